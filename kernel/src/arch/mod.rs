@@ -27,6 +27,10 @@ pub use riscv64::smp;
 #[cfg(feature = "riscv64")]
 pub use riscv64::ipi;
 
+// 导出 tlb 模块
+#[cfg(feature = "riscv64")]
+pub use riscv64::tlb;
+
 // 导出 cpu_id 函数
 #[cfg(feature = "riscv64")]
 pub use riscv64::smp::cpu_id;
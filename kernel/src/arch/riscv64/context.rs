@@ -24,7 +24,7 @@ pub struct InterruptGuard {
 impl InterruptGuard {
     /// 禁用中断并创建守卫
     ///
-    /// 保存 sstatus 寄存器，清除 SIE 位（全局中断使能）
+    /// 保存 sstatus 寄存器，清除 SIE 位（全局中断使能），持有期间计入抢占计数
     #[inline]
     pub unsafe fn new() -> Self {
         let flags: u64;
@@ -34,12 +34,13 @@ impl InterruptGuard {
         // 清除 SIE 位（bit 1）
         temp = flags & !0x02;
         asm!("csrw sstatus, {}", in(reg) temp, options(nomem, nostack));
+        crate::sched::preempt::preempt_disable();
         InterruptGuard { flags }
     }
 }
 
 impl Drop for InterruptGuard {
-    /// 恢复中断状态
+    /// 恢复中断状态，重新打开中断时检查抢占
     #[inline]
     fn drop(&mut self) {
         unsafe {
@@ -49,6 +50,7 @@ impl Drop for InterruptGuard {
                 options(nomem, nostack)
             );
         }
+        crate::sched::preempt::preempt_enable();
     }
 }
 
@@ -104,6 +106,11 @@ pub unsafe fn context_switch(prev: &mut Task, next: &mut Task) {
     // ...
     let _irq_guard = InterruptGuard::new();
 
+    // 抢占计数随任务保存和恢复 (thread_info::preempt_count)：
+    // 恢复执行的任务在这里继续，计数包括上面的守卫；新任务从 0 开始
+    prev.se.preempt_count = crate::sched::preempt::preempt_count();
+    crate::sched::preempt::preempt_count_set(next.se.preempt_count);
+
     // 获取 CpuContext 的指针
     let next_ctx: *mut CpuContext = next.context_mut();
     let prev_ctx: *mut CpuContext = prev.context_mut();
@@ -184,11 +191,13 @@ impl UserContext {
         // - SPP (bit 8) = 0: 从 S-Mode 返回到 U-Mode
         // - SPIE (bit 5) = 1: 在 U-Mode 中使能中断
         // - SUM (bit 18) = 1: 允许 S 模式访问用户内存
+        // - FS (bits 13-14) = Off: 浮点状态延迟装载
         sstatus_value &= !(1 << 8);   // Clear SPP (返回到 U 模式)
         sstatus_value |= 1 << 5;    // Set SPIE (U 模式中使能中断)
         sstatus_value |= 1 << 18;   // Set SUM (S 模式可访问用户内存)
+        sstatus_value &= !super::fpu::SR_FS;  // 关闭浮点，第一次使用时装载
 
-        // 读取当前 tp 寄存器（包含 hart ID）
+        // 读取当前 tp 寄存器（指向本 CPU 的每 CPU 数据区）
         let tp_value: u64;
         unsafe {
             asm!("mv {}, tp", out(reg) tp_value, options(nomem, nostack, pure));
@@ -199,7 +208,7 @@ impl UserContext {
             x1: 0,
             x2: 0,
             x3: global_pointer, // gp - 全局指针，musl libc 使用 gp-relative 寻址
-            x4: tp_value, // tp - hart ID，用于 cpu_id()
+            x4: tp_value, // tp - 每 CPU 数据区，用于 cpu_id()
             x5: 0,
             x6: 0,
             x7: 0,
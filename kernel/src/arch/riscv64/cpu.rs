@@ -5,6 +5,9 @@
 
 /// CPU 相关操作 (RISC-V 64-bit)
 use core::arch::asm;
+use core::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use alloc::string::String;
+use spin::Mutex;
 
 /// 获取当前核心ID (hart ID)
 #[inline]
@@ -134,3 +137,192 @@ pub fn restore_irq(state: bool) {
         enable_irq();
     }
 }
+
+/// sstatus.SIE：S 模式中断使能
+const SSTATUS_SIE: usize = 1 << 1;
+/// sstatus.VS：向量单元状态，Off = 0，Initial = 1
+const SSTATUS_VS: usize = 3 << 9;
+const SSTATUS_VS_INITIAL: usize = 1 << 9;
+
+/// 设备树报告的 ISA 字符串最大长度
+const RISCV_ISA_MAX_LEN: usize = 256;
+
+/// CPU 是否支持向量扩展 (RISCV_ISA_EXT_v)
+static RISCV_ISA_V: AtomicBool = AtomicBool::new(false);
+
+/// CPU 是否支持无进位乘法扩展 (RISCV_ISA_EXT_ZBC)
+static RISCV_ISA_ZBC: AtomicBool = AtomicBool::new(false);
+
+/// cbo.zero 清零的块大小 (riscv_cboz_block_size)，0 表示不支持 Zicboz
+static RISCV_CBOZ_BLOCK_SIZE: AtomicUsize = AtomicUsize::new(0);
+
+/// 设备树报告的 ISA 字符串，供 /proc/cpuinfo 显示
+static RISCV_ISA: Mutex<String> = Mutex::new(String::new());
+
+/// 从设备树读取 ISA 扩展 (riscv_fill_hwcap)
+///
+/// # 参数
+/// - `dtb_ptr`: 设备树扁平数据指针
+pub fn init_isa_extensions(dtb_ptr: u64) {
+    let mut buf = [0u8; RISCV_ISA_MAX_LEN];
+    let len = match unsafe { crate::fdt::scan_cpu_isa(dtb_ptr, &mut buf) } {
+        Some(len) => len,
+        None => return,
+    };
+    let isa = match core::str::from_utf8(&buf[..len]) {
+        Ok(isa) => isa,
+        Err(_) => return,
+    };
+    RISCV_ISA_V.store(isa_has_extension(isa, 'v'), Ordering::Release);
+    RISCV_ISA_ZBC.store(isa_has_multi_extension(isa, "zbc"), Ordering::Release);
+    // 块大小必须是不超过一页的 2 的幂，否则按块清零会越过页边界或漏掉部分字节
+    if isa_has_multi_extension(isa, "zicboz") {
+        let block = unsafe { crate::fdt::scan_cpu_u32(dtb_ptr, b"riscv,cboz-block-size") }.unwrap_or(0) as usize;
+        if block.is_power_of_two() && block <= crate::mm::page::PAGE_SIZE {
+            RISCV_CBOZ_BLOCK_SIZE.store(block, Ordering::Release);
+        }
+    }
+    *RISCV_ISA.lock() = String::from(isa);
+    super::string::init_string_ops();
+}
+
+/// ISA 字符串是否包含单字母扩展
+///
+/// 单字母扩展位于 "rv64" 之后、第一个 '_' 之前，例如 "rv64imafdcv_zicsr"
+pub fn isa_has_extension(isa: &str, ext: char) -> bool {
+    let base = isa.split('_').next().unwrap_or("");
+    base.len() > 4
+        && base[..4].eq_ignore_ascii_case("rv64")
+        && base[4..].chars().any(|c| c.to_ascii_lowercase() == ext)
+}
+
+/// ISA 字符串是否包含多字母扩展
+///
+/// 多字母扩展以 '_' 分隔，位于单字母扩展之后，例如 "rv64imafdc_zicsr_zbc"
+pub fn isa_has_multi_extension(isa: &str, ext: &str) -> bool {
+    isa.split('_').skip(1).any(|e| e.eq_ignore_ascii_case(ext))
+}
+
+/// CPU 是否支持向量扩展 (has_vector)
+#[inline]
+pub fn has_vector() -> bool {
+    RISCV_ISA_V.load(Ordering::Acquire)
+}
+
+/// CPU 是否支持 Zbc 无进位乘法 (riscv_has_extension_likely(RISCV_ISA_EXT_ZBC))
+#[inline]
+pub fn has_zbc() -> bool {
+    RISCV_ISA_ZBC.load(Ordering::Acquire)
+}
+
+/// cbo.zero 的块大小；不支持 Zicboz 时返回 None
+#[inline]
+pub fn cboz_block_size() -> Option<usize> {
+    match RISCV_CBOZ_BLOCK_SIZE.load(Ordering::Acquire) {
+        0 => None,
+        block => Some(block),
+    }
+}
+
+/// 报告给用户空间的 AT_HWCAP (riscv_fill_hwcap)
+///
+/// 单字母扩展 x 对应位 (x - 'a')。用户态的向量寄存器不随任务切换保存，
+/// 不报告 V 扩展，用户程序不会使用向量指令
+pub fn elf_hwcap() -> u64 {
+    let isa = RISCV_ISA.lock();
+    let base = isa.split('_').next().unwrap_or("");
+    if base.len() <= 4 || !base[..4].eq_ignore_ascii_case("rv64") {
+        return 0;
+    }
+    let mut hwcap = 0u64;
+    for c in base[4..].chars().map(|c| c.to_ascii_lowercase()) {
+        if c.is_ascii_lowercase() && c != 'v' {
+            hwcap |= 1 << (c as u32 - 'a' as u32);
+        }
+    }
+    hwcap
+}
+
+/// 设备树报告的 ISA 字符串；没有设备树时返回 None
+pub fn isa_string() -> Option<String> {
+    let isa = RISCV_ISA.lock();
+    if isa.is_empty() {
+        None
+    } else {
+        Some(isa.clone())
+    }
+}
+
+/// 开始在内核中使用向量寄存器 (kernel_vector_begin)
+///
+/// 关闭本 CPU 中断并打开向量单元；用户态从不打开向量单元，
+/// 因此没有需要保存的用户向量状态
+///
+/// # 返回
+/// 进入前的 sstatus，交给 kernel_vector_end 恢复
+#[inline]
+pub unsafe fn kernel_vector_begin() -> usize {
+    let sstatus: usize;
+    asm!("csrrci {}, sstatus, 2", out(reg) sstatus, options(nostack));
+    asm!("csrs sstatus, {}", in(reg) SSTATUS_VS_INITIAL, options(nostack));
+    sstatus
+}
+
+/// 结束向量寄存器的使用 (kernel_vector_end)
+///
+/// 关闭向量单元并恢复进入前的中断状态
+#[inline]
+pub unsafe fn kernel_vector_end(sstatus: usize) {
+    asm!("csrc sstatus, {}", in(reg) SSTATUS_VS, options(nostack));
+    asm!("csrs sstatus, {}", in(reg) sstatus & SSTATUS_SIE, options(nostack));
+}
+
+/// 清零一页 (clear_page)
+///
+/// 支持 Zicboz 时按块执行 cbo.zero，不经过读取整行再写回；
+/// 否则有向量扩展时用 RVV 整组存储零，都没有时退回 write_bytes
+///
+/// # Safety
+/// addr 必须页对齐，且指向可写的一整页
+pub unsafe fn clear_page(addr: usize) {
+    let size = crate::mm::page::PAGE_SIZE;
+    if let Some(block) = cboz_block_size() {
+        let mut p = addr;
+        while p < addr + size {
+            asm!(
+                ".option push",
+                ".option arch, +zicboz",
+                "cbo.zero ({p})",
+                ".option pop",
+                p = in(reg) p,
+                options(nostack),
+            );
+            p += block;
+        }
+        return;
+    }
+    if has_vector() {
+        let state = kernel_vector_begin();
+        // v8-v15 整组置零后每轮存 vl 字节；内核其余代码不依赖向量寄存器的内容
+        asm!(
+            ".option push",
+            ".option arch, +v",
+            "vsetvli {vl}, zero, e8, m8, ta, ma",
+            "vmv.v.i v8, 0",
+            "2:",
+            "vsetvli {vl}, {n}, e8, m8, ta, ma",
+            "vse8.v v8, ({p})",
+            "sub {n}, {n}, {vl}",
+            "add {p}, {p}, {vl}",
+            "bnez {n}, 2b",
+            ".option pop",
+            vl = out(reg) _,
+            n = inout(reg) size => _,
+            p = inout(reg) addr => _,
+            options(nostack),
+        );
+        kernel_vector_end(state);
+        return;
+    }
+    core::ptr::write_bytes(addr as *mut u8, 0, size);
+}
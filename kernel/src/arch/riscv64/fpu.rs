@@ -0,0 +1,314 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 浮点状态的延迟保存与恢复 (arch/riscv/include/asm/switch_to.h)
+//!
+//! 每个任务在 Task::fpu 中保存 32 个浮点寄存器和 fcsr (__riscv_d_ext_state)。
+//! 内核自身关闭 sstatus.FS 运行，任务切换时不做任何浮点操作：
+//! - 从用户模式进入 trap 时，TrapFrame 中的 FS 为 Dirty 说明用户改过浮点寄存器，
+//!   记在任务上，FS 改为 Clean
+//! - 切换走时只保存改过的寄存器 (__switch_to_fpu)
+//! - 返回用户模式时，寄存器仍是本任务在本 CPU 上装载的内容就直接使用
+//!   (fpsimd_last_state / fpsimd_cpu)；否则把 FS 设为 Off，用户第一次使用浮点时
+//!   触发非法指令异常再恢复。连续多次切换都用到浮点的任务在返回时直接恢复，
+//!   省掉这次异常 (fpu_counter)
+//! - 内核代码使用浮点同样触发非法指令异常：先保存当前任务改过的寄存器，
+//!   放弃本 CPU 的寄存器归属后打开 FS
+//!
+//! 目标是 RV64GC，没有向量扩展，不处理 sstatus.VS。
+
+use core::ptr;
+use core::sync::atomic::{AtomicPtr, Ordering};
+
+use crate::arch::riscv64::trap::TrapFrame;
+use crate::config::MAX_CPUS;
+use crate::process::task::Task;
+
+/// sstatus.FS 字段 (SR_FS)
+pub const SR_FS: u64 = 0x6000;
+pub const SR_FS_OFF: u64 = 0x0000;
+pub const SR_FS_INITIAL: u64 = 0x2000;
+pub const SR_FS_CLEAN: u64 = 0x4000;
+pub const SR_FS_DIRTY: u64 = 0x6000;
+
+/// 寄存器没有装载在任何 CPU 上
+const CPU_NONE: u32 = u32::MAX;
+
+/// 连续这么多次切换都用到浮点后，返回用户模式时直接恢复
+const EAGER_THRESHOLD: u8 = 5;
+
+/// 浮点寄存器 (struct __riscv_d_ext_state)
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct FpState {
+    pub f: [u64; 32],
+    pub fcsr: u32,
+}
+
+impl FpState {
+    pub const fn new() -> Self {
+        Self { f: [0; 32], fcsr: 0 }
+    }
+}
+
+/// 任务的浮点状态 (thread_struct::fstate)
+#[derive(Debug, Clone, Copy)]
+pub struct ThreadFpu {
+    /// 保存在内存中的寄存器
+    pub state: FpState,
+    /// 硬件寄存器有未保存的修改
+    dirty: bool,
+    /// 本次运行期间用到了浮点
+    used: bool,
+    /// 寄存器最近装载在哪个 CPU 上 (fpsimd_cpu)
+    cpu: u32,
+    /// 连续用到浮点的切换次数 (fpu_counter)
+    counter: u8,
+}
+
+impl ThreadFpu {
+    pub const fn new() -> Self {
+        Self { state: FpState::new(), dirty: false, used: false, cpu: CPU_NONE, counter: 0 }
+    }
+
+    /// 新任务的状态：复制寄存器内容，不继承硬件寄存器和使用统计
+    pub fn fork_copy(&self) -> Self {
+        Self { state: self.state, ..Self::new() }
+    }
+
+    /// 硬件寄存器是否有未保存的修改
+    pub fn is_dirty(&self) -> bool {
+        self.dirty
+    }
+}
+
+/// 各 CPU 的浮点寄存器当前属于哪个任务 (fpsimd_last_state)
+///
+/// 只和 current 比较，不解引用
+static FPU_OWNER: [AtomicPtr<Task>; MAX_CPUS] = [const { AtomicPtr::new(ptr::null_mut()) }; MAX_CPUS];
+
+core::arch::global_asm!(
+    ".section .text",
+    ".global __fstate_save",
+    "__fstate_save:",
+    "    li t0, 0x6000",
+    "    csrrs t1, sstatus, t0",
+    "    fsd f0, 0(a0)",
+    "    fsd f1, 8(a0)",
+    "    fsd f2, 16(a0)",
+    "    fsd f3, 24(a0)",
+    "    fsd f4, 32(a0)",
+    "    fsd f5, 40(a0)",
+    "    fsd f6, 48(a0)",
+    "    fsd f7, 56(a0)",
+    "    fsd f8, 64(a0)",
+    "    fsd f9, 72(a0)",
+    "    fsd f10, 80(a0)",
+    "    fsd f11, 88(a0)",
+    "    fsd f12, 96(a0)",
+    "    fsd f13, 104(a0)",
+    "    fsd f14, 112(a0)",
+    "    fsd f15, 120(a0)",
+    "    fsd f16, 128(a0)",
+    "    fsd f17, 136(a0)",
+    "    fsd f18, 144(a0)",
+    "    fsd f19, 152(a0)",
+    "    fsd f20, 160(a0)",
+    "    fsd f21, 168(a0)",
+    "    fsd f22, 176(a0)",
+    "    fsd f23, 184(a0)",
+    "    fsd f24, 192(a0)",
+    "    fsd f25, 200(a0)",
+    "    fsd f26, 208(a0)",
+    "    fsd f27, 216(a0)",
+    "    fsd f28, 224(a0)",
+    "    fsd f29, 232(a0)",
+    "    fsd f30, 240(a0)",
+    "    fsd f31, 248(a0)",
+    "    frcsr t2",
+    "    sw t2, 256(a0)",
+    "    csrw sstatus, t1",
+    "    ret",
+    "",
+    ".global __fstate_restore",
+    "__fstate_restore:",
+    "    li t0, 0x6000",
+    "    csrrs t1, sstatus, t0",
+    "    fld f0, 0(a0)",
+    "    fld f1, 8(a0)",
+    "    fld f2, 16(a0)",
+    "    fld f3, 24(a0)",
+    "    fld f4, 32(a0)",
+    "    fld f5, 40(a0)",
+    "    fld f6, 48(a0)",
+    "    fld f7, 56(a0)",
+    "    fld f8, 64(a0)",
+    "    fld f9, 72(a0)",
+    "    fld f10, 80(a0)",
+    "    fld f11, 88(a0)",
+    "    fld f12, 96(a0)",
+    "    fld f13, 104(a0)",
+    "    fld f14, 112(a0)",
+    "    fld f15, 120(a0)",
+    "    fld f16, 128(a0)",
+    "    fld f17, 136(a0)",
+    "    fld f18, 144(a0)",
+    "    fld f19, 152(a0)",
+    "    fld f20, 160(a0)",
+    "    fld f21, 168(a0)",
+    "    fld f22, 176(a0)",
+    "    fld f23, 184(a0)",
+    "    fld f24, 192(a0)",
+    "    fld f25, 200(a0)",
+    "    fld f26, 208(a0)",
+    "    fld f27, 216(a0)",
+    "    fld f28, 224(a0)",
+    "    fld f29, 232(a0)",
+    "    fld f30, 240(a0)",
+    "    fld f31, 248(a0)",
+    "    lw t2, 256(a0)",
+    "    fscsr t2",
+    "    csrw sstatus, t1",
+    "    ret",
+);
+
+extern "C" {
+    fn __fstate_save(state: *mut FpState);
+    fn __fstate_restore(state: *const FpState);
+}
+
+/// 把硬件浮点寄存器写入 state (__fstate_save)
+///
+/// 临时打开 FS，返回前恢复原来的 sstatus
+pub unsafe fn fstate_save(state: &mut FpState) {
+    __fstate_save(state);
+}
+
+/// 把 state 装入硬件浮点寄存器 (__fstate_restore)
+///
+/// 会改写 callee-saved 的 fs0-fs11：只在内核不持有浮点值的地方调用
+pub unsafe fn fstate_restore(state: &FpState) {
+    __fstate_restore(state);
+}
+
+fn this_cpu() -> usize {
+    crate::arch::cpu_id() as usize % MAX_CPUS
+}
+
+/// 硬件寄存器装载的是否是 task 的状态
+fn regs_owned_by(task: *mut Task, cpu: usize) -> bool {
+    FPU_OWNER[cpu].load(Ordering::Relaxed) == task
+        && unsafe { (*task).fpu.cpu } == cpu as u32
+}
+
+/// 把 task 的状态装入本 CPU 的硬件寄存器
+unsafe fn load_regs(task: *mut Task, cpu: usize) {
+    fstate_restore(&(*task).fpu.state);
+    (*task).fpu.cpu = cpu as u32;
+    (*task).fpu.dirty = false;
+    FPU_OWNER[cpu].store(task, Ordering::Relaxed);
+}
+
+/// 从用户模式进入 trap (fstate_save 的脏位检查)
+///
+/// 记录用户是否改过浮点寄存器，然后关闭 FS，内核代码不使用浮点
+pub unsafe fn fpu_trap_entry(frame: *mut TrapFrame) {
+    if (*frame).sstatus & SR_FS == SR_FS_DIRTY {
+        if let Some(task) = crate::sched::current() {
+            task.fpu.dirty = true;
+            task.fpu.used = true;
+        }
+        (*frame).sstatus = ((*frame).sstatus & !SR_FS) | SR_FS_CLEAN;
+    }
+    core::arch::asm!("csrc sstatus, {}", in(reg) SR_FS);
+}
+
+/// 切换走之前保存改过的浮点寄存器 (__switch_to_fpu)
+///
+/// 没有改过就不保存，寄存器仍然归 prev 所有，prev 回到本 CPU 时不用恢复
+pub unsafe fn fpu_switch_out(prev: *mut Task) {
+    let fpu = &mut (*prev).fpu;
+    if fpu.dirty {
+        fstate_save(&mut fpu.state);
+        fpu.dirty = false;
+    }
+    fpu.counter = if fpu.used { fpu.counter.saturating_add(1) } else { 0 };
+    fpu.used = false;
+}
+
+/// 返回用户模式前决定浮点寄存器的状态
+///
+/// 寄存器仍属于当前任务时直接使用；经常用浮点的任务立即恢复；
+/// 其余关闭 FS，第一次使用时由 fpu_first_use 恢复
+pub unsafe fn fpu_exit_to_user(frame: *mut TrapFrame) {
+    let task = match crate::sched::current() {
+        Some(task) => task as *mut Task,
+        None => return,
+    };
+    let cpu = this_cpu();
+    let fs = if regs_owned_by(task, cpu) {
+        SR_FS_CLEAN
+    } else if (*task).fpu.counter >= EAGER_THRESHOLD {
+        load_regs(task, cpu);
+        SR_FS_CLEAN
+    } else {
+        SR_FS_OFF
+    };
+    (*frame).sstatus = ((*frame).sstatus & !SR_FS) | fs;
+}
+
+/// 非法指令异常：FS 关闭时第一次使用浮点 (do_trap_insn_illegal)
+///
+/// # 返回
+/// 是 FS 关闭引起的，已打开 FS、重新执行该指令时返回 true
+pub unsafe fn fpu_first_use(frame: *mut TrapFrame) -> bool {
+    if (*frame).sstatus & SR_FS != SR_FS_OFF {
+        return false;
+    }
+    let cpu = this_cpu();
+    let current = crate::sched::current().map_or(ptr::null_mut(), |task| task as *mut Task);
+    let from_user = (*frame).sstatus & 0x100 == 0;
+
+    if from_user {
+        if current.is_null() {
+            return false;
+        }
+        if !regs_owned_by(current, cpu) {
+            load_regs(current, cpu);
+        }
+        (*current).fpu.used = true;
+        (*frame).sstatus = ((*frame).sstatus & !SR_FS) | SR_FS_CLEAN;
+    } else {
+        // 内核使用浮点会改写寄存器：先保存当前任务的修改，再放弃归属
+        if !current.is_null() && regs_owned_by(current, cpu) && (*current).fpu.dirty {
+            fstate_save(&mut (*current).fpu.state);
+            (*current).fpu.dirty = false;
+        }
+        FPU_OWNER[cpu].store(ptr::null_mut(), Ordering::Relaxed);
+        (*frame).sstatus = ((*frame).sstatus & !SR_FS) | SR_FS_INITIAL;
+    }
+    true
+}
+
+/// 把硬件寄存器中未保存的修改写回 task 的内存状态 (fstate_save)
+///
+/// 读取 Task::fpu::state 之前调用，例如 fork 和建立信号帧
+pub unsafe fn fpu_flush(task: *mut Task) {
+    if (*task).fpu.dirty && regs_owned_by(task, this_cpu()) {
+        fstate_save(&mut (*task).fpu.state);
+        (*task).fpu.dirty = false;
+    }
+}
+
+/// 内存状态被替换后丢弃硬件寄存器中的旧内容，例如 rt_sigreturn
+pub unsafe fn fpu_invalidate(task: *mut Task) {
+    (*task).fpu.cpu = CPU_NONE;
+    (*task).fpu.dirty = false;
+}
+
+/// execve 时清空浮点状态 (flush_thread)
+pub unsafe fn flush_thread(task: *mut Task) {
+    (*task).fpu = ThreadFpu::new();
+}
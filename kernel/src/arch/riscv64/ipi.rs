@@ -4,15 +4,29 @@
 //!
 //! RISC-V IPI (Inter-Processor Interrupt) 支持
 //!
-//! - smp_cross_call() - 发送跨 CPU 调用
-//! - handle_IPI() - 处理 IPI
+//! - send_ipi_mask() - 一次 SBI 调用向多个 CPU 发送 IPI
+//! - smp_call_function_many() - 在其他 CPU 上执行函数 (kernel/smp.c)
+//! - handle_software_ipi() - 处理 IPI
 //!
 //! IPI 类型：
 //! - RESCHEDULE: 通知目标 CPU 重新调度（当有新任务或负载均衡时）
 //! - STOP: 停止目标 CPU
+//! - DRAIN_PAGES: 内存压力下清空目标 CPU 的 Per-CPU 页缓存
+//! - CALL_FUNCTION: 执行目标 CPU 调用队列中的函数
 //!
 //! 使用 RISC-V 软件中断（SSIP）和 SBI IPI Extension (EID #0x735049)
+//! 软件中断不携带数据，IPI 类型记录在目标 CPU 的待处理位图中
+//!
+//! 跨 CPU 调用：每个 CPU 一个无锁调用队列 (call_single_queue)，
+//! 请求 (call_single_data) 由发起 CPU 为每个目标预留一份。
+//! 只有队列从空变为非空时才需要 IPI，所有目标的 IPI 合并成一次 SBI 调用。
+//! 同步调用等目标执行完函数才返回；异步调用入队后即返回，
+//! 下一次使用同一请求前等待上一次执行完
 
+use core::cell::UnsafeCell;
+use core::ptr;
+use core::sync::atomic::{AtomicBool, AtomicPtr, AtomicU8, AtomicUsize, Ordering};
+use crate::config::MAX_CPUS;
 use crate::sbi;
 use crate::println;
 
@@ -23,6 +37,101 @@ pub enum IpiType {
     Reschedule = 0,
     /// 停止 CPU
     Stop = 1,
+    /// 清空 Per-CPU 页缓存
+    DrainPages = 2,
+    /// 刷新 TLB（处理 tlb 模块中的刷新队列）
+    TlbFlush = 3,
+    /// 执行跨 CPU 调用队列中的函数
+    CallFunction = 4,
+}
+
+/// 跨 CPU 调用的函数，参数是发起方传入的 info
+pub type SmpCallFunc = fn(usize);
+
+/// 跨 CPU 调用请求 (call_single_data_t)
+struct CallSingleData {
+    /// 目标 CPU 调用队列中的下一项 (llist_node)
+    next: AtomicPtr<CallSingleData>,
+    func: UnsafeCell<Option<SmpCallFunc>>,
+    info: UnsafeCell<usize>,
+    /// 发起方等待函数执行完 (SCF_WAIT)
+    wait: AtomicBool,
+    /// 请求已入队、尚未执行完 (CSD_FLAG_LOCK)
+    locked: AtomicBool,
+}
+
+// func 和 info 只在持有 locked 的一方写入，目标 CPU 出队后读取
+unsafe impl Sync for CallSingleData {}
+
+impl CallSingleData {
+    const fn new() -> Self {
+        Self {
+            next: AtomicPtr::new(ptr::null_mut()),
+            func: UnsafeCell::new(None),
+            info: UnsafeCell::new(0),
+            wait: AtomicBool::new(false),
+            locked: AtomicBool::new(false),
+        }
+    }
+}
+
+crate::percpu! {
+    /// 待处理的 IPI 类型位图（第 n 位对应 IpiType = n）
+    static IPI_PENDING: AtomicU8 = AtomicU8::new(0);
+
+    /// 发给本 CPU 的跨 CPU 调用，后入队的在前 (call_single_queue)
+    static CALL_SINGLE_QUEUE: AtomicPtr<CallSingleData> = AtomicPtr::new(ptr::null_mut());
+
+    /// 本 CPU 发起调用时每个目标 CPU 一份请求 (cfd_data)
+    static CFD_DATA: [CallSingleData; MAX_CPUS] = [const { CallSingleData::new() }; MAX_CPUS];
+}
+
+/// 已使能软件中断、能处理跨 CPU 调用的 CPU 位图
+static IPI_READY_MASK: AtomicUsize = AtomicUsize::new(0);
+
+/// 统计：发送的 SBI IPI 调用数、跨 CPU 调用请求数
+static IPI_SBI_CALLS: AtomicUsize = AtomicUsize::new(0);
+static IPI_CALL_REQS: AtomicUsize = AtomicUsize::new(0);
+
+/// 发送指定类型的 IPI 到目标 CPU
+///
+/// 不发送给自己
+pub fn send_ipi(target_cpu: usize, ipi: IpiType) {
+    if target_cpu >= MAX_CPUS {
+        return;
+    }
+    send_ipi_mask(1 << target_cpu, ipi);
+}
+
+/// 发送指定类型的 IPI 到位图中的所有 CPU (send_ipi_mask)
+///
+/// 不发送给自己；先记录类型再发送，一次 SBI 调用通知全部目标
+pub fn send_ipi_mask(mask: usize, ipi: IpiType) {
+    let targets = mask & cpu_mask_all() & !(1 << crate::arch::cpu_id());
+    if targets == 0 {
+        return;
+    }
+    for cpu in 0..MAX_CPUS {
+        if targets & (1 << cpu) != 0 {
+            IPI_PENDING.per_cpu(cpu).fetch_or(1 << ipi as u8, Ordering::Release);
+        }
+    }
+    IPI_SBI_CALLS.fetch_add(1, Ordering::Relaxed);
+    let _ = sbi::send_ipi_mask(targets, 0);
+}
+
+/// 所有可能的 CPU 的位图
+#[inline]
+fn cpu_mask_all() -> usize {
+    (1 << MAX_CPUS) - 1
+}
+
+/// 能处理跨 CPU 调用的 CPU 位图：调用过 ipi::init 的 CPU
+///
+/// 只在 WFI 中等待、没有使能软件中断的次核不会执行调用队列，同步调用不能等它们
+#[inline]
+pub fn ipi_ready_mask() -> usize {
+    IPI_READY_MASK.load(Ordering::Acquire)
 }
 
 /// 发送 Reschedule IPI 到指定 CPU
@@ -32,20 +141,156 @@ pub enum IpiType {
 ///
 ///
 /// # 参数
-/// * `target_cpu` - 目标 CPU ID
+/// * `target_cpu` - 目标 CPU ID，不存在的 CPU 忽略
 pub fn send_reschedule_ipi(target_cpu: usize) {
-    if target_cpu >= 4 {
+    send_ipi(target_cpu, IpiType::Reschedule);
+}
+
+/// 把请求加入目标 CPU 的调用队列 (llist_add)
+///
+/// # 返回
+/// 队列原来为空，需要发送 IPI
+fn call_queue_add(cpu: usize, csd: &CallSingleData) -> bool {
+    let head = CALL_SINGLE_QUEUE.per_cpu(cpu);
+    let node = csd as *const CallSingleData as *mut CallSingleData;
+    let mut first = head.load(Ordering::Relaxed);
+    loop {
+        csd.next.store(first, Ordering::Relaxed);
+        match head.compare_exchange_weak(first, node, Ordering::Release, Ordering::Relaxed) {
+            Ok(_) => return first.is_null(),
+            Err(cur) => first = cur,
+        }
+    }
+}
+
+/// 执行发给本 CPU 的跨 CPU 调用 (flush_smp_call_function_queue)
+///
+/// 由 CallFunction IPI 调用，也由等待请求完成的发起方调用：
+/// 两个 CPU 互相发起同步调用时各自处理对方的请求，不会死锁
+///
+/// # 返回
+/// 执行的函数数
+pub fn flush_smp_call_function_queue() -> usize {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let mut pos = CALL_SINGLE_QUEUE.this_cpu().swap(ptr::null_mut(), Ordering::Acquire);
+
+    // 队列后入队的在前，反转后按入队顺序执行
+    let mut list: *mut CallSingleData = ptr::null_mut();
+    while !pos.is_null() {
+        let next = unsafe { (*pos).next.load(Ordering::Relaxed) };
+        unsafe { (*pos).next.store(list, Ordering::Relaxed) };
+        list = pos;
+        pos = next;
+    }
+
+    let mut nr = 0;
+    while !list.is_null() {
+        let csd = unsafe { &*list };
+        list = csd.next.load(Ordering::Relaxed);
+        let (func, info) = unsafe { (*csd.func.get(), *csd.info.get()) };
+        if csd.wait.load(Ordering::Relaxed) {
+            // 同步调用：执行完再释放，发起方借此知道函数已完成
+            if let Some(func) = func {
+                func(info);
+            }
+            csd.locked.store(false, Ordering::Release);
+        } else {
+            // 异步调用：先释放，发起方可以立即复用请求
+            csd.locked.store(false, Ordering::Release);
+            if let Some(func) = func {
+                func(info);
+            }
+        }
+        nr += 1;
+    }
+    nr
+}
+
+/// 等待请求执行完 (csd_lock_wait)
+///
+/// 等待时处理发给本 CPU 的调用和 TLB 刷新，对方可能也在等本 CPU
+fn csd_lock_wait(csd: &CallSingleData) {
+    while csd.locked.load(Ordering::Acquire) {
+        flush_smp_call_function_queue();
+        super::tlb::handle_flush_ipi();
+        core::hint::spin_loop();
+    }
+}
+
+/// 在 mask 中的其他 CPU 上执行 func(info) (smp_call_function_many)
+///
+/// 自己不在目标之内；不能处理 IPI 的 CPU 被忽略。wait 为 true 时所有目标执行完才返回，
+/// 否则只保证请求已入队。所有目标的 IPI 合并为一次 SBI 调用，
+/// 目标队列中已有请求时不再发送 IPI。
+///
+/// func 在目标 CPU 的中断上下文中执行，不能睡眠，也不能再发起跨 CPU 调用
+pub fn smp_call_function_many(mask: usize, func: SmpCallFunc, info: usize, wait: bool) {
+    // 关中断：不迁移到其他 CPU，本 CPU 的请求不被重入
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let this_cpu = crate::arch::cpu_id();
+    let targets = mask & ipi_ready_mask() & !(1 << this_cpu);
+    if targets == 0 {
         return;
     }
 
-    // 不要发送给自己
-    let current_cpu = crate::arch::cpu_id() as usize;
-    if target_cpu == current_cpu {
+    let cfd = unsafe { &*CFD_DATA.this_cpu_ptr() };
+    let mut ipi_mask = 0;
+    for cpu in 0..MAX_CPUS {
+        if targets & (1 << cpu) == 0 {
+            continue;
+        }
+        let csd = &cfd[cpu];
+        // 上一次异步调用还没执行完时等它 (csd_lock)
+        csd_lock_wait(csd);
+        csd.locked.store(true, Ordering::Relaxed);
+        unsafe {
+            *csd.func.get() = Some(func);
+            *csd.info.get() = info;
+        }
+        csd.wait.store(wait, Ordering::Relaxed);
+        IPI_CALL_REQS.fetch_add(1, Ordering::Relaxed);
+        if call_queue_add(cpu, csd) {
+            ipi_mask |= 1 << cpu;
+        }
+    }
+    send_ipi_mask(ipi_mask, IpiType::CallFunction);
+
+    if wait {
+        for cpu in 0..MAX_CPUS {
+            if targets & (1 << cpu) != 0 {
+                csd_lock_wait(&cfd[cpu]);
+            }
+        }
+    }
+}
+
+/// 在指定 CPU 上执行 func(info) (smp_call_function_single)
+///
+/// 目标是本 CPU 时关中断直接执行
+pub fn smp_call_function_single(cpu: usize, func: SmpCallFunc, info: usize, wait: bool) {
+    if cpu >= MAX_CPUS {
+        return;
+    }
+    if cpu == crate::arch::cpu_id() {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        func(info);
         return;
     }
+    smp_call_function_many(1 << cpu, func, info, wait);
+}
+
+/// 在所有能处理 IPI 的 CPU 上执行 func(info) (on_each_cpu)
+///
+/// 本 CPU 关中断直接执行
+pub fn on_each_cpu(func: SmpCallFunc, info: usize, wait: bool) {
+    smp_call_function_many(cpu_mask_all(), func, info, wait);
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    func(info);
+}
 
-    // 通过 SBI 发送 IPI
-    let _ = sbi::send_ipi(target_cpu);
+/// IPI 统计：(SBI 调用数, 跨 CPU 调用请求数)
+pub fn ipi_stats() -> (usize, usize) {
+    (IPI_SBI_CALLS.load(Ordering::Relaxed), IPI_CALL_REQS.load(Ordering::Relaxed))
 }
 
 /// 处理软件中断 IPI
@@ -57,6 +302,29 @@ pub fn send_reschedule_ipi(target_cpu: usize) {
 /// # 参数
 /// * `hart` - 当前 hart ID
 pub fn handle_software_ipi(hart: usize) {
+    let pending = if hart < MAX_CPUS {
+        IPI_PENDING.this_cpu().swap(0, Ordering::Acquire)
+    } else {
+        0
+    };
+
+    if pending & (1 << IpiType::CallFunction as u8) != 0 {
+        flush_smp_call_function_queue();
+    }
+
+    if pending & (1 << IpiType::DrainPages as u8) != 0 {
+        crate::mm::pcp::drain_local_pages();
+    }
+
+    if pending & (1 << IpiType::TlbFlush as u8) != 0 {
+        super::tlb::handle_flush_ipi();
+    }
+
+    // 没有记录类型的软件中断按 Reschedule 处理（兼容直接发送的 SBI IPI）
+    if pending != 0 && pending & (1 << IpiType::Reschedule as u8) == 0 {
+        return;
+    }
+
     // 处理 IPI - 触发调度器
     // 当其他 CPU 发送 Reschedule IPI 时，表示需要触发调度
     // 例如：唤醒了高优先级任务、需要负载均衡等
@@ -109,4 +377,5 @@ pub fn init() {
             options(nomem, nostack)
         );
     }
+    IPI_READY_MASK.fetch_or(1 << crate::arch::cpu_id(), Ordering::Release);
 }
@@ -18,8 +18,12 @@
 use crate::println;
 use crate::config::MAX_PAGE_TABLES;
 use core::arch::asm;
-use core::sync::atomic::{AtomicBool, AtomicI32, AtomicUsize, Ordering};
-use spin::RwLock;
+use core::sync::atomic::{AtomicBool, AtomicI32, AtomicPtr, AtomicU8, AtomicUsize, Ordering};
+use spin::{Mutex, RwLock};
+use alloc::boxed::Box;
+use alloc::collections::BTreeMap;
+use alloc::sync::Arc;
+use alloc::vec::Vec;
 
 /// 调试输出宏
 macro_rules! debug_mm {
@@ -95,6 +99,48 @@ pub mod map {
     pub const MAP_NODUMP: u32 = 0x10000;
 }
 
+/// madvise 建议类型 (advice)
+pub mod madv {
+    /// 无特殊建议
+    pub const MADV_NORMAL: i32 = 0;
+    /// 随机访问，不预读
+    pub const MADV_RANDOM: i32 = 1;
+    /// 顺序访问，扩大预读
+    pub const MADV_SEQUENTIAL: i32 = 2;
+    /// 将要访问，提前读入
+    pub const MADV_WILLNEED: i32 = 3;
+    /// 不再需要，立即释放
+    pub const MADV_DONTNEED: i32 = 4;
+    /// 内存紧张时可以释放（惰性释放）
+    pub const MADV_FREE: i32 = 8;
+    /// 释放映射的后备存储
+    pub const MADV_REMOVE: i32 = 9;
+    /// fork 时不复制
+    pub const MADV_DONTFORK: i32 = 10;
+    /// fork 时复制
+    pub const MADV_DOFORK: i32 = 11;
+    /// 可合并（KSM）
+    pub const MADV_MERGEABLE: i32 = 12;
+    /// 不可合并
+    pub const MADV_UNMERGEABLE: i32 = 13;
+    /// 使用巨页
+    pub const MADV_HUGEPAGE: i32 = 14;
+    /// 不使用巨页
+    pub const MADV_NOHUGEPAGE: i32 = 15;
+    /// 不转储到 core
+    pub const MADV_DONTDUMP: i32 = 16;
+    /// 转储到 core
+    pub const MADV_DODUMP: i32 = 17;
+}
+
+/// mremap 标志
+pub mod mremap {
+    /// 不能原地扩展时可以移动到新地址
+    pub const MREMAP_MAYMOVE: u32 = 0x1;
+    /// 移动到 new_addr 指定的地址（必须同时指定 MREMAP_MAYMOVE）
+    pub const MREMAP_FIXED: u32 = 0x2;
+}
+
 /// mmap 错误码
 pub mod mmap_error {
     /// 无效参数
@@ -113,6 +159,17 @@ pub mod mmap_error {
     pub const EBADF: i64 = -9;
 }
 
+/// 内核栈区域 (VMAP_STACK)
+///
+/// 位于地址空间高半部分（根页表最后一项），页表在启动时建好，之后创建的
+/// 用户页表复制同一个根页表项，因此所有地址空间看到相同的内核栈映射
+pub mod vmap_stack {
+    /// 区域起始地址
+    pub const START: u64 = 0xFFFF_FFFF_C000_0000;
+    /// 区域大小
+    pub const SIZE: u64 = 32 * 1024 * 1024;
+}
+
 /// 用户空间地址范围
 pub mod user_addr {
     /// 用户空间起始地址
@@ -133,6 +190,14 @@ pub mod user_addr {
     pub const HEAP_START: usize = 0x0100_0000;
     /// 堆最大大小
     pub const HEAP_MAX_SIZE: usize = 128 * 1024 * 1024;  // 128MB
+    /// brk 的默认起点
+    pub const BRK_START: usize = 0x2000_0000;  // 512MB
+    /// 用户页表私有区域的结束地址：只有根页表第 0 项（最低 1GB）不复制内核页表，
+    /// 之上的各项（内核、PCI MMIO 等设备）与内核共享，见 copy_kernel_mappings
+    pub const USER_PRIVATE_END: usize = 0x4000_0000;
+    /// copy_kernel_mappings 在私有区域中映射的 UART 页
+    pub const USER_UART_BASE: usize = 0x1000_0000;
+    pub const USER_UART_SIZE: usize = 0x1000;
 }
 
 // ==================== 地址类型 ====================
@@ -311,12 +376,42 @@ impl PageTableEntry {
         self.0 & Self::U != 0
     }
 
+    /// 检查是否为叶子项（R/W/X 任一置位；否则指向下一级页表）
+    #[inline]
+    pub fn is_leaf(&self) -> bool {
+        self.0 & (Self::R | Self::W | Self::X) != 0
+    }
+
     /// 获取物理页号（PPN，bits [53:10]）
     #[inline]
     pub fn ppn(&self) -> u64 {
         (self.0 >> 10) & 0x00FFFFFFFFFFFFFF
     }
 
+    /// 换出页的页表项 (swp_entry_to_pte)
+    #[inline]
+    pub fn new_swap(offset: usize) -> Self {
+        Self(((offset as u64) << swap_flags::OFFSET_SHIFT) | swap_flags::SWAP)
+    }
+
+    /// 是否为换出页的页表项 (is_swap_pte)
+    #[inline]
+    pub fn is_swap(&self) -> bool {
+        self.0 & (Self::V | swap_flags::SWAP) == swap_flags::SWAP
+    }
+
+    /// 换出页的交换槽号 (swp_offset)
+    #[inline]
+    pub fn swap_offset(&self) -> usize {
+        (self.0 >> swap_flags::OFFSET_SHIFT) as usize
+    }
+
+    /// 既没有映射也不是换出页 (pte_none)
+    #[inline]
+    pub fn is_none(&self) -> bool {
+        self.0 == 0
+    }
+
     /// 创建指向下一级页表的 PTE
     #[inline]
     pub fn new_table(ppn: u64) -> Self {
@@ -443,8 +538,88 @@ impl Satp {
 // ==================== 地址空间 ====================
 
 use crate::mm::vma::{Vma, VmaManager, VmaFlags, VmaType};
-use crate::mm::pagemap::{MapError, Perm, PageTableType};
+use crate::mm::pagemap::{MapError, PageTableType};
 use crate::mm::page::{VirtAddr as PageVirtAddr, PhysAddr as PagePhysAddr, PAGE_SIZE as PAGE_SIZE_USIZE};
+use crate::mm::vmstat::{count_pgalloc, count_pgfree, count_vm_event, nr_pages_order, VmEvent};
+use super::tlb::{self, MmContext};
+
+/// 地址空间的页表锁 (page_table_lock)
+///
+/// 由 Arc 持有：惰性释放 (MADV_FREE) 的页在页描述符中记录所属的页表锁，
+/// 页回收通过它找到根页表并在锁内解除映射。地址空间释放后页表不回收，
+/// 记录的根页表因此始终有效
+struct PageTableLock {
+    /// 所属地址空间的根页表 PPN
+    root_ppn: u64,
+    lock: Mutex<()>,
+}
+
+impl PageTableLock {
+    fn new(root_ppn: u64) -> Arc<Self> {
+        Arc::new(Self { root_ppn, lock: Mutex::new(()) })
+    }
+
+    #[inline]
+    fn lock(&self) -> spin::MutexGuard<'_, ()> {
+        self.lock.lock()
+    }
+
+    #[inline]
+    fn try_lock(&self) -> Option<spin::MutexGuard<'_, ()>> {
+        self.lock.try_lock()
+    }
+}
+
+/// 缺页路径无锁查找用的 VMA 快照，按起始地址排序
+///
+/// VMA 写锁释放时由 VmaWriteGuard 重新发布，旧快照在 RCU 宽限期后释放
+/// （对应 maple tree 的 RCU 读取）
+struct VmaSnapshot {
+    vmas: Vec<Vma>,
+}
+
+impl VmaSnapshot {
+    /// 二分查找包含 addr 的 VMA
+    fn find(&self, addr: PageVirtAddr) -> Option<&Vma> {
+        let idx = self.vmas.partition_point(|vma| vma.start().as_usize() <= addr.as_usize());
+        self.vmas[..idx].last().filter(|vma| vma.contains(addr))
+    }
+}
+
+/// VMA 写锁守卫
+///
+/// 持有期间修改序号为奇数；释放时先发布新的 VMA 快照，再把序号加一变回偶数，
+/// 之后才释放写锁 (mmap_write_unlock → vma_end_write_all)
+pub struct VmaWriteGuard<'a> {
+    space: &'a AddressSpace,
+    guard: spin::RwLockWriteGuard<'a, VmaManager>,
+}
+
+impl core::ops::Deref for VmaWriteGuard<'_> {
+    type Target = VmaManager;
+
+    fn deref(&self) -> &VmaManager {
+        &self.guard
+    }
+}
+
+impl core::ops::DerefMut for VmaWriteGuard<'_> {
+    fn deref_mut(&mut self) -> &mut VmaManager {
+        &mut self.guard
+    }
+}
+
+impl Drop for VmaWriteGuard<'_> {
+    fn drop(&mut self) {
+        let snapshot = Box::into_raw(Box::new(VmaSnapshot { vmas: self.guard.iter().copied().collect() }));
+        let old = self.space.vma_snapshot.swap(snapshot, Ordering::AcqRel);
+        if !old.is_null() {
+            // 缺页路径可能还在读旧快照
+            crate::sync::kfree_rcu(unsafe { Box::from_raw(old) });
+        }
+        self.space.vma_seq.fetch_add(1, Ordering::Release);
+    }
+}
 
 pub struct AddressSpace {
     /// 页表根节点 PPN
@@ -452,6 +627,10 @@ pub struct AddressSpace {
     /// VMA 管理器（受 RwLock 保护）
     /// 使用 RwLock 包装实现内部可变性
     vma_manager: RwLock<VmaManager>,
+    /// VMA 修改序号 (mm_lock_seq)：写锁持有期间为奇数，每次写锁加二
+    vma_seq: AtomicUsize,
+    /// 缺页路径无锁查找的 VMA 快照，为空指针时没有 VMA
+    vma_snapshot: AtomicPtr<VmaSnapshot>,
     /// 地址空间类型
     space_type: PageTableType,
     /// 堆指针 (brk)（受原子操作保护）
@@ -460,6 +639,10 @@ pub struct AddressSpace {
     mm_users: AtomicI32,
     /// 引用计数：mm_struct 的生命期引用
     mm_count: AtomicI32,
+    /// 页表锁：串行化缺页时的页表项安装 (page_table_lock)
+    page_table_lock: Arc<PageTableLock>,
+    /// ASID 与运行过的 CPU (mm_context_t)
+    context: MmContext,
 }
 
 impl AddressSpace {
@@ -474,7 +657,7 @@ impl AddressSpace {
         // - 0x40000000+ - 其他设备
         // 使用 0x20000000 (512MB)，在程序区域和设备区域之间
         let brk = if space_type == PageTableType::User {
-            0x2000_0000usize  // 512MB
+            user_addr::BRK_START
         } else {
             0usize
         };
@@ -482,10 +665,14 @@ impl AddressSpace {
         Self {
             root_ppn,
             vma_manager: RwLock::new(vma_manager),
+            vma_seq: AtomicUsize::new(0),
+            vma_snapshot: AtomicPtr::new(core::ptr::null_mut()),
             space_type,
             brk: core::sync::atomic::AtomicUsize::new(brk),
             mm_users: AtomicI32::new(1),
             mm_count: AtomicI32::new(1),
+            page_table_lock: PageTableLock::new(root_ppn),
+            context: MmContext::new(),
         }
     }
 
@@ -495,10 +682,14 @@ impl AddressSpace {
         Self {
             root_ppn,
             vma_manager: RwLock::new(vma),
+            vma_seq: AtomicUsize::new(0),
+            vma_snapshot: AtomicPtr::new(core::ptr::null_mut()),
             space_type,
             brk: core::sync::atomic::AtomicUsize::new(brk.as_usize()),
             mm_users: AtomicI32::new(1),
             mm_count: AtomicI32::new(1),
+            page_table_lock: PageTableLock::new(root_ppn),
+            context: MmContext::new(),
         }
     }
 
@@ -568,15 +759,81 @@ impl AddressSpace {
     }
 
     /// 获取 VMA 写锁
+    ///
+    /// 取得写锁后修改序号变为奇数，进行中的无锁缺页在安装页表项前发现修改并重试
+    #[inline]
+    pub fn vma_write(&self) -> VmaWriteGuard<'_> {
+        let guard = self.vma_manager.write();
+        self.vma_seq.fetch_add(1, Ordering::AcqRel);
+        VmaWriteGuard { space: self, guard }
+    }
+
+    /// 开始无锁读取 VMA (mmap_lock_speculate_try_begin)
+    ///
+    /// 有写者正在修改时在读锁上等它完成，返回的序号总是偶数
+    pub fn vma_seq_begin(&self) -> usize {
+        let seq = self.vma_seq.load(Ordering::Acquire);
+        if seq & 1 == 0 {
+            return seq;
+        }
+        let _vma_mgr = self.vma_read();
+        self.vma_seq.load(Ordering::Acquire)
+    }
+
+    /// 自 vma_seq_begin 返回 seq 以来 VMA 是否被修改过 (mmap_lock_speculate_retry)
+    ///
+    /// 缺页在页表锁内检查：修改 VMA 的一方先增加序号，之后才在页表锁内清除页表项，
+    /// 未发现修改时安装的页表项一定会被随后的清除看到
     #[inline]
-    pub fn vma_write(&self) -> spin::RwLockWriteGuard<'_, VmaManager> {
-        self.vma_manager.write()
+    pub fn vma_seq_retry(&self, seq: usize) -> bool {
+        self.vma_seq.load(Ordering::Acquire) != seq
     }
 
+    /// 不加 VMA 锁查找包含 addr 的 VMA (lock_vma_under_rcu)
+    ///
+    /// 读取 RCU 发布的快照，写者不会阻塞查找；与 vma_seq_begin 配合，
+    /// 结果只在序号未变化时有效
+    pub fn find_vma_rcu(&self, addr: PageVirtAddr) -> Option<Vma> {
+        let _rcu = crate::sync::rcu_read_lock();
+        let snapshot = unsafe { self.vma_snapshot.load(Ordering::Acquire).as_ref() }?;
+        snapshot.find(addr).copied()
+    }
+
+    /// TLB 上下文
+    #[inline]
+    pub fn context(&self) -> &MmContext {
+        &self.context
+    }
+
+    /// 当前 ASID（未启用 ASID 时为 0）
+    #[inline]
+    pub fn asid(&self) -> u64 {
+        self.context.asid()
+    }
+
+    /// 切换到此地址空间 (switch_mm)
+    ///
+    /// 写入带 ASID 的 satp，只有 ASID 代数翻转后才刷新本地 TLB
     pub unsafe fn enable(&self) {
-        let satp = Satp::sv39(self.root_ppn, 0);
-        asm!("csrw satp, {}", in(reg) satp.bits());
-        asm!("sfence.vma zero, zero");
+        tlb::switch_mm(self.root_ppn, &self.context);
+    }
+
+    /// 带 ASID 的 satp 值（需先 enable 分配 ASID）
+    #[inline]
+    pub fn satp(&self) -> u64 {
+        Satp::sv39(self.root_ppn, self.asid() as u16).bits()
+    }
+
+    /// 刷新此地址空间在所有 CPU 上 [start, end) 的 TLB (flush_tlb_range)
+    #[inline]
+    pub fn flush_tlb_range(&self, start: usize, end: usize) {
+        tlb::flush_tlb_range(&self.context, start, end);
+    }
+
+    /// 刷新此地址空间在所有 CPU 上一个页的 TLB (flush_tlb_page)
+    #[inline]
+    pub fn flush_tlb_page(&self, addr: usize) {
+        tlb::flush_tlb_page(&self.context, addr);
     }
 
     pub unsafe fn disable() {
@@ -596,37 +853,36 @@ impl AddressSpace {
     // ==================== VMA 操作 ====================
 
     /// 映射 VMA（需要写锁）
-    pub fn map_vma(&self, vma: Vma, perm: Perm) -> Result<(), MapError> {
+    ///
+    /// 只登记 VMA，不分配物理页：页在第一次访问时由 handle_mm_fault 分配
+    /// 页表权限在缺页时由 VMA 标志决定
+    pub fn map_vma(&self, vma: Vma) -> Result<(), MapError> {
         let mut vma_mgr = self.vma_write();
+        vma_mgr.add(vma).map_err(|_| MapError::Invalid)
+    }
 
-        let start = vma.start();
-        let end = vma.end();
-        vma_mgr.add(vma).map_err(|_| MapError::Invalid)?;
-
-        let mut addr = start.as_usize();
+    /// 预先为 [start, end) 建立映射 (populate_vma_page_range)
+    ///
+    /// 逐页模拟缺页，可写 VMA 按写缺页处理
+    ///
+    /// # 返回
+    /// 内存不足时返回 MapError::OutOfMemory，已映射的页保持不变
+    pub fn populate(&self, start: PageVirtAddr, end: PageVirtAddr) -> Result<(), MapError> {
+        let mut addr = start.as_usize() & !(PAGE_SIZE_USIZE - 1);
         while addr < end.as_usize() {
-            // 使用用户物理内存分配器（而非内核帧分配器）
-            let phys_addr = alloc_user_phys_page().ok_or(MapError::OutOfMemory)? as usize;
-            let flags = perm_to_flags(perm, self.space_type);
-
-            // 转换为 RISC-V 类型并映射
-            unsafe {
-                map_page(
-                    self.root_ppn,
-                    VirtAddr::new(addr as u64),
-                    PhysAddr::new(phys_addr as u64),
-                    flags,
-                );
+            let writable = match self.find_vma(PageVirtAddr::new(addr)) {
+                Some(vma) => vma.flags().is_writable(),
+                None => return Err(MapError::NotMapped),
+            };
+            let flags = FaultFlags::USER | if writable { FaultFlags::WRITE } else { FaultFlags::READ };
+            match handle_mm_fault(self, VirtAddr::new(addr as u64), flags) {
+                MmFaultResult::OutOfMemory => return Err(MapError::OutOfMemory),
+                MmFaultResult::CowPending => unsafe {
+                    handle_cow_fault(self, VirtAddr::new(addr as u64))
+                        .ok_or(MapError::OutOfMemory)?;
+                },
+                _ => {}
             }
-
-            // 使用物理地址清零（内核使用 identity mapping）
-            // 在 RISC-V 上，内核使用 identity mapping，物理地址就是虚拟地址
-            unsafe {
-                // 直接通过物理地址清零（identity mapping）
-                let ptr = phys_addr as *mut u8;
-                core::ptr::write_bytes(ptr, 0, PAGE_SIZE_USIZE);
-            }
-
             addr += PAGE_SIZE_USIZE;
         }
         Ok(())
@@ -649,9 +905,221 @@ impl AddressSpace {
         vma_mgr.find(addr).cloned()
     }
 
+    /// 虚拟地址所在页是否已建立映射
+    pub fn is_mapped(&self, addr: PageVirtAddr) -> bool {
+        unsafe { PageTableWalker::walk(self.root_ppn, addr.as_usize() as u64) }.is_some()
+    }
+
+    /// 查询虚拟地址映射到的物理地址
+    pub fn translate(&self, addr: PageVirtAddr) -> Option<PagePhysAddr> {
+        let ppn = unsafe { PageTableWalker::walk(self.root_ppn, addr.as_usize() as u64) }?;
+        Some(PagePhysAddr::new(((ppn << PAGE_SHIFT) as usize) | (addr.as_usize() & (PAGE_SIZE_USIZE - 1))))
+    }
+
+    /// 后台合并扫描使用的句柄 (mm::ksm)
+    pub fn mm_handle(&self) -> MmHandle {
+        MmHandle(self.page_table_lock.clone())
+    }
+
+    /// 把用户页交给内核：为页增加一个引用并改为只读 + COW (vmsplice SPLICE_F_GIFT)
+    ///
+    /// 之后用户再写这一页时由 handle_cow_fault 复制出新页，内核持有的页内容不变；
+    /// 内核先归还引用时只恢复写权限。只交出可写私有匿名 VMA 中、本地址空间独有的
+    /// L0 页表里的可写 4KB 页；大页、fork 共享的页表、共享或锁定的映射返回 None
+    ///
+    /// # 返回
+    /// 页的物理地址，调用者用完后以 put_page 归还引用
+    pub fn gift_user_page(&self, addr: usize) -> Option<usize> {
+        use crate::mm::page_desc::pfn_to_page;
+
+        let addr = addr & !(PAGE_SIZE_USIZE - 1);
+        let vma = self.find_vma(PageVirtAddr::new(addr))?;
+        if vma.vma_type() != VmaType::Anonymous
+            || vma.flags().is_shared()
+            || !vma.flags().is_writable()
+            || vma.flags().contains(VmaFlags::LOCKED)
+        {
+            return None;
+        }
+
+        let ptl = self.page_table_lock.lock();
+        let phys = unsafe {
+            let (table1, vpn1) = l1_entry(self.root_ppn, addr, false)?;
+            let pte1 = (*table1).get(vpn1);
+            if !pte1.is_valid() || pte1.is_leaf() || pte1.bits() & shared_flags::SHARED != 0 {
+                return None;
+            }
+            let table0 = (pte1.ppn() << PAGE_SHIFT) as *mut PageTable;
+            let vpn0 = (addr >> 12) & 0x1FF;
+            let pte0 = (*table0).get(vpn0);
+            if !pte0.is_valid() || !pte0.is_user() || !pte0.is_writable()
+                || pte0.bits() & shared_flags::SPECIAL != 0
+            {
+                return None;
+            }
+            let pfn = pte0.ppn() as usize;
+            let page = pfn_to_page(pfn);
+            if page.is_null() || (*page).is_reserved() || (*page).refcount() <= 0 {
+                return None;
+            }
+            (*page).get_page();
+            (*table0).set(vpn0, PageTableEntry::from_bits(
+                pte0.bits() & !PageTableEntry::W | cow_flags::COW
+            ));
+            pfn * PAGE_SIZE_USIZE
+        };
+        drop(ptl);
+
+        // 去掉了写权限，其他 CPU 上可写的 TLB 项必须失效
+        self.flush_tlb_page(addr);
+        Some(phys)
+    }
+
+    /// 固定用户缓冲区 [addr, addr + len) 所在的页，供设备直接读写 (pin_user_pages)
+    ///
+    /// 逐页模拟缺页：设备要写入内存 (write) 时按写缺页处理，COW 页先复制出私有页，
+    /// 设备写到的就是用户之后看到的页。每页增加一个引用，I/O 期间即使 munmap 也不会释放
+    ///
+    /// # 返回
+    /// 各页的物理地址，调用者用完后以 filemap::put_page 逐页归还；
+    /// 地址不在用户可访问的 VMA 内返回 EFAULT，内存不足返回 ENOMEM
+    pub fn pin_user_pages(&self, addr: usize, len: usize, write: bool) -> Result<Vec<usize>, i32> {
+        use crate::mm::page_desc::pfn_to_page;
+
+        const EFAULT: i32 = -14;
+        const ENOMEM: i32 = -12;
+
+        let mut pages = Vec::new();
+        if len == 0 {
+            return Ok(pages);
+        }
+        let end = addr.checked_add(len).ok_or(EFAULT)?;
+        let unpin = |pages: &[usize]| pages.iter().for_each(|&phys| crate::mm::filemap::put_page(phys));
+        let mut page_addr = addr & !(PAGE_SIZE_USIZE - 1);
+        while page_addr < end {
+            let fault_addr = VirtAddr::new(page_addr as u64);
+            let flags = FaultFlags::USER | if write { FaultFlags::WRITE } else { FaultFlags::READ };
+            let result = match handle_mm_fault(self, fault_addr, flags) {
+                MmFaultResult::Handled | MmFaultResult::AlreadyMapped => Ok(()),
+                MmFaultResult::CowPending => unsafe { handle_cow_fault(self, fault_addr) }.ok_or(ENOMEM),
+                MmFaultResult::OutOfMemory => Err(ENOMEM),
+                _ => Err(EFAULT),
+            };
+            // 查页表与加引用在页表锁内，页不会在两者之间被换掉
+            let phys = result.and_then(|()| {
+                let _ptl = self.page_table_lock.lock();
+                let phys = self.translate(PageVirtAddr::new(page_addr)).ok_or(EFAULT)?.as_usize();
+                let page = pfn_to_page(phys / PAGE_SIZE_USIZE);
+                if page.is_null() || unsafe { !(*page).try_get_page() } {
+                    return Err(EFAULT);
+                }
+                Ok(phys)
+            });
+            match phys {
+                Ok(phys) => pages.push(phys),
+                Err(e) => {
+                    unpin(&pages);
+                    return Err(e);
+                }
+            }
+            page_addr += PAGE_SIZE_USIZE;
+        }
+        Ok(pages)
+    }
+
+    /// 把内核持有的页映射到用户空间 (vm_insert_pages)
+    ///
+    /// 在 addr（为 0 时由内核选择）建立共享 VMA 并逐页填好页表，用户与内核访问同一批页；
+    /// 每页另加一个引用，随页表项一起归还，内核可以先于用户释放自己的引用
+    ///
+    /// # 返回
+    /// 映射的起始地址
+    pub fn insert_pages(&self, addr: PageVirtAddr, pages: &[usize], writable: bool) -> Result<PageVirtAddr, MapError> {
+        use crate::mm::page_desc::pfn_to_page;
+
+        if pages.is_empty() {
+            return Err(MapError::Invalid);
+        }
+        let mut flags = VmaFlags::new();
+        flags.insert(VmaFlags::READ);
+        flags.insert(VmaFlags::SHARED);
+        let mut pte_flags = PageTableEntry::V | PageTableEntry::U | PageTableEntry::R | PageTableEntry::A;
+        if writable {
+            flags.insert(VmaFlags::WRITE);
+            pte_flags |= PageTableEntry::W | PageTableEntry::D;
+        }
+        let start = self.mmap(addr, pages.len() * PAGE_SIZE_USIZE, flags, VmaType::Anonymous, map::MAP_SHARED)?;
+
+        let ptl = self.page_table_lock.lock();
+        for (i, &page) in pages.iter().enumerate() {
+            let desc = pfn_to_page(page / PAGE_SIZE_USIZE);
+            unsafe {
+                if !desc.is_null() {
+                    (*desc).get_page();
+                }
+                map_page(
+                    self.root_ppn,
+                    VirtAddr::new((start.as_usize() + i * PAGE_SIZE_USIZE) as u64),
+                    PhysAddr::new(page as u64),
+                    pte_flags,
+                );
+            }
+        }
+        drop(ptl);
+        Ok(start)
+    }
+
+    /// 把驱动持有的物理内存映射到用户空间 (remap_pfn_range)
+    ///
+    /// 用于帧缓冲区这类驱动分配的普通内存：页表项带 SPECIAL，不参与引用计数，
+    /// 与普通内存一样可缓存。选址时与 phys 保持相同的 2MB 内偏移，对齐的部分
+    /// 用大页映射；登记为 Device 类型的 VMA，不会与其他映射重叠，可以 munmap
+    ///
+    /// # 参数
+    /// - `addr`: 建议的起始地址，0 或与已有映射冲突时由内核选择
+    /// - `phys`: 物理地址，必须页对齐
+    /// - `pte_flags`: 页表项权限 (R, W, X, U)
+    pub fn mmap_pfn(
+        &self,
+        addr: PageVirtAddr,
+        phys: usize,
+        size: usize,
+        flags: VmaFlags,
+        pte_flags: u64,
+    ) -> Result<PageVirtAddr, MapError> {
+        let map_len = (size + PAGE_SIZE_USIZE - 1) & !(PAGE_SIZE_USIZE - 1);
+        if map_len == 0 || phys % PAGE_SIZE_USIZE != 0 {
+            return Err(MapError::Invalid);
+        }
+
+        let hint = addr.as_usize();
+        let hint_ok = hint != 0 && hint % PAGE_SIZE_USIZE == 0 && hint >= user_addr::USER_START && {
+            let test_vma = Vma::new(addr, PageVirtAddr::new(hint + map_len), flags);
+            !self.vma_read().iter().any(|v| v.overlaps(&test_vma))
+        };
+        let start = if hint_ok {
+            hint
+        } else {
+            let offset = phys % HPAGE_SIZE;
+            match self.find_free_area(map_len + offset, HPAGE_SIZE) {
+                Ok(base) => base.as_usize() + offset,
+                Err(_) => self.find_free_area(map_len, PAGE_SIZE_USIZE)?.as_usize(),
+            }
+        };
+
+        let mut vma = Vma::new(PageVirtAddr::new(start), PageVirtAddr::new(start + map_len), flags);
+        vma.set_type(VmaType::Device);
+        self.map_vma(vma)?;
+        let ptl = self.page_table_lock.lock();
+        unsafe {
+            map_device_range(self.root_ppn, start, phys, map_len, pte_flags);
+        }
+        drop(ptl);
+        Ok(PageVirtAddr::new(start))
+    }
+
     /// 调整堆指针（需要写锁）
     pub fn set_brk(&self, new_brk: PageVirtAddr) -> Result<PageVirtAddr, MapError> {
-        use crate::mm;
 
         if new_brk.as_usize() == 0 {
             return Ok(self.brk());
@@ -676,43 +1144,44 @@ impl AddressSpace {
         }
 
         if new_brk.as_usize() > old_brk {
-            let old_brk_aligned = old_brk & !(PAGE_SIZE_USIZE - 1);
-            let new_brk_aligned = new_brk.as_usize() & !(PAGE_SIZE_USIZE - 1);
-
-            let mut addr = old_brk_aligned;
-            while addr < new_brk_aligned {
-                if unsafe { PageTableWalker::walk(self.root_ppn, addr as u64) }.is_none() {
-                    let frame = mm::alloc_frame().ok_or(MapError::OutOfMemory)?;
-                    let flags = perm_to_flags(Perm::ReadWrite, self.space_type);
-                    unsafe {
-                        map_page(
-                            self.root_ppn,
-                            VirtAddr::new(addr as u64),
-                            PhysAddr::new(frame.start_address().as_usize() as u64),
-                            flags,
-                        );
-                    }
-
-                    // 在写锁内添加 VMA
-                    let mut vma_mgr = self.vma_write();
-                    let mut vma_flags = VmaFlags::new();
-                    vma_flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::GROWSUP);
-                    let vma = Vma::new(
-                        PageVirtAddr::new(addr),
-                        PageVirtAddr::new(addr + PAGE_SIZE_USIZE),
-                        vma_flags,
-                    );
-                    let _ = vma_mgr.add(vma);
-                }
-                addr += PAGE_SIZE_USIZE;
-            }
-
+            self.expand_brk(old_brk, new_brk.as_usize())?;
             self.brk.store(new_brk.as_usize(), Ordering::Release);
         }
 
         Ok(new_brk)
     }
 
+    /// 扩展堆 VMA 覆盖 [old_brk, new_brk) (do_brk_flags)
+    ///
+    /// 不分配物理页；与前一个堆 VMA 相邻时直接扩展它 (vma_merge)
+    ///
+    /// # 返回
+    /// 新区域与已有映射重叠时返回 MapError::AlreadyMapped
+    pub fn expand_brk(&self, old_brk: usize, new_brk: usize) -> Result<(), MapError> {
+        let start = (old_brk + PAGE_SIZE_USIZE - 1) & !(PAGE_SIZE_USIZE - 1);
+        let end = (new_brk + PAGE_SIZE_USIZE - 1) & !(PAGE_SIZE_USIZE - 1);
+        if end <= start {
+            return Ok(());
+        }
+
+        let mut vma_flags = VmaFlags::new();
+        vma_flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::GROWSUP);
+        let vma = Vma::new(PageVirtAddr::new(start), PageVirtAddr::new(end), vma_flags);
+
+        let mut vma_mgr = self.vma_write();
+        if vma_mgr.iter().any(|v| v.overlaps(&vma)) {
+            return Err(MapError::AlreadyMapped);
+        }
+        if start >= PAGE_SIZE_USIZE {
+            if let Some(prev) = vma_mgr.find_mut(PageVirtAddr::new(start - PAGE_SIZE_USIZE)) {
+                if prev.merge(vma) {
+                    return Ok(());
+                }
+            }
+        }
+        vma_mgr.add(vma).map_err(|_| MapError::AlreadyMapped)
+    }
+
     /// mmap 系统调用实现
     ///
     ///
@@ -721,8 +1190,10 @@ impl AddressSpace {
     /// - `size`: 映射长度
     /// - `flags`: VMA 标志
     /// - `vma_type`: VMA 类型
-    /// - `perm`: 页权限
-    /// - `map_flags`: mmap 标志（MAP_FIXED 等）
+    /// - `map_flags`: mmap 标志（MAP_FIXED、MAP_POPULATE 等）
+    ///
+    /// 映射是惰性的：物理页在第一次访问时分配，
+    /// 只有 MAP_POPULATE / MAP_LOCKED 会立即建立映射
     ///
     /// # 返回
     /// 成功返回映射的起始地址，失败返回 MapError
@@ -732,23 +1203,66 @@ impl AddressSpace {
         size: usize,
         flags: VmaFlags,
         vma_type: VmaType,
-        perm: Perm,
         map_flags: u32,
     ) -> Result<PageVirtAddr, MapError> {
-        let aligned_size = (size + PAGE_SIZE_USIZE - 1) & !(PAGE_SIZE_USIZE - 1);
+        self.do_mmap(addr, size, flags, vma_type, None, map_flags)
+    }
+
+    /// 文件映射：从文件字节偏移 offset 开始映射 ino 的页缓存
+    ///
+    /// 缺页时映射页缓存中的页 (filemap_fault)；私有映射写时复制，
+    /// 同一文件的多个映射共享未写过的缓存页
+    ///
+    /// # 参数
+    /// - `offset`: 文件偏移，必须页对齐
+    pub fn mmap_file(
+        &self,
+        addr: PageVirtAddr,
+        size: usize,
+        flags: VmaFlags,
+        ino: u64,
+        offset: usize,
+        map_flags: u32,
+    ) -> Result<PageVirtAddr, MapError> {
+        if offset % PAGE_SIZE_USIZE != 0 || flags.contains(VmaFlags::HUGETLB) {
+            return Err(MapError::Invalid);
+        }
+        self.do_mmap(addr, size, flags, VmaType::FileBacked, Some((ino, offset)), map_flags)
+    }
+
+    /// 建立映射 (do_mmap)
+    fn do_mmap(
+        &self,
+        addr: PageVirtAddr,
+        size: usize,
+        flags: VmaFlags,
+        vma_type: VmaType,
+        file: Option<(u64, usize)>,
+        map_flags: u32,
+    ) -> Result<PageVirtAddr, MapError> {
+        // MAP_HUGETLB 映射的长度和地址按大页对齐
+        let huge = flags.contains(VmaFlags::HUGETLB);
+        let granule = if huge { HPAGE_SIZE } else { PAGE_SIZE_USIZE };
+        let aligned_size = (size + granule - 1) & !(granule - 1);
         if aligned_size == 0 {
             return Err(MapError::Invalid);
         }
+        // 不小于大页的匿名映射按 2MB 对齐选址，便于使用大页 (thp_get_unmapped_area)
+        let align = if vma_type == VmaType::Anonymous && aligned_size >= HPAGE_SIZE {
+            HPAGE_SIZE
+        } else {
+            PAGE_SIZE_USIZE
+        };
 
-        // 检查 MAP_FIXED
-        let is_fixed = map_flags & map::MAP_FIXED != 0;
+        // 检查 MAP_FIXED / MAP_FIXED_NOREPLACE
+        let is_fixed = map_flags & (map::MAP_FIXED | map::MAP_FIXED_NOREPLACE) != 0;
 
         // 确定映射起始地址
         let start = if is_fixed {
             // MAP_FIXED: 强制使用指定地址
             let start = addr;
             // 检查地址对齐
-            if start.as_usize() % PAGE_SIZE_USIZE != 0 {
+            if start.as_usize() % granule != 0 {
                 return Err(MapError::Invalid);
             }
             // 检查地址范围
@@ -758,7 +1272,7 @@ impl AddressSpace {
             start
         } else if addr.as_usize() == 0 {
             // 地址为 0，由内核选择合适的地址
-            self.find_free_area(aligned_size)?
+            self.find_free_area(aligned_size, align)?
         } else {
             // 尝试使用建议的地址，如果冲突则查找其他地址
             let end = PageVirtAddr::new(addr.as_usize() + aligned_size);
@@ -769,23 +1283,36 @@ impl AddressSpace {
             let has_conflict = vma_mgr.iter().any(|v| v.overlaps(&test_vma));
             drop(vma_mgr);
 
-            if has_conflict {
-                self.find_free_area(aligned_size)?
+            if has_conflict || addr.as_usize() % granule != 0 {
+                self.find_free_area(aligned_size, align)?
             } else {
                 addr
             }
         };
 
         let end = PageVirtAddr::new(start.as_usize() + aligned_size);
+        // MAP_FIXED 替换范围内原有的映射，MAP_FIXED_NOREPLACE 遇到重叠失败
+        if map_flags & map::MAP_FIXED != 0 && map_flags & map::MAP_FIXED_NOREPLACE == 0 {
+            self.munmap_range(start.as_usize(), end.as_usize())?;
+        }
         let mut vma = Vma::new(start, end, flags);
         vma.set_type(vma_type);
-        self.map_vma(vma, perm)?;
+        if let Some((ino, offset)) = file {
+            vma.set_file_mapping(ino, offset);
+        }
+        self.map_vma(vma)?;
+
+        // 与 Linux 一样，预填充失败不影响 mmap 的返回值 (mm_populate)
+        if map_flags & (map::MAP_POPULATE | map::MAP_LOCKED) != 0 {
+            let _ = self.populate(start, end);
+        }
         Ok(start)
     }
 
     /// 查找空闲的虚拟地址区域
     ///
-    fn find_free_area(&self, size: usize) -> Result<PageVirtAddr, MapError> {
+    /// 返回的起始地址按 align（页大小或大页大小）对齐
+    fn find_free_area(&self, size: usize, align: usize) -> Result<PageVirtAddr, MapError> {
         use user_addr::{MMAP_START, MMAP_END, USER_END};
 
         let aligned_size = (size + PAGE_SIZE_USIZE - 1) & !(PAGE_SIZE_USIZE - 1);
@@ -796,7 +1323,7 @@ impl AddressSpace {
         let vma_mgr = self.vma_read();
 
         // 从 mmap 区域开始查找
-        let mut search_start = MMAP_START;
+        let mut search_start = (MMAP_START + align - 1) & !(align - 1);
         let search_end = MMAP_END.min(USER_END - aligned_size);
 
         // 遍历现有 VMA，查找空隙
@@ -815,7 +1342,7 @@ impl AddressSpace {
 
             // 更新搜索起点到当前 VMA 结束地址
             if vma.end().as_usize() > search_start {
-                search_start = (vma.end().as_usize() + PAGE_SIZE_USIZE - 1) & !(PAGE_SIZE_USIZE - 1);
+                search_start = (vma.end().as_usize() + align - 1) & !(align - 1);
             }
 
             // 检查是否超出搜索范围
@@ -870,13 +1397,19 @@ impl AddressSpace {
                     // 完全取消映射
                     let mut vma_mgr = self.vma_write();
                     vma_mgr.remove(vma_start)?;
-                } else if addr.as_usize() > vma_start_usize && end_addr < vma_end_usize {
-                    // 部分取消映射（中间部分）- 需要分割 VMA
-                    // TODO: 实现 VMA 分割
-                    return Err(MapError::Invalid);
                 } else {
-                    // 部分重叠
-                    return Err(MapError::Invalid);
+                    // 部分取消映射：分割 VMA，保留 [addr, end_addr) 之外的部分 (__split_vma)
+                    let mut vma_mgr = self.vma_write();
+                    let vma = *vma_mgr.get(vma_start).ok_or(MapError::NotMapped)?;
+                    vma_mgr.remove(vma_start)?;
+                    let mut rest = vma;
+                    if let Some((head, tail)) = vma.split(addr) {
+                        vma_mgr.add(head).map_err(|_| MapError::AlreadyMapped)?;
+                        rest = tail;
+                    }
+                    if let Some((_, tail)) = rest.split(PageVirtAddr::new(end_addr)) {
+                        vma_mgr.add(tail).map_err(|_| MapError::AlreadyMapped)?;
+                    }
                 }
             }
         }
@@ -887,60 +1420,842 @@ impl AddressSpace {
         Ok(())
     }
 
-    /// 取消映射指定范围的物理页
+    /// 取消映射指定范围的物理页，解除页表项持有的页引用
     fn unmap_pages(&self, start: PageVirtAddr, size: usize) -> Result<(), MapError> {
-        let mut addr = start.as_usize();
-        let end = addr + size;
+        self.zap_pages(start.as_usize(), start.as_usize() + size, true);
+        Ok(())
+    }
 
-        while addr < end {
-            // 查找页表项
-            let ppn = unsafe { PageTableWalker::walk(self.root_ppn, addr as u64) };
+    /// 解除全部用户映射并归还映射的页 (exit_mmap)
+    ///
+    /// 最后一个使用者退出或 execve 换用新地址空间时调用。页表页和根页表保留，
+    /// 当前 CPU 可能仍在使用该页表运行内核代码
+    pub fn exit_mmap(&self) {
+        crate::mm::ksm::ksm_exit(&self.mm_handle());
+        let ranges: Vec<(usize, usize)> = {
+            let mut vma_mgr = self.vma_write();
+            let ranges = vma_mgr.iter().map(|vma| (vma.start().as_usize(), vma.end().as_usize())).collect();
+            vma_mgr.clear();
+            ranges
+        };
+        for (start, end) in ranges {
+            self.zap_pages(start, end, true);
+        }
+    }
 
-            if let Some(ppn) = ppn {
-                // 释放物理页（如果引用计数为 1）
-                // TODO: 实现正确的页引用计数
-                let _ = ppn; // 暂时忽略
+    /// 减少用户计数，最后一个使用者释放用户映射 (mmput)
+    pub fn mmput(&self) {
+        if self.mm_users_dec() == 0 {
+            self.exit_mmap();
+        }
+    }
 
-                // 清除页表项
-                unsafe {
-                    self.clear_pte(addr as u64);
-                }
-            }
+    /// 清除 [start, end) 的页表项并刷新 TLB (zap_page_range)
+    ///
+    /// release 为真时在刷新 TLB 之后解除页表项持有的 4KB 页引用，最后一个引用解除时
+    /// 释放页 (tlb_finish_mmu)
+    fn zap_pages(&self, start: usize, end: usize, release: bool) {
+        let mut freed = if release { Some(Vec::new()) } else { None };
+        let mut addr = start;
 
-            addr += PAGE_SIZE_USIZE;
+        let ptl = self.page_table_lock.lock();
+        while addr < end {
+            // 每次处理一个 L0 页表（或大页）覆盖的范围
+            addr += unsafe { self.zap_range(addr as u64, end as u64, freed.as_mut()) };
         }
+        drop(ptl);
 
-        // 刷新 TLB
-        unsafe {
-            core::arch::asm!("sfence.vma zero, zero");
-        }
+        // 所有页表项清除后统一刷新 TLB（只刷新此 ASID 的该范围，包括其他 CPU）
+        self.flush_tlb_range(start, end);
 
-        Ok(())
+        // 其他 CPU 不再能通过旧的 TLB 项访问这些页之后才释放
+        for pte in freed.into_iter().flatten() {
+            unsafe { put_user_pte(pte) };
+        }
     }
 
-    /// 清除指定虚拟地址的页表项
-    unsafe fn clear_pte(&self, virt: u64) {
+    /// 清除 [virt, end) 中位于同一个 L0 页表内的页表项 (zap_pte_range)
+    ///
+    /// 只从根页表下降一次；缺失的 L2/L1 项直接跳到下一个 1GB/2MB 边界。
+    /// 2MB 大页整块落在 [virt, end) 内时直接清除 L1 叶子项，否则先拆分 (zap_huge_pmd)。
+    /// 不刷新 TLB，由调用者在整个范围清除后统一刷新；freed 不为 None 时收集被清除的
+    /// 4KB 页表项，由调用者刷新 TLB 后释放
+    ///
+    /// # 返回
+    /// 处理的字节数
+    unsafe fn zap_range(&self, virt: u64, end: u64, mut freed: Option<&mut Vec<PageTableEntry>>) -> usize {
         let vpn2 = ((virt >> 30) & 0x1FF) as usize;
         let vpn1 = ((virt >> 21) & 0x1FF) as usize;
-        let vpn0 = ((virt >> 12) & 0x1FF) as usize;
+        let next_1g = ((virt >> 30) + 1) << 30;
+        let next_2m = ((virt >> 21) + 1) << 21;
 
         let root_table = (self.root_ppn << PAGE_SHIFT) as *mut PageTable;
 
         let pte2 = (*root_table).get(vpn2);
-        if !pte2.is_valid() {
-            return;
+        if !pte2.is_valid() || pte2.is_leaf() {
+            return (next_1g.min(end) - virt) as usize;
         }
 
         let table1 = (pte2.ppn() << PAGE_SHIFT) as *mut PageTable;
         let pte1 = (*table1).get(vpn1);
         if !pte1.is_valid() {
-            return;
+            return (next_2m.min(end) - virt) as usize;
         }
 
-        let table0 = (pte1.ppn() << PAGE_SHIFT) as *mut PageTable;
+        if pte1.is_leaf() {
+            if virt % HPAGE_SIZE as u64 == 0 && virt + HPAGE_SIZE as u64 <= end {
+                (*table1).set(vpn1, PageTableEntry::new());
+                if pte1.is_user() && pte1.bits() & shared_flags::SPECIAL == 0 {
+                    put_huge_page(pte1.ppn());
+                }
+                return HPAGE_SIZE;
+            }
+            split_megapage(table1, vpn1);
+        }
 
-        // 清除页表项
-        (*table0).set(vpn0, PageTableEntry::from_bits(0));
+        let stop = next_2m.min(end);
+        let first = ((virt >> 12) & 0x1FF) as usize;
+        let last = first + ((stop - virt) >> 12) as usize;
+
+        // 范围内没有映射时不触发共享 L0 页表的复制
+        let table0 = ((*table1).get(vpn1).ppn() << PAGE_SHIFT) as *const PageTable;
+        if (first..last).all(|vpn0| (*table0).get(vpn0).is_none()) {
+            return (stop - virt) as usize;
+        }
+        // 写入前确保 L0 页表不再与其他地址空间共享
+        let table0 = own_pte_table(table1, vpn1);
+
+        // 清除页表项；可写的共享文件页把脏状态转移到页缓存 (zap_pte_range: set_page_dirty)，
+        // 换出页的页表项释放交换槽 (free_swap_and_cache)
+        for vpn0 in first..last {
+            let pte0 = (*table0).get(vpn0);
+            (*table0).set(vpn0, PageTableEntry::from_bits(0));
+            if pte0.is_swap() {
+                crate::mm::zswap::swap_free(pte0.swap_offset());
+                continue;
+            }
+            if pte0.is_valid() && pte0.is_user() && pte0.is_writable() {
+                crate::mm::filemap::set_mapped_page_dirty(pte0.ppn() as usize);
+            }
+            if let Some(freed) = freed.as_mut() {
+                if pte0.is_valid() {
+                    freed.push(pte0);
+                }
+            }
+        }
+        (stop - virt) as usize
+    }
+
+    // ==================== mremap ====================
+
+    /// mremap 系统调用实现 (do_mremap)
+    ///
+    /// - 收缩：解除尾部的映射
+    /// - 扩展：VMA 之后的地址空闲时原地扩展，之后访问的页按需分配
+    /// - 移动（MREMAP_MAYMOVE / MREMAP_FIXED）：把页表项搬到新地址 (move_vma)，
+    ///   物理页既不复制也不重新分配；MREMAP_FIXED 先解除目标范围原有的映射
+    ///
+    /// 旧范围必须位于同一个 VMA 内；设备映射不能扩展
+    ///
+    /// # 返回
+    /// - 成功返回新的起始地址（可能与旧地址相同）
+    /// - MapError::NotMapped: 旧范围未映射或跨越多个 VMA，或扩展设备映射 (EFAULT)
+    /// - MapError::OutOfMemory: 不能原地扩展且不允许移动，或没有足够的地址空间 (ENOMEM)
+    /// - MapError::Invalid: 参数不合法 (EINVAL)
+    pub fn mremap(
+        &self,
+        old_addr: PageVirtAddr,
+        old_size: usize,
+        new_size: usize,
+        flags: u32,
+        new_addr: PageVirtAddr,
+    ) -> Result<PageVirtAddr, MapError> {
+        use mremap::{MREMAP_FIXED, MREMAP_MAYMOVE};
+
+        if flags & !(MREMAP_MAYMOVE | MREMAP_FIXED) != 0 {
+            return Err(MapError::Invalid);
+        }
+        let fixed = flags & MREMAP_FIXED != 0;
+        if fixed && flags & MREMAP_MAYMOVE == 0 {
+            return Err(MapError::Invalid);
+        }
+
+        let vma = self.find_vma(old_addr).ok_or(MapError::NotMapped)?;
+        // MAP_HUGETLB 映射按大页对齐，页表项以 2MB 大页为单位搬移
+        let granule = if vma.flags().contains(VmaFlags::HUGETLB) { HPAGE_SIZE } else { PAGE_SIZE_USIZE };
+        let old_start = old_addr.as_usize();
+        let old_size = (old_size + granule - 1) & !(granule - 1);
+        let new_size = (new_size + granule - 1) & !(granule - 1);
+        // old_size 为 0 的共享映射复制不支持
+        if old_start % granule != 0 || old_size == 0 || new_size == 0 {
+            return Err(MapError::Invalid);
+        }
+        let old_end = old_start + old_size;
+        if old_end > vma.end().as_usize() {
+            return Err(MapError::NotMapped);
+        }
+        if new_size > old_size && vma.flags().contains(VmaFlags::IO) {
+            return Err(MapError::NotMapped);
+        }
+
+        if fixed {
+            let dst = new_addr.as_usize();
+            if dst % granule != 0
+                || dst < user_addr::USER_START
+                || dst + new_size > user_addr::USER_END
+                || (dst < old_end && old_start < dst + new_size)
+            {
+                return Err(MapError::Invalid);
+            }
+            self.munmap_range(dst, dst + new_size)?;
+            if new_size < old_size {
+                self.munmap(PageVirtAddr::new(old_start + new_size), old_size - new_size)?;
+            }
+            return self.move_vma(&vma, old_start, old_size.min(new_size), dst, new_size);
+        }
+
+        if new_size <= old_size {
+            if new_size < old_size {
+                self.munmap(PageVirtAddr::new(old_start + new_size), old_size - new_size)?;
+            }
+            return Ok(old_addr);
+        }
+
+        // 旧范围在 VMA 末尾且其后空闲时原地扩展 (vma_expandable)
+        if old_end == vma.end().as_usize() && old_start + new_size <= user_addr::USER_END {
+            let mut vma_mgr = self.vma_write();
+            let new_end = old_start + new_size;
+            let free = !vma_mgr
+                .iter()
+                .any(|v| v.start().as_usize() < new_end && old_end < v.end().as_usize());
+            if free {
+                let grown = vma.remap(vma.start(), vma.start(), new_end - vma.start().as_usize());
+                vma_mgr.remove(vma.start())?;
+                vma_mgr.add(grown).map_err(|_| MapError::AlreadyMapped)?;
+                return Ok(old_addr);
+            }
+        }
+
+        if flags & MREMAP_MAYMOVE == 0 {
+            return Err(MapError::OutOfMemory);
+        }
+        // 新地址与旧地址在 2MB 内的偏移相同，整块的 L0 页表和大页只需搬移 L1 项
+        let dst = if new_size >= HPAGE_SIZE {
+            let off = old_start % HPAGE_SIZE;
+            self.find_free_area(new_size + off, HPAGE_SIZE)?.as_usize() + off
+        } else {
+            self.find_free_area(new_size, PAGE_SIZE_USIZE)?.as_usize()
+        };
+        self.move_vma(&vma, old_start, old_size, dst, new_size)
+    }
+
+    /// 解除 [start, end) 内所有 VMA 的映射（可能跨越多个 VMA）
+    fn munmap_range(&self, start: usize, end: usize) -> Result<(), MapError> {
+        loop {
+            let hit = self
+                .vma_read()
+                .iter()
+                .find(|v| v.start().as_usize() < end && start < v.end().as_usize())
+                .map(|v| (v.start().as_usize().max(start), v.end().as_usize().min(end)));
+            match hit {
+                Some((from, to)) => self.munmap(PageVirtAddr::new(from), to - from)?,
+                None => return Ok(()),
+            }
+        }
+    }
+
+    /// 把 vma 中的 [old_start, old_start + old_size) 移动到 new_start，
+    /// 新 VMA 长度为 new_size (move_vma)
+    ///
+    /// 旧范围两侧的部分保留为独立的 VMA；页表项整体搬移后刷新旧范围的 TLB
+    fn move_vma(
+        &self,
+        vma: &Vma,
+        old_start: usize,
+        old_size: usize,
+        new_start: usize,
+        new_size: usize,
+    ) -> Result<PageVirtAddr, MapError> {
+        let old_end = old_start + old_size;
+        let mut vma_mgr = self.vma_write();
+        // 查找目标地址之后 VMA 可能已经变化
+        if vma_mgr.get(vma.start()).map(|v| v.end()) != Some(vma.end())
+            || vma_mgr
+                .iter()
+                .any(|v| v.start().as_usize() < new_start + new_size && new_start < v.end().as_usize())
+        {
+            return Err(MapError::AlreadyMapped);
+        }
+
+        let moved = vma.remap(PageVirtAddr::new(old_start), PageVirtAddr::new(new_start), new_size);
+        vma_mgr.remove(vma.start())?;
+        let mut rest = *vma;
+        if let Some((head, tail)) = vma.split(PageVirtAddr::new(old_start)) {
+            vma_mgr.add(head).map_err(|_| MapError::AlreadyMapped)?;
+            rest = tail;
+        }
+        if let Some((_, tail)) = rest.split(PageVirtAddr::new(old_end)) {
+            vma_mgr.add(tail).map_err(|_| MapError::AlreadyMapped)?;
+        }
+        vma_mgr.add(moved).map_err(|_| MapError::AlreadyMapped)?;
+
+        // 持有 VMA 写锁，缺页不会在搬移过程中重新填充旧范围
+        let ptl = self.page_table_lock.lock();
+        let mut done = 0;
+        while done < old_size {
+            done += unsafe { self.move_range(old_start + done, new_start + done, old_size - done) };
+        }
+        drop(ptl);
+        drop(vma_mgr);
+
+        // 新地址原本没有映射，只需让旧地址的 TLB 项失效
+        self.flush_tlb_range(old_start, old_end);
+        Ok(PageVirtAddr::new(new_start))
+    }
+
+    /// 把 src 开始、位于同一个 L0 页表内的页表项搬到 dst (move_page_tables)
+    ///
+    /// 源和目标都 2MB 对齐、len 覆盖整个 2MB 且目标 L1 项为空时直接搬移 L1 项
+    /// （整个 L0 页表或 2MB 大页，move_normal_pmd / move_huge_pmd），
+    /// 否则拆分大页、确保 L0 页表私有后逐项搬移 (move_ptes)。
+    /// 调用者持有页表锁，目标范围没有映射，不刷新 TLB
+    ///
+    /// # 返回
+    /// 处理的字节数
+    unsafe fn move_range(&self, src: usize, dst: usize, len: usize) -> usize {
+        let next_1g = ((src >> 30) + 1) << 30;
+        let next_2m = ((src >> 21) + 1) << 21;
+
+        let (table1, vpn1) = match l1_entry(self.root_ppn, src, false) {
+            Some(entry) => entry,
+            None => return (next_1g - src).min(len),
+        };
+        let pte1 = (*table1).get(vpn1);
+        if !pte1.is_valid() {
+            return (next_2m - src).min(len);
+        }
+
+        if src % HPAGE_SIZE == 0 && dst % HPAGE_SIZE == 0 && len >= HPAGE_SIZE {
+            if let Some((dst_table1, dst_vpn1)) = l1_entry(self.root_ppn, dst, true) {
+                if !(*dst_table1).get(dst_vpn1).is_valid() {
+                    (*table1).set(vpn1, PageTableEntry::new());
+                    (*dst_table1).set(dst_vpn1, pte1);
+                    if !pte1.is_leaf() {
+                        let table0 = (pte1.ppn() << PAGE_SHIFT) as *const PageTable;
+                        for vpn0 in 0..512 {
+                            self.move_lazyfree_index((*table0).get(vpn0), dst + vpn0 * PAGE_SIZE_USIZE);
+                        }
+                    }
+                    return HPAGE_SIZE;
+                }
+            }
+        }
+
+        let stop = (next_2m - src).min(len);
+        let first = (src >> 12) & 0x1FF;
+        let table0 = if pte1.is_leaf() {
+            split_megapage(table1, vpn1)
+        } else {
+            // 范围内没有映射时不触发共享 L0 页表的复制
+            let table0 = (pte1.ppn() << PAGE_SHIFT) as *const PageTable;
+            if (first..first + stop / PAGE_SIZE_USIZE).all(|vpn0| (*table0).get(vpn0).is_none()) {
+                return stop;
+            }
+            own_pte_table(table1, vpn1)
+        };
+
+        // 换出页的页表项连同交换槽的引用一起搬移
+        for i in 0..stop / PAGE_SIZE_USIZE {
+            let pte0 = (*table0).get(first + i);
+            if pte0.is_none() {
+                continue;
+            }
+            let to = dst + i * PAGE_SIZE_USIZE;
+            (*table0).set(first + i, PageTableEntry::new());
+            let dst_table0 = pte_table_alloc(self.root_ppn, to as u64);
+            (*dst_table0).set((to >> 12) & 0x1FF, pte0);
+            self.move_lazyfree_index(pte0, to);
+        }
+        stop
+    }
+
+    /// 本地址空间标记的惰性释放页移动后更新页描述符记录的虚拟地址
+    unsafe fn move_lazyfree_index(&self, pte: PageTableEntry, vaddr: usize) {
+        use crate::mm::page_desc::{pfn_to_page, PageType};
+
+        if !pte.is_valid() || !pte.is_user() || is_zero_page_ppn(pte.ppn()) {
+            return;
+        }
+        let page = pfn_to_page(pte.ppn() as usize);
+        if !page.is_null()
+            && (*page).page_type() == PageType::Anonymous
+            && (*page).private() == Arc::as_ptr(&self.page_table_lock) as usize
+        {
+            (*page).set_index(vaddr / PAGE_SIZE_USIZE);
+        }
+    }
+
+    // ==================== msync ====================
+
+    /// msync 系统调用实现 (msync)
+    ///
+    /// 能回写的共享文件映射：把可写的页表项改为只读并在页缓存中标记为脏，之后再写入时
+    /// 由 do_shared_wp_page 重新标记，页回写期间的修改不会丢失 (folio_clear_dirty_for_io)。
+    /// sync 为真 (MS_SYNC) 时回写页缓存并报告回写错误，否则 (MS_ASYNC) 交给回写线程。
+    /// 页缓存在各映射间一致，MS_INVALIDATE 不需要额外处理
+    ///
+    /// # 返回
+    /// - ENOMEM: 范围内有未映射的空洞
+    /// - 回写的错误码（如 EIO）
+    pub fn msync(&self, addr: PageVirtAddr, size: usize, sync: bool) -> Result<(), i32> {
+        let start = addr.as_usize();
+        let end = start
+            .checked_add(size)
+            .and_then(|end| end.checked_add(PAGE_SIZE_USIZE - 1))
+            .ok_or(crate::errno::Errno::OutOfMemory.as_neg_i32())?
+            & !(PAGE_SIZE_USIZE - 1);
+        let vmas = vmas_covering(&self.vma_read(), start, end).map_err(|_| crate::errno::Errno::OutOfMemory.as_neg_i32())?;
+
+        let mut mappings: Vec<Arc<crate::mm::filemap::FileMapping>> = Vec::new();
+        for vma in vmas.iter() {
+            if vma.vma_type() != VmaType::FileBacked || !vma.flags().is_shared() {
+                continue;
+            }
+            let mapping = match vma.mapping().and_then(crate::mm::filemap::find_mapping) {
+                Some(mapping) if mapping.can_writeback() => mapping,
+                _ => continue,
+            };
+            let from = start.max(vma.start().as_usize());
+            let to = end.min(vma.end().as_usize());
+            if unsafe { self.wrprotect_shared_range(from, to) } {
+                self.flush_tlb_range(from, to);
+            }
+            if !mappings.iter().any(|m| Arc::ptr_eq(m, &mapping)) {
+                mappings.push(mapping);
+            }
+        }
+
+        if sync {
+            for mapping in mappings {
+                mapping.writeback()?;
+                match mapping.take_wb_error() {
+                    0 => {}
+                    e => return Err(e),
+                }
+            }
+        }
+        Ok(())
+    }
+
+    /// 把 [start, end) 中可写的页表项改为只读，并把页转为页缓存中的脏页 (page_mkclean)
+    ///
+    /// 不刷新 TLB，由调用者刷新
+    ///
+    /// # 返回
+    /// 是否修改了页表项
+    unsafe fn wrprotect_shared_range(&self, start: usize, end: usize) -> bool {
+        let _ptl = self.page_table_lock.lock();
+        let mut changed = false;
+        let mut addr = start;
+        while addr < end {
+            let next_2m = ((addr >> 21) + 1) << 21;
+            let stop = next_2m.min(end);
+            let (table1, vpn1) = match l1_entry(self.root_ppn, addr, false) {
+                Some(entry) => entry,
+                None => {
+                    addr = stop;
+                    continue;
+                }
+            };
+            let pte1 = (*table1).get(vpn1);
+            let table0 = (pte1.ppn() << PAGE_SHIFT) as *const PageTable;
+            let first = (addr >> 12) & 0x1FF;
+            let last = first + ((stop - addr) >> 12);
+            if !pte1.is_valid() || pte1.is_leaf() || !(first..last).any(|vpn0| (*table0).get(vpn0).is_writable()) {
+                addr = stop;
+                continue;
+            }
+            let table0 = own_pte_table(table1, vpn1);
+            for vpn0 in first..last {
+                let pte0 = (*table0).get(vpn0);
+                if !pte0.is_valid() || !pte0.is_writable() {
+                    continue;
+                }
+                crate::mm::filemap::set_mapped_page_dirty(pte0.ppn() as usize);
+                let bits = pte0.bits() & !(PageTableEntry::W | PageTableEntry::D);
+                (*table0).set(vpn0, PageTableEntry::from_bits(bits));
+                changed = true;
+            }
+            addr = stop;
+        }
+        changed
+    }
+
+    // ==================== madvise / mincore ====================
+
+    /// madvise 系统调用实现 (do_madvise)
+    ///
+    /// - MADV_NORMAL / MADV_RANDOM / MADV_SEQUENTIAL: 设置 VMA 的预读标志，
+    ///   范围只覆盖 VMA 一部分时分割 VMA
+    /// - MADV_WILLNEED: 把文件映射的页预读进页缓存
+    /// - MADV_DONTNEED: 清除页表项并释放页，之后访问得到零页（匿名）或页缓存中的页（文件）
+    /// - MADV_FREE: 私有匿名页标记为惰性释放，内存紧张时由页回收释放
+    /// - MADV_MERGEABLE / MADV_UNMERGEABLE: 设置或清除 VMA 的可合并标志并登记到后台合并扫描
+    ///   (mm::ksm)；已经合并的页保持只读共享，写入时照常复制
+    /// - MADV_HUGEPAGE / MADV_NOHUGEPAGE: 设置 VMA 的透明大页标志 (ThpMode)；
+    ///   已经映射的大页不拆分
+    /// - 其他建议只检查范围
+    ///
+    /// # 返回
+    /// - MapError::NotMapped: 范围内有未映射的空洞 (ENOMEM)
+    /// - MapError::Invalid: 未知建议，或对锁定/设备/非匿名映射做不允许的操作 (EINVAL)
+    pub fn madvise(&self, addr: PageVirtAddr, size: usize, advice: i32) -> Result<(), MapError> {
+        let start = addr.as_usize();
+        if start % PAGE_SIZE_USIZE != 0 {
+            return Err(MapError::Invalid);
+        }
+        let end = start
+            .checked_add(size)
+            .and_then(|end| end.checked_add(PAGE_SIZE_USIZE - 1))
+            .ok_or(MapError::Invalid)?
+            & !(PAGE_SIZE_USIZE - 1);
+        if end == start {
+            return Ok(());
+        }
+
+        match advice {
+            madv::MADV_NORMAL => self.update_vma_flags(start, end, 0, VmaFlags::SEQ_READ | VmaFlags::RAND_READ),
+            madv::MADV_RANDOM => self.update_vma_flags(start, end, VmaFlags::RAND_READ, VmaFlags::SEQ_READ),
+            madv::MADV_SEQUENTIAL => self.update_vma_flags(start, end, VmaFlags::SEQ_READ, VmaFlags::RAND_READ),
+            madv::MADV_WILLNEED => self.madvise_willneed(start, end),
+            madv::MADV_DONTNEED => {
+                let vmas = vmas_covering(&self.vma_read(), start, end)?;
+                if vmas.iter().any(|vma| vma.flags().contains(VmaFlags::LOCKED) || vma.vma_type() == VmaType::Device) {
+                    return Err(MapError::Invalid);
+                }
+                self.zap_pages(start, end, true);
+                Ok(())
+            }
+            madv::MADV_FREE => self.madvise_free(start, end),
+            madv::MADV_MERGEABLE | madv::MADV_UNMERGEABLE => {
+                let merge = advice == madv::MADV_MERGEABLE;
+                let (set, clear) = if merge { (VmaFlags::MERGEABLE, 0) } else { (0, VmaFlags::MERGEABLE) };
+                self.update_vma_flags(start, end, set, clear)?;
+                crate::mm::ksm::ksm_madvise(&self.mm_handle(), start, end, merge);
+                Ok(())
+            }
+            madv::MADV_HUGEPAGE => self.update_vma_flags(start, end, VmaFlags::HUGEPAGE, VmaFlags::NOHUGEPAGE),
+            madv::MADV_NOHUGEPAGE => self.update_vma_flags(start, end, VmaFlags::NOHUGEPAGE, VmaFlags::HUGEPAGE),
+            madv::MADV_REMOVE | madv::MADV_DONTFORK | madv::MADV_DOFORK
+            | madv::MADV_DONTDUMP | madv::MADV_DODUMP => {
+                vmas_covering(&self.vma_read(), start, end).map(|_| ())
+            }
+            _ => Err(MapError::Invalid),
+        }
+    }
+
+    /// 修改 [start, end) 内 VMA 的标志，范围边界落在 VMA 中间时先分割 (madvise_update_vma)
+    fn update_vma_flags(&self, start: usize, end: usize, set: u32, clear: u32) -> Result<(), MapError> {
+        let mut vma_mgr = self.vma_write();
+        for vma in vmas_covering(&vma_mgr, start, end)? {
+            let mut flags = vma.flags();
+            flags.insert(set);
+            flags.remove(clear);
+            if flags == vma.flags() {
+                continue;
+            }
+
+            vma_mgr.remove(vma.start()).map_err(|_| MapError::NotMapped)?;
+            let mut mid = vma;
+            if let Some((head, tail)) = mid.split(PageVirtAddr::new(start)) {
+                vma_mgr.add(head).map_err(|_| MapError::AlreadyMapped)?;
+                mid = tail;
+            }
+            if let Some((body, tail)) = mid.split(PageVirtAddr::new(end)) {
+                vma_mgr.add(tail).map_err(|_| MapError::AlreadyMapped)?;
+                mid = body;
+            }
+            mid.set_flags(flags);
+            vma_mgr.add(mid).map_err(|_| MapError::AlreadyMapped)?;
+        }
+        Ok(())
+    }
+
+    /// MADV_WILLNEED：把文件映射范围内的页预读进页缓存 (madvise_willneed)
+    ///
+    /// 只读入页缓存不建立映射，之后的缺页由 fault-around 直接映射缓存页；
+    /// 匿名映射没有后备存储，不做处理
+    fn madvise_willneed(&self, start: usize, end: usize) -> Result<(), MapError> {
+        let vmas = vmas_covering(&self.vma_read(), start, end)?;
+        for vma in vmas {
+            if vma.vma_type() != VmaType::FileBacked {
+                continue;
+            }
+            let mapping = match vma.mapping().and_then(crate::mm::filemap::find_mapping) {
+                Some(mapping) => mapping,
+                None => continue,
+            };
+            let from = start.max(vma.start().as_usize());
+            let to = end.min(vma.end().as_usize());
+            let index = (vma.offset() + (from - vma.start().as_usize())) / PAGE_SIZE_USIZE;
+            mapping.readahead(index, (to - from) / PAGE_SIZE_USIZE);
+        }
+        Ok(())
+    }
+
+    /// MADV_FREE：把私有匿名页标记为惰性释放 (madvise_free_pte_range)
+    ///
+    /// 只被本地址空间映射的页改为只读 + COW 并加入 inactive 链表，页描述符记录
+    /// 页表锁和虚拟地址；内存紧张时页回收解除映射并释放，之后读到零页。
+    /// 标记后再次写入时 handle_cow_fault 恢复写权限并取消标记，页不再被回收。
+    /// 大页、fork 共享的 L0 页表和多个引用的页保持不变
+    fn madvise_free(&self, start: usize, end: usize) -> Result<(), MapError> {
+        let vmas = vmas_covering(&self.vma_read(), start, end)?;
+        if vmas.iter().any(|vma| {
+            vma.vma_type() != VmaType::Anonymous
+                || vma.flags().is_shared()
+                || vma.flags().contains(VmaFlags::LOCKED)
+        }) {
+            return Err(MapError::Invalid);
+        }
+
+        let mut changed = false;
+        let ptl = self.page_table_lock.lock();
+        // 只读 VMA 中的页写入时不会经过 COW，不能标记
+        for vma in vmas.iter().filter(|vma| vma.flags().is_writable()) {
+            let mut addr = start.max(vma.start().as_usize());
+            let stop = end.min(vma.end().as_usize());
+            while addr < stop {
+                let (len, marked) = unsafe { self.lazyfree_range(addr, stop) };
+                addr += len;
+                changed |= marked;
+            }
+        }
+        drop(ptl);
+
+        // 去掉了写权限，其他 CPU 上可写的 TLB 项必须失效
+        if changed {
+            self.flush_tlb_range(start, end);
+        }
+        Ok(())
+    }
+
+    /// 标记 [virt, end) 中位于同一个 L0 页表内的页为惰性释放
+    ///
+    /// 调用者持有页表锁
+    ///
+    /// # 返回
+    /// (处理的字节数, 是否修改了页表项)
+    unsafe fn lazyfree_range(&self, virt: usize, end: usize) -> (usize, bool) {
+        use crate::mm::page_desc::{pfn_to_page, PageType};
+
+        let base = virt & !(HPAGE_SIZE - 1);
+        let stop = (base + HPAGE_SIZE).min(end);
+        let len = stop - virt;
+
+        let (table1, vpn1) = match l1_entry(self.root_ppn, virt, false) {
+            Some(entry) => entry,
+            None => return (len, false),
+        };
+        let pte1 = (*table1).get(vpn1);
+        if !pte1.is_valid() || pte1.is_leaf() || pte1.bits() & shared_flags::SHARED != 0 {
+            return (len, false);
+        }
+        let table0 = (pte1.ppn() << PAGE_SHIFT) as *mut PageTable;
+
+        let first = (virt >> 12) & 0x1FF;
+        let mut changed = false;
+        for vpn0 in first..first + len / PAGE_SIZE_USIZE {
+            let pte0 = (*table0).get(vpn0);
+            if !pte0.is_valid() || !pte0.is_user() || pte0.bits() & shared_flags::SPECIAL != 0
+                || is_zero_page_ppn(pte0.ppn())
+            {
+                continue;
+            }
+            let pfn = pte0.ppn() as usize;
+            let page = pfn_to_page(pfn);
+            if page.is_null() || (*page).is_reserved() || (*page).refcount() != 1 {
+                continue;
+            }
+
+            set_lazyfree_owner(page, &self.page_table_lock);
+            (*page).set_page_type(PageType::Anonymous);
+            (*page).set_index((base + vpn0 * PAGE_SIZE_USIZE) / PAGE_SIZE_USIZE);
+            // 惰性释放的页回收时直接丢弃，不再换出
+            (*page).clear_flag(crate::mm::page_desc::PageFlag::SwapBacked);
+            crate::mm::vmscan::lru_cache_add(pfn);
+
+            if pte0.is_writable() || pte0.bits() & PageTableEntry::D != 0 {
+                (*table0).set(vpn0, PageTableEntry::from_bits(
+                    pte0.bits() & !(PageTableEntry::W | PageTableEntry::D) | cow_flags::COW
+                ));
+                changed = true;
+            }
+        }
+        (len, changed)
+    }
+
+    /// mincore 系统调用实现 (do_mincore)
+    ///
+    /// 按 L0 页表遍历页表，有页表项（包括零页和大页）的页算作驻留；
+    /// 文件映射中没有页表项、但在页缓存中的页同样算作驻留
+    ///
+    /// # 返回
+    /// 每页一个字节，最低位表示是否驻留；范围内有未映射的空洞时返回 MapError::NotMapped
+    pub fn mincore(&self, addr: PageVirtAddr, size: usize) -> Result<Vec<u8>, MapError> {
+        let start = addr.as_usize();
+        if start % PAGE_SIZE_USIZE != 0 {
+            return Err(MapError::Invalid);
+        }
+        let end = start
+            .checked_add(size)
+            .and_then(|end| end.checked_add(PAGE_SIZE_USIZE - 1))
+            .ok_or(MapError::NotMapped)?
+            & !(PAGE_SIZE_USIZE - 1);
+        let vmas = vmas_covering(&self.vma_read(), start, end)?;
+
+        let mut vec = alloc::vec![0u8; (end - start) / PAGE_SIZE_USIZE];
+        let ptl = self.page_table_lock.lock();
+        let mut addr = start;
+        while addr < end {
+            addr += unsafe { self.mincore_range(addr, end, &mut vec[(addr - start) / PAGE_SIZE_USIZE..]) };
+        }
+        drop(ptl);
+
+        // 没有映射的文件页查询页缓存 (mincore_page)
+        for vma in &vmas {
+            if vma.vma_type() != VmaType::FileBacked {
+                continue;
+            }
+            let mapping = match vma.mapping().and_then(crate::mm::filemap::find_mapping) {
+                Some(mapping) => mapping,
+                None => continue,
+            };
+            let from = start.max(vma.start().as_usize());
+            let to = end.min(vma.end().as_usize());
+            for page_addr in (from..to).step_by(PAGE_SIZE_USIZE) {
+                let slot = &mut vec[(page_addr - start) / PAGE_SIZE_USIZE];
+                if *slot == 0 {
+                    let index = (vma.offset() + (page_addr - vma.start().as_usize())) / PAGE_SIZE_USIZE;
+                    *slot = mapping.find_page(index).is_some() as u8;
+                }
+            }
+        }
+        Ok(vec)
+    }
+
+    /// 查询 [virt, end) 中位于同一个 L0 页表（或大页）内的页是否有页表项
+    ///
+    /// # 返回
+    /// 处理的字节数
+    unsafe fn mincore_range(&self, virt: usize, end: usize, out: &mut [u8]) -> usize {
+        let stop = ((virt & !(HPAGE_SIZE - 1)) + HPAGE_SIZE).min(end);
+        let nr = (stop - virt) / PAGE_SIZE_USIZE;
+
+        let root = (self.root_ppn << PAGE_SHIFT) as *const PageTable;
+        let pte2 = (*root).get((virt >> 30) & 0x1FF);
+        let pte1 = if pte2.is_valid() && !pte2.is_leaf() {
+            (*((pte2.ppn() << PAGE_SHIFT) as *const PageTable)).get((virt >> 21) & 0x1FF)
+        } else {
+            pte2
+        };
+
+        // 整个区域没有页表或是大页
+        if !pte1.is_valid() || pte1.is_leaf() {
+            out[..nr].fill(pte1.is_valid() as u8);
+            return nr * PAGE_SIZE_USIZE;
+        }
+
+        let table0 = (pte1.ppn() << PAGE_SHIFT) as *const PageTable;
+        let first = (virt >> 12) & 0x1FF;
+        for (i, slot) in out[..nr].iter_mut().enumerate() {
+            *slot = (*table0).get(first + i).is_valid() as u8;
+        }
+        nr * PAGE_SIZE_USIZE
+    }
+
+    /// 统计 VMA 中有页表项的页 (smap_gather_stats)
+    ///
+    /// 零页和设备内存不计入；文件映射的缓存页减去页缓存自己的引用
+    pub fn smaps(&self, vma: &Vma) -> MemSizeStats {
+        let mut mss = MemSizeStats::default();
+        let file_backed = vma.vma_type() == VmaType::FileBacked;
+        let end = vma.end().as_usize();
+        let _ptl = self.page_table_lock.lock();
+        let mut addr = vma.start().as_usize();
+        while addr < end {
+            addr += unsafe { self.smaps_range(addr, end, file_backed, &mut mss) };
+        }
+        mss
+    }
+
+    /// 统计 [virt, end) 中位于同一个 L0 页表（或大页）内的页
+    ///
+    /// # 返回
+    /// 处理的字节数
+    unsafe fn smaps_range(&self, virt: usize, end: usize, file_backed: bool, mss: &mut MemSizeStats) -> usize {
+        let stop = ((virt & !(HPAGE_SIZE - 1)) + HPAGE_SIZE).min(end);
+
+        let root = (self.root_ppn << PAGE_SHIFT) as *const PageTable;
+        let pte2 = (*root).get((virt >> 30) & 0x1FF);
+        let pte1 = if pte2.is_valid() && !pte2.is_leaf() {
+            (*((pte2.ppn() << PAGE_SHIFT) as *const PageTable)).get((virt >> 21) & 0x1FF)
+        } else {
+            pte2
+        };
+
+        if !pte1.is_valid() {
+            return stop - virt;
+        }
+        if pte1.is_leaf() {
+            if pte1.bits() & shared_flags::SPECIAL == 0 {
+                mss.account(pte1, (stop - virt) as u64, file_backed);
+            }
+            return stop - virt;
+        }
+
+        let table0 = (pte1.ppn() << PAGE_SHIFT) as *const PageTable;
+        let first = (virt >> 12) & 0x1FF;
+        for i in 0..(stop - virt) / PAGE_SIZE_USIZE {
+            let pte = (*table0).get(first + i);
+            if pte.is_valid() {
+                mss.account(pte, PAGE_SIZE_USIZE as u64, file_backed);
+            } else if pte.is_swap() {
+                mss.swap += PAGE_SIZE_USIZE as u64;
+            }
+        }
+        stop - virt
+    }
+
+    /// khugepaged 扫描 (khugepaged_scan_mm_slot)
+    ///
+    /// 从 start 开始，把允许透明大页的匿名 VMA 中填满 4KB 页的 2MB 区域合并为大页；
+    /// 扫描期间持有 VMA 读锁，VMA 不会变化
+    ///
+    /// # 返回
+    /// (检查的区域数, 合并的大页数, 下一次扫描的起始地址)，扫描完最后一个 VMA 时起始地址为 None
+    pub fn collapse_scan(&self, start: usize, nr: usize) -> (usize, usize, Option<usize>) {
+        let vma_mgr = self.vma_read();
+        let mut scanned = 0;
+        let mut collapsed = 0;
+        for vma in vma_mgr.iter() {
+            if vma.end().as_usize() <= start || !thp_vma_allowable(vma) {
+                continue;
+            }
+            let mut haddr = (start.max(vma.start().as_usize()) + HPAGE_SIZE - 1) & !(HPAGE_SIZE - 1);
+            while thp_suitable(vma, haddr) {
+                if scanned == nr {
+                    return (scanned, collapsed, Some(haddr));
+                }
+                scanned += 1;
+                let _ptl = self.page_table_lock.lock();
+                if unsafe { collapse_huge_page(self, haddr, haddr) } {
+                    collapsed += 1;
+                }
+                haddr += HPAGE_SIZE;
+            }
+        }
+        (scanned, collapsed, None)
     }
 
     /// brk 系统调用实现（兼容旧接口）
@@ -959,7 +2274,7 @@ impl AddressSpace {
         let mut flags = VmaFlags::new();
         flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::GROWSDOWN);
         let vma = Vma::new(stack_start, stack_top, flags);
-        self.map_vma(vma, Perm::ReadWrite)?;
+        self.map_vma(vma)?;
         Ok(stack_top)
     }
 
@@ -968,9 +2283,12 @@ impl AddressSpace {
     /// 使用 COW 标记可写页面，避免立即复制所有物理页
     pub fn fork(&self) -> Result<AddressSpace, MapError> {
         // 使用 COW 页表复制
-        let new_root_ppn = unsafe {
-            copy_page_table_cow(self.root_ppn).ok_or(MapError::OutOfMemory)?
+        let new_root_ppn = {
+            let _ptl = self.page_table_lock.lock();
+            unsafe { copy_page_table_cow(self.root_ppn).ok_or(MapError::OutOfMemory)? }
         };
+        // 父进程的可写页已改为只读 + COW，旧的可写 TLB 项必须失效 (flush_tlb_mm)
+        tlb::flush_tlb_mm(&self.context);
 
         let new_space = unsafe { AddressSpace::new_shared(
             new_root_ppn,
@@ -985,40 +2303,56 @@ impl AddressSpace {
             if vma_mgr.iter().count() > 0 {
                 let mut new_vma_mgr = new_space.vma_write();
                 for vma in vma_mgr.iter() {
-                    let new_vma = Vma::new(vma.start(), vma.end(), vma.flags());
-                    let _ = new_vma_mgr.add(new_vma);
+                    // 保留类型、文件偏移和页缓存
+                    let _ = new_vma_mgr.add(*vma);
                 }
             }
+            // 可合并的范围随 VMA 继承，子进程也登记到合并扫描 (ksm_fork)
+            let mergeable: Vec<(usize, usize)> = vma_mgr
+                .iter()
+                .filter(|vma| vma.flags().contains(VmaFlags::MERGEABLE))
+                .map(|vma| (vma.start().as_usize(), vma.end().as_usize()))
+                .collect();
+            if !mergeable.is_empty() {
+                crate::mm::ksm::ksm_fork(&new_space.mm_handle(), &mergeable);
+            }
         }
 
         Ok(new_space)
     }
 }
 
-fn perm_to_flags(perm: Perm, space_type: PageTableType) -> u64 {
-    let mut flags = PageTableEntry::V | PageTableEntry::A | PageTableEntry::D;
-    match perm {
-        Perm::None => {
-            // PROT_NONE: 在 RISC-V 中，V=1 且 R=W=X=0 是非叶 PTE
-            // 为了创建一个不可访问的映射，我们设置为只读但不允许访问
-            // 实际上 Linux 会映射但不允许访问，触发 SIGSEGV
-            // 这里简化处理：设置为只读，实际访问会由页故障处理
-            flags |= PageTableEntry::R;  // 必须设置至少一个权限位才能是有效的叶 PTE
+impl Drop for AddressSpace {
+    fn drop(&mut self) {
+        let snapshot = *self.vma_snapshot.get_mut();
+        if !snapshot.is_null() {
+            // 最后一个引用：缺页路径不会再读取
+            drop(unsafe { Box::from_raw(snapshot) });
         }
-        Perm::Read => {
-            flags |= PageTableEntry::R;
+    }
+}
+
+/// 收集覆盖 [start, end) 的 VMA（按地址顺序）
+///
+/// # 返回
+/// 范围内有不属于任何 VMA 的空洞时返回 MapError::NotMapped
+fn vmas_covering(vma_mgr: &VmaManager, start: usize, end: usize) -> Result<Vec<Vma>, MapError> {
+    let mut vmas = Vec::new();
+    let mut addr = start;
+    for vma in vma_mgr.iter() {
+        if vma.end().as_usize() <= addr {
+            continue;
         }
-        Perm::ReadWrite => {
-            flags |= PageTableEntry::R | PageTableEntry::W;
+        if vma.start().as_usize() > addr {
+            break;
         }
-        Perm::ReadWriteExec => {
-            flags |= PageTableEntry::R | PageTableEntry::W | PageTableEntry::X;
+        addr = vma.end().as_usize();
+        vmas.push(*vma);
+        if addr >= end {
+            return Ok(vmas);
         }
     }
-    if space_type == PageTableType::User {
-        flags |= PageTableEntry::U;
-    }
-    flags
+    Err(MapError::NotMapped)
 }
 
 // ==================== MMU 初始化 ====================
@@ -1048,6 +2382,11 @@ unsafe fn alloc_page_table() -> &'static mut PageTable {
     static mut PAGE_TABLES: [PageTable; MAX_PAGE_TABLES] = [PageTable::new(); MAX_PAGE_TABLES];
     static NEXT_INDEX: AtomicUsize = AtomicUsize::new(0);
 
+    // 优先复用回收的页表页
+    if let Some(addr) = FREE_PAGE_TABLES.lock().pop() {
+        return &mut *(addr as *mut PageTable);
+    }
+
     let idx = NEXT_INDEX.fetch_add(1, Ordering::AcqRel);
     if idx >= PAGE_TABLES.len() {
         panic!("mm: Out of page table pages (allocated {})", idx);
@@ -1057,19 +2396,27 @@ unsafe fn alloc_page_table() -> &'static mut PageTable {
     &mut PAGE_TABLES[idx]
 }
 
-unsafe fn map_page(root_ppn: u64, virt: VirtAddr, phys: PhysAddr, flags: u64) {
-    let virt_addr = virt.bits();
-    let phys_addr = phys.bits();
+/// 回收的页表页（物理地址），alloc_page_table 优先复用
+static FREE_PAGE_TABLES: Mutex<Vec<usize>> = Mutex::new(Vec::new());
 
-    // 提取虚拟页号（VPN2, VPN1, VPN0）
-    let vpn2 = ((virt_addr >> 30) & 0x1FF) as usize;
-    let vpn1 = ((virt_addr >> 21) & 0x1FF) as usize;
-    let vpn0 = ((virt_addr >> 12) & 0x1FF) as usize;
+/// 回收不再被引用的页表页 (pte_free)
+///
+/// 调用者必须确保已经没有页表项指向它，且相关 TLB 已刷新
+unsafe fn free_page_table(table: *mut PageTable) {
+    (*table).zero();
+    FREE_PAGE_TABLES.lock().push(table as usize);
+}
+
+/// 查找 virt 所在的 L0 页表，缺失的 L1/L0 页表按需分配 (pte_alloc)
+///
+/// 地址落在大页内时先拆分为 4KB 页表，fork 共享的 L0 页表先复制为私有页表；
+/// 返回的页表可以直接写入
+unsafe fn pte_table_alloc(root_ppn: u64, virt: u64) -> *mut PageTable {
+    let vpn2 = ((virt >> 30) & 0x1FF) as usize;
+    let vpn1 = ((virt >> 21) & 0x1FF) as usize;
 
     // 获取根页表（L2）
-    let root_table_addr = root_ppn << PAGE_SHIFT;
-    let root_table = root_table_addr as *mut PageTable;
-    let root = &mut *root_table;
+    let root = &mut *((root_ppn << PAGE_SHIFT) as *mut PageTable);
 
     // Level 2 -> Level 1
     let pte2 = root.get(vpn2);
@@ -1083,46 +2430,153 @@ unsafe fn map_page(root_ppn: u64, virt: VirtAddr, phys: PhysAddr, flags: u64) {
     };
 
     // Level 1 -> Level 0
-    let table1_addr = ppn1 << PAGE_SHIFT;
-    let table1 = table1_addr as *mut PageTable;
-    let table1_ref = &mut *table1;
-    let pte1 = table1_ref.get(vpn1);
-    let ppn0 = if pte1.is_valid() {
-        pte1.ppn()
+    let table1 = (ppn1 << PAGE_SHIFT) as *mut PageTable;
+    let pte1 = (*table1).get(vpn1);
+    if pte1.is_valid() && pte1.is_leaf() {
+        // 地址落在大页内：先拆分为 4KB 页表
+        split_megapage(table1, vpn1)
+    } else if pte1.is_valid() {
+        // fork 共享的 L0 页表先复制为私有页表
+        own_pte_table(table1, vpn1)
     } else {
         let table = alloc_page_table();
         let ppn = (table as *const PageTable as u64) >> PAGE_SHIFT;
-        table1_ref.set(vpn1, PageTableEntry::new_table(ppn));
-        ppn
-    };
+        (*table1).set(vpn1, PageTableEntry::new_table(ppn));
+        table as *mut PageTable
+    }
+}
+
+unsafe fn map_page(root_ppn: u64, virt: VirtAddr, phys: PhysAddr, flags: u64) {
+    let virt_addr = virt.bits();
+    let table0 = pte_table_alloc(root_ppn, virt_addr);
 
     // Level 0 -> 物理页
-    let table0_addr = ppn0 << PAGE_SHIFT;
-    let table0 = table0_addr as *mut PageTable;
-    let table0_ref = &mut *table0;
-    let ppn: u64 = phys_addr >> PAGE_SHIFT;
-    let pte_bits: u64 = (ppn << 10) | flags;
+    let vpn0 = ((virt_addr >> 12) & 0x1FF) as usize;
+    let ppn: u64 = phys.bits() >> PAGE_SHIFT;
+    (*table0).set(vpn0, PageTableEntry::from_bits((ppn << 10) | flags));
+
+    // 只刷新本地该地址的 TLB 项 (update_mmu_cache)
+    // 原 PTE 无效，其他 CPU 不可能缓存它；改写有效 PTE 的调用者负责远程刷新
+    tlb::local_flush_tlb_page(virt_addr as usize);
+}
+
+/// 批量建立 [virt, virt + size) 到 [phys, phys + size) 的 4KB 映射 (remap_pte_range)
+///
+/// 每个 L0 页表只从根页表下降一次，连续填写其中的页表项，
+/// 最后统一刷新本地 TLB。与 map_page 相同，原有的有效映射由调用者负责远程刷新
+unsafe fn map_pte_range(root_ppn: u64, virt: u64, phys: u64, size: u64, flags: u64) {
+    let start = virt & !(PAGE_SIZE - 1);
+    let end = (virt + size + PAGE_SIZE - 1) & !(PAGE_SIZE - 1);
+    let mut virt = start;
+    let mut ppn = phys >> PAGE_SHIFT;
+
+    while virt < end {
+        let table0 = pte_table_alloc(root_ppn, virt);
+        // 本 L0 页表覆盖到下一个 2MB 边界
+        let stop = (((virt >> 21) + 1) << 21).min(end);
+        let mut vpn0 = ((virt >> 12) & 0x1FF) as usize;
+        while virt < stop {
+            (*table0).set(vpn0, PageTableEntry::from_bits((ppn << 10) | flags));
+            vpn0 += 1;
+            ppn += 1;
+            virt += PAGE_SIZE;
+        }
+    }
+
+    tlb::local_flush_tlb_range(start as usize, end as usize);
+}
+
+/// 大页大小（Sv39 L1 叶子项，HPAGE_PMD_SIZE）
+pub const HPAGE_SIZE: usize = 2 * 1024 * 1024;
+
+/// 大页包含的 4KB 页数 (HPAGE_PMD_NR)
+pub const HPAGE_NR: usize = HPAGE_SIZE / PAGE_SIZE as usize;
+
+/// 建立 2MB 大页映射（L1 叶子项）
+///
+/// virt 与 phys 必须 2MB 对齐；该位置原有的 L0 页表由调用者处理
+unsafe fn map_megapage(root_ppn: u64, virt: u64, phys: u64, flags: u64) {
+    let vpn2 = ((virt >> 30) & 0x1FF) as usize;
+    let vpn1 = ((virt >> 21) & 0x1FF) as usize;
+
+    let root = &mut *((root_ppn << PAGE_SHIFT) as *mut PageTable);
+    let pte2 = root.get(vpn2);
+    let table1 = if pte2.is_valid() {
+        (pte2.ppn() << PAGE_SHIFT) as *mut PageTable
+    } else {
+        let table = alloc_page_table();
+        let ppn = (table as *const PageTable as u64) >> PAGE_SHIFT;
+        root.set(vpn2, PageTableEntry::new_table(ppn));
+        table as *mut PageTable
+    };
+
+    (*table1).set(vpn1, PageTableEntry::from_bits(((phys >> PAGE_SHIFT) << 10) | flags));
+    tlb::local_flush_tlb_page(virt as usize);
+}
 
-    table0_ref.set(vpn0, PageTableEntry::from_bits(pte_bits));
+/// 把 2MB 大页拆分为 512 个 4KB 页表项 (split_huge_pmd)
+///
+/// 映射关系不变，拆分后的页表项继承大页的权限与 COW 标志。
+/// 用户大页的引用计数记录在首页上，拆分时复制到每个子页
+///
+/// # 返回
+/// 新的 L0 页表
+unsafe fn split_megapage(table1: *mut PageTable, vpn1: usize) -> *mut PageTable {
+    use crate::mm::page_desc::pfn_to_page_mut;
 
-    // 刷新 TLB
-    core::arch::asm!("sfence.vma");
+    let pte1 = (*table1).get(vpn1);
+    let base_ppn = pte1.ppn();
+    let flags = pte1.bits() & 0x3FF;
+
+    if pte1.is_user() && pte1.bits() & shared_flags::SPECIAL == 0 {
+        let head = pfn_to_page_mut(base_ppn as usize);
+        if !head.is_null() {
+            let refcount = (*head).refcount();
+            for i in 1..HPAGE_NR {
+                let page = pfn_to_page_mut(base_ppn as usize + i);
+                if !page.is_null() {
+                    (*page).set_refcount(refcount);
+                }
+            }
+        }
+    }
+
+    let table0 = alloc_page_table();
+    for i in 0..HPAGE_NR {
+        table0.set(i, PageTableEntry::from_bits(((base_ppn + i as u64) << 10) | flags));
+    }
+    let ppn0 = (table0 as *const PageTable as u64) >> PAGE_SHIFT;
+    (*table1).set(vpn1, PageTableEntry::new_table(ppn0));
+    table0 as *mut PageTable
 }
 
+/// 恒等映射 [start, start + size)
 unsafe fn map_region(root_ppn: u64, start: u64, size: u64, flags: u64) {
-    let virt_start = VirtAddr::new(start);
-    let phys_start = PhysAddr::new(start);
-    let virt_end = VirtAddr::new(start + size);
+    map_range(root_ppn, start, start, size, flags);
+}
 
-    let mut virt = virt_start.floor();
-    let end = virt_end.ceil();
+/// 把 [phys, phys + size) 映射到 virt
+///
+/// virt 与 phys 同为 2MB 对齐且剩余长度足够时使用大页，减少页表页和 TLB 缺失
+unsafe fn map_range(root_ppn: u64, virt: u64, phys: u64, size: u64, flags: u64) {
+    let huge = HPAGE_SIZE as u64;
+    let end = VirtAddr::new(virt + size).ceil();
+    let mut virt = VirtAddr::new(virt).floor();
+    let mut phys = PhysAddr::new(phys).floor();
 
     while virt.bits() < end.bits() {
-        // 使用恒等映射：虚拟地址 = 物理地址
-        let offset = virt.bits() - virt_start.bits();
-        let phys = PhysAddr::new(phys_start.bits() + offset);
-        map_page(root_ppn, virt, phys, flags);
-        virt = VirtAddr::new(virt.bits() + PAGE_SIZE);
+        if virt.bits() % huge == 0 && phys.bits() % huge == 0 && end.bits() - virt.bits() >= huge {
+            map_megapage(root_ppn, virt.bits(), phys.bits(), flags);
+            virt = VirtAddr::new(virt.bits() + huge);
+            phys = PhysAddr::new(phys.bits() + huge);
+            continue;
+        }
+
+        // 4KB 页映射到下一个 2MB 边界（或区间末尾）为止
+        let stop = ((virt.bits() / huge + 1) * huge).min(end.bits());
+        map_pte_range(root_ppn, virt.bits(), phys.bits(), stop - virt.bits(), flags);
+        phys = PhysAddr::new(phys.bits() + (stop - virt.bits()));
+        virt = VirtAddr::new(stop);
     }
 }
 
@@ -1151,8 +2605,7 @@ pub fn init() {
             // 计算根页表的物理页号（与启动核使用相同的页表）
             let root_ppn = (&raw mut ROOT_PAGE_TABLE as *mut PageTable as u64) / PAGE_SIZE;
 
-            let addr_space = AddressSpace::new(root_ppn);
-            addr_space.enable();
+            enable_kernel_page_table(root_ppn);
 
             return;
         }
@@ -1177,21 +2630,8 @@ pub fn init() {
         // 注意：这确保了 virt_to_phys() 能正确转换 VirtQueue 的 DMA 地址
         let heap_flags = PageTableEntry::V | PageTableEntry::R | PageTableEntry::W | PageTableEntry::A | PageTableEntry::D;
         let heap_virt_start = 0x80A00000u64;
-        let heap_phys_start = 0x80A00000u64;  // 恒等映射
         let heap_size = crate::config::KERNEL_HEAP_SIZE as u64;
-
-        let virt_start = VirtAddr::new(heap_virt_start);
-        let phys_start = PhysAddr::new(heap_phys_start);
-        let virt_end = VirtAddr::new(heap_virt_start + heap_size);
-        let mut virt = virt_start.floor();
-        let end = virt_end.ceil();
-
-        while virt.bits() < end.bits() {
-            let offset = virt.bits() - virt_start.bits();
-            let phys = PhysAddr::new(phys_start.bits() + offset);
-            map_page(root_ppn, virt, phys, heap_flags);
-            virt = VirtAddr::new(virt.bits() + PAGE_SIZE);
-        }
+        map_region(root_ppn, heap_virt_start, heap_size, heap_flags);
 
         // 映射 Slab 分配器区域（堆之后，4MB）
         // Slab 起始地址 = 堆结束地址
@@ -1243,19 +2683,34 @@ pub fn init() {
         // 为 PCI 设备分配的 BAR 地址映射到此区域
         map_region(root_ppn, 0x40000000, 0x10000000, device_flags);
 
+        // 预先分配内核栈区域的各级页表，映射内核栈时只需写页表项
+        let mut addr = vmap_stack::START;
+        while addr < vmap_stack::START + vmap_stack::SIZE {
+            pte_table_alloc(root_ppn, addr);
+            addr += HPAGE_SIZE as u64;
+        }
+
         // 使能 MMU
-        let addr_space = AddressSpace::new(root_ppn);
-        addr_space.enable();
+        enable_kernel_page_table(root_ppn);
+
+        // 分页开启后探测 ASID 位数
+        tlb::init();
     }
 }
 
+/// 切换到内核页表（ASID 0，刷新本地 TLB）
+unsafe fn enable_kernel_page_table(root_ppn: u64) {
+    let satp = Satp::sv39(root_ppn, 0);
+    asm!("csrw satp, {}", in(reg) satp.bits());
+    tlb::local_flush_tlb_all();
+}
+
 pub fn enable() {
     unsafe {
         // 计算根页表的物理页号
         let root_ppn = (&raw mut ROOT_PAGE_TABLE as *mut PageTable as u64) / PAGE_SIZE;
 
-        let addr_space = AddressSpace::new(root_ppn);
-        addr_space.enable();
+        enable_kernel_page_table(root_ppn);
     }
 }
 
@@ -1268,39 +2723,42 @@ pub fn map_identity(virt: VirtAddr, phys: PhysAddr, flags: u64) {
     }
 }
 
-/// 映射设备内存页到用户空间
+/// 映射设备内存到用户空间 (remap_pfn_range)
 ///
-/// 用于将 framebuffer 等设备内存映射到用户进程的地址空间
+/// 用于将 framebuffer 等设备内存映射到用户进程的地址空间。
+/// virt 与 phys 同为 2MB 对齐的部分使用大页，其余使用 4KB 页；
+/// 页表项带 SPECIAL 标志，fork 时直接共享，不参与引用计数和写时复制。
+/// 用户根页表中与内核共享的 L1 页表（如 PCI MMIO 所在的 1GB 区域）会先复制一份私有副本，
+/// 避免把用户映射写进内核页表
 ///
 /// # 参数
+/// - root_ppn: 用户根页表的物理页号
 /// - virt: 虚拟地址 (用户空间)
 /// - phys: 物理地址 (设备内存)
+/// - size: 映射长度
 /// - flags: 页表项标志 (V, R, W, X, U 等)
-///
-/// # 注意
-/// 这是一个简化的实现，使用 2MB 大页映射
-pub fn map_device_page(virt: usize, phys: usize, flags: u64) {
-    // 使用 2MB 大页映射
-    // 对于 framebuffer，使用 2MB 页更简单
-    let vpn2 = (virt >> 30) & 0x1FF;  // VPN[2] for L2 index
-
-    // 计算 PPN (物理页号，对于 2MB 页是 PPN[2:1])
-    let ppn_2m = (phys >> 21) as u64;  // 2MB 对齐的物理页号
-
-    unsafe {
-        // 创建 1GB 大页条目（L2 leaf）
-        // PPN[2:1] 需要放在正确的位置
-        // PTE 格式: [PPN[2] (26 bits)] [PPN[1] (9 bits)] [PPN[0] (9 bits)] [RSW] [DGBUWRXV]
-        let ppn = (phys >> 12) as u64;  // 完整的物理页号
-        let entry_bits = (ppn << 10) | flags;
-
-        ROOT_PAGE_TABLE.set(vpn2 as usize, PageTableEntry::from_bits(entry_bits));
+pub unsafe fn map_device_range(root_ppn: u64, virt: usize, phys: usize, size: usize, flags: u64) {
+    let root = (root_ppn << PAGE_SHIFT) as *mut PageTable;
+    let kernel_root = &raw const ROOT_PAGE_TABLE as *const PageTable;
+    let end = virt + size;
+
+    let mut vpn2 = (virt >> 30) & 0x1FF;
+    while vpn2 <= ((end - 1) >> 30) & 0x1FF {
+        let pte2 = (*root).get(vpn2);
+        if pte2.is_valid() && !pte2.is_leaf() && pte2.bits() == (*kernel_root).get(vpn2).bits() {
+            let kernel_table1 = (pte2.ppn() << PAGE_SHIFT) as *const PageTable;
+            let table1 = alloc_page_table();
+            for vpn1 in 0..512 {
+                table1.set(vpn1, (*kernel_table1).get(vpn1));
+            }
+            let ppn1 = (table1 as *const PageTable as u64) >> PAGE_SHIFT;
+            (*root).set(vpn2, PageTableEntry::new_table(ppn1));
+        }
+        vpn2 += 1;
     }
 
-    // 刷新 TLB
-    unsafe {
-        core::arch::asm!("sfence.vma", options(nomem, nostack));
-    }
+    map_range(root_ppn, virt as u64, phys as u64, size as u64,
+              flags | PageTableEntry::A | PageTableEntry::D | shared_flags::SPECIAL);
 }
 
 pub fn get_satp() -> Satp {
@@ -1374,6 +2832,11 @@ impl PageTableWalker {
             return None;
         }
 
+        // 1GB 大页
+        if pte2.is_leaf() {
+            return Some(pte2.ppn() + ((vpn1 as u64) << 9) + vpn0 as u64);
+        }
+
         let ppn1 = pte2.ppn();
         let table1 = (ppn1 << PAGE_SHIFT) as *const PageTable;
         let pte1 = (*table1).get(vpn1);
@@ -1381,6 +2844,11 @@ impl PageTableWalker {
             return None;
         }
 
+        // 2MB 大页
+        if pte1.is_leaf() {
+            return Some(pte1.ppn() + vpn0 as u64);
+        }
+
         let ppn0 = pte1.ppn();
         let table0 = (ppn0 << PAGE_SHIFT) as *const PageTable;
         let pte0 = (*table0).get(vpn0);
@@ -1392,11 +2860,20 @@ impl PageTableWalker {
     }
 }
 
+/// 归还区间表的容量
+const PHYS_FREE_RANGES: usize = 32;
+
 struct PhysAllocator {
     /// 当前分配位置（物理地址）
     current: u64,
     /// 分配限制（最低地址）
     limit: u64,
+    /// 管理区域的最高地址（不含）
+    top: u64,
+    /// 已归还但无法并回 current 的区间 (起始地址, 大小)，大小为 0 表示空槽
+    ///
+    /// 向下分配的区域耗尽后从这里分配
+    free_ranges: [(u64, u64); PHYS_FREE_RANGES],
 }
 
 impl PhysAllocator {
@@ -1404,6 +2881,8 @@ impl PhysAllocator {
         Self {
             current: 0,
             limit: 0,
+            top: 0,
+            free_ranges: [(0, 0); PHYS_FREE_RANGES],
         }
     }
 
@@ -1415,30 +2894,103 @@ impl PhysAllocator {
     unsafe fn init(&mut self, start: u64, limit: u64) {
         self.current = start;
         self.limit = limit;
+        self.top = start;
+    }
+
+    /// 物理地址是否在本分配器管理的区域中
+    fn contains(&self, addr: u64) -> bool {
+        addr >= self.limit && addr < self.top
     }
 
     /// 分配一页物理内存
     ///
     /// 返回物理页的物理地址，如果分配失败则返回 None
     unsafe fn alloc_page(&mut self) -> Option<u64> {
-        if self.current < self.limit + PAGE_SIZE {
-            return None;
-        }
-
-        self.current -= PAGE_SIZE;
-        Some(self.current)
+        self.alloc_aligned(PAGE_SIZE, PAGE_SIZE)
     }
 
     /// 分配多页物理内存
     unsafe fn alloc_pages(&mut self, count: usize) -> Option<u64> {
-        let total_size = count as u64 * PAGE_SIZE;
+        self.alloc_aligned(count as u64 * PAGE_SIZE, PAGE_SIZE)
+    }
 
-        if self.current < self.limit + total_size {
-            return None;
+    /// 分配 size 字节、按 align 对齐的连续物理内存
+    ///
+    /// 对齐产生的空隙记入归还区间表，不会丢失
+    unsafe fn alloc_aligned(&mut self, size: u64, align: u64) -> Option<u64> {
+        if let Some(start) = self.current.checked_sub(size).map(|s| s & !(align - 1)) {
+            if start >= self.limit {
+                let gap = self.current - (start + size);
+                if gap > 0 {
+                    self.add_free_range(start + size, gap);
+                }
+                self.current = start;
+                return Some(start);
+            }
+        }
+        self.alloc_from_free_ranges(size, align)
+    }
+
+    /// 从归还区间表中分配（取区间的高端）
+    unsafe fn alloc_from_free_ranges(&mut self, size: u64, align: u64) -> Option<u64> {
+        for i in 0..PHYS_FREE_RANGES {
+            let (addr, len) = self.free_ranges[i];
+            if len < size {
+                continue;
+            }
+            let top = (addr + len - size) & !(align - 1);
+            if top < addr {
+                continue;
+            }
+            self.free_ranges[i].1 = top - addr;
+            let tail = addr + len - (top + size);
+            if tail > 0 {
+                self.add_free_range(top + size, tail);
+            }
+            return Some(top);
         }
+        None
+    }
 
-        self.current -= total_size;
-        Some(self.current)
+    /// 记录一个归还区间
+    ///
+    /// # 返回
+    /// 表已满时返回 false
+    fn add_free_range(&mut self, addr: u64, len: u64) -> bool {
+        for range in self.free_ranges.iter_mut() {
+            if range.1 == 0 {
+                *range = (addr, len);
+                return true;
+            }
+        }
+        false
+    }
+
+    /// 归还连续物理内存
+    ///
+    /// 紧邻 current 的区间直接并回向下分配的区域，否则记入归还区间表
+    ///
+    /// # 返回
+    /// 归还区间表已满时返回 false，调用者应继续持有该内存
+    unsafe fn free_range(&mut self, addr: u64, len: u64) -> bool {
+        if addr != self.current {
+            return self.add_free_range(addr, len);
+        }
+
+        self.current += len;
+        // 继续并入与新 current 相邻的归还区间
+        let mut merged = true;
+        while merged {
+            merged = false;
+            for range in self.free_ranges.iter_mut() {
+                if range.1 != 0 && range.0 == self.current {
+                    self.current += range.1;
+                    *range = (0, 0);
+                    merged = true;
+                }
+            }
+        }
+        true
     }
 }
 
@@ -1462,20 +3014,166 @@ pub fn init_user_phys_allocator(start: u64, size: u64) {
     }
 }
 
-/// 从用户物理内存分配器分配一页
-/// 返回物理地址，如果分配失败则返回 None
-pub fn alloc_user_phys_page() -> Option<u64> {
-    unsafe { USER_PHYS_ALLOCATOR.alloc_page() }
+/// 从物理内存分配器分配连续多页
+///
+/// 只用于启动时映射到内核页表、不再释放的内存；用户页由页分配器逐页分配
+///
+/// 内存不足时先让内核堆归还完全空闲的扩展块，再重试一次；
+/// 仍然失败时回收内核缓存（释放的堆内存同样归还）后最后重试一次
+fn alloc_user_phys_pages(count: usize) -> Option<u64> {
+    unsafe {
+        if let Some(addr) = USER_PHYS_ALLOCATOR.alloc_pages(count) {
+            return Some(addr);
+        }
+        if crate::mm::buddy_allocator::shrink_heap() != 0 {
+            if let Some(addr) = USER_PHYS_ALLOCATOR.alloc_pages(count) {
+                return Some(addr);
+            }
+        }
+        if !crate::mm::vmscan::try_to_free_pages() {
+            return None;
+        }
+        USER_PHYS_ALLOCATOR.alloc_pages(count)
+    }
+}
+
+/// 为内核堆扩展块分配对齐的连续物理内存
+///
+/// 不触发堆回收（调用者持有堆锁）
+pub fn alloc_kernel_chunk(size: u64, align: u64) -> Option<u64> {
+    unsafe { USER_PHYS_ALLOCATOR.alloc_aligned(size, align) }
+}
+
+/// 归还内核堆扩展块
+///
+/// # 返回
+/// 无法记录归还区间时返回 false，调用者应继续持有该块
+pub fn free_kernel_chunk(addr: u64, size: u64) -> bool {
+    unsafe { USER_PHYS_ALLOCATOR.free_range(addr, size) }
+}
+
+/// 已分配的匿名大页数 (NR_ANON_THPS)
+static NR_ANON_HUGE_PAGES: AtomicUsize = AtomicUsize::new(0);
+
+/// 由 4KB 页合并而成的大页数 (THP_COLLAPSE_ALLOC)
+static NR_COLLAPSED_HUGE_PAGES: AtomicUsize = AtomicUsize::new(0);
+
+/// 透明大页模式 (transparent_hugepage/enabled)
+///
+/// 允许透明大页的 VMA 中，写缺页整块落在 VMA 内的 2MB 区域直接分配大页，
+/// 填满的 L0 页表在缺页时或由 khugepaged 合并为大页 (mm::khugepaged)；
+/// MAP_HUGETLB 映射不受模式影响
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(u8)]
+pub enum ThpMode {
+    /// 所有匿名私有 VMA，MADV_NOHUGEPAGE 标记的除外
+    Always = 0,
+    /// 只有 MADV_HUGEPAGE 标记的 VMA
+    Madvise = 1,
+    /// 不使用透明大页
+    Never = 2,
+}
+
+static TRANSPARENT_HUGEPAGE: AtomicU8 = AtomicU8::new(ThpMode::Always as u8);
+
+/// 设置透明大页模式
+pub fn set_transparent_hugepage(mode: ThpMode) {
+    TRANSPARENT_HUGEPAGE.store(mode as u8, Ordering::Relaxed);
+}
+
+/// 当前的透明大页模式
+pub fn transparent_hugepage() -> ThpMode {
+    match TRANSPARENT_HUGEPAGE.load(Ordering::Relaxed) {
+        0 => ThpMode::Always,
+        1 => ThpMode::Madvise,
+        _ => ThpMode::Never,
+    }
+}
+
+/// VMA 是否允许透明大页 (vma_thp_allowable)：按模式和 MADV_HUGEPAGE / MADV_NOHUGEPAGE 标志判断
+fn thp_vma_allowable(vma: &Vma) -> bool {
+    let flags = vma.flags();
+    if flags.contains(VmaFlags::NOHUGEPAGE) {
+        return false;
+    }
+    match transparent_hugepage() {
+        ThpMode::Always => true,
+        ThpMode::Madvise => flags.contains(VmaFlags::HUGEPAGE),
+        ThpMode::Never => false,
+    }
+}
+
+/// 已分配的匿名大页数
+pub fn nr_anon_huge_pages() -> usize {
+    NR_ANON_HUGE_PAGES.load(Ordering::Relaxed)
+}
+
+/// 由 4KB 页合并而成的大页数
+pub fn nr_collapsed_huge_pages() -> usize {
+    NR_COLLAPSED_HUGE_PAGES.load(Ordering::Relaxed)
+}
+
+/// 分配 2MB 对齐的物理连续大页（内容未清零）
+///
+/// 每个子页的引用计数置 1；映射期间大页的共享计数记录在首页上。
+/// 用户物理区域用完后从页帧分配器连续分配，必要时规整 (mm::compaction)
+fn alloc_huge_page() -> Option<u64> {
+    use crate::mm::page_desc::pfn_to_page_mut;
+
+    let phys = match unsafe { USER_PHYS_ALLOCATOR.alloc_aligned(HPAGE_SIZE as u64, HPAGE_SIZE as u64) } {
+        Some(phys) => phys,
+        None => {
+            // alloc_contig_frames 计入分配统计
+            let frame = crate::mm::page::alloc_contig_frames(HPAGE_NR, HPAGE_NR)?;
+            NR_ANON_HUGE_PAGES.fetch_add(1, Ordering::Relaxed);
+            return Some(frame.start_address().as_usize() as u64);
+        }
+    };
+    let pfn = (phys >> PAGE_SHIFT) as usize;
+    for i in 0..HPAGE_NR {
+        let page = pfn_to_page_mut(pfn + i);
+        if !page.is_null() {
+            unsafe { (*page).set_refcount(1) };
+        }
+    }
+    NR_ANON_HUGE_PAGES.fetch_add(1, Ordering::Relaxed);
+    count_pgalloc(nr_pages_order(HPAGE_NR));
+    Some(phys)
+}
+
+/// 释放大页
+///
+/// 来自页帧分配器的大页逐页归还
+fn free_huge_page(phys: u64) {
+    if !unsafe { USER_PHYS_ALLOCATOR.contains(phys) } {
+        let pfn = (phys >> PAGE_SHIFT) as usize;
+        for i in 0..HPAGE_NR {
+            crate::mm::page::dealloc_frame(crate::mm::page::PhysFrame::new(pfn + i));
+        }
+        NR_ANON_HUGE_PAGES.fetch_sub(1, Ordering::Relaxed);
+        count_pgfree(nr_pages_order(HPAGE_NR));
+        return;
+    }
+    if unsafe { USER_PHYS_ALLOCATOR.free_range(phys, HPAGE_SIZE as u64) } {
+        NR_ANON_HUGE_PAGES.fetch_sub(1, Ordering::Relaxed);
+        count_pgfree(nr_pages_order(HPAGE_NR));
+    }
+}
+
+/// 解除一个大页映射，最后一个映射解除时释放大页
+fn put_huge_page(ppn: u64) {
+    let head = crate::mm::page_desc::pfn_to_page_mut(ppn as usize);
+    if !head.is_null() && unsafe { (*head).put_page() } == 0 {
+        free_huge_page(ppn << PAGE_SHIFT);
+    }
 }
 
 pub fn create_user_address_space() -> Option<u64> {
     unsafe {
-        // 分配根页表（一页）
-        let root_page = USER_PHYS_ALLOCATOR.alloc_page()?;
-
-        // 初始化页表
-        let root_table = root_page as *mut PageTable;
+        // 根页表与 fork 出的子进程一样取自页表页池，不占用用户物理页
+        let root_table = alloc_page_table() as *mut PageTable;
         (*root_table).zero();
+        let root_page = root_table as u64;
 
         // 复制内核映射到用户页表
         // 用户页表需要能访问内核代码（用于系统调用）
@@ -1547,7 +3245,7 @@ unsafe fn copy_kernel_mappings(user_root_ppn: u64, kernel_root_ppn: u64) {
     let uart_flags = PageTableEntry::V | PageTableEntry::U |
                        PageTableEntry::R | PageTableEntry::W |
                        PageTableEntry::A | PageTableEntry::D;
-    map_region(user_root_ppn, 0x10000000, 0x1000, uart_flags);
+    map_region(user_root_ppn, user_addr::USER_UART_BASE as u64, user_addr::USER_UART_SIZE as u64, uart_flags);
 }
 
 pub unsafe fn map_user_page(user_root_ppn: u64, user_virt: VirtAddr, phys: PhysAddr, flags: u64) {
@@ -1562,58 +3260,108 @@ pub unsafe fn map_user_region(
     flags: u64,
 ) {
     // 检查溢出
-    let virt_end_checked = virt_start.checked_add(size);
-    if virt_end_checked.is_none() {
+    if virt_start.checked_add(size).is_none() {
         panic!("map_user_region: virt_start + size overflow: virt_start={:#x}, size={:#x}",
                virt_start, size);
     }
-    let virt_end_val = virt_end_checked.unwrap();
-
-    let virt_start_addr = VirtAddr::new(virt_start);
-    let phys_start_addr = PhysAddr::new(phys_start);
-    let virt_end = VirtAddr::new(virt_end_val);
-
-    let mut virt = virt_start_addr.floor();
-    let end = virt_end.ceil();
 
-    let mut iteration = 0;
-    while virt.bits() < end.bits() {
-        // offset = 当前虚拟地址 - 起始虚拟地址
-        // virt >= virt_start_addr 应该总是成立，因为 virt = floor(virt_start)
-        let virt_bits = virt.bits();
-        let virt_start_bits = virt_start_addr.bits();
-        if virt_bits < virt_start_bits {
-            panic!("map_user_region: virt ({:#x}) < virt_start ({:#x}), floor() failed?",
-                   virt_bits, virt_start_bits);
-        }
-        let offset = virt_bits - virt_start_bits;
-        let phys = PhysAddr::new(phys_start_addr.bits() + offset);
-        map_page(user_root_ppn, virt, phys, flags);
-        virt = VirtAddr::new(virt.bits() + PAGE_SIZE);
-        iteration += 1;
-    }
+    // 逐个 L0 页表批量填写页表项
+    map_pte_range(user_root_ppn, virt_start, phys_start, size, flags);
 }
 
+/// 为 [virt_addr, virt_addr + size) 分配清零的用户页并建立映射
+///
+/// 每页单独从页分配器取得（引用计数为 1），munmap、进程退出时由 put_user_pte 归还；
+/// 物理页不连续，内容经 copy_to_user_space 按用户地址写入。
+/// 内存不足时归还已分配的页，不建立任何映射
 pub unsafe fn alloc_and_map_user_memory(
     user_root_ppn: u64,
     virt_addr: u64,
     size: u64,
     flags: u64,
-) -> Option<u64> {
+) -> Option<()> {
+    use crate::mm::memcontrol::{mem_cgroup_alloc_zeroed_page, MemcgStat};
+    use crate::mm::pcp::free_user_page;
+
     // 计算需要的页数
     let page_count = ((size + PAGE_SIZE - 1) / PAGE_SIZE) as usize;
 
-    // 分配物理页
-    let phys_addr = USER_PHYS_ALLOCATOR.alloc_pages(page_count)?;
+    // 先分配全部物理页，失败时不留下部分映射
+    let mut frames = Vec::with_capacity(page_count);
+    for _ in 0..page_count {
+        // 清零的页（MAP_ANONYMOUS 要求）
+        match mem_cgroup_alloc_zeroed_page(MemcgStat::Anon) {
+            Some(frame) => frames.push(frame),
+            None => {
+                frames.into_iter().for_each(free_user_page);
+                return None;
+            }
+        }
+    }
 
-    // 映射到用户地址空间
-    map_user_region(user_root_ppn, virt_addr, phys_addr, size, flags);
+    // 逐页映射
+    let start = virt_addr & !(PAGE_SIZE - 1);
+    for (i, frame) in frames.into_iter().enumerate() {
+        let phys = frame.start_address().as_usize() as u64;
+        map_page(user_root_ppn, VirtAddr::new(start + i as u64 * PAGE_SIZE), PhysAddr::new(phys), flags);
+    }
 
-    // 通过物理地址清零（MAP_ANONYMOUS 要求）
-    // 内核使用 identity mapping，物理地址可以直接访问
-    core::ptr::write_bytes(phys_addr as *mut u8, 0, page_count * PAGE_SIZE as usize);
+    Some(())
+}
 
-    Some(phys_addr)
+/// 经用户页表把 data 写入用户地址 virt 起的内存 (access_remote_vm)
+///
+/// 逐页查找映射的物理页，不要求物理页连续
+///
+/// # 返回
+/// 范围内有未映射的页时返回 false，之前的页已写入
+pub unsafe fn copy_to_user_space(user_root_ppn: u64, virt: u64, data: &[u8]) -> bool {
+    let mut done = 0;
+    while done < data.len() {
+        let addr = virt + done as u64;
+        let ppn = match PageTableWalker::walk(user_root_ppn, addr) {
+            Some(ppn) => ppn,
+            None => return false,
+        };
+        let offset = (addr & (PAGE_SIZE - 1)) as usize;
+        let n = (PAGE_SIZE_USIZE - offset).min(data.len() - done);
+        core::ptr::copy_nonoverlapping(
+            data[done..].as_ptr(),
+            ((ppn << PAGE_SHIFT) as usize + offset) as *mut u8,
+            n,
+        );
+        done += n;
+    }
+    true
+}
+
+/// 在内核栈区域建立 [virt, virt + size) 到 [phys, phys + size) 的映射
+///
+/// 页表已在启动时建好，不分配页表页；原映射无效，只刷新本地 TLB
+///
+/// # Safety
+/// 区间必须位于 vmap_stack 区域内且页对齐，调用者负责互斥
+pub unsafe fn vmap_stack_pages(virt: u64, phys: u64, size: u64) {
+    let flags = PageTableEntry::V | PageTableEntry::R | PageTableEntry::W | PageTableEntry::A | PageTableEntry::D;
+    map_pte_range(get_kernel_page_table_ppn(), virt, phys, size, flags);
+}
+
+/// 解除内核栈区域 [virt, virt + size) 的映射 (vunmap_range)
+///
+/// 只刷新本地 TLB；虚拟地址再次映射前，调用者负责刷新所有 CPU 的 TLB
+///
+/// # Safety
+/// 区间必须位于 vmap_stack 区域内且页对齐，调用者负责互斥
+pub unsafe fn vunmap_stack_pages(virt: u64, size: u64) {
+    let root = &*((get_kernel_page_table_ppn() << PAGE_SHIFT) as *const PageTable);
+    let mut addr = virt;
+    while addr < virt + size {
+        let table1 = (root.get(((addr >> 30) & 0x1FF) as usize).ppn() << PAGE_SHIFT) as *const PageTable;
+        let table0 = ((*table1).get(((addr >> 21) & 0x1FF) as usize).ppn() << PAGE_SHIFT) as *mut PageTable;
+        (*table0).set(((addr >> 12) & 0x1FF) as usize, PageTableEntry::from_bits(0));
+        addr += PAGE_SIZE;
+    }
+    tlb::local_flush_tlb_range(virt as usize, (virt + size) as usize);
 }
 
 pub fn get_kernel_page_table_ppn() -> u64 {
@@ -1632,7 +3380,7 @@ pub unsafe fn alloc_and_map_to_kernel_table(
     let page_count = ((size + PAGE_SIZE - 1) / PAGE_SIZE) as usize;
 
     // 分配物理页
-    let phys_addr = USER_PHYS_ALLOCATOR.alloc_pages(page_count)?;
+    let phys_addr = alloc_user_phys_pages(page_count)?;
 
     // 获取内核页表PPN
     let kernel_ppn = get_kernel_page_table_ppn();
@@ -1640,32 +3388,155 @@ pub unsafe fn alloc_and_map_to_kernel_table(
     // 添加U-bit（用户可访问）
     let user_flags = flags | PageTableEntry::U;
 
-    // 映射到内核页表
-    map_user_region(kernel_ppn, virt_addr, phys_addr, size, user_flags);
+    // 映射到内核页表
+    map_user_region(kernel_ppn, virt_addr, phys_addr, size, user_flags);
+
+    Some(phys_addr)
+}
+
+pub unsafe fn switch_to_user(entry: u64, user_stack: u64) -> ! {
+    // 直接调用汇编函数切换到用户模式
+    switch_to_user_asm(entry, user_stack);
+}
+
+// ==================== Copy-on-Write (COW) 支持 ====================
+
+/// Copy-on-Write 标志
+///
+/// 用于标记页是否需要写时复制
+/// 我们使用 PageTableEntry 的保留位来存储 COW 标志
+/// RISC-V Sv39 中，位 [63:54] 是保留给软件使用的
+pub mod cow_flags {
+    /// COW 标志 - 页被标记为写时复制
+    pub const COW: u64 = 1 << 8;  // 使用位 8（在 A 和 D 之后）
+}
+
+/// 换出页的页表项 (swp_entry_t)
+///
+/// V 为 0 时硬件忽略其余各位：RSW 位 9 标记交换项，位 10 起是 zswap 的交换槽号
+pub mod swap_flags {
+    pub const SWAP: u64 = 1 << 9;
+    pub const OFFSET_SHIFT: u32 = 10;
+}
+
+/// 全局零页 (empty_zero_page)
+///
+/// 匿名私有映射的读缺页映射到这一页（只读），第一次写入时经 COW 换成私有页
+#[repr(C, align(4096))]
+struct ZeroPage([u8; PAGE_SIZE as usize]);
+
+static EMPTY_ZERO_PAGE: ZeroPage = ZeroPage([0; PAGE_SIZE as usize]);
+
+/// 零页的物理页号 (my_zero_pfn)
+#[inline]
+pub fn zero_page_ppn() -> u64 {
+    (&EMPTY_ZERO_PAGE as *const ZeroPage as u64) >> PAGE_SHIFT
+}
+
+/// 是否为零页 (is_zero_pfn)
+#[inline]
+pub fn is_zero_page_ppn(ppn: u64) -> bool {
+    ppn == zero_page_ppn()
+}
 
-    Some(phys_addr)
+/// 共享的 L0 页表：页表 PPN -> 引用它的 L1 页表项个数
+///
+/// 引用共享 L0 页表的 L1 页表项带 shared_flags::SHARED，
+/// 写入 L0 页表之前由 own_pte_table 复制出私有页表
+static SHARED_PTE_TABLES: Mutex<BTreeMap<u64, u32>> = Mutex::new(BTreeMap::new());
+
+/// L1 页表项的软件标志
+pub mod shared_flags {
+    /// 指向的 L0 页表可能与其他地址空间共享（RSW 位 9，硬件忽略）
+    pub const SHARED: u64 = 1 << 9;
+    /// 叶子项映射的是设备内存，不参与引用计数和写时复制（RSW 位 9，VM_PFNMAP）
+    ///
+    /// 与 SHARED 共用同一位：SHARED 只出现在指向页表的非叶子项上
+    pub const SPECIAL: u64 = 1 << 9;
 }
 
-pub unsafe fn switch_to_user(entry: u64, user_stack: u64) -> ! {
-    // 直接调用汇编函数切换到用户模式
-    switch_to_user_asm(entry, user_stack);
+/// 当前共享的 L0 页表数
+pub fn nr_shared_pte_tables() -> usize {
+    SHARED_PTE_TABLES.lock().len()
 }
 
-// ==================== Copy-on-Write (COW) 支持 ====================
+/// 把 L0 页表中可写的用户页改为只读 + COW
+unsafe fn wrprotect_pte_table(table0: *mut PageTable) {
+    for vpn0 in 0..512 {
+        let pte0 = (*table0).get(vpn0);
+        if pte0.is_valid() && pte0.is_user() && pte0.is_writable()
+            && pte0.bits() & shared_flags::SPECIAL == 0
+        {
+            (*table0).set(vpn0, PageTableEntry::from_bits(
+                pte0.bits() & !PageTableEntry::W | cow_flags::COW
+            ));
+        }
+    }
+}
 
-/// Copy-on-Write 标志
+/// 确保 L1 页表项指向的 L0 页表为当前地址空间独有 (unshare)
 ///
-/// 用于标记页是否需要写时复制
-/// 我们使用 PageTableEntry 的保留位来存储 COW 标志
-/// RISC-V Sv39 中，位 [63:54] 是保留给软件使用的
-pub mod cow_flags {
-    /// COW 标志 - 页被标记为写时复制
-    pub const COW: u64 = 1 << 8;  // 使用位 8（在 A 和 D 之后）
+/// 仍有其他地址空间共享时复制一份私有 L0 页表，并为其中映射的页增加引用计数；
+/// 最后一个使用者直接收回共享标志。调用者需持有地址空间的页表锁
+///
+/// # 返回
+/// 可以写入的 L0 页表
+unsafe fn own_pte_table(table1: *mut PageTable, vpn1: usize) -> *mut PageTable {
+    use crate::mm::page_desc::pfn_to_page_mut;
+
+    let pte1 = (*table1).get(vpn1);
+    let ppn0 = pte1.ppn();
+    if pte1.bits() & shared_flags::SHARED == 0 {
+        return (ppn0 << PAGE_SHIFT) as *mut PageTable;
+    }
+
+    let mut shared = SHARED_PTE_TABLES.lock();
+    let sharers = shared.get(&ppn0).copied().unwrap_or(1);
+    if sharers <= 1 {
+        shared.remove(&ppn0);
+        (*table1).set(vpn1, PageTableEntry::from_bits(pte1.bits() & !shared_flags::SHARED));
+        return (ppn0 << PAGE_SHIFT) as *mut PageTable;
+    }
+
+    let old_table = (ppn0 << PAGE_SHIFT) as *const PageTable;
+    let new_table = alloc_page_table();
+    for vpn0 in 0..512 {
+        let pte0 = (*old_table).get(vpn0);
+        if pte0.is_swap() {
+            // 换出页的页表项由每份页表各持交换槽的一个引用 (copy_nonpresent_pte)
+            crate::mm::zswap::swap_duplicate(pte0.swap_offset());
+            new_table.set(vpn0, pte0);
+            continue;
+        }
+        if !pte0.is_valid() {
+            continue;
+        }
+        // 与复制页表时相同：COW 页和可写页由每份页表各持一个引用
+        let is_cow = pte0.bits() & cow_flags::COW != 0;
+        let special = pte0.bits() & shared_flags::SPECIAL != 0;
+        if pte0.is_user() && (pte0.is_writable() || is_cow) && !special && !is_zero_page_ppn(pte0.ppn()) {
+            let page = pfn_to_page_mut(pte0.ppn() as usize);
+            if !page.is_null() {
+                (*page).get_page();
+                (*page).set_flag(crate::mm::page_desc::PageFlag::Cow);
+            }
+        }
+        new_table.set(vpn0, pte0);
+    }
+    shared.insert(ppn0, sharers - 1);
+
+    let new_ppn = (new_table as *const PageTable as u64) >> PAGE_SHIFT;
+    (*table1).set(vpn1, PageTableEntry::new_table(new_ppn));
+    new_table as *mut PageTable
 }
 
 /// 复制页表（用于 fork）
 ///
-/// 创建新页表，复制父进程的页表项，但将可写页标记为只读 + COW
+/// 只复制根页表和 L1 页表，L0 页表由父子进程共享 (shared page tables)：
+/// 共享的 L0 页表中的可写页改为只读 + COW，之后任一方第一次写入该 L0 页表
+/// （缺页映射、COW、munmap）时才复制出私有页表。
+/// fork 的开销因此与 L0 页表数而不是映射的页数成正比，紧接 execve 的子进程
+/// 不会复制任何 L0 页表。调用者需持有父进程页表锁并刷新父进程 TLB
 ///
 /// # 参数
 /// - parent_root_ppn: 父进程根页表的物理页号
@@ -1676,7 +3547,7 @@ pub mod cow_flags {
 /// # 安全性
 /// 此函数是 unsafe 的，因为它直接操作原始指针和页表
 pub unsafe fn copy_page_table_cow(parent_root_ppn: u64) -> Option<u64> {
-    use crate::mm::page_desc::{pfn_to_page_mut, PHYS_MEMORY_BASE};
+    use crate::mm::page_desc::pfn_to_page_mut;
 
     // 检查 parent_root_ppn 是否有效
     if parent_root_ppn == 0 {
@@ -1687,10 +3558,12 @@ pub unsafe fn copy_page_table_cow(parent_root_ppn: u64) -> Option<u64> {
     let child_root_table = alloc_page_table();
     let child_root_ppn = (child_root_table as *const PageTable as u64) >> PAGE_SHIFT;
 
-    // 复制 L2 页表项（512 项）
     let parent_root = (parent_root_ppn << PAGE_SHIFT) as *const PageTable;
     let child_root = child_root_table as *mut PageTable;
 
+    let kernel_root = &raw const ROOT_PAGE_TABLE as *const PageTable;
+    let mut shared = SHARED_PTE_TABLES.lock();
+
     for vpn2 in 0..512 {
         let pte2 = (*parent_root).get(vpn2);
 
@@ -1698,11 +3571,9 @@ pub unsafe fn copy_page_table_cow(parent_root_ppn: u64) -> Option<u64> {
             continue;  // 跳过无效项
         }
 
-        let ppn1 = pte2.ppn();
-
-        // VPN2 >= 2 对应内核区域（0x80000000+），直接共享页表引用
-        // 这避免了复制大量内核映射
-        if vpn2 >= 2 {
+        // VPN2 >= 2 对应内核区域（0x80000000+），1GB 大页和从内核页表复制来的
+        // 页表（如 PCI MMIO）同样直接共享
+        if vpn2 >= 2 || pte2.is_leaf() || pte2.bits() == (*kernel_root).get(vpn2).bits() {
             (*child_root).set(vpn2, pte2);
             continue;
         }
@@ -1712,61 +3583,55 @@ pub unsafe fn copy_page_table_cow(parent_root_ppn: u64) -> Option<u64> {
         let child_ppn1 = (child_table1 as *const PageTable as u64) >> PAGE_SHIFT;
         (*child_root).set(vpn2, PageTableEntry::new_table(child_ppn1));
 
-        let parent_table1 = (ppn1 << PAGE_SHIFT) as *const PageTable;
-        let child_table1_ref = &mut *child_table1;
+        let parent_table1 = (pte2.ppn() << PAGE_SHIFT) as *mut PageTable;
+        // 私有 L1 页表中从内核复制来的项（map_device_range）
+        let kernel_pte2 = (*kernel_root).get(vpn2);
+        let kernel_table1 = if kernel_pte2.is_valid() && !kernel_pte2.is_leaf() {
+            (kernel_pte2.ppn() << PAGE_SHIFT) as *const PageTable
+        } else {
+            core::ptr::null()
+        };
 
-        // 复制 L1 页表项（512 项）
         for vpn1 in 0..512 {
             let pte1 = (*parent_table1).get(vpn1);
 
             if !pte1.is_valid() {
-                continue;  // 跳过无效项
+                continue;
             }
-
-            let ppn0 = pte1.ppn();
-
-            // 分配新的 L0 页表
-            let child_table0 = alloc_page_table();
-            let child_ppn0 = (child_table0 as *const PageTable as u64) >> PAGE_SHIFT;
-            (*child_table1_ref).set(vpn1, PageTableEntry::new_table(child_ppn0));
-
-            let parent_table0 = (ppn0 << PAGE_SHIFT) as *const PageTable;
-            let child_table0_ref = &mut *child_table0;
-
-            // 复制 L0 页表项（512 项）
-            for vpn0 in 0..512 {
-                let pte0 = (*parent_table0).get(vpn0);
-
-                if !pte0.is_valid() {
-                    continue;  // 跳过无效项
-                }
-
-                // 只对用户可写页进行 COW 标记
-                let is_user = pte0.bits() & PageTableEntry::U != 0;
-                let is_writable = pte0.is_writable();
-
-                let new_pte = if is_user && is_writable {
-                    // 获取物理页的 Page 描述符并增加引用计数
-                    let phys_ppn = pte0.ppn();
-                    let pfn = (phys_ppn as usize) + (PHYS_MEMORY_BASE / 0x1000);
-                    let page = pfn_to_page_mut(pfn);
-
-                    if !page.is_null() {
-                        (*page).get_page();  // 增加引用计数
-                        (*page).set_flag(crate::mm::page_desc::PageFlag::Cow);
+            if !kernel_table1.is_null() && pte1.bits() == (*kernel_table1).get(vpn1).bits() {
+                child_table1.set(vpn1, pte1);
+                continue;
+            }
+            if pte1.is_leaf() {
+                // 用户大页：父子进程都改为只读 + COW，首页引用计数加一 (copy_huge_pmd)
+                // 设备内存直接共享
+                let huge_pte = if pte1.is_user() && pte1.bits() & shared_flags::SPECIAL == 0 {
+                    let head = pfn_to_page_mut(pte1.ppn() as usize);
+                    if !head.is_null() {
+                        (*head).get_page();
                     }
-
-                    // 移除 W 标志，添加 COW 标志
-                    PageTableEntry::from_bits(
-                        pte0.bits() & !PageTableEntry::W | cow_flags::COW
-                    )
+                    let cow_pte = if pte1.is_writable() {
+                        PageTableEntry::from_bits(pte1.bits() & !PageTableEntry::W | cow_flags::COW)
+                    } else {
+                        pte1
+                    };
+                    (*parent_table1).set(vpn1, cow_pte);
+                    cow_pte
                 } else {
-                    // 非用户页或只读页，直接复制 PTE
-                    pte0
+                    pte1
                 };
-
-                (*child_table0_ref).set(vpn0, new_pte);
+                child_table1.set(vpn1, huge_pte);
+                continue;
             }
+
+            // 共享 L0 页表：写保护其中的可写页，父子进程的 L1 项都标记为共享
+            let ppn0 = pte1.ppn();
+            wrprotect_pte_table((ppn0 << PAGE_SHIFT) as *mut PageTable);
+            *shared.entry(ppn0).or_insert(1) += 1;
+
+            let shared_pte = PageTableEntry::from_bits(pte1.bits() | shared_flags::SHARED);
+            (*parent_table1).set(vpn1, shared_pte);
+            child_table1.set(vpn1, shared_pte);
         }
     }
 
@@ -1778,7 +3643,7 @@ pub unsafe fn copy_page_table_cow(parent_root_ppn: u64) -> Option<u64> {
 /// 当进程尝试写入 COW 页时，复制该页并更新页表
 ///
 /// # 参数
-/// - root_ppn: 进程根页表的物理页号
+/// - addr_space: 发生错误的地址空间
 /// - fault_addr: 触发错误的虚拟地址
 ///
 /// # 返回
@@ -1786,11 +3651,14 @@ pub unsafe fn copy_page_table_cow(parent_root_ppn: u64) -> Option<u64> {
 ///
 /// # 安全性
 /// 此函数是 unsafe 的，因为它直接操作原始指针和页表
-pub unsafe fn handle_cow_fault(root_ppn: u64, fault_addr: VirtAddr) -> Option<()> {
-    use crate::mm::page::alloc_frame;
-    use crate::mm::page_desc::{pfn_to_page_mut, PHYS_MEMORY_BASE};
+pub unsafe fn handle_cow_fault(addr_space: &AddressSpace, fault_addr: VirtAddr) -> Option<()> {
+    use crate::mm::memcontrol::{mem_cgroup_alloc_page, MemcgStat};
+    use crate::mm::page_desc::{pfn_to_page_mut, PageType};
 
+    let root_ppn = addr_space.root_ppn;
     let virt_addr = fault_addr.bits();
+    let page_addr = virt_addr as usize & !(PAGE_SIZE_USIZE - 1);
+    let _ptl = addr_space.page_table_lock.lock();
 
     // 提取虚拟页号（VPN2, VPN1, VPN0）
     let vpn2 = ((virt_addr >> 30) & 0x1FF) as usize;
@@ -1814,6 +3682,11 @@ pub unsafe fn handle_cow_fault(root_ppn: u64, fault_addr: VirtAddr) -> Option<()
         return None;
     }
 
+    // 2MB 大页
+    if pte1.is_leaf() {
+        return do_huge_wp_page(addr_space, table1, vpn1, virt_addr as usize);
+    }
+
     let ppn0 = pte1.ppn();
     let table0 = (ppn0 << PAGE_SHIFT) as *mut PageTable;
 
@@ -1828,10 +3701,30 @@ pub unsafe fn handle_cow_fault(root_ppn: u64, fault_addr: VirtAddr) -> Option<()
         return None;
     }
 
+    // fork 共享的 L0 页表先复制为私有页表，页的引用计数随之增加
+    let table0 = own_pte_table(table1, vpn1);
+
     let old_ppn = old_pte.ppn();
+    // 写入后的私有页挂到 LRU 上，可以被换出
+    let swappable = addr_space.find_vma_rcu(PageVirtAddr::new(page_addr)).map_or(false, |vma| vma_swappable(&vma));
+
+    // 零页：分配清零的私有页，零页本身不计引用 (wp_page_copy)
+    if is_zero_page_ppn(old_ppn) {
+        let new_frame = crate::mm::memcontrol::mem_cgroup_alloc_zeroed_page(MemcgStat::Anon)?;
+        let new_ppn = new_frame.start_address().as_usize() as u64 >> PAGE_SHIFT;
+
+        let flags = (old_bits & 0xFF) | PageTableEntry::W | PageTableEntry::D;
+        (*table0).set(vpn0, PageTableEntry::from_bits((new_ppn << 10) | flags));
+        addr_space.flush_tlb_page(page_addr);
+        if swappable {
+            lru_add_anon(&addr_space.page_table_lock, new_frame.number, page_addr);
+        }
+        count_vm_event(VmEvent::CowFault);
+        return Some(());
+    }
 
     // 检查旧页的引用计数
-    let old_pfn = (old_ppn as usize) + (PHYS_MEMORY_BASE / 0x1000);
+    let old_pfn = old_ppn as usize;
     let old_page = pfn_to_page_mut(old_pfn);
 
     let refcount = if !old_page.is_null() {
@@ -1839,32 +3732,42 @@ pub unsafe fn handle_cow_fault(root_ppn: u64, fault_addr: VirtAddr) -> Option<()
     } else {
         1  // 如果没有 page descriptor，假设只有一个引用
     };
+    // 合并页的内容由合并扫描按引用共享，只剩一个映射也总是复制 (do_wp_page: PageKsm)
+    let ksm = !old_page.is_null() && (*old_page).page_type() == PageType::Ksm;
 
     // 如果只有一个引用，直接恢复写权限（不需要复制）
-    if refcount <= 1 {
-        // 更新页表项：移除 COW 标志，添加 W 标志，保持原有 PPN
+    if refcount <= 1 && !ksm {
+        // MADV_FREE 标记过的页再次写入，内容重新有效，不再惰性释放；
+        // 能换出的页改为可换出（换出前的写保护也在这里解除），并记一次访问
+        if !old_page.is_null() {
+            let page_type = (*old_page).page_type();
+            if swappable && matches!(page_type, PageType::Anonymous | PageType::Normal) {
+                lru_add_anon(&addr_space.page_table_lock, old_pfn, page_addr);
+                crate::mm::vmscan::mark_page_accessed(old_pfn);
+            } else if page_type == PageType::Anonymous {
+                clear_lazyfree(old_page, old_pfn);
+            }
+        }
+
+        // 更新页表项：移除 COW 标志，添加 W 和 D 标志，保持原有 PPN
         let new_pte = PageTableEntry::from_bits(
-            (old_bits & !cow_flags::COW) | PageTableEntry::W
+            (old_bits & !cow_flags::COW) | PageTableEntry::W | PageTableEntry::D
         );
 
-        // 刷新 TLB
-        asm!("sfence.vma zero, zero");
-
-        // 更新页表项
+        // 先更新页表项再刷新 TLB，其他 CPU 上的只读项随之失效
         (*table0).set(vpn0, new_pte);
+        addr_space.flush_tlb_page(page_addr);
 
         return Some(());
     }
 
     // 有多个引用，需要复制页面
 
-    // 减少旧页的引用计数
-    if !old_page.is_null() {
-        (*old_page).put_page();
-    }
-
     // 分配新的物理页
-    let new_frame = alloc_frame()?;
+    let new_frame = mem_cgroup_alloc_page(MemcgStat::Anon)?;
+
+    // 减少旧页的引用计数
+    let last_ksm = !old_page.is_null() && (*old_page).put_page() == 0 && ksm;
     let new_ppn = new_frame.start_address().as_usize() as u64 >> PAGE_SHIFT;
 
     let new_virt = (new_ppn << PAGE_SHIFT) as *mut u8;
@@ -1878,15 +3781,115 @@ pub unsafe fn handle_cow_fault(root_ppn: u64, fault_addr: VirtAddr) -> Option<()
     let flags = (old_bits & 0xFF) | PageTableEntry::W;  // 保留原有标志，添加 W，移除 COW
     let new_pte = PageTableEntry::from_bits((new_ppn << 10) | flags);
 
-    // 刷新 TLB
-    asm!("sfence.vma zero, zero");
-
-    // 更新页表项
+    // 更新页表项并刷新 TLB
     (*table0).set(vpn0, new_pte);
+    addr_space.flush_tlb_page(page_addr);
+    if swappable {
+        lru_add_anon(&addr_space.page_table_lock, new_ppn as usize, page_addr);
+    }
+    // 合并页的最后一个映射已换成私有副本，旧 TLB 项失效后释放
+    if last_ksm {
+        (*old_page).set_page_type(PageType::Normal);
+        crate::mm::pcp::free_user_page(crate::mm::page::PhysFrame::new(old_pfn));
+    }
+    count_vm_event(VmEvent::CowFault);
+
+    Some(())
+}
+
+/// 大页的写时复制 (do_huge_pmd_wp_page)
+///
+/// 只有一个映射时直接恢复写权限，否则复制整个 2MB 大页。
+/// 调用者持有页表锁
+unsafe fn do_huge_wp_page(
+    addr_space: &AddressSpace,
+    table1: *mut PageTable,
+    vpn1: usize,
+    addr: usize,
+) -> Option<()> {
+    use crate::mm::page_desc::pfn_to_page_mut;
+
+    let pte1 = (*table1).get(vpn1);
+    let old_bits = pte1.bits();
+    if old_bits & cow_flags::COW == 0 {
+        return None;
+    }
+    let haddr = addr & !(HPAGE_SIZE - 1);
+    let old_ppn = pte1.ppn();
+    let head = pfn_to_page_mut(old_ppn as usize);
+    let refcount = if head.is_null() { 1 } else { (*head).refcount() };
+
+    let flags = (old_bits & 0xFF) | PageTableEntry::W | PageTableEntry::D;
+    if refcount <= 1 {
+        (*table1).set(vpn1, PageTableEntry::from_bits((old_ppn << 10) | flags));
+        addr_space.flush_tlb_page(haddr);
+        return Some(());
+    }
 
+    let new_phys = alloc_huge_page()?;
+    core::ptr::copy_nonoverlapping(
+        (old_ppn << PAGE_SHIFT) as *const u8,
+        new_phys as *mut u8,
+        HPAGE_SIZE,
+    );
+    put_huge_page(old_ppn);
+
+    (*table1).set(vpn1, PageTableEntry::from_bits(((new_phys >> PAGE_SHIFT) << 10) | flags));
+    addr_space.flush_tlb_page(haddr);
+    count_vm_event(VmEvent::CowFault);
     Some(())
 }
 
+/// 共享可写映射的写保护缺页 (wp_page_shared)
+///
+/// 页已映射但不可写时恢复写权限，不复制页：能回写的文件映射为跟踪脏页映射为只读，
+/// msync 写保护后也是只读；fork 把共享映射的页也标记为 COW，这里清除 COW 标志，
+/// 父子进程继续共享同一个页。文件映射的页在页缓存中标记为脏 (fault_dirty_shared_page)
+///
+/// # 返回
+/// 不是共享可写 VMA 时返回 None，由调用者按 COW 或权限错误处理
+fn do_shared_wp_page(addr_space: &AddressSpace, fault_addr: VirtAddr, seq: usize) -> Option<MmFaultResult> {
+    let vma = addr_space.find_vma_rcu(PageVirtAddr::new(fault_addr.as_usize()))?;
+    if !vma.flags().is_shared() || !vma.flags().is_writable() {
+        return None;
+    }
+    let addr = fault_addr.as_usize() & !(PAGE_SIZE_USIZE - 1);
+    let vpn0 = (addr >> 12) & 0x1FF;
+
+    let _ptl = addr_space.page_table_lock.lock();
+    // VMA 已被修改（如 mprotect 去掉了写权限）：重新执行访问，按新的 VMA 处理
+    if addr_space.vma_seq_retry(seq) {
+        return Some(MmFaultResult::Handled);
+    }
+    unsafe {
+        let (table1, vpn1) = l1_entry(addr_space.root_ppn, addr, false)?;
+        let pte1 = (*table1).get(vpn1);
+        if !pte1.is_valid() {
+            return Some(MmFaultResult::Handled);
+        }
+        // 共享的 2MB 大页（MAP_HUGETLB | MAP_SHARED）
+        if pte1.is_leaf() {
+            let bits = (pte1.bits() & !cow_flags::COW) | PageTableEntry::W | PageTableEntry::D;
+            (*table1).set(vpn1, PageTableEntry::from_bits(bits));
+            addr_space.flush_tlb_page(addr & !(HPAGE_SIZE - 1));
+            return Some(MmFaultResult::Handled);
+        }
+        // 其他 CPU 上的线程可能已经处理
+        let pte0 = (*((pte1.ppn() << PAGE_SHIFT) as *const PageTable)).get(vpn0);
+        if !pte0.is_valid() || pte0.is_writable() {
+            return Some(MmFaultResult::Handled);
+        }
+        let table0 = own_pte_table(table1, vpn1);
+        let bits = ((*table0).get(vpn0).bits() & !cow_flags::COW) | PageTableEntry::W | PageTableEntry::D;
+        (*table0).set(vpn0, PageTableEntry::from_bits(bits));
+        if vma.vma_type() == VmaType::FileBacked {
+            crate::mm::filemap::set_mapped_page_dirty(pte0.ppn() as usize);
+        }
+    }
+    addr_space.flush_tlb_page(addr);
+    Some(MmFaultResult::Handled)
+}
+
 /// 检查页是否为 COW 页
 ///
 /// # 参数
@@ -1903,30 +3906,499 @@ pub unsafe fn is_cow_page(root_ppn: u64, addr: VirtAddr) -> bool {
     let vpn1 = ((virt_addr >> 21) & 0x1FF) as usize;
     let vpn0 = ((virt_addr >> 12) & 0x1FF) as usize;
 
-    // 遍历页表
-    let root_table = (root_ppn << PAGE_SHIFT) as *const PageTable;
-    let pte2 = (*root_table).get(vpn2);
+    // 遍历页表
+    let root_table = (root_ppn << PAGE_SHIFT) as *const PageTable;
+    let pte2 = (*root_table).get(vpn2);
+
+    if !pte2.is_valid() {
+        return false;
+    }
+
+    let table1 = (pte2.ppn() << PAGE_SHIFT) as *const PageTable;
+    let pte1 = (*table1).get(vpn1);
+
+    if !pte1.is_valid() {
+        return false;
+    }
+
+    // 2MB 大页的 COW 标志在 L1 叶子项上
+    if pte1.is_leaf() {
+        return (pte1.bits() & cow_flags::COW) != 0;
+    }
+
+    let table0 = (pte1.ppn() << PAGE_SHIFT) as *const PageTable;
+    let pte0 = (*table0).get(vpn0);
+
+    if !pte0.is_valid() {
+        return false;
+    }
+
+    // 检查 COW 标志
+    (pte0.bits() & cow_flags::COW) != 0
+}
+
+// ==================== 页释放与惰性释放 ====================
+
+/// 解除一个 4KB 用户页映射持有的引用，最后一个引用解除时释放页 (zap_present_pte)
+///
+/// 零页、设备页和不由页分配器管理的页（保留页、引用计数为 0 的页）跳过。
+/// 调用者已刷新 TLB
+unsafe fn put_user_pte(pte: PageTableEntry) {
+    use crate::mm::page_desc::{pfn_to_page, PageType};
+
+    let ppn = pte.ppn();
+    if !pte.is_user() || pte.bits() & shared_flags::SPECIAL != 0 || is_zero_page_ppn(ppn) {
+        return;
+    }
+    let page = pfn_to_page(ppn as usize);
+    if page.is_null() || (*page).is_reserved() || (*page).refcount() <= 0 {
+        return;
+    }
+    if (*page).put_page() == 0 {
+        match (*page).page_type() {
+            PageType::Anonymous => clear_lazyfree(page, ppn as usize),
+            // 合并页的最后一个映射：类型先于释放复位，合并扫描不会再取得引用
+            PageType::Ksm => (*page).set_page_type(PageType::Normal),
+            _ => {}
+        }
+        crate::mm::pcp::free_user_page(crate::mm::page::PhysFrame::new(ppn as usize));
+    }
+}
+
+/// 页描述符的 private 记录惰性释放页所属的页表锁（持有一个 Arc 引用）
+///
+/// 已有记录时替换；与页回收并发时只有一方持有记录
+unsafe fn set_lazyfree_owner(page: *const crate::mm::page_desc::Page, owner: &Arc<PageTableLock>) {
+    let raw = Arc::into_raw(owner.clone()) as usize;
+    loop {
+        let old = (*page).take_private();
+        if old != 0 {
+            drop(Arc::from_raw(old as *const PageTableLock));
+        }
+        if (*page).try_set_private(raw) {
+            return;
+        }
+    }
+}
+
+/// 放回页回收暂时取出的页表锁记录；期间页被重新标记时丢弃旧记录
+unsafe fn restore_lazyfree_owner(page: *const crate::mm::page_desc::Page, owner: Arc<PageTableLock>) {
+    let raw = Arc::into_raw(owner) as usize;
+    if !(*page).try_set_private(raw) {
+        drop(Arc::from_raw(raw as *const PageTableLock));
+    }
+}
+
+/// 取消页的惰性释放（或可换出）标记并移出 LRU
+unsafe fn clear_lazyfree(page: *const crate::mm::page_desc::Page, pfn: usize) {
+    let owner = (*page).take_private();
+    if owner != 0 {
+        drop(Arc::from_raw(owner as *const PageTableLock));
+    }
+    (*page).set_page_type(crate::mm::page_desc::PageType::Normal);
+    (*page).clear_flag(crate::mm::page_desc::PageFlag::SwapBacked);
+    crate::mm::vmscan::lru_cache_del(pfn);
+}
+
+/// 页表锁内清除指向 pfn 的惰性释放页表项
+///
+/// 页表项必须仍为只读 + COW（标记后没有写入过），且页只有这一个引用
+unsafe fn clear_lazyfree_pte(root_ppn: u64, vaddr: usize, pfn: usize) -> bool {
+    let (table1, vpn1) = match l1_entry(root_ppn, vaddr, false) {
+        Some(entry) => entry,
+        None => return false,
+    };
+    let pte1 = (*table1).get(vpn1);
+    if !pte1.is_valid() || pte1.is_leaf() || pte1.bits() & shared_flags::SHARED != 0 {
+        return false;
+    }
+    let table0 = (pte1.ppn() << PAGE_SHIFT) as *mut PageTable;
+    let vpn0 = (vaddr >> 12) & 0x1FF;
+    let pte0 = (*table0).get(vpn0);
+    if !pte0.is_valid() || pte0.ppn() != pfn as u64 || pte0.is_writable() || pte0.bits() & cow_flags::COW == 0 {
+        return false;
+    }
+    let page = crate::mm::page_desc::pfn_to_page(pfn);
+    if (*page).refcount() != 1 {
+        return false;
+    }
+    (*table0).set(vpn0, PageTableEntry::new());
+    true
+}
+
+/// 解除一个惰性释放页的映射，由页回收调用 (try_to_unmap)
+///
+/// 在页所属地址空间的页表锁内确认页仍未被写入且只有一个引用，然后清除页表项。
+/// 不刷新 TLB、不释放页：调用者用 flush_tlb_all 批量刷新后释放。
+/// 页表锁被占用（可能正是该地址空间在分配内存）时保留标记，稍后再试
+///
+/// # 返回
+/// 解除映射后返回 true；页已不再是惰性释放页时取消标记并移出 LRU
+pub fn try_to_unmap_lazyfree(pfn: usize) -> bool {
+    let page = crate::mm::page_desc::pfn_to_page(pfn);
+    if page.is_null() {
+        return false;
+    }
+    unsafe {
+        let raw = (*page).take_private();
+        if raw == 0 {
+            return false;
+        }
+        let owner = Arc::from_raw(raw as *const PageTableLock);
+        let vaddr = (*page).index() * PAGE_SIZE_USIZE;
+        let locked = owner.try_lock().map(|_ptl| clear_lazyfree_pte(owner.root_ppn, vaddr, pfn));
+        let unmapped = match locked {
+            Some(unmapped) => unmapped,
+            None => {
+                restore_lazyfree_owner(page, owner);
+                return false;
+            }
+        };
+        drop(owner);
+        if !unmapped {
+            clear_lazyfree(page, pfn);
+        }
+        unmapped
+    }
+}
+
+/// VMA 中的匿名页能否换出
+///
+/// 私有匿名映射和私有文件映射中复制出的页；mlock 的页常驻内存 (VM_LOCKED)
+fn vma_swappable(vma: &Vma) -> bool {
+    let flags = vma.flags();
+    matches!(vma.vma_type(), VmaType::Anonymous | VmaType::FileBacked)
+        && !flags.is_shared()
+        && !flags.contains(VmaFlags::LOCKED)
+        && !flags.contains(VmaFlags::IO)
+}
+
+/// 新的私有匿名页加入 LRU，之后可以被换出 (folio_add_lru_vma)
+///
+/// 与惰性释放页一样，页描述符记录所属的页表锁和虚拟地址（反向映射），
+/// 并带 SwapBacked 标志。调用者持有页表锁
+unsafe fn lru_add_anon(owner: &Arc<PageTableLock>, pfn: usize, vaddr: usize) {
+    use crate::mm::page_desc::{pfn_to_page, PageFlag, PageType};
+
+    let page = pfn_to_page(pfn);
+    if page.is_null() || (*page).is_reserved() {
+        return;
+    }
+    set_lazyfree_owner(page, owner);
+    (*page).set_page_type(PageType::Anonymous);
+    (*page).set_index(vaddr / PAGE_SIZE_USIZE);
+    (*page).set_flag(PageFlag::SwapBacked);
+    crate::mm::vmscan::lru_cache_add(pfn);
+}
+
+/// 最后一个引用释放前清除匿名页的反向映射和 LRU 状态
+///
+/// 由不经过页表释放用户页的路径调用（如 get_user_pages 取得的引用最后归还）
+pub fn release_anon_page(pfn: usize) {
+    let page = crate::mm::page_desc::pfn_to_page(pfn);
+    if !page.is_null() && unsafe { (*page).page_type() } == crate::mm::page_desc::PageType::Anonymous {
+        unsafe { clear_lazyfree(page, pfn) };
+    }
+}
+
+/// try_to_swap_out 的结果
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum SwapOut {
+    /// 已换出并解除映射，调用者刷新 TLB 后释放页
+    Unmapped,
+    /// 页表项原来可写，已改为只读 + COW；调用者刷新 TLB 后放回 inactive 链表，
+    /// 下一轮扫描时页内容不会再变化
+    Protected,
+    /// 暂时不能换出（页表锁被占用、L0 页表共享或页有其他引用），放回 LRU
+    Keep,
+    /// 页已不再映射在记录的位置或 zswap 拒绝保存，已移出 LRU
+    Removed,
+}
+
+/// 页表锁内换出 vaddr 处映射 pfn 的页表项 (try_to_unmap_one)
+unsafe fn swap_out_pte(root_ppn: u64, vaddr: usize, pfn: usize) -> SwapOut {
+    let (table1, vpn1) = match l1_entry(root_ppn, vaddr, false) {
+        Some(entry) => entry,
+        None => return SwapOut::Removed,
+    };
+    let pte1 = (*table1).get(vpn1);
+    if !pte1.is_valid() || pte1.is_leaf() {
+        return SwapOut::Removed;
+    }
+    let table0 = (pte1.ppn() << PAGE_SHIFT) as *mut PageTable;
+    let vpn0 = (vaddr >> 12) & 0x1FF;
+    let pte0 = (*table0).get(vpn0);
+    if !pte0.is_valid() || pte0.ppn() != pfn as u64 {
+        return SwapOut::Removed;
+    }
+    // 共享的 L0 页表或多个引用：页还映射在其他地址空间中
+    let page = crate::mm::page_desc::pfn_to_page(pfn);
+    if pte1.bits() & shared_flags::SHARED != 0 || (*page).refcount() != 1 {
+        return SwapOut::Keep;
+    }
+    // 没有反向映射逐个清除脏位，先写保护，刷新 TLB 后页内容才稳定
+    if pte0.is_writable() {
+        (*table0).set(vpn0, PageTableEntry::from_bits(pte0.bits() & !PageTableEntry::W | cow_flags::COW));
+        return SwapOut::Protected;
+    }
+    match crate::mm::zswap::zswap_store(pfn) {
+        Some(offset) => {
+            (*table0).set(vpn0, PageTableEntry::new_swap(offset));
+            SwapOut::Unmapped
+        }
+        None => SwapOut::Removed,
+    }
+}
+
+/// 换出一个匿名页，由页回收调用 (shrink_folio_list: add_to_swap + try_to_unmap)
+///
+/// 在页所属地址空间的页表锁内确认页只有这一个映射。可写的页先写保护，
+/// 下一轮扫描时才压缩保存到 zswap 并把页表项换成交换项。
+/// 不刷新 TLB、不释放页：调用者用 flush_tlb_all 批量刷新后释放。
+/// 页表锁被占用时保留记录，稍后再试
+pub fn try_to_swap_out(pfn: usize) -> SwapOut {
+    let page = crate::mm::page_desc::pfn_to_page(pfn);
+    if page.is_null() {
+        return SwapOut::Keep;
+    }
+    unsafe {
+        let raw = (*page).take_private();
+        if raw == 0 {
+            return SwapOut::Keep;
+        }
+        let owner = Arc::from_raw(raw as *const PageTableLock);
+        let vaddr = (*page).index() * PAGE_SIZE_USIZE;
+        let result = match owner.try_lock() {
+            Some(_ptl) => swap_out_pte(owner.root_ppn, vaddr, pfn),
+            None => SwapOut::Keep,
+        };
+        match result {
+            SwapOut::Keep | SwapOut::Protected => restore_lazyfree_owner(page, owner),
+            SwapOut::Unmapped => drop(owner),
+            SwapOut::Removed => {
+                drop(owner);
+                clear_lazyfree(page, pfn);
+            }
+        }
+        result
+    }
+}
+
+/// try_to_migrate 的结果
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum MigratePage {
+    /// 页表项已改为指向新页，页的状态已转移；调用者刷新 TLB 后释放旧页
+    Moved,
+    /// 页表项原来可写，已改为只读 + COW；调用者刷新 TLB 后再次调用
+    Protected,
+    /// 暂时不能迁移（页表锁被占用、L0 页表共享、页有其他引用或已不在记录的位置）
+    Busy,
+}
+
+/// 页表锁内把 vaddr 处映射 pfn 的页表项迁移到 new_pfn (try_to_migrate_one + remove_migration_pte)
+unsafe fn migrate_pte(root_ppn: u64, vaddr: usize, pfn: usize, new_pfn: usize) -> MigratePage {
+    let (table1, vpn1) = match l1_entry(root_ppn, vaddr, false) {
+        Some(entry) => entry,
+        None => return MigratePage::Busy,
+    };
+    let pte1 = (*table1).get(vpn1);
+    if !pte1.is_valid() || pte1.is_leaf() || pte1.bits() & shared_flags::SHARED != 0 {
+        return MigratePage::Busy;
+    }
+    let table0 = (pte1.ppn() << PAGE_SHIFT) as *mut PageTable;
+    let vpn0 = (vaddr >> 12) & 0x1FF;
+    let pte0 = (*table0).get(vpn0);
+    let page = crate::mm::page_desc::pfn_to_page(pfn);
+    if !pte0.is_valid() || pte0.ppn() != pfn as u64 || (*page).refcount() != 1 {
+        return MigratePage::Busy;
+    }
+    // 与换出相同：先写保护，刷新 TLB 后页内容才稳定；期间的写入经 COW 缺页在页表锁上等待
+    if pte0.is_writable() {
+        (*table0).set(vpn0, PageTableEntry::from_bits(pte0.bits() & !PageTableEntry::W | cow_flags::COW));
+        return MigratePage::Protected;
+    }
+    core::ptr::copy_nonoverlapping(
+        (pfn << PAGE_SHIFT) as *const u8,
+        (new_pfn << PAGE_SHIFT) as *mut u8,
+        PAGE_SIZE_USIZE,
+    );
+    (*table0).set(vpn0, PageTableEntry::from_bits(((new_pfn as u64) << 10) | (pte0.bits() & 0x3FF)));
+    MigratePage::Moved
+}
+
+/// 把一个匿名页迁移到 new_pfn，由内存规整调用 (migrate_pages)
+///
+/// 页必须带反向映射（可换出或惰性释放的匿名页），在所属地址空间的页表锁内
+/// 确认页只有这一个映射后复制内容、改写页表项，并把反向映射、LRU 状态和
+/// 内存控制组的计费转移到新页。可写的页先写保护，下一次调用时才复制。
+/// 不刷新 TLB、不释放旧页：调用者用 flush_tlb_all 批量刷新后释放
+pub fn try_to_migrate(pfn: usize, new_pfn: usize) -> MigratePage {
+    use crate::mm::page_desc::{pfn_to_page, PageFlag, PageType};
+
+    let page = pfn_to_page(pfn);
+    let new_page = pfn_to_page(new_pfn);
+    if page.is_null() || new_page.is_null() {
+        return MigratePage::Busy;
+    }
+    unsafe {
+        if (*page).page_type() != PageType::Anonymous {
+            return MigratePage::Busy;
+        }
+        let raw = (*page).take_private();
+        if raw == 0 {
+            return MigratePage::Busy;
+        }
+        let owner = Arc::from_raw(raw as *const PageTableLock);
+        let vaddr = (*page).index() * PAGE_SIZE_USIZE;
+        let result = match owner.try_lock() {
+            Some(_ptl) => {
+                let result = migrate_pte(owner.root_ppn, vaddr, pfn, new_pfn);
+                if result == MigratePage::Moved {
+                    // 锁内转移反向映射：之后的换出和 COW 缺页都只看到新页
+                    set_lazyfree_owner(new_page, &owner);
+                    (*new_page).set_index((*page).index());
+                    (*new_page).set_page_type(PageType::Anonymous);
+                    if (*page).test_flag(PageFlag::SwapBacked) {
+                        (*new_page).set_flag(PageFlag::SwapBacked);
+                    }
+                    (*new_page).set_memcg_data((*page).take_memcg_data());
+                }
+                result
+            }
+            None => MigratePage::Busy,
+        };
+        if result == MigratePage::Moved {
+            drop(owner);
+            if (*page).test_flag(PageFlag::Lru) {
+                crate::mm::vmscan::lru_cache_del(pfn);
+                crate::mm::vmscan::lru_cache_add(new_pfn);
+            }
+            (*page).set_page_type(PageType::Normal);
+            (*page).clear_flag(PageFlag::SwapBacked);
+        } else {
+            restore_lazyfree_owner(page, owner);
+        }
+        result
+    }
+}
+
+// ==================== 相同页合并 (KSM) ====================
 
-    if !pte2.is_valid() {
-        return false;
+/// 后台合并扫描使用的地址空间句柄 (ksm_mm_slot)
+///
+/// 持有地址空间页表锁的引用：地址空间释放后页表不回收，通过句柄访问页表始终安全，
+/// 页已不属于该地址空间时查找失败
+#[derive(Clone)]
+pub struct MmHandle(Arc<PageTableLock>);
+
+impl MmHandle {
+    /// 句柄的标识，同一个地址空间的句柄相同
+    pub fn id(&self) -> usize {
+        Arc::as_ptr(&self.0) as usize
     }
+}
 
-    let table1 = (pte2.ppn() << PAGE_SHIFT) as *const PageTable;
-    let pte1 = (*table1).get(vpn1);
+/// 页表锁内找到 vaddr 处可以合并的页表项 (follow_page)
+///
+/// 页必须是 owner 反向映射记录的、只有一个引用的私有匿名页，页表项可写或为 COW；
+/// 大页和 fork 共享的 L0 页表跳过
+unsafe fn ksm_pte(owner: &Arc<PageTableLock>, vaddr: usize) -> Option<(*mut PageTable, usize, PageTableEntry)> {
+    use crate::mm::page_desc::{pfn_to_page, PageType};
 
-    if !pte1.is_valid() {
-        return false;
+    let (table1, vpn1) = l1_entry(owner.root_ppn, vaddr, false)?;
+    let pte1 = (*table1).get(vpn1);
+    if !pte1.is_valid() || pte1.is_leaf() || pte1.bits() & shared_flags::SHARED != 0 {
+        return None;
     }
-
-    let table0 = (pte1.ppn() << PAGE_SHIFT) as *const PageTable;
+    let table0 = (pte1.ppn() << PAGE_SHIFT) as *mut PageTable;
+    let vpn0 = (vaddr >> 12) & 0x1FF;
     let pte0 = (*table0).get(vpn0);
+    if !pte0.is_valid() || !pte0.is_user() || (!pte0.is_writable() && pte0.bits() & cow_flags::COW == 0) {
+        return None;
+    }
+    let page = pfn_to_page(pte0.ppn() as usize);
+    if page.is_null()
+        || (*page).page_type() != PageType::Anonymous
+        || (*page).private() != Arc::as_ptr(owner) as usize
+        || (*page).index() != vaddr / PAGE_SIZE_USIZE
+        || (*page).refcount() != 1
+    {
+        return None;
+    }
+    Some((table0, vpn0, pte0))
+}
 
-    if !pte0.is_valid() {
-        return false;
+/// vaddr 处可以合并的页
+///
+/// # 返回
+/// 页号；页表锁被占用、没有映射或页不是本地址空间独有的私有匿名页时返回 None
+pub fn ksm_follow_page(mm: &MmHandle, vaddr: usize) -> Option<usize> {
+    let _ptl = mm.0.try_lock()?;
+    unsafe { ksm_pte(&mm.0, vaddr) }.map(|(_, _, pte)| pte.ppn() as usize)
+}
+
+/// 写保护待合并的页 (write_protect_page)
+///
+/// # 返回
+/// 页仍可合并时返回 Some，值表示是否去掉了写权限：为真时调用者刷新 TLB 后页内容才稳定
+pub fn ksm_write_protect(mm: &MmHandle, vaddr: usize, pfn: usize) -> Option<bool> {
+    let _ptl = mm.0.try_lock()?;
+    unsafe {
+        let (table0, vpn0, pte0) = ksm_pte(&mm.0, vaddr).filter(|(_, _, pte)| pte.ppn() == pfn as u64)?;
+        if !pte0.is_writable() {
+            return Some(false);
+        }
+        (*table0).set(vpn0, PageTableEntry::from_bits(pte0.bits() & !PageTableEntry::W | cow_flags::COW));
+        Some(true)
     }
+}
 
-    // 检查 COW 标志
-    (pte0.bits() & cow_flags::COW) != 0
+/// 把写保护过的页变成合并页，原映射保持只读 + COW (stable_tree_insert)
+///
+/// 页的反向映射和 LRU 状态清除，之后不再被换出或迁移；
+/// 任何映射写入时 handle_cow_fault 都复制出私有页
+pub fn ksm_promote_page(mm: &MmHandle, vaddr: usize, pfn: usize) -> bool {
+    let _ptl = match mm.0.try_lock() {
+        Some(ptl) => ptl,
+        None => return false,
+    };
+    unsafe {
+        match ksm_pte(&mm.0, vaddr) {
+            Some((_, _, pte0)) if pte0.ppn() == pfn as u64 && !pte0.is_writable() => {
+                let page = crate::mm::page_desc::pfn_to_page(pfn);
+                clear_lazyfree(page, pfn);
+                (*page).set_page_type(crate::mm::page_desc::PageType::Ksm);
+                true
+            }
+            _ => false,
+        }
+    }
+}
+
+/// 把 vaddr 处映射 pfn 的页换成内容相同的合并页 kpfn (replace_page)
+///
+/// 调用者已写保护 pfn 并刷新 TLB，持有 kpfn 的一个引用，成功时这个引用转给页表项。
+/// 页表锁内逐字节比较，相同才替换；不刷新 TLB、不释放 pfn：
+/// 调用者刷新 TLB 后归还 pfn 的引用
+pub fn ksm_replace_page(mm: &MmHandle, vaddr: usize, pfn: usize, kpfn: usize) -> bool {
+    let _ptl = match mm.0.try_lock() {
+        Some(ptl) => ptl,
+        None => return false,
+    };
+    unsafe {
+        let (table0, vpn0, pte0) = match ksm_pte(&mm.0, vaddr) {
+            Some((table0, vpn0, pte0)) if pte0.ppn() == pfn as u64 && !pte0.is_writable() => (table0, vpn0, pte0),
+            _ => return false,
+        };
+        let page = core::slice::from_raw_parts((pfn << PAGE_SHIFT) as *const u8, PAGE_SIZE_USIZE);
+        let kpage = core::slice::from_raw_parts((kpfn << PAGE_SHIFT) as *const u8, PAGE_SIZE_USIZE);
+        if page != kpage {
+            return false;
+        }
+        (*table0).set(vpn0, PageTableEntry::from_bits(((kpfn as u64) << 10) | (pte0.bits() & 0x3FF) | cow_flags::COW));
+        clear_lazyfree(crate::mm::page_desc::pfn_to_page(pfn), pfn);
+        true
+    }
 }
 
 /// 页面错误类型标志
@@ -1963,6 +4435,61 @@ pub enum MmFaultResult {
     CowPending,
 }
 
+/// PSS 的小数位数 (PSS_SHIFT)
+pub const PSS_SHIFT: u32 = 12;
+
+/// 一个 VMA 的驻留内存统计，单位字节 (mem_size_stats)
+///
+/// 没有维护 mapcount，共享者数取页（大页取首页）的引用计数
+#[derive(Debug, Clone, Copy, Default)]
+pub struct MemSizeStats {
+    pub resident: u64,
+    /// 按共享者数均摊的驻留大小，带 PSS_SHIFT 位小数
+    pub pss: u64,
+    pub shared_clean: u64,
+    pub shared_dirty: u64,
+    pub private_clean: u64,
+    pub private_dirty: u64,
+    pub referenced: u64,
+    pub anonymous: u64,
+    /// 换出到 zswap 的大小
+    pub swap: u64,
+}
+
+impl MemSizeStats {
+    /// 计入一个页表项映射的 size 字节 (smaps_account)
+    unsafe fn account(&mut self, pte: PageTableEntry, size: u64, file_backed: bool) {
+        if is_zero_page_ppn(pte.ppn()) {
+            return;
+        }
+        let page = crate::mm::page_desc::pfn_to_page(pte.ppn() as usize);
+        let (anon, sharers) = if page.is_null() {
+            (!file_backed, 1)
+        } else {
+            let anon = !file_backed || (*page).is_anonymous();
+            // 页缓存中的页有一个引用属于页缓存
+            let cache_ref = if anon { 0 } else { 1 };
+            (anon, ((*page).refcount() - cache_ref).max(1) as u64)
+        };
+        let dirty = pte.bits() & PageTableEntry::D != 0;
+
+        self.resident += size;
+        self.pss += (size << PSS_SHIFT) / sharers;
+        if pte.bits() & PageTableEntry::A != 0 {
+            self.referenced += size;
+        }
+        if anon {
+            self.anonymous += size;
+        }
+        match (sharers > 1, dirty) {
+            (true, true) => self.shared_dirty += size,
+            (true, false) => self.shared_clean += size,
+            (false, true) => self.private_dirty += size,
+            (false, false) => self.private_clean += size,
+        }
+    }
+}
+
 /// 处理页面错误（按需分页）
 ///
 ///
@@ -1978,16 +4505,57 @@ pub enum MmFaultResult {
 /// 1. 查找 VMA 验证地址有效性和权限
 /// 2. 检查页面是否已映射
 /// 3. 如果是 COW 页，返回 CowPending
-/// 4. 如果未映射，分配新页面（匿名页面清零）
+/// 4. 匿名私有映射的读缺页映射共享零页
+/// 5. 其他情况分配新页面（匿名页面清零，优先取自预清零页池）
 /// 5. 更新页表，设置正确的权限位
+///
+/// VMA 不加锁查找 (lock_vma_under_rcu)，其他线程的 mmap/munmap 不阻塞缺页；
+/// 安装页表项前在页表锁内确认 VMA 未被修改，否则不安装并按新的 VMA 重新处理
 pub fn handle_mm_fault(
     addr_space: &AddressSpace,
     fault_addr: VirtAddr,
     flags: u32,
 ) -> MmFaultResult {
-    use crate::mm::page::alloc_frame;
-    use crate::mm::page::VirtAddr as PageVirtAddr;
-    use crate::mm::vma::VmaType;
+    loop {
+        let seq = addr_space.vma_seq_begin();
+        let result = do_handle_mm_fault(addr_space, fault_addr, flags, seq);
+        if result != MmFaultResult::Handled
+            || !addr_space.vma_seq_retry(seq)
+            || unsafe { PageTableWalker::walk(addr_space.root_ppn, fault_addr.bits()) }.is_some()
+        {
+            return result;
+        }
+        NR_FAULT_RETRIES.fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+/// 因 VMA 并发修改而重新处理的缺页次数
+static NR_FAULT_RETRIES: AtomicUsize = AtomicUsize::new(0);
+
+/// 因 VMA 并发修改而重新处理的缺页次数
+pub fn nr_fault_retries() -> usize {
+    NR_FAULT_RETRIES.load(Ordering::Relaxed)
+}
+
+/// 本次缺页读入了文件页或换入了页 (VM_FAULT_MAJOR)
+///
+/// 记在当前任务上，处理成功后由 Task::account_fault 计为 maj_flt
+fn mark_fault_major() {
+    if let Some(task) = crate::sched::current() {
+        task.acct.fault_major.store(true, Ordering::Relaxed);
+    }
+}
+
+/// 按 seq 时的 VMA 处理一次缺页
+///
+/// VMA 已被修改时不安装页表项，返回 Handled 由 handle_mm_fault 重试
+fn do_handle_mm_fault(
+    addr_space: &AddressSpace,
+    fault_addr: VirtAddr,
+    flags: u32,
+    seq: usize,
+) -> MmFaultResult {
+    use crate::mm::memcontrol::{mem_cgroup_alloc_page, MemcgStat};
 
     // 转换为 mm::page::VirtAddr（VmaManager 使用的类型）
     let page_virt_addr = PageVirtAddr::new(fault_addr.as_usize());
@@ -1998,9 +4566,14 @@ pub fn handle_mm_fault(
         PageTableWalker::walk(root_ppn, fault_addr.bits() as u64).is_some()
     };
 
-    // 如果页面已映射，先检查是否是 COW
+    // 如果页面已映射，先检查共享可写映射的写保护，再检查是否是 COW
     if already_mapped {
         let is_write = flags & FaultFlags::WRITE != 0;
+        if is_write {
+            if let Some(result) = do_shared_wp_page(addr_space, fault_addr, seq) {
+                return result;
+            }
+        }
         if is_write && unsafe { is_cow_page(root_ppn, fault_addr) } {
             return MmFaultResult::CowPending;
         }
@@ -2009,10 +4582,11 @@ pub fn handle_mm_fault(
         return MmFaultResult::AlreadyMapped;
     }
 
-    // 1. 查找 VMA
-    let vma_mgr = addr_space.vma_read();
-    let vma = match vma_mgr.find(page_virt_addr) {
+    // 1. 查找 VMA（不加锁）
+    let vma = match addr_space.find_vma_rcu(page_virt_addr) {
         Some(v) => v,
+        // 查找期间 VMA 被修改：快照可能还没有新映射的 VMA
+        None if addr_space.vma_seq_retry(seq) => return MmFaultResult::Handled,
         None => {
             // 地址不在任何 VMA 中，且页面未映射
             return MmFaultResult::Segfault;
@@ -2038,41 +4612,65 @@ pub fn handle_mm_fault(
         return MmFaultResult::PermissionDenied;
     }
 
-    // 释放读锁，后续可能需要写操作
-    drop(vma_mgr);
+    // 换出的页：从 zswap 换入 (do_swap_page)
+    if let Some(pte) = unsafe { swap_pte_at(root_ppn, fault_addr.as_usize()) } {
+        return do_swap_page(addr_space, &vma, pte, fault_addr, seq);
+    }
+
+    // 2MB 对齐区域整块落在匿名 VMA 中：直接映射大页 (do_huge_pmd_anonymous_page)
+    // MAP_HUGETLB 映射任何缺页都使用大页；透明大页只在写缺页时分配，读缺页仍映射零页
+    let haddr = fault_addr.as_usize() & !(HPAGE_SIZE - 1);
+    let huge_ok = vma.flags().contains(VmaFlags::HUGETLB) || (is_write && thp_vma_allowable(&vma));
+    if huge_ok && thp_suitable(&vma, haddr) {
+        if let Some(result) = do_huge_anonymous_page(addr_space, &vma, haddr, seq) {
+            return result;
+        }
+    }
+
+    // 3. 匿名私有映射的读缺页：映射只读零页，不分配物理页 (do_anonymous_page)
+    //    可写 VMA 的零页带 COW 标志，第一次写入时由 handle_cow_fault 换成私有页
+    if !is_write && vma_type == VmaType::Anonymous && !vma_flags.is_shared() {
+        let mut pte_flags = PageTableEntry::V | PageTableEntry::A | PageTableEntry::U | PageTableEntry::R;
+        if vma_flags.is_executable() {
+            pte_flags |= PageTableEntry::X;
+        }
+        if vma_flags.is_writable() {
+            pte_flags |= cow_flags::COW;
+        }
+
+        let _ptl = addr_space.page_table_lock.lock();
+        if !addr_space.vma_seq_retry(seq) && unsafe { pte_none(root_ppn, fault_addr.as_usize()) } {
+            unsafe {
+                map_page(root_ppn, fault_addr, PhysAddr::new(zero_page_ppn() << PAGE_SHIFT), pte_flags);
+            }
+            count_vm_event(VmEvent::ZeroPageMap);
+        }
+        return MmFaultResult::Handled;
+    }
+
+    // 有页缓存的文件映射：映射共享的缓存页 (filemap_fault)
+    if vma_type == VmaType::FileBacked {
+        if let Some(mapping) = vma.mapping().and_then(crate::mm::filemap::find_mapping) {
+            return do_file_fault(addr_space, &vma, &mapping, fault_addr, is_write, seq);
+        }
+    }
 
     // 4. 分配新页面
-    let frame = match alloc_frame() {
+    //    匿名映射、共享内存和没有页缓存的文件映射（暂时）使用清零的页，优先取自预清零页池；
+    //    设备映射不清零，由驱动处理
+    let frame = if vma_type == VmaType::Device {
+        mem_cgroup_alloc_page(MemcgStat::Anon)
+    } else {
+        crate::mm::memcontrol::mem_cgroup_alloc_zeroed_page(MemcgStat::Anon)
+    };
+    let frame = match frame {
         Some(f) => f,
         None => return MmFaultResult::OutOfMemory,
     };
 
     let phys_addr = PhysAddr::new(frame.start_address().as_usize() as u64);
-    let page_ptr = frame.start_address().as_usize() as *mut u8;
-
-    // 5. 根据类型初始化页面内容
-    unsafe {
-        match vma_type {
-            VmaType::Anonymous => {
-                // 匿名映射：清零页面
-                core::ptr::write_bytes(page_ptr, 0, PAGE_SIZE_USIZE);
-            }
-            VmaType::FileBacked => {
-                // 文件映射：TODO - 从文件读取
-                // 暂时清零
-                core::ptr::write_bytes(page_ptr, 0, PAGE_SIZE_USIZE);
-            }
-            VmaType::Device => {
-                // 设备映射：不清零，由驱动处理
-            }
-            VmaType::SharedMemory => {
-                // 共享内存：清零
-                core::ptr::write_bytes(page_ptr, 0, PAGE_SIZE_USIZE);
-            }
-        }
-    }
 
-    // 6. 构建页表项标志
+    // 5. 构建页表项标志
     let mut pte_flags = PageTableEntry::V | PageTableEntry::A | PageTableEntry::D;
     pte_flags |= PageTableEntry::U; // 用户页面
 
@@ -2086,14 +4684,397 @@ pub fn handle_mm_fault(
         pte_flags |= PageTableEntry::X;
     }
 
-    // 7. 映射页面
+    // 6. 映射页面
+    // 持页表锁重新检查：其他 CPU 上的线程可能已为同一页处理了缺页
+    let _ptl = addr_space.page_table_lock.lock();
+    if addr_space.vma_seq_retry(seq) || !unsafe { pte_none(root_ppn, fault_addr.as_usize()) } {
+        crate::mm::pcp::free_user_page(frame);
+        return MmFaultResult::Handled;
+    }
     unsafe {
         map_page(root_ppn, fault_addr, phys_addr, pte_flags);
+        if vma_swappable(&vma) {
+            lru_add_anon(&addr_space.page_table_lock, frame.number, fault_addr.as_usize());
+        }
+    }
+
+    // 填满的 L0 页表合并为大页 (khugepaged collapse)
+    if thp_vma_allowable(&vma) && thp_suitable(&vma, haddr) {
+        unsafe { collapse_huge_page(addr_space, haddr, fault_addr.as_usize()) };
+    }
+
+    MmFaultResult::Handled
+}
+
+/// 换入一个换出的页 (do_swap_page)
+///
+/// 在页表锁外分配新页，锁内确认页表项仍是同一个交换项后解压、安装并释放交换槽；
+/// 共享的 L0 页表先复制为私有页表，副本中的交换项各持交换槽的一个引用。
+/// 换入的页由本地址空间独占，按 VMA 权限直接映射为可写，重新挂到 LRU 上
+fn do_swap_page(
+    addr_space: &AddressSpace,
+    vma: &Vma,
+    orig_pte: PageTableEntry,
+    fault_addr: VirtAddr,
+    seq: usize,
+) -> MmFaultResult {
+    use crate::mm::memcontrol::{mem_cgroup_alloc_page, MemcgStat};
 
-        // 刷新 TLB
-        core::arch::asm!("sfence.vma zero, zero");
+    let frame = match mem_cgroup_alloc_page(MemcgStat::Anon) {
+        Some(f) => f,
+        None => return MmFaultResult::OutOfMemory,
+    };
+    let root_ppn = addr_space.root_ppn();
+    let page_addr = fault_addr.as_usize() & !(PAGE_SIZE_USIZE - 1);
+
+    let _ptl = addr_space.page_table_lock.lock();
+    // 其他线程已经换入，或 munmap 已释放交换槽
+    let current = unsafe { swap_pte_at(root_ppn, page_addr) };
+    if addr_space.vma_seq_retry(seq) || current.map(|pte| pte.bits()) != Some(orig_pte.bits()) {
+        crate::mm::pcp::free_user_page(frame);
+        return MmFaultResult::Handled;
+    }
+    let offset = orig_pte.swap_offset();
+    if !crate::mm::zswap::zswap_load(offset, frame.number) {
+        crate::mm::pcp::free_user_page(frame);
+        return MmFaultResult::Segfault;
     }
 
+    let vma_flags = vma.flags();
+    let mut pte_flags = PageTableEntry::V | PageTableEntry::A | PageTableEntry::D | PageTableEntry::U;
+    if vma_flags.is_readable() {
+        pte_flags |= PageTableEntry::R;
+    }
+    if vma_flags.is_writable() {
+        pte_flags |= PageTableEntry::W;
+    }
+    if vma_flags.is_executable() {
+        pte_flags |= PageTableEntry::X;
+    }
+    unsafe {
+        map_page(root_ppn, VirtAddr::new(page_addr as u64), PhysAddr::new(frame.start_address().as_usize() as u64),
+                 pte_flags);
+    }
+    crate::mm::zswap::swap_free(offset);
+    if vma_swappable(vma) {
+        unsafe { lru_add_anon(&addr_space.page_table_lock, frame.number, page_addr) };
+    }
+    mark_fault_major();
     MmFaultResult::Handled
 }
 
+/// 2MB 区域 [haddr, haddr + HPAGE_SIZE) 是否整块落在匿名 VMA 中 (thp_vma_suitable)
+fn thp_suitable(vma: &Vma, haddr: usize) -> bool {
+    vma.vma_type() == VmaType::Anonymous
+        && !vma.flags().is_shared()
+        && haddr >= vma.start().as_usize()
+        && haddr + HPAGE_SIZE <= vma.end().as_usize()
+}
+
+/// 查找 haddr 所在的 L1 页表项，alloc 为真时按需分配 L1 页表
+unsafe fn l1_entry(root_ppn: u64, haddr: usize, alloc: bool) -> Option<(*mut PageTable, usize)> {
+    let vpn2 = (haddr >> 30) & 0x1FF;
+    let vpn1 = (haddr >> 21) & 0x1FF;
+    let root = (root_ppn << PAGE_SHIFT) as *mut PageTable;
+    let pte2 = (*root).get(vpn2);
+    if pte2.is_valid() {
+        if pte2.is_leaf() {
+            return None;
+        }
+        return Some(((pte2.ppn() << PAGE_SHIFT) as *mut PageTable, vpn1));
+    }
+    if !alloc {
+        return None;
+    }
+    let table = alloc_page_table();
+    let ppn = (table as *const PageTable as u64) >> PAGE_SHIFT;
+    (*root).set(vpn2, PageTableEntry::new_table(ppn));
+    Some((table as *mut PageTable, vpn1))
+}
+
+/// virt 处换出页的页表项 (is_swap_pte)，不是换出页时返回 None
+unsafe fn swap_pte_at(root_ppn: u64, virt: usize) -> Option<PageTableEntry> {
+    let (table1, vpn1) = l1_entry(root_ppn, virt, false)?;
+    let pte1 = (*table1).get(vpn1);
+    if !pte1.is_valid() || pte1.is_leaf() {
+        return None;
+    }
+    let pte0 = (*((pte1.ppn() << PAGE_SHIFT) as *const PageTable)).get((virt >> 12) & 0x1FF);
+    pte0.is_swap().then_some(pte0)
+}
+
+/// virt 处既没有映射也不是换出页 (pte_none)，缺页处理在页表锁内安装页表项前检查
+#[inline]
+unsafe fn pte_none(root_ppn: u64, virt: usize) -> bool {
+    PageTableWalker::walk(root_ppn, virt as u64).is_none() && swap_pte_at(root_ppn, virt).is_none()
+}
+
+/// 匿名大页缺页 (do_huge_pmd_anonymous_page)
+///
+/// # 返回
+/// 该区域已有 4KB 映射或分配不到大页时返回 None，由调用者按 4KB 页处理
+fn do_huge_anonymous_page(addr_space: &AddressSpace, vma: &Vma, haddr: usize, seq: usize) -> Option<MmFaultResult> {
+    let root_ppn = addr_space.root_ppn();
+    // 已有 L0 页表（部分 4KB 映射）的区域不分配大页
+    if let Some((table1, vpn1)) = unsafe { l1_entry(root_ppn, haddr, false) } {
+        if unsafe { (*table1).get(vpn1) }.is_valid() {
+            return None;
+        }
+    }
+
+    let phys = alloc_huge_page()?;
+    for i in 0..HPAGE_NR {
+        unsafe { super::cpu::clear_page(phys as usize + i * PAGE_SIZE_USIZE) };
+    }
+
+    let vma_flags = vma.flags();
+    let mut pte_flags = PageTableEntry::V | PageTableEntry::A | PageTableEntry::D
+        | PageTableEntry::U | PageTableEntry::R;
+    if vma_flags.is_writable() {
+        pte_flags |= PageTableEntry::W;
+    }
+    if vma_flags.is_executable() {
+        pte_flags |= PageTableEntry::X;
+    }
+
+    let _ptl = addr_space.page_table_lock.lock();
+    if addr_space.vma_seq_retry(seq) {
+        free_huge_page(phys);
+        return Some(MmFaultResult::Handled);
+    }
+    match unsafe { l1_entry(root_ppn, haddr, true) } {
+        Some((table1, vpn1)) if !unsafe { (*table1).get(vpn1) }.is_valid() => unsafe {
+            map_megapage(root_ppn, haddr as u64, phys, pte_flags);
+            Some(MmFaultResult::Handled)
+        },
+        // 其他 CPU 已经映射了该区域，重新执行访问即可
+        Some(_) => {
+            free_huge_page(phys);
+            Some(MmFaultResult::Handled)
+        }
+        None => {
+            free_huge_page(phys);
+            None
+        }
+    }
+}
+
+/// 把填满的 L0 页表合并为一个 2MB 大页 (collapse_huge_page)
+///
+/// 512 个页表项都必须是可写、非 COW、引用计数为 1 的普通匿名页，且权限一致。
+/// 先清除 L1 项并刷新 TLB，再复制内容：其他 CPU 上的访问会缺页并在页表锁上等待。
+/// 调用者持有页表锁
+unsafe fn collapse_huge_page(addr_space: &AddressSpace, haddr: usize, fault_addr: usize) -> bool {
+    use crate::mm::page_desc::pfn_to_page_mut;
+
+    let (table1, vpn1) = match l1_entry(addr_space.root_ppn, haddr, false) {
+        Some(entry) => entry,
+        None => return false,
+    };
+    let pte1 = (*table1).get(vpn1);
+    if !pte1.is_valid() || pte1.is_leaf() || pte1.bits() & shared_flags::SHARED != 0 {
+        return false;
+    }
+    let table0 = (pte1.ppn() << PAGE_SHIFT) as *mut PageTable;
+
+    // 从缺页位置之后开始检查，顺序填充时第一项就能提前退出
+    let start = (fault_addr >> 12) & 0x1FF;
+    for k in 1..HPAGE_NR {
+        if !(*table0).get((start + k) % HPAGE_NR).is_valid() {
+            return false;
+        }
+    }
+
+    let perm = PageTableEntry::R | PageTableEntry::W | PageTableEntry::X | PageTableEntry::U;
+    let special = cow_flags::COW | shared_flags::SPECIAL;
+    let first = (*table0).get(0).bits() & perm;
+    for i in 0..HPAGE_NR {
+        let pte0 = (*table0).get(i);
+        if pte0.bits() & perm != first || !pte0.is_writable() || pte0.bits() & special != 0 {
+            return false;
+        }
+        let page = pfn_to_page_mut(pte0.ppn() as usize);
+        if page.is_null() || (*page).refcount() != 1 {
+            return false;
+        }
+    }
+
+    let new_phys = match alloc_huge_page() {
+        Some(phys) => phys,
+        None => return false,
+    };
+
+    (*table1).set(vpn1, PageTableEntry::new());
+    addr_space.flush_tlb_range(haddr, haddr + HPAGE_SIZE);
+
+    for i in 0..HPAGE_NR {
+        let old_ppn = (*table0).get(i).ppn();
+        core::ptr::copy_nonoverlapping(
+            (old_ppn << PAGE_SHIFT) as *const u8,
+            (new_phys as usize + i * PAGE_SIZE_USIZE) as *mut u8,
+            PAGE_SIZE_USIZE,
+        );
+        let page = pfn_to_page_mut(old_ppn as usize);
+        if (*page).page_type() == crate::mm::page_desc::PageType::Anonymous {
+            clear_lazyfree(page, old_ppn as usize);
+        }
+        crate::mm::pcp::free_user_page(crate::mm::page::PhysFrame::new(old_ppn as usize));
+    }
+
+    map_megapage(addr_space.root_ppn, haddr as u64, new_phys,
+                 first | PageTableEntry::V | PageTableEntry::A | PageTableEntry::D);
+    free_page_table(table0);
+    NR_COLLAPSED_HUGE_PAGES.fetch_add(1, Ordering::Relaxed);
+    true
+}
+
+/// 文件映射缺页 (do_read_fault / do_cow_fault)
+///
+/// 读缺页映射页缓存中的页，并一起映射 FAULT_AROUND_PAGES 对齐窗口内
+/// 尚未映射的相邻页 (do_fault_around)，窗口随 MADV_RANDOM/MADV_SEQUENTIAL 调整；
+/// 私有映射的写缺页复制一份私有页。
+/// 可写私有映射的缓存页带 COW 标志，第一次写入时由 handle_cow_fault 复制；
+/// 能回写的可写共享映射只在写缺页时映射为可写并标记脏页
+fn do_file_fault(
+    addr_space: &AddressSpace,
+    vma: &Vma,
+    mapping: &crate::mm::filemap::FileMapping,
+    fault_addr: VirtAddr,
+    is_write: bool,
+    seq: usize,
+) -> MmFaultResult {
+    use crate::mm::filemap::{FAULT_AROUND_PAGES, READAHEAD_PAGES};
+    use crate::mm::page_desc::pfn_to_page;
+    use crate::mm::memcontrol::{mem_cgroup_alloc_page, MemcgStat};
+    use crate::mm::pcp::free_user_page;
+
+    let root_ppn = addr_space.root_ppn();
+    let vma_flags = vma.flags();
+    let page_addr = fault_addr.as_usize() & !(PAGE_SIZE_USIZE - 1);
+    let pgoff = |addr: usize| (vma.offset() + (addr - vma.start().as_usize())) / PAGE_SIZE_USIZE;
+    // 缺页的页不在页缓存中，需要从数据来源读入 (VM_FAULT_MAJOR)
+    let major = mapping.find_page(pgoff(page_addr)).is_none();
+
+    let mut pte_flags = PageTableEntry::V | PageTableEntry::A | PageTableEntry::U;
+    if vma_flags.is_readable() {
+        pte_flags |= PageTableEntry::R;
+    }
+    if vma_flags.is_executable() {
+        pte_flags |= PageTableEntry::X;
+    }
+
+    // 私有映射的写缺页：复制缓存页 (do_cow_fault)
+    if is_write && !vma_flags.is_shared() {
+        // 复制期间持有缓存页的引用，防止被回收
+        let src = match mapping.grab_page(pgoff(page_addr)) {
+            Some(phys) => phys,
+            None => return MmFaultResult::Segfault,
+        };
+        let src_page = pfn_to_page(src / PAGE_SIZE_USIZE);
+        let frame = mem_cgroup_alloc_page(MemcgStat::Anon);
+        if let Some(ref frame) = frame {
+            unsafe {
+                core::ptr::copy_nonoverlapping(src as *const u8, frame.start_address().as_usize() as *mut u8,
+                                               PAGE_SIZE_USIZE);
+            }
+        }
+        if !src_page.is_null() {
+            unsafe { (*src_page).put_page() };
+        }
+        let frame = match frame {
+            Some(f) => f,
+            None => return MmFaultResult::OutOfMemory,
+        };
+        let dst = frame.start_address().as_usize();
+
+        let _ptl = addr_space.page_table_lock.lock();
+        if addr_space.vma_seq_retry(seq) || !unsafe { pte_none(root_ppn, page_addr) } {
+            free_user_page(frame);
+            return MmFaultResult::Handled;
+        }
+        unsafe {
+            map_page(root_ppn, VirtAddr::new(page_addr as u64), PhysAddr::new(dst as u64),
+                     pte_flags | PageTableEntry::W | PageTableEntry::D);
+            if vma_swappable(vma) {
+                lru_add_anon(&addr_space.page_table_lock, dst / PAGE_SIZE_USIZE, page_addr);
+            }
+        }
+        count_vm_event(VmEvent::CowFault);
+        if major {
+            mark_fault_major();
+        }
+        return MmFaultResult::Handled;
+    }
+
+    // 能回写的可写共享映射跟踪脏页 (do_shared_fault)：映射为只读，只有写缺页的页
+    // 直接可写并在页缓存中标记为脏，之后第一次写入只读页时由 do_shared_wp_page 处理
+    let track_dirty = vma_flags.is_shared() && vma_flags.is_writable() && mapping.can_writeback();
+    if vma_flags.is_writable() {
+        if !vma_flags.is_shared() {
+            pte_flags |= cow_flags::COW;
+        } else if !track_dirty {
+            pte_flags |= PageTableEntry::W | PageTableEntry::D;
+        }
+    }
+
+    // fault-around 窗口：按 FAULT_AROUND_PAGES 对齐，限制在 VMA 和文件范围内。
+    // MADV_RANDOM 只映射缺页的页；MADV_SEQUENTIAL 从缺页位置向后映射一个窗口，
+    // 并把窗口之后 READAHEAD_PAGES 页预读进页缓存 (page_cache_sync_readahead)
+    let window = FAULT_AROUND_PAGES * PAGE_SIZE_USIZE;
+    let window_start = if vma_flags.contains(VmaFlags::RAND_READ) || vma_flags.contains(VmaFlags::SEQ_READ) {
+        page_addr
+    } else {
+        page_addr & !(window - 1)
+    };
+    let window_end = if vma_flags.contains(VmaFlags::RAND_READ) {
+        page_addr + PAGE_SIZE_USIZE
+    } else {
+        window_start + window
+    };
+    if vma_flags.contains(VmaFlags::SEQ_READ) {
+        // 读入数据可能睡眠，在页表锁外进行
+        mapping.readahead(pgoff(page_addr), FAULT_AROUND_PAGES + READAHEAD_PAGES);
+    }
+    let start = window_start.max(vma.start().as_usize());
+    let end = window_end.min(vma.end().as_usize());
+    let nr_file_pages = mapping.nr_file_pages();
+
+    let _ptl = addr_space.page_table_lock.lock();
+    if addr_space.vma_seq_retry(seq) {
+        return MmFaultResult::Handled;
+    }
+    let mut addr = start;
+    while addr < end {
+        let index = pgoff(addr);
+        if index >= nr_file_pages {
+            break;
+        }
+        if unsafe { pte_none(root_ppn, addr) } {
+            // 每个映射持有缓存页的一个引用（在页缓存锁内获取）
+            match mapping.grab_page(index) {
+                Some(phys) => {
+                    let mut flags = pte_flags;
+                    if track_dirty && is_write && addr == page_addr {
+                        flags |= PageTableEntry::W | PageTableEntry::D;
+                        crate::mm::filemap::set_mapped_page_dirty(phys / PAGE_SIZE_USIZE);
+                    }
+                    unsafe {
+                        map_page(root_ppn, VirtAddr::new(addr as u64), PhysAddr::new(phys as u64), flags);
+                    }
+                }
+                None if addr == page_addr => return MmFaultResult::OutOfMemory,
+                None => {}
+            }
+        }
+        addr += PAGE_SIZE_USIZE;
+    }
+
+    // 缺页地址超出文件末尾 (SIGBUS)
+    if unsafe { PageTableWalker::walk(root_ppn, page_addr as u64) }.is_none() {
+        return MmFaultResult::Segfault;
+    }
+    if major {
+        mark_fault_major();
+    }
+    MmFaultResult::Handled
+}
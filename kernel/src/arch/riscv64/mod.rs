@@ -10,11 +10,20 @@
 pub mod boot;
 pub mod trap;
 pub mod context;
+pub mod fpu;
+pub mod percpu;
 pub mod cpu;
 pub mod syscall;
+pub mod syscall_stats;
+pub mod stacktrace;
+pub mod pmu;
 pub mod mm;
 pub mod smp;
 pub mod ipi;
+pub mod tlb;
+pub mod uaccess;
+pub mod string;
+pub mod vdso;
 
 use crate::println;
 use core::arch::asm;
@@ -0,0 +1,126 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 每 CPU 变量 (percpu)
+//!
+//! `percpu!` 定义的变量放在 `.percpu` 段中，这一段只是模板：
+//! 启动核在 boot.S 中为每个 hart 复制一份，得到各自的每 CPU 数据区
+//! (setup_per_cpu_areas)。数据区按缓存行对齐、大小是缓存行的整数倍，
+//! 不同 CPU 的变量不会落在同一缓存行里。
+//!
+//! 内核态的 tp 寄存器指向本 hart 的数据区（进入用户态时由 sscratch 保存），
+//! 访问本 CPU 的变量只需 tp 加上变量在模板中的偏移，不用先读 hart ID 再索引数组
+//! (this_cpu_ptr)。数据区的第一个字是 CPU 编号，cpu_id() 一次 load 得到。
+//!
+//! 模板本身从不被访问；访问本 CPU 的可变数据时调用方负责关中断或使用原子类型，
+//! 与以前按 cpu_id() 索引的静态数组相同。
+
+use core::ptr::addr_of;
+
+/// 缓存行大小，数据区按它对齐 (SMP_CACHE_BYTES)
+pub const PERCPU_ALIGN: usize = 64;
+
+extern "C" {
+    /// 模板起止地址（linker.ld）
+    static __per_cpu_start: u8;
+    static __per_cpu_end: u8;
+    /// 各 hart 的数据区，依次排列
+    static __per_cpu_areas: u8;
+}
+
+/// 每个 CPU 数据区的大小
+#[inline]
+pub fn percpu_size() -> usize {
+    unsafe { addr_of!(__per_cpu_end) as usize - addr_of!(__per_cpu_start) as usize }
+}
+
+/// CPU 的数据区相对模板的偏移 (__per_cpu_offset)
+#[inline]
+pub fn per_cpu_offset(cpu: usize) -> usize {
+    unsafe {
+        (addr_of!(__per_cpu_areas) as usize + cpu * percpu_size())
+            .wrapping_sub(addr_of!(__per_cpu_start) as usize)
+    }
+}
+
+/// 本 CPU 数据区的起始地址，即内核态的 tp
+#[inline(always)]
+pub fn this_cpu_base() -> usize {
+    let base: usize;
+    unsafe { core::arch::asm!("mv {}, tp", out(reg) base, options(nomem, nostack, pure)) };
+    base
+}
+
+/// 每 CPU 变量 (DEFINE_PER_CPU)
+///
+/// 由 `percpu!` 定义；静态变量本身是模板，通过 this_cpu / per_cpu 访问各 CPU 的副本
+#[repr(transparent)]
+pub struct PerCpu<T> {
+    template: T,
+}
+
+// 每个 CPU 只访问自己的副本，访问其他 CPU 的副本要求 T: Sync
+unsafe impl<T> Sync for PerCpu<T> {}
+
+impl<T> PerCpu<T> {
+    pub const fn new(template: T) -> Self {
+        Self { template }
+    }
+
+    /// 变量在数据区中的偏移
+    #[inline(always)]
+    fn offset(&self) -> usize {
+        addr_of!(self.template) as usize - unsafe { addr_of!(__per_cpu_start) as usize }
+    }
+
+    /// 本 CPU 的副本 (this_cpu_ptr)
+    ///
+    /// 指针只在不迁移到其他 CPU 期间（关中断或关抢占）指向本 CPU
+    #[inline(always)]
+    pub fn this_cpu_ptr(&self) -> *mut T {
+        (this_cpu_base() + self.offset()) as *mut T
+    }
+
+    /// 指定 CPU 的副本 (per_cpu_ptr)
+    #[inline]
+    pub fn per_cpu_ptr(&self, cpu: usize) -> *mut T {
+        (addr_of!(self.template) as usize).wrapping_add(per_cpu_offset(cpu)) as *mut T
+    }
+}
+
+impl<T: Sync> PerCpu<T> {
+    /// 本 CPU 的副本 (this_cpu_read / this_cpu_write 用于原子类型)
+    #[inline(always)]
+    pub fn this_cpu(&self) -> &T {
+        unsafe { &*self.this_cpu_ptr() }
+    }
+
+    /// 指定 CPU 的副本 (per_cpu)
+    #[inline]
+    pub fn per_cpu(&self, cpu: usize) -> &T {
+        unsafe { &*self.per_cpu_ptr(cpu) }
+    }
+}
+
+/// 定义每 CPU 变量 (DEFINE_PER_CPU)
+///
+/// ```no_run
+/// percpu! {
+///     /// 本 CPU 的计数
+///     static COUNT: AtomicUsize = AtomicUsize::new(0);
+/// }
+/// COUNT.this_cpu().fetch_add(1, Ordering::Relaxed);
+/// ```
+#[macro_export]
+macro_rules! percpu {
+    ($($(#[$attr:meta])* $vis:vis static $name:ident: $ty:ty = $init:expr;)+) => {
+        $(
+            $(#[$attr])*
+            #[link_section = ".percpu"]
+            $vis static $name: $crate::arch::riscv64::percpu::PerCpu<$ty> =
+                $crate::arch::riscv64::percpu::PerCpu::new($init);
+        )+
+    };
+}
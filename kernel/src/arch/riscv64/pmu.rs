@@ -0,0 +1,153 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 硬件性能计数器 (riscv_pmu)
+//!
+//! 参考 Linux: drivers/perf/riscv_pmu_sbi.c, drivers/perf/riscv_pmu_legacy.c
+//!
+//! cycle 与 instret 是架构规定的固定计数器，固件默认允许 S 模式读取，直接用
+//! rdcycle / rdinstret 读。其他硬件事件（缓存未命中）要通过 SBI PMU 扩展让固件
+//! 选一个可编程计数器 (mhpmcounterN) 配置并启动，之后按它的 CSR 编号读取；
+//! 固件没有 PMU 扩展或没有能计该事件的计数器时只有 cycle 与 instret，与 legacy 驱动相同。
+//!
+//! 计数器每个 hart 一套，启动时配置好后一直运行，不随任务切换启停：
+//! perf_event 在切换时读取当前值求差归属给任务，多个事件共用一个计数器也不需要轮换
+
+use core::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+
+use crate::config::MAX_CPUS;
+use crate::sbi::{
+    probe_extension, sbi_ecall, SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_CFG_MATCH, SBI_EXT_PMU_COUNTER_GET_INFO,
+    SBI_EXT_PMU_NUM_COUNTERS, SBI_SUCCESS,
+};
+
+/// 通用硬件事件 (enum perf_hw_id 的子集)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum HwEvent {
+    Cycles,
+    Instructions,
+    CacheMisses,
+}
+
+/// SBI 硬件事件编码 (SBI_PMU_HW_CACHE_MISSES)，事件类型 0 放在 event_idx 的高位
+const SBI_PMU_HW_CACHE_MISSES: usize = 4;
+
+/// counter_cfg_match 标志：清零并立即启动
+const SBI_PMU_CFG_FLAG_CLEAR_VALUE: usize = 1 << 1;
+const SBI_PMU_CFG_FLAG_AUTO_START: usize = 1 << 2;
+
+/// counter_get_info 返回值的最高位：固件计数器
+const SBI_PMU_CTR_INFO_FIRMWARE: usize = 1 << (usize::BITS - 1);
+
+/// 计数器 0-2 是 cycle / time / instret，可编程计数器从 3 开始
+const HPM_FIRST: usize = 3;
+
+/// hpmcounter3 - hpmcounter31 的 CSR 编号
+const CSR_HPMCOUNTER3: usize = 0xc03;
+const CSR_HPMCOUNTER31: usize = 0xc1f;
+
+/// 没有可用的计数器
+const NO_COUNTER: usize = 0;
+
+/// 固件是否实现 SBI PMU 扩展
+static SBI_PMU: AtomicBool = AtomicBool::new(false);
+
+/// 每个 hart 上计缓存未命中的计数器 CSR 编号
+static CACHE_MISS_CSR: [AtomicUsize; MAX_CPUS] = [const { AtomicUsize::new(NO_COUNTER) }; MAX_CPUS];
+
+/// 读取 hpmcounterN：CSR 编号必须是立即数，逐个展开
+macro_rules! read_hpm {
+    ($csr:expr; $($n:literal)*) => {
+        match $csr {
+            $($n => {
+                let value: u64;
+                unsafe { core::arch::asm!(concat!("csrr {}, ", stringify!($n)), out(reg) value, options(nomem, nostack)) };
+                value
+            })*
+            _ => 0,
+        }
+    };
+}
+
+fn read_hpm_csr(csr: usize) -> u64 {
+    read_hpm!(csr;
+        0xc03 0xc04 0xc05 0xc06 0xc07 0xc08 0xc09 0xc0a 0xc0b 0xc0c 0xc0d 0xc0e 0xc0f
+        0xc10 0xc11 0xc12 0xc13 0xc14 0xc15 0xc16 0xc17 0xc18 0xc19 0xc1a 0xc1b 0xc1c
+        0xc1d 0xc1e 0xc1f)
+}
+
+/// 启动核探测 SBI PMU 并配置本 hart 的计数器 (pmu_sbi_devinit)
+pub fn init() {
+    SBI_PMU.store(probe_extension(SBI_EXT_PMU), Ordering::Relaxed);
+    init_cpu(crate::arch::cpu_id() as usize);
+}
+
+/// 请固件为本 hart 分配一个计缓存未命中的计数器并启动 (pmu_sbi_starting_cpu)
+///
+/// 每个 hart 启动时调用一次；分配不到时该 hart 上的缓存未命中事件读数为 0
+pub fn init_cpu(cpu: usize) {
+    if cpu >= MAX_CPUS || !SBI_PMU.load(Ordering::Relaxed) {
+        return;
+    }
+    let num = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_NUM_COUNTERS, [0; 5]);
+    let num = if num.error == SBI_SUCCESS { num.value.min(usize::BITS as usize) } else { 0 };
+    if num <= HPM_FIRST {
+        return;
+    }
+    let all = if num == usize::BITS as usize { usize::MAX } else { (1 << num) - 1 };
+    let mask = all & !((1 << HPM_FIRST) - 1);
+    let flags = SBI_PMU_CFG_FLAG_CLEAR_VALUE | SBI_PMU_CFG_FLAG_AUTO_START;
+    let ret = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_CFG_MATCH, [0, mask, flags, SBI_PMU_HW_CACHE_MISSES, 0]);
+    if ret.error != SBI_SUCCESS {
+        return;
+    }
+    let info = sbi_ecall(SBI_EXT_PMU, SBI_EXT_PMU_COUNTER_GET_INFO, [ret.value, 0, 0, 0, 0]);
+    if info.error != SBI_SUCCESS || info.value & SBI_PMU_CTR_INFO_FIRMWARE != 0 {
+        return;
+    }
+    let csr = info.value & 0xfff;
+    if (CSR_HPMCOUNTER3..=CSR_HPMCOUNTER31).contains(&csr) {
+        CACHE_MISS_CSR[cpu].store(csr, Ordering::Relaxed);
+    }
+}
+
+/// 固件是否实现 SBI PMU 扩展
+pub fn sbi_pmu_available() -> bool {
+    SBI_PMU.load(Ordering::Relaxed)
+}
+
+/// 某个 CPU 上能否计数该事件
+pub fn event_supported(event: HwEvent, cpu: usize) -> bool {
+    match event {
+        HwEvent::Cycles | HwEvent::Instructions => true,
+        HwEvent::CacheMisses => cpu < MAX_CPUS && CACHE_MISS_CSR[cpu].load(Ordering::Relaxed) != NO_COUNTER,
+    }
+}
+
+/// 读取本 CPU 上该事件计数器的当前值 (riscv_pmu_event_update 读取的原始值)
+///
+/// 计数器单调增长，调用者对两次读数求差
+#[inline]
+pub fn read_counter(event: HwEvent) -> u64 {
+    match event {
+        HwEvent::Cycles => {
+            let value: u64;
+            unsafe { core::arch::asm!("rdcycle {}", out(reg) value, options(nomem, nostack)) };
+            value
+        }
+        HwEvent::Instructions => {
+            let value: u64;
+            unsafe { core::arch::asm!("rdinstret {}", out(reg) value, options(nomem, nostack)) };
+            value
+        }
+        HwEvent::CacheMisses => {
+            let cpu = crate::arch::cpu_id() as usize;
+            if cpu >= MAX_CPUS {
+                return 0;
+            }
+            read_hpm_csr(CACHE_MISS_CSR[cpu].load(Ordering::Relaxed))
+        }
+    }
+}
@@ -20,25 +20,23 @@ static ACTUAL_BOOT_HART: AtomicU32 = AtomicU32::new(u32::MAX);
 
 static SMP_INIT_DONE: AtomicU32 = AtomicU32::new(0);
 
-static CPU_STARTED: [AtomicU32; MAX_CPUS] = [
-    AtomicU32::new(0),
-    AtomicU32::new(0),
-    AtomicU32::new(0),
-    AtomicU32::new(0),
-];
+crate::percpu! {
+    /// CPU 是否已启动
+    static CPU_STARTED: AtomicU32 = AtomicU32::new(0);
+}
 
 fn mark_cpu_started(hart_id: usize) {
     if hart_id < MAX_CPUS {
-        CPU_STARTED[hart_id].store(1, Ordering::Release);
+        CPU_STARTED.per_cpu(hart_id).store(1, Ordering::Release);
     }
 }
 
 /// 获取当前 CPU 的硬件线程 ID
 ///
-/// 使用 tp 寄存器获取 hart ID：
-/// - boot.S 在启动时将 hart ID 保存到 tp 寄存器
+/// 内核态 tp 指向本 hart 的每 CPU 数据区 (percpu.rs)，第一个字是 hart ID：
+/// - boot.S 在启动时复制数据区、写入 hart ID 并设置 tp
 /// - trap.S 在 trap 处理时保存和恢复 tp 寄存器
-/// - 因此 tp 寄存器始终包含正确的 hart ID
+/// - 因此一次 load 就能得到正确的 hart ID
 ///
 /// 注意：
 /// - 不能使用 mhartid CSR（M-mode 专用，S-mode 访问会触发异常）
@@ -47,7 +45,7 @@ fn mark_cpu_started(hart_id: usize) {
 pub fn cpu_id() -> usize {
     unsafe {
         let hartid: u64;
-        asm!("mv {}, tp", out(reg) hartid, options(nomem, nostack, pure));
+        asm!("ld {}, 0(tp)", out(reg) hartid, options(readonly, nostack, pure));
         hartid as usize
     }
 }
@@ -153,7 +151,7 @@ pub fn init() -> bool {
 pub fn num_started_cpus() -> usize {
     let mut count = 0;
     for i in 0..MAX_CPUS {
-        if CPU_STARTED[i].load(Ordering::Acquire) == 1 {
+        if CPU_STARTED.per_cpu(i).load(Ordering::Acquire) == 1 {
             count += 1;
         }
     }
@@ -0,0 +1,65 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 栈回溯 (stacktrace)
+//!
+//! 参考 Linux: arch/riscv/kernel/stacktrace.c
+//!
+//! 内核以 force-frame-pointers 编译：每个函数的 s0 (fp) 等于进入函数时的 sp，
+//! fp - 8 保存返回地址，fp - 16 保存调用者的 fp。沿这条链可以在中断上下文中
+//! 回溯，不需要 DWARF 展开信息
+
+/// fp 下方的栈帧记录 (struct stackframe)
+#[repr(C)]
+struct StackFrame {
+    fp: usize,
+    ra: usize,
+}
+
+/// 当前函数的帧指针
+#[inline(always)]
+pub fn current_frame_pointer() -> usize {
+    let fp: usize;
+    unsafe { core::arch::asm!("mv {}, s0", out(reg) fp, options(nomem, nostack)) };
+    fp
+}
+
+/// 沿帧指针链回溯 (walk_stackframe)
+///
+/// 依次产生每一帧的 (fp, 返回地址)。fp 必须 8 字节对齐、落在 [low, high) 内
+/// 并且逐帧严格增长，否则停止，损坏的栈不会导致越界读取
+pub struct StackWalker {
+    fp: usize,
+    low: usize,
+    high: usize,
+}
+
+impl StackWalker {
+    /// # Safety
+    ///
+    /// [low, high) 必须是可读的内核栈
+    pub unsafe fn new(fp: usize, low: usize, high: usize) -> Self {
+        Self { fp, low, high }
+    }
+}
+
+impl Iterator for StackWalker {
+    type Item = (usize, usize);
+
+    fn next(&mut self) -> Option<(usize, usize)> {
+        let fp = self.fp;
+        let record = fp.checked_sub(core::mem::size_of::<StackFrame>())?;
+        if fp % 8 != 0 || record < self.low || fp > self.high {
+            return None;
+        }
+        let frame = unsafe { core::ptr::read(record as *const StackFrame) };
+        // 下一帧必须在更高的地址，否则是链的末尾或栈已损坏
+        self.fp = if frame.fp > fp { frame.fp } else { 0 };
+        if frame.ra == 0 {
+            return None;
+        }
+        Some((fp, frame.ra))
+    }
+}
@@ -0,0 +1,37 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内核字符串函数 (arch/riscv/include/asm/string.h)
+//!
+//! 参考 Linux: arch/riscv/lib/memcpy.S, memmove.S, memset.S, strlen.S
+//!
+//! memcpy / memmove / memset / memcmp / bcmp / strlen 由 string.S 实现，
+//! 强符号覆盖 compiler_builtins 中逐字节或对齐要求宽松的弱符号版本。
+//! 必须用汇编实现：Rust 写的复制循环会被编译器识别并替换回 memcpy 调用。
+//! 长度不小于 256 字节、地址都在用户地址空间之外且 CPU 支持向量扩展时使用 RVV，
+//! 否则按 8 字节字访问
+
+use core::sync::atomic::{AtomicBool, Ordering};
+
+core::arch::global_asm!(include_str!("string.S"));
+
+/// 字符串函数是否使用向量扩展，由 string.S 读取
+#[no_mangle]
+static __string_use_rvv: AtomicBool = AtomicBool::new(false);
+
+/// 根据 ISA 扩展选择实现，由 init_isa_extensions 调用
+pub fn init_string_ops() {
+    __string_use_rvv.store(super::cpu::has_vector(), Ordering::Relaxed);
+}
+
+/// 切换向量实现（CPU 不支持向量扩展时保持标量），供测试比较两种实现
+pub fn set_string_rvv(enable: bool) {
+    __string_use_rvv.store(enable && super::cpu::has_vector(), Ordering::Relaxed);
+}
+
+/// 字符串函数当前是否使用向量扩展
+pub fn string_rvv_enabled() -> bool {
+    __string_use_rvv.load(Ordering::Relaxed)
+}
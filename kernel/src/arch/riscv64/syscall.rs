@@ -14,9 +14,9 @@
 //! - 错误码: a0 设置为负数
 
 use core::arch::asm;
-use crate::println;
-use crate::debug_println;
+use crate::tracepoint;
 use crate::config::{USER_STACK_SIZE, USER_STACK_TOP};
+use crate::process::task::SchedPolicy;
 
 /// 时间值结构体 (struct timeval)
 ///
@@ -29,45 +29,47 @@ pub struct TimeVal {
 
 /// 文件描述符集 (fd_set)
 ///
-/// 简化实现：使用 u64 位图，最多支持 64 个文件描述符
+/// FD_SETSIZE 位的位图；内核只读写前 nfds 位所在的字
 #[repr(C)]
 #[derive(Debug, Copy, Clone, PartialEq)]
 pub struct FdSet {
-    pub fds_bits: [u64; 1],  // 简化：只支持 64 个 fd
+    pub fds_bits: [u64; FD_SET_WORDS],
 }
 
 impl FdSet {
     pub const fn new() -> Self {
-        Self { fds_bits: [0] }
+        Self { fds_bits: [0; FD_SET_WORDS] }
     }
 
     pub fn set(&mut self, fd: i32) {
-        if fd >= 0 && fd < 64 {
-            self.fds_bits[0] |= 1 << fd;
+        if fd >= 0 && fd < FD_SETSIZE {
+            self.fds_bits[fd as usize / 64] |= 1 << (fd % 64);
         }
     }
 
     pub fn clear(&mut self, fd: i32) {
-        if fd >= 0 && fd < 64 {
-            self.fds_bits[0] &= !(1 << fd);
+        if fd >= 0 && fd < FD_SETSIZE {
+            self.fds_bits[fd as usize / 64] &= !(1 << (fd % 64));
         }
     }
 
     pub fn is_set(&self, fd: i32) -> bool {
-        if fd >= 0 && fd < 64 {
-            (self.fds_bits[0] & (1 << fd)) != 0
+        if fd >= 0 && fd < FD_SETSIZE {
+            (self.fds_bits[fd as usize / 64] & (1 << (fd % 64))) != 0
         } else {
             false
         }
     }
 
     pub fn zero(&mut self) {
-        self.fds_bits[0] = 0;
+        self.fds_bits = [0; FD_SET_WORDS];
     }
 }
 
-/// select 系统调用的文件描述符数量限制
-const FD_SETSIZE: i32 = 64;
+/// select 系统调用的文件描述符数量限制 (__FD_SETSIZE)
+const FD_SETSIZE: i32 = 1024;
+/// fd_set 的字数
+const FD_SET_WORDS: usize = FD_SETSIZE as usize / 64;
 
 #[repr(C)]
 #[derive(Debug, Copy, Clone, PartialEq)]
@@ -115,6 +117,9 @@ pub enum SyscallNo {
     Gettimeofday = 169,
     ClockGettime = 113,
     ClockGetres = 114,
+    TimerfdCreate = 85,
+    TimerfdSettime = 86,
+    TimerfdGettime = 87,
 
     /// 网络操作
     Socket = 198,
@@ -215,91 +220,192 @@ impl Default for SyscallFrame {
     }
 }
 
+/// 系统调用处理函数 (sys_call_ptr_t)
+type SyscallFn = fn([u64; 6]) -> u64;
+
+/// 系统调用表项
+#[derive(Clone, Copy)]
+struct SyscallEntry {
+    /// 处理函数名，用于统计输出
+    name: &'static str,
+    handler: SyscallFn,
+}
+
+/// 系统调用号上界（不含），包括自定义的 500+ 调用
+pub const NR_SYSCALLS: usize = 512;
+
+/// 按编号填入系统调用表
+macro_rules! syscall_table {
+    ($($nr:literal => $handler:ident,)*) => {{
+        let mut table: [Option<SyscallEntry>; NR_SYSCALLS] = [None; NR_SYSCALLS];
+        $(table[$nr] = Some(SyscallEntry { name: stringify!($handler), handler: $handler });)*
+        table
+    }};
+}
+
+/// 系统调用表 (sys_call_table)，按系统调用号索引
+static SYS_CALL_TABLE: [Option<SyscallEntry>; NR_SYSCALLS] = syscall_table! {
+    2 => sys_open,
+    7 => sys_poll,
+    19 => sys_eventfd2,
+    20 => sys_epoll_create1,
+    21 => sys_epoll_ctl,
+    22 => sys_epoll_pwait,
+    23 => sys_dup,
+    24 => sys_dup2,
+    25 => sys_fcntl,
+    29 => sys_ioctl,
+    35 => sys_unlinkat,
+    46 => sys_ftruncate,
+    56 => sys_openat,
+    57 => sys_close,
+    59 => sys_pipe2,                    // pipe2 (supports flags)
+    61 => sys_getdents64,
+    63 => sys_read,
+    64 => sys_write,
+    65 => sys_readv,
+    66 => sys_writev,
+    67 => sys_pread64,
+    68 => sys_pwrite64,
+    69 => sys_preadv,
+    70 => sys_pwritev,
+    71 => sys_sendfile,
+    73 => sys_flock,
+    74 => sys_unlink,
+    75 => sys_vmsplice,
+    76 => sys_splice,
+    77 => sys_mkdir,
+    78 => sys_link,
+    79 => sys_newfstatat,
+    80 => sys_fstat,
+    81 => sys_sync,
+    82 => sys_fsync,
+    83 => sys_fdatasync,
+    84 => sys_sync_file_range,
+    85 => sys_timerfd_create,
+    86 => sys_timerfd_settime,
+    87 => sys_timerfd_gettime,
+    93 => sys_exit,
+    94 => sys_exit_group,
+    95 => sys_waitid,
+    96 => sys_set_tid_address,          // musl libc: set_tid_address
+    98 => sys_futex,
+    99 => sys_set_robust_list,          // musl libc: set_robust_list
+    101 => sys_nanosleep,               // 纳秒级睡眠
+    110 => sys_getppid,
+    113 => sys_clock_gettime,
+    116 => sys_syslog,
+    118 => sys_sched_setparam,
+    119 => sys_sched_setscheduler,
+    120 => sys_sched_getscheduler,
+    121 => sys_sched_getparam,
+    122 => sys_sched_setaffinity,
+    123 => sys_sched_getaffinity,
+    124 => sys_sched_yield,
+    125 => sys_sched_get_priority_max,
+    126 => sys_sched_get_priority_min,
+    129 => sys_kill,
+    134 => sys_rt_sigaction,
+    135 => sys_rt_sigprocmask,
+    139 => sys_rt_sigreturn,
+    160 => sys_uname,
+    165 => sys_getrusage,
+    169 => sys_gettimeofday,
+    172 => sys_getpid,
+    174 => sys_getuid,
+    175 => sys_geteuid,
+    176 => sys_getgid,
+    177 => sys_getegid,
+    178 => sys_gettid,
+    198 => sys_socket,
+    199 => sys_socketpair,
+    200 => sys_bind,
+    201 => sys_listen,
+    202 => sys_accept,
+    203 => sys_connect,
+    204 => sys_getsockname,
+    205 => sys_getpeername,
+    206 => sys_sendto,
+    207 => sys_recvfrom,
+    208 => sys_setsockopt,
+    209 => sys_getsockopt,
+    210 => sys_shutdown,
+    211 => sys_sendmsg,
+    212 => sys_recvmsg,
+    214 => sys_brk,
+    215 => sys_munmap,
+    216 => sys_mremap,
+    220 => sys_clone,
+    221 => sys_execve,
+    222 => sys_mmap,
+    223 => sys_fadvise64,
+    226 => sys_mprotect,
+    227 => sys_msync,
+    228 => sys_mlock,
+    229 => sys_munlock,
+    232 => sys_mincore,
+    233 => sys_madvise,
+    241 => sys_perf_event_open,
+    243 => sys_recvmmsg,
+    260 => sys_wait4,
+    269 => sys_sendmmsg,
+    280 => sys_select,
+    281 => sys_pselect6,
+    285 => sys_copy_file_range,
+    290 => sys_eventfd,                 // eventfd (可能需要确认)
+    291 => sys_statx,
+    425 => sys_io_uring_setup,
+    426 => sys_io_uring_enter,
+    434 => sys_pidfd_open,
+    435 => sys_clone3,
+    // 自定义系统调用 (500+)
+    500 => sys_read_input_event,        // 读取输入事件
+};
+
+/// 系统调用处理函数名，未实现的编号返回 None
+pub fn syscall_name(nr: usize) -> Option<&'static str> {
+    SYS_CALL_TABLE.get(nr).copied().flatten().map(|entry| entry.name)
+}
+
+/// 未实现的系统调用 (sys_ni_syscall)
+fn sys_ni_syscall(nr: u64) -> u64 {
+    tracepoint!(SYSCALL, "unknown syscall {}", nr);
+    -38_i64 as u64  // ENOSYS - 函数未实现
+}
+
 #[no_mangle]
 pub extern "C" fn syscall_handler(frame: &mut SyscallFrame) {
+    use crate::arch::riscv64::syscall_stats;
+
     let syscall_no = frame.a7;
     let args = [frame.a0, frame.a1, frame.a2, frame.a3, frame.a4, frame.a5];
 
-    // 调试输出（可选）
-    // println!("SYSCALL: no={}, args=[{:#x},{:#x},{:#x},{:#x},{:#x},{:#x}]",
-    //          syscall_no, args[0], args[1], args[2], args[3], args[4], args[5]);
-
-    // 根据系统调用号分发
-    frame.a0 = match syscall_no as u32 {
-        63 => sys_read(args),
-        64 => sys_write(args),
-        66 => sys_writev(args),       // RISC-V writev
-        2 => sys_open(args),          // RISC-V open
-        56 => sys_openat(args),
-        57 => sys_close(args),
-        93 => sys_exit(args),
-        94 => sys_exit(args),          // exit_group - 与 exit 相同
-        172 => sys_getpid(args),
-        110 => sys_getppid(args),
-        129 => sys_kill(args),
-        96 => sys_set_tid_address(args),   // musl libc: set_tid_address
-        99 => sys_set_robust_list(args),   // musl libc: set_robust_list
-        134 => { debug_println!("sys_rt_sigaction: not implemented"); -38_i64 as u64 },  // ENOSYS
-        135 => sys_rt_sigprocmask(args),  // RISC-V rt_sigprocmask
-        280 => sys_select(args),          // RISC-V select
-        281 => sys_pselect6(args),        // RISC-V pselect6
-        7 => sys_poll(args),              // RISC-V poll
-        20 => sys_epoll_create(args),     // RISC-V epoll_create (可能需要确认)
-        251 => sys_epoll_create1(args),   // RISC-V epoll_create1
-        21 => sys_epoll_ctl(args),        // RISC-V epoll_ctl (可能需要确认)
-        22 => sys_epoll_wait(args),       // RISC-V epoll_wait (可能需要确认)
-        252 => sys_epoll_pwait(args),     // RISC-V epoll_pwait
-        290 => sys_eventfd(args),         // RISC-V eventfd (可能需要确认)
-        291 => sys_eventfd2(args),        // RISC-V eventfd2
-        59 => sys_pipe2(args),            // RISC-V pipe2 (supports flags)
-        220 => sys_fork(args),
-        221 => sys_execve(args),
-        260 => sys_wait4(args),
-        160 => sys_uname(args),
-        174 => sys_getuid(args),
-        176 => sys_getgid(args),
-        175 => sys_geteuid(args),
-        177 => sys_getegid(args),
-        169 => sys_gettimeofday(args),
-        113 => sys_clock_gettime(args),
-        101 => sys_nanosleep(args),  // 纳秒级睡眠
-        23 => sys_dup(args),
-        24 => sys_dup2(args),
-        25 => sys_fcntl(args),
-        29 => sys_ioctl(args),          // RISC-V ioctl
-        73 => sys_flock(args),          // RISC-V flock
-        80 => sys_fstat(args),
-        61 => sys_getdents64(args),  // getdents64
-        77 => sys_mkdir(args),
-        79 => sys_rmdir(args),
-        74 => sys_unlink(args),
-        78 => sys_link(args),
-        214 => sys_brk(args),
-        222 => {
-            sys_mmap(args)
-        }
-        215 => sys_munmap(args),
-        226 => sys_mprotect(args),      // RISC-V mprotect
-        227 => sys_msync(args),         // RISC-V msync
-        216 => sys_mremap(args),        // RISC-V mremap
-        233 => sys_madvise(args),       // RISC-V madvise
-        232 => sys_mincore(args),       // RISC-V mincore
-        228 => sys_mlock(args),         // RISC-V mlock
-        229 => sys_munlock(args),       // RISC-V munlock
-        198 => sys_socket(args),
-        200 => sys_bind(args),
-        201 => sys_listen(args),
-        202 => sys_accept(args),
-        203 => sys_connect(args),
-        206 => sys_sendto(args),
-        207 => sys_recvfrom(args),
-        // 自定义系统调用 (500+)
-        500 => sys_read_input_event(args),  // 读取输入事件
-        _ => {
-            debug_println!("Unknown syscall: {}", syscall_no);
-            -38_i64 as u64  // ENOSYS - 函数未实现
+    tracepoint!(SYSCALL, "syscall no={}, args=[{:#x},{:#x},{:#x},{:#x},{:#x},{:#x}]",
+                syscall_no, args[0], args[1], args[2], args[3], args[4], args[5]);
+
+    // 按系统调用号查表分发
+    let entry = if syscall_no < NR_SYSCALLS as u64 {
+        SYS_CALL_TABLE[syscall_no as usize]
+    } else {
+        None
+    };
+    let handler = match entry {
+        Some(entry) => entry.handler,
+        None => {
+            frame.a0 = sys_ni_syscall(syscall_no);
+            return;
         }
     };
+
+    crate::trace_record!(TRACE_SYS_ENTER, syscall_no, args[0], args[1]);
+    if !syscall_stats::enabled() {
+        frame.a0 = handler(args);
+    } else {
+        let start = syscall_stats::rdcycle();
+        frame.a0 = handler(args);
+        syscall_stats::account(syscall_no as usize, syscall_stats::rdcycle().wrapping_sub(start));
+    }
+    crate::trace_record!(TRACE_SYS_EXIT, syscall_no, frame.a0, 0);
 }
 
 // ============================================================================
@@ -307,7 +413,7 @@ pub extern "C" fn syscall_handler(frame: &mut SyscallFrame) {
 // ============================================================================
 
 fn sys_read(args: [u64; 6]) -> u64 {
-    use crate::fs::get_file_fd;
+    use crate::fs::fdget;
     let fd = args[0] as usize;
     let buf = args[1] as *mut u8;
     let count = args[2] as usize;
@@ -332,9 +438,12 @@ fn sys_read(args: [u64; 6]) -> u64 {
     }
 
     unsafe {
-        match get_file_fd(fd) {
+        match fdget(fd) {
             Some(file) => {
                 let result = file.read(buf, count);
+                if let Some(current) = crate::sched::current() {
+                    current.account_read(result);
+                }
                 if result < 0 {
                     result as u32 as u64
                 } else {
@@ -347,7 +456,7 @@ fn sys_read(args: [u64; 6]) -> u64 {
 }
 
 fn sys_write(args: [u64; 6]) -> u64 {
-    use crate::fs::get_file_fd;
+    use crate::fs::fdget;
     let fd = args[0] as usize;
     let buf = args[1] as *const u8;
     let count = args[2] as usize;
@@ -359,23 +468,22 @@ fn sys_write(args: [u64; 6]) -> u64 {
     }
 
     unsafe {
-        // Special handling for stdout (1) and stderr (2) - write directly to UART
+        // 标准输出、标准错误直接写串口终端，复制进发送缓冲区即返回
         if fd == 1 || fd == 2 {
-            use crate::console::putchar;
             let slice = core::slice::from_raw_parts(buf, count);
-            for &b in slice {
-                // 换行符前加回车（终端需要）
-                if b == b'\n' {
-                    putchar(b'\r');
-                }
-                putchar(b);
+            let result = crate::drivers::tty::tty_write(slice, false);
+            if let Some(current) = crate::sched::current() {
+                current.account_write(result);
             }
-            return count as u64;
+            return result as u64;
         }
 
-        match get_file_fd(fd) {
+        match fdget(fd) {
             Some(file) => {
                 let result = file.write(buf, count);
+                if let Some(current) = crate::sched::current() {
+                    current.account_write(result);
+                }
                 if result < 0 {
                     result as u32 as u64  // 返回错误码
                 } else {
@@ -424,6 +532,11 @@ fn sys_writev(args: [u64; 6]) -> u64 {
     let mut total_written: isize = 0;
     let mut has_valid_iov = false;
 
+    // 标准输出、标准错误直接写串口，其他文件一次写出全部分段
+    if fd != 1 && fd != 2 {
+        return do_writev(fd, import_iovec(iov_ptr, iovcnt), None);
+    }
+
     unsafe {
         for i in 0..iovcnt {
             let iov = &*iov_ptr.add(i);
@@ -455,6 +568,193 @@ fn sys_writev(args: [u64; 6]) -> u64 {
     total_written as u64
 }
 
+/// 用户空间地址范围，与 sys_read / sys_write 的检查一致
+const USER_IO_START: usize = 0x10000;
+const USER_IO_END: usize = 0x8000_0000;
+
+/// 检查一段用户缓冲区 (import_ubuf)
+///
+/// # 返回
+/// 长度为 0 时没有分段；不在用户空间返回 EFAULT
+fn import_ubuf(base: usize, len: usize) -> Result<alloc::vec::Vec<(usize, usize)>, u64> {
+    if len == 0 {
+        return Ok(alloc::vec::Vec::new());
+    }
+    if len > isize::MAX as usize {
+        return Err(-22_i64 as u64);  // EINVAL
+    }
+    if base < USER_IO_START || base.checked_add(len).map_or(true, |end| end > USER_IO_END) {
+        return Err(-14_i64 as u64);  // EFAULT
+    }
+    Ok(alloc::vec![(base, len)])
+}
+
+/// 检查并取出用户的 iovec 数组 (import_iovec)
+///
+/// # 返回
+/// 各段的 (地址, 长度)；分段数超过 UIO_MAXIOV 或总长度溢出返回 EINVAL，
+/// 数组或某段不在用户空间返回 EFAULT
+fn import_iovec(iov_ptr: *const Iovec, iovcnt: usize) -> Result<alloc::vec::Vec<(usize, usize)>, u64> {
+    if iovcnt > crate::fs::file::UIO_MAXIOV {
+        return Err(-22_i64 as u64);  // EINVAL
+    }
+    let iov_addr = iov_ptr as usize;
+    let iov_end = iov_addr.checked_add(iovcnt * core::mem::size_of::<Iovec>());
+    if iovcnt > 0 && (iov_addr < USER_IO_START || iov_end.map_or(true, |end| end > USER_IO_END)) {
+        return Err(-14_i64 as u64);  // EFAULT
+    }
+
+    let mut segs = alloc::vec::Vec::with_capacity(iovcnt);
+    let mut total: usize = 0;
+    for i in 0..iovcnt {
+        let iov = unsafe { core::ptr::read_unaligned(iov_ptr.add(i)) };
+        if iov.iov_len == 0 {
+            continue;
+        }
+        total = match total.checked_add(iov.iov_len) {
+            Some(total) if total <= isize::MAX as usize => total,
+            _ => return Err(-22_i64 as u64),  // EINVAL
+        };
+        let base = iov.iov_base as usize;
+        if base < USER_IO_START || base.checked_add(iov.iov_len).map_or(true, |end| end > USER_IO_END) {
+            return Err(-14_i64 as u64);  // EFAULT
+        }
+        segs.push((base, iov.iov_len));
+    }
+    Ok(segs)
+}
+
+/// 把用户位置参数转换为文件位置，负数返回 EINVAL
+fn user_pos(pos: u64) -> Result<u64, u64> {
+    if (pos as i64) < 0 {
+        return Err(-22_i64 as u64);  // EINVAL
+    }
+    Ok(pos)
+}
+
+/// readv / preadv / pread64 的公共部分 (do_readv / do_preadv)
+///
+/// segs 是 import_iovec / import_ubuf 检查过的用户分段
+fn do_readv(fd: usize, segs: Result<alloc::vec::Vec<(usize, usize)>, u64>, pos: Option<u64>) -> u64 {
+    let segs = match segs {
+        Ok(segs) => segs,
+        Err(e) => return e,
+    };
+    let file = match unsafe { crate::fs::get_file_fd(fd) } {
+        Some(file) => file,
+        None => return -9_i64 as u64,  // EBADF
+    };
+    let mut bufs: alloc::vec::Vec<&mut [u8]> = segs
+        .iter()
+        .map(|&(base, len)| unsafe { core::slice::from_raw_parts_mut(base as *mut u8, len) })
+        .collect();
+    file.read_vec(&mut bufs, pos) as i64 as u64
+}
+
+/// writev / pwritev / pwrite64 的公共部分 (do_writev / do_pwritev)
+fn do_writev(fd: usize, segs: Result<alloc::vec::Vec<(usize, usize)>, u64>, pos: Option<u64>) -> u64 {
+    let segs = match segs {
+        Ok(segs) => segs,
+        Err(e) => return e,
+    };
+    let file = match unsafe { crate::fs::get_file_fd(fd) } {
+        Some(file) => file,
+        None => return -9_i64 as u64,  // EBADF
+    };
+    let bufs: alloc::vec::Vec<&[u8]> = segs
+        .iter()
+        .map(|&(base, len)| unsafe { core::slice::from_raw_parts(base as *const u8, len) })
+        .collect();
+    file.write_vec(&bufs, pos) as i64 as u64
+}
+
+/// sys_readv - 从文件描述符读入多个缓冲区
+///
+/// # 参数
+/// - args[0]: fd - 文件描述符
+/// - args[1]: iov - 指向 iovec 结构数组的指针
+/// - args[2]: iovcnt - iovec 数组的长度
+///
+/// # 返回
+/// 成功返回读取的总字节数，失败返回负错误码
+///
+/// - RISC-V: 65
+fn sys_readv(args: [u64; 6]) -> u64 {
+    do_readv(args[0] as usize, import_iovec(args[1] as *const Iovec, args[2] as usize), None)
+}
+
+/// sys_pread64 - 从指定位置读取，不改变文件位置
+///
+/// # 参数
+/// - args[0]: fd - 文件描述符
+/// - args[1]: buf - 缓冲区
+/// - args[2]: count - 最多读取的字节数
+/// - args[3]: pos - 文件位置
+///
+/// # 返回
+/// 成功返回读取的字节数，失败返回负错误码；管道等不可定位的文件返回 ESPIPE
+///
+/// - RISC-V: 67
+fn sys_pread64(args: [u64; 6]) -> u64 {
+    match user_pos(args[3]) {
+        Ok(pos) => do_readv(args[0] as usize, import_ubuf(args[1] as usize, args[2] as usize), Some(pos)),
+        Err(e) => e,
+    }
+}
+
+/// sys_pwrite64 - 写入指定位置，不改变文件位置
+///
+/// # 参数
+/// - args[0]: fd - 文件描述符
+/// - args[1]: buf - 缓冲区
+/// - args[2]: count - 写入的字节数
+/// - args[3]: pos - 文件位置
+///
+/// # 返回
+/// 成功返回写入的字节数，失败返回负错误码
+///
+/// - RISC-V: 68
+fn sys_pwrite64(args: [u64; 6]) -> u64 {
+    match user_pos(args[3]) {
+        Ok(pos) => do_writev(args[0] as usize, import_ubuf(args[1] as usize, args[2] as usize), Some(pos)),
+        Err(e) => e,
+    }
+}
+
+/// sys_preadv - 从指定位置读入多个缓冲区，不改变文件位置
+///
+/// # 参数
+/// - args[0]: fd, args[1]: iov, args[2]: iovcnt - 同 readv
+/// - args[3]: pos_l - 文件位置（64 位下即完整位置，args[4] 的高位不使用）
+///
+/// # 返回
+/// 成功返回读取的总字节数，失败返回负错误码
+///
+/// - RISC-V: 69
+fn sys_preadv(args: [u64; 6]) -> u64 {
+    match user_pos(args[3]) {
+        Ok(pos) => do_readv(args[0] as usize, import_iovec(args[1] as *const Iovec, args[2] as usize), Some(pos)),
+        Err(e) => e,
+    }
+}
+
+/// sys_pwritev - 把多个缓冲区写到指定位置，不改变文件位置
+///
+/// # 参数
+/// - args[0]: fd, args[1]: iov, args[2]: iovcnt - 同 writev
+/// - args[3]: pos_l - 文件位置
+///
+/// # 返回
+/// 成功返回写入的总字节数，失败返回负错误码
+///
+/// - RISC-V: 70
+fn sys_pwritev(args: [u64; 6]) -> u64 {
+    match user_pos(args[3]) {
+        Ok(pos) => do_writev(args[0] as usize, import_iovec(args[1] as *const Iovec, args[2] as usize), Some(pos)),
+        Err(e) => e,
+    }
+}
+
 /// sys_open - 打开文件
 ///
 /// # 参数
@@ -557,163 +857,379 @@ fn sys_flock(_args: [u64; 6]) -> u64 {
     0
 }
 
-fn sys_pipe(args: [u64; 6]) -> u64 {
-    sys_pipe2_impl(args, 0)
-}
-
-/// sys_pipe2 - 创建带有标志的管道
+/// sys_fadvise64 - 声明文件的访问模式
 ///
 /// # 参数
-/// - args[0]: pipefd - 指向存储两个文件描述符的数组
-/// - args[1]: flags - 标志位 (O_CLOEXEC, O_NONBLOCK, 等)
+/// - args[0]: fd - 文件描述符
+/// - args[1]: offset - 起始偏移
+/// - args[2]: len - 长度，0 表示到文件末尾
+/// - args[3]: advice - POSIX_FADV_*
 ///
 /// # 返回
 /// 成功返回 0，失败返回负错误码
 ///
-/// # 标志位
-/// - O_CLOEXEC (0x80000): exec() 时关闭文件描述符
-/// - O_NONBLOCK (0x800): 非阻塞模式
-fn sys_pipe2(args: [u64; 6]) -> u64 {
-    let pipefd_ptr = args[0] as *mut i32;
-    let flags = args[1] as u32;
+/// - RISC-V: 223
+///
+/// # 说明
+/// NORMAL/RANDOM/SEQUENTIAL 设置文件的预读方式，WILLNEED 立即预读，
+/// DONTNEED 丢弃范围内未被使用的缓存页
+fn sys_fadvise64(args: [u64; 6]) -> u64 {
+    let fd = args[0] as usize;
+    let offset = args[1] as i64;
+    let len = args[2] as i64;
+    let advice = args[3] as i32;
 
-    sys_pipe2_impl([pipefd_ptr as u64, flags as u64, args[2], args[3], args[4], args[5]], flags as u64)
+    if offset < 0 || len < 0 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    match crate::fs::file_fadvise(fd, offset as u64, len as u64, advice) {
+        Ok(()) => 0,
+        Err(e) => e as i64 as u64,
+    }
 }
 
-/// 管道系统调用的实现
-fn sys_pipe2_impl(args: [u64; 6], flags: u64) -> u64 {
-    let pipefd_ptr = args[0] as *mut i32;
+/// sys_sync - 把所有脏页和脏缓冲区写回存储
+///
+/// - RISC-V: 81
+fn sys_sync(_args: [u64; 6]) -> u64 {
+    crate::mm::writeback::sync_all();
+    let _ = crate::fs::ext4::sync_fs();
+    let _ = crate::fs::bio::sync_buffers();
+    0
+}
 
-    // 检查指针有效性（简化检查，只检查是否为 null）
-    if pipefd_ptr.is_null() {
-        return -14_i64 as u64;  // EFAULT
+/// sys_fsync - 把文件的脏页写回存储
+///
+/// # 参数
+/// - args[0]: fd - 文件描述符
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码
+///
+/// - RISC-V: 82
+fn sys_fsync(args: [u64; 6]) -> u64 {
+    match crate::fs::file_fsync(args[0] as usize) {
+        Ok(()) => 0,
+        Err(e) => e as i64 as u64,
     }
+}
 
-    // 解析标志位
-    const O_CLOEXEC: u32 = 0x80000;
-    const O_NONBLOCK: u32 = 0x800;
-
-    let _has_cloexec = (flags as u32) & O_CLOEXEC != 0;
-    let _has_nonblock = (flags as u32) & O_NONBLOCK != 0;
-
-    // 获取当前进程的 fdtable
-    let fdtable = match crate::sched::get_current_fdtable() {
-        Some(ft) => ft,
-        None => return -9_i64 as u64,  // EBADF
-    };
-
-    // 创建管道
-    let (read_file, write_file) = crate::fs::create_pipe();
-
-    // 分配文件描述符
-    let read_fd = match fdtable.alloc_fd() {
-        Some(fd) => fd,
-        None => {
-            println!("sys_pipe2: failed to alloc read fd");
-            return -24_i64 as u64;  // EMFILE - 进程打开文件数过多
-        }
-    };
-
-    let write_fd = match fdtable.alloc_fd() {
-        Some(fd) => fd,
-        None => {
-            println!("sys_pipe2: failed to alloc write fd");
-            // 释放已分配的读端（直接关闭文件描述符）
-            let _ = fdtable.close_fd(read_fd);
-            return -24_i64 as u64;  // EMFILE
-        }
-    };
-
-    // 设置文件描述符标志
-    if _has_cloexec {
-        // TODO: 实现 close-on-exec 标志
-        // 继续执行，不返回错误
+/// sys_fdatasync - 写回文件数据，只改变了时间戳时不等待元数据
+///
+/// # 参数
+/// - args[0]: fd - 文件描述符
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码
+///
+/// - RISC-V: 83
+fn sys_fdatasync(args: [u64; 6]) -> u64 {
+    match crate::fs::file_fdatasync(args[0] as usize) {
+        Ok(()) => 0,
+        Err(e) => e as i64 as u64,
     }
+}
 
-    // TODO: 实现 O_NONBLOCK 标志
-    if _has_nonblock {
-        // 继续执行，不返回错误
+/// sys_sync_file_range - 写回文件一段范围内的脏页
+///
+/// # 参数
+/// - args[0]: fd - 文件描述符
+/// - args[1]: offset - 起始偏移
+/// - args[2]: nbytes - 长度，0 表示到文件末尾
+/// - args[3]: flags - SYNC_FILE_RANGE_*
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码
+///
+/// - RISC-V: 84
+fn sys_sync_file_range(args: [u64; 6]) -> u64 {
+    match crate::fs::file_sync_range(args[0] as usize, args[1] as i64, args[2] as i64, args[3] as u32) {
+        Ok(()) => 0,
+        Err(e) => e as i64 as u64,
     }
+}
 
-    // 安装文件到 fdtable
-    if fdtable.install_fd(read_fd, read_file).is_err() {
-        let _ = fdtable.close_fd(read_fd);
-        let _ = fdtable.close_fd(write_fd);
-        return -9_i64 as u64;  // EBADF
+/// sys_ftruncate - 改变打开文件的大小
+///
+/// # 参数
+/// - args[0]: fd - 文件描述符
+/// - args[1]: length - 新的文件大小
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码
+///
+/// - RISC-V: 46
+fn sys_ftruncate(args: [u64; 6]) -> u64 {
+    match crate::fs::file_ftruncate(args[0] as usize, args[1] as i64) {
+        Ok(()) => 0,
+        Err(e) => e as i64 as u64,
     }
+}
 
-    if fdtable.install_fd(write_fd, write_file).is_err() {
-        let _ = fdtable.close_fd(read_fd);
-        let _ = fdtable.close_fd(write_fd);
-        return -9_i64 as u64;  // EBADF
+/// 读取用户传入的 loff_t 位置 (copy_from_user)
+///
+/// # 返回
+/// 指针为 NULL 时返回 Ok(None)；指针不在用户空间或位置为负返回负错误码
+fn get_user_loff(ptr: u64) -> Result<Option<u64>, u64> {
+    if ptr == 0 {
+        return Ok(None);
     }
-
-    // 将文件描述符写入用户空间
-    unsafe {
-        *pipefd_ptr.add(0) = read_fd as i32;
-        *pipefd_ptr.add(1) = write_fd as i32;
+    if ptr < 0x10000 || ptr + 8 > 0x8000_0000 {
+        return Err(-14_i64 as u64);  // EFAULT
+    }
+    let off = unsafe { core::ptr::read_unaligned(ptr as *const i64) };
+    if off < 0 {
+        return Err(-22_i64 as u64);  // EINVAL
     }
+    Ok(Some(off as u64))
+}
 
-    0  // 成功
+/// 把前进后的位置写回 get_user_loff 读取的地址 (copy_to_user)
+fn put_user_loff(ptr: u64, off: Option<u64>) {
+    if let Some(off) = off {
+        unsafe { core::ptr::write_unaligned(ptr as *mut i64, off as i64) };
+    }
 }
 
-/// sys_pselect6 - I/O 多路复用 (使用 sigmask)
+/// sys_sendfile - 在文件描述符之间传输数据，数据不经过用户内存
 ///
 /// # 参数
-/// - args[0]: nfds - 需要检查的最高文件描述符 + 1
-/// - args[1]: readfds - 可读文件描述符集合指针
-/// - args[2]: writefds - 可写文件描述符集合指针
-/// - args[3]: exceptfds - 异常文件描述符集合指针
-/// - args[4]: timeout - 超时时间 (TimeVal 指针)
-/// - args[5]: sigmask - 信号掩码指针
+/// - args[0]: out_fd - 目标（文件、管道或 TCP socket）
+/// - args[1]: in_fd - 来源，必须是有页缓存的文件
+/// - args[2]: offset - 来源位置指针，NULL 时使用并前进 in_fd 的文件位置
+/// - args[3]: count - 最多传输的字节数
 ///
 /// # 返回
-/// 成功返回就绪的文件描述符数量，超时返回 0，失败返回负错误码
+/// 成功返回传输的字节数，失败返回负错误码
 ///
-/// # 说明
-/// 这是一个简化实现，主要支持:
-/// - 检查文件描述符是否就绪
-/// - 超时机制
-/// - 返回修改后的 fd_sets
-fn sys_pselect6(args: [u64; 6]) -> u64 {
-    let nfds = args[0] as i32;
-    let readfds_ptr = args[1] as *mut FdSet;
-    let writefds_ptr = args[2] as *mut FdSet;
-    let exceptfds_ptr = args[3] as *mut FdSet;
-    let timeout_ptr = args[4] as *const TimeVal;
-    let _sigmask_ptr = args[5] as *const u64;  // sigmask 暂未使用
-
-    // 验证 nfds 范围
-    if nfds < 0 || nfds > FD_SETSIZE {
-        return -22_i64 as u64;  // EINVAL
+/// - RISC-V: 71
+fn sys_sendfile(args: [u64; 6]) -> u64 {
+    let mut off = match get_user_loff(args[2]) {
+        Ok(off) => off,
+        Err(e) => return e,
+    };
+    let ret = crate::fs::splice::do_sendfile(args[0] as usize, args[1] as usize, off.as_mut(), args[3] as usize);
+    put_user_loff(args[2], off);
+    match ret {
+        Ok(n) => n as u64,
+        Err(e) => e as i64 as u64,
     }
+}
 
-    // 检查指针有效性
-    if readfds_ptr.is_null() && writefds_ptr.is_null() && exceptfds_ptr.is_null() {
-        return -14_i64 as u64;  // EFAULT
+/// sys_splice - 在管道与文件之间传输数据
+///
+/// # 参数
+/// - args[0]: fd_in, args[1]: off_in - 来源及其位置指针（管道一端必须为 NULL）
+/// - args[2]: fd_out, args[3]: off_out - 目标及其位置指针
+/// - args[4]: len - 最多传输的字节数
+/// - args[5]: flags - SPLICE_F_*
+///
+/// # 返回
+/// 成功返回传输的字节数，失败返回负错误码
+///
+/// - RISC-V: 76
+fn sys_splice(args: [u64; 6]) -> u64 {
+    let mut off_in = match get_user_loff(args[1]) {
+        Ok(off) => off,
+        Err(e) => return e,
+    };
+    let mut off_out = match get_user_loff(args[3]) {
+        Ok(off) => off,
+        Err(e) => return e,
+    };
+    let ret = crate::fs::splice::do_splice(
+        args[0] as usize,
+        off_in.as_mut(),
+        args[2] as usize,
+        off_out.as_mut(),
+        args[4] as usize,
+        args[5] as u32,
+    );
+    put_user_loff(args[1], off_in);
+    put_user_loff(args[3], off_out);
+    match ret {
+        Ok(n) => n as u64,
+        Err(e) => e as i64 as u64,
     }
+}
+
+/// sys_vmsplice - 把用户内存写入管道
+///
+/// # 参数
+/// - args[0]: fd - 管道的写端
+/// - args[1]: iov - 指向 iovec 结构数组的指针
+/// - args[2]: nr_segs - iovec 数组的长度
+/// - args[3]: flags - SPLICE_F_*，SPLICE_F_GIFT 时整页的数据交出页而不复制
+///
+/// # 返回
+/// 成功返回写入的字节数，失败返回负错误码
+///
+/// - RISC-V: 75
+fn sys_vmsplice(args: [u64; 6]) -> u64 {
+    let fd = args[0] as usize;
+    let iov_ptr = args[1] as *const Iovec;
+    let nr_segs = args[2] as usize;
+    let flags = args[3] as u32;
 
-    // 读取原始 fd_sets
-    let mut original_readfds = FdSet::new();
-    let mut original_writefds = FdSet::new();
-    let mut original_exceptfds = FdSet::new();
+    const USER_START: usize = 0x10000;
+    const USER_END: usize = 0x8000_0000;
 
-    unsafe {
-        if !readfds_ptr.is_null() {
-            original_readfds = *readfds_ptr;
+    let iov_addr = iov_ptr as usize;
+    if iov_addr < USER_START || iov_addr >= USER_END {
+        return -14_i64 as u64; // EFAULT
+    }
+
+    let mut total: usize = 0;
+    for i in 0..nr_segs {
+        let iov = unsafe { &*iov_ptr.add(i) };
+        let base = iov.iov_base as usize;
+        if iov.iov_len == 0 {
+            continue;
+        }
+        if base < USER_START || base.saturating_add(iov.iov_len) > USER_END {
+            return -14_i64 as u64; // EFAULT
         }
-        if !writefds_ptr.is_null() {
-            original_writefds = *writefds_ptr;
+        let data = unsafe { core::slice::from_raw_parts(iov.iov_base, iov.iov_len) };
+        match crate::fs::splice::do_vmsplice(fd, data, flags) {
+            Ok(n) => {
+                total += n;
+                if n < iov.iov_len {
+                    break;
+                }
+            }
+            Err(e) => {
+                if total == 0 {
+                    return e as i64 as u64;
+                }
+                break;
+            }
         }
-        if !exceptfds_ptr.is_null() {
-            original_exceptfds = *exceptfds_ptr;
+    }
+    total as u64
+}
+
+/// sys_copy_file_range - 在两个文件之间复制数据，数据不经过用户内存
+///
+/// # 参数
+/// - args[0]: fd_in, args[1]: off_in - 来源及其位置指针
+/// - args[2]: fd_out, args[3]: off_out - 目标及其位置指针
+/// - args[4]: len - 最多复制的字节数
+/// - args[5]: flags - 必须为 0
+///
+/// # 返回
+/// 成功返回复制的字节数，失败返回负错误码
+///
+/// - RISC-V: 285
+fn sys_copy_file_range(args: [u64; 6]) -> u64 {
+    let mut off_in = match get_user_loff(args[1]) {
+        Ok(off) => off,
+        Err(e) => return e,
+    };
+    let mut off_out = match get_user_loff(args[3]) {
+        Ok(off) => off,
+        Err(e) => return e,
+    };
+    let ret = crate::fs::splice::copy_file_range(
+        args[0] as usize,
+        off_in.as_mut(),
+        args[2] as usize,
+        off_out.as_mut(),
+        args[4] as usize,
+        args[5] as u32,
+    );
+    put_user_loff(args[1], off_in);
+    put_user_loff(args[3], off_out);
+    match ret {
+        Ok(n) => n as u64,
+        Err(e) => e as i64 as u64,
+    }
+}
+
+/// sys_io_uring_setup - 创建异步 I/O 环
+///
+/// # 参数
+/// - args[0]: entries - SQ 条目数，向上取整到 2 的幂
+/// - args[1]: params - struct io_uring_params，返回时填入环的大小和各字段偏移
+///
+/// # 返回
+/// 成功返回环的文件描述符，之后用 mmap 映射 SQ/CQ 环和 SQE 数组
+fn sys_io_uring_setup(args: [u64; 6]) -> u64 {
+    use crate::fs::io_uring::{self, IoUringParams};
+
+    let ptr = args[1];
+    let size = core::mem::size_of::<IoUringParams>() as u64;
+    if ptr < 0x10000 || ptr + size > 0x8000_0000 {
+        return -14_i64 as u64;  // EFAULT
+    }
+    let params = unsafe { core::ptr::read_unaligned(ptr as *const IoUringParams) };
+    // 保留字段必须为 0
+    if params.resv.iter().any(|&r| r != 0) {
+        return -22_i64 as u64;  // EINVAL
+    }
+    match io_uring::io_uring_setup(args[0] as u32, &params) {
+        Ok((fd, out)) => {
+            unsafe { core::ptr::write_unaligned(ptr as *mut IoUringParams, out) };
+            fd as u64
         }
+        Err(e) => e as i64 as u64,
+    }
+}
+
+/// sys_io_uring_enter - 提交请求并等待完成
+///
+/// # 参数
+/// - args[0]: fd - io_uring_setup 返回的文件描述符
+/// - args[1]: to_submit - 要提交的 SQE 数
+/// - args[2]: min_complete - IORING_ENTER_GETEVENTS 时等待的完成项数
+/// - args[3]: flags - IORING_ENTER_*
+///
+/// # 返回
+/// 成功返回提交的 SQE 数
+fn sys_io_uring_enter(args: [u64; 6]) -> u64 {
+    match crate::fs::io_uring::io_uring_enter(args[0] as usize, args[1] as u32, args[2] as u32, args[3] as u32) {
+        Ok(n) => n as u64,
+        Err(e) => e as i64 as u64,
+    }
+}
+
+fn sys_pipe(args: [u64; 6]) -> u64 {
+    sys_pipe2_impl(args, 0)
+}
+
+/// sys_pipe2 - 创建带有标志的管道
+///
+/// # 参数
+/// - args[0]: pipefd - 指向存储两个文件描述符的数组
+/// - args[1]: flags - 标志位 (O_CLOEXEC, O_NONBLOCK, 等)
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码
+///
+/// # 标志位
+/// - O_CLOEXEC (0x80000): exec() 时关闭文件描述符
+/// - O_NONBLOCK (0x800): 非阻塞模式
+fn sys_pipe2(args: [u64; 6]) -> u64 {
+    let pipefd_ptr = args[0] as *mut i32;
+    let flags = args[1] as u32;
+
+    sys_pipe2_impl([pipefd_ptr as u64, flags as u64, args[2], args[3], args[4], args[5]], flags as u64)
+}
+
+/// 管道系统调用的实现
+fn sys_pipe2_impl(args: [u64; 6], flags: u64) -> u64 {
+    let pipefd_ptr = args[0] as *mut i32;
+
+    // 检查指针有效性（简化检查，只检查是否为 null）
+    if pipefd_ptr.is_null() {
+        return -14_i64 as u64;  // EFAULT
     }
 
-    // 创建返回的 fd_sets
-    let mut result_readfds = FdSet::new();
-    let mut result_writefds = FdSet::new();
-    let mut result_exceptfds = FdSet::new();
+    // 解析标志位
+    const O_CLOEXEC: u32 = 0x80000;
+    const O_NONBLOCK: u32 = 0x800;
+
+    let _has_cloexec = (flags as u32) & O_CLOEXEC != 0;
+    let _has_nonblock = (flags as u32) & O_NONBLOCK != 0;
 
     // 获取当前进程的 fdtable
     let fdtable = match crate::sched::get_current_fdtable() {
@@ -721,87 +1237,269 @@ fn sys_pselect6(args: [u64; 6]) -> u64 {
         None => return -9_i64 as u64,  // EBADF
     };
 
-    let mut ready_count = 0;
-
-    // 检查所有文件描述符
-    for fd in 0..nfds {
-        let mut is_readable = false;
-        let mut is_writable = false;
-        let mut has_exception = false;
-
-        // 检查文件描述符是否存在
-        let file_exists = fdtable.get_file(fd as usize).is_some();
+    // 创建管道
+    let (read_file, write_file) = crate::fs::create_pipe();
 
-        if !file_exists {
-            // 文件描述符不存在，跳过
-            continue;
+    // 分配文件描述符
+    let read_fd = match fdtable.alloc_fd() {
+        Some(fd) => fd,
+        None => {
+            tracepoint!(SYSCALL, "sys_pipe2: failed to alloc read fd");
+            return -24_i64 as u64;  // EMFILE - 进程打开文件数过多
         }
+    };
 
-        // 简化实现：
-        // 1. 对于 readfds: 所有有效的 fd 都认为是可读的
-        if original_readfds.is_set(fd) {
-            is_readable = true;
+    let write_fd = match fdtable.alloc_fd() {
+        Some(fd) => fd,
+        None => {
+            tracepoint!(SYSCALL, "sys_pipe2: failed to alloc write fd");
+            // 释放已分配的读端（直接关闭文件描述符）
+            let _ = fdtable.close_fd(read_fd);
+            return -24_i64 as u64;  // EMFILE
         }
+    };
 
-        // 2. 对于 writefds: 所有有效的 fd 都认为是可写的
-        if original_writefds.is_set(fd) {
-            is_writable = true;
-        }
+    // 设置文件描述符标志
+    if _has_cloexec {
+        // TODO: 实现 close-on-exec 标志
+        // 继续执行，不返回错误
+    }
 
-        // 3. 对于 exceptfds: 暂不实现异常检查
-        if original_exceptfds.is_set(fd) {
-            has_exception = false;  // 暂不支持异常
-        }
+    // TODO: 实现 O_NONBLOCK 标志
+    if _has_nonblock {
+        // 继续执行，不返回错误
+    }
 
-        // 设置返回的 fd_sets
-        if is_readable {
-            result_readfds.set(fd);
-            ready_count += 1;
-        }
-        if is_writable {
-            result_writefds.set(fd);
-            ready_count += 1;
-        }
-        if has_exception {
-            result_exceptfds.set(fd);
-            ready_count += 1;
-        }
+    // 安装文件到 fdtable
+    if fdtable.install_fd(read_fd, read_file).is_err() {
+        let _ = fdtable.close_fd(read_fd);
+        let _ = fdtable.close_fd(write_fd);
+        return -9_i64 as u64;  // EBADF
+    }
+
+    if fdtable.install_fd(write_fd, write_file).is_err() {
+        let _ = fdtable.close_fd(read_fd);
+        let _ = fdtable.close_fd(write_fd);
+        return -9_i64 as u64;  // EBADF
     }
 
-    // 将结果写回用户空间
+    // 将文件描述符写入用户空间
     unsafe {
-        if !readfds_ptr.is_null() {
-            *readfds_ptr = result_readfds;
+        *pipefd_ptr.add(0) = read_fd as i32;
+        *pipefd_ptr.add(1) = write_fd as i32;
+    }
+
+    0  // 成功
+}
+
+/// select 的公共部分 (core_sys_select)
+///
+/// 三个集合各复制进来一次（只复制 nfds 位所在的字），扫描与等待都在内核副本上进行，
+/// 结束后写回
+///
+/// # 参数
+/// - timeout_ms: 0 立即返回，负数一直等待
+fn core_sys_select(nfds: i32, fds_ptrs: [*mut u64; 3], timeout_ms: i64) -> u64 {
+    if nfds < 0 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    // 超过 FD_SETSIZE 的部分没有打开的文件，截断即可
+    let nfds = (nfds as usize).min(FD_SETSIZE as usize);
+    let words = (nfds + 63) / 64;
+
+    let mut sets: [alloc::vec::Vec<u64>; 3] = [alloc::vec::Vec::new(), alloc::vec::Vec::new(), alloc::vec::Vec::new()];
+    for (set, &ptr) in sets.iter_mut().zip(fds_ptrs.iter()) {
+        if ptr.is_null() {
+            continue;
+        }
+        if !user_range_ok(ptr as usize, words * 8) {
+            return -14_i64 as u64;  // EFAULT
         }
-        if !writefds_ptr.is_null() {
-            *writefds_ptr = result_writefds;
+        set.extend((0..words).map(|i| unsafe { core::ptr::read_unaligned(ptr.add(i)) }));
+    }
+
+    let [inp, outp, exp] = &mut sets;
+    let lookup = |fd: usize| unsafe { crate::fs::get_file_fd(fd) };
+    let ret = match crate::fs::select::do_select(nfds, [&mut inp[..], &mut outp[..], &mut exp[..]], lookup, timeout_ms) {
+        Ok(count) => count,
+        Err(e) => return e as i64 as u64,
+    };
+
+    for (set, &ptr) in sets.iter().zip(fds_ptrs.iter()) {
+        if ptr.is_null() {
+            continue;
         }
-        if !exceptfds_ptr.is_null() {
-            *exceptfds_ptr = result_exceptfds;
+        for (i, &word) in set.iter().enumerate() {
+            unsafe { core::ptr::write_unaligned(ptr.add(i), word) };
         }
     }
+    ret as u64
+}
 
-    ready_count as u64
+/// 由超时结构得到毫秒数，向上取整；空指针表示一直等待
+///
+/// # 参数
+/// - sub_unit: 第二个字段每毫秒的单位数（timeval 为 1000 微秒，timespec 为 1000000 纳秒）
+fn poll_timeout_ms(ptr: *const [i64; 2], sub_unit: i64) -> Result<i64, u64> {
+    if ptr.is_null() {
+        return Ok(-1);
+    }
+    if !user_range_ok(ptr as usize, 16) {
+        return Err(-14_i64 as u64);  // EFAULT
+    }
+    let [sec, sub] = unsafe { core::ptr::read_unaligned(ptr) };
+    if sec < 0 || sub < 0 || sub >= sub_unit * 1000 {
+        return Err(-22_i64 as u64);  // EINVAL
+    }
+    Ok(sec.saturating_mul(1000).saturating_add((sub + sub_unit - 1) / sub_unit))
 }
 
-/// sys_select - I/O 多路复用 (BSD 风格)
+/// sys_pselect6 - I/O 多路复用 (使用 sigmask)
 ///
 /// # 参数
 /// - args[0]: nfds - 需要检查的最高文件描述符 + 1
 /// - args[1]: readfds - 可读文件描述符集合指针
 /// - args[2]: writefds - 可写文件描述符集合指针
 /// - args[3]: exceptfds - 异常文件描述符集合指针
-/// - args[4]: timeout - 超时时间 (TimeVal 指针)
+/// - args[4]: timeout - 超时时间 (Timespec 指针)，空指针一直等待
+/// - args[5]: sigmask - 信号掩码指针
 ///
 /// # 返回
 /// 成功返回就绪的文件描述符数量，超时返回 0，失败返回负错误码
 ///
 /// # 说明
-/// select 是 pselect6 的简化版本，不使用信号掩码
-/// 实际调用 sys_pselect6 完成
+/// 信号掩码暂不支持
+fn sys_pselect6(args: [u64; 6]) -> u64 {
+    let nfds = args[0] as i32;
+    let fds_ptrs = [args[1] as *mut u64, args[2] as *mut u64, args[3] as *mut u64];
+    let timeout_ptr = args[4] as *const [i64; 2];
+    let _sigmask_ptr = args[5] as *const u64;  // sigmask 暂未使用
+
+    let timeout_ms = match poll_timeout_ms(timeout_ptr, 1_000_000) {
+        Ok(ms) => ms,
+        Err(e) => return e,
+    };
+    core_sys_select(nfds, fds_ptrs, timeout_ms)
+}
+
+/// sys_select - I/O 多路复用 (BSD 风格)
+///
+/// # 参数
+/// - args[0]: nfds - 需要检查的最高文件描述符 + 1
+/// - args[1]: readfds - 可读文件描述符集合指针
+/// - args[2]: writefds - 可写文件描述符集合指针
+/// - args[3]: exceptfds - 异常文件描述符集合指针
+/// - args[4]: timeout - 超时时间 (TimeVal 指针)，空指针一直等待
+///
+/// # 返回
+/// 成功返回就绪的文件描述符数量，超时返回 0，失败返回负错误码
 fn sys_select(args: [u64; 6]) -> u64 {
-    // select 是 pselect6 的特殊情况，sigmask 为 null
-    sys_pselect6([args[0], args[1], args[2], args[3], args[4], 0])
+    let nfds = args[0] as i32;
+    let fds_ptrs = [args[1] as *mut u64, args[2] as *mut u64, args[3] as *mut u64];
+    let timeout_ptr = args[4] as *const [i64; 2];
+
+    let timeout_ms = match poll_timeout_ms(timeout_ptr, 1_000) {
+        Ok(ms) => ms,
+        Err(e) => return e,
+    };
+    core_sys_select(nfds, fds_ptrs, timeout_ms)
+}
+
+/// 用户态 struct sigaction (include/uapi/asm-generic/signal.h，riscv 没有 sa_restorer)
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+struct UserSigAction {
+    handler: u64,
+    flags: u64,
+    mask: u64,
+}
+
+/// sys_rt_sigaction - 检查和更改信号处理动作
+///
+/// # 参数
+/// - args[0]: sig - 信号编号
+/// - args[1]: act - 新动作指针，NULL 时只查询
+/// - args[2]: oldact - 用于返回旧动作的指针，可以为 NULL
+/// - args[3]: sigsetsize - 信号集大小 (必须为 8)
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码
+fn sys_rt_sigaction(args: [u64; 6]) -> u64 {
+    use crate::arch::riscv64::uaccess::{get_user, put_user};
+    use crate::signal::{SigAction, SigFlags, UNBLOCKABLE};
+
+    let sig = args[0] as i32;
+    let act_ptr = args[1] as usize;
+    let oldact_ptr = args[2] as usize;
+    if args[3] != 8 {
+        return -22_i64 as u64;  // EINVAL
+    }
+
+    let act = if act_ptr != 0 {
+        match get_user::<UserSigAction>(act_ptr) {
+            Ok(act) => Some(SigAction {
+                sa_handler: act.handler as usize,
+                sa_flags: SigFlags::new(act.flags as u32),
+                sa_mask: act.mask & !UNBLOCKABLE,
+            }),
+            Err(e) => return e as i64 as u64,
+        }
+    } else {
+        None
+    };
+
+    let mut old = SigAction::new();
+    let ret = crate::signal::rt_sigaction(sig, act.as_ref(), Some(&mut old), 8);
+    if ret < 0 {
+        return ret as i64 as u64;
+    }
+
+    if oldact_ptr != 0 {
+        let oldact = UserSigAction {
+            handler: old.sa_handler as u64,
+            flags: old.sa_flags.bits() as u64,
+            mask: old.sa_mask,
+        };
+        if let Err(e) = put_user(oldact_ptr, &oldact) {
+            return e as i64 as u64;
+        }
+    }
+    0
+}
+
+/// sys_rt_sigreturn - 从信号处理函数返回
+///
+/// 由 vDSO 的 __vdso_rt_sigreturn 调用，此时用户 sp 指向 setup_rt_frame 建立的信号帧。
+/// 恢复信号帧中保存的寄存器和信号掩码，返回值就是被打断时的 a0
+///
+/// # 返回
+/// 恢复的 a0；信号帧不可读时发送 SIGSEGV
+fn sys_rt_sigreturn(_args: [u64; 6]) -> u64 {
+    use crate::arch::riscv64::trap::{current_trap_frame, TrapFrame};
+
+    let frame = current_trap_frame() as *mut TrapFrame;
+    if frame.is_null() {
+        return -14_i64 as u64;  // EFAULT
+    }
+    let task = match crate::sched::current() {
+        Some(t) => t,
+        None => return -1_i64 as u64,  // EPERM
+    };
+
+    unsafe {
+        match crate::signal::restore_sigcontext(task, frame) {
+            Ok(a0) => {
+                // trap 路径返回前会跳过 ecall，恢复的 sepc 是被打断的指令本身
+                (*frame).sepc = (*frame).sepc.wrapping_sub(4);
+                a0
+            }
+            Err(e) => {
+                // 信号帧损坏 (force_sig(SIGSEGV))
+                (*task).pending.add(crate::signal::Signal::SIGSEGV as i32);
+                e as i64 as u64
+            }
+        }
+    }
 }
 
 /// sys_rt_sigprocmask - 检查和更改阻塞的信号
@@ -885,9 +1583,12 @@ fn sys_rt_sigprocmask(args: [u64; 6]) -> u64 {
         _ => old_mask, // 不应该到达这里
     };
 
-    // 更新当前进程的信号掩码
+    // 更新当前进程的信号掩码，SIGKILL 和 SIGSTOP 不能被屏蔽
+    let result_mask = result_mask & !crate::signal::UNBLOCKABLE;
     unsafe {
         (*current).sigmask = result_mask;
+        // 解除屏蔽后已待处理的信号在返回用户模式时递送
+        (*current).pending.recalc(result_mask);
     }
 
     // 返回旧的信号掩码
@@ -900,212 +1601,90 @@ fn sys_rt_sigprocmask(args: [u64; 6]) -> u64 {
     0  // 成功
 }
 
-/// pollfd 结构体 (struct pollfd)
-///
-#[repr(C)]
-#[derive(Debug, Copy, Clone, PartialEq)]
-pub struct PollFd {
-    pub fd: i32,           // 文件描述符
-    pub events: u16,       // 请求的事件
-    pub revents: u16,      // 返回的事件
-}
-
-/// poll 事件类型
-pub mod poll_events {
-    pub const POLLIN: u16 = 0x0001;      // 可读
-    pub const POLLPRI: u16 = 0x0002;     // 紧急可读
-    pub const POLLOUT: u16 = 0x0004;     // 可写
-    pub const POLLERR: u16 = 0x0008;     // 错误
-    pub const POLLHUP: u16 = 0x0010;     // 挂断
-    pub const POLLNVAL: u16 = 0x0020;    // 无效请求
-    pub const POLLRDNORM: u16 = 0x0040;  // 等同于 POLLIN
-    pub const POLLRDBAND: u16 = 0x0080;  // 优先带数据可读
-    pub const POLLWRNORM: u16 = 0x0100;  // 等同于 POLLOUT
-    pub const POLLWRBAND: u16 = 0x0200;  // 优先带数据可写
-}
+pub use crate::fs::select::{poll_events, PollFd};
+
+/// poll 一次最多的描述符数 (RLIMIT_NOFILE)
+const POLL_MAX_NFDS: usize = 1024;
 
 /// sys_poll - I/O 多路复用 (poll 方式)
 ///
 /// # 参数
 /// - args[0]: fds - pollfd 数组指针
 /// - args[1]: nfds - pollfd 数组长度
-/// - args[2]: timeout - 超时时间（毫秒）
+/// - args[2]: timeout - 超时时间（毫秒），负数一直等待
 ///
 /// # 返回
 /// 成功返回就绪的文件描述符数量，超时返回 0，失败返回负错误码
 ///
 /// # 说明
-/// poll 比 select 更灵活，没有文件描述符数量限制
+/// pollfd 数组复制进来一次，返回前只写回 revents
 fn sys_poll(args: [u64; 6]) -> u64 {
-    use poll_events::*;
-
     let fds_ptr = args[0] as *mut PollFd;
     let nfds = args[1] as usize;
     let timeout_ms = args[2] as i32;
 
-    println!("sys_poll: fds={:#x}, nfds={}, timeout={}ms", fds_ptr as u64, nfds, timeout_ms);
+    tracepoint!(SYSCALL, "sys_poll: fds={:#x}, nfds={}, timeout={}ms", fds_ptr as u64, nfds, timeout_ms);
 
-    // 检查指针有效性
-    if fds_ptr.is_null() {
-        println!("sys_poll: fds is null");
+    if nfds > POLL_MAX_NFDS {
+        return -22_i64 as u64;  // EINVAL
+    }
+    let size = nfds * core::mem::size_of::<PollFd>();
+    if nfds > 0 && !user_range_ok(fds_ptr as usize, size) {
         return -14_i64 as u64;  // EFAULT
     }
+    let mut fds: alloc::vec::Vec<PollFd> = (0..nfds)
+        .map(|i| unsafe { core::ptr::read_unaligned(fds_ptr.add(i)) })
+        .collect();
 
-    // 检查 nfds 范围
-    if nfds == 0 || nfds > 1024 {  // 简化：最多支持 1024 个 fd
-        println!("sys_poll: invalid nfds {}", nfds);
-        return -22_i64 as u64;  // EINVAL
+    match crate::fs::vfs::io_poll(&mut fds, timeout_ms as i64) {
+        Ok(count) => {
+            for (i, pollfd) in fds.iter().enumerate() {
+                unsafe { core::ptr::write_unaligned(core::ptr::addr_of_mut!((*fds_ptr.add(i)).revents), pollfd.revents) };
+            }
+            count as u64
+        }
+        Err(e) => e as i64 as u64,
     }
+}
 
-    // 获取当前进程的 fdtable
-    let fdtable = match crate::sched::get_current_fdtable() {
-        Some(ft) => ft,
+pub use crate::fs::eventpoll::{epoll_ctl_ops, epoll_events, EPollEvent};
+
+/// 安装 epoll 文件 (do_epoll_create)
+fn epoll_install(cloexec: bool) -> u64 {
+    let file = crate::fs::eventpoll::epoll_create_file();
+    if cloexec {
+        file.set_cloexec(true);
+    }
+    match unsafe { crate::fs::file::get_file_fd_install(file.clone()) } {
+        Some(fd) => {
+            tracepoint!(SYSCALL, "epoll_create: created epoll fd {}", fd);
+            fd as u64
+        }
         None => {
-            println!("sys_poll: no fdtable");
-            return -9_i64 as u64;  // EBADF
+            crate::fs::file::fput(file);
+            -24_i64 as u64  // EMFILE
         }
-    };
-
-    let mut ready_count = 0;
-
-    // 检查所有文件描述符
-    for i in 0..nfds {
-        unsafe {
-            let pollfd = &mut *fds_ptr.add(i);
-            pollfd.revents = 0;  // 清空返回事件
-
-            // 检查文件描述符是否存在
-            let file_exists = fdtable.get_file(pollfd.fd as usize).is_some();
-
-            if !file_exists {
-                // 文件描述符不存在
-                pollfd.revents |= POLLNVAL;
-                ready_count += 1;
-                continue;
-            }
-
-            // 简化实现：
-            // 1. 对于 POLLIN: 所有有效的 fd 都认为是可读的
-            if pollfd.events & POLLIN != 0 {
-                pollfd.revents |= POLLIN | POLLRDNORM;
-                ready_count += 1;
-            }
-
-            // 2. 对于 POLLOUT: 所有有效的 fd 都认为是可写的
-            if pollfd.events & POLLOUT != 0 {
-                pollfd.revents |= POLLOUT | POLLWRNORM;
-                ready_count += 1;
-            }
-
-            // 3. 对于 POLLPRI: 暂不支持
-            // 4. 暂不设置 POLLERR/POLLHUP
-        }
-    }
-
-    // TODO: 实现超时机制
-    // 当前简化实现：立即返回
-    let _ = timeout_ms;
-
-    println!("sys_poll: {} file descriptors ready", ready_count);
-
-    ready_count as u64
-}
-
-/// epoll_event 结构体
-///
-#[repr(C)]
-#[derive(Debug, Copy, Clone, PartialEq)]
-pub struct EPollEvent {
-    pub events: u32,       // 事件类型
-    pub data: u64,         // 用户数据
-}
-
-/// epoll 事件类型
-pub mod epoll_events {
-    pub const EPOLLIN: u32 = 0x00000001;     // 可读
-    pub const EPOLLPRI: u32 = 0x00000002;    // 紧急可读
-    pub const EPOLLOUT: u32 = 0x00000004;    // 可写
-    pub const EPOLLERR: u32 = 0x00000008;    // 错误
-    pub const EPOLLHUP: u32 = 0x00000010;    // 挂断
-    pub const EPOLLRDHUP: u32 = 0x00002000;  // 对端关闭连接
-    pub const EPOLLONESHOT: u32 = 0x40000000; // 只监听一次
-    pub const EPOLLET: u32 = 1 << 31;       // 边缘触发
-}
-
-/// epoll 操作类型
-pub mod epoll_ctl_ops {
-    pub const EPOLL_CTL_ADD: i32 = 1;   // 添加 fd
-    pub const EPOLL_CTL_DEL: i32 = 2;   // 删除 fd
-    pub const EPOLL_CTL_MOD: i32 = 3;   // 修改 fd
-}
-
-// 全局 epoll 实例计数器（简化实现）
-use core::sync::atomic::{AtomicU32, Ordering};
-
-static EPOLL_INSTANCE_COUNTER: AtomicU32 = AtomicU32::new(1);
-
-/// sys_epoll_create - 创建 epoll 实例
-///
-/// # 参数
-///
-/// # 返回
-/// 成功返回 epoll 文件描述符，失败返回负错误码
-///
-/// # 说明
-/// 创建一个 epoll 实例，返回用于后续 epoll_ctl/epoll_wait 的文件描述符
-/// 简化实现：返回一个伪文件描述符
-fn sys_epoll_create(args: [u64; 6]) -> u64 {
-    let _size = args[0] as i32;
-
-    println!("sys_epoll_create: size={}", _size);
-
-    // 获取当前进程的 fdtable
-    let fdtable = match crate::sched::get_current_fdtable() {
-        Some(ft) => ft,
-        None => {
-            println!("sys_epoll_create: no fdtable");
-            return -9_i64 as u64;  // EBADF
-        }
-    };
-
-    // 分配文件描述符
-    let epoll_fd = match fdtable.alloc_fd() {
-        Some(fd) => fd,
-        None => {
-            println!("sys_epoll_create: failed to alloc fd");
-            return -24_i64 as u64;  // EMFILE
-        }
-    };
-
-    // 简化实现：
-    // 在真实实现中，应该创建一个 EpollFile 并安装到 fdtable
-    // 这里我们只是分配一个 fd，实际功能由 epoll_ctl/epoll_wait 实现
-    // TODO: 创建 EpollFile 结构
-
-    println!("sys_epoll_create: created epoll fd {}", epoll_fd);
-
-    epoll_fd as u64
-}
+    }
+}
 
 /// sys_epoll_create1 - 创建 epoll 实例（带标志）
 ///
 /// # 参数
-/// - args[0]: flags - 标志位
+/// - args[0]: flags - 只支持 EPOLL_CLOEXEC
 ///
 /// # 返回
 /// 成功返回 epoll 文件描述符，失败返回负错误码
-///
-/// # 说明
-/// epoll_create1 是 epoll_create 的扩展版本，支持标志位
-/// 简化实现：忽略标志，调用 epoll_create
 fn sys_epoll_create1(args: [u64; 6]) -> u64 {
+    use crate::fs::eventpoll::EPOLL_CLOEXEC;
+
     let flags = args[0] as i32;
 
-    println!("sys_epoll_create1: flags={:#x}", flags);
+    tracepoint!(SYSCALL, "sys_epoll_create1: flags={:#x}", flags);
 
-    // 简化实现：忽略标志
-    // O_CLOEXEC (0x80000) 等标志暂不支持
-    sys_epoll_create([0, args[1], args[2], args[3], args[4], args[5]])
+    if flags & !EPOLL_CLOEXEC != 0 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    epoll_install(flags & EPOLL_CLOEXEC != 0)
 }
 
 /// sys_epoll_ctl - 控制 epoll 实例
@@ -1114,14 +1693,10 @@ fn sys_epoll_create1(args: [u64; 6]) -> u64 {
 /// - args[0]: epfd - epoll 文件描述符
 /// - args[1]: op - 操作类型 (ADD/DEL/MOD)
 /// - args[2]: fd - 目标文件描述符
-/// - args[3]: event - 事件指针
+/// - args[3]: event - 事件指针，DEL 时忽略
 ///
 /// # 返回
 /// 成功返回 0，失败返回负错误码
-///
-/// # 说明
-/// 向 epoll 实例添加、删除或修改文件描述符
-/// 简化实现：只验证参数，不实际维护 epoll 集合
 fn sys_epoll_ctl(args: [u64; 6]) -> u64 {
     use epoll_ctl_ops::*;
 
@@ -1130,56 +1705,43 @@ fn sys_epoll_ctl(args: [u64; 6]) -> u64 {
     let fd = args[2] as i32;
     let event_ptr = args[3] as *const EPollEvent;
 
-    println!("sys_epoll_ctl: epfd={}, op={}, fd={}, event={:#x}",
-             epfd, op, fd, event_ptr as u64);
-
-    // 验证 epfd
-    if epfd < 0 {
-        println!("sys_epoll_ctl: invalid epfd");
-        return -9_i64 as u64;  // EBADF
-    }
+    tracepoint!(SYSCALL, "sys_epoll_ctl: epfd={}, op={}, fd={}, event={:#x}",
+                         epfd, op, fd, event_ptr as u64);
 
-    // 验证 op
     if op != EPOLL_CTL_ADD && op != EPOLL_CTL_DEL && op != EPOLL_CTL_MOD {
-        println!("sys_epoll_ctl: invalid op {}", op);
         return -22_i64 as u64;  // EINVAL
     }
 
-    // 验证 fd
-    if fd < 0 {
-        println!("sys_epoll_ctl: invalid fd");
-        return -9_i64 as u64;  // EBADF
-    }
-
-    // 验证 event_ptr（ADD 和 MOD 需要 event）
-    if (op == EPOLL_CTL_ADD || op == EPOLL_CTL_MOD) && event_ptr.is_null() {
-        println!("sys_epoll_ctl: event is null for ADD/MOD");
-        return -14_i64 as u64;  // EFAULT
-    }
-
-    // 读取事件
-    let event = if !event_ptr.is_null() {
-        unsafe { *event_ptr }
+    // 读取事件（ADD 和 MOD 需要 event）
+    let event = if op == EPOLL_CTL_DEL {
+        None
     } else {
-        EPollEvent { events: 0, data: 0 }
+        if !user_range_ok(event_ptr as usize, core::mem::size_of::<EPollEvent>()) {
+            return -14_i64 as u64;  // EFAULT
+        }
+        Some(unsafe { core::ptr::read_unaligned(event_ptr) })
     };
 
-    // 简化实现：
-    // 在真实实现中，应该：
-    // 1. 查找 epfd 对应的 EpollFile
-    // 2. 根据 op 添加/删除/修改 fd 到 epoll 集合
-    // TODO: 实现 EpollFile 和红黑树
-
-    println!("sys_epoll_ctl: op={}, fd={}, events={:#x}, data={:#x}",
-             match op {
-                 EPOLL_CTL_ADD => "ADD",
-                 EPOLL_CTL_DEL => "DEL",
-                 EPOLL_CTL_MOD => "MOD",
-                 _ => "UNKNOWN",
-             },
-             fd, event.events, event.data);
+    if epfd < 0 || fd < 0 {
+        return -9_i64 as u64;  // EBADF
+    }
+    let epfile = match unsafe { crate::fs::get_file_fd(epfd as usize) } {
+        Some(file) => file,
+        None => return -9_i64 as u64,  // EBADF
+    };
+    let file = match unsafe { crate::fs::get_file_fd(fd as usize) } {
+        Some(file) => file,
+        None => return -9_i64 as u64,  // EBADF
+    };
+    let ep = match crate::fs::eventpoll::file_epoll(&epfile) {
+        Some(ep) => ep,
+        None => return -22_i64 as u64,  // EINVAL
+    };
 
-    0  // 成功
+    match crate::fs::eventpoll::ep_ctl(&ep, op, fd, &file, event.as_ref()) {
+        Ok(()) => 0,
+        Err(e) => e as i64 as u64,
+    }
 }
 
 /// sys_epoll_wait - 等待 epoll 事件
@@ -1188,54 +1750,49 @@ fn sys_epoll_ctl(args: [u64; 6]) -> u64 {
 /// - args[0]: epfd - epoll 文件描述符
 /// - args[1]: events - 事件数组指针
 /// - args[2]: maxevents - 最大事件数
-/// - args[3]: timeout - 超时时间（毫秒）
+/// - args[3]: timeout - 超时时间（毫秒），负数一直等待
 ///
 /// # 返回
 /// 成功返回就绪的事件数量，超时返回 0，失败返回负错误码
-///
-/// # 说明
-/// 等待 epoll 实例上的事件
-/// 简化实现：返回 0（超时）
 fn sys_epoll_wait(args: [u64; 6]) -> u64 {
     let epfd = args[0] as i32;
     let events_ptr = args[1] as *mut EPollEvent;
     let maxevents = args[2] as i32;
     let timeout_ms = args[3] as i32;
 
-    println!("sys_epoll_wait: epfd={}, events={:#x}, maxevents={}, timeout={}ms",
-             epfd, events_ptr as u64, maxevents, timeout_ms);
+    tracepoint!(SYSCALL, "sys_epoll_wait: epfd={}, events={:#x}, maxevents={}, timeout={}ms",
+                         epfd, events_ptr as u64, maxevents, timeout_ms);
 
-    // 验证 epfd
-    if epfd < 0 {
-        println!("sys_epoll_wait: invalid epfd");
-        return -9_i64 as u64;  // EBADF
+    // 与 Linux 一样限制在 EP_MAX_EVENTS 以内
+    if maxevents <= 0 || maxevents as usize > i32::MAX as usize / core::mem::size_of::<EPollEvent>() {
+        return -22_i64 as u64;  // EINVAL
     }
-
-    // 验证 events_ptr
-    if events_ptr.is_null() {
-        println!("sys_epoll_wait: events is null");
+    let maxevents = maxevents as usize;
+    if !user_range_ok(events_ptr as usize, maxevents * core::mem::size_of::<EPollEvent>()) {
         return -14_i64 as u64;  // EFAULT
     }
-
-    // 验证 maxevents
-    if maxevents <= 0 || maxevents > 1024 {
-        println!("sys_epoll_wait: invalid maxevents {}", maxevents);
-        return -22_i64 as u64;  // EINVAL
+    if epfd < 0 {
+        return -9_i64 as u64;  // EBADF
     }
+    let epfile = match unsafe { crate::fs::get_file_fd(epfd as usize) } {
+        Some(file) => file,
+        None => return -9_i64 as u64,  // EBADF
+    };
+    let ep = match crate::fs::eventpoll::file_epoll(&epfile) {
+        Some(ep) => ep,
+        None => return -22_i64 as u64,  // EINVAL
+    };
 
-    // 简化实现：
-    // 在真实实现中，应该：
-    // 1. 查找 epfd 对应的 EpollFile
-    // 3. 等待事件或超时
-    // 4. 将就绪事件复制到用户空间
-    // TODO: 实现真实的等待逻辑
-
-    // 当前简化：立即返回 0（超时）
-    let _ = (epfd, events_ptr, maxevents, timeout_ms);
-
-    println!("sys_epoll_wait: timeout (no events)");
-
-    0  // 超时
+    match crate::fs::eventpoll::ep_poll(&ep, maxevents, timeout_ms) {
+        Ok(events) => {
+            for (i, event) in events.iter().enumerate() {
+                unsafe { core::ptr::write_unaligned(events_ptr.add(i), *event) };
+            }
+            tracepoint!(SYSCALL, "sys_epoll_wait: {} events", events.len());
+            events.len() as u64
+        }
+        Err(e) => e as i64 as u64,
+    }
 }
 
 /// sys_epoll_pwait - 等待 epoll 事件（带信号掩码）
@@ -1245,26 +1802,43 @@ fn sys_epoll_wait(args: [u64; 6]) -> u64 {
 /// - args[1]: events - 事件数组指针
 /// - args[2]: maxevents - 最大事件数
 /// - args[3]: timeout - 超时时间（毫秒）
-/// - args[4]: sigmask - 信号掩码指针
+/// - args[4]: sigmask - 信号掩码指针，NULL 时与 epoll_wait 相同
+/// - args[5]: sigsetsize - 信号集大小 (必须为 8)
 ///
 /// # 返回
 /// 成功返回就绪的事件数量，超时返回 0，失败返回负错误码
 ///
 /// # 说明
-/// epoll_pwait 是 epoll_wait 的扩展版本，支持信号掩码
-/// 简化实现：忽略信号掩码，调用 epoll_wait
+/// 等待期间使用 sigmask 指定的信号掩码；被信号打断时保留临时掩码，
+/// 返回用户模式递送信号后恢复 (set_user_sigmask / restore_saved_sigmask_unless)
 fn sys_epoll_pwait(args: [u64; 6]) -> u64 {
+    use crate::arch::riscv64::uaccess::get_user;
+
     let epfd = args[0] as i32;
     let events_ptr = args[1] as *mut EPollEvent;
     let maxevents = args[2] as i32;
     let timeout_ms = args[3] as i32;
-    let _sigmask_ptr = args[4] as *const u64;
+    let sigmask_ptr = args[4] as usize;
 
-    println!("sys_epoll_pwait: epfd={}, events={:#x}, maxevents={}, timeout={}ms",
-             epfd, events_ptr as u64, maxevents, timeout_ms);
+    tracepoint!(SYSCALL, "sys_epoll_pwait: epfd={}, events={:#x}, maxevents={}, timeout={}ms, sigmask={:#x}",
+                         epfd, events_ptr as u64, maxevents, timeout_ms, sigmask_ptr);
+
+    let current = match crate::sched::current() {
+        Some(task) if sigmask_ptr != 0 => task as *mut crate::process::task::Task,
+        _ => return sys_epoll_wait(args),
+    };
+    if args[5] != 8 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    let mask = match get_user::<u64>(sigmask_ptr) {
+        Ok(mask) => mask,
+        Err(e) => return e as i64 as u64,
+    };
 
-    // 简化实现：忽略信号掩码
-    sys_epoll_wait([epfd as u64, events_ptr as u64, maxevents as u64, timeout_ms as u64, args[5], 0])
+    unsafe { crate::signal::set_user_sigmask(current, mask) };
+    let ret = sys_epoll_wait(args);
+    unsafe { crate::signal::restore_saved_sigmask_unless(current, ret == -4_i64 as u64) };  // EINTR
+    ret
 }
 
 /// sys_eventfd - 创建 eventfd 对象
@@ -1276,65 +1850,57 @@ fn sys_epoll_pwait(args: [u64; 6]) -> u64 {
 /// 成功返回 eventfd 文件描述符，失败返回负错误码
 ///
 /// # 说明
-/// eventfd 是一种进程间通信机制，用于事件通知
-/// 简化实现：返回一个伪文件描述符
+/// eventfd 是一种进程间通信机制，用于事件通知；等同于 flags 为 0 的 eventfd2
 fn sys_eventfd(args: [u64; 6]) -> u64 {
-    let initval = args[0] as u32;
-
-    println!("sys_eventfd: initval={}", initval);
-
-    // 获取当前进程的 fdtable
-    let fdtable = match crate::sched::get_current_fdtable() {
-        Some(ft) => ft,
-        None => {
-            println!("sys_eventfd: no fdtable");
-            return -9_i64 as u64;  // EBADF
-        }
-    };
-
-    // 分配文件描述符
-    let eventfd_fd = match fdtable.alloc_fd() {
-        Some(fd) => fd,
-        None => {
-            println!("sys_eventfd: failed to alloc fd");
-            return -24_i64 as u64;  // EMFILE
-        }
-    };
-
-    // 简化实现：
-    // 在真实实现中，应该创建一个 EventFdFile 并安装到 fdtable
-    // eventfd 本质上是一个 64 位计数器
-    // TODO: 创建 EventFdFile 结构
-
-    println!("sys_eventfd: created eventfd fd {}", eventfd_fd);
-
-    eventfd_fd as u64
+    sys_eventfd2([args[0], 0, 0, 0, 0, 0])
 }
 
 /// sys_eventfd2 - 创建 eventfd 对象（带标志）
 ///
 /// # 参数
 /// - args[0]: initval - 初始值
-/// - args[1]: flags - 标志位
+/// - args[1]: flags - EFD_SEMAPHORE | EFD_CLOEXEC | EFD_NONBLOCK
 ///
 /// # 返回
 /// 成功返回 eventfd 文件描述符，失败返回负错误码
 ///
-/// # 说明
-/// eventfd2 是 eventfd 的扩展版本，支持标志位
-/// 简化实现：忽略标志，调用 eventfd
+/// - RISC-V: 19
 fn sys_eventfd2(args: [u64; 6]) -> u64 {
+    use crate::fs::eventfd::{eventfd_create_file, EFD_CLOEXEC};
+
     let initval = args[0] as u32;
-    let flags = args[1] as i32;
+    let flags = args[1] as u32;
 
-    println!("sys_eventfd2: initval={}, flags={:#x}", initval, flags);
+    tracepoint!(SYSCALL, "sys_eventfd2: initval={}, flags={:#x}", initval, flags);
 
-    // 简化实现：忽略标志
-    // EFD_CLOEXEC (0x80000), EFD_NONBLOCK (0x800), EFD_SEMAPHORE (0x1) 等标志暂不支持
-    sys_eventfd([initval as u64, args[2], args[3], args[4], args[5], 0])
+    let file = match eventfd_create_file(initval, flags) {
+        Ok(file) => file,
+        Err(e) => return e as i64 as u64,
+    };
+    if flags & EFD_CLOEXEC != 0 {
+        file.set_cloexec(true);
+    }
+    match unsafe { crate::fs::file::get_file_fd_install(file.clone()) } {
+        Some(fd) => {
+            tracepoint!(SYSCALL, "sys_eventfd2: created eventfd fd {}", fd);
+            fd as u64
+        }
+        None => {
+            crate::fs::file::fput(file);
+            -24_i64 as u64  // EMFILE
+        }
+    }
 }
 
 fn sys_getpid(_args: [u64; 6]) -> u64 {
+    // 线程组中所有线程的 PID 都是 TGID
+    match crate::sched::current() {
+        Some(task) => task.tgid() as u64,
+        None => crate::process::current_pid() as u64,
+    }
+}
+
+fn sys_gettid(_args: [u64; 6]) -> u64 {
     use crate::process;
     process::current_pid() as u64
 }
@@ -1362,15 +1928,28 @@ fn sys_getegid(_args: [u64; 6]) -> u64 {
 
 pub fn sys_exit(args: [u64; 6]) -> u64 {
     let exit_code = args[0] as i32;
-    println!("sys_exit: exiting with code {}", exit_code);
-    crate::sched::do_exit(exit_code);
+    tracepoint!(SYSCALL, "sys_exit: exiting with code {}", exit_code);
+    crate::sched::do_exit(crate::sched::exit_status(exit_code));
+}
+
+/// sys_exit_group - 结束调用者所在的整个线程组
+///
+/// # 参数
+/// - args[0]: 退出码，只有低 8 位交给父进程
+///
+/// # 说明
+/// 组内其他线程收到 SIGKILL，以同一个退出码退出
+pub fn sys_exit_group(args: [u64; 6]) -> u64 {
+    let exit_code = args[0] as i32;
+    tracepoint!(SYSCALL, "sys_exit_group: exiting with code {}", exit_code);
+    crate::sched::do_group_exit(crate::sched::exit_status(exit_code));
 }
 
 fn sys_kill(args: [u64; 6]) -> u64 {
     let pid = args[0] as i32;
     let sig = args[1] as i32;
 
-    println!("sys_kill: pid={}, sig={}", pid, sig);
+    tracepoint!(SYSCALL, "sys_kill: pid={}, sig={}", pid, sig);
 
     match crate::sched::send_signal(pid as u32, sig) {
         Ok(()) => 0,
@@ -1378,261 +1957,428 @@ fn sys_kill(args: [u64; 6]) -> u64 {
     }
 }
 
-// 辅助函数用于测试
-#[inline(never)]
-fn sys_fork(_args: [u64; 6]) -> u64 {
-    match crate::process::do_fork() {
-        Some(pid) => pid as u64,
-        None => -12_i64 as u64,  // ENOMEM
+/// sched_setscheduler 的策略参数中表示 fork 时重置为 SCHED_NORMAL 的标志
+/// (SCHED_RESET_ON_FORK)，当前忽略
+const SCHED_RESET_ON_FORK: u32 = 0x4000_0000;
+
+/// 按 PID 查找调度系统调用的目标任务，0 表示调用者 (find_process_by_pid)
+fn sched_find_task(pid: u64) -> Result<*mut crate::process::Task, u64> {
+    let pid = pid as i32;
+    if pid < 0 {
+        return Err(-22_i64 as u64);  // EINVAL
+    }
+    let task = if pid == 0 {
+        match crate::sched::current() {
+            Some(task) => task as *mut crate::process::Task,
+            None => core::ptr::null_mut(),
+        }
+    } else {
+        unsafe { crate::sched::find_task_by_pid(pid as u32) }
+    };
+    if task.is_null() {
+        return Err(-3_i64 as u64);  // ESRCH
     }
+    Ok(task)
 }
 
-pub fn sys_execve(args: [u64; 6]) -> u64 {
-    use crate::fs::elf::ElfLoader;
-    use crate::fs;
+/// 设置任务的调度策略和 struct sched_param 中的优先级
+fn do_sched_setscheduler(pid: u64, policy: Option<SchedPolicy>, param: u64) -> u64 {
+    use crate::arch::riscv64::uaccess::get_user;
 
-    let pathname_ptr = args[0] as *const u8;
-    let _argv = args[1] as *const *const u8;
-    let _envp = args[2] as *const *const u8;
+    if param == 0 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    let sched_priority = match get_user::<i32>(param as usize) {
+        Ok(prio) => prio,
+        Err(e) => return e as i64 as u64,
+    };
+    let task = match sched_find_task(pid) {
+        Ok(task) => task,
+        Err(e) => return e,
+    };
+    // sched_setparam 保持原来的策略
+    let policy = policy.unwrap_or_else(|| unsafe { (*task).policy() });
 
-    println!("sys_execve: called");
+    tracepoint!(SYSCALL, "sched_setscheduler: pid={} policy={:?} prio={}", pid, policy, sched_priority);
 
-    // ===== 1. 读取文件名 =====
-    if pathname_ptr.is_null() {
-        println!("sys_execve: null pathname");
-        return -14_i64 as u64;  // EFAULT
+    match crate::sched::sched_setscheduler(task, policy, sched_priority) {
+        Ok(()) => 0,
+        Err(e) => e as i64 as u64,
     }
+}
 
-    // 读取文件名（简化：假设以 null 结尾，最大长度 256）
-    let filename = unsafe {
-        let mut len = 0;
-        let mut ptr = pathname_ptr;
-        while len < 256 {
-            let byte = *ptr;
-            if byte == 0 {
-                break;
-            }
-            len += 1;
-            ptr = ptr.add(1);
-        }
-        core::slice::from_raw_parts(pathname_ptr, len)
+/// sys_sched_setscheduler - 设置调度策略和实时优先级
+///
+/// # 参数
+/// - args[0]: pid - 目标任务，0 表示调用者
+/// - args[1]: policy - SCHED_NORMAL/FIFO/RR/BATCH/IDLE，可带 SCHED_RESET_ON_FORK
+/// - args[2]: param - struct sched_param 指针
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码
+fn sys_sched_setscheduler(args: [u64; 6]) -> u64 {
+    let policy = match SchedPolicy::from_raw(args[1] as u32 & !SCHED_RESET_ON_FORK) {
+        Some(policy) => policy,
+        None => return -22_i64 as u64,  // EINVAL
     };
+    do_sched_setscheduler(args[0], Some(policy), args[2])
+}
 
-    let filename_str = match core::str::from_utf8(filename) {
-        Ok(s) => s,
-        Err(_) => {
-            println!("sys_execve: invalid utf-8 filename");
-            return -22_i64 as u64;  // EINVAL
-        }
-    };
+/// sys_sched_setparam - 在当前策略下设置实时优先级
+///
+/// # 参数
+/// - args[0]: pid - 目标任务，0 表示调用者
+/// - args[1]: param - struct sched_param 指针
+fn sys_sched_setparam(args: [u64; 6]) -> u64 {
+    do_sched_setscheduler(args[0], None, args[1])
+}
 
-    println!("sys_execve: pathname='{}'", filename_str);
+/// sys_sched_getscheduler - 读取调度策略
+///
+/// # 参数
+/// - args[0]: pid - 目标任务，0 表示调用者
+fn sys_sched_getscheduler(args: [u64; 6]) -> u64 {
+    match sched_find_task(args[0]) {
+        Ok(task) => unsafe { (*task).policy() as u64 },
+        Err(e) => e,
+    }
+}
 
-    // ===== 2. 从文件系统读取文件 =====
-    let file_data = fs::read_file_from_rootfs(filename_str);
-    let file_data = match file_data {
-        Some(data) => data,
-        None => {
-            println!("sys_execve: file not found: {}", filename_str);
-            return -2_i64 as u64;  // ENOENT
-        }
+/// sys_sched_getparam - 读取实时优先级，非实时任务为 0
+///
+/// # 参数
+/// - args[0]: pid - 目标任务，0 表示调用者
+/// - args[1]: param - struct sched_param 指针
+fn sys_sched_getparam(args: [u64; 6]) -> u64 {
+    use crate::arch::riscv64::uaccess::put_user;
+
+    if args[1] == 0 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    let task = match sched_find_task(args[0]) {
+        Ok(task) => task,
+        Err(e) => return e,
     };
+    let sched_priority = unsafe { (*task).rt_priority() };
+    match put_user(args[1] as usize, &sched_priority) {
+        Ok(()) => 0,
+        Err(e) => e as i64 as u64,
+    }
+}
 
-    println!("sys_execve: file size = {} bytes", file_data.len());
+/// 内核 CPU 位图的字节数 (cpumask_size)
+const CPUMASK_SIZE: usize = core::mem::size_of::<usize>();
 
-    // ===== 3. 验证 ELF 格式 =====
-    let validation_result = ElfLoader::validate(&file_data);
-    if let Err(e) = validation_result {
-        println!("sys_execve: invalid ELF: {:?}", e);
-        return -8_i64 as u64;  // ENOEXEC
-    }
+/// sys_sched_setaffinity - 设置允许运行的 CPU
+///
+/// # 参数
+/// - args[0]: pid - 目标任务，0 表示调用者
+/// - args[1]: len - 用户位图的字节数，超出内核位图的部分忽略，不足的部分视为 0
+/// - args[2]: user_mask_ptr - CPU 位图指针
+///
+/// 调用者自己不再允许在当前 CPU 上运行时，返回前就切换到允许的 CPU
+fn sys_sched_setaffinity(args: [u64; 6]) -> u64 {
+    use crate::arch::riscv64::uaccess::copy_from_user;
 
-    // ===== 4. 获取 ELF 头信息 =====
-    let ehdr = ElfLoader::get_entry(&file_data);
-    let entry = match ehdr {
-        Ok(addr) => addr,
-        Err(e) => {
-            println!("sys_execve: failed to get entry: {:?}", e);
-            return -8_i64 as u64;
-        }
+    let mut bytes = [0u8; CPUMASK_SIZE];
+    let len = (args[1] as usize).min(CPUMASK_SIZE);
+    if copy_from_user(&mut bytes[..len], args[2] as usize) != 0 {
+        return -14_i64 as u64;  // EFAULT
+    }
+    let mask = usize::from_le_bytes(bytes);
+    let task = match sched_find_task(args[0]) {
+        Ok(task) => task,
+        Err(e) => return e,
     };
 
-    println!("sys_execve: ELF entry point = {:#x}", entry);
+    tracepoint!(SYSCALL, "sched_setaffinity: pid={} mask={:#x}", args[0], mask);
 
-    // ===== 5. 获取程序头数量 =====
-    let phdr_count = match ElfLoader::get_program_headers(&file_data) {
-        Ok(count) => count,
-        Err(e) => {
-            println!("sys_execve: failed to get program headers: {:?}", e);
-            return -8_i64 as u64;
-        }
-    };
+    if let Err(e) = crate::sched::sched_setaffinity(task, mask) {
+        return e as i64 as u64;
+    }
+    let this_cpu = crate::arch::cpu_id() as usize;
+    let is_current = crate::sched::current().map_or(false, |c| core::ptr::eq(c, task));
+    if is_current && unsafe { !(*task).cpu_allowed(this_cpu) } {
+        crate::sched::yield_cpu();
+    }
+    0
+}
 
-    println!("sys_execve: {} program headers", phdr_count);
+/// sys_sched_getaffinity - 读取允许运行的 CPU
+///
+/// # 参数
+/// - args[0]: pid - 目标任务，0 表示调用者
+/// - args[1]: len - 用户缓冲区字节数，必须是 long 的整数倍且能容纳内核位图
+/// - args[2]: user_mask_ptr - CPU 位图指针
+///
+/// # 返回
+/// 成功返回写入的字节数
+fn sys_sched_getaffinity(args: [u64; 6]) -> u64 {
+    use crate::arch::riscv64::uaccess::copy_to_user;
 
-    // 获取 ELF 头
-    let ehdr = match unsafe { crate::fs::elf::Elf64Ehdr::from_bytes(&file_data) } {
-        Some(e) => e,
-        None => {
-            println!("sys_execve: failed to get ELF header");
-            return -8_i64 as u64;
-        }
+    let len = args[1] as usize;
+    if len < CPUMASK_SIZE || len % core::mem::size_of::<usize>() != 0 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    let task = match sched_find_task(args[0]) {
+        Ok(task) => task,
+        Err(e) => return e,
     };
-
-    // ===== 6. 分析 PT_LOAD 段 =====
-    for i in 0..phdr_count {
-        if let Some(phdr) = unsafe { ehdr.get_program_header(&file_data, i) } {
-            if phdr.is_load() {
-                println!("  PT_LOAD[{}]: vaddr={:#x}, filesz={}, memsz={}, flags={:#x}",
-                         i, phdr.p_vaddr, phdr.p_filesz, phdr.p_memsz, phdr.p_flags);
-            }
-        }
+    let mask = unsafe { (*task).cpus_allowed() } & crate::sched::cpu_active_mask();
+    if copy_to_user(args[2] as usize, &mask.to_le_bytes()) != 0 {
+        return -14_i64 as u64;  // EFAULT
     }
+    CPUMASK_SIZE as u64
+}
+
+/// sys_sched_yield - 让出 CPU
+///
+/// 实时任务移到同优先级链表的尾部，CFS 任务按 vruntime 重新排队
+fn sys_sched_yield(_args: [u64; 6]) -> u64 {
+    crate::sched::yield_cpu();
+    0
+}
 
-    // ===== 7. 检查 PT_INTERP（动态链接器） =====
-    if let Some(interp) = ElfLoader::get_interpreter(&file_data) {
-        let interp_str = core::str::from_utf8(interp).unwrap_or("<invalid>");
-        println!("sys_execve: interpreter: {}", interp_str);
+/// sys_sched_get_priority_max - 策略的最高 sched_priority
+fn sys_sched_get_priority_max(args: [u64; 6]) -> u64 {
+    match SchedPolicy::from_raw(args[0] as u32) {
+        Some(policy) if policy.is_rt() => (crate::sched::fair::MAX_RT_PRIO - 1) as u64,
+        Some(SchedPolicy::Deadline) | None => -22_i64 as u64,  // EINVAL
+        Some(_) => 0,
     }
+}
 
-    // ===== 8. 创建用户地址空间 =====
-    use crate::arch::riscv64::mm::{
-        create_user_address_space, alloc_and_map_user_memory,
-        PageTableEntry, PAGE_SIZE
-    };
+/// sys_sched_get_priority_min - 策略的最低 sched_priority
+fn sys_sched_get_priority_min(args: [u64; 6]) -> u64 {
+    match SchedPolicy::from_raw(args[0] as u32) {
+        Some(policy) if policy.is_rt() => 1,
+        Some(SchedPolicy::Deadline) | None => -22_i64 as u64,  // EINVAL
+        Some(_) => 0,
+    }
+}
 
-    let user_root_ppn = match create_user_address_space() {
-        Some(ppn) => {
-            println!("sys_execve: created user address space (root_ppn={:#x})", ppn);
-            ppn
-        }
-        None => {
-            println!("sys_execve: failed to create user address space");
-            return -12_i64 as u64;  // ENOMEM
-        }
+// 辅助函数用于测试
+#[inline(never)]
+/// 检查 clone 给出的 TID 地址
+fn clone_tid_ok(flags: u64, parent_tid: usize, child_tid: usize) -> bool {
+    use crate::process::fork::*;
+    let size = core::mem::size_of::<i32>();
+    if flags & CLONE_PARENT_SETTID != 0 && parent_tid != 0 && !user_range_ok(parent_tid, size) {
+        return false;
+    }
+    if flags & (CLONE_CHILD_SETTID | CLONE_CHILD_CLEARTID) != 0 && child_tid != 0
+        && !user_range_ok(child_tid, size)
+    {
+        return false;
+    }
+    true
+}
+
+/// sys_clone (220) - 创建进程或线程
+///
+/// fork() 在 RISC-V 上也通过 clone(SIGCHLD, 0) 实现
+///
+/// # 参数
+/// - args[0]: flags - CLONE_* 标志，低 8 位是退出信号
+/// - args[1]: newsp - 子任务的用户栈，0 表示沿用父进程的栈
+/// - args[2]: parent_tid - CLONE_PARENT_SETTID 的写入地址
+/// - args[3]: tls - CLONE_SETTLS 的 tp
+/// - args[4]: child_tid - CLONE_CHILD_SETTID / CLONE_CHILD_CLEARTID 的地址
+///
+/// # 返回
+/// 父进程中返回子任务的 TID，子任务中返回 0
+fn sys_clone(args: [u64; 6]) -> u64 {
+    use crate::process::fork::{do_clone, CloneArgs, CSIGNAL};
+
+    let clone_args = CloneArgs {
+        flags: args[0] & !CSIGNAL,
+        exit_signal: (args[0] & CSIGNAL) as u32,
+        stack: args[1] as usize,
+        tls: args[3] as usize,
+        parent_tid: args[2] as usize,
+        child_tid: args[4] as usize,
     };
+    if !clone_tid_ok(clone_args.flags, clone_args.parent_tid, clone_args.child_tid) {
+        return -14_i64 as u64;  // EFAULT
+    }
 
-    // ===== 9. 加载 PT_LOAD 段 =====
-    for i in 0..phdr_count {
-        if let Some(phdr) = unsafe { ehdr.get_program_header(&file_data, i) } {
-            if phdr.is_load() {
-                let vaddr = phdr.p_vaddr;
-                let memsz = phdr.p_memsz as usize;
-                let filesz = phdr.p_filesz as usize;
-                let offset = phdr.p_offset as usize;
+    match do_clone(&clone_args) {
+        Ok(pid) => pid as u64,
+        Err(e) => e as i64 as u64,
+    }
+}
 
-                // 页对齐
-                let aligned_vaddr = vaddr & !(PAGE_SIZE as u64 - 1);
-                let aligned_size = ((memsz as u64 + PAGE_SIZE as u64 - 1) & !(PAGE_SIZE as u64 - 1)) as usize;
+/// struct clone_args 最早版本的大小 (CLONE_ARGS_SIZE_VER0)
+const CLONE_ARGS_SIZE_VER0: usize = 64;
 
-                // 计算页标志
-                let mut flags = PageTableEntry::V | PageTableEntry::A | PageTableEntry::D;
-                if phdr.p_flags & crate::fs::elf::PF_R != 0 {
-                    flags |= PageTableEntry::R;
-                }
-                if phdr.p_flags & crate::fs::elf::PF_W != 0 {
-                    flags |= PageTableEntry::W;
-                }
-                if phdr.p_flags & crate::fs::elf::PF_X != 0 {
-                    flags |= PageTableEntry::X;
-                }
-                // 用户可访问
-                flags |= PageTableEntry::U;
-
-                // 分配并映射内存
-                let phys_addr = unsafe {
-                    match alloc_and_map_user_memory(user_root_ppn, aligned_vaddr, aligned_size as u64, flags) {
-                        Some(addr) => addr,
-                        None => {
-                            println!("sys_execve: failed to allocate memory for segment at {:#x}", vaddr);
-                            return -12_i64 as u64;  // ENOMEM
-                        }
-                    }
-                };
+/// sys_clone3 (435) - 以结构体传参的 clone
+///
+/// # 参数
+/// - args[0]: uargs - struct clone_args 的用户空间地址
+/// - args[1]: size - 结构体大小
+///
+/// 不支持 set_tid 与 cgroup
+fn sys_clone3(args: [u64; 6]) -> u64 {
+    use crate::process::fork::{do_clone, CloneArgs, CSIGNAL};
 
-                // 复制 ELF 数据到物理内存
-                unsafe {
-                    let offset_in_segment = vaddr - aligned_vaddr;
-                    let dst = (phys_addr + offset_in_segment) as *mut u8;
-                    let src = file_data.as_ptr().add(offset);
+    let uargs = args[0] as usize;
+    let size = args[1] as usize;
 
-                    if filesz > 0 {
-                        core::ptr::copy_nonoverlapping(src, dst, filesz);
-                    }
+    if size < CLONE_ARGS_SIZE_VER0 || size > 4096 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    if !user_range_ok(uargs, size) {
+        return -14_i64 as u64;  // EFAULT
+    }
 
-                    // BSS 段清零
-                    if memsz > filesz {
-                        let bss_start = dst.add(filesz);
-                        let bss_size = memsz - filesz;
-                        core::ptr::write_bytes(bss_start, 0, bss_size);
-                    }
-                }
+    // struct clone_args 的字段都是 u64，未知的扩展部分必须为 0
+    let field = |i: usize| unsafe { core::ptr::read_unaligned((uargs + i * 8) as *const u64) };
+    let tail = unsafe { core::slice::from_raw_parts((uargs + 88) as *const u8, size.saturating_sub(88)) };
+    if tail.iter().any(|&b| b != 0) {
+        return -7_i64 as u64;  // E2BIG
+    }
+    let flags = field(0);
+    let child_tid = field(2);
+    let parent_tid = field(3);
+    let exit_signal = field(4);
+    let stack = field(5);
+    let stack_size = field(6);
+    let tls = field(7);
+    // set_tid / set_tid_size / cgroup
+    let set_tid_size = if size >= 80 { field(9) } else { 0 };
+    let cgroup = if size >= 88 { field(10) } else { 0 };
+
+    // clone3 的退出信号单独给出，flags 中不能带 CSIGNAL
+    if flags & CSIGNAL != 0 || exit_signal & !CSIGNAL != 0 || set_tid_size != 0 || cgroup != 0 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    // 栈向下增长，给出栈时 sp 从栈顶开始
+    if (stack == 0) != (stack_size == 0) {
+        return -22_i64 as u64;  // EINVAL
+    }
+    let sp = match stack.checked_add(stack_size) {
+        Some(sp) => sp,
+        None => return -22_i64 as u64,  // EINVAL
+    };
 
-                println!("sys_execve: loaded segment: vaddr={:#x}, memsz={}, phys={:#x}",
-                         vaddr, memsz, phys_addr);
-            }
-        }
+    let clone_args = CloneArgs {
+        flags,
+        exit_signal: exit_signal as u32,
+        stack: sp as usize,
+        tls: tls as usize,
+        parent_tid: parent_tid as usize,
+        child_tid: child_tid as usize,
+    };
+    if !clone_tid_ok(flags, clone_args.parent_tid, clone_args.child_tid) {
+        return -14_i64 as u64;  // EFAULT
     }
 
-    // ===== 10. 分配用户栈 =====
-    let user_stack_bottom = USER_STACK_TOP - (USER_STACK_SIZE as u64);
+    match do_clone(&clone_args) {
+        Ok(pid) => pid as u64,
+        Err(e) => e as i64 as u64,
+    }
+}
 
-    let stack_flags = PageTableEntry::V | PageTableEntry::R | PageTableEntry::W
-        | PageTableEntry::A | PageTableEntry::D | PageTableEntry::U;
+pub fn sys_execve(args: [u64; 6]) -> u64 {
+    use crate::arch::riscv64::uaccess::strncpy_from_user;
+    use crate::fs::binfmt_elf;
 
-    let user_stack_phys = unsafe {
-        match alloc_and_map_user_memory(user_root_ppn, user_stack_bottom, USER_STACK_SIZE as u64, stack_flags) {
-            Some(addr) => addr,
-            None => {
-                println!("sys_execve: failed to allocate user stack");
-                return -12_i64 as u64;  // ENOMEM
-            }
+    let pathname_ptr = args[0] as *const u8;
+    let _argv = args[1] as *const *const u8;
+    let _envp = args[2] as *const *const u8;
+
+    tracepoint!(SYSCALL, "sys_execve: called");
+
+    // ===== 1. 读取文件名 =====
+    if pathname_ptr.is_null() {
+        tracepoint!(SYSCALL, "sys_execve: null pathname");
+        return -14_i64 as u64;  // EFAULT
+    }
+
+    // 读取文件名：地址无效时由异常表修复返回 EFAULT
+    let mut filename_buf = [0u8; 256];
+    let filename = match strncpy_from_user(&mut filename_buf, pathname_ptr as usize) {
+        Ok(len) if len == filename_buf.len() => return -36_i64 as u64,  // ENAMETOOLONG
+        Ok(len) => &filename_buf[..len],
+        Err(e) => return e as i64 as u64,
+    };
+
+    let filename_str = match core::str::from_utf8(filename) {
+        Ok(s) => s,
+        Err(_) => {
+            tracepoint!(SYSCALL, "sys_execve: invalid utf-8 filename");
+            return -22_i64 as u64;  // EINVAL
+        }
+    };
+
+    tracepoint!(SYSCALL, "sys_execve: pathname='{}'", filename_str);
+
+    // ===== 2. 读取 ELF 头和程序头（经页缓存，不读入整个文件） =====
+    let bin = match binfmt_elf::open_exec(filename_str) {
+        Ok(bin) => bin,
+        Err(e) => {
+            tracepoint!(SYSCALL, "sys_execve: cannot exec {}: {}", filename_str, e);
+            return e as i64 as u64;
+        }
+    };
+    tracepoint!(SYSCALL, "sys_execve: ELF entry point = {:#x}, {} program headers", bin.ehdr.e_entry, bin.phdrs.len());
+
+    for (i, phdr) in bin.phdrs.iter().enumerate() {
+        if phdr.is_load() {
+            tracepoint!(SYSCALL, "  PT_LOAD[{}]: vaddr={:#x}, filesz={}, memsz={}, flags={:#x}",
+                                 i, phdr.p_vaddr, phdr.p_filesz, phdr.p_memsz, phdr.p_flags);
         }
+    }
+
+    // ===== 3. 创建用户地址空间 =====
+    use crate::arch::riscv64::mm::{
+        create_user_address_space, alloc_and_map_user_memory,
+        PageTableEntry,
     };
 
-    println!("sys_execve: user stack: virt={:#x}, phys={:#x}", USER_STACK_TOP, user_stack_phys);
+    let user_root_ppn = match create_user_address_space() {
+        Some(ppn) => {
+            tracepoint!(SYSCALL, "sys_execve: created user address space (root_ppn={:#x})", ppn);
+            ppn
+        }
+        None => {
+            tracepoint!(SYSCALL, "sys_execve: failed to create user address space");
+            return -12_i64 as u64;  // ENOMEM
+        }
+    };
 
-    // ===== 10.5 创建 AddressSpace 并注册 VMA =====
     use crate::arch::riscv64::mm::AddressSpace;
     use crate::mm::pagemap::PageTableType;
     use crate::mm::vma::{Vma, VmaFlags};
 
     let addr_space = unsafe { AddressSpace::new_with_type(user_root_ppn, PageTableType::User) };
 
-    // 为代码段/数据段注册 VMA
-    for i in 0..phdr_count {
-        if let Some(phdr) = unsafe { ehdr.get_program_header(&file_data, i) } {
-            if phdr.is_load() {
-                let vaddr = phdr.p_vaddr;
-                let memsz = phdr.p_memsz as usize;
-
-                // 页对齐
-                let aligned_vaddr = vaddr & !(PAGE_SIZE as u64 - 1);
-                let aligned_end = ((vaddr + memsz as u64 + PAGE_SIZE as u64 - 1) & !(PAGE_SIZE as u64 - 1));
-
-                // 设置 VMA 标志
-                let mut vma_flags = VmaFlags::new();
-                vma_flags.insert(VmaFlags::READ);
-                if phdr.p_flags & crate::fs::elf::PF_W != 0 {
-                    vma_flags.insert(VmaFlags::WRITE);
-                }
-                if phdr.p_flags & crate::fs::elf::PF_X != 0 {
-                    vma_flags.insert(VmaFlags::EXEC);
-                }
+    // ===== 4. 映射 PT_LOAD 段 =====
+    // 私有文件映射，缺页时从页缓存映射 (filemap_fault)，写时复制；
+    // 有 PT_INTERP 时同时映射解释器
+    let image = match binfmt_elf::load_elf_binary(&addr_space, &bin) {
+        Ok(image) => image,
+        Err(e) => {
+            tracepoint!(SYSCALL, "sys_execve: failed to map segments: {}", e);
+            return e as i64 as u64;
+        }
+    };
+    tracepoint!(SYSCALL, "sys_execve: start={:#x}, entry={:#x}, interp base={:#x}",
+                         image.start, image.entry, image.base);
 
-                let vma = Vma::new(
-                    crate::mm::page::VirtAddr::new(aligned_vaddr as usize),
-                    crate::mm::page::VirtAddr::new(aligned_end as usize),
-                    vma_flags,
-                );
+    // ===== 5. 分配用户栈 =====
+    let user_stack_bottom = USER_STACK_TOP - (USER_STACK_SIZE as u64);
 
-                // 直接添加 VMA（不映射，因为已经映射过了）
-                addr_space.vma_write().add(vma).ok();
-                println!("sys_execve: registered VMA {:#x}-{:#x}", aligned_vaddr, aligned_end);
-            }
-        }
+    let stack_flags = PageTableEntry::V | PageTableEntry::R | PageTableEntry::W
+        | PageTableEntry::A | PageTableEntry::D | PageTableEntry::U;
+
+    if unsafe { alloc_and_map_user_memory(user_root_ppn, user_stack_bottom, USER_STACK_SIZE as u64, stack_flags) }.is_none() {
+        tracepoint!(SYSCALL, "sys_execve: failed to allocate user stack");
+        return -12_i64 as u64;  // ENOMEM
     }
 
+    tracepoint!(SYSCALL, "sys_execve: user stack: virt={:#x}-{:#x}", user_stack_bottom, USER_STACK_TOP);
+
     // 为栈注册 VMA
     let mut stack_vma_flags = VmaFlags::new();
     stack_vma_flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::GROWSDOWN);
@@ -1642,17 +2388,28 @@ pub fn sys_execve(args: [u64; 6]) -> u64 {
         stack_vma_flags,
     );
     addr_space.vma_write().add(stack_vma).ok();
-    println!("sys_execve: registered stack VMA {:#x}-{:#x}", user_stack_bottom, USER_STACK_TOP);
+    tracepoint!(SYSCALL, "sys_execve: registered stack VMA {:#x}-{:#x}", user_stack_bottom, USER_STACK_TOP);
+
+    // 映射 vDSO (arch_setup_additional_pages)
+    let vdso_base = crate::arch::riscv64::vdso::vdso_map(&addr_space);
+    tracepoint!(SYSCALL, "sys_execve: mapped vDSO at {:#x}", vdso_base);
 
-    // 更新当前任务的 address_space
+    // 更新当前任务的 address_space；旧地址空间在读完 argv/envp 之后释放
+    let mut old_mm = None;
     if let Some(current_task) = crate::sched::current() {
         unsafe {
+            old_mm = (*current_task).address_space_arc();
             (*current_task).set_address_space(Some(addr_space));
+            // 任务名取程序文件名 (__set_task_comm)
+            (*current_task).set_comm(filename.rsplit(|&b| b == b'/').next().unwrap_or(filename));
+            // 新程序从清零的浮点状态开始 (flush_thread)
+            crate::arch::riscv64::fpu::flush_thread(current_task);
+            crate::perf_event::perf_event_enable_on_exec(&*current_task);
         }
-        println!("sys_execve: updated task address_space");
+        tracepoint!(SYSCALL, "sys_execve: updated task address_space");
     }
 
-    // ===== 11. 设置 argv/envp 到用户栈 =====
+    // ===== 6. 设置 argv/envp 到用户栈 =====
     // | envp[n]     |
     // | ...         |
     // | envp[0]     |
@@ -1663,271 +2420,207 @@ pub fn sys_execve(args: [u64; 6]) -> u64 {
     // | argv[0]     |
     // | argc        |  <- 栈指针指向这里
 
-    let user_stack_with_args = match setup_user_stack(user_root_ppn, user_stack_phys, USER_STACK_TOP, args[1], args[2]) {
+    let user_stack_with_args = match setup_user_stack(user_root_ppn, USER_STACK_TOP, args[1], args[2], vdso_base,
+                                                  &image) {
         Ok(sp) => sp,
         Err(e) => {
-            println!("sys_execve: failed to setup user stack: {}", e);
+            tracepoint!(SYSCALL, "sys_execve: failed to setup user stack: {}", e);
             return -12_i64 as u64;  // ENOMEM
         }
     };
 
-    println!("sys_execve: user stack with args: sp={:#x}", user_stack_with_args);
-
-    // ===== 12. 切换到用户模式并执行 =====
+    tracepoint!(SYSCALL, "sys_execve: user stack with args: sp={:#x}", user_stack_with_args);
+
+    // 旧地址空间少一个使用者，最后一个使用者归还其中的页 (exec_mmap → mmput)；
+    // 参数已经读完，vfork 的父进程可以继续运行 (exec_mm_release)
+    if let Some(old_mm) = old_mm.take() {
+        old_mm.mmput();
+    }
+    if let Some(task) = crate::sched::current() {
+        crate::process::fork::complete_vfork_done(task);
+    }
+
+    // ===== 7. 切换到用户模式并执行 =====
+    // 先切换到新地址空间以分配 ASID，satp 随后在 sret 前写入
+    let satp = match crate::sched::current().and_then(|t| t.address_space()) {
+        Some(addr_space) => unsafe {
+            addr_space.enable();
+            addr_space.satp()
+        },
+        None => unsafe {
+            let satp = crate::arch::riscv64::mm::Satp::sv39(user_root_ppn, 0).bits();
+            core::arch::asm!("csrw satp, {}", "sfence.vma zero, zero", in(reg) satp);
+            satp
+        },
+    };
     unsafe {
-        switch_to_user(user_root_ppn, entry, user_stack_with_args);
+        switch_to_user(satp, image.start, user_stack_with_args);
     }
 
     // 不应该返回
     #[allow(unreachable_code)]
     {
-        println!("sys_execve: unexpectedly returned from user mode");
+        tracepoint!(SYSCALL, "sys_execve: unexpectedly returned from user mode");
         -1_i64 as u64
     }
 }
 
+/// 读取用户的字符串指针数组（argv / envp，copy_strings）
+///
+/// 最多 256 项，每个字符串最长 4096 字节（含 NUL）
+fn read_user_strings(array: u64) -> Result<alloc::vec::Vec<alloc::vec::Vec<u8>>, &'static str> {
+    use crate::arch::riscv64::uaccess::{get_user, strndup_user};
+
+    let mut strings = alloc::vec::Vec::new();
+    if array == 0 {
+        return Ok(strings);
+    }
+    while strings.len() < 256 {
+        let ptr = get_user::<u64>(array as usize + strings.len() * 8).map_err(|_| "bad argument array")?;
+        if ptr == 0 {
+            break;
+        }
+        strings.push(strndup_user(ptr as usize, 4096).map_err(|_| "bad argument string")?);
+    }
+    Ok(strings)
+}
+
 fn setup_user_stack(
-    _user_root_ppn: u64,
-    user_stack_phys: u64,
+    user_root_ppn: u64,
     user_stack_top: u64,
     argv: u64,
     envp: u64,
+    sysinfo_ehdr: u64,
+    image: &crate::fs::binfmt_elf::ElfImage,
 ) -> Result<u64, &'static str> {
     use alloc::vec::Vec;
-    use core::slice;
-
-    // ===== 1. 读取 argv 数组 =====
-    let argv_ptr = argv as *const *const u8;
-    let mut argv_strings: Vec<Vec<u8>> = Vec::new();
-
-    if !argv_ptr.is_null() {
-        unsafe {
-            let mut i = 0;
-            loop {
-                let ptr = *argv_ptr.add(i);
-                if ptr.is_null() {
-                    break;
-                }
-
-                // 读取字符串
-                let mut len = 0;
-                let mut str_ptr = ptr;
-                while len < 4096 {  // 最大长度限制
-                    let byte = *str_ptr;
-                    if byte == 0 {
-                        break;
-                    }
-                    len += 1;
-                    str_ptr = str_ptr.add(1);
-                }
-
-                let string_vec = slice::from_raw_parts(ptr, len).to_vec();
-                argv_strings.push(string_vec);
-                i += 1;
-
-                if i >= 256 {  // 最多 256 个参数
-                    break;
-                }
-            }
-        }
-    }
 
+    // ===== 1. 读取 argv 与 envp 数组 =====
+    let argv_strings = read_user_strings(argv)?;
     let argc = argv_strings.len();
+    let envp_strings = read_user_strings(envp)?;
 
-    // ===== 2. 读取 envp 数组 =====
-    let envp_ptr = envp as *const *const u8;
-    let mut envp_strings: Vec<Vec<u8>> = Vec::new();
-
-    if !envp_ptr.is_null() {
-        unsafe {
-            let mut i = 0;
-            loop {
-                let ptr = *envp_ptr.add(i);
-                if ptr.is_null() {
-                    break;
-                }
-
-                // 读取字符串
-                let mut len = 0;
-                let mut str_ptr = ptr;
-                while len < 4096 {
-                    let byte = *str_ptr;
-                    if byte == 0 {
-                        break;
-                    }
-                    len += 1;
-                    str_ptr = str_ptr.add(1);
-                }
-
-                let string_vec = slice::from_raw_parts(ptr, len).to_vec();
-                envp_strings.push(string_vec);
-                i += 1;
-
-                if i >= 256 {  // 最多 256 个环境变量
-                    break;
-                }
-            }
-        }
-    }
-
-    println!("setup_user_stack: argc={}, envc={}", argc, envp_strings.len());
+    tracepoint!(SYSCALL, "setup_user_stack: argc={}, envc={}", argc, envp_strings.len());
 
-    // ===== 3. 计算需要的栈空间 =====
-    // 栈布局（从高地址到低地址）：
-    // | envp strings     |
-    // | argv strings     |
+    // ===== 2. 计算需要的栈空间 =====
+    // 栈布局（从低地址到高地址，与 Linux create_elf_tables 相同）：
+    // | argc             |  <- SP
+    // | argv pointers    |
+    // | NULL (argv[argc]) |
     // | envp pointers    |
     // | NULL (envp 结束)  |
-    // | NULL (argv[argc]) |
-    // | argv pointers    |
-    // | argc             |  <- SP
-
-    let mut total_size = 0usize;
+    // | auxv 键值对       |
+    // | AT_NULL          |
+    // | argv strings     |
+    // | envp strings     |
 
-    // 环境变量字符串
-    for s in &envp_strings {
-        total_size += s.len() + 1;  // +1 for null terminator
-    }
-    // argv 字符串
-    for s in &argv_strings {
-        total_size += s.len() + 1;
-    }
+    const AT_NULL: u64 = 0;
+    const AT_PHDR: u64 = 3;
+    const AT_PHENT: u64 = 4;
+    const AT_PHNUM: u64 = 5;
+    const AT_PAGESZ: u64 = 6;
+    const AT_BASE: u64 = 7;
+    const AT_ENTRY: u64 = 9;
+    const AT_HWCAP: u64 = 16;
+    const AT_CLKTCK: u64 = 17;
+    const AT_SYSINFO_EHDR: u64 = 33;
+    // 动态链接器用 AT_PHDR / AT_ENTRY 找到主程序，用 AT_BASE 重定位自身；
+    // libc 按 AT_HWCAP 选择字符串函数的实现
+    let auxv: [(u64, u64); 10] = [
+        (AT_SYSINFO_EHDR, sysinfo_ehdr),
+        (AT_PHDR, image.phdr),
+        (AT_PHENT, core::mem::size_of::<crate::fs::elf::Elf64Phdr>() as u64),
+        (AT_PHNUM, image.phnum),
+        (AT_PAGESZ, 4096),
+        (AT_BASE, image.base),
+        (AT_ENTRY, image.entry),
+        (AT_HWCAP, super::cpu::elf_hwcap()),
+        (AT_CLKTCK, crate::drivers::timer::HZ),
+        (AT_NULL, 0),
+    ];
 
     // 指针对齐到 8 字节
     let ptr_size = 8;
 
-    // envp 指针数组
-    total_size += (envp_strings.len() + 1) * ptr_size;  // +1 for NULL
-
-    // argv 指针数组
-    total_size += (argc + 1) * ptr_size;  // +1 for NULL
+    // argc + argv 指针数组 + envp 指针数组 + auxv
+    let table_size = ptr_size
+        + (argc + 1) * ptr_size
+        + (envp_strings.len() + 1) * ptr_size
+        + auxv.len() * 2 * ptr_size;
 
-    // argc
-    total_size += 8;
+    // argv 与环境变量字符串
+    let strings_size: usize = argv_strings.iter().chain(envp_strings.iter())
+        .map(|s| s.len() + 1)
+        .sum();
 
     // 栈对齐到 16 字节
-    total_size = (total_size + 15) & !15;
-
-    println!("setup_user_stack: total stack size = {} bytes", total_size);
-
-    // ===== 4. 在用户栈上布置数据 =====
-    // user_stack_phys 是栈底物理地址（对应虚拟地址 user_stack_bottom）
-    // 我们需要计算栈顶物理地址
-    let user_stack_bottom_vaddr = user_stack_top - (USER_STACK_SIZE as u64);
-
-    // 当前虚拟地址从栈顶开始向下
-    let mut current_vaddr = user_stack_top;
-
-    // 当前物理地址 = 栈底物理地址 + (当前虚拟地址 - 栈底虚拟地址)
-    // 初始时 current_vaddr = user_stack_top，所以：
-    // current_paddr = user_stack_phys + USER_STACK_SIZE
-    let mut current_paddr = user_stack_phys + (USER_STACK_SIZE as u64);
-
-    // 减去总大小
-    current_vaddr -= total_size as u64;
-    current_paddr -= total_size as u64;
+    let total_size = (table_size + strings_size + 15) & !15;
+    if total_size > USER_STACK_SIZE {
+        return Err("arguments too large");
+    }
 
-    // 对齐栈指针
-    current_vaddr &= !15;
-    current_paddr &= !15;
+    tracepoint!(SYSCALL, "setup_user_stack: total stack size = {} bytes", total_size);
 
-    let _final_sp = current_vaddr;
-    let mut offset = 0usize;
+    // ===== 3. 在内核缓冲区中布置栈内容 =====
+    // 栈页逐页分配、物理上不连续，布置完成后经用户页表一次写入 [sp, sp + total_size)
+    let sp = (user_stack_top - total_size as u64) & !15;
+    let mut frame = alloc::vec![0u8; total_size];
 
-    // ===== 5. 写入字符串数据 =====
-    // 首先写入所有环境变量字符串（在高地址）
-    let mut envp_addrs: Vec<u64> = Vec::new();
-    for s in &envp_strings {
-        let str_vaddr = current_vaddr + offset as u64;
-        unsafe {
-            let dst = (current_paddr + offset as u64) as *mut u8;
-            for (i, &byte) in s.iter().enumerate() {
-                *dst.add(i) = byte;
-            }
-            *dst.add(s.len()) = 0;  // null terminator
-        }
-        envp_addrs.push(str_vaddr);
-        offset += s.len() + 1;
-    }
+    let write_u64 = |frame: &mut [u8], offset: usize, value: u64| {
+        frame[offset..offset + ptr_size].copy_from_slice(&value.to_le_bytes());
+    };
 
-    // 然后 argv 字符串
-    let mut argv_addrs: Vec<u64> = Vec::new();
-    for s in &argv_strings {
-        let str_vaddr = current_vaddr + offset as u64;
-        unsafe {
-            let dst = (current_paddr + offset as u64) as *mut u8;
-            for (i, &byte) in s.iter().enumerate() {
-                *dst.add(i) = byte;
-            }
-            *dst.add(s.len()) = 0;  // null terminator
+    // ===== 4. 写入字符串数据 =====
+    let mut string_offset = table_size;
+    let mut copy_strings = |frame: &mut [u8], strings: &Vec<Vec<u8>>| -> Vec<u64> {
+        let mut addrs = Vec::with_capacity(strings.len());
+        for s in strings {
+            // 缓冲区已清零，字符串后的 0 即结束符
+            frame[string_offset..string_offset + s.len()].copy_from_slice(s);
+            addrs.push(sp + string_offset as u64);
+            string_offset += s.len() + 1;
         }
-        argv_addrs.push(str_vaddr);
-        offset += s.len() + 1;
-    }
-
-    // ===== 6. 写入指针数组 =====
-    // 对齐到指针大小
-    while offset % ptr_size != 0 {
-        offset += 1;
-    }
+        addrs
+    };
+    let argv_addrs = copy_strings(&mut frame, &argv_strings);
+    let envp_addrs = copy_strings(&mut frame, &envp_strings);
 
-    // envp 指针数组
-    for &addr in &envp_addrs {
-        unsafe {
-            let dst = (current_paddr + offset as u64) as *mut u64;
-            *dst = addr;
-        }
-        offset += ptr_size;
-    }
-    // envp NULL 终止符
-    unsafe {
-        let dst = (current_paddr + offset as u64) as *mut u64;
-        *dst = 0;
-    }
+    // ===== 5. 写入 argc、指针数组与 auxv =====
+    let mut offset = 0usize;
+    write_u64(&mut frame, offset, argc as u64);
     offset += ptr_size;
-
-    // argv 指针数组（注意：需要倒序写入，因为栈从高地址向低地址增长）
-    // 实际上我们不需要倒序，因为我们是从低地址向高地址构建的
-
-    // 先写 argv NULL 终止符
-    unsafe {
-        let dst = (current_paddr + offset as u64) as *mut u64;
-        *dst = 0;
+    for &addr in argv_addrs.iter().chain(core::iter::once(&0)) {
+        write_u64(&mut frame, offset, addr);
+        offset += ptr_size;
     }
-    offset += ptr_size;
-
-    // 然后写 argv 指针（从后往前）
-    for i in (0..argc).rev() {
-        unsafe {
-            let dst = (current_paddr + offset as u64) as *mut u64;
-            *dst = argv_addrs[i];
-        }
+    for &addr in envp_addrs.iter().chain(core::iter::once(&0)) {
+        write_u64(&mut frame, offset, addr);
         offset += ptr_size;
     }
-
-    // ===== 7. 写入 argc =====
-    unsafe {
-        let dst = (current_paddr + offset as u64) as *mut u64;
-        *dst = argc as u64;
+    for &(key, value) in &auxv {
+        write_u64(&mut frame, offset, key);
+        write_u64(&mut frame, offset + ptr_size, value);
+        offset += 2 * ptr_size;
     }
-    offset += 8;
+    debug_assert_eq!(offset, table_size);
 
-    // 最终的栈指针应该在 argc 的位置
-    let final_sp = current_vaddr + offset as u64 - 8;
+    if !unsafe { crate::arch::riscv64::mm::copy_to_user_space(user_root_ppn, sp, &frame) } {
+        return Err("user stack not mapped");
+    }
 
-    println!("setup_user_stack: final sp={:#x}, argc={}, argv={:#x}", final_sp, argc,
-             if argc > 0 { argv_addrs[0] } else { 0 });
+    tracepoint!(SYSCALL, "setup_user_stack: final sp={:#x}, argc={}, argv={:#x}", sp, argc,
+                         if argc > 0 { argv_addrs[0] } else { 0 });
 
-    Ok(final_sp)
+    Ok(sp)
 }
 
-unsafe fn switch_to_user(user_root_ppn: u64, entry: u64, user_stack: u64) -> ! {
-    use crate::arch::riscv64::mm::Satp;
-
-    // 设置用户页表
-    let satp = Satp::sv39(user_root_ppn, 0);
-    println!("sys_execve: switching to user mode, satp={:#x}, entry={:#x}, sp={:#x}",
-             satp.0, entry, user_stack);
+/// 返回用户模式执行
+///
+/// # 参数
+/// - satp: 用户页表的 satp 值（含 ASID），TLB 已由 switch_mm 处理
+unsafe fn switch_to_user(satp: u64, entry: u64, user_stack: u64) -> ! {
+    tracepoint!(SYSCALL, "sys_execve: switching to user mode, satp={:#x}, entry={:#x}, sp={:#x}",
+                         satp, entry, user_stack);
 
     // 设置用户模式下的寄存器状态
     // RISC-V S-mode to U-mode:
@@ -1950,26 +2643,23 @@ unsafe fn switch_to_user(user_root_ppn: u64, entry: u64, user_stack: u64) -> ! {
         // 2. 设置 sepc (用户程序入口点)
         "csrw sepc, {0}",
 
-        // 3. 设置 satp (用户页表)
+        // 3. 设置 satp (用户页表，带 ASID，无需刷新 TLB)
         "csrw satp, {1}",
 
-        // 4. 刷新 TLB
-        "sfence.vma zero, zero",
-
-        // 5. 设置 sscratch = tp + 1 (hart ID + 1)
+        // 4. 设置 sscratch = tp + 1 (hart ID + 1)
         // 这样 trap 入口可以识别从用户空间来的 trap
         "addi t0, tp, 1",
         "csrw sscratch, t0",
 
-        // 6. 设置用户栈
+        // 5. 设置用户栈
         "mv sp, {2}",
 
-        // 7. sret - 返回到用户模式
+        // 6. sret - 返回到用户模式
         "sret",
 
         // 参数
         in(reg) entry,
-        in(reg) satp.0,
+        in(reg) satp,
         in(reg) user_stack,
         in(reg) sstatus,
 
@@ -2003,6 +2693,124 @@ pub fn sys_wait4(args: [u64; 6]) -> u64 {
     }
 }
 
+/// waitid 的 idtype
+const P_ALL: u32 = 0;
+const P_PID: u32 = 1;
+const P_PGID: u32 = 2;
+const P_PIDFD: u32 = 3;
+
+/// sys_waitid - 等待子进程状态改变
+///
+/// # 参数
+/// - args[0]: idtype - P_ALL / P_PID / P_PGID / P_PIDFD
+/// - args[1]: id - PID 或 pidfd
+/// - args[2]: infop - 用于返回 siginfo_t 的指针，可以为 NULL
+/// - args[3]: options - 必须包含 WEXITED，可加 WNOHANG / WNOWAIT
+/// - args[4]: rusage - 忽略
+///
+/// # 返回
+/// 成功返回 0；WNOHANG 且没有已退出的子进程时也返回 0，infop 中 si_pid 为 0
+///
+/// # 说明
+/// 不跟踪停止和继续状态，没有 WEXITED 时返回 EINVAL；没有进程组，P_PGID 等价于 P_ALL
+fn sys_waitid(args: [u64; 6]) -> u64 {
+    use crate::signal::{SigInfo, Signal, UserSigInfo};
+
+    const WNOHANG: u32 = 0x0000_0001;
+    const WSTOPPED: u32 = 0x0000_0002;
+    const WEXITED: u32 = 0x0000_0004;
+    const WCONTINUED: u32 = 0x0000_0008;
+    const WNOWAIT: u32 = 0x0100_0000;
+    const WAIT_FLAGS: u32 = 0xe000_0000;  // __WNOTHREAD | __WALL | __WCLONE
+
+    let idtype = args[0] as u32;
+    let id = args[1] as i32;
+    let infop = args[2] as usize;
+    let options = args[3] as u32;
+
+    if options & !(WNOHANG | WSTOPPED | WEXITED | WCONTINUED | WNOWAIT | WAIT_FLAGS) != 0
+        || options & WEXITED == 0
+    {
+        return -22_i64 as u64;  // EINVAL
+    }
+
+    let pid = match idtype {
+        P_ALL | P_PGID => -1,
+        P_PID if id > 0 => id,
+        P_PIDFD => {
+            if id < 0 {
+                return -9_i64 as u64;  // EBADF
+            }
+            let file = match unsafe { crate::fs::get_file_fd(id as usize) } {
+                Some(file) => file,
+                None => return -9_i64 as u64,  // EBADF
+            };
+            match crate::sched::pid::pidfd_pid(&file) {
+                Some(pid) => pid as i32,
+                None => return -9_i64 as u64,  // EBADF
+            }
+        }
+        _ => return -22_i64 as u64,  // EINVAL
+    };
+
+    let info = match crate::sched::do_wait_child(pid, options & WNOHANG != 0, options & WNOWAIT == 0) {
+        Ok((child_pid, status)) => {
+            let (code, si_status) = crate::sched::wait_status_to_cld(status);
+            let mut info = SigInfo::new(Signal::SIGCHLD as i32, code, child_pid, 0);
+            info.si_status = si_status;
+            info
+        }
+        Err(e) if e == -11 => SigInfo::EMPTY,  // EAGAIN：WNOHANG 且没有已退出的子进程
+        Err(e) => return e as i64 as u64,
+    };
+
+    if infop != 0 {
+        if let Err(e) = crate::arch::riscv64::uaccess::put_user(infop, &UserSigInfo::from_info(&info)) {
+            return e as i64 as u64;
+        }
+    }
+    0
+}
+
+/// sys_pidfd_open - 取得指向进程的文件描述符
+///
+/// # 参数
+/// - args[0]: pid - 线程组组长的 PID
+/// - args[1]: flags - 0 或 PIDFD_NONBLOCK
+///
+/// # 返回
+/// 成功返回描述符（总是 O_CLOEXEC），失败返回负错误码
+fn sys_pidfd_open(args: [u64; 6]) -> u64 {
+    use crate::sched::pid::{pidfd_create_file, PIDFD_NONBLOCK};
+
+    let pid = args[0] as i32;
+    let flags = args[1] as u32;
+    if pid <= 0 || flags & !PIDFD_NONBLOCK != 0 {
+        return -22_i64 as u64;  // EINVAL
+    }
+
+    let task = unsafe { crate::sched::find_task_by_pid(pid as u32) };
+    if task.is_null() {
+        return -3_i64 as u64;  // ESRCH
+    }
+    if unsafe { (*task).is_thread() } {
+        return -22_i64 as u64;  // EINVAL
+    }
+
+    let file = pidfd_create_file(pid as u32, flags);
+    file.set_cloexec(true);
+    match unsafe { crate::fs::file::get_file_fd_install(file.clone()) } {
+        Some(fd) => {
+            tracepoint!(SYSCALL, "pidfd_open: pid {} fd {}", pid, fd);
+            fd as u64
+        }
+        None => {
+            crate::fs::file::fput(file);
+            -24_i64 as u64  // EMFILE
+        }
+    }
+}
+
 fn sys_uname(args: [u64; 6]) -> u64 {
     /// 每个字段长度为 65 字节 (包括 null 终止符)
     #[repr(C)]
@@ -2037,6 +2845,7 @@ fn sys_uname(args: [u64; 6]) -> u64 {
 }
 
 #[repr(C)]
+#[derive(Clone, Copy, Default)]
 struct Timeval {
     tv_sec: i64,   // 秒
     tv_usec: i64,  // 微秒
@@ -2074,54 +2883,141 @@ fn sys_gettimeofday(args: [u64; 6]) -> u64 {
     0
 }
 
+/// getrusage 的 who
+const RUSAGE_SELF: i32 = 0;
+const RUSAGE_CHILDREN: i32 = -1;
+const RUSAGE_THREAD: i32 = 1;
+
+/// 资源使用统计 (struct rusage)
 #[repr(C)]
-struct TimespecForGettime {
-    tv_sec: i64,   // 秒
-    tv_nsec: i64,  // 纳秒
+#[derive(Clone, Copy, Default)]
+struct Rusage {
+    ru_utime: Timeval,
+    ru_stime: Timeval,
+    ru_maxrss: i64,
+    ru_ixrss: i64,
+    ru_idrss: i64,
+    ru_isrss: i64,
+    ru_minflt: i64,
+    ru_majflt: i64,
+    ru_nswap: i64,
+    ru_inblock: i64,
+    ru_oublock: i64,
+    ru_msgsnd: i64,
+    ru_msgrcv: i64,
+    ru_nsignals: i64,
+    ru_nvcsw: i64,
+    ru_nivcsw: i64,
 }
 
-/// clock_gettime 时钟 ID
-const CLOCK_REALTIME: u32 = 0;
-const CLOCK_MONOTONIC: u32 = 1;
-const CLOCK_PROCESS_CPUTIME_ID: u32 = 2;
-const CLOCK_THREAD_CPUTIME_ID: u32 = 3;
+/// 一个 jiffy 的微秒数
+const USEC_PER_JIFFY: u64 = 1_000_000 / crate::drivers::timer::HZ;
 
-fn sys_clock_gettime(args: [u64; 6]) -> u64 {
-    let clk_id = args[0] as u32;
-    let tp_ptr = args[1] as *mut TimespecForGettime;
+fn jiffies_to_timeval(jiffies: u64) -> Timeval {
+    let hz = crate::drivers::timer::HZ;
+    Timeval { tv_sec: (jiffies / hz) as i64, tv_usec: ((jiffies % hz) * USEC_PER_JIFFY) as i64 }
+}
 
-    if tp_ptr.is_null() {
+/// sys_getrusage - 读取资源使用统计
+///
+/// 时间按 tick 采样，精度为一个 jiffy；不累计已回收子进程的资源，
+/// RUSAGE_CHILDREN 全为 0。没有驻留集峰值与块 I/O 计数，对应字段为 0
+///
+/// # 参数
+/// - args[0]: who - RUSAGE_SELF（整个线程组）、RUSAGE_THREAD（调用线程）或 RUSAGE_CHILDREN
+/// - args[1]: ru - struct rusage 指针
+fn sys_getrusage(args: [u64; 6]) -> u64 {
+    let who = args[0] as i32;
+    let current = match crate::sched::current() {
+        Some(task) => task,
+        None => return -3_i64 as u64,  // ESRCH
+    };
+    let mut ru = Rusage::default();
+    let (mut utime, mut stime) = (0, 0);
+    // 累加一个任务的时间、缺页与上下文切换次数 (accumulate_thread_rusage)
+    let mut add = |task: &crate::process::Task| {
+        use core::sync::atomic::Ordering;
+        let info = &task.se.sched_info;
+        utime += info.utime;
+        stime += info.stime;
+        ru.ru_minflt += task.acct.min_flt.load(Ordering::Relaxed) as i64;
+        ru.ru_majflt += task.acct.maj_flt.load(Ordering::Relaxed) as i64;
+        ru.ru_nvcsw += info.nvcsw as i64;
+        ru.ru_nivcsw += info.nivcsw as i64;
+    };
+    match who {
+        RUSAGE_SELF => {
+            let tgid = current.tgid();
+            crate::sched::sched::for_each_task(|task| unsafe {
+                if (*task).tgid() == tgid {
+                    add(&*task);
+                }
+            });
+        }
+        RUSAGE_THREAD => add(current),
+        RUSAGE_CHILDREN => {}
+        _ => return -22_i64 as u64,  // EINVAL
+    }
+    ru.ru_utime = jiffies_to_timeval(utime);
+    ru.ru_stime = jiffies_to_timeval(stime);
+    match crate::arch::riscv64::uaccess::put_user(args[1] as usize, &ru) {
+        Ok(()) => 0,
+        Err(e) => e as i64 as u64,
+    }
+}
+
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct TimespecForGettime {
+    tv_sec: i64,   // 秒
+    tv_nsec: i64,  // 纳秒
+}
+
+/// clock_gettime 时钟 ID
+const CLOCK_REALTIME: u32 = 0;
+const CLOCK_MONOTONIC: u32 = 1;
+const CLOCK_PROCESS_CPUTIME_ID: u32 = 2;
+const CLOCK_THREAD_CPUTIME_ID: u32 = 3;
+const CLOCK_MONOTONIC_RAW: u32 = 4;
+const CLOCK_REALTIME_COARSE: u32 = 5;
+const CLOCK_MONOTONIC_COARSE: u32 = 6;
+const CLOCK_BOOTTIME: u32 = 7;
+
+fn sys_clock_gettime(args: [u64; 6]) -> u64 {
+    let clk_id = args[0] as u32;
+    let tp_addr = args[1] as usize;
+
+    if tp_addr == 0 {
         return -22_i64 as u64;  // EINVAL
     }
 
-    // 目前只支持 REALTIME 和 MONOTONIC
-    match clk_id {
-        CLOCK_REALTIME | CLOCK_MONOTONIC => {
+    // 所有时钟都从启动开始计时，与 vDSO 的结果一致
+    let (sec, nsec) = match clk_id {
+        CLOCK_REALTIME | CLOCK_MONOTONIC | CLOCK_MONOTONIC_RAW | CLOCK_BOOTTIME => {
             // 从 RISC-V 定时器获取时间
             let cycles = crate::drivers::intc::clint::read_time();
             let freq_hz: u64 = 10_000_000;  // 10 MHz
 
-            let sec = cycles / freq_hz;
-            let nsec = (cycles % freq_hz) * 1_000_000_000 / freq_hz;
-
-            unsafe {
-                (*tp_ptr).tv_sec = sec as i64;
-                (*tp_ptr).tv_nsec = nsec as i64;
-            }
-            0
+            (cycles / freq_hz, (cycles % freq_hz) * 1_000_000_000 / freq_hz)
+        }
+        CLOCK_REALTIME_COARSE | CLOCK_MONOTONIC_COARSE => {
+            // 上一个 tick 的时间，与 vDSO 读同一份 vvar 数据
+            crate::arch::riscv64::vdso::coarse_time()
         }
         CLOCK_PROCESS_CPUTIME_ID | CLOCK_THREAD_CPUTIME_ID => {
             // 对于 CPU 时间，暂时返回 0
-            unsafe {
-                (*tp_ptr).tv_sec = 0;
-                (*tp_ptr).tv_nsec = 0;
-            }
-            0
+            (0, 0)
         }
         _ => {
             // 不支持的时钟类型
-            -22_i64 as u64  // EINVAL
+            return -22_i64 as u64;  // EINVAL
         }
+    };
+
+    let ts = TimespecForGettime { tv_sec: sec as i64, tv_nsec: nsec as i64 };
+    match crate::arch::riscv64::uaccess::put_user(tp_addr, &ts) {
+        Ok(()) => 0,
+        Err(e) => e as i64 as u64,
     }
 }
 
@@ -2136,97 +3032,204 @@ pub struct Timespec {
     pub tv_nsec: i64,  // 纳秒
 }
 
-fn sys_nanosleep(args: [u64; 6]) -> u64 {
-    use crate::drivers::timer;
-    use crate::process;
+/// 定时器设置 (struct itimerspec)
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct Itimerspec {
+    pub it_interval: Timespec,  // 周期
+    pub it_value: Timespec,     // 首次到期
+}
+
+/// timespec 转换为纳秒，字段超出范围返回 None (timespec64_valid)
+fn timespec_to_ns(ts: &Timespec) -> Option<u64> {
+    if ts.tv_sec < 0 || ts.tv_nsec < 0 || ts.tv_nsec >= 1_000_000_000 {
+        return None;
+    }
+    Some((ts.tv_sec as u64).saturating_mul(1_000_000_000).saturating_add(ts.tv_nsec as u64))
+}
 
+/// 纳秒转换为 timespec
+fn ns_to_timespec(ns: u64) -> Timespec {
+    Timespec {
+        tv_sec: (ns / 1_000_000_000) as i64,
+        tv_nsec: (ns % 1_000_000_000) as i64,
+    }
+}
+
+/// sys_nanosleep - 高精度睡眠
+///
+/// # 参数
+/// - args[0]: req - 请求的睡眠时间
+/// - args[1]: rem - 被信号打断时写入剩余时间，可以为空
+///
+/// 睡在一个 hrtimer 上，到期时间精确到时钟周期，不再按 jiffies 轮询
+fn sys_nanosleep(args: [u64; 6]) -> u64 {
     let req_ptr = args[0] as *const Timespec;
     let rem_ptr = args[1] as *mut Timespec;
 
     // 检查请求指针有效性
-    if req_ptr.is_null() {
-        println!("sys_nanosleep: null req pointer");
+    if !user_range_ok(req_ptr as usize, core::mem::size_of::<Timespec>()) {
+        tracepoint!(SYSCALL, "sys_nanosleep: bad req pointer");
         return -14_i64 as u64;  // EFAULT
     }
 
     // 读取请求的睡眠时间
-    let req = unsafe { *req_ptr };
-    let total_nanos = req.tv_sec * 1_000_000_000 + req.tv_nsec;
-
-    println!("sys_nanosleep: sleeping for {}s {}ns (total {}ns)",
-             req.tv_sec, req.tv_nsec, total_nanos);
+    let req = unsafe { core::ptr::read_unaligned(req_ptr) };
+    let total_nanos = match timespec_to_ns(&req) {
+        Some(ns) => ns,
+        None => return -22_i64 as u64,  // EINVAL
+    };
 
-    // 转换为毫秒
-    let sleep_msecs = (total_nanos / 1_000_000) as u64;
+    tracepoint!(SYSCALL, "sys_nanosleep: sleeping for {}s {}ns (total {}ns)",
+                         req.tv_sec, req.tv_nsec, total_nanos);
 
-    // 如果睡眠时间为 0，直接返回
-    if sleep_msecs == 0 {
-        return 0;
+    let expires = crate::time::ktime_get().saturating_add(total_nanos);
+    match crate::time::hrtimer::hrtimer_nanosleep(expires) {
+        Ok(()) => 0,
+        Err(remaining) => {
+            tracepoint!(SYSCALL, "sys_nanosleep: interrupted by signal, {}ns left", remaining);
+            // 写入剩余时间到 rem（如果提供了 rem_ptr）
+            if user_range_ok(rem_ptr as usize, core::mem::size_of::<Timespec>()) {
+                unsafe { core::ptr::write_unaligned(rem_ptr, ns_to_timespec(remaining)) };
+            }
+            -4_i64 as u64  // EINTR
+        }
     }
+}
 
-    // 获取当前 jiffies
-    let start_jiffies = timer::get_jiffies();
-
-    // 计算目标 jiffies
-    let sleep_jiffies = timer::msecs_to_jiffies(sleep_msecs);
-    let target_jiffies = start_jiffies + sleep_jiffies;
+/// sys_timerfd_create - 创建 timerfd
+///
+/// # 参数
+/// - args[0]: clockid - CLOCK_REALTIME / CLOCK_MONOTONIC / CLOCK_BOOTTIME
+/// - args[1]: flags - TFD_CLOEXEC | TFD_NONBLOCK
+fn sys_timerfd_create(args: [u64; 6]) -> u64 {
+    use crate::fs::timerfd::{timerfd_create_file, TFD_CLOEXEC};
 
-    println!("sys_nanosleep: start_jiffies={}, sleep_jiffies={}, target={}",
-             start_jiffies, sleep_jiffies, target_jiffies);
+    let clockid = args[0] as i32;
+    let flags = args[1] as u32;
+    let file = match timerfd_create_file(clockid, flags) {
+        Ok(file) => file,
+        Err(e) => return e as i64 as u64,
+    };
+    if flags & TFD_CLOEXEC != 0 {
+        file.set_cloexec(true);
+    }
+    match unsafe { crate::fs::file::get_file_fd_install(file.clone()) } {
+        Some(fd) => {
+            tracepoint!(SYSCALL, "timerfd_create: clock {} fd {}", clockid, fd);
+            fd as u64
+        }
+        None => {
+            crate::fs::file::fput(file);
+            -24_i64 as u64  // EMFILE
+        }
+    }
+}
 
-    // 循环睡眠，直到达到目标时间
-    loop {
-        let current_jiffies = timer::get_jiffies();
+/// 由描述符得到 timerfd 文件
+fn timerfd_fget(fd: i32) -> Result<alloc::sync::Arc<crate::fs::File>, u64> {
+    if fd < 0 {
+        return Err(-9_i64 as u64);  // EBADF
+    }
+    let file = match unsafe { crate::fs::get_file_fd(fd as usize) } {
+        Some(file) => file,
+        None => return Err(-9_i64 as u64),  // EBADF
+    };
+    if crate::fs::timerfd::file_timerfd(&file).is_none() {
+        return Err(-22_i64 as u64);  // EINVAL
+    }
+    Ok(file)
+}
 
-        // 检查是否已经达到目标时间
-        if current_jiffies >= target_jiffies {
-            println!("sys_nanosleep: sleep completed, current_jiffies={}", current_jiffies);
-            return 0;  // 成功
-        }
+/// 把 timerfd 的设置写回用户空间
+fn put_itimerspec(ptr: *mut Itimerspec, spec: crate::fs::timerfd::TimerFdSpec) {
+    let its = Itimerspec {
+        it_interval: ns_to_timespec(spec.interval),
+        it_value: ns_to_timespec(spec.value),
+    };
+    unsafe { core::ptr::write_unaligned(ptr, its) };
+}
 
-        // 计算剩余时间
-        let remaining_jiffies = target_jiffies - current_jiffies;
-        let remaining_msecs = timer::jiffies_to_msecs(remaining_jiffies);
+/// sys_timerfd_settime - 启动或停止 timerfd
+///
+/// # 参数
+/// - args[0]: fd - timerfd
+/// - args[1]: flags - TFD_TIMER_ABSTIME
+/// - args[2]: new_value - 新的设置，it_value 为 0 表示停止
+/// - args[3]: old_value - 原来的设置，可以为空
+fn sys_timerfd_settime(args: [u64; 6]) -> u64 {
+    use crate::fs::timerfd::{timerfd_settime, TimerFdSpec, TFD_TIMER_ABSTIME};
 
-        println!("sys_nanosleep: sleeping, remaining {} msecs", remaining_msecs);
+    let fd = args[0] as i32;
+    let flags = args[1] as i32;
+    let new_ptr = args[2] as *const Itimerspec;
+    let old_ptr = args[3] as *mut Itimerspec;
 
-        // 检查是否有待处理信号
-        use crate::signal;
-        if signal::signal_pending() {
-            println!("sys_nanosleep: interrupted by signal");
+    if flags & !TFD_TIMER_ABSTIME != 0 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    if !user_range_ok(new_ptr as usize, core::mem::size_of::<Itimerspec>()) {
+        return -14_i64 as u64;  // EFAULT
+    }
+    if !old_ptr.is_null() && !user_range_ok(old_ptr as usize, core::mem::size_of::<Itimerspec>()) {
+        return -14_i64 as u64;  // EFAULT
+    }
+    let new = unsafe { core::ptr::read_unaligned(new_ptr) };
+    let spec = match (timespec_to_ns(&new.it_value), timespec_to_ns(&new.it_interval)) {
+        (Some(value), Some(interval)) => TimerFdSpec { value, interval },
+        _ => return -22_i64 as u64,  // EINVAL
+    };
+    let file = match timerfd_fget(fd) {
+        Ok(file) => file,
+        Err(e) => return e,
+    };
+    let ctx = match crate::fs::timerfd::file_timerfd(&file) {
+        Some(ctx) => ctx,
+        None => return -22_i64 as u64,  // EINVAL
+    };
+    tracepoint!(SYSCALL, "timerfd_settime: fd {} value {}ns interval {}ns", fd, spec.value, spec.interval);
+    let old = timerfd_settime(ctx, flags, spec);
+    if !old_ptr.is_null() {
+        put_itimerspec(old_ptr, old);
+    }
+    0
+}
 
-            // 写入剩余时间到 rem（如果提供了 rem_ptr）
-            if !rem_ptr.is_null() {
-                unsafe {
-                    // 将毫秒转换为 timespec
-                    let rem_sec = (remaining_msecs / 1000) as i64;
-                    let rem_nsec = ((remaining_msecs % 1000) * 1_000_000) as i64;
-                    *rem_ptr = Timespec {
-                        tv_sec: rem_sec,
-                        tv_nsec: rem_nsec,
-                    };
-                }
-            }
+/// sys_timerfd_gettime - 读取 timerfd 距下次到期的时间与周期
+///
+/// # 参数
+/// - args[0]: fd - timerfd
+/// - args[1]: curr_value - 写入当前设置
+fn sys_timerfd_gettime(args: [u64; 6]) -> u64 {
+    let fd = args[0] as i32;
+    let curr_ptr = args[1] as *mut Itimerspec;
 
-            return -4_i64 as u64;  // EINTR
+    if !user_range_ok(curr_ptr as usize, core::mem::size_of::<Itimerspec>()) {
+        return -14_i64 as u64;  // EFAULT
+    }
+    let file = match timerfd_fget(fd) {
+        Ok(file) => file,
+        Err(e) => return e,
+    };
+    match crate::fs::timerfd::file_timerfd(&file) {
+        Some(ctx) => {
+            put_itimerspec(curr_ptr, crate::fs::timerfd::timerfd_gettime(ctx));
+            0
         }
-
-        // 使用 Task::sleep() 进入可中断睡眠
-        // 注意：这里会触发调度，醒来后继续检查时间
-        process::Task::sleep(crate::process::task::TaskState::Interruptible);
+        None => -22_i64 as u64,  // EINVAL
     }
 }
 
 fn sys_dup(args: [u64; 6]) -> u64 {
     let oldfd = args[0] as usize;
-    println!("sys_dup: oldfd={}", oldfd);
+    tracepoint!(SYSCALL, "sys_dup: oldfd={}", oldfd);
     -24_i64 as u64  // EMFILE
 }
 
 fn sys_dup2(args: [u64; 6]) -> u64 {
     let oldfd = args[0] as usize;
     let newfd = args[1] as usize;
-    println!("sys_dup2: oldfd={}, newfd={}", oldfd, newfd);
+    tracepoint!(SYSCALL, "sys_dup2: oldfd={}, newfd={}", oldfd, newfd);
     -24_i64 as u64  // EMFILE
 }
 
@@ -2247,11 +3250,11 @@ fn sys_fstat(args: [u64; 6]) -> u64 {
     let fd = args[0] as usize;
     let statbuf = args[1] as *mut Stat;
 
-    println!("sys_fstat: fd={}, statbuf={:#x}", fd, statbuf as usize);
+    tracepoint!(SYSCALL, "sys_fstat: fd={}, statbuf={:#x}", fd, statbuf as usize);
 
     // 检查 statbuf 指针有效性
     if statbuf.is_null() {
-        println!("sys_fstat: null statbuf pointer");
+        tracepoint!(SYSCALL, "sys_fstat: null statbuf pointer");
         return -14_i64 as u64;  // EFAULT
     }
 
@@ -2261,7 +3264,7 @@ fn sys_fstat(args: [u64; 6]) -> u64 {
     // 调用 VFS 层的 file_stat
     match file_stat(fd, &mut stat) {
         Ok(()) => {
-            println!("sys_fstat: success for fd={}, mode={:#o}", fd, stat.st_mode);
+            tracepoint!(SYSCALL, "sys_fstat: success for fd={}, mode={:#o}", fd, stat.st_mode);
             // 将 stat 结构复制到用户空间
             unsafe {
                 *statbuf = stat;
@@ -2269,12 +3272,139 @@ fn sys_fstat(args: [u64; 6]) -> u64 {
             0  // 成功
         }
         Err(errno) => {
-            println!("sys_fstat: file_stat failed for fd={}, error={}", fd, errno);
+            tracepoint!(SYSCALL, "sys_fstat: file_stat failed for fd={}, error={}", fd, errno);
             errno as u64  // 返回错误码
         }
     }
 }
 
+/// 读取 *at 系统调用的路径参数，按 dirfd 转换为绝对路径
+///
+/// # 返回
+/// 路径为空时返回空串，由调用者按 AT_EMPTY_PATH 处理
+fn user_at_path(dirfd: i32, pathname: usize) -> Result<alloc::string::String, i32> {
+    use crate::arch::riscv64::uaccess::strncpy_from_user;
+
+    if pathname == 0 {
+        return Err(-14);  // EFAULT
+    }
+    let mut buf = [0u8; 256];
+    let path = match strncpy_from_user(&mut buf, pathname) {
+        Ok(len) if len == buf.len() => return Err(-36),  // ENAMETOOLONG
+        Ok(len) => &buf[..len],
+        Err(e) => return Err(e),
+    };
+    let path = core::str::from_utf8(path).map_err(|_| -22)?;  // EINVAL
+    if path.is_empty() {
+        return Ok(alloc::string::String::new());
+    }
+    crate::fs::at_path(dirfd, path)
+}
+
+/// 按 dirfd 与路径获取文件状态 (vfs_statx)
+///
+/// 路径按 dirfd 解析后经 path_stat 查找，不打开文件；路径为空且带 AT_EMPTY_PATH 时取 dirfd 本身。
+/// 查找与 open 相同，AT_SYMLINK_NOFOLLOW 与 AT_STATX_SYNC_TYPE 接受但不改变结果
+///
+/// # 返回
+/// 成功返回实际填充的字段 (STATX_*)
+fn vfs_statx(dirfd: i32, pathname: usize, flags: u32, mask: u32, stat: &mut crate::fs::Stat) -> Result<u32, i32> {
+    use crate::fs::stat::{AT_EMPTY_PATH, AT_FDCWD, AT_NO_AUTOMOUNT, AT_STATX_SYNC_TYPE, AT_SYMLINK_NOFOLLOW, STATX_BASIC_STATS};
+
+    if flags & !(AT_SYMLINK_NOFOLLOW | AT_NO_AUTOMOUNT | AT_EMPTY_PATH | AT_STATX_SYNC_TYPE) != 0 {
+        return Err(-22);  // EINVAL
+    }
+    let path = user_at_path(dirfd, pathname)?;
+    if !path.is_empty() {
+        return crate::fs::path_stat(&path, mask, stat);
+    }
+    if flags & AT_EMPTY_PATH == 0 {
+        return Err(-2);  // ENOENT
+    }
+    if dirfd == AT_FDCWD {
+        // 没有进程当前目录，按根目录处理
+        return crate::fs::path_stat("/", mask, stat);
+    }
+    crate::fs::file_stat(dirfd as usize, stat).map(|()| STATX_BASIC_STATS)
+}
+
+/// sys_newfstatat - 按路径获取文件状态信息
+///
+/// # 参数
+/// - args[0] (dirfd): 相对路径的起点目录，AT_FDCWD 表示当前目录
+/// - args[1] (pathname): 路径指针
+/// - args[2] (statbuf): 指向 stat 结构的指针
+/// - args[3] (flags): AT_SYMLINK_NOFOLLOW / AT_EMPTY_PATH
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码
+///
+/// - RISC-V: 79
+fn sys_newfstatat(args: [u64; 6]) -> u64 {
+    use crate::arch::riscv64::uaccess::put_user;
+    use crate::fs::stat::STATX_BASIC_STATS;
+    use crate::fs::Stat;
+
+    let dirfd = args[0] as i32;
+    let statbuf = args[2] as usize;
+    let flags = args[3] as u32;
+
+    tracepoint!(SYSCALL, "sys_newfstatat: dirfd={}, statbuf={:#x}, flags={:#x}", dirfd, statbuf, flags);
+
+    let mut stat = Stat::new();
+    match vfs_statx(dirfd, args[1] as usize, flags, STATX_BASIC_STATS, &mut stat) {
+        Ok(_) => match put_user(statbuf, &stat) {
+            Ok(()) => 0,
+            Err(e) => e as i64 as u64,
+        },
+        Err(e) => e as i64 as u64,
+    }
+}
+
+/// sys_statx - 按路径获取扩展文件状态信息
+///
+/// mask 说明调用者需要的字段，只要类型、权限等的调用者不必查找文件当前的大小；
+/// 返回的 stx_mask 是实际填充的字段
+///
+/// # 参数
+/// - args[0] (dirfd): 相对路径的起点目录，AT_FDCWD 表示当前目录
+/// - args[1] (pathname): 路径指针
+/// - args[2] (flags): AT_SYMLINK_NOFOLLOW / AT_EMPTY_PATH / AT_STATX_SYNC_TYPE
+/// - args[3] (mask): 需要的字段 (STATX_*)
+/// - args[4] (statxbuf): 指向 statx 结构的指针
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码
+///
+/// - RISC-V: 291
+fn sys_statx(args: [u64; 6]) -> u64 {
+    use crate::arch::riscv64::uaccess::put_user;
+    use crate::fs::stat::Statx;
+    use crate::fs::Stat;
+
+    /// 保留给以后扩展 struct statx 的位 (STATX__RESERVED)
+    const STATX_RESERVED: u32 = 0x8000_0000;
+
+    let dirfd = args[0] as i32;
+    let flags = args[2] as u32;
+    let mask = args[3] as u32;
+    let statxbuf = args[4] as usize;
+
+    tracepoint!(SYSCALL, "sys_statx: dirfd={}, flags={:#x}, mask={:#x}", dirfd, flags, mask);
+
+    if mask & STATX_RESERVED != 0 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    let mut stat = Stat::new();
+    match vfs_statx(dirfd, args[1] as usize, flags, mask, &mut stat) {
+        Ok(filled) => match put_user(statxbuf, &Statx::from_stat(&stat, filled)) {
+            Ok(()) => 0,
+            Err(e) => e as i64 as u64,
+        },
+        Err(e) => e as i64 as u64,
+    }
+}
+
 /// sys_getdents64 - 读取目录项
 ///
 ///
@@ -2302,45 +3432,10 @@ fn sys_getdents64(args: [u64; 6]) -> u64 {
         return -22_i64 as u64;  // EINVAL
     }
 
-    // 创建临时缓冲区
-    let mut buffer = alloc::vec::Vec::with_capacity(count);
-    unsafe {
-        buffer.set_len(count);
-    }
-
-    // 调用 VFS 层
-    let result = file_getdents64(fd, &mut buffer, count);
-    match result {
-        Ok(bytes_read) => {
-            // 将数据复制到用户空间
-            // 需要启用 sstatus.SUM 位以允许内核访问用户空间内存
-            // SUM 位是 sstatus 的 bit 18 (0x40000)
-            unsafe {
-                let sstatus: u64;
-                let sum_bit: u64 = 0x40000;  // SUM 位 (bit 18)
-                core::arch::asm!(
-                    "csrr {sstatus}, sstatus",
-                    "or {tmp}, {sstatus}, {sum}",
-                    "csrw sstatus, {tmp}",
-                    sstatus = out(reg) sstatus,
-                    tmp = out(reg) _,
-                    sum = in(reg) sum_bit,
-                );
-
-                // 复制数据到用户空间
-                core::ptr::copy_nonoverlapping(buffer.as_ptr(), dirp, bytes_read);
-
-                // 恢复 sstatus
-                core::arch::asm!(
-                    "csrw sstatus, {sstatus}",
-                    sstatus = in(reg) sstatus,
-                );
-            }
-            bytes_read as u64
-        }
-        Err(errno) => {
-            errno as i64 as u64
-        }
+    // 目录项由 VFS 以 copy_to_user 直接写入用户缓冲区
+    match file_getdents64(fd, dirp as usize, count) {
+        Ok(bytes_read) => bytes_read as u64,
+        Err(errno) => errno as i64 as u64,
     }
 }
 
@@ -2357,6 +3452,152 @@ fn sys_fcntl(args: [u64; 6]) -> u64 {
     }
 }
 
+/// perf 事件的 ioctl (perf_ioctl)
+///
+/// ENABLE / DISABLE / RESET 的参数是 PERF_IOC_FLAG_GROUP，没有事件组时忽略
+fn perf_ioctl(event: &crate::perf_event::PerfEvent, cmd: u32, arg: usize) -> u64 {
+    use crate::perf_event::*;
+
+    match cmd {
+        PERF_EVENT_IOC_ENABLE => event.enable(),
+        PERF_EVENT_IOC_DISABLE => event.disable(),
+        PERF_EVENT_IOC_RESET => event.reset(),
+        PERF_EVENT_IOC_ID => {
+            if !user_range_ok(arg, 8) {
+                return -14_i64 as u64;  // EFAULT
+            }
+            unsafe { core::ptr::write_unaligned(arg as *mut u64, event.id()) };
+        }
+        _ => return -25_i64 as u64,  // ENOTTY
+    }
+    0
+}
+
+/// sys_perf_event_open - 打开性能计数事件
+///
+/// # 参数
+/// - args[0]: attr - struct perf_event_attr 指针
+/// - args[1]: pid - 0 为当前任务，大于 0 为指定任务，-1 为 CPU 上的所有任务
+/// - args[2]: cpu - -1 为任意 CPU
+/// - args[3]: group_fd - 只支持 -1（不使用事件组）
+/// - args[4]: flags - 只支持 PERF_FLAG_FD_CLOEXEC
+fn sys_perf_event_open(args: [u64; 6]) -> u64 {
+    use crate::perf_event::{perf_event_create, perf_event_create_file, PerfEventAttr, PERF_ATTR_SIZE_VER0, PERF_FLAG_FD_CLOEXEC};
+
+    let attr_ptr = args[0] as usize;
+    let pid = args[1] as i32;
+    let cpu = args[2] as i32;
+    let group_fd = args[3] as i32;
+    let flags = args[4];
+
+    if flags & !PERF_FLAG_FD_CLOEXEC != 0 || group_fd != -1 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    if !user_range_ok(attr_ptr, 8) {
+        return -14_i64 as u64;  // EFAULT
+    }
+    // size 为 0 按第一版结构处理，更小的结构无法解析
+    let size = unsafe { core::ptr::read_unaligned((attr_ptr + 4) as *const u32) };
+    let size = if size == 0 { PERF_ATTR_SIZE_VER0 } else { size };
+    if size < PERF_ATTR_SIZE_VER0 {
+        return -7_i64 as u64;  // E2BIG
+    }
+    if !user_range_ok(attr_ptr, core::mem::size_of::<PerfEventAttr>()) {
+        return -14_i64 as u64;  // EFAULT
+    }
+    let attr = unsafe { core::ptr::read_unaligned(attr_ptr as *const PerfEventAttr) };
+    let event = match perf_event_create(&attr, pid, cpu) {
+        Ok(event) => event,
+        Err(e) => return e as i64 as u64,
+    };
+    let file = perf_event_create_file(event);
+    if flags & PERF_FLAG_FD_CLOEXEC != 0 {
+        file.set_cloexec(true);
+    }
+    match unsafe { crate::fs::file::get_file_fd_install(file.clone()) } {
+        Some(fd) => {
+            tracepoint!(SYSCALL, "perf_event_open: type {} config {} pid {} cpu {} fd {}", attr.type_, attr.config, pid, cpu, fd);
+            fd as u64
+        }
+        None => {
+            crate::fs::file::fput(file);
+            -24_i64 as u64  // EMFILE
+        }
+    }
+}
+
+/// sys_syslog - 读取或控制内核日志缓冲区 (do_syslog)
+///
+/// # 参数
+/// - args[0]: type - SYSLOG_ACTION_*
+/// - args[1]: buf - READ / READ_ALL / READ_CLEAR 的用户缓冲区
+/// - args[2]: len - 缓冲区长度，CONSOLE_LEVEL 时为新的控制台级别
+///
+/// READ 不阻塞，没有新日志时返回 0
+fn sys_syslog(args: [u64; 6]) -> u64 {
+    use crate::printk;
+
+    let action = args[0] as i32;
+    let buf = args[1] as usize;
+    let len = args[2] as i64;
+
+    let copy_out = |data: alloc::vec::Vec<u8>| -> u64 {
+        unsafe { core::ptr::copy_nonoverlapping(data.as_ptr(), buf as *mut u8, data.len()) };
+        data.len() as u64
+    };
+    match action {
+        // SYSLOG_ACTION_CLOSE / SYSLOG_ACTION_OPEN
+        0 | 1 => 0,
+        // SYSLOG_ACTION_READ / SYSLOG_ACTION_READ_ALL / SYSLOG_ACTION_READ_CLEAR
+        2 | 3 | 4 => {
+            if len < 0 {
+                return -22_i64 as u64;  // EINVAL
+            }
+            if len == 0 {
+                return 0;
+            }
+            if !user_range_ok(buf, len as usize) {
+                return -14_i64 as u64;  // EFAULT
+            }
+            if action == 2 {
+                return copy_out(printk::syslog_read(len as usize));
+            }
+            let copied = copy_out(printk::syslog_read_all(len as usize));
+            if action == 4 {
+                printk::syslog_clear();
+            }
+            copied
+        }
+        // SYSLOG_ACTION_CLEAR
+        5 => {
+            printk::syslog_clear();
+            0
+        }
+        // SYSLOG_ACTION_CONSOLE_OFF / SYSLOG_ACTION_CONSOLE_ON
+        6 => {
+            printk::console_off();
+            0
+        }
+        7 => {
+            printk::console_on();
+            0
+        }
+        // SYSLOG_ACTION_CONSOLE_LEVEL
+        8 => {
+            if !(1..=8).contains(&len) {
+                return -22_i64 as u64;  // EINVAL
+            }
+            printk::set_console_loglevel(len as u8);
+            0
+        }
+        // SYSLOG_ACTION_SIZE_UNREAD
+        9 => printk::syslog_unread_size() as u64,
+        // SYSLOG_ACTION_SIZE_BUFFER
+        10 => printk::LOG_BUF_LEN as u64,
+        _ => -22_i64 as u64,  // EINVAL
+    }
+}
+
 /// sys_ioctl - 设备控制
 ///
 ///
@@ -2379,6 +3620,30 @@ fn sys_ioctl(args: [u64; 6]) -> u64 {
         return crate::drivers::gpu::fbdev_ioctl(cmd, arg) as u64;
     }
 
+    // perf 事件 (perf_ioctl)
+    if fd >= 0 {
+        if let Some(file) = unsafe { crate::fs::get_file_fd(fd as usize) } {
+            if let Some(event) = crate::perf_event::file_perf_event(&file) {
+                return perf_ioctl(event, cmd, arg);
+            }
+            // ext4 的命令 (ext4_ioctl)
+            if let Some(fs) = crate::fs::vfs::file_ext4_fs(&file) {
+                if let Some(ret) = crate::fs::ext4::ioctl::ext4_ioctl(fs, cmd, arg) {
+                    return ret as i64 as u64;
+                }
+            }
+        }
+    }
+
+    // 串口终端的 termios 与输入缓冲区 (tty_ioctl)
+    let is_tty = fd >= 0
+        && unsafe { crate::fs::get_file_fd(fd as usize) }.map_or(false, |file| crate::fs::char_dev::is_uart_file(&file));
+    if is_tty {
+        if let Some(ret) = crate::drivers::tty::tty_ioctl(cmd, arg) {
+            return ret as u64;
+        }
+    }
+
     // TTY ioctl 命令
     match cmd {
         // TCGETS - 获取终端属性 (0x5401)
@@ -2497,7 +3762,7 @@ fn sys_mkdir(args: [u64; 6]) -> u64 {
 
     // 检查路径指针有效性
     if pathname_ptr.is_null() {
-        println!("sys_mkdir: null pathname pointer");
+        tracepoint!(SYSCALL, "sys_mkdir: null pathname pointer");
         return -14_i64 as u64;  // EFAULT
     }
 
@@ -2520,12 +3785,12 @@ fn sys_mkdir(args: [u64; 6]) -> u64 {
     let pathname_str = match core::str::from_utf8(pathname) {
         Ok(s) => s,
         Err(_) => {
-            println!("sys_mkdir: invalid utf-8 pathname");
+            tracepoint!(SYSCALL, "sys_mkdir: invalid utf-8 pathname");
             return -22_i64 as u64;  // EINVAL
         }
     };
 
-    println!("sys_mkdir: pathname='{}', mode={:#o}", pathname_str, mode);
+    tracepoint!(SYSCALL, "sys_mkdir: pathname='{}', mode={:#o}", pathname_str, mode);
 
     // 调用 VFS 层创建目录
     match file_mkdir(pathname_str, mode) {
@@ -2534,78 +3799,60 @@ fn sys_mkdir(args: [u64; 6]) -> u64 {
     }
 }
 
-/// sys_rmdir - 删除目录
+/// sys_unlinkat - 删除文件或目录
+///
+/// # 参数
+/// - args[0] (dirfd): 相对路径的起点目录，AT_FDCWD 表示当前目录
+/// - args[1] (pathname): 路径指针
+/// - args[2] (flags): AT_REMOVEDIR 时删除目录
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码
+///
+/// - RISC-V: 35
+fn sys_unlinkat(args: [u64; 6]) -> u64 {
+    use crate::fs::stat::AT_REMOVEDIR;
+    use crate::fs::{file_rmdir, file_unlink};
+
+    let dirfd = args[0] as i32;
+    let flags = args[2] as u32;
+
+    if flags & !AT_REMOVEDIR != 0 {
+        return -22_i64 as u64;  // EINVAL
+    }
+    let path = match user_at_path(dirfd, args[1] as usize) {
+        Ok(path) if path.is_empty() => return -2_i64 as u64,  // ENOENT
+        Ok(path) => path,
+        Err(e) => return e as i64 as u64,
+    };
+
+    tracepoint!(SYSCALL, "sys_unlinkat: pathname='{}', flags={:#x}", path, flags);
+
+    let result = if flags & AT_REMOVEDIR != 0 { file_rmdir(&path) } else { file_unlink(&path) };
+    match result {
+        Ok(()) => 0,
+        Err(errno) => errno as i64 as u64,
+    }
+}
+
+/// sys_unlink - 删除文件
 ///
 ///
 /// # 参数
-/// - args[0] (pathname): 目录路径指针
+/// - args[0] (pathname): 文件路径指针
 ///
 /// # 返回
 /// 成功返回 0，失败返回负错误码
 ///
-/// - RISC-V: 79
-fn sys_rmdir(args: [u64; 6]) -> u64 {
-    use crate::fs::file_rmdir;
+/// - RISC-V: 74 (unlinkat), 我们实现简化版 unlink
+fn sys_unlink(args: [u64; 6]) -> u64 {
+    use crate::fs::file_unlink;
 
     let pathname_ptr = args[0] as *const u8;
 
     // 检查路径指针有效性
     if pathname_ptr.is_null() {
-        println!("sys_rmdir: null pathname pointer");
-        return -14_i64 as u64;  // EFAULT
-    }
-
-    // 读取目录名（假设以 null 结尾，最大长度 256）
-    let pathname = unsafe {
-        let mut len = 0;
-        let mut ptr = pathname_ptr;
-        while len < 256 {
-            let byte = *ptr;
-            if byte == 0 {
-                break;
-            }
-            len += 1;
-            ptr = ptr.add(1);
-        }
-        core::slice::from_raw_parts(pathname_ptr, len)
-    };
-
-    // 转换为字符串
-    let pathname_str = match core::str::from_utf8(pathname) {
-        Ok(s) => s,
-        Err(_) => {
-            println!("sys_rmdir: invalid utf-8 pathname");
-            return -22_i64 as u64;  // EINVAL
-        }
-    };
-
-    println!("sys_rmdir: pathname='{}'", pathname_str);
-
-    // 调用 VFS 层删除目录
-    match file_rmdir(pathname_str) {
-        Ok(()) => 0,  // 成功
-        Err(errno) => errno as u64,
-    }
-}
-
-/// sys_unlink - 删除文件
-///
-///
-/// # 参数
-/// - args[0] (pathname): 文件路径指针
-///
-/// # 返回
-/// 成功返回 0，失败返回负错误码
-///
-/// - RISC-V: 74 (unlinkat), 我们实现简化版 unlink
-fn sys_unlink(args: [u64; 6]) -> u64 {
-    use crate::fs::file_unlink;
-
-    let pathname_ptr = args[0] as *const u8;
-
-    // 检查路径指针有效性
-    if pathname_ptr.is_null() {
-        println!("sys_unlink: null pathname pointer");
+        tracepoint!(SYSCALL, "sys_unlink: null pathname pointer");
         return -14_i64 as u64;  // EFAULT
     }
 
@@ -2628,12 +3875,12 @@ fn sys_unlink(args: [u64; 6]) -> u64 {
     let pathname_str = match core::str::from_utf8(pathname) {
         Ok(s) => s,
         Err(_) => {
-            println!("sys_unlink: invalid utf-8 pathname");
+            tracepoint!(SYSCALL, "sys_unlink: invalid utf-8 pathname");
             return -22_i64 as u64;  // EINVAL
         }
     };
 
-    println!("sys_unlink: pathname='{}'", pathname_str);
+    tracepoint!(SYSCALL, "sys_unlink: pathname='{}'", pathname_str);
 
     // 调用 VFS 层删除文件
     match file_unlink(pathname_str) {
@@ -2661,11 +3908,11 @@ fn sys_link(args: [u64; 6]) -> u64 {
 
     // 检查路径指针有效性
     if oldpath_ptr.is_null() {
-        println!("sys_link: null oldpath pointer");
+        tracepoint!(SYSCALL, "sys_link: null oldpath pointer");
         return -14_i64 as u64;  // EFAULT
     }
     if newpath_ptr.is_null() {
-        println!("sys_link: null newpath pointer");
+        tracepoint!(SYSCALL, "sys_link: null newpath pointer");
         return -14_i64 as u64;  // EFAULT
     }
 
@@ -2703,7 +3950,7 @@ fn sys_link(args: [u64; 6]) -> u64 {
     let oldpath_str = match core::str::from_utf8(oldpath) {
         Ok(s) => s,
         Err(_) => {
-            println!("sys_link: invalid utf-8 oldpath");
+            tracepoint!(SYSCALL, "sys_link: invalid utf-8 oldpath");
             return -22_i64 as u64;  // EINVAL
         }
     };
@@ -2711,12 +3958,12 @@ fn sys_link(args: [u64; 6]) -> u64 {
     let newpath_str = match core::str::from_utf8(newpath) {
         Ok(s) => s,
         Err(_) => {
-            println!("sys_link: invalid utf-8 newpath");
+            tracepoint!(SYSCALL, "sys_link: invalid utf-8 newpath");
             return -22_i64 as u64;  // EINVAL
         }
     };
 
-    println!("sys_link: oldpath='{}', newpath='{}'", oldpath_str, newpath_str);
+    tracepoint!(SYSCALL, "sys_link: oldpath='{}', newpath='{}'", oldpath_str, newpath_str);
 
     // 调用 VFS 层创建硬链接
     match file_link(oldpath_str, newpath_str) {
@@ -2733,8 +3980,8 @@ fn sys_link(args: [u64; 6]) -> u64 {
 ///
 ///
 /// # 参数
-/// - args[0] (domain): 协议族 (AF_INET=2)
-/// - args[1] (type): socket 类型 (SOCK_STREAM=1, SOCK_DGRAM=2)
+/// - args[0] (domain): 协议族 (AF_UNIX=1, AF_INET=2)
+/// - args[1] (type): socket 类型 (SOCK_STREAM=1, SOCK_DGRAM=2, AF_UNIX 另有 SOCK_SEQPACKET=5)
 /// - args[2] (protocol): 协议类型 (IPPROTO_TCP=6, IPPROTO_UDP=17)
 ///
 /// # 返回
@@ -2746,27 +3993,41 @@ fn sys_socket(args: [u64; 6]) -> u64 {
     let type_ = args[1] as i32;
     let protocol = args[2] as i32;
 
-    println!("sys_socket: domain={}, type={}, protocol={}", domain, type_, protocol);
+    tracepoint!(SYSCALL, "sys_socket: domain={}, type={}, protocol={}", domain, type_, protocol);
 
-    // 目前只支持 AF_INET (IPv4)
+    // Unix 域套接字是文件描述符表中的文件
+    if domain == crate::net::unix::AF_UNIX {
+        if protocol != 0 {
+            return -93_i64 as u64;  // EPROTONOSUPPORT
+        }
+        return match crate::net::unix::unix_create(type_ & crate::net::unix::SOCK_TYPE_MASK) {
+            Ok(sock) => unix_install_sock(sock, type_),
+            Err(e) => e as i64 as u64,
+        };
+    }
+
+    // 其余只支持 AF_INET (IPv4)
     if domain != 2 {
-        println!("sys_socket: unsupported domain {}", domain);
+        tracepoint!(SYSCALL, "sys_socket: unsupported domain {}", domain);
         return -97_i64 as u64;  // EAFNOSUPPORT
     }
 
-    match type_ {
+    use crate::net::unix::{SOCK_CLOEXEC, SOCK_NONBLOCK, SOCK_TYPE_MASK};
+
+    match type_ & SOCK_TYPE_MASK {
         1 => {
             // SOCK_STREAM (TCP)
             if protocol != 0 && protocol != 6 {
-                println!("sys_socket: invalid protocol {} for SOCK_STREAM", protocol);
+                tracepoint!(SYSCALL, "sys_socket: invalid protocol {} for SOCK_STREAM", protocol);
                 return -22_i64 as u64;  // EINVAL
             }
 
+            // TCP socket 是文件描述符表中的文件，文件保存 socket 表中的编号
             use crate::net::tcp;
             match tcp::tcp_socket_alloc() {
-                Ok(fd) => fd as u64,
+                Ok(sk) => tcp::tcp_sock_install(sk, type_ & SOCK_NONBLOCK != 0, type_ & SOCK_CLOEXEC != 0) as i64 as u64,
                 Err(e) => {
-                    println!("sys_socket: tcp_socket_alloc failed: {}", e);
+                    tracepoint!(SYSCALL, "sys_socket: tcp_socket_alloc failed: {}", e);
                     e as u64
                 }
             }
@@ -2774,7 +4035,7 @@ fn sys_socket(args: [u64; 6]) -> u64 {
         2 => {
             // SOCK_DGRAM (UDP)
             if protocol != 0 && protocol != 17 {
-                println!("sys_socket: invalid protocol {} for SOCK_DGRAM", protocol);
+                tracepoint!(SYSCALL, "sys_socket: invalid protocol {} for SOCK_DGRAM", protocol);
                 return -22_i64 as u64;  // EINVAL
             }
 
@@ -2782,18 +4043,104 @@ fn sys_socket(args: [u64; 6]) -> u64 {
             match udp::udp_socket_alloc() {
                 Ok(fd) => fd as u64,
                 Err(e) => {
-                    println!("sys_socket: udp_socket_alloc failed: {}", e);
+                    tracepoint!(SYSCALL, "sys_socket: udp_socket_alloc failed: {}", e);
                     e as u64
                 }
             }
         }
         _ => {
-            println!("sys_socket: unsupported socket type {}", type_);
+            tracepoint!(SYSCALL, "sys_socket: unsupported socket type {}", type_);
             -94_i64 as u64  // ESOCKTNOSUPPORT
         }
     }
 }
 
+/// 为 Unix 域套接字创建文件并安装到文件描述符表 (sock_map_fd)
+///
+/// # 参数
+/// - `type_`: socket() 的 type，取其中的 SOCK_NONBLOCK / SOCK_CLOEXEC
+fn unix_install_sock(sock: alloc::sync::Arc<crate::net::unix::UnixSock>, type_: i32) -> u64 {
+    use crate::net::unix::{unix_sock_file, SOCK_CLOEXEC, SOCK_NONBLOCK};
+
+    let file = unix_sock_file(sock, type_ & SOCK_NONBLOCK != 0);
+    if type_ & SOCK_CLOEXEC != 0 {
+        file.set_cloexec(true);
+    }
+    match unsafe { crate::fs::file::get_file_fd_install(file.clone()) } {
+        Some(fd) => fd as u64,
+        None => {
+            // 文件的最后一个引用：关闭套接字
+            crate::fs::file::fput(file);
+            -24_i64 as u64  // EMFILE
+        }
+    }
+}
+
+/// 按描述符查找 Unix 域套接字
+///
+/// # 返回
+/// (文件, 套接字)；不是 Unix 域套接字时返回 None
+fn unix_socket_fd(fd: i32) -> Option<(alloc::sync::Arc<crate::fs::File>, alloc::sync::Arc<crate::net::unix::UnixSock>)> {
+    if fd < 0 {
+        return None;
+    }
+    let file = unsafe { crate::fs::get_file_fd(fd as usize) }?;
+    let sock = crate::net::unix::unix_sock_arc(&file)?;
+    Some((file, sock))
+}
+
+/// sys_socketpair - 创建一对互相连接的 socket
+///
+/// # 参数
+/// - args[0] (domain): 协议族，只支持 AF_UNIX
+/// - args[1] (type): SOCK_STREAM / SOCK_DGRAM / SOCK_SEQPACKET，可带 SOCK_NONBLOCK / SOCK_CLOEXEC
+/// - args[2] (protocol): 必须为 0
+/// - args[3] (sv): 两个 int 的数组（输出）
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码
+///
+/// - RISC-V: 199
+fn sys_socketpair(args: [u64; 6]) -> u64 {
+    use crate::net::unix;
+
+    let domain = args[0] as i32;
+    let type_ = args[1] as i32;
+    let protocol = args[2] as i32;
+    let sv_ptr = args[3] as usize;
+
+    tracepoint!(SYSCALL, "sys_socketpair: domain={}, type={}", domain, type_);
+
+    if domain != unix::AF_UNIX {
+        return -95_i64 as u64;  // EOPNOTSUPP
+    }
+    if protocol != 0 {
+        return -93_i64 as u64;  // EPROTONOSUPPORT
+    }
+    if !user_range_ok(sv_ptr, 8) {
+        return -14_i64 as u64;  // EFAULT
+    }
+    let (a, b) = match unix::unix_socketpair(type_ & unix::SOCK_TYPE_MASK) {
+        Ok(pair) => pair,
+        Err(e) => return e as i64 as u64,
+    };
+    let fd0 = unix_install_sock(a, type_);
+    if (fd0 as i64) < 0 {
+        // a 已随文件关闭，b 不再被引用
+        return fd0;
+    }
+    let fd1 = unix_install_sock(b, type_);
+    if (fd1 as i64) < 0 {
+        let _ = unsafe { crate::fs::close_file_fd(fd0 as usize) };
+        return fd1;
+    }
+    unsafe {
+        *(sv_ptr as *mut i32) = fd0 as i32;
+        *((sv_ptr + 4) as *mut i32) = fd1 as i32;
+    }
+    0
+}
+
 /// sys_bind - 绑定 socket 到地址
 ///
 ///
@@ -2809,16 +4156,23 @@ fn sys_socket(args: [u64; 6]) -> u64 {
 fn sys_bind(args: [u64; 6]) -> u64 {
     let fd = args[0] as i32;
     let addr_ptr = args[1] as *const u8;
-    let _addrlen = args[2] as u32;
+    let addrlen = args[2] as u32;
 
-    println!("sys_bind: fd={}, addr={:#x}", fd, addr_ptr as usize);
+    tracepoint!(SYSCALL, "sys_bind: fd={}, addr={:#x}", fd, addr_ptr as usize);
 
     // 检查地址指针有效性
     if addr_ptr.is_null() {
-        println!("sys_bind: null addr pointer");
+        tracepoint!(SYSCALL, "sys_bind: null addr pointer");
         return -14_i64 as u64;  // EFAULT
     }
 
+    if let Some((_, sock)) = unix_socket_fd(fd) {
+        return match read_sockaddr_un(addr_ptr as usize, addrlen as usize) {
+            Ok(name) => crate::net::unix::unix_bind(&sock, &name) as i64 as u64,
+            Err(e) => e,
+        };
+    }
+
     // 读取 sockaddr_in 结构（简化实现）
     // struct sockaddr_in {
     //     sa_family_t sin_family;  // 2 bytes
@@ -2831,31 +4185,28 @@ fn sys_bind(args: [u64; 6]) -> u64 {
     let sin_port = unsafe { u16::from_be_bytes(*((addr_ptr.add(2)) as *const [u8; 2])) };
     let sin_addr = unsafe { u32::from_be_bytes(*((addr_ptr.add(4)) as *const [u8; 4])) };
 
-    println!("sys_bind: family={}, port={}, addr={:#x}", sin_family, sin_port, sin_addr);
+    tracepoint!(SYSCALL, "sys_bind: family={}, port={}, addr={:#x}", sin_family, sin_port, sin_addr);
 
     // 目前只支持 AF_INET
     if sin_family != 2 {
-        println!("sys_bind: unsupported family {}", sin_family);
+        tracepoint!(SYSCALL, "sys_bind: unsupported family {}", sin_family);
         return -97_i64 as u64;  // EAFNOSUPPORT
     }
 
-    // TODO: 需要一种方法确定 fd 是 TCP 还是 UDP socket
-    // 简化实现：尝试两种协议
     use crate::net::{tcp, udp};
 
-    // 先尝试 TCP
-    if let Some(_socket) = tcp::tcp_socket_get(fd) {
-        println!("sys_bind: binding TCP socket {} to port {}", fd, sin_port);
-        return tcp::tcp_bind(fd, sin_port) as u64;
+    // TCP socket 在文件描述符表中，UDP socket 仍用自己的表
+    if let Some(sk) = tcp::tcp_socket_fd(fd) {
+        tracepoint!(SYSCALL, "sys_bind: binding TCP socket {} to port {}", fd, sin_port);
+        return tcp::tcp_bind(sk, sin_port) as u64;
     }
 
-    // 再尝试 UDP
     if let Some(_socket) = udp::udp_socket_get(fd) {
-        println!("sys_bind: binding UDP socket {} to port {}", fd, sin_port);
+        tracepoint!(SYSCALL, "sys_bind: binding UDP socket {} to port {}", fd, sin_port);
         return udp::udp_bind(fd, sin_port) as u64;
     }
 
-    println!("sys_bind: invalid fd {}", fd);
+    tracepoint!(SYSCALL, "sys_bind: invalid fd {}", fd);
     -9_i64 as u64  // EBADF
 }
 
@@ -2874,14 +4225,18 @@ fn sys_listen(args: [u64; 6]) -> u64 {
     let fd = args[0] as i32;
     let backlog = args[1] as i32;
 
-    println!("sys_listen: fd={}, backlog={}", fd, backlog);
+    tracepoint!(SYSCALL, "sys_listen: fd={}, backlog={}", fd, backlog);
+
+    if let Some((_, sock)) = unix_socket_fd(fd) {
+        return crate::net::unix::unix_listen(&sock, backlog) as i64 as u64;
+    }
 
     use crate::net::tcp;
 
-    if let Some(_socket) = tcp::tcp_socket_get(fd) {
-        tcp::tcp_listen(fd, backlog as u32) as u64
+    if let Some(sk) = tcp::tcp_socket_fd(fd) {
+        tcp::tcp_listen(sk, backlog as u32) as u64
     } else {
-        println!("sys_listen: invalid fd {}", fd);
+        tracepoint!(SYSCALL, "sys_listen: invalid fd {}", fd);
         -9_i64 as u64  // EBADF
     }
 }
@@ -2895,163 +4250,1024 @@ fn sys_listen(args: [u64; 6]) -> u64 {
 /// - args[2] (addrlen): 地址长度指针（输入/输出）
 ///
 /// # 返回
-/// 成功返回新 socket 的文件描述符，失败返回负错误码
+/// 成功返回新 socket 的文件描述符，失败返回负错误码
+///
+/// - RISC-V: 202
+fn sys_accept(args: [u64; 6]) -> u64 {
+    let fd = args[0] as i32;
+    let addr_ptr = args[1] as *mut u8;
+    let addrlen_ptr = args[2] as *mut u32;
+
+    tracepoint!(SYSCALL, "sys_accept: fd={}", fd);
+
+    if let Some((file, sock)) = unix_socket_fd(fd) {
+        use crate::net::unix;
+        let newsk = match unix::unix_accept(&sock, unix::unix_file_nonblock(&file)) {
+            Ok(newsk) => newsk,
+            Err(e) => return e as i64 as u64,
+        };
+        // 对端（发起连接的一方）的地址
+        let peer_addr = unix::unix_getpeername(&newsk).ok().flatten();
+        let new_fd = unix_install_sock(newsk, 0);
+        if (new_fd as i64) >= 0 && !addr_ptr.is_null() && user_range_ok(addrlen_ptr as usize, 4) {
+            unsafe {
+                *addrlen_ptr = write_sockaddr_un(addr_ptr as usize, *addrlen_ptr as usize, peer_addr.as_deref());
+            }
+        }
+        return new_fd;
+    }
+
+    use crate::net::tcp;
+
+    let sk = match tcp::tcp_socket_fd(fd) {
+        Some(sk) => sk,
+        None => {
+            tracepoint!(SYSCALL, "sys_accept: invalid fd {}", fd);
+            return -9_i64 as u64;  // EBADF
+        }
+    };
+
+    // 从监听 socket 的全连接队列取出连接，没有时返回 EAGAIN
+    let new_sk = tcp::tcp_accept(sk);
+    if new_sk < 0 {
+        return new_sk as i64 as u64;
+    }
+    // 文件表已满时 socket 随文件关闭
+    let new_fd = tcp::tcp_sock_install(new_sk, false, false);
+    if new_fd < 0 {
+        return new_fd as i64 as u64;
+    }
+
+    // 填写对端地址 (sockaddr_in)，缓冲区不足 16 字节时截断
+    if !addr_ptr.is_null() && !addrlen_ptr.is_null() {
+        if let Some(socket) = tcp::tcp_socket_get(new_sk) {
+            let mut sin = [0u8; 16];
+            sin[0..2].copy_from_slice(&2u16.to_le_bytes()); // AF_INET
+            sin[2..4].copy_from_slice(&socket.remote_port.to_be_bytes());
+            sin[4..8].copy_from_slice(&socket.remote_ip.to_be_bytes());
+            unsafe {
+                let len = core::cmp::min(*addrlen_ptr as usize, sin.len());
+                core::ptr::copy_nonoverlapping(sin.as_ptr(), addr_ptr, len);
+                *addrlen_ptr = sin.len() as u32;
+            }
+        }
+    }
+
+    tracepoint!(SYSCALL, "sys_accept: fd={} -> {}", fd, new_fd);
+    new_fd as u64
+}
+
+/// sys_connect - 连接到远程地址
+///
+///
+/// # 参数
+/// - args[0] (fd): socket 文件描述符
+/// - args[1] (addr): sockaddr 结构指针
+/// - args[2] (addrlen): 地址长度
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码
+///
+/// - RISC-V: 203
+fn sys_connect(args: [u64; 6]) -> u64 {
+    let fd = args[0] as i32;
+    let addr_ptr = args[1] as *const u8;
+    let addrlen = args[2] as u32;
+
+    tracepoint!(SYSCALL, "sys_connect: fd={}, addr={:#x}", fd, addr_ptr as usize);
+
+    // 检查地址指针有效性
+    if addr_ptr.is_null() {
+        tracepoint!(SYSCALL, "sys_connect: null addr pointer");
+        return -14_i64 as u64;  // EFAULT
+    }
+
+    if let Some((file, sock)) = unix_socket_fd(fd) {
+        use crate::net::unix;
+        return match read_sockaddr_un(addr_ptr as usize, addrlen as usize) {
+            Ok(name) => unix::unix_connect(&sock, &name, unix::unix_file_nonblock(&file)) as i64 as u64,
+            Err(e) => e,
+        };
+    }
+
+    // 读取 sockaddr_in 结构
+    let sin_family = unsafe { u16::from_le_bytes(*(addr_ptr as *const [u8; 2])) };
+    let sin_port = unsafe { u16::from_be_bytes(*((addr_ptr.add(2)) as *const [u8; 2])) };
+    let sin_addr = unsafe { u32::from_be_bytes(*((addr_ptr.add(4)) as *const [u8; 4])) };
+
+    tracepoint!(SYSCALL, "sys_connect: family={}, port={}, addr={:#x}", sin_family, sin_port, sin_addr);
+
+    // 目前只支持 AF_INET
+    if sin_family != 2 {
+        tracepoint!(SYSCALL, "sys_connect: unsupported family {}", sin_family);
+        return -97_i64 as u64;  // EAFNOSUPPORT
+    }
+
+    use crate::net::tcp;
+
+    match tcp::tcp_socket_fd(fd) {
+        Some(sk) => tcp::tcp_connect(sk, sin_addr, sin_port) as u64,
+        None => {
+            tracepoint!(SYSCALL, "sys_connect: invalid fd {}", fd);
+            -9_i64 as u64  // EBADF
+        }
+    }
+}
+
+/// sys_getsockname - 获取 socket 绑定的地址
+///
+/// # 参数
+/// - args[0] (fd): socket 文件描述符
+/// - args[1] (addr): sockaddr 结构指针（输出）
+/// - args[2] (addrlen): 地址长度指针（输入/输出）
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码；目前只支持 AF_UNIX
+///
+/// - RISC-V: 204
+fn sys_getsockname(args: [u64; 6]) -> u64 {
+    let fd = args[0] as i32;
+    let addr_ptr = args[1] as usize;
+    let addrlen_ptr = args[2] as usize;
+
+    let sock = match unix_socket_fd(fd) {
+        Some((_, sock)) => sock,
+        None => return -95_i64 as u64,  // EOPNOTSUPP
+    };
+    if !user_range_ok(addrlen_ptr, 4) {
+        return -14_i64 as u64;  // EFAULT
+    }
+    let name = crate::net::unix::unix_getname(&sock);
+    unsafe {
+        let addrlen = *(addrlen_ptr as *const u32) as usize;
+        *(addrlen_ptr as *mut u32) = write_sockaddr_un(addr_ptr, addrlen, name.as_deref());
+    }
+    0
+}
+
+/// sys_getpeername - 获取已连接 socket 对端的地址
+///
+/// # 参数
+/// 与 sys_getsockname 相同
+///
+/// # 返回
+/// 成功返回 0，未连接返回 ENOTCONN；目前只支持 AF_UNIX
+///
+/// - RISC-V: 205
+fn sys_getpeername(args: [u64; 6]) -> u64 {
+    let fd = args[0] as i32;
+    let addr_ptr = args[1] as usize;
+    let addrlen_ptr = args[2] as usize;
+
+    let sock = match unix_socket_fd(fd) {
+        Some((_, sock)) => sock,
+        None => return -95_i64 as u64,  // EOPNOTSUPP
+    };
+    if !user_range_ok(addrlen_ptr, 4) {
+        return -14_i64 as u64;  // EFAULT
+    }
+    let name = match crate::net::unix::unix_getpeername(&sock) {
+        Ok(name) => name,
+        Err(e) => return e as i64 as u64,
+    };
+    unsafe {
+        let addrlen = *(addrlen_ptr as *const u32) as usize;
+        *(addrlen_ptr as *mut u32) = write_sockaddr_un(addr_ptr, addrlen, name.as_deref());
+    }
+    0
+}
+
+/// sys_shutdown - 关闭连接的一个或两个方向
+///
+/// # 参数
+/// - args[0] (fd): socket 文件描述符
+/// - args[1] (how): SHUT_RD / SHUT_WR / SHUT_RDWR
+///
+/// # 返回
+/// 成功返回 0，失败返回负错误码；目前只支持 AF_UNIX
+///
+/// - RISC-V: 210
+fn sys_shutdown(args: [u64; 6]) -> u64 {
+    match unix_socket_fd(args[0] as i32) {
+        Some((_, sock)) => crate::net::unix::unix_shutdown(&sock, args[1] as i32) as i64 as u64,
+        None => -95_i64 as u64,  // EOPNOTSUPP
+    }
+}
+
+/// 消息头 (struct user_msghdr)
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct MsgHdr {
+    msg_name: *mut u8,
+    msg_namelen: u32,
+    msg_iov: *const Iovec,
+    msg_iovlen: usize,
+    msg_control: *const u8,
+    msg_controllen: usize,
+    msg_flags: i32,
+}
+
+/// sendmmsg / recvmmsg 的数组元素 (struct mmsghdr)
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct MmsgHdr {
+    msg_hdr: MsgHdr,
+    msg_len: u32,
+}
+
+/// 控制消息头 (struct cmsghdr)，数据紧随其后并按 8 字节对齐
+#[repr(C)]
+#[derive(Clone, Copy)]
+struct CmsgHdr {
+    cmsg_len: usize,
+    cmsg_level: i32,
+    cmsg_type: i32,
+}
+
+/// 控制消息缓冲区不足，部分控制消息被丢弃 (MSG_CTRUNC)
+const MSG_CTRUNC: i32 = 0x8;
+/// 数据报比缓冲区长，多出的部分被丢弃 (MSG_TRUNC)
+const MSG_TRUNC: i32 = 0x20;
+/// 本次调用不等待 (MSG_DONTWAIT)
+const MSG_DONTWAIT: i32 = 0x40;
+/// 后面还有数据，TCP 暂不发出不足一个 MSS 的零头 (MSG_MORE)
+const MSG_MORE: i32 = 0x8000;
+/// 第一个消息之后不再等待 (MSG_WAITFORONE)
+const MSG_WAITFORONE: i32 = 0x10000;
+
+/// sockaddr_in 的长度
+const SOCKADDR_IN_LEN: usize = 16;
+
+/// 用户地址范围是否可访问 (access_ok)
+fn user_range_ok(addr: usize, len: usize) -> bool {
+    addr >= USER_IO_START && addr.checked_add(len).map_or(false, |end| end <= USER_IO_END)
+}
+
+/// 读取用户给出的 sockaddr_in (move_addr_to_kernel)
+///
+/// # 返回
+/// 地址指针为空时返回 None；(地址, 端口) 均为主机字节序
+fn read_sockaddr_in(addr: usize, addrlen: usize) -> Result<Option<(u32, u16)>, u64> {
+    if addr == 0 {
+        return Ok(None);
+    }
+    if addrlen < SOCKADDR_IN_LEN {
+        return Err(-22_i64 as u64);  // EINVAL
+    }
+    if !user_range_ok(addr, SOCKADDR_IN_LEN) {
+        return Err(-14_i64 as u64);  // EFAULT
+    }
+    let mut sin = [0u8; SOCKADDR_IN_LEN];
+    unsafe { core::ptr::copy_nonoverlapping(addr as *const u8, sin.as_mut_ptr(), SOCKADDR_IN_LEN) };
+    if u16::from_le_bytes([sin[0], sin[1]]) != 2 {
+        return Err(-97_i64 as u64);  // EAFNOSUPPORT
+    }
+    let port = u16::from_be_bytes([sin[2], sin[3]]);
+    let ip = u32::from_be_bytes([sin[4], sin[5], sin[6], sin[7]]);
+    Ok(Some((ip, port)))
+}
+
+/// 把源地址写回用户，缓冲区不足 16 字节时截断 (move_addr_to_user)
+///
+/// # 返回
+/// 地址的完整长度
+fn write_sockaddr_in(addr: usize, addrlen: usize, ip: u32, port: u16) -> u32 {
+    let mut sin = [0u8; SOCKADDR_IN_LEN];
+    sin[0..2].copy_from_slice(&2u16.to_le_bytes()); // AF_INET
+    sin[2..4].copy_from_slice(&port.to_be_bytes());
+    sin[4..8].copy_from_slice(&ip.to_be_bytes());
+    let len = core::cmp::min(addrlen, SOCKADDR_IN_LEN);
+    if addr != 0 && user_range_ok(addr, len) {
+        unsafe { core::ptr::copy_nonoverlapping(sin.as_ptr(), addr as *mut u8, len) };
+    }
+    SOCKADDR_IN_LEN as u32
+}
+
+/// 读取用户给出的 sockaddr_un (move_addr_to_kernel + unix_mkname)
+///
+/// # 返回
+/// 名字表中的键，只有 sun_family 时为空
+fn read_sockaddr_un(addr: usize, addrlen: usize) -> Result<alloc::vec::Vec<u8>, u64> {
+    use crate::net::unix::{unix_mkname, UNIX_FAMILY_LEN, UNIX_PATH_MAX};
+
+    if addrlen < UNIX_FAMILY_LEN || addrlen > UNIX_FAMILY_LEN + UNIX_PATH_MAX {
+        return Err(-22_i64 as u64);  // EINVAL
+    }
+    if !user_range_ok(addr, addrlen) {
+        return Err(-14_i64 as u64);  // EFAULT
+    }
+    let sun = unsafe { core::slice::from_raw_parts(addr as *const u8, addrlen) };
+    unix_mkname(sun).map_err(|e| e as i64 as u64)
+}
+
+/// 把 Unix 域地址写回用户，缓冲区不足时截断 (unix_getname + move_addr_to_user)
+///
+/// # 返回
+/// 地址的完整长度
+fn write_sockaddr_un(addr: usize, addrlen: usize, name: Option<&[u8]>) -> u32 {
+    let sun = crate::net::unix::unix_sockaddr(name);
+    let len = core::cmp::min(addrlen, sun.len());
+    if addr != 0 && user_range_ok(addr, len) {
+        unsafe { core::ptr::copy_nonoverlapping(sun.as_ptr(), addr as *mut u8, len) };
+    }
+    sun.len() as u32
+}
+
+/// 读取用户的 msghdr 与其中的 iovec 数组 (copy_msghdr_from_user)
+fn import_msghdr(msg_ptr: usize) -> Result<(MsgHdr, alloc::vec::Vec<(usize, usize)>), u64> {
+    if !user_range_ok(msg_ptr, core::mem::size_of::<MsgHdr>()) {
+        return Err(-14_i64 as u64);  // EFAULT
+    }
+    let msg = unsafe { core::ptr::read_unaligned(msg_ptr as *const MsgHdr) };
+    let segs = import_iovec(msg.msg_iov, msg.msg_iovlen)?;
+    Ok((msg, segs))
+}
+
+/// 从发送的控制消息中取出 UDP_SEGMENT (udp_cmsg_send)
+///
+/// # 返回
+/// 没有 UDP_SEGMENT 时返回 None；其他层级的控制消息被忽略
+fn parse_udp_cmsg(control: usize, controllen: usize) -> Result<Option<u16>, u64> {
+    use crate::net::udp::{SOL_UDP, UDP_SEGMENT};
+
+    const CMSG_HDR_LEN: usize = core::mem::size_of::<CmsgHdr>();
+    if controllen == 0 {
+        return Ok(None);
+    }
+    if !user_range_ok(control, controllen) {
+        return Err(-14_i64 as u64);  // EFAULT
+    }
+
+    let mut gso_size = None;
+    let mut off = 0;
+    while off + CMSG_HDR_LEN <= controllen {
+        let cmsg = unsafe { core::ptr::read_unaligned((control + off) as *const CmsgHdr) };
+        if cmsg.cmsg_len < CMSG_HDR_LEN || cmsg.cmsg_len > controllen - off {
+            return Err(-22_i64 as u64);  // EINVAL
+        }
+        if cmsg.cmsg_level == SOL_UDP {
+            if cmsg.cmsg_type != UDP_SEGMENT || cmsg.cmsg_len < CMSG_HDR_LEN + 2 {
+                return Err(-22_i64 as u64);  // EINVAL
+            }
+            let val = unsafe { core::ptr::read_unaligned((control + off + CMSG_HDR_LEN) as *const u16) };
+            gso_size = Some(val);
+        }
+        // CMSG_NXTHDR：按 8 字节对齐
+        off += (cmsg.cmsg_len + 7) & !7;
+    }
+    Ok(gso_size)
+}
+
+/// 从发送的控制消息中取出 SCM_RIGHTS 的文件 (scm_send / scm_fp_copy)
+///
+/// # 返回
+/// 按出现顺序的文件；描述符无效时返回 EBADF，超过 SCM_MAX_FD 个时返回 EINVAL
+fn parse_scm_rights(control: usize, controllen: usize) -> Result<alloc::vec::Vec<alloc::sync::Arc<crate::fs::File>>, u64> {
+    use crate::net::unix::{SCM_MAX_FD, SCM_RIGHTS, SOL_SOCKET};
+
+    const CMSG_HDR_LEN: usize = core::mem::size_of::<CmsgHdr>();
+    let mut files = alloc::vec::Vec::new();
+    if controllen == 0 {
+        return Ok(files);
+    }
+    if !user_range_ok(control, controllen) {
+        return Err(-14_i64 as u64);  // EFAULT
+    }
+
+    let mut off = 0;
+    while off + CMSG_HDR_LEN <= controllen {
+        let cmsg = unsafe { core::ptr::read_unaligned((control + off) as *const CmsgHdr) };
+        if cmsg.cmsg_len < CMSG_HDR_LEN || cmsg.cmsg_len > controllen - off {
+            return Err(-22_i64 as u64);  // EINVAL
+        }
+        if cmsg.cmsg_level == SOL_SOCKET {
+            if cmsg.cmsg_type != SCM_RIGHTS {
+                return Err(-22_i64 as u64);  // EINVAL
+            }
+            let nr = (cmsg.cmsg_len - CMSG_HDR_LEN) / 4;
+            if files.len() + nr > SCM_MAX_FD {
+                return Err(-22_i64 as u64);  // EINVAL
+            }
+            for i in 0..nr {
+                let fd = unsafe { core::ptr::read_unaligned((control + off + CMSG_HDR_LEN + i * 4) as *const i32) };
+                let file = if fd >= 0 { unsafe { crate::fs::get_file_fd(fd as usize) } } else { None };
+                match file {
+                    Some(file) => files.push(file),
+                    None => return Err(-9_i64 as u64),  // EBADF
+                }
+            }
+        }
+        // CMSG_NXTHDR：按 8 字节对齐
+        off += (cmsg.cmsg_len + 7) & !7;
+    }
+    Ok(files)
+}
+
+/// 把收到的文件安装到文件描述符表并写出 SCM_RIGHTS 控制消息 (scm_detach_fds)
+///
+/// 控制消息缓冲区放不下或描述符用尽时，其余的文件被释放并设置 MSG_CTRUNC
+///
+/// # 返回
+/// (写出的控制消息长度, 是否截断)
+fn put_scm_rights(control: usize, controllen: usize, files: alloc::vec::Vec<alloc::sync::Arc<crate::fs::File>>) -> (usize, bool) {
+    use crate::fs::file::fput;
+    use crate::net::unix::{SCM_RIGHTS, SOL_SOCKET};
+
+    const CMSG_HDR_LEN: usize = core::mem::size_of::<CmsgHdr>();
+    if files.is_empty() {
+        return (0, false);
+    }
+    let room = if control != 0 && controllen >= CMSG_HDR_LEN && user_range_ok(control, controllen) {
+        (controllen - CMSG_HDR_LEN) / 4
+    } else {
+        0
+    };
+
+    let mut truncated = false;
+    let mut fds = alloc::vec::Vec::new();
+    for file in files {
+        if fds.len() < room {
+            // 安装失败时 file 是最后一个引用，由 fput 关闭
+            match unsafe { crate::fs::file::get_file_fd_install(file.clone()) } {
+                Some(fd) => {
+                    fds.push(fd as i32);
+                    continue;
+                }
+                None => truncated = true,
+            }
+        } else {
+            truncated = true;
+        }
+        fput(file);
+    }
+    if fds.is_empty() {
+        return (0, truncated);
+    }
+
+    let cmsg_len = CMSG_HDR_LEN + fds.len() * 4;
+    let cmsg = CmsgHdr { cmsg_len, cmsg_level: SOL_SOCKET, cmsg_type: SCM_RIGHTS };
+    unsafe {
+        core::ptr::write_unaligned(control as *mut CmsgHdr, cmsg);
+        for (i, fd) in fds.iter().enumerate() {
+            core::ptr::write_unaligned((control + CMSG_HDR_LEN + i * 4) as *mut i32, *fd);
+        }
+    }
+    // CMSG_SPACE，不超过缓冲区
+    (core::cmp::min((cmsg_len + 7) & !7, controllen), truncated)
+}
+
+/// 在 Unix 域套接字上发送一个消息 (unix_stream_sendmsg / unix_dgram_sendmsg)
+///
+/// # 参数
+/// - `name` / `namelen`: 目标 sockaddr_un，为 0 时发给对端
+/// - `control` / `controllen`: 控制消息，可带 SCM_RIGHTS
+fn unix_do_sendmsg(
+    file: &crate::fs::File,
+    sock: &alloc::sync::Arc<crate::net::unix::UnixSock>,
+    segs: &[(usize, usize)],
+    name: usize,
+    namelen: usize,
+    control: usize,
+    controllen: usize,
+) -> u64 {
+    use crate::net::unix;
+
+    let dest = if name != 0 && namelen != 0 {
+        match read_sockaddr_un(name, namelen) {
+            Ok(dest) => Some(dest),
+            Err(e) => return e,
+        }
+    } else {
+        None
+    };
+    let files = match parse_scm_rights(control, controllen) {
+        Ok(files) => files,
+        Err(e) => return e,
+    };
+    let bufs: alloc::vec::Vec<&[u8]> = segs
+        .iter()
+        .map(|&(base, len)| unsafe { core::slice::from_raw_parts(base as *const u8, len) })
+        .collect();
+    unix::unix_sendmsg(sock, &bufs, dest.as_deref(), files, unix::unix_file_nonblock(file)) as i64 as u64
+}
+
+/// 在 Unix 域套接字上接收一个消息 (unix_stream_recvmsg / unix_dgram_recvmsg)
+///
+/// # 返回
+/// (字节数或错误码, 源地址长度, 控制消息长度, msg_flags)
+fn unix_do_recvmsg(
+    file: &crate::fs::File,
+    sock: &alloc::sync::Arc<crate::net::unix::UnixSock>,
+    segs: &[(usize, usize)],
+    name: usize,
+    namelen: usize,
+    control: usize,
+    controllen: usize,
+    flags: i32,
+) -> (u64, u32, usize, i32) {
+    use crate::net::unix;
+
+    let mut bufs: alloc::vec::Vec<&mut [u8]> = segs
+        .iter()
+        .map(|&(base, len)| unsafe { core::slice::from_raw_parts_mut(base as *mut u8, len) })
+        .collect();
+    let nonblock = unix::unix_file_nonblock(file) || flags & MSG_DONTWAIT != 0;
+    let recv = match unix::unix_recvmsg(sock, &mut bufs, nonblock) {
+        Ok(recv) => recv,
+        Err(e) => return (e as i64 as u64, 0, 0, 0),
+    };
+
+    let mut msg_flags = if recv.len < recv.msg_len { MSG_TRUNC } else { 0 };
+    // 发送方未绑定地址时不填写 (unix_copy_addr)
+    let namelen = match (&recv.addr, name) {
+        (Some(addr), name) if name != 0 => write_sockaddr_un(name, namelen, Some(addr)),
+        _ => 0,
+    };
+    let (used, truncated) = put_scm_rights(control, controllen, recv.fds);
+    if truncated {
+        msg_flags |= MSG_CTRUNC;
+    }
+    let ret = if flags & MSG_TRUNC != 0 { recv.msg_len } else { recv.len };
+    (ret as u64, namelen, used, msg_flags)
+}
+
+/// 发送一个消息 (____sys_sendmsg)
+///
+/// # 参数
+/// - `segs`: 已检查过的用户缓冲区
+/// - `dest`: 目标地址，只对 UDP 有意义
+/// - `gso_size`: 控制消息中的 UDP_SEGMENT
+/// - `flags`: MSG_MORE 时 TCP 末尾的零头等下一次写入
+fn do_sendmsg(fd: i32, segs: &[(usize, usize)], dest: Option<(u32, u16)>, gso_size: Option<u16>, flags: i32) -> u64 {
+    use crate::net::{tcp, udp};
+
+    let bufs: alloc::vec::Vec<&[u8]> = segs
+        .iter()
+        .map(|&(base, len)| unsafe { core::slice::from_raw_parts(base as *const u8, len) })
+        .collect();
+
+    // 与 sys_bind 相同，先按 TCP 查找
+    if let Some(sk) = tcp::tcp_socket_fd(fd) {
+        let mut total: isize = 0;
+        let more = flags & MSG_MORE != 0;
+        let nr = bufs.len();
+        for (i, buf) in bufs.into_iter().enumerate() {
+            // 各段连成一次写入，只有最后一段之后才按 Nagle 与 MSG_MORE 决定是否发出零头
+            let last = i + 1 == nr;
+            let ret = tcp::tcp_sendmsg(sk, buf, more || !last);
+            if ret < 0 {
+                if total == 0 {
+                    return ret as i64 as u64;
+                }
+            } else {
+                total += ret;
+                if ret as usize == buf.len() {
+                    continue;
+                }
+            }
+            // 提前结束时按本次调用的 MSG_MORE 重新决定零头
+            if !last {
+                tcp::tcp_sendmsg(sk, &[], more);
+            }
+            break;
+        }
+        return total as u64;
+    }
+
+    if udp::udp_socket_get(fd).is_some() {
+        return udp::udp_sendmsg(fd, &bufs, dest, gso_size) as i64 as u64;
+    }
+
+    tracepoint!(SYSCALL, "do_sendmsg: invalid fd {}", fd);
+    -9_i64 as u64  // EBADF
+}
+
+/// 接收一个消息 (____sys_recvmsg)
+///
+/// # 参数
+/// - `segs`: 已检查过的用户缓冲区
+/// - `name` / `namelen`: 源地址缓冲区，只对 UDP 填写
+/// - `flags`: MSG_TRUNC 时返回数据报的实际长度
+///
+/// # 返回
+/// (字节数或错误码, 源地址长度, msg_flags)
+fn do_recvmsg(fd: i32, segs: &[(usize, usize)], name: usize, namelen: usize, flags: i32) -> (u64, u32, i32) {
+    use crate::net::{tcp, udp};
+
+    // inet socket 的接收不睡眠：队列为空时按 SO_BUSY_POLL 先忙轮询网卡，仍然没有数据才返回 EAGAIN
+    let nonblock = flags & MSG_DONTWAIT != 0;
+    if let Some(sk) = tcp::tcp_socket_fd(fd) {
+        tcp::tcp_busy_loop(sk, nonblock);
+        let mut total: isize = 0;
+        for &(base, len) in segs {
+            let buf = unsafe { core::slice::from_raw_parts_mut(base as *mut u8, len) };
+            let ret = tcp::tcp_recv(sk, buf);
+            if ret < 0 {
+                if total == 0 {
+                    return (ret as i64 as u64, 0, 0);
+                }
+                break;
+            }
+            total += ret;
+            if (ret as usize) < len {
+                break;
+            }
+        }
+        return (total as u64, 0, 0);
+    }
+
+    if udp::udp_socket_get(fd).is_none() {
+        tracepoint!(SYSCALL, "do_recvmsg: invalid fd {}", fd);
+        return (-9_i64 as u64, 0, 0);  // EBADF
+    }
+    udp::udp_busy_loop(fd, nonblock);
+    let dgram = match udp::udp_recvmsg(fd) {
+        Ok(dgram) => dgram,
+        Err(e) => return (e as i64 as u64, 0, 0),
+    };
+
+    // 按段分散复制，放不下的部分丢弃
+    let mut copied = 0;
+    for &(base, len) in segs {
+        if copied == dgram.len() {
+            break;
+        }
+        let buf = unsafe { core::slice::from_raw_parts_mut(base as *mut u8, len) };
+        copied += dgram.copy_to(copied, buf);
+    }
+    let msg_flags = if copied < dgram.len() { MSG_TRUNC } else { 0 };
+    let namelen = if name != 0 { write_sockaddr_in(name, namelen, dgram.saddr, dgram.sport) } else { 0 };
+    let ret = if flags & MSG_TRUNC != 0 { dgram.len() } else { copied };
+    dgram.free();
+    (ret as u64, namelen, msg_flags)
+}
+
+/// sys_sendto - 发送数据（可能指定目标地址）
+///
+///
+/// # 参数
+/// - args[0] (fd): socket 文件描述符
+/// - args[1] (buf): 数据缓冲区指针
+/// - args[2] (len): 数据长度
+/// - args[3] (flags): 标志位
+/// - args[4] (addr): 目标地址指针（可选）
+/// - args[5] (addrlen): 地址长度（可选）
+///
+/// # 返回
+/// 成功返回发送的字节数，失败返回负错误码
+///
+/// - RISC-V: 206
+fn sys_sendto(args: [u64; 6]) -> u64 {
+    let fd = args[0] as i32;
+    let buf_ptr = args[1] as usize;
+    let len = args[2] as usize;
+    let flags = args[3] as i32;
+    let addr_ptr = args[4] as usize;
+    let addrlen = args[5] as u32 as usize;
+
+    tracepoint!(SYSCALL, "sys_sendto: fd={}, buf={:#x}, len={}", fd, buf_ptr, len);
+
+    let segs = match import_ubuf(buf_ptr, len) {
+        Ok(segs) => segs,
+        Err(e) => return e,
+    };
+    if let Some((file, sock)) = unix_socket_fd(fd) {
+        return unix_do_sendmsg(&file, &sock, &segs, addr_ptr, addrlen, 0, 0);
+    }
+    let dest = match read_sockaddr_in(addr_ptr, addrlen) {
+        Ok(dest) => dest,
+        Err(e) => return e,
+    };
+    do_sendmsg(fd, &segs, dest, None, flags)
+}
+
+/// sys_recvfrom - 接收数据（可能获取源地址）
+///
+///
+/// # 参数
+/// - args[0] (fd): socket 文件描述符
+/// - args[1] (buf): 数据缓冲区指针
+/// - args[2] (len): 缓冲区长度
+/// - args[3] (flags): 标志位
+/// - args[4] (addr): 源地址指针（可选，输出）
+/// - args[5] (addrlen): 地址长度指针（可选，输入/输出）
+///
+/// # 返回
+/// 成功返回接收的字节数，失败返回负错误码
+///
+/// - RISC-V: 207
+fn sys_recvfrom(args: [u64; 6]) -> u64 {
+    let fd = args[0] as i32;
+    let buf_ptr = args[1] as usize;
+    let len = args[2] as usize;
+    let flags = args[3] as i32;
+    let addr_ptr = args[4] as usize;
+    let addrlen_ptr = args[5] as usize;
+
+    let segs = match import_ubuf(buf_ptr, len) {
+        Ok(segs) => segs,
+        Err(e) => return e,
+    };
+    let want_addr = addr_ptr != 0 && addrlen_ptr != 0;
+    if want_addr && !user_range_ok(addrlen_ptr, 4) {
+        return -14_i64 as u64;  // EFAULT
+    }
+    let addrlen = if want_addr { unsafe { *(addrlen_ptr as *const u32) as usize } } else { 0 };
+
+    let (ret, namelen, _) = match unix_socket_fd(fd) {
+        Some((file, sock)) => {
+            let (ret, namelen, _, msg_flags) =
+                unix_do_recvmsg(&file, &sock, &segs, if want_addr { addr_ptr } else { 0 }, addrlen, 0, 0, flags);
+            (ret, namelen, msg_flags)
+        }
+        None => do_recvmsg(fd, &segs, if want_addr { addr_ptr } else { 0 }, addrlen, flags),
+    };
+    if want_addr && (ret as i64) >= 0 && namelen != 0 {
+        unsafe { *(addrlen_ptr as *mut u32) = namelen; }
+    }
+    ret
+}
+
+/// 发送 msghdr 描述的一个消息，sendmsg 与 sendmmsg 共用 (___sys_sendmsg)
+fn sendmsg_one(fd: i32, msg_ptr: usize, flags: i32) -> u64 {
+    let (msg, segs) = match import_msghdr(msg_ptr) {
+        Ok(msg) => msg,
+        Err(e) => return e,
+    };
+    if let Some((file, sock)) = unix_socket_fd(fd) {
+        return unix_do_sendmsg(
+            &file,
+            &sock,
+            &segs,
+            msg.msg_name as usize,
+            msg.msg_namelen as usize,
+            msg.msg_control as usize,
+            msg.msg_controllen,
+        );
+    }
+    let dest = match read_sockaddr_in(msg.msg_name as usize, msg.msg_namelen as usize) {
+        Ok(dest) => dest,
+        Err(e) => return e,
+    };
+    let gso_size = match parse_udp_cmsg(msg.msg_control as usize, msg.msg_controllen) {
+        Ok(gso_size) => gso_size,
+        Err(e) => return e,
+    };
+    do_sendmsg(fd, &segs, dest, gso_size, flags)
+}
+
+/// 接收一个消息到 msghdr，回写 msg_namelen 与 msg_flags (___sys_recvmsg)
+fn recvmsg_one(fd: i32, msg_ptr: usize, flags: i32) -> u64 {
+    let (msg, segs) = match import_msghdr(msg_ptr) {
+        Ok(msg) => msg,
+        Err(e) => return e,
+    };
+    // Unix 域套接字可以收到 SCM_RIGHTS 控制消息，其他 socket 没有控制消息
+    let (ret, namelen, controllen, msg_flags) = match unix_socket_fd(fd) {
+        Some((file, sock)) => unix_do_recvmsg(
+            &file,
+            &sock,
+            &segs,
+            msg.msg_name as usize,
+            msg.msg_namelen as usize,
+            msg.msg_control as usize,
+            msg.msg_controllen,
+            flags,
+        ),
+        None => {
+            let (ret, namelen, msg_flags) =
+                do_recvmsg(fd, &segs, msg.msg_name as usize, msg.msg_namelen as usize, flags);
+            (ret, namelen, 0, msg_flags)
+        }
+    };
+    if (ret as i64) >= 0 {
+        let hdr = msg_ptr as *mut MsgHdr;
+        unsafe {
+            if !msg.msg_name.is_null() {
+                core::ptr::write_unaligned(core::ptr::addr_of_mut!((*hdr).msg_namelen), namelen);
+            }
+            core::ptr::write_unaligned(core::ptr::addr_of_mut!((*hdr).msg_controllen), controllen);
+            core::ptr::write_unaligned(core::ptr::addr_of_mut!((*hdr).msg_flags), msg_flags);
+        }
+    }
+    ret
+}
+
+/// sys_sendmsg - 按 msghdr 发送一个消息
+///
+/// # 参数
+/// - args[0] (fd): socket 文件描述符
+/// - args[1] (msg): struct msghdr 指针；UDP 可带 UDP_SEGMENT 控制消息
+/// - args[2] (flags): 标志位
+///
+/// # 返回
+/// 成功返回发送的字节数，失败返回负错误码
+///
+/// - RISC-V: 211
+fn sys_sendmsg(args: [u64; 6]) -> u64 {
+    sendmsg_one(args[0] as i32, args[1] as usize, args[2] as i32)
+}
+
+/// sys_recvmsg - 按 msghdr 接收一个消息
+///
+/// # 参数
+/// - args[0] (fd): socket 文件描述符
+/// - args[1] (msg): struct msghdr 指针，回写 msg_namelen 与 msg_flags
+/// - args[2] (flags): 标志位
+///
+/// # 返回
+/// 成功返回接收的字节数，失败返回负错误码
+///
+/// - RISC-V: 212
+fn sys_recvmsg(args: [u64; 6]) -> u64 {
+    recvmsg_one(args[0] as i32, args[1] as usize, args[2] as i32)
+}
+
+/// 检查 mmsghdr 数组，vlen 超过 UIO_MAXIOV 时截断
+fn import_mmsg(mmsg_ptr: usize, vlen: usize) -> Result<usize, u64> {
+    let vlen = core::cmp::min(vlen, crate::fs::file::UIO_MAXIOV);
+    if vlen > 0 && !user_range_ok(mmsg_ptr, vlen * core::mem::size_of::<MmsgHdr>()) {
+        return Err(-14_i64 as u64);  // EFAULT
+    }
+    Ok(vlen)
+}
+
+/// sys_sendmmsg - 一次系统调用发送多个消息
+///
+/// # 参数
+/// - args[0] (fd): socket 文件描述符
+/// - args[1] (msgvec): struct mmsghdr 数组，每项回写 msg_len
+/// - args[2] (vlen): 数组长度，最多处理 UIO_MAXIOV 项
+/// - args[3] (flags): 标志位
+///
+/// # 返回
+/// 成功发送的消息数；第一个消息就失败时返回其错误码，之后的失败只是提前结束
 ///
-/// - RISC-V: 202
-fn sys_accept(args: [u64; 6]) -> u64 {
+/// - RISC-V: 269
+fn sys_sendmmsg(args: [u64; 6]) -> u64 {
     let fd = args[0] as i32;
-    let _addr_ptr = args[1] as *mut u8;
-    let _addrlen_ptr = args[2] as *mut u32;
-
-    println!("sys_accept: fd={}", fd);
-
-    use crate::net::tcp;
-
-    // TODO: 实现完整的 accept 逻辑
-    // 1. 检查 socket 是否处于 LISTEN 状态
-    // 2. 从等待队列中取出连接请求
-    // 3. 创建新的 socket
-    // 4. 将新 socket 设置为 ESTABLISHED 状态
-    // 5. 返回新 socket 的 fd
+    let mmsg_ptr = args[1] as usize;
+    let vlen = match import_mmsg(mmsg_ptr, args[2] as usize) {
+        Ok(vlen) => vlen,
+        Err(e) => return e,
+    };
 
-    match tcp::tcp_socket_get(fd) {
-        Some(_socket) => tcp::tcp_accept(fd) as u64,
-        None => {
-            println!("sys_accept: invalid fd {}", fd);
-            -9_i64 as u64  // EBADF
+    let mut sent = 0;
+    while sent < vlen {
+        let entry = (mmsg_ptr as *mut MmsgHdr).wrapping_add(sent);
+        let ret = sendmsg_one(fd, entry as usize, args[3] as i32);
+        if (ret as i64) < 0 {
+            if sent == 0 {
+                return ret;
+            }
+            break;
         }
+        unsafe { core::ptr::write_unaligned(core::ptr::addr_of_mut!((*entry).msg_len), ret as u32) };
+        sent += 1;
     }
+    tracepoint!(SYSCALL, "sys_sendmmsg: fd={}, sent {}/{}", fd, sent, vlen);
+    sent as u64
 }
 
-/// sys_connect - 连接到远程地址
-///
+/// sys_recvmmsg - 一次系统调用接收多个消息
 ///
 /// # 参数
 /// - args[0] (fd): socket 文件描述符
-/// - args[1] (addr): sockaddr 结构指针
-/// - args[2] (addrlen): 地址长度
+/// - args[1] (msgvec): struct mmsghdr 数组，每项回写 msg_len
+/// - args[2] (vlen): 数组长度，最多处理 UIO_MAXIOV 项
+/// - args[3] (flags): 标志位；MSG_WAITFORONE 在第一个消息之后不再等待
+/// - args[4] (timeout): 超时（忽略）
 ///
 /// # 返回
-/// 成功返回 0，失败返回负错误码
+/// 收到的消息数；一个都没有时返回错误码（队列为空为 EAGAIN）
 ///
-/// - RISC-V: 203
-fn sys_connect(args: [u64; 6]) -> u64 {
+/// # 说明
+/// TCP / UDP 接收总是非阻塞的，队列取空即返回；阻塞的 Unix 域套接字在
+/// MSG_WAITFORONE 时只等待第一个消息。timeout 被忽略
+///
+/// - RISC-V: 243
+fn sys_recvmmsg(args: [u64; 6]) -> u64 {
     let fd = args[0] as i32;
-    let addr_ptr = args[1] as *const u8;
-    let _addrlen = args[2] as u32;
-
-    println!("sys_connect: fd={}, addr={:#x}", fd, addr_ptr as usize);
-
-    // 检查地址指针有效性
-    if addr_ptr.is_null() {
-        println!("sys_connect: null addr pointer");
-        return -14_i64 as u64;  // EFAULT
-    }
-
-    // 读取 sockaddr_in 结构
-    let sin_family = unsafe { u16::from_le_bytes(*(addr_ptr as *const [u8; 2])) };
-    let sin_port = unsafe { u16::from_be_bytes(*((addr_ptr.add(2)) as *const [u8; 2])) };
-    let sin_addr = unsafe { u32::from_be_bytes(*((addr_ptr.add(4)) as *const [u8; 4])) };
-
-    println!("sys_connect: family={}, port={}, addr={:#x}", sin_family, sin_port, sin_addr);
-
-    // 目前只支持 AF_INET
-    if sin_family != 2 {
-        println!("sys_connect: unsupported family {}", sin_family);
-        return -97_i64 as u64;  // EAFNOSUPPORT
-    }
-
-    use crate::net::tcp;
+    let mmsg_ptr = args[1] as usize;
+    let wait_for_one = (args[3] as i32) & MSG_WAITFORONE != 0;
+    let mut flags = (args[3] as i32) & !MSG_WAITFORONE;
+    let vlen = match import_mmsg(mmsg_ptr, args[2] as usize) {
+        Ok(vlen) => vlen,
+        Err(e) => return e,
+    };
 
-    match tcp::tcp_socket_get(fd) {
-        Some(_socket) => tcp::tcp_connect(fd, sin_addr, sin_port) as u64,
-        None => {
-            println!("sys_connect: invalid fd {}", fd);
-            -9_i64 as u64  // EBADF
+    let mut received = 0;
+    while received < vlen {
+        let entry = (mmsg_ptr as *mut MmsgHdr).wrapping_add(received);
+        let ret = recvmsg_one(fd, entry as usize, flags);
+        if (ret as i64) < 0 {
+            if received == 0 {
+                return ret;
+            }
+            break;
+        }
+        unsafe { core::ptr::write_unaligned(core::ptr::addr_of_mut!((*entry).msg_len), ret as u32) };
+        received += 1;
+        if wait_for_one {
+            flags |= MSG_DONTWAIT;
         }
     }
+    received as u64
 }
 
-/// sys_sendto - 发送数据（可能指定目标地址）
+/// sys_setsockopt - 设置 socket 选项
 ///
 ///
 /// # 参数
 /// - args[0] (fd): socket 文件描述符
-/// - args[1] (buf): 数据缓冲区指针
-/// - args[2] (len): 数据长度
-/// - args[3] (flags): 标志位
-/// - args[4] (addr): 目标地址指针（可选）
-/// - args[5] (addrlen): 地址长度（可选）
+/// - args[1] (level): 选项层级
+/// - args[2] (optname): 选项名
+/// - args[3] (optval): 选项值指针
+/// - args[4] (optlen): 选项值长度
 ///
 /// # 返回
-/// 成功返回发送的字节数，失败返回负错误码
+/// 成功返回 0，失败返回负错误码
 ///
-/// - RISC-V: 206
-fn sys_sendto(args: [u64; 6]) -> u64 {
+/// - RISC-V: 208
+fn sys_setsockopt(args: [u64; 6]) -> u64 {
     let fd = args[0] as i32;
-    let buf_ptr = args[1] as *const u8;
-    let len = args[2] as usize;
-    let _flags = args[3] as i32;
-    let _addr_ptr = args[4] as *const u8;
-    let _addrlen = args[5] as u32;
+    let level = args[1] as i32;
+    let optname = args[2] as i32;
+    let optval_ptr = args[3] as *const u8;
+    let optlen = args[4] as u32 as usize;
 
-    println!("sys_sendto: fd={}, buf={:#x}, len={}", fd, buf_ptr as usize, len);
+    tracepoint!(SYSCALL, "sys_setsockopt: fd={}, level={}, optname={}, optlen={}", fd, level, optname, optlen);
 
-    // 检查缓冲区指针有效性
-    if buf_ptr.is_null() {
-        println!("sys_sendto: null buf pointer");
+    if optval_ptr.is_null() && optlen > 0 {
         return -14_i64 as u64;  // EFAULT
     }
 
-    if len == 0 {
-        return 0;
-    }
-
-    // 读取数据
-    let data = unsafe { core::slice::from_raw_parts(buf_ptr, len) };
+    use crate::net::{tcp, udp};
 
-    // TODO: 需要确定是 TCP 还是 UDP socket
-    // 简化实现：暂时返回错误
-    println!("sys_sendto: not fully implemented, data={}", data.len());
+    let optval = if optlen == 0 {
+        &[][..]
+    } else {
+        unsafe { core::slice::from_raw_parts(optval_ptr, optlen) }
+    };
 
-    -38_i64 as u64  // ENOSYS
+    // SOL_UDP 的选项交给 UDP，其余先按 TCP 查找
+    if level != udp::SOL_UDP {
+        if let Some(sk) = tcp::tcp_socket_fd(fd) {
+            return tcp::tcp_setsockopt(sk, level, optname, optval) as i64 as u64;
+        }
+    }
+    if udp::udp_socket_get(fd).is_some() {
+        return udp::udp_setsockopt(fd, level, optname, optval) as i64 as u64;
+    }
+    tracepoint!(SYSCALL, "sys_setsockopt: invalid fd {}", fd);
+    -9_i64 as u64  // EBADF
 }
 
-/// sys_recvfrom - 接收数据（可能获取源地址）
+/// sys_getsockopt - 读取 socket 选项
 ///
 ///
 /// # 参数
 /// - args[0] (fd): socket 文件描述符
-/// - args[1] (buf): 数据缓冲区指针
-/// - args[2] (len): 缓冲区长度
-/// - args[3] (flags): 标志位
-/// - args[4] (addr): 源地址指针（可选，输出）
-/// - args[5] (addrlen): 地址长度指针（可选，输入/输出）
+/// - args[1] (level): 选项层级
+/// - args[2] (optname): 选项名
+/// - args[3] (optval): 输出缓冲区指针
+/// - args[4] (optlen): 缓冲区长度指针（输入/输出）
 ///
 /// # 返回
-/// 成功返回接收的字节数，失败返回负错误码
+/// 成功返回 0，失败返回负错误码
 ///
-/// - RISC-V: 207
-fn sys_recvfrom(args: [u64; 6]) -> u64 {
-    let _fd = args[0] as i32;
-    let buf_ptr = args[1] as *mut u8;
-    let len = args[2] as usize;
-    let _flags = args[3] as i32;
-    let _addr_ptr = args[4] as *mut u8;
-    let _addrlen_ptr = args[5] as *mut u32;
+/// - RISC-V: 209
+fn sys_getsockopt(args: [u64; 6]) -> u64 {
+    let fd = args[0] as i32;
+    let level = args[1] as i32;
+    let optname = args[2] as i32;
+    let optval_ptr = args[3] as *mut u8;
+    let optlen_ptr = args[4] as *mut u32;
+
+    tracepoint!(SYSCALL, "sys_getsockopt: fd={}, level={}, optname={}", fd, level, optname);
 
-    // 检查缓冲区指针有效性
-    if buf_ptr.is_null() {
+    if optval_ptr.is_null() || optlen_ptr.is_null() {
         return -14_i64 as u64;  // EFAULT
     }
 
-    if len == 0 {
-        return 0;
-    }
+    use crate::net::{tcp, udp};
 
-    // TODO: 需要确定是 TCP 还是 UDP socket
-    // 简化实现：暂时返回错误
-    -38_i64 as u64  // ENOSYS
+    let optlen = unsafe { *optlen_ptr } as usize;
+    let out = unsafe { core::slice::from_raw_parts_mut(optval_ptr, optlen) };
+    let tcp_sk = if level != udp::SOL_UDP { tcp::tcp_socket_fd(fd) } else { None };
+    let ret = if let Some(sk) = tcp_sk {
+        tcp::tcp_getsockopt(sk, level, optname, out)
+    } else if udp::udp_socket_get(fd).is_some() {
+        udp::udp_getsockopt(fd, level, optname, out)
+    } else {
+        tracepoint!(SYSCALL, "sys_getsockopt: invalid fd {}", fd);
+        return -9_i64 as u64;  // EBADF
+    };
+    if ret < 0 {
+        return ret as i64 as u64;
+    }
+    unsafe { *optlen_ptr = ret as u32; }
+    0
 }
 
 /// sys_brk - 改变数据段大小
@@ -3072,8 +5288,6 @@ fn sys_recvfrom(args: [u64; 6]) -> u64 {
 /// - RISC-V: 214
 fn sys_brk(args: [u64; 6]) -> u64 {
     use crate::sched;
-    use crate::mm::page::PAGE_SIZE;
-    use crate::arch::riscv64::mm::{alloc_and_map_user_memory, PageTableEntry};
 
     let new_brk = args[0] as u64;
 
@@ -3111,34 +5325,14 @@ fn sys_brk(args: [u64; 6]) -> u64 {
                 return current_brk;
             }
 
-            // 扩展堆：需要映射新的内存页
+            // 扩展堆：只扩展堆 VMA，物理页在第一次访问时分配
             if new_brk > current_brk {
-                // 计算需要映射的页面范围
-                let current_page_end = (current_brk + PAGE_SIZE as u64 - 1) & !(PAGE_SIZE as u64 - 1);
-                let new_page_end = (new_brk + PAGE_SIZE as u64 - 1) & !(PAGE_SIZE as u64 - 1);
-
-                // 如果需要映射新页面
-                if new_page_end > current_page_end {
-                    // 获取地址空间的根页表
-                    let root_ppn = if let Some(addr_space) = current_task.address_space() {
-                        addr_space.root_ppn()
-                    } else {
-                        return current_brk;
-                    };
-
-                    // 映射新的堆页面
-                    let size = new_page_end - current_page_end;
-
-                    // 权限: User + Read + Write + Valid + Accessed + Dirty
-                    let pte_flags = PageTableEntry::V | PageTableEntry::R | PageTableEntry::W
-                        | PageTableEntry::U | PageTableEntry::A | PageTableEntry::D;
-
-                    unsafe {
-                        let result = alloc_and_map_user_memory(root_ppn, current_page_end, size, pte_flags);
-                        if result.is_none() {
-                            return current_brk;
-                        }
-                    }
+                let addr_space = match current_task.address_space() {
+                    Some(addr_space) => addr_space,
+                    None => return current_brk,
+                };
+                if addr_space.expand_brk(current_brk as usize, new_brk as usize).is_err() {
+                    return current_brk;
                 }
 
                 current_task.set_brk(new_brk);
@@ -3169,7 +5363,6 @@ fn sys_brk(args: [u64; 6]) -> u64 {
 fn sys_mmap(args: [u64; 6]) -> u64 {
     use crate::mm::page::VirtAddr;
     use crate::mm::vma::{VmaFlags, VmaType};
-    use crate::mm::pagemap::Perm;
     use crate::arch::riscv64::mm::{prot, map, mmap_error};
 
     let addr = args[0] as usize;
@@ -3177,7 +5370,7 @@ fn sys_mmap(args: [u64; 6]) -> u64 {
     let prot_flags = args[2] as u32;
     let map_flags = args[3] as u32;
     let fd = args[4] as i32;
-    let _offset = args[5] as u64;
+    let offset = args[5] as u64;
 
     // 特殊处理：如果 length=0，分配一个页面
     // 这是为了兼容某些程序（如 musl）可能在某些边缘情况下请求 0 长度
@@ -3203,6 +5396,28 @@ fn sys_mmap(args: [u64; 6]) -> u64 {
         return sys_mmap_framebuffer(addr, actual_length, prot_flags, map_flags);
     }
 
+    // io_uring 环：按偏移映射 SQ/CQ 环或 SQE 数组，与内核共享
+    // /dev/kstats：只读映射统计页
+    if fd >= 0 && map_flags & map::MAP_ANONYMOUS == 0 {
+        if let Some(file) = unsafe { crate::fs::get_file_fd(fd as usize) } {
+            if crate::fs::io_uring::is_io_uring(&file) {
+                if map_type != map::MAP_SHARED {
+                    return mmap_error::EINVAL as u64;
+                }
+                return match crate::fs::io_uring::io_uring_mmap(&file, addr, actual_length, offset) {
+                    Ok(start) => start as u64,
+                    Err(e) => e as i64 as u64,
+                };
+            }
+            if crate::fs::char_dev::is_kstats_file(&file) {
+                return match crate::kstats::kstats_mmap(addr, actual_length, prot_flags, offset) {
+                    Ok(start) => start as u64,
+                    Err(e) => e as i64 as u64,
+                };
+            }
+        }
+    }
+
     // 非匿名映射且没有文件描述符
     if (map_flags & map::MAP_ANONYMOUS == 0) && fd < 0 {
         return mmap_error::EBADF as u64;
@@ -3212,25 +5427,8 @@ fn sys_mmap(args: [u64; 6]) -> u64 {
     match crate::sched::current() {
         Some(current_task) => {
             // 检查是否有地址空间
-            match current_task.address_space_mut() {
+            match current_task.address_space() {
                 Some(address_space) => {
-                    // 解析保护标志
-                    let perm = if prot_flags & prot::PROT_EXEC != 0 {
-                        if prot_flags & prot::PROT_WRITE != 0 {
-                            Perm::ReadWriteExec
-                        } else if prot_flags & prot::PROT_READ != 0 {
-                            Perm::ReadWriteExec  // 简化：读+执行
-                        } else {
-                            Perm::ReadWriteExec  // 简化：仅执行
-                        }
-                    } else if prot_flags & prot::PROT_WRITE != 0 {
-                        Perm::ReadWrite
-                    } else if prot_flags & prot::PROT_READ != 0 {
-                        Perm::Read
-                    } else {
-                        Perm::None
-                    };
-
                     // 解析 VMA 标志
                     let mut vma_flags = VmaFlags::new();
 
@@ -3252,6 +5450,10 @@ fn sys_mmap(args: [u64; 6]) -> u64 {
                     if map_flags & map::MAP_STACK != 0 {
                         vma_flags.insert(VmaFlags::GROWSDOWN);
                     }
+                    // 匿名大页映射 (MAP_HUGETLB)
+                    if map_flags & map::MAP_HUGETLB != 0 && map_flags & map::MAP_ANONYMOUS != 0 {
+                        vma_flags.insert(VmaFlags::HUGETLB);
+                    }
 
                     // 设置 VMA 类型
                     let vma_type = if map_flags & map::MAP_ANONYMOUS != 0 {
@@ -3260,15 +5462,39 @@ fn sys_mmap(args: [u64; 6]) -> u64 {
                         VmaType::FileBacked
                     };
 
+                    // 有页缓存的文件映射缓存页，共享库的代码页在进程间共享
+                    let file_ino = if vma_type == VmaType::FileBacked {
+                        let file = match unsafe { crate::fs::get_file_fd(fd as usize) } {
+                            Some(file) => file,
+                            None => return mmap_error::EBADF as u64,
+                        };
+                        // 可写的共享映射会把修改写回文件，文件必须以读写方式打开
+                        if map_type == map::MAP_SHARED && prot_flags & prot::PROT_WRITE != 0 && !file.flags.is_rdwr() {
+                            return mmap_error::EACCES as u64;
+                        }
+                        crate::fs::vfs::file_mapping(&file).map(|mapping| mapping.ino())
+                    } else {
+                        None
+                    };
+
                     // 调用 AddressSpace::mmap
-                    let result = address_space.mmap(
-                        VirtAddr::new(addr),
-                        actual_length,
-                        vma_flags,
-                        vma_type,
-                        perm,
-                        map_flags,
-                    );
+                    let result = match file_ino {
+                        Some(ino) => address_space.mmap_file(
+                            VirtAddr::new(addr),
+                            actual_length,
+                            vma_flags,
+                            ino,
+                            offset as usize,
+                            map_flags,
+                        ),
+                        None => address_space.mmap(
+                            VirtAddr::new(addr),
+                            actual_length,
+                            vma_flags,
+                            vma_type,
+                            map_flags,
+                        ),
+                    };
                     match result {
                         Ok(mapped_addr) => mapped_addr.as_usize() as u64,
                         Err(e) => {
@@ -3299,8 +5525,9 @@ fn sys_mmap(args: [u64; 6]) -> u64 {
 ///
 /// # 返回
 /// 成功返回映射的虚拟地址，失败返回负错误码
-fn sys_mmap_framebuffer(addr: usize, length: usize, prot: u32, flags: u32) -> u64 {
+fn sys_mmap_framebuffer(addr: usize, length: usize, prot: u32, _flags: u32) -> u64 {
     use crate::mm::page::{VirtAddr, PAGE_SIZE};
+    use crate::mm::vma::VmaFlags;
     use crate::arch::riscv64::mm::PageTableEntry;
 
     // 获取 framebuffer 信息
@@ -3315,47 +5542,43 @@ fn sys_mmap_framebuffer(addr: usize, length: usize, prot: u32, flags: u32) -> u6
     }
 
     // 获取当前进程
-    let _current_task = match crate::sched::current() {
+    let current_task = match crate::sched::current() {
         Some(task) => task,
         None => return -12_i64 as u64,  // ENOMEM
     };
+    let aspace = match current_task.address_space() {
+        Some(aspace) => aspace,
+        None => return -12_i64 as u64,  // ENOMEM
+    };
 
-    // 计算映射的虚拟地址
-    // 使用固定地址 0x60000000 作为 framebuffer 映射地址
-    let vaddr = if addr == 0 { 0x6000_0000 } else { addr };
-    let vaddr_aligned = vaddr & !(PAGE_SIZE - 1);
-
-    // 计算需要的页数
-    let pages_needed = (length + PAGE_SIZE - 1) / PAGE_SIZE;
+    // 帧缓冲区是 virtio-gpu 资源的后备内存（普通 RAM，不是 MMIO），按普通可缓存内存映射；
+    // 像素在 FBIO_DAMAGE 时才传输到主机，驱动在提交传输命令前排序这些写入
     let fb_phys_addr = fb_info.addr as usize;
     let fb_phys_aligned = fb_phys_addr & !(PAGE_SIZE - 1);
+    let map_len = (length + (fb_phys_addr - fb_phys_aligned) + PAGE_SIZE - 1) & !(PAGE_SIZE - 1);
 
-    // 获取当前进程的页表
-    // 这里需要直接修改用户进程的页表
-    unsafe {
-        // 构建页表项标志
-        let mut pte_flags = PageTableEntry::V | PageTableEntry::U;  // Valid + User
-        if prot & 0x1 != 0 {  // PROT_READ
-            pte_flags |= PageTableEntry::R;
-        }
-        if prot & 0x2 != 0 {  // PROT_WRITE
-            pte_flags |= PageTableEntry::R | PageTableEntry::W;
-        }
-        if prot & 0x4 != 0 {  // PROT_EXEC
-            pte_flags |= PageTableEntry::X;
-        }
-
-        // 映射每一页
-        for i in 0..pages_needed {
-            let va = vaddr_aligned + i * PAGE_SIZE;
-            let pa = fb_phys_aligned + i * PAGE_SIZE;
-
-            // 使用内核的映射函数
-            crate::arch::riscv64::mm::map_device_page(va, pa, pte_flags);
-        }
+    // 构建页表项与 VMA 标志
+    let mut pte_flags = PageTableEntry::V | PageTableEntry::U;  // Valid + User
+    let mut vma_flags = VmaFlags::new();
+    vma_flags.insert(VmaFlags::SHARED);
+    if prot & 0x1 != 0 {  // PROT_READ
+        pte_flags |= PageTableEntry::R;
+        vma_flags.insert(VmaFlags::READ);
+    }
+    if prot & 0x2 != 0 {  // PROT_WRITE
+        pte_flags |= PageTableEntry::R | PageTableEntry::W;
+        vma_flags.insert(VmaFlags::READ | VmaFlags::WRITE);
+    }
+    if prot & 0x4 != 0 {  // PROT_EXEC
+        pte_flags |= PageTableEntry::X;
+        vma_flags.insert(VmaFlags::EXEC);
     }
 
-    vaddr_aligned as u64
+    // 由内核选址，2MB 对齐的部分使用大页
+    match aspace.mmap_pfn(VirtAddr::new(addr), fb_phys_aligned, map_len, vma_flags, pte_flags) {
+        Ok(start) => (start.as_usize() + (fb_phys_addr - fb_phys_aligned)) as u64,
+        Err(_) => -12_i64 as u64,  // ENOMEM
+    }
 }
 
 /// sys_read_input_event - 读取输入事件
@@ -3427,7 +5650,7 @@ fn sys_munmap(args: [u64; 6]) -> u64 {
     match crate::sched::current() {
         Some(current_task) => {
             // 检查是否有地址空间
-            match current_task.address_space_mut() {
+            match current_task.address_space() {
                 Some(address_space) => {
                     // 调用 AddressSpace::munmap
                     match address_space.munmap(VirtAddr::new(addr), length) {
@@ -3473,24 +5696,24 @@ fn sys_mprotect(args: [u64; 6]) -> u64 {
     let length = args[1] as usize;
     let prot = args[2] as u32;
 
-    println!("sys_mprotect: addr={:#x}, length={}, prot={:#x}", addr, length, prot);
+    tracepoint!(SYSCALL, "sys_mprotect: addr={:#x}, length={}, prot={:#x}", addr, length, prot);
 
     // 验证参数
     if length == 0 {
-        println!("sys_mprotect: length is 0");
+        tracepoint!(SYSCALL, "sys_mprotect: length is 0");
         return -22_i64 as u64;  // EINVAL
     }
 
     // 地址必须页对齐
     if addr % crate::mm::page::PAGE_SIZE != 0 {
-        println!("sys_mprotect: addr not page aligned");
+        tracepoint!(SYSCALL, "sys_mprotect: addr not page aligned");
         return -22_i64 as u64;  // EINVAL
     }
 
     // 获取当前进程
     match crate::sched::current() {
         Some(current_task) => {
-            match current_task.address_space_mut() {
+            match current_task.address_space() {
                 Some(address_space) => {
                     // 解析保护标志
                     let mut perm = Perm::None;
@@ -3517,17 +5740,17 @@ fn sys_mprotect(args: [u64; 6]) -> u64 {
                     // TODO: 实现完整的 mprotect 逻辑
 
                     // 当前简化：直接返回成功
-                    println!("sys_mprotect: protection changed to {:?} (simplified)", perm);
+                    tracepoint!(SYSCALL, "sys_mprotect: protection changed to {:?}", perm);
                     0
                 }
                 None => {
-                    println!("sys_mprotect: no address space");
+                    tracepoint!(SYSCALL, "sys_mprotect: no address space");
                     -12_i64 as u64  // ENOMEM
                 }
             }
         }
         None => {
-            println!("sys_mprotect: no current task");
+            tracepoint!(SYSCALL, "sys_mprotect: no current task");
             -12_i64 as u64  // ENOMEM
         }
     }
@@ -3555,47 +5778,49 @@ fn sys_msync(args: [u64; 6]) -> u64 {
     let length = args[1] as usize;
     let flags = args[2] as u32;
 
-    println!("sys_msync: addr={:#x}, length={}, flags={:#x}", addr, length, flags);
+    tracepoint!(SYSCALL, "sys_msync: addr={:#x}, length={}, flags={:#x}", addr, length, flags);
 
-    // msync 标志
+    // msync 标志（与 Linux/musl 的取值一致）
     const MS_ASYNC: u32 = 0x1;     // 异步写入
-    const MS_SYNC: u32 = 0x2;      // 同步写入
-    const MS_INVALIDATE: u32 = 0x4; // 使缓存失效
+    const MS_INVALIDATE: u32 = 0x2; // 使缓存失效
+    const MS_SYNC: u32 = 0x4;      // 同步写入
 
     // 验证标志
     if flags & !(MS_ASYNC | MS_SYNC | MS_INVALIDATE) != 0 {
-        println!("sys_msync: invalid flags");
+        tracepoint!(SYSCALL, "sys_msync: invalid flags");
         return -22_i64 as u64;  // EINVAL
     }
 
     // 不能同时设置 ASYNC 和 SYNC
     if (flags & MS_ASYNC != 0) && (flags & MS_SYNC != 0) {
-        println!("sys_msync: MS_ASYNC and MS_SYNC are mutually exclusive");
-        return -22_i64 as u64;  // EINVAL
-    }
-
-    // 验证参数
-    if length == 0 {
-        println!("sys_msync: length is 0");
+        tracepoint!(SYSCALL, "sys_msync: MS_ASYNC and MS_SYNC are mutually exclusive");
         return -22_i64 as u64;  // EINVAL
     }
 
     // 地址必须页对齐
     if addr % crate::mm::page::PAGE_SIZE != 0 {
-        println!("sys_msync: addr not page aligned");
+        tracepoint!(SYSCALL, "sys_msync: addr not page aligned");
         return -22_i64 as u64;  // EINVAL
     }
 
-    // 简化实现：
-    // 在真实实现中，应该：
-    // 1. 查找覆盖 [addr, addr+length) 的所有 VMA
-    // 2. 对文件映射的 VMA，将脏页写回
-    // 3. 如果设置了 MS_INVALIDATE，使缓存失效
-    // TODO: 实现完整的 msync 逻辑
-
-    println!("sys_msync: sync completed (simplified implementation)");
+    if length == 0 {
+        return 0;
+    }
 
-    0  // 成功
+    // 写保护共享文件映射中写过的页并把它们转为页缓存中的脏页；MS_SYNC 还等待回写完成
+    match crate::sched::current() {
+        Some(current_task) => match current_task.address_space() {
+            Some(address_space) => match address_space.msync(VirtAddr::new(addr), length, flags & MS_SYNC != 0) {
+                Ok(()) => 0,
+                Err(e) => {
+                    tracepoint!(SYSCALL, "sys_msync: failed: {}", e);
+                    e as i64 as u64
+                }
+            },
+            None => -12_i64 as u64,  // ENOMEM
+        },
+        None => -12_i64 as u64,  // ENOMEM
+    }
 }
 
 /// sys_mremap - 重新映射内存
@@ -3614,9 +5839,10 @@ fn sys_msync(args: [u64; 6]) -> u64 {
 /// - RISC-V: 216
 ///
 /// # 说明
-/// mremap 扩展或收缩已有的内存映射
+/// mremap 扩展或收缩已有的内存映射；需要移动时搬移页表项，不复制页内容
 fn sys_mremap(args: [u64; 6]) -> u64 {
     use crate::mm::page::VirtAddr;
+    use crate::mm::pagemap::MapError;
 
     let old_addr = args[0] as usize;
     let old_size = args[1] as usize;
@@ -3624,72 +5850,39 @@ fn sys_mremap(args: [u64; 6]) -> u64 {
     let flags = args[3] as u32;
     let new_addr = args[4] as usize;
 
-    println!("sys_mremap: old_addr={:#x}, old_size={}, new_size={}, flags={:#x}",
-             old_addr, old_size, new_size, flags);
-
-    // mremap 标志
-    const MREMAP_MAYMOVE: u32 = 0x1;  // 可以移动到新地址
-    const MREMAP_FIXED: u32 = 0x2;   // 必须映射到指定地址
-
-    // 验证参数
-    if old_size == 0 || new_size == 0 {
-        println!("sys_mremap: invalid size");
-        return -22_i64 as u64;  // EINVAL
-    }
-
-    // 地址必须页对齐
-    if old_addr % crate::mm::page::PAGE_SIZE != 0 {
-        println!("sys_mremap: old_addr not page aligned");
-        return -22_i64 as u64;  // EINVAL
-    }
-
-    if (flags & MREMAP_FIXED != 0) && (new_addr % crate::mm::page::PAGE_SIZE != 0) {
-        println!("sys_mremap: new_addr not page aligned with MREMAP_FIXED");
-        return -22_i64 as u64;  // EINVAL
-    }
+    tracepoint!(SYSCALL, "sys_mremap: old_addr={:#x}, old_size={}, new_size={}, flags={:#x}",
+                         old_addr, old_size, new_size, flags);
 
     // 获取当前进程
     match crate::sched::current() {
-        Some(current_task) => {
-            match current_task.address_space_mut() {
-                Some(address_space) => {
-                    // 简化实现：
-                    // 在真实实现中，应该：
-                    // 1. 查找 [old_addr, old_addr+old_size) 的 VMA
-                    // 2. 如果扩展，检查是否有空间
-                    // 3. 如果收缩，释放多余空间
-                    // 4. 如果设置了 MAYMOVE 且无法原地扩展，移动到新位置
-                    // 5. 如果设置了 FIXED，必须映射到指定地址
-                    // TODO: 实现完整的 mremap 逻辑
-
-                    // 当前简化实现：只支持原地收缩或扩展（不移动）
-                    if new_size == old_size {
-                        println!("sys_mremap: size unchanged, returning old address");
-                        return old_addr as u64;
+        Some(current_task) => match current_task.address_space() {
+            Some(address_space) => {
+                match address_space.mremap(VirtAddr::new(old_addr), old_size, new_size, flags, VirtAddr::new(new_addr)) {
+                    Ok(addr) => {
+                        tracepoint!(SYSCALL, "sys_mremap: remapped to {:#x}", addr.as_usize());
+                        addr.as_usize() as u64
+                    }
+                    Err(MapError::NotMapped) => {
+                        tracepoint!(SYSCALL, "sys_mremap: old range not mapped by a single VMA");
+                        -14_i64 as u64  // EFAULT
+                    }
+                    Err(MapError::OutOfMemory) | Err(MapError::AlreadyMapped) => {
+                        tracepoint!(SYSCALL, "sys_mremap: no room to grow or move");
+                        -12_i64 as u64  // ENOMEM
+                    }
+                    Err(_) => {
+                        tracepoint!(SYSCALL, "sys_mremap: invalid arguments");
+                        -22_i64 as u64  // EINVAL
                     }
-
-                    // 简化实现：
-                    // 在真实实现中，应该：
-                    // 1. 查找 [old_addr, old_addr+old_size) 的 VMA
-                    // 2. 如果扩展，检查是否有空间
-                    // 3. 如果收缩，释放多余空间
-                    // 4. 如果设置了 MAYMOVE 且无法原地扩展，移动到新位置
-                    // 5. 如果设置了 FIXED，必须映射到指定地址
-                    // TODO: 实现完整的 mremap 逻辑
-
-                    // 当前简化：只支持原地扩展/收缩（不移动）
-                    // 假设操作成功，返回原地址
-                    println!("sys_mremap: remapped to {:#x} (simplified)", old_addr);
-                    old_addr as u64
-                }
-                None => {
-                    println!("sys_mremap: no address space");
-                    -12_i64 as u64  // ENOMEM
                 }
             }
-        }
+            None => {
+                tracepoint!(SYSCALL, "sys_mremap: no address space");
+                -12_i64 as u64  // ENOMEM
+            }
+        },
         None => {
-            println!("sys_mremap: no current task");
+            tracepoint!(SYSCALL, "sys_mremap: no current task");
             -12_i64 as u64  // ENOMEM
         }
     }
@@ -3717,62 +5910,31 @@ fn sys_madvise(args: [u64; 6]) -> u64 {
     let length = args[1] as usize;
     let advice = args[2] as i32;
 
-    println!("sys_madvise: addr={:#x}, length={}, advice={}", addr, length, advice);
-
-    // madvise 建议类型
-    const MADV_NORMAL: i32 = 0;      // 无特殊建议
-    const MADV_RANDOM: i32 = 1;      // 随机访问
-    const MADV_SEQUENTIAL: i32 = 2;  // 顺序访问
-    const MADV_WILLNEED: i32 = 3;    // 将要访问
-    const MADV_DONTNEED: i32 = 4;    // 不再需要
-    const MADV_REMOVE: i32 = 9;      // 释放映射
-    const MADV_DONTFORK: i32 = 10;   // fork 时不复制
-    const MADV_DOFORK: i32 = 11;     // fork 时复制
-    const MADV_MERGEABLE: i32 = 12;  // 可合并（KSM）
-    const MADV_UNMERGEABLE: i32 = 13; // 不可合并
-    const MADV_HUGEPAGE: i32 = 14;    // 使用巨页
-    const MADV_NOHUGEPAGE: i32 = 15;  // 不使用巨页
-    const MADV_DONTDUMP: i32 = 16;    // 不转储到 core
-    const MADV_DODUMP: i32 = 17;      // 转储到 core
-    const MADV_HWPOISON: i32 = 100;   // 标记为损坏
-
-    // 验证参数
-    if length == 0 {
-        println!("sys_madvise: length is 0");
-        return -22_i64 as u64;  // EINVAL
-    }
+    tracepoint!(SYSCALL, "sys_madvise: addr={:#x}, length={}, advice={}", addr, length, advice);
 
     // 地址必须页对齐
     if addr % crate::mm::page::PAGE_SIZE != 0 {
-        println!("sys_madvise: addr not page aligned");
+        tracepoint!(SYSCALL, "sys_madvise: addr not page aligned");
         return -22_i64 as u64;  // EINVAL
     }
 
-    // 验证 advice 类型
-    match advice {
-        MADV_NORMAL | MADV_RANDOM | MADV_SEQUENTIAL | MADV_WILLNEED |
-        MADV_DONTNEED | MADV_REMOVE | MADV_DONTFORK | MADV_DOFORK |
-        MADV_MERGEABLE | MADV_UNMERGEABLE | MADV_HUGEPAGE | MADV_NOHUGEPAGE |
-        MADV_DONTDUMP | MADV_DODUMP => {
-            // 有效的 advice
-        }
-        _ => {
-            println!("sys_madvise: invalid advice {}", advice);
-            return -22_i64 as u64;  // EINVAL
-        }
+    match crate::sched::current() {
+        Some(current_task) => match current_task.address_space() {
+            Some(address_space) => match address_space.madvise(VirtAddr::new(addr), length, advice) {
+                Ok(()) => 0,
+                Err(crate::mm::pagemap::MapError::NotMapped) => {
+                    tracepoint!(SYSCALL, "sys_madvise: range not mapped");
+                    -12_i64 as u64  // ENOMEM
+                }
+                Err(_) => {
+                    tracepoint!(SYSCALL, "sys_madvise: advice {} rejected", advice);
+                    -22_i64 as u64  // EINVAL
+                }
+            },
+            None => -12_i64 as u64,  // ENOMEM
+        },
+        None => -12_i64 as u64,  // ENOMEM
     }
-
-    // 简化实现：
-    // 在真实实现中，应该：
-    // 1. 查找覆盖 [addr, addr+length) 的所有 VMA
-    // 2. 根据 advice 更新 VMA 的标志或行为
-    // 3. 对于 MADV_DONTNEED，可以释放物理页
-    // 4. 对于 MADV_REMOVE，调用 madvise_remove
-    // TODO: 实现完整的 madvise 逻辑
-
-    println!("sys_madvise: advice {} recorded (simplified implementation)", advice);
-
-    0  // 成功
 }
 
 /// sys_mincore - 查询页面是否在内存中
@@ -3797,46 +5959,49 @@ fn sys_mincore(args: [u64; 6]) -> u64 {
     let length = args[1] as usize;
     let vec_ptr = args[2] as *mut u8;
 
-    println!("sys_mincore: addr={:#x}, length={}, vec={:#x}", addr, length, vec_ptr as usize);
-
-    // 验证参数
-    if length == 0 {
-        println!("sys_mincore: length is 0");
-        return -22_i64 as u64;  // EINVAL
-    }
+    tracepoint!(SYSCALL, "sys_mincore: addr={:#x}, length={}, vec={:#x}", addr, length, vec_ptr as usize);
 
     // 地址必须页对齐
     if addr % crate::mm::page::PAGE_SIZE != 0 {
-        println!("sys_mincore: addr not page aligned");
+        tracepoint!(SYSCALL, "sys_mincore: addr not page aligned");
         return -22_i64 as u64;  // EINVAL
     }
 
+    if length == 0 {
+        return 0;
+    }
+
     // 验证 vec 指针
     if vec_ptr.is_null() {
-        println!("sys_mincore: vec is null");
-        return -22_i64 as u64;  // EINVAL
+        tracepoint!(SYSCALL, "sys_mincore: vec is null");
+        return -14_i64 as u64;  // EFAULT
     }
 
-    // 计算需要的页数
-    let page_count = (length + crate::mm::page::PAGE_SIZE - 1) / crate::mm::page::PAGE_SIZE;
+    let current_task = match crate::sched::current() {
+        Some(task) => task,
+        None => return -12_i64 as u64,  // ENOMEM
+    };
+    let address_space = match current_task.address_space() {
+        Some(space) => space,
+        None => return -12_i64 as u64,  // ENOMEM
+    };
 
-    // 简化实现：
-    // 在真实实现中，应该：
-    // 1. 查找覆盖 [addr, addr+length) 的所有 VMA
-    // 2. 检查每个页面的页表项
-    // 3. 如果页面在内存中，设置对应位
-    // 4. vec 的每个字节表示一个页面的状态
-    // TODO: 实现完整的 mincore 逻辑
+    // 先在内核缓冲区中收集（持页表锁），再写回用户空间：写 vec 本身可能缺页
+    let residency = match address_space.mincore(VirtAddr::new(addr), length) {
+        Ok(vec) => vec,
+        Err(crate::mm::pagemap::MapError::Invalid) => return -22_i64 as u64,  // EINVAL
+        Err(_) => {
+            tracepoint!(SYSCALL, "sys_mincore: range not mapped");
+            return -12_i64 as u64;  // ENOMEM
+        }
+    };
 
-    // 当前简化：假设所有页面都在内存中
     unsafe {
-        for i in 0..page_count {
-            // 设置最低位表示页面在内存中
-            *vec_ptr.add(i) = 1;
-        }
+        core::ptr::copy_nonoverlapping(residency.as_ptr(), vec_ptr, residency.len());
     }
 
-    println!("sys_mincore: {} pages checked (all in memory - simplified)", page_count);
+    tracepoint!(SYSCALL, "sys_mincore: {} pages checked, {} resident",
+                residency.len(), residency.iter().filter(|&&r| r != 0).count());
 
     0  // 成功
 }
@@ -3861,17 +6026,17 @@ fn sys_mlock(args: [u64; 6]) -> u64 {
     let addr = args[0] as usize;
     let length = args[1] as usize;
 
-    println!("sys_mlock: addr={:#x}, length={}", addr, length);
+    tracepoint!(SYSCALL, "sys_mlock: addr={:#x}, length={}", addr, length);
 
     // 验证参数
     if length == 0 {
-        println!("sys_mlock: length is 0");
+        tracepoint!(SYSCALL, "sys_mlock: length is 0");
         return -22_i64 as u64;  // EINVAL
     }
 
     // 地址必须页对齐
     if addr % crate::mm::page::PAGE_SIZE != 0 {
-        println!("sys_mlock: addr not page aligned");
+        tracepoint!(SYSCALL, "sys_mlock: addr not page aligned");
         return -22_i64 as u64;  // EINVAL
     }
 
@@ -3883,7 +6048,7 @@ fn sys_mlock(args: [u64; 6]) -> u64 {
     // 4. 确保页面驻留在内存中
     // TODO: 实现完整的 mlock 逻辑
 
-    println!("sys_mlock: memory locked (simplified implementation)");
+    tracepoint!(SYSCALL, "sys_mlock: memory locked");
 
     0  // 成功
 }
@@ -3908,17 +6073,17 @@ fn sys_munlock(args: [u64; 6]) -> u64 {
     let addr = args[0] as usize;
     let length = args[1] as usize;
 
-    println!("sys_munlock: addr={:#x}, length={}", addr, length);
+    tracepoint!(SYSCALL, "sys_munlock: addr={:#x}, length={}", addr, length);
 
     // 验证参数
     if length == 0 {
-        println!("sys_munlock: length is 0");
+        tracepoint!(SYSCALL, "sys_munlock: length is 0");
         return -22_i64 as u64;  // EINVAL
     }
 
     // 地址必须页对齐
     if addr % crate::mm::page::PAGE_SIZE != 0 {
-        println!("sys_munlock: addr not page aligned");
+        tracepoint!(SYSCALL, "sys_munlock: addr not page aligned");
         return -22_i64 as u64;  // EINVAL
     }
 
@@ -3928,7 +6093,7 @@ fn sys_munlock(args: [u64; 6]) -> u64 {
     // 2. 清除 VM_LOCKED 标志
     // TODO: 实现完整的 munlock 逻辑
 
-    println!("sys_munlock: memory unlocked (simplified implementation)");
+    tracepoint!(SYSCALL, "sys_munlock: memory unlocked");
 
     0  // 成功
 }
@@ -3951,35 +6116,21 @@ pub unsafe fn set_syscall_ret(val: u64) {
     asm!("mv a0, {}", in(reg) val, options(nomem, nostack));
 }
 
-const USER_SPACE_END: u64 = 0x0000_ffff_ffff_ffff;
-
 #[inline]
 pub unsafe fn verify_user_ptr(ptr: u64) -> bool {
-    ptr <= USER_SPACE_END
+    ptr as usize <= crate::arch::riscv64::uaccess::USER_SPACE_END
 }
 
 pub unsafe fn verify_user_ptr_array(ptr: u64, size: usize) -> bool {
-    if ptr > USER_SPACE_END {
-        return false;
-    }
-
-    match ptr.checked_add(size as u64) {
-        Some(end) if end <= USER_SPACE_END => true,
-        _ => false,
-    }
+    crate::arch::riscv64::uaccess::access_ok(ptr as usize, size)
 }
 
 pub fn sys_write_impl(fd: i32, buf: *const u8, count: usize) -> u64 {
-    use crate::console::putchar;
-
     unsafe {
-        // Special handling for stdout (1) and stderr (2) - write directly to UART
+        // 标准输出、标准错误写串口终端
         if fd == 1 || fd == 2 {
             let slice = core::slice::from_raw_parts(buf, count);
-            for &b in slice {
-                putchar(b);
-            }
-            return count as u64;
+            return crate::drivers::tty::tty_write(slice, false) as u64;
         }
 
         // 其他文件描述符：使用 VFS
@@ -3987,11 +6138,11 @@ pub fn sys_write_impl(fd: i32, buf: *const u8, count: usize) -> u64 {
         match get_file_fd(fd as usize) {
             Some(_file) => {
                 // TODO: 实现 VFS write
-                crate::println!("sys_write: fd={}, count={} (VFS not implemented)", fd, count);
+                tracepoint!(SYSCALL, "sys_write: fd={}, count={} (VFS not implemented)", fd, count);
                 -9_i32 as u64  // EBADF
             }
             None => {
-                crate::println!("sys_write: invalid fd {}", fd);
+                tracepoint!(SYSCALL, "sys_write: invalid fd {}", fd);
                 -9_i32 as u64  // EBADF
             }
         }
@@ -4069,3 +6220,89 @@ pub fn sys_set_robust_list(args: [u64; 6]) -> u64 {
 
     -3_i64 as u64  // ESRCH
 }
+
+/// 读取 futex 的超时参数
+///
+/// # 参数
+/// - relative: FUTEX_WAIT 的超时是相对时间，其他操作是绝对时间
+///
+/// # 返回
+/// 绝对的单调时钟纳秒，指针为 NULL 时返回 Ok(None)
+fn get_futex_timeout(ptr: u64, relative: bool) -> Result<Option<u64>, u64> {
+    if ptr == 0 {
+        return Ok(None);
+    }
+    if !user_range_ok(ptr as usize, core::mem::size_of::<Timespec>()) {
+        return Err(-14_i64 as u64);  // EFAULT
+    }
+    let ts = unsafe { core::ptr::read_unaligned(ptr as *const Timespec) };
+    let ns = match timespec_to_ns(&ts) {
+        Some(ns) => ns,
+        None => return Err(-22_i64 as u64),  // EINVAL
+    };
+    // CLOCK_REALTIME 与 CLOCK_MONOTONIC 相同，都从启动开始计时
+    if relative {
+        Ok(Some(crate::time::ktime_get().saturating_add(ns)))
+    } else {
+        Ok(Some(ns))
+    }
+}
+
+/// sys_futex (98) - 快速用户空间互斥
+///
+/// # 参数
+/// - args[0]: uaddr - futex 字
+/// - args[1]: futex_op - 操作与 FUTEX_PRIVATE_FLAG / FUTEX_CLOCK_REALTIME
+/// - args[2]: val - 期望值或唤醒数量
+/// - args[3]: timeout - 超时 timespec，REQUEUE / WAKE_OP 时为第二个数量 val2
+/// - args[4]: uaddr2 - REQUEUE / WAKE_OP 的第二个 futex 字
+/// - args[5]: val3 - CMP_REQUEUE 的比较值、WAIT/WAKE_BITSET 的位掩码或 WAKE_OP 的编码
+///
+/// # 返回
+/// 取决于操作，失败返回负错误码
+fn sys_futex(args: [u64; 6]) -> u64 {
+    use crate::process::futex::*;
+
+    let uaddr = args[0] as usize;
+    let op = args[1] as i32;
+    let val = args[2] as u32;
+    let uaddr2 = args[4] as usize;
+    let val2 = args[3] as u32;
+    let val3 = args[5] as u32;
+    let cmd = op & FUTEX_CMD_MASK;
+    let flags = op & !FUTEX_CMD_MASK;
+
+    if flags & FUTEX_CLOCK_REALTIME != 0 && cmd != FUTEX_WAIT_BITSET && cmd != FUTEX_LOCK_PI {
+        return -38_i64 as u64;  // ENOSYS
+    }
+    if !user_range_ok(uaddr, 4) {
+        return -14_i64 as u64;  // EFAULT
+    }
+    if matches!(cmd, FUTEX_REQUEUE | FUTEX_CMP_REQUEUE | FUTEX_WAKE_OP) && !user_range_ok(uaddr2, 4) {
+        return -14_i64 as u64;  // EFAULT
+    }
+    let timeout = if matches!(cmd, FUTEX_WAIT | FUTEX_WAIT_BITSET | FUTEX_LOCK_PI) {
+        match get_futex_timeout(args[3], cmd == FUTEX_WAIT) {
+            Ok(timeout) => timeout,
+            Err(e) => return e,
+        }
+    } else {
+        None
+    };
+
+    let ret = match cmd {
+        FUTEX_WAIT => futex_wait(uaddr, flags, val, timeout, FUTEX_BITSET_MATCH_ANY),
+        FUTEX_WAIT_BITSET => futex_wait(uaddr, flags, val, timeout, val3),
+        FUTEX_WAKE => futex_wake(uaddr, flags, val as i32, FUTEX_BITSET_MATCH_ANY),
+        FUTEX_WAKE_BITSET => futex_wake(uaddr, flags, val as i32, val3),
+        FUTEX_REQUEUE => futex_requeue(uaddr, flags, uaddr2, val as i32, val2 as i32, None),
+        FUTEX_CMP_REQUEUE => futex_requeue(uaddr, flags, uaddr2, val as i32, val2 as i32, Some(val3)),
+        FUTEX_WAKE_OP => futex_wake_op(uaddr, flags, uaddr2, val as i32, val2 as i32, val3),
+        FUTEX_LOCK_PI => futex_lock_pi(uaddr, flags, timeout, false),
+        FUTEX_TRYLOCK_PI => futex_lock_pi(uaddr, flags, None, true),
+        FUTEX_UNLOCK_PI => futex_unlock_pi(uaddr, flags),
+        _ => -38,  // ENOSYS
+    };
+    tracepoint!(SYSCALL, "sys_futex: uaddr={:#x} op={} val={} ret={}", uaddr, op, val, ret);
+    ret as i64 as u64
+}
@@ -0,0 +1,187 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 系统调用统计
+//!
+//! 每个 CPU 分别记录各系统调用的次数、总周期数 (rdcycle) 和周期数的
+//! log2 直方图，由 /proc/syscall_stats 导出。
+//!
+//! 统计默认关闭，关闭时 syscall_handler 只多读一次开关。
+//! 向 /proc/syscall_stats 写入 `1` 打开、`0` 关闭、`reset` 清零
+
+extern crate alloc;
+
+use alloc::string::String;
+use core::fmt::Write;
+use core::sync::atomic::{AtomicBool, Ordering};
+
+use crate::config::MAX_CPUS;
+use super::syscall::{syscall_name, NR_SYSCALLS};
+
+/// 直方图桶数
+///
+/// 第 0 桶统计少于 2^HIST_SHIFT 个周期的调用，第 i 桶统计
+/// [2^(HIST_SHIFT+i-1), 2^(HIST_SHIFT+i)) 个周期，最后一桶包含更长的调用
+pub const HIST_BUCKETS: usize = 12;
+const HIST_SHIFT: u32 = 8;
+
+/// 单个 CPU 上一个系统调用的计数
+#[derive(Clone, Copy)]
+struct SyscallCounter {
+    calls: u64,
+    cycles: u64,
+    hist: [u32; HIST_BUCKETS],
+}
+
+impl SyscallCounter {
+    const fn new() -> Self {
+        Self { calls: 0, cycles: 0, hist: [0; HIST_BUCKETS] }
+    }
+}
+
+crate::percpu! {
+    /// 各 CPU 的计数，只由本 CPU 在关中断时修改
+    static SYSCALL_STATS: [SyscallCounter; NR_SYSCALLS] = [SyscallCounter::new(); NR_SYSCALLS];
+}
+
+/// 统计开关
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+/// 汇总各 CPU 后的统计
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct SyscallStat {
+    /// 调用次数
+    pub calls: u64,
+    /// 总周期数
+    pub cycles: u64,
+    /// 周期数直方图
+    pub hist: [u64; HIST_BUCKETS],
+}
+
+/// 统计是否打开
+#[inline]
+pub fn enabled() -> bool {
+    ENABLED.load(Ordering::Relaxed)
+}
+
+/// 打开或关闭统计
+pub fn set_enabled(on: bool) {
+    ENABLED.store(on, Ordering::Relaxed);
+}
+
+/// 读取周期计数器 (get_cycles)
+#[inline]
+pub fn rdcycle() -> u64 {
+    let cycles: u64;
+    unsafe { core::arch::asm!("rdcycle {}", out(reg) cycles, options(nomem, nostack)) };
+    cycles
+}
+
+/// 周期数所在的直方图桶
+#[inline]
+fn hist_bucket(cycles: u64) -> usize {
+    let bits = 64 - cycles.leading_zeros();
+    (bits.saturating_sub(HIST_SHIFT) as usize).min(HIST_BUCKETS - 1)
+}
+
+/// 记录一次系统调用 (trace_sys_exit)
+pub fn account(nr: usize, cycles: u64) {
+    if nr >= NR_SYSCALLS {
+        return;
+    }
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let counter = unsafe { &mut (*SYSCALL_STATS.this_cpu_ptr())[nr] };
+    counter.calls += 1;
+    counter.cycles = counter.cycles.wrapping_add(cycles);
+    let bucket = &mut counter.hist[hist_bucket(cycles)];
+    *bucket = bucket.saturating_add(1);
+}
+
+/// 一个系统调用在各 CPU 上的调用次数
+pub fn per_cpu_calls(nr: usize) -> [u64; MAX_CPUS] {
+    let mut calls = [0; MAX_CPUS];
+    if nr < NR_SYSCALLS {
+        for (cpu_id, c) in calls.iter_mut().enumerate() {
+            *c = unsafe { (*SYSCALL_STATS.per_cpu_ptr(cpu_id))[nr].calls };
+        }
+    }
+    calls
+}
+
+/// 汇总一个系统调用在所有 CPU 上的统计
+pub fn syscall_stat(nr: usize) -> SyscallStat {
+    let mut stat = SyscallStat::default();
+    if nr >= NR_SYSCALLS {
+        return stat;
+    }
+    for cpu_id in 0..MAX_CPUS {
+        let counter = unsafe { (*SYSCALL_STATS.per_cpu_ptr(cpu_id))[nr] };
+        stat.calls += counter.calls;
+        stat.cycles = stat.cycles.wrapping_add(counter.cycles);
+        for (sum, &n) in stat.hist.iter_mut().zip(counter.hist.iter()) {
+            *sum += n as u64;
+        }
+    }
+    stat
+}
+
+/// 清零所有 CPU 的统计
+pub fn reset() {
+    for cpu_id in 0..MAX_CPUS {
+        for nr in 0..NR_SYSCALLS {
+            unsafe { (*SYSCALL_STATS.per_cpu_ptr(cpu_id))[nr] = SyscallCounter::new() };
+        }
+    }
+}
+
+/// 生成 /proc/syscall_stats 内容
+///
+/// 只列出调用过的系统调用：编号、处理函数、总次数、平均周期、
+/// 各 CPU 的次数和周期直方图
+pub fn generate_stats() -> String {
+    let mut out = String::new();
+    let _ = writeln!(out, "enabled {}", enabled() as u8);
+    let _ = write!(out, "{:>4} {:<24} {:>10} {:>10}", "nr", "name", "calls", "avg_cyc");
+    for cpu_id in 0..MAX_CPUS {
+        let _ = write!(out, " {:>8}", alloc::format!("cpu{}", cpu_id));
+    }
+    let _ = write!(out, " | {:>6}", alloc::format!("<2^{}", HIST_SHIFT));
+    for i in 1..HIST_BUCKETS - 1 {
+        let _ = write!(out, " {:>6}", alloc::format!("<2^{}", HIST_SHIFT as usize + i));
+    }
+    let _ = writeln!(out, " {:>6}", alloc::format!(">=2^{}", HIST_SHIFT as usize + HIST_BUCKETS - 2));
+
+    for nr in 0..NR_SYSCALLS {
+        let stat = syscall_stat(nr);
+        if stat.calls == 0 {
+            continue;
+        }
+        let _ = write!(out, "{:>4} {:<24} {:>10} {:>10}", nr, syscall_name(nr).unwrap_or("-"), stat.calls,
+                       stat.cycles / stat.calls);
+        for calls in per_cpu_calls(nr) {
+            let _ = write!(out, " {:>8}", calls);
+        }
+        let _ = write!(out, " |");
+        for n in stat.hist {
+            let _ = write!(out, " {:>6}", n);
+        }
+        let _ = writeln!(out);
+    }
+    out
+}
+
+/// 处理 /proc/syscall_stats 的写入
+///
+/// # 返回
+/// 成功返回写入的字节数，格式错误返回 -EINVAL
+pub fn write_control(data: &[u8]) -> Result<usize, i32> {
+    match core::str::from_utf8(data).map(|s| s.trim()) {
+        Ok("1") => set_enabled(true),
+        Ok("0") => set_enabled(false),
+        Ok("reset") => reset(),
+        _ => return Err(crate::errno::Errno::InvalidArgument.as_neg_i32()),
+    }
+    Ok(data.len())
+}
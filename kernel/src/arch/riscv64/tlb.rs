@@ -0,0 +1,522 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! RISC-V ASID 分配与 TLB 刷新
+//!
+//! 参考 Linux: arch/riscv/mm/context.c, arch/riscv/mm/tlbflush.c
+//!
+//! # ASID
+//! - 每个地址空间分配一个 ASID 写入 satp，切换地址空间时不再刷新整个 TLB
+//! - ASID 按代 (version) 分配：context id = 代数 | ASID。ASID 用完后代数加一，
+//!   清空位图，各 CPU 正在使用的 ASID 保留到新一代 (reserved_context)，
+//!   所有 CPU 在下一次 switch_mm 时刷新本地 TLB
+//! - 硬件 ASID 位数不足以给每个 CPU 分配两个 ASID 时关闭 ASID，
+//!   退化为每次切换刷新整个 TLB
+//!
+//! # TLB 刷新
+//! - 修改页表后按地址 + ASID 刷新 (sfence.vma vaddr, asid)，
+//!   页数超过 TLB_FLUSH_ALL_THRESHOLD 时按 ASID 整体刷新
+//! - 地址空间在其他 CPU 上运行过时，把刷新请求放入目标 CPU 的队列并发送
+//!   TlbFlush IPI；队列中已有请求的 CPU 不再重复发送 IPI，
+//!   目标 CPU 一次处理队列中的全部请求
+//! - 发送方等待目标 CPU 处理完毕；等待期间处理发给自己的刷新请求，
+//!   避免两个 CPU 互相等待
+//! - 不知道所属地址空间时 (页回收) 用 flush_tlb_all 刷新所有运行过用户态的 CPU
+
+use core::arch::asm;
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use spin::Mutex;
+
+use crate::config::MAX_CPUS;
+
+/// satp 中 ASID 字段的位置
+const SATP_ASID_SHIFT: u64 = 44;
+const SATP_ASID_MASK: u64 = 0xFFFF;
+
+/// 页大小
+const PAGE_SIZE: usize = 4096;
+
+/// 超过该页数时按 ASID 整体刷新 (tlb_flush_all_threshold)
+pub const TLB_FLUSH_ALL_THRESHOLD: usize = 64;
+
+/// ASID 位图字数（最多 2^16 个 ASID）
+const ASID_MAP_WORDS: usize = (1 << 16) / 64;
+
+/// 每个 CPU 远程刷新队列的容量，溢出时整体刷新
+const FLUSH_QUEUE_LEN: usize = 8;
+
+/// 地址空间的 TLB 上下文 (mm_context_t)
+pub struct MmContext {
+    /// 代数 | ASID，0 表示尚未分配
+    id: AtomicU64,
+    /// 运行过此地址空间的 CPU (mm_cpumask)
+    cpumask: AtomicUsize,
+}
+
+impl MmContext {
+    pub const fn new() -> Self {
+        Self {
+            id: AtomicU64::new(0),
+            cpumask: AtomicUsize::new(0),
+        }
+    }
+
+    /// 当前 ASID
+    #[inline]
+    pub fn asid(&self) -> u64 {
+        if USE_ASID.load(Ordering::Relaxed) {
+            self.id.load(Ordering::Relaxed) & asid_mask()
+        } else {
+            0
+        }
+    }
+
+    /// 运行过此地址空间的 CPU 位图
+    #[inline]
+    pub fn cpumask(&self) -> usize {
+        self.cpumask.load(Ordering::Acquire)
+    }
+}
+
+impl Default for MmContext {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// 是否使用 ASID
+static USE_ASID: AtomicBool = AtomicBool::new(false);
+/// 硬件支持的 ASID 位数
+static ASID_BITS: AtomicUsize = AtomicUsize::new(0);
+/// 当前代数（位于 ASID 位之上）
+static CURRENT_VERSION: AtomicU64 = AtomicU64::new(0);
+/// 需要在下一次 switch_mm 时刷新本地 TLB 的 CPU (context_tlb_flush_pending)
+static FLUSH_PENDING: AtomicUsize = AtomicUsize::new(0);
+/// 每个 CPU 正在使用的 context id (active_context)
+static ACTIVE_CONTEXT: [AtomicU64; MAX_CPUS] = [const { AtomicU64::new(0) }; MAX_CPUS];
+/// ASID 分配统计：代数翻转次数
+static ROLLOVERS: AtomicUsize = AtomicUsize::new(0);
+
+/// ASID 分配器状态（受锁保护）
+struct AsidMap {
+    /// 当前代已分配的 ASID
+    bitmap: [u64; ASID_MAP_WORDS],
+    /// 下一次查找的起点
+    cur_idx: usize,
+    /// 代数翻转时各 CPU 保留的 context id (reserved_context)
+    reserved: [u64; MAX_CPUS],
+}
+
+static ASID_MAP: Mutex<AsidMap> = Mutex::new(AsidMap {
+    bitmap: [0; ASID_MAP_WORDS],
+    cur_idx: 1,
+    reserved: [0; MAX_CPUS],
+});
+
+#[inline]
+fn num_asids() -> u64 {
+    1 << ASID_BITS.load(Ordering::Relaxed)
+}
+
+#[inline]
+fn asid_mask() -> u64 {
+    num_asids() - 1
+}
+
+impl AsidMap {
+    fn test_and_set(&mut self, asid: usize) -> bool {
+        let (word, bit) = (asid / 64, asid % 64);
+        let old = self.bitmap[word] & (1 << bit) != 0;
+        self.bitmap[word] |= 1 << bit;
+        old
+    }
+
+    fn find_next_zero(&self, from: usize, limit: usize) -> Option<usize> {
+        (from..limit).find(|&asid| self.bitmap[asid / 64] & (1 << (asid % 64)) == 0)
+    }
+
+    /// 开始新的一代 (__flush_context)
+    fn flush_context(&mut self) {
+        self.bitmap.fill(0);
+        for cpu in 0..MAX_CPUS {
+            let mut cntx = ACTIVE_CONTEXT[cpu].swap(0, Ordering::Relaxed);
+            // CPU 在上一代翻转后还没有切换过地址空间，沿用它保留的 ASID
+            if cntx == 0 {
+                cntx = self.reserved[cpu];
+            }
+            if cntx != 0 {
+                self.test_and_set((cntx & asid_mask()) as usize);
+            }
+            self.reserved[cpu] = cntx;
+        }
+        // ASID 0 保留给未分配 ASID 的地址空间
+        self.test_and_set(0);
+        FLUSH_PENDING.store((1 << MAX_CPUS) - 1, Ordering::Release);
+        ROLLOVERS.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// 保留的 ASID 在新一代继续使用 (check_update_reserved_context)
+    fn update_reserved(&mut self, cntx: u64, newcntx: u64) -> bool {
+        let mut hit = false;
+        for cpu in 0..MAX_CPUS {
+            if self.reserved[cpu] == cntx {
+                hit = true;
+                self.reserved[cpu] = newcntx;
+            }
+        }
+        hit
+    }
+
+    /// 为地址空间分配当前代的 context id (__new_context)
+    fn new_context(&mut self, ctx: &MmContext) -> u64 {
+        let cntx = ctx.id.load(Ordering::Relaxed);
+        let mut ver = CURRENT_VERSION.load(Ordering::Relaxed);
+        let limit = num_asids() as usize;
+
+        if cntx != 0 {
+            let asid = cntx & asid_mask();
+            let newcntx = asid | ver;
+            // 上一代翻转时正在运行，ASID 已保留
+            if self.update_reserved(cntx, newcntx) {
+                return newcntx;
+            }
+            // 旧 ASID 在新一代中仍然空闲
+            if !self.test_and_set(asid as usize) {
+                return newcntx;
+            }
+        }
+
+        let asid = match self.find_next_zero(self.cur_idx, limit) {
+            Some(asid) => asid,
+            None => {
+                // ASID 用完：开始新的一代
+                ver = CURRENT_VERSION.fetch_add(num_asids(), Ordering::Relaxed) + num_asids();
+                self.flush_context();
+                self.find_next_zero(1, limit).unwrap_or(1)
+            }
+        };
+
+        self.test_and_set(asid);
+        self.cur_idx = asid;
+        // 新 ASID 的地址空间还没有在任何 CPU 上运行过
+        ctx.cpumask.store(0, Ordering::Release);
+        asid as u64 | ver
+    }
+}
+
+/// 检测硬件 ASID 位数并初始化分配器 (asids_init)
+///
+/// 在启动 CPU 上、开启分页后调用
+pub fn init() {
+    let bits = unsafe {
+        let old: u64;
+        asm!("csrr {}, satp", out(reg) old);
+        let probe = old | (SATP_ASID_MASK << SATP_ASID_SHIFT);
+        asm!("csrw satp, {}", in(reg) probe);
+        let readback: u64;
+        asm!("csrr {}, satp", out(reg) readback);
+        asm!("csrw satp, {}", in(reg) old);
+        asm!("sfence.vma zero, zero");
+        64 - ((readback >> SATP_ASID_SHIFT) & SATP_ASID_MASK).leading_zeros() as usize
+    };
+
+    ASID_BITS.store(bits, Ordering::Relaxed);
+    // 每个 CPU 至少需要一个正在使用和一个保留的 ASID，外加 ASID 0
+    if (1usize << bits) > 2 * MAX_CPUS {
+        CURRENT_VERSION.store(num_asids(), Ordering::Relaxed);
+        ASID_MAP.lock().test_and_set(0);
+        USE_ASID.store(true, Ordering::Release);
+        crate::println!("mm: ASID allocator using {} bits", bits);
+    } else {
+        crate::println!("mm: ASID unsupported ({} bits), flushing TLB on switch", bits);
+    }
+}
+
+/// 切换到地址空间 (switch_mm / set_mm_asid)
+///
+/// # 安全性
+/// root_ppn 必须是包含内核映射的有效根页表
+pub unsafe fn switch_mm(root_ppn: u64, ctx: &MmContext) {
+    let cpu = crate::arch::cpu_id();
+    if cpu < MAX_CPUS {
+        ctx.cpumask.fetch_or(1 << cpu, Ordering::AcqRel);
+        MM_CPUMASK.fetch_or(1 << cpu, Ordering::AcqRel);
+    }
+
+    if !USE_ASID.load(Ordering::Acquire) || cpu >= MAX_CPUS {
+        let satp = (8u64 << 60) | root_ppn;
+        asm!("csrw satp, {}", "sfence.vma zero, zero", in(reg) satp);
+        return;
+    }
+
+    let _irq = crate::arch::context::InterruptGuard::new();
+
+    // 快速路径：context id 属于当前代，且期间没有发生代数翻转
+    let cntx = ctx.id.load(Ordering::Relaxed);
+    let old_active = ACTIVE_CONTEXT[cpu].load(Ordering::Relaxed);
+    let version = CURRENT_VERSION.load(Ordering::Relaxed);
+    let fast = cntx != 0
+        && old_active != 0
+        && (cntx & !asid_mask()) == version
+        && ACTIVE_CONTEXT[cpu]
+            .compare_exchange(old_active, cntx, Ordering::Relaxed, Ordering::Relaxed)
+            .is_ok();
+
+    let (cntx, need_flush) = if fast {
+        (cntx, false)
+    } else {
+        let mut map = ASID_MAP.lock();
+        let mut cntx = ctx.id.load(Ordering::Relaxed);
+        if cntx == 0 || (cntx & !asid_mask()) != CURRENT_VERSION.load(Ordering::Relaxed) {
+            cntx = map.new_context(ctx);
+            ctx.id.store(cntx, Ordering::Relaxed);
+            ctx.cpumask.fetch_or(1 << cpu, Ordering::AcqRel);
+        }
+        let need_flush = FLUSH_PENDING.fetch_and(!(1 << cpu), Ordering::AcqRel) & (1 << cpu) != 0;
+        ACTIVE_CONTEXT[cpu].store(cntx, Ordering::Relaxed);
+        (cntx, need_flush)
+    };
+
+    let satp = (8u64 << 60) | ((cntx & asid_mask()) << SATP_ASID_SHIFT) | root_ppn;
+    asm!("csrw satp, {}", in(reg) satp);
+    if need_flush {
+        local_flush_tlb_all();
+    }
+}
+
+// ==================== 本地刷新 ====================
+
+/// 刷新本地全部 TLB
+#[inline]
+pub fn local_flush_tlb_all() {
+    unsafe { asm!("sfence.vma zero, zero") };
+}
+
+/// 刷新本地 TLB 中一个地址在所有 ASID 下的项
+#[inline]
+pub fn local_flush_tlb_page(addr: usize) {
+    unsafe { asm!("sfence.vma {}, zero", in(reg) addr) };
+}
+
+/// 刷新本地 TLB 中 [start, end) 范围在所有 ASID 下的项
+///
+/// 超过 TLB_FLUSH_ALL_THRESHOLD 页时整体刷新
+pub fn local_flush_tlb_range(start: usize, end: usize) {
+    if (end - start) / PAGE_SIZE > TLB_FLUSH_ALL_THRESHOLD {
+        local_flush_tlb_all();
+        return;
+    }
+    let mut addr = start;
+    while addr < end {
+        local_flush_tlb_page(addr);
+        addr += PAGE_SIZE;
+    }
+}
+
+/// 刷新本地 TLB 中一个 ASID 的全部项
+#[inline]
+pub fn local_flush_tlb_all_asid(asid: u64) {
+    unsafe { asm!("sfence.vma zero, {}", in(reg) asid) };
+}
+
+/// 刷新本地 TLB 中一个 ASID 下的一个地址
+#[inline]
+pub fn local_flush_tlb_page_asid(addr: usize, asid: u64) {
+    unsafe { asm!("sfence.vma {}, {}", in(reg) addr, in(reg) asid) };
+}
+
+/// 刷新本地 TLB 中 [start, end) 范围 (local_flush_tlb_range_asid)
+///
+/// 未启用 ASID 时使用不带 ASID 的 sfence.vma
+fn local_flush_tlb_range_asid(start: usize, end: usize, asid: u64) {
+    let use_asid = USE_ASID.load(Ordering::Relaxed);
+    if (end - start) / PAGE_SIZE > TLB_FLUSH_ALL_THRESHOLD {
+        if use_asid {
+            local_flush_tlb_all_asid(asid);
+        } else {
+            local_flush_tlb_all();
+        }
+        return;
+    }
+    let mut addr = start & !(PAGE_SIZE - 1);
+    while addr < end {
+        if use_asid {
+            local_flush_tlb_page_asid(addr, asid);
+        } else {
+            local_flush_tlb_page(addr);
+        }
+        addr += PAGE_SIZE;
+    }
+}
+
+// ==================== 远程刷新 ====================
+
+/// 一个远程刷新请求
+#[derive(Clone, Copy)]
+struct FlushReq {
+    asid: u64,
+    start: usize,
+    end: usize,
+}
+
+/// 目标 CPU 的刷新请求队列
+struct FlushQueue {
+    reqs: [FlushReq; FLUSH_QUEUE_LEN],
+    len: usize,
+    /// 队列溢出，处理时刷新全部 TLB
+    overflow: bool,
+    /// 已入队的请求序号
+    queued: u64,
+}
+
+static FLUSH_QUEUES: [Mutex<FlushQueue>; MAX_CPUS] = [const {
+    Mutex::new(FlushQueue {
+        reqs: [FlushReq { asid: 0, start: 0, end: 0 }; FLUSH_QUEUE_LEN],
+        len: 0,
+        overflow: false,
+        queued: 0,
+    })
+}; MAX_CPUS];
+
+/// 目标 CPU 已处理完的请求序号
+static FLUSH_DONE: [AtomicU64; MAX_CPUS] = [const { AtomicU64::new(0) }; MAX_CPUS];
+
+/// 运行过任何用户地址空间的 CPU，flush_tlb_all 的目标
+static MM_CPUMASK: AtomicUsize = AtomicUsize::new(0);
+
+/// 远程刷新统计：(发送的 IPI 数, 请求数)
+static SHOOTDOWN_IPIS: AtomicUsize = AtomicUsize::new(0);
+static SHOOTDOWN_REQS: AtomicUsize = AtomicUsize::new(0);
+
+/// 处理发给本 CPU 的刷新请求（TlbFlush IPI 处理函数）
+pub fn handle_flush_ipi() {
+    let cpu = crate::arch::cpu_id();
+    if cpu >= MAX_CPUS {
+        return;
+    }
+
+    let (reqs, len, overflow, seq) = {
+        let mut q = FLUSH_QUEUES[cpu].lock();
+        let taken = (q.reqs, q.len, q.overflow, q.queued);
+        q.len = 0;
+        q.overflow = false;
+        taken
+    };
+
+    if overflow {
+        local_flush_tlb_all();
+    } else {
+        for req in &reqs[..len] {
+            local_flush_tlb_range_asid(req.start, req.end, req.asid);
+        }
+    }
+    FLUSH_DONE[cpu].fetch_max(seq, Ordering::Release);
+}
+
+/// 刷新地址空间在所有 CPU 上的 [start, end) 范围 (flush_tlb_range)
+pub fn flush_tlb_range(ctx: &MmContext, start: usize, end: usize) {
+    if end <= start {
+        return;
+    }
+    let asid = ctx.asid();
+    let this_cpu = crate::arch::cpu_id();
+    local_flush_tlb_range_asid(start, end, asid);
+    flush_tlb_others(ctx.cpumask() & !(1 << this_cpu), Some(FlushReq { asid, start, end }));
+}
+
+/// 刷新所有 CPU 上全部地址空间的 TLB (flush_tlb_all)
+///
+/// 用于不知道页表所属地址空间的场合（页回收按物理页解除映射）
+pub fn flush_tlb_all() {
+    let this_cpu = crate::arch::cpu_id();
+    local_flush_tlb_all();
+    flush_tlb_others(MM_CPUMASK.load(Ordering::Acquire) & !(1 << this_cpu), None);
+}
+
+/// 把刷新请求发给 targets 中的 CPU 并等待完成 (flush_tlb_others)
+///
+/// req 为 None 时目标 CPU 刷新全部 TLB
+fn flush_tlb_others(targets: usize, req: Option<FlushReq>) {
+    if targets == 0 {
+        return;
+    }
+
+    let mut wait = [0u64; MAX_CPUS];
+    let mut ipi_mask = 0;
+    for cpu in 0..MAX_CPUS {
+        if targets & (1 << cpu) == 0 {
+            continue;
+        }
+        let need_ipi = {
+            let mut q = FLUSH_QUEUES[cpu].lock();
+            let was_empty = q.len == 0 && !q.overflow;
+            match req {
+                Some(req) if q.len < FLUSH_QUEUE_LEN => {
+                    let idx = q.len;
+                    q.reqs[idx] = req;
+                    q.len += 1;
+                }
+                _ => q.overflow = true,
+            }
+            q.queued += 1;
+            wait[cpu] = q.queued;
+            was_empty
+        };
+        SHOOTDOWN_REQS.fetch_add(1, Ordering::Relaxed);
+        // 队列中已有请求时 IPI 已在途，目标 CPU 会一并处理
+        if need_ipi {
+            SHOOTDOWN_IPIS.fetch_add(1, Ordering::Relaxed);
+            ipi_mask |= 1 << cpu;
+        }
+    }
+    // 所有目标合并为一次 SBI 调用
+    crate::arch::ipi::send_ipi_mask(ipi_mask, crate::arch::ipi::IpiType::TlbFlush);
+
+    for cpu in 0..MAX_CPUS {
+        if targets & (1 << cpu) == 0 {
+            continue;
+        }
+        while FLUSH_DONE[cpu].load(Ordering::Acquire) < wait[cpu] {
+            // 对方可能也在等待本 CPU
+            handle_flush_ipi();
+            crate::arch::ipi::flush_smp_call_function_queue();
+            core::hint::spin_loop();
+        }
+    }
+}
+
+/// 刷新地址空间在所有 CPU 上的一个页 (flush_tlb_page)
+#[inline]
+pub fn flush_tlb_page(ctx: &MmContext, addr: usize) {
+    let start = addr & !(PAGE_SIZE - 1);
+    flush_tlb_range(ctx, start, start + PAGE_SIZE);
+}
+
+/// 刷新地址空间在所有 CPU 上的全部项 (flush_tlb_mm)
+#[inline]
+pub fn flush_tlb_mm(ctx: &MmContext) {
+    flush_tlb_range(ctx, 0, usize::MAX & !(PAGE_SIZE - 1));
+}
+
+/// TLB 统计
+#[derive(Debug, Clone, Copy)]
+pub struct TlbStats {
+    /// ASID 位数（0 表示未启用）
+    pub asid_bits: usize,
+    /// 代数翻转次数
+    pub rollovers: usize,
+    /// 发送的 shootdown IPI 数
+    pub shootdown_ipis: usize,
+    /// 远程刷新请求数
+    pub shootdown_reqs: usize,
+}
+
+pub fn tlb_stats() -> TlbStats {
+    TlbStats {
+        asid_bits: if USE_ASID.load(Ordering::Relaxed) { ASID_BITS.load(Ordering::Relaxed) } else { 0 },
+        rollovers: ROLLOVERS.load(Ordering::Relaxed),
+        shootdown_ipis: SHOOTDOWN_IPIS.load(Ordering::Relaxed),
+        shootdown_reqs: SHOOTDOWN_REQS.load(Ordering::Relaxed),
+    }
+}
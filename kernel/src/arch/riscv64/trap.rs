@@ -64,6 +64,32 @@ pub struct TrapFrame {
     pub stval: u64,    // frame+240 = sp+256
 }
 
+impl TrapFrame {
+    /// 进入 trap 前的 sp（TrapFrame 之前 8 字节处）
+    #[inline]
+    pub fn orig_sp(&self) -> u64 {
+        unsafe { *((self as *const Self as *const u64).sub(1)) }
+    }
+
+    /// 设置返回时恢复的 sp
+    #[inline]
+    pub fn set_orig_sp(&mut self, sp: u64) {
+        unsafe { *((self as *mut Self as *mut u64).sub(1)) = sp };
+    }
+
+    /// 用户 tp（TrapFrame 之前 16 字节处，从内核进入时为 0）
+    #[inline]
+    pub fn user_tp(&self) -> u64 {
+        unsafe { *((self as *const Self as *const u64).sub(2)) }
+    }
+
+    /// 设置返回用户模式时恢复的 tp
+    #[inline]
+    pub fn set_user_tp(&mut self, tp: u64) {
+        unsafe { *((self as *mut Self as *mut u64).sub(2)) = tp };
+    }
+}
+
 #[derive(Debug, Clone, Copy)]
 pub enum ExceptionCause {
     InstructionAddressMisaligned,
@@ -142,19 +168,19 @@ pub fn init() {
         let _stvec: u64;
         asm!("csrr {}, stvec", out(reg) _stvec);
 
-        // 初始化 sscratch 为 hart_id + 1
+        // 初始化 sscratch 为内核 tp + 1
         // 这对于 trap.S 正确处理第一个用户态 trap 至关重要
-        // trap.S 期望 sscratch = hart_id + 1，这样：
-        //   csrrw tp, sscratch, tp  交换后 tp = hart_id + 1
-        //   addi tp, tp, -1         tp = hart_id
-        // 注意：+1 是为了避免 hart_id = 0 时的歧义（0 也可能是未初始化）
-        let hart_id: u64;
+        // trap.S 期望 sscratch = tp + 1，这样：
+        //   csrrw tp, sscratch, tp  交换后 tp = 内核 tp + 1
+        //   addi tp, tp, -1         tp = 本 CPU 的每 CPU 数据区
+        // 注意：+1 保证 sscratch 非零（0 表示在内核态）
+        let kernel_tp: u64;
         asm!(
             "mv {}, tp",
-            out(reg) hart_id,
+            out(reg) kernel_tp,
             options(nomem, nostack, pure)
         );
-        let sscratch_value = hart_id + 1;
+        let sscratch_value = kernel_tp + 1;
 
         asm!(
             "csrw sscratch, {}",
@@ -162,6 +188,9 @@ pub fn init() {
             options(nomem, nostack)
         )
     }
+
+    // vDSO 在用户模式读取 time CSR
+    super::vdso::enable_user_time();
 }
 
 pub fn init_syscall() {
@@ -175,7 +204,7 @@ pub fn enable_timer_interrupt() {
         // 2^5 = 0x20 = 32
         asm!(
             "li t0, 32",           // 加载 STIE 位的值 (2^5)
-            "csrw sie, t0",         // 设置 sie 寄存器
+            "csrs sie, t0",         // 置位 sie 寄存器，保留其他中断的使能位
             options(nomem, nostack)
         );
 
@@ -204,7 +233,7 @@ pub fn enable_external_interrupt() {
         // 2^9 = 0x200 = 512 (注意: csrsi 只支持 5-bit 立即数，需要用 li 加载)
         asm!(
             "li t0, 512",          // 加载 SEIE 位的值 (2^9)
-            "csrw sie, t0",         // 设置 sie 寄存器
+            "csrs sie, t0",         // 置位 sie 寄存器，保留其他中断的使能位
             options(nomem, nostack)
         );
 
@@ -220,6 +249,20 @@ pub fn enable_external_interrupt() {
     }
 }
 
+/// 内核访问用户内存出错：跳到异常表登记的修复代码 (fixup_exception)
+///
+/// # 返回
+/// 出错指令不在异常表中时返回 false
+unsafe fn fixup_exception(frame: *mut TrapFrame) -> bool {
+    match crate::arch::riscv64::uaccess::search_exception_table((*frame).sepc as usize) {
+        Some(fixup) => {
+            (*frame).sepc = fixup as u64;
+            true
+        }
+        None => false,
+    }
+}
+
 /// 当前 CPU 的 TrapFrame 指针（用于 fork）
 /// 在 trap 入口时设置，在 trap 出口时清除
 static CURRENT_TRAP_FRAME: core::sync::atomic::AtomicU64 = core::sync::atomic::AtomicU64::new(0);
@@ -246,6 +289,16 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
 
         let exception = ExceptionCause::from_scause(scause);
 
+        // 记录用户改过的浮点寄存器，内核关闭浮点运行
+        if (*frame).sstatus & 0x100 == 0 {
+            crate::arch::riscv64::fpu::fpu_trap_entry(frame);
+        }
+
+        if matches!(exception, ExceptionCause::InstructionPageFault | ExceptionCause::LoadPageFault | ExceptionCause::StorePageFault) {
+            crate::trace_record!(TRACE_PAGE_FAULT, stval, (*frame).sepc,
+                                 scause | ((((*frame).sstatus & 0x100 == 0) as u64) << 63));
+        }
+
         // 调试输出（可选）
         // if !matches!(exception, ExceptionCause::SupervisorTimerInterrupt) {
         //     crate::println!("TRAP: {:?} sepc={:#x} stval={:#x}", exception, (*frame).sepc, stval);
@@ -255,30 +308,53 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
             ExceptionCause::SupervisorTimerInterrupt => {
                 // Timer interrupt - 时钟中断处理
                 //
-                // 1. tick_sched_timer() - 更新 jiffies
+                // 1. tick_sched_timer() - 更新 jiffies，标记到期的定时器
                 // 2. scheduler_tick() - 更新时间片，设置 need_resched
-                // 3. schedule() - 如果 need_resched，触发调度
+                // 3. irq_exit() - 执行定时器软中断
+                // 4. 中断返回前的抢占点 - 如果 need_resched，触发调度
+
+                // 1. 调用时钟中断处理函数；只为 hrtimer 编程的中断不是 tick
+                let tick = crate::drivers::timer::timer_interrupt_handler();
+
+                if tick {
+                    // 2. 按被打断的特权级记账 CPU 时间 (SPP: 0 = U-mode)，
+                    //    调度器 tick - 更新进程时间片，检查是否需要重新调度
+                    #[cfg(feature = "riscv64")]
+                    {
+                        crate::sched::account_process_tick((*frame).sstatus & 0x100 == 0);
+                        crate::sched::scheduler_tick();
+                    }
 
-                // 1. 调用时钟中断处理函数（更新 jiffies 等）
-                crate::drivers::timer::timer_interrupt_handler();
+                    // 采样被打断的上下文 (profile_tick)
+                    if crate::profile::enabled() {
+                        let pid = crate::sched::current().map(|task| task.pid()).unwrap_or(0);
+                        crate::profile::profile_tick(frame, pid);
+                    }
 
-                // 2. 调度器 tick - 更新进程时间片，检查是否需要重新调度
-                #[cfg(feature = "riscv64")]
-                crate::sched::scheduler_tick();
+                    // 输出异步写入的日志 (printk)
+                    crate::printk::printk_tick();
 
-                // 3. 设置下一次定时器中断
-                crate::drivers::timer::set_next_trigger();
+                    // 周期性调整 Per-CPU 页缓存水位
+                    crate::mm::pcp::pcp_tick();
+
+                    // TCP 重传、延迟 ACK 与 TIME_WAIT 定时器
+                    crate::net::tcp_timer::tcp_timer_tick();
 
-                // 4. 如果设置了 need_resched 标志，触发进程调度
-                #[cfg(feature = "riscv64")]
-                if crate::sched::need_resched() {
-                    crate::sched::schedule();
+                    // ARP 请求重发与邻居缓存老化
+                    crate::net::arp::arp_timer_tick();
                 }
+
+                // 3. 执行到期的定时器，再按最早的定时器设置下一次中断
+                crate::softirq::irq_exit();
+                crate::drivers::timer::set_next_trigger();
             }
             ExceptionCause::SupervisorSoftwareInterrupt => {
                 // 软件中断（用于 IPI）
                 let hart_id = crate::arch::riscv64::smp::cpu_id();
 
+                // tick 停止期间补上 jiffies，NO_HZ full 被通知时恢复 tick
+                crate::time::tick::tick_irq_enter();
+
                 // 清除软件中断
                 unsafe {
                     // 清除 sip.SSIP 位
@@ -289,41 +365,25 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
                 crate::arch::ipi::handle_software_ipi(hart_id as usize);
             }
             ExceptionCause::SupervisorExternalInterrupt => {
-                // 外部中断 - 由 PLIC 处理
+                // 外部中断 - 由 PLIC 与 IMSIC 处理
                 let hart_id = crate::arch::riscv64::smp::cpu_id();
+                crate::time::tick::tick_irq_enter();
 
-                // Claim 中断（获取最高优先级的待处理中断 ID）
+                // Claim 中断（获取最高优先级的待处理中断 ID），按描述符分发 (generic_handle_irq)
+                // QEMU RISC-V virt: IRQ 1-8 为 VirtIO MMIO 槽位 0-7，10 为 UART，
+                // 32+ 为 PCI INTx；IPI 走 SBI 软件中断，不经过 PLIC
                 if let Some(irq) = crate::drivers::intc::plic::claim(hart_id as usize) {
-                    match irq {
-                        1..=8 => {
-                            // VirtIO MMIO 设备中断（VirtIO slot 0-7）
-                            // QEMU RISC-V virt: IRQ 1-8 对应 VirtIO 设备槽位 0-7
-                            crate::drivers::virtio::interrupt_handler();
-                        }
-                        32..=127 => {
-                            // VirtIO PCI 设备中断
-                            // QEMU RISC-V virt: IRQ 32+ 对应 PCI 设备
-                            // IRQ = 32 + (PCI slot * 4) + (INT_PIN - 1)
-                            crate::println!("trap: PCI VirtIO interrupt detected (IRQ {})", irq);
-                            crate::drivers::virtio::interrupt_handler_pci(irq as usize);
-                        }
-                        10 => {
-                            // UART 中断（ns16550a）- QEMU RISC-V virt 使用 IRQ 10
-                            // TODO: 实现 UART 输入处理
-                            // crate::println!("IRQ: UART interrupt (IRQ 10)");
-                        }
-                        11..=13 => {
-                            // IPI 中断（核间中断）
-                            crate::arch::ipi::handle_ipi(irq, hart_id as usize);
-                        }
-                        _ => {
-                            // 未知中断 - 静默忽略
-                        }
-                    }
+                    crate::irq::handle_irq(irq);
 
                     // Complete 中断（通知 PLIC 处理完成）
                     crate::drivers::intc::plic::complete(hart_id as usize, irq);
                 }
+
+                // PCI 设备的 MSI 直接投递到本 hart 的 IMSIC 中断文件
+                crate::drivers::intc::imsic::handle_pending();
+
+                // 执行硬中断标记的下半部
+                crate::softirq::irq_exit();
             }
             ExceptionCause::EnvironmentCallFromMMode => {
                 // Machine-mode ecall - 不应该发生
@@ -381,19 +441,18 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
                 crate::arch::riscv64::syscall::syscall_handler(&mut syscall_frame);
 
                 // 将结果写回 TrapFrame
+                // 只写回 a0：rt_sigreturn 直接恢复 TrapFrame 中的其他寄存器
                 (*frame).a0 = syscall_frame.a0;
-                (*frame).a1 = syscall_frame.a1;
-                (*frame).a2 = syscall_frame.a2;
-                (*frame).a3 = syscall_frame.a3;
-                (*frame).a4 = syscall_frame.a4;
-                (*frame).a5 = syscall_frame.a5;
 
                 // 跳过 ecall 指令
                 (*frame).sepc += 4;
             }
             ExceptionCause::IllegalInstruction => {
-                // 静默处理非法指令
-                (*frame).sepc += 4; // 跳过错误指令
+                // FS 关闭时第一次使用浮点：装载浮点状态后重新执行该指令
+                if !crate::arch::riscv64::fpu::fpu_first_use(frame) {
+                    // 静默处理非法指令
+                    (*frame).sepc += 4; // 跳过错误指令
+                }
             }
             ExceptionCause::Breakpoint => {
                 // SPP bit (8): 0 = from U-mode, 1 = from S-mode
@@ -419,15 +478,20 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
                 (*frame).sepc += 4; // 跳过错误指令
             }
             ExceptionCause::LoadAccessFault => {
-                // 静默处理加载访问错误
-                (*frame).sepc += 4; // 跳过错误指令
+                // 静默处理加载访问错误；用户内存复制中出错时跳到修复代码
+                let is_user = (*frame).sstatus & 0x100 == 0;
+                if is_user || !fixup_exception(frame) {
+                    (*frame).sepc += 4; // 跳过错误指令
+                }
             }
             ExceptionCause::StoreAMOAccessFault => {
                 // SPP bit (8): 0 = from U-mode, 1 = from S-mode
                 let is_user = (*frame).sstatus & 0x100 == 0;
-                crate::println!("trap: Store/AMO access fault at sepc={:#x}, addr={:#x} ({}mode)",
-                    (*frame).sepc, stval, if is_user { "user " } else { "kernel " });
-                (*frame).sepc += 4; // 跳过错误指令
+                if is_user || !fixup_exception(frame) {
+                    crate::println!("trap: Store/AMO access fault at sepc={:#x}, addr={:#x} ({}mode)",
+                        (*frame).sepc, stval, if is_user { "user " } else { "kernel " });
+                    (*frame).sepc += 4; // 跳过错误指令
+                }
             }
             ExceptionCause::InstructionPageFault => {
                 // SPP bit (8): 0 = from U-mode, 1 = from S-mode
@@ -447,6 +511,7 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
                             match handle_mm_fault(&addr_space, fault_addr, flags) {
                                 MmFaultResult::Handled => {
                                     // 页面已映射，重新执行指令
+                                    current.account_fault();
                                     return;
                                 }
                                 MmFaultResult::CowPending => {
@@ -462,7 +527,9 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
                                     crate::println!("trap: Permission denied at {:#x} (exec)", stval);
                                 }
                                 MmFaultResult::OutOfMemory => {
-                                    crate::println!("trap: Out of memory at {:#x} (exec)", stval);
+                                    // 杀死一个进程后重新执行指令 (pagefault_out_of_memory)
+                                    crate::mm::oom_kill::pagefault_out_of_memory();
+                                    return;
                                 }
                             }
                         }
@@ -475,8 +542,10 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
             ExceptionCause::LoadPageFault => {
                 // SPP bit (8): 0 = from U-mode, 1 = from S-mode
                 let is_user = (*frame).sstatus & 0x100 == 0;
+                // 内核通过 SUM 访问尚未建立映射的用户页（如 read 写入新 mmap 的缓冲区）
+                let is_uaccess = !is_user && (stval as usize) < crate::arch::riscv64::mm::user_addr::USER_END;
 
-                if is_user {
+                if is_user || is_uaccess {
                     if let Some(current) = crate::sched::current() {
                         if let Some(addr_space) = current.address_space() {
                             use crate::arch::riscv64::mm::{
@@ -490,6 +559,7 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
                             match handle_mm_fault(&addr_space, fault_addr, flags) {
                                 MmFaultResult::Handled => {
                                     // 页面已映射，重新执行指令
+                                    current.account_fault();
                                     return;
                                 }
                                 MmFaultResult::AlreadyMapped => {
@@ -501,6 +571,11 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
                                 MmFaultResult::PermissionDenied => {
                                     crate::println!("trap: Permission denied at {:#x} (read)", stval);
                                 }
+                                MmFaultResult::OutOfMemory if is_user => {
+                                    // 杀死一个进程后重新执行指令 (pagefault_out_of_memory)
+                                    crate::mm::oom_kill::pagefault_out_of_memory();
+                                    return;
+                                }
                                 MmFaultResult::OutOfMemory => {
                                     crate::println!("trap: Out of memory at {:#x} (read)", stval);
                                 }
@@ -512,14 +587,23 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
                     }
                 }
 
-                // 无法处理，跳过指令
-                (*frame).sepc += 4;
+                // 访问内核栈保护页：内核栈溢出，无法继续
+                if !is_user && crate::process::kstack::is_guard_page(stval as usize) {
+                    panic!("kernel stack overflow: read {:#x}, sepc={:#x}", stval, (*frame).sepc);
+                }
+
+                // 无法处理：用户内存复制中出错时跳到修复代码，否则跳过指令
+                if is_user || !fixup_exception(frame) {
+                    (*frame).sepc += 4;
+                }
             }
             ExceptionCause::StorePageFault => {
                 // SPP bit (8): 0 = from U-mode, 1 = from S-mode
                 let is_user = (*frame).sstatus & 0x100 == 0;
+                // 内核通过 SUM 写入尚未建立映射的用户页
+                let is_uaccess = !is_user && (stval as usize) < crate::arch::riscv64::mm::user_addr::USER_END;
 
-                if is_user {
+                if is_user || is_uaccess {
                     if let Some(current) = crate::sched::current() {
                         if let Some(addr_space) = current.address_space() {
                             use crate::arch::riscv64::mm::{
@@ -534,13 +618,15 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
                             match handle_mm_fault(&addr_space, fault_addr, flags) {
                                 MmFaultResult::Handled => {
                                     // 页面已映射，重新执行指令
+                                    current.account_fault();
                                     return;
                                 }
                                 MmFaultResult::CowPending => {
                                     // COW 页面，尝试写时复制
-                                    match handle_cow_fault(addr_space.root_ppn(), fault_addr) {
+                                    match handle_cow_fault(&addr_space, fault_addr) {
                                         Some(()) => {
                                             // COW 成功，重新执行指令
+                                            current.account_fault();
                                             return;
                                         }
                                         None => {
@@ -558,6 +644,11 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
                                 MmFaultResult::PermissionDenied => {
                                     crate::println!("trap: Permission denied at {:#x} (write)", stval);
                                 }
+                                MmFaultResult::OutOfMemory if is_user => {
+                                    // 杀死一个进程后重新执行指令 (pagefault_out_of_memory)
+                                    crate::mm::oom_kill::pagefault_out_of_memory();
+                                    return;
+                                }
                                 MmFaultResult::OutOfMemory => {
                                     crate::println!("trap: Out of memory at {:#x} (write)", stval);
                                 }
@@ -566,15 +657,24 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
                     }
 
                     // 终止进程而不是跳过指令
-                    crate::println!("trap: Terminating process due to unhandled page fault");
-                    if let Some(current) = crate::sched::current() {
-                        current.set_state(crate::process::task::TaskState::Zombie);
-                        crate::sched::schedule();
+                    if is_user {
+                        crate::println!("trap: Terminating process due to unhandled page fault");
+                        if let Some(current) = crate::sched::current() {
+                            current.set_state(crate::process::task::TaskState::Zombie);
+                            crate::sched::schedule();
+                        }
                     }
                 }
 
-                // 无法处理，跳过指令
-                (*frame).sepc += 4;
+                // 访问内核栈保护页：内核栈溢出，无法继续
+                if !is_user && crate::process::kstack::is_guard_page(stval as usize) {
+                    panic!("kernel stack overflow: write {:#x}, sepc={:#x}", stval, (*frame).sepc);
+                }
+
+                // 无法处理：用户内存复制中出错时跳到修复代码，否则跳过指令
+                if is_user || !fixup_exception(frame) {
+                    (*frame).sepc += 4;
+                }
             }
             _ => {
                 crate::println!("trap: Unknown exception: scause={:#x}, sepc={:#x}, stval={:#x}",
@@ -582,6 +682,30 @@ pub extern "C" fn trap_handler(frame: *mut TrapFrame) {
             }
         }
 
+        // 中断返回前的抢占点 (irqentry_exit)：
+        // 返回用户态时总是可以调度；返回内核态时只在被打断的代码允许抢占时调度
+        // (preempt_count 为 0)。打断了开中断的软中断时不调度，回到软中断后由外层返回路径处理
+        #[cfg(feature = "riscv64")]
+        if matches!(exception,
+                ExceptionCause::SupervisorTimerInterrupt
+                | ExceptionCause::SupervisorSoftwareInterrupt
+                | ExceptionCause::SupervisorExternalInterrupt)
+            && crate::sched::need_resched()
+            && !crate::softirq::in_softirq()
+        {
+            if (*frame).sstatus & 0x100 == 0 {
+                crate::sched::schedule();
+            } else {
+                crate::sched::preempt_schedule_irq();
+            }
+        }
+
+        // 返回用户模式前递送信号
+        if (*frame).sstatus & 0x100 == 0 {
+            crate::signal::exit_to_user_mode(frame);
+            crate::arch::riscv64::fpu::fpu_exit_to_user(frame);
+        }
+
         // 清除当前 TrapFrame 指针
         CURRENT_TRAP_FRAME.store(0, core::sync::atomic::Ordering::Relaxed);
     }
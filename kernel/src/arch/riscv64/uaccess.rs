@@ -0,0 +1,131 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 用户内存访问 (asm/uaccess.h)
+//!
+//! copy_from_user / copy_to_user / strncpy_from_user 由 uaccess.S 实现，
+//! 按字复制并在复制期间打开 sstatus.SUM。调用前只检查地址范围 (access_ok)，
+//! 不遍历页表：访问用户内存的指令登记在异常表中，缺页无法处理时
+//! trap 处理跳到修复代码 (fixup_exception)，函数返回错误
+
+extern crate alloc;
+
+use alloc::vec;
+use alloc::vec::Vec;
+use core::mem::{size_of, MaybeUninit};
+
+core::arch::global_asm!(include_str!("uaccess.S"));
+
+const EFAULT: i32 = -14;
+const EINVAL: i32 = -22;
+
+/// 用户地址空间的上界
+pub const USER_SPACE_END: usize = 0x0000_ffff_ffff_ffff;
+
+/// 异常表项：可能出错的指令地址与修复代码地址 (struct exception_table_entry)
+#[repr(C)]
+struct ExceptionTableEntry {
+    insn: usize,
+    fixup: usize,
+}
+
+extern "C" {
+    static __start___ex_table: ExceptionTableEntry;
+    static __stop___ex_table: ExceptionTableEntry;
+
+    fn __asm_copy_to_user(to: *mut u8, from: *const u8, n: usize) -> usize;
+    fn __asm_copy_from_user(to: *mut u8, from: *const u8, n: usize) -> usize;
+    fn __asm_strncpy_from_user(dst: *mut u8, src: *const u8, count: usize) -> isize;
+}
+
+/// 查找出错指令的修复地址 (search_exception_tables)
+///
+/// 表项只由 uaccess.S 产生，数量很少，只在缺页无法处理时查找，线性扫描即可
+pub fn search_exception_table(addr: usize) -> Option<usize> {
+    let table = unsafe {
+        let start = core::ptr::addr_of!(__start___ex_table);
+        let stop = core::ptr::addr_of!(__stop___ex_table);
+        core::slice::from_raw_parts(start, stop.offset_from(start) as usize)
+    };
+    table.iter().find(|entry| entry.insn == addr).map(|entry| entry.fixup)
+}
+
+/// 检查 [addr, addr + size) 是否在用户地址空间内 (access_ok)
+#[inline]
+pub fn access_ok(addr: usize, size: usize) -> bool {
+    addr.checked_add(size).map_or(false, |end| end <= USER_SPACE_END)
+}
+
+/// 从用户地址 from 复制 to.len() 字节 (copy_from_user)
+///
+/// # 返回
+/// 未复制的字节数，0 表示全部复制
+pub fn copy_from_user(to: &mut [u8], from: usize) -> usize {
+    if !access_ok(from, to.len()) {
+        return to.len();
+    }
+    unsafe { __asm_copy_from_user(to.as_mut_ptr(), from as *const u8, to.len()) }
+}
+
+/// 把 from 复制到用户地址 to (copy_to_user)
+///
+/// # 返回
+/// 未复制的字节数，0 表示全部复制
+pub fn copy_to_user(to: usize, from: &[u8]) -> usize {
+    if !access_ok(to, from.len()) {
+        return from.len();
+    }
+    unsafe { __asm_copy_to_user(to as *mut u8, from.as_ptr(), from.len()) }
+}
+
+/// 复制以 NUL 结尾的用户字符串到 dst (strncpy_from_user)
+///
+/// # 返回
+/// 字符串长度（不含 NUL，dst 中也不保证有 NUL）；dst 装满仍没有 NUL 时返回 dst.len()；
+/// 地址无效返回 EFAULT
+pub fn strncpy_from_user(dst: &mut [u8], src: usize) -> Result<usize, i32> {
+    if src >= USER_SPACE_END {
+        return Err(EFAULT);
+    }
+    // 不读取用户地址空间之外的字节
+    let count = dst.len().min(USER_SPACE_END - src);
+    match unsafe { __asm_strncpy_from_user(dst.as_mut_ptr(), src as *const u8, count) } {
+        n if n < 0 => Err(n as i32),
+        n => Ok(n as usize),
+    }
+}
+
+/// 复制不超过 max 字节（含 NUL）的用户字符串 (strndup_user)
+///
+/// # 返回
+/// 不含 NUL 的字符串；max 字节内没有 NUL 返回 EINVAL，地址无效返回 EFAULT
+pub fn strndup_user(src: usize, max: usize) -> Result<Vec<u8>, i32> {
+    let mut buf = vec![0u8; max];
+    let len = strncpy_from_user(&mut buf, src)?;
+    if len == max {
+        return Err(EINVAL);
+    }
+    buf.truncate(len);
+    Ok(buf)
+}
+
+/// 读取用户地址上的一个值 (get_user)
+pub fn get_user<T: Copy>(addr: usize) -> Result<T, i32> {
+    let mut value = MaybeUninit::<T>::uninit();
+    let bytes = unsafe { core::slice::from_raw_parts_mut(value.as_mut_ptr() as *mut u8, size_of::<T>()) };
+    if copy_from_user(bytes, addr) != 0 {
+        return Err(EFAULT);
+    }
+    Ok(unsafe { value.assume_init() })
+}
+
+/// 把一个值写到用户地址 (put_user)
+pub fn put_user<T: Copy>(addr: usize, value: &T) -> Result<(), i32> {
+    let bytes = unsafe { core::slice::from_raw_parts(value as *const T as *const u8, size_of::<T>()) };
+    if copy_to_user(addr, bytes) != 0 {
+        return Err(EFAULT);
+    }
+    Ok(())
+}
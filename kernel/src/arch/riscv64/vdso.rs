@@ -0,0 +1,410 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! vDSO 与 vvar 时间数据页
+//!
+//! vDSO 是内核映射到每个用户地址空间的一个小型 ELF 共享对象，导出
+//! `__vdso_clock_gettime`、`__vdso_gettimeofday` 和信号返回跳板
+//! `__vdso_rt_sigreturn`（版本 LINUX_4.15，与 Linux riscv 相同）。
+//! 用户程序直接在用户模式读取 time CSR 并换算，不再陷入内核。
+//!
+//! 布局（两页，内核镜像中的静态页，所有进程共享同一份物理页）：
+//! - vvar 页：VdsoData，由 tick_do_timer_cpu 的时钟中断按 seqlock 更新
+//! - vDSO 页：启动时在页内生成 ELF 头、动态段、符号表和符号版本，
+//!   再把 vdso.S 中与位置无关的代码复制到 VDSO_CODE_OFFSET
+//!
+//! execve 把两页映射到 VDSO_BASE，并通过 auxv 的 AT_SYSINFO_EHDR 告诉
+//! libc vDSO 的位置。页表项带 SPECIAL 标志，fork 时直接共享。
+//!
+//! 参考: arch/riscv/kernel/vdso.c, kernel/time/vsyscall.c,
+//!       include/vdso/datapage.h
+
+use core::cell::UnsafeCell;
+use core::sync::atomic::{fence, AtomicU32, AtomicU64, Ordering};
+
+use crate::drivers::timer::{read_time, CLOCK_FREQ};
+use crate::time::{cycles_to_ns, NSEC_PER_SEC};
+
+core::arch::global_asm!(include_str!("vdso.S"));
+
+extern "C" {
+    fn vdso_code_start();
+    fn vdso_code_end();
+    fn vdso_clock_gettime();
+    fn vdso_gettimeofday();
+    fn vdso_rt_sigreturn();
+}
+
+const PAGE_SIZE: usize = 4096;
+
+/// vvar 页的用户虚拟地址，vDSO 页紧随其后
+pub const VDSO_DATA_BASE: u64 = 0x3f_f000_0000;
+/// vDSO ELF 映像的用户虚拟地址 (AT_SYSINFO_EHDR)
+pub const VDSO_BASE: u64 = VDSO_DATA_BASE + PAGE_SIZE as u64;
+
+/// 代码在 vDSO 页内的偏移，之前是 ELF 头和动态段
+pub const VDSO_CODE_OFFSET: usize = 0x400;
+
+/// 时钟模式 (vdso_clock_mode)
+pub const VDSO_CLOCKMODE_NONE: u32 = 0;
+pub const VDSO_CLOCKMODE_ARCHTIMER: u32 = 1;
+
+/// vvar 页中的时间数据 (struct vdso_data)
+///
+/// 字段偏移被 vdso.S 直接使用，修改时两边同步
+#[repr(C)]
+pub struct VdsoData {
+    /// seqlock 序号，奇数表示正在更新
+    seq: AtomicU32,
+    /// VDSO_CLOCKMODE_*，NONE 时用户代码回退到系统调用
+    clock_mode: AtomicU32,
+    /// time CSR 频率
+    freq: AtomicU64,
+    /// 上一个 tick 的单调时间，供 *_COARSE 时钟使用
+    coarse_sec: AtomicU64,
+    coarse_nsec: AtomicU64,
+}
+
+#[repr(C, align(4096))]
+struct VdsoPages {
+    data: VdsoData,
+    _pad: [u8; PAGE_SIZE - core::mem::size_of::<VdsoData>()],
+    image: UnsafeCell<[u8; PAGE_SIZE]>,
+}
+
+// image 只在启动时写入一次，之后只读
+unsafe impl Sync for VdsoPages {}
+
+static VDSO_PAGES: VdsoPages = VdsoPages {
+    data: VdsoData {
+        seq: AtomicU32::new(0),
+        clock_mode: AtomicU32::new(VDSO_CLOCKMODE_NONE),
+        freq: AtomicU64::new(CLOCK_FREQ),
+        coarse_sec: AtomicU64::new(0),
+        coarse_nsec: AtomicU64::new(0),
+    },
+    _pad: [0; PAGE_SIZE - core::mem::size_of::<VdsoData>()],
+    image: UnsafeCell::new([0; PAGE_SIZE]),
+};
+
+/// vvar 页的物理地址（内核恒等映射）
+#[inline]
+fn data_page() -> usize {
+    &VDSO_PAGES.data as *const VdsoData as usize
+}
+
+/// vDSO 页的物理地址
+#[inline]
+pub fn image_page() -> usize {
+    VDSO_PAGES.image.get() as usize
+}
+
+/// vDSO ELF 映像，init 之后内容不再变化
+pub fn vdso_image() -> &'static [u8] {
+    unsafe { &*VDSO_PAGES.image.get() }
+}
+
+// ==================== ELF 映像 ====================
+
+const ET_DYN: u16 = 3;
+const EM_RISCV: u16 = 243;
+/// EF_RISCV_RVC | EF_RISCV_FLOAT_ABI_DOUBLE
+const EF_RISCV: u32 = 0x5;
+const PT_LOAD: u32 = 1;
+const PT_DYNAMIC: u32 = 2;
+const PF_X: u32 = 1;
+const PF_R: u32 = 4;
+const DT_NULL: u64 = 0;
+const DT_HASH: u64 = 4;
+const DT_STRTAB: u64 = 5;
+const DT_SYMTAB: u64 = 6;
+const DT_STRSZ: u64 = 10;
+const DT_SYMENT: u64 = 11;
+const DT_SONAME: u64 = 14;
+const DT_VERSYM: u64 = 0x6fff_fff0;
+const DT_VERDEF: u64 = 0x6fff_fffc;
+const DT_VERDEFNUM: u64 = 0x6fff_fffd;
+/// STB_GLOBAL << 4 | STT_FUNC
+const SYM_GLOBAL_FUNC: u8 = 0x12;
+const VER_FLG_BASE: u16 = 1;
+
+/// vDSO 的 soname 与符号版本
+pub const VDSO_SONAME: &str = "linux-vdso.so.1";
+pub const VDSO_VERSION: &str = "LINUX_4.15";
+
+/// 导出的符号
+pub const VDSO_SYMBOLS: [&str; 3] = ["__vdso_clock_gettime", "__vdso_gettimeofday", "__vdso_rt_sigreturn"];
+
+/// ELF 符号哈希 (elf_hash)
+pub fn elf_hash(name: &str) -> u32 {
+    let mut h: u32 = 0;
+    for &c in name.as_bytes() {
+        h = (h << 4).wrapping_add(c as u32);
+        let g = h & 0xf000_0000;
+        if g != 0 {
+            h ^= g >> 24;
+        }
+        h &= !g;
+    }
+    h
+}
+
+/// 按顺序写入小端数据
+struct ImageWriter<'a> {
+    buf: &'a mut [u8],
+    pos: usize,
+}
+
+impl<'a> ImageWriter<'a> {
+    fn put(&mut self, bytes: &[u8]) {
+        self.buf[self.pos..self.pos + bytes.len()].copy_from_slice(bytes);
+        self.pos += bytes.len();
+    }
+    fn put_u8(&mut self, v: u8) { self.put(&[v]); }
+    fn put_u16(&mut self, v: u16) { self.put(&v.to_le_bytes()); }
+    fn put_u32(&mut self, v: u32) { self.put(&v.to_le_bytes()); }
+    fn put_u64(&mut self, v: u64) { self.put(&v.to_le_bytes()); }
+    fn align(&mut self, align: usize) {
+        self.pos = (self.pos + align - 1) & !(align - 1);
+    }
+}
+
+/// 在 buf 中生成 vDSO ELF 映像 (vdso_init 的构建期部分)
+///
+/// 代码位于 VDSO_CODE_OFFSET，由调用方复制；`sym_offsets` 是各导出符号
+/// 相对代码起点的偏移，与 VDSO_SYMBOLS 一一对应
+pub fn build_vdso_image(buf: &mut [u8; PAGE_SIZE], sym_offsets: [usize; VDSO_SYMBOLS.len()]) {
+    const EHDR_SIZE: usize = 64;
+    const PHDR_SIZE: usize = 56;
+    const NR_PHDR: usize = 2;
+    const NR_DYN: usize = 10;
+    const NR_SYMS: usize = 1 + VDSO_SYMBOLS.len();
+
+    // 字符串表：空串、soname、版本、符号名
+    let mut strtab = [0u8; 128];
+    let mut strsz = 1;
+    let mut add_str = |s: &str| {
+        let off = strsz;
+        strtab[off..off + s.len()].copy_from_slice(s.as_bytes());
+        strsz += s.len() + 1;
+        off as u32
+    };
+    let soname = add_str(VDSO_SONAME);
+    let version = add_str(VDSO_VERSION);
+    let names = VDSO_SYMBOLS.map(|name| add_str(name));
+
+    let dyn_off = EHDR_SIZE + PHDR_SIZE * NR_PHDR;
+    let hash_off = dyn_off + 16 * NR_DYN;
+    let sym_off = (hash_off + 4 * (2 + 1 + NR_SYMS) + 7) & !7;
+    let versym_off = sym_off + 24 * NR_SYMS;
+    let verdef_off = (versym_off + 2 * NR_SYMS + 3) & !3;
+    let str_off = verdef_off + 2 * 28;
+    assert!(str_off + strsz <= VDSO_CODE_OFFSET);
+
+    buf.fill(0);
+    let mut w = ImageWriter { buf: &mut buf[..], pos: 0 };
+
+    // Elf64_Ehdr
+    w.put(&[0x7f, b'E', b'L', b'F', 2, 1, 1, 0]);
+    w.put(&[0; 8]);
+    w.put_u16(ET_DYN);
+    w.put_u16(EM_RISCV);
+    w.put_u32(1);
+    w.put_u64(0);
+    w.put_u64(EHDR_SIZE as u64);
+    w.put_u64(0);
+    w.put_u32(EF_RISCV);
+    w.put_u16(EHDR_SIZE as u16);
+    w.put_u16(PHDR_SIZE as u16);
+    w.put_u16(NR_PHDR as u16);
+    w.put_u16(64);
+    w.put_u16(0);
+    w.put_u16(0);
+
+    // PT_LOAD 覆盖整页，文件偏移与虚拟地址都从 0 开始
+    w.put_u32(PT_LOAD);
+    w.put_u32(PF_R | PF_X);
+    w.put_u64(0);
+    w.put_u64(0);
+    w.put_u64(0);
+    w.put_u64(PAGE_SIZE as u64);
+    w.put_u64(PAGE_SIZE as u64);
+    w.put_u64(PAGE_SIZE as u64);
+    // PT_DYNAMIC
+    w.put_u32(PT_DYNAMIC);
+    w.put_u32(PF_R);
+    w.put_u64(dyn_off as u64);
+    w.put_u64(dyn_off as u64);
+    w.put_u64(dyn_off as u64);
+    w.put_u64((16 * NR_DYN) as u64);
+    w.put_u64((16 * NR_DYN) as u64);
+    w.put_u64(8);
+
+    // 动态段
+    for (tag, val) in [
+        (DT_HASH, hash_off),
+        (DT_STRTAB, str_off),
+        (DT_SYMTAB, sym_off),
+        (DT_STRSZ, strsz),
+        (DT_SYMENT, 24),
+        (DT_SONAME, soname as usize),
+        (DT_VERSYM, versym_off),
+        (DT_VERDEF, verdef_off),
+        (DT_VERDEFNUM, 2),
+        (DT_NULL, 0),
+    ] {
+        w.put_u64(tag);
+        w.put_u64(val as u64);
+    }
+
+    // DT_HASH：一个桶，链表串起所有符号
+    debug_assert_eq!(w.pos, hash_off);
+    w.put_u32(1);
+    w.put_u32(NR_SYMS as u32);
+    w.put_u32(1);
+    for i in 0..NR_SYMS {
+        w.put_u32(if i == 0 || i + 1 == NR_SYMS { 0 } else { i as u32 + 1 });
+    }
+
+    // 符号表：0 号为空符号；st_shndx 非 0 表示已定义
+    w.align(8);
+    w.put(&[0; 24]);
+    for (name, off) in names.iter().zip(sym_offsets.iter()) {
+        w.put_u32(*name);
+        w.put_u8(SYM_GLOBAL_FUNC);
+        w.put_u8(0);
+        w.put_u16(1);
+        w.put_u64((VDSO_CODE_OFFSET + off) as u64);
+        w.put_u64(0);
+    }
+
+    // 符号版本：导出符号都属于 2 号版本 LINUX_4.15
+    w.put_u16(0);
+    for _ in 0..VDSO_SYMBOLS.len() {
+        w.put_u16(2);
+    }
+
+    // Verdef：1 号为基版本 (soname)，2 号为 LINUX_4.15
+    w.align(4);
+    for (ndx, name, name_off, next) in [(1u16, VDSO_SONAME, soname, 28u32), (2, VDSO_VERSION, version, 0)] {
+        w.put_u16(1);
+        w.put_u16(if ndx == 1 { VER_FLG_BASE } else { 0 });
+        w.put_u16(ndx);
+        w.put_u16(1);
+        w.put_u32(elf_hash(name));
+        w.put_u32(20);
+        w.put_u32(next);
+        w.put_u32(name_off);
+        w.put_u32(0);
+    }
+
+    debug_assert_eq!(w.pos, str_off);
+    w.put(&strtab[..strsz]);
+}
+
+/// 生成 vDSO 映像并启用用户模式读取 time CSR (vdso_init)
+pub fn init() {
+    let start = vdso_code_start as usize;
+    let code_len = vdso_code_end as usize - start;
+    assert!(VDSO_CODE_OFFSET + code_len <= PAGE_SIZE);
+    let offsets = [vdso_clock_gettime as usize, vdso_gettimeofday as usize, vdso_rt_sigreturn as usize]
+        .map(|addr| addr - start);
+
+    let image = unsafe { &mut *VDSO_PAGES.image.get() };
+    build_vdso_image(image, offsets);
+    unsafe {
+        core::ptr::copy_nonoverlapping(start as *const u8, image.as_mut_ptr().add(VDSO_CODE_OFFSET), code_len);
+        // 新写入的代码可能作为指令执行
+        core::arch::asm!("fence.i", options(nostack));
+    }
+
+    update_vsyscall(read_time());
+    VDSO_PAGES.data.clock_mode.store(VDSO_CLOCKMODE_ARCHTIMER, Ordering::Release);
+}
+
+/// 允许用户模式读取 time CSR (scounteren.TM)，每个 hart 各自设置
+pub fn enable_user_time() {
+    unsafe {
+        core::arch::asm!("csrs scounteren, {}", in(reg) 1u64 << 1, options(nomem, nostack));
+    }
+}
+
+// ==================== 时间数据 ====================
+
+/// 更新 vvar 页 (update_vsyscall)
+///
+/// 只由 tick_do_timer_cpu 的 tick 调用，写者唯一；seq 为奇数期间
+/// 用户代码重读
+pub fn update_vsyscall(now: u64) {
+    let data = &VDSO_PAGES.data;
+    let ns = cycles_to_ns(now);
+    let seq = data.seq.load(Ordering::Relaxed);
+    data.seq.store(seq.wrapping_add(1), Ordering::Relaxed);
+    fence(Ordering::Release);
+    data.coarse_sec.store(ns / NSEC_PER_SEC, Ordering::Relaxed);
+    data.coarse_nsec.store(ns % NSEC_PER_SEC, Ordering::Relaxed);
+    data.seq.store(seq.wrapping_add(2), Ordering::Release);
+}
+
+/// 读取上一个 tick 的时间 (ktime_get_coarse_ts64)
+///
+/// 与 vDSO 的 *_COARSE 时钟读同一份数据
+pub fn coarse_time() -> (u64, u64) {
+    let data = &VDSO_PAGES.data;
+    loop {
+        let seq = data.seq.load(Ordering::Acquire);
+        if seq & 1 != 0 {
+            core::hint::spin_loop();
+            continue;
+        }
+        let sec = data.coarse_sec.load(Ordering::Relaxed);
+        let nsec = data.coarse_nsec.load(Ordering::Relaxed);
+        fence(Ordering::Acquire);
+        if data.seq.load(Ordering::Relaxed) == seq {
+            return (sec, nsec);
+        }
+    }
+}
+
+/// 信号处理函数的返回地址：vDSO 中的 __vdso_rt_sigreturn
+///
+/// 与 Linux riscv 相同，信号帧不带跳板代码，处理函数返回到 vDSO
+pub fn sigreturn_trampoline() -> u64 {
+    let start = vdso_code_start as usize;
+    VDSO_BASE + (VDSO_CODE_OFFSET + vdso_rt_sigreturn as usize - start) as u64
+}
+
+// ==================== 映射 ====================
+
+/// 把 vvar 页和 vDSO 页映射到新地址空间 (arch_setup_additional_pages)
+///
+/// # 返回
+/// vDSO ELF 映像的用户地址，填入 AT_SYSINFO_EHDR
+pub fn vdso_map(addr_space: &super::mm::AddressSpace) -> u64 {
+    use super::mm::{map_device_range, PageTableEntry};
+    use crate::mm::page::VirtAddr;
+    use crate::mm::vma::{Vma, VmaFlags, VmaType};
+
+    let user = PageTableEntry::V | PageTableEntry::U | PageTableEntry::R;
+    unsafe {
+        map_device_range(addr_space.root_ppn(), VDSO_DATA_BASE as usize, data_page(), PAGE_SIZE, user);
+        map_device_range(addr_space.root_ppn(), VDSO_BASE as usize, image_page(), PAGE_SIZE, user | PageTableEntry::X);
+    }
+
+    for (start, exec) in [(VDSO_DATA_BASE, false), (VDSO_BASE, true)] {
+        let mut flags = VmaFlags::new();
+        flags.insert(VmaFlags::READ | VmaFlags::SHARED);
+        if exec {
+            flags.insert(VmaFlags::EXEC);
+        }
+        let mut vma = Vma::new(
+            VirtAddr::new(start as usize),
+            VirtAddr::new(start as usize + PAGE_SIZE),
+            flags,
+        );
+        vma.set_type(VmaType::Device);
+        addr_space.vma_write().add(vma).ok();
+    }
+    VDSO_BASE
+}
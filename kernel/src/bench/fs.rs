@@ -0,0 +1,85 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 文件系统基准：块缓存 bread 命中与未命中、dcache 查找
+
+use alloc::string::String;
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+
+use super::{bench, name, BenchConfig, DEFAULT};
+use crate::drivers::blkdev::{GenDisk, ReqCmd, Request};
+use crate::fs::bio::{bread, brelse, invalidate_buffers};
+use crate::fs::dentry::{dcache_add, dcache_lookup, dcache_remove, Dentry};
+
+/// 内存盘容量（扇区），足够让每次未命中都读一个新块
+const RAMDISK_SECTORS: u32 = 1 << 22;
+
+/// 基准使用的父目录 inode 号，不与真实文件系统冲突
+const BENCH_PARENT_INO: u64 = 0xbe7c_0000;
+
+/// 读请求填零、写请求丢弃的内存盘，只测量块层和缓存本身的开销
+unsafe extern "C" fn zero_request(req: &mut Request) {
+    if let ReqCmd::Read = req.cmd_type {
+        if req.sg.is_empty() {
+            req.buffer.fill(0);
+        } else {
+            for &(addr, len) in &req.sg {
+                core::ptr::write_bytes(addr as *mut u8, 0, len);
+            }
+        }
+    }
+    if let Some(end_io) = req.end_io {
+        end_io(req, 0);
+    }
+}
+
+/// bread 命中：反复读同一个已缓存的块；未命中：每次读一个新块，经过块层读盘
+pub fn bench_bread() {
+    let mut disk = GenDisk::new("bench0", 251, 1, 512, None);
+    disk.set_capacity(RAMDISK_SECTORS);
+    disk.set_request_fn(zero_request);
+    let device = &disk as *const GenDisk;
+
+    if let Some(bh) = bread(device, 0) {
+        brelse(bh);
+        bench("bread/hit", DEFAULT, || {
+            if let Some(bh) = bread(device, 0) {
+                brelse(bh);
+            }
+        });
+    }
+
+    let mut blocknr = 1;
+    bench("bread/miss", BenchConfig::new(500, 1), || {
+        if let Some(bh) = bread(device, blocknr) {
+            brelse(bh);
+        }
+        blocknr += 1;
+    });
+
+    // 内存盘在返回后失效，丢弃它的缓冲区
+    invalidate_buffers();
+}
+
+/// 目录中有 n 个目录项时的查找命中与未命中
+pub fn bench_dcache_lookup() {
+    for &n in [16usize, 1024].iter() {
+        let names: Vec<String> = (0..n).map(|i| alloc::format!("bench-{}", i)).collect();
+        for entry in names.iter() {
+            dcache_add(Arc::new(Dentry::new(entry.clone())), BENCH_PARENT_INO);
+        }
+        let target = names[n / 2].as_str();
+        bench(&name("dcache_lookup/hit", n), DEFAULT, || {
+            core::hint::black_box(dcache_lookup(target, BENCH_PARENT_INO));
+        });
+        bench(&name("dcache_lookup/miss", n), DEFAULT, || {
+            core::hint::black_box(dcache_lookup("bench-missing", BENCH_PARENT_INO));
+        });
+        for entry in names.iter() {
+            dcache_remove(entry, BENCH_PARENT_INO);
+        }
+    }
+}
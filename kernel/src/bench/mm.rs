@@ -0,0 +1,55 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内存分配基准：kmalloc/kfree、伙伴系统各 order、Per-CPU 页缓存
+
+use core::alloc::{GlobalAlloc, Layout};
+
+use super::{bench, name, BenchConfig, DEFAULT};
+use crate::config::PAGE_SIZE;
+use crate::mm::buddy_allocator::GLOBAL_ALLOCATOR;
+use crate::mm::pcp::{alloc_page_pcp, free_page_pcp, MigrateType};
+
+/// slab 的各个大小类
+const KMALLOC_SIZES: [usize; 10] = [8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096];
+
+/// 测量的伙伴系统 order
+const BUDDY_MAX_ORDER: usize = 6;
+
+/// 每个大小类分配并立即释放一个对象，走本 CPU 弹匣的快速路径
+pub fn bench_kmalloc() {
+    for &size in KMALLOC_SIZES.iter() {
+        bench(&name("kmalloc", size), DEFAULT, || {
+            let ptr = crate::mm::kmalloc(core::hint::black_box(size));
+            crate::mm::kfree(core::hint::black_box(ptr));
+        });
+    }
+}
+
+/// 每个 order 从伙伴系统分配并释放一个块，释放时与伙伴合并
+pub fn bench_buddy() {
+    for order in 0..=BUDDY_MAX_ORDER {
+        let size = PAGE_SIZE << order;
+        let layout = match Layout::from_size_align(size, size) {
+            Ok(layout) => layout,
+            Err(_) => continue,
+        };
+        bench(&name("buddy", order), BenchConfig::new(500, 1), || unsafe {
+            let ptr = GLOBAL_ALLOCATOR.alloc(layout);
+            if !ptr.is_null() {
+                GLOBAL_ALLOCATOR.dealloc(core::hint::black_box(ptr), layout);
+            }
+        });
+    }
+}
+
+/// 从本 CPU 页缓存分配并释放一个页
+pub fn bench_pcp() {
+    bench("alloc_page_pcp", DEFAULT, || {
+        if let Some(frame) = alloc_page_pcp(MigrateType::Movable) {
+            free_page_pcp(core::hint::black_box(frame), MigrateType::Movable);
+        }
+    });
+}
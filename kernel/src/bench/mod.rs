@@ -0,0 +1,160 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内核微基准测试
+//!
+//! 与单元测试并列，使用 `bench` 特性控制编译，在单元测试之后由启动流程调用。
+//! 每个基准先预热，再采样若干次；每次采样用 rdcycle 计时 `batch` 次调用，
+//! 扣除空采样的计时开销后折算为单次调用的周期数。
+//!
+//! 结果每行一条，便于脚本解析：
+//! ```text
+//! bench: <名称> samples=<N> batch=<B> min=<c> p50=<c> p90=<c> p99=<c> max=<c> mean=<c> ns=<ns>
+//! ```
+//! min..mean 为每次调用的周期数，ns 为按 rdtime 算出的每次调用平均纳秒数。
+//! 启动参数 `bench=<前缀>` 只运行名称以该前缀开始的基准。
+//!
+//! 运行：
+//! ```bash
+//! cargo build --package rux --features riscv64,bench
+//! ./test/run.sh kbench
+//! ```
+
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use crate::arch::riscv64::syscall_stats::rdcycle;
+use crate::println;
+
+pub mod mm;
+pub mod sched;
+pub mod fs;
+pub mod net;
+
+/// 一个基准的采样参数
+#[derive(Clone, Copy)]
+pub struct BenchConfig {
+    /// 不计入结果的预热采样数
+    pub warmup: usize,
+    /// 采样数
+    pub samples: usize,
+    /// 每次采样调用的次数，单次调用太短时用来摊薄计时开销
+    pub batch: usize,
+}
+
+impl BenchConfig {
+    pub const fn new(samples: usize, batch: usize) -> Self {
+        Self { warmup: samples / 10, samples, batch }
+    }
+}
+
+/// 默认参数：1000 次采样，每次调用一次
+pub const DEFAULT: BenchConfig = BenchConfig::new(1000, 1);
+
+/// 一个基准的结果，周期数都是单次调用的
+pub struct BenchResult {
+    pub min: u64,
+    pub p50: u64,
+    pub p90: u64,
+    pub p99: u64,
+    pub max: u64,
+    pub mean: u64,
+    pub ns: u64,
+}
+
+/// 空采样的最小周期数，从每次采样中扣除
+static mut TIMER_OVERHEAD: u64 = 0;
+
+/// 已排序样本的百分位
+fn percentile(sorted: &[u64], pct: usize) -> u64 {
+    sorted[(sorted.len() - 1) * pct / 100]
+}
+
+/// 启动参数 `bench=` 是否选中这个基准
+fn selected(name: &str) -> bool {
+    match crate::cmdline::get_param("bench") {
+        Some(prefix) => name.starts_with(prefix.as_str()),
+        None => true,
+    }
+}
+
+/// 采样 f，不输出
+fn measure<F: FnMut()>(config: BenchConfig, f: &mut F) -> BenchResult {
+    let batch = config.batch.max(1);
+    let samples = config.samples.max(1);
+    for _ in 0..config.warmup * batch {
+        f();
+    }
+
+    let overhead = unsafe { TIMER_OVERHEAD };
+    let mut cycles = Vec::with_capacity(samples);
+    let time_start = crate::drivers::timer::read_time();
+    for _ in 0..samples {
+        let start = rdcycle();
+        for _ in 0..batch {
+            f();
+        }
+        let elapsed = rdcycle().wrapping_sub(start).saturating_sub(overhead);
+        cycles.push(elapsed / batch as u64);
+    }
+    let ticks = crate::drivers::timer::read_time().wrapping_sub(time_start);
+    cycles.sort_unstable();
+
+    let calls = (samples * batch) as u64;
+    BenchResult {
+        min: cycles[0],
+        p50: percentile(&cycles, 50),
+        p90: percentile(&cycles, 90),
+        p99: percentile(&cycles, 99),
+        max: cycles[samples - 1],
+        mean: cycles.iter().sum::<u64>() / samples as u64,
+        // rdtime 频率为 CLOCK_FREQ (10MHz)，1 tick = 100ns
+        ns: ticks * (1_000_000_000 / crate::drivers::timer::CLOCK_FREQ) / calls,
+    }
+}
+
+/// 运行一个基准并输出一行结果
+///
+/// # 返回
+/// 被 `bench=` 过滤掉时返回 None
+pub fn bench<F: FnMut()>(name: &str, config: BenchConfig, mut f: F) -> Option<BenchResult> {
+    if !selected(name) {
+        return None;
+    }
+    let result = measure(config, &mut f);
+    println!(
+        "bench: {} samples={} batch={} min={} p50={} p90={} p99={} max={} mean={} ns={}",
+        name, config.samples, config.batch.max(1), result.min, result.p50, result.p90,
+        result.p99, result.max, result.mean, result.ns
+    );
+    Some(result)
+}
+
+/// 带参数的基准名称，如 `kmalloc/64`
+pub fn name(base: &str, param: usize) -> String {
+    alloc::format!("{}/{}", base, param)
+}
+
+/// 测量空采样的计时开销
+fn calibrate() {
+    let result = measure(BenchConfig::new(1000, 1), &mut || {});
+    unsafe { TIMER_OVERHEAD = result.min };
+}
+
+pub fn run_all_benches() {
+    println!("bench: ===== Starting Kernel Benchmarks =====");
+    calibrate();
+    println!("bench: timer overhead {} cycles", unsafe { TIMER_OVERHEAD });
+
+    mm::bench_kmalloc();
+    mm::bench_buddy();
+    mm::bench_pcp();
+    sched::bench_schedule();
+    fs::bench_bread();
+    fs::bench_dcache_lookup();
+    net::bench_ip_checksum();
+
+    println!("bench: ===== Kernel Benchmarks Completed =====");
+}
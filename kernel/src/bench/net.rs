@@ -0,0 +1,23 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 网络基准：Internet 校验和
+
+use alloc::vec::Vec;
+
+use super::{bench, name, DEFAULT};
+use crate::net::ipv4::checksum::ip_checksum;
+
+/// IP 头、最小帧、IPv4 最小 MTU 和以太网 MTU
+const CHECKSUM_SIZES: [usize; 4] = [20, 64, 576, 1500];
+
+pub fn bench_ip_checksum() {
+    for &size in CHECKSUM_SIZES.iter() {
+        let data: Vec<u8> = (0..size).map(|i| (i * 7) as u8).collect();
+        bench(&name("ip_checksum", size), DEFAULT, || {
+            core::hint::black_box(ip_checksum(core::hint::black_box(&data)));
+        });
+    }
+}
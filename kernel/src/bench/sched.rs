@@ -0,0 +1,20 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 调度器基准：schedule() 往返
+
+use super::{bench, BenchConfig};
+
+/// 从启动上下文调用 schedule() 直到重新回到这里
+///
+/// 没有其他可运行任务时只测量选择下一个任务的开销；有任务时包含它们运行到让出 CPU 的时间
+pub fn bench_schedule() {
+    let switches = crate::sched::stats::nr_context_switches_cpu(crate::arch::cpu_id() as usize);
+    let result = bench("schedule", BenchConfig::new(200, 1), crate::sched::schedule);
+    if result.is_some() {
+        let after = crate::sched::stats::nr_context_switches_cpu(crate::arch::cpu_id() as usize);
+        crate::println!("bench: schedule context_switches={}", after - switches);
+    }
+}
@@ -99,11 +99,14 @@ pub const TCP_SOCKET_TABLE_SIZE: usize = 64;
 /// UDP 套接字表大小
 pub const UDP_SOCKET_TABLE_SIZE: usize = 64;
 
-/// ARP 缓存大小
-pub const ARP_CACHE_SIZE: usize = 64;
+/// ARP 缓存大小（条目数，ARP_BUCKET_WAYS 的倍数）
+pub const ARP_CACHE_SIZE: usize = 256;
 
-/// 路由表大小
-pub const ROUTE_TABLE_SIZE: usize = 64;
+/// 路由表最多容纳的路由条数
+pub const ROUTE_TABLE_SIZE: usize = 4096;
+
+/// 每 CPU 目的地址缓存的项数（2 的幂）
+pub const ROUTE_CACHE_SIZE: usize = 64;
 
 /// IPv4 默认 TTL
 pub const IP_DEFAULT_TTL: u8 = 64;
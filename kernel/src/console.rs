@@ -4,7 +4,8 @@
 //!
 use core::fmt;
 use core::arch::asm;
-use spin::Mutex;
+use crate::sync::LockClass;
+use crate::sync::spinlock::{RawTicketLock, SpinLockGuard, TicketLock};
 
 // UART 基础地址 - 根据架构选择
 #[cfg(feature = "aarch64")]
@@ -50,8 +51,10 @@ impl Uart {
     }
 }
 
-/// 全局 UART 控制台（使用自旋锁保护，SMP 安全）
-static UART: Mutex<Uart> = Mutex::new(Uart::new(UART0_BASE));
+static UART_LOCK_CLASS: LockClass = LockClass::new("uart");
+
+/// 全局 UART 控制台（使用票据锁保护，各 CPU 按顺序输出）
+static UART: TicketLock<Uart> = TicketLock::with_class(Uart::new(UART0_BASE), &UART_LOCK_CLASS);
 
 /// 初始化控制台（QEMU virt 不需要初始化）
 pub fn init() {
@@ -76,7 +79,7 @@ pub fn puts(s: &str) {
 /// 获取 UART 锁（用于批量输出）
 ///
 /// 返回锁守卫，调用者可以在其作用域内安全地调用 putc
-pub fn lock() -> spin::MutexGuard<'static, Uart> {
+pub fn lock() -> SpinLockGuard<'static, Uart, RawTicketLock> {
     UART.lock()
 }
 
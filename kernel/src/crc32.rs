@@ -0,0 +1,178 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! CRC32 与 CRC32C
+//!
+//! 参考 Linux: lib/crc32.c, arch/riscv/lib/crc32.c
+//!
+//! 两个反射多项式共用同一套实现：
+//! - 按 8 字节切片查表 (slice-by-8)，每轮 8 次相互独立的查表，不再逐字节串行依赖
+//! - CPU 支持 Zbc 时每 8 字节用无进位乘法做一次 Barrett 约减 (crc32_le_zbc)
+//!
+//! 与 Linux 的 crc32_le() / crc32c() 一样不做首尾取反，调用者给出初始值
+//! （jbd2 与 ext4 以 ~0 为种子且结果不取反，以太网 FCS 首尾都取反）
+
+/// 反射形式的 IEEE 802.3 多项式 (CRC32_POLY_LE)
+pub const CRC32_POLY_LE: u32 = 0xEDB8_8320;
+/// 反射形式的 Castagnoli 多项式 (CRC32C_POLY_LE)
+pub const CRC32C_POLY_LE: u32 = 0x82F6_3B78;
+
+/// x^96 / P 的商，省略 x^64 项，反射形式 (CRC32_POLY_QT_LE)
+#[cfg(feature = "riscv64")]
+const CRC32_POLY_QT_LE: u64 = 0x5a72_d812_fb80_8b20;
+/// x^96 / P 的商，省略 x^64 项，反射形式 (CRC32C_POLY_QT_LE)
+#[cfg(feature = "riscv64")]
+const CRC32C_POLY_QT_LE: u64 = 0xa434_f61c_6f53_89f8;
+
+/// 使用 Zbc 的最小长度；更短的数据对齐的开销大于收益
+pub const CRC_ZBC_MIN_LEN: usize = 16;
+
+/// 切片表：tab[0] 为按字节查表的余数表，tab[k][i] 为字节 i 之后再跟 k 个零字节的余数
+const fn slice8_table(poly: u32) -> [[u32; 256]; 8] {
+    let mut tab = [[0u32; 256]; 8];
+    let mut i = 0;
+    while i < 256 {
+        let mut crc = i as u32;
+        let mut bit = 0;
+        while bit < 8 {
+            crc = if crc & 1 != 0 { (crc >> 1) ^ poly } else { crc >> 1 };
+            bit += 1;
+        }
+        tab[0][i] = crc;
+        i += 1;
+    }
+    let mut k = 1;
+    while k < 8 {
+        let mut i = 0;
+        while i < 256 {
+            let prev = tab[k - 1][i];
+            tab[k][i] = (prev >> 8) ^ tab[0][(prev & 0xFF) as usize];
+            i += 1;
+        }
+        k += 1;
+    }
+    tab
+}
+
+/// 编译时生成的切片表，各 8KB
+static CRC32_TABLE: [[u32; 256]; 8] = slice8_table(CRC32_POLY_LE);
+static CRC32C_TABLE: [[u32; 256]; 8] = slice8_table(CRC32C_POLY_LE);
+
+/// 在 crc 的基础上继续计算 data 的 CRC32 (crc32_le)
+pub fn crc32_le(crc: u32, data: &[u8]) -> u32 {
+    #[cfg(feature = "riscv64")]
+    {
+        if data.len() >= CRC_ZBC_MIN_LEN && crate::arch::riscv64::cpu::has_zbc() {
+            return unsafe { crc32_le_zbc(crc, data) };
+        }
+    }
+    crc32_le_base(crc, data)
+}
+
+/// 在 crc 的基础上继续计算 data 的 CRC32C (crc32c)
+pub fn crc32c(crc: u32, data: &[u8]) -> u32 {
+    #[cfg(feature = "riscv64")]
+    {
+        if data.len() >= CRC_ZBC_MIN_LEN && crate::arch::riscv64::cpu::has_zbc() {
+            return unsafe { crc32c_zbc(crc, data) };
+        }
+    }
+    crc32c_base(crc, data)
+}
+
+/// 切片查表的 CRC32 (crc32_le_base)
+pub fn crc32_le_base(crc: u32, data: &[u8]) -> u32 {
+    crc_le_slice8(crc, data, &CRC32_TABLE)
+}
+
+/// 切片查表的 CRC32C (crc32c_base)
+pub fn crc32c_base(crc: u32, data: &[u8]) -> u32 {
+    crc_le_slice8(crc, data, &CRC32C_TABLE)
+}
+
+/// 逐位计算的参考实现
+///
+/// 用于验证与基准比较，poly 为反射形式的多项式
+pub fn crc_le_ref(poly: u32, crc: u32, data: &[u8]) -> u32 {
+    data.iter().fold(crc, |mut crc, &b| {
+        crc ^= b as u32;
+        for _ in 0..8 {
+            crc = if crc & 1 != 0 { (crc >> 1) ^ poly } else { crc >> 1 };
+        }
+        crc
+    })
+}
+
+/// 每轮取 8 字节，低 4 字节与 crc 异或后和高 4 字节一起查 8 张表 (crc32_body)
+fn crc_le_slice8(mut crc: u32, data: &[u8], tab: &[[u32; 256]; 8]) -> u32 {
+    let mut chunks = data.chunks_exact(8);
+    for c in &mut chunks {
+        let lo = crc ^ u32::from_le_bytes([c[0], c[1], c[2], c[3]]);
+        let hi = u32::from_le_bytes([c[4], c[5], c[6], c[7]]);
+        crc = tab[7][(lo & 0xFF) as usize]
+            ^ tab[6][(lo >> 8 & 0xFF) as usize]
+            ^ tab[5][(lo >> 16 & 0xFF) as usize]
+            ^ tab[4][(lo >> 24) as usize]
+            ^ tab[3][(hi & 0xFF) as usize]
+            ^ tab[2][(hi >> 8 & 0xFF) as usize]
+            ^ tab[1][(hi >> 16 & 0xFF) as usize]
+            ^ tab[0][(hi >> 24) as usize];
+    }
+    chunks
+        .remainder()
+        .iter()
+        .fold(crc, |crc, &b| (crc >> 8) ^ tab[0][((crc ^ b as u32) & 0xFF) as usize])
+}
+
+/// 使用 Zbc 的 CRC32
+///
+/// # Safety
+/// 调用者需确认 `has_zbc()` 为真
+#[cfg(feature = "riscv64")]
+pub unsafe fn crc32_le_zbc(crc: u32, data: &[u8]) -> u32 {
+    crc_le_zbc(crc, data, &CRC32_TABLE, CRC32_POLY_LE, CRC32_POLY_QT_LE)
+}
+
+/// 使用 Zbc 的 CRC32C
+///
+/// # Safety
+/// 调用者需确认 `has_zbc()` 为真
+#[cfg(feature = "riscv64")]
+pub unsafe fn crc32c_zbc(crc: u32, data: &[u8]) -> u32 {
+    crc_le_zbc(crc, data, &CRC32C_TABLE, CRC32C_POLY_LE, CRC32C_POLY_QT_LE)
+}
+
+/// 8 字节对齐的部分每个字做一次 Barrett 约减，首尾不足一个字的部分查表 (crc32_le_generic)
+///
+/// s = crc ^ word 视为 64 位多项式，余数为 ((s·qt 的低 64 位 << 1) ^ s) 与 P 相乘的高位；
+/// 没有 clmulrh 指令，用 clmul + slli 代替
+#[cfg(feature = "riscv64")]
+unsafe fn crc_le_zbc(mut crc: u32, data: &[u8], tab: &[[u32; 256]; 8], poly: u32, poly_qt: u64) -> u32 {
+    let head = data.as_ptr().align_offset(8).min(data.len());
+    crc = crc_le_slice8(crc, &data[..head], tab);
+    let words = (data.len() - head) / 8;
+    let p = data.as_ptr().add(head) as *const u64;
+    for i in 0..words {
+        let s = crc as u64 ^ u64::from_le(p.add(i).read());
+        let r: u64;
+        core::arch::asm!(
+            ".option push",
+            ".option arch, +zbc",
+            "clmul {r}, {s}, {qt}",
+            "slli {r}, {r}, 1",
+            "xor {r}, {r}, {s}",
+            "clmulr {r}, {r}, {p}",
+            "srli {r}, {r}, 32",
+            ".option pop",
+            r = out(reg) r,
+            s = in(reg) s,
+            qt = in(reg) poly_qt,
+            p = in(reg) (poly as u64) << 32,
+            options(pure, nomem, nostack),
+        );
+        crc = r as u32;
+    }
+    crc_le_slice8(crc, &data[head + words * 8..], tab)
+}
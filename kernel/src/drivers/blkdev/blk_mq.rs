@@ -0,0 +1,628 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 多队列块层 (blk-mq)
+//!
+//! 参考 Linux: block/blk-mq.c, block/blk-core.c (blk_start_plug), block/blk-merge.c,
+//! block/mq-deadline.c
+//!
+//! 文件系统与驱动之间的请求队列：
+//! - 调用者的每段 I/O 是一个 bio；在 plug 中积攒的 bio 按扇区排序后一次放入当前 CPU 的
+//!   软件队列 (blk_mq_ctx)，不按 plug 提交的 bio 直接放入
+//! - 派发时把所有软件队列的 bio 移入 deadline 调度器：与已排队的请求首尾相接的 bio
+//!   前向或后向合并进同一个请求，单个请求不超过 BLK_MAX_SECTORS
+//! - deadline 调度器读写分开按扇区排序，优先派发读；写最多让读 WRITES_STARVED 轮，
+//!   请求超过期限时从 FIFO 头派发，否则沿扇区递增方向批量派发 FIFO_BATCH 个
+//! - 同时派发的上下文不超过驱动设置的队列深度 (queue_depth)，超出时由正在派发的
+//!   上下文一并派发，提交者等待自己的 bio 全部完成
+//! - 设备有多个硬件队列时按派发所在的 CPU 选择 (blk_mq_map_queues)，各 CPU 的请求
+//!   落在不同的硬件队列上，互不争用队列锁
+//! - 刷新请求 (Flush) 以及没有数据的 Discard / WriteZeroes 不合并，
+//!   先派发完调度器中的请求再执行
+//! - bio 进入 plug 时记下 rdtime，合并、交给驱动和驱动完成时更新磁盘的 I/O 统计 (stat)
+
+use alloc::collections::{BTreeMap, VecDeque};
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use core::marker::PhantomData;
+use core::sync::atomic::{AtomicI32, AtomicU64, AtomicUsize, Ordering};
+use spin::Mutex;
+
+use super::stat::op_stat_group;
+use super::{GenDisk, ReqCmd, Request};
+use crate::config::MAX_CPUS;
+use crate::drivers::timer::{get_jiffies, read_time, HZ};
+
+/// 扇区大小
+pub const SECTOR_SIZE: usize = 512;
+
+/// 单个请求最多的扇区数 (max_sectors_kb = 128)
+pub const BLK_MAX_SECTORS: u64 = 256;
+
+/// plug 中积攒的 bio 超过它时提前放入软件队列 (BLK_MAX_REQUEST_COUNT)
+const BLK_MAX_REQUEST_COUNT: usize = 32;
+
+/// 读请求的期限 (read_expire = 500ms)
+const READ_EXPIRE: u64 = HZ / 2;
+
+/// 写请求的期限 (write_expire = 5s)
+const WRITE_EXPIRE: u64 = 5 * HZ;
+
+/// 有写请求时读最多连续派发的轮数 (writes_starved)
+const WRITES_STARVED: u32 = 2;
+
+/// 沿扇区方向连续派发的请求数 (fifo_batch)
+const FIFO_BATCH: u32 = 16;
+
+/// 读写方向 (DD_READ / DD_WRITE)
+const DD_READ: usize = 0;
+const DD_WRITE: usize = 1;
+
+/// 一组 bio 的完成状态 (submit_bio_wait)
+struct BioDone {
+    /// 尚未完成的 bio 数
+    pending: AtomicUsize,
+    /// 第一个错误码
+    error: AtomicI32,
+}
+
+impl BioDone {
+    fn new() -> Self {
+        Self { pending: AtomicUsize::new(0), error: AtomicI32::new(0) }
+    }
+
+    /// 一个 bio 完成 (bio_endio)
+    fn complete(&self, error: i32) {
+        if error < 0 {
+            let _ = self.error.compare_exchange(0, error, Ordering::AcqRel, Ordering::Relaxed);
+        }
+        self.pending.fetch_sub(1, Ordering::Release);
+    }
+}
+
+/// 调用者的一段连续 I/O (struct bio)
+struct Bio {
+    op: ReqCmd,
+    sector: u64,
+    /// 调用者的缓冲区，在 done 完成前有效
+    buf: *mut u8,
+    len: usize,
+    done: Arc<BioDone>,
+    /// 进入块层的时刻，rdtime
+    start: u64,
+}
+
+unsafe impl Send for Bio {}
+
+impl Bio {
+    /// 不足一个扇区的尾部按整扇区传输
+    #[inline]
+    fn nr_sectors(&self) -> u64 {
+        ((self.len + SECTOR_SIZE - 1) / SECTOR_SIZE) as u64
+    }
+
+    #[inline]
+    fn end_sector(&self) -> u64 {
+        self.sector + self.nr_sectors()
+    }
+}
+
+/// 调度器中的请求：扇区连续的一组 bio (struct request)
+struct MqRequest {
+    sector: u64,
+    nr_sectors: u64,
+    /// 按扇区顺序排列
+    bios: VecDeque<Bio>,
+    /// 派发期限 (fifo_time)
+    deadline: u64,
+    /// FIFO 中的序号
+    seq: u64,
+}
+
+impl MqRequest {
+    #[inline]
+    fn end_sector(&self) -> u64 {
+        self.sector + self.nr_sectors
+    }
+}
+
+/// deadline 调度器 (struct deadline_data)
+struct DeadlineSched {
+    /// 按起始扇区排序的请求 (sort_list)
+    sorted: [BTreeMap<u64, MqRequest>; 2],
+    /// 按期限排序：(deadline, seq) -> 起始扇区 (fifo_list)
+    fifo: [BTreeMap<(u64, u64), u64>; 2],
+    /// 当前批次的方向和批内已派发数
+    last_dir: usize,
+    batching: u32,
+    /// 有写请求时读已连续派发的轮数
+    starved: u32,
+    /// 批次中下一个请求的起始扇区 (next_rq)
+    next_sector: [u64; 2],
+    next_seq: u64,
+    /// 等调度器清空后执行的 bio：刷新请求，以及与已排队请求起始扇区相同的 bio
+    deferred: VecDeque<Bio>,
+    /// 统计：合并的 bio 数、派发的请求数
+    nr_merged: usize,
+    nr_dispatched: usize,
+}
+
+#[inline]
+fn op_dir(op: ReqCmd) -> usize {
+    if op == ReqCmd::Read { DD_READ } else { DD_WRITE }
+}
+
+impl DeadlineSched {
+    const fn new() -> Self {
+        Self {
+            sorted: [BTreeMap::new(), BTreeMap::new()],
+            fifo: [BTreeMap::new(), BTreeMap::new()],
+            last_dir: DD_READ,
+            batching: 0,
+            starved: 0,
+            next_sector: [0; 2],
+            next_seq: 0,
+            deferred: VecDeque::new(),
+            nr_merged: 0,
+            nr_dispatched: 0,
+        }
+    }
+
+    /// 从两个索引中取出请求
+    fn take(&mut self, dir: usize, sector: u64) -> Option<MqRequest> {
+        let rq = self.sorted[dir].remove(&sector)?;
+        self.fifo[dir].remove(&(rq.deadline, rq.seq));
+        Some(rq)
+    }
+
+    fn put(&mut self, dir: usize, rq: MqRequest) {
+        self.fifo[dir].insert((rq.deadline, rq.seq), rq.sector);
+        self.sorted[dir].insert(rq.sector, rq);
+    }
+
+    /// 插入 bio，能合并时并入已有请求 (dd_insert_request + blk_mq_sched_try_merge)
+    ///
+    /// # 返回
+    /// 合并后少掉的请求数：没有合并为 0，bio 并入请求为 1，并入后两个请求相接又合为一个为 2
+    fn insert(&mut self, bio: Bio, now: u64) -> usize {
+        if !matches!(bio.op, ReqCmd::Read | ReqCmd::Write) {
+            self.deferred.push_back(bio);
+            return 0;
+        }
+        let dir = op_dir(bio.op);
+
+        // 后向合并：接在某个请求之后 (ELEVATOR_BACK_MERGE)
+        let back = self.sorted[dir]
+            .range(..bio.sector)
+            .next_back()
+            .filter(|(_, rq)| rq.end_sector() == bio.sector && rq.nr_sectors + bio.nr_sectors() <= BLK_MAX_SECTORS)
+            .map(|(&sector, _)| sector);
+        if let Some(sector) = back {
+            let mut rq = self.take(dir, sector).unwrap();
+            rq.nr_sectors += bio.nr_sectors();
+            rq.bios.push_back(bio);
+            self.nr_merged += 1;
+            // 合并后与下一个请求相接时两个请求合为一个 (attempt_back_merge)
+            let next = rq.end_sector();
+            let mergeable = self.sorted[dir]
+                .get(&next)
+                .map_or(false, |n| rq.nr_sectors + n.nr_sectors <= BLK_MAX_SECTORS);
+            if mergeable {
+                let n = self.take(dir, next).unwrap();
+                rq.nr_sectors += n.nr_sectors;
+                rq.deadline = rq.deadline.min(n.deadline);
+                rq.bios.extend(n.bios);
+            }
+            self.put(dir, rq);
+            return if mergeable { 2 } else { 1 };
+        }
+
+        // 前向合并：接在某个请求之前 (ELEVATOR_FRONT_MERGE)
+        let front = self.sorted[dir]
+            .get(&bio.end_sector())
+            .map_or(false, |rq| rq.nr_sectors + bio.nr_sectors() <= BLK_MAX_SECTORS);
+        if front {
+            let mut rq = self.take(dir, bio.end_sector()).unwrap();
+            rq.sector = bio.sector;
+            rq.nr_sectors += bio.nr_sectors();
+            rq.bios.push_front(bio);
+            self.nr_merged += 1;
+            self.put(dir, rq);
+            return 1;
+        }
+
+        // 同一扇区的重复写在已排队的请求之后执行，保持提交顺序
+        if self.sorted[dir].contains_key(&bio.sector) {
+            self.deferred.push_back(bio);
+            return 0;
+        }
+
+        let expire = if dir == DD_READ { READ_EXPIRE } else { WRITE_EXPIRE };
+        let rq = MqRequest {
+            sector: bio.sector,
+            nr_sectors: bio.nr_sectors(),
+            bios: VecDeque::from([bio]),
+            deadline: now + expire,
+            seq: self.next_seq,
+        };
+        self.next_seq += 1;
+        self.put(dir, rq);
+        0
+    }
+
+    /// 选出下一个派发的请求 (dd_dispatch_request)
+    fn dispatch(&mut self, now: u64) -> Option<MqRequest> {
+        // 1. 继续当前批次
+        if self.batching > 0 && self.batching < FIFO_BATCH {
+            let dir = self.last_dir;
+            let next = self.sorted[dir].range(self.next_sector[dir]..).next().map(|(&s, _)| s);
+            if let Some(sector) = next {
+                return self.dispatch_from(dir, sector);
+            }
+        }
+
+        // 2. 选择方向：优先读，但写不能一直等
+        let reads = !self.sorted[DD_READ].is_empty();
+        let writes = !self.sorted[DD_WRITE].is_empty();
+        let dir = if reads && (!writes || self.starved < WRITES_STARVED) {
+            if writes {
+                self.starved += 1;
+            }
+            DD_READ
+        } else if writes {
+            self.starved = 0;
+            DD_WRITE
+        } else {
+            return None;
+        };
+
+        // 3. 期限已到或扇区方向上没有请求时从 FIFO 头开始新批次
+        let expired = self.fifo[dir].keys().next().map_or(false, |&(deadline, _)| deadline <= now);
+        let next = self.sorted[dir].range(self.next_sector[dir]..).next().map(|(&s, _)| s);
+        let sector = match next {
+            Some(sector) if !expired => sector,
+            _ => *self.fifo[dir].values().next()?,
+        };
+        self.last_dir = dir;
+        self.batching = 0;
+        self.dispatch_from(dir, sector)
+    }
+
+    fn dispatch_from(&mut self, dir: usize, sector: u64) -> Option<MqRequest> {
+        let rq = self.take(dir, sector)?;
+        self.next_sector[dir] = rq.end_sector();
+        self.batching += 1;
+        self.nr_dispatched += 1;
+        Some(rq)
+    }
+}
+
+/// 设备的请求队列 (struct request_queue)
+pub struct RequestQueue {
+    /// 每 CPU 软件队列 (blk_mq_ctx)
+    ctx: [Mutex<Vec<Bio>>; MAX_CPUS],
+    /// I/O 调度器
+    sched: Mutex<DeadlineSched>,
+    /// 正在派发的上下文数，每个上下文同时只有一个请求在驱动中
+    nr_running: AtomicUsize,
+    /// 驱动能同时处理的请求数 (queue_depth)
+    depth: AtomicUsize,
+    /// 驱动的硬件队列数 (nr_hw_queues)
+    nr_hw_queues: AtomicUsize,
+    /// 统计：提交的 bio 数
+    nr_bios: AtomicU64,
+}
+
+impl RequestQueue {
+    pub const fn new() -> Self {
+        Self {
+            ctx: [const { Mutex::new(Vec::new()) }; MAX_CPUS],
+            sched: Mutex::new(DeadlineSched::new()),
+            nr_running: AtomicUsize::new(0),
+            depth: AtomicUsize::new(1),
+            nr_hw_queues: AtomicUsize::new(1),
+            nr_bios: AtomicU64::new(0),
+        }
+    }
+
+    /// 设置驱动能同时处理的请求数 (blk_mq_tag_set.queue_depth)
+    pub fn set_depth(&self, depth: usize) {
+        self.depth.store(depth.max(1), Ordering::Relaxed);
+    }
+
+    /// 设置驱动的硬件队列数 (blk_mq_tag_set.nr_hw_queues)
+    pub fn set_nr_hw_queues(&self, nr: usize) {
+        self.nr_hw_queues.store(nr.max(1), Ordering::Relaxed);
+    }
+
+    /// 驱动的硬件队列数
+    pub fn nr_hw_queues(&self) -> usize {
+        self.nr_hw_queues.load(Ordering::Relaxed)
+    }
+
+    /// CPU 的请求交给哪个硬件队列 (blk_mq_map_queues)
+    ///
+    /// 队列不少于 CPU 时每个 CPU 一个队列，否则按 CPU 号轮流分配
+    #[inline]
+    pub fn map_queue(&self, cpu: usize) -> usize {
+        cpu % self.nr_hw_queues()
+    }
+
+    /// 放入当前 CPU 的软件队列 (blk_mq_insert_requests)
+    fn insert(&self, bios: impl IntoIterator<Item = Bio>) {
+        let cpu = (crate::arch::cpu_id() as usize).min(MAX_CPUS - 1);
+        let mut queue = self.ctx[cpu].lock();
+        for bio in bios {
+            self.nr_bios.fetch_add(1, Ordering::Relaxed);
+            queue.push(bio);
+        }
+    }
+
+    /// 派发所有排队的请求 (blk_mq_run_hw_queue)
+    ///
+    /// 派发的上下文已达到队列深度时直接返回，由它们派发本 CPU 放入的 bio
+    fn run(&self, disk: &GenDisk) {
+        let depth = self.depth.load(Ordering::Relaxed);
+        loop {
+            let started = self.nr_running.fetch_update(Ordering::SeqCst, Ordering::SeqCst, |n| {
+                if n < depth { Some(n + 1) } else { None }
+            });
+            if started.is_err() {
+                return;
+            }
+            // 软件队列的 bio 移入调度器 (blk_mq_flush_busy_ctxs)
+            let now = get_jiffies();
+            {
+                let mut sched = self.sched.lock();
+                for ctx in &self.ctx {
+                    let bios = core::mem::take(&mut *ctx.lock());
+                    for bio in bios {
+                        let group = op_stat_group(bio.op);
+                        disk.stats.io_merge(group, sched.insert(bio, now));
+                    }
+                }
+            }
+            loop {
+                let rq = {
+                    let mut sched = self.sched.lock();
+                    match sched.dispatch(now) {
+                        Some(rq) => Some(rq),
+                        // 调度器空了且没有其他请求在驱动中时才执行推迟的 bio
+                        None if self.nr_running.load(Ordering::SeqCst) > 1 => None,
+                        None => sched.deferred.pop_front().map(|bio| {
+                            let nr_sectors = bio.nr_sectors();
+                            MqRequest {
+                                sector: bio.sector,
+                                nr_sectors,
+                                bios: VecDeque::from([bio]),
+                                deadline: now,
+                                seq: 0,
+                            }
+                        }),
+                    }
+                };
+                match rq {
+                    Some(rq) => issue(disk, rq),
+                    None => break,
+                }
+            }
+            self.nr_running.fetch_sub(1, Ordering::SeqCst);
+
+            // 派发期间其他 CPU 放入的 bio、其他上下文留下的推迟 bio 可能没人派发
+            if self.ctx.iter().all(|ctx| ctx.lock().is_empty()) && self.sched.lock().deferred.is_empty() {
+                return;
+            }
+        }
+    }
+
+    /// 等待一组 bio 完成 (blk_wait_io)
+    fn wait(&self, disk: &GenDisk, done: &BioDone) {
+        while done.pending.load(Ordering::Acquire) != 0 {
+            self.run(disk);
+            core::hint::spin_loop();
+        }
+    }
+
+    /// 合并和派发统计：(提交的 bio 数, 合并的 bio 数, 派发的请求数)
+    pub fn stats(&self) -> (u64, usize, usize) {
+        let sched = self.sched.lock();
+        (self.nr_bios.load(Ordering::Relaxed), sched.nr_merged, sched.nr_dispatched)
+    }
+}
+
+/// 请求的完成状态，由 Request.end_io_data 指向
+struct RqStatus {
+    error: AtomicI32,
+    /// 驱动完成的时刻，rdtime；0 表示驱动没有调用完成回调
+    done: AtomicU64,
+}
+
+/// 驱动完成请求时记录结果与时刻 (blk_mq_end_request)
+unsafe fn blk_end_request(req: &Request, error: i32) {
+    if let Some(status) = (req.end_io_data as *const RqStatus).as_ref() {
+        status.done.store(read_time(), Ordering::Relaxed);
+        status.error.store(error, Ordering::Release);
+    }
+}
+
+/// 把请求交给驱动，完成后分发到各个 bio (blk_mq_dispatch_rq_list)
+fn issue(disk: &GenDisk, rq: MqRequest) {
+    let op = rq.bios.front().map_or(ReqCmd::Flush, |bio| bio.op);
+    let len = rq.nr_sectors as usize * SECTOR_SIZE;
+    let has_data = matches!(op, ReqCmd::Read | ReqCmd::Write);
+    // 驱动支持分散/聚集且各 bio 都是整扇区时直接交出 bio 的缓冲区，不再拷贝
+    let zero_copy = has_data
+        && rq.bios.iter().all(|bio| bio.len % SECTOR_SIZE == 0)
+        && nr_phys_segments(&rq) <= disk.max_segments;
+    let mut buffer = Vec::new();
+    let mut sg = Vec::new();
+    if !has_data {
+        // 只有范围，没有数据
+    } else if zero_copy {
+        sg = rq.bios.iter().map(|bio| (bio.buf as usize, bio.len)).collect();
+    } else {
+        buffer = alloc::vec![0u8; len];
+        if op == ReqCmd::Write {
+            // 聚集各 bio 的数据
+            let mut off = 0;
+            for bio in &rq.bios {
+                unsafe { core::ptr::copy_nonoverlapping(bio.buf, buffer[off..].as_mut_ptr(), bio.len) };
+                off += bio.nr_sectors() as usize * SECTOR_SIZE;
+            }
+        }
+    }
+
+    let status = RqStatus { error: AtomicI32::new(0), done: AtomicU64::new(0) };
+    let mut req = Request {
+        cmd_type: op,
+        sector: rq.sector,
+        nr_sectors: rq.nr_sectors,
+        buffer,
+        sg,
+        device: disk as *const GenDisk,
+        end_io: Some(blk_end_request),
+        end_io_data: &status as *const RqStatus as *mut u8,
+    };
+    crate::trace_record!(TRACE_BLOCK_RQ, req.sector,
+                         req.buffer.len() + req.sg.iter().map(|&(_, len)| len).sum::<usize>(), req.cmd_type as u32);
+    let start = rq.bios.iter().map(|bio| bio.start).min().unwrap_or(0);
+    let issue_time = read_time();
+    let ret = match disk.request_fn {
+        Some(request_fn) => {
+            unsafe { request_fn(&mut req) };
+            status.error.load(Ordering::Acquire)
+        }
+        None => -6,  // ENXIO
+    };
+    let done_time = match status.done.load(Ordering::Relaxed) {
+        0 => read_time(),
+        t => t,
+    };
+    disk.stats.io_done(op_stat_group(op), rq.nr_sectors, start, issue_time, done_time);
+
+    let mut off = 0;
+    for bio in rq.bios {
+        if op == ReqCmd::Read && ret >= 0 && !zero_copy {
+            // 分散到各 bio 的缓冲区
+            unsafe { core::ptr::copy_nonoverlapping(req.buffer[off..].as_ptr(), bio.buf, bio.len) };
+        }
+        off += bio.nr_sectors() as usize * SECTOR_SIZE;
+        bio.done.complete(ret);
+    }
+}
+
+/// 请求按页拆分后的段数上限 (blk_rq_nr_phys_segments)
+fn nr_phys_segments(rq: &MqRequest) -> usize {
+    const PAGE: usize = 4096;
+    rq.bios
+        .iter()
+        .map(|bio| {
+            let start = bio.buf as usize;
+            (start + bio.len + PAGE - 1) / PAGE - start / PAGE
+        })
+        .sum()
+}
+
+/// 批量提交 (struct blk_plug)
+///
+/// 在 plug 中提交的读写先积攒起来，finish（或 drop）时按扇区排序后放入软件队列，
+/// 派发并等待全部完成；相邻的 bio 在调度器中合并为一个请求。
+/// 缓冲区的生命周期与 plug 绑定，完成前不能被访问
+pub struct BlkPlug<'a> {
+    disk: &'a GenDisk,
+    bios: Vec<Bio>,
+    done: Arc<BioDone>,
+    _bufs: PhantomData<&'a mut [u8]>,
+}
+
+impl<'a> BlkPlug<'a> {
+    /// 开始批量提交 (blk_start_plug)
+    pub fn new(disk: &'a GenDisk) -> Self {
+        Self { disk, bios: Vec::new(), done: Arc::new(BioDone::new()), _bufs: PhantomData }
+    }
+
+    fn add(&mut self, op: ReqCmd, sector: u64, buf: *mut u8, len: usize) {
+        self.done.pending.fetch_add(1, Ordering::Relaxed);
+        let start = read_time();
+        self.disk.stats.io_start(start);
+        self.bios.push(Bio { op, sector, buf, len, done: self.done.clone(), start });
+        if self.bios.len() >= BLK_MAX_REQUEST_COUNT {
+            self.flush();
+        }
+    }
+
+    /// 读入 buf
+    pub fn read(&mut self, sector: u64, buf: &'a mut [u8]) {
+        self.add(ReqCmd::Read, sector, buf.as_mut_ptr(), buf.len());
+    }
+
+    /// 写出 buf，不足一个扇区的尾部补 0
+    pub fn write(&mut self, sector: u64, buf: &'a [u8]) {
+        self.add(ReqCmd::Write, sector, buf.as_ptr() as *mut u8, buf.len());
+    }
+
+    /// 刷新设备的写缓存
+    pub fn flush_cache(&mut self) {
+        self.add(ReqCmd::Flush, 0, core::ptr::null_mut(), 0);
+    }
+
+    /// 没有数据的范围请求按设备上限拆开，bio 的长度只用于记录扇区数
+    fn add_range(&mut self, op: ReqCmd, sector: u64, nr_sectors: u64, max_sectors: u32) {
+        let max = (max_sectors as u64).max(1);
+        let mut done = 0;
+        while done < nr_sectors {
+            let n = (nr_sectors - done).min(max);
+            self.add(op, sector + done, core::ptr::null_mut(), n as usize * SECTOR_SIZE);
+            done += n;
+        }
+    }
+
+    /// 丢弃扇区 (__blkdev_issue_discard)
+    ///
+    /// 与同一 plug 中的读写不保证先后，调用方应等读写完成后再丢弃
+    pub fn discard(&mut self, sector: u64, nr_sectors: u64) {
+        self.add_range(ReqCmd::Discard, sector, nr_sectors, self.disk.max_discard_sectors);
+    }
+
+    /// 不传输数据地清零扇区 (__blkdev_issue_write_zeroes)
+    pub fn write_zeroes(&mut self, sector: u64, nr_sectors: u64) {
+        self.add_range(ReqCmd::WriteZeroes, sector, nr_sectors, self.disk.max_write_zeroes_sectors);
+    }
+
+    /// 积攒的 bio 放入软件队列并派发 (blk_mq_flush_plug_list)
+    fn flush(&mut self) {
+        if self.bios.is_empty() {
+            return;
+        }
+        let mut bios = core::mem::take(&mut self.bios);
+        // 刷新请求之间的读写保持相对顺序，其余按扇区排序便于合并
+        if bios.iter().all(|bio| matches!(bio.op, ReqCmd::Read | ReqCmd::Write)) {
+            bios.sort_by_key(|bio| bio.sector);
+        }
+        self.disk.queue.insert(bios);
+        self.disk.queue.run(self.disk);
+    }
+
+    /// 结束批量提交并等待完成 (blk_finish_plug)
+    ///
+    /// # 返回
+    /// 全部成功返回 Ok，否则返回第一个错误码
+    pub fn finish(mut self) -> Result<(), i32> {
+        self.flush();
+        self.disk.queue.wait(self.disk, &self.done);
+        match self.done.error.load(Ordering::Acquire) {
+            0 => Ok(()),
+            e => Err(e),
+        }
+    }
+}
+
+impl Drop for BlkPlug<'_> {
+    fn drop(&mut self) {
+        // 缓冲区随 plug 失效，必须等待已提交的 bio 完成
+        self.flush();
+        self.disk.queue.wait(self.disk, &self.done);
+    }
+}
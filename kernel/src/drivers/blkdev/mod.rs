@@ -11,12 +11,22 @@
 //! - `struct block_device`: 块设备实例
 //! - `struct request_queue`: 请求队列
 //! - `struct bio`: I/O 描述符
+//!
+//! 读写经 blk_mq 的请求队列合并、调度后交给驱动的请求处理函数，
+//! 块层在提交、合并与完成时记录每个磁盘的 I/O 统计 (stat)
+
+pub mod blk_mq;
+pub mod stat;
 
 use alloc::boxed::Box;
-use alloc::vec;
 use alloc::vec::Vec;
 use spin::Mutex;
-use core::sync::atomic::{AtomicU32, Ordering};
+use core::sync::atomic::{AtomicU32, AtomicU64, Ordering};
+
+use crate::drivers::timer::read_time;
+
+pub use blk_mq::{BlkPlug, RequestQueue};
+pub use stat::DiskStats;
 
 #[repr(C)]
 pub struct BlockDeviceOps {
@@ -60,6 +70,26 @@ pub struct GenDisk {
     pub private_data: Option<*mut u8>,
     /// 请求处理函数
     pub request_fn: Option<unsafe extern "C" fn(&mut Request)>,
+    /// 请求队列
+    pub queue: RequestQueue,
+    /// 一个请求最多的数据段数 (queue_max_segments)；0 表示驱动只接受 buffer 中的连续数据
+    pub max_segments: usize,
+    /// 一个 Discard 请求最多的扇区数 (max_discard_sectors)；0 表示不支持 Discard
+    pub max_discard_sectors: u32,
+    /// Discard 的粒度（扇区），比它短的范围设备不会释放 (discard_granularity)
+    pub discard_granularity: u32,
+    /// 一个 WriteZeroes 请求最多的扇区数 (max_write_zeroes_sectors)；0 表示不支持
+    pub max_write_zeroes_sectors: u32,
+    /// 请求过的刷新序号，blkdev_issue_flush 据此判断自己的请求是否已被覆盖
+    flush_requested: AtomicU64,
+    /// 已完成的刷新覆盖到的请求序号
+    flush_completed: AtomicU64,
+    /// 同一时刻只有一个刷新在设备上 (blk_flush_queue.mq_flush_lock)
+    flush_mutex: crate::sync::Mutex,
+    /// 实际发给设备的刷新数
+    nr_flushes: AtomicU64,
+    /// I/O 统计 (gendisk.part0.bd_stats)
+    pub stats: DiskStats,
 }
 
 unsafe impl Send for GenDisk {}
@@ -84,6 +114,16 @@ impl GenDisk {
             ops,
             private_data: None,
             request_fn: None,
+            queue: RequestQueue::new(),
+            max_segments: 0,
+            max_discard_sectors: 0,
+            discard_granularity: 1,
+            max_write_zeroes_sectors: 0,
+            flush_requested: AtomicU64::new(0),
+            flush_completed: AtomicU64::new(0),
+            flush_mutex: crate::sync::Mutex::new(),
+            nr_flushes: AtomicU64::new(0),
+            stats: DiskStats::new(),
         }
     }
 
@@ -97,6 +137,11 @@ impl GenDisk {
         self.capacity.load(Ordering::Acquire)
     }
 
+    /// (请求过的刷新数, 实际发给设备的刷新数)
+    pub fn flush_stats(&self) -> (u64, u64) {
+        (self.flush_requested.load(Ordering::Relaxed), self.nr_flushes.load(Ordering::Relaxed))
+    }
+
     /// 设置私有数据
     pub fn set_private_data(&mut self, data: *mut u8) {
         self.private_data = Some(data);
@@ -113,12 +158,18 @@ pub struct Request {
     pub cmd_type: ReqCmd,
     /// 起始扇区
     pub sector: u64,
+    /// 扇区数；Discard / WriteZeroes 没有数据，只由它给出范围
+    pub nr_sectors: u64,
     /// 数据缓冲区
     pub buffer: Vec<u8>,
+    /// 分散/聚集段 (内核虚拟地址, 长度)；非空时数据直接在各段中，buffer 为空
+    pub sg: Vec<(usize, usize)>,
     /// 块设备指针
     pub device: *const GenDisk,
     /// 完成回调
     pub end_io: Option<unsafe fn(&Request, i32)>,
+    /// 完成回调的私有数据
+    pub end_io_data: *mut u8,
 }
 
 #[repr(C)]
@@ -130,6 +181,10 @@ pub enum ReqCmd {
     Write,
     /// 刷新
     Flush,
+    /// 丢弃：扇区不再使用，瘦分配的设备可以回收空间 (REQ_OP_DISCARD)
+    Discard,
+    /// 写零：不传输数据，设备把扇区清零 (REQ_OP_WRITE_ZEROES)
+    WriteZeroes,
 }
 
 struct BlockDeviceManager {
@@ -152,7 +207,7 @@ impl BlockDeviceManager {
 
     /// 注册块设备
     ///
-    pub fn register_disk(&self, disk: Box<GenDisk>) -> Result<(), &'static str> {
+    pub fn register_disk(&self, disk: Box<GenDisk>) -> Result<u32, &'static str> {
         let mut disks = self.disks.lock();
 
         // 检查设备号是否已使用
@@ -164,8 +219,9 @@ impl BlockDeviceManager {
             }
         }
 
+        let major = disk.major;
         disks.push(Some(disk));
-        Ok(())
+        Ok(major)
     }
 
     /// 查找块设备
@@ -183,13 +239,26 @@ impl BlockDeviceManager {
         None
     }
 
+    /// 已注册的块设备
+    pub fn disks(&self) -> Vec<*const GenDisk> {
+        self.disks.lock().iter().flatten().map(|gd| gd.as_ref() as *const GenDisk).collect()
+    }
+
     /// 处理 I/O 请求
+    ///
+    /// 不经请求队列直接交给驱动，没有排队时间，统计只记录设备时间
     pub fn submit_request(&self, disk: *const GenDisk, req: &mut Request) -> i32 {
         unsafe {
             let gd = &*disk;
 
             if let Some(request_fn) = gd.request_fn {
+                let bytes = req.buffer.len() + req.sg.iter().map(|&(_, len)| len).sum::<usize>();
+                crate::trace_record!(TRACE_BLOCK_RQ, req.sector, bytes, req.cmd_type as u32);
+                let sectors = if bytes != 0 { (bytes / blk_mq::SECTOR_SIZE) as u64 } else { req.nr_sectors };
+                let start = read_time();
+                gd.stats.io_start(start);
                 request_fn(req);
+                gd.stats.io_done(stat::op_stat_group(req.cmd_type), sectors, start, start, read_time());
                 0  // Success
             } else {
                 -6  // ENXIO
@@ -200,58 +269,117 @@ impl BlockDeviceManager {
 
 static BLOCK_MANAGER: BlockDeviceManager = BlockDeviceManager::new();
 
+/// 注册块设备并创建 /proc/disk_latency/<磁盘名>
 pub fn register_disk(disk: Box<GenDisk>) -> Result<(), &'static str> {
-    BLOCK_MANAGER.register_disk(disk)
+    let major = BLOCK_MANAGER.register_disk(disk)?;
+    crate::fs::procfs::register_disk_proc(major);
+    Ok(())
 }
 
 pub fn get_disk(major: u32) -> Option<*const GenDisk> {
     BLOCK_MANAGER.get_disk(major)
 }
 
+/// 已注册的块设备
+pub fn disks() -> Vec<*const GenDisk> {
+    BLOCK_MANAGER.disks()
+}
+
+/// 在中断中遍历已注册的块设备，不等待：列表正被修改时返回 false
+pub fn try_for_each_disk(mut f: impl FnMut(&GenDisk)) -> bool {
+    match BLOCK_MANAGER.disks.try_lock() {
+        Some(disks) => {
+            disks.iter().flatten().for_each(|gd| f(gd));
+            true
+        }
+        None => false,
+    }
+}
+
 pub fn submit_request(disk: *const GenDisk, req: &mut Request) -> i32 {
     BLOCK_MANAGER.submit_request(disk, req)
 }
 
+/// 生成 /proc/diskstats 内容 (diskstats_show)
+pub fn show_diskstats() -> alloc::string::String {
+    let mut out = alloc::string::String::new();
+    for disk in disks() {
+        let gd = unsafe { &*disk };
+        out += &gd.stats.show(gd.major, gd.first_minor, gd.name);
+    }
+    out
+}
+
+/// 读取从 sector 开始的扇区 (submit_bio_wait)
 pub fn blkdev_read(disk: *const GenDisk, sector: u64, buf: &mut [u8]) -> Result<usize, i32> {
-    unsafe {
-        let _gd = &*disk;
-
-        let mut req = Request {
-            cmd_type: ReqCmd::Read,
-            sector,
-            buffer: vec![0u8; buf.len()],
-            device: disk,
-            end_io: None,
-        };
-
-        let ret = submit_request(disk, &mut req);
-        if ret < 0 {
-            return Err(ret);
-        }
+    let gd = unsafe { &*disk };
+    let len = buf.len();
+    let mut plug = BlkPlug::new(gd);
+    plug.read(sector, buf);
+    plug.finish().map(|_| len)
+}
+
+/// 写入从 sector 开始的扇区 (submit_bio_wait)
+pub fn blkdev_write(disk: *const GenDisk, sector: u64, buf: &[u8]) -> Result<usize, i32> {
+    let gd = unsafe { &*disk };
+    let mut plug = BlkPlug::new(gd);
+    plug.write(sector, buf);
+    plug.finish().map(|_| buf.len())
+}
 
-        // 复制数据
-        buf.copy_from_slice(&req.buffer);
-        Ok(buf.len())
+/// 刷新设备的写缓存，并发的调用合并为一次 FLUSH (blkdev_issue_flush)
+///
+/// 调用者在自己的写完成之后领取序号，持锁后若已有一次在领号之后开始的刷新完成则直接返回，
+/// 否则发出一次覆盖目前所有领号者的刷新。设备正在刷新时到来的调用者在锁上等待，
+/// 之后由其中一个发出下一次刷新，fsync 密集时每轮只有一个 FLUSH 请求
+pub fn blkdev_issue_flush(disk: *const GenDisk) -> Result<(), i32> {
+    let gd = unsafe { &*disk };
+    let ticket = gd.flush_requested.fetch_add(1, Ordering::AcqRel) + 1;
+    let _guard = gd.flush_mutex.guard();
+    if gd.flush_completed.load(Ordering::Acquire) >= ticket {
+        return Ok(());
     }
+    let covered = gd.flush_requested.load(Ordering::Acquire);
+    let mut plug = BlkPlug::new(gd);
+    plug.flush_cache();
+    plug.finish()?;
+    gd.nr_flushes.fetch_add(1, Ordering::Relaxed);
+    gd.flush_completed.fetch_max(covered, Ordering::Release);
+    Ok(())
 }
 
-pub fn blkdev_write(disk: *const GenDisk, sector: u64, buf: &[u8]) -> Result<usize, i32> {
-    unsafe {
-        let _gd = &*disk;
-
-        let mut req = Request {
-            cmd_type: ReqCmd::Write,
-            sector,
-            buffer: buf.to_vec(),
-            device: disk,
-            end_io: None,
-        };
-
-        let ret = submit_request(disk, &mut req);
-        if ret < 0 {
-            return Err(ret);
-        }
+/// 丢弃 [sector, sector + nr_sectors) (blkdev_issue_discard)
+///
+/// # 返回
+/// 设备不支持 Discard 时返回 -EOPNOTSUPP
+pub fn blkdev_issue_discard(disk: *const GenDisk, sector: u64, nr_sectors: u64) -> Result<(), i32> {
+    let gd = unsafe { &*disk };
+    if gd.max_discard_sectors == 0 {
+        return Err(crate::errno::Errno::OperationNotSupported.as_neg_i32());
+    }
+    let mut plug = BlkPlug::new(gd);
+    plug.discard(sector, nr_sectors);
+    plug.finish()
+}
 
-        Ok(buf.len())
+/// 把 [sector, sector + nr_sectors) 清零 (blkdev_issue_zeroout)
+///
+/// 设备支持 WriteZeroes 时不传输数据，否则写入零页 (__blkdev_issue_zero_pages)
+pub fn blkdev_issue_zeroout(disk: *const GenDisk, sector: u64, nr_sectors: u64) -> Result<(), i32> {
+    let gd = unsafe { &*disk };
+    if gd.max_write_zeroes_sectors != 0 {
+        let mut plug = BlkPlug::new(gd);
+        plug.write_zeroes(sector, nr_sectors);
+        return plug.finish();
+    }
+    let chunk = nr_sectors.min(blk_mq::BLK_MAX_SECTORS);
+    let zeroes = alloc::vec![0u8; chunk as usize * blk_mq::SECTOR_SIZE];
+    let mut plug = BlkPlug::new(gd);
+    let mut done = 0;
+    while done < nr_sectors {
+        let n = (nr_sectors - done).min(chunk);
+        plug.write(sector + done, &zeroes[..n as usize * blk_mq::SECTOR_SIZE]);
+        done += n;
     }
+    plug.finish()
 }
@@ -0,0 +1,277 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 块设备 I/O 统计 (struct disk_stats)
+//!
+//! 参考 Linux: block/blk-core.c (update_io_ticks), block/blk-mq.c (blk_account_io_done),
+//! block/genhd.c (diskstats_show), tools/bcc/biolatency
+//!
+//! 每个磁盘按操作组（读、写、Discard、Flush）记录完成的请求数、合并的 bio 数、扇区数
+//! 和从提交到完成的时间，以及在队列中的请求数与设备忙的时间，由 /proc/diskstats 导出。
+//!
+//! 请求的三个时间点都用 rdtime 读取：bio 提交 (blk_account_io_start)、交给驱动
+//! (io_start_time_ns)、驱动完成 (blk_account_io_done)；前两者之差是排队时间，后两者之差是
+//! 设备时间，各自按操作组记入微秒数的 log2 直方图，由 /proc/disk_latency/<磁盘名> 导出。
+//! 合并进已有请求的 bio 不单独计时，请求的提交时间取其中最早的 bio
+//!
+//! 向 /proc/disk_latency/<磁盘名> 写入 `reset` 清零直方图，/proc/diskstats 的计数不清零
+
+use alloc::format;
+use alloc::string::String;
+use core::fmt::Write;
+use core::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+
+use super::ReqCmd;
+use crate::drivers::timer::CLOCK_FREQ;
+
+/// 操作组 (enum stat_group)
+pub const STAT_READ: usize = 0;
+pub const STAT_WRITE: usize = 1;
+pub const STAT_DISCARD: usize = 2;
+pub const STAT_FLUSH: usize = 3;
+pub const NR_STAT_GROUPS: usize = 4;
+
+const GROUP_NAMES: [&str; NR_STAT_GROUPS] = ["read", "write", "discard", "flush"];
+
+/// 直方图桶数
+///
+/// 第 0 桶统计不足 1 微秒的请求，第 i 桶统计 [2^(i-1), 2^i) 微秒，
+/// 最后一桶包含更长的请求
+pub const LAT_BUCKETS: usize = 24;
+
+/// 每微秒的 timer 计数
+const TICKS_PER_US: u64 = CLOCK_FREQ / 1_000_000;
+
+/// 每毫秒的 timer 计数
+const TICKS_PER_MS: u64 = CLOCK_FREQ / 1_000;
+
+/// 请求的操作组 (op_stat_group)；WriteZeroes 按写统计
+#[inline]
+pub fn op_stat_group(op: ReqCmd) -> usize {
+    match op {
+        ReqCmd::Read => STAT_READ,
+        ReqCmd::Write | ReqCmd::WriteZeroes => STAT_WRITE,
+        ReqCmd::Discard => STAT_DISCARD,
+        ReqCmd::Flush => STAT_FLUSH,
+    }
+}
+
+/// timer 计数所在的直方图桶
+#[inline]
+fn lat_bucket(ticks: u64) -> usize {
+    let us = ticks / TICKS_PER_US;
+    ((64 - us.leading_zeros()) as usize).min(LAT_BUCKETS - 1)
+}
+
+/// 微秒数的 log2 直方图
+pub struct LatencyHist {
+    buckets: [AtomicU64; LAT_BUCKETS],
+}
+
+impl LatencyHist {
+    pub const fn new() -> Self {
+        Self { buckets: [const { AtomicU64::new(0) }; LAT_BUCKETS] }
+    }
+
+    /// 记录一个以 timer 计数表示的时长
+    #[inline]
+    pub fn record(&self, ticks: u64) {
+        self.buckets[lat_bucket(ticks)].fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// 各桶的计数
+    pub fn snapshot(&self) -> [u64; LAT_BUCKETS] {
+        core::array::from_fn(|i| self.buckets[i].load(Ordering::Relaxed))
+    }
+
+    pub fn reset(&self) {
+        for bucket in &self.buckets {
+            bucket.store(0, Ordering::Relaxed);
+        }
+    }
+}
+
+/// 一个磁盘的统计 (struct disk_stats + block_device.bd_stamp)
+pub struct DiskStats {
+    /// 完成的请求数
+    ios: [AtomicU64; NR_STAT_GROUPS],
+    /// 并入已有请求的 bio 数
+    merges: [AtomicU64; NR_STAT_GROUPS],
+    /// 传输的扇区数
+    sectors: [AtomicU64; NR_STAT_GROUPS],
+    /// 请求从提交到完成的时间之和，timer 计数
+    ticks: [AtomicU64; NR_STAT_GROUPS],
+    /// 已提交未完成的请求数，合并掉的 bio 不算 (part_in_flight)
+    in_flight: AtomicUsize,
+    /// 有请求未完成的时间之和，timer 计数
+    io_ticks: AtomicU64,
+    /// 上次更新 io_ticks 的时刻
+    stamp: AtomicU64,
+    /// 排队时间与设备时间的直方图
+    queue_hist: [LatencyHist; NR_STAT_GROUPS],
+    device_hist: [LatencyHist; NR_STAT_GROUPS],
+}
+
+/// 汇总后的计数，单位与 /proc/diskstats 相同
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct DiskStat {
+    pub ios: [u64; NR_STAT_GROUPS],
+    pub merges: [u64; NR_STAT_GROUPS],
+    pub sectors: [u64; NR_STAT_GROUPS],
+    /// 毫秒
+    pub ms: [u64; NR_STAT_GROUPS],
+    pub in_flight: usize,
+    /// 毫秒
+    pub io_ms: u64,
+}
+
+impl DiskStats {
+    pub const fn new() -> Self {
+        Self {
+            ios: [const { AtomicU64::new(0) }; NR_STAT_GROUPS],
+            merges: [const { AtomicU64::new(0) }; NR_STAT_GROUPS],
+            sectors: [const { AtomicU64::new(0) }; NR_STAT_GROUPS],
+            ticks: [const { AtomicU64::new(0) }; NR_STAT_GROUPS],
+            in_flight: AtomicUsize::new(0),
+            io_ticks: AtomicU64::new(0),
+            stamp: AtomicU64::new(0),
+            queue_hist: [const { LatencyHist::new() }; NR_STAT_GROUPS],
+            device_hist: [const { LatencyHist::new() }; NR_STAT_GROUPS],
+        }
+    }
+
+    /// 把上次更新以来的时间记入设备忙的时间 (update_io_ticks)
+    ///
+    /// 只有一个 CPU 能把 stamp 推进到 now，其余 CPU 的同一段时间不重复计入
+    fn update_io_ticks(&self, now: u64, end: bool) {
+        let stamp = self.stamp.load(Ordering::Relaxed);
+        if now > stamp
+            && self.stamp.compare_exchange(stamp, now, Ordering::Relaxed, Ordering::Relaxed).is_ok()
+            && (end || self.in_flight.load(Ordering::Relaxed) != 0)
+        {
+            self.io_ticks.fetch_add(now - stamp, Ordering::Relaxed);
+        }
+    }
+
+    /// 一个 bio 进入块层 (blk_account_io_start)
+    #[inline]
+    pub fn io_start(&self, now: u64) {
+        self.update_io_ticks(now, false);
+        self.in_flight.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// 调度器中的合并 (blk_account_io_merge_bio)
+    ///
+    /// # 参数
+    /// - `merged`: 合并后少掉的请求数；bio 并入请求为 1，并入后又与相邻请求相接为 2
+    #[inline]
+    pub fn io_merge(&self, group: usize, merged: usize) {
+        if merged == 0 {
+            return;
+        }
+        self.merges[group].fetch_add(1, Ordering::Relaxed);
+        self.in_flight.fetch_sub(merged, Ordering::Relaxed);
+    }
+
+    /// 一个请求完成 (blk_account_io_done)
+    ///
+    /// # 参数
+    /// - `start`: 请求中最早的 bio 进入块层的时刻
+    /// - `issue`: 交给驱动的时刻
+    /// - `done`: 驱动完成的时刻
+    pub fn io_done(&self, group: usize, sectors: u64, start: u64, issue: u64, done: u64) {
+        self.ios[group].fetch_add(1, Ordering::Relaxed);
+        self.sectors[group].fetch_add(sectors, Ordering::Relaxed);
+        self.ticks[group].fetch_add(done.saturating_sub(start), Ordering::Relaxed);
+        self.queue_hist[group].record(issue.saturating_sub(start));
+        self.device_hist[group].record(done.saturating_sub(issue));
+        self.update_io_ticks(done, true);
+        self.in_flight.fetch_sub(1, Ordering::Relaxed);
+    }
+
+    /// 汇总计数 (part_stat_read_all)
+    pub fn read(&self) -> DiskStat {
+        let load = |a: &[AtomicU64; NR_STAT_GROUPS]| core::array::from_fn(|i| a[i].load(Ordering::Relaxed));
+        let ticks: [u64; NR_STAT_GROUPS] = load(&self.ticks);
+        DiskStat {
+            ios: load(&self.ios),
+            merges: load(&self.merges),
+            sectors: load(&self.sectors),
+            ms: ticks.map(|t| t / TICKS_PER_MS),
+            in_flight: self.in_flight.load(Ordering::Relaxed),
+            io_ms: self.io_ticks.load(Ordering::Relaxed) / TICKS_PER_MS,
+        }
+    }
+
+    /// 一个操作组的排队时间直方图
+    pub fn queue_hist(&self, group: usize) -> [u64; LAT_BUCKETS] {
+        self.queue_hist[group].snapshot()
+    }
+
+    /// 一个操作组的设备时间直方图
+    pub fn device_hist(&self, group: usize) -> [u64; LAT_BUCKETS] {
+        self.device_hist[group].snapshot()
+    }
+
+    /// 清零直方图
+    pub fn reset_hist(&self) {
+        for hist in self.queue_hist.iter().chain(self.device_hist.iter()) {
+            hist.reset();
+        }
+    }
+
+    /// /proc/diskstats 中的一行 (diskstats_show)
+    pub fn show(&self, major: u32, minor: u32, name: &str) -> String {
+        let s = self.read();
+        // 等待时间之和 (time_in_queue) 是各操作组的时间之和
+        let weighted: u64 = s.ms.iter().sum();
+        format!(
+            "{:>4} {:>7} {} {} {} {} {} {} {} {} {} {} {} {} {} {} {} {} {} {}\n",
+            major, minor, name,
+            s.ios[STAT_READ], s.merges[STAT_READ], s.sectors[STAT_READ], s.ms[STAT_READ],
+            s.ios[STAT_WRITE], s.merges[STAT_WRITE], s.sectors[STAT_WRITE], s.ms[STAT_WRITE],
+            s.in_flight, s.io_ms, weighted,
+            s.ios[STAT_DISCARD], s.merges[STAT_DISCARD], s.sectors[STAT_DISCARD], s.ms[STAT_DISCARD],
+            s.ios[STAT_FLUSH], s.ms[STAT_FLUSH],
+        )
+    }
+
+    /// /proc/disk_latency/<磁盘名> 的内容：每行一个 (排队/设备, 操作组) 的直方图，
+    /// 只列出有请求的操作组
+    pub fn show_latency(&self) -> String {
+        let mut out = String::new();
+        let _ = write!(out, "{:<14} {:>6}", "usecs", "<1");
+        for i in 1..LAT_BUCKETS - 1 {
+            let _ = write!(out, " {:>6}", format!("<2^{}", i));
+        }
+        let _ = writeln!(out, " {:>6}", format!(">=2^{}", LAT_BUCKETS - 2));
+        for (kind, hists) in [("queue", &self.queue_hist), ("device", &self.device_hist)] {
+            for (group, hist) in hists.iter().enumerate() {
+                let counts = hist.snapshot();
+                if counts.iter().all(|&n| n == 0) {
+                    continue;
+                }
+                let _ = write!(out, "{:<14}", format!("{} {}", kind, GROUP_NAMES[group]));
+                for n in counts {
+                    let _ = write!(out, " {:>6}", n);
+                }
+                let _ = writeln!(out);
+            }
+        }
+        out
+    }
+
+    /// 处理 /proc/disk_latency/<磁盘名> 的写入
+    ///
+    /// # 返回
+    /// 成功返回写入的字节数，格式错误返回 -EINVAL
+    pub fn write_control(&self, data: &[u8]) -> Result<usize, i32> {
+        match core::str::from_utf8(data).map(|s| s.trim()) {
+            Ok("reset") => self.reset_hist(),
+            _ => return Err(crate::errno::Errno::InvalidArgument.as_neg_i32()),
+        }
+        Ok(data.len())
+    }
+}
@@ -0,0 +1,139 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 帧缓冲区损坏区域 (damage) 记录
+//!
+//! 用户态通过 FBIO_DAMAGE 报告修改过的矩形，驱动只把这些区域传输到主机并刷新，
+//! 移动光标之类的小改动不再重传整个屏幕。
+//!
+//! 参考: drivers/gpu/drm/drm_damage_helper.c
+//!
+//! # 设计
+//! - 矩形先裁剪到屏幕范围，空矩形直接丢弃
+//! - 新矩形与已有矩形重叠时合并为外接矩形，合并后可能又与其他矩形重叠，
+//!   重复直到没有重叠，列表中的矩形两两不相交
+//! - 矩形数超过 MAX_DAMAGE_RECTS 时整体合并为一个外接矩形，一帧的命令数有上限
+
+use alloc::vec::Vec;
+
+/// 每帧最多记录的矩形数
+pub const MAX_DAMAGE_RECTS: usize = 16;
+
+/// 损坏矩形（像素坐标），与用户态 struct fb_damage_rect 布局一致
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct DamageRect {
+    pub x: u32,
+    pub y: u32,
+    pub width: u32,
+    pub height: u32,
+}
+
+impl DamageRect {
+    pub const fn new(x: u32, y: u32, width: u32, height: u32) -> Self {
+        Self { x, y, width, height }
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.width == 0 || self.height == 0
+    }
+
+    /// 右边界（不含）
+    pub fn right(&self) -> u32 {
+        self.x + self.width
+    }
+
+    /// 下边界（不含）
+    pub fn bottom(&self) -> u32 {
+        self.y + self.height
+    }
+
+    /// 像素数
+    pub fn area(&self) -> u64 {
+        self.width as u64 * self.height as u64
+    }
+
+    /// 两个矩形是否有公共像素
+    pub fn intersects(&self, other: &DamageRect) -> bool {
+        self.x < other.right() && other.x < self.right()
+            && self.y < other.bottom() && other.y < self.bottom()
+    }
+
+    /// 外接矩形
+    pub fn union(&self, other: &DamageRect) -> DamageRect {
+        let x = self.x.min(other.x);
+        let y = self.y.min(other.y);
+        DamageRect::new(x, y, self.right().max(other.right()) - x, self.bottom().max(other.bottom()) - y)
+    }
+
+    /// 裁剪到 width x height 的屏幕内 (drm_rect_clip)
+    pub fn clip(&self, width: u32, height: u32) -> DamageRect {
+        let x = self.x.min(width);
+        let y = self.y.min(height);
+        let right = (self.x as u64 + self.width as u64).min(width as u64) as u32;
+        let bottom = (self.y as u64 + self.height as u64).min(height as u64) as u32;
+        DamageRect::new(x, y, right - x, bottom - y)
+    }
+}
+
+/// 一帧内累积的损坏区域
+pub struct DamageList {
+    rects: Vec<DamageRect>,
+    width: u32,
+    height: u32,
+}
+
+impl DamageList {
+    pub const fn new(width: u32, height: u32) -> Self {
+        Self { rects: Vec::new(), width, height }
+    }
+
+    /// 设置屏幕大小，已记录的区域被丢弃
+    pub fn set_bounds(&mut self, width: u32, height: u32) {
+        self.width = width;
+        self.height = height;
+        self.rects.clear();
+    }
+
+    /// 记录一个损坏矩形，与已有矩形重叠时合并
+    pub fn add(&mut self, rect: DamageRect) {
+        let mut rect = rect.clip(self.width, self.height);
+        if rect.is_empty() {
+            return;
+        }
+        while let Some(pos) = self.rects.iter().position(|r| r.intersects(&rect)) {
+            rect = rect.union(&self.rects.swap_remove(pos));
+        }
+        self.rects.push(rect);
+        if self.rects.len() > MAX_DAMAGE_RECTS {
+            let bounding = self.bounding().unwrap();
+            self.rects.clear();
+            self.rects.push(bounding);
+        }
+    }
+
+    /// 整个屏幕都需要更新
+    pub fn add_all(&mut self) {
+        self.add(DamageRect::new(0, 0, self.width, self.height));
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.rects.is_empty()
+    }
+
+    pub fn rects(&self) -> &[DamageRect] {
+        &self.rects
+    }
+
+    /// 所有矩形的外接矩形 (drm_atomic_helper_damage_merged)
+    pub fn bounding(&self) -> Option<DamageRect> {
+        let (first, rest) = self.rects.split_first()?;
+        Some(rest.iter().fold(*first, |acc, r| acc.union(r)))
+    }
+
+    /// 取出本帧的区域并清空
+    pub fn take(&mut self) -> Vec<DamageRect> {
+        core::mem::take(&mut self.rects)
+    }
+}
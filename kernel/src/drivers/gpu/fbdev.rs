@@ -8,13 +8,35 @@
 //!
 //! 实现 兼容的 framebuffer 设备接口
 
-use super::FrameBufferInfo;
+use super::{DamageRect, FrameBufferInfo};
+use crate::arch::riscv64::uaccess::{copy_from_user, get_user};
 
 /// ioctl 命令码
 /// 获取可变屏幕信息
 pub const FBIOGET_VSCREENINFO: u32 = 0x4600;
 /// 获取固定屏幕信息
 pub const FBIOGET_FSCREENINFO: u32 = 0x4602;
+/// 报告损坏区域并刷新（Rux 扩展，参数为 struct fb_damage），返回本帧的 fence 序号
+pub const FBIO_DAMAGE: u32 = 0x46F0;
+/// 创建帧完成通知文件（Rux 扩展，参数为 O_NONBLOCK | O_CLOEXEC），返回文件描述符
+pub const FBIO_FENCE_FD: u32 = 0x46F1;
+/// 设置硬件光标（Rux 扩展，参数为 struct fb_hwcursor）
+///
+/// 不是 Linux 的 FBIO_CURSOR (_IOWR('F', 0x08, struct fb_cursor))，两者的参数布局不同
+pub const FBIO_HWCURSOR: u32 = 0x46F2;
+
+/// FBIO_DAMAGE 标志：只记录区域，留到下一次不带此标志的调用一起刷新
+pub const FB_DAMAGE_DEFER: u32 = 1;
+/// 一次 FBIO_DAMAGE 最多传入的矩形数
+pub const FB_DAMAGE_MAX_RECTS: u32 = 256;
+
+/// FBIO_HWCURSOR 的 set 位
+/// 更换图像；热点随图像一起设置
+pub const FB_HWCURSOR_SETIMAGE: u32 = 0x01;
+/// 移动光标
+pub const FB_HWCURSOR_SETPOS: u32 = 0x02;
+/// 设置热点，必须与 FB_HWCURSOR_SETIMAGE 一起使用
+pub const FB_HWCURSOR_SETHOT: u32 = 0x04;
 
 /// Framebuffer 类型
 pub const FB_TYPE_PACKED_PIXELS: u32 = 0;
@@ -174,6 +196,39 @@ impl Default for FbVarScreeninfo {
     }
 }
 
+/// FBIO_DAMAGE 参数
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct FbDamage {
+    /// rects 数组中的矩形数
+    pub num_rects: u32,
+    /// FB_DAMAGE_* 标志
+    pub flags: u32,
+    /// 用户态 struct fb_damage_rect 数组地址
+    pub rects: u64,
+}
+
+/// FBIO_HWCURSOR 参数
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct FbHwCursor {
+    /// FB_HWCURSOR_* 位
+    pub set: u32,
+    /// 0 隐藏光标，非 0 显示
+    pub enable: u32,
+    /// 热点在屏幕上的位置
+    pub x: u32,
+    pub y: u32,
+    /// 热点在图像中的位置
+    pub hot_x: u32,
+    pub hot_y: u32,
+    /// 图像尺寸，不超过 64x64
+    pub width: u32,
+    pub height: u32,
+    /// 用户态 ARGB 像素数组地址，width x height 个 u32
+    pub image: u64,
+}
+
 /// 从 FrameBufferInfo 创建 FbFixScreeninfo
 pub fn create_fix_screeninfo(info: &FrameBufferInfo) -> FbFixScreeninfo {
     let mut fix = FbFixScreeninfo::default();
@@ -235,6 +290,117 @@ pub fn fbdev_ioctl(cmd: u32, arg: usize) -> i64 {
             }
             0
         }
+        FBIO_DAMAGE => fb_damage(arg),
+        FBIO_FENCE_FD => fb_fence_fd(arg as u32),
+        FBIO_HWCURSOR => fb_hwcursor(arg),
         _ => -25, // ENOTTY: 不支持的 ioctl 命令
     }
 }
+
+/// 记录用户态报告的损坏矩形，没有 FB_DAMAGE_DEFER 时把本帧一次提交到主机
+///
+/// num_rects 为 0 时只刷新之前推迟的区域。不等待设备完成，返回本帧的 fence 序号，
+/// 没有提交命令时返回 0
+fn fb_damage(arg: usize) -> i64 {
+    let damage = match get_user::<FbDamage>(arg) {
+        Ok(damage) => damage,
+        Err(e) => return e as i64,
+    };
+    if damage.flags & !FB_DAMAGE_DEFER != 0 || damage.num_rects > FB_DAMAGE_MAX_RECTS {
+        return -22; // EINVAL
+    }
+    // 先复制全部矩形，地址无效时不留下部分区域
+    let mut rects = alloc::vec::Vec::with_capacity(damage.num_rects as usize);
+    for i in 0..damage.num_rects as usize {
+        let addr = damage.rects as usize + i * core::mem::size_of::<DamageRect>();
+        match get_user::<DamageRect>(addr) {
+            Ok(rect) => rects.push(rect),
+            Err(e) => return e as i64,
+        }
+    }
+
+    let flushed = super::with_gpu_device(|gpu| {
+        for rect in rects {
+            gpu.add_damage(rect);
+        }
+        if damage.flags & FB_DAMAGE_DEFER != 0 {
+            return Some(0);
+        }
+        gpu.flush()
+    });
+    match flushed {
+        None => -6,          // ENXIO: 没有 GPU 设备
+        Some(None) => -5,    // EIO: 控制队列不可用
+        Some(Some(fence_id)) => fence_id as i64,
+    }
+}
+
+/// 设置硬件光标 (FBIO_HWCURSOR)
+///
+/// 移动光标只改变主机叠加的位置，不需要重绘帧缓冲区，也不产生损坏区域
+fn fb_hwcursor(arg: usize) -> i64 {
+    let cursor = match get_user::<FbHwCursor>(arg) {
+        Ok(cursor) => cursor,
+        Err(e) => return e as i64,
+    };
+    let known = FB_HWCURSOR_SETIMAGE | FB_HWCURSOR_SETPOS | FB_HWCURSOR_SETHOT;
+    if cursor.set & !known != 0
+        || (cursor.set & FB_HWCURSOR_SETHOT != 0 && cursor.set & FB_HWCURSOR_SETIMAGE == 0) {
+        return -22; // EINVAL
+    }
+    let size = super::virtio_gpu::CURSOR_SIZE;
+    let mut image = alloc::vec::Vec::new();
+    if cursor.set & FB_HWCURSOR_SETIMAGE != 0 {
+        if cursor.width == 0 || cursor.height == 0 || cursor.width > size || cursor.height > size {
+            return -22; // EINVAL
+        }
+        image = alloc::vec![0u32; (cursor.width * cursor.height) as usize];
+        let bytes = unsafe {
+            core::slice::from_raw_parts_mut(image.as_mut_ptr() as *mut u8, image.len() * 4)
+        };
+        if copy_from_user(bytes, cursor.image as usize) != 0 {
+            return -14; // EFAULT
+        }
+    }
+    let (hot_x, hot_y) = if cursor.set & FB_HWCURSOR_SETHOT != 0 { (cursor.hot_x, cursor.hot_y) } else { (0, 0) };
+
+    let done = super::with_gpu_device(|gpu| {
+        if !gpu.has_cursor() {
+            return Err(-19); // ENODEV: 设备没有光标队列
+        }
+        if cursor.enable == 0 {
+            return gpu.hide_cursor().ok_or(-5);
+        }
+        if cursor.set & FB_HWCURSOR_SETPOS != 0 {
+            gpu.move_cursor(cursor.x, cursor.y).ok_or(-5)?;
+        }
+        if cursor.set & FB_HWCURSOR_SETIMAGE != 0 {
+            gpu.set_cursor_image(&image, cursor.width, cursor.height, hot_x, hot_y).ok_or(-5)
+        } else {
+            gpu.show_cursor().ok_or(-5)
+        }
+    });
+    match done {
+        None => -6, // ENXIO: 没有 GPU 设备
+        Some(Err(e)) => e,
+        Some(Ok(())) => 0,
+    }
+}
+
+/// 创建帧完成通知文件并安装到当前进程
+fn fb_fence_fd(flags: u32) -> i64 {
+    let file = match super::fence::fence_create_file(flags) {
+        Ok(file) => file,
+        Err(e) => return e as i64,
+    };
+    if flags & crate::fs::file::FileFlags::O_CLOEXEC != 0 {
+        file.set_cloexec(true);
+    }
+    match unsafe { crate::fs::file::get_file_fd_install(file.clone()) } {
+        Some(fd) => fd as i64,
+        None => {
+            crate::fs::file::fput(file);
+            -24  // EMFILE
+        }
+    }
+}
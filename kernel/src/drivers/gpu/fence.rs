@@ -0,0 +1,148 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! GPU fence 与完成通知文件
+//!
+//! 每次 FBIO_DAMAGE 刷新一帧得到一个递增的 fence 序号，设备完成整帧后发出该
+//! fence。FBIO_FENCE_FD 创建的文件在有新的 fence 完成时可读，read 返回最近完成的
+//! 序号 (u64)，合成器可以用 poll / epoll 等上一帧完成后再画下一帧。
+//!
+//! 参考: drivers/gpu/drm/virtio/virtgpu_fence.c, drivers/gpu/drm/drm_file.c (drm_read)
+//!
+//! # 设计
+//! - fence 按提交顺序完成，只记录最近完成的序号，等待者比较序号
+//! - 设备命令完成没有中断，有未完成的 fence 时由每个 jiffy 的轮询定时器回收
+//! - 每个文件记录自己读到的序号，多个文件互不影响
+
+use alloc::sync::Arc;
+use core::sync::atomic::{AtomicU64, Ordering};
+
+use crate::fs::file::{poll_mask::*, File, FileFlags, FileOps};
+use crate::fs::pipe::pipe_wait;
+use crate::fs::select::{poll_wait, PollTable};
+use crate::process::wait::WaitQueueHead;
+
+const EINTR: i32 = -4;
+const EAGAIN: i32 = -11;
+const EINVAL: i32 = -22;
+
+/// 最近完成的 fence 序号
+static LAST_SIGNALED: AtomicU64 = AtomicU64::new(0);
+
+/// 等待 fence 的读者与 poll 登记
+static FENCE_WQ: WaitQueueHead = WaitQueueHead::new();
+
+/// 最近完成的 fence 序号
+pub fn last_signaled() -> u64 {
+    LAST_SIGNALED.load(Ordering::Acquire)
+}
+
+/// fence 是否已经完成 (dma_fence_is_signaled)
+pub fn fence_signaled(seq: u64) -> bool {
+    seq <= last_signaled()
+}
+
+/// 发出 seq 及之前的所有 fence (dma_fence_signal)
+pub fn fence_signal(seq: u64) {
+    if LAST_SIGNALED.fetch_max(seq, Ordering::AcqRel) < seq {
+        FENCE_WQ.wake_up_all();
+    }
+}
+
+/// 完成通知文件
+struct FenceFile {
+    /// 本文件读到的序号
+    seen: AtomicU64,
+}
+
+fn file_fence(file: &File) -> Option<&FenceFile> {
+    let is_fence = unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &FENCE_OPS));
+    if !is_fence {
+        return None;
+    }
+    unsafe { *file.private_data.get() }.map(|ptr| unsafe { &*(ptr as *const FenceFile) })
+}
+
+/// 读取最近完成的 fence 序号
+///
+/// 缓冲区不足 8 字节返回 EINVAL；上次读取以来没有新的 fence 完成时阻塞，
+/// 非阻塞模式返回 EAGAIN
+fn fence_read(file: &File, buf: &mut [u8]) -> isize {
+    let ff = match file_fence(file) {
+        Some(ff) => ff,
+        None => return EINVAL as isize,
+    };
+    if buf.len() < 8 {
+        return EINVAL as isize;
+    }
+    let nonblock = (file.flags.bits() & FileFlags::O_NONBLOCK) != 0;
+    loop {
+        let seen = ff.seen.load(Ordering::Acquire);
+        let done = last_signaled();
+        if done > seen {
+            if ff.seen.compare_exchange(seen, done, Ordering::AcqRel, Ordering::Relaxed).is_err() {
+                continue;
+            }
+            buf[..8].copy_from_slice(&done.to_ne_bytes());
+            return 8;
+        }
+        if nonblock {
+            return EAGAIN as isize;
+        }
+        if crate::signal::signal_pending() {
+            return EINTR as isize;
+        }
+        if !pipe_wait(&FENCE_WQ, || last_signaled() > seen) {
+            return EAGAIN as isize;
+        }
+    }
+}
+
+/// 有新的 fence 完成时可读
+fn fence_poll(file: &File, pt: Option<&mut PollTable>) -> u32 {
+    let ff = match file_fence(file) {
+        Some(ff) => ff,
+        None => return 0,
+    };
+    poll_wait(&FENCE_WQ, pt);
+    if last_signaled() > ff.seen.load(Ordering::Acquire) {
+        POLLIN | POLLRDNORM
+    } else {
+        0
+    }
+}
+
+fn fence_release(file: &File) -> i32 {
+    let ptr = match unsafe { (*file.private_data.get()).take() } {
+        Some(ptr) => ptr,
+        None => return -9,  // EBADF
+    };
+    drop(unsafe { Arc::from_raw(ptr as *const FenceFile) });
+    0
+}
+
+static FENCE_OPS: FileOps = FileOps {
+    read: Some(fence_read),
+    write: None,
+    lseek: None,
+    close: Some(fence_release),
+    read_iter: None,
+    write_iter: None,
+    poll: Some(fence_poll),
+};
+
+/// 创建完成通知文件，创建之前完成的 fence 不会报告
+///
+/// # 参数
+/// - flags: O_NONBLOCK | O_CLOEXEC，CLOEXEC 由调用方在安装描述符时处理
+pub fn fence_create_file(flags: u32) -> Result<Arc<File>, i32> {
+    if flags & !(FileFlags::O_NONBLOCK | FileFlags::O_CLOEXEC) != 0 {
+        return Err(EINVAL);
+    }
+    let ff = Arc::new(FenceFile { seen: AtomicU64::new(last_signaled()) });
+    let file = Arc::new(File::new(FileFlags::new(FileFlags::O_RDONLY | (flags & FileFlags::O_NONBLOCK))));
+    file.set_ops(&FENCE_OPS);
+    file.set_private_data(Arc::into_raw(ff) as *mut u8);
+    Ok(file)
+}
@@ -11,7 +11,12 @@
 //! 当前实现：
 //! - VirtIO-GPU 驱动 (符合 VirtIO 1.2 规范)
 //! - 简化 MMIO framebuffer (QEMU RISC-V virt)
+//! - 损坏区域记录与部分刷新 (FBIO_DAMAGE)
+//! - 异步命令提交，帧完成通过 fence 文件通知 (FBIO_FENCE_FD)
+//! - 经光标队列的硬件光标 (FBIO_HWCURSOR)
 
+pub mod damage;
+pub mod fence;
 pub mod framebuffer;
 pub mod fb_simple;
 pub mod fbdev;
@@ -20,14 +25,17 @@ pub mod virtio_gpu;
 
 pub use framebuffer::{FrameBuffer, FrameBufferInfo};
 pub use fb_simple::{probe_simple_framebuffer, create_framebuffer, SimpleFrameBufferInfo};
+pub use damage::{DamageList, DamageRect, MAX_DAMAGE_RECTS};
 pub use virtio_gpu::{VirtioGpuDevice, probe_virtio_gpu};
 pub use fbdev::{
     fbdev_ioctl, create_fix_screeninfo, create_var_screeninfo,
-    FbFixScreeninfo, FbVarScreeninfo, FbBitfield,
-    FBIOGET_FSCREENINFO, FBIOGET_VSCREENINFO,
+    FbFixScreeninfo, FbVarScreeninfo, FbBitfield, FbDamage, FbHwCursor,
+    FBIOGET_FSCREENINFO, FBIOGET_VSCREENINFO, FBIO_DAMAGE, FBIO_FENCE_FD, FBIO_HWCURSOR,
+    FB_DAMAGE_DEFER, FB_HWCURSOR_SETIMAGE, FB_HWCURSOR_SETPOS, FB_HWCURSOR_SETHOT,
 };
 
 use spin::Mutex;
+use crate::time::timer::{mod_timer, TimerList};
 
 /// 全局 Framebuffer 信息存储
 /// 用于用户态通过 mmap 访问帧缓冲区
@@ -42,3 +50,41 @@ pub fn set_framebuffer_info(info: FrameBufferInfo) {
 pub fn get_framebuffer_info() -> Option<FrameBufferInfo> {
     FRAMEBUFFER_INFO.lock().clone()
 }
+
+/// 全局 VirtIO-GPU 设备（FBIO_DAMAGE 刷新时使用）
+static GPU_DEVICE: Mutex<Option<VirtioGpuDevice>> = Mutex::new(None);
+
+/// 保存初始化完成的 GPU 设备（GPU 初始化时调用）
+pub fn set_gpu_device(device: VirtioGpuDevice) {
+    *GPU_DEVICE.lock() = Some(device);
+}
+
+/// 在持有设备锁的情况下访问 GPU 设备，没有设备时返回 None
+///
+/// 返回前还有未完成的 fence 时启动轮询定时器
+pub fn with_gpu_device<R>(f: impl FnOnce(&mut VirtioGpuDevice) -> R) -> Option<R> {
+    let mut guard = GPU_DEVICE.lock();
+    let gpu = guard.as_mut()?;
+    let ret = f(gpu);
+    if gpu.fences_pending() {
+        mod_timer(&FENCE_POLL_TIMER, crate::drivers::timer::get_jiffies() + 1);
+    }
+    Some(ret)
+}
+
+/// 回收控制队列的定时器：设备完成命令没有中断，有未完成的 fence 时每个 jiffy 检查一次
+static FENCE_POLL_TIMER: TimerList = TimerList::new(fence_poll_timer, 0);
+
+fn fence_poll_timer(timer: &TimerList) {
+    // 软中断中不能等锁：持锁的一方会在返回前重新启动定时器
+    let mut guard = match GPU_DEVICE.try_lock() {
+        Some(guard) => guard,
+        None => return,
+    };
+    if let Some(gpu) = guard.as_mut() {
+        gpu.reclaim();
+        if gpu.fences_pending() {
+            mod_timer(timer, crate::drivers::timer::get_jiffies() + 1);
+        }
+    }
+}
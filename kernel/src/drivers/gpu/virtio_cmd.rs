@@ -37,6 +37,12 @@ pub mod cmd {
     pub const RESP_ERR_INVALID_PARAMETER: u32 = 0x1205;
 }
 
+/// 命令头标志
+pub mod hdr_flags {
+    /// 设备处理完此前的所有命令后才完成本命令 (VIRTIO_GPU_FLAG_FENCE)
+    pub const FENCE: u32 = 1 << 0;
+}
+
 /// 格式常量
 pub mod format {
     pub const B8G8R8A8_UNORM: u32 = 1;
@@ -6,15 +6,35 @@
 //!
 //! 实现 VirtIO-GPU PCI 设备的初始化和 framebuffer 管理
 //! 参考: VirtIO 1.2 规范
+//!
+//! 刷新只传输损坏区域：每个矩形一条 TRANSFER_TO_HOST_2D 和一条 RESOURCE_FLUSH，
+//! 一帧的所有命令一次放入控制队列、只通知设备一次
+//!
+//! # 命令提交
+//! - 命令和响应缓冲区属于 PendingCmd，在设备完成之前一直保留；描述符由队列的
+//!   空闲链表分配，前一帧未完成时可以继续提交下一帧
+//! - 一帧的最后一条命令带 VIRTIO_GPU_FLAG_FENCE 和递增的 fence_id，设备处理完它
+//!   之前的所有命令后才完成它，回收到它时发出该 fence (virtio_gpu_fence_event_process)
+//! - 初始化阶段的命令仍然同步等待自己的响应
+//!
+//! # 硬件光标
+//! - 光标是一个 64x64 的独立资源，由主机叠加在扫描输出上，移动光标不改动帧缓冲区
+//! - 换图像时先在控制队列同步传输资源，再在光标队列发送 UPDATE_CURSOR；
+//!   两个队列之间没有顺序，传输必须先完成 (virtio_gpu_cursor_plane_update)
+//! - 移动只发送一条 MOVE_CURSOR；光标队列的命令没有响应，设备用完即回收
 
 use crate::println;
 use crate::drivers::pci::{self, virtio_device};
 use crate::drivers::virtio::virtio_pci::{VirtIOPCI, status};
 use crate::drivers::virtio::queue::VirtQueue;
 use crate::drivers::virtio::offset;
+use super::damage::{DamageList, DamageRect};
+use super::fence;
 use super::framebuffer::{FrameBuffer, FrameBufferInfo};
-use super::virtio_cmd::cmd;
+use super::virtio_cmd::{cmd, hdr_flags};
 use alloc::alloc::{alloc_zeroed, dealloc, Layout};
+use alloc::collections::BTreeMap;
+use alloc::vec::Vec;
 use core::ptr::{read_volatile, write_volatile};
 use core::sync::atomic::{fence, Ordering};
 
@@ -25,12 +45,21 @@ const VIRTIO_GPU_PCI_VENDOR: u16 = 0x1AF4;
 const CTRL_QUEUE: u16 = 0;   // 控制队列
 const CURSOR_QUEUE: u16 = 1; // 光标队列
 
+/// 扫描输出资源与光标资源的 ID
+const SCANOUT_RESOURCE_ID: u32 = 1;
+const CURSOR_RESOURCE_ID: u32 = 2;
+
+/// 光标资源的边长，设备只支持 64x64
+pub const CURSOR_SIZE: u32 = 64;
+
 /// VirtIO-GPU 设备
 pub struct VirtioGpuDevice {
     /// VirtIO PCI 设备
     pci: VirtIOPCI,
     /// 控制队列
     ctrl_queue: Option<VirtQueue>,
+    /// 光标队列，设备没有时为 None
+    cursor_queue: Option<VirtQueue>,
     /// 帧缓冲区信息
     fb_info: Option<FrameBufferInfo>,
     /// 帧缓冲区指针
@@ -41,6 +70,40 @@ pub struct VirtioGpuDevice {
     resource_id: u32,
     /// 显示矩形
     display_rect: Rect,
+    /// 本帧的损坏区域
+    damage: DamageList,
+    /// 已提交、设备尚未完成的命令，按 add_buf 的 token
+    pending: BTreeMap<usize, PendingCmd>,
+    /// 同步命令完成后的响应，等待者取走
+    done: BTreeMap<usize, Vec<u8>>,
+    /// 下一个命令 token
+    next_token: usize,
+    /// 最近分配的 fence_id
+    last_fence: u64,
+    /// 设备返回错误响应的命令数
+    nr_errors: u64,
+    /// 光标资源的后备内存，CURSOR_SIZE x CURSOR_SIZE 个 B8G8R8A8 像素
+    cursor_ptr: *mut u8,
+    /// 设备尚未用完的光标命令，按 add_buf 的 token
+    cursor_pending: BTreeMap<usize, Vec<u8>>,
+    /// 光标资源已创建并附加后备内存
+    cursor_resource: bool,
+    /// 当前光标：位置、热点与是否显示
+    cursor_pos: (u32, u32),
+    cursor_hot: (u32, u32),
+    cursor_visible: bool,
+}
+
+/// 一条在途命令 (struct virtio_gpu_vbuffer)
+struct PendingCmd {
+    /// 命令，设备读取
+    cmd: Vec<u8>,
+    /// 响应，设备写入
+    resp: Vec<u8>,
+    /// 带 fence 时为其 fence_id，否则为 0
+    fence_id: u64,
+    /// 有同步等待者，完成后响应放入 done
+    sync: bool,
 }
 
 /// VirtIO-GPU 命令头 (24 字节)
@@ -53,6 +116,18 @@ struct GpuCtrlHeader {
     padding: u32,
 }
 
+impl GpuCtrlHeader {
+    const fn new(hdr_type: u32) -> Self {
+        Self { hdr_type, flags: 0, fence_id: 0, ctx_id: 0, padding: 0 }
+    }
+
+    /// 带 fence 的命令头，fence_id 为 0 时不带 fence
+    const fn fenced(hdr_type: u32, fence_id: u64) -> Self {
+        let flags = if fence_id != 0 { hdr_flags::FENCE } else { 0 };
+        Self { hdr_type, flags, fence_id, ctx_id: 0, padding: 0 }
+    }
+}
+
 /// 矩形结构 (16 字节)
 #[repr(C)]
 #[derive(Debug, Clone, Copy, Default)]
@@ -63,6 +138,12 @@ struct Rect {
     height: u32,
 }
 
+impl From<DamageRect> for Rect {
+    fn from(r: DamageRect) -> Self {
+        Rect { x: r.x, y: r.y, width: r.width, height: r.height }
+    }
+}
+
 /// 单个显示输出配置 (24 字节)
 #[repr(C)]
 #[derive(Debug, Clone, Copy, Default)]
@@ -137,6 +218,28 @@ struct CmdTransferToHost2d {
     padding: u32,
 }
 
+/// 光标位置 (16 字节)
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+struct CursorPos {
+    scanout_id: u32,
+    x: u32,
+    y: u32,
+    padding: u32,
+}
+
+/// UPDATE_CURSOR / MOVE_CURSOR 命令 (56 字节)
+/// VirtIO 1.2 规范: header(24) + pos(16) + resource_id(4) + hot_x(4) + hot_y(4) + padding(4)
+#[repr(C)]
+struct CmdUpdateCursor {
+    header: GpuCtrlHeader,
+    pos: CursorPos,
+    resource_id: u32,
+    hot_x: u32,
+    hot_y: u32,
+    padding: u32,
+}
+
 /// 通用响应 (24 字节)
 #[repr(C)]
 struct RespNoData {
@@ -146,17 +249,41 @@ struct RespNoData {
 unsafe impl Send for VirtioGpuDevice {}
 unsafe impl Sync for VirtioGpuDevice {}
 
+/// 内核虚拟地址转换为设备使用的物理地址
+fn dma_addr<T>(ptr: *const T) -> u64 {
+    #[cfg(feature = "riscv64")]
+    let phys = crate::arch::riscv64::mm::virt_to_phys(
+        crate::arch::riscv64::mm::VirtAddr::new(ptr as u64)
+    ).0;
+    #[cfg(not(feature = "riscv64"))]
+    let phys = ptr as u64;
+    phys
+}
+
 impl VirtioGpuDevice {
     /// 创建新的 VirtIO-GPU 设备
     pub fn new(pci: VirtIOPCI) -> Option<Self> {
         let mut device = Self {
             pci,
             ctrl_queue: None,
+            cursor_queue: None,
             fb_info: None,
             fb_ptr: core::ptr::null_mut(),
             fb_layout: None,
-            resource_id: 1,
+            resource_id: SCANOUT_RESOURCE_ID,
             display_rect: Rect::default(),
+            damage: DamageList::new(0, 0),
+            pending: BTreeMap::new(),
+            done: BTreeMap::new(),
+            next_token: 1,
+            last_fence: 0,
+            nr_errors: 0,
+            cursor_ptr: core::ptr::null_mut(),
+            cursor_pending: BTreeMap::new(),
+            cursor_resource: false,
+            cursor_pos: (0, 0),
+            cursor_hot: (0, 0),
+            cursor_visible: false,
         };
 
         // 初始化 VirtIO 设备
@@ -168,8 +295,6 @@ impl VirtioGpuDevice {
     /// 初始化 VirtIO 设备
     fn init_virtio(&mut self) -> Option<()> {
         let common_cfg = self.pci.common_cfg_bar + self.pci.common_cfg_offset as u64;
-        let notify_base = self.pci.notify_cfg_bar + self.pci.notify_cfg_offset as u64;
-        let isr_base = self.pci.isr_cfg_bar + self.pci.isr_cfg_offset as u64;
 
         // 步骤 1: 重置设备
         unsafe {
@@ -219,9 +344,31 @@ impl VirtioGpuDevice {
             return None;
         }
 
-        // 步骤 8: 初始化控制队列
+        // 步骤 8: 初始化控制队列和光标队列，光标队列不可用时只用软件光标
+        self.ctrl_queue = Some(self.setup_queue(CTRL_QUEUE)?);
+        self.cursor_queue = self.setup_queue(CURSOR_QUEUE);
+
+        // 步骤 9: 设置 DRIVER_OK
         unsafe {
-            write_volatile((common_cfg + offset::COMMON_CFG_QUEUE_SELECT as u64) as *mut u16, CTRL_QUEUE);
+            write_volatile((common_cfg + offset::DEVICE_STATUS as u64) as *mut u8,
+                (status::ACKNOWLEDGE | status::DRIVER | status::FEATURES_OK | status::DRIVER_OK) as u8);
+        }
+        fence(Ordering::SeqCst);
+
+        Some(())
+    }
+
+    /// 初始化一个虚拟队列并启用
+    ///
+    /// # 返回
+    /// 设备没有该队列或分配失败时返回 None
+    fn setup_queue(&mut self, index: u16) -> Option<VirtQueue> {
+        let common_cfg = self.pci.common_cfg_bar + self.pci.common_cfg_offset as u64;
+        let notify_base = self.pci.notify_cfg_bar + self.pci.notify_cfg_offset as u64;
+        let isr_base = self.pci.isr_cfg_bar + self.pci.isr_cfg_offset as u64;
+
+        unsafe {
+            write_volatile((common_cfg + offset::COMMON_CFG_QUEUE_SELECT as u64) as *mut u16, index);
         }
         fence(Ordering::SeqCst);
 
@@ -233,11 +380,11 @@ impl VirtioGpuDevice {
 
         // 根据 VirtIO 1.0 规范，通知地址偏移需要乘以 2
         // 因为 notify_off_multiplier 是以 16 位为单位
-        let notify_offset = (CTRL_QUEUE as u64) * (self.pci.notify_off_multiplier as u64) * 2;
+        let notify_offset = (index as u64) * (self.pci.notify_off_multiplier as u64) * 2;
 
         let queue = VirtQueue::new(
             queue_size,
-            CTRL_QUEUE,
+            index,
             notify_base + notify_offset,
             isr_base,
             isr_base + 4,
@@ -279,16 +426,7 @@ impl VirtioGpuDevice {
         }
         fence(Ordering::SeqCst);
 
-        self.ctrl_queue = Some(queue);
-
-        // 步骤 9: 设置 DRIVER_OK
-        unsafe {
-            write_volatile((common_cfg + offset::DEVICE_STATUS as u64) as *mut u8,
-                (status::ACKNOWLEDGE | status::DRIVER | status::FEATURES_OK | status::DRIVER_OK) as u8);
-        }
-        fence(Ordering::SeqCst);
-
-        Some(())
+        Some(queue)
     }
 
     /// 初始化帧缓冲区并发送 GPU 命令
@@ -325,7 +463,7 @@ impl VirtioGpuDevice {
         self.fb_layout = Some(layout);
 
         // 步骤 3: 创建 2D 资源
-        self.create_resource_2d(width, height)?;
+        self.create_resource_2d(self.resource_id, width, height)?;
 
         // 步骤 4: 附加后备存储（使用物理地址）
         #[cfg(feature = "riscv64")]
@@ -335,7 +473,7 @@ impl VirtioGpuDevice {
         #[cfg(not(feature = "riscv64"))]
         let fb_phys = fb_ptr as u64;
 
-        self.attach_backing(fb_phys, fb_size as u32)?;
+        self.attach_backing(self.resource_id, fb_phys, fb_size as u32)?;
 
         // 步骤 5: 传输帧缓冲区到设备
         let full_rect = Rect {
@@ -348,6 +486,7 @@ impl VirtioGpuDevice {
 
         // 步骤 6: 设置扫描输出
         self.set_scanout(0, self.resource_id, &full_rect)?;
+        self.damage.set_bounds(self.display_rect.width, self.display_rect.height);
 
         // 保存帧缓冲区信息
         self.fb_info = Some(FrameBufferInfo {
@@ -363,7 +502,7 @@ impl VirtioGpuDevice {
     }
 
     /// 获取显示信息
-    fn get_display_info(&self) -> Option<RespDisplayInfo> {
+    fn get_display_info(&mut self) -> Option<RespDisplayInfo> {
         let cmd = GpuCtrlHeader {
             hdr_type: cmd::GET_DISPLAY_INFO,
             flags: 0,
@@ -394,7 +533,7 @@ impl VirtioGpuDevice {
     }
 
     /// 创建 2D 资源
-    fn create_resource_2d(&self, width: u32, height: u32) -> Option<()> {
+    fn create_resource_2d(&mut self, resource_id: u32, width: u32, height: u32) -> Option<()> {
         let cmd = CmdResourceCreate2d {
             header: GpuCtrlHeader {
                 hdr_type: cmd::RESOURCE_CREATE_2D,
@@ -403,7 +542,7 @@ impl VirtioGpuDevice {
                 ctx_id: 0,
                 padding: 0,
             },
-            resource_id: self.resource_id,
+            resource_id,
             format: 1, // B8G8R8A8_UNORM
             width,
             height,
@@ -430,7 +569,7 @@ impl VirtioGpuDevice {
     }
 
     /// 附加后备存储
-    fn attach_backing(&self, addr: u64, size: u32) -> Option<()> {
+    fn attach_backing(&mut self, resource_id: u32, addr: u64, size: u32) -> Option<()> {
         let cmd = CmdResourceAttachBacking {
             header: GpuCtrlHeader {
                 hdr_type: cmd::RESOURCE_ATTACH_BACKING,
@@ -439,7 +578,7 @@ impl VirtioGpuDevice {
                 ctx_id: 0,
                 padding: 0,
             },
-            resource_id: self.resource_id,
+            resource_id,
             nr_entries: 1,
             entry: MemEntry {
                 addr,
@@ -469,7 +608,7 @@ impl VirtioGpuDevice {
     }
 
     /// 设置扫描输出
-    fn set_scanout(&self, scanout_id: u32, resource_id: u32, rect: &Rect) -> Option<()> {
+    fn set_scanout(&mut self, scanout_id: u32, resource_id: u32, rect: &Rect) -> Option<()> {
         let cmd = CmdSetScanout {
             header: GpuCtrlHeader {
                 hdr_type: cmd::SET_SCANOUT,
@@ -504,7 +643,7 @@ impl VirtioGpuDevice {
     }
 
     /// 传输数据到主机
-    fn transfer_to_host_2d(&self, resource_id: u32, offset: u64, rect: &Rect) -> Option<()> {
+    fn transfer_to_host_2d(&mut self, resource_id: u32, offset: u64, rect: &Rect) -> Option<()> {
         let cmd = CmdTransferToHost2d {
             header: GpuCtrlHeader {
                 hdr_type: cmd::TRANSFER_TO_HOST_2D,
@@ -539,105 +678,315 @@ impl VirtioGpuDevice {
         Some(())
     }
 
-    /// 发送命令到 VirtIO-GPU
-    fn send_command<CMD, RESP>(&self,
+    /// 把命令放入控制队列，不通知设备 (virtio_gpu_queue_ctrl_buffer)
+    ///
+    /// 队列满时先通知设备并回收已完成的命令，等到有空闲描述符为止
+    ///
+    /// # 返回
+    /// 命令的 token；设备长时间不完成时返回 None
+    fn queue_cmd<CMD>(&mut self, cmd: &CMD, cmd_size: usize, resp_size: usize,
+                      fence_id: u64, sync: bool) -> Option<usize> {
+        let bytes = unsafe { core::slice::from_raw_parts(cmd as *const CMD as *const u8, cmd_size) };
+        let pending = PendingCmd {
+            cmd: bytes.to_vec(),
+            resp: alloc::vec![0u8; resp_size],
+            fence_id,
+            sync,
+        };
+        let token = self.next_token;
+        let bufs = [
+            (dma_addr(pending.cmd.as_ptr()), cmd_size as u32, false),
+            (dma_addr(pending.resp.as_ptr()), resp_size as u32, true),
+        ];
+
+        for _ in 0..100000 {
+            let queue = self.ctrl_queue.as_mut()?;
+            if queue.add_buf(&bufs, token).is_some() {
+                self.next_token += 1;
+                self.pending.insert(token, pending);
+                return Some(token);
+            }
+            // 没有空闲描述符：让设备处理已提交的命令
+            queue.kick();
+            core::hint::spin_loop();
+            self.reclaim();
+        }
+        None
+    }
+
+    /// 回收设备已完成的命令 (virtio_gpu_dequeue_ctrl_func)
+    ///
+    /// 检查响应、发出完成的 fence，同步命令的响应留给等待者
+    ///
+    /// # 返回
+    /// 回收的命令数
+    pub fn reclaim(&mut self) -> usize {
+        let queue = match self.ctrl_queue.as_mut() {
+            Some(queue) => queue,
+            None => return 0,
+        };
+        let mut count = 0;
+        let mut signaled = 0;
+        while let Some((token, _len)) = queue.get_buf() {
+            count += 1;
+            let pending = match self.pending.remove(&token) {
+                Some(pending) => pending,
+                None => continue,
+            };
+            if pending.sync {
+                self.done.insert(token, pending.resp);
+                continue;
+            }
+            let hdr_type = u32::from_ne_bytes(pending.resp[..4].try_into().unwrap());
+            if hdr_type != cmd::RESP_OK_NODATA {
+                self.nr_errors += 1;
+            }
+            signaled = signaled.max(pending.fence_id);
+        }
+        // fence 按提交顺序完成，只需发出最大的一个
+        if signaled != 0 {
+            fence::fence_signal(signaled);
+        }
+        count
+    }
+
+    /// 是否还有设备未完成的带 fence 命令
+    pub fn fences_pending(&self) -> bool {
+        self.last_fence > fence::last_signaled()
+    }
+
+    /// 最近分配的 fence_id
+    pub fn last_fence(&self) -> u64 {
+        self.last_fence
+    }
+
+    /// 设备返回错误响应的命令数
+    pub fn nr_errors(&self) -> u64 {
+        self.nr_errors
+    }
+
+    /// 发送命令到 VirtIO-GPU 并等待响应
+    fn send_command<CMD, RESP>(&mut self,
                                cmd: &CMD,
                                cmd_size: usize,
                                resp: &mut RESP,
                                resp_size: usize) -> Option<()> {
-        let queue = self.ctrl_queue.as_ref()?;
+        let token = self.queue_cmd(cmd, cmd_size, resp_size, 0, true)?;
+        self.ctrl_queue.as_mut()?.kick();
 
-        // 将虚拟地址转换为物理地址
-        #[cfg(feature = "riscv64")]
-        let cmd_phys = crate::arch::riscv64::mm::virt_to_phys(
-            crate::arch::riscv64::mm::VirtAddr::new(cmd as *const CMD as u64)
-        ).0;
-        #[cfg(feature = "riscv64")]
-        let resp_phys = crate::arch::riscv64::mm::virt_to_phys(
-            crate::arch::riscv64::mm::VirtAddr::new(resp as *mut RESP as u64)
-        ).0;
+        // 等待响应 (简单轮询)
+        for _ in 0..100000 {
+            fence(Ordering::SeqCst);
+            self.reclaim();
+            if let Some(bytes) = self.done.remove(&token) {
+                unsafe {
+                    core::ptr::copy_nonoverlapping(bytes.as_ptr(), resp as *mut RESP as *mut u8, resp_size);
+                }
+                return Some(());
+            }
+        }
 
-        #[cfg(not(feature = "riscv64"))]
-        let cmd_phys = cmd as *const CMD as u64;
-        #[cfg(not(feature = "riscv64"))]
-        let resp_phys = resp as *mut RESP as u64;
+        None
+    }
 
-        // 使用第一个描述符发送命令，第二个描述符接收响应
-        unsafe {
-            // 设置命令描述符
-            let desc0 = &mut *queue.desc.add(0);
-            desc0.addr = cmd_phys;
-            desc0.len = cmd_size as u32;
-            desc0.flags = 0x01; // VIRTQ_DESC_F_NEXT
-            desc0.next = 1;
-
-            // 设置响应描述符
-            let desc1 = &mut *queue.desc.add(1);
-            desc1.addr = resp_phys;
-            desc1.len = resp_size as u32;
-            desc1.flags = 0x02; // VIRTQ_DESC_F_WRITE
-            desc1.next = 0;
-
-            // 更新可用环
-            // AvailRing 结构: flags (u16) + idx (u16) + ring[] (u16 array)
-            // ring 数组从偏移 4 开始
-            let avail = &mut *queue.avail;
-            let idx = avail.idx as usize;
-            let ring_idx = idx % queue.queue_size as usize;
-
-            // ring 数组紧跟在 AvailRing 结构体后面
-            let ring_ptr = (queue.avail as *mut u8).add(4) as *mut u16;
-            write_volatile(ring_ptr.add(ring_idx), 0); // 描述符索引 0
-            fence(Ordering::SeqCst);
-            avail.idx = avail.idx.wrapping_add(1);
-            fence(Ordering::SeqCst);
+    /// 记录一个损坏矩形，下一次 flush 时更新
+    pub fn add_damage(&mut self, rect: DamageRect) {
+        self.damage.add(rect);
+    }
 
-            // 通知设备
-            queue.notify();
-            fence(Ordering::SeqCst);
+    /// 下一次 flush 更新整个屏幕
+    pub fn damage_all(&mut self) {
+        self.damage.add_all();
+    }
 
-            // 等待响应 (简单轮询)
-            for _ in 0..100000 {
-                fence(Ordering::SeqCst);
-                let used = &*queue.used;
-                if used.idx as usize >= idx + 1 {
-                    return Some(());
-                }
+    /// 本帧待更新的区域
+    pub fn damage(&self) -> &DamageList {
+        &self.damage
+    }
+
+    /// 刷新显示：只传输并刷新本帧的损坏区域
+    ///
+    /// 一帧的命令放入队列后只通知设备一次，不等待完成；最后一条 RESOURCE_FLUSH 带
+    /// fence，设备完成整帧后由 reclaim 发出
+    ///
+    /// # 返回
+    /// 本帧的 fence_id，没有损坏区域时返回 0；没有帧缓冲区或队列不可用时返回 None
+    pub fn flush(&mut self) -> Option<u64> {
+        let stride = self.fb_info.as_ref()?.stride;
+        self.reclaim();
+        let rects = self.damage.take();
+        if rects.is_empty() {
+            return Some(0);
+        }
+        self.last_fence += 1;
+        let fence_id = self.last_fence;
+
+        // 用户态通过可缓存映射写入的像素在传输命令之前对设备可见 (dma_wmb)；
+        // virtio 设备与 CPU 缓存一致，不需要按行写回缓存
+        fence(Ordering::Release);
+
+        // 先传输全部区域再刷新，设备按提交顺序处理
+        for r in &rects {
+            let transfer = CmdTransferToHost2d {
+                header: GpuCtrlHeader::new(cmd::TRANSFER_TO_HOST_2D),
+                rect: Rect::from(*r),
+                offset: r.y as u64 * stride as u64 + r.x as u64 * 4,
+                resource_id: self.resource_id,
+                padding: 0,
+            };
+            self.queue_cmd(&transfer, core::mem::size_of::<CmdTransferToHost2d>(),
+                           core::mem::size_of::<RespNoData>(), 0, false)?;
+        }
+        for (i, r) in rects.iter().enumerate() {
+            let fence_id = if i + 1 == rects.len() { fence_id } else { 0 };
+            let flush = CmdResourceFlush {
+                header: GpuCtrlHeader::fenced(cmd::RESOURCE_FLUSH, fence_id),
+                resource_id: self.resource_id,
+                padding: 0,
+                rect: Rect::from(*r),
+            };
+            self.queue_cmd(&flush, core::mem::size_of::<CmdResourceFlush>(),
+                           core::mem::size_of::<RespNoData>(), fence_id, false)?;
+        }
+
+        self.ctrl_queue.as_mut()?.kick();
+        Some(fence_id)
+    }
+
+    /// 是否有光标队列，没有时只能用软件光标
+    pub fn has_cursor(&self) -> bool {
+        self.cursor_queue.is_some()
+    }
+
+    /// 设置光标图像并显示 (virtio_gpu_cursor_plane_update)
+    ///
+    /// # 参数
+    /// - `image`: width x height 个 ARGB 像素，按行排列；超出部分透明
+    /// - `hot_x`, `hot_y`: 热点在图像中的位置，光标位置指向热点
+    ///
+    /// # 返回
+    /// 图像超过 CURSOR_SIZE、没有光标队列或设备不响应时返回 None
+    pub fn set_cursor_image(&mut self, image: &[u32], width: u32, height: u32,
+                            hot_x: u32, hot_y: u32) -> Option<()> {
+        if self.cursor_queue.is_none() || width > CURSOR_SIZE || height > CURSOR_SIZE
+            || image.len() < (width * height) as usize {
+            return None;
+        }
+        let size = (CURSOR_SIZE * CURSOR_SIZE * 4) as usize;
+        if self.cursor_ptr.is_null() {
+            let layout = Layout::from_size_align(size, 4096).ok()?;
+            let ptr = unsafe { alloc_zeroed(layout) };
+            if ptr.is_null() {
+                return None;
             }
+            self.cursor_ptr = ptr;
+        }
+        if !self.cursor_resource {
+            self.create_resource_2d(CURSOR_RESOURCE_ID, CURSOR_SIZE, CURSOR_SIZE)?;
+            self.attach_backing(CURSOR_RESOURCE_ID, dma_addr(self.cursor_ptr), size as u32)?;
+            self.cursor_resource = true;
+        }
 
-            None
+        let pixels = unsafe {
+            core::slice::from_raw_parts_mut(self.cursor_ptr as *mut u32, (CURSOR_SIZE * CURSOR_SIZE) as usize)
+        };
+        for (y, row) in pixels.chunks_mut(CURSOR_SIZE as usize).enumerate() {
+            row.fill(0);
+            if (y as u32) < height {
+                let src = &image[y * width as usize..(y + 1) * width as usize];
+                row[..width as usize].copy_from_slice(src);
+            }
         }
+
+        // 光标队列与控制队列之间没有顺序，必须等传输完成后再更新光标
+        fence(Ordering::Release);
+        let rect = Rect { x: 0, y: 0, width: CURSOR_SIZE, height: CURSOR_SIZE };
+        self.transfer_to_host_2d(CURSOR_RESOURCE_ID, 0, &rect)?;
+
+        self.cursor_hot = (hot_x.min(CURSOR_SIZE - 1), hot_y.min(CURSOR_SIZE - 1));
+        self.cursor_visible = true;
+        self.update_cursor(cmd::UPDATE_CURSOR, CURSOR_RESOURCE_ID)
     }
 
-    /// 刷新显示
-    pub fn flush(&self) {
-        let rect = self.display_rect;
+    /// 移动光标，只发送一条 MOVE_CURSOR (virtio_gpu_cursor_plane_update)
+    ///
+    /// 位置是热点在屏幕上的坐标；光标隐藏时只记录位置
+    pub fn move_cursor(&mut self, x: u32, y: u32) -> Option<()> {
+        self.cursor_queue.as_ref()?;
+        self.cursor_pos = (x, y);
+        if !self.cursor_visible {
+            return Some(());
+        }
+        self.update_cursor(cmd::MOVE_CURSOR, CURSOR_RESOURCE_ID)
+    }
 
-        let cmd = CmdResourceFlush {
-            header: GpuCtrlHeader {
-                hdr_type: cmd::RESOURCE_FLUSH,
-                flags: 0,
-                fence_id: 0,
-                ctx_id: 0,
-                padding: 0,
-            },
-            resource_id: self.resource_id,
+    /// 隐藏光标：UPDATE_CURSOR 的 resource_id 为 0
+    pub fn hide_cursor(&mut self) -> Option<()> {
+        self.cursor_queue.as_ref()?;
+        if !self.cursor_visible {
+            return Some(());
+        }
+        self.cursor_visible = false;
+        self.update_cursor(cmd::UPDATE_CURSOR, 0)
+    }
+
+    /// 重新显示最近设置的光标图像，还没有图像时什么也不做
+    pub fn show_cursor(&mut self) -> Option<()> {
+        self.cursor_queue.as_ref()?;
+        if !self.cursor_resource || self.cursor_visible {
+            return Some(());
+        }
+        self.cursor_visible = true;
+        self.update_cursor(cmd::UPDATE_CURSOR, CURSOR_RESOURCE_ID)
+    }
+
+    /// 把一条光标命令放入光标队列并通知设备 (virtio_gpu_queue_cursor)
+    ///
+    /// 光标命令没有响应，设备读取后即可回收；队列满时先回收再重试
+    fn update_cursor(&mut self, hdr_type: u32, resource_id: u32) -> Option<()> {
+        let cursor = CmdUpdateCursor {
+            header: GpuCtrlHeader::new(hdr_type),
+            pos: CursorPos { scanout_id: 0, x: self.cursor_pos.0, y: self.cursor_pos.1, padding: 0 },
+            resource_id,
+            hot_x: self.cursor_hot.0,
+            hot_y: self.cursor_hot.1,
             padding: 0,
-            rect,
         };
+        let size = core::mem::size_of::<CmdUpdateCursor>();
+        let bytes = unsafe {
+            core::slice::from_raw_parts(&cursor as *const CmdUpdateCursor as *const u8, size)
+        }.to_vec();
+        let token = self.next_token;
+        let bufs = [(dma_addr(bytes.as_ptr()), size as u32, false)];
+
+        self.reclaim_cursor();
+        for _ in 0..100000 {
+            let queue = self.cursor_queue.as_mut()?;
+            if queue.add_buf(&bufs, token).is_some() {
+                self.next_token += 1;
+                self.cursor_pending.insert(token, bytes);
+                queue.kick();
+                return Some(());
+            }
+            queue.kick();
+            core::hint::spin_loop();
+            self.reclaim_cursor();
+        }
+        None
+    }
 
-        let mut resp = RespNoData {
-            header: GpuCtrlHeader {
-                hdr_type: 0,
-                flags: 0,
-                fence_id: 0,
-                ctx_id: 0,
-                padding: 0,
-            },
+    /// 回收设备已读取的光标命令 (virtio_gpu_dequeue_cursor_func)
+    fn reclaim_cursor(&mut self) -> usize {
+        let queue = match self.cursor_queue.as_mut() {
+            Some(queue) => queue,
+            None => return 0,
         };
-
-        let _ = self.send_command(&cmd, core::mem::size_of::<CmdResourceFlush>(),
-                                  &mut resp, core::mem::size_of::<RespNoData>());
+        let mut count = 0;
+        while let Some((token, _len)) = queue.get_buf() {
+            self.cursor_pending.remove(&token);
+            count += 1;
+        }
+        count
     }
 
     /// 获取帧缓冲区
@@ -665,6 +1014,14 @@ impl Drop for VirtioGpuDevice {
                 }
             }
         }
+        if !self.cursor_ptr.is_null() {
+            let size = (CURSOR_SIZE * CURSOR_SIZE * 4) as usize;
+            if let Ok(layout) = Layout::from_size_align(size, 4096) {
+                unsafe {
+                    dealloc(self.cursor_ptr, layout);
+                }
+            }
+        }
     }
 }
 
@@ -0,0 +1,259 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! RISC-V AIA IMSIC（Incoming MSI Controller）驱动
+//!
+//! 每个 hart 有一个 S 态中断文件，设备向文件的 seteipnum 寄存器写入中断号即触发
+//! 该 hart 的外部中断。中断号就是 MSI 消息的数据，目标 hart 由消息地址决定，
+//! 因此 PCI 设备的每个 MSI-X 向量都可以有自己的中断号和目标 hart，
+//! 不再经过 PLIC 的共享 INTx 线。
+//!
+//! 参考: drivers/irqchip/irq-riscv-imsic-state.c, drivers/irqchip/irq-riscv-imsic-early.c
+//!
+//! # 设计
+//! - 设备树解析不包含 IMSIC 节点，按 QEMU virt (aia=aplic-imsic) 的固定布局访问；
+//!   Ssaia 的 CSR 在不支持的平台上会触发非法指令，所以只在命令行给出 aia=imsic 时启用
+//! - 每个 hart 初始化自己的中断文件时使能全部中断号，分配中断号不需要跨 hart 改 CSR；
+//!   未分配的中断号到来时计为伪中断
+//! - 中断号与 PLIC 中断号是两个空间，MSI 的处理函数登记在本模块的描述符表中
+
+use core::arch::asm;
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+
+use crate::config::MAX_CPUS;
+use crate::drivers::pci::msi::MsiMsg;
+use crate::errno::Errno;
+use crate::irq::{IrqHandler, IrqReturn};
+use crate::sync::RwLock;
+
+/// S 态中断文件基地址 (QEMU virt VIRT_IMSIC_S)
+pub const IMSIC_S_BASE: u64 = 0x2800_0000;
+/// 每个 hart 中断文件的间隔 (IMSIC_HART_SIZE，无 guest 文件)
+pub const IMSIC_HART_STRIDE: u64 = 0x1000;
+/// 使用的中断号个数，0 号保留
+pub const IMSIC_NR_IDS: usize = 64;
+
+/// 间接访问中断文件寄存器的 CSR
+const CSR_SISELECT: usize = 0x150;
+const CSR_SIREG: usize = 0x151;
+const CSR_STOPEI: usize = 0x15C;
+
+/// siselect 可选的中断文件寄存器
+const IMSIC_EIDELIVERY: usize = 0x70;
+const IMSIC_EITHRESHOLD: usize = 0x72;
+const IMSIC_EIE0: usize = 0xC0;
+
+/// stopei 中中断号所在的位 (TOPEI_ID_SHIFT)
+const TOPEI_ID_SHIFT: usize = 16;
+const TOPEI_ID_MASK: usize = 0x7FF;
+
+/// 是否启用 IMSIC
+static IMSIC_ENABLED: AtomicBool = AtomicBool::new(false);
+
+/// 已初始化中断文件的 hart，只有这些 hart 可以作为 MSI 的目标
+static IMSIC_READY_MASK: AtomicUsize = AtomicUsize::new(0);
+
+/// MSI 中断描述符
+#[derive(Clone, Copy)]
+struct MsiDesc {
+    handler: Option<IrqHandler>,
+    thread_softirq: Option<usize>,
+    name: &'static str,
+}
+
+impl MsiDesc {
+    const EMPTY: Self = Self { handler: None, thread_softirq: None, name: "" };
+}
+
+/// MSI 描述符表，下标为中断号
+static MSI_DESC: RwLock<[MsiDesc; IMSIC_NR_IDS]> = RwLock::new([MsiDesc::EMPTY; IMSIC_NR_IDS]);
+
+/// 各中断号在每个 CPU 上的次数
+static KSTAT_MSI: [[AtomicU64; MAX_CPUS]; IMSIC_NR_IDS] =
+    [const { [const { AtomicU64::new(0) }; MAX_CPUS] }; IMSIC_NR_IDS];
+
+/// 没有处理函数认领的 MSI 数
+static SPURIOUS_MSI: AtomicU64 = AtomicU64::new(0);
+
+#[inline]
+fn imsic_csr_write(reg: usize, val: usize) {
+    unsafe {
+        asm!(
+            "csrw {siselect}, {reg}",
+            "csrw {sireg}, {val}",
+            siselect = const CSR_SISELECT,
+            sireg = const CSR_SIREG,
+            reg = in(reg) reg,
+            val = in(reg) val,
+            options(nomem, nostack)
+        );
+    }
+}
+
+/// 取出最高优先级的待处理中断并清除其 pending 位 (imsic_handle_irq)
+#[inline]
+fn imsic_topei_claim() -> usize {
+    let topei: usize;
+    unsafe {
+        asm!("csrrw {topei}, {stopei}, zero", topei = out(reg) topei, stopei = const CSR_STOPEI, options(nomem, nostack));
+    }
+    (topei >> TOPEI_ID_SHIFT) & TOPEI_ID_MASK
+}
+
+/// 初始化本 hart 的中断文件 (imsic_local_delivery + imsic_local_sync_all)
+///
+/// 打开中断投递、不设优先级阈值，并使能全部中断号
+pub fn local_init() {
+    if !is_enabled() {
+        return;
+    }
+    imsic_csr_write(IMSIC_EIDELIVERY, 0);
+    imsic_csr_write(IMSIC_EITHRESHOLD, 0);
+    // RV64 上只有偶数编号的 eie 寄存器，每个 64 位
+    for word in 0..IMSIC_NR_IDS.div_ceil(64) {
+        let mut bits = !0usize;
+        if word == 0 {
+            bits &= !1;  // 0 号不是有效中断
+        }
+        imsic_csr_write(IMSIC_EIE0 + word * 2, bits);
+    }
+    imsic_csr_write(IMSIC_EIDELIVERY, 1);
+    let hart = crate::arch::cpu_id();
+    if hart < MAX_CPUS {
+        IMSIC_READY_MASK.fetch_or(1 << hart, Ordering::AcqRel);
+    }
+}
+
+/// 按命令行决定是否启用 IMSIC，并初始化启动 hart 的中断文件
+pub fn init() {
+    if crate::cmdline::get_param("aia").as_deref() != Some("imsic") {
+        return;
+    }
+    IMSIC_ENABLED.store(true, Ordering::Release);
+    local_init();
+}
+
+/// IMSIC 是否可用
+#[inline]
+pub fn is_enabled() -> bool {
+    IMSIC_ENABLED.load(Ordering::Acquire)
+}
+
+/// 已初始化中断文件的 hart 掩码
+pub fn ready_mask() -> usize {
+    IMSIC_READY_MASK.load(Ordering::Acquire)
+}
+
+/// 分配一个 MSI 中断号并登记处理函数 (msi_domain_alloc_irqs)
+///
+/// # 参数
+/// - `handler`: 硬中断处理函数，参数为中断号
+/// - `thread_softirq`: 返回 WakeThread 时触发的软中断
+/// - `name`: 设备名
+///
+/// # 返回
+/// 中断号；没有空闲中断号时返回 -ENOSPC
+pub fn msi_alloc(handler: IrqHandler, thread_softirq: Option<usize>, name: &'static str) -> Result<usize, i32> {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let mut descs = MSI_DESC.write();
+    let id = (1..IMSIC_NR_IDS)
+        .find(|&id| descs[id].handler.is_none())
+        .ok_or(Errno::NoSpaceLeftOnDevice.as_neg_i32())?;
+    descs[id] = MsiDesc { handler: Some(handler), thread_softirq, name };
+    for count in KSTAT_MSI[id].iter() {
+        count.store(0, Ordering::Relaxed);
+    }
+    Ok(id)
+}
+
+/// 释放 MSI 中断号 (msi_domain_free_irqs)
+///
+/// 调用方应先在设备上屏蔽对应的向量
+pub fn msi_free(id: usize) {
+    if id == 0 || id >= IMSIC_NR_IDS {
+        return;
+    }
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    MSI_DESC.write()[id] = MsiDesc::EMPTY;
+}
+
+/// 生成投递到指定 hart 的 MSI 消息 (imsic_irq_compose_msi_msg)
+///
+/// # 返回
+/// 中断号无效或 hart 的中断文件未初始化时返回 None
+pub fn msi_compose_msg(id: usize, hart: usize) -> Option<MsiMsg> {
+    if id == 0 || id >= IMSIC_NR_IDS || hart >= MAX_CPUS || ready_mask() & (1 << hart) == 0 {
+        return None;
+    }
+    Some(MsiMsg { address: IMSIC_S_BASE + hart as u64 * IMSIC_HART_STRIDE, data: id as u32 })
+}
+
+/// 分发一个 MSI
+pub fn handle_msi(id: usize) {
+    if id == 0 || id >= IMSIC_NR_IDS {
+        SPURIOUS_MSI.fetch_add(1, Ordering::Relaxed);
+        return;
+    }
+    let cpu = crate::arch::cpu_id();
+    if cpu < MAX_CPUS {
+        KSTAT_MSI[id][cpu].fetch_add(1, Ordering::Relaxed);
+    }
+    let desc = MSI_DESC.read()[id];
+    let ret = match desc.handler {
+        Some(handler) => handler(id),
+        None => IrqReturn::None,
+    };
+    match ret {
+        IrqReturn::None => {
+            SPURIOUS_MSI.fetch_add(1, Ordering::Relaxed);
+        }
+        IrqReturn::Handled => {}
+        IrqReturn::WakeThread => {
+            if let Some(nr) = desc.thread_softirq {
+                crate::softirq::raise_softirq(nr);
+            }
+        }
+    }
+}
+
+/// 处理本 hart 所有待处理的 MSI，在外部中断中调用
+pub fn handle_pending() {
+    if !is_enabled() {
+        return;
+    }
+    loop {
+        let id = imsic_topei_claim();
+        if id == 0 {
+            break;
+        }
+        handle_msi(id);
+    }
+}
+
+/// 中断号在指定 CPU 上的次数
+pub fn kstat_msi_cpu(id: usize, cpu: usize) -> u64 {
+    if id >= IMSIC_NR_IDS || cpu >= MAX_CPUS {
+        return 0;
+    }
+    KSTAT_MSI[id][cpu].load(Ordering::Relaxed)
+}
+
+/// 中断号在所有 CPU 上的次数之和
+pub fn kstat_msi(id: usize) -> u64 {
+    (0..MAX_CPUS).map(|cpu| kstat_msi_cpu(id, cpu)).sum()
+}
+
+/// 已分配的中断号
+pub fn allocated_msis() -> alloc::vec::Vec<(usize, &'static str)> {
+    let descs = MSI_DESC.read();
+    (1..IMSIC_NR_IDS)
+        .filter(|&id| descs[id].handler.is_some())
+        .map(|id| (id, descs[id].name))
+        .collect()
+}
+
+/// 未被认领的 MSI 数
+pub fn spurious_msis() -> u64 {
+    SPURIOUS_MSI.load(Ordering::Relaxed)
+}
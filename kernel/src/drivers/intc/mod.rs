@@ -5,7 +5,7 @@
 
 //! 中断控制器驱动
 //!
-//! 支持 GICv3（ARM64）、PLIC（RISC-V64）和 CLINT（RISC-V64）
+//! 支持 GICv3（ARM64）、PLIC（RISC-V64）、CLINT（RISC-V64）和 AIA IMSIC（RISC-V64，MSI）
 
 #[cfg(feature = "aarch64")]
 pub mod gicv3;
@@ -16,6 +16,9 @@ pub mod plic;
 #[cfg(feature = "riscv64")]
 pub mod clint;
 
+#[cfg(feature = "riscv64")]
+pub mod imsic;
+
 // 根据平台导出对应的中断控制器
 #[cfg(feature = "aarch64")]
 pub use gicv3::*;
@@ -30,4 +33,5 @@ pub fn init() {
 pub fn init() {
     plic::init();
     clint::init();
+    imsic::init();
 }
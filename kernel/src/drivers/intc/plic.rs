@@ -7,9 +7,14 @@
 //!
 //! 参考 RISC-V PLIC 规范
 //! QEMU virt 平台内存布局
+//!
+//! 每个 hart 在自己的 S 态上下文中 claim / complete；一个中断在哪些上下文中
+//! 使能由 irq.rs 中的亲和性决定 (plic_set_affinity)
 
 use core::arch::asm;
-use crate::println;
+
+use crate::config::MAX_CPUS;
+use crate::sync::TicketLock;
 
 // PLIC base address - QEMU virt platform uses 0x0c000000
 // NOTE: Must use plain hex digits (0x0c000000) not (0x0c00_0000) to avoid
@@ -23,16 +28,17 @@ mod offset {
     // 待取中断寄存器（每次读取 4 字节）
     pub const PENDING: usize = 0x1000;
 
-    // 使能寄存器（每个 hart 一组）
+    // 使能寄存器（每个上下文一组，每组 0x80 字节）
     pub const ENABLE: usize = 0x2000;
+    pub const ENABLE_STRIDE: usize = 0x80;
+
+    // 上下文寄存器（每个上下文 0x1000 字节）
+    pub const CONTEXT: usize = 0x200000;
 
-    // 阈值寄存器（每个 hart 一个）
-    // 位于 context 偏移 0x0000
+    // 阈值寄存器，位于上下文偏移 0x0000
     pub const THRESHOLD: usize = 0x0000;
 
-    // Claim 寄存器（每个 hart 一个）
-    // Complete 寄存器（每个 hart 一个）
-    // 位于 context 偏移 0x0004
+    // Claim / Complete 寄存器，位于上下文偏移 0x0004
     pub const CLAIM_COMPLETE: usize = 0x0004;
 }
 
@@ -44,9 +50,45 @@ pub const PLIC_PRIORITY_BASE: u32 = 1;
 pub const PLIC_PRIORITY_MIN: u32 = 0;
 pub const PLIC_PRIORITY_MAX: u32 = 7;
 
+/// hart 的 S 态上下文号
+///
+/// QEMU virt 上每个 hart 有 M 态、S 态两个上下文，S 态上下文为 2 * hart + 1
+#[inline]
+const fn s_context(hart: usize) -> usize {
+    2 * hart + 1
+}
+
+#[inline]
+fn mmio_read(addr: usize) -> u32 {
+    let value: u32;
+    unsafe {
+        asm!(
+            "lw {}, 0({})",
+            out(reg) value,
+            in(reg) addr,
+            options(nostack)
+        );
+    }
+    value
+}
+
+#[inline]
+fn mmio_write(addr: usize, value: u32) {
+    unsafe {
+        asm!(
+            "sw t1, 0(a0)",
+            in("a0") addr,
+            in("t1") value,
+            options(nostack)
+        );
+    }
+}
+
 pub struct Plic {
     base: usize,
     num_harts: usize,
+    /// 串行化使能寄存器的读-改-写，亲和性可能在多个 CPU 上同时修改
+    enable_lock: TicketLock<()>,
 }
 
 impl Plic {
@@ -55,6 +97,7 @@ impl Plic {
         Self {
             base,
             num_harts,
+            enable_lock: TicketLock::new(()),
         }
     }
 
@@ -80,98 +123,75 @@ impl Plic {
         }
     }
 
+    /// hart 的 S 态上下文的使能寄存器
+    #[inline]
+    fn enable_addr(&self, hart: usize, word: usize) -> usize {
+        self.base + offset::ENABLE + s_context(hart) * offset::ENABLE_STRIDE + word * 4
+    }
+
+    /// hart 的 S 态上下文的寄存器
+    #[inline]
+    fn context_addr(&self, hart: usize, reg: usize) -> usize {
+        self.base + offset::CONTEXT + s_context(hart) * CONTEXT_SIZE + reg
+    }
+
     /// 设置中断优先级
     fn set_priority(&self, irq: usize, priority: u32) {
-        let addr = self.base + offset::PRIORITY + irq * 4;
-        unsafe {
-            asm!(
-                "sw t1, 0(a0)",
-                in("a0") addr,
-                in("t1") priority,
-                options(nostack)
-            );
-        }
+        mmio_write(self.base + offset::PRIORITY + irq * 4, priority);
     }
 
     /// 设置 hart 的中断阈值
     ///
     /// 只有优先级 > threshold 的中断才会被传递给 hart
     fn set_threshold(&self, hart: usize, threshold: u32) {
-        let addr = self.base + offset::THRESHOLD + hart * CONTEXT_SIZE;
-        unsafe {
-            asm!(
-                "sw t1, 0(a0)",
-                in("a0") addr,
-                in("t1") threshold,
-                options(nostack)
-            );
+        mmio_write(self.context_addr(hart, offset::THRESHOLD), threshold);
+    }
+
+    /// 在 hart 的 S 态上下文中打开或关闭一个中断
+    fn set_enable(&self, hart: usize, irq: usize, enable: bool) {
+        if hart >= self.num_harts || irq == 0 || irq >= MAX_INTERRUPTS {
+            return;
         }
+        let addr = self.enable_addr(hart, irq / 32);
+        let bit = 1u32 << (irq % 32);
+        let _guard = self.enable_lock.lock_irqsave();
+        let value = mmio_read(addr);
+        mmio_write(addr, if enable { value | bit } else { value & !bit });
     }
 
     /// 使能指定 hart 的中断
     pub fn enable_interrupt(&self, hart: usize, irq: usize) {
         // 首先设置中断优先级（必须 > 0 才能触发）
         self.set_priority(irq, PLIC_PRIORITY_BASE);
+        self.set_enable(hart, irq, true);
+    }
 
-        // 然后在 ENABLE 寄存器中设置对应的位
-        let word = irq / 32;
-        let bit = irq % 32;
-        let addr = self.base + offset::ENABLE + hart * CONTEXT_SIZE + word * 4;
-
-        unsafe {
-            let value: u32;
-            asm!(
-                "lw {}, 0({})",
-                out(reg) value,
-                in(reg) addr,
-                options(nostack)
-            );
-
-            // 设置对应的位
-            let new_value = value | (1 << bit);
+    /// 禁用指定 hart 的一个中断
+    pub fn disable_interrupt(&self, hart: usize, irq: usize) {
+        self.set_enable(hart, irq, false);
+    }
 
-            asm!(
-                "sw t1, 0(a0)",
-                in("a0") addr,
-                in("t1") new_value,
-                options(nostack)
-            );
-        }
+    /// 中断是否在指定 hart 上使能
+    pub fn is_enabled(&self, hart: usize, irq: usize) -> bool {
+        hart < self.num_harts
+            && irq < MAX_INTERRUPTS
+            && mmio_read(self.enable_addr(hart, irq / 32)) & (1 << (irq % 32)) != 0
     }
 
     /// 禁用指定 hart 的中断（禁用一个 32-bit word 中的所有中断）
     fn disable_interrupts(&self, hart: usize, word: usize) {
-        let addr = self.base + offset::ENABLE + hart * CONTEXT_SIZE + word * 4;
-        unsafe {
-            asm!(
-                "sw t1, 0(a0)",
-                in("a0") addr,
-                in("t1") 0u32,
-                options(nostack)
-            );
-        }
+        mmio_write(self.enable_addr(hart, word), 0);
     }
 
     /// Claim（声明）中断
     ///
     /// 返回最高优先级的待处理中断 ID
     pub fn claim(&self, hart: usize) -> Option<usize> {
-        let addr = self.base + offset::CLAIM_COMPLETE + hart * CONTEXT_SIZE + 0x4;
-
-        unsafe {
-            let irq: u32;
-            asm!(
-                "lw {}, 0({})",
-                out(reg) irq,
-                in(reg) addr,
-                options(nostack)
-            );
-
-            if irq == 0 {
-                None
-            } else {
-                Some(irq as usize)
-            }
+        let irq = mmio_read(self.context_addr(hart, offset::CLAIM_COMPLETE));
+        if irq == 0 {
+            None
+        } else {
+            Some(irq as usize)
         }
     }
 
@@ -179,16 +199,7 @@ impl Plic {
     ///
     /// 通知 PLIC 中断处理已完成
     pub fn complete(&self, hart: usize, irq: usize) {
-        let addr = self.base + offset::CLAIM_COMPLETE + hart * CONTEXT_SIZE + 0x4;
-
-        unsafe {
-            asm!(
-                "sw t1, 0(a0)",
-                in("a0") addr,
-                in("t1") irq as u32,
-                options(nostack)
-            );
-        }
+        mmio_write(self.context_addr(hart, offset::CLAIM_COMPLETE), irq as u32);
     }
 
     /// 读取待取中断状态
@@ -245,36 +256,14 @@ impl Plic {
     }
 }
 
-static PLIC: Plic = Plic::new(PLIC_BASE, 4);
+static PLIC: Plic = Plic::new(PLIC_BASE, MAX_CPUS);
 
+/// 初始化 PLIC
+///
+/// 所有中断先关闭；设备驱动通过 irq::request_irq 注册时，
+/// 按中断的亲和性在对应 hart 的 S 态上下文中使能
 pub fn init() {
     PLIC.init();
-
-    // 使能关键中断
-    // RISC-V virt 平台中断映射（QEMU）:
-    // - IRQ 1-8: VirtIO 设备（8 个 VirtIO 槽位）
-    // - IRQ 10: UART (ns16550a)
-    // - IRQ 11-13: IPI (软件中断，用于核间通信)
-    let boot_hart = crate::arch::riscv64::smp::cpu_id();
-
-    // 为启动核使能 VirtIO 设备中断
-    // IRQ 1 是第一个 VirtIO 设备（通常是 VirtIO-Blk）
-    PLIC.enable_interrupt(boot_hart, 1);
-    // 也使能其他 VirtIO 槽位的 IRQ（以防有多个 VirtIO 设备）
-    // IRQ 2-8 对应 VirtIO 槽位 1-7
-    for virtio_irq in 2..9 {  // 2 到 8（包含 8）
-        PLIC.enable_interrupt(boot_hart, virtio_irq);
-    }
-
-    // 为启动核使能 UART 中断（QEMU RISC-V virt: IRQ 10）
-    PLIC.enable_interrupt(boot_hart, 10);
-
-    // 使能 IPI 中断（用于核间通信）
-    for hart in 0..4 {
-        for ipi_irq in 11..14 {  // 11-13: IPI
-            PLIC.enable_interrupt(hart, ipi_irq);
-        }
-    }
 }
 
 pub fn claim(hart: usize) -> Option<usize> {
@@ -289,6 +278,14 @@ pub fn enable_interrupt(hart: usize, irq: usize) {
     PLIC.enable_interrupt(hart, irq);
 }
 
+pub fn disable_interrupt(hart: usize, irq: usize) {
+    PLIC.disable_interrupt(hart, irq);
+}
+
+pub fn is_enabled(hart: usize, irq: usize) -> bool {
+    PLIC.is_enabled(hart, irq)
+}
+
 pub fn read_pending() -> u32 {
     PLIC.read_pending()
 }
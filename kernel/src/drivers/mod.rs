@@ -10,6 +10,7 @@ pub mod blkdev;
 pub mod pci;
 pub mod virtio;
 pub mod net;
+pub mod tty;
 
 #[cfg(feature = "riscv64")]
 pub mod gpu;
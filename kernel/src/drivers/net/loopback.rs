@@ -6,13 +6,27 @@
 //!
 //! 完全...
 //! 参考: drivers/net/loopback.c
+//!
+//! # 本机投递快速路径
+//! 目标为本机地址的 IP 包由 ip_output 直接交给 loopback_xmit_local，
+//! 不经过 ARP、以太网封装和校验和：
+//! - UDP 数据报整个 SkBuff 挂到接收方 socket 的队列，不复制
+//! - 其他协议放入当前 CPU 的接收积压队列 (softnet_data.input_pkt_queue)，在发送方
+//!   释放协议锁后由 loopback_process_backlog 交给 ip_rcv，发送路径不会重入协议锁
+//! - 统计按 CPU 分开累加，读取时求和 (pcpu_lstats)
+
+use alloc::collections::VecDeque;
 
+use crate::config::MAX_CPUS;
 use crate::drivers::net::space::{NetDevice, NetDeviceOps, DeviceStats, ArpHrdType, dev_flags};
-use crate::net::buffer::SkBuff;
-use spin::Mutex;
+use crate::net::buffer::{SkBuff, CHECKSUM_UNNECESSARY};
+use crate::sync::{LockClass, TicketLock};
+
+/// 每 CPU 接收积压队列的上限 (netdev_max_backlog)
+pub const LO_MAX_BACKLOG: usize = 1000;
 
-/// 回环设备统计信息（使用 Mutex 保护）
-static LO_STATS: Mutex<DeviceStats> = Mutex::new(DeviceStats {
+/// 清零的统计信息
+const LO_STATS_ZERO: DeviceStats = DeviceStats {
     rx_packets: 0,
     tx_packets: 0,
     rx_bytes: 0,
@@ -22,14 +36,32 @@ static LO_STATS: Mutex<DeviceStats> = Mutex::new(DeviceStats {
     rx_dropped: 0,
     tx_dropped: 0,
     multicast: 0,
-});
+};
+
+/// 每 CPU 的回环设备统计（关中断后只由本 CPU 修改） (pcpu_lstats)
+static mut LO_PCPU_STATS: [DeviceStats; MAX_CPUS] = [LO_STATS_ZERO; MAX_CPUS];
+
+/// 每 CPU 的接收积压队列，保存从 IP 头部开始的包 (softnet_data.input_pkt_queue)
+static mut LO_BACKLOG: [VecDeque<SkBuff>; MAX_CPUS] = [const { VecDeque::new() }; MAX_CPUS];
+
+/// 本 CPU 是否正在处理积压队列，处理中再次发送的包只入队
+static mut LO_BACKLOG_RUNNING: [bool; MAX_CPUS] = [false; MAX_CPUS];
 
 /// 回环设备锁
-static LO_DEVICE_LOCK: Mutex<()> = Mutex::new(());
+static LO_DEVICE_LOCK_CLASS: LockClass = LockClass::new("lo_device");
+
+static LO_DEVICE_LOCK: TicketLock<()> = TicketLock::with_class((), &LO_DEVICE_LOCK_CLASS);
 
 /// 回环设备（使用锁保护）
 static mut LO_DEVICE: Option<NetDevice> = None;
 
+/// 在关中断的状态下修改本 CPU 的统计
+fn lo_stats_update(f: impl FnOnce(&mut DeviceStats)) {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let cpu = crate::arch::cpu_id() as usize % MAX_CPUS;
+    unsafe { f(&mut LO_PCPU_STATS[cpu]) }
+}
+
 /// 回环设备发送函数
 ///
 /// # 参数
@@ -39,22 +71,16 @@ static mut LO_DEVICE: Option<NetDevice> = None;
 /// 始终返回 0 (成功)
 ///
 /// # 说明
-/// 回环设备的特殊之处在于：
-/// - 发送的包立即被接收
-/// - 不需要通过硬件
+/// 经以太网封装发来的帧只计数后释放；发往本机的包在 ip_output 中已经走了
+/// loopback_xmit_local，这里收到的都不属于本机
 fn loopback_xmit(skb: SkBuff) -> i32 {
-    // 更新统计信息（需要锁保护）
-    {
-        let mut stats = LO_STATS.lock();
+    let len = skb.len as u64;
+    lo_stats_update(|stats| {
         stats.tx_packets += 1;
-        stats.tx_bytes += skb.len as u64;
+        stats.tx_bytes += len;
         stats.rx_packets += 1;
-        stats.rx_bytes += skb.len as u64;
-    }
-
-    // TODO: 将数据包传递到网络协议栈
-    // 目前简化实现：直接释放数据包
-    // 完整实现应该调用 netif_rx(skb)
+        stats.rx_bytes += len;
+    });
 
     // 释放数据包
     skb.free();
@@ -62,20 +88,111 @@ fn loopback_xmit(skb: SkBuff) -> i32 {
     0
 }
 
+/// 本机发往本机的 IP 包 (loopback_xmit + netif_rx 快速路径)
+///
+/// # 参数
+/// - `skb`: 从 IP 头部开始的包，头部已填好
+///
+/// # 返回
+/// 成功返回 0；积压队列已满时丢弃并返回 -ENOBUFS
+pub fn loopback_xmit_local(mut skb: SkBuff) -> i32 {
+    let len = skb.len as u64;
+    lo_stats_update(|stats| {
+        stats.tx_packets += 1;
+        stats.tx_bytes += len;
+    });
+
+    // 包没有离开内存，校验和无需计算也无需校验
+    skb.ip_summed = CHECKSUM_UNNECESSARY;
+
+    let protocol = if skb.skb_headlen() >= 20 { unsafe { *skb.data.add(9) } } else { 0 };
+    if protocol == 17 {
+        // IPPROTO_UDP：不持有协议锁，直接挂到接收方队列
+        lo_stats_update(|stats| {
+            stats.rx_packets += 1;
+            stats.rx_bytes += len;
+        });
+        crate::net::udp::udp_rcv_local(skb);
+        return 0;
+    }
+
+    let queued = {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        let cpu = crate::arch::cpu_id() as usize % MAX_CPUS;
+        unsafe {
+            if LO_BACKLOG[cpu].len() < LO_MAX_BACKLOG {
+                LO_BACKLOG[cpu].push_back(skb);
+                None
+            } else {
+                LO_PCPU_STATS[cpu].rx_dropped += 1;
+                Some(skb)
+            }
+        }
+    };
+    match queued {
+        None => 0,
+        Some(skb) => {
+            skb.free();
+            -105 // ENOBUFS
+        }
+    }
+}
+
+/// 把本 CPU 积压队列中的包交给 IP 层 (process_backlog)
+///
+/// # 说明
+/// 协议在释放自己的锁后调用；处理期间产生的新包（如回复的 ACK）追加到队列，
+/// 由同一轮处理，嵌套调用直接返回
+pub fn loopback_process_backlog() {
+    let cpu = {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        let cpu = crate::arch::cpu_id() as usize % MAX_CPUS;
+        unsafe {
+            if LO_BACKLOG_RUNNING[cpu] || LO_BACKLOG[cpu].is_empty() {
+                return;
+            }
+            LO_BACKLOG_RUNNING[cpu] = true;
+        }
+        cpu
+    };
+
+    while let Some(skb) = loopback_poll() {
+        let len = skb.len as u64;
+        lo_stats_update(|stats| {
+            stats.rx_packets += 1;
+            stats.rx_bytes += len;
+        });
+        let _ = crate::net::ipv4::ip_rcv(&skb);
+        skb.free();
+    }
+
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    unsafe { LO_BACKLOG_RUNNING[cpu] = false; }
+}
+
 /// 回环设备统计信息获取函数
+///
+/// 各 CPU 的计数求和 (loopback_get_stats64)
 fn loopback_get_stats() -> DeviceStats {
-    let stats = LO_STATS.lock();
-    DeviceStats {
-        rx_packets: stats.rx_packets,
-        tx_packets: stats.tx_packets,
-        rx_bytes: stats.rx_bytes,
-        tx_bytes: stats.tx_bytes,
-        rx_errors: stats.rx_errors,
-        tx_errors: stats.tx_errors,
-        rx_dropped: stats.rx_dropped,
-        tx_dropped: stats.tx_dropped,
-        multicast: stats.multicast,
+    let mut total = LO_STATS_ZERO;
+    for cpu in 0..MAX_CPUS {
+        let stats = unsafe { core::ptr::read_volatile(core::ptr::addr_of!(LO_PCPU_STATS[cpu])) };
+        total.rx_packets += stats.rx_packets;
+        total.tx_packets += stats.tx_packets;
+        total.rx_bytes += stats.rx_bytes;
+        total.tx_bytes += stats.tx_bytes;
+        total.rx_errors += stats.rx_errors;
+        total.tx_errors += stats.tx_errors;
+        total.rx_dropped += stats.rx_dropped;
+        total.tx_dropped += stats.tx_dropped;
+        total.multicast += stats.multicast;
     }
+    total
+}
+
+/// 回环设备统计信息（各 CPU 之和）
+pub fn loopback_stats() -> DeviceStats {
+    loopback_get_stats()
 }
 
 /// 回环设备操作接口
@@ -111,6 +228,8 @@ pub fn loopback_init() -> Option<&'static mut NetDevice> {
             stats: DeviceStats::default(),
             flags: dev_flags::IFF_UP | dev_flags::IFF_RUNNING | dev_flags::IFF_LOOPBACK,
             rx_queue_len: 0,
+            // 回环设备不卸载：超长包与部分校验和由软件 GSO 处理
+            features: 0,
         };
 
         // 设置设备名
@@ -140,8 +259,12 @@ pub fn get_loopback_device() -> Option<&'static mut NetDevice> {
 /// # 说明
 /// 用于测试环境，在测试开始前重置统计信息
 pub fn loopback_reset_stats() {
-    let mut stats = LO_STATS.lock();
-    *stats = DeviceStats::default();
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    unsafe {
+        for cpu in 0..MAX_CPUS {
+            LO_PCPU_STATS[cpu] = LO_STATS_ZERO;
+        }
+    }
 }
 
 /// 发送数据包到回环设备
@@ -155,19 +278,14 @@ pub fn loopback_send(skb: SkBuff) -> i32 {
     loopback_xmit(skb)
 }
 
-/// 轮询回环设备接收数据包
+/// 从本 CPU 的积压队列取出一个包
 ///
 /// # 返回
-/// 如果有数据包返回 Some(skb)，否则返回 None
-///
-/// # 说明
-/// 回环设备没有真正的接收队列
-/// 这个函数目前返回 None，因为回环设备的发送直接处理了数据包
+/// 从 IP 头部开始的包；队列为空返回 None
 pub fn loopback_poll() -> Option<SkBuff> {
-    // 回环设备的发送和接收是同步的
-    // 发送的包在 loopback_xmit 中已经处理
-    // 所以这里不需要返回任何数据包
-    None
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let cpu = crate::arch::cpu_id() as usize % MAX_CPUS;
+    unsafe { LO_BACKLOG[cpu].pop_front() }
 }
 
 #[cfg(test)]
@@ -199,7 +317,7 @@ mod tests {
         assert_eq!(result, 0);
 
         // 检查统计信息
-        let stats = unsafe { LO_STATS };
+        let stats = loopback_stats();
         assert_eq!(stats.tx_packets, 1);
         assert_eq!(stats.rx_packets, 1);
     }
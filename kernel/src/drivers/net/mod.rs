@@ -16,7 +16,7 @@ pub use space::{
     ArpHrdType, dev_flags,
     register_netdevice, unregister_netdevice,
     get_netdevice_by_index, get_netdevice_by_name,
-    get_netdevice_count,
+    get_netdevice_count, netdev_stats_total,
 };
 
 pub use loopback::{
@@ -6,8 +6,13 @@
 //!
 //! 完全...
 
+use alloc::boxed::Box;
+use alloc::vec::Vec;
+use core::ptr;
+use core::sync::atomic::{AtomicPtr, Ordering};
+
 use crate::net::buffer::SkBuff;
-use spin::Mutex;
+use crate::sync::{kfree_rcu, rcu_read_lock, TicketLock};
 
 /// 设备名最大长度
 ///
@@ -114,6 +119,8 @@ pub struct NetDevice {
     pub flags: u32,
     /// 接收队列长度
     pub rx_queue_len: u32,
+    /// 设备特性 (features)，见 netdev_features
+    pub features: u32,
 }
 
 unsafe impl Send for NetDevice {}
@@ -133,10 +140,70 @@ pub mod dev_flags {
     pub const IFF_MULTICAST: u32 = 0x1000;
 }
 
-/// 网络设备注册表
+/// 设备特性标志 (netdev_features_t)
+///
+/// 协议栈据此决定校验和与分段交给设备还是由软件完成
+pub mod netdev_features {
+    /// 设备能计算任意位置的校验和 (NETIF_F_HW_CSUM)
+    pub const NETIF_F_HW_CSUM: u32 = 1 << 0;
+    /// 设备接收时验证校验和 (NETIF_F_RXCSUM)
+    pub const NETIF_F_RXCSUM: u32 = 1 << 1;
+    /// 设备支持分散/聚集发送 (NETIF_F_SG)
+    pub const NETIF_F_SG: u32 = 1 << 2;
+    /// 设备能切分 TCPv4 超长包 (NETIF_F_TSO)
+    pub const NETIF_F_TSO: u32 = 1 << 3;
+}
+
+/// 已注册设备的列表 (dev_base_head)
+///
+/// 按索引和名称查找在 RCU 读临界区内无锁读取；注册和注销在 DEV_LOCK 下
+/// 复制一份新列表发布，旧列表在宽限期后释放。设备本身是静态分配的，不会释放
+struct NetDevList {
+    devs: Vec<*mut NetDevice>,
+}
+
+unsafe impl Send for NetDevList {}
+
+static DEV_LIST: AtomicPtr<NetDevList> = AtomicPtr::new(ptr::null_mut());
+
+/// 注册与注销互斥 (rtnl_lock)，保护下一个设备索引；索引 0 留给回环设备
+static DEV_LOCK: TicketLock<u32> = TicketLock::new(1);
+
+/// 读临界区内的设备列表 (rcu_dereference)
+///
+/// # Safety
+/// 调用者持有 rcu_read_lock 或 DEV_LOCK
+unsafe fn netdev_list() -> &'static [*mut NetDevice] {
+    let list = DEV_LIST.load(Ordering::Acquire);
+    if list.is_null() {
+        &[]
+    } else {
+        &(*list).devs
+    }
+}
+
+/// 复制设备列表、修改后发布 (list_add_tail_rcu / list_del_rcu)
 ///
-/// 简化实现：使用计数器跟踪设备数量（使用 Mutex 保护）
-static DEV_COUNT: Mutex<usize> = Mutex::new(0);
+/// 调用者持有 DEV_LOCK
+fn netdev_list_update(f: impl FnOnce(&mut Vec<*mut NetDevice>)) {
+    let mut devs = unsafe { netdev_list() }.to_vec();
+    f(&mut devs);
+    let new = Box::into_raw(Box::new(NetDevList { devs }));
+    let old = DEV_LIST.swap(new, Ordering::AcqRel);
+    if !old.is_null() {
+        kfree_rcu(unsafe { Box::from_raw(old) });
+    }
+}
+
+/// 在设备列表中查找
+fn netdev_find(pred: impl Fn(&NetDevice) -> bool) -> Option<&'static mut NetDevice> {
+    let _rcu = rcu_read_lock();
+    unsafe { netdev_list() }
+        .iter()
+        .copied()
+        .find(|&dev| pred(unsafe { &*dev }))
+        .map(|dev| unsafe { &mut *dev })
+}
 
 impl NetDevice {
     /// 设置硬件地址
@@ -210,14 +277,15 @@ impl NetDevice {
 /// - 将设备添加到全局设备列表
 /// - 分配设备索引
 pub fn register_netdevice(device: &'static mut NetDevice) -> i32 {
-    let mut count = DEV_COUNT.lock();
+    let mut next_ifindex = DEV_LOCK.lock();
     // 分配设备索引
-    device.ifindex = *count as u32;
-
-    // 增加计数
-    *count += 1;
+    device.ifindex = *next_ifindex;
+    *next_ifindex += 1;
 
-    device.ifindex as i32
+    let ifindex = device.ifindex as i32;
+    let dev: *mut NetDevice = device;
+    netdev_list_update(|devs| devs.push(dev));
+    ifindex
 }
 
 /// 注销网络设备
@@ -225,9 +293,14 @@ pub fn register_netdevice(device: &'static mut NetDevice) -> i32 {
 /// # 参数
 /// - `device`: 要注销的设备
 pub fn unregister_netdevice(device: &mut NetDevice) {
-    // 从全局列表中移除
-    // 简化实现：仅标记设备
+    let _lock = DEV_LOCK.lock();
     device.flags &= !dev_flags::IFF_UP;
+
+    // 从全局列表中移除，正在查找的读者仍可能拿到它
+    let dev: *mut NetDevice = device;
+    if unsafe { netdev_list() }.contains(&dev) {
+        netdev_list_update(|devs| devs.retain(|&d| d != dev));
+    }
 }
 
 /// 根据索引查找网络设备
@@ -238,12 +311,11 @@ pub fn unregister_netdevice(device: &mut NetDevice) {
 /// # 返回
 /// 返回找到的设备，如果未找到则返回 None
 pub fn get_netdevice_by_index(ifindex: u32) -> Option<&'static mut NetDevice> {
-    // 简化实现：目前只支持查找回环设备
-    // 完整实现需要维护设备链表
+    // 回环设备不经过注册，固定使用索引 0
     if ifindex == 0 {
         crate::drivers::net::get_loopback_device()
     } else {
-        None
+        netdev_find(|dev| dev.ifindex == ifindex)
     }
 }
 
@@ -255,16 +327,36 @@ pub fn get_netdevice_by_index(ifindex: u32) -> Option<&'static mut NetDevice> {
 /// # 返回
 /// 返回找到的设备，如果未找到则返回 None
 pub fn get_netdevice_by_name(name: &str) -> Option<&'static mut NetDevice> {
-    // 简化实现：目前只支持查找回环设备
-    // 完整实现需要维护设备链表
     if name == "lo" {
         crate::drivers::net::get_loopback_device()
     } else {
-        None
+        netdev_find(|dev| dev.get_name() == name)
+    }
+}
+
+/// 所有网络设备的统计之和，包括回环设备 (dev_get_stats)
+///
+/// 在 RCU 读临界区内遍历，可以在中断中调用
+pub fn netdev_stats_total() -> DeviceStats {
+    let mut total = crate::drivers::net::get_loopback_device().map(|lo| lo.get_stats()).unwrap_or_default();
+    let _rcu = rcu_read_lock();
+    for &dev in unsafe { netdev_list() } {
+        let stats = unsafe { (*dev).get_stats() };
+        total.rx_packets += stats.rx_packets;
+        total.tx_packets += stats.tx_packets;
+        total.rx_bytes += stats.rx_bytes;
+        total.tx_bytes += stats.tx_bytes;
+        total.rx_errors += stats.rx_errors;
+        total.tx_errors += stats.tx_errors;
+        total.rx_dropped += stats.rx_dropped;
+        total.tx_dropped += stats.tx_dropped;
+        total.multicast += stats.multicast;
     }
+    total
 }
 
-/// 获取所有网络设备数量
+/// 获取已注册的网络设备数量
 pub fn get_netdevice_count() -> usize {
-    *DEV_COUNT.lock()
+    let _rcu = rcu_read_lock();
+    unsafe { netdev_list() }.len()
 }
@@ -6,11 +6,306 @@
 //!
 //! 参考: drivers/net/virtio_net.c, Documentation/virtio/
 
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicU8, AtomicUsize, Ordering};
+
+use crate::config::MAX_CPUS;
 use crate::drivers::virtio::queue;
-use crate::drivers::net::space::{NetDevice, NetDeviceOps, DeviceStats, ArpHrdType, dev_flags};
-use crate::net::buffer::SkBuff;
+use crate::irq::IrqReturn;
+use crate::drivers::net::space::{NetDevice, NetDeviceOps, DeviceStats, ArpHrdType, dev_flags, netdev_features};
+use crate::net::buffer::{SkBuff, CHECKSUM_PARTIAL, CHECKSUM_UNNECESSARY, SKB_GSO_TCPV4};
+use crate::net::xdp::{XdpAction, XdpHook, XdpProg};
 use spin::Mutex;
 
+/// 第 n 对队列的接收队列索引 (receiveqN = 2N)
+pub const fn rxq2vq(n: usize) -> u16 {
+    (2 * n) as u16
+}
+
+/// 第 n 对队列的发送队列索引 (transmitqN = 2N + 1)
+pub const fn txq2vq(n: usize) -> u16 {
+    (2 * n + 1) as u16
+}
+
+/// 控制队列索引，在所有数据队列之后 (2 * max_virtqueue_pairs)
+pub const fn ctrlq2vq(max_pairs: usize) -> u16 {
+    (2 * max_pairs) as u16
+}
+
+/// 按当前 CPU 选择队列对 (virtnet_select_queue)
+///
+/// 队列对少于 CPU 时多个 CPU 共用一对
+pub fn select_queue_pair(cpu: usize, nr_pairs: usize) -> usize {
+    cpu % nr_pairs.max(1)
+}
+
+/// 每个队列的描述符数；接收缓冲区每个占 2 个
+const VIRTIO_NET_QUEUE_SIZE: u16 = 128;
+
+/// 接收缓冲区大小：以太网头 + VLAN 标签 + 1500 字节 MTU (GOOD_PACKET_LEN)
+const VIRTIO_NET_RX_BUF_LEN: u32 = 14 + 4 + 1500;
+
+/// 每轮 NAPI 轮询最多处理的数据包数 (NAPI_POLL_WEIGHT)
+pub const NAPI_POLL_WEIGHT: usize = 64;
+
+/// 忙轮询每轮最多处理的数据包数 (BUSY_POLL_BUDGET)
+pub const BUSY_POLL_BUDGET: usize = 8;
+
+/// 特性位：设备可完成部分校验和 (VIRTIO_NET_F_CSUM)
+const VIRTIO_NET_F_CSUM: u32 = 1 << 0;
+/// 特性位：驱动接受部分校验和的包 (VIRTIO_NET_F_GUEST_CSUM)
+const VIRTIO_NET_F_GUEST_CSUM: u32 = 1 << 1;
+/// 特性位：设备能切分 TCPv4 超长包 (VIRTIO_NET_F_HOST_TSO4)
+const VIRTIO_NET_F_HOST_TSO4: u32 = 1 << 11;
+/// 特性位：设备提供 MTU (VIRTIO_NET_F_MTU)
+const VIRTIO_NET_F_MTU: u32 = 1 << 3;
+/// 特性位：设备提供 MAC (VIRTIO_NET_F_MAC)
+const VIRTIO_NET_F_MAC: u32 = 1 << 5;
+/// 特性位：控制队列 (VIRTIO_NET_F_CTRL_VQ)
+const VIRTIO_NET_F_CTRL_VQ: u32 = 1 << 17;
+/// 特性位：多队列 (VIRTIO_NET_F_MQ)
+const VIRTIO_NET_F_MQ: u32 = 1 << 22;
+
+/// 包头标志：需要设备从 csum_start 起完成校验和 (VIRTIO_NET_HDR_F_NEEDS_CSUM)
+const VIRTIO_NET_HDR_F_NEEDS_CSUM: u8 = 1;
+/// 包头标志：设备已验证校验和 (VIRTIO_NET_HDR_F_DATA_VALID)
+const VIRTIO_NET_HDR_F_DATA_VALID: u8 = 2;
+/// 包头分段类型：不分段 (VIRTIO_NET_HDR_GSO_NONE)
+const VIRTIO_NET_HDR_GSO_NONE: u8 = 0;
+/// 包头分段类型：TCPv4 (VIRTIO_NET_HDR_GSO_TCPV4)
+const VIRTIO_NET_HDR_GSO_TCPV4: u8 = 1;
+
+/// 控制命令类别：多队列 (VIRTIO_NET_CTRL_MQ)
+const VIRTIO_NET_CTRL_MQ: u8 = 4;
+/// 多队列命令：设置使用的队列对数 (VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET)
+const VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET: u8 = 0;
+/// 控制命令成功 (VIRTIO_NET_OK)
+const VIRTIO_NET_OK: u8 = 0;
+/// 特性位：VirtIO 1.0，位于第二个特性字 (VIRTIO_F_VERSION_1 = 32)
+const VIRTIO_F_VERSION_1_HI: u32 = 1 << (32 - 32);
+
+/// NAPI 状态：轮询已被某个执行者占有 (NAPI_STATE_SCHED)
+const NAPI_STATE_SCHED: u8 = 1 << 0;
+/// NAPI 状态：占有期间又来了中断 (NAPI_STATE_MISSED)
+const NAPI_STATE_MISSED: u8 = 1 << 1;
+
+/// NAPI 调度状态 (struct napi_struct.state)
+///
+/// 同一时刻只有一个执行者（中断或进程上下文）在轮询；
+/// 轮询期间到来的中断只留下 MISSED 标记，由轮询者在结束前再跑一轮
+pub struct NapiState {
+    state: AtomicU8,
+}
+
+impl NapiState {
+    pub const fn new() -> Self {
+        Self { state: AtomicU8::new(0) }
+    }
+
+    /// 尝试占有轮询 (napi_schedule_prep)
+    ///
+    /// # 返回
+    /// 调用者成为轮询者时返回 true；已有轮询者时记下 MISSED 并返回 false
+    pub fn schedule_prep(&self) -> bool {
+        let mut cur = self.state.load(Ordering::Acquire);
+        loop {
+            let new = if cur & NAPI_STATE_SCHED != 0 { cur | NAPI_STATE_MISSED } else { cur | NAPI_STATE_SCHED };
+            match self.state.compare_exchange_weak(cur, new, Ordering::AcqRel, Ordering::Acquire) {
+                Ok(_) => return cur & NAPI_STATE_SCHED == 0,
+                Err(actual) => cur = actual,
+            }
+        }
+    }
+
+    /// 进程上下文忙轮询尝试占有轮询，已有轮询者时不留 MISSED 标记 (napi_busy_loop)
+    ///
+    /// # 返回
+    /// 调用者成为轮询者时返回 true
+    pub fn busy_poll_prep(&self) -> bool {
+        self.state.fetch_or(NAPI_STATE_SCHED, Ordering::AcqRel) & NAPI_STATE_SCHED == 0
+    }
+
+    /// 结束轮询 (napi_complete_done)
+    ///
+    /// # 返回
+    /// 释放了轮询权时返回 true；有 MISSED 标记时清除它并返回 false，调用者继续轮询
+    pub fn complete(&self) -> bool {
+        let mut cur = self.state.load(Ordering::Acquire);
+        loop {
+            let new = if cur & NAPI_STATE_MISSED != 0 { cur & !NAPI_STATE_MISSED } else { cur & !NAPI_STATE_SCHED };
+            match self.state.compare_exchange_weak(cur, new, Ordering::AcqRel, Ordering::Acquire) {
+                Ok(_) => return cur & NAPI_STATE_MISSED == 0,
+                Err(actual) => cur = actual,
+            }
+        }
+    }
+}
+
+/// 内核虚拟地址转换为设备使用的物理地址
+#[inline]
+fn virt_to_phys(addr: u64) -> u64 {
+    #[cfg(feature = "riscv64")]
+    {
+        crate::arch::riscv64::mm::virt_to_phys(crate::arch::riscv64::mm::VirtAddr::new(addr)).0
+    }
+    #[cfg(not(feature = "riscv64"))]
+    {
+        addr
+    }
+}
+
+/// 发送队列 (struct send_queue)
+struct VirtNetTx {
+    vq: queue::VirtQueue,
+    /// 包头池，按链头描述符索引
+    hdrs: queue::DmaPool<VirtIONetHdr>,
+}
+
+/// 一对收发队列，发送按当前 CPU 选择，接收由各自的 NAPI 状态保护
+struct VirtNetQueuePair {
+    rx: Mutex<Option<VirtNetRx>>,
+    napi: NapiState,
+    tx: Mutex<Option<VirtNetTx>>,
+}
+
+impl VirtNetQueuePair {
+    const fn new() -> Self {
+        Self { rx: Mutex::new(None), napi: NapiState::new(), tx: Mutex::new(None) }
+    }
+}
+
+/// 接收队列 (struct receive_queue)
+///
+/// 每个接收缓冲区占两个描述符：按链头索引的包头，和一个 SkBuff 的数据区
+struct VirtNetRx {
+    vq: queue::VirtQueue,
+    /// 包头池，按链头描述符索引
+    hdrs: queue::DmaPool<VirtIONetHdr>,
+    /// 已放入队列的 SkBuff，按链头描述符索引
+    skbs: Vec<Option<SkBuff>>,
+    /// 丢弃的数据包留下的 SkBuff，补充时优先重用 (page_pool 回收)
+    spare: Vec<SkBuff>,
+}
+
+impl VirtNetRx {
+    /// 补充接收缓冲区，整批放入后只通知一次 (try_fill_recv)
+    ///
+    /// # 返回
+    /// 本次放入的缓冲区数
+    fn fill(&mut self) -> usize {
+        let mut added = 0;
+        while self.vq.num_free() >= 2 {
+            let head = match self.vq.next_head() {
+                Some(head) => head as usize,
+                None => break,
+            };
+            let skb = match self.spare.pop() {
+                Some(skb) => skb,
+                None => match SkBuff::alloc(VIRTIO_NET_RX_BUF_LEN) {
+                    Some(skb) => skb,
+                    None => break,
+                },
+            };
+            let mut bufs = Vec::with_capacity(3);
+            bufs.push((self.hdrs.phys(head), core::mem::size_of::<VirtIONetHdr>() as u32, true));
+            queue::buf_to_sg(skb.data as usize, VIRTIO_NET_RX_BUF_LEN as usize, true, &mut bufs);
+            if self.vq.add_buf(&bufs, head).is_none() {
+                skb.free();
+                break;
+            }
+            self.skbs[head] = Some(skb);
+            added += 1;
+        }
+        if added > 0 {
+            self.vq.kick();
+        }
+        added
+    }
+
+    /// 保留丢弃的接收缓冲区供下次补充，不归还再分配
+    fn recycle(&mut self, mut skb: SkBuff) {
+        if self.spare.len() < self.vq.queue_size as usize {
+            skb.skb_recycle();
+            self.spare.push(skb);
+            crate::net::skb_pool::skb_pool_note_recycle();
+        } else {
+            skb.free();
+        }
+    }
+
+    /// 取出最多 budget 个已收到的数据包 (virtnet_receive)
+    ///
+    /// 装有 XDP 程序时每个帧先经过程序 (virtnet_xdp_handler)：丢弃的帧直接回收缓冲区，
+    /// TX 与 REDIRECT 的帧放入 xmit，由调用者释放队列锁后发送
+    ///
+    /// # 返回
+    /// 取出的描述符数、有效帧的字节数、有效帧数（含被 XDP 截留的）
+    fn receive(
+        &mut self,
+        budget: usize,
+        xdp: Option<(&XdpProg, &XdpHook)>,
+        out: &mut Vec<SkBuff>,
+        xmit: &mut Vec<(SkBuff, u32)>,
+    ) -> (usize, u64, usize) {
+        let hdr_len = core::mem::size_of::<VirtIONetHdr>() as u32;
+        let mut bytes = 0;
+        let mut received = 0;
+        let mut valid = 0;
+        while received < budget {
+            let (head, len) = match self.vq.get_buf() {
+                Some(buf) => buf,
+                None => break,
+            };
+            let mut skb = match self.skbs.get_mut(head).and_then(|slot| slot.take()) {
+                Some(skb) => skb,
+                None => continue,
+            };
+            received += 1;
+            if len <= hdr_len || len - hdr_len > VIRTIO_NET_RX_BUF_LEN {
+                self.recycle(skb);
+                continue;
+            }
+            let pkt_len = len - hdr_len;
+            if skb.skb_put(pkt_len).is_none() {
+                self.recycle(skb);
+                continue;
+            }
+            bytes += pkt_len as u64;
+            valid += 1;
+            if let Some((prog, hook)) = xdp {
+                let frame = unsafe { core::slice::from_raw_parts(skb.data, pkt_len as usize) };
+                let (action, ifindex) = prog.run(frame);
+                hook.count(action);
+                match action {
+                    XdpAction::Pass => {}
+                    XdpAction::Tx => {
+                        xmit.push((skb, 0));
+                        continue;
+                    }
+                    XdpAction::Redirect => {
+                        xmit.push((skb, ifindex));
+                        continue;
+                    }
+                    _ => {
+                        self.recycle(skb);
+                        continue;
+                    }
+                }
+            }
+            // 设备已验证，或包来自本机另一端、校验和尚未填写 (virtio_net_hdr_to_skb)
+            if self.hdrs.read(head).flags & (VIRTIO_NET_HDR_F_DATA_VALID | VIRTIO_NET_HDR_F_NEEDS_CSUM) != 0 {
+                skb.ip_summed = CHECKSUM_UNNECESSARY;
+            }
+            out.push(skb);
+        }
+        // 空出一半以上时补充，避免每个包都通知设备
+        if self.vq.num_free() as usize * 2 >= self.vq.queue_size as usize {
+            self.fill();
+        }
+        (received, bytes, valid)
+    }
+}
+
 /// VirtIO 网络设备寄存器布局
 ///
 /// 对应 VirtIO 网络设备的 MMIO 寄存器
@@ -87,6 +382,35 @@ pub struct VirtIONetHdr {
     pub num_buffers: u16,
 }
 
+/// 按 SkBuff 的卸载信息填写发送包头 (virtio_net_hdr_from_skb)
+///
+/// csum_start 相对于以太网帧开头，即发送时的 skb.data
+fn xmit_hdr(skb: &SkBuff) -> VirtIONetHdr {
+    let mut hdr = VirtIONetHdr {
+        flags: 0,
+        gso_type: VIRTIO_NET_HDR_GSO_NONE,
+        hdr_len: 0,
+        gso_size: 0,
+        csum_start: 0,
+        csum_offset: 0,
+        num_buffers: 0,
+    };
+    if skb.ip_summed == CHECKSUM_PARTIAL {
+        hdr.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+        hdr.csum_start = skb.skb_checksum_start_offset() as u16;
+        hdr.csum_offset = skb.csum_offset;
+    }
+    if skb.is_gso() && skb.gso_type & SKB_GSO_TCPV4 != 0 {
+        hdr.gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
+        hdr.gso_size = skb.gso_size;
+        // 协议头总长：TCP 头起点加数据偏移
+        let tcp = hdr.csum_start as usize;
+        let doff = unsafe { (*skb.data.add(tcp + 12) >> 4) as u16 } * 4;
+        hdr.hdr_len = hdr.csum_start + doff;
+    }
+    hdr
+}
+
 /// VirtIO 网络设备
 pub struct VirtIONetDevice {
     /// MMIO 基地址
@@ -95,16 +419,26 @@ pub struct VirtIONetDevice {
     mac: [u8; 6],
     /// MTU
     mtu: u16,
-    /// 初始化状态
-    initialized: Mutex<bool>,
-    /// 发送队列 (TX Queue - Queue 0)
-    tx_queue: Mutex<Option<queue::VirtQueue>>,
-    /// 接收队列 (RX Queue - Queue 1)
-    rx_queue: Mutex<Option<queue::VirtQueue>>,
+    /// 初始化状态；发送路径每次都检查，不使用锁
+    initialized: AtomicBool,
+    /// 收发队列对，最多每个 CPU 一对
+    pairs: [VirtNetQueuePair; MAX_CPUS],
+    /// 使用中的队列对数 (curr_queue_pairs)
+    nr_pairs: AtomicUsize,
+    /// 收发统计在多个 CPU 与中断上下文更新，不使用 stats 锁
+    rx_packets: AtomicU64,
+    rx_bytes: AtomicU64,
+    rx_dropped: AtomicU64,
+    tx_packets: AtomicU64,
+    tx_bytes: AtomicU64,
+    /// 协商得到的卸载能力，见 netdev_features
+    features: u32,
     /// 队列大小
     queue_size: u16,
     /// 统计信息
     stats: Mutex<DeviceStats>,
+    /// 接收轮询中的早期包过滤
+    xdp: XdpHook,
 }
 
 unsafe impl Send for VirtIONetDevice {}
@@ -116,32 +450,33 @@ impl VirtIONetDevice {
             base_addr,
             mac: [0; 6],
             mtu: 1500,
-            initialized: Mutex::new(false),
-            tx_queue: Mutex::new(None),
-            rx_queue: Mutex::new(None),
+            initialized: AtomicBool::new(false),
+            pairs: [const { VirtNetQueuePair::new() }; MAX_CPUS],
+            nr_pairs: AtomicUsize::new(1),
+            rx_packets: AtomicU64::new(0),
+            rx_bytes: AtomicU64::new(0),
+            rx_dropped: AtomicU64::new(0),
+            tx_packets: AtomicU64::new(0),
+            tx_bytes: AtomicU64::new(0),
+            features: 0,
             queue_size: 0,
             stats: Mutex::new(DeviceStats::default()),
+            xdp: XdpHook::new(),
         }
     }
 
-    /// 初始化设备
+    /// 初始化设备 (virtnet_probe)
     pub fn init(&mut self) -> Result<(), &'static str> {
         unsafe {
-            // VirtIO MMIO 寄存器偏移量
-            const MAGIC_VALUE: u64 = 0x00;
-            const VERSION: u64 = 0x04;
-            const DEVICE_ID: u64 = 0x08;
-            const VENDOR: u64 = 0x0C;
-            const DEVICE_FEATURES: u64 = 0x14;
-            const QUEUE_SEL: u64 = 0x30;
-            const QUEUE_NUM_MAX: u64 = 0x34;
-            const QUEUE_NUM: u64 = 0x38;
-            const QUEUE_READY: u64 = 0x3C;
-            const QUEUE_NOTIFY: u64 = 0x40;
-            const STATUS: u64 = 0x50;
-            const QUEUE_DESC: u64 = 0xA0;
-            const QUEUE_DRIVER: u64 = 0xA8;
-            const QUEUE_DEVICE: u64 = 0xB0;
+            // VirtIO MMIO 寄存器偏移量 (Modern VirtIO 1.0+)
+            const MAGIC_VALUE: u64 = 0x000;
+            const VERSION: u64 = 0x004;
+            const DEVICE_ID: u64 = 0x008;
+            const DEVICE_FEATURES: u64 = 0x010;
+            const DEVICE_FEATURES_SEL: u64 = 0x014;
+            const DRIVER_FEATURES: u64 = 0x020;
+            const DRIVER_FEATURES_SEL: u64 = 0x024;
+            const STATUS: u64 = 0x070;
 
             // 验证魔数
             let magic = core::ptr::read_volatile((self.base_addr + MAGIC_VALUE) as *const u32);
@@ -151,7 +486,7 @@ impl VirtIONetDevice {
 
             // 验证版本
             let version = core::ptr::read_volatile((self.base_addr + VERSION) as *const u32);
-            if version != 1 && version != 2 {
+            if version != 2 {
                 return Err("Unsupported VirtIO version");
             }
 
@@ -161,12 +496,36 @@ impl VirtIONetDevice {
                 return Err("Not a VirtIO network device");
             }
 
-            // 设置驱动状态：ACKNOWLEDGE
+            // 重置后设置驱动状态：ACKNOWLEDGE | DRIVER
+            core::ptr::write_volatile((self.base_addr + STATUS) as *mut u32, 0x00);
             core::ptr::write_volatile((self.base_addr + STATUS) as *mut u32, 0x01);
-
-            // 设置驱动状态：DRIVER
             core::ptr::write_volatile((self.base_addr + STATUS) as *mut u32, 0x03);
 
+            // 特性协商：MAC、MTU、校验和与 TSO 卸载、多队列、事件索引和 VERSION_1
+            core::ptr::write_volatile((self.base_addr + DEVICE_FEATURES_SEL) as *mut u32, 0);
+            let features = core::ptr::read_volatile((self.base_addr + DEVICE_FEATURES) as *const u32);
+            core::ptr::write_volatile((self.base_addr + DEVICE_FEATURES_SEL) as *mut u32, 1);
+            let features_hi = core::ptr::read_volatile((self.base_addr + DEVICE_FEATURES) as *const u32);
+            let mut driver_features = features
+                & (VIRTIO_NET_F_MTU | VIRTIO_NET_F_MAC | queue::VIRTIO_RING_F_EVENT_IDX);
+            // 发送校验和卸载；TSO 依赖设备完成校验和
+            if features & VIRTIO_NET_F_CSUM != 0 {
+                driver_features |= VIRTIO_NET_F_CSUM | (features & VIRTIO_NET_F_HOST_TSO4);
+            }
+            driver_features |= features & VIRTIO_NET_F_GUEST_CSUM;
+            // 多队列依赖控制队列下发队列对数
+            if features & (VIRTIO_NET_F_MQ | VIRTIO_NET_F_CTRL_VQ) == VIRTIO_NET_F_MQ | VIRTIO_NET_F_CTRL_VQ {
+                driver_features |= VIRTIO_NET_F_MQ | VIRTIO_NET_F_CTRL_VQ;
+            }
+            core::ptr::write_volatile((self.base_addr + DRIVER_FEATURES_SEL) as *mut u32, 0);
+            core::ptr::write_volatile((self.base_addr + DRIVER_FEATURES) as *mut u32, driver_features);
+            core::ptr::write_volatile((self.base_addr + DRIVER_FEATURES_SEL) as *mut u32, 1);
+            core::ptr::write_volatile((self.base_addr + DRIVER_FEATURES) as *mut u32, features_hi & VIRTIO_F_VERSION_1_HI);
+            core::ptr::write_volatile((self.base_addr + STATUS) as *mut u32, 0x0B);
+            if core::ptr::read_volatile((self.base_addr + STATUS) as *const u32) & 0x08 == 0 {
+                return Err("VirtIO-Net rejected features");
+            }
+
             // 读取 MAC 地址 (从配置空间，偏移 0x100)
             // 在 QEMU virt 平台中，MAC 地址在配置空间的偏移 0 处
             let config_ptr = (self.base_addr + 0x100) as *const u8;
@@ -174,133 +533,175 @@ impl VirtIONetDevice {
                 self.mac[i] = *config_ptr.add(i);
             }
 
-            // 读取 MTU (从偏移 0x106)
-            let mtu_ptr = (self.base_addr + 0x106) as *const u16;
-            self.mtu = core::ptr::read_volatile(mtu_ptr);
-            if self.mtu == 0 {
-                self.mtu = 1500; // 默认 MTU
+            // 协商结果换算为协议栈使用的设备特性；发送总是按分散/聚集组链
+            self.features = netdev_features::NETIF_F_SG;
+            if driver_features & VIRTIO_NET_F_CSUM != 0 {
+                self.features |= netdev_features::NETIF_F_HW_CSUM;
             }
-
-            // ========== 设置 TX 队列 (Queue 0) ==========
-            // 选择队列 0
-            core::ptr::write_volatile((self.base_addr + QUEUE_SEL) as *mut u32, 0);
-
-            // 读取最大队列大小
-            let max_queue_size = core::ptr::read_volatile((self.base_addr + QUEUE_NUM_MAX) as *const u32);
-            if max_queue_size == 0 {
-                return Err("VirtIO device has zero queue size");
+            if driver_features & VIRTIO_NET_F_HOST_TSO4 != 0 {
+                self.features |= netdev_features::NETIF_F_TSO;
             }
-
-            // 设置队列大小
-            self.queue_size = if max_queue_size < 8 { 4 } else { 8 };
-
-            // 分配描述符表
-            let desc_size = self.queue_size as usize * core::mem::size_of::<queue::Desc>();
-            let desc_layout = alloc::alloc::Layout::from_size_align(desc_size, 16)
-                .map_err(|_| "Failed to create descriptor layout")?;
-            let desc_ptr = alloc::alloc::alloc(desc_layout) as *mut queue::Desc;
-            if desc_ptr.is_null() {
-                return Err("Failed to allocate TX descriptor table");
+            if driver_features & VIRTIO_NET_F_GUEST_CSUM != 0 {
+                self.features |= netdev_features::NETIF_F_RXCSUM;
             }
 
-            // 初始化描述符表
-            let desc_slice = core::slice::from_raw_parts_mut(desc_ptr, self.queue_size as usize);
-            for desc in desc_slice.iter_mut() {
-                *desc = queue::Desc {
-                    addr: 0,
-                    len: 0,
-                    flags: 0,
-                    next: 0,
-                };
+            // 读取 MTU (从偏移 0x10A，struct virtio_net_config.mtu)
+            if driver_features & VIRTIO_NET_F_MTU != 0 {
+                let mtu_ptr = (self.base_addr + 0x10A) as *const u16;
+                self.mtu = core::ptr::read_volatile(mtu_ptr);
+            }
+            if self.mtu == 0 || self.mtu > 1500 {
+                self.mtu = 1500; // 默认 MTU；接收缓冲区按 1500 分配
             }
 
-            // 设置队列地址
-            core::ptr::write_volatile((self.base_addr + QUEUE_DESC) as *mut u64, desc_ptr as u64);
-            core::ptr::write_volatile((self.base_addr + QUEUE_DRIVER) as *mut u64, 0);
-            core::ptr::write_volatile((self.base_addr + QUEUE_DEVICE) as *mut u64, 0);
-
-            // 设置队列数量
-            core::ptr::write_volatile((self.base_addr + QUEUE_NUM) as *mut u32, self.queue_size as u32);
-
-            // 设置队列就绪
-            core::ptr::write_volatile((self.base_addr + QUEUE_READY) as *mut u32, 1);
-
-            // 创建 VirtQueue
-            let tx_queue = match queue::VirtQueue::new(
-                self.queue_size,
-                0,  // queue_index: TX queue is queue 0
-                self.base_addr + QUEUE_NOTIFY,
-                self.base_addr + 0x60,  // interrupt_status offset
-                self.base_addr + 0x64,  // interrupt_ack offset
-            ) {
-                Some(q) => q,
-                None => {
-                    alloc::alloc::dealloc(desc_ptr as *mut u8, desc_layout);
-                    return Err("Failed to create TX VirtQueue");
-                }
+            // 设备支持的队列对数 (virtio_net_config.max_virtqueue_pairs，偏移 0x108)
+            let max_pairs = if driver_features & VIRTIO_NET_F_MQ != 0 {
+                (core::ptr::read_volatile((self.base_addr + 0x108) as *const u16) as usize).max(1)
+            } else {
+                1
             };
-            *self.tx_queue.lock() = Some(tx_queue);
-
-            // ========== 设置 RX 队列 (Queue 1) ==========
-            // 选择队列 1
-            core::ptr::write_volatile((self.base_addr + QUEUE_SEL) as *mut u32, 1);
+            let nr_pairs = max_pairs.min(MAX_CPUS);
+
+            // ========== 设置各队列对：RX = 2N, TX = 2N + 1 ==========
+            for n in 0..nr_pairs {
+                let mut rx_queue = self.setup_queue(rxq2vq(n))?;
+                let mut tx_queue = self.setup_queue(txq2vq(n))?;
+                if driver_features & queue::VIRTIO_RING_F_EVENT_IDX != 0 {
+                    rx_queue.enable_event_idx();
+                    tx_queue.enable_event_idx();
+                }
+                // 发送完成在 xmit 中同步收割，不需要发送中断
+                tx_queue.disable_cb();
+                self.queue_size = tx_queue.queue_size;
 
-            // 分配描述符表
-            let desc_ptr_rx = alloc::alloc::alloc(desc_layout) as *mut queue::Desc;
-            if desc_ptr_rx.is_null() {
-                alloc::alloc::dealloc(desc_ptr as *mut u8, desc_layout);
-                return Err("Failed to allocate RX descriptor table");
-            }
+                let tx_hdrs = match queue::DmaPool::new(tx_queue.queue_size as usize, VirtIONetHdr {
+                    flags: 0,
+                    gso_type: 0,
+                    hdr_len: 0,
+                    gso_size: 0,
+                    csum_start: 0,
+                    csum_offset: 0,
+                    num_buffers: 1,
+                }) {
+                    Some(pool) => pool,
+                    None => return Err("Failed to allocate TX header pool"),
+                };
+                *self.pairs[n].tx.lock() = Some(VirtNetTx { vq: tx_queue, hdrs: tx_hdrs });
 
-            // 初始化描述符表
-            let desc_slice_rx = core::slice::from_raw_parts_mut(desc_ptr_rx, self.queue_size as usize);
-            for desc in desc_slice_rx.iter_mut() {
-                *desc = queue::Desc {
-                    addr: 0,
-                    len: 0,
+                let rx_hdrs = match queue::DmaPool::new(rx_queue.queue_size as usize, VirtIONetHdr {
                     flags: 0,
-                    next: 0,
+                    gso_type: 0,
+                    hdr_len: 0,
+                    gso_size: 0,
+                    csum_start: 0,
+                    csum_offset: 0,
+                    num_buffers: 0,
+                }) {
+                    Some(pool) => pool,
+                    None => return Err("Failed to allocate RX header pool"),
                 };
+                let skbs = (0..rx_queue.queue_size).map(|_| None).collect();
+                *self.pairs[n].rx.lock() = Some(VirtNetRx { vq: rx_queue, hdrs: rx_hdrs, skbs, spare: Vec::new() });
             }
 
-            // 设置队列地址
-            core::ptr::write_volatile((self.base_addr + QUEUE_DESC) as *mut u64, desc_ptr_rx as u64);
-            core::ptr::write_volatile((self.base_addr + QUEUE_DRIVER) as *mut u64, 0);
-            core::ptr::write_volatile((self.base_addr + QUEUE_DEVICE) as *mut u64, 0);
-
-            // 设置队列数量
-            core::ptr::write_volatile((self.base_addr + QUEUE_NUM) as *mut u32, self.queue_size as u32);
-
-            // 设置队列就绪
-            core::ptr::write_volatile((self.base_addr + QUEUE_READY) as *mut u32, 1);
-
-            // 创建 VirtQueue
-            let rx_queue = match queue::VirtQueue::new(
-                self.queue_size,
-                1,  // queue_index: RX queue is queue 1
-                self.base_addr + QUEUE_NOTIFY,
-                self.base_addr + 0x60,  // interrupt_status offset
-                self.base_addr + 0x64,  // interrupt_ack offset
-            ) {
-                Some(q) => q,
-                None => {
-                    alloc::alloc::dealloc(desc_ptr as *mut u8, desc_layout);
-                    alloc::alloc::dealloc(desc_ptr_rx as *mut u8, desc_layout);
-                    return Err("Failed to create RX VirtQueue");
-                }
+            // 控制队列在所有数据队列之后
+            let ctrl_queue = if driver_features & VIRTIO_NET_F_CTRL_VQ != 0 {
+                Some(self.setup_queue(ctrlq2vq(max_pairs))?)
+            } else {
+                None
             };
-            *self.rx_queue.lock() = Some(rx_queue);
 
             // 设置驱动状态：DRIVER_OK
-            core::ptr::write_volatile((self.base_addr + STATUS) as *mut u32, 0x07);
+            core::ptr::write_volatile((self.base_addr + STATUS) as *mut u32, 0x0F);
+
+            // 启用多个队列对；设备默认只用第一对，失败时保持单队列
+            if let Some(mut ctrl) = ctrl_queue {
+                if nr_pairs > 1 && Self::set_queue_pairs(&mut ctrl, nr_pairs as u16) {
+                    self.nr_pairs.store(nr_pairs, Ordering::Release);
+                }
+            }
+
+            // 预先放入接收缓冲区，之后设备才能交付数据包
+            for n in 0..self.nr_pairs.load(Ordering::Acquire) {
+                if let Some(rx) = self.pairs[n].rx.lock().as_mut() {
+                    if rx.fill() == 0 {
+                        return Err("Failed to post RX buffers");
+                    }
+                }
+            }
 
             // 标记为已初始化
-            *self.initialized.lock() = true;
+            self.initialized.store(true, Ordering::Release);
 
             Ok(())
         }
     }
 
+    /// 通过控制队列设置使用的队列对数 (virtnet_set_queues)
+    fn set_queue_pairs(ctrl: &mut queue::VirtQueue, pairs: u16) -> bool {
+        // 命令头 (class, cmd)、参数 virtqueue_pairs、设备写回的 ack
+        let buf = match queue::DmaPool::new(1, [0u8; 8]) {
+            Some(buf) => buf,
+            None => return false,
+        };
+        let pairs = pairs.to_le_bytes();
+        buf.write(0, [VIRTIO_NET_CTRL_MQ, VIRTIO_NET_CTRL_MQ_VQ_PAIRS_SET, pairs[0], pairs[1], 0xFF, 0, 0, 0]);
+        let phys = buf.phys(0);
+        let bufs = [(phys, 2, false), (phys + 2, 2, false), (phys + 4, 1, true)];
+        let prev_used = ctrl.get_used();
+        if ctrl.add_buf(&bufs, 0).is_none() {
+            return false;
+        }
+        ctrl.notify();
+        ctrl.wait_for_completion(prev_used);
+        while ctrl.get_buf().is_some() {}
+        buf.read(0)[4] == VIRTIO_NET_OK
+    }
+
+    /// 配置一个队列并返回驱动侧的 VirtQueue (vm_setup_vq)
+    unsafe fn setup_queue(&self, index: u16) -> Result<queue::VirtQueue, &'static str> {
+        const QUEUE_SEL: u64 = 0x030;
+        const QUEUE_NUM_MAX: u64 = 0x034;
+        const QUEUE_NUM: u64 = 0x038;
+        const QUEUE_READY: u64 = 0x044;
+        const QUEUE_NOTIFY: u64 = 0x050;
+        const INTERRUPT_STATUS: u64 = 0x060;
+        const INTERRUPT_ACK: u64 = 0x064;
+        const QUEUE_DESC_LO: u64 = 0x080;
+        const QUEUE_DRIVER_LO: u64 = 0x090;
+        const QUEUE_DEVICE_LO: u64 = 0x0a0;
+
+        let write = |offset: u64, val: u32| core::ptr::write_volatile((self.base_addr + offset) as *mut u32, val);
+        let write64 = |offset: u64, val: u64| {
+            write(offset, val as u32);
+            write(offset + 4, (val >> 32) as u32);
+        };
+
+        write(QUEUE_SEL, index as u32);
+        let max_queue_size = core::ptr::read_volatile((self.base_addr + QUEUE_NUM_MAX) as *const u32);
+        if max_queue_size == 0 {
+            return Err("VirtIO device has zero queue size");
+        }
+        let size = (max_queue_size as u16).min(VIRTIO_NET_QUEUE_SIZE);
+        write(QUEUE_NUM, size as u32);
+
+        let vq = match queue::VirtQueue::new(
+            size,
+            index,
+            self.base_addr + QUEUE_NOTIFY,
+            self.base_addr + INTERRUPT_STATUS,
+            self.base_addr + INTERRUPT_ACK,
+        ) {
+            Some(vq) => vq,
+            None => return Err("Failed to create VirtQueue"),
+        };
+        write64(QUEUE_DESC_LO, virt_to_phys(vq.get_desc_addr()));
+        write64(QUEUE_DRIVER_LO, virt_to_phys(vq.get_avail_addr()));
+        write64(QUEUE_DEVICE_LO, virt_to_phys(vq.get_used_addr()));
+        write(QUEUE_READY, 1);
+        Ok(vq)
+    }
+
     /// 获取 MAC 地址
     pub fn get_mac(&self) -> [u8; 6] {
         self.mac
@@ -311,6 +712,16 @@ impl VirtIONetDevice {
         self.mtu
     }
 
+    /// 使用中的队列对数 (curr_queue_pairs)
+    pub fn nr_queue_pairs(&self) -> usize {
+        self.nr_pairs.load(Ordering::Acquire)
+    }
+
+    /// 获取设备特性 (netdev->features)
+    pub fn features(&self) -> u32 {
+        self.features
+    }
+
     /// 发送数据包
     ///
     /// # 参数
@@ -319,89 +730,56 @@ impl VirtIONetDevice {
     /// # 返回
     /// 成功返回 0，失败返回负数错误码
     pub fn xmit(&self, skb: SkBuff) -> i32 {
-        if !*self.initialized.lock() {
+        if !self.initialized.load(Ordering::Acquire) {
             return -5; // EIO
         }
 
-        // 获取 TX 队列
-        let mut queue_guard = self.tx_queue.lock();
-        let queue = match queue_guard.as_mut() {
-            Some(q) => q,
+        // 按当前 CPU 选择发送队列，各 CPU 的发送互不争锁 (virtnet_select_queue)；
+        // 设备把一条流的接收交给最近发送它的队列对，接收随之落在同一 CPU
+        let qp = select_queue_pair(crate::arch::cpu_id() as usize, self.nr_pairs.load(Ordering::Relaxed));
+        let mut tx_guard = self.pairs[qp].tx.lock();
+        let tx = match tx_guard.as_mut() {
+            Some(tx) => tx,
             None => return -5, // EIO
         };
+        let queue = &mut tx.vq;
 
-        // 分配 VirtIO 网络包头
-        let hdr_layout = alloc::alloc::Layout::new::<VirtIONetHdr>();
-        let hdr_ptr: *mut VirtIONetHdr;
-        unsafe {
-            hdr_ptr = alloc::alloc::alloc(hdr_layout) as *mut VirtIONetHdr;
-        }
-        if hdr_ptr.is_null() {
-            return -12; // ENOMEM
-        }
-        unsafe {
-            *hdr_ptr = VirtIONetHdr {
-                flags: 0,
-                gso_type: 0,
-                hdr_len: 0,
-                gso_size: 0,
-                csum_start: 0,
-                csum_offset: 0,
-                num_buffers: 1,
-            };
-        }
-
-        // VirtIO 描述符标志
-        const VIRTQ_DESC_F_NEXT: u16 = 1;
-        const VIRTQ_DESC_F_WRITE: u16 = 2;
-
-        // 分配两个描述符
-        let header_desc_idx = match queue.alloc_desc() {
-            Some(idx) => idx,
-            None => return -5,  // EIO
-        };
-        let data_desc_idx = match queue.alloc_desc() {
-            Some(idx) => idx,
+        // 包头在预分配的池中按链头描述符索引，物理地址事先已知
+        let hdrs = &tx.hdrs;
+        let head = match queue.next_head() {
+            Some(head) => head as usize,
             None => return -5,  // EIO
         };
+        hdrs.write(head, xmit_hdr(&skb));
+
+        // 包头、线性区、各页片段组成一条描述符链 (xmit_skb + skb_to_sgvec)
+        let linear = (skb.len - skb.data_len) as usize;
+        let mut bufs = alloc::vec::Vec::with_capacity(2 + skb.nr_frags as usize);
+        bufs.push((hdrs.phys(head), core::mem::size_of::<VirtIONetHdr>() as u32, false));
+        if linear > 0 {
+            queue::buf_to_sg(skb.data as usize, linear, false, &mut bufs);
+        }
+        for frag in &skb.frags[..skb.nr_frags as usize] {
+            bufs.push(((frag.page + frag.offset as usize) as u64, frag.size, false));
+        }
 
-        // 设置包头描述符
-        queue.set_desc(
-            header_desc_idx,
-            hdr_ptr as u64,
-            core::mem::size_of::<VirtIONetHdr>() as u32,
-            VIRTQ_DESC_F_NEXT,
-            data_desc_idx,
-        );
-
-        // 设置数据描述符
-        queue.set_desc(
-            data_desc_idx,
-            skb.data as u64,
-            skb.len,
-            0,  // 最后一个描述符
-            0,
-        );
-
-        // 提交到可用环
-        queue.submit(header_desc_idx);
+        let prev_used = queue.get_used();
+        if queue.add_buf(&bufs, head).is_none() {
+            return -5;  // EIO
+        }
 
         // 通知设备
-        queue.notify();
+        queue.kick();
 
-        // 等待完成
-        let prev_used = queue.get_used();
+        // 等待完成后归还描述符
         let _used = queue.wait_for_completion(prev_used);
+        while queue.get_buf().is_some() {}
 
-        // 释放包头
-        unsafe {
-            alloc::alloc::dealloc(hdr_ptr as *mut u8, hdr_layout);
-        }
+        drop(tx_guard);
 
         // 更新统计信息
-        let mut stats = self.stats.lock();
-        stats.tx_packets += 1;
-        stats.tx_bytes += skb.len as u64;
+        self.tx_packets.fetch_add(1, Ordering::Relaxed);
+        self.tx_bytes.fetch_add(skb.len as u64, Ordering::Relaxed);
 
         // 释放 skb
         skb.free();
@@ -409,38 +787,157 @@ impl VirtIONetDevice {
         0
     }
 
-    /// 接收数据包
+    /// 预算内收取一个接收队列并整批交给以太网层 (virtnet_poll)
     ///
     /// # 返回
-    /// 返回接收到的数据包，如果没有数据包则返回 None
-    pub fn poll(&self) -> Option<SkBuff> {
-        if !*self.initialized.lock() {
+    /// 本轮处理的数据包数；小于 budget 表示队列已空
+    fn poll(&self, qp: usize, budget: usize) -> usize {
+        let mut batch = Vec::with_capacity(budget.min(NAPI_POLL_WEIGHT));
+        let mut xmit = Vec::new();
+        // 本轮使用同一个程序，装入与卸载从下一轮起生效
+        let prog = self.xdp.prog();
+        let xdp = prog.as_deref().map(|prog| (prog, &self.xdp));
+        let (received, bytes, valid) = match self.pairs[qp].rx.lock().as_mut() {
+            Some(rx) => rx.receive(budget, xdp, &mut batch, &mut xmit),
+            None => return 0,
+        };
+        if received > 0 {
+            self.rx_packets.fetch_add(valid as u64, Ordering::Relaxed);
+            self.rx_bytes.fetch_add(bytes, Ordering::Relaxed);
+            self.rx_dropped.fetch_add((received - valid) as u64, Ordering::Relaxed);
+        }
+        // 不持队列锁发送 XDP 截留的帧、交给协议栈
+        if !xmit.is_empty() {
+            self.xdp.flush(|skb| self.xmit(skb), xmit);
+        }
+        if !batch.is_empty() {
+            crate::net::ethernet::ethernet_rcv_list(batch);
+        }
+        received
+    }
+
+    /// 作为轮询者收取一个接收队列直到为空 (net_rx_action)
+    ///
+    /// 轮询期间关闭该队列的接收中断；收空后重新打开，打开后又有数据或
+    /// 期间来过中断时继续轮询，不会漏掉数据包
+    fn napi_poll_queue(&self, qp: usize) {
+        if self.pairs[qp].napi.schedule_prep() {
+            self.napi_drain(qp);
+        }
+    }
+
+    /// 已占有轮询权时收空队列，重新打开接收中断后交还轮询权
+    fn napi_drain(&self, qp: usize) {
+        let pair = &self.pairs[qp];
+        loop {
+            if let Some(rx) = pair.rx.lock().as_mut() {
+                rx.vq.disable_cb();
+            }
+            while self.poll(qp, NAPI_POLL_WEIGHT) == NAPI_POLL_WEIGHT {}
+
+            let drained = match pair.rx.lock().as_mut() {
+                Some(rx) => rx.vq.enable_cb(),
+                None => true,
+            };
+            if !drained {
+                continue;
+            }
+            if pair.napi.complete() {
+                break;
+            }
+        }
+    }
+
+    /// 轮询所有接收队列，从当前 CPU 对应的队列开始
+    ///
+    /// 其他 CPU 正在轮询的队列直接跳过
+    pub fn napi_poll(&self) {
+        let nr = self.nr_pairs.load(Ordering::Acquire);
+        let first = select_queue_pair(crate::arch::cpu_id() as usize, nr);
+        for i in 0..nr {
+            self.napi_poll_queue((first + i) % nr);
+        }
+    }
+
+    /// 开始忙轮询当前 CPU 对应的接收队列 (napi_busy_loop)
+    ///
+    /// 发送按 CPU 选择队列对，设备把一条流的接收交给最近发送它的队列对，
+    /// socket 的数据包因此落在这个队列上
+    ///
+    /// # 返回
+    /// 占有了轮询权时返回队列对编号，期间该队列的接收中断关闭；
+    /// 设备未初始化或队列正被中断下半部轮询时返回 None
+    pub fn busy_poll_start(&self) -> Option<usize> {
+        let nr = self.nr_pairs.load(Ordering::Acquire);
+        if nr == 0 || !self.initialized.load(Ordering::Acquire) {
             return None;
         }
+        let qp = select_queue_pair(crate::arch::cpu_id() as usize, nr);
+        let pair = &self.pairs[qp];
+        if !pair.napi.busy_poll_prep() {
+            return None;
+        }
+        if let Some(rx) = pair.rx.lock().as_mut() {
+            rx.vq.disable_cb();
+        }
+        Some(qp)
+    }
 
-        // 获取 RX 队列
-        let mut queue_guard = self.rx_queue.lock();
-        let queue = match queue_guard.as_mut() {
-            Some(q) => q,
-            None => return None,
-        };
+    /// 忙轮询一轮
+    ///
+    /// # 返回
+    /// 本轮处理的数据包数
+    pub fn busy_poll(&self, qp: usize) -> usize {
+        self.poll(qp, BUSY_POLL_BUDGET)
+    }
 
-        // 检查是否有已用的描述符
-        let used_idx = queue.get_used();
-        let avail_idx = queue.get_avail();
+    /// 结束忙轮询：收空队列、打开接收中断并交还轮询权 (busy_poll_stop)
+    pub fn busy_poll_stop(&self, qp: usize) {
+        self.napi_drain(qp);
+    }
 
-        if used_idx == avail_idx {
-            return None; // 没有新的数据包
+    /// 设备中断 (vm_interrupt + skb_recv_done)
+    ///
+    /// virtio-mmio 每个设备只有一条中断线，所有队列共用；硬中断只应答设备，
+    /// 已用环有更新时返回 WakeThread，收包在 NET_RX_SOFTIRQ 中开中断完成。
+    /// 中断按亲和性交给某个 hart，下半部也在该 hart 上执行
+    pub fn interrupt_handler(&self) -> IrqReturn {
+        let status = unsafe {
+            let status = core::ptr::read_volatile((self.base_addr + 0x60) as *const u32);
+            if status != 0 {
+                core::ptr::write_volatile((self.base_addr + 0x64) as *mut u32, status);
+            }
+            status
+        };
+        // bit 0：已用环有更新
+        if status & 1 != 0 {
+            IrqReturn::WakeThread
+        } else if status != 0 {
+            IrqReturn::Handled
+        } else {
+            IrqReturn::None
         }
+    }
 
-        // TODO: 从队列中读取数据包
-        // 当前简化实现：返回 None
-        None
+    /// 接收轮询中的 XDP 挂载点
+    pub fn xdp(&self) -> &XdpHook {
+        &self.xdp
+    }
+
+    /// 使用中的队列对数
+    pub fn queue_pairs(&self) -> usize {
+        self.nr_pairs.load(Ordering::Acquire)
     }
 
     /// 获取统计信息
     pub fn get_stats(&self) -> DeviceStats {
-        *self.stats.lock()
+        let mut stats = *self.stats.lock();
+        stats.rx_packets = self.rx_packets.load(Ordering::Relaxed);
+        stats.rx_bytes = self.rx_bytes.load(Ordering::Relaxed);
+        stats.rx_dropped = self.rx_dropped.load(Ordering::Relaxed);
+        stats.tx_packets = self.tx_packets.load(Ordering::Relaxed);
+        stats.tx_bytes = self.tx_bytes.load(Ordering::Relaxed);
+        stats
     }
 }
 
@@ -506,6 +1003,7 @@ pub fn init(base_addr: u64) -> Result<(), &'static str> {
             stats: DeviceStats::default(),
             flags: dev_flags::IFF_UP | dev_flags::IFF_RUNNING | dev_flags::IFF_BROADCAST,
             rx_queue_len: 0,
+            features: device.features(),
         };
 
         // 设置设备名
@@ -528,6 +1026,31 @@ pub fn init(base_addr: u64) -> Result<(), &'static str> {
     }
 }
 
+/// VirtIO-Net 设备中断入口
+pub fn interrupt_handler(_irq: usize) -> IrqReturn {
+    match get_device() {
+        Some(device) => device.interrupt_handler(),
+        None => IrqReturn::None,
+    }
+}
+
+/// VirtIO-Net 中断下半部 (NET_RX_SOFTIRQ, net_rx_action)
+///
+/// 在收到中断的 CPU 上开中断运行，从该 CPU 对应的队列对开始轮询
+fn net_rx_softirq() {
+    if let Some(device) = get_device() {
+        device.napi_poll();
+    }
+}
+
+/// 注册设备中断 (vp_request_intx)
+///
+/// 默认亲和性为所有可接收中断的 hart，可以通过 /proc/irq/N/smp_affinity 固定到某个 hart
+pub fn request_irq(irq: usize) -> Result<(), i32> {
+    crate::softirq::open_softirq_threaded(crate::softirq::NET_RX_SOFTIRQ, net_rx_softirq);
+    crate::irq::request_threaded_irq(irq, interrupt_handler, Some(crate::softirq::NET_RX_SOFTIRQ), "virtio-net")
+}
+
 /// 获取 VirtIO 网络设备
 pub fn get_device() -> Option<&'static VirtIONetDevice> {
     unsafe { VIRTIO_NET.as_ref() }
@@ -6,6 +6,8 @@
 //!
 //! 实现 PCI 配置空间访问和设备枚举
 
+pub mod msi;
+
 /// PCI 配置空间寄存器偏移
 pub mod offset {
     pub const VENDOR_ID: u8 = 0x00;
@@ -133,6 +135,14 @@ impl PCIConfig {
         }
     }
 
+    /// 写入 16 位配置空间寄存器
+    pub fn write_config_word(&self, offset: u8, value: u16) {
+        unsafe {
+            let ptr = (self.base_addr + offset as u64) as *mut u16;
+            core::ptr::write_volatile(ptr, value);
+        }
+    }
+
     /// 读取 8 位配置空间寄存器
     pub fn read_config_byte(&self, offset: u8) -> u8 {
         unsafe {
@@ -377,6 +387,28 @@ impl PCIConfig {
         self.read_config_word(offset::COMMAND)
     }
 
+    /// 在 capability 链表中查找指定 ID 的 capability (pci_find_capability)
+    ///
+    /// # 返回
+    /// capability 在配置空间中的偏移，设备没有 capability 链表或未找到时返回 None
+    pub fn find_capability(&self, cap_id: u8) -> Option<u8> {
+        if self.read_config_word(offset::STATUS) & status::CAPABILITIES_LIST == 0 {
+            return None;
+        }
+        let mut pos = self.read_config_byte(offset::CAPABILITIES_PTR) & !0x3;
+        // 链表最多 48 项 (PCI_FIND_CAP_TTL)，防止损坏的链表成环
+        for _ in 0..48 {
+            if pos < 0x40 {
+                return None;
+            }
+            if self.read_config_byte(pos) == cap_id {
+                return Some(pos);
+            }
+            pos = self.read_config_byte(pos + 1) & !0x3;
+        }
+        None
+    }
+
     /// 使能总线 mastering
     pub fn enable_bus_master(&self) {
         let current = self.command();
@@ -0,0 +1,271 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! PCI MSI / MSI-X
+//!
+//! 解析配置空间中的 MSI 与 MSI-X capability，编程 MSI-X 向量表。
+//! 设备写 MSI 消息（地址 + 数据）发出中断，不再占用共享的 INTx 线，
+//! 驱动可以为每个队列分配独立的向量。
+//!
+//! 参考: drivers/pci/msi/msi.c, include/uapi/linux/pci_regs.h
+//!
+//! # 设计
+//! - 消息的地址与数据由中断控制器 (IMSIC) 给出，这里只负责写入设备
+//! - 编程向量表期间置位 Function Mask，全部写完后再放开，避免设备用半写的表项发中断
+//! - 使能 MSI-X 后关闭 INTx (PCI_COMMAND_INTX_DISABLE)
+
+use super::{command, PCIConfig};
+
+/// MSI capability ID (PCI_CAP_ID_MSI)
+pub const PCI_CAP_ID_MSI: u8 = 0x05;
+/// MSI-X capability ID (PCI_CAP_ID_MSIX)
+pub const PCI_CAP_ID_MSIX: u8 = 0x11;
+
+/// MSI Message Control 寄存器位
+pub mod msi_flags {
+    pub const ENABLE: u16 = 0x0001;        // PCI_MSI_FLAGS_ENABLE
+    pub const QMASK: u16 = 0x000E;         // PCI_MSI_FLAGS_QMASK
+    pub const QSIZE: u16 = 0x0070;         // PCI_MSI_FLAGS_QSIZE
+    pub const ADDR_64: u16 = 0x0080;       // PCI_MSI_FLAGS_64BIT
+    pub const MASKBIT: u16 = 0x0100;       // PCI_MSI_FLAGS_MASKBIT
+}
+
+/// MSI-X Message Control 寄存器位
+pub mod msix_flags {
+    pub const QSIZE: u16 = 0x07FF;         // PCI_MSIX_FLAGS_QSIZE
+    pub const MASKALL: u16 = 0x4000;       // PCI_MSIX_FLAGS_MASKALL
+    pub const ENABLE: u16 = 0x8000;        // PCI_MSIX_FLAGS_ENABLE
+}
+
+/// MSI-X Table / PBA 寄存器中 BAR 编号所占的位 (PCI_MSIX_TABLE_BIR)
+const PCI_MSIX_BIR: u32 = 0x7;
+
+/// MSI-X 向量表项大小 (PCI_MSIX_ENTRY_SIZE)
+pub const PCI_MSIX_ENTRY_SIZE: u64 = 16;
+const PCI_MSIX_ENTRY_LOWER_ADDR: u64 = 0x0;
+const PCI_MSIX_ENTRY_UPPER_ADDR: u64 = 0x4;
+const PCI_MSIX_ENTRY_DATA: u64 = 0x8;
+const PCI_MSIX_ENTRY_VECTOR_CTRL: u64 = 0xC;
+/// 向量控制寄存器的屏蔽位 (PCI_MSIX_ENTRY_CTRL_MASKBIT)
+const PCI_MSIX_ENTRY_CTRL_MASKBIT: u32 = 0x1;
+
+/// MSI 消息 (struct msi_msg)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct MsiMsg {
+    /// 设备写入的地址
+    pub address: u64,
+    /// 写入的数据，即中断号
+    pub data: u32,
+}
+
+/// MSI capability
+#[derive(Debug, Clone, Copy)]
+pub struct MsiCapability {
+    /// capability 在配置空间中的偏移
+    pub pos: u8,
+    /// 支持 64 位消息地址
+    pub is_64: bool,
+    /// 支持按向量屏蔽
+    pub per_vector_mask: bool,
+    /// 设备可请求的向量数
+    pub max_vectors: u8,
+}
+
+impl MsiCapability {
+    /// 从 Message Control 寄存器解码
+    pub fn decode(pos: u8, control: u16) -> Self {
+        Self {
+            pos,
+            is_64: control & msi_flags::ADDR_64 != 0,
+            per_vector_mask: control & msi_flags::MASKBIT != 0,
+            max_vectors: 1 << ((control & msi_flags::QMASK) >> 1),
+        }
+    }
+
+    /// 读取设备的 MSI capability
+    pub fn parse(config: &PCIConfig) -> Option<Self> {
+        let pos = config.find_capability(PCI_CAP_ID_MSI)?;
+        Some(Self::decode(pos, config.read_config_word(pos + 2)))
+    }
+
+    /// 数据寄存器偏移（32 位地址时紧跟地址低 32 位）
+    fn data_pos(&self) -> u8 {
+        if self.is_64 { self.pos + 0xC } else { self.pos + 0x8 }
+    }
+
+    /// 写入消息并使能 MSI，只使用一个向量 (pci_msi_domain_write_msg + msi_capability_init)
+    ///
+    /// # 返回
+    /// 设备只支持 32 位地址而消息地址超出 4GB 时返回 Err
+    pub fn enable(&self, config: &PCIConfig, msg: &MsiMsg) -> Result<(), &'static str> {
+        if !self.is_64 && msg.address >> 32 != 0 {
+            return Err("MSI address above 4GB on a 32-bit MSI device");
+        }
+        config.write_config_dword(self.pos + 4, msg.address as u32);
+        if self.is_64 {
+            config.write_config_dword(self.pos + 8, (msg.address >> 32) as u32);
+        }
+        config.write_config_word(self.data_pos(), msg.data as u16);
+        let control = config.read_config_word(self.pos + 2) & !msi_flags::QSIZE;
+        config.write_config_word(self.pos + 2, control | msi_flags::ENABLE);
+        pci_intx(config, false);
+        Ok(())
+    }
+
+    /// 关闭 MSI
+    pub fn disable(&self, config: &PCIConfig) {
+        let control = config.read_config_word(self.pos + 2);
+        config.write_config_word(self.pos + 2, control & !msi_flags::ENABLE);
+    }
+}
+
+/// MSI-X capability
+#[derive(Debug, Clone, Copy)]
+pub struct MsixCapability {
+    /// capability 在配置空间中的偏移
+    pub pos: u8,
+    /// 向量表项数
+    pub table_size: u16,
+    /// 向量表所在的 BAR
+    pub table_bir: u8,
+    /// 向量表在 BAR 内的偏移
+    pub table_offset: u32,
+    /// Pending Bit Array 所在的 BAR
+    pub pba_bir: u8,
+    /// PBA 在 BAR 内的偏移
+    pub pba_offset: u32,
+}
+
+impl MsixCapability {
+    /// 从 Message Control、Table、PBA 三个寄存器解码
+    pub fn decode(pos: u8, control: u16, table: u32, pba: u32) -> Self {
+        Self {
+            pos,
+            table_size: (control & msix_flags::QSIZE) + 1,
+            table_bir: (table & PCI_MSIX_BIR) as u8,
+            table_offset: table & !PCI_MSIX_BIR,
+            pba_bir: (pba & PCI_MSIX_BIR) as u8,
+            pba_offset: pba & !PCI_MSIX_BIR,
+        }
+    }
+
+    /// 读取设备的 MSI-X capability
+    pub fn parse(config: &PCIConfig) -> Option<Self> {
+        let pos = config.find_capability(PCI_CAP_ID_MSIX)?;
+        Some(Self::decode(
+            pos,
+            config.read_config_word(pos + 2),
+            config.read_config_dword(pos + 4),
+            config.read_config_dword(pos + 8),
+        ))
+    }
+
+    /// 修改 Message Control 寄存器 (pci_msix_clear_and_set_ctrl)
+    fn clear_and_set_ctrl(&self, config: &PCIConfig, clear: u16, set: u16) {
+        let control = config.read_config_word(self.pos + 2);
+        config.write_config_word(self.pos + 2, (control & !clear) | set);
+    }
+
+    /// 使能 MSI-X 并屏蔽整个功能，此后可以安全地编程向量表
+    pub fn enable_masked(&self, config: &PCIConfig) {
+        pci_intx(config, false);
+        self.clear_and_set_ctrl(config, 0, msix_flags::ENABLE | msix_flags::MASKALL);
+    }
+
+    /// 向量表编程完成，放开功能屏蔽
+    pub fn unmask_all(&self, config: &PCIConfig) {
+        self.clear_and_set_ctrl(config, msix_flags::MASKALL, 0);
+    }
+
+    /// 关闭 MSI-X，恢复 INTx (pci_msix_shutdown)
+    pub fn disable(&self, config: &PCIConfig) {
+        self.clear_and_set_ctrl(config, msix_flags::ENABLE | msix_flags::MASKALL, 0);
+        pci_intx(config, true);
+    }
+}
+
+/// 映射后的 MSI-X 向量表
+#[derive(Debug, Clone, Copy)]
+pub struct MsixTable {
+    /// 向量表的虚拟地址
+    base: u64,
+    /// 表项数
+    nr_entries: u16,
+}
+
+impl MsixTable {
+    /// # 参数
+    /// - `bar_addr`: 向量表所在 BAR 分配到的地址
+    pub fn new(cap: &MsixCapability, bar_addr: u64) -> Self {
+        Self { base: bar_addr + cap.table_offset as u64, nr_entries: cap.table_size }
+    }
+
+    pub fn nr_entries(&self) -> u16 {
+        self.nr_entries
+    }
+
+    fn entry_addr(&self, entry: u16, reg: u64) -> *mut u32 {
+        (self.base + entry as u64 * PCI_MSIX_ENTRY_SIZE + reg) as *mut u32
+    }
+
+    /// 写入表项的消息，先屏蔽表项再写，写完保持屏蔽 (pci_write_msg_msix)
+    pub fn write_msg(&self, entry: u16, msg: &MsiMsg) -> Result<(), &'static str> {
+        if entry >= self.nr_entries {
+            return Err("MSI-X entry out of range");
+        }
+        self.mask(entry);
+        unsafe {
+            core::ptr::write_volatile(self.entry_addr(entry, PCI_MSIX_ENTRY_LOWER_ADDR), msg.address as u32);
+            core::ptr::write_volatile(self.entry_addr(entry, PCI_MSIX_ENTRY_UPPER_ADDR), (msg.address >> 32) as u32);
+            core::ptr::write_volatile(self.entry_addr(entry, PCI_MSIX_ENTRY_DATA), msg.data);
+        }
+        Ok(())
+    }
+
+    /// 读回表项的消息
+    pub fn read_msg(&self, entry: u16) -> Option<MsiMsg> {
+        if entry >= self.nr_entries {
+            return None;
+        }
+        unsafe {
+            let lo = core::ptr::read_volatile(self.entry_addr(entry, PCI_MSIX_ENTRY_LOWER_ADDR));
+            let hi = core::ptr::read_volatile(self.entry_addr(entry, PCI_MSIX_ENTRY_UPPER_ADDR));
+            let data = core::ptr::read_volatile(self.entry_addr(entry, PCI_MSIX_ENTRY_DATA));
+            Some(MsiMsg { address: (hi as u64) << 32 | lo as u64, data })
+        }
+    }
+
+    /// 屏蔽表项 (pci_msix_mask)
+    pub fn mask(&self, entry: u16) {
+        self.set_ctrl(entry, true);
+    }
+
+    /// 放开表项 (pci_msix_unmask)
+    pub fn unmask(&self, entry: u16) {
+        self.set_ctrl(entry, false);
+    }
+
+    fn set_ctrl(&self, entry: u16, masked: bool) {
+        if entry >= self.nr_entries {
+            return;
+        }
+        let ptr = self.entry_addr(entry, PCI_MSIX_ENTRY_VECTOR_CTRL);
+        unsafe {
+            let ctrl = core::ptr::read_volatile(ptr);
+            let ctrl = if masked { ctrl | PCI_MSIX_ENTRY_CTRL_MASKBIT } else { ctrl & !PCI_MSIX_ENTRY_CTRL_MASKBIT };
+            core::ptr::write_volatile(ptr, ctrl);
+            // 读回，确保屏蔽在返回前已到达设备
+            let _ = core::ptr::read_volatile(ptr);
+        }
+    }
+}
+
+/// 打开或关闭 INTx (pci_intx)
+pub fn pci_intx(config: &PCIConfig, enable: bool) {
+    let cmd = config.command();
+    let new = if enable { cmd & !command::INT_DISABLE } else { cmd | command::INT_DISABLE };
+    if new != cmd {
+        config.set_command(new);
+    }
+}
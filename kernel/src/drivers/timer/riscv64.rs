@@ -52,12 +52,25 @@ pub fn get_jiffies() -> u64 {
     JIFFIES.load(Ordering::Acquire)
 }
 
-/// 增加 jiffies 计数器
+/// 按当前时间推进 jiffies (tick_do_update_jiffies64)
 ///
-/// 在每次时钟中断时调用
+/// jiffies 由 time CSR 换算而来，任何 CPU 的 tick 都可以推进，多个 CPU
+/// 同时 tick 或某个 CPU 空闲停止 tick 都不会让 jiffies 走快或走慢
 #[inline]
-fn increment_jiffies() {
-    JIFFIES.fetch_add(1, Ordering::Release);
+pub fn update_jiffies(now: u64) {
+    JIFFIES.fetch_max(cycles_to_jiffies(now), Ordering::AcqRel);
+}
+
+/// 将 jiffies 转换为时钟周期
+#[inline]
+pub const fn jiffies_to_cycles(jiffies: u64) -> u64 {
+    jiffies.saturating_mul(TIME_SLICE_TICKS)
+}
+
+/// 将时钟周期转换为 jiffies
+#[inline]
+pub const fn cycles_to_jiffies(cycles: u64) -> u64 {
+    cycles / TIME_SLICE_TICKS
 }
 
 /// 将 jiffies 转换为毫秒
@@ -85,45 +98,49 @@ pub fn set_timer(deadline: u64) {
     sbi::set_timer(deadline);
 }
 
-/// 设置下一次定时器中断（时间片长度）
+/// 设置下一次定时器中断
 ///
+/// 取下一个 tick 与最早的 hrtimer 中较早者；空闲停止 tick 时只看定时器
 pub fn set_next_trigger() {
-    let current = read_time();
-    let deadline = current + TIME_SLICE_TICKS;  // 10ms 后触发
-    set_timer(deadline);
+    crate::time::tick::tick_program_event();
 }
 
 /// 时钟中断处理函数
 ///
 ///
 /// # 功能
-/// 1. 更新 jiffies 计数器
-/// 2. 更新系统运行时间统计
-/// 3. 触发调度器 tick
-/// 4. 处理定时器回调
+/// 1. 检查到期的 hrtimer
+/// 2. 到了 tick 时更新 jiffies，检查到期的时间轮定时器
+///
+/// 到期的定时器标记为软中断，在中断返回前执行
 ///
-/// # 调用时机
-/// 每次时钟中断时由 trap_handler 调用
+/// # 返回
+/// 本次中断是否为 tick；只为 hrtimer 编程的中断返回 false，
+/// 调用方据此跳过调度器 tick 等周期性工作
 ///
 /// # 注意
 /// - 在中断上下文中调用，不能睡眠
 /// - 需要尽快完成，避免影响系统性能
-pub fn timer_interrupt_handler() {
-    // 1. 更新 jiffies 计数器
-    increment_jiffies();
+pub fn timer_interrupt_handler() -> bool {
+    let now = read_time();
+
+    // 1. hrtimer 在每次中断都检查
+    crate::time::hrtimer::hrtimer_interrupt(crate::time::cycles_to_ns(now));
 
-    // 3. TODO: 更新进程运行时间统计
-    //    - 当前进程的 utime/stime
-    //    - CPU 统计信息
+    if !crate::time::tick::tick_handle(now) {
+        return false;
+    }
 
-    // 4. TODO: 处理软件定时器
-    //    - 检查到期的定时器
-    //    - 调用定时器回调函数
+    // 2. 更新 jiffies 计数器，tick_do_timer_cpu 同时更新 vDSO 时间数据和统计页
+    update_jiffies(now);
+    if crate::arch::cpu_id() as usize == crate::time::tick::TICK_DO_TIMER_CPU {
+        crate::arch::riscv64::vdso::update_vsyscall(now);
+        crate::kstats::kstats_tick();
+    }
 
-    // 5. TODO: 触发调度器 tick
-    //    - 更新当前进程运行时间
-    //    - 检查是否需要调度
-    //    - 设置 need_resched 标志
+    // 3. 时间轮
+    crate::time::timer::run_local_timers();
 
     // 注意：调度由 trap.rs 中的 schedule() 调用处理
+    true
 }
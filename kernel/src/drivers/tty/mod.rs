@@ -0,0 +1,365 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! TTY 层
+//!
+//! 参考 Linux: drivers/tty/tty_io.c, drivers/tty/tty_ioctl.c, drivers/tty/n_tty.c
+//!
+//! 串口控制台 ttyS0 的读写都经过这里：
+//! - 写：按 termios 的输出标志 (OPOST | ONLCR) 处理后复制进串口的发送缓冲区就返回，
+//!   由 THRE 中断发送；缓冲区满时睡眠，直到中断腾出空间。整个 write 持有写互斥锁
+//!   (atomic_write_lock)，不同进程的一次 write 不会交错；输出锁只在复制期间持有
+//! - 读：接收中断收到的字符在软中断中交给线路规程 (n_tty)，回显、行编辑后唤醒读者
+//! - TCGETS / TCSETS 读写线路规程使用的 termios，FIONREAD 返回可读字节数
+
+pub mod n_tty;
+pub mod serial;
+
+use crate::fs::file::poll_mask::*;
+use crate::fs::pipe::pipe_wait;
+use crate::fs::select::{poll_wait, PollTable};
+use crate::process::wait::WaitQueueHead;
+use crate::sync::{Mutex, TicketLock};
+use core::sync::atomic::{AtomicU32, Ordering};
+
+use n_tty::NTty;
+use serial::{CircBuf, XMIT};
+
+/// c_cc 的长度 (NCCS)
+pub const NCCS: usize = 19;
+
+/// c_cc 下标
+pub const VINTR: usize = 0;
+pub const VQUIT: usize = 1;
+pub const VERASE: usize = 2;
+pub const VKILL: usize = 3;
+pub const VEOF: usize = 4;
+pub const VTIME: usize = 5;
+pub const VMIN: usize = 6;
+pub const VSTART: usize = 8;
+pub const VSTOP: usize = 9;
+pub const VSUSP: usize = 10;
+pub const VEOL: usize = 11;
+
+/// c_iflag
+pub const ISTRIP: u32 = 0o000040;
+pub const INLCR: u32 = 0o000100;
+pub const IGNCR: u32 = 0o000200;
+pub const ICRNL: u32 = 0o000400;
+pub const IXON: u32 = 0o002000;
+
+/// c_oflag
+pub const OPOST: u32 = 0o000001;
+pub const ONLCR: u32 = 0o000004;
+
+/// c_cflag
+pub const B38400: u32 = 0o000017;
+pub const CS8: u32 = 0o000060;
+pub const CREAD: u32 = 0o000200;
+pub const HUPCL: u32 = 0o002000;
+
+/// c_lflag
+pub const ISIG: u32 = 0o000001;
+pub const ICANON: u32 = 0o000002;
+pub const ECHO: u32 = 0o000010;
+pub const ECHOE: u32 = 0o000020;
+pub const ECHOK: u32 = 0o000040;
+pub const ECHONL: u32 = 0o000100;
+pub const ECHOCTL: u32 = 0o001000;
+pub const ECHOKE: u32 = 0o004000;
+pub const IEXTEN: u32 = 0o100000;
+
+/// ioctl 命令
+const TCGETS: u32 = 0x5401;
+const TCSETS: u32 = 0x5402;
+const TCSETSW: u32 = 0x5403;
+const TCSETSF: u32 = 0x5404;
+const TCFLSH: u32 = 0x540B;
+const FIONREAD: u32 = 0x541B;
+
+/// TCFLSH 的参数
+const TCIFLUSH: usize = 0;
+const TCOFLUSH: usize = 1;
+const TCIOFLUSH: usize = 2;
+
+/// 内核的 struct termios，TCGETS / TCSETS 直接复制
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct Termios {
+    pub c_iflag: u32,
+    pub c_oflag: u32,
+    pub c_cflag: u32,
+    pub c_lflag: u32,
+    pub c_line: u8,
+    pub c_cc: [u8; NCCS],
+}
+
+impl Termios {
+    /// 默认的终端设置 (tty_std_termios)
+    pub const fn std() -> Self {
+        let mut c_cc = [0u8; NCCS];
+        c_cc[VINTR] = 3;     // ^C
+        c_cc[VQUIT] = 28;    // ^\
+        c_cc[VERASE] = 127;  // DEL
+        c_cc[VKILL] = 21;    // ^U
+        c_cc[VEOF] = 4;      // ^D
+        c_cc[VTIME] = 0;
+        c_cc[VMIN] = 1;
+        c_cc[VSTART] = 17;   // ^Q
+        c_cc[VSTOP] = 19;    // ^S
+        c_cc[VSUSP] = 26;    // ^Z
+        Self {
+            c_iflag: ICRNL | IXON,
+            c_oflag: OPOST | ONLCR,
+            c_cflag: B38400 | CS8 | CREAD | HUPCL,
+            c_lflag: ISIG | ICANON | ECHO | ECHOE | ECHOK | ECHOCTL | ECHOKE | IEXTEN,
+            c_line: 0,
+            c_cc,
+        }
+    }
+}
+
+/// 线路规程，软中断和读者都会获取，必须用 lock_irqsave
+static LDISC: TicketLock<NTty> = TicketLock::new(NTty::new());
+/// 发送缓冲区的生产者锁 (output_lock)，回显与写者共用
+static OUTPUT_LOCK: TicketLock<()> = TicketLock::new(());
+/// 写互斥锁 (atomic_write_lock)，写者等待空间时睡眠也持有
+static WRITE_MUTEX: Mutex = Mutex::new();
+/// 输出标志的副本，写者不必获取线路规程的锁
+static OFLAG: AtomicU32 = AtomicU32::new(OPOST | ONLCR);
+
+/// 等待输入的读者
+pub static TTY_READ_WQ: WaitQueueHead = WaitQueueHead::new();
+/// 等待发送缓冲区空间的写者
+pub static TTY_WRITE_WQ: WaitQueueHead = WaitQueueHead::new();
+
+/// 下半部所在的软中断
+const TTY_SOFTIRQ: usize = crate::softirq::TASKLET_SOFTIRQ;
+
+/// 输出处理后写入缓冲区 (process_output_block)
+///
+/// ONLCR 时换行写成 "\r\n"，两个字节放不下就停在换行之前
+///
+/// # 返回
+/// 消耗的输入字节数
+pub fn process_output<const N: usize>(xmit: &CircBuf<N>, buf: &[u8], oflag: u32) -> usize {
+    if oflag & OPOST == 0 || oflag & ONLCR == 0 {
+        return xmit.push(buf);
+    }
+    let mut done = 0;
+    while done < buf.len() {
+        let rest = &buf[done..];
+        let seg = rest.iter().position(|&c| c == b'\n').unwrap_or(rest.len());
+        let n = xmit.push(&rest[..seg]);
+        done += n;
+        if n < seg || seg == rest.len() || xmit.space() < 2 {
+            break;
+        }
+        xmit.push(b"\r\n");
+        done += 1;
+    }
+    done
+}
+
+/// 回显写入发送缓冲区，放不下的部分丢弃
+fn echo_output(buf: &[u8]) {
+    let _out = OUTPUT_LOCK.lock_irqsave();
+    process_output(&XMIT, buf, OFLAG.load(Ordering::Relaxed));
+}
+
+/// 把接收缓冲区中的字符交给线路规程 (flush_to_ldisc)
+fn flush_to_ldisc() {
+    let mut chars = [0u8; 64];
+    let mut echoed = false;
+    let ready = {
+        let mut ldisc = LDISC.lock_irqsave();
+        loop {
+            let n = serial::RX.pop_into(&mut chars);
+            if n == 0 {
+                break;
+            }
+            ldisc.receive_buf(&chars[..n], &mut |buf| {
+                echoed = true;
+                echo_output(buf);
+            });
+        }
+        ldisc.input_available()
+    };
+    if echoed {
+        serial::start_tx();
+    }
+    if ready {
+        TTY_READ_WQ.wake_up_all();
+    }
+}
+
+/// 串口中断的下半部：处理输入，唤醒读写者
+fn tty_softirq() {
+    flush_to_ldisc();
+    if XMIT.space() > 0 {
+        TTY_WRITE_WQ.wake_up_all();
+    }
+}
+
+/// 初始化串口 TTY，中断注册失败时保持轮询
+pub fn init() {
+    crate::softirq::open_softirq_threaded(TTY_SOFTIRQ, tty_softirq);
+    if let Err(e) = serial::init(TTY_SOFTIRQ) {
+        crate::println!("tty: request_irq {} failed: {}, ttyS0 stays polled", serial::UART_IRQ, e);
+    }
+}
+
+/// 写入终端 (tty_write / n_tty_write)
+///
+/// # 返回
+/// 写入的字节数；非阻塞且缓冲区已满返回 EAGAIN，等待时收到信号返回 EINTR
+pub fn tty_write(buf: &[u8], nonblock: bool) -> isize {
+    let _guard = WRITE_MUTEX.guard();
+    let mut written = 0;
+    while written < buf.len() {
+        let n = {
+            let _out = OUTPUT_LOCK.lock_irqsave();
+            process_output(&XMIT, &buf[written..], OFLAG.load(Ordering::Relaxed))
+        };
+        written += n;
+        serial::start_tx();
+        if written == buf.len() || n > 0 {
+            continue;
+        }
+        if nonblock {
+            return if written > 0 { written as isize } else { -11 };  // EAGAIN
+        }
+        if crate::signal::signal_pending() {
+            return if written > 0 { written as isize } else { -4 };  // EINTR
+        }
+        // 没有当前任务时继续轮询，每次 start_tx 都会填一次 FIFO
+        if serial::irq_mode() {
+            pipe_wait(&TTY_WRITE_WQ, || XMIT.space() >= 2);
+        }
+    }
+    written as isize
+}
+
+/// 从终端读取 (tty_read / n_tty_read)
+///
+/// # 返回
+/// 读取的字节数；非阻塞且没有输入返回 EAGAIN，等待时收到信号返回 EINTR
+pub fn tty_read(buf: &mut [u8], nonblock: bool) -> isize {
+    loop {
+        if !serial::irq_mode() {
+            serial::poll_rx();
+            flush_to_ldisc();
+        }
+        if let Some(n) = LDISC.lock_irqsave().read(buf) {
+            return n as isize;
+        }
+        if nonblock {
+            return -11;  // EAGAIN
+        }
+        if crate::signal::signal_pending() {
+            return -4;  // EINTR
+        }
+        if !serial::irq_mode() || !pipe_wait(&TTY_READ_WQ, || LDISC.lock_irqsave().input_available()) {
+            // 轮询模式下短暂延迟，避免过度占用 CPU
+            for _ in 0..1000 {
+                core::hint::spin_loop();
+            }
+        }
+    }
+}
+
+/// 有输入时可读，发送缓冲区有空间时可写 (n_tty_poll)
+pub fn tty_poll(pt: Option<&mut PollTable>) -> u32 {
+    if let Some(pt) = pt {
+        poll_wait(&TTY_READ_WQ, Some(&mut *pt));
+        poll_wait(&TTY_WRITE_WQ, Some(pt));
+    }
+    if !serial::irq_mode() {
+        serial::poll_rx();
+        flush_to_ldisc();
+    }
+    let mut mask = 0;
+    if LDISC.lock_irqsave().input_available() {
+        mask |= POLLIN | POLLRDNORM;
+    }
+    if XMIT.space() > 0 {
+        mask |= POLLOUT | POLLWRNORM;
+    }
+    mask
+}
+
+/// 等待发送缓冲区清空 (tty_wait_until_sent)
+fn wait_until_sent() {
+    while !XMIT.is_empty() {
+        serial::start_tx();
+        if crate::signal::signal_pending() {
+            return;
+        }
+        if serial::irq_mode() {
+            pipe_wait(&TTY_WRITE_WQ, || XMIT.is_empty());
+        }
+    }
+}
+
+/// 当前的 termios
+pub fn get_termios() -> Termios {
+    LDISC.lock_irqsave().termios
+}
+
+/// 设置 termios (tty_set_termios)
+pub fn set_termios(termios: &Termios) {
+    LDISC.lock_irqsave().set_termios(termios);
+    OFLAG.store(termios.c_oflag, Ordering::Relaxed);
+}
+
+/// 终端 ioctl (tty_ioctl / n_tty_ioctl)
+///
+/// # 返回
+/// 不是由这里处理的命令返回 None
+pub fn tty_ioctl(cmd: u32, arg: usize) -> Option<i64> {
+    use crate::arch::riscv64::uaccess::{get_user, put_user};
+
+    let ret = match cmd {
+        TCGETS => match put_user(arg, &get_termios()) {
+            Ok(()) => 0,
+            Err(e) => e as i64,
+        },
+        TCSETS | TCSETSW | TCSETSF => {
+            let termios = match get_user::<Termios>(arg) {
+                Ok(termios) => termios,
+                Err(e) => return Some(e as i64),
+            };
+            if cmd != TCSETS {
+                wait_until_sent();
+            }
+            if cmd == TCSETSF {
+                LDISC.lock_irqsave().flush();
+            }
+            set_termios(&termios);
+            0
+        }
+        TCFLSH => match arg {
+            TCIFLUSH | TCOFLUSH | TCIOFLUSH => {
+                if arg != TCOFLUSH {
+                    LDISC.lock_irqsave().flush();
+                }
+                if arg != TCIFLUSH {
+                    serial::flush_xmit();
+                }
+                0
+            }
+            _ => -22,  // EINVAL
+        },
+        FIONREAD => {
+            let n = LDISC.lock_irqsave().readable() as i32;
+            match put_user(arg, &n) {
+                Ok(()) => 0,
+                Err(e) => e as i64,
+            }
+        }
+        _ => return None,
+    };
+    Some(ret)
+}
@@ -0,0 +1,276 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 默认线路规程 (N_TTY)
+//!
+//! 参考 Linux: drivers/tty/n_tty.c
+//!
+//! 规范模式 (ICANON) 下按行缓冲：VERASE 删除一个字符，VKILL 删除整行，
+//! 换行、VEOL 或 VEOF 结束一行，读者一次最多得到一行；VEOF 本身不交给读者，
+//! 空行上的 VEOF 让 read 返回 0。非规范模式下字符到达即可读，按 VMIN 决定何时返回。
+//! 回显 (ECHO) 经过输出处理写入发送缓冲区，控制字符在 ECHOCTL 下显示为 ^X
+
+use super::{
+    Termios, ECHO, ECHOCTL, ECHOE, ECHOK, ECHOKE, ECHONL, ICANON, ICRNL, IGNCR, INLCR, ISTRIP, VEOF, VEOL,
+    VERASE, VKILL, VMIN,
+};
+
+/// 读缓冲区大小 (N_TTY_BUF_SIZE)
+pub const N_TTY_BUF_SIZE: usize = 4096;
+
+/// 线路规程状态 (struct n_tty_data)
+///
+/// 位置只增不减，取模得到缓冲区下标：
+/// read_tail ≤ canon_head ≤ read_head，规范模式下 canon_head 之前是已完成的行
+pub struct NTty {
+    pub termios: Termios,
+    read_buf: [u8; N_TTY_BUF_SIZE],
+    /// 行尾标记，对应位置的字符是换行、VEOL 或 VEOF (read_flags)
+    read_flags: [u64; N_TTY_BUF_SIZE / 64],
+    read_head: usize,
+    canon_head: usize,
+    read_tail: usize,
+}
+
+impl NTty {
+    pub const fn new() -> Self {
+        Self {
+            termios: Termios::std(),
+            read_buf: [0; N_TTY_BUF_SIZE],
+            read_flags: [0; N_TTY_BUF_SIZE / 64],
+            read_head: 0,
+            canon_head: 0,
+            read_tail: 0,
+        }
+    }
+
+    fn icanon(&self) -> bool {
+        self.termios.c_lflag & ICANON != 0
+    }
+
+    fn lflag(&self, flag: u32) -> bool {
+        self.termios.c_lflag & flag != 0
+    }
+
+    fn is_eol(&self, pos: usize) -> bool {
+        let i = pos % N_TTY_BUF_SIZE;
+        self.read_flags[i / 64] & (1 << (i % 64)) != 0
+    }
+
+    fn set_eol(&mut self, pos: usize, eol: bool) {
+        let i = pos % N_TTY_BUF_SIZE;
+        if eol {
+            self.read_flags[i / 64] |= 1 << (i % 64);
+        } else {
+            self.read_flags[i / 64] &= !(1 << (i % 64));
+        }
+    }
+
+    fn put_char(&mut self, c: u8, eol: bool) {
+        let pos = self.read_head;
+        self.read_buf[pos % N_TTY_BUF_SIZE] = c;
+        self.set_eol(pos, eol);
+        self.read_head = pos.wrapping_add(1);
+    }
+
+    fn buffered(&self) -> usize {
+        self.read_head.wrapping_sub(self.read_tail)
+    }
+
+    /// 回显一个字符，控制字符显示为 ^X (echo_char)
+    fn echo_char(&self, c: u8, echo: &mut dyn FnMut(&[u8])) {
+        if self.lflag(ECHOCTL) && is_ctl(c) {
+            echo(&[b'^', c ^ 0x40]);
+        } else {
+            echo(&[c]);
+        }
+    }
+
+    /// 删除当前行的最后一个字符，返回是否删除了 (eraser)
+    fn erase_char(&mut self, echo: &mut dyn FnMut(&[u8])) -> bool {
+        if self.read_head == self.canon_head {
+            return false;
+        }
+        self.read_head = self.read_head.wrapping_sub(1);
+        let c = self.read_buf[self.read_head % N_TTY_BUF_SIZE];
+        if self.lflag(ECHO) && self.lflag(ECHOE) {
+            echo(b"\x08 \x08");
+            if self.lflag(ECHOCTL) && is_ctl(c) {
+                echo(b"\x08 \x08");
+            }
+        }
+        true
+    }
+
+    /// 处理一个收到的字符 (n_tty_receive_char)
+    fn receive_char(&mut self, mut c: u8, echo: &mut dyn FnMut(&[u8])) {
+        let iflag = self.termios.c_iflag;
+        let cc = self.termios.c_cc;
+        if iflag & ISTRIP != 0 {
+            c &= 0x7f;
+        }
+        if c == b'\r' {
+            if iflag & IGNCR != 0 {
+                return;
+            }
+            if iflag & ICRNL != 0 {
+                c = b'\n';
+            }
+        } else if c == b'\n' && iflag & INLCR != 0 {
+            c = b'\r';
+        }
+
+        if self.icanon() {
+            if c == cc[VERASE] {
+                self.erase_char(echo);
+                return;
+            }
+            if c == cc[VKILL] {
+                if self.lflag(ECHO) && !self.lflag(ECHOKE) && self.read_head != self.canon_head {
+                    // 不擦除屏幕，回显 VKILL 后另起一行 (ECHOK)
+                    self.echo_char(c, echo);
+                    if self.lflag(ECHOK) {
+                        echo(b"\n");
+                    }
+                    self.read_head = self.canon_head;
+                    return;
+                }
+                while self.erase_char(echo) {}
+                return;
+            }
+            if c == cc[VEOF] {
+                self.put_char(c, true);
+                self.canon_head = self.read_head;
+                return;
+            }
+            if c == b'\n' || (c == cc[VEOL] && c != 0) {
+                // 保留的最后一个位置留给行尾
+                if self.buffered() >= N_TTY_BUF_SIZE {
+                    return;
+                }
+                if self.lflag(ECHO) || (c == b'\n' && self.lflag(ECHONL)) {
+                    echo(&[c]);
+                }
+                self.put_char(c, true);
+                self.canon_head = self.read_head;
+                return;
+            }
+            if self.buffered() >= N_TTY_BUF_SIZE - 1 {
+                return;
+            }
+        } else if self.buffered() >= N_TTY_BUF_SIZE {
+            return;
+        }
+
+        if self.lflag(ECHO) {
+            self.echo_char(c, echo);
+        }
+        self.put_char(c, false);
+        if !self.icanon() {
+            self.canon_head = self.read_head;
+        }
+    }
+
+    /// 处理一批收到的字符 (n_tty_receive_buf)
+    ///
+    /// # 参数
+    /// - `echo`: 回显输出，由调用方做输出处理后写入发送缓冲区
+    pub fn receive_buf(&mut self, chars: &[u8], echo: &mut dyn FnMut(&[u8])) {
+        for &c in chars {
+            self.receive_char(c, echo);
+        }
+    }
+
+    /// 读者可以取走的字节数，规范模式下只计已完成的行 (FIONREAD)
+    pub fn readable(&self) -> usize {
+        self.canon_head.wrapping_sub(self.read_tail)
+    }
+
+    /// read 是否不必等待 (input_available_p)
+    pub fn input_available(&self) -> bool {
+        let avail = self.readable();
+        if self.icanon() {
+            avail > 0
+        } else {
+            avail >= (self.termios.c_cc[VMIN] as usize).max(1)
+        }
+    }
+
+    /// 取出输入 (n_tty_read)
+    ///
+    /// # 返回
+    /// 需要等待更多输入时返回 None；规范模式下最多返回一行，空行上的 VEOF 返回 0
+    pub fn read(&mut self, out: &mut [u8]) -> Option<usize> {
+        if out.is_empty() {
+            return Some(0);
+        }
+        if self.icanon() {
+            if self.readable() == 0 {
+                return None;
+            }
+            let eof = self.termios.c_cc[VEOF];
+            let mut n = 0;
+            while self.read_tail != self.canon_head && n < out.len() {
+                let pos = self.read_tail;
+                let c = self.read_buf[pos % N_TTY_BUF_SIZE];
+                let eol = self.is_eol(pos);
+                self.set_eol(pos, false);
+                self.read_tail = pos.wrapping_add(1);
+                if eol && c == eof {
+                    break;
+                }
+                out[n] = c;
+                n += 1;
+                if eol {
+                    break;
+                }
+            }
+            return Some(n);
+        }
+
+        let avail = self.readable();
+        let vmin = self.termios.c_cc[VMIN] as usize;
+        if avail == 0 && vmin > 0 {
+            return None;
+        }
+        if avail < vmin.min(out.len()) {
+            return None;
+        }
+        let n = avail.min(out.len());
+        for slot in out[..n].iter_mut() {
+            *slot = self.read_buf[self.read_tail % N_TTY_BUF_SIZE];
+            self.set_eol(self.read_tail, false);
+            self.read_tail = self.read_tail.wrapping_add(1);
+        }
+        Some(n)
+    }
+
+    /// 丢弃所有输入 (n_tty_flush_buffer)
+    pub fn flush(&mut self) {
+        self.read_head = 0;
+        self.canon_head = 0;
+        self.read_tail = 0;
+        self.read_flags = [0; N_TTY_BUF_SIZE / 64];
+    }
+
+    /// 设置 termios (n_tty_set_termios)
+    ///
+    /// 离开规范模式时未完成的行立即可读；进入规范模式时已有的输入视为一行
+    pub fn set_termios(&mut self, termios: &Termios) {
+        let was_canon = self.icanon();
+        self.termios = *termios;
+        if was_canon != self.icanon() {
+            self.canon_head = self.read_head;
+            if self.icanon() && self.read_head != self.read_tail {
+                self.set_eol(self.read_head.wrapping_sub(1), true);
+            }
+        }
+    }
+}
+
+/// 回显时需要转义的控制字符：制表符与换行照常输出
+fn is_ctl(c: u8) -> bool {
+    (c < 0x20 && c != b'\t' && c != b'\n') || c == 0x7f
+}
@@ -0,0 +1,296 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 16550 串口驱动 (ttyS0)
+//!
+//! 参考 Linux: drivers/tty/serial/8250/8250_port.c, drivers/tty/serial/serial_core.c
+//!
+//! 输出先进入发送缓冲区 (uart_state.xmit)，写者复制完就返回；发送保持寄存器空
+//! (THRE) 中断到来时一次填满 16 字节的发送 FIFO，缓冲区发完关闭 THRE 中断。
+//! 接收中断把到达的字符放进接收缓冲区，由 TTY 软中断交给线路规程。
+//! 中断注册之前或注册失败时轮询寄存器：写者自己把缓冲区发完，读者自己读取字符。
+//!
+//! 任一时刻只有一个 CPU 访问端口寄存器：发现端口已有所有者的 CPU 只标记还有工作，
+//! 所有者退出前再处理一遍，收发路径都不加锁
+
+use core::cell::UnsafeCell;
+use core::sync::atomic::{AtomicBool, AtomicU8, AtomicUsize, Ordering};
+
+use crate::irq::IrqReturn;
+
+/// QEMU virt 的 ns16550a
+const UART_BASE: usize = 0x1000_0000;
+/// UART 的 PLIC 中断号
+pub const UART_IRQ: usize = 10;
+
+/// 寄存器偏移 (include/uapi/linux/serial_reg.h)
+const UART_RX: usize = 0;
+const UART_TX: usize = 0;
+const UART_IER: usize = 1;
+const UART_FCR: usize = 2;
+const UART_MCR: usize = 4;
+const UART_LSR: usize = 5;
+
+const UART_IER_RDI: u8 = 0x01;
+const UART_IER_THRI: u8 = 0x02;
+const UART_FCR_ENABLE_FIFO: u8 = 0x01;
+const UART_FCR_CLEAR_RCVR: u8 = 0x02;
+const UART_FCR_CLEAR_XMIT: u8 = 0x04;
+const UART_MCR_OUT2: u8 = 0x08;
+const UART_LSR_DR: u8 = 0x01;
+const UART_LSR_THRE: u8 = 0x20;
+
+/// 发送 FIFO 深度 (PORT_16550A 的 tx_loadsz)
+const UART_FIFO_SIZE: usize = 16;
+
+/// 发送缓冲区大小；Linux 的 UART_XMIT_SIZE 为一页，这里放大以容纳 ls -R 等成批输出
+pub const XMIT_SIZE: usize = 16384;
+/// 接收缓冲区大小
+const RX_SIZE: usize = 1024;
+
+/// 单生产者单消费者的环形缓冲区 (circ_buf)
+///
+/// head 与 tail 只增不减，取模得到位置；生产者只写 head，消费者只写 tail，
+/// 两边各自串行化后互相不需要加锁
+pub struct CircBuf<const N: usize> {
+    buf: UnsafeCell<[u8; N]>,
+    head: AtomicUsize,
+    tail: AtomicUsize,
+}
+
+// 缓冲区的每个位置在 head 与 tail 之间只属于一方
+unsafe impl<const N: usize> Sync for CircBuf<N> {}
+
+impl<const N: usize> CircBuf<N> {
+    pub const fn new() -> Self {
+        Self {
+            buf: UnsafeCell::new([0; N]),
+            head: AtomicUsize::new(0),
+            tail: AtomicUsize::new(0),
+        }
+    }
+
+    /// 缓冲区中的字节数 (CIRC_CNT)
+    pub fn len(&self) -> usize {
+        self.head.load(Ordering::Acquire).wrapping_sub(self.tail.load(Ordering::Acquire))
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// 剩余空间 (CIRC_SPACE)
+    pub fn space(&self) -> usize {
+        N - self.len()
+    }
+
+    /// 追加数据，空间不足时只写入能放下的部分（生产者调用）
+    ///
+    /// # 返回
+    /// 写入的字节数
+    pub fn push(&self, data: &[u8]) -> usize {
+        let head = self.head.load(Ordering::Relaxed);
+        let tail = self.tail.load(Ordering::Acquire);
+        let n = data.len().min(N - head.wrapping_sub(tail));
+        let pos = head % N;
+        let first = n.min(N - pos);
+        unsafe {
+            let buf = self.buf.get() as *mut u8;
+            core::ptr::copy_nonoverlapping(data.as_ptr(), buf.add(pos), first);
+            core::ptr::copy_nonoverlapping(data.as_ptr().add(first), buf, n - first);
+        }
+        self.head.store(head.wrapping_add(n), Ordering::Release);
+        n
+    }
+
+    /// 取出一个字节（消费者调用）
+    pub fn pop(&self) -> Option<u8> {
+        let tail = self.tail.load(Ordering::Relaxed);
+        if self.head.load(Ordering::Acquire) == tail {
+            return None;
+        }
+        let c = unsafe { *(self.buf.get() as *const u8).add(tail % N) };
+        self.tail.store(tail.wrapping_add(1), Ordering::Release);
+        Some(c)
+    }
+
+    /// 取出最多 out.len() 字节（消费者调用）
+    ///
+    /// # 返回
+    /// 取出的字节数
+    pub fn pop_into(&self, out: &mut [u8]) -> usize {
+        let tail = self.tail.load(Ordering::Relaxed);
+        let n = out.len().min(self.head.load(Ordering::Acquire).wrapping_sub(tail));
+        let pos = tail % N;
+        let first = n.min(N - pos);
+        unsafe {
+            let buf = self.buf.get() as *const u8;
+            core::ptr::copy_nonoverlapping(buf.add(pos), out.as_mut_ptr(), first);
+            core::ptr::copy_nonoverlapping(buf, out.as_mut_ptr().add(first), n - first);
+        }
+        self.tail.store(tail.wrapping_add(n), Ordering::Release);
+        n
+    }
+
+    /// 丢弃所有数据（消费者调用）
+    pub fn clear(&self) {
+        self.tail.store(self.head.load(Ordering::Acquire), Ordering::Release);
+    }
+}
+
+/// 发送缓冲区，生产者由 TTY 的输出锁串行化
+pub static XMIT: CircBuf<XMIT_SIZE> = CircBuf::new();
+/// 接收缓冲区，消费者由线路规程的锁串行化
+pub static RX: CircBuf<RX_SIZE> = CircBuf::new();
+
+/// 端口寄存器的所有者
+static PORT_BUSY: AtomicBool = AtomicBool::new(false);
+/// 所有者退出前需要再处理一遍
+static PORT_AGAIN: AtomicBool = AtomicBool::new(false);
+/// 中断已注册，发送由 THRE 中断驱动
+static IRQ_MODE: AtomicBool = AtomicBool::new(false);
+/// IER 的当前值，只由端口所有者修改
+static IER: AtomicU8 = AtomicU8::new(0);
+/// 由端口所有者丢弃发送缓冲区中还没发出的数据
+static XMIT_FLUSH: AtomicBool = AtomicBool::new(false);
+
+#[inline]
+fn serial_in(offset: usize) -> u8 {
+    unsafe { core::ptr::read_volatile((UART_BASE + offset) as *const u8) }
+}
+
+#[inline]
+fn serial_out(offset: usize, value: u8) {
+    unsafe { core::ptr::write_volatile((UART_BASE + offset) as *mut u8, value) }
+}
+
+fn set_ier(ier: u8) {
+    if IER.load(Ordering::Relaxed) != ier {
+        IER.store(ier, Ordering::Relaxed);
+        serial_out(UART_IER, ier);
+    }
+}
+
+/// 读出所有到达的字符 (serial8250_rx_chars)，接收缓冲区满时丢弃，与 FIFO 溢出一样
+fn rx_chars() {
+    while serial_in(UART_LSR) & UART_LSR_DR != 0 {
+        let c = serial_in(UART_RX);
+        RX.push(&[c]);
+    }
+}
+
+/// 发送缓冲区中的数据 (serial8250_tx_chars)
+///
+/// 中断模式下 THRE 置位时填满一次 FIFO，还有数据就打开 THRE 中断等下一次，
+/// 发完关闭 (__stop_tx)；轮询模式下等待 THRE 把缓冲区全部发完
+fn tx_chars(irq_mode: bool) {
+    if irq_mode {
+        if serial_in(UART_LSR) & UART_LSR_THRE != 0 {
+            for _ in 0..UART_FIFO_SIZE {
+                match XMIT.pop() {
+                    Some(c) => serial_out(UART_TX, c),
+                    None => break,
+                }
+            }
+        }
+        let ier = if XMIT.is_empty() { UART_IER_RDI } else { UART_IER_RDI | UART_IER_THRI };
+        set_ier(ier);
+        return;
+    }
+    while !XMIT.is_empty() {
+        while serial_in(UART_LSR) & UART_LSR_THRE == 0 {
+            core::hint::spin_loop();
+        }
+        for _ in 0..UART_FIFO_SIZE {
+            match XMIT.pop() {
+                Some(c) => serial_out(UART_TX, c),
+                None => break,
+            }
+        }
+    }
+}
+
+/// 处理端口上的接收与发送
+///
+/// 先置 PORT_AGAIN 再争夺所有权：所有者释放后检查 PORT_AGAIN，
+/// 失败的 CPU 提交的工作要么被所有者看到，要么它自己在所有者释放后成为所有者
+fn port_service() {
+    loop {
+        PORT_AGAIN.store(true, Ordering::SeqCst);
+        if PORT_BUSY.swap(true, Ordering::SeqCst) {
+            return;
+        }
+        let irq_mode = IRQ_MODE.load(Ordering::Relaxed);
+        while PORT_AGAIN.swap(false, Ordering::SeqCst) {
+            if XMIT_FLUSH.swap(false, Ordering::Relaxed) {
+                XMIT.clear();
+            }
+            rx_chars();
+            tx_chars(irq_mode);
+        }
+        PORT_BUSY.store(false, Ordering::SeqCst);
+        if !PORT_AGAIN.load(Ordering::SeqCst) {
+            break;
+        }
+    }
+}
+
+/// 开始发送 (uart_start)
+///
+/// 中断模式下最多填一次 FIFO 就返回，轮询模式下发完才返回
+pub fn start_tx() {
+    if !XMIT.is_empty() {
+        port_service();
+    }
+}
+
+/// 丢弃还没发出的输出 (uart_flush_buffer)
+pub fn flush_xmit() {
+    XMIT_FLUSH.store(true, Ordering::Relaxed);
+    port_service();
+}
+
+/// 轮询接收，供中断注册之前的读者使用
+pub fn poll_rx() {
+    port_service();
+}
+
+/// 发送是否由中断驱动
+pub fn irq_mode() -> bool {
+    IRQ_MODE.load(Ordering::Relaxed)
+}
+
+/// 串口中断 (serial8250_interrupt)
+///
+/// 接收与发送都在硬中断中完成，唤醒读写者和线路规程处理放在下半部
+fn serial_interrupt(_irq: usize) -> IrqReturn {
+    let lsr = serial_in(UART_LSR);
+    let thri = IER.load(Ordering::Relaxed) & UART_IER_THRI != 0;
+    if lsr & UART_LSR_DR == 0 && !(thri && lsr & UART_LSR_THRE != 0) {
+        return IrqReturn::None;
+    }
+    port_service();
+    IrqReturn::WakeThread
+}
+
+/// 初始化端口并注册中断 (serial8250_startup)
+///
+/// # 参数
+/// - `softirq`: 下半部所在的软中断号
+///
+/// # 返回
+/// 中断注册失败时返回错误码，端口保持轮询模式
+pub fn init(softirq: usize) -> Result<(), i32> {
+    serial_out(UART_FCR, UART_FCR_ENABLE_FIFO | UART_FCR_CLEAR_RCVR | UART_FCR_CLEAR_XMIT);
+    serial_out(UART_MCR, serial_in(UART_MCR) | UART_MCR_OUT2);
+    IER.store(0, Ordering::Relaxed);
+    serial_out(UART_IER, 0);
+
+    crate::irq::request_threaded_irq(UART_IRQ, serial_interrupt, Some(softirq), "ttyS0")?;
+    IRQ_MODE.store(true, Ordering::Relaxed);
+    // 由端口所有者打开接收中断，缓冲区中已有的输出也一起发出
+    port_service();
+    Ok(())
+}
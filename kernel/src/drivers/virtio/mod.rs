@@ -6,11 +6,16 @@
 //!
 //! 参考: drivers/block/virtio_blk.c, Documentation/virtio/
 
+use core::sync::atomic::{AtomicBool, AtomicU64, Ordering};
 use spin::Mutex;
 
 use crate::drivers::blkdev::{GenDisk, Request, BlockDeviceOps};
+use crate::irq::IrqReturn;
+use crate::process::wait::WaitQueueHead;
+use crate::sync::semaphore::Semaphore;
 
 pub mod queue;
+pub mod packed;
 pub mod probe;
 pub mod offset;
 pub mod virtio_pci;
@@ -67,6 +72,73 @@ pub struct VirtIOBlkRegs {
     _reserved9: [u32; 4],
 }
 
+/// 块设备队列的描述符数，每个请求占 3 个，最多 21 个请求同时在设备上
+const VIRTIO_BLK_QUEUE_SIZE: u16 = 64;
+
+/// 特性位：遵循 VirtIO 1.0 规范，位于第二个特性字 (VIRTIO_F_VERSION_1 = 32)
+const VIRTIO_F_VERSION_1_HI: u32 = 1 << (32 - 32);
+
+/// 特性位：设备有多个请求队列 (VIRTIO_BLK_F_MQ)
+const VIRTIO_BLK_F_MQ: u32 = 1 << 12;
+/// 特性位：支持 Discard 命令 (VIRTIO_BLK_F_DISCARD)
+const VIRTIO_BLK_F_DISCARD: u32 = 1 << 13;
+/// 特性位：支持 Write Zeroes 命令 (VIRTIO_BLK_F_WRITE_ZEROES)
+const VIRTIO_BLK_F_WRITE_ZEROES: u32 = 1 << 14;
+
+/// 设备配置空间 (struct virtio_blk_config) 在 MMIO 中的偏移
+mod blk_config {
+    pub const CAPACITY: u64 = 0x100;
+    pub const NUM_QUEUES: u64 = 0x100 + 34;
+    pub const MAX_DISCARD_SECTORS: u64 = 0x100 + 36;
+    pub const DISCARD_SECTOR_ALIGNMENT: u64 = 0x100 + 44;
+    pub const MAX_WRITE_ZEROES_SECTORS: u64 = 0x100 + 48;
+    pub const WRITE_ZEROES_MAY_UNMAP: u64 = 0x100 + 56;
+}
+
+/// 一个请求队列 (struct virtio_blk_vq)
+struct VirtBlkVq {
+    /// VirtQueue（用于 I/O 操作）
+    vq: Mutex<queue::VirtQueue>,
+    /// 可以再提交的请求数，每个请求占 3 个描述符
+    inflight: Semaphore,
+    /// 有未收割的完成（中断时队列锁被占用）
+    irq_pending: AtomicBool,
+    /// 预分配的请求头、状态和等待状态
+    tags: VirtBlkTags,
+}
+
+impl VirtBlkVq {
+    /// 收割已用环上完成的请求并唤醒请求者 (virtblk_done)
+    ///
+    /// 中断上下文与请求者都会调用；队列锁被占用时留下标记，
+    /// 由持锁者在释放前再收割一次，不会在中断中自旋等锁
+    fn complete(&self) {
+        self.irq_pending.store(true, Ordering::Release);
+        while self.irq_pending.swap(false, Ordering::AcqRel) {
+            let mut queue = match self.vq.try_lock() {
+                Some(guard) => guard,
+                None => {
+                    self.irq_pending.store(true, Ordering::Release);
+                    return;
+                }
+            };
+            // 收割期间关闭中断，重新打开后若又有完成则继续 (virtblk_done)
+            loop {
+                queue.disable_cb();
+                while let Some((tag, _len)) = queue.get_buf() {
+                    let slot = &self.tags.slots[tag];
+                    slot.done.store(true, Ordering::Release);
+                    slot.wait.wake_up_all();
+                }
+                if queue.enable_cb() {
+                    break;
+                }
+            }
+            drop(queue);
+        }
+    }
+}
+
 /// VirtIO 块设备
 pub struct VirtIOBlkDevice {
     /// MMIO 基地址
@@ -79,12 +151,14 @@ pub struct VirtIOBlkDevice {
     block_size: u32,
     /// 初始化状态
     initialized: Mutex<bool>,
-    /// VirtQueue（用于 I/O 操作）
-    virtqueue: Mutex<Option<queue::VirtQueue>>,
-    /// 队列大小
+    /// 请求队列，CPU 按 disk.queue.map_queue 选择
+    vqs: alloc::vec::Vec<VirtBlkVq>,
+    /// 每个队列的大小
     queue_size: u16,
     /// IRQ 号
     irq: u32,
+    /// Write Zeroes 时允许设备释放扇区 (write_zeroes_may_unmap)
+    write_zeroes_may_unmap: bool,
 }
 
 unsafe impl Send for VirtIOBlkDevice {}
@@ -99,9 +173,10 @@ impl VirtIOBlkDevice {
             capacity: 0,
             block_size: 512,
             initialized: Mutex::new(false),
-            virtqueue: Mutex::new(None),
+            vqs: alloc::vec::Vec::new(),
             queue_size: 0,
             irq: 1,  // 默认 IRQ 1（第一个 VirtIO 设备）
+            write_zeroes_may_unmap: false,
         }
     }
 
@@ -115,9 +190,9 @@ impl VirtIOBlkDevice {
         const GUEST_PAGE_SIZE_OFFSET: u64 = 0x028;
         const DEVICE_FEATURES_OFFSET: u64 = 0x010;
         const DRIVER_FEATURES_OFFSET: u64 = 0x020;
-        const QUEUE_SEL_OFFSET: u64 = 0x030;
-        const QUEUE_NUM_MAX_OFFSET: u64 = 0x034;
-        const QUEUE_NUM_OFFSET: u64 = 0x038;
+
+        const DEVICE_FEATURES_SEL_OFFSET: u64 = 0x014;
+        const DRIVER_FEATURES_SEL_OFFSET: u64 = 0x024;
 
         // 辅助宏：打印寄存器读写
         macro_rules! read_reg {
@@ -175,106 +250,94 @@ impl VirtIOBlkDevice {
             }
 
             // 7. 读取设备特性
-            let _device_features = read_reg!(DEVICE_FEATURES_OFFSET, "DEVICE_FEATURES");
+            write_reg!(DEVICE_FEATURES_SEL_OFFSET, "DEVICE_FEATURES_SEL", 0);
+            let device_features = read_reg!(DEVICE_FEATURES_OFFSET, "DEVICE_FEATURES");
+            write_reg!(DEVICE_FEATURES_SEL_OFFSET, "DEVICE_FEATURES_SEL", 1);
+            let device_features_hi = read_reg!(DEVICE_FEATURES_OFFSET, "DEVICE_FEATURES");
 
             // 9. 特性协商（Modern VirtIO）
-            // 写入 DRIVER_FEATURES 寄存器
+            // 写入 DRIVER_FEATURES 寄存器：间接描述符、事件索引、多队列、Discard、
+            // Write Zeroes、VERSION_1，启用 virtio-packed 特性时再加上紧凑队列
             // 设置 FEATURES_OK 位（表示特性协商完成）
-            write_reg!(DRIVER_FEATURES_OFFSET, "DRIVER_FEATURES", 0);
+            let driver_features = device_features
+                & (queue::VIRTIO_RING_F_INDIRECT_DESC | queue::VIRTIO_RING_F_EVENT_IDX
+                    | VIRTIO_BLK_F_MQ | VIRTIO_BLK_F_DISCARD | VIRTIO_BLK_F_WRITE_ZEROES);
+            let mut wanted_hi = VIRTIO_F_VERSION_1_HI;
+            if cfg!(feature = "virtio-packed") {
+                wanted_hi |= packed::VIRTIO_F_RING_PACKED_HI;
+            }
+            let driver_features_hi = device_features_hi & wanted_hi;
+            write_reg!(DRIVER_FEATURES_SEL_OFFSET, "DRIVER_FEATURES_SEL", 0);
+            write_reg!(DRIVER_FEATURES_OFFSET, "DRIVER_FEATURES", driver_features);
+            write_reg!(DRIVER_FEATURES_SEL_OFFSET, "DRIVER_FEATURES_SEL", 1);
+            write_reg!(DRIVER_FEATURES_OFFSET, "DRIVER_FEATURES", driver_features_hi);
 
             // 9.5. 设置 FEATURES_OK 位
             write_reg!(STATUS_OFFSET, "STATUS", 0x01 | 0x02 | 0x08);
 
             // ========== VirtQueue 设置 ==========
 
-            // 10. 选择队列 0
-            write_reg!(QUEUE_SEL_OFFSET, "QUEUE_SEL", 0);
-
-            // 11. 读取最大队列大小
-            let max_queue_size = read_reg!(QUEUE_NUM_MAX_OFFSET, "QUEUE_NUM_MAX");
-
-            if max_queue_size == 0 {
-                return Err("VirtIO device has zero queue size");
-            }
-
-            self.queue_size = if max_queue_size < 8 { 4 } else { 8 };
-
-            // 12. 设置队列数量
-            write_reg!(QUEUE_NUM_OFFSET, "QUEUE_NUM", self.queue_size as u32);
-
-            // 13. 创建 VirtQueue（分配 vring 内存）
-            let virtqueue = match queue::VirtQueue::new(
-                self.queue_size,
-                0,  // queue_index: 块设备只使用队列 0
-                self.base_addr + 0x50,  // queue_notify
-                self.base_addr + 0x60,  // interrupt_status
-                self.base_addr + 0x64,  // interrupt_ack
-            ) {
-                Some(vq) => vq,
-                None => return Err("Failed to allocate VirtQueue"),
+            // 10. 队列数：协商了多队列时每个 CPU 最多一个 (init_vq)
+            let nr_vqs = if driver_features & VIRTIO_BLK_F_MQ != 0 {
+                let num_queues = core::ptr::read_volatile((self.base_addr + blk_config::NUM_QUEUES) as *const u16);
+                (num_queues as usize).clamp(1, crate::config::MAX_CPUS)
+            } else {
+                1
             };
 
-            let desc_addr = virtqueue.get_desc_addr();
-            let avail_addr = virtqueue.get_avail_addr();
-            let used_addr = virtqueue.get_used_addr();
-            // 14. Modern VirtIO: 设置队列地址（64位，分高低位）
-            // Modern VirtIO 使用三个独立的地址寄存器对来设置队列
-            use crate::drivers::virtio::offset;
-            const QUEUE_DESC_LO_OFFSET: u64 = offset::COMMON_CFG_QUEUE_DESC_LO as u64;
-            const QUEUE_DESC_HI_OFFSET: u64 = offset::COMMON_CFG_QUEUE_DESC_HI as u64;
-            const QUEUE_DRIVER_LO_OFFSET: u64 = offset::COMMON_CFG_QUEUE_DRIVER_LO as u64;
-            const QUEUE_DRIVER_HI_OFFSET: u64 = offset::COMMON_CFG_QUEUE_DRIVER_HI as u64;
-            const QUEUE_DEVICE_LO_OFFSET: u64 = offset::COMMON_CFG_QUEUE_DEVICE_LO as u64;
-            const QUEUE_DEVICE_HI_OFFSET: u64 = offset::COMMON_CFG_QUEUE_DEVICE_HI as u64;
-            const QUEUE_READY_OFFSET: u64 = offset::COMMON_CFG_QUEUE_ENABLE as u64;
-
-            // 转换虚拟地址为物理地址
-            #[cfg(feature = "riscv64")]
-            let desc_phys_addr = crate::arch::riscv64::mm::virt_to_phys(
-                crate::arch::riscv64::mm::VirtAddr::new(desc_addr)
-            ).0;
-            #[cfg(not(feature = "riscv64"))]
-            let desc_phys_addr = desc_addr;
-            #[cfg(feature = "riscv64")]
-            let avail_phys_addr = crate::arch::riscv64::mm::virt_to_phys(
-                crate::arch::riscv64::mm::VirtAddr::new(avail_addr)
-            ).0;
-            #[cfg(not(feature = "riscv64"))]
-            let avail_phys_addr = avail_addr;
-            #[cfg(feature = "riscv64")]
-            let used_phys_addr = crate::arch::riscv64::mm::virt_to_phys(
-                crate::arch::riscv64::mm::VirtAddr::new(used_addr)
-            ).0;
-            #[cfg(not(feature = "riscv64"))]
-            let used_phys_addr = used_addr;
-
-            // 写入描述符表地址（低32位）
-            write_reg!(QUEUE_DESC_LO_OFFSET, "QUEUE_DESC_LO", (desc_phys_addr & 0xFFFFFFFF) as u32);
-            // 写入描述符表地址（高32位）
-            write_reg!(QUEUE_DESC_HI_OFFSET, "QUEUE_DESC_HI", (desc_phys_addr >> 32) as u32);
-
-            // 写入可用环地址（低32位）
-            write_reg!(QUEUE_DRIVER_LO_OFFSET, "QUEUE_DRIVER_LO", (avail_phys_addr & 0xFFFFFFFF) as u32);
-            // 写入可用环地址（高32位）
-            write_reg!(QUEUE_DRIVER_HI_OFFSET, "QUEUE_DRIVER_HI", (avail_phys_addr >> 32) as u32);
-
-            // 写入已用环地址（低32位）
-            write_reg!(QUEUE_DEVICE_LO_OFFSET, "QUEUE_DEVICE_LO", (used_phys_addr & 0xFFFFFFFF) as u32);
-            // 写入已用环地址（高32位）
-            write_reg!(QUEUE_DEVICE_HI_OFFSET, "QUEUE_DEVICE_HI", (used_phys_addr >> 32) as u32);
-
-            // 设置队列就绪位
-            write_reg!(QUEUE_READY_OFFSET, "QUEUE_READY", 1);
+            // 11. 逐个创建队列
+            let use_packed = driver_features_hi & packed::VIRTIO_F_RING_PACKED_HI != 0;
+            let mut indirect = driver_features & queue::VIRTIO_RING_F_INDIRECT_DESC != 0;
+            let mut vqs = alloc::vec::Vec::with_capacity(nr_vqs);
+            for index in 0..nr_vqs as u16 {
+                let mut virtqueue = match self.setup_vq(index, use_packed) {
+                    Ok(vq) => vq,
+                    // 只拿到部分队列时用已有的队列
+                    Err(e) if index == 0 => return Err(e),
+                    Err(_) => break,
+                };
+                // 间接描述符：一个请求只占环上一个描述符，头和状态之外最多 VIRTQ_MAX_INDIRECT - 2 段
+                if driver_features & queue::VIRTIO_RING_F_EVENT_IDX != 0 {
+                    virtqueue.enable_event_idx();
+                }
+                indirect = indirect && virtqueue.enable_indirect();
+                let depth = (self.queue_size / 3) as usize;
+                let tags = match VirtBlkTags::new(depth) {
+                    Some(tags) => tags,
+                    None => return Err("Failed to allocate VirtIO-Blk request pool"),
+                };
+                let inflight = Semaphore::new(0);
+                inflight.init(depth as i32);
+                vqs.push(VirtBlkVq { vq: Mutex::new(virtqueue), inflight, irq_pending: AtomicBool::new(false), tags });
+            }
+            if indirect {
+                self.disk.max_segments = queue::VIRTQ_MAX_INDIRECT - 2;
+            }
+            // 每个硬件队列可以有一个上下文在派发
+            self.disk.queue.set_depth((self.queue_size / 3) as usize * vqs.len());
+            self.disk.queue.set_nr_hw_queues(vqs.len());
+            self.vqs = vqs;
 
-            // 15. 读取设备容量
-            const VIRTIO_BLK_CONFIG_CAPACITY: u64 = 0x100;
-            let cap_ptr = (self.base_addr + VIRTIO_BLK_CONFIG_CAPACITY) as *const u64;
+            // 15. 读取设备容量与 Discard / Write Zeroes 限制 (virtblk_probe)
+            let cap_ptr = (self.base_addr + blk_config::CAPACITY) as *const u64;
             self.capacity = *cap_ptr;
+            let read_config = |offset: u64| core::ptr::read_volatile((self.base_addr + offset) as *const u32);
+            if driver_features & VIRTIO_BLK_F_DISCARD != 0 {
+                // 0 表示没有上限
+                let max = read_config(blk_config::MAX_DISCARD_SECTORS);
+                self.disk.max_discard_sectors = if max == 0 { u32::MAX } else { max };
+                self.disk.discard_granularity = read_config(blk_config::DISCARD_SECTOR_ALIGNMENT).max(1);
+            }
+            if driver_features & VIRTIO_BLK_F_WRITE_ZEROES != 0 {
+                let max = read_config(blk_config::MAX_WRITE_ZEROES_SECTORS);
+                self.disk.max_write_zeroes_sectors = if max == 0 { u32::MAX } else { max };
+                self.write_zeroes_may_unmap =
+                    core::ptr::read_volatile((self.base_addr + blk_config::WRITE_ZEROES_MAY_UNMAP) as *const u8) != 0;
+            }
 
             // 16. 更新块设备信息
             self.disk.set_capacity(self.capacity as u32);
             self.disk.set_request_fn(Self::handle_request);
-            *self.virtqueue.lock() = Some(virtqueue);
 
             // 17. 状态机：DRIVER_OK (0x04)
             write_reg!(STATUS_OFFSET, "STATUS", 0x01 | 0x02 | 0x08 | 0x04);
@@ -289,13 +352,93 @@ impl VirtIOBlkDevice {
         }
     }
 
+    /// 创建并向设备登记一个请求队列 (vm_setup_vq)
+    unsafe fn setup_vq(&mut self, index: u16, use_packed: bool) -> Result<queue::VirtQueue, &'static str> {
+        const QUEUE_SEL_OFFSET: u64 = 0x030;
+        const QUEUE_NUM_MAX_OFFSET: u64 = 0x034;
+        const QUEUE_NUM_OFFSET: u64 = 0x038;
+        // Modern VirtIO 使用三个独立的地址寄存器对来设置队列
+        // (VIRTIO_MMIO_QUEUE_*；offset 模块中是 PCI common cfg 的偏移，不适用于 MMIO)
+        const QUEUE_READY_OFFSET: u64 = 0x044;
+        const QUEUE_DESC_LO_OFFSET: u64 = 0x080;
+        const QUEUE_DESC_HI_OFFSET: u64 = 0x084;
+        const QUEUE_DRIVER_LO_OFFSET: u64 = 0x090;
+        const QUEUE_DRIVER_HI_OFFSET: u64 = 0x094;
+        const QUEUE_DEVICE_LO_OFFSET: u64 = 0x0a0;
+        const QUEUE_DEVICE_HI_OFFSET: u64 = 0x0a4;
+
+        let base = self.base_addr;
+        let write_reg = |offset: u64, val: u32| core::ptr::write_volatile((base + offset) as *mut u32, val);
+        let read_reg = |offset: u64| core::ptr::read_volatile((base + offset) as *const u32);
+
+        // 选择队列并读取最大队列大小
+        write_reg(QUEUE_SEL_OFFSET, index as u32);
+        let max_queue_size = read_reg(QUEUE_NUM_MAX_OFFSET);
+        if max_queue_size == 0 {
+            return Err("VirtIO device has zero queue size");
+        }
+        // 各队列取相同的大小，队列深度按第一个队列计算
+        if index == 0 {
+            self.queue_size = (max_queue_size as u16).min(VIRTIO_BLK_QUEUE_SIZE);
+        } else if (max_queue_size as u16) < self.queue_size {
+            return Err("VirtIO queue smaller than queue 0");
+        }
+        write_reg(QUEUE_NUM_OFFSET, self.queue_size as u32);
+
+        // 创建 VirtQueue（分配 vring 内存）
+        let new_queue = if use_packed { queue::VirtQueue::new_packed } else { queue::VirtQueue::new };
+        let virtqueue = match new_queue(
+            self.queue_size,
+            index,
+            base + 0x50,  // queue_notify
+            base + 0x60,  // interrupt_status
+            base + 0x64,  // interrupt_ack
+        ) {
+            Some(vq) => vq,
+            None => return Err("Failed to allocate VirtQueue"),
+        };
+
+        // 转换虚拟地址为物理地址
+        let to_phys = |addr: u64| -> u64 {
+            #[cfg(feature = "riscv64")]
+            {
+                crate::arch::riscv64::mm::virt_to_phys(crate::arch::riscv64::mm::VirtAddr::new(addr)).0
+            }
+            #[cfg(not(feature = "riscv64"))]
+            {
+                addr
+            }
+        };
+        let desc_phys_addr = to_phys(virtqueue.get_desc_addr());
+        let avail_phys_addr = to_phys(virtqueue.get_avail_addr());
+        let used_phys_addr = to_phys(virtqueue.get_used_addr());
+
+        write_reg(QUEUE_DESC_LO_OFFSET, (desc_phys_addr & 0xFFFFFFFF) as u32);
+        write_reg(QUEUE_DESC_HI_OFFSET, (desc_phys_addr >> 32) as u32);
+        write_reg(QUEUE_DRIVER_LO_OFFSET, (avail_phys_addr & 0xFFFFFFFF) as u32);
+        write_reg(QUEUE_DRIVER_HI_OFFSET, (avail_phys_addr >> 32) as u32);
+        write_reg(QUEUE_DEVICE_LO_OFFSET, (used_phys_addr & 0xFFFFFFFF) as u32);
+        write_reg(QUEUE_DEVICE_HI_OFFSET, (used_phys_addr >> 32) as u32);
+
+        // 设置队列就绪位
+        write_reg(QUEUE_READY_OFFSET, 1);
+        Ok(virtqueue)
+    }
+
     /// 获取容量
     pub fn get_capacity(&self) -> u64 {
         self.capacity
     }
 
+    /// 请求队列数
+    pub fn nr_queues(&self) -> usize {
+        self.vqs.len()
+    }
+
     /// 处理 I/O 请求
     unsafe extern "C" fn handle_request(req: &mut Request) {
+        use crate::drivers::blkdev::ReqCmd;
+
         // 从 private_data 获取 VirtIOBlkDevice 指针
         let gd = &*req.device;
         let device_ptr = match gd.private_data {
@@ -311,19 +454,31 @@ impl VirtIOBlkDevice {
         let device = &*device_ptr;
 
         // 根据命令类型执行相应的操作
+        let segs = if req.sg.is_empty() {
+            alloc::vec![(req.buffer.as_mut_ptr() as usize, req.buffer.len())]
+        } else {
+            core::mem::take(&mut req.sg)
+        };
         let result = match req.cmd_type {
-            crate::drivers::blkdev::ReqCmd::Read => {
+            ReqCmd::Read => {
                 // 读取块
-                device.read_block(req.sector, &mut req.buffer)
+                device.do_request(queue::req_type::VIRTIO_BLK_T_IN, req.sector, &segs, true)
             }
-            crate::drivers::blkdev::ReqCmd::Write => {
+            ReqCmd::Write => {
                 // 写入块
-                device.write_block(req.sector, &req.buffer)
+                device.do_request(queue::req_type::VIRTIO_BLK_T_OUT, req.sector, &segs, false)
             }
-            crate::drivers::blkdev::ReqCmd::Flush => {
+            ReqCmd::Flush => {
                 // 刷新操作（暂时返回成功）
                 Ok(())
             }
+            ReqCmd::Discard => {
+                device.do_range_request(queue::req_type::VIRTIO_BLK_T_DISCARD, req.sector, req.nr_sectors, 0)
+            }
+            ReqCmd::WriteZeroes => {
+                let flags = if device.write_zeroes_may_unmap { queue::VIRTIO_BLK_WRITE_ZEROES_FLAG_UNMAP } else { 0 };
+                device.do_range_request(queue::req_type::VIRTIO_BLK_T_WRITE_ZEROES, req.sector, req.nr_sectors, flags)
+            }
         };
 
         // 调用完成回调
@@ -344,268 +499,204 @@ impl VirtIOBlkDevice {
 
     /// 读取块
     pub fn read_block(&self, sector: u64, buf: &mut [u8]) -> Result<(), i32> {
-        if !*self.initialized.lock() {
-            return Err(-5);  // EIO
-        }
-
-        // 获取 VirtQueue
-        let mut queue_guard = self.virtqueue.lock();
-        let queue = match queue_guard.as_mut() {
-            Some(q) => q,
-            None => return Err(-5),
-        };
+        self.do_request(queue::req_type::VIRTIO_BLK_T_IN, sector, &[(buf.as_mut_ptr() as usize, buf.len())], true)
+    }
 
-        use queue::{VirtIOBlkReqHeader, VirtIOBlkResp};
+    /// 写入块
+    pub fn write_block(&self, sector: u64, buf: &[u8]) -> Result<(), i32> {
+        self.do_request(queue::req_type::VIRTIO_BLK_T_OUT, sector, &[(buf.as_ptr() as usize, buf.len())], false)
+    }
 
-        // 构造 VirtIO 块请求头
-        let req_header = VirtIOBlkReqHeader {
-            type_: queue::req_type::VIRTIO_BLK_T_IN,
-            reserved: 0,
-            sector,
-        };
+    /// 提交一个读写请求并等待完成
+    fn do_request(&self, type_: u32, sector: u64, segs: &[(usize, usize)], device_writes: bool) -> Result<(), i32> {
+        self.exec(type_, sector, |_, _, bufs| {
+            for &(addr, len) in segs {
+                queue::buf_to_sg(addr, len, device_writes, bufs);
+            }
+        })
+    }
 
-        // 分配请求头缓冲区（需要持久化直到请求完成）
-        let header_layout = alloc::alloc::Layout::new::<VirtIOBlkReqHeader>();
-        let header_ptr: *mut VirtIOBlkReqHeader;
-        unsafe {
-            header_ptr = alloc::alloc::alloc(header_layout) as *mut VirtIOBlkReqHeader;
+    /// 提交一个 Discard / Write Zeroes 请求并等待完成 (virtblk_setup_discard_write_zeroes_erase)
+    ///
+    /// 数据是一个描述扇区范围的段，请求头中的扇区号不使用
+    fn do_range_request(&self, type_: u32, sector: u64, nr_sectors: u64, flags: u32) -> Result<(), i32> {
+        if nr_sectors > u32::MAX as u64 {
+            return Err(-22);  // EINVAL
         }
-        if header_ptr.is_null() {
-            return Err(-12);  // ENOMEM
+        self.exec(type_, 0, |tags, tag, bufs| {
+            tags.ranges.write(tag, queue::VirtIOBlkDiscardWriteZeroes { sector, num_sectors: nr_sectors as u32, flags });
+            bufs.push((tags.ranges.phys(tag), core::mem::size_of::<queue::VirtIOBlkDiscardWriteZeroes>() as u32, false));
+        })
+    }
+
+    /// 在当前 CPU 对应的队列上提交一个请求并等待完成 (virtio_queue_rq + blk_execute_rq)
+    ///
+    /// 每个队列最多 queue_size / 3 个请求同时在设备上，每个请求占一个标签 (tag)：
+    /// 请求头和状态字节在预分配的池中按标签索引，物理地址事先已知；
+    /// 描述符放入可用环后释放队列锁，请求者在标签的完成上等待，由中断处理函数收割已用环后唤醒
+    fn exec(
+        &self,
+        type_: u32,
+        sector: u64,
+        fill: impl FnOnce(&VirtBlkTags, usize, &mut alloc::vec::Vec<(u64, u32, bool)>),
+    ) -> Result<(), i32> {
+        if !*self.initialized.lock() {
+            return Err(-5);  // EIO
         }
-        unsafe {
-            *header_ptr = req_header;
+        if self.vqs.is_empty() {
+            return Err(-5);
         }
+        // 完成时要回到提交的队列收割，请求者之后迁移到别的 CPU 也不受影响
+        let cpu = crate::arch::cpu_id() as usize;
+        let vq = &self.vqs[self.disk.queue.map_queue(cpu)];
+        let tags = &vq.tags;
 
-        // 分配响应缓冲区
-        let resp_layout = alloc::alloc::Layout::new::<VirtIOBlkResp>();
-        let resp_ptr: *mut VirtIOBlkResp;
-        unsafe {
-            resp_ptr = alloc::alloc::alloc(resp_layout) as *mut VirtIOBlkResp;
-        }
-        if resp_ptr.is_null() {
-            unsafe {
-                alloc::alloc::dealloc(header_ptr as *mut u8, header_layout);
+        use queue::{VirtIOBlkReqHeader, VirtIOBlkResp};
+
+        // 限制同时在设备上的请求数：拿到信号量后一定有空闲标签
+        vq.inflight.down();
+        let tag = tags.get();
+        let slot = &tags.slots[tag];
+        slot.done.store(false, Ordering::Relaxed);
+        tags.headers.write(tag, VirtIOBlkReqHeader { type_, reserved: 0, sector });
+        tags.resps.write(tag, VirtIOBlkResp { status: 0xFF });
+
+        // 请求头、按页拆开的数据段、状态字节
+        let mut bufs = alloc::vec::Vec::with_capacity(4);
+        bufs.push((tags.headers.phys(tag), core::mem::size_of::<VirtIOBlkReqHeader>() as u32, false));
+        fill(tags, tag, &mut bufs);
+        bufs.push((tags.resps.phys(tag), core::mem::size_of::<VirtIOBlkResp>() as u32, true));
+        let added = {
+            let mut queue = vq.vq.lock();
+            let added = queue.add_buf(&bufs, tag).is_some();
+            if added {
+                queue.kick();
             }
-            return Err(-12);  // ENOMEM
-        }
-        unsafe {
-            (*resp_ptr).status = 0xFF;  // 初始化为无效状态
-        }
-
-        // VirtIO 描述符标志
-        const VIRTQ_DESC_F_NEXT: u16 = 1;
-        const VIRTQ_DESC_F_WRITE: u16 = 2;
-
-        // 将虚拟地址转换为物理地址（VirtIO 设备需要物理地址进行 DMA）
-        #[cfg(feature = "riscv64")]
-        let header_phys_addr = crate::arch::riscv64::mm::virt_to_phys(
-            crate::arch::riscv64::mm::VirtAddr::new(header_ptr as u64)
-        ).0;
-        #[cfg(feature = "riscv64")]
-        let data_phys_addr = crate::arch::riscv64::mm::virt_to_phys(
-            crate::arch::riscv64::mm::VirtAddr::new(buf.as_ptr() as u64)
-        ).0;
-        #[cfg(feature = "riscv64")]
-        let resp_phys_addr = crate::arch::riscv64::mm::virt_to_phys(
-            crate::arch::riscv64::mm::VirtAddr::new(resp_ptr as u64)
-        ).0;
-
-        // 如果不是 RISC-V，使用原始地址（仅用于其他架构）
-        #[cfg(not(feature = "riscv64"))]
-        let header_phys_addr = header_ptr as u64;
-        #[cfg(not(feature = "riscv64"))]
-        let data_phys_addr = buf.as_ptr() as u64;
-        #[cfg(not(feature = "riscv64"))]
-        let resp_phys_addr = resp_ptr as u64;
-
-        // 分配三个描述符
-        let header_desc_idx = match queue.alloc_desc() {
-            Some(idx) => idx,
-            None => return Err(-5),
-        };
-        let data_desc_idx = match queue.alloc_desc() {
-            Some(idx) => idx,
-            None => return Err(-5),
-        };
-        let resp_desc_idx = match queue.alloc_desc() {
-            Some(idx) => idx,
-            None => return Err(-5),
+            added
         };
+        if !added {
+            tags.put(tag);
+            vq.inflight.up();
+            return Err(-5);
+        }
 
-        // 设置请求头描述符（只读，设备读取）- 使用物理地址
-        queue.set_desc(
-            header_desc_idx,
-            header_phys_addr,
-            core::mem::size_of::<VirtIOBlkReqHeader>() as u32,
-            VIRTQ_DESC_F_NEXT,
-            data_desc_idx,
-        );
-
-        // 设置数据缓冲区描述符（只写，设备写入）- 使用物理地址
-        // 对于读请求，数据缓冲区必须是设备可写的
-        queue.set_desc(
-            data_desc_idx,
-            data_phys_addr,
-            buf.len() as u32,
-            VIRTQ_DESC_F_WRITE | VIRTQ_DESC_F_NEXT,  // WRITE + NEXT
-            resp_desc_idx,
-        );
-
-        // 设置响应描述符（只写，设备写入）- 使用物理地址
-        queue.set_desc(
-            resp_desc_idx,
-            resp_phys_addr,
-            core::mem::size_of::<VirtIOBlkResp>() as u32,
-            0,  // 最后一个描述符
-            0,
-        );
-
-        // 提交到可用环
-        queue.submit(header_desc_idx);
-
-        // 通知设备
-        queue.notify();
-
-        // 等待设备完成请求
-        let prev_used = queue.get_used();
-        let used = queue.wait_for_completion(prev_used);
-
-        // 检查中断状态并清除
-        const INTERRUPT_STATUS_OFFSET: u64 = 0x60;
-        unsafe {
-            let irq_ptr = (self.base_addr + INTERRUPT_STATUS_OFFSET) as *const u32;
-            let irq_status = core::ptr::read_volatile(irq_ptr);
-            if irq_status != 0 {
-                const INTERRUPT_ACK_OFFSET: u64 = 0x64;
-                let ack_ptr = (self.base_addr + INTERRUPT_ACK_OFFSET) as *mut u32;
-                core::ptr::write_volatile(ack_ptr, irq_status);
+        // 等待完成；中断没有送达时（未使能或被其他 CPU 持锁错过）自己收割
+        while !slot.done.load(Ordering::Acquire) {
+            let current = match crate::sched::current() {
+                Some(task) => task,
+                None => {
+                    vq.complete();
+                    core::hint::spin_loop();
+                    continue;
+                }
+            };
+            let entry = crate::process::wait::WaitQueueEntry::new(current, false);
+            slot.wait.add(&entry);
+            if !slot.done.load(Ordering::Acquire) {
+                vq.complete();
+            }
+            if !slot.done.load(Ordering::Acquire) {
+                #[cfg(feature = "riscv64")]
+                crate::sched::schedule();
             }
+            slot.wait.remove(&entry);
         }
 
-        // 检查响应状态
-        unsafe {
-            let status = (*resp_ptr).status;
-            alloc::alloc::dealloc(header_ptr as *mut u8, header_layout);
-            alloc::alloc::dealloc(resp_ptr as *mut u8, resp_layout);
-
-            if status == queue::status::VIRTIO_BLK_S_OK {
-                Ok(())
-            } else {
-                Err(-5)  // EIO
-            }
+        // 读出状态后才归还标签
+        let status = tags.resps.read(tag).status;
+        tags.put(tag);
+        vq.inflight.up();
+        match status {
+            queue::status::VIRTIO_BLK_S_OK => Ok(()),
+            queue::status::VIRTIO_BLK_S_UNSUPP => Err(-95),  // EOPNOTSUPP
+            _ => Err(-5),  // EIO
         }
     }
 
-    /// 写入块
-    pub fn write_block(&self, sector: u64, buf: &[u8]) -> Result<(), i32> {
-        if !*self.initialized.lock() {
-            return Err(-5);  // EIO
+    /// 收割所有队列上完成的请求 (virtblk_done)
+    ///
+    /// MMIO 设备所有队列共用一个中断，无法区分来源
+    fn complete_requests(&self) {
+        for vq in &self.vqs {
+            vq.complete();
         }
+    }
+}
 
-        // 获取 VirtQueue
-        let mut queue_guard = self.virtqueue.lock();
-        let queue = queue_guard.as_mut().ok_or(-5)?;
-
-        use queue::{VirtIOBlkReqHeader, VirtIOBlkResp};
+/// 请求标签的等待状态
+struct VirtBlkSlot {
+    /// 设备已完成 (struct completion)
+    done: AtomicBool,
+    wait: WaitQueueHead,
+}
 
-        // 构造 VirtIO 块请求头
-        let req_header = VirtIOBlkReqHeader {
-            type_: queue::req_type::VIRTIO_BLK_T_OUT,
-            reserved: 0,
-            sector,
-        };
+/// 预分配的请求资源 (blk_mq_tags + virtblk_req pdu)
+///
+/// 请求头与状态字节放在两个 DMA 池中，按标签索引
+pub struct VirtBlkTags {
+    headers: queue::DmaPool<queue::VirtIOBlkReqHeader>,
+    resps: queue::DmaPool<queue::VirtIOBlkResp>,
+    /// Discard / Write Zeroes 的范围段
+    ranges: queue::DmaPool<queue::VirtIOBlkDiscardWriteZeroes>,
+    slots: alloc::vec::Vec<VirtBlkSlot>,
+    /// 空闲标签位图
+    free: AtomicU64,
+}
 
-        // 分配请求头缓冲区（需要持久化直到请求完成）
-        let header_layout = alloc::alloc::Layout::new::<VirtIOBlkReqHeader>();
-        let header_ptr: *mut VirtIOBlkReqHeader;
-        unsafe {
-            header_ptr = alloc::alloc::alloc(header_layout) as *mut VirtIOBlkReqHeader;
-        }
-        if header_ptr.is_null() {
-            return Err(-12);  // ENOMEM
-        }
-        unsafe {
-            *header_ptr = req_header;
-        }
+impl VirtBlkTags {
+    /// 分配 nr 个标签（最多 64 个）的请求头、状态与范围段池
+    pub fn new(nr: usize) -> Option<Self> {
+        use queue::{VirtIOBlkDiscardWriteZeroes, VirtIOBlkReqHeader, VirtIOBlkResp};
+
+        let nr = nr.clamp(1, 64);
+        let headers = queue::DmaPool::new(nr, VirtIOBlkReqHeader { type_: 0, reserved: 0, sector: 0 })?;
+        let resps = queue::DmaPool::new(nr, VirtIOBlkResp { status: 0xFF })?;
+        let ranges = queue::DmaPool::new(nr, VirtIOBlkDiscardWriteZeroes { sector: 0, num_sectors: 0, flags: 0 })?;
+        let slots = (0..nr)
+            .map(|_| VirtBlkSlot { done: AtomicBool::new(false), wait: WaitQueueHead::new() })
+            .collect();
+        let free = if nr == 64 { u64::MAX } else { (1u64 << nr) - 1 };
+        Some(Self { headers, resps, ranges, slots, free: AtomicU64::new(free) })
+    }
 
-        // 分配响应缓冲区
-        let resp_layout = alloc::alloc::Layout::new::<VirtIOBlkResp>();
-        let resp_ptr: *mut VirtIOBlkResp;
-        unsafe {
-            resp_ptr = alloc::alloc::alloc(resp_layout) as *mut VirtIOBlkResp;
-        }
-        if resp_ptr.is_null() {
-            unsafe {
-                alloc::alloc::dealloc(header_ptr as *mut u8, header_layout);
+    /// 取一个空闲标签，调用者已通过 inflight 信号量保证存在 (blk_mq_get_tag)
+    fn get(&self) -> usize {
+        loop {
+            match self.try_get() {
+                Some(tag) => return tag,
+                None => core::hint::spin_loop(),
             }
-            return Err(-12);  // ENOMEM
         }
-        unsafe {
-            (*resp_ptr).status = 0xFF;  // 初始化为无效状态
-        }
-
-        // VirtIO 描述符标志
-        const VIRTQ_DESC_F_NEXT: u16 = 1;
-        const VIRTQ_DESC_F_WRITE: u16 = 2;
-
-        // 分配三个描述符
-        let header_desc_idx = queue.alloc_desc().ok_or(-5)?;
-        let data_desc_idx = queue.alloc_desc().ok_or(-5)?;
-        let resp_desc_idx = queue.alloc_desc().ok_or(-5)?;
-
-        // 设置请求头描述符（只读，设备读取）
-        queue.set_desc(
-            header_desc_idx,
-            header_ptr as u64,
-            core::mem::size_of::<VirtIOBlkReqHeader>() as u32,
-            VIRTQ_DESC_F_NEXT,
-            data_desc_idx,
-        );
-
-        // 设置数据缓冲区描述符（只读，设备读取）
-        queue.set_desc(
-            data_desc_idx,
-            buf.as_ptr() as u64,
-            buf.len() as u32,
-            VIRTQ_DESC_F_NEXT,
-            resp_desc_idx,
-        );
-
-        // 设置响应描述符（只写，设备写入）
-        queue.set_desc(
-            resp_desc_idx,
-            resp_ptr as u64,
-            core::mem::size_of::<VirtIOBlkResp>() as u32,
-            VIRTQ_DESC_F_WRITE,
-            0,
-        );
-
-        // 提交到可用环
-        queue.submit(header_desc_idx);
-
-        // 通知设备
-        queue.notify();
-
-        // 等待完成
-        let prev_used = queue.get_used();
-        let _used = queue.wait_for_completion(prev_used);
-
-        // 检查响应状态
-        unsafe {
-            let status = (*resp_ptr).status;
-            alloc::alloc::dealloc(header_ptr as *mut u8, header_layout);
-            alloc::alloc::dealloc(resp_ptr as *mut u8, resp_layout);
+    }
 
-            if status == queue::status::VIRTIO_BLK_S_OK {
-                Ok(())
-            } else if status == queue::status::VIRTIO_BLK_S_IOERR {
-                Err(-5)  // EIO
-            } else {
-                Err(-5)  // EIO
+    /// 取编号最小的空闲标签，全部在用时返回 None (__blk_mq_get_tag)
+    pub fn try_get(&self) -> Option<usize> {
+        loop {
+            let free = self.free.load(Ordering::Acquire);
+            if free == 0 {
+                return None;
+            }
+            let tag = free.trailing_zeros() as usize;
+            if self.free.compare_exchange(free, free & !(1 << tag), Ordering::AcqRel, Ordering::Relaxed).is_ok() {
+                return Some(tag);
             }
         }
     }
+
+    /// 第 tag 个请求头的物理地址
+    pub fn header_phys(&self, tag: usize) -> u64 {
+        self.headers.phys(tag)
+    }
+
+    /// 第 tag 个状态字节的物理地址
+    pub fn resp_phys(&self, tag: usize) -> u64 {
+        self.resps.phys(tag)
+    }
+
+    /// 归还标签 (blk_mq_put_tag)
+    pub fn put(&self, tag: usize) {
+        self.free.fetch_or(1 << tag, Ordering::Release);
+    }
 }
 
 /// VirtIO 块设备操作
@@ -648,6 +739,8 @@ pub fn init(base_addr: u64) -> Result<(), &'static str> {
         if let Some(ref mut dev) = VIRTIO_BLK {
             let device_ptr = dev as *const VirtIOBlkDevice as *mut u8;
             dev.disk.private_data = Some(device_ptr);
+            crate::println!("virtio-blk: {} request queue(s), discard {}, write-zeroes {}",
+                dev.nr_queues(), dev.disk.max_discard_sectors != 0, dev.disk.max_write_zeroes_sectors != 0);
         }
 
         Ok(())
@@ -816,6 +909,10 @@ unsafe extern "C" fn pci_virtio_handle_request(req: &mut Request) {
             // 刷新操作（暂返回成功）
             Ok(())
         }
+        ReqCmd::Discard | ReqCmd::WriteZeroes => {
+            // GenDisk 的限制为 0，块层不会下发
+            Err(-95)  // EOPNOTSUPP
+        }
     };
 
     // 调用完成回调
@@ -865,7 +962,7 @@ pub fn get_pci_gen_disk() -> Option<&'static GenDisk> {
 /// # 说明
 /// PCI VirtIO 使用传统的 INTx 中断，通过 PCI INTx 引脚传递
 /// 中断在 PLIC 层面处理，不需要读取设备特定的中断状态寄存器
-pub fn interrupt_handler_pci(irq: usize) {
+pub fn interrupt_handler_pci(irq: usize) -> IrqReturn {
     crate::println!("virtio-blk: interrupt_handler_pci called (IRQ {})!", irq);
     unsafe {
         if let Some(_pci_device) = VIRTIO_PCI_BLK.as_ref() {
@@ -886,44 +983,63 @@ pub fn interrupt_handler_pci(irq: usize) {
             }
 
             crate::println!("virtio-blk: PCI VirtIO interrupt handled");
-            return;
+            IrqReturn::Handled
         } else {
             crate::println!("virtio-blk: ERROR: No PCI VirtIO device found!");
+            IrqReturn::None
         }
     }
 }
 
-/// VirtIO-Blk 中断处理器（Legacy MMIO VirtIO）
+/// PCI VirtIO-Blk 的 MSI-X 中断处理器 (vp_vring_interrupt)
 ///
-/// 处理 Legacy MMIO VirtIO-Blk 设备的中断
-pub fn interrupt_handler() {
-    crate::println!("virtio-blk: interrupt_handler called (MMIO)!");
+/// 每个向量只对应一个队列或配置变更，不需要读取 ISR 区分来源；
+/// IMSIC 在 claim 时已经清除 pending 位，也不需要在 PLIC 上 complete。
+/// PCI 块设备的请求同步等待已用环，这里只确认中断属于本设备
+pub fn msix_handler_pci(id: usize) -> IrqReturn {
     unsafe {
-        // MMIO VirtIO 设备（Legacy VirtIO）
-        if let Some(device) = VIRTIO_BLK.as_ref() {
-            // 读取中断状态 (INTERRUPT_STATUS at 0x60)
-            let irq_status_ptr = (device.base_addr + 0x60) as *const u32;
-            let irq_status = core::ptr::read_volatile(irq_status_ptr);
-
-            crate::println!("virtio-blk: MMIO IRQ status = 0x{:x}", irq_status);
-
-            if irq_status != 0 {
-                crate::println!("virtio-blk: MMIO Interrupt! status=0x{:x}", irq_status);
-
-                // 清除中断（INTERRUPT_ACK at 0x64）
-                let irq_ack_ptr = (device.base_addr + 0x64) as *mut u32;
-                core::ptr::write_volatile(irq_ack_ptr, irq_status);
+        match VIRTIO_PCI_BLK.as_ref() {
+            Some(device) if device.msix_vectors.contains(&id) => IrqReturn::Handled,
+            _ => IrqReturn::None,
+        }
+    }
+}
 
-                // 获取队列并打印状态
-                if let Some(queue_guard) = device.virtqueue.try_lock() {
-                    if let Some(queue) = queue_guard.as_ref() {
-                        let used_idx = queue.get_used();
-                        crate::println!("virtio-blk: used_idx now = {}", used_idx);
-                    }
-                }
-            }
+/// VirtIO-Blk 中断处理器（MMIO VirtIO）
+///
+/// 硬中断中只应答设备中断 (vm_interrupt)；已用环有更新时返回 WakeThread，
+/// 收割已用环、唤醒等待的请求者在 BLOCK_SOFTIRQ 中开中断完成 (virtblk_done)。
+/// PLIC 的 claim / complete 由陷入处理完成
+pub fn interrupt_handler(_irq: usize) -> IrqReturn {
+    unsafe {
+        let device = match VIRTIO_BLK.as_ref() {
+            Some(device) => device,
+            None => return IrqReturn::None,
+        };
+        let irq_status_ptr = (device.base_addr + 0x60) as *const u32;
+        let irq_status = core::ptr::read_volatile(irq_status_ptr);
+        if irq_status == 0 {
+            return IrqReturn::None;
+        }
+        let irq_ack_ptr = (device.base_addr + 0x64) as *mut u32;
+        core::ptr::write_volatile(irq_ack_ptr, irq_status);
+        // bit 0：已用环有更新
+        if irq_status & 1 != 0 {
+            IrqReturn::WakeThread
         } else {
-            crate::println!("virtio-blk: ERROR: No VirtIO block device found!");
+            IrqReturn::Handled
+        }
+    }
+}
+
+/// VirtIO-Blk 中断下半部 (BLOCK_SOFTIRQ)
+///
+/// 在收到中断的 CPU 上开中断运行；complete_requests 只 try_lock 队列，
+/// 硬中断打断它时不会等锁
+fn blk_done_softirq() {
+    unsafe {
+        if let Some(device) = VIRTIO_BLK.as_ref() {
+            device.complete_requests();
         }
     }
 }
@@ -948,11 +1064,18 @@ pub fn enable_device_interrupt(base_addr: u64) {
 
     crate::println!("virtio-blk: Enabling IRQ {} for device at 0x{:x} (slot {})", irq, base_addr, slot);
 
-    // 使能 IRQ（在当前 boot hart 上）
+    // 注册线程化中断，按亲和性在 PLIC 中使能（默认所有可接收中断的 hart）
     #[cfg(feature = "riscv64")]
     {
-        let boot_hart = crate::arch::riscv64::smp::cpu_id();
-        crate::drivers::intc::plic::enable_interrupt(boot_hart, irq);
+        crate::softirq::open_softirq_threaded(crate::softirq::BLOCK_SOFTIRQ, blk_done_softirq);
+        if let Err(e) = crate::irq::request_threaded_irq(
+            irq,
+            interrupt_handler,
+            Some(crate::softirq::BLOCK_SOFTIRQ),
+            "virtio-blk",
+        ) {
+            crate::println!("virtio-blk: request_irq {} failed: {}", irq, e);
+        }
 
         // 也更新设备中的 IRQ 号
         unsafe {
@@ -0,0 +1,368 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! VirtIO 紧凑队列 (packed virtqueue)
+//!
+//! 描述符环同时承担可用环和已用环的角色：驱动和设备按同一方向推进，
+//! 通过描述符标志中的 AVAIL/USED 位与各自的回绕计数器判断归属，
+//! 一次请求只访问一段连续的描述符，缓存局部性比分离式队列好
+
+use alloc::vec::Vec;
+use core::sync::atomic::{fence, Ordering};
+
+use super::queue::{need_event, Desc, DmaPool, VIRTQ_DESC_F_INDIRECT, VIRTQ_DESC_F_NEXT, VIRTQ_DESC_F_WRITE, VIRTQ_MAX_INDIRECT};
+
+/// 特性位：紧凑队列布局，位于第二个特性字 (VIRTIO_F_RING_PACKED = 34)
+pub const VIRTIO_F_RING_PACKED_HI: u32 = 1 << (34 - 32);
+
+/// 描述符标志：驱动侧可用位 (VRING_PACKED_DESC_F_AVAIL)
+pub const VRING_PACKED_DESC_F_AVAIL: u16 = 1 << 7;
+/// 描述符标志：设备侧已用位 (VRING_PACKED_DESC_F_USED)
+pub const VRING_PACKED_DESC_F_USED: u16 = 1 << 15;
+
+/// 事件抑制：需要通知 (VRING_PACKED_EVENT_FLAG_ENABLE)
+pub const VRING_PACKED_EVENT_FLAG_ENABLE: u16 = 0;
+/// 事件抑制：不需要通知 (VRING_PACKED_EVENT_FLAG_DISABLE)
+pub const VRING_PACKED_EVENT_FLAG_DISABLE: u16 = 1;
+/// 事件抑制：到达 off_wrap 指定的位置时通知 (VRING_PACKED_EVENT_FLAG_DESC)
+pub const VRING_PACKED_EVENT_FLAG_DESC: u16 = 2;
+
+/// off_wrap 中回绕计数器所在的位 (VRING_PACKED_EVENT_F_WRAP_CTR)
+const VRING_PACKED_EVENT_F_WRAP_CTR: u16 = 15;
+
+/// 紧凑描述符 (struct vring_packed_desc)
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct PackedDesc {
+    /// 缓冲区物理地址
+    pub addr: u64,
+    /// 长度；设备完成时写入已写字节数
+    pub len: u32,
+    /// 缓冲区 ID，设备完成时原样写回
+    pub id: u16,
+    /// 标志
+    pub flags: u16,
+}
+
+/// 事件抑制结构 (struct vring_packed_desc_event)
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct PackedEvent {
+    /// 环位置（低 15 位）与回绕计数器（最高位）
+    pub off_wrap: u16,
+    /// VRING_PACKED_EVENT_FLAG_*
+    pub flags: u16,
+}
+
+/// 每个缓冲区 ID 的状态 (vring_packed_desc_state)
+#[derive(Clone, Copy)]
+struct DescState {
+    /// 完成时返回的 token
+    token: usize,
+    /// 占用的环上描述符数
+    num: u16,
+    /// 空闲 ID 链表的下一项
+    next: u16,
+}
+
+/// 紧凑队列的驱动侧状态 (struct vring_virtqueue_packed)
+pub struct PackedRing {
+    /// 环大小
+    num: u16,
+    /// 描述符环
+    desc: *mut PackedDesc,
+    /// 驱动事件抑制区：驱动写、设备读，控制中断
+    driver_event: *mut PackedEvent,
+    /// 设备事件抑制区：设备写、驱动读，控制通知
+    device_event: *mut PackedEvent,
+    /// 下一个要填写的描述符位置
+    next_avail_idx: u16,
+    /// 驱动侧回绕计数器
+    avail_wrap_counter: bool,
+    /// 下一个要检查的已用描述符位置
+    last_used_idx: u16,
+    /// 设备侧回绕计数器
+    used_wrap_counter: bool,
+    /// 当前回绕计数器对应的 AVAIL/USED 标志
+    avail_used_flags: u16,
+    /// 空闲描述符数
+    num_free: u16,
+    /// 空闲缓冲区 ID 链表头
+    free_head: u16,
+    /// 上次通知以来放入的描述符数
+    num_added: u16,
+    /// 协商了 VIRTIO_RING_F_EVENT_IDX
+    event_idx: bool,
+    /// 驱动事件抑制区的当前标志 (event_flags_shadow)
+    event_flags_shadow: u16,
+    /// 按缓冲区 ID 索引
+    state: Vec<DescState>,
+    /// 间接描述符表，按缓冲区 ID 索引
+    indirect: Option<DmaPool<[Desc; VIRTQ_MAX_INDIRECT]>>,
+}
+
+unsafe impl Send for PackedRing {}
+unsafe impl Sync for PackedRing {}
+
+impl PackedRing {
+    /// 描述符环与两个事件抑制区各需要的字节数
+    pub fn ring_size(num: u16) -> (usize, usize) {
+        (num as usize * core::mem::size_of::<PackedDesc>(), core::mem::size_of::<PackedEvent>())
+    }
+
+    /// 在已清零的内存上建立紧凑队列 (vring_create_virtqueue_packed)
+    ///
+    /// # Safety
+    /// 三个指针指向按 ring_size 分配的、设备可访问的内存，生命周期长于本结构
+    pub unsafe fn new(num: u16, desc: *mut PackedDesc, driver_event: *mut PackedEvent, device_event: *mut PackedEvent) -> Self {
+        for i in 0..num as usize {
+            *desc.add(i) = PackedDesc { addr: 0, len: 0, id: 0, flags: 0 };
+        }
+        *driver_event = PackedEvent { off_wrap: 0, flags: VRING_PACKED_EVENT_FLAG_ENABLE };
+        *device_event = PackedEvent { off_wrap: 0, flags: VRING_PACKED_EVENT_FLAG_ENABLE };
+        let state = (0..num)
+            .map(|i| DescState { token: 0, num: 0, next: i + 1 })
+            .collect();
+        Self {
+            num,
+            desc,
+            driver_event,
+            device_event,
+            next_avail_idx: 0,
+            avail_wrap_counter: true,
+            last_used_idx: 0,
+            used_wrap_counter: true,
+            avail_used_flags: VRING_PACKED_DESC_F_AVAIL,
+            num_free: num,
+            free_head: 0,
+            num_added: 0,
+            event_idx: false,
+            event_flags_shadow: VRING_PACKED_EVENT_FLAG_ENABLE,
+            state,
+            indirect: None,
+        }
+    }
+
+    /// 使用事件索引抑制通知和中断
+    pub fn set_event_idx(&mut self, enable: bool) {
+        self.event_idx = enable;
+    }
+
+    /// 使用间接描述符表
+    pub fn enable_indirect(&mut self) -> bool {
+        let empty = [Desc { addr: 0, len: 0, flags: 0, next: 0 }; VIRTQ_MAX_INDIRECT];
+        self.indirect = DmaPool::new(self.num as usize, empty);
+        self.indirect.is_some()
+    }
+
+    /// 是否使用了间接描述符表
+    pub fn has_indirect(&self) -> bool {
+        self.indirect.is_some()
+    }
+
+    /// 空闲描述符数
+    pub fn num_free(&self) -> u16 {
+        self.num_free
+    }
+
+    /// 下一次 add_buf 使用的缓冲区 ID
+    pub fn next_id(&self) -> Option<u16> {
+        if self.num_free == 0 { None } else { Some(self.free_head) }
+    }
+
+    /// 推进驱动侧位置，回绕时翻转计数器
+    fn advance_avail(&mut self) {
+        self.next_avail_idx += 1;
+        if self.next_avail_idx >= self.num {
+            self.next_avail_idx = 0;
+            self.avail_wrap_counter = !self.avail_wrap_counter;
+            self.avail_used_flags ^= VRING_PACKED_DESC_F_AVAIL | VRING_PACKED_DESC_F_USED;
+        }
+    }
+
+    /// 放入一组缓冲区，不通知设备 (virtqueue_add_packed)
+    ///
+    /// 首个描述符的标志最后写入，设备看到它时整条链已经就绪
+    pub fn add_buf(&mut self, bufs: &[(u64, u32, bool)], token: usize) -> Option<u16> {
+        if bufs.is_empty() || self.num_free == 0 {
+            return None;
+        }
+        let id = self.free_head;
+        let head = self.next_avail_idx;
+        let head_flags;
+        let num;
+
+        match self.indirect.as_ref() {
+            Some(table) if bufs.len() > 1 && bufs.len() <= VIRTQ_MAX_INDIRECT => {
+                // 间接表中的项按顺序排列，不使用 NEXT 标志
+                let entries = table.as_mut_ptr(id as usize) as *mut PackedDesc;
+                for (i, &(addr, len, write)) in bufs.iter().enumerate() {
+                    let flags = if write { VIRTQ_DESC_F_WRITE } else { 0 };
+                    unsafe { core::ptr::write_volatile(entries.add(i), PackedDesc { addr, len, id: 0, flags }) };
+                }
+                unsafe {
+                    let d = &mut *self.desc.add(head as usize);
+                    d.addr = table.phys(id as usize);
+                    d.len = (bufs.len() * core::mem::size_of::<PackedDesc>()) as u32;
+                    d.id = id;
+                }
+                head_flags = VIRTQ_DESC_F_INDIRECT | self.avail_used_flags;
+                num = 1;
+                self.advance_avail();
+            }
+            _ => {
+                if bufs.len() > self.num_free as usize {
+                    return None;
+                }
+                let mut first_flags = 0;
+                for (i, &(addr, len, write)) in bufs.iter().enumerate() {
+                    let mut flags = if write { VIRTQ_DESC_F_WRITE } else { 0 };
+                    if i + 1 < bufs.len() {
+                        flags |= VIRTQ_DESC_F_NEXT;
+                    }
+                    flags |= self.avail_used_flags;
+                    let idx = self.next_avail_idx;
+                    unsafe {
+                        let d = &mut *self.desc.add(idx as usize);
+                        d.addr = addr;
+                        d.len = len;
+                        d.id = id;
+                        if i == 0 {
+                            first_flags = flags;
+                        } else {
+                            core::ptr::write_volatile(core::ptr::addr_of_mut!(d.flags), flags);
+                        }
+                    }
+                    self.advance_avail();
+                }
+                head_flags = first_flags;
+                num = bufs.len() as u16;
+            }
+        }
+
+        let slot = &mut self.state[id as usize];
+        self.free_head = slot.next;
+        slot.token = token;
+        slot.num = num;
+        self.num_free -= num;
+        self.num_added = self.num_added.wrapping_add(num);
+
+        // 其余描述符先于首个描述符的标志对设备可见
+        fence(Ordering::Release);
+        unsafe {
+            core::ptr::write_volatile(core::ptr::addr_of_mut!((*self.desc.add(head as usize)).flags), head_flags);
+        }
+        Some(id)
+    }
+
+    /// 是否需要通知设备 (virtqueue_kick_prepare_packed)
+    pub fn kick_prepare(&mut self) -> bool {
+        // 先发布描述符再读设备的事件抑制区
+        fence(Ordering::SeqCst);
+        let old = self.next_avail_idx.wrapping_sub(self.num_added);
+        let new = self.next_avail_idx;
+        self.num_added = 0;
+
+        let (off_wrap, flags) = unsafe {
+            (
+                core::ptr::read_volatile(core::ptr::addr_of!((*self.device_event).off_wrap)),
+                core::ptr::read_volatile(core::ptr::addr_of!((*self.device_event).flags)),
+            )
+        };
+        if self.event_idx && flags == VRING_PACKED_EVENT_FLAG_DESC {
+            let wrap_counter = off_wrap >> VRING_PACKED_EVENT_F_WRAP_CTR != 0;
+            let mut event_idx = off_wrap & !(1 << VRING_PACKED_EVENT_F_WRAP_CTR);
+            if wrap_counter != self.avail_wrap_counter {
+                event_idx = event_idx.wrapping_sub(self.num);
+            }
+            need_event(event_idx, new, old)
+        } else {
+            flags != VRING_PACKED_EVENT_FLAG_DISABLE
+        }
+    }
+
+    /// last_used_idx 处的描述符是否已被设备用完 (is_used_desc_packed)
+    fn is_used(&self, idx: u16, wrap: bool) -> bool {
+        let flags = unsafe { core::ptr::read_volatile(core::ptr::addr_of!((*self.desc.add(idx as usize)).flags)) };
+        let avail = flags & VRING_PACKED_DESC_F_AVAIL != 0;
+        let used = flags & VRING_PACKED_DESC_F_USED != 0;
+        avail == used && used == wrap
+    }
+
+    /// 是否有未收割的完成
+    pub fn more_used(&self) -> bool {
+        self.is_used(self.last_used_idx, self.used_wrap_counter)
+    }
+
+    /// 取出一个已完成的缓冲区 (virtqueue_get_buf_ctx_packed)
+    pub fn get_buf(&mut self) -> Option<(usize, u32)> {
+        if !self.more_used() {
+            return None;
+        }
+        // 先确认标志再读 id 和 len
+        fence(Ordering::Acquire);
+        let (id, len) = unsafe {
+            let d = self.desc.add(self.last_used_idx as usize);
+            (
+                core::ptr::read_volatile(core::ptr::addr_of!((*d).id)),
+                core::ptr::read_volatile(core::ptr::addr_of!((*d).len)),
+            )
+        };
+        if id >= self.num {
+            return None;
+        }
+        let slot = &mut self.state[id as usize];
+        let num = slot.num;
+        let token = slot.token;
+        slot.next = self.free_head;
+        self.free_head = id;
+        self.num_free += num;
+
+        self.last_used_idx += num;
+        if self.last_used_idx >= self.num {
+            self.last_used_idx -= self.num;
+            self.used_wrap_counter = !self.used_wrap_counter;
+        }
+
+        // 事件索引模式下中断开启时跟着推进通知位置
+        if self.event_idx && self.event_flags_shadow == VRING_PACKED_EVENT_FLAG_DESC {
+            self.write_used_event();
+        }
+        Some((token, len))
+    }
+
+    fn write_used_event(&self) {
+        let off_wrap = self.last_used_idx | ((self.used_wrap_counter as u16) << VRING_PACKED_EVENT_F_WRAP_CTR);
+        unsafe { core::ptr::write_volatile(core::ptr::addr_of_mut!((*self.driver_event).off_wrap), off_wrap) };
+    }
+
+    /// 关闭完成中断 (virtqueue_disable_cb_packed)
+    pub fn disable_cb(&mut self) {
+        if self.event_flags_shadow != VRING_PACKED_EVENT_FLAG_DISABLE {
+            self.event_flags_shadow = VRING_PACKED_EVENT_FLAG_DISABLE;
+            unsafe {
+                core::ptr::write_volatile(core::ptr::addr_of_mut!((*self.driver_event).flags), self.event_flags_shadow);
+            }
+        }
+    }
+
+    /// 重新打开完成中断 (virtqueue_enable_cb_packed)
+    ///
+    /// # 返回
+    /// 打开期间没有漏掉完成时返回 true；返回 false 时调用者应继续收割
+    pub fn enable_cb(&mut self) -> bool {
+        if self.event_idx {
+            self.write_used_event();
+            fence(Ordering::Release);
+        }
+        let flags = if self.event_idx { VRING_PACKED_EVENT_FLAG_DESC } else { VRING_PACKED_EVENT_FLAG_ENABLE };
+        if self.event_flags_shadow != flags {
+            self.event_flags_shadow = flags;
+            unsafe { core::ptr::write_volatile(core::ptr::addr_of_mut!((*self.driver_event).flags), flags) };
+        }
+        // 标志写入后再检查一次，避免设备在此之前完成而不发中断
+        fence(Ordering::SeqCst);
+        !self.more_used()
+    }
+}
@@ -111,7 +111,14 @@ pub fn virtio_probe_devices() -> usize {
 fn init_virtio_net(base_addr: u64) -> Result<(), &'static str> {
     #[cfg(feature = "riscv64")]
     {
-        crate::drivers::net::virtio_net::init(base_addr)
+        crate::drivers::net::virtio_net::init(base_addr)?;
+        // 注册设备中断：IRQ 1-8 对应 MMIO 槽位 0-7；默认在每个可接收中断的 hart 上使能，
+        // PLIC 把中断交给空闲的 hart，接收处理不再集中在引导 hart
+        let irq = ((base_addr - VIRTIO_MMIO_BASE) / VIRTIO_MMIO_SIZE) as usize + 1;
+        if let Err(e) = crate::drivers::net::virtio_net::request_irq(irq) {
+            crate::println!("virtio-net: request_irq {} failed: {}", irq, e);
+        }
+        Ok(())
     }
 
     #[cfg(not(feature = "riscv64"))]
@@ -288,6 +295,9 @@ pub fn init_pci_block_devices() -> usize {
                             continue;
                         }
 
+                        // 配置变更与队列 0 各一个 MSI-X 向量；没有 IMSIC 或设备不支持 MSI-X 时使用 INTx
+                        let _ = virtio_dev.setup_msix(1, crate::drivers::virtio::msix_handler_pci, "virtio-blk");
+
                         // 选择队列 0 并读取队列大小
                         unsafe {
                             let queue_select_ptr = (virtio_dev.common_cfg_bar + crate::drivers::virtio::offset::COMMON_CFG_QUEUE_SELECT as u64) as *mut u16;
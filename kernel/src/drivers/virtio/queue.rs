@@ -6,8 +6,61 @@
 //!
 //! 完全遵循 VirtIO 规范的队列实现
 
+use alloc::vec::Vec;
 use core::sync::atomic::{AtomicU16, Ordering};
 
+use super::packed::{PackedDesc, PackedEvent, PackedRing};
+
+/// 描述符标志：链中还有下一个描述符 (VIRTQ_DESC_F_NEXT)
+pub const VIRTQ_DESC_F_NEXT: u16 = 1;
+/// 描述符标志：设备写入的缓冲区 (VIRTQ_DESC_F_WRITE)
+pub const VIRTQ_DESC_F_WRITE: u16 = 2;
+/// 描述符标志：指向一张间接描述符表 (VIRTQ_DESC_F_INDIRECT)
+pub const VIRTQ_DESC_F_INDIRECT: u16 = 4;
+
+/// 特性位：支持间接描述符 (VIRTIO_RING_F_INDIRECT_DESC)
+pub const VIRTIO_RING_F_INDIRECT_DESC: u32 = 1 << 28;
+/// 特性位：用 used_event/avail_event 抑制中断和通知 (VIRTIO_RING_F_EVENT_IDX)
+pub const VIRTIO_RING_F_EVENT_IDX: u32 = 1 << 29;
+
+/// 可用环标志：驱动不需要中断 (VRING_AVAIL_F_NO_INTERRUPT)
+pub const VRING_AVAIL_F_NO_INTERRUPT: u16 = 1;
+/// 已用环标志：设备不需要通知 (VRING_USED_F_NO_NOTIFY)
+pub const VRING_USED_F_NO_NOTIFY: u16 = 1;
+
+/// 从 old 推进到 new 的过程中是否越过 event_idx (vring_need_event)
+#[inline]
+pub fn need_event(event_idx: u16, new: u16, old: u16) -> bool {
+    new.wrapping_sub(event_idx).wrapping_sub(1) < new.wrapping_sub(old)
+}
+
+/// 每张间接描述符表的项数
+pub const VIRTQ_MAX_INDIRECT: usize = 32;
+
+/// 把内核虚拟地址上的一段缓冲区按页拆成物理段 (sg_init_table + sg_set_buf)
+///
+/// 虚拟上连续的缓冲区在物理上不一定连续，每段不跨页
+pub fn buf_to_sg(addr: usize, len: usize, device_writes: bool, sg: &mut Vec<(u64, u32, bool)>) {
+    const PAGE_SIZE: usize = 4096;
+    let mut addr = addr;
+    let end = addr + len;
+    while addr < end {
+        let seg_end = ((addr & !(PAGE_SIZE - 1)) + PAGE_SIZE).min(end);
+        #[cfg(feature = "riscv64")]
+        let phys = crate::arch::riscv64::mm::virt_to_phys(crate::arch::riscv64::mm::VirtAddr::new(addr as u64)).0;
+        #[cfg(not(feature = "riscv64"))]
+        let phys = addr as u64;
+        // 与上一段物理相接时合并
+        match sg.last_mut() {
+            Some(last) if last.2 == device_writes && last.0 + last.1 as u64 == phys => {
+                last.1 += (seg_end - addr) as u32;
+            }
+            _ => sg.push((phys, (seg_end - addr) as u32, device_writes)),
+        }
+        addr = seg_end;
+    }
+}
+
 /// VirtIO 描述符 (16 字节对齐)
 #[repr(C)]
 #[derive(Debug, Clone, Copy)]
@@ -56,7 +109,9 @@ pub struct UsedRing {
 
 /// VirtIO 虚拟队列
 ///
-/// 使用 Modern VirtIO (v1.0+) 布局
+/// 默认使用分离式布局 (split virtqueue)；new_packed 创建的队列使用紧凑布局，
+/// 两者共用 add_buf / get_buf / kick / enable_cb 接口。
+/// alloc_desc / submit / wait_for_completion 只适用于分离式布局
 pub struct VirtQueue {
     /// 队列大小
     pub queue_size: u16,
@@ -78,6 +133,24 @@ pub struct VirtQueue {
     vring_addr: u64,
     /// 下一个要分配的描述符索引
     next_desc: AtomicU16,
+    /// 空闲描述符链表头，经 desc.next 串起 (free_head)
+    free_head: u16,
+    /// 空闲描述符数 (num_free)
+    num_free: u16,
+    /// 驱动已处理到的 used.idx (last_used_idx)
+    last_used_idx: u16,
+    /// 每个链头描述符对应的请求 (desc_state[].data)
+    desc_state: Vec<usize>,
+    /// 间接描述符表，按占用的环上描述符索引；协商了 VIRTIO_RING_F_INDIRECT_DESC 时分配
+    indirect: Option<DmaPool<[Desc; VIRTQ_MAX_INDIRECT]>>,
+    /// 协商了 VIRTIO_RING_F_EVENT_IDX
+    event_idx: bool,
+    /// 上次通知以来放入可用环的链数 (num_added)
+    num_added: u16,
+    /// 可用环标志的本地副本，避免读回共享内存 (avail_flags_shadow)
+    avail_flags_shadow: u16,
+    /// 紧凑布局；Some 时上面的分离式环不使用
+    packed: Option<PackedRing>,
 }
 
 unsafe impl Send for VirtQueue {}
@@ -107,7 +180,7 @@ impl VirtQueue {
         let total_size = desc_size_aligned + avail_size_aligned + used_size_aligned;
 
         let layout = alloc::alloc::Layout::from_size_align(total_size, PAGE_SIZE).ok()?;
-        let mem_ptr = unsafe { alloc::alloc::alloc(layout) as *mut u8 };
+        let mem_ptr = unsafe { alloc::alloc::alloc_zeroed(layout) as *mut u8 };
         if mem_ptr.is_null() {
             return None;
         }
@@ -132,7 +205,7 @@ impl VirtQueue {
 
         for i in 0..queue_size {
             unsafe {
-                *desc.add(i as usize) = Desc { addr: 0, len: 0, flags: 0, next: 0 };
+                *desc.add(i as usize) = Desc { addr: 0, len: 0, flags: 0, next: i + 1 };
             }
         }
 
@@ -147,9 +220,84 @@ impl VirtQueue {
             used,
             vring_addr: mem_ptr as u64,
             next_desc: AtomicU16::new(0),
+            free_head: 0,
+            num_free: queue_size,
+            last_used_idx: 0,
+            desc_state: alloc::vec![0; queue_size as usize],
+            indirect: None,
+            event_idx: false,
+            num_added: 0,
+            avail_flags_shadow: 0,
+            packed: None,
         })
     }
 
+    /// 创建紧凑布局的队列 (VIRTIO_F_RING_PACKED)
+    ///
+    /// 描述符环、驱动事件区、设备事件区分别通过 get_desc_addr / get_avail_addr /
+    /// get_used_addr 取得，写入设备的 desc / driver / device 地址寄存器
+    pub fn new_packed(queue_size: u16, queue_index: u16, queue_notify: u64, interrupt_status: u64, interrupt_ack: u64) -> Option<Self> {
+        const PAGE_SIZE: usize = 4096;
+        let (ring_size, event_size) = PackedRing::ring_size(queue_size);
+        let ring_size_aligned = (ring_size + PAGE_SIZE - 1) & !(PAGE_SIZE - 1);
+        // 两个事件区放在描述符环之后的同一页
+        let total_size = ring_size_aligned + PAGE_SIZE;
+        let layout = alloc::alloc::Layout::from_size_align(total_size, PAGE_SIZE).ok()?;
+        let mem_ptr = unsafe { alloc::alloc::alloc_zeroed(layout) };
+        if mem_ptr.is_null() {
+            return None;
+        }
+        let desc = mem_ptr as *mut PackedDesc;
+        let driver_event = (mem_ptr as usize + ring_size_aligned) as *mut PackedEvent;
+        let device_event = (mem_ptr as usize + ring_size_aligned + event_size.max(8)) as *mut PackedEvent;
+        let ring = unsafe { PackedRing::new(queue_size, desc, driver_event, device_event) };
+
+        Some(Self {
+            queue_size,
+            queue_index,
+            queue_notify,
+            interrupt_status,
+            interrupt_ack,
+            desc: desc as *mut Desc,
+            avail: driver_event as *mut AvailRing,
+            used: device_event as *mut UsedRing,
+            vring_addr: mem_ptr as u64,
+            next_desc: AtomicU16::new(queue_size),
+            free_head: 0,
+            num_free: 0,
+            last_used_idx: 0,
+            desc_state: Vec::new(),
+            indirect: None,
+            event_idx: false,
+            num_added: 0,
+            avail_flags_shadow: 0,
+            packed: Some(ring),
+        })
+    }
+
+    /// 是否为紧凑布局
+    pub fn is_packed(&self) -> bool {
+        self.packed.is_some()
+    }
+
+    /// 使用事件索引，设备已协商 VIRTIO_RING_F_EVENT_IDX 后调用
+    pub fn enable_event_idx(&mut self) {
+        self.event_idx = true;
+        if let Some(ring) = self.packed.as_mut() {
+            ring.set_event_idx(true);
+        }
+    }
+
+    /// 可用环之后的 used_event：驱动希望在已用环越过它时收到中断
+    fn used_event_ptr(&self) -> *mut u16 {
+        (self.avail as usize + 4 + self.queue_size as usize * 2) as *mut u16
+    }
+
+    /// 已用环之后的 avail_event：设备希望在可用环越过它时收到通知
+    fn avail_event_ptr(&self) -> *const u16 {
+        (self.used as usize + 4 + self.queue_size as usize * 8) as *const u16
+    }
+
     /// 获取当前可用索引
     pub fn get_avail(&self) -> u16 {
         unsafe { core::ptr::read_volatile(core::ptr::addr_of!((*self.avail).idx)) }
@@ -169,6 +317,88 @@ impl VirtQueue {
         }
     }
 
+    /// 是否需要通知设备 (virtqueue_kick_prepare)
+    ///
+    /// 事件索引模式下只有本批新放入的链越过设备给出的 avail_event 时才通知；
+    /// 否则看设备是否设置了 VRING_USED_F_NO_NOTIFY
+    pub fn kick_prepare(&mut self) -> bool {
+        if let Some(ring) = self.packed.as_mut() {
+            return ring.kick_prepare();
+        }
+        // 先发布 avail.idx 再读设备侧的抑制信息
+        core::sync::atomic::fence(Ordering::SeqCst);
+        let new = self.get_avail();
+        let old = new.wrapping_sub(self.num_added);
+        self.num_added = 0;
+        if self.event_idx {
+            let event = unsafe { core::ptr::read_volatile(self.avail_event_ptr()) };
+            need_event(event, new, old)
+        } else {
+            let flags = unsafe { core::ptr::read_volatile(core::ptr::addr_of!((*self.used).flags)) };
+            flags & VRING_USED_F_NO_NOTIFY == 0
+        }
+    }
+
+    /// 需要时通知设备 (virtqueue_kick)
+    ///
+    /// # 返回
+    /// 是否写了通知寄存器
+    pub fn kick(&mut self) -> bool {
+        let needed = self.kick_prepare();
+        if needed {
+            self.notify();
+        }
+        needed
+    }
+
+    /// 关闭完成中断，轮询期间使用 (virtqueue_disable_cb)
+    pub fn disable_cb(&mut self) {
+        if let Some(ring) = self.packed.as_mut() {
+            ring.disable_cb();
+            return;
+        }
+        if self.avail_flags_shadow & VRING_AVAIL_F_NO_INTERRUPT == 0 {
+            self.avail_flags_shadow |= VRING_AVAIL_F_NO_INTERRUPT;
+            if !self.event_idx {
+                unsafe { core::ptr::write_volatile(core::ptr::addr_of_mut!((*self.avail).flags), self.avail_flags_shadow) };
+            }
+        }
+        // 事件索引模式下设备忽略标志：used_event 留在已收割位置之前，环回绕前不会再触发
+        if self.event_idx {
+            unsafe { core::ptr::write_volatile(self.used_event_ptr(), self.last_used_idx.wrapping_sub(1)) };
+        }
+    }
+
+    /// 重新打开完成中断 (virtqueue_enable_cb)
+    ///
+    /// # 返回
+    /// 没有未收割的完成时返回 true；返回 false 时调用者应继续收割，否则可能丢失中断
+    pub fn enable_cb(&mut self) -> bool {
+        if let Some(ring) = self.packed.as_mut() {
+            return ring.enable_cb();
+        }
+        if self.avail_flags_shadow & VRING_AVAIL_F_NO_INTERRUPT != 0 {
+            self.avail_flags_shadow &= !VRING_AVAIL_F_NO_INTERRUPT;
+            if !self.event_idx {
+                unsafe { core::ptr::write_volatile(core::ptr::addr_of_mut!((*self.avail).flags), self.avail_flags_shadow) };
+            }
+        }
+        if self.event_idx {
+            unsafe { core::ptr::write_volatile(self.used_event_ptr(), self.last_used_idx) };
+        }
+        // 先公开 used_event 再检查已用环
+        core::sync::atomic::fence(Ordering::SeqCst);
+        self.last_used_idx == self.get_used()
+    }
+
+    /// 是否有未收割的完成
+    pub fn more_used(&self) -> bool {
+        match self.packed.as_ref() {
+            Some(ring) => ring.more_used(),
+            None => self.last_used_idx != self.get_used(),
+        }
+    }
+
     /// 等待设备完成请求
     pub fn wait_for_completion(&self, prev_used: u16) -> u16 {
         let mut timeout = 10_000_000;
@@ -263,6 +493,189 @@ impl VirtQueue {
         }
     }
 
+    /// 空闲描述符数
+    ///
+    /// 与 alloc_desc / reset_desc_allocator 的简单分配方式不能用在同一个队列上
+    pub fn num_free(&self) -> u16 {
+        match self.packed.as_ref() {
+            Some(ring) => ring.num_free(),
+            None => self.num_free,
+        }
+    }
+
+    /// 使用间接描述符，设备已协商 VIRTIO_RING_F_INDIRECT_DESC 后调用
+    ///
+    /// # 返回
+    /// 间接描述符表分配失败时返回 false，队列继续使用直接描述符链
+    pub fn enable_indirect(&mut self) -> bool {
+        if let Some(ring) = self.packed.as_mut() {
+            return ring.enable_indirect();
+        }
+        let empty = [Desc { addr: 0, len: 0, flags: 0, next: 0 }; VIRTQ_MAX_INDIRECT];
+        self.indirect = DmaPool::new(self.queue_size as usize, empty);
+        self.indirect.is_some()
+    }
+
+    /// 一次请求最多的段数
+    pub fn max_segments(&self) -> usize {
+        if self.indirect.is_some() || self.packed.as_ref().map_or(false, |ring| ring.has_indirect()) {
+            VIRTQ_MAX_INDIRECT
+        } else {
+            self.queue_size as usize
+        }
+    }
+
+    /// 把一组缓冲区作为描述符链放入可用环，不通知设备 (virtqueue_add_sgs)
+    ///
+    /// 多于一段且不超过 VIRTQ_MAX_INDIRECT 段时使用间接描述符表，只占环上一个描述符
+    ///
+    /// # 参数
+    /// - `bufs`: (物理地址, 长度, 是否设备写入)，设备按顺序访问
+    /// - `token`: 完成时由 get_buf 返回
+    ///
+    /// # 返回
+    /// 链头描述符；空闲描述符不足时返回 None
+    pub fn add_buf(&mut self, bufs: &[(u64, u32, bool)], token: usize) -> Option<u16> {
+        if let Some(ring) = self.packed.as_mut() {
+            return ring.add_buf(bufs, token);
+        }
+        if bufs.is_empty() {
+            return None;
+        }
+        if let Some(table) = self.indirect.as_ref() {
+            if bufs.len() > 1 && bufs.len() <= VIRTQ_MAX_INDIRECT && self.num_free > 0 {
+                let head = self.free_head;
+                let next = unsafe { (*self.desc.add(head as usize)).next };
+                let entries = table.as_mut_ptr(head as usize) as *mut Desc;
+                for (i, &(addr, len, write)) in bufs.iter().enumerate() {
+                    let mut flags = if write { VIRTQ_DESC_F_WRITE } else { 0 };
+                    if i + 1 < bufs.len() {
+                        flags |= VIRTQ_DESC_F_NEXT;
+                    }
+                    unsafe {
+                        core::ptr::write_volatile(entries.add(i), Desc { addr, len, flags, next: i as u16 + 1 });
+                    }
+                }
+                let table_len = (bufs.len() * core::mem::size_of::<Desc>()) as u32;
+                unsafe {
+                    *self.desc.add(head as usize) = Desc {
+                        addr: table.phys(head as usize),
+                        len: table_len,
+                        flags: VIRTQ_DESC_F_INDIRECT,
+                        next,
+                    };
+                }
+                self.free_head = next;
+                self.num_free -= 1;
+                self.desc_state[head as usize] = token;
+                self.push_avail(head);
+                return Some(head);
+            }
+        }
+        if bufs.len() > self.num_free as usize {
+            return None;
+        }
+        let head = self.free_head;
+        let mut idx = head;
+        for (i, &(addr, len, write)) in bufs.iter().enumerate() {
+            let next = unsafe { (*self.desc.add(idx as usize)).next };
+            let mut flags = if write { VIRTQ_DESC_F_WRITE } else { 0 };
+            if i + 1 < bufs.len() {
+                flags |= VIRTQ_DESC_F_NEXT;
+            }
+            unsafe {
+                *self.desc.add(idx as usize) = Desc { addr, len, flags, next };
+            }
+            if i + 1 < bufs.len() {
+                idx = next;
+            } else {
+                self.free_head = next;
+            }
+        }
+        self.num_free -= bufs.len() as u16;
+        self.desc_state[head as usize] = token;
+        self.push_avail(head);
+        Some(head)
+    }
+
+    /// 链头放入可用环
+    fn push_avail(&mut self, head: u16) {
+        unsafe {
+            let idx = core::ptr::read_volatile(core::ptr::addr_of!((*self.avail).idx));
+            let ring_ptr = (self.avail as usize + 4) as *mut u16;
+            core::ptr::write_volatile(ring_ptr.add(idx as usize % self.queue_size as usize), head);
+            // 描述符和环项先于 idx 对设备可见
+            core::sync::atomic::fence(Ordering::Release);
+            core::ptr::write_volatile(core::ptr::addr_of_mut!((*self.avail).idx), idx.wrapping_add(1));
+        }
+        self.num_added = self.num_added.wrapping_add(1);
+    }
+
+    /// 下一次 add_buf 使用的链头描述符
+    ///
+    /// 持有队列期间有效，用于按描述符索引的预分配请求头
+    pub fn next_head(&self) -> Option<u16> {
+        if let Some(ring) = self.packed.as_ref() {
+            return ring.next_id();
+        }
+        if self.num_free == 0 { None } else { Some(self.free_head) }
+    }
+
+    /// 取出一个已完成的请求并归还其描述符链 (virtqueue_get_buf)
+    ///
+    /// # 返回
+    /// add_buf 时的 token 和设备写入的字节数
+    pub fn get_buf(&mut self) -> Option<(usize, u32)> {
+        if let Some(ring) = self.packed.as_mut() {
+            return ring.get_buf();
+        }
+        if self.last_used_idx == self.get_used() {
+            return None;
+        }
+        // 先读 idx 再读环项
+        core::sync::atomic::fence(Ordering::Acquire);
+        let elem = unsafe {
+            let ring_ptr = (self.used as usize + 4) as *const UsedElem;
+            core::ptr::read_volatile(ring_ptr.add(self.last_used_idx as usize % self.queue_size as usize))
+        };
+        self.last_used_idx = self.last_used_idx.wrapping_add(1);
+
+        // 整条链放回空闲链表 (detach_buf)
+        let head = elem.id as u16;
+        let mut idx = head;
+        let mut nr = 1;
+        loop {
+            let desc = unsafe { &mut *self.desc.add(idx as usize) };
+            if desc.flags & VIRTQ_DESC_F_NEXT == 0 {
+                desc.next = self.free_head;
+                break;
+            }
+            idx = desc.next;
+            nr += 1;
+        }
+        self.free_head = head;
+        self.num_free += nr;
+        // 中断开启时 used_event 跟着收割位置推进 (virtqueue_get_buf_ctx_split)
+        if self.event_idx && self.avail_flags_shadow & VRING_AVAIL_F_NO_INTERRUPT == 0 {
+            unsafe { core::ptr::write_volatile(self.used_event_ptr(), self.last_used_idx) };
+        }
+        Some((self.desc_state[head as usize], elem.len))
+    }
+
+    /// 读取并应答中断状态 (vm_interrupt)
+    ///
+    /// # 返回
+    /// 中断状态：bit 0 为已用环更新，bit 1 为配置变化
+    pub fn ack_interrupt(&self) -> u32 {
+        unsafe {
+            let status = core::ptr::read_volatile(self.interrupt_status as *const u32);
+            if status != 0 {
+                core::ptr::write_volatile(self.interrupt_ack as *mut u32, status);
+            }
+            status
+        }
+    }
+
     /// 获取描述符表地址
     pub fn get_desc_addr(&self) -> u64 {
         self.desc as u64
@@ -289,6 +702,76 @@ impl VirtQueue {
     }
 }
 
+/// 与设备共享的小对象池 (请求头、状态字节等)
+///
+/// 一次分配按页对齐的连续内存，物理地址在创建时转换一次，
+/// 之后第 i 个元素的物理地址是 phys_base + i * size_of::<T>()，提交请求时不再查页表
+pub struct DmaPool<T: Copy> {
+    virt: *mut T,
+    phys: u64,
+    len: usize,
+    layout: alloc::alloc::Layout,
+}
+
+unsafe impl<T: Copy> Send for DmaPool<T> {}
+unsafe impl<T: Copy> Sync for DmaPool<T> {}
+
+impl<T: Copy> DmaPool<T> {
+    /// 分配 len 个元素并用 init 填充 (dma_alloc_coherent)
+    pub fn new(len: usize, init: T) -> Option<Self> {
+        const PAGE_SIZE: usize = 4096;
+        let size = (len * core::mem::size_of::<T>()).max(1);
+        let layout = alloc::alloc::Layout::from_size_align(size, PAGE_SIZE).ok()?;
+        // 内核堆是恒等映射的连续物理内存，按页对齐的一次分配物理上连续
+        let virt = unsafe { alloc::alloc::alloc(layout) as *mut T };
+        if virt.is_null() {
+            return None;
+        }
+        for i in 0..len {
+            unsafe { virt.add(i).write(init) };
+        }
+        #[cfg(feature = "riscv64")]
+        let phys = crate::arch::riscv64::mm::virt_to_phys(crate::arch::riscv64::mm::VirtAddr::new(virt as u64)).0;
+        #[cfg(not(feature = "riscv64"))]
+        let phys = virt as u64;
+        Some(Self { virt, phys, len, layout })
+    }
+
+    /// 第 i 个元素的物理地址
+    #[inline]
+    pub fn phys(&self, i: usize) -> u64 {
+        debug_assert!(i < self.len);
+        self.phys + (i * core::mem::size_of::<T>()) as u64
+    }
+
+    /// 写入第 i 个元素
+    #[inline]
+    pub fn write(&self, i: usize, val: T) {
+        debug_assert!(i < self.len);
+        unsafe { core::ptr::write_volatile(self.virt.add(i), val) };
+    }
+
+    /// 第 i 个元素的内核地址，用于就地填写较大的元素
+    #[inline]
+    pub fn as_mut_ptr(&self, i: usize) -> *mut T {
+        debug_assert!(i < self.len);
+        unsafe { self.virt.add(i) }
+    }
+
+    /// 读取第 i 个元素（设备写入后）
+    #[inline]
+    pub fn read(&self, i: usize) -> T {
+        debug_assert!(i < self.len);
+        unsafe { core::ptr::read_volatile(self.virt.add(i)) }
+    }
+}
+
+impl<T: Copy> Drop for DmaPool<T> {
+    fn drop(&mut self) {
+        unsafe { alloc::alloc::dealloc(self.virt as *mut u8, self.layout) };
+    }
+}
+
 #[repr(C)]
 #[derive(Debug, Clone, Copy)]
 pub struct VirtIOBlkReqHeader {
@@ -300,6 +783,21 @@ pub struct VirtIOBlkReqHeader {
     pub sector: u64,
 }
 
+/// Discard / Write Zeroes 请求的数据段 (struct virtio_blk_discard_write_zeroes)
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct VirtIOBlkDiscardWriteZeroes {
+    /// 起始扇区
+    pub sector: u64,
+    /// 扇区数
+    pub num_sectors: u32,
+    /// VIRTIO_BLK_WRITE_ZEROES_FLAG_*
+    pub flags: u32,
+}
+
+/// Write Zeroes 时允许设备释放扇区
+pub const VIRTIO_BLK_WRITE_ZEROES_FLAG_UNMAP: u32 = 1;
+
 #[repr(C)]
 #[derive(Debug, Clone, Copy)]
 pub struct VirtIOBlkResp {
@@ -322,6 +820,8 @@ pub mod req_type {
     pub const VIRTIO_BLK_T_IN: u32 = 0;
     pub const VIRTIO_BLK_T_OUT: u32 = 1;
     pub const VIRTIO_BLK_T_FLUSH: u32 = 4;
+    pub const VIRTIO_BLK_T_DISCARD: u32 = 11;
+    pub const VIRTIO_BLK_T_WRITE_ZEROES: u32 = 13;
 }
 
 pub mod status {
@@ -5,8 +5,13 @@
 //! VirtIO PCI 传输层
 //!
 //! 实现 VirtIO 设备的 PCI 传输（Modern VirtIO 1.0+）
+//!
+//! 中断优先使用 MSI-X：配置变更占 0 号向量，队列 N 占 N+1 号向量，每个向量
+//! 分配独立的 IMSIC 中断号，不用再读 ISR 区分队列；没有 IMSIC 或设备不支持
+//! MSI-X 时退回共享的 INTx (vp_find_vqs_msix → vp_find_vqs_intx)
 
 use crate::drivers::pci::{PCIConfig, vendor, virtio_device, BARType};
+use crate::drivers::pci::msi::{MsixCapability, MsixTable};
 use crate::drivers::virtio::queue;
 use crate::drivers::virtio::offset;
 use alloc::collections::btree_map::BTreeMap;
@@ -86,8 +91,17 @@ pub struct VirtIOPCI {
     pub isr_cfg_offset: u32,
     /// 设备基地址
     pub base_addr: u64,
+    /// MSI-X capability
+    pub msix: Option<MsixCapability>,
+    /// 映射后的 MSI-X 向量表
+    pub msix_table: Option<MsixTable>,
+    /// 每个 MSI-X 向量分配到的 IMSIC 中断号，空表示使用 INTx
+    pub msix_vectors: Vec<usize>,
 }
 
+/// 不使用 MSI-X 向量 (VIRTIO_MSI_NO_VECTOR)
+pub const VIRTIO_MSI_NO_VECTOR: u16 = 0xFFFF;
+
 impl VirtIOPCI {
     /// 查找 VirtIO PCI capability
     ///
@@ -220,6 +234,9 @@ impl VirtIOPCI {
             isr_cfg_bar: 0,
             isr_cfg_offset: 0,
             base_addr: 0,
+            msix: None,
+            msix_table: None,
+            msix_vectors: Vec::new(),
         };
 
         // ========== 扫描 VirtIO PCI capabilities ==========
@@ -285,6 +302,16 @@ impl VirtIOPCI {
             bars_to_assign.push(device_bar);
         }
 
+        // MSI-X 向量表与 PBA 可能在单独的 BAR 中
+        let msix = MsixCapability::parse(&pci_config);
+        if let Some(cap) = msix {
+            for bir in [cap.table_bir, cap.pba_bir] {
+                if !bars_to_assign.contains(&bir) {
+                    bars_to_assign.push(bir);
+                }
+            }
+        }
+
         // 存储分配后的 BAR 信息
         let mut assigned_bars = alloc::collections::btree_map::BTreeMap::new();
 
@@ -359,6 +386,11 @@ impl VirtIOPCI {
             None => 0,
         };
 
+        let msix_table = msix.and_then(|cap| match assigned_bars.get(&cap.table_bir) {
+            Some(bar_obj) if bar_obj.bar_type == BARType::MemoryMapped => Some(MsixTable::new(&cap, bar_obj.base_addr)),
+            _ => None,
+        });
+
         Ok(Self {
             pci_config,
             pci_slot,
@@ -374,6 +406,9 @@ impl VirtIOPCI {
             isr_cfg_bar: isr_cfg_bar + isr_offset as u64,
             isr_cfg_offset: isr_offset,
             base_addr: common_cfg_bar + common_offset as u64,  // 使用 Common CFG 作为主要访问地址
+            msix,
+            msix_table,
+            msix_vectors: Vec::new(),
         })
     }
 
@@ -506,6 +541,11 @@ impl VirtIOPCI {
             core::ptr::write_volatile(device_hi_ptr, (used_phys >> 32) as u32);
         }
 
+        // 使用 MSI-X 时必须在使能队列之前绑定向量
+        if !self.msix_vectors.is_empty() {
+            self.set_queue_vector(queue_index, queue_index + 1)?;
+        }
+
         // 使能队列
         unsafe {
             let queue_enable_ptr = (self.common_cfg_bar + offset::COMMON_CFG_QUEUE_ENABLE as u64) as *mut u16;
@@ -541,6 +581,11 @@ impl VirtIOPCI {
     /// 公式: IRQ = 32 + ((INT_PIN + PCI_slot) % 4)
     /// 参考: create_pcie_irq_map() 中的 irq_nr = PCIE_IRQ + ((pin + PCI_SLOT(devfn)) % PCI_NUM_PINS)
     pub fn enable_device_interrupt(&self) {
+        // 已经使用 MSI-X，INTx 在使能 MSI-X 时已关闭
+        if !self.msix_vectors.is_empty() {
+            return;
+        }
+
         // 读取 INT_PIN 来确定 IRQ 偏移
         let int_pin = self.pci_config.read_config_byte(0x3D);
 
@@ -548,29 +593,149 @@ impl VirtIOPCI {
         // 注意：INT_PIN 从 1 开始（INTA=1, INTB=2, INTC=3, INTD=4）
         let irq = 32 + ((int_pin as u32 + self.pci_slot as u32) % 4);
 
-        // 使能 IRQ（在当前 boot hart 上）
+        // 注册中断，按亲和性在 PLIC 中使能
         #[cfg(feature = "riscv64")]
         {
-            let boot_hart = crate::arch::riscv64::smp::cpu_id();
-            crate::drivers::intc::plic::enable_interrupt(boot_hart, irq as usize);
+            // 多个设备可能共用同一条 INTx 线，已注册时沿用原来的处理函数
+            let _ = crate::irq::request_irq(irq as usize, crate::drivers::virtio::interrupt_handler_pci, "virtio-pci");
         }
     }
 
-    /// 设置队列 MSI-X 向量
+    /// 设置队列 MSI-X 向量 (vp_modern_queue_vector)
     ///
     /// VirtIO 1.0 规范要求在 queue_enable 之前设置 MSI-X 向量
     /// 这告诉设备使用哪个 MSI-X 向量来发送队列完成中断
     ///
     /// # 参数
     /// - `queue_index`: 队列索引（0 为第一个队列）
-    /// - `vector`: MSI-X 向量号（0 表示不使用 MSI-X，使用传统 INTx）
-    pub fn set_queue_vector(&self, queue_index: u16, vector: u16) {
-        // VirtIO Common CFG 偏移 0x1C: queue_msix_vector
+    /// - `vector`: MSI-X 表项号，VIRTIO_MSI_NO_VECTOR 表示不为该队列发中断
+    ///
+    /// # 返回
+    /// 设备读回 VIRTIO_MSI_NO_VECTOR（无法分配该向量）时返回 Err
+    pub fn set_queue_vector(&self, queue_index: u16, vector: u16) -> Result<(), &'static str> {
+        unsafe {
+            let queue_select_ptr = (self.common_cfg_bar + offset::COMMON_CFG_QUEUE_SELECT as u64) as *mut u16;
+            core::ptr::write_volatile(queue_select_ptr, queue_index);
+            let vector_ptr = (self.common_cfg_bar + offset::COMMON_CFG_QUEUE_MSIX_VECTOR as u64) as *mut u16;
+            core::ptr::write_volatile(vector_ptr, vector);
+            if vector != VIRTIO_MSI_NO_VECTOR && core::ptr::read_volatile(vector_ptr) == VIRTIO_MSI_NO_VECTOR {
+                return Err("Device rejected queue MSI-X vector");
+            }
+        }
+        Ok(())
+    }
+
+    /// 设置配置变更中断的 MSI-X 向量 (vp_modern_config_vector)
+    pub fn set_config_vector(&self, vector: u16) -> Result<(), &'static str> {
         unsafe {
-            let vector_ptr = (self.common_cfg_bar + 0x1C) as *mut u16;
+            let vector_ptr = (self.common_cfg_bar + offset::CONFIG_MSIX_VECTOR as u64) as *mut u16;
             core::ptr::write_volatile(vector_ptr, vector);
+            if vector != VIRTIO_MSI_NO_VECTOR && core::ptr::read_volatile(vector_ptr) == VIRTIO_MSI_NO_VECTOR {
+                return Err("Device rejected config MSI-X vector");
+            }
+        }
+        Ok(())
+    }
+
+    /// 为配置变更和每个队列分配 MSI-X 向量 (vp_request_msix_vectors)
+    ///
+    /// 需要在 FEATURES_OK 之后、setup_queue 之前调用；之后 setup_queue 会把队列 N
+    /// 绑定到 N+1 号向量。失败时不留下任何状态，调用方继续使用 INTx。
+    ///
+    /// # 参数
+    /// - `nr_queues`: 队列数
+    /// - `handler`: 中断处理函数，参数为 IMSIC 中断号，可用 queue_msi 反查队列
+    /// - `name`: 设备名
+    pub fn setup_msix(&mut self, nr_queues: u16, handler: crate::irq::IrqHandler, name: &'static str) -> Result<(), &'static str> {
+        #[cfg(feature = "riscv64")]
+        {
+            use crate::drivers::intc::imsic;
+
+            if !imsic::is_enabled() {
+                return Err("IMSIC not available");
+            }
+            let (cap, table) = match (self.msix, self.msix_table) {
+                (Some(cap), Some(table)) => (cap, table),
+                _ => return Err("Device has no MSI-X capability"),
+            };
+            let nr_vectors = nr_queues + 1;
+            if table.nr_entries() < nr_vectors {
+                return Err("Not enough MSI-X table entries");
+            }
+
+            let hart = crate::arch::cpu_id();
+            cap.enable_masked(&self.pci_config);
+            let mut ids = Vec::with_capacity(nr_vectors as usize);
+            let mut result = Ok(());
+            for entry in 0..nr_vectors {
+                let id = match imsic::msi_alloc(handler, None, name) {
+                    Ok(id) => id,
+                    Err(_) => {
+                        result = Err("Out of MSI vectors");
+                        break;
+                    }
+                };
+                ids.push(id);
+                let msg = match imsic::msi_compose_msg(id, hart) {
+                    Some(msg) => msg,
+                    None => {
+                        result = Err("Hart has no IMSIC interrupt file");
+                        break;
+                    }
+                };
+                if let Err(e) = table.write_msg(entry, &msg) {
+                    result = Err(e);
+                    break;
+                }
+                table.unmask(entry);
+            }
+            cap.unmask_all(&self.pci_config);
+            if result.is_ok() {
+                result = self.set_config_vector(0);
+            }
+            self.msix_vectors = ids;
+            if result.is_err() {
+                self.free_msix();
+            }
+            result
+        }
+
+        #[cfg(not(feature = "riscv64"))]
+        {
+            let _ = (nr_queues, handler, name);
+            Err("IMSIC not available")
+        }
+    }
+
+    /// 释放 MSI-X 向量并恢复 INTx (vp_del_vqs)
+    pub fn free_msix(&mut self) {
+        if self.msix_vectors.is_empty() {
+            return;
+        }
+        let _ = self.set_config_vector(VIRTIO_MSI_NO_VECTOR);
+        if let Some(table) = self.msix_table {
+            for entry in 0..self.msix_vectors.len() as u16 {
+                table.mask(entry);
+            }
         }
-        let _ = queue_index; // 避免未使用警告
+        if let Some(cap) = self.msix {
+            cap.disable(&self.pci_config);
+        }
+        #[cfg(feature = "riscv64")]
+        for &id in &self.msix_vectors {
+            crate::drivers::intc::imsic::msi_free(id);
+        }
+        self.msix_vectors.clear();
+    }
+
+    /// 队列对应的 IMSIC 中断号，使用 INTx 时返回 None
+    pub fn queue_msi(&self, queue_index: u16) -> Option<usize> {
+        self.msix_vectors.get(queue_index as usize + 1).copied()
+    }
+
+    /// IMSIC 中断号对应的队列，配置变更向量或不属于本设备时返回 None
+    pub fn msi_queue(&self, id: usize) -> Option<u16> {
+        self.msix_vectors.iter().skip(1).position(|&v| v == id).map(|q| q as u16)
     }
 
     /// 从块设备读取数据
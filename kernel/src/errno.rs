@@ -121,8 +121,17 @@ pub enum Errno {
     /// Function not implemented (ENOSYS, 38)
     FunctionNotImplemented = 38,
 
+    /// Not a data message (EBADMSG, 74)，文件系统校验和错误 (EFSBADCRC)
+    BadMessage = 74,
+
     /// Value too large (EOVERFLOW, 75)
     ValueTooLarge = 75,
+
+    /// Operation not supported (EOPNOTSUPP, 95)
+    OperationNotSupported = 95,
+
+    /// Operation canceled (ECANCELED, 125)
+    OperationCanceled = 125,
 }
 
 impl Errno {
@@ -188,7 +197,9 @@ pub mod constants {
     pub const ELOOP: i32 = 40;
     pub const EWOULDBLOCK: i32 = 11;
     pub const ENOMSG: i32 = 42;
+    pub const EBADMSG: i32 = 74;
     pub const EOVERFLOW: i32 = 75;
+    pub const EOPNOTSUPP: i32 = 95;
 }
 
 #[cfg(test)]
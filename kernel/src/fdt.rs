@@ -0,0 +1,439 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 扁平设备树 (Flattened Device Tree) 早期扫描
+//!
+//! 参考 Linux: drivers/of/fdt.c (early_init_dt_scan_memory)
+//!
+//! 只在启动早期使用，不分配内存：
+//! - 读取根节点的 #address-cells / #size-cells
+//! - 收集 device_type = "memory" 节点（或 memory@ 节点）的 reg 区间
+//! - 读取 /chosen 中引导程序传递的 initrd 区间
+
+/// FDT 魔数
+const FDT_MAGIC: u32 = 0xd00dfeed;
+
+const FDT_BEGIN_NODE: u32 = 0x1;
+const FDT_END_NODE: u32 = 0x2;
+const FDT_PROP: u32 = 0x3;
+const FDT_NOP: u32 = 0x4;
+const FDT_END: u32 = 0x9;
+
+/// 最多记录的内存区间数
+pub const MAX_MEM_REGIONS: usize = 8;
+
+/// 物理内存区间
+#[derive(Debug, Clone, Copy, Default)]
+pub struct MemRegion {
+    /// 起始物理地址
+    pub base: u64,
+    /// 大小（字节）
+    pub size: u64,
+}
+
+/// 设备树中的物理内存布局
+#[derive(Debug, Clone, Copy, Default)]
+pub struct MemLayout {
+    pub regions: [MemRegion; MAX_MEM_REGIONS],
+    pub count: usize,
+}
+
+impl MemLayout {
+    /// 有效的内存区间
+    pub fn regions(&self) -> &[MemRegion] {
+        &self.regions[..self.count]
+    }
+
+    /// 内存总大小
+    pub fn total_size(&self) -> u64 {
+        self.regions().iter().map(|r| r.size).sum()
+    }
+
+    fn push(&mut self, base: u64, size: u64) {
+        if size != 0 && self.count < MAX_MEM_REGIONS {
+            self.regions[self.count] = MemRegion { base, size };
+            self.count += 1;
+        }
+    }
+}
+
+#[inline]
+unsafe fn read_be32(p: *const u8) -> u32 {
+    u32::from_be_bytes([*p, *p.add(1), *p.add(2), *p.add(3)])
+}
+
+/// 读取 cells 个 32 位单元组成的大端数
+#[inline]
+unsafe fn read_cells(p: *const u8, cells: u32) -> u64 {
+    let mut value = 0u64;
+    for i in 0..cells as usize {
+        value = (value << 32) | read_be32(p.add(i * 4)) as u64;
+    }
+    value
+}
+
+/// 读取以 NUL 结尾的字符串
+unsafe fn read_cstr<'a>(p: *const u8) -> &'a [u8] {
+    let mut len = 0;
+    while *p.add(len) != 0 {
+        len += 1;
+    }
+    core::slice::from_raw_parts(p, len)
+}
+
+#[inline]
+fn align4(off: usize) -> usize {
+    (off + 3) & !3
+}
+
+/// 扫描设备树中的物理内存节点 (early_init_dt_scan_memory)
+///
+/// # 参数
+/// - `dtb_ptr`: 设备树扁平数据指针
+///
+/// # 返回
+/// 设备树无效或没有内存节点时返回 None
+pub unsafe fn scan_memory(dtb_ptr: u64) -> Option<MemLayout> {
+    if dtb_ptr == 0 {
+        return None;
+    }
+    let fdt = dtb_ptr as *const u8;
+    if read_be32(fdt) != FDT_MAGIC {
+        return None;
+    }
+
+    let off_dt_struct = read_be32(fdt.add(0x08)) as usize;
+    let off_dt_strings = read_be32(fdt.add(0x0C)) as usize;
+    let size_dt_struct = read_be32(fdt.add(0x24)) as usize;
+    let strings = fdt.add(off_dt_strings);
+
+    // 根节点的默认值（Devicetree 规范）
+    let mut addr_cells = 2u32;
+    let mut size_cells = 1u32;
+
+    let mut layout = MemLayout::default();
+    let mut depth = 0usize;
+    // 当前 depth 2 节点是否为内存节点
+    let mut memory_name = false;
+    let mut memory_type = false;
+    // 内存节点的 reg 属性（等 device_type 确认后再解析）
+    let mut reg: Option<(*const u8, usize)> = None;
+
+    let mut off = off_dt_struct;
+    let end = off_dt_struct + size_dt_struct;
+
+    while off < end {
+        let token = read_be32(fdt.add(off));
+        off += 4;
+
+        match token {
+            FDT_BEGIN_NODE => {
+                let name = read_cstr(fdt.add(off));
+                off = align4(off + name.len() + 1);
+                depth += 1;
+                if depth == 2 {
+                    memory_name = name == b"memory" || name.starts_with(b"memory@");
+                    memory_type = false;
+                    reg = None;
+                }
+            }
+            FDT_END_NODE => {
+                if depth == 2 && (memory_type || memory_name) {
+                    if let Some((p, len)) = reg {
+                        let entry = ((addr_cells + size_cells) * 4) as usize;
+                        let mut i = 0;
+                        while entry > 0 && i + entry <= len {
+                            let base = read_cells(p.add(i), addr_cells);
+                            let size = read_cells(p.add(i + addr_cells as usize * 4), size_cells);
+                            layout.push(base, size);
+                            i += entry;
+                        }
+                    }
+                }
+                if depth == 0 {
+                    break;
+                }
+                depth -= 1;
+            }
+            FDT_PROP => {
+                let len = read_be32(fdt.add(off)) as usize;
+                let nameoff = read_be32(fdt.add(off + 4)) as usize;
+                let value = fdt.add(off + 8);
+                let name = read_cstr(strings.add(nameoff));
+                off = align4(off + 8 + len);
+
+                if depth == 1 && len == 4 {
+                    if name == b"#address-cells" {
+                        addr_cells = read_be32(value);
+                    } else if name == b"#size-cells" {
+                        size_cells = read_be32(value);
+                    }
+                } else if depth == 2 {
+                    if name == b"device_type" {
+                        memory_type = read_cstr(value) == b"memory";
+                    } else if name == b"reg" {
+                        reg = Some((value, len));
+                    }
+                }
+            }
+            FDT_NOP => {}
+            FDT_END => break,
+            _ => return None,
+        }
+    }
+
+    if layout.count == 0 {
+        None
+    } else {
+        Some(layout)
+    }
+}
+
+/// 读取第一个 CPU 节点的 riscv,isa 字符串 (riscv_fill_hwcap)
+///
+/// # 参数
+/// - `dtb_ptr`: 设备树扁平数据指针
+/// - `buf`: 存放 ISA 字符串（不含 NUL）
+///
+/// # 返回
+/// 字符串长度；设备树无效或没有 /cpus/cpu@N/riscv,isa 时返回 None
+pub unsafe fn scan_cpu_isa(dtb_ptr: u64, buf: &mut [u8]) -> Option<usize> {
+    let (value, _) = find_cpu_prop(dtb_ptr, b"riscv,isa")?;
+    let isa = read_cstr(value);
+    let n = core::cmp::min(isa.len(), buf.len());
+    buf[..n].copy_from_slice(&isa[..n]);
+    Some(n)
+}
+
+/// 读取第一个 CPU 节点的 32 位整数属性（如 riscv,cboz-block-size）
+///
+/// # 返回
+/// 属性值；设备树无效、没有该属性或长度不足 4 字节时返回 None
+pub unsafe fn scan_cpu_u32(dtb_ptr: u64, prop: &[u8]) -> Option<u32> {
+    match find_cpu_prop(dtb_ptr, prop)? {
+        (value, len) if len >= 4 => Some(read_be32(value)),
+        _ => None,
+    }
+}
+
+/// 查找第一个 CPU 节点 (/cpus/cpu@N) 的属性
+///
+/// # 返回
+/// 属性值的指针与长度
+unsafe fn find_cpu_prop(dtb_ptr: u64, prop: &[u8]) -> Option<(*const u8, usize)> {
+    if dtb_ptr == 0 {
+        return None;
+    }
+    let fdt = dtb_ptr as *const u8;
+    if read_be32(fdt) != FDT_MAGIC {
+        return None;
+    }
+
+    let off_dt_struct = read_be32(fdt.add(0x08)) as usize;
+    let off_dt_strings = read_be32(fdt.add(0x0C)) as usize;
+    let size_dt_struct = read_be32(fdt.add(0x24)) as usize;
+    let strings = fdt.add(off_dt_strings);
+
+    let mut depth = 0usize;
+    // 当前 depth 2 节点是否为 /cpus，depth 3 节点是否为 cpu@N
+    let mut in_cpus = false;
+    let mut in_cpu = false;
+
+    let mut off = off_dt_struct;
+    let end = off_dt_struct + size_dt_struct;
+
+    while off < end {
+        let token = read_be32(fdt.add(off));
+        off += 4;
+
+        match token {
+            FDT_BEGIN_NODE => {
+                let name = read_cstr(fdt.add(off));
+                off = align4(off + name.len() + 1);
+                depth += 1;
+                if depth == 2 {
+                    in_cpus = name == b"cpus";
+                } else if depth == 3 {
+                    in_cpu = in_cpus && (name == b"cpu" || name.starts_with(b"cpu@"));
+                }
+            }
+            FDT_END_NODE => {
+                if depth == 0 {
+                    break;
+                }
+                depth -= 1;
+            }
+            FDT_PROP => {
+                let len = read_be32(fdt.add(off)) as usize;
+                let nameoff = read_be32(fdt.add(off + 4)) as usize;
+                let value = fdt.add(off + 8);
+                let name = read_cstr(strings.add(nameoff));
+                off = align4(off + 8 + len);
+
+                if depth == 3 && in_cpu && name == prop {
+                    return Some((value, len));
+                }
+            }
+            FDT_NOP => {}
+            FDT_END => break,
+            _ => return None,
+        }
+    }
+
+    None
+}
+
+/// 读取 /chosen 的 linux,initrd-start / linux,initrd-end (early_init_dt_check_for_initrd)
+///
+/// # 返回
+/// initrd 的物理地址区间 [start, end)；没有 initrd 时返回 None
+pub unsafe fn scan_initrd(dtb_ptr: u64) -> Option<(u64, u64)> {
+    if dtb_ptr == 0 {
+        return None;
+    }
+    let fdt = dtb_ptr as *const u8;
+    if read_be32(fdt) != FDT_MAGIC {
+        return None;
+    }
+
+    let off_dt_struct = read_be32(fdt.add(0x08)) as usize;
+    let off_dt_strings = read_be32(fdt.add(0x0C)) as usize;
+    let size_dt_struct = read_be32(fdt.add(0x24)) as usize;
+    let strings = fdt.add(off_dt_strings);
+
+    let mut depth = 0usize;
+    let mut in_chosen = false;
+    let mut start = None;
+    let mut end = None;
+
+    let mut off = off_dt_struct;
+    let limit = off_dt_struct + size_dt_struct;
+
+    while off < limit {
+        let token = read_be32(fdt.add(off));
+        off += 4;
+
+        match token {
+            FDT_BEGIN_NODE => {
+                let name = read_cstr(fdt.add(off));
+                off = align4(off + name.len() + 1);
+                depth += 1;
+                if depth == 2 {
+                    in_chosen = name == b"chosen" || name.starts_with(b"chosen@");
+                }
+            }
+            FDT_END_NODE => {
+                if depth == 0 {
+                    break;
+                }
+                depth -= 1;
+            }
+            FDT_PROP => {
+                let len = read_be32(fdt.add(off)) as usize;
+                let nameoff = read_be32(fdt.add(off + 4)) as usize;
+                let value = fdt.add(off + 8);
+                let name = read_cstr(strings.add(nameoff));
+                off = align4(off + 8 + len);
+
+                // 属性可以是 1 个或 2 个 cell
+                if depth == 2 && in_chosen && (len == 4 || len == 8) {
+                    if name == b"linux,initrd-start" {
+                        start = Some(read_cells(value, len as u32 / 4));
+                    } else if name == b"linux,initrd-end" {
+                        end = Some(read_cells(value, len as u32 / 4));
+                    }
+                }
+            }
+            FDT_NOP => {}
+            FDT_END => break,
+            _ => return None,
+        }
+    }
+
+    match (start, end) {
+        (Some(start), Some(end)) if end > start => Some((start, end)),
+        _ => None,
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    /// 构造一个最小设备树：根节点 + memory@80000000 节点
+    fn build_dtb(buf: &mut [u32; 64]) -> usize {
+        // 字符串表: "#address-cells\0#size-cells\0device_type\0reg\0"
+        const STRINGS: &[u8] = b"#address-cells\0#size-cells\0device_type\0reg\0";
+        let mut words: [u32; 48] = [0; 48];
+        let mut n = 0;
+        let mut push = |w: u32, words: &mut [u32; 48]| {
+            words[n] = w;
+            n += 1;
+        };
+        push(FDT_BEGIN_NODE, &mut words);
+        push(0, &mut words); // 根节点名 ""
+        push(FDT_PROP, &mut words);
+        push(4, &mut words);
+        push(0, &mut words); // #address-cells
+        push(2, &mut words);
+        push(FDT_PROP, &mut words);
+        push(4, &mut words);
+        push(15, &mut words); // #size-cells
+        push(2, &mut words);
+        push(FDT_BEGIN_NODE, &mut words);
+        push(u32::from_be_bytes(*b"memo"), &mut words);
+        push(u32::from_be_bytes(*b"ry@8"), &mut words);
+        push(u32::from_be_bytes([b'0', 0, 0, 0]), &mut words);
+        push(FDT_PROP, &mut words);
+        push(7, &mut words);
+        push(27, &mut words); // device_type
+        push(u32::from_be_bytes(*b"memo"), &mut words);
+        push(u32::from_be_bytes([b'r', b'y', 0, 0]), &mut words);
+        push(FDT_PROP, &mut words);
+        push(16, &mut words);
+        push(39, &mut words); // reg
+        push(0, &mut words);
+        push(0x8000_0000, &mut words);
+        push(0, &mut words);
+        push(0x0800_0000, &mut words);
+        push(FDT_END_NODE, &mut words);
+        push(FDT_END_NODE, &mut words);
+        push(FDT_END, &mut words);
+
+        let off_struct = 40usize;
+        let size_struct = n * 4;
+        let off_strings = off_struct + size_struct;
+        let bytes = unsafe { core::slice::from_raw_parts_mut(buf.as_mut_ptr() as *mut u8, 256) };
+        bytes[0..4].copy_from_slice(&FDT_MAGIC.to_be_bytes());
+        bytes[8..12].copy_from_slice(&(off_struct as u32).to_be_bytes());
+        bytes[12..16].copy_from_slice(&(off_strings as u32).to_be_bytes());
+        bytes[0x24..0x28].copy_from_slice(&(size_struct as u32).to_be_bytes());
+        for i in 0..n {
+            bytes[off_struct + i * 4..off_struct + i * 4 + 4].copy_from_slice(&words[i].to_be_bytes());
+        }
+        bytes[off_strings..off_strings + STRINGS.len()].copy_from_slice(STRINGS);
+        off_strings + STRINGS.len()
+    }
+
+    #[test]
+    fn test_scan_memory() {
+        let mut buf = [0u32; 64];
+        let len = build_dtb(&mut buf);
+        assert!(len <= 256);
+
+        let layout = unsafe { scan_memory(buf.as_ptr() as u64) }.unwrap();
+        assert_eq!(layout.count, 1);
+        assert_eq!(layout.regions()[0].base, 0x8000_0000);
+        assert_eq!(layout.regions()[0].size, 0x0800_0000);
+        assert_eq!(layout.total_size(), 0x0800_0000);
+    }
+
+    #[test]
+    fn test_scan_memory_bad_magic() {
+        let buf = [0u32; 16];
+        assert!(unsafe { scan_memory(buf.as_ptr() as u64) }.is_none());
+        assert!(unsafe { scan_memory(0) }.is_none());
+    }
+}
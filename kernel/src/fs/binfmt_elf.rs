@@ -0,0 +1,372 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ELF 可执行文件的映射 (fs/binfmt_elf.c)
+//!
+//! exec 只经页缓存读取 ELF 头和程序头，PT_LOAD 段建立为私有文件映射：
+//! - 文件部分页对齐后映射文件的缓存页，缺页时由 filemap_fault 映射，写时复制
+//! - 段末页中 p_filesz 之后的字节清零 (padzero)
+//! - 超出文件部分的 BSS 是匿名映射，缺页时映射零页
+//!
+//! 文件偏移与虚拟地址页内偏移不一致的段无法直接映射缓存页，
+//! 退回到分配匿名页并从页缓存复制
+//!
+//! 带 PT_INTERP 的程序同时加载解释器（动态链接器），从解释器入口开始执行，
+//! 通过 auxv 的 AT_PHDR / AT_BASE / AT_ENTRY 告诉它主程序的位置。
+//! ET_DYN 映像加载到固定基址：主程序在 ELF_ET_DYN_BASE，解释器在 ELF_INTERP_BASE
+
+extern crate alloc;
+
+use alloc::string::String;
+use alloc::sync::Arc;
+use alloc::vec;
+use alloc::vec::Vec;
+use core::mem::size_of;
+
+use crate::arch::riscv64::mm::{self, user_addr, AddressSpace, FaultFlags, MmFaultResult, PageTableEntry};
+use crate::fs::elf::{Elf64Ehdr, Elf64Phdr, ElfPtType, ElfType, PF_W, PF_X};
+use crate::mm::filemap::{self, FileMapping};
+use crate::mm::page::{VirtAddr, PAGE_SIZE};
+use crate::mm::vma::{Vma, VmaFlags};
+
+const ENOENT: i32 = -2;
+const ENOEXEC: i32 = -8;
+const ENOMEM: i32 = -12;
+
+/// 程序头表的最大长度 (ELF_MIN_ALIGN)
+const MAX_PHDRS_SIZE: usize = PAGE_SIZE;
+
+/// 解释器路径的最大长度 (PATH_MAX)
+const PATH_MAX: usize = 4096;
+
+/// ET_DYN 主程序的加载基址 (ELF_ET_DYN_BASE)
+///
+/// 位于 USER_START 之上、brk 默认起点之下
+pub const ELF_ET_DYN_BASE: usize = 0x0040_0000;
+
+/// 解释器的加载基址
+///
+/// 位于 brk 区域（0x2000_0000 起最多 128MB）之上；0x4000_0000 起的 1GB
+/// 与内核共享 PCI MMIO 映射，不能使用。动态链接器之后用 mmap 加载的
+/// 共享库落在 mmap 区域 (MMAP_START)
+pub const ELF_INTERP_BASE: usize = 0x3000_0000;
+
+/// 解释器映像的最大跨度，更大的解释器返回 ENOEXEC
+pub const ELF_INTERP_MAX_SIZE: usize = 0x1000_0000;
+
+// 解释器窗口必须落在用户页表私有的最低 1GB 中，不能与复制来的内核及 MMIO 映射、
+// UART 页、brk 区域或 mmap 区域重叠
+const _: () = {
+    let end = ELF_INTERP_BASE + ELF_INTERP_MAX_SIZE;
+    assert!(end <= user_addr::USER_PRIVATE_END);
+    assert!(end <= user_addr::MMAP_START);
+    assert!(ELF_INTERP_BASE >= user_addr::BRK_START + user_addr::HEAP_MAX_SIZE);
+    assert!(ELF_INTERP_BASE >= user_addr::USER_UART_BASE + user_addr::USER_UART_SIZE);
+};
+
+/// 打开的 ELF 文件 (struct linux_binprm)
+pub struct ElfBinary {
+    /// ELF 头
+    pub ehdr: Elf64Ehdr,
+    /// 程序头
+    pub phdrs: Vec<Elf64Phdr>,
+    /// 文件的页缓存
+    pub mapping: Arc<FileMapping>,
+}
+
+/// 加载完成的映像，execve 据此设置 auxv 和入口 (create_elf_tables)
+#[derive(Debug, Clone, Copy, PartialEq)]
+pub struct ElfImage {
+    /// 开始执行的地址：有解释器时是解释器的入口
+    pub start: u64,
+    /// 主程序程序头表的用户地址 (AT_PHDR)
+    pub phdr: u64,
+    /// 程序头数量 (AT_PHNUM)
+    pub phnum: u64,
+    /// 解释器的加载基址，没有解释器时为 0 (AT_BASE)
+    pub base: u64,
+    /// 主程序的入口 (AT_ENTRY)
+    pub entry: u64,
+    /// 主程序映像结束地址（页对齐）
+    pub image_end: usize,
+}
+
+impl ElfBinary {
+    /// PT_LOAD 段
+    pub fn load_segments(&self) -> impl Iterator<Item = &Elf64Phdr> {
+        self.phdrs.iter().filter(|phdr| phdr.is_load())
+    }
+
+    /// 是否是位置无关的映像 (ET_DYN)
+    pub fn is_dyn(&self) -> bool {
+        self.ehdr.e_type == ElfType::ET_DYN as u16
+    }
+
+    /// 读出 PT_INTERP 给出的解释器路径
+    ///
+    /// # 返回
+    /// 没有 PT_INTERP 返回 Ok(None)；路径不以 NUL 结尾或过长返回 ENOEXEC
+    pub fn interp_path(&self) -> Result<Option<String>, i32> {
+        let phdr = match self.phdrs.iter().find(|p| p.p_type == ElfPtType::PT_INTERP as u32) {
+            Some(phdr) => phdr,
+            None => return Ok(None),
+        };
+        let size = phdr.p_filesz as usize;
+        if size < 2 || size > PATH_MAX {
+            return Err(ENOEXEC);
+        }
+        let mut buf = vec![0u8; size];
+        if self.mapping.read(phdr.p_offset as usize, &mut buf) != size || buf[size - 1] != 0 {
+            return Err(ENOEXEC);
+        }
+        buf.truncate(size - 1);
+        String::from_utf8(buf).map(Some).map_err(|_| ENOEXEC)
+    }
+
+    /// 程序头表在映像中的虚拟地址（未加 load_bias）
+    ///
+    /// 优先使用 PT_PHDR；否则找文件中包含程序头表的 PT_LOAD 段
+    pub fn phdr_vaddr(&self) -> Option<usize> {
+        if let Some(phdr) = self.phdrs.iter().find(|p| p.p_type == ElfPtType::PT_PHDR as u32) {
+            return Some(phdr.p_vaddr as usize);
+        }
+        let phoff = self.ehdr.e_phoff;
+        self.load_segments()
+            .find(|p| p.p_offset <= phoff && phoff - p.p_offset < p.p_filesz)
+            .map(|p| (p.p_vaddr + phoff - p.p_offset) as usize)
+    }
+
+    /// 各 PT_LOAD 段从首页起始到最后一段结束的跨度
+    fn image_span(&self) -> usize {
+        let start = self.load_segments().map(|p| page_align_down(p.p_vaddr as usize)).min().unwrap_or(0);
+        let end = self.load_segments().map(|p| (p.p_vaddr + p.p_memsz) as usize).max().unwrap_or(0);
+        end.saturating_sub(start)
+    }
+
+    /// 加载到 base 时段地址的偏移：ET_EXEC 为 0
+    fn load_bias(&self, base: usize) -> usize {
+        if !self.is_dyn() {
+            return 0;
+        }
+        let min_vaddr = self.load_segments().map(|p| p.p_vaddr as usize).min().unwrap_or(0);
+        base.wrapping_sub(page_align_down(min_vaddr))
+    }
+}
+
+/// 打开可执行文件并读出 ELF 头和程序头 (prepare_binprm + load_elf_phdrs)
+pub fn open_exec(path: &str) -> Result<ElfBinary, i32> {
+    let node = match crate::fs::lookup_rootfs_file(path) {
+        Some(node) => node,
+        None => return Err(ENOENT),
+    };
+    load_elf_phdrs(filemap::get_mapping(node.ino, node))
+}
+
+/// 经页缓存读出 ELF 头和程序头 (load_elf_phdrs)
+pub fn load_elf_phdrs(mapping: Arc<FileMapping>) -> Result<ElfBinary, i32> {
+    let mut buf = [0u8; size_of::<Elf64Ehdr>()];
+    if mapping.read(0, &mut buf) != buf.len() {
+        return Err(ENOEXEC);
+    }
+    let ehdr = match unsafe { Elf64Ehdr::from_bytes(&buf) } {
+        Some(e) => e,
+        None => return Err(ENOEXEC),
+    };
+    // 可执行文件或位置无关的共享目标（PIE、动态链接器）
+    if ehdr.e_type != ElfType::ET_EXEC as u16 && ehdr.e_type != ElfType::ET_DYN as u16 {
+        return Err(ENOEXEC);
+    }
+    if !ehdr.check_machine() {
+        return Err(ENOEXEC);
+    }
+
+    if ehdr.e_phentsize as usize != size_of::<Elf64Phdr>() || ehdr.e_phnum == 0 {
+        return Err(ENOEXEC);
+    }
+    let phdrs_size = ehdr.e_phnum as usize * size_of::<Elf64Phdr>();
+    if phdrs_size > MAX_PHDRS_SIZE {
+        return Err(ENOEXEC);
+    }
+    let mut raw = vec![0u8; phdrs_size];
+    if mapping.read(ehdr.e_phoff as usize, &mut raw) != phdrs_size {
+        return Err(ENOEXEC);
+    }
+    let phdrs = (0..ehdr.e_phnum as usize)
+        .map(|i| unsafe { core::ptr::read_unaligned((raw.as_ptr() as *const Elf64Phdr).add(i)) })
+        .collect();
+
+    Ok(ElfBinary { ehdr, phdrs, mapping })
+}
+
+/// 段的 VMA 标志
+fn segment_vma_flags(phdr: &Elf64Phdr) -> VmaFlags {
+    // RISC-V 没有只写页，段总是可读
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ);
+    if phdr.p_flags & PF_W != 0 {
+        flags.insert(VmaFlags::WRITE);
+    }
+    if phdr.p_flags & PF_X != 0 {
+        flags.insert(VmaFlags::EXEC);
+    }
+    flags
+}
+
+fn page_align_down(addr: usize) -> usize {
+    addr & !(PAGE_SIZE - 1)
+}
+
+fn page_align_up(addr: usize) -> usize {
+    (addr + PAGE_SIZE - 1) & !(PAGE_SIZE - 1)
+}
+
+/// 把 [start, end) 登记为 VMA，file 给出时是文件映射
+fn add_vma(addr_space: &AddressSpace, start: usize, end: usize, flags: VmaFlags,
+           file: Option<(&FileMapping, usize)>) -> Result<(), i32> {
+    if start >= end {
+        return Ok(());
+    }
+    let mut vma = Vma::new(VirtAddr::new(start), VirtAddr::new(end), flags);
+    if let Some((mapping, offset)) = file {
+        vma.set_file_mapping(mapping.ino(), offset);
+    }
+    addr_space.vma_write().add(vma).map_err(|_| ENOEXEC)
+}
+
+/// 清零段末页中文件内容之后的部分 (padzero)
+///
+/// 以写缺页取得该页的私有副本，不修改页缓存
+fn padzero(addr_space: &AddressSpace, addr: usize) -> Result<(), i32> {
+    let len = page_align_up(addr) - addr;
+    if len == 0 {
+        return Ok(());
+    }
+    let fault_addr = mm::VirtAddr::new(addr as u64);
+    match mm::handle_mm_fault(addr_space, fault_addr, FaultFlags::WRITE | FaultFlags::USER) {
+        MmFaultResult::Handled | MmFaultResult::AlreadyMapped => {}
+        MmFaultResult::CowPending => {
+            if unsafe { mm::handle_cow_fault(addr_space, fault_addr) }.is_none() {
+                return Err(ENOMEM);
+            }
+        }
+        MmFaultResult::OutOfMemory => return Err(ENOMEM),
+        _ => return Err(ENOEXEC),
+    }
+    let phys = match addr_space.translate(VirtAddr::new(addr)) {
+        Some(phys) => phys.as_usize() + (addr & (PAGE_SIZE - 1)),
+        None => return Err(ENOEXEC),
+    };
+    unsafe { core::ptr::write_bytes(phys as *mut u8, 0, len) };
+    Ok(())
+}
+
+/// 无法直接映射缓存页的段：分配匿名页并从页缓存复制
+fn copy_segment(addr_space: &AddressSpace, bin: &ElfBinary, phdr: &Elf64Phdr, vaddr: usize) -> Result<(), i32> {
+    let start = page_align_down(vaddr);
+    let end = page_align_up(vaddr + phdr.p_memsz as usize);
+
+    let mut pte_flags = PageTableEntry::V | PageTableEntry::A | PageTableEntry::D | PageTableEntry::U
+        | PageTableEntry::R;
+    if phdr.p_flags & PF_W != 0 {
+        pte_flags |= PageTableEntry::W;
+    }
+    if phdr.p_flags & PF_X != 0 {
+        pte_flags |= PageTableEntry::X;
+    }
+
+    if unsafe {
+        mm::alloc_and_map_user_memory(addr_space.root_ppn(), start as u64, (end - start) as u64, pte_flags)
+    }.is_none() {
+        return Err(ENOMEM);
+    }
+    // 匿名页逐页分配，物理上不连续，先读到内核缓冲区再按用户地址写入
+    let filesz = phdr.p_filesz as usize;
+    let mut data = vec![0u8; filesz];
+    if bin.mapping.read(phdr.p_offset as usize, &mut data) != filesz
+        || !unsafe { mm::copy_to_user_space(addr_space.root_ppn(), vaddr as u64, &data) }
+    {
+        return Err(ENOEXEC);
+    }
+    add_vma(addr_space, start, end, segment_vma_flags(phdr), None)
+}
+
+/// 建立全部 PT_LOAD 段的映射 (elf_map + set_brk)
+///
+/// # 参数
+/// - `load_bias`: 段地址的偏移，ET_EXEC 为 0
+///
+/// # 返回
+/// 映像结束地址（页对齐），用作初始 brk
+pub fn elf_map(addr_space: &AddressSpace, bin: &ElfBinary, load_bias: usize) -> Result<usize, i32> {
+    let file_size = bin.mapping.size();
+    let mut image_end = 0;
+
+    for phdr in bin.load_segments() {
+        let vaddr = load_bias + phdr.p_vaddr as usize;
+        let filesz = phdr.p_filesz as usize;
+        let memsz = phdr.p_memsz as usize;
+        let offset = phdr.p_offset as usize;
+        if filesz > memsz || offset.saturating_add(filesz) > file_size {
+            return Err(ENOEXEC);
+        }
+        image_end = image_end.max(page_align_up(vaddr + memsz));
+
+        // 只读段的 BSS 无法在私有副本中清零，也按复制处理
+        let readonly_bss = memsz > filesz && phdr.p_flags & PF_W == 0;
+        if vaddr % PAGE_SIZE != offset % PAGE_SIZE || (filesz > 0 && readonly_bss) {
+            copy_segment(addr_space, bin, phdr, vaddr)?;
+            continue;
+        }
+
+        let flags = segment_vma_flags(phdr);
+        let mut bss_start = page_align_down(vaddr);
+        if filesz > 0 {
+            bss_start = page_align_up(vaddr + filesz);
+            add_vma(addr_space, page_align_down(vaddr), bss_start, flags,
+                    Some((&bin.mapping, page_align_down(offset))))?;
+            if memsz > filesz {
+                padzero(addr_space, vaddr + filesz)?;
+            }
+        }
+        add_vma(addr_space, bss_start, page_align_up(vaddr + memsz), flags, None)?;
+    }
+
+    Ok(image_end)
+}
+
+/// 加载程序及其解释器 (load_elf_binary)
+///
+/// ET_DYN 主程序加载到 ELF_ET_DYN_BASE；有 PT_INTERP 时打开解释器，
+/// 加载到 ELF_INTERP_BASE，从解释器入口开始执行。ET_DYN 解释器的跨度超过
+/// ELF_INTERP_MAX_SIZE 时返回 ENOEXEC
+pub fn load_elf_binary(addr_space: &AddressSpace, bin: &ElfBinary) -> Result<ElfImage, i32> {
+    let interp = match bin.interp_path()? {
+        Some(path) => Some(open_exec(&path)?),
+        None => None,
+    };
+
+    let load_bias = bin.load_bias(ELF_ET_DYN_BASE);
+    let image_end = elf_map(addr_space, bin, load_bias)?;
+    let entry = (load_bias as u64).wrapping_add(bin.ehdr.e_entry);
+    let phdr = match bin.phdr_vaddr() {
+        Some(vaddr) => load_bias.wrapping_add(vaddr) as u64,
+        None => 0,
+    };
+
+    let (start, base) = match interp {
+        Some(interp) => {
+            // 位置无关的解释器必须装得进解释器窗口
+            if interp.is_dyn() && interp.image_span() > ELF_INTERP_MAX_SIZE {
+                return Err(ENOEXEC);
+            }
+            let interp_bias = interp.load_bias(ELF_INTERP_BASE);
+            elf_map(addr_space, &interp, interp_bias)?;
+            ((interp_bias as u64).wrapping_add(interp.ehdr.e_entry), interp_bias as u64)
+        }
+        None => (entry, 0),
+    };
+
+    Ok(ElfImage { start, phdr, phnum: bin.ehdr.e_phnum as u64, base, entry, image_end })
+}
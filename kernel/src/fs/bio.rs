@@ -11,13 +11,14 @@
 //! - 块缓存：缓存磁盘块以提高性能
 //! - 哈希表：快速查找已缓存的块
 
-use alloc::boxed::Box;
 use alloc::vec;
 use alloc::vec::Vec;
 use spin::Mutex;
-use core::sync::atomic::{AtomicU32, Ordering};
+use crate::sync::{LockClass, TicketLock};
+use core::sync::atomic::{AtomicU32, AtomicUsize, Ordering};
 
 use crate::drivers::blkdev;
+use crate::mm::kmem_cache::{KmemCache, kmem_cache_create, kmem_cache_alloc, kmem_cache_free, SLAB_HWCACHE_ALIGN};
 
 #[repr(C)]
 #[derive(Debug, Copy, Clone, PartialEq)]
@@ -29,6 +30,7 @@ impl BufferState {
     pub const BH_Lock: u8 = 2;      // Buffer is locked
     pub const BH_Req: u8 = 3;       // Buffer has been requested
     pub const BH_Mapped: u8 = 4;    // Buffer is mapped to a disk block
+    pub const BH_Verified: u8 = 5;  // Metadata checksum has been verified
 
     pub fn new() -> Self {
         Self(0)
@@ -76,6 +78,10 @@ pub struct BufferHead {
     pub b_data: Vec<u8>,
     /// 引用计数
     b_count: AtomicU32,
+    /// LRU 链表指针和是否在链表中，由块缓存的 LRU 锁保护
+    b_lru_prev: *mut BufferHead,
+    b_lru_next: *mut BufferHead,
+    b_in_lru: bool,
 }
 
 unsafe impl Send for BufferHead {}
@@ -91,6 +97,9 @@ impl BufferHead {
             b_state: Mutex::new(BufferState::new()),
             b_data: vec![0u8; size as usize],
             b_count: AtomicU32::new(1),
+            b_lru_prev: core::ptr::null_mut(),
+            b_lru_next: core::ptr::null_mut(),
+            b_in_lru: false,
         }
     }
 
@@ -102,9 +111,6 @@ impl BufferHead {
             return;
         }
         self.b_device = Some(device);
-        // 直接设置状态位，避免可能的死锁
-        // let mut state = self.b_state.lock();
-        // state.set(BufferState::BH_Mapped);
     }
 
     /// 获取状态
@@ -115,10 +121,8 @@ impl BufferHead {
 
     /// 设置状态位
     pub fn set_state_bit(&self, bit: u8) {
-        // 暂时禁用锁定来调试
-        // let mut state = self.b_state.lock();
-        // state.set(bit);
-        let _ = bit; // 避免未使用警告
+        let mut state = self.b_state.lock();
+        state.set(bit);
     }
 
     /// 清除状态位
@@ -143,6 +147,11 @@ impl BufferHead {
         self.b_count.fetch_sub(1, Ordering::AcqRel) - 1
     }
 
+    /// 当前引用计数
+    pub fn count(&self) -> u32 {
+        self.b_count.load(Ordering::Acquire)
+    }
+
     /// 读取数据
     pub fn read(&self, offset: usize, buf: &mut [u8]) -> usize {
         if offset >= self.b_size as usize {
@@ -186,14 +195,113 @@ impl BufferHead {
     }
 }
 
+/// 哈希桶数（2 的幂）
+const BH_HASH_BUCKETS: usize = 256;
+/// 块缓存默认内存预算（字节）
+const BH_CACHE_DEFAULT_BYTES: usize = 4 * 1024 * 1024;
+
+/// 块缓存 LRU 锁的统计
+static BH_LRU_LOCK_CLASS: LockClass = LockClass::new("bh_lru");
+
+/// 没有使用者的缓冲区组成的 LRU 链表，表头最久未用
+///
+/// 链表指针嵌在 BufferHead 中，只在本锁内读写
+struct BufferLru {
+    head: *mut BufferHead,
+    tail: *mut BufferHead,
+    len: usize,
+}
+
+impl BufferLru {
+    const fn new() -> Self {
+        Self {
+            head: core::ptr::null_mut(),
+            tail: core::ptr::null_mut(),
+            len: 0,
+        }
+    }
+
+    /// 加到表尾（最近使用）
+    unsafe fn push_back(&mut self, bh: *mut BufferHead) {
+        (*bh).b_lru_prev = self.tail;
+        (*bh).b_lru_next = core::ptr::null_mut();
+        if self.tail.is_null() {
+            self.head = bh;
+        } else {
+            (*self.tail).b_lru_next = bh;
+        }
+        self.tail = bh;
+        (*bh).b_in_lru = true;
+        self.len += 1;
+    }
+
+    /// 从链表中摘除，不在链表中时什么也不做
+    unsafe fn unlink(&mut self, bh: *mut BufferHead) {
+        if !(*bh).b_in_lru {
+            return;
+        }
+        let prev = (*bh).b_lru_prev;
+        let next = (*bh).b_lru_next;
+        if prev.is_null() {
+            self.head = next;
+        } else {
+            (*prev).b_lru_next = next;
+        }
+        if next.is_null() {
+            self.tail = prev;
+        } else {
+            (*next).b_lru_prev = prev;
+        }
+        (*bh).b_lru_prev = core::ptr::null_mut();
+        (*bh).b_lru_next = core::ptr::null_mut();
+        (*bh).b_in_lru = false;
+        self.len -= 1;
+    }
+}
+
+/// 块缓存统计
+#[derive(Debug, Clone, Copy, Default)]
+pub struct BufferCacheStats {
+    /// 缓存的缓冲区数
+    pub nr_buffers: usize,
+    /// 没有使用者、可回收的缓冲区数
+    pub nr_unused: usize,
+    /// 缓冲区数上限（由内存预算换算）
+    pub max_buffers: usize,
+    /// 命中次数
+    pub hits: usize,
+    /// 未命中（读盘）次数
+    pub misses: usize,
+    /// 被淘汰的缓冲区数
+    pub evicted: usize,
+    /// 预读读入的缓冲区数
+    pub readahead: usize,
+}
+
+/// 块缓存 (buffer cache)
+///
+/// - 哈希表按 (设备, 块号) 分桶，每桶一把锁，同桶冲突的缓冲区串在桶的链上
+/// - 缓冲区由引用计数保护，bread 取得引用，brelse 归还；
+///   计数降为 0 的缓冲区留在哈希表中，同时挂到 LRU 表尾等待复用
+/// - 缓冲区数超过内存预算时从 LRU 表头淘汰，脏缓冲区先回写；有使用者的缓冲区从不淘汰
+/// - 锁顺序：桶锁 -> LRU 锁
 struct BlockCache {
-    /// 缓冲区哈希表
-    /// 索引: (设备主设备号, 块号) % 哈希表大小
-    buffers: Mutex<Vec<Option<*mut BufferHead>>>,
-    /// 哈希表大小（必须是 2 的幂）
-    hash_size: usize,
+    /// 哈希桶
+    buckets: Vec<Mutex<Vec<*mut BufferHead>>>,
+    /// 没有使用者的缓冲区
+    lru: TicketLock<BufferLru>,
+    /// 缓存的缓冲区数
+    nr_buffers: AtomicUsize,
+    /// 缓冲区数上限
+    max_buffers: AtomicUsize,
+    hits: AtomicUsize,
+    misses: AtomicUsize,
+    evicted: AtomicUsize,
+    readahead: AtomicUsize,
     /// 缓冲区大小
     block_size: u32,
+    /// BufferHead 对象缓存 (bh_cachep)
+    bh_cachep: Option<&'static KmemCache>,
 }
 
 unsafe impl Send for BlockCache {}
@@ -201,126 +309,395 @@ unsafe impl Sync for BlockCache {}
 
 impl BlockCache {
     /// 创建新的块缓存
-    fn new(hash_size: usize, block_size: u32) -> Self {
-        // 使用裸指针初始化，避免需要 Clone trait
-        let mut vec = Vec::with_capacity(hash_size);
-        for _ in 0..hash_size {
-            vec.push(None);
+    fn new(nr_buckets: usize, block_size: u32, budget_bytes: usize) -> Self {
+        debug_assert!(nr_buckets.is_power_of_two());
+        let mut buckets = Vec::with_capacity(nr_buckets);
+        for _ in 0..nr_buckets {
+            buckets.push(Mutex::new(Vec::new()));
         }
 
+        let bh_cachep = kmem_cache_create(
+            "buffer_head",
+            core::mem::size_of::<BufferHead>(),
+            core::mem::align_of::<BufferHead>(),
+            SLAB_HWCACHE_ALIGN,
+            None,
+        );
+
         Self {
-            buffers: Mutex::new(vec),
-            hash_size,
+            buckets,
+            lru: TicketLock::with_class(BufferLru::new(), &BH_LRU_LOCK_CLASS),
+            nr_buffers: AtomicUsize::new(0),
+            max_buffers: AtomicUsize::new(Self::budget_to_buffers(budget_bytes, block_size)),
+            hits: AtomicUsize::new(0),
+            misses: AtomicUsize::new(0),
+            evicted: AtomicUsize::new(0),
+            readahead: AtomicUsize::new(0),
             block_size,
+            bh_cachep,
         }
     }
 
-    /// 计算哈希索引
-    fn hash_index(&self, device_major: u32, blocknr: u64) -> usize {
-        // 使用简单的哈希函数
-        let hash = (device_major as u64).wrapping_mul(31).wrapping_add(blocknr);
-        (hash as usize) & (self.hash_size - 1)
+    /// 内存预算换算为缓冲区数，至少保留一个
+    fn budget_to_buffers(budget_bytes: usize, block_size: u32) -> usize {
+        core::cmp::max(budget_bytes / block_size as usize, 1)
     }
 
-    /// 查找缓冲区
-    fn lookup(&self, device_major: u32, blocknr: u64) -> Option<*const BufferHead> {
-        let index = self.hash_index(device_major, blocknr);
-        let buffers = self.buffers.lock();
+    /// 从 bh_cachep 分配并初始化 BufferHead (alloc_buffer_head)
+    fn alloc_buffer_head(&self, blocknr: u64) -> Option<*mut BufferHead> {
+        let cachep = self.bh_cachep?;
+        let bh = kmem_cache_alloc(cachep) as *mut BufferHead;
+        if bh.is_null() {
+            return None;
+        }
+        unsafe {
+            core::ptr::write(bh, BufferHead::new(blocknr, self.block_size));
+        }
+        Some(bh)
+    }
 
-        if let Some(bh_ptr) = buffers[index] {
-            unsafe {
-                let bh = &*bh_ptr;
-                if bh.b_blocknr == blocknr {
-                    if let Some(device) = bh.b_device {
-                        if (*device).major == device_major {
-                            return Some(bh_ptr);
-                        }
-                    }
-                }
-            }
+    /// 析构并释放 BufferHead (free_buffer_head)
+    ///
+    /// # Safety
+    /// bh 必须由 alloc_buffer_head 分配，且不再被引用
+    unsafe fn free_buffer_head(&self, bh: *mut BufferHead) {
+        if let Some(cachep) = self.bh_cachep {
+            core::ptr::drop_in_place(bh);
+            kmem_cache_free(cachep, bh as *mut u8);
         }
+    }
 
-        None
+    /// 计算哈希桶
+    fn bucket(&self, device: *const blkdev::GenDisk, blocknr: u64) -> &Mutex<Vec<*mut BufferHead>> {
+        let hash = (device as u64 >> 4)
+            .wrapping_mul(31)
+            .wrapping_add(blocknr)
+            .wrapping_mul(0x9E37_79B9_7F4A_7C15);
+        &self.buckets[(hash >> 32) as usize & (self.buckets.len() - 1)]
     }
 
-    /// 获取或创建缓冲区
-    fn get(&self, device: *const blkdev::GenDisk, blocknr: u64) -> Option<*mut BufferHead> {
+    /// 在桶内查找缓冲区，找到时增加引用计数 (__find_get_block)
+    ///
+    /// 引用在桶锁内获取，避免与淘汰竞争；计数从 0 变为 1 时从 LRU 摘除
+    fn find_get(
+        &self,
+        chain: &[*mut BufferHead],
+        device: *const blkdev::GenDisk,
+        blocknr: u64,
+    ) -> Option<*mut BufferHead> {
         unsafe {
-            let device_major = (*device).major;
-
-            // 首先尝试查找已存在的缓冲区
-            if let Some(bh) = self.lookup(device_major, blocknr) {
-                let bh_ref = &*bh;
-                bh_ref.get();
-                return Some(bh as *mut u8 as *mut BufferHead);
+            let bh = *chain
+                .iter()
+                .find(|&&bh| (*bh).b_blocknr == blocknr && (*bh).b_device == Some(device))?;
+            if (*bh).b_count.fetch_add(1, Ordering::AcqRel) == 0 {
+                self.lru.lock().unlink(bh);
             }
+            Some(bh)
+        }
+    }
 
-            // 创建新缓冲区
-            let bh = Box::new(BufferHead::new(blocknr, self.block_size));
+    /// 获取或创建缓冲区 (__bread)
+    fn get(&self, device: *const blkdev::GenDisk, blocknr: u64) -> Option<*mut BufferHead> {
+        let bucket = self.bucket(device, blocknr);
+        if let Some(bh) = self.find_get(&bucket.lock(), device, blocknr) {
+            self.hits.fetch_add(1, Ordering::Relaxed);
+            return Some(bh);
+        }
+        self.misses.fetch_add(1, Ordering::Relaxed);
 
-            // 从磁盘读取数据
-            let mut bh_owned = bh;
+        unsafe {
+            // 在桶锁外读盘
+            let bh_ptr = self.alloc_buffer_head(blocknr)?;
             if let Err(_e) = blkdev::blkdev_read(
                 device,
                 blocknr * (self.block_size as u64 / 512),
-                &mut bh_owned.b_data,
+                &mut (*bh_ptr).b_data,
             ) {
+                self.free_buffer_head(bh_ptr);
                 return None;
             }
+            (*bh_ptr).set_device(device);
+            (*bh_ptr).set_state_bit(BufferState::BH_Uptodate);
+            (*bh_ptr).set_state_bit(BufferState::BH_Mapped);
+
+            {
+                let mut chain = bucket.lock();
+                // 读盘期间其他 CPU 已缓存同一块时使用已有的缓冲区
+                if let Some(bh) = self.find_get(&chain, device, blocknr) {
+                    drop(chain);
+                    self.free_buffer_head(bh_ptr);
+                    return Some(bh);
+                }
+                chain.push(bh_ptr);
+            }
 
-            bh_owned.set_device(device);
-            bh_owned.set_state_bit(BufferState::BH_Uptodate);
+            if self.nr_buffers.fetch_add(1, Ordering::AcqRel) + 1
+                > self.max_buffers.load(Ordering::Relaxed)
+            {
+                self.evict_to_budget();
+            }
+            Some(bh_ptr)
+        }
+    }
 
-            // 转换为裸指针并泄漏
-            let bh_ptr = Box::leak(bh_owned);
+    /// 只查缓存，不读盘 (__find_get_block)
+    fn lookup(&self, device: *const blkdev::GenDisk, blocknr: u64) -> Option<*mut BufferHead> {
+        let bh = self.find_get(&self.bucket(device, blocknr).lock(), device, blocknr)?;
+        self.hits.fetch_add(1, Ordering::Relaxed);
+        Some(bh)
+    }
 
-            // 插入到哈希表
-            let index = self.hash_index(device_major, blocknr);
-            let mut buffers = self.buffers.lock();
-            buffers[index] = Some(bh_ptr);
+    /// 把不在缓存中的块读入缓存，不取得引用 (__breadahead)
+    ///
+    /// 各块在同一个 plug 中提交，相邻的块在调度器中合并为一个请求；
+    /// 读入的缓冲区没有使用者，直接挂到 LRU 表尾等待之后的 bread。
+    /// 一次最多读入四分之一的预算，避免预读把刚读入的块挤掉；读失败时全部丢弃
+    ///
+    /// # 返回
+    /// 读入的块数
+    fn readahead(&self, device: *const blkdev::GenDisk, blocks: &[u64]) -> usize {
+        if device.is_null() {
+            return 0;
+        }
+        let max = core::cmp::max(self.max_buffers.load(Ordering::Relaxed) / 4, 1);
+        let mut bhs = Vec::new();
+        for &blocknr in blocks {
+            if bhs.len() >= max {
+                break;
+            }
+            let cached = {
+                let chain = self.bucket(device, blocknr).lock();
+                chain.iter().any(|&bh| unsafe { (*bh).b_blocknr == blocknr && (*bh).b_device == Some(device) })
+            };
+            if cached || bhs.iter().any(|&bh: &*mut BufferHead| unsafe { (*bh).b_blocknr == blocknr }) {
+                continue;
+            }
+            match self.alloc_buffer_head(blocknr) {
+                Some(bh) => bhs.push(bh),
+                None => break,
+            }
+        }
+        if bhs.is_empty() {
+            return 0;
+        }
 
-            Some(bh_ptr)
+        unsafe {
+            let sectors_per_block = self.block_size as u64 / 512;
+            let result = {
+                let mut plug = blkdev::BlkPlug::new(&*device);
+                for &bh in &bhs {
+                    plug.read((*bh).b_blocknr * sectors_per_block, &mut (*bh).b_data);
+                }
+                plug.finish()
+            };
+            if result.is_err() {
+                for bh in bhs {
+                    self.free_buffer_head(bh);
+                }
+                return 0;
+            }
+
+            let mut added = 0;
+            for bh in bhs {
+                (*bh).set_device(device);
+                (*bh).set_state_bit(BufferState::BH_Uptodate);
+                (*bh).set_state_bit(BufferState::BH_Mapped);
+                (*bh).b_count.store(0, Ordering::Release);
+                let mut chain = self.bucket(device, (*bh).b_blocknr).lock();
+                // 读盘期间其他 CPU 已经读入了同一块
+                if chain.iter().any(|&b| (*b).b_blocknr == (*bh).b_blocknr && (*b).b_device == Some(device)) {
+                    drop(chain);
+                    self.free_buffer_head(bh);
+                    continue;
+                }
+                chain.push(bh);
+                self.lru.lock().push_back(bh);
+                drop(chain);
+                added += 1;
+            }
+            self.readahead.fetch_add(added, Ordering::Relaxed);
+            if self.nr_buffers.fetch_add(added, Ordering::AcqRel) + added
+                > self.max_buffers.load(Ordering::Relaxed)
+            {
+                self.evict_to_budget();
+            }
+            added
         }
     }
 
-    /// 释放缓冲区
-    fn put(&self, _bh: *const BufferHead) {
-        // 简化实现：不真正释放
-        // 在完整实现中，应该减少引用计数，并在计数为 0 时回收
+    /// 释放缓冲区 (brelse)
+    ///
+    /// 引用计数降为 0 时挂到 LRU 表尾，缓冲区仍留在哈希表中
+    fn put(&self, bh: *const BufferHead) {
+        if bh.is_null() {
+            return;
+        }
+        let bh = bh as *mut BufferHead;
+        unsafe {
+            if (*bh).put() != 0 {
+                return;
+            }
+            let mut lru = self.lru.lock();
+            // 计数降为 0 后可能已被重新引用
+            if (*bh).count() == 0 && !(*bh).b_in_lru {
+                lru.push_back(bh);
+            }
+        }
     }
 
-    /// 同步所有脏缓冲区
-    fn sync_all(&self) -> Result<(), i32> {
-        let buffers = self.buffers.lock();
+    /// 从 LRU 表头淘汰一个缓冲区，脏缓冲区先回写
+    ///
+    /// try_only 为真时拿不到锁直接放弃（页回收路径）
+    ///
+    /// # 返回
+    /// 是否释放了缓冲区；LRU 为空或拿不到锁时返回 None
+    fn evict_one(&self, try_only: bool) -> Option<bool> {
+        let bh = {
+            let mut lru = if try_only { self.lru.try_lock()? } else { self.lru.lock() };
+            let bh = lru.head;
+            if bh.is_null() {
+                return None;
+            }
+            // 摘除后其他淘汰者看不到它，只有 find_get 还能取得引用
+            unsafe { lru.unlink(bh) };
+            bh
+        };
 
-        for bh_opt in buffers.iter() {
-            if let Some(bh_ptr) = *bh_opt {
-                unsafe {
-                    let bh = &*bh_ptr;
-                    if bh.is_dirty() {
-                        bh.sync()?;
+        unsafe {
+            let device = (*bh).b_device?;
+            let bucket = self.bucket(device, (*bh).b_blocknr);
+            let mut chain = if try_only {
+                match bucket.try_lock() {
+                    Some(chain) => chain,
+                    None => {
+                        self.requeue(bh);
+                        return Some(false);
                     }
                 }
+            } else {
+                bucket.lock()
+            };
+
+            // 摘除后又被引用的缓冲区由其 brelse 重新挂回 LRU
+            if (*bh).count() != 0 {
+                return Some(false);
+            }
+            // 回写失败的脏缓冲区保留
+            if (*bh).sync().is_err() {
+                drop(chain);
+                self.requeue(bh);
+                return Some(false);
+            }
+            // 摘除后可能经过一次 bread/brelse 又挂回了 LRU
+            self.lru.lock().unlink(bh);
+            if let Some(pos) = chain.iter().position(|&b| b == bh) {
+                chain.swap_remove(pos);
+            }
+            drop(chain);
+
+            self.free_buffer_head(bh);
+            self.nr_buffers.fetch_sub(1, Ordering::AcqRel);
+            self.evicted.fetch_add(1, Ordering::Relaxed);
+            Some(true)
+        }
+    }
+
+    /// 把暂时不能淘汰的缓冲区放回 LRU 表尾
+    unsafe fn requeue(&self, bh: *mut BufferHead) {
+        let mut lru = self.lru.lock();
+        if (*bh).count() == 0 && !(*bh).b_in_lru {
+            lru.push_back(bh);
+        }
+    }
+
+    /// 淘汰到缓冲区数不超过预算
+    ///
+    /// 每个缓冲区最多尝试一次，全部有使用者或回写失败时允许暂时超出
+    fn evict_to_budget(&self) {
+        let mut attempts = self.lru.lock().len;
+        while attempts > 0
+            && self.nr_buffers.load(Ordering::Acquire) > self.max_buffers.load(Ordering::Relaxed)
+        {
+            if self.evict_one(false).is_none() {
+                break;
+            }
+            attempts -= 1;
+        }
+    }
+
+    /// 设置内存预算，超出的部分立即淘汰
+    fn set_budget(&self, budget_bytes: usize) {
+        self.max_buffers
+            .store(Self::budget_to_buffers(budget_bytes, self.block_size), Ordering::Relaxed);
+        self.evict_to_budget();
+    }
+
+    /// 回收没有使用者的缓冲区，脏缓冲区先回写 (try_to_free_buffers)
+    ///
+    /// 由页回收调用，拿不到锁时跳过
+    ///
+    /// # 返回
+    /// 释放的缓冲区数
+    fn shrink(&self) -> usize {
+        let mut attempts = match self.lru.try_lock() {
+            Some(lru) => lru.len,
+            None => return 0,
+        };
+        let mut freed = 0;
+        while attempts > 0 {
+            match self.evict_one(true) {
+                Some(true) => freed += 1,
+                Some(false) => {}
+                None => break,
             }
+            attempts -= 1;
         }
+        freed
+    }
 
+    /// 同步所有脏缓冲区
+    fn sync_all(&self) -> Result<(), i32> {
+        for bucket in self.buckets.iter() {
+            let chain = bucket.lock();
+            for &bh in chain.iter() {
+                unsafe {
+                    (*bh).sync()?;
+                }
+            }
+        }
         Ok(())
     }
 
     /// 释放所有缓冲区
+    ///
+    /// 调用者保证没有缓冲区仍被引用
     fn invalidate(&self) {
-        let mut buffers = self.buffers.lock();
-
-        for i in 0..buffers.len() {
-            if let Some(bh_ptr) = buffers[i] {
+        for bucket in self.buckets.iter() {
+            let mut chain = bucket.lock();
+            // 仍被引用的缓冲区（如日志事务持有的元数据块）保留
+            let (busy, idle): (Vec<_>, Vec<_>) = chain.drain(..).partition(|&bh| unsafe { (*bh).count() > 0 });
+            chain.extend(busy);
+            for bh in idle {
                 unsafe {
-                    // 重新获取所有权并释放
-                    let _ = Box::from_raw(bh_ptr);
+                    self.lru.lock().unlink(bh);
+                    self.free_buffer_head(bh);
                 }
-                buffers[i] = None;
+                self.nr_buffers.fetch_sub(1, Ordering::AcqRel);
             }
         }
     }
+
+    fn stats(&self) -> BufferCacheStats {
+        BufferCacheStats {
+            nr_buffers: self.nr_buffers.load(Ordering::Relaxed),
+            nr_unused: self.lru.lock().len,
+            max_buffers: self.max_buffers.load(Ordering::Relaxed),
+            hits: self.hits.load(Ordering::Relaxed),
+            misses: self.misses.load(Ordering::Relaxed),
+            evicted: self.evicted.load(Ordering::Relaxed),
+            readahead: self.readahead.load(Ordering::Relaxed),
+        }
+    }
 }
 
 // 使用 lazy_static 风格的初始化
@@ -332,8 +709,7 @@ static mut BLOCK_CACHE: Option<BlockCache> = None;
 fn get_block_cache() -> &'static BlockCache {
     unsafe {
         if !CACHE_INIT.load(AtomicOrdering::Acquire) {
-            // 使用 16 个条目的缓存（64KB）
-            BLOCK_CACHE = Some(BlockCache::new(16, 4096));
+            BLOCK_CACHE = Some(BlockCache::new(BH_HASH_BUCKETS, 4096, BH_CACHE_DEFAULT_BYTES));
             CACHE_INIT.store(true, AtomicOrdering::Release);
         }
         BLOCK_CACHE.as_ref().unwrap()
@@ -344,6 +720,21 @@ pub fn bread(device: *const blkdev::GenDisk, blocknr: u64) -> Option<*mut Buffer
     get_block_cache().get(device, blocknr)
 }
 
+/// 块已在缓存中时取得引用，否则返回 None，不读盘 (sb_find_get_block)
+pub fn find_get_block(device: *const blkdev::GenDisk, blocknr: u64) -> Option<*mut BufferHead> {
+    get_block_cache().lookup(device, blocknr)
+}
+
+/// 预读一组块到块缓存，已缓存的块跳过 (sb_breadahead)
+///
+/// 调用者把将要读的块一起给出，相邻的块合并为一个多块读请求
+///
+/// # 返回
+/// 实际读入的块数
+pub fn breadahead(device: *const blkdev::GenDisk, blocks: &[u64]) -> usize {
+    get_block_cache().readahead(device, blocks)
+}
+
 pub fn brelse(bh: *const BufferHead) {
     get_block_cache().put(bh)
 }
@@ -359,6 +750,40 @@ pub fn sync_buffers() -> Result<(), i32> {
     get_block_cache().sync_all()
 }
 
+/// 回收空闲缓冲区（页回收的收缩器）
+///
+/// # 返回
+/// 释放的缓冲区数
+pub fn shrink_buffers() -> usize {
+    if !CACHE_INIT.load(AtomicOrdering::Acquire) {
+        return 0;
+    }
+    get_block_cache().shrink()
+}
+
+/// 设置块缓存的内存预算（字节），超出的空闲缓冲区立即淘汰
+pub fn set_buffer_cache_budget(budget_bytes: usize) {
+    get_block_cache().set_budget(budget_bytes)
+}
+
+/// 块缓存统计
+pub fn buffer_cache_stats() -> BufferCacheStats {
+    if !CACHE_INIT.load(AtomicOrdering::Acquire) {
+        return BufferCacheStats::default();
+    }
+    get_block_cache().stats()
+}
+
+/// 回写并丢弃所有未被引用的缓冲区
+pub fn invalidate_buffers() {
+    if !CACHE_INIT.load(AtomicOrdering::Acquire) {
+        return;
+    }
+    let cache = get_block_cache();
+    let _ = cache.sync_all();
+    cache.invalidate();
+}
+
 pub fn init() {
     // 缓存会在第一次使用时自动初始化（懒加载模式）
     // 不在这里初始化，避免启动时分配过多内存导致 panic
@@ -0,0 +1,500 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! cgroup2 - 控制组文件系统（cpu 与 memory 控制器）
+//!
+//! 参考 Linux: kernel/cgroup/cgroup.c, kernel/sched/core.c (cpu_cftypes),
+//!            mm/memcontrol.c (memory_files)
+//!
+//! 挂载在 /sys/fs/cgroup，目录树就是调度器的任务组树 (sched::group)：
+//! mkdir 创建子组，rmdir 删除空组。每个目录下的文件：
+//! - cgroup.controllers - 可用的控制器
+//! - cgroup.procs       - 组内的进程（可写，写入 PID 把整个线程组移进来）
+//! - cpu.weight         - 权重 1..10000，默认 100（根组没有）
+//! - cpu.shares         - v1 兼容的份额 (cpu.shares)（根组没有）
+//! - cpu.max            - "$QUOTA $PERIOD"，单位微秒，不限制时 QUOTA 为 max（根组没有）
+//! - cpu.stat           - 运行时间与节流统计
+//! - memory.current     - 组及其子组计费的字节数（根组没有）
+//! - memory.max         - 硬限制，字节数或 max；超过时组内回收，回收不出则分配失败（根组没有）
+//! - memory.high        - 软限制，超过时同步回收（根组没有）
+//! - memory.peak        - 用量的历史最高值（根组没有）
+//! - memory.stat        - 各类型计费的字节数：anon、file、kernel、sock（根组没有）
+//! - memory.events      - high / max / oom 事件次数（根组没有）
+
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use alloc::string::String;
+use alloc::format;
+use core::sync::atomic::{AtomicPtr, Ordering};
+
+use crate::errno;
+use crate::fs::superblock::{SuperBlock, FileSystemType};
+use crate::fs::mount::{VfsMount, MntFlags};
+use crate::mm::memcontrol;
+use crate::mm::PAGE_SIZE;
+use crate::sched::group::{self, TaskGroup};
+
+/// cgroup2 魔数 (CGROUP2_SUPER_MAGIC)
+const CGROUP2_MAGIC: u32 = 0x63677270;
+
+/// 挂载点
+const CGROUP_MOUNT_POINT: &str = "/sys/fs/cgroup";
+
+/// cpu.weight 的范围与默认值 (CGROUP_WEIGHT_MIN/DFL/MAX)
+const CGROUP_WEIGHT_MIN: u64 = 1;
+const CGROUP_WEIGHT_DFL: u64 = 100;
+const CGROUP_WEIGHT_MAX: u64 = 10000;
+
+/// 控制文件 (cftype)
+struct CgroupFile {
+    name: &'static str,
+    /// 根组是否有这个文件 (!CFTYPE_NOT_ON_ROOT)
+    on_root: bool,
+    read: fn(*mut TaskGroup) -> String,
+    write: Option<fn(*mut TaskGroup, &str) -> Result<(), i32>>,
+}
+
+static CGROUP_FILES: [CgroupFile; 12] = [
+    CgroupFile { name: "cgroup.controllers", on_root: true, read: controllers_show, write: None },
+    CgroupFile { name: "cgroup.procs", on_root: true, read: procs_show, write: Some(procs_write) },
+    CgroupFile { name: "cpu.weight", on_root: false, read: weight_show, write: Some(weight_write) },
+    CgroupFile { name: "cpu.shares", on_root: false, read: shares_show, write: Some(shares_write) },
+    CgroupFile { name: "cpu.max", on_root: false, read: max_show, write: Some(max_write) },
+    CgroupFile { name: "cpu.stat", on_root: true, read: stat_show, write: None },
+    CgroupFile { name: "memory.current", on_root: false, read: memory_current_show, write: None },
+    CgroupFile { name: "memory.max", on_root: false, read: memory_max_show, write: Some(memory_max_write) },
+    CgroupFile { name: "memory.high", on_root: false, read: memory_high_show, write: Some(memory_high_write) },
+    CgroupFile { name: "memory.peak", on_root: false, read: memory_peak_show, write: None },
+    CgroupFile { name: "memory.stat", on_root: false, read: memory_stat_show, write: None },
+    CgroupFile { name: "memory.events", on_root: false, read: memory_events_show, write: None },
+];
+
+/// 路径解析结果
+enum CgroupNode {
+    Dir(*mut TaskGroup),
+    File(*mut TaskGroup, &'static CgroupFile),
+}
+
+fn invalid() -> i32 {
+    errno::Errno::InvalidArgument.as_neg_i32()
+}
+
+fn parse_u64(s: &str) -> Result<u64, i32> {
+    s.trim().parse::<u64>().map_err(|_| invalid())
+}
+
+// ==================== 控制文件 ====================
+
+fn controllers_show(_group: *mut TaskGroup) -> String {
+    String::from("cpu memory\n")
+}
+
+/// 列出组内的线程组，每个 TGID 一行
+fn procs_show(group: *mut TaskGroup) -> String {
+    let mut tgids: Vec<u32> = Vec::new();
+    crate::sched::sched::for_each_task(|task| unsafe {
+        if group::task_group(&*task) == group {
+            let tgid = (*task).tgid();
+            if !tgids.contains(&tgid) {
+                tgids.push(tgid);
+            }
+        }
+    });
+    tgids.sort_unstable();
+    let mut out = String::new();
+    for tgid in tgids {
+        out.push_str(&format!("{}\n", tgid));
+    }
+    out
+}
+
+/// 把 PID 所在线程组的所有线程移进组 (cgroup_procs_write)
+fn procs_write(group: *mut TaskGroup, data: &str) -> Result<(), i32> {
+    let pid = parse_u64(data)? as u32;
+    // idle 任务不属于任何组
+    if pid == 0 {
+        return Err(invalid());
+    }
+    let mut tgid = None;
+    crate::sched::sched::for_each_task(|task| unsafe {
+        if (*task).pid() == pid {
+            tgid = Some((*task).tgid());
+        }
+    });
+    let tgid = match tgid {
+        Some(tgid) => tgid,
+        None => return Err(errno::Errno::NoSuchProcess.as_neg_i32()),
+    };
+    // 持有任务表锁时任务不会被释放
+    crate::sched::sched::for_each_task(|task| unsafe {
+        if (*task).tgid() == tgid {
+            group::sched_move_task(task, group);
+        }
+    });
+    Ok(())
+}
+
+fn weight_show(group: *mut TaskGroup) -> String {
+    let weight = group::sched_group_shares(group) * CGROUP_WEIGHT_DFL / crate::sched::fair::NICE_0_LOAD;
+    format!("{}\n", weight.clamp(CGROUP_WEIGHT_MIN, CGROUP_WEIGHT_MAX))
+}
+
+/// 权重按 100 对应 NICE_0_LOAD 换算成份额 (cpu_weight_write_u64)
+fn weight_write(group: *mut TaskGroup, data: &str) -> Result<(), i32> {
+    let weight = parse_u64(data)?;
+    if !(CGROUP_WEIGHT_MIN..=CGROUP_WEIGHT_MAX).contains(&weight) {
+        return Err(invalid());
+    }
+    let shares = (weight * crate::sched::fair::NICE_0_LOAD + CGROUP_WEIGHT_DFL / 2) / CGROUP_WEIGHT_DFL;
+    group::sched_group_set_shares(group, shares)
+}
+
+fn shares_show(group: *mut TaskGroup) -> String {
+    format!("{}\n", group::sched_group_shares(group))
+}
+
+fn shares_write(group: *mut TaskGroup, data: &str) -> Result<(), i32> {
+    group::sched_group_set_shares(group, parse_u64(data)?)
+}
+
+fn max_show(group: *mut TaskGroup) -> String {
+    let (period, quota) = group::tg_get_cfs_bandwidth(group);
+    if quota == group::RUNTIME_INF {
+        format!("max {}\n", period / 1000)
+    } else {
+        format!("{} {}\n", quota / 1000, period / 1000)
+    }
+}
+
+/// 写入 "$QUOTA [$PERIOD]"，QUOTA 可以是 max；省略 PERIOD 时保持原值 (cpu_max_write)
+fn max_write(group: *mut TaskGroup, data: &str) -> Result<(), i32> {
+    let (mut period, _) = group::tg_get_cfs_bandwidth(group);
+    let mut fields = data.split_whitespace();
+    let quota = match fields.next() {
+        Some("max") => group::RUNTIME_INF,
+        Some(quota) => parse_u64(quota)?.checked_mul(1000).ok_or_else(invalid)?,
+        None => return Err(invalid()),
+    };
+    if let Some(p) = fields.next() {
+        period = parse_u64(p)?.checked_mul(1000).ok_or_else(invalid)?;
+    }
+    if fields.next().is_some() {
+        return Err(invalid());
+    }
+    group::tg_set_cfs_bandwidth(group, period, quota)
+}
+
+fn stat_show(group: *mut TaskGroup) -> String {
+    let stat = group::tg_cpu_stat(group);
+    format!(
+        "usage_usec {}\nnr_periods {}\nnr_throttled {}\nthrottled_usec {}\n",
+        stat.usage_ns / 1000,
+        stat.nr_periods,
+        stat.nr_throttled,
+        stat.throttled_ns / 1000,
+    )
+}
+
+/// 组的内存统计；只对非根组调用，非根组一定有内存控制组
+fn memcg_stats(group: *mut TaskGroup) -> memcontrol::MemcgStats {
+    unsafe { memcontrol::mem_cgroup_stats(group::tg_memcg(group)) }
+}
+
+/// 页数写成字节数，不限制时为 max
+fn format_limit(pages: usize) -> String {
+    if pages == memcontrol::PAGE_COUNTER_MAX {
+        String::from("max\n")
+    } else {
+        format!("{}\n", pages * PAGE_SIZE)
+    }
+}
+
+/// 解析 "max" 或字节数，向下取整到页 (page_counter_memparse)
+fn parse_limit(data: &str) -> Result<usize, i32> {
+    match data.trim() {
+        "max" => Ok(memcontrol::PAGE_COUNTER_MAX),
+        bytes => Ok(parse_u64(bytes)? as usize / PAGE_SIZE),
+    }
+}
+
+fn memory_current_show(group: *mut TaskGroup) -> String {
+    format!("{}\n", memcg_stats(group).usage * PAGE_SIZE)
+}
+
+fn memory_max_show(group: *mut TaskGroup) -> String {
+    format_limit(memcg_stats(group).max)
+}
+
+fn memory_max_write(group: *mut TaskGroup, data: &str) -> Result<(), i32> {
+    let max = parse_limit(data)?;
+    unsafe { memcontrol::memory_max_write(group::tg_memcg(group), max) };
+    Ok(())
+}
+
+fn memory_high_show(group: *mut TaskGroup) -> String {
+    format_limit(memcg_stats(group).high)
+}
+
+fn memory_high_write(group: *mut TaskGroup, data: &str) -> Result<(), i32> {
+    let high = parse_limit(data)?;
+    unsafe { memcontrol::memory_high_write(group::tg_memcg(group), high) };
+    Ok(())
+}
+
+fn memory_peak_show(group: *mut TaskGroup) -> String {
+    format!("{}\n", memcg_stats(group).peak * PAGE_SIZE)
+}
+
+fn memory_stat_show(group: *mut TaskGroup) -> String {
+    let stats = memcg_stats(group);
+    let mut out = String::new();
+    for (name, pages) in memcontrol::MEMCG_STAT_NAMES.iter().zip(stats.stat.iter()) {
+        out.push_str(&format!("{} {}\n", name, pages * PAGE_SIZE));
+    }
+    out
+}
+
+fn memory_events_show(group: *mut TaskGroup) -> String {
+    let stats = memcg_stats(group);
+    let mut out = String::new();
+    for (name, count) in memcontrol::MEMCG_EVENT_NAMES.iter().zip(stats.events.iter()) {
+        out.push_str(&format!("{} {}\n", name, count));
+    }
+    out
+}
+
+// ==================== 超级块 ====================
+
+/// cgroup2 超级块
+#[repr(C)]
+pub struct CgroupFsSuperBlock {
+    /// 基础超级块（必须在首位，挂载时按 *mut SuperBlock 传递）
+    pub sb: SuperBlock,
+}
+
+impl CgroupFsSuperBlock {
+    pub fn new() -> Self {
+        Self {
+            sb: SuperBlock::new(4096, CGROUP2_MAGIC),
+        }
+    }
+
+    /// 沿任务组树解析路径，路径相对于挂载点
+    fn lookup(&self, path: &str) -> Option<CgroupNode> {
+        let mut group = group::root_task_group();
+        let mut components = path.split('/').filter(|s| !s.is_empty() && *s != ".").peekable();
+        while let Some(name) = components.next() {
+            if let Some(child) = group::find_child_group(group, name) {
+                group = child;
+                continue;
+            }
+            // 只有最后一个分量可以是控制文件
+            if components.peek().is_some() {
+                return None;
+            }
+            let on_root = group == group::root_task_group();
+            return CGROUP_FILES
+                .iter()
+                .find(|file| file.name == name && (file.on_root || !on_root))
+                .map(|file| CgroupNode::File(group, file));
+        }
+        Some(CgroupNode::Dir(group))
+    }
+
+    /// 读取控制文件
+    pub fn read_file(&self, path: &str) -> Option<Vec<u8>> {
+        match self.lookup(path)? {
+            CgroupNode::File(group, file) => Some((file.read)(group).into_bytes()),
+            CgroupNode::Dir(_) => None,
+        }
+    }
+
+    /// 写入控制文件
+    ///
+    /// # 返回
+    /// 成功返回写入的字节数；只读文件返回 EACCES
+    pub fn write_file(&self, path: &str, data: &[u8]) -> Result<usize, i32> {
+        match self.lookup(path) {
+            Some(CgroupNode::File(group, file)) => {
+                let write = match file.write {
+                    Some(write) => write,
+                    None => return Err(errno::Errno::PermissionDenied.as_neg_i32()),
+                };
+                let text = core::str::from_utf8(data).map_err(|_| invalid())?;
+                write(group, text)?;
+                Ok(data.len())
+            }
+            Some(CgroupNode::Dir(_)) => Err(errno::Errno::IsADirectory.as_neg_i32()),
+            None => Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
+        }
+    }
+
+    /// 分离出父目录和最后一个分量
+    fn split_parent<'a>(&self, path: &'a str) -> Result<(*mut TaskGroup, &'a str), i32> {
+        let path = path.trim_end_matches('/');
+        let (parent, name) = match path.rfind('/') {
+            Some(pos) => (&path[..pos], &path[pos + 1..]),
+            None => ("", path),
+        };
+        match self.lookup(parent) {
+            Some(CgroupNode::Dir(group)) => Ok((group, name)),
+            Some(CgroupNode::File(..)) => Err(errno::Errno::NotADirectory.as_neg_i32()),
+            None => Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
+        }
+    }
+
+    /// 创建子组 (cgroup_mkdir)
+    pub fn mkdir(&self, path: &str) -> Result<(), i32> {
+        let (parent, name) = self.split_parent(path)?;
+        if CGROUP_FILES.iter().any(|file| file.name == name) {
+            return Err(errno::Errno::FileExists.as_neg_i32());
+        }
+        group::sched_create_group(parent, name).map(|_| ())
+    }
+
+    /// 删除空的子组 (cgroup_rmdir)
+    pub fn rmdir(&self, path: &str) -> Result<(), i32> {
+        match self.lookup(path) {
+            Some(CgroupNode::Dir(group)) => group::sched_destroy_group(group),
+            Some(CgroupNode::File(..)) => Err(errno::Errno::NotADirectory.as_neg_i32()),
+            None => Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
+        }
+    }
+
+    /// 列出目录：子组在前，控制文件在后；第二项表示是否为目录
+    pub fn list_dir(&self, path: &str) -> Option<Vec<(Vec<u8>, bool)>> {
+        let group = match self.lookup(path)? {
+            CgroupNode::Dir(group) => group,
+            CgroupNode::File(..) => return None,
+        };
+        let on_root = group == group::root_task_group();
+        let mut entries: Vec<(Vec<u8>, bool)> = group::child_group_names(group)
+            .into_iter()
+            .map(|name| (name.into_bytes(), true))
+            .collect();
+        for file in CGROUP_FILES.iter().filter(|file| file.on_root || !on_root) {
+            entries.push((file.name.as_bytes().to_vec(), false));
+        }
+        Some(entries)
+    }
+}
+
+// ==================== 文件系统类型注册 ====================
+
+/// cgroup2 文件系统类型
+pub static CGROUP2_FS_TYPE: FileSystemType = FileSystemType::new(
+    "cgroup2",
+    Some(cgroupfs_mount),
+    Some(cgroupfs_kill_sb),
+    0,
+);
+
+/// 全局 cgroup2 超级块指针
+static GLOBAL_CGROUPFS_SB: AtomicPtr<CgroupFsSuperBlock> = AtomicPtr::new(core::ptr::null_mut());
+
+/// 全局 cgroup2 挂载点指针
+static GLOBAL_CGROUP_MOUNT: AtomicPtr<VfsMount> = AtomicPtr::new(core::ptr::null_mut());
+
+/// cgroup2 挂载函数
+unsafe extern "C" fn cgroupfs_mount(_fs_context: &crate::fs::superblock::FsContext<'_>) -> Result<*mut SuperBlock, i32> {
+    let sb = alloc::boxed::Box::new(CgroupFsSuperBlock::new());
+    Ok(alloc::boxed::Box::into_raw(sb) as *mut SuperBlock)
+}
+
+/// cgroup2 卸载函数
+unsafe extern "C" fn cgroupfs_kill_sb(sb: *mut SuperBlock) {
+    if !sb.is_null() {
+        let _ = alloc::boxed::Box::from_raw(sb as *mut CgroupFsSuperBlock);
+    }
+}
+
+/// 获取 cgroup2 超级块
+pub fn get_cgroupfs_sb() -> Option<&'static CgroupFsSuperBlock> {
+    let ptr = GLOBAL_CGROUPFS_SB.load(Ordering::Acquire);
+    if ptr.is_null() {
+        None
+    } else {
+        Some(unsafe { &*ptr })
+    }
+}
+
+/// 读取 /sys/fs/cgroup 下的文件
+pub fn read_file(path: &str) -> Option<Vec<u8>> {
+    get_cgroupfs_sb()?.read_file(path)
+}
+
+/// 写入 /sys/fs/cgroup 下的文件
+pub fn write_file(path: &str, data: &[u8]) -> Result<usize, i32> {
+    match get_cgroupfs_sb() {
+        Some(sb) => sb.write_file(path, data),
+        None => Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
+    }
+}
+
+/// 在 /sys/fs/cgroup 下创建组
+pub fn mkdir(path: &str) -> Result<(), i32> {
+    match get_cgroupfs_sb() {
+        Some(sb) => sb.mkdir(path),
+        None => Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
+    }
+}
+
+/// 删除 /sys/fs/cgroup 下的组
+pub fn rmdir(path: &str) -> Result<(), i32> {
+    match get_cgroupfs_sb() {
+        Some(sb) => sb.rmdir(path),
+        None => Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
+    }
+}
+
+/// 列出 /sys/fs/cgroup 下的目录
+pub fn list_dir(path: &str) -> Option<Vec<(Vec<u8>, bool)>> {
+    get_cgroupfs_sb()?.list_dir(path)
+}
+
+/// 初始化 cgroup2
+pub fn init_cgroupfs() -> Result<(), i32> {
+    use crate::fs::superblock::register_filesystem;
+
+    register_filesystem(&CGROUP2_FS_TYPE)?;
+
+    let sb = alloc::boxed::Box::new(CgroupFsSuperBlock::new());
+    GLOBAL_CGROUPFS_SB.store(alloc::boxed::Box::into_raw(sb), Ordering::Release);
+
+    Ok(())
+}
+
+/// 挂载 cgroup2 到 /sys/fs/cgroup
+pub fn mount_cgroupfs() -> Result<(), i32> {
+    let rootfs_sb = match crate::fs::rootfs::get_rootfs_sb() {
+        Some(sb) => sb,
+        None => return Err(-1),
+    };
+
+    // 逐级创建挂载点，已存在的目录保留
+    for dir in ["/sys", "/sys/fs", CGROUP_MOUNT_POINT] {
+        match unsafe { (*rootfs_sb).create_dir(dir, 0o755) } {
+            Ok(()) => {}
+            Err(e) if e == errno::Errno::FileExists.as_neg_i32() => {}
+            Err(e) => return Err(e),
+        }
+    }
+
+    let sb_ptr = GLOBAL_CGROUPFS_SB.load(Ordering::Acquire);
+    if sb_ptr.is_null() {
+        return Err(-1);
+    }
+
+    let mount = Arc::new(VfsMount::new(
+        CGROUP_MOUNT_POINT.as_bytes().to_vec(),
+        CGROUP_MOUNT_POINT.as_bytes().to_vec(),
+        MntFlags::new(0),
+        Some(sb_ptr as *mut u8),
+    ).with_fstype(&CGROUP2_FS_TYPE));
+    crate::fs::mount::get_init_namespace().add_mount(mount.clone())?;
+    GLOBAL_CGROUP_MOUNT.store(Arc::as_ptr(&mount) as *mut VfsMount, Ordering::Release);
+
+    Ok(())
+}
@@ -5,10 +5,19 @@
 
 //! 字符设备文件操作
 //!
-//! 实现字符设备的读写操作，主要支持 UART 设备
+//! 实现字符设备的读写操作，主要支持 UART 设备、输入事件设备和只读统计页 (/dev/kstats)；
+//! UART 控制台的读写、poll 交给 TTY 层 (drivers/tty)
 //!
 
-use crate::console;
+use alloc::sync::Arc;
+
+use crate::drivers::tty;
+use crate::fs::file::{fput, get_file_fd_install, poll_mask::*, File, FileFlags, FileOps};
+use crate::fs::pipe::pipe_wait;
+use crate::fs::select::{poll_wait, PollTable};
+use crate::input::evdev::{self, EvdevClient, EVDEV_WQ};
+use crate::input::RawInputEvent;
+use crate::kstats::KSTATS_PATH;
 
 #[repr(C)]
 #[derive(Debug, Copy, Clone, PartialEq)]
@@ -50,44 +59,14 @@ impl CharDev {
     }
 }
 
+/// 从串口终端阻塞读取，规范模式下最多一行
 pub unsafe fn uart_read(buf: *mut u8, count: usize) -> isize {
-    let mut bytes_read: usize = 0;
-    let slice = core::slice::from_raw_parts_mut(buf, count);
-
-    // 忙等待第一个字符
-    while bytes_read == 0 {
-        if let Some(c) = console::getchar() {
-            slice[bytes_read] = c;
-            bytes_read += 1;
-        }
-        // 短暂延迟，避免过度占用 CPU
-        for _ in 0..1000 {
-            core::arch::asm!("nop", options(nomem, nostack));
-        }
-    }
-
-    // 继续读取更多字符（非阻塞）
-    while bytes_read < count {
-        if let Some(c) = console::getchar() {
-            slice[bytes_read] = c;
-            bytes_read += 1;
-            if c == b'\n' {
-                break;
-            }
-        } else {
-            break;
-        }
-    }
-
-    bytes_read as isize
+    tty::tty_read(core::slice::from_raw_parts_mut(buf, count), false)
 }
 
+/// 写入串口终端，复制进发送缓冲区即返回
 pub unsafe fn uart_write(buf: *const u8, count: usize) -> isize {
-    let slice = core::slice::from_raw_parts(buf, count);
-    for &b in slice {
-        console::putchar(b);
-    }
-    count as isize
+    tty::tty_write(core::slice::from_raw_parts(buf, count), false)
 }
 
 /// UART 字符设备的文件操作（公开访问）
@@ -96,26 +75,232 @@ pub static UART_OPS: crate::fs::FileOps = crate::fs::FileOps {
     write: Some(uart_file_write),
     lseek: None,
     close: None,
+    read_iter: None,
+    write_iter: None,
+    poll: Some(uart_file_poll),
 };
 
+/// UART 文件的字符设备，非 UART 控制台返回 None
+fn uart_file_dev(file: &File) -> Option<&CharDev> {
+    unsafe { *file.private_data.get() }.map(|ptr| unsafe { &*(ptr as *const CharDev) })
+}
+
 fn uart_file_read(file: &crate::fs::File, buf: &mut [u8]) -> isize {
-    if let Some(priv_data) = unsafe { *file.private_data.get() } {
-        let char_dev = unsafe { &*(priv_data as *const CharDev) };
-        unsafe { char_dev.read(buf.as_mut_ptr(), buf.len()) }
-    } else {
-        -9  // EBADF
+    match uart_file_dev(file) {
+        Some(dev) if dev.dev_type == CharDevType::UartConsole => {
+            tty::tty_read(buf, (file.flags.bits() & FileFlags::O_NONBLOCK) != 0)
+        }
+        Some(dev) => unsafe { dev.read(buf.as_mut_ptr(), buf.len()) },
+        None => -9,  // EBADF
     }
 }
 
 fn uart_file_write(file: &crate::fs::File, buf: &[u8]) -> isize {
-    if let Some(priv_data) = unsafe { *file.private_data.get() } {
-        let char_dev = unsafe { &*(priv_data as *const CharDev) };
-        unsafe { char_dev.write(buf.as_ptr(), buf.len()) }
+    match uart_file_dev(file) {
+        Some(dev) if dev.dev_type == CharDevType::UartConsole => {
+            tty::tty_write(buf, (file.flags.bits() & FileFlags::O_NONBLOCK) != 0)
+        }
+        Some(dev) => unsafe { dev.write(buf.as_ptr(), buf.len()) },
+        None => -9,  // EBADF
+    }
+}
+
+/// 有输入时可读，发送缓冲区有空间时可写
+fn uart_file_poll(file: &File, pt: Option<&mut PollTable>) -> u32 {
+    match uart_file_dev(file) {
+        Some(dev) if dev.dev_type == CharDevType::UartConsole => tty::tty_poll(pt),
+        _ => POLLERR,
+    }
+}
+
+/// 文件是否为串口终端，termios 类 ioctl 只对它生效
+pub fn is_uart_file(file: &File) -> bool {
+    unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &UART_OPS))
+}
+
+/// 输入事件设备节点
+pub const EVDEV_PATH: &str = "/dev/input/event0";
+
+/// 输入事件设备号 (INPUT_MAJOR 13, EVDEV_MINOR_BASE 64)
+const EVDEV_RDEV: u64 = 0x0d40;
+
+/// 统计页设备号 (MISC_MAJOR 10, 次设备号 240)
+const KSTATS_RDEV: u64 = 0x0af0;
+
+/// 打开字符设备节点
+///
+/// 路径不是字符设备时返回 None，由调用方继续在文件系统中查找
+pub fn char_dev_open(path: &str, flags: u32) -> Option<Result<usize, i32>> {
+    match path {
+        EVDEV_PATH => Some(evdev_open(flags)),
+        KSTATS_PATH => Some(kstats_open(flags)),
+        _ => None,
+    }
+}
+
+/// 安装新文件的描述符，表满时释放文件
+fn install_char_dev_file(file: Arc<File>, flags: u32) -> Result<usize, i32> {
+    if flags & FileFlags::O_CLOEXEC != 0 {
+        file.set_cloexec(true);
+    }
+    match unsafe { get_file_fd_install(file.clone()) } {
+        Some(fd) => Ok(fd),
+        None => {
+            fput(file);
+            Err(-24)  // EMFILE
+        }
+    }
+}
+
+/// 创建输入事件设备文件，每个文件一个客户端 (evdev_open)
+pub fn evdev_create_file(flags: u32) -> Arc<File> {
+    let file = Arc::new(File::new(FileFlags::new(flags & !FileFlags::O_CLOEXEC)));
+    file.set_ops(&EVDEV_OPS);
+    file.set_private_data(Arc::into_raw(evdev::evdev_attach()) as *mut u8);
+    file
+}
+
+fn evdev_open(flags: u32) -> Result<usize, i32> {
+    install_char_dev_file(evdev_create_file(flags), flags)
+}
+
+fn file_evdev(file: &File) -> Option<&EvdevClient> {
+    let is_evdev = unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &EVDEV_OPS));
+    if !is_evdev {
+        return None;
+    }
+    unsafe { *file.private_data.get() }.map(|ptr| unsafe { &*(ptr as *const EvdevClient) })
+}
+
+/// 读取输入事件，一次返回缓冲区能容纳的所有完整事件 (evdev_read)
+///
+/// 缓冲区不足一个事件返回 EINVAL；没有事件时阻塞，非阻塞模式返回 EAGAIN
+fn evdev_read(file: &File, buf: &mut [u8]) -> isize {
+    let client = match file_evdev(file) {
+        Some(client) => client,
+        None => return -9,  // EBADF
+    };
+    let size = core::mem::size_of::<RawInputEvent>();
+    if buf.len() < size {
+        return -22;  // EINVAL
+    }
+    let nonblock = (file.flags.bits() & FileFlags::O_NONBLOCK) != 0;
+    loop {
+        let events = client.fetch(buf.len() / size);
+        if !events.is_empty() {
+            let bytes = unsafe { core::slice::from_raw_parts(events.as_ptr() as *const u8, events.len() * size) };
+            buf[..bytes.len()].copy_from_slice(bytes);
+            return bytes.len() as isize;
+        }
+        if nonblock {
+            return -11;  // EAGAIN
+        }
+        if crate::signal::signal_pending() {
+            return -4;  // EINTR
+        }
+        if !pipe_wait(&EVDEV_WQ, || client.has_events()) {
+            return -11;  // EAGAIN
+        }
+    }
+}
+
+/// 有事件时可读 (evdev_poll)
+fn evdev_poll(file: &File, pt: Option<&mut PollTable>) -> u32 {
+    let client = match file_evdev(file) {
+        Some(client) => client,
+        None => return POLLERR,
+    };
+    poll_wait(&EVDEV_WQ, pt);
+    if client.has_events() {
+        POLLIN | POLLRDNORM
     } else {
-        -9  // EBADF
+        0
+    }
+}
+
+fn evdev_release(file: &File) -> i32 {
+    let ptr = match unsafe { (*file.private_data.get()).take() } {
+        Some(ptr) => ptr,
+        None => return -9,  // EBADF
+    };
+    let client = unsafe { Arc::from_raw(ptr as *const EvdevClient) };
+    evdev::evdev_detach(&client);
+    0
+}
+
+/// 输入事件设备的文件操作
+pub static EVDEV_OPS: FileOps = FileOps {
+    read: Some(evdev_read),
+    write: None,
+    lseek: None,
+    close: Some(evdev_release),
+    read_iter: None,
+    write_iter: None,
+    poll: Some(evdev_poll),
+};
+
+/// 打开统计页，只允许只读打开
+fn kstats_open(flags: u32) -> Result<usize, i32> {
+    if !FileFlags::new(flags).is_readonly() {
+        return Err(-13);  // EACCES
+    }
+    let file = Arc::new(File::new(FileFlags::new(flags & !FileFlags::O_CLOEXEC)));
+    file.set_ops(&KSTATS_OPS);
+    install_char_dev_file(file, flags)
+}
+
+/// 文件是否为 /dev/kstats
+pub fn is_kstats_file(file: &File) -> bool {
+    unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &KSTATS_OPS))
+}
+
+/// 从文件位置读取统计页的一致快照
+fn kstats_file_read(file: &File, buf: &mut [u8]) -> isize {
+    let pos = file.get_pos();
+    let n = crate::kstats::kstats_read(buf, pos);
+    file.set_pos(pos + n as u64);
+    n as isize
+}
+
+/// 从指定位置读取，供 pread/preadv 使用
+fn kstats_file_read_iter(_file: &File, iov: &mut [&mut [u8]], pos: u64) -> isize {
+    let mut total = 0;
+    for buf in iov.iter_mut() {
+        let n = crate::kstats::kstats_read(buf, pos + total as u64);
+        total += n;
+        if n < buf.len() {
+            break;
+        }
     }
+    total as isize
 }
 
+/// 定位，文件大小为一页
+fn kstats_file_lseek(file: &File, offset: isize, whence: i32) -> isize {
+    let new_pos = match whence {
+        0 => offset,                             // SEEK_SET
+        1 => file.get_pos() as isize + offset,   // SEEK_CUR
+        2 => 4096 + offset,                      // SEEK_END
+        _ => return -22,                         // EINVAL
+    };
+    if new_pos < 0 {
+        return -22;  // EINVAL
+    }
+    file.set_pos(new_pos as u64);
+    new_pos
+}
+
+/// 统计页的文件操作；映射见 kstats::kstats_mmap
+pub static KSTATS_OPS: FileOps = FileOps {
+    read: Some(kstats_file_read),
+    write: None,
+    lseek: Some(kstats_file_lseek),
+    close: None,
+    read_iter: Some(kstats_file_read_iter),
+    write_iter: None,
+    poll: None,
+};
+
 /// 检查文件是否为字符设备并填充 stat 结构
 ///
 /// 返回 Some(()) 如果是字符设备，None 如果不是
@@ -127,6 +312,16 @@ pub fn char_dev_stat(file: &crate::fs::File, stat: &mut crate::fs::Stat) -> Opti
             let ops_ptr = *ops as *const crate::fs::FileOps;
             let uart_ops_ptr = &UART_OPS as *const crate::fs::FileOps;
 
+            if core::ptr::eq(ops_ptr, &EVDEV_OPS) {
+                evdev_stat(stat);
+                return Some(());
+            }
+
+            if core::ptr::eq(ops_ptr, &KSTATS_OPS) {
+                kstats_stat(stat);
+                return Some(());
+            }
+
             if ops_ptr == uart_ops_ptr {
                 // 这是 UART 字符设备
                 stat.st_dev = 0;
@@ -152,3 +347,42 @@ pub fn char_dev_stat(file: &crate::fs::File, stat: &mut crate::fs::Stat) -> Opti
     }
     None
 }
+
+/// 按路径获取字符设备节点的状态，不打开设备
+///
+/// # 返回
+/// 路径不是字符设备节点时返回 None
+pub fn char_dev_path_stat(path: &str, stat: &mut crate::fs::Stat) -> Option<()> {
+    match path {
+        EVDEV_PATH => {
+            evdev_stat(stat);
+            Some(())
+        }
+        KSTATS_PATH => {
+            kstats_stat(stat);
+            Some(())
+        }
+        _ => None,
+    }
+}
+
+/// evdev 节点的状态
+fn evdev_stat(stat: &mut crate::fs::Stat) {
+    *stat = crate::fs::Stat::default();
+    stat.st_nlink = 1;
+    stat.st_rdev = EVDEV_RDEV;
+    stat.st_blksize = 1024;
+    stat.set_char_device();
+    stat.set_mode(0o660);  // crw-rw----
+}
+
+/// 统计页节点的状态
+fn kstats_stat(stat: &mut crate::fs::Stat) {
+    *stat = crate::fs::Stat::default();
+    stat.st_nlink = 1;
+    stat.st_rdev = KSTATS_RDEV;
+    stat.st_size = 4096;
+    stat.st_blksize = 4096;
+    stat.set_char_device();
+    stat.set_mode(0o444);  // cr--r--r--
+}
@@ -8,13 +8,17 @@
 //! 核心概念：
 //! - `struct dentry`: 目录项，表示目录中的一个条目
 //! - `dcache`: 目录项缓存，加速路径查找
-//! - `LRU`: 最近最少使用淘汰策略
+//! - 负目录项 (negative dentry)：记录查找失败的名字，重复查找不存在的文件不再访问文件系统
+//! - 淘汰：CLOCK 近似 LRU，被访问的条目多保留一轮
 
+use alloc::boxed::Box;
 use alloc::sync::Arc;
 use alloc::string::String;
-use alloc::borrow::ToOwned;
+use alloc::vec::Vec;
 use spin::Mutex;
-use core::sync::atomic::{AtomicU64, Ordering};
+use crate::sync::RwLock;
+use core::any::Any;
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
 use crate::fs::inode::Inode;
 
 /// Dentry 状态标志
@@ -32,6 +36,8 @@ impl DentryFlags {
     pub const DCACHE_REFERENCED: u32 = 0x00000010;
     /// 目录项已删除
     pub const DCACHE_DENTRY_KILL: u32 = 0x00000040;
+    /// 负目录项：名字在父目录中不存在
+    pub const DCACHE_NEGATIVE: u32 = 0x00100000;
 
     pub fn new(flags: u32) -> Self {
         Self(flags)
@@ -63,12 +69,48 @@ pub enum DentryState {
     DKill,
 }
 
+/// 短名字直接存放在 dentry 中的长度上限 (DNAME_INLINE_LEN)
+pub const DNAME_INLINE_LEN: usize = 32;
+
+/// 目录项名称 (struct qstr + d_iname)
+///
+/// 名字创建后不再改变，短名字内联存放，查找时不需要加锁也不需要复制
+pub enum DName {
+    Inline { len: u8, buf: [u8; DNAME_INLINE_LEN] },
+    Heap(Box<[u8]>),
+}
+
+impl DName {
+    pub fn new(name: &[u8]) -> Self {
+        if name.len() <= DNAME_INLINE_LEN {
+            let mut buf = [0u8; DNAME_INLINE_LEN];
+            buf[..name.len()].copy_from_slice(name);
+            DName::Inline { len: name.len() as u8, buf }
+        } else {
+            DName::Heap(name.into())
+        }
+    }
+
+    #[inline]
+    pub fn as_bytes(&self) -> &[u8] {
+        match self {
+            DName::Inline { len, buf } => &buf[..*len as usize],
+            DName::Heap(name) => name,
+        }
+    }
+
+    #[inline]
+    pub fn as_str(&self) -> &str {
+        unsafe { core::str::from_utf8_unchecked(self.as_bytes()) }
+    }
+}
+
 /// 目录项
 ///
 #[repr(C)]
 pub struct Dentry {
     /// dentry 名称
-    pub name: Mutex<String>,
+    pub name: DName,
     /// 父目录项
     pub parent: Mutex<Option<Arc<Dentry>>>,
     /// 关联的 inode
@@ -77,6 +119,10 @@ pub struct Dentry {
     pub state: Mutex<DentryState>,
     /// dentry 标志
     pub flags: Mutex<DentryFlags>,
+    /// 目标 inode 编号（正目录项）
+    pub d_ino: u64,
+    /// 文件系统私有数据，路径查找命中时由它直接得到目标节点 (d_fsdata)
+    pub d_fsdata: Option<Arc<dyn Any + Send + Sync>>,
     /// 引用计数
     ref_count: AtomicU64,
 }
@@ -87,16 +133,31 @@ unsafe impl Sync for Dentry {}
 impl Dentry {
     /// 创建新的 dentry
     pub fn new(name: String) -> Self {
+        Self::from_name(name.as_bytes())
+    }
+
+    /// 由名字创建 dentry，短名字不分配内存 (d_alloc)
+    pub fn from_name(name: &[u8]) -> Self {
         Self {
-            name: Mutex::new(name),
+            name: DName::new(name),
             parent: Mutex::new(None),
             inode: Mutex::new(None),
             state: Mutex::new(DentryState::DUnhashed),
             flags: Mutex::new(DentryFlags::new(DentryFlags::DCACHE_UNHASHED)),
+            d_ino: 0,
+            d_fsdata: None,
             ref_count: AtomicU64::new(1),
         }
     }
 
+    /// 创建指向 ino 的正目录项 (d_alloc + d_instantiate)
+    pub fn new_positive(name: &[u8], ino: u64, fsdata: Option<Arc<dyn Any + Send + Sync>>) -> Self {
+        let mut dentry = Self::from_name(name);
+        dentry.d_ino = ino;
+        dentry.d_fsdata = fsdata;
+        dentry
+    }
+
     /// 设置父目录项
     pub fn set_parent(&self, parent: Arc<Dentry>) {
         *self.parent.lock() = Some(parent);
@@ -115,8 +176,21 @@ impl Dentry {
     }
 
     /// 获取名称
-    pub fn get_name(&self) -> String {
-        self.name.lock().clone()
+    #[inline]
+    pub fn name(&self) -> &str {
+        self.name.as_str()
+    }
+
+    /// 创建负目录项 (d_add(dentry, NULL))
+    pub fn new_negative(name: &[u8]) -> Self {
+        let dentry = Self::from_name(name);
+        *dentry.flags.lock() = DentryFlags::new(DentryFlags::DCACHE_UNHASHED | DentryFlags::DCACHE_NEGATIVE);
+        dentry
+    }
+
+    /// 是否为负目录项 (d_is_negative)
+    pub fn is_negative(&self) -> bool {
+        (self.flags.lock().bits() & DentryFlags::DCACHE_NEGATIVE) != 0
     }
 
     /// 设置为已哈希状态
@@ -151,7 +225,7 @@ impl Dentry {
 
 /// 创建根目录项
 pub fn make_root_dentry() -> Option<Arc<Dentry>> {
-    let dentry = Arc::new(Dentry::new("/".to_owned()));
+    let dentry = Arc::new(Dentry::from_name(b"/"));
     // Note: Arc returns &T when dereferenced
     // For now, we'll return the Arc directly - the caller can call set_hashed if needed
     Some(dentry)
@@ -160,9 +234,25 @@ pub fn make_root_dentry() -> Option<Arc<Dentry>> {
 // ============================================================================
 // Dentry 缓存 (dcache)
 // ============================================================================
+//
+// 参考 Linux: fs/dcache.c (d_hash, d_lookup, prune_dcache_sb)
+//
+// - 以 (父目录 inode, 名字) 的哈希分桶，每个桶一把锁，不同目录分量的查找互不阻塞
+// - 桶数组在条目数超过桶数的 DCACHE_LOAD_FACTOR 倍时加倍；读者只持有表的读锁，
+//   只有扩容时才取写锁
+// - 条目数超过 DCACHE_MAX_ENTRIES 时按 CLOCK 顺序淘汰：最近被访问过的条目清除访问位后保留
+
+/// 初始桶数
+const DCACHE_INITIAL_BUCKETS: usize = 256;
+
+/// 最大桶数
+const DCACHE_MAX_BUCKETS: usize = 1 << 16;
 
-/// Dentry 缓存大小
-const DCACHE_SIZE: usize = 256;
+/// 平均每桶条目数超过它时扩容
+const DCACHE_LOAD_FACTOR: usize = 2;
+
+/// 缓存的条目上限，超出后淘汰
+const DCACHE_MAX_ENTRIES: usize = 32768;
 
 /// Dentry 缓存统计信息
 #[derive(Debug)]
@@ -173,14 +263,17 @@ pub struct DentryCacheStats {
     pub misses: AtomicU64,
     /// 淘汰次数
     pub evictions: AtomicU64,
+    /// 命中负目录项的次数
+    pub negative_hits: AtomicU64,
 }
 
 impl DentryCacheStats {
-    pub fn new() -> Self {
+    pub const fn new() -> Self {
         Self {
             hits: AtomicU64::new(0),
             misses: AtomicU64::new(0),
             evictions: AtomicU64::new(0),
+            negative_hits: AtomicU64::new(0),
         }
     }
 
@@ -208,70 +301,52 @@ impl DentryCacheStats {
     }
 }
 
-/// 哈希表桶
-struct DentryHashBucket {
-    /// dentry 指针
-    dentry: Option<Arc<Dentry>>,
-    /// 哈希键（用于快速比较）
+/// 哈希桶中的一个条目
+struct DentryHashEntry {
+    /// 完整哈希值（用于快速比较）
     key: u64,
-    /// LRU 时间戳（用于淘汰）
-    access_time: AtomicU64,
-}
-
-impl Clone for DentryHashBucket {
-    fn clone(&self) -> Self {
-        Self {
-            dentry: self.dentry.clone(),
-            key: self.key,
-            access_time: AtomicU64::new(self.access_time.load(Ordering::Relaxed)),
-        }
-    }
+    /// 父目录 inode 编号
+    parent_ino: u64,
+    dentry: Arc<Dentry>,
+    /// CLOCK 访问位
+    referenced: AtomicBool,
 }
 
-/// Dentry 哈希表
+/// Dentry 哈希表 (dentry_hashtable)
 struct DentryCache {
-    /// 哈希表
-    buckets: [DentryHashBucket; DCACHE_SIZE],
-    /// 缓存中的条目数量
-    count: usize,
-    /// 全局时间戳（用于 LRU）
-    global_time: AtomicU64,
-    /// 统计信息
-    stats: DentryCacheStats,
+    /// 哈希桶，个数为 2 的幂
+    buckets: Vec<Mutex<Vec<DentryHashEntry>>>,
 }
 
 unsafe impl Send for DentryCache {}
 unsafe impl Sync for DentryCache {}
 
+impl DentryCache {
+    #[inline]
+    fn bucket(&self, hash: u64) -> &Mutex<Vec<DentryHashEntry>> {
+        &self.buckets[(hash as usize) & (self.buckets.len() - 1)]
+    }
+}
+
 /// 全局 Dentry 缓存
-static DCACHE: spin::Mutex<Option<DentryCache>> = spin::Mutex::new(None);
+static DCACHE: RwLock<DentryCache> = RwLock::new(DentryCache { buckets: Vec::new() });
 
-/// 初始化 Dentry 缓存
-fn dcache_init() {
-    let mut cache = DCACHE.lock();
-    if cache.is_some() {
-        return;  // 已经初始化
-    }
+/// 缓存中的条目数
+static DCACHE_COUNT: AtomicUsize = AtomicUsize::new(0);
 
-    // 创建空桶数组
-    let buckets: [DentryHashBucket; DCACHE_SIZE] = core::array::from_fn(|_| DentryHashBucket {
-        dentry: None,
-        key: 0,
-        access_time: AtomicU64::new(0),
-    });
+/// 负目录项数
+static DCACHE_NEGATIVE_COUNT: AtomicUsize = AtomicUsize::new(0);
 
-    *cache = Some(DentryCache {
-        buckets,
-        count: 0,
-        global_time: AtomicU64::new(1),
-        stats: DentryCacheStats::new(),
-    });
-}
+/// CLOCK 指针：下一次淘汰从这个桶开始扫描
+static DCACHE_CLOCK: AtomicUsize = AtomicUsize::new(0);
+
+/// 统计信息
+static DCACHE_STATS: DentryCacheStats = DentryCacheStats::new();
 
 /// 计算哈希值
 ///
 /// 使用简单的 FNV-1a 哈希算法
-fn dentry_hash(name: &str, parent_ino: u64) -> u64 {
+fn dentry_hash(name: &[u8], parent_ino: u64) -> u64 {
     let mut hash = 0xcbf29ce484222325_u64;  // FNV offset basis
 
     // 混合父 inode 编号
@@ -279,7 +354,7 @@ fn dentry_hash(name: &str, parent_ino: u64) -> u64 {
     hash = hash.wrapping_mul(0x100000001b3);
 
     // 混合名称
-    for byte in name.bytes() {
+    for &byte in name {
         hash ^= byte as u64;
         hash = hash.wrapping_mul(0x100000001b3);
     }
@@ -287,198 +362,231 @@ fn dentry_hash(name: &str, parent_ino: u64) -> u64 {
     hash
 }
 
-/// 在 Dentry 缓存中查找
-///
-pub fn dcache_lookup(name: &str, parent_ino: u64) -> Option<Arc<Dentry>> {
-    // 确保缓存已初始化
-    dcache_init();
-
-    let mut cache = DCACHE.lock();
-    let cache_inner = cache.as_mut()?;
-
-    // 计算哈希值
-    let hash = dentry_hash(name, parent_ino);
-    let index = (hash as usize) % DCACHE_SIZE;
-
-    // 查找匹配的条目
-    let bucket = &cache_inner.buckets[index];
+/// 桶数组加倍，或在第一次使用时建立 (d_hash 表的扩容)
+fn dcache_grow() {
+    let mut cache = DCACHE.write();
+    let old_len = cache.buckets.len();
+    let count = DCACHE_COUNT.load(Ordering::Relaxed);
+    // 其他 CPU 可能已经扩容
+    if old_len != 0 && (count <= old_len * DCACHE_LOAD_FACTOR || old_len >= DCACHE_MAX_BUCKETS) {
+        return;
+    }
+    let new_len = if old_len == 0 { DCACHE_INITIAL_BUCKETS } else { old_len * 2 };
 
-    if let Some(ref dentry) = bucket.dentry {
-        // 比较哈希键
-        if bucket.key == hash {
-            // 比较名称
-            if dentry.name.lock().as_str() == name {
-                // 更新访问时间（用于 LRU）
-                let current_time = cache_inner.global_time.fetch_add(1, Ordering::Relaxed);
-                bucket.access_time.store(current_time, Ordering::Relaxed);
+    let mut buckets: Vec<Mutex<Vec<DentryHashEntry>>> = Vec::with_capacity(new_len);
+    buckets.resize_with(new_len, || Mutex::new(Vec::new()));
+    for old in cache.buckets.drain(..) {
+        for entry in old.into_inner() {
+            buckets[(entry.key as usize) & (new_len - 1)].get_mut().push(entry);
+        }
+    }
+    cache.buckets = buckets;
+}
 
-                // 记录命中
-                cache_inner.stats.record_hit();
+/// 在 Dentry 缓存中查找 (d_lookup)
+///
+/// 返回的也可能是负目录项，调用者用 is_negative 区分
+pub fn dcache_lookup(name: &str, parent_ino: u64) -> Option<Arc<Dentry>> {
+    let hash = dentry_hash(name.as_bytes(), parent_ino);
+    let cache = DCACHE.read();
+    if cache.buckets.is_empty() {
+        DCACHE_STATS.record_miss();
+        return None;
+    }
 
-                return Some(dentry.clone());
+    let bucket = cache.bucket(hash).lock();
+    let found = bucket.iter().find(|e| {
+        e.key == hash && e.parent_ino == parent_ino && e.dentry.name.as_bytes() == name.as_bytes()
+    });
+    match found {
+        Some(entry) => {
+            entry.referenced.store(true, Ordering::Relaxed);
+            DCACHE_STATS.record_hit();
+            if entry.dentry.is_negative() {
+                DCACHE_STATS.negative_hits.fetch_add(1, Ordering::Relaxed);
             }
+            Some(entry.dentry.clone())
+        }
+        None => {
+            DCACHE_STATS.record_miss();
+            None
         }
     }
-
-    // 记录未命中
-    cache_inner.stats.record_miss();
-
-    None
 }
 
-/// 将 Dentry 添加到缓存
+/// 将 Dentry 添加到缓存 (d_add)
 ///
+/// 同名条目已存在时替换它（例如负目录项在文件创建后换成正目录项）
 pub fn dcache_add(dentry: Arc<Dentry>, parent_ino: u64) {
-    // 确保缓存已初始化
-    dcache_init();
-
-    // 计算哈希值（在缓存锁外进行）
-    let name = dentry.name.lock();
-    let name_str = name.clone();
-    drop(name);  // 释放 name 锁
-    let hash = dentry_hash(&name_str, parent_ino);
-
-    let mut cache = DCACHE.lock();
-    let inner = cache.as_mut().expect("dcache not initialized");
-
-    let index = (hash as usize) % DCACHE_SIZE;
-
-    // 检查是否已存在
-    if let Some(ref _existing) = inner.buckets[index].dentry {
-        if inner.buckets[index].key == hash {
-            return;  // 已经在缓存中
+    let hash = dentry_hash(dentry.name.as_bytes(), parent_ino);
+    let negative = dentry.is_negative();
+
+    loop {
+        let count = DCACHE_COUNT.load(Ordering::Relaxed);
+        let nr_buckets = DCACHE.read().buckets.len();
+        if nr_buckets == 0
+            || (count > nr_buckets * DCACHE_LOAD_FACTOR && nr_buckets < DCACHE_MAX_BUCKETS)
+        {
+            dcache_grow();
+        }
+        if count >= DCACHE_MAX_ENTRIES {
+            dcache_shrink(count + 1 - DCACHE_MAX_ENTRIES);
         }
 
-        // 使用 LRU 策略：查找并淘汰最久未使用的条目
-        dcache_evict_lru(inner);
+        let cache = DCACHE.read();
+        if cache.buckets.is_empty() {
+            drop(cache);
+            continue;
+        }
+        let mut bucket = cache.bucket(hash).lock();
+        let existing = bucket.iter().position(|e| {
+            e.key == hash && e.parent_ino == parent_ino && e.dentry.name.as_bytes() == dentry.name.as_bytes()
+        });
+        if let Some(pos) = existing {
+            let old = bucket.swap_remove(pos);
+            if Arc::ptr_eq(&old.dentry, &dentry) {
+                bucket.push(old);
+                return;  // 已经在缓存中
+            }
+            old.dentry.set_unhashed();
+            DCACHE_COUNT.fetch_sub(1, Ordering::Relaxed);
+            if old.dentry.is_negative() {
+                DCACHE_NEGATIVE_COUNT.fetch_sub(1, Ordering::Relaxed);
+            }
+        }
+        bucket.push(DentryHashEntry {
+            key: hash,
+            parent_ino,
+            dentry: dentry.clone(),
+            referenced: AtomicBool::new(false),
+        });
+        DCACHE_COUNT.fetch_add(1, Ordering::Relaxed);
+        if negative {
+            DCACHE_NEGATIVE_COUNT.fetch_add(1, Ordering::Relaxed);
+        }
+        drop(bucket);
+        drop(cache);
+        dentry.set_hashed();
+        return;
     }
+}
 
-    // 获取当前时间戳
-    let current_time = inner.global_time.fetch_add(1, Ordering::Relaxed);
-
-    // 添加到缓存
-    inner.buckets[index] = DentryHashBucket {
-        dentry: Some(dentry.clone()),
-        key: hash,
-        access_time: AtomicU64::new(current_time),
-    };
-    inner.count += 1;
+/// 记录查找失败的名字 (d_add 负目录项)
+pub fn dcache_add_negative(name: &str, parent_ino: u64) {
+    dcache_add(Arc::new(Dentry::new_negative(name.as_bytes())), parent_ino);
+}
 
-    // 标记为已哈希（在缓存锁外进行）
-    drop(cache);  // 释放缓存锁
-    dentry.set_hashed();
+/// 从桶中移除条目并更新计数
+fn dcache_unhash(bucket: &mut Vec<DentryHashEntry>, pos: usize) {
+    let entry = bucket.swap_remove(pos);
+    entry.dentry.set_unhashed();
+    DCACHE_COUNT.fetch_sub(1, Ordering::Relaxed);
+    if entry.dentry.is_negative() {
+        DCACHE_NEGATIVE_COUNT.fetch_sub(1, Ordering::Relaxed);
+    }
 }
 
-/// LRU 淘汰策略：淘汰最久未使用的条目
+/// 从 Dentry 缓存中删除 (d_drop)
 ///
-fn dcache_evict_lru(cache: &mut DentryCache) {
-    // 查找最久未使用的条目（最小访问时间）
-    let mut lru_index = 0;
-    let mut lru_time = u64::MAX;
-    let mut found = false;
-
-    for (i, bucket) in cache.buckets.iter().enumerate() {
-        if bucket.dentry.is_some() {
-            let access_time = bucket.access_time.load(Ordering::Relaxed);
-            if access_time < lru_time {
-                lru_time = access_time;
-                lru_index = i;
-                found = true;
-            }
-        }
+pub fn dcache_remove(name: &str, parent_ino: u64) {
+    let hash = dentry_hash(name.as_bytes(), parent_ino);
+    let cache = DCACHE.read();
+    if cache.buckets.is_empty() {
+        return;
     }
-
-    // 淘汰 LRU 条目
-    if found {
-        if let Some(ref dentry) = cache.buckets[lru_index].dentry {
-            // 标记为未哈希
-            dentry.set_unhashed();
-        }
-
-        cache.buckets[lru_index].dentry = None;
-        cache.buckets[lru_index].key = 0;
-        cache.buckets[lru_index].access_time.store(0, Ordering::Relaxed);
-        cache.count -= 1;
-
-        // 记录淘汰
-        cache.stats.record_eviction();
+    let mut bucket = cache.bucket(hash).lock();
+    if let Some(pos) = bucket.iter().position(|e| {
+        e.key == hash && e.parent_ino == parent_ino && e.dentry.name.as_bytes() == name.as_bytes()
+    }) {
+        dcache_unhash(&mut bucket, pos);
     }
 }
 
-/// 从 Dentry 缓存中删除
+/// 按 CLOCK 顺序淘汰最多 nr 个条目（页回收的收缩器，prune_dcache_sb）
 ///
-pub fn dcache_remove(name: &str, parent_ino: u64) {
-    // 确保缓存已初始化
-    dcache_init();
-
-    let mut cache = DCACHE.lock();
-    let inner = cache.as_mut().expect("dcache not initialized");
-
-    // 计算哈希值
-    let hash = dentry_hash(name, parent_ino);
-    let index = (hash as usize) % DCACHE_SIZE;
-
-    // 删除条目
-    if let Some(ref dentry) = inner.buckets[index].dentry {
-        if inner.buckets[index].key == hash {
-            // 标记为未哈希
-            dentry.set_unhashed();
-
-            // 从缓存中移除
-            inner.buckets[index].dentry = None;
-            inner.buckets[index].key = 0;
-            inner.buckets[index].access_time.store(0, Ordering::Relaxed);
-            inner.count -= 1;
+/// 被淘汰的 dentry 只失去缓存的引用，仍在使用的 dentry 不受影响。
+/// 回收可能发生在持有 dcache 锁的分配路径中，拿不到锁时跳过
+///
+/// # 返回
+/// 淘汰的条目数
+pub fn dcache_shrink(nr: usize) -> usize {
+    let cache = match DCACHE.try_read() {
+        Some(cache) => cache,
+        None => return 0,
+    };
+    let nr_buckets = cache.buckets.len();
+    if nr_buckets == 0 {
+        return 0;
+    }
+
+    // 最多扫两圈：第一圈清除访问位，第二圈淘汰
+    let mut freed = 0;
+    for _ in 0..nr_buckets * 2 {
+        if freed >= nr || DCACHE_COUNT.load(Ordering::Relaxed) == 0 {
+            break;
+        }
+        let index = DCACHE_CLOCK.fetch_add(1, Ordering::Relaxed) & (nr_buckets - 1);
+        let mut bucket = match cache.buckets[index].try_lock() {
+            Some(bucket) => bucket,
+            None => continue,
+        };
+        let mut pos = 0;
+        while pos < bucket.len() && freed < nr {
+            if bucket[pos].referenced.swap(false, Ordering::Relaxed) {
+                pos += 1;
+                continue;
+            }
+            dcache_unhash(&mut bucket, pos);
+            DCACHE_STATS.record_eviction();
+            freed += 1;
         }
     }
+    freed
 }
 
 /// 获取缓存统计信息
+///
+/// # 返回
+/// (条目数, 条目上限)
 pub fn dcache_stats() -> (usize, usize) {
-    // 确保缓存已初始化
-    dcache_init();
-
-    let cache = DCACHE.lock();
-    let cache_inner = cache.as_ref().expect("dcache not initialized");
-
-    (cache_inner.count, DCACHE_SIZE)
+    (DCACHE_COUNT.load(Ordering::Relaxed), DCACHE_MAX_ENTRIES)
 }
 
 /// 获取详细的缓存统计信息
 pub fn dcache_stats_detailed() -> (u64, u64, u64, f64) {
-    // 确保缓存已初始化
-    dcache_init();
-
-    let cache = DCACHE.lock();
-    let cache_inner = cache.as_ref().expect("dcache not initialized");
+    (
+        DCACHE_STATS.hits.load(Ordering::Relaxed),
+        DCACHE_STATS.misses.load(Ordering::Relaxed),
+        DCACHE_STATS.evictions.load(Ordering::Relaxed),
+        DCACHE_STATS.get_hit_rate(),
+    )
+}
 
+/// 负目录项统计
+///
+/// # 返回
+/// (负目录项数, 命中负目录项的次数)
+pub fn dcache_negative_stats() -> (usize, u64) {
     (
-        cache_inner.stats.hits.load(Ordering::Relaxed),
-        cache_inner.stats.misses.load(Ordering::Relaxed),
-        cache_inner.stats.evictions.load(Ordering::Relaxed),
-        cache_inner.stats.get_hit_rate(),
+        DCACHE_NEGATIVE_COUNT.load(Ordering::Relaxed),
+        DCACHE_STATS.negative_hits.load(Ordering::Relaxed),
     )
 }
 
+/// 当前桶数
+pub fn dcache_nr_buckets() -> usize {
+    DCACHE.read().buckets.len()
+}
+
 /// 清空 Dentry 缓存
 ///
 pub fn dcache_flush() {
-    // 确保缓存已初始化
-    dcache_init();
-
-    let mut cache = DCACHE.lock();
-    let inner = cache.as_mut().expect("dcache not initialized");
-
-    // 清空所有桶
-    for bucket in inner.buckets.iter_mut() {
-        if let Some(ref dentry) = bucket.dentry {
-            // 标记为未哈希
-            dentry.set_unhashed();
+    let cache = DCACHE.read();
+    for bucket in cache.buckets.iter() {
+        let mut bucket = bucket.lock();
+        while !bucket.is_empty() {
+            let last = bucket.len() - 1;
+            dcache_unhash(&mut bucket, last);
         }
-        bucket.dentry = None;
-        bucket.key = 0;
-        bucket.access_time.store(0, Ordering::Relaxed);
     }
-
-    inner.count = 0;
 }
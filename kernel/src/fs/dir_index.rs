@@ -0,0 +1,133 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内存文件系统目录的子节点索引
+//!
+//! 子节点按插入顺序保存在向量中，readdir 的位置就是下标；子节点超过
+//! DIR_INDEX_THRESHOLD 个时另建一张开放寻址的名字哈希表，
+//! /bin 中几百个 toybox 链接的查找不再逐个比较名字。
+//! 删除与改名很少发生，直接重建哈希表
+
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+
+/// 子节点多于这个数目时建立哈希表，更小的目录线性比较更快
+pub const DIR_INDEX_THRESHOLD: usize = 16;
+
+/// 空槽
+const EMPTY: u32 = u32::MAX;
+
+/// 可以按名字索引的目录项
+pub trait DirEntryName {
+    fn entry_name(&self) -> &[u8];
+}
+
+/// 目录的子节点
+pub struct ChildIndex<T> {
+    /// 按插入顺序排列的子节点
+    entries: Vec<Arc<T>>,
+    /// 哈希表，槽中是 entries 的下标；长度为 2 的幂且不小于子节点数的两倍，
+    /// 为空表示子节点还不多，按顺序查找
+    table: Vec<u32>,
+}
+
+/// 名字的哈希值 (FNV-1a)
+fn name_hash(name: &[u8]) -> usize {
+    let mut hash = 0xcbf29ce484222325_u64;
+    for &byte in name {
+        hash ^= byte as u64;
+        hash = hash.wrapping_mul(0x100000001b3);
+    }
+    hash as usize
+}
+
+impl<T: DirEntryName> ChildIndex<T> {
+    pub const fn new() -> Self {
+        Self { entries: Vec::new(), table: Vec::new() }
+    }
+
+    pub fn len(&self) -> usize {
+        self.entries.len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.entries.is_empty()
+    }
+
+    /// 按插入顺序遍历
+    pub fn iter(&self) -> core::slice::Iter<'_, Arc<T>> {
+        self.entries.iter()
+    }
+
+    /// 名字对应的下标
+    pub fn position(&self, name: &[u8]) -> Option<usize> {
+        if self.table.is_empty() {
+            return self.entries.iter().position(|c| c.entry_name() == name);
+        }
+        let mask = self.table.len() - 1;
+        let mut slot = name_hash(name) & mask;
+        loop {
+            let index = self.table[slot];
+            if index == EMPTY {
+                return None;
+            }
+            if self.entries[index as usize].entry_name() == name {
+                return Some(index as usize);
+            }
+            slot = (slot + 1) & mask;
+        }
+    }
+
+    /// 按名字查找
+    pub fn find(&self, name: &[u8]) -> Option<&Arc<T>> {
+        self.position(name).map(|index| &self.entries[index])
+    }
+
+    /// 追加子节点，调用者保证名字不重复
+    pub fn push(&mut self, child: Arc<T>) {
+        self.entries.push(child);
+        let len = self.entries.len();
+        if self.table.is_empty() {
+            if len > DIR_INDEX_THRESHOLD {
+                self.reindex();
+            }
+        } else if len * 2 > self.table.len() {
+            self.reindex();
+        } else {
+            self.insert_slot(len - 1);
+        }
+    }
+
+    /// 按名字删除，后面的子节点前移一位，与 readdir 位置保持一致
+    pub fn remove(&mut self, name: &[u8]) -> Option<Arc<T>> {
+        let index = self.position(name)?;
+        let child = self.entries.remove(index);
+        self.reindex();
+        Some(child)
+    }
+
+    /// 重建哈希表，子节点改名后调用
+    pub fn reindex(&mut self) {
+        let len = self.entries.len();
+        self.table.clear();
+        if len <= DIR_INDEX_THRESHOLD {
+            self.table.shrink_to_fit();
+            return;
+        }
+        self.table.resize((len * 2).next_power_of_two(), EMPTY);
+        for index in 0..len {
+            self.insert_slot(index);
+        }
+    }
+
+    fn insert_slot(&mut self, index: usize) {
+        let mask = self.table.len() - 1;
+        let mut slot = name_hash(self.entries[index].entry_name()) & mask;
+        while self.table[slot] != EMPTY {
+            slot = (slot + 1) & mask;
+        }
+        self.table[slot] = index as u32;
+    }
+}
@@ -0,0 +1,239 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! eventfd：以文件描述符表示的 64 位事件计数器
+//!
+//! write 把值加到计数器上，read 取出并清零计数器（EFD_SEMAPHORE 时每次取 1）；
+//! 计数器非零时可读，小于 EVENTFD_MAX 时可写，可以和 epoll / poll / select
+//! 一起作为线程间或内核到用户态的通知。
+//!
+//! 参考: fs/eventfd.c
+//!
+//! # 设计
+//! - 计数器是一个原子变量，read / write 用比较交换更新，不持有锁
+//! - 只有计数器从 0 变为非零时才唤醒等待队列（读者和 epoll 回调）；计数器已经非零时
+//!   不会有读者在睡眠，水平触发的 epoll 仍报告可读，连续写入不再重复唤醒
+//! - 读出使计数器离开 EVENTFD_MAX（可写状态变化）或有写者等待时才唤醒写者
+
+use alloc::sync::Arc;
+use core::sync::atomic::{fence, AtomicU32, AtomicU64, Ordering};
+
+use crate::fs::file::{poll_mask::*, File, FileFlags, FileOps};
+use crate::fs::pipe::pipe_wait;
+use crate::fs::select::{poll_wait, PollTable};
+use crate::process::wait::WaitQueueHead;
+
+const EINTR: i32 = -4;
+const EAGAIN: i32 = -11;
+const EINVAL: i32 = -22;
+
+/// 计数器的最大值 (ULLONG_MAX - 1)
+pub const EVENTFD_MAX: u64 = u64::MAX - 1;
+
+/// eventfd2 标志
+pub const EFD_SEMAPHORE: u32 = 1;
+pub const EFD_CLOEXEC: u32 = FileFlags::O_CLOEXEC;
+pub const EFD_NONBLOCK: u32 = FileFlags::O_NONBLOCK;
+
+/// eventfd 实例 (struct eventfd_ctx)
+pub struct EventFdCtx {
+    /// 读者、写者与 poll 登记的等待队列 (wqh)
+    wqh: WaitQueueHead,
+    count: AtomicU64,
+    /// 因计数器将要溢出而等待的写者数
+    writers: AtomicU32,
+    semaphore: bool,
+}
+
+impl EventFdCtx {
+    pub fn new(initval: u64, semaphore: bool) -> Self {
+        Self {
+            wqh: WaitQueueHead::new(),
+            count: AtomicU64::new(initval),
+            writers: AtomicU32::new(0),
+            semaphore,
+        }
+    }
+
+    /// 当前计数
+    pub fn count(&self) -> u64 {
+        self.count.load(Ordering::Acquire)
+    }
+
+    /// 把 n 加到计数器上，不阻塞 (eventfd_signal)
+    ///
+    /// # 返回
+    /// 计数器会超过 EVENTFD_MAX 时返回 false，计数器不变
+    pub fn try_add(&self, n: u64) -> bool {
+        let mut old = self.count.load(Ordering::Relaxed);
+        loop {
+            if n > EVENTFD_MAX - old {
+                return false;
+            }
+            match self.count.compare_exchange_weak(old, old + n, Ordering::AcqRel, Ordering::Relaxed) {
+                Ok(_) => break,
+                Err(cur) => old = cur,
+            }
+        }
+        // 计数器原来非零：等待者只可能是写者，它们等的是计数减少
+        if old == 0 && n != 0 {
+            self.wqh.wake_up_all();
+        }
+        true
+    }
+
+    /// 取出计数，不阻塞 (eventfd_ctx_do_read)
+    ///
+    /// 普通模式取出全部并清零，EFD_SEMAPHORE 模式取出 1
+    ///
+    /// # 返回
+    /// 计数器为 0 时返回 None
+    pub fn try_take(&self) -> Option<u64> {
+        let mut old = self.count.load(Ordering::Relaxed);
+        let taken = loop {
+            if old == 0 {
+                return None;
+            }
+            let taken = if self.semaphore { 1 } else { old };
+            match self.count.compare_exchange_weak(old, old - taken, Ordering::AcqRel, Ordering::Relaxed) {
+                Ok(_) => break taken,
+                Err(cur) => old = cur,
+            }
+        };
+        // 与写者登记 writers 之后检查计数配对
+        fence(Ordering::SeqCst);
+        if old == EVENTFD_MAX || self.writers.load(Ordering::Relaxed) != 0 {
+            self.wqh.wake_up_all();
+        }
+        Some(taken)
+    }
+}
+
+/// 由文件得到 eventfd 实例
+pub fn file_eventfd(file: &File) -> Option<&EventFdCtx> {
+    let is_eventfd = unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &EVENTFD_OPS));
+    if !is_eventfd {
+        return None;
+    }
+    unsafe { *file.private_data.get() }.map(|ptr| unsafe { &*(ptr as *const EventFdCtx) })
+}
+
+/// 读取计数 (eventfd_read)
+///
+/// 缓冲区不足 8 字节返回 EINVAL；计数为 0 时阻塞，非阻塞模式返回 EAGAIN
+fn eventfd_read(file: &File, buf: &mut [u8]) -> isize {
+    let ctx = match file_eventfd(file) {
+        Some(ctx) => ctx,
+        None => return EINVAL as isize,
+    };
+    if buf.len() < 8 {
+        return EINVAL as isize;
+    }
+    let nonblock = (file.flags.bits() & FileFlags::O_NONBLOCK) != 0;
+    loop {
+        if let Some(value) = ctx.try_take() {
+            buf[..8].copy_from_slice(&value.to_ne_bytes());
+            return 8;
+        }
+        if nonblock {
+            return EAGAIN as isize;
+        }
+        if crate::signal::signal_pending() {
+            return EINTR as isize;
+        }
+        if !pipe_wait(&ctx.wqh, || ctx.count() != 0) {
+            return EAGAIN as isize;
+        }
+    }
+}
+
+/// 把值加到计数器上 (eventfd_write)
+///
+/// 缓冲区不足 8 字节或值为 u64::MAX 返回 EINVAL；计数器会溢出时阻塞，
+/// 非阻塞模式返回 EAGAIN
+fn eventfd_write(file: &File, buf: &[u8]) -> isize {
+    let ctx = match file_eventfd(file) {
+        Some(ctx) => ctx,
+        None => return EINVAL as isize,
+    };
+    if buf.len() < 8 {
+        return EINVAL as isize;
+    }
+    let value = u64::from_ne_bytes(buf[..8].try_into().unwrap());
+    if value == u64::MAX {
+        return EINVAL as isize;
+    }
+    let nonblock = (file.flags.bits() & FileFlags::O_NONBLOCK) != 0;
+    loop {
+        if ctx.try_add(value) {
+            return 8;
+        }
+        if nonblock {
+            return EAGAIN as isize;
+        }
+        if crate::signal::signal_pending() {
+            return EINTR as isize;
+        }
+        ctx.writers.fetch_add(1, Ordering::SeqCst);
+        let waited = pipe_wait(&ctx.wqh, || value <= EVENTFD_MAX - ctx.count());
+        ctx.writers.fetch_sub(1, Ordering::SeqCst);
+        if !waited {
+            return EAGAIN as isize;
+        }
+    }
+}
+
+/// 计数非零时可读，小于 EVENTFD_MAX 时可写 (eventfd_poll)
+fn eventfd_poll(file: &File, pt: Option<&mut PollTable>) -> u32 {
+    let ctx = match file_eventfd(file) {
+        Some(ctx) => ctx,
+        None => return 0,
+    };
+    poll_wait(&ctx.wqh, pt);
+    let count = ctx.count();
+    let mut mask = 0;
+    if count != 0 {
+        mask |= POLLIN | POLLRDNORM;
+    }
+    if count < EVENTFD_MAX {
+        mask |= POLLOUT | POLLWRNORM;
+    }
+    mask
+}
+
+/// 关闭时释放实例 (eventfd_release)
+fn eventfd_release(file: &File) -> i32 {
+    let ptr = match unsafe { (*file.private_data.get()).take() } {
+        Some(ptr) => ptr,
+        None => return -9,  // EBADF
+    };
+    drop(unsafe { Arc::from_raw(ptr as *const EventFdCtx) });
+    0
+}
+
+static EVENTFD_OPS: FileOps = FileOps {
+    read: Some(eventfd_read),
+    write: Some(eventfd_write),
+    lseek: None,
+    close: Some(eventfd_release),
+    read_iter: None,
+    write_iter: None,
+    poll: Some(eventfd_poll),
+};
+
+/// 创建 eventfd 文件 (do_eventfd)
+///
+/// # 参数
+/// - initval: 计数器初值
+/// - flags: EFD_SEMAPHORE | EFD_CLOEXEC | EFD_NONBLOCK，CLOEXEC 由调用方在安装描述符时处理
+pub fn eventfd_create_file(initval: u32, flags: u32) -> Result<Arc<File>, i32> {
+    if flags & !(EFD_SEMAPHORE | EFD_CLOEXEC | EFD_NONBLOCK) != 0 {
+        return Err(EINVAL);
+    }
+    let ctx = Arc::new(EventFdCtx::new(initval as u64, flags & EFD_SEMAPHORE != 0));
+    let file = Arc::new(File::new(FileFlags::new(FileFlags::O_RDWR | (flags & EFD_NONBLOCK))));
+    file.set_ops(&EVENTFD_OPS);
+    file.set_private_data(Arc::into_raw(ctx) as *mut u8);
+    Ok(file)
+}
@@ -0,0 +1,538 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! epoll 事件轮询 (eventpoll)
+//!
+//! 每个被监视的文件在它的等待队列上登记一个回调项：文件就绪状态变化唤醒队列时，
+//! 回调把对应的 epitem 放入 epoll 实例的就绪链表并唤醒 epoll_wait 的等待者。
+//! epoll_wait 只处理就绪链表上的项，开销与就绪数量成正比，而不是与监视数量成正比。
+//!
+//! 参考: fs/eventpoll.c
+//!
+//! # 设计
+//! - 监视集合按 (文件, 描述符) 存放在 BTreeMap 中 (ep->rbr)
+//! - 水平触发的项报告后仍然就绪就重新放回就绪链表，边缘触发 (EPOLLET) 的项要等下一次唤醒；
+//!   EPOLLONESHOT 报告一次后禁用，EPOLL_CTL_MOD 重新启用
+//! - EPOLLEXCLUSIVE 的回调项以独占方式加入目标等待队列，并且只有真正唤醒了
+//!   epoll_wait 的等待者才算作一次唤醒，同一个文件上的多个 epoll 实例只惊醒一个
+//! - 文件的最后一个引用释放时从所有监视它的 epoll 中摘除 (eventpoll_release)
+//! - 超时按 jiffies 截止时间检查：还没有定时器唤醒，等待方被任意唤醒后重新检查
+
+use alloc::boxed::Box;
+use alloc::collections::{BTreeMap, VecDeque};
+use alloc::sync::{Arc, Weak};
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, Ordering};
+use spin::Mutex;
+
+use crate::fs::file::{fput, poll_mask, File, FileFlags, FileOps};
+use crate::fs::select::{poll_wait, vfs_poll, PollTable};
+use crate::process::task::TaskState;
+use crate::process::wait::{WaitQueueEntry, WaitQueueHead};
+use crate::time::timer::{schedule_timeout, MAX_SCHEDULE_TIMEOUT};
+
+/// epoll 事件类型
+pub mod epoll_events {
+    pub const EPOLLIN: u32 = 0x00000001;     // 可读
+    pub const EPOLLPRI: u32 = 0x00000002;    // 紧急可读
+    pub const EPOLLOUT: u32 = 0x00000004;    // 可写
+    pub const EPOLLERR: u32 = 0x00000008;    // 错误
+    pub const EPOLLHUP: u32 = 0x00000010;    // 挂断
+    pub const EPOLLRDHUP: u32 = 0x00002000;  // 对端关闭连接
+    pub const EPOLLEXCLUSIVE: u32 = 1 << 28; // 独占唤醒
+    pub const EPOLLWAKEUP: u32 = 1 << 29;    // 保持唤醒（忽略）
+    pub const EPOLLONESHOT: u32 = 0x40000000; // 只监听一次
+    pub const EPOLLET: u32 = 1 << 31;       // 边缘触发
+}
+
+/// epoll 操作类型
+pub mod epoll_ctl_ops {
+    pub const EPOLL_CTL_ADD: i32 = 1;   // 添加 fd
+    pub const EPOLL_CTL_DEL: i32 = 2;   // 删除 fd
+    pub const EPOLL_CTL_MOD: i32 = 3;   // 修改 fd
+}
+
+use epoll_ctl_ops::*;
+use epoll_events::*;
+
+/// epoll_event 结构体
+///
+/// riscv64 上不是 packed，data 按 8 字节对齐，共 16 字节
+#[repr(C)]
+#[derive(Debug, Copy, Clone, PartialEq)]
+pub struct EPollEvent {
+    pub events: u32,       // 事件类型
+    pub data: u64,         // 用户数据
+}
+
+/// epoll_create1 的标志 (EPOLL_CLOEXEC)
+pub const EPOLL_CLOEXEC: i32 = 0o2000000;
+
+/// 控制位，不是事件 (EP_PRIVATE_BITS)
+const EP_PRIVATE_BITS: u32 = EPOLLWAKEUP | EPOLLONESHOT | EPOLLET | EPOLLEXCLUSIVE;
+
+/// 允许与 EPOLLEXCLUSIVE 同时使用的位 (EPOLLEXCLUSIVE_OK_BITS)
+const EPOLLEXCLUSIVE_OK_BITS: u32 =
+    EPOLLIN | EPOLLOUT | EPOLLERR | EPOLLHUP | EPOLLWAKEUP | EPOLLET | EPOLLEXCLUSIVE;
+
+/// epoll 嵌套的最大深度 (EP_MAX_NESTS)
+const EP_MAX_NESTS: usize = 4;
+
+const ENOENT: i32 = -2;
+const EINTR: i32 = -4;
+const EEXIST: i32 = -17;
+const EINVAL: i32 = -22;
+const ELOOP: i32 = -40;
+
+/// 监视项的键：文件对象地址与描述符 (epoll_filefd)
+type EpKey = (usize, i32);
+
+/// epoll 实例 (struct eventpoll)
+pub struct EventPoll {
+    /// 监视集合 (ep->rbr)
+    items: Mutex<BTreeMap<EpKey, Arc<EpItem>>>,
+    /// 就绪链表 (ep->rdllist)
+    rdllist: Mutex<VecDeque<Arc<EpItem>>>,
+    /// epoll_wait 的等待者 (ep->wq)，以独占方式等待
+    wq: WaitQueueHead,
+    /// poll 这个 epoll 文件的等待者 (ep->poll_wait)，嵌套 epoll 时使用
+    poll_wait: WaitQueueHead,
+}
+
+/// 监视项 (struct epitem)
+pub struct EpItem {
+    /// 被监视的文件，不持有引用
+    file: Weak<File>,
+    /// 关心的事件与控制位
+    events: AtomicU32,
+    /// 用户数据
+    data: AtomicU64,
+    /// 是否在就绪链表上
+    ready: AtomicBool,
+    /// 所属的 epoll 实例，登记的回调项全部摘下之前保持有效
+    ep: *const EventPoll,
+    /// 登记在目标等待队列上的回调项 (eppoll_entry)
+    pwqlist: Mutex<Vec<(Box<WaitQueueEntry>, *const WaitQueueHead)>>,
+}
+
+// 回调项与队列指针只在 ep_unregister 之前使用
+unsafe impl Send for EpItem {}
+unsafe impl Sync for EpItem {}
+
+/// 文件到监视它的 epoll 的链接 (file->f_ep)
+pub struct EpLink {
+    ep: Weak<EventPoll>,
+    key: EpKey,
+}
+
+impl EventPoll {
+    fn new() -> Self {
+        Self {
+            items: Mutex::new(BTreeMap::new()),
+            rdllist: Mutex::new(VecDeque::new()),
+            wq: WaitQueueHead::new(),
+            poll_wait: WaitQueueHead::new(),
+        }
+    }
+
+    /// 监视的文件数
+    pub fn nr_items(&self) -> usize {
+        self.items.lock().len()
+    }
+}
+
+/// 由事件得到需要检查的就绪位；EPOLLONESHOT 触发后返回 0
+#[inline]
+fn ep_event_mask(events: u32) -> u32 {
+    if events & !EP_PRIVATE_BITS == 0 {
+        return 0;
+    }
+    (events & !EP_PRIVATE_BITS) | EPOLLERR | EPOLLHUP
+}
+
+/// 把项放入就绪链表
+///
+/// # 返回
+/// 是否新放入（已经在链表上时返回 false）
+fn ep_queue_ready(ep: &EventPoll, epi: &Arc<EpItem>) -> bool {
+    if epi.ready.swap(true, Ordering::AcqRel) {
+        return false;
+    }
+    ep.rdllist.lock().push_back(epi.clone());
+    true
+}
+
+/// 目标文件等待队列上的回调 (ep_poll_callback)
+///
+/// # 返回
+/// 是否算作一次唤醒：EPOLLEXCLUSIVE 的项只有唤醒了 epoll_wait 的等待者才返回 true，
+/// 目标队列继续尝试下一个独占项
+fn ep_poll_callback(entry: &WaitQueueEntry) -> bool {
+    let epi = unsafe { &*(entry.private() as *const EpItem) };
+    let events = epi.events.load(Ordering::Acquire);
+    // EPOLLONESHOT 触发后禁用，直到 EPOLL_CTL_MOD
+    if ep_event_mask(events) == 0 {
+        return false;
+    }
+    let ep = unsafe { &*epi.ep };
+    let epi = unsafe {
+        Arc::increment_strong_count(epi as *const EpItem);
+        Arc::from_raw(epi as *const EpItem)
+    };
+    let queued = ep_queue_ready(ep, &epi);
+
+    let woken = ep.wq.wake_up_one() != 0;
+    // 只在新放入时通知嵌套的 epoll，环检查保证不会递归回到自己
+    if queued {
+        ep.poll_wait.wake_up_all();
+    }
+    if events & EPOLLEXCLUSIVE != 0 {
+        woken
+    } else {
+        true
+    }
+}
+
+/// 摘下项登记的所有回调项 (ep_unregister_pollwait)
+///
+/// 摘下之后不会再有回调引用这个项
+fn ep_unregister(ep: &EventPoll, epi: &Arc<EpItem>) {
+    let pwqlist = core::mem::take(&mut *epi.pwqlist.lock());
+    for (entry, queue) in pwqlist.iter() {
+        unsafe { (**queue).remove(entry) };
+    }
+    drop(pwqlist);
+    ep.rdllist.lock().retain(|item| !Arc::ptr_eq(item, epi));
+    epi.ready.store(false, Ordering::Release);
+}
+
+/// 目标文件是否已经（直接或间接）监视了 ep (ep_loop_check)
+fn ep_loop_check(ep: &EventPoll, target: &EventPoll, depth: usize) -> bool {
+    if core::ptr::eq(ep, target) || depth > EP_MAX_NESTS {
+        return true;
+    }
+    let files: Vec<Arc<File>> = target.items.lock().values()
+        .filter_map(|epi| epi.file.upgrade())
+        .collect();
+    let mut looped = false;
+    for file in files {
+        if !looped {
+            if let Some(nested) = file_epoll(&file) {
+                looped = ep_loop_check(ep, &nested, depth + 1);
+            }
+        }
+        fput(file);
+    }
+    looped
+}
+
+/// 添加监视 (ep_insert)
+fn ep_insert(ep: &Arc<EventPoll>, fd: i32, file: &Arc<File>, event: &EPollEvent) -> Result<(), i32> {
+    let key = (Arc::as_ptr(file) as usize, fd);
+    let exclusive = event.events & EPOLLEXCLUSIVE != 0;
+    {
+        let mut items = ep.items.lock();
+        if items.contains_key(&key) {
+            return Err(EEXIST);
+        }
+        let epi = Arc::new(EpItem {
+            file: Arc::downgrade(file),
+            events: AtomicU32::new(event.events),
+            data: AtomicU64::new(event.data),
+            ready: AtomicBool::new(false),
+            ep: Arc::as_ptr(ep),
+            pwqlist: Mutex::new(Vec::new()),
+        });
+        // 在目标的等待队列上登记回调 (ep_ptable_queue_proc)
+        let mut pt = PollTable::new();
+        vfs_poll(file, Some(&mut pt));
+        let mut pwqlist = epi.pwqlist.lock();
+        for &queue in pt.queues() {
+            let entry = Box::new(WaitQueueEntry::with_callback(
+                ep_poll_callback,
+                Arc::as_ptr(&epi) as *const (),
+                exclusive,
+            ));
+            unsafe { (*queue).add(&entry) };
+            pwqlist.push((entry, queue));
+        }
+        drop(pwqlist);
+        items.insert(key, epi);
+    }
+    file.f_ep.lock().push(EpLink { ep: Arc::downgrade(ep), key });
+
+    // 回调挂上之后再检查一次：之前已经就绪的事件不会再有唤醒，直接放入就绪链表
+    ep_check_ready(ep, key, file);
+    Ok(())
+}
+
+/// 当前已就绪时把项放入就绪链表并唤醒等待者
+fn ep_check_ready(ep: &EventPoll, key: EpKey, file: &File) {
+    let epi = match ep.items.lock().get(&key) {
+        Some(epi) => epi.clone(),
+        None => return,
+    };
+    let mask = ep_event_mask(epi.events.load(Ordering::Acquire));
+    if file.poll() & mask != 0 && ep_queue_ready(ep, &epi) {
+        ep.wq.wake_up_one();
+        ep.poll_wait.wake_up_all();
+    }
+}
+
+/// 删除监视 (ep_remove)
+fn ep_remove(ep: &EventPoll, key: EpKey, file: &File) -> Result<(), i32> {
+    let epi = ep.items.lock().remove(&key).ok_or(ENOENT)?;
+    ep_unregister(ep, &epi);
+    let ep_ptr = ep as *const EventPoll;
+    file.f_ep.lock().retain(|link| !(link.key == key && link.ep.as_ptr() == ep_ptr));
+    Ok(())
+}
+
+/// 修改监视 (ep_modify)
+fn ep_modify(ep: &EventPoll, key: EpKey, file: &File, event: &EPollEvent) -> Result<(), i32> {
+    let epi = ep.items.lock().get(&key).cloned().ok_or(ENOENT)?;
+    // 独占项的回调已经以独占方式登记，不能修改
+    if epi.events.load(Ordering::Acquire) & EPOLLEXCLUSIVE != 0 {
+        return Err(EINVAL);
+    }
+    epi.data.store(event.data, Ordering::Release);
+    epi.events.store(event.events, Ordering::Release);
+    ep_check_ready(ep, key, file);
+    Ok(())
+}
+
+/// epoll_ctl (do_epoll_ctl)
+///
+/// # 参数
+/// - ep: epoll 实例
+/// - op: EPOLL_CTL_ADD / EPOLL_CTL_DEL / EPOLL_CTL_MOD
+/// - fd, file: 目标描述符与文件
+/// - event: ADD 与 MOD 的事件
+///
+/// # 返回
+/// 目标是 ep 自己、MOD 独占项或 EPOLLEXCLUSIVE 与不允许的位同时使用返回 EINVAL，
+/// 形成环返回 ELOOP，重复添加返回 EEXIST，未添加返回 ENOENT
+pub fn ep_ctl(ep: &Arc<EventPoll>, op: i32, fd: i32, file: &Arc<File>, event: Option<&EPollEvent>) -> Result<(), i32> {
+    let key = (Arc::as_ptr(file) as usize, fd);
+    if op == EPOLL_CTL_DEL {
+        return ep_remove(ep, key, file);
+    }
+    let event = match event {
+        Some(event) if op == EPOLL_CTL_ADD || op == EPOLL_CTL_MOD => event,
+        _ => return Err(EINVAL),
+    };
+    let nested = file_epoll(file);
+    if event.events & EPOLLEXCLUSIVE != 0 {
+        if op == EPOLL_CTL_MOD || nested.is_some() || event.events & !EPOLLEXCLUSIVE_OK_BITS != 0 {
+            return Err(EINVAL);
+        }
+    }
+    if op == EPOLL_CTL_MOD {
+        return ep_modify(ep, key, file, event);
+    }
+    if let Some(nested) = nested {
+        if Arc::ptr_eq(&nested, ep) {
+            return Err(EINVAL);
+        }
+        if ep_loop_check(ep, &nested, 1) {
+            return Err(ELOOP);
+        }
+    }
+    ep_insert(ep, fd, file, event)
+}
+
+/// 取出就绪事件 (ep_send_events)
+///
+/// 逐个重新检查就绪链表上的项：水平触发的项仍然就绪就放回链表，
+/// 边缘触发的项等待下一次回调，EPOLLONESHOT 的项报告后禁用
+fn ep_send_events(ep: &EventPoll, maxevents: usize) -> Vec<EPollEvent> {
+    let mut txlist = core::mem::take(&mut *ep.rdllist.lock());
+    let mut out = Vec::new();
+    let mut requeue = Vec::new();
+
+    while out.len() < maxevents {
+        let epi = match txlist.pop_front() {
+            Some(epi) => epi,
+            None => break,
+        };
+        // 先清除标志：检查期间到达的回调会把它重新放入链表
+        epi.ready.store(false, Ordering::Release);
+        let file = match epi.file.upgrade() {
+            Some(file) => file,
+            None => continue,
+        };
+        let events = epi.events.load(Ordering::Acquire);
+        let revents = file.poll() & ep_event_mask(events);
+        fput(file);
+        if revents == 0 {
+            continue;
+        }
+        out.push(EPollEvent { events: revents, data: epi.data.load(Ordering::Acquire) });
+        if events & EPOLLONESHOT != 0 {
+            epi.events.store(events & EP_PRIVATE_BITS, Ordering::Release);
+        } else if events & EPOLLET == 0 {
+            requeue.push(epi);
+        }
+    }
+
+    // 没有处理到的项保持原来的顺序放回链表头部
+    let mut rdllist = ep.rdllist.lock();
+    while let Some(epi) = txlist.pop_back() {
+        rdllist.push_front(epi);
+    }
+    for epi in requeue {
+        if !epi.ready.swap(true, Ordering::AcqRel) {
+            rdllist.push_back(epi);
+        }
+    }
+    out
+}
+
+/// epoll_wait (ep_poll)
+///
+/// # 参数
+/// - maxevents: 最多返回的事件数
+/// - timeout_ms: 0 立即返回，负数一直等待
+///
+/// # 返回
+/// 就绪事件，超时返回空；等待期间有信号返回 EINTR
+pub fn ep_poll(ep: &EventPoll, maxevents: usize, timeout_ms: i32) -> Result<Vec<EPollEvent>, i32> {
+    use crate::drivers::timer;
+
+    let deadline = if timeout_ms > 0 {
+        Some(timer::get_jiffies() + timer::msecs_to_jiffies(timeout_ms as u64).max(1))
+    } else {
+        None
+    };
+    loop {
+        let events = ep_send_events(ep, maxevents);
+        if !events.is_empty() || timeout_ms == 0 {
+            return Ok(events);
+        }
+        if deadline.map_or(false, |deadline| timer::get_jiffies() >= deadline) {
+            return Ok(events);
+        }
+        if crate::signal::signal_pending() {
+            return Err(EINTR);
+        }
+
+        // 睡眠前按 net.core.busy_poll 忙轮询网卡 (ep_busy_loop)
+        if crate::net::busy_poll::napi_busy_loop(crate::net::busy_poll::busy_poll(), false, || {
+            !ep.rdllist.lock().is_empty()
+        }) {
+            continue;
+        }
+
+        let current = match crate::sched::current() {
+            Some(task) => task,
+            None => return Ok(events),
+        };
+        // 独占等待：一次回调只唤醒一个 epoll_wait
+        let entry = WaitQueueEntry::new(current, true);
+        ep.wq.add(&entry);
+        // 先进入睡眠状态再检查，检查之后的唤醒会把状态改回 Running
+        current.set_state(TaskState::Interruptible);
+        if ep.rdllist.lock().is_empty() {
+            // 超时由时间轮定时器唤醒，不再每个 tick 醒来检查
+            let timeout = deadline.map_or(MAX_SCHEDULE_TIMEOUT, |deadline| deadline.saturating_sub(timer::get_jiffies()));
+            schedule_timeout(timeout);
+        }
+        current.set_state(TaskState::Running);
+        ep.wq.remove(&entry);
+    }
+}
+
+/// 文件的最后一个引用释放时从监视它的 epoll 中摘除 (eventpoll_release)
+pub fn eventpoll_release(file: &File) {
+    let links = core::mem::take(&mut *file.f_ep.lock());
+    for link in links {
+        if let Some(ep) = link.ep.upgrade() {
+            let epi = ep.items.lock().remove(&link.key);
+            if let Some(epi) = epi {
+                ep_unregister(&ep, &epi);
+            }
+        }
+    }
+}
+
+/// 释放 epoll 实例的所有监视 (ep_free)
+fn ep_free(ep: &Arc<EventPoll>) {
+    let items = core::mem::take(&mut *ep.items.lock());
+    let ep_ptr = Arc::as_ptr(ep);
+    for (key, epi) in items {
+        ep_unregister(ep, &epi);
+        if let Some(file) = epi.file.upgrade() {
+            file.f_ep.lock().retain(|link| !(link.key == key && link.ep.as_ptr() == ep_ptr));
+            fput(file);
+        }
+    }
+}
+
+/// epoll 文件本身的就绪事件 (ep_eventpoll_poll)
+///
+/// 就绪链表上有真正就绪的项时可读；嵌套时登记 poll_wait
+fn ep_eventpoll_poll(file: &File, pt: Option<&mut PollTable>) -> u32 {
+    let ep = match file_epoll(file) {
+        Some(ep) => ep,
+        None => return 0,
+    };
+    poll_wait(&ep.poll_wait, pt);
+    let ready: Vec<Arc<EpItem>> = ep.rdllist.lock().iter().cloned().collect();
+    for epi in ready {
+        if let Some(target) = epi.file.upgrade() {
+            let revents = target.poll() & ep_event_mask(epi.events.load(Ordering::Acquire));
+            fput(target);
+            if revents != 0 {
+                return poll_mask::POLLIN | poll_mask::POLLRDNORM;
+            }
+        }
+    }
+    0
+}
+
+fn ep_file_close(file: &File) -> i32 {
+    let ptr = match unsafe { (*file.private_data.get()).take() } {
+        Some(ptr) => ptr,
+        None => return -9,  // EBADF
+    };
+    let ep = unsafe { Arc::from_raw(ptr as *const EventPoll) };
+    ep_free(&ep);
+    0
+}
+
+static EPOLL_OPS: FileOps = FileOps {
+    read: None,
+    write: None,
+    lseek: None,
+    close: Some(ep_file_close),
+    read_iter: None,
+    write_iter: None,
+    poll: Some(ep_eventpoll_poll),
+};
+
+/// 创建 epoll 实例与它的文件 (do_epoll_create)
+pub fn epoll_create_file() -> Arc<File> {
+    let ep = Arc::new(EventPoll::new());
+    let file = Arc::new(File::new(FileFlags::new(FileFlags::O_RDWR)));
+    file.set_ops(&EPOLL_OPS);
+    file.set_private_data(Arc::into_raw(ep) as *mut u8);
+    file
+}
+
+/// 文件是否为 epoll 实例 (is_file_epoll)
+pub fn is_file_epoll(file: &File) -> bool {
+    unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &EPOLL_OPS))
+}
+
+/// 由文件得到 epoll 实例的一个引用
+pub fn file_epoll(file: &File) -> Option<Arc<EventPoll>> {
+    if !is_file_epoll(file) {
+        return None;
+    }
+    unsafe { *file.private_data.get() }.map(|ptr| unsafe {
+        let ptr = ptr as *const EventPoll;
+        Arc::increment_strong_count(ptr);
+        Arc::from_raw(ptr)
+    })
+}
@@ -5,13 +5,13 @@
 
 //! ext4 块和 inode 分配器
 //!
-//! 完全...
 //! 参考: fs/ext4/mballoc.c, fs/ext4/ialloc.c
 
 use alloc::vec::Vec;
 
 use crate::errno;
 use crate::fs::bio;
+use crate::fs::ext4::mballoc;
 use crate::fs::ext4::superblock::Ext4GroupDesc;
 
 pub struct BlockAllocator<'a> {
@@ -26,62 +26,14 @@ impl<'a> BlockAllocator<'a> {
 
     /// 分配一个块
     ///
+    /// 由多块分配器从第一个块组开始查找，立即写回位图和计数
     ///
     /// # 返回
     /// 成功返回块号，失败返回错误码
     pub fn alloc_block(&self) -> Result<u64, i32> {
-        // 1. 查找有空闲块的块组
-        let block_groups = self.fs.group_count;
-        let blocks_per_group = self.fs.blocks_per_group as u64;
-        let first_data_block = self.fs.sb_info.as_ref()
-            .map(|sb| sb.s_first_data_block as u64)
-            .unwrap_or(0);
-
-        // 遍历所有块组寻找空闲块
-        for group_idx in 0..block_groups {
-            let group_desc = &self.fs.group_descs[group_idx as usize];
-
-            // 检查是否有空闲块
-            let free_blocks = group_desc.bg_free_blocks_count;
-            if free_blocks == 0 {
-                continue;
-            }
-
-            // 块位图的块号
-            let block_bitmap_block = group_desc.bg_block_bitmap as u64;
-            if block_bitmap_block == 0 {
-                continue;
-            }
-
-            // 读取块位图
-            let bitmap = self.read_block_bitmap(block_bitmap_block)?;
-
-            // 在位图中查找空闲块
-            let start = if group_idx == 0 {
-                first_data_block
-            } else {
-                0
-            };
-
-            if let Some(block_offset) = self.find_free_bit(&bitmap, start, blocks_per_group) {
-                // 计算实际块号
-                let block_number = (group_idx as u64) * blocks_per_group + block_offset;
-
-                // 标记块为已使用
-                self.mark_block_used(group_idx as u64, block_offset as usize, block_bitmap_block)?;
-
-                // 更新块组描述符（减少空闲块计数）
-                self.update_group_desc_free_blocks(group_idx as u64, free_blocks - 1)?;
-
-                // 更新 superblock（减少空闲块计数）
-                self.update_superblock_free_blocks(-1)?;
-
-                return Ok(block_number);
-            }
-        }
-
-        // 没有可用的空闲块
-        Err(errno::Errno::NoSpaceLeftOnDevice.as_neg_i32())
+        let (block, _) = mballoc::ext4_mb_new_blocks(self.fs, 0, 0, 0, 1)?;
+        mballoc::ext4_mb_flush(self.fs)?;
+        Ok(block)
     }
 
     /// 释放一个块
@@ -90,194 +42,8 @@ impl<'a> BlockAllocator<'a> {
     /// # 参数
     /// - `block`: 要释放的块号
     pub fn free_block(&self, block: u64) -> Result<(), i32> {
-        let blocks_per_group = self.fs.blocks_per_group as u64;
-        let block_groups = self.fs.group_count as u64;
-
-        // 计算块所在的组
-        let group_idx = block / blocks_per_group;
-        if group_idx >= block_groups {
-            return Err(errno::Errno::InvalidArgument.as_neg_i32());
-        }
-
-        let block_offset = (block % blocks_per_group) as usize;
-
-        // 读取块组描述符
-        let group_desc = &self.fs.group_descs[group_idx as usize];
-        let block_bitmap_block = group_desc.bg_block_bitmap as u64;
-
-        // 读取块位图
-        let mut bitmap = self.read_block_bitmap(block_bitmap_block)?;
-
-        // 清除位图中的对应位
-        let byte_idx = block_offset / 8;
-        let bit_idx = block_offset % 8;
-
-        if byte_idx < bitmap.len() {
-            bitmap[byte_idx] &= !(1 << bit_idx);
-
-            // 写回位图
-            self.write_block_bitmap(block_bitmap_block, &bitmap)?;
-
-            // 更新块组描述符（增加空闲块计数）
-            self.update_group_desc_free_blocks(group_idx, group_desc.bg_free_blocks_count + 1)?;
-
-            // 更新 superblock（增加空闲块计数）
-            self.update_superblock_free_blocks(1)?;
-
-            Ok(())
-        } else {
-            Err(errno::Errno::InvalidArgument.as_neg_i32())
-        }
-    }
-
-    /// 读取块位图
-    fn read_block_bitmap(&self, bitmap_block: u64) -> Result<Vec<u8>, i32> {
-        unsafe {
-            let bh = bio::bread(self.fs.device, bitmap_block)
-                .ok_or(errno::Errno::IOError.as_neg_i32())?;
-
-            let data = &(*bh).b_data;
-            let bitmap = data.to_vec();
-
-            bio::brelse(bh);
-
-            Ok(bitmap)
-        }
-    }
-
-    /// 写回块位图
-    fn write_block_bitmap(&self, bitmap_block: u64, bitmap: &[u8]) -> Result<(), i32> {
-        unsafe {
-            let bh = bio::bread(self.fs.device, bitmap_block)
-                .ok_or(errno::Errno::IOError.as_neg_i32())?;
-
-            let data = &mut (*bh).b_data;
-            data.copy_from_slice(bitmap);
-
-            // 标记为脏并同步
-            (*bh).set_state_bit(crate::fs::bio::BufferState::BH_Dirty);
-            bio::sync_dirty_buffer(bh)?;
-
-            bio::brelse(bh);
-
-            Ok(())
-        }
-    }
-
-    /// 在位图中查找空闲位
-    fn find_free_bit(&self, bitmap: &[u8], start: u64, max_bits: u64) -> Option<u64> {
-        let start_bit = start as usize;
-
-        for (i, &byte) in bitmap.iter().enumerate() {
-            let bit_offset = i * 8;
-
-            // 跳过起始位置之前的位
-            if bit_offset + 8 <= start_bit {
-                continue;
-            }
-
-            // 检查字节中是否有未设置的位
-            if byte != 0xFF {
-                for bit in 0..8 {
-                    let abs_bit = bit_offset + bit;
-
-                    // 超出最大位数
-                    if abs_bit as u64 >= max_bits {
-                        break;
-                    }
-
-                    // 跳过起始位置之前的位
-                    if abs_bit < start_bit {
-                        continue;
-                    }
-
-                    // 检查该位是否为0（空闲）
-                    if (byte & (1 << bit)) == 0 {
-                        return Some(abs_bit as u64);
-                    }
-                }
-            }
-        }
-
-        None
-    }
-
-    /// 标记块为已使用
-    fn mark_block_used(&self, _group_idx: u64, block_offset: usize, bitmap_block: u64) -> Result<(), i32> {
-        let mut bitmap = self.read_block_bitmap(bitmap_block)?;
-
-        let byte_idx = block_offset / 8;
-        let bit_idx = block_offset % 8;
-
-        if byte_idx < bitmap.len() {
-            bitmap[byte_idx] |= 1 << bit_idx;
-            self.write_block_bitmap(bitmap_block, &bitmap)?;
-            Ok(())
-        } else {
-            Err(errno::Errno::InvalidArgument.as_neg_i32())
-        }
-    }
-
-    /// 更新块组描述符中的空闲块计数
-    fn update_group_desc_free_blocks(&self, group_idx: u64, free_blocks: u16) -> Result<(), i32> {
-        // 在 ext4 中，块组描述符在磁盘上的位置是固定的
-        // 我们需要找到块组描述符所在的块并更新它
-
-        let group_desc_size = core::mem::size_of::<Ext4GroupDesc>();
-        let group_desc_start_block = if self.fs.block_size == 1024 {
-            2  // 块组描述符从块2开始（块0=引导，块1=superblock）
-        } else {
-            1  // 块组描述符从块1开始（块0包含superblock）
-        };
-
-        let desc_per_block = self.fs.block_size as u64 / group_desc_size as u64;
-        let desc_block = group_desc_start_block + (group_idx / desc_per_block);
-        let desc_offset = ((group_idx % desc_per_block) as usize) * group_desc_size;
-
-        unsafe {
-            let bh = bio::bread(self.fs.device, desc_block)
-                .ok_or(errno::Errno::IOError.as_neg_i32())?;
-
-            let data = &mut (*bh).b_data;
-            // 更新空闲块计数（偏移量 = bg_free_blocks_count 在 Ext4GroupDesc 中的位置）
-            let free_blocks_ptr = data.as_mut_ptr().add(desc_offset + 12) as *mut u16;
-            free_blocks_ptr.write_volatile(free_blocks);
-
-            (*bh).set_state_bit(crate::fs::bio::BufferState::BH_Dirty);
-            bio::sync_dirty_buffer(bh)?;
-
-            bio::brelse(bh);
-
-            Ok(())
-        }
-    }
-
-    /// 更新 superblock 中的空闲块计数
-    fn update_superblock_free_blocks(&self, delta: i16) -> Result<(), i32> {
-        unsafe {
-            // superblock 总是在块 1 (对于 1024 字节块) 或块 0 (对于更大的块)
-            let sb_block = if self.fs.block_size == 1024 { 1 } else { 0 };
-
-            let bh = bio::bread(self.fs.device, sb_block as u64)
-                .ok_or(errno::Errno::IOError.as_neg_i32())?;
-
-            let data = &mut (*bh).b_data;
-
-            // 更新空闲块计数（s_free_blocks_count 在 Ext4SuperBlockOnDisk 中的偏移）
-            // 偏移量需要从结构体定义中计算
-            let free_blocks_ptr = data.as_mut_ptr().add(16) as *mut u16;  // s_free_blocks_count 在偏移16
-
-            let current = free_blocks_ptr.read_volatile();
-            let new = (current as i16 + delta) as u16;
-            free_blocks_ptr.write_volatile(new);
-
-            (*bh).set_state_bit(crate::fs::bio::BufferState::BH_Dirty);
-            bio::sync_dirty_buffer(bh)?;
-
-            bio::brelse(bh);
-
-            Ok(())
-        }
+        mballoc::ext4_mb_free_blocks(self.fs, block, 1)?;
+        mballoc::ext4_mb_flush(self.fs)
     }
 }
 
@@ -302,6 +68,9 @@ impl<'a> InodeAllocator<'a> {
 
         // 遍历所有块组寻找空闲 inode
         for group_idx in 0..block_groups {
+            // 块组很多时逐组读位图，给其他任务运行的机会
+            crate::sched::cond_resched();
+
             let group_desc = &self.fs.group_descs[group_idx as usize];
 
             // 检查是否有空闲 inode
@@ -316,7 +85,8 @@ impl<'a> InodeAllocator<'a> {
                 continue;
             }
 
-            // 读取 inode 位图
+            // 读取 inode 位图，未缓存时连同 flex 组的其他位图一起读入
+            mballoc::ext4_mb_prefetch(self.fs, group_idx as usize, inode_bitmap_block);
             let bitmap = self.read_inode_bitmap(inode_bitmap_block)?;
 
             // 在位图中查找空闲 inode
@@ -329,10 +99,10 @@ impl<'a> InodeAllocator<'a> {
                 self.mark_inode_used(group_idx as u64, inode_offset as usize, inode_bitmap_block)?;
 
                 // 更新块组描述符（减少空闲 inode 计数）
-                self.update_group_desc_free_inodes(group_idx as u64, free_inodes - 1)?;
+                self.update_group_desc_free_inodes(group_idx as u64, -1)?;
 
-                // 更新 superblock（减少空闲 inode 计数）
-                self.update_superblock_free_inodes(-1)?;
+                // 超级块的空闲 inode 数只记在每 CPU 计数器中，sync 时写回
+                self.fs.mod_free_inodes(-1);
 
                 return Ok(inode_number as u32);
             }
@@ -364,6 +134,7 @@ impl<'a> InodeAllocator<'a> {
         let inode_bitmap_block = group_desc.bg_inode_bitmap as u64;
 
         // 读取 inode 位图
+        mballoc::ext4_mb_prefetch(self.fs, group_idx as usize, inode_bitmap_block);
         let mut bitmap = self.read_inode_bitmap(inode_bitmap_block)?;
 
         // 清除位图中的对应位
@@ -377,10 +148,10 @@ impl<'a> InodeAllocator<'a> {
             self.write_inode_bitmap(inode_bitmap_block, &bitmap)?;
 
             // 更新块组描述符（增加空闲 inode 计数）
-            self.update_group_desc_free_inodes(group_idx, group_desc.bg_free_inodes_count + 1)?;
+            self.update_group_desc_free_inodes(group_idx, 1)?;
 
-            // 更新 superblock（增加空闲 inode 计数）
-            self.update_superblock_free_inodes(1)?;
+            // 超级块的空闲 inode 数只记在每 CPU 计数器中，sync 时写回
+            self.fs.mod_free_inodes(1);
 
             Ok(())
         } else {
@@ -412,8 +183,7 @@ impl<'a> InodeAllocator<'a> {
             let data = &mut (*bh).b_data;
             data.copy_from_slice(bitmap);
 
-            (*bh).set_state_bit(crate::fs::bio::BufferState::BH_Dirty);
-            bio::sync_dirty_buffer(bh)?;
+            self.fs.handle_dirty_metadata(bh)?;
 
             bio::brelse(bh);
 
@@ -475,8 +245,10 @@ impl<'a> InodeAllocator<'a> {
         }
     }
 
-    /// 更新块组描述符中的空闲 inode 计数
-    fn update_group_desc_free_inodes(&self, group_idx: u64, free_inodes: u16) -> Result<(), i32> {
+    /// 更新块组描述符中的空闲 inode 计数 (ext4_free_inodes_set)
+    ///
+    /// 在缓存的描述符块上加减：挂载时读入的 group_descs 副本不随分配更新
+    fn update_group_desc_free_inodes(&self, group_idx: u64, delta: i32) -> Result<(), i32> {
         let group_desc_size = core::mem::size_of::<Ext4GroupDesc>();
         let group_desc_start_block = if self.fs.block_size == 1024 {
             2
@@ -495,36 +267,19 @@ impl<'a> InodeAllocator<'a> {
             let data = &mut (*bh).b_data;
             // 更新空闲 inode 计数（bg_free_inodes_count 在 Ext4GroupDesc 中的偏移）
             let free_inodes_ptr = data.as_mut_ptr().add(desc_offset + 14) as *mut u16;
-            free_inodes_ptr.write_volatile(free_inodes);
-
-            (*bh).set_state_bit(crate::fs::bio::BufferState::BH_Dirty);
-            bio::sync_dirty_buffer(bh)?;
-
-            bio::brelse(bh);
-
-            Ok(())
-        }
-    }
-
-    /// 更新 superblock 中的空闲 inode 计数
-    fn update_superblock_free_inodes(&self, delta: i16) -> Result<(), i32> {
-        unsafe {
-            let sb_block = if self.fs.block_size == 1024 { 1 } else { 0 };
-
-            let bh = bio::bread(self.fs.device, sb_block as u64)
-                .ok_or(errno::Errno::IOError.as_neg_i32())?;
-
-            let data = &mut (*bh).b_data;
-
-            // 更新空闲 inode 计数（s_free_inodes_count 在 Ext4SuperBlockOnDisk 中的偏移）
-            let free_inodes_ptr = data.as_mut_ptr().add(20) as *mut u16;
-
-            let current = free_inodes_ptr.read_volatile();
-            let new = (current as i16 + delta) as u16;
-            free_inodes_ptr.write_volatile(new);
+            let free_inodes = (free_inodes_ptr.read_unaligned() as i32 + delta).clamp(0, u16::MAX as i32);
+            free_inodes_ptr.write_unaligned(free_inodes as u16);
+
+            // 此时 inode 位图已写回，重新计算位图与描述符的校验和
+            if self.fs.has_metadata_csum() {
+                let bitmap_block = self.fs.group_descs[group_idx as usize].bg_inode_bitmap as u64;
+                let bitmap = self.read_inode_bitmap(bitmap_block)?;
+                let desc = &mut data[desc_offset..desc_offset + group_desc_size];
+                self.fs.inode_bitmap_csum_set(desc, &bitmap);
+                self.fs.group_desc_csum_set(group_idx as u32, desc);
+            }
 
-            (*bh).set_state_bit(crate::fs::bio::BufferState::BH_Dirty);
-            bio::sync_dirty_buffer(bh)?;
+            self.fs.handle_dirty_metadata(bh)?;
 
             bio::brelse(bh);
 
@@ -0,0 +1,369 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 元数据校验和 (metadata_csum)
+//!
+//! 参考: fs/ext4/super.c, fs/ext4/inode.c, fs/ext4/extents.c, fs/ext4/namei.c, fs/ext4/bitmap.c
+//!
+//! 启用 RO_COMPAT_METADATA_CSUM 时超级块、块组描述符、位图、inode、extent 块和目录块都带 CRC32C。
+//! 文件系统种子为 crc32c(~0, uuid)（INCOMPAT_CSUM_SEED 时直接取 s_checksum_seed），
+//! 属于某个 inode 的 extent 块与目录块再以 inode 号和 i_generation 派生出 inode 种子。
+//! 读入时校验，不一致返回 EFSBADCRC；修改后在交给日志之前重新计算。
+//! 通过校验的缓冲区标记 BH_Verified，留在块缓存期间不再重复计算
+
+use crate::crc32::crc32c;
+use crate::errno;
+use crate::fs::bio::{BufferHead, BufferState};
+
+use super::inode::Ext4Inode;
+use super::Ext4FileSystem;
+
+/// 元数据校验和 (EXT4_FEATURE_RO_COMPAT_METADATA_CSUM)
+pub const EXT4_FEATURE_RO_COMPAT_METADATA_CSUM: u32 = 0x400;
+/// 校验和种子保存在超级块中 (EXT4_FEATURE_INCOMPAT_CSUM_SEED)
+pub const EXT4_FEATURE_INCOMPAT_CSUM_SEED: u32 = 0x2000;
+
+/// 超级块中的字段偏移
+const EXT4_SB_FEATURE_INCOMPAT: usize = 0x60;
+const EXT4_SB_FEATURE_RO_COMPAT: usize = 0x64;
+const EXT4_SB_UUID: usize = 0x68;
+const EXT4_SB_CHECKSUM_SEED: usize = 0x270;
+const EXT4_SB_CHECKSUM: usize = 0x3FC;
+
+/// 块组描述符中的位图校验和与描述符校验和
+const EXT4_BG_BLOCK_BITMAP_CSUM_LO: usize = 0x18;
+const EXT4_BG_INODE_BITMAP_CSUM_LO: usize = 0x1A;
+const EXT4_BG_CHECKSUM: usize = 0x1E;
+
+/// inode 中的生成号、校验和低 16 位、扩展区大小和校验和高 16 位
+const EXT4_INODE_GENERATION: usize = 0x64;
+const EXT4_INODE_CHECKSUM_LO: usize = 0x7C;
+const EXT4_GOOD_OLD_INODE_SIZE: usize = 128;
+const EXT4_INODE_EXTRA_ISIZE: usize = 0x80;
+const EXT4_INODE_CHECKSUM_HI: usize = 0x82;
+
+/// extent 块头与条目的大小，校验和 (ext4_extent_tail) 紧跟在 eh_max 个条目之后
+const EXT4_EXT_HDR_SIZE: usize = 12;
+const EXT4_EXT_ENTRY_SIZE: usize = 12;
+
+/// 目录块末尾的校验和目录项 (struct ext4_dir_entry_tail)
+pub const EXT4_DIR_TAIL_SIZE: usize = 12;
+const EXT4_DIR_TAIL_FT: u8 = 0xDE;
+
+/// dx 索引之后的校验和 (struct dx_tail)
+pub const EXT4_DX_TAIL_SIZE: usize = 8;
+
+fn get_le16(buf: &[u8], off: usize) -> u16 {
+    u16::from_le_bytes([buf[off], buf[off + 1]])
+}
+
+fn get_le32(buf: &[u8], off: usize) -> u32 {
+    u32::from_le_bytes([buf[off], buf[off + 1], buf[off + 2], buf[off + 3]])
+}
+
+fn put_le16(buf: &mut [u8], off: usize, val: u16) {
+    buf[off..off + 2].copy_from_slice(&val.to_le_bytes());
+}
+
+fn put_le32(buf: &mut [u8], off: usize, val: u32) {
+    buf[off..off + 4].copy_from_slice(&val.to_le_bytes());
+}
+
+/// 校验和错误 (EFSBADCRC)
+pub fn efsbadcrc() -> i32 {
+    errno::Errno::BadMessage.as_neg_i32()
+}
+
+/// 超级块的校验和 (ext4_superblock_csum)
+fn superblock_csum(sb: &[u8]) -> u32 {
+    crc32c(!0, &sb[..EXT4_SB_CHECKSUM])
+}
+
+/// 超级块是否启用元数据校验和
+fn sb_has_metadata_csum(sb: &[u8]) -> bool {
+    get_le32(sb, EXT4_SB_FEATURE_RO_COMPAT) & EXT4_FEATURE_RO_COMPAT_METADATA_CSUM != 0
+}
+
+/// 重新计算超级块的校验和，未启用元数据校验和时不修改 (ext4_superblock_csum_set)
+///
+/// `sb` 为超级块的 1024 字节
+pub fn ext4_superblock_csum_set(sb: &mut [u8]) {
+    if sb_has_metadata_csum(sb) {
+        let csum = superblock_csum(sb);
+        put_le32(sb, EXT4_SB_CHECKSUM, csum);
+    }
+}
+
+/// 校验超级块 (ext4_superblock_csum_verify)
+pub fn ext4_superblock_csum_verify(sb: &[u8]) -> bool {
+    !sb_has_metadata_csum(sb) || superblock_csum(sb) == get_le32(sb, EXT4_SB_CHECKSUM)
+}
+
+/// 文件系统的校验和种子 (ext4_fill_super 中的 s_csum_seed)
+pub fn ext4_csum_seed(sb: &[u8]) -> u32 {
+    if get_le32(sb, EXT4_SB_FEATURE_INCOMPAT) & EXT4_FEATURE_INCOMPAT_CSUM_SEED != 0 {
+        get_le32(sb, EXT4_SB_CHECKSUM_SEED)
+    } else {
+        crc32c(!0, &sb[EXT4_SB_UUID..EXT4_SB_UUID + 16])
+    }
+}
+
+/// 缓冲区是否已经通过校验 (buffer_verified)
+pub fn buffer_verified(bh: *mut BufferHead) -> bool {
+    unsafe { (*bh).get_state().test(BufferState::BH_Verified) }
+}
+
+/// 标记缓冲区已通过校验 (set_buffer_verified)
+pub fn set_buffer_verified(bh: *mut BufferHead) {
+    unsafe { (*bh).set_state_bit(BufferState::BH_Verified) }
+}
+
+impl Ext4FileSystem {
+    /// 是否启用元数据校验和 (ext4_has_metadata_csum)
+    pub fn has_metadata_csum(&self) -> bool {
+        self.feature_ro_compat & EXT4_FEATURE_RO_COMPAT_METADATA_CSUM != 0
+    }
+
+    /// 块组描述符的校验和 (ext4_group_desc_csum)
+    ///
+    /// 依次覆盖块组号、bg_checksum 之前的字段、两个零字节和之后的字段，取低 16 位
+    fn group_desc_csum(&self, group: u32, desc: &[u8]) -> u16 {
+        let mut csum = crc32c(self.csum_seed, &group.to_le_bytes());
+        csum = crc32c(csum, &desc[..EXT4_BG_CHECKSUM]);
+        csum = crc32c(csum, &[0; 2]);
+        csum = crc32c(csum, &desc[EXT4_BG_CHECKSUM + 2..]);
+        csum as u16
+    }
+
+    /// 重新计算块组描述符的校验和 (ext4_group_desc_csum_set)
+    pub fn group_desc_csum_set(&self, group: u32, desc: &mut [u8]) {
+        if self.has_metadata_csum() {
+            let csum = self.group_desc_csum(group, desc);
+            put_le16(desc, EXT4_BG_CHECKSUM, csum);
+        }
+    }
+
+    /// 校验块组描述符 (ext4_group_desc_csum_verify)
+    pub fn group_desc_csum_verify(&self, group: u32, desc: &[u8]) -> bool {
+        !self.has_metadata_csum() || self.group_desc_csum(group, desc) == get_le16(desc, EXT4_BG_CHECKSUM)
+    }
+
+    /// 设置块位图的校验和，只覆盖本组的 blocks_per_group 位 (ext4_block_bitmap_csum_set)
+    pub fn block_bitmap_csum_set(&self, desc: &mut [u8], bitmap: &[u8]) {
+        if self.has_metadata_csum() {
+            let len = (self.blocks_per_group as usize / 8).min(bitmap.len());
+            put_le16(desc, EXT4_BG_BLOCK_BITMAP_CSUM_LO, crc32c(self.csum_seed, &bitmap[..len]) as u16);
+        }
+    }
+
+    /// 设置 inode 位图的校验和，只覆盖本组的 inodes_per_group 位 (ext4_inode_bitmap_csum_set)
+    pub fn inode_bitmap_csum_set(&self, desc: &mut [u8], bitmap: &[u8]) {
+        if self.has_metadata_csum() {
+            let len = (self.inodes_per_group as usize / 8).min(bitmap.len());
+            put_le16(desc, EXT4_BG_INODE_BITMAP_CSUM_LO, crc32c(self.csum_seed, &bitmap[..len]) as u16);
+        }
+    }
+
+    /// inode 的校验和种子 (ext4_inode_info.i_csum_seed)
+    pub fn inode_csum_seed(&self, ino: u32, generation: u32) -> u32 {
+        crc32c(crc32c(self.csum_seed, &ino.to_le_bytes()), &generation.to_le_bytes())
+    }
+
+    /// inode 扩展区是否容纳校验和高 16 位 (EXT4_FITS_IN_INODE(i_checksum_hi))
+    fn inode_has_csum_hi(&self, raw: &[u8]) -> bool {
+        self.inode_size as usize > EXT4_GOOD_OLD_INODE_SIZE
+            && EXT4_GOOD_OLD_INODE_SIZE + get_le16(raw, EXT4_INODE_EXTRA_ISIZE) as usize >= EXT4_INODE_CHECKSUM_HI + 2
+    }
+
+    /// inode 的校验和 (ext4_inode_csum)
+    ///
+    /// 覆盖整个 inode_size，两个校验和字段按零计算
+    fn inode_csum(&self, ino: u32, raw: &[u8]) -> u32 {
+        let size = (self.inode_size as usize).min(raw.len());
+        let seed = self.inode_csum_seed(ino, get_le32(raw, EXT4_INODE_GENERATION));
+        let mut csum = crc32c(seed, &raw[..EXT4_INODE_CHECKSUM_LO]);
+        csum = crc32c(csum, &[0; 2]);
+        csum = crc32c(csum, &raw[EXT4_INODE_CHECKSUM_LO + 2..EXT4_GOOD_OLD_INODE_SIZE]);
+        if size > EXT4_GOOD_OLD_INODE_SIZE {
+            let mut off = EXT4_INODE_CHECKSUM_HI;
+            csum = crc32c(csum, &raw[EXT4_GOOD_OLD_INODE_SIZE..off]);
+            if self.inode_has_csum_hi(raw) {
+                csum = crc32c(csum, &[0; 2]);
+                off += 2;
+            }
+            csum = crc32c(csum, &raw[off..size]);
+        }
+        csum
+    }
+
+    /// 重新计算 inode 的校验和 (ext4_inode_csum_set)
+    pub fn inode_csum_set(&self, ino: u32, raw: &mut [u8]) {
+        if !self.has_metadata_csum() {
+            return;
+        }
+        let csum = self.inode_csum(ino, raw);
+        put_le16(raw, EXT4_INODE_CHECKSUM_LO, csum as u16);
+        if self.inode_has_csum_hi(raw) {
+            put_le16(raw, EXT4_INODE_CHECKSUM_HI, (csum >> 16) as u16);
+        }
+    }
+
+    /// 校验 inode (ext4_inode_csum_verify)
+    pub fn inode_csum_verify(&self, ino: u32, raw: &[u8]) -> bool {
+        if !self.has_metadata_csum() {
+            return true;
+        }
+        let csum = self.inode_csum(ino, raw);
+        let mut provided = get_le16(raw, EXT4_INODE_CHECKSUM_LO) as u32;
+        let calculated = if self.inode_has_csum_hi(raw) {
+            provided |= (get_le16(raw, EXT4_INODE_CHECKSUM_HI) as u32) << 16;
+            csum
+        } else {
+            csum & 0xFFFF
+        };
+        provided == calculated
+    }
+
+    /// extent 块中校验和的偏移 (EXT4_EXTENT_TAIL_OFFSET)
+    fn extent_tail_offset(&self, block: &[u8]) -> Option<usize> {
+        let off = EXT4_EXT_HDR_SIZE + EXT4_EXT_ENTRY_SIZE * get_le16(block, 4) as usize;
+        (off + 4 <= block.len()).then_some(off)
+    }
+
+    /// 重新计算 extent 块的校验和 (ext4_extent_block_csum_set)
+    pub fn extent_block_csum_set(&self, seed: u32, block: &mut [u8]) {
+        if !self.has_metadata_csum() {
+            return;
+        }
+        if let Some(off) = self.extent_tail_offset(block) {
+            let csum = crc32c(seed, &block[..off]);
+            put_le32(block, off, csum);
+        }
+    }
+
+    /// 校验 extent 块 (ext4_extent_block_csum_verify)
+    pub fn extent_block_csum_verify(&self, seed: u32, block: &[u8]) -> bool {
+        if !self.has_metadata_csum() {
+            return true;
+        }
+        match self.extent_tail_offset(block) {
+            Some(off) => crc32c(seed, &block[..off]) == get_le32(block, off),
+            None => false,
+        }
+    }
+
+    /// 目录块中可存放目录项的长度：启用校验和时末尾留给 ext4_dir_entry_tail
+    pub fn dir_leaf_size(&self) -> usize {
+        if self.has_metadata_csum() {
+            self.block_size as usize - EXT4_DIR_TAIL_SIZE
+        } else {
+            self.block_size as usize
+        }
+    }
+
+    /// dx 索引块的 limit：启用校验和时最后一项的位置留给 dx_tail
+    pub fn dx_limit(&self, entries_off: usize) -> usize {
+        let limit = (self.block_size as usize - entries_off) / 8;
+        if self.has_metadata_csum() {
+            limit - EXT4_DX_TAIL_SIZE / 8
+        } else {
+            limit
+        }
+    }
+
+    /// 目录叶子块的校验和 (ext4_dirblock_csum)
+    fn dirblock_csum(&self, seed: u32, block: &[u8]) -> u32 {
+        crc32c(seed, &block[..block.len() - EXT4_DIR_TAIL_SIZE])
+    }
+
+    /// 在目录叶子块末尾写入校验和目录项 (ext4_initialize_dirent_tail + ext4_dirblock_csum_set)
+    pub fn dirblock_csum_set(&self, seed: u32, block: &mut [u8]) {
+        let off = block.len() - EXT4_DIR_TAIL_SIZE;
+        block[off..].fill(0);
+        put_le16(block, off + 4, EXT4_DIR_TAIL_SIZE as u16);
+        block[off + 7] = EXT4_DIR_TAIL_FT;
+        let csum = self.dirblock_csum(seed, block);
+        put_le32(block, off + 8, csum);
+    }
+
+    /// 重新计算 dx 索引块的校验和 (ext4_dx_csum_set)
+    ///
+    /// `count_off` 为 dx_countlimit 的偏移，dx_tail 在 limit 项之后
+    pub fn dx_csum_set(&self, seed: u32, block: &mut [u8], count_off: usize) {
+        if let Some((tail, csum)) = self.dx_csum(seed, block, count_off) {
+            put_le32(block, tail + 4, csum);
+        }
+    }
+
+    /// dx 索引块的校验和位置与数值 (ext4_dx_csum)
+    ///
+    /// 覆盖 count 项索引与 dt_reserved，dt_checksum 按零计算；limit 处放不下 dx_tail 时返回 None
+    fn dx_csum(&self, seed: u32, block: &[u8], count_off: usize) -> Option<(usize, u32)> {
+        let limit = get_le16(block, count_off) as usize;
+        let count = get_le16(block, count_off + 2) as usize;
+        let tail = count_off + 8 * limit;
+        if count > limit || tail + EXT4_DX_TAIL_SIZE > block.len() {
+            return None;
+        }
+        let mut csum = crc32c(seed, &block[..count_off + 8 * count]);
+        csum = crc32c(csum, &block[tail..tail + 4]);
+        csum = crc32c(csum, &[0; 4]);
+        Some((tail, csum))
+    }
+
+    /// 校验目录块 (ext4_dirblock_csum_verify / ext4_dx_csum_verify)
+    ///
+    /// 末尾有校验和目录项的是叶子块，否则按 dx_root / dx_node 的格式找到索引；都不是时视为错误
+    pub fn dirblock_csum_verify(&self, seed: u32, block: &[u8]) -> bool {
+        if !self.has_metadata_csum() {
+            return true;
+        }
+        if has_dirent_tail(block) {
+            return self.dirblock_csum(seed, block) == get_le32(block, block.len() - 4);
+        }
+        match dx_countlimit_offset(block).and_then(|off| self.dx_csum(seed, block, off)) {
+            Some((tail, csum)) => csum == get_le32(block, tail + 4),
+            None => false,
+        }
+    }
+
+    /// 校验从块缓存读入的目录块，通过后标记 BH_Verified
+    pub fn dirblock_verify(&self, dir: &Ext4Inode, bh: *mut BufferHead) -> Result<(), i32> {
+        if !self.has_metadata_csum() || buffer_verified(bh) {
+            return Ok(());
+        }
+        let block = unsafe { &(*bh).b_data[..self.block_size as usize] };
+        if !self.dirblock_csum_verify(self.inode_csum_seed(dir.ino, dir.generation), block) {
+            crate::println!("ext4: directory block {} of inode {} checksum does not match", unsafe { (*bh).b_blocknr }, dir.ino);
+            return Err(efsbadcrc());
+        }
+        set_buffer_verified(bh);
+        Ok(())
+    }
+}
+
+/// dx 索引块中 dx_countlimit 的偏移 (get_dx_countlimit)
+///
+/// dx_node 以一个 inode 为 0、覆盖整块的空目录项开头；dx_root 以 12 字节的 '.' 开头，
+/// 其后的 '..' 覆盖块的其余部分，dx_root_info 之后是索引
+pub fn dx_countlimit_offset(block: &[u8]) -> Option<usize> {
+    let rec_len = get_le16(block, 4) as usize;
+    if rec_len == block.len() && get_le32(block, 0) == 0 && block[6] == 0 {
+        return Some(8);
+    }
+    if rec_len == 12 && get_le16(block, 12 + 4) as usize == block.len() - 12 && block[24 + 5] == 8 {
+        return Some(24 + 8);
+    }
+    None
+}
+
+/// 块末尾是否是校验和目录项 (get_dirent_tail)
+pub fn has_dirent_tail(block: &[u8]) -> bool {
+    let off = block.len() - EXT4_DIR_TAIL_SIZE;
+    get_le32(block, off) == 0
+        && get_le16(block, off + 4) as usize == EXT4_DIR_TAIL_SIZE
+        && block[off + 6] == 0
+        && block[off + 7] == EXT4_DIR_TAIL_FT
+}
@@ -146,3 +146,36 @@ pub fn ext4_find_entry(dir_data: &[u8], block_size: usize, name: &str) -> Result
 
     Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32())
 }
+
+/// 从块内偏移 offset 起逐条解析一个目录块 (ext4_readdir 的块内循环)
+///
+/// offset 不在记录边界上（两次调用之间目录被修改）时从块头重新走一遍，
+/// 从 offset 之后的第一条记录继续 (ext4_readdir 的 i_version 检查)。
+/// 已删除的记录 (inode 为 0) 跳过；回调参数为目录项和它之后的块内偏移，返回 false 时停止
+///
+/// # 返回
+/// 停止处的块内偏移（回调拒绝的那一条），整块读完返回块大小；rec_len 损坏返回 EIO
+pub fn ext4_readdir_block(
+    data: &[u8],
+    offset: usize,
+    mut actor: impl FnMut(&Ext4DirEntry, usize) -> bool,
+) -> Result<usize, i32> {
+    let block_size = data.len();
+    let mut pos = 0;
+    while pos < block_size {
+        if pos + 8 > block_size {
+            return Err(errno::Errno::IOError.as_neg_i32());
+        }
+        let entry = unsafe { Ext4DirEntry::from_bytes(&data[pos..], block_size - pos) };
+        let rec_len = entry.rec_len as usize;
+        if rec_len < 8 || pos + rec_len > block_size || entry.name_len as usize + 8 > rec_len {
+            return Err(errno::Errno::IOError.as_neg_i32());
+        }
+        let next = pos + rec_len;
+        if pos >= offset && entry.inode != 0 && !actor(&entry, next) {
+            return Ok(pos);
+        }
+        pos = next;
+    }
+    Ok(block_size)
+}
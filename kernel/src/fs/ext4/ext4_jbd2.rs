@@ -0,0 +1,160 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 与 JBD2 日志的接口
+//!
+//! 参考: fs/ext4/ext4_jbd2.c, fs/ext4/super.c (ext4_load_journal)
+//!
+//! 位图、块组描述符、inode 表、extent 树和目录块的修改都经 handle_dirty_metadata
+//! 交给日志的运行中事务；文件系统没有日志时退回立即同步写回。
+
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+
+use super::Ext4FileSystem;
+use crate::errno;
+use crate::fs::bio::{self, BufferHead};
+use crate::fs::inode as vfs_inode;
+use crate::fs::jbd2::Journal;
+
+/// 文件系统有日志 (EXT4_FEATURE_COMPAT_HAS_JOURNAL)
+pub const EXT4_FEATURE_COMPAT_HAS_JOURNAL: u32 = 0x4;
+/// 日志需要重放 (EXT4_FEATURE_INCOMPAT_RECOVER)
+pub const EXT4_FEATURE_INCOMPAT_RECOVER: u32 = 0x4;
+
+/// 超级块在 0 号块中的偏移，以及其中的特性字段
+const EXT4_SB_OFFSET: usize = 1024;
+const EXT4_SB_FEATURE_INCOMPAT: usize = 0x60;
+
+fn get_le32(buf: &[u8], off: usize) -> u32 {
+    u32::from_le_bytes([buf[off], buf[off + 1], buf[off + 2], buf[off + 3]])
+}
+
+impl Ext4FileSystem {
+    /// 文件系统是否有内部日志 (ext4_has_feature_journal)
+    pub fn has_journal(&self) -> bool {
+        self.feature_compat & EXT4_FEATURE_COMPAT_HAS_JOURNAL != 0 && self.journal_inum != 0
+    }
+
+    /// 修改过的元数据块交给日志 (ext4_handle_dirty_metadata)
+    ///
+    /// 有日志时记入运行中的事务，由提交写日志、检查点写回原位置；
+    /// 没有日志时立即同步写回
+    pub fn handle_dirty_metadata(&self, bh: *mut BufferHead) -> Result<(), i32> {
+        match &self.journal {
+            Some(journal) => journal.dirty_metadata(bh),
+            None => unsafe {
+                (*bh).set_state_bit(bio::BufferState::BH_Dirty);
+                bio::sync_dirty_buffer(bh)
+            },
+        }
+    }
+
+    /// 把空闲计数写回超级块，再提交日志中运行的事务 (ext4_sync_fs)
+    pub fn sync_fs(&self) -> Result<(), i32> {
+        self.commit_super_counts()?;
+        match &self.journal {
+            Some(journal) => journal.force_commit(),
+            None => Ok(()),
+        }
+    }
+
+    /// 日志 inode 的块映射，合并为连续的段 (jbd2_journal_bmap)
+    fn journal_bmap(&self) -> Result<Vec<(u64, u64, u64)>, i32> {
+        let inode = self.read_inode_disk(self.journal_inum)?;
+        let nr_blocks = inode.size / self.block_size as u64;
+        let mut runs: Vec<(u64, u64, u64)> = Vec::new();
+        let mut lblk = 0;
+        while lblk < nr_blocks {
+            let (pblk, len) = if inode.has_extent() {
+                super::extent::ext4_ext_map_blocks(self, &inode, lblk)?
+            } else {
+                super::indirect::ext4_ind_map_blocks(self, &inode.block, lblk)?
+            };
+            // 日志文件不能有空洞
+            if pblk == 0 || len == 0 {
+                return Err(errno::Errno::IOError.as_neg_i32());
+            }
+            let len = len.min(nr_blocks - lblk);
+            let contiguous = runs.last().is_some_and(|&(l, p, n)| l + n == lblk && p + n == pblk);
+            if contiguous {
+                runs.last_mut().unwrap().2 += len;
+            } else {
+                runs.push((lblk, pblk, len));
+            }
+            lblk += len;
+        }
+        Ok(runs)
+    }
+
+    /// 加载日志，需要时重放 (ext4_load_journal)
+    ///
+    /// 日志不可用（块大小不是 4KB、格式或特性不支持）时打印原因并以无日志方式继续
+    pub fn load_journal(&mut self) -> Result<(), i32> {
+        if !self.has_journal() {
+            return Ok(());
+        }
+        // 块缓存以 4KB 为单位，日志块必须与之一致
+        if self.block_size != 4096 {
+            crate::println!("ext4: journal needs 4096-byte blocks, mounting without journal");
+            return Ok(());
+        }
+        let map = self.journal_bmap()?;
+        let journal = match Journal::load(self.device, self.block_size as usize, map) {
+            Ok(journal) => journal,
+            Err(e) if e == errno::Errno::InvalidArgument.as_neg_i32() => {
+                crate::println!("ext4: journal unusable, mounting without journal");
+                return Ok(());
+            }
+            Err(e) => return Err(e),
+        };
+        if journal.stats().nr_replayed > 0 {
+            // 重放改写了超级块、块组描述符和 inode 表，重新读取
+            vfs_inode::evict_inodes(self.s_dev);
+            self.init()?;
+        }
+        self.journal = Some(journal);
+        self.set_needs_recovery(true)?;
+        crate::println!("ext4: journal loaded from inode {}", self.journal_inum);
+        Ok(())
+    }
+
+    /// 卸载时写回全部事务并把日志标记为空 (ext4_put_super → jbd2_journal_destroy)
+    pub(super) fn destroy_journal(&mut self) {
+        let journal: Option<Arc<Journal>> = self.journal.take();
+        if let Some(journal) = journal {
+            if journal.destroy().is_ok() {
+                let _ = self.set_needs_recovery(false);
+            }
+        }
+    }
+
+    /// 设置或清除超级块的 INCOMPAT_RECOVER (ext4_set_feature_journal_needs_recovery)
+    ///
+    /// 挂载期间置位，其他实现挂载时据此重放日志而不是丢弃它；
+    /// 超级块不经日志直接写回，启用元数据校验和时同时更新超级块校验和
+    fn set_needs_recovery(&self, on: bool) -> Result<(), i32> {
+        let bh = bio::bread(self.device, 0).ok_or(errno::Errno::IOError.as_neg_i32())?;
+        let result = unsafe {
+            let sb = &mut (*bh).b_data[EXT4_SB_OFFSET..EXT4_SB_OFFSET + 1024];
+            let incompat = get_le32(sb, EXT4_SB_FEATURE_INCOMPAT);
+            let new = if on { incompat | EXT4_FEATURE_INCOMPAT_RECOVER } else { incompat & !EXT4_FEATURE_INCOMPAT_RECOVER };
+            sb[EXT4_SB_FEATURE_INCOMPAT..EXT4_SB_FEATURE_INCOMPAT + 4].copy_from_slice(&new.to_le_bytes());
+            super::csum::ext4_superblock_csum_set(sb);
+            (*bh).set_state_bit(bio::BufferState::BH_Dirty);
+            bio::sync_dirty_buffer(bh)
+        };
+        bio::brelse(bh);
+        result
+    }
+}
+
+/// 提交已挂载 ext4 的日志，sync 时调用
+pub fn sync_fs() -> Result<(), i32> {
+    match super::get_ext4_fs() {
+        Some(fs) => unsafe { (*fs).sync_fs() },
+        None => Ok(()),
+    }
+}
@@ -4,13 +4,44 @@
 //!
 //! ext4 extent tree 支持
 //!
+//! 参考: fs/ext4/extents.c
+//!
+//! 查找从 i_block 中的根节点逐层读入索引块直到叶子；写入时插入新的 extent：
+//! - 与前后 extent 逻辑、物理都连续且同为已初始化或未初始化时合并 (ext4_ext_try_to_merge)
+//! - 叶子已满时分裂 (ext4_ext_split)：在末尾追加时新建空叶子，否则移走后一半，
+//!   父节点插入指向新节点的索引；父节点也满时先分裂父节点
+//! - 根节点已满时整体移到新块中，树加深一层 (ext4_ext_grow_indepth)
+//!
+//! 未初始化 (unwritten) 的 extent 的 ee_len 大于 EXT_INIT_MAX_LEN，已分配但按空洞读出；
+//! 写入时把写入的部分分裂出来转为已初始化 (ext4_ext_convert_to_initialized)
+
+use alloc::vec::Vec;
 
 use crate::errno;
 use crate::fs::bio;
+use crate::fs::ext4::{csum, mballoc};
+use crate::fs::ext4::inode::Ext4Inode;
+use crate::fs::ext4::Ext4FileSystem;
 
 /// Extent header magic number
 pub const EXT4_EXT_MAGIC: u16 = 0xF30A;
 
+/// inode 使用 extent 的标志 (EXT4_EXTENTS_FL)
+pub const EXT4_EXTENTS_FL: u32 = 0x80000;
+
+/// 一个已初始化的 extent 最多覆盖的块数 (EXT_INIT_MAX_LEN)
+pub const EXT_INIT_MAX_LEN: u64 = 1 << 15;
+
+/// 一个未初始化的 extent 最多覆盖的块数 (EXT_UNWRITTEN_MAX_LEN)
+pub const EXT_UNWRITTEN_MAX_LEN: u64 = EXT_INIT_MAX_LEN - 1;
+
+/// 节点头和条目（extent 与索引）的大小
+const EXT_HDR_SIZE: usize = 12;
+const EXT_ENTRY_SIZE: usize = 12;
+
+/// i_block 的字节数
+const EXT_ROOT_SIZE: usize = 60;
+
 /// Extent header (in i_block or external block)
 #[repr(C)]
 #[derive(Debug, Clone, Copy)]
@@ -47,9 +78,34 @@ impl Ext4Extent {
         ((self.ee_start_hi as u64) << 32) | (self.ee_start_lo as u64)
     }
 
-    /// Get the length (number of blocks)
+    /// Get the length (number of blocks)，未初始化的 extent 去掉标记位 (ext4_ext_get_actual_len)
     pub fn length(&self) -> u32 {
-        self.ee_len as u32
+        if self.is_unwritten() {
+            self.ee_len as u32 - EXT_INIT_MAX_LEN as u32
+        } else {
+            self.ee_len as u32
+        }
+    }
+
+    /// 是否为未初始化的 extent (ext4_ext_is_unwritten)
+    pub fn is_unwritten(&self) -> bool {
+        self.ee_len as u64 > EXT_INIT_MAX_LEN
+    }
+
+    /// 同类 extent 合并后的最大长度
+    fn max_len(&self) -> u64 {
+        if self.is_unwritten() { EXT_UNWRITTEN_MAX_LEN } else { EXT_INIT_MAX_LEN }
+    }
+
+    /// 按实际长度构造 extent (ext4_ext_mark_unwritten)
+    fn new(lblk: u64, len: u64, pblk: u64, unwritten: bool) -> Self {
+        let ee_len = if unwritten { len + EXT_INIT_MAX_LEN } else { len };
+        Self {
+            ee_block: lblk as u32,
+            ee_len: ee_len as u16,
+            ee_start_hi: (pblk >> 32) as u16,
+            ee_start_lo: pblk as u32,
+        }
     }
 }
 
@@ -85,129 +141,517 @@ pub fn get_extent_header(i_block: &[u32; 15]) -> &Ext4ExtentHeader {
 ///
 /// # 参数
 /// - `fs`: ext4 文件系统
-/// - `i_block`: inode 的 i_block 数组
+/// - `inode`: 使用 extent 的 inode
 /// - `logical_block`: 要查找的逻辑块号
 ///
 /// # 返回
 /// 物理块号，如果未找到返回 0
 pub fn ext4_ext_get_block(
     fs: &crate::fs::ext4::Ext4FileSystem,
-    i_block: &[u32; 15],
+    inode: &Ext4Inode,
     logical_block: u64,
 ) -> Result<u64, i32> {
-    let header = get_extent_header(i_block);
+    ext4_ext_map_blocks(fs, inode, logical_block).map(|(block, _)| block)
+}
+
+/// 查找逻辑块所在的整段映射 (ext4_ext_map_blocks)
+///
+/// # 返回
+/// (起始物理块号, 从 logical_block 起连续的块数)；逻辑块未分配时物理块号为 0，
+/// 块数为到下一个 extent 的空洞长度（之后没有 extent 时为 u64::MAX - logical_block）。
+/// 未初始化的 extent 按空洞返回，块数到它的末尾为止
+pub fn ext4_ext_map_blocks(
+    fs: &Ext4FileSystem,
+    inode: &Ext4Inode,
+    logical_block: u64,
+) -> Result<(u64, u64), i32> {
+    let mut node = ExtNode::from_root(&inode.block)?;
 
-    // 验证 magic
-    if header.eh_magic != EXT4_EXT_MAGIC {
-        return Err(errno::Errno::IOError.as_neg_i32());
+    // 下一层索引的起始逻辑块限定了查找结果的范围
+    let mut bound = u64::MAX;
+    while node.depth > 0 {
+        if node.entries.is_empty() {
+            return Ok((0, bound - logical_block));
+        }
+        let pos = node.search(logical_block);
+        if let Some(next) = node.entries.get(pos + 1) {
+            bound = bound.min(entry_key(next) as u64);
+        }
+        let idx = decode_idx(&node.entries[pos]);
+        if (idx.ei_block as u64) > logical_block {
+            // 在第一个索引之前
+            return Ok((0, (idx.ei_block as u64).min(bound) - logical_block));
+        }
+        node = ExtNode::load(fs, inode, idx.leaf_block())?;
     }
 
-    // 递归查找 extent
-    find_block_in_extent_tree(fs, i_block, logical_block, 0)
+    let extents: Vec<Ext4Extent> = node.entries.iter().map(decode_extent).collect();
+    let (block, len) = map_in_leaf(&extents, logical_block);
+    Ok((block, len.min(bound - logical_block)))
 }
 
-/// 在 extent 树中查找逻辑块
-fn find_block_in_extent_tree(
-    fs: &crate::fs::ext4::Ext4FileSystem,
-    data: &[u32; 15],
-    logical_block: u64,
-    depth: u32,
-) -> Result<u64, i32> {
-    let header = unsafe { &*(data.as_ptr() as *const Ext4ExtentHeader) };
-
-    if header.eh_depth == 0 {
-        // 叶子节点：在 i_block 数组中查找 extent
-        let entries = unsafe {
-            core::slice::from_raw_parts(
-                (data.as_ptr() as *const u8).add(core::mem::size_of::<Ext4ExtentHeader>()) as *const Ext4Extent,
-                header.eh_entries as usize
-            )
-        };
-
-        for ext in entries {
-            let start = ext.ee_block as u64;
-            let end = start + ext.length() as u64;
+/// 在叶子节点的 extent 中查找逻辑块
+fn map_in_leaf(entries: &[Ext4Extent], logical_block: u64) -> (u64, u64) {
+    let mut hole_end = u64::MAX;
+    for ext in entries {
+        let start = ext.ee_block as u64;
+        let end = start + ext.length() as u64;
 
-            if logical_block >= start && logical_block < end {
-                // 找到了！计算偏移
-                let offset = logical_block - start;
-                return Ok(ext.start_block() + offset);
+        if logical_block >= start && logical_block < end {
+            if ext.is_unwritten() {
+                return (0, end - logical_block);
             }
+            // 找到了！计算偏移
+            let offset = logical_block - start;
+            return (ext.start_block() + offset, end - logical_block);
         }
+        if start > logical_block {
+            hole_end = hole_end.min(start);
+        }
+    }
 
-        // 未找到
-        Ok(0)
-    } else {
-        // 内部节点：需要读取子节点块
-        // 对于简单的 rootfs，通常 depth = 0，这里暂不实现 depth > 0 的情况
-        Err(errno::Errno::IOError.as_neg_i32())
+    // 未找到：空洞延伸到下一个 extent
+    (0, hole_end - logical_block)
+}
+
+/// 条目的起始逻辑块号（extent 的 ee_block 与索引的 ei_block 位置相同）
+fn entry_key(entry: &[u8; EXT_ENTRY_SIZE]) -> u32 {
+    u32::from_le_bytes([entry[0], entry[1], entry[2], entry[3]])
+}
+
+fn decode_extent(entry: &[u8; EXT_ENTRY_SIZE]) -> Ext4Extent {
+    Ext4Extent {
+        ee_block: entry_key(entry),
+        ee_len: u16::from_le_bytes([entry[4], entry[5]]),
+        ee_start_hi: u16::from_le_bytes([entry[6], entry[7]]),
+        ee_start_lo: u32::from_le_bytes([entry[8], entry[9], entry[10], entry[11]]),
     }
 }
 
-/// 从外部块读取 extent 并查找逻辑块
-#[allow(dead_code)]
-fn find_block_in_external_extent(
-    fs: &crate::fs::ext4::Ext4FileSystem,
-    block_num: u64,
-    logical_block: u64,
-) -> Result<u64, i32> {
-    unsafe {
-        let bh = bio::bread(fs.device, block_num)
-            .ok_or(errno::Errno::IOError.as_neg_i32())?;
+fn encode_extent(ext: &Ext4Extent) -> [u8; EXT_ENTRY_SIZE] {
+    let mut entry = [0u8; EXT_ENTRY_SIZE];
+    entry[0..4].copy_from_slice(&ext.ee_block.to_le_bytes());
+    entry[4..6].copy_from_slice(&ext.ee_len.to_le_bytes());
+    entry[6..8].copy_from_slice(&ext.ee_start_hi.to_le_bytes());
+    entry[8..12].copy_from_slice(&ext.ee_start_lo.to_le_bytes());
+    entry
+}
 
-        let data = &(*bh).b_data;
-        let header = &*(data.as_ptr() as *const Ext4ExtentHeader);
+/// left 与紧接其后的 right 能否合并为一个 extent (ext4_can_extents_be_merged)
+fn can_merge(left: &Ext4Extent, right: &Ext4Extent) -> bool {
+    let len = left.length() as u64;
+    left.is_unwritten() == right.is_unwritten()
+        && left.ee_block as u64 + len == right.ee_block as u64
+        && left.start_block() + len == right.start_block()
+        && len + right.length() as u64 <= left.max_len()
+}
 
-        if header.eh_magic != EXT4_EXT_MAGIC {
-            bio::brelse(bh);
+fn decode_idx(entry: &[u8; EXT_ENTRY_SIZE]) -> Ext4ExtentIdx {
+    Ext4ExtentIdx {
+        ei_block: entry_key(entry),
+        ei_leaf_lo: u32::from_le_bytes([entry[4], entry[5], entry[6], entry[7]]),
+        ei_leaf_hi: u16::from_le_bytes([entry[8], entry[9]]),
+        ei_unused: 0,
+    }
+}
+
+fn encode_idx(lblk: u32, child: u64) -> [u8; EXT_ENTRY_SIZE] {
+    let mut entry = [0u8; EXT_ENTRY_SIZE];
+    entry[0..4].copy_from_slice(&lblk.to_le_bytes());
+    entry[4..8].copy_from_slice(&(child as u32).to_le_bytes());
+    entry[8..10].copy_from_slice(&((child >> 32) as u16).to_le_bytes());
+    entry
+}
+
+/// 内存中的 extent 树节点 (struct ext4_ext_path 的一层)
+struct ExtNode {
+    /// 节点所在块号，0 表示 inode 的 i_block
+    block: u64,
+    /// 0 为叶子节点
+    depth: u16,
+    /// 最多容纳的条目数
+    max: u16,
+    /// 按起始逻辑块号排序的条目（叶子为 extent，内部节点为索引）
+    entries: Vec<[u8; EXT_ENTRY_SIZE]>,
+}
+
+impl ExtNode {
+    /// 按磁盘格式解析节点
+    fn parse(data: &[u8], block: u64) -> Result<Self, i32> {
+        let header = unsafe { (data.as_ptr() as *const Ext4ExtentHeader).read_unaligned() };
+        let count = header.eh_entries as usize;
+        if header.eh_magic != EXT4_EXT_MAGIC || EXT_HDR_SIZE + count * EXT_ENTRY_SIZE > data.len() {
             return Err(errno::Errno::IOError.as_neg_i32());
         }
+        let entries = (0..count)
+            .map(|i| {
+                let off = EXT_HDR_SIZE + i * EXT_ENTRY_SIZE;
+                let mut entry = [0u8; EXT_ENTRY_SIZE];
+                entry.copy_from_slice(&data[off..off + EXT_ENTRY_SIZE]);
+                entry
+            })
+            .collect();
+        Ok(Self { block, depth: header.eh_depth, max: header.eh_max, entries })
+    }
 
-        if header.eh_depth == 0 {
-            // 叶子节点
-            let entries = core::slice::from_raw_parts(
-                data.as_ptr().add(core::mem::size_of::<Ext4ExtentHeader>()) as *const Ext4Extent,
-                header.eh_entries as usize
-            );
+    /// 按磁盘格式写出节点，data 中条目之后的部分清零
+    fn serialize(&self, data: &mut [u8]) {
+        let header = Ext4ExtentHeader {
+            eh_magic: EXT4_EXT_MAGIC,
+            eh_entries: self.entries.len() as u16,
+            eh_max: self.max,
+            eh_depth: self.depth,
+            eh_generation: 0,
+        };
+        data.fill(0);
+        unsafe { (data.as_mut_ptr() as *mut Ext4ExtentHeader).write_unaligned(header) };
+        for (i, entry) in self.entries.iter().enumerate() {
+            let off = EXT_HDR_SIZE + i * EXT_ENTRY_SIZE;
+            data[off..off + EXT_ENTRY_SIZE].copy_from_slice(entry);
+        }
+    }
 
-            for ext in entries {
-                let start = ext.ee_block as u64;
-                let end = start + ext.length() as u64;
+    /// i_block 中的根节点
+    fn from_root(i_block: &[u32; 15]) -> Result<Self, i32> {
+        let data = unsafe { core::slice::from_raw_parts(i_block.as_ptr() as *const u8, EXT_ROOT_SIZE) };
+        Self::parse(data, 0)
+    }
 
-                if logical_block >= start && logical_block < end {
-                    let offset = logical_block - start;
+    /// 从块中读入节点，启用元数据校验和时校验块尾的 ext4_extent_tail (__read_extent_tree_block)
+    fn load(fs: &Ext4FileSystem, inode: &Ext4Inode, block: u64) -> Result<Self, i32> {
+        unsafe {
+            let bh = bio::bread(fs.device, block).ok_or(errno::Errno::IOError.as_neg_i32())?;
+            let data = &(*bh).b_data[..fs.block_size as usize];
+            if fs.has_metadata_csum() && !csum::buffer_verified(bh) {
+                let seed = fs.inode_csum_seed(inode.ino, inode.generation);
+                if !fs.extent_block_csum_verify(seed, data) {
+                    crate::println!("ext4: extent block {} of inode {} checksum does not match", block, inode.ino);
                     bio::brelse(bh);
-                    return Ok(ext.start_block() + offset);
+                    return Err(csum::efsbadcrc());
                 }
+                csum::set_buffer_verified(bh);
             }
-
+            let result = Self::parse(data, block);
             bio::brelse(bh);
-            Ok(0)
-        } else {
-            // 内部节点：递归查找
-            let indices = core::slice::from_raw_parts(
-                data.as_ptr().add(core::mem::size_of::<Ext4ExtentHeader>()) as *const Ext4ExtentIdx,
-                header.eh_entries as usize
-            );
-
-            // 二分查找合适的索引
-            let mut child_block = 0;
-            for idx in indices {
-                if logical_block >= idx.ei_block as u64 {
-                    child_block = idx.leaf_block();
-                } else {
-                    break;
-                }
-            }
+            result
+        }
+    }
 
+    /// 写回节点：根节点写入 i_block，其他节点同步写回所在的块
+    fn store(&self, fs: &Ext4FileSystem, inode: &mut Ext4Inode) -> Result<(), i32> {
+        if self.block == 0 {
+            let mut data = [0u8; EXT_ROOT_SIZE];
+            self.serialize(&mut data);
+            for (word, bytes) in inode.block.iter_mut().zip(data.chunks_exact(4)) {
+                *word = u32::from_le_bytes([bytes[0], bytes[1], bytes[2], bytes[3]]);
+            }
+            return Ok(());
+        }
+        unsafe {
+            let bh = bio::bread(fs.device, self.block).ok_or(errno::Errno::IOError.as_neg_i32())?;
+            let data = &mut (*bh).b_data[..fs.block_size as usize];
+            self.serialize(data);
+            fs.extent_block_csum_set(fs.inode_csum_seed(inode.ino, inode.generation), data);
+            let result = fs.handle_dirty_metadata(bh);
             bio::brelse(bh);
+            result
+        }
+    }
+
+    /// 最后一个起始逻辑块号不大于 lblk 的条目，都大于时取第一个 (ext4_ext_binsearch)
+    fn search(&self, lblk: u64) -> usize {
+        self.entries
+            .partition_point(|e| entry_key(e) as u64 <= lblk)
+            .saturating_sub(1)
+    }
+
+    fn is_full(&self) -> bool {
+        self.entries.len() >= self.max as usize
+    }
+}
+
+/// 把 inode 初始化为空的 extent 树 (ext4_ext_tree_init)
+pub fn ext4_ext_tree_init(inode: &mut Ext4Inode) {
+    let root = ExtNode {
+        block: 0,
+        depth: 0,
+        max: ((EXT_ROOT_SIZE - EXT_HDR_SIZE) / EXT_ENTRY_SIZE) as u16,
+        entries: Vec::new(),
+    };
+    inode.flags |= EXT4_EXTENTS_FL;
+    inode.block = [0; 15];
+    let mut data = [0u8; EXT_ROOT_SIZE];
+    root.serialize(&mut data);
+    for (word, bytes) in inode.block.iter_mut().zip(data.chunks_exact(4)) {
+        *word = u32::from_le_bytes([bytes[0], bytes[1], bytes[2], bytes[3]]);
+    }
+}
+
+/// 从根到包含 lblk 的叶子的路径 (ext4_find_extent)
+///
+/// 每层为 (节点, 下一层所在的条目下标)
+fn find_path(fs: &Ext4FileSystem, inode: &Ext4Inode, lblk: u64) -> Result<Vec<(ExtNode, usize)>, i32> {
+    let mut path = Vec::new();
+    let mut node = ExtNode::from_root(&inode.block)?;
+    loop {
+        let pos = node.search(lblk);
+        if node.depth == 0 {
+            path.push((node, pos));
+            return Ok(path);
+        }
+        let child = node.entries.get(pos).map(|e| decode_idx(e).leaf_block());
+        path.push((node, pos));
+        match child {
+            Some(block) => node = ExtNode::load(fs, inode, block)?,
+            None => return Err(errno::Errno::IOError.as_neg_i32()),
+        }
+    }
+}
+
+/// 为树节点分配一个块，靠近 goal
+fn alloc_node_block(fs: &Ext4FileSystem, inode: &mut Ext4Inode, goal: u64) -> Result<u64, i32> {
+    let (block, _) = mballoc::ext4_mb_new_blocks(fs, 0, 0, goal, 1)?;
+    inode.blocks += fs.block_size as u64 / 512;
+    Ok(block)
+}
+
+/// 节点的第一个条目变小后更新上层索引的起始逻辑块号 (ext4_ext_correct_indexes)
+fn correct_indexes(
+    fs: &Ext4FileSystem,
+    inode: &mut Ext4Inode,
+    path: &mut [(ExtNode, usize)],
+    mut level: usize,
+) -> Result<(), i32> {
+    while level > 0 {
+        let first = match path[level].0.entries.first() {
+            Some(entry) => entry_key(entry),
+            None => return Ok(()),
+        };
+        let (parent, pos) = &mut path[level - 1];
+        let pos = *pos;
+        if entry_key(&parent.entries[pos]) <= first {
+            return Ok(());
+        }
+        parent.entries[pos][0..4].copy_from_slice(&first.to_le_bytes());
+        parent.store(fs, inode)?;
+        if pos != 0 {
+            return Ok(());
+        }
+        level -= 1;
+    }
+    Ok(())
+}
+
+/// 整棵树下移一层：根节点的条目移到新块，根只保留指向它的索引 (ext4_ext_grow_indepth)
+fn grow_indepth(fs: &Ext4FileSystem, inode: &mut Ext4Inode, goal: u64) -> Result<(), i32> {
+    let mut root = ExtNode::from_root(&inode.block)?;
+    let block = alloc_node_block(fs, inode, goal)?;
+    let first = root.entries.first().map_or(0, entry_key);
+    let child = ExtNode {
+        block,
+        depth: root.depth,
+        max: ((fs.block_size as usize - EXT_HDR_SIZE) / EXT_ENTRY_SIZE) as u16,
+        entries: core::mem::take(&mut root.entries),
+    };
+    child.store(fs, inode)?;
+    root.depth += 1;
+    root.entries.push(encode_idx(first, block));
+    root.store(fs, inode)
+}
+
+/// 为第 level 层节点腾出一个条目的位置 (ext4_ext_create_new_leaf)
+///
+/// 根节点满时加深一层；其他节点满时分裂，父节点也满时先处理父节点。
+/// 完成后路径失效，调用者重新查找
+fn make_room(
+    fs: &Ext4FileSystem,
+    inode: &mut Ext4Inode,
+    path: &mut [(ExtNode, usize)],
+    level: usize,
+    lblk: u64,
+    goal: u64,
+) -> Result<(), i32> {
+    if level == 0 {
+        return grow_indepth(fs, inode, goal);
+    }
+    if path[level - 1].0.is_full() {
+        return make_room(fs, inode, path, level - 1, lblk, goal);
+    }
 
-            if child_block == 0 {
-                return Ok(0);
+    // 叶子在末尾追加时新建空叶子，顺序写入的文件叶子都是满的；否则移走后一半
+    let node = &mut path[level].0;
+    let insert_at = node.entries.partition_point(|e| entry_key(e) as u64 <= lblk);
+    let at = if node.depth == 0 && insert_at == node.entries.len() {
+        insert_at
+    } else {
+        node.entries.len() / 2
+    };
+    let block = alloc_node_block(fs, inode, goal)?;
+    let node = &mut path[level].0;
+    let sibling = ExtNode {
+        block,
+        depth: node.depth,
+        max: ((fs.block_size as usize - EXT_HDR_SIZE) / EXT_ENTRY_SIZE) as u16,
+        entries: node.entries.split_off(at),
+    };
+    let key = sibling.entries.first().map_or(lblk as u32, entry_key);
+    sibling.store(fs, inode)?;
+    path[level].0.store(fs, inode)?;
+
+    let (parent, pos) = &mut path[level - 1];
+    parent.entries.insert(*pos + 1, encode_idx(key, block));
+    parent.store(fs, inode)
+}
+
+/// 插入一个不超过同类最大长度的 extent
+fn insert_one(fs: &Ext4FileSystem, inode: &mut Ext4Inode, new: Ext4Extent) -> Result<(), i32> {
+    let lblk = new.ee_block as u64;
+    loop {
+        let mut path = find_path(fs, inode, lblk)?;
+        let level = path.len() - 1;
+        let leaf = &mut path[level].0;
+        let pos = leaf.entries.partition_point(|e| entry_key(e) as u64 <= lblk);
+
+        // 1. 与前后的 extent 连续：延长它们，三段都连续时合并为一个
+        let prev = pos.checked_sub(1).map(|i| decode_extent(&leaf.entries[i])).filter(|p| can_merge(p, &new));
+        let next = leaf.entries.get(pos).map(decode_extent).filter(|n| can_merge(&new, n));
+        let len = new.length() as u64;
+        match (prev, next) {
+            (Some(p), Some(n)) if p.length() as u64 + len + n.length() as u64 <= p.max_len() => {
+                let merged = p.length() as u64 + len + n.length() as u64;
+                leaf.entries[pos - 1] = encode_extent(&Ext4Extent::new(
+                    p.ee_block as u64, merged, p.start_block(), p.is_unwritten(),
+                ));
+                leaf.entries.remove(pos);
+                return leaf.store(fs, inode);
+            }
+            (Some(p), _) => {
+                let merged = p.length() as u64 + len;
+                leaf.entries[pos - 1] = encode_extent(&Ext4Extent::new(
+                    p.ee_block as u64, merged, p.start_block(), p.is_unwritten(),
+                ));
+                return leaf.store(fs, inode);
+            }
+            (None, Some(n)) => {
+                let merged = len + n.length() as u64;
+                leaf.entries[pos] = encode_extent(&Ext4Extent::new(lblk, merged, new.start_block(), n.is_unwritten()));
+                leaf.store(fs, inode)?;
+                if pos == 0 {
+                    correct_indexes(fs, inode, &mut path, level)?;
+                }
+                return Ok(());
             }
+            (None, None) => {}
+        }
 
-            // 递归查找
-            find_block_in_external_extent(fs, child_block, logical_block)
+        // 2. 叶子有空位：按顺序插入
+        if !leaf.is_full() {
+            leaf.entries.insert(pos, encode_extent(&new));
+            leaf.store(fs, inode)?;
+            if pos == 0 {
+                correct_indexes(fs, inode, &mut path, level)?;
+            }
+            return Ok(());
         }
+
+        // 3. 腾出位置后重新查找
+        make_room(fs, inode, &mut path, level, lblk, new.start_block())?;
+    }
+}
+
+/// 按同类最大长度切段插入
+fn insert_range(
+    fs: &Ext4FileSystem,
+    inode: &mut Ext4Inode,
+    lblk: u64,
+    pblk: u64,
+    len: u64,
+    unwritten: bool,
+) -> Result<(), i32> {
+    if !inode.has_extent() || lblk + len > u32::MAX as u64 {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    let max = if unwritten { EXT_UNWRITTEN_MAX_LEN } else { EXT_INIT_MAX_LEN };
+    let mut done = 0;
+    while done < len {
+        let n = (len - done).min(max);
+        insert_one(fs, inode, Ext4Extent::new(lblk + done, n, pblk + done, unwritten))?;
+        done += n;
+    }
+    Ok(())
+}
+
+/// 把逻辑块 [lblk, lblk + len) 映射到物理块 pblk 起 (ext4_ext_insert_extent)
+///
+/// 范围必须是空洞；树节点需要的块由多块分配器分配并计入 i_blocks，
+/// 根节点的修改写入 inode.block，由调用者写回 inode
+pub fn ext4_ext_insert_extent(
+    fs: &Ext4FileSystem,
+    inode: &mut Ext4Inode,
+    lblk: u64,
+    pblk: u64,
+    len: u64,
+) -> Result<(), i32> {
+    insert_range(fs, inode, lblk, pblk, len, false)
+}
+
+/// 把 [lblk, lblk + len) 映射为未初始化的 extent (EXT4_GET_BLOCKS_UNWRIT_EXT)
+///
+/// 块已分配但内容未写入，读出为 0；约定与 ext4_ext_insert_extent 相同
+pub fn ext4_ext_insert_unwritten(
+    fs: &Ext4FileSystem,
+    inode: &mut Ext4Inode,
+    lblk: u64,
+    pblk: u64,
+    len: u64,
+) -> Result<(), i32> {
+    insert_range(fs, inode, lblk, pblk, len, true)
+}
+
+/// 写入未初始化的 extent 之前把写入的部分转为已初始化 (ext4_ext_convert_to_initialized)
+///
+/// lblk 所在的 extent 被分裂为至多三段：前后未写入的部分仍为未初始化，
+/// [lblk, lblk + len) 与 extent 重叠的部分为已初始化，并与相邻的已初始化 extent 合并 (ext4_split_extent)
+///
+/// # 返回
+/// Some((物理块号, 块数))：从 lblk 起转换的部分，块数不超过 len；
+/// lblk 不在未初始化的 extent 中返回 None
+pub fn ext4_ext_convert_to_initialized(
+    fs: &Ext4FileSystem,
+    inode: &mut Ext4Inode,
+    lblk: u64,
+    len: u64,
+) -> Result<Option<(u64, u64)>, i32> {
+    if !inode.has_extent() || len == 0 {
+        return Ok(None);
+    }
+    let mut leaf = match find_path(fs, inode, lblk)?.pop() {
+        Some((node, _)) => node,
+        None => return Err(errno::Errno::IOError.as_neg_i32()),
+    };
+    let pos = match leaf.entries.partition_point(|e| entry_key(e) as u64 <= lblk).checked_sub(1) {
+        Some(pos) => pos,
+        None => return Ok(None),
+    };
+    let ext = decode_extent(&leaf.entries[pos]);
+    let start = ext.ee_block as u64;
+    let end = start + ext.length() as u64;
+    if !ext.is_unwritten() || lblk >= end {
+        return Ok(None);
+    }
+    let n = len.min(end - lblk);
+    let pblk = ext.start_block() + (lblk - start);
+
+    // 先移走原 extent，再依次插入三段；各段都在原 extent 的范围内，查找仍落在原来的叶子，
+    // 叶子满时由插入分裂
+    leaf.entries.remove(pos);
+    leaf.store(fs, inode)?;
+    if lblk > start {
+        insert_one(fs, inode, Ext4Extent::new(start, lblk - start, ext.start_block(), true))?;
+    }
+    insert_one(fs, inode, Ext4Extent::new(lblk, n, pblk, false))?;
+    if lblk + n < end {
+        insert_one(fs, inode, Ext4Extent::new(lblk + n, end - lblk - n, pblk + n, true))?;
     }
+    Ok(Some((pblk, n)))
 }
@@ -0,0 +1,136 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 extent 状态缓存
+//!
+//! 参考: fs/ext4/extents_status.c
+//!
+//! 按逻辑块号缓存 inode 的块映射 (logical, physical, len)：读取只解析用到的块，
+//! 第一次访问某个块时从 extent 树或间接块读入它所在的整段映射，
+//! 之后同一段内的块直接由缓存得到，不再访问磁盘上的映射结构。
+//! 物理块号为 0 的段表示空洞。块分配改变映射后由调用者清空缓存
+
+use alloc::collections::BTreeMap;
+
+/// 每个 inode 最多缓存的段数，超出时整体清空重新建立
+const EXT4_ES_MAX_EXTENTS: usize = 512;
+
+/// 一段连续的块映射 (struct extent_status)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct ExtentStatus {
+    /// 起始逻辑块号
+    pub lblk: u64,
+    /// 块数
+    pub len: u64,
+    /// 起始物理块号，0 表示空洞
+    pub pblk: u64,
+}
+
+impl ExtentStatus {
+    /// 是否为空洞
+    #[inline]
+    pub fn is_hole(&self) -> bool {
+        self.pblk == 0
+    }
+
+    /// 结束逻辑块号（不包含）
+    #[inline]
+    pub fn end(&self) -> u64 {
+        self.lblk.saturating_add(self.len)
+    }
+
+    /// 逻辑块是否在本段内
+    #[inline]
+    pub fn contains(&self, lblk: u64) -> bool {
+        lblk >= self.lblk && lblk < self.end()
+    }
+
+    /// 逻辑块对应的物理块号，空洞返回 0
+    #[inline]
+    pub fn map(&self, lblk: u64) -> u64 {
+        if self.is_hole() {
+            0
+        } else {
+            self.pblk + (lblk - self.lblk)
+        }
+    }
+
+    /// other 紧接在本段之后且映射连续
+    fn can_merge(&self, other: &ExtentStatus) -> bool {
+        self.end() == other.lblk
+            && self.is_hole() == other.is_hole()
+            && (self.is_hole() || self.pblk + self.len == other.pblk)
+    }
+}
+
+/// inode 的 extent 状态树 (struct ext4_es_tree)
+///
+/// 以起始逻辑块号为键，段之间互不重叠
+pub struct ExtentStatusTree {
+    tree: BTreeMap<u64, ExtentStatus>,
+}
+
+impl ExtentStatusTree {
+    /// 创建空树
+    pub const fn new() -> Self {
+        Self { tree: BTreeMap::new() }
+    }
+
+    /// 缓存的段数
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.tree.len()
+    }
+
+    /// 查找包含 lblk 的段 (ext4_es_lookup_extent)
+    pub fn lookup(&self, lblk: u64) -> Option<ExtentStatus> {
+        self.tree
+            .range(..=lblk)
+            .next_back()
+            .map(|(_, es)| *es)
+            .filter(|es| es.contains(lblk))
+    }
+
+    /// 加入一段映射，与相邻且连续的段合并 (ext4_es_cache_extent)
+    ///
+    /// 与已缓存的后一段重叠的部分截掉；es.lblk 不能已被缓存
+    pub fn insert(&mut self, mut es: ExtentStatus) {
+        debug_assert!(self.lookup(es.lblk).is_none());
+        if es.len == 0 {
+            return;
+        }
+        if self.tree.len() >= EXT4_ES_MAX_EXTENTS {
+            self.tree.clear();
+        }
+
+        if let Some((_, next)) = self.tree.range(es.lblk..).next() {
+            es.len = es.len.min(next.lblk - es.lblk);
+        }
+        if let Some(next) = self.tree.get(&es.end()).copied() {
+            if es.can_merge(&next) {
+                self.tree.remove(&next.lblk);
+                es.len += next.len;
+            }
+        }
+        if let Some((_, prev)) = self.tree.range_mut(..es.lblk).next_back() {
+            if prev.can_merge(&es) {
+                prev.len += es.len;
+                return;
+            }
+        }
+        self.tree.insert(es.lblk, es);
+    }
+
+    /// 清空缓存 (ext4_es_remove_extent)
+    pub fn clear(&mut self) {
+        self.tree.clear();
+    }
+}
+
+impl Default for ExtentStatusTree {
+    fn default() -> Self {
+        Self::new()
+    }
+}
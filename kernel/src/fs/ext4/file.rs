@@ -8,192 +8,465 @@
 //! 完全...
 //! 参考: fs/ext4/file.c
 
+use alloc::collections::BTreeMap;
+use alloc::sync::Arc;
+use spin::Mutex;
+
 use crate::errno;
+use crate::drivers::blkdev;
 use crate::fs::bio;
-use crate::fs::ext4::indirect;
+use crate::fs::ext4::{extent, indirect, inline, mballoc};
+use crate::fs::ext4::extents_status::{ExtentStatus, ExtentStatusTree};
+use crate::fs::ext4::inode::Ext4Inode;
+use crate::fs::ext4::Ext4FileSystem;
+use crate::mm::filemap::{self, FileMapping, FileRaState, MappingSource};
+use crate::mm::PAGE_SIZE;
+
+/// ext4 文件作为页缓存的数据来源 (ext4_aops)
+///
+/// 页缓存登记后一直存在，不能引用调用者临时创建的 Ext4FileSystem：
+/// 只复制块设备和块大小。inode 在第一次访问时复制一份作为内存中的 inode (icache)，
+/// 之后大小与块映射以它为准：写入扩展 i_size，回写分配块后更新 i_block 并写回磁盘。
+/// 块映射按段缓存在 extent 状态树中，读页时只解析页覆盖的块。
+/// inline 数据的文件从 inode 表所在的块读取 system.data，需要 inode 的位置
+pub struct Ext4PageSource {
+    fs: Ext4FileSystem,
+    inode: Mutex<Ext4Inode>,
+    extents: Mutex<ExtentStatusTree>,
+    /// inode 在 inode 表中的位置 (块号, 块内偏移)
+    iloc: Option<(u64, usize)>,
+}
 
-pub fn ext4_file_read(
-    fs: &crate::fs::ext4::Ext4FileSystem,
-    inode: &crate::fs::ext4::inode::Ext4Inode,
-    offset: u64,
-    buf: &mut [u8],
-) -> Result<usize, i32> {
-    let file_size = inode.get_size();
+unsafe impl Sync for Ext4PageSource {}
 
-    if offset >= file_size {
-        return Ok(0);  // EOF
-    }
+impl Ext4PageSource {
+    /// 查找逻辑块所在的映射段，未缓存时从 extent 树或间接块读入 (ext4_map_blocks)
+    fn map_blocks(&self, inode: &Ext4Inode, lblk: u64) -> Result<ExtentStatus, i32> {
+        if let Some(es) = self.extents.lock().lookup(lblk) {
+            return Ok(es);
+        }
 
-    let available = file_size - offset;
-    let to_read = core::cmp::min(buf.len() as u64, available) as usize;
+        let (pblk, len) = if inode.has_extent() {
+            extent::ext4_ext_map_blocks(&self.fs, inode, lblk)?
+        } else {
+            indirect::ext4_ind_map_blocks(&self.fs, &inode.block, lblk)?
+        };
+        // 空洞只缓存到文件末尾，之后写入扩展文件时不会残留过长的空洞
+        let block_size = self.fs.block_size as u64;
+        let nr_blocks = (inode.get_size() + block_size - 1) / block_size;
+        let len = if pblk == 0 { len.min(nr_blocks.saturating_sub(lblk)).max(1) } else { len };
+
+        let es = ExtentStatus { lblk, len, pblk };
+        self.extents.lock().insert(es);
+        Ok(es)
+    }
+}
 
-    let blocks = inode.get_data_blocks(fs)?;
-    let block_size = fs.block_size as usize;
+impl Ext4PageSource {
+    /// 读取从 page_start 开始的文件内容到 buf (ext4_mpage_readpages)
+    ///
+    /// 物理上连续的块合并为一次块设备请求，直接读入 buf 而不经过块缓存；
+    /// 各段在同一个 plug 中提交，磁盘上相邻的段在请求队列中再合并；
+    /// 未分配的块（稀疏文件）读作 0
+    ///
+    /// # 返回
+    /// 实际读取的字节数，读盘出错返回 0
+    fn read_range(&self, page_start: usize, buf: &mut [u8]) -> usize {
+        let inode = self.inode.lock().clone();
+        if inode.has_inline_data() {
+            return self.read_inline(&inode, page_start, buf);
+        }
+        let block_size = self.fs.block_size as usize;
+        let sectors_per_block = (block_size / 512) as u64;
+        let len = (inode.get_size() as usize).saturating_sub(page_start).min(buf.len());
+
+        let mut plug = blkdev::BlkPlug::new(unsafe { &*self.fs.device });
+        let mut rest = &mut buf[..len];
+        let mut done = 0;
+        while done < len {
+            let pos = page_start + done;
+            let block_offset = pos % block_size;
+            let lblk = (pos / block_size) as u64;
+            let es = match self.map_blocks(&inode, lblk) {
+                Ok(es) => es,
+                Err(_) => break,
+            };
+            // 本段内从 pos 起的连续部分
+            let run = ((es.end() - lblk) as usize * block_size - block_offset).min(len - done);
+            let (chunk, tail) = core::mem::take(&mut rest).split_at_mut(run);
+            rest = tail;
+            if es.is_hole() {
+                chunk.fill(0);
+                done += run;
+                continue;
+            }
 
-    let mut total_read = 0;
-    let mut current_offset = offset as usize;
-    let mut buf_offset = 0;
+            let sector = es.map(lblk) * sectors_per_block;
+            if block_offset == 0 && run % block_size == 0 {
+                plug.read(sector, chunk);
+            } else {
+                // 不按块对齐的首尾部分读入整块后复制
+                let nr_blocks = (block_offset + run + block_size - 1) / block_size;
+                let mut tmp = alloc::vec![0u8; nr_blocks * block_size];
+                if blkdev::blkdev_read(self.fs.device, sector, &mut tmp).is_err() {
+                    break;
+                }
+                chunk.copy_from_slice(&tmp[block_offset..block_offset + run]);
+            }
+            done += run;
+        }
+        match plug.finish() {
+            Ok(()) => done,
+            Err(_) => 0,
+        }
+    }
+}
 
-    while total_read < to_read {
-        let block_index = current_offset / block_size;
-        let block_offset = current_offset % block_size;
+impl Ext4PageSource {
+    /// 读取 inline 数据，只读 inode 表所在的块 (ext4_readpage_inline)
+    fn read_inline(&self, inode: &Ext4Inode, pos: usize, buf: &mut [u8]) -> usize {
+        let (block, offset) = match self.iloc {
+            Some(iloc) => iloc,
+            None => return 0,
+        };
+        let bh = match bio::bread(self.fs.device, block) {
+            Some(bh) => bh,
+            None => return 0,
+        };
+        let raw = unsafe { &(*bh).b_data[offset..offset + self.fs.inode_size as usize] };
+        let read = inline::ext4_read_inline_data(inode, raw, pos, buf);
+        bio::brelse(bh);
+        read
+    }
 
-        if block_index >= blocks.len() {
-            break;
+    /// inline 数据放不下 end 字节时转为普通文件 (ext4_da_convert_inline_data_to_extent)
+    ///
+    /// 先经页缓存取出现有数据（0 号页可能有尚未写回 inode 的脏数据）并删除 inline 数据，
+    /// 再把数据写回 0 号页并标记为脏，回写时按普通文件分配块；extent 树在分配时建立
+    fn convert_inline(&self, fs: &Ext4FileSystem, mapping: &FileMapping, end: u64) -> Result<(), i32> {
+        let inode = self.inode.lock().clone();
+        if !inode.has_inline_data() || end <= fs.inline_max_size(&inode)? as u64 {
+            return Ok(());
         }
+        let mut data = alloc::vec![0u8; inode.get_size() as usize];
+        let len = mapping.read(0, &mut data);
+        data.truncate(len);
+
+        let mut icore = self.inode.lock();
+        inline::ext4_destroy_inline_data(fs, &mut icore)?;
+        self.extents.lock().clear();
+        fs.write_inode(&icore)?;
+        drop(icore);
+
+        if !data.is_empty() && mapping.write_dirty(0, &data) < data.len() {
+            return Err(errno::Errno::OutOfMemory.as_neg_i32());
+        }
+        Ok(())
+    }
+}
 
-        unsafe {
-            let bh = bio::bread(fs.device, blocks[block_index])
-                .ok_or(errno::Errno::IOError.as_neg_i32())?;
-
-            let data = &(*bh).b_data;
-            let remaining = to_read - total_read;
-            let available_in_block = block_size - block_offset;
-            let read_in_block = core::cmp::min(remaining, available_in_block);
+impl Ext4PageSource {
+    /// 回写需要分配块，使用已挂载的完整文件系统
+    fn mounted_fs(&self) -> Result<&'static Ext4FileSystem, i32> {
+        match crate::fs::ext4::get_ext4_fs() {
+            Some(fs) if unsafe { (*fs).device } == self.fs.device => Ok(unsafe { &*fs }),
+            _ => Err(errno::Errno::ReadOnlyFileSystem.as_neg_i32()),
+        }
+    }
 
-            buf[buf_offset..buf_offset + read_in_block]
-                .copy_from_slice(&data[block_offset..block_offset + read_in_block]);
+    /// 为 [lblk, lblk + nr) 的空洞分配块 (ext4_da_map_blocks -> ext4_map_blocks)
+    ///
+    /// 延迟到回写时分配，整段交给多块分配器，extent 文件每段插入一个 extent；
+    /// 落在未初始化 extent 中的部分使用已分配的块，只转为已初始化。
+    /// 目标块取前一个逻辑块的物理块号 + 1，
+    /// 文件开头取 inode 所在块组的第一个块 (ext4_ext_find_goal / ext4_inode_to_goal_block)
+    fn alloc_run(&self, fs: &Ext4FileSystem, inode: &mut Ext4Inode, lblk: u64, nr: u64) -> Result<(), i32> {
+        // 还没有数据块的文件改用 extent 树 (ext4_ext_tree_init)
+        if !inode.has_extent() && fs.has_extents() && inode.blocks == 0 && inode.block.iter().all(|&b| b == 0) {
+            extent::ext4_ext_tree_init(inode);
+        }
+        let allocator = crate::fs::ext4::allocator::BlockAllocator::new(fs);
+        let sectors_per_block = fs.block_size as u64 / 512;
 
-            total_read += read_in_block;
-            buf_offset += read_in_block;
-            current_offset += read_in_block;
+        let prev = if lblk > 0 { self.map_blocks(inode, lblk - 1)?.map(lblk - 1) } else { 0 };
+        let mut goal = if prev != 0 {
+            prev + 1
+        } else {
+            let group = (inode.ino.saturating_sub(1) / fs.inodes_per_group.max(1)) as u64;
+            let first_data_block = fs.sb_info.as_ref().map(|sb| sb.s_first_data_block as u64).unwrap_or(0);
+            first_data_block + group * fs.blocks_per_group as u64
+        };
 
-            bio::brelse(bh);
+        let mut i = lblk;
+        while i < lblk + nr {
+            if let Some((pblk, got)) = extent::ext4_ext_convert_to_initialized(fs, inode, i, lblk + nr - i)? {
+                i += got;
+                goal = pblk + got;
+                continue;
+            }
+            let (pblk, got) = mballoc::ext4_mb_new_blocks(fs, inode.ino, i, goal, lblk + nr - i)?;
+            if inode.has_extent() {
+                // 整段插入为一个 extent，与前一段物理连续时合并
+                if let Err(e) = extent::ext4_ext_insert_extent(fs, inode, i, pblk, got) {
+                    let _ = mballoc::ext4_mb_free_blocks(fs, pblk, got);
+                    return Err(e);
+                }
+                inode.blocks += got * sectors_per_block;
+                i += got;
+                goal = pblk + got;
+                continue;
+            }
+            for n in 0..got {
+                let data_block = pblk + n;
+                inode.blocks += sectors_per_block;
+                if i + n < 12 {
+                    inode.block[(i + n) as usize] = data_block as u32;
+                } else {
+                    allocate_indirect_block(fs, inode, i + n, data_block, &allocator)?;
+                }
+            }
+            i += got;
+            goal = pblk + got;
         }
+        Ok(())
     }
-
-    Ok(total_read)
 }
 
-pub fn ext4_file_write(
-    fs: &crate::fs::ext4::Ext4FileSystem,
-    inode: &mut crate::fs::ext4::inode::Ext4Inode,
-    offset: u64,
-    buf: &[u8],
-) -> Result<usize, i32> {
-    let block_size = fs.block_size as u64;
-    let to_write = buf.len() as u64;
+impl MappingSource for Ext4PageSource {
+    fn size(&self) -> usize {
+        self.inode.lock().get_size() as usize
+    }
 
-    // 计算需要的块数
-    let end_offset = offset + to_write;
-    let needed_blocks = (end_offset + block_size - 1) / block_size;
-    let current_blocks = (inode.get_size() + block_size - 1) / block_size;
+    fn read_page(&self, index: usize, buf: &mut [u8]) -> usize {
+        self.read_range(index * PAGE_SIZE, buf)
+    }
 
-    // 如果需要新块，进行分配
-    if needed_blocks > current_blocks {
-        allocate_blocks_for_file(fs, inode, needed_blocks)?;
+    /// 共享映射写过的页经回写分配块并写入磁盘
+    fn can_writeback(&self) -> bool {
+        true
     }
 
-    // 写入数据
-    let mut total_written = 0;
-    let mut current_offset = offset;
-    let mut buf_offset = 0;
-
-    while total_written < to_write as usize {
-        let block_index = current_offset / block_size;
-        let block_offset = (current_offset % block_size) as usize;
-
-        // 获取数据块号（支持间接块）
-        let block_num = match inode.get_data_block(fs, block_index) {
-            Ok(0) => {
-                // 稀疏文件，块未分配，跳过
-                let remaining = to_write as usize - total_written;
-                let skip_to_block_end = block_size as usize - block_offset;
-                let skip = core::cmp::min(remaining, skip_to_block_end);
-                total_written += skip;
-                buf_offset += skip;
-                current_offset += skip as u64;
-                continue;
+    /// 同一个块设备上的文件共用一个后备设备
+    fn bdi_id(&self) -> u64 {
+        self.fs.device as usize as u64
+    }
+
+    /// 连续多页一次读入，页内块与页间块一起合并 (ext4_readahead)
+    fn read_pages(&self, index: usize, buf: &mut [u8]) -> usize {
+        self.read_range(index * PAGE_SIZE, buf)
+    }
+
+    /// 回写连续的脏页 (ext4_writepages)
+    ///
+    /// 先为范围内的空洞按段分配块并写回 inode (mpage_map_and_submit_extent)，
+    /// 再把物理连续的块合并为一次写请求。文件末尾之后的页不写；块大小不超过页大小
+    fn write_pages(&self, index: usize, pages: &[usize]) -> Result<(), i32> {
+        let fs = self.mounted_fs()?;
+        let block_size = self.fs.block_size as usize;
+        let sectors_per_block = (block_size / 512) as u64;
+
+        // 回写期间持有 inode，写入者不能同时修改块映射
+        let mut inode = self.inode.lock();
+        let start = index * PAGE_SIZE;
+        let end = (start + pages.len() * PAGE_SIZE).min(inode.get_size() as usize);
+        if start >= end {
+            return Ok(());
+        }
+        if inode.has_inline_data() {
+            // 文件仍能放在 inode 中（更大时写入前已转换）：整个文件在 0 号页，不分配块
+            let data = unsafe { core::slice::from_raw_parts(pages[0] as *const u8, end) };
+            inline::ext4_write_inline_data(fs, &mut inode, data)?;
+            return fs.write_inode(&inode);
+        }
+        let first = (start / block_size) as u64;
+        let last = ((end - 1) / block_size) as u64;
+
+        // 1. 映射：未分配的块整段分配
+        let mut allocated = false;
+        let mut lblk = first;
+        while lblk <= last {
+            let es = self.map_blocks(&inode, lblk)?;
+            let run_end = es.end().min(last + 1);
+            if es.is_hole() {
+                let result = self.alloc_run(fs, &mut inode, lblk, run_end - lblk);
+                // 已分配的部分也要记入 inode 和缓存
+                self.extents.lock().clear();
+                allocated = true;
+                if let Err(e) = result {
+                    mballoc::ext4_mb_flush(fs)?;
+                    fs.write_inode(&inode)?;
+                    return Err(e);
+                }
             }
-            Ok(b) => b,
-            Err(e) => return Err(e),
-        };
+            lblk = run_end;
+        }
+        if allocated {
+            // 整批分配的位图与计数一次写回
+            mballoc::ext4_mb_flush(fs)?;
+            fs.write_inode(&inode)?;
+        }
 
-        unsafe {
-            let bh = bio::bread(fs.device, block_num)
-                .ok_or(errno::Errno::IOError.as_neg_i32())?;
+        // 2. 提交：物理连续的块合并为一次写请求，各段在同一个 plug 中提交
+        let mut runs = alloc::vec::Vec::new();
+        let mut lblk = first;
+        while lblk <= last {
+            let es = self.map_blocks(&inode, lblk)?;
+            let nr = (es.end().min(last + 1) - lblk) as usize;
+            let mut data = alloc::vec![0u8; nr * block_size];
+            for (i, chunk) in data.chunks_mut(block_size).enumerate() {
+                let pos = (lblk as usize + i) * block_size - start;
+                let phys = pages[pos / PAGE_SIZE] + pos % PAGE_SIZE;
+                unsafe {
+                    core::ptr::copy_nonoverlapping(phys as *const u8, chunk.as_mut_ptr(), block_size);
+                }
+            }
+            runs.push((es.map(lblk) * sectors_per_block, data));
+            lblk += nr as u64;
+        }
+        let mut plug = blkdev::BlkPlug::new(unsafe { &*self.fs.device });
+        for (sector, data) in &runs {
+            plug.write(*sector, data);
+        }
+        plug.finish()
+    }
+}
 
-            let data = &mut (*bh).b_data;
-            let remaining = to_write as usize - total_written;
-            let available_in_block = block_size as usize - block_offset;
-            let write_in_block = core::cmp::min(remaining, available_in_block);
+/// inode 的页缓存键，按块设备号区分不同 ext4 实例的 inode (MKDEV)
+fn ext4_mapping_key(fs: &Ext4FileSystem, inode: &Ext4Inode) -> u64 {
+    let dev = if fs.device.is_null() {
+        0
+    } else {
+        unsafe { ((*fs.device).major << 20) | (*fs.device).first_minor }
+    };
+    filemap::mapping_key(dev, inode.ino as u64)
+}
 
-            // 写入数据到块
-            data[block_offset..block_offset + write_in_block]
-                .copy_from_slice(&buf[buf_offset..buf_offset + write_in_block]);
+/// 页缓存键 -> 数据来源，每个 inode 只创建一次
+static PAGE_SOURCES: Mutex<BTreeMap<u64, Arc<Ext4PageSource>>> = Mutex::new(BTreeMap::new());
+
+/// 获取 inode 的数据来源，第一次访问时以调用者的 inode 建立内存中的 inode (ext4_iget)
+fn ext4_page_source(fs: &Ext4FileSystem, inode: &Ext4Inode) -> (u64, Arc<Ext4PageSource>) {
+    let key = ext4_mapping_key(fs, inode);
+
+    let source = PAGE_SOURCES
+        .lock()
+        .entry(key)
+        .or_insert_with(|| {
+            let mut view = Ext4FileSystem::new(fs.device);
+            view.block_size = fs.block_size;
+            view.block_size_bits = fs.block_size_bits;
+            view.inode_size = fs.inode_size;
+            Arc::new(Ext4PageSource {
+                fs: view,
+                inode: Mutex::new(inode.clone()),
+                extents: Mutex::new(ExtentStatusTree::new()),
+                iloc: fs.inode_loc(inode.ino).ok(),
+            })
+        })
+        .clone();
+    (key, source)
+}
 
-            // 标记为脏
-            (*bh).set_state_bit(crate::fs::bio::BufferState::BH_Dirty);
-            bio::sync_dirty_buffer(bh)?;
-            bio::brelse(bh);
+/// 获取 inode 的页缓存
+///
+/// 大小与块映射以内存中的 inode 为准：调用者的副本可能早于延迟写和回写分配
+pub fn ext4_mapping(fs: &Ext4FileSystem, inode: &Ext4Inode) -> Arc<FileMapping> {
+    let (key, source) = ext4_page_source(fs, inode);
+    filemap::get_mapping(key, source)
+}
 
-            total_written += write_in_block;
-            buf_offset += write_in_block;
-            current_offset += write_in_block as u64;
-        }
+/// 文件当前大小，不建立内存中的 inode 和页缓存 (i_size_read)
+///
+/// 已建立内存中的 inode 时以它为准（含尚未写回的延迟写），否则就是调用者 inode 中的大小
+pub fn ext4_file_size(fs: &Ext4FileSystem, inode: &Ext4Inode) -> u64 {
+    match PAGE_SOURCES.lock().get(&ext4_mapping_key(fs, inode)) {
+        Some(source) => source.inode.lock().get_size(),
+        None => inode.get_size(),
     }
+}
 
-    // 更新文件大小
-    if end_offset > inode.get_size() {
-        inode.set_size(end_offset);
-    }
+/// 读取文件 (ext4_file_read_iter)
+///
+/// 经页缓存读取：未缓存的页从磁盘读入一次，之后的读取只从缓存页复制。
+/// 没有打开文件的预读状态，按一次独立读取处理：从文件开头读时带一个初始预读窗口
+pub fn ext4_file_read(
+    fs: &Ext4FileSystem,
+    inode: &Ext4Inode,
+    offset: u64,
+    buf: &mut [u8],
+) -> Result<usize, i32> {
+    ext4_file_read_ra(fs, inode, offset, buf, &mut FileRaState::new())
+}
 
-    // TODO: 更新 inode 时间戳
-    // TODO: 同步 inode 到磁盘
+/// 按打开文件的预读状态读取 (ext4_file_read_iter + filemap_read)
+pub fn ext4_file_read_ra(
+    fs: &Ext4FileSystem,
+    inode: &Ext4Inode,
+    offset: u64,
+    buf: &mut [u8],
+    ra: &mut FileRaState,
+) -> Result<usize, i32> {
+    if offset >= inode.get_size() {
+        return Ok(0);  // EOF
+    }
 
-    Ok(total_written)
+    // 文件内有数据却一页也读不到：分配不到页缓存页
+    let read = ext4_mapping(fs, inode).read_ra(offset as usize, buf, ra);
+    if read == 0 && !buf.is_empty() {
+        return Err(errno::Errno::OutOfMemory.as_neg_i32());
+    }
+    Ok(read)
 }
 
-fn allocate_blocks_for_file(
+/// 写入文件 (ext4_buffered_write_iter + ext4_da_write_begin)
+///
+/// 延迟分配：数据只写入页缓存的脏页并扩展 i_size，块在回写时按段分配。
+/// 返回后调用者的 inode 与内存中的 inode 一致
+pub fn ext4_file_write(
     fs: &crate::fs::ext4::Ext4FileSystem,
     inode: &mut crate::fs::ext4::inode::Ext4Inode,
-    needed_blocks: u64,
-) -> Result<(), i32> {
-    let allocator = crate::fs::ext4::allocator::BlockAllocator::new(fs);
-    let block_size = fs.block_size as u64;
-    let current_blocks = (inode.get_size() + block_size - 1) / block_size;
-
-    // 分配新块
-    for i in current_blocks..needed_blocks {
-        match allocator.alloc_block() {
-            Ok(data_block) => {
-                // 清零新分配的数据块
-                unsafe {
-                    let bh = bio::bread(fs.device, data_block)
-                        .ok_or(errno::Errno::IOError.as_neg_i32())?;
-
-                    for byte in (*bh).b_data.iter_mut() {
-                        *byte = 0;
-                    }
-
-                    (*bh).set_state_bit(crate::fs::bio::BufferState::BH_Dirty);
-                    bio::sync_dirty_buffer(bh)?;
-                    bio::brelse(bh);
-                }
+    offset: u64,
+    buf: &[u8],
+) -> Result<usize, i32> {
+    if buf.is_empty() {
+        return Ok(0);
+    }
+    let end_offset = offset
+        .checked_add(buf.len() as u64)
+        .ok_or(errno::Errno::FileTooLarge.as_neg_i32())?;
+
+    let (key, source) = ext4_page_source(fs, inode);
+    let mapping = filemap::get_mapping(key, source.clone());
+    source.convert_inline(fs, &mapping, end_offset)?;
+
+    // 先扩展 i_size：新页在页缓存中读作 0，写入时不访问磁盘
+    let old_size = {
+        let mut icore = source.inode.lock();
+        let old_size = icore.get_size();
+        if end_offset > old_size {
+            icore.set_size(end_offset);
+        }
+        old_size
+    };
 
-                // 根据块索引决定如何存储块号
-                let block_index = i;
+    let written = mapping.write_dirty(offset as usize, buf);
 
-                if block_index < 12 {
-                    // 直接块
-                    inode.block[block_index as usize] = data_block as u32;
-                } else {
-                    // 间接块
-                    allocate_indirect_block(fs, inode, block_index, data_block, &allocator)?;
-                }
-            }
-            Err(e) => {
-                // 分配失败，回滚已分配的块
-                // TODO: 实现完整的回滚
-                return Err(e);
-            }
-        }
+    let mut icore = source.inode.lock();
+    if (written as u64) < buf.len() as u64 && end_offset > old_size {
+        // 短写：i_size 只扩展到实际写入的位置
+        icore.set_size(old_size.max(offset + written as u64));
     }
+    // TODO: 更新 inode 时间戳
+    *inode = icore.clone();
+    drop(icore);
 
-    Ok(())
+    if written == 0 {
+        return Err(errno::Errno::OutOfMemory.as_neg_i32());
+    }
+    Ok(written)
 }
 
-fn allocate_indirect_block(
+pub(crate) fn allocate_indirect_block(
     fs: &crate::fs::ext4::Ext4FileSystem,
     inode: &mut crate::fs::ext4::inode::Ext4Inode,
     block_index: u64,
@@ -209,6 +482,7 @@ fn allocate_indirect_block(
         if inode.block[12] == 0 {
             // 需要分配单级间接块
             let indirect_block = allocator.alloc_block()?;
+            inode.blocks += block_size / 512;
             inode.block[12] = indirect_block as u32;
 
             // 清零间接块
@@ -220,8 +494,7 @@ fn allocate_indirect_block(
                     *byte = 0;
                 }
 
-                (*bh).set_state_bit(crate::fs::bio::BufferState::BH_Dirty);
-                bio::sync_dirty_buffer(bh)?;
+                fs.handle_dirty_metadata(bh)?;
                 bio::brelse(bh);
             }
         }
@@ -242,6 +515,7 @@ fn allocate_indirect_block(
             if inode.block[13] == 0 {
                 // 需要分配二级间接块
                 let double_block = allocator.alloc_block()?;
+                inode.blocks += block_size / 512;
                 inode.block[13] = double_block as u32;
 
                 // 清零
@@ -253,8 +527,7 @@ fn allocate_indirect_block(
                         *byte = 0;
                     }
 
-                    (*bh).set_state_bit(crate::fs::bio::BufferState::BH_Dirty);
-                    bio::sync_dirty_buffer(bh)?;
+                    fs.handle_dirty_metadata(bh)?;
                     bio::brelse(bh);
                 }
             }
@@ -273,6 +546,7 @@ fn allocate_indirect_block(
             if indirect_block == 0 {
                 // 需要分配单级间接块
                 indirect_block = allocator.alloc_block()?;
+                inode.blocks += block_size / 512;
 
                 // 清零
                 unsafe {
@@ -283,8 +557,7 @@ fn allocate_indirect_block(
                         *byte = 0;
                     }
 
-                    (*bh).set_state_bit(crate::fs::bio::BufferState::BH_Dirty);
-                    bio::sync_dirty_buffer(bh)?;
+                    fs.handle_dirty_metadata(bh)?;
                     bio::brelse(bh);
                 }
 
@@ -337,25 +610,251 @@ pub fn ext4_file_lseek(
     Ok(new_pos)
 }
 
+/// 同步文件 (ext4_sync_file)
+///
+/// 回写文件的所有脏页（此时分配延迟的块），并报告之前后台回写遇到的错误；
+/// 数据落盘后写回 inode，有日志时只等待最近修改这个 inode 的事务提交 (jbd2_complete_transaction)，
+/// 事务早已提交时仍要刷新设备缓存让数据落到介质。
+/// `datasync` 时只等待改变了大小或块映射的事务 (fdatasync)
 pub fn ext4_sync_file(
     fs: &crate::fs::ext4::Ext4FileSystem,
     inode: &crate::fs::ext4::inode::Ext4Inode,
+    datasync: bool,
 ) -> Result<(), i32> {
-    // 同步文件的所有数据块
-    let blocks = inode.get_data_blocks(fs)?;
+    let mapping = ext4_mapping(fs, inode);
+    mapping.writeback()?;
+    match mapping.take_wb_error() {
+        0 => {}
+        e => return Err(e),
+    }
+    fs.sync_inode(inode.ino)?;
+    let committed = match (&fs.journal, crate::fs::inode::ilookup(fs.s_dev, inode.ino as u64)) {
+        (Some(journal), Some(vi)) => {
+            let tid = if datasync { &vi.i_datasync_tid } else { &vi.i_sync_tid };
+            journal.complete_transaction(tid.load(core::sync::atomic::Ordering::Acquire))?
+        }
+        // inode 不在缓存中，没有记录事务号
+        (Some(journal), None) => {
+            journal.force_commit()?;
+            false
+        }
+        // 没有日志时元数据已同步写回
+        (None, _) => false,
+    };
+    if !committed {
+        blkdev::blkdev_issue_flush(fs.device)?;
+    }
+    Ok(())
+}
 
-    for block in blocks {
-        unsafe {
-            let bh = bio::bread(fs.device, block)
-                .ok_or(errno::Errno::IOError.as_neg_i32())?;
+/// 直接 I/O 的对齐单位：文件偏移、长度和用户缓冲区地址都按扇区对齐 (bdev_logical_block_size)
+pub const DIO_ALIGN: usize = 512;
 
-            if (*bh).is_dirty() {
-                bio::sync_dirty_buffer(bh)?;
-            }
+/// 检查直接 I/O 的对齐 (iomap_dio_rw 的对齐检查)
+fn dio_check_align(offset: u64, addr: usize, len: usize) -> Result<(), i32> {
+    if offset as usize % DIO_ALIGN != 0 || addr % DIO_ALIGN != 0 || len % DIO_ALIGN != 0 {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    Ok(())
+}
+
+/// 固定当前进程从 addr 开始 len 字节的用户缓冲区
+///
+/// `write` 表示设备要写入这段内存（读文件）
+fn dio_pin_user(addr: usize, len: usize, write: bool) -> Result<alloc::vec::Vec<usize>, i32> {
+    let efault = errno::Errno::BadAddress.as_neg_i32();
+    let task = crate::sched::current().ok_or(efault)?;
+    task.address_space().ok_or(efault)?.pin_user_pages(addr, len, write)
+}
+
+/// 把用户缓冲区中 [from, from + len) 按页切成物理连续的片段
+///
+/// `pages` 是 pin_user_pages 返回的各页物理地址，缓冲区从 addr 开始
+fn dio_segments(pages: &[usize], addr: usize, from: usize, len: usize, mut f: impl FnMut(usize, usize)) {
+    let mut off = addr % PAGE_SIZE + from;
+    let end = off + len;
+    while off < end {
+        let n = (PAGE_SIZE - off % PAGE_SIZE).min(end - off);
+        f(pages[off / PAGE_SIZE] + off % PAGE_SIZE, n);
+        off += n;
+    }
+}
+
+/// 直接读 (ext4_dio_read_iter)
+///
+/// 不经过页缓存和块缓存：固定用户页，把文件块直接读进这些页。
+/// 块设备请求按页切分，磁盘上连续的片段在请求队列中合并为一个分散/聚集请求，
+/// 设备直接 DMA 到用户页。读之前回写范围内的脏页，空洞读作 0
+///
+/// # 参数
+/// - `addr`: 用户缓冲区地址，与 offset、len 一起按 DIO_ALIGN 对齐
+///
+/// # 返回
+/// 读取的字节数，从文件末尾之后开始读返回 0；不对齐返回 EINVAL
+pub fn ext4_dio_read(
+    fs: &Ext4FileSystem,
+    inode: &Ext4Inode,
+    offset: u64,
+    addr: usize,
+    len: usize,
+) -> Result<usize, i32> {
+    dio_check_align(offset, addr, len)?;
+    let (key, source) = ext4_page_source(fs, inode);
+    if source.inode.lock().has_inline_data() {
+        // inline 数据没有数据块，退回缓冲读 (ext4_should_use_dio)
+        let buf = unsafe { core::slice::from_raw_parts_mut(addr as *mut u8, len) };
+        return ext4_file_read(fs, inode, offset, buf);
+    }
+    let size = source.size();
+    let offset = offset as usize;
+    if offset >= size || len == 0 {
+        return Ok(0);
+    }
+    // 最后一个扇区读整个扇区，返回值只算到文件末尾
+    let count = len.min(size - offset);
+    let io_len = (count + DIO_ALIGN - 1) / DIO_ALIGN * DIO_ALIGN;
+
+    let mapping = filemap::get_mapping(key, source.clone());
+    mapping.writeback_range(offset / PAGE_SIZE, (offset + io_len - 1) / PAGE_SIZE + 1)?;
+
+    let pages = dio_pin_user(addr, io_len, true)?;
+    let result = source.dio_rw(offset, addr, io_len, &pages, false);
+    pages.iter().for_each(|&phys| filemap::put_page(phys));
+    result.map(|()| count)
+}
+
+/// 直接写 (ext4_dio_write_iter)
+///
+/// 固定用户页后让设备直接从这些页读出数据写入文件块，不复制到页缓存。
+/// 写入前回写并丢弃范围内的缓存页，写完再丢弃一次，之后的缓冲读从磁盘读到新数据；
+/// 被 mmap 映射而不能丢弃的页复制新内容，保持一致。空洞立即分配，写到文件末尾之后时扩展 i_size
+///
+/// # 返回
+/// 写入的字节数；不对齐返回 EINVAL
+pub fn ext4_dio_write(
+    fs: &Ext4FileSystem,
+    inode: &mut Ext4Inode,
+    offset: u64,
+    addr: usize,
+    len: usize,
+) -> Result<usize, i32> {
+    dio_check_align(offset, addr, len)?;
+    if len == 0 {
+        return Ok(0);
+    }
+    let (key, source) = ext4_page_source(fs, inode);
+    if source.inode.lock().has_inline_data() {
+        // 退回缓冲写，放不下时在写入前转为普通文件
+        let data = unsafe { core::slice::from_raw_parts(addr as *const u8, len) };
+        return ext4_file_write(fs, inode, offset, data);
+    }
+    let mfs = source.mounted_fs()?;
+    let offset = offset as usize;
+    let end = offset.checked_add(len).ok_or(errno::Errno::FileTooLarge.as_neg_i32())?;
+    let (first_page, last_page) = (offset / PAGE_SIZE, (end - 1) / PAGE_SIZE + 1);
+
+    let mapping = filemap::get_mapping(key, source.clone());
+    mapping.writeback_range(first_page, last_page)?;
+    mapping.invalidate_range(first_page, last_page);
+
+    let pages = dio_pin_user(addr, len, false)?;
+    let result = source.dio_alloc(mfs, offset, end).and_then(|()| source.dio_rw(offset, addr, len, &pages, true));
+    pages.iter().for_each(|&phys| filemap::put_page(phys));
+
+    // 写期间读入的页可能是旧数据；写失败时磁盘上仍是旧数据，不复制到留下的页
+    mapping.invalidate_range(first_page, last_page);
+    if result.is_ok() {
+        mapping.write(offset, unsafe { core::slice::from_raw_parts(addr as *const u8, len) });
+    }
+    *inode = source.inode.lock().clone();
+    result.map(|()| len)
+}
+
+impl Ext4PageSource {
+    /// 直接写前为 [start, end) 的空洞分配块，写到文件末尾之后时扩展 i_size
+    ///
+    /// 与回写共用按段分配，inode 立即写回：设备写完数据后块映射已经可见
+    fn dio_alloc(&self, fs: &Ext4FileSystem, start: usize, end: usize) -> Result<(), i32> {
+        let block_size = self.fs.block_size as usize;
+        let mut inode = self.inode.lock();
+        let old_size = inode.get_size();
+        if end as u64 > old_size {
+            inode.set_size(end as u64);
+        }
 
-            bio::brelse(bh);
+        let mut result = Ok(());
+        let mut allocated = false;
+        let mut lblk = (start / block_size) as u64;
+        let last = ((end - 1) / block_size) as u64;
+        while lblk <= last {
+            let es = match self.map_blocks(&inode, lblk) {
+                Ok(es) => es,
+                Err(e) => {
+                    result = Err(e);
+                    break;
+                }
+            };
+            let run_end = es.end().min(last + 1);
+            if es.is_hole() {
+                result = self.alloc_run(fs, &mut inode, lblk, run_end - lblk);
+                self.extents.lock().clear();
+                allocated = true;
+                if result.is_err() {
+                    break;
+                }
+            }
+            lblk = run_end;
+        }
+        if result.is_err() {
+            inode.set_size(old_size);
+        }
+        if allocated {
+            mballoc::ext4_mb_flush(fs)?;
         }
+        if allocated || end as u64 > old_size {
+            fs.write_inode(&inode)?;
+        }
+        result
     }
 
-    Ok(())
+    /// 在文件 [offset, offset + len) 与固定的用户页之间直接传输 (iomap_dio_bio_iter)
+    ///
+    /// 逐段映射文件块，每段按页切成块设备请求，全部在同一个 plug 中提交；
+    /// 读时空洞直接清零用户页。写之前空洞已由 dio_alloc 分配
+    fn dio_rw(&self, offset: usize, addr: usize, len: usize, pages: &[usize], write: bool) -> Result<(), i32> {
+        let inode = self.inode.lock().clone();
+        let block_size = self.fs.block_size as usize;
+        let sectors_per_block = (block_size / 512) as u64;
+
+        let mut plug = blkdev::BlkPlug::new(unsafe { &*self.fs.device });
+        let mut done = 0;
+        while done < len {
+            let pos = offset + done;
+            let lblk = (pos / block_size) as u64;
+            let es = self.map_blocks(&inode, lblk)?;
+            let run = ((es.end() - lblk) as usize * block_size - pos % block_size).min(len - done);
+            if es.is_hole() {
+                if write {
+                    return Err(errno::Errno::IOError.as_neg_i32());
+                }
+                dio_segments(pages, addr, done, run, |phys, n| unsafe {
+                    core::ptr::write_bytes(phys as *mut u8, 0, n);
+                });
+                done += run;
+                continue;
+            }
+
+            let mut sector = es.map(lblk) * sectors_per_block + (pos % block_size / 512) as u64;
+            dio_segments(pages, addr, done, run, |phys, n| {
+                if write {
+                    plug.write(sector, unsafe { core::slice::from_raw_parts(phys as *const u8, n) });
+                } else {
+                    plug.read(sector, unsafe { core::slice::from_raw_parts_mut(phys as *mut u8, n) });
+                }
+                sector += (n / 512) as u64;
+            });
+            done += run;
+        }
+        plug.finish()
+    }
 }
@@ -0,0 +1,188 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 目录索引的文件名哈希
+//!
+//! 参考: fs/ext4/hash.c
+//!
+//! 索引目录 (htree) 按文件名哈希排序，哈希算法记录在 dx_root 中：
+//! legacy (dx_hack_hash)、half MD4 和 TEA，各有按有符号/无符号字符计算的两种版本，
+//! 超级块的 s_flags 指明文件系统使用哪一种
+
+/// 哈希算法 (DX_HASH_*)
+pub const DX_HASH_LEGACY: u8 = 0;
+pub const DX_HASH_HALF_MD4: u8 = 1;
+pub const DX_HASH_TEA: u8 = 2;
+pub const DX_HASH_LEGACY_UNSIGNED: u8 = 3;
+pub const DX_HASH_HALF_MD4_UNSIGNED: u8 = 4;
+pub const DX_HASH_TEA_UNSIGNED: u8 = 5;
+
+/// 32 位哈希的结束标记 (EXT4_HTREE_EOF_32BIT)
+const EXT4_HTREE_EOF_32BIT: u32 = 0x7fff_ffff;
+
+/// 计算哈希所需的参数 (struct dx_hash_info)
+#[derive(Debug, Clone, Copy)]
+pub struct DxHashInfo {
+    /// 哈希算法
+    pub hash_version: u8,
+    /// 超级块的 s_hash_seed，全 0 时使用默认种子
+    pub seed: [u32; 4],
+}
+
+const TEA_DELTA: u32 = 0x9E37_79B9;
+
+/// TEA 加密的一轮 (TEA_transform)
+fn tea_transform(buf: &mut [u32; 4], input: &[u32]) {
+    let mut sum = 0u32;
+    let (mut b0, mut b1) = (buf[0], buf[1]);
+    let (a, b, c, d) = (input[0], input[1], input[2], input[3]);
+    for _ in 0..16 {
+        sum = sum.wrapping_add(TEA_DELTA);
+        b0 = b0.wrapping_add(
+            (b1 << 4).wrapping_add(a) ^ b1.wrapping_add(sum) ^ (b1 >> 5).wrapping_add(b),
+        );
+        b1 = b1.wrapping_add(
+            (b0 << 4).wrapping_add(c) ^ b0.wrapping_add(sum) ^ (b0 >> 5).wrapping_add(d),
+        );
+    }
+    buf[0] = buf[0].wrapping_add(b0);
+    buf[1] = buf[1].wrapping_add(b1);
+}
+
+/// 简化的 MD4 变换 (half_md4_transform)
+fn half_md4_transform(buf: &mut [u32; 4], input: &[u32]) {
+    const K2: u32 = 0o13240474631;
+    const K3: u32 = 0o15666365641;
+    let f = |x: u32, y: u32, z: u32| z ^ (x & (y ^ z));
+    let g = |x: u32, y: u32, z: u32| (x & y).wrapping_add((x ^ y) & z);
+    let h = |x: u32, y: u32, z: u32| x ^ y ^ z;
+    let round = |f: &dyn Fn(u32, u32, u32) -> u32, a: &mut u32, b: u32, c: u32, d: u32, x: u32, s: u32| {
+        *a = a.wrapping_add(f(b, c, d)).wrapping_add(x).rotate_left(s);
+    };
+
+    let (mut a, mut b, mut c, mut d) = (buf[0], buf[1], buf[2], buf[3]);
+
+    // 第 1 轮
+    round(&f, &mut a, b, c, d, input[0], 3);
+    round(&f, &mut d, a, b, c, input[1], 7);
+    round(&f, &mut c, d, a, b, input[2], 11);
+    round(&f, &mut b, c, d, a, input[3], 19);
+    round(&f, &mut a, b, c, d, input[4], 3);
+    round(&f, &mut d, a, b, c, input[5], 7);
+    round(&f, &mut c, d, a, b, input[6], 11);
+    round(&f, &mut b, c, d, a, input[7], 19);
+
+    // 第 2 轮
+    round(&g, &mut a, b, c, d, input[1].wrapping_add(K2), 3);
+    round(&g, &mut d, a, b, c, input[3].wrapping_add(K2), 5);
+    round(&g, &mut c, d, a, b, input[5].wrapping_add(K2), 9);
+    round(&g, &mut b, c, d, a, input[7].wrapping_add(K2), 13);
+    round(&g, &mut a, b, c, d, input[0].wrapping_add(K2), 3);
+    round(&g, &mut d, a, b, c, input[2].wrapping_add(K2), 5);
+    round(&g, &mut c, d, a, b, input[4].wrapping_add(K2), 9);
+    round(&g, &mut b, c, d, a, input[6].wrapping_add(K2), 13);
+
+    // 第 3 轮
+    round(&h, &mut a, b, c, d, input[3].wrapping_add(K3), 3);
+    round(&h, &mut d, a, b, c, input[7].wrapping_add(K3), 9);
+    round(&h, &mut c, d, a, b, input[2].wrapping_add(K3), 11);
+    round(&h, &mut b, c, d, a, input[6].wrapping_add(K3), 15);
+    round(&h, &mut a, b, c, d, input[1].wrapping_add(K3), 3);
+    round(&h, &mut d, a, b, c, input[5].wrapping_add(K3), 9);
+    round(&h, &mut c, d, a, b, input[0].wrapping_add(K3), 11);
+    round(&h, &mut b, c, d, a, input[4].wrapping_add(K3), 15);
+
+    buf[0] = buf[0].wrapping_add(a);
+    buf[1] = buf[1].wrapping_add(b);
+    buf[2] = buf[2].wrapping_add(c);
+    buf[3] = buf[3].wrapping_add(d);
+}
+
+/// 旧的 legacy 哈希 (dx_hack_hash_signed / dx_hack_hash_unsigned)
+fn dx_hack_hash(name: &[u8], unsigned: bool) -> u32 {
+    let (mut hash0, mut hash1) = (0x12a3_fe2du32, 0x37ab_e8f9u32);
+    for &ch in name {
+        let c = if unsigned { ch as i32 } else { ch as i8 as i32 };
+        let mut hash = hash1.wrapping_add(hash0 ^ c.wrapping_mul(7_152_373) as u32);
+        if hash & 0x8000_0000 != 0 {
+            hash = hash.wrapping_sub(0x7fff_ffff);
+        }
+        hash1 = hash0;
+        hash0 = hash;
+    }
+    hash0 << 1
+}
+
+/// 把文件名按 4 字节一组填入哈希输入，不足部分用长度填充 (str2hashbuf_signed / _unsigned)
+fn str2hashbuf(msg: &[u8], buf: &mut [u32], unsigned: bool) {
+    let num = buf.len();
+    let len = msg.len() as u32;
+    let mut pad = len | (len << 8);
+    pad |= pad << 16;
+
+    let mut val = pad;
+    let mut out = 0;
+    for (i, &ch) in msg.iter().take(num * 4).enumerate() {
+        let c = if unsigned { ch as u32 } else { ch as i8 as i32 as u32 };
+        val = c.wrapping_add(val << 8);
+        if i % 4 == 3 {
+            buf[out] = val;
+            out += 1;
+            val = pad;
+        }
+    }
+    if out < num {
+        buf[out] = val;
+        out += 1;
+    }
+    for slot in &mut buf[out..] {
+        *slot = pad;
+    }
+}
+
+/// 计算文件名的哈希 (ext4fs_dirhash)
+///
+/// # 返回
+/// (主哈希, 次哈希)；主哈希最低位为 0，留作索引中的冲突标记；算法未知时返回 None
+pub fn ext4fs_dirhash(name: &[u8], info: &DxHashInfo) -> Option<(u32, u32)> {
+    let mut buf = [0x6745_2301u32, 0xefcd_ab89, 0x98ba_dcfe, 0x1032_5476];
+    if info.seed.iter().any(|&s| s != 0) {
+        buf = info.seed;
+    }
+
+    let (hash, minor_hash) = match info.hash_version {
+        DX_HASH_LEGACY | DX_HASH_LEGACY_UNSIGNED => {
+            (dx_hack_hash(name, info.hash_version == DX_HASH_LEGACY_UNSIGNED), 0)
+        }
+        DX_HASH_HALF_MD4 | DX_HASH_HALF_MD4_UNSIGNED => {
+            let unsigned = info.hash_version == DX_HASH_HALF_MD4_UNSIGNED;
+            let mut input = [0u32; 8];
+            for chunk in name.chunks(32) {
+                // 每组的填充按剩余长度计算
+                let offset = chunk.as_ptr() as usize - name.as_ptr() as usize;
+                str2hashbuf(&name[offset..], &mut input, unsigned);
+                half_md4_transform(&mut buf, &input);
+            }
+            (buf[1], buf[2])
+        }
+        DX_HASH_TEA | DX_HASH_TEA_UNSIGNED => {
+            let unsigned = info.hash_version == DX_HASH_TEA_UNSIGNED;
+            let mut input = [0u32; 4];
+            for chunk in name.chunks(16) {
+                let offset = chunk.as_ptr() as usize - name.as_ptr() as usize;
+                str2hashbuf(&name[offset..], &mut input, unsigned);
+                tea_transform(&mut buf, &input);
+            }
+            (buf[0], buf[1])
+        }
+        _ => return None,
+    };
+
+    let mut hash = hash & !1;
+    if hash == EXT4_HTREE_EOF_32BIT << 1 {
+        hash = (EXT4_HTREE_EOF_32BIT - 1) << 1;
+    }
+    Some((hash, minor_hash))
+}
@@ -162,6 +162,88 @@ pub fn ext4_get_block(
     read_indirect_block(fs, indirect_block, third_index)
 }
 
+/// 查找逻辑块所在的一段连续映射 (ext4_ind_map_blocks)
+///
+/// 只在同一层块指针数组（i_block 的直接块或同一个间接块）内向后扫描，
+/// 每次调用最多读一个间接块链；三级间接块只返回单个块
+///
+/// # 返回
+/// (起始物理块号, 从 block_index 起连续的块数)；未分配时物理块号为 0，
+/// 块数为连续未分配的块数
+pub fn ext4_ind_map_blocks(
+    fs: &crate::fs::ext4::Ext4FileSystem,
+    block_array: &[u32; 15],
+    block_index: u64,
+) -> Result<(u64, u64), i32> {
+    let pointers_per_block = fs.block_size as u64 / 4;
+
+    // 直接块
+    if block_index < 12 {
+        return Ok(scan_run(&block_array[..12], block_index as usize));
+    }
+
+    // 单级间接块
+    let indirect_offset = block_index - 12;
+    if indirect_offset < pointers_per_block {
+        if block_array[12] == 0 {
+            return Ok((0, pointers_per_block - indirect_offset));
+        }
+        return read_indirect_run(fs, block_array[12] as u64, indirect_offset as usize);
+    }
+
+    // 二级间接块：先找到覆盖该块的单级间接块
+    let double_offset = indirect_offset - pointers_per_block;
+    if double_offset < pointers_per_block * pointers_per_block {
+        let second_index = double_offset % pointers_per_block;
+        if block_array[13] == 0 {
+            return Ok((0, pointers_per_block - second_index));
+        }
+        let first_index = (double_offset / pointers_per_block) as usize;
+        let indirect_block = read_indirect_block(fs, block_array[13] as u64, first_index)?;
+        if indirect_block == 0 {
+            return Ok((0, pointers_per_block - second_index));
+        }
+        return read_indirect_run(fs, indirect_block, second_index as usize);
+    }
+
+    // 三级间接块
+    ext4_get_block(fs, block_array, block_index).map(|block| (block, 1))
+}
+
+/// 从 ptrs[index] 开始扫描物理上连续（或连续未分配）的块指针
+fn scan_run(ptrs: &[u32], index: usize) -> (u64, u64) {
+    let first = ptrs[index];
+    let len = ptrs[index..]
+        .iter()
+        .enumerate()
+        .take_while(|&(i, &ptr)| if first == 0 { ptr == 0 } else { ptr as u64 == first as u64 + i as u64 })
+        .count();
+    (first as u64, len as u64)
+}
+
+/// 读取间接块一次并扫描从 index 开始的连续块指针
+fn read_indirect_run(
+    fs: &crate::fs::ext4::Ext4FileSystem,
+    indirect_block: u64,
+    index: usize,
+) -> Result<(u64, u64), i32> {
+    unsafe {
+        let bh = bio::bread(fs.device, indirect_block)
+            .ok_or(errno::Errno::IOError.as_neg_i32())?;
+
+        let block_numbers = reinterpret_slice::<u32>(&(*bh).b_data);
+        let count = block_numbers.len().min(fs.block_size as usize / 4);
+        if index >= count {
+            bio::brelse(bh);
+            return Err(errno::Errno::InvalidArgument.as_neg_i32());
+        }
+
+        let run = scan_run(&block_numbers[..count], index);
+        bio::brelse(bh);
+        Ok(run)
+    }
+}
+
 pub fn read_indirect_block(
     fs: &crate::fs::ext4::Ext4FileSystem,
     indirect_block: u64,
@@ -206,8 +288,7 @@ pub fn write_indirect_block(
 
         block_numbers[index] = block_num;
 
-        (*bh).set_state_bit(crate::fs::bio::BufferState::BH_Dirty);
-        bio::sync_dirty_buffer(bh)?;
+        fs.handle_dirty_metadata(bh)?;
         bio::brelse(bh);
         Ok(())
     }
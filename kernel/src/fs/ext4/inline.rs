@@ -0,0 +1,220 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 inline 数据
+//!
+//! 参考: fs/ext4/inline.c
+//!
+//! 不超过 i_block（60 字节）加 system.data 扩展属性值的小文件，数据直接保存在 inode 中：
+//! 前 60 字节在 i_block，其余在 inode 体内扩展属性区（i_extra_isize 之后）的 system.data 值里。
+//! 读写都只访问 inode 表所在的块，不读写数据块。
+//! - system.data 值的大小保持不变，文件增长到放不下时转为 extent 文件
+//! - 只支持普通文件，inline 目录不解析
+
+use crate::errno;
+use crate::fs::bio;
+use crate::fs::ext4::inode::Ext4Inode;
+use crate::fs::ext4::Ext4FileSystem;
+
+/// inode 标志：数据保存在 inode 中 (EXT4_INLINE_DATA_FL)
+pub const EXT4_INLINE_DATA_FL: u32 = 0x1000_0000;
+/// 文件系统特性：允许 inline 数据 (EXT4_FEATURE_INCOMPAT_INLINE_DATA)
+pub const EXT4_FEATURE_INCOMPAT_INLINE_DATA: u32 = 0x8000;
+/// i_block 能保存的字节数 (EXT4_MIN_INLINE_DATA_SIZE)
+pub const EXT4_MIN_INLINE_DATA_SIZE: usize = 60;
+
+/// 原始 inode 中 i_block 与 i_extra_isize 的偏移
+const EXT4_INODE_I_BLOCK: usize = 0x28;
+const EXT4_INODE_I_FLAGS: usize = 0x20;
+const EXT4_INODE_EXTRA_ISIZE: usize = 0x80;
+const EXT4_GOOD_OLD_INODE_SIZE: usize = 128;
+
+/// inode 体内扩展属性区的魔数 (EXT4_XATTR_MAGIC)
+const EXT4_XATTR_MAGIC: u32 = 0xEA02_0000;
+/// system.* 扩展属性的名字索引 (EXT4_XATTR_INDEX_SYSTEM)
+const EXT4_XATTR_INDEX_SYSTEM: u8 = 7;
+/// inline 数据扩展属性的名字 (EXT4_XATTR_SYSTEM_DATA)
+const EXT4_XATTR_SYSTEM_DATA: &[u8] = b"data";
+/// 扩展属性项的固定部分 (struct ext4_xattr_entry)
+const EXT4_XATTR_ENTRY_SIZE: usize = 16;
+
+fn get_le16(buf: &[u8], off: usize) -> u16 {
+    u16::from_le_bytes([buf[off], buf[off + 1]])
+}
+
+fn get_le32(buf: &[u8], off: usize) -> u32 {
+    u32::from_le_bytes([buf[off], buf[off + 1], buf[off + 2], buf[off + 3]])
+}
+
+/// 扩展属性项的长度，名字按 4 字节补齐 (EXT4_XATTR_LEN)
+fn xattr_entry_len(name_len: usize) -> usize {
+    (EXT4_XATTR_ENTRY_SIZE + name_len + 3) & !3
+}
+
+/// system.data 扩展属性在原始 inode 中的位置
+struct InlineXattr {
+    /// 属性项的偏移
+    entry: usize,
+    /// 属性值的偏移与长度
+    value: usize,
+    size: usize,
+}
+
+/// 在 inode 体内扩展属性区查找 system.data (ext4_xattr_ibody_find)
+///
+/// raw 是磁盘上的整个 inode；没有扩展属性区或属性项越界时返回 None
+fn find_inline_xattr(raw: &[u8]) -> Option<InlineXattr> {
+    if raw.len() <= EXT4_GOOD_OLD_INODE_SIZE {
+        return None;
+    }
+    let header = EXT4_GOOD_OLD_INODE_SIZE + get_le16(raw, EXT4_INODE_EXTRA_ISIZE) as usize;
+    if header + 4 > raw.len() || get_le32(raw, header) != EXT4_XATTR_MAGIC {
+        return None;
+    }
+    // 属性值的偏移相对第一个属性项
+    let first = header + 4;
+    let mut off = first;
+    while off + EXT4_XATTR_ENTRY_SIZE <= raw.len() && get_le32(raw, off) != 0 {
+        let name_len = raw[off] as usize;
+        let name_end = off + EXT4_XATTR_ENTRY_SIZE + name_len;
+        if name_end > raw.len() {
+            return None;
+        }
+        if raw[off + 1] == EXT4_XATTR_INDEX_SYSTEM && &raw[off + EXT4_XATTR_ENTRY_SIZE..name_end] == EXT4_XATTR_SYSTEM_DATA {
+            let value = first + get_le16(raw, off + 2) as usize;
+            let size = get_le32(raw, off + 8) as usize;
+            // 值保存在独立 inode 中 (e_value_inum) 或越界的属性不使用
+            if get_le32(raw, off + 4) != 0 || value + size > raw.len() {
+                return None;
+            }
+            return Some(InlineXattr { entry: off, value, size });
+        }
+        off += xattr_entry_len(name_len);
+    }
+    None
+}
+
+/// inode 中能保存的 inline 数据字节数 (ext4_get_max_inline_size)
+///
+/// system.data 的值大小不变，所以就是 i_block 加上当前的值长度；没有 system.data 时为 0
+pub fn ext4_get_max_inline_size(raw: &[u8]) -> usize {
+    find_inline_xattr(raw).map_or(0, |xattr| EXT4_MIN_INLINE_DATA_SIZE + xattr.size)
+}
+
+/// 从 pos 起读取 inline 数据 (ext4_read_inline_data)
+///
+/// i_block 部分取自内存中的 inode，其余取自磁盘 inode 的 system.data 值
+///
+/// # 返回
+/// 读取的字节数，不超过文件大小
+pub fn ext4_read_inline_data(inode: &Ext4Inode, raw: &[u8], pos: usize, buf: &mut [u8]) -> usize {
+    let xattr = find_inline_xattr(raw);
+    let max = EXT4_MIN_INLINE_DATA_SIZE + xattr.as_ref().map_or(0, |x| x.size);
+    let end = (inode.get_size() as usize).min(max).min(pos.saturating_add(buf.len()));
+    if pos >= end {
+        return 0;
+    }
+    let mut i_block = [0u8; EXT4_MIN_INLINE_DATA_SIZE];
+    for (chunk, word) in i_block.chunks_mut(4).zip(inode.block.iter()) {
+        chunk.copy_from_slice(&word.to_le_bytes());
+    }
+    for (i, byte) in buf[..end - pos].iter_mut().enumerate() {
+        let off = pos + i;
+        *byte = if off < EXT4_MIN_INLINE_DATA_SIZE {
+            i_block[off]
+        } else {
+            // off < max，此时一定有 system.data
+            raw[xattr.as_ref().unwrap().value + off - EXT4_MIN_INLINE_DATA_SIZE]
+        };
+    }
+    end - pos
+}
+
+impl Ext4FileSystem {
+    /// 修改磁盘上的 inode 后重新计算校验和并交给日志
+    fn modify_raw_inode<R>(&self, ino: u32, f: impl FnOnce(&mut [u8]) -> Result<R, i32>) -> Result<R, i32> {
+        let (block, offset) = self.inode_loc(ino)?;
+        let bh = bio::bread(self.device, block).ok_or(errno::Errno::IOError.as_neg_i32())?;
+        let result = unsafe {
+            let raw = &mut (*bh).b_data[offset..offset + self.inode_size as usize];
+            f(raw).and_then(|r| {
+                self.inode_csum_set(ino, raw);
+                self.handle_dirty_metadata(bh).map(|()| r)
+            })
+        };
+        bio::brelse(bh);
+        result
+    }
+
+    /// 读取磁盘上的 inode，用于查找 system.data
+    fn read_raw_inode<R>(&self, ino: u32, f: impl FnOnce(&[u8]) -> R) -> Result<R, i32> {
+        let (block, offset) = self.inode_loc(ino)?;
+        let bh = bio::bread(self.device, block).ok_or(errno::Errno::IOError.as_neg_i32())?;
+        let result = f(unsafe { &(*bh).b_data[offset..offset + self.inode_size as usize] });
+        bio::brelse(bh);
+        Ok(result)
+    }
+
+    /// inode 中能保存的 inline 数据字节数，读取磁盘 inode
+    pub fn inline_max_size(&self, inode: &Ext4Inode) -> Result<usize, i32> {
+        self.read_raw_inode(inode.ino, ext4_get_max_inline_size)
+    }
+}
+
+/// 把文件的全部内容写入 inode (ext4_write_inline_data)
+///
+/// 前 60 字节写入 inode.block 与磁盘 inode 的 i_block，其余写入 system.data 的值，
+/// 值中多出的部分清零；大小等其他字段由调用者经 write_inode 写回
+///
+/// # 返回
+/// 内容超过 inode 能保存的大小时返回 ENOSPC
+pub fn ext4_write_inline_data(fs: &Ext4FileSystem, inode: &mut Ext4Inode, data: &[u8]) -> Result<(), i32> {
+    let mut i_block = [0u8; EXT4_MIN_INLINE_DATA_SIZE];
+    let head = data.len().min(EXT4_MIN_INLINE_DATA_SIZE);
+    i_block[..head].copy_from_slice(&data[..head]);
+    for (word, chunk) in inode.block.iter_mut().zip(i_block.chunks(4)) {
+        *word = u32::from_le_bytes([chunk[0], chunk[1], chunk[2], chunk[3]]);
+    }
+
+    fs.modify_raw_inode(inode.ino, |raw| {
+        let tail = &data[head..];
+        let xattr = match find_inline_xattr(raw) {
+            Some(xattr) if tail.len() <= xattr.size => xattr,
+            _ => return Err(errno::Errno::NoSpaceLeftOnDevice.as_neg_i32()),
+        };
+        raw[EXT4_INODE_I_BLOCK..EXT4_INODE_I_BLOCK + EXT4_MIN_INLINE_DATA_SIZE].copy_from_slice(&i_block);
+        let value = &mut raw[xattr.value..xattr.value + xattr.size];
+        value[..tail.len()].copy_from_slice(tail);
+        value[tail.len()..].fill(0);
+        Ok(())
+    })
+}
+
+/// 删除 inline 数据，inode 改为没有数据块的普通 inode (ext4_destroy_inline_data)
+///
+/// 清除 EXT4_INLINE_DATA_FL 与 i_block，移除 system.data 属性项：之后的属性项前移，
+/// 值区域清零；其他属性的值偏移不变。调用者先取出数据，再按普通文件写入
+pub fn ext4_destroy_inline_data(fs: &Ext4FileSystem, inode: &mut Ext4Inode) -> Result<(), i32> {
+    inode.flags &= !EXT4_INLINE_DATA_FL;
+    inode.block = [0; 15];
+    let flags = inode.flags;
+    fs.modify_raw_inode(inode.ino, |raw| {
+        raw[EXT4_INODE_I_FLAGS..EXT4_INODE_I_FLAGS + 4].copy_from_slice(&flags.to_le_bytes());
+        raw[EXT4_INODE_I_BLOCK..EXT4_INODE_I_BLOCK + EXT4_MIN_INLINE_DATA_SIZE].fill(0);
+        if let Some(xattr) = find_inline_xattr(raw) {
+            raw[xattr.value..xattr.value + xattr.size].fill(0);
+            // 找到属性表末尾的 4 字节 0
+            let len = xattr_entry_len(raw[xattr.entry] as usize);
+            let mut end = xattr.entry;
+            while end + EXT4_XATTR_ENTRY_SIZE <= raw.len() && get_le32(raw, end) != 0 {
+                end += xattr_entry_len(raw[end] as usize);
+            }
+            let end = end.min(raw.len());
+            raw.copy_within(xattr.entry + len..end, xattr.entry);
+            raw[end - len..end].fill(0);
+        }
+        Ok(())
+    })
+}
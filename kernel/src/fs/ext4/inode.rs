@@ -10,8 +10,6 @@
 use core::mem;
 use alloc::vec::Vec;
 
-use crate::errno;
-
 #[repr(C)]
 #[derive(Debug, Clone, Copy)]
 pub struct Ext4InodeOnDisk {
@@ -108,6 +106,8 @@ pub struct Ext4Inode {
     pub mtime: u32,
     /// 创建时间
     pub ctime: u32,
+    /// 生成号，与 inode 号一起派生 extent 块和目录块的校验和种子 (i_generation)
+    pub generation: u32,
 }
 
 impl Ext4Inode {
@@ -126,6 +126,7 @@ impl Ext4Inode {
             atime: disk.i_atime,
             mtime: disk.i_mtime,
             ctime: disk.i_ctime,
+            generation: disk.i_generation,
         }
     }
 
@@ -149,6 +150,11 @@ impl Ext4Inode {
         (self.flags & 0x80000) != 0
     }
 
+    /// 数据是否保存在 inode 中 (EXT4_INODE_INLINE_DATA)
+    pub fn has_inline_data(&self) -> bool {
+        (self.flags & super::inline::EXT4_INLINE_DATA_FL) != 0
+    }
+
     /// 获取文件大小
     pub fn get_size(&self) -> u64 {
         self.size
@@ -164,6 +170,10 @@ impl Ext4Inode {
     /// 支持 extent 和间接块两种模式
     pub fn get_data_blocks(&self, fs: &super::super::ext4::Ext4FileSystem) -> Result<Vec<u64>, i32> {
         let mut blocks = Vec::new();
+        // inline 数据没有数据块
+        if self.has_inline_data() {
+            return Ok(blocks);
+        }
 
         let remaining_blocks = (self.size + fs.block_size as u64 - 1) / (fs.block_size as u64);
 
@@ -171,7 +181,7 @@ impl Ext4Inode {
         if self.has_extent() {
             // 使用 extent 树查找
             for i in 0..remaining_blocks {
-                match super::extent::ext4_ext_get_block(fs, &self.block, i) {
+                match super::extent::ext4_ext_get_block(fs, self, i) {
                     Ok(block_num) => {
                         if block_num != 0 {
                             blocks.push(block_num);
@@ -205,10 +215,12 @@ impl Ext4Inode {
 
     /// 获取指定块索引的数据块号
     ///
-    /// 支持 extent 和间接块两种模式
+    /// 支持 extent 和间接块两种模式；inline 数据的 inode 返回 0
     pub fn get_data_block(&self, fs: &super::super::ext4::Ext4FileSystem, block_index: u64) -> Result<u64, i32> {
-        if self.has_extent() {
-            super::extent::ext4_ext_get_block(fs, &self.block, block_index)
+        if self.has_inline_data() {
+            Ok(0)
+        } else if self.has_extent() {
+            super::extent::ext4_ext_get_block(fs, self, block_index)
         } else {
             super::indirect::ext4_get_block(fs, &self.block, block_index)
         }
@@ -216,59 +228,14 @@ impl Ext4Inode {
 
     /// 读取文件数据
     ///
-    /// 从指定偏移量读取数据
+    /// 从指定偏移量读取数据，经页缓存 (见 file::ext4_file_read)
     pub fn read_data(
         &self,
         fs: &super::super::ext4::Ext4FileSystem,
         offset: u64,
         buf: &mut [u8],
     ) -> Result<usize, i32> {
-        use crate::fs::bio;
-
-        let file_size = self.get_size();
-        if offset >= file_size {
-            return Ok(0);
-        }
-
-        let available = file_size - offset;
-        let to_read = core::cmp::min(buf.len() as u64, available) as usize;
-
-        let blocks = self.get_data_blocks(fs)?;
-        let block_size = fs.block_size as usize;
-
-        let mut total_read = 0;
-        let mut current_offset = offset as usize;
-        let mut buf_offset = 0;
-
-        while total_read < to_read {
-            let block_index = current_offset / block_size;
-            let block_offset = current_offset % block_size;
-
-            if block_index >= blocks.len() {
-                break;
-            }
-
-            unsafe {
-                let bh = bio::bread(fs.device, blocks[block_index])
-                    .ok_or(errno::Errno::IOError.as_neg_i32())?;
-
-                let data = &(*bh).b_data;
-                let remaining = to_read - total_read;
-                let available_in_block = block_size - block_offset;
-                let read_in_block = core::cmp::min(remaining, available_in_block);
-
-                buf[buf_offset..buf_offset + read_in_block]
-                    .copy_from_slice(&data[block_offset..block_offset + read_in_block]);
-
-                total_read += read_in_block;
-                buf_offset += read_in_block;
-                current_offset += read_in_block;
-
-                bio::brelse(bh);
-            }
-        }
-
-        Ok(total_read)
+        super::file::ext4_file_read(fs, self, offset, buf)
     }
 }
 
@@ -0,0 +1,67 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 ioctl
+//!
+//! 参考: fs/ext4/ioctl.c
+
+use crate::arch::riscv64::uaccess::{get_user, put_user};
+use crate::errno;
+use crate::fs::ext4::{mballoc, Ext4FileSystem};
+
+/// 丢弃文件系统的空闲块 (FITRIM = _IOWR('X', 121, struct fstrim_range))
+pub const FITRIM: u32 = 0xC018_5879;
+
+/// FITRIM 的参数，均以字节为单位 (struct fstrim_range)
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct FstrimRange {
+    pub start: u64,
+    pub len: u64,
+    pub minlen: u64,
+}
+
+/// ext4 文件上的 ioctl (ext4_ioctl)
+///
+/// # 返回
+/// 不是 ext4 的命令时返回 None，由调用者继续处理
+pub fn ext4_ioctl(fs: &Ext4FileSystem, cmd: u32, arg: usize) -> Option<isize> {
+    match cmd {
+        FITRIM => Some(ext4_ioctl_fitrim(fs, arg)),
+        _ => None,
+    }
+}
+
+/// FITRIM：按字节范围丢弃空闲块，把丢弃的字节数写回 range.len (ext4_ioctl_fitrim)
+fn ext4_ioctl_fitrim(fs: &Ext4FileSystem, arg: usize) -> isize {
+    let disk = unsafe { &*fs.device };
+    if disk.max_discard_sectors == 0 {
+        return errno::Errno::OperationNotSupported.as_neg_i32() as isize;
+    }
+    let mut range = match get_user::<FstrimRange>(arg) {
+        Ok(range) => range,
+        Err(e) => return e as isize,
+    };
+
+    // 比设备丢弃粒度还短的段丢弃了也不会释放空间
+    let block_size = fs.block_size as u64;
+    let granularity = disk.discard_granularity as u64 * 512;
+    let minlen = range.minlen.max(granularity).div_ceil(block_size);
+    let start = range.start / block_size;
+    if minlen > fs.blocks_per_group as u64 || start >= fs.total_blocks || range.len < block_size {
+        return errno::Errno::InvalidArgument.as_neg_i32() as isize;
+    }
+
+    match mballoc::ext4_trim_fs(fs, start, range.len / block_size, minlen) {
+        Ok(trimmed) => {
+            range.len = trimmed * block_size;
+            match put_user(arg, &range) {
+                Ok(()) => 0,
+                Err(e) => e as isize,
+            }
+        }
+        Err(e) => e as isize,
+    }
+}
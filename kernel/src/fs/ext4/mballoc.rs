@@ -0,0 +1,594 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 多块分配器 (mballoc)
+//!
+//! 参考: fs/ext4/mballoc.c
+//!
+//! - 块组的块位图在第一次分配时读入内存 (ext4_mb_load_buddy)，并生成各阶伙伴位图：
+//!   第 k 阶的第 i 位为 1 表示块 [i·2^k, (i+1)·2^k) 全部空闲
+//! - 一次分配 N 个连续块 (ext4_mb_regular_allocator)：先试目标块 (goal)，
+//!   再在 ⌈log2 N⌉ 阶伙伴位图中找一段对齐的空闲块，最后退回 0 阶找第一段够长的空闲块；
+//!   都没有时返回组内最长的一段，调用者继续请求剩下的部分
+//! - 每个 inode 保留一个预分配窗口 (ext4_prealloc_space)：顺序追加时从窗口中连续取块，
+//!   窗口只在内存中保留，用完或不再连续时归还
+//! - 位图和块组描述符的空闲计数先在内存中修改，ext4_mb_flush 时一起写回；
+//!   超级块的空闲块数只记在每 CPU 计数器中，sync 与卸载时写回 (s_freeclusters_counter)
+//! - FITRIM 逐组把空闲段先保留再释放锁下发 Discard，期间分配不会拿到正在丢弃的块；
+//!   整组丢弃过且之后没有释放块时下次跳过 (EXT4_GROUP_INFO_WAS_TRIMMED)
+//! - 启用 flex_bg 时，第一次读某组位图会把整个 flex 组的位图一起读入 (ext4_mb_prefetch)
+
+use alloc::collections::BTreeMap;
+use alloc::vec;
+use alloc::vec::Vec;
+use spin::Mutex;
+
+use crate::errno;
+use crate::fs::bio;
+use crate::fs::ext4::superblock::Ext4GroupDesc;
+use crate::fs::ext4::Ext4FileSystem;
+
+/// 预分配窗口的块数 (s_mb_stream_request 对应的预分配大小)
+const MB_PREALLOC_BLOCKS: u64 = 64;
+
+/// 一次分配的块数上限（一个块组的位图只能覆盖这么多）
+const MB_MAX_ORDER: usize = 15;
+
+/// 位图操作：u64 字中按位存放，位为 1 表示空闲
+fn test_bit(bits: &[u64], i: usize) -> bool {
+    bits[i / 64] & (1 << (i % 64)) != 0
+}
+
+fn set_bit(bits: &mut [u64], i: usize, val: bool) {
+    if val {
+        bits[i / 64] |= 1 << (i % 64);
+    } else {
+        bits[i / 64] &= !(1 << (i % 64));
+    }
+}
+
+/// [from, limit) 中第一个置位的位 (mb_find_next_bit)
+fn next_set(bits: &[u64], from: usize, limit: usize) -> Option<usize> {
+    let mut i = from;
+    while i < limit {
+        let word = bits[i / 64] >> (i % 64);
+        if word == 0 {
+            i = (i / 64 + 1) * 64;
+            continue;
+        }
+        let found = i + word.trailing_zeros() as usize;
+        return if found < limit { Some(found) } else { None };
+    }
+    None
+}
+
+/// [from, limit) 中第一个清零的位，没有时返回 limit (mb_find_next_zero_bit)
+fn next_clear(bits: &[u64], from: usize, limit: usize) -> usize {
+    let mut i = from;
+    while i < limit {
+        let word = !bits[i / 64] >> (i % 64);
+        if word == 0 {
+            i = (i / 64 + 1) * 64;
+            continue;
+        }
+        return (i + word.trailing_zeros() as usize).min(limit);
+    }
+    limit
+}
+
+/// 块组在内存中的分配状态 (struct ext4_group_info)
+struct Ext4GroupInfo {
+    /// 磁盘上的块位图，位为 1 表示已用
+    bitmap: Vec<u8>,
+    /// 伙伴位图：buddy[0] 为空闲且未被预分配保留的块，buddy[k] 为 2^k 对齐的整段空闲
+    buddy: Vec<Vec<u64>>,
+    /// 组内块数（最后一组可能不满）
+    nr_blocks: usize,
+    /// 空闲块数（磁盘计数，不扣除预分配保留）
+    free: u32,
+    /// 位图和空闲计数需要写回
+    dirty: bool,
+    /// 上次 FITRIM 丢弃过整组空闲块，之后没有释放块 (EXT4_GROUP_INFO_WAS_TRIMMED)
+    trimmed: bool,
+}
+
+impl Ext4GroupInfo {
+    /// 由块位图生成伙伴位图 (ext4_mb_generate_buddy)
+    fn new(bitmap: Vec<u8>, nr_blocks: usize) -> Self {
+        let mut buddy = Vec::new();
+        let mut level = vec![0u64; (nr_blocks + 63) / 64];
+        let mut free = 0;
+        for i in 0..nr_blocks {
+            if bitmap[i / 8] & (1 << (i % 8)) == 0 {
+                set_bit(&mut level, i, true);
+                free += 1;
+            }
+        }
+        buddy.push(level);
+
+        let mut info = Self { bitmap, buddy, nr_blocks, free, dirty: false, trimmed: false };
+        let mut order = 1;
+        while order <= MB_MAX_ORDER && (1usize << order) <= nr_blocks {
+            let len = nr_blocks >> order;
+            info.buddy.push(vec![0u64; (len + 63) / 64]);
+            order += 1;
+        }
+        info.update_buddy(0, nr_blocks);
+        info
+    }
+
+    /// 0 阶的 [start, end) 改变后重新计算上层伙伴位图 (mb_mark_used / mb_free_blocks)
+    fn update_buddy(&mut self, start: usize, end: usize) {
+        for order in 1..self.buddy.len() {
+            let len = self.nr_blocks >> order;
+            let first = start >> order;
+            let last = ((end - 1) >> order).min(len.saturating_sub(1));
+            for i in first..=last {
+                let (lower, upper) = self.buddy.split_at_mut(order);
+                let lower = &lower[order - 1];
+                let val = test_bit(lower, 2 * i) && test_bit(lower, 2 * i + 1);
+                set_bit(&mut upper[0], i, val);
+            }
+        }
+    }
+
+    /// 在内存中保留 [start, start + len)，其他分配不再使用这些块
+    fn reserve(&mut self, start: usize, len: usize) {
+        for i in start..start + len {
+            set_bit(&mut self.buddy[0], i, false);
+        }
+        self.update_buddy(start, start + len);
+    }
+
+    /// 归还保留但未使用的块
+    fn unreserve(&mut self, start: usize, len: usize) {
+        for i in start..start + len {
+            set_bit(&mut self.buddy[0], i, true);
+        }
+        self.update_buddy(start, start + len);
+    }
+
+    /// 把已保留的块记为已用，写入磁盘位图
+    fn mark_used(&mut self, start: usize, len: usize) {
+        for i in start..start + len {
+            self.bitmap[i / 8] |= 1 << (i % 8);
+        }
+        self.free -= len as u32;
+        self.dirty = true;
+    }
+
+    /// 释放块 (ext4_free_blocks)
+    fn free_blocks(&mut self, start: usize, len: usize) {
+        for i in start..start + len {
+            self.bitmap[i / 8] &= !(1 << (i % 8));
+        }
+        self.free += len as u32;
+        self.dirty = true;
+        self.trimmed = false;
+        self.unreserve(start, len);
+    }
+
+    /// 保留 [start, end) 中所有不短于 minlen 的空闲段，准备丢弃 (ext4_try_to_trim_range)
+    ///
+    /// # 返回
+    /// 保留的 (组内起始块, 块数)
+    fn reserve_trim_extents(&mut self, start: usize, end: usize, minlen: usize) -> Vec<(usize, usize)> {
+        let end = end.min(self.nr_blocks);
+        let mut extents = Vec::new();
+        let mut pos = start;
+        while let Some(first) = next_set(&self.buddy[0], pos, end) {
+            let last = next_clear(&self.buddy[0], first, end);
+            if last - first >= minlen {
+                extents.push((first, last - first));
+            }
+            pos = last;
+        }
+        for &(first, len) in &extents {
+            self.reserve(first, len);
+        }
+        extents
+    }
+
+    /// 在组内找 len 个连续的空闲块，goal 为组内的目标块
+    ///
+    /// # 返回
+    /// (组内起始块, 块数)；块数可能小于 len，组内没有空闲块时返回 None
+    fn find_extent(&self, goal: Option<usize>, len: usize) -> Option<(usize, usize)> {
+        let free = &self.buddy[0];
+        let n = self.nr_blocks;
+
+        // 1. 目标块 (ext4_mb_find_by_goal)
+        if let Some(goal) = goal.filter(|&g| g < n) {
+            if test_bit(free, goal) && next_clear(free, goal, n) - goal >= len {
+                return Some((goal, len));
+            }
+        }
+
+        // 2. 伙伴位图中对齐的整段 (ext4_mb_simple_scan_group)
+        let order = (len.next_power_of_two().trailing_zeros() as usize).min(self.buddy.len() - 1);
+        if (1usize << order) >= len {
+            let level = &self.buddy[order];
+            if let Some(i) = next_set(level, 0, n >> order) {
+                return Some((i << order, len));
+            }
+        }
+
+        // 3. 0 阶中第一段够长的空闲块，没有时取最长的一段 (ext4_mb_complex_scan_group)
+        let mut best: Option<(usize, usize)> = None;
+        let mut pos = 0;
+        while let Some(start) = next_set(free, pos, n) {
+            let end = next_clear(free, start, n);
+            let run = end - start;
+            if run >= len {
+                return Some((start, len));
+            }
+            if best.map_or(true, |(_, best_len)| run > best_len) {
+                best = Some((start, run));
+            }
+            pos = end;
+        }
+        best
+    }
+}
+
+/// inode 的预分配窗口 (struct ext4_prealloc_space)
+///
+/// 逻辑块 lstart 起依次对应物理块 pstart 起的 len 块
+#[derive(Debug, Clone, Copy)]
+struct Ext4Prealloc {
+    lstart: u64,
+    pstart: u64,
+    len: u64,
+}
+
+/// 文件系统的分配状态 (struct ext4_sb_info 中的 s_group_info 等)
+struct Ext4MbContext {
+    /// 已读入的块组
+    groups: Vec<Option<Ext4GroupInfo>>,
+    /// inode 号 -> 预分配窗口
+    prealloc: BTreeMap<u32, Ext4Prealloc>,
+}
+
+/// 块设备 -> 分配状态
+static MB_CONTEXTS: Mutex<BTreeMap<usize, Ext4MbContext>> = Mutex::new(BTreeMap::new());
+
+/// 第一个数据块号（1KB 块时为 1）
+fn first_data_block(fs: &Ext4FileSystem) -> u64 {
+    fs.sb_info.as_ref().map(|sb| sb.s_first_data_block as u64).unwrap_or(0)
+}
+
+/// 块号 -> (块组, 组内偏移)
+fn block_group(fs: &Ext4FileSystem, block: u64) -> (usize, usize) {
+    let rel = block - first_data_block(fs);
+    let bpg = fs.blocks_per_group as u64;
+    ((rel / bpg) as usize, (rel % bpg) as usize)
+}
+
+/// 块组的起始块号
+fn group_first_block(fs: &Ext4FileSystem, group: usize) -> u64 {
+    first_data_block(fs) + group as u64 * fs.blocks_per_group as u64
+}
+
+/// 位图块不在缓存中时预读它所在 flex 组的全部位图 (ext4_mb_prefetch)
+///
+/// flex_bg 把同一 flex 组内各块组的块位图、inode 位图分别连续存放，
+/// 整组位图在一个 plug 中提交，合并为两个多块读请求；之后扫描相邻块组时直接命中缓存。
+/// 没有 flex_bg 时各组位图分散在各自的块组开头，不预读
+pub fn ext4_mb_prefetch(fs: &Ext4FileSystem, group: usize, bitmap_block: u64) {
+    let flex = fs.groups_per_flex() as usize;
+    if flex <= 1 {
+        return;
+    }
+    if let Some(bh) = bio::find_get_block(fs.device, bitmap_block) {
+        bio::brelse(bh);
+        return;
+    }
+    let first = group & !(flex - 1);
+    let last = (first + flex).min(fs.group_descs.len());
+    let mut blocks = Vec::with_capacity((last - first) * 2);
+    for desc in &fs.group_descs[first..last] {
+        blocks.extend([desc.bg_block_bitmap as u64, desc.bg_inode_bitmap as u64].into_iter().filter(|&b| b != 0));
+    }
+    blocks.sort_unstable();
+    bio::breadahead(fs.device, &blocks);
+}
+
+impl Ext4MbContext {
+    fn new(fs: &Ext4FileSystem) -> Self {
+        let mut groups = Vec::new();
+        groups.resize_with(fs.group_count as usize, || None);
+        Self { groups, prealloc: BTreeMap::new() }
+    }
+
+    /// 读入块组位图并生成伙伴位图 (ext4_mb_load_buddy)
+    fn load_group(&mut self, fs: &Ext4FileSystem, group: usize) -> Result<&mut Ext4GroupInfo, i32> {
+        if self.groups[group].is_none() {
+            let bitmap_block = fs.group_descs[group].bg_block_bitmap as u64;
+            if bitmap_block == 0 {
+                return Err(errno::Errno::IOError.as_neg_i32());
+            }
+            ext4_mb_prefetch(fs, group, bitmap_block);
+            let bitmap = unsafe {
+                let bh = bio::bread(fs.device, bitmap_block)
+                    .ok_or(errno::Errno::IOError.as_neg_i32())?;
+                let bitmap = (*bh).b_data[..fs.block_size as usize].to_vec();
+                bio::brelse(bh);
+                bitmap
+            };
+            let start = group_first_block(fs, group);
+            let nr_blocks = (fs.total_blocks.saturating_sub(start))
+                .min(fs.blocks_per_group as u64)
+                .min(bitmap.len() as u64 * 8) as usize;
+            self.groups[group] = Some(Ext4GroupInfo::new(bitmap, nr_blocks));
+        }
+        Ok(self.groups[group].as_mut().unwrap())
+    }
+
+    /// 从 goal 所在的块组开始依次找空闲块，找到后在内存中保留
+    ///
+    /// # 返回
+    /// (起始块号, 块数)
+    fn find_and_reserve(&mut self, fs: &Ext4FileSystem, goal: u64, len: u64) -> Result<(u64, u64), i32> {
+        let nr_groups = self.groups.len();
+        let goal = goal.clamp(first_data_block(fs), fs.total_blocks.saturating_sub(1));
+        let (goal_group, goal_off) = block_group(fs, goal);
+        let len = len.min(1 << MB_MAX_ORDER) as usize;
+
+        for i in 0..nr_groups {
+            let group = (goal_group + i) % nr_groups;
+            // 磁盘计数为 0 的组不必读入位图
+            if self.groups[group].is_none() && fs.group_descs[group].bg_free_blocks_count == 0 {
+                continue;
+            }
+            let info = self.load_group(fs, group)?;
+            let goal = if i == 0 { Some(goal_off) } else { None };
+            if let Some((start, got)) = info.find_extent(goal, len) {
+                info.reserve(start, got);
+                return Ok((group_first_block(fs, group) + start as u64, got as u64));
+            }
+        }
+        Err(errno::Errno::NoSpaceLeftOnDevice.as_neg_i32())
+    }
+
+    /// 把保留的 [block, block + len) 记为已用
+    fn commit(&mut self, fs: &Ext4FileSystem, block: u64, len: u64) {
+        let (group, off) = block_group(fs, block);
+        if let Some(info) = self.groups[group].as_mut() {
+            info.mark_used(off, len as usize);
+            fs.mod_free_blocks(-(len as i64));
+        }
+    }
+
+    /// 归还保留未用的块
+    fn unreserve(&mut self, fs: &Ext4FileSystem, block: u64, len: u64) {
+        let (group, off) = block_group(fs, block);
+        if let Some(info) = self.groups[group].as_mut() {
+            info.unreserve(off, len as usize);
+        }
+    }
+
+    /// 丢弃 inode 的预分配窗口 (ext4_discard_preallocations)
+    fn discard(&mut self, fs: &Ext4FileSystem, ino: u32) {
+        if let Some(pa) = self.prealloc.remove(&ino) {
+            self.unreserve(fs, pa.pstart, pa.len);
+        }
+    }
+
+    /// 分配块 (ext4_mb_new_blocks)
+    fn new_blocks(&mut self, fs: &Ext4FileSystem, ino: u32, lblk: u64, goal: u64, len: u64) -> Result<(u64, u64), i32> {
+        // 1. 从预分配窗口中连续取块 (ext4_mb_use_preallocated)
+        if let Some(pa) = self.prealloc.get_mut(&ino) {
+            if pa.lstart == lblk {
+                let got = pa.len.min(len);
+                let pblk = pa.pstart;
+                pa.lstart += got;
+                pa.pstart += got;
+                pa.len -= got;
+                if pa.len == 0 {
+                    self.prealloc.remove(&ino);
+                }
+                self.commit(fs, pblk, got);
+                return Ok((pblk, got));
+            }
+        }
+        // 不再连续：归还旧窗口，新窗口紧接在目标块之后
+        if ino != 0 {
+            self.discard(fs, ino);
+        }
+
+        // 2. 普通文件按窗口大小请求，多出的部分留作预分配
+        let request = if ino != 0 { len.max(MB_PREALLOC_BLOCKS) } else { len };
+        let (pblk, got) = match self.find_and_reserve(fs, goal, request) {
+            Ok(found) => found,
+            Err(e) => {
+                // 空间不足时先收回所有预分配窗口再试 (ext4_mb_discard_preallocations)
+                if self.prealloc.is_empty() {
+                    return Err(e);
+                }
+                let inos: Vec<u32> = self.prealloc.keys().copied().collect();
+                for ino in inos {
+                    self.discard(fs, ino);
+                }
+                self.find_and_reserve(fs, goal, len)?
+            }
+        };
+
+        let used = got.min(len);
+        self.commit(fs, pblk, used);
+        if got > used {
+            self.prealloc.insert(ino, Ext4Prealloc { lstart: lblk + used, pstart: pblk + used, len: got - used });
+        }
+        Ok((pblk, used))
+    }
+
+    /// 写回修改过的位图和块组描述符
+    fn flush(&mut self, fs: &Ext4FileSystem) -> Result<(), i32> {
+        let desc_size = core::mem::size_of::<Ext4GroupDesc>();
+        let desc_start = if fs.block_size == 1024 { 2 } else { 1 };
+        let desc_per_block = fs.block_size as usize / desc_size;
+
+        for (group, info) in self.groups.iter_mut().enumerate() {
+            let info = match info {
+                Some(info) if info.dirty => info,
+                _ => continue,
+            };
+            unsafe {
+                // 块位图
+                let bh = bio::bread(fs.device, fs.group_descs[group].bg_block_bitmap as u64)
+                    .ok_or(errno::Errno::IOError.as_neg_i32())?;
+                (*bh).b_data[..info.bitmap.len()].copy_from_slice(&info.bitmap);
+                let result = fs.handle_dirty_metadata(bh);
+                bio::brelse(bh);
+                result?;
+
+                // 块组描述符的 bg_free_blocks_count（偏移 12）
+                let desc_block = desc_start + (group / desc_per_block) as u64;
+                let desc_offset = (group % desc_per_block) * desc_size;
+                let bh = bio::bread(fs.device, desc_block)
+                    .ok_or(errno::Errno::IOError.as_neg_i32())?;
+                let ptr = (*bh).b_data.as_mut_ptr().add(desc_offset + 12) as *mut u16;
+                ptr.write_unaligned(info.free as u16);
+                let desc = &mut (*bh).b_data[desc_offset..desc_offset + desc_size];
+                fs.block_bitmap_csum_set(desc, &info.bitmap);
+                fs.group_desc_csum_set(group as u32, desc);
+                let result = fs.handle_dirty_metadata(bh);
+                bio::brelse(bh);
+                result?;
+            }
+            info.dirty = false;
+        }
+        Ok(())
+    }
+}
+
+fn with_context<R>(fs: &Ext4FileSystem, f: impl FnOnce(&mut Ext4MbContext) -> R) -> R {
+    let mut contexts = MB_CONTEXTS.lock();
+    let ctx = contexts
+        .entry(fs.device as usize)
+        .or_insert_with(|| Ext4MbContext::new(fs));
+    f(ctx)
+}
+
+/// 为 inode 的逻辑块 lblk 起分配最多 len 个连续块 (ext4_mb_new_blocks)
+///
+/// # 参数
+/// - `ino`: inode 号，0 表示元数据块（不使用预分配窗口）
+/// - `goal`: 希望得到的物理块号，通常是前一个逻辑块的物理块号 + 1
+///
+/// # 返回
+/// (起始块号, 块数)，块数至少为 1；位图与计数在 ext4_mb_flush 时写回
+pub fn ext4_mb_new_blocks(fs: &Ext4FileSystem, ino: u32, lblk: u64, goal: u64, len: u64) -> Result<(u64, u64), i32> {
+    if len == 0 || fs.group_count == 0 {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    with_context(fs, |ctx| ctx.new_blocks(fs, ino, lblk, goal, len))
+}
+
+/// 释放 [block, block + len) (ext4_free_blocks)
+pub fn ext4_mb_free_blocks(fs: &Ext4FileSystem, block: u64, len: u64) -> Result<(), i32> {
+    if block < first_data_block(fs) || block + len > fs.total_blocks || len == 0 {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    with_context(fs, |ctx| {
+        let mut block = block;
+        let mut left = len;
+        while left > 0 {
+            let (group, off) = block_group(fs, block);
+            let info = ctx.load_group(fs, group)?;
+            let n = left.min((info.nr_blocks - off) as u64);
+            info.free_blocks(off, n as usize);
+            fs.mod_free_blocks(n as i64);
+            block += n;
+            left -= n;
+        }
+        Ok(())
+    })
+}
+
+/// 归还 inode 的预分配窗口 (ext4_discard_preallocations)
+pub fn ext4_mb_discard_preallocations(fs: &Ext4FileSystem, ino: u32) {
+    with_context(fs, |ctx| ctx.discard(fs, ino))
+}
+
+/// 把分配结果写回磁盘：每个改动过的块组写一次位图和描述符
+pub fn ext4_mb_flush(fs: &Ext4FileSystem) -> Result<(), i32> {
+    with_context(fs, |ctx| ctx.flush(fs))
+}
+
+/// 丢弃 [start, start + len) 中不短于 minlen 块的空闲段 (ext4_trim_fs)
+///
+/// 每组的空闲段先在持锁时保留，释放锁后下发 Discard，完成后归还；
+/// 设备不支持 Discard 时返回 -EOPNOTSUPP
+///
+/// # 返回
+/// 丢弃的块数
+pub fn ext4_trim_fs(fs: &Ext4FileSystem, start: u64, len: u64, minlen: u64) -> Result<u64, i32> {
+    let disk = unsafe { &*fs.device };
+    if disk.max_discard_sectors == 0 {
+        return Err(errno::Errno::OperationNotSupported.as_neg_i32());
+    }
+    if fs.group_count == 0 {
+        return Ok(0);
+    }
+    let first = start.max(first_data_block(fs));
+    let end = start.saturating_add(len).min(fs.total_blocks);
+    if first >= end {
+        return Ok(0);
+    }
+    let minlen = minlen.max(1) as usize;
+    let sectors_per_block = fs.block_size as u64 / 512;
+    let (first_group, _) = block_group(fs, first);
+    let (last_group, _) = block_group(fs, end - 1);
+
+    let mut trimmed = 0;
+    for group in first_group..=last_group {
+        let base = group_first_block(fs, group);
+        let lo = (first.max(base) - base) as usize;
+        let hi = (end - base).min(fs.blocks_per_group as u64) as usize;
+        let extents = with_context(fs, |ctx| -> Result<Option<(Vec<(usize, usize)>, bool)>, i32> {
+            if ctx.groups[group].is_none() && fs.group_descs[group].bg_free_blocks_count == 0 {
+                return Ok(None);
+            }
+            let info = ctx.load_group(fs, group)?;
+            let whole = lo == 0 && hi >= info.nr_blocks;
+            if info.trimmed && whole {
+                return Ok(None);
+            }
+            Ok(Some((info.reserve_trim_extents(lo, hi, minlen), whole)))
+        })?;
+        let (extents, whole) = match extents {
+            Some(found) => found,
+            None => continue,
+        };
+
+        let mut result = Ok(());
+        for &(off, n) in &extents {
+            let block = base + off as u64;
+            result = crate::drivers::blkdev::blkdev_issue_discard(
+                fs.device, block * sectors_per_block, n as u64 * sectors_per_block);
+            if result.is_err() {
+                break;
+            }
+            trimmed += n as u64;
+        }
+        with_context(fs, |ctx| {
+            if let Some(info) = ctx.groups[group].as_mut() {
+                for &(off, n) in &extents {
+                    info.unreserve(off, n);
+                }
+                if result.is_ok() && whole && minlen == 1 {
+                    info.trimmed = true;
+                }
+            }
+        });
+        result?;
+    }
+    Ok(trimmed)
+}
+
+/// 块组在内存中的空闲块数（未读入的组返回 None）
+pub fn ext4_mb_group_free(fs: &Ext4FileSystem, group: usize) -> Option<u32> {
+    with_context(fs, |ctx| ctx.groups.get(group)?.as_ref().map(|info| info.free))
+}
@@ -19,21 +19,44 @@ pub mod inode;
 pub mod dir;
 pub mod file;
 pub mod allocator;
+pub mod mballoc;
+pub mod ioctl;
 pub mod indirect;
 pub mod extent;
+pub mod extents_status;
+pub mod hash;
+pub mod namei;
+pub mod ext4_jbd2;
+pub mod csum;
+pub mod inline;
 
 use alloc::boxed::Box;
 use alloc::string::String;
 use alloc::string::ToString;
+use alloc::sync::Arc;
 use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, Ordering};
 
 use crate::errno;
 use crate::drivers::blkdev;
 use crate::fs::bio;
+use crate::fs::dentry::Dentry;
+use crate::fs::inode as vfs_inode;
+use crate::fs::namei::{path_walk, PathWalk};
 use crate::fs::superblock::{FileSystemType, FsContext, SuperBlock};
+use crate::percpu_counter::PercpuCounter;
+
+pub use ext4_jbd2::sync_fs;
 
 pub const EXT4_SUPER_MAGIC: u16 = 0xEF53;
 
+/// 读 inode 表时一次预读的块数，须为 2 的幂 (EXT4_DEF_INODE_READAHEAD_BLKS)
+pub const EXT4_INODE_READAHEAD_BLKS: u64 = 32;
+/// 块组描述符带 crc16 校验和 (EXT4_FEATURE_RO_COMPAT_GDT_CSUM)
+const EXT4_FEATURE_RO_COMPAT_GDT_CSUM: u32 = 0x10;
+/// 块组的位图与 inode 表集中存放 (EXT4_FEATURE_INCOMPAT_FLEX_BG)
+const EXT4_FEATURE_INCOMPAT_FLEX_BG: u32 = 0x200;
+
 pub struct Ext4FileSystem {
     /// 块设备
     pub device: *const blkdev::GenDisk,
@@ -57,6 +80,34 @@ pub struct Ext4FileSystem {
     pub total_blocks: u64,
     /// 总 inode 数
     pub total_inodes: u32,
+    /// 特性兼容标志 (s_feature_compat)
+    pub feature_compat: u32,
+    /// 特性不兼容标志 (s_feature_incompat)
+    pub feature_incompat: u32,
+    /// 只读兼容特性标志 (s_feature_ro_compat)
+    pub feature_ro_compat: u32,
+    /// 元数据校验和种子 (s_csum_seed)
+    pub csum_seed: u32,
+    /// 每个 flex 组的块组数的对数 (s_log_groups_per_flex)
+    pub log_groups_per_flex: u8,
+    /// 超级块标志 (s_flags)，指明目录哈希按有符号还是无符号字符计算
+    pub s_flags: u32,
+    /// 目录哈希种子 (s_hash_seed)
+    pub hash_seed: [u32; 4],
+    /// 新建索引目录使用的哈希算法 (s_def_hash_version)
+    pub def_hash_version: u8,
+    /// 设备号，dcache 以它区分不同的文件系统实例
+    pub s_dev: u64,
+    /// 日志 inode 号 (s_journal_inum)
+    pub journal_inum: u32,
+    /// 元数据日志，没有日志或未加载时为 None
+    pub journal: Option<Arc<crate::fs::jbd2::Journal>>,
+    /// 空闲块数 (s_freeclusters_counter)
+    pub s_freeclusters_counter: PercpuCounter,
+    /// 空闲 inode 数 (s_freeinodes_counter)
+    pub s_freeinodes_counter: PercpuCounter,
+    /// 计数器自上次写回超级块后是否变过
+    s_counts_dirty: AtomicBool,
 }
 
 unsafe impl Send for Ext4FileSystem {}
@@ -77,6 +128,20 @@ impl Ext4FileSystem {
             group_count: 0,
             total_blocks: 0,
             total_inodes: 0,
+            feature_compat: 0,
+            feature_incompat: 0,
+            feature_ro_compat: 0,
+            csum_seed: 0,
+            log_groups_per_flex: 0,
+            s_flags: 0,
+            hash_seed: [0; 4],
+            def_hash_version: 0,
+            s_dev: crate::fs::superblock::get_anon_bdev(),
+            journal_inum: 0,
+            journal: None,
+            s_freeclusters_counter: PercpuCounter::new(0),
+            s_freeinodes_counter: PercpuCounter::new(0),
+            s_counts_dirty: AtomicBool::new(false),
         }
     }
 
@@ -103,6 +168,17 @@ impl Ext4FileSystem {
                 return Err(errno::Errno::IOError.as_neg_i32());
             }
 
+            // 启用元数据校验和时先校验超级块 (ext4_superblock_csum_verify)
+            let sb_raw = &sb_data[1024..2048];
+            if !csum::ext4_superblock_csum_verify(sb_raw) {
+                crate::println!("ext4: superblock checksum does not match");
+                bio::brelse(sb_bh);
+                return Err(csum::efsbadcrc());
+            }
+            self.feature_ro_compat = u32::from_le_bytes([sb_raw[0x64], sb_raw[0x65], sb_raw[0x66], sb_raw[0x67]]);
+            self.csum_seed = csum::ext4_csum_seed(sb_raw);
+            self.log_groups_per_flex = sb_raw[0x174];
+
             // 解析超级块
             let block_size = 1024 << ext4_sb.s_log_block_size;
             let block_size_bits = (12 + ext4_sb.s_log_block_size) as u8;
@@ -129,10 +205,15 @@ impl Ext4FileSystem {
                     .ok_or(errno::Errno::IOError.as_neg_i32())?;
 
                 let gd_data = &(*gd_bh).b_data;
-                let gd_ptr = unsafe {
-                    &*(gd_data.as_ptr().add(gd_offset * core::mem::size_of::<superblock::Ext4GroupDesc>())
-                        as *const superblock::Ext4GroupDesc)
-                };
+                let gd_size = core::mem::size_of::<superblock::Ext4GroupDesc>();
+                let gd_raw = &gd_data[gd_offset * gd_size..(gd_offset + 1) * gd_size];
+                if !self.group_desc_csum_verify(i as u32, gd_raw) {
+                    crate::println!("ext4: group descriptor {} checksum does not match", i);
+                    bio::brelse(gd_bh);
+                    bio::brelse(sb_bh);
+                    return Err(csum::efsbadcrc());
+                }
+                let gd_ptr = unsafe { &*(gd_raw.as_ptr() as *const superblock::Ext4GroupDesc) };
 
                 group_descs.push(Box::new(*gd_ptr));
                 bio::brelse(gd_bh);
@@ -161,39 +242,174 @@ impl Ext4FileSystem {
             self.group_count = group_count as u32;
             self.total_blocks = total_blocks as u64;
             self.total_inodes = total_inodes;
+            self.feature_compat = ext4_sb.s_feature_compat;
+            self.feature_incompat = ext4_sb.s_feature_incompat;
+            self.s_flags = ext4_sb.s_flags;
+            self.hash_seed = ext4_sb.s_hash_seed;
+            self.def_hash_version = ext4_sb.s_def_hash_version;
+            self.journal_inum = ext4_sb.s_journal_inum;
+
+            // 空闲计数以块组描述符为准：超级块中的值只在 sync 和卸载时写回，
+            // 崩溃后可能过时 (ext4_count_free_clusters / ext4_count_free_inodes)
+            self.s_freeclusters_counter.set(group_descs.iter().map(|gd| gd.bg_free_blocks_count as i64).sum());
+            self.s_freeinodes_counter.set(group_descs.iter().map(|gd| gd.bg_free_inodes_count as i64).sum());
+            self.s_counts_dirty.store(false, Ordering::Relaxed);
             self.group_descs = group_descs;
 
             Ok(())
         }
     }
 
-    /// 读取 inode
-    pub fn read_inode(&self, ino: u32) -> Result<inode::Ext4Inode, i32> {
-        unsafe {
-            // 计算块组和 inode 表索引
-            let group = (ino - 1) / self.inodes_per_group;
-            let index = (ino - 1) % self.inodes_per_group;
+    /// 文件系统是否支持 extent (INCOMPAT_EXTENTS)
+    pub fn has_extents(&self) -> bool {
+        (self.feature_incompat & 0x40) != 0
+    }
+
+    /// 文件系统是否支持索引目录 (COMPAT_DIR_INDEX)
+    pub fn has_dir_index(&self) -> bool {
+        (self.feature_compat & 0x20) != 0
+    }
+
+    /// 每个 flex 组的块组数，未启用 flex_bg 时为 1 (ext4_flex_bg_size)
+    pub fn groups_per_flex(&self) -> u32 {
+        if self.feature_incompat & EXT4_FEATURE_INCOMPAT_FLEX_BG == 0 || self.log_groups_per_flex >= 31 {
+            return 1;
+        }
+        1 << self.log_groups_per_flex
+    }
+
+    /// 块组描述符是否带校验和，带时 bg_itable_unused 有效 (ext4_has_group_desc_csum)
+    pub fn has_group_desc_csum(&self) -> bool {
+        self.feature_ro_compat & EXT4_FEATURE_RO_COMPAT_GDT_CSUM != 0 || self.has_metadata_csum()
+    }
+
+    /// 分配或释放块后调整空闲块计数
+    pub fn mod_free_blocks(&self, delta: i64) {
+        self.s_freeclusters_counter.add(delta);
+        self.s_counts_dirty.store(true, Ordering::Release);
+    }
+
+    /// 分配或释放 inode 后调整空闲 inode 计数
+    pub fn mod_free_inodes(&self, delta: i64) {
+        self.s_freeinodes_counter.add(delta);
+        self.s_counts_dirty.store(true, Ordering::Release);
+    }
+
+    /// 把空闲计数的准确值写回超级块 (ext4_commit_super 中的 s_free_*_count)
+    ///
+    /// 分配与释放只修改每 CPU 计数器，超级块不再是每次分配都要改写的热点；
+    /// sync 与卸载时汇总一次，随同一个事务提交。计数器没变过时什么也不做
+    pub fn commit_super_counts(&self) -> Result<(), i32> {
+        if !self.s_counts_dirty.swap(false, Ordering::AcqRel) {
+            return Ok(());
+        }
+        let free_blocks = self.s_freeclusters_counter.sum_positive().min(u32::MAX as i64) as u32;
+        let free_inodes = self.s_freeinodes_counter.sum_positive().min(u32::MAX as i64) as u32;
+        let bh = match bio::bread(self.device, 0) {
+            Some(bh) => bh,
+            None => {
+                self.s_counts_dirty.store(true, Ordering::Release);
+                return Err(errno::Errno::IOError.as_neg_i32());
+            }
+        };
+        let result = unsafe {
+            // 超级块在块 0 偏移 1024 处，s_free_blocks_count_lo 偏移 12，s_free_inodes_count 偏移 16
+            let sb = &mut (*bh).b_data[1024..2048];
+            sb[12..16].copy_from_slice(&free_blocks.to_le_bytes());
+            sb[16..20].copy_from_slice(&free_inodes.to_le_bytes());
+            csum::ext4_superblock_csum_set(sb);
+            self.handle_dirty_metadata(bh)
+        };
+        bio::brelse(bh);
+        if result.is_err() {
+            self.s_counts_dirty.store(true, Ordering::Release);
+        }
+        result
+    }
+
+    /// 预读 inode 表 (__ext4_get_inode_loc)
+    ///
+    /// 从 block 所在的对齐窗口起读 EXT4_INODE_READAHEAD_BLKS 块，只读 inode 表中用过的部分：
+    /// 描述符带校验和时，每组最后 bg_itable_unused 个 inode 从未分配过
+    fn inode_table_readahead(&self, group: u32, block: u64) {
+        let gd = &self.group_descs[group as usize];
+        let table = gd.bg_inode_table as u64;
+        let inodes_per_block = (self.block_size / self.inode_size as u32) as u64;
+        let mut used = self.inodes_per_group as u64;
+        if self.has_group_desc_csum() {
+            used = used.saturating_sub(gd.bg_itable_unused_lo as u64);
+        }
+        let start = table + ((block - table) & !(EXT4_INODE_READAHEAD_BLKS - 1));
+        let end = (table + used.div_ceil(inodes_per_block))
+            .min(start + EXT4_INODE_READAHEAD_BLKS)
+            .max(block + 1);
+        let blocks: Vec<u64> = (start..end).collect();
+        bio::breadahead(self.device, &blocks);
+    }
 
-            if group as usize >= self.group_descs.len() {
-                return Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32());
+    /// 读取 inode (ext4_iget)
+    ///
+    /// 先查 inode 缓存，命中时不读 inode 表；未命中时从磁盘读入并加入缓存
+    pub fn read_inode(&self, ino: u32) -> Result<inode::Ext4Inode, i32> {
+        if let Some(cached) = vfs_inode::ilookup(self.s_dev, ino as u64) {
+            if let Some(ei) = cached.i_fsdata.lock().as_ref().and_then(|d| d.downcast_ref::<inode::Ext4Inode>()) {
+                return Ok(ei.clone());
             }
+        }
 
-            let gd = &self.group_descs[group as usize];
+        let ei = self.read_inode_disk(ino)?;
+        let mut vi = vfs_inode::Inode::new(ino as u64, vfs_inode::InodeMode::new(ei.mode as u32));
+        vi.set_size(ei.size);
+        vi.i_dev = self.s_dev;
+        vi.write_inode = Some(ext4_write_inode);
+        vi.set_private_data(self as *const Ext4FileSystem as *mut u8);
+        *vi.i_fsdata.lock() = Some(Box::new(ei.clone()));
+        vfs_inode::insert_inode_hash(Arc::new(vi));
+        Ok(ei)
+    }
 
-            // 计算 inode 块号
-            let inode_table_start = gd.bg_inode_table;
-            let inodes_per_block = self.block_size / (self.inode_size as u32);
-            let inode_block = inode_table_start + (index / inodes_per_block);
-            let inode_offset = ((index % inodes_per_block) * (self.inode_size as u32)) as usize;
+    /// inode 在 inode 表中的位置：(块号, 块内偏移) (__ext4_get_inode_loc)
+    pub(crate) fn inode_loc(&self, ino: u32) -> Result<(u64, usize), i32> {
+        let group = (ino.wrapping_sub(1) / self.inodes_per_group.max(1)) as usize;
+        let index = ino.wrapping_sub(1) % self.inodes_per_group.max(1);
+        let gd = self.group_descs.get(group).ok_or(errno::Errno::InvalidArgument.as_neg_i32())?;
+        let inodes_per_block = self.block_size / (self.inode_size as u32);
+        let block = gd.bg_inode_table as u64 + (index / inodes_per_block) as u64;
+        let offset = ((index % inodes_per_block) * (self.inode_size as u32)) as usize;
+        Ok((block, offset))
+    }
 
-            // 读取包含 inode 的块
-            let bh = bio::bread(self.device, inode_block as u64)
-                .ok_or(errno::Errno::IOError.as_neg_i32())?;
+    /// 从 inode 表读取并解析 inode
+    fn read_inode_disk(&self, ino: u32) -> Result<inode::Ext4Inode, i32> {
+        if ino == 0 {
+            return Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32());
+        }
+        let (inode_block, inode_offset) = self
+            .inode_loc(ino)
+            .map_err(|_| errno::Errno::NoSuchFileOrDirectory.as_neg_i32())?;
+        let group = (ino - 1) / self.inodes_per_group;
+        unsafe {
+            // 读取包含 inode 的块，未缓存时连同 inode 表的后续块一起读入
+            let bh = match bio::find_get_block(self.device, inode_block) {
+                Some(bh) => bh,
+                None => {
+                    self.inode_table_readahead(group, inode_block);
+                    bio::bread(self.device, inode_block)
+                        .ok_or(errno::Errno::IOError.as_neg_i32())?
+                }
+            };
 
             let data = &(*bh).b_data;
 
+            let raw = &data[inode_offset..inode_offset + self.inode_size as usize];
+            if !self.inode_csum_verify(ino, raw) {
+                crate::println!("ext4: inode {} checksum does not match", ino);
+                bio::brelse(bh);
+                return Err(csum::efsbadcrc());
+            }
+
             // 解析 inode
-            let ext4_inode = &*(data.as_ptr().add(inode_offset) as *const inode::Ext4InodeOnDisk);
+            let ext4_inode = &*(raw.as_ptr() as *const inode::Ext4InodeOnDisk);
 
             let result = inode::Ext4Inode::from_disk(ext4_inode, ino);
 
@@ -202,6 +418,67 @@ impl Ext4FileSystem {
         }
     }
 
+    /// 更新 inode (ext4_mark_inode_dirty)
+    ///
+    /// 修改缓存中的 inode 并标记为脏，由回写线程或 sync 写回 inode 表
+    pub fn write_inode(&self, inode: &inode::Ext4Inode) -> Result<(), i32> {
+        let cached = match vfs_inode::ilookup(self.s_dev, inode.ino as u64) {
+            Some(cached) => cached,
+            // 不在缓存中（已被淘汰）时直接写回
+            None => return self.update_inode_disk(inode),
+        };
+        *cached.i_fsdata.lock() = Some(Box::new(inode.clone()));
+        cached.set_size(inode.size);
+        vfs_inode::mark_inode_dirty(&cached);
+        Ok(())
+    }
+
+    /// 立即把缓存中的脏 inode 写回 inode 表 (ext4_write_inode + WB_SYNC_ALL)
+    pub fn sync_inode(&self, ino: u32) -> Result<(), i32> {
+        match vfs_inode::ilookup(self.s_dev, ino as u64) {
+            Some(cached) => vfs_inode::write_inode_now(&cached),
+            None => Ok(()),
+        }
+    }
+
+    /// 把 inode 的大小、块数、块映射和修改时间写回 inode 表 (ext4_do_update_inode)
+    fn update_inode_disk(&self, inode: &inode::Ext4Inode) -> Result<(), i32> {
+        let (inode_block, inode_offset) = self.inode_loc(inode.ino)?;
+        unsafe {
+            let bh = bio::bread(self.device, inode_block)
+                .ok_or(errno::Errno::IOError.as_neg_i32())?;
+
+            let disk = &mut *((*bh).b_data.as_mut_ptr().add(inode_offset) as *mut inode::Ext4InodeOnDisk);
+            // 大小或块映射变化时 fdatasync 也要等这次写入提交
+            let datasync = disk.i_size != inode.size as u32
+                || disk.i_dir_acl != (inode.size >> 32) as u32
+                || disk.i_blocks != inode.blocks as u32
+                || disk.i_block != inode.block;
+            disk.i_size = inode.size as u32;
+            // 普通文件的 i_dir_acl 即 i_size_high
+            disk.i_dir_acl = (inode.size >> 32) as u32;
+            disk.i_blocks = inode.blocks as u32;
+            disk.i_flags = inode.flags;
+            disk.i_block = inode.block;
+            disk.i_mtime = inode.mtime;
+            self.inode_csum_set(inode.ino, &mut (*bh).b_data[inode_offset..inode_offset + self.inode_size as usize]);
+
+            let result = self.handle_dirty_metadata(bh);
+            bio::brelse(bh);
+            if let (Ok(()), Some(journal)) = (&result, &self.journal) {
+                // ext4_update_inode_fsync_trans
+                if let Some(cached) = vfs_inode::ilookup(self.s_dev, inode.ino as u64) {
+                    let tid = journal.running_tid();
+                    cached.i_sync_tid.store(tid, core::sync::atomic::Ordering::Release);
+                    if datasync {
+                        cached.i_datasync_tid.store(tid, core::sync::atomic::Ordering::Release);
+                    }
+                }
+            }
+            result
+        }
+    }
+
     /// 获取根 inode
     pub fn get_root_inode(&self) -> Result<inode::Ext4Inode, i32> {
         // ext4 中根 inode 的编号总是 2
@@ -209,7 +486,16 @@ impl Ext4FileSystem {
     }
 
     /// 查找目录项
+    ///
+    /// 索引目录按文件名哈希只读一个叶子块 (ext4_dx_find_entry)，
+    /// 未索引或索引无法解析时逐块扫描
     pub fn lookup(&self, dir: &inode::Ext4Inode, name: &str) -> Result<dir::Ext4DirEntry, i32> {
+        if namei::is_dx_dir(self, dir) {
+            match namei::ext4_dx_find_entry(self, dir, name.as_bytes()) {
+                Err(e) if e != errno::Errno::NoSuchFileOrDirectory.as_neg_i32() => {}
+                result => return result,
+            }
+        }
         unsafe {
             // 遍历目录的数据块
             let blocks = dir.get_data_blocks(self)?;
@@ -218,6 +504,10 @@ impl Ext4FileSystem {
             for block in blocks {
                 let bh = bio::bread(self.device, block)
                     .ok_or(errno::Errno::IOError.as_neg_i32())?;
+                if let Err(e) = self.dirblock_verify(dir, bh) {
+                    bio::brelse(bh);
+                    return Err(e);
+                }
 
                 let data = &(*bh).b_data;
                 let mut offset = 0;
@@ -267,6 +557,10 @@ impl Ext4FileSystem {
             for block in blocks {
                 let bh = bio::bread(self.device, block)
                     .ok_or(errno::Errno::IOError.as_neg_i32())?;
+                if let Err(e) = self.dirblock_verify(dir, bh) {
+                    bio::brelse(bh);
+                    return Err(e);
+                }
 
                 let data = &(*bh).b_data;
                 let mut offset = 0;
@@ -298,6 +592,56 @@ impl Ext4FileSystem {
         }
     }
 
+    /// 从目录位置 *pos 起读取目录项 (ext4_readdir)
+    ///
+    /// 位置是目录内的字节偏移（逻辑块号 * 块大小 + 块内偏移），保存在打开的目录中作为游标，
+    /// 每次只读入游标之后的块，不再从头列出整个目录。htree 目录的索引块在线性遍历中
+    /// 是空记录，按普通目录块遍历即可。`.` 和 `..` 不报告。
+    /// 回调参数为目录项和它之后的位置 (d_off)，返回 false（缓冲区已满）时游标停在这一项
+    pub fn readdir(
+        &self,
+        dir: &inode::Ext4Inode,
+        pos: &mut u64,
+        mut actor: impl FnMut(&dir::Ext4DirEntry, u64) -> bool,
+    ) -> Result<(), i32> {
+        let block_size = self.block_size as u64;
+        while *pos < dir.get_size() {
+            let lblk = *pos / block_size;
+            let base = lblk * block_size;
+            let pblk = dir.get_data_block(self, lblk)?;
+            if pblk == 0 {
+                // 目录中的空洞
+                *pos = base + block_size;
+                continue;
+            }
+
+            let bh = bio::bread(self.device, pblk).ok_or(errno::Errno::IOError.as_neg_i32())?;
+            if let Err(e) = self.dirblock_verify(dir, bh) {
+                bio::brelse(bh);
+                return Err(e);
+            }
+            let mut full = false;
+            let result = dir::ext4_readdir_block(
+                unsafe { &(*bh).b_data[..block_size as usize] },
+                (*pos - base) as usize,
+                |entry, next| {
+                    let name = &entry.name[..entry.name_len as usize];
+                    if name == b"." || name == b".." {
+                        return true;
+                    }
+                    full = !actor(entry, base + next as u64);
+                    !full
+                },
+            );
+            bio::brelse(bh);
+            *pos = base + result? as u64;
+            if full {
+                break;
+            }
+        }
+        Ok(())
+    }
+
     /// 根据路径查找 inode
     ///
     /// # 参数
@@ -306,23 +650,69 @@ impl Ext4FileSystem {
     /// # 返回
     /// inode 编号和 inode 结构
     pub fn lookup_path(&self, path: &str) -> Result<(u32, inode::Ext4Inode), i32> {
-        // 解析路径
-        let path_parts: Vec<&str> = path.split('/').filter(|s| !s.is_empty()).collect();
+        // 逐分量查找，每个分量先查 dcache，命中时只需读取 inode
+        let inode = path_walk(self, path, false)?;
+        Ok((inode.ino, inode))
+    }
+}
 
-        // 从根 inode 开始
-        let mut current_inode = self.get_root_inode()?;
-        let mut current_ino = 2u32; // 根 inode 编号
+/// ext4 的逐分量查找
+///
+/// dcache 只记录 inode 编号，命中时从 inode 表重新读取 inode，
+/// 文件大小等随写入变化的字段不会过时；目录项的增删由 namei 使缓存失效
+impl PathWalk for Ext4FileSystem {
+    type Node = inode::Ext4Inode;
 
-        // 遍历路径
-        for part in path_parts.iter() {
-            let entry = self.lookup(&current_inode, part)?;
+    fn s_dev(&self) -> u64 {
+        self.s_dev
+    }
 
-            // 读取下一级 inode
-            current_ino = entry.inode;
-            current_inode = self.read_inode(entry.inode)?;
-        }
+    fn root(&self) -> Result<inode::Ext4Inode, i32> {
+        self.get_root_inode()
+    }
 
-        Ok((current_ino, current_inode))
+    fn ino(&self, node: &inode::Ext4Inode) -> u64 {
+        node.ino as u64
+    }
+
+    fn is_dir(&self, node: &inode::Ext4Inode) -> bool {
+        node.is_dir()
+    }
+
+    fn lookup(&self, dir: &inode::Ext4Inode, name: &str) -> Result<inode::Ext4Inode, i32> {
+        let entry = self.lookup(dir, name)?;
+        self.read_inode(entry.inode)
+    }
+
+    fn d_instantiate(&self, name: &str, node: &inode::Ext4Inode) -> Dentry {
+        Dentry::new_positive(name.as_bytes(), node.ino as u64, None)
+    }
+
+    fn d_node(&self, dentry: &Dentry) -> Option<inode::Ext4Inode> {
+        self.read_inode(dentry.d_ino as u32).ok()
+    }
+}
+
+/// inode 缓存的写回回调 (ext4_write_inode)
+fn ext4_write_inode(vi: &vfs_inode::Inode) -> Result<(), i32> {
+    let ei = match vi.i_fsdata.lock().as_ref().and_then(|d| d.downcast_ref::<inode::Ext4Inode>()) {
+        Some(ei) => ei.clone(),
+        None => return Ok(()),
+    };
+    let fs = match vi.private_data {
+        Some(fs) => unsafe { &*(fs as *const Ext4FileSystem) },
+        None => return Err(errno::Errno::InvalidArgument.as_neg_i32()),
+    };
+    fs.update_inode_disk(&ei)
+}
+
+/// 文件系统实例释放时写回并淘汰它的 inode，缓存中不留指向它的指针，再写回空闲计数；
+/// 有日志时之后提交并检查点全部事务
+impl Drop for Ext4FileSystem {
+    fn drop(&mut self) {
+        vfs_inode::evict_inodes(self.s_dev);
+        let _ = self.commit_super_counts();
+        self.destroy_journal();
     }
 }
 
@@ -468,7 +858,6 @@ static GLOBAL_EXT4_FS: core::sync::atomic::AtomicPtr<Ext4FileSystem> =
 /// - `Err(code)`: 挂载失败
 pub fn mount_ext4(device: *const blkdev::GenDisk) -> Result<(), i32> {
     use crate::console::putchar;
-    use core::sync::atomic::Ordering;
 
     if device.is_null() {
         return Err(-22); // EINVAL
@@ -484,6 +873,8 @@ pub fn mount_ext4(device: *const blkdev::GenDisk) -> Result<(), i32> {
 
     // 初始化文件系统
     fs.init()?;
+    // 加载日志，上次没有正常卸载时重放
+    fs.load_journal()?;
 
     // 保存到全局变量
     let fs_ptr = Box::into_raw(fs);
@@ -508,6 +899,13 @@ pub fn get_ext4_fs() -> Option<*mut Ext4FileSystem> {
     }
 }
 
+/// 替换全局 ext4 实例，返回原来的实例
+///
+/// 回写与直接写只为全局实例所在的设备分配块；测试在内存盘上换入自己的实例，结束后换回
+pub fn replace_ext4_fs(fs: *mut Ext4FileSystem) -> *mut Ext4FileSystem {
+    GLOBAL_EXT4_FS.swap(fs, Ordering::AcqRel)
+}
+
 /// 从已挂载的 ext4 列出目录内容
 ///
 /// # 参数
@@ -517,16 +915,27 @@ pub fn get_ext4_fs() -> Option<*mut Ext4FileSystem> {
 /// - `Some(entries)`: 目录项列表
 /// - `None`: 读取失败或目录不存在
 pub fn list_dir(path: &str) -> Option<Vec<dir::Ext4DirEntry>> {
-    use core::sync::atomic::Ordering;
+    let fs = unsafe { &*get_ext4_fs()? };
+    // 查找目录 inode
+    let (_, dir_inode) = fs.lookup_path(&abs_dir_path(path)).ok()?;
+    // 列出目录内容
+    fs.list_dir(&dir_inode).ok()
+}
 
-    let fs_ptr = GLOBAL_EXT4_FS.load(Ordering::Acquire);
-    if fs_ptr.is_null() {
-        return None;
-    }
+/// 查找目录，返回它的 inode 编号
+///
+/// 路径规则与 list_dir 相同；不是目录时返回 None
+pub fn lookup_dir(path: &str) -> Option<u32> {
+    let fs = unsafe { &*get_ext4_fs()? };
+    let (ino, dir_inode) = fs.lookup_path(&abs_dir_path(path)).ok()?;
+    dir_inode.is_dir().then_some(ino)
+}
 
-    // 处理相对路径：转换为绝对路径
-    // TODO: 支持进程的当前工作目录
-    let abs_path = if path.starts_with('/') {
+/// 把目录路径转换为绝对路径
+///
+/// TODO: 支持进程的当前工作目录
+fn abs_dir_path(path: &str) -> String {
+    if path.starts_with('/') {
         // 已经是绝对路径
         String::from(path)
     } else if path == "." || path.is_empty() {
@@ -550,16 +959,6 @@ pub fn list_dir(path: &str) -> Option<Vec<dir::Ext4DirEntry>> {
         let mut s = String::from("/");
         s.push_str(path);
         s
-    };
-
-    unsafe {
-        let fs = &*fs_ptr;
-
-        // 查找目录 inode
-        let (_, dir_inode) = fs.lookup_path(&abs_path).ok()?;
-
-        // 列出目录内容
-        fs.list_dir(&dir_inode).ok()
     }
 }
 
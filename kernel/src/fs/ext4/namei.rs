@@ -0,0 +1,613 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 索引目录 (htree / dx_dir)
+//!
+//! 参考: fs/ext4/namei.c
+//!
+//! 索引目录的第 0 块是 dx_root：'.' 与 '..' 两个目录项之后是哈希索引，
+//! 每项为 (起始哈希, 逻辑块号)，按哈希排序；indirect_levels 为 1 时中间还有一层 dx_node。
+//! 查找时对文件名计算哈希，逐层二分查找到一个叶子块，只扫描这一块；
+//! 同一哈希的目录项跨块时，下一个索引项的哈希最低位为 1 (冲突标记)，继续查找下一块。
+//!
+//! 插入时叶子块已满则按哈希排序后分成两半 (do_split)，新块的起始哈希插入索引；
+//! 索引块已满时分裂 dx_node 或为 dx_root 加一层 (dx_insert_block / add_level)。
+//! 未索引的单块目录写满时转换为索引目录 (make_indexed_dir)
+
+use alloc::vec;
+use alloc::vec::Vec;
+
+use crate::errno;
+use crate::fs::bio;
+use crate::fs::ext4::dir::{file_type, Ext4DirEntry};
+use crate::fs::ext4::hash::{self, DxHashInfo};
+use crate::fs::ext4::inode::Ext4Inode;
+use crate::fs::ext4::{csum, extent, file, mballoc, Ext4FileSystem};
+
+/// 目录使用哈希索引 (EXT4_INDEX_FL)
+pub const EXT4_INDEX_FL: u32 = 0x1000;
+
+/// 超级块标志：目录哈希按无符号字符计算 (EXT2_FLAGS_UNSIGNED_HASH)
+const EXT2_FLAGS_UNSIGNED_HASH: u32 = 0x2;
+
+/// 索引层数上限：dx_root 之下最多一层 dx_node (ext4_dir_htree_level)
+const DX_MAX_INDIRECT_LEVELS: u8 = 1;
+
+/// dx_root 中 dx_root_info 的偏移（'.' 和 '..' 目录项之后）
+const DX_ROOT_INFO: usize = 24;
+
+/// dx_node 中索引的偏移（一个 inode 为 0、覆盖整块的空目录项之后）
+const DX_NODE_ENTRIES: usize = 8;
+
+/// 目录项占用的长度 (EXT4_DIR_REC_LEN)
+fn dir_rec_len(name_len: usize) -> usize {
+    (8 + name_len + 3) & !3
+}
+
+fn get_u16(data: &[u8], off: usize) -> u16 {
+    u16::from_le_bytes([data[off], data[off + 1]])
+}
+
+fn get_u32(data: &[u8], off: usize) -> u32 {
+    u32::from_le_bytes([data[off], data[off + 1], data[off + 2], data[off + 3]])
+}
+
+fn put_u16(data: &mut [u8], off: usize, val: u16) {
+    data[off..off + 2].copy_from_slice(&val.to_le_bytes());
+}
+
+fn put_u32(data: &mut [u8], off: usize, val: u32) {
+    data[off..off + 4].copy_from_slice(&val.to_le_bytes());
+}
+
+/// 块中的一个目录项
+struct RawDirent {
+    off: usize,
+    inode: u32,
+    rec_len: usize,
+    name_len: usize,
+    file_type: u8,
+}
+
+/// 按 rec_len 依次解析块中的目录项，遇到损坏的记录时停止
+fn dirents(block: &[u8]) -> Vec<RawDirent> {
+    let mut entries = Vec::new();
+    let mut off = 0;
+    while off + 8 <= block.len() {
+        let rec_len = get_u16(block, off + 4) as usize;
+        let name_len = block[off + 6] as usize;
+        if rec_len < 8 || off + rec_len > block.len() || 8 + name_len > rec_len {
+            break;
+        }
+        entries.push(RawDirent {
+            off,
+            inode: get_u32(block, off),
+            rec_len,
+            name_len,
+            file_type: block[off + 7],
+        });
+        off += rec_len;
+    }
+    entries
+}
+
+fn write_dirent(block: &mut [u8], off: usize, ino: u32, rec_len: usize, name: &[u8], ftype: u8) {
+    put_u32(block, off, ino);
+    put_u16(block, off + 4, rec_len as u16);
+    block[off + 6] = name.len() as u8;
+    block[off + 7] = ftype;
+    block[off + 8..off + 8 + name.len()].copy_from_slice(name);
+}
+
+/// 在块中查找文件名 (search_dirblock)
+fn search_dirblock(block: &[u8], name: &[u8]) -> Option<Ext4DirEntry> {
+    dirents(block)
+        .into_iter()
+        .find(|d| d.inode != 0 && &block[d.off + 8..d.off + 8 + d.name_len] == name)
+        .map(|d| unsafe { Ext4DirEntry::from_bytes(&block[d.off..], block.len()) })
+}
+
+/// 在块中找空位写入新目录项 (add_dirent_to_buf)
+fn add_dirent_to_buf(block: &mut [u8], name: &[u8], ino: u32, ftype: u8) -> bool {
+    let need = dir_rec_len(name.len());
+    for d in dirents(block) {
+        let used = if d.inode == 0 { 0 } else { dir_rec_len(d.name_len) };
+        if d.rec_len - used < need {
+            continue;
+        }
+        if used == 0 {
+            write_dirent(block, d.off, ino, d.rec_len, name, ftype);
+        } else {
+            put_u16(block, d.off + 4, used as u16);
+            write_dirent(block, d.off + used, ino, d.rec_len - used, name, ftype);
+        }
+        return true;
+    }
+    false
+}
+
+/// 把目录项依次紧凑地写入一个块，最后一项延伸到块尾
+fn pack_dirents(entries: &[(u32, Vec<u8>, u8)], block_size: usize) -> Vec<u8> {
+    let mut block = vec![0u8; block_size];
+    if entries.is_empty() {
+        put_u16(&mut block, 4, block_size as u16);
+        return block;
+    }
+    let mut off = 0;
+    for (i, (ino, name, ftype)) in entries.iter().enumerate() {
+        let len = if i + 1 == entries.len() { block_size - off } else { dir_rec_len(name.len()) };
+        write_dirent(&mut block, off, *ino, len, name, *ftype);
+        off += len;
+    }
+    block
+}
+
+/// 读目录的第 lblk 块 (ext4_read_dirblock)
+///
+/// 启用元数据校验和时先校验；叶子块去掉末尾的校验和目录项，只返回 dir_leaf_size 字节，
+/// 索引块返回整块
+fn dir_bread(fs: &Ext4FileSystem, dir: &Ext4Inode, lblk: u64) -> Result<Vec<u8>, i32> {
+    let pblk = dir.get_data_block(fs, lblk)?;
+    if pblk == 0 {
+        return Err(errno::Errno::IOError.as_neg_i32());
+    }
+    unsafe {
+        let bh = bio::bread(fs.device, pblk).ok_or(errno::Errno::IOError.as_neg_i32())?;
+        if let Err(e) = fs.dirblock_verify(dir, bh) {
+            bio::brelse(bh);
+            return Err(e);
+        }
+        let block = &(*bh).b_data[..fs.block_size as usize];
+        let len = if fs.has_metadata_csum() && csum::has_dirent_tail(block) { fs.dir_leaf_size() } else { block.len() };
+        let data = block[..len].to_vec();
+        bio::brelse(bh);
+        Ok(data)
+    }
+}
+
+/// 同步写回目录的第 lblk 块
+///
+/// 不足一块的 data 是叶子块的目录项部分，启用元数据校验和时在后面补上校验和目录项；
+/// 整块的 data 是索引块，更新 dx_tail
+fn dir_bwrite(fs: &Ext4FileSystem, dir: &Ext4Inode, lblk: u64, data: &[u8]) -> Result<(), i32> {
+    let pblk = dir.get_data_block(fs, lblk)?;
+    if pblk == 0 {
+        return Err(errno::Errno::IOError.as_neg_i32());
+    }
+    unsafe {
+        let bh = bio::bread(fs.device, pblk).ok_or(errno::Errno::IOError.as_neg_i32())?;
+        let block = &mut (*bh).b_data[..fs.block_size as usize];
+        block[..data.len()].copy_from_slice(data);
+        if fs.has_metadata_csum() {
+            let seed = fs.inode_csum_seed(dir.ino, dir.generation);
+            if data.len() < block.len() {
+                fs.dirblock_csum_set(seed, block);
+            } else if let Some(count_off) = csum::dx_countlimit_offset(block) {
+                fs.dx_csum_set(seed, block, count_off);
+            }
+            csum::set_buffer_verified(bh);
+        }
+        let result = fs.handle_dirty_metadata(bh);
+        bio::brelse(bh);
+        result
+    }
+}
+
+/// 在目录末尾加一个块 (ext4_append)
+///
+/// # 返回
+/// 新块的逻辑块号；dir 的大小、i_blocks 与块映射已更新，由调用者写回 inode
+fn ext4_append(fs: &Ext4FileSystem, dir: &mut Ext4Inode) -> Result<u64, i32> {
+    let block_size = fs.block_size as u64;
+    let lblk = dir.get_size() / block_size;
+    let goal = if lblk > 0 { dir.get_data_block(fs, lblk - 1)? + 1 } else { 0 };
+    let (pblk, _) = mballoc::ext4_mb_new_blocks(fs, dir.ino, lblk, goal, 1)?;
+
+    let mapped = if dir.has_extent() {
+        extent::ext4_ext_insert_extent(fs, dir, lblk, pblk, 1)
+    } else if lblk < 12 {
+        dir.block[lblk as usize] = pblk as u32;
+        Ok(())
+    } else {
+        let allocator = crate::fs::ext4::allocator::BlockAllocator::new(fs);
+        file::allocate_indirect_block(fs, dir, lblk, pblk, &allocator)
+    };
+    if let Err(e) = mapped {
+        let _ = mballoc::ext4_mb_free_blocks(fs, pblk, 1);
+        return Err(e);
+    }
+    dir.blocks += block_size / 512;
+    dir.set_size((lblk + 1) * block_size);
+    Ok(lblk)
+}
+
+/// 目录是否使用哈希索引 (is_dx)
+pub fn is_dx_dir(fs: &Ext4FileSystem, dir: &Ext4Inode) -> bool {
+    fs.has_dir_index() && dir.flags & EXT4_INDEX_FL != 0
+}
+
+/// 查找路径上的一层索引 (struct dx_frame)
+struct DxFrame {
+    /// 索引块的逻辑块号
+    lblk: u64,
+    /// 块内容
+    data: Vec<u8>,
+    /// dx_countlimit 在块内的偏移，第 i 项在 base + 8·i
+    base: usize,
+    /// 选中的索引项
+    at: usize,
+}
+
+impl DxFrame {
+    fn limit(&self) -> usize {
+        get_u16(&self.data, self.base) as usize
+    }
+
+    fn count(&self) -> usize {
+        get_u16(&self.data, self.base + 2) as usize
+    }
+
+    fn set_count(&mut self, count: usize) {
+        put_u16(&mut self.data, self.base + 2, count as u16);
+    }
+
+    /// 第 i 项的起始哈希，第 0 项的哈希位置存放 count/limit，视为 0
+    fn hash(&self, i: usize) -> u32 {
+        if i == 0 { 0 } else { get_u32(&self.data, self.base + 8 * i) }
+    }
+
+    fn block(&self, i: usize) -> u64 {
+        (get_u32(&self.data, self.base + 8 * i + 4) & 0x0fff_ffff) as u64
+    }
+
+    fn set_entry(&mut self, i: usize, hash: u32, block: u64) {
+        if i != 0 {
+            put_u32(&mut self.data, self.base + 8 * i, hash);
+        }
+        put_u32(&mut self.data, self.base + 8 * i + 4, block as u32);
+    }
+
+    /// 最后一个起始哈希不大于 hash 的索引项
+    fn search(&self, hash: u32) -> usize {
+        let (mut lo, mut hi) = (1, self.count());
+        while lo < hi {
+            let mid = (lo + hi) / 2;
+            if self.hash(mid) > hash {
+                hi = mid;
+            } else {
+                lo = mid + 1;
+            }
+        }
+        lo - 1
+    }
+
+    /// 在第 at 项之后插入索引项 (dx_insert_block)
+    fn insert_after(&mut self, at: usize, hash: u32, block: u64) {
+        let count = self.count();
+        let start = self.base + 8 * (at + 1);
+        let end = self.base + 8 * count;
+        self.data.copy_within(start..end, start + 8);
+        self.set_count(count + 1);
+        self.set_entry(at + 1, hash, block);
+    }
+}
+
+/// dx_root 的 indirect_levels
+fn dx_indirect_levels(root: &[u8]) -> u8 {
+    root[DX_ROOT_INFO + 6]
+}
+
+/// dx_root 指定的哈希算法，按超级块标志选择有符号或无符号版本
+fn dx_hash_info(fs: &Ext4FileSystem, root: &[u8]) -> DxHashInfo {
+    let mut hash_version = root[DX_ROOT_INFO + 4];
+    if hash_version <= hash::DX_HASH_TEA && fs.s_flags & EXT2_FLAGS_UNSIGNED_HASH != 0 {
+        hash_version += 3;
+    }
+    DxHashInfo { hash_version, seed: fs.hash_seed }
+}
+
+/// 计算文件名哈希，索引格式不认识时返回 EIO 让调用者退回线性查找
+fn dx_hash(fs: &Ext4FileSystem, dir: &Ext4Inode, name: &[u8]) -> Result<u32, i32> {
+    let root = dir_bread(fs, dir, 0)?;
+    hash::ext4fs_dirhash(name, &dx_hash_info(fs, &root))
+        .map(|(hash, _)| hash)
+        .ok_or(errno::Errno::IOError.as_neg_i32())
+}
+
+/// 从 dx_root 逐层找到 hash 所在的叶子 (dx_probe)
+fn dx_probe(fs: &Ext4FileSystem, dir: &Ext4Inode, hash: u32) -> Result<Vec<DxFrame>, i32> {
+    let data = dir_bread(fs, dir, 0)?;
+    let info_length = data[DX_ROOT_INFO + 5] as usize;
+    let levels = dx_indirect_levels(&data);
+    if get_u32(&data, DX_ROOT_INFO) != 0 || levels > DX_MAX_INDIRECT_LEVELS || info_length < 8 {
+        return Err(errno::Errno::IOError.as_neg_i32());
+    }
+
+    let mut frames: Vec<DxFrame> = Vec::new();
+    let mut frame = DxFrame { lblk: 0, data, base: DX_ROOT_INFO + info_length, at: 0 };
+    loop {
+        let count = frame.count();
+        if count == 0 || count > frame.limit() || frame.base + 8 * frame.limit() > frame.data.len() {
+            return Err(errno::Errno::IOError.as_neg_i32());
+        }
+        frame.at = frame.search(hash);
+        let child = frame.block(frame.at);
+        frames.push(frame);
+        if frames.len() > levels as usize {
+            return Ok(frames);
+        }
+        frame = DxFrame { lblk: child, data: dir_bread(fs, dir, child)?, base: DX_NODE_ENTRIES, at: 0 };
+    }
+}
+
+/// 当前叶子之后的叶子仍以同一哈希开始时返回它 (ext4_htree_next_block)
+fn dx_next_leaf(fs: &Ext4FileSystem, dir: &Ext4Inode, frames: &mut [DxFrame], hash: u32) -> Result<Option<u64>, i32> {
+    let mut level = frames.len();
+    loop {
+        if level == 0 {
+            return Ok(None);
+        }
+        level -= 1;
+        if frames[level].at + 1 < frames[level].count() {
+            break;
+        }
+    }
+    frames[level].at += 1;
+    if frames[level].hash(frames[level].at) & !1 != hash {
+        return Ok(None);
+    }
+    for l in level + 1..frames.len() {
+        let child = frames[l - 1].block(frames[l - 1].at);
+        frames[l] = DxFrame { lblk: child, data: dir_bread(fs, dir, child)?, base: DX_NODE_ENTRIES, at: 0 };
+    }
+    let last = frames.last().unwrap();
+    Ok(Some(last.block(last.at)))
+}
+
+/// 在索引目录中查找文件名 (ext4_dx_find_entry)
+///
+/// # 返回
+/// 不存在时返回 ENOENT；索引无法解析时返回其他错误，调用者退回线性查找
+pub fn ext4_dx_find_entry(fs: &Ext4FileSystem, dir: &Ext4Inode, name: &[u8]) -> Result<Ext4DirEntry, i32> {
+    let hash = dx_hash(fs, dir, name)?;
+    let mut frames = dx_probe(fs, dir, hash)?;
+    let last = frames.last().unwrap();
+    let mut leaf = last.block(last.at);
+    loop {
+        let block = dir_bread(fs, dir, leaf)?;
+        if let Some(entry) = search_dirblock(&block, name) {
+            return Ok(entry);
+        }
+        match dx_next_leaf(fs, dir, &mut frames, hash)? {
+            Some(next) => leaf = next,
+            None => return Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
+        }
+    }
+}
+
+/// 为最底层的索引块腾出一项 (ext4_dx_add_entry 中的索引分裂)
+///
+/// 只有 dx_root 时加一层 dx_node；已有 dx_node 时把它的后一半移到新块。完成后调用者重新查找
+fn dx_make_room(fs: &Ext4FileSystem, dir: &mut Ext4Inode, frames: &mut [DxFrame]) -> Result<(), i32> {
+    let block_size = fs.block_size as usize;
+    let node_limit = fs.dx_limit(DX_NODE_ENTRIES);
+
+    if frames.len() == 1 {
+        // add_level：dx_root 的索引整体移到新的 dx_node
+        let node_lblk = ext4_append(fs, dir)?;
+        let root = &mut frames[0];
+        let count = root.count();
+        let mut node = vec![0u8; block_size];
+        put_u16(&mut node, 4, block_size as u16);
+        node[DX_NODE_ENTRIES..DX_NODE_ENTRIES + 8 * count]
+            .copy_from_slice(&root.data[root.base..root.base + 8 * count]);
+        put_u16(&mut node, DX_NODE_ENTRIES, node_limit as u16);
+        put_u16(&mut node, DX_NODE_ENTRIES + 2, count as u16);
+        dir_bwrite(fs, dir, node_lblk, &node)?;
+
+        root.set_count(1);
+        root.set_entry(0, 0, node_lblk);
+        root.data[DX_ROOT_INFO + 6] = 1;
+        return dir_bwrite(fs, dir, 0, &root.data);
+    }
+
+    if frames[0].count() >= frames[0].limit() {
+        // dx_root 和 dx_node 都已满
+        return Err(errno::Errno::NoSpaceLeftOnDevice.as_neg_i32());
+    }
+    let node_lblk = ext4_append(fs, dir)?;
+    let (root, rest) = frames.split_at_mut(1);
+    let (root, node) = (&mut root[0], &mut rest[0]);
+    let count = node.count();
+    let half = count / 2;
+    let split_hash = node.hash(half);
+
+    let mut sibling = vec![0u8; block_size];
+    put_u16(&mut sibling, 4, block_size as u16);
+    let moved = &node.data[node.base + 8 * half..node.base + 8 * count];
+    sibling[DX_NODE_ENTRIES..DX_NODE_ENTRIES + moved.len()].copy_from_slice(moved);
+    put_u16(&mut sibling, DX_NODE_ENTRIES, node_limit as u16);
+    put_u16(&mut sibling, DX_NODE_ENTRIES + 2, (count - half) as u16);
+    dir_bwrite(fs, dir, node_lblk, &sibling)?;
+
+    node.set_count(half);
+    dir_bwrite(fs, dir, node.lblk, &node.data)?;
+    let at = root.at;
+    root.insert_after(at, split_hash, node_lblk);
+    dir_bwrite(fs, dir, 0, &root.data)
+}
+
+/// 把满的叶子按哈希分成两半，后一半移到新块 (do_split)
+fn do_split(
+    fs: &Ext4FileSystem,
+    dir: &mut Ext4Inode,
+    frames: &mut [DxFrame],
+    leaf_lblk: u64,
+    leaf: &[u8],
+    info: &DxHashInfo,
+) -> Result<(), i32> {
+    let mut entries: Vec<(u32, u32, Vec<u8>, u8)> = dirents(leaf)
+        .into_iter()
+        .filter(|d| d.inode != 0)
+        .map(|d| {
+            let name = leaf[d.off + 8..d.off + 8 + d.name_len].to_vec();
+            let hash = hash::ext4fs_dirhash(&name, info).map_or(0, |(h, _)| h);
+            (hash, d.inode, name, d.file_type)
+        })
+        .collect();
+    entries.sort_by_key(|e| e.0);
+    if entries.len() < 2 {
+        return Err(errno::Errno::NoSpaceLeftOnDevice.as_neg_i32());
+    }
+
+    // 同一哈希跨两块时新块的起始哈希带冲突标记
+    let split = entries.len() / 2;
+    let mut split_hash = entries[split].0;
+    if entries[split - 1].0 == split_hash {
+        split_hash |= 1;
+    }
+
+    let new_lblk = ext4_append(fs, dir)?;
+    let block_size = fs.dir_leaf_size();
+    let to_packed = |part: &[(u32, u32, Vec<u8>, u8)]| {
+        let list: Vec<(u32, Vec<u8>, u8)> = part.iter().map(|e| (e.1, e.2.clone(), e.3)).collect();
+        pack_dirents(&list, block_size)
+    };
+    dir_bwrite(fs, dir, new_lblk, &to_packed(&entries[split..]))?;
+    dir_bwrite(fs, dir, leaf_lblk, &to_packed(&entries[..split]))?;
+
+    let frame = frames.last_mut().unwrap();
+    let at = frame.at;
+    frame.insert_after(at, split_hash, new_lblk);
+    dir_bwrite(fs, dir, frame.lblk, &frame.data)
+}
+
+/// 向索引目录插入目录项 (ext4_dx_add_entry)
+fn dx_add_entry(fs: &Ext4FileSystem, dir: &mut Ext4Inode, name: &[u8], ino: u32, ftype: u8) -> Result<(), i32> {
+    let root = dir_bread(fs, dir, 0)?;
+    let info = dx_hash_info(fs, &root);
+    let hash = hash::ext4fs_dirhash(name, &info)
+        .map(|(hash, _)| hash)
+        .ok_or(errno::Errno::IOError.as_neg_i32())?;
+
+    loop {
+        let mut frames = dx_probe(fs, dir, hash)?;
+        let last = frames.last().unwrap();
+        let leaf_lblk = last.block(last.at);
+        let mut leaf = dir_bread(fs, dir, leaf_lblk)?;
+        if add_dirent_to_buf(&mut leaf, name, ino, ftype) {
+            return dir_bwrite(fs, dir, leaf_lblk, &leaf);
+        }
+
+        // 叶子已满：索引块有空位时分裂叶子，否则先分裂索引，之后重新查找
+        let last = frames.last().unwrap();
+        if last.count() >= last.limit() {
+            dx_make_room(fs, dir, &mut frames)?;
+        } else {
+            do_split(fs, dir, &mut frames, leaf_lblk, &leaf, &info)?;
+        }
+    }
+}
+
+/// 写满的单块目录转换为索引目录 (make_indexed_dir)
+///
+/// '.' 和 '..' 之后的目录项移到新的第 1 块，第 0 块改写为 dx_root
+fn make_indexed_dir(fs: &Ext4FileSystem, dir: &mut Ext4Inode) -> Result<(), i32> {
+    let block_size = fs.block_size as usize;
+    let block0 = dir_bread(fs, dir, 0)?;
+    let list = dirents(&block0);
+    if list.len() < 2 || list[0].name_len != 1 || list[1].name_len != 2 {
+        return Err(errno::Errno::IOError.as_neg_i32());
+    }
+    let parent = list[1].inode;
+    let moved: Vec<(u32, Vec<u8>, u8)> = list[2..]
+        .iter()
+        .filter(|d| d.inode != 0)
+        .map(|d| (d.inode, block0[d.off + 8..d.off + 8 + d.name_len].to_vec(), d.file_type))
+        .collect();
+
+    let lblk = ext4_append(fs, dir)?;
+    dir_bwrite(fs, dir, lblk, &pack_dirents(&moved, fs.dir_leaf_size()))?;
+
+    let mut root = vec![0u8; block_size];
+    write_dirent(&mut root, 0, dir.ino, 12, b".", file_type::EXT4_FT_DIR);
+    write_dirent(&mut root, 12, parent, block_size - 12, b"..", file_type::EXT4_FT_DIR);
+    root[DX_ROOT_INFO + 4] = fs.def_hash_version;
+    root[DX_ROOT_INFO + 5] = 8;
+    let base = DX_ROOT_INFO + 8;
+    put_u16(&mut root, base, fs.dx_limit(base) as u16);
+    put_u16(&mut root, base + 2, 1);
+    put_u32(&mut root, base + 4, lblk as u32);
+    dir_bwrite(fs, dir, 0, &root)?;
+
+    dir.flags |= EXT4_INDEX_FL;
+    Ok(())
+}
+
+/// 向未索引的目录插入目录项：逐块找空位，都满时加一个块
+fn linear_add_entry(fs: &Ext4FileSystem, dir: &mut Ext4Inode, name: &[u8], ino: u32, ftype: u8) -> Result<(), i32> {
+    let block_size = fs.block_size as u64;
+    let nr_blocks = dir.get_size() / block_size;
+    for lblk in 0..nr_blocks {
+        let mut block = dir_bread(fs, dir, lblk)?;
+        if add_dirent_to_buf(&mut block, name, ino, ftype) {
+            return dir_bwrite(fs, dir, lblk, &block);
+        }
+    }
+
+    // 单块目录写满后改用索引 (ext4_add_entry 中的 make_indexed_dir)
+    if nr_blocks == 1 && fs.has_dir_index() && make_indexed_dir(fs, dir).is_ok() {
+        return dx_add_entry(fs, dir, name, ino, ftype);
+    }
+
+    let lblk = ext4_append(fs, dir)?;
+    let block = pack_dirents(&[(ino, name.to_vec(), ftype)], fs.dir_leaf_size());
+    dir_bwrite(fs, dir, lblk, &block)
+}
+
+/// 向目录插入目录项 (ext4_add_entry)
+///
+/// 目录的块由调用者持有的 dir 描述，插入后写回块位图与 dir 的 inode
+///
+/// # 参数
+/// - `ftype`: 目录项的文件类型 (EXT4_FT_*)
+pub fn ext4_add_entry(
+    fs: &Ext4FileSystem,
+    dir: &mut Ext4Inode,
+    name: &str,
+    ino: u32,
+    ftype: u8,
+) -> Result<(), i32> {
+    if name.is_empty() || name.len() > 255 {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    if !dir.is_dir() {
+        return Err(errno::Errno::NotADirectory.as_neg_i32());
+    }
+    if fs.lookup(dir, name).is_ok() {
+        return Err(errno::Errno::FileExists.as_neg_i32());
+    }
+    let name = name.as_bytes();
+
+    let result = if is_dx_dir(fs, dir) {
+        match dx_add_entry(fs, dir, name, ino, ftype) {
+            // 索引无法解析时按普通目录处理 (dx_fallback)
+            Err(e) if e == errno::Errno::IOError.as_neg_i32() => {
+                dir.flags &= !EXT4_INDEX_FL;
+                linear_add_entry(fs, dir, name, ino, ftype)
+            }
+            result => result,
+        }
+    } else {
+        linear_add_entry(fs, dir, name, ino, ftype)
+    };
+
+    // 丢弃这个名字的负目录项
+    crate::fs::namei::d_invalidate(fs.s_dev, dir.ino as u64, name);
+
+    mballoc::ext4_mb_flush(fs)?;
+    fs.write_inode(dir)?;
+    result
+}
@@ -14,9 +14,15 @@
 use crate::errno;
 use crate::fs::inode::Inode;
 use crate::fs::dentry::Dentry;
+use crate::mm::filemap::FileRaState;
+use crate::sync::rcu::{rcu_read_lock, synchronize_rcu};
+use alloc::boxed::Box;
 use alloc::sync::Arc;
+use alloc::vec::Vec;
 use spin::Mutex;
 use core::cell::UnsafeCell;
+use core::ptr::{self, NonNull};
+use core::sync::atomic::{AtomicPtr, AtomicUsize, Ordering};
 
 #[repr(C)]
 #[derive(Debug, Copy, Clone, PartialEq)]
@@ -79,6 +85,41 @@ pub struct FileOps {
     pub lseek: Option<fn(&File, isize, i32) -> isize>,
     /// 关闭文件
     pub close: Option<fn(&File) -> i32>,
+    /// 从指定位置依次读入多个缓冲区，不改变文件位置 (read_iter)
+    ///
+    /// 一次调用服务全部分段；没有时 readv 逐段调用 read，pread/preadv 返回 ESPIPE
+    pub read_iter: Option<fn(&File, &mut [&mut [u8]], u64) -> isize>,
+    /// 把多个缓冲区依次写到指定位置，不改变文件位置 (write_iter)
+    pub write_iter: Option<fn(&File, &[&[u8]], u64) -> isize>,
+    /// 返回就绪事件，pt 非空时登记就绪变化时唤醒的等待队列 (poll)
+    ///
+    /// 没有时文件总是可读可写 (DEFAULT_POLLMASK)
+    pub poll: Option<fn(&File, Option<&mut crate::fs::select::PollTable>) -> u32>,
+}
+
+/// readv / writev 最多的分段数 (UIO_MAXIOV)
+pub const UIO_MAXIOV: usize = 1024;
+
+/// poll 事件位 (include/uapi/asm-generic/poll.h)
+pub mod poll_mask {
+    /// 可读
+    pub const POLLIN: u32 = 0x0001;
+    /// 紧急数据可读
+    pub const POLLPRI: u32 = 0x0002;
+    /// 可写
+    pub const POLLOUT: u32 = 0x0004;
+    /// 出错（管道读端已关闭）
+    pub const POLLERR: u32 = 0x0008;
+    /// 挂断（管道写端已关闭）
+    pub const POLLHUP: u32 = 0x0010;
+    /// 普通数据可读
+    pub const POLLRDNORM: u32 = 0x0040;
+    /// 优先带数据可读
+    pub const POLLRDBAND: u32 = 0x0080;
+    /// 普通数据可写
+    pub const POLLWRNORM: u32 = 0x0100;
+    /// 优先带数据可写
+    pub const POLLWRBAND: u32 = 0x0200;
 }
 
 #[repr(C)]
@@ -97,6 +138,10 @@ pub struct File {
     pub private_data: UnsafeCell<Option<*mut u8>>,
     /// close-on-exec 标志（FD_CLOEXEC）
     pub cloexec: Mutex<bool>,
+    /// 预读状态 (f_ra)
+    pub ra: Mutex<FileRaState>,
+    /// 监视该文件的 epoll 实例 (f_ep)，最后一个引用释放时逐一摘除
+    pub f_ep: Mutex<alloc::vec::Vec<crate::fs::eventpoll::EpLink>>,
 }
 
 unsafe impl Sync for File {}
@@ -112,6 +157,8 @@ impl File {
             ops: UnsafeCell::new(None),
             private_data: UnsafeCell::new(None),
             cloexec: Mutex::new(false),  // 默认不设置 close-on-exec
+            ra: Mutex::new(FileRaState::new()),
+            f_ep: Mutex::new(alloc::vec::Vec::new()),
         }
     }
 
@@ -167,6 +214,108 @@ impl File {
         -9  // EBADF
     }
 
+    /// 读入多个缓冲区 (vfs_readv / vfs_iter_read)
+    ///
+    /// pos 为 Some 时从该位置读取且不改变文件位置 (preadv)，
+    /// 否则从文件位置读取并前进，期间持有文件位置锁 (f_pos_lock)
+    ///
+    /// # 返回
+    /// 读取的总字节数或负错误码
+    pub fn read_vec(&self, iov: &mut [&mut [u8]], pos: Option<u64>) -> isize {
+        let ops = match unsafe { *self.ops.get() } {
+            Some(ops) => ops,
+            None => return -9,  // EBADF
+        };
+        match (ops.read_iter, pos) {
+            (Some(read_iter), Some(pos)) => read_iter(self, iov, pos),
+            (Some(read_iter), None) => {
+                let mut f_pos = self.pos.lock();
+                let ret = read_iter(self, iov, *f_pos);
+                if ret > 0 {
+                    *f_pos += ret as u64;
+                }
+                ret
+            }
+            // 不可定位的文件 (FMODE_PREAD)
+            (None, Some(_)) => -29,  // ESPIPE
+            (None, None) => {
+                let read_fn = match ops.read {
+                    Some(read_fn) => read_fn,
+                    None => return -9,  // EBADF
+                };
+                // 逐段读取，某段读不满就停止 (do_loop_readv_writev)
+                let mut total = 0isize;
+                for buf in iov.iter_mut() {
+                    if buf.is_empty() {
+                        continue;
+                    }
+                    let ret = read_fn(self, buf);
+                    if ret < 0 {
+                        return if total > 0 { total } else { ret };
+                    }
+                    total += ret;
+                    if (ret as usize) < buf.len() {
+                        break;
+                    }
+                }
+                total
+            }
+        }
+    }
+
+    /// 写出多个缓冲区 (vfs_writev / vfs_iter_write)
+    ///
+    /// pos 的含义与 read_vec 相同
+    ///
+    /// # 返回
+    /// 写入的总字节数或负错误码
+    pub fn write_vec(&self, iov: &[&[u8]], pos: Option<u64>) -> isize {
+        let ops = match unsafe { *self.ops.get() } {
+            Some(ops) => ops,
+            None => return -9,  // EBADF
+        };
+        match (ops.write_iter, pos) {
+            (Some(write_iter), Some(pos)) => write_iter(self, iov, pos),
+            (Some(write_iter), None) => {
+                let mut f_pos = self.pos.lock();
+                let ret = write_iter(self, iov, *f_pos);
+                if ret > 0 {
+                    *f_pos += ret as u64;
+                }
+                ret
+            }
+            (None, Some(_)) => -29,  // ESPIPE
+            (None, None) => {
+                let write_fn = match ops.write {
+                    Some(write_fn) => write_fn,
+                    None => return -9,  // EBADF
+                };
+                let mut total = 0isize;
+                for buf in iov.iter() {
+                    if buf.is_empty() {
+                        continue;
+                    }
+                    let ret = write_fn(self, buf);
+                    if ret < 0 {
+                        return if total > 0 { total } else { ret };
+                    }
+                    total += ret;
+                    if (ret as usize) < buf.len() {
+                        break;
+                    }
+                }
+                total
+            }
+        }
+    }
+
+    /// 当前就绪的事件 (vfs_poll)
+    ///
+    /// 由文件的 poll 方法报告；没有 poll 方法的文件总是可读可写
+    pub fn poll(&self) -> u32 {
+        crate::fs::select::vfs_poll(self, None)
+    }
+
     /// 定位文件位置
     pub unsafe fn lseek(&self, offset: isize, whence: i32) -> isize {
         if let Some(ops) = *self.ops.get() {
@@ -198,126 +347,343 @@ impl File {
     }
 }
 
-pub struct FdTable {
-    /// 文件描述符数组 (每个进程最多 1024 个打开文件)
-    /// 使用 Vec 避免在栈上创建大数组
-    fds: UnsafeCell<alloc::vec::Vec<Option<Arc<File>>>>,
-    /// 下一个可用的文件描述符
-    next_fd: Mutex<usize>,
-    /// 文件描述符数量
-    count: Mutex<usize>,
+/// 新建描述符表的数组大小 (NR_OPEN_DEFAULT)
+const NR_OPEN_DEFAULT: usize = 64;
+
+/// 每个进程最多打开的文件数
+pub const NR_OPEN_MAX: usize = 1024;
+
+const BITS_PER_WORD: usize = u64::BITS as usize;
+
+/// 在位图的 [start, size) 中查找第一个 0 位 (find_next_zero_bit)
+pub(crate) fn find_next_zero_bit(bits: &[u64], size: usize, start: usize) -> Option<usize> {
+    let mut i = start;
+    while i < size {
+        // 起始字中 i 之前的位视为 1
+        let word = bits[i / BITS_PER_WORD] | ((1u64 << (i % BITS_PER_WORD)) - 1);
+        if word != !0 {
+            let bit = i / BITS_PER_WORD * BITS_PER_WORD + (!word).trailing_zeros() as usize;
+            return if bit < size { Some(bit) } else { None };
+        }
+        i = (i / BITS_PER_WORD + 1) * BITS_PER_WORD;
+    }
+    None
 }
 
-unsafe impl Sync for FdTable {}
+/// 描述符数组 (struct fdtable)
+///
+/// 每项是 Arc::into_raw 得到的指针，空指针表示未安装。扩展时整体替换，
+/// 旧数组在宽限期后释放，读者在 RCU 读临界区内无锁访问
+struct FdArray {
+    fd: Box<[AtomicPtr<File>]>,
+}
 
-impl FdTable {
-    /// 创建新的文件描述符表
-    pub fn new() -> Self {
-        // 使用 Vec 在堆上直接分配，避免栈溢出
-        let mut fds: alloc::vec::Vec<Option<Arc<File>>> = alloc::vec::Vec::with_capacity(1024);
-        for _ in 0..1024 {
-            fds.push(None);
+impl FdArray {
+    fn new(max_fds: usize) -> Box<Self> {
+        Box::new(Self { fd: (0..max_fds).map(|_| AtomicPtr::new(ptr::null_mut())).collect() })
+    }
+}
+
+/// 描述符分配位图，由 FdTable::file_lock 保护
+struct FdBitmap {
+    /// 已分配的描述符 (open_fds)
+    open_fds: Vec<u64>,
+    /// open_fds 中已满的字，分配时整字跳过 (full_fds_bits)
+    full_fds_bits: Vec<u64>,
+    /// 小于它的描述符都已分配 (next_fd)
+    next_fd: usize,
+}
+
+impl FdBitmap {
+    fn new(max_fds: usize) -> Self {
+        let mut bitmap = Self { open_fds: Vec::new(), full_fds_bits: Vec::new(), next_fd: 0 };
+        bitmap.grow(max_fds);
+        bitmap
+    }
+
+    fn max_fds(&self) -> usize {
+        self.open_fds.len() * BITS_PER_WORD
+    }
+
+    fn grow(&mut self, max_fds: usize) {
+        let words = max_fds / BITS_PER_WORD;
+        self.open_fds.resize(words, 0);
+        self.full_fds_bits.resize(words.div_ceil(BITS_PER_WORD), 0);
+    }
+
+    fn is_set(&self, fd: usize) -> bool {
+        fd < self.max_fds() && self.open_fds[fd / BITS_PER_WORD] & (1 << (fd % BITS_PER_WORD)) != 0
+    }
+
+    /// 标记描述符已分配 (__set_open_fd)
+    fn set(&mut self, fd: usize) {
+        let word = fd / BITS_PER_WORD;
+        self.open_fds[word] |= 1 << (fd % BITS_PER_WORD);
+        if self.open_fds[word] == !0 {
+            self.full_fds_bits[word / BITS_PER_WORD] |= 1 << (word % BITS_PER_WORD);
         }
+    }
 
-        Self {
-            fds: UnsafeCell::new(fds),
-            next_fd: Mutex::new(0),
-            count: Mutex::new(0),
+    /// 标记描述符空闲 (__clear_open_fd)
+    fn clear(&mut self, fd: usize) {
+        let word = fd / BITS_PER_WORD;
+        self.open_fds[word] &= !(1 << (fd % BITS_PER_WORD));
+        self.full_fds_bits[word / BITS_PER_WORD] &= !(1 << (word % BITS_PER_WORD));
+        if fd < self.next_fd {
+            self.next_fd = fd;
         }
     }
 
-    /// 分配文件描述符
-    pub fn alloc_fd(&self) -> Option<usize> {
-        let mut next = self.next_fd.lock();
-        let fds = unsafe { &mut *self.fds.get() };
-
-        // 从 next_fd 开始搜索可用的文件描述符
-        for i in 0..1024 {
-            let fd = (*next + i) % 1024;
-            if fds[fd].is_none() {
-                *next = (fd + 1) % 1024;
-                *self.count.lock() += 1;
+    /// 查找不小于 start 的最小空闲描述符 (find_next_fd)
+    fn find_next_fd(&self, start: usize) -> Option<usize> {
+        let words = self.open_fds.len();
+        let mut word = start / BITS_PER_WORD;
+        loop {
+            // 先在 full_fds_bits 中找第一个未满的字，再在字内找空闲位
+            word = find_next_zero_bit(&self.full_fds_bits, words, word)?;
+            let from = start.max(word * BITS_PER_WORD);
+            if let Some(fd) = find_next_zero_bit(&self.open_fds, (word + 1) * BITS_PER_WORD, from) {
                 return Some(fd);
             }
+            // 起始字只有 start 之前的位空闲
+            word += 1;
         }
+    }
+}
 
-        None // 没有可用的文件描述符
+/// 文件描述符表 (struct files_struct)
+///
+/// 查找不加锁：在 RCU 读临界区内读取当前数组和表项，再增加文件的引用计数。
+/// 分配、安装、关闭和扩展持 file_lock；关闭时等待宽限期后才释放表项的引用，
+/// 扩展时等待宽限期后才释放旧数组
+pub struct FdTable {
+    /// 当前的描述符数组
+    fdt: AtomicPtr<FdArray>,
+    /// 分配位图，写者之间互斥 (file_lock)
+    file_lock: Mutex<FdBitmap>,
+    /// 已分配的描述符数量
+    count: AtomicUsize,
+}
+
+impl FdTable {
+    /// 创建新的文件描述符表
+    ///
+    /// 初始只分配 NR_OPEN_DEFAULT 项，按需倍增到 NR_OPEN_MAX
+    pub fn new() -> Self {
+        Self {
+            fdt: AtomicPtr::new(Box::into_raw(FdArray::new(NR_OPEN_DEFAULT))),
+            file_lock: Mutex::new(FdBitmap::new(NR_OPEN_DEFAULT)),
+            count: AtomicUsize::new(0),
+        }
     }
 
-    /// 安装文件到文件描述符表
-    pub fn install_fd(&self, fd: usize, file: Arc<File>) -> Result<(), ()> {
-        if fd >= 1024 {
+    /// 访问当前数组，调用者持 file_lock
+    fn fdt_locked(&self) -> &FdArray {
+        unsafe { &*self.fdt.load(Ordering::Relaxed) }
+    }
+
+    /// 当前数组的大小
+    pub fn max_fds(&self) -> usize {
+        self.file_lock.lock().max_fds()
+    }
+
+    /// 已分配的描述符数量
+    pub fn open_count(&self) -> usize {
+        self.count.load(Ordering::Relaxed)
+    }
+
+    /// 扩展数组以容纳 fd (expand_files)
+    fn expand(&self, bitmap: &mut FdBitmap, fd: usize) -> Result<(), ()> {
+        if fd >= NR_OPEN_MAX {
             return Err(());
         }
+        if fd < bitmap.max_fds() {
+            return Ok(());
+        }
+
+        let old = self.fdt.load(Ordering::Relaxed);
+        let new_fdt = FdArray::new((fd + 1).next_power_of_two().min(NR_OPEN_MAX));
+        // 表项的引用随指针转移到新数组
+        for (dst, src) in new_fdt.fd.iter().zip(unsafe { (*old).fd.iter() }) {
+            dst.store(src.load(Ordering::Relaxed), Ordering::Relaxed);
+        }
+        bitmap.grow(new_fdt.fd.len());
+        self.fdt.store(Box::into_raw(new_fdt), Ordering::Release);
+
+        // 读者可能还在读旧数组
+        synchronize_rcu();
+        drop(unsafe { Box::from_raw(old) });
+        Ok(())
+    }
+
+    /// 分配最小的空闲文件描述符 (get_unused_fd_flags)
+    ///
+    /// 描述符只在位图中占用，install_fd 之后才能查到文件；
+    /// 分配后不再需要时用 close_fd 释放
+    pub fn alloc_fd(&self) -> Option<usize> {
+        let mut bitmap = self.file_lock.lock();
 
-        let fds = unsafe { &mut *self.fds.get() };
+        let start = bitmap.next_fd;
+        let fd = bitmap.find_next_fd(start).unwrap_or(bitmap.max_fds());
+        self.expand(&mut bitmap, fd).ok()?;
 
-        if fds[fd].is_some() {
+        bitmap.set(fd);
+        bitmap.next_fd = fd + 1;
+        self.count.fetch_add(1, Ordering::Relaxed);
+        Some(fd)
+    }
+
+    /// 安装文件到文件描述符表 (fd_install)
+    ///
+    /// fd 可以是 alloc_fd 分配的，也可以直接指定（如标准输入输出）
+    pub fn install_fd(&self, fd: usize, file: Arc<File>) -> Result<(), ()> {
+        let mut bitmap = self.file_lock.lock();
+        self.expand(&mut bitmap, fd)?;
+
+        let slot = &self.fdt_locked().fd[fd];
+        if !slot.load(Ordering::Relaxed).is_null() {
             return Err(()); // 文件描述符已被占用
         }
+        if !bitmap.is_set(fd) {
+            bitmap.set(fd);
+            self.count.fetch_add(1, Ordering::Relaxed);
+        }
 
-        fds[fd] = Some(file);
+        // 文件初始化的写入先于指针对读者可见
+        slot.store(Arc::into_raw(file) as *mut File, Ordering::Release);
         Ok(())
     }
 
-    /// 获取文件描述符对应的文件对象
+    /// 获取文件描述符对应的文件对象 (fget)
     pub fn get_file(&self, fd: usize) -> Option<Arc<File>> {
-        if fd >= 1024 {
+        if fd >= NR_OPEN_MAX {
+            return None;
+        }
+
+        let _rcu = rcu_read_lock();
+        let fdt = unsafe { &*self.fdt.load(Ordering::Acquire) };
+        let file = fdt.fd.get(fd)?.load(Ordering::Acquire);
+        if file.is_null() {
             return None;
         }
-        let fds = unsafe { &*self.fds.get() };
+        // 关闭者在宽限期后才释放表项的引用，此时引用计数不为 0
+        unsafe {
+            Arc::increment_strong_count(file);
+            Some(Arc::from_raw(file))
+        }
+    }
 
-        // 简单的 clone 方式
-        fds[fd].clone()
+    /// 不增加引用计数地查找文件 (files_lookup_fd_raw)
+    ///
+    /// # Safety
+    /// 调用者保证返回的指针使用期间没有其他任务修改本表，
+    /// 即本表未共享，且调用者自己不关闭该描述符
+    unsafe fn lookup_fd_raw(&self, fd: usize) -> Option<NonNull<File>> {
+        let fdt = &*self.fdt.load(Ordering::Acquire);
+        NonNull::new(fdt.fd.get(fd)?.load(Ordering::Acquire))
     }
 
-    /// 关闭文件描述符
+    /// 关闭文件描述符 (close_fd)
+    ///
+    /// 也用于释放 alloc_fd 分配后未安装的描述符 (put_unused_fd)
     pub fn close_fd(&self, fd: usize) -> Result<(), ()> {
-        if fd >= 1024 {
-            return Err(());
+        let file = {
+            let mut bitmap = self.file_lock.lock();
+            if !bitmap.is_set(fd) {
+                return Err(());
+            }
+            let file = self.fdt_locked().fd[fd].swap(ptr::null_mut(), Ordering::AcqRel);
+            bitmap.clear(fd);
+            self.count.fetch_sub(1, Ordering::Relaxed);
+            file
+        };
+
+        if !file.is_null() {
+            // 等待可能已读到该表项、尚未增加引用计数的读者
+            synchronize_rcu();
+            // 释放描述符持有的引用，最后一个引用时才调用 close
+            fput(unsafe { Arc::from_raw(file) });
         }
+        Ok(())
+    }
 
-        let fds = unsafe { &mut *self.fds.get() };
+    /// 复制文件描述符
+    pub fn dup_fd(&self, oldfd: usize) -> Option<usize> {
+        let file = self.get_file(oldfd)?;
+        let newfd = self.alloc_fd()?;
 
-        if fds[fd].is_none() {
-            return Err(());
+        if self.install_fd(newfd, file).is_err() {
+            let _ = self.close_fd(newfd);
+            return None;
         }
+        Some(newfd)
+    }
+}
 
-        // 取出文件并调用关闭操作
-        // 注意：需要先取出文件，避免在 unsafe 块中借用问题
-        let file_opt = unsafe {
-            // 使用 swap 将 fds[fd] 替换为 None，同时获取原值
-            let temp = &mut fds[fd];
-            core::mem::replace(temp, None)
-        };
-
-        // 如果文件有操作函数指针，调用 close
-        if let Some(file) = file_opt {
-            unsafe {
-                let file_ptr = Arc::as_ptr(&file) as *mut File;
-                // 检查是否有 ops（避免访问 None）
-                let ops_ptr = (*file_ptr).ops.get();
-                if !ops_ptr.is_null() && !(*ops_ptr).is_none() {
-                    (*file_ptr).close();
-                }
+impl Drop for FdTable {
+    /// 释放数组并关闭仍打开的文件 (put_files_struct)
+    fn drop(&mut self) {
+        let fdt = unsafe { Box::from_raw(*self.fdt.get_mut()) };
+        for slot in fdt.fd.iter() {
+            let file = slot.load(Ordering::Relaxed);
+            if !file.is_null() {
+                fput(unsafe { Arc::from_raw(file) });
             }
         }
+    }
+}
 
-        *self.count.lock() -= 1;
-        Ok(())
+/// fdget 的结果 (struct fd)
+///
+/// 描述符表未共享时直接借用表中的文件，不修改引用计数；
+/// 共享时持有一个引用，drop 时释放 (fdput)
+pub struct FileRef {
+    file: NonNull<File>,
+    /// 持有引用 (FDPUT_FPUT)
+    owned: bool,
+}
+
+impl core::ops::Deref for FileRef {
+    type Target = File;
+
+    fn deref(&self) -> &File {
+        unsafe { self.file.as_ref() }
     }
+}
 
-    /// 复制文件描述符
-    pub fn dup_fd(&self, oldfd: usize) -> Option<usize> {
-        if oldfd >= 1024 {
-            return None;
+impl Drop for FileRef {
+    fn drop(&mut self) {
+        if self.owned {
+            fput(unsafe { Arc::from_raw(self.file.as_ptr()) });
         }
+    }
+}
 
-        let file = self.get_file(oldfd)?;
-        let newfd = self.alloc_fd()?;
+/// 查找当前任务的文件，只在系统调用内使用 (fdget)
+///
+/// 描述符表只被当前任务引用时，其他任务不能关闭文件，当前任务在本次
+/// 系统调用返回前也不会关闭它，可以跳过引用计数的原子操作 (__fget_light)
+pub unsafe fn fdget(fd: usize) -> Option<FileRef> {
+    let task = crate::sched::current()?;
+    let fdtable = task.try_fdtable()?;
+
+    if task.fdtable_shared() {
+        let file = fdtable.get_file(fd)?;
+        return Some(FileRef { file: NonNull::new_unchecked(Arc::into_raw(file) as *mut File), owned: true });
+    }
+    let file = fdtable.lookup_fd_raw(fd)?;
+    Some(FileRef { file, owned: false })
+}
 
-        self.install_fd(newfd, file).ok()?;
-        Some(newfd)
+/// 释放文件的一个引用，最后一个引用释放时调用 close (fput)
+///
+/// 同一个文件可能被多个描述符 (dup / fork) 或在途的 SCM_RIGHTS 消息引用，
+/// 只关闭其中一个描述符时不能关闭文件
+pub fn fput(file: Arc<File>) {
+    if let Some(mut file) = Arc::into_inner(file) {
+        // 先从监视它的 epoll 中摘除，等待队列随 close 释放 (eventpoll_release)
+        crate::fs::eventpoll::eventpoll_release(&file);
+        unsafe { file.close(); }
     }
 }
 
@@ -396,6 +762,44 @@ fn reg_file_write(file: &File, buf: &[u8]) -> isize {
     }
 }
 
+/// 从 pos 起依次读入各段 (read_iter)
+fn reg_file_read_iter(file: &File, iov: &mut [&mut [u8]], pos: u64) -> isize {
+    let inode = match unsafe { &*file.inode.get() } {
+        Some(inode) => inode,
+        None => return -9,  // EBADF
+    };
+    let mut offset = pos as usize;
+    let mut total = 0;
+    for buf in iov.iter_mut() {
+        let n = inode.read_data(offset, buf);
+        offset += n;
+        total += n;
+        if n < buf.len() {
+            break;  // EOF
+        }
+    }
+    total as isize
+}
+
+/// 从 pos 起依次写入各段 (write_iter)
+fn reg_file_write_iter(file: &File, iov: &[&[u8]], pos: u64) -> isize {
+    let inode = match unsafe { &*file.inode.get() } {
+        Some(inode) => inode,
+        None => return -9,  // EBADF
+    };
+    let mut offset = pos as usize;
+    let mut total = 0;
+    for buf in iov.iter() {
+        let n = inode.write_data(offset, buf);
+        offset += n;
+        total += n;
+        if n < buf.len() {
+            break;
+        }
+    }
+    total as isize
+}
+
 fn reg_file_lseek(file: &File, offset: isize, whence: i32) -> isize {
     // SEEK_SET = 0, SEEK_CUR = 1, SEEK_END = 2
     let current_pos = file.get_pos() as isize;
@@ -433,6 +837,9 @@ pub static REG_FILE_OPS: FileOps = FileOps {
     write: Some(reg_file_write),
     lseek: Some(reg_file_lseek),
     close: Some(reg_file_close),
+    read_iter: Some(reg_file_read_iter),
+    write_iter: Some(reg_file_write_iter),
+    poll: None,
 };
 
 pub static REG_RO_FILE_OPS: FileOps = FileOps {
@@ -440,4 +847,7 @@ pub static REG_RO_FILE_OPS: FileOps = FileOps {
     write: None,
     lseek: Some(reg_file_lseek),
     close: Some(reg_file_close),
+    read_iter: Some(reg_file_read_iter),
+    write_iter: None,
+    poll: None,
 };
@@ -0,0 +1,202 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! initramfs - 把引导程序交给内核的 cpio 归档解到 RootFS
+//!
+//! 参考 Linux: init/initramfs.c (populate_rootfs, unpack_to_rootfs), usr/gen_init_cpio.c
+//!
+//! - 归档的位置来自设备树 /chosen 的 linux,initrd-start / linux,initrd-end
+//!   （QEMU 的 -initrd 参数会写入这两个属性）
+//! - 只支持未压缩的 newc 格式（"070701"，以及带校验和的 "070702"，校验和不检查）
+//! - 普通文件不复制：RootFS 节点直接引用归档中的数据 (FileData::Initramfs)，
+//!   第一次写入时才复制到堆上；数据在归档中页对齐时，页缓存直接映射归档所在的物理页，
+//!   exec 与 mmap 都不再复制一份
+//! - newc 的数据只按 4 字节对齐；生成归档的工具可以在文件名后多填 NUL（namesize 包含填充），
+//!   使数据从页边界开始
+//! - 归档所在的内存启动后一直保留，不交还给分配器
+//! - 设备节点等其他类型的条目跳过；硬链接的各个名字各自成为独立文件
+
+use alloc::format;
+use alloc::string::String;
+use core::sync::atomic::{AtomicU64, Ordering};
+
+use crate::errno::Errno;
+use crate::fs::rootfs::{FileData, RootFSSuperBlock};
+
+/// newc 头部长度：6 字节魔数 + 13 个 8 位十六进制字段
+const NEWC_HDR_LEN: usize = 110;
+
+const NEWC_MAGIC: &[u8] = b"070701";
+const NEWC_CRC_MAGIC: &[u8] = b"070702";
+
+/// 归档结束标记
+const TRAILER: &str = "TRAILER!!!";
+
+const S_IFMT: u32 = 0o170000;
+const S_IFDIR: u32 = 0o040000;
+const S_IFREG: u32 = 0o100000;
+const S_IFLNK: u32 = 0o120000;
+
+/// 内核映像、堆、slab 与用户页分配器使用的物理内存上限
+/// （main.rs 中 init_user_phys_allocator 的区间），initrd 不能与它重叠
+const KERNEL_MANAGED_END: u64 = 0x8800_0000;
+
+/// initrd 的物理地址区间，没有 initrd 时为 0
+static INITRD_START: AtomicU64 = AtomicU64::new(0);
+static INITRD_END: AtomicU64 = AtomicU64::new(0);
+
+/// cpio 归档中的一个条目
+pub struct CpioEntry<'a> {
+    /// 去掉开头的 "./" 与 "/" 之后的路径
+    pub name: &'a str,
+    pub mode: u32,
+    pub data: &'a [u8],
+}
+
+fn parse_hex(field: &[u8]) -> Option<u32> {
+    let mut value = 0u32;
+    for &c in field {
+        let digit = (c as char).to_digit(16)?;
+        value = value << 4 | digit;
+    }
+    Some(value)
+}
+
+#[inline]
+fn align4(off: usize) -> usize {
+    (off + 3) & !3
+}
+
+/// 依次访问归档中的条目，直到 TRAILER!!! 或归档末尾
+///
+/// # 返回
+/// 访问的条目数；归档格式错误返回 EINVAL
+pub fn parse<'a, F>(archive: &'a [u8], mut f: F) -> Result<usize, i32>
+where
+    F: FnMut(CpioEntry<'a>) -> Result<(), i32>,
+{
+    let einval = Errno::InvalidArgument.as_neg_i32();
+    let mut off = 0;
+    let mut count = 0;
+    loop {
+        // 拼接的归档之间可能有 NUL 填充
+        while off < archive.len() && archive[off] == 0 {
+            off += 1;
+        }
+        if off + NEWC_HDR_LEN > archive.len() {
+            return if off >= archive.len() { Ok(count) } else { Err(einval) };
+        }
+        let hdr = &archive[off..off + NEWC_HDR_LEN];
+        if &hdr[..6] != NEWC_MAGIC && &hdr[..6] != NEWC_CRC_MAGIC {
+            return Err(einval);
+        }
+        let field = |i: usize| parse_hex(&hdr[6 + i * 8..14 + i * 8]).ok_or(einval);
+        let mode = field(1)?;
+        let filesize = field(6)? as usize;
+        let namesize = field(11)? as usize;
+
+        let name_start = off + NEWC_HDR_LEN;
+        let data_start = align4(name_start + namesize);
+        let data_end = data_start + filesize;
+        if namesize == 0 || data_end > archive.len() {
+            return Err(einval);
+        }
+        // namesize 包含结尾的 NUL 和可能的填充
+        let raw_name = &archive[name_start..name_start + namesize];
+        let name_len = raw_name.iter().position(|&c| c == 0).unwrap_or(raw_name.len());
+        let name = core::str::from_utf8(&raw_name[..name_len]).map_err(|_| einval)?;
+        if name == TRAILER {
+            return Ok(count);
+        }
+
+        let name = name.trim_start_matches("./").trim_start_matches('/');
+        f(CpioEntry { name, mode, data: &archive[data_start..data_end] })?;
+        count += 1;
+        off = align4(data_end);
+    }
+}
+
+/// 逐级创建 path 的父目录
+fn make_parents(sb: &RootFSSuperBlock, path: &str) {
+    let mut end = 0;
+    while let Some(pos) = path[end + 1..].find('/') {
+        end += 1 + pos;
+        let _ = sb.create_dir(&path[..end], 0o755);
+    }
+}
+
+/// 把归档解到 RootFS (unpack_to_rootfs)
+///
+/// # 返回
+/// 建立的目录、文件和符号链接数
+pub fn unpack(sb: &RootFSSuperBlock, archive: &'static [u8]) -> Result<usize, i32> {
+    let eexist = Errno::FileExists.as_neg_i32();
+    let mut created = 0;
+    parse(archive, |entry| {
+        if entry.name.is_empty() || entry.name == "." {
+            return Ok(());
+        }
+        let path: String = format!("/{}", entry.name);
+        make_parents(sb, &path);
+        let result = match entry.mode & S_IFMT {
+            S_IFDIR => match sb.create_dir(&path, entry.mode & 0o7777) {
+                Err(e) if e == eexist => return Ok(()),
+                result => result,
+            },
+            S_IFREG => {
+                // 后面的归档覆盖前面的同名文件
+                let _ = sb.unlink(&path);
+                sb.create_file_data(&path, FileData::Initramfs(entry.data))
+            }
+            S_IFLNK => match core::str::from_utf8(entry.data) {
+                Ok(target) => {
+                    let _ = sb.unlink(&path);
+                    sb.symlink(target, &path)
+                }
+                Err(_) => return Ok(()),
+            },
+            _ => return Ok(()),
+        };
+        if result.is_ok() {
+            created += 1;
+        }
+        Ok(())
+    })?;
+    Ok(created)
+}
+
+/// initrd 的物理地址区间
+pub fn initrd_range() -> Option<(u64, u64)> {
+    let start = INITRD_START.load(Ordering::Relaxed);
+    if start == 0 {
+        return None;
+    }
+    Some((start, INITRD_END.load(Ordering::Relaxed)))
+}
+
+/// 查找引导程序传递的 initrd 并解到 RootFS (populate_rootfs)
+///
+/// # 返回
+/// - `None`: 没有 initrd
+/// - `Some(Ok(n))`: 建立了 n 个条目
+/// - `Some(Err(e))`: initrd 与内核使用的内存重叠或归档格式错误
+#[cfg(feature = "riscv64")]
+pub fn populate_rootfs() -> Option<Result<usize, i32>> {
+    let dtb_ptr = crate::arch::riscv64::boot::get_dtb_pointer();
+    let (start, end) = unsafe { crate::fdt::scan_initrd(dtb_ptr) }?;
+    if start < KERNEL_MANAGED_END {
+        return Some(Err(Errno::InvalidArgument.as_neg_i32()));
+    }
+    let sb = crate::fs::get_rootfs();
+    if sb.is_null() {
+        return Some(Err(Errno::NoSuchFileOrDirectory.as_neg_i32()));
+    }
+    INITRD_START.store(start, Ordering::Relaxed);
+    INITRD_END.store(end, Ordering::Relaxed);
+
+    // 内核页表恒等映射物理内存，归档在启动后一直保留
+    let archive: &'static [u8] = unsafe { core::slice::from_raw_parts(start as *const u8, (end - start) as usize) };
+    Some(unpack(unsafe { &*sb }, archive))
+}
@@ -10,9 +10,13 @@
 //! - `struct super_block`: 超级块，表示一个文件系统
 //! - `struct inode_operations`: inode 操作函数指针
 
+use alloc::boxed::Box;
+use alloc::collections::BTreeMap;
 use alloc::sync::Arc;
+use alloc::vec::Vec;
 use spin::Mutex;
-use core::sync::atomic::{AtomicU64, Ordering};
+use core::any::Any;
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, AtomicUsize, Ordering};
 use crate::fs::buffer::FileBuffer;
 
 /// Inode 编号类型
@@ -151,6 +155,18 @@ pub struct Inode {
     pub private_data: Option<*mut u8>,
     /// 文件数据（常规文件使用）
     pub data: Mutex<Option<FileBuffer>>,
+    /// 所属文件系统实例的设备号，0 表示不属于任何文件系统 (i_sb->s_dev)
+    pub i_dev: u64,
+    /// 是否需要写回 (I_DIRTY)
+    pub i_dirty: AtomicBool,
+    /// 最近一次把 inode 写入日志的事务，fsync 等待它提交 (ext4_inode_info.i_sync_tid)
+    pub i_sync_tid: AtomicU32,
+    /// 最近一次改变大小或块映射的事务，fdatasync 等待它提交 (i_datasync_tid)
+    pub i_datasync_tid: AtomicU32,
+    /// 文件系统私有的 inode 信息 (如 ext4_inode_info)
+    pub i_fsdata: Mutex<Option<Box<dyn Any + Send>>>,
+    /// 把 inode 写回存储 (super_operations.write_inode)
+    pub write_inode: Option<fn(&Inode) -> Result<(), i32>>,
     /// 引用计数
     ref_count: AtomicU64,
 }
@@ -170,6 +186,12 @@ impl Inode {
             ops: None,
             private_data: None,
             data: Mutex::new(None),
+            i_dev: 0,
+            i_dirty: AtomicBool::new(false),
+            i_sync_tid: AtomicU32::new(0),
+            i_datasync_tid: AtomicU32::new(0),
+            i_fsdata: Mutex::new(None),
+            write_inode: None,
             ref_count: AtomicU64::new(1),
         }
     }
@@ -277,9 +299,23 @@ pub fn make_fifo_inode(ino: Ino) -> Inode {
 // ============================================================================
 // Inode 缓存 (inode cache)
 // ============================================================================
+//
+// 参考 Linux: fs/inode.c (iget_locked, find_inode_fast, __mark_inode_dirty, prune_icache_sb)
+//
+// - 以 (设备号, inode 编号) 哈希分桶，每个桶一把锁；同一 inode 在缓存中只有一个 Arc<Inode>
+// - 文件系统修改 inode 后 mark_inode_dirty 登记到脏 inode 表 (b_dirty)，
+//   由回写线程和 sync 调用 write_inode 写回
+// - 条目数超过 ICACHE_MAX_ENTRIES 或内存回收时按 CLOCK 顺序淘汰：
+//   仍被引用的 inode 和脏 inode 不淘汰，最近被访问过的条目清除访问位后保留
 
-/// Inode 缓存大小
-const ICACHE_SIZE: usize = 256;
+/// 桶数
+const ICACHE_BUCKETS: usize = 256;
+
+/// 缓存的最大 inode 数
+const ICACHE_MAX_ENTRIES: usize = 4096;
+
+/// 脏 inode 保留的最长时间 (dirty_expire_centisecs = 30s)
+const INODE_DIRTY_EXPIRE: u64 = 30 * crate::drivers::timer::HZ;
 
 /// Inode 缓存统计信息
 #[derive(Debug)]
@@ -290,14 +326,17 @@ pub struct InodeCacheStats {
     pub misses: AtomicU64,
     /// 淘汰次数
     pub evictions: AtomicU64,
+    /// 写回的 inode 数
+    pub writebacks: AtomicU64,
 }
 
 impl InodeCacheStats {
-    pub fn new() -> Self {
+    pub const fn new() -> Self {
         Self {
             hits: AtomicU64::new(0),
             misses: AtomicU64::new(0),
             evictions: AtomicU64::new(0),
+            writebacks: AtomicU64::new(0),
         }
     }
 
@@ -325,252 +364,274 @@ impl InodeCacheStats {
     }
 }
 
-/// 哈希表桶
-struct InodeHashBucket {
-    /// inode 指针
-    inode: Option<Arc<Inode>>,
-    /// inode 编号（用于快速比较）
+/// 哈希链上的条目
+struct InodeHashEntry {
+    /// 设备号
+    dev: u64,
+    /// inode 编号
     ino: Ino,
-    /// LRU 时间戳（用于淘汰）
-    access_time: AtomicU64,
+    inode: Arc<Inode>,
+    /// CLOCK 访问位
+    referenced: AtomicBool,
 }
 
-impl Clone for InodeHashBucket {
-    fn clone(&self) -> Self {
-        Self {
-            inode: self.inode.clone(),
-            ino: self.ino,
-            access_time: AtomicU64::new(self.access_time.load(Ordering::Relaxed)),
-        }
-    }
-}
-
-/// Inode 哈希表
-struct InodeCache {
-    /// 哈希表
-    buckets: [InodeHashBucket; ICACHE_SIZE],
-    /// 缓存中的条目数量
-    count: usize,
-    /// 全局时间戳（用于 LRU）
-    global_time: AtomicU64,
-    /// 统计信息
-    stats: InodeCacheStats,
-}
+const ICACHE_EMPTY_BUCKET: Mutex<Vec<InodeHashEntry>> = Mutex::new(Vec::new());
 
-unsafe impl Send for InodeCache {}
-unsafe impl Sync for InodeCache {}
+/// inode 哈希表 (inode_hashtable)
+static ICACHE: [Mutex<Vec<InodeHashEntry>>; ICACHE_BUCKETS] = [ICACHE_EMPTY_BUCKET; ICACHE_BUCKETS];
 
-/// 全局 Inode 缓存
-static ICACHE: spin::Mutex<Option<InodeCache>> = spin::Mutex::new(None);
+/// 缓存中的条目数
+static ICACHE_COUNT: AtomicUsize = AtomicUsize::new(0);
 
-/// 初始化 Inode 缓存
-fn icache_init() {
-    let mut cache = ICACHE.lock();
-    if cache.is_some() {
-        return;  // 已经初始化
-    }
+/// CLOCK 指针（桶下标）
+static ICACHE_CLOCK: AtomicUsize = AtomicUsize::new(0);
 
-    // 创建空桶数组
-    let buckets: [InodeHashBucket; ICACHE_SIZE] = core::array::from_fn(|_| InodeHashBucket {
-        inode: None,
-        ino: 0,
-        access_time: AtomicU64::new(0),
-    });
+static ICACHE_STATS: InodeCacheStats = InodeCacheStats::new();
 
-    *cache = Some(InodeCache {
-        buckets,
-        count: 0,
-        global_time: AtomicU64::new(1),
-        stats: InodeCacheStats::new(),
-    });
-}
+/// 脏 inode 表：(设备号, inode 编号) -> 变脏的时刻 (wb->b_dirty)
+static DIRTY_INODES: Mutex<BTreeMap<(u64, Ino), u64>> = Mutex::new(BTreeMap::new());
 
 /// 计算哈希值
 ///
 /// 使用简单的 FNV-1a 哈希算法
-fn inode_hash(ino: Ino) -> u64 {
+fn inode_hash(dev: u64, ino: Ino) -> u64 {
     let mut hash = 0xcbf29ce484222325_u64;  // FNV offset basis
 
-    // 混合 inode 编号
+    // 混合设备号和 inode 编号
+    hash ^= dev;
+    hash = hash.wrapping_mul(0x100000001b3);
     hash ^= ino;
     hash = hash.wrapping_mul(0x100000001b3);
 
     hash
 }
 
-/// 在 Inode 缓存中查找
-///
-pub fn icache_lookup(ino: Ino) -> Option<Arc<Inode>> {
-    // 确保缓存已初始化
-    icache_init();
-
-    let mut cache = ICACHE.lock();
-    let cache_inner = cache.as_mut()?;
-
-    // 计算哈希值
-    let hash = inode_hash(ino);
-    let index = (hash as usize) % ICACHE_SIZE;
-
-    // 查找匹配的条目
-    let bucket = &cache_inner.buckets[index];
-
-    if let Some(ref inode) = bucket.inode {
-        // 比较 inode 编号
-        if bucket.ino == ino {
-            // 更新访问时间（用于 LRU）
-            let current_time = cache_inner.global_time.fetch_add(1, Ordering::Relaxed);
-            bucket.access_time.store(current_time, Ordering::Relaxed);
-
-            // 记录命中
-            cache_inner.stats.record_hit();
+#[inline]
+fn icache_bucket(dev: u64, ino: Ino) -> &'static Mutex<Vec<InodeHashEntry>> {
+    &ICACHE[(inode_hash(dev, ino) as usize) % ICACHE_BUCKETS]
+}
 
-            return Some(inode.clone());
+/// 按 (设备号, inode 编号) 查找缓存的 inode (ilookup)
+pub fn ilookup(dev: u64, ino: Ino) -> Option<Arc<Inode>> {
+    let bucket = icache_bucket(dev, ino).lock();
+    match bucket.iter().find(|e| e.dev == dev && e.ino == ino) {
+        Some(entry) => {
+            entry.referenced.store(true, Ordering::Relaxed);
+            ICACHE_STATS.record_hit();
+            Some(entry.inode.clone())
+        }
+        None => {
+            ICACHE_STATS.record_miss();
+            None
         }
     }
-
-    // 记录未命中
-    cache_inner.stats.record_miss();
-
-    None
 }
 
-/// 将 Inode 添加到缓存
+/// 把新读入的 inode 加入缓存 (insert_inode_locked)
 ///
-pub fn icache_add(inode: Arc<Inode>) {
-    // 确保缓存已初始化
-    icache_init();
+/// 键为 (inode.i_dev, inode.ino)；其他 CPU 已经加入同一 inode 时返回已有的那个，
+/// 调用者应改用返回值，保证同一 inode 只有一个内存实例
+pub fn insert_inode_hash(inode: Arc<Inode>) -> Arc<Inode> {
+    let (dev, ino) = (inode.i_dev, inode.ino);
 
-    // 获取 inode 编号（在缓存锁外进行）
-    let ino = inode.ino;
+    let count = ICACHE_COUNT.load(Ordering::Relaxed);
+    if count >= ICACHE_MAX_ENTRIES {
+        icache_shrink(count + 1 - ICACHE_MAX_ENTRIES);
+    }
 
-    // 计算哈希值
-    let hash = inode_hash(ino);
+    let mut bucket = icache_bucket(dev, ino).lock();
+    if let Some(existing) = bucket.iter().find(|e| e.dev == dev && e.ino == ino) {
+        existing.referenced.store(true, Ordering::Relaxed);
+        return existing.inode.clone();
+    }
+    bucket.push(InodeHashEntry {
+        dev,
+        ino,
+        inode: inode.clone(),
+        referenced: AtomicBool::new(false),
+    });
+    ICACHE_COUNT.fetch_add(1, Ordering::Relaxed);
+    inode
+}
 
-    let mut cache = ICACHE.lock();
-    let inner = cache.as_mut().expect("icache not initialized");
+/// 从缓存中删除 (remove_inode_hash)
+///
+/// 脏 inode 不再写回
+pub fn remove_inode_hash(dev: u64, ino: Ino) {
+    DIRTY_INODES.lock().remove(&(dev, ino));
+    let mut bucket = icache_bucket(dev, ino).lock();
+    if let Some(pos) = bucket.iter().position(|e| e.dev == dev && e.ino == ino) {
+        let entry = bucket.swap_remove(pos);
+        entry.inode.i_dirty.store(false, Ordering::Relaxed);
+        ICACHE_COUNT.fetch_sub(1, Ordering::Relaxed);
+    }
+}
 
-    let index = (hash as usize) % ICACHE_SIZE;
+/// 标记 inode 需要写回 (__mark_inode_dirty)
+pub fn mark_inode_dirty(inode: &Inode) {
+    if !inode.i_dirty.swap(true, Ordering::AcqRel) {
+        let now = crate::drivers::timer::get_jiffies();
+        DIRTY_INODES.lock().entry((inode.i_dev, inode.ino)).or_insert(now);
+    }
+}
 
-    // 检查是否已存在
-    if let Some(ref _existing) = inner.buckets[index].inode {
-        if inner.buckets[index].ino == ino {
-            return;  // 已经在缓存中
+/// 立即写回一个脏 inode (write_inode_now)
+pub fn write_inode_now(inode: &Inode) -> Result<(), i32> {
+    if !inode.i_dirty.swap(false, Ordering::AcqRel) {
+        return Ok(());
+    }
+    DIRTY_INODES.lock().remove(&(inode.i_dev, inode.ino));
+    let result = match inode.write_inode {
+        Some(write) => write(inode),
+        None => Ok(()),
+    };
+    match result {
+        Ok(()) => {
+            ICACHE_STATS.writebacks.fetch_add(1, Ordering::Relaxed);
+        }
+        Err(_) => {
+            // 写回失败时保留脏标记，之后重试
+            mark_inode_dirty(inode);
         }
-
-        // 使用 LRU 策略：查找并淘汰最久未使用的条目
-        icache_evict_lru(inner);
     }
+    result
+}
 
-    // 获取当前时间戳
-    let current_time = inner.global_time.fetch_add(1, Ordering::Relaxed);
-
-    // 添加到缓存
-    inner.buckets[index] = InodeHashBucket {
-        inode: Some(inode.clone()),
-        ino,
-        access_time: AtomicU64::new(current_time),
-    };
-    inner.count += 1;
+/// 是否有等待写回的 inode
+pub fn has_dirty_inodes() -> bool {
+    !DIRTY_INODES.lock().is_empty()
 }
 
-/// LRU 淘汰策略：淘汰最久未使用的条目
+/// 写回脏 inode (writeback_inodes_sb)
 ///
-fn icache_evict_lru(cache: &mut InodeCache) {
-    // 查找最久未使用的条目（最小访问时间）
-    let mut lru_index = 0;
-    let mut lru_time = u64::MAX;
-    let mut found = false;
-
-    for (i, bucket) in cache.buckets.iter().enumerate() {
-        if bucket.inode.is_some() {
-            let access_time = bucket.access_time.load(Ordering::Relaxed);
-            if access_time < lru_time {
-                lru_time = access_time;
-                lru_index = i;
-                found = true;
+/// # 参数
+/// - `dev`: 只写回该设备的 inode；None 表示全部
+/// - `expired_only`: 只写回变脏超过 INODE_DIRTY_EXPIRE 的 inode
+///
+/// # 返回
+/// 写回的 inode 数
+pub fn writeback_inodes(dev: Option<u64>, expired_only: bool) -> usize {
+    let now = crate::drivers::timer::get_jiffies();
+    let keys: Vec<(u64, Ino)> = DIRTY_INODES.lock()
+        .iter()
+        .filter(|(&(d, _), &when)| {
+            dev.map_or(true, |dev| dev == d)
+                && (!expired_only || now.saturating_sub(when) >= INODE_DIRTY_EXPIRE)
+        })
+        .map(|(&key, _)| key)
+        .collect();
+
+    let mut written = 0;
+    for (d, ino) in keys {
+        let inode = {
+            let bucket = icache_bucket(d, ino).lock();
+            bucket.iter().find(|e| e.dev == d && e.ino == ino).map(|e| e.inode.clone())
+        };
+        match inode {
+            Some(inode) => {
+                if write_inode_now(&inode).is_ok() {
+                    written += 1;
+                }
+            }
+            None => {
+                DIRTY_INODES.lock().remove(&(d, ino));
             }
         }
     }
+    written
+}
 
-    // 淘汰 LRU 条目
-    if found {
-        cache.buckets[lru_index].inode = None;
-        cache.buckets[lru_index].ino = 0;
-        cache.buckets[lru_index].access_time.store(0, Ordering::Relaxed);
-        cache.count -= 1;
-
-        // 记录淘汰
-        cache.stats.record_eviction();
-    }
+/// 淘汰一个设备的全部 inode，脏 inode 先写回 (evict_inodes)
+///
+/// 卸载文件系统时调用
+pub fn evict_inodes(dev: u64) {
+    writeback_inodes(Some(dev), false);
+    for bucket in ICACHE.iter() {
+        let mut bucket = bucket.lock();
+        let before = bucket.len();
+        bucket.retain(|e| e.dev != dev);
+        ICACHE_COUNT.fetch_sub(before - bucket.len(), Ordering::Relaxed);
+    }
+    DIRTY_INODES.lock().retain(|&(d, _), _| d != dev);
 }
 
-/// 从 Inode 缓存中删除
+/// 按 CLOCK 顺序淘汰最多 nr 个未使用的干净 inode (prune_icache_sb)
 ///
-pub fn icache_remove(ino: Ino) {
-    // 确保缓存已初始化
-    icache_init();
-
-    let mut cache = ICACHE.lock();
-    let inner = cache.as_mut().expect("icache not initialized");
-
-    // 计算哈希值
-    let hash = inode_hash(ino);
-    let index = (hash as usize) % ICACHE_SIZE;
-
-    // 删除条目
-    if let Some(ref _inode) = inner.buckets[index].inode {
-        if inner.buckets[index].ino == ino {
-            // 从缓存中移除
-            inner.buckets[index].inode = None;
-            inner.buckets[index].ino = 0;
-            inner.buckets[index].access_time.store(0, Ordering::Relaxed);
-            inner.count -= 1;
+/// 只 try_lock 桶锁，可在内存回收路径中调用
+///
+/// # 返回
+/// 淘汰的条目数
+pub fn icache_shrink(nr: usize) -> usize {
+    let mut freed = 0;
+    // 每个桶最多扫两遍：第一遍清除访问位，第二遍淘汰
+    for _ in 0..ICACHE_BUCKETS * 2 {
+        if freed >= nr || ICACHE_COUNT.load(Ordering::Relaxed) == 0 {
+            break;
+        }
+        let index = ICACHE_CLOCK.fetch_add(1, Ordering::Relaxed) % ICACHE_BUCKETS;
+        let mut bucket = match ICACHE[index].try_lock() {
+            Some(bucket) => bucket,
+            None => continue,
+        };
+        let mut i = 0;
+        while i < bucket.len() && freed < nr {
+            let entry = &bucket[i];
+            // 只有缓存自己持有引用的干净 inode 可以淘汰
+            let busy = Arc::strong_count(&entry.inode) > 1 || entry.inode.i_dirty.load(Ordering::Relaxed);
+            if busy || entry.referenced.swap(false, Ordering::Relaxed) {
+                i += 1;
+                continue;
+            }
+            bucket.swap_remove(i);
+            ICACHE_COUNT.fetch_sub(1, Ordering::Relaxed);
+            ICACHE_STATS.record_eviction();
+            freed += 1;
         }
     }
+    freed
 }
 
-/// 获取缓存统计信息
-pub fn icache_stats() -> (usize, usize) {
-    // 确保缓存已初始化
-    icache_init();
-
-    let cache = ICACHE.lock();
-    let cache_inner = cache.as_ref().expect("icache not initialized");
+/// 在 Inode 缓存中查找设备号为 0 的 inode
+pub fn icache_lookup(ino: Ino) -> Option<Arc<Inode>> {
+    ilookup(0, ino)
+}
 
-    (cache_inner.count, ICACHE_SIZE)
+/// 将 Inode 添加到缓存，已存在时保留原有的
+pub fn icache_add(inode: Arc<Inode>) {
+    insert_inode_hash(inode);
 }
 
-/// 获取详细的缓存统计信息
-pub fn icache_stats_detailed() -> (u64, u64, u64, f64) {
-    // 确保缓存已初始化
-    icache_init();
+/// 从 Inode 缓存中删除设备号为 0 的 inode
+pub fn icache_remove(ino: Ino) {
+    remove_inode_hash(0, ino);
+}
 
-    let cache = ICACHE.lock();
-    let cache_inner = cache.as_ref().expect("icache not initialized");
+/// 获取缓存统计信息 (条目数, 最大条目数)
+pub fn icache_stats() -> (usize, usize) {
+    (ICACHE_COUNT.load(Ordering::Relaxed), ICACHE_MAX_ENTRIES)
+}
 
+/// 获取详细的缓存统计信息 (命中, 未命中, 淘汰, 命中率)
+pub fn icache_stats_detailed() -> (u64, u64, u64, f64) {
     (
-        cache_inner.stats.hits.load(Ordering::Relaxed),
-        cache_inner.stats.misses.load(Ordering::Relaxed),
-        cache_inner.stats.evictions.load(Ordering::Relaxed),
-        cache_inner.stats.get_hit_rate(),
+        ICACHE_STATS.hits.load(Ordering::Relaxed),
+        ICACHE_STATS.misses.load(Ordering::Relaxed),
+        ICACHE_STATS.evictions.load(Ordering::Relaxed),
+        ICACHE_STATS.get_hit_rate(),
     )
 }
 
-/// 清空 Inode 缓存
-///
-pub fn icache_flush() {
-    // 确保缓存已初始化
-    icache_init();
-
-    let mut cache = ICACHE.lock();
-    let inner = cache.as_mut().expect("icache not initialized");
+/// 写回的 inode 总数
+pub fn icache_writebacks() -> u64 {
+    ICACHE_STATS.writebacks.load(Ordering::Relaxed)
+}
 
-    // 清空所有桶
-    for bucket in inner.buckets.iter_mut() {
-        bucket.inode = None;
-        bucket.ino = 0;
-        bucket.access_time.store(0, Ordering::Relaxed);
+/// 清空 Inode 缓存，脏 inode 先写回
+pub fn icache_flush() {
+    writeback_inodes(None, false);
+    for bucket in ICACHE.iter() {
+        let mut bucket = bucket.lock();
+        ICACHE_COUNT.fetch_sub(bucket.len(), Ordering::Relaxed);
+        bucket.clear();
     }
-
-    inner.count = 0;
 }
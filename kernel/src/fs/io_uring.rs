@@ -0,0 +1,848 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 异步 I/O 环 (io_uring)
+//!
+//! 参考 Linux: io_uring/io_uring.c, io_uring/rw.c, io_uring/poll.c, include/uapi/linux/io_uring.h
+//!
+//! 用户与内核共享两个环，一次系统调用提交和收割任意多个请求：
+//! - 提交队列 (SQ)：用户填写 SQE 数组，把下标放入 sq_array 并前进 sq_tail；
+//!   io_uring_enter 从 sq_head 开始取出 to_submit 个请求
+//! - 完成队列 (CQ)：内核把 CQE 写在 cq_tail 处，用户读取后前进 cq_head，
+//!   收割完成不需要系统调用
+//! - 环的布局与 Linux 的 ABI 一致，内存由 mmap(IORING_OFF_SQ_RING / IORING_OFF_SQES)
+//!   映射到用户空间 (IORING_FEAT_SINGLE_MMAP)
+//!
+//! 请求在提交时以非阻塞方式直接执行，完成项批量写入 CQ 后才前进 cq_tail；
+//! 会阻塞的请求（管道暂无数据、poll 未就绪）挂在环上，在之后的 io_uring_enter 中重试，
+//! 不为每个请求切换上下文。IOSQE_IO_LINK 串起的请求按顺序执行，前一个失败时后续的以
+//! ECANCELED 完成；IOSQE_IO_DRAIN 的请求等之前提交的请求全部完成后才执行
+
+use alloc::boxed::Box;
+use alloc::collections::VecDeque;
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU32, Ordering};
+use spin::Mutex;
+
+use crate::errno::Errno;
+use crate::fs::file::{poll_mask, File, FileFlags, FileOps};
+use crate::mm::filemap::put_page;
+use crate::mm::PAGE_SIZE;
+use crate::process::wait::WaitQueueHead;
+
+/// mmap 偏移：SQ/CQ 环 (IORING_OFF_SQ_RING)
+pub const IORING_OFF_SQ_RING: u64 = 0;
+/// mmap 偏移：CQ 环，与 SQ 环是同一块内存 (IORING_OFF_CQ_RING)
+pub const IORING_OFF_CQ_RING: u64 = 0x800_0000;
+/// mmap 偏移：SQE 数组 (IORING_OFF_SQES)
+pub const IORING_OFF_SQES: u64 = 0x1000_0000;
+
+/// io_uring_setup 标志
+pub mod setup_flags {
+    /// 用 params.cq_entries 指定 CQ 大小 (IORING_SETUP_CQSIZE)
+    pub const IORING_SETUP_CQSIZE: u32 = 1 << 3;
+    /// 条目数过大时截断而不是报错 (IORING_SETUP_CLAMP)
+    pub const IORING_SETUP_CLAMP: u32 = 1 << 4;
+}
+
+/// io_uring_enter 标志：等待 min_complete 个完成 (IORING_ENTER_GETEVENTS)
+pub const IORING_ENTER_GETEVENTS: u32 = 1 << 0;
+
+/// 支持的特性 (IORING_FEAT_*)
+pub mod features {
+    /// SQ 环与 CQ 环共用一次 mmap
+    pub const IORING_FEAT_SINGLE_MMAP: u32 = 1 << 0;
+    /// CQ 满时完成项不丢弃
+    pub const IORING_FEAT_NODROP: u32 = 1 << 1;
+    /// 提交返回后 SQE 可以立即重用
+    pub const IORING_FEAT_SUBMIT_STABLE: u32 = 1 << 2;
+    /// off 为 -1 时使用并前进文件位置
+    pub const IORING_FEAT_RW_CUR_POS: u32 = 1 << 3;
+}
+
+/// 请求操作码 (enum io_uring_op)
+pub mod opcode {
+    pub const IORING_OP_NOP: u8 = 0;
+    pub const IORING_OP_READV: u8 = 1;
+    pub const IORING_OP_WRITEV: u8 = 2;
+    pub const IORING_OP_FSYNC: u8 = 3;
+    pub const IORING_OP_POLL_ADD: u8 = 6;
+    pub const IORING_OP_ACCEPT: u8 = 13;
+    pub const IORING_OP_READ: u8 = 22;
+    pub const IORING_OP_WRITE: u8 = 23;
+    pub const IORING_OP_SEND: u8 = 26;
+    pub const IORING_OP_RECV: u8 = 27;
+}
+
+/// SQE 标志 (IOSQE_*)
+pub mod sqe_flags {
+    /// 等之前提交的请求全部完成后再执行
+    pub const IOSQE_IO_DRAIN: u8 = 1 << 1;
+    /// 与下一个请求串联
+    pub const IOSQE_IO_LINK: u8 = 1 << 2;
+}
+
+/// fsync_flags：只同步数据与大小 (IORING_FSYNC_DATASYNC)
+pub const IORING_FSYNC_DATASYNC: u32 = 1 << 0;
+
+/// sq_flags：有完成项暂存在溢出链表中 (IORING_SQ_CQ_OVERFLOW)
+const IORING_SQ_CQ_OVERFLOW: u32 = 1 << 1;
+
+/// SQ 最多的条目数 (IORING_MAX_ENTRIES)
+pub const IORING_MAX_ENTRIES: u32 = 4096;
+/// CQ 最多的条目数 (IORING_MAX_CQ_ENTRIES)
+pub const IORING_MAX_CQ_ENTRIES: u32 = 2 * IORING_MAX_ENTRIES;
+
+/// 提交队列项 (struct io_uring_sqe)
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct IoUringSqe {
+    pub opcode: u8,
+    pub flags: u8,
+    pub ioprio: u16,
+    pub fd: i32,
+    /// 文件位置，-1 表示使用文件位置
+    pub off: u64,
+    /// 缓冲区或 iovec 数组地址
+    pub addr: u64,
+    /// 缓冲区长度或 iovec 个数
+    pub len: u32,
+    /// rw_flags / fsync_flags / poll32_events / msg_flags / accept_flags
+    pub op_flags: u32,
+    pub user_data: u64,
+    pub buf_index: u16,
+    pub personality: u16,
+    pub splice_fd_in: i32,
+    pub pad: [u64; 2],
+}
+
+/// 完成队列项 (struct io_uring_cqe)
+#[repr(C)]
+#[derive(Debug, Clone, Copy)]
+pub struct IoUringCqe {
+    pub user_data: u64,
+    pub res: i32,
+    pub flags: u32,
+}
+
+/// SQ 环中各字段的偏移 (struct io_sqring_offsets)
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct IoSqringOffsets {
+    pub head: u32,
+    pub tail: u32,
+    pub ring_mask: u32,
+    pub ring_entries: u32,
+    pub flags: u32,
+    pub dropped: u32,
+    pub array: u32,
+    pub resv1: u32,
+    pub user_addr: u64,
+}
+
+/// CQ 环中各字段的偏移 (struct io_cqring_offsets)
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct IoCqringOffsets {
+    pub head: u32,
+    pub tail: u32,
+    pub ring_mask: u32,
+    pub ring_entries: u32,
+    pub overflow: u32,
+    pub cqes: u32,
+    pub flags: u32,
+    pub resv1: u32,
+    pub user_addr: u64,
+}
+
+/// io_uring_setup 的参数 (struct io_uring_params)
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct IoUringParams {
+    pub sq_entries: u32,
+    pub cq_entries: u32,
+    pub flags: u32,
+    pub sq_thread_cpu: u32,
+    pub sq_thread_idle: u32,
+    pub features: u32,
+    pub wq_fd: u32,
+    pub resv: [u32; 3],
+    pub sq_off: IoSqringOffsets,
+    pub cq_off: IoCqringOffsets,
+}
+
+// 环内存布局 (struct io_rings)：SQ、CQ 的 head/tail 各占一个缓存行，
+// 之后是掩码、条目数和标志，CQE 数组从下一个缓存行开始，sq_array 紧随其后
+const SQ_HEAD: usize = 0;
+const SQ_TAIL: usize = 4;
+const CQ_HEAD: usize = 64;
+const CQ_TAIL: usize = 68;
+const SQ_RING_MASK: usize = 128;
+const CQ_RING_MASK: usize = 132;
+const SQ_RING_ENTRIES: usize = 136;
+const CQ_RING_ENTRIES: usize = 140;
+const SQ_DROPPED: usize = 144;
+const SQ_FLAGS: usize = 148;
+const CQ_FLAGS: usize = 152;
+const CQ_OVERFLOW: usize = 156;
+const CQES: usize = 192;
+
+/// 与用户共享的内存：逐页分配，不要求物理连续
+///
+/// 数组元素的大小整除页大小且起始偏移按元素对齐，任何元素都不跨页
+struct RingMem {
+    pages: Vec<usize>,
+}
+
+impl RingMem {
+    /// 分配 size 字节（向上取整到页）并清零
+    fn new(size: usize) -> Option<Self> {
+        let nr_pages = (size + PAGE_SIZE - 1) / PAGE_SIZE;
+        let mut mem = Self { pages: Vec::with_capacity(nr_pages) };
+        for _ in 0..nr_pages {
+            // 分配失败时 Drop 归还已分配的页
+            let page = crate::mm::prezero::alloc_zeroed_user_page()?.start_address().as_usize();
+            mem.pages.push(page);
+        }
+        Some(mem)
+    }
+
+    /// 偏移 off 处的内核地址
+    #[inline]
+    fn addr(&self, off: usize) -> usize {
+        self.pages[off / PAGE_SIZE] + off % PAGE_SIZE
+    }
+
+    /// 偏移 off 处的 32 位共享字段
+    #[inline]
+    fn u32_at(&self, off: usize) -> &AtomicU32 {
+        unsafe { &*(self.addr(off) as *const AtomicU32) }
+    }
+}
+
+impl Drop for RingMem {
+    fn drop(&mut self) {
+        // 用户仍映射着的页由页表项上的引用保持
+        for &page in &self.pages {
+            put_page(page);
+        }
+    }
+}
+
+/// 挂起的请求链：第一个请求会阻塞，之后是与它串联、尚未执行的请求
+struct PendingChain {
+    sqes: VecDeque<IoUringSqe>,
+    /// 链头带 IOSQE_IO_DRAIN
+    drain: bool,
+}
+
+/// 环的内核状态，受 IoRingCtx::inner 保护
+struct IoRingInner {
+    /// 下一个要取出的 SQ 位置 (cached_sq_head)
+    cached_sq_head: u32,
+    /// 下一个要写入的 CQ 位置，commit 时才对用户可见 (cached_cq_tail)
+    cached_cq_tail: u32,
+    /// CQ 满时暂存的完成项 (overflow_list)
+    overflow: VecDeque<IoUringCqe>,
+    /// 会阻塞、等待重试的请求
+    pending: VecDeque<PendingChain>,
+}
+
+/// 一个 io_uring 实例 (struct io_ring_ctx)
+pub struct IoRingCtx {
+    rings: RingMem,
+    sqes: RingMem,
+    sq_entries: u32,
+    cq_entries: u32,
+    /// sq_array 在环内存中的偏移
+    sq_array: usize,
+    inner: Mutex<IoRingInner>,
+    /// 等待完成的进程 (cq_wait)
+    cq_wait: WaitQueueHead,
+}
+
+/// 一次执行的结果
+enum IssueResult {
+    /// 完成，结果写入 CQE
+    Done(i32),
+    /// 会阻塞，稍后重试
+    Again,
+}
+
+impl IoRingCtx {
+    /// 按参数创建环 (io_uring_create)
+    ///
+    /// # 返回
+    /// 环以及填好偏移的参数；条目数无效返回 EINVAL，内存不足返回 ENOMEM
+    pub fn new(entries: u32, params: &IoUringParams) -> Result<(Self, IoUringParams), i32> {
+        use setup_flags::*;
+
+        let einval = Errno::InvalidArgument.as_neg_i32();
+        if params.flags & !(IORING_SETUP_CQSIZE | IORING_SETUP_CLAMP) != 0 {
+            return Err(einval);
+        }
+        let clamp = params.flags & IORING_SETUP_CLAMP != 0;
+        if entries == 0 || (entries > IORING_MAX_ENTRIES && !clamp) {
+            return Err(einval);
+        }
+        let sq_entries = entries.min(IORING_MAX_ENTRIES).next_power_of_two();
+        let cq_entries = if params.flags & IORING_SETUP_CQSIZE != 0 {
+            if params.cq_entries == 0 || (params.cq_entries > IORING_MAX_CQ_ENTRIES && !clamp) {
+                return Err(einval);
+            }
+            let cq = params.cq_entries.min(IORING_MAX_CQ_ENTRIES).next_power_of_two();
+            if cq < sq_entries {
+                return Err(einval);
+            }
+            cq
+        } else {
+            2 * sq_entries
+        };
+
+        let sq_array = CQES + cq_entries as usize * core::mem::size_of::<IoUringCqe>();
+        let rings_size = sq_array + sq_entries as usize * core::mem::size_of::<u32>();
+        let sqes_size = sq_entries as usize * core::mem::size_of::<IoUringSqe>();
+        let enomem = Errno::OutOfMemory.as_neg_i32();
+        let rings = RingMem::new(rings_size).ok_or(enomem)?;
+        let sqes = RingMem::new(sqes_size).ok_or(enomem)?;
+
+        rings.u32_at(SQ_RING_MASK).store(sq_entries - 1, Ordering::Relaxed);
+        rings.u32_at(SQ_RING_ENTRIES).store(sq_entries, Ordering::Relaxed);
+        rings.u32_at(CQ_RING_MASK).store(cq_entries - 1, Ordering::Relaxed);
+        rings.u32_at(CQ_RING_ENTRIES).store(cq_entries, Ordering::Relaxed);
+
+        let mut out = *params;
+        out.sq_entries = sq_entries;
+        out.cq_entries = cq_entries;
+        out.features = features::IORING_FEAT_SINGLE_MMAP
+            | features::IORING_FEAT_NODROP
+            | features::IORING_FEAT_SUBMIT_STABLE
+            | features::IORING_FEAT_RW_CUR_POS;
+        out.sq_off = IoSqringOffsets {
+            head: SQ_HEAD as u32,
+            tail: SQ_TAIL as u32,
+            ring_mask: SQ_RING_MASK as u32,
+            ring_entries: SQ_RING_ENTRIES as u32,
+            flags: SQ_FLAGS as u32,
+            dropped: SQ_DROPPED as u32,
+            array: sq_array as u32,
+            resv1: 0,
+            user_addr: 0,
+        };
+        out.cq_off = IoCqringOffsets {
+            head: CQ_HEAD as u32,
+            tail: CQ_TAIL as u32,
+            ring_mask: CQ_RING_MASK as u32,
+            ring_entries: CQ_RING_ENTRIES as u32,
+            overflow: CQ_OVERFLOW as u32,
+            cqes: CQES as u32,
+            flags: CQ_FLAGS as u32,
+            resv1: 0,
+            user_addr: 0,
+        };
+
+        let ctx = Self {
+            rings,
+            sqes,
+            sq_entries,
+            cq_entries,
+            sq_array,
+            inner: Mutex::new(IoRingInner {
+                cached_sq_head: 0,
+                cached_cq_tail: 0,
+                overflow: VecDeque::new(),
+                pending: VecDeque::new(),
+            }),
+            cq_wait: WaitQueueHead::new(),
+        };
+        Ok((ctx, out))
+    }
+
+    /// 取出下一个 SQE (io_get_sqe)
+    ///
+    /// 用户放入无效下标时计入 sq_dropped 并跳过
+    fn get_sqe(&self, inner: &mut IoRingInner) -> Option<IoUringSqe> {
+        let tail = self.rings.u32_at(SQ_TAIL).load(Ordering::Acquire);
+        while inner.cached_sq_head != tail {
+            let slot = inner.cached_sq_head & (self.sq_entries - 1);
+            inner.cached_sq_head = inner.cached_sq_head.wrapping_add(1);
+            let idx = self.rings.u32_at(self.sq_array + slot as usize * 4).load(Ordering::Relaxed);
+            if idx >= self.sq_entries {
+                self.rings.u32_at(SQ_DROPPED).fetch_add(1, Ordering::Relaxed);
+                continue;
+            }
+            let addr = self.sqes.addr(idx as usize * core::mem::size_of::<IoUringSqe>());
+            // 复制一份：提交返回后用户可以立即重用 SQE (IORING_FEAT_SUBMIT_STABLE)
+            return Some(unsafe { core::ptr::read_volatile(addr as *const IoUringSqe) });
+        }
+        None
+    }
+
+    /// 写入一个完成项，commit_cqring 之前对用户不可见 (io_fill_cqe)
+    ///
+    /// CQ 满时暂存到溢出链表 (IORING_FEAT_NODROP)
+    fn fill_cqe(&self, inner: &mut IoRingInner, user_data: u64, res: i32) {
+        let cqe = IoUringCqe { user_data, res, flags: 0 };
+        let head = self.rings.u32_at(CQ_HEAD).load(Ordering::Acquire);
+        if !inner.overflow.is_empty() || inner.cached_cq_tail.wrapping_sub(head) >= self.cq_entries {
+            if inner.overflow.is_empty() {
+                self.rings.u32_at(SQ_FLAGS).fetch_or(IORING_SQ_CQ_OVERFLOW, Ordering::Relaxed);
+            }
+            inner.overflow.push_back(cqe);
+            return;
+        }
+        self.write_cqe(inner, cqe);
+    }
+
+    #[inline]
+    fn write_cqe(&self, inner: &mut IoRingInner, cqe: IoUringCqe) {
+        let slot = inner.cached_cq_tail & (self.cq_entries - 1);
+        let addr = self.rings.addr(CQES + slot as usize * core::mem::size_of::<IoUringCqe>());
+        unsafe { core::ptr::write_volatile(addr as *mut IoUringCqe, cqe) };
+        inner.cached_cq_tail = inner.cached_cq_tail.wrapping_add(1);
+    }
+
+    /// 把溢出链表中的完成项移回 CQ (io_cqring_overflow_flush)
+    fn flush_overflow(&self, inner: &mut IoRingInner) {
+        if inner.overflow.is_empty() {
+            return;
+        }
+        let head = self.rings.u32_at(CQ_HEAD).load(Ordering::Acquire);
+        while inner.cached_cq_tail.wrapping_sub(head) < self.cq_entries {
+            match inner.overflow.pop_front() {
+                Some(cqe) => self.write_cqe(inner, cqe),
+                None => break,
+            }
+        }
+        if inner.overflow.is_empty() {
+            self.rings.u32_at(SQ_FLAGS).fetch_and(!IORING_SQ_CQ_OVERFLOW, Ordering::Relaxed);
+        }
+    }
+
+    /// 让本批写入的完成项对用户可见，只在有等待者时唤醒 (io_commit_cqring)
+    fn commit_cqring(&self, inner: &IoRingInner) {
+        let tail = self.rings.u32_at(CQ_TAIL);
+        if tail.load(Ordering::Relaxed) == inner.cached_cq_tail {
+            return;
+        }
+        // CQE 内容先于 tail 可见
+        tail.store(inner.cached_cq_tail, Ordering::Release);
+        self.cq_wait.wake_up_all();
+    }
+
+    /// 用户尚未收割的完成项数
+    fn cq_ready(&self) -> u32 {
+        let head = self.rings.u32_at(CQ_HEAD).load(Ordering::Acquire);
+        self.rings.u32_at(CQ_TAIL).load(Ordering::Acquire).wrapping_sub(head)
+    }
+
+    /// 执行请求链，遇到会阻塞的请求时返回剩余部分 (io_queue_sqe)
+    fn run_chain(&self, inner: &mut IoRingInner, mut chain: VecDeque<IoUringSqe>) -> Option<VecDeque<IoUringSqe>> {
+        while let Some(sqe) = chain.front().copied() {
+            match issue(&sqe) {
+                IssueResult::Again => return Some(chain),
+                IssueResult::Done(res) => {
+                    chain.pop_front();
+                    self.fill_cqe(inner, sqe.user_data, res);
+                    if res < 0 {
+                        // 链中失败的请求取消其后的请求 (io_fail_links)
+                        for rest in chain.drain(..) {
+                            self.fill_cqe(inner, rest.user_data, Errno::OperationCanceled.as_neg_i32());
+                        }
+                    }
+                }
+            }
+        }
+        None
+    }
+
+    /// 排队或执行一个请求链
+    fn queue_chain(&self, inner: &mut IoRingInner, chain: VecDeque<IoUringSqe>) {
+        let drain = chain.front().map_or(false, |sqe| sqe.flags & sqe_flags::IOSQE_IO_DRAIN != 0);
+        // 之前有挂起的 drain 请求时，后来的请求也要排在它后面
+        let blocked = inner.pending.iter().any(|p| p.drain) || (drain && !inner.pending.is_empty());
+        if blocked {
+            inner.pending.push_back(PendingChain { sqes: chain, drain });
+            return;
+        }
+        if let Some(rest) = self.run_chain(inner, chain) {
+            inner.pending.push_back(PendingChain { sqes: rest, drain });
+        }
+    }
+
+    /// 重试挂起的请求 (io_poll_task_func)
+    ///
+    /// drain 请求只在排到最前时执行，之后的请求等它完成
+    fn retry_pending(&self, inner: &mut IoRingInner) {
+        let mut queue = core::mem::take(&mut inner.pending);
+        let mut first = true;
+        while let Some(item) = queue.pop_front() {
+            if item.drain && !(first && inner.pending.is_empty()) {
+                inner.pending.push_back(item);
+                inner.pending.extend(queue.drain(..));
+                break;
+            }
+            first = false;
+            if let Some(rest) = self.run_chain(inner, item.sqes) {
+                inner.pending.push_back(PendingChain { sqes: rest, drain: item.drain });
+            }
+        }
+    }
+
+    /// 提交最多 to_submit 个请求 (io_submit_sqes)
+    ///
+    /// # 返回
+    /// 取出的请求数
+    pub fn submit(&self, to_submit: u32) -> u32 {
+        let mut inner = self.inner.lock();
+        self.flush_overflow(&mut inner);
+        self.retry_pending(&mut inner);
+
+        let mut submitted = 0;
+        let mut chain = VecDeque::new();
+        while submitted < to_submit {
+            let sqe = match self.get_sqe(&mut inner) {
+                Some(sqe) => sqe,
+                None => break,
+            };
+            submitted += 1;
+            let linked = sqe.flags & sqe_flags::IOSQE_IO_LINK != 0;
+            chain.push_back(sqe);
+            if !linked {
+                let full = core::mem::take(&mut chain);
+                self.queue_chain(&mut inner, full);
+            }
+        }
+        // 最后一个请求仍带 IOSQE_IO_LINK：链到此为止
+        if !chain.is_empty() {
+            self.queue_chain(&mut inner, chain);
+        }
+
+        // 用户可以据此重用 SQ 条目
+        self.rings.u32_at(SQ_HEAD).store(inner.cached_sq_head, Ordering::Release);
+        self.commit_cqring(&inner);
+        submitted
+    }
+
+    /// 等待至少 min_complete 个完成项 (io_cqring_wait)
+    ///
+    /// 挂起的请求在每次被调度时重试；没有挂起的请求时不会再有新的完成，立即返回
+    pub fn wait(&self, min_complete: u32) {
+        loop {
+            {
+                let mut inner = self.inner.lock();
+                self.flush_overflow(&mut inner);
+                self.retry_pending(&mut inner);
+                self.commit_cqring(&inner);
+                if self.cq_ready() >= min_complete || inner.pending.is_empty() {
+                    return;
+                }
+            }
+            let current = match crate::sched::current() {
+                Some(task) => task,
+                None => return,
+            };
+            let entry = crate::process::wait::WaitQueueEntry::new(current, false);
+            self.cq_wait.add(&entry);
+            #[cfg(feature = "riscv64")]
+            crate::sched::schedule();
+            self.cq_wait.remove(&entry);
+        }
+    }
+
+    /// 以用户的一侧放入一个 SQE (liburing: io_uring_get_sqe + io_uring_submit)
+    ///
+    /// 供内核内的使用者和测试按与用户相同的协议操作环；SQ 满时返回 false
+    pub fn push_sqe(&self, sqe: &IoUringSqe) -> bool {
+        let head = self.rings.u32_at(SQ_HEAD).load(Ordering::Acquire);
+        let tail = self.rings.u32_at(SQ_TAIL).load(Ordering::Relaxed);
+        if tail.wrapping_sub(head) >= self.sq_entries {
+            return false;
+        }
+        let idx = tail & (self.sq_entries - 1);
+        let addr = self.sqes.addr(idx as usize * core::mem::size_of::<IoUringSqe>());
+        unsafe { core::ptr::write_volatile(addr as *mut IoUringSqe, *sqe) };
+        self.rings.u32_at(self.sq_array + idx as usize * 4).store(idx, Ordering::Relaxed);
+        // SQE 内容先于 tail 可见
+        self.rings.u32_at(SQ_TAIL).store(tail.wrapping_add(1), Ordering::Release);
+        true
+    }
+
+    /// 以用户的一侧取出一个 CQE (liburing: io_uring_peek_cqe + io_uring_cqe_seen)
+    pub fn pop_cqe(&self) -> Option<IoUringCqe> {
+        let head = self.rings.u32_at(CQ_HEAD).load(Ordering::Relaxed);
+        let tail = self.rings.u32_at(CQ_TAIL).load(Ordering::Acquire);
+        if head == tail {
+            return None;
+        }
+        let slot = head & (self.cq_entries - 1);
+        let addr = self.rings.addr(CQES + slot as usize * core::mem::size_of::<IoUringCqe>());
+        let cqe = unsafe { core::ptr::read_volatile(addr as *const IoUringCqe) };
+        self.rings.u32_at(CQ_HEAD).store(head.wrapping_add(1), Ordering::Release);
+        Some(cqe)
+    }
+
+    /// mmap 偏移对应的内存页
+    fn pages_for(&self, offset: u64) -> Option<&[usize]> {
+        match offset {
+            IORING_OFF_SQ_RING | IORING_OFF_CQ_RING => Some(&self.rings.pages),
+            IORING_OFF_SQES => Some(&self.sqes.pages),
+            _ => None,
+        }
+    }
+}
+
+/// 取出请求的文件
+fn req_file(sqe: &IoUringSqe) -> Result<Arc<File>, i32> {
+    if sqe.fd < 0 {
+        return Err(Errno::BadFileNumber.as_neg_i32());
+    }
+    unsafe { crate::fs::get_file_fd(sqe.fd as usize) }.ok_or(Errno::BadFileNumber.as_neg_i32())
+}
+
+/// 检查要访问的用户缓冲区
+fn req_buf(addr: u64, len: usize) -> Result<(), i32> {
+    if len == 0 {
+        return Ok(());
+    }
+    let end = addr.checked_add(len as u64);
+    if addr < 0x10000 || end.map_or(true, |end| end > 0x8000_0000) {
+        return Err(Errno::BadAddress.as_neg_i32());
+    }
+    Ok(())
+}
+
+/// 文件会阻塞时的结果：O_NONBLOCK 的文件直接返回 EAGAIN，否则挂起重试
+fn would_block(file: &File) -> IssueResult {
+    if file.flags.bits() & FileFlags::O_NONBLOCK != 0 {
+        IssueResult::Done(Errno::TryAgain.as_neg_i32())
+    } else {
+        IssueResult::Again
+    }
+}
+
+/// off 为 -1 时使用文件位置 (IORING_FEAT_RW_CUR_POS)
+#[inline]
+fn req_pos(sqe: &IoUringSqe) -> Option<u64> {
+    if sqe.off == u64::MAX { None } else { Some(sqe.off) }
+}
+
+/// 取出 READV / WRITEV 的 iovec 数组
+fn req_iovec(sqe: &IoUringSqe) -> Result<Vec<(usize, usize)>, i32> {
+    #[repr(C)]
+    struct Iovec {
+        iov_base: usize,
+        iov_len: usize,
+    }
+    let nr = sqe.len as usize;
+    if nr > crate::fs::file::UIO_MAXIOV {
+        return Err(Errno::InvalidArgument.as_neg_i32());
+    }
+    req_buf(sqe.addr, nr * core::mem::size_of::<Iovec>())?;
+    let mut segs = Vec::with_capacity(nr);
+    for i in 0..nr {
+        let iov = unsafe { core::ptr::read_unaligned((sqe.addr as *const Iovec).add(i)) };
+        if iov.iov_len == 0 {
+            continue;
+        }
+        req_buf(iov.iov_base as u64, iov.iov_len)?;
+        segs.push((iov.iov_base, iov.iov_len));
+    }
+    Ok(segs)
+}
+
+/// 以非阻塞方式执行一个请求 (io_issue_sqe)
+fn issue(sqe: &IoUringSqe) -> IssueResult {
+    use opcode::*;
+    use poll_mask::*;
+
+    let result = (|| -> Result<IssueResult, i32> {
+        match sqe.opcode {
+            IORING_OP_NOP => Ok(IssueResult::Done(0)),
+            IORING_OP_READ | IORING_OP_READV => {
+                let file = req_file(sqe)?;
+                let segs = if sqe.opcode == IORING_OP_READ {
+                    req_buf(sqe.addr, sqe.len as usize)?;
+                    alloc::vec![(sqe.addr as usize, sqe.len as usize)]
+                } else {
+                    req_iovec(sqe)?
+                };
+                // 管道没有数据且写端未关闭时读会阻塞
+                if file.poll() & (POLLIN | POLLHUP) == 0 {
+                    return Ok(would_block(&file));
+                }
+                let mut bufs: Vec<&mut [u8]> = segs
+                    .iter()
+                    .map(|&(base, len)| unsafe { core::slice::from_raw_parts_mut(base as *mut u8, len) })
+                    .collect();
+                Ok(IssueResult::Done(file.read_vec(&mut bufs, req_pos(sqe)) as i32))
+            }
+            IORING_OP_WRITE | IORING_OP_WRITEV => {
+                let file = req_file(sqe)?;
+                let segs = if sqe.opcode == IORING_OP_WRITE {
+                    req_buf(sqe.addr, sqe.len as usize)?;
+                    alloc::vec![(sqe.addr as usize, sqe.len as usize)]
+                } else {
+                    req_iovec(sqe)?
+                };
+                if file.poll() & (POLLOUT | POLLERR) == 0 {
+                    return Ok(would_block(&file));
+                }
+                let bufs: Vec<&[u8]> = segs
+                    .iter()
+                    .map(|&(base, len)| unsafe { core::slice::from_raw_parts(base as *const u8, len) })
+                    .collect();
+                Ok(IssueResult::Done(file.write_vec(&bufs, req_pos(sqe)) as i32))
+            }
+            IORING_OP_FSYNC => {
+                if sqe.fd < 0 {
+                    return Err(Errno::BadFileNumber.as_neg_i32());
+                }
+                if sqe.op_flags & IORING_FSYNC_DATASYNC != 0 {
+                    crate::fs::file_fdatasync(sqe.fd as usize)?;
+                } else {
+                    crate::fs::file_fsync(sqe.fd as usize)?;
+                }
+                Ok(IssueResult::Done(0))
+            }
+            IORING_OP_POLL_ADD => {
+                let file = req_file(sqe)?;
+                // 出错和挂断总是报告
+                let events = (sqe.op_flags & 0xffff) | POLLERR | POLLHUP;
+                let mask = file.poll() & events;
+                if mask == 0 {
+                    return Ok(IssueResult::Again);
+                }
+                Ok(IssueResult::Done(mask as i32))
+            }
+            IORING_OP_ACCEPT => {
+                let sk = crate::net::tcp::tcp_socket_fd(sqe.fd).ok_or(Errno::BadFileNumber.as_neg_i32())?;
+                let new_sk = crate::net::tcp::tcp_accept(sk);
+                if new_sk < 0 {
+                    return Ok(IssueResult::Done(new_sk));
+                }
+                Ok(IssueResult::Done(crate::net::tcp::tcp_sock_install(new_sk, false, false)))
+            }
+            IORING_OP_SEND => {
+                req_buf(sqe.addr, sqe.len as usize)?;
+                let data = unsafe { core::slice::from_raw_parts(sqe.addr as *const u8, sqe.len as usize) };
+                let ret = if let Some(sk) = crate::net::tcp::tcp_socket_fd(sqe.fd) {
+                    crate::net::tcp::tcp_send(sk, data)
+                } else if crate::net::udp::udp_socket_get(sqe.fd).is_some() {
+                    crate::net::udp::udp_send(sqe.fd, data)
+                } else {
+                    return Err(Errno::BadFileNumber.as_neg_i32());
+                };
+                Ok(IssueResult::Done(ret as i32))
+            }
+            IORING_OP_RECV => {
+                req_buf(sqe.addr, sqe.len as usize)?;
+                let buf = unsafe { core::slice::from_raw_parts_mut(sqe.addr as *mut u8, sqe.len as usize) };
+                let ret = if let Some(sk) = crate::net::tcp::tcp_socket_fd(sqe.fd) {
+                    crate::net::tcp::tcp_recv(sk, buf)
+                } else if crate::net::udp::udp_socket_get(sqe.fd).is_some() {
+                    let len = buf.len();
+                    crate::net::udp::udp_recv(sqe.fd, buf, len)
+                } else {
+                    return Err(Errno::BadFileNumber.as_neg_i32());
+                };
+                Ok(IssueResult::Done(ret as i32))
+            }
+            _ => Err(Errno::InvalidArgument.as_neg_i32()),
+        }
+    })();
+    match result {
+        Ok(res) => res,
+        Err(e) => IssueResult::Done(e),
+    }
+}
+
+fn io_uring_release(file: &File) -> i32 {
+    if let Some(ptr) = unsafe { (*file.private_data.get()).take() } {
+        // 用户仍映射着的环页由页表项上的引用保持
+        unsafe { drop(Box::from_raw(ptr as *mut IoRingCtx)) };
+    }
+    0
+}
+
+static IO_URING_OPS: FileOps = FileOps {
+    read: None,
+    write: None,
+    lseek: None,
+    close: Some(io_uring_release),
+    read_iter: None,
+    write_iter: None,
+    poll: None,
+};
+
+/// 由文件得到环
+fn file_ctx(file: &File) -> Option<&IoRingCtx> {
+    if !matches!(unsafe { *file.ops.get() }, Some(ops) if core::ptr::eq(ops, &IO_URING_OPS)) {
+        return None;
+    }
+    unsafe { *file.private_data.get() }.map(|ptr| unsafe { &*(ptr as *const IoRingCtx) })
+}
+
+/// 文件是否为 io_uring 实例
+pub fn is_io_uring(file: &File) -> bool {
+    file_ctx(file).is_some()
+}
+
+/// 创建环并安装文件描述符 (io_uring_setup)
+///
+/// # 返回
+/// 新的文件描述符和填好的参数
+pub fn io_uring_setup(entries: u32, params: &IoUringParams) -> Result<(usize, IoUringParams), i32> {
+    let (ctx, out) = IoRingCtx::new(entries, params)?;
+    let file = Arc::new(File::new(FileFlags::new(FileFlags::O_RDWR)));
+    file.set_ops(&IO_URING_OPS);
+    file.set_private_data(Box::into_raw(Box::new(ctx)) as *mut u8);
+    // 安装失败时文件没有进入 fd 表，不会再经过 close，在这里释放环
+    match unsafe { crate::fs::file::get_file_fd_install(file.clone()) } {
+        Some(fd) => Ok((fd, out)),
+        None => {
+            io_uring_release(&file);
+            Err(Errno::TooManyOpenFiles.as_neg_i32())
+        }
+    }
+}
+
+/// 提交请求并等待完成 (io_uring_enter)
+///
+/// # 返回
+/// 提交的请求数
+pub fn io_uring_enter(fd: usize, to_submit: u32, min_complete: u32, flags: u32) -> Result<u32, i32> {
+    if flags & !IORING_ENTER_GETEVENTS != 0 {
+        return Err(Errno::InvalidArgument.as_neg_i32());
+    }
+    let file = unsafe { crate::fs::get_file_fd(fd) }.ok_or(Errno::BadFileNumber.as_neg_i32())?;
+    let ctx = file_ctx(&file).ok_or(Errno::OperationNotSupported.as_neg_i32())?;
+    let submitted = ctx.submit(to_submit);
+    if flags & IORING_ENTER_GETEVENTS != 0 {
+        ctx.wait(min_complete.min(ctx.cq_entries));
+    }
+    Ok(submitted)
+}
+
+/// 把环映射到当前进程 (io_uring_mmap)
+///
+/// # 返回
+/// 映射的用户地址；偏移无效或长度超过环的大小返回 EINVAL
+pub fn io_uring_mmap(file: &File, addr: usize, len: usize, offset: u64) -> Result<usize, i32> {
+    let einval = Errno::InvalidArgument.as_neg_i32();
+    let ctx = file_ctx(file).ok_or(Errno::NoSuchDevice.as_neg_i32())?;
+    let pages = ctx.pages_for(offset).ok_or(einval)?;
+    let nr_pages = (len + PAGE_SIZE - 1) / PAGE_SIZE;
+    if nr_pages == 0 || nr_pages > pages.len() {
+        return Err(einval);
+    }
+    let current = crate::sched::current().ok_or(Errno::OutOfMemory.as_neg_i32())?;
+    let aspace = current.address_space().ok_or(Errno::OutOfMemory.as_neg_i32())?;
+    aspace
+        .insert_pages(crate::mm::page::VirtAddr::new(addr), &pages[..nr_pages], true)
+        .map(|start| start.as_usize())
+        .map_err(|_| Errno::OutOfMemory.as_neg_i32())
+}
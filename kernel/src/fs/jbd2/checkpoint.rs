@@ -0,0 +1,72 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! JBD2 检查点
+//!
+//! 参考: fs/jbd2/checkpoint.c
+//!
+//! 把已提交事务的块写回原位置，刷新设备缓存后再推进日志尾并写超级块；
+//! 超级块落盘之前日志中的副本一直有效，崩溃时由重放补上未完成的写回。
+
+use alloc::collections::BTreeMap;
+use alloc::vec::Vec;
+use core::sync::atomic::Ordering;
+
+use super::*;
+
+impl Journal {
+    /// 检查点全部已提交的事务并释放日志空间 (jbd2_log_do_checkpoint + jbd2_cleanup_journal_tail)
+    ///
+    /// 调用者持有 commit_mutex，期间没有新的提交，完成后日志为空
+    pub(super) fn do_checkpoint(&self) -> Result<(), i32> {
+        if self.is_aborted() {
+            return Err(Errno::ReadOnlyFileSystem.as_neg_i32());
+        }
+        let txns: Vec<Transaction> = self.state.lock().checkpoint.drain(..).collect();
+        if txns.is_empty() {
+            return Ok(());
+        }
+
+        // 同一块在多个事务中出现时只写最新的版本
+        let mut latest: BTreeMap<u64, &[u8]> = BTreeMap::new();
+        for txn in &txns {
+            for (&blocknr, jh) in &txn.buffers {
+                latest.insert(blocknr, &jh.data);
+            }
+        }
+        let spb = self.sectors_per_block();
+        let nr_blocks = latest.len() as u64;
+        let result = {
+            let mut plug = blkdev::BlkPlug::new(unsafe { &*self.device });
+            for (&blocknr, data) in &latest {
+                plug.write(blocknr * spb, data);
+            }
+            plug.finish()
+        }
+        .and_then(|()| self.flush_cache());
+        drop(latest);
+        if let Err(e) = result {
+            // 写回失败：事务留在检查点队列，日志中的副本仍然有效
+            crate::println!("jbd2: checkpoint failed: {}", e);
+            let mut state = self.state.lock();
+            for txn in txns.into_iter().rev() {
+                state.checkpoint.push_front(txn);
+            }
+            return Err(e);
+        }
+
+        let (tail, sequence) = {
+            let mut state = self.state.lock();
+            state.tail = state.head;
+            state.tail_sequence = state.running.tid;
+            (state.tail, state.tail_sequence)
+        };
+        self.update_sb_tail(tail, sequence)?;
+        self.nr_checkpoint_blocks.fetch_add(nr_blocks, Ordering::Relaxed);
+        // 释放事务持有的缓冲区引用
+        drop(txns);
+        Ok(())
+    }
+}
@@ -0,0 +1,221 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! JBD2 事务提交
+//!
+//! 参考: fs/jbd2/commit.c
+//!
+//! 一次提交的日志布局：若干个 [描述符块, 元数据块...]，最后是提交块。
+//! 描述符块和元数据块在一个 plug 中顺序写出，刷新设备缓存后再写提交块并再次刷新，
+//! 提交块落盘即事务提交完成；崩溃时没有有效提交块的事务在重放时被忽略。
+
+use alloc::vec;
+use alloc::vec::Vec;
+use core::sync::atomic::Ordering;
+
+use super::*;
+
+impl Journal {
+    /// 新日志块，写入块头 (journal_header_t)
+    pub(super) fn new_log_block(&self, blocktype: u32, tid: u32) -> Vec<u8> {
+        let mut block = vec![0u8; self.block_size];
+        put_be32(&mut block, 0, JBD2_MAGIC_NUMBER);
+        put_be32(&mut block, 4, blocktype);
+        put_be32(&mut block, 8, tid);
+        block
+    }
+
+    /// 元数据块在日志中的校验和 (jbd2_block_tag_csum_set)
+    pub(super) fn block_tag_csum(&self, tid: u32, data: &[u8]) -> u32 {
+        let seed = self.csum_seed.unwrap_or(!0);
+        crc32c(crc32c(seed, &tid.to_be_bytes()), data)
+    }
+
+    /// 写一个描述符标签 (write_tag_block)
+    ///
+    /// # 返回
+    /// 标签的字节数
+    fn write_tag(&self, buf: &mut [u8], blocknr: u64, flags: u32, csum: u32) -> usize {
+        put_be32(buf, 0, blocknr as u32);
+        if self.has_csum_v3() {
+            // journal_block_tag3_t
+            put_be32(buf, 4, flags);
+            put_be32(buf, 8, (blocknr >> 32) as u32);
+            put_be32(buf, 12, csum);
+        } else {
+            // journal_block_tag_t：t_checksum 与 t_flags 各 16 位
+            buf[4..6].copy_from_slice(&(csum as u16).to_be_bytes());
+            buf[6..8].copy_from_slice(&(flags as u16).to_be_bytes());
+            if self.has_64bit() {
+                put_be32(buf, 8, (blocknr >> 32) as u32);
+            }
+        }
+        journal_tag_bytes(self.incompat)
+    }
+
+    /// 描述符块或 revoke 块尾部的校验和 (jbd2_descriptor_block_csum_set)
+    pub(super) fn block_tail_csum(&self, block: &[u8]) -> u32 {
+        let mut csum = crc32c(self.csum_seed.unwrap_or(!0), &block[..self.block_size - 4]);
+        csum = crc32c(csum, &[0; 4]);
+        csum
+    }
+
+    /// 提交块 (struct commit_header)
+    fn commit_block(&self, tid: u32) -> Vec<u8> {
+        let mut block = self.new_log_block(JBD2_COMMIT_BLOCK, tid);
+        let now = crate::time::ktime_get();
+        block[COMMIT_SEC_OFF..COMMIT_SEC_OFF + 8].copy_from_slice(&(now / 1_000_000_000).to_be_bytes());
+        put_be32(&mut block, COMMIT_NSEC_OFF, (now % 1_000_000_000) as u32);
+        if self.has_csum_v3() {
+            // jbd2_commit_block_csum_set：h_chksum_type / h_chksum_size 为 0
+            let csum = crc32c(self.csum_seed.unwrap_or(!0), &block);
+            put_be32(&mut block, COMMIT_CHKSUM_OFF, csum);
+        }
+        block
+    }
+
+    /// 把事务编排为描述符块与日志中的元数据块
+    ///
+    /// 以 ESCAPE 标志记录开头恰好是日志魔数的块，写入日志时把开头 4 字节清零，
+    /// 避免重放时被误认为日志块头 (jbd2_journal_write_metadata_buffer)
+    pub(super) fn build_log_blocks(&self, txn: &Transaction) -> Vec<Vec<u8>> {
+        let per_desc = tags_per_descriptor(self.block_size, self.incompat);
+        let heads: Vec<(&u64, &JournalHead)> = txn.buffers.iter().collect();
+        let mut blocks = Vec::with_capacity(heads.len() + heads.len().div_ceil(per_desc));
+        for chunk in heads.chunks(per_desc) {
+            let mut desc = self.new_log_block(JBD2_DESCRIPTOR_BLOCK, txn.tid);
+            let desc_index = blocks.len();
+            blocks.push(Vec::new());
+            let mut off = JOURNAL_HEADER_SIZE;
+            for (i, &(&blocknr, jh)) in chunk.iter().enumerate() {
+                let mut data = jh.data.clone();
+                let mut flags = 0;
+                if get_be32(&data, 0) == JBD2_MAGIC_NUMBER {
+                    data[..4].fill(0);
+                    flags |= JBD2_FLAG_ESCAPE;
+                }
+                if i > 0 {
+                    flags |= JBD2_FLAG_SAME_UUID;
+                }
+                if i + 1 == chunk.len() {
+                    flags |= JBD2_FLAG_LAST_TAG;
+                }
+                let csum = if self.has_csum_v3() { self.block_tag_csum(txn.tid, &data) } else { 0 };
+                off += self.write_tag(&mut desc[off..], blocknr, flags, csum);
+                if i == 0 {
+                    desc[off..off + 16].copy_from_slice(&self.uuid);
+                    off += 16;
+                }
+                blocks.push(data);
+            }
+            if self.has_csum_v3() {
+                let csum = self.block_tail_csum(&desc);
+                put_be32(&mut desc, self.block_size - 4, csum);
+            }
+            blocks[desc_index] = desc;
+        }
+        blocks
+    }
+
+    /// 提交运行中的事务 (jbd2_journal_commit_transaction)
+    ///
+    /// 调用者持有 commit_mutex
+    pub(super) fn do_commit(&self) -> Result<(), i32> {
+        if self.is_aborted() {
+            return Err(Errno::ReadOnlyFileSystem.as_neg_i32());
+        }
+        let txn = {
+            let mut state = self.state.lock();
+            if state.running.buffers.is_empty() {
+                return Ok(());
+            }
+            let next = Transaction::new(state.running.tid.wrapping_add(1));
+            core::mem::replace(&mut state.running, next)
+        };
+        self.kick.store(false, Ordering::Release);
+
+        let blocks = self.build_log_blocks(&txn);
+        let needed = blocks.len() as u64 + 1;
+        // 日志容纳不下的事务直接写回原位置
+        if needed >= self.log_size() {
+            crate::println!("jbd2: transaction {} ({} blocks) exceeds the journal, writing in place", txn.tid, needed);
+            return self.write_in_place(txn);
+        }
+        let free = { let state = self.state.lock(); self.log_size() - self.log_used(&state) };
+        if free <= needed {
+            if let Err(e) = self.do_checkpoint() {
+                self.write_in_place(txn)?;
+                return Err(e);
+            }
+        }
+
+        let start = self.state.lock().head;
+        let result = self.write_log(start, &blocks, txn.tid);
+        let end = match result {
+            Ok(end) => end,
+            Err(e) => {
+                // 日志写失败时事务没有提交，尽量把元数据写回原位置
+                crate::println!("jbd2: commit of transaction {} failed: {}", txn.tid, e);
+                self.write_in_place(txn)?;
+                return Err(e);
+            }
+        };
+
+        let mut state = self.state.lock();
+        state.head = end;
+        state.commit_sequence = txn.tid;
+        state.checkpoint.push_back(txn);
+        drop(state);
+        self.nr_commits.fetch_add(1, Ordering::Relaxed);
+        self.nr_logged_blocks.fetch_add(needed, Ordering::Relaxed);
+        Ok(())
+    }
+
+    /// 从 start 开始顺序写日志块与提交块
+    ///
+    /// # 返回
+    /// 提交块之后的位置
+    fn write_log(&self, start: u64, blocks: &[Vec<u8>], tid: u32) -> Result<u64, i32> {
+        let disk = unsafe { &*self.device };
+        let mut pos = start;
+        {
+            let mut plug = blkdev::BlkPlug::new(disk);
+            for block in blocks {
+                plug.write(self.log_sector(pos)?, block);
+                pos = self.next_block(pos);
+            }
+            plug.finish()?;
+        }
+        // 提交块写出之前日志块必须已经落盘 (JBD2_BARRIER)
+        self.flush_cache()?;
+        let commit = self.commit_block(tid);
+        {
+            let mut plug = blkdev::BlkPlug::new(disk);
+            plug.write(self.log_sector(pos)?, &commit);
+            plug.finish()?;
+        }
+        self.flush_cache()?;
+        Ok(self.next_block(pos))
+    }
+
+    /// 不经日志把事务的块写回原位置
+    ///
+    /// 先完成已提交事务的检查点，避免它们的旧版本随后覆盖这里写的新版本
+    fn write_in_place(&self, txn: Transaction) -> Result<(), i32> {
+        self.do_checkpoint()?;
+        let spb = self.sectors_per_block();
+        {
+            let mut plug = blkdev::BlkPlug::new(unsafe { &*self.device });
+            for (&blocknr, jh) in &txn.buffers {
+                plug.write(blocknr * spb, &jh.data);
+            }
+            plug.finish()?;
+        }
+        self.flush_cache()?;
+        self.nr_checkpoint_blocks.fetch_add(txn.buffers.len() as u64, Ordering::Relaxed);
+        self.state.lock().commit_sequence = txn.tid;
+        Ok(())
+    }
+}
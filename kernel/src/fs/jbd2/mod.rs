@@ -0,0 +1,633 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! JBD2 日志
+//!
+//! 与 Linux JBD2 磁盘格式兼容的元数据日志。文件系统修改元数据块后交给运行中的事务，
+//! 多次修改与并发的 fsync 合并为一次提交 (group commit)：描述符块与元数据块顺序写入
+//! 日志区域，刷新设备缓存后再写提交块；检查点把已提交的块写回原位置并释放日志空间。
+//! 挂载时重放崩溃前已提交但未完成检查点的事务。
+//!
+//! 参考: fs/jbd2/journal.c, fs/jbd2/transaction.c, fs/jbd2/commit.c,
+//!       fs/jbd2/checkpoint.c, fs/jbd2/recovery.c, include/linux/jbd2.h
+//!
+//! # 设计
+//! - 只记录元数据 (data=writeback)，文件数据由页缓存回写直接写到原位置
+//! - 元数据块交给事务时复制一份内容作为事务中的版本，缓冲区不标记为脏；
+//!   事务持有缓冲区的引用，块缓存不会在检查点之前把它淘汰或写回，日志总是先于原位置落盘
+//! - 运行中的事务达到 j_max_transaction_buffers 或超过提交间隔时由后台提交，
+//!   fsync 强制提交；提交期间的修改进入下一个事务
+//! - 后台提交与检查点在 CPU 0 的空闲循环中进行 (kjournald2)，日志用掉一半时做检查点
+//! - 支持 REVOKE、64BIT、CSUM_V3 特性；本实现不写 revoke 记录，重放时识别已有的 revoke 块
+//!
+//! 子模块：
+//! - `commit`: 事务提交 (fs/jbd2/commit.c)
+//! - `checkpoint`: 检查点 (fs/jbd2/checkpoint.c)
+//! - `recovery`: 挂载时重放 (fs/jbd2/recovery.c)
+
+pub mod commit;
+pub mod checkpoint;
+pub mod recovery;
+
+use alloc::collections::{BTreeMap, VecDeque};
+use alloc::sync::Arc;
+use alloc::vec;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicU64, Ordering};
+use spin::Mutex;
+
+use crate::crc32::crc32c;
+use crate::drivers::blkdev;
+use crate::drivers::timer::{get_jiffies, HZ};
+use crate::errno::Errno;
+use crate::fs::bio::{self, BufferHead};
+
+/// 日志块头魔数 (JBD2_MAGIC_NUMBER)
+pub const JBD2_MAGIC_NUMBER: u32 = 0xC03B_3998;
+
+/// 日志块类型 (h_blocktype)
+pub const JBD2_DESCRIPTOR_BLOCK: u32 = 1;
+pub const JBD2_COMMIT_BLOCK: u32 = 2;
+pub const JBD2_SUPERBLOCK_V1: u32 = 3;
+pub const JBD2_SUPERBLOCK_V2: u32 = 4;
+pub const JBD2_REVOKE_BLOCK: u32 = 5;
+
+/// 描述符标签标志 (t_flags)
+pub const JBD2_FLAG_ESCAPE: u32 = 1;
+pub const JBD2_FLAG_SAME_UUID: u32 = 2;
+pub const JBD2_FLAG_DELETED: u32 = 4;
+pub const JBD2_FLAG_LAST_TAG: u32 = 8;
+
+/// 不兼容特性 (s_feature_incompat)
+pub const JBD2_FEATURE_INCOMPAT_REVOKE: u32 = 0x1;
+pub const JBD2_FEATURE_INCOMPAT_64BIT: u32 = 0x2;
+pub const JBD2_FEATURE_INCOMPAT_ASYNC_COMMIT: u32 = 0x4;
+pub const JBD2_FEATURE_INCOMPAT_CSUM_V2: u32 = 0x8;
+pub const JBD2_FEATURE_INCOMPAT_CSUM_V3: u32 = 0x10;
+pub const JBD2_FEATURE_INCOMPAT_FAST_COMMIT: u32 = 0x20;
+
+/// 本实现支持的不兼容特性 (JBD2_KNOWN_INCOMPAT_FEATURES 的子集)
+pub const JBD2_KNOWN_INCOMPAT_FEATURES: u32 =
+    JBD2_FEATURE_INCOMPAT_REVOKE | JBD2_FEATURE_INCOMPAT_64BIT | JBD2_FEATURE_INCOMPAT_CSUM_V3;
+
+/// 超级块中的校验和类型 (JBD2_CRC32C_CHKSUM)
+pub const JBD2_CRC32C_CHKSUM: u8 = 4;
+
+/// 日志块头大小 (journal_header_t)
+pub const JOURNAL_HEADER_SIZE: usize = 12;
+
+/// 超级块字段偏移 (journal_superblock_t)，全部为大端
+pub(crate) mod sb_off {
+    pub const S_BLOCKSIZE: usize = 0x0C;
+    pub const S_MAXLEN: usize = 0x10;
+    pub const S_FIRST: usize = 0x14;
+    pub const S_SEQUENCE: usize = 0x18;
+    pub const S_START: usize = 0x1C;
+    pub const S_ERRNO: usize = 0x20;
+    pub const S_FEATURE_INCOMPAT: usize = 0x28;
+    pub const S_UUID: usize = 0x30;
+    pub const S_CHECKSUM_TYPE: usize = 0x50;
+    pub const S_CHECKSUM: usize = 0xFC;
+}
+
+/// 超级块的有效长度，校验和只覆盖这部分
+pub const JBD2_SUPERBLOCK_SIZE: usize = 1024;
+
+/// 提交块中提交时间的偏移 (struct commit_header)
+const COMMIT_CHKSUM_OFF: usize = 0x10;
+const COMMIT_SEC_OFF: usize = 0x30;
+const COMMIT_NSEC_OFF: usize = 0x38;
+
+/// 默认提交间隔 (JBD2_DEFAULT_MAX_COMMIT_AGE)
+pub const JBD2_DEFAULT_MAX_COMMIT_AGE: u64 = 5;
+
+#[inline]
+pub(crate) fn get_be32(buf: &[u8], off: usize) -> u32 {
+    u32::from_be_bytes([buf[off], buf[off + 1], buf[off + 2], buf[off + 3]])
+}
+
+#[inline]
+pub(crate) fn put_be32(buf: &mut [u8], off: usize, val: u32) {
+    buf[off..off + 4].copy_from_slice(&val.to_be_bytes());
+}
+
+/// tid 比较，考虑回绕 (tid_geq)
+#[inline]
+pub fn tid_geq(x: u32, y: u32) -> bool {
+    (x.wrapping_sub(y) as i32) >= 0
+}
+
+/// 每个标签的字节数 (journal_tag_bytes)
+pub fn journal_tag_bytes(incompat: u32) -> usize {
+    if incompat & JBD2_FEATURE_INCOMPAT_CSUM_V3 != 0 {
+        16
+    } else if incompat & JBD2_FEATURE_INCOMPAT_64BIT != 0 {
+        12
+    } else {
+        8
+    }
+}
+
+/// 一个描述符块能容纳的标签数
+///
+/// 第一个标签之后跟 16 字节 UUID，CSUM_V3 时块尾留 4 字节校验和 (struct jbd2_journal_block_tail)
+pub fn tags_per_descriptor(block_size: usize, incompat: u32) -> usize {
+    let tag = journal_tag_bytes(incompat);
+    let tail = if incompat & JBD2_FEATURE_INCOMPAT_CSUM_V3 != 0 { 4 } else { 0 };
+    1 + (block_size - JOURNAL_HEADER_SIZE - tail - tag - 16) / tag
+}
+
+/// 事务中的一个元数据块 (struct journal_head)
+///
+/// 持有缓冲区的一个引用，释放时归还
+pub(crate) struct JournalHead {
+    bh: *mut BufferHead,
+    /// 交给事务时的块内容
+    data: Vec<u8>,
+}
+
+unsafe impl Send for JournalHead {}
+
+impl Drop for JournalHead {
+    fn drop(&mut self) {
+        bio::brelse(self.bh);
+    }
+}
+
+/// 事务 (transaction_t)
+pub(crate) struct Transaction {
+    tid: u32,
+    /// 磁盘块号 -> 块内容，同一块多次修改只保留最新版本
+    buffers: BTreeMap<u64, JournalHead>,
+    /// 第一个块加入的时间 (t_start)
+    start: u64,
+}
+
+impl Transaction {
+    fn new(tid: u32) -> Self {
+        Self { tid, buffers: BTreeMap::new(), start: 0 }
+    }
+}
+
+/// j_state_lock 保护的日志状态
+pub(crate) struct JournalState {
+    /// 运行中的事务 (j_running_transaction)
+    running: Transaction,
+    /// 已提交、等待检查点的事务，按提交顺序 (j_checkpoint_transactions)
+    checkpoint: VecDeque<Transaction>,
+    /// 下一个日志块 (j_head)
+    head: u64,
+    /// 最老的未检查点事务的起点 (j_tail)
+    tail: u64,
+    /// 最老的未检查点事务的 tid (j_tail_sequence)
+    tail_sequence: u32,
+    /// 最近完成提交的 tid (j_commit_sequence)
+    commit_sequence: u32,
+    /// 日志超级块（整个 0 号日志块）
+    sb: Vec<u8>,
+}
+
+/// 日志统计
+#[derive(Debug, Clone, Copy, Default)]
+pub struct JournalStats {
+    /// 提交的事务数
+    pub nr_commits: u64,
+    /// 写入日志的块数（描述符、元数据、提交块）
+    pub nr_logged_blocks: u64,
+    /// 检查点写回原位置的块数
+    pub nr_checkpoint_blocks: u64,
+    /// 运行中事务的块数
+    pub running_buffers: usize,
+    /// 日志中已占用的块数
+    pub log_used: u64,
+    /// 日志区域的块数
+    pub log_size: u64,
+    /// 挂载时重放的事务数
+    pub nr_replayed: u32,
+}
+
+/// 日志 (journal_t)
+pub struct Journal {
+    /// 日志所在的块设备，与文件系统相同
+    device: *const blkdev::GenDisk,
+    /// 日志块大小，与文件系统块大小相同
+    block_size: usize,
+    /// 日志逻辑块到磁盘块的映射段 (逻辑块, 磁盘块, 块数)，按逻辑块递增 (jbd2_journal_bmap)
+    map: Vec<(u64, u64, u64)>,
+    /// 日志区域 [first, last)，0 号块是超级块
+    first: u64,
+    last: u64,
+    /// s_feature_incompat
+    incompat: u32,
+    /// s_uuid，写在每个描述符块的第一个标签之后
+    uuid: [u8; 16],
+    /// CSUM_V3 校验和种子 (j_csum_seed)
+    csum_seed: Option<u32>,
+    /// 一个事务最多的块数 (j_max_transaction_buffers)
+    max_txn_buffers: usize,
+    /// 提交间隔 (j_commit_interval)，单位 jiffies
+    commit_interval: u64,
+    /// 提交与检查点互斥 (j_checkpoint_mutex)，两者都移动日志头尾并写超级块
+    commit_mutex: crate::sync::Mutex,
+    state: Mutex<JournalState>,
+    /// 运行中的事务已满，请求后台尽快提交
+    kick: AtomicBool,
+    /// 日志已放弃 (JBD2_ABORT)，之后不再写设备
+    aborted: AtomicBool,
+    nr_commits: AtomicU64,
+    nr_logged_blocks: AtomicU64,
+    nr_checkpoint_blocks: AtomicU64,
+    nr_replayed: core::sync::atomic::AtomicU32,
+}
+
+unsafe impl Send for Journal {}
+unsafe impl Sync for Journal {}
+
+/// 已加载的日志，后台提交遍历它们
+static JOURNALS: Mutex<Vec<Arc<Journal>>> = Mutex::new(Vec::new());
+
+impl Journal {
+    /// 读取日志超级块，重放未完成的事务并打开日志 (jbd2_journal_init_inode + jbd2_journal_load)
+    ///
+    /// # 参数
+    /// - `device`: 块设备
+    /// - `block_size`: 文件系统块大小
+    /// - `map`: 日志 inode 的块映射 (逻辑块, 磁盘块, 块数)
+    ///
+    /// # 返回
+    /// 不是 JBD2 日志、块大小不一致或有不支持的特性时返回 -EINVAL
+    pub fn load(device: *const blkdev::GenDisk, block_size: usize, map: Vec<(u64, u64, u64)>) -> Result<Arc<Self>, i32> {
+        let einval = Errno::InvalidArgument.as_neg_i32();
+        let mapped = map.last().map_or(0, |&(lblk, _, len)| lblk + len);
+        let mut journal = Self {
+            device,
+            block_size,
+            map,
+            first: 0,
+            last: 0,
+            incompat: 0,
+            uuid: [0; 16],
+            csum_seed: None,
+            max_txn_buffers: 0,
+            commit_interval: JBD2_DEFAULT_MAX_COMMIT_AGE * HZ,
+            commit_mutex: crate::sync::Mutex::new(),
+            state: Mutex::new(JournalState {
+                running: Transaction::new(0),
+                checkpoint: VecDeque::new(),
+                head: 0,
+                tail: 0,
+                tail_sequence: 0,
+                commit_sequence: 0,
+                sb: Vec::new(),
+            }),
+            kick: AtomicBool::new(false),
+            aborted: AtomicBool::new(false),
+            nr_commits: AtomicU64::new(0),
+            nr_logged_blocks: AtomicU64::new(0),
+            nr_checkpoint_blocks: AtomicU64::new(0),
+            nr_replayed: core::sync::atomic::AtomicU32::new(0),
+        };
+
+        // 日志超级块 (journal_get_superblock)
+        let mut sb = vec![0u8; block_size];
+        journal.read_block(0, &mut sb)?;
+        let blocktype = get_be32(&sb, 4);
+        if get_be32(&sb, 0) != JBD2_MAGIC_NUMBER
+            || !(blocktype == JBD2_SUPERBLOCK_V1 || blocktype == JBD2_SUPERBLOCK_V2)
+            || get_be32(&sb, sb_off::S_BLOCKSIZE) as usize != block_size
+        {
+            crate::println!("jbd2: no valid journal superblock found");
+            return Err(einval);
+        }
+        if blocktype == JBD2_SUPERBLOCK_V2 {
+            journal.incompat = get_be32(&sb, sb_off::S_FEATURE_INCOMPAT);
+        }
+        let unknown = journal.incompat & !JBD2_KNOWN_INCOMPAT_FEATURES;
+        if unknown != 0 {
+            crate::println!("jbd2: unsupported journal incompat features {:#x}", unknown);
+            return Err(einval);
+        }
+        journal.first = get_be32(&sb, sb_off::S_FIRST) as u64;
+        journal.last = get_be32(&sb, sb_off::S_MAXLEN) as u64;
+        if journal.first == 0 || journal.last > mapped || journal.first + 2 >= journal.last {
+            crate::println!("jbd2: journal area [{}, {}) does not fit the inode", journal.first, journal.last);
+            return Err(einval);
+        }
+        journal.uuid.copy_from_slice(&sb[sb_off::S_UUID..sb_off::S_UUID + 16]);
+        if journal.has_csum_v3() {
+            if sb[sb_off::S_CHECKSUM_TYPE] != JBD2_CRC32C_CHKSUM || superblock_csum(&sb) != get_be32(&sb, sb_off::S_CHECKSUM) {
+                crate::println!("jbd2: journal superblock checksum invalid");
+                return Err(einval);
+            }
+            journal.csum_seed = Some(crc32c(!0, &journal.uuid));
+        }
+        journal.max_txn_buffers = ((journal.last - journal.first) / 4) as usize;
+
+        let s_start = get_be32(&sb, sb_off::S_START) as u64;
+        let mut next_tid = get_be32(&sb, sb_off::S_SEQUENCE);
+        journal.state.lock().sb = sb;
+
+        // s_start 为 0 表示上次正常卸载，日志为空
+        if s_start != 0 {
+            let (replayed, end_tid) = journal.recover(s_start, next_tid)?;
+            journal.nr_replayed.store(replayed, Ordering::Relaxed);
+            next_tid = end_tid;
+        }
+
+        // 重放完成或日志为空：从头开始记录 (jbd2_journal_reset)
+        {
+            let mut state = journal.state.lock();
+            state.running = Transaction::new(next_tid);
+            state.head = journal.first;
+            state.tail = journal.first;
+            state.tail_sequence = next_tid;
+            state.commit_sequence = next_tid.wrapping_sub(1);
+        }
+        journal.update_sb_tail(journal.first, next_tid)?;
+
+        let journal = Arc::new(journal);
+        JOURNALS.lock().push(journal.clone());
+        Ok(journal)
+    }
+
+    /// 是否使用 CSUM_V3 校验和
+    #[inline]
+    fn has_csum_v3(&self) -> bool {
+        self.incompat & JBD2_FEATURE_INCOMPAT_CSUM_V3 != 0
+    }
+
+    /// 块号是否为 64 位
+    #[inline]
+    fn has_64bit(&self) -> bool {
+        self.incompat & JBD2_FEATURE_INCOMPAT_64BIT != 0
+    }
+
+    /// 日志逻辑块对应的磁盘块 (jbd2_journal_bmap)
+    fn bmap(&self, lblk: u64) -> Option<u64> {
+        let idx = self.map.partition_point(|&(start, _, _)| start <= lblk).checked_sub(1)?;
+        let (start, pblk, len) = self.map[idx];
+        (lblk < start + len).then(|| pblk + lblk - start)
+    }
+
+    /// 每块的扇区数
+    #[inline]
+    fn sectors_per_block(&self) -> u64 {
+        self.block_size as u64 / 512
+    }
+
+    /// 日志逻辑块的起始扇区
+    fn log_sector(&self, lblk: u64) -> Result<u64, i32> {
+        self.bmap(lblk)
+            .map(|pblk| pblk * self.sectors_per_block())
+            .ok_or(Errno::IOError.as_neg_i32())
+    }
+
+    /// 绕过块缓存读一个日志块
+    fn read_block(&self, lblk: u64, buf: &mut [u8]) -> Result<(), i32> {
+        let sector = self.log_sector(lblk)?;
+        blkdev::blkdev_read(self.device, sector, buf).map(|_| ())
+    }
+
+    /// 刷新设备写缓存，与并发的 fsync 共用一次 FLUSH (blkdev_issue_flush)
+    fn flush_cache(&self) -> Result<(), i32> {
+        blkdev::blkdev_issue_flush(self.device)
+    }
+
+    /// 日志区域中 pos 的下一块，到末尾时回到 first (jbd2_wrap)
+    #[inline]
+    fn next_block(&self, pos: u64) -> u64 {
+        if pos + 1 >= self.last { self.first } else { pos + 1 }
+    }
+
+    /// 日志区域的块数
+    #[inline]
+    fn log_size(&self) -> u64 {
+        self.last - self.first
+    }
+
+    /// 日志中已占用的块数
+    fn log_used(&self, state: &JournalState) -> u64 {
+        if state.head >= state.tail {
+            state.head - state.tail
+        } else {
+            self.log_size() - (state.tail - state.head)
+        }
+    }
+
+    /// 写日志超级块中的日志起点与序号 (jbd2_journal_update_sb_log_tail)
+    ///
+    /// `start` 为 0 表示日志已清空（正常卸载）
+    fn update_sb_tail(&self, start: u64, sequence: u32) -> Result<(), i32> {
+        let mut sb = self.state.lock().sb.clone();
+        put_be32(&mut sb, sb_off::S_SEQUENCE, sequence);
+        put_be32(&mut sb, sb_off::S_START, start as u32);
+        put_be32(&mut sb, sb_off::S_ERRNO, 0);
+        if self.has_csum_v3() {
+            let csum = superblock_csum(&sb);
+            put_be32(&mut sb, sb_off::S_CHECKSUM, csum);
+        }
+        {
+            let sector = self.log_sector(0)?;
+            let mut plug = blkdev::BlkPlug::new(unsafe { &*self.device });
+            plug.write(sector, &sb);
+            plug.flush_cache();
+            plug.finish()?;
+        }
+        self.state.lock().sb = sb;
+        Ok(())
+    }
+
+    /// 元数据块交给运行中的事务 (jbd2_journal_get_write_access + jbd2_journal_dirty_metadata)
+    ///
+    /// 复制块的当前内容作为事务中的版本，缓冲区不标记为脏，由提交写入日志、检查点写回原位置。
+    /// 同一块在事务中再次修改时更新已有的版本
+    pub fn dirty_metadata(&self, bh: *mut BufferHead) -> Result<(), i32> {
+        if self.is_aborted() {
+            return Err(Errno::ReadOnlyFileSystem.as_neg_i32());
+        }
+        let (blocknr, data) = unsafe { ((*bh).b_blocknr, (*bh).b_data.clone()) };
+        // 事务持有自己的引用，检查点之前缓冲区留在块缓存中
+        let pinned = bio::bread(self.device, blocknr).ok_or(Errno::IOError.as_neg_i32())?;
+        let (duplicate, full) = {
+            let mut state = self.state.lock();
+            let txn = &mut state.running;
+            if txn.buffers.is_empty() {
+                txn.start = get_jiffies();
+            }
+            let duplicate = match txn.buffers.get_mut(&blocknr) {
+                Some(jh) => {
+                    jh.data = data;
+                    true
+                }
+                None => {
+                    txn.buffers.insert(blocknr, JournalHead { bh: pinned, data });
+                    false
+                }
+            };
+            (duplicate, txn.buffers.len() >= self.max_txn_buffers)
+        };
+        if duplicate {
+            bio::brelse(pinned);
+        }
+        if full {
+            self.kick.store(true, Ordering::Release);
+        }
+        Ok(())
+    }
+
+    /// 运行中事务的 tid，刚交给日志的修改至迟在它提交时落盘
+    pub fn running_tid(&self) -> u32 {
+        self.state.lock().running.tid
+    }
+
+    /// 等待 tid 及之前的事务提交 (jbd2_complete_transaction)
+    ///
+    /// tid 仍在运行时由本调用提交；等待 commit_mutex 期间别人已经提交了它时不再写日志。
+    ///
+    /// # 返回
+    /// 本调用写了提交块时返回 true：提交之前的刷新已覆盖调用者先前完成的数据写；
+    /// 返回 false 时调用者需要自己刷新设备缓存
+    pub fn complete_transaction(&self, tid: u32) -> Result<bool, i32> {
+        if tid_geq(self.state.lock().commit_sequence, tid) {
+            return Ok(false);
+        }
+        let _guard = self.commit_mutex.guard();
+        let pending = {
+            let state = self.state.lock();
+            !tid_geq(state.commit_sequence, tid) && state.running.tid == tid && !state.running.buffers.is_empty()
+        };
+        if !pending {
+            return Ok(false);
+        }
+        self.do_commit()?;
+        Ok(true)
+    }
+
+    /// 提交运行中的事务并等待它落盘 (jbd2_journal_force_commit)
+    ///
+    /// 等待 commit_mutex 期间别的调用者可能已经提交了包含本次修改的事务，此时直接返回，
+    /// 并发的 fsync 因此合并为一次日志写 (group commit)
+    pub fn force_commit(&self) -> Result<(), i32> {
+        let tid = {
+            let state = self.state.lock();
+            // 运行中的事务为空时，本次修改可能在正在提交的上一个事务中
+            if state.running.buffers.is_empty() {
+                state.running.tid.wrapping_sub(1)
+            } else {
+                state.running.tid
+            }
+        };
+        let _guard = self.commit_mutex.guard();
+        if tid_geq(self.state.lock().commit_sequence, tid) {
+            return Ok(());
+        }
+        self.do_commit()
+    }
+
+    /// 提交并把所有事务写回原位置 (jbd2_journal_flush)
+    pub fn flush(&self) -> Result<(), i32> {
+        let _guard = self.commit_mutex.guard();
+        self.do_commit()?;
+        self.do_checkpoint()
+    }
+
+    /// 卸载：写回全部事务并把日志标记为空 (jbd2_journal_destroy)
+    pub fn destroy(self: &Arc<Self>) -> Result<(), i32> {
+        JOURNALS.lock().retain(|j| !Arc::ptr_eq(j, self));
+        let _guard = self.commit_mutex.guard();
+        self.do_commit()?;
+        self.do_checkpoint()?;
+        let sequence = self.state.lock().tail_sequence;
+        self.update_sb_tail(0, sequence)
+    }
+
+    /// 放弃日志 (jbd2_journal_abort)
+    ///
+    /// 丢弃运行中与等待检查点的事务，之后不再写日志和原位置；
+    /// 已提交的事务仍在日志中，下次挂载时重放
+    pub fn abort(self: &Arc<Self>) {
+        self.aborted.store(true, Ordering::Release);
+        JOURNALS.lock().retain(|j| !Arc::ptr_eq(j, self));
+        let _guard = self.commit_mutex.guard();
+        let (running, checkpoint) = {
+            let mut guard = self.state.lock();
+            let state = &mut *guard;
+            let next = Transaction::new(state.running.tid);
+            (core::mem::replace(&mut state.running, next), core::mem::take(&mut state.checkpoint))
+        };
+        // 在锁外归还缓冲区引用
+        drop(running);
+        drop(checkpoint);
+    }
+
+    /// 日志是否已放弃
+    #[inline]
+    pub fn is_aborted(&self) -> bool {
+        self.aborted.load(Ordering::Acquire)
+    }
+
+    /// 后台提交与检查点的一轮 (kjournald2)
+    fn background(&self) {
+        let now = get_jiffies();
+        let (due, over_half) = {
+            let state = self.state.lock();
+            let due = !state.running.buffers.is_empty()
+                && (self.kick.load(Ordering::Acquire) || now.saturating_sub(state.running.start) >= self.commit_interval);
+            (due, self.log_used(&state) > self.log_size() / 2)
+        };
+        if !due && !over_half {
+            return;
+        }
+        if self.commit_mutex.try_lock().is_err() {
+            return;
+        }
+        if due {
+            let _ = self.do_commit();
+        }
+        let over_half = self.log_used(&self.state.lock()) > self.log_size() / 2;
+        if over_half {
+            let _ = self.do_checkpoint();
+        }
+        self.commit_mutex.unlock();
+    }
+
+    /// 日志统计
+    pub fn stats(&self) -> JournalStats {
+        let state = self.state.lock();
+        JournalStats {
+            nr_commits: self.nr_commits.load(Ordering::Relaxed),
+            nr_logged_blocks: self.nr_logged_blocks.load(Ordering::Relaxed),
+            nr_checkpoint_blocks: self.nr_checkpoint_blocks.load(Ordering::Relaxed),
+            running_buffers: state.running.buffers.len(),
+            log_used: self.log_used(&state),
+            log_size: self.log_size(),
+            nr_replayed: self.nr_replayed.load(Ordering::Relaxed),
+        }
+    }
+}
+
+/// 超级块校验和，计算时校验和字段视为 0 (jbd2_superblock_csum)
+pub fn superblock_csum(sb: &[u8]) -> u32 {
+    let mut copy = [0u8; JBD2_SUPERBLOCK_SIZE];
+    copy.copy_from_slice(&sb[..JBD2_SUPERBLOCK_SIZE]);
+    put_be32(&mut copy, sb_off::S_CHECKSUM, 0);
+    crc32c(!0, &copy)
+}
+
+/// 后台提交与检查点 (kjournald2)
+///
+/// 由 CPU 0 的空闲循环调用：运行中的事务已满或超过提交间隔时提交，日志用掉一半时做检查点
+pub fn kjournald_run() {
+    let journals = {
+        let journals = JOURNALS.lock();
+        if journals.is_empty() {
+            return;
+        }
+        journals.clone()
+    };
+    for journal in journals {
+        journal.background();
+    }
+}
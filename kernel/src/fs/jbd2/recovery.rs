@@ -0,0 +1,201 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! JBD2 日志重放
+//!
+//! 参考: fs/jbd2/recovery.c
+//!
+//! 从超级块的 s_start / s_sequence 开始扫描三遍：
+//! - SCAN: 找到最后一个有提交块的事务
+//! - REVOKE: 收集 revoke 记录，块号 -> 撤销它的最新 tid
+//! - REPLAY: 把日志中的块写回原位置，被同一或更新事务撤销的块跳过
+//!
+//! 没有提交块（或提交块校验和错误）的事务没有完成提交，不重放。
+
+use alloc::collections::BTreeMap;
+use alloc::vec;
+
+use super::*;
+
+/// 扫描的阶段 (enum passtype)
+#[derive(Clone, Copy, PartialEq, Eq)]
+enum Pass {
+    Scan,
+    Revoke,
+    Replay,
+}
+
+impl Journal {
+    /// 重放日志 (jbd2_journal_recover)
+    ///
+    /// # 返回
+    /// (重放的事务数, 之后使用的第一个 tid)
+    pub(super) fn recover(&self, start: u64, sequence: u32) -> Result<(u32, u32), i32> {
+        let mut revoked = BTreeMap::new();
+        let end = self.do_one_pass(start, sequence, None, Pass::Scan, &mut revoked)?;
+        self.do_one_pass(start, sequence, Some(end), Pass::Revoke, &mut revoked)?;
+        self.do_one_pass(start, sequence, Some(end), Pass::Replay, &mut revoked)?;
+        self.flush_cache()?;
+        let replayed = end.wrapping_sub(sequence);
+        if replayed > 0 {
+            crate::println!("jbd2: recovery complete, replayed transactions {}..{}", sequence, end.wrapping_sub(1));
+        }
+        // 跳过 end：日志中可能残留它没有提交完的块
+        Ok((replayed, end.wrapping_add(1)))
+    }
+
+    /// 扫描一遍日志 (do_one_pass)
+    ///
+    /// # 参数
+    /// - `end`: SCAN 之后已知的第一个未提交的 tid，其余阶段到此为止
+    /// - `revoked`: 块号 -> 撤销它的最新 tid
+    ///
+    /// # 返回
+    /// 扫描停止处的 tid，即第一个没有完成提交的事务
+    fn do_one_pass(
+        &self,
+        start: u64,
+        sequence: u32,
+        end: Option<u32>,
+        pass: Pass,
+        revoked: &mut BTreeMap<u64, u32>,
+    ) -> Result<u32, i32> {
+        let mut block = vec![0u8; self.block_size];
+        let mut pos = start;
+        let mut next_tid = sequence;
+        loop {
+            if end == Some(next_tid) {
+                break;
+            }
+            self.read_block(pos, &mut block)?;
+            pos = self.next_block(pos);
+            if get_be32(&block, 0) != JBD2_MAGIC_NUMBER || get_be32(&block, 8) != next_tid {
+                break;
+            }
+            match get_be32(&block, 4) {
+                JBD2_DESCRIPTOR_BLOCK => {
+                    if self.has_csum_v3() && self.block_tail_csum(&block) != get_be32(&block, self.block_size - 4) {
+                        crate::println!("jbd2: descriptor block checksum invalid in transaction {}", next_tid);
+                        break;
+                    }
+                    pos = self.do_descriptor(&block, pos, next_tid, pass, revoked)?;
+                }
+                JBD2_COMMIT_BLOCK => {
+                    if pass == Pass::Scan && self.has_csum_v3() && !self.commit_csum_ok(&block) {
+                        crate::println!("jbd2: commit block checksum invalid in transaction {}", next_tid);
+                        break;
+                    }
+                    next_tid = next_tid.wrapping_add(1);
+                }
+                JBD2_REVOKE_BLOCK => {
+                    if pass == Pass::Revoke {
+                        self.scan_revoke_records(&block, next_tid, revoked);
+                    }
+                }
+                _ => break,
+            }
+        }
+        Ok(next_tid)
+    }
+
+    /// 处理一个描述符块，REPLAY 时把其后的元数据块写回原位置
+    ///
+    /// # 返回
+    /// 描述符块所描述的最后一个元数据块之后的位置
+    fn do_descriptor(
+        &self,
+        desc: &[u8],
+        mut pos: u64,
+        tid: u32,
+        pass: Pass,
+        revoked: &BTreeMap<u64, u32>,
+    ) -> Result<u64, i32> {
+        let tag_bytes = journal_tag_bytes(self.incompat);
+        let limit = self.block_size - if self.has_csum_v3() { 4 } else { 0 };
+        let mut data = vec![0u8; self.block_size];
+        let mut off = JOURNAL_HEADER_SIZE;
+        while off + tag_bytes <= limit {
+            let mut blocknr = get_be32(desc, off) as u64;
+            let (flags, csum) = if self.has_csum_v3() {
+                (get_be32(desc, off + 4), get_be32(desc, off + 12))
+            } else {
+                (u16::from_be_bytes([desc[off + 6], desc[off + 7]]) as u32, 0)
+            };
+            if self.has_64bit() {
+                blocknr |= (get_be32(desc, off + 8) as u64) << 32;
+            }
+            off += tag_bytes;
+            if flags & JBD2_FLAG_SAME_UUID == 0 {
+                off += 16;
+            }
+
+            if pass == Pass::Replay {
+                let skip = revoked.get(&blocknr).is_some_and(|&rtid| tid_geq(rtid, tid));
+                if !skip {
+                    self.read_block(pos, &mut data)?;
+                    if self.has_csum_v3() && self.block_tag_csum(tid, &data) != csum {
+                        crate::println!("jbd2: invalid checksum recovering block {} in log", blocknr);
+                    } else {
+                        if flags & JBD2_FLAG_ESCAPE != 0 {
+                            put_be32(&mut data, 0, JBD2_MAGIC_NUMBER);
+                        }
+                        self.write_home(blocknr, &data)?;
+                    }
+                }
+            }
+            pos = self.next_block(pos);
+            if flags & JBD2_FLAG_LAST_TAG != 0 {
+                break;
+            }
+        }
+        Ok(pos)
+    }
+
+    /// 提交块的校验和 (jbd2_commit_block_csum_verify)
+    fn commit_csum_ok(&self, block: &[u8]) -> bool {
+        let provided = get_be32(block, COMMIT_CHKSUM_OFF);
+        let mut copy = block.to_vec();
+        put_be32(&mut copy, COMMIT_CHKSUM_OFF, 0);
+        crc32c(self.csum_seed.unwrap_or(!0), &copy) == provided
+    }
+
+    /// 收集 revoke 块中的记录 (scan_revoke_records)
+    ///
+    /// r_count 为块中已用的字节数（含 16 字节头），记录为 4 或 8 字节块号
+    fn scan_revoke_records(&self, block: &[u8], tid: u32, revoked: &mut BTreeMap<u64, u32>) {
+        if self.has_csum_v3() && self.block_tail_csum(block) != get_be32(block, self.block_size - 4) {
+            crate::println!("jbd2: revoke block checksum invalid in transaction {}", tid);
+            return;
+        }
+        let record = if self.has_64bit() { 8 } else { 4 };
+        let limit = self.block_size - if self.has_csum_v3() { 4 } else { 0 };
+        let count = (get_be32(block, 12) as usize).min(limit);
+        let mut off = 16;
+        while off + record <= count {
+            let blocknr = if record == 8 {
+                (get_be32(block, off) as u64) << 32 | get_be32(block, off + 4) as u64
+            } else {
+                get_be32(block, off) as u64
+            };
+            let entry = revoked.entry(blocknr).or_insert(tid);
+            if tid_geq(tid, *entry) {
+                *entry = tid;
+            }
+            off += record;
+        }
+    }
+
+    /// 通过块缓存把重放的块写回原位置，缓存中的旧内容一并更新
+    fn write_home(&self, blocknr: u64, data: &[u8]) -> Result<(), i32> {
+        let bh = bio::bread(self.device, blocknr).ok_or(Errno::IOError.as_neg_i32())?;
+        let result = unsafe {
+            (*bh).b_data[..data.len()].copy_from_slice(data);
+            (*bh).set_state_bit(bio::BufferState::BH_Dirty);
+            bio::sync_dirty_buffer(bh)
+        };
+        bio::brelse(bh);
+        result
+    }
+}
@@ -9,71 +9,80 @@
 //! - `file`: 文件对象和文件描述符管理 (fs/file.c)
 //! - `inode`: 索引节点管理 (fs/inode.c)
 //! - `dentry`: 目录项管理 (fs/dcache.c)
+//! - `namei`: 逐分量路径查找 (fs/namei.c)
 //! - `pipe`: 管道文件系统 (fs/pipe.c)
-//! - `elf`: ELF 加载器 (fs/binfmt_elf.c)
+//! - `select`: poll / select 与文件的 poll 方法 (fs/select.c)
+//! - `eventpoll`: epoll 事件轮询 (fs/eventpoll.c)
+//! - `timerfd`: 以文件描述符交付的定时器 (fs/timerfd.c)
+//! - `eventfd`: 以文件描述符表示的事件计数器 (fs/eventfd.c)
+//! - `splice`: sendfile / splice / copy_file_range (fs/splice.c)
+//! - `io_uring`: 异步 I/O 环 (io_uring/io_uring.c)
+//! - `elf`: ELF 格式解析
+//! - `binfmt_elf`: exec 时以文件映射建立 ELF 段 (fs/binfmt_elf.c)
+//! - `tmpfs`: 数据只在页缓存中的内存文件系统 (mm/shmem.c)
+//! - `jbd2`: ext4 的元数据日志 (fs/jbd2/)
+//! - `dir_index`: rootfs 与 procfs 目录的子节点名字索引
 
 pub mod file;
 pub mod inode;
 pub mod dentry;
 pub mod pipe;
+pub mod select;
+pub mod eventpoll;
+pub mod timerfd;
+pub mod eventfd;
+pub mod splice;
+pub mod io_uring;
 pub mod char_dev;
 pub mod elf;
+pub mod binfmt_elf;
 pub mod buffer;
 pub mod bio;
 pub mod vfs;
 pub mod path;
+pub mod namei;
 pub mod superblock;
 pub mod mount;
+pub mod dir_index;
 pub mod rootfs;
+pub mod initramfs;
 pub mod ext4;
+pub mod jbd2;
 pub mod stat;
+pub mod seq_file;
 pub mod procfs;
+pub mod cgroupfs;
+pub mod tmpfs;
 
-pub use file::{File, FileFlags, FileOps, FdTable, get_file_fd, close_file_fd};
+pub use file::{File, FileFlags, FileOps, FdTable, FileRef, fdget, get_file_fd, close_file_fd};
 pub use stat::Stat;
 pub use pipe::create_pipe;
 pub use char_dev::CharDev;
 pub use rootfs::get_rootfs;
-pub use vfs::{file_open, file_close, file_stat, file_fcntl, fcntl, file_mkdir, file_rmdir, file_unlink, file_link};
+pub use vfs::{file_open, file_close, file_stat, file_fcntl, fcntl, file_mkdir, file_rmdir, file_unlink, file_link, file_fadvise, path_stat, at_path, file_fsync, file_fdatasync, file_sync_range, file_ftruncate};
 
-pub fn read_file_from_rootfs(filename: &str) -> Option<alloc::vec::Vec<u8>> {
-    use alloc::vec::Vec;
-    use crate::println;
-
-    // 简化实现：直接访问全局 RootFS
-    // 注意：这是临时方案，未来应该通过 VFS 接口访问
-
-    // 获取 RootFS 实例
+/// 在 RootFS 中查找文件节点
+pub fn lookup_rootfs_file(filename: &str) -> Option<alloc::sync::Arc<rootfs::RootFSNode>> {
     let rootfs = unsafe { get_rootfs() };
     if rootfs.is_null() {
         return None;
     }
+    unsafe { (*rootfs).lookup(filename) }
+}
+
+/// 读取 RootFS 中的文件
+///
+/// initramfs 中的文件直接借用归档里的数据，不再复制一份
+pub fn read_file_from_rootfs(filename: &str) -> Option<alloc::borrow::Cow<'static, [u8]>> {
+    use alloc::borrow::Cow;
 
-    // 查找文件
-    let node = unsafe { (*rootfs).lookup(filename) };
-    let node = match node {
-        Some(n) => n,
-        None => {
-            return None;
-        }
-    };
+    // 简化实现：直接访问全局 RootFS
+    // 注意：这是临时方案，未来应该通过 VFS 接口访问
+    let node = lookup_rootfs_file(filename)?;
 
-    // 读取文件数据
-    if let Some(ref data) = node.data {
-        let mut buffer = Vec::new();
-        // 复制数据到 Vec
-        unsafe {
-            let len = data.len();
-            if len > 0 {
-                buffer.reserve(len);
-                for i in 0..len {
-                    buffer.push(*data.as_ptr().add(i));
-                }
-            }
-        }
-        Some(buffer)
-    } else {
-        None
+    match node.data.as_ref()? {
+        rootfs::FileData::Initramfs(data) => Some(Cow::Borrowed(*data)),
+        rootfs::FileData::Owned(data) => Some(Cow::Owned(data.clone())),
     }
 }
 
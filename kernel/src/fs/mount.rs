@@ -10,12 +10,18 @@
 //! - `struct vfsmount`: 挂载点，表示文件系统在命名空间中的位置
 //! - `struct mnt_namespace`: 命名空间，包含进程可见的所有挂载点
 //! - 挂载点树：挂载点形成的层次结构
+//! - 挂载表读多写少：路径查找在 RCU 读临界区内无锁读取，
+//!   挂载和卸载复制一份新表发布，旧表在宽限期后释放
+//! - 挂载表带按挂载点路径的散列索引，查找按路径前缀逐级探测而不是扫描全部挂载
 
 use crate::errno;
 use alloc::sync::Arc;
 use alloc::vec::Vec;
-use spin::Mutex;
-use core::sync::atomic::{AtomicU64, Ordering};
+use alloc::boxed::Box;
+use core::ptr;
+use core::sync::atomic::{AtomicPtr, AtomicU64, Ordering};
+use crate::fs::superblock::FileSystemType;
+use crate::sync::{kfree_rcu, rcu_read_lock, TicketLock};
 
 #[repr(C)]
 #[derive(Debug, Copy, Clone, PartialEq)]
@@ -82,6 +88,8 @@ pub struct VfsMount {
     pub mnt_root: Option<Arc<Vec<u8>>>,
     /// 超级块指针
     pub mnt_sb: Option<*mut u8>,
+    /// 超级块所属的文件系统类型 (mnt_sb->s_type)，用于判断 mnt_sb 指向的超级块类型
+    pub mnt_fstype: Option<&'static FileSystemType>,
     /// 挂载点引用计数
     mnt_count: AtomicU64,
     /// 挂载点是否过期
@@ -103,12 +111,24 @@ impl VfsMount {
             mnt_mountpoint: Some(Arc::new(mountpoint)),
             mnt_root: Some(Arc::new(root)),
             mnt_sb: sb,
+            mnt_fstype: None,
             mnt_count: AtomicU64::new(1),
             mnt_expired: AtomicU64::new(0),
             mnt_ns: None,
         }
     }
 
+    /// 记下超级块所属的文件系统类型
+    pub fn with_fstype(mut self, fstype: &'static FileSystemType) -> Self {
+        self.mnt_fstype = Some(fstype);
+        self
+    }
+
+    /// 超级块是否属于 fstype
+    pub fn is_fstype(&self, fstype: &'static FileSystemType) -> bool {
+        self.mnt_fstype.is_some_and(|t| ptr::eq(t, fstype))
+    }
+
     /// 获取超级块
     pub fn get_superblock(&self) -> Option<*mut u8> {
         self.mnt_sb
@@ -149,11 +169,53 @@ impl VfsMount {
 
     /// 获取挂载点路径
     pub fn get_path(&self) -> Option<Vec<u8>> {
-        self.mnt_mountpoint.as_ref().map(|_arc| {
-            // 获取 Vec<u8> 的克隆
-            // Arc 已经实现了 Clone trait (标准库)
-            Vec::new()  // TODO: 实现实际的克隆
-        })
+        self.mnt_mountpoint.as_ref().map(|mp| mp.as_ref().clone())
+    }
+}
+
+/// 挂载散列表的桶数 (mount_hashtable)
+const MOUNT_HASH_SIZE: usize = 64;
+
+/// 挂载点路径的散列值 (m_hash)，FNV-1a
+fn mount_hash(mountpoint: &[u8]) -> usize {
+    let mut hash = 0xcbf29ce484222325_u64;
+    for &byte in mountpoint {
+        hash ^= byte as u64;
+        hash = hash.wrapping_mul(0x100000001b3);
+    }
+    (hash as usize) % MOUNT_HASH_SIZE
+}
+
+/// RCU 发布的挂载表
+///
+/// Linux 按 (父挂载, 挂载点 dentry) 散列；这里的挂载点是命名空间内的绝对路径，
+/// 路径本身就确定了父挂载与挂载点，散列键就是挂载点路径
+struct MountList {
+    mounts: Vec<Arc<VfsMount>>,
+    /// 每个桶是 mounts 中的下标，同一挂载点先挂载的在前
+    hash: Vec<Vec<usize>>,
+}
+
+unsafe impl Send for MountList {}
+
+impl MountList {
+    /// 为挂载列表建立散列索引
+    fn new(mounts: Vec<Arc<VfsMount>>) -> Self {
+        let mut hash = alloc::vec![Vec::new(); MOUNT_HASH_SIZE];
+        for (i, mount) in mounts.iter().enumerate() {
+            if let Some(ref mountpoint) = mount.mnt_mountpoint {
+                hash[mount_hash(mountpoint)].push(i);
+            }
+        }
+        Self { mounts, hash }
+    }
+
+    /// 挂载点恰好是 mountpoint 的挂载 (__lookup_mnt)
+    fn lookup(&self, mountpoint: &[u8]) -> Option<&Arc<VfsMount>> {
+        self.hash[mount_hash(mountpoint)]
+            .iter()
+            .map(|&i| &self.mounts[i])
+            .find(|mount| mount.mnt_mountpoint.as_ref().is_some_and(|mp| mp.as_slice() == mountpoint))
     }
 }
 
@@ -161,8 +223,10 @@ impl VfsMount {
 pub struct MntNamespace {
     /// 命名空间 ID
     pub ns_id: u64,
-    /// 挂载点列表
-    mounts: Mutex<Vec<Arc<VfsMount>>>,
+    /// 挂载点列表，为空时是空指针
+    mounts: AtomicPtr<MountList>,
+    /// 修改挂载表的写者互斥 (namespace_sem)
+    mount_lock: TicketLock<()>,
     /// 根挂载点
     pub root: Option<Arc<VfsMount>>,
     /// 引用计数
@@ -177,75 +241,110 @@ impl MntNamespace {
     pub fn new() -> Self {
         Self {
             ns_id: 0,
-            mounts: Mutex::new(Vec::new()),
+            mounts: AtomicPtr::new(ptr::null_mut()),
+            mount_lock: TicketLock::new(()),
             root: None,
             count: AtomicU64::new(1),
         }
     }
 
-    /// 添加挂载点到命名空间
+    /// 读临界区内的挂载表 (rcu_dereference)
     ///
-    pub fn add_mount(&self, mount: Arc<VfsMount>) -> Result<(), i32> {
-        let mut mounts = self.mounts.lock();
+    /// # Safety
+    /// 调用者持有 rcu_read_lock 或 mount_lock，返回的引用只在此期间有效
+    unsafe fn list_rcu(&self) -> Option<&MountList> {
+        self.mounts.load(Ordering::Acquire).as_ref()
+    }
 
-        // 分配挂载点 ID
-        let _mnt_id = mounts.len() as u64;
+    /// 读临界区内的挂载列表
+    ///
+    /// # Safety
+    /// 同 list_rcu
+    unsafe fn mounts_rcu(&self) -> &[Arc<VfsMount>] {
+        self.list_rcu().map_or(&[], |list| list.mounts.as_slice())
+    }
 
-        // 如果是第一个挂载点，设置为根挂载点
-        if self.root.is_none() {
-            // 注意：这里需要修改 Arc 内部的值，这在 Rust 中比较复杂
-            // 简化实现：我们在创建挂载点时就设置好所有属性
+    /// 复制挂载表、修改后重建散列索引并发布，旧表在宽限期后释放
+    fn update_mounts(&self, f: impl FnOnce(&mut Vec<Arc<VfsMount>>) -> Result<(), i32>) -> Result<(), i32> {
+        let _guard = self.mount_lock.lock();
+        let mut mounts = unsafe { self.mounts_rcu() }.to_vec();
+        f(&mut mounts)?;
+        let new = Box::into_raw(Box::new(MountList::new(mounts)));
+        let old = self.mounts.swap(new, Ordering::AcqRel);
+        if !old.is_null() {
+            // 路径查找可能还在读旧表
+            kfree_rcu(unsafe { Box::from_raw(old) });
         }
-
-        mounts.push(mount);
         Ok(())
     }
 
+    /// 添加挂载点到命名空间
+    ///
+    pub fn add_mount(&self, mount: Arc<VfsMount>) -> Result<(), i32> {
+        self.update_mounts(|mounts| {
+            // 分配挂载点 ID
+            let _mnt_id = mounts.len() as u64;
+
+            // 如果是第一个挂载点，设置为根挂载点
+            if self.root.is_none() {
+                // 注意：这里需要修改 Arc 内部的值，这在 Rust 中比较复杂
+                // 简化实现：我们在创建挂载点时就设置好所有属性
+            }
+
+            mounts.push(mount);
+            Ok(())
+        })
+    }
+
     /// 移除挂载点
     ///
     pub fn remove_mount(&self, mnt_id: u64) -> Result<(), i32> {
-        let mut mounts = self.mounts.lock();
-
-        // 查找并移除挂载点
-        for i in 0..mounts.len() {
-            if mounts[i].mnt_id == mnt_id {
-                // 检查是否是根挂载点
-                if let Some(ref root) = self.root {
-                    if root.mnt_id == mnt_id {
-                        return Err(errno::Errno::DeviceOrResourceBusy.as_neg_i32());
+        self.update_mounts(|mounts| {
+            // 查找并移除挂载点
+            for i in 0..mounts.len() {
+                if mounts[i].mnt_id == mnt_id {
+                    // 检查是否是根挂载点
+                    if let Some(ref root) = self.root {
+                        if root.mnt_id == mnt_id {
+                            return Err(errno::Errno::DeviceOrResourceBusy.as_neg_i32());
+                        }
                     }
-                }
 
-                mounts.remove(i);
-                return Ok(());
+                    mounts.remove(i);
+                    return Ok(());
+                }
             }
-        }
 
-        Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32())
+            Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32())
+        })
     }
 
-    /// 查找挂载点
-    pub fn find_mount(&self, _path: &[u8]) -> Option<Arc<VfsMount>> {
-        let mounts = self.mounts.lock();
-
-        for mount in mounts.iter() {
-            if let Some(ref _mountpoint) = mount.mnt_mountpoint {
-                // TODO: 实现路径比较
-                // if mountpoint.as_slice() == path {
-                //     return Some(mount.clone());
-                // }
+    /// 查找路径所在的挂载 (lookup_mnt)
+    ///
+    /// 由长到短依次用 path 在分量边界上的前缀查散列表，第一个命中的就是最深的挂载点；
+    /// "/" 覆盖所有绝对路径。查找次数与路径深度成正比，与挂载数无关。
+    /// 不加锁：挂载表在宽限期后才释放，表中的挂载持有引用
+    pub fn find_mount(&self, path: &[u8]) -> Option<Arc<VfsMount>> {
+        let _rcu = rcu_read_lock();
+        let list = unsafe { self.list_rcu() }?;
+
+        let mut end = path.len();
+        while end > 0 {
+            if let Some(mount) = list.lookup(&path[..end]) {
+                return Some(mount.clone());
             }
+            end = path[..end].iter().rposition(|&b| b == b'/').unwrap_or(0);
         }
-
-        None
+        if !path.starts_with(b"/") {
+            return None;
+        }
+        list.lookup(b"/").cloned()
     }
 
     /// 获取所有挂载点
     pub fn list_mounts(&self) -> Vec<Arc<VfsMount>> {
-        let _mounts = self.mounts.lock();
-        // Arc 已经实现了 Clone trait (标准库)
-        // 暂时返回空 Vec
-        Vec::new()
+        let _rcu = rcu_read_lock();
+        unsafe { self.mounts_rcu() }.to_vec()
     }
 
     /// 增加引用计数
@@ -261,9 +360,19 @@ impl MntNamespace {
     }
 }
 
+impl Drop for MntNamespace {
+    fn drop(&mut self) {
+        let list = *self.mounts.get_mut();
+        if !list.is_null() {
+            drop(unsafe { Box::from_raw(list) });
+        }
+    }
+}
+
 static INIT_NS: MntNamespace = MntNamespace {
     ns_id: 0,
-    mounts: Mutex::new(Vec::new()),
+    mounts: AtomicPtr::new(ptr::null_mut()),
+    mount_lock: TicketLock::new(()),
     root: None,
     count: AtomicU64::new(1),
 };
@@ -0,0 +1,266 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 逐分量路径查找
+//!
+//! 参考 Linux: fs/namei.c (link_path_walk, walk_component, lookup_fast, lookup_slow)
+//!
+//! 路径按分量逐个解析，每个分量先在 dcache 中以 (设备号, 父目录 inode, 名字) 查找：
+//! - 命中正目录项时由它直接得到子节点 (lookup_fast)，不访问文件系统的目录结构
+//! - 命中负目录项时直接返回 ENOENT
+//! - 未命中时调用文件系统的 lookup (lookup_slow)，结果连同"不存在"一起加入 dcache
+//!
+//! 解析不分配内存：分量直接在原路径上切分，"." 跳过，".." 回到祖先栈中的上一层目录，
+//! 只有跟随符号链接时才读取链接目标。/usr/bin/foo 与 /usr/bin/bar 共享前两个分量的缓存。
+//! rootfs、procfs 和 ext4 各自实现 PathWalk；跨文件系统时由 lookup_mnt 按挂载点切分路径
+
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU64, Ordering};
+
+use crate::errno;
+use crate::fs::dentry::{self, Dentry};
+use crate::fs::mount::{get_init_namespace, VfsMount};
+
+/// 单个分量的最大长度 (NAME_MAX)
+pub const NAME_MAX: usize = 255;
+
+/// 最多跟随的符号链接数 (MAXSYMLINKS)
+pub const MAXSYMLINKS: usize = 40;
+
+/// 祖先栈的深度，更深的路径丢弃最上层的祖先
+const WALK_STACK_DEPTH: usize = 16;
+
+/// dcache 中父目录的键：设备号占高 24 位，inode 编号占低 40 位
+#[inline]
+pub fn d_parent_key(s_dev: u64, ino: u64) -> u64 {
+    (s_dev << 40) | (ino & ((1u64 << 40) - 1))
+}
+
+/// 目录中的名字被创建、删除或改名后，丢弃缓存的查找结果 (d_invalidate)
+pub fn d_invalidate(s_dev: u64, dir_ino: u64, name: &[u8]) {
+    // 路径查找只缓存 UTF-8 名字
+    if let Ok(name) = core::str::from_utf8(name) {
+        dentry::dcache_remove(name, d_parent_key(s_dev, dir_ino));
+    }
+}
+
+/// 文件系统提供给路径查找的目录操作 (inode_operations 的 lookup / get_link)
+pub trait PathWalk {
+    /// 查找得到的节点
+    type Node: Clone;
+
+    /// 文件系统实例的设备号 (s_dev)
+    fn s_dev(&self) -> u64;
+
+    /// 根目录
+    fn root(&self) -> Result<Self::Node, i32>;
+
+    /// 节点的 inode 编号
+    fn ino(&self, node: &Self::Node) -> u64;
+
+    /// 是否为目录
+    fn is_dir(&self, node: &Self::Node) -> bool;
+
+    /// 是否为需要跟随的符号链接
+    fn is_symlink(&self, _node: &Self::Node) -> bool {
+        false
+    }
+
+    /// 读取符号链接目标 (get_link)
+    fn get_link(&self, _node: &Self::Node) -> Option<Vec<u8>> {
+        None
+    }
+
+    /// 在目录中查找分量，不存在时返回 ENOENT (inode_operations.lookup)
+    fn lookup(&self, dir: &Self::Node, name: &str) -> Result<Self::Node, i32>;
+
+    /// 为查找到的节点建立正目录项 (d_instantiate)
+    fn d_instantiate(&self, name: &str, node: &Self::Node) -> Dentry;
+
+    /// 由缓存的正目录项得到节点，失败时按未命中处理
+    fn d_node(&self, dentry: &Dentry) -> Option<Self::Node>;
+}
+
+/// 统计：dcache 命中 / 调用文件系统 lookup 的分量数
+static LOOKUP_FAST: AtomicU64 = AtomicU64::new(0);
+static LOOKUP_SLOW: AtomicU64 = AtomicU64::new(0);
+
+/// 路径查找统计 (lookup_fast 次数, lookup_slow 次数)
+pub fn path_walk_stats() -> (u64, u64) {
+    (LOOKUP_FAST.load(Ordering::Relaxed), LOOKUP_SLOW.load(Ordering::Relaxed))
+}
+
+/// 已经解析的目录及其祖先 (nameidata)
+///
+/// 固定大小的栈，解析过程中不分配内存；超过 WALK_STACK_DEPTH 层时丢弃最上层的祖先，
+/// 之后 ".." 退到被丢弃的层时返回 ENAMETOOLONG
+struct WalkStack<N> {
+    stack: [Option<N>; WALK_STACK_DEPTH],
+    depth: usize,
+    /// 被丢弃的祖先层数
+    dropped: usize,
+}
+
+impl<N> WalkStack<N> {
+    fn new(root: N) -> Self {
+        let mut stack: [Option<N>; WALK_STACK_DEPTH] = core::array::from_fn(|_| None);
+        stack[0] = Some(root);
+        Self { stack, depth: 0, dropped: 0 }
+    }
+
+    /// 当前目录
+    #[inline]
+    fn current(&self) -> &N {
+        self.stack[self.depth].as_ref().expect("walk stack slot is empty")
+    }
+
+    /// 进入子节点
+    fn push(&mut self, node: N) {
+        if self.depth + 1 == WALK_STACK_DEPTH {
+            self.stack.rotate_left(1);
+            self.dropped += 1;
+        } else {
+            self.depth += 1;
+        }
+        self.stack[self.depth] = Some(node);
+    }
+
+    /// 处理 ".."：根目录的父目录是它自己
+    fn pop(&mut self) -> Result<(), i32> {
+        if self.depth == 0 {
+            if self.dropped != 0 {
+                return Err(-errno::constants::ENAMETOOLONG);
+            }
+            return Ok(());
+        }
+        self.stack[self.depth] = None;
+        self.depth -= 1;
+        Ok(())
+    }
+
+    /// 回到根目录（绝对路径的符号链接）
+    fn reset(&mut self, root: N) {
+        for slot in self.stack.iter_mut() {
+            *slot = None;
+        }
+        self.stack[0] = Some(root);
+        self.depth = 0;
+        self.dropped = 0;
+    }
+
+    fn into_current(mut self) -> N {
+        self.stack[self.depth].take().expect("walk stack slot is empty")
+    }
+}
+
+/// 在目录中查找一个分量 (walk_component)
+///
+/// 先查 dcache（只取桶锁，不取文件系统的锁，也不分配内存），未命中再调用文件系统
+fn walk_component<W: PathWalk>(fs: &W, dir: &W::Node, name: &str) -> Result<W::Node, i32> {
+    let key = d_parent_key(fs.s_dev(), fs.ino(dir));
+
+    // lookup_fast
+    if let Some(dentry) = dentry::dcache_lookup(name, key) {
+        if dentry.is_negative() {
+            LOOKUP_FAST.fetch_add(1, Ordering::Relaxed);
+            return Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32());
+        }
+        if let Some(node) = fs.d_node(&dentry) {
+            LOOKUP_FAST.fetch_add(1, Ordering::Relaxed);
+            return Ok(node);
+        }
+    }
+
+    // lookup_slow
+    LOOKUP_SLOW.fetch_add(1, Ordering::Relaxed);
+    match fs.lookup(dir, name) {
+        Ok(node) => {
+            dentry::dcache_add(Arc::new(fs.d_instantiate(name, &node)), key);
+            Ok(node)
+        }
+        Err(e) => {
+            if e == errno::Errno::NoSuchFileOrDirectory.as_neg_i32() {
+                dentry::dcache_add_negative(name, key);
+            }
+            Err(e)
+        }
+    }
+}
+
+/// 逐个解析 path 的分量 (link_path_walk)
+///
+/// 相对路径从栈顶目录开始，绝对路径先回到根目录
+fn link_path_walk<W: PathWalk>(
+    fs: &W,
+    nd: &mut WalkStack<W::Node>,
+    path: &str,
+    follow: bool,
+    nlink: &mut usize,
+) -> Result<(), i32> {
+    if path.starts_with('/') {
+        nd.reset(fs.root()?);
+    }
+
+    let mut components = path.split('/').filter(|c| !c.is_empty()).peekable();
+    while let Some(name) = components.next() {
+        let last = components.peek().is_none();
+        match name {
+            "." => continue,
+            ".." => {
+                nd.pop()?;
+                continue;
+            }
+            _ => {}
+        }
+        if name.len() > NAME_MAX {
+            return Err(-errno::constants::ENAMETOOLONG);
+        }
+        if !fs.is_dir(nd.current()) {
+            return Err(errno::Errno::NotADirectory.as_neg_i32());
+        }
+
+        let child = walk_component(fs, nd.current(), name)?;
+
+        // 中间分量的符号链接总是跟随，最后一个分量由 follow 决定 (pick_link)
+        if (follow || !last) && fs.is_symlink(&child) {
+            *nlink += 1;
+            if *nlink > MAXSYMLINKS {
+                return Err(-errno::constants::ELOOP);
+            }
+            let target = fs.get_link(&child)
+                .ok_or(errno::Errno::NoSuchFileOrDirectory.as_neg_i32())?;
+            let target = core::str::from_utf8(&target)
+                .map_err(|_| errno::Errno::NoSuchFileOrDirectory.as_neg_i32())?;
+            // 相对目标从链接所在的目录开始解析
+            link_path_walk(fs, nd, target, true, nlink)?;
+        } else {
+            nd.push(child);
+        }
+    }
+    Ok(())
+}
+
+/// 在一个文件系统内解析路径 (path_lookupat)
+///
+/// 相对路径也从根目录开始；follow 为 false 时不跟随最后一个分量的符号链接 (LOOKUP_FOLLOW)
+pub fn path_walk<W: PathWalk>(fs: &W, path: &str, follow: bool) -> Result<W::Node, i32> {
+    let mut nd = WalkStack::new(fs.root()?);
+    let mut nlink = 0;
+    link_path_walk(fs, &mut nd, path, follow, &mut nlink)?;
+    Ok(nd.into_current())
+}
+
+/// 找到绝对路径所在的挂载 (lookup_mnt)
+///
+/// # 返回
+/// (挂载, 挂载点之后的剩余路径)；剩余路径交给该挂载的文件系统用 path_walk 解析
+pub fn lookup_mnt(path: &str) -> Option<(Arc<VfsMount>, &str)> {
+    let mnt = get_init_namespace().find_mount(path.as_bytes())?;
+    let covered = mnt.mnt_mountpoint.as_ref().map_or(0, |mp| mp.len());
+    // 根挂载点 "/" 的剩余路径就是整个路径
+    let rest = if covered <= 1 { path } else { &path[covered..] };
+    Some((mnt, rest))
+}
@@ -7,125 +7,231 @@
 //!
 //!
 //! 核心概念：
-//! - `struct pipe_inode_info`: 管道信息
-//! - `struct pipe_buffer`: 管道缓冲区
+//! - `struct pipe_inode_info`: 管道信息，页槽组成的环 (PipeRing)
+//! - `struct pipe_buffer`: 一个页槽，引用一页中的一段数据 (PipeBuffer)
 //! - 同步读写操作
+//!
+//! 管道的数据按页存放，每个页槽持有所在页的一个引用：
+//! - 普通写入复制到管道自己分配的页，未满的最后一页继续追加 (PIPE_BUF_FLAG_CAN_MERGE)
+//! - 从用户空间写入整页且页对齐的数据时，把用户页交给管道 (vmsplice SPLICE_F_GIFT)：
+//!   页改为只读 + COW，不复制；写入者之后再写这一页时才复制
+//! - splice 直接把页缓存页或另一个管道的页挂入页槽，只增加引用
+//! - 容量默认 PIPE_DEF_BUFFERS 页，可用 F_SETPIPE_SZ 调整
+//!
+//! 唤醒只在页槽数跨过边界时进行：读者在管道由空变非空或升过水位线时唤醒，
+//! 写者在管道由满变不满或降过水位线时唤醒；没有等待者时不获取队列锁
 
-use alloc::vec::Vec;
 use alloc::boxed::Box;
+use alloc::collections::VecDeque;
 use spin::Mutex;
 use core::sync::atomic::{AtomicUsize, Ordering};
 use alloc::sync::Arc;
+use crate::fs::splice::SpliceChunk;
+use crate::mm::filemap::put_page;
+use crate::mm::memcontrol::{mem_cgroup_alloc_page, MemcgStat};
+use crate::mm::page_desc::pfn_to_page;
+use crate::mm::PAGE_SIZE;
 use crate::process::wait::WaitQueueHead;
 
-const PIPE_BUF_SIZE: usize = 16384;
+/// 默认的页槽数 (PIPE_DEF_BUFFERS)
+pub const PIPE_DEF_BUFFERS: usize = 16;
 
-#[repr(C)]
+/// F_SETPIPE_SZ 允许的最大容量 (pipe_max_size)
+pub const PIPE_MAX_SIZE: usize = 1024 * 1024;
+
+/// 普通写入分配的页，之后的写入可以追加到页中 (PIPE_BUF_FLAG_CAN_MERGE)
+const PIPE_BUF_FLAG_CAN_MERGE: u8 = 0x10;
+
+/// 写入者交出的用户页 (PIPE_BUF_FLAG_GIFT)
+const PIPE_BUF_FLAG_GIFT: u8 = 0x08;
+
+/// 用户空间地址范围，与 sys_read / sys_write 的检查一致
+const USER_START: usize = 0x10000;
+const USER_END: usize = 0x8000_0000;
+
+/// 一个页槽：页中 [offset, offset + len) 的数据 (struct pipe_buffer)
+///
+/// 持有页的一个引用，数据读完或管道释放时归还
+#[derive(Debug, Clone, Copy)]
 pub struct PipeBuffer {
-    /// 缓冲区数据
-    data: Vec<u8>,
-    /// 读指针
-    read_pos: AtomicUsize,
-    /// 写指针
-    write_pos: AtomicUsize,
-    /// 缓冲区大小
-    size: usize,
+    /// 页的物理地址
+    page: usize,
+    /// 数据在页内的偏移
+    offset: usize,
+    /// 数据长度
+    len: usize,
+    /// PIPE_BUF_FLAG_*
+    flags: u8,
 }
 
 impl PipeBuffer {
-    /// 创建新的管道缓冲区
-    pub fn new(size: usize) -> Self {
-        // 手动分配并初始化向量，避免使用 vec! 宏
-        let mut data = Vec::with_capacity(size);
-        unsafe {
-            data.set_len(size);
-            core::ptr::write_bytes(data.as_mut_ptr(), 0, size);
-        }
+    /// 数据
+    #[inline]
+    fn data(&self) -> &[u8] {
+        unsafe { core::slice::from_raw_parts((self.page + self.offset) as *const u8, self.len) }
+    }
 
+    /// 归还页引用 (pipe_buf_release)
+    #[inline]
+    fn release(self) {
+        put_page(self.page);
+    }
+}
+
+/// 页槽组成的环 (pipe_inode_info 的 bufs / head / tail / max_usage)
+pub struct PipeRing {
+    /// 从最早写入的页槽开始
+    bufs: VecDeque<PipeBuffer>,
+    /// 最多使用的页槽数
+    max_usage: usize,
+}
+
+impl PipeRing {
+    /// 创建可容纳 nr_slots 页的环
+    pub fn new(nr_slots: usize) -> Self {
         Self {
-            data,
-            read_pos: AtomicUsize::new(0),
-            write_pos: AtomicUsize::new(0),
-            size,
+            bufs: VecDeque::with_capacity(nr_slots),
+            max_usage: nr_slots,
         }
     }
 
-    /// 读取数据
-    pub fn read(&mut self, buf: &mut [u8]) -> usize {
-        let read_pos = self.read_pos.load(Ordering::Acquire);
-        let write_pos = self.write_pos.load(Ordering::Acquire);
+    /// 是否已用完所有页槽 (pipe_full)
+    #[inline]
+    fn is_full(&self) -> bool {
+        self.bufs.len() >= self.max_usage
+    }
 
-        if read_pos == write_pos {
-            return 0; // 缓冲区为空
-        }
+    /// 唤醒水位线（页槽数）：容量的一半
+    #[inline]
+    fn watermark(&self) -> usize {
+        (self.max_usage / 2).max(1)
+    }
 
-        let available = if write_pos > read_pos {
-            write_pos - read_pos
-        } else {
-            self.size - read_pos
-        };
+    /// 写入前有 before 个页槽，是否需要唤醒读者
+    ///
+    /// 由空变非空，或升过水位线
+    #[inline]
+    fn should_wake_reader(&self, before: usize) -> bool {
+        let after = self.bufs.len();
+        (before == 0 && after > 0) || (before < self.watermark() && after >= self.watermark())
+    }
 
-        let to_read = core::cmp::min(available, buf.len());
+    /// 读取前有 before 个页槽，是否需要唤醒写者
+    ///
+    /// 由满变不满，或降过水位线
+    #[inline]
+    fn should_wake_writer(&self, before: usize) -> bool {
+        let after = self.bufs.len();
+        (before >= self.max_usage && after < self.max_usage)
+            || (before > self.watermark() && after <= self.watermark())
+    }
 
-        for i in 0..to_read {
-            buf[i] = self.data[(read_pos + i) % self.size];
+    /// 读取数据，读完的页槽归还页引用 (pipe_read)
+    pub fn read(&mut self, buf: &mut [u8]) -> usize {
+        let mut done = 0;
+        while done < buf.len() {
+            let slot = match self.bufs.front_mut() {
+                Some(slot) => slot,
+                None => break,
+            };
+            let n = slot.len.min(buf.len() - done);
+            buf[done..done + n].copy_from_slice(&slot.data()[..n]);
+            slot.offset += n;
+            slot.len -= n;
+            done += n;
+            if slot.len == 0 {
+                if let Some(slot) = self.bufs.pop_front() {
+                    slot.release();
+                }
+            }
         }
-
-        self.read_pos.store((read_pos + to_read) % self.size, Ordering::Release);
-        to_read
+        done
     }
 
-    /// 写入数据
+    /// 复制写入数据：先追加到可合并的最后一页，再分配新页 (pipe_write)
+    ///
+    /// # 返回
+    /// 写入的字节数；页槽用完或分配不到页时可能少于 buf.len()
     pub fn write(&mut self, buf: &[u8]) -> usize {
-        let read_pos = self.read_pos.load(Ordering::Acquire);
-        let write_pos = self.write_pos.load(Ordering::Acquire);
-
-        // 计算可用空间
-        let available = if write_pos >= read_pos {
-            self.size - (write_pos - read_pos) - 1
-        } else {
-            read_pos - write_pos - 1
-        };
-
-        let to_write = core::cmp::min(available, buf.len());
-
-        for i in 0..to_write {
-            self.data[(write_pos + i) % self.size] = buf[i];
+        let mut done = 0;
+        if let Some(last) = self.bufs.back_mut() {
+            let end = last.offset + last.len;
+            if last.flags & PIPE_BUF_FLAG_CAN_MERGE != 0 && end < PAGE_SIZE {
+                let n = (PAGE_SIZE - end).min(buf.len());
+                unsafe {
+                    core::ptr::copy_nonoverlapping(buf.as_ptr(), (last.page + end) as *mut u8, n);
+                }
+                last.len += n;
+                done = n;
+            }
         }
+        while done < buf.len() && !self.is_full() {
+            let frame = match mem_cgroup_alloc_page(MemcgStat::Kernel) {
+                Some(frame) => frame,
+                None => break,
+            };
+            let page = frame.start_address().as_usize();
+            let n = PAGE_SIZE.min(buf.len() - done);
+            unsafe {
+                core::ptr::copy_nonoverlapping(buf[done..].as_ptr(), page as *mut u8, n);
+            }
+            self.bufs.push_back(PipeBuffer { page, offset: 0, len: n, flags: PIPE_BUF_FLAG_CAN_MERGE });
+            done += n;
+        }
+        done
+    }
 
-        self.write_pos.store((write_pos + to_write) % self.size, Ordering::Release);
-        to_write
+    /// 把页中的一段挂入新的页槽，为页增加一个引用 (add_to_pipe)
+    ///
+    /// # 返回
+    /// 页槽已满返回 false
+    fn push_page(&mut self, page: usize, offset: usize, len: usize, flags: u8) -> bool {
+        if self.is_full() {
+            return false;
+        }
+        let desc = pfn_to_page(page / PAGE_SIZE);
+        if !desc.is_null() {
+            unsafe { (*desc).get_page() };
+        }
+        self.bufs.push_back(PipeBuffer { page, offset, len, flags });
+        true
     }
 
     /// 获取可用读取字节数
     pub fn available_read(&self) -> usize {
-        let read_pos = self.read_pos.load(Ordering::Acquire);
-        let write_pos = self.write_pos.load(Ordering::Acquire);
-
-        if write_pos >= read_pos {
-            write_pos - read_pos
-        } else {
-            self.size - read_pos + write_pos
-        }
+        self.bufs.iter().map(|slot| slot.len).sum()
     }
 
-    /// 获取可用写入空间
+    /// 获取可用写入空间：空闲页槽加上最后一页中可追加的部分
     pub fn available_write(&self) -> usize {
-        let read_pos = self.read_pos.load(Ordering::Acquire);
-        let write_pos = self.write_pos.load(Ordering::Acquire);
+        let merge = self.bufs.back().map_or(0, |last| {
+            if last.flags & PIPE_BUF_FLAG_CAN_MERGE != 0 {
+                PAGE_SIZE - (last.offset + last.len)
+            } else {
+                0
+            }
+        });
+        (self.max_usage - self.bufs.len().min(self.max_usage)) * PAGE_SIZE + merge
+    }
 
-        if write_pos >= read_pos {
-            self.size - (write_pos - read_pos) - 1
-        } else {
-            read_pos - write_pos - 1
+    /// 容量（字节）
+    pub fn capacity(&self) -> usize {
+        self.max_usage * PAGE_SIZE
+    }
+}
+
+impl Drop for PipeRing {
+    fn drop(&mut self) {
+        for slot in self.bufs.drain(..) {
+            slot.release();
         }
     }
 }
 
 #[repr(C)]
 pub struct Pipe {
-    /// 管道缓冲区
-    buffer: Mutex<PipeBuffer>,
+    /// 页槽环
+    ring: Mutex<PipeRing>,
     /// 读端是否已关闭
     read_closed: AtomicUsize,
     /// 写端是否已关闭
@@ -140,7 +246,7 @@ impl Pipe {
     /// 创建新管道
     pub fn new() -> Self {
         Self {
-            buffer: Mutex::new(PipeBuffer::new(PIPE_BUF_SIZE)),
+            ring: Mutex::new(PipeRing::new(PIPE_DEF_BUFFERS)),
             read_closed: AtomicUsize::new(0),
             write_closed: AtomicUsize::new(0),
             read_queue: WaitQueueHead::new(),
@@ -172,6 +278,16 @@ impl Pipe {
         self.write_closed.load(Ordering::Acquire) == 1
     }
 
+    /// 读者不必等待：有数据或写端已关闭
+    fn readable(&self) -> bool {
+        !self.ring.lock().bufs.is_empty() || self.is_write_closed()
+    }
+
+    /// 写者不必等待：有空闲页槽或读端已关闭
+    fn writable(&self) -> bool {
+        !self.ring.lock().is_full() || self.is_read_closed()
+    }
+
     /// 获取读等待队列
     pub fn read_queue(&self) -> &WaitQueueHead {
         &self.read_queue
@@ -181,14 +297,42 @@ impl Pipe {
     pub fn write_queue(&self) -> &WaitQueueHead {
         &self.write_queue
     }
+
+    /// 管道容量（字节）
+    pub fn capacity(&self) -> usize {
+        self.ring.lock().capacity()
+    }
+
+    /// 调整容量 (pipe_set_size)
+    ///
+    /// size 向上取整为 2 的幂个页，至少一页
+    ///
+    /// # 返回
+    /// 新的容量；超过 PIPE_MAX_SIZE 返回 EPERM，已有数据多于新容量返回 EBUSY
+    pub fn set_size(&self, size: usize) -> Result<usize, i32> {
+        if size > PIPE_MAX_SIZE {
+            return Err(crate::errno::Errno::OperationNotPermitted.as_neg_i32());
+        }
+        let nr_slots = ((size + PAGE_SIZE - 1) / PAGE_SIZE).max(1).next_power_of_two();
+        let mut ring = self.ring.lock();
+        if ring.bufs.len() > nr_slots {
+            return Err(crate::errno::Errno::DeviceOrResourceBusy.as_neg_i32());
+        }
+        ring.max_usage = nr_slots;
+        ring.bufs.shrink_to(nr_slots);
+        drop(ring);
+        // 扩大容量后有了空闲页槽
+        self.write_queue.wake_up_all();
+        Ok(nr_slots * PAGE_SIZE)
+    }
 }
 
 pub fn pipe_read(pipe: &Pipe, buf: &mut [u8]) -> isize {
-    if pipe.is_write_closed() && pipe.buffer.lock().available_read() == 0 {
+    if pipe.is_write_closed() && pipe.ring.lock().available_read() == 0 {
         return 0; // EOF
     }
 
-    let count = pipe.buffer.lock().read(buf);
+    let count = pipe.ring.lock().read(buf);
     count as isize
 }
 
@@ -197,7 +341,7 @@ pub fn pipe_write(pipe: &Pipe, buf: &[u8]) -> isize {
         return -9; // EBADF - 读端已关闭，写入会失败
     }
 
-    let count = pipe.buffer.lock().write(buf);
+    let count = pipe.ring.lock().write(buf);
     if count == 0 {
         // 缓冲区满，非阻塞模式下返回 EAGAIN
         -11_i32 as isize // EAGAIN
@@ -207,25 +351,80 @@ pub fn pipe_write(pipe: &Pipe, buf: &[u8]) -> isize {
 }
 
 use crate::fs::file::{File, FileOps, FileFlags};
+use crate::fs::select::{poll_wait, PollTable};
+
+/// 在等待队列上睡眠一次，被唤醒后返回 (pipe_wait_readable / pipe_wait_writable)
+///
+/// 加入队列后再检查一次条件：唤醒方修改管道后才检查 has_waiters，
+/// 条件在加入之前已经满足时不睡眠，不会丢失唤醒
+///
+/// # 返回
+/// 无法获取当前任务时返回 false
+pub(crate) fn pipe_wait<F>(queue: &WaitQueueHead, ready: F) -> bool
+where
+    F: Fn() -> bool,
+{
+    let current = match crate::sched::current() {
+        Some(task) => task,
+        None => return false,
+    };
 
-fn pipe_file_read(file: &File, buf: &mut [u8]) -> isize {
-    if let Some(pipe_ptr) = unsafe { *file.private_data.get() } {
-        let pipe = unsafe { &*(pipe_ptr as *const Pipe) };
+    let entry = crate::process::wait::WaitQueueEntry::new(current, false);
+    queue.add(&entry);
+
+    // 让出 CPU
+    if !ready() {
+        #[cfg(feature = "riscv64")]
+        crate::sched::schedule();
+    }
+
+    // 被唤醒后，从等待队列移除
+    queue.remove(&entry);
+    true
+}
 
+/// 由文件得到管道
+#[inline]
+fn file_pipe(file: &File) -> Option<&Pipe> {
+    unsafe { *file.private_data.get() }.map(|ptr| unsafe { &*(ptr as *const Pipe) })
+}
+
+/// 把当前进程的用户页交给管道 (iter_to_pipe + SPLICE_F_GIFT)
+///
+/// # 返回
+/// 页的物理地址，已为管道增加一个引用；不能交出时返回 None，由调用者复制
+fn gift_user_page(addr: usize) -> Option<usize> {
+    if addr < USER_START || addr + PAGE_SIZE > USER_END {
+        return None;
+    }
+    let current = crate::sched::current()?;
+    let addr_space = current.address_space()?;
+    addr_space.gift_user_page(addr)
+}
+
+fn pipe_file_read(file: &File, buf: &mut [u8]) -> isize {
+    if let Some(pipe) = file_pipe(file) {
         // 检查是否为非阻塞模式
         let nonblock = (file.flags.bits() & FileFlags::O_NONBLOCK) != 0;
 
         loop {
             // 检查 EOF 条件：写端已关闭且缓冲区为空
-            if pipe.is_write_closed() && pipe.buffer.lock().available_read() == 0 {
+            if pipe.is_write_closed() && pipe.ring.lock().available_read() == 0 {
                 return 0; // EOF
             }
 
             // 尝试读取数据
-            let count = pipe.buffer.lock().read(buf);
+            let (count, wake) = {
+                let mut ring = pipe.ring.lock();
+                let before = ring.bufs.len();
+                let count = ring.read(buf);
+                (count, ring.should_wake_writer(before))
+            };
             if count > 0 {
-                // 读取成功，唤醒写等待者（有空间了）
-                pipe.write_queue().wake_up_all();
+                // 读取成功，空出页槽跨过边界时唤醒写等待者
+                if wake {
+                    pipe.write_queue().wake_up_all_sync();
+                }
                 return count as isize;
             }
 
@@ -235,27 +434,9 @@ fn pipe_file_read(file: &File, buf: &mut [u8]) -> isize {
                 return -11_i32 as isize; // EAGAIN
             }
 
-            // 阻塞模式：使用等待队列等待数据
-            // 条件：缓冲区有数据或写端关闭
-            {
-                // 创建等待队列项
-                let current = match crate::sched::current() {
-                    Some(task) => task,
-                    None => return 0, // 无法获取当前任务，返回 EOF
-                };
-
-                let entry = crate::process::wait::WaitQueueEntry::new(current, false);
-                pipe.read_queue().add(entry);
-
-                // 让出 CPU
-                #[cfg(feature = "riscv64")]
-                crate::sched::schedule();
-
-                // 被唤醒后，从等待队列移除
-                pipe.read_queue().remove(current);
-
-                // 重新检查条件
-                continue;
+            // 阻塞模式：等待数据或写端关闭
+            if !pipe_wait(pipe.read_queue(), || pipe.readable()) {
+                return 0; // 无法获取当前任务，返回 EOF
             }
         }
     } else {
@@ -263,72 +444,239 @@ fn pipe_file_read(file: &File, buf: &mut [u8]) -> isize {
     }
 }
 
-fn pipe_file_write(file: &File, buf: &[u8]) -> isize {
-    if let Some(pipe_ptr) = unsafe { *file.private_data.get() } {
-        let pipe = unsafe { &*(pipe_ptr as *const Pipe) };
+/// 写入管道，gift 时把整页且页对齐的用户数据交给管道 (pipe_write / vmsplice_to_pipe)
+fn do_pipe_write(file: &File, buf: &[u8], gift: bool) -> isize {
+    let pipe = match file_pipe(file) {
+        Some(pipe) => pipe,
+        None => return -9,  // EBADF
+    };
 
-        // 检查读端是否已关闭
-        if pipe.is_read_closed() {
-            return -9; // EBADF - 读端已关闭，写入会失败（SIGPIPE）
+    // 检查读端是否已关闭
+    if pipe.is_read_closed() {
+        return -9; // EBADF - 读端已关闭，写入会失败（SIGPIPE）
+    }
+
+    // 检查是否为非阻塞模式
+    let nonblock = (file.flags.bits() & FileFlags::O_NONBLOCK) != 0;
+
+    let mut total_written = 0;
+    // 本次写入累计的唤醒，睡眠前和返回前统一唤醒读者
+    let mut wake_readers = false;
+
+    // 循环写入，直到所有数据写入完毕或遇到错误
+    while total_written < buf.len() {
+        let remaining = &buf[total_written..];
+        let addr = remaining.as_ptr() as usize;
+
+        // 整页的用户数据：交出页而不复制
+        let count = if gift && addr % PAGE_SIZE == 0 && remaining.len() >= PAGE_SIZE && !pipe.ring.lock().is_full() {
+            match gift_user_page(addr) {
+                Some(page) => {
+                    let pushed = {
+                        let mut ring = pipe.ring.lock();
+                        let before = ring.bufs.len();
+                        let pushed = ring.push_page(page, 0, PAGE_SIZE, PIPE_BUF_FLAG_GIFT);
+                        wake_readers |= ring.should_wake_reader(before);
+                        pushed
+                    };
+                    // push_page 另加了引用，交出时取得的引用归还
+                    put_page(page);
+                    if pushed { PAGE_SIZE } else { 0 }
+                }
+                None => {
+                    let mut ring = pipe.ring.lock();
+                    let before = ring.bufs.len();
+                    let count = ring.write(&remaining[..PAGE_SIZE]);
+                    wake_readers |= ring.should_wake_reader(before);
+                    count
+                }
+            }
+        } else {
+            let mut ring = pipe.ring.lock();
+            let before = ring.bufs.len();
+            let count = ring.write(remaining);
+            wake_readers |= ring.should_wake_reader(before);
+            count
+        };
+
+        if count > 0 {
+            // 写入成功
+            total_written += count;
+            continue;
         }
 
-        // 检查是否为非阻塞模式
-        let nonblock = (file.flags.bits() & FileFlags::O_NONBLOCK) != 0;
+        // 睡眠或返回之前唤醒读者，读者才能腾出空间
+        if wake_readers {
+            pipe.read_queue().wake_up_all_sync();
+            wake_readers = false;
+        }
 
-        let mut total_written = 0;
+        // 缓冲区满
+        if nonblock {
+            // 非阻塞模式：返回已写入的字节数或 EAGAIN
+            if total_written > 0 {
+                return total_written as isize;
+            } else {
+                return -11_i32 as isize; // EAGAIN
+            }
+        }
 
-        // 循环写入，直到所有数据写入完毕或遇到错误
-        while total_written < buf.len() {
-            let remaining = &buf[total_written..];
+        // 阻塞模式：等待空间
+        if !pipe_wait(pipe.write_queue(), || pipe.writable()) {
+            return total_written as isize; // 无法获取当前任务，返回已写入字节数
+        }
+        if pipe.is_read_closed() {
+            break;
+        }
+    }
 
-            // 尝试写入数据
-            let count = pipe.buffer.lock().write(remaining);
+    if wake_readers {
+        pipe.read_queue().wake_up_all_sync();
+    }
+    total_written as isize
+}
 
-            if count > 0 {
-                // 写入成功
-                total_written += count;
-                // 唤醒读等待者（有数据了）
-                pipe.read_queue().wake_up_all();
-                continue;
-            }
+fn pipe_file_write(file: &File, buf: &[u8]) -> isize {
+    do_pipe_write(file, buf, true)
+}
 
-            // 缓冲区满
-            if nonblock {
-                // 非阻塞模式：返回已写入的字节数或 EAGAIN
-                if total_written > 0 {
-                    return total_written as isize;
-                } else {
-                    return -11_i32 as isize; // EAGAIN
-                }
-            }
+/// 管道的就绪事件 (pipe_poll)
+///
+/// 读端：有数据可读 POLLIN，写端已关闭 POLLHUP；写端：有空闲页槽 POLLOUT，读端已关闭 POLLERR。
+/// 读端登记读队列（写入数据、写端关闭时唤醒），写端登记写队列
+fn pipe_poll(file: &File, mut pt: Option<&mut PollTable>) -> u32 {
+    use crate::fs::file::poll_mask::*;
 
-            // 阻塞模式：使用等待队列等待空间
-            {
-                // 创建等待队列项
-                let current = match crate::sched::current() {
-                    Some(task) => task,
-                    None => return total_written as isize, // 无法获取当前任务，返回已写入字节数
-                };
+    let pipe = match file_pipe(file) {
+        Some(pipe) => pipe,
+        None => return 0,
+    };
+    if file.flags.is_readonly() || file.flags.is_rdwr() {
+        poll_wait(pipe.read_queue(), pt.as_deref_mut());
+    }
+    if file.flags.is_writeonly() || file.flags.is_rdwr() {
+        poll_wait(pipe.write_queue(), pt);
+    }
+    let mut mask = 0;
+    if file.flags.is_readonly() || file.flags.is_rdwr() {
+        if !pipe.ring.lock().bufs.is_empty() {
+            mask |= POLLIN | POLLRDNORM;
+        }
+        if pipe.is_write_closed() {
+            mask |= POLLHUP;
+        }
+    }
+    if file.flags.is_writeonly() || file.flags.is_rdwr() {
+        if !pipe.ring.lock().is_full() {
+            mask |= POLLOUT | POLLWRNORM;
+        }
+        if pipe.is_read_closed() {
+            mask |= POLLERR;
+        }
+    }
+    mask
+}
 
-                let entry = crate::process::wait::WaitQueueEntry::new(current, false);
-                pipe.write_queue().add(entry);
+/// vmsplice：把用户内存写入管道，flags 含 SPLICE_F_GIFT 时交出整页 (vmsplice_to_pipe)
+pub fn pipe_vmsplice(file: &File, buf: &[u8], gift: bool) -> isize {
+    do_pipe_write(file, buf, gift)
+}
 
-                // 让出 CPU
-                #[cfg(feature = "riscv64")]
-                crate::sched::schedule();
+/// 把页中的一段挂入管道，不复制数据 (splice_to_pipe)
+///
+/// 页槽用完时等待读者，非阻塞模式返回 EAGAIN
+///
+/// # 返回
+/// 挂入的字节数或负错误码
+pub fn pipe_splice_page(file: &File, page: usize, offset: usize, len: usize) -> isize {
+    let pipe = match file_pipe(file) {
+        Some(pipe) => pipe,
+        None => return -9,  // EBADF
+    };
+    let nonblock = (file.flags.bits() & FileFlags::O_NONBLOCK) != 0;
+    loop {
+        if pipe.is_read_closed() {
+            return -9; // EBADF - 读端已关闭
+        }
+        let (pushed, wake) = {
+            let mut ring = pipe.ring.lock();
+            let before = ring.bufs.len();
+            let pushed = ring.push_page(page, offset, len, 0);
+            (pushed, ring.should_wake_reader(before))
+        };
+        if pushed {
+            if wake {
+                pipe.read_queue().wake_up_all();
+            }
+            return len as isize;
+        }
+        if nonblock || !pipe_wait(pipe.write_queue(), || pipe.writable()) {
+            return -11_i32 as isize; // EAGAIN
+        }
+    }
+}
 
-                // 被唤醒后，从等待队列移除
-                pipe.write_queue().remove(current);
+/// 逐个页槽把管道中的数据交给 actor，页不复制 (splice_from_pipe)
+///
+/// 管道为空时等待写者（非阻塞模式返回 EAGAIN）；之后只传输已有的数据。
+/// actor 执行时不持有管道锁，页槽暂时取出，未传输完的部分放回环头
+///
+/// # 返回
+/// 传输的字节数，写端关闭且没有数据时为 0；一个字节也没传输时返回 actor 的错误
+pub fn splice_from_pipe<F>(file: &File, len: usize, mut actor: F) -> Result<usize, i32>
+where
+    F: FnMut(&SpliceChunk) -> isize,
+{
+    let pipe = file_pipe(file).ok_or(crate::errno::Errno::BadFileNumber.as_neg_i32())?;
+    let nonblock = (file.flags.bits() & FileFlags::O_NONBLOCK) != 0;
+
+    // 等待数据
+    while pipe.ring.lock().bufs.is_empty() {
+        if pipe.is_write_closed() {
+            return Ok(0);
+        }
+        if nonblock || !pipe_wait(pipe.read_queue(), || pipe.readable()) {
+            return Err(crate::errno::Errno::TryAgain.as_neg_i32());
+        }
+    }
 
-                // 重新尝试写入
-                continue;
+    let before = pipe.ring.lock().bufs.len();
+    let mut done = 0;
+    let mut result = Ok(());
+    while done < len {
+        let mut slot = match pipe.ring.lock().bufs.pop_front() {
+            Some(slot) => slot,
+            None => break,
+        };
+        let n = slot.len.min(len - done);
+        let chunk = SpliceChunk { page: Some(slot.page), offset: slot.offset, data: &slot.data()[..n] };
+        let ret = actor(&chunk);
+        if ret < 0 {
+            pipe.ring.lock().bufs.push_front(slot);
+            result = Err(ret as i32);
+            break;
+        }
+        let ret = ret as usize;
+        done += ret;
+        if ret < slot.len {
+            slot.offset += ret;
+            slot.len -= ret;
+            pipe.ring.lock().bufs.push_front(slot);
+            if ret < n {
+                break;
             }
+        } else {
+            slot.release();
         }
+    }
 
-        total_written as isize
-    } else {
-        -9  // EBADF
+    if done > 0 {
+        if pipe.ring.lock().should_wake_writer(before) {
+            pipe.write_queue().wake_up_all();
+        }
+        return Ok(done);
     }
+    result.map(|_| 0)
 }
 
 fn pipe_file_close(file: &File) -> i32 {
@@ -350,7 +698,7 @@ fn pipe_file_close(file: &File) -> i32 {
         if pipe.is_read_closed() && pipe.is_write_closed() {
             unsafe {
                 // 将裸指针转换回 Box，当 Box 离开作用域时会自动释放内存
-                // ...
+                // 剩余页槽的页引用随 PipeRing 一起归还
                 let _ = Box::from_raw(pipe_ptr as *mut Pipe);
             }
         }
@@ -361,19 +709,45 @@ fn pipe_file_close(file: &File) -> i32 {
     }
 }
 
+/// 管道文件操作
+static PIPE_OPS: FileOps = FileOps {
+    read: Some(pipe_file_read),
+    write: Some(pipe_file_write),
+    lseek: None,  // 管道不支持 lseek
+    close: Some(pipe_file_close),
+    read_iter: None,
+    write_iter: None,
+    poll: Some(pipe_poll),
+};
+
+/// 文件是否为管道的一端 (get_pipe_info)
+pub fn is_pipe(file: &File) -> bool {
+    unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &PIPE_OPS))
+}
+
+/// F_GETPIPE_SZ / F_SETPIPE_SZ (pipe_fcntl)
+///
+/// # 参数
+/// - size: None 时查询容量，Some 时调整容量
+///
+/// # 返回
+/// 容量（字节）；不是管道返回 EBADF
+pub fn pipe_fcntl(file: &File, size: Option<usize>) -> Result<usize, i32> {
+    if !is_pipe(file) {
+        return Err(crate::errno::Errno::BadFileNumber.as_neg_i32());
+    }
+    let pipe = file_pipe(file).ok_or(crate::errno::Errno::BadFileNumber.as_neg_i32())?;
+    match size {
+        Some(size) => pipe.set_size(size),
+        None => Ok(pipe.capacity()),
+    }
+}
+
 pub fn create_pipe() -> (Arc<File>, Arc<File>) {
     // 创建管道并在堆上分配（使用 Box::leak 确保生命周期直到手动释放）
     let pipe = Box::new(Pipe::new());
     let pipe_ptr = Box::leak(pipe) as *mut Pipe as *mut u8;
 
-    // 管道文件操作
-    static PIPE_OPS: FileOps = FileOps {
-        read: Some(pipe_file_read),
-        write: Some(pipe_file_write),
-        lseek: None,  // 管道不支持 lseek
-        close: Some(pipe_file_close),
-    };
-
     // 创建读端文件
     let read_file = Arc::new(File::new(FileFlags::new(FileFlags::O_RDONLY)));
     read_file.set_ops(&PIPE_OPS);
@@ -11,25 +11,79 @@
 //! - /proc/cpuinfo  - CPU 信息
 //! - /proc/version  - 内核版本
 //! - /proc/uptime   - 系统运行时间
-//! - /proc/loadavg  - 系统负载
+//! - /proc/loadavg  - 1、5、15 分钟平均负载
+//! - /proc/stat     - 各 CPU 的 CPU 时间与上下文切换次数
+//! - /proc/schedstat - 各 CPU 的调度统计
+//! - /proc/cpuidle - 各 CPU 空闲状态的进入次数与停留时间、当前轮询时长
 //! - /proc/cmdline  - 内核启动参数
-//! - /proc/self     - 当前进程信息（符号链接）
+//! - /proc/boottime - 各启动阶段（initcall）的 CPU、开始时间与耗时
+//! - /proc/kmsg     - 上次读取之后的内核日志（读取即消费，与 syslog 共用读取位置）
+//! - /proc/tracepoints - 跟踪点开关（可写）
+//! - /proc/trace_events - 二进制跟踪记录的事件开关（可写，开关与丢弃未读记录）
+//! - /proc/trace_pipe_raw - 上次读取之后的二进制跟踪记录
+//! - /proc/syscall_stats - 各系统调用的次数与周期直方图（可写，开关与清零）
+//! - /proc/profile  - 内核采样分析的 folded 调用栈（可写，开关与清空）
+//! - /proc/slabinfo - 命名对象缓存统计
+//! - /proc/buddyinfo - 伙伴系统各 order 空闲块数
+//! - /proc/vmstat  - 缺页、页分配与释放、PCP、slab 与回收的事件计数
+//! - /proc/kstackinfo - 内核栈数与用过的最大深度
+//! - /proc/lock_stat - 各锁类的获取、竞争与持有周期（可写，开关与清零）
+//! - /proc/interrupts - 各中断在每个 CPU 上的次数
+//! - /proc/irq/N/smp_affinity - 中断亲和性掩码（可写）
+//! - /proc/diskstats - 各磁盘的读写次数、合并、扇区、耗时与队列中的请求数
+//! - /proc/disk_latency/<磁盘名> - 排队时间与设备时间的 log2 直方图（可写，清零）
+//! - /proc/self     - 指向当前线程组 PID 的符号链接
+//! - /proc/<pid>/stat   - 进程状态、时间与内存，ps/top 使用的单行格式
+//! - /proc/<pid>/status - 进程状态的可读格式
+//! - /proc/<pid>/maps   - 进程的 VMA
+//! - /proc/<pid>/smaps  - 每个 VMA 的驻留内存统计
+//! - /proc/<pid>/io     - 读写系统调用的次数与字节数
+//! - /proc/<pid>/schedstat - 任务的运行时间、等待时间与上 CPU 次数
+//!
+//! /proc/<pid> 下的节点在查找时按需生成，不进入 dcache；
+//! 文件内容在读取时才从任务、VMA 和页表生成。
+//! 常用文件按记录经 seq_file 生成（maps/smaps 每个 VMA、cpuinfo 每个 CPU 一条），
+//! 每次打开保存迭代状态，读取只生成覆盖所读范围的记录，不先拼出整个文件
 
+use alloc::boxed::Box;
 use alloc::sync::Arc;
 use alloc::vec::Vec;
 use alloc::string::String;
 use alloc::format;
-use spin::Mutex;
+use spin::{Mutex, RwLock};
+use core::fmt::Write;
 use core::sync::atomic::{AtomicU64, Ordering};
 
 use crate::fs::superblock::{SuperBlock, SuperBlockFlags, FileSystemType};
 use crate::fs::inode::{Inode, InodeMode, Ino};
 use crate::fs::mount::{VfsMount, MntFlags};
+use crate::fs::dentry::Dentry;
+use crate::fs::dir_index::{ChildIndex, DirEntryName};
+use crate::fs::file::{File, FileFlags, FileOps, fput, get_file_fd_install};
+use crate::fs::namei::{path_walk, PathWalk};
+use crate::fs::seq_file::{SeqFile, SeqShow};
 use crate::println;
+use crate::process::task::{Task, Pid};
 
 /// ProcFS 魔数
 const PROCFS_MAGIC: u32 = 0x9fa0;
 
+/// /proc/<pid> 下节点的 inode 号从这里开始，每个 PID 占 PID_INO_STRIDE 个
+const PID_INO_BASE: u64 = 1 << 32;
+const PID_INO_STRIDE: u64 = 64;
+
+/// /proc/<pid> 下的文件 (tgid_base_stuff)，生成与写入函数的私有数据是 PID
+const PID_ENTRIES: &[(&str, SeqShow, Option<DataWriteHandler>)] = &[
+    ("stat", pid_stat_show, None),
+    ("status", pid_status_show, None),
+    ("maps", show_map, None),
+    ("smaps", show_smap, None),
+    ("io", pid_io_show, None),
+    ("schedstat", pid_schedstat_show, None),
+    ("oom_score", pid_oom_score_show, None),
+    ("oom_score_adj", pid_oom_score_adj_show, Some(pid_oom_score_adj_write)),
+];
+
 /// ProcFS 节点类型
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
 pub enum ProcFSType {
@@ -44,6 +98,15 @@ pub enum ProcFSType {
 /// 动态内容生成函数类型
 type ContentGenerator = fn() -> Vec<u8>;
 
+/// 写入处理函数类型（返回写入的字节数或负错误码）
+type WriteHandler = fn(&[u8]) -> Result<usize, i32>;
+
+/// 带私有数据的内容生成函数类型，参数为节点的 data (PDE_DATA)
+type DataGenerator = fn(usize) -> Vec<u8>;
+
+/// 带私有数据的写入处理函数类型
+type DataWriteHandler = fn(usize, &[u8]) -> Result<usize, i32>;
+
 /// ProcFS 节点
 pub struct ProcFSNode {
     /// 节点名称
@@ -52,12 +115,21 @@ pub struct ProcFSNode {
     pub node_type: ProcFSType,
     /// 动态内容生成器（用于常规文件）
     pub content_generator: Option<ContentGenerator>,
+    /// 写入处理函数（可写文件）
+    pub write_handler: Option<WriteHandler>,
+    /// 带私有数据的内容生成器与写入处理函数
+    pub data_generator: Option<DataGenerator>,
+    pub data_write_handler: Option<DataWriteHandler>,
+    /// 逐条记录生成内容的函数，读取时经 seq_file 按需生成
+    pub seq_show: Option<SeqShow>,
+    /// 私有数据，如 /proc/irq/N 下文件的中断号 (proc_dir_entry.data)
+    pub data: usize,
     /// 静态内容（如果没有内容生成器）
     pub static_content: Option<Vec<u8>>,
     /// 符号链接目标
     pub link_target: Option<Vec<u8>>,
-    /// 子节点（如果是目录）
-    pub children: Mutex<Vec<Arc<ProcFSNode>>>,
+    /// 子节点（如果是目录），子节点多时带名字哈希表
+    pub children: RwLock<ChildIndex<ProcFSNode>>,
     /// 引用计数
     ref_count: AtomicU64,
     /// 节点 ID
@@ -71,9 +143,14 @@ impl ProcFSNode {
             name,
             node_type: ProcFSType::Directory,
             content_generator: None,
+            write_handler: None,
+            data_generator: None,
+            data_write_handler: None,
+            seq_show: None,
+            data: 0,
             static_content: None,
             link_target: None,
-            children: Mutex::new(Vec::new()),
+            children: RwLock::new(ChildIndex::new()),
             ref_count: AtomicU64::new(1),
             ino,
         }
@@ -85,23 +162,72 @@ impl ProcFSNode {
             name,
             node_type: ProcFSType::RegularFile,
             content_generator: Some(generator),
+            write_handler: None,
+            data_generator: None,
+            data_write_handler: None,
+            seq_show: None,
+            data: 0,
             static_content: None,
             link_target: None,
-            children: Mutex::new(Vec::new()),
+            children: RwLock::new(ChildIndex::new()),
             ref_count: AtomicU64::new(1),
             ino,
         }
     }
 
+    /// 创建可写的动态内容文件节点
+    pub fn new_rw_file(name: Vec<u8>, generator: ContentGenerator, handler: WriteHandler, ino: u64) -> Self {
+        let mut node = Self::new_dynamic_file(name, generator, ino);
+        node.write_handler = Some(handler);
+        node
+    }
+
+    /// 创建带私有数据的文件节点，handler 为 None 时只读
+    pub fn new_data_file(
+        name: Vec<u8>,
+        generator: DataGenerator,
+        handler: Option<DataWriteHandler>,
+        data: usize,
+        ino: u64,
+    ) -> Self {
+        let mut node = Self::new_static_file(name, Vec::new(), ino);
+        node.static_content = None;
+        node.data_generator = Some(generator);
+        node.data_write_handler = handler;
+        node.data = data;
+        node
+    }
+
+    /// 创建按记录生成内容的文件节点，handler 为 None 时只读
+    pub fn new_seq_file(
+        name: Vec<u8>,
+        show: SeqShow,
+        handler: Option<DataWriteHandler>,
+        data: usize,
+        ino: u64,
+    ) -> Self {
+        let mut node = Self::new_static_file(name, Vec::new(), ino);
+        node.static_content = None;
+        node.seq_show = Some(show);
+        node.data_write_handler = handler;
+        node.data = data;
+        node
+    }
+
     /// 创建静态内容文件节点
     pub fn new_static_file(name: Vec<u8>, content: Vec<u8>, ino: u64) -> Self {
         Self {
             name,
             node_type: ProcFSType::RegularFile,
             content_generator: None,
+            write_handler: None,
+            data_generator: None,
+            data_write_handler: None,
+            seq_show: None,
+            data: 0,
             static_content: Some(content),
             link_target: None,
-            children: Mutex::new(Vec::new()),
+            children: RwLock::new(ChildIndex::new()),
             ref_count: AtomicU64::new(1),
             ino,
         }
@@ -113,9 +239,14 @@ impl ProcFSNode {
             name,
             node_type: ProcFSType::SymbolicLink,
             content_generator: None,
+            write_handler: None,
+            data_generator: None,
+            data_write_handler: None,
+            seq_show: None,
+            data: 0,
             static_content: None,
             link_target: Some(target),
-            children: Mutex::new(Vec::new()),
+            children: RwLock::new(ChildIndex::new()),
             ref_count: AtomicU64::new(1),
             ino,
         }
@@ -136,10 +267,14 @@ impl ProcFSNode {
         self.node_type == ProcFSType::SymbolicLink
     }
 
-    /// 获取文件内容
+    /// 获取文件的全部内容
     pub fn get_content(&self) -> Vec<u8> {
-        if let Some(generator) = self.content_generator {
+        if let Some(show) = self.seq_show {
+            SeqFile::new(show, self.data).read_to_end()
+        } else if let Some(generator) = self.content_generator {
             generator()
+        } else if let Some(generator) = self.data_generator {
+            generator(self.data)
         } else if let Some(ref content) = self.static_content {
             content.clone()
         } else if let Some(ref target) = self.link_target {
@@ -149,31 +284,46 @@ impl ProcFSNode {
         }
     }
 
+    /// 写入文件内容
+    ///
+    /// # 返回
+    /// 不可写的文件返回 -EACCES
+    pub fn write(&self, data: &[u8]) -> Result<usize, i32> {
+        if let Some(handler) = self.data_write_handler {
+            return handler(self.data, data);
+        }
+        match self.write_handler {
+            Some(handler) => handler(data),
+            None => Err(crate::errno::Errno::PermissionDenied.as_neg_i32()),
+        }
+    }
+
     /// 获取文件大小
+    ///
+    /// 读取时才生成内容的文件大小为 0，与 Linux 的 /proc 一致，不为取大小生成一遍内容
     pub fn size(&self) -> usize {
-        self.get_content().len()
+        if let Some(ref content) = self.static_content {
+            content.len()
+        } else if let Some(ref target) = self.link_target {
+            target.len()
+        } else {
+            0
+        }
     }
 
     /// 查找子节点
     pub fn find_child(&self, name: &[u8]) -> Option<Arc<ProcFSNode>> {
-        let children = self.children.lock();
-        for child in children.iter() {
-            if child.name.as_slice() == name {
-                return Some(child.clone());
-            }
-        }
-        None
+        self.children.read().find(name).cloned()
     }
 
     /// 添加子节点
     pub fn add_child(&self, child: Arc<ProcFSNode>) {
-        let mut children = self.children.lock();
-        children.push(child);
+        self.children.write().push(child);
     }
 
     /// 列出子节点
     pub fn list_children(&self) -> Vec<(Vec<u8>, ProcFSType, u64)> {
-        let children = self.children.lock();
+        let children = self.children.read();
         children.iter().map(|c| {
             (c.name.clone(), c.node_type, c.ino)
         }).collect()
@@ -193,6 +343,12 @@ impl ProcFSNode {
 unsafe impl Send for ProcFSNode {}
 unsafe impl Sync for ProcFSNode {}
 
+impl DirEntryName for ProcFSNode {
+    fn entry_name(&self) -> &[u8] {
+        &self.name
+    }
+}
+
 /// ProcFS 超级块
 pub struct ProcFSSuperBlock {
     /// 基础超级块
@@ -225,22 +381,166 @@ impl ProcFSSuperBlock {
     /// 初始化默认文件
     pub fn init_default_files(&self) {
         // 创建 /proc 目录结构
-        self.create_dynamic_file("meminfo", generate_meminfo);
-        self.create_dynamic_file("cpuinfo", generate_cpuinfo);
-        self.create_dynamic_file("version", generate_version);
-        self.create_dynamic_file("uptime", generate_uptime);
-        self.create_dynamic_file("loadavg", generate_loadavg);
+        self.create_seq_file("meminfo", meminfo_show);
+        self.create_seq_file("cpuinfo", cpuinfo_show);
+        self.create_seq_file("version", version_show);
+        self.create_seq_file("uptime", uptime_show);
+        self.create_seq_file("loadavg", loadavg_show);
+        self.create_seq_file("stat", stat_show);
+        self.create_seq_file("schedstat", schedstat_show);
         self.create_static_file("cmdline", generate_cmdline());
-        self.create_symlink("self", "/proc/self");
+        self.create_dynamic_file("slabinfo", generate_slabinfo);
+        self.create_dynamic_file("buddyinfo", generate_buddyinfo);
+        self.create_dynamic_file("vmstat", generate_vmstat);
+        self.create_dynamic_file("cpuidle", generate_cpuidle);
+        self.create_dynamic_file("kstackinfo", generate_kstackinfo);
+        self.create_rw_file("tracepoints", generate_tracepoints, crate::trace::write_control);
+        self.create_dynamic_file("kmsg", crate::printk::generate_kmsg);
+        self.create_dynamic_file("boottime", crate::initcall::generate_boottime);
+        self.create_rw_file("trace_events", generate_trace_events, crate::trace::ring_buffer::write_control);
+        self.create_dynamic_file("trace_pipe_raw", crate::trace::ring_buffer::generate_pipe_raw);
+        self.create_rw_file("lock_stat", generate_lock_stat, crate::sync::spinlock::write_lock_stat);
+        self.create_rw_file("syscall_stats", generate_syscall_stats,
+                            crate::arch::riscv64::syscall_stats::write_control);
+        self.create_rw_file("profile", generate_profile, crate::profile::write_control);
+        // 目标在查找时换成当前线程组的 PID，这里的节点只用于列目录
+        self.create_symlink("self", "self");
+
+        // /proc/net 目录
+        let net_dir = Arc::new(ProcFSNode::new_dir(b"net".to_vec(), self.alloc_ino()));
+        self.root_node.add_child(net_dir.clone());
+        net_dir.add_child(Arc::new(ProcFSNode::new_dynamic_file(
+            b"skb_pool".to_vec(),
+            generate_skb_pool,
+            self.alloc_ino(),
+        )));
+        net_dir.add_child(Arc::new(ProcFSNode::new_dynamic_file(
+            b"snmp".to_vec(),
+            generate_snmp,
+            self.alloc_ino(),
+        )));
+        net_dir.add_child(Arc::new(ProcFSNode::new_rw_file(
+            b"xdp".to_vec(),
+            generate_xdp,
+            write_xdp,
+            self.alloc_ino(),
+        )));
+
+        // /proc/sys/vm 目录：回写阈值与透明大页模式
+        let sys_dir = Arc::new(ProcFSNode::new_dir(b"sys".to_vec(), self.alloc_ino()));
+        self.root_node.add_child(sys_dir.clone());
+        let vm_dir = Arc::new(ProcFSNode::new_dir(b"vm".to_vec(), self.alloc_ino()));
+        sys_dir.add_child(vm_dir.clone());
+        vm_dir.add_child(Arc::new(ProcFSNode::new_rw_file(
+            b"dirty_ratio".to_vec(),
+            generate_dirty_ratio,
+            crate::mm::writeback::write_dirty_ratio,
+            self.alloc_ino(),
+        )));
+        vm_dir.add_child(Arc::new(ProcFSNode::new_rw_file(
+            b"dirty_background_ratio".to_vec(),
+            generate_dirty_background_ratio,
+            crate::mm::writeback::write_dirty_background_ratio,
+            self.alloc_ino(),
+        )));
+        vm_dir.add_child(Arc::new(ProcFSNode::new_rw_file(
+            b"transparent_hugepage".to_vec(),
+            generate_transparent_hugepage,
+            crate::mm::khugepaged::write_enabled,
+            self.alloc_ino(),
+        )));
+
+        // /proc/sys/net/core 目录：忙轮询时长
+        let sys_net_dir = Arc::new(ProcFSNode::new_dir(b"net".to_vec(), self.alloc_ino()));
+        sys_dir.add_child(sys_net_dir.clone());
+        let core_dir = Arc::new(ProcFSNode::new_dir(b"core".to_vec(), self.alloc_ino()));
+        sys_net_dir.add_child(core_dir.clone());
+        core_dir.add_child(Arc::new(ProcFSNode::new_rw_file(
+            b"busy_read".to_vec(),
+            generate_busy_read,
+            crate::net::busy_poll::write_busy_read,
+            self.alloc_ino(),
+        )));
+        core_dir.add_child(Arc::new(ProcFSNode::new_rw_file(
+            b"busy_poll".to_vec(),
+            generate_busy_poll,
+            crate::net::busy_poll::write_busy_poll,
+            self.alloc_ino(),
+        )));
+
+        // /proc/interrupts 与 /proc/irq 目录，已注册的中断各有一个子目录
+        self.create_dynamic_file("interrupts", generate_interrupts);
+        let irq_dir = Arc::new(ProcFSNode::new_dir(b"irq".to_vec(), self.alloc_ino()));
+        self.root_node.add_child(irq_dir);
+        for irq in crate::irq::registered_irqs() {
+            self.register_irq_proc(irq);
+        }
 
-        // 创建 /proc/self 目录（简化实现，指向当前进程信息）
-        let self_dir = Arc::new(ProcFSNode::new_dir(b"self".to_vec(), self.alloc_ino()));
-        self.root_node.add_child(self_dir.clone());
+        // /proc/diskstats 与 /proc/disk_latency 目录，已注册的磁盘各有一个文件
+        self.create_dynamic_file("diskstats", generate_diskstats);
+        let lat_dir = Arc::new(ProcFSNode::new_dir(b"disk_latency".to_vec(), self.alloc_ino()));
+        self.root_node.add_child(lat_dir);
+        for disk in crate::drivers::blkdev::disks() {
+            self.register_disk_proc(unsafe { (*disk).major });
+        }
+    }
 
-        // /proc/self/fd 目录
-        let fd_ino = self.alloc_ino();
-        let fd_dir = Arc::new(ProcFSNode::new_dir(b"fd".to_vec(), fd_ino));
-        self_dir.add_child(fd_dir);
+    /// 创建 /proc/disk_latency/<磁盘名>，私有数据是主设备号
+    ///
+    /// 磁盘在 procfs 初始化之后注册时调用；文件已存在时什么也不做
+    pub fn register_disk_proc(&self, major: u32) {
+        let lat_dir = match self.root_node.find_child(b"disk_latency") {
+            Some(dir) => dir,
+            None => return,
+        };
+        let name = match crate::drivers::blkdev::get_disk(major) {
+            Some(disk) => unsafe { (*disk).name },
+            None => return,
+        };
+        if lat_dir.find_child(name.as_bytes()).is_some() {
+            return;
+        }
+        lat_dir.add_child(Arc::new(ProcFSNode::new_data_file(
+            name.as_bytes().to_vec(),
+            generate_disk_latency,
+            Some(write_disk_latency),
+            major as usize,
+            self.alloc_ino(),
+        )));
+        // 之前查找过这个名字时留下的负目录项
+        crate::fs::dentry::dcache_remove(name, crate::fs::namei::d_parent_key(self.sb.s_dev, lat_dir.ino));
+    }
+
+    /// 创建 /proc/irq/N 目录 (register_irq_proc)
+    ///
+    /// 中断在 procfs 初始化之后注册时调用；目录已存在时什么也不做
+    pub fn register_irq_proc(&self, irq: usize) {
+        let irq_dir = match self.root_node.find_child(b"irq") {
+            Some(dir) => dir,
+            None => return,
+        };
+        let name = format!("{}", irq);
+        if irq_dir.find_child(name.as_bytes()).is_some() {
+            return;
+        }
+        let dir = Arc::new(ProcFSNode::new_dir(name.as_bytes().to_vec(), self.alloc_ino()));
+        dir.add_child(Arc::new(ProcFSNode::new_data_file(
+            b"smp_affinity".to_vec(),
+            crate::irq::read_smp_affinity,
+            Some(crate::irq::write_smp_affinity),
+            irq,
+            self.alloc_ino(),
+        )));
+        dir.add_child(Arc::new(ProcFSNode::new_data_file(
+            b"effective_affinity".to_vec(),
+            crate::irq::read_effective_affinity,
+            None,
+            irq,
+            self.alloc_ino(),
+        )));
+        irq_dir.add_child(dir);
+        // 之前查找过这个名字时留下的负目录项
+        crate::fs::dentry::dcache_remove(&name, crate::fs::namei::d_parent_key(self.sb.s_dev, irq_dir.ino));
     }
 
     /// 创建动态内容文件
@@ -254,6 +554,31 @@ impl ProcFSSuperBlock {
         self.root_node.add_child(file);
     }
 
+    /// 创建按记录生成内容的文件
+    fn create_seq_file(&self, name: &str, show: SeqShow) {
+        let ino = self.alloc_ino();
+        let file = Arc::new(ProcFSNode::new_seq_file(
+            name.as_bytes().to_vec(),
+            show,
+            None,
+            0,
+            ino,
+        ));
+        self.root_node.add_child(file);
+    }
+
+    /// 创建可写的动态内容文件
+    fn create_rw_file(&self, name: &str, generator: ContentGenerator, handler: WriteHandler) {
+        let ino = self.alloc_ino();
+        let file = Arc::new(ProcFSNode::new_rw_file(
+            name.as_bytes().to_vec(),
+            generator,
+            handler,
+            ino,
+        ));
+        self.root_node.add_child(file);
+    }
+
     /// 创建静态内容文件
     fn create_static_file(&self, name: &str, content: Vec<u8>) {
         let ino = self.alloc_ino();
@@ -277,21 +602,55 @@ impl ProcFSSuperBlock {
     }
 
     /// 查找文件
+    ///
+    /// 逐分量查找，每个分量先查 dcache；不跟随符号链接。
+    /// 第一个分量是 PID 时由 lookup_pid 生成节点；
+    /// self 只有一个分量时是指向当前线程组 PID 的符号链接 (proc_self_get_link)，
+    /// 后面还有分量时按当前线程组查找
     pub fn lookup(&self, path: &str) -> Option<Arc<ProcFSNode>> {
-        let components: Vec<&str> = path.split('/').filter(|s| !s.is_empty()).collect();
-
-        if components.is_empty() {
-            return Some(self.root_node.clone());
+        let mut components = path.split('/').filter(|c| !c.is_empty() && *c != ".").peekable();
+        let first = components.next().unwrap_or("");
+        if let Ok(pid) = first.parse::<Pid>() {
+            return self.lookup_pid(pid, components);
         }
+        if first == "self" {
+            let tgid = crate::sched::current().map(|task| task.tgid()).unwrap_or(0);
+            if components.peek().is_some() {
+                return self.lookup_pid(tgid, components);
+            }
+            let ino = self.root_node.find_child(b"self")?.ino;
+            return Some(Arc::new(ProcFSNode::new_symlink(
+                b"self".to_vec(), format!("{}", tgid).into_bytes(), ino,
+            )));
+        }
+        path_walk(self, path, false).ok()
+    }
 
-        let mut current = self.root_node.clone();
-        for component in components {
-            match current.find_child(component.as_bytes()) {
-                Some(child) => current = child,
-                None => return None,
+    /// 生成 /proc/<pid> 或其下的一个文件 (proc_pid_lookup)
+    ///
+    /// 任务随时可能退出，节点每次查找时重新生成；只查找文件时只生成这一个节点
+    fn lookup_pid<'a>(&self, pid: Pid, mut rest: impl Iterator<Item = &'a str>) -> Option<Arc<ProcFSNode>> {
+        crate::sched::sched::with_task(pid, |_| ())?;
+        let ino = PID_INO_BASE + pid as u64 * PID_INO_STRIDE;
+        let name = match rest.next() {
+            Some(name) => name,
+            None => {
+                let dir = Arc::new(ProcFSNode::new_dir(format!("{}", pid).into_bytes(), ino));
+                for (i, &(entry, show, write)) in PID_ENTRIES.iter().enumerate() {
+                    dir.add_child(Arc::new(ProcFSNode::new_seq_file(
+                        entry.as_bytes().to_vec(), show, write, pid as usize, ino + 1 + i as u64,
+                    )));
+                }
+                return Some(dir);
             }
+        };
+        if rest.next().is_some() {
+            return None;
         }
-        Some(current)
+        let i = PID_ENTRIES.iter().position(|&(entry, _, _)| entry == name)?;
+        Some(Arc::new(ProcFSNode::new_seq_file(
+            name.as_bytes().to_vec(), PID_ENTRIES[i].1, PID_ENTRIES[i].2, pid as usize, ino + 1 + i as u64,
+        )))
     }
 
     /// 读取文件内容
@@ -304,134 +663,347 @@ impl ProcFSSuperBlock {
         }
     }
 
+    /// 写入文件
+    pub fn write_file(&self, path: &str, data: &[u8]) -> Result<usize, i32> {
+        match self.lookup(path) {
+            Some(node) if node.is_file() => node.write(data),
+            Some(_) => Err(crate::errno::Errno::IsADirectory.as_neg_i32()),
+            None => Err(crate::errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
+        }
+    }
+
     /// 列出目录内容
     pub fn list_dir(&self, path: &str) -> Option<Vec<(Vec<u8>, ProcFSType, u64)>> {
         let node = self.lookup(path)?;
-        if node.is_dir() {
-            Some(node.list_children())
-        } else {
-            None
+        if !node.is_dir() {
+            return None;
+        }
+        let mut entries = node.list_children();
+        // 根目录还列出每个线程组 (proc_pid_readdir)
+        if Arc::ptr_eq(&node, &self.root_node) {
+            let mut tgids: Vec<Pid> = Vec::new();
+            crate::sched::sched::for_each_task(|task| unsafe {
+                if (*task).pid() != 0 && (*task).pid() == (*task).tgid() {
+                    tgids.push((*task).pid());
+                }
+            });
+            tgids.sort_unstable();
+            for pid in tgids {
+                let ino = PID_INO_BASE + pid as u64 * PID_INO_STRIDE;
+                entries.push((format!("{}", pid).into_bytes(), ProcFSType::Directory, ino));
+            }
         }
+        Some(entries)
     }
 }
 
+/// procfs 的逐分量查找：dcache 的目录项直接持有 ProcFSNode
+///
+/// 目录树在 init_default_files 中建好后只会增加 /proc/irq/N，
+/// 增加时删除同名的负目录项
+impl PathWalk for ProcFSSuperBlock {
+    type Node = Arc<ProcFSNode>;
+
+    fn s_dev(&self) -> u64 {
+        self.sb.s_dev
+    }
+
+    fn root(&self) -> Result<Arc<ProcFSNode>, i32> {
+        Ok(self.root_node.clone())
+    }
+
+    fn ino(&self, node: &Arc<ProcFSNode>) -> u64 {
+        node.ino
+    }
+
+    fn is_dir(&self, node: &Arc<ProcFSNode>) -> bool {
+        node.is_dir()
+    }
+
+    fn lookup(&self, dir: &Arc<ProcFSNode>, name: &str) -> Result<Arc<ProcFSNode>, i32> {
+        dir.find_child(name.as_bytes())
+            .ok_or(crate::errno::Errno::NoSuchFileOrDirectory.as_neg_i32())
+    }
+
+    fn d_instantiate(&self, name: &str, node: &Arc<ProcFSNode>) -> Dentry {
+        Dentry::new_positive(name.as_bytes(), node.ino, Some(node.clone()))
+    }
+
+    fn d_node(&self, dentry: &Dentry) -> Option<Arc<ProcFSNode>> {
+        dentry.d_fsdata.clone()?.downcast::<ProcFSNode>().ok()
+    }
+}
+
+// ==================== 打开的文件 ====================
+
+/// 打开的 /proc 文件，保存在 File 的私有数据中
+///
+/// seq 是这次打开的迭代状态；没有 seq_show 的旧式节点整个内容作为一条记录，
+/// 第一次读取时生成，之后的读取从同一份内容中复制 (single_open)
+struct ProcFile {
+    node: Arc<ProcFSNode>,
+    seq: Mutex<SeqFile>,
+}
+
+/// 旧式节点的唯一一条记录，data 是 ProcFile 持有的节点 (single_open 的 show)
+fn proc_single_show(data: usize, index: usize, m: &mut SeqFile) -> bool {
+    if index > 0 {
+        return false;
+    }
+    let node = unsafe { &*(data as *const ProcFSNode) };
+    m.write_bytes(&node.get_content());
+    true
+}
+
+fn proc_file(file: &File) -> Option<&ProcFile> {
+    unsafe { (*file.private_data.get()).map(|ptr| &*(ptr as *const ProcFile)) }
+}
+
+fn proc_file_read(file: &File, buf: &mut [u8]) -> isize {
+    let pf = match proc_file(file) {
+        Some(pf) if !file.flags.is_writeonly() => pf,
+        _ => return -9,  // EBADF
+    };
+    let pos = file.get_pos();
+    let read = pf.seq.lock().read(pos, buf);
+    file.set_pos(pos + read as u64);
+    read as isize
+}
+
+fn proc_file_read_iter(file: &File, iov: &mut [&mut [u8]], pos: u64) -> isize {
+    let pf = match proc_file(file) {
+        Some(pf) if !file.flags.is_writeonly() => pf,
+        _ => return -9,  // EBADF
+    };
+    let mut seq = pf.seq.lock();
+    let mut offset = pos;
+    for buf in iov.iter_mut() {
+        let read = seq.read(offset, buf);
+        offset += read as u64;
+        if read < buf.len() {
+            break;
+        }
+    }
+    (offset - pos) as isize
+}
+
+fn proc_file_write(file: &File, buf: &[u8]) -> isize {
+    let pf = match proc_file(file) {
+        Some(pf) if !file.flags.is_readonly() => pf,
+        _ => return -9,  // EBADF
+    };
+    match pf.node.write(buf) {
+        Ok(n) => n as isize,
+        Err(e) => e as isize,
+    }
+}
+
+/// 内容在读取时生成，没有确定的末尾，不支持 SEEK_END (seq_lseek)
+fn proc_file_lseek(file: &File, offset: isize, whence: i32) -> isize {
+    let new_pos = match whence {
+        0 => offset,                              // SEEK_SET
+        1 => file.get_pos() as isize + offset,    // SEEK_CUR
+        _ => return -22,                          // EINVAL
+    };
+    if new_pos < 0 {
+        return -22;  // EINVAL
+    }
+    file.set_pos(new_pos as u64);
+    new_pos
+}
+
+fn proc_file_close(file: &File) -> i32 {
+    if let Some(ptr) = unsafe { *file.private_data.get() } {
+        drop(unsafe { Box::from_raw(ptr as *mut ProcFile) });
+    }
+    0
+}
+
+/// /proc 文件操作表 (proc_reg_file_ops + seq_read_iter)
+static PROC_FILE_OPS: FileOps = FileOps {
+    read: Some(proc_file_read),
+    write: Some(proc_file_write),
+    lseek: Some(proc_file_lseek),
+    close: Some(proc_file_close),
+    read_iter: Some(proc_file_read_iter),
+    write_iter: None,
+    poll: None,
+};
+
+/// 为节点创建一次打开的迭代状态 (seq_open / single_open)
+///
+/// 旧式节点的 SeqFile 引用节点本身，调用者在 SeqFile 使用期间持有 node
+fn proc_seq_open(node: &Arc<ProcFSNode>) -> SeqFile {
+    match node.seq_show {
+        Some(show) => SeqFile::new(show, node.data),
+        None => SeqFile::new(proc_single_show, Arc::as_ptr(node) as usize),
+    }
+}
+
+/// 打开 /proc 下的文件 (proc_reg_open)
+///
+/// # 返回
+/// 路径不在 procfs 挂载之下时返回 None；目录和 /proc/self 返回 EISDIR，
+/// 以写方式打开不可写的文件返回 EACCES
+pub fn open(path: &str, flags: u32) -> Option<Result<usize, i32>> {
+    use crate::errno::Errno;
+
+    let sb = get_procfs_sb()?;
+    let (mnt, rest) = crate::fs::namei::lookup_mnt(path)?;
+    if mnt.mnt_sb != Some(sb as *const ProcFSSuperBlock as *mut u8) {
+        return None;
+    }
+    let node = match sb.lookup(rest) {
+        Some(node) => node,
+        None => return Some(Err(Errno::NoSuchFileOrDirectory.as_neg_i32())),
+    };
+    if !node.is_file() {
+        return Some(Err(Errno::IsADirectory.as_neg_i32()));
+    }
+    let file_flags = FileFlags::new(flags);
+    if !file_flags.is_readonly() && node.write_handler.is_none() && node.data_write_handler.is_none() {
+        return Some(Err(Errno::PermissionDenied.as_neg_i32()));
+    }
+
+    let seq = Mutex::new(proc_seq_open(&node));
+    let file = Arc::new(File::new(file_flags));
+    file.set_ops(&PROC_FILE_OPS);
+    file.set_private_data(Box::into_raw(Box::new(ProcFile { node, seq })) as *mut u8);
+    Some(match unsafe { get_file_fd_install(file.clone()) } {
+        Some(fd) => Ok(fd),
+        None => {
+            // 关闭时释放 ProcFile
+            fput(file);
+            Err(Errno::TooManyOpenFiles.as_neg_i32())
+        }
+    })
+}
+
 // ==================== 内容生成函数 ====================
 
-/// 生成 /proc/meminfo 内容
-fn generate_meminfo() -> Vec<u8> {
+/// 一行 "名称 数值 kB"，数值右对齐到 8 列 (show_val_kb)
+fn show_val_kb(m: &mut SeqFile, name: &str, kb: impl core::fmt::Display) {
+    let _ = write!(m, "{:<16}{:8} kB\n", name, kb);
+}
+
+/// /proc/meminfo (meminfo_proc_show)
+fn meminfo_show(_data: usize, index: usize, m: &mut SeqFile) -> bool {
     use crate::mm::meminfo::get_memory_info;
 
+    if index > 0 {
+        return false;
+    }
     let info = get_memory_info();
-    let mut content = String::new();
 
     // 转换为 KB
     let mem_total_kb = info.mem_total / 1024;
     let mem_free_kb = info.mem_free / 1024;
     let mem_available_kb = info.mem_available / 1024;
     let mem_used_kb = info.mem_used / 1024;
+    let (_, cached_pages) = crate::mm::filemap::page_cache_stats();
+    let (lru_active, lru_inactive) = crate::mm::vmscan::lru_sizes();
+    let shmem_pages = crate::fs::tmpfs::nr_shmem_pages();
+
+    show_val_kb(m, "MemTotal:", mem_total_kb);
+    show_val_kb(m, "MemFree:", mem_free_kb);
+    show_val_kb(m, "MemAvailable:", mem_available_kb);
+    show_val_kb(m, "Buffers:", 0);
+    show_val_kb(m, "Cached:", cached_pages * 4);
+    show_val_kb(m, "SwapCached:", 0);
+    show_val_kb(m, "Active:", mem_used_kb);
+    show_val_kb(m, "Inactive:", 0);
+    show_val_kb(m, "Active(anon):", mem_used_kb);
+    show_val_kb(m, "Inactive(anon):", 0);
+    show_val_kb(m, "Active(file):", lru_active * 4);
+    show_val_kb(m, "Inactive(file):", lru_inactive * 4);
+    show_val_kb(m, "Unevictable:", shmem_pages * 4);
+    show_val_kb(m, "Mlocked:", 0);
+    let zswap = crate::mm::zswap::zswap_stats();
+    show_val_kb(m, "SwapTotal:", zswap.total_slots * 4);
+    show_val_kb(m, "SwapFree:", zswap.total_slots.saturating_sub(zswap.stored_pages) * 4);
+    show_val_kb(m, "Zswap:", zswap.pool_pages * 4);
+    show_val_kb(m, "Zswapped:", zswap.stored_pages * 4);
+    show_val_kb(m, "Dirty:", crate::mm::filemap::nr_file_dirty() * 4);
+    show_val_kb(m, "Writeback:", 0);
+    show_val_kb(m, "AnonPages:", mem_used_kb);
+    show_val_kb(m, "Mapped:", 0);
+    show_val_kb(m, "Shmem:", shmem_pages * 4);
+    for name in [
+        "KReclaimable:", "Slab:", "SReclaimable:", "SUnreclaim:", "KernelStack:",
+        "PageTables:", "NFS_Unstable:", "Bounce:", "WritebackTmp:",
+    ] {
+        show_val_kb(m, name, 0);
+    }
+    show_val_kb(m, "CommitLimit:", mem_total_kb / 2);
+    show_val_kb(m, "Committed_AS:", mem_used_kb);
+    show_val_kb(m, "VmallocTotal:", 536870912);  // 512 GB virtual
+    for name in ["VmallocUsed:", "VmallocChunk:", "Percpu:", "HardwareCorrupted:"] {
+        show_val_kb(m, name, 0);
+    }
+    show_val_kb(m, "AnonHugePages:", crate::arch::riscv64::mm::nr_anon_huge_pages() * 2048);
+    show_val_kb(m, "ShmemHugePages:", crate::fs::tmpfs::nr_shmem_huge_pages() * 2048);
+    for name in ["ShmemPmdMapped:", "FileHugePages:", "FilePmdMapped:"] {
+        show_val_kb(m, name, 0);
+    }
+    for name in ["HugePages_Total:", "HugePages_Free:", "HugePages_Rsvd:", "HugePages_Surp:"] {
+        let _ = write!(m, "{:<16}{:8}\n", name, 0);
+    }
+    show_val_kb(m, "Hugepagesize:", 2048);
+    show_val_kb(m, "Hugetlb:", 0);
+    show_val_kb(m, "DirectMap4k:", 4096);
+    show_val_kb(m, "DirectMap2M:", mem_total_kb);
+    show_val_kb(m, "DirectMap1G:", 0);
+    true
+}
 
-    content.push_str(&format!("MemTotal:       {} kB\n", mem_total_kb));
-    content.push_str(&format!("MemFree:        {} kB\n", mem_free_kb));
-    content.push_str(&format!("MemAvailable:   {} kB\n", mem_available_kb));
-    content.push_str(&format!("Buffers:               0 kB\n"));
-    content.push_str(&format!("Cached:                0 kB\n"));
-    content.push_str(&format!("SwapCached:            0 kB\n"));
-    content.push_str(&format!("Active:          {} kB\n", mem_used_kb));
-    content.push_str(&format!("Inactive:              0 kB\n"));
-    content.push_str(&format!("Active(anon):    {} kB\n", mem_used_kb));
-    content.push_str(&format!("Inactive(anon):        0 kB\n"));
-    content.push_str(&format!("Active(file):          0 kB\n"));
-    content.push_str(&format!("Inactive(file):        0 kB\n"));
-    content.push_str(&format!("Unevictable:           0 kB\n"));
-    content.push_str(&format!("Mlocked:               0 kB\n"));
-    content.push_str(&format!("SwapTotal:             0 kB\n"));
-    content.push_str(&format!("SwapFree:              0 kB\n"));
-    content.push_str(&format!("Dirty:                 0 kB\n"));
-    content.push_str(&format!("Writeback:             0 kB\n"));
-    content.push_str(&format!("AnonPages:       {} kB\n", mem_used_kb));
-    content.push_str(&format!("Mapped:                0 kB\n"));
-    content.push_str(&format!("Shmem:                 0 kB\n"));
-    content.push_str(&format!("KReclaimable:          0 kB\n"));
-    content.push_str(&format!("Slab:                  0 kB\n"));
-    content.push_str(&format!("SReclaimable:          0 kB\n"));
-    content.push_str(&format!("SUnreclaim:            0 kB\n"));
-    content.push_str(&format!("KernelStack:           0 kB\n"));
-    content.push_str(&format!("PageTables:            0 kB\n"));
-    content.push_str(&format!("NFS_Unstable:          0 kB\n"));
-    content.push_str(&format!("Bounce:                0 kB\n"));
-    content.push_str(&format!("WritebackTmp:          0 kB\n"));
-    content.push_str(&format!("CommitLimit:    {} kB\n", mem_total_kb / 2));
-    content.push_str(&format!("Committed_AS:    {} kB\n", mem_used_kb));
-    content.push_str(&format!("VmallocTotal:  536870912 kB\n"));  // 512 GB virtual
-    content.push_str(&format!("VmallocUsed:           0 kB\n"));
-    content.push_str(&format!("VmallocChunk:          0 kB\n"));
-    content.push_str(&format!("Percpu:                0 kB\n"));
-    content.push_str(&format!("HardwareCorrupted:     0 kB\n"));
-    content.push_str(&format!("AnonHugePages:         0 kB\n"));
-    content.push_str(&format!("ShmemHugePages:        0 kB\n"));
-    content.push_str(&format!("ShmemPmdMapped:        0 kB\n"));
-    content.push_str(&format!("FileHugePages:         0 kB\n"));
-    content.push_str(&format!("FilePmdMapped:         0 kB\n"));
-    content.push_str(&format!("HugePages_Total:       0\n"));
-    content.push_str(&format!("HugePages_Free:        0\n"));
-    content.push_str(&format!("HugePages_Rsvd:        0\n"));
-    content.push_str(&format!("HugePages_Surp:        0\n"));
-    content.push_str(&format!("Hugepagesize:       2048 kB\n"));
-    content.push_str(&format!("Hugetlb:               0 kB\n"));
-    content.push_str(&format!("DirectMap4k:       4096 kB\n"));
-    content.push_str(&format!("DirectMap2M:     {} kB\n", mem_total_kb));
-    content.push_str(&format!("DirectMap1G:           0 kB\n"));
-
-    content.into_bytes()
-}
-
-/// 生成 /proc/cpuinfo 内容
-fn generate_cpuinfo() -> Vec<u8> {
+/// /proc/cpuinfo，每个 CPU 一条记录 (show_cpuinfo)
+fn cpuinfo_show(_data: usize, index: usize, m: &mut SeqFile) -> bool {
     use crate::arch::riscv64::smp::num_started_cpus;
     use core::arch::asm;
 
-    let mut content = String::new();
-
-    let num_cpus = num_started_cpus();
-
-    for cpu in 0..num_cpus {
-        // 读取 CPU 信息
-        let mvendorid: u64;
-        let marchid: u64;
-        let mimpid: u64;
-        let misa: u64;
-
-        unsafe {
-            asm!("csrr {}, mvendorid", out(reg) mvendorid);
-            asm!("csrr {}, marchid", out(reg) marchid);
-            asm!("csrr {}, mimpid", out(reg) mimpid);
-            asm!("csrr {}, misa", out(reg) misa);
-        }
+    if index >= num_started_cpus() {
+        return false;
+    }
+    // 设备树报告的 ISA；没有设备树时使用 QEMU virt 的默认值
+    let isa = crate::arch::riscv64::cpu::isa_string();
+    let isa = isa.as_deref().unwrap_or("rv64imafdch");
 
-        content.push_str(&format!("processor\t: {}\n", cpu));
-        content.push_str(&format!("hart\t\t: {}\n", cpu));
-        content.push_str(&format!("isa\t\t: rv64imafdch\n"));  // 简化，实际应该解析 misa
-        content.push_str(&format!("mmu\t\t: sv39\n"));
-        content.push_str(&format!("mvendorid\t: {:#x}\n", mvendorid));
-        content.push_str(&format!("marchid\t\t: {:#x}\n", marchid));
-        content.push_str(&format!("mimpid\t\t: {:#x}\n", mimpid));
+    // 读取 CPU 信息
+    let mvendorid: u64;
+    let marchid: u64;
+    let mimpid: u64;
 
-        if cpu < num_cpus - 1 {
-            content.push('\n');
-        }
+    unsafe {
+        asm!("csrr {}, mvendorid", out(reg) mvendorid);
+        asm!("csrr {}, marchid", out(reg) marchid);
+        asm!("csrr {}, mimpid", out(reg) mimpid);
     }
 
-    content.into_bytes()
+    // CPU 之间空一行
+    if index > 0 {
+        m.puts("\n");
+    }
+    let _ = write!(
+        m,
+        "processor\t: {}\nhart\t\t: {}\nisa\t\t: {}\nmmu\t\t: sv39\n\
+         mvendorid\t: {:#x}\nmarchid\t\t: {:#x}\nmimpid\t\t: {:#x}\n",
+        index, index, isa, mvendorid, marchid, mimpid,
+    );
+    true
 }
 
-/// 生成 /proc/version 内容
-fn generate_version() -> Vec<u8> {
+/// /proc/version (version_proc_show)
+fn version_show(_data: usize, index: usize, m: &mut SeqFile) -> bool {
     use crate::config::KERNEL_VERSION;
 
+    if index > 0 {
+        return false;
+    }
     let rustc_version = option_env!("RUSTC_VERSION").unwrap_or("unknown");
     let build_time = option_env!("BUILD_TIME").unwrap_or("unknown");
 
-    let content = format!(
+    let _ = write!(
+        m,
         "Rux OS version {} (riscv64)\n\
          Compiled with Rust {} at {}\n\
          Copyright (c) 2026 Fei Wang\n",
@@ -439,15 +1011,17 @@ fn generate_version() -> Vec<u8> {
         rustc_version,
         build_time
     );
-
-    content.into_bytes()
+    true
 }
 
-/// 生成 /proc/uptime 内容
-fn generate_uptime() -> Vec<u8> {
+/// /proc/uptime (uptime_proc_show)
+fn uptime_show(_data: usize, index: usize, m: &mut SeqFile) -> bool {
     // QEMU virt 机器的时钟频率是 10 MHz
     const TIMER_FREQ: u64 = 10_000_000;
 
+    if index > 0 {
+        return false;
+    }
     // 读取当前时间（cycles）
     let cycles: u64;
     unsafe {
@@ -460,17 +1034,438 @@ fn generate_uptime() -> Vec<u8> {
 
     // 转换为秒
     let uptime_secs = cycles / TIMER_FREQ;
+    let _ = write!(m, "{}.00 {}.00\n", uptime_secs, uptime_secs);
+    true
+}
 
-    let content = format!("{}.00 {}.00\n", uptime_secs, uptime_secs);
+/// /proc/loadavg (loadavg_proc_show)
+///
+/// 三个平均负载，可运行任务数/任务总数，最近分配的 PID
+fn loadavg_show(_data: usize, index: usize, m: &mut SeqFile) -> bool {
+    use crate::sched::loadavg::{get_avenrun, load_int, load_frac, FIXED_1};
 
-    content.into_bytes()
+    if index > 0 {
+        return false;
+    }
+    let avnrun = get_avenrun(FIXED_1 / 200, 0);
+    let _ = write!(
+        m,
+        "{}.{:02} {}.{:02} {}.{:02} {}/{} {}\n",
+        load_int(avnrun[0]), load_frac(avnrun[0]),
+        load_int(avnrun[1]), load_frac(avnrun[1]),
+        load_int(avnrun[2]), load_frac(avnrun[2]),
+        crate::sched::sched::nr_running(),
+        crate::sched::sched::nr_threads(),
+        crate::sched::pid::last_pid(),
+    );
+    true
 }
 
-/// 生成 /proc/loadavg 内容
-fn generate_loadavg() -> Vec<u8> {
-    // 简化实现：返回 0 负载
-    // TODO: 实现真正的负载计算
-    b"0.00 0.00 0.00 1/64 0\n".to_vec()
+/// /proc/stat (show_stat)
+///
+/// CPU 时间单位为 USER_HZ；没有单独记账的 iowait、irq、steal、guest 为 0，
+/// procs_blocked 为不可中断睡眠的任务数。总计行在各 CPU 之前，所以同一时刻的
+/// 各 CPU 时间先取出再输出
+fn stat_show(_data: usize, index: usize, m: &mut SeqFile) -> bool {
+    use crate::sched::stats::{cpu_time, nr_context_switches, CpuTime};
+
+    if index > 0 {
+        return false;
+    }
+    let now = crate::sched::fair::sched_clock();
+    let to_clock_t = |ns: u64| ns / crate::time::TICK_NSEC;
+    let line = |m: &mut SeqFile, name: &str, cpu: Option<usize>, t: &CpuTime| {
+        m.puts(name);
+        if let Some(cpu) = cpu {
+            let _ = write!(m, "{}", cpu);
+        }
+        let _ = write!(
+            m,
+            " {} {} {} {} 0 0 {} 0 0 0\n",
+            to_clock_t(t.user), to_clock_t(t.nice), to_clock_t(t.system),
+            to_clock_t(t.idle), to_clock_t(t.softirq),
+        );
+    };
+
+    let times: Vec<(usize, CpuTime)> = (0..crate::config::MAX_CPUS)
+        .filter(|&cpu| crate::sched::cpu_rq(cpu).is_some())
+        .map(|cpu| (cpu, cpu_time(cpu, now)))
+        .collect();
+    let mut total = CpuTime::default();
+    for (_, t) in times.iter() {
+        total.add(t);
+    }
+    line(m, "cpu ", None, &total);
+    for (cpu, t) in times.iter() {
+        line(m, "cpu", Some(*cpu), t);
+    }
+
+    let intr: u64 = crate::irq::registered_irqs().into_iter().map(crate::irq::kstat_irqs).sum();
+    let _ = write!(
+        m,
+        "intr {}\nctxt {}\nbtime 0\nprocesses {}\nprocs_running {}\nprocs_blocked {}\n",
+        intr,
+        nr_context_switches(),
+        crate::sched::sched::total_forks(),
+        crate::sched::sched::nr_running(),
+        crate::sched::sched::nr_uninterruptible(),
+    );
+    true
+}
+
+/// /proc/schedstat：首条记录是版本与时间戳，之后每个 CPU 一条 (show_schedstat)
+fn schedstat_show(_data: usize, index: usize, m: &mut SeqFile) -> bool {
+    use crate::sched::stats::{show_schedstat_cpu, SCHEDSTAT_VERSION};
+
+    if index == 0 {
+        let _ = write!(m, "version {}\ntimestamp {}\n", SCHEDSTAT_VERSION, crate::drivers::timer::get_jiffies());
+        return true;
+    }
+    let cpu = index - 1;
+    if cpu >= crate::config::MAX_CPUS {
+        return false;
+    }
+    // 不在线的 CPU 是空记录
+    if crate::sched::cpu_rq(cpu).is_some() {
+        m.puts(&show_schedstat_cpu(cpu));
+    }
+    true
+}
+
+/// 任务状态的字母与名称 (task_state_array)
+fn task_state_name(state: crate::process::task::TaskState) -> (char, &'static str) {
+    use crate::process::task::TaskState;
+
+    match state {
+        TaskState::Running => ('R', "running"),
+        TaskState::Interruptible => ('S', "sleeping"),
+        TaskState::Uninterruptible => ('D', "disk sleep"),
+        TaskState::Stopped => ('T', "stopped"),
+        TaskState::Zombie => ('Z', "zombie"),
+        TaskState::Dead => ('X', "dead"),
+    }
+}
+
+/// 线程组中的线程数 (get_nr_threads)
+fn nr_threads_of(tgid: Pid) -> usize {
+    let mut nr = 0;
+    crate::sched::sched::for_each_task(|task| unsafe {
+        if (*task).tgid() == tgid {
+            nr += 1;
+        }
+    });
+    nr
+}
+
+/// 生成 /proc/<pid> 内容时复制出的任务信息
+///
+/// 在任务表锁内复制；遍历页表与统计线程数在锁外进行
+struct TaskSnapshot {
+    pid: Pid,
+    tgid: Pid,
+    ppid: Pid,
+    comm: String,
+    state: crate::process::task::TaskState,
+    prio: i32,
+    static_prio: i32,
+    policy: u32,
+    cpu: usize,
+    cpus_allowed: usize,
+    sigmask: u64,
+    exit_code: i32,
+    start_brk: u64,
+    start_time: u64,
+    min_flt: u64,
+    maj_flt: u64,
+    utime: u64,
+    stime: u64,
+    nvcsw: u64,
+    nivcsw: u64,
+    mm: Option<Arc<crate::mm::pagemap::AddressSpace>>,
+}
+
+fn task_snapshot(pid: usize) -> Option<TaskSnapshot> {
+    crate::sched::sched::with_task(pid as Pid, |task| {
+        let info = &task.se.sched_info;
+        TaskSnapshot {
+            pid: task.pid(),
+            tgid: task.tgid(),
+            ppid: task.ppid(),
+            comm: task.comm(),
+            state: task.state(),
+            prio: task.prio(),
+            static_prio: task.static_prio(),
+            policy: task.policy() as u32,
+            cpu: task.cpu(),
+            cpus_allowed: task.cpus_allowed(),
+            sigmask: task.sigmask,
+            exit_code: task.exit_code(),
+            start_brk: task.get_brk(),
+            start_time: task.start_time(),
+            min_flt: task.acct.min_flt.load(Ordering::Relaxed),
+            maj_flt: task.acct.maj_flt.load(Ordering::Relaxed),
+            utime: info.utime,
+            stime: info.stime,
+            nvcsw: info.nvcsw,
+            nivcsw: info.nivcsw,
+            mm: task.address_space_arc(),
+        }
+    })
+}
+
+/// 地址空间的虚拟大小与驻留大小，单位字节 (task_vsize / get_mm_rss)
+fn mm_size(mm: &crate::mm::pagemap::AddressSpace) -> (u64, u64) {
+    let vmas: Vec<crate::mm::vma::Vma> = mm.vma_read().iter().copied().collect();
+    let vsize = vmas.iter().map(|vma| vma.size() as u64).sum();
+    let rss = vmas.iter().map(|vma| mm.smaps(vma).resident).sum();
+    (vsize, rss)
+}
+
+/// /proc/<pid>/stat (do_task_stat)
+///
+/// 时间单位为 USER_HZ。没有进程组、会话和终端，对应字段为 0；
+/// 不累计已回收子进程的缺页与时间，cminflt、cmajflt、cutime、cstime 为 0
+fn pid_stat_show(pid: usize, index: usize, m: &mut SeqFile) -> bool {
+    use crate::sched::fair::MAX_RT_PRIO;
+
+    let t = match task_snapshot(pid) {
+        Some(t) if index == 0 => t,
+        _ => return false,
+    };
+    let (vsize, rss) = t.mm.as_deref().map(mm_size).unwrap_or((0, 0));
+    let (state, _) = task_state_name(t.state);
+    let rt_priority = if t.prio < MAX_RT_PRIO { MAX_RT_PRIO - 1 - t.prio } else { 0 };
+    let _ = write!(
+        m,
+        "{} ({}) {} {} 0 0 0 0 0 {} 0 {} 0 {} {} 0 0 {} {} {} 0 {} {} {} {} ",
+        t.pid, t.comm, state, t.ppid,
+        t.min_flt, t.maj_flt, t.utime, t.stime,
+        t.prio - MAX_RT_PRIO, t.static_prio - MAX_RT_PRIO - 20,
+        nr_threads_of(t.tgid), t.start_time / crate::time::TICK_NSEC,
+        vsize, rss / crate::mm::page::PAGE_SIZE as u64, u64::MAX,
+    );
+    // startcode endcode startstack kstkesp kstkeip signal blocked sigignore sigcatch wchan nswap cnswap
+    let _ = write!(m, "0 0 0 0 0 0 {} 0 0 0 0 0 ", t.sigmask);
+    // exit_signal processor rt_priority policy delayacct_blkio_ticks guest_time cguest_time
+    let _ = write!(m, "17 {} {} {} 0 0 0 ", t.cpu, rt_priority, t.policy);
+    // start_data end_data start_brk arg_start arg_end env_start env_end exit_code
+    let _ = write!(m, "0 0 {} 0 0 0 0 {}\n", t.start_brk, t.exit_code);
+    true
+}
+
+/// /proc/<pid>/status (proc_pid_status)
+fn pid_status_show(pid: usize, index: usize, m: &mut SeqFile) -> bool {
+    let t = match task_snapshot(pid) {
+        Some(t) if index == 0 => t,
+        _ => return false,
+    };
+    let (state, state_name) = task_state_name(t.state);
+    let _ = write!(
+        m,
+        "Name:\t{}\nState:\t{} ({})\nTgid:\t{}\nPid:\t{}\nPPid:\t{}\n",
+        t.comm, state, state_name, t.tgid, t.pid, t.ppid,
+    );
+    if let Some(mm) = t.mm.as_deref() {
+        let (vsize, rss) = mm_size(mm);
+        let _ = write!(m, "VmSize:\t{:8} kB\nVmRSS:\t{:8} kB\n", vsize / 1024, rss / 1024);
+    }
+    let _ = write!(
+        m,
+        "Threads:\t{}\nSigBlk:\t{:016x}\nCpus_allowed:\t{:x}\n\
+         voluntary_ctxt_switches:\t{}\nnonvoluntary_ctxt_switches:\t{}\n",
+        nr_threads_of(t.tgid), t.sigmask, t.cpus_allowed, t.nvcsw, t.nivcsw,
+    );
+    true
+}
+
+/// VMA 的首行：地址范围、权限、偏移、设备、inode 与名称 (show_map_vma)
+fn show_map_vma(m: &mut SeqFile, mm: &crate::mm::pagemap::AddressSpace, vma: &crate::mm::vma::Vma) {
+    use crate::arch::riscv64::vdso::{VDSO_BASE, VDSO_DATA_BASE};
+    use crate::mm::vma::{VmaFlags, VmaType};
+
+    let flags = vma.flags();
+    let start = vma.start().as_usize();
+    let end = vma.end().as_usize();
+    let brk = mm.brk().as_usize();
+    let name = if start as u64 == VDSO_BASE {
+        "[vdso]"
+    } else if start as u64 == VDSO_DATA_BASE {
+        "[vvar]"
+    } else if flags.contains(VmaFlags::GROWSDOWN) {
+        "[stack]"
+    } else if vma.vma_type() == VmaType::Anonymous && brk != 0 && start < brk && end >= brk {
+        "[heap]"
+    } else {
+        ""
+    };
+    let perm = |set: bool, c: char| if set { c } else { '-' };
+    m.setwidth(73);
+    let _ = write!(
+        m,
+        "{:08x}-{:08x} {}{}{}{} {:08x} 00:00 {} ",
+        start, end,
+        perm(flags.is_readable(), 'r'), perm(flags.is_writable(), 'w'),
+        perm(flags.is_executable(), 'x'), if flags.is_shared() { 's' } else { 'p' },
+        vma.offset(), vma.mapping().unwrap_or(0),
+    );
+    if !name.is_empty() {
+        m.pad();
+        m.puts(name);
+    }
+    m.puts("\n");
+}
+
+/// 取出下一个 VMA：起始地址不小于上一个 VMA 的结束地址 m.cursor (m_start / m_next)
+///
+/// 按地址而不是序号续读，两次读取之间 VMA 有增删时也不会重复或跳过未变的 VMA
+fn next_vma(pid: usize, m: &mut SeqFile) -> Option<(Arc<crate::mm::pagemap::AddressSpace>, crate::mm::vma::Vma)> {
+    use crate::mm::vma::VirtAddr;
+
+    let mm = match crate::sched::sched::with_task(pid as Pid, |task| task.address_space_arc()) {
+        Some(Some(mm)) => mm,
+        _ => return None,
+    };
+    let vma = mm.vma_read().find_vma_after(VirtAddr::new(m.cursor)).copied()?;
+    m.cursor = vma.end().as_usize();
+    Some((mm, vma))
+}
+
+/// /proc/<pid>/maps，每个 VMA 一条记录 (show_map)
+fn show_map(pid: usize, _index: usize, m: &mut SeqFile) -> bool {
+    match next_vma(pid, m) {
+        Some((mm, vma)) => {
+            show_map_vma(m, &mm, &vma);
+            true
+        }
+        None => false,
+    }
+}
+
+/// /proc/<pid>/smaps，每个 VMA 一条记录 (show_smap)
+///
+/// 在 maps 的每一行后附上页表遍历得到的驻留内存统计，单位 kB
+fn show_smap(pid: usize, _index: usize, m: &mut SeqFile) -> bool {
+    use crate::arch::riscv64::mm::PSS_SHIFT;
+    use crate::mm::vma::VmaFlags;
+
+    let (mm, vma) = match next_vma(pid, m) {
+        Some(next) => next,
+        None => return false,
+    };
+    let mss = mm.smaps(&vma);
+    show_map_vma(m, &mm, &vma);
+    show_val_kb(m, "Size:", vma.size() as u64 / 1024);
+    show_val_kb(m, "KernelPageSize:", crate::mm::page::PAGE_SIZE / 1024);
+    show_val_kb(m, "MMUPageSize:", crate::mm::page::PAGE_SIZE / 1024);
+    show_val_kb(m, "Rss:", mss.resident / 1024);
+    show_val_kb(m, "Pss:", (mss.pss >> PSS_SHIFT) / 1024);
+    show_val_kb(m, "Shared_Clean:", mss.shared_clean / 1024);
+    show_val_kb(m, "Shared_Dirty:", mss.shared_dirty / 1024);
+    show_val_kb(m, "Private_Clean:", mss.private_clean / 1024);
+    show_val_kb(m, "Private_Dirty:", mss.private_dirty / 1024);
+    show_val_kb(m, "Referenced:", mss.referenced / 1024);
+    show_val_kb(m, "Anonymous:", mss.anonymous / 1024);
+    show_val_kb(m, "Swap:", mss.swap / 1024);
+
+    // VmFlags (show_smap_vma_flags)
+    let flags = vma.flags();
+    m.puts("VmFlags:");
+    for (bit, name) in [
+        (VmaFlags::READ, "rd"), (VmaFlags::WRITE, "wr"), (VmaFlags::EXEC, "ex"),
+        (VmaFlags::SHARED, "sh"), (VmaFlags::GROWSDOWN, "gd"), (VmaFlags::LOCKED, "lo"),
+        (VmaFlags::HUGETLB, "ht"), (VmaFlags::HUGEPAGE, "hg"),
+        (VmaFlags::NOHUGEPAGE, "nh"), (VmaFlags::MERGEABLE, "mg"),
+    ] {
+        if flags.contains(bit) {
+            m.puts(" ");
+            m.puts(name);
+        }
+    }
+    m.puts(" \n");
+    true
+}
+
+/// /proc/<pid>/io (proc_pid_io_accounting)
+///
+/// 没有块设备层的记账，read_bytes、write_bytes 为 0
+fn pid_io_show(pid: usize, index: usize, m: &mut SeqFile) -> bool {
+    if index > 0 {
+        return false;
+    }
+    crate::sched::sched::with_task(pid as Pid, |task| {
+        let acct = &task.acct;
+        let _ = write!(
+            m,
+            "rchar: {}\nwchar: {}\nsyscr: {}\nsyscw: {}\nread_bytes: 0\nwrite_bytes: 0\ncancelled_write_bytes: 0\n",
+            acct.rchar.load(Ordering::Relaxed),
+            acct.wchar.load(Ordering::Relaxed),
+            acct.syscr.load(Ordering::Relaxed),
+            acct.syscw.load(Ordering::Relaxed),
+        );
+    }).is_some()
+}
+
+/// /proc/<pid>/oom_score (proc_oom_score)
+///
+/// 评分要遍历页表，先在任务表锁内取出地址空间
+fn pid_oom_score_show(pid: usize, index: usize, m: &mut SeqFile) -> bool {
+    if index > 0 {
+        return false;
+    }
+    let (mm, score_adj, tgid) = match crate::sched::sched::with_task(pid as Pid, |task| {
+        (task.address_space_arc(), task.oom.score_adj.load(Ordering::Relaxed), task.tgid())
+    }) {
+        Some(snapshot) => snapshot,
+        None => return false,
+    };
+    let score = match mm {
+        Some(mm) if tgid != 1 => crate::mm::oom_kill::oom_score(&mm, score_adj),
+        _ => 0,
+    };
+    let _ = write!(m, "{}\n", score);
+    true
+}
+
+/// /proc/<pid>/oom_score_adj (oom_score_adj_read)
+fn pid_oom_score_adj_show(pid: usize, index: usize, m: &mut SeqFile) -> bool {
+    if index > 0 {
+        return false;
+    }
+    crate::sched::sched::with_task(pid as Pid, |task| {
+        let _ = write!(m, "{}\n", task.oom.score_adj.load(Ordering::Relaxed));
+    }).is_some()
+}
+
+/// 写入 -1000..1000，作用于整个线程组 (oom_score_adj_write)
+fn pid_oom_score_adj_write(pid: usize, data: &[u8]) -> Result<usize, i32> {
+    let einval = crate::errno::Errno::InvalidArgument.as_neg_i32();
+    let score_adj = core::str::from_utf8(data)
+        .ok()
+        .and_then(|text| text.trim().parse::<i32>().ok())
+        .ok_or(einval)?;
+    crate::mm::oom_kill::set_oom_score_adj(pid as Pid, score_adj)?;
+    Ok(data.len())
+}
+
+/// /proc/<pid>/schedstat (proc_pid_schedstat)
+///
+/// 运行时间 (ns)、在运行队列中等待的时间 (ns)、上 CPU 次数
+fn pid_schedstat_show(pid: usize, index: usize, m: &mut SeqFile) -> bool {
+    if index > 0 {
+        return false;
+    }
+    let now = crate::sched::fair::sched_clock();
+    crate::sched::sched::with_task(pid as Pid, |task| {
+        let running = crate::sched::task_curr(task as *const Task);
+        let info = &task.se.sched_info;
+        let _ = write!(
+            m,
+            "{} {} {}\n",
+            crate::sched::stats::task_sched_runtime(task, running, now),
+            info.run_delay,
+            info.pcount,
+        );
+    }).is_some()
 }
 
 /// 生成 /proc/cmdline 内容
@@ -485,6 +1480,144 @@ fn generate_cmdline() -> Vec<u8> {
     }
 }
 
+/// 生成 /proc/slabinfo 内容
+fn generate_slabinfo() -> Vec<u8> {
+    crate::mm::kmem_cache::slabinfo().into_bytes()
+}
+
+/// 生成 /proc/buddyinfo 内容
+fn generate_buddyinfo() -> Vec<u8> {
+    crate::mm::buddy_allocator::buddyinfo().into_bytes()
+}
+
+/// 生成 /proc/vmstat 内容
+fn generate_vmstat() -> Vec<u8> {
+    crate::mm::vmstat::vmstat().into_bytes()
+}
+
+/// 生成 /proc/cpuidle 内容
+fn generate_cpuidle() -> Vec<u8> {
+    crate::sched::idle::cpuidle_show().into_bytes()
+}
+
+/// 生成 /proc/kstackinfo 内容
+fn generate_kstackinfo() -> Vec<u8> {
+    crate::process::kstack::kstackinfo().into_bytes()
+}
+
+/// 生成 /proc/net/skb_pool 内容
+fn generate_skb_pool() -> Vec<u8> {
+    crate::net::skb_pool::skb_pool_info().into_bytes()
+}
+
+/// 生成 /proc/net/snmp 内容：IP 分片与重组计数
+fn generate_snmp() -> Vec<u8> {
+    crate::net::ipv4::ip_fragment::ip_frag_snmp().into_bytes()
+}
+
+/// 生成 /proc/net/xdp 内容
+fn generate_xdp() -> Vec<u8> {
+    match crate::drivers::net::virtio_net::get_device() {
+        Some(dev) => dev.xdp().show("eth0").into_bytes(),
+        None => Vec::new(),
+    }
+}
+
+/// 写入 /proc/net/xdp：为 eth0 装入或卸载程序
+fn write_xdp(data: &[u8]) -> Result<usize, i32> {
+    match crate::drivers::net::virtio_net::get_device() {
+        Some(dev) => dev.xdp().write_control(data),
+        None => Err(crate::errno::Errno::NoSuchDevice.as_neg_i32()),
+    }
+}
+
+/// 生成 /proc/diskstats 内容
+fn generate_diskstats() -> Vec<u8> {
+    crate::drivers::blkdev::show_diskstats().into_bytes()
+}
+
+/// 生成 /proc/disk_latency/<磁盘名> 内容
+fn generate_disk_latency(major: usize) -> Vec<u8> {
+    match crate::drivers::blkdev::get_disk(major as u32) {
+        Some(disk) => unsafe { (*disk).stats.show_latency().into_bytes() },
+        None => Vec::new(),
+    }
+}
+
+/// 写入 /proc/disk_latency/<磁盘名>：`reset` 清零直方图
+fn write_disk_latency(major: usize, data: &[u8]) -> Result<usize, i32> {
+    match crate::drivers::blkdev::get_disk(major as u32) {
+        Some(disk) => unsafe { (*disk).stats.write_control(data) },
+        None => Err(crate::errno::Errno::NoSuchDevice.as_neg_i32()),
+    }
+}
+
+/// 生成 /proc/tracepoints 内容
+fn generate_tracepoints() -> Vec<u8> {
+    crate::trace::generate_list().into_bytes()
+}
+
+/// 生成 /proc/trace_events 内容
+fn generate_trace_events() -> Vec<u8> {
+    crate::trace::ring_buffer::generate_events().into_bytes()
+}
+
+/// 生成 /proc/lock_stat 内容
+fn generate_lock_stat() -> Vec<u8> {
+    crate::sync::spinlock::generate_lock_stat().into_bytes()
+}
+
+/// 生成 /proc/interrupts 内容
+fn generate_interrupts() -> Vec<u8> {
+    crate::irq::show_interrupts().into_bytes()
+}
+
+/// 生成 /proc/syscall_stats 内容
+fn generate_syscall_stats() -> Vec<u8> {
+    crate::arch::riscv64::syscall_stats::generate_stats().into_bytes()
+}
+
+/// 生成 /proc/profile 内容
+fn generate_profile() -> Vec<u8> {
+    crate::profile::generate_profile().into_bytes()
+}
+
+fn generate_dirty_ratio() -> Vec<u8> {
+    format!("{}\n", crate::mm::writeback::dirty_ratio()).into_bytes()
+}
+
+fn generate_dirty_background_ratio() -> Vec<u8> {
+    format!("{}\n", crate::mm::writeback::dirty_background_ratio()).into_bytes()
+}
+
+fn generate_busy_read() -> Vec<u8> {
+    format!("{}\n", crate::net::busy_poll::busy_read()).into_bytes()
+}
+
+fn generate_busy_poll() -> Vec<u8> {
+    format!("{}\n", crate::net::busy_poll::busy_poll()).into_bytes()
+}
+
+/// /proc/sys/vm/transparent_hugepage：当前模式用方括号标出 (enabled_show)
+fn generate_transparent_hugepage() -> Vec<u8> {
+    use crate::arch::riscv64::mm::{transparent_hugepage, ThpMode};
+
+    let current = transparent_hugepage();
+    let mut out = String::new();
+    for (mode, name) in [(ThpMode::Always, "always"), (ThpMode::Madvise, "madvise"), (ThpMode::Never, "never")] {
+        if !out.is_empty() {
+            out.push(' ');
+        }
+        if mode == current {
+            out.push_str(&format!("[{}]", name));
+        } else {
+            out.push_str(name);
+        }
+    }
+    out.push('\n');
+    out.into_bytes()
+}
+
 // ==================== 文件系统类型注册 ====================
 
 /// ProcFS 文件系统类型
@@ -532,6 +1665,28 @@ pub fn read_file(path: &str) -> Option<Vec<u8>> {
     get_procfs_sb()?.read_file(path)
 }
 
+/// 写入 /proc 文件
+pub fn write_file(path: &str, data: &[u8]) -> Result<usize, i32> {
+    match get_procfs_sb() {
+        Some(sb) => sb.write_file(path, data),
+        None => Err(crate::errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
+    }
+}
+
+/// 为新注册的中断创建 /proc/irq/N，procfs 尚未初始化时由初始化补建
+pub fn register_irq_proc(irq: usize) {
+    if let Some(sb) = get_procfs_sb() {
+        sb.register_irq_proc(irq);
+    }
+}
+
+/// 为新注册的磁盘创建 /proc/disk_latency/<磁盘名>，procfs 尚未初始化时由初始化补建
+pub fn register_disk_proc(major: u32) {
+    if let Some(sb) = get_procfs_sb() {
+        sb.register_disk_proc(major);
+    }
+}
+
 /// 列出 /proc 目录
 pub fn list_dir(path: &str) -> Option<Vec<(Vec<u8>, ProcFSType, u64)>> {
     get_procfs_sb()?.list_dir(path)
@@ -578,14 +1733,15 @@ pub fn mount_procfs() -> Result<(), i32> {
         return Err(-1);
     }
 
-    let mount = alloc::boxed::Box::new(VfsMount::new(
+    // 登记到初始命名空间，/proc 之下的路径由 lookup_mnt 交给 procfs
+    let mount = Arc::new(VfsMount::new(
         b"/proc".to_vec(),
         b"/proc".to_vec(),
         MntFlags::new(0),
         Some(procfs_sb_ptr as *mut u8),
-    ));
-    let mount_ptr = alloc::boxed::Box::into_raw(mount) as *mut VfsMount;
-    GLOBAL_PROC_MOUNT.store(mount_ptr, Ordering::Release);
+    ).with_fstype(&PROCFS_FS_TYPE));
+    crate::fs::mount::get_init_namespace().add_mount(mount.clone())?;
+    GLOBAL_PROC_MOUNT.store(Arc::as_ptr(&mount) as *mut VfsMount, Ordering::Release);
 
     Ok(())
 }
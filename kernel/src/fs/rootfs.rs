@@ -14,17 +14,19 @@
 //! - 支持目录和常规文件
 //! - 不支持块设备
 //! - 不需要磁盘
+//! - initramfs 解出的文件直接引用归档中的数据 (FileData::Initramfs)，第一次写入时才复制
 
 use crate::errno;
 use crate::fs::superblock::{SuperBlock, SuperBlockFlags, FileSystemType, FsContext};
 use crate::fs::mount::VfsMount;
 use crate::fs::path::path_normalize;
+use crate::fs::dentry::Dentry;
+use crate::fs::namei::{d_invalidate, path_walk, PathWalk};
 use alloc::sync::Arc;
 use alloc::vec::Vec;
 use alloc::boxed::Box;
-use alloc::string::String;
-use alloc::borrow::ToOwned;
-use spin::Mutex;
+use crate::fs::dir_index::{ChildIndex, DirEntryName};
+use spin::RwLock;
 use core::sync::atomic::{AtomicU64, AtomicPtr, Ordering};
 
 pub const ROOTFS_MAGIC: u32 = 0x73636673;  // "sfsf" - Simple File System
@@ -33,115 +35,6 @@ static GLOBAL_ROOTFS_SB: AtomicPtr<RootFSSuperBlock> = AtomicPtr::new(core::ptr:
 
 static GLOBAL_ROOT_MOUNT: AtomicPtr<VfsMount> = AtomicPtr::new(core::ptr::null_mut());
 
-// ============================================================================
-// RootFS 路径缓存 (Path Cache)
-// ============================================================================
-
-const ROOTFS_PATH_CACHE_SIZE: usize = 64;  // 减少缓存大小以避免内存分配失败
-
-struct RootFSPathCacheEntry {
-    /// 完整路径
-    path: String,
-    /// 节点引用
-    node: Option<Arc<RootFSNode>>,
-}
-
-impl RootFSPathCacheEntry {
-    fn new() -> Self {
-        Self {
-            path: String::new(),
-            node: None,
-        }
-    }
-}
-
-struct RootFSPathCache {
-    /// 哈希表桶
-    buckets: [RootFSPathCacheEntry; ROOTFS_PATH_CACHE_SIZE],
-    /// 缓存命中计数
-    hits: AtomicU64,
-    /// 缓存未命中计数
-    misses: AtomicU64,
-}
-
-unsafe impl Send for RootFSPathCache {}
-unsafe impl Sync for RootFSPathCache {}
-
-static ROOTFS_PATH_CACHE: Mutex<Option<RootFSPathCache>> = Mutex::new(None);
-
-fn rootfs_path_cache_init() {
-    let mut cache = ROOTFS_PATH_CACHE.lock();
-    if cache.is_some() {
-        return;  // 已经初始化
-    }
-
-    // 使用 from_fn 创建数组（避免 Copy trait 要求）
-    let buckets: [RootFSPathCacheEntry; ROOTFS_PATH_CACHE_SIZE] =
-        core::array::from_fn(|_| RootFSPathCacheEntry::new());
-
-    *cache = Some(RootFSPathCache {
-        buckets,
-        hits: AtomicU64::new(0),
-        misses: AtomicU64::new(0),
-    });
-}
-
-fn rootfs_path_hash(path: &str) -> u64 {
-    let mut hash = 0xcbf29ce484222325_u64;  // FNV offset basis
-    for byte in path.bytes() {
-        hash ^= byte as u64;
-        hash = hash.wrapping_mul(0x100000001b3);
-    }
-    hash
-}
-
-fn rootfs_path_cache_lookup(path: &str) -> Option<Arc<RootFSNode>> {
-    rootfs_path_cache_init();
-
-    let cache = ROOTFS_PATH_CACHE.lock();
-    let cache_inner = cache.as_ref()?;
-
-    let hash = rootfs_path_hash(path);
-    let index = (hash as usize) % ROOTFS_PATH_CACHE_SIZE;
-
-    let bucket = &cache_inner.buckets[index];
-    if bucket.path == path {
-        if let Some(ref node) = bucket.node {
-            cache_inner.hits.fetch_add(1, Ordering::Relaxed);
-            return Some(node.clone());
-        }
-    }
-
-    cache_inner.misses.fetch_add(1, Ordering::Relaxed);
-    None
-}
-
-fn rootfs_path_cache_add(path: &str, node: Arc<RootFSNode>) {
-    rootfs_path_cache_init();
-
-    let mut cache = ROOTFS_PATH_CACHE.lock();
-    let inner = cache.as_mut().expect("cache not initialized");
-
-    let hash = rootfs_path_hash(path);
-    let index = (hash as usize) % ROOTFS_PATH_CACHE_SIZE;
-
-    // 简单的 LRU：直接覆盖旧条目
-    inner.buckets[index].path = path.to_owned();
-    inner.buckets[index].node = Some(node);
-}
-
-fn rootfs_path_cache_stats() -> (u64, u64) {
-    rootfs_path_cache_init();
-
-    let cache = ROOTFS_PATH_CACHE.lock();
-    let cache_inner = cache.as_ref().expect("cache not initialized");
-
-    (
-        cache_inner.hits.load(Ordering::Relaxed),
-        cache_inner.misses.load(Ordering::Relaxed),
-    )
-}
-
 pub fn get_rootfs_sb() -> Option<*mut RootFSSuperBlock> {
     let ptr = GLOBAL_ROOTFS_SB.load(Ordering::Acquire);
     if ptr.is_null() {
@@ -171,7 +64,51 @@ pub enum RootFSType {
     SymbolicLink,
 }
 
-const MAX_SYMLINKS: usize = 40;
+/// 文件数据
+#[derive(Clone)]
+pub enum FileData {
+    /// 堆上的数据
+    Owned(Vec<u8>),
+    /// initramfs 归档中的数据，归档所在的内存在启动后一直保留
+    Initramfs(&'static [u8]),
+}
+
+impl FileData {
+    pub fn len(&self) -> usize {
+        self.as_slice().len()
+    }
+
+    pub fn as_slice(&self) -> &[u8] {
+        match self {
+            FileData::Owned(data) => data,
+            FileData::Initramfs(data) => data,
+        }
+    }
+
+    /// 可写的数据，initramfs 中的数据先复制到堆上
+    pub fn to_mut(&mut self) -> &mut Vec<u8> {
+        if let FileData::Initramfs(data) = *self {
+            *self = FileData::Owned(data.to_vec());
+        }
+        match self {
+            FileData::Owned(data) => data,
+            FileData::Initramfs(_) => unreachable!(),
+        }
+    }
+
+    /// 第 index 页完整地位于页对齐的 initramfs 数据中时返回它的物理地址
+    pub fn direct_page(&self, index: usize) -> Option<usize> {
+        let data = match self {
+            FileData::Initramfs(data) => *data,
+            FileData::Owned(_) => return None,
+        };
+        let start = data.as_ptr() as usize;
+        if start % crate::mm::PAGE_SIZE != 0 || (index + 1) * crate::mm::PAGE_SIZE > data.len() {
+            return None;
+        }
+        Some(start + index * crate::mm::PAGE_SIZE)
+    }
+}
 
 #[repr(C)]
 pub struct RootFSNode {
@@ -180,11 +117,11 @@ pub struct RootFSNode {
     /// 节点类型
     pub node_type: RootFSType,
     /// 节点数据（如果是文件）
-    pub data: Option<Vec<u8>>,
+    pub data: Option<FileData>,
     /// 符号链接目标（如果是符号链接）
     pub link_target: Option<Vec<u8>>,
-    /// 子节点（如果是目录）
-    pub children: Mutex<Vec<Arc<RootFSNode>>>,
+    /// 子节点（如果是目录），子节点多时带名字哈希表
+    pub children: RwLock<ChildIndex<RootFSNode>>,
     /// 引用计数
     ref_count: AtomicU64,
     /// 节点 ID
@@ -194,6 +131,27 @@ pub struct RootFSNode {
 unsafe impl Send for RootFSNode {}
 unsafe impl Sync for RootFSNode {}
 
+impl DirEntryName for RootFSNode {
+    fn entry_name(&self) -> &[u8] {
+        &self.name
+    }
+}
+
+/// rootfs 文件作为页缓存的数据来源
+impl crate::mm::filemap::MappingSource for RootFSNode {
+    fn size(&self) -> usize {
+        self.data.as_ref().map_or(0, |d| d.len())
+    }
+
+    fn read_page(&self, index: usize, buf: &mut [u8]) -> usize {
+        self.read_data(index * crate::mm::PAGE_SIZE, buf)
+    }
+
+    fn direct_page(&self, index: usize) -> Option<usize> {
+        self.data.as_ref()?.direct_page(index)
+    }
+}
+
 impl RootFSNode {
     /// 创建新节点
     pub fn new(name: Vec<u8>, node_type: RootFSType, ino: u64) -> Self {
@@ -202,7 +160,7 @@ impl RootFSNode {
             node_type,
             data: None,
             link_target: None,
-            children: Mutex::new(Vec::new()),
+            children: RwLock::new(ChildIndex::new()),
             ref_count: AtomicU64::new(1),
             ino,
         }
@@ -215,6 +173,11 @@ impl RootFSNode {
 
     /// 创建文件节点
     pub fn new_file(name: Vec<u8>, data: Vec<u8>, ino: u64) -> Self {
+        Self::new_file_data(name, FileData::Owned(data), ino)
+    }
+
+    /// 创建文件节点，数据可以引用 initramfs
+    pub fn new_file_data(name: Vec<u8>, data: FileData, ino: u64) -> Self {
         let mut node = Self::new(name, RootFSType::RegularFile, ino);
         node.data = Some(data);
         node
@@ -241,53 +204,55 @@ impl RootFSNode {
 
     /// 添加子节点
     pub fn add_child(&self, child: Arc<RootFSNode>) {
-        let mut children = self.children.lock();
-        children.push(child);
+        self.children.write().push(child);
     }
 
     /// 移除子节点
     pub fn remove_child(&self, name: &[u8]) -> bool {
-        let mut children = self.children.lock();
-        if let Some(pos) = children.iter().position(|c| c.as_ref().name == name) {
-            children.remove(pos);
-            true
-        } else {
-            false
-        }
+        self.children.write().remove(name).is_some()
     }
 
     /// 重命名子节点
     pub fn rename_child(&self, old_name: &[u8], new_name: Vec<u8>) -> Result<(), ()> {
-        let children = self.children.lock();
-        let pos = children.iter().position(|c| c.as_ref().name == old_name).ok_or(())?;
+        let mut children = self.children.write();
+        let child = children.find(old_name).ok_or(())?;
 
         // Arc 不提供内部可变性，我们需要使用 unsafe
-        // 这在文件系统中是安全的，因为我们持有父目录的锁
+        // 这在文件系统中是安全的，因为我们持有父目录的写锁，查找都在读锁下进行
         unsafe {
-            let node_ptr = Arc::as_ptr(&children[pos]) as *mut RootFSNode;
+            let node_ptr = Arc::as_ptr(child) as *mut RootFSNode;
             (*node_ptr).name = new_name;
         }
+        children.reindex();
 
         Ok(())
     }
 
     /// 查找子节点
     pub fn find_child(&self, name: &[u8]) -> Option<Arc<RootFSNode>> {
-        let children = self.children.lock();
-        for child in children.iter() {
-            if child.as_ref().name == name {
-                // Arc 已实现 Clone trait
-                return Some(child.clone());
+        self.children.read().find(name).cloned()
+    }
+
+    /// 获取所有子节点的引用
+    pub fn list_children(&self) -> Vec<Arc<RootFSNode>> {
+        self.children.read().iter().cloned().collect()
+    }
+
+    /// 在读锁下从第 start 个子节点开始遍历，不复制引用 (dcache_readdir)
+    ///
+    /// # 参数
+    /// - `f`: 返回 false 时停止遍历
+    pub fn for_each_child(&self, start: usize, mut f: impl FnMut(&RootFSNode) -> bool) {
+        for child in self.children.read().iter().skip(start) {
+            if !f(child) {
+                break;
             }
         }
-        None
     }
 
-    /// 获取所有子节点
-    pub fn list_children(&self) -> Vec<Arc<RootFSNode>> {
-        let children = self.children.lock();
-        // 克隆每个 Arc 引用
-        children.iter().map(|child| child.clone()).collect()
+    /// 是否有子节点
+    pub fn has_children(&self) -> bool {
+        !self.children.read().is_empty()
     }
 
     /// 检查是否是目录
@@ -313,6 +278,7 @@ impl RootFSNode {
     /// 读取文件数据
     pub fn read_data(&self, offset: usize, buf: &mut [u8]) -> usize {
         if let Some(ref data) = self.data {
+            let data = data.as_slice();
             if offset >= data.len() {
                 return 0;
             }
@@ -328,10 +294,11 @@ impl RootFSNode {
     /// 写入文件数据
     pub fn write_data(&mut self, offset: usize, data: &[u8]) -> usize {
         if self.data.is_none() {
-            self.data = Some(Vec::new());
+            self.data = Some(FileData::Owned(Vec::new()));
         }
 
         if let Some(ref mut existing_data) = self.data {
+            let existing_data = existing_data.to_mut();
             // 确保向量足够大
             let required_size = offset + data.len();
             if existing_data.len() < required_size {
@@ -340,6 +307,8 @@ impl RootFSNode {
 
             // 从 offset 位置开始写入数据
             existing_data[offset..offset + data.len()].copy_from_slice(data);
+            // 已映射的页缓存与文件内容保持一致
+            crate::mm::filemap::update_cached_pages(self.ino, offset, data);
             data.len()
         } else {
             0
@@ -386,6 +355,11 @@ impl RootFSSuperBlock {
 
     /// 在指定路径创建文件
     pub fn create_file(&self, path: &str, data: Vec<u8>) -> Result<(), i32> {
+        self.create_file_data(path, FileData::Owned(data))
+    }
+
+    /// 在指定路径创建文件，数据可以引用 initramfs
+    pub fn create_file_data(&self, path: &str, data: FileData) -> Result<(), i32> {
         // 解析路径
         let components: Vec<&str> = path.split('/').filter(|s| !s.is_empty()).collect();
 
@@ -414,7 +388,8 @@ impl RootFSSuperBlock {
         // 创建新文件
         let filename = components.last().unwrap().as_bytes().to_vec();
         let ino = self.alloc_ino();
-        let new_file = Arc::new(RootFSNode::new_file(filename, data, ino));
+        let new_file = Arc::new(RootFSNode::new_file_data(filename, data, ino));
+        self.d_invalidate(&current, &new_file.name);
         current.add_child(new_file);
 
         Ok(())
@@ -470,6 +445,7 @@ impl RootFSSuperBlock {
         let dirname = dirname.to_vec();
         let ino = self.alloc_ino();
         let new_dir = Arc::new(RootFSNode::new_dir(dirname, ino));
+        self.d_invalidate(&current, &new_dir.name);
         current.add_child(new_dir);
 
         Ok(())
@@ -566,15 +542,17 @@ impl RootFSSuperBlock {
 
             // 简化实现：创建新节点，复制数据引用
             let new_name = new_name.to_vec();
-            let mut node = RootFSNode::new_file(
+            let mut node = RootFSNode::new_file_data(
                 new_name,
-                old_node.data.clone().unwrap_or_default(),
+                old_node.data.clone().unwrap_or(FileData::Owned(Vec::new())),
                 old_node.ino  // 使用相同的 ino（真正的硬链接）
             );
             node.link_target = old_node.link_target.clone();
             Arc::new(node)
         };
 
+        self.d_invalidate(&current, &new_link.name);
+
         current.add_child(new_link);
 
         Ok(())
@@ -587,79 +565,17 @@ impl RootFSSuperBlock {
             return Some(self.root_node.clone());
         }
 
-        // 检查是否是相对路径
-        let is_relative = !path.starts_with('/');
-
-        // 规范化路径（处理 . 和 ..）
-        let normalized = path_normalize(path);
-
-        // 如果是相对路径，暂时不支持（需要当前工作目录）
-        if is_relative && !normalized.is_empty() && !normalized.starts_with("..") {
-            // TODO: 支持相对路径（需要当前工作目录）
-            // 对于简单的相对路径如 "usr/bin"，可以尝试从根目录查找
-            // 但正确的行为应该是从进程的当前工作目录开始
-            return None;
-        }
-
-        // 如果规范化后为空，返回根目录
-        let normalized_path = if normalized.is_empty() {
-            "/"
-        } else {
-            normalized.as_str()
-        };
-
-        // 尝试从路径缓存查找
-        if let Some(cached) = rootfs_path_cache_lookup(normalized_path) {
-            return Some(cached);
-        }
-
-        // 缓存未命中，执行路径遍历（支持符号链接）
-        let result = self.lookup_follow(normalized_path, 0);
-
-        // 将结果添加到缓存
-        if let Some(ref node) = result {
-            rootfs_path_cache_add(normalized_path, node.clone());
-        }
-
-        result
-    }
-
-    /// 实际执行路径遍历的内部函数（不支持符号链接）
-    fn lookup_walk(&self, path: &str) -> Option<Arc<RootFSNode>> {
-        if path == "/" {
-            return Some(self.root_node.clone());
-        }
-
-        let components: Vec<&str> = path.split('/').filter(|s| !s.is_empty()).collect();
-
-        if components.is_empty() {
-            return Some(self.root_node.clone());
-        }
-
-        // 从根节点开始遍历路径
-        let mut current = self.root_node.clone();
-
-        for (i, component) in components.iter().enumerate() {
-            let component_bytes = component.as_bytes();
-
-            // 从树中查找子节点
-            match current.find_child(component_bytes) {
-                Some(child) => {
-                    if !child.is_dir() && i < components.len() - 1 {
-                        // 不是目录，但路径还没结束
-                        return None;
-                    }
-
-                    current = child;
-                }
-                None => {
-                    // 查找失败
-                    return None;
-                }
+        // 相对路径需要当前工作目录，暂不支持；只由 "." 组成的路径视为根目录
+        if !path.starts_with('/') {
+            if path.split('/').all(|c| c.is_empty() || c == ".") {
+                return Some(self.root_node.clone());
             }
+            return None;
         }
 
-        Some(current)
+        // 逐分量查找（"." 和 ".." 在查找中处理，不需要先规范化），每个分量先查 dcache；
+        // 最后一个分量是符号链接时返回链接本身
+        path_walk(self, path, false).ok()
     }
 
     /// 列出目录内容
@@ -711,6 +627,8 @@ impl RootFSSuperBlock {
         let ino = self.alloc_ino();
         let new_dir = Arc::new(RootFSNode::new_dir(dirname, ino));
 
+        self.d_invalidate(&current, &new_dir.name);
+
         current.add_child(new_dir);
 
         Ok(())
@@ -761,6 +679,7 @@ impl RootFSSuperBlock {
         }
 
         // 删除文件
+        self.d_invalidate(&current, filename);
         if !current.remove_child(filename) {
             return Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32());
         }
@@ -813,11 +732,12 @@ impl RootFSSuperBlock {
         }
 
         // 目录必须为空
-        if !target.list_children().is_empty() {
+        if target.has_children() {
             return Err(errno::Errno::DirectoryNotEmpty.as_neg_i32());
         }
 
         // 删除目录
+        self.d_invalidate(&current, dirname);
         if !current.remove_child(dirname) {
             return Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32());
         }
@@ -896,10 +816,12 @@ impl RootFSSuperBlock {
         // 检查新文件是否已存在
         if new_parent.find_child(&new_name).is_some() {
             // 如果目标存在，需要先删除
+            self.d_invalidate(&new_parent, &new_name);
             new_parent.remove_child(&new_name);
         }
 
         // 从旧父目录中移除
+        self.d_invalidate(&old_parent, old_name);
         if !old_parent.remove_child(old_name) {
             return Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32());
         }
@@ -951,6 +873,8 @@ impl RootFSSuperBlock {
         let ino = self.alloc_ino();
         let new_symlink = Arc::new(RootFSNode::new_symlink(linkname, target_bytes, ino));
 
+        self.d_invalidate(&current, &new_symlink.name);
+
         current.add_child(new_symlink);
 
         Ok(())
@@ -971,83 +895,51 @@ impl RootFSSuperBlock {
         node.get_link_target().ok_or(errno::Errno::NoSuchFileOrDirectory.as_neg_i32())
     }
 
-    /// 跟随符号链接（内部实现）
-    ///
-    ///
-    /// # 参数
-    /// - `link`: 符号链接节点
-    /// - `depth`: 当前递归深度
-    ///
-    /// # 返回
-    /// 成功返回符号链接指向的实际节点，失败返回错误
-    fn follow_link_internal(
-        &self,
-        link: &Arc<RootFSNode>,
-        depth: usize,
-    ) -> Option<Arc<RootFSNode>> {
-        // 检查递归深度
-        if depth >= MAX_SYMLINKS {
-            return None;  // ELOOP: 符号链接层级过深
-        }
-
-        // 获取目标路径
-        let target_bytes = link.get_link_target()?;
-        let target = core::str::from_utf8(&target_bytes).ok()?;
+    /// 目录的名字改变后丢弃 dcache 中的查找结果
+    fn d_invalidate(&self, dir: &RootFSNode, name: &[u8]) {
+        d_invalidate(self.sb.s_dev, dir.ino, name);
+    }
+}
 
-        // 规范化目标路径
-        let normalized = path_normalize(target);
+/// rootfs 的逐分量查找：dcache 的目录项直接持有 RootFSNode
+impl PathWalk for RootFSSuperBlock {
+    type Node = Arc<RootFSNode>;
 
-        // 查找目标节点（递归查找）
-        self.lookup_follow(&normalized, depth + 1)
+    fn s_dev(&self) -> u64 {
+        self.sb.s_dev
     }
 
-    /// 查找路径，支持跟随符号链接（内部实现）
-    ///
-    /// # 参数
-    /// - `path`: 规范化后的路径
-    /// - `depth`: 当前递归深度
-    fn lookup_follow(&self, path: &str, depth: usize) -> Option<Arc<RootFSNode>> {
-        if path == "/" {
-            return Some(self.root_node.clone());
-        }
+    fn root(&self) -> Result<Arc<RootFSNode>, i32> {
+        Ok(self.root_node.clone())
+    }
 
-        let components: Vec<&str> = path.split('/').filter(|s| !s.is_empty()).collect();
+    fn ino(&self, node: &Arc<RootFSNode>) -> u64 {
+        node.ino
+    }
 
-        if components.is_empty() {
-            return Some(self.root_node.clone());
-        }
+    fn is_dir(&self, node: &Arc<RootFSNode>) -> bool {
+        node.is_dir()
+    }
 
-        // 从根节点开始遍历路径
-        let mut current = self.root_node.clone();
+    fn is_symlink(&self, node: &Arc<RootFSNode>) -> bool {
+        node.is_symlink()
+    }
 
-        for (i, component) in components.iter().enumerate() {
-            let component_bytes = component.as_bytes();
+    fn get_link(&self, node: &Arc<RootFSNode>) -> Option<Vec<u8>> {
+        node.get_link_target()
+    }
 
-            // 从树中查找子节点
-            match current.find_child(component_bytes) {
-                Some(child) => {
-                    // 如果是符号链接，跟随它
-                    if child.is_symlink() && i < components.len() - 1 {
-                        // 跟随符号链接
-                        let target = self.follow_link_internal(&child, depth)?;
-                        // 继续从符号链接目标查找
-                        current = target;
-                    } else {
-                        current = child;
-                    }
+    fn lookup(&self, dir: &Arc<RootFSNode>, name: &str) -> Result<Arc<RootFSNode>, i32> {
+        dir.find_child(name.as_bytes())
+            .ok_or(errno::Errno::NoSuchFileOrDirectory.as_neg_i32())
+    }
 
-                    // 检查是否需要继续遍历
-                    if !current.is_dir() && i < components.len() - 1 {
-                        return None;
-                    }
-                }
-                None => {
-                    return None;
-                }
-            }
-        }
+    fn d_instantiate(&self, name: &str, node: &Arc<RootFSNode>) -> Dentry {
+        Dentry::new_positive(name.as_bytes(), node.ino, Some(node.clone()))
+    }
 
-        Some(current)
+    fn d_node(&self, dentry: &Dentry) -> Option<Arc<RootFSNode>> {
+        dentry.d_fsdata.clone()?.downcast::<RootFSNode>().ok()
     }
 }
 
@@ -1070,7 +962,7 @@ pub static ROOTFS_FS_TYPE: FileSystemType = FileSystemType::new(
 
 pub fn init_rootfs() -> Result<(), i32> {
     use crate::fs::superblock::register_filesystem;
-    use crate::fs::mount::MntFlags;
+    use crate::fs::mount::{get_init_namespace, MntFlags};
 
     // 注册 rootfs 文件系统
     register_filesystem(&ROOTFS_FS_TYPE)?;
@@ -1082,22 +974,19 @@ pub fn init_rootfs() -> Result<(), i32> {
     // 保存到全局变量（使用 AtomicPtr 保护）
     GLOBAL_ROOTFS_SB.store(rootfs_sb_ptr, Ordering::Release);
 
-    // 创建根挂载点并泄漏到静态存储
-    let mount = Box::new(VfsMount::new(
+    // 创建根挂载点并登记到初始命名空间，挂载点 ID 为 1（根挂载点）
+    let mut mount = VfsMount::new(
         b"/".to_vec(),      // 挂载点
         b"/".to_vec(),      // 根目录
         MntFlags::new(0),   // 无特殊标志
         Some(rootfs_sb_ptr as *mut u8),  // 超级块
-    ));
-    let mount_ptr = Box::into_raw(mount) as *mut VfsMount;
+    ).with_fstype(&ROOTFS_FS_TYPE);
+    mount.mnt_id = 1;
+    let mount = Arc::new(mount);
+    get_init_namespace().add_mount(mount.clone())?;
 
-    // 保存到全局变量（使用 AtomicPtr 保护）
-    GLOBAL_ROOT_MOUNT.store(mount_ptr, Ordering::Release);
-
-    // 设置挂载点 ID 为 1（根挂载点）
-    unsafe {
-        (*mount_ptr).mnt_id = 1;
-    }
+    // 保存到全局变量（使用 AtomicPtr 保护），命名空间持有的引用使它一直有效
+    GLOBAL_ROOT_MOUNT.store(Arc::as_ptr(&mount) as *mut VfsMount, Ordering::Release);
 
     Ok(())
 }
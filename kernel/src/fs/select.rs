@@ -0,0 +1,293 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! poll / select 的通用实现
+//!
+//! 文件的 poll 方法 (FileOps::poll) 返回就绪掩码，并把就绪状态变化时会唤醒的
+//! 等待队列登记到 PollTable。poll 与 select 只在第一遍扫描时登记，随后等在
+//! 所有队列上，被唤醒或超时后重新扫描，不再每次重复登记。
+//!
+//! 参考: fs/select.c, include/linux/poll.h
+
+use alloc::boxed::Box;
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+
+use crate::fs::file::{poll_mask::*, File};
+use crate::process::task::TaskState;
+use crate::process::wait::{WaitQueueEntry, WaitQueueHead};
+use crate::time::timer::{schedule_timeout, MAX_SCHEDULE_TIMEOUT};
+
+const EBADF: i32 = -9;
+const EINTR: i32 = -4;
+
+/// pollfd 结构体 (struct pollfd)
+///
+#[repr(C)]
+#[derive(Debug, Copy, Clone, PartialEq)]
+pub struct PollFd {
+    pub fd: i32,           // 文件描述符
+    pub events: u16,       // 请求的事件
+    pub revents: u16,      // 返回的事件
+}
+
+/// poll 事件类型
+pub mod poll_events {
+    pub const POLLIN: u16 = 0x0001;      // 可读
+    pub const POLLPRI: u16 = 0x0002;     // 紧急可读
+    pub const POLLOUT: u16 = 0x0004;     // 可写
+    pub const POLLERR: u16 = 0x0008;     // 错误
+    pub const POLLHUP: u16 = 0x0010;     // 挂断
+    pub const POLLNVAL: u16 = 0x0020;    // 无效请求
+    pub const POLLRDNORM: u16 = 0x0040;  // 等同于 POLLIN
+    pub const POLLRDBAND: u16 = 0x0080;  // 优先带数据可读
+    pub const POLLWRNORM: u16 = 0x0100;  // 等同于 POLLOUT
+    pub const POLLWRBAND: u16 = 0x0200;  // 优先带数据可写
+}
+
+/// 没有 poll 方法的文件总是可读可写 (DEFAULT_POLLMASK)
+pub const DEFAULT_POLLMASK: u32 = POLLIN | POLLOUT | POLLRDNORM | POLLWRNORM;
+
+/// select 各集合对应的事件 (POLLIN_SET / POLLOUT_SET / POLLEX_SET)
+const POLLIN_SET: u32 = POLLRDNORM | POLLRDBAND | POLLIN | POLLHUP | POLLERR;
+const POLLOUT_SET: u32 = POLLWRBAND | POLLWRNORM | POLLOUT | POLLERR;
+const POLLEX_SET: u32 = POLLPRI;
+
+/// poll 登记表 (poll_table)
+///
+/// 文件的 poll 方法把等待队列登记在这里，调用方决定在队列上挂什么样的等待项：
+/// poll / select 挂当前任务，epoll 挂回调
+pub struct PollTable {
+    queues: Vec<*const WaitQueueHead>,
+}
+
+impl PollTable {
+    pub fn new() -> Self {
+        Self { queues: Vec::new() }
+    }
+
+    /// 登记的等待队列，在文件关闭之前保持有效
+    pub fn queues(&self) -> &[*const WaitQueueHead] {
+        &self.queues
+    }
+}
+
+/// 登记等待队列 (poll_wait)
+///
+/// pt 为 None 时只查询就绪状态，不登记
+#[inline]
+pub fn poll_wait(queue: &WaitQueueHead, pt: Option<&mut PollTable>) {
+    if let Some(pt) = pt {
+        pt.queues.push(queue as *const WaitQueueHead);
+    }
+}
+
+/// 查询文件的就绪事件并登记等待队列 (vfs_poll)
+pub fn vfs_poll(file: &File, pt: Option<&mut PollTable>) -> u32 {
+    match unsafe { *file.ops.get() }.and_then(|ops| ops.poll) {
+        Some(poll) => poll(file, pt),
+        None => DEFAULT_POLLMASK,
+    }
+}
+
+/// 当前任务在各个等待队列上的等待项 (poll_wqueues)
+///
+/// 释放时从所有队列上摘下 (poll_freewait)
+struct PollWqueues {
+    entries: Vec<(Box<WaitQueueEntry>, *const WaitQueueHead)>,
+}
+
+impl PollWqueues {
+    fn new() -> Self {
+        Self { entries: Vec::new() }
+    }
+
+    /// 在登记的每个队列上挂一个当前任务的等待项 (__pollwait)
+    fn register(&mut self, task: *mut crate::process::Task, pt: &PollTable) {
+        for &queue in pt.queues() {
+            let entry = Box::new(WaitQueueEntry::new(task, false));
+            unsafe { (*queue).add(&entry) };
+            self.entries.push((entry, queue));
+        }
+    }
+
+    /// 从上次睡眠以来是否被唤醒过 (pwq->triggered)，并清除标志
+    fn take_triggered(&self) -> bool {
+        let mut triggered = false;
+        for (entry, _) in self.entries.iter() {
+            if entry.is_woken() {
+                entry.clear_woken();
+                triggered = true;
+            }
+        }
+        triggered
+    }
+}
+
+impl Drop for PollWqueues {
+    fn drop(&mut self) {
+        for (entry, queue) in self.entries.iter() {
+            unsafe { (**queue).remove(entry) };
+        }
+    }
+}
+
+/// 扫描直到有事件、超时或被信号打断 (do_poll / do_select 的公共部分)
+///
+/// # 参数
+/// - timeout_ms: 0 只扫描一遍，负数一直等待
+/// - scan: 扫描一遍，返回就绪数量；参数为 Some 时把等待队列登记进去
+fn poll_loop<F>(timeout_ms: i64, mut scan: F) -> Result<usize, i32>
+where
+    F: FnMut(Option<&mut PollTable>) -> usize,
+{
+    use crate::drivers::timer;
+
+    let deadline = if timeout_ms > 0 {
+        Some(timer::get_jiffies() + timer::msecs_to_jiffies(timeout_ms as u64).max(1))
+    } else {
+        None
+    };
+    let task = if timeout_ms != 0 { crate::sched::current().map(|task| task as *mut crate::process::Task) } else { None };
+    let mut wait = PollWqueues::new();
+    let mut table = task.map(|_| PollTable::new());
+
+    loop {
+        let count = scan(table.as_mut());
+        if let (Some(task), Some(pt)) = (task, table.take()) {
+            wait.register(task, &pt);
+            // 等待项挂上之后再扫描一遍，扫描与登记之间的唤醒不会丢失
+            if count == 0 {
+                continue;
+            }
+        }
+        if count > 0 || task.is_none() {
+            return Ok(count);
+        }
+        if deadline.map_or(false, |deadline| timer::get_jiffies() >= deadline) {
+            return Ok(0);
+        }
+        if crate::signal::signal_pending() {
+            return Err(EINTR);
+        }
+        // 上一遍扫描之后已经有唤醒，直接重新扫描；否则睡到被唤醒或超时
+        if let Some(task) = task {
+            unsafe { (*task).set_state(TaskState::Interruptible) };
+            if !wait.take_triggered() {
+                let timeout = deadline.map_or(MAX_SCHEDULE_TIMEOUT, |deadline| deadline.saturating_sub(timer::get_jiffies()));
+                schedule_timeout(timeout);
+                wait.take_triggered();
+            }
+            unsafe { (*task).set_state(TaskState::Running) };
+        }
+    }
+}
+
+/// poll 的实现 (do_sys_poll)
+///
+/// # 参数
+/// - fds: 已经从用户空间复制进来的 pollfd 数组，返回时 revents 已填写
+/// - files: 与 fds 一一对应的文件，fd 为负时忽略，文件不存在时报告 POLLNVAL
+/// - timeout_ms: 超时，0 立即返回，负数一直等待
+///
+/// # 返回
+/// revents 非零的项数
+pub fn do_poll(fds: &mut [PollFd], files: &[Option<Arc<File>>], timeout_ms: i64) -> Result<usize, i32> {
+    poll_loop(timeout_ms, |mut pt| {
+        let mut count = 0;
+        for (pollfd, file) in fds.iter_mut().zip(files.iter()) {
+            pollfd.revents = 0;
+            if pollfd.fd < 0 {
+                continue;
+            }
+            let mask = match file {
+                Some(file) => {
+                    // POLLERR 与 POLLHUP 总是报告
+                    let wanted = pollfd.events as u32 | POLLERR | POLLHUP;
+                    vfs_poll(file, pt.as_deref_mut()) & wanted
+                }
+                None => poll_events::POLLNVAL as u32,
+            };
+            pollfd.revents = mask as u16;
+            if mask != 0 {
+                count += 1;
+            }
+        }
+        count
+    })
+}
+
+/// select 的实现 (core_sys_select / do_select)
+///
+/// # 参数
+/// - nfds: 最高文件描述符 + 1
+/// - sets: 可读、可写、异常三个位图，每个至少 nfds 位；返回时改写为就绪的描述符
+/// - lookup: 由描述符查找文件
+/// - timeout_ms: 超时，0 立即返回，负数一直等待
+///
+/// # 返回
+/// 三个集合中置位的总数；集合中有未打开的描述符返回 EBADF
+pub fn do_select<L>(nfds: usize, sets: [&mut [u64]; 3], lookup: L, timeout_ms: i64) -> Result<usize, i32>
+where
+    L: Fn(usize) -> Option<Arc<File>>,
+{
+    let [inp, outp, exp] = sets;
+    let word = |set: &[u64], fd: usize| set.get(fd / 64).map_or(0, |w| (w >> (fd % 64)) & 1);
+
+    // 只查找一次文件 (max_select_fd)
+    let mut files: Vec<(usize, Arc<File>)> = Vec::new();
+    for fd in 0..nfds {
+        if word(inp, fd) | word(outp, fd) | word(exp, fd) == 0 {
+            continue;
+        }
+        match lookup(fd) {
+            Some(file) => files.push((fd, file)),
+            None => return Err(EBADF),
+        }
+    }
+
+    // 每个文件在三个集合中分别关心的事件
+    const SETS: [u32; 3] = [POLLIN_SET, POLLOUT_SET, POLLEX_SET];
+    let wanted: Vec<[u32; 3]> = files.iter().map(|&(fd, _)| {
+        let mut wanted = [0; 3];
+        for (k, set) in [&*inp, &*outp, &*exp].iter().enumerate() {
+            if word(set, fd) != 0 {
+                wanted[k] = SETS[k];
+            }
+        }
+        wanted
+    }).collect();
+    let mut ready = alloc::vec![[false; 3]; files.len()];
+
+    let count = poll_loop(timeout_ms, |mut pt| {
+        let mut count = 0;
+        for (i, (_, file)) in files.iter().enumerate() {
+            let mask = vfs_poll(file, pt.as_deref_mut());
+            for k in 0..3 {
+                ready[i][k] = mask & wanted[i][k] != 0;
+                if ready[i][k] {
+                    count += 1;
+                }
+            }
+        }
+        count
+    })?;
+
+    // 把结果写回三个位图
+    let words = (nfds + 63) / 64;
+    for set in [&mut *inp, &mut *outp, &mut *exp] {
+        for w in set.iter_mut().take(words) {
+            *w = 0;
+        }
+    }
+    for (i, &(fd, _)) in files.iter().enumerate() {
+        let bit = 1u64 << (fd % 64);
+        for (k, set) in [&mut *inp, &mut *outp, &mut *exp].into_iter().enumerate() {
+            if ready[i][k] {
+                set[fd / 64] |= bit;
+            }
+        }
+    }
+    Ok(count)
+}
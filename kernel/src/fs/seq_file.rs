@@ -0,0 +1,161 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 顺序文件：按记录逐条生成内容
+//!
+//! 参考: fs/seq_file.c
+//!
+//! 生成函数每次把一条记录写入打开文件的缓冲区，读取只生成覆盖所读范围的记录：
+//! - 每个打开的文件保存下一条记录的序号、当前记录和读到的位置，顺序读取从上次停下的地方继续
+//! - 读取位置与上次结束的位置不同时，从第 0 条记录重新生成并跳过前面的字节 (traverse)
+//! - 记录缓冲区在打开期间重用，只在遇到更长的记录时增长
+
+use alloc::vec::Vec;
+
+/// 生成第 index 条记录 (seq_operations 的 start/next/show)
+///
+/// 用 write! 或 puts 把记录写入 m；没有这一条记录（已到末尾）时返回 false。
+/// data 是打开时给出的私有数据 (seq_file.private)
+pub type SeqShow = fn(data: usize, index: usize, m: &mut SeqFile) -> bool;
+
+/// 一次打开的迭代状态 (struct seq_file)
+pub struct SeqFile {
+    show: SeqShow,
+    /// 私有数据，如 /proc/<pid> 下文件的 PID
+    pub data: usize,
+    /// 生成函数自用的游标，如 maps 下一个 VMA 的起始地址 (proc_maps_private.last_addr)；
+    /// 生成第 0 条记录前清零
+    pub cursor: usize,
+    /// 当前记录
+    buf: Vec<u8>,
+    /// buf 中已复制出去的字节数
+    from: usize,
+    /// 下一条要生成的记录
+    index: usize,
+    /// 已读出的字节数，即 buf[from] 在文件中的位置
+    pos: u64,
+    /// pad 补齐到的 buf 长度
+    pad_until: usize,
+}
+
+impl SeqFile {
+    /// 创建迭代状态 (seq_open)
+    pub fn new(show: SeqShow, data: usize) -> Self {
+        Self {
+            show,
+            data,
+            cursor: 0,
+            buf: Vec::new(),
+            from: 0,
+            index: 0,
+            pos: 0,
+            pad_until: 0,
+        }
+    }
+
+    /// 追加字符串 (seq_puts)
+    pub fn puts(&mut self, s: &str) {
+        self.buf.extend_from_slice(s.as_bytes());
+    }
+
+    /// 追加原始字节 (seq_write)
+    pub fn write_bytes(&mut self, data: &[u8]) {
+        self.buf.extend_from_slice(data);
+    }
+
+    /// 记下列宽：之后写入的内容由 pad 补齐到 width 字节 (seq_setwidth)
+    pub fn setwidth(&mut self, width: usize) {
+        self.pad_until = self.buf.len() + width;
+    }
+
+    /// 用空格补齐到 setwidth 记下的列宽，已经超过时不补 (seq_pad)
+    pub fn pad(&mut self) {
+        if self.buf.len() < self.pad_until {
+            self.buf.resize(self.pad_until, b' ');
+        }
+    }
+
+    /// 生成下一条记录到空的 buf 中
+    ///
+    /// # 返回
+    /// 已经没有记录时返回 false
+    fn next_record(&mut self) -> bool {
+        self.buf.clear();
+        self.from = 0;
+        if self.index == 0 {
+            self.cursor = 0;
+        }
+        let show = self.show;
+        if !show(self.data, self.index, self) {
+            return false;
+        }
+        self.index += 1;
+        true
+    }
+
+    /// 从头生成记录直到 pos 所在的记录 (traverse)
+    fn traverse(&mut self, pos: u64) {
+        self.index = 0;
+        self.pos = 0;
+        self.buf.clear();
+        self.from = 0;
+        while self.pos < pos {
+            if !self.next_record() {
+                return;
+            }
+            let len = self.buf.len() as u64;
+            if self.pos + len > pos {
+                self.from = (pos - self.pos) as usize;
+                self.pos = pos;
+                return;
+            }
+            self.pos += len;
+        }
+        self.buf.clear();
+    }
+
+    /// 从 pos 起读入 out (seq_read_iter)
+    ///
+    /// # 返回
+    /// 读取的字节数；0 表示已到末尾
+    pub fn read(&mut self, pos: u64, out: &mut [u8]) -> usize {
+        if pos != self.pos {
+            self.traverse(pos);
+        }
+        let mut copied = 0;
+        loop {
+            let pending = &self.buf[self.from..];
+            let n = pending.len().min(out.len() - copied);
+            out[copied..copied + n].copy_from_slice(&pending[..n]);
+            self.from += n;
+            self.pos += n as u64;
+            copied += n;
+            if copied == out.len() || !self.next_record() {
+                return copied;
+            }
+        }
+    }
+
+    /// 读出从 pos 起的全部内容
+    pub fn read_to_end(&mut self) -> Vec<u8> {
+        let mut content = Vec::new();
+        let mut chunk = [0u8; 512];
+        loop {
+            let n = self.read(self.pos, &mut chunk);
+            if n == 0 {
+                return content;
+            }
+            content.extend_from_slice(&chunk[..n]);
+        }
+    }
+}
+
+impl core::fmt::Write for SeqFile {
+    /// write! 直接写入记录缓冲区 (seq_printf)
+    fn write_str(&mut self, s: &str) -> core::fmt::Result {
+        self.puts(s);
+        Ok(())
+    }
+}
@@ -0,0 +1,395 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 文件、管道与 socket 之间的内核内数据传输
+//!
+//! 参考 Linux: fs/splice.c (splice_direct_to_actor, do_splice), fs/read_write.c (do_sendfile),
+//! fs/read_write.c (vfs_copy_file_range)
+//!
+//! sendfile / splice / copy_file_range 的数据不经过用户内存：
+//! - 来源文件有页缓存时，逐页取得页引用 (grab_page)，以缓存页本身作为写入目标的数据，
+//!   不先复制到中间缓冲区
+//! - 目标是 TCP socket 时，数据经 tcp_sendmsg 进入发送缓冲区，与 write(2) 的发送和重传路径相同
+//! - 目标是管道时，页挂入管道的页槽；来源是管道时，页槽中的页交给目标，
+//!   管道之间移动的也只是页引用
+//! - 来源既没有页缓存也不是管道时，经一个内核页大小的缓冲区中转
+
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+
+use crate::errno;
+use crate::fs::file::{get_file_fd, File};
+use crate::fs::pipe::{self, is_pipe};
+use crate::fs::vfs::file_mapping;
+use crate::mm::filemap::{self, FileMapping};
+use crate::mm::PAGE_SIZE;
+use crate::net::buffer::{alloc_skb, SkBuff};
+
+/// splice 标志 (SPLICE_F_*)
+pub const SPLICE_F_MOVE: u32 = 0x01;
+pub const SPLICE_F_NONBLOCK: u32 = 0x02;
+pub const SPLICE_F_MORE: u32 = 0x04;
+pub const SPLICE_F_GIFT: u32 = 0x08;
+const SPLICE_F_ALL: u32 = SPLICE_F_MOVE | SPLICE_F_NONBLOCK | SPLICE_F_MORE | SPLICE_F_GIFT;
+
+/// 单次调用最多传输的字节数 (MAX_RW_COUNT)
+const MAX_RW_COUNT: usize = 0x7fff_f000;
+
+/// 一段待传输的数据
+pub struct SpliceChunk<'a> {
+    /// 数据所在的页缓存页（物理地址），来自中转缓冲区时为 None
+    pub page: Option<usize>,
+    /// 页内偏移
+    pub offset: usize,
+    /// 数据
+    pub data: &'a [u8],
+}
+
+/// 逐页把页缓存中 [*pos, *pos + len) 的数据交给 actor (splice_direct_to_actor)
+///
+/// actor 执行期间持有页引用，页不会被回收；actor 返回写入的字节数或负错误码，
+/// 写入不足一段时停止
+///
+/// # 返回
+/// 传输的字节数，*pos 前进相同的字节数；一个字节也没传输时返回 actor 的错误
+pub fn splice_from_mapping<F>(mapping: &FileMapping, pos: &mut u64, len: usize, mut actor: F) -> Result<usize, i32>
+where
+    F: FnMut(&SpliceChunk) -> isize,
+{
+    let size = mapping.size();
+    let mut done = 0;
+    while done < len {
+        let cur = *pos as usize;
+        if cur >= size {
+            break;
+        }
+        let phys = match mapping.grab_page(cur / PAGE_SIZE) {
+            Some(phys) => phys,
+            None => {
+                if done == 0 {
+                    return Err(errno::Errno::OutOfMemory.as_neg_i32());
+                }
+                break;
+            }
+        };
+        let in_page = cur % PAGE_SIZE;
+        let n = (PAGE_SIZE - in_page).min(size - cur).min(len - done);
+        let chunk = SpliceChunk {
+            page: Some(phys),
+            offset: in_page,
+            data: unsafe { core::slice::from_raw_parts((phys + in_page) as *const u8, n) },
+        };
+        let ret = actor(&chunk);
+        filemap::put_page(phys);
+
+        if ret < 0 {
+            if done == 0 {
+                return Err(ret as i32);
+            }
+            break;
+        }
+        let ret = ret as usize;
+        done += ret;
+        *pos += ret as u64;
+        if ret < n {
+            break;
+        }
+    }
+    Ok(done)
+}
+
+/// 把页缓存中的数据作为页片段挂入新的 SkBuff，不复制数据 (skb_splice_from_iter)
+///
+/// # 返回
+/// 数据包；页片段数用完时只包含前面的部分，*pos 前进实际挂入的字节数
+pub fn splice_mapping_to_skb(mapping: &FileMapping, pos: &mut u64, len: usize) -> Option<SkBuff> {
+    let mut skb = alloc_skb(0)?;
+    let ret = splice_from_mapping(mapping, pos, len, |chunk| {
+        let page = chunk.page.unwrap_or(0);
+        match skb.skb_fill_page_desc(page, chunk.offset as u32, chunk.data.len() as u32) {
+            Ok(()) => chunk.data.len() as isize,
+            Err(()) => 0,
+        }
+    });
+    match ret {
+        Ok(_) => Some(skb),
+        Err(_) => {
+            skb.free();
+            None
+        }
+    }
+}
+
+/// 在 pos 指定的位置读取；pos 为 None 时使用并前进文件位置 (rw_verify_area + vfs_read)
+fn read_at(file: &File, pos: Option<&mut u64>, buf: &mut [u8]) -> isize {
+    match pos {
+        Some(pos) => {
+            let ret = file.read_vec(&mut [buf], Some(*pos));
+            if ret > 0 {
+                *pos += ret as u64;
+            }
+            ret
+        }
+        None => unsafe { file.read(buf.as_mut_ptr(), buf.len()) },
+    }
+}
+
+/// 在 pos 指定的位置写入；pos 为 None 时使用并前进文件位置 (vfs_write)
+fn write_at(file: &File, pos: Option<u64>, data: &[u8]) -> isize {
+    match pos {
+        Some(pos) => file.write_vec(&[data], Some(pos)),
+        None => unsafe { file.write(data.as_ptr(), data.len()) },
+    }
+}
+
+/// 传输的目标
+enum SpliceSink<'a> {
+    /// 文件，Some 时写入指定位置且不改变文件位置
+    File(&'a File, Option<&'a mut u64>),
+    /// 管道的写端
+    Pipe(&'a File),
+    /// TCP socket
+    Socket(i32),
+}
+
+impl SpliceSink<'_> {
+    /// 写入一段数据 (splice_write)
+    fn write(&mut self, chunk: &SpliceChunk) -> isize {
+        match self {
+            SpliceSink::File(file, pos) => {
+                let ret = write_at(file, pos.as_deref().copied(), chunk.data);
+                if ret > 0 {
+                    if let Some(pos) = pos {
+                        **pos += ret as u64;
+                    }
+                }
+                ret
+            }
+            SpliceSink::Pipe(file) => match chunk.page {
+                // 页只挂入引用
+                Some(page) => pipe::pipe_splice_page(file, page, chunk.offset, chunk.data.len()),
+                None => unsafe { file.write(chunk.data.as_ptr(), chunk.data.len()) },
+            },
+            // 与 write(2) 走同一条发送路径：复制进发送缓冲区，由 tcp_write_xmit 组段并负责重传
+            SpliceSink::Socket(sk) => crate::net::tcp::tcp_sendmsg(*sk, chunk.data, false),
+        }
+    }
+}
+
+/// 把 in 的数据传输到 sink (do_splice_direct)
+///
+/// 有页缓存的文件直接交出缓存页，管道交出页槽中的页；否则经内核缓冲区中转，
+/// 读到的数据不足一个缓冲区时停止，不再阻塞
+fn splice_direct(in_file: &File, in_pos: Option<&mut u64>, sink: &mut SpliceSink, len: usize) -> Result<usize, i32> {
+    if is_pipe(in_file) {
+        return pipe::splice_from_pipe(in_file, len, |chunk| sink.write(chunk));
+    }
+    if let Some(mapping) = file_mapping(in_file) {
+        let mut pos = in_pos.as_deref().copied().unwrap_or_else(|| in_file.get_pos());
+        let ret = splice_from_mapping(&mapping, &mut pos, len, |chunk| sink.write(chunk));
+        match in_pos {
+            Some(in_pos) => *in_pos = pos,
+            None => in_file.set_pos(pos),
+        }
+        return ret;
+    }
+
+    let mut buf: Vec<u8> = Vec::new();
+    buf.resize(PAGE_SIZE.min(len), 0);
+    let mut in_pos = in_pos;
+    let mut done = 0;
+    while done < len {
+        let want = buf.len().min(len - done);
+        let read = read_at(in_file, in_pos.as_deref_mut(), &mut buf[..want]);
+        if read < 0 {
+            if done == 0 {
+                return Err(read as i32);
+            }
+            break;
+        }
+        if read == 0 {
+            break;
+        }
+        let read = read as usize;
+        let chunk = SpliceChunk { page: None, offset: 0, data: &buf[..read] };
+        let written = sink.write(&chunk);
+        if written < 0 {
+            if done == 0 {
+                return Err(written as i32);
+            }
+            break;
+        }
+        done += written as usize;
+        if (written as usize) < read || read < want {
+            break;
+        }
+    }
+    Ok(done)
+}
+
+/// 取得文件描述符对应的文件
+fn fdget(fd: usize) -> Result<Arc<File>, i32> {
+    unsafe { get_file_fd(fd) }.ok_or(errno::Errno::BadFileNumber.as_neg_i32())
+}
+
+/// 检查文件可读 (FMODE_READ)
+fn check_readable(file: &File) -> Result<(), i32> {
+    if file.flags.is_writeonly() {
+        return Err(errno::Errno::BadFileNumber.as_neg_i32());
+    }
+    Ok(())
+}
+
+/// 检查文件可写 (FMODE_WRITE)
+fn check_writable(file: &File) -> Result<(), i32> {
+    if file.flags.is_readonly() {
+        return Err(errno::Errno::BadFileNumber.as_neg_i32());
+    }
+    Ok(())
+}
+
+/// 在两个文件描述符之间传输数据 (do_sendfile)
+///
+/// # 参数
+/// - out_fd: 目标，文件、管道或 TCP socket
+/// - in_fd: 来源，必须有页缓存
+/// - ppos: 来源的读取位置；None 时使用并前进 in_fd 的文件位置
+/// - count: 最多传输的字节数
+///
+/// # 返回
+/// 传输的字节数
+pub fn do_sendfile(out_fd: usize, in_fd: usize, ppos: Option<&mut u64>, count: usize) -> Result<usize, i32> {
+    let in_file = fdget(in_fd)?;
+    check_readable(&in_file)?;
+    if file_mapping(&in_file).is_none() {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    let count = count.min(MAX_RW_COUNT);
+
+    let out_file = fdget(out_fd)?;
+    check_writable(&out_file)?;
+    let mut sink = if is_pipe(&out_file) {
+        SpliceSink::Pipe(&out_file)
+    } else if let Some(sk) = crate::net::tcp::tcp_sock_id(&out_file) {
+        SpliceSink::Socket(sk)
+    } else {
+        SpliceSink::File(&out_file, None)
+    };
+    splice_direct(&in_file, ppos, &mut sink, count)
+}
+
+/// 在管道与文件之间，或两个管道之间传输数据 (do_splice)
+///
+/// # 参数
+/// - off_in / off_out: 非管道一端的位置，None 时使用文件位置；管道一端不能指定位置
+/// - flags: SPLICE_F_*
+///
+/// # 返回
+/// 传输的字节数；两端都不是管道返回 EINVAL，管道一端指定位置返回 ESPIPE
+pub fn do_splice(
+    fd_in: usize,
+    off_in: Option<&mut u64>,
+    fd_out: usize,
+    off_out: Option<&mut u64>,
+    len: usize,
+    flags: u32,
+) -> Result<usize, i32> {
+    if flags & !SPLICE_F_ALL != 0 {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    let in_file = fdget(fd_in)?;
+    let out_file = fdget(fd_out)?;
+    check_readable(&in_file)?;
+    check_writable(&out_file)?;
+
+    let (in_pipe, out_pipe) = (is_pipe(&in_file), is_pipe(&out_file));
+    if !in_pipe && !out_pipe {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    if (in_pipe && off_in.is_some()) || (out_pipe && off_out.is_some()) {
+        return Err(errno::Errno::IllegalSeek.as_neg_i32());
+    }
+    if in_pipe && out_pipe && Arc::ptr_eq(&in_file, &out_file) {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    if len == 0 {
+        return Ok(0);
+    }
+
+    let mut sink = if out_pipe {
+        SpliceSink::Pipe(&out_file)
+    } else {
+        SpliceSink::File(&out_file, off_out)
+    };
+    splice_direct(&in_file, off_in, &mut sink, len.min(MAX_RW_COUNT))
+}
+
+/// 把用户内存写入管道 (vmsplice_to_pipe)
+///
+/// flags 含 SPLICE_F_GIFT 时整页且页对齐的数据交出用户页（只读 + COW），不复制
+///
+/// # 返回
+/// 写入的字节数；fd 不是管道返回 EBADF
+pub fn do_vmsplice(fd: usize, data: &[u8], flags: u32) -> Result<usize, i32> {
+    if flags & !SPLICE_F_ALL != 0 {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    let file = fdget(fd)?;
+    if !is_pipe(&file) {
+        return Err(errno::Errno::BadFileNumber.as_neg_i32());
+    }
+    check_writable(&file)?;
+    let ret = pipe::pipe_vmsplice(&file, data, flags & SPLICE_F_GIFT != 0);
+    if ret < 0 {
+        return Err(ret as i32);
+    }
+    Ok(ret as usize)
+}
+
+/// 在两个文件之间复制数据 (vfs_copy_file_range)
+///
+/// 来源的缓存页直接作为目标的写入数据，不经过用户内存
+///
+/// # 参数
+/// - off_in / off_out: 位置，None 时使用并前进文件位置
+/// - flags: 必须为 0
+///
+/// # 返回
+/// 复制的字节数；任一端是管道返回 EINVAL，同一文件的重叠区间返回 EINVAL
+pub fn copy_file_range(
+    fd_in: usize,
+    off_in: Option<&mut u64>,
+    fd_out: usize,
+    off_out: Option<&mut u64>,
+    len: usize,
+    flags: u32,
+) -> Result<usize, i32> {
+    if flags != 0 {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    let in_file = fdget(fd_in)?;
+    let out_file = fdget(fd_out)?;
+    check_readable(&in_file)?;
+    check_writable(&out_file)?;
+    if is_pipe(&in_file) || is_pipe(&out_file) {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    let len = len.min(MAX_RW_COUNT);
+
+    // 同一文件内的复制区间不能重叠
+    if Arc::ptr_eq(&in_file, &out_file) {
+        let pos_in = off_in.as_deref().copied().unwrap_or_else(|| in_file.get_pos());
+        let pos_out = off_out.as_deref().copied().unwrap_or_else(|| out_file.get_pos());
+        if pos_in < pos_out.saturating_add(len as u64) && pos_out < pos_in.saturating_add(len as u64) {
+            return Err(errno::Errno::InvalidArgument.as_neg_i32());
+        }
+    }
+    if len == 0 {
+        return Ok(0);
+    }
+
+    let mut sink = SpliceSink::File(&out_file, off_out);
+    splice_direct(&in_file, off_in, &mut sink, len)
+}
@@ -181,6 +181,104 @@ impl Stat {
     }
 }
 
+/// 路径参数是相对 dirfd 的目录 (AT_FDCWD 表示当前目录)
+pub const AT_FDCWD: i32 = -100;
+/// 不跟随末尾的符号链接 (AT_SYMLINK_NOFOLLOW)
+pub const AT_SYMLINK_NOFOLLOW: u32 = 0x100;
+/// unlinkat 删除目录 (AT_REMOVEDIR)
+pub const AT_REMOVEDIR: u32 = 0x200;
+/// 不触发自动挂载 (AT_NO_AUTOMOUNT)
+pub const AT_NO_AUTOMOUNT: u32 = 0x800;
+/// 路径为空时对 dirfd 本身操作 (AT_EMPTY_PATH)
+pub const AT_EMPTY_PATH: u32 = 0x1000;
+/// statx 的同步方式 (AT_STATX_SYNC_TYPE)，本地文件系统总是最新，忽略
+pub const AT_STATX_SYNC_TYPE: u32 = 0x6000;
+
+/// statx 请求与返回的字段掩码 (STATX_*)
+pub const STATX_TYPE: u32 = 0x0001;
+pub const STATX_MODE: u32 = 0x0002;
+pub const STATX_NLINK: u32 = 0x0004;
+pub const STATX_UID: u32 = 0x0008;
+pub const STATX_GID: u32 = 0x0010;
+pub const STATX_ATIME: u32 = 0x0020;
+pub const STATX_MTIME: u32 = 0x0040;
+pub const STATX_CTIME: u32 = 0x0080;
+pub const STATX_INO: u32 = 0x0100;
+pub const STATX_SIZE: u32 = 0x0200;
+pub const STATX_BLOCKS: u32 = 0x0400;
+/// struct stat 中的全部字段
+pub const STATX_BASIC_STATS: u32 = 0x07ff;
+
+/// statx 时间戳 (struct statx_timestamp)
+#[repr(C)]
+#[derive(Debug, Copy, Clone, Default, PartialEq)]
+pub struct StatxTimestamp {
+    pub tv_sec: i64,
+    pub tv_nsec: u32,
+    pub __reserved: i32,
+}
+
+/// 扩展文件状态信息 (struct statx)
+///
+/// 布局与 Linux uapi 一致，共 256 字节；stx_mask 说明哪些字段有效
+#[repr(C)]
+#[derive(Debug, Copy, Clone, PartialEq)]
+pub struct Statx {
+    pub stx_mask: u32,
+    pub stx_blksize: u32,
+    pub stx_attributes: u64,
+    pub stx_nlink: u32,
+    pub stx_uid: u32,
+    pub stx_gid: u32,
+    pub stx_mode: u16,
+    pub __spare0: u16,
+    pub stx_ino: u64,
+    pub stx_size: u64,
+    pub stx_blocks: u64,
+    pub stx_attributes_mask: u64,
+    pub stx_atime: StatxTimestamp,
+    pub stx_btime: StatxTimestamp,
+    pub stx_ctime: StatxTimestamp,
+    pub stx_mtime: StatxTimestamp,
+    pub stx_rdev_major: u32,
+    pub stx_rdev_minor: u32,
+    pub stx_dev_major: u32,
+    pub stx_dev_minor: u32,
+    pub __spare2: [u64; 14],
+}
+
+impl Statx {
+    /// 由 Stat 转换，mask 是实际填充的字段 (cp_statx)
+    ///
+    /// 设备号按 Linux 的 new_encode_dev 拆成主次设备号
+    pub fn from_stat(stat: &Stat, mask: u32) -> Self {
+        let ts = |sec: u64, nsec: u64| StatxTimestamp { tv_sec: sec as i64, tv_nsec: nsec as u32, __reserved: 0 };
+        Self {
+            stx_mask: mask,
+            stx_blksize: stat.st_blksize as u32,
+            stx_attributes: 0,
+            stx_nlink: stat.st_nlink,
+            stx_uid: stat.st_uid,
+            stx_gid: stat.st_gid,
+            stx_mode: stat.st_mode as u16,
+            __spare0: 0,
+            stx_ino: stat.st_ino,
+            stx_size: stat.st_size as u64,
+            stx_blocks: stat.st_blocks,
+            stx_attributes_mask: 0,
+            stx_atime: ts(stat.st_atime, stat.st_atime_nsec),
+            stx_btime: StatxTimestamp::default(),
+            stx_ctime: ts(stat.st_ctime, stat.st_ctime_nsec),
+            stx_mtime: ts(stat.st_mtime, stat.st_mtime_nsec),
+            stx_rdev_major: ((stat.st_rdev >> 8) & 0xfff) as u32,
+            stx_rdev_minor: ((stat.st_rdev & 0xff) | ((stat.st_rdev >> 12) & 0xfff00)) as u32,
+            stx_dev_major: ((stat.st_dev >> 8) & 0xfff) as u32,
+            stx_dev_minor: ((stat.st_dev & 0xff) | ((stat.st_dev >> 12) & 0xfff00)) as u32,
+            __spare2: [0; 14],
+        }
+    }
+}
+
 impl Default for Stat {
     fn default() -> Self {
         Self::new()
@@ -14,6 +14,7 @@
 use crate::errno;
 use alloc::sync::Arc;
 use spin::Mutex;
+use core::sync::atomic::{AtomicU64, Ordering};
 
 #[repr(C)]
 #[derive(Debug, Copy, Clone, PartialEq)]
@@ -76,6 +77,8 @@ pub struct SuperBlock {
     pub s_options: Option<Arc<()>>,
     /// 私有数据（用于特定文件系统）
     pub s_fs_info: Option<*mut u8>,
+    /// 设备号，区分不同的文件系统实例（dcache 以它和父目录 inode 为键）
+    pub s_dev: u64,
 }
 
 unsafe impl Send for SuperBlock {}
@@ -102,6 +105,7 @@ impl SuperBlock {
             s_type: None,
             s_options: None,
             s_fs_info: None,
+            s_dev: get_anon_bdev(),
         }
     }
 
@@ -121,6 +125,14 @@ impl SuperBlock {
     }
 }
 
+/// 下一个匿名设备号
+static NEXT_ANON_DEV: AtomicU64 = AtomicU64::new(1);
+
+/// 为没有块设备的文件系统实例分配设备号 (get_anon_bdev)
+pub fn get_anon_bdev() -> u64 {
+    NEXT_ANON_DEV.fetch_add(1, Ordering::Relaxed)
+}
+
 pub struct FsContext<'a> {
     /// 源设备
     pub source: Option<&'a str>,
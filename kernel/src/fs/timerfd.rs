@@ -0,0 +1,244 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! timerfd：通过文件描述符交付的定时器
+//!
+//! 每个 timerfd 包含一个 hrtimer。到期时累加到期次数并唤醒读者，周期定时器
+//! 推进到下一个周期重新入队；read 返回并清零到期次数 (u64)，poll 在次数
+//! 非零时可读，所以 timerfd 可以和 epoll / poll / select 一起使用。
+//! 所有时钟都由 ktime_get 提供，REALTIME 与 MONOTONIC 相同。
+//!
+//! 参考: fs/timerfd.c
+
+use alloc::sync::Arc;
+use core::mem::offset_of;
+use core::sync::atomic::{AtomicU64, Ordering};
+use spin::Mutex;
+
+use crate::fs::file::{poll_mask::*, File, FileFlags, FileOps};
+use crate::fs::select::{poll_wait, PollTable};
+use crate::process::task::TaskState;
+use crate::process::wait::{WaitQueueEntry, WaitQueueHead};
+use crate::time::hrtimer::{
+    hrtimer_cancel, hrtimer_get_remaining, hrtimer_is_queued, hrtimer_start, Hrtimer, HrtimerMode,
+    HrtimerRestart,
+};
+use crate::time::ktime_get;
+
+const EINTR: i32 = -4;
+const EAGAIN: i32 = -11;
+const EINVAL: i32 = -22;
+
+/// 支持的时钟 (clockid_t)
+pub const CLOCK_REALTIME: i32 = 0;
+pub const CLOCK_MONOTONIC: i32 = 1;
+pub const CLOCK_BOOTTIME: i32 = 7;
+
+/// timerfd_create 标志
+pub const TFD_CLOEXEC: u32 = FileFlags::O_CLOEXEC;
+pub const TFD_NONBLOCK: u32 = FileFlags::O_NONBLOCK;
+
+/// timerfd_settime 标志：value 为绝对时间
+pub const TFD_TIMER_ABSTIME: i32 = 1;
+
+/// 定时器设置，纳秒 (struct itimerspec)
+///
+/// value 为 0 表示停止；interval 为 0 表示只触发一次
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct TimerFdSpec {
+    pub value: u64,
+    pub interval: u64,
+}
+
+/// timerfd 实例 (struct timerfd_ctx)
+pub struct TimerFdCtx {
+    tmr: Hrtimer,
+    /// 等待到期的读者
+    wqh: WaitQueueHead,
+    /// 上次 read 以来的到期次数
+    ticks: AtomicU64,
+    /// 周期，纳秒
+    interval: AtomicU64,
+    clockid: i32,
+    /// 串行化 settime，保证 cancel 与 start 之间不被打断
+    lock: Mutex<()>,
+}
+
+impl TimerFdCtx {
+    fn new(clockid: i32) -> Self {
+        Self {
+            tmr: Hrtimer::new(timerfd_tmrproc, 0),
+            wqh: WaitQueueHead::new(),
+            ticks: AtomicU64::new(0),
+            interval: AtomicU64::new(0),
+            clockid,
+            lock: Mutex::new(()),
+        }
+    }
+
+    /// 创建时指定的时钟
+    pub fn clockid(&self) -> i32 {
+        self.clockid
+    }
+
+    /// 读出并清零到期次数，不阻塞
+    pub fn take_ticks(&self) -> u64 {
+        self.ticks.swap(0, Ordering::AcqRel)
+    }
+}
+
+/// 到期回调 (timerfd_tmrproc)
+///
+/// 周期定时器一次推进跳过的所有周期，都计入到期次数
+fn timerfd_tmrproc(htmr: &Hrtimer) -> HrtimerRestart {
+    let ctx = unsafe { &*((htmr as *const Hrtimer as usize - offset_of!(TimerFdCtx, tmr)) as *const TimerFdCtx) };
+    let interval = ctx.interval.load(Ordering::Acquire);
+    let overruns = if interval != 0 { htmr.forward(ktime_get(), interval).max(1) } else { 1 };
+    ctx.ticks.fetch_add(overruns, Ordering::AcqRel);
+    ctx.wqh.wake_up_all();
+    if interval != 0 {
+        HrtimerRestart::Restart
+    } else {
+        HrtimerRestart::NoRestart
+    }
+}
+
+/// 设置定时器，返回原来的设置 (do_timerfd_settime)
+pub fn timerfd_settime(ctx: &TimerFdCtx, flags: i32, new: TimerFdSpec) -> TimerFdSpec {
+    let _guard = ctx.lock.lock();
+    let old = timerfd_gettime(ctx);
+    hrtimer_cancel(&ctx.tmr);
+    ctx.ticks.store(0, Ordering::Release);
+    ctx.interval.store(new.interval, Ordering::Release);
+    if new.value != 0 {
+        let mode = if flags & TFD_TIMER_ABSTIME != 0 { HrtimerMode::Abs } else { HrtimerMode::Rel };
+        hrtimer_start(&ctx.tmr, new.value, mode);
+    }
+    old
+}
+
+/// 读取当前设置：距下次到期的时间与周期 (timerfd_gettime)
+pub fn timerfd_gettime(ctx: &TimerFdCtx) -> TimerFdSpec {
+    let value = if hrtimer_is_queued(&ctx.tmr) {
+        // 已到期但软中断还没执行时也报告为即将到期
+        hrtimer_get_remaining(&ctx.tmr).max(1)
+    } else {
+        0
+    };
+    TimerFdSpec { value, interval: ctx.interval.load(Ordering::Acquire) }
+}
+
+/// 由文件得到 timerfd 实例
+pub fn file_timerfd(file: &File) -> Option<&TimerFdCtx> {
+    let is_timerfd = unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &TIMERFD_OPS));
+    if !is_timerfd {
+        return None;
+    }
+    unsafe { *file.private_data.get() }.map(|ptr| unsafe { &*(ptr as *const TimerFdCtx) })
+}
+
+/// 等待到期 (timerfd_read 中的 wait_event_interruptible)
+///
+/// 回调在软中断中唤醒队列，挂入和摘下时关闭本地中断
+fn timerfd_wait(ctx: &TimerFdCtx) {
+    let current = match crate::sched::current() {
+        Some(task) => task,
+        None => return,
+    };
+    let entry = WaitQueueEntry::new(current, false);
+    {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        ctx.wqh.add(&entry);
+    }
+    // 先进入睡眠状态再检查，检查之后的唤醒会把状态改回 Running
+    current.set_state(TaskState::Interruptible);
+    if ctx.ticks.load(Ordering::Acquire) == 0 {
+        crate::sched::schedule();
+    }
+    current.set_state(TaskState::Running);
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    ctx.wqh.remove(&entry);
+}
+
+/// 读取到期次数 (timerfd_read)
+///
+/// 缓冲区不足 8 字节返回 EINVAL；没有到期时阻塞，非阻塞模式返回 EAGAIN
+fn timerfd_read(file: &File, buf: &mut [u8]) -> isize {
+    let ctx = match file_timerfd(file) {
+        Some(ctx) => ctx,
+        None => return EINVAL as isize,
+    };
+    if buf.len() < 8 {
+        return EINVAL as isize;
+    }
+    let nonblock = (file.flags.bits() & FileFlags::O_NONBLOCK) != 0;
+    loop {
+        let ticks = ctx.take_ticks();
+        if ticks != 0 {
+            buf[..8].copy_from_slice(&ticks.to_ne_bytes());
+            return 8;
+        }
+        if nonblock {
+            return EAGAIN as isize;
+        }
+        if crate::signal::signal_pending() {
+            return EINTR as isize;
+        }
+        timerfd_wait(ctx);
+    }
+}
+
+/// 有到期次数时可读 (timerfd_poll)
+fn timerfd_poll(file: &File, pt: Option<&mut PollTable>) -> u32 {
+    let ctx = match file_timerfd(file) {
+        Some(ctx) => ctx,
+        None => return 0,
+    };
+    poll_wait(&ctx.wqh, pt);
+    if ctx.ticks.load(Ordering::Acquire) != 0 {
+        POLLIN | POLLRDNORM
+    } else {
+        0
+    }
+}
+
+/// 关闭时取消定时器并释放实例 (timerfd_release)
+fn timerfd_release(file: &File) -> i32 {
+    let ptr = match unsafe { (*file.private_data.get()).take() } {
+        Some(ptr) => ptr,
+        None => return -9,  // EBADF
+    };
+    // 释放时 Hrtimer 的 Drop 会等待正在执行的回调
+    drop(unsafe { Arc::from_raw(ptr as *const TimerFdCtx) });
+    0
+}
+
+static TIMERFD_OPS: FileOps = FileOps {
+    read: Some(timerfd_read),
+    write: None,
+    lseek: None,
+    close: Some(timerfd_release),
+    read_iter: None,
+    write_iter: None,
+    poll: Some(timerfd_poll),
+};
+
+/// 创建 timerfd 文件 (timerfd_create)
+///
+/// # 参数
+/// - clockid: CLOCK_REALTIME / CLOCK_MONOTONIC / CLOCK_BOOTTIME
+/// - flags: TFD_CLOEXEC | TFD_NONBLOCK，CLOEXEC 由调用方在安装描述符时处理
+pub fn timerfd_create_file(clockid: i32, flags: u32) -> Result<Arc<File>, i32> {
+    if !matches!(clockid, CLOCK_REALTIME | CLOCK_MONOTONIC | CLOCK_BOOTTIME) {
+        return Err(EINVAL);
+    }
+    if flags & !(TFD_CLOEXEC | TFD_NONBLOCK) != 0 {
+        return Err(EINVAL);
+    }
+    let ctx = Arc::new(TimerFdCtx::new(clockid));
+    let file = Arc::new(File::new(FileFlags::new(FileFlags::O_RDONLY | (flags & TFD_NONBLOCK))));
+    file.set_ops(&TIMERFD_OPS);
+    file.set_private_data(Arc::into_raw(ctx) as *mut u8);
+    Ok(file)
+}
@@ -0,0 +1,1039 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! tmpfs - 数据只在页缓存中的内存文件系统
+//!
+//! 参考 Linux: mm/shmem.c (shmem_get_folio, shmem_write_begin, shmem_setattr, shmem_parse_one)
+//!
+//! - 每个 inode 的数据就是它的页缓存 (FileMapping，键为 mapping_key(设备号, inode 号))：
+//!   写入时按页从页分配器分配，读取空洞不分配页。不像 RootFS 把文件放在一个 Vec 里，
+//!   追加写不会重新分配和复制整个文件，read、write 与 mmap 访问的是同一批页
+//! - 页没有后备存储，不可驱逐 (MappingSource::unevictable)：不进入 LRU、不会被回收，
+//!   只在截断和删除文件时释放
+//! - 挂载选项以逗号分隔 (shmem_parse_one)：
+//!   - size=N[k|m|g|%]  页数上限，% 相对物理内存，默认为物理内存的一半，0 表示不限
+//!   - nr_inodes=N[k|m|g] inode 数上限，默认为物理页数的一半，0 表示不限
+//!   - huge=never|always|within_size 是否以 2MB 为单位分配，默认 never
+//! - huge 时一个 2MB 对齐的区间第一次写入就分配 512 个物理连续、2MB 对齐的页，一次加入页缓存；
+//!   within_size 只在整个区间落在文件大小内时这样做。区间中已有页、超出 size 上限或分配不到
+//!   连续内存时退回 4KB 页。页缓存与缺页仍以 4KB 页为单位，映射不使用 2MB 叶子页表项
+//! - 启动时挂载 /tmp 与 /dev/shm；VFS 按挂载点前缀把打开、建目录、删除与列目录交给 tmpfs
+//! - 删除后仍被打开的文件在最后一次关闭时释放 (evict)；只剩 mmap 映射时已删除文件的页随之释放，
+//!   之后的缺页失败
+
+use alloc::boxed::Box;
+use alloc::collections::{BTreeMap, BTreeSet};
+use alloc::string::String;
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, AtomicUsize, Ordering};
+use spin::Mutex;
+
+use crate::errno::Errno;
+use crate::fs::file::{File, FileFlags, FileOps, fput, get_file_fd_install};
+use crate::fs::mount::{VfsMount, MntFlags};
+use crate::fs::superblock::{SuperBlock, FileSystemType, FsContext};
+use crate::fs::vfs::DirContext;
+use crate::fs::Stat;
+use crate::mm::filemap::{self, FileMapping, MappingSource};
+use crate::mm::page::PAGE_SIZE;
+
+/// tmpfs 魔数 (TMPFS_MAGIC)
+const TMPFS_MAGIC: u32 = 0x01021994;
+
+/// 一个 2MB 大页包含的 4KB 页数 (HPAGE_PMD_NR)
+pub const HPAGE_PMD_NR: usize = 512;
+
+/// 文件名长度上限 (NAME_MAX)
+const NAME_MAX: usize = 255;
+
+/// 启动时挂载的实例
+const TMPFS_MOUNT_POINTS: [&str; 2] = ["/tmp", "/dev/shm"];
+
+/// 所有实例占用的页数 (NR_SHMEM)
+static NR_SHMEM: AtomicUsize = AtomicUsize::new(0);
+
+/// 所有实例中整块分配的 2MB 区间数 (NR_SHMEM_THPS)
+static NR_SHMEM_THPS: AtomicUsize = AtomicUsize::new(0);
+
+fn einval() -> i32 {
+    Errno::InvalidArgument.as_neg_i32()
+}
+
+fn enospc() -> i32 {
+    Errno::NoSpaceLeftOnDevice.as_neg_i32()
+}
+
+// ==================== 挂载选项 ====================
+
+/// 大页分配策略 (SHMEM_HUGE_*)
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub enum ShmemHuge {
+    Never,
+    Always,
+    /// 只对完整落在文件大小内的 2MB 区间使用大页
+    WithinSize,
+}
+
+/// 挂载选项
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct TmpfsOptions {
+    /// 页数上限，0 表示不限 (max_blocks)
+    pub max_blocks: usize,
+    /// inode 数上限，0 表示不限 (max_inodes)
+    pub max_inodes: usize,
+    pub huge: ShmemHuge,
+}
+
+impl TmpfsOptions {
+    /// 默认选项：物理内存的一半，inode 数为物理页数的一半 (shmem_default_max_blocks/inodes)
+    pub fn default_options() -> Self {
+        let half = crate::mm::page_desc::total_pages() / 2;
+        Self { max_blocks: half, max_inodes: half, huge: ShmemHuge::Never }
+    }
+
+    /// 解析逗号分隔的挂载选项，未给出的项取默认值
+    ///
+    /// mode、uid、gid 只被接受，不检查权限；未知选项返回 EINVAL
+    pub fn parse(data: Option<&str>) -> Result<Self, i32> {
+        let mut opts = Self::default_options();
+        let data = match data {
+            Some(data) => data,
+            None => return Ok(opts),
+        };
+        for opt in data.split(',').map(str::trim).filter(|opt| !opt.is_empty()) {
+            let (key, value) = opt.split_once('=').ok_or_else(einval)?;
+            match key {
+                "size" => opts.max_blocks = parse_size(value)?,
+                "nr_blocks" => opts.max_blocks = memparse(value)?,
+                "nr_inodes" => opts.max_inodes = memparse(value)?,
+                "huge" => {
+                    opts.huge = match value {
+                        "never" => ShmemHuge::Never,
+                        "always" => ShmemHuge::Always,
+                        "within_size" => ShmemHuge::WithinSize,
+                        _ => return Err(einval()),
+                    }
+                }
+                "mode" | "uid" | "gid" => {}
+                _ => return Err(einval()),
+            }
+        }
+        Ok(opts)
+    }
+}
+
+/// 带 k/m/g 后缀的数 (memparse)
+fn memparse(s: &str) -> Result<usize, i32> {
+    let (digits, shift) = match s.as_bytes().last() {
+        Some(b'k') | Some(b'K') => (&s[..s.len() - 1], 10),
+        Some(b'm') | Some(b'M') => (&s[..s.len() - 1], 20),
+        Some(b'g') | Some(b'G') => (&s[..s.len() - 1], 30),
+        _ => (s, 0),
+    };
+    digits
+        .parse::<usize>()
+        .ok()
+        .and_then(|value| value.checked_mul(1 << shift))
+        .ok_or_else(einval)
+}
+
+/// size= 的值换算成页数：字节数向上取整到页，或物理内存的百分比
+fn parse_size(s: &str) -> Result<usize, i32> {
+    if let Some(pct) = s.strip_suffix('%') {
+        let pct = pct.parse::<usize>().map_err(|_| einval())?;
+        return Ok(crate::mm::page_desc::total_pages() * pct / 100);
+    }
+    let bytes = memparse(s)?;
+    Ok((bytes + PAGE_SIZE - 1) / PAGE_SIZE)
+}
+
+// ==================== inode ====================
+
+/// 一个实例的用量与上限 (struct shmem_sb_info)
+pub struct TmpfsSbInfo {
+    /// 设备号，页缓存键的高 32 位
+    dev: u32,
+    opts: TmpfsOptions,
+    used_blocks: AtomicUsize,
+    used_inodes: AtomicUsize,
+    next_ino: AtomicU64,
+}
+
+impl TmpfsSbInfo {
+    /// 还能再放 nr 页
+    fn may_alloc(&self, nr: usize) -> bool {
+        self.opts.max_blocks == 0 || self.used_blocks.load(Ordering::Relaxed) + nr <= self.opts.max_blocks
+    }
+
+    /// 预留一个 inode 并分配 inode 号 (shmem_reserve_inode)
+    fn reserve_inode(&self) -> Result<u64, i32> {
+        let max = self.opts.max_inodes;
+        self.used_inodes
+            .fetch_update(Ordering::AcqRel, Ordering::Relaxed, |used| {
+                if max != 0 && used >= max {
+                    None
+                } else {
+                    Some(used + 1)
+                }
+            })
+            .map_err(|_| enospc())?;
+        Ok(self.next_ino.fetch_add(1, Ordering::Relaxed))
+    }
+
+    fn free_inode(&self) {
+        self.used_inodes.fetch_sub(1, Ordering::AcqRel);
+    }
+}
+
+/// tmpfs inode (struct shmem_inode_info)
+pub struct TmpfsInode {
+    pub ino: u64,
+    is_dir: bool,
+    /// 权限位
+    mode: AtomicU32,
+    /// 文件大小（字节）
+    size: AtomicUsize,
+    /// 页缓存中的页数 (info->alloced)
+    nr_pages: AtomicUsize,
+    /// 整块分配的 2MB 区间序号
+    huge_extents: Mutex<BTreeSet<usize>>,
+    /// 指向它的目录项数，删除后为 0 (i_nlink)
+    nlink: AtomicU32,
+    /// 打开它的文件数
+    open_count: AtomicUsize,
+    /// 数据与 inode 号已释放
+    evicted: AtomicBool,
+    /// 目录的子节点
+    children: Mutex<BTreeMap<String, Arc<TmpfsInode>>>,
+    /// 写入、截断与释放互斥 (i_rwsem)
+    lock: Mutex<()>,
+    info: Arc<TmpfsSbInfo>,
+}
+
+impl MappingSource for TmpfsInode {
+    fn size(&self) -> usize {
+        self.size.load(Ordering::Acquire)
+    }
+
+    /// 页缓存中没有的页是空洞，读出 0 (shmem_get_folio 的 SGP_READ)
+    fn read_page(&self, _index: usize, buf: &mut [u8]) -> usize {
+        buf.fill(0);
+        buf.len()
+    }
+
+    fn unevictable(&self) -> bool {
+        true
+    }
+
+    fn acct_pages(&self, delta: isize) {
+        let nr = delta.unsigned_abs();
+        if delta >= 0 {
+            self.nr_pages.fetch_add(nr, Ordering::Relaxed);
+            self.info.used_blocks.fetch_add(nr, Ordering::Relaxed);
+            NR_SHMEM.fetch_add(nr, Ordering::Relaxed);
+        } else {
+            self.nr_pages.fetch_sub(nr, Ordering::Relaxed);
+            self.info.used_blocks.fetch_sub(nr, Ordering::Relaxed);
+            NR_SHMEM.fetch_sub(nr, Ordering::Relaxed);
+        }
+    }
+
+    /// 数据就在内存中，回写什么也不用做
+    fn write_pages(&self, _index: usize, _pages: &[usize]) -> Result<(), i32> {
+        Ok(())
+    }
+}
+
+impl TmpfsInode {
+    fn new(ino: u64, is_dir: bool, mode: u32, info: Arc<TmpfsSbInfo>) -> Self {
+        Self {
+            ino,
+            is_dir,
+            mode: AtomicU32::new(mode & 0o7777),
+            size: AtomicUsize::new(0),
+            nr_pages: AtomicUsize::new(0),
+            huge_extents: Mutex::new(BTreeSet::new()),
+            nlink: AtomicU32::new(1),
+            open_count: AtomicUsize::new(0),
+            evicted: AtomicBool::new(false),
+            children: Mutex::new(BTreeMap::new()),
+            lock: Mutex::new(()),
+            info,
+        }
+    }
+
+    pub fn is_dir(&self) -> bool {
+        self.is_dir
+    }
+
+    pub fn mode(&self) -> u32 {
+        self.mode.load(Ordering::Relaxed)
+    }
+
+    /// 页缓存中的页数
+    pub fn nr_pages(&self) -> usize {
+        self.nr_pages.load(Ordering::Relaxed)
+    }
+
+    /// 整块分配的 2MB 区间数
+    pub fn nr_huge_extents(&self) -> usize {
+        self.huge_extents.lock().len()
+    }
+
+    /// 页缓存键
+    pub fn mapping_key(&self) -> u64 {
+        filemap::mapping_key(self.info.dev, self.ino)
+    }
+
+    /// 文件的页缓存，也就是文件数据本身
+    pub fn mapping(self: &Arc<Self>) -> Arc<FileMapping> {
+        filemap::get_mapping(self.mapping_key(), self.clone())
+    }
+
+    /// 读取，空洞读为 0 且不分配页 (shmem_file_read_iter)
+    ///
+    /// # 返回
+    /// 读取的字节数，到文件末尾为止
+    pub fn read(self: &Arc<Self>, offset: usize, buf: &mut [u8]) -> usize {
+        let size = MappingSource::size(&**self);
+        if offset >= size || buf.is_empty() {
+            return 0;
+        }
+        let end = size.min(offset.saturating_add(buf.len()));
+        let mapping = self.mapping();
+        let mut pos = offset;
+        while pos < end {
+            let index = pos / PAGE_SIZE;
+            let in_page = pos % PAGE_SIZE;
+            let len = (PAGE_SIZE - in_page).min(end - pos);
+            let dst = &mut buf[pos - offset..pos - offset + len];
+            // 只对已有的页取引用，复制期间页不会因截断而释放
+            match mapping.find_page(index).and_then(|_| mapping.grab_page(index)) {
+                Some(phys) => {
+                    unsafe {
+                        core::ptr::copy_nonoverlapping((phys + in_page) as *const u8, dst.as_mut_ptr(), len);
+                    }
+                    filemap::put_page(phys);
+                }
+                None => dst.fill(0),
+            }
+            pos += len;
+        }
+        end - offset
+    }
+
+    /// 在 offset 处写入
+    ///
+    /// # 返回
+    /// 写入的字节数；一个字节也写不进时返回 ENOSPC
+    pub fn write(self: &Arc<Self>, offset: usize, data: &[u8]) -> Result<usize, i32> {
+        self.write_inner(Some(offset), data).map(|(_, written)| written)
+    }
+
+    /// 在文件末尾写入 (O_APPEND)
+    ///
+    /// # 返回
+    /// (写入位置, 写入的字节数)
+    pub fn append(self: &Arc<Self>, data: &[u8]) -> Result<(usize, usize), i32> {
+        self.write_inner(None, data)
+    }
+
+    /// 按需分配页并写入 (shmem_write_begin / shmem_write_end)
+    ///
+    /// 页缓存只读入文件大小以内的页，所以先扩展文件大小，没写满时退回到实际写到的位置
+    fn write_inner(self: &Arc<Self>, offset: Option<usize>, data: &[u8]) -> Result<(usize, usize), i32> {
+        if self.is_dir {
+            return Err(Errno::IsADirectory.as_neg_i32());
+        }
+        let _guard = self.lock.lock();
+        let old_size = MappingSource::size(&**self);
+        let offset = offset.unwrap_or(old_size);
+        if data.is_empty() {
+            return Ok((offset, 0));
+        }
+        let end = offset.checked_add(data.len()).ok_or(Errno::FileTooLarge.as_neg_i32())?;
+        if end > old_size {
+            self.size.store(end, Ordering::Release);
+        }
+
+        let mapping = self.mapping();
+        let mut pos = offset;
+        while pos < end {
+            let index = pos / PAGE_SIZE;
+            if mapping.find_page(index).is_none() && !self.try_alloc_huge(&mapping, index) && !self.info.may_alloc(1) {
+                break;
+            }
+            let phys = match mapping.grab_page(index) {
+                Some(phys) => phys,
+                None => break,
+            };
+            let in_page = pos % PAGE_SIZE;
+            let len = (PAGE_SIZE - in_page).min(end - pos);
+            unsafe {
+                core::ptr::copy_nonoverlapping(data[pos - offset..].as_ptr(), (phys + in_page) as *mut u8, len);
+            }
+            filemap::put_page(phys);
+            pos += len;
+        }
+
+        if pos < end {
+            self.size.store(old_size.max(pos), Ordering::Release);
+        }
+        if pos == offset {
+            return Err(enospc());
+        }
+        Ok((offset, pos - offset))
+    }
+
+    /// 为第 index 页所在的 2MB 区间整块分配物理连续的页 (shmem_alloc_hugefolio)
+    ///
+    /// # 返回
+    /// 区间已加入页缓存时返回 true；策略不允许、区间中已有页、超出上限或没有连续内存时返回 false
+    fn try_alloc_huge(&self, mapping: &FileMapping, index: usize) -> bool {
+        let extent = index / HPAGE_PMD_NR;
+        let first = extent * HPAGE_PMD_NR;
+        let wanted = match self.info.opts.huge {
+            ShmemHuge::Never => false,
+            ShmemHuge::Always => true,
+            ShmemHuge::WithinSize => (first + HPAGE_PMD_NR) * PAGE_SIZE <= MappingSource::size(self),
+        };
+        if !wanted || !self.info.may_alloc(HPAGE_PMD_NR) || mapping.nr_cached_range(first, first + HPAGE_PMD_NR) != 0 {
+            return false;
+        }
+        let frame = match crate::mm::page::alloc_contig_frames(HPAGE_PMD_NR, HPAGE_PMD_NR) {
+            Some(frame) => frame,
+            None => return false,
+        };
+        let phys = frame.start_address().as_usize();
+        unsafe { core::ptr::write_bytes(phys as *mut u8, 0, HPAGE_PMD_NR * PAGE_SIZE) };
+        mapping.add_new_pages(first, phys, HPAGE_PMD_NR);
+        if self.huge_extents.lock().insert(extent) {
+            NR_SHMEM_THPS.fetch_add(1, Ordering::Relaxed);
+        }
+        true
+    }
+
+    /// 改变文件大小 (shmem_setattr)
+    ///
+    /// 缩小时释放新末尾之后的页，末页中超出新末尾的部分清零；扩大只改变大小，新增部分是空洞
+    pub fn truncate(self: &Arc<Self>, new_size: usize) -> Result<(), i32> {
+        if self.is_dir {
+            return Err(Errno::IsADirectory.as_neg_i32());
+        }
+        let _guard = self.lock.lock();
+        let old_size = MappingSource::size(&**self);
+        if new_size >= old_size {
+            self.size.store(new_size, Ordering::Release);
+            return Ok(());
+        }
+
+        let mapping = self.mapping();
+        let tail = new_size % PAGE_SIZE;
+        if tail != 0 {
+            let index = new_size / PAGE_SIZE;
+            if let Some(phys) = mapping.find_page(index).and_then(|_| mapping.grab_page(index)) {
+                unsafe { core::ptr::write_bytes((phys + tail) as *mut u8, 0, PAGE_SIZE - tail) };
+                filemap::put_page(phys);
+            }
+        }
+        self.size.store(new_size, Ordering::Release);
+        let keep = (new_size + PAGE_SIZE - 1) / PAGE_SIZE;
+        mapping.truncate_pages(keep);
+        self.drop_huge_extents(keep);
+        Ok(())
+    }
+
+    /// 不再完整位于前 keep 页内的 2MB 区间不再算作大页 (split_huge_page)
+    fn drop_huge_extents(&self, keep: usize) {
+        let mut extents = self.huge_extents.lock();
+        let first_dropped = keep / HPAGE_PMD_NR;
+        let dropped = extents.split_off(&first_dropped);
+        NR_SHMEM_THPS.fetch_sub(dropped.len(), Ordering::Relaxed);
+    }
+
+    /// 没有目录项也没有打开的文件时释放数据与 inode 号 (shmem_evict_inode)
+    fn evict_if_unused(&self) {
+        if self.nlink.load(Ordering::Acquire) != 0 || self.open_count.load(Ordering::Acquire) != 0 {
+            return;
+        }
+        // unlink 与最后一次 close 可能同时看到引用归零
+        if self.evicted.swap(true, Ordering::AcqRel) {
+            return;
+        }
+        let _guard = self.lock.lock();
+        self.size.store(0, Ordering::Release);
+        let key = self.mapping_key();
+        if let Some(mapping) = filemap::find_mapping(key) {
+            mapping.truncate_pages(0);
+            filemap::remove_mapping(key);
+        }
+        self.drop_huge_extents(0);
+        self.info.free_inode();
+    }
+}
+
+// ==================== 超级块 ====================
+
+/// tmpfs 超级块
+#[repr(C)]
+pub struct TmpfsSuperBlock {
+    /// 基础超级块（必须在首位，挂载时按 *mut SuperBlock 传递）
+    pub sb: SuperBlock,
+    info: Arc<TmpfsSbInfo>,
+    root: Arc<TmpfsInode>,
+}
+
+impl TmpfsSuperBlock {
+    pub fn new(opts: TmpfsOptions) -> Self {
+        let sb = SuperBlock::new(PAGE_SIZE, TMPFS_MAGIC);
+        let info = Arc::new(TmpfsSbInfo {
+            dev: sb.s_dev as u32,
+            opts,
+            used_blocks: AtomicUsize::new(0),
+            // 根目录占一个 inode
+            used_inodes: AtomicUsize::new(1),
+            next_ino: AtomicU64::new(2),
+        });
+        let root = Arc::new(TmpfsInode::new(1, true, 0o1777, info.clone()));
+        Self { sb, info, root }
+    }
+
+    /// 挂载选项
+    pub fn options(&self) -> TmpfsOptions {
+        self.info.opts
+    }
+
+    /// 已用的页数
+    pub fn used_blocks(&self) -> usize {
+        self.info.used_blocks.load(Ordering::Relaxed)
+    }
+
+    /// 已用的 inode 数
+    pub fn used_inodes(&self) -> usize {
+        self.info.used_inodes.load(Ordering::Relaxed)
+    }
+
+    /// 按路径查找，路径相对于挂载点
+    pub fn lookup(&self, path: &str) -> Option<Arc<TmpfsInode>> {
+        let mut node = self.root.clone();
+        for name in path.split('/').filter(|s| !s.is_empty() && *s != ".") {
+            if !node.is_dir {
+                return None;
+            }
+            let child = node.children.lock().get(name).cloned()?;
+            node = child;
+        }
+        Some(node)
+    }
+
+    /// 分离出父目录和最后一个分量
+    fn split_parent<'a>(&self, path: &'a str) -> Result<(Arc<TmpfsInode>, &'a str), i32> {
+        let path = path.trim_end_matches('/');
+        let (parent, name) = match path.rfind('/') {
+            Some(pos) => (&path[..pos], &path[pos + 1..]),
+            None => ("", path),
+        };
+        if name.is_empty() || name == "." || name == ".." {
+            return Err(einval());
+        }
+        if name.len() > NAME_MAX {
+            return Err(einval());
+        }
+        match self.lookup(parent) {
+            Some(dir) if dir.is_dir => Ok((dir, name)),
+            Some(_) => Err(Errno::NotADirectory.as_neg_i32()),
+            None => Err(Errno::NoSuchFileOrDirectory.as_neg_i32()),
+        }
+    }
+
+    /// 创建文件或目录 (shmem_mknod)
+    pub fn create(&self, path: &str, mode: u32, is_dir: bool) -> Result<Arc<TmpfsInode>, i32> {
+        let (dir, name) = self.split_parent(path)?;
+        let mut children = dir.children.lock();
+        if children.contains_key(name) {
+            return Err(Errno::FileExists.as_neg_i32());
+        }
+        let ino = self.info.reserve_inode()?;
+        let inode = Arc::new(TmpfsInode::new(ino, is_dir, mode, self.info.clone()));
+        children.insert(String::from(name), inode.clone());
+        Ok(inode)
+    }
+
+    /// 创建目录
+    pub fn mkdir(&self, path: &str, mode: u32) -> Result<(), i32> {
+        self.create(path, mode, true).map(|_| ())
+    }
+
+    /// 删除文件；仍被打开的文件在最后一次关闭时释放 (shmem_unlink)
+    pub fn unlink(&self, path: &str) -> Result<(), i32> {
+        let (dir, name) = self.split_parent(path)?;
+        let inode = {
+            let mut children = dir.children.lock();
+            match children.get(name) {
+                Some(inode) if inode.is_dir => return Err(Errno::IsADirectory.as_neg_i32()),
+                Some(_) => {}
+                None => return Err(Errno::NoSuchFileOrDirectory.as_neg_i32()),
+            }
+            children.remove(name)
+        };
+        if let Some(inode) = inode {
+            inode.nlink.store(0, Ordering::Release);
+            inode.evict_if_unused();
+        }
+        Ok(())
+    }
+
+    /// 删除空目录 (shmem_rmdir)
+    pub fn rmdir(&self, path: &str) -> Result<(), i32> {
+        if path.split('/').all(|s| s.is_empty() || s == ".") {
+            return Err(Errno::DeviceOrResourceBusy.as_neg_i32());
+        }
+        let (dir, name) = self.split_parent(path)?;
+        let mut children = dir.children.lock();
+        match children.get(name) {
+            Some(inode) if !inode.is_dir => return Err(Errno::NotADirectory.as_neg_i32()),
+            Some(inode) if !inode.children.lock().is_empty() => {
+                return Err(Errno::DirectoryNotEmpty.as_neg_i32())
+            }
+            Some(_) => {}
+            None => return Err(Errno::NoSuchFileOrDirectory.as_neg_i32()),
+        }
+        if let Some(inode) = children.remove(name) {
+            inode.nlink.store(0, Ordering::Release);
+            self.info.free_inode();
+        }
+        Ok(())
+    }
+
+    /// 列出目录：(名字, inode 号, 是否为目录)
+    pub fn list_dir(&self, path: &str) -> Option<Vec<(Vec<u8>, u64, bool)>> {
+        let dir = self.lookup(path)?;
+        if !dir.is_dir {
+            return None;
+        }
+        let children = dir.children.lock();
+        Some(
+            children
+                .iter()
+                .map(|(name, inode)| (name.as_bytes().to_vec(), inode.ino, inode.is_dir))
+                .collect(),
+        )
+    }
+}
+
+// ==================== 文件操作 ====================
+
+/// 打开文件持有的 inode（private_data 是 Arc::into_raw 得到的指针）
+fn file_inode(file: &File) -> Option<&TmpfsInode> {
+    let ptr = unsafe { (*file.private_data.get())? } as *const TmpfsInode;
+    Some(unsafe { &*ptr })
+}
+
+/// 打开文件持有的 inode，另加一个引用
+fn file_inode_arc(file: &File) -> Option<Arc<TmpfsInode>> {
+    let ptr = unsafe { (*file.private_data.get())? } as *const TmpfsInode;
+    unsafe {
+        Arc::increment_strong_count(ptr);
+        Some(Arc::from_raw(ptr))
+    }
+}
+
+/// 普通文件的页缓存，vfs::file_mapping 使用
+pub fn tmpfs_file_mapping(file: &File) -> Option<Arc<FileMapping>> {
+    if !is_tmpfs_file(file) {
+        return None;
+    }
+    Some(file_inode_arc(file)?.mapping())
+}
+
+/// 是否为 tmpfs 普通文件
+pub fn is_tmpfs_file(file: &File) -> bool {
+    unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &TMPFS_FILE_OPS))
+}
+
+fn tmpfs_file_read(file: &File, buf: &mut [u8]) -> isize {
+    let inode = match file_inode_arc(file) {
+        Some(inode) => inode,
+        None => return -9,  // EBADF
+    };
+    if file.flags.is_writeonly() {
+        return -9;  // EBADF
+    }
+    let offset = file.get_pos() as usize;
+    let read = inode.read(offset, buf);
+    file.set_pos((offset + read) as u64);
+    read as isize
+}
+
+fn tmpfs_file_read_iter(file: &File, iov: &mut [&mut [u8]], pos: u64) -> isize {
+    let inode = match file_inode_arc(file) {
+        Some(inode) => inode,
+        None => return -9,  // EBADF
+    };
+    if file.flags.is_writeonly() {
+        return -9;  // EBADF
+    }
+    let mut offset = pos as usize;
+    let mut total = 0;
+    for buf in iov.iter_mut() {
+        let read = inode.read(offset, buf);
+        offset += read;
+        total += read;
+        if read < buf.len() {
+            break;
+        }
+    }
+    total as isize
+}
+
+/// O_APPEND 时写到文件末尾，否则写到 pos
+fn write_at(file: &File, inode: &Arc<TmpfsInode>, pos: usize, data: &[u8]) -> Result<(usize, usize), i32> {
+    if file.flags.bits() & FileFlags::O_APPEND != 0 {
+        inode.append(data)
+    } else {
+        inode.write(pos, data).map(|written| (pos, written))
+    }
+}
+
+fn tmpfs_file_write(file: &File, buf: &[u8]) -> isize {
+    let inode = match file_inode_arc(file) {
+        Some(inode) => inode,
+        None => return -9,  // EBADF
+    };
+    if file.flags.is_readonly() {
+        return -9;  // EBADF
+    }
+    match write_at(file, &inode, file.get_pos() as usize, buf) {
+        Ok((start, written)) => {
+            file.set_pos((start + written) as u64);
+            written as isize
+        }
+        Err(e) => e as isize,
+    }
+}
+
+fn tmpfs_file_write_iter(file: &File, iov: &[&[u8]], pos: u64) -> isize {
+    let inode = match file_inode_arc(file) {
+        Some(inode) => inode,
+        None => return -9,  // EBADF
+    };
+    if file.flags.is_readonly() {
+        return -9;  // EBADF
+    }
+    let mut offset = pos as usize;
+    let mut total = 0;
+    for buf in iov.iter().filter(|buf| !buf.is_empty()) {
+        match write_at(file, &inode, offset, buf) {
+            Ok((start, written)) => {
+                offset = start + written;
+                total += written;
+                if written < buf.len() {
+                    break;
+                }
+            }
+            Err(e) if total == 0 => return e as isize,
+            Err(_) => break,
+        }
+    }
+    total as isize
+}
+
+fn tmpfs_file_lseek(file: &File, offset: isize, whence: i32) -> isize {
+    let size = match file_inode(file) {
+        Some(inode) => MappingSource::size(inode) as isize,
+        None => return -9,  // EBADF
+    };
+    let new_pos = match whence {
+        0 => offset,                           // SEEK_SET
+        1 => file.get_pos() as isize + offset, // SEEK_CUR
+        2 => size + offset,                    // SEEK_END
+        _ => return -22,                       // EINVAL
+    };
+    if new_pos < 0 {
+        return -22;  // EINVAL
+    }
+    file.set_pos(new_pos as u64);
+    new_pos
+}
+
+/// 放下打开文件持有的 inode 引用，已删除的文件在最后一次关闭时释放
+fn tmpfs_file_close(file: &File) -> i32 {
+    let ptr = match unsafe { *file.private_data.get() } {
+        Some(ptr) => ptr as *const TmpfsInode,
+        None => return 0,
+    };
+    let inode = unsafe { Arc::from_raw(ptr) };
+    inode.open_count.fetch_sub(1, Ordering::AcqRel);
+    inode.evict_if_unused();
+    0
+}
+
+/// tmpfs 普通文件操作表
+pub static TMPFS_FILE_OPS: FileOps = FileOps {
+    read: Some(tmpfs_file_read),
+    write: Some(tmpfs_file_write),
+    lseek: Some(tmpfs_file_lseek),
+    close: Some(tmpfs_file_close),
+    read_iter: Some(tmpfs_file_read_iter),
+    write_iter: Some(tmpfs_file_write_iter),
+    poll: None,
+};
+
+/// 目录关闭时释放 DirContext
+fn tmpfs_dir_close(file: &File) -> i32 {
+    if let Some(ptr) = unsafe { *file.private_data.get() } {
+        drop(unsafe { Box::from_raw(ptr as *mut DirContext) });
+    }
+    0
+}
+
+/// tmpfs 目录操作表，目录项由 getdents64 按 DirContext 中的路径读取
+pub static TMPFS_DIR_OPS: FileOps = FileOps {
+    read: None,
+    write: None,
+    lseek: None,
+    close: Some(tmpfs_dir_close),
+    read_iter: None,
+    write_iter: None,
+    poll: None,
+};
+
+/// 打开文件，path 相对于挂载点 (shmem_file_open)
+///
+/// 支持 O_CREAT、O_EXCL 与 O_TRUNC
+pub fn open(sb: &TmpfsSuperBlock, path: &str, flags: u32, mode: u32) -> Result<usize, i32> {
+    let o_creat = flags & FileFlags::O_CREAT != 0;
+    let o_excl = flags & FileFlags::O_EXCL != 0;
+    let inode = match sb.lookup(path) {
+        Some(_) if o_creat && o_excl => return Err(Errno::FileExists.as_neg_i32()),
+        Some(inode) => inode,
+        None if o_creat => sb.create(path, mode, false)?,
+        None => return Err(Errno::NoSuchFileOrDirectory.as_neg_i32()),
+    };
+    if inode.is_dir {
+        return Err(Errno::IsADirectory.as_neg_i32());
+    }
+    let flags_obj = FileFlags::new(flags);
+    if flags & FileFlags::O_TRUNC != 0 && !flags_obj.is_readonly() {
+        inode.truncate(0)?;
+    }
+
+    let file = Arc::new(File::new(flags_obj));
+    file.set_ops(&TMPFS_FILE_OPS);
+    inode.open_count.fetch_add(1, Ordering::AcqRel);
+    file.set_private_data(Arc::into_raw(inode) as *mut u8);
+    match unsafe { get_file_fd_install(file.clone()) } {
+        Some(fd) => Ok(fd),
+        None => {
+            // 关闭时放下 inode 引用
+            fput(file);
+            Err(Errno::TooManyOpenFiles.as_neg_i32())
+        }
+    }
+}
+
+/// 打开目录，path 相对于挂载点；full_path 记入 DirContext 供 getdents64 使用
+pub fn opendir(sb: &TmpfsSuperBlock, path: &str, full_path: &str, flags: u32) -> Result<usize, i32> {
+    match sb.lookup(path) {
+        Some(inode) if inode.is_dir => {}
+        Some(_) => return Err(Errno::NotADirectory.as_neg_i32()),
+        None => return Err(Errno::NoSuchFileOrDirectory.as_neg_i32()),
+    }
+    let file = Arc::new(File::new(FileFlags::new(flags)));
+    file.set_ops(&TMPFS_DIR_OPS);
+    let ctx = Box::new(DirContext::new_tmpfs(full_path));
+    file.set_private_data(Box::into_raw(ctx) as *mut u8);
+    match unsafe { get_file_fd_install(file.clone()) } {
+        Some(fd) => Ok(fd),
+        None => {
+            fput(file);
+            Err(Errno::TooManyOpenFiles.as_neg_i32())
+        }
+    }
+}
+
+/// 截断打开的文件 (do_sys_ftruncate)
+///
+/// # 返回
+/// 不是 tmpfs 文件时返回 None
+pub fn ftruncate(file: &File, length: usize) -> Option<Result<(), i32>> {
+    if !is_tmpfs_file(file) {
+        return None;
+    }
+    let inode = file_inode_arc(file)?;
+    if file.flags.is_readonly() {
+        return Some(Err(einval()));
+    }
+    Some(inode.truncate(length))
+}
+
+/// 填充 tmpfs 文件或目录的 stat
+///
+/// # 返回
+/// 不是 tmpfs 文件或目录时返回 None
+pub fn tmpfs_stat(file: &File, stat: &mut Stat) -> Option<()> {
+    let ops = unsafe { *file.ops.get() }?;
+    let (dev, inode) = if core::ptr::eq(ops, &TMPFS_FILE_OPS) {
+        let inode = file_inode_arc(file)?;
+        (inode.info.dev, inode)
+    } else if core::ptr::eq(ops, &TMPFS_DIR_OPS) {
+        let ctx = unsafe { &*((*file.private_data.get())? as *const DirContext) };
+        let (sb, path) = resolve(ctx.get_path())?;
+        let inode = sb.lookup(path)?;
+        (sb.info.dev, inode)
+    } else {
+        return None;
+    };
+    fill_stat(dev, &inode, stat);
+    Some(())
+}
+
+/// 按路径获取 tmpfs 文件状态，不打开文件 (vfs_statx → shmem_getattr)
+pub fn path_stat(sb: &'static TmpfsSuperBlock, path: &str, stat: &mut Stat) -> Result<(), i32> {
+    let inode = sb.lookup(path).ok_or(Errno::NoSuchFileOrDirectory.as_neg_i32())?;
+    fill_stat(sb.info.dev, &inode, stat);
+    Ok(())
+}
+
+/// 由 tmpfs inode 填充 stat (shmem_getattr)
+fn fill_stat(dev: u32, inode: &TmpfsInode, stat: &mut Stat) {
+    stat.st_dev = dev as u64;
+    stat.st_ino = inode.ino;
+    stat.st_nlink = if inode.is_dir { 2 } else { inode.nlink.load(Ordering::Relaxed) };
+    stat.st_uid = 0;
+    stat.st_gid = 0;
+    stat.st_rdev = 0;
+    stat.st_blksize = PAGE_SIZE as u64;
+    if inode.is_dir {
+        stat.st_size = 0;
+        stat.st_blocks = 0;
+        stat.set_directory();
+    } else {
+        stat.st_size = MappingSource::size(inode) as i64;
+        stat.st_blocks = (inode.nr_pages() * (PAGE_SIZE / 512)) as u64;
+        stat.set_regular_file();
+    }
+    stat.set_mode(inode.mode());
+    stat.st_atime = 0;
+    stat.st_atime_nsec = 0;
+    stat.st_mtime = 0;
+    stat.st_mtime_nsec = 0;
+    stat.st_ctime = 0;
+    stat.st_ctime_nsec = 0;
+}
+
+// ==================== 文件系统类型注册 ====================
+
+/// tmpfs 文件系统类型
+pub static TMPFS_FS_TYPE: FileSystemType = FileSystemType::new(
+    "tmpfs",
+    Some(tmpfs_mount),
+    Some(tmpfs_kill_sb),
+    0,
+);
+
+/// 已挂载的实例：(挂载点, 超级块地址)
+static TMPFS_MOUNTS: Mutex<Vec<(String, usize)>> = Mutex::new(Vec::new());
+
+/// tmpfs 挂载函数，数据选项见 TmpfsOptions::parse
+unsafe extern "C" fn tmpfs_mount(fs_context: &FsContext<'_>) -> Result<*mut SuperBlock, i32> {
+    let opts = TmpfsOptions::parse(fs_context.data)?;
+    let sb = Box::new(TmpfsSuperBlock::new(opts));
+    Ok(Box::into_raw(sb) as *mut SuperBlock)
+}
+
+/// tmpfs 卸载函数
+unsafe extern "C" fn tmpfs_kill_sb(sb: *mut SuperBlock) {
+    if !sb.is_null() {
+        let _ = Box::from_raw(sb as *mut TmpfsSuperBlock);
+    }
+}
+
+/// 查找路径所在的 tmpfs 实例
+///
+/// 经 lookup_mnt 在 RCU 读取的挂载散列表中查找，打开文件不再经过 TMPFS_MOUNTS 的锁；
+/// 路径所在的最深挂载不是 tmpfs 时交给其他文件系统
+///
+/// # 返回
+/// (超级块, 相对于挂载点的路径)；路径不在任何 tmpfs 下时返回 None
+pub fn resolve(path: &str) -> Option<(&'static TmpfsSuperBlock, &str)> {
+    let (mnt, rest) = crate::fs::namei::lookup_mnt(path)?;
+    if !mnt.is_fstype(&TMPFS_FS_TYPE) {
+        return None;
+    }
+    // 实例挂载后不再释放
+    let sb = mnt.mnt_sb? as *const TmpfsSuperBlock;
+    Some((unsafe { &*sb }, rest))
+}
+
+/// 挂载点对应的实例
+pub fn get_tmpfs_sb(mountpoint: &str) -> Option<&'static TmpfsSuperBlock> {
+    let mounts = TMPFS_MOUNTS.lock();
+    let (_, sb) = mounts.iter().find(|(mp, _)| mp == mountpoint)?;
+    Some(unsafe { &*(*sb as *const TmpfsSuperBlock) })
+}
+
+/// 所有实例占用的页数 (Shmem)
+pub fn nr_shmem_pages() -> usize {
+    NR_SHMEM.load(Ordering::Relaxed)
+}
+
+/// 所有实例中整块分配的 2MB 区间数 (ShmemHugePages)
+pub fn nr_shmem_huge_pages() -> usize {
+    NR_SHMEM_THPS.load(Ordering::Relaxed)
+}
+
+/// 注册 tmpfs
+pub fn init_tmpfs() -> Result<(), i32> {
+    crate::fs::superblock::register_filesystem(&TMPFS_FS_TYPE)
+}
+
+/// 挂载一个 tmpfs 实例到 mountpoint，逐级创建 RootFS 中的挂载点目录
+pub fn mount_tmpfs(mountpoint: &str, data: Option<&str>) -> Result<(), i32> {
+    let rootfs_sb = match crate::fs::rootfs::get_rootfs_sb() {
+        Some(sb) => sb,
+        None => return Err(-1),
+    };
+    if get_tmpfs_sb(mountpoint).is_some() {
+        return Err(Errno::DeviceOrResourceBusy.as_neg_i32());
+    }
+
+    // 已存在的目录保留
+    let mut end = 0;
+    while end < mountpoint.len() {
+        end = mountpoint[end + 1..].find('/').map_or(mountpoint.len(), |pos| end + 1 + pos);
+        match unsafe { (*rootfs_sb).create_dir(&mountpoint[..end], 0o755) } {
+            Ok(()) => {}
+            Err(e) if e == Errno::FileExists.as_neg_i32() => {}
+            Err(e) => return Err(e),
+        }
+    }
+
+    let mut fc = FsContext::new(Some("tmpfs"), Some(mountpoint), 0);
+    fc.data = data;
+    let sb_ptr = unsafe { tmpfs_mount(&fc)? };
+
+    let mount = Arc::new(VfsMount::new(
+        mountpoint.as_bytes().to_vec(),
+        mountpoint.as_bytes().to_vec(),
+        MntFlags::new(0),
+        Some(sb_ptr as *mut u8),
+    ).with_fstype(&TMPFS_FS_TYPE));
+    if let Err(e) = crate::fs::mount::get_init_namespace().add_mount(mount) {
+        unsafe { tmpfs_kill_sb(sb_ptr) };
+        return Err(e);
+    }
+    TMPFS_MOUNTS.lock().push((String::from(mountpoint), sb_ptr as usize));
+    Ok(())
+}
+
+/// 挂载启动时的 /tmp 与 /dev/shm，使用默认选项
+pub fn mount_default_tmpfs() -> Result<(), i32> {
+    for mountpoint in TMPFS_MOUNT_POINTS {
+        mount_tmpfs(mountpoint, None)?;
+    }
+    Ok(())
+}
@@ -5,28 +5,19 @@
 //! 虚拟文件系统 (VFS) 核心功能
 
 use alloc::boxed::Box;
+use alloc::string::String;
 use alloc::vec::Vec;
 use alloc::sync::Arc;
-use spin::Mutex;
 
 use crate::errno;
-use crate::fs::file::{File, FileFlags, FileOps, get_file_fd, close_file_fd, get_file_fd_install};
+use crate::fs::file::{File, FileFlags, FileOps, fdget, get_file_fd, close_file_fd, get_file_fd_install};
 use crate::fs::rootfs::{RootFSNode, get_rootfs};
 use crate::fs::ext4;
+use crate::fs::tmpfs;
 use crate::fs::Stat;
+use crate::fs::stat::{AT_FDCWD, STATX_BASIC_STATS, STATX_SIZE};
 use crate::println;
 
-/// VFS 全局状态
-struct VfsState {
-    root_inode: Option<Arc<()>>,  // 将来替换为实际的 root inode
-    initialized: bool,
-}
-
-static VFS_STATE: Mutex<VfsState> = Mutex::new(VfsState {
-    root_inode: None,
-    initialized: false,
-});
-
 /// 初始化 VFS
 pub fn init() {
     use crate::console::putchar;
@@ -42,11 +33,6 @@ pub fn init() {
         unsafe { putchar(b); }
     }
 
-    {
-        let mut state = VFS_STATE.lock();
-        state.initialized = true;
-    }
-
     const MSG4: &[u8] = b"vfs: VFS layer initialized [OK]\n";
     for &b in MSG4 {
         unsafe { putchar(b); }
@@ -58,7 +44,7 @@ pub fn init() {
 /// # 参数
 /// - filename: 文件名（必须是绝对路径）
 /// - flags: O_RDONLY (0), O_WRONLY (1), O_RDWR (2), O_CREAT (0o100), O_EXCL (0o200), O_TRUNC (0o1000)
-/// - mode: 文件权限（创建时使用，当前未实现）
+/// - mode: 文件权限（创建时使用，目前只有 tmpfs 记录）
 ///
 /// # 返回
 /// 成功返回文件描述符，失败返回错误码
@@ -68,7 +54,22 @@ pub fn init() {
 /// - O_CREAT: 文件不存在时创建
 /// - O_EXCL: 与 O_CREAT 一起使用，文件已存在时返回错误
 /// - O_TRUNC: 截断文件为空
-pub fn file_open(filename: &str, flags: u32, _mode: u32) -> Result<usize, i32> {
+pub fn file_open(filename: &str, flags: u32, mode: u32) -> Result<usize, i32> {
+    // 字符设备节点
+    if let Some(ret) = crate::fs::char_dev::char_dev_open(filename, flags) {
+        return ret;
+    }
+
+    // tmpfs 挂载点下的路径交给 tmpfs
+    if let Some((tmpfs_sb, path)) = tmpfs::resolve(filename) {
+        return tmpfs::open(tmpfs_sb, path, flags, mode);
+    }
+
+    // /proc 下的文件按记录生成内容
+    if let Some(ret) = crate::fs::procfs::open(filename, flags) {
+        return ret;
+    }
+
     unsafe {
         // 1. 获取 RootFS 超级块
         let sb_ptr = get_rootfs();
@@ -94,6 +95,10 @@ pub fn file_open(filename: &str, flags: u32, _mode: u32) -> Result<usize, i32> {
                 (n, false)
             }
             None => {
+                // ext4 上已存在的普通文件
+                if let Some(ret) = ext4_file_open(filename, flags) {
+                    return ret;
+                }
                 // 文件不存在
                 if o_creat {
                     // 创建新文件
@@ -162,6 +167,157 @@ pub fn file_close(fd: usize) -> Result<(), i32> {
     }
 }
 
+/// 打开文件的页缓存 (file->f_mapping)
+///
+/// 只有经页缓存读写的普通文件有页缓存，管道、设备和目录返回 None
+pub fn file_mapping(file: &File) -> Option<Arc<crate::mm::filemap::FileMapping>> {
+    let ops = unsafe { *file.ops.get() };
+    if ops.map_or(false, |ops| core::ptr::eq(ops, &ROOTFS_FILE_OPS)) {
+        unsafe { rootfs_file_mapping(file) }
+    } else if ops.map_or(false, |ops| core::ptr::eq(ops, &EXT4_FILE_OPS)) {
+        let (fs, ei) = ext4_file_inode(file)?;
+        Some(ext4::file::ext4_mapping(fs, &ei))
+    } else {
+        tmpfs::tmpfs_file_mapping(file)
+    }
+}
+
+/// 把文件的脏页写回存储 (vfs_fsync)
+///
+/// # 返回
+/// 成功返回 Ok(())；fd 无效返回 EBADF，回写失败返回回写错误
+pub fn file_fsync(fd: usize) -> Result<(), i32> {
+    vfs_fsync(fd, false)
+}
+
+/// 只同步文件数据和读取数据所需的元数据 (fdatasync)
+///
+/// 只改变了时间戳的 inode 不必等待日志提交
+pub fn file_fdatasync(fd: usize) -> Result<(), i32> {
+    vfs_fsync(fd, true)
+}
+
+/// fsync / fdatasync 的公共部分 (vfs_fsync_range)
+fn vfs_fsync(fd: usize, datasync: bool) -> Result<(), i32> {
+    let file = unsafe { get_file_fd(fd) }.ok_or(errno::Errno::BadFileNumber.as_neg_i32())?;
+    if unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &EXT4_FILE_OPS)) {
+        let (fs, ei) = ext4_file_inode(&file).ok_or(errno::Errno::IOError.as_neg_i32())?;
+        return ext4::file::ext4_sync_file(fs, &ei, datasync);
+    }
+    let mapping = file_mapping(&file);
+    if let Some(mapping) = mapping {
+        mapping.writeback()?;
+        match mapping.take_wb_error() {
+            0 => {}
+            e => return Err(e),
+        }
+    }
+    Ok(())
+}
+
+/// 等待写回开始前已在进行的回写 (SYNC_FILE_RANGE_WAIT_BEFORE)
+pub const SYNC_FILE_RANGE_WAIT_BEFORE: u32 = 1;
+/// 发起范围内脏页的回写 (SYNC_FILE_RANGE_WRITE)
+pub const SYNC_FILE_RANGE_WRITE: u32 = 2;
+/// 等待回写完成 (SYNC_FILE_RANGE_WAIT_AFTER)
+pub const SYNC_FILE_RANGE_WAIT_AFTER: u32 = 4;
+
+/// 回写文件 [offset, offset + nbytes) 的脏页 (ksys_sync_file_range)
+///
+/// nbytes 为 0 表示到文件末尾。与 Linux 一样不写回元数据，也不刷新设备缓存；
+/// 这里的回写是同步的，WAIT_BEFORE / WAIT_AFTER 只决定是否报告回写错误
+///
+/// # 返回
+/// 成功返回 Ok(())；fd 无效返回 EBADF，参数无效返回 EINVAL
+pub fn file_sync_range(fd: usize, offset: i64, nbytes: i64, flags: u32) -> Result<(), i32> {
+    let valid = SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER;
+    if flags & !valid != 0 || offset < 0 || nbytes < 0 || offset.checked_add(nbytes).is_none() {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    let file = unsafe { get_file_fd(fd) }.ok_or(errno::Errno::BadFileNumber.as_neg_i32())?;
+    let mapping = match file_mapping(&file) {
+        Some(mapping) => mapping,
+        None => return Ok(()),
+    };
+    if flags & SYNC_FILE_RANGE_WRITE != 0 {
+        let start = offset as usize / crate::mm::PAGE_SIZE;
+        let end = if nbytes == 0 {
+            usize::MAX
+        } else {
+            ((offset + nbytes) as usize).div_ceil(crate::mm::PAGE_SIZE)
+        };
+        mapping.writeback_range(start, end)?;
+    }
+    if flags & (SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WAIT_AFTER) != 0 {
+        match mapping.take_wb_error() {
+            0 => {}
+            e => return Err(e),
+        }
+    }
+    Ok(())
+}
+
+/// 改变打开文件的大小 (do_sys_ftruncate)
+///
+/// # 返回
+/// 成功返回 Ok(())；fd 无效返回 EBADF，不支持截断的文件返回 EINVAL，空间不足返回 ENOSPC
+///
+/// 目前只有 tmpfs 文件支持截断
+pub fn file_ftruncate(fd: usize, length: i64) -> Result<(), i32> {
+    let file = unsafe { get_file_fd(fd) }.ok_or(errno::Errno::BadFileNumber.as_neg_i32())?;
+    if length < 0 {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    match tmpfs::ftruncate(&file, length as usize) {
+        Some(result) => result,
+        None => Err(errno::Errno::InvalidArgument.as_neg_i32()),
+    }
+}
+
+/// 文件访问模式建议 (generic_fadvise)
+///
+/// # 参数
+/// - fd: 文件描述符
+/// - offset, len: 建议适用的字节范围，len 为 0 表示到文件末尾
+/// - advice: POSIX_FADV_*
+///
+/// # 返回
+/// 成功返回 Ok(())；fd 无效返回 EBADF，advice 无效返回 EINVAL
+pub fn file_fadvise(fd: usize, offset: u64, len: u64, advice: i32) -> Result<(), i32> {
+    use crate::mm::filemap::fadvise::*;
+    use crate::mm::filemap::RaMode;
+    use crate::mm::PAGE_SIZE;
+
+    let file = unsafe { get_file_fd(fd) }.ok_or(errno::Errno::BadFileNumber.as_neg_i32())?;
+    let mapping = file_mapping(&file);
+    let start = (offset / PAGE_SIZE as u64) as usize;
+    let end = if len == 0 {
+        usize::MAX
+    } else {
+        (offset.saturating_add(len).saturating_add(PAGE_SIZE as u64 - 1) / PAGE_SIZE as u64) as usize
+    };
+
+    match advice {
+        POSIX_FADV_NORMAL => file.ra.lock().mode = RaMode::Normal,
+        POSIX_FADV_RANDOM => file.ra.lock().mode = RaMode::Random,
+        POSIX_FADV_SEQUENTIAL => file.ra.lock().mode = RaMode::Sequential,
+        POSIX_FADV_WILLNEED => {
+            if let Some(mapping) = mapping {
+                mapping.readahead(start, end - start);
+            }
+        }
+        POSIX_FADV_DONTNEED => {
+            if let Some(mapping) = mapping {
+                mapping.invalidate_range(start, end);
+            }
+            file.ra.lock().reset();
+        }
+        POSIX_FADV_NOREUSE => {}
+        _ => return Err(errno::Errno::InvalidArgument.as_neg_i32()),
+    }
+    Ok(())
+}
+
 ///
 ///
 /// # 参数
@@ -174,9 +330,9 @@ pub fn file_close(fd: usize) -> Result<(), i32> {
 pub fn file_read(fd: usize, buf: &mut [u8], count: usize) -> Result<usize, i32> {
     unsafe {
         // 获取文件对象
-        match get_file_fd(fd) {
+        match fdget(fd) {
             Some(file) => {
-                // Arc 自动 Deref 到 File
+                // FileRef 自动 Deref 到 File
                 let file_ref: &File = &*file;
                 let buf_ptr = buf.as_mut_ptr();
                 let read_count = count.min(buf.len());
@@ -208,9 +364,9 @@ pub fn file_read(fd: usize, buf: &mut [u8], count: usize) -> Result<usize, i32>
 pub fn file_write(fd: usize, buf: &[u8], count: usize) -> Result<usize, i32> {
     unsafe {
         // 获取文件对象
-        match get_file_fd(fd) {
+        match fdget(fd) {
             Some(file) => {
-                // Arc 自动 Deref 到 File
+                // FileRef 自动 Deref 到 File
                 let file_ref: &File = &*file;
                 let buf_ptr = buf.as_ptr();
                 let write_count = count.min(buf.len());
@@ -259,6 +415,16 @@ pub fn file_stat(fd: usize, stat: &mut Stat) -> Result<(), i32> {
                     return Ok(());
                 }
 
+                // tmpfs 文件与目录
+                if tmpfs::tmpfs_stat(file_ref, stat).is_some() {
+                    return Ok(());
+                }
+
+                // ext4 普通文件
+                if ext4_file_stat(file_ref, stat).is_some() {
+                    return Ok(());
+                }
+
                 // 从 private_data 获取数据
                 let data_opt = &*file_ref.private_data.get();
                 if let Some(data_ptr) = *data_opt {
@@ -266,107 +432,18 @@ pub fn file_stat(fd: usize, stat: &mut Stat) -> Result<(), i32> {
                     let ops = &*file_ref.ops.get();
                     if let Some(ops_ref) = ops {
                         // 如果是目录操作，处理 DirContext
-                        if core::ptr::eq(*ops_ref, &ROOTFS_DIR_OPS as *const FileOps) {
-                            // 这是 RootFS 目录，data_ptr 是 DirContext
+                        if core::ptr::eq(*ops_ref, &ROOTFS_DIR_OPS as *const FileOps)
+                            || core::ptr::eq(*ops_ref, &EXT4_DIR_OPS as *const FileOps)
+                        {
+                            // RootFS / ext4 目录，data_ptr 是 DirContext，按打开时的路径重新查找
                             let ctx = &*(data_ptr as *const DirContext);
-                            let path = ctx.get_path();
-
-                            // 重新查找节点
-                            let sb_ptr = get_rootfs();
-                            if sb_ptr.is_null() {
-                                return Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32());
-                            }
-                            let sb = &*sb_ptr;
-                            let node = match sb.lookup(path) {
-                                Some(n) => n,
-                                None => return Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
-                            };
-                            let node_ref = node.as_ref();
-
-                            // 填充 stat 结构
-                            stat.st_dev = 0;
-                            stat.st_ino = node_ref.ino;
-                            stat.st_nlink = 1;
-                            stat.st_uid = 0;
-                            stat.st_gid = 0;
-                            stat.st_rdev = 0;
-                            stat.st_size = 0;
-                            stat.st_blocks = 0;
-                            stat.st_blksize = 4096;
-                            stat.set_directory();
-                            stat.set_mode(0o755);
-                            stat.st_atime = 0;
-                            stat.st_atime_nsec = 0;
-                            stat.st_mtime = 0;
-                            stat.st_mtime_nsec = 0;
-                            stat.st_ctime = 0;
-                            stat.st_ctime_nsec = 0;
-                            return Ok(());
-                        } else if core::ptr::eq(*ops_ref, &EXT4_DIR_OPS as *const FileOps) {
-                            // ext4 目录
-                            stat.st_dev = 0;
-                            stat.st_ino = 2;  // 根目录
-                            stat.st_nlink = 1;
-                            stat.st_uid = 0;
-                            stat.st_gid = 0;
-                            stat.st_rdev = 0;
-                            stat.st_size = 0;
-                            stat.st_blocks = 0;
-                            stat.st_blksize = 4096;
-                            stat.set_directory();
-                            stat.set_mode(0o755);
-                            stat.st_atime = 0;
-                            stat.st_atime_nsec = 0;
-                            stat.st_mtime = 0;
-                            stat.st_mtime_nsec = 0;
-                            stat.st_ctime = 0;
-                            stat.st_ctime_nsec = 0;
-                            return Ok(());
+                            return path_stat(ctx.get_path(), STATX_BASIC_STATS, stat).map(|_| ());
                         }
                     }
 
                     // 普通文件：data_ptr 是 RootFSNode 指针
                     let node = &*(data_ptr as *const RootFSNode);
-
-                    // 填充 stat 结构
-                    stat.st_dev = 0;  // RootFS 没有设备概念
-                    stat.st_ino = node.ino;
-                    stat.st_nlink = 1;  // 默认硬链接数为 1
-                    stat.st_uid = 0;   // root 用户
-                    stat.st_gid = 0;   // root 组
-                    stat.st_rdev = 0;
-
-                    // 文件大小
-                    if let Some(ref data) = node.data {
-                        stat.st_size = data.len() as i64;
-                        // 计算块数 (512字节块)
-                        stat.st_blocks = (data.len() as u64 + 511) / 512;
-                    } else {
-                        stat.st_size = 0;
-                        stat.st_blocks = 0;
-                    }
-
-                    stat.st_blksize = 4096;  // 4KB 块大小
-
-                    // 文件类型和权限
-                    if node.is_dir() {
-                        stat.set_directory();
-                        // 目录权限: rwxr-xr-x (0o755)
-                        stat.set_mode(0o755);
-                    } else {
-                        stat.set_regular_file();
-                        // 文件权限: rw-r--r-- (0o644)
-                        stat.set_mode(0o644);
-                    }
-
-                    // 时间戳 (当前使用 0，未来可以实现真实时间戳)
-                    stat.st_atime = 0;
-                    stat.st_atime_nsec = 0;
-                    stat.st_mtime = 0;
-                    stat.st_mtime_nsec = 0;
-                    stat.st_ctime = 0;
-                    stat.st_ctime_nsec = 0;
-
+                    rootfs_fill_stat(node, stat);
                     Ok(())
                 } else {
                     // 没有 private_data，可能是管道或字符设备
@@ -381,6 +458,89 @@ pub fn file_stat(fd: usize, stat: &mut Stat) -> Result<(), i32> {
     }
 }
 
+/// 按路径获取文件状态，不打开文件 (vfs_statx)
+///
+/// 查找顺序与 file_open / file_opendir 一致：字符设备节点、tmpfs、RootFS、ext4。
+/// 只经过 dentry 与 inode 缓存，不建立打开文件；mask 不含 STATX_SIZE 时
+/// ext4 普通文件不查找内存中的 inode，直接用 inode 中的大小
+///
+/// # 参数
+/// - path: 绝对路径（相对 dirfd 的路径先经 at_path 转换）
+/// - mask: 调用者需要的字段 (STATX_*)
+///
+/// # 返回
+/// 成功返回实际填充的字段 (STATX_*)，失败返回错误码
+pub fn path_stat(path: &str, mask: u32, stat: &mut Stat) -> Result<u32, i32> {
+    if crate::fs::char_dev::char_dev_path_stat(path, stat).is_some() {
+        return Ok(STATX_BASIC_STATS);
+    }
+
+    if let Some((tmpfs_sb, rest)) = tmpfs::resolve(path) {
+        return tmpfs::path_stat(tmpfs_sb, rest, stat).map(|()| STATX_BASIC_STATS);
+    }
+
+    let sb_ptr = unsafe { get_rootfs() };
+    if !sb_ptr.is_null() {
+        if let Some(node) = unsafe { &*sb_ptr }.lookup(path) {
+            rootfs_fill_stat(&node, stat);
+            return Ok(STATX_BASIC_STATS);
+        }
+    }
+
+    if let Some(fs) = ext4::get_ext4_fs() {
+        let fs = unsafe { &*fs };
+        let (_, ei) = fs.lookup_path(path)?;
+        return Ok(ext4_fill_stat(fs, &ei, mask, stat));
+    }
+    Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32())
+}
+
+/// 由 RootFS 节点填充 stat
+fn rootfs_fill_stat(node: &RootFSNode, stat: &mut Stat) {
+    *stat = Stat::new();
+    stat.st_ino = node.ino;
+    stat.st_nlink = 1;
+    if let Some(ref data) = node.data {
+        stat.st_size = data.len() as i64;
+        stat.st_blocks = (data.len() as u64 + 511) / 512;
+    }
+    if node.is_dir() {
+        stat.set_directory();
+        stat.set_mode(0o755);
+    } else if node.is_symlink() {
+        stat.set_symlink();
+        stat.set_mode(0o777);
+        stat.st_size = node.link_target.as_ref().map_or(0, |t| t.len() as i64);
+    } else {
+        stat.set_regular_file();
+        stat.set_mode(0o644);
+    }
+}
+
+/// 把相对 dirfd 的路径转换为绝对路径 (*at 系统调用的路径解析)
+///
+/// 绝对路径与 AT_FDCWD 原样返回（没有进程当前目录，相对路径与 openat 一样直接查找）；
+/// 否则 dirfd 必须是打开的目录，路径接在打开时的目录路径之后
+pub fn at_path(dirfd: i32, path: &str) -> Result<String, i32> {
+    if path.starts_with('/') || dirfd == AT_FDCWD {
+        return Ok(String::from(path));
+    }
+    let file = unsafe { get_file_fd(dirfd as usize) }.ok_or(errno::Errno::BadFileNumber.as_neg_i32())?;
+    let ops = unsafe { *file.ops.get() }.ok_or(errno::Errno::NotADirectory.as_neg_i32())?;
+    let is_dir = core::ptr::eq(ops, &ROOTFS_DIR_OPS)
+        || core::ptr::eq(ops, &EXT4_DIR_OPS)
+        || core::ptr::eq(ops, &tmpfs::TMPFS_DIR_OPS);
+    let data_ptr = unsafe { *file.private_data.get() };
+    let ctx = match data_ptr {
+        Some(ptr) if is_dir => unsafe { &*(ptr as *const DirContext) },
+        _ => return Err(errno::Errno::NotADirectory.as_neg_i32()),
+    };
+    let mut abs = String::from(ctx.get_path().trim_end_matches('/'));
+    abs.push('/');
+    abs.push_str(path);
+    Ok(abs)
+}
+
 /// fcntl 命令常量
 ///
 pub mod fcntl {
@@ -399,6 +559,12 @@ pub mod fcntl {
     /// 设置文件状态标志
     pub const F_SETFL: usize = 4;
 
+    /// 设置管道容量 (F_LINUX_SPECIFIC_BASE + 7)
+    pub const F_SETPIPE_SZ: usize = 1031;
+
+    /// 获取管道容量 (F_LINUX_SPECIFIC_BASE + 8)
+    pub const F_GETPIPE_SZ: usize = 1032;
+
     /// FD_CLOEXEC 标志值
     pub const FD_CLOEXEC: usize = 1;
 }
@@ -419,6 +585,7 @@ pub mod fcntl {
 /// - F_SETFD (2) - 设置 close-on-exec 标志
 /// - F_GETFL (3) - 获取文件状态标志
 /// - F_SETFL (4) - 设置文件状态标志
+/// - F_SETPIPE_SZ (1031) / F_GETPIPE_SZ (1032) - 设置 / 获取管道容量
 pub fn file_fcntl(fd: usize, cmd: usize, arg: usize) -> Result<usize, i32> {
     use crate::fs::file::{get_file_fd, get_file_fd_install};
 
@@ -511,6 +678,16 @@ pub fn file_fcntl(fd: usize, cmd: usize, arg: usize) -> Result<usize, i32> {
                 Ok(0)  // 成功返回 0
             }
 
+            // F_SETPIPE_SZ / F_GETPIPE_SZ: 管道容量
+            fcntl::F_SETPIPE_SZ | fcntl::F_GETPIPE_SZ => {
+                let file = match get_file_fd(fd) {
+                    Some(f) => f,
+                    None => return Err(errno::Errno::BadFileNumber.as_neg_i32()),
+                };
+                let size = if cmd == fcntl::F_SETPIPE_SZ { Some(arg) } else { None };
+                crate::fs::pipe::pipe_fcntl(&file, size)
+            }
+
             // 不支持的命令
             _ => {
                 Err(errno::Errno::FunctionNotImplemented.as_neg_i32())
@@ -519,14 +696,20 @@ pub fn file_fcntl(fd: usize, cmd: usize, arg: usize) -> Result<usize, i32> {
     }
 }
 
+/// I/O 多路复用 (do_sys_poll)
+///
+/// # 参数
+/// - fds: 已经复制到内核的 pollfd 数组，返回时填写 revents
+/// - timeout_ms: 超时，0 立即返回，负数一直等待
 ///
-pub fn io_poll(_fds: *mut u8, _nfds: usize, _timeout_ms: i32) -> Result<usize, i32> {
-    // TODO: 实现 I/O 多路复用
-    // 需要实现：
-    // - 等待文件描述符就绪
-    // - 支持超时
-    // - 返回就绪的文件描述符数量
-    Err(errno::Errno::FunctionNotImplemented.as_neg_i32())
+/// # 返回
+/// 成功返回 revents 非零的项数，被信号打断返回 EINTR
+pub fn io_poll(fds: &mut [crate::fs::select::PollFd], timeout_ms: i64) -> Result<usize, i32> {
+    // 每个描述符只查找一次文件，之后的每一遍扫描都直接使用
+    let files: Vec<Option<Arc<File>>> = fds.iter()
+        .map(|pollfd| if pollfd.fd < 0 { None } else { unsafe { get_file_fd(pollfd.fd as usize) } })
+        .collect();
+    crate::fs::select::do_poll(fds, &files, timeout_ms)
 }
 
 ///
@@ -540,6 +723,10 @@ pub fn io_poll(_fds: *mut u8, _nfds: usize, _timeout_ms: i32) -> Result<usize, i
 ///
 /// - RISC-V: 77 (mkdirat), 但我们实现简化的 mkdir
 pub fn file_mkdir(pathname: &str, mode: u32) -> Result<(), i32> {
+    if let Some((tmpfs_sb, path)) = tmpfs::resolve(pathname) {
+        return tmpfs_sb.mkdir(path, mode);
+    }
+
     unsafe {
         // 获取 RootFS 超级块
         let sb_ptr = get_rootfs();
@@ -564,6 +751,10 @@ pub fn file_mkdir(pathname: &str, mode: u32) -> Result<(), i32> {
 ///
 /// - RISC-V: 79
 pub fn file_rmdir(pathname: &str) -> Result<(), i32> {
+    if let Some((tmpfs_sb, path)) = tmpfs::resolve(pathname) {
+        return tmpfs_sb.rmdir(path);
+    }
+
     unsafe {
         // 获取 RootFS 超级块
         let sb_ptr = get_rootfs();
@@ -588,6 +779,10 @@ pub fn file_rmdir(pathname: &str) -> Result<(), i32> {
 ///
 /// - RISC-V: 74 (unlinkat), 但我们实现简化的 unlink
 pub fn file_unlink(pathname: &str) -> Result<(), i32> {
+    if let Some((tmpfs_sb, path)) = tmpfs::resolve(pathname) {
+        return tmpfs_sb.unlink(path);
+    }
+
     unsafe {
         // 获取 RootFS 超级块
         let sb_ptr = get_rootfs();
@@ -630,40 +825,68 @@ pub fn file_link(oldpath: &str, newpath: &str) -> Result<(), i32> {
 // ============================================================================
 // ============================================================================
 
+/// RootFS 普通文件的页缓存
+///
+/// private_data 来自 RootFS 持有的 Arc，页缓存另持一个引用作为数据来源
+unsafe fn rootfs_file_mapping(file: &File) -> Option<Arc<crate::mm::filemap::FileMapping>> {
+    let node_ptr = (*file.private_data.get())? as *const RootFSNode;
+    let node = &*node_ptr;
+    // 目录或无数据
+    node.data.as_ref()?;
+    Arc::increment_strong_count(node_ptr);
+    Some(crate::mm::filemap::get_mapping(node.ino, Arc::from_raw(node_ptr)))
+}
+
 /// RootFS 文件读取操作
 ///
+/// 经页缓存读取：与 mmap 映射的是同一批页，重复读取只从缓存页复制；
+/// 预读窗口由文件的 f_ra 决定
 fn rootfs_file_read(file: &File, buf: &mut [u8]) -> isize {
     unsafe {
-        // 从 private_data 获取 RootFSNode 指针
-        let data_opt = &*file.private_data.get();
-        if let Some(node_ptr) = *data_opt {
-            let node = &*(node_ptr as *const RootFSNode);
-
-            // 获取当前文件位置
-            let offset = file.get_pos() as usize;
-
-            // 检查是否有数据
-            if let Some(ref data) = node.data {
-                let available: usize = data.len().saturating_sub(offset);
-                let to_read = buf.len().min(available);
+        if (*file.private_data.get()).is_none() {
+            return -9;  // EBADF
+        }
+        let mapping = match rootfs_file_mapping(file) {
+            Some(mapping) => mapping,
+            None => return 0,
+        };
 
-                if to_read > 0 {
-                    // 复制数据到缓冲区
-                    buf[..to_read].copy_from_slice(&data[offset..offset + to_read]);
+        // 获取当前文件位置
+        let offset = file.get_pos() as usize;
+        let read = mapping.read_ra(offset, buf, &mut file.ra.lock());
+        if read > 0 {
+            // 更新文件位置
+            file.set_pos((offset + read) as u64);
+        }
+        read as isize
+    }
+}
 
-                    // 更新文件位置
-                    file.set_pos((offset + to_read) as u64);
+/// RootFS 文件按位置的分段读取 (filemap_read)
+///
+/// 页缓存和预读状态只取一次，各段连续读取；某段读不满（到达文件末尾）就停止
+fn rootfs_file_read_iter(file: &File, iov: &mut [&mut [u8]], pos: u64) -> isize {
+    unsafe {
+        if (*file.private_data.get()).is_none() {
+            return -9;  // EBADF
+        }
+        let mapping = match rootfs_file_mapping(file) {
+            Some(mapping) => mapping,
+            None => return 0,
+        };
 
-                    to_read as isize
-                } else {
-                    0  // EOF
-                }
-            } else {
-                0  // 目录或无数据
+        let mut ra = file.ra.lock();
+        let mut offset = pos as usize;
+        let mut total = 0;
+        for buf in iov.iter_mut() {
+            let read = mapping.read_ra(offset, buf, &mut ra);
+            offset += read;
+            total += read;
+            if read < buf.len() {
+                break;
             }
-        } else {
-            -9  // EBADF
         }
+        total as isize
     }
 }
 
@@ -695,7 +918,7 @@ fn rootfs_file_lseek(file: &File, offset: isize, whence: i32) -> isize {
         let data_opt = &*file.private_data.get();
         if let Some(node_ptr) = *data_opt {
             let node = &*(node_ptr as *const RootFSNode);
-            node.data.as_ref().map_or(0isize, |d: &Vec<u8>| d.len() as isize)
+            node.data.as_ref().map_or(0isize, |d| d.len() as isize)
         } else {
             return -9;  // EBADF
         }
@@ -729,6 +952,9 @@ static ROOTFS_FILE_OPS: FileOps = FileOps {
     write: Some(rootfs_file_write),  // 暂时返回 EBADF
     lseek: Some(rootfs_file_lseek),
     close: Some(rootfs_file_close),
+    read_iter: Some(rootfs_file_read_iter),
+    write_iter: None,
+    poll: None,
 };
 
 // ============================================================================
@@ -741,6 +967,7 @@ static ROOTFS_FILE_OPS: FileOps = FileOps {
 pub enum DirType {
     RootFS = 0,
     Ext4 = 1,
+    Tmpfs = 2,
 }
 
 /// 目录上下文（存储在 File 的 private_data 中）
@@ -748,9 +975,11 @@ pub enum DirType {
 pub struct DirContext {
     /// 目录类型
     pub dir_type: DirType,
-    /// 当前读取偏移
+    /// 当前读取偏移：rootfs 与 tmpfs 是已返回的目录项数，ext4 是目录内的字节位置
     pub offset: usize,
-    /// 目录路径（用于 ext4）
+    /// 目录的 inode 编号（ext4 打开时解析一次，之后按游标读取）
+    pub ino: u64,
+    /// 目录路径（用于 ext4 与 tmpfs）
     pub path: [u8; 256],
     /// 路径长度
     pub path_len: usize,
@@ -761,6 +990,7 @@ impl DirContext {
         let mut ctx = Self {
             dir_type: DirType::RootFS,
             offset: 0,
+            ino: 0,
             path: [0; 256],
             path_len: 0,
         };
@@ -771,17 +1001,16 @@ impl DirContext {
         ctx
     }
 
-    pub fn new_ext4(path: &str) -> Self {
-        let mut ctx = Self {
-            dir_type: DirType::Ext4,
-            offset: 0,
-            path: [0; 256],
-            path_len: 0,
-        };
-        let bytes = path.as_bytes();
-        let len = bytes.len().min(255);
-        ctx.path[..len].copy_from_slice(&bytes[..len]);
-        ctx.path_len = len;
+    pub fn new_ext4(path: &str, ino: u32) -> Self {
+        let mut ctx = Self::new_rootfs(path);
+        ctx.dir_type = DirType::Ext4;
+        ctx.ino = ino as u64;
+        ctx
+    }
+
+    pub fn new_tmpfs(path: &str) -> Self {
+        let mut ctx = Self::new_rootfs(path);
+        ctx.dir_type = DirType::Tmpfs;
         ctx
     }
 
@@ -799,6 +1028,11 @@ impl DirContext {
 /// # 返回
 /// 成功返回文件描述符，失败返回错误码
 pub fn file_opendir(pathname: &str, flags: u32) -> Result<usize, i32> {
+    // 0. tmpfs 挂载点下的目录
+    if let Some((tmpfs_sb, path)) = tmpfs::resolve(pathname) {
+        return tmpfs::opendir(tmpfs_sb, path, pathname, flags);
+    }
+
     unsafe {
         // 1. 首先尝试从 RootFS 查找
         let sb_ptr = get_rootfs();
@@ -836,10 +1070,8 @@ pub fn file_opendir(pathname: &str, flags: u32) -> Result<usize, i32> {
 
         // 2. RootFS 中未找到，尝试从 ext4 查找
         if ext4::is_mounted() {
-            // 检查目录是否存在
-            let entries = ext4::list_dir(pathname);
-
-            if let Some(_entries) = entries {
+            // 检查目录是否存在，只解析路径，不列出目录
+            if let Some(ino) = ext4::lookup_dir(pathname) {
                 // 创建 File 对象
                 let file_flags = FileFlags::new(flags);
                 let file = Arc::new(File::new(file_flags));
@@ -848,7 +1080,7 @@ pub fn file_opendir(pathname: &str, flags: u32) -> Result<usize, i32> {
                 file.set_ops(&EXT4_DIR_OPS);
 
                 // 创建目录上下文
-                let ctx = Box::new(DirContext::new_ext4(pathname));
+                let ctx = Box::new(DirContext::new_ext4(pathname, ino));
                 let ctx_ptr = Box::into_raw(ctx) as *mut u8;
                 file.set_private_data(ctx_ptr);
 
@@ -885,16 +1117,111 @@ pub const DT_LNK: u8 = 10;
 pub const DT_SOCK: u8 = 12;
 pub const DT_WHT: u8 = 14;
 
+/// 把 linux_dirent64 记录直接写入用户缓冲区 (struct getdents_callback64)
+///
+/// 每条记录在栈上组装后以 copy_to_user 写出，不经过内核中间缓冲区
+pub struct DirentWriter {
+    /// 用户缓冲区地址
+    addr: usize,
+    /// 缓冲区大小
+    count: usize,
+    /// 已写入的字节数
+    written: usize,
+    /// 有记录因缓冲区不足没有写入
+    overflow: bool,
+    /// 复制到用户空间失败
+    fault: bool,
+}
+
+impl DirentWriter {
+    pub fn new(addr: usize, count: usize) -> Self {
+        Self { addr, count, written: 0, overflow: false, fault: false }
+    }
+
+    /// 写入一条记录 (filldir64)
+    ///
+    /// # 参数
+    /// - `off`: 下一条记录的位置，用户以 lseek 回到这里继续读取
+    ///
+    /// # 返回
+    /// 缓冲区放不下或复制失败时返回 false，调用者停止遍历且不前移游标
+    pub fn emit(&mut self, ino: u64, off: u64, d_type: u8, name: &[u8]) -> bool {
+        let name_len = name.len().min(255);
+        let reclen = (19 + name_len + 1 + 7) & !7;
+        if self.written + reclen > self.count {
+            self.overflow = true;
+            return false;
+        }
+        let mut rec = [0u8; 19 + 256 + 8];
+        rec[0..8].copy_from_slice(&ino.to_le_bytes());
+        rec[8..16].copy_from_slice(&off.to_le_bytes());
+        rec[16..18].copy_from_slice(&(reclen as u16).to_le_bytes());
+        rec[18] = d_type;
+        rec[19..19 + name_len].copy_from_slice(&name[..name_len]);
+        if crate::arch::riscv64::uaccess::copy_to_user(self.addr + self.written, &rec[..reclen]) != 0 {
+            self.fault = true;
+            return false;
+        }
+        self.written += reclen;
+        true
+    }
+
+    /// 结束本次读取
+    ///
+    /// # 返回
+    /// 写入的字节数；一条都没写时，复制失败返回 EFAULT，第一条就放不下返回 EINVAL
+    pub fn finish(self) -> Result<usize, i32> {
+        if self.written == 0 && self.fault {
+            return Err(errno::Errno::BadAddress.as_neg_i32());
+        }
+        if self.written == 0 && self.overflow {
+            return Err(errno::Errno::InvalidArgument.as_neg_i32());
+        }
+        Ok(self.written)
+    }
+}
+
+/// ext4 目录项类型转换为 d_type
+fn ext4_d_type(file_type: u8) -> u8 {
+    match file_type {
+        1 => DT_REG,   // 常规文件
+        2 => DT_DIR,   // 目录
+        3 => DT_CHR,   // 字符设备
+        4 => DT_BLK,   // 块设备
+        5 => DT_FIFO,  // FIFO
+        6 => DT_SOCK,  // Socket
+        7 => DT_LNK,   // 符号链接
+        _ => DT_UNKNOWN,
+    }
+}
+
+/// 从 ext4 目录的游标处继续读取目录项 (ext4_readdir)
+///
+/// 游标是目录内的字节位置，只读入游标之后的块；放不下的那一项留给下一次
+fn ext4_getdents(ctx: &mut DirContext, out: &mut DirentWriter) -> Result<(), i32> {
+    let fs = match ext4::get_ext4_fs() {
+        Some(fs) => unsafe { &*fs },
+        None => return Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
+    };
+    let dir = fs.read_inode(ctx.ino as u32)?;
+    let mut pos = ctx.offset as u64;
+    let result = fs.readdir(&dir, &mut pos, |entry, next| {
+        out.emit(entry.inode as u64, next, ext4_d_type(entry.file_type), &entry.name[..entry.name_len as usize])
+    });
+    ctx.offset = pos as usize;
+    result
+}
+
 /// 读取目录项 (getdents64)
 ///
 /// # 参数
 /// - fd: 目录文件描述符
-/// - buf: 输出缓冲区
+/// - dirp: 用户缓冲区地址，记录直接写入
 /// - count: 缓冲区大小
 ///
 /// # 返回
 /// 成功返回读取的字节数，失败返回错误码
-pub fn file_getdents64(fd: usize, buf: &mut [u8], count: usize) -> Result<usize, i32> {
+pub fn file_getdents64(fd: usize, dirp: usize, count: usize) -> Result<usize, i32> {
     unsafe {
         // 获取文件对象
         let file = match get_file_fd(fd) {
@@ -910,6 +1237,7 @@ pub fn file_getdents64(fd: usize, buf: &mut [u8], count: usize) -> Result<usize,
         };
 
         let ctx = &mut *(ctx_ptr as *mut DirContext);
+        let mut out = DirentWriter::new(dirp, count);
 
         match ctx.dir_type {
             DirType::RootFS => {
@@ -930,37 +1258,7 @@ pub fn file_getdents64(fd: usize, buf: &mut [u8], count: usize) -> Result<usize,
                     return Err(errno::Errno::NotADirectory.as_neg_i32());
                 }
 
-                let start_pos = ctx.offset;
-                let children = node.list_children();
-
-                let mut bytes_written = 0usize;
-                let mut current_idx = 0usize;
-
-                for child in children.iter().skip(start_pos) {
-                    let child_ref = child.as_ref();
-                    let name = &child_ref.name;
-                    let name_len = name.len();
-
-                    let dirent_size = (19 + name_len + 1 + 7) & !7;
-
-                    if bytes_written + dirent_size > count {
-                        break;
-                    }
-
-                    let buf_offset = bytes_written;
-
-                    // d_ino
-                    let d_ino = child_ref.ino;
-                    buf[buf_offset..buf_offset + 8].copy_from_slice(&d_ino.to_le_bytes());
-
-                    // d_off
-                    let d_off = (bytes_written + dirent_size) as u64;
-                    buf[buf_offset + 8..buf_offset + 16].copy_from_slice(&d_off.to_le_bytes());
-
-                    // d_reclen
-                    buf[buf_offset + 16..buf_offset + 18].copy_from_slice(&(dirent_size as u16).to_le_bytes());
-
-                    // d_type
+                node.for_each_child(ctx.offset, |child_ref| {
                     let d_type = if child_ref.is_dir() {
                         DT_DIR
                     } else if child_ref.is_file() {
@@ -970,87 +1268,42 @@ pub fn file_getdents64(fd: usize, buf: &mut [u8], count: usize) -> Result<usize,
                     } else {
                         DT_UNKNOWN
                     };
-                    buf[buf_offset + 18] = d_type;
-
-                    // d_name
-                    buf[buf_offset + 19..buf_offset + 19 + name_len].copy_from_slice(name);
-                    buf[buf_offset + 19 + name_len] = 0;
-
-                    bytes_written += dirent_size;
-                    current_idx += 1;
-                }
-
-                ctx.offset = start_pos + current_idx;
-                Ok(bytes_written)
+                    if !out.emit(child_ref.ino, ctx.offset as u64 + 1, d_type, &child_ref.name) {
+                        return false;
+                    }
+                    ctx.offset += 1;
+                    true
+                });
             }
             DirType::Ext4 => {
-                // ext4 目录读取
-                let path = ctx.get_path();
-                let start_pos = ctx.offset;
-
-                // 获取目录项列表
-                let entries = match ext4::list_dir(path) {
+                if let Err(e) = ext4_getdents(ctx, &mut out) {
+                    // 出错前已写入的记录照常返回
+                    if out.written == 0 {
+                        return Err(e);
+                    }
+                }
+            }
+            DirType::Tmpfs => {
+                // tmpfs 目录读取 - 按路径重新找到实例与目录
+                let (tmpfs_sb, path) = match tmpfs::resolve(ctx.get_path()) {
+                    Some(r) => r,
+                    None => return Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
+                };
+                let entries = match tmpfs_sb.list_dir(path) {
                     Some(e) => e,
                     None => return Err(errno::Errno::NoSuchFileOrDirectory.as_neg_i32()),
                 };
 
-                let mut bytes_written = 0usize;
-                let mut current_idx = 0usize;
-
-                // 遍历目录项，从 start_pos 开始
-                for entry in entries.iter().skip(start_pos) {
-                    let name_bytes = &entry.name[..entry.name_len as usize];
-                    let name_len = name_bytes.len();
-
-                    // 计算这个 dirent 的大小
-                    let dirent_size = (19 + name_len + 1 + 7) & !7;
-
-                    // 检查缓冲区是否足够
-                    if bytes_written + dirent_size > count {
+                for (name, ino, is_dir) in entries.iter().skip(ctx.offset) {
+                    let d_type = if *is_dir { DT_DIR } else { DT_REG };
+                    if !out.emit(*ino, ctx.offset as u64 + 1, d_type, name) {
                         break;
                     }
-
-                    // 填充 dirent64 结构
-                    let buf_offset = bytes_written;
-
-                    // d_ino
-                    let d_ino = entry.inode as u64;
-                    buf[buf_offset..buf_offset + 8].copy_from_slice(&d_ino.to_le_bytes());
-
-                    // d_off
-                    let d_off = (bytes_written + dirent_size) as u64;
-                    buf[buf_offset + 8..buf_offset + 16].copy_from_slice(&d_off.to_le_bytes());
-
-                    // d_reclen
-                    buf[buf_offset + 16..buf_offset + 18].copy_from_slice(&(dirent_size as u16).to_le_bytes());
-
-                    // d_type - ext4 文件类型映射
-                    let d_type = match entry.file_type {
-                        1 => DT_REG,   // 常规文件
-                        2 => DT_DIR,   // 目录
-                        3 => DT_CHR,   // 字符设备
-                        4 => DT_BLK,   // 块设备
-                        5 => DT_FIFO,  // FIFO
-                        6 => DT_SOCK,  // Socket
-                        7 => DT_LNK,   // 符号链接
-                        _ => DT_UNKNOWN,
-                    };
-                    buf[buf_offset + 18] = d_type;
-
-                    // d_name (以 null 结尾)
-                    buf[buf_offset + 19..buf_offset + 19 + name_len].copy_from_slice(name_bytes);
-                    buf[buf_offset + 19 + name_len] = 0;
-
-                    bytes_written += dirent_size;
-                    current_idx += 1;
+                    ctx.offset += 1;
                 }
-
-                // 更新偏移
-                ctx.offset = start_pos + current_idx;
-
-                Ok(bytes_written)
             }
         }
+        out.finish()
     }
 }
 
@@ -1076,16 +1329,11 @@ fn rootfs_dir_read(file: &File, buf: &mut [u8]) -> isize {
         // 获取当前读取位置
         let start_pos = file.get_pos() as usize;
 
-        // 获取子节点列表
-        let children = node.list_children();
-
         let mut bytes_written = 0usize;
         let mut current_idx = 0usize;
 
-        // 遍历子节点，从 start_pos 开始
-        for child in children.iter().skip(start_pos) {
-            let child_ref = child.as_ref();
-
+        // 在读锁下遍历子节点，从 start_pos 开始
+        node.for_each_child(start_pos, |child_ref| {
             // 获取文件名
             let name = &child_ref.name;
             let name_len = name.len();
@@ -1098,7 +1346,7 @@ fn rootfs_dir_read(file: &File, buf: &mut [u8]) -> isize {
 
             // 检查缓冲区是否足够
             if bytes_written + dirent_size > buf.len() {
-                break;
+                return false;
             }
 
             // 填充 dirent64 结构
@@ -1133,7 +1381,8 @@ fn rootfs_dir_read(file: &File, buf: &mut [u8]) -> isize {
 
             bytes_written += dirent_size;
             current_idx += 1;
-        }
+            true
+        });
 
         // 更新文件位置
         file.set_pos((start_pos + current_idx) as u64);
@@ -1148,9 +1397,14 @@ static ROOTFS_DIR_OPS: FileOps = FileOps {
     write: None,
     lseek: Some(rootfs_file_lseek),
     close: Some(rootfs_file_close),
+    read_iter: None,
+    write_iter: None,
+    poll: None,
 };
 
 /// ext4 目录读取操作
+///
+/// 与 getdents64 相同，buf 就是用户缓冲区，记录直接写入
 fn ext4_dir_read(file: &File, buf: &mut [u8]) -> isize {
     unsafe {
         // 从 private_data 获取目录上下文
@@ -1168,83 +1422,240 @@ fn ext4_dir_read(file: &File, buf: &mut [u8]) -> isize {
             return -22;  // EINVAL
         }
 
-        let path = ctx.get_path();
-        let start_pos = ctx.offset;
-
-        // 获取目录项列表
-        let entries = match ext4::list_dir(path) {
-            Some(e) => e,
-            None => return -2,  // ENOENT
-        };
-
-        let mut bytes_written = 0usize;
-        let mut current_idx = 0usize;
-
-        // 遍历目录项
-        for entry in entries.iter().skip(start_pos) {
-            let name_bytes = &entry.name[..entry.name_len as usize];
-            let name_len = name_bytes.len();
+        let mut out = DirentWriter::new(buf.as_mut_ptr() as usize, buf.len());
+        if let Err(e) = ext4_getdents(ctx, &mut out) {
+            if out.written == 0 {
+                return e as isize;
+            }
+        }
+        match out.finish() {
+            Ok(n) => n as isize,
+            Err(e) => e as isize,
+        }
+    }
+}
 
-            // 计算这个 dirent 的大小
-            let dirent_size = (19 + name_len + 1 + 7) & !7;
+/// ext4 目录定位操作 (ext4_dir_llseek)
+///
+/// 位置是 getdents64 返回的 d_off，即目录内的字节位置；SEEK_SET 0 回到目录开头
+fn ext4_dir_lseek(file: &File, offset: isize, whence: i32) -> isize {
+    let ctx = match unsafe { *file.private_data.get() } {
+        Some(ptr) => unsafe { &mut *(ptr as *mut DirContext) },
+        None => return -9,  // EBADF
+    };
+    let new_pos = match whence {
+        0 => offset,                        // SEEK_SET
+        1 => ctx.offset as isize + offset,  // SEEK_CUR
+        _ => return -22,                    // EINVAL
+    };
+    if new_pos < 0 {
+        return -22;  // EINVAL
+    }
+    ctx.offset = new_pos as usize;
+    new_pos
+}
 
-            // 检查缓冲区是否足够
-            if bytes_written + dirent_size > buf.len() {
-                break;
-            }
+/// ext4 目录关闭操作
+fn ext4_dir_close(_file: &File) -> i32 {
+    // 不需要特殊清理，DirContext 会在文件关闭时自动释放
+    0
+}
 
-            // 填充 dirent64 结构
-            let buf_offset = bytes_written;
+/// ext4 目录操作表
+static EXT4_DIR_OPS: FileOps = FileOps {
+    read: Some(ext4_dir_read),
+    write: None,
+    lseek: Some(ext4_dir_lseek),
+    close: Some(ext4_dir_close),
+    read_iter: None,
+    write_iter: None,
+    poll: None,
+};
 
-            // d_ino
-            let d_ino = entry.inode as u64;
-            buf[buf_offset..buf_offset + 8].copy_from_slice(&d_ino.to_le_bytes());
+/// 文件所在的 ext4 文件系统 (file_inode(file)->i_sb)
+///
+/// ext4 目录以 EXT4_DIR_OPS 打开、没有 inode；普通文件的 inode 私有数据指向文件系统
+pub fn file_ext4_fs(file: &File) -> Option<&'static ext4::Ext4FileSystem> {
+    let fs = ext4::get_ext4_fs()?;
+    let ops = unsafe { *file.ops.get() };
+    if ops.map_or(false, |ops| core::ptr::eq(ops, &EXT4_DIR_OPS)) {
+        return Some(unsafe { &*fs });
+    }
+    let inode = unsafe { (*file.inode.get()).as_ref()? };
+    match inode.private_data {
+        Some(ptr) if ptr == fs as *mut u8 => Some(unsafe { &*fs }),
+        _ => None,
+    }
+}
 
-            // d_off
-            let d_off = (bytes_written + dirent_size) as u64;
-            buf[buf_offset + 8..buf_offset + 16].copy_from_slice(&d_off.to_le_bytes());
+/// 打开 ext4 上的普通文件 (ext4_file_open)
+///
+/// 文件以 inode 缓存中的 inode 作为 f_inode，读写时从中取出 ext4 inode
+///
+/// # 返回
+/// 没有挂载 ext4 或路径不是 ext4 上的普通文件时返回 None
+fn ext4_file_open(filename: &str, flags: u32) -> Option<Result<usize, i32>> {
+    let fs = unsafe { &*ext4::get_ext4_fs()? };
+    let (ino, ei) = fs.lookup_path(filename).ok()?;
+    if !ei.is_reg() {
+        return None;
+    }
+    // lookup_path 读入 inode 时已加入 inode 缓存
+    let inode = crate::fs::inode::ilookup(fs.s_dev, ino as u64)?;
 
-            // d_reclen
-            buf[buf_offset + 16..buf_offset + 18].copy_from_slice(&(dirent_size as u16).to_le_bytes());
+    let file = Arc::new(File::new(FileFlags::new(flags)));
+    file.set_ops(&EXT4_FILE_OPS);
+    file.set_inode(inode);
+    Some(get_file_fd_install(file).ok_or(errno::Errno::TooManyOpenFiles.as_neg_i32()))
+}
 
-            // d_type
-            let d_type = match entry.file_type {
-                1 => DT_REG,
-                2 => DT_DIR,
-                3 => DT_CHR,
-                4 => DT_BLK,
-                5 => DT_FIFO,
-                6 => DT_SOCK,
-                7 => DT_LNK,
-                _ => DT_UNKNOWN,
-            };
-            buf[buf_offset + 18] = d_type;
+/// 打开的 ext4 普通文件所在的文件系统与当前的 ext4 inode
+fn ext4_file_inode(file: &File) -> Option<(&'static ext4::Ext4FileSystem, ext4::inode::Ext4Inode)> {
+    let fs = file_ext4_fs(file)?;
+    let ino = unsafe { (*file.inode.get()).as_ref()? }.ino;
+    fs.read_inode(ino as u32).ok().map(|ei| (fs, ei))
+}
 
-            // d_name
-            buf[buf_offset + 19..buf_offset + 19 + name_len].copy_from_slice(name_bytes);
-            buf[buf_offset + 19 + name_len] = 0;
+/// 是否以 O_DIRECT 打开
+fn is_direct(file: &File) -> bool {
+    file.flags.bits() & FileFlags::O_DIRECT != 0
+}
 
-            bytes_written += dirent_size;
-            current_idx += 1;
+/// ext4 文件读取操作 (ext4_file_read_iter)
+///
+/// O_DIRECT 打开时固定用户缓冲区，由设备直接读入；否则经页缓存并按 f_ra 预读
+fn ext4_file_read_op(file: &File, buf: &mut [u8]) -> isize {
+    let (fs, ei) = match ext4_file_inode(file) {
+        Some(inode) => inode,
+        None => return -9,  // EBADF
+    };
+    let offset = file.get_pos();
+    let result = if is_direct(file) {
+        // buf 就是用户缓冲区
+        ext4::file::ext4_dio_read(fs, &ei, offset, buf.as_mut_ptr() as usize, buf.len())
+    } else {
+        ext4::file::ext4_file_read_ra(fs, &ei, offset, buf, &mut file.ra.lock())
+    };
+    match result {
+        Ok(read) => {
+            file.set_pos(offset + read as u64);
+            read as isize
         }
+        Err(e) => e as isize,
+    }
+}
 
-        // 更新偏移
-        ctx.offset = start_pos + current_idx;
+/// ext4 文件写入操作 (ext4_file_write_iter)
+///
+/// O_APPEND 从文件末尾写；写入后更新 inode 缓存中的大小
+fn ext4_file_write_op(file: &File, buf: &[u8]) -> isize {
+    let (fs, mut ei) = match ext4_file_inode(file) {
+        Some(inode) => inode,
+        None => return -9,  // EBADF
+    };
+    let offset = if file.flags.bits() & FileFlags::O_APPEND != 0 {
+        ext4::file::ext4_mapping(fs, &ei).size() as u64
+    } else {
+        file.get_pos()
+    };
+    let result = if is_direct(file) {
+        ext4::file::ext4_dio_write(fs, &mut ei, offset, buf.as_ptr() as usize, buf.len())
+    } else {
+        ext4::file::ext4_file_write(fs, &mut ei, offset, buf)
+    };
+    match result.and_then(|written| fs.write_inode(&ei).map(|()| written)) {
+        Ok(written) => {
+            file.set_pos(offset + written as u64);
+            written as isize
+        }
+        Err(e) => e as isize,
+    }
+}
 
-        bytes_written as isize
+/// ext4 文件定位操作 (ext4_llseek)
+fn ext4_file_lseek_op(file: &File, offset: isize, whence: i32) -> isize {
+    let size = match ext4_file_inode(file) {
+        Some((fs, ei)) => ext4::file::ext4_mapping(fs, &ei).size() as isize,
+        None => return -9,  // EBADF
+    };
+    let new_pos = match whence {
+        0 => offset,                           // SEEK_SET
+        1 => file.get_pos() as isize + offset, // SEEK_CUR
+        2 => size + offset,                    // SEEK_END
+        _ => return -22,                       // EINVAL
+    };
+    if new_pos < 0 {
+        return -22;  // EINVAL
     }
+    file.set_pos(new_pos as u64);
+    new_pos
 }
 
-/// ext4 目录关闭操作
-fn ext4_dir_close(_file: &File) -> i32 {
-    // 不需要特殊清理，DirContext 会在文件关闭时自动释放
+/// ext4 文件关闭操作
+///
+/// 脏页留给回写线程，f_inode 随 File 释放
+fn ext4_file_close(_file: &File) -> i32 {
     0
 }
 
-/// ext4 目录操作表
-static EXT4_DIR_OPS: FileOps = FileOps {
-    read: Some(ext4_dir_read),
-    write: None,
-    lseek: None,  // ext4 目录不支持 lseek
-    close: Some(ext4_dir_close),
+/// ext4 普通文件操作表 (ext4_file_operations)
+static EXT4_FILE_OPS: FileOps = FileOps {
+    read: Some(ext4_file_read_op),
+    write: Some(ext4_file_write_op),
+    lseek: Some(ext4_file_lseek_op),
+    close: Some(ext4_file_close),
+    read_iter: None,
+    write_iter: None,
+    poll: None,
 };
+
+/// 填充 ext4 普通文件的 stat (ext4_getattr)
+///
+/// # 返回
+/// 不是 ext4 普通文件时返回 None
+fn ext4_file_stat(file: &File, stat: &mut Stat) -> Option<()> {
+    if !unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &EXT4_FILE_OPS)) {
+        return None;
+    }
+    let (fs, ei) = ext4_file_inode(file)?;
+    ext4_fill_stat(fs, &ei, STATX_BASIC_STATS, stat);
+    Some(())
+}
+
+/// 由 ext4 inode 填充 stat (ext4_getattr)
+///
+/// 普通文件的大小可能只在内存中的 inode 里（延迟写），mask 含 STATX_SIZE 时才去查找，
+/// 否则返回的掩码不含 STATX_SIZE；其余字段都来自调用者的 inode
+///
+/// # 返回
+/// 实际填充的字段
+fn ext4_fill_stat(fs: &ext4::Ext4FileSystem, ei: &ext4::inode::Ext4Inode, mask: u32, stat: &mut Stat) -> u32 {
+    let size = if mask & STATX_SIZE != 0 && ei.is_reg() {
+        ext4::file::ext4_file_size(fs, ei)
+    } else {
+        ei.size
+    };
+    stat.st_dev = fs.s_dev;
+    stat.st_ino = ei.ino as u64;
+    stat.st_nlink = ei.links_count as u32;
+    stat.st_uid = ei.uid as u32;
+    stat.st_gid = ei.gid as u32;
+    stat.st_rdev = 0;
+    stat.st_size = size as i64;
+    stat.st_blocks = ei.blocks;
+    stat.st_blksize = fs.block_size as u64;
+    // i_mode 已含文件类型
+    stat.st_mode = ei.mode as u32;
+    stat.st_atime = ei.atime as u64;
+    stat.st_atime_nsec = 0;
+    stat.st_mtime = ei.mtime as u64;
+    stat.st_mtime_nsec = 0;
+    stat.st_ctime = ei.ctime as u64;
+    stat.st_ctime_nsec = 0;
+    if ei.is_reg() && mask & STATX_SIZE == 0 {
+        // 大小取自磁盘 inode，可能落后于延迟写
+        STATX_BASIC_STATS & !STATX_SIZE
+    } else {
+        STATX_BASIC_STATS
+    }
+}
@@ -21,9 +21,8 @@ use crate::sched;
 use crate::process::task::{Task, SchedPolicy};
 use crate::println;
 use crate::cmdline;
-use alloc::vec::Vec;
+use alloc::borrow::Cow;
 use alloc::sync::Arc;
-use alloc::boxed::Box;
 use core::slice;
 
 // 静态存储：init 进程和用户上下文
@@ -64,19 +63,19 @@ pub fn init() {
 /// - `path`: init 程序路径
 ///
 /// # 返回
-/// - `Some(data)`: 程序数据
+/// - `Some(data)`: 程序数据，来自 initramfs 时直接借用归档中的数据
 /// - `None`: 加载失败
 ///
 /// # 加载顺序
 /// 1. 尝试从 PCI VirtIO 块设备的 ext4 文件系统读取
 /// 2. 尝试从 MMIO VirtIO 块设备的 ext4 文件系统读取
-/// 3. 尝试从 RootFS（内存文件系统）读取
-fn load_init_program(path: &str) -> Option<Vec<u8>> {
+/// 3. 尝试从 RootFS（内存文件系统，含 initramfs）读取
+fn load_init_program(path: &str) -> Option<Cow<'static, [u8]>> {
     // 1. 首先尝试从 PCI VirtIO 块设备的 ext4 文件系统读取
     if let Some(disk) = crate::drivers::virtio::get_pci_gen_disk() {
         match crate::fs::ext4::read_file(disk as *const _, path) {
             Some(data) => {
-                return Some(data);
+                return Some(Cow::Owned(data));
             }
             None => {}
         }
@@ -88,7 +87,7 @@ fn load_init_program(path: &str) -> Option<Vec<u8>> {
 
         match crate::fs::ext4::read_file(disk_ptr, path) {
             Some(data) => {
-                return Some(data);
+                return Some(Cow::Owned(data));
             }
             None => {}
         }
@@ -111,16 +110,17 @@ fn create_and_start_init_process(program_data: &[u8]) -> Option<*mut Task> {
 
         // 创建 init 任务，PID 固定为 1
         Task::new_task_at(task_ptr, 1, SchedPolicy::Normal);
+        (*task_ptr).set_comm(b"init");
 
         // 设置父进程为 0（没有父进程）
         (*task_ptr).set_parent(core::ptr::null_mut());
 
         // 创建并初始化文件描述符表
-        let fdtable = Box::new(FdTable::new());
+        let fdtable = Arc::new(FdTable::new());
         (*task_ptr).set_fdtable(Some(fdtable));
 
         // 初始化标准文件描述符
-        if let Some(fdtable) = (*task_ptr).try_fdtable_mut() {
+        if let Some(fdtable) = (*task_ptr).try_fdtable() {
             init_std_fds_for_task(fdtable);
         } else {
             return None;
@@ -379,7 +379,7 @@ fn load_and_setup_elf(task_ptr: *mut Task, program_data: &[u8]) -> Result<(), El
 
         // AT_HWCAP
         core::ptr::write_volatile(stack_ptr.offset(offset), AT_HWCAP);
-        core::ptr::write_volatile(stack_ptr.offset(offset + 1), 0u64);
+        core::ptr::write_volatile(stack_ptr.offset(offset + 1), crate::arch::riscv64::cpu::elf_hwcap());
         offset += 2;
 
         // AT_CLKTCK
@@ -0,0 +1,330 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 启动阶段计时与并行 initcall
+//!
+//! 参考 Linux: init/main.c (do_one_initcall, initcall_debug), kernel/async.c
+//!
+//! - 启动核用 `initcall()` 包装每个启动阶段，记录开始与结束的 rdtime；
+//!   启动结束后通过 /proc/boottime 导出，带 initcall_debug 启动参数时打印表格
+//! - 互不依赖的阶段（设备探测、ext4 挂载等）用 `async_schedule()` 交给次核并行执行，
+//!   可以声明必须先完成的任务；启动核在 `async_synchronize_full()` 等待全部完成，
+//!   等待期间自己也执行就绪的任务，所以单核或 initcall_sync 时退化为串行
+//! - 次核在 `async_open()` 前自旋，之后安装 trap 向量、切换到内核页表并领取任务，
+//!   `async_close()` 后回到空闲循环
+//!
+//! 记录槽位先用原子计数预留再写入，不加锁也不分配内存，堆初始化之前也可以记录
+
+use alloc::string::String;
+use alloc::vec::Vec;
+use core::cell::UnsafeCell;
+use core::fmt::Write;
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicU8, AtomicUsize, Ordering};
+
+use crate::drivers::timer::{read_time, CLOCK_FREQ};
+
+/// 最多记录的启动阶段数
+pub const MAX_INITCALLS: usize = 64;
+
+/// 最多排队的异步任务数（依赖用 u64 位图表示）
+pub const MAX_ASYNC_JOBS: usize = 32;
+
+/// 一个启动阶段的计时
+#[derive(Clone, Copy)]
+pub struct InitcallRecord {
+    pub name: &'static str,
+    pub cpu: u32,
+    /// 是否作为异步任务执行
+    pub is_async: bool,
+    pub ok: bool,
+    /// rdtime 计数
+    pub start: u64,
+    pub end: u64,
+}
+
+struct RecordSlot {
+    /// 写完后置位
+    valid: AtomicBool,
+    record: UnsafeCell<InitcallRecord>,
+}
+
+// 槽位由 NR_RECORDS 预留给唯一的写者，valid 置位后只读
+unsafe impl Sync for RecordSlot {}
+
+static RECORDS: [RecordSlot; MAX_INITCALLS] = [const {
+    RecordSlot {
+        valid: AtomicBool::new(false),
+        record: UnsafeCell::new(InitcallRecord { name: "", cpu: 0, is_async: false, ok: false, start: 0, end: 0 }),
+    }
+}; MAX_INITCALLS];
+
+static NR_RECORDS: AtomicUsize = AtomicUsize::new(0);
+
+/// 启动核进入 rust_main 的时间
+static BOOT_START: AtomicU64 = AtomicU64::new(0);
+
+/// init 进程加入调度器的时间，0 表示还在启动
+static BOOT_END: AtomicU64 = AtomicU64::new(0);
+
+const JOB_EMPTY: u8 = 0;
+const JOB_PENDING: u8 = 1;
+const JOB_RUNNING: u8 = 2;
+const JOB_DONE: u8 = 3;
+
+/// 异步任务的句柄，用于声明依赖与等待 (async_cookie_t)
+pub type AsyncCookie = usize;
+
+/// 没有排队、已经同步执行完的任务
+pub const ASYNC_COOKIE_DONE: AsyncCookie = usize::MAX;
+
+struct AsyncJob {
+    state: AtomicU8,
+    /// 必须先完成的任务位图
+    deps: AtomicU64,
+    name: UnsafeCell<&'static str>,
+    func: UnsafeCell<Option<fn() -> bool>>,
+}
+
+// name / func 在 state 变为 JOB_PENDING 之前写入，之后只读
+unsafe impl Sync for AsyncJob {}
+
+static JOBS: [AsyncJob; MAX_ASYNC_JOBS] = [const {
+    AsyncJob {
+        state: AtomicU8::new(JOB_EMPTY),
+        deps: AtomicU64::new(0),
+        name: UnsafeCell::new(""),
+        func: UnsafeCell::new(None),
+    }
+}; MAX_ASYNC_JOBS];
+
+static NR_JOBS: AtomicUsize = AtomicUsize::new(0);
+
+/// 次核可以开始领取任务
+static ASYNC_OPEN: AtomicBool = AtomicBool::new(false);
+
+/// 启动阶段结束，次核回到空闲循环
+static ASYNC_CLOSED: AtomicBool = AtomicBool::new(false);
+
+/// 领取过任务的次核数
+static ASYNC_WORKERS: AtomicUsize = AtomicUsize::new(0);
+
+/// rdtime 计数转换为微秒
+pub fn ticks_to_us(ticks: u64) -> u64 {
+    ticks * 1_000_000 / CLOCK_FREQ
+}
+
+fn record(name: &'static str, is_async: bool, ok: bool, start: u64, end: u64) {
+    let idx = NR_RECORDS.fetch_add(1, Ordering::Relaxed);
+    if idx >= MAX_INITCALLS {
+        return;
+    }
+    let slot = &RECORDS[idx];
+    unsafe {
+        *slot.record.get() = InitcallRecord { name, cpu: crate::arch::cpu_id() as u32, is_async, ok, start, end };
+    }
+    slot.valid.store(true, Ordering::Release);
+}
+
+/// 记录启动开始时间，启动核进入 rust_main 后最先调用
+pub fn boot_start() {
+    BOOT_START.store(read_time(), Ordering::Relaxed);
+}
+
+/// 在启动核上执行并计时一个启动阶段 (do_one_initcall)
+pub fn initcall<F: FnOnce() -> bool>(name: &'static str, f: F) -> bool {
+    let start = read_time();
+    let ok = f();
+    record(name, false, ok, start, read_time());
+    ok
+}
+
+/// 已写完的启动阶段记录，按开始时间排序
+pub fn records() -> Vec<InitcallRecord> {
+    let nr = NR_RECORDS.load(Ordering::Acquire).min(MAX_INITCALLS);
+    let mut out = Vec::with_capacity(nr);
+    for slot in &RECORDS[..nr] {
+        if slot.valid.load(Ordering::Acquire) {
+            out.push(unsafe { *slot.record.get() });
+        }
+    }
+    out.sort_by_key(|r| r.start);
+    out
+}
+
+/// 排队一个异步任务，after 中的任务完成后才会执行 (async_schedule)
+///
+/// 只在启动核上调用；队列已满时直接同步执行
+pub fn async_schedule(name: &'static str, func: fn() -> bool, after: &[AsyncCookie]) -> AsyncCookie {
+    let idx = NR_JOBS.load(Ordering::Relaxed);
+    if idx >= MAX_ASYNC_JOBS {
+        for &cookie in after {
+            async_synchronize_cookie(cookie);
+        }
+        initcall(name, func);
+        return ASYNC_COOKIE_DONE;
+    }
+    let mut deps = 0u64;
+    for &cookie in after {
+        if cookie < idx {
+            deps |= 1 << cookie;
+        }
+    }
+    let job = &JOBS[idx];
+    unsafe {
+        *job.name.get() = name;
+        *job.func.get() = Some(func);
+    }
+    job.deps.store(deps, Ordering::Relaxed);
+    job.state.store(JOB_PENDING, Ordering::Release);
+    NR_JOBS.store(idx + 1, Ordering::Release);
+    idx
+}
+
+fn deps_done(mut deps: u64) -> bool {
+    while deps != 0 {
+        let idx = deps.trailing_zeros() as usize;
+        if JOBS[idx].state.load(Ordering::Acquire) != JOB_DONE {
+            return false;
+        }
+        deps &= deps - 1;
+    }
+    true
+}
+
+/// 领取并执行一个依赖已满足的任务，没有可执行的任务时返回 false
+fn run_one() -> bool {
+    let nr = NR_JOBS.load(Ordering::Acquire);
+    for job in &JOBS[..nr] {
+        if job.state.load(Ordering::Acquire) != JOB_PENDING || !deps_done(job.deps.load(Ordering::Relaxed)) {
+            continue;
+        }
+        if job.state.compare_exchange(JOB_PENDING, JOB_RUNNING, Ordering::AcqRel, Ordering::Relaxed).is_err() {
+            continue;
+        }
+        let (name, func) = unsafe { (*job.name.get(), *job.func.get()) };
+        let start = read_time();
+        let ok = func.map_or(false, |f| f());
+        record(name, true, ok, start, read_time());
+        job.state.store(JOB_DONE, Ordering::Release);
+        return true;
+    }
+    false
+}
+
+/// 等待 cookie 对应的任务完成，等待期间执行其他就绪任务 (async_synchronize_cookie)
+pub fn async_synchronize_cookie(cookie: AsyncCookie) {
+    if cookie >= NR_JOBS.load(Ordering::Acquire) {
+        return;
+    }
+    while JOBS[cookie].state.load(Ordering::Acquire) != JOB_DONE {
+        if !run_one() {
+            core::hint::spin_loop();
+        }
+    }
+}
+
+/// 等待所有已排队的任务完成 (async_synchronize_full)
+pub fn async_synchronize_full() {
+    for cookie in 0..NR_JOBS.load(Ordering::Acquire) {
+        async_synchronize_cookie(cookie);
+    }
+}
+
+/// 允许次核领取任务；带 initcall_sync 启动参数时所有任务都在启动核上串行执行
+pub fn async_open() {
+    if !crate::cmdline::has_param("initcall_sync") {
+        ASYNC_OPEN.store(true, Ordering::Release);
+    }
+}
+
+/// 等待全部任务完成并让次核回到空闲循环
+pub fn async_close() {
+    async_synchronize_full();
+    ASYNC_CLOSED.store(true, Ordering::Release);
+}
+
+/// 领取过任务的次核数
+pub fn async_workers() -> usize {
+    ASYNC_WORKERS.load(Ordering::Relaxed)
+}
+
+/// 次核的启动工作循环，返回后进入空闲循环
+pub fn secondary_worker() {
+    while !ASYNC_OPEN.load(Ordering::Acquire) {
+        if ASYNC_CLOSED.load(Ordering::Acquire) {
+            return;
+        }
+        core::hint::spin_loop();
+    }
+
+    // 启动核的页表与 trap 向量已经就绪，任务中的缺页和设备访问与启动核一致
+    crate::arch::trap::init();
+    crate::arch::mm::init();
+    ASYNC_WORKERS.fetch_add(1, Ordering::Relaxed);
+
+    while !ASYNC_CLOSED.load(Ordering::Acquire) {
+        if !run_one() {
+            core::hint::spin_loop();
+        }
+    }
+}
+
+/// init 进程已加入调度器，记录启动结束时间
+pub fn boot_complete() {
+    BOOT_END.store(read_time(), Ordering::Relaxed);
+}
+
+/// 从进入 rust_main 到 init 进程加入调度器的微秒数，还在启动时为 None
+pub fn boot_duration_us() -> Option<u64> {
+    let end = BOOT_END.load(Ordering::Relaxed);
+    if end == 0 {
+        return None;
+    }
+    Some(ticks_to_us(end.saturating_sub(BOOT_START.load(Ordering::Relaxed))))
+}
+
+/// 启动阶段表格，/proc/boottime 与 initcall_debug 共用
+pub fn format_table() -> String {
+    let base = BOOT_START.load(Ordering::Relaxed);
+    let mut out = String::new();
+    let _ = writeln!(out, "{:<20} {:>3} {:>5} {:>10} {:>10} {:>3}", "initcall", "cpu", "async", "start_us", "dur_us", "ok");
+    for r in records() {
+        let _ = writeln!(
+            out,
+            "{:<20} {:>3} {:>5} {:>10} {:>10} {:>3}",
+            r.name,
+            r.cpu,
+            r.is_async as u8,
+            ticks_to_us(r.start.saturating_sub(base)),
+            ticks_to_us(r.end.saturating_sub(r.start)),
+            r.ok as u8
+        );
+    }
+    match boot_duration_us() {
+        Some(us) => {
+            let _ = writeln!(out, "total_us {}", us);
+        }
+        None => {
+            let _ = writeln!(out, "total_us -");
+        }
+    }
+    let _ = writeln!(out, "async_workers {}", async_workers());
+    out
+}
+
+/// 带 initcall_debug 启动参数时打印启动阶段表格
+pub fn print_table() {
+    if !crate::cmdline::has_param("initcall_debug") {
+        return;
+    }
+    for line in format_table().lines() {
+        crate::println!("initcall: {}", line);
+    }
+}
+
+/// 生成 /proc/boottime 内容
+pub fn generate_boottime() -> Vec<u8> {
+    format_table().into_bytes()
+}
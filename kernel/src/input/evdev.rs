@@ -0,0 +1,171 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! evdev 事件缓冲区
+//!
+//! 键盘、鼠标驱动通过 input_report 报告事件，转换为 struct input_event 序列
+//! 并以 EV_SYN/SYN_REPORT 结束一组，写入每个打开 /dev/input/event0 的客户端的
+//! 环形缓冲区，然后唤醒等待的读者；桌面空闲时阻塞在 read / poll 上，不再忙等。
+//!
+//! 参考: drivers/input/evdev.c, drivers/input/input.c
+//!
+//! # 设计
+//! - 每个打开的文件一个客户端，各自有缓冲区，多个读者互不影响
+//! - 缓冲区满时丢弃已有事件并写入 SYN_DROPPED，客户端据此重新同步状态
+//! - 驱动没有中断，有客户端时由每个 jiffy 的定时器从驱动拉取事件
+
+use alloc::collections::vec_deque::VecDeque;
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use spin::Mutex;
+
+use super::{
+    poll_event, InputEvent, RawInputEvent, BTN_LEFT, BTN_MIDDLE, BTN_RIGHT, EV_KEY, EV_REL, REL_X, REL_Y,
+};
+use crate::drivers::keyboard::ps2::KeyEvent;
+use crate::process::wait::WaitQueueHead;
+use crate::time::timer::{mod_timer, TimerList};
+
+pub const EV_SYN: u16 = 0x00;
+pub const SYN_REPORT: u16 = 0;
+pub const SYN_DROPPED: u16 = 3;
+
+/// 每个客户端缓冲的事件数 (EVDEV_BUF_PACKETS * 包大小)
+pub const EVDEV_BUFFER_SIZE: usize = 256;
+
+/// 一个打开的事件设备
+pub struct EvdevClient {
+    buffer: Mutex<VecDeque<RawInputEvent>>,
+}
+
+impl EvdevClient {
+    fn new() -> Self {
+        Self { buffer: Mutex::new(VecDeque::with_capacity(EVDEV_BUFFER_SIZE)) }
+    }
+
+    /// 缓冲区中是否有事件
+    pub fn has_events(&self) -> bool {
+        !self.buffer.lock().is_empty()
+    }
+
+    /// 取出最多 max 个事件
+    pub fn fetch(&self, max: usize) -> Vec<RawInputEvent> {
+        let mut buffer = self.buffer.lock();
+        let n = max.min(buffer.len());
+        buffer.drain(..n).collect()
+    }
+
+    /// 写入一个事件，缓冲区满时清空并写入 SYN_DROPPED (evdev_pass_values)
+    fn push(&self, event: RawInputEvent) {
+        let mut buffer = self.buffer.lock();
+        if buffer.len() >= EVDEV_BUFFER_SIZE - 1 {
+            buffer.clear();
+            buffer.push_back(RawInputEvent { type_: EV_SYN, code: SYN_DROPPED, value: 0, ..event });
+        }
+        buffer.push_back(event);
+    }
+}
+
+/// 所有打开的客户端
+static CLIENTS: Mutex<Vec<Arc<EvdevClient>>> = Mutex::new(Vec::new());
+
+/// 等待事件的读者与 poll 登记
+pub static EVDEV_WQ: WaitQueueHead = WaitQueueHead::new();
+
+/// 鼠标上一次报告的按键状态，按键事件只报告变化的键
+static MOUSE_BUTTONS: Mutex<(bool, bool, bool)> = Mutex::new((false, false, false));
+
+/// 从驱动拉取事件的定时器
+static EVDEV_POLL_TIMER: TimerList = TimerList::new(evdev_poll_timer, 0);
+
+/// 打开事件设备，创建客户端 (evdev_open)
+pub fn evdev_attach() -> Arc<EvdevClient> {
+    let client = Arc::new(EvdevClient::new());
+    let first = {
+        let mut clients = CLIENTS.lock();
+        clients.push(client.clone());
+        clients.len() == 1
+    };
+    if first {
+        mod_timer(&EVDEV_POLL_TIMER, crate::drivers::timer::get_jiffies() + 1);
+    }
+    client
+}
+
+/// 关闭事件设备 (evdev_release)
+pub fn evdev_detach(client: &Arc<EvdevClient>) {
+    CLIENTS.lock().retain(|c| !Arc::ptr_eq(c, client));
+}
+
+/// 当前客户端数
+pub fn nr_clients() -> usize {
+    CLIENTS.lock().len()
+}
+
+/// 把一组事件写入所有客户端并以 SYN_REPORT 结束，然后唤醒读者 (input_event + input_sync)
+fn input_pass_values(values: &[(u16, u16, i32)]) {
+    let ns = crate::time::ktime_get();
+    let stamp = |type_: u16, code: u16, value: i32| RawInputEvent {
+        tv_sec: ns / 1_000_000_000,
+        tv_usec: ns % 1_000_000_000 / 1000,
+        type_,
+        code,
+        value,
+    };
+    let clients = CLIENTS.lock();
+    if clients.is_empty() {
+        return;
+    }
+    for client in clients.iter() {
+        for &(type_, code, value) in values {
+            client.push(stamp(type_, code, value));
+        }
+        client.push(stamp(EV_SYN, SYN_REPORT, 0));
+    }
+    drop(clients);
+    EVDEV_WQ.wake_up_all();
+}
+
+/// 驱动报告一个输入事件
+pub fn input_report(event: InputEvent) {
+    match event {
+        InputEvent::Keyboard(KeyEvent::Press(code)) => input_pass_values(&[(EV_KEY, code, 1)]),
+        InputEvent::Keyboard(KeyEvent::Release(code)) => input_pass_values(&[(EV_KEY, code, 0)]),
+        InputEvent::MouseMove { dx, dy } => {
+            let mut values = Vec::with_capacity(2);
+            if dx != 0 {
+                values.push((EV_REL, REL_X, dx as i32));
+            }
+            if dy != 0 {
+                values.push((EV_REL, REL_Y, dy as i32));
+            }
+            if !values.is_empty() {
+                input_pass_values(&values);
+            }
+        }
+        InputEvent::MouseButton { left, right, middle } => {
+            let mut last = MOUSE_BUTTONS.lock();
+            let mut values = Vec::with_capacity(3);
+            for (code, old, new) in [(BTN_LEFT, last.0, left), (BTN_RIGHT, last.1, right), (BTN_MIDDLE, last.2, middle)] {
+                if old != new {
+                    values.push((EV_KEY, code, new as i32));
+                }
+            }
+            *last = (left, right, middle);
+            drop(last);
+            if !values.is_empty() {
+                input_pass_values(&values);
+            }
+        }
+    }
+}
+
+fn evdev_poll_timer(timer: &TimerList) {
+    while let Some(event) = poll_event() {
+        input_report(event);
+    }
+    if nr_clients() > 0 {
+        mod_timer(timer, crate::drivers::timer::get_jiffies() + 1);
+    }
+}
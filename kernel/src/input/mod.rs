@@ -2,6 +2,8 @@
 //!
 //! 提供统一的输入事件接口
 
+pub mod evdev;
+
 use crate::println;
 use crate::drivers::keyboard::ps2::{KeyEvent, KEYBOARD};
 use crate::drivers::mouse::ps2::{MouseEvent, MOUSE};
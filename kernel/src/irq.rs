@@ -0,0 +1,326 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 中断描述符与中断亲和性 (irqdesc)
+//!
+//! 每条 PLIC 中断线有一个描述符，记录硬中断处理函数、下半部和亲和性掩码。
+//! 设备驱动用 request_irq / request_threaded_irq 注册，陷入处理 claim 到中断后
+//! 调用 handle_irq 分发。
+//!
+//! 亲和性决定中断在哪些 hart 的 S 态上下文中使能 (irq_set_affinity)，下半部也就
+//! 在这些 hart 上执行：线程化的中断由硬中断处理函数应答设备后返回
+//! IrqReturn::WakeThread，下半部作为开中断的软中断在 irq_exit 中运行。
+//! 网络与块设备的完成处理可以分别放到不同的 hart 上。
+//!
+//! 只有已经打开中断的 CPU (ipi_ready_mask) 才能作为目标，不包含这类 CPU 的掩码被拒绝。
+//!
+//! /proc/irq/N/smp_affinity 以十六进制 CPU 掩码读写亲和性，
+//! /proc/interrupts 列出各中断在每个 CPU 上的次数。
+//!
+//! 参考: kernel/irq/manage.c, kernel/irq/irqdesc.c, kernel/irq/proc.c
+
+use alloc::string::String;
+use alloc::vec::Vec;
+use core::fmt::Write;
+use core::sync::atomic::{AtomicU64, Ordering};
+
+use crate::config::MAX_CPUS;
+use crate::drivers::intc::plic::{self, MAX_INTERRUPTS};
+use crate::errno::Errno;
+use crate::sync::RwLock;
+
+/// 硬中断处理函数的返回值 (irqreturn_t)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum IrqReturn {
+    /// 不是本设备的中断 (IRQ_NONE)
+    None,
+    /// 已处理完 (IRQ_HANDLED)
+    Handled,
+    /// 已应答设备，其余工作交给下半部 (IRQ_WAKE_THREAD)
+    WakeThread,
+}
+
+/// 硬中断处理函数 (irq_handler_t)，参数为中断号
+pub type IrqHandler = fn(usize) -> IrqReturn;
+
+/// 所有 CPU 的掩码 (irq_default_affinity)
+pub const IRQ_DEFAULT_AFFINITY: usize = (1 << MAX_CPUS) - 1;
+
+/// 中断描述符 (irq_desc)
+#[derive(Clone, Copy)]
+struct IrqDesc {
+    /// 硬中断处理函数，None 表示未注册
+    handler: Option<IrqHandler>,
+    /// 下半部所在的软中断号
+    thread_softirq: Option<usize>,
+    /// 设备名，显示在 /proc/interrupts 中
+    name: &'static str,
+    /// 亲和性掩码 (irq_common_data.affinity)
+    affinity: usize,
+}
+
+impl IrqDesc {
+    const EMPTY: Self = Self {
+        handler: None,
+        thread_softirq: None,
+        name: "",
+        affinity: IRQ_DEFAULT_AFFINITY,
+    };
+}
+
+/// 中断描述符表 (irq_desc[])
+///
+/// 硬中断中只读；修改时先关中断，避免本 CPU 的硬中断等待自己持有的写锁
+static IRQ_DESC: RwLock<[IrqDesc; MAX_INTERRUPTS]> = RwLock::new([IrqDesc::EMPTY; MAX_INTERRUPTS]);
+
+/// 各中断在每个 CPU 上的次数 (kstat_irqs)
+static KSTAT_IRQS: [[AtomicU64; MAX_CPUS]; MAX_INTERRUPTS] =
+    [const { [const { AtomicU64::new(0) }; MAX_CPUS] }; MAX_INTERRUPTS];
+
+/// 没有处理函数认领的中断数 (irq_err_count / spurious)
+static SPURIOUS_IRQS: AtomicU64 = AtomicU64::new(0);
+
+/// 可以接收中断的 CPU
+///
+/// 打开了中断的 CPU，加上当前 CPU（启动早期 IPI 尚未初始化）
+fn irq_online_mask() -> usize {
+    crate::arch::riscv64::ipi::ipi_ready_mask() | (1 << crate::arch::cpu_id())
+}
+
+/// 按亲和性在 PLIC 各 hart 的上下文中打开或关闭中断 (irq_do_set_affinity)
+fn plic_set_affinity(irq: usize, effective: usize) {
+    for hart in 0..MAX_CPUS {
+        if effective & (1 << hart) != 0 {
+            plic::enable_interrupt(hart, irq);
+        } else {
+            plic::disable_interrupt(hart, irq);
+        }
+    }
+}
+
+/// 修改描述符表，期间关中断
+fn with_desc_mut<R>(f: impl FnOnce(&mut [IrqDesc; MAX_INTERRUPTS]) -> R) -> R {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let mut descs = IRQ_DESC.write();
+    f(&mut descs)
+}
+
+/// 注册线程化的中断 (request_threaded_irq)
+///
+/// # 参数
+/// - `irq`: PLIC 中断号
+/// - `handler`: 硬中断处理函数，返回 WakeThread 时执行下半部
+/// - `thread_softirq`: 下半部所在的软中断号，由调用方用 open_softirq_threaded 注册
+/// - `name`: 设备名
+///
+/// # 返回
+/// 中断号无效返回 -EINVAL，已被注册返回 -EBUSY
+pub fn request_threaded_irq(
+    irq: usize,
+    handler: IrqHandler,
+    thread_softirq: Option<usize>,
+    name: &'static str,
+) -> Result<(), i32> {
+    if irq == 0 || irq >= MAX_INTERRUPTS {
+        return Err(Errno::InvalidArgument.as_neg_i32());
+    }
+    let affinity = with_desc_mut(|descs| {
+        let desc = &mut descs[irq];
+        if desc.handler.is_some() {
+            return Err(Errno::DeviceOrResourceBusy.as_neg_i32());
+        }
+        desc.handler = Some(handler);
+        desc.thread_softirq = thread_softirq;
+        desc.name = name;
+        Ok(desc.affinity)
+    })?;
+    plic_set_affinity(irq, affinity & irq_online_mask());
+    crate::fs::procfs::register_irq_proc(irq);
+    Ok(())
+}
+
+/// 注册中断，处理全部在硬中断中完成 (request_irq)
+pub fn request_irq(irq: usize, handler: IrqHandler, name: &'static str) -> Result<(), i32> {
+    request_threaded_irq(irq, handler, None, name)
+}
+
+/// 注销中断并在所有 hart 上关闭 (free_irq)
+pub fn free_irq(irq: usize) {
+    if irq == 0 || irq >= MAX_INTERRUPTS {
+        return;
+    }
+    plic_set_affinity(irq, 0);
+    with_desc_mut(|descs| {
+        descs[irq].handler = None;
+        descs[irq].thread_softirq = None;
+    });
+}
+
+/// 设置中断亲和性 (irq_set_affinity)
+///
+/// 中断只在掩码中可以接收中断的 CPU 上使能，硬中断与下半部都在这些 CPU 上执行
+///
+/// # 返回
+/// 中断号无效，或掩码中没有可以接收中断的 CPU 时返回 -EINVAL
+pub fn irq_set_affinity(irq: usize, mask: usize) -> Result<(), i32> {
+    if irq == 0 || irq >= MAX_INTERRUPTS {
+        return Err(Errno::InvalidArgument.as_neg_i32());
+    }
+    let mask = mask & IRQ_DEFAULT_AFFINITY;
+    let effective = mask & irq_online_mask();
+    if effective == 0 {
+        return Err(Errno::InvalidArgument.as_neg_i32());
+    }
+    let registered = with_desc_mut(|descs| {
+        descs[irq].affinity = mask;
+        descs[irq].handler.is_some()
+    });
+    // 未注册的中断只记下掩码，注册时生效
+    if registered {
+        plic_set_affinity(irq, effective);
+    }
+    Ok(())
+}
+
+/// 中断的亲和性掩码
+pub fn irq_get_affinity(irq: usize) -> usize {
+    if irq >= MAX_INTERRUPTS {
+        return 0;
+    }
+    IRQ_DESC.read()[irq].affinity
+}
+
+/// 中断实际使能的 CPU (irq_data_get_effective_affinity_mask)
+pub fn irq_effective_affinity(irq: usize) -> usize {
+    (0..MAX_CPUS)
+        .filter(|&hart| plic::is_enabled(hart, irq))
+        .fold(0, |mask, hart| mask | (1 << hart))
+}
+
+/// 中断在每个 CPU 上的次数之和 (kstat_irqs)
+pub fn kstat_irqs(irq: usize) -> u64 {
+    if irq >= MAX_INTERRUPTS {
+        return 0;
+    }
+    KSTAT_IRQS[irq].iter().map(|count| count.load(Ordering::Relaxed)).sum()
+}
+
+/// 中断在指定 CPU 上的次数 (kstat_irqs_cpu)
+pub fn kstat_irqs_cpu(irq: usize, cpu: usize) -> u64 {
+    if irq >= MAX_INTERRUPTS || cpu >= MAX_CPUS {
+        return 0;
+    }
+    KSTAT_IRQS[irq][cpu].load(Ordering::Relaxed)
+}
+
+/// 已注册的中断号
+pub fn registered_irqs() -> Vec<usize> {
+    let descs = IRQ_DESC.read();
+    (1..MAX_INTERRUPTS).filter(|&irq| descs[irq].handler.is_some()).collect()
+}
+
+/// 分发一个已 claim 的中断 (generic_handle_irq)
+///
+/// 在关中断的硬中断中调用；下半部在本 CPU 的 irq_exit 中执行
+pub fn handle_irq(irq: usize) {
+    if irq == 0 || irq >= MAX_INTERRUPTS {
+        SPURIOUS_IRQS.fetch_add(1, Ordering::Relaxed);
+        return;
+    }
+    let cpu = crate::arch::cpu_id();
+    if cpu < MAX_CPUS {
+        KSTAT_IRQS[irq][cpu].fetch_add(1, Ordering::Relaxed);
+    }
+    let (handler, thread_softirq) = {
+        let descs = IRQ_DESC.read();
+        (descs[irq].handler, descs[irq].thread_softirq)
+    };
+    let ret = match handler {
+        Some(handler) => handler(irq),
+        None => IrqReturn::None,
+    };
+    match ret {
+        IrqReturn::None => {
+            SPURIOUS_IRQS.fetch_add(1, Ordering::Relaxed);
+        }
+        IrqReturn::Handled => {}
+        IrqReturn::WakeThread => {
+            if let Some(nr) = thread_softirq {
+                crate::softirq::raise_softirq(nr);
+            }
+        }
+    }
+}
+
+/// 解析十六进制 CPU 掩码，允许 0x 前缀和逗号分组
+fn parse_cpumask(data: &[u8]) -> Option<usize> {
+    let text = core::str::from_utf8(data).ok()?.trim();
+    let text = text.strip_prefix("0x").unwrap_or(text);
+    let digits: String = text.chars().filter(|&c| c != ',').collect();
+    if digits.is_empty() {
+        return None;
+    }
+    usize::from_str_radix(&digits, 16).ok()
+}
+
+/// 生成 /proc/irq/N/smp_affinity 内容
+pub fn read_smp_affinity(irq: usize) -> Vec<u8> {
+    format_mask(irq_get_affinity(irq))
+}
+
+/// 生成 /proc/irq/N/effective_affinity 内容
+pub fn read_effective_affinity(irq: usize) -> Vec<u8> {
+    format_mask(irq_effective_affinity(irq))
+}
+
+fn format_mask(mask: usize) -> Vec<u8> {
+    let mut out = String::new();
+    let _ = writeln!(out, "{:x}", mask);
+    out.into_bytes()
+}
+
+/// 写入 /proc/irq/N/smp_affinity (write_irq_affinity)
+pub fn write_smp_affinity(irq: usize, data: &[u8]) -> Result<usize, i32> {
+    let mask = match parse_cpumask(data) {
+        Some(mask) => mask,
+        None => return Err(Errno::InvalidArgument.as_neg_i32()),
+    };
+    irq_set_affinity(irq, mask)?;
+    Ok(data.len())
+}
+
+/// 生成 /proc/interrupts 内容 (show_interrupts)
+pub fn show_interrupts() -> String {
+    let mut out = String::new();
+    let _ = write!(out, "    ");
+    for cpu in 0..MAX_CPUS {
+        let _ = write!(out, " {:>10}", alloc::format!("CPU{}", cpu));
+    }
+    let _ = writeln!(out);
+
+    let descs = *IRQ_DESC.read();
+    for irq in 1..MAX_INTERRUPTS {
+        let desc = &descs[irq];
+        if desc.handler.is_none() && kstat_irqs(irq) == 0 {
+            continue;
+        }
+        let _ = write!(out, "{:>3}:", irq);
+        for cpu in 0..MAX_CPUS {
+            let _ = write!(out, " {:>10}", kstat_irqs_cpu(irq, cpu));
+        }
+        let kind = if desc.thread_softirq.is_some() { "threaded" } else { "level" };
+        let _ = writeln!(out, "  PLIC {:>3} {:<8} {}", irq, kind, desc.name);
+    }
+    // MSI 中断号与 PLIC 中断号是两个空间，以 M 前缀区分
+    for (id, name) in crate::drivers::intc::imsic::allocated_msis() {
+        let _ = write!(out, "M{:>2}:", id);
+        for cpu in 0..MAX_CPUS {
+            let _ = write!(out, " {:>10}", crate::drivers::intc::imsic::kstat_msi_cpu(id, cpu));
+        }
+        let _ = writeln!(out, "  IMSIC {:>3} {:<8} {}", id, "edge", name);
+    }
+    let _ = writeln!(out, "ERR: {:>10}", SPURIOUS_IRQS.load(Ordering::Relaxed));
+    out
+}
@@ -0,0 +1,352 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 共享只读统计页 (/dev/kstats)
+//!
+//! 参考 Linux: kernel/time/vsyscall.c (update_vsyscall), include/linux/seqlock.h,
+//! mm/vmstat.c (vmstat_update)
+//!
+//! 内核镜像中的一页，按固定偏移存放 u64 计数：页头、全局计数（块设备与网络设备的合计、
+//! 空闲页数）和每个 CPU 一段（调度、CPU 时间、内存事件、空闲状态）。
+//! 监控程序打开 /dev/kstats 并只读 mmap 这一页，之后读取计数不再需要系统调用和文本解析；
+//! 不能 mmap 的程序可以 read/pread 同一份内容。
+//!
+//! tick_do_timer_cpu 的 tick 每 KSTATS_INTERVAL 个 jiffies 从各模块的计数复制一次，
+//! 写者持有 UPDATE_LOCK，复制期间页头的 seq 为奇数。读者的一致快照：
+//! 读 seq（奇数则重读）、读计数、再读 seq，两次相同才有效。
+//!
+//! # 布局（版本 1，所有字段为本机字节序的 u64）
+//! - 页头：第 0 个字起，HDR_* 为字下标，记录魔数、版本、seq 与各段的字节偏移
+//! - 全局段：GLB_* 为相对 glb_offset 的字下标
+//! - CPU 段：第 N 个 CPU 从 cpu_offset + N * cpu_stride 开始，CPU_* 为段内的字下标；
+//!   CPU_ONLINE 为 0 的段没有意义
+//!
+//! 新字段只追加在各段的空余位置并增加版本号，已有字段的偏移不变
+//!
+//! # 与 Linux 的差异
+//! - Linux 没有对应的接口，格式是本内核自定义的；更新方式与 vvar 页相同
+//! - 块设备与网络设备只导出所有设备的合计，单个设备仍看 /proc/diskstats
+
+use core::sync::atomic::{fence, AtomicBool, AtomicU64, Ordering};
+
+use crate::config::MAX_CPUS;
+use crate::drivers::timer::{get_jiffies, HZ};
+
+const PAGE_SIZE: usize = 4096;
+const PAGE_WORDS: usize = PAGE_SIZE / 8;
+
+/// 设备节点
+pub const KSTATS_PATH: &str = "/dev/kstats";
+
+/// 页头的魔数 "RUXKSTAT"
+pub const KSTATS_MAGIC: u64 = u64::from_le_bytes(*b"RUXKSTAT");
+/// 布局版本
+pub const KSTATS_VERSION: u64 = 1;
+
+/// 两次更新之间的 jiffies 数
+pub const KSTATS_INTERVAL: u64 = HZ / 10;
+
+// ==================== 布局 ====================
+
+/// 页头的字下标
+pub const HDR_MAGIC: usize = 0;
+pub const HDR_VERSION: usize = 1;
+/// seqcount，奇数表示正在更新
+pub const HDR_SEQ: usize = 2;
+/// 页的字节数
+pub const HDR_SIZE: usize = 3;
+/// 全局段的字节偏移
+pub const HDR_GLB_OFFSET: usize = 4;
+/// 第 0 个 CPU 段的字节偏移、相邻 CPU 段的间隔字节数与 CPU 段数
+pub const HDR_CPU_OFFSET: usize = 5;
+pub const HDR_CPU_STRIDE: usize = 6;
+pub const HDR_NR_CPUS: usize = 7;
+const HDR_WORDS: usize = 8;
+
+/// 全局段的字下标
+/// 更新时的单调时间，纳秒，及 jiffies
+pub const GLB_TIMESTAMP_NS: usize = 0;
+pub const GLB_JIFFIES: usize = 1;
+/// 在线 CPU 数与所有 CPU 上的可运行任务数
+pub const GLB_NR_CPUS_ONLINE: usize = 2;
+pub const GLB_NR_RUNNING: usize = 3;
+/// 物理页总数与空闲页数
+pub const GLB_NR_PAGES: usize = 4;
+pub const GLB_NR_FREE_PAGES: usize = 5;
+/// 所有磁盘的请求数、扇区数与毫秒数 (/proc/diskstats)
+pub const GLB_BLK_READ_IOS: usize = 6;
+pub const GLB_BLK_READ_SECTORS: usize = 7;
+pub const GLB_BLK_READ_MS: usize = 8;
+pub const GLB_BLK_WRITE_IOS: usize = 9;
+pub const GLB_BLK_WRITE_SECTORS: usize = 10;
+pub const GLB_BLK_WRITE_MS: usize = 11;
+pub const GLB_BLK_DISCARD_IOS: usize = 12;
+pub const GLB_BLK_FLUSH_IOS: usize = 13;
+pub const GLB_BLK_IN_FLIGHT: usize = 14;
+pub const GLB_BLK_IO_MS: usize = 15;
+/// 所有网络设备的包数、字节数、错误与丢弃数 (/proc/net/dev)
+pub const GLB_NET_RX_PACKETS: usize = 16;
+pub const GLB_NET_RX_BYTES: usize = 17;
+pub const GLB_NET_RX_ERRORS: usize = 18;
+pub const GLB_NET_RX_DROPPED: usize = 19;
+pub const GLB_NET_TX_PACKETS: usize = 20;
+pub const GLB_NET_TX_BYTES: usize = 21;
+pub const GLB_NET_TX_ERRORS: usize = 22;
+pub const GLB_NET_TX_DROPPED: usize = 23;
+const GLB_BASE: usize = HDR_WORDS;
+const GLB_WORDS: usize = 56;
+
+/// CPU 段的字下标
+/// CPU 在线为 1
+pub const CPU_ONLINE: usize = 0;
+pub const CPU_NR_RUNNING: usize = 1;
+/// 调度计数 (/proc/schedstat)，时间为纳秒
+pub const CPU_NR_SWITCHES: usize = 2;
+pub const CPU_SCHED_COUNT: usize = 3;
+pub const CPU_SCHED_GOIDLE: usize = 4;
+pub const CPU_TTWU_COUNT: usize = 5;
+pub const CPU_TTWU_LOCAL: usize = 6;
+pub const CPU_YLD_COUNT: usize = 7;
+pub const CPU_RUN_TIME_NS: usize = 8;
+pub const CPU_RUN_DELAY_NS: usize = 9;
+pub const CPU_PCOUNT: usize = 10;
+/// CPU 时间，纳秒 (/proc/stat)
+pub const CPU_USER_NS: usize = 11;
+pub const CPU_NICE_NS: usize = 12;
+pub const CPU_SYSTEM_NS: usize = 13;
+pub const CPU_IDLE_NS: usize = 14;
+pub const CPU_SOFTIRQ_NS: usize = 15;
+/// 内存事件 (/proc/vmstat)，分配与释放按页计
+pub const CPU_PGFAULT: usize = 16;
+pub const CPU_PGMAJFAULT: usize = 17;
+pub const CPU_PGALLOC: usize = 18;
+pub const CPU_PGFREE: usize = 19;
+pub const CPU_COW_FAULT: usize = 20;
+/// 各空闲状态的进入次数 (/proc/cpuidle)
+pub const CPU_IDLE_POLL_USAGE: usize = 21;
+pub const CPU_IDLE_WFI_USAGE: usize = 22;
+pub const CPU_IDLE_SUSPEND_USAGE: usize = 23;
+const CPU_BASE: usize = GLB_BASE + GLB_WORDS;
+const CPU_WORDS: usize = 32;
+
+const _: () = assert!(CPU_BASE + MAX_CPUS * CPU_WORDS <= PAGE_WORDS);
+
+#[repr(C, align(4096))]
+struct KstatsPage {
+    words: [AtomicU64; PAGE_WORDS],
+}
+
+static KSTATS_PAGE: KstatsPage = KstatsPage { words: [const { AtomicU64::new(0) }; PAGE_WORDS] };
+
+/// 写者互斥：tick 拿不到时跳过这一次，不在中断中等待
+static UPDATE_LOCK: AtomicBool = AtomicBool::new(false);
+
+/// 上次更新的 jiffies
+static LAST_UPDATE: AtomicU64 = AtomicU64::new(0);
+
+#[inline]
+fn word(idx: usize) -> &'static AtomicU64 {
+    &KSTATS_PAGE.words[idx]
+}
+
+#[inline]
+fn set(idx: usize, val: u64) {
+    word(idx).store(val, Ordering::Relaxed);
+}
+
+/// 统计页的物理地址（内核恒等映射）
+#[inline]
+pub fn kstats_page() -> usize {
+    &KSTATS_PAGE as *const KstatsPage as usize
+}
+
+/// 填写页头并做第一次更新
+pub fn init() {
+    set(HDR_MAGIC, KSTATS_MAGIC);
+    set(HDR_VERSION, KSTATS_VERSION);
+    set(HDR_SIZE, PAGE_SIZE as u64);
+    set(HDR_GLB_OFFSET, (GLB_BASE * 8) as u64);
+    set(HDR_CPU_OFFSET, (CPU_BASE * 8) as u64);
+    set(HDR_CPU_STRIDE, (CPU_WORDS * 8) as u64);
+    set(HDR_NR_CPUS, MAX_CPUS as u64);
+    kstats_update();
+}
+
+/// tick 中调用，距上次更新满 KSTATS_INTERVAL 时更新
+#[inline]
+pub fn kstats_tick() {
+    let now = get_jiffies();
+    if now.wrapping_sub(LAST_UPDATE.load(Ordering::Relaxed)) >= KSTATS_INTERVAL {
+        kstats_update();
+    }
+}
+
+/// 从各模块复制计数 (vmstat_update)
+///
+/// 只读取原子计数，不获取会在中断中死锁的锁；磁盘列表正被修改时保留上次的块设备计数
+///
+/// # 返回
+/// 另一个写者正在更新时返回 false
+pub fn kstats_update() -> bool {
+    if UPDATE_LOCK.compare_exchange(false, true, Ordering::Acquire, Ordering::Relaxed).is_err() {
+        return false;
+    }
+    let seq = word(HDR_SEQ).load(Ordering::Relaxed);
+    word(HDR_SEQ).store(seq.wrapping_add(1), Ordering::Relaxed);
+    fence(Ordering::Release);
+
+    let jiffies = get_jiffies();
+    let now = crate::sched::fair::sched_clock();
+    LAST_UPDATE.store(jiffies, Ordering::Relaxed);
+    update_global(now, jiffies);
+    let active = crate::sched::cpu_active_mask();
+    for cpu in 0..MAX_CPUS {
+        update_cpu(cpu, active & (1 << cpu) != 0, now);
+    }
+
+    word(HDR_SEQ).store(seq.wrapping_add(2), Ordering::Release);
+    UPDATE_LOCK.store(false, Ordering::Release);
+    true
+}
+
+fn update_global(now: u64, jiffies: u64) {
+    use crate::drivers::blkdev::stat::{STAT_DISCARD, STAT_FLUSH, STAT_READ, STAT_WRITE};
+
+    let g = |idx: usize, val: u64| set(GLB_BASE + idx, val);
+    let frames = crate::mm::page::frame_stats();
+    g(GLB_TIMESTAMP_NS, now);
+    g(GLB_JIFFIES, jiffies);
+    g(GLB_NR_CPUS_ONLINE, crate::sched::cpu_active_mask().count_ones() as u64);
+    g(GLB_NR_RUNNING, crate::sched::sched::nr_running() as u64);
+    g(GLB_NR_PAGES, frames.total_frames as u64);
+    g(GLB_NR_FREE_PAGES, frames.free_frames as u64);
+
+    let mut blk = [0u64; 10];
+    let complete = crate::drivers::blkdev::try_for_each_disk(|gd| {
+        let s = gd.stats.read();
+        for (sum, val) in blk.iter_mut().zip([
+            s.ios[STAT_READ], s.sectors[STAT_READ], s.ms[STAT_READ],
+            s.ios[STAT_WRITE], s.sectors[STAT_WRITE], s.ms[STAT_WRITE],
+            s.ios[STAT_DISCARD], s.ios[STAT_FLUSH], s.in_flight as u64, s.io_ms,
+        ]) {
+            *sum += val;
+        }
+    });
+    if complete {
+        for (i, &val) in blk.iter().enumerate() {
+            g(GLB_BLK_READ_IOS + i, val);
+        }
+    }
+
+    let net = crate::drivers::net::netdev_stats_total();
+    g(GLB_NET_RX_PACKETS, net.rx_packets);
+    g(GLB_NET_RX_BYTES, net.rx_bytes);
+    g(GLB_NET_RX_ERRORS, net.rx_errors);
+    g(GLB_NET_RX_DROPPED, net.rx_dropped);
+    g(GLB_NET_TX_PACKETS, net.tx_packets);
+    g(GLB_NET_TX_BYTES, net.tx_bytes);
+    g(GLB_NET_TX_ERRORS, net.tx_errors);
+    g(GLB_NET_TX_DROPPED, net.tx_dropped);
+}
+
+fn update_cpu(cpu: usize, online: bool, now: u64) {
+    use crate::mm::vmstat::VmEvent;
+    use crate::sched::idle::IdleState;
+
+    let base = CPU_BASE + cpu * CPU_WORDS;
+    let c = |idx: usize, val: u64| set(base + idx, val);
+    c(CPU_ONLINE, online as u64);
+    if !online {
+        return;
+    }
+    let s = crate::sched::stats::schedstat_cpu(cpu);
+    c(CPU_NR_RUNNING, crate::sched::sched::nr_running_cpu(cpu) as u64);
+    c(CPU_NR_SWITCHES, s.nr_switches);
+    c(CPU_SCHED_COUNT, s.sched_count);
+    c(CPU_SCHED_GOIDLE, s.sched_goidle);
+    c(CPU_TTWU_COUNT, s.ttwu_count);
+    c(CPU_TTWU_LOCAL, s.ttwu_local);
+    c(CPU_YLD_COUNT, s.yld_count);
+    c(CPU_RUN_TIME_NS, s.rq_cpu_time);
+    c(CPU_RUN_DELAY_NS, s.run_delay);
+    c(CPU_PCOUNT, s.pcount);
+
+    let t = crate::sched::stats::cpu_time(cpu, now);
+    c(CPU_USER_NS, t.user);
+    c(CPU_NICE_NS, t.nice);
+    c(CPU_SYSTEM_NS, t.system);
+    c(CPU_IDLE_NS, t.idle);
+    c(CPU_SOFTIRQ_NS, t.softirq);
+
+    let ev = crate::mm::vmstat::cpu_vm_events(cpu);
+    c(CPU_PGFAULT, ev.event(VmEvent::PgFault));
+    c(CPU_PGMAJFAULT, ev.event(VmEvent::PgMajFault));
+    c(CPU_PGALLOC, ev.pages_allocated());
+    c(CPU_PGFREE, ev.pages_freed());
+    c(CPU_COW_FAULT, ev.event(VmEvent::CowFault));
+
+    let idle = crate::sched::idle::cpuidle_stat(cpu);
+    c(CPU_IDLE_POLL_USAGE, idle.usage[IdleState::Poll as usize]);
+    c(CPU_IDLE_WFI_USAGE, idle.usage[IdleState::Wfi as usize]);
+    c(CPU_IDLE_SUSPEND_USAGE, idle.usage[IdleState::Suspend as usize]);
+}
+
+// ==================== 读取 ====================
+
+/// 读取页中 [pos, pos + buf.len()) 的一致快照，与用户读映射的方式相同
+///
+/// # 返回
+/// 复制的字节数，pos 超出页时为 0
+pub fn kstats_read(buf: &mut [u8], pos: u64) -> usize {
+    if pos >= PAGE_SIZE as u64 {
+        return 0;
+    }
+    let pos = pos as usize;
+    let len = buf.len().min(PAGE_SIZE - pos);
+    loop {
+        let seq = word(HDR_SEQ).load(Ordering::Acquire);
+        if seq & 1 != 0 {
+            core::hint::spin_loop();
+            continue;
+        }
+        // 逐字复制与 [pos, pos + len) 重叠的字节
+        for i in pos / 8..(pos + len + 7) / 8 {
+            let bytes = word(i).load(Ordering::Relaxed).to_ne_bytes();
+            let lo = (i * 8).max(pos);
+            let hi = (i * 8 + 8).min(pos + len);
+            buf[lo - pos..hi - pos].copy_from_slice(&bytes[lo - i * 8..hi - i * 8]);
+        }
+        fence(Ordering::Acquire);
+        if word(HDR_SEQ).load(Ordering::Relaxed) == seq {
+            return len;
+        }
+    }
+}
+
+/// 把统计页只读映射到当前进程
+///
+/// # 返回
+/// 映射的用户地址；偏移不为 0 或长度超过一页返回 EINVAL，要求写入或执行返回 EACCES
+pub fn kstats_mmap(addr: usize, len: usize, prot_flags: u32, offset: u64) -> Result<usize, i32> {
+    use crate::arch::riscv64::mm::{prot, PageTableEntry};
+    use crate::errno::Errno;
+    use crate::mm::page::VirtAddr;
+    use crate::mm::vma::VmaFlags;
+
+    if offset != 0 || len == 0 || len > PAGE_SIZE {
+        return Err(Errno::InvalidArgument.as_neg_i32());
+    }
+    if prot_flags & (prot::PROT_WRITE | prot::PROT_EXEC) != 0 {
+        return Err(Errno::PermissionDenied.as_neg_i32());
+    }
+    let current = crate::sched::current().ok_or(Errno::OutOfMemory.as_neg_i32())?;
+    let aspace = current.address_space().ok_or(Errno::OutOfMemory.as_neg_i32())?;
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::SHARED);
+    aspace
+        .mmap_pfn(VirtAddr::new(addr), kstats_page(), PAGE_SIZE, flags, PageTableEntry::V | PageTableEntry::U | PageTableEntry::R)
+        .map(|start| start.as_usize())
+        .map_err(|_| Errno::OutOfMemory.as_neg_i32())
+}
@@ -0,0 +1,213 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! LZ4 块格式压缩与解压
+//!
+//! 参考 Linux: lib/lz4/lz4_compress.c, lib/lz4/lz4_decompress.c
+//!
+//! 输出是标准的 LZ4 块格式（不带帧头），与 LZ4_compress_default / LZ4_decompress_safe 互通：
+//! - 每个序列由 token（高 4 位字面量长度、低 4 位匹配长度 - 4）、字面量、
+//!   2 字节小端偏移和长度扩展字节组成，最后一个序列只有字面量
+//! - 压缩用 4 字节哈希表查找最近一次出现的位置，贪心取第一个匹配；
+//!   输入不超过 64KB，哈希表只存 16 位位置 (LZ4_64Klimit)
+//! - 解压检查所有越界情况，损坏的输入返回 None 而不会越界读写
+
+/// 最短匹配长度 (MINMATCH)
+const MINMATCH: usize = 4;
+/// 最后一个匹配至少在块尾 12 字节之前开始 (MFLIMIT)
+const MFLIMIT: usize = 12;
+/// 块尾至少 5 字节为字面量 (LASTLITERALS)
+const LASTLITERALS: usize = 5;
+/// 最大匹配距离 (LZ4_DISTANCE_MAX)
+const MAX_DISTANCE: usize = 65535;
+/// token 中长度字段的最大值 (RUN_MASK / ML_MASK)
+const RUN_MASK: usize = 15;
+
+/// 哈希表位数 (LZ4_HASHLOG)
+const LZ4_HASHLOG: u32 = 12;
+/// 哈希表项数，由调用者提供工作区 (LZ4_MEM_COMPRESS)
+pub const LZ4_HASH_SIZE: usize = 1 << LZ4_HASHLOG;
+
+/// 可以压缩的最大输入长度 (LZ4_64Klimit)
+pub const LZ4_MAX_INPUT_SIZE: usize = 65536;
+
+/// 最坏情况下的输出长度 (LZ4_COMPRESSBOUND)
+pub const fn lz4_compress_bound(len: usize) -> usize {
+    len + len / 255 + 16
+}
+
+#[inline]
+fn read_u32(src: &[u8], pos: usize) -> u32 {
+    u32::from_le_bytes([src[pos], src[pos + 1], src[pos + 2], src[pos + 3]])
+}
+
+#[inline]
+fn hash(sequence: u32) -> usize {
+    (sequence.wrapping_mul(2_654_435_761) >> (32 - LZ4_HASHLOG)) as usize
+}
+
+/// 输出缓冲区的写入位置
+struct Output<'a> {
+    dst: &'a mut [u8],
+    pos: usize,
+}
+
+impl Output<'_> {
+    #[inline]
+    fn push(&mut self, byte: u8) -> Option<()> {
+        *self.dst.get_mut(self.pos)? = byte;
+        self.pos += 1;
+        Some(())
+    }
+
+    fn extend(&mut self, bytes: &[u8]) -> Option<()> {
+        let end = self.pos.checked_add(bytes.len())?;
+        self.dst.get_mut(self.pos..end)?.copy_from_slice(bytes);
+        self.pos = end;
+        Some(())
+    }
+
+    /// token 放不下的长度：每个 255 字节表示再加 255，最后一个字节小于 255
+    fn push_length(&mut self, mut len: usize) -> Option<()> {
+        while len >= 255 {
+            self.push(255)?;
+            len -= 255;
+        }
+        self.push(len as u8)
+    }
+
+    /// 写入一个序列；match_len 为 0 时是只有字面量的最后一个序列
+    fn sequence(&mut self, literals: &[u8], offset: usize, match_len: usize) -> Option<()> {
+        let lit_len = literals.len();
+        let token_pos = self.pos;
+        self.push(0)?;
+        if lit_len >= RUN_MASK {
+            self.push_length(lit_len - RUN_MASK)?;
+        }
+        self.extend(literals)?;
+        let mut token = (lit_len.min(RUN_MASK) as u8) << 4;
+        if match_len > 0 {
+            self.extend(&(offset as u16).to_le_bytes())?;
+            let len = match_len - MINMATCH;
+            if len >= RUN_MASK {
+                self.push_length(len - RUN_MASK)?;
+            }
+            token |= len.min(RUN_MASK) as u8;
+        }
+        self.dst[token_pos] = token;
+        Some(())
+    }
+}
+
+/// 压缩 src 到 dst (LZ4_compress_fast_extState)
+///
+/// table 是调用者提供的工作区，每次压缩前清零
+///
+/// # 返回
+/// 压缩后的长度；dst 放不下时返回 None（dst 至少为 lz4_compress_bound 时总是成功）
+pub fn lz4_compress(src: &[u8], dst: &mut [u8], table: &mut [u16; LZ4_HASH_SIZE]) -> Option<usize> {
+    let len = src.len();
+    if len > LZ4_MAX_INPUT_SIZE {
+        return None;
+    }
+    let mut out = Output { dst, pos: 0 };
+    let mut anchor = 0;
+
+    // 太短的输入整个作为字面量 (LZ4_minLength)
+    if len > MFLIMIT {
+        table.fill(0);
+        let match_end_limit = len - LASTLITERALS;
+        let mut ip = 0;
+        while ip + MFLIMIT <= len {
+            let sequence = read_u32(src, ip);
+            let h = hash(sequence);
+            let candidate = table[h] as usize;
+            table[h] = ip as u16;
+            if candidate >= ip || ip - candidate > MAX_DISTANCE || read_u32(src, candidate) != sequence {
+                // 长时间没有匹配时加大步长，不可压缩的数据很快跳过 (LZ4_skipTrigger)
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            let mut match_len = MINMATCH;
+            while ip + match_len < match_end_limit && src[candidate + match_len] == src[ip + match_len] {
+                match_len += 1;
+            }
+            out.sequence(&src[anchor..ip], ip - candidate, match_len)?;
+            ip += match_len;
+            anchor = ip;
+        }
+    }
+
+    out.sequence(&src[anchor..], 0, 0)?;
+    Some(out.pos)
+}
+
+/// 读取长度扩展字节
+#[inline]
+fn read_length(src: &[u8], ip: &mut usize) -> Option<usize> {
+    let mut len = 0usize;
+    loop {
+        let byte = *src.get(*ip)?;
+        *ip += 1;
+        len = len.checked_add(byte as usize)?;
+        if byte != 255 {
+            return Some(len);
+        }
+    }
+}
+
+/// 解压 src 到 dst (LZ4_decompress_safe)
+///
+/// # 返回
+/// 解压后的长度；输入损坏或 dst 放不下时返回 None
+pub fn lz4_decompress(src: &[u8], dst: &mut [u8]) -> Option<usize> {
+    let mut ip = 0;
+    let mut op = 0;
+    loop {
+        let token = *src.get(ip)? as usize;
+        ip += 1;
+
+        let mut lit_len = token >> 4;
+        if lit_len == RUN_MASK {
+            lit_len += read_length(src, &mut ip)?;
+        }
+        let lit_end = ip.checked_add(lit_len)?;
+        let out_end = op.checked_add(lit_len)?;
+        dst.get_mut(op..out_end)?.copy_from_slice(src.get(ip..lit_end)?);
+        ip = lit_end;
+        op = out_end;
+
+        // 最后一个序列没有匹配部分
+        if ip == src.len() {
+            return Some(op);
+        }
+
+        let offset = u16::from_le_bytes([*src.get(ip)?, *src.get(ip + 1)?]) as usize;
+        ip += 2;
+        if offset == 0 || offset > op {
+            return None;
+        }
+        let mut match_len = token & RUN_MASK;
+        if match_len == RUN_MASK {
+            match_len += read_length(src, &mut ip)?;
+        }
+        match_len += MINMATCH;
+        let out_end = op.checked_add(match_len)?;
+        if out_end > dst.len() {
+            return None;
+        }
+        let from = op - offset;
+        if offset >= match_len {
+            dst.copy_within(from..from + match_len, op);
+        } else {
+            // 重叠的匹配（如连续的相同字节）逐字节复制
+            for i in 0..match_len {
+                dst[op + i] = dst[from + i];
+            }
+        }
+        op = out_end;
+    }
+}
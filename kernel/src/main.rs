@@ -32,9 +32,10 @@ fn print_status(module: &str, desc: &str, success: bool) {
     const OK: &[u8] = b"[ok]";
     const FAIL: &[u8] = b"[fail]";
 
-    unsafe {
-        use crate::console::putchar;
-
+    // 整行在一次 UART 加锁内输出，启动阶段次核的异步任务也会打印
+    let uart = crate::console::lock();
+    let putchar = |c: u8| uart.putc(c);
+    {
         // 失败时先打印红色开始代码
         if !success {
             for &b in RED {
@@ -98,22 +99,38 @@ mod sbi;
 mod mm;
 mod console;
 mod print;
+mod printk;
 mod drivers;
 mod input;
 mod config;
 mod list;
+mod rbtree;
+mod crc32;
+mod lz4;
+mod percpu_counter;
 mod process;
 mod sched;
+mod softirq;
+mod irq;
+mod time;
 mod fs;
 mod signal;
 mod sync;
 mod errno;
 mod net;
 mod cmdline;
+mod trace;
+mod profile;
+mod perf_event;
+mod kstats;
+mod fdt;
 mod init;
+mod initcall;
 
 #[cfg(feature = "unit-test")]
 mod tests;
+#[cfg(feature = "bench")]
+mod bench;
 
 // Allocation error handler for no_std
 #[alloc_error_handler]
@@ -128,6 +145,77 @@ global_asm!(include_str!("arch/aarch64/boot/boot.S"));
 #[cfg(feature = "aarch64")]
 global_asm!(include_str!("arch/aarch64/trap.S"));
 
+/// 探测块设备（async initcall）：先扫描 MMIO 设备，再扫描 PCI 设备
+#[cfg(feature = "riscv64")]
+fn probe_block_devices() -> bool {
+    // 先扫描 MMIO 设备（virtio-blk-device）
+    let mmio_count = drivers::probe::init_block_devices();
+    if mmio_count > 0 {
+        print_status("driver", &format!("virtio-blk MMIO x{}", mmio_count), true);
+    }
+    // 再扫描 PCI 设备（virtio-blk-pci）
+    let pci_count = drivers::probe::init_pci_block_devices();
+    if pci_count > 0 {
+        print_status("driver", &format!("virtio-blk PCI x{}", pci_count), true);
+        print_status("driver", "GenDisk registered", true);
+    }
+    true
+}
+
+/// 自动挂载 ext4 文件系统（async initcall，依赖 probe_block_devices）
+#[cfg(feature = "riscv64")]
+fn mount_root_ext4() -> bool {
+    if !crate::config::AUTO_MOUNT_EXT4 {
+        return true;
+    }
+    let mount_point = crate::config::EXT4_MOUNT_POINT;
+    // 尝试从 PCI 设备挂载
+    if let Some(disk) = drivers::virtio::get_pci_gen_disk() {
+        let mount_result = fs::ext4::mount_ext4(disk as *const _);
+        print_status("fs", &format!("ext4 mounted {}", mount_point), mount_result.is_ok());
+        mount_result.is_ok()
+    } else if let Some(virtio_dev) = drivers::virtio::get_device() {
+        // 尝试从 MMIO 设备挂载
+        let disk_ptr = &virtio_dev.disk as *const drivers::blkdev::GenDisk;
+        let mount_result = fs::ext4::mount_ext4(disk_ptr);
+        print_status("fs", &format!("ext4 mounted {}", mount_point), mount_result.is_ok());
+        mount_result.is_ok()
+    } else {
+        false
+    }
+}
+
+/// 初始化网络设备（async initcall）
+#[cfg(feature = "riscv64")]
+fn probe_network_devices() -> bool {
+    let device_count = drivers::probe::init_network_devices();
+    if device_count > 0 {
+        print_status("driver", &format!("virtio-net x{}", device_count), true);
+    }
+    true
+}
+
+/// 探测 VirtIO-GPU 并初始化帧缓冲区（async initcall）
+#[cfg(feature = "riscv64")]
+fn probe_gpu() -> bool {
+    let mut gpu_device = match drivers::gpu::probe_virtio_gpu() {
+        Some(device) => device,
+        None => return true,
+    };
+    print_status("driver", "virtio-gpu probed", true);
+    if let Some(fb_info) = gpu_device.init_framebuffer().copied() {
+        print_status("gpu", &format!("{}x{} 32bpp framebuffer", fb_info.width, fb_info.height), true);
+        // 保存 framebuffer 信息供用户态 mmap 使用
+        drivers::gpu::set_framebuffer_info(fb_info);
+        // 设备一直保留：帧缓冲区随设备释放，FBIO_DAMAGE 通过它刷新
+        drivers::gpu::set_gpu_device(gpu_device);
+        true
+    } else {
+        print_status("gpu", "framebuffer init failed", false);
+        false
+    }
+}
+
 // RISC-V kernel main function
 #[cfg(feature = "riscv64")]
 #[no_mangle]
@@ -137,9 +225,10 @@ pub extern "C" fn rust_main() -> ! {
     #[cfg(feature = "riscv64")]
     let is_boot_hart = arch::smp::init();
 
-    // 次核进入空闲循环，不执行任何初始化
+    // 次核先执行启动核排队的异步 initcall，之后进入空闲循环
     #[cfg(feature = "riscv64")]
     if !is_boot_hart {
+        initcall::secondary_worker();
         loop {
             unsafe {
                 core::arch::asm!("wfi", options(nomem, nostack));
@@ -149,8 +238,10 @@ pub extern "C" fn rust_main() -> ! {
 
     // ========== 以下代码只有启动核执行 ==========
 
+    initcall::boot_start();
+
     // 初始化控制台（必须最先，其他初始化才能打印）
-    console::init();
+    initcall::initcall("console", || { console::init(); true });
 
     // 打印启动横幅
     unsafe {
@@ -192,23 +283,29 @@ pub extern "C" fn rust_main() -> ! {
     }
 
     // 初始化 trap 处理
-    arch::trap::init();
-    arch::trap::init_syscall();
-
-    // 初始化 MMU（必须在堆初始化之前）
-    #[cfg(feature = "riscv64")]
-    {
-        arch::mm::init();
-    }
+    initcall::initcall("trap", || {
+        arch::trap::init();
+        arch::trap::init_syscall();
+        true
+    });
+
+    initcall::initcall("mm", || {
+        // 初始化 MMU（必须在堆初始化之前）
+        #[cfg(feature = "riscv64")]
+        {
+            arch::mm::init();
+        }
 
-    // 初始化堆分配器（MMU 必须先初始化）
-    mm::init_heap();
+        // 初始化堆分配器（MMU 必须先初始化）
+        mm::init_heap();
 
-    // 初始化 Slab 分配器（在堆之后）
-    // 堆结束地址：0x80A0_0000 + KERNEL_HEAP_SIZE
-    // 使用 4MB slab 区域以支持更多小对象分配
-    let slab_start = 0x80A0_0000 + crate::config::KERNEL_HEAP_SIZE;
-    mm::init_slab(slab_start, 4 * 1024 * 1024);  // 4MB for slab
+        // 初始化 Slab 分配器（在堆之后）
+        // 堆结束地址：0x80A0_0000 + KERNEL_HEAP_SIZE
+        // 使用 4MB slab 区域以支持更多小对象分配
+        let slab_start = 0x80A0_0000 + crate::config::KERNEL_HEAP_SIZE;
+        mm::init_slab(slab_start, 4 * 1024 * 1024);  // 4MB for slab
+        true
+    });
 
     // ========== 堆已初始化，以下可以使用 format! ==========
 
@@ -263,8 +360,16 @@ pub extern "C" fn rust_main() -> ! {
     // 初始化命令行参数解析（需要在堆初始化之后）
     #[cfg(feature = "riscv64")]
     {
-        let dtb_ptr = arch::riscv64::boot::get_dtb_pointer();
-        cmdline::init(dtb_ptr);
+        initcall::initcall("early_param", || {
+            let dtb_ptr = arch::riscv64::boot::get_dtb_pointer();
+            cmdline::init(dtb_ptr);
+            printk::init();
+            arch::riscv64::cpu::init_isa_extensions(dtb_ptr);
+            trace::init();
+            profile::init();
+            net::tcp_cong::tcp_cong_init();
+            true
+        });
         print_status("boot", "FDT/DTB parsed", true);
         if let Some(cmdline) = cmdline::get_cmdline() {
             if !cmdline.is_empty() {
@@ -284,144 +389,206 @@ pub extern "C" fn rust_main() -> ! {
     if is_boot_hart {
         // 初始化用户物理页分配器
         #[cfg(feature = "riscv64")]
-        {
+        initcall::initcall("page_alloc", || {
             arch::mm::init_user_phys_allocator(0x80000000, 0x8000000); // 128MB 内存
             print_status("mm", "user frame allocator 64MB", true);
 
             // 初始化页描述符（struct Page）
-            // 物理内存从 0x80000000 开始，初始化 64MB 的页描述符
-            let start_pfn = 0x80000000 / mm::PAGE_SIZE;
-            let nr_pages = mm::page_desc::MAX_PAGES;
+            // 按设备树的内存节点为每个包含 RAM 的 section 分配页描述符，
+            // 没有设备树时假定 0x80000000 起 128MB
+            let mut ranges = [(0usize, 0usize); fdt::MAX_MEM_REGIONS];
+            let mut nr_ranges = 0;
+            if let Some(layout) = unsafe { fdt::scan_memory(arch::riscv64::boot::get_dtb_pointer()) } {
+                for region in layout.regions() {
+                    ranges[nr_ranges] = (region.base as usize / mm::PAGE_SIZE, region.size as usize / mm::PAGE_SIZE);
+                    nr_ranges += 1;
+                }
+            } else {
+                ranges[0] = (0x80000000 / mm::PAGE_SIZE, 0x8000000 / mm::PAGE_SIZE);
+                nr_ranges = 1;
+            }
+            let start_pfn = ranges[..nr_ranges].iter().map(|r| r.0).min().unwrap_or(0x80000000 / mm::PAGE_SIZE);
 
             // 初始化帧分配器（用于 mmap 等操作）
             mm::page::init_frame_allocator(start_pfn);
 
-            mm::page::init_page_descriptors(start_pfn, nr_pages);
-            print_status("mm", &format!("{} page descriptors", nr_pages), true);
-        }
+            let nr_pages = mm::page::init_page_descriptors(&ranges[..nr_ranges]);
+            print_status("mm", &format!("{} page descriptors in {} sections", nr_pages, mm::page_desc::present_sections()), true);
+            true
+        });
 
         // 初始化 PLIC（中断控制器）
         #[cfg(feature = "riscv64")]
-        {
+        initcall::initcall("intc", || {
             drivers::intc::init();
             print_status("intc", "PLIC @ 0x0C000000", true);
             print_status("intc", "external IRQ routing", true);
-        }
+            if drivers::intc::imsic::is_enabled() {
+                print_status("intc", "IMSIC @ 0x28000000 (PCI MSI-X)", true);
+            }
+            true
+        });
 
         // 初始化 IPI（核间中断）
         #[cfg(feature = "riscv64")]
-        {
+        initcall::initcall("ipi", || {
             arch::ipi::init();
             print_status("ipi", "SSIP software IRQ", true);
-        }
+            true
+        });
+
+        // 串口终端：发送缓冲区由 THRE 中断驱动，输入经过线路规程
+        #[cfg(feature = "riscv64")]
+        initcall::initcall("tty", || {
+            drivers::tty::init();
+            let mode = if drivers::tty::serial::irq_mode() { "IRQ 10" } else { "polled" };
+            print_status("tty", &format!("ttyS0 {}, {}K xmit buffer", mode, drivers::tty::serial::XMIT_SIZE / 1024), true);
+            true
+        });
 
         // 初始化文件系统
         {
             // 初始化 block I/O 层
-            fs::bio::init();
-            print_status("bio", "buffer cache layer", true);
+            initcall::initcall("bio", || {
+                fs::bio::init();
+                print_status("bio", "buffer cache layer", true);
+                true
+            });
 
             // 初始化 ext4 文件系统
-            fs::ext4::init();
-            print_status("fs", "ext4 driver loaded", true);
+            initcall::initcall("ext4_init", || {
+                fs::ext4::init();
+                print_status("fs", "ext4 driver loaded", true);
+                true
+            });
 
             // 初始化 RootFS
-            let rootfs_result = fs::rootfs::init_rootfs();
-            print_status("fs", "ramfs mounted /", rootfs_result.is_ok());
+            initcall::initcall("rootfs", || {
+                let rootfs_result = fs::rootfs::init_rootfs();
+                print_status("fs", "ramfs mounted /", rootfs_result.is_ok());
+                rootfs_result.is_ok()
+            });
+
+            // 解开引导程序传递的 initramfs (cpio newc)
+            #[cfg(feature = "riscv64")]
+            initcall::initcall("initramfs", || match fs::initramfs::populate_rootfs() {
+                Some(Ok(count)) => {
+                    print_status("fs", &format!("initramfs {} entries", count), true);
+                    true
+                }
+                Some(Err(_)) => {
+                    print_status("fs", "initramfs unpack", false);
+                    false
+                }
+                None => true,
+            });
 
             // 初始化 ProcFS 并挂载到 /proc
-            let procfs_result = fs::procfs::init_procfs();
-            print_status("fs", "procfs initialized", procfs_result.is_ok());
-            if procfs_result.is_ok() {
-                let mount_result = fs::procfs::mount_procfs();
-                print_status("fs", "procfs mounted /proc", mount_result.is_ok());
-            }
-        }
-
-        // 初始化块设备（用于 rootfs）
-        {
-            // 先扫描 MMIO 设备（virtio-blk-device）
-            let mmio_count = drivers::probe::init_block_devices();
-            if mmio_count > 0 {
-                print_status("driver", &format!("virtio-blk MMIO x{}", mmio_count), true);
-            }
-            // 再扫描 PCI 设备（virtio-blk-pci）
-            let pci_count = drivers::probe::init_pci_block_devices();
-            if pci_count > 0 {
-                print_status("driver", &format!("virtio-blk PCI x{}", pci_count), true);
-                print_status("driver", "GenDisk registered", true);
-            }
-
-            // 自动挂载 ext4 文件系统（如果配置启用）
-            if crate::config::AUTO_MOUNT_EXT4 {
-                // 尝试从 PCI 设备挂载
-                if let Some(disk) = drivers::virtio::get_pci_gen_disk() {
-                    let mount_result = fs::ext4::mount_ext4(disk as *const _);
-                    let mount_point = crate::config::EXT4_MOUNT_POINT;
-                    print_status("fs", &format!("ext4 mounted {}", mount_point), mount_result.is_ok());
-                } else if let Some(virtio_dev) = drivers::virtio::get_device() {
-                    // 尝试从 MMIO 设备挂载
-                    let disk_ptr = &virtio_dev.disk as *const drivers::blkdev::GenDisk;
-                    let mount_result = fs::ext4::mount_ext4(disk_ptr);
-                    let mount_point = crate::config::EXT4_MOUNT_POINT;
-                    print_status("fs", &format!("ext4 mounted {}", mount_point), mount_result.is_ok());
+            initcall::initcall("procfs", || {
+                let procfs_result = fs::procfs::init_procfs();
+                print_status("fs", "procfs initialized", procfs_result.is_ok());
+                if procfs_result.is_ok() {
+                    let mount_result = fs::procfs::mount_procfs();
+                    print_status("fs", "procfs mounted /proc", mount_result.is_ok());
+                    return mount_result.is_ok();
                 }
-            }
+                false
+            });
+
+            // 初始化 cgroup2 并挂载到 /sys/fs/cgroup
+            initcall::initcall("cgroup", || {
+                let cgroup_result = fs::cgroupfs::init_cgroupfs();
+                print_status("fs", "cgroup2 initialized", cgroup_result.is_ok());
+                if cgroup_result.is_ok() {
+                    let mount_result = fs::cgroupfs::mount_cgroupfs();
+                    print_status("fs", "cgroup2 mounted /sys/fs/cgroup", mount_result.is_ok());
+                    return mount_result.is_ok();
+                }
+                false
+            });
+
+            // 初始化 tmpfs 并挂载 /tmp 与 /dev/shm
+            initcall::initcall("tmpfs", || {
+                let tmpfs_result = fs::tmpfs::init_tmpfs();
+                print_status("fs", "tmpfs initialized", tmpfs_result.is_ok());
+                if tmpfs_result.is_ok() {
+                    let mount_result = fs::tmpfs::mount_default_tmpfs();
+                    print_status("fs", "tmpfs mounted /tmp /dev/shm", mount_result.is_ok());
+                    return mount_result.is_ok();
+                }
+                false
+            });
         }
 
-        // 初始化网络设备
+        // ========== 并行 initcall ==========
+        // 设备探测与 ext4 挂载互不依赖调度器，交给次核执行；启动核同时初始化调度器。
+        // 外部中断在全部完成后才使能，探测期间的块设备请求轮询完成
+        #[cfg(feature = "riscv64")]
         {
-            let device_count = drivers::probe::init_network_devices();
-            if device_count > 0 {
-                print_status("driver", &format!("virtio-net x{}", device_count), true);
-            }
+            initcall::async_open();
+            let blk = initcall::async_schedule("blkdev_probe", probe_block_devices, &[]);
+            initcall::async_schedule("ext4_mount", mount_root_ext4, &[blk]);
+            initcall::async_schedule("netdev_probe", probe_network_devices, &[]);
+            initcall::async_schedule("virtio_gpu", probe_gpu, &[]);
         }
 
         // 初始化进程调度器
         #[cfg(feature = "riscv64")]
-        {
+        initcall::initcall("sched", || {
             sched::init();
             print_status("sched", "CFS scheduler v1", true);
             print_status("sched", "runqueue per-CPU", true);
             print_status("sched", "PID allocator init", true);
             print_status("sched", "idle task (PID 0)", true);
 
+            // 注册时间轮与 hrtimer 的软中断
+            time::init();
+            print_status("time", "timer wheel + hrtimer", true);
+
+            // 生成 vDSO 映像，execve 时映射到用户地址空间
+            arch::riscv64::vdso::init();
+            print_status("time", "vDSO clock_gettime", true);
+
+            // 探测 SBI PMU 并配置本核的硬件计数器
+            arch::riscv64::pmu::init();
+            print_status("perf", if arch::riscv64::pmu::sbi_pmu_available() { "SBI PMU counters" } else { "legacy cycle/instret" }, true);
+
+            // 探测 SBI HSM，空闲 CPU 长时间睡眠时挂起 hart
+            sched::idle::init();
+            print_status("sched", if sched::idle::hsm_suspend_available() { "cpuidle poll/wfi/HSM suspend" } else { "cpuidle poll/wfi" }, true);
+
+            // 填写统计页的页头，之后由 tick 定期更新
+            kstats::init();
+            print_status("kstats", "/dev/kstats stats page", true);
+
             // 初始化 Per-CPU Pages（在调度器初始化之后）
             let boot_cpu = arch::cpu_id() as usize;
             mm::init_percpu_pages(boot_cpu);
             print_status("mm", &format!("PCP cpu{} hotpage", boot_cpu), true);
-        }
+            true
+        });
 
-        // 使能外部中断
+        // ========== 初始化输入系统 ==========
         #[cfg(feature = "riscv64")]
-        {
-            arch::trap::enable_external_interrupt();
-            print_status("trap", "sie.SEIE enabled", true);
-        }
+        initcall::initcall("input", || {
+            input::init();
+            print_status("driver", "PS/2 keyboard", true);
+            print_status("driver", "PS/2 mouse", true);
+            true
+        });
 
-        // ========== 图形系统初始化 (VirtIO-GPU) ==========
+        // 等待异步 initcall 完成，次核回到空闲循环
         #[cfg(feature = "riscv64")]
         {
-            // 探测 VirtIO-GPU 设备
-            if let Some(mut gpu_device) = drivers::gpu::probe_virtio_gpu() {
-                print_status("driver", "virtio-gpu probed", true);
-                // 初始化帧缓冲区
-                if let Some(fb_info) = gpu_device.init_framebuffer() {
-                    print_status("gpu", &format!("{}x{} 32bpp framebuffer", fb_info.width, fb_info.height), true);
-                    // 保存 framebuffer 信息供用户态 mmap 使用
-                    drivers::gpu::set_framebuffer_info(*fb_info);
-                } else {
-                    print_status("gpu", "framebuffer init failed", false);
-                }
-            }
+            initcall::initcall("async_wait", || { initcall::async_close(); true });
+            print_status("initcall", &format!("async on {} secondary CPU(s)", initcall::async_workers()), true);
         }
 
-        // ========== 初始化输入系统 ==========
+        // 使能外部中断
         #[cfg(feature = "riscv64")]
         {
-            input::init();
-            print_status("driver", "PS/2 keyboard", true);
-            print_status("driver", "PS/2 mouse", true);
+            arch::trap::enable_external_interrupt();
+            print_status("trap", "sie.SEIE enabled", true);
         }
 
         println!();
@@ -440,6 +607,15 @@ pub extern "C" fn rust_main() -> ! {
             drivers::timer::set_next_trigger();
         }
 
+        // 运行内核微基准测试（同样禁用定时器中断，避免 tick 计入采样）
+        #[cfg(feature = "bench")]
+        {
+            arch::trap::disable_timer_interrupt();
+            bench::run_all_benches();
+            arch::trap::enable_timer_interrupt();
+            drivers::timer::set_next_trigger();
+        }
+
         // 测试用户程序执行
         #[cfg(feature = "riscv64")]
         {
@@ -462,9 +638,16 @@ pub extern "C" fn rust_main() -> ! {
             // 获取 init 路径
             let init_path = cmdline::get_init_program();
             print_status("init", &format!("loading {}", init_path), true);
-            init::init();
+            initcall::initcall("init", || { init::init(); true });
             print_status("init", "ELF loaded to user space", true);
             print_status("init", "init task (PID 1) enqueued", true);
+
+            // 启动阶段计时见 /proc/boottime
+            initcall::boot_complete();
+            initcall::print_table();
+            if let Some(us) = initcall::boot_duration_us() {
+                print_status("boot", &format!("{}.{:03} ms to init", us / 1000, us % 1000), true);
+            }
         }
 
         println!();
@@ -493,6 +676,8 @@ pub extern "C" fn rust_main() -> ! {
         #[cfg(feature = "riscv64")]
         {
             sched::init();
+            mm::init_percpu_pages(arch::cpu_id() as usize);
+            arch::riscv64::pmu::init_cpu(arch::cpu_id() as usize);
         }
 
         // 进入空闲循环，参与任务调度
@@ -515,7 +700,9 @@ pub extern "C" fn rust_main() -> ! {
 #[panic_handler]
 fn panic(info: &PanicInfo) -> ! {
     unsafe {
-        use crate::console::putchar;
+        // 先输出缓冲区中还没输出的日志；panic 的 hart 可能持有 UART 锁，之后都不加锁
+        crate::printk::console_flush_on_panic();
+        use crate::console::putchar_no_lock as putchar;
         const MSG: &[u8] = b"\nPANIC! ";
         for &b in MSG {
             putchar(b);
@@ -565,7 +752,7 @@ impl core::fmt::Write for SimpleWriter {
     fn write_str(&mut self, s: &str) -> core::fmt::Result {
         unsafe {
             for b in s.bytes() {
-                crate::console::putchar(b);
+                crate::console::putchar_no_lock(b);
             }
         }
         Ok(())
@@ -5,17 +5,28 @@
 
 //! Buddy System (伙伴系统) 内存分配器
 //!
-//! 改进版本：元数据与用户数据分开存储，避免 BlockHeader 被覆盖
+//! 参考 Linux: mm/page_alloc.c (free_area, __rmqueue_smallest, __free_one_page)
+//!
+//! - 每个 order 一个侵入式双向空闲链表，链表节点直接存放在空闲块的首部，
+//!   不需要额外的元数据数组
+//! - 每个 order 一个空闲位图，每个 order 对齐的块占一位，
+//!   释放时用位图判断伙伴是否空闲，摘除伙伴是 O(1) 的链表删除
+//! - 分割和合并均为 O(1)（每一级），统计信息直接读取 nr_free
+//!
+//! 堆由固定的初始区域和按需扩展的块组成：
+//! - 初始区域 [HEAP_START, HEAP_START + HEAP_SIZE) 由 Kernel.toml 配置
+//! - 初始区域耗尽时从物理页分配器取一个按自身大小对齐的扩展块，
+//!   扩展块有自己的 Zone，Zone 头存放在块末尾的页中
+//! - 物理内存不足时 (shrink_heap) 归还完全空闲的扩展块
 
 use core::alloc::{GlobalAlloc, Layout};
-use core::cell::UnsafeCell;
+use core::ptr;
 use core::sync::atomic::{AtomicUsize, Ordering};
+use spin::Mutex;
 
 const PAGE_SIZE: usize = 4096;
 
-const MAX_ORDER: usize = 20;
-
-const MIN_ORDER: usize = 0;
+pub const MAX_ORDER: usize = 20;
 
 const HEAP_START: usize = 0x80A0_0000;
 
@@ -23,313 +34,430 @@ const HEAP_START: usize = 0x80A0_0000;
 // 注意：帧缓冲区会从堆中分配，约4MB (1280x800x4)
 const HEAP_SIZE: usize = crate::config::KERNEL_HEAP_SIZE;
 
-/// 最大页数（用于元数据数组大小）
-const MAX_PAGES: usize = HEAP_SIZE / PAGE_SIZE;  // 4096 页
+/// 最大页数（用于位图大小）
+const MAX_PAGES: usize = HEAP_SIZE / PAGE_SIZE;
+
+/// 扩展块的最小 order（2MB）
+const HEAP_CHUNK_ORDER: usize = 9;
+
+/// 扩展块的最大 order（Zone 位图只覆盖 MAX_PAGES 个页）
+const HEAP_CHUNK_MAX_ORDER: usize = (usize::BITS - 1 - MAX_PAGES.leading_zeros()) as usize;
+
+/// 扩展块数量上限
+const MAX_HEAP_CHUNKS: usize = 32;
+
+/// 每个 order 位图的字数
+const fn map_words(order: usize) -> usize {
+    let bits = MAX_PAGES >> order;
+    if bits == 0 { 1 } else { (bits + 63) / 64 }
+}
+
+/// 每个 order 位图在 map 中的起始字偏移
+const fn map_offsets() -> [usize; MAX_ORDER + 2] {
+    let mut offsets = [0usize; MAX_ORDER + 2];
+    let mut order = 0;
+    while order <= MAX_ORDER {
+        offsets[order + 1] = offsets[order] + map_words(order);
+        order += 1;
+    }
+    offsets
+}
 
-/// 空链表标记（使用超出范围的值）
-const EMPTY_LIST: usize = MAX_PAGES + 1;
+const MAP_OFFSETS: [usize; MAX_ORDER + 2] = map_offsets();
 
-/// 块元数据（分开存储，不与用户数据混用）
+/// 所有 order 位图的总字数
+const MAP_WORDS: usize = MAP_OFFSETS[MAX_ORDER + 1];
+
+/// 空闲块首部的链表节点（侵入式，只存在于空闲块中）
 #[repr(C)]
+struct FreeBlock {
+    next: *mut FreeBlock,
+    prev: *mut FreeBlock,
+}
+
+/// 单个 order 的空闲区 (struct free_area)
 #[derive(Clone, Copy)]
-struct BlockMeta {
-    /// 块的大小等级 (2^order * PAGE_SIZE)
-    order: u8,
-    /// 是否空闲
-    free: u8,
-    /// 前驱索引（在元数据数组中的索引，0 表示空）
-    prev: u16,
-    /// 后继索引（在元数据数组中的索引，0 表示空）
-    next: u16,
+struct FreeArea {
+    /// 空闲链表头（null 表示空）
+    head: *mut FreeBlock,
+    /// 空闲块数量
+    nr_free: usize,
 }
 
-impl BlockMeta {
+impl FreeArea {
     const fn new() -> Self {
         Self {
-            order: 0,
-            free: 0,
-            prev: 0,
-            next: 0,
+            head: ptr::null_mut(),
+            nr_free: 0,
         }
     }
 }
 
-/// 元数据数组包装器（使用 UnsafeCell 实现内部可变性）
-struct MetaArray {
-    data: UnsafeCell<[BlockMeta; MAX_PAGES]>,
+/// 伙伴系统管理区 (struct zone)
+///
+/// 管理从 base 开始的 nr_pages 个页，块按相对 base 的页索引对齐
+struct Zone {
+    /// 起始地址
+    base: usize,
+    /// 管理的页数
+    nr_pages: usize,
+    /// 各 order 空闲区
+    free_area: [FreeArea; MAX_ORDER + 1],
+    /// 各 order 空闲位图（第 order 个位图的第 i 位对应页索引 i << order 的块）
+    map: [u64; MAP_WORDS],
+    /// 空闲页数
+    free_pages: usize,
+    /// 分配次数
+    alloc_count: usize,
+    /// 释放次数
+    free_count: usize,
 }
 
-unsafe impl Send for MetaArray {}
-unsafe impl Sync for MetaArray {}
+// 裸指针只指向 zone 自身管理的内存，由外层 Mutex 保护
+unsafe impl Send for Zone {}
 
-impl MetaArray {
+impl Zone {
     const fn new() -> Self {
         Self {
-            data: UnsafeCell::new([const { BlockMeta::new() }; MAX_PAGES]),
+            base: 0,
+            nr_pages: 0,
+            free_area: [const { FreeArea::new() }; MAX_ORDER + 1],
+            map: [0; MAP_WORDS],
+            free_pages: 0,
+            alloc_count: 0,
+            free_count: 0,
         }
     }
 
-    /// 获取元数据引用（安全：只在单线程环境下使用）
-    fn get(&self, idx: usize) -> &BlockMeta {
-        unsafe { &(*self.data.get())[idx] }
+    /// 位图中 (page_idx, order) 对应的 (字索引, 位掩码)
+    #[inline]
+    fn map_pos(page_idx: usize, order: usize) -> (usize, u64) {
+        let bit = page_idx >> order;
+        (MAP_OFFSETS[order] + bit / 64, 1u64 << (bit % 64))
     }
 
-    /// 获取元数据可变引用（安全：只在单线程环境下使用）
-    fn get_mut(&self, idx: usize) -> &mut BlockMeta {
-        if idx >= MAX_PAGES {
-            // 索引越界，返回第一个元素（安全回退）
-            return unsafe { &mut (*self.data.get())[0] };
-        }
-        unsafe { &mut (*self.data.get())[idx] }
+    /// 块是否空闲且恰好为该 order (page_is_buddy)
+    #[inline]
+    fn test_free(&self, page_idx: usize, order: usize) -> bool {
+        let (word, mask) = Self::map_pos(page_idx, order);
+        self.map[word] & mask != 0
     }
-}
 
-pub struct BuddyAllocator {
-    /// 魔数（用于检测破坏）
-    magic: AtomicUsize,
-    /// 堆的起始地址（用户数据区域）
-    heap_start: AtomicUsize,
-    /// 堆的结束地址
-    heap_end: AtomicUsize,
-    /// 空闲块链表 (每个 order 一个链表，存储页索引)
-    free_lists: [AtomicUsize; MAX_ORDER + 1],
-    /// 是否已初始化
-    initialized: AtomicUsize,
-    /// 元数据区域（存储每个页的元数据）
-    meta: MetaArray,
-}
+    #[inline]
+    fn block_of(&self, page_idx: usize) -> *mut FreeBlock {
+        (self.base + page_idx * PAGE_SIZE) as *mut FreeBlock
+    }
 
-unsafe impl Send for BuddyAllocator {}
-unsafe impl Sync for BuddyAllocator {}
+    /// 将块加入空闲链表头部并置位 (add_to_free_list)
+    unsafe fn add_to_free_list(&mut self, page_idx: usize, order: usize) {
+        let block = self.block_of(page_idx);
+        let area = &mut self.free_area[order];
 
-impl BuddyAllocator {
-    pub const fn new() -> Self {
-        Self {
-            magic: AtomicUsize::new(0xDEADBEEF),
-            heap_start: AtomicUsize::new(0),
-            heap_end: AtomicUsize::new(0),
-            free_lists: [const { AtomicUsize::new(0) }; MAX_ORDER + 1],
-            initialized: AtomicUsize::new(0),
-            meta: MetaArray::new(),
+        (*block).next = area.head;
+        (*block).prev = ptr::null_mut();
+        if !area.head.is_null() {
+            (*area.head).prev = block;
         }
-    }
+        area.head = block;
+        area.nr_free += 1;
 
-    /// 检查魔数是否有效
-    fn check_magic(&self) -> bool {
-        self.magic.load(Ordering::Acquire) == 0xDEADBEEF
+        let (word, mask) = Self::map_pos(page_idx, order);
+        self.map[word] |= mask;
+        self.free_pages += 1 << order;
     }
 
-    /// 初始化分配器
-    pub fn init(&self) {
-        if self.initialized.load(Ordering::Acquire) != 0 {
-            return;
+    /// 将块从空闲链表中摘除并清位 (del_page_from_free_list)
+    unsafe fn del_from_free_list(&mut self, page_idx: usize, order: usize) {
+        let block = self.block_of(page_idx);
+        let area = &mut self.free_area[order];
+        let next = (*block).next;
+        let prev = (*block).prev;
+
+        if prev.is_null() {
+            area.head = next;
+        } else {
+            (*prev).next = next;
+        }
+        if !next.is_null() {
+            (*next).prev = prev;
         }
+        area.nr_free -= 1;
 
-        if self.initialized.compare_exchange(0, 1, Ordering::AcqRel, Ordering::Acquire).is_ok() {
-            // 设置魔数
-            self.magic.store(0xDEADBEEF, Ordering::Release);
-            self.heap_start.store(HEAP_START, Ordering::Release);
-            self.heap_end.store(HEAP_START + HEAP_SIZE, Ordering::Release);
+        let (word, mask) = Self::map_pos(page_idx, order);
+        self.map[word] &= !mask;
+        self.free_pages -= 1 << order;
+    }
 
-            // 初始化所有空闲链表为空
-            for i in 0..=MAX_ORDER {
-                self.free_lists[i].store(EMPTY_LIST, Ordering::Release);
+    /// 将 [base, base + nr_pages * PAGE_SIZE) 交给伙伴系统管理
+    ///
+    /// 区间按最大的对齐块切分加入空闲链表，页数不必是 2 的幂
+    unsafe fn init(&mut self, base: usize, nr_pages: usize) {
+        self.base = base;
+        self.nr_pages = nr_pages;
+
+        let mut idx = 0;
+        while idx < nr_pages {
+            let mut order = if idx == 0 { MAX_ORDER } else { (idx.trailing_zeros() as usize).min(MAX_ORDER) };
+            while idx + (1 << order) > nr_pages {
+                order -= 1;
             }
-
-            // 计算最大 order
-            let max_order = self.heap_size_to_order(HEAP_SIZE);
-
-            // 将整个堆作为一个大块添加到对应 order 的空闲链表
-            // 页索引 0 对应 HEAP_START
-            self.init_block(0, max_order, false);
-            self.add_to_free_list(0, max_order);
+            self.add_to_free_list(idx, order);
+            idx += 1 << order;
         }
     }
 
-    /// 初始化块元数据
-    fn init_block(&self, page_idx: usize, order: usize, free: bool) {
-        let meta = self.meta.get_mut(page_idx);
-        meta.order = order as u8;
-        meta.free = if free { 1 } else { 0 };
-        meta.prev = 0;
-        meta.next = 0;
-    }
-
-    /// 将块添加到空闲链表
-    fn add_to_free_list(&self, page_idx: usize, order: usize) {
-        // 边界检查
-        if order > MAX_ORDER {
-            return;  // 无法处理超过最大 order 的块
+    /// 分配 2^order 个页 (__rmqueue_smallest)
+    unsafe fn alloc(&mut self, order: usize) -> Option<usize> {
+        let mut current = order;
+        while current <= MAX_ORDER && self.free_area[current].nr_free == 0 {
+            current += 1;
         }
-
-        {
-            let meta = self.meta.get_mut(page_idx);
-            meta.order = order as u8;
-            meta.free = 1;
+        if current > MAX_ORDER {
+            return None;
         }
 
-        // 获取当前空闲链表头
-        let list_head = self.free_lists[order].load(Ordering::Acquire);
+        let block = self.free_area[current].head as usize;
+        let page_idx = (block - self.base) / PAGE_SIZE;
+        self.del_from_free_list(page_idx, current);
 
-        // 将块插入链表头部
-        if list_head != EMPTY_LIST && list_head < MAX_PAGES {
-            self.meta.get_mut(list_head).prev = page_idx as u16;
-        }
-        {
-            let meta = self.meta.get_mut(page_idx);
-            meta.next = if list_head == EMPTY_LIST { 0xFFFF } else { list_head as u16 };
-            meta.prev = 0xFFFF;  // 0xFFFF 表示空
+        // 分割：后半部分依次放回低一级的空闲链表 (expand)
+        while current > order {
+            current -= 1;
+            self.add_to_free_list(page_idx + (1 << current), current);
         }
 
-        // 更新链表头
-        self.free_lists[order].store(page_idx, Ordering::Release);
+        self.alloc_count += 1;
+        Some(self.base + page_idx * PAGE_SIZE)
     }
 
-    /// 从空闲链表移除块
-    fn remove_from_free_list(&self, page_idx: usize, order: usize) {
-        // 边界检查
-        if order > MAX_ORDER {
-            return;  // 无法处理超过最大 order 的块
-        }
+    /// 地址是否属于该 zone
+    #[inline]
+    fn contains(&self, addr: usize) -> bool {
+        addr >= self.base && addr < self.base + self.nr_pages * PAGE_SIZE
+    }
 
-        let prev_idx = self.meta.get(page_idx).prev as usize;
-        let next_idx = self.meta.get(page_idx).next as usize;
+    /// 所有页都空闲
+    #[inline]
+    fn is_empty(&self) -> bool {
+        self.free_pages == self.nr_pages
+    }
 
-        if prev_idx != 0xFFFF && prev_idx < MAX_PAGES {
-            self.meta.get_mut(prev_idx).next = next_idx as u16;
-        } else {
-            // 这是链表头，更新全局链表头
-            let new_head = if next_idx == 0xFFFF { EMPTY_LIST } else { next_idx };
-            self.free_lists[order].store(new_head, Ordering::Release);
-        }
+    /// 释放 2^order 个页并与空闲伙伴合并 (__free_one_page)
+    unsafe fn free(&mut self, addr: usize, order: usize) {
+        let mut page_idx = (addr - self.base) / PAGE_SIZE;
+        let mut order = order;
 
-        if next_idx != 0xFFFF && next_idx < MAX_PAGES {
-            self.meta.get_mut(next_idx).prev = prev_idx as u16;
+        if self.test_free(page_idx, order) {
+            // 重复释放
+            return;
         }
 
-        self.meta.get_mut(page_idx).free = 0;
-    }
-
-    /// 计算堆大小对应的 order
-    fn heap_size_to_order(&self, size: usize) -> usize {
-        let mut order = 0;
-        let mut block_size = PAGE_SIZE;
-        while block_size < size {
-            block_size *= 2;
+        while order < MAX_ORDER {
+            let buddy_idx = page_idx ^ (1 << order);
+            if buddy_idx + (1 << order) > self.nr_pages || !self.test_free(buddy_idx, order) {
+                break;
+            }
+            self.del_from_free_list(buddy_idx, order);
+            page_idx &= !(1 << order);
             order += 1;
         }
-        order
-    }
 
-    /// 将大小转换为 order
-    fn size_to_order(&self, size: usize) -> usize {
-        let mut order = 0;
-        let mut block_size = PAGE_SIZE;
-        while block_size < size {
-            block_size *= 2;
-            order += 1;
-        }
-        order
+        self.add_to_free_list(page_idx, order);
+        self.free_count += 1;
     }
+}
 
-    /// 获取块的伙伴页索引
-    fn get_buddy_idx(&self, page_idx: usize, order: usize) -> usize {
-        let block_size_pages = 1usize << order;  // 块包含的页数
-        page_idx ^ block_size_pages
+/// Zone 头占用的页数（扩展块中存放在块末尾）
+const ZONE_HDR_PAGES: usize = (core::mem::size_of::<Zone>() + PAGE_SIZE - 1) / PAGE_SIZE;
+
+/// 内核堆：初始区域加上按需扩展的块
+struct Heap {
+    /// 初始堆区域
+    zone: Zone,
+    /// 扩展块的 Zone 头
+    chunks: [*mut Zone; MAX_HEAP_CHUNKS],
+    /// 扩展块数量
+    nr_chunks: usize,
+    /// 扩展次数
+    grow_count: usize,
+    /// 归还次数
+    shrink_count: usize,
+}
+
+// 扩展块指针只由堆锁保护访问
+unsafe impl Send for Heap {}
+
+impl Heap {
+    const fn new() -> Self {
+        Self {
+            zone: Zone::new(),
+            chunks: [ptr::null_mut(); MAX_HEAP_CHUNKS],
+            nr_chunks: 0,
+            grow_count: 0,
+            shrink_count: 0,
+        }
     }
 
-    /// 页索引转换为地址
-    fn page_idx_to_addr(&self, page_idx: usize) -> usize {
-        HEAP_START + page_idx * PAGE_SIZE
+    /// 分配 2^order 个页，初始区域和已有扩展块都不足时扩展堆
+    unsafe fn alloc(&mut self, order: usize) -> Option<usize> {
+        if let Some(addr) = self.zone.alloc(order) {
+            return Some(addr);
+        }
+        for i in 0..self.nr_chunks {
+            if let Some(addr) = (*self.chunks[i]).alloc(order) {
+                return Some(addr);
+            }
+        }
+        let chunk = self.grow(order)?;
+        (*chunk).alloc(order)
     }
 
-    /// 地址转换为页索引
-    fn addr_to_page_idx(&self, addr: usize) -> usize {
-        (addr - HEAP_START) / PAGE_SIZE
+    /// 释放 2^order 个页
+    ///
+    /// # 返回
+    /// 地址不属于堆时返回 false
+    unsafe fn free(&mut self, addr: usize, order: usize) -> bool {
+        if self.zone.contains(addr) {
+            self.zone.free(addr, order);
+            return true;
+        }
+        for i in 0..self.nr_chunks {
+            let chunk = &mut *self.chunks[i];
+            if chunk.contains(addr) {
+                chunk.free(addr, order);
+                return true;
+            }
+        }
+        false
     }
 
-    /// 分配内存
-    fn alloc_blocks(&self, order: usize) -> *mut u8 {
-        // 从指定 order 开始查找
-        for mut current_order in order..=MAX_ORDER {
-            let list_head = self.free_lists[current_order].load(Ordering::Acquire);
+    /// 从物理页分配器取一个扩展块
+    ///
+    /// Zone 头放在块末尾，块内最大的空闲块只有块的一半，
+    /// 因此扩展块比请求大一级，且不小于 HEAP_CHUNK_ORDER
+    unsafe fn grow(&mut self, order: usize) -> Option<*mut Zone> {
+        if self.nr_chunks == MAX_HEAP_CHUNKS {
+            return None;
+        }
+        let chunk_order = (order + 1).max(HEAP_CHUNK_ORDER);
+        if chunk_order > HEAP_CHUNK_MAX_ORDER {
+            return None;
+        }
 
-            if list_head != EMPTY_LIST && list_head < MAX_PAGES {
-                // 找到空闲块
-                self.remove_from_free_list(list_head, current_order);
+        let chunk_pages = 1usize << chunk_order;
+        let chunk_size = chunk_pages * PAGE_SIZE;
+        let base = crate::arch::mm::alloc_kernel_chunk(chunk_size as u64, chunk_size as u64)? as usize;
 
-                // 如果需要，分割块
-                let mut page_idx = list_head;
-                while current_order > order {
-                    let block_size_pages = 1usize << current_order;
-                    let buddy_idx = page_idx + (block_size_pages / 2);
+        // 全零的 Zone 是合法的空 zone，避免在栈上构造大结构体
+        let nr_pages = chunk_pages - ZONE_HDR_PAGES;
+        let hdr = (base + nr_pages * PAGE_SIZE) as *mut Zone;
+        ptr::write_bytes(hdr, 0, 1);
+        (*hdr).init(base, nr_pages);
 
-                    // 初始化伙伴块并加入空闲链表
-                    self.init_block(buddy_idx, current_order - 1, true);
-                    self.add_to_free_list(buddy_idx, current_order - 1);
+        self.chunks[self.nr_chunks] = hdr;
+        self.nr_chunks += 1;
+        self.grow_count += 1;
+        Some(hdr)
+    }
 
-                    // 更新当前块为前半部分
-                    self.init_block(page_idx, current_order - 1, false);
-                    current_order -= 1;
-                }
+    /// 归还所有完全空闲的扩展块
+    ///
+    /// # 返回
+    /// 归还的字节数
+    unsafe fn shrink(&mut self) -> usize {
+        let mut released = 0;
+        let mut i = 0;
+        while i < self.nr_chunks {
+            let chunk = self.chunks[i];
+            if !(*chunk).is_empty() {
+                i += 1;
+                continue;
+            }
 
-                // 返回用户可用地址（直接返回块开始地址，元数据分开存储）
-                return self.page_idx_to_addr(page_idx) as *mut u8;
+            let base = (*chunk).base;
+            let chunk_size = ((*chunk).nr_pages + ZONE_HDR_PAGES) * PAGE_SIZE;
+            if !crate::arch::mm::free_kernel_chunk(base as u64, chunk_size as u64) {
+                i += 1;
+                continue;
             }
-        }
 
-        // 没有足够内存
-        core::ptr::null_mut()
+            self.nr_chunks -= 1;
+            self.chunks[i] = self.chunks[self.nr_chunks];
+            self.chunks[self.nr_chunks] = ptr::null_mut();
+            self.shrink_count += 1;
+            released += chunk_size;
+        }
+        released
     }
+}
 
-    /// 释放内存
-    unsafe fn free_blocks(&self, ptr: *mut u8, order: usize) {
-        let addr = ptr as usize;
-        let mut page_idx = self.addr_to_page_idx(addr);
-        let mut current_order = order;
+pub struct BuddyAllocator {
+    /// 魔数（用于检测破坏）
+    magic: AtomicUsize,
+    /// 堆的起始地址（初始区域）
+    heap_start: AtomicUsize,
+    /// 堆的结束地址（初始区域）
+    heap_end: AtomicUsize,
+    /// 是否已初始化
+    initialized: AtomicUsize,
+    /// 内核堆 (zone->lock)
+    heap: Mutex<Heap>,
+}
 
-        loop {
-            // 边界检查：order 不能超过 MAX_ORDER
-            if current_order > MAX_ORDER {
-                // 超过最大 order，直接添加到 MAX_ORDER 链表
-                self.add_to_free_list(page_idx, MAX_ORDER);
-                break;
-            }
+unsafe impl Send for BuddyAllocator {}
+unsafe impl Sync for BuddyAllocator {}
 
-            let buddy_idx = self.get_buddy_idx(page_idx, current_order);
+impl BuddyAllocator {
+    pub const fn new() -> Self {
+        Self {
+            magic: AtomicUsize::new(0xDEADBEEF),
+            heap_start: AtomicUsize::new(0),
+            heap_end: AtomicUsize::new(0),
+            initialized: AtomicUsize::new(0),
+            heap: Mutex::new(Heap::new()),
+        }
+    }
 
-            // 检查伙伴是否在有效范围内
-            if buddy_idx >= MAX_PAGES {
-                // 伙伴超出范围，无法合并
-                self.add_to_free_list(page_idx, current_order);
-                break;
-            }
+    /// 检查魔数是否有效
+    fn check_magic(&self) -> bool {
+        self.magic.load(Ordering::Acquire) == 0xDEADBEEF
+    }
 
-            // 检查伙伴是否空闲且大小匹配
-            let buddy_meta = self.meta.get(buddy_idx);
-            if buddy_meta.free == 0 || buddy_meta.order != current_order as u8 {
-                // 伙伴不空闲或大小不匹配，无法合并
-                self.add_to_free_list(page_idx, current_order);
-                break;
-            }
+    /// 初始化分配器
+    pub fn init(&self) {
+        if self.initialized.load(Ordering::Acquire) != 0 {
+            return;
+        }
 
-            // 伙伴空闲，从链表中移除
-            self.remove_from_free_list(buddy_idx, current_order);
+        if self.initialized.compare_exchange(0, 1, Ordering::AcqRel, Ordering::Acquire).is_ok() {
+            // 设置魔数
+            self.magic.store(0xDEADBEEF, Ordering::Release);
 
-            // 合并：选择索引较小的作为基址
-            if page_idx > buddy_idx {
-                page_idx = buddy_idx;
+            unsafe {
+                self.heap.lock().zone.init(HEAP_START, MAX_PAGES);
             }
 
-            current_order += 1;
+            self.heap_start.store(HEAP_START, Ordering::Release);
+            self.heap_end.store(HEAP_START + HEAP_SIZE, Ordering::Release);
+        }
+    }
+
+    /// 将大小转换为 order
+    fn size_to_order(&self, size: usize) -> usize {
+        let mut order = 0;
+        let mut block_size = PAGE_SIZE;
+        while block_size < size {
+            block_size *= 2;
+            order += 1;
         }
+        order
     }
 }
 
 unsafe impl GlobalAlloc for BuddyAllocator {
     unsafe fn alloc(&self, layout: Layout) -> *mut u8 {
         // 检查魔数和初始化状态
-        if self.magic.load(Ordering::Acquire) != 0xDEADBEEF
+        if !self.check_magic()
             || self.initialized.load(Ordering::Acquire) == 0
             || self.heap_start.load(Ordering::Acquire) == 0 {
             return core::ptr::null_mut();
@@ -339,7 +467,15 @@ unsafe impl GlobalAlloc for BuddyAllocator {
         let align = layout.align();
 
         let order = self.size_to_order(size.max(align));
-        self.alloc_blocks(order)
+        if order > MAX_ORDER {
+            return core::ptr::null_mut();
+        }
+
+        let _irq = crate::arch::context::InterruptGuard::new();
+        match self.heap.lock().alloc(order) {
+            Some(addr) => addr as *mut u8,
+            None => core::ptr::null_mut(),
+        }
     }
 
     unsafe fn dealloc(&self, ptr: *mut u8, layout: Layout) {
@@ -350,14 +486,6 @@ unsafe impl GlobalAlloc for BuddyAllocator {
         let size = layout.size();
         let align = layout.align();
 
-        let ptr_addr = ptr as usize;
-        let heap_start = self.heap_start.load(Ordering::Acquire);
-        let heap_end = self.heap_end.load(Ordering::Acquire);
-
-        if ptr_addr < heap_start || ptr_addr >= heap_end {
-            return;
-        }
-
         let order = self.size_to_order(size.max(align));
 
         // 检查 order 是否超过 MAX_ORDER
@@ -365,7 +493,9 @@ unsafe impl GlobalAlloc for BuddyAllocator {
             return;
         }
 
-        self.free_blocks(ptr, order);
+        // 不属于堆的指针由 Heap::free 忽略
+        let _irq = crate::arch::context::InterruptGuard::new();
+        self.heap.lock().free(ptr as usize, order);
     }
 }
 
@@ -381,14 +511,26 @@ pub fn init_heap() {
     GLOBAL_ALLOCATOR.init();
 }
 
+/// 物理内存不足时归还完全空闲的堆扩展块
+///
+/// # 返回
+/// 归还的字节数
+pub fn shrink_heap() -> usize {
+    if HEAP_ALLOCATOR.initialized.load(Ordering::Acquire) == 0 {
+        return 0;
+    }
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    unsafe { HEAP_ALLOCATOR.heap.lock().shrink() }
+}
+
 /// Buddy 分配器统计信息
 #[derive(Debug, Clone, Copy, Default)]
 pub struct BuddyStats {
-    /// 堆起始地址
+    /// 堆起始地址（初始区域）
     pub heap_start: usize,
-    /// 堆结束地址
+    /// 堆结束地址（初始区域）
     pub heap_end: usize,
-    /// 堆总大小（字节）
+    /// 堆总大小（字节，包括扩展块）
     pub heap_size: usize,
     /// 已使用大小（字节）
     pub used_bytes: usize,
@@ -396,10 +538,39 @@ pub struct BuddyStats {
     pub free_bytes: usize,
     /// 各 order 的空闲块数量
     pub free_blocks: [usize; MAX_ORDER + 1],
+    /// 各 order 的不可用空闲内存比例（千分比）
+    ///
+    /// 即空闲内存中无法满足该 order 分配的部分 (unusable_free_index)，
+    /// 0 表示没有碎片，1000 表示所有空闲内存都碎片化到小于该 order
+    pub unusable_index: [u16; MAX_ORDER + 1],
     /// 总分配次数
     pub alloc_count: usize,
     /// 总释放次数
     pub free_count: usize,
+    /// 当前扩展块数量
+    pub nr_chunks: usize,
+    /// 扩展块占用的字节数（包括 Zone 头）
+    pub chunk_bytes: usize,
+    /// 堆扩展次数
+    pub grow_count: usize,
+    /// 扩展块归还次数
+    pub shrink_count: usize,
+}
+
+/// 计算各 order 的不可用空闲内存比例 (mm/vmstat.c: unusable_free_index)
+fn unusable_index(free_blocks: &[usize; MAX_ORDER + 1], free_pages: usize) -> [u16; MAX_ORDER + 1] {
+    let mut index = [0u16; MAX_ORDER + 1];
+    if free_pages == 0 {
+        return index;
+    }
+
+    // suitable: order 及以上的空闲页数，从高到低累加
+    let mut suitable = 0usize;
+    for order in (0..=MAX_ORDER).rev() {
+        suitable += free_blocks[order] << order;
+        index[order] = ((free_pages - suitable) * 1000 / free_pages) as u16;
+    }
+    index
 }
 
 /// 获取 Buddy 分配器统计信息
@@ -412,32 +583,53 @@ pub fn buddy_stats() -> BuddyStats {
 
     stats.heap_start = HEAP_ALLOCATOR.heap_start.load(Ordering::Acquire);
     stats.heap_end = HEAP_ALLOCATOR.heap_end.load(Ordering::Acquire);
-    stats.heap_size = stats.heap_end - stats.heap_start;
 
-    // 统计各 order 的空闲块数量
-    let mut total_free_pages = 0usize;
-    for order in 0..=MAX_ORDER {
-        let mut count = 0usize;
-        let mut page_idx = HEAP_ALLOCATOR.free_lists[order].load(Ordering::Acquire);
-
-        while page_idx != EMPTY_LIST && page_idx < MAX_PAGES {
-            count += 1;
-            total_free_pages += 1usize << order;
-            let next = HEAP_ALLOCATOR.meta.get(page_idx).next as usize;
-            if next == 0xFFFF || next >= MAX_PAGES {
-                break;
+    let mut managed_pages = 0;
+    let mut free_pages = 0;
+    {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        let heap = HEAP_ALLOCATOR.heap.lock();
+        let chunks = heap.chunks[..heap.nr_chunks].iter().map(|&c| unsafe { &*c });
+        for zone in core::iter::once(&heap.zone).chain(chunks) {
+            for order in 0..=MAX_ORDER {
+                stats.free_blocks[order] += zone.free_area[order].nr_free;
             }
-            page_idx = next;
+            stats.alloc_count += zone.alloc_count;
+            stats.free_count += zone.free_count;
+            managed_pages += zone.nr_pages;
+            free_pages += zone.free_pages;
         }
-        stats.free_blocks[order] = count;
+        stats.nr_chunks = heap.nr_chunks;
+        stats.chunk_bytes = (managed_pages - heap.zone.nr_pages + heap.nr_chunks * ZONE_HDR_PAGES) * PAGE_SIZE;
+        stats.grow_count = heap.grow_count;
+        stats.shrink_count = heap.shrink_count;
     }
 
-    stats.free_bytes = total_free_pages * PAGE_SIZE;
+    stats.heap_size = managed_pages * PAGE_SIZE;
+
+    stats.unusable_index = unusable_index(&stats.free_blocks, free_pages);
+    stats.free_bytes = free_pages * PAGE_SIZE;
     stats.used_bytes = stats.heap_size - stats.free_bytes;
 
     stats
 }
 
+/// 生成 /proc/buddyinfo 内容
+///
+/// 格式与 Linux 兼容：`Node 0, zone   Normal` 后跟各 order 的空闲块数
+pub fn buddyinfo() -> alloc::string::String {
+    use core::fmt::Write;
+
+    let stats = buddy_stats();
+    let mut out = alloc::string::String::new();
+    let _ = write!(out, "Node 0, zone {:>8} ", "Normal");
+    for order in 0..=MAX_ORDER {
+        let _ = write!(out, "{:>6} ", stats.free_blocks[order]);
+    }
+    out.push('\n');
+    out
+}
+
 /// 组合分配器 - 优先使用 Slab 处理小对象，大对象回退到 Buddy
 ///
 /// 这种设计可以减少内存碎片化，提高小对象分配效率
@@ -466,7 +658,6 @@ unsafe impl GlobalAlloc for CombinedAllocator {
         }
 
         let ptr_addr = ptr as usize;
-        let heap_start = HEAP_ALLOCATOR.heap_start.load(Ordering::Acquire);
         let heap_end = HEAP_ALLOCATOR.heap_end.load(Ordering::Acquire);
 
         // 检查指针是否在 Slab 区域
@@ -477,10 +668,110 @@ unsafe impl GlobalAlloc for CombinedAllocator {
         if ptr_addr >= slab_start && ptr_addr < slab_end {
             // 在 Slab 区域，使用 kfree
             crate::mm::kfree(ptr);
-        } else if ptr_addr >= heap_start && ptr_addr < heap_end {
-            // 在 Buddy 堆区域
+        } else {
+            // Buddy 堆（初始区域或扩展块），其他区域的指针由 Buddy 忽略
             HEAP_ALLOCATOR.dealloc(ptr, layout);
         }
-        // 其他区域的指针忽略
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    const ARENA_PAGES: usize = 64;
+
+    #[repr(C, align(262144))]
+    struct Arena([u8; ARENA_PAGES * PAGE_SIZE]);
+
+    fn new_zone(arena: &mut Arena, nr_pages: usize) -> Zone {
+        let mut zone = Zone::new();
+        unsafe { zone.init(arena.0.as_mut_ptr() as usize, nr_pages) };
+        zone
+    }
+
+    #[test]
+    fn test_init_non_power_of_two() {
+        let mut arena = Arena([0; ARENA_PAGES * PAGE_SIZE]);
+        let zone = new_zone(&mut arena, 13);
+        // 13 = 8 + 4 + 1
+        assert_eq!(zone.free_pages, 13);
+        assert_eq!(zone.free_area[3].nr_free, 1);
+        assert_eq!(zone.free_area[2].nr_free, 1);
+        assert_eq!(zone.free_area[0].nr_free, 1);
+        assert!(zone.test_free(0, 3));
+        assert!(zone.test_free(8, 2));
+        assert!(zone.test_free(12, 0));
+    }
+
+    #[test]
+    fn test_split_and_coalesce() {
+        let mut arena = Arena([0; ARENA_PAGES * PAGE_SIZE]);
+        let mut zone = new_zone(&mut arena, ARENA_PAGES);
+        let base = zone.base;
+        assert_eq!(zone.free_area[6].nr_free, 1);
+
+        unsafe {
+            let a = zone.alloc(0).unwrap();
+            assert_eq!(a, base);
+            // 64 = 1 + 1 + 2 + 4 + 8 + 16 + 32
+            for order in 0..6 {
+                assert_eq!(zone.free_area[order].nr_free, 1);
+            }
+            assert_eq!(zone.free_pages, ARENA_PAGES - 1);
+
+            let b = zone.alloc(0).unwrap();
+            assert_eq!(b, base + PAGE_SIZE);
+            let c = zone.alloc(2).unwrap();
+            assert_eq!(c, base + 4 * PAGE_SIZE);
+            assert_eq!(c % (4 * PAGE_SIZE), 0);
+
+            zone.free(a, 0);
+            zone.free(c, 2);
+            zone.free(b, 0);
+        }
+
+        assert!(zone.is_empty());
+        assert_eq!(zone.free_area[6].nr_free, 1);
+        for order in 0..6 {
+            assert_eq!(zone.free_area[order].nr_free, 0);
+        }
+    }
+
+    #[test]
+    fn test_double_free_ignored() {
+        let mut arena = Arena([0; ARENA_PAGES * PAGE_SIZE]);
+        let mut zone = new_zone(&mut arena, 4);
+        unsafe {
+            let a = zone.alloc(0).unwrap();
+            let _b = zone.alloc(0).unwrap();
+            zone.free(a, 0);
+            zone.free(a, 0);
+        }
+        assert_eq!(zone.free_pages, 3);
+        assert_eq!(zone.free_area[0].nr_free, 1);
+    }
+
+    #[test]
+    fn test_exhaustion() {
+        let mut arena = Arena([0; ARENA_PAGES * PAGE_SIZE]);
+        let mut zone = new_zone(&mut arena, 8);
+        unsafe {
+            assert!(zone.alloc(4).is_none());
+            assert!(zone.alloc(3).is_some());
+            assert!(zone.alloc(0).is_none());
+        }
+    }
+
+    #[test]
+    fn test_unusable_index() {
+        let mut free_blocks = [0usize; MAX_ORDER + 1];
+        free_blocks[0] = 4;
+        free_blocks[2] = 1;
+        let index = unusable_index(&free_blocks, 8);
+        assert_eq!(index[0], 0);
+        assert_eq!(index[1], 500);
+        assert_eq!(index[2], 500);
+        assert_eq!(index[3], 1000);
     }
 }
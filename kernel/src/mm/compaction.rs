@@ -0,0 +1,351 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内存规整 (memory compaction)
+//!
+//! 参考 Linux: mm/compaction.c (compact_zone, isolate_migratepages, isolate_freepages, kcompactd),
+//!            mm/migrate.c (migrate_pages)
+//!
+//! 物理页分配器的连续分配只从 bump 区域切出，bump 区域用完后空闲链表中的页
+//! 不再连续，大页和 DMA 缓冲区分配失败。规整在已切出的区域中凑出连续的空闲块：
+//! - 按块 (pageblock，最多 COMPACT_BLOCK_PAGES 页) 扫描，块中每页都必须空闲
+//!   （在空闲链表中，Buddy 类型）或可移动，选可移动页最少的块
+//! - 可移动的页是带反向映射、只有一个映射的匿名页（可换出页和惰性释放页），
+//!   由 arch::mm::try_to_migrate 迁移到块外的新页：可写的页先写保护，
+//!   刷新 TLB 后复制内容并改写页表项，再刷新 TLB 后释放旧页
+//! - 页缓存页、内核页、共享页表映射的页不迁移，含有这些页的块跳过
+//! - 块中的空闲页从空闲链表摘下 (isolate_freepages)；迁移目标恰好落在块中时直接留下。
+//!   凑不齐时全部归还，已经迁移的页不迁回
+//!
+//! # 触发
+//! - 连续分配失败时同步规整 (direct compaction, compact_stall)
+//! - 失败后唤醒 kcompactd：在 CPU 0 的空闲循环中运行，空闲页高于高水位时预先规整出
+//!   一个块留给下一次连续分配；页回收时先归还这个块
+//! - 同一时间只有一个规整在进行
+
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+
+use super::page::{allocated_frame_range, dealloc_frame, frame_stats, isolate_free_frames, PhysFrame};
+use super::page_desc::{pfn_to_page, PageFlag, PageType};
+use super::pcp::{alloc_page_nowait, drain_all_pages, free_user_page, MigrateType};
+use crate::arch::riscv64::mm::{try_to_migrate, MigratePage};
+
+/// 规整块的最大页数 (pageblock_nr_pages)，与 2MB 大页相同
+pub const COMPACT_BLOCK_PAGES: usize = 512;
+
+/// 块内页位图的字数
+const BITMAP_WORDS: usize = COMPACT_BLOCK_PAGES / 64;
+
+/// 每次规整最多尝试的候选块数
+const COMPACT_MAX_ATTEMPTS: usize = 4;
+
+/// 每页最多尝试迁移的次数：第一次可能只是写保护
+const MIGRATE_PASSES: usize = 2;
+
+/// 正在规整
+static COMPACTING: AtomicBool = AtomicBool::new(false);
+
+/// kcompactd 唤醒请求：最近一次连续分配失败
+static KCOMPACTD_WAKE: AtomicBool = AtomicBool::new(false);
+
+/// kcompactd 预先规整出的块的起始页号，0 表示没有
+static READY_BLOCK: AtomicUsize = AtomicUsize::new(0);
+
+/// 统计：同步规整次数 (compact_stall)
+static NR_COMPACT_STALL: AtomicUsize = AtomicUsize::new(0);
+/// 统计：规整出连续块的次数 (compact_success)
+static NR_COMPACT_SUCCESS: AtomicUsize = AtomicUsize::new(0);
+/// 统计：规整失败次数 (compact_fail)
+static NR_COMPACT_FAIL: AtomicUsize = AtomicUsize::new(0);
+/// 统计：迁移的页数 (pgmigrate_success)
+static NR_MIGRATED: AtomicUsize = AtomicUsize::new(0);
+/// 统计：迁移失败的页数 (pgmigrate_fail)
+static NR_MIGRATE_FAIL: AtomicUsize = AtomicUsize::new(0);
+/// 统计：kcompactd 运行次数 (compact_daemon_wake)
+static NR_KCOMPACTD_RUNS: AtomicUsize = AtomicUsize::new(0);
+
+#[inline]
+fn test_bit(bitmap: &[u64; BITMAP_WORDS], bit: usize) -> bool {
+    bitmap[bit / 64] & 1 << (bit % 64) != 0
+}
+
+#[inline]
+fn set_bit(bitmap: &mut [u64; BITMAP_WORDS], bit: usize) {
+    bitmap[bit / 64] |= 1 << (bit % 64);
+}
+
+/// 页能否迁移：带反向映射、只有一个引用的匿名页
+#[inline]
+fn page_movable(page: *const super::page_desc::Page) -> bool {
+    unsafe { (*page).page_type() == PageType::Anonymous && (*page).private() != 0 && (*page).refcount() == 1 }
+}
+
+/// 扫描一个块 (isolate_migratepages_block)
+///
+/// # 返回
+/// 块中每页都空闲或可移动时返回可移动页的页号；否则返回 None
+fn scan_block(start: usize, nr: usize) -> Option<Vec<usize>> {
+    let mut movable = Vec::new();
+    for pfn in start..start + nr {
+        let page = pfn_to_page(pfn);
+        if page.is_null() {
+            return None;
+        }
+        if unsafe { (*page).page_type() } == PageType::Buddy {
+            continue;
+        }
+        if !page_movable(page) || movable.try_reserve(1).is_err() {
+            return None;
+        }
+        movable.push(pfn);
+    }
+    Some(movable)
+}
+
+/// 分配迁移目标页 (compaction_alloc)
+///
+/// 只用不回收的分配；落在块中的页留作块的一部分 (capture)，继续分配
+fn alloc_target(start: usize, nr: usize, captured: &mut [u64; BITMAP_WORDS]) -> Option<usize> {
+    loop {
+        let frame = alloc_page_nowait(MigrateType::Movable)?;
+        if frame.number >= start && frame.number < start + nr {
+            set_bit(captured, frame.number - start);
+            continue;
+        }
+        return Some(frame.number);
+    }
+}
+
+/// 把块中的可移动页迁移出去 (migrate_pages)
+///
+/// # 返回
+/// 全部迁移成功时返回 true
+fn migrate_block(start: usize, nr: usize, movable: Vec<usize>, captured: &mut [u64; BITMAP_WORDS]) -> bool {
+    let mut pending = movable;
+    let mut moved = Vec::new();
+    if moved.try_reserve(pending.len()).is_err() {
+        return false;
+    }
+    let mut complete = true;
+    for _ in 0..MIGRATE_PASSES {
+        if pending.is_empty() {
+            break;
+        }
+        let mut retry = Vec::new();
+        for &pfn in &pending {
+            let new_pfn = match alloc_target(start, nr, captured) {
+                Some(new_pfn) => new_pfn,
+                None => {
+                    complete = false;
+                    break;
+                }
+            };
+            match try_to_migrate(pfn, new_pfn) {
+                MigratePage::Moved => moved.push(pfn),
+                result => {
+                    free_user_page(PhysFrame::new(new_pfn));
+                    if result == MigratePage::Busy || retry.try_reserve(1).is_err() {
+                        complete = false;
+                        break;
+                    }
+                    retry.push(pfn);
+                }
+            }
+        }
+        if !complete {
+            break;
+        }
+        // 写保护的页刷新 TLB 后内容才稳定
+        if !retry.is_empty() {
+            crate::arch::tlb::flush_tlb_all();
+        }
+        pending = retry;
+    }
+    complete &= pending.is_empty();
+
+    // 旧页在所有 CPU 的 TLB 中都失效后才能释放
+    if !moved.is_empty() {
+        crate::arch::tlb::flush_tlb_all();
+        for &pfn in &moved {
+            free_user_page(PhysFrame::new(pfn));
+        }
+    }
+    NR_MIGRATED.fetch_add(moved.len(), Ordering::Relaxed);
+    if !complete {
+        NR_MIGRATE_FAIL.fetch_add(1, Ordering::Relaxed);
+    }
+    complete
+}
+
+/// 规整一个块 (compact_zone)
+///
+/// 成功时块中每页引用计数为 1，逐页释放
+fn compact_block(start: usize, nr: usize, movable: Vec<usize>) -> Option<PhysFrame> {
+    let mut captured = [0u64; BITMAP_WORDS];
+    let migrated = migrate_block(start, nr, movable, &mut captured);
+
+    // 迁移释放的旧页先回到空闲链表，再一起摘下
+    drain_all_pages();
+    let mut isolated = [0u64; BITMAP_WORDS];
+    isolate_free_frames(start, nr, &mut isolated);
+    let complete = migrated && (0..nr).all(|bit| test_bit(&isolated, bit) || test_bit(&captured, bit));
+    if !complete {
+        // 块中有页又被分配或迁移失败：摘下和留下的页都归还
+        for bit in 0..nr {
+            if test_bit(&isolated, bit) || test_bit(&captured, bit) {
+                dealloc_frame(PhysFrame::new(start + bit));
+            }
+        }
+        return None;
+    }
+
+    for pfn in start..start + nr {
+        let page = pfn_to_page(pfn);
+        unsafe {
+            (*page).set_refcount(1);
+            (*page).set_flag(PageFlag::Referenced);
+            (*page).set_page_type(PageType::Normal);
+        }
+    }
+    Some(PhysFrame::new(start))
+}
+
+/// 在已切出的区域中找块并规整
+fn compact_zone(nr: usize, align: usize) -> Option<PhysFrame> {
+    // 各 CPU 缓存中的空闲页回到空闲链表后才能认出来
+    drain_all_pages();
+    let (lo, hi) = allocated_frame_range();
+    let mut candidates: Vec<(usize, usize)> = Vec::new();
+    let mut start = (lo + align - 1) & !(align - 1);
+    while start + nr <= hi {
+        if let Some(movable) = scan_block(start, nr) {
+            if candidates.try_reserve(1).is_err() {
+                break;
+            }
+            candidates.push((movable.len(), start));
+        }
+        start += align;
+    }
+    // 需要迁移的页越少，越快、越可能成功
+    candidates.sort_unstable();
+    for &(_, start) in candidates.iter().take(COMPACT_MAX_ATTEMPTS) {
+        // 扫描之后块的内容可能已经变化，重新扫描
+        let movable = match scan_block(start, nr) {
+            Some(movable) => movable,
+            None => continue,
+        };
+        if let Some(frame) = compact_block(start, nr, movable) {
+            return Some(frame);
+        }
+    }
+    None
+}
+
+/// 取出 kcompactd 预先规整出的块，多出 nr 的页归还
+fn take_ready_block(nr: usize, align: usize) -> Option<PhysFrame> {
+    let start = READY_BLOCK.load(Ordering::Acquire);
+    if start == 0 || start & (align - 1) != 0 || READY_BLOCK.swap(0, Ordering::AcqRel) != start {
+        return None;
+    }
+    for pfn in start + nr..start + COMPACT_BLOCK_PAGES {
+        dealloc_frame(PhysFrame::new(pfn));
+    }
+    Some(PhysFrame::new(start))
+}
+
+/// 连续分配失败后同步规整 (try_to_compact_pages)
+///
+/// nr 最多 COMPACT_BLOCK_PAGES，align 为 2 的幂
+///
+/// # 返回
+/// 规整出的连续页帧，每页引用计数为 1；找不到可以规整的块时返回 None
+pub fn try_to_compact_pages(nr: usize, align: usize) -> Option<PhysFrame> {
+    if nr == 0 || nr > COMPACT_BLOCK_PAGES || !align.is_power_of_two() || align > COMPACT_BLOCK_PAGES {
+        return None;
+    }
+    if let Some(frame) = take_ready_block(nr, align) {
+        NR_COMPACT_SUCCESS.fetch_add(1, Ordering::Relaxed);
+        return Some(frame);
+    }
+    if COMPACTING.swap(true, Ordering::Acquire) {
+        return None;
+    }
+    NR_COMPACT_STALL.fetch_add(1, Ordering::Relaxed);
+    let frame = compact_zone(nr, align);
+    COMPACTING.store(false, Ordering::Release);
+    match frame {
+        Some(_) => NR_COMPACT_SUCCESS.fetch_add(1, Ordering::Relaxed),
+        None => {
+            KCOMPACTD_WAKE.store(true, Ordering::Release);
+            NR_COMPACT_FAIL.fetch_add(1, Ordering::Relaxed)
+        }
+    };
+    frame
+}
+
+/// 后台规整 (kcompactd)
+///
+/// 由 CPU 0 的空闲循环调用：最近有连续分配失败、空闲页高于高水位且没有预备块时，
+/// 规整出一个块留给下一次连续分配
+pub fn kcompactd_run() {
+    if !KCOMPACTD_WAKE.load(Ordering::Acquire) || READY_BLOCK.load(Ordering::Acquire) != 0 {
+        return;
+    }
+    let (_, _, high) = super::vmscan::watermarks();
+    if frame_stats().free_frames < high + COMPACT_BLOCK_PAGES {
+        return;
+    }
+    if COMPACTING.swap(true, Ordering::Acquire) {
+        return;
+    }
+    KCOMPACTD_WAKE.store(false, Ordering::Release);
+    NR_KCOMPACTD_RUNS.fetch_add(1, Ordering::Relaxed);
+    if let Some(frame) = compact_zone(COMPACT_BLOCK_PAGES, COMPACT_BLOCK_PAGES) {
+        READY_BLOCK.store(frame.number, Ordering::Release);
+    }
+    COMPACTING.store(false, Ordering::Release);
+}
+
+/// 页回收时归还预备块
+///
+/// # 返回
+/// 归还的页数
+pub fn release_ready_block() -> usize {
+    let start = READY_BLOCK.swap(0, Ordering::AcqRel);
+    if start == 0 {
+        return 0;
+    }
+    for pfn in start..start + COMPACT_BLOCK_PAGES {
+        dealloc_frame(PhysFrame::new(pfn));
+    }
+    COMPACT_BLOCK_PAGES
+}
+
+/// 规整统计 (/proc/vmstat)
+#[derive(Debug, Clone, Copy, Default)]
+pub struct CompactionStats {
+    pub compact_stall: usize,
+    pub compact_success: usize,
+    pub compact_fail: usize,
+    pub pgmigrate_success: usize,
+    pub pgmigrate_fail: usize,
+    pub kcompactd_runs: usize,
+    /// 预备块的页数
+    pub ready_pages: usize,
+}
+
+/// 获取规整统计
+pub fn compaction_stats() -> CompactionStats {
+    CompactionStats {
+        compact_stall: NR_COMPACT_STALL.load(Ordering::Relaxed),
+        compact_success: NR_COMPACT_SUCCESS.load(Ordering::Relaxed),
+        compact_fail: NR_COMPACT_FAIL.load(Ordering::Relaxed),
+        pgmigrate_success: NR_MIGRATED.load(Ordering::Relaxed),
+        pgmigrate_fail: NR_MIGRATE_FAIL.load(Ordering::Relaxed),
+        kcompactd_runs: NR_KCOMPACTD_RUNS.load(Ordering::Relaxed),
+        ready_pages: if READY_BLOCK.load(Ordering::Relaxed) != 0 { COMPACT_BLOCK_PAGES } else { 0 },
+    }
+}
@@ -0,0 +1,1001 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 文件页缓存 (page cache)
+//!
+//! 参考 Linux: mm/filemap.c (filemap_fault, filemap_map_pages, find_get_page)
+//!
+//! 文件映射（ELF 代码段等）的页不再在 exec 时复制一份私有副本，
+//! 而是按 (文件, 页偏移) 缓存，所有进程映射同一个物理页。
+//!
+//! # 设计
+//! - 每个文件对应一个 FileMapping (struct address_space)，以 mapping_key(设备号, inode 号)
+//!   登记在全局 MAPPINGS 中；VMA 只记录这个键，保持 Vma 为 Copy
+//! - 页按页偏移存放在基数树 (XArray, i_pages) 中
+//! - read()/write() 是文件读写的缓冲路径 (filemap_read / generic_perform_write)：
+//!   ext4 和 rootfs 的 read/write 都经过页缓存，重复读取只是从缓存页复制，
+//!   mmap 映射的也是同一批物理页
+//! - 缓存页的 refcount 中包含页缓存自身的一个引用，每个映射再各持一个引用，
+//!   因此写时复制总是复制而不会改写缓存页
+//! - 缺页时按 FAULT_AROUND_PAGES 对齐的窗口一次映射相邻页 (fault-around)
+//! - 顺序访问 (MADV_SEQUENTIAL) 的映射在缺页时向后预读 READAHEAD_PAGES 页，
+//!   随机访问 (MADV_RANDOM) 的映射不做 fault-around；MADV_WILLNEED 直接预读
+//! - read() 的预读由每个打开文件的 FileRaState 驱动 (mm/readahead.c)：顺序读取时窗口
+//!   逐次放大到 RA_MAX_PAGES，读到上一窗口的起点就读入下一窗口，随机读取只读请求本身；
+//!   posix_fadvise 可以设置访问模式。连续未缓存的页交给数据来源一次读入 (read_pages)，
+//!   ext4 据此把物理连续的块合并成一个块设备请求
+//! - 缓存页挂在页回收的 LRU 链表上 (vmscan)，Page 的 mapping/index 指回所属的
+//!   FileMapping 和页偏移；只被页缓存引用的页可以回收，之后缺页时从数据来源重新读入
+//! - FileMapping 登记后只有在不再缓存任何页时才会注销 (remove_mapping)，Page 中的 mapping 指针因此始终有效
+//! - 没有后备存储的数据来源（tmpfs）的页不可驱逐：不进入 LRU，只在截断 (truncate_pages) 时释放
+//! - write() 只更新已缓存的页，数据来源自己写回；write_dirty() 是延迟写：数据留在缓存页中，
+//!   页标记为脏并记入 dirty 集合，之后由回写 (writeback) 按连续的页段交给数据来源的
+//!   write_pages。脏页不会被回收
+//! - 可以回写的页缓存 (can_writeback，ext4) 的共享可写映射先只读映射，第一次写入时缺页、
+//!   页标记为脏后才可写 (page_mkwrite)；msync 和解除映射把可写页表项写过的页转为脏页，
+//!   msync 写保护后回写。没有后备存储或不能回写的页缓存（tmpfs、rootfs）直接可写映射
+
+use alloc::collections::{BTreeMap, BTreeSet};
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicI32, AtomicU64, AtomicUsize, Ordering};
+use spin::Mutex;
+
+use super::page::{PhysFrame, PAGE_SIZE};
+use super::xarray::XArray;
+use super::page_desc::{pfn_to_page, PageType};
+use super::memcontrol::{mem_cgroup_alloc_page, MemcgStat};
+use super::pcp::free_user_page;
+use super::vmscan;
+use super::writeback;
+
+/// 每次缺页映射的页数（fault_around_bytes = 64KB）
+pub const FAULT_AROUND_PAGES: usize = 16;
+
+/// 预读窗口的页数 (VM_READAHEAD_PAGES = 128KB)
+pub const READAHEAD_PAGES: usize = 32;
+
+/// read() 预读窗口的上限 (bdi->ra_pages = 256KB)，POSIX_FADV_SEQUENTIAL 时加倍
+pub const RA_MAX_PAGES: usize = 64;
+
+/// posix_fadvise 的建议类型
+pub mod fadvise {
+    pub const POSIX_FADV_NORMAL: i32 = 0;
+    pub const POSIX_FADV_RANDOM: i32 = 1;
+    pub const POSIX_FADV_SEQUENTIAL: i32 = 2;
+    pub const POSIX_FADV_WILLNEED: i32 = 3;
+    pub const POSIX_FADV_DONTNEED: i32 = 4;
+    pub const POSIX_FADV_NOREUSE: i32 = 5;
+}
+
+/// 打开文件的访问模式 (FMODE_RANDOM, POSIX_FADV_SEQUENTIAL)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum RaMode {
+    Normal,
+    Sequential,
+    Random,
+}
+
+/// 每个打开文件的预读状态 (struct file_ra_state)
+///
+/// 当前窗口为 [start, start + size)，其中最后 async_size 页是预读出来、还没被读到的部分；
+/// 读到 start + size - async_size（异步预读标记页）时推进到下一窗口
+#[derive(Debug, Clone, Copy)]
+pub struct FileRaState {
+    pub start: usize,
+    pub size: usize,
+    pub async_size: usize,
+    /// 上次读到的最后一页，usize::MAX 表示还没有读过
+    pub prev_index: usize,
+    pub mode: RaMode,
+}
+
+impl FileRaState {
+    pub const fn new() -> Self {
+        Self { start: 0, size: 0, async_size: 0, prev_index: usize::MAX, mode: RaMode::Normal }
+    }
+
+    /// 窗口上限
+    fn max_pages(&self) -> usize {
+        match self.mode {
+            RaMode::Sequential => RA_MAX_PAGES * 2,
+            _ => RA_MAX_PAGES,
+        }
+    }
+
+    /// 第一个窗口的大小：小请求放大 4 倍，中等请求 2 倍 (get_init_ra_size)
+    fn init_size(&self, nr: usize) -> usize {
+        let max = self.max_pages();
+        if self.mode == RaMode::Sequential {
+            return max;
+        }
+        let size = nr.next_power_of_two();
+        if size <= max / 32 {
+            size * 4
+        } else if size <= max / 4 {
+            size * 2
+        } else {
+            max
+        }
+    }
+
+    /// 下一个窗口的大小：小窗口 4 倍增长，之后 2 倍，不超过上限 (get_next_ra_size)
+    fn next_size(&self) -> usize {
+        let max = self.max_pages();
+        let size = if self.size < max / 16 { self.size * 4 } else { self.size * 2 };
+        size.clamp(1, max)
+    }
+
+    /// 丢弃当前窗口，下次读取重新判断访问模式
+    pub fn reset(&mut self) {
+        self.start = 0;
+        self.size = 0;
+        self.async_size = 0;
+        self.prev_index = usize::MAX;
+    }
+
+    /// 读取 [index, index + nr) 页前更新窗口 (ondemand_readahead)
+    ///
+    /// # 返回
+    /// 需要确保在页缓存中的范围 (起始页, 页数)，覆盖请求本身
+    pub fn ondemand(&mut self, index: usize, nr: usize) -> (usize, usize) {
+        let nr = nr.max(1);
+        let last = index + nr - 1;
+
+        if self.mode == RaMode::Random {
+            self.start = index;
+            self.size = nr;
+            self.async_size = 0;
+            self.prev_index = last;
+            return (index, nr);
+        }
+
+        // 从文件开头读、紧接上次读取或仍在上次的页内都算顺序访问
+        let sequential = if self.prev_index == usize::MAX {
+            index == 0
+        } else {
+            index == self.prev_index || index == self.prev_index + 1
+        };
+        // 上一窗口推进后，顺序读取仍会读到新窗口之前已预读的页
+        let end = self.start + self.size;
+        let in_window = self.size != 0 && index <= end && (sequential || index >= self.start);
+
+        if in_window {
+            // 读到异步预读标记页：预读下一窗口，窗口放大，直到覆盖请求
+            if last >= end - self.async_size {
+                loop {
+                    self.start += self.size;
+                    self.size = self.next_size();
+                    self.async_size = self.size;
+                    if last < self.start + self.size {
+                        break;
+                    }
+                }
+            }
+        } else if sequential {
+            self.start = index;
+            self.size = self.init_size(nr).max(nr);
+            self.async_size = self.size - nr;
+        } else {
+            // 随机访问：窗口收缩为请求本身
+            self.start = index;
+            self.size = nr;
+            self.async_size = 0;
+        }
+        self.prev_index = last;
+        (index, self.start + self.size - index)
+    }
+}
+
+impl Default for FileRaState {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// 页缓存的数据来源 (address_space_operations)
+pub trait MappingSource: Send + Sync {
+    /// 文件大小（字节）
+    fn size(&self) -> usize;
+
+    /// 读取第 index 页到 buf，超出文件末尾的部分由调用者清零 (read_folio)
+    ///
+    /// # 返回
+    /// 实际读取的字节数
+    fn read_page(&self, index: usize, buf: &mut [u8]) -> usize;
+
+    /// 第 index 页的数据本身就是一个完整的物理页时返回它的地址（initramfs 中页对齐的文件），
+    /// 页缓存直接引用该页而不复制；这种页不进入 LRU，也不会被回收或释放
+    fn direct_page(&self, index: usize) -> Option<usize> {
+        let _ = index;
+        None
+    }
+
+    /// 页缓存是数据唯一的存放处、没有后备存储时返回 true (mapping_unevictable)
+    ///
+    /// 这种页不进入 LRU，不会被回收或被 POSIX_FADV_DONTNEED 丢弃，只在截断时释放
+    fn unevictable(&self) -> bool {
+        false
+    }
+
+    /// 经共享可写映射写入的页需要标记为脏并回写时返回 true (mapping_can_writeback)
+    ///
+    /// 返回 false 的数据来源的共享映射直接映射为可写，写入只留在缓存页中
+    fn can_writeback(&self) -> bool {
+        false
+    }
+
+    /// 后备设备标识，脏页和回写完成按它统计 (inode_to_bdi)
+    ///
+    /// 0 表示没有独立的后备设备
+    fn bdi_id(&self) -> u64 {
+        0
+    }
+
+    /// 页缓存中的页数变化了 delta，在页缓存锁内调用 (shmem_recalc_inode)
+    fn acct_pages(&self, delta: isize) {
+        let _ = delta;
+    }
+
+    /// 读取从第 index 页开始的连续多页到 buf（长度为页大小的整数倍），
+    /// 数据来源可以把它们合并成一次块设备请求 (readahead)
+    ///
+    /// # 返回
+    /// 从 buf 开头起连续读到的字节数
+    fn read_pages(&self, index: usize, buf: &mut [u8]) -> usize {
+        let mut done = 0;
+        for (i, chunk) in buf.chunks_mut(PAGE_SIZE).enumerate() {
+            let read = self.read_page(index + i, chunk);
+            done += read;
+            if read < chunk.len() {
+                break;
+            }
+        }
+        done
+    }
+
+    /// 回写从第 index 页开始的连续脏页 (writepages)
+    ///
+    /// pages 为各页的物理地址，回写期间调用者持有它们的引用。
+    /// 只读的数据来源不会产生脏页，默认返回 EROFS
+    fn write_pages(&self, index: usize, pages: &[usize]) -> Result<(), i32> {
+        let _ = (index, pages);
+        Err(-30)  // EROFS
+    }
+}
+
+/// 一次交给 write_pages 的最多页数 (MAX_WRITEBACK_PAGES = 1MB)
+pub const WB_MAX_PAGES: usize = 256;
+
+/// 文件的页缓存 (struct address_space)
+pub struct FileMapping {
+    /// 页缓存的键 (mapping_key)
+    ino: u64,
+    /// 数据来源
+    source: Arc<dyn MappingSource>,
+    /// 数据来源所在的后备设备 (inode_to_bdi)
+    bdi: Arc<writeback::BdiWriteback>,
+    /// 页偏移 -> 物理地址 (i_pages)
+    pages: Mutex<XArray>,
+    /// 脏页的页偏移 (PAGECACHE_TAG_DIRTY)
+    ///
+    /// 锁顺序：dirty -> pages
+    dirty: Mutex<BTreeSet<usize>>,
+    /// 第一页变脏的时刻 (jiffies)，干净时为 0 (inode->dirtied_when)
+    dirtied_when: AtomicU64,
+    /// 最近一次回写错误，由 fsync 取走并报告 (mapping->wb_err)
+    wb_err: AtomicI32,
+}
+
+impl FileMapping {
+    /// 页缓存的键，VMA 用它找回页缓存
+    #[inline]
+    pub fn ino(&self) -> u64 {
+        self.ino
+    }
+
+    /// 文件大小（字节）
+    #[inline]
+    pub fn size(&self) -> usize {
+        self.source.size()
+    }
+
+    /// 文件占用的页数
+    #[inline]
+    pub fn nr_file_pages(&self) -> usize {
+        (self.source.size() + PAGE_SIZE - 1) / PAGE_SIZE
+    }
+
+    /// 共享可写映射是否需要跟踪脏页 (mapping_can_writeback)
+    #[inline]
+    pub fn can_writeback(&self) -> bool {
+        self.source.can_writeback()
+    }
+
+    /// 已缓存的页数
+    pub fn nr_cached(&self) -> usize {
+        self.pages.lock().len()
+    }
+
+    /// [start, end) 中已缓存的页数
+    pub fn nr_cached_range(&self, start: usize, end: usize) -> usize {
+        let mut nr = 0;
+        self.pages.lock().for_each_range(start, end, |_, _| nr += 1);
+        nr
+    }
+
+    /// 脏页数
+    pub fn nr_dirty(&self) -> usize {
+        self.dirty.lock().len()
+    }
+
+    /// 所在的后备设备
+    pub fn bdi(&self) -> &writeback::BdiWriteback {
+        &self.bdi
+    }
+
+    /// 第一页变脏的时刻 (jiffies)，干净时为 0
+    #[inline]
+    pub fn dirtied_when(&self) -> u64 {
+        self.dirtied_when.load(Ordering::Acquire)
+    }
+
+    /// 查找已缓存的页 (find_get_page)
+    pub fn find_page(&self, index: usize) -> Option<usize> {
+        self.pages.lock().load(index)
+    }
+
+    /// 查找页，未缓存时从数据来源读入 (filemap_fault)
+    ///
+    /// 返回的页可能随时被回收，需要长期使用时改用 grab_page
+    ///
+    /// # 返回
+    /// 页的物理地址；超出文件末尾或内存不足时返回 None
+    pub fn find_or_read_page(&self, index: usize) -> Option<usize> {
+        self.lookup_or_read(index, false)
+    }
+
+    /// 查找或读入页，并为调用者增加一个引用 (find_get_page)
+    ///
+    /// 引用在页缓存锁内获取，持有引用期间页不会被回收；映射该页时引用交给页表项，
+    /// 否则用完后调用 put_page 释放
+    pub fn grab_page(&self, index: usize) -> Option<usize> {
+        self.lookup_or_read(index, true)
+    }
+
+    /// 把 [index, index + nr) 中尚未缓存的页读入页缓存 (page_cache_ra_unbounded)
+    ///
+    /// 连续未缓存的页每 RA_MAX_PAGES 页一批交给数据来源。
+    /// 不增加引用，也不算作访问；到达文件末尾、读取失败或内存不足时停止
+    ///
+    /// # 返回
+    /// 新读入的页数
+    pub fn readahead(&self, index: usize, nr: usize) -> usize {
+        let end = index.saturating_add(nr).min(self.nr_file_pages());
+        let mut read = 0;
+        let mut i = index;
+        while i < end {
+            let run_end = {
+                let pages = self.pages.lock();
+                if pages.load(i).is_some() {
+                    i += 1;
+                    continue;
+                }
+                let mut run_end = i + 1;
+                while run_end < end && run_end - i < RA_MAX_PAGES && pages.load(run_end).is_none() {
+                    run_end += 1;
+                }
+                run_end
+            };
+            let added = self.read_run(i, run_end - i);
+            read += added;
+            if added == 0 {
+                break;
+            }
+            i = run_end;
+        }
+        read
+    }
+
+    /// 一次读入 nr 个连续页并加入页缓存 (read_pages)
+    ///
+    /// 读盘不持有页缓存锁；期间已被其他路径缓存的页保留原来的
+    ///
+    /// # 返回
+    /// 加入页缓存的页数
+    fn read_run(&self, index: usize, nr: usize) -> usize {
+        if nr == 1 {
+            return self.lookup_or_read(index, false).is_some() as usize;
+        }
+        if self.source.direct_page(index).is_some() {
+            // 直接引用的页不需要读盘，逐页加入
+            return (index..index + nr).filter(|&i| self.lookup_or_read(i, false).is_some()).count();
+        }
+        let mut buf = Vec::new();
+        if buf.try_reserve_exact(nr * PAGE_SIZE).is_err() {
+            return self.lookup_or_read(index, false).is_some() as usize;
+        }
+        buf.resize(nr * PAGE_SIZE, 0u8);
+        let read = self.source.read_pages(index, &mut buf);
+
+        // 读取提前结束时只缓存完整读到的页，文件末尾的页除外
+        let expected = self.source.size().saturating_sub(index * PAGE_SIZE).min(buf.len());
+        let valid = if read >= expected {
+            (expected + PAGE_SIZE - 1) / PAGE_SIZE
+        } else {
+            read / PAGE_SIZE
+        };
+
+        let mut added = 0;
+        for (i, chunk) in buf.chunks(PAGE_SIZE).take(valid).enumerate() {
+            let frame = match mem_cgroup_alloc_page(MemcgStat::File) {
+                Some(frame) => frame,
+                None => break,
+            };
+            let phys = frame.start_address().as_usize();
+            unsafe {
+                core::ptr::copy_nonoverlapping(chunk.as_ptr(), phys as *mut u8, PAGE_SIZE);
+            }
+            let mut pages = self.pages.lock();
+            if pages.load(index + i).is_some() {
+                drop(pages);
+                free_user_page(frame);
+                continue;
+            }
+            self.add_page(&mut pages, index + i, phys, false);
+            added += 1;
+        }
+        added
+    }
+
+    /// 经页缓存读取文件内容 (filemap_read)
+    ///
+    /// 未缓存的页从数据来源读入并留在缓存中，之后的读取直接从缓存页复制
+    ///
+    /// # 返回
+    /// 读取的字节数，到文件末尾为止；内存不足时返回已读取的部分
+    pub fn read(&self, offset: usize, buf: &mut [u8]) -> usize {
+        let size = self.source.size();
+        if offset >= size {
+            return 0;
+        }
+        let end = size.min(offset.saturating_add(buf.len()));
+        let mut pos = offset;
+        while pos < end {
+            // 复制期间持有引用，页不会被回收
+            let phys = match self.grab_page(pos / PAGE_SIZE) {
+                Some(phys) => phys,
+                None => break,
+            };
+            let in_page = pos % PAGE_SIZE;
+            let len = (PAGE_SIZE - in_page).min(end - pos);
+            unsafe {
+                core::ptr::copy_nonoverlapping(
+                    (phys + in_page) as *const u8,
+                    buf[pos - offset..].as_mut_ptr(),
+                    len,
+                );
+                (*pfn_to_page(phys / PAGE_SIZE)).put_page();
+            }
+            pos += len;
+            // 读入大文件（如 execve 复制段）时逐页给其他任务运行的机会
+            crate::sched::cond_resched();
+        }
+        pos - offset
+    }
+
+    /// 按打开文件的预读状态读取 (filemap_read + page_cache_sync_readahead)
+    ///
+    /// 先把请求和预读窗口覆盖的页成批读入，再从缓存页复制
+    pub fn read_ra(&self, offset: usize, buf: &mut [u8], ra: &mut FileRaState) -> usize {
+        let size = self.source.size();
+        if offset >= size || buf.is_empty() {
+            return 0;
+        }
+        let end = size.min(offset.saturating_add(buf.len()));
+        let first = offset / PAGE_SIZE;
+        let nr = (end - 1) / PAGE_SIZE - first + 1;
+        let (start, len) = ra.ondemand(first, nr);
+        self.readahead(start, len);
+        self.read(offset, buf)
+    }
+
+    /// 丢弃 [start, end) 中只被页缓存引用的页 (invalidate_mapping_pages)
+    ///
+    /// # 返回
+    /// 释放的页数
+    pub fn invalidate_range(&self, start: usize, end: usize) -> usize {
+        let mut victims = Vec::new();
+        self.pages
+            .lock()
+            .for_each_range(start, end, |index, phys| victims.push((index, phys / PAGE_SIZE)));
+        victims
+            .into_iter()
+            .filter(|&(index, pfn)| self.remove_page(index, pfn))
+            .count()
+    }
+
+    /// 把写入文件的数据复制到已缓存的页，保持 read 和 mmap 看到的内容与文件一致
+    ///
+    /// 未缓存的页不读入，之后访问时从数据来源读到新内容
+    pub fn write(&self, offset: usize, data: &[u8]) {
+        let end = offset + data.len();
+        let pages = self.pages.lock();
+        pages.for_each_range(offset / PAGE_SIZE, (end + PAGE_SIZE - 1) / PAGE_SIZE, |index, phys| {
+            let page_start = index * PAGE_SIZE;
+            let from = offset.max(page_start);
+            let to = end.min(page_start + PAGE_SIZE);
+            unsafe {
+                core::ptr::copy_nonoverlapping(
+                    data.as_ptr().add(from - offset),
+                    (phys + (from - page_start)) as *mut u8,
+                    to - from,
+                );
+            }
+        });
+    }
+
+    /// 延迟写：把数据写入缓存页并标记为脏，不访问数据来源的存储 (generic_perform_write)
+    ///
+    /// 调用者先把文件大小扩展到 offset + data.len()；部分覆盖的页先从数据来源读入。
+    /// 脏页过多时按新弄脏的页数限速写入者 (balance_dirty_pages)
+    ///
+    /// # 返回
+    /// 写入的字节数，内存不足时返回已写入的部分
+    pub fn write_dirty(&self, offset: usize, data: &[u8]) -> usize {
+        let end = offset + data.len();
+        let mut pos = offset;
+        let mut nr_dirtied = 0;
+        while pos < end {
+            let index = pos / PAGE_SIZE;
+            // 复制期间持有引用，页不会被回收
+            let phys = match self.grab_page(index) {
+                Some(phys) => phys,
+                None => break,
+            };
+            let in_page = pos % PAGE_SIZE;
+            let len = (PAGE_SIZE - in_page).min(end - pos);
+            unsafe {
+                core::ptr::copy_nonoverlapping(
+                    data[pos - offset..].as_ptr(),
+                    (phys + in_page) as *mut u8,
+                    len,
+                );
+            }
+            if self.set_page_dirty(index, phys) {
+                nr_dirtied += 1;
+            }
+            unsafe { (*pfn_to_page(phys / PAGE_SIZE)).put_page() };
+            pos += len;
+        }
+        if nr_dirtied > 0 {
+            writeback::balance_dirty_pages(self, nr_dirtied);
+        }
+        pos - offset
+    }
+
+    /// 标记缓存页为脏 (folio_mark_dirty)
+    ///
+    /// 文件的第一个脏页把文件登记到回写链表
+    ///
+    /// # 返回
+    /// 页原来是干净的时返回 true
+    fn set_page_dirty(&self, index: usize, phys: usize) -> bool {
+        let mut dirty = self.dirty.lock();
+        if !dirty.insert(index) {
+            return false;
+        }
+        let page = pfn_to_page(phys / PAGE_SIZE);
+        if !page.is_null() {
+            unsafe { (*page).set_flag(super::page_desc::PageFlag::Dirty) };
+        }
+        NR_FILE_DIRTY.fetch_add(1, Ordering::Relaxed);
+        self.bdi.inc_dirty();
+        if dirty.len() == 1 {
+            self.dirtied_when
+                .store(crate::drivers::timer::get_jiffies().max(1), Ordering::Release);
+            drop(dirty);
+            writeback::mark_mapping_dirty(self.ino);
+        }
+        true
+    }
+
+    /// 回写所有脏页 (do_writepages)
+    ///
+    /// 按页偏移顺序取出连续的脏页段，先清除脏标志再交给数据来源 (folio_clear_dirty_for_io)，
+    /// 回写期间再次写入的页重新变脏、下次回写。回写失败的页不再保持为脏，
+    /// 错误记录下来由 fsync 报告 (mapping_set_error)
+    ///
+    /// # 返回
+    /// 回写的页数；有回写失败时返回第一个错误
+    pub fn writeback(&self) -> Result<usize, i32> {
+        self.writeback_range(0, usize::MAX)
+    }
+
+    /// 回写页偏移在 [start, end) 内的脏页 (filemap_write_and_wait_range)
+    ///
+    /// 直接 I/O 前调用，设备上的数据不比页缓存旧
+    pub fn writeback_range(&self, start: usize, end: usize) -> Result<usize, i32> {
+        let mut written = 0;
+        let mut first_err = 0;
+        loop {
+            let (index, run) = {
+                let mut dirty = self.dirty.lock();
+                let first = match dirty.range(start..end).next() {
+                    Some(&index) => index,
+                    None => break,
+                };
+                let pages = self.pages.lock();
+                let mut run = Vec::new();
+                while run.len() < WB_MAX_PAGES && first + run.len() < end && dirty.remove(&(first + run.len())) {
+                    // 脏页不会被回收，一定还在缓存中
+                    let phys = match pages.load(first + run.len()) {
+                        Some(phys) => phys,
+                        None => {
+                            NR_FILE_DIRTY.fetch_sub(1, Ordering::Relaxed);
+                            self.bdi.dec_dirty();
+                            break;
+                        }
+                    };
+                    let page = pfn_to_page(phys / PAGE_SIZE);
+                    if !page.is_null() {
+                        unsafe {
+                            (*page).clear_flag(super::page_desc::PageFlag::Dirty);
+                            (*page).get_page();
+                        }
+                    }
+                    NR_FILE_DIRTY.fetch_sub(1, Ordering::Relaxed);
+                    self.bdi.dec_dirty();
+                    run.push(phys);
+                }
+                if dirty.is_empty() {
+                    self.dirtied_when.store(0, Ordering::Release);
+                }
+                (first, run)
+            };
+            if run.is_empty() {
+                continue;
+            }
+
+            match self.source.write_pages(index, &run) {
+                Ok(()) => written += run.len(),
+                Err(e) => {
+                    self.wb_err.store(e, Ordering::Release);
+                    if first_err == 0 {
+                        first_err = e;
+                    }
+                }
+            }
+            for &phys in run.iter() {
+                unsafe { (*pfn_to_page(phys / PAGE_SIZE)).put_page() };
+            }
+        }
+        self.bdi.account_written(written);
+        if first_err != 0 {
+            Err(first_err)
+        } else {
+            Ok(written)
+        }
+    }
+
+    /// 取走最近一次回写错误 (file_check_and_advance_wb_err)
+    ///
+    /// # 返回
+    /// 负错误码，没有错误时为 0
+    pub fn take_wb_error(&self) -> i32 {
+        self.wb_err.swap(0, Ordering::AcqRel)
+    }
+
+    fn lookup_or_read(&self, index: usize, get: bool) -> Option<usize> {
+        if index >= self.nr_file_pages() {
+            return None;
+        }
+
+        let mut pages = self.pages.lock();
+        if let Some(phys) = pages.load(index) {
+            let page = pfn_to_page(phys / PAGE_SIZE);
+            if get && !page.is_null() {
+                unsafe { (*page).get_page() };
+            }
+            vmscan::mark_page_accessed(phys / PAGE_SIZE);
+            return Some(phys);
+        }
+
+        if let Some(phys) = self.source.direct_page(index) {
+            self.add_direct_page(&mut pages, index, phys, get);
+            return Some(phys);
+        }
+
+        let frame = mem_cgroup_alloc_page(MemcgStat::File)?;
+        let phys = frame.start_address().as_usize();
+        let buf = unsafe { core::slice::from_raw_parts_mut(phys as *mut u8, PAGE_SIZE) };
+        let read = self.source.read_page(index, buf);
+        buf[read.min(PAGE_SIZE)..].fill(0);
+
+        self.add_page(&mut pages, index, phys, get);
+        Some(phys)
+    }
+
+    /// 把已读入数据的新页加入页缓存 (filemap_add_folio)
+    ///
+    /// 页缓存自身持有一个引用（prep_new_page 设置的初始引用），get 时再为调用者加一个
+    fn add_page(&self, pages: &mut XArray, index: usize, phys: usize, get: bool) {
+        let page = pfn_to_page(phys / PAGE_SIZE);
+        if !page.is_null() {
+            unsafe {
+                (*page).set_flag(super::page_desc::PageFlag::UpToDate);
+                (*page).set_page_type(PageType::PageCache);
+                (*page).set_mapping(self as *const FileMapping as *mut core::ffi::c_void);
+                (*page).set_index(index);
+                if get {
+                    (*page).get_page();
+                }
+            }
+        }
+
+        pages.store(index, phys);
+        NR_FILE_PAGES.fetch_add(1, Ordering::Relaxed);
+        self.source.acct_pages(1);
+        if self.source.unevictable() {
+            if !page.is_null() {
+                unsafe { (*page).set_flag(super::page_desc::PageFlag::Unevictable) };
+            }
+        } else {
+            vmscan::lru_cache_add(phys / PAGE_SIZE);
+        }
+    }
+
+    /// 把调用者分配的 nr 个已清零的页作为 [index, index + nr) 加入页缓存 (shmem_add_to_page_cache)
+    ///
+    /// 用于一次加入一个物理连续的大页；已经缓存的页偏移保留原来的页，
+    /// 对应的新页直接释放。新页的初始引用成为页缓存自身的引用
+    ///
+    /// # 返回
+    /// 加入页缓存的页数
+    pub fn add_new_pages(&self, index: usize, phys: usize, nr: usize) -> usize {
+        let mut pages = self.pages.lock();
+        let mut added = 0;
+        for i in 0..nr {
+            let page_phys = phys + i * PAGE_SIZE;
+            if pages.load(index + i).is_some() {
+                free_user_page(PhysFrame::new(page_phys / PAGE_SIZE));
+                continue;
+            }
+            self.add_page(&mut pages, index + i, page_phys, false);
+            added += 1;
+        }
+        added
+    }
+
+    /// 从页缓存删除页偏移不小于 start 的所有页 (truncate_inode_pages_range)
+    ///
+    /// 不论页是否脏、是否仍被映射都删除：页缓存放下自己的引用，映射中的页随页表项一起释放，
+    /// 之后的缺页按新的文件大小处理。直接引用的页不由分配器管理，只从缓存中摘除
+    ///
+    /// # 返回
+    /// 删除的页数
+    pub fn truncate_pages(&self, start: usize) -> usize {
+        use super::page_desc::PageFlag;
+
+        let mut dirty = self.dirty.lock();
+        let mut pages = self.pages.lock();
+        let mut victims = Vec::new();
+        pages.for_each_range(start, usize::MAX, |index, phys| victims.push((index, phys)));
+        for &(index, phys) in victims.iter() {
+            pages.erase(index);
+            NR_FILE_PAGES.fetch_sub(1, Ordering::Relaxed);
+            if dirty.remove(&index) {
+                NR_FILE_DIRTY.fetch_sub(1, Ordering::Relaxed);
+                self.bdi.dec_dirty();
+            }
+            let pfn = phys / PAGE_SIZE;
+            vmscan::lru_cache_del(pfn);
+            let page = pfn_to_page(pfn);
+            if page.is_null() {
+                continue;
+            }
+            unsafe {
+                (*page).clear_flag(PageFlag::Dirty);
+                (*page).set_mapping(core::ptr::null_mut());
+                (*page).set_page_type(PageType::Normal);
+                if (*page).is_reserved() {
+                    continue;
+                }
+                (*page).clear_flag(PageFlag::Unevictable);
+                if (*page).put_page() == 0 {
+                    free_user_page(PhysFrame::new(pfn));
+                }
+            }
+        }
+        if dirty.is_empty() {
+            self.dirtied_when.store(0, Ordering::Release);
+        }
+        if !victims.is_empty() {
+            self.source.acct_pages(-(victims.len() as isize));
+        }
+        victims.len()
+    }
+
+    /// 把数据来源直接提供的物理页加入页缓存
+    ///
+    /// 页不来自分配器：引用计数从页缓存的一个引用开始，标记为保留且不可驱逐，
+    /// 不进入 LRU，因此既不会被回收，映射全部解除后也不会被释放
+    fn add_direct_page(&self, pages: &mut XArray, index: usize, phys: usize, get: bool) {
+        let page = pfn_to_page(phys / PAGE_SIZE);
+        if !page.is_null() {
+            unsafe {
+                (*page).set_refcount(if get { 2 } else { 1 });
+                (*page).set_flag(super::page_desc::PageFlag::Reserved);
+                (*page).set_flag(super::page_desc::PageFlag::Unevictable);
+                (*page).set_flag(super::page_desc::PageFlag::UpToDate);
+                (*page).set_page_type(PageType::PageCache);
+                (*page).set_mapping(self as *const FileMapping as *mut core::ffi::c_void);
+                (*page).set_index(index);
+            }
+        }
+
+        pages.store(index, phys);
+        NR_FILE_PAGES.fetch_add(1, Ordering::Relaxed);
+        self.source.acct_pages(1);
+    }
+
+    /// 删除只被页缓存引用的页并释放 (remove_mapping)
+    ///
+    /// 拿不到页缓存锁（调用者可能正持有它分配内存）、页仍被使用或不可驱逐时返回 false
+    fn remove_page(&self, index: usize, pfn: usize) -> bool {
+        let mut pages = match self.pages.try_lock() {
+            Some(pages) => pages,
+            None => return false,
+        };
+        if pages.load(index) != Some(pfn * PAGE_SIZE) {
+            return false;
+        }
+        // 脏页是数据的唯一副本，回写前不能丢弃
+        let page = pfn_to_page(pfn);
+        if page.is_null()
+            || unsafe {
+                (*page).refcount() != 1
+                    || (*page).is_dirty()
+                    || (*page).test_flag(super::page_desc::PageFlag::Unevictable)
+            }
+        {
+            return false;
+        }
+
+        pages.erase(index);
+        NR_FILE_PAGES.fetch_sub(1, Ordering::Relaxed);
+        self.source.acct_pages(-1);
+        vmscan::lru_cache_del(pfn);
+        unsafe {
+            (*page).set_mapping(core::ptr::null_mut());
+            (*page).set_page_type(PageType::Normal);
+        }
+        free_user_page(PhysFrame::new(pfn));
+        true
+    }
+}
+
+/// 回收一个页缓存页，由 vmscan 调用
+///
+/// # 返回
+/// 页已释放时返回 true
+pub(super) fn try_remove_cached_page(pfn: usize) -> bool {
+    let page = pfn_to_page(pfn);
+    if page.is_null() {
+        return false;
+    }
+    let mapping = unsafe { (*page).mapping() } as *const FileMapping;
+    if mapping.is_null() {
+        return false;
+    }
+    unsafe { (*mapping).remove_page((*page).index(), pfn) }
+}
+
+/// 把经共享可写映射写过的缓存页标记为脏 (folio_mark_dirty)
+///
+/// 页表项被清除或写保护时由调用者传入页号；不是缓存页或页缓存不能回写时什么也不做
+pub fn set_mapped_page_dirty(pfn: usize) {
+    let page = pfn_to_page(pfn);
+    if page.is_null() || unsafe { (*page).page_type() } != PageType::PageCache {
+        return;
+    }
+    let mapping = unsafe { (*page).mapping() } as *const FileMapping;
+    if mapping.is_null() {
+        return;
+    }
+    unsafe {
+        if (*mapping).can_writeback() {
+            (*mapping).set_page_dirty((*page).index(), pfn * PAGE_SIZE);
+        }
+    }
+}
+
+/// inode 号 -> 页缓存
+static MAPPINGS: Mutex<BTreeMap<u64, Arc<FileMapping>>> = Mutex::new(BTreeMap::new());
+
+/// 页缓存中的页总数 (NR_FILE_PAGES)
+static NR_FILE_PAGES: AtomicUsize = AtomicUsize::new(0);
+
+/// 页缓存中的脏页数 (NR_FILE_DIRTY)
+static NR_FILE_DIRTY: AtomicUsize = AtomicUsize::new(0);
+
+/// 页缓存中的脏页数
+pub fn nr_file_dirty() -> usize {
+    NR_FILE_DIRTY.load(Ordering::Relaxed)
+}
+
+/// 获取文件的页缓存，不存在时以 source 为数据来源创建
+pub fn get_mapping(ino: u64, source: Arc<dyn MappingSource>) -> Arc<FileMapping> {
+    MAPPINGS
+        .lock()
+        .entry(ino)
+        .or_insert_with(|| {
+            Arc::new(FileMapping {
+                ino,
+                bdi: writeback::get_bdi(source.bdi_id()),
+                source,
+                pages: Mutex::new(XArray::new()),
+                dirty: Mutex::new(BTreeSet::new()),
+                dirtied_when: AtomicU64::new(0),
+                wb_err: AtomicI32::new(0),
+            })
+        })
+        .clone()
+}
+
+/// 查找已登记的页缓存
+pub fn find_mapping(ino: u64) -> Option<Arc<FileMapping>> {
+    MAPPINGS.lock().get(&ino).cloned()
+}
+
+/// 注销不再缓存任何页的页缓存，文件被删除后调用 (truncate_inode_pages_final)
+///
+/// 仍有缓存页时不注销，页的 mapping 指针不会悬空；之后仍使用这个键的 VMA 缺页时找不到页缓存
+///
+/// # 返回
+/// 已注销时返回 true
+pub fn remove_mapping(ino: u64) -> bool {
+    let mut mappings = MAPPINGS.lock();
+    match mappings.get(&ino) {
+        Some(mapping) if mapping.nr_cached() == 0 => {
+            mappings.remove(&ino);
+            true
+        }
+        _ => false,
+    }
+}
+
+/// 文件写入后更新已缓存的页，保持映射与文件内容一致
+pub fn update_cached_pages(ino: u64, offset: usize, data: &[u8]) {
+    if let Some(mapping) = find_mapping(ino) {
+        mapping.write(offset, data);
+    }
+}
+
+/// 页缓存的键：设备号与 inode 号 (i_sb->s_dev, i_ino)
+///
+/// 不同文件系统的 inode 号会重复；rootfs 的设备号为 0，键就是 inode 号
+pub fn mapping_key(dev: u32, ino: u64) -> u64 {
+    ((dev as u64) << 32) | (ino & 0xFFFF_FFFF)
+}
+
+/// 归还 grab_page 取得的页引用 (put_page)
+///
+/// 页缓存中的页至少还有页缓存自己的引用；引用归零说明页已不在缓存中，由最后的持有者释放。
+/// get_user_pages 取得的匿名页也由这里归还，最后一个引用释放时先清除其 LRU 状态
+pub fn put_page(phys: usize) {
+    let page = pfn_to_page(phys / PAGE_SIZE);
+    if page.is_null() {
+        return;
+    }
+    if unsafe { (*page).put_page() } == 0 {
+        crate::arch::mm::release_anon_page(phys / PAGE_SIZE);
+        free_user_page(PhysFrame::new(phys / PAGE_SIZE));
+    }
+}
+
+/// 页缓存统计：(文件数, 缓存页数)
+pub fn page_cache_stats() -> (usize, usize) {
+    (MAPPINGS.lock().len(), NR_FILE_PAGES.load(Ordering::Relaxed))
+}
@@ -0,0 +1,145 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 透明大页后台合并 (khugepaged)
+//!
+//! 参考 Linux: mm/khugepaged.c, mm/huge_memory.c
+//!
+//! - 透明大页模式 (ThpMode) 决定哪些匿名私有 VMA 使用 2MB 大页：
+//!   always 为全部（MADV_NOHUGEPAGE 的除外），madvise 只有 MADV_HUGEPAGE 标记的，never 不使用
+//! - 缺页路径在写缺页时直接分配大页，最后一个 4KB 页映射时合并整个 L0 页表；
+//!   khugepaged 补上缺页路径合并不到的区域：模式切换或 MADV_HUGEPAGE 之前已经填满的、
+//!   换入 (do_swap_page) 或 COW 之后才变成独占可写的区域
+//! - khugepaged 在 CPU 0 的空闲循环中每 KHUGEPAGED_SLEEP_INTERVAL 检查 KHUGEPAGED_PAGES_TO_SCAN 个
+//!   2MB 区域，按地址空间的地址依次轮转，记录上次停下的位置
+//! - 只合并 512 个页表项都存在的区域 (max_ptes_none = 0)，不为合并分配新的 4KB 页
+//! - /proc/sys/vm/transparent_hugepage 读出当前模式（方括号标出），写入 always / madvise / never 切换
+
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use spin::Mutex;
+
+use crate::arch::riscv64::mm::{set_transparent_hugepage, AddressSpace, ThpMode};
+use crate::drivers::timer::{get_jiffies, HZ};
+
+/// khugepaged 每次检查的 2MB 区域数 (pages_to_scan / HPAGE_PMD_NR)
+pub const KHUGEPAGED_PAGES_TO_SCAN: usize = 8;
+
+/// khugepaged 两次扫描的间隔 (scan_sleep_millisecs = 10000)
+const KHUGEPAGED_SLEEP_INTERVAL: u64 = 10 * HZ;
+
+/// 扫描位置 (khugepaged_scan)：地址空间的标识与虚拟地址
+///
+/// 地址空间按标识排序轮转，标识为 0 时从第一个地址空间开始
+static SCAN_CURSOR: Mutex<(usize, usize)> = Mutex::new((0, 0));
+
+static LAST_SCAN: AtomicU64 = AtomicU64::new(0);
+static NR_SCANNED: AtomicUsize = AtomicUsize::new(0);
+static NR_COLLAPSED: AtomicUsize = AtomicUsize::new(0);
+static NR_FULL_SCANS: AtomicUsize = AtomicUsize::new(0);
+
+/// 所有用户任务的地址空间，按标识排序去重
+fn collect_mms() -> Vec<Arc<AddressSpace>> {
+    let mut mms: Vec<Arc<AddressSpace>> = Vec::new();
+    crate::sched::sched::for_each_task(|task| unsafe {
+        if let Some(mm) = (*task).address_space_arc() {
+            if mm.mm_users() > 0 {
+                mms.push(mm);
+            }
+        }
+    });
+    mms.sort_unstable_by_key(|mm| Arc::as_ptr(mm) as usize);
+    mms.dedup_by_key(|mm| Arc::as_ptr(mm) as usize);
+    mms
+}
+
+/// 检查 nr 个 2MB 区域，把填满的区域合并为大页 (khugepaged_do_scan)
+///
+/// # 返回
+/// 合并的大页数
+pub fn khugepaged_scan(nr: usize) -> usize {
+    let mms = collect_mms();
+    let mut cursor = SCAN_CURSOR.lock();
+    let mut budget = nr;
+    let mut collapsed = 0;
+    // 每个地址空间最多访问一次，避免地址空间都很小时在一次扫描中反复轮转
+    let first = mms.partition_point(|mm| (Arc::as_ptr(mm) as usize) < cursor.0);
+    for index in (first..mms.len()).chain(0..first) {
+        if budget == 0 {
+            break;
+        }
+        let mm = &mms[index];
+        let id = Arc::as_ptr(mm) as usize;
+        let start = if id == cursor.0 { cursor.1 } else { 0 };
+        let (scanned, merged, next) = mm.collapse_scan(start, budget);
+        budget -= scanned;
+        collapsed += merged;
+        match next {
+            Some(addr) => *cursor = (id, addr),
+            None => {
+                // 下一个地址空间从头开始；最后一个扫完时完成一轮
+                *cursor = match mms.get(index + 1) {
+                    Some(next_mm) => (Arc::as_ptr(next_mm) as usize, 0),
+                    None => {
+                        NR_FULL_SCANS.fetch_add(1, Ordering::Relaxed);
+                        (0, 0)
+                    }
+                };
+            }
+        }
+    }
+    drop(cursor);
+    NR_SCANNED.fetch_add(nr - budget, Ordering::Relaxed);
+    NR_COLLAPSED.fetch_add(collapsed, Ordering::Relaxed);
+    collapsed
+}
+
+/// 后台合并 (khugepaged)
+///
+/// 由 CPU 0 的空闲循环调用，每 KHUGEPAGED_SLEEP_INTERVAL 检查一批区域
+pub fn khugepaged_run() {
+    if crate::arch::riscv64::mm::transparent_hugepage() == ThpMode::Never {
+        return;
+    }
+    let now = get_jiffies();
+    if now.saturating_sub(LAST_SCAN.load(Ordering::Relaxed)) < KHUGEPAGED_SLEEP_INTERVAL {
+        return;
+    }
+    LAST_SCAN.store(now, Ordering::Relaxed);
+    khugepaged_scan(KHUGEPAGED_PAGES_TO_SCAN);
+}
+
+/// 写入 /proc/sys/vm/transparent_hugepage (enabled_store)
+pub fn write_enabled(data: &[u8]) -> Result<usize, i32> {
+    let mode = match core::str::from_utf8(data).map(str::trim) {
+        Ok("always") => ThpMode::Always,
+        Ok("madvise") => ThpMode::Madvise,
+        Ok("never") => ThpMode::Never,
+        _ => return Err(crate::errno::Errno::InvalidArgument.as_neg_i32()),
+    };
+    set_transparent_hugepage(mode);
+    Ok(data.len())
+}
+
+/// khugepaged 统计 (/sys/kernel/mm/transparent_hugepage/khugepaged)
+#[derive(Debug, Clone, Copy, Default)]
+pub struct KhugepagedStats {
+    /// 检查过的 2MB 区域数
+    pub ranges_scanned: usize,
+    /// khugepaged 合并的大页数 (pages_collapsed)
+    pub pages_collapsed: usize,
+    /// 完整扫描的轮数 (full_scans)
+    pub full_scans: usize,
+}
+
+/// 获取 khugepaged 统计
+pub fn khugepaged_stats() -> KhugepagedStats {
+    KhugepagedStats {
+        ranges_scanned: NR_SCANNED.load(Ordering::Relaxed),
+        pages_collapsed: NR_COLLAPSED.load(Ordering::Relaxed),
+        full_scans: NR_FULL_SCANS.load(Ordering::Relaxed),
+    }
+}
@@ -0,0 +1,553 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 命名对象缓存 (kmem_cache)
+//!
+//! 为频繁分配的内核对象（Task、BufferHead 等）提供精确大小的 slab，
+//! 避免 kmalloc 按 2 的幂取整造成的内存和缓存行浪费。
+//!
+//! 参考：
+//! - Linux mm/slab.c, mm/slab_common.c
+//! - J. Bonwick, "The Slab Allocator: An Object-Caching Kernel Memory Allocator"
+//!
+//! # 设计
+//! - 每个 slab 是 2^order 个连续页，从 buddy 分配器按 slab 大小对齐分配，
+//!   释放时由对象地址向下对齐即可找到 slab 头部
+//! - slab 头部 (KmemSlab) 和空闲对象索引栈放在 slab 开头（on-slab 管理），
+//!   对象内存中不存放空闲链表，构造函数初始化后的状态在释放后保持不变
+//! - 缓存着色 (colouring)：不同 slab 的第一个对象错开若干个缓存行，
+//!   让不同 slab 中相同编号的对象映射到不同的缓存组
+//! - 所有缓存登记在 CACHE_CHAIN 中，通过 /proc/slabinfo 查看统计
+//!
+//! # 使用
+//! ```no_run
+//! let cachep = kmem_cache_create("task_struct", size_of::<Task>(), align_of::<Task>(),
+//!                                SLAB_HWCACHE_ALIGN, None).unwrap();
+//! let obj = kmem_cache_alloc(cachep);
+//! kmem_cache_free(cachep, obj);
+//! ```
+
+use alloc::string::String;
+use alloc::vec::Vec;
+use alloc::boxed::Box;
+use alloc::format;
+use core::alloc::{GlobalAlloc, Layout};
+use core::ptr;
+use spin::Mutex;
+
+use crate::list::ListHead;
+use super::buddy_allocator::HEAP_ALLOCATOR;
+use super::vmstat::{count_vm_event, VmEvent};
+
+/// 页大小
+const PAGE_SIZE: usize = 4096;
+
+/// 缓存行大小（着色偏移单位）
+const CACHE_LINE_SIZE: usize = 64;
+
+/// slab 最大阶数（8 页 = 32KB）
+///
+/// buddy 块只在 2MB 对齐的堆内按自身大小对齐，阶数不能超过 9
+const MAX_SLAB_ORDER: usize = 3;
+
+/// 可接受的 slab 内部浪费比例（1/8）
+const MAX_WASTE_SHIFT: usize = 3;
+
+/// 对象对齐到缓存行 (SLAB_HWCACHE_ALIGN)
+pub const SLAB_HWCACHE_ALIGN: u32 = 0x0000_2000;
+
+/// 开启缓存着色
+pub const SLAB_CACHE_COLOUR: u32 = 0x0001_0000;
+
+/// 对象构造函数（slab 创建时对每个对象调用一次）
+pub type Ctor = fn(*mut u8);
+
+/// slab 头部（位于每个 slab 的起始地址）
+#[repr(C)]
+struct KmemSlab {
+    /// 链接到所属缓存的 slabs_full/partial/free 链表（必须是第一个字段）
+    list: ListHead,
+    /// 第一个对象的地址
+    s_mem: usize,
+    /// 已分配的对象数
+    inuse: usize,
+    /// 空闲索引栈中的元素个数
+    nr_free: usize,
+}
+
+impl KmemSlab {
+    /// 空闲对象索引栈（紧跟在头部之后）
+    #[inline]
+    unsafe fn freelist(slab: *mut KmemSlab) -> *mut u16 {
+        (slab as *mut u8).add(core::mem::size_of::<KmemSlab>()) as *mut u16
+    }
+}
+
+/// 缓存的可变状态（由锁保护）
+struct KmemCacheNode {
+    /// 全部对象已分配的 slab
+    slabs_full: ListHead,
+    /// 部分对象已分配的 slab
+    slabs_partial: ListHead,
+    /// 没有对象被分配的 slab
+    slabs_free: ListHead,
+    /// 下一个 slab 使用的着色编号
+    colour_next: usize,
+    /// 统计：slab 数量
+    num_slabs: usize,
+    /// 统计：已分配对象数
+    active_objs: usize,
+    /// 统计：累计分配次数
+    alloc_count: usize,
+    /// 统计：累计释放次数
+    free_count: usize,
+}
+
+/// 命名对象缓存 (struct kmem_cache)
+pub struct KmemCache {
+    /// 缓存名称
+    name: String,
+    /// 对象大小（已按对齐取整）
+    size: usize,
+    /// 调用者请求的对象大小
+    object_size: usize,
+    /// 对象对齐
+    align: usize,
+    /// 对象构造函数
+    ctor: Option<Ctor>,
+    /// slab 阶数
+    order: usize,
+    /// 每个 slab 的对象数
+    num: usize,
+    /// 头部和空闲索引栈之后、对象之前的偏移（不含着色）
+    mgmt_size: usize,
+    /// 可用着色数
+    colour: usize,
+    /// 着色偏移单位
+    colour_off: usize,
+    /// 可变状态
+    node: Mutex<KmemCacheNode>,
+}
+
+unsafe impl Send for KmemCache {}
+unsafe impl Sync for KmemCache {}
+
+/// 所有已创建的缓存 (slab_caches)
+static CACHE_CHAIN: Mutex<Vec<&'static KmemCache>> = Mutex::new(Vec::new());
+
+#[inline]
+const fn align_up(value: usize, align: usize) -> usize {
+    (value + align - 1) & !(align - 1)
+}
+
+/// 计算给定阶数的 slab 能容纳的对象数和剩余空间 (cache_estimate)
+///
+/// # 返回
+/// (对象数, 对象区起始偏移, 剩余字节数)
+fn cache_estimate(order: usize, size: usize, align: usize) -> (usize, usize, usize) {
+    let slab_bytes = PAGE_SIZE << order;
+    let header = core::mem::size_of::<KmemSlab>();
+    let mut num = (slab_bytes - header) / (size + core::mem::size_of::<u16>());
+    num = num.min(u16::MAX as usize);
+
+    while num > 0 {
+        let mgmt = align_up(header + num * core::mem::size_of::<u16>(), align);
+        let used = mgmt + num * size;
+        if used <= slab_bytes {
+            return (num, mgmt, slab_bytes - used);
+        }
+        num -= 1;
+    }
+    (0, 0, slab_bytes)
+}
+
+impl KmemCache {
+    /// 分配并初始化一个新 slab (cache_grow)
+    ///
+    /// # Safety
+    /// 必须持有 node 锁
+    unsafe fn grow(&self, node: &mut KmemCacheNode) -> *mut KmemSlab {
+        let slab_bytes = PAGE_SIZE << self.order;
+        let layout = match Layout::from_size_align(slab_bytes, slab_bytes) {
+            Ok(l) => l,
+            Err(_) => return ptr::null_mut(),
+        };
+        let base = HEAP_ALLOCATOR.alloc(layout);
+        if base.is_null() {
+            return ptr::null_mut();
+        }
+        // buddy 块必须按 slab 大小对齐，否则无法由对象地址找到头部
+        if (base as usize) & (slab_bytes - 1) != 0 {
+            HEAP_ALLOCATOR.dealloc(base, layout);
+            return ptr::null_mut();
+        }
+
+        let colour = if self.colour > 0 {
+            let c = node.colour_next;
+            node.colour_next = (node.colour_next + 1) % (self.colour + 1);
+            c
+        } else {
+            0
+        };
+
+        let slab = base as *mut KmemSlab;
+        (*slab).list = ListHead::new();
+        (*slab).s_mem = base as usize + self.mgmt_size + colour * self.colour_off;
+        (*slab).inuse = 0;
+        (*slab).nr_free = self.num;
+
+        // 索引栈倒序存放，先分配低地址对象
+        let freelist = KmemSlab::freelist(slab);
+        for i in 0..self.num {
+            *freelist.add(i) = (self.num - 1 - i) as u16;
+        }
+
+        if let Some(ctor) = self.ctor {
+            for i in 0..self.num {
+                ctor(((*slab).s_mem + i * self.size) as *mut u8);
+            }
+        }
+
+        node.num_slabs += 1;
+        count_vm_event(VmEvent::SlabGrow);
+        slab
+    }
+
+    /// 释放一个空闲 slab
+    ///
+    /// # Safety
+    /// slab 必须已从链表中移除且没有已分配对象
+    unsafe fn destroy_slab(&self, node: &mut KmemCacheNode, slab: *mut KmemSlab) {
+        let slab_bytes = PAGE_SIZE << self.order;
+        let layout = Layout::from_size_align_unchecked(slab_bytes, slab_bytes);
+        HEAP_ALLOCATOR.dealloc(slab as *mut u8, layout);
+        node.num_slabs -= 1;
+        count_vm_event(VmEvent::SlabShrink);
+    }
+
+    /// 对象地址所在的 slab
+    #[inline]
+    fn slab_of(&self, obj: *mut u8) -> *mut KmemSlab {
+        let slab_bytes = PAGE_SIZE << self.order;
+        ((obj as usize) & !(slab_bytes - 1)) as *mut KmemSlab
+    }
+
+    /// 缓存名称
+    pub fn name(&self) -> &str {
+        &self.name
+    }
+
+    /// 对象大小（取整后）
+    pub fn size(&self) -> usize {
+        self.size
+    }
+
+    /// 调用者请求的对象大小
+    pub fn object_size(&self) -> usize {
+        self.object_size
+    }
+
+    /// 对象对齐
+    pub fn align(&self) -> usize {
+        self.align
+    }
+
+    /// 每个 slab 的对象数
+    pub fn objects_per_slab(&self) -> usize {
+        self.num
+    }
+
+    /// 获取统计信息
+    pub fn stats(&self) -> KmemCacheStats {
+        let node = self.node.lock();
+        KmemCacheStats {
+            active_objs: node.active_objs,
+            num_objs: node.num_slabs * self.num,
+            num_slabs: node.num_slabs,
+            alloc_count: node.alloc_count,
+            free_count: node.free_count,
+        }
+    }
+}
+
+/// 单个缓存的统计信息
+#[derive(Debug, Clone, Copy, Default)]
+pub struct KmemCacheStats {
+    pub active_objs: usize,
+    pub num_objs: usize,
+    pub num_slabs: usize,
+    pub alloc_count: usize,
+    pub free_count: usize,
+}
+
+/// 创建命名对象缓存
+///
+/// # 参数
+/// - `name`: 缓存名称（显示在 /proc/slabinfo）
+/// - `size`: 对象大小
+/// - `align`: 对象最小对齐（0 表示按指针对齐）
+/// - `flags`: SLAB_HWCACHE_ALIGN、SLAB_CACHE_COLOUR
+/// - `ctor`: 可选的构造函数，slab 创建时对每个对象调用一次
+///
+/// # 返回
+/// 成功返回缓存引用（缓存永久存在），对象过大时返回 None
+pub fn kmem_cache_create(
+    name: &str,
+    size: usize,
+    align: usize,
+    flags: u32,
+    ctor: Option<Ctor>,
+) -> Option<&'static KmemCache> {
+    if size == 0 {
+        return None;
+    }
+
+    let mut align = align.max(core::mem::align_of::<usize>());
+    if flags & SLAB_HWCACHE_ALIGN != 0 {
+        // 小对象不强制对齐到整个缓存行，避免过多浪费
+        let mut ralign = CACHE_LINE_SIZE;
+        while size <= ralign / 2 {
+            ralign /= 2;
+        }
+        align = align.max(ralign);
+    }
+    if !align.is_power_of_two() {
+        return None;
+    }
+    let obj_size = align_up(size, align);
+
+    // 选择浪费不超过 1/8 的最小阶数 (calculate_slab_order)
+    let mut chosen = None;
+    for order in 0..=MAX_SLAB_ORDER {
+        let (num, mgmt, left) = cache_estimate(order, obj_size, align);
+        if num == 0 {
+            continue;
+        }
+        chosen = Some((order, num, mgmt, left));
+        if left << MAX_WASTE_SHIFT <= PAGE_SIZE << order {
+            break;
+        }
+    }
+    let (order, num, mgmt_size, left_over) = chosen?;
+
+    let colour_off = CACHE_LINE_SIZE.max(align);
+    let colour = if flags & SLAB_CACHE_COLOUR != 0 {
+        left_over / colour_off
+    } else {
+        0
+    };
+
+    let cachep: &'static mut KmemCache = Box::leak(Box::new(KmemCache {
+        name: String::from(name),
+        size: obj_size,
+        object_size: size,
+        align,
+        ctor,
+        order,
+        num,
+        mgmt_size,
+        colour,
+        colour_off,
+        node: Mutex::new(KmemCacheNode {
+            slabs_full: ListHead::new(),
+            slabs_partial: ListHead::new(),
+            slabs_free: ListHead::new(),
+            colour_next: 0,
+            num_slabs: 0,
+            active_objs: 0,
+            alloc_count: 0,
+            free_count: 0,
+        }),
+    }));
+
+    // 链表头是自引用的，必须在缓存放入最终位置后初始化
+    {
+        let mut node = cachep.node.lock();
+        node.slabs_full.init();
+        node.slabs_partial.init();
+        node.slabs_free.init();
+    }
+
+    let cachep: &'static KmemCache = cachep;
+    CACHE_CHAIN.lock().push(cachep);
+    Some(cachep)
+}
+
+/// 从缓存分配一个对象
+///
+/// # 返回
+/// 成功返回对象指针（已按缓存对齐），内存不足返回 null
+pub fn kmem_cache_alloc(cachep: &KmemCache) -> *mut u8 {
+    let mut node = cachep.node.lock();
+    let node = &mut *node;
+
+    unsafe {
+        // 优先使用部分分配的 slab，其次是空闲 slab，最后创建新 slab
+        let slab = if !node.slabs_partial.is_empty() {
+            node.slabs_partial.next as *mut KmemSlab
+        } else if !node.slabs_free.is_empty() {
+            node.slabs_free.next as *mut KmemSlab
+        } else {
+            let slab = cachep.grow(node);
+            if slab.is_null() {
+                return ptr::null_mut();
+            }
+            (*slab).list.add(&mut node.slabs_free);
+            slab
+        };
+
+        (*slab).nr_free -= 1;
+        let idx = *KmemSlab::freelist(slab).add((*slab).nr_free) as usize;
+        (*slab).inuse += 1;
+
+        (*slab).list.del();
+        if (*slab).nr_free == 0 {
+            (*slab).list.add(&mut node.slabs_full);
+        } else {
+            (*slab).list.add(&mut node.slabs_partial);
+        }
+
+        node.active_objs += 1;
+        node.alloc_count += 1;
+        ((*slab).s_mem + idx * cachep.size) as *mut u8
+    }
+}
+
+/// 释放对象到缓存
+///
+/// 对象应处于构造后的状态（如果缓存有构造函数）
+///
+/// # Safety
+/// obj 必须是由 `kmem_cache_alloc(cachep)` 分配且尚未释放的对象
+pub unsafe fn kmem_cache_free(cachep: &KmemCache, obj: *mut u8) {
+    if obj.is_null() {
+        return;
+    }
+
+    let slab = cachep.slab_of(obj);
+    let idx = (obj as usize - (*slab).s_mem) / cachep.size;
+
+    let mut node = cachep.node.lock();
+    let node = &mut *node;
+
+    *KmemSlab::freelist(slab).add((*slab).nr_free) = idx as u16;
+    (*slab).nr_free += 1;
+    (*slab).inuse -= 1;
+
+    (*slab).list.del();
+    if (*slab).inuse == 0 {
+        // 最多保留一个空闲 slab，其余归还 buddy
+        if node.slabs_free.is_empty() {
+            (*slab).list.add(&mut node.slabs_free);
+        } else {
+            cachep.destroy_slab(node, slab);
+        }
+    } else {
+        (*slab).list.add(&mut node.slabs_partial);
+    }
+
+    node.active_objs -= 1;
+    node.free_count += 1;
+}
+
+/// 释放缓存中所有空闲 slab (kmem_cache_shrink)
+///
+/// # 返回
+/// 释放的 slab 数
+pub fn kmem_cache_shrink(cachep: &KmemCache) -> usize {
+    let mut node = cachep.node.lock();
+    let node = &mut *node;
+    let mut freed = 0;
+
+    unsafe {
+        while !node.slabs_free.is_empty() {
+            let slab = node.slabs_free.next as *mut KmemSlab;
+            (*slab).list.del();
+            cachep.destroy_slab(node, slab);
+            freed += 1;
+        }
+    }
+    freed
+}
+
+/// 收缩所有缓存（页回收的收缩器）
+///
+/// 回收可能发生在持有某个缓存锁的分配路径中，拿不到锁的缓存跳过
+///
+/// # 返回
+/// 释放的 slab 数
+pub fn kmem_cache_shrink_all() -> usize {
+    let chain = match CACHE_CHAIN.try_lock() {
+        Some(chain) => chain,
+        None => return 0,
+    };
+    let mut freed = 0;
+    for cachep in chain.iter() {
+        let mut node = match cachep.node.try_lock() {
+            Some(node) => node,
+            None => continue,
+        };
+        let node = &mut *node;
+        unsafe {
+            while !node.slabs_free.is_empty() {
+                let slab = node.slabs_free.next as *mut KmemSlab;
+                (*slab).list.del();
+                cachep.destroy_slab(node, slab);
+                freed += 1;
+            }
+        }
+    }
+    freed
+}
+
+/// 生成 /proc/slabinfo 内容
+///
+/// 格式与 Linux slabinfo 2.1 兼容：
+/// `name <active_objs> <num_objs> <objsize> <objperslab> <pagesperslab> : slabdata <active_slabs> <num_slabs> 0`
+pub fn slabinfo() -> String {
+    let mut out = String::from("slabinfo - version: 2.1\n");
+    out.push_str("# name            <active_objs> <num_objs> <objsize> <objperslab> <pagesperslab> : slabdata <active_slabs> <num_slabs> <sharedavail>\n");
+
+    let chain = CACHE_CHAIN.lock();
+    for cachep in chain.iter() {
+        let stats = cachep.stats();
+        out.push_str(&format!(
+            "{:<17} {:>6} {:>6} {:>6} {:>4} {:>4} : slabdata {:>6} {:>6} {:>6}\n",
+            cachep.name,
+            stats.active_objs,
+            stats.num_objs,
+            cachep.size,
+            cachep.num,
+            1usize << cachep.order,
+            stats.num_slabs,
+            stats.num_slabs,
+            0,
+        ));
+    }
+    out
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[test]
+    fn test_cache_estimate_fits_slab() {
+        for &size in &[24usize, 64, 200, 1000, 3000] {
+            let (num, mgmt, left) = cache_estimate(0, size, 8);
+            assert!(num > 0);
+            assert_eq!(mgmt + num * size + left, PAGE_SIZE);
+            // 再多一个对象就放不下
+            let header = core::mem::size_of::<KmemSlab>();
+            let more = align_up(header + (num + 1) * 2, 8) + (num + 1) * size;
+            assert!(more > PAGE_SIZE);
+        }
+    }
+
+    #[test]
+    fn test_cache_estimate_too_large() {
+        assert_eq!(cache_estimate(0, PAGE_SIZE, 8).0, 0);
+        assert_eq!(cache_estimate(1, PAGE_SIZE, 8).0, 1);
+    }
+}
@@ -0,0 +1,446 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 相同页合并 (Kernel Samepage Merging)
+//!
+//! 参考 Linux: mm/ksm.c
+//!
+//! - madvise(MADV_MERGEABLE) 把地址空间的范围登记到扫描列表 (ksm_mm_slot)，
+//!   fork 的子进程继承，进程退出时移除
+//! - ksmd 在 CPU 0 的空闲循环中每 KSM_SLEEP_INTERVAL 扫描 KSM_PAGES_TO_SCAN 页，
+//!   只看本地址空间独有的私有匿名页（带反向映射、引用计数为 1、L0 页表不共享）
+//! - 每页计算校验和并记在 rmap_item 中；两次扫描之间校验和变化的页经常写入，跳过
+//! - 校验和不变的页先写保护，一批页写保护后用一次 flush_tlb_all 刷新，内容才稳定；
+//!   然后按校验和查找，逐字节相同才合并：
+//!   - 稳定表 (stable tree)：已合并的页，页表项换成合并页，原页刷新 TLB 后释放
+//!   - 不稳定表 (unstable tree)：本轮扫描见过的候选页，相同时前者变成合并页放入稳定表，
+//!     后者换成它；每轮完整扫描后清空
+//! - 合并页只读、不在 LRU 上，任何映射写入时经 COW 复制出私有页 (handle_cow_fault)；
+//!   最后一个映射解除时释放，稳定表中的旧记录在查找时丢弃
+//! - MADV_UNMERGEABLE 只停止扫描，已合并的页保持共享
+//! - 锁顺序为 KSM → 页表锁，页表锁一律 try_lock，拿不到就留到下一轮
+
+use alloc::collections::BTreeMap;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use spin::Mutex;
+
+use super::page::{PhysFrame, PAGE_SIZE};
+use super::page_desc::{pfn_to_page, PageType};
+use super::pcp::free_user_page;
+use crate::arch::riscv64::mm::{ksm_follow_page, ksm_promote_page, ksm_replace_page, ksm_write_protect, MmHandle};
+use crate::drivers::timer::{get_jiffies, HZ};
+
+/// ksmd 每次扫描的页数 (pages_to_scan)
+pub const KSM_PAGES_TO_SCAN: usize = 100;
+
+/// ksmd 两次扫描的间隔 (sleep_millisecs = 20)
+const KSM_SLEEP_INTERVAL: u64 = HZ / 50;
+
+/// 一个登记的地址空间 (ksm_mm_slot)
+struct MmSlot {
+    mm: MmHandle,
+    /// 可合并的范围，按地址排序且互不重叠
+    ranges: Vec<(usize, usize)>,
+}
+
+/// 校验和不变、已写保护的待合并页
+struct Candidate {
+    mm: MmHandle,
+    vaddr: usize,
+    pfn: usize,
+    checksum: u64,
+}
+
+struct Ksm {
+    slots: Vec<MmSlot>,
+    /// 扫描位置 (ksm_scan)：登记表下标与虚拟地址
+    cursor_slot: usize,
+    cursor_addr: usize,
+    /// 每个扫描过的页上次的校验和 (rmap_item->oldchecksum)，键为 (地址空间, 虚拟地址)
+    checksums: BTreeMap<(usize, usize), u64>,
+    /// 稳定表：校验和 → 合并页
+    stable: BTreeMap<u64, Vec<usize>>,
+    /// 不稳定表：校验和 → 本轮见过的候选页
+    unstable: BTreeMap<u64, (MmHandle, usize, usize)>,
+}
+
+static KSM: Mutex<Ksm> = Mutex::new(Ksm {
+    slots: Vec::new(),
+    cursor_slot: 0,
+    cursor_addr: 0,
+    checksums: BTreeMap::new(),
+    stable: BTreeMap::new(),
+    unstable: BTreeMap::new(),
+});
+
+/// ksmd 开关 (/sys/kernel/mm/ksm/run)
+static KSM_RUN: AtomicBool = AtomicBool::new(true);
+
+/// 上一次扫描的时间
+static LAST_SCAN: AtomicU64 = AtomicU64::new(0);
+
+/// 统计：扫描的页数
+static NR_SCANNED: AtomicUsize = AtomicUsize::new(0);
+/// 统计：完整扫描的轮数 (full_scans)
+static NR_FULL_SCANS: AtomicUsize = AtomicUsize::new(0);
+/// 统计：合并后释放的页数
+static NR_MERGED: AtomicUsize = AtomicUsize::new(0);
+/// 统计：校验和变化而跳过的页数
+static NR_VOLATILE: AtomicUsize = AtomicUsize::new(0);
+
+/// 页内容的校验和 (calc_checksum)
+fn calc_checksum(pfn: usize) -> u64 {
+    let words = unsafe { core::slice::from_raw_parts((pfn * PAGE_SIZE) as *const u64, PAGE_SIZE / 8) };
+    words
+        .iter()
+        .fold(0xcbf2_9ce4_8422_2325, |hash, &word| (hash ^ word).wrapping_mul(0x0000_0100_0000_01b3).rotate_left(29))
+}
+
+/// 取得合并页的引用；页已释放或不再是合并页时返回 false
+fn get_ksm_page(kpfn: usize) -> bool {
+    let page = pfn_to_page(kpfn);
+    if page.is_null() || !unsafe { (*page).try_get_page() } {
+        return false;
+    }
+    // 类型在引用计数归零后才复位，持有引用时看到的类型可靠
+    if unsafe { (*page).page_type() } != PageType::Ksm {
+        put_ksm_page(kpfn);
+        return false;
+    }
+    true
+}
+
+/// 归还 get_ksm_page 取得的引用，期间所有映射都已解除时释放页
+fn put_ksm_page(kpfn: usize) {
+    let page = pfn_to_page(kpfn);
+    if unsafe { (*page).put_page() } == 0 {
+        unsafe { (*page).set_page_type(PageType::Normal) };
+        free_user_page(PhysFrame::new(kpfn));
+    }
+}
+
+/// 把 [start, end) 并入有序范围表
+fn add_range(ranges: &mut Vec<(usize, usize)>, start: usize, end: usize) {
+    let (mut start, mut end) = (start, end);
+    ranges.retain(|&(s, e)| {
+        if e < start || s > end {
+            return true;
+        }
+        start = start.min(s);
+        end = end.max(e);
+        false
+    });
+    let pos = ranges.partition_point(|&(s, _)| s < start);
+    ranges.insert(pos, (start, end));
+}
+
+/// 从有序范围表中去掉 [start, end)
+fn remove_range(ranges: &mut Vec<(usize, usize)>, start: usize, end: usize) {
+    let mut result = Vec::with_capacity(ranges.len() + 1);
+    for &(s, e) in ranges.iter() {
+        if e <= start || s >= end {
+            result.push((s, e));
+            continue;
+        }
+        if s < start {
+            result.push((s, start));
+        }
+        if e > end {
+            result.push((end, e));
+        }
+    }
+    *ranges = result;
+}
+
+impl Ksm {
+    fn slot_index(&self, mm: &MmHandle) -> Option<usize> {
+        self.slots.iter().position(|slot| slot.mm.id() == mm.id())
+    }
+
+    /// 移除登记表项及其扫描记录 (remove_mm_from_lists)
+    fn remove_slot(&mut self, index: usize) {
+        let id = self.slots[index].mm.id();
+        self.slots.remove(index);
+        if index < self.cursor_slot {
+            self.cursor_slot -= 1;
+        } else if index == self.cursor_slot {
+            self.cursor_addr = 0;
+        }
+        let keys: Vec<(usize, usize)> = self.checksums.range((id, 0)..=(id, usize::MAX)).map(|(&key, _)| key).collect();
+        for key in keys {
+            self.checksums.remove(&key);
+        }
+        self.unstable.retain(|_, (mm, _, _)| mm.id() != id);
+    }
+
+    /// 下一个要扫描的地址 (scan_get_next_rmap_item)
+    ///
+    /// 走完所有登记的范围算一轮完整扫描，不稳定表随之清空
+    fn next_address(&mut self) -> Option<(MmHandle, usize)> {
+        if self.slots.is_empty() {
+            return None;
+        }
+        loop {
+            if self.cursor_slot >= self.slots.len() {
+                self.cursor_slot = 0;
+                self.cursor_addr = 0;
+                self.unstable.clear();
+                NR_FULL_SCANS.fetch_add(1, Ordering::Relaxed);
+            }
+            let slot = &self.slots[self.cursor_slot];
+            if let Some(&(start, _)) = slot.ranges.iter().find(|&&(_, end)| end > self.cursor_addr) {
+                let addr = self.cursor_addr.max(start);
+                self.cursor_addr = addr + PAGE_SIZE;
+                return Some((slot.mm.clone(), addr));
+            }
+            self.cursor_slot += 1;
+            self.cursor_addr = 0;
+        }
+    }
+
+    /// 与稳定表中的合并页合并 (stable_tree_search)
+    fn stable_merge(&mut self, candidate: &Candidate) -> bool {
+        let pages = match self.stable.get_mut(&candidate.checksum) {
+            Some(pages) => pages,
+            None => return false,
+        };
+        let mut merged = false;
+        pages.retain(|&kpfn| {
+            if merged {
+                return true;
+            }
+            if !get_ksm_page(kpfn) {
+                return false;
+            }
+            // 成功时取得的引用转给新的页表项
+            merged = ksm_replace_page(&candidate.mm, candidate.vaddr, candidate.pfn, kpfn);
+            if !merged {
+                put_ksm_page(kpfn);
+            }
+            true
+        });
+        if pages.is_empty() {
+            self.stable.remove(&candidate.checksum);
+        }
+        merged
+    }
+
+    /// 与不稳定表中的候选页合并 (unstable_tree_search_insert + try_to_merge_two_pages)
+    ///
+    /// 没有相同的候选页时把自己放入不稳定表
+    fn unstable_merge(&mut self, candidate: Candidate) -> bool {
+        let (mm, vaddr, pfn) = match self.unstable.remove(&candidate.checksum) {
+            Some(entry) => entry,
+            None => {
+                self.unstable.insert(candidate.checksum, (candidate.mm, candidate.vaddr, candidate.pfn));
+                return false;
+            }
+        };
+        // 一批扫描绕过一整轮时同一页会出现两次
+        if pfn == candidate.pfn || !ksm_promote_page(&mm, vaddr, pfn) {
+            // 先前的候选页已被写入或解除映射
+            self.unstable.insert(candidate.checksum, (candidate.mm, candidate.vaddr, candidate.pfn));
+            return false;
+        }
+        // 成为合并页后即使这次没有合并成功也留在稳定表中，内容不会再变化
+        self.stable.entry(candidate.checksum).or_default().push(pfn);
+        unsafe { (*pfn_to_page(pfn)).get_page() };
+        let merged = ksm_replace_page(&candidate.mm, candidate.vaddr, candidate.pfn, pfn);
+        if !merged {
+            put_ksm_page(pfn);
+        }
+        merged
+    }
+}
+
+/// 登记或取消可合并的范围，由 madvise(MADV_MERGEABLE / MADV_UNMERGEABLE) 调用 (ksm_madvise)
+pub fn ksm_madvise(mm: &MmHandle, start: usize, end: usize, merge: bool) {
+    let mut ksm = KSM.lock();
+    let index = match ksm.slot_index(mm) {
+        Some(index) => index,
+        None if merge => {
+            ksm.slots.push(MmSlot { mm: mm.clone(), ranges: Vec::new() });
+            ksm.slots.len() - 1
+        }
+        None => return,
+    };
+    if merge {
+        add_range(&mut ksm.slots[index].ranges, start, end);
+        return;
+    }
+    remove_range(&mut ksm.slots[index].ranges, start, end);
+    if ksm.slots[index].ranges.is_empty() {
+        ksm.remove_slot(index);
+        return;
+    }
+    let id = mm.id();
+    let keys: Vec<(usize, usize)> = ksm.checksums.range((id, start)..(id, end)).map(|(&key, _)| key).collect();
+    for key in keys {
+        ksm.checksums.remove(&key);
+    }
+}
+
+/// fork 的子进程继承可合并的范围 (ksm_fork)
+pub fn ksm_fork(mm: &MmHandle, ranges: &[(usize, usize)]) {
+    let mut ksm = KSM.lock();
+    let mut slot = MmSlot { mm: mm.clone(), ranges: Vec::new() };
+    for &(start, end) in ranges {
+        add_range(&mut slot.ranges, start, end);
+    }
+    ksm.slots.push(slot);
+}
+
+/// 地址空间退出时取消登记 (ksm_exit)
+pub fn ksm_exit(mm: &MmHandle) {
+    let mut ksm = KSM.lock();
+    if let Some(index) = ksm.slot_index(mm) {
+        ksm.remove_slot(index);
+    }
+}
+
+/// 扫描最多 nr_pages 个登记的页并合并内容相同的页 (ksm_do_scan)
+///
+/// # 返回
+/// 合并后释放的页数
+pub fn ksm_scan(nr_pages: usize) -> usize {
+    let mut ksm = KSM.lock();
+
+    // 1. 找出两次扫描之间内容没有变化的页
+    let mut candidates = Vec::new();
+    for _ in 0..nr_pages {
+        let (mm, vaddr) = match ksm.next_address() {
+            Some(next) => next,
+            None => break,
+        };
+        NR_SCANNED.fetch_add(1, Ordering::Relaxed);
+        let pfn = match ksm_follow_page(&mm, vaddr) {
+            Some(pfn) => pfn,
+            None => continue,
+        };
+        let checksum = calc_checksum(pfn);
+        match ksm.checksums.insert((mm.id(), vaddr), checksum) {
+            Some(old) if old == checksum => {
+                if candidates.try_reserve(1).is_err() {
+                    break;
+                }
+                candidates.push(Candidate { mm, vaddr, pfn, checksum });
+            }
+            Some(_) => {
+                NR_VOLATILE.fetch_add(1, Ordering::Relaxed);
+            }
+            None => {}
+        }
+    }
+    if candidates.is_empty() {
+        return 0;
+    }
+
+    // 2. 写保护，刷新 TLB 后内容才稳定；写保护之前的写入使校验和过时，重新计算
+    let mut flush = false;
+    candidates.retain(|candidate| match ksm_write_protect(&candidate.mm, candidate.vaddr, candidate.pfn) {
+        Some(changed) => {
+            flush |= changed;
+            true
+        }
+        None => false,
+    });
+    if flush {
+        crate::arch::tlb::flush_tlb_all();
+    }
+    for candidate in candidates.iter_mut() {
+        candidate.checksum = calc_checksum(candidate.pfn);
+    }
+
+    // 3. 先查稳定表，再查不稳定表
+    let mut merged = Vec::new();
+    if merged.try_reserve(candidates.len()).is_err() {
+        return 0;
+    }
+    for candidate in candidates {
+        let pfn = candidate.pfn;
+        if ksm.stable_merge(&candidate) || ksm.unstable_merge(candidate) {
+            merged.push(pfn);
+        }
+    }
+    drop(ksm);
+
+    // 4. 原页在所有 CPU 的 TLB 中都失效后释放
+    if !merged.is_empty() {
+        crate::arch::tlb::flush_tlb_all();
+        for &pfn in &merged {
+            let page = pfn_to_page(pfn);
+            if unsafe { (*page).put_page() } == 0 {
+                free_user_page(PhysFrame::new(pfn));
+            }
+        }
+    }
+    NR_MERGED.fetch_add(merged.len(), Ordering::Relaxed);
+    merged.len()
+}
+
+/// 后台合并 (ksmd)
+///
+/// 由 CPU 0 的空闲循环调用，每 KSM_SLEEP_INTERVAL 扫描一批页
+pub fn ksmd_run() {
+    if !KSM_RUN.load(Ordering::Relaxed) {
+        return;
+    }
+    let now = get_jiffies();
+    if now.saturating_sub(LAST_SCAN.load(Ordering::Relaxed)) < KSM_SLEEP_INTERVAL {
+        return;
+    }
+    LAST_SCAN.store(now, Ordering::Relaxed);
+    if KSM.lock().slots.is_empty() {
+        return;
+    }
+    ksm_scan(KSM_PAGES_TO_SCAN);
+}
+
+/// 打开或关闭 ksmd (/sys/kernel/mm/ksm/run)
+pub fn set_ksm_run(run: bool) {
+    KSM_RUN.store(run, Ordering::Relaxed);
+}
+
+/// KSM 统计 (/sys/kernel/mm/ksm)
+#[derive(Debug, Clone, Copy, Default)]
+pub struct KsmStats {
+    /// 仍在使用的合并页数 (pages_shared)
+    pub pages_shared: usize,
+    /// 合并页上除第一个以外的映射数，即节省的页数 (pages_sharing)
+    pub pages_sharing: usize,
+    /// 不稳定表中的候选页数 (pages_unshared)
+    pub pages_unshared: usize,
+    /// 校验和变化而跳过的页数 (pages_volatile)
+    pub pages_volatile: usize,
+    pub pages_scanned: usize,
+    pub pages_merged: usize,
+    pub full_scans: usize,
+    /// 登记的地址空间数
+    pub mm_slots: usize,
+}
+
+/// 获取 KSM 统计
+pub fn ksm_stats() -> KsmStats {
+    let ksm = KSM.lock();
+    let mut stats = KsmStats {
+        pages_unshared: ksm.unstable.len(),
+        pages_volatile: NR_VOLATILE.load(Ordering::Relaxed),
+        pages_scanned: NR_SCANNED.load(Ordering::Relaxed),
+        pages_merged: NR_MERGED.load(Ordering::Relaxed),
+        full_scans: NR_FULL_SCANS.load(Ordering::Relaxed),
+        mm_slots: ksm.slots.len(),
+        ..KsmStats::default()
+    };
+    for &kpfn in ksm.stable.values().flatten() {
+        let page = pfn_to_page(kpfn);
+        let refcount = unsafe { (*page).refcount() };
+        if refcount > 0 && unsafe { (*page).page_type() } == PageType::Ksm {
+            stats.pages_shared += 1;
+            stats.pages_sharing += refcount as usize - 1;
+        }
+    }
+    stats
+}
@@ -0,0 +1,441 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内存控制组 (memory cgroup)
+//!
+//! 参考 Linux: mm/memcontrol.c, mm/page_counter.c
+//!
+//! - 每个非根任务组有一个 MemCgroup，组成与任务组相同的树；根组的任务不记账
+//! - 按页计费 (mem_cgroup_charge)：用户匿名页、页缓存页、管道缓冲区页和 SkBuff 的页片段
+//!   计到分配时当前任务所在的组；页描述符的 memcg_data 记下所属组和类型，
+//!   页最后一次释放时 (free_page_pcp) 从所属组及其祖先扣除
+//! - 用量逐级累加 (page_counter_try_charge)：任何一级超过 memory.max 时先在该级组内
+//!   定向回收 (try_to_free_mem_cgroup_pages)，重试仍失败则分配失败；
+//!   超过 memory.high 时计费成功，但同步回收到 high 以下（Linux 在返回用户态时节流）
+//! - 组删除后 MemCgroup 由仍计在其中的页保持存活 (offline memcg)，最后一页释放时回收，
+//!   用量随之从祖先扣除
+//! - 计费失败的缺页由 OOM killer 在达到限制的组内选择受害者 (mm::oom_kill)
+//! - 只有独占整页的对象计费；slab 对象与其他组共享页，不计费
+
+use alloc::boxed::Box;
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+use super::page::PhysFrame;
+use super::page_desc::pfn_to_page;
+
+/// 不限制 (PAGE_COUNTER_MAX)
+pub const PAGE_COUNTER_MAX: usize = usize::MAX;
+
+/// 超过 memory.max 时定向回收的重试次数 (MAX_RECLAIM_RETRIES)
+const MAX_RECLAIM_RETRIES: usize = 16;
+
+/// 计费类型 (memory.stat 的各项)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(usize)]
+pub enum MemcgStat {
+    /// 匿名页 (NR_ANON_MAPPED)
+    Anon = 0,
+    /// 页缓存页 (NR_FILE_PAGES)
+    File = 1,
+    /// 内核对象独占的页，如管道缓冲区 (MEMCG_KMEM)
+    Kernel = 2,
+    /// 网络缓冲区 (MEMCG_SOCK)
+    Sock = 3,
+}
+
+pub const NR_MEMCG_STAT: usize = 4;
+
+/// memory.stat 中各项的名字
+pub const MEMCG_STAT_NAMES: [&str; NR_MEMCG_STAT] = ["anon", "file", "kernel", "sock"];
+
+/// memory.events 计数 (enum memcg_memory_event)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(usize)]
+pub enum MemcgEvent {
+    /// 用量超过 memory.high
+    High = 0,
+    /// 用量达到 memory.max，进入定向回收
+    Max = 1,
+    /// 回收后仍超过 memory.max，分配失败
+    Oom = 2,
+}
+
+pub const NR_MEMCG_EVENTS: usize = 3;
+
+/// memory.events 中各项的名字
+pub const MEMCG_EVENT_NAMES: [&str; NR_MEMCG_EVENTS] = ["high", "max", "oom"];
+
+/// memcg_data 低位保存计费类型，高位是 MemCgroup 指针
+const MEMCG_DATA_STAT_MASK: usize = 0x7;
+
+/// 内存控制组 (struct mem_cgroup)
+///
+/// 计数器全部是原子量，计费路径不持有任务组锁；用量以页为单位
+pub struct MemCgroup {
+    parent: *mut MemCgroup,
+    /// 引用计数：任务组一个，子组各一个，每个计费的页一个 (css refcnt)
+    refcnt: AtomicUsize,
+    /// 子树的用量 (memory.current)
+    usage: AtomicUsize,
+    max: AtomicUsize,
+    high: AtomicUsize,
+    /// 用量的历史最高值 (memory.peak)
+    watermark: AtomicUsize,
+    /// 子树中各类型的页数
+    stat: [AtomicUsize; NR_MEMCG_STAT],
+    /// 本组发生的事件 (memory.events)
+    events: [AtomicUsize; NR_MEMCG_EVENTS],
+}
+
+unsafe impl Send for MemCgroup {}
+unsafe impl Sync for MemCgroup {}
+
+/// memory.* 文件读取的内容
+#[derive(Debug, Clone, Copy, Default)]
+pub struct MemcgStats {
+    pub usage: usize,
+    pub max: usize,
+    pub high: usize,
+    pub peak: usize,
+    pub stat: [usize; NR_MEMCG_STAT],
+    pub events: [usize; NR_MEMCG_EVENTS],
+}
+
+/// 创建控制组 (mem_cgroup_css_alloc)
+///
+/// parent 为 null 表示父组是根组；新组持有父组的一个引用
+pub fn mem_cgroup_alloc(parent: *mut MemCgroup) -> *mut MemCgroup {
+    if !parent.is_null() {
+        unsafe { css_get(parent, 1) };
+    }
+    Box::into_raw(Box::new(MemCgroup {
+        parent,
+        refcnt: AtomicUsize::new(1),
+        usage: AtomicUsize::new(0),
+        max: AtomicUsize::new(PAGE_COUNTER_MAX),
+        high: AtomicUsize::new(PAGE_COUNTER_MAX),
+        watermark: AtomicUsize::new(0),
+        stat: [const { AtomicUsize::new(0) }; NR_MEMCG_STAT],
+        events: [const { AtomicUsize::new(0) }; NR_MEMCG_EVENTS],
+    }))
+}
+
+/// 任务组删除时放下组的引用 (mem_cgroup_css_offline)
+///
+/// 还有页计在组中时 MemCgroup 保留到最后一页释放
+///
+/// # Safety
+/// memcg 必须有效，每个组只调用一次
+pub unsafe fn mem_cgroup_offline(memcg: *mut MemCgroup) {
+    if !memcg.is_null() {
+        css_put(memcg, 1);
+    }
+}
+
+/// 增加引用 (css_get_many)
+///
+/// # Safety
+/// memcg 必须有效且调用者已持有一个引用（或持有任务组锁）
+#[inline]
+pub unsafe fn css_get(memcg: *mut MemCgroup, nr: usize) {
+    (*memcg).refcnt.fetch_add(nr, Ordering::Relaxed);
+}
+
+/// 放下引用，最后一个引用释放控制组并放下父组的引用 (css_put_many)
+///
+/// # Safety
+/// memcg 必须有效，nr 不超过调用者持有的引用数
+pub unsafe fn css_put(mut memcg: *mut MemCgroup, mut nr: usize) {
+    while !memcg.is_null() && (*memcg).refcnt.fetch_sub(nr, Ordering::AcqRel) == nr {
+        let parent = (*memcg).parent;
+        drop(Box::from_raw(memcg));
+        memcg = parent;
+        nr = 1;
+    }
+}
+
+/// 当前任务所在组的控制组，并取得一个引用 (get_mem_cgroup_from_current)
+///
+/// 根组的任务、软中断上下文和调度器启动前返回 null（不计费）
+fn get_mem_cgroup_from_current() -> *mut MemCgroup {
+    if crate::softirq::in_softirq() {
+        return core::ptr::null_mut();
+    }
+    match crate::sched::current() {
+        Some(task) if !task.se.group.is_null() => crate::sched::group::task_get_memcg(task),
+        _ => core::ptr::null_mut(),
+    }
+}
+
+/// memcg 是否是 root 本身或 root 的后代 (mem_cgroup_is_descendant)
+///
+/// # Safety
+/// memcg 为 null 或有效
+pub unsafe fn mem_cgroup_is_descendant(mut memcg: *mut MemCgroup, root: *mut MemCgroup) -> bool {
+    while !memcg.is_null() {
+        if memcg == root {
+            return true;
+        }
+        memcg = (*memcg).parent;
+    }
+    false
+}
+
+/// memcg 及其祖先中已达到 memory.max 的最高一级，都没有达到时返回 null
+///
+/// 计费失败后 OOM killer 在这一级的任务中选择受害者 (mem_cgroup_oom)
+///
+/// # Safety
+/// memcg 为 null 或有效
+pub unsafe fn mem_cgroup_oom_domain(mut memcg: *mut MemCgroup) -> *mut MemCgroup {
+    let mut domain = core::ptr::null_mut();
+    while !memcg.is_null() {
+        let counter = &*memcg;
+        if counter.usage.load(Ordering::Relaxed) >= counter.max.load(Ordering::Relaxed) {
+            domain = memcg;
+        }
+        memcg = counter.parent;
+    }
+    domain
+}
+
+/// 页所属的控制组，没有计费时返回 null (folio_memcg)
+pub fn page_memcg(pfn: usize) -> *mut MemCgroup {
+    let page = pfn_to_page(pfn);
+    if page.is_null() {
+        return core::ptr::null_mut();
+    }
+    (unsafe { (*page).memcg_data() } & !MEMCG_DATA_STAT_MASK) as *mut MemCgroup
+}
+
+#[inline]
+fn memcg_event(memcg: &MemCgroup, event: MemcgEvent) {
+    memcg.events[event as usize].fetch_add(1, Ordering::Relaxed);
+}
+
+/// 从 memcg 起逐级增加用量 (page_counter_try_charge)
+///
+/// # 返回
+/// 某一级超过 memory.max 时撤销已加上的部分，返回该级
+unsafe fn page_counter_try_charge(memcg: *mut MemCgroup, nr: usize) -> Result<(), *mut MemCgroup> {
+    let mut c = memcg;
+    while !c.is_null() {
+        let counter = &*c;
+        let new = counter.usage.fetch_add(nr, Ordering::Relaxed) + nr;
+        if new > counter.max.load(Ordering::Relaxed) {
+            counter.usage.fetch_sub(nr, Ordering::Relaxed);
+            let mut undo = memcg;
+            while undo != c {
+                (*undo).usage.fetch_sub(nr, Ordering::Relaxed);
+                undo = (*undo).parent;
+            }
+            return Err(c);
+        }
+        counter.watermark.fetch_max(new, Ordering::Relaxed);
+        c = counter.parent;
+    }
+    Ok(())
+}
+
+/// 从 memcg 起逐级扣除用量 (page_counter_uncharge)
+unsafe fn page_counter_uncharge(mut memcg: *mut MemCgroup, nr: usize) {
+    while !memcg.is_null() {
+        (*memcg).usage.fetch_sub(nr, Ordering::Relaxed);
+        memcg = (*memcg).parent;
+    }
+}
+
+/// 超过 memory.high 的各级同步回收到 high 以下 (reclaim_high)
+unsafe fn reclaim_high(mut memcg: *mut MemCgroup) {
+    while !memcg.is_null() {
+        let counter = &*memcg;
+        let usage = counter.usage.load(Ordering::Relaxed);
+        let high = counter.high.load(Ordering::Relaxed);
+        if usage > high {
+            memcg_event(counter, MemcgEvent::High);
+            super::vmscan::try_to_free_mem_cgroup_pages(memcg, usage - high);
+        }
+        memcg = counter.parent;
+    }
+}
+
+/// 计费 nr 页，超过 memory.max 时定向回收后重试 (try_charge_memcg)
+///
+/// # 返回
+/// 回收后仍超过限制时返回 false
+unsafe fn try_charge(memcg: *mut MemCgroup, nr: usize) -> bool {
+    let mut retries = 0;
+    loop {
+        match page_counter_try_charge(memcg, nr) {
+            Ok(()) => break,
+            Err(over) => {
+                memcg_event(&*over, MemcgEvent::Max);
+                if retries == MAX_RECLAIM_RETRIES {
+                    memcg_event(&*over, MemcgEvent::Oom);
+                    return false;
+                }
+                retries += 1;
+                super::vmscan::try_to_free_mem_cgroup_pages(over, nr);
+            }
+        }
+    }
+    reclaim_high(memcg);
+    true
+}
+
+/// 把页计到 memcg 中，消耗调用者持有的一个引用
+///
+/// # Safety
+/// memcg 必须有效
+unsafe fn charge_memcg(memcg: *mut MemCgroup, frame: &PhysFrame, stat: MemcgStat) -> bool {
+    let page = pfn_to_page(frame.number);
+    if page.is_null() {
+        css_put(memcg, 1);
+        return true;
+    }
+    if !try_charge(memcg, 1) {
+        css_put(memcg, 1);
+        return false;
+    }
+    let mut c = memcg;
+    while !c.is_null() {
+        (*c).stat[stat as usize].fetch_add(1, Ordering::Relaxed);
+        c = (*c).parent;
+    }
+    (*page).set_memcg_data(memcg as usize | stat as usize);
+    true
+}
+
+/// 把新分配的页计到当前任务的组 (mem_cgroup_charge)
+///
+/// # 返回
+/// 超过组的 memory.max 且回收不出内存时返回 false，调用者应释放页并报告内存不足；
+/// 不需要计费时返回 true
+pub fn mem_cgroup_charge(frame: &PhysFrame, stat: MemcgStat) -> bool {
+    let memcg = get_mem_cgroup_from_current();
+    if memcg.is_null() {
+        return true;
+    }
+    unsafe { charge_memcg(memcg, frame, stat) }
+}
+
+/// 把页计到指定的组
+///
+/// # Safety
+/// memcg 必须有效（持有任务组锁之外的引用或组未被删除）
+pub unsafe fn mem_cgroup_charge_to(memcg: *mut MemCgroup, frame: &PhysFrame, stat: MemcgStat) -> bool {
+    if memcg.is_null() {
+        return true;
+    }
+    css_get(memcg, 1);
+    charge_memcg(memcg, frame, stat)
+}
+
+/// 分配一个页并计到当前任务的组
+///
+/// # 返回
+/// 分配失败或超过组的限制时返回 None
+pub fn mem_cgroup_alloc_page(stat: MemcgStat) -> Option<PhysFrame> {
+    let frame = super::pcp::alloc_user_page()?;
+    if !mem_cgroup_charge(&frame, stat) {
+        super::pcp::free_user_page(frame);
+        return None;
+    }
+    Some(frame)
+}
+
+/// 分配清零的用户页并计费 (GFP_ZERO)，先从预清零页池中取 (mm::prezero)
+pub fn mem_cgroup_alloc_zeroed_page(stat: MemcgStat) -> Option<PhysFrame> {
+    let frame = super::prezero::alloc_zeroed_user_page()?;
+    if !mem_cgroup_charge(&frame, stat) {
+        super::pcp::free_user_page(frame);
+        return None;
+    }
+    Some(frame)
+}
+
+/// 页释放时从所属组扣除 (mem_cgroup_uncharge)
+///
+/// 由 free_page_pcp 调用，没有计费的页直接返回
+pub fn mem_cgroup_uncharge(frame: &PhysFrame) {
+    let page = pfn_to_page(frame.number);
+    if page.is_null() {
+        return;
+    }
+    let data = unsafe { (*page).take_memcg_data() };
+    if data == 0 {
+        return;
+    }
+    let memcg = (data & !MEMCG_DATA_STAT_MASK) as *mut MemCgroup;
+    let stat = data & MEMCG_DATA_STAT_MASK;
+    unsafe {
+        page_counter_uncharge(memcg, 1);
+        let mut c = memcg;
+        while !c.is_null() {
+            (*c).stat[stat].fetch_sub(1, Ordering::Relaxed);
+            c = (*c).parent;
+        }
+        css_put(memcg, 1);
+    }
+}
+
+/// 设置 memory.max 并回收到限制以下 (memory_max_write)
+///
+/// 回收不出内存时保留超出的用量，之后的计费失败
+///
+/// # Safety
+/// memcg 必须有效
+pub unsafe fn memory_max_write(memcg: *mut MemCgroup, max: usize) {
+    let counter = &*memcg;
+    counter.max.store(max, Ordering::Relaxed);
+    for _ in 0..MAX_RECLAIM_RETRIES {
+        let usage = counter.usage.load(Ordering::Relaxed);
+        if usage <= max {
+            return;
+        }
+        memcg_event(counter, MemcgEvent::Max);
+        if super::vmscan::try_to_free_mem_cgroup_pages(memcg, usage - max) == 0 {
+            break;
+        }
+    }
+    if counter.usage.load(Ordering::Relaxed) > max {
+        memcg_event(counter, MemcgEvent::Oom);
+    }
+}
+
+/// 设置 memory.high 并回收一次 (memory_high_write)
+///
+/// # Safety
+/// memcg 必须有效
+pub unsafe fn memory_high_write(memcg: *mut MemCgroup, high: usize) {
+    let counter = &*memcg;
+    counter.high.store(high, Ordering::Relaxed);
+    let usage = counter.usage.load(Ordering::Relaxed);
+    if usage > high {
+        super::vmscan::try_to_free_mem_cgroup_pages(memcg, usage - high);
+    }
+}
+
+/// 读取用量、限制与统计
+///
+/// # Safety
+/// memcg 必须有效
+pub unsafe fn mem_cgroup_stats(memcg: *mut MemCgroup) -> MemcgStats {
+    let counter = &*memcg;
+    let mut stats = MemcgStats {
+        usage: counter.usage.load(Ordering::Relaxed),
+        max: counter.max.load(Ordering::Relaxed),
+        high: counter.high.load(Ordering::Relaxed),
+        peak: counter.watermark.load(Ordering::Relaxed),
+        ..MemcgStats::default()
+    };
+    for (out, stat) in stats.stat.iter_mut().zip(counter.stat.iter()) {
+        *out = stat.load(Ordering::Relaxed);
+    }
+    for (out, event) in stats.events.iter_mut().zip(counter.events.iter()) {
+        *out = event.load(Ordering::Relaxed);
+    }
+    stats
+}
@@ -42,6 +42,12 @@ pub struct MemoryInfo {
     pub heap_used: usize,
     /// 堆空闲（字节）
     pub heap_free: usize,
+    /// 堆扩展块数量
+    pub heap_chunks: usize,
+    /// 堆扩展次数
+    pub heap_grows: usize,
+    /// 堆扩展块归还次数
+    pub heap_shrinks: usize,
 
     // ========== Slab 分配器 ==========
     /// Slab 页数
@@ -50,6 +56,10 @@ pub struct MemoryInfo {
     pub slab_allocs: usize,
     /// Slab 释放次数
     pub slab_frees: usize,
+    /// 每 CPU 弹匣命中次数
+    pub slab_magazine_hits: usize,
+    /// 每 CPU 弹匣未命中次数
+    pub slab_magazine_misses: usize,
 
     // ========== Per-CPU Pages ==========
     /// 各 CPU 的 PCP 页数
@@ -82,9 +92,14 @@ impl Default for MemoryInfo {
             heap_total: 0,
             heap_used: 0,
             heap_free: 0,
+            heap_chunks: 0,
+            heap_grows: 0,
+            heap_shrinks: 0,
             slab_pages: 0,
             slab_allocs: 0,
             slab_frees: 0,
+            slab_magazine_hits: 0,
+            slab_magazine_misses: 0,
             pcp_pages: [0; 4],
             pages_free: 0,
             pages_used: 0,
@@ -120,10 +135,15 @@ impl<'a> core::fmt::Display for MemoryInfoFormatter<'a> {
         writeln!(f, "  HeapTotal:      {:>10} kB ({} MB)", self.info.heap_total / 1024, self.info.heap_total / 1024 / 1024)?;
         writeln!(f, "  HeapUsed:       {:>10} kB ({} MB)", self.info.heap_used / 1024, self.info.heap_used / 1024 / 1024)?;
         writeln!(f, "  HeapFree:       {:>10} kB ({} MB)", self.info.heap_free / 1024, self.info.heap_free / 1024 / 1024)?;
+        writeln!(f, "  HeapChunks:     {:>10}", self.info.heap_chunks)?;
+        writeln!(f, "  HeapGrows:      {:>10}", self.info.heap_grows)?;
+        writeln!(f, "  HeapShrinks:    {:>10}", self.info.heap_shrinks)?;
         writeln!(f)?;
         writeln!(f, "  SlabPages:      {:>10} pages", self.info.slab_pages)?;
         writeln!(f, "  SlabAllocs:     {:>10}", self.info.slab_allocs)?;
         writeln!(f, "  SlabFrees:      {:>10}", self.info.slab_frees)?;
+        writeln!(f, "  SlabMagHits:    {:>10}", self.info.slab_magazine_hits)?;
+        writeln!(f, "  SlabMagMisses:  {:>10}", self.info.slab_magazine_misses)?;
         writeln!(f)?;
         writeln!(f, "  PCP Pages:      CPU0={} CPU1={} CPU2={} CPU3={}",
             self.info.pcp_pages[0], self.info.pcp_pages[1],
@@ -155,12 +175,17 @@ pub fn get_memory_info() -> MemoryInfo {
     info.heap_total = buddy_stats.heap_size;
     info.heap_used = buddy_stats.used_bytes;
     info.heap_free = buddy_stats.free_bytes;
+    info.heap_chunks = buddy_stats.nr_chunks;
+    info.heap_grows = buddy_stats.grow_count;
+    info.heap_shrinks = buddy_stats.shrink_count;
 
     // Slab 统计
     let slab_stats = slab_stats();
     info.slab_pages = slab_stats.total_pages;
     info.slab_allocs = slab_stats.cache_stats.iter().map(|c| c.alloc_count).sum();
     info.slab_frees = slab_stats.cache_stats.iter().map(|c| c.free_count).sum();
+    info.slab_magazine_hits = slab_stats.cache_stats.iter().map(|c| c.magazine_hits).sum();
+    info.slab_magazine_misses = slab_stats.cache_stats.iter().map(|c| c.magazine_misses).sum();
 
     // Per-CPU Pages 统计
     let pcp_stats = pcp_stats();
@@ -12,8 +12,22 @@ pub mod page_desc;
 pub mod vma;
 pub mod pagemap;
 pub mod slab;
+pub mod kmem_cache;
 pub mod pcp;
+pub mod xarray;
+pub mod filemap;
+pub mod vmscan;
+pub mod writeback;
 pub mod meminfo;
+pub mod vmstat;
+pub mod memcontrol;
+pub mod oom_kill;
+pub mod zsmalloc;
+pub mod zswap;
+pub mod compaction;
+pub mod ksm;
+pub mod khugepaged;
+pub mod prezero;
 
 pub use page::*;
 pub use page_desc::{Page, PageFlag, PageFlags, PageType};
@@ -28,12 +42,16 @@ pub const USER_VIRT_BASE: usize = 0x0000_0000_1000_0000;
 pub const USER_VIRT_TOP: usize = 0x0000_0000_7fff_ffff;
 
 pub use allocator::init_heap;
-pub use page_desc::{init_mem_map, mem_map, pfn_to_page, pfn_to_page_mut, page_to_pfn};
+pub use page_desc::{init_mem_map, sparse_init, pfn_valid, pfn_to_page, pfn_to_page_mut, page_to_pfn};
 pub use slab::{kmalloc, kfree, kzalloc, init_slab, slab_stats};
+pub use kmem_cache::{
+    kmem_cache_create, kmem_cache_alloc, kmem_cache_free, kmem_cache_shrink,
+    KmemCache, SLAB_HWCACHE_ALIGN, SLAB_CACHE_COLOUR,
+};
 pub use pcp::{
     init_percpu_pages, alloc_page_pcp, free_page_pcp,
     alloc_kernel_page, alloc_user_page, free_kernel_page, free_user_page,
-    pcp_stats, MigrateType, GFP_KERNEL, GFP_USER,
+    pcp_stats, drain_all_pages, MigrateType, GFP_KERNEL, GFP_USER,
 };
 pub use meminfo::{
     get_memory_info, print_memory_info, get_memory_summary,
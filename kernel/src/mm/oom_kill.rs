@@ -0,0 +1,308 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! OOM killer
+//!
+//! 参考 Linux: mm/oom_kill.c
+//!
+//! 用户缺页分配失败、回收也无济于事时 (pagefault_out_of_memory)，选出一个进程发送 SIGKILL，
+//! 缺页指令在返回后重新执行：
+//! - 评分 (oom_badness)：驻留页数加上 oom_score_adj × 总页数 / 1000；
+//!   oom_score_adj 为 -1000 的进程、init 和内核线程不会被选中
+//! - 共享同一地址空间的进程一起杀死；上一个受害者还没有退出时不选新的受害者
+//! - 受害者退出时 (exit_mmap) 还需要分配少量页，分配失败时可以动用预留页 (ALLOC_OOM)；
+//!   预留页在 CPU 0 的空闲循环中补满
+//! - 超过内存控制组 memory.max 引起的失败只在该组的任务中选择 (mem_cgroup_out_of_memory)
+//! - 找不到可杀的进程时杀死当前进程，系统保持运行
+
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicI32, AtomicUsize, Ordering};
+use spin::Mutex;
+
+use super::memcontrol::{self, MemCgroup};
+use super::page::{frame_stats, PhysFrame, PAGE_SIZE};
+use super::pagemap::AddressSpace;
+use crate::process::task::{Pid, Task, TaskState};
+
+/// oom_score_adj 的取值范围 (OOM_SCORE_ADJ_MIN / OOM_SCORE_ADJ_MAX)
+pub const OOM_SCORE_ADJ_MIN: i32 = -1000;
+pub const OOM_SCORE_ADJ_MAX: i32 = 1000;
+
+/// 给受害者预留的页数
+pub const OOM_RESERVE_PAGES: usize = 64;
+
+/// 任务的 OOM 状态 (signal_struct::oom_score_adj, TIF_MEMDIE)
+pub struct TaskOom {
+    /// 评分调整，fork 时继承，写入时作用于整个线程组
+    pub score_adj: AtomicI32,
+    /// 已被 OOM killer 选中，分配失败时可以动用预留页
+    pub victim: AtomicBool,
+}
+
+impl TaskOom {
+    pub const fn new() -> Self {
+        Self {
+            score_adj: AtomicI32::new(0),
+            victim: AtomicBool::new(false),
+        }
+    }
+
+    #[inline]
+    pub fn is_victim(&self) -> bool {
+        self.victim.load(Ordering::Acquire)
+    }
+}
+
+/// 预留页 (memory reserves)
+struct OomReserve {
+    frames: [usize; OOM_RESERVE_PAGES],
+    nr: usize,
+}
+
+static OOM_RESERVE: Mutex<OomReserve> = Mutex::new(OomReserve { frames: [0; OOM_RESERVE_PAGES], nr: 0 });
+
+/// 同一时间只有一个 OOM killer 在选择受害者 (oom_lock)
+static OOM_LOCK: Mutex<()> = Mutex::new(());
+
+/// 统计：杀死的进程数 (oom_kill)
+static NR_OOM_KILLS: AtomicUsize = AtomicUsize::new(0);
+
+/// 进程的评分 (oom_badness)
+///
+/// # 返回
+/// oom_score_adj 为 OOM_SCORE_ADJ_MIN 时返回 None（不可杀）；否则至少为 1
+pub fn oom_badness(mm: &AddressSpace, score_adj: i32, totalpages: usize) -> Option<usize> {
+    if score_adj == OOM_SCORE_ADJ_MIN {
+        return None;
+    }
+    let vmas: Vec<super::vma::Vma> = mm.vma_read().iter().copied().collect();
+    let rss: u64 = vmas.iter().map(|vma| mm.smaps(vma).resident).sum();
+    let points = (rss / PAGE_SIZE as u64) as isize + score_adj as isize * (totalpages / 1000) as isize;
+    Some(points.max(1) as usize)
+}
+
+/// 评分换算到 /proc/<pid>/oom_score 的 0..2000 (proc_oom_score)
+///
+/// 要遍历页表，调用者不能持有任务表锁
+pub fn oom_score(mm: &AddressSpace, score_adj: i32) -> usize {
+    let totalpages = frame_stats().total_frames.max(1);
+    oom_badness(mm, score_adj, totalpages).map_or(0, |points| points * 1000 / totalpages)
+}
+
+/// 设置线程组中所有任务的 oom_score_adj (oom_score_adj_write)
+///
+/// # 返回
+/// 超出范围返回 EINVAL，进程不存在返回 ESRCH
+pub fn set_oom_score_adj(pid: Pid, score_adj: i32) -> Result<(), i32> {
+    if !(OOM_SCORE_ADJ_MIN..=OOM_SCORE_ADJ_MAX).contains(&score_adj) {
+        return Err(crate::errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    let tgid = crate::sched::sched::with_task(pid, |task| task.tgid())
+        .ok_or(crate::errno::Errno::NoSuchProcess.as_neg_i32())?;
+    crate::sched::sched::for_each_task(|task| unsafe {
+        if (*task).tgid() == tgid {
+            (*task).oom.score_adj.store(score_adj, Ordering::Relaxed);
+        }
+    });
+    Ok(())
+}
+
+/// 候选进程
+struct OomCandidate {
+    pid: Pid,
+    mm: Arc<AddressSpace>,
+    score_adj: i32,
+}
+
+/// 任务是否在 memcg 的子树中；memcg 为 null 时是全局 OOM，所有任务都是候选
+fn task_in_memcg(task: &Task, memcg: *mut MemCgroup) -> bool {
+    if memcg.is_null() {
+        return true;
+    }
+    let task_memcg = crate::sched::group::task_get_memcg(task);
+    if task_memcg.is_null() {
+        return false;
+    }
+    unsafe {
+        let within = memcontrol::mem_cgroup_is_descendant(task_memcg, memcg);
+        memcontrol::css_put(task_memcg, 1);
+        within
+    }
+}
+
+/// 选出评分最高的进程 (select_bad_process)
+///
+/// # 返回
+/// 上一个受害者还没有退出时返回 Err，调用者等它释放内存；没有可杀的进程时返回 Ok(None)
+fn select_bad_process(memcg: *mut MemCgroup) -> Result<Option<OomCandidate>, ()> {
+    let mut candidates: Vec<OomCandidate> = Vec::new();
+    let mut abort = false;
+    crate::sched::sched::for_each_task(|task| unsafe {
+        let task = &*task;
+        let state = task.state();
+        if task.pid() == 0 || task.tgid() == 1 || state == TaskState::Zombie || state == TaskState::Dead {
+            return;
+        }
+        let mm = match task.address_space_arc() {
+            Some(mm) => mm,
+            None => return,
+        };
+        if !task_in_memcg(task, memcg) {
+            return;
+        }
+        if task.oom.is_victim() {
+            abort = true;
+            return;
+        }
+        // 共享地址空间的线程只评一次
+        if candidates.iter().any(|c| Arc::ptr_eq(&c.mm, &mm)) {
+            return;
+        }
+        candidates.push(OomCandidate { pid: task.pid(), mm, score_adj: task.oom.score_adj.load(Ordering::Relaxed) });
+    });
+    if abort {
+        return Err(());
+    }
+
+    // 评分要遍历页表，在任务表锁外进行
+    let totalpages = frame_stats().total_frames;
+    let mut chosen: Option<(usize, OomCandidate)> = None;
+    for candidate in candidates {
+        let points = match oom_badness(&candidate.mm, candidate.score_adj, totalpages) {
+            Some(points) => points,
+            None => continue,
+        };
+        if chosen.as_ref().map_or(true, |&(best, _)| points > best) {
+            chosen = Some((points, candidate));
+        }
+    }
+    Ok(chosen.map(|(_, candidate)| candidate))
+}
+
+/// 杀死使用 mm 的所有任务 (oom_kill_process / __oom_kill_process)
+fn oom_kill_process(victim: &OomCandidate, message: &str) {
+    let mut pids: Vec<Pid> = Vec::new();
+    crate::sched::sched::for_each_task(|task| unsafe {
+        if let Some(mm) = (*task).address_space() {
+            if core::ptr::eq(mm, Arc::as_ptr(&victim.mm)) {
+                (*task).oom.victim.store(true, Ordering::Release);
+                pids.push((*task).pid());
+            }
+        }
+    });
+    let comm = crate::sched::sched::with_task(victim.pid, |task| task.comm()).unwrap_or_default();
+    crate::println!(
+        "{}: Killed process {} ({}) oom_score_adj:{}",
+        message, victim.pid, comm, victim.score_adj,
+    );
+    for pid in pids {
+        let _ = crate::sched::send_signal(pid, crate::signal::Signal::SIGKILL as i32);
+    }
+    NR_OOM_KILLS.fetch_add(1, Ordering::Relaxed);
+}
+
+/// 选择并杀死一个进程 (out_of_memory)
+///
+/// memcg 不为 null 时只在该组的任务中选择
+///
+/// # 返回
+/// 已杀死进程、或有受害者正在退出、或其他 CPU 正在处理时返回 true；没有可杀的进程时返回 false
+pub fn out_of_memory(memcg: *mut MemCgroup) -> bool {
+    let _oom = match OOM_LOCK.try_lock() {
+        Some(guard) => guard,
+        None => return true,
+    };
+    match select_bad_process(memcg) {
+        Err(()) => true,
+        Ok(Some(victim)) => {
+            let message = if memcg.is_null() { "Out of memory" } else { "Memory cgroup out of memory" };
+            oom_kill_process(&victim, message);
+            true
+        }
+        Ok(None) => false,
+    }
+}
+
+/// 用户缺页返回 OutOfMemory 后调用 (pagefault_out_of_memory)
+///
+/// 返回后重新执行缺页指令：当前任务被选中时在返回用户态前处理 SIGKILL，
+/// 否则等受害者释放内存后重试
+pub fn pagefault_out_of_memory() {
+    let task = match crate::sched::current() {
+        Some(task) => task,
+        None => return,
+    };
+    if task.oom.is_victim() || task.pending.has(crate::signal::Signal::SIGKILL as i32) {
+        return;
+    }
+
+    let memcg = crate::sched::group::task_get_memcg(task);
+    let oom_memcg = if memcg.is_null() { memcg } else { unsafe { memcontrol::mem_cgroup_oom_domain(memcg) } };
+    if oom_memcg.is_null() {
+        // 全局：回收后空闲页回到最低水位以上时只是暂时失败，直接重试
+        let (min, _, _) = super::vmscan::watermarks();
+        if super::vmscan::try_to_free_pages() || frame_stats().free_frames >= min {
+            return;
+        }
+    }
+    if !out_of_memory(oom_memcg) {
+        // 没有可杀的进程：杀死当前进程，而不是让系统卡住
+        oom_kill_process(
+            &OomCandidate {
+                pid: task.pid(),
+                mm: task.address_space_arc().expect("user fault without mm"),
+                score_adj: task.oom.score_adj.load(Ordering::Relaxed),
+            },
+            "Out of memory and no killable processes",
+        );
+    }
+    unsafe { memcontrol::css_put(memcg, 1) };
+}
+
+/// 受害者从预留页分配 (ALLOC_OOM)
+///
+/// 由 alloc_page_pcp 在回收后仍失败时调用；当前任务不是受害者时返回 None
+pub fn oom_reserve_alloc() -> Option<PhysFrame> {
+    if !crate::sched::current().map_or(false, |task| task.oom.is_victim()) {
+        return None;
+    }
+    let mut reserve = OOM_RESERVE.lock();
+    if reserve.nr == 0 {
+        return None;
+    }
+    reserve.nr -= 1;
+    Some(PhysFrame::new(reserve.frames[reserve.nr]))
+}
+
+/// 空闲页高于高水位时补满预留页
+///
+/// 由 CPU 0 的空闲循环调用
+pub fn oom_reserve_refill() {
+    let (_, _, high) = super::vmscan::watermarks();
+    let mut reserve = match OOM_RESERVE.try_lock() {
+        Some(reserve) => reserve,
+        None => return,
+    };
+    while reserve.nr < OOM_RESERVE_PAGES && frame_stats().free_frames > high {
+        let frame = match super::pcp::alloc_user_page() {
+            Some(frame) => frame,
+            None => break,
+        };
+        let nr = reserve.nr;
+        reserve.frames[nr] = frame.number;
+        reserve.nr += 1;
+    }
+}
+
+/// 预留页数
+pub fn nr_reserved_pages() -> usize {
+    OOM_RESERVE.lock().nr
+}
+
+/// 杀死的进程数 (/proc/vmstat oom_kill)
+pub fn nr_oom_kills() -> usize {
+    NR_OOM_KILLS.load(Ordering::Relaxed)
+}
@@ -131,6 +131,7 @@ impl VirtPage {
 pub struct FrameAllocator {
     next_free: AtomicUsize,
     free_list: AtomicUsize,  // 空闲链表头（存储物理页号）
+    nr_free_listed: AtomicUsize, // 空闲链表中的页数
     total_frames: usize,
     use_page_desc: AtomicUsize, // 是否使用 Page 描述符
 }
@@ -143,6 +144,7 @@ impl FrameAllocator {
         Self {
             next_free: AtomicUsize::new(0),
             free_list: AtomicUsize::new(FREE_LIST_NULL),
+            nr_free_listed: AtomicUsize::new(0),
             total_frames,
             use_page_desc: AtomicUsize::new(0),
         }
@@ -189,6 +191,7 @@ impl FrameAllocator {
                 Ordering::Acquire,
             ) {
                 Ok(_) => {
+                    self.nr_free_listed.fetch_sub(1, Ordering::Relaxed);
                     // 分配成功，更新 Page 引用计数
                     if self.use_page_desc.load(Ordering::Acquire) == 1 {
                         let page = super::page_desc::pfn_to_page_mut(head);
@@ -196,6 +199,7 @@ impl FrameAllocator {
                             unsafe {
                                 (*page).set_refcount(1);
                                 (*page).set_flag(super::page_desc::PageFlag::Referenced);
+                                (*page).set_page_type(super::page_desc::PageType::Normal);
                             }
                         }
                     }
@@ -225,6 +229,39 @@ impl FrameAllocator {
         }
     }
 
+    /// 分配 nr 个物理连续、起始页号按 align 对齐的页帧 (alloc_contig_pages)
+    ///
+    /// 空闲链表中的页不保证连续，只从 bump 区域切出；对齐跳过的页帧放入空闲链表。
+    /// bump 区域用完后返回 None，调用者退回逐页分配
+    pub fn allocate_contig(&self, nr: usize, align: usize) -> Option<PhysFrame> {
+        let mut cur = self.next_free.load(Ordering::Acquire);
+        let start = loop {
+            let start = (cur + align - 1) & !(align - 1);
+            if start + nr > self.total_frames {
+                return None;
+            }
+            match self.next_free.compare_exchange_weak(cur, start + nr, Ordering::SeqCst, Ordering::Acquire) {
+                Ok(_) => break start,
+                Err(actual) => cur = actual,
+            }
+        };
+        for skipped in cur..start {
+            self.deallocate(PhysFrame::new(skipped));
+        }
+        if self.use_page_desc.load(Ordering::Acquire) == 1 {
+            for pfn in start..start + nr {
+                let page = super::page_desc::pfn_to_page_mut(pfn);
+                if !page.is_null() {
+                    unsafe {
+                        (*page).set_refcount(1);
+                        (*page).set_flag(super::page_desc::PageFlag::Referenced);
+                    }
+                }
+            }
+        }
+        Some(PhysFrame::new(start))
+    }
+
     pub fn deallocate(&self, frame: PhysFrame) {
         let frame_num = frame.number;
 
@@ -244,11 +281,12 @@ impl FrameAllocator {
                 let page = super::page_desc::pfn_to_page_mut(frame_num);
                 if !page.is_null() {
                     unsafe {
-                        // 重置 Page 状态
+                        // 重置 Page 状态，Buddy 类型标记页在空闲链表中（内存规整据此找空闲页）
                         (*page).set_refcount(0);
                         (*page).reset_mapcount();
                         (*page).clear_flag(super::page_desc::PageFlag::Referenced);
                         (*page).clear_flag(super::page_desc::PageFlag::Dirty);
+                        (*page).set_page_type(super::page_desc::PageType::Buddy);
                         // 设置空闲链表指针
                         (*page).set_next_free(head);
                     }
@@ -268,11 +306,67 @@ impl FrameAllocator {
                 Ordering::Release,
                 Ordering::Acquire,
             ) {
-                Ok(_) => return,  // 成功释放
+                Ok(_) => {
+                    // 成功释放
+                    self.nr_free_listed.fetch_add(1, Ordering::Relaxed);
+                    return;
+                }
                 Err(_) => continue,  // CAS 失败，重试
             }
         }
     }
+
+    /// 从空闲链表中摘下 [start, start + nr) 内的页 (isolate_freepages_range)
+    ///
+    /// 整条链表先取下，过滤后把其余的页一次接回；其间的分配看到空链表时退回 bump 区域。
+    /// 摘下的页在 isolated 位图中置位，状态保持空闲（引用计数 0、Buddy 类型）
+    ///
+    /// # 返回
+    /// 摘下的页数
+    pub fn isolate_range(&self, start: PhysFrameNr, nr: usize, isolated: &mut [u64]) -> usize {
+        if self.use_page_desc.load(Ordering::Acquire) != 1 {
+            return 0;
+        }
+        let mut cur = self.free_list.swap(FREE_LIST_NULL, Ordering::AcqRel);
+        let mut kept_head = FREE_LIST_NULL;
+        let mut kept_tail = FREE_LIST_NULL;
+        let mut nr_isolated = 0;
+        while cur != FREE_LIST_NULL {
+            let page = super::page_desc::pfn_to_page(cur);
+            let next = unsafe { (*page).next_free() };
+            if cur >= start && cur < start + nr {
+                let bit = cur - start;
+                isolated[bit / 64] |= 1 << (bit % 64);
+                nr_isolated += 1;
+            } else {
+                if kept_tail == FREE_LIST_NULL {
+                    kept_head = cur;
+                } else {
+                    unsafe { (*super::page_desc::pfn_to_page(kept_tail)).set_next_free(cur) };
+                }
+                kept_tail = cur;
+            }
+            cur = next;
+        }
+        self.nr_free_listed.fetch_sub(nr_isolated, Ordering::Relaxed);
+
+        // 其余的页接回链表头部，期间释放的页排在它们前面
+        if kept_tail != FREE_LIST_NULL {
+            let tail = super::page_desc::pfn_to_page(kept_tail);
+            loop {
+                let head = self.free_list.load(Ordering::Acquire);
+                unsafe { (*tail).set_next_free(head) };
+                if self
+                    .free_list
+                    .compare_exchange_weak(head, kept_head, Ordering::Release, Ordering::Acquire)
+                    .is_ok()
+                {
+                    break;
+                }
+            }
+        }
+        nr_isolated
+    }
 }
 
 static FRAME_ALLOCATOR: FrameAllocator = FrameAllocator::new(TOTAL_FRAMES);
@@ -284,18 +378,48 @@ pub fn init_frame_allocator(start_frame: PhysFrameNr) {
 /// 初始化页描述符支持
 ///
 /// 必须在 init_frame_allocator 之后调用
-pub fn init_page_descriptors(start_frame: PhysFrameNr, nr_pages: usize) {
-    // 初始化页描述符数组
-    super::page_desc::init_mem_map(start_frame, nr_pages);
+///
+/// # 参数
+/// - `ranges`: RAM 区间列表 (起始 PFN, 页数)，通常来自设备树
+///
+/// # 返回
+/// 有页描述符的 RAM 页数
+pub fn init_page_descriptors(ranges: &[(PhysFrameNr, usize)]) -> usize {
+    // 按 section 分配页描述符数组
+    let nr_pages = super::page_desc::sparse_init(ranges);
 
     // 启用分配器的页描述符支持
     FRAME_ALLOCATOR.enable_page_desc();
+    nr_pages
 }
 
 pub fn alloc_frame() -> Option<PhysFrame> {
     FRAME_ALLOCATOR.allocate()
 }
 
+/// 分配 nr 个物理连续、按 align 页对齐的页帧，每页引用计数为 1，逐页释放
+///
+/// bump 区域用完后规整已切出的区域，迁移可移动的页凑出连续的空闲块 (mm::compaction)
+pub fn alloc_contig_frames(nr: usize, align: usize) -> Option<PhysFrame> {
+    let frame = FRAME_ALLOCATOR
+        .allocate_contig(nr, align)
+        .or_else(|| super::compaction::try_to_compact_pages(nr, align));
+    if frame.is_some() {
+        super::vmstat::count_pgalloc(super::vmstat::nr_pages_order(nr));
+    }
+    frame
+}
+
+/// 从空闲链表摘下 [start, start + nr) 内的页，由内存规整调用
+pub(crate) fn isolate_free_frames(start: PhysFrameNr, nr: usize, isolated: &mut [u64]) -> usize {
+    FRAME_ALLOCATOR.isolate_range(start, nr, isolated)
+}
+
+/// 分配器已切出的页帧范围 [起始, bump 位置)，之后的页帧从未分配过
+pub(crate) fn allocated_frame_range() -> (PhysFrameNr, PhysFrameNr) {
+    (PHYS_MEMORY_BASE_FRAME, FRAME_ALLOCATOR.next_free.load(Ordering::Acquire).min(FRAME_ALLOCATOR.total_frames))
+}
+
 pub fn dealloc_frame(frame: PhysFrame) {
     FRAME_ALLOCATOR.deallocate(frame)
 }
@@ -320,7 +444,9 @@ pub struct FrameStats {
 /// 获取物理页帧分配器统计信息
 pub fn frame_stats() -> FrameStats {
     let total = FRAME_ALLOCATOR.total_frames;
-    let allocated = FRAME_ALLOCATOR.next_free.load(Ordering::Acquire);
+    // 释放到空闲链表的页也计入空闲页
+    let free_listed = FRAME_ALLOCATOR.nr_free_listed.load(Ordering::Acquire);
+    let allocated = FRAME_ALLOCATOR.next_free.load(Ordering::Acquire).saturating_sub(free_listed);
     let free = total.saturating_sub(allocated);
 
     FrameStats {
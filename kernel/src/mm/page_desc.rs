@@ -12,7 +12,7 @@
 //! - 其他元数据
 //!
 
-use core::sync::atomic::{AtomicI32, AtomicU32, AtomicUsize, Ordering};
+use core::sync::atomic::{AtomicI32, AtomicPtr, AtomicU32, AtomicUsize, Ordering};
 
 use super::page::{PhysAddr, PhysFrame, PhysFrameNr, VirtAddr, PAGE_SIZE};
 
@@ -124,6 +124,8 @@ pub enum PageType {
     PageCache = 3,
     /// 匿名页
     Anonymous = 4,
+    /// 内容相同而合并、由多个映射只读共享的匿名页 (PageKsm)
+    Ksm = 5,
 }
 
 /// 页描述符
@@ -138,7 +140,7 @@ pub enum PageType {
 /// - mapping: 8 字节（关联的 address_space，用于文件映射）
 /// - index: 8 字节（在映射中的偏移）
 /// - _type: 4 字节（页类型）
-/// - _reserved: 4 字节（保留）
+/// - _section: 4 字节（所属 mem_section 编号）
 /// - next_free: 8 字节（空闲链表指针，用于分配器）
 /// - _pad: 12 字节（填充到 64 字节）
 ///
@@ -172,11 +174,16 @@ pub struct Page {
     /// 页类型（用于特殊页面）
     _type: AtomicU32,
 
-    /// 保留字段
-    _reserved: AtomicU32,
+    /// 所属 mem_section 编号 (page_to_section)
+    ///
+    /// Linux 把 section 编号编码在 page->flags 高位，这里单独存放
+    _section: AtomicU32,
 
     /// 空闲链表指针（用于分配器内部使用）
     next_free: AtomicUsize,
+
+    /// 计费的内存控制组与类型 (memcg_data)，没有计费时为 0
+    memcg_data: AtomicUsize,
 }
 
 /// 映射计数的初始偏移值（-1 表示未映射）
@@ -193,8 +200,9 @@ impl Page {
             mapping: AtomicUsize::new(0),
             index: AtomicUsize::new(0),
             _type: AtomicU32::new(PageType::Normal as u32),
-            _reserved: AtomicU32::new(0),
+            _section: AtomicU32::new(0),
             next_free: AtomicUsize::new(0),
+            memcg_data: AtomicUsize::new(0),
         }
     }
 
@@ -212,6 +220,7 @@ impl Page {
         self.private.store(0, Ordering::Release);
         self.mapping.store(0, Ordering::Release);
         self.index.store(0, Ordering::Release);
+        self.memcg_data.store(0, Ordering::Release);
     }
 
     // ========== 标志位操作 ==========
@@ -379,6 +388,23 @@ impl Page {
         self.private.store(value, Ordering::Release);
     }
 
+    /// 取出私有数据并清零，并发调用时只有一个调用者拿到非零值
+    #[inline]
+    pub fn take_private(&self) -> usize {
+        self.private.swap(0, Ordering::AcqRel)
+    }
+
+    /// 私有数据为 0 时设置为 value
+    ///
+    /// # 返回
+    /// 设置成功返回 true
+    #[inline]
+    pub fn try_set_private(&self, value: usize) -> bool {
+        self.private
+            .compare_exchange(0, value, Ordering::AcqRel, Ordering::Acquire)
+            .is_ok()
+    }
+
     // ========== 映射信息操作 ==========
 
     /// 获取关联的 address_space
@@ -405,6 +431,26 @@ impl Page {
         self.index.store(index, Ordering::Release);
     }
 
+    // ========== 内存控制组 ==========
+
+    /// 获取计费信息
+    #[inline]
+    pub fn memcg_data(&self) -> usize {
+        self.memcg_data.load(Ordering::Acquire)
+    }
+
+    /// 设置计费信息
+    #[inline]
+    pub fn set_memcg_data(&self, data: usize) {
+        self.memcg_data.store(data, Ordering::Release);
+    }
+
+    /// 取出计费信息并清零，并发调用时只有一个调用者拿到非零值
+    #[inline]
+    pub fn take_memcg_data(&self) -> usize {
+        self.memcg_data.swap(0, Ordering::AcqRel)
+    }
+
     // ========== 页类型操作 ==========
 
     /// 获取页类型
@@ -416,6 +462,7 @@ impl Page {
             2 => PageType::Slab,
             3 => PageType::PageCache,
             4 => PageType::Anonymous,
+            5 => PageType::Ksm,
             _ => PageType::Normal,
         }
     }
@@ -441,116 +488,178 @@ impl Page {
     }
 }
 
-// ========== 全局页数组 (mem_map) ==========
+// ========== 稀疏页数组 (SPARSEMEM) ==========
+//
+// 参考 Linux: mm/sparse.c, include/linux/mmzone.h
+//
+// 物理地址空间按 section 划分，只有包含 RAM 的 section 才分配页描述符数组
+// (section_mem_map)，空洞不占用内存。
+// 启动时根据设备树的内存节点调用 sparse_init。
 
 /// 物理内存常量
 pub const PHYS_MEMORY_BASE: usize = 0x8000_0000; // QEMU virt: 物理内存起始地址
 pub const PHYS_MEMORY_SIZE: usize = 2 * 1024 * 1024 * 1024; // 2GB
 pub const MAX_PFN: usize = (PHYS_MEMORY_BASE + PHYS_MEMORY_SIZE) / PAGE_SIZE;
 
-/// 页数组的大小
-///
-/// 注意：MEM_MAP 数组大小 = MAX_PAGES * sizeof(Page) = MAX_PAGES * 64 字节
-/// - 16384 页 = 64MB 物理内存 = 1MB 描述符
-/// - 32768 页 = 128MB 物理内存 = 2MB 描述符
-/// - 65536 页 = 256MB 物理内存 = 4MB 描述符
+/// section 大小为 2^SECTION_SIZE_BITS 字节（16MB）
 ///
-/// 当前设置为 16384 以避免链接时内存布局冲突
-pub const MAX_PAGES: usize = 16384; // 64MB = 16384 页
+/// 每个 section 的页描述符数组 = 4096 * 64 字节 = 256KB
+pub const SECTION_SIZE_BITS: usize = 24;
 
-/// 全局页数组
-///
-/// 存储所有物理页的描述符。
-/// 注意：这是一个静态数组，实际使用大小由物理内存决定。
-static mut MEM_MAP: [Page; MAX_PAGES] = {
-    // 使用 const fn 初始化
-    const INIT: Page = Page::new();
-    [INIT; MAX_PAGES]
-};
+/// section 内页号位数
+pub const PFN_SECTION_SHIFT: usize = SECTION_SIZE_BITS - 12;
+
+/// 每个 section 的页数
+pub const PAGES_PER_SECTION: usize = 1 << PFN_SECTION_SHIFT;
+
+/// 覆盖 [0, MAX_PFN) 所需的 section 数
+pub const NR_MEM_SECTIONS: usize = (MAX_PFN + PAGES_PER_SECTION - 1) >> PFN_SECTION_SHIFT;
+
+/// 内存 section (struct mem_section)
+struct MemSection {
+    /// 该 section 的页描述符数组，null 表示不存在（空洞）
+    section_mem_map: AtomicPtr<Page>,
+}
+
+impl MemSection {
+    const fn new() -> Self {
+        Self {
+            section_mem_map: AtomicPtr::new(core::ptr::null_mut()),
+        }
+    }
+}
+
+/// 全局 section 表
+static MEM_SECTIONS: [MemSection; NR_MEM_SECTIONS] = [const { MemSection::new() }; NR_MEM_SECTIONS];
 
 /// 页数组是否已初始化
 static MEM_MAP_INIT: AtomicUsize = AtomicUsize::new(0);
 
-/// 获取页数组的起始地址
+/// 有页描述符的 RAM 页数
+static NR_MANAGED_PAGES: AtomicUsize = AtomicUsize::new(0);
+
+/// 已分配页描述符数组的 section 数
+static NR_PRESENT_SECTIONS: AtomicUsize = AtomicUsize::new(0);
+
 #[inline]
-pub fn mem_map() -> *const Page {
-    unsafe { MEM_MAP.as_ptr() }
+pub const fn pfn_to_section_nr(pfn: PhysFrameNr) -> usize {
+    pfn >> PFN_SECTION_SHIFT
 }
 
-/// 获取页数组的可变起始地址
 #[inline]
-pub fn mem_map_mut() -> *mut Page {
-    unsafe { MEM_MAP.as_mut_ptr() }
+pub const fn section_nr_to_pfn(nr: usize) -> PhysFrameNr {
+    nr << PFN_SECTION_SHIFT
+}
+
+/// section 的页描述符数组布局
+fn section_map_layout() -> core::alloc::Layout {
+    core::alloc::Layout::from_size_align(
+        PAGES_PER_SECTION * core::mem::size_of::<Page>(),
+        core::mem::align_of::<Page>(),
+    )
+    .unwrap()
 }
 
-/// 初始化页数组
+/// 为一个 section 分配并初始化页描述符数组 (sparse_init_one_section)
 ///
-/// 初始化指定范围内的页描述符。
-/// 超出范围的页标记为保留。
+/// section 内不属于 RAM 的页标记为保留
+fn sparse_init_one_section(nr: usize, ranges: &[(PhysFrameNr, usize)]) -> bool {
+    let map = unsafe { alloc::alloc::alloc(section_map_layout()) } as *mut Page;
+    if map.is_null() {
+        return false;
+    }
+
+    let start_pfn = section_nr_to_pfn(nr);
+    let mut managed = 0;
+    for i in 0..PAGES_PER_SECTION {
+        let pfn = start_pfn + i;
+        unsafe {
+            core::ptr::write(map.add(i), Page::new());
+            let page = &*map.add(i);
+            page._section.store(nr as u32, Ordering::Relaxed);
+            if ranges.iter().any(|&(start, len)| pfn >= start && pfn < start + len) {
+                page.init_free();
+                managed += 1;
+            } else {
+                page.init_reserved();
+            }
+        }
+    }
+
+    MEM_SECTIONS[nr].section_mem_map.store(map, Ordering::Release);
+    NR_MANAGED_PAGES.fetch_add(managed, Ordering::AcqRel);
+    NR_PRESENT_SECTIONS.fetch_add(1, Ordering::AcqRel);
+    true
+}
+
+/// 为所有包含 RAM 的 section 分配页描述符 (sparse_init)
 ///
 /// # 参数
-/// - `start_pfn`: 可用内存起始 PFN
-/// - `nr_pages`: 可用页数
-pub fn init_mem_map(start_pfn: PhysFrameNr, nr_pages: usize) {
+/// - `ranges`: RAM 区间列表 (起始 PFN, 页数)
+///
+/// # 返回
+/// 有页描述符的 RAM 页数
+pub fn sparse_init(ranges: &[(PhysFrameNr, usize)]) -> usize {
     // 防止重复初始化
     if MEM_MAP_INIT.swap(1, Ordering::AcqRel) != 0 {
-        return;
+        return NR_MANAGED_PAGES.load(Ordering::Acquire);
     }
 
-    let mem_map_ptr = mem_map_mut();
-
-    // 标记所有页为保留
-    for i in 0..MAX_PAGES {
-        unsafe {
-            let page = &*mem_map_ptr.add(i);
-            page.init_reserved();
+    for &(start, len) in ranges {
+        let end = (start + len).min(MAX_PFN);
+        if start >= end {
+            continue;
+        }
+        for nr in pfn_to_section_nr(start)..=pfn_to_section_nr(end - 1) {
+            if !MEM_SECTIONS[nr].section_mem_map.load(Ordering::Acquire).is_null() {
+                continue;
+            }
+            if !sparse_init_one_section(nr, ranges) {
+                crate::println!("mm: failed to allocate mem_map for section {}", nr);
+            }
         }
     }
 
-    // 初始化可用页
-    let init_count = if nr_pages > MAX_PAGES { MAX_PAGES } else { nr_pages };
+    NR_MANAGED_PAGES.load(Ordering::Acquire)
+}
 
-    for i in 0..init_count {
-        unsafe {
-            let page = &*mem_map_ptr.add(i);
-            page.init_free();
-        }
-    }
+/// 初始化单个 RAM 区间的页数组
+///
+/// # 参数
+/// - `start_pfn`: 可用内存起始 PFN
+/// - `nr_pages`: 可用页数
+pub fn init_mem_map(start_pfn: PhysFrameNr, nr_pages: usize) {
+    sparse_init(&[(start_pfn, nr_pages)]);
 }
 
 // ========== PFN <-> Page 转换 ==========
 
+/// PFN 是否有页描述符 (pfn_valid)
+#[inline]
+pub fn pfn_valid(pfn: PhysFrameNr) -> bool {
+    !pfn_to_page(pfn).is_null()
+}
+
 /// PFN (Page Frame Number) 转换为 Page 指针
 ///
-/// # Safety
-/// 调用者必须确保 pfn 在有效范围内
+/// 不存在的 section（空洞或超出范围）返回 null
 #[inline]
 pub fn pfn_to_page(pfn: PhysFrameNr) -> *const Page {
-    let base_pfn = PHYS_MEMORY_BASE / PAGE_SIZE;
-    // 检查 pfn 是否在有效范围内
-    if pfn < base_pfn {
-        return core::ptr::null();
-    }
-    let idx = pfn - base_pfn;
-    if idx >= MAX_PAGES {
-        return core::ptr::null();
-    }
-    unsafe { MEM_MAP.as_ptr().add(idx) }
+    pfn_to_page_mut(pfn) as *const Page
 }
 
 /// PFN 转换为可变 Page 指针
 #[inline]
 pub fn pfn_to_page_mut(pfn: PhysFrameNr) -> *mut Page {
-    let base_pfn = PHYS_MEMORY_BASE / PAGE_SIZE;
-    // 检查 pfn 是否在有效范围内
-    if pfn < base_pfn {
+    let nr = pfn_to_section_nr(pfn);
+    if nr >= NR_MEM_SECTIONS {
         return core::ptr::null_mut();
     }
-    let idx = pfn - base_pfn;
-    if idx >= MAX_PAGES {
+    let map = MEM_SECTIONS[nr].section_mem_map.load(Ordering::Acquire);
+    if map.is_null() {
         return core::ptr::null_mut();
     }
-    unsafe { MEM_MAP.as_mut_ptr().add(idx) }
+    unsafe { map.add(pfn & (PAGES_PER_SECTION - 1)) }
 }
 
 /// Page 指针转换为 PFN
@@ -560,10 +669,23 @@ pub fn pfn_to_page_mut(pfn: PhysFrameNr) -> *mut Page {
 #[inline]
 pub fn page_to_pfn(page: *const Page) -> PhysFrameNr {
     unsafe {
-        let base = MEM_MAP.as_ptr() as usize;
-        let page_addr = page as usize;
-        let idx = (page_addr - base) / core::mem::size_of::<Page>();
-        (PHYS_MEMORY_BASE / PAGE_SIZE) + idx
+        let nr = (*page)._section.load(Ordering::Relaxed) as usize;
+        let base = MEM_SECTIONS[nr].section_mem_map.load(Ordering::Acquire) as usize;
+        let idx = (page as usize - base) / core::mem::size_of::<Page>();
+        section_nr_to_pfn(nr) + idx
+    }
+}
+
+/// 遍历所有存在的 section 的页描述符
+fn for_each_present_page(mut f: impl FnMut(&Page)) {
+    for section in MEM_SECTIONS.iter() {
+        let map = section.section_mem_map.load(Ordering::Acquire);
+        if map.is_null() {
+            continue;
+        }
+        for i in 0..PAGES_PER_SECTION {
+            unsafe { f(&*map.add(i)) };
+        }
     }
 }
 
@@ -593,10 +715,16 @@ pub fn frame_to_page_mut(frame: PhysFrame) -> *mut Page {
 
 // ========== 辅助函数 ==========
 
-/// 获取页的总数
+/// 获取有页描述符的 RAM 页数
 #[inline]
 pub fn total_pages() -> usize {
-    MAX_PAGES
+    NR_MANAGED_PAGES.load(Ordering::Acquire)
+}
+
+/// 获取已分配页描述符数组的 section 数
+#[inline]
+pub fn present_sections() -> usize {
+    NR_PRESENT_SECTIONS.load(Ordering::Acquire)
 }
 
 /// 获取 Page 结构体的大小（字节）
@@ -629,43 +757,37 @@ pub struct PageDescStats {
 /// 获取页描述符统计信息
 pub fn page_desc_stats() -> PageDescStats {
     let mut stats = PageDescStats {
-        total_pages: MAX_PAGES,
+        total_pages: total_pages(),
         ..Default::default()
     };
 
-    let mem_map_ptr = mem_map();
-
-    for i in 0..MAX_PAGES {
-        unsafe {
-            let page = &*mem_map_ptr.add(i);
-
-            if page.refcount() == 0 {
-                stats.free_pages += 1;
-            } else {
-                stats.used_pages += 1;
-            }
+    for_each_present_page(|page| {
+        if page.refcount() == 0 {
+            stats.free_pages += 1;
+        } else {
+            stats.used_pages += 1;
+        }
 
-            if page.is_reserved() {
-                stats.reserved_pages += 1;
-            }
+        if page.is_reserved() {
+            stats.reserved_pages += 1;
+        }
 
-            if page.is_mapped() {
-                stats.mapped_pages += 1;
-            }
+        if page.is_mapped() {
+            stats.mapped_pages += 1;
+        }
 
-            if page.is_dirty() {
-                stats.dirty_pages += 1;
-            }
+        if page.is_dirty() {
+            stats.dirty_pages += 1;
+        }
 
-            if page.is_cow() {
-                stats.cow_pages += 1;
-            }
+        if page.is_cow() {
+            stats.cow_pages += 1;
+        }
 
-            if page.is_anonymous() {
-                stats.anonymous_pages += 1;
-            }
+        if page.is_anonymous() {
+            stats.anonymous_pages += 1;
         }
-    }
+    });
 
     stats
 }
@@ -9,10 +9,22 @@
 //! 参考：
 //!
 //! # 设计
-//! - 每个 CPU 维护独立的页缓存
-//! - 分配时优先从本地缓存获取（无锁）
+//! - 每个 CPU 维护独立的页缓存，只由所属 CPU 在关中断状态下访问，
+//!   因此不需要锁，也不会被抢占或被本 CPU 的中断处理程序重入
+//! - 分配时优先从本地缓存获取
 //! - 本地缓存空时批量从全局分配器获取
-//! - 本地缓存满时批量归还给全局分配器
+//! - 本地缓存超过高水位时批量归还给全局分配器
+//!
+//! # 自适应水位 (参考 Linux 6.7 pcp->high 自动调整)
+//! - 连续补充（分配密集）时增大补充批量 (alloc_factor)
+//! - 连续归还（释放密集）时增大高水位和归还批量 (free_factor)
+//! - 每秒 (pcp_tick) 高水位向 PCP_HIGH_MIN 衰减 1/8，归还多余的页
+//!
+//! # 内存压力
+//! - drain_all_pages() 清空本 CPU 的缓存，并通过 IPI 让其他 CPU
+//!   在各自的中断上下文中清空缓存 (drain_local_pages)
+//! - 全局分配器分配失败时自动调用一次，仍然失败时进入直接回收 (vmscan)
+//!
 //!
 //! # 迁移类型 (MigrateType)
 //! - Unmovable: 不可移动（内核使用的页）
@@ -23,14 +35,26 @@ use core::sync::atomic::{AtomicUsize, Ordering};
 use crate::config::MAX_CPUS;
 use super::page::{PhysFrame, PAGE_SIZE, alloc_frame, dealloc_frame};
 use super::page_desc::{pfn_to_page_mut, PageFlag};
+use super::vmstat::{count_pgalloc, count_pgfree, count_vm_event, VmEvent};
 
 /// 迁移类型数量
 pub const MIGRATE_TYPES: usize = 3;
 
-/// 每种迁移类型的页链表最大长度
-pub const PCP_HIGH: usize = 64;      // 高水位：超过时归还页面
-pub const PCP_LOW: usize = 16;       // 低水位：低于时从全局分配器获取
-pub const PCP_BATCH: usize = 16;     // 批量操作数量
+/// 每种迁移类型的页链表水位
+pub const PCP_HIGH: usize = 64;      // 初始高水位：超过时归还页面
+pub const PCP_HIGH_MIN: usize = 32;  // 高水位衰减下限
+pub const PCP_HIGH_MAX: usize = 512; // 释放密集时高水位上限
+pub const PCP_LOW: usize = 16;       // 归还时至少保留的页数
+pub const PCP_BATCH: usize = 16;     // 基础批量操作数量
+
+/// 批量放大系数上限（批量最大为 PCP_BATCH << PCP_MAX_FACTOR）
+const PCP_MAX_FACTOR: u8 = 3;
+
+/// 高水位衰减周期（tick 数，约 1 秒）
+const PCP_DECAY_TICKS: usize = 100;
+
+/// drain_all_pages 等待远程 CPU 完成的最大轮询次数
+const DRAIN_WAIT_SPINS: usize = 1_000_000;
 
 /// 迁移类型
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
@@ -46,7 +70,8 @@ pub enum MigrateType {
 
 /// Per-CPU 页缓存
 ///
-/// 每个 CPU 维护的本地页缓存
+/// 每个 CPU 维护的本地页缓存，所有方法都要求调用者已关闭本地中断
+/// 且运行在所属 CPU 上（通过 with_this_cpu_pcp 访问）
 #[repr(C)]
 pub struct PerCpuPages {
     /// 每种迁移类型的页链表
@@ -54,10 +79,22 @@ pub struct PerCpuPages {
     lists: [usize; MIGRATE_TYPES],
     /// 每种迁移类型的页数
     counts: [usize; MIGRATE_TYPES],
-    /// 高水位（超过时归还）
+    /// 高水位（超过时归还），在 [PCP_HIGH_MIN, PCP_HIGH_MAX] 内自适应
     high: usize,
-    /// 批量操作数量
+    /// 基础批量操作数量
     batch: usize,
+    /// 补充批量放大系数（分配密集时增长）
+    alloc_factor: u8,
+    /// 归还批量放大系数（释放密集时增长）
+    free_factor: u8,
+    /// 距离上次衰减的 tick 数
+    ticks: usize,
+    /// 从本地缓存分配成功次数
+    hits: usize,
+    /// 本地缓存为空需要补充的次数
+    refills: usize,
+    /// 批量归还次数
+    drains: usize,
     /// 初始化标志
     initialized: bool,
 }
@@ -70,16 +107,19 @@ impl PerCpuPages {
             counts: [0; MIGRATE_TYPES],
             high: PCP_HIGH,
             batch: PCP_BATCH,
+            alloc_factor: 0,
+            free_factor: 0,
+            ticks: 0,
+            hits: 0,
+            refills: 0,
+            drains: 0,
             initialized: false,
         }
     }
 
     /// 初始化 PerCpuPages
     pub fn init(&mut self) {
-        self.lists = [0; MIGRATE_TYPES];
-        self.counts = [0; MIGRATE_TYPES];
-        self.high = PCP_HIGH;
-        self.batch = PCP_BATCH;
+        *self = Self::new();
         self.initialized = true;
     }
 
@@ -87,30 +127,17 @@ impl PerCpuPages {
     pub fn alloc(&mut self, migratetype: MigrateType) -> Option<PhysFrame> {
         let mt = migratetype as usize;
 
-        // 检查本地缓存是否有页
-        if self.counts[mt] > 0 {
-            // 从链表头取出一个页
-            let pfn = self.lists[mt];
-            if pfn == 0 {
-                return None;
-            }
-
-            // 获取下一个页
-            let next = self.get_next_free(pfn);
-            self.lists[mt] = next;
-            self.counts[mt] -= 1;
-
-            // 清除页的空闲链表指针
-            self.clear_next_free(pfn);
+        // 分配时释放密集的趋势减弱
+        self.free_factor = self.free_factor.saturating_sub(1);
 
+        if let Some(pfn) = self.pop(mt) {
+            self.hits += 1;
+            prep_new_page(pfn);
             return Some(PhysFrame::new(pfn));
         }
 
         // 本地缓存为空，从全局分配器批量获取
-        self.refill(migratetype)?;
-
-        // 再次尝试分配
-        self.alloc(migratetype)
+        self.refill(migratetype)
     }
 
     /// 释放一个页到本地缓存
@@ -118,66 +145,122 @@ impl PerCpuPages {
         let mt = migratetype as usize;
         let pfn = frame.number;
 
-        // 将页添加到链表头
+        // 没有页描述符的页无法链入本地缓存
+        if pfn_to_page_mut(pfn).is_null() {
+            dealloc_frame(frame);
+            return;
+        }
+
+        free_page_prepare(pfn);
+        self.push(mt, pfn);
+        self.alloc_factor = self.alloc_factor.saturating_sub(1);
+
+        // 检查是否超过高水位
+        if self.counts[mt] >= self.high {
+            // 频繁触发归还说明释放密集：提高水位并放大下次归还批量
+            self.high = (self.high + self.batch).min(PCP_HIGH_MAX);
+            let count = self.batch << self.free_factor;
+            if self.free_factor < PCP_MAX_FACTOR {
+                self.free_factor += 1;
+            }
+            self.drain(mt, count);
+        }
+    }
+
+    #[inline]
+    fn push(&mut self, mt: usize, pfn: usize) {
         self.set_next_free(pfn, self.lists[mt]);
         self.lists[mt] = pfn;
         self.counts[mt] += 1;
+    }
 
-        // 检查是否超过高水位
-        if self.counts[mt] >= self.high {
-            // 批量归还给全局分配器
-            self.drain(migratetype);
+    #[inline]
+    fn pop(&mut self, mt: usize) -> Option<usize> {
+        let pfn = self.lists[mt];
+        if self.counts[mt] == 0 || pfn == 0 {
+            return None;
         }
+        self.lists[mt] = self.get_next_free(pfn);
+        self.counts[mt] -= 1;
+        self.clear_next_free(pfn);
+        Some(pfn)
     }
 
-    /// 从全局分配器批量获取页
-    fn refill(&mut self, migratetype: MigrateType) -> Option<()> {
+    /// 从全局分配器批量获取页，并直接返回其中一页 (rmqueue_bulk)
+    ///
+    /// 连续补充时批量按 alloc_factor 放大，但不超过高水位的一半
+    fn refill(&mut self, migratetype: MigrateType) -> Option<PhysFrame> {
         let mt = migratetype as usize;
-        let batch = self.batch;
-
-        for _ in 0..batch {
-            match alloc_frame() {
-                Some(frame) => {
-                    let pfn = frame.number;
-                    // 添加到链表头
-                    self.set_next_free(pfn, self.lists[mt]);
-                    self.lists[mt] = pfn;
-                    self.counts[mt] += 1;
-                }
+        let batch = (self.batch << self.alloc_factor).min(self.high / 2).max(1);
+        if self.alloc_factor < PCP_MAX_FACTOR {
+            self.alloc_factor += 1;
+        }
+        self.refills += 1;
+        count_vm_event(VmEvent::PcpRefill);
+
+        // 第一页直接返回给调用者
+        let first = alloc_frame()?;
+
+        for _ in 1..batch {
+            let frame = match alloc_frame() {
+                Some(frame) => frame,
                 None => break,  // 全局分配器无可用页
+            };
+            if pfn_to_page_mut(frame.number).is_null() {
+                // 没有页描述符，无法缓存
+                dealloc_frame(frame);
+                break;
             }
+            free_page_prepare(frame.number);
+            self.push(mt, frame.number);
         }
 
-        if self.counts[mt] > 0 {
-            Some(())
-        } else {
-            None
-        }
+        Some(first)
     }
 
-    /// 批量归还页给全局分配器
-    fn drain(&mut self, migratetype: MigrateType) {
-        let mt = migratetype as usize;
-        let batch = self.batch;
-
-        // 保留低水位的页
-        while self.counts[mt] > PCP_LOW && self.counts[mt] > batch {
-            // 从链表头取出 batch 个页
-            for _ in 0..batch {
-                let pfn = self.lists[mt];
-                if pfn == 0 {
-                    break;
-                }
+    /// 归还最多 count 个页给全局分配器，至少保留 PCP_LOW 个页
+    fn drain(&mut self, mt: usize, count: usize) {
+        let mut freed = 0;
+        while freed < count && self.counts[mt] > PCP_LOW {
+            match self.pop(mt) {
+                Some(pfn) => dealloc_frame(PhysFrame::new(pfn)),
+                None => break,
+            }
+            freed += 1;
+        }
+        if freed > 0 {
+            self.drains += 1;
+            count_vm_event(VmEvent::PcpDrain);
+        }
+    }
 
-                let next = self.get_next_free(pfn);
-                self.lists[mt] = next;
-                self.counts[mt] -= 1;
+    /// 归还所有缓存的页 (drain_pages)
+    fn drain_all(&mut self) {
+        for mt in 0..MIGRATE_TYPES {
+            while let Some(pfn) = self.pop(mt) {
+                dealloc_frame(PhysFrame::new(pfn));
+            }
+        }
+        self.alloc_factor = 0;
+        self.free_factor = 0;
+    }
 
-                // 清除空闲链表指针
-                self.clear_next_free(pfn);
+    /// 周期性衰减高水位并归还超出部分 (decay_pcp_high)
+    fn tick(&mut self) {
+        self.ticks += 1;
+        if self.ticks < PCP_DECAY_TICKS {
+            return;
+        }
+        self.ticks = 0;
 
-                // 归还给全局分配器
-                dealloc_frame(PhysFrame::new(pfn));
+        if self.high > PCP_HIGH_MIN {
+            let decay = ((self.high - PCP_HIGH_MIN) / 8).max(1);
+            self.high -= decay;
+        }
+        for mt in 0..MIGRATE_TYPES {
+            if self.counts[mt] > self.high {
+                let excess = self.counts[mt] - self.high;
+                self.drain(mt, excess);
             }
         }
     }
@@ -224,90 +307,197 @@ impl PerCpuPages {
     }
 }
 
-/// 全局 Per-CPU Pages 数组
-///
-/// 使用静态数组存储每个 CPU 的页缓存
-static mut PER_CPU_PAGES: [PerCpuPages; MAX_CPUS] = [
-    PerCpuPages::new(),
-    PerCpuPages::new(),
-    PerCpuPages::new(),
-    PerCpuPages::new(),
-];
+/// 分配出去的页：引用计数置 1 (prep_new_page)
+fn prep_new_page(pfn: usize) {
+    let page = pfn_to_page_mut(pfn);
+    if page.is_null() {
+        return;
+    }
+    unsafe {
+        (*page).set_refcount(1);
+        (*page).set_flag(PageFlag::Referenced);
+    }
+}
+
+/// 进入缓存的页：重置状态 (free_pages_prepare)
+fn free_page_prepare(pfn: usize) {
+    let page = pfn_to_page_mut(pfn);
+    if page.is_null() {
+        return;
+    }
+    unsafe {
+        (*page).set_refcount(0);
+        (*page).reset_mapcount();
+        (*page).clear_flag(PageFlag::Referenced);
+        (*page).clear_flag(PageFlag::Dirty);
+    }
+}
+
+crate::percpu! {
+    /// 每个 CPU 的页缓存 (per_cpu_pageset)
+    static PER_CPU_PAGES: PerCpuPages = PerCpuPages::new();
+}
+
+/// 等待本 CPU 执行 drain_local_pages 的 CPU 位图
+static DRAIN_PENDING: AtomicUsize = AtomicUsize::new(0);
 
 /// 初始化 Per-CPU Pages
 ///
-/// 在每个 CPU 启动时调用
+/// 在每个 CPU 启动时调用；未调用时首次访问会自动初始化
 pub fn init_percpu_pages(cpu_id: usize) {
     if cpu_id >= MAX_CPUS {
         return;
     }
 
     unsafe {
-        PER_CPU_PAGES[cpu_id].init();
+        let _irq = crate::arch::context::InterruptGuard::new();
+        (*PER_CPU_PAGES.per_cpu_ptr(cpu_id)).init();
     }
 }
 
-/// 获取当前 CPU 的 Per-CPU Pages
+/// 在关中断状态下访问当前 CPU 的 Per-CPU Pages (pcp_spin_lock_irqsave)
 ///
-/// # 安全性
-/// 调用者必须确保 cpu_id 有效
-fn this_cpu_pcp() -> Option<&'static mut PerCpuPages> {
-    let cpu_id = crate::arch::cpu_id() as usize;
-    if cpu_id >= MAX_CPUS {
-        return None;
-    }
-
-    unsafe {
-        if !PER_CPU_PAGES[cpu_id].initialized {
-            return None;
-        }
-        Some(&mut PER_CPU_PAGES[cpu_id])
+/// 关中断保证闭包执行期间不会被抢占或迁移到其他 CPU，
+/// 也不会被本 CPU 上的中断（包括 drain IPI）重入
+fn with_this_cpu_pcp<R>(f: impl FnOnce(&mut PerCpuPages) -> R) -> Option<R> {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let pcp = unsafe { &mut *PER_CPU_PAGES.this_cpu_ptr() };
+    if !pcp.initialized {
+        pcp.init();
     }
+    Some(f(pcp))
 }
 
 /// 从 Per-CPU 缓存分配一个页
 ///
 /// 优先从本地 CPU 缓存分配（无锁）
-/// 失败时回退到全局分配器
+/// 全局分配器也失败时清空所有 CPU 的缓存后重试一次
 pub fn alloc_page_pcp(migratetype: MigrateType) -> Option<PhysFrame> {
-    // 尝试从 Per-CPU 缓存分配
-    if let Some(pcp) = this_cpu_pcp() {
-        if let Some(frame) = pcp.alloc(migratetype) {
+    let frame = rmqueue(migratetype);
+    if frame.is_some() {
+        count_pgalloc(0);
+    }
+    frame
+}
+
+/// alloc_page_pcp 的分配过程 (rmqueue)，不计入分配统计
+fn rmqueue(migratetype: MigrateType) -> Option<PhysFrame> {
+    if let Some(Some(frame)) = with_this_cpu_pcp(|pcp| pcp.alloc(migratetype)) {
+        super::vmscan::check_watermark();
+        return Some(frame);
+    }
+
+    // 本地缓存和全局分配器都没有页：回收其他 CPU 缓存中的页
+    drain_all_pages();
+    if let Some(frame) = alloc_frame() {
+        return Some(frame);
+    }
+
+    // 仍然失败：同步回收页缓存和内核缓存后再试一次 (direct reclaim)
+    if super::vmscan::try_to_free_pages() {
+        drain_local_pages();
+        if let Some(frame) = alloc_frame() {
             return Some(frame);
         }
     }
 
-    // 回退到全局分配器
-    alloc_frame()
+    // OOM killer 选中的任务动用预留页，保证能够退出
+    super::oom_kill::oom_reserve_alloc()
+}
+
+/// 不进入回收的分配 (GFP_NOWAIT)
+///
+/// 只尝试本地缓存和全局分配器。供页回收过程中的分配使用（如 zswap 的池页），
+/// 不会再次进入回收
+pub fn alloc_page_nowait(migratetype: MigrateType) -> Option<PhysFrame> {
+    if let Some(Some(frame)) = with_this_cpu_pcp(|pcp| pcp.alloc(migratetype)) {
+        super::vmscan::check_watermark();
+        count_pgalloc(0);
+        return Some(frame);
+    }
+    let frame = alloc_frame();
+    if frame.is_some() {
+        count_pgalloc(0);
+    }
+    frame
 }
 
 /// 释放一个页到 Per-CPU 缓存
 ///
-/// 优先释放到本地 CPU 缓存（无锁）
-/// 失败时回退到全局分配器
+/// 释放到当前 CPU 的缓存，页可以由任意 CPU 分配后在其他 CPU 上释放；
+/// 计过费的页先从所属的内存控制组扣除
 pub fn free_page_pcp(frame: PhysFrame, migratetype: MigrateType) {
-    // 尝试释放到 Per-CPU 缓存
-    if let Some(pcp) = this_cpu_pcp() {
-        pcp.free(frame, migratetype);
+    super::memcontrol::mem_cgroup_uncharge(&frame);
+    count_pgfree(0);
+    if with_this_cpu_pcp(|pcp| pcp.free(frame, migratetype)).is_none() {
+        dealloc_frame(frame);
+    }
+}
+
+/// 清空当前 CPU 的页缓存 (drain_local_pages)
+///
+/// 也由 drain IPI 在中断上下文中调用
+pub fn drain_local_pages() {
+    let cpu_id = crate::arch::cpu_id() as usize;
+    with_this_cpu_pcp(|pcp| pcp.drain_all());
+    if cpu_id < MAX_CPUS {
+        DRAIN_PENDING.fetch_and(!(1 << cpu_id), Ordering::Release);
+    }
+}
+
+/// 清空所有 CPU 的页缓存 (drain_all_pages)
+///
+/// 本 CPU 直接清空，其他有缓存页的 CPU 通过 IPI 清空；
+/// 有限时间内等待远程 CPU 完成，避免双方都在关中断状态下互相等待
+pub fn drain_all_pages() {
+    let this_cpu = crate::arch::cpu_id() as usize;
+    drain_local_pages();
+
+    let mut mask = 0usize;
+    for cpu in 0..MAX_CPUS {
+        if cpu == this_cpu {
+            continue;
+        }
+        let pcp = unsafe { &*PER_CPU_PAGES.per_cpu_ptr(cpu) };
+        if pcp.initialized && pcp.total_count() > 0 {
+            mask |= 1 << cpu;
+        }
+    }
+    if mask == 0 {
         return;
     }
 
-    // 回退到全局分配器
-    dealloc_frame(frame);
+    DRAIN_PENDING.fetch_or(mask, Ordering::AcqRel);
+    crate::arch::ipi::send_ipi_mask(mask, crate::arch::ipi::IpiType::DrainPages);
+
+    let mut spins = 0;
+    while DRAIN_PENDING.load(Ordering::Acquire) & mask != 0 && spins < DRAIN_WAIT_SPINS {
+        core::hint::spin_loop();
+        spins += 1;
+    }
+}
+
+/// 时钟中断中调用：周期性衰减本 CPU 的高水位
+pub fn pcp_tick() {
+    with_this_cpu_pcp(|pcp| pcp.tick());
 }
 
 /// 获取 Per-CPU 缓存统计信息
+///
+/// 读取其他 CPU 的计数不加锁，结果是近似值
 pub fn pcp_stats() -> PcpStats {
     let mut stats = PcpStats::default();
 
-    unsafe {
-        for cpu_id in 0..MAX_CPUS {
-            if PER_CPU_PAGES[cpu_id].initialized {
-                stats.cpu_stats[cpu_id].initialized = true;
-                for mt in 0..MIGRATE_TYPES {
-                    stats.cpu_stats[cpu_id].counts[mt] = PER_CPU_PAGES[cpu_id].counts[mt];
-                }
-            }
+    for cpu_id in 0..MAX_CPUS {
+        let pcp = unsafe { &*PER_CPU_PAGES.per_cpu_ptr(cpu_id) };
+        if pcp.initialized {
+            let cpu_stats = &mut stats.cpu_stats[cpu_id];
+            cpu_stats.initialized = true;
+            cpu_stats.counts = pcp.counts;
+            cpu_stats.high = pcp.high;
+            cpu_stats.hits = pcp.hits;
+            cpu_stats.refills = pcp.refills;
+            cpu_stats.drains = pcp.drains;
         }
     }
 
@@ -319,6 +509,14 @@ pub fn pcp_stats() -> PcpStats {
 pub struct CpuPcpStats {
     pub initialized: bool,
     pub counts: [usize; MIGRATE_TYPES],
+    /// 当前高水位
+    pub high: usize,
+    /// 本地缓存命中次数
+    pub hits: usize,
+    /// 批量补充次数
+    pub refills: usize,
+    /// 批量归还次数
+    pub drains: usize,
 }
 
 /// 全局 Per-CPU 缓存统计
@@ -345,6 +543,7 @@ pub const GFP_ATOMIC: u32 = 0x04;      // 原子分配（不能睡眠）
 pub const GFP_HIGHUSER: u32 = 0x08;    // 高端用户内存
 pub const GFP_DMA: u32 = 0x10;         // DMA 内存
 pub const GFP_NOWAIT: u32 = 0x20;      // 不等待
+pub const GFP_ZERO: u32 = 0x40;        // 清零的页 (__GFP_ZERO)，用户页取自预清零页池 (mm::prezero)
 
 /// 便捷函数：分配内核页
 pub fn alloc_kernel_page() -> Option<PhysFrame> {
@@ -0,0 +1,127 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 预清零页池
+//!
+//! 参考 Linux: __GFP_ZERO (mm/page_alloc.c), clear_page (arch/riscv/lib/clear_page.S)
+//!
+//! - 交给用户空间的页都必须清零，原来在缺页路径中分配后同步清零
+//! - 空闲的 CPU 在空闲循环中从页分配器取页、清零 (clear_page) 后放入池中，
+//!   每次最多 PREZERO_BATCH 页，保证唤醒延迟；空闲页不高于高水位时不补充
+//! - alloc_zeroed_user_page (GFP_ZERO) 先从池中取，池空时分配后同步清零
+//! - 池中的页已分配出去（引用计数为 1），内容保持全零；直接回收时先归还 (drain_zero_pool)
+
+use core::sync::atomic::{AtomicUsize, Ordering};
+use spin::Mutex;
+
+use super::page::{frame_stats, PhysFrame};
+use super::pcp::{alloc_page_nowait, alloc_user_page, free_user_page, MigrateType};
+
+/// 池容量（页）
+pub const ZERO_POOL_PAGES: usize = 256;
+
+/// 空闲循环每次补充的页数
+const PREZERO_BATCH: usize = 8;
+
+/// 清零的页 (pfn)
+struct ZeroPool {
+    frames: [usize; ZERO_POOL_PAGES],
+    nr: usize,
+}
+
+static ZERO_POOL: Mutex<ZeroPool> = Mutex::new(ZeroPool { frames: [0; ZERO_POOL_PAGES], nr: 0 });
+
+static NR_POOL_HITS: AtomicUsize = AtomicUsize::new(0);
+static NR_POOL_MISSES: AtomicUsize = AtomicUsize::new(0);
+
+#[inline]
+fn clear_frame(frame: &PhysFrame) {
+    unsafe { crate::arch::riscv64::cpu::clear_page(frame.start_address().as_usize()) };
+}
+
+/// 空闲的 CPU 补充池 (由 cpu_idle_loop 调用)
+///
+/// 清零在锁外进行，多个 CPU 可以同时补充
+pub fn prezero_run() {
+    let (_, _, high) = super::vmscan::watermarks();
+    for _ in 0..PREZERO_BATCH {
+        if ZERO_POOL.lock().nr >= ZERO_POOL_PAGES || frame_stats().free_frames <= high {
+            return;
+        }
+        let frame = match alloc_page_nowait(MigrateType::Movable) {
+            Some(frame) => frame,
+            None => return,
+        };
+        clear_frame(&frame);
+        let mut pool = ZERO_POOL.lock();
+        if pool.nr == ZERO_POOL_PAGES {
+            drop(pool);
+            free_user_page(frame);
+            return;
+        }
+        let nr = pool.nr;
+        pool.frames[nr] = frame.number;
+        pool.nr += 1;
+    }
+}
+
+/// 分配清零的用户页 (GFP_HIGHUSER_MOVABLE | __GFP_ZERO)
+///
+/// 先从池中取；池空时走普通分配并同步清零
+pub fn alloc_zeroed_user_page() -> Option<PhysFrame> {
+    {
+        let mut pool = ZERO_POOL.lock();
+        if pool.nr > 0 {
+            pool.nr -= 1;
+            let pfn = pool.frames[pool.nr];
+            drop(pool);
+            NR_POOL_HITS.fetch_add(1, Ordering::Relaxed);
+            return Some(PhysFrame::new(pfn));
+        }
+    }
+    NR_POOL_MISSES.fetch_add(1, Ordering::Relaxed);
+    let frame = alloc_user_page()?;
+    clear_frame(&frame);
+    Some(frame)
+}
+
+/// 把池中的页全部归还页分配器，由直接回收调用
+///
+/// # 返回
+/// 归还的页数
+pub fn drain_zero_pool() -> usize {
+    let mut frames = [0usize; ZERO_POOL_PAGES];
+    let nr = {
+        let mut pool = ZERO_POOL.lock();
+        let nr = pool.nr;
+        frames[..nr].copy_from_slice(&pool.frames[..nr]);
+        pool.nr = 0;
+        nr
+    };
+    for &pfn in &frames[..nr] {
+        free_user_page(PhysFrame::new(pfn));
+    }
+    nr
+}
+
+/// 预清零页池统计
+#[derive(Debug, Clone, Copy, Default)]
+pub struct ZeroPoolStats {
+    /// 池中的页数
+    pub nr_pages: usize,
+    /// 从池中取到清零页的分配次数
+    pub hits: usize,
+    /// 池空、同步清零的分配次数
+    pub misses: usize,
+}
+
+/// 获取预清零页池统计
+pub fn zero_pool_stats() -> ZeroPoolStats {
+    ZeroPoolStats {
+        nr_pages: ZERO_POOL.lock().nr,
+        hits: NR_POOL_HITS.load(Ordering::Relaxed),
+        misses: NR_POOL_MISSES.load(Ordering::Relaxed),
+    }
+}
@@ -13,12 +13,15 @@
 //! - SlabCache: 管理特定大小对象的缓存
 //! - Slab: 包含多个相同大小对象的内存页
 //! - kmalloc/kfree: 公共分配接口
+//! - Magazine: 每 CPU 对象弹匣（参考 Linux SLAB 的 array_cache 和
+//!   Bonwick 的 magazine 层），常见路径不获取缓存锁
 //!
 //! # 支持的对象大小
 //! 8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096 字节
 
 use core::sync::atomic::{AtomicUsize, Ordering};
 use spin::Mutex;
+use crate::config::MAX_CPUS;
 
 /// 页大小
 const PAGE_SIZE: usize = 4096;
@@ -37,6 +40,23 @@ const OBJECT_SIZES: [usize; NUM_CACHES] = [
     8, 16, 32, 64, 128, 256, 512, 1024, 2048, 4096
 ];
 
+/// 弹匣最大容量（对象数）
+const MAGAZINE_CAPACITY: usize = 32;
+
+/// 每个大小类的弹匣容量
+///
+/// 大对象占用的内存更多，弹匣更小，避免每个 CPU 囤积过多空闲对象
+/// （参考 Linux mm/slab.c enable_cpucache）
+const fn magazine_limit(object_size: usize) -> usize {
+    if object_size > 1024 {
+        8
+    } else if object_size > 256 {
+        16
+    } else {
+        MAGAZINE_CAPACITY
+    }
+}
+
 /// Slab 状态
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
 enum SlabState {
@@ -83,6 +103,8 @@ impl SlabHeader {
 
 /// Slab 缓存
 pub struct SlabCache {
+    /// 缓存索引（写入 slab 头部，kfree 据此找到所属缓存）
+    cache_idx: u8,
     /// 对象大小
     object_size: usize,
     /// 每个 slab 可容纳的对象数
@@ -109,6 +131,7 @@ impl SlabCache {
         let objects_per_slab = usable_size / object_size;
 
         Self {
+            cache_idx: (object_size / MIN_OBJECT_SIZE).trailing_zeros() as u8,
             object_size,
             objects_per_slab,
             free_list: 0,
@@ -213,7 +236,7 @@ impl SlabCache {
         let header = slab_pages.get_header_mut(slab_idx);
 
         // 验证缓存索引
-        if header.cache_idx as usize >= NUM_CACHES {
+        if header.cache_idx != self.cache_idx {
             return false;
         }
 
@@ -249,14 +272,44 @@ impl SlabCache {
         true
     }
 
+    /// 批量分配对象（填充弹匣）
+    ///
+    /// # 返回
+    /// 实际分配的对象数
+    fn alloc_batch(&mut self, slab_pages: &mut SlabPages, out: &mut [*mut u8]) -> usize {
+        let mut n = 0;
+        while n < out.len() {
+            let ptr = self.alloc(slab_pages);
+            if ptr.is_null() {
+                break;
+            }
+            out[n] = ptr;
+            n += 1;
+        }
+        n
+    }
+
+    /// 批量释放对象（清空弹匣）
+    fn free_batch(&mut self, slab_pages: &mut SlabPages, objects: &[*mut u8]) {
+        for &ptr in objects {
+            self.free(ptr, slab_pages);
+        }
+    }
+
     /// 创建新的 slab
     fn create_slab(&mut self, slab_pages: &mut SlabPages) -> Option<u16> {
+        // 一页放不下一个对象（例如 4096 字节对象加上头部），交给 buddy 分配
+        if self.objects_per_slab == 0 {
+            return None;
+        }
+
         // 从 buddy allocator 分配一页
         let page = slab_pages.alloc_page()?;
+        super::vmstat::count_vm_event(super::vmstat::VmEvent::SlabGrow);
 
         // 初始化 slab 头部
         let header = slab_pages.get_header_mut(page);
-        header.cache_idx = 0; // 将在返回后设置
+        header.cache_idx = self.cache_idx;
         header.object_size = self.object_size as u16;
         header.total_objects = self.objects_per_slab as u16;
         header.free_objects = self.objects_per_slab as u16;
@@ -414,6 +467,84 @@ impl SlabPages {
         }
         Some(idx)
     }
+
+    /// 获取对象所属的缓存索引
+    fn cache_of(&self, ptr: *mut u8) -> Option<usize> {
+        let page_addr = (ptr as usize) & !(PAGE_SIZE - 1);
+        let slab_idx = self.find_slab_by_addr(page_addr)?;
+        let cache_idx = self.get_header_mut(slab_idx).cache_idx as usize;
+        if cache_idx < NUM_CACHES {
+            Some(cache_idx)
+        } else {
+            None
+        }
+    }
+}
+
+/// 每 CPU 对象弹匣
+///
+/// 只由所属 CPU 在关中断的情况下访问，因此不需要加锁。
+/// 弹匣为空时从共享缓存批量填充，满时批量归还一半，
+/// 每次批量操作只获取一次缓存锁。
+struct Magazine {
+    /// 空闲对象栈（LIFO，最近释放的对象缓存最热）
+    objects: [*mut u8; MAGAZINE_CAPACITY],
+    /// 栈中的对象数
+    count: usize,
+    /// 统计：命中次数（分配或释放时未访问共享缓存）
+    hits: AtomicUsize,
+    /// 统计：未命中次数（需要批量填充或归还）
+    misses: AtomicUsize,
+}
+
+impl Magazine {
+    const fn new() -> Self {
+        Self {
+            objects: [core::ptr::null_mut(); MAGAZINE_CAPACITY],
+            count: 0,
+            hits: AtomicUsize::new(0),
+            misses: AtomicUsize::new(0),
+        }
+    }
+
+    /// 取出一个对象
+    #[inline]
+    fn pop(&mut self) -> Option<*mut u8> {
+        if self.count == 0 {
+            return None;
+        }
+        self.count -= 1;
+        Some(self.objects[self.count])
+    }
+
+    /// 放入一个对象
+    #[inline]
+    fn push(&mut self, ptr: *mut u8, limit: usize) -> bool {
+        if self.count >= limit {
+            return false;
+        }
+        self.objects[self.count] = ptr;
+        self.count += 1;
+        true
+    }
+}
+
+const MAGAZINE_INIT: Magazine = Magazine::new();
+const CPU_MAGAZINES_INIT: [Magazine; NUM_CACHES] = [MAGAZINE_INIT; NUM_CACHES];
+
+/// 每 CPU 弹匣数组（每个大小类一个）
+static mut PER_CPU_MAGAZINES: [[Magazine; NUM_CACHES]; MAX_CPUS] = [CPU_MAGAZINES_INIT; MAX_CPUS];
+
+/// 获取当前 CPU 的弹匣
+///
+/// # Safety
+/// 调用者必须已关闭本地中断，且在使用期间不会迁移到其他 CPU
+unsafe fn this_cpu_magazines() -> Option<&'static mut [Magazine; NUM_CACHES]> {
+    let cpu_id = crate::arch::cpu_id() as usize;
+    if cpu_id >= MAX_CPUS {
+        return None;
+    }
+    Some(&mut PER_CPU_MAGAZINES[cpu_id])
 }
 
 /// Slab 分配器全局状态
@@ -492,8 +623,31 @@ pub fn kmalloc(size: usize) -> *mut u8 {
     };
 
     unsafe {
+        // 关中断：弹匣只属于本 CPU，不能被中断处理程序中的分配重入
+        let _irq = crate::arch::context::InterruptGuard::new();
+
+        let mags = match this_cpu_magazines() {
+            Some(m) => m,
+            None => {
+                let mut cache = SLAB_ALLOCATOR.caches[cache_idx].lock();
+                return cache.alloc(&mut SLAB_ALLOCATOR.pages);
+            }
+        };
+        let mag = &mut mags[cache_idx];
+
+        if let Some(ptr) = mag.pop() {
+            mag.hits.fetch_add(1, Ordering::Relaxed);
+            return ptr;
+        }
+
+        // 弹匣为空：从共享缓存批量填充一半
+        mag.misses.fetch_add(1, Ordering::Relaxed);
+        let batch = magazine_limit(OBJECT_SIZES[cache_idx]) / 2;
         let mut cache = SLAB_ALLOCATOR.caches[cache_idx].lock();
-        cache.alloc(&mut SLAB_ALLOCATOR.pages)
+        mag.count = cache.alloc_batch(&mut SLAB_ALLOCATOR.pages, &mut mag.objects[..batch]);
+        drop(cache);
+
+        mag.pop().unwrap_or(core::ptr::null_mut())
     }
 }
 
@@ -507,13 +661,40 @@ pub fn kfree(ptr: *mut u8) {
     }
 
     unsafe {
-        // 尝试在每个缓存中释放
-        for i in 0..NUM_CACHES {
-            let mut cache = SLAB_ALLOCATOR.caches[i].lock();
-            if cache.free(ptr, &mut SLAB_ALLOCATOR.pages) {
+        // 由 slab 头部直接找到所属缓存
+        let cache_idx = match SLAB_ALLOCATOR.pages.cache_of(ptr) {
+            Some(idx) => idx,
+            None => return,
+        };
+
+        let _irq = crate::arch::context::InterruptGuard::new();
+
+        let mags = match this_cpu_magazines() {
+            Some(m) => m,
+            None => {
+                let mut cache = SLAB_ALLOCATOR.caches[cache_idx].lock();
+                cache.free(ptr, &mut SLAB_ALLOCATOR.pages);
                 return;
             }
+        };
+        let mag = &mut mags[cache_idx];
+        let limit = magazine_limit(OBJECT_SIZES[cache_idx]);
+
+        if mag.push(ptr, limit) {
+            mag.hits.fetch_add(1, Ordering::Relaxed);
+            return;
         }
+
+        // 弹匣已满：把最早放入的一半归还共享缓存
+        mag.misses.fetch_add(1, Ordering::Relaxed);
+        let batch = limit / 2;
+        let mut cache = SLAB_ALLOCATOR.caches[cache_idx].lock();
+        cache.free_batch(&mut SLAB_ALLOCATOR.pages, &mag.objects[..batch]);
+        drop(cache);
+
+        mag.objects.copy_within(batch..mag.count, 0);
+        mag.count -= batch;
+        mag.push(ptr, limit);
     }
 }
 
@@ -564,7 +745,17 @@ pub fn slab_stats() -> SlabStats {
                 object_size: cache.object_size,
                 alloc_count: cache.alloc_count.load(Ordering::Relaxed),
                 free_count: cache.free_count.load(Ordering::Relaxed),
+                ..CacheStats::default()
             };
+            drop(cache);
+
+            // 弹匣计数由各 CPU 自己更新，这里的读取是近似值
+            for cpu_id in 0..MAX_CPUS {
+                let mag = &PER_CPU_MAGAZINES[cpu_id][i];
+                stats.cache_stats[i].magazine_hits += mag.hits.load(Ordering::Relaxed);
+                stats.cache_stats[i].magazine_misses += mag.misses.load(Ordering::Relaxed);
+                stats.cache_stats[i].magazine_objects += mag.count;
+            }
         }
         stats.total_pages = SLAB_ALLOCATOR.pages.allocated_pages.load(Ordering::Relaxed);
     }
@@ -576,8 +767,16 @@ pub fn slab_stats() -> SlabStats {
 #[derive(Debug, Clone, Copy, Default)]
 pub struct CacheStats {
     pub object_size: usize,
+    /// 共享缓存的分配次数（弹匣命中的分配不计入）
     pub alloc_count: usize,
+    /// 共享缓存的释放次数
     pub free_count: usize,
+    /// 弹匣命中次数（所有 CPU）
+    pub magazine_hits: usize,
+    /// 弹匣未命中次数（批量填充或归还）
+    pub magazine_misses: usize,
+    /// 当前缓存在弹匣中的空闲对象数
+    pub magazine_objects: usize,
 }
 
 /// Slab 统计信息
@@ -602,4 +801,23 @@ mod tests {
         assert_eq!(SlabAllocator::find_cache_index(4097), None);
         assert_eq!(SlabAllocator::find_cache_index(0), None);
     }
+
+    #[test]
+    fn test_cache_idx_matches_size_class() {
+        for (i, &size) in OBJECT_SIZES.iter().enumerate() {
+            assert_eq!(SlabCache::new(size).cache_idx as usize, i);
+        }
+    }
+
+    #[test]
+    fn test_magazine_push_pop() {
+        let mut mag = Magazine::new();
+        let limit = magazine_limit(2048);
+        for i in 0..limit {
+            assert!(mag.push((0x1000 + i * 8) as *mut u8, limit));
+        }
+        assert!(!mag.push(0x9000 as *mut u8, limit));
+        assert_eq!(mag.pop(), Some((0x1000 + (limit - 1) * 8) as *mut u8));
+        assert_eq!(mag.count, limit - 1);
+    }
 }
@@ -46,6 +46,18 @@ impl VmaFlags {
     pub const LOCKED: u32 = 0x00002000;
     /// I/O 映射 (VM_IO)
     pub const IO: u32 = 0x00004000;
+    /// 顺序访问，扩大预读窗口 (VM_SEQ_READ, MADV_SEQUENTIAL)
+    pub const SEQ_READ: u32 = 0x00008000;
+    /// 随机访问，不预读 (VM_RAND_READ, MADV_RANDOM)
+    pub const RAND_READ: u32 = 0x00010000;
+    /// 大页映射 (VM_HUGETLB)
+    pub const HUGETLB: u32 = 0x00400000;
+    /// 优先使用透明大页 (VM_HUGEPAGE, MADV_HUGEPAGE)
+    pub const HUGEPAGE: u32 = 0x20000000;
+    /// 不使用透明大页 (VM_NOHUGEPAGE, MADV_NOHUGEPAGE)
+    pub const NOHUGEPAGE: u32 = 0x40000000;
+    /// 匿名页可以与内容相同的页合并 (VM_MERGEABLE, MADV_MERGEABLE)
+    pub const MERGEABLE: u32 = 0x80000000;
 
     #[inline]
     pub const fn new() -> Self {
@@ -155,6 +167,9 @@ pub struct Vma {
 
     /// VMA 类型
     vma_type: VmaType,
+
+    /// 文件映射的页缓存（inode 号，见 mm::filemap）
+    mapping: Option<u64>,
 }
 
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
@@ -182,6 +197,7 @@ impl Vma {
             flags,
             offset: 0,
             vma_type: VmaType::Anonymous,
+            mapping: None,
         }
     }
 
@@ -215,6 +231,11 @@ impl Vma {
         self.flags
     }
 
+    /// 设置标志
+    pub fn set_flags(&mut self, flags: VmaFlags) {
+        self.flags = flags;
+    }
+
     /// 获取类型
     #[inline]
     pub fn vma_type(&self) -> VmaType {
@@ -226,6 +247,19 @@ impl Vma {
         self.vma_type = vma_type;
     }
 
+    /// 页缓存的 inode 号（文件映射）
+    #[inline]
+    pub fn mapping(&self) -> Option<u64> {
+        self.mapping
+    }
+
+    /// 设置为文件映射：从文件字节偏移 offset 开始映射 ino 的页缓存
+    pub fn set_file_mapping(&mut self, ino: u64, offset: usize) {
+        self.vma_type = VmaType::FileBacked;
+        self.mapping = Some(ino);
+        self.offset = offset;
+    }
+
     /// 检查地址是否在 VMA 范围内
     #[inline]
     pub fn contains(&self, addr: VirtAddr) -> bool {
@@ -271,6 +305,7 @@ impl Vma {
             flags: self.flags,
             offset: self.offset,
             vma_type: self.vma_type,
+            mapping: self.mapping,
         };
 
         let second = Vma {
@@ -279,17 +314,37 @@ impl Vma {
             flags: self.flags,
             offset: self.offset + (aligned_addr.as_usize() - self.start.as_usize()),
             vma_type: self.vma_type,
+            mapping: self.mapping,
         };
 
         Some((first, second))
     }
 
+    /// 把从 from 开始的部分放到 [new_start, new_start + size)（mremap，copy_vma）
+    ///
+    /// 标志、类型和文件映射不变，文件偏移对应 from
+    pub fn remap(&self, from: VirtAddr, new_start: VirtAddr, size: usize) -> Vma {
+        debug_assert!(self.contains(from));
+        assert!(new_start.as_usize() % PAGE_SIZE == 0 && size % PAGE_SIZE == 0 && size > 0);
+
+        Vma {
+            start: new_start,
+            end: VirtAddr::new(new_start.as_usize() + size),
+            flags: self.flags,
+            offset: self.offset + (from.as_usize() - self.start.as_usize()),
+            vma_type: self.vma_type,
+            mapping: self.mapping,
+        }
+    }
+
     /// 可以与另一个 VMA 合并吗？
     pub fn can_merge(&self, other: &Vma) -> bool {
         // 必须相邻且具有相同的属性
         self.end.as_usize() == other.start.as_usize()
             && self.flags.bits() == other.flags.bits()
             && self.vma_type == other.vma_type
+            && self.mapping == other.mapping
+            && (self.mapping.is_none() || self.offset + self.size() == other.offset)
     }
 
     /// 与另一个 VMA 合并
@@ -498,6 +553,32 @@ mod tests {
         assert!(!vma.contains(VirtAddr::new(0x3000)));
         assert!(!vma.contains(VirtAddr::new(0xfff)));
     }
+
+    #[test]
+    fn test_vma_file_mapping_merge() {
+        let flags = VmaFlags::from_bits(VmaFlags::READ | VmaFlags::EXEC);
+        let mut text = Vma::new(VirtAddr::new(0x10000), VirtAddr::new(0x14000), flags);
+        text.set_file_mapping(7, 0);
+        assert_eq!(text.vma_type(), VmaType::FileBacked);
+        assert_eq!(text.mapping(), Some(7));
+
+        // 分裂后两部分共享页缓存，后半部分的文件偏移随之前移
+        let (first, second) = text.split(VirtAddr::new(0x12000)).unwrap();
+        assert_eq!(first.mapping(), Some(7));
+        assert_eq!(second.offset(), 0x2000);
+
+        // 文件偏移连续才能合并
+        let mut merged = first;
+        assert!(merged.merge(second));
+        assert_eq!(merged.end(), VirtAddr::new(0x14000));
+
+        let mut gap = Vma::new(VirtAddr::new(0x14000), VirtAddr::new(0x15000), flags);
+        gap.set_file_mapping(7, 0x8000);
+        assert!(!merged.can_merge(&gap));
+
+        let anon = Vma::new(VirtAddr::new(0x14000), VirtAddr::new(0x15000), flags);
+        assert!(!merged.can_merge(&anon));
+    }
 }
 
 // ============================================================================
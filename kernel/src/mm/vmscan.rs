@@ -0,0 +1,467 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 页回收 (page reclaim)
+//!
+//! 参考 Linux: mm/vmscan.c (shrink_lruvec, shrink_active_list, shrink_inactive_list, kswapd),
+//!            mm/swap.c (lru_cache_add, mark_page_accessed)
+//!
+//! # 设计
+//! - 可回收的页缓存页、私有匿名页和 MADV_FREE 标记的匿名页挂在 active / inactive 两条 LRU 链表上。Page 描述符中没有
+//!   链表指针，链表按 PFN 记录；Lru / Active 标志与页所在链表保持一致
+//! - 新页加入 inactive 链表头部，回收从尾部开始；访问只设置 Referenced，
+//!   扫描到带 Referenced 的 inactive 页时提升到 active (二次机会)
+//! - active 链表比 inactive 长时把尾部的页降级，被访问过的页清除 Referenced 后放回头部
+//! - 只回收只被页缓存引用（refcount == 1）的页；仍被映射的页转回 active
+//! - 惰性释放的匿名页在所属地址空间的页表锁内解除映射，标记后写入过的页不回收；
+//!   一批页解除映射后用一次 flush_tlb_all 刷新所有 CPU 再释放
+//! - 可换出的匿名页 (SwapBacked) 压缩保存到 zswap 后换成交换项；可写的页第一次扫描时
+//!   只写保护并放回 inactive 链表，之后再被写入会重新标记访问，下一次扫描到时才换出
+//! - 除页缓存外还调用各个收缩器 (shrinker)：dentry 缓存、块缓存（脏缓冲区先回写）、
+//!   kmem_cache 空闲 slab，最后把完全空闲的堆扩展块还给物理页分配器
+//!
+//! # 触发
+//! - 分配页时空闲页低于低水位，唤醒 kswapd，回收到高水位为止。
+//!   内核没有独立的内核线程，kswapd 在 CPU 0 的空闲循环中运行
+//! - 分配失败时同步回收一次后重试 (direct reclaim)
+//! - 内存控制组超过 memory.max / memory.high 时只回收该组的页 (memcg reclaim)，
+//!   链表是全局的，扫描时跳过其他组的页并按原顺序放回
+//! - 回收可能在持有各种锁的分配路径中发生，收缩器一律使用 try_lock，拿不到锁就跳过
+
+use alloc::collections::VecDeque;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use spin::Mutex;
+
+use super::memcontrol::{mem_cgroup_is_descendant, page_memcg, MemCgroup};
+use super::page::{frame_stats, PhysFrame};
+use super::page_desc::{pfn_to_page, PageFlag, PageType};
+use super::pcp::free_user_page;
+use super::vmstat::{count_vm_event, vm_event, VmEvent};
+
+/// 每轮扫描 inactive 链表的页数 (SWAP_CLUSTER_MAX)
+pub const SWAP_CLUSTER_MAX: usize = 32;
+
+/// 最低水位下限（页）
+const MIN_WMARK_FLOOR: usize = 128;
+
+/// kswapd 每次运行最多扫描的轮数，避免长时间占用空闲循环
+const KSWAPD_MAX_ROUNDS: usize = 16;
+
+/// LRU 链表 (struct lruvec)
+struct LruVec {
+    /// 活跃页，头部最近访问
+    active: VecDeque<usize>,
+    /// 非活跃页，尾部最先回收
+    inactive: VecDeque<usize>,
+}
+
+static LRU: Mutex<LruVec> = Mutex::new(LruVec {
+    active: VecDeque::new(),
+    inactive: VecDeque::new(),
+});
+
+/// kswapd 唤醒请求
+static KSWAPD_WAKE: AtomicBool = AtomicBool::new(false);
+
+/// 正在回收，防止回收过程中的分配再次进入回收
+static RECLAIMING: AtomicBool = AtomicBool::new(false);
+
+/// 统计：回收的页缓存页数 (pgsteal)
+static NR_RECLAIMED: AtomicUsize = AtomicUsize::new(0);
+/// 统计：回收的惰性释放匿名页数 (pglazyfreed)
+static NR_LAZYFREE: AtomicUsize = AtomicUsize::new(0);
+/// 统计：换出到 zswap 后释放的匿名页数 (pgsteal_anon)
+static NR_SWAPPED: AtomicUsize = AtomicUsize::new(0);
+/// 统计：kswapd 运行次数 (pageoutrun)
+static NR_KSWAPD_RUNS: AtomicUsize = AtomicUsize::new(0);
+/// 统计：直接回收次数 (allocstall)
+static NR_DIRECT_RECLAIM: AtomicUsize = AtomicUsize::new(0);
+/// 统计：内存控制组定向回收次数
+static NR_MEMCG_RECLAIM: AtomicUsize = AtomicUsize::new(0);
+
+// ==================== LRU 维护 ====================
+
+/// 新页加入 inactive 链表 (lru_cache_add)
+pub fn lru_cache_add(pfn: usize) {
+    let page = pfn_to_page(pfn);
+    if page.is_null() {
+        return;
+    }
+    unsafe {
+        if (*page).test_and_set_flag(PageFlag::Lru) {
+            return;
+        }
+        (*page).clear_flag(PageFlag::Active);
+        // 分配时设置的 Referenced 不算访问
+        (*page).clear_flag(PageFlag::Referenced);
+    }
+    LRU.lock().inactive.push_front(pfn);
+}
+
+/// 记录一次访问 (mark_page_accessed)
+///
+/// 只设置标志，链表之间的移动推迟到扫描时进行，访问路径上不需要 LRU 锁
+pub fn mark_page_accessed(pfn: usize) {
+    let page = pfn_to_page(pfn);
+    if page.is_null() {
+        return;
+    }
+    unsafe { (*page).set_flag(PageFlag::Referenced) };
+}
+
+/// 页离开页缓存时从 LRU 删除 (lru_cache_del)
+///
+/// 只清除 Lru 标志，链表中残留的 PFN 在扫描时丢弃
+pub fn lru_cache_del(pfn: usize) {
+    let page = pfn_to_page(pfn);
+    if !page.is_null() {
+        unsafe {
+            (*page).clear_flag(PageFlag::Lru);
+            (*page).clear_flag(PageFlag::Active);
+        }
+    }
+}
+
+/// LRU 链表长度：(active, inactive)
+pub fn lru_sizes() -> (usize, usize) {
+    let lru = LRU.lock();
+    (lru.active.len(), lru.inactive.len())
+}
+
+// ==================== 水位 ====================
+
+/// 空闲页数
+fn nr_free_pages() -> usize {
+    frame_stats().free_frames
+}
+
+/// 页回收水位：(min, low, high) (setup_per_zone_wmarks)
+pub fn watermarks() -> (usize, usize, usize) {
+    let min = (super::page_desc::total_pages() / 256).max(MIN_WMARK_FLOOR);
+    (min, min * 5 / 4, min * 3 / 2)
+}
+
+/// 分配页后调用：空闲页低于低水位时唤醒 kswapd (wakeup_kswapd)
+#[inline]
+pub fn check_watermark() {
+    if KSWAPD_WAKE.load(Ordering::Relaxed) {
+        return;
+    }
+    let (_, low, _) = watermarks();
+    if nr_free_pages() < low {
+        KSWAPD_WAKE.store(true, Ordering::Release);
+    }
+}
+
+// ==================== 扫描 ====================
+
+/// 页是否属于本次回收的目标组；target 为 null 时是全局回收，所有页都是候选
+#[inline]
+fn page_in_target(pfn: usize, target: *mut MemCgroup) -> bool {
+    target.is_null() || unsafe { mem_cgroup_is_descendant(page_memcg(pfn), target) }
+}
+
+/// 不属于目标组的页按原顺序放回链表尾部
+fn putback_skipped(list: &mut VecDeque<usize>, skipped: Vec<usize>) {
+    for pfn in skipped.into_iter().rev() {
+        list.push_back(pfn);
+    }
+}
+
+/// 降级 active 链表尾部的页 (shrink_active_list)
+///
+/// 被访问过的页清除 Referenced 后放回头部，其余移到 inactive 链表；
+/// 定向回收时只处理目标组的页，最多检查整条链表
+fn shrink_active_list(lru: &mut LruVec, nr_to_scan: usize, target: *mut MemCgroup) {
+    let mut skipped = Vec::new();
+    let mut scanned = 0;
+    for _ in 0..lru.active.len() {
+        if scanned == nr_to_scan {
+            break;
+        }
+        let pfn = match lru.active.pop_back() {
+            Some(pfn) => pfn,
+            None => break,
+        };
+        let page = pfn_to_page(pfn);
+        if page.is_null() || !unsafe { (*page).test_flag(PageFlag::Lru) } {
+            continue;
+        }
+        if !page_in_target(pfn, target) {
+            skipped.push(pfn);
+            continue;
+        }
+        scanned += 1;
+        count_vm_event(VmEvent::PgRefill);
+        unsafe {
+            if (*page).test_and_clear_flag(PageFlag::Referenced) {
+                lru.active.push_front(pfn);
+            } else {
+                (*page).clear_flag(PageFlag::Active);
+                lru.inactive.push_front(pfn);
+            }
+        }
+    }
+    putback_skipped(&mut lru.active, skipped);
+}
+
+/// 从 inactive 链表尾部取出回收候选页 (isolate_lru_pages)
+///
+/// 最近访问过的页转到 active 链表 (folio_check_references)；
+/// 定向回收时跳过其他组的页，最多检查整条链表
+fn isolate_inactive(lru: &mut LruVec, nr_to_scan: usize, target: *mut MemCgroup) -> Vec<usize> {
+    let mut isolated = Vec::new();
+    let mut skipped = Vec::new();
+    let mut scanned = 0;
+    for _ in 0..lru.inactive.len() {
+        if scanned == nr_to_scan {
+            break;
+        }
+        let pfn = match lru.inactive.pop_back() {
+            Some(pfn) => pfn,
+            None => break,
+        };
+        let page = pfn_to_page(pfn);
+        if page.is_null() || !unsafe { (*page).test_flag(PageFlag::Lru) } {
+            continue;
+        }
+        if !page_in_target(pfn, target) {
+            skipped.push(pfn);
+            continue;
+        }
+        scanned += 1;
+        count_vm_event(VmEvent::PgScan);
+        unsafe {
+            if (*page).test_and_clear_flag(PageFlag::Referenced) {
+                (*page).set_flag(PageFlag::Active);
+                lru.active.push_front(pfn);
+            } else {
+                isolated.push(pfn);
+            }
+        }
+    }
+    putback_skipped(&mut lru.inactive, skipped);
+    isolated
+}
+
+/// 回收页缓存页 (shrink_lruvec)
+///
+/// # 返回
+/// 释放的页数
+pub fn shrink_page_cache(nr_to_scan: usize) -> usize {
+    shrink_lruvec(nr_to_scan, core::ptr::null_mut())
+}
+
+/// 回收 target 组及其子组的页，target 为 null 时不限组 (shrink_lruvec)
+fn shrink_lruvec(nr_to_scan: usize, target: *mut MemCgroup) -> usize {
+    let isolated = match LRU.try_lock() {
+        Some(mut lru) => {
+            // 保持 active 链表不长于 inactive 链表 (inactive_is_low)；
+            // 定向回收时组的页可能都在 active 链表上，每次都降级一批
+            if !target.is_null() {
+                shrink_active_list(&mut lru, nr_to_scan, target);
+            } else if lru.active.len() > lru.inactive.len() {
+                let excess = lru.active.len() - lru.inactive.len();
+                shrink_active_list(&mut lru, excess.min(nr_to_scan), target);
+            }
+            isolate_inactive(&mut lru, nr_to_scan, target)
+        }
+        None => return 0,
+    };
+
+    use crate::arch::mm::{try_to_swap_out, SwapOut};
+
+    let mut reclaimed = 0;
+    let mut putback = Vec::new();
+    let mut unmapped = Vec::new();
+    let mut swapped = Vec::new();
+    let mut protected = Vec::new();
+    for pfn in isolated {
+        let page = pfn_to_page(pfn);
+        if unsafe { (*page).page_type() } == PageType::Anonymous {
+            if unsafe { (*page).test_flag(PageFlag::SwapBacked) } {
+                // 可换出的匿名页：换出后与惰性释放页一起刷新 TLB 再释放
+                match try_to_swap_out(pfn) {
+                    SwapOut::Unmapped => swapped.push(pfn),
+                    SwapOut::Protected => protected.push(pfn),
+                    SwapOut::Keep | SwapOut::Removed => putback.push(pfn),
+                }
+            } else if crate::arch::mm::try_to_unmap_lazyfree(pfn) {
+                // MADV_FREE 的匿名页：先解除映射，统一刷新 TLB 后再释放
+                unmapped.push(pfn);
+            } else {
+                putback.push(pfn);
+            }
+        } else if super::filemap::try_remove_cached_page(pfn) {
+            reclaimed += 1;
+        } else {
+            putback.push(pfn);
+        }
+    }
+
+    // 解除映射的页在其他 CPU 的 TLB 中失效后才能释放 (try_to_unmap_flush)；
+    // 写保护的页刷新后内容不再变化，下一轮可以换出
+    if !unmapped.is_empty() || !swapped.is_empty() || !protected.is_empty() {
+        crate::arch::tlb::flush_tlb_all();
+        for &pfn in unmapped.iter().chain(swapped.iter()) {
+            lru_cache_del(pfn);
+            unsafe {
+                let page = pfn_to_page(pfn);
+                (*page).set_page_type(PageType::Normal);
+                (*page).clear_flag(PageFlag::SwapBacked);
+            }
+            free_user_page(PhysFrame::new(pfn));
+        }
+        reclaimed += unmapped.len() + swapped.len();
+        NR_LAZYFREE.fetch_add(unmapped.len(), Ordering::Relaxed);
+        NR_SWAPPED.fetch_add(swapped.len(), Ordering::Relaxed);
+    }
+    if !protected.is_empty() {
+        let mut lru = LRU.lock();
+        for pfn in protected {
+            if unsafe { (*pfn_to_page(pfn)).test_flag(PageFlag::Lru) } {
+                lru.inactive.push_front(pfn);
+            }
+        }
+    }
+
+    // 仍被映射或拿不到锁的页放回 active 链表；不再可回收的页已清除 Lru 标志
+    if !putback.is_empty() {
+        let mut lru = LRU.lock();
+        for pfn in putback {
+            let page = pfn_to_page(pfn);
+            if !page.is_null() && unsafe { (*page).test_flag(PageFlag::Lru) } {
+                unsafe { (*page).set_flag(PageFlag::Active) };
+                lru.active.push_front(pfn);
+            }
+        }
+    }
+
+    NR_RECLAIMED.fetch_add(reclaimed, Ordering::Relaxed);
+    reclaimed
+}
+
+/// 调用各个收缩器 (shrink_slab)
+///
+/// # 返回
+/// 释放的对象数（dentry、inode、缓冲区、slab、SkBuff 数据区）
+fn shrink_slab(nr_to_scan: usize) -> usize {
+    let mut freed = 0;
+    freed += crate::fs::dentry::dcache_shrink(nr_to_scan);
+    freed += crate::fs::inode::icache_shrink(nr_to_scan);
+    freed += crate::fs::bio::shrink_buffers();
+    freed += super::kmem_cache::kmem_cache_shrink_all();
+    freed += crate::net::skb_pool::skb_pool_drain_local();
+    freed
+}
+
+/// 回收一轮 (shrink_node)
+///
+/// # 返回
+/// 释放的页缓存页数与收缩器对象数之和
+fn shrink_node(nr_to_scan: usize) -> usize {
+    let mut progress = shrink_page_cache(nr_to_scan);
+    progress += shrink_slab(nr_to_scan);
+    // 收缩器释放的堆内存整块归还物理页分配器
+    progress += super::buddy_allocator::shrink_heap() / super::PAGE_SIZE;
+    progress
+}
+
+/// 直接回收 (try_to_free_pages)
+///
+/// 分配失败时由分配路径调用
+///
+/// # 返回
+/// 是否取得进展（值得重试分配）
+pub fn try_to_free_pages() -> bool {
+    if RECLAIMING.swap(true, Ordering::Acquire) {
+        return false;
+    }
+    NR_DIRECT_RECLAIM.fetch_add(1, Ordering::Relaxed);
+    // kcompactd 预先规整出的块和预清零页池中的页先归还
+    let progress = super::compaction::release_ready_block() + super::prezero::drain_zero_pool()
+        + shrink_node(SWAP_CLUSTER_MAX);
+    RECLAIMING.store(false, Ordering::Release);
+    progress > 0
+}
+
+/// 组内定向回收 (try_to_free_mem_cgroup_pages)
+///
+/// 计费超过 memory.max 或 memory.high 时调用，只回收 memcg 及其子组的页缓存页
+/// 与惰性释放的匿名页；收缩器管理的对象不计费，不调用收缩器。
+/// 回收中的分配只来自内核堆，不会再次计费，所以不与全局回收互斥
+///
+/// # 返回
+/// 释放的页数
+pub fn try_to_free_mem_cgroup_pages(memcg: *mut MemCgroup, nr_pages: usize) -> usize {
+    if memcg.is_null() {
+        return 0;
+    }
+    NR_MEMCG_RECLAIM.fetch_add(1, Ordering::Relaxed);
+    let nr_to_reclaim = nr_pages.max(SWAP_CLUSTER_MAX);
+    let mut reclaimed = 0;
+    for _ in 0..KSWAPD_MAX_ROUNDS {
+        let progress = shrink_lruvec(SWAP_CLUSTER_MAX, memcg);
+        reclaimed += progress;
+        if progress == 0 || reclaimed >= nr_to_reclaim {
+            break;
+        }
+    }
+    reclaimed
+}
+
+/// kswapd 主体 (balance_pgdat)
+///
+/// 由 CPU 0 的空闲循环调用；没有唤醒请求时立即返回
+pub fn kswapd_run() {
+    if !KSWAPD_WAKE.load(Ordering::Acquire) {
+        return;
+    }
+    if RECLAIMING.swap(true, Ordering::Acquire) {
+        return;
+    }
+    NR_KSWAPD_RUNS.fetch_add(1, Ordering::Relaxed);
+
+    let (_, _, high) = watermarks();
+    for _ in 0..KSWAPD_MAX_ROUNDS {
+        if nr_free_pages() >= high {
+            break;
+        }
+        if shrink_node(SWAP_CLUSTER_MAX) == 0 {
+            break;
+        }
+    }
+
+    KSWAPD_WAKE.store(false, Ordering::Release);
+    RECLAIMING.store(false, Ordering::Release);
+}
+
+/// 页回收统计
+#[derive(Debug, Clone, Copy, Default)]
+pub struct VmscanStats {
+    pub nr_active: usize,
+    pub nr_inactive: usize,
+    pub pgscan: usize,
+    pub pgsteal: usize,
+    pub pglazyfreed: usize,
+    pub kswapd_runs: usize,
+    pub allocstall: usize,
+    pub memcg_reclaim: usize,
+}
+
+/// 获取页回收统计 (/proc/vmstat)
+pub fn vmscan_stats() -> VmscanStats {
+    let (nr_active, nr_inactive) = lru_sizes();
+    VmscanStats {
+        nr_active,
+        nr_inactive,
+        pgscan: vm_event(VmEvent::PgScan) as usize,
+        pgsteal: NR_RECLAIMED.load(Ordering::Relaxed),
+        pglazyfreed: NR_LAZYFREE.load(Ordering::Relaxed),
+        kswapd_runs: NR_KSWAPD_RUNS.load(Ordering::Relaxed),
+        allocstall: NR_DIRECT_RECLAIM.load(Ordering::Relaxed),
+        memcg_reclaim: NR_MEMCG_RECLAIM.load(Ordering::Relaxed),
+    }
+}
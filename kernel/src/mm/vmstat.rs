@@ -0,0 +1,218 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内存事件计数 (vm_event_states)
+//!
+//! 参考 Linux: mm/vmstat.c (vmstat_start, all_vm_events), include/linux/vm_event_item.h
+//!
+//! 缺页、写时复制、页分配与释放、PCP 补充与归还、slab 增长与收缩和回收扫描
+//! 每发生一次在本 CPU 的计数上加一，由 /proc/vmstat 汇总各 CPU 后导出。
+//! 计数是原子变量，任务在加一前后迁移到其他 CPU 也不会丢失，不需要关中断。
+//!
+//! # 与 Linux 的差异
+//! - 页的分配与释放按阶分别计数 (pgalloc_order<N> / pgfree_order<N>)，没有 zone
+//! - 连续分配的页逐页释放，释放计入 0 阶；匿名大页整块释放，计入大页的阶
+
+use alloc::string::String;
+use core::fmt::Write;
+use core::sync::atomic::{AtomicU64, Ordering};
+
+use crate::config::MAX_CPUS;
+
+/// 计数的事件 (enum vm_event_item)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(usize)]
+pub enum VmEvent {
+    /// 缺页次数，包括需要读盘的缺页
+    PgFault = 0,
+    /// 需要读入文件页或换入的缺页
+    PgMajFault,
+    /// 写时复制出的私有页
+    CowFault,
+    /// 匿名读缺页映射的零页
+    ZeroPageMap,
+    /// PCP 从全局分配器批量补充
+    PcpRefill,
+    /// PCP 批量归还给全局分配器
+    PcpDrain,
+    /// slab 缓存分配新 slab
+    SlabGrow,
+    /// slab 缓存释放空闲 slab
+    SlabShrink,
+    /// inactive 链表扫描的页数 (pgscan)
+    PgScan,
+    /// active 链表扫描的页数 (pgrefill)
+    PgRefill,
+}
+
+/// 事件数
+pub const NR_VM_EVENTS: usize = 10;
+
+const EVENT_NAMES: [&str; NR_VM_EVENTS] = [
+    "pgfault",
+    "pgmajfault",
+    "cow_fault",
+    "zero_page_map",
+    "pcp_refill",
+    "pcp_drain",
+    "slab_grow",
+    "slab_shrink",
+    "pgscan",
+    "pgrefill",
+];
+
+/// 分别计数的阶数 (NR_PAGE_ORDERS)，更大的阶计入最后一阶
+pub const NR_PAGE_ORDERS: usize = 11;
+
+/// 一个 CPU 上的计数
+struct VmEventState {
+    events: [AtomicU64; NR_VM_EVENTS],
+    pgalloc: [AtomicU64; NR_PAGE_ORDERS],
+    pgfree: [AtomicU64; NR_PAGE_ORDERS],
+}
+
+impl VmEventState {
+    const fn new() -> Self {
+        Self {
+            events: [const { AtomicU64::new(0) }; NR_VM_EVENTS],
+            pgalloc: [const { AtomicU64::new(0) }; NR_PAGE_ORDERS],
+            pgfree: [const { AtomicU64::new(0) }; NR_PAGE_ORDERS],
+        }
+    }
+}
+
+crate::percpu! {
+    /// 各 CPU 的事件计数 (vm_event_states)
+    static VM_EVENT_STATES: VmEventState = VmEventState::new();
+}
+
+/// 记一次事件 (count_vm_event)
+#[inline]
+pub fn count_vm_event(event: VmEvent) {
+    count_vm_events(event, 1);
+}
+
+/// 记 n 次事件 (count_vm_events)
+#[inline]
+pub fn count_vm_events(event: VmEvent, n: u64) {
+    VM_EVENT_STATES.this_cpu().events[event as usize].fetch_add(n, Ordering::Relaxed);
+}
+
+/// 记一次 order 阶的分配 (PGALLOC)
+#[inline]
+pub fn count_pgalloc(order: usize) {
+    VM_EVENT_STATES.this_cpu().pgalloc[order.min(NR_PAGE_ORDERS - 1)].fetch_add(1, Ordering::Relaxed);
+}
+
+/// 记一次 order 阶的释放 (PGFREE)
+#[inline]
+pub fn count_pgfree(order: usize) {
+    VM_EVENT_STATES.this_cpu().pgfree[order.min(NR_PAGE_ORDERS - 1)].fetch_add(1, Ordering::Relaxed);
+}
+
+/// 能容纳 nr 页的最小阶 (get_order)
+#[inline]
+pub fn nr_pages_order(nr: usize) -> usize {
+    nr.max(1).next_power_of_two().trailing_zeros() as usize
+}
+
+/// 汇总各 CPU 后的计数 (sum_vm_events)
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct VmEvents {
+    pub events: [u64; NR_VM_EVENTS],
+    pub pgalloc: [u64; NR_PAGE_ORDERS],
+    pub pgfree: [u64; NR_PAGE_ORDERS],
+}
+
+impl VmEvents {
+    #[inline]
+    pub fn event(&self, event: VmEvent) -> u64 {
+        self.events[event as usize]
+    }
+
+    /// 分配的页数，按阶折算
+    pub fn pages_allocated(&self) -> u64 {
+        self.pgalloc.iter().enumerate().map(|(order, &n)| n << order).sum()
+    }
+
+    /// 释放的页数，按阶折算
+    pub fn pages_freed(&self) -> u64 {
+        self.pgfree.iter().enumerate().map(|(order, &n)| n << order).sum()
+    }
+}
+
+/// 一个 CPU 上的计数
+pub fn cpu_vm_events(cpu_id: usize) -> VmEvents {
+    let state = VM_EVENT_STATES.per_cpu(cpu_id);
+    let load = |a: &[AtomicU64]| -> [u64; NR_PAGE_ORDERS] { core::array::from_fn(|i| a[i].load(Ordering::Relaxed)) };
+    VmEvents {
+        events: core::array::from_fn(|i| state.events[i].load(Ordering::Relaxed)),
+        pgalloc: load(&state.pgalloc),
+        pgfree: load(&state.pgfree),
+    }
+}
+
+/// 汇总所有 CPU 的计数 (all_vm_events)
+pub fn all_vm_events() -> VmEvents {
+    let mut sum = VmEvents::default();
+    for cpu_id in 0..MAX_CPUS {
+        let ev = cpu_vm_events(cpu_id);
+        for (total, count) in sum.events.iter_mut().zip(ev.events.iter()) {
+            *total += count;
+        }
+        for order in 0..NR_PAGE_ORDERS {
+            sum.pgalloc[order] += ev.pgalloc[order];
+            sum.pgfree[order] += ev.pgfree[order];
+        }
+    }
+    sum
+}
+
+/// 一个事件在所有 CPU 上的计数
+pub fn vm_event(event: VmEvent) -> u64 {
+    (0..MAX_CPUS)
+        .map(|cpu_id| VM_EVENT_STATES.per_cpu(cpu_id).events[event as usize].load(Ordering::Relaxed))
+        .sum()
+}
+
+/// /proc/vmstat 的内容 (vmstat_show)
+///
+/// 每行一个 "名称 数值"：先是页数统计，再是事件计数，最后是回收、规整与 OOM 的统计
+pub fn vmstat() -> String {
+    let mut out = String::new();
+    let frames = super::page::frame_stats();
+    let reclaim = super::vmscan::vmscan_stats();
+    let compact = super::compaction::compaction_stats();
+    let (_, nr_file_pages) = super::filemap::page_cache_stats();
+    let ev = all_vm_events();
+
+    let _ = writeln!(out, "nr_free_pages {}", frames.free_frames);
+    let _ = writeln!(out, "nr_active {}", reclaim.nr_active);
+    let _ = writeln!(out, "nr_inactive {}", reclaim.nr_inactive);
+    let _ = writeln!(out, "nr_file_pages {}", nr_file_pages);
+    let _ = writeln!(out, "nr_anon_transparent_hugepages {}", crate::arch::riscv64::mm::nr_anon_huge_pages());
+    for order in 0..NR_PAGE_ORDERS {
+        let _ = writeln!(out, "pgalloc_order{} {}", order, ev.pgalloc[order]);
+    }
+    for order in 0..NR_PAGE_ORDERS {
+        let _ = writeln!(out, "pgfree_order{} {}", order, ev.pgfree[order]);
+    }
+    let _ = writeln!(out, "pgalloc {}", ev.pages_allocated());
+    let _ = writeln!(out, "pgfree {}", ev.pages_freed());
+    for (name, count) in EVENT_NAMES.iter().zip(ev.events.iter()) {
+        let _ = writeln!(out, "{} {}", name, count);
+    }
+    let _ = writeln!(out, "pgsteal {}", reclaim.pgsteal);
+    let _ = writeln!(out, "pglazyfreed {}", reclaim.pglazyfreed);
+    let _ = writeln!(out, "pageoutrun {}", reclaim.kswapd_runs);
+    let _ = writeln!(out, "allocstall {}", reclaim.allocstall);
+    let _ = writeln!(out, "compact_stall {}", compact.compact_stall);
+    let _ = writeln!(out, "compact_success {}", compact.compact_success);
+    let _ = writeln!(out, "compact_fail {}", compact.compact_fail);
+    let _ = writeln!(out, "pgmigrate_success {}", compact.pgmigrate_success);
+    let _ = writeln!(out, "pgmigrate_fail {}", compact.pgmigrate_fail);
+    let _ = writeln!(out, "oom_kill {}", super::oom_kill::nr_oom_kills());
+    out
+}
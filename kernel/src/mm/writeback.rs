@@ -0,0 +1,398 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 脏页回写 (writeback)
+//!
+//! 参考 Linux: mm/page-writeback.c (balance_dirty_pages), fs/fs-writeback.c (wb_workfn)
+//!
+//! 延迟写把数据留在页缓存的脏页中（见 filemap::write_dirty），由这里决定何时写回：
+//! - 有脏页的文件登记在 DIRTY_MAPPINGS (wb->b_dirty) 中
+//! - 回写线程 (flusher) 每 DIRTY_WRITEBACK_INTERVAL 检查一次，回写变脏超过
+//!   DIRTY_EXPIRE_INTERVAL 的文件；脏页超过后台阈值 (dirty_background_ratio) 时
+//!   立即从最早变脏的文件开始回写，直到低于阈值
+//! - 写入者按脏页的多少被限速 (balance_dirty_pages)：低于后台阈值与 dirty_ratio 阈值的中点
+//!   (freerun) 时不受限制；在中点和 dirty_ratio 之间按所处的位置和本设备的脏页占它应得份额的
+//!   比例睡眠一段时间，让回写线程赶上；超过 dirty_ratio 时同步回写所写的文件
+//! - 每个后备设备 (BdiWriteback) 统计自己的脏页和回写完成数，设备的脏页份额按最近回写完成的
+//!   比例分配 (wb_calc_thresh)：回写快的设备分到更多份额，慢设备上的写入者先被放慢
+//! - dirty_ratio 与 dirty_background_ratio 可以通过 /proc/sys/vm 调整
+//! - fsync 回写单个文件，sync 回写全部文件
+//! - 脏 inode 登记在 inode 缓存中（见 fs::inode::mark_inode_dirty），在同一轮回写的数据之后写回
+//! - 内核没有独立的内核线程，与 kswapd 一样在 CPU 0 的空闲循环中运行
+
+use alloc::collections::{BTreeMap, BTreeSet};
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+use spin::Mutex;
+
+use super::filemap::{self, FileMapping};
+use super::page_desc::total_pages;
+use crate::drivers::timer::{get_jiffies, HZ};
+use crate::fs::inode;
+
+/// 脏页占内存的比例超过它时后台回写 (dirty_background_ratio)
+static DIRTY_BACKGROUND_RATIO: AtomicUsize = AtomicUsize::new(10);
+
+/// 脏页占内存的比例超过它时写入者同步回写 (dirty_ratio)
+static DIRTY_RATIO: AtomicUsize = AtomicUsize::new(20);
+
+/// 脏页保留的最长时间 (dirty_expire_centisecs = 30s)
+const DIRTY_EXPIRE_INTERVAL: u64 = 30 * HZ;
+
+/// 回写线程的检查周期 (dirty_writeback_centisecs = 5s)
+const DIRTY_WRITEBACK_INTERVAL: u64 = 5 * HZ;
+
+/// 写入者一次限速的最长睡眠时间 (MAX_PAUSE = 200ms)
+pub const MAX_PAUSE: u64 = HZ / 5;
+
+/// 按这么多新脏页计算一次完整的限速时间 (ratelimit_pages)
+pub const DIRTY_RATELIMIT_PAGES: usize = 32;
+
+/// 后备设备的回写状态 (struct bdi_writeback)
+pub struct BdiWriteback {
+    /// 设备标识 (bdi->dev)，0 为没有独立设备的页缓存
+    id: u64,
+    /// 本设备的脏页数 (WB_RECLAIMABLE)
+    nr_dirty: AtomicUsize,
+    /// 累计回写的页数 (WB_WRITTEN)
+    nr_written: AtomicUsize,
+    /// 最近回写完成的页数，每个回写周期减半 (wb->completions)
+    completions: AtomicUsize,
+}
+
+impl BdiWriteback {
+    const fn new(id: u64) -> Self {
+        Self {
+            id,
+            nr_dirty: AtomicUsize::new(0),
+            nr_written: AtomicUsize::new(0),
+            completions: AtomicUsize::new(0),
+        }
+    }
+
+    /// 设备标识
+    pub fn id(&self) -> u64 {
+        self.id
+    }
+
+    /// 本设备的脏页数
+    pub fn nr_dirty(&self) -> usize {
+        self.nr_dirty.load(Ordering::Relaxed)
+    }
+
+    /// 累计回写的页数
+    pub fn nr_written(&self) -> usize {
+        self.nr_written.load(Ordering::Relaxed)
+    }
+
+    pub(super) fn inc_dirty(&self) {
+        self.nr_dirty.fetch_add(1, Ordering::Relaxed);
+    }
+
+    pub(super) fn dec_dirty(&self) {
+        self.nr_dirty.fetch_sub(1, Ordering::Relaxed);
+    }
+
+    /// 记录回写完成的页数 (wb_domain_writeout_add)
+    pub(super) fn account_written(&self, nr: usize) {
+        self.nr_written.fetch_add(nr, Ordering::Relaxed);
+        self.completions.fetch_add(nr, Ordering::Relaxed);
+        COMPLETIONS.fetch_add(nr, Ordering::Relaxed);
+        NR_WRITTEN.fetch_add(nr, Ordering::Relaxed);
+    }
+
+    /// 本设备应得的脏页份额（页）(wb_calc_thresh)
+    ///
+    /// 按最近回写完成的比例分配 thresh；还没有回写过的设备得到整个 thresh
+    pub fn calc_thresh(&self, thresh: usize) -> usize {
+        let total = COMPLETIONS.load(Ordering::Relaxed);
+        if total == 0 {
+            return thresh;
+        }
+        let own = self.completions.load(Ordering::Relaxed).min(total);
+        (thresh as u64 * own as u64 / total as u64) as usize
+    }
+}
+
+/// 已登记的后备设备 (bdi_list)
+static BDI_LIST: Mutex<BTreeMap<u64, Arc<BdiWriteback>>> = Mutex::new(BTreeMap::new());
+
+/// 所有设备最近回写完成的页数，与各设备的 completions 一起减半 (dom->completions)
+static COMPLETIONS: AtomicUsize = AtomicUsize::new(0);
+
+/// 获取后备设备的回写状态，不存在时创建 (bdi_register)
+pub fn get_bdi(id: u64) -> Arc<BdiWriteback> {
+    BDI_LIST.lock().entry(id).or_insert_with(|| Arc::new(BdiWriteback::new(id))).clone()
+}
+
+/// 已登记的后备设备
+pub fn bdi_list() -> Vec<Arc<BdiWriteback>> {
+    BDI_LIST.lock().values().cloned().collect()
+}
+
+/// 回写完成数减半，份额跟随最近的回写速度 (fprop_new_period)
+fn age_completions() {
+    for wb in BDI_LIST.lock().values() {
+        let c = wb.completions.load(Ordering::Relaxed);
+        wb.completions.fetch_sub(c - c / 2, Ordering::Relaxed);
+    }
+    let c = COMPLETIONS.load(Ordering::Relaxed);
+    COMPLETIONS.fetch_sub(c - c / 2, Ordering::Relaxed);
+}
+
+/// 有脏页的文件（页缓存键）
+static DIRTY_MAPPINGS: Mutex<BTreeSet<u64>> = Mutex::new(BTreeSet::new());
+
+/// 回写线程上次运行的时刻 (jiffies)
+static LAST_WRITEBACK: AtomicU64 = AtomicU64::new(0);
+
+/// 正在回写，防止空闲循环重入
+static WRITEBACK_RUNNING: AtomicBool = AtomicBool::new(false);
+
+/// 统计：回写的页数 (nr_written)
+static NR_WRITTEN: AtomicUsize = AtomicUsize::new(0);
+
+/// 统计：写入者被限速睡眠的次数 (nr_dirty_throttled)
+static NR_THROTTLED: AtomicUsize = AtomicUsize::new(0);
+
+/// 写入者请求立即开始后台回写 (wb_start_background_writeback)
+static WB_KICK: AtomicBool = AtomicBool::new(false);
+
+/// dirty_background_ratio
+pub fn dirty_background_ratio() -> usize {
+    DIRTY_BACKGROUND_RATIO.load(Ordering::Relaxed)
+}
+
+/// dirty_ratio
+pub fn dirty_ratio() -> usize {
+    DIRTY_RATIO.load(Ordering::Relaxed)
+}
+
+/// 解析 /proc/sys/vm 中写入的百分比 (proc_dointvec_minmax, 0..=100)
+fn parse_ratio(data: &[u8]) -> Result<usize, i32> {
+    core::str::from_utf8(data)
+        .ok()
+        .and_then(|s| s.trim().parse::<usize>().ok())
+        .filter(|&ratio| ratio <= 100)
+        .ok_or(crate::errno::Errno::InvalidArgument.as_neg_i32())
+}
+
+/// 写入 /proc/sys/vm/dirty_ratio
+pub fn write_dirty_ratio(data: &[u8]) -> Result<usize, i32> {
+    DIRTY_RATIO.store(parse_ratio(data)?, Ordering::Relaxed);
+    Ok(data.len())
+}
+
+/// 写入 /proc/sys/vm/dirty_background_ratio
+pub fn write_dirty_background_ratio(data: &[u8]) -> Result<usize, i32> {
+    DIRTY_BACKGROUND_RATIO.store(parse_ratio(data)?, Ordering::Relaxed);
+    Ok(data.len())
+}
+
+/// 后台回写阈值（页）
+///
+/// 不低于 dirty_ratio 阈值时取它的一半 (domain_dirty_limits)
+fn background_thresh() -> usize {
+    let bg = total_pages() * dirty_background_ratio() / 100;
+    let thresh = dirty_thresh();
+    if bg >= thresh {
+        thresh / 2
+    } else {
+        bg
+    }
+}
+
+/// 写入者同步回写的阈值（页）
+fn dirty_thresh() -> usize {
+    total_pages() * dirty_ratio() / 100
+}
+
+/// 文件有了第一个脏页时登记 (__mark_inode_dirty)
+pub(super) fn mark_mapping_dirty(key: u64) {
+    DIRTY_MAPPINGS.lock().insert(key);
+}
+
+/// 写入者的限速方式
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum DirtyThrottle {
+    /// 低于 freerun，不限速
+    FreeRun,
+    /// 睡眠这么多 jiffies，同时唤醒后台回写
+    Pause(u64),
+    /// 超过 dirty_ratio，同步回写所写的文件
+    Sync,
+}
+
+/// 计算写入者的限速 (balance_dirty_pages 中的 pos_ratio 与 pause)
+///
+/// # 参数
+/// - nr_dirtied: 这次写入新弄脏的页数
+/// - dirty / thresh / bg_thresh: 全局脏页数与两个阈值
+/// - wb_dirty / wb_thresh: 本设备的脏页数与应得份额
+///
+/// 全局脏页在 freerun = (thresh + bg_thresh) / 2 与 thresh 之间时，按所处位置线性增加睡眠时间；
+/// 本设备的脏页超过份额越多睡得越久，低于份额一半时只睡一半。
+/// 每 DIRTY_RATELIMIT_PAGES 个新脏页对应一次完整的睡眠，不超过 MAX_PAUSE
+pub fn dirty_throttle(
+    nr_dirtied: usize,
+    dirty: usize,
+    thresh: usize,
+    bg_thresh: usize,
+    wb_dirty: usize,
+    wb_thresh: usize,
+) -> DirtyThrottle {
+    let freerun = (thresh + bg_thresh) / 2;
+    if dirty <= freerun || nr_dirtied == 0 {
+        return DirtyThrottle::FreeRun;
+    }
+    if dirty >= thresh {
+        return DirtyThrottle::Sync;
+    }
+    // 全局位置 [0, 1)，以 1/1024 为单位
+    let pos = ((dirty - freerun) as u64 * 1024) / (thresh - freerun).max(1) as u64;
+    // 本设备的脏页相对份额：[1/2, 2]
+    let wb_pos = ((wb_dirty as u64 * 1024) / wb_thresh.max(1) as u64).clamp(512, 2048);
+    let pause = MAX_PAUSE * pos * wb_pos / (1024 * 1024);
+    let pause = (pause * nr_dirtied as u64 / DIRTY_RATELIMIT_PAGES as u64).min(MAX_PAUSE);
+    DirtyThrottle::Pause(pause.max(1))
+}
+
+/// 写入后检查脏页数 (balance_dirty_pages)
+///
+/// 按 dirty_throttle 的结果限速写入者；睡眠时间由脏页所处的位置决定，
+/// 写入者被均匀地放慢，而不是在达到 dirty_ratio 时突然停下来同步回写
+pub fn balance_dirty_pages(mapping: &FileMapping, nr_dirtied: usize) {
+    let thresh = dirty_thresh();
+    let bg_thresh = background_thresh();
+    let wb = mapping.bdi();
+    let throttle = dirty_throttle(nr_dirtied, filemap::nr_file_dirty(), thresh, bg_thresh,
+                                  wb.nr_dirty(), wb.calc_thresh(thresh));
+    match throttle {
+        DirtyThrottle::FreeRun => {}
+        DirtyThrottle::Sync => {
+            let _ = mapping.writeback();
+        }
+        DirtyThrottle::Pause(pause) => {
+            // 让空闲循环中的回写线程立即开始，不必等 DIRTY_WRITEBACK_INTERVAL
+            WB_KICK.store(true, Ordering::Release);
+            NR_THROTTLED.fetch_add(1, Ordering::Relaxed);
+            if let Some(task) = crate::sched::current() {
+                task.set_state(crate::process::task::TaskState::Uninterruptible);
+                crate::time::timer::schedule_timeout(pause);
+                task.set_state(crate::process::task::TaskState::Running);
+            }
+        }
+    }
+}
+
+/// 回写登记的文件 (wb_writeback)
+///
+/// 从最早变脏的文件开始；expired_only 时只回写变脏超过 DIRTY_EXPIRE_INTERVAL 的文件，
+/// 否则回写到脏页低于 stop_below 为止
+///
+/// # 返回
+/// 回写的页数
+fn writeback_mappings(expired_only: bool, stop_below: usize) -> usize {
+    let now = get_jiffies();
+    let mut queue: Vec<(u64, u64)> = {
+        let keys = DIRTY_MAPPINGS.lock().iter().copied().collect::<Vec<_>>();
+        keys.into_iter()
+            .map(|key| {
+                let when = filemap::find_mapping(key).map_or(0, |m| m.dirtied_when());
+                (when, key)
+            })
+            .collect()
+    };
+    queue.sort_unstable();
+
+    let mut written = 0;
+    for (when, key) in queue {
+        if !expired_only && filemap::nr_file_dirty() <= stop_below {
+            break;
+        }
+        if expired_only && when != 0 && now.saturating_sub(when) < DIRTY_EXPIRE_INTERVAL {
+            // 按变脏时间排序，之后的文件都还没到期
+            break;
+        }
+        if let Some(mapping) = filemap::find_mapping(key) {
+            if let Ok(n) = mapping.writeback() {
+                written += n;
+            }
+        }
+
+        // 在登记锁内确认已经干净再注销，与 mark_mapping_dirty 不会交错
+        let mut dirty = DIRTY_MAPPINGS.lock();
+        if filemap::find_mapping(key).map_or(true, |m| m.nr_dirty() == 0) {
+            dirty.remove(&key);
+        }
+    }
+    written
+}
+
+/// 回写线程主体 (wb_workfn)
+///
+/// 由 CPU 0 的空闲循环调用：脏页超过后台阈值或被限速的写入者唤醒时立即回写，
+/// 否则每 DIRTY_WRITEBACK_INTERVAL 回写到期的文件，并让各设备的回写完成数减半
+pub fn wb_run() {
+    if DIRTY_MAPPINGS.lock().is_empty() && !inode::has_dirty_inodes() {
+        return;
+    }
+    let now = get_jiffies();
+    let kicked = WB_KICK.swap(false, Ordering::AcqRel);
+    let over_background = kicked || filemap::nr_file_dirty() > background_thresh();
+    let periodic = now.saturating_sub(LAST_WRITEBACK.load(Ordering::Relaxed)) >= DIRTY_WRITEBACK_INTERVAL;
+    if !over_background && !periodic {
+        return;
+    }
+    if WRITEBACK_RUNNING.swap(true, Ordering::Acquire) {
+        return;
+    }
+    if periodic {
+        LAST_WRITEBACK.store(now, Ordering::Relaxed);
+        age_completions();
+    }
+
+    if over_background {
+        writeback_mappings(false, background_thresh());
+    }
+    writeback_mappings(true, 0);
+    // 数据写回之后再写回到期的 inode（大小、块映射）
+    inode::writeback_inodes(None, true);
+
+    WRITEBACK_RUNNING.store(false, Ordering::Release);
+}
+
+/// 回写所有文件的脏页和脏 inode (sync_inodes_sb)
+///
+/// # 返回
+/// 回写的页数
+pub fn sync_all() -> usize {
+    let written = writeback_mappings(false, 0);
+    inode::writeback_inodes(None, false);
+    written
+}
+
+/// 回写统计
+#[derive(Debug, Clone, Copy, Default)]
+pub struct WritebackStats {
+    /// 脏页数
+    pub nr_dirty: usize,
+    /// 有脏页的文件数
+    pub nr_dirty_mappings: usize,
+    /// 累计回写的页数
+    pub nr_written: usize,
+    /// 写入者被限速睡眠的次数
+    pub nr_throttled: usize,
+}
+
+/// 获取回写统计
+pub fn writeback_stats() -> WritebackStats {
+    WritebackStats {
+        nr_dirty: filemap::nr_file_dirty(),
+        nr_dirty_mappings: DIRTY_MAPPINGS.lock().len(),
+        nr_written: NR_WRITTEN.load(Ordering::Relaxed),
+        nr_throttled: NR_THROTTLED.load(Ordering::Relaxed),
+    }
+}
@@ -0,0 +1,224 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 基数树索引 (XArray)
+//!
+//! 参考 Linux: lib/xarray.c, include/linux/xarray.h
+//!
+//! 页缓存按页偏移查找页。有序映射每次查找要比较 O(log n) 次键并在节点间跳转，
+//! 基数树按索引的位段逐层下标访问，树高只取决于最大索引：
+//! - 每个节点 64 个槽位 (XA_CHUNK_SHIFT = 6)，4 层即可覆盖 16M 页（64GB 文件）
+//! - 索引超出当前容量时在根上方加层 (xas_expand)，删除后只剩首槽位时降层 (xas_shrink)
+//! - 空节点在删除最后一项时立即释放
+//! - 不加锁，由调用者（FileMapping 的页缓存锁）保护
+
+use alloc::boxed::Box;
+
+/// 每层索引的位数
+const XA_CHUNK_SHIFT: usize = 6;
+/// 每个节点的槽位数
+const XA_CHUNK_SIZE: usize = 1 << XA_CHUNK_SHIFT;
+/// 槽位下标掩码
+const XA_CHUNK_MASK: usize = XA_CHUNK_SIZE - 1;
+
+enum XaSlot {
+    Empty,
+    /// 叶子节点中的值
+    Value(usize),
+    /// 下一层节点
+    Node(Box<XaNode>),
+}
+
+struct XaNode {
+    /// 本层槽位对应索引的位移（叶子节点为 0）
+    shift: usize,
+    /// 非空槽位数
+    count: usize,
+    slots: [XaSlot; XA_CHUNK_SIZE],
+}
+
+impl XaNode {
+    fn new(shift: usize) -> Box<Self> {
+        Box::new(Self {
+            shift,
+            count: 0,
+            slots: core::array::from_fn(|_| XaSlot::Empty),
+        })
+    }
+
+    /// 本节点覆盖的索引范围大小超过 index 时返回 true
+    fn covers(&self, index: usize) -> bool {
+        let shift = self.shift + XA_CHUNK_SHIFT;
+        shift >= usize::BITS as usize || index >> shift == 0
+    }
+
+    fn erase(&mut self, index: usize) -> Option<usize> {
+        let offset = (index >> self.shift) & XA_CHUNK_MASK;
+        let old = match &mut self.slots[offset] {
+            XaSlot::Empty => return None,
+            XaSlot::Value(value) => Some(*value),
+            XaSlot::Node(child) => {
+                let old = child.erase(index);
+                if child.count != 0 {
+                    return old;
+                }
+                old
+            }
+        };
+        self.slots[offset] = XaSlot::Empty;
+        self.count -= 1;
+        old
+    }
+
+    fn for_each(&self, base: usize, start: usize, end: usize, f: &mut dyn FnMut(usize, usize)) {
+        let span = 1usize << self.shift;
+        for (offset, slot) in self.slots.iter().enumerate() {
+            let lo = match offset.checked_mul(span).and_then(|off| base.checked_add(off)) {
+                Some(lo) => lo,
+                None => break,
+            };
+            if lo >= end {
+                break;
+            }
+            if lo.saturating_add(span) <= start {
+                continue;
+            }
+            match slot {
+                XaSlot::Empty => {}
+                XaSlot::Value(value) => f(lo, *value),
+                XaSlot::Node(child) => child.for_each(lo, start, end, f),
+            }
+        }
+    }
+}
+
+/// 索引 -> 值的基数树 (struct xarray)
+pub struct XArray {
+    root: Option<Box<XaNode>>,
+    /// 存放的值的个数
+    len: usize,
+}
+
+impl XArray {
+    /// 创建空树
+    pub const fn new() -> Self {
+        Self { root: None, len: 0 }
+    }
+
+    /// 存放的值的个数
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    /// 是否为空
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    /// 查找 index 处的值 (xa_load)
+    pub fn load(&self, index: usize) -> Option<usize> {
+        let mut node = self.root.as_deref()?;
+        if !node.covers(index) {
+            return None;
+        }
+        loop {
+            match &node.slots[(index >> node.shift) & XA_CHUNK_MASK] {
+                XaSlot::Empty => return None,
+                XaSlot::Value(value) => return Some(*value),
+                XaSlot::Node(child) => node = &**child,
+            }
+        }
+    }
+
+    /// 在 index 处存放 value (xa_store)
+    ///
+    /// # 返回
+    /// 被替换的旧值
+    pub fn store(&mut self, index: usize, value: usize) -> Option<usize> {
+        let root = self.root.get_or_insert_with(|| XaNode::new(0));
+        while !root.covers(index) {
+            let shift = root.shift + XA_CHUNK_SHIFT;
+            let old_root = core::mem::replace(root, XaNode::new(shift));
+            if old_root.count != 0 {
+                root.slots[0] = XaSlot::Node(old_root);
+                root.count = 1;
+            }
+        }
+
+        let mut node: &mut XaNode = root;
+        loop {
+            let offset = (index >> node.shift) & XA_CHUNK_MASK;
+            if node.shift == 0 {
+                return match core::mem::replace(&mut node.slots[offset], XaSlot::Value(value)) {
+                    XaSlot::Value(old) => Some(old),
+                    _ => {
+                        node.count += 1;
+                        self.len += 1;
+                        None
+                    }
+                };
+            }
+            if let XaSlot::Empty = node.slots[offset] {
+                node.slots[offset] = XaSlot::Node(XaNode::new(node.shift - XA_CHUNK_SHIFT));
+                node.count += 1;
+            }
+            node = match &mut node.slots[offset] {
+                XaSlot::Node(child) => &mut **child,
+                _ => unreachable!(),
+            };
+        }
+    }
+
+    /// 删除 index 处的值 (xa_erase)
+    ///
+    /// # 返回
+    /// 被删除的值
+    pub fn erase(&mut self, index: usize) -> Option<usize> {
+        let root = self.root.as_mut()?;
+        if !root.covers(index) {
+            return None;
+        }
+        let old = root.erase(index);
+        if old.is_some() {
+            self.len -= 1;
+            self.shrink();
+        }
+        old
+    }
+
+    /// 根节点只剩首槽位时去掉一层，树为空时释放根节点 (xas_shrink)
+    fn shrink(&mut self) {
+        while let Some(root) = self.root.as_mut() {
+            if root.count == 0 {
+                self.root = None;
+                return;
+            }
+            if root.shift == 0 || root.count != 1 {
+                return;
+            }
+            match core::mem::replace(&mut root.slots[0], XaSlot::Empty) {
+                XaSlot::Node(child) => self.root = Some(child),
+                other => {
+                    root.slots[0] = other;
+                    return;
+                }
+            }
+        }
+    }
+
+    /// 按索引顺序访问 [start, end) 中的值 (xa_for_each_range)
+    pub fn for_each_range(&self, start: usize, end: usize, mut f: impl FnMut(usize, usize)) {
+        if let Some(root) = self.root.as_deref() {
+            root.for_each(0, start, end, &mut f);
+        }
+    }
+}
+
+impl Default for XArray {
+    fn default() -> Self {
+        Self::new()
+    }
+}
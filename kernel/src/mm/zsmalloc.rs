@@ -0,0 +1,178 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 压缩对象的内存池 (zsmalloc)
+//!
+//! 参考 Linux: mm/zsmalloc.c
+//!
+//! - 对象长度按 ZS_SIZE_CLASS_DELTA 向上取整后分到大小类 (size_class)，
+//!   同一大小类的对象紧密排列在一个物理页 (zspage) 中，不跨页
+//! - 句柄 (handle) 编码页号与页内序号，按句柄直接得到对象地址，不需要查表
+//! - 页描述符记录所属大小类（index）和对象占用位图（private），每页最多 64 个对象
+//! - 池页不进入直接回收 (alloc_page_nowait)，页中的对象全部释放后整页归还
+//! - 池本身不加锁，由调用者 (zswap) 互斥
+
+use alloc::vec::Vec;
+
+use super::page::{PhysFrame, PAGE_SIZE};
+use super::page_desc::{pfn_to_page, PageFlag};
+use super::pcp::{alloc_page_nowait, free_kernel_page, MigrateType};
+
+/// 大小类的粒度 (ZS_SIZE_CLASS_DELTA)
+pub const ZS_SIZE_CLASS_DELTA: usize = 64;
+/// 最大对象长度 (ZS_MAX_ALLOC_SIZE)
+pub const ZS_MAX_ALLOC_SIZE: usize = PAGE_SIZE;
+/// 大小类个数
+const ZS_NR_CLASSES: usize = ZS_MAX_ALLOC_SIZE / ZS_SIZE_CLASS_DELTA;
+/// 句柄中页内序号的位数：页内最多 PAGE_SIZE / ZS_SIZE_CLASS_DELTA 个对象
+const OBJ_INDEX_BITS: usize = 6;
+const OBJ_INDEX_MASK: usize = (1 << OBJ_INDEX_BITS) - 1;
+
+/// 对象句柄：页号 << OBJ_INDEX_BITS | 页内序号
+pub type ZsHandle = usize;
+
+/// 一个大小类 (size_class)
+struct SizeClass {
+    /// 还有空闲对象的页 (ZS_ALMOST_EMPTY / ZS_ALMOST_FULL)
+    partial: Vec<usize>,
+}
+
+impl SizeClass {
+    const fn new() -> Self {
+        Self { partial: Vec::new() }
+    }
+}
+
+/// 内存池 (zs_pool)
+pub struct ZsPool {
+    classes: [SizeClass; ZS_NR_CLASSES],
+    /// 池占用的页数 (pages_allocated)
+    pages_allocated: usize,
+    /// 已分配的对象数
+    nr_objs: usize,
+}
+
+/// 大小类 class 的对象长度
+#[inline]
+const fn class_size(class: usize) -> usize {
+    (class + 1) * ZS_SIZE_CLASS_DELTA
+}
+
+/// 每页的对象数
+#[inline]
+const fn objs_per_zspage(class: usize) -> usize {
+    PAGE_SIZE / class_size(class)
+}
+
+/// 占用位图全满的值
+#[inline]
+const fn full_mask(class: usize) -> usize {
+    let nr = objs_per_zspage(class);
+    if nr == usize::BITS as usize { usize::MAX } else { (1 << nr) - 1 }
+}
+
+impl ZsPool {
+    pub const fn new() -> Self {
+        Self {
+            classes: [const { SizeClass::new() }; ZS_NR_CLASSES],
+            pages_allocated: 0,
+            nr_objs: 0,
+        }
+    }
+
+    /// 分配 size 字节的对象 (zs_malloc)
+    ///
+    /// # 返回
+    /// 长度超过 ZS_MAX_ALLOC_SIZE 或分配不到池页时返回 None
+    pub fn malloc(&mut self, size: usize) -> Option<ZsHandle> {
+        if size == 0 || size > ZS_MAX_ALLOC_SIZE {
+            return None;
+        }
+        let class = (size - 1) / ZS_SIZE_CLASS_DELTA;
+        let pfn = match self.classes[class].partial.last() {
+            Some(&pfn) => pfn,
+            None => self.alloc_zspage(class)?,
+        };
+
+        let page = pfn_to_page(pfn);
+        let used = unsafe { (*page).private() };
+        let obj = (!used).trailing_zeros() as usize;
+        let used = used | 1 << obj;
+        unsafe { (*page).set_private(used) };
+        if used == full_mask(class) {
+            self.classes[class].partial.pop();
+        }
+        self.nr_objs += 1;
+        Some(pfn << OBJ_INDEX_BITS | obj)
+    }
+
+    /// 为大小类分配一个空页并放入 partial 链表 (alloc_zspage)
+    fn alloc_zspage(&mut self, class: usize) -> Option<usize> {
+        // 链表在页分配之前预留空间，页面不会因为链表扩容失败而丢失
+        self.classes[class].partial.try_reserve(1).ok()?;
+        let frame = alloc_page_nowait(MigrateType::Unmovable)?;
+        let page = pfn_to_page(frame.number);
+        unsafe {
+            (*page).set_flag(PageFlag::Private);
+            (*page).set_index(class);
+            (*page).set_private(0);
+        }
+        self.classes[class].partial.push(frame.number);
+        self.pages_allocated += 1;
+        Some(frame.number)
+    }
+
+    /// 释放对象 (zs_free)
+    pub fn free(&mut self, handle: ZsHandle) {
+        let pfn = handle >> OBJ_INDEX_BITS;
+        let obj = handle & OBJ_INDEX_MASK;
+        let page = pfn_to_page(pfn);
+        let (class, used) = unsafe { ((*page).index(), (*page).private()) };
+        debug_assert!(used & 1 << obj != 0, "zs_free: object {:#x} not allocated", handle);
+        let was_full = used == full_mask(class);
+        let used = used & !(1 << obj);
+        unsafe { (*page).set_private(used) };
+        self.nr_objs -= 1;
+
+        let partial = &mut self.classes[class].partial;
+        if used == 0 {
+            // 页中没有对象了：整页归还 (free_zspage)
+            if let Some(i) = partial.iter().rposition(|&p| p == pfn) {
+                partial.swap_remove(i);
+            }
+            unsafe {
+                (*page).set_private(0);
+                (*page).set_index(0);
+                (*page).clear_flag(PageFlag::Private);
+            }
+            free_kernel_page(PhysFrame::new(pfn));
+            self.pages_allocated -= 1;
+        } else if was_full && partial.try_reserve(1).is_ok() {
+            // 预留失败时这一页暂时不再分配新对象，已有对象不受影响
+            partial.push(pfn);
+        }
+    }
+
+    /// 对象的地址 (zs_map_object)
+    ///
+    /// 物理内存恒等映射，对象不跨页，直接返回起始地址
+    #[inline]
+    pub fn map_object(&self, handle: ZsHandle) -> *mut u8 {
+        let pfn = handle >> OBJ_INDEX_BITS;
+        let obj = handle & OBJ_INDEX_MASK;
+        let class = unsafe { (*pfn_to_page(pfn)).index() };
+        (pfn * PAGE_SIZE + obj * class_size(class)) as *mut u8
+    }
+
+    /// 池占用的页数 (zs_get_total_pages)
+    pub fn total_pages(&self) -> usize {
+        self.pages_allocated
+    }
+
+    /// 已分配的对象数
+    pub fn nr_objs(&self) -> usize {
+        self.nr_objs
+    }
+}
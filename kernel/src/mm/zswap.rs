@@ -0,0 +1,290 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 压缩的内存交换 (zswap / zram)
+//!
+//! 参考 Linux: mm/zswap.c, mm/swapfile.c (swap_map, swap_duplicate, swap_free),
+//!            drivers/block/zram/zram_drv.c
+//!
+//! 没有交换设备，换出的匿名页用 LZ4 压缩后保存在内存池 (mm::zsmalloc) 中：
+//! - 每个换出的页占一个交换槽 (swap_map)，槽号编码在无效的页表项中
+//!   (arch::mm::PageTableEntry::new_swap)；访问时缺页处理解压到新页 (do_swap_page)
+//! - 槽有引用计数：fork 复制共享页表时每份页表项各持一个 (swap_duplicate)，
+//!   解除映射或换入时释放 (swap_free)，最后一个引用释放时归还池中的对象
+//! - 每个字都相同的页（多为全零页）只记下这个值，不占池空间 (same_filled)
+//! - 压缩后超过 ZSWAP_MAX_COMPRESSED 的页拒绝换出 (reject_compress_poor)，
+//!   池页数达到物理页的 ZSWAP_MAX_POOL_PERCENT 时拒绝换出 (reject_pool_limit)
+//! - 换出由页回收驱动 (mm::vmscan)，一把锁保护槽表、池和压缩缓冲区；
+//!   锁内只分配不回收的页 (alloc_page_nowait)，锁顺序为页表锁 → ZSWAP
+
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicUsize, Ordering};
+use spin::Mutex;
+
+use super::page::PAGE_SIZE;
+use super::zsmalloc::{ZsHandle, ZsPool};
+use crate::lz4::{lz4_compress, lz4_compress_bound, lz4_decompress, LZ4_HASH_SIZE};
+
+/// 池最多占用的物理页百分比 (zswap.max_pool_percent)
+pub const ZSWAP_MAX_POOL_PERCENT: usize = 25;
+
+/// 允许换出的最大压缩长度
+///
+/// zspage 只有一页，超过半页的对象每页只能放一个，压缩不再节省内存
+pub const ZSWAP_MAX_COMPRESSED: usize = PAGE_SIZE / 2;
+
+/// 一个交换槽 (swap_map 项与 zswap_entry)
+#[derive(Clone, Copy)]
+struct ZswapEntry {
+    /// 引用计数，0 表示空闲槽
+    count: u32,
+    /// 压缩后的长度；0 表示 same_filled，value 是页中每个字的值
+    length: u32,
+    /// 池对象句柄或填充值
+    value: usize,
+}
+
+struct Zswap {
+    /// 交换槽，下标即槽号
+    entries: Vec<ZswapEntry>,
+    /// 空闲的槽号
+    free_slots: Vec<u32>,
+    /// 使用中的槽数
+    nr_used: usize,
+    pool: ZsPool,
+    /// 压缩输出缓冲区 (acomp_ctx->buffer)
+    buffer: [u8; lz4_compress_bound(PAGE_SIZE)],
+    /// LZ4 哈希表工作区
+    wrkmem: [u16; LZ4_HASH_SIZE],
+    /// 池中对象的压缩长度之和
+    compressed_bytes: usize,
+    /// same_filled 的槽数
+    same_filled: usize,
+}
+
+static ZSWAP: Mutex<Zswap> = Mutex::new(Zswap {
+    entries: Vec::new(),
+    free_slots: Vec::new(),
+    nr_used: 0,
+    pool: ZsPool::new(),
+    buffer: [0; lz4_compress_bound(PAGE_SIZE)],
+    wrkmem: [0; LZ4_HASH_SIZE],
+    compressed_bytes: 0,
+    same_filled: 0,
+});
+
+/// 统计：换出的页数 (pswpout)
+static NR_SWPOUT: AtomicUsize = AtomicUsize::new(0);
+/// 统计：换入的页数 (pswpin)
+static NR_SWPIN: AtomicUsize = AtomicUsize::new(0);
+/// 统计：压缩率太低而拒绝的页数 (reject_compress_poor)
+static NR_REJECT_COMPRESS_POOR: AtomicUsize = AtomicUsize::new(0);
+/// 统计：池达到上限或分配不到池页、槽而拒绝的页数 (reject_pool_limit / reject_alloc_fail)
+static NR_REJECT_POOL_LIMIT: AtomicUsize = AtomicUsize::new(0);
+
+/// 交换槽总数：最多与物理页数相同 (SwapTotal)
+fn max_slots() -> usize {
+    super::page_desc::total_pages()
+}
+
+/// 池页数上限
+fn max_pool_pages() -> usize {
+    super::page_desc::total_pages() * ZSWAP_MAX_POOL_PERCENT / 100
+}
+
+/// 页中每个字都相同时返回这个值 (zswap_is_page_same_filled)
+fn page_same_filled(words: &[usize]) -> Option<usize> {
+    let first = words[0];
+    words.iter().all(|&word| word == first).then_some(first)
+}
+
+#[inline]
+unsafe fn page_words<'a>(pfn: usize) -> &'a mut [usize] {
+    core::slice::from_raw_parts_mut((pfn * PAGE_SIZE) as *mut usize, PAGE_SIZE / core::mem::size_of::<usize>())
+}
+
+impl Zswap {
+    /// 分配一个交换槽 (get_swap_page)
+    fn alloc_slot(&mut self, entry: ZswapEntry) -> Option<usize> {
+        let offset = match self.free_slots.pop() {
+            Some(offset) => offset as usize,
+            None => {
+                if self.entries.len() >= max_slots() || self.entries.try_reserve(1).is_err() {
+                    return None;
+                }
+                self.entries.push(ZswapEntry { count: 0, length: 0, value: 0 });
+                self.entries.len() - 1
+            }
+        };
+        self.entries[offset] = entry;
+        self.nr_used += 1;
+        Some(offset)
+    }
+
+    /// 槽的最后一个引用释放：归还池对象与槽号 (zswap_invalidate)
+    fn release_slot(&mut self, offset: usize) {
+        let entry = self.entries[offset];
+        if entry.length == 0 {
+            self.same_filled -= 1;
+        } else {
+            self.pool.free(entry.value as ZsHandle);
+            self.compressed_bytes -= entry.length as usize;
+        }
+        self.entries[offset].value = 0;
+        self.nr_used -= 1;
+        // 空闲槽号表的空间在分配槽时就能预留；预留失败只是不再复用这个槽号
+        if self.free_slots.try_reserve(1).is_ok() {
+            self.free_slots.push(offset as u32);
+        }
+    }
+
+    fn entry_mut(&mut self, offset: usize) -> &mut ZswapEntry {
+        let entry = &mut self.entries[offset];
+        debug_assert!(entry.count > 0, "swap entry {} not in use", offset);
+        entry
+    }
+}
+
+/// 换出一页 (zswap_store)
+///
+/// 压缩 pfn 的内容保存到池中并分配交换槽，引用计数为 1。
+/// 调用者保证页内容在此期间不变（页表项已写保护并刷新了 TLB），成功后负责释放页
+///
+/// # 返回
+/// 交换槽号；页压缩率太低、池已满或分配失败时返回 None
+pub fn zswap_store(pfn: usize) -> Option<usize> {
+    let words = unsafe { page_words(pfn) };
+    let mut zswap = ZSWAP.lock();
+
+    if let Some(value) = page_same_filled(words) {
+        let offset = zswap.alloc_slot(ZswapEntry { count: 1, length: 0, value });
+        if offset.is_none() {
+            NR_REJECT_POOL_LIMIT.fetch_add(1, Ordering::Relaxed);
+            return None;
+        }
+        zswap.same_filled += 1;
+        NR_SWPOUT.fetch_add(1, Ordering::Relaxed);
+        return offset;
+    }
+
+    let src = unsafe { core::slice::from_raw_parts((pfn * PAGE_SIZE) as *const u8, PAGE_SIZE) };
+    let zswap = &mut *zswap;
+    let length = match lz4_compress(src, &mut zswap.buffer, &mut zswap.wrkmem) {
+        Some(length) if length <= ZSWAP_MAX_COMPRESSED => length,
+        _ => {
+            NR_REJECT_COMPRESS_POOR.fetch_add(1, Ordering::Relaxed);
+            return None;
+        }
+    };
+
+    if zswap.pool.total_pages() >= max_pool_pages() {
+        NR_REJECT_POOL_LIMIT.fetch_add(1, Ordering::Relaxed);
+        return None;
+    }
+    let handle = match zswap.pool.malloc(length) {
+        Some(handle) => handle,
+        None => {
+            NR_REJECT_POOL_LIMIT.fetch_add(1, Ordering::Relaxed);
+            return None;
+        }
+    };
+    let offset = match zswap.alloc_slot(ZswapEntry { count: 1, length: length as u32, value: handle }) {
+        Some(offset) => offset,
+        None => {
+            zswap.pool.free(handle);
+            NR_REJECT_POOL_LIMIT.fetch_add(1, Ordering::Relaxed);
+            return None;
+        }
+    };
+    unsafe {
+        core::ptr::copy_nonoverlapping(zswap.buffer.as_ptr(), zswap.pool.map_object(handle), length);
+    }
+    zswap.compressed_bytes += length;
+    NR_SWPOUT.fetch_add(1, Ordering::Relaxed);
+    Some(offset)
+}
+
+/// 把交换槽的内容解压到 pfn (zswap_load)
+///
+/// 不改变引用计数
+///
+/// # 返回
+/// 压缩数据损坏时返回 false
+pub fn zswap_load(offset: usize, pfn: usize) -> bool {
+    let mut zswap = ZSWAP.lock();
+    let entry = *zswap.entry_mut(offset);
+    let words = unsafe { page_words(pfn) };
+    if entry.length == 0 {
+        words.fill(entry.value);
+    } else {
+        let src = unsafe {
+            core::slice::from_raw_parts(zswap.pool.map_object(entry.value as ZsHandle), entry.length as usize)
+        };
+        let dst = unsafe { core::slice::from_raw_parts_mut((pfn * PAGE_SIZE) as *mut u8, PAGE_SIZE) };
+        if lz4_decompress(src, dst) != Some(PAGE_SIZE) {
+            return false;
+        }
+    }
+    drop(zswap);
+    NR_SWPIN.fetch_add(1, Ordering::Relaxed);
+    true
+}
+
+/// 交换槽增加一个引用 (swap_duplicate)
+///
+/// 共享页表复制时，副本中的交换页表项各持一个引用
+pub fn swap_duplicate(offset: usize) {
+    ZSWAP.lock().entry_mut(offset).count += 1;
+}
+
+/// 交换槽释放一个引用，最后一个引用释放时归还槽 (swap_free)
+pub fn swap_free(offset: usize) {
+    let mut zswap = ZSWAP.lock();
+    let entry = zswap.entry_mut(offset);
+    entry.count -= 1;
+    if entry.count == 0 {
+        zswap.release_slot(offset);
+    }
+}
+
+/// 交换槽的引用计数 (swp_swapcount)，空闲槽返回 0
+pub fn swap_count(offset: usize) -> usize {
+    ZSWAP.lock().entries.get(offset).map_or(0, |entry| entry.count as usize)
+}
+
+/// zswap 统计 (/sys/kernel/debug/zswap)
+#[derive(Debug, Clone, Copy, Default)]
+pub struct ZswapStats {
+    /// 换出的页数 (stored_pages)
+    pub stored_pages: usize,
+    /// 其中 same_filled 的页数 (same_filled_pages)
+    pub same_filled_pages: usize,
+    /// 池占用的页数 (pool_total_size / PAGE_SIZE)
+    pub pool_pages: usize,
+    /// 池中对象的压缩长度之和
+    pub compressed_bytes: usize,
+    /// 交换槽总数 (SwapTotal)
+    pub total_slots: usize,
+    pub pswpin: usize,
+    pub pswpout: usize,
+    pub reject_compress_poor: usize,
+    pub reject_pool_limit: usize,
+}
+
+/// 获取 zswap 统计
+pub fn zswap_stats() -> ZswapStats {
+    let zswap = ZSWAP.lock();
+    ZswapStats {
+        stored_pages: zswap.nr_used,
+        same_filled_pages: zswap.same_filled,
+        pool_pages: zswap.pool.total_pages(),
+        compressed_bytes: zswap.compressed_bytes,
+        total_slots: max_slots(),
+        pswpin: NR_SWPIN.load(Ordering::Relaxed),
+        pswpout: NR_SWPOUT.load(Ordering::Relaxed),
+        reject_compress_poor: NR_REJECT_COMPRESS_POOR.load(Ordering::Relaxed),
+        reject_pool_limit: NR_REJECT_POOL_LIMIT.load(Ordering::Relaxed),
+    }
+}
@@ -5,10 +5,29 @@
 //! ARP 协议
 //!
 //! 完全...
-
-use crate::net::buffer::SkBuff;
-use crate::net::ethernet::{ETH_ALEN, eth_is_broadcast_addr};
+//!
+//! # 邻居缓存
+//! - 按地址哈希到桶，每桶 ARP_BUCKET_WAYS 个条目，桶满时替换最久未确认的条目
+//! - 条目由顺序锁保护，发送路径上的查找不加锁、不写共享内存
+//! - 地址未解析时包在邻居的队列中等待（最多 ARP_UNRES_QLEN 个），收到响应后一并发出
+//! - 状态按 jiffies 老化：Incomplete -> Reachable -> Stale -> 删除
+//!
+//! 参考: net/ipv4/arp.c, net/core/neighbour.c
+
+use alloc::collections::VecDeque;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU64, Ordering};
+use spin::Mutex;
+
+use crate::net::buffer::{alloc_skb, SkBuff};
+use crate::net::ethernet::{
+    ETH_ALEN, ETH_BROADCAST, ETH_HLEN, EthProtocol, eth_dev_addr, eth_dev_needs_arp, eth_is_broadcast_addr, ethernet_xmit,
+};
+use crate::net::inet_hashtables::jhash_3words;
+use crate::net::ipv4::INADDR_LOCAL;
 use crate::config::ARP_CACHE_SIZE;
+use crate::drivers::timer::{get_jiffies, HZ};
+use crate::sync::SeqLock;
 
 /// ARP 硬件类型
 ///
@@ -72,8 +91,8 @@ pub struct ArpHdr {
 
 /// ARP 报文 (以太网 + IPv4)
 ///
-/// 完整的 ARP 报文，包括头部和数据
-#[repr(C)]
+/// 完整的 ARP 报文，包括头部和数据；紧凑布局，与线上格式一致（28 字节）
+#[repr(C, packed)]
 #[derive(Debug, Clone, Copy)]
 pub struct ArpPacket {
     /// ARP 头部
@@ -134,34 +153,63 @@ impl ArpPacket {
     }
 }
 
+/// 邻居状态 (NUD_*)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum ArpState {
+    /// 空闲的槽位 (NUD_NONE)
+    None,
+    /// 已发送请求，等待响应 (NUD_INCOMPLETE)
+    Incomplete,
+    /// 最近得到确认 (NUD_REACHABLE)
+    Reachable,
+    /// 超过 ARP_REACHABLE_TIME 未确认，仍可使用 (NUD_STALE)
+    Stale,
+}
+
 /// ARP 缓存条目
 ///
 /// 缓存 IP 地址到 MAC 地址的映射
 #[repr(C)]
 #[derive(Debug, Clone, Copy)]
 pub struct ArpEntry {
-    /// IP 地址
+    /// IP 地址（主机字节序）
     pub ip: u32,
     /// MAC 地址
     pub mac: [u8; ETH_ALEN],
-    /// 最后更新时间
+    /// 最后确认时间（jiffies）；Incomplete 状态下为最后一次发送请求的时间
     pub last_updated: u64,
-    /// 是否有效
-    pub valid: bool,
+    /// 邻居状态
+    pub state: ArpState,
+    /// 已发送的请求数
+    pub probes: u8,
 }
 
 impl ArpEntry {
+    /// 空槽位
+    const EMPTY: ArpEntry = ArpEntry {
+        ip: 0,
+        mac: [0; ETH_ALEN],
+        last_updated: 0,
+        state: ArpState::None,
+        probes: 0,
+    };
+
     /// 创建新的 ARP 缓存条目
     pub fn new(ip: u32, mac: [u8; ETH_ALEN]) -> Self {
-        // TODO: 获取当前时间戳
         Self {
             ip,
             mac,
-            last_updated: 0,
-            valid: true,
+            last_updated: get_jiffies(),
+            state: ArpState::Reachable,
+            probes: 0,
         }
     }
 
+    /// MAC 地址是否可用于发送 (NUD_VALID)
+    pub fn is_valid(&self) -> bool {
+        matches!(self.state, ArpState::Reachable | ArpState::Stale)
+    }
+
     /// 检查条目是否过期
     ///
     /// # 参数
@@ -170,132 +218,394 @@ impl ArpEntry {
     /// # 返回
     /// 是否过期
     pub fn is_expired(&self, timeout: u64) -> bool {
-        // TODO: 实现时间比较
-        false
+        get_jiffies().saturating_sub(self.last_updated) >= timeout * HZ
     }
 }
 
-/// ARP 缓存
+/// 每个桶的条目数
+const ARP_BUCKET_WAYS: usize = 4;
+
+/// 桶数
+const ARP_NR_BUCKETS: usize = ARP_CACHE_SIZE / ARP_BUCKET_WAYS;
+
+/// 确认后保持 Reachable 的时间（jiffies） (REACHABLE_TIME)
+pub const ARP_REACHABLE_TIME: u64 = 30 * HZ;
+
+/// Stale 条目继续保留的时间（jiffies） (GC_STALETIME)
+pub const ARP_GC_STALETIME: u64 = 60 * HZ;
+
+/// 请求的重发间隔（jiffies） (RETRANS_TIME)
+pub const ARP_RETRANS_TIME: u64 = HZ;
+
+/// 放弃解析前发送的请求数 (MCAST_PROBES)
+pub const ARP_MAX_PROBES: u8 = 3;
+
+/// 每个邻居等待解析的包数上限，超出时丢弃最早的包 (UNRES_QLEN)
+pub const ARP_UNRES_QLEN: usize = 3;
+
+/// 等待解析的包 (neighbour.arp_queue)
+struct ArpQueue {
+    ip: u32,
+    skbs: VecDeque<SkBuff>,
+}
+
+/// 哈希桶：条目在顺序锁下，发送路径的查找不写共享内存
 ///
-/// 简化实现：固定大小的哈希表
-struct ArpCache {
-    entries: [ArpEntry; ARP_CACHE_SIZE],
-    count: usize,
+/// 所有修改先取 pending 锁（关中断），条目与等待队列在同一把锁下保持一致
+struct ArpBucket {
+    entries: SeqLock<[ArpEntry; ARP_BUCKET_WAYS]>,
+    pending: Mutex<Vec<ArpQueue>>,
 }
 
-impl ArpCache {
+impl ArpBucket {
     const fn new() -> Self {
-        const EMPTY_ENTRY: ArpEntry = ArpEntry {
-            ip: 0,
-            mac: [0; ETH_ALEN],
-            last_updated: 0,
-            valid: false,
-        };
-
         Self {
-            entries: [EMPTY_ENTRY; ARP_CACHE_SIZE],
-            count: 0,
+            entries: SeqLock::new([ArpEntry::EMPTY; ARP_BUCKET_WAYS]),
+            pending: Mutex::new(Vec::new()),
         }
     }
 
-    /// 查找 ARP 缓存条目
-    fn lookup(&self, ip: u32) -> Option<ArpEntry> {
-        for entry in self.entries.iter() {
-            if entry.valid && entry.ip == ip {
-                return Some(*entry);
-            }
+    /// 取出并删除某个邻居的等待队列
+    fn take_pending(pending: &mut Vec<ArpQueue>, ip: u32) -> VecDeque<SkBuff> {
+        match pending.iter().position(|q| q.ip == ip) {
+            Some(pos) => pending.swap_remove(pos).skbs,
+            None => VecDeque::new(),
         }
-        None
     }
+}
 
-    /// 添加或更新 ARP 缓存条目
-    fn update(&mut self, ip: u32, mac: [u8; ETH_ALEN]) {
-        // 首先尝试更新现有条目
-        for entry in self.entries.iter_mut() {
-            if entry.valid && entry.ip == ip {
-                entry.mac = mac;
-                entry.last_updated = 0; // TODO: 获取当前时间
-                return;
-            }
-        }
+/// 全局 ARP 缓存 (arp_tbl)
+static ARP_TABLE: [ArpBucket; ARP_NR_BUCKETS] = [const { ArpBucket::new() }; ARP_NR_BUCKETS];
 
-        // 如果未找到，添加新条目
-        if self.count < ARP_CACHE_SIZE {
-            self.entries[self.count] = ArpEntry::new(ip, mac);
-            self.count += 1;
-        } else {
-            // 缓存已满，替换最旧的条目
-            // 简化实现：替换第一个条目
-            self.entries[0] = ArpEntry::new(ip, mac);
-        }
-    }
+/// 上次老化扫描的时间
+static ARP_LAST_SCAN: AtomicU64 = AtomicU64::new(0);
 
-    /// 删除 ARP 缓存条目
-    fn remove(&mut self, ip: u32) {
-        for entry in self.entries.iter_mut() {
-            if entry.valid && entry.ip == ip {
-                entry.valid = false;
-                self.count -= 1;
-                return;
-            }
+/// 地址所在的桶 (arp_hashfn)
+#[inline]
+fn arp_bucket(ip: u32) -> &'static ArpBucket {
+    &ARP_TABLE[jhash_3words(ip, 0, 0, 0) as usize % ARP_NR_BUCKETS]
+}
+
+/// 为新地址选择槽位：空槽位优先，否则替换最久未确认的条目
+fn arp_victim(entries: &[ArpEntry; ARP_BUCKET_WAYS]) -> usize {
+    if let Some(i) = entries.iter().position(|e| e.state == ArpState::None) {
+        return i;
+    }
+    let mut victim = 0;
+    for i in 1..ARP_BUCKET_WAYS {
+        if entries[i].last_updated < entries[victim].last_updated {
+            victim = i;
         }
     }
+    victim
+}
 
-    /// 清空 ARP 缓存
-    fn clear(&mut self) {
-        self.count = 0;
-        for entry in self.entries.iter_mut() {
-            entry.valid = false;
-        }
+/// 释放队列中的包
+fn arp_free_queue(skbs: VecDeque<SkBuff>) {
+    for skb in skbs {
+        skb.free();
     }
 }
 
-/// 全局 ARP 缓存
-static mut ARP_CACHE: ArpCache = ArpCache::new();
+/// 发送已解析的包
+fn arp_flush_queue(skbs: VecDeque<SkBuff>, mac: [u8; ETH_ALEN]) {
+    for skb in skbs {
+        let _ = ethernet_xmit(skb, mac, EthProtocol::ETH_P_IP);
+    }
+}
 
-/// 查找 ARP 缓存
+/// 查找 ARP 缓存，不加锁 (neigh_lookup)
 ///
 /// # 参数
-/// - `ip`: IP 地址 (网络字节序)
+/// - `ip`: IP 地址（主机字节序）
 ///
 /// # 返回
-/// 返回找到的 MAC 地址，如果未找到则返回 None
+/// 返回找到的 MAC 地址，如果未找到或尚未解析则返回 None
 pub fn arp_lookup(ip: u32) -> Option<[u8; ETH_ALEN]> {
-    unsafe {
-        if let Some(entry) = ARP_CACHE.lookup(ip) {
-            Some(entry.mac)
-        } else {
-            None
-        }
-    }
+    arp_bucket(ip)
+        .entries
+        .read()
+        .iter()
+        .find(|e| e.ip == ip && e.is_valid())
+        .map(|e| e.mac)
+}
+
+/// 记录邻居的 MAC 地址并发送等待解析的包 (neigh_update)
+///
+/// # 参数
+/// - `create`: 条目不存在时是否创建
+///
+/// # 返回
+/// 条目存在或被创建时返回 true
+fn arp_neigh_update(ip: u32, mac: [u8; ETH_ALEN], create: bool) -> bool {
+    let bucket = arp_bucket(ip);
+    let now = get_jiffies();
+    let (updated, dropped, queued) = {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        let mut pending = bucket.pending.lock();
+        let (updated, evicted) = bucket.entries.write(|entries| {
+            let slot = match entries.iter().position(|e| e.state != ArpState::None && e.ip == ip) {
+                Some(i) => i,
+                None if create => arp_victim(entries),
+                None => return (false, None),
+            };
+            let old = entries[slot];
+            entries[slot] = ArpEntry { ip, mac, last_updated: now, state: ArpState::Reachable, probes: 0 };
+            let evicted = if old.state != ArpState::None && old.ip != ip { Some(old.ip) } else { None };
+            (true, evicted)
+        });
+        let dropped = match evicted {
+            Some(old_ip) => ArpBucket::take_pending(&mut pending, old_ip),
+            None => VecDeque::new(),
+        };
+        let queued = if updated { ArpBucket::take_pending(&mut pending, ip) } else { VecDeque::new() };
+        (updated, dropped, queued)
+    };
+    // 在锁外发送：回环设备上的发送可能直接回到 arp_rcv
+    arp_free_queue(dropped);
+    arp_flush_queue(queued, mac);
+    updated
 }
 
-/// 更新 ARP 缓存
+/// 更新 ARP 缓存，条目不存在时创建
 ///
 /// # 参数
-/// - `ip`: IP 地址 (网络字节序)
+/// - `ip`: IP 地址（主机字节序）
 /// - `mac`: MAC 地址
 pub fn arp_update(ip: u32, mac: [u8; ETH_ALEN]) {
-    unsafe {
-        ARP_CACHE.update(ip, mac);
-    }
+    arp_neigh_update(ip, mac, true);
 }
 
-/// 删除 ARP 缓存条目
+/// 删除 ARP 缓存条目，丢弃等待解析的包
 ///
 /// # 参数
-/// - `ip`: IP 地址 (网络字节序)
+/// - `ip`: IP 地址（主机字节序）
 pub fn arp_remove(ip: u32) {
-    unsafe {
-        ARP_CACHE.remove(ip);
-    }
+    let bucket = arp_bucket(ip);
+    let dropped = {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        let mut pending = bucket.pending.lock();
+        bucket.entries.write(|entries| {
+            for e in entries.iter_mut().filter(|e| e.state != ArpState::None && e.ip == ip) {
+                *e = ArpEntry::EMPTY;
+            }
+        });
+        ArpBucket::take_pending(&mut pending, ip)
+    };
+    arp_free_queue(dropped);
 }
 
 /// 清空 ARP 缓存
 pub fn arp_clear() {
-    unsafe {
-        ARP_CACHE.clear();
+    for bucket in ARP_TABLE.iter() {
+        let dropped: Vec<ArpQueue> = {
+            let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+            let mut pending = bucket.pending.lock();
+            bucket.entries.write(|entries| *entries = [ArpEntry::EMPTY; ARP_BUCKET_WAYS]);
+            core::mem::take(&mut *pending)
+        };
+        for q in dropped {
+            arp_free_queue(q.skbs);
+        }
+    }
+}
+
+/// 缓存中的条目数（含未解析的）
+pub fn arp_cache_len() -> usize {
+    ARP_TABLE
+        .iter()
+        .map(|b| b.entries.read().iter().filter(|e| e.state != ArpState::None).count())
+        .sum()
+}
+
+/// 查询邻居的状态
+pub fn arp_state(ip: u32) -> ArpState {
+    arp_bucket(ip)
+        .entries
+        .read()
+        .iter()
+        .find(|e| e.state != ArpState::None && e.ip == ip)
+        .map_or(ArpState::None, |e| e.state)
+}
+
+/// 等待解析的包数
+pub fn arp_pending_len(ip: u32) -> usize {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let pending = arp_bucket(ip).pending.lock();
+    pending.iter().find(|q| q.ip == ip).map_or(0, |q| q.skbs.len())
+}
+
+/// 发送 IP 包，下一跳地址未解析时先缓存并发出 ARP 请求 (neigh_resolve_output)
+///
+/// # 参数
+/// - `skb`: SkBuff (包含 IP 数据包)
+/// - `next_hop`: 下一跳地址（主机字节序）
+pub fn arp_resolve_output(skb: SkBuff, next_hop: u32) -> Result<(), ()> {
+    if let Some(mac) = arp_lookup(next_hop) {
+        return ethernet_xmit(skb, mac, EthProtocol::ETH_P_IP);
+    }
+
+    let bucket = arp_bucket(next_hop);
+    let now = get_jiffies();
+    let mut skb = Some(skb);
+    let (resolved, send_request, dropped) = {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        let mut pending = bucket.pending.lock();
+        // 取锁期间可能已被解析
+        let entries = bucket.entries.read();
+        match entries.iter().find(|e| e.state != ArpState::None && e.ip == next_hop) {
+            Some(e) if e.is_valid() => (Some(e.mac), false, None),
+            found => {
+                let send_request = found.is_none();
+                let mut evicted = None;
+                if send_request {
+                    evicted = bucket.entries.write(|entries| {
+                        let slot = arp_victim(entries);
+                        let old = entries[slot];
+                        entries[slot] = ArpEntry {
+                            ip: next_hop,
+                            mac: [0; ETH_ALEN],
+                            last_updated: now,
+                            state: ArpState::Incomplete,
+                            probes: 1,
+                        };
+                        if old.state != ArpState::None { Some(old.ip) } else { None }
+                    });
+                }
+                let mut dropped = match evicted {
+                    Some(old_ip) => ArpBucket::take_pending(&mut pending, old_ip),
+                    None => VecDeque::new(),
+                };
+                let queue = match pending.iter().position(|q| q.ip == next_hop) {
+                    Some(pos) => &mut pending[pos].skbs,
+                    None => {
+                        pending.push(ArpQueue { ip: next_hop, skbs: VecDeque::new() });
+                        &mut pending.last_mut().unwrap().skbs
+                    }
+                };
+                if queue.len() >= ARP_UNRES_QLEN {
+                    if let Some(old) = queue.pop_front() {
+                        dropped.push_back(old);
+                    }
+                }
+                queue.push_back(skb.take().unwrap());
+                (None, send_request, Some(dropped))
+            }
+        }
+    };
+
+    if let Some(dropped) = dropped {
+        arp_free_queue(dropped);
+    }
+    if send_request {
+        let _ = arp_send_request(next_hop);
+    }
+    match (resolved, skb) {
+        (Some(mac), Some(skb)) => ethernet_xmit(skb, mac, EthProtocol::ETH_P_IP),
+        _ => Ok(()),
+    }
+}
+
+/// IP 多播地址对应的以太网地址 (ip_eth_mc_map)
+fn ip_eth_mc_map(ip: u32) -> [u8; ETH_ALEN] {
+    [0x01, 0x00, 0x5e, ((ip >> 16) & 0x7f) as u8, (ip >> 8) as u8, ip as u8]
+}
+
+/// 按下一跳发送 IP 包 (ip_finish_output2)
+///
+/// 广播与多播地址直接映射；设备不需要 ARP（回环）时使用广播地址
+pub fn arp_output(skb: SkBuff, next_hop: u32) -> Result<(), ()> {
+    if !eth_dev_needs_arp() || next_hop == 0xFFFFFFFF {
+        return ethernet_xmit(skb, ETH_BROADCAST, EthProtocol::ETH_P_IP);
+    }
+    if next_hop >> 28 == 0xE {
+        return ethernet_xmit(skb, ip_eth_mc_map(next_hop), EthProtocol::ETH_P_IP);
     }
+    arp_resolve_output(skb, next_hop)
+}
+
+/// 广播 ARP 请求 (arp_solicit)
+///
+/// # 参数
+/// - `target_ip`: 要解析的地址（主机字节序）
+pub fn arp_send_request(target_ip: u32) -> Result<(), ()> {
+    let mut skb = alloc_skb((ETH_HLEN + ArpPacket::LEN) as u32).ok_or(())?;
+    skb.skb_reserve(ETH_HLEN as u32).ok_or(())?;
+    if arp_build_request(&mut skb, eth_dev_addr(), INADDR_LOCAL.to_be(), target_ip.to_be()).is_err() {
+        skb.free();
+        return Err(());
+    }
+    ethernet_xmit(skb, ETH_BROADCAST, EthProtocol::ETH_P_ARP)
+}
+
+/// 老化扫描 (neigh_timer_handler + neigh_periodic_work)
+///
+/// - Incomplete：每 ARP_RETRANS_TIME 重发请求，发满 ARP_MAX_PROBES 次后放弃并丢弃等待的包
+/// - Reachable：超过 ARP_REACHABLE_TIME 未确认变为 Stale
+/// - Stale：再过 ARP_GC_STALETIME 仍未确认则删除
+///
+/// 只在桶中有条目需要变化时才取锁
+pub fn arp_periodic(now: u64) {
+    let mut requests: Vec<u32> = Vec::new();
+    for bucket in ARP_TABLE.iter() {
+        let needs_work = bucket.entries.read().iter().any(|e| arp_entry_due(e, now));
+        if !needs_work {
+            continue;
+        }
+        let dropped: Vec<VecDeque<SkBuff>> = {
+            let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+            let mut pending = bucket.pending.lock();
+            let mut failed: Vec<u32> = Vec::new();
+            bucket.entries.write(|entries| {
+                for e in entries.iter_mut().filter(|e| arp_entry_due(e, now)) {
+                    match e.state {
+                        ArpState::Incomplete if e.probes >= ARP_MAX_PROBES => {
+                            failed.push(e.ip);
+                            *e = ArpEntry::EMPTY;
+                        }
+                        ArpState::Incomplete => {
+                            e.probes += 1;
+                            e.last_updated = now;
+                            requests.push(e.ip);
+                        }
+                        ArpState::Reachable => e.state = ArpState::Stale,
+                        _ => *e = ArpEntry::EMPTY,
+                    }
+                }
+            });
+            failed.into_iter().map(|ip| ArpBucket::take_pending(&mut pending, ip)).collect()
+        };
+        for q in dropped {
+            arp_free_queue(q);
+        }
+    }
+    for ip in requests {
+        let _ = arp_send_request(ip);
+    }
+}
+
+/// 条目在 now 时是否需要状态变化
+fn arp_entry_due(e: &ArpEntry, now: u64) -> bool {
+    let age = now.saturating_sub(e.last_updated);
+    match e.state {
+        ArpState::None => false,
+        ArpState::Incomplete => age >= ARP_RETRANS_TIME,
+        ArpState::Reachable => age >= ARP_REACHABLE_TIME,
+        ArpState::Stale => age >= ARP_REACHABLE_TIME + ARP_GC_STALETIME,
+    }
+}
+
+/// 时钟中断中调用，每 ARP_RETRANS_TIME 扫描一次（仅 CPU 0）
+pub fn arp_timer_tick() {
+    if crate::arch::cpu_id() != 0 {
+        return;
+    }
+    let now = get_jiffies();
+    if now.saturating_sub(ARP_LAST_SCAN.load(Ordering::Relaxed)) < ARP_RETRANS_TIME {
+        return;
+    }
+    ARP_LAST_SCAN.store(now, Ordering::Relaxed);
+    arp_periodic(now);
 }
 
 /// 构造 ARP 请求报文
@@ -410,18 +720,27 @@ pub fn arp_rcv(skb: &SkBuff, _eth_hdr: &crate::net::ethernet::EthHdr) -> Result<
         return Ok(()); // 忽略非 IPv4 ARP
     }
 
-    // 更新 ARP 缓存 (学习发送方的地址映射)
     let sender_ip = arp_pkt.sender_ip();
     let sender_mac = arp_pkt.sender_mac();
-    arp_update(sender_ip, sender_mac);
-
-    // 处理 ARP 请求
-    if arp_pkt.is_request() {
-        let target_ip = arp_pkt.target_ip();
+    let target_ip = arp_pkt.target_ip();
+    // 地址探测 (sender 为 0.0.0.0) 不学习
+    if sender_ip == 0 {
+        return Ok(());
+    }
 
-        // TODO: 检查目标 IP 是否为本机 IP
-        // 如果是，则发送 ARP 响应
-        let _ = target_ip; // 暂时忽略警告
+    // 学习发送方的地址映射：已有的条目总是更新，请求本机时才新建 (arp_process)
+    let for_us = target_ip == INADDR_LOCAL;
+    arp_neigh_update(sender_ip, sender_mac, for_us);
+
+    // 回复请求本机地址的 ARP 请求
+    if arp_pkt.is_request() && for_us {
+        let mut reply = alloc_skb((ETH_HLEN + ArpPacket::LEN) as u32).ok_or(())?;
+        reply.skb_reserve(ETH_HLEN as u32).ok_or(())?;
+        if arp_build_reply(&mut reply, eth_dev_addr(), INADDR_LOCAL.to_be(), sender_mac, arp_pkt.ar_sip).is_err() {
+            reply.free();
+            return Err(());
+        }
+        return ethernet_xmit(reply, sender_mac, EthProtocol::ETH_P_ARP);
     }
 
     Ok(())
@@ -441,11 +760,11 @@ mod tests {
         let ip = 0xC0A80101; // 192.168.1.1
         let mac = [0x52, 0x54, 0x00, 0x12, 0x34, 0x56];
 
-        unsafe {
-            ARP_CACHE.update(ip, mac);
-        }
+        arp_update(ip, mac);
 
         let result = arp_lookup(ip);
         assert_eq!(result, Some(mac));
+        arp_remove(ip);
+        assert_eq!(arp_lookup(ip), None);
     }
 }
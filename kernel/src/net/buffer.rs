@@ -8,6 +8,9 @@
 
 use core::sync::atomic::AtomicU64;
 
+use crate::mm::memcontrol::{mem_cgroup_alloc_page, MemcgStat};
+use crate::net::skb_pool::{self, SKB_DATA_SIZE};
+
 /// 数据包类型
 ///
 /// ...
@@ -129,10 +132,61 @@ pub struct SkBuff {
     pub network_header: *mut u8,
     /// 传输层头指针
     pub transport_header: *mut u8,
+    /// 页片段中的字节数，len 包含这部分 (data_len)
+    pub data_len: u32,
+    /// 页片段数 (skb_shared_info.nr_frags)
+    pub nr_frags: u8,
+    /// 引用页缓存页的数据片段 (skb_shared_info.frags)
+    pub frags: [SkbFrag; MAX_SKB_FRAGS],
+    /// 校验和状态 (ip_summed)，取值见 CHECKSUM_*
+    pub ip_summed: u8,
+    /// CHECKSUM_PARTIAL 时从此处（相对 head）开始计算校验和
+    pub csum_start: u16,
+    /// 校验和字段相对 csum_start 的偏移
+    pub csum_offset: u16,
+    /// 分段大小，非 0 表示这是等待分段的超长包 (skb_shared_info.gso_size)
+    pub gso_size: u16,
+    /// 分段类型 (skb_shared_info.gso_type)，取值见 SKB_GSO_*
+    pub gso_type: u8,
 }
 
+/// 校验和未计算，也未验证 (CHECKSUM_NONE)
+pub const CHECKSUM_NONE: u8 = 0;
+/// 接收时设备已验证校验和 (CHECKSUM_UNNECESSARY)
+pub const CHECKSUM_UNNECESSARY: u8 = 1;
+/// 发送时只填了伪头部，余下由设备或 skb_checksum_help 完成 (CHECKSUM_PARTIAL)
+pub const CHECKSUM_PARTIAL: u8 = 3;
+
+/// TCP over IPv4 分段 (SKB_GSO_TCPV4)
+pub const SKB_GSO_TCPV4: u8 = 1 << 0;
+/// UDP_SEGMENT 产生的 UDP 分段 (SKB_GSO_UDP_L4)
+pub const SKB_GSO_UDP_L4: u8 = 1 << 1;
+
 unsafe impl Send for SkBuff {}
 
+/// 新分配的 SkBuff 在数据前预留的 headroom (NET_SKB_PAD)
+const NET_SKB_PAD: usize = 16;
+
+/// 每个 SkBuff 最多的页片段数 (MAX_SKB_FRAGS)
+pub const MAX_SKB_FRAGS: usize = 17;
+
+/// 引用一个物理页中一段数据的片段 (skb_frag_t)
+///
+/// 片段持有页的引用，SkBuff 释放时归还；数据不复制到线性区
+#[derive(Debug, Clone, Copy)]
+pub struct SkbFrag {
+    /// 页的物理地址
+    pub page: usize,
+    /// 页内偏移
+    pub offset: u32,
+    /// 长度
+    pub size: u32,
+}
+
+impl SkbFrag {
+    const EMPTY: SkbFrag = SkbFrag { page: 0, offset: 0, size: 0 };
+}
+
 /// SkBuff 全局分配器 ID
 static SKBUFF_ALLOCATOR_ID: AtomicU64 = AtomicU64::new(0);
 
@@ -147,6 +201,7 @@ impl SkBuff {
     ///
     /// # 说明
     /// - 分配的缓冲区大小为 `size + 2 * NET_SKBUFF_DATA_ALIGN`（预留 headroom 和 tailroom）
+    /// - 不超过 SKB_DATA_SIZE 时使用每 CPU 缓存的固定大小数据区，多出的部分成为 tailroom
     /// - data 和 tail 初始时指向 headroom 之后的位置
     /// - headroom 用于添加协议头（MAC、IP、TCP 等）
     pub fn alloc(size: u32) -> Option<Self> {
@@ -154,7 +209,7 @@ impl SkBuff {
         const NET_SKBUFF_DATA_ALIGN: usize = 16;
 
         // 预留 headroom 和 tailroom，各至少 16 字节
-        let headroom = NET_SKBUFF_DATA_ALIGN;
+        let headroom = NET_SKB_PAD;
         let data_size = if size == 0 {
             NET_SKBUFF_DATA_ALIGN
         } else {
@@ -162,11 +217,14 @@ impl SkBuff {
         };
         let alloc_size = headroom + data_size + NET_SKBUFF_DATA_ALIGN;
 
-        // 分配缓冲区
-        let layout = alloc::alloc::Layout::from_size_align(alloc_size, NET_SKBUFF_DATA_ALIGN)
-            .ok()?;
-
-        let head = unsafe { alloc::alloc::alloc(layout) };
+        // 分配缓冲区：常见大小走每 CPU 缓存，更大的走堆
+        let (head, alloc_size) = if alloc_size <= SKB_DATA_SIZE {
+            (skb_pool::skb_data_alloc(), SKB_DATA_SIZE)
+        } else {
+            let layout = alloc::alloc::Layout::from_size_align(alloc_size, NET_SKBUFF_DATA_ALIGN)
+                .ok()?;
+            (unsafe { alloc::alloc::alloc(layout) }, alloc_size)
+        };
         if head.is_null() {
             return None;
         }
@@ -189,14 +247,28 @@ impl SkBuff {
             mac_header: core::ptr::null_mut(),
             network_header: core::ptr::null_mut(),
             transport_header: core::ptr::null_mut(),
+            data_len: 0,
+            nr_frags: 0,
+            frags: [SkbFrag::EMPTY; MAX_SKB_FRAGS],
+            ip_summed: CHECKSUM_NONE,
+            csum_start: 0,
+            csum_offset: 0,
+            gso_size: 0,
+            gso_type: 0,
         })
     }
 
     /// 释放 SkBuff
     ///
     /// # 说明
-    /// 释放分配的内存
-    pub fn free(self) {
+    /// 释放分配的内存，并归还页片段的引用
+    pub fn free(mut self) {
+        self.skb_release_frags();
+        // 大小正好为 SKB_DATA_SIZE 的数据区来自每 CPU 缓存
+        if self.truesize() == SKB_DATA_SIZE {
+            skb_pool::skb_data_free(self.head);
+            return;
+        }
         unsafe {
             let layout = alloc::alloc::Layout::from_size_align(
                 (self.end as usize) - (self.head as usize),
@@ -312,6 +384,163 @@ impl SkBuff {
         Ok(())
     }
 
+    /// 数据区总大小 (skb_end_offset)
+    #[inline]
+    pub fn truesize(&self) -> usize {
+        self.end as usize - self.head as usize
+    }
+
+    /// 把 SkBuff 恢复为刚分配时的状态，保留数据区以便直接重用 (skb_recycle)
+    ///
+    /// # 说明
+    /// 由接收路径在丢弃数据包后调用，数据区不必归还再分配；页片段照常归还
+    pub fn skb_recycle(&mut self) {
+        self.skb_release_frags();
+        self.data = unsafe { self.head.add(NET_SKB_PAD) };
+        self.tail = self.data;
+        self.len = 0;
+        self.protocol = 0;
+        self.pkt_type = PacketType::Host;
+        self.tstamp = 0;
+        self.mac_len = 0;
+        self.mac_header = core::ptr::null_mut();
+        self.network_header = core::ptr::null_mut();
+        self.transport_header = core::ptr::null_mut();
+        self.ip_summed = CHECKSUM_NONE;
+        self.csum_start = 0;
+        self.csum_offset = 0;
+        self.gso_size = 0;
+        self.gso_type = 0;
+    }
+
+    /// 把数据复制到新分配的页中，作为页片段追加到包尾 (alloc_skb_with_frags)
+    ///
+    /// # 说明
+    /// 大块数据不放在线性区，线性区只需容纳协议头，固定大小的数据区就够用
+    pub fn skb_append_pagefrags(&mut self, data: &[u8]) -> Result<(), ()> {
+        let page_size = crate::mm::PAGE_SIZE;
+        if self.nr_frags as usize + (data.len() + page_size - 1) / page_size > MAX_SKB_FRAGS {
+            return Err(());
+        }
+        for chunk in data.chunks(page_size) {
+            let frame = mem_cgroup_alloc_page(MemcgStat::Sock).ok_or(())?;
+            let page = frame.start_address().as_usize();
+            skb_pool::skb_pool_note_frag_page();
+            unsafe {
+                core::ptr::copy_nonoverlapping(chunk.as_ptr(), page as *mut u8, chunk.len());
+            }
+            // skb_fill_page_desc 取得自己的引用，随后放下分配时的引用
+            let ret = self.skb_fill_page_desc(page, 0, chunk.len() as u32);
+            crate::mm::filemap::put_page(page);
+            ret?;
+        }
+        Ok(())
+    }
+
+    /// 部分校验和的起点相对 data 的偏移 (skb_checksum_start_offset)
+    #[inline]
+    pub fn skb_checksum_start_offset(&self) -> u32 {
+        (self.head as usize + self.csum_start as usize - self.data as usize) as u32
+    }
+
+    /// 设置部分校验和：从 start（指针）算到包尾，结果写在 start + offset
+    pub fn set_csum_partial(&mut self, start: *const u8, offset: u16) {
+        self.ip_summed = CHECKSUM_PARTIAL;
+        self.csum_start = (start as usize - self.head as usize) as u16;
+        self.csum_offset = offset;
+    }
+
+    /// 是否是等待分段的超长包 (skb_is_gso)
+    #[inline]
+    pub fn is_gso(&self) -> bool {
+        self.gso_size != 0
+    }
+
+    /// 用软件完成 CHECKSUM_PARTIAL 的校验和 (skb_checksum_help)
+    ///
+    /// 设备不支持校验和卸载时在发送前调用；伪头部的和已在校验和字段中
+    pub fn skb_checksum_help(&mut self) -> Result<(), ()> {
+        if self.ip_summed != CHECKSUM_PARTIAL {
+            return Ok(());
+        }
+        let start = self.skb_checksum_start_offset();
+        let field = start + self.csum_offset as u32;
+        if field + 2 > self.skb_headlen() {
+            return Err(());
+        }
+        let sum = if self.data_len == 0 {
+            let data = unsafe { core::slice::from_raw_parts(self.data.add(start as usize), (self.len - start) as usize) };
+            crate::net::ipv4::checksum::csum_partial(data, 0)
+        } else {
+            // 页片段中的数据先复制出来再计算
+            let mut buf = alloc::vec![0u8; (self.len - start) as usize];
+            self.skb_copy_bits(start, &mut buf, self.len - start);
+            crate::net::ipv4::checksum::csum_partial(&buf, 0)
+        };
+        let mut check = crate::net::ipv4::checksum::csum_fold(sum);
+        // UDP 用 0xFFFF 表示结果为 0 (CSUM_MANGLED_0)
+        if check == 0 {
+            check = 0xFFFF;
+        }
+        unsafe {
+            core::ptr::write_unaligned(self.data.add(field as usize) as *mut u16, check.to_be());
+        }
+        self.ip_summed = CHECKSUM_NONE;
+        Ok(())
+    }
+
+    /// 线性区中的字节数 (skb_headlen)
+    #[inline]
+    pub fn skb_headlen(&self) -> u32 {
+        self.len - self.data_len
+    }
+
+    /// 追加引用页中 [offset, offset + size) 的片段 (skb_fill_page_desc)
+    ///
+    /// 为片段增加页的引用，数据留在原页中；与前一个片段在同一页上相接时合并 (skb_can_coalesce)
+    ///
+    /// # 返回
+    /// 成功返回 Ok(())，片段数已满返回 Err(())
+    pub fn skb_fill_page_desc(&mut self, page: usize, offset: u32, size: u32) -> Result<(), ()> {
+        if size == 0 {
+            return Ok(());
+        }
+        let nr = self.nr_frags as usize;
+        if nr > 0 {
+            let last = &mut self.frags[nr - 1];
+            if last.page == page && last.offset + last.size == offset {
+                last.size += size;
+                self.data_len += size;
+                self.len += size;
+                return Ok(());
+            }
+        }
+        if nr == MAX_SKB_FRAGS {
+            return Err(());
+        }
+        let desc = crate::mm::page_desc::pfn_to_page(page / crate::mm::PAGE_SIZE);
+        if !desc.is_null() {
+            unsafe { (*desc).get_page() };
+        }
+        self.frags[nr] = SkbFrag { page, offset, size };
+        self.nr_frags += 1;
+        self.data_len += size;
+        self.len += size;
+        Ok(())
+    }
+
+    /// 归还所有页片段的引用 (skb_release_data)
+    ///
+    /// 最后一个引用归还时页被释放
+    pub fn skb_release_frags(&mut self) {
+        for frag in &self.frags[..self.nr_frags as usize] {
+            crate::mm::filemap::put_page(frag.page);
+        }
+        self.len -= self.data_len;
+        self.data_len = 0;
+        self.nr_frags = 0;
+    }
+
     /// 设置 MAC 头
     ///
     /// # 参数
@@ -386,17 +615,93 @@ impl SkBuff {
             return 0;
         }
 
-        let copy_len = core::cmp::min(len, self.len - offset);
+        let copy_len = core::cmp::min(core::cmp::min(len, self.len - offset), buf.len() as u32);
         if copy_len == 0 {
             return 0;
         }
 
-        unsafe {
-            let src = self.data.add(offset as usize);
-            core::ptr::copy_nonoverlapping(src, buf.as_mut_ptr(), copy_len as usize);
+        // 先复制线性区，再依次复制页片段
+        let headlen = self.skb_headlen();
+        let mut copied = 0u32;
+        if offset < headlen {
+            let n = core::cmp::min(copy_len, headlen - offset);
+            unsafe {
+                let src = self.data.add(offset as usize);
+                core::ptr::copy_nonoverlapping(src, buf.as_mut_ptr(), n as usize);
+            }
+            copied = n;
+        }
+
+        let mut start = headlen;
+        for frag in &self.frags[..self.nr_frags as usize] {
+            if copied == copy_len {
+                break;
+            }
+            let pos = offset + copied;
+            if pos < start + frag.size {
+                let in_frag = pos - start;
+                let n = core::cmp::min(copy_len - copied, frag.size - in_frag);
+                unsafe {
+                    let src = (frag.page + (frag.offset + in_frag) as usize) as *const u8;
+                    core::ptr::copy_nonoverlapping(src, buf[copied as usize..].as_mut_ptr(), n as usize);
+                }
+                copied += n;
+            }
+            start += frag.size;
+        }
+
+        copied
+    }
+
+    /// 复制数据并同时计算部分和 (skb_copy_and_csum_bits)
+    ///
+    /// # 参数
+    /// - `offset`: 起始偏移
+    /// - `buf`: 目标缓冲区
+    /// - `len`: 要复制的长度
+    /// - `sum`: 之前的部分和
+    ///
+    /// # 返回
+    /// (实际复制的字节数, 复制数据的部分和)
+    pub fn skb_copy_and_csum_bits(&self, offset: u32, buf: &mut [u8], len: u32, sum: u32) -> (u32, u32) {
+        use crate::net::ipv4::checksum::{csum_block_add, csum_partial_copy};
+
+        if offset > self.len {
+            return (0, sum);
+        }
+        let copy_len = core::cmp::min(core::cmp::min(len, self.len - offset), buf.len() as u32);
+
+        // 与 skb_copy_bits 相同的遍历顺序；每段按其在 buf 中的奇偶位置累加
+        let headlen = self.skb_headlen();
+        let mut copied = 0u32;
+        let mut sum = sum;
+        if offset < headlen && copy_len > 0 {
+            let n = core::cmp::min(copy_len, headlen - offset);
+            let src = unsafe { core::slice::from_raw_parts(self.data.add(offset as usize), n as usize) };
+            sum = csum_partial_copy(src, &mut buf[..n as usize], sum);
+            copied = n;
+        }
+
+        let mut start = headlen;
+        for frag in &self.frags[..self.nr_frags as usize] {
+            if copied == copy_len {
+                break;
+            }
+            let pos = offset + copied;
+            if pos < start + frag.size {
+                let in_frag = pos - start;
+                let n = core::cmp::min(copy_len - copied, frag.size - in_frag);
+                let src = unsafe {
+                    core::slice::from_raw_parts((frag.page + (frag.offset + in_frag) as usize) as *const u8, n as usize)
+                };
+                let dst = &mut buf[copied as usize..(copied + n) as usize];
+                sum = csum_block_add(sum, csum_partial_copy(src, dst, 0), copied as usize);
+                copied += n;
+            }
+            start += frag.size;
         }
 
-        copy_len
+        (copied, sum)
     }
 }
 
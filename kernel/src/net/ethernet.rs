@@ -151,17 +151,15 @@ pub enum ArpHrdType {
     ARPHRD_EUI64 = 27,
 }
 
-/// 计算以太网帧的 CRC32 校验和
+/// 计算以太网帧的 CRC32 校验和 (FCS)
 ///
 /// # 参数
 /// - `data`: 帧数据
 ///
 /// # 返回
-/// CRC32 校验和
+/// CRC32 校验和，初始值与结果都取反 (IEEE 802.3)
 pub fn eth_crc(data: &[u8]) -> u32 {
-    // 简化实现：返回固定值
-    // 完整实现需要 CRC32 算法
-    0xFFFFFFFF
+    !crate::crc32::crc32_le(!0, data)
 }
 
 /// 检查以太网地址是否有效
@@ -236,7 +234,7 @@ pub fn eth_addr_zero(addr: &mut [u8; ETH_ALEN]) {
     addr.fill(0);
 }
 
-/// 发送以太网帧
+/// 发送以太网帧（广播）
 ///
 /// # 参数
 /// - `skb`: SkBuff (包含 IP 数据包)
@@ -245,20 +243,20 @@ pub fn eth_addr_zero(addr: &mut [u8; ETH_ALEN]) {
 /// 成功返回 Ok(())，失败返回 Err(())
 ///
 /// # 说明
-/// 添加以太网头部并发送到网络设备
-pub fn ethernet_send(mut skb: SkBuff) -> Result<(), ()> {
-    // 构造以太网头部
-    // 简化实现：使用广播 MAC 地址
-    // TODO: 实现 ARP 协议来获取目标 MAC 地址
-    let dest_mac = ETH_BROADCAST;
-
-    // 获取源 MAC 地址（从网络设备）
-    let src_mac = match get_device_mac() {
-        Some(mac) => mac,
-        None => [0x52, 0x54, 0x00, 0x12, 0x34, 0x56], // 默认 MAC 地址
-    };
+/// 不经 ARP 解析，使用广播 MAC 地址；按下一跳发送见 arp::arp_output
+pub fn ethernet_send(skb: SkBuff) -> Result<(), ()> {
+    ethernet_xmit(skb, ETH_BROADCAST, EthProtocol::ETH_P_IP)
+}
 
-    eth_push_header(&mut skb, dest_mac, src_mac, EthProtocol::ETH_P_IP)?;
+/// 添加以太网头部并发送到网络设备 (dev_hard_header + dev_queue_xmit)
+///
+/// # 参数
+/// - `skb`: SkBuff (包含上层协议数据)
+/// - `dest_mac`: 目标 MAC 地址
+/// - `proto`: 上层协议类型
+pub fn ethernet_xmit(mut skb: SkBuff, dest_mac: [u8; ETH_ALEN], proto: EthProtocol) -> Result<(), ()> {
+    eth_push_header(&mut skb, dest_mac, eth_dev_addr(), proto)?;
+    crate::trace_record!(TRACE_NET_TX, skb.len, proto.to_u16(), 0);
 
     // 发送到网络设备驱动
     match transmit_to_device(skb) {
@@ -267,15 +265,26 @@ pub fn ethernet_send(mut skb: SkBuff) -> Result<(), ()> {
     }
 }
 
+/// 本机的 MAC 地址，没有网络设备时使用默认值
+pub fn eth_dev_addr() -> [u8; ETH_ALEN] {
+    match get_device_mac() {
+        Some(mac) => mac,
+        None => [0x52, 0x54, 0x00, 0x12, 0x34, 0x56], // 默认 MAC 地址
+    }
+}
+
+/// 发送设备是否需要 ARP 解析：回环设备不需要 (IFF_NOARP)
+pub fn eth_dev_needs_arp() -> bool {
+    get_device_mac().is_some()
+}
+
 /// 获取网络设备的 MAC 地址
 fn get_device_mac() -> Option<[u8; 6]> {
     // 尝试从 VirtIO-Net 设备获取 MAC 地址
     #[cfg(feature = "riscv64")]
     {
-        if let Some(_device) = crate::drivers::net::virtio_net::get_device() {
-            // 从 VirtIO-Net 设备读取 MAC 地址
-            // 注意：这里需要访问实际设备，暂时返回固定值
-            return Some([0x52, 0x54, 0x00, 0x12, 0x34, 0x56]);
+        if let Some(device) = crate::drivers::net::virtio_net::get_device() {
+            return Some(device.get_mac());
         }
     }
 
@@ -289,17 +298,31 @@ fn transmit_to_device(skb: SkBuff) -> i32 {
     #[cfg(feature = "riscv64")]
     {
         // 检查是否有 VirtIO-Net 设备可用
-        if let Some(_device) = crate::drivers::net::virtio_net::get_device() {
-            // 通过 VirtIO-Net 发送
-            // 注意：这里需要调用实际的设备发送函数
-            // 暂时使用简化实现
-            skb.free();
-            return 0; // 成功
+        if let Some(device) = crate::drivers::net::virtio_net::get_device() {
+            // 设备不支持的卸载先由软件完成，再通过 VirtIO-Net 发送
+            let segs = match crate::net::gso::validate_xmit_skb(skb, device.features()) {
+                Ok(segs) => segs,
+                Err(()) => return -22, // EINVAL
+            };
+            let mut ret = 0;
+            for seg in segs {
+                let r = device.xmit(seg);
+                if r != 0 {
+                    ret = r;
+                }
+            }
+            return ret;
         }
     }
 
-    // 回退到回环设备
-    crate::drivers::net::loopback::loopback_send(skb);
+    // 回退到回环设备：不做任何卸载，超长包和部分校验和由软件处理
+    let segs = match crate::net::gso::validate_xmit_skb(skb, 0) {
+        Ok(segs) => segs,
+        Err(()) => return -22, // EINVAL
+    };
+    for seg in segs {
+        crate::drivers::net::loopback::loopback_send(seg);
+    }
     0
 }
 
@@ -346,8 +369,11 @@ pub fn ethernet_rcv(skb: SkBuff) -> Result<(), ()> {
         }
     };
 
-    // 根据协议类型分发到上层
+    // 根据协议类型分发到上层，上层协议从自己的头部开始解析
     let protocol = eth_hdr.protocol();
+    crate::trace_record!(TRACE_NET_RX, skb.len, protocol.to_u16(), 0);
+    let mut skb = skb;
+    skb.skb_pull(ETH_HLEN as u32);
 
     match protocol {
         EthProtocol::ETH_P_IP => {
@@ -369,6 +395,17 @@ pub fn ethernet_rcv(skb: SkBuff) -> Result<(), ()> {
     Ok(())
 }
 
+/// 接收驱动整批交付的以太网帧 (napi_gro_receive + netif_receive_skb_list)
+///
+/// # 说明
+/// NAPI 轮询每轮收取的数据包在释放队列锁后一次交付；同一条 TCP 流上连续的
+/// 报文段先经 GRO 合并
+pub fn ethernet_rcv_list(skbs: alloc::vec::Vec<SkBuff>) {
+    for skb in crate::net::gro::napi_gro_receive_list(skbs) {
+        let _ = ethernet_rcv(skb);
+    }
+}
+
 /// 轮询网络设备接收数据包
 ///
 /// # 说明
@@ -377,16 +414,14 @@ pub fn ethernet_poll() {
     // 轮询 VirtIO-Net 设备
     #[cfg(feature = "riscv64")]
     {
-        if let Some(_device) = crate::drivers::net::virtio_net::get_device() {
-            // TODO: 从 VirtIO-Net 设备接收数据包
-            // 当前简化实现：不执行任何操作
+        if let Some(device) = crate::drivers::net::virtio_net::get_device() {
+            // 中断没有送达时由这里补收；已有轮询者时立即返回
+            device.napi_poll();
         }
     }
 
-    // 轮询回环设备
-    if let Some(skb) = crate::drivers::net::loopback::loopback_poll() {
-        let _ = ethernet_rcv(skb);
-    }
+    // 回环设备积压队列中的本机包
+    crate::drivers::net::loopback::loopback_process_backlog();
 }
 
 #[cfg(test)]
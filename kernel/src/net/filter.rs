@@ -0,0 +1,312 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 经典 BPF 过滤程序
+//!
+//! 对一段原始包数据运行 struct sock_filter 指令序列，返回 32 位结果。
+//!
+//! 参考: net/core/filter.c (bpf_check_classic), include/uapi/linux/filter.h, include/uapi/linux/bpf_common.h
+//!
+//! # 设计
+//! - 装入前检查 (bpf_check_classic)：只接受已知的操作码，跳转目标都在程序内，
+//!   常数除数不为 0，移位常数小于 32，暂存区下标在范围内，最后一条是 RET
+//! - 跳转偏移是无符号数，只能向前跳，通过检查的程序最多执行 len 条指令
+//! - 暂存区开始时清零，不需要检查读之前是否写过
+//! - 读取越过包尾，或运行时除以 0，程序立即返回 0，与 Linux 相同
+
+/// 一条指令 (struct sock_filter)
+#[repr(C)]
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct SockFilter {
+    pub code: u16,
+    pub jt: u8,
+    pub jf: u8,
+    pub k: u32,
+}
+
+impl SockFilter {
+    /// 普通指令 (BPF_STMT)
+    pub const fn stmt(code: u16, k: u32) -> Self {
+        Self { code, jt: 0, jf: 0, k }
+    }
+
+    /// 条件跳转 (BPF_JUMP)
+    pub const fn jump(code: u16, k: u32, jt: u8, jf: u8) -> Self {
+        Self { code, jt, jf, k }
+    }
+
+    /// 从小端字节流解析，长度必须是 8 的倍数（用户写入的 struct sock_filter 数组）
+    pub fn parse(bytes: &[u8]) -> Option<alloc::vec::Vec<Self>> {
+        if bytes.len() % 8 != 0 {
+            return None;
+        }
+        Some(bytes.chunks_exact(8).map(|b| Self {
+            code: u16::from_le_bytes([b[0], b[1]]),
+            jt: b[2],
+            jf: b[3],
+            k: u32::from_le_bytes([b[4], b[5], b[6], b[7]]),
+        }).collect())
+    }
+}
+
+/// 指令类别
+pub const BPF_LD: u16 = 0x00;
+pub const BPF_LDX: u16 = 0x01;
+pub const BPF_ST: u16 = 0x02;
+pub const BPF_STX: u16 = 0x03;
+pub const BPF_ALU: u16 = 0x04;
+pub const BPF_JMP: u16 = 0x05;
+pub const BPF_RET: u16 = 0x06;
+pub const BPF_MISC: u16 = 0x07;
+
+/// 读取宽度
+pub const BPF_W: u16 = 0x00;
+pub const BPF_H: u16 = 0x08;
+pub const BPF_B: u16 = 0x10;
+
+/// 寻址方式
+pub const BPF_IMM: u16 = 0x00;
+pub const BPF_ABS: u16 = 0x20;
+pub const BPF_IND: u16 = 0x40;
+pub const BPF_MEM: u16 = 0x60;
+pub const BPF_LEN: u16 = 0x80;
+pub const BPF_MSH: u16 = 0xa0;
+
+/// 算术运算
+pub const BPF_ADD: u16 = 0x00;
+pub const BPF_SUB: u16 = 0x10;
+pub const BPF_MUL: u16 = 0x20;
+pub const BPF_DIV: u16 = 0x30;
+pub const BPF_OR: u16 = 0x40;
+pub const BPF_AND: u16 = 0x50;
+pub const BPF_LSH: u16 = 0x60;
+pub const BPF_RSH: u16 = 0x70;
+pub const BPF_NEG: u16 = 0x80;
+pub const BPF_MOD: u16 = 0x90;
+pub const BPF_XOR: u16 = 0xa0;
+
+/// 跳转条件
+pub const BPF_JA: u16 = 0x00;
+pub const BPF_JEQ: u16 = 0x10;
+pub const BPF_JGT: u16 = 0x20;
+pub const BPF_JGE: u16 = 0x30;
+pub const BPF_JSET: u16 = 0x40;
+
+/// 操作数来源：常数 k 或 X 寄存器
+pub const BPF_K: u16 = 0x00;
+pub const BPF_X: u16 = 0x08;
+
+/// RET 的返回值来源：A 寄存器
+pub const BPF_A: u16 = 0x10;
+
+/// MISC：A 与 X 之间的传送
+pub const BPF_TAX: u16 = 0x00;
+pub const BPF_TXA: u16 = 0x80;
+
+/// 暂存区字数 (BPF_MEMWORDS)
+pub const BPF_MEMWORDS: usize = 16;
+/// 程序最大指令数 (BPF_MAXINSNS)
+pub const BPF_MAXINSNS: usize = 4096;
+
+#[inline]
+const fn bpf_class(code: u16) -> u16 {
+    code & 0x07
+}
+
+#[inline]
+const fn bpf_op(code: u16) -> u16 {
+    code & 0xf0
+}
+
+/// 操作码是否合法 (bpf_check_basics_ok 中的 codes[] 表)
+fn valid_code(code: u16) -> bool {
+    match bpf_class(code) {
+        BPF_ALU => {
+            if code == BPF_ALU | BPF_NEG {
+                return true;
+            }
+            code & !(0xf0 | BPF_X | 0x07) == 0
+                && matches!(bpf_op(code),
+                    BPF_ADD | BPF_SUB | BPF_MUL | BPF_DIV | BPF_MOD | BPF_AND | BPF_OR | BPF_XOR | BPF_LSH | BPF_RSH)
+        }
+        BPF_LD => matches!(code & !0x07,
+            0x00 /* IMM */ | 0x60 /* MEM */ | 0x80 /* W|LEN */
+            | 0x20 | 0x28 | 0x30 /* ABS */ | 0x40 | 0x48 | 0x50 /* IND */),
+        BPF_LDX => matches!(code & !0x07, 0x00 | 0x60 | 0x80 | 0xb0 /* B|MSH */),
+        BPF_ST | BPF_STX => code & !0x07 == 0,
+        BPF_MISC => code == BPF_MISC | BPF_TAX || code == BPF_MISC | BPF_TXA,
+        BPF_RET => code == BPF_RET | BPF_K || code == BPF_RET | BPF_A,
+        BPF_JMP => {
+            code == BPF_JMP | BPF_JA
+                || (code & !(0xf0 | BPF_X | 0x07) == 0
+                    && matches!(bpf_op(code), BPF_JEQ | BPF_JGT | BPF_JGE | BPF_JSET))
+        }
+        _ => false,
+    }
+}
+
+/// 检查程序 (bpf_check_classic)
+///
+/// # 返回
+/// 程序可以安全运行时返回 Ok，否则返回 -EINVAL
+pub fn bpf_check_classic(prog: &[SockFilter]) -> Result<(), i32> {
+    let einval = crate::errno::Errno::InvalidArgument.as_neg_i32();
+    let len = prog.len();
+    if len == 0 || len > BPF_MAXINSNS {
+        return Err(einval);
+    }
+    for (pc, ins) in prog.iter().enumerate() {
+        if !valid_code(ins.code) {
+            return Err(einval);
+        }
+        match bpf_class(ins.code) {
+            BPF_ALU => {
+                let op = bpf_op(ins.code);
+                if ins.code & BPF_X == 0 {
+                    if (op == BPF_DIV || op == BPF_MOD) && ins.k == 0 {
+                        return Err(einval);
+                    }
+                    if (op == BPF_LSH || op == BPF_RSH) && ins.k >= 32 {
+                        return Err(einval);
+                    }
+                }
+            }
+            BPF_LD | BPF_LDX if ins.code & 0xe0 == BPF_MEM => {
+                if ins.k as usize >= BPF_MEMWORDS {
+                    return Err(einval);
+                }
+            }
+            BPF_ST | BPF_STX => {
+                if ins.k as usize >= BPF_MEMWORDS {
+                    return Err(einval);
+                }
+            }
+            BPF_JMP => {
+                let rest = (len - pc - 1) as u64;
+                if ins.code == BPF_JMP | BPF_JA {
+                    if ins.k as u64 >= rest {
+                        return Err(einval);
+                    }
+                } else if ins.jt as u64 >= rest || ins.jf as u64 >= rest {
+                    return Err(einval);
+                }
+            }
+            _ => {}
+        }
+    }
+    if bpf_class(prog[len - 1].code) != BPF_RET {
+        return Err(einval);
+    }
+    Ok(())
+}
+
+/// 按网络字节序读取 size 字节
+#[inline]
+fn load(pkt: &[u8], off: Option<u32>, size: usize) -> Option<u32> {
+    let off = off? as usize;
+    let bytes = pkt.get(off..off.checked_add(size)?)?;
+    Some(bytes.iter().fold(0u32, |v, &b| (v << 8) | b as u32))
+}
+
+/// 运行已通过检查的程序 (bpf_prog_run)
+///
+/// # 返回
+/// RET 指令的值；读取越界或除以 0 时返回 0
+pub fn bpf_prog_run(prog: &[SockFilter], pkt: &[u8]) -> u32 {
+    let mut a: u32 = 0;
+    let mut x: u32 = 0;
+    let mut mem = [0u32; BPF_MEMWORDS];
+    let mut pc = 0;
+
+    while pc < prog.len() {
+        let ins = prog[pc];
+        pc += 1;
+        let k = ins.k;
+        match bpf_class(ins.code) {
+            BPF_LD => {
+                let size = match ins.code & 0x18 {
+                    BPF_W => 4,
+                    BPF_H => 2,
+                    _ => 1,
+                };
+                a = match ins.code & 0xe0 {
+                    BPF_IMM => k,
+                    BPF_MEM => mem[k as usize],
+                    BPF_LEN => pkt.len() as u32,
+                    BPF_ABS => match load(pkt, Some(k), size) {
+                        Some(v) => v,
+                        None => return 0,
+                    },
+                    _ => match load(pkt, x.checked_add(k), size) {
+                        Some(v) => v,
+                        None => return 0,
+                    },
+                };
+            }
+            BPF_LDX => {
+                x = match ins.code & 0xe0 {
+                    BPF_IMM => k,
+                    BPF_MEM => mem[k as usize],
+                    BPF_LEN => pkt.len() as u32,
+                    // IPv4 头部长度：4 * (P[k] & 0xf)
+                    _ => match load(pkt, Some(k), 1) {
+                        Some(v) => (v & 0xf) << 2,
+                        None => return 0,
+                    },
+                };
+            }
+            BPF_ST => mem[k as usize] = a,
+            BPF_STX => mem[k as usize] = x,
+            BPF_ALU => {
+                let op = bpf_op(ins.code);
+                if op == BPF_NEG {
+                    a = a.wrapping_neg();
+                    continue;
+                }
+                let src = if ins.code & BPF_X != 0 { x } else { k };
+                a = match op {
+                    BPF_ADD => a.wrapping_add(src),
+                    BPF_SUB => a.wrapping_sub(src),
+                    BPF_MUL => a.wrapping_mul(src),
+                    BPF_DIV => match a.checked_div(src) {
+                        Some(v) => v,
+                        None => return 0,
+                    },
+                    BPF_MOD => match a.checked_rem(src) {
+                        Some(v) => v,
+                        None => return 0,
+                    },
+                    BPF_OR => a | src,
+                    BPF_AND => a & src,
+                    BPF_XOR => a ^ src,
+                    BPF_LSH => a.checked_shl(src).unwrap_or(0),
+                    _ => a.checked_shr(src).unwrap_or(0),
+                };
+            }
+            BPF_JMP => {
+                if ins.code == BPF_JMP | BPF_JA {
+                    pc += k as usize;
+                    continue;
+                }
+                let src = if ins.code & BPF_X != 0 { x } else { k };
+                let taken = match bpf_op(ins.code) {
+                    BPF_JEQ => a == src,
+                    BPF_JGT => a > src,
+                    BPF_JGE => a >= src,
+                    _ => a & src != 0,
+                };
+                pc += if taken { ins.jt } else { ins.jf } as usize;
+            }
+            BPF_RET => return if ins.code & BPF_A != 0 { a } else { k },
+            _ => {
+                if ins.code == BPF_MISC | BPF_TAX {
+                    x = a;
+                } else {
+                    a = x;
+                }
+            }
+        }
+    }
+    0
+}
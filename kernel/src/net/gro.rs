@@ -0,0 +1,323 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 通用接收合并 (GRO)
+//!
+//! NAPI 每轮收取的包中，同一条 TCP 流上连续的报文段先合并成一个大包再交给协议栈，
+//! IP 与 TCP 的解析、socket 查找与加锁对每个合并包只做一次。
+//!
+//! 参考: net/core/gro.c, net/ipv4/tcp_offload.c, net/ipv4/af_inet.c (inet_gro_receive)
+//!
+//! # 设计
+//! - 合并状态只在一轮轮询内存在，不需要加锁；轮询结束时全部交付 (napi_gro_flush)
+//! - 只合并不带 IP 选项、未分片的 TCPv4 报文段：标志只能是 ACK/PSH，确认号、TCP 选项、
+//!   TOS 与 TTL 与流中已有的包相同，序列号正好接上
+//! - 第一个报文段的数据长度作为 gso_size，更短的报文段是一批的结尾，合并后立即交付
+//! - 合并包是线性的：第一次合并时分配 GRO_MAX_SIZE 的数据区，之后的数据直接追加，
+//!   TCP 可以直接引用而不必再复制
+//! - 报文段合并前校验 TCP 校验和（设备已验证的除外），合并包标记为 CHECKSUM_UNNECESSARY；
+//!   校验失败的报文段原样交付，由 TCP 丢弃
+//! - 不能合并的报文段先冲刷同一条流上暂存的包，流内顺序不变
+
+use alloc::vec::Vec;
+
+use crate::net::buffer::{SkBuff, CHECKSUM_UNNECESSARY, SKB_GSO_TCPV4};
+use crate::net::ethernet::ETH_HLEN;
+use crate::net::ipv4::checksum;
+use crate::net::tcp::{TCPHDR_ACK, TCPHDR_PSH};
+
+/// 同时暂存的流数，超出时交付最早的流 (MAX_GRO_SKBS)
+pub const GRO_MAX_HELD: usize = 8;
+
+/// 合并后 IP 包的最大长度 (GRO_LEGACY_MAX_SIZE)
+pub const GRO_MAX_SIZE: usize = 65535;
+
+/// IPv4 头部长度（不带选项）
+const IP_HLEN: usize = 20;
+
+/// TCP 头部最大长度
+const TCP_MAX_HLEN: usize = 60;
+
+/// 报文段的流标识：源地址、目标地址、源端口、目标端口
+type GroKey = (u32, u32, u16, u16);
+
+/// 解析出的报文段头部 (napi_gro_cb)
+struct GroSeg {
+    key: GroKey,
+    /// 以太网、IP、TCP 头部
+    hdr: [u8; ETH_HLEN + IP_HLEN + TCP_MAX_HLEN],
+    /// 三层头部的总长度
+    hdr_len: usize,
+    /// 数据长度
+    payload: usize,
+    seq: u32,
+    flags: u8,
+    /// 可以与同一条流上的包合并
+    mergeable: bool,
+}
+
+impl GroSeg {
+    #[inline]
+    fn ip(&self) -> &[u8] {
+        &self.hdr[ETH_HLEN..ETH_HLEN + IP_HLEN]
+    }
+
+    #[inline]
+    fn tcp(&self) -> &[u8] {
+        &self.hdr[ETH_HLEN + IP_HLEN..self.hdr_len]
+    }
+}
+
+/// 暂存的流：第一个报文段之后合并进来的数据都追加在 skb 末尾
+struct GroFlow {
+    seg: GroSeg,
+    skb: SkBuff,
+    /// 下一个报文段应有的序列号
+    next_seq: u32,
+    /// 第一个报文段的数据长度
+    mss: usize,
+    /// 已合并的报文段数
+    count: u16,
+}
+
+/// 解析以太网帧中的 TCPv4 报文段 (inet_gro_receive + tcp4_gro_receive)
+///
+/// # 返回
+/// 不是 TCPv4 报文段时返回 None
+fn gro_parse(skb: &SkBuff) -> Option<GroSeg> {
+    let mut hdr = [0u8; ETH_HLEN + IP_HLEN + TCP_MAX_HLEN];
+    let min = ETH_HLEN + IP_HLEN + 20;
+    if (skb.len as usize) < min || skb.skb_copy_bits(0, &mut hdr[..min], min as u32) as usize != min {
+        return None;
+    }
+    // 以太网类型 ETH_P_IP，IPv4 且协议号为 TCP
+    let ip = &hdr[ETH_HLEN..ETH_HLEN + IP_HLEN];
+    if hdr[12..14] != [0x08, 0x00] || ip[0] >> 4 != 4 || ip[9] != 6 {
+        return None;
+    }
+    let tcp_off = ETH_HLEN + IP_HLEN;
+    let key = (
+        u32::from_be_bytes([ip[12], ip[13], ip[14], ip[15]]),
+        u32::from_be_bytes([ip[16], ip[17], ip[18], ip[19]]),
+        u16::from_be_bytes([hdr[tcp_off], hdr[tcp_off + 1]]),
+        u16::from_be_bytes([hdr[tcp_off + 2], hdr[tcp_off + 3]]),
+    );
+    let mut seg = GroSeg { key, hdr, hdr_len: min, payload: 0, seq: 0, flags: 0, mergeable: false };
+
+    // 带 IP 选项、分片或长度不一致的包不合并
+    let ip = seg.ip();
+    let tot_len = u16::from_be_bytes([ip[2], ip[3]]) as usize;
+    let frag_off = u16::from_be_bytes([ip[6], ip[7]]);
+    if ip[0] != 0x45 || frag_off & 0x3FFF != 0 || tot_len > skb.len as usize - ETH_HLEN {
+        return Some(seg);
+    }
+    let doff = ((seg.hdr[tcp_off + 12] >> 4) as usize) * 4;
+    if doff < 20 || IP_HLEN + doff > tot_len {
+        return Some(seg);
+    }
+    seg.hdr_len = tcp_off + doff;
+    skb.skb_copy_bits(0, &mut seg.hdr[..seg.hdr_len], seg.hdr_len as u32);
+    seg.payload = tot_len - IP_HLEN - doff;
+    let (seq, flags) = {
+        let tcp = seg.tcp();
+        (u32::from_be_bytes([tcp[4], tcp[5], tcp[6], tcp[7]]), tcp[13])
+    };
+    seg.seq = seq;
+    seg.flags = flags;
+
+    // 只合并带数据、标志只有 ACK/PSH 的报文段；IP 头部校验和必须正确
+    if seg.payload == 0 || seg.flags & !(TCPHDR_ACK | TCPHDR_PSH) != 0 || seg.flags & TCPHDR_ACK == 0 {
+        return Some(seg);
+    }
+    if checksum::ip_checksum(seg.ip()) != 0 {
+        return Some(seg);
+    }
+    // 设备没有验证过的报文段在这里校验：合并包不再逐段校验
+    if skb.ip_summed != CHECKSUM_UNNECESSARY {
+        let frame_len = ETH_HLEN + tot_len;
+        if (skb.skb_headlen() as usize) < frame_len {
+            return Some(seg);
+        }
+        let tcp_bytes = unsafe { core::slice::from_raw_parts(skb.data.add(tcp_off), tot_len - IP_HLEN) };
+        let sum = checksum::csum_tcpudp_nofold(key.0, key.1, (tot_len - IP_HLEN) as u32, 6);
+        if checksum::csum_fold(checksum::csum_partial(tcp_bytes, sum)) != 0 {
+            return Some(seg);
+        }
+    }
+    seg.mergeable = true;
+    Some(seg)
+}
+
+impl GroFlow {
+    fn new(mut skb: SkBuff, seg: GroSeg) -> Self {
+        skb.ip_summed = CHECKSUM_UNNECESSARY;
+        Self {
+            next_seq: seg.seq.wrapping_add(seg.payload as u32),
+            mss: seg.payload,
+            count: 1,
+            seg,
+            skb,
+        }
+    }
+
+    /// 新报文段能否接在这条流之后 (tcp_gro_receive 的 flush 判断)
+    fn can_merge(&self, seg: &GroSeg) -> bool {
+        let (ip, new_ip) = (self.seg.ip(), seg.ip());
+        let (tcp, new_tcp) = (self.seg.tcp(), seg.tcp());
+        seg.seq == self.next_seq
+            && seg.payload <= self.mss
+            && ETH_HLEN + IP_HLEN + tcp.len() + self.merged_payload() + seg.payload <= ETH_HLEN + GRO_MAX_SIZE
+            // TOS 与 TTL 相同
+            && ip[1] == new_ip[1]
+            && ip[8] == new_ip[8]
+            // 确认号与 TCP 选项相同
+            && tcp[8..12] == new_tcp[8..12]
+            && tcp.len() == new_tcp.len()
+            && tcp[20..] == new_tcp[20..]
+    }
+
+    /// 已合并的数据长度
+    #[inline]
+    fn merged_payload(&self) -> usize {
+        self.next_seq.wrapping_sub(self.seg.seq) as usize
+    }
+
+    /// 把报文段的数据追加到流中 (skb_gro_receive)
+    ///
+    /// # 返回
+    /// 分配合并包失败时原样交还报文段
+    fn merge(&mut self, skb: SkBuff, seg: &GroSeg) -> Result<(), SkBuff> {
+        if self.count == 1 {
+            // 第一次合并：把第一个报文段复制到能容纳整个合并包的线性数据区
+            let frame_len = self.seg.hdr_len + self.mss;
+            let mut big = match SkBuff::alloc((ETH_HLEN + GRO_MAX_SIZE) as u32) {
+                Some(big) => big,
+                None => return Err(skb),
+            };
+            let dst = match big.skb_put(frame_len as u32) {
+                Some(ptr) => ptr,
+                None => {
+                    big.free();
+                    return Err(skb);
+                }
+            };
+            let frame = unsafe { core::slice::from_raw_parts_mut(dst, frame_len) };
+            self.skb.skb_copy_bits(0, frame, frame_len as u32);
+            big.protocol = self.skb.protocol;
+            big.ip_summed = CHECKSUM_UNNECESSARY;
+            let first = core::mem::replace(&mut self.skb, big);
+            first.free();
+        }
+
+        let dst = match self.skb.skb_put(seg.payload as u32) {
+            Some(ptr) => ptr,
+            None => return Err(skb),
+        };
+        let data = unsafe { core::slice::from_raw_parts_mut(dst, seg.payload) };
+        skb.skb_copy_bits(seg.hdr_len as u32, data, seg.payload as u32);
+        skb.free();
+
+        // 窗口取最新的报文段，PSH 累积
+        let tcp = unsafe { core::slice::from_raw_parts_mut(self.skb.data.add(ETH_HLEN + IP_HLEN), 20) };
+        let new_tcp = seg.tcp();
+        tcp[14..16].copy_from_slice(&new_tcp[14..16]);
+        tcp[13] |= seg.flags & TCPHDR_PSH;
+
+        self.next_seq = self.next_seq.wrapping_add(seg.payload as u32);
+        self.count += 1;
+        Ok(())
+    }
+
+    /// 补齐合并包的 IP 头部后交出 (tcp_gro_complete + inet_gro_complete)
+    fn complete(self) -> SkBuff {
+        let mut skb = self.skb;
+        if self.count > 1 {
+            let ip = unsafe { core::slice::from_raw_parts_mut(skb.data.add(ETH_HLEN), IP_HLEN) };
+            ip[2..4].copy_from_slice(&((skb.len as usize - ETH_HLEN) as u16).to_be_bytes());
+            ip[10..12].copy_from_slice(&[0, 0]);
+            let check = checksum::ip_checksum(ip);
+            ip[10..12].copy_from_slice(&check.to_be_bytes());
+            skb.gso_size = self.mss as u16;
+            skb.gso_type = SKB_GSO_TCPV4;
+        }
+        skb
+    }
+}
+
+/// 一轮轮询中暂存的流 (napi_struct.gro_hash)
+struct GroList {
+    flows: Vec<GroFlow>,
+}
+
+impl GroList {
+    fn new() -> Self {
+        Self { flows: Vec::with_capacity(GRO_MAX_HELD) }
+    }
+
+    /// 交付一条流
+    fn flush_flow(&mut self, pos: usize, out: &mut Vec<SkBuff>) {
+        out.push(self.flows.remove(pos).complete());
+    }
+
+    /// 接收一个以太网帧，可合并的暂存，其余按顺序放入 out (dev_gro_receive)
+    fn receive(&mut self, skb: SkBuff, out: &mut Vec<SkBuff>) {
+        let seg = match gro_parse(&skb) {
+            Some(seg) => seg,
+            None => {
+                out.push(skb);
+                return;
+            }
+        };
+
+        let mut skb = skb;
+        if let Some(pos) = self.flows.iter().position(|f| f.seg.key == seg.key) {
+            if seg.mergeable && self.flows[pos].can_merge(&seg) {
+                match self.flows[pos].merge(skb, &seg) {
+                    Ok(()) => {
+                        // 短报文段结束这一批
+                        if seg.payload < self.flows[pos].mss {
+                            self.flush_flow(pos, out);
+                        }
+                        return;
+                    }
+                    Err(unmerged) => skb = unmerged,
+                }
+            }
+            self.flush_flow(pos, out);
+        }
+
+        if !seg.mergeable {
+            out.push(skb);
+            return;
+        }
+        if self.flows.len() == GRO_MAX_HELD {
+            self.flush_flow(0, out);
+        }
+        self.flows.push(GroFlow::new(skb, seg));
+    }
+
+    /// 交付所有暂存的流 (napi_gro_flush)
+    fn flush(&mut self, out: &mut Vec<SkBuff>) {
+        for flow in self.flows.drain(..) {
+            out.push(flow.complete());
+        }
+    }
+}
+
+/// 合并一轮轮询收到的以太网帧 (napi_gro_receive + napi_gro_flush)
+///
+/// # 参数
+/// - `skbs`: 按到达顺序排列的帧
+///
+/// # 返回
+/// 交给协议栈的帧；同一条流内保持到达顺序
+pub fn napi_gro_receive_list(skbs: Vec<SkBuff>) -> Vec<SkBuff> {
+    let mut gro = GroList::new();
+    let mut out = Vec::with_capacity(skbs.len());
+    for skb in skbs {
+        gro.receive(skb, &mut out);
+    }
+    gro.flush(&mut out);
+    out
+}
@@ -0,0 +1,269 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 通用分段与发送前校验 (GSO)
+//!
+//! TCP 交给设备层的超长包（最大 64 KB）在设备支持 TSO 时整包下发，
+//! 由设备切分；否则在这里按 gso_size 切成 MSS 大小的帧。
+//! UDP_SEGMENT 产生的 UDP 超长包总是在这里切成各个数据报（设备没有 USO）。
+//! 设备不支持校验和卸载时，CHECKSUM_PARTIAL 的包在这里用软件补齐。
+//!
+//! 参考: net/core/gso.c, net/ipv4/tcp_offload.c, net/ipv4/udp_offload.c,
+//! net/core/dev.c (validate_xmit_skb)
+
+use alloc::vec::Vec;
+
+use crate::drivers::net::space::netdev_features::{NETIF_F_HW_CSUM, NETIF_F_TSO};
+use crate::net::buffer::{SkBuff, CHECKSUM_PARTIAL, SKB_GSO_TCPV4, SKB_GSO_UDP_L4};
+use crate::net::ethernet::ETH_HLEN;
+use crate::net::ipv4::checksum;
+use crate::net::tcp::{TCPHDR_CWR, TCPHDR_FIN, TCPHDR_PSH};
+
+/// TCP 头部中校验和字段的偏移
+pub const TCP_CSUM_OFFSET: u16 = 16;
+/// UDP 头部中校验和字段的偏移
+pub const UDP_CSUM_OFFSET: u16 = 6;
+
+/// 把超长包切成 gso_size 大小的帧 (skb_gso_segment)
+///
+/// # 参数
+/// - `skb`: 以以太网头部开始的超长包，处理后释放
+///
+/// - `features`: 设备特性；不支持校验和卸载时复制数据的同时算出校验和
+///
+/// # 返回
+/// 各分段；设备支持校验和卸载时仍为 CHECKSUM_PARTIAL（已填好各自的伪头部）
+pub fn skb_gso_segment(skb: SkBuff, features: u32) -> Result<Vec<SkBuff>, ()> {
+    if skb.gso_size == 0 {
+        skb.free();
+        return Err(());
+    }
+    if skb.gso_type & SKB_GSO_TCPV4 != 0 {
+        tcp_gso_segment(skb, features)
+    } else if skb.gso_type & SKB_GSO_UDP_L4 != 0 {
+        udp4_gso_segment(skb, features)
+    } else {
+        skb.free();
+        Err(())
+    }
+}
+
+/// 分配一个能容纳 len 字节的分段并占满 (skb_segment 中的 alloc_skb)
+///
+/// 失败时释放已切出的分段
+fn gso_alloc_seg(len: usize, segs: &mut Vec<SkBuff>) -> Option<(SkBuff, *mut u8)> {
+    let mut seg = SkBuff::alloc(len as u32);
+    let base = seg.as_mut().and_then(|seg| seg.skb_put(len as u32));
+    match (seg, base) {
+        (Some(seg), Some(base)) => Some((seg, base)),
+        (seg, _) => {
+            if let Some(seg) = seg {
+                seg.free();
+            }
+            for seg in segs.drain(..) {
+                seg.free();
+            }
+            None
+        }
+    }
+}
+
+/// 把 UDPv4 超长包切成 gso_size 字节的数据报，最后一个可以更短 (__udp_gso_segment)
+///
+/// 每个数据报带自己的 UDP 头部：长度与校验和按各自的数据重算，IP 标识依次递增
+fn udp4_gso_segment(skb: SkBuff, features: u32) -> Result<Vec<SkBuff>, ()> {
+    let mut hdr = [0u8; ETH_HLEN + 60 + 8];
+    let copied = skb.skb_copy_bits(0, &mut hdr[..ETH_HLEN + 20], (ETH_HLEN + 20) as u32) as usize;
+    let ihl = ((hdr[ETH_HLEN] & 0x0F) as usize) * 4;
+    let udp_off = ETH_HLEN + ihl;
+    let hdr_len = udp_off + 8;
+    if copied < ETH_HLEN + 20 || ihl < 20 || hdr_len as u32 > skb.len {
+        skb.free();
+        return Err(());
+    }
+    skb.skb_copy_bits(0, &mut hdr[..hdr_len], hdr_len as u32);
+
+    let mss = skb.gso_size as usize;
+    let payload = skb.len as usize - hdr_len;
+    let id = u16::from_be_bytes([hdr[ETH_HLEN + 4], hdr[ETH_HLEN + 5]]);
+    let saddr = u32::from_be_bytes([hdr[ETH_HLEN + 12], hdr[ETH_HLEN + 13], hdr[ETH_HLEN + 14], hdr[ETH_HLEN + 15]]);
+    let daddr = u32::from_be_bytes([hdr[ETH_HLEN + 16], hdr[ETH_HLEN + 17], hdr[ETH_HLEN + 18], hdr[ETH_HLEN + 19]]);
+    let sw_csum = features & NETIF_F_HW_CSUM == 0;
+
+    let mut segs = Vec::with_capacity((payload + mss - 1) / mss);
+    let mut offset = 0;
+    while offset < payload {
+        let seg_len = core::cmp::min(mss, payload - offset);
+        let (mut seg, base) = match gso_alloc_seg(hdr_len + seg_len, &mut segs) {
+            Some(seg) => seg,
+            None => {
+                skb.free();
+                return Err(());
+            }
+        };
+        let frame = unsafe { core::slice::from_raw_parts_mut(base, hdr_len + seg_len) };
+        frame[..hdr_len].copy_from_slice(&hdr[..hdr_len]);
+        let payload_sum = if sw_csum {
+            skb.skb_copy_and_csum_bits((hdr_len + offset) as u32, &mut frame[hdr_len..], seg_len as u32, 0).1
+        } else {
+            skb.skb_copy_bits((hdr_len + offset) as u32, &mut frame[hdr_len..], seg_len as u32);
+            0
+        };
+
+        let ip = &mut frame[ETH_HLEN..udp_off];
+        ip[2..4].copy_from_slice(&((ihl + 8 + seg_len) as u16).to_be_bytes());
+        ip[4..6].copy_from_slice(&id.wrapping_add(segs.len() as u16).to_be_bytes());
+        ip[10..12].copy_from_slice(&[0, 0]);
+        let ip_check = checksum::ip_checksum(ip);
+        ip[10..12].copy_from_slice(&ip_check.to_be_bytes());
+
+        let udp = &mut frame[udp_off..];
+        udp[4..6].copy_from_slice(&((8 + seg_len) as u16).to_be_bytes());
+        let pseudo = checksum::csum_tcpudp_nofold(saddr, daddr, (8 + seg_len) as u32, 17);
+        if sw_csum {
+            udp[6..8].copy_from_slice(&[0, 0]);
+            let sum = checksum::csum_partial(&udp[..8], pseudo);
+            let sum = checksum::csum_block_add(sum, payload_sum, 8);
+            // 算出的 0 要写成 0xFFFF，0 表示没有校验和 (CSUM_MANGLED_0)
+            let check = match checksum::csum_fold(sum) {
+                0 => 0xFFFF,
+                check => check,
+            };
+            udp[6..8].copy_from_slice(&check.to_be_bytes());
+        } else {
+            udp[6..8].copy_from_slice(&(!checksum::csum_fold(pseudo)).to_be_bytes());
+            seg.set_csum_partial(unsafe { base.add(udp_off) }, UDP_CSUM_OFFSET);
+        }
+
+        seg.protocol = skb.protocol;
+        segs.push(seg);
+        offset += seg_len;
+    }
+
+    skb.free();
+    Ok(segs)
+}
+
+/// 把 TCPv4 超长包切成 MSS 大小的帧 (skb_segment + tcp_gso_segment)
+fn tcp_gso_segment(skb: SkBuff, features: u32) -> Result<Vec<SkBuff>, ()> {
+
+    // 复制出全部协议头：以太网 + IP + TCP
+    let mut hdr = [0u8; ETH_HLEN + 60 + 60];
+    let copied = skb.skb_copy_bits(0, &mut hdr[..ETH_HLEN + 20], (ETH_HLEN + 20) as u32) as usize;
+    if copied < ETH_HLEN + 20 {
+        skb.free();
+        return Err(());
+    }
+    let ihl = ((hdr[ETH_HLEN] & 0x0F) as usize) * 4;
+    let tcp_off = ETH_HLEN + ihl;
+    skb.skb_copy_bits(tcp_off as u32, &mut hdr[tcp_off..tcp_off + 20], 20);
+    let doff = ((hdr[tcp_off + 12] >> 4) as usize) * 4;
+    let hdr_len = tcp_off + doff;
+    if ihl < 20 || doff < 20 || hdr_len as u32 > skb.len {
+        skb.free();
+        return Err(());
+    }
+    skb.skb_copy_bits(0, &mut hdr[..hdr_len], hdr_len as u32);
+
+    let mss = skb.gso_size as usize;
+    let payload = skb.len as usize - hdr_len;
+    let id = u16::from_be_bytes([hdr[ETH_HLEN + 4], hdr[ETH_HLEN + 5]]);
+    let seq = u32::from_be_bytes([hdr[tcp_off + 4], hdr[tcp_off + 5], hdr[tcp_off + 6], hdr[tcp_off + 7]]);
+    let saddr = u32::from_be_bytes([hdr[ETH_HLEN + 12], hdr[ETH_HLEN + 13], hdr[ETH_HLEN + 14], hdr[ETH_HLEN + 15]]);
+    let daddr = u32::from_be_bytes([hdr[ETH_HLEN + 16], hdr[ETH_HLEN + 17], hdr[ETH_HLEN + 18], hdr[ETH_HLEN + 19]]);
+    let flags = hdr[tcp_off + 13];
+    let sw_csum = features & NETIF_F_HW_CSUM == 0;
+
+    let mut segs = Vec::with_capacity((payload + mss - 1) / mss);
+    let mut offset = 0;
+    while offset < payload {
+        let seg_len = core::cmp::min(mss, payload - offset);
+        let last = offset + seg_len == payload;
+        let (mut seg, base) = match gso_alloc_seg(hdr_len + seg_len, &mut segs) {
+            Some(seg) => seg,
+            None => {
+                skb.free();
+                return Err(());
+            }
+        };
+        let frame = unsafe { core::slice::from_raw_parts_mut(base, hdr_len + seg_len) };
+        frame[..hdr_len].copy_from_slice(&hdr[..hdr_len]);
+        let payload_sum = if sw_csum {
+            skb.skb_copy_and_csum_bits((hdr_len + offset) as u32, &mut frame[hdr_len..], seg_len as u32, 0).1
+        } else {
+            skb.skb_copy_bits((hdr_len + offset) as u32, &mut frame[hdr_len..], seg_len as u32);
+            0
+        };
+
+        // IP：总长度、标识、头部校验和
+        let ip = &mut frame[ETH_HLEN..tcp_off];
+        ip[2..4].copy_from_slice(&((ihl + doff + seg_len) as u16).to_be_bytes());
+        ip[4..6].copy_from_slice(&id.wrapping_add(segs.len() as u16).to_be_bytes());
+        ip[10..12].copy_from_slice(&[0, 0]);
+        let ip_check = checksum::ip_checksum(ip);
+        ip[10..12].copy_from_slice(&ip_check.to_be_bytes());
+
+        // TCP：序列号；FIN/PSH 只留给最后一段，CWR 只留给第一段
+        let tcp = &mut frame[tcp_off..];
+        tcp[4..8].copy_from_slice(&seq.wrapping_add(offset as u32).to_be_bytes());
+        let mut seg_flags = flags;
+        if !last {
+            seg_flags &= !(TCPHDR_FIN | TCPHDR_PSH);
+        }
+        if offset != 0 {
+            seg_flags &= !TCPHDR_CWR;
+        }
+        tcp[13] = seg_flags;
+        let pseudo = checksum::csum_tcpudp_nofold(saddr, daddr, (doff + seg_len) as u32, 6);
+        if sw_csum {
+            // 数据部分的和已在复制时算出，只需再加上 TCP 头部
+            tcp[16..18].copy_from_slice(&[0, 0]);
+            let sum = checksum::csum_partial(&tcp[..doff], pseudo);
+            let sum = checksum::csum_block_add(sum, payload_sum, doff);
+            tcp[16..18].copy_from_slice(&checksum::csum_fold(sum).to_be_bytes());
+        } else {
+            tcp[16..18].copy_from_slice(&(!checksum::csum_fold(pseudo)).to_be_bytes());
+        }
+
+        seg.protocol = skb.protocol;
+        if !sw_csum {
+            seg.set_csum_partial(unsafe { base.add(tcp_off) }, TCP_CSUM_OFFSET);
+        }
+        segs.push(seg);
+        offset += seg_len;
+    }
+
+    skb.free();
+    Ok(segs)
+}
+
+/// 按设备特性处理待发送的包 (validate_xmit_skb)
+///
+/// # 参数
+/// - `skb`: 待发送的包
+/// - `features`: 设备特性，见 netdev_features
+///
+/// # 返回
+/// 可以直接交给设备的包；设备不支持 TSO 时为切分后的各帧，UDP 超长包总是切分
+pub fn validate_xmit_skb(skb: SkBuff, features: u32) -> Result<Vec<SkBuff>, ()> {
+    let need_segment = skb.gso_type & SKB_GSO_UDP_L4 != 0 || features & NETIF_F_TSO == 0;
+    let mut segs = if skb.is_gso() && need_segment {
+        skb_gso_segment(skb, features)?
+    } else {
+        alloc::vec![skb]
+    };
+
+    if features & NETIF_F_HW_CSUM == 0 {
+        let failed = segs
+            .iter_mut()
+            .any(|seg| seg.ip_summed == CHECKSUM_PARTIAL && seg.skb_checksum_help().is_err());
+        if failed {
+            for seg in segs {
+                seg.free();
+            }
+            return Err(());
+        }
+    }
+    Ok(segs)
+}
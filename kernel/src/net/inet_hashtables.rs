@@ -0,0 +1,278 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 套接字查找哈希表
+//!
+//! 收到的报文按地址与端口在哈希表中查找所属的 socket：TCP 已建立的连接按四元组，
+//! 监听 socket 与 UDP 按 (本地地址, 端口)。每包查找为 O(1)，与连接数无关。
+//!
+//! 参考: net/ipv4/inet_hashtables.c, include/net/inet_hashtables.h, include/linux/jhash.h
+//!
+//! # 设计
+//! - 每个桶一把锁，不同桶上的查找与插入互不阻塞
+//! - 桶数组在条目数超过桶数的 INET_HASH_LOAD_FACTOR 倍时加倍；查找只持有表的读锁，
+//!   只有扩容时才取写锁
+//! - 哈希带随机种子（第一次建表时取自时钟），对端无法构造大量落入同一个桶的连接
+//! - 多个 SO_REUSEPORT 监听 socket 以同一个键插入，查找时按四元组哈希选择其中一个，
+//!   同一条连接的报文总是落到同一个监听 socket
+//! - socket 不记录本地地址，四元组中的本地地址视为本机唯一的地址，不参与匹配
+
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU32, AtomicUsize, Ordering};
+use spin::{Mutex, RwLock};
+
+/// 初始桶数
+const INET_HASH_INITIAL_BUCKETS: usize = 64;
+
+/// 最大桶数
+const INET_HASH_MAX_BUCKETS: usize = 1 << 16;
+
+/// 平均每桶条目数超过它时扩容
+const INET_HASH_LOAD_FACTOR: usize = 2;
+
+/// 任意本地地址 (INADDR_ANY)
+pub const INADDR_ANY: u32 = 0;
+
+/// jhash 的初始值 (JHASH_INITVAL)
+const JHASH_INITVAL: u32 = 0xdeadbeef;
+
+/// 哈希种子，0 表示尚未初始化 (inet_ehash_secret)
+static INET_HASH_SECRET: AtomicU32 = AtomicU32::new(0);
+
+/// 三个 32 位字的 Jenkins 哈希 (jhash_3words)
+pub fn jhash_3words(a: u32, b: u32, c: u32, initval: u32) -> u32 {
+    let init = JHASH_INITVAL.wrapping_add(3 << 2).wrapping_add(initval);
+    let mut a = a.wrapping_add(init);
+    let mut b = b.wrapping_add(init);
+    let mut c = c.wrapping_add(init);
+    // __jhash_final
+    c ^= b; c = c.wrapping_sub(b.rotate_left(14));
+    a ^= c; a = a.wrapping_sub(c.rotate_left(11));
+    b ^= a; b = b.wrapping_sub(a.rotate_left(25));
+    c ^= b; c = c.wrapping_sub(b.rotate_left(16));
+    a ^= c; a = a.wrapping_sub(c.rotate_left(4));
+    b ^= a; b = b.wrapping_sub(a.rotate_left(14));
+    c ^= b; c = c.wrapping_sub(b.rotate_left(24));
+    c
+}
+
+/// 取哈希种子，第一次使用时生成 (net_get_random_once)
+pub(crate) fn inet_hash_secret() -> u32 {
+    let secret = INET_HASH_SECRET.load(Ordering::Relaxed);
+    if secret != 0 {
+        return secret;
+    }
+    let t = crate::drivers::timer::read_time();
+    let seed = jhash_3words(t as u32, (t >> 32) as u32, 0x9e3779b9, 0).max(1);
+    match INET_HASH_SECRET.compare_exchange(0, seed, Ordering::Relaxed, Ordering::Relaxed) {
+        Ok(_) => seed,
+        Err(current) => current,
+    }
+}
+
+/// 哈希表的查找键
+pub trait InetHashKey: Copy + Eq {
+    /// 计算带种子的哈希值
+    fn hash(&self, secret: u32) -> u32;
+}
+
+/// 已建立连接的查找键：对端地址、对端端口、本地端口 (inet_ehashfn)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct InetEhashKey {
+    /// 对端地址（主机字节序）
+    pub faddr: u32,
+    /// 对端端口
+    pub fport: u16,
+    /// 本地端口
+    pub lport: u16,
+}
+
+impl InetHashKey for InetEhashKey {
+    #[inline]
+    fn hash(&self, secret: u32) -> u32 {
+        jhash_3words(self.faddr, ((self.lport as u32) << 16) | self.fport as u32, 0, secret)
+    }
+}
+
+/// 按本地地址与端口查找的键，地址为 INADDR_ANY 表示绑定所有地址 (inet_lhashfn)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct InetBindKey {
+    /// 本地地址（主机字节序）
+    pub addr: u32,
+    /// 本地端口
+    pub port: u16,
+}
+
+impl InetHashKey for InetBindKey {
+    #[inline]
+    fn hash(&self, secret: u32) -> u32 {
+        jhash_3words(self.addr, self.port as u32, 1, secret)
+    }
+}
+
+/// 带桶锁、可扩容的哈希表 (inet_hashinfo)
+///
+/// 值通常是 socket 的句柄（文件描述符或连接编号），调用者自己解析
+pub struct InetHashTable<K: InetHashKey, V: Copy + PartialEq> {
+    /// 哈希桶，个数为 2 的幂
+    buckets: RwLock<Vec<Mutex<Vec<(K, V)>>>>,
+    /// 条目数
+    count: AtomicUsize,
+}
+
+impl<K: InetHashKey, V: Copy + PartialEq> InetHashTable<K, V> {
+    /// 创建空表，桶数组在第一次插入时建立
+    pub const fn new() -> Self {
+        Self {
+            buckets: RwLock::new(Vec::new()),
+            count: AtomicUsize::new(0),
+        }
+    }
+
+    /// 条目数
+    pub fn len(&self) -> usize {
+        self.count.load(Ordering::Relaxed)
+    }
+
+    /// 当前桶数
+    pub fn nr_buckets(&self) -> usize {
+        self.buckets.read().len()
+    }
+
+    #[inline]
+    fn bucket_index(key: &K, nr_buckets: usize) -> usize {
+        (key.hash(inet_hash_secret()) as usize) & (nr_buckets - 1)
+    }
+
+    /// 桶数组加倍，或在第一次使用时建立
+    fn grow(&self) {
+        let mut buckets = self.buckets.write();
+        let old_len = buckets.len();
+        let count = self.count.load(Ordering::Relaxed);
+        // 其他 CPU 可能已经扩容
+        if old_len != 0 && (count <= old_len * INET_HASH_LOAD_FACTOR || old_len >= INET_HASH_MAX_BUCKETS) {
+            return;
+        }
+        let new_len = if old_len == 0 { INET_HASH_INITIAL_BUCKETS } else { old_len * 2 };
+
+        let mut new_buckets: Vec<Mutex<Vec<(K, V)>>> = Vec::with_capacity(new_len);
+        new_buckets.resize_with(new_len, || Mutex::new(Vec::new()));
+        for old in buckets.drain(..) {
+            for (key, value) in old.into_inner() {
+                new_buckets[Self::bucket_index(&key, new_len)].get_mut().push((key, value));
+            }
+        }
+        *buckets = new_buckets;
+    }
+
+    /// 条目数超过负载时扩容
+    fn maybe_grow(&self) {
+        let count = self.count.load(Ordering::Relaxed);
+        let nr_buckets = self.nr_buckets();
+        if nr_buckets == 0 || (count > nr_buckets * INET_HASH_LOAD_FACTOR && nr_buckets < INET_HASH_MAX_BUCKETS) {
+            self.grow();
+        }
+    }
+
+    /// 插入一个条目 (__inet_hash)
+    ///
+    /// 同一个键可以对应多个值，查找返回最早插入的
+    pub fn insert(&self, key: K, value: V) {
+        self.maybe_grow();
+        let buckets = self.buckets.read();
+        let idx = Self::bucket_index(&key, buckets.len());
+        buckets[idx].lock().push((key, value));
+        self.count.fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// 键不存在时插入，检查与插入在同一把桶锁下完成 (inet_csk_get_port 的冲突检查)
+    ///
+    /// # 返回
+    /// 键已存在时不插入，返回 false
+    pub fn insert_unique(&self, key: K, value: V) -> bool {
+        self.maybe_grow();
+        let buckets = self.buckets.read();
+        let idx = Self::bucket_index(&key, buckets.len());
+        let mut bucket = buckets[idx].lock();
+        if bucket.iter().any(|(k, _)| *k == key) {
+            return false;
+        }
+        bucket.push((key, value));
+        self.count.fetch_add(1, Ordering::Relaxed);
+        true
+    }
+
+    /// 删除键与值都匹配的条目 (inet_unhash)
+    ///
+    /// # 返回
+    /// 找到并删除时返回 true
+    pub fn remove(&self, key: &K, value: V) -> bool {
+        let buckets = self.buckets.read();
+        if buckets.is_empty() {
+            return false;
+        }
+        let mut bucket = buckets[Self::bucket_index(key, buckets.len())].lock();
+        match bucket.iter().position(|(k, v)| k == key && *v == value) {
+            Some(pos) => {
+                bucket.remove(pos);
+                self.count.fetch_sub(1, Ordering::Relaxed);
+                true
+            }
+            None => false,
+        }
+    }
+
+    /// 查找键对应的值
+    pub fn lookup(&self, key: &K) -> Option<V> {
+        let buckets = self.buckets.read();
+        if buckets.is_empty() {
+            return None;
+        }
+        let bucket = buckets[Self::bucket_index(key, buckets.len())].lock();
+        bucket.iter().find(|(k, _)| k == key).map(|&(_, v)| v)
+    }
+
+    /// 同一个键对应多个值时按哈希值选择其中一个 (reuseport_select_sock)
+    ///
+    /// 值按插入顺序编号，取 hash 按比例缩放到 [0, n) 后的那一个 (reciprocal_scale)；
+    /// 只有一个值时与 lookup 相同
+    pub fn lookup_select(&self, key: &K, hash: u32) -> Option<V> {
+        let buckets = self.buckets.read();
+        if buckets.is_empty() {
+            return None;
+        }
+        let bucket = buckets[Self::bucket_index(key, buckets.len())].lock();
+        let n = bucket.iter().filter(|(k, _)| k == key).count();
+        if n == 0 {
+            return None;
+        }
+        let pick = ((hash as u64 * n as u64) >> 32) as usize;
+        bucket.iter().filter(|(k, _)| k == key).nth(pick).map(|&(_, v)| v)
+    }
+}
+
+/// 四元组的带种子哈希值，用于在 SO_REUSEPORT 组中选择监听 socket (inet_ehashfn)
+pub fn inet_ehashfn(key: &InetEhashKey) -> u32 {
+    key.hash(inet_hash_secret())
+}
+
+/// 按本地地址查找绑定项：先精确匹配，再匹配 INADDR_ANY (inet_lhash2_lookup)
+pub fn inet_lookup_bound<V: Copy + PartialEq>(table: &InetHashTable<InetBindKey, V>, addr: u32, port: u16) -> Option<V> {
+    table
+        .lookup(&InetBindKey { addr, port })
+        .or_else(|| table.lookup(&InetBindKey { addr: INADDR_ANY, port }))
+}
+
+/// 查找监听 socket：与 inet_lookup_bound 相同的匹配顺序，同一地址上有多个监听 socket
+/// (SO_REUSEPORT) 时按四元组的哈希值选择其中一个 (inet_lhash2_lookup + lookup_reuseport)
+pub fn inet_lookup_listener<V: Copy + PartialEq>(
+    table: &InetHashTable<InetBindKey, V>,
+    addr: u32,
+    port: u16,
+    hash: u32,
+) -> Option<V> {
+    table
+        .lookup_select(&InetBindKey { addr, port }, hash)
+        .or_else(|| table.lookup_select(&InetBindKey { addr: INADDR_ANY, port }, hash))
+}
@@ -17,21 +17,193 @@
 /// # 说明
 /// RFC 1071 定义的 Internet 校验和算法
 pub fn ip_checksum(data: &[u8]) -> u16 {
-    let mut sum: u32 = 0;
+    csum_fold(csum_partial(data, 0))
+}
+
+/// 使用向量扩展的最小长度；更短的数据设置向量单元的开销大于收益
+pub const CSUM_RVV_MIN_LEN: usize = 256;
+
+/// 累加数据的部分和，不取反 (csum_partial)
+///
+/// # 参数
+/// - `data`: 数据，奇数长度时最后一个字节作为高字节
+/// - `sum`: 之前的部分和
+///
+/// # 返回
+/// 32 位部分和，可继续累加
+///
+/// # 说明
+/// 较长的数据在 CPU 支持向量扩展时用 RVV 累加，否则按 64 位字累加
+pub fn csum_partial(data: &[u8], sum: u32) -> u32 {
+    #[cfg(feature = "riscv64")]
+    {
+        if data.len() >= CSUM_RVV_MIN_LEN && crate::arch::riscv64::cpu::has_vector() {
+            return unsafe { csum_partial_rvv(data, sum) };
+        }
+    }
+    csum_partial_64(data, sum)
+}
+
+/// 逐个 16 位字累加的参考实现
+///
+/// 用于验证与基准比较，语义与 csum_partial 相同
+pub fn csum_partial_ref(data: &[u8], sum: u32) -> u32 {
+    let mut sum = sum as u64;
 
     // 按 16 位字累加
     let mut i = 0;
     while i < data.len() {
         // 处理最后一个字节 (如果长度为奇数)
         if i + 1 == data.len() {
-            sum += (data[i] as u32) << 8;
+            sum += (data[i] as u64) << 8;
         } else {
-            let word = u16::from_be_bytes([data[i], data[i + 1]]) as u32;
+            let word = u16::from_be_bytes([data[i], data[i + 1]]) as u64;
             sum += word;
         }
         i += 2;
     }
 
+    // 折叠到 32 位
+    while sum >> 32 != 0 {
+        sum = (sum & 0xFFFF_FFFF) + (sum >> 32);
+    }
+    sum as u32
+}
+
+/// 按 64 位字累加的部分和 (do_csum)
+///
+/// 按小端读取，每个 16 位字的高低字节与网络字节序相反，
+/// 折叠后交换一次字节即可；进位加回最低位
+pub fn csum_partial_64(data: &[u8], sum: u32) -> u32 {
+    csum_from_le(do_csum(data), sum)
+}
+
+/// 使用 RISC-V 向量扩展累加的部分和
+///
+/// # Safety
+/// 调用者需确认 `has_vector()` 为真
+#[cfg(feature = "riscv64")]
+pub unsafe fn csum_partial_rvv(data: &[u8], sum: u32) -> u32 {
+    let words = data.len() / 4;
+    let mut acc: u64 = 0;
+    if words > 0 {
+        let state = crate::arch::riscv64::cpu::kernel_vector_begin();
+        // 每轮取 vl 个 32 位字，零扩展累加到 64 位累加器 v16-v17；
+        // tu 保证最后一轮较短时不破坏尾部累加器；内核其余代码不使用向量寄存器
+        core::arch::asm!(
+            ".option push",
+            ".option arch, +v",
+            "vsetvli {vl}, zero, e64, m2, ta, ma",
+            "vmv.v.i v16, 0",
+            "2:",
+            "vsetvli {vl}, {n}, e32, m1, tu, ma",
+            "vle32.v v8, ({p})",
+            "vwaddu.wv v16, v16, v8",
+            "sub {n}, {n}, {vl}",
+            "slli {vl}, {vl}, 2",
+            "add {p}, {p}, {vl}",
+            "bnez {n}, 2b",
+            "vsetvli {vl}, zero, e64, m2, ta, ma",
+            "vmv.s.x v24, zero",
+            "vredsum.vs v24, v16, v24",
+            "vmv.x.s {acc}, v24",
+            ".option pop",
+            vl = out(reg) _,
+            n = inout(reg) words => _,
+            p = inout(reg) data.as_ptr() => _,
+            acc = out(reg) acc,
+            options(readonly, nostack),
+        );
+        crate::arch::riscv64::cpu::kernel_vector_end(state);
+    }
+    // 剩余不足 4 字节的部分起点为偶数，可直接累加
+    let acc = add_carry64(acc, do_csum(&data[words * 4..]));
+    csum_from_le(acc, sum)
+}
+
+/// 复制数据并计算部分和 (csum_partial_copy_nocheck)
+///
+/// # 参数
+/// - `src`: 源数据
+/// - `dst`: 目标缓冲区，复制 min(src.len(), dst.len()) 字节
+/// - `sum`: 之前的部分和
+///
+/// # 返回
+/// 已复制数据的部分和；每个字只读一次，比先复制再计算少一遍访存
+pub fn csum_partial_copy(src: &[u8], dst: &mut [u8], sum: u32) -> u32 {
+    let len = core::cmp::min(src.len(), dst.len());
+    let mut acc: u64 = 0;
+    let mut i = 0;
+    while i + 8 <= len {
+        unsafe {
+            let w = core::ptr::read_unaligned(src.as_ptr().add(i) as *const u64);
+            core::ptr::write_unaligned(dst.as_mut_ptr().add(i) as *mut u64, w);
+            acc = add_carry64(acc, u64::from_le(w));
+        }
+        i += 8;
+    }
+    dst[i..len].copy_from_slice(&src[i..len]);
+    acc = add_carry64(acc, do_csum(&src[i..len]));
+    csum_from_le(acc, sum)
+}
+
+/// 累加两个部分和 (csum_add)
+#[inline]
+pub fn csum_add(sum: u32, addend: u32) -> u32 {
+    let (res, carry) = sum.overflowing_add(addend);
+    res + carry as u32
+}
+
+/// 累加从 offset 开始的一段数据的部分和 (csum_block_add)
+///
+/// 奇数偏移处开始的数据，其字节在 16 位字中的位置相反，需先循环移位
+#[inline]
+pub fn csum_block_add(sum: u32, sum2: u32, offset: usize) -> u32 {
+    let sum2 = if offset & 1 != 0 { sum2.rotate_right(8) } else { sum2 };
+    csum_add(sum, sum2)
+}
+
+/// 带进位回卷的 64 位加法
+#[inline]
+fn add_carry64(a: u64, b: u64) -> u64 {
+    let (res, carry) = a.overflowing_add(b);
+    res + carry as u64
+}
+
+/// 按小端 64 位字累加，尾部不足 8 字节时补零
+fn do_csum(data: &[u8]) -> u64 {
+    let mut acc: u64 = 0;
+    let chunks = data.len() / 8;
+    let ptr = data.as_ptr() as *const u64;
+    for i in 0..chunks {
+        let w = unsafe { core::ptr::read_unaligned(ptr.add(i)) };
+        acc = add_carry64(acc, u64::from_le(w));
+    }
+    let tail = &data[chunks * 8..];
+    if !tail.is_empty() {
+        let mut buf = [0u8; 8];
+        buf[..tail.len()].copy_from_slice(tail);
+        acc = add_carry64(acc, u64::from_le_bytes(buf));
+    }
+    acc
+}
+
+/// 把小端累加结果折叠为 16 位并换回网络字节序，再与 sum 合并
+#[inline]
+fn csum_from_le(acc: u64, sum: u32) -> u32 {
+    let mut acc = (acc & 0xFFFF_FFFF) + (acc >> 32);
+    acc = (acc & 0xFFFF_FFFF) + (acc >> 32);
+    let mut folded = (acc & 0xFFFF) + (acc >> 16);
+    folded = (folded & 0xFFFF) + (folded >> 16);
+    csum_add(sum, (folded as u16).swap_bytes() as u32)
+}
+
+/// 折叠部分和并取反 (csum_fold)
+///
+/// # 返回
+/// 校验和 (主机字节序)
+pub fn csum_fold(sum: u32) -> u16 {
+    let mut sum = sum;
     // 处理进位
     while sum >> 16 != 0 {
         sum = (sum & 0xFFFF) + (sum >> 16);
@@ -41,6 +213,22 @@ pub fn ip_checksum(data: &[u8]) -> u16 {
     !sum as u16
 }
 
+/// TCP/UDP 伪头部的部分和 (csum_tcpudp_nofold)
+///
+/// # 参数
+/// - `saddr`/`daddr`: IP 地址（主机字节序）
+/// - `len`: TCP/UDP 头部加数据的长度
+/// - `protocol`: 协议号
+pub fn csum_tcpudp_nofold(saddr: u32, daddr: u32, len: u32, protocol: u8) -> u32 {
+    let sum = (saddr >> 16) as u64
+        + (saddr & 0xFFFF) as u64
+        + (daddr >> 16) as u64
+        + (daddr & 0xFFFF) as u64
+        + protocol as u64
+        + len as u64;
+    ((sum & 0xFFFF_FFFF) + (sum >> 32)) as u32
+}
+
 /// 验证 IP 校验和
 ///
 /// # 参数
@@ -0,0 +1,274 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 路径压缩的前缀树（最长前缀匹配）
+//!
+//! 每个节点对应一个前缀 (key/plen)，只在前缀出现分叉或挂有路由的位置建节点，
+//! 单分支的中间层被压缩掉。查找从根向下最多经过 33 个节点，与路由条数无关。
+//!
+//! 参考: net/ipv4/fib_trie.c
+//!
+//! # 设计
+//! - 节点放在数组中，子节点用下标引用，删除的节点进入空闲链表复用
+//! - 根节点是 /0，默认路由挂在根上
+//! - 不变式：子节点的前缀以父节点的前缀开头，且比父节点长；位于父节点前缀之后的
+//!   第一个比特决定它是哪个子节点
+//! - 删除路由后，没有路由且少于两个子节点的中间节点被合并，树的形状只取决于现有路由
+
+use alloc::vec::Vec;
+
+/// 空的子节点下标
+const NIL: u32 = u32::MAX;
+
+/// 根节点下标
+const ROOT: u32 = 0;
+
+/// 前缀树节点 (key_vector)
+struct TrieNode<V: Copy> {
+    /// 前缀，plen 之后的比特为 0
+    key: u32,
+    /// 前缀长度 0..=32
+    plen: u8,
+    /// 挂在这个前缀上的值
+    value: Option<V>,
+    /// 前缀之后下一个比特为 0 / 1 的子节点
+    child: [u32; 2],
+}
+
+impl<V: Copy> TrieNode<V> {
+    const fn new(key: u32, plen: u8, value: Option<V>) -> Self {
+        Self { key, plen, value, child: [NIL, NIL] }
+    }
+
+    /// 子节点个数
+    fn nr_children(&self) -> usize {
+        self.child.iter().filter(|&&c| c != NIL).count()
+    }
+}
+
+/// 前缀长度对应的掩码
+#[inline]
+pub fn prefix_mask(plen: u8) -> u32 {
+    if plen == 0 { 0 } else { u32::MAX << (32 - plen as u32) }
+}
+
+/// 第 pos 个比特（从最高位数起），pos < 32
+#[inline]
+fn bit_at(key: u32, pos: u8) -> usize {
+    ((key >> (31 - pos as u32)) & 1) as usize
+}
+
+/// 路径压缩的前缀树 (trie)
+pub struct FibTrie<V: Copy> {
+    /// 节点数组，下标 0 是根
+    nodes: Vec<TrieNode<V>>,
+    /// 可复用的节点下标
+    free: Vec<u32>,
+    /// 值的个数
+    count: usize,
+}
+
+impl<V: Copy> FibTrie<V> {
+    /// 创建空树，根节点在第一次插入时建立
+    pub const fn new() -> Self {
+        Self { nodes: Vec::new(), free: Vec::new(), count: 0 }
+    }
+
+    /// 值的个数
+    pub fn len(&self) -> usize {
+        self.count
+    }
+
+    /// 使用中的节点数（含根与分叉节点）
+    pub fn nr_nodes(&self) -> usize {
+        self.nodes.len() - self.free.len()
+    }
+
+    /// 清空
+    pub fn clear(&mut self) {
+        self.nodes.clear();
+        self.free.clear();
+        self.count = 0;
+    }
+
+    fn alloc_node(&mut self, node: TrieNode<V>) -> u32 {
+        match self.free.pop() {
+            Some(idx) => {
+                self.nodes[idx as usize] = node;
+                idx
+            }
+            None => {
+                self.nodes.push(node);
+                (self.nodes.len() - 1) as u32
+            }
+        }
+    }
+
+    fn free_node(&mut self, idx: u32) {
+        self.nodes[idx as usize].value = None;
+        self.nodes[idx as usize].child = [NIL, NIL];
+        self.free.push(idx);
+    }
+
+    /// 插入前缀，已存在时替换 (fib_insert_node)
+    ///
+    /// # 参数
+    /// - `key`: 前缀，plen 之后的比特被忽略
+    /// - `plen`: 前缀长度 0..=32
+    ///
+    /// # 返回
+    /// 被替换的旧值
+    pub fn insert(&mut self, key: u32, plen: u8, value: V) -> Option<V> {
+        let plen = core::cmp::min(plen, 32);
+        let key = key & prefix_mask(plen);
+        if self.nodes.is_empty() {
+            self.nodes.push(TrieNode::new(0, 0, None));
+        }
+
+        let mut cur = ROOT;
+        loop {
+            let node = &self.nodes[cur as usize];
+            if node.plen == plen {
+                let old = self.nodes[cur as usize].value.replace(value);
+                if old.is_none() {
+                    self.count += 1;
+                }
+                return old;
+            }
+            let bit = bit_at(key, node.plen);
+            let c = node.child[bit];
+            if c == NIL {
+                let leaf = self.alloc_node(TrieNode::new(key, plen, Some(value)));
+                self.nodes[cur as usize].child[bit] = leaf;
+                self.count += 1;
+                return None;
+            }
+
+            let (child_key, child_plen) = (self.nodes[c as usize].key, self.nodes[c as usize].plen);
+            let diff = (key ^ child_key).leading_zeros() as u8;
+            let common = core::cmp::min(diff, core::cmp::min(plen, child_plen));
+            if common == child_plen {
+                // 子节点的前缀覆盖新前缀，继续向下
+                cur = c;
+                continue;
+            }
+
+            let new_idx = if common == plen {
+                // 新前缀是子节点的祖先，插在两者之间
+                let mut node = TrieNode::new(key, plen, Some(value));
+                node.child[bit_at(child_key, plen)] = c;
+                self.alloc_node(node)
+            } else {
+                // 在公共前缀处分叉
+                let leaf = self.alloc_node(TrieNode::new(key, plen, Some(value)));
+                let mut mid = TrieNode::new(key & prefix_mask(common), common, None);
+                mid.child[bit_at(key, common)] = leaf;
+                mid.child[bit_at(child_key, common)] = c;
+                self.alloc_node(mid)
+            };
+            self.nodes[cur as usize].child[bit] = new_idx;
+            self.count += 1;
+            return None;
+        }
+    }
+
+    /// 删除前缀 (fib_remove_alias + trie_rebalance)
+    ///
+    /// # 返回
+    /// 被删除的值
+    pub fn remove(&mut self, key: u32, plen: u8) -> Option<V> {
+        let plen = core::cmp::min(plen, 32);
+        let key = key & prefix_mask(plen);
+        if self.nodes.is_empty() {
+            return None;
+        }
+
+        // 记录从根到目标节点的路径，合并节点时需要修改父节点
+        let mut path = [NIL; 34];
+        let mut depth = 0;
+        let mut cur = ROOT;
+        loop {
+            path[depth] = cur;
+            depth += 1;
+            let node = &self.nodes[cur as usize];
+            if node.plen == plen {
+                if node.key != key {
+                    return None;
+                }
+                break;
+            }
+            let c = node.child[bit_at(key, node.plen)];
+            if c == NIL {
+                return None;
+            }
+            let child = &self.nodes[c as usize];
+            if child.plen > plen || (key ^ child.key) & prefix_mask(child.plen) != 0 {
+                return None;
+            }
+            cur = c;
+        }
+
+        let old = self.nodes[cur as usize].value.take()?;
+        self.count -= 1;
+
+        // 自下而上合并没有值、少于两个子节点的节点（根节点保留）
+        while depth > 1 {
+            let idx = path[depth - 1];
+            let parent = path[depth - 2];
+            let node = &self.nodes[idx as usize];
+            if node.value.is_some() || node.nr_children() == 2 {
+                break;
+            }
+            // 唯一的子节点（或 NIL）接替它在父节点中的位置
+            let replacement = if node.child[0] == NIL { node.child[1] } else { node.child[0] };
+            let slot = bit_at(self.nodes[idx as usize].key, self.nodes[parent as usize].plen);
+            self.nodes[parent as usize].child[slot] = replacement;
+            self.free_node(idx);
+            depth -= 1;
+        }
+        Some(old)
+    }
+
+    /// 最长前缀匹配 (fib_table_lookup)
+    pub fn lookup(&self, addr: u32) -> Option<V> {
+        let first = self.nodes.first()?;
+        let mut best = first.value;
+        let mut node = first;
+        while node.plen < 32 {
+            let c = node.child[bit_at(addr, node.plen)];
+            if c == NIL {
+                break;
+            }
+            let child = &self.nodes[c as usize];
+            if (addr ^ child.key) & prefix_mask(child.plen) != 0 {
+                break;
+            }
+            if child.value.is_some() {
+                best = child.value;
+            }
+            node = child;
+        }
+        best
+    }
+
+    /// 精确查找前缀
+    pub fn get(&self, key: u32, plen: u8) -> Option<V> {
+        let plen = core::cmp::min(plen, 32);
+        let key = key & prefix_mask(plen);
+        let mut node = self.nodes.first()?;
+        loop {
+            if node.plen == plen {
+                return if node.key == key { node.value } else { None };
+            }
+            let c = node.child[bit_at(key, node.plen)];
+            if c == NIL {
+                return None;
+            }
+            node = &self.nodes[c as usize];
+            if node.plen > plen || (key ^ node.key) & prefix_mask(node.plen) != 0 {
+                return None;
+            }
+        }
+    }
+}
@@ -0,0 +1,84 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! ICMP 协议
+//!
+//! 参考: net/ipv4/icmp.c (icmp_unreach), net/ipv4/tcp_ipv4.c (tcp_v4_err)
+//!
+//! 只处理目标不可达中的"需要分片" (ICMP_FRAG_NEEDED)：按其中的下一跳 MTU 降低
+//! 原报文目标地址的路径 MTU，并通知发出原报文的 TCP 连接缩小报文段。
+//! UDP 不需要通知，之后的数据报按新的路径 MTU 决定是否分片。其他类型的报文忽略
+
+use crate::net::buffer::SkBuff;
+use super::{checksum, inet_addr_is_local, route, IPHDR_LEN, IPPROTO_TCP};
+
+/// ICMP 头部长度
+pub const ICMP_HLEN: usize = 8;
+
+/// 目标不可达 (ICMP_DEST_UNREACH)
+pub const ICMP_DEST_UNREACH: u8 = 3;
+
+/// 目标不可达的代码：需要分片但设置了 DF (ICMP_FRAG_NEEDED)
+pub const ICMP_FRAG_NEEDED: u8 = 4;
+
+/// 差错报文至少携带原报文的 IP 头和传输层的前 8 字节 (RFC 792)
+const ICMP_ERR_MIN_LEN: usize = ICMP_HLEN + IPHDR_LEN + 8;
+
+/// 接收 ICMP 报文 (icmp_rcv)
+///
+/// # 参数
+/// - `skb`: 以 IP 头开始的报文
+/// - `offset`: ICMP 头在 skb 中的偏移
+/// - `len`: ICMP 报文长度
+///
+/// # 返回
+/// 报文过短或校验和错误时返回 Err(())
+pub fn icmp_rcv(skb: &SkBuff, offset: u32, len: u32) -> Result<(), ()> {
+    if (len as usize) < ICMP_HLEN || offset + len > skb.len {
+        return Err(());
+    }
+    // 差错报文只携带原报文的开头，整个复制出来校验
+    let mut msg = alloc::vec![0u8; len as usize];
+    skb.skb_copy_bits(offset, &mut msg, len);
+    if checksum::ip_checksum(&msg) != 0 {
+        return Err(());
+    }
+
+    if msg[0] == ICMP_DEST_UNREACH && msg[1] == ICMP_FRAG_NEEDED {
+        if msg.len() < ICMP_ERR_MIN_LEN {
+            return Err(());
+        }
+        let mtu = u16::from_be_bytes([msg[6], msg[7]]) as u32;
+        icmp_frag_needed(&msg[ICMP_HLEN..], mtu);
+    }
+    Ok(())
+}
+
+/// 处理"需要分片" (icmp_unreach + ipv4_update_pmtu)
+///
+/// # 参数
+/// - `inner`: 被丢弃的原报文的开头
+/// - `mtu`: 下一跳 MTU
+fn icmp_frag_needed(inner: &[u8], mtu: u32) {
+    let ihl = ((inner[0] & 0x0F) as usize) * 4;
+    if inner[0] >> 4 != 4 || ihl < IPHDR_LEN || inner.len() < ihl + 8 {
+        return;
+    }
+    let saddr = u32::from_be_bytes([inner[12], inner[13], inner[14], inner[15]]);
+    let daddr = u32::from_be_bytes([inner[16], inner[17], inner[18], inner[19]]);
+    // 只接受本机发出的报文引起的差错
+    if !inet_addr_is_local(saddr) {
+        return;
+    }
+
+    route::ip_rt_update_pmtu(daddr, mtu);
+    if inner[9] == IPPROTO_TCP {
+        let l4 = &inner[ihl..];
+        let sport = u16::from_be_bytes([l4[0], l4[1]]);
+        let dport = u16::from_be_bytes([l4[2], l4[3]]);
+        let seq = u32::from_be_bytes([l4[4], l4[5], l4[6], l4[7]]);
+        // 路径 MTU 可能之前已经降低，按当前值同步连接的 MSS
+        crate::net::tcp::tcp_v4_mtu_reduced(daddr, sport, dport, seq, route::ip_dst_mtu(daddr));
+    }
+}
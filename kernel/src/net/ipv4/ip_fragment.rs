@@ -0,0 +1,416 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! IPv4 分片重组
+//!
+//! 参考: net/ipv4/ip_fragment.c, net/ipv4/inet_fragment.c
+//!
+//! 同一数据报的分片按 (源地址, 目标地址, 标识, 协议) 归入一个重组队列，
+//! 队列按四元组的带种子哈希分桶。分片到齐后拼成一个完整的数据报交给上层协议。
+//!
+//! # 限制
+//! - 队列在第一个分片到达后 IPFRAG_TIME 内未完成即丢弃 (ip_expire)；
+//!   超时检查在分片到达时进行，每个 jiffy 最多扫描一次
+//! - 所有队列占用的内存超过 IPFRAG_HIGH_THRESH 时，从最早的队列开始丢弃，
+//!   直到低于 IPFRAG_LOW_THRESH (inet_frag_evictor)
+//! - 与已有分片重叠但不完全相同的分片使整个队列作废 (RFC 5722，IPFRAG_OVERLAP)；
+//!   完全相同的重复分片直接忽略
+
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU64, Ordering};
+use spin::Mutex;
+
+use super::{ip_frag_flags, IpHdr, IPHDR_LEN, IP_MAX_MTU};
+use crate::drivers::timer::{get_jiffies, HZ};
+use crate::net::buffer::SkBuff;
+use crate::net::inet_hashtables::{inet_hash_secret, jhash_3words};
+
+/// 重组队列的哈希桶数 (INETFRAGS_HASHSZ)
+const IPQ_HASHSZ: usize = 64;
+
+/// 队列的存活时间 (ipfrag_time)
+pub const IPFRAG_TIME: u64 = 30 * HZ;
+
+/// 开始丢弃队列的内存上限 (ipfrag_high_thresh)
+pub const IPFRAG_HIGH_THRESH: usize = 4 * 1024 * 1024;
+
+/// 丢弃到这个内存量为止 (ipfrag_low_thresh)
+pub const IPFRAG_LOW_THRESH: usize = 3 * 1024 * 1024;
+
+/// 每个分片在数据之外计入的开销，使大量小分片同样受内存上限约束 (skb->truesize)
+const IPFRAG_OVERHEAD: usize = 64;
+
+/// 重组队列的键
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+struct IpFragKey {
+    saddr: u32,
+    daddr: u32,
+    id: u16,
+    protocol: u8,
+}
+
+impl IpFragKey {
+    /// 所在的哈希桶 (ipqhashfn)
+    fn bucket(&self) -> usize {
+        let c = ((self.id as u32) << 16) | self.protocol as u32;
+        (jhash_3words(self.saddr, self.daddr, c, inet_hash_secret()) as usize) & (IPQ_HASHSZ - 1)
+    }
+}
+
+/// 一个数据报的重组队列 (struct ipq)
+struct IpFragQueue {
+    key: IpFragKey,
+    /// 已收到的分片：(数据偏移, 数据)，按偏移排列、互不重叠
+    frags: Vec<(u32, Vec<u8>)>,
+    /// 偏移为 0 的分片的 IP 头（含选项），未收到时为空
+    header: Vec<u8>,
+    /// 数据报的数据长度，收到最后一个分片 (MF = 0) 之前为 0
+    len: u32,
+    /// 已收到的数据字节数 (meat)
+    meat: u32,
+    /// 占用的内存
+    mem: usize,
+    /// 队列创建的时刻，超时与淘汰都以此为准
+    created: u64,
+}
+
+impl IpFragQueue {
+    fn new(key: IpFragKey, now: u64) -> Self {
+        Self { key, frags: Vec::new(), header: Vec::new(), len: 0, meat: 0, mem: 0, created: now }
+    }
+
+    /// 已收到的分片中最大的结束偏移
+    fn max_end(&self) -> u32 {
+        self.frags.last().map_or(0, |(off, data)| off + data.len() as u32)
+    }
+
+    /// 所有分片都已到达
+    fn complete(&self) -> bool {
+        self.len != 0 && self.meat == self.len && !self.header.is_empty()
+    }
+}
+
+/// 分片插入的结果
+enum FragInsert {
+    /// 新分片已加入
+    Added,
+    /// 与已有分片完全相同，忽略
+    Duplicate,
+    /// 与已有分片部分重叠，或与已知的总长度矛盾，整个队列作废
+    Invalid,
+}
+
+/// 所有重组队列
+struct IpFragTable {
+    buckets: [Vec<IpFragQueue>; IPQ_HASHSZ],
+    /// 所有队列占用的内存 (fqdir->mem)
+    mem: usize,
+    /// 队列数
+    nqueues: usize,
+    /// 上次扫描超时队列的时刻
+    last_expire: u64,
+}
+
+/// 重组与分片的统计 (IPSTATS_MIB_REASM* / IPSTATS_MIB_FRAG*)
+pub(crate) struct IpFragMib {
+    pub(crate) reasm_timeout: AtomicU64,
+    pub(crate) reasm_reqds: AtomicU64,
+    pub(crate) reasm_oks: AtomicU64,
+    pub(crate) reasm_fails: AtomicU64,
+    pub(crate) reasm_overlaps: AtomicU64,
+    pub(crate) frag_oks: AtomicU64,
+    pub(crate) frag_fails: AtomicU64,
+    pub(crate) frag_creates: AtomicU64,
+}
+
+pub(crate) static IPFRAG_MIB: IpFragMib = IpFragMib {
+    reasm_timeout: AtomicU64::new(0),
+    reasm_reqds: AtomicU64::new(0),
+    reasm_oks: AtomicU64::new(0),
+    reasm_fails: AtomicU64::new(0),
+    reasm_overlaps: AtomicU64::new(0),
+    frag_oks: AtomicU64::new(0),
+    frag_fails: AtomicU64::new(0),
+    frag_creates: AtomicU64::new(0),
+};
+
+/// 统计的快照
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct IpFragStats {
+    /// 超时丢弃的队列数
+    pub reasm_timeout: u64,
+    /// 收到的需要重组的分片数
+    pub reasm_reqds: u64,
+    /// 重组成功的数据报数
+    pub reasm_oks: u64,
+    /// 重组失败（超时、淘汰、分片错误）的次数
+    pub reasm_fails: u64,
+    /// 因分片重叠作废的队列数
+    pub reasm_overlaps: u64,
+    /// 分片发送成功的数据报数
+    pub frag_oks: u64,
+    /// 需要分片但不能分片 (DF) 或分片失败的数据报数
+    pub frag_fails: u64,
+    /// 发送的分片数
+    pub frag_creates: u64,
+}
+
+/// 读取重组与分片的统计
+pub fn ip_frag_stats() -> IpFragStats {
+    let m = &IPFRAG_MIB;
+    IpFragStats {
+        reasm_timeout: m.reasm_timeout.load(Ordering::Relaxed),
+        reasm_reqds: m.reasm_reqds.load(Ordering::Relaxed),
+        reasm_oks: m.reasm_oks.load(Ordering::Relaxed),
+        reasm_fails: m.reasm_fails.load(Ordering::Relaxed),
+        reasm_overlaps: m.reasm_overlaps.load(Ordering::Relaxed),
+        frag_oks: m.frag_oks.load(Ordering::Relaxed),
+        frag_fails: m.frag_fails.load(Ordering::Relaxed),
+        frag_creates: m.frag_creates.load(Ordering::Relaxed),
+    }
+}
+
+#[inline]
+fn mib_inc(counter: &AtomicU64) {
+    counter.fetch_add(1, Ordering::Relaxed);
+}
+
+/// 接收路径在 NAPI 的中断上下文中运行，进程上下文持锁时必须关中断
+static IPQ_TABLE: Mutex<IpFragTable> = Mutex::new(IpFragTable {
+    buckets: [const { Vec::new() }; IPQ_HASHSZ],
+    mem: 0,
+    nqueues: 0,
+    last_expire: 0,
+});
+
+fn with_ipq_lock<R>(f: impl FnOnce(&mut IpFragTable) -> R) -> R {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let mut table = IPQ_TABLE.lock();
+    f(&mut table)
+}
+
+impl IpFragTable {
+    /// 从桶中取出一个队列并扣除它的内存
+    fn unlink(&mut self, bucket: usize, index: usize) -> IpFragQueue {
+        let q = self.buckets[bucket].swap_remove(index);
+        self.mem -= q.mem;
+        self.nqueues -= 1;
+        q
+    }
+
+    /// 丢弃 now 时已超时的队列 (ip_expire)
+    fn expire(&mut self, now: u64) -> usize {
+        let mut expired = 0;
+        for bucket in 0..IPQ_HASHSZ {
+            let mut i = 0;
+            while i < self.buckets[bucket].len() {
+                if now.saturating_sub(self.buckets[bucket][i].created) >= IPFRAG_TIME {
+                    self.unlink(bucket, i);
+                    mib_inc(&IPFRAG_MIB.reasm_timeout);
+                    mib_inc(&IPFRAG_MIB.reasm_fails);
+                    expired += 1;
+                } else {
+                    i += 1;
+                }
+            }
+        }
+        self.last_expire = now;
+        expired
+    }
+
+    /// 内存超过上限时从最早的队列开始丢弃，直到低于下限 (inet_frag_evictor)
+    fn evict(&mut self) {
+        if self.mem <= IPFRAG_HIGH_THRESH {
+            return;
+        }
+        while self.mem > IPFRAG_LOW_THRESH {
+            let oldest = (0..IPQ_HASHSZ)
+                .flat_map(|b| self.buckets[b].iter().enumerate().map(move |(i, q)| (q.created, b, i)))
+                .min();
+            match oldest {
+                Some((_, bucket, index)) => {
+                    self.unlink(bucket, index);
+                    mib_inc(&IPFRAG_MIB.reasm_fails);
+                }
+                None => break,
+            }
+        }
+    }
+}
+
+/// 把分片加入队列 (ip_frag_queue)
+///
+/// # 参数
+/// - `offset`: 数据在数据报中的偏移
+/// - `last`: 最后一个分片 (MF = 0)
+fn ip_frag_queue(q: &mut IpFragQueue, offset: u32, data: Vec<u8>, last: bool) -> FragInsert {
+    let end = offset + data.len() as u32;
+    if last {
+        // 最后一个分片确定总长度，不能短于已收到的数据，也不能与之前的最后一个分片矛盾
+        if end < q.max_end() || (q.len != 0 && q.len != end) {
+            return FragInsert::Invalid;
+        }
+        q.len = end;
+    } else if q.len != 0 && end > q.len {
+        return FragInsert::Invalid;
+    }
+
+    let pos = q.frags.partition_point(|(off, _)| *off < offset);
+    if let Some((off, prev)) = q.frags.get(pos) {
+        if *off == offset && prev.len() == data.len() {
+            return FragInsert::Duplicate;
+        }
+        if *off < end {
+            return FragInsert::Invalid;
+        }
+    }
+    if pos > 0 {
+        let (off, prev) = &q.frags[pos - 1];
+        if off + prev.len() as u32 > offset {
+            return FragInsert::Invalid;
+        }
+    }
+
+    q.meat += data.len() as u32;
+    q.mem += data.len() + IPFRAG_OVERHEAD;
+    q.frags.insert(pos, (offset, data));
+    FragInsert::Added
+}
+
+/// 把到齐的分片拼成一个数据报 (ip_frag_reasm)
+///
+/// 首个分片的 IP 头放在前面，总长度、分片字段与校验和按完整的数据报重写
+fn ip_frag_reasm(q: &IpFragQueue) -> Option<SkBuff> {
+    let ihl = q.header.len() as u32;
+    let mut skb = SkBuff::alloc(ihl + q.len)?;
+    let built = skb.skb_put_data(&q.header).and_then(|()| {
+        q.frags.iter().try_for_each(|(_, data)| skb.skb_put_data(data))
+    });
+    if built.is_err() {
+        skb.free();
+        return None;
+    }
+    unsafe {
+        let ip_hdr = &mut *(skb.data as *mut IpHdr);
+        ip_hdr.tot_len = ((ihl + q.len) as u16).to_be();
+        ip_hdr.frag_off = 0;
+        ip_hdr.check = 0;
+        let hdr_bytes = core::slice::from_raw_parts(skb.data, ihl as usize);
+        ip_hdr.check = super::checksum::ip_checksum(hdr_bytes).to_be();
+    }
+    Some(skb)
+}
+
+/// 处理一个分片 (ip_defrag)
+///
+/// # 参数
+/// - `skb`: 以 IP 头开始的分片，由调用者释放
+/// - `ihl`: IP 头长度
+/// - `tot_len`: IP 总长度
+///
+/// # 返回
+/// 数据报的分片到齐时返回重组后的数据报，以 IP 头开始，由调用者释放；否则返回 None
+pub fn ip_defrag(skb: &SkBuff, ihl: u32, tot_len: u32) -> Option<SkBuff> {
+    mib_inc(&IPFRAG_MIB.reasm_reqds);
+    let mut hdr = [0u8; IPHDR_LEN];
+    skb.skb_copy_bits(0, &mut hdr, IPHDR_LEN as u32);
+    let ip_hdr = IpHdr::from_bytes(&hdr)?;
+    let frag_off = u16::from_be(ip_hdr.frag_off);
+    let offset = ((frag_off & ip_frag_flags::OFFSET_MASK) as u32) * 8;
+    let more = frag_off & ip_frag_flags::MF != 0;
+    let plen = tot_len - ihl;
+
+    // 中间分片的长度必须是 8 的倍数，重组后的数据报不能超过 IP 总长度的上限
+    if plen == 0 || (more && plen % 8 != 0) || ihl + offset + plen > IP_MAX_MTU as u32 {
+        mib_inc(&IPFRAG_MIB.reasm_fails);
+        return None;
+    }
+
+    let key = IpFragKey {
+        saddr: u32::from_be(ip_hdr.saddr),
+        daddr: u32::from_be(ip_hdr.daddr),
+        id: u16::from_be(ip_hdr.id),
+        protocol: ip_hdr.protocol,
+    };
+    // 复制在持锁之外进行
+    let mut data = alloc::vec![0u8; plen as usize];
+    skb.skb_copy_bits(ihl, &mut data, plen);
+    let mut header = Vec::new();
+    if offset == 0 {
+        header = alloc::vec![0u8; ihl as usize];
+        skb.skb_copy_bits(0, &mut header, ihl);
+    }
+
+    let now = get_jiffies();
+    let done = with_ipq_lock(|table| {
+        if now != table.last_expire {
+            table.expire(now);
+        }
+        let bucket = key.bucket();
+        let index = match table.buckets[bucket].iter().position(|q| q.key == key) {
+            Some(index) => index,
+            None => {
+                table.evict();
+                table.buckets[bucket].push(IpFragQueue::new(key, now));
+                table.nqueues += 1;
+                table.buckets[bucket].len() - 1
+            }
+        };
+
+        let q = &mut table.buckets[bucket][index];
+        let before = q.mem;
+        match ip_frag_queue(q, offset, data, !more) {
+            FragInsert::Added => {}
+            FragInsert::Duplicate => return None,
+            FragInsert::Invalid => {
+                table.unlink(bucket, index);
+                mib_inc(&IPFRAG_MIB.reasm_overlaps);
+                mib_inc(&IPFRAG_MIB.reasm_fails);
+                return None;
+            }
+        }
+        if offset == 0 {
+            q.header = header;
+        }
+        let grown = q.mem - before;
+        table.mem += grown;
+        if !table.buckets[bucket][index].complete() {
+            return None;
+        }
+        Some(table.unlink(bucket, index))
+    })?;
+
+    // 拼接在持锁之外进行
+    match ip_frag_reasm(&done) {
+        Some(full) => {
+            mib_inc(&IPFRAG_MIB.reasm_oks);
+            Some(full)
+        }
+        None => {
+            mib_inc(&IPFRAG_MIB.reasm_fails);
+            None
+        }
+    }
+}
+
+/// 丢弃 now 时已超时的队列，返回丢弃的队列数
+pub fn ip_frag_expire(now: u64) -> usize {
+    with_ipq_lock(|table| table.expire(now))
+}
+
+/// 重组队列数与占用的内存 (ip_frag_mem)
+pub fn ip_frag_mem() -> (usize, usize) {
+    with_ipq_lock(|table| (table.nqueues, table.mem))
+}
+
+/// /proc/net/snmp 中 Ip 一行的分片相关字段 (snmp_seq_show_ipstats)
+pub fn ip_frag_snmp() -> alloc::string::String {
+    let s = ip_frag_stats();
+    alloc::format!(
+        "Ip: ReasmTimeout ReasmReqds ReasmOKs ReasmFails ReasmOverlaps FragOKs FragFails FragCreates\n\
+         Ip: {} {} {} {} {} {} {} {}\n",
+        s.reasm_timeout, s.reasm_reqds, s.reasm_oks, s.reasm_fails, s.reasm_overlaps,
+        s.frag_oks, s.frag_fails, s.frag_creates,
+    )
+}
@@ -5,9 +5,20 @@
 //! IPv4 协议
 //!
 //! 完全...
+//!
+//! # 分片与路径 MTU
+//! - TCP 报文段总是带 DF，按路径 MTU 确定 MSS；UDP 数据报不超过路径 MTU 时带 DF，
+//!   更大的数据报在发送时分片 (IP_PMTUDISC_WANT)
+//! - ICMP "需要分片" 降低路径 MTU（见 route.rs），之后的报文按新值发送
+//! - 收到的分片在 ip_fragment.rs 中重组后再交给上层协议
 
+pub mod fib_trie;
 pub mod route;
 pub mod checksum;
+pub mod ip_fragment;
+pub mod icmp;
+
+use core::sync::atomic::{AtomicU16, Ordering};
 
 use crate::net::buffer::SkBuff;
 use crate::net::ethernet::ETH_ALEN;
@@ -24,9 +35,40 @@ pub const IP_MIN_MTU: u16 = 68;
 /// IPv4 最大 MTU
 pub const IP_MAX_MTU: u16 = 65535;
 
+/// 本机地址（主机字节序；简化实现：使用固定值 192.168.1.100）
+pub const INADDR_LOCAL: u32 = 0xC0A80164;
+
+/// 回环网络 127.0.0.0/8 (IN_LOOPBACKNET)
+pub const IN_LOOPBACKNET: u8 = 127;
+
+/// 地址是否属于本机：本机地址或回环网络 (inet_addr_type == RTN_LOCAL)
+#[inline]
+pub fn inet_addr_is_local(addr: u32) -> bool {
+    addr == INADDR_LOCAL || (addr >> 24) as u8 == IN_LOOPBACKNET
+}
+
 /// IPv4 默认 TTL (使用配置值)
 pub use crate::config::IP_DEFAULT_TTL;
 
+/// 协议号 (IPPROTO_*)
+pub const IPPROTO_ICMP: u8 = 1;
+pub const IPPROTO_TCP: u8 = 6;
+pub const IPPROTO_UDP: u8 = 17;
+
+/// 分片时在 IP 头前为链路层头预留的空间 (LL_RESERVED_SPACE)
+const LL_RESERVED_SPACE: u32 = 16;
+
+/// 不带 DF 的报文的标识，同一数据报的分片共用一个值 (ip_idents)
+static IP_IDENT: AtomicU16 = AtomicU16::new(1);
+
+/// 为可能被分片的报文选择标识 (ip_select_ident)
+///
+/// 带 DF 的报文不会被分片，标识为 0 (RFC 6864)
+#[inline]
+fn ip_select_ident() -> u16 {
+    IP_IDENT.fetch_add(1, Ordering::Relaxed)
+}
+
 /// IPv4 分片标志常量
 pub mod ip_frag_flags {
     /// 保留位
@@ -211,6 +253,35 @@ pub fn ip_pull_header(skb: &mut SkBuff) -> Option<&'static IpHdr> {
 /// # 返回
 /// 成功返回 Ok(())，失败返回 Err(())
 pub fn ipv4_send(mut skb: SkBuff, dest_ip: u32, protocol: u8) -> Result<(), ()> {
+    let saddr = INADDR_LOCAL;
+
+    // TCP 与 UDP GSO 的每个报文段都不超过路径 MTU，总是带 DF；
+    // 其他报文不超过路径 MTU 时带 DF，否则在 ip_output 中分片 (ip_dont_fragment)
+    let df = protocol == IPPROTO_TCP
+        || skb.is_gso()
+        || IPHDR_LEN as u32 + skb.len <= route::ip_dst_mtu(dest_ip);
+
+    // TCP/UDP 校验和只填伪头部，余下交给设备或发送前的软件补齐 (CHECKSUM_PARTIAL)
+    let csum_offset = match protocol {
+        6 => Some(crate::net::gso::TCP_CSUM_OFFSET),
+        17 => Some(crate::net::gso::UDP_CSUM_OFFSET),
+        _ => None,
+    };
+    if let Some(offset) = csum_offset {
+        if skb.skb_headlen() < offset as u32 + 2 {
+            return Err(());
+        }
+        let pseudo = checksum::csum_tcpudp_nofold(saddr, dest_ip, skb.len, protocol);
+        unsafe {
+            core::ptr::write_unaligned(
+                skb.data.add(offset as usize) as *mut u16,
+                (!checksum::csum_fold(pseudo)).to_be(),
+            );
+        }
+        let start = skb.data;
+        skb.set_csum_partial(start, offset);
+    }
+
     // 为 IP 头部预留空间
     let ip_ptr = skb.skb_push(IPHDR_LEN as u32).ok_or(())?;
 
@@ -226,11 +297,14 @@ pub fn ipv4_send(mut skb: SkBuff, dest_ip: u32, protocol: u8) -> Result<(), ()>
         // 总长度（IP 头 + 数据）
         ip_hdr.tot_len = ((IPHDR_LEN + skb.len as usize) as u16).to_be();
 
-        // ID（标识符）
-        ip_hdr.id = 0;
-
-        // 标志和分片偏移
-        ip_hdr.frag_off = 0;
+        // ID（标识符）与标志
+        if df {
+            ip_hdr.id = 0;
+            ip_hdr.frag_off = ip_frag_flags::DF.to_be();
+        } else {
+            ip_hdr.id = ip_select_ident().to_be();
+            ip_hdr.frag_off = 0;
+        }
 
         // TTL
         ip_hdr.ttl = IP_DEFAULT_TTL;
@@ -238,8 +312,8 @@ pub fn ipv4_send(mut skb: SkBuff, dest_ip: u32, protocol: u8) -> Result<(), ()>
         // 协议
         ip_hdr.protocol = protocol;
 
-        // 源 IP（简化实现：使用固定值）
-        ip_hdr.saddr = 0xC0A80164; // 192.168.1.100
+        // 源 IP
+        ip_hdr.saddr = saddr.to_be();
 
         // 目标 IP
         ip_hdr.daddr = dest_ip.to_be();
@@ -269,11 +343,112 @@ pub fn ipv4_send(mut skb: SkBuff, dest_ip: u32, protocol: u8) -> Result<(), ()>
 /// # 返回
 /// 成功返回 Ok(())，失败返回 Err(())
 pub fn ip_output(skb: SkBuff) -> Result<(), ()> {
-    // TODO: 查找路由
-    // TODO: 分片处理
+    if (skb.len as usize) < IPHDR_LEN {
+        skb.free();
+        return Err(());
+    }
+    let daddr = unsafe { u32::from_be(core::ptr::read_unaligned(core::ptr::addr_of!((*(skb.data as *const IpHdr)).daddr))) };
+    let frag_off = unsafe { u16::from_be(core::ptr::read_unaligned(core::ptr::addr_of!((*(skb.data as *const IpHdr)).frag_off))) };
+
+    // 发往本机：不经过 ARP 与以太网，直接投递 (RTN_LOCAL 经 loopback)
+    if inet_addr_is_local(daddr) {
+        return match crate::drivers::net::loopback::loopback_xmit_local(skb) {
+            0 => Ok(()),
+            _ => Err(()),
+        };
+    }
 
-    // 简化实现：直接发送到以太网层
-    crate::net::ethernet::ethernet_send(skb)
+    // 下一跳：经网关的路由发往网关，否则直接发往目标 (rt_nexthop)
+    let next_hop = match route::route_lookup(daddr) {
+        Some(rt) if rt.is_gateway() => rt.gateway,
+        _ => daddr,
+    };
+
+    // 超长包的每个报文段由 GSO 按 MSS 切分，不按整包检查 (skb_gso_validate_network_len)
+    let mtu = route::ip_dst_mtu(daddr);
+    if skb.len > mtu && !skb.is_gso() {
+        if frag_off & ip_frag_flags::DF != 0 {
+            // 路径 MTU 在报文组装之后降低：丢弃，由上层按新的 MTU 重发
+            ip_fragment::IPFRAG_MIB.frag_fails.fetch_add(1, Ordering::Relaxed);
+            skb.free();
+            return Err(());
+        }
+        return ip_fragment_output(skb, mtu, next_hop);
+    }
+    crate::net::arp::arp_output(skb, next_hop)
+}
+
+/// 把超过 MTU 的报文切成分片逐个发送 (ip_do_fragment)
+///
+/// 每个分片复制原报文的 IP 头，数据长度是 8 的倍数（最后一个除外）；
+/// 传输层校验和覆盖整个数据报，分片前先用软件算完
+///
+/// # 参数
+/// - `skb`: 以 IP 头开始、不带 DF 的报文，由本函数释放
+/// - `mtu`: 每个分片的最大长度（含 IP 头）
+/// - `next_hop`: 下一跳地址
+fn ip_fragment_output(mut skb: SkBuff, mtu: u32, next_hop: u32) -> Result<(), ()> {
+    let mib = &ip_fragment::IPFRAG_MIB;
+    let ihl = ((unsafe { *skb.data } & 0x0F) as u32) * 4;
+    let chunk = mtu.saturating_sub(ihl) & !7;
+    if ihl < IPHDR_LEN as u32 || chunk == 0 || skb.skb_checksum_help().is_err() {
+        mib.frag_fails.fetch_add(1, Ordering::Relaxed);
+        skb.free();
+        return Err(());
+    }
+    let mut header = [0u8; 60];
+    skb.skb_copy_bits(0, &mut header[..ihl as usize], ihl);
+    let payload = skb.len - ihl;
+
+    let mut offset = 0;
+    let mut ret = Ok(());
+    while offset < payload {
+        let len = core::cmp::min(chunk, payload - offset);
+        let last = offset + len == payload;
+        let mut frag = match SkBuff::alloc(LL_RESERVED_SPACE + ihl + len) {
+            Some(frag) => frag,
+            None => {
+                ret = Err(());
+                break;
+            }
+        };
+        let built = frag.skb_reserve(LL_RESERVED_SPACE).is_some()
+            && frag.skb_put_data(&header[..ihl as usize]).is_ok()
+            && match frag.skb_put(len) {
+                Some(ptr) => {
+                    let dst = unsafe { core::slice::from_raw_parts_mut(ptr, len as usize) };
+                    skb.skb_copy_bits(ihl + offset, dst, len) == len
+                }
+                None => false,
+            };
+        if !built {
+            frag.free();
+            ret = Err(());
+            break;
+        }
+        unsafe {
+            let ip_hdr = &mut *(frag.data as *mut IpHdr);
+            ip_hdr.tot_len = ((ihl + len) as u16).to_be();
+            let mf = if last { 0 } else { ip_frag_flags::MF };
+            ip_hdr.frag_off = ((offset / 8) as u16 | mf).to_be();
+            ip_hdr.check = 0;
+            let hdr_bytes = core::slice::from_raw_parts(frag.data, ihl as usize);
+            ip_hdr.check = checksum::ip_checksum(hdr_bytes).to_be();
+        }
+        mib.frag_creates.fetch_add(1, Ordering::Relaxed);
+        if crate::net::arp::arp_output(frag, next_hop).is_err() {
+            ret = Err(());
+            break;
+        }
+        offset += len;
+    }
+    skb.free();
+
+    match ret {
+        Ok(()) => mib.frag_oks.fetch_add(1, Ordering::Relaxed),
+        Err(()) => mib.frag_fails.fetch_add(1, Ordering::Relaxed),
+    };
+    ret
 }
 
 /// 接收并处理 IPv4 数据包
@@ -307,29 +482,44 @@ pub fn ip_rcv(skb: &SkBuff) -> Result<(), ()> {
     // TODO: 检查目标 IP 是否为本机
     // 简化实现：接受所有数据包
 
-    // 根据 protocol 分发到上层协议
-    match ip_hdr.protocol {
-        6 => {
-            // TCP 协议 (IPPROTO_TCP = 6)
-            // 从 IP 头部获取目标端口
-            // 注意：需要解析 TCP 头部才能知道目标端口
-            // 这里简化处理，直接传递给 TCP 层
-            // crate::net::tcp::tcp_rcv(skb, src_ip, dest_ip);
+    // 传输层长度按 IP 总长度计算，去掉以太网最小帧的填充
+    let ihl = ((ip_hdr.version_ihl & 0x0F) as u32) * 4;
+    let tot_len = u16::from_be(ip_hdr.tot_len) as u32;
+    if ihl < IPHDR_LEN as u32 || tot_len < ihl || tot_len > skb.len {
+        return Ok(());
+    }
+
+    // 分片先重组，到齐后完整的数据报再交给上层协议 (ip_local_deliver)
+    let frag_off = u16::from_be(ip_hdr.frag_off);
+    if frag_off & (ip_frag_flags::MF | ip_frag_flags::OFFSET_MASK) != 0 {
+        if let Some(full) = ip_fragment::ip_defrag(skb, ihl, tot_len) {
+            let full_len = full.len;
+            ip_local_deliver_finish(&full, ip_hdr.protocol, src_ip, dest_ip, ihl, full_len);
+            full.free();
         }
-        17 => {
-            // UDP 协议 (IPPROTO_UDP = 17)
-            // crate::net::udp::udp_rcv(skb, src_ip, dest_ip);
+        return Ok(());
+    }
+    ip_local_deliver_finish(skb, ip_hdr.protocol, src_ip, dest_ip, ihl, tot_len);
+
+    Ok(())
+}
+
+/// 根据 protocol 分发到上层协议 (ip_local_deliver_finish)
+fn ip_local_deliver_finish(skb: &SkBuff, protocol: u8, src_ip: u32, dest_ip: u32, ihl: u32, tot_len: u32) {
+    match protocol {
+        IPPROTO_TCP => {
+            let _ = crate::net::tcp::tcp_v4_rcv(skb, src_ip, dest_ip, ihl, tot_len - ihl);
         }
-        1 => {
-            // ICMP 协议 (IPPROTO_ICMP = 1)
-            // crate::net::icmp::icmp_rcv(skb, src_ip, dest_ip);
+        IPPROTO_UDP => {
+            let _ = crate::net::udp::udp_rcv(skb, src_ip, dest_ip, ihl, tot_len - ihl);
+        }
+        IPPROTO_ICMP => {
+            let _ = icmp::icmp_rcv(skb, ihl, tot_len - ihl);
         }
         _ => {
             // 不支持的协议
         }
     }
-
-    Ok(())
 }
 
 #[cfg(test)]
@@ -6,9 +6,35 @@
 //!
 //! 完全...
 //! 参考: net/ipv4/route.c, include/net/route.h
+//!
+//! 路由按前缀存放在路径压缩的前缀树中（见 fib_trie.rs），最长前缀匹配的代价与路由条数无关。
+//! 树前面是每 CPU 的目的地址缓存：已建立的流每个报文都命中缓存，不再查树。
+//! 路由表每次修改都递增代数 (rt_genid)，缓存项记录填入时的代数，代数不符即失效，
+//! 修改路由时不需要逐个 CPU 清缓存
+//!
+//! # 路径 MTU
+//! ICMP "需要分片" 报告的下一跳 MTU 按目标地址记为一条例外 (fib_nh_exception)，
+//! 有效期 IP_RT_MTU_EXPIRES。查表时路由的 MTU 取路由与例外中的较小值并带着到期时刻
+//! 填入缓存；记录例外时递增代数使缓存失效，缓存项到期后同样按未命中处理
+
+use alloc::collections::BTreeMap;
+use core::sync::atomic::{AtomicU32, Ordering};
+use crate::sync::RwLock;
 
 use crate::net::buffer::SkBuff;
-use crate::config::ROUTE_TABLE_SIZE;
+use crate::net::ipv4::fib_trie::FibTrie;
+use crate::config::{MAX_CPUS, ROUTE_CACHE_SIZE, ROUTE_TABLE_SIZE};
+use crate::drivers::timer::{get_jiffies, HZ};
+use crate::net::ethernet::ETH_DATA_LEN;
+
+/// 路径 MTU 的下限，ICMP 报告更小的值时按此值处理 (ip_rt_min_pmtu)
+pub const IP_RT_MIN_PMTU: u32 = 552;
+
+/// 学到的路径 MTU 的有效期，到期后重新按路由的 MTU 探测 (ip_rt_mtu_expires)
+pub const IP_RT_MTU_EXPIRES: u64 = 600 * HZ;
+
+/// 最多记录的路径 MTU 例外数，满时替换最早到期的一条 (FNHE_RECLAIM_DEPTH)
+const FNHE_MAX: usize = 256;
 
 /// 路由表条目
 ///
@@ -93,107 +119,283 @@ impl RouteEntry {
     }
 }
 
-/// 路由表
-///
-/// 简化实现：固定大小的路由表
+/// 路由表 (fib_table)
 struct RouteTable {
-    entries: [Option<RouteEntry>; ROUTE_TABLE_SIZE],
-    count: usize,
+    /// 按前缀组织的路由
+    trie: FibTrie<RouteEntry>,
 }
 
 impl RouteTable {
     const fn new() -> Self {
-        const NONE: Option<RouteEntry> = None;
-        Self {
-            entries: [NONE; ROUTE_TABLE_SIZE],
-            count: 0,
-        }
+        Self { trie: FibTrie::new() }
     }
 
-    /// 查找路由
+    /// 查找路由：最长前缀匹配
     fn lookup(&self, dst: u32) -> Option<RouteEntry> {
-        // 最长前缀匹配
-        let mut best_match: Option<RouteEntry> = None;
-        let mut best_mask = 0u32;
-
-        for entry in self.entries.iter() {
-            if let Some(route) = entry {
-                if route.matches(dst) && route.mask >= best_mask {
-                    best_match = Some(*route);
-                    best_mask = route.mask;
-                }
-            }
-        }
-
-        best_match
+        self.trie.lookup(dst)
     }
 
-    /// 添加路由
+    /// 添加路由；同一前缀已有路由时替换
+    ///
+    /// 掩码必须是连续的前缀掩码，路由数不超过 ROUTE_TABLE_SIZE
     fn add(&mut self, route: RouteEntry) -> Result<(), ()> {
-        if self.count >= ROUTE_TABLE_SIZE {
+        let plen = mask_to_plen(route.mask).ok_or(())?;
+        if self.trie.len() >= ROUTE_TABLE_SIZE && self.trie.get(route.dst, plen).is_none() {
             return Err(());
         }
-
-        self.entries[self.count] = Some(route);
-        self.count += 1;
+        self.trie.insert(route.dst, plen, route);
         Ok(())
     }
 
     /// 删除路由
     fn remove(&mut self, dst: u32, mask: u32) -> bool {
-        for i in 0..self.count {
-            if let Some(route) = self.entries[i] {
-                if route.dst == dst && route.mask == mask {
-                    // 移除条目
-                    for j in i..self.count - 1 {
-                        self.entries[j] = self.entries[j + 1];
-                    }
-                    self.entries[self.count - 1] = None;
-                    self.count -= 1;
-                    return true;
-                }
-            }
+        match mask_to_plen(mask) {
+            Some(plen) => self.trie.remove(dst, plen).is_some(),
+            None => false,
         }
-        false
     }
 
     /// 清空路由表
     fn clear(&mut self) {
-        self.count = 0;
-        for entry in self.entries.iter_mut() {
-            *entry = None;
-        }
+        self.trie.clear();
+    }
+}
+
+/// 掩码转换为前缀长度，不连续的掩码返回 None (inet_mask_len)
+fn mask_to_plen(mask: u32) -> Option<u8> {
+    let plen = mask.leading_ones();
+    if plen < 32 && mask << plen != 0 {
+        return None;
     }
+    Some(plen as u8)
 }
 
 /// 全局路由表
-static mut ROUTE_TABLE: RouteTable = RouteTable::new();
+static ROUTE_TABLE: RwLock<RouteTable> = RwLock::new(RouteTable::new());
+
+/// 路由表代数，每次修改递增；0 保留给空的缓存项 (rt_genid)
+static ROUTE_GENID: AtomicU32 = AtomicU32::new(1);
+
+/// 路由表已修改，所有 CPU 的缓存项随之失效 (rt_cache_flush)
+fn rt_cache_flush() {
+    let next = ROUTE_GENID.load(Ordering::Relaxed).wrapping_add(1).max(1);
+    ROUTE_GENID.store(next, Ordering::Release);
+}
+
+/// 目的地址缓存项 (dst_entry)
+#[derive(Clone, Copy)]
+struct DstCacheEntry {
+    /// 目标地址
+    daddr: u32,
+    /// 填入时的路由表代数，0 表示空
+    genid: u32,
+    /// 查表结果，没有路由时为 None（同样缓存）
+    route: Option<RouteEntry>,
+    /// 路由的 MTU 来自路径 MTU 例外时为例外的到期时刻，否则为 0
+    expires: u64,
+}
+
+/// 每 CPU 的目的地址缓存：按目标地址直接映射 (dst_cache)
+struct DstCacheCpu {
+    entries: [DstCacheEntry; ROUTE_CACHE_SIZE],
+    /// 命中次数
+    hits: u64,
+    /// 未命中（查树）次数
+    misses: u64,
+}
+
+/// 单个 CPU 的缓存统计
+#[derive(Debug, Clone, Copy, Default)]
+pub struct RouteCacheStats {
+    /// 命中次数
+    pub hits: u64,
+    /// 未命中次数
+    pub misses: u64,
+}
+
+impl DstCacheCpu {
+    const fn new() -> Self {
+        const EMPTY: DstCacheEntry = DstCacheEntry { daddr: 0, genid: 0, route: None, expires: 0 };
+        Self {
+            entries: [EMPTY; ROUTE_CACHE_SIZE],
+            hits: 0,
+            misses: 0,
+        }
+    }
+}
+
+static mut DST_CACHE: [DstCacheCpu; MAX_CPUS] = [const { DstCacheCpu::new() }; MAX_CPUS];
+
+/// 目标地址的路径 MTU 例外 (fib_nh_exception)
+#[derive(Debug, Clone, Copy)]
+struct PmtuException {
+    /// 路径 MTU (fnhe_pmtu)
+    pmtu: u32,
+    /// 到期时刻，jiffies (fnhe_expires)
+    expires: u64,
+}
+
+/// 按目标地址记录的路径 MTU 例外；只在关中断时访问
+static PMTU_EXCEPTIONS: RwLock<BTreeMap<u32, PmtuException>> = RwLock::new(BTreeMap::new());
+
+/// 查表并叠加路径 MTU 例外 (find_exception + rt_bind_exception)
+///
+/// # 返回
+/// (路由, 例外的到期时刻)，没有生效的例外时到期时刻为 0
+fn route_lookup_slow(dst: u32) -> (Option<RouteEntry>, u64) {
+    let mut route = ROUTE_TABLE.read().lookup(dst);
+    let mut expires = 0;
+    if let Some(rt) = route.as_mut() {
+        let now = get_jiffies();
+        match PMTU_EXCEPTIONS.read().get(&dst) {
+            Some(fnhe) if now < fnhe.expires => {
+                rt.mtu = route_entry_mtu(rt).min(fnhe.pmtu);
+                expires = fnhe.expires;
+            }
+            _ => {}
+        }
+    }
+    (route, expires)
+}
+
+/// 路由的 MTU，未指定时按以太网 MTU
+#[inline]
+fn route_entry_mtu(rt: &RouteEntry) -> u32 {
+    if rt.mtu != 0 { rt.mtu } else { ETH_DATA_LEN as u32 }
+}
+
+/// 目标地址在缓存中的槽位
+#[inline]
+fn dst_cache_slot(daddr: u32) -> usize {
+    (crate::net::inet_hashtables::jhash_3words(daddr, 0, 0, 0) as usize) & (ROUTE_CACHE_SIZE - 1)
+}
 
 /// 查找路由
 ///
+/// 先查当前 CPU 的缓存，未命中或代数过期时查路由表并填入缓存 (ip_route_output_key)
+///
 /// # 参数
 /// - `dst`: 目标 IP 地址 (主机字节序)
 ///
 /// # 返回
 /// 返回找到的路由条目，如果未找到则返回 None
 pub fn route_lookup(dst: u32) -> Option<RouteEntry> {
-    unsafe { ROUTE_TABLE.lookup(dst) }
+    // 先读代数再查表：查表期间路由被修改时，填入的缓存项带旧代数，下次即失效
+    let genid = ROUTE_GENID.load(Ordering::Acquire);
+    let slot = dst_cache_slot(dst);
+
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let cpu_id = crate::arch::cpu_id() as usize;
+    if cpu_id >= MAX_CPUS {
+        return route_lookup_slow(dst).0;
+    }
+    let cache = unsafe { &mut *core::ptr::addr_of_mut!(DST_CACHE[cpu_id]) };
+    let entry = cache.entries[slot];
+    if entry.genid == genid && entry.daddr == dst && (entry.expires == 0 || get_jiffies() < entry.expires) {
+        cache.hits += 1;
+        return entry.route;
+    }
+
+    cache.misses += 1;
+    let (route, expires) = route_lookup_slow(dst);
+    cache.entries[slot] = DstCacheEntry { daddr: dst, genid, route, expires };
+    route
+}
+
+/// 发往 daddr 的报文（含 IP 头）的最大长度 (dst_mtu)
+///
+/// 发往本机的报文经回环发送，不受限制；没有路由时按以太网 MTU
+pub fn ip_dst_mtu(daddr: u32) -> u32 {
+    if super::inet_addr_is_local(daddr) {
+        return super::IP_MAX_MTU as u32;
+    }
+    match route_lookup(daddr) {
+        Some(rt) => route_entry_mtu(&rt),
+        None => ETH_DATA_LEN as u32,
+    }
+}
+
+/// 按 ICMP "需要分片" 降低发往 daddr 的路径 MTU (__ip_rt_update_pmtu)
+///
+/// # 参数
+/// - `daddr`: 原报文的目标地址 (主机字节序)
+/// - `mtu`: ICMP 报告的下一跳 MTU；小于 IP_RT_MIN_PMTU（包括不报告 MTU 的旧路由器的 0）时
+///   按 IP_RT_MIN_PMTU 处理
+///
+/// # 返回
+/// 路径 MTU 降低时返回新值；不低于当前值时不记录，返回 None
+pub fn ip_rt_update_pmtu(daddr: u32, mtu: u32) -> Option<u32> {
+    if super::inet_addr_is_local(daddr) {
+        return None;
+    }
+    let old = ip_dst_mtu(daddr);
+    let mtu = if mtu < IP_RT_MIN_PMTU { old.min(IP_RT_MIN_PMTU) } else { mtu };
+    if mtu >= old {
+        return None;
+    }
+    let now = get_jiffies();
+    let fnhe = PmtuException { pmtu: mtu, expires: now + IP_RT_MTU_EXPIRES };
+    {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        let mut table = PMTU_EXCEPTIONS.write();
+        table.retain(|_, e| now < e.expires);
+        if table.len() >= FNHE_MAX && !table.contains_key(&daddr) {
+            // 替换最早到期的例外 (fnhe_oldest)
+            if let Some(oldest) = table.iter().min_by_key(|(_, e)| e.expires).map(|(&addr, _)| addr) {
+                table.remove(&oldest);
+            }
+        }
+        table.insert(daddr, fnhe);
+    }
+    rt_cache_flush();
+    Some(mtu)
+}
+
+/// 路径 MTU 例外的条数
+pub fn pmtu_exception_count() -> usize {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    PMTU_EXCEPTIONS.read().len()
+}
+
+/// 各 CPU 的缓存统计
+pub fn route_cache_stats() -> [RouteCacheStats; MAX_CPUS] {
+    let mut stats = [RouteCacheStats::default(); MAX_CPUS];
+    for (cpu_id, s) in stats.iter_mut().enumerate() {
+        let cache = unsafe { &*core::ptr::addr_of!(DST_CACHE[cpu_id]) };
+        s.hits = cache.hits;
+        s.misses = cache.misses;
+    }
+    stats
+}
+
+/// 路由条数
+pub fn route_count() -> usize {
+    ROUTE_TABLE.read().trie.len()
 }
 
 /// 添加路由
 ///
 /// # 参数
 /// - `dst`: 目标网络地址 (主机字节序)
-/// - `mask`: 网络掩码 (主机字节序)
+/// - `mask`: 网络掩码 (主机字节序)，必须连续
 /// - `gateway`: 网关地址 (主机字节序)
 /// - `oif`: 输出设备索引
 /// - `mtu`: MTU
 ///
 /// # 返回
-/// 成功返回 Ok(())，失败返回 Err(())
+/// 成功返回 Ok(())；掩码不连续或路由表已满返回 Err(())
 pub fn route_add(dst: u32, mask: u32, gateway: u32, oif: u32, mtu: u32) -> Result<(), ()> {
-    let route = RouteEntry::new(dst, mask, gateway, oif, mtu);
-    unsafe { ROUTE_TABLE.add(route) }
+    let mut route = RouteEntry::new(dst & mask, mask, gateway, oif, mtu);
+    route.flags.0 |= RouteFlags::RTF_UP;
+    if gateway != 0 {
+        route.flags.0 |= RouteFlags::RTF_GATEWAY;
+    }
+    if mask == u32::MAX {
+        route.flags.0 |= RouteFlags::RTF_HOST;
+    }
+    let ret = ROUTE_TABLE.write().add(route);
+    rt_cache_flush();
+    ret
 }
 
 /// 删除路由
@@ -205,12 +407,19 @@ pub fn route_add(dst: u32, mask: u32, gateway: u32, oif: u32, mtu: u32) -> Resul
 /// # 返回
 /// 是否成功删除
 pub fn route_remove(dst: u32, mask: u32) -> bool {
-    unsafe { ROUTE_TABLE.remove(dst, mask) }
+    let removed = ROUTE_TABLE.write().remove(dst, mask);
+    rt_cache_flush();
+    removed
 }
 
-/// 清空路由表
+/// 清空路由表与路径 MTU 例外
 pub fn route_clear() {
-    unsafe { ROUTE_TABLE.clear() }
+    ROUTE_TABLE.write().clear();
+    {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        PMTU_EXCEPTIONS.write().clear();
+    }
+    rt_cache_flush();
 }
 
 /// 初始化默认路由
@@ -244,19 +453,16 @@ pub fn route_init() {
 ///
 /// # 返回
 /// 成功返回 Ok(())，失败返回 Err(())
+///
+/// # 说明
+/// 下一跳与路径 MTU 由 ip_output 按同一路由确定：超过 MTU 的报文在允许时分片，
+/// 带 DF 时丢弃
 pub fn route_output(skb: SkBuff, dst: u32) -> Result<(), ()> {
-    // 查找路由
-    let route = route_lookup(dst).ok_or(())?;
-
-    // TODO: 根据路由发送数据包
-    // 1. 如果有网关，使用网关 MAC 地址
-    // 2. 如果没有网关，使用目标 IP 的 MAC 地址
-    // 3. 查找 ARP 缓存获取 MAC 地址
-    // 4. 调用设备发送函数
-
-    // 简化实现：直接释放数据包
-    skb.free();
-    Ok(())
+    if route_lookup(dst).is_none() && !super::inet_addr_is_local(dst) {
+        skb.free();
+        return Err(());
+    }
+    super::ip_output(skb)
 }
 
 #[cfg(test)]
@@ -280,9 +486,7 @@ mod tests {
 
     #[test]
     fn test_route_lookup() {
-        unsafe {
-            ROUTE_TABLE.clear();
-        }
+        route_clear();
 
         // 添加路由
         let _ = route_add(
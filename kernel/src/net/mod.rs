@@ -8,11 +8,27 @@
 //! 参考: net/
 
 pub mod buffer;
+pub mod skb_pool;
 pub mod ethernet;
 pub mod arp;
 pub mod ipv4;
+pub mod inet_hashtables;
 pub mod udp;
+pub mod unix;
 pub mod tcp;
+pub mod tcp_input;
+pub mod tcp_output;
+pub mod tcp_timer;
+pub mod tcp_rate;
+pub mod tcp_cong;
+pub mod tcp_cubic;
+pub mod tcp_bbr;
+pub mod syncookies;
+pub mod gso;
+pub mod gro;
+pub mod filter;
+pub mod xdp;
+pub mod busy_poll;
 
 pub use buffer::{
     SkBuff, PacketType, EthProtocol, IpProtocol,
@@ -0,0 +1,217 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! SkBuff 数据区的每 CPU 缓存
+//!
+//! 每个数据包都要分配和释放一次数据区，直接走堆分配器两次都要取全局锁。
+//! 这里为线性区不超过 SKB_DATA_SIZE 的 SkBuff 提供固定大小的数据区，
+//! 释放的数据区留在释放 CPU 的缓存中，接收补充时直接复用。
+//!
+//! 参考: net/core/skbuff.c (napi_alloc_cache, skb_free_head), mm/page_alloc.c (pcp)
+//!
+//! # 设计
+//! - 每个 CPU 一个缓存，与 Per-CPU Pages 相同，只由所属 CPU 在关中断状态下访问，
+//!   不需要锁，也不会被本 CPU 上的 NAPI 中断重入
+//! - 缓存满时释放回堆，缓存空时从堆分配；两者都计入统计，在 /proc/net/skb_pool 查看
+//! - 更大的数据放在页片段中（见 SkBuff::skb_append_pagefrags），不占用堆
+
+use alloc::format;
+use alloc::string::String;
+
+use crate::config::MAX_CPUS;
+
+/// 缓存的数据区大小：headroom + 以太网帧 + TCP 头部预留
+pub const SKB_DATA_SIZE: usize = 2048;
+
+/// 数据区对齐（缓存行）
+const SKB_DATA_ALIGN: usize = 64;
+
+/// 每个 CPU 最多缓存的数据区数
+const SKB_POOL_HIGH: usize = 128;
+
+/// 单个 CPU 的数据区缓存 (napi_alloc_cache)
+struct SkbPoolCpu {
+    bufs: [usize; SKB_POOL_HIGH],
+    count: usize,
+    /// 从缓存取到数据区
+    hits: u64,
+    /// 缓存为空，从堆分配
+    misses: u64,
+    /// 释放回缓存
+    frees: u64,
+    /// 缓存已满，释放回堆
+    overflows: u64,
+    /// 接收路径直接重用的 SkBuff
+    recycled: u64,
+    /// 为页片段分配的页
+    frag_pages: u64,
+}
+
+impl SkbPoolCpu {
+    const fn new() -> Self {
+        Self {
+            bufs: [0; SKB_POOL_HIGH],
+            count: 0,
+            hits: 0,
+            misses: 0,
+            frees: 0,
+            overflows: 0,
+            recycled: 0,
+            frag_pages: 0,
+        }
+    }
+}
+
+static mut SKB_POOL: [SkbPoolCpu; MAX_CPUS] = [const { SkbPoolCpu::new() }; MAX_CPUS];
+
+/// 在关中断状态下访问当前 CPU 的缓存
+fn with_this_cpu_pool<R>(f: impl FnOnce(&mut SkbPoolCpu) -> R) -> Option<R> {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let cpu_id = crate::arch::cpu_id() as usize;
+    if cpu_id >= MAX_CPUS {
+        return None;
+    }
+    let pool = unsafe { &mut *core::ptr::addr_of_mut!(SKB_POOL[cpu_id]) };
+    Some(f(pool))
+}
+
+#[inline]
+fn data_layout() -> alloc::alloc::Layout {
+    // SKB_DATA_SIZE 与 SKB_DATA_ALIGN 都是 2 的幂，不会失败
+    alloc::alloc::Layout::from_size_align(SKB_DATA_SIZE, SKB_DATA_ALIGN).unwrap()
+}
+
+/// 分配一个 SKB_DATA_SIZE 字节的数据区 (napi_alloc_frag)
+///
+/// # 返回
+/// 数据区起始地址；堆也分配失败时返回空指针
+pub fn skb_data_alloc() -> *mut u8 {
+    let cached = with_this_cpu_pool(|pool| {
+        if pool.count > 0 {
+            pool.count -= 1;
+            pool.hits += 1;
+            pool.bufs[pool.count]
+        } else {
+            pool.misses += 1;
+            0
+        }
+    });
+    match cached {
+        Some(buf) if buf != 0 => buf as *mut u8,
+        _ => unsafe { alloc::alloc::alloc(data_layout()) },
+    }
+}
+
+/// 释放 skb_data_alloc 分配的数据区 (skb_free_head)
+pub fn skb_data_free(buf: *mut u8) {
+    let cached = with_this_cpu_pool(|pool| {
+        if pool.count < SKB_POOL_HIGH {
+            pool.bufs[pool.count] = buf as usize;
+            pool.count += 1;
+            pool.frees += 1;
+            true
+        } else {
+            pool.overflows += 1;
+            false
+        }
+    });
+    if cached != Some(true) {
+        unsafe { alloc::alloc::dealloc(buf, data_layout()) };
+    }
+}
+
+/// 记录一次接收路径的直接重用
+pub fn skb_pool_note_recycle() {
+    with_this_cpu_pool(|pool| pool.recycled += 1);
+}
+
+/// 记录为页片段分配的页
+pub fn skb_pool_note_frag_page() {
+    with_this_cpu_pool(|pool| pool.frag_pages += 1);
+}
+
+/// 清空当前 CPU 的缓存，归还给堆 (内存压力时调用)
+///
+/// # 返回
+/// 归还的数据区数
+pub fn skb_pool_drain_local() -> usize {
+    let mut drained = 0;
+    loop {
+        let buf = with_this_cpu_pool(|pool| {
+            if pool.count > 0 {
+                pool.count -= 1;
+                pool.bufs[pool.count]
+            } else {
+                0
+            }
+        });
+        match buf {
+            Some(buf) if buf != 0 => {
+                unsafe { alloc::alloc::dealloc(buf as *mut u8, data_layout()) };
+                drained += 1;
+            }
+            _ => break,
+        }
+    }
+    drained
+}
+
+/// 单个 CPU 的缓存统计
+#[derive(Debug, Clone, Copy, Default)]
+pub struct SkbPoolCpuStats {
+    pub count: usize,
+    pub hits: u64,
+    pub misses: u64,
+    pub frees: u64,
+    pub overflows: u64,
+    pub recycled: u64,
+    pub frag_pages: u64,
+}
+
+impl SkbPoolCpuStats {
+    /// 分配命中率（千分比）
+    pub fn hit_permille(&self) -> u64 {
+        let total = self.hits + self.misses;
+        if total == 0 {
+            0
+        } else {
+            self.hits * 1000 / total
+        }
+    }
+}
+
+/// 读取各 CPU 的缓存统计
+///
+/// 读取其他 CPU 的计数不加锁，结果是近似值
+pub fn skb_pool_stats() -> [SkbPoolCpuStats; MAX_CPUS] {
+    let mut stats = [SkbPoolCpuStats::default(); MAX_CPUS];
+    for (cpu_id, s) in stats.iter_mut().enumerate() {
+        let pool = unsafe { &*core::ptr::addr_of!(SKB_POOL[cpu_id]) };
+        *s = SkbPoolCpuStats {
+            count: pool.count,
+            hits: pool.hits,
+            misses: pool.misses,
+            frees: pool.frees,
+            overflows: pool.overflows,
+            recycled: pool.recycled,
+            frag_pages: pool.frag_pages,
+        };
+    }
+    stats
+}
+
+/// 生成 /proc/net/skb_pool 内容
+pub fn skb_pool_info() -> String {
+    let mut content = String::new();
+    content.push_str("cpu  cached      hits    misses  hit%     frees overflows  recycled frag_pages\n");
+    for (cpu_id, s) in skb_pool_stats().iter().enumerate() {
+        let permille = s.hit_permille();
+        content.push_str(&format!(
+            "{:<4} {:>6} {:>9} {:>9} {:>3}.{} {:>9} {:>9} {:>9} {:>10}\n",
+            cpu_id, s.count, s.hits, s.misses, permille / 10, permille % 10,
+            s.frees, s.overflows, s.recycled, s.frag_pages
+        ));
+    }
+    content
+}
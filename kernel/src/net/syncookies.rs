@@ -0,0 +1,177 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! SYN cookie
+//!
+//! 监听 socket 的半连接队列满时不再为 SYN 创建子连接，而是把连接参数编码进 SYN-ACK 的
+//! 初始序列号；对端第三次握手的 ACK 确认号减一即为 cookie，校验通过后直接建立连接。
+//! SYN 洪泛因此不会耗尽内存，也不会挤掉正常的连接
+//!
+//! 参考: net/ipv4/syncookies.c, net/core/secure_seq.c
+//!
+//! # 编码
+//! cookie = H1 + 对端 ISN + (count << 24) + ((H2(count) + MSS 下标) & 0xffffff)
+//!
+//! - H1、H2 是四元组带两个不同种子的哈希，count 是分钟计数
+//! - 校验时减去 H1 与 ISN 得到 count，超过 MAX_SYNCOOKIE_AGE 分钟的 cookie 无效
+//! - 没有时间戳选项携带其余参数，cookie 的 SYN-ACK 不带窗口扩大与 SACK 选项，
+//!   这样建立的连接都不使用它们
+
+use core::sync::atomic::{AtomicU32, Ordering};
+
+use crate::drivers::timer::{get_jiffies, read_time, HZ};
+use crate::net::inet_hashtables::jhash_3words;
+use crate::net::tcp::{
+    tcp_alloc_skb, tcp_build_header, TcpHdr, TcpPort, TcpSeq, TCPHDR_ACK, TCPHDR_SYN, TCPOLEN_MSS,
+    TCPOPT_MSS, TCP_MAX_WINDOW, TCP_MSS,
+};
+use crate::net::tcp_input::tcp_parse_options;
+
+/// count 占用的高位之外，低 24 位携带 MSS 下标 (COOKIEBITS)
+const COOKIEBITS: u32 = 24;
+const COOKIEMASK: u32 = (1 << COOKIEBITS) - 1;
+
+/// cookie 的有效期（分钟） (MAX_SYNCOOKIE_AGE)
+const MAX_SYNCOOKIE_AGE: u32 = 2;
+
+/// 半连接队列最近溢出过多久内才接受 cookie（jiffies） (TCP_SYNCOOKIE_VALID)
+pub const TCP_SYNCOOKIE_VALID: u64 = 2 * 60 * HZ;
+
+/// 可编码的 MSS，按从小到大排列 (msstab)
+const MSSTAB: [u16; 4] = [536, 1300, 1440, 1460];
+
+/// 两个哈希种子，0 表示尚未初始化 (syncookie_secret)
+static SYNCOOKIE_SECRET: [AtomicU32; 2] = [AtomicU32::new(0), AtomicU32::new(0)];
+
+/// 取哈希种子，第一次使用时生成 (net_get_random_once)
+fn syncookie_secret(c: usize) -> u32 {
+    let secret = SYNCOOKIE_SECRET[c].load(Ordering::Relaxed);
+    if secret != 0 {
+        return secret;
+    }
+    let t = read_time();
+    let seed = jhash_3words(t as u32, (t >> 32) as u32, 0x5eed0000 + c as u32, 0).max(1);
+    match SYNCOOKIE_SECRET[c].compare_exchange(0, seed, Ordering::Relaxed, Ordering::Relaxed) {
+        Ok(_) => seed,
+        Err(current) => current,
+    }
+}
+
+/// 分钟计数 (tcp_cookie_time)
+pub fn tcp_cookie_time() -> u32 {
+    (get_jiffies() / (60 * HZ)) as u32
+}
+
+/// 四元组与 count 的哈希 (cookie_hash)
+fn cookie_hash(saddr: u32, daddr: u32, sport: TcpPort, dport: TcpPort, count: u32, c: usize) -> u32 {
+    jhash_3words(saddr, daddr, ((sport as u32) << 16) | dport as u32, syncookie_secret(c).wrapping_add(count))
+}
+
+/// 按指定的分钟计数生成 cookie (secure_tcp_syn_cookie)
+fn secure_tcp_syn_cookie(
+    saddr: u32,
+    daddr: u32,
+    sport: TcpPort,
+    dport: TcpPort,
+    sseq: TcpSeq,
+    count: u32,
+    data: u32,
+) -> TcpSeq {
+    cookie_hash(saddr, daddr, sport, dport, 0, 0)
+        .wrapping_add(sseq)
+        .wrapping_add(count << COOKIEBITS)
+        .wrapping_add(cookie_hash(saddr, daddr, sport, dport, count, 1).wrapping_add(data) & COOKIEMASK)
+}
+
+/// 从 cookie 中取出编码的数据，cookie 过期或被篡改时返回 None (check_tcp_syn_cookie)
+fn check_tcp_syn_cookie(
+    cookie: TcpSeq,
+    saddr: u32,
+    daddr: u32,
+    sport: TcpPort,
+    dport: TcpPort,
+    sseq: TcpSeq,
+    count: u32,
+) -> Option<u32> {
+    let cookie = cookie.wrapping_sub(cookie_hash(saddr, daddr, sport, dport, 0, 0).wrapping_add(sseq));
+    // cookie 生成时的分钟计数只保留了高 8 位
+    let diff = count.wrapping_sub(cookie >> COOKIEBITS) & (u32::MAX >> COOKIEBITS);
+    if diff >= MAX_SYNCOOKIE_AGE {
+        return None;
+    }
+    let generated = count.wrapping_sub(diff);
+    Some(cookie.wrapping_sub(cookie_hash(saddr, daddr, sport, dport, generated, 1)) & COOKIEMASK)
+}
+
+/// 为 SYN 生成 cookie，对端 MSS 向下取整到 MSSTAB 中 (cookie_v4_init_sequence)
+///
+/// # 参数
+/// - `saddr` / `sport`: 对端地址与端口
+/// - `daddr` / `dport`: 本地地址与端口
+/// - `sseq`: 对端 SYN 的序列号
+/// - `mss`: 对端通告的 MSS
+///
+/// # 返回
+/// (cookie, 编码的 MSS)
+pub fn cookie_v4_init_sequence(
+    saddr: u32,
+    daddr: u32,
+    sport: TcpPort,
+    dport: TcpPort,
+    sseq: TcpSeq,
+    mss: u16,
+) -> (TcpSeq, u16) {
+    let mssind = MSSTAB.iter().rposition(|&m| m <= mss).unwrap_or(0);
+    let cookie = secure_tcp_syn_cookie(saddr, daddr, sport, dport, sseq, tcp_cookie_time(), mssind as u32);
+    (cookie, MSSTAB[mssind])
+}
+
+/// 校验第三次握手 ACK 中的 cookie (cookie_v4_check / __cookie_v4_check)
+///
+/// # 参数
+/// - `sseq`: 对端 SYN 的序列号，即 ACK 的序列号减一
+/// - `cookie`: ACK 的确认号减一
+///
+/// # 返回
+/// 校验通过时返回编码的 MSS
+pub fn cookie_v4_check(
+    saddr: u32,
+    daddr: u32,
+    sport: TcpPort,
+    dport: TcpPort,
+    sseq: TcpSeq,
+    cookie: TcpSeq,
+) -> Option<u16> {
+    let mssind = check_tcp_syn_cookie(cookie, saddr, daddr, sport, dport, sseq, tcp_cookie_time())?;
+    MSSTAB.get(mssind as usize).copied()
+}
+
+/// 不创建子连接，直接回复以 cookie 为序列号的 SYN-ACK (tcp_v4_send_synack + want_cookie)
+///
+/// # 参数
+/// - `tcp_hdr`: 对端的 SYN
+/// - `saddr`: 对端地址
+/// - `daddr`: 本地地址
+pub fn tcp_v4_send_cookie_synack(tcp_hdr: &TcpHdr, saddr: u32, daddr: u32) -> Result<(), ()> {
+    let sport = TcpPort::from_be(tcp_hdr.source);
+    let dport = TcpPort::from_be(tcp_hdr.dest);
+    let sseq = TcpSeq::from_be(tcp_hdr.seq);
+    let peer_mss = match tcp_parse_options(tcp_hdr.options()).mss {
+        Some(mss) if mss != 0 => mss,
+        _ => MSSTAB[0],
+    };
+    let (cookie, _) = cookie_v4_init_sequence(saddr, daddr, sport, dport, sseq, peer_mss);
+
+    // 只带 MSS 选项；窗口不缩放
+    let mut opts = [TCPOPT_MSS, TCPOLEN_MSS, 0, 0];
+    opts[2..4].copy_from_slice(&(TCP_MSS as u16).to_be_bytes());
+    let mut skb = tcp_alloc_skb(0)?;
+    if tcp_build_header(&mut skb, dport, sport, cookie, sseq.wrapping_add(1), TCPHDR_SYN | TCPHDR_ACK, TCP_MAX_WINDOW, &opts)
+        .is_err()
+    {
+        skb.free();
+        return Err(());
+    }
+    crate::net::ipv4::ipv4_send(skb, saddr, 6) // IPPROTO_TCP = 6
+}
@@ -5,9 +5,33 @@
 //! TCP 协议
 //!
 //! 完全...
+//!
+//! 本文件包含头部格式、socket 结构、连接状态机、socket 表与报文分发；
+//! 接收处理见 tcp_input.rs，发送与重传见 tcp_output.rs，定时器见 tcp_timer.rs
+//!
+//! 收到的报文先按四元组在已建立连接的哈希表中查找，再按 (地址, 端口) 查找监听 socket，
+//! 见 inet_hashtables.rs
+//!
+//! 监听 socket 收到的 SYN 创建子连接，子连接先进入半连接队列，握手完成后移到全连接队列，
+//! 由 accept 取出；半连接队列满时改用 SYN cookie，见 syncookies.rs
+//!
+//! 参考: net/ipv4/tcp.c, net/ipv4/tcp_ipv4.c, net/ipv4/inet_connection_sock.c
 
-use crate::net::buffer::SkBuff;
+use alloc::collections::VecDeque;
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use spin::Mutex;
+
+use crate::fs::file::{File, FileFlags, FileOps};
+
+use crate::net::buffer::{SkBuff, CHECKSUM_UNNECESSARY};
+use crate::net::busy_poll::SO_BUSY_POLL;
+use crate::net::inet_hashtables::{inet_ehashfn, inet_lookup_listener, InetBindKey, InetEhashKey, InetHashTable, INADDR_ANY};
 use crate::net::ipv4::{route, checksum};
+use crate::net::tcp_cong::{tcp_ca_default, TcpCaPriv, TcpCongestionOps};
+use crate::net::tcp_input::{tcp_parse_options, TcpOptions};
+use crate::net::tcp_rate::TcpRateState;
+use crate::net::tcp_timer::TCP_TIMEOUT_INIT;
 use crate::config::TCP_SOCKET_TABLE_SIZE;
 
 /// TCP 头部长度
@@ -17,6 +41,85 @@ pub const TCP_MAX_HLEN: usize = 60;
 /// TCP 最大窗口大小
 pub const TCP_MAX_WINDOW: u16 = 65535;
 
+/// 以太网 MTU 下的最大报文段长度 (TCP_MSS_DEFAULT)
+pub const TCP_MSS: usize = 1460;
+
+/// 一次交给 IP 层的最大数据量：取 MSS 的整数倍，IP 总长不超过 65535 (GSO_MAX_SIZE)
+pub const TCP_GSO_MAX_SIZE: usize = TCP_MSS * 44;
+
+/// 为以太网、IP、TCP 头部预留的空间 (MAX_TCP_HEADER)
+pub const MAX_TCP_HEADER: u32 = 128;
+
+/// TCP 标志位（头部第 13 字节）
+pub const TCPHDR_FIN: u8 = 0x01;
+pub const TCPHDR_SYN: u8 = 0x02;
+pub const TCPHDR_RST: u8 = 0x04;
+pub const TCPHDR_PSH: u8 = 0x08;
+pub const TCPHDR_ACK: u8 = 0x10;
+pub const TCPHDR_URG: u8 = 0x20;
+pub const TCPHDR_ECE: u8 = 0x40;
+pub const TCPHDR_CWR: u8 = 0x80;
+
+/// TCP 选项类型
+pub const TCPOPT_EOL: u8 = 0;
+pub const TCPOPT_NOP: u8 = 1;
+pub const TCPOPT_MSS: u8 = 2;
+pub const TCPOPT_WINDOW: u8 = 3;
+pub const TCPOPT_SACK_PERM: u8 = 4;
+pub const TCPOPT_SACK: u8 = 5;
+
+/// TCP 选项长度
+pub const TCPOLEN_MSS: u8 = 4;
+pub const TCPOLEN_WINDOW: u8 = 3;
+pub const TCPOLEN_SACK_PERM: u8 = 2;
+pub const TCPOLEN_SACK_BASE: u8 = 2;
+pub const TCPOLEN_SACK_PERBLOCK: u8 = 8;
+
+/// 默认发送缓冲区大小 (tcp_wmem)
+pub const TCP_WMEM_DEFAULT: usize = 128 * 1024;
+
+/// 默认接收缓冲区大小 (tcp_rmem)
+pub const TCP_RMEM_DEFAULT: usize = 128 * 1024;
+
+/// 窗口扩大因子上限 (TCP_MAX_WSCALE)
+pub const TCP_MAX_WSCALE: u8 = 14;
+
+/// 初始拥塞窗口，单位为报文段 (TCP_INIT_CWND)
+pub const TCP_INIT_CWND: u32 = 10;
+
+/// 拥塞窗口上限，单位为报文段 (snd_cwnd_clamp)
+pub const TCP_MAX_CWND: u32 = 65535;
+
+/// 一个 ACK 最多携带的 SACK 块数 (TCP_NUM_SACKS)
+pub const TCP_NUM_SACKS: usize = 4;
+
+/// 接收方最多记录的乱序区间数
+pub const TCP_MAX_OFO_RANGES: usize = 32;
+
+/// 触发快速重传的重复 ACK 数 (tcp_reordering)
+pub const TCP_FASTRETRANS_THRESH: u32 = 3;
+
+/// setsockopt 的 TCP 层级 (SOL_TCP)
+pub const SOL_TCP: i32 = 6;
+
+/// 关闭 Nagle 算法，不足一个 MSS 的数据立即发送 (TCP_NODELAY)
+pub const TCP_NODELAY: i32 = 1;
+
+/// 只发送满 MSS 的报文段，取消设置或超过 TCP_CORK_MAX 后发出剩余数据 (TCP_CORK)
+pub const TCP_CORK: i32 = 3;
+
+/// 选择拥塞控制算法的选项 (TCP_CONGESTION)
+pub const TCP_CONGESTION: i32 = 13;
+
+/// setsockopt 的通用 socket 层级 (SOL_SOCKET)
+pub const SOL_SOCKET: i32 = 1;
+
+/// 允许多个 socket 监听同一端口，新连接按四元组哈希分给其中一个 (SO_REUSEPORT)
+pub const SO_REUSEPORT: i32 = 15;
+
+/// listen 的 backlog 上限 (SOMAXCONN)
+pub const SOMAXCONN: u32 = 4096;
+
 /// TCP 端口号
 pub type TcpPort = u16;
 
@@ -26,6 +129,18 @@ pub type TcpSeq = u32;
 /// TCP 确认号
 pub type TcpAck = u32;
 
+/// 序列号 a 是否在 b 之前（按 2^31 回绕比较）(before)
+#[inline]
+pub fn before(a: TcpSeq, b: TcpSeq) -> bool {
+    (a.wrapping_sub(b) as i32) < 0
+}
+
+/// 序列号 a 是否在 b 之后 (after)
+#[inline]
+pub fn after(a: TcpSeq, b: TcpSeq) -> bool {
+    before(b, a)
+}
+
 /// TCP 头部
 ///
 #[repr(C)]
@@ -39,10 +154,12 @@ pub struct TcpHdr {
     pub seq: TcpSeq,
     /// 确认号
     pub ack_seq: TcpAck,
-    /// 数据偏移 + 保留 + 标志
+    /// 数据偏移 + 保留
     pub dof_res: u8,
-    /// 标志 + 窗口大小
-    pub flags_win: u16,
+    /// 标志
+    pub flags: u8,
+    /// 窗口大小
+    pub window: u16,
     /// 校验和
     pub check: u16,
     /// 紧急指针
@@ -71,34 +188,45 @@ impl TcpHdr {
         (self.dof() as usize) * 4
     }
 
+    /// 获取头部中的选项
+    ///
+    /// # 说明
+    /// 头部必须来自完整的 TCP 头部（含选项），见 from_bytes
+    pub fn options(&self) -> &[u8] {
+        let len = self.header_len().saturating_sub(TCP_MIN_HLEN);
+        unsafe {
+            core::slice::from_raw_parts((self as *const TcpHdr as *const u8).add(TCP_MIN_HLEN), len)
+        }
+    }
+
     /// 检查 SYN 标志
     pub fn syn(&self) -> bool {
-        (self.flags_win & 0x02) != 0
+        (self.flags & TCPHDR_SYN) != 0
     }
 
     /// 检查 ACK 标志
     pub fn ack(&self) -> bool {
-        (self.flags_win & 0x10) != 0
+        (self.flags & TCPHDR_ACK) != 0
     }
 
     /// 检查 FIN 标志
     pub fn fin(&self) -> bool {
-        (self.flags_win & 0x01) != 0
+        (self.flags & TCPHDR_FIN) != 0
     }
 
     /// 检查 RST 标志
     pub fn rst(&self) -> bool {
-        (self.flags_win & 0x04) != 0
+        (self.flags & TCPHDR_RST) != 0
     }
 
     /// 检查 PSH 标志
     pub fn psh(&self) -> bool {
-        (self.flags_win & 0x08) != 0
+        (self.flags & TCPHDR_PSH) != 0
     }
 
-    /// 获取窗口大小
+    /// 获取窗口大小（未按窗口扩大因子放大）
     pub fn window(&self) -> u16 {
-        u16::from_be(self.flags_win & 0xFF00)
+        u16::from_be(self.window)
     }
 
     /// 设置数据偏移
@@ -108,32 +236,32 @@ impl TcpHdr {
 
     /// 设置 SYN 标志
     pub fn set_syn(&mut self) {
-        self.flags_win |= 0x0002;
+        self.flags |= TCPHDR_SYN;
     }
 
     /// 设置 ACK 标志
     pub fn set_ack(&mut self) {
-        self.flags_win |= 0x0010;
+        self.flags |= TCPHDR_ACK;
     }
 
     /// 设置 FIN 标志
     pub fn set_fin(&mut self) {
-        self.flags_win |= 0x0001;
+        self.flags |= TCPHDR_FIN;
     }
 
     /// 设置 RST 标志
     pub fn set_rst(&mut self) {
-        self.flags_win |= 0x0004;
+        self.flags |= TCPHDR_RST;
     }
 
     /// 设置 PSH 标志
     pub fn set_psh(&mut self) {
-        self.flags_win |= 0x0008;
+        self.flags |= TCPHDR_PSH;
     }
 
     /// 设置窗口大小
     pub fn set_window(&mut self, win: u16) {
-        self.flags_win = (self.flags_win & 0x00FF) | (win & 0xFF00);
+        self.window = win.to_be();
     }
 }
 
@@ -168,9 +296,280 @@ pub enum TcpState {
     TCP_CLOSING = 10,
 }
 
+
+/// 字节环形缓冲区，用作 TCP 的发送和接收缓冲区
+///
+/// 发送缓冲区的队首对应 snd_una，保存已发送未确认和尚未发送的数据，重传时直接从这里组包；
+/// 接收缓冲区的队首是应用下一次读取的位置，乱序到达的数据直接写到对应偏移处，
+/// 空洞补齐后用 commit 并入已接收部分，不需要额外的乱序队列内存
+pub struct TcpRingBuf {
+    buf: Vec<u8>,
+    head: usize,
+    len: usize,
+}
+
+impl TcpRingBuf {
+    /// 创建未分配空间的缓冲区
+    pub const fn new() -> Self {
+        Self { buf: Vec::new(), head: 0, len: 0 }
+    }
+
+    /// 创建容量为 capacity 的缓冲区
+    pub fn with_capacity(capacity: usize) -> Self {
+        Self { buf: alloc::vec![0u8; capacity], head: 0, len: 0 }
+    }
+
+    /// 缓冲区容量
+    #[inline]
+    pub fn capacity(&self) -> usize {
+        self.buf.len()
+    }
+
+    /// 已有数据长度
+    #[inline]
+    pub fn len(&self) -> usize {
+        self.len
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.len == 0
+    }
+
+    /// 剩余空间
+    #[inline]
+    pub fn free_space(&self) -> usize {
+        self.capacity() - self.len
+    }
+
+    /// 偏移 offset（相对队首）处开始、长度 len 的区间在环中的两段位置
+    fn spans(&self, offset: usize, len: usize) -> ((usize, usize), (usize, usize)) {
+        let cap = self.capacity();
+        if cap == 0 || len == 0 {
+            return ((0, 0), (0, 0));
+        }
+        let start = (self.head + offset) % cap;
+        let first = core::cmp::min(len, cap - start);
+        ((start, first), (0, len - first))
+    }
+
+    /// 在 offset（相对队首）处写入数据，不改变长度
+    ///
+    /// # 返回
+    /// 写入的字节数；超出容量的部分被截掉
+    pub fn write_at(&mut self, offset: usize, data: &[u8]) -> usize {
+        if offset >= self.capacity() {
+            return 0;
+        }
+        let n = core::cmp::min(data.len(), self.capacity() - offset);
+        let ((s1, l1), (s2, l2)) = self.spans(offset, n);
+        self.buf[s1..s1 + l1].copy_from_slice(&data[..l1]);
+        self.buf[s2..s2 + l2].copy_from_slice(&data[l1..l1 + l2]);
+        n
+    }
+
+    /// 把已经写在队尾之后的 n 字节并入数据
+    pub fn commit(&mut self, n: usize) {
+        self.len = core::cmp::min(self.len + n, self.capacity());
+    }
+
+    /// 追加数据
+    ///
+    /// # 返回
+    /// 追加的字节数，受剩余空间限制
+    pub fn push(&mut self, data: &[u8]) -> usize {
+        let n = core::cmp::min(data.len(), self.free_space());
+        self.write_at(self.len, &data[..n]);
+        self.commit(n);
+        n
+    }
+
+    /// 队尾之后的空闲空间，分为两段
+    pub fn tail_slices_mut(&mut self) -> (&mut [u8], &mut [u8]) {
+        let ((s1, l1), (s2, l2)) = self.spans(self.len, self.free_space());
+        if l2 == 0 {
+            (&mut self.buf[s1..s1 + l1], &mut [])
+        } else {
+            // 第二段总是从 0 开始，位于第一段之前
+            let (low, high) = self.buf.split_at_mut(s1);
+            (&mut high[..l1], &mut low[s2..s2 + l2])
+        }
+    }
+
+    /// 偏移 offset 处开始、长度 len 的数据，分为两段
+    pub fn slices(&self, offset: usize, len: usize) -> (&[u8], &[u8]) {
+        let len = core::cmp::min(len, self.len.saturating_sub(offset));
+        let ((s1, l1), (s2, l2)) = self.spans(offset, len);
+        (&self.buf[s1..s1 + l1], &self.buf[s2..s2 + l2])
+    }
+
+    /// 把 offset 处开始的数据复制到 out
+    ///
+    /// # 返回
+    /// 复制的字节数
+    pub fn read_at(&self, offset: usize, out: &mut [u8]) -> usize {
+        let (a, b) = self.slices(offset, out.len());
+        out[..a.len()].copy_from_slice(a);
+        out[a.len()..a.len() + b.len()].copy_from_slice(b);
+        a.len() + b.len()
+    }
+
+    /// 丢弃队首的 n 字节
+    pub fn consume(&mut self, n: usize) {
+        let n = core::cmp::min(n, self.len);
+        if self.capacity() != 0 {
+            self.head = (self.head + n) % self.capacity();
+        }
+        self.len -= n;
+    }
+
+    /// 从队首读出数据
+    ///
+    /// # 返回
+    /// 读出的字节数
+    pub fn pop(&mut self, out: &mut [u8]) -> usize {
+        let n = self.read_at(0, out);
+        self.consume(n);
+        n
+    }
+}
+
+/// 拥塞控制状态 (tcp_ca_state)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum TcpCaState {
+    /// 正常发送
+    Open,
+    /// 快速重传后的快速恢复
+    Recovery,
+    /// 重传超时后，未被 SACK 的已发送数据都视为丢失
+    Loss,
+}
+
+/// 单个连接的统计 (tcp_info)
+#[derive(Debug, Clone, Copy, Default)]
+pub struct TcpStats {
+    /// 发出的报文段数（超长包按分段数计）
+    pub segs_out: u64,
+    /// 收到的报文段数
+    pub segs_in: u64,
+    /// 重传的报文段数
+    pub retrans_segs: u64,
+    /// 快速重传次数
+    pub fast_retrans: u64,
+    /// 重传超时次数
+    pub timeouts: u64,
+    /// 乱序到达的报文段数
+    pub ofo_segs: u64,
+    /// 收到的 SACK 块数
+    pub sack_blocks: u64,
+    /// 被确认的字节数
+    pub bytes_acked: u64,
+    /// 按序收到的字节数
+    pub bytes_received: u64,
+    /// 监听 socket：全连接队列满而丢弃的 SYN 与 ACK 数 (LINUX_MIB_LISTENOVERFLOWS)
+    pub listen_overflows: u64,
+    /// 监听 socket：发出的 SYN cookie 数 (LINUX_MIB_SYNCOOKIESSENT)
+    pub syncookies_sent: u64,
+    /// 监听 socket：校验通过的 SYN cookie 数 (LINUX_MIB_SYNCOOKIESRECV)
+    pub syncookies_recv: u64,
+    /// 监听 socket：校验失败的 SYN cookie 数 (LINUX_MIB_SYNCOOKIESFAILED)
+    pub syncookies_failed: u64,
+}
+
+/// 按接收缓冲区大小选择窗口扩大因子 (tcp_select_initial_window)
+pub fn tcp_select_initial_wscale(space: usize) -> u8 {
+    let mut wscale = 0;
+    while (space >> wscale) > TCP_MAX_WINDOW as usize && wscale < TCP_MAX_WSCALE {
+        wscale += 1;
+    }
+    wscale
+}
+
+/// socket 在查找哈希表中的句柄
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum TcpSockRef {
+    /// socket 表中的 socket（文件描述符）
+    Fd(usize),
+    /// 连接管理器中被动打开的连接
+    Child(usize),
+    /// 连接管理器中的监听 socket
+    Listen(usize),
+}
+
+/// socket 在哪个哈希表中、以什么键插入
+#[derive(Debug, Clone, Copy)]
+pub(crate) enum TcpHashed {
+    /// 已建立连接的哈希表 (ehash)
+    Established(InetEhashKey),
+    /// 监听哈希表 (lhash2)
+    Listen(InetBindKey),
+}
+
+/// 监听 socket 的连接队列 (request_sock_queue)
+///
+/// 队列中保存子连接在连接管理器中的编号 (TcpSockRef::Child)
+pub struct TcpRequestQueue {
+    /// listen 的 backlog，两个队列各自的长度上限 (sk_max_ack_backlog)
+    pub max_backlog: u32,
+    /// 正在握手（SYN_RECV）的子连接
+    pub(crate) syn_queue: Vec<usize>,
+    /// 已完成握手、等待 accept 的子连接，按完成顺序排列 (icsk_accept_queue)
+    pub(crate) accept_queue: VecDeque<usize>,
+    /// 最近一次半连接队列溢出的时刻（jiffies），0 表示没有溢出过 (synq_overflow_ts)
+    pub(crate) synq_overflow_ts: u64,
+}
+
+impl TcpRequestQueue {
+    pub const fn new() -> Self {
+        Self {
+            max_backlog: 0,
+            syn_queue: Vec::new(),
+            accept_queue: VecDeque::new(),
+            synq_overflow_ts: 0,
+        }
+    }
+
+    /// 半连接队列是否已满 (inet_csk_reqsk_queue_is_full)
+    pub fn syn_queue_is_full(&self) -> bool {
+        self.syn_queue.len() as u32 >= self.max_backlog
+    }
+
+    /// 全连接队列是否已满；与 Linux 一致，backlog 为 0 时仍可容纳一个连接 (sk_acceptq_is_full)
+    pub fn accept_queue_is_full(&self) -> bool {
+        self.accept_queue.len() as u32 > self.max_backlog
+    }
+
+    /// 等待 accept 的连接数
+    pub fn accept_queue_len(&self) -> usize {
+        self.accept_queue.len()
+    }
+
+    /// 正在握手的连接数
+    pub fn syn_queue_len(&self) -> usize {
+        self.syn_queue.len()
+    }
+
+    /// 子连接完成握手，从半连接队列移到全连接队列 (inet_csk_reqsk_queue_add)
+    fn complete(&mut self, idx: usize) {
+        self.syn_queue.retain(|&i| i != idx);
+        self.accept_queue.push_back(idx);
+    }
+
+    /// 子连接在被 accept 之前终止，从所在的队列中删除 (inet_csk_reqsk_queue_drop)
+    fn unlink(&mut self, idx: usize) {
+        self.syn_queue.retain(|&i| i != idx);
+        self.accept_queue.retain(|&i| i != idx);
+    }
+
+    /// 半连接队列最近是否溢出过，决定是否接受 SYN cookie (tcp_synq_no_recent_overflow)
+    fn recent_overflow(&self, now: u64) -> bool {
+        self.synq_overflow_ts != 0 && now.wrapping_sub(self.synq_overflow_ts) < crate::net::syncookies::TCP_SYNCOOKIE_VALID
+    }
+}
+
 /// TCP Socket 结构
 ///
-/// 简化实现：包含连接状态、序列号等
+/// 包含连接状态、序列号、收发缓冲区、窗口、拥塞控制与重传状态
 #[repr(C)]
 pub struct TcpSocket {
     /// 本地端口
@@ -187,10 +586,122 @@ pub struct TcpSocket {
     pub snd_una: TcpSeq,
     /// 接收序列号
     pub rcv_nxt: TcpSeq,
-    /// 窗口大小
-    pub window: u16,
     /// 是否已绑定
     pub bound: bool,
+
+    /// 对端通告的发送窗口（已按窗口扩大因子放大）
+    pub snd_wnd: u32,
+    /// 上次更新发送窗口的报文段序列号与确认号 (snd_wl1 / snd_wl2)
+    pub snd_wl1: TcpSeq,
+    pub snd_wl2: TcpAck,
+    /// 本端上次通告的接收窗口右边界
+    pub rcv_wnd_edge: TcpSeq,
+    /// 对端通告的窗口扩大因子，用于放大对端的窗口
+    pub snd_wscale: u8,
+    /// 本端通告的窗口扩大因子，用于缩小本端的窗口
+    pub rcv_wscale: u8,
+    /// 双方都支持窗口扩大选项
+    pub wscale_ok: bool,
+    /// 双方都支持 SACK
+    pub sack_ok: bool,
+    /// 发送报文段的最大数据长度 (mss_cache)
+    pub mss: u32,
+
+    /// 拥塞窗口，单位为报文段
+    pub snd_cwnd: u32,
+    /// 慢启动阈值
+    pub snd_ssthresh: u32,
+    /// 拥塞避免阶段累计确认的报文段数
+    pub(crate) snd_cwnd_cnt: u32,
+    /// 重复 ACK 计数
+    pub dup_acks: u32,
+    /// 拥塞状态
+    pub ca_state: TcpCaState,
+    /// 进入恢复或超时时的 snd_nxt，确认到这里即回到 Open
+    pub high_seq: TcpSeq,
+    /// 恢复期间已重传到的位置
+    pub(crate) high_rxt: TcpSeq,
+    /// 对端 SACK 确认的区间（记分板），按序排列、互不重叠
+    pub sacked: Vec<(TcpSeq, TcpSeq)>,
+
+    /// 平滑 RTT（jiffies，放大 8 倍）
+    pub srtt: u32,
+    /// RTT 偏差（jiffies，放大 4 倍）
+    pub mdev: u32,
+    /// 重传超时（jiffies）
+    pub rto: u64,
+    /// 连续超时的退避次数
+    pub backoff: u32,
+    /// 正在测量 RTT 的报文段：确认号越过 rtt_seq 时取样
+    pub(crate) rtt_seq: TcpSeq,
+    /// 测量开始时刻（jiffies），0 表示未在测量
+    pub(crate) rtt_start: u64,
+
+    /// 发送缓冲区，队首对应 snd_una
+    pub send_buf: TcpRingBuf,
+    /// 接收缓冲区，队尾对应 rcv_nxt
+    pub recv_buf: TcpRingBuf,
+    /// 本端收到的乱序区间，用于生成 SACK 块，按序排列
+    pub ofo: Vec<(TcpSeq, TcpSeq)>,
+    /// 最近一个乱序报文段的起始序列号，对应的块放在 SACK 选项首位
+    pub(crate) ofo_last: TcpSeq,
+
+    /// 应用已关闭发送方向，数据发完后发送 FIN
+    pub fin_queued: bool,
+    /// FIN 已发送，占用序列号 snd_una + send_buf.len()
+    pub fin_sent: bool,
+    /// 已收到对端的 FIN
+    pub fin_rcvd: bool,
+    /// 尚未确认的已收报文段数（延迟 ACK）
+    pub(crate) ack_pending: u32,
+
+    /// 关闭 Nagle 算法 (TCP_NODELAY, nonagle & TCP_NAGLE_OFF)
+    pub nodelay: bool,
+    /// 应用设置了 TCP_CORK (nonagle & TCP_NAGLE_CORK)
+    pub cork: bool,
+    /// 最近一次写入带 MSG_MORE，末尾的零头等下一次写入
+    pub(crate) msg_more: bool,
+    /// 最近一个不足 MSS 的已发报文段的结束序列号 (snd_sml)
+    pub(crate) snd_sml: TcpSeq,
+    /// cork 或 MSG_MORE 推迟的零头最迟发出的时刻（jiffies），0 表示未设置
+    pub cork_deadline: u64,
+
+    /// 重传 / 零窗口探测定时器的到期时刻（jiffies），0 表示未设置
+    pub retransmit_deadline: u64,
+    /// 延迟 ACK 定时器的到期时刻
+    pub delack_deadline: u64,
+    /// TIME_WAIT 结束时刻
+    pub timewait_deadline: u64,
+
+    /// 拥塞控制算法
+    pub ca_ops: &'static TcpCongestionOps,
+    /// 拥塞控制算法的私有状态
+    pub(crate) ca_priv: TcpCaPriv,
+    /// 交付速率采样
+    pub rate: TcpRateState,
+    /// 发送速率上限（字节/秒），0 表示不做 pacing (sk_pacing_rate)
+    pub pacing_rate: u64,
+    /// pacing 允许下一次发送的时间（微秒）
+    pub(crate) pacing_next_us: u64,
+    /// pacing 定时器的到期时刻（jiffies），0 表示未设置
+    pub pacing_deadline: u64,
+    /// 最近一次发送新数据的时间（jiffies） (lsndtime)
+    pub(crate) lsndtime: u64,
+    /// 在查找哈希表中的句柄与键，未插入时为 None
+    pub(crate) hashed: Option<(TcpSockRef, TcpHashed)>,
+    /// 允许与其他 SO_REUSEPORT socket 监听同一端口
+    pub reuseport: bool,
+    /// 接收缓冲区为空时忙轮询的微秒数 (SO_BUSY_POLL, sk_ll_usec)
+    pub busy_poll_usecs: u32,
+    /// 监听 socket 的半连接与全连接队列
+    pub(crate) reqsk_queue: TcpRequestQueue,
+    /// 尚未被 accept 的子连接：所属的监听 socket 与本连接在连接管理器中的编号
+    pub(crate) parent: Option<(TcpSockRef, usize)>,
+
+    /// 连接出错的原因（负的错误码），0 表示没有错误
+    pub err: i32,
+    /// 统计
+    pub stats: TcpStats,
 }
 
 impl TcpSocket {
@@ -204,8 +715,60 @@ impl TcpSocket {
             snd_nxt: 0,
             snd_una: 0,
             rcv_nxt: 0,
-            window: TCP_MAX_WINDOW,
             bound: false,
+            snd_wnd: TCP_MAX_WINDOW as u32,
+            snd_wl1: 0,
+            snd_wl2: 0,
+            rcv_wnd_edge: 0,
+            snd_wscale: 0,
+            rcv_wscale: tcp_select_initial_wscale(TCP_RMEM_DEFAULT),
+            wscale_ok: false,
+            sack_ok: false,
+            mss: TCP_MSS as u32,
+            snd_cwnd: TCP_INIT_CWND,
+            snd_ssthresh: TCP_MAX_CWND,
+            snd_cwnd_cnt: 0,
+            dup_acks: 0,
+            ca_state: TcpCaState::Open,
+            high_seq: 0,
+            high_rxt: 0,
+            sacked: Vec::new(),
+            srtt: 0,
+            mdev: 0,
+            rto: TCP_TIMEOUT_INIT,
+            backoff: 0,
+            rtt_seq: 0,
+            rtt_start: 0,
+            send_buf: TcpRingBuf::new(),
+            recv_buf: TcpRingBuf::new(),
+            ofo: Vec::new(),
+            ofo_last: 0,
+            fin_queued: false,
+            fin_sent: false,
+            fin_rcvd: false,
+            ack_pending: 0,
+            nodelay: false,
+            cork: false,
+            msg_more: false,
+            snd_sml: 0,
+            cork_deadline: 0,
+            retransmit_deadline: 0,
+            delack_deadline: 0,
+            timewait_deadline: 0,
+            ca_ops: tcp_ca_default(),
+            ca_priv: TcpCaPriv::None,
+            rate: TcpRateState::new(),
+            pacing_rate: 0,
+            pacing_next_us: 0,
+            pacing_deadline: 0,
+            lsndtime: 0,
+            hashed: None,
+            reuseport: false,
+            busy_poll_usecs: crate::net::busy_poll::busy_read(),
+            reqsk_queue: TcpRequestQueue::new(),
+            parent: None,
+            err: 0,
+            stats: TcpStats::default(),
         }
     }
 
@@ -220,19 +783,20 @@ impl TcpSocket {
         Ok(())
     }
 
-    /// 监听端口
+    /// 监听端口；已在监听时只更新 backlog (inet_listen)
     ///
     /// # 参数
-    /// - `backlog`: 等待队列长度
-    pub fn listen(&mut self, _backlog: u32) -> Result<(), ()> {
-        if !self.bound {
+    /// - `backlog`: 半连接与全连接队列的长度，不超过 SOMAXCONN
+    pub fn listen(&mut self, backlog: u32) -> Result<(), ()> {
+        if !self.bound || !matches!(self.state, TcpState::TCP_CLOSE | TcpState::TCP_LISTEN) {
             return Err(());
         }
+        self.reqsk_queue.max_backlog = core::cmp::min(backlog, SOMAXCONN);
         self.state = TcpState::TCP_LISTEN;
         Ok(())
     }
 
-        /// 连接到远程地址（主动打开，三次握手）
+    /// 连接到远程地址（主动打开，三次握手）
     ///
     /// # 参数
     /// - `ip`: IP 地址
@@ -242,107 +806,114 @@ impl TcpSocket {
         self.remote_port = port;
 
         // 初始化序列号（简化实现：使用固定值，实际应使用 ISN）
-        self.snd_nxt = 12345;
-        self.snd_una = self.snd_nxt;
+        let iss: TcpSeq = 12345;
+        self.snd_una = iss;
+        self.snd_nxt = iss;
+        self.snd_sml = iss;
         self.rcv_nxt = 0; // 将从 SYN-ACK 中获取
+        self.tcp_init_buffers();
+        self.wscale_ok = true;
+        self.sack_ok = true;
 
-        // 发送 SYN 包（三次握手的第一步）
+        // 发送 SYN 包（三次握手的第一步），SYN 占用一个序列号
         self.send_syn()?;
+        self.snd_nxt = iss.wrapping_add(1);
         self.state = TcpState::TCP_SYN_SENT;
 
         Ok(())
     }
 
-    /// 发送 SYN 包（三次握手第一步）
-    fn send_syn(&self) -> Result<(), ()> {
-        // 构造 SYN 包：seq=ISN, ack=0, flags=SYN
-        let mut skb = crate::net::buffer::alloc_skb(1500).ok_or(())?;
-
-        tcp_build_packet(
-            &mut skb,
-            self.local_port,
-            self.remote_port,
-            self.snd_nxt,
-            0, // ACK 号为 0
-            &[], // 无数据
-            0x0002, // SYN 标志
-        )?;
-
-        // 发送到 IP 层
-        crate::net::ipv4::ipv4_send(skb, self.remote_ip, 6); // IPPROTO_TCP = 6
-
-        Ok(())
+    /// 分配收发缓冲区 (tcp_init_buffer_space)
+    pub(crate) fn tcp_init_buffers(&mut self) {
+        if self.send_buf.capacity() == 0 {
+            self.send_buf = TcpRingBuf::with_capacity(TCP_WMEM_DEFAULT);
+        }
+        if self.recv_buf.capacity() == 0 {
+            self.recv_buf = TcpRingBuf::with_capacity(TCP_RMEM_DEFAULT);
+        }
     }
 
-    /// 发送 SYN-ACK 包（三次握手第二步）
-    fn send_synack(&mut self, ack_seq: TcpSeq) -> Result<(), ()> {
-        let mut skb = crate::net::buffer::alloc_skb(1500).ok_or(())?;
-
-        tcp_build_packet(
-            &mut skb,
-            self.local_port,
-            self.remote_port,
-            self.snd_nxt,
-            self.rcv_nxt,
-            &[],
-            0x0012, // SYN + ACK 标志
-        )?;
-
-        crate::net::ipv4::ipv4_send(skb, self.remote_ip, 6);
-
-        Ok(())
+    /// 根据对端 SYN 中的选项确定 MSS、窗口扩大与 SACK (tcp_parse_options 之后)
+    fn tcp_syn_negotiate(&mut self, opts: &TcpOptions) {
+        // 对端未通告 MSS 时按 RFC 879 的默认值 536
+        self.mss = match opts.mss {
+            Some(mss) if mss != 0 => core::cmp::min(mss as u32, TCP_MSS as u32),
+            _ => 536,
+        };
+        // 报文段带 DF 发送，不能超过路径 MTU
+        self.tcp_sync_mss(route::ip_dst_mtu(self.remote_ip));
+        match opts.wscale {
+            Some(wscale) => {
+                self.snd_wscale = core::cmp::min(wscale, TCP_MAX_WSCALE);
+                self.wscale_ok = true;
+            }
+            None => {
+                self.snd_wscale = 0;
+                self.rcv_wscale = 0;
+                self.wscale_ok = false;
+            }
+        }
+        self.sack_ok = opts.sack_perm;
     }
 
-    /// 发送 ACK 包（三次握手第三步）
-    fn send_ack(&self) -> Result<(), ()> {
-        let mut skb = crate::net::buffer::alloc_skb(1500).ok_or(())?;
-
-        tcp_build_packet(
-            &mut skb,
-            self.local_port,
-            self.remote_port,
-            self.snd_nxt,
-            self.rcv_nxt,
-            &[],
-            0x0010, // ACK 标志
-        )?;
-
-        crate::net::ipv4::ipv4_send(skb, self.remote_ip, 6);
+    /// 发送 SYN 包（三次握手第一步）
+    fn send_syn(&mut self) -> Result<(), ()> {
+        // 构造 SYN 包：seq=ISN, ack=0, flags=SYN，带 MSS、窗口扩大和 SACK 允许选项
+        self.rtt_seq = self.snd_una;
+        self.rtt_start = crate::drivers::timer::get_jiffies().max(1);
+        self.tcp_reset_xmit_timer();
+        self.tcp_transmit_skb(self.snd_una, TCPHDR_SYN, 0, 0)
+    }
 
-        Ok(())
+    /// 发送 SYN-ACK 包（三次握手第二步）
+    fn send_synack(&mut self) -> Result<(), ()> {
+        self.tcp_reset_xmit_timer();
+        self.tcp_transmit_skb(self.snd_una, TCPHDR_SYN | TCPHDR_ACK, 0, 0)
     }
 
     /// 处理接收到的 TCP 包
+    ///
+    /// # 参数
+    /// - `tcp_hdr`: 完整的 TCP 头部（含选项）
+    /// - `data`: 数据部分
     pub fn handle_packet(&mut self, tcp_hdr: &TcpHdr, data: &[u8]) -> Result<(), ()> {
+        let opts = tcp_parse_options(tcp_hdr.options());
+        self.stats.segs_in += 1;
+
         match self.state {
             TcpState::TCP_LISTEN => {
                 // 服务器端：接收 SYN 包
-                if tcp_hdr.syn() && !tcp_hdr.ack() {
-                    self.handle_syn_recv(tcp_hdr)?;
+                if tcp_hdr.syn() && !tcp_hdr.ack() && !tcp_hdr.rst() {
+                    self.handle_syn_recv(tcp_hdr, &opts)?;
                 }
             }
             TcpState::TCP_SYN_SENT => {
-                // 客户端：接收 SYN-ACK 包
-                if tcp_hdr.syn() && tcp_hdr.ack() {
-                    self.handle_synack_recv(tcp_hdr)?;
+                // 客户端：接收 SYN-ACK 包；确认了 SYN 的 RST 表示对端拒绝连接
+                if tcp_hdr.rst() {
+                    if tcp_hdr.ack() && TcpSeq::from_be(tcp_hdr.ack_seq) == self.snd_nxt {
+                        self.tcp_done(-111); // ECONNREFUSED
+                    }
+                } else if tcp_hdr.syn() && tcp_hdr.ack() {
+                    self.handle_synack_recv(tcp_hdr, &opts)?;
                 }
             }
             TcpState::TCP_SYN_RECV => {
-                // 服务器端：接收 ACK 包
-                if tcp_hdr.ack() && !tcp_hdr.syn() {
-                    self.handle_ack_recv()?;
+                // 服务器端：接收 ACK 包，同一报文段中可能已经带有数据
+                if tcp_hdr.rst() {
+                    self.tcp_done(-104); // ECONNRESET
+                } else if tcp_hdr.ack() && !tcp_hdr.syn() {
+                    self.handle_ack_recv(tcp_hdr)?;
+                    if !data.is_empty() || tcp_hdr.fin() {
+                        self.tcp_rcv_established(tcp_hdr, &opts, data)?;
+                    }
                 }
             }
-            TcpState::TCP_ESTABLISHED => {
-                // 连接已建立，处理数据
-                if tcp_hdr.fin() {
-                    self.handle_fin_recv()?;
-                } else if !data.is_empty() {
-                    self.handle_data_recv(tcp_hdr, data)?;
-                }
+            TcpState::TCP_CLOSE => {
+                // 已关闭的连接不再处理
             }
             _ => {
-                // 其他状态暂不处理
+                // 同步状态：确认、窗口、数据与 FIN
+                self.tcp_rcv_established(tcp_hdr, &opts, data)?;
             }
         }
 
@@ -350,110 +921,228 @@ impl TcpSocket {
     }
 
     /// 处理接收到的 SYN 包（服务器端）
-    fn handle_syn_recv(&mut self, tcp_hdr: &TcpHdr) -> Result<(), ()> {
+    fn handle_syn_recv(&mut self, tcp_hdr: &TcpHdr, opts: &TcpOptions) -> Result<(), ()> {
         // 记录客户端的初始序列号
-        let client_isn = tcp_hdr.seq;
-        self.remote_ip = 0; // TODO: 从 IP 包头获取
+        let client_isn = TcpSeq::from_be(tcp_hdr.seq);
         self.remote_port = TcpPort::from_be(tcp_hdr.source);
 
         // 初始化自己的序列号
-        self.snd_nxt = 54321; // 服务器 ISN
-        self.snd_una = self.snd_nxt;
+        let iss: TcpSeq = 54321; // 服务器 ISN
+        self.snd_una = iss;
+        self.snd_nxt = iss;
+        self.snd_sml = iss;
         self.rcv_nxt = client_isn.wrapping_add(1);
+        self.tcp_init_buffers();
+        self.tcp_syn_negotiate(opts);
+
+        // SYN 中的窗口不按扩大因子放大
+        self.snd_wnd = tcp_hdr.window() as u32;
+        self.snd_wl1 = client_isn;
+        self.snd_wl2 = iss;
 
-        // 发送 SYN-ACK（三次握手第二步）
-        self.send_synack(self.rcv_nxt)?;
+        // 发送 SYN-ACK（三次握手第二步），SYN 占用一个序列号
+        self.send_synack()?;
+        self.snd_nxt = iss.wrapping_add(1);
         self.state = TcpState::TCP_SYN_RECV;
 
         Ok(())
     }
 
+    /// 按校验通过的 SYN cookie 直接建立连接（服务器端） (tcp_get_cookie_sock)
+    ///
+    /// cookie 的 SYN-ACK 只带 MSS 选项，连接不使用窗口扩大与 SACK
+    ///
+    /// # 参数
+    /// - `tcp_hdr`: 第三次握手的 ACK
+    /// - `mss`: cookie 中编码的对端 MSS
+    fn tcp_cookie_open(&mut self, tcp_hdr: &TcpHdr, mss: u16) {
+        let seq = TcpSeq::from_be(tcp_hdr.seq);
+        let ack_num = TcpSeq::from_be(tcp_hdr.ack_seq);
+        self.remote_port = TcpPort::from_be(tcp_hdr.source);
+        self.snd_una = ack_num;
+        self.snd_nxt = ack_num;
+        self.snd_sml = ack_num;
+        self.rcv_nxt = seq;
+        self.tcp_init_buffers();
+        self.mss = core::cmp::min(mss as u32, TCP_MSS as u32);
+        self.tcp_sync_mss(route::ip_dst_mtu(self.remote_ip));
+        self.snd_wscale = 0;
+        self.rcv_wscale = 0;
+        self.wscale_ok = false;
+        self.sack_ok = false;
+        self.snd_wnd = tcp_hdr.window() as u32;
+        self.snd_wl1 = seq;
+        self.snd_wl2 = ack_num;
+        self.state = TcpState::TCP_ESTABLISHED;
+        self.tcp_init_congestion_control();
+    }
+
     /// 处理接收到的 SYN-ACK 包（客户端）
-    fn handle_synack_recv(&mut self, tcp_hdr: &TcpHdr) -> Result<(), ()> {
+    fn handle_synack_recv(&mut self, tcp_hdr: &TcpHdr, opts: &TcpOptions) -> Result<(), ()> {
         // 检查 ACK 是否确认了我们的 SYN
         let ack_num = TcpSeq::from_be(tcp_hdr.ack_seq);
-        if ack_num != self.snd_nxt.wrapping_add(1) {
+        if ack_num != self.snd_nxt {
             return Err(()); // ACK 不正确
         }
 
         // 记录服务器的初始序列号
-        let server_isn = tcp_hdr.seq;
+        let server_isn = TcpSeq::from_be(tcp_hdr.seq);
         self.rcv_nxt = server_isn.wrapping_add(1);
+        self.tcp_syn_negotiate(opts);
 
-        // 更新发送序列号
-        self.snd_una = self.snd_nxt.wrapping_add(1);
-        self.snd_nxt = self.snd_una;
+        // SYN 已被确认；未重传过的 SYN 可以作为第一个 RTT 样本
+        self.snd_una = ack_num;
+        if self.rtt_start != 0 && self.backoff == 0 {
+            let now = crate::drivers::timer::get_jiffies();
+            self.tcp_rtt_estimator(now.saturating_sub(self.rtt_start));
+        }
+        self.rtt_start = 0;
+        self.backoff = 0;
+        self.retransmit_deadline = 0;
+        self.snd_wnd = tcp_hdr.window() as u32;
+        self.snd_wl1 = server_isn;
+        self.snd_wl2 = ack_num;
 
         // 发送 ACK（三次握手第三步）
-        self.send_ack()?;
         self.state = TcpState::TCP_ESTABLISHED;
+        self.tcp_init_congestion_control();
+        self.tcp_send_ack()?;
 
         Ok(())
     }
 
     /// 处理接收到的 ACK 包（服务器端）
-    fn handle_ack_recv(&mut self) -> Result<(), ()> {
+    fn handle_ack_recv(&mut self, tcp_hdr: &TcpHdr) -> Result<(), ()> {
         // 检查 ACK 是否确认了我们的 SYN-ACK
-        // 三次握手完成，连接建立
+        let ack_num = TcpSeq::from_be(tcp_hdr.ack_seq);
+        if ack_num != self.snd_nxt {
+            return Err(());
+        }
+
+        // 三次握手完成，连接建立；此后对端窗口按扩大因子放大
+        self.snd_una = ack_num;
+        self.snd_wnd = (tcp_hdr.window() as u32) << self.snd_wscale;
+        self.snd_wl1 = TcpSeq::from_be(tcp_hdr.seq);
+        self.snd_wl2 = ack_num;
+        self.backoff = 0;
+        self.retransmit_deadline = 0;
         self.state = TcpState::TCP_ESTABLISHED;
+        self.tcp_init_congestion_control();
         Ok(())
     }
 
-    /// 处理接收到的数据
-    fn handle_data_recv(&mut self, tcp_hdr: &TcpHdr, data: &[u8]) -> Result<(), ()> {
-        // 检查序列号
-        let seq = TcpSeq::from_be(tcp_hdr.seq);
-        if seq != self.rcv_nxt {
-            return Err(()); // 序列号不匹配
+    /// 连接终止，停止所有定时器 (tcp_done)
+    ///
+    /// # 参数
+    /// - `err`: 报告给应用的错误码，正常关闭为 0
+    pub(crate) fn tcp_done(&mut self, err: i32) {
+        if self.state == TcpState::TCP_LISTEN {
+            self.inet_csk_listen_stop();
         }
-
-        // 更新接收序列号
-        self.rcv_nxt = self.rcv_nxt.wrapping_add(data.len() as u32);
-
-        // TODO: 将数据放入接收队列
-
-        // 发送 ACK（确认数据）
-        self.send_ack()?;
-
-        Ok(())
+        // 尚未被 accept 的子连接从监听 socket 的队列中删除
+        if let Some((parent, idx)) = self.parent.take() {
+            if let Some(listener) = tcp_sock_deref(parent) {
+                listener.reqsk_queue.unlink(idx);
+            }
+        }
+        self.state = TcpState::TCP_CLOSE;
+        self.err = err;
+        self.retransmit_deadline = 0;
+        self.delack_deadline = 0;
+        self.timewait_deadline = 0;
+        self.pacing_deadline = 0;
+        self.tcp_unhash();
     }
 
-    /// 处理接收到的 FIN 包
-    fn handle_fin_recv(&mut self) -> Result<(), ()> {
-        // 更新接收序列号（FIN 占据一个序列号）
-        self.rcv_nxt = self.rcv_nxt.wrapping_add(1);
+    /// 监听 socket 关闭：终止所有尚未被 accept 的子连接 (inet_csk_listen_stop)
+    ///
+    /// 握手未完成的直接丢弃，已建立的向对端发送 RST
+    fn inet_csk_listen_stop(&mut self) {
+        let mut children = core::mem::take(&mut self.reqsk_queue.syn_queue);
+        children.extend(self.reqsk_queue.accept_queue.drain(..));
+        for idx in children {
+            if let Some(child) = get_tcp_manager().get_mut(TcpSockRef::Child(idx)) {
+                child.parent = None;
+                if child.state != TcpState::TCP_SYN_RECV {
+                    let _ = child.tcp_send_active_reset();
+                }
+                child.tcp_done(-104); // ECONNRESET
+            }
+        }
+    }
 
-        // 发送 ACK
-        self.send_ack()?;
+    /// 按当前状态把 socket 插入查找哈希表 (inet_hash / __inet_hash_connect)
+    ///
+    /// 监听 socket 进入监听哈希表，其他已同步或正在握手的连接进入已建立连接的哈希表
+    pub(crate) fn tcp_hash(&mut self, sk_ref: TcpSockRef) {
+        self.tcp_unhash();
+        let hashed = match self.state {
+            TcpState::TCP_CLOSE => return,
+            TcpState::TCP_LISTEN => {
+                let key = InetBindKey { addr: INADDR_ANY, port: self.local_port };
+                TCP_LHASH.insert(key, sk_ref);
+                TcpHashed::Listen(key)
+            }
+            _ => {
+                let key = InetEhashKey { faddr: self.remote_ip, fport: self.remote_port, lport: self.local_port };
+                TCP_EHASH.insert(key, sk_ref);
+                TcpHashed::Established(key)
+            }
+        };
+        self.hashed = Some((sk_ref, hashed));
+    }
 
-        // 根据当前状态转换
-        match self.state {
-            TcpState::TCP_ESTABLISHED => {
-                self.state = TcpState::TCP_CLOSE_WAIT;
+    /// 从查找哈希表中删除 (inet_unhash)
+    pub(crate) fn tcp_unhash(&mut self) {
+        match self.hashed.take() {
+            Some((sk_ref, TcpHashed::Established(key))) => {
+                TCP_EHASH.remove(&key, sk_ref);
             }
-            TcpState::TCP_FIN_WAIT1 => {
-                self.state = TcpState::TCP_TIME_WAIT;
+            Some((sk_ref, TcpHashed::Listen(key))) => {
+                TCP_LHASH.remove(&key, sk_ref);
             }
-            _ => {}
+            None => {}
         }
-
-        Ok(())
     }
 
     /// 发送数据
     ///
+    /// 数据复制到发送缓冲区后，在拥塞窗口和对端窗口允许的范围内立即发出，
+    /// 其余部分随 ACK 到达陆续发出
+    ///
     /// # 参数
     /// - `data`: 数据
-    pub fn send(&mut self, data: &[u8]) -> Result<usize, ()> {
-        if self.state != TcpState::TCP_ESTABLISHED {
-            return Err(());
-        }
+    ///
+    /// # 返回
+    /// 放入发送缓冲区的字节数；发送缓冲区已满返回 -EAGAIN
+    pub fn send(&mut self, data: &[u8]) -> Result<usize, i32> {
+        self.sendmsg(data, false)
+    }
 
-        // TODO: 发送数据包
-        // 更新序列号
-        self.snd_nxt += data.len() as u32;
+    /// 发送数据，可以声明后面还有数据 (tcp_sendmsg)
+    ///
+    /// 多次小写入在发送缓冲区中连成一段，由 tcp_write_xmit 按 Nagle、cork 与
+    /// MSG_MORE 决定末尾的零头是立即发出还是等待凑满一个 MSS
+    ///
+    /// # 参数
+    /// - `data`: 数据
+    /// - `more`: MSG_MORE，末尾的零头等下一次写入
+    ///
+    /// # 返回
+    /// 放入发送缓冲区的字节数；发送缓冲区已满返回 -EAGAIN
+    pub fn sendmsg(&mut self, data: &[u8], more: bool) -> Result<usize, i32> {
+        match self.state {
+            TcpState::TCP_ESTABLISHED | TcpState::TCP_CLOSE_WAIT if !self.fin_queued => {}
+            _ => return Err(if self.err != 0 { self.err } else { -32 }), // EPIPE
+        }
 
-        Ok(data.len())
+        let copied = self.send_buf.push(data);
+        if copied == 0 && !data.is_empty() {
+            return Err(-11); // EAGAIN
+        }
+        self.msg_more = more;
+        self.tcp_write_xmit();
+        Ok(copied)
     }
 
     /// 接收数据
@@ -461,30 +1150,66 @@ impl TcpSocket {
     /// # 参数
     /// - `buf`: 缓冲区
     /// - `len`: 缓冲区长度
-    pub fn recv(&mut self, buf: &mut [u8], _len: usize) -> Result<usize, ()> {
-        if self.state != TcpState::TCP_ESTABLISHED {
-            return Err(());
+    ///
+    /// # 返回
+    /// 读到的字节数；对端已关闭且数据读完返回 0，暂时没有数据返回 -EAGAIN
+    pub fn recv(&mut self, buf: &mut [u8], len: usize) -> Result<usize, i32> {
+        match self.state {
+            TcpState::TCP_CLOSE | TcpState::TCP_LISTEN | TcpState::TCP_SYN_SENT
+            | TcpState::TCP_SYN_RECV => {
+                // 连接关闭后缓冲区中剩余的数据仍可读出
+                if self.recv_buf.is_empty() {
+                    return Err(if self.err != 0 { self.err } else { -107 }); // ENOTCONN
+                }
+            }
+            _ => {}
+        }
+
+        let len = core::cmp::min(len, buf.len());
+        let copied = self.recv_buf.pop(&mut buf[..len]);
+        if copied == 0 {
+            if self.fin_rcvd || self.state == TcpState::TCP_CLOSE {
+                return Ok(0);
+            }
+            return Err(-11); // EAGAIN
         }
 
-        // TODO: 从接收队列获取数据
-        // 更新接收序列号
+        // 读走数据后窗口变大，必要时立即通告
+        self.tcp_cleanup_rbuf();
+        Ok(copied)
+    }
 
-        Ok(0) // 简化实现：暂时返回 0
+    /// recv 是否会返回 -EAGAIN：连接可以收数据，但接收缓冲区为空且没有收到 FIN
+    pub fn recv_would_block(&self) -> bool {
+        self.recv_buf.is_empty()
+            && !self.fin_rcvd
+            && !matches!(
+                self.state,
+                TcpState::TCP_CLOSE | TcpState::TCP_LISTEN | TcpState::TCP_SYN_SENT | TcpState::TCP_SYN_RECV
+            )
     }
 
     /// 关闭连接
+    ///
+    /// 已建立的连接在发送缓冲区中的数据发完后发送 FIN
     pub fn close(&mut self) {
         match self.state {
             TcpState::TCP_ESTABLISHED => {
                 self.state = TcpState::TCP_FIN_WAIT1;
-                // TODO: 发送 FIN 包
+                self.fin_queued = true;
+                self.tcp_write_xmit();
             }
             TcpState::TCP_CLOSE_WAIT => {
                 self.state = TcpState::TCP_LAST_ACK;
-                // TODO: 发送 FIN 包
+                self.fin_queued = true;
+                self.tcp_write_xmit();
+            }
+            TcpState::TCP_FIN_WAIT1 | TcpState::TCP_FIN_WAIT2 | TcpState::TCP_CLOSING
+            | TcpState::TCP_LAST_ACK | TcpState::TCP_TIME_WAIT => {
+                // 已在关闭过程中
             }
             _ => {
-                self.state = TcpState::TCP_CLOSE;
+                self.tcp_done(0);
             }
         }
     }
@@ -492,128 +1217,213 @@ impl TcpSocket {
 
 /// TCP 连接管理器
 ///
-/// 管理所有 TCP 连接，处理接收到的 TCP 包
+/// 管理被动打开产生的连接：监听 Socket 收到 SYN 后创建子连接，放入连接槽位并插入
+/// 已建立连接的哈希表；accept 把连接移到 socket 表，未被 accept 的连接关闭后槽位在
+/// 定时器遍历时回收
 pub struct TcpConnectionManager {
     /// 监听 Socket 列表
     listen_sockets: alloc::vec::Vec<TcpSocket>,
-    /// 已建立的连接
-    established_connections: alloc::vec::Vec<TcpSocket>,
-    /// 待处理连接队列（用于 accept）
-    pending_connections: alloc::vec::Vec<TcpSocket>,
+    /// 被动打开的连接，下标即 TcpSockRef::Child 的编号
+    connections: alloc::vec::Vec<Option<TcpSocket>>,
+    /// 空闲的连接槽位
+    free_slots: alloc::vec::Vec<usize>,
 }
 
 impl TcpConnectionManager {
-    pub fn new() -> Self {
+    pub const fn new() -> Self {
         Self {
             listen_sockets: alloc::vec::Vec::new(),
-            established_connections: alloc::vec::Vec::new(),
-            pending_connections: alloc::vec::Vec::new(),
+            connections: alloc::vec::Vec::new(),
+            free_slots: alloc::vec::Vec::new(),
         }
     }
 
     /// 添加监听 Socket
     pub fn add_listen_socket(&mut self, socket: TcpSocket) {
+        let idx = self.listen_sockets.len();
         self.listen_sockets.push(socket);
+        self.listen_sockets[idx].tcp_hash(TcpSockRef::Listen(idx));
     }
 
-    /// 处理接收到的 TCP 包
-    ///
-    /// 根据目标端口和状态分发到对应的 Socket
-    pub fn handle_tcp_packet(&mut self, skb: &SkBuff, src_ip: u32, dest_port: TcpPort) -> Result<(), ()> {
-        // 解析 TCP 头部
-        let tcp_hdr = match tcp_parse_packet(skb) {
-            Some(hdr) => hdr,
-            None => return Ok(()),
-        };
+    /// 按句柄取管理器中的 socket
+    fn get_mut(&mut self, sk_ref: TcpSockRef) -> Option<&mut TcpSocket> {
+        match sk_ref {
+            TcpSockRef::Child(idx) => self.connections.get_mut(idx).and_then(|s| s.as_mut()),
+            TcpSockRef::Listen(idx) => self.listen_sockets.get_mut(idx),
+            TcpSockRef::Fd(_) => None,
+        }
+    }
 
-        let src_port = TcpPort::from_be(tcp_hdr.source);
-
-        // 查找匹配的 Socket
-        // 1. 首先检查已建立的连接
-        for socket in &mut self.established_connections.iter_mut() {
-            if socket.local_port == dest_port
-                && socket.remote_port == src_port
-                && socket.remote_ip == src_ip
-            {
-                // 找到匹配的连接，处理包
-                let _ = socket.handle_packet(tcp_hdr, unsafe {
-                    core::slice::from_raw_parts(
-                        skb.data.add(tcp_hdr.header_len()),
-                        (skb.len as usize - tcp_hdr.header_len())
-                    )
-                });
-                return Ok(());
-            }
-        }
-
-        // 2. 检查监听 Socket
-        for socket in &mut self.listen_sockets.iter_mut() {
-            if socket.local_port == dest_port && socket.state == TcpState::TCP_LISTEN {
-                // 创建新的连接
-                let mut new_socket = TcpSocket::new();
-                new_socket.local_port = dest_port;
-                new_socket.remote_port = src_port;
-                new_socket.remote_ip = src_ip;
-                new_socket.state = TcpState::TCP_SYN_RECV;
-
-                // 处理 SYN 包
-                if tcp_hdr.syn() && !tcp_hdr.ack() {
-                    let _ = new_socket.handle_packet(tcp_hdr, &[]);
-
-                    // 将连接加入待处理队列
-                    self.pending_connections.push(new_socket);
-                }
-                return Ok(());
-            }
-        }
-
-        // 3. 检查待处理连接（SYN_SENT 状态）
-        let mut idx_to_move: Option<usize> = None;
-        for (idx, socket) in self.pending_connections.iter_mut().enumerate() {
-            if socket.local_port == dest_port
-                && socket.remote_port == src_port
-                && socket.remote_ip == src_ip
-            {
-                let _ = socket.handle_packet(tcp_hdr, unsafe {
-                    core::slice::from_raw_parts(
-                        skb.data.add(tcp_hdr.header_len()),
-                        (skb.len as usize - tcp_hdr.header_len())
-                    )
-                });
-
-                // 如果连接建立，标记要移动到已建立连接列表
-                if socket.state == TcpState::TCP_ESTABLISHED {
-                    idx_to_move = Some(idx);
-                }
-                break;
+    /// 被动打开的连接数（含正在握手的）
+    pub fn connection_count(&self) -> usize {
+        self.connections.len() - self.free_slots.len()
+    }
+
+    /// 把连接放入空闲槽位并插入哈希表，返回槽位编号
+    fn add_connection(&mut self, socket: TcpSocket) -> usize {
+        let idx = match self.free_slots.pop() {
+            Some(idx) => idx,
+            None => {
+                self.connections.push(None);
+                self.connections.len() - 1
             }
+        };
+        let slot = self.connections[idx].insert(socket);
+        slot.tcp_hash(TcpSockRef::Child(idx));
+        idx
+    }
+
+    /// 取走槽位中的连接（accept），槽位回收
+    fn take_connection(&mut self, idx: usize) -> Option<TcpSocket> {
+        let socket = self.connections.get_mut(idx)?.take()?;
+        self.free_slots.push(idx);
+        Some(socket)
+    }
+
+    /// 监听端口收到 SYN：创建子连接并回复 SYN-ACK (tcp_conn_request)
+    ///
+    /// 子连接继承监听 Socket 的拥塞控制算法，记录所属的监听 socket
+    ///
+    /// # 返回
+    /// 子连接的槽位编号
+    pub fn accept_syn(
+        &mut self,
+        tcp_hdr: &TcpHdr,
+        src_ip: u32,
+        dest_port: TcpPort,
+        listener: TcpSockRef,
+        ca_ops: &'static TcpCongestionOps,
+    ) -> Option<usize> {
+        if !tcp_hdr.syn() || tcp_hdr.ack() {
+            return None;
         }
+        // 创建新的连接，由 LISTEN 状态处理 SYN 后进入 SYN_RECV
+        let mut new_socket = TcpSocket::new();
+        new_socket.local_port = dest_port;
+        new_socket.remote_port = TcpPort::from_be(tcp_hdr.source);
+        new_socket.remote_ip = src_ip;
+        new_socket.bound = true;
+        new_socket.state = TcpState::TCP_LISTEN;
+        new_socket.ca_ops = ca_ops;
+
+        if new_socket.handle_packet(tcp_hdr, &[]).is_err() || new_socket.state != TcpState::TCP_SYN_RECV {
+            return None;
+        }
+        let idx = self.add_connection(new_socket);
+        if let Some(child) = self.get_mut(TcpSockRef::Child(idx)) {
+            child.parent = Some((listener, idx));
+        }
+        Some(idx)
+    }
 
-        // 移动已建立的连接（如果在循环外）
-        if let Some(idx) = idx_to_move {
-            let socket = self.pending_connections.remove(idx);
-            self.established_connections.push(socket);
+    /// 校验通过的 SYN cookie：直接创建已建立的子连接 (cookie_v4_check)
+    ///
+    /// # 返回
+    /// 子连接的槽位编号
+    fn accept_cookie(
+        &mut self,
+        tcp_hdr: &TcpHdr,
+        src_ip: u32,
+        dest_port: TcpPort,
+        mss: u16,
+        listener: TcpSockRef,
+        ca_ops: &'static TcpCongestionOps,
+    ) -> usize {
+        let mut new_socket = TcpSocket::new();
+        new_socket.local_port = dest_port;
+        new_socket.remote_ip = src_ip;
+        new_socket.bound = true;
+        new_socket.ca_ops = ca_ops;
+        new_socket.tcp_cookie_open(tcp_hdr, mss);
+        let idx = self.add_connection(new_socket);
+        if let Some(child) = self.get_mut(TcpSockRef::Child(idx)) {
+            child.parent = Some((listener, idx));
         }
+        idx
+    }
 
-        Ok(())
+    /// 遍历管理器中的所有连接
+    pub fn for_each_connection(&mut self, mut f: impl FnMut(&mut TcpSocket)) {
+        for (idx, slot) in self.connections.iter_mut().enumerate() {
+            let socket = match slot {
+                Some(socket) => socket,
+                None => continue,
+            };
+            f(socket);
+            // 已关闭的连接不再保留
+            if socket.state == TcpState::TCP_CLOSE {
+                socket.tcp_unhash();
+                *slot = None;
+                self.free_slots.push(idx);
+            }
+        }
     }
 }
 
 /// 全局 TCP 连接管理器
-static mut TCP_CONNECTION_MANAGER: core::mem::MaybeUninit<TcpConnectionManager> = core::mem::MaybeUninit::<TcpConnectionManager>::uninit();
+static mut TCP_CONNECTION_MANAGER: TcpConnectionManager = TcpConnectionManager::new();
 
 /// 初始化 TCP 连接管理器
 pub fn init_tcp_manager() {
     unsafe {
-        TCP_CONNECTION_MANAGER.write(TcpConnectionManager::new());
+        *core::ptr::addr_of_mut!(TCP_CONNECTION_MANAGER) = TcpConnectionManager::new();
     }
 }
 
 /// 获取 TCP 连接管理器
 pub fn get_tcp_manager() -> &'static mut TcpConnectionManager {
-    unsafe { TCP_CONNECTION_MANAGER.assume_init_mut() }
+    unsafe { &mut *core::ptr::addr_of_mut!(TCP_CONNECTION_MANAGER) }
+}
+
+/// TCP 锁：保护 socket 表与连接管理器中的所有连接 (lock_sock / bh_lock_sock)
+///
+/// 接收路径在 NAPI 的中断上下文中运行，进程上下文持锁时必须关中断
+static TCP_LOCK: Mutex<()> = Mutex::new(());
+
+/// 在关中断并持有 TCP 锁的状态下执行
+///
+/// 持锁期间发往本机的报文段进入回环积压队列，释放锁后再处理 (release_sock)
+pub fn with_tcp_lock<R>(f: impl FnOnce() -> R) -> R {
+    let ret = {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        let _guard = TCP_LOCK.lock();
+        f()
+    };
+    crate::drivers::net::loopback::loopback_process_backlog();
+    ret
+}
+
+/// 已建立连接的哈希表，按四元组查找 (tcp_hashinfo.ehash)
+static TCP_EHASH: InetHashTable<InetEhashKey, TcpSockRef> = InetHashTable::new();
+
+/// 监听 socket 的哈希表，按 (地址, 端口) 查找 (tcp_hashinfo.lhash2)
+static TCP_LHASH: InetHashTable<InetBindKey, TcpSockRef> = InetHashTable::new();
+
+/// 按句柄取 socket（调用者持有 TCP 锁）
+fn tcp_sock_deref(sk_ref: TcpSockRef) -> Option<&'static mut TcpSocket> {
+    match sk_ref {
+        TcpSockRef::Fd(fd) => unsafe { (*core::ptr::addr_of_mut!(TCP_SOCKET_TABLE)).get_mut(fd) },
+        _ => get_tcp_manager().get_mut(sk_ref),
+    }
+}
+
+/// 已建立连接哈希表中的条目数
+pub fn tcp_ehash_len() -> usize {
+    TCP_EHASH.len()
+}
+
+/// 遍历所有 TCP 连接（调用者持有 TCP 锁）
+pub(crate) fn for_each_tcp_socket(mut f: impl FnMut(&mut TcpSocket)) {
+    unsafe {
+        let table = &mut *core::ptr::addr_of_mut!(TCP_SOCKET_TABLE);
+        for socket in table.sockets[..table.count].iter_mut().flatten() {
+            f(socket);
+        }
+    }
+    get_tcp_manager().for_each_connection(f);
 }
 
+
 /// 全局 TCP Socket 表
 ///
 /// 简化实现：固定大小的 Socket 表
@@ -633,19 +1443,35 @@ impl TcpSocketTable {
 
     /// 分配 Socket
     fn alloc(&mut self) -> Result<usize, ()> {
+        self.install(TcpSocket::new())
+    }
+
+    /// 把已有的 Socket 放入新的表项（accept 得到的连接）
+    fn install(&mut self, socket: TcpSocket) -> Result<usize, ()> {
         if self.count >= TCP_SOCKET_TABLE_SIZE {
             return Err(());
         }
 
         let fd = self.count;
-        self.sockets[fd] = Some(TcpSocket::new());
+        self.sockets[fd] = Some(socket);
         self.count += 1;
         Ok(fd)
     }
 
-    /// 释放 Socket
+    /// 表是否已满
+    fn is_full(&self) -> bool {
+        self.count >= TCP_SOCKET_TABLE_SIZE
+    }
+
+    /// 释放 Socket；监听 socket 同时终止未被 accept 的连接
     fn free(&mut self, fd: usize) {
         if fd < self.count {
+            if let Some(socket) = self.sockets[fd].as_mut() {
+                if socket.state == TcpState::TCP_LISTEN {
+                    socket.tcp_done(0);
+                }
+                socket.tcp_unhash();
+            }
             self.sockets[fd] = None;
             // 不减少 count，简化实现
         }
@@ -691,9 +1517,9 @@ pub fn tcp_socket_alloc() -> Result<i32, i32> {
 /// # 参数
 /// - `fd`: Socket 文件描述符
 pub fn tcp_socket_free(fd: i32) {
-    unsafe {
+    with_tcp_lock(|| unsafe {
         TCP_SOCKET_TABLE.free(fd as usize);
-    }
+    })
 }
 
 /// 获取 TCP Socket
@@ -709,6 +1535,109 @@ pub fn tcp_socket_get(fd: i32) -> Option<&'static mut TcpSocket> {
     }
 }
 
+fn tcp_file_read(file: &File, buf: &mut [u8]) -> isize {
+    match tcp_sock_id(file) {
+        Some(sk) => tcp_recv(sk, buf),
+        None => -9, // EBADF
+    }
+}
+
+fn tcp_file_write(file: &File, buf: &[u8]) -> isize {
+    match tcp_sock_id(file) {
+        Some(sk) => tcp_sendmsg(sk, buf, false),
+        None => -9, // EBADF
+    }
+}
+
+/// 最后一个文件引用释放时关闭连接 (inet_release)
+///
+/// 已建立的连接排队 FIN，表项保留到关闭过程结束；未连接与监听的 socket 立即释放表项
+fn tcp_file_close(file: &File) -> i32 {
+    let sk = match unsafe { (*file.private_data.get()).take() } {
+        Some(ptr) => ptr as usize,
+        None => return -9, // EBADF
+    };
+    with_tcp_lock(|| unsafe {
+        let table = &mut *core::ptr::addr_of_mut!(TCP_SOCKET_TABLE);
+        if let Some(socket) = table.get_mut(sk) {
+            socket.close();
+            if socket.state == TcpState::TCP_CLOSE {
+                table.free(sk);
+            }
+        }
+    });
+    0
+}
+
+/// TCP 套接字文件操作
+static TCP_FILE_OPS: FileOps = FileOps {
+    read: Some(tcp_file_read),
+    write: Some(tcp_file_write),
+    lseek: None,
+    close: Some(tcp_file_close),
+    read_iter: None,
+    write_iter: None,
+    poll: None,
+};
+
+/// 为 TCP Socket 创建文件 (sock_alloc_file)
+///
+/// 文件的私有数据保存 socket 表中的编号
+pub fn tcp_sock_file(sk: i32, nonblock: bool) -> Arc<File> {
+    let mut flags = FileFlags::O_RDWR;
+    if nonblock {
+        flags |= FileFlags::O_NONBLOCK;
+    }
+    let file = Arc::new(File::new(FileFlags::new(flags)));
+    file.set_ops(&TCP_FILE_OPS);
+    file.set_private_data(sk as usize as *mut u8);
+    file
+}
+
+/// 文件是否为 TCP 套接字
+pub fn is_tcp_socket(file: &File) -> bool {
+    unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &TCP_FILE_OPS))
+}
+
+/// 由文件得到 socket 表中的编号
+pub fn tcp_sock_id(file: &File) -> Option<i32> {
+    if !is_tcp_socket(file) {
+        return None;
+    }
+    unsafe { *file.private_data.get() }.map(|ptr| ptr as usize as i32)
+}
+
+/// 由进程的文件描述符得到 socket 表中的编号 (sockfd_lookup)
+///
+/// # 返回
+/// 描述符不存在或不是 TCP 套接字时返回 None
+pub fn tcp_socket_fd(fd: i32) -> Option<i32> {
+    if fd < 0 {
+        return None;
+    }
+    let file = unsafe { crate::fs::get_file_fd(fd as usize) }?;
+    tcp_sock_id(&file)
+}
+
+/// 把 socket 装入进程的文件表
+///
+/// # 返回
+/// 成功返回文件描述符；文件表已满时释放 socket 并返回 -EMFILE
+pub fn tcp_sock_install(sk: i32, nonblock: bool, cloexec: bool) -> i32 {
+    let file = tcp_sock_file(sk, nonblock);
+    if cloexec {
+        file.set_cloexec(true);
+    }
+    match unsafe { crate::fs::file::get_file_fd_install(file.clone()) } {
+        Some(fd) => fd as i32,
+        None => {
+            // 文件的最后一个引用：关闭 socket
+            crate::fs::file::fput(file);
+            -24 // EMFILE
+        }
+    }
+}
+
 /// 绑定 Socket 到端口
 ///
 /// # 参数
@@ -730,6 +1659,74 @@ pub fn tcp_bind(fd: i32, port: TcpPort) -> i32 {
     }
 }
 
+/// 发送数据
+///
+/// # 参数
+/// - `fd`: Socket 文件描述符
+/// - `buf`: 数据
+///
+/// # 返回
+/// 成功返回发送的字节数，失败返回错误码
+pub fn tcp_send(fd: i32, buf: &[u8]) -> isize {
+    tcp_sendmsg(fd, buf, false)
+}
+
+/// 发送数据，`more` 为 MSG_MORE：末尾不足一个 MSS 的数据等下一次写入
+///
+/// # 返回
+/// 成功返回放入发送缓冲区的字节数，失败返回错误码
+pub fn tcp_sendmsg(fd: i32, buf: &[u8], more: bool) -> isize {
+    with_tcp_lock(|| unsafe {
+        if let Some(socket) = TCP_SOCKET_TABLE.get_mut(fd as usize) {
+            match socket.sendmsg(buf, more) {
+                Ok(len) => len as isize,
+                Err(e) => e as isize,
+            }
+        } else {
+            -9 // EBADF
+        }
+    })
+}
+
+/// 接收数据
+///
+/// # 参数
+/// - `fd`: Socket 文件描述符
+/// - `buf`: 缓冲区
+///
+/// # 返回
+/// 成功返回接收的字节数，失败返回错误码
+pub fn tcp_recv(fd: i32, buf: &mut [u8]) -> isize {
+    with_tcp_lock(|| unsafe {
+        if let Some(socket) = TCP_SOCKET_TABLE.get_mut(fd as usize) {
+            let len = buf.len();
+            match socket.recv(buf, len) {
+                Ok(len) => len as isize,
+                Err(e) => e as isize,
+            }
+        } else {
+            -9 // EBADF
+        }
+    })
+}
+
+/// 接收缓冲区为空且设置了 SO_BUSY_POLL 时忙轮询网卡，等待数据到达 (sk_busy_loop)
+///
+/// # 参数
+/// - `nonblock`: 带 MSG_DONTWAIT，只轮询一轮
+pub fn tcp_busy_loop(fd: i32, nonblock: bool) {
+    let usecs = with_tcp_lock(|| unsafe {
+        TCP_SOCKET_TABLE.get(fd as usize)
+            .filter(|socket| socket.recv_would_block())
+            .map_or(0, |socket| socket.busy_poll_usecs)
+    });
+    crate::net::busy_poll::napi_busy_loop(usecs, nonblock, || {
+        with_tcp_lock(|| unsafe {
+            TCP_SOCKET_TABLE.get(fd as usize).map_or(true, |socket| !socket.recv_would_block())
+        })
+    });
+}
+
 /// 监听端口
 ///
 /// # 参数
@@ -737,18 +1734,35 @@ pub fn tcp_bind(fd: i32, port: TcpPort) -> i32 {
 /// - `backlog`: 等待队列长度
 ///
 /// # 返回
-/// 成功返回 0，失败返回错误码
+/// 成功返回 0；端口已被不允许共享的 socket 监听时返回 -EADDRINUSE，
+/// 两者都设置了 SO_REUSEPORT 时组成一组，新连接在组内按四元组哈希分配
 pub fn tcp_listen(fd: i32, backlog: u32) -> i32 {
-    unsafe {
+    with_tcp_lock(|| unsafe {
         if let Some(socket) = TCP_SOCKET_TABLE.get_mut(fd as usize) {
+            if socket.state == TcpState::TCP_LISTEN {
+                return match socket.listen(backlog) {
+                    Ok(()) => 0,
+                    Err(()) => -5, // EIO
+                };
+            }
+            // 端口冲突检查 (inet_csk_bind_conflict)：组内成员都设置了 SO_REUSEPORT，看第一个即可
+            let key = InetBindKey { addr: INADDR_ANY, port: socket.local_port };
+            if let Some(other) = TCP_LHASH.lookup(&key).and_then(tcp_sock_deref) {
+                if !(other.reuseport && socket.reuseport) {
+                    return -98; // EADDRINUSE
+                }
+            }
             match socket.listen(backlog) {
-                Ok(()) => 0,
+                Ok(()) => {
+                    socket.tcp_hash(TcpSockRef::Fd(fd as usize));
+                    0
+                }
                 Err(()) => -5, // EIO
             }
         } else {
             -5 // EBADF
         }
-    }
+    })
 }
 
 /// 连接到远程地址
@@ -761,39 +1775,194 @@ pub fn tcp_listen(fd: i32, backlog: u32) -> i32 {
 /// # 返回
 /// 成功返回 0，失败返回错误码
 pub fn tcp_connect(fd: i32, ip: u32, port: TcpPort) -> i32 {
-    unsafe {
+    with_tcp_lock(|| unsafe {
         if let Some(socket) = TCP_SOCKET_TABLE.get_mut(fd as usize) {
+            // 持有 TCP 锁，SYN-ACK 只能在插入哈希表之后被处理
+            socket.tcp_unhash();
             match socket.connect(ip, port) {
-                Ok(()) => 0,
+                Ok(()) => {
+                    socket.tcp_hash(TcpSockRef::Fd(fd as usize));
+                    0
+                }
                 Err(()) => -5, // EIO
             }
         } else {
             -5 // EBADF
         }
+    })
+}
+
+/// 设置 socket 选项 (sock_setsockopt / do_tcp_setsockopt)
+///
+/// # 参数
+/// - `fd`: Socket 文件描述符
+/// - `level`: 选项层级，支持 SOL_SOCKET 与 SOL_TCP
+/// - `optname`: 选项名
+/// - `optval`: 选项值
+///
+/// # 返回
+/// 成功返回 0，失败返回错误码
+pub fn tcp_setsockopt(fd: i32, level: i32, optname: i32, optval: &[u8]) -> i32 {
+    if level != SOL_TCP && level != SOL_SOCKET {
+        return -92; // ENOPROTOOPT
     }
+    with_tcp_lock(|| unsafe {
+        let socket = match TCP_SOCKET_TABLE.get_mut(fd as usize) {
+            Some(socket) => socket,
+            None => return -9, // EBADF
+        };
+        match (level, optname) {
+            (SOL_SOCKET, SO_REUSEPORT) => {
+                if optval.len() < 4 {
+                    return -22; // EINVAL
+                }
+                socket.reuseport = i32::from_ne_bytes([optval[0], optval[1], optval[2], optval[3]]) != 0;
+                0
+            }
+            (SOL_SOCKET, SO_BUSY_POLL) => match crate::net::busy_poll::parse_sockopt(optval) {
+                Ok(usecs) => {
+                    socket.busy_poll_usecs = usecs;
+                    0
+                }
+                Err(e) => e,
+            },
+            (SOL_TCP, TCP_NODELAY) | (SOL_TCP, TCP_CORK) => {
+                if optval.len() < 4 {
+                    return -22; // EINVAL
+                }
+                let on = i32::from_ne_bytes([optval[0], optval[1], optval[2], optval[3]]) != 0;
+                if optname == TCP_NODELAY {
+                    socket.tcp_set_nodelay(on);
+                } else {
+                    socket.tcp_set_cork(on);
+                }
+                0
+            }
+            (SOL_TCP, TCP_CONGESTION) => {
+                // 名称可以不以 NUL 结尾，最多 TCP_CA_NAME_MAX 字节
+                let len = core::cmp::min(optval.len(), crate::net::tcp_cong::TCP_CA_NAME_MAX);
+                let name = &optval[..len];
+                let name = &name[..name.iter().position(|&b| b == 0).unwrap_or(len)];
+                match core::str::from_utf8(name) {
+                    Ok(name) => match socket.tcp_set_congestion_control(name) {
+                        Ok(()) => 0,
+                        Err(e) => e,
+                    },
+                    Err(_) => -2, // ENOENT
+                }
+            }
+            _ => -92, // ENOPROTOOPT
+        }
+    })
 }
 
-/// 接受连接
+/// 读取 socket 选项 (sock_getsockopt / do_tcp_getsockopt)
 ///
 /// # 参数
 /// - `fd`: Socket 文件描述符
+/// - `level`: 选项层级，支持 SOL_SOCKET 与 SOL_TCP
+/// - `optname`: 选项名
+/// - `out`: 输出缓冲区
+///
+/// # 返回
+/// 成功返回写入的字节数，失败返回错误码
+pub fn tcp_getsockopt(fd: i32, level: i32, optname: i32, out: &mut [u8]) -> isize {
+    if level != SOL_TCP && level != SOL_SOCKET {
+        return -92; // ENOPROTOOPT
+    }
+    with_tcp_lock(|| unsafe {
+        let socket = match TCP_SOCKET_TABLE.get(fd as usize) {
+            Some(socket) => socket,
+            None => return -9, // EBADF
+        };
+        match (level, optname) {
+            (SOL_SOCKET, SO_REUSEPORT) => {
+                if out.len() < 4 {
+                    return -22; // EINVAL
+                }
+                out[..4].copy_from_slice(&(socket.reuseport as i32).to_ne_bytes());
+                4
+            }
+            (SOL_SOCKET, SO_BUSY_POLL) => {
+                if out.len() < 4 {
+                    return -22; // EINVAL
+                }
+                out[..4].copy_from_slice(&(socket.busy_poll_usecs as i32).to_ne_bytes());
+                4
+            }
+            (SOL_TCP, TCP_NODELAY) | (SOL_TCP, TCP_CORK) => {
+                if out.len() < 4 {
+                    return -22; // EINVAL
+                }
+                let on = if optname == TCP_NODELAY { socket.nodelay } else { socket.cork };
+                out[..4].copy_from_slice(&(on as i32).to_ne_bytes());
+                4
+            }
+            (SOL_TCP, TCP_CONGESTION) => {
+                let name = socket.ca_ops.name.as_bytes();
+                let len = core::cmp::min(out.len(), crate::net::tcp_cong::TCP_CA_NAME_MAX);
+                let n = core::cmp::min(name.len(), len);
+                out[..n].copy_from_slice(&name[..n]);
+                // 与 Linux 一致，缓冲区有剩余时补 NUL
+                out[n..len].fill(0);
+                len as isize
+            }
+            _ => -92, // ENOPROTOOPT
+        }
+    })
+}
+
+/// 接受连接：从监听 socket 的全连接队列取出最早完成握手的连接 (inet_csk_accept)
+///
+/// 连接从连接管理器移到 socket 表，以新的文件描述符重新插入哈希表。
+/// SO_REUSEPORT 组中每个监听 socket 有自己的队列，各线程 accept 各自的 socket 互不争用队列
+///
+/// # 参数
+/// - `fd`: 监听 Socket 的文件描述符
 ///
 /// # 返回
-/// 成功返回新的 Socket 文件描述符，失败返回错误码
+/// 成功返回新的 Socket 文件描述符；没有已完成的连接返回 -EAGAIN，
+/// 不是监听 socket 返回 -EINVAL
 pub fn tcp_accept(fd: i32) -> i32 {
-    unsafe {
-        if let Some(_socket) = TCP_SOCKET_TABLE.get(fd as usize) {
-            // TODO: 实现完整的 accept 逻辑
-            // 1. 从队列中获取待处理的连接
-            // 2. 创建新的 Socket
-            // 3. 返回新的文件描述符
-
-            // 简化实现：返回错误
-            -5 // EIO
-        } else {
-            -5 // EBADF
+    with_tcp_lock(|| unsafe {
+        let table = &mut *core::ptr::addr_of_mut!(TCP_SOCKET_TABLE);
+        let table_full = table.is_full();
+        let listener = match table.get_mut(fd as usize) {
+            Some(socket) => socket,
+            None => return -9, // EBADF
+        };
+        if listener.state != TcpState::TCP_LISTEN {
+            return -22; // EINVAL
         }
-    }
+        if listener.reqsk_queue.accept_queue.is_empty() {
+            return -11; // EAGAIN
+        }
+        if table_full {
+            return -24; // EMFILE
+        }
+        let idx = match listener.reqsk_queue.accept_queue.pop_front() {
+            Some(idx) => idx,
+            None => return -11, // EAGAIN
+        };
+        let busy_poll_usecs = listener.busy_poll_usecs;
+        let mut child = match get_tcp_manager().take_connection(idx) {
+            Some(child) => child,
+            None => return -103, // ECONNABORTED
+        };
+        child.tcp_unhash();
+        child.parent = None;
+        // 与 Linux 的 sk_clone_lock 一样继承监听 socket 的 SO_BUSY_POLL
+        child.busy_poll_usecs = busy_poll_usecs;
+        match table.install(child) {
+            Ok(new_fd) => {
+                if let Some(socket) = table.get_mut(new_fd) {
+                    socket.tcp_hash(TcpSockRef::Fd(new_fd));
+                }
+                new_fd as i32
+            }
+            Err(()) => -24, // EMFILE
+        }
+    })
 }
 
 /// 计算 TCP 校验和
@@ -807,55 +1976,66 @@ pub fn tcp_accept(fd: i32) -> i32 {
 /// # 返回
 /// 校验和 (网络字节序)
 pub fn tcp_checksum(shdr: u32, dhdr: u32, thdr: &TcpHdr, data: &[u8]) -> u16 {
-    let mut sum: u32 = 0;
-
     // 伪头部 (12 字节)
-    // 源 IP (4 字节)
-    sum += (shdr >> 16) & 0xFFFF;
-    sum += shdr & 0xFFFF;
-    // 目标 IP (4 字节)
-    sum += (dhdr >> 16) & 0xFFFF;
-    sum += dhdr & 0xFFFF;
-    // 保留 (1 字节) + 协议 (1 字节) + TCP 长度 (2 字节)
-    sum += (6u32 << 8); // TCP 协议号
-    let tcp_len = (thdr.header_len() + data.len()) as u16;
-    sum += tcp_len as u32;
+    let hdr_len = thdr.header_len().min(TCP_MIN_HLEN);
+    let tcp_len = (thdr.header_len() + data.len()) as u32;
+    let sum = checksum::csum_tcpudp_nofold(shdr, dhdr, tcp_len, 6);
 
     // TCP 头部 (假设最小 20 字节)
     let hdr_bytes = unsafe {
-        core::slice::from_raw_parts(
-            (thdr as *const TcpHdr) as *const u8,
-            thdr.header_len().min(20)
-        )
+        core::slice::from_raw_parts((thdr as *const TcpHdr) as *const u8, hdr_len)
     };
+    let sum = checksum::csum_partial(hdr_bytes, sum);
 
-    let mut i = 0;
-    while i + 1 < hdr_bytes.len() {
-        let word = u16::from_be_bytes([hdr_bytes[i], hdr_bytes[i + 1]]) as u32;
-        sum += word;
-        i += 2;
-    }
+    // 数据紧跟在偶数长度的头部之后
+    checksum::csum_fold(checksum::csum_partial(data, sum))
+}
 
-    // 数据
-    let mut i = 0;
-    while i + 1 < data.len() {
-        let word = u16::from_be_bytes([data[i], data[i + 1]]) as u32;
-        sum += word;
-        i += 2;
+/// 在数据前加上 TCP 头部与选项
+///
+/// # 参数
+/// - `skb`: 已放好数据的 SkBuff，头部空间由 tcp_alloc_skb 预留
+/// - `flags`: 标志位
+/// - `window`: 通告窗口（已按窗口扩大因子缩小）
+/// - `opts`: 选项，长度必须是 4 的倍数
+///
+/// # 返回
+/// 成功返回 Ok(())，失败返回 Err(())
+pub fn tcp_build_header(
+    skb: &mut SkBuff,
+    source: TcpPort,
+    dest: TcpPort,
+    seq: TcpSeq,
+    ack_seq: TcpAck,
+    flags: u8,
+    window: u16,
+    opts: &[u8],
+) -> Result<(), ()> {
+    if opts.len() % 4 != 0 || opts.len() > TCP_MAX_HLEN - TCP_MIN_HLEN {
+        return Err(());
     }
+    let hdr_len = TCP_MIN_HLEN + opts.len();
+    let ptr = skb.skb_push(hdr_len as u32).ok_or(())?;
 
-    // 处理最后一个字节 (如果有)
-    if i < data.len() {
-        sum += (data[i] as u32) << 8;
-    }
+    unsafe {
+        let tcp_hdr = &mut *(ptr as *mut TcpHdr);
+
+        tcp_hdr.source = source.to_be();
+        tcp_hdr.dest = dest.to_be();
+        tcp_hdr.seq = seq.to_be();
+        tcp_hdr.ack_seq = ack_seq.to_be();
+        tcp_hdr.dof_res = 0;
+        tcp_hdr.set_dof((hdr_len / 4) as u8);
+        tcp_hdr.flags = flags;
+        tcp_hdr.set_window(window);
+        // 校验和由 ipv4_send 填入伪头部，其余交给设备或软件补齐
+        tcp_hdr.check = 0;
+        tcp_hdr.urg_ptr = 0;
 
-    // 处理进位
-    while sum >> 16 != 0 {
-        sum = (sum & 0xFFFF) + (sum >> 16);
+        core::ptr::copy_nonoverlapping(opts.as_ptr(), ptr.add(TCP_MIN_HLEN), opts.len());
     }
 
-    // 取反
-    !sum as u16
+    Ok(())
 }
 
 /// 构造 TCP 数据包
@@ -880,47 +2060,21 @@ pub fn tcp_build_packet(
     data: &[u8],
     flags: u16,
 ) -> Result<(), ()> {
-    // 分配空间用于 TCP 头部
-    let ptr = skb.skb_push(TCP_MIN_HLEN as u32).ok_or(())?;
-
-    unsafe {
-        let tcp_hdr = &mut *(ptr as *mut TcpHdr);
-
-        // 源端口
-        tcp_hdr.source = source.to_be();
-
-        // 目标端口
-        tcp_hdr.dest = dest.to_be();
-
-        // 序列号
-        tcp_hdr.seq = seq.to_be();
-
-        // 确认号
-        tcp_hdr.ack_seq = ack_seq.to_be();
-
-        // 数据偏移 (20 字节 = 5 个 32 位字)
-        tcp_hdr.set_dof(5);
-
-        // 标志和窗口
-        tcp_hdr.flags_win = flags.to_be();
-
-        // 窗口大小
-        tcp_hdr.set_window(TCP_MAX_WINDOW);
-
-        // 校验和 (先设为 0，稍后计算)
-        tcp_hdr.check = 0;
-
-        // 紧急指针
-        tcp_hdr.urg_ptr = 0;
-    }
-
     // 添加数据
     skb.skb_put_data(data)?;
 
-    // TODO: 计算 TCP 校验和 (需要源 IP 和目标 IP)
-    // tcp_hdr.check = tcp_checksum(...).to_be();
+    // 不带选项的头部，窗口取最大值
+    tcp_build_header(skb, source, dest, seq, ack_seq, flags as u8, TCP_MAX_WINDOW, &[])
+}
 
-    Ok(())
+/// 分配带协议头预留空间的 SkBuff (sk_stream_alloc_skb)
+///
+/// # 参数
+/// - `size`: 数据长度
+pub fn tcp_alloc_skb(size: usize) -> Result<SkBuff, ()> {
+    let mut skb = crate::net::buffer::alloc_skb(MAX_TCP_HEADER + size as u32).ok_or(())?;
+    skb.skb_reserve(MAX_TCP_HEADER).ok_or(())?;
+    Ok(skb)
 }
 
 /// 解析 TCP 数据包
@@ -941,18 +2095,206 @@ pub fn tcp_parse_packet(skb: &SkBuff) -> Option<&'static TcpHdr> {
 
     // 验证头部长度
     let hdr_len = tcp_hdr.header_len();
-    if hdr_len < TCP_MIN_HLEN || hdr_len > TCP_MAX_HLEN {
+    if hdr_len < TCP_MIN_HLEN || hdr_len > TCP_MAX_HLEN || hdr_len > data.len() {
         return None;
     }
 
-    // TODO: 验证 TCP 校验和
-    // if tcp_hdr.check() != 0 && tcp_hdr.check() != 0xFFFF {
-    //     return None;
-    // }
-
     Some(tcp_hdr)
 }
 
+/// 接收 IPv4 上的 TCP 报文段 (tcp_v4_rcv)
+///
+/// # 参数
+/// - `skb`: 以 IP 头部开始的数据包
+/// - `src_ip` / `dest_ip`: 源、目标 IP 地址（主机字节序）
+/// - `offset`: TCP 头部相对 skb->data 的偏移
+/// - `len`: TCP 报文段长度（按 IP 总长度计算，不含链路层填充）
+///
+/// # 返回
+/// 报文段格式错误或校验和不对时返回 Err(())
+pub fn tcp_v4_rcv(skb: &SkBuff, src_ip: u32, dest_ip: u32, offset: u32, len: u32) -> Result<(), ()> {
+    if (len as usize) < TCP_MIN_HLEN || offset + len > skb.len {
+        return Err(());
+    }
+
+    // 头部复制到栈上，数据在线性区时直接引用
+    let mut hdr_buf = [0u8; TCP_MAX_HLEN];
+    skb.skb_copy_bits(offset, &mut hdr_buf[..TCP_MIN_HLEN], TCP_MIN_HLEN as u32);
+    let hdr_len = ((hdr_buf[12] >> 4) as usize) * 4;
+    if hdr_len < TCP_MIN_HLEN || hdr_len > len as usize {
+        return Err(());
+    }
+    skb.skb_copy_bits(offset, &mut hdr_buf[..hdr_len], hdr_len as u32);
+
+    let data_off = offset + hdr_len as u32;
+    let data_len = len - hdr_len as u32;
+    let copied: Vec<u8>;
+    let data: &[u8] = if data_off + data_len <= skb.skb_headlen() {
+        unsafe { core::slice::from_raw_parts(skb.data.add(data_off as usize), data_len as usize) }
+    } else {
+        let mut buf = alloc::vec![0u8; data_len as usize];
+        skb.skb_copy_bits(data_off, &mut buf, data_len);
+        copied = buf;
+        &copied
+    };
+
+    // 设备没有校验过的报文段在这里校验
+    if skb.ip_summed != CHECKSUM_UNNECESSARY {
+        let sum = checksum::csum_tcpudp_nofold(src_ip, dest_ip, len, 6);
+        let sum = checksum::csum_partial(&hdr_buf[..hdr_len], sum);
+        let sum = checksum::csum_block_add(sum, checksum::csum_partial(data, 0), hdr_len);
+        if checksum::csum_fold(sum) != 0 {
+            return Err(());
+        }
+    }
+
+    let tcp_hdr = TcpHdr::from_bytes(&hdr_buf[..hdr_len]).ok_or(())?;
+    with_tcp_lock(|| tcp_v4_do_rcv(tcp_hdr, data, src_ip, dest_ip));
+    Ok(())
+}
+
+/// 把报文段交给对应的连接（调用者持有 TCP 锁） (tcp_v4_do_rcv / __inet_lookup)
+///
+/// 先按四元组查找已建立的连接，找不到时按目标地址与端口查找监听 socket；
+/// SO_REUSEPORT 组按四元组哈希选择，同一条连接的 SYN 与 ACK 落到同一个监听 socket
+fn tcp_v4_do_rcv(tcp_hdr: &TcpHdr, data: &[u8], src_ip: u32, dest_ip: u32) {
+    let src_port = TcpPort::from_be(tcp_hdr.source);
+    let dest_port = TcpPort::from_be(tcp_hdr.dest);
+
+    // 1. 已建立或正在握手的连接 (__inet_lookup_established)
+    let key = InetEhashKey { faddr: src_ip, fport: src_port, lport: dest_port };
+    if let Some(socket) = TCP_EHASH.lookup(&key).and_then(tcp_sock_deref) {
+        match socket.parent {
+            Some(parent) if socket.state == TcpState::TCP_SYN_RECV => tcp_check_req(socket, parent, tcp_hdr, data),
+            _ => {
+                let _ = socket.handle_packet(tcp_hdr, data);
+            }
+        }
+        return;
+    }
+
+    // 2. 监听 socket (__inet_lookup_listener)
+    if let Some(listener) = inet_lookup_listener(&TCP_LHASH, dest_ip, dest_port, inet_ehashfn(&key)) {
+        tcp_v4_conn_request(listener, tcp_hdr, data, src_ip, dest_ip);
+    }
+}
+
+/// ICMP 报告发往 daddr 的路径 MTU 已降到 pmtu (tcp_v4_err + tcp_v4_mtu_reduced)
+///
+/// 被丢弃的报文段所属的连接把 MSS 降到路径 MTU 以内，并按新的 MSS 重传在途数据。
+/// 原报文段的序列号不在 [snd_una, snd_nxt] 内时忽略，伪造的 ICMP 难以命中
+///
+/// # 参数
+/// - `daddr`, `sport`, `dport`, `seq`: ICMP 携带的原报文段的目标地址、端口与序列号
+pub fn tcp_v4_mtu_reduced(daddr: u32, sport: TcpPort, dport: TcpPort, seq: TcpSeq, pmtu: u32) {
+    with_tcp_lock(|| {
+        let key = InetEhashKey { faddr: daddr, fport: dport, lport: sport };
+        let socket = match TCP_EHASH.lookup(&key).and_then(tcp_sock_deref) {
+            Some(socket) => socket,
+            None => return,
+        };
+        if matches!(socket.state, TcpState::TCP_CLOSE | TcpState::TCP_LISTEN)
+            || before(seq, socket.snd_una)
+            || after(seq, socket.snd_nxt)
+        {
+            return;
+        }
+        if socket.tcp_sync_mss(pmtu) {
+            socket.tcp_simple_retransmit();
+        }
+    });
+}
+
+/// 正在握手的子连接收到报文段 (tcp_check_req)
+///
+/// 全连接队列已满时丢弃第三次握手的 ACK，子连接留在 SYN_RECV，等对端重传；
+/// 握手完成后子连接移到全连接队列
+fn tcp_check_req(child: &mut TcpSocket, parent: (TcpSockRef, usize), tcp_hdr: &TcpHdr, data: &[u8]) {
+    let (listener_ref, idx) = parent;
+    if tcp_hdr.ack() && !tcp_hdr.syn() && !tcp_hdr.rst() {
+        if let Some(listener) = tcp_sock_deref(listener_ref) {
+            if listener.reqsk_queue.accept_queue_is_full() {
+                listener.stats.listen_overflows += 1;
+                return;
+            }
+        }
+    }
+    let _ = child.handle_packet(tcp_hdr, data);
+    // RST 或出错终止的子连接已由 tcp_done 从队列中删除
+    if child.state != TcpState::TCP_SYN_RECV && child.state != TcpState::TCP_CLOSE {
+        if let Some(listener) = tcp_sock_deref(listener_ref) {
+            listener.reqsk_queue.complete(idx);
+        }
+    }
+}
+
+/// 监听 socket 收到报文段 (tcp_v4_conn_request / cookie_v4_check)
+///
+/// - SYN：全连接队列满时丢弃；半连接队列满时回复 SYN cookie，不创建子连接；
+///   否则创建子连接放入半连接队列
+/// - ACK：半连接队列最近溢出过时按 SYN cookie 校验，通过后直接创建已建立的连接
+fn tcp_v4_conn_request(listener_ref: TcpSockRef, tcp_hdr: &TcpHdr, data: &[u8], src_ip: u32, dest_ip: u32) {
+    let listener = match tcp_sock_deref(listener_ref) {
+        Some(listener) if listener.state == TcpState::TCP_LISTEN => listener,
+        _ => return,
+    };
+    if tcp_hdr.rst() {
+        return;
+    }
+    let src_port = TcpPort::from_be(tcp_hdr.source);
+    let dest_port = TcpPort::from_be(tcp_hdr.dest);
+    let ca_ops = listener.ca_ops;
+
+    if tcp_hdr.syn() && !tcp_hdr.ack() {
+        let queue = &mut listener.reqsk_queue;
+        if queue.accept_queue_is_full() {
+            listener.stats.listen_overflows += 1;
+            return;
+        }
+        if queue.syn_queue_is_full() {
+            // SYN 洪泛：状态编码进 SYN-ACK 的序列号 (tcp_syn_flood_action)
+            queue.synq_overflow_ts = crate::drivers::timer::get_jiffies().max(1);
+            if crate::net::syncookies::tcp_v4_send_cookie_synack(tcp_hdr, src_ip, dest_ip).is_ok() {
+                listener.stats.syncookies_sent += 1;
+            }
+            return;
+        }
+        let idx = get_tcp_manager().accept_syn(tcp_hdr, src_ip, dest_port, listener_ref, ca_ops);
+        if let (Some(idx), Some(listener)) = (idx, tcp_sock_deref(listener_ref)) {
+            listener.reqsk_queue.syn_queue.push(idx);
+        }
+    } else if tcp_hdr.ack() && !tcp_hdr.syn() {
+        let now = crate::drivers::timer::get_jiffies();
+        if !listener.reqsk_queue.recent_overflow(now) {
+            return;
+        }
+        if listener.reqsk_queue.accept_queue_is_full() {
+            listener.stats.listen_overflows += 1;
+            return;
+        }
+        let seq = TcpSeq::from_be(tcp_hdr.seq);
+        let cookie = TcpSeq::from_be(tcp_hdr.ack_seq).wrapping_sub(1);
+        let mss = match crate::net::syncookies::cookie_v4_check(src_ip, dest_ip, src_port, dest_port, seq.wrapping_sub(1), cookie) {
+            Some(mss) => mss,
+            None => {
+                listener.stats.syncookies_failed += 1;
+                return;
+            }
+        };
+        listener.stats.syncookies_recv += 1;
+        let idx = get_tcp_manager().accept_cookie(tcp_hdr, src_ip, dest_port, mss, listener_ref, ca_ops);
+        if let Some(listener) = tcp_sock_deref(listener_ref) {
+            listener.reqsk_queue.accept_queue.push_back(idx);
+        }
+        // ACK 上可能已经带有数据
+        if !data.is_empty() || tcp_hdr.fin() {
+            if let Some(child) = get_tcp_manager().get_mut(TcpSockRef::Child(idx)) {
+                let _ = child.handle_packet(tcp_hdr, data);
+            }
+        }
+    }
+}
+
 #[cfg(test)]
 mod tests {
     use super::*;
@@ -0,0 +1,580 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! BBR 拥塞控制
+//!
+//! 不以丢包为拥塞信号，而是持续估计瓶颈带宽（最近 10 轮交付速率的最大值）和
+//! 传播时延（最近 10 秒 RTT 的最小值），按两者的乘积 BDP 设置拥塞窗口，
+//! 并以带宽乘增益的速率 pacing 发送。
+//!
+//! 参考: net/ipv4/tcp_bbr.c, draft-cardwell-iccrg-bbr-congestion-control
+//!
+//! # 设计
+//! - 状态机：STARTUP（指数增长探测带宽）→ DRAIN（排空队列）→ PROBE_BW
+//!   （按 8 段增益循环探测）；最小 RTT 过期时进入 PROBE_RTT 把在途数据降到 4 个报文段
+//! - 带宽单位为字节/秒，增益为 1/256 定点数
+//! - 实现 cong_control：每个确认上直接设置窗口与 pacing 速率，丢包恢复时做包守恒
+
+use crate::drivers::timer::{get_jiffies, msecs_to_jiffies, HZ};
+use crate::net::tcp::{TcpCaState, TcpSocket, TCP_INIT_CWND, TCP_MAX_CWND};
+use crate::net::tcp_cong::{TcpCaEvent, TcpCaPriv, TcpCongestionOps};
+use crate::net::tcp_rate::TcpRateSample;
+
+/// 增益的定点数位数 (BBR_SCALE)
+const BBR_SCALE: u32 = 8;
+/// 增益 1.0 (BBR_UNIT)
+const BBR_UNIT: u32 = 1 << BBR_SCALE;
+
+/// 2/ln(2)：每轮带宽翻倍所需的最小增益 (bbr_high_gain)
+const BBR_HIGH_GAIN: u32 = BBR_UNIT * 2885 / 1000 + 1;
+/// 1/high_gain：一轮内排空 STARTUP 造成的队列 (bbr_drain_gain)
+const BBR_DRAIN_GAIN: u32 = BBR_UNIT * 1000 / 2885;
+/// PROBE_BW 的窗口增益，为延迟 ACK 与 ACK 聚合留余量 (bbr_cwnd_gain)
+const BBR_CWND_GAIN: u32 = BBR_UNIT * 2;
+
+/// PROBE_BW 的增益循环：一轮探测、一轮排空、六轮巡航 (bbr_pacing_gain)
+const BBR_PACING_GAIN: [u32; BBR_CYCLE_LEN] = [
+    BBR_UNIT * 5 / 4,
+    BBR_UNIT * 3 / 4,
+    BBR_UNIT,
+    BBR_UNIT,
+    BBR_UNIT,
+    BBR_UNIT,
+    BBR_UNIT,
+    BBR_UNIT,
+];
+const BBR_CYCLE_LEN: usize = 8;
+
+/// 带宽最大值滤波器的窗口（轮数） (bbr_bw_rtts)
+const BBR_BW_RTTS: u32 = BBR_CYCLE_LEN as u32 + 2;
+/// 最小 RTT 滤波器的窗口 (bbr_min_rtt_win_sec)
+const BBR_MIN_RTT_WIN_SEC: u64 = 10;
+/// PROBE_RTT 的最短持续时间 (bbr_probe_rtt_mode_ms)
+const BBR_PROBE_RTT_MODE_MS: u64 = 200;
+/// 最小拥塞窗口（报文段） (bbr_cwnd_min_target)
+const BBR_CWND_MIN_TARGET: u32 = 4;
+
+/// 带宽增长不足 25% 即视为不再增长 (bbr_full_bw_thresh)
+const BBR_FULL_BW_THRESH: u32 = BBR_UNIT * 5 / 4;
+/// 连续这么多轮不增长则认为管道已满 (bbr_full_bw_cnt)
+const BBR_FULL_BW_CNT: u32 = 3;
+
+/// pacing 速率比估计带宽低 1%，让瓶颈队列有机会排空 (bbr_pacing_margin_percent)
+const BBR_PACING_MARGIN_PERCENT: u64 = 1;
+
+/// BBR 状态 (bbr_mode)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum BbrMode {
+    /// 指数增长探测带宽
+    Startup,
+    /// 排空 STARTUP 造成的队列
+    Drain,
+    /// 稳态，按增益循环探测带宽
+    ProbeBw,
+    /// 降低在途数据以测量传播时延
+    ProbeRtt,
+}
+
+/// 窗口化最大值滤波器的一个样本 (minmax_sample)
+#[derive(Debug, Clone, Copy, Default)]
+struct MinmaxSample {
+    t: u32,
+    v: u64,
+}
+
+/// 保存最大、次大、第三大样本的窗口化最大值滤波器 (struct minmax, lib/win_minmax.c)
+#[derive(Debug, Clone, Copy, Default)]
+struct Minmax {
+    s: [MinmaxSample; 3],
+}
+
+impl Minmax {
+    fn get(&self) -> u64 {
+        self.s[0].v
+    }
+
+    fn reset(&mut self, t: u32, v: u64) -> u64 {
+        let val = MinmaxSample { t, v };
+        self.s = [val; 3];
+        v
+    }
+
+    /// 窗口内的样本逐渐过期时，依次提升次大与第三大的样本 (minmax_subwin_update)
+    fn subwin_update(&mut self, win: u32, val: MinmaxSample) -> u64 {
+        let dt = val.t.wrapping_sub(self.s[0].t);
+        if dt > win {
+            self.s[0] = self.s[1];
+            self.s[1] = self.s[2];
+            self.s[2] = val;
+            if val.t.wrapping_sub(self.s[0].t) > win {
+                self.s[0] = self.s[1];
+                self.s[1] = self.s[2];
+                self.s[2] = val;
+            }
+        } else if self.s[1].t == self.s[0].t && dt > win / 4 {
+            self.s[1] = val;
+            self.s[2] = val;
+        } else if self.s[2].t == self.s[1].t && dt > win / 2 {
+            self.s[2] = val;
+        }
+        self.s[0].v
+    }
+
+    /// 加入一个样本并返回窗口内的最大值 (minmax_running_max)
+    fn running_max(&mut self, win: u32, t: u32, v: u64) -> u64 {
+        let val = MinmaxSample { t, v };
+        if val.v >= self.s[0].v || val.t.wrapping_sub(self.s[2].t) > win {
+            return self.reset(t, v);
+        }
+        if val.v >= self.s[1].v {
+            self.s[1] = val;
+            self.s[2] = val;
+        } else if val.v >= self.s[2].v {
+            self.s[2] = val;
+        }
+        self.subwin_update(win, val)
+    }
+}
+
+/// 每个连接的 BBR 状态 (struct bbr)
+#[derive(Debug, Clone, Copy)]
+pub struct Bbr {
+    /// 最小 RTT（微秒），没有样本为 u32::MAX
+    pub min_rtt_us: u32,
+    /// 最小 RTT 的取样时间（jiffies）
+    min_rtt_stamp: u64,
+    /// PROBE_RTT 结束时间（jiffies），0 表示尚未开始计时
+    probe_rtt_done_stamp: u64,
+    /// 最近 BBR_BW_RTTS 轮的最大交付速率（字节/秒）
+    bw: Minmax,
+    /// 已经过的轮数
+    rtt_cnt: u32,
+    /// 本轮结束时的 delivered
+    next_rtt_delivered: u64,
+    /// 进入 PROBE_BW 当前增益阶段的时间（微秒）
+    cycle_mstamp: u64,
+    /// 当前状态
+    pub mode: BbrMode,
+    /// 上一个确认时的拥塞状态
+    prev_ca_state: TcpCaState,
+    /// 丢包恢复的第一轮中做包守恒
+    packet_conservation: bool,
+    /// 本次确认开始了新的一轮
+    round_start: bool,
+    /// 空闲后重新开始发送
+    idle_restart: bool,
+    /// PROBE_RTT 已经持续了一整轮
+    probe_rtt_round_done: bool,
+    /// 当前的 pacing 增益
+    pub pacing_gain: u32,
+    /// 当前的窗口增益
+    pub cwnd_gain: u32,
+    /// 已确认管道被填满
+    pub full_bw_reached: bool,
+    /// 连续没有明显增长的轮数
+    full_bw_cnt: u32,
+    /// 管道填满判断的基准带宽
+    full_bw: u64,
+    /// PROBE_BW 的增益阶段
+    cycle_idx: usize,
+    /// 是否已用 RTT 样本初始化过 pacing 速率
+    has_seen_rtt: bool,
+    /// 进入丢包恢复或 PROBE_RTT 之前的窗口
+    prior_cwnd: u32,
+}
+
+impl Bbr {
+    const fn new() -> Self {
+        Self {
+            min_rtt_us: u32::MAX,
+            min_rtt_stamp: 0,
+            probe_rtt_done_stamp: 0,
+            bw: Minmax { s: [MinmaxSample { t: 0, v: 0 }; 3] },
+            rtt_cnt: 0,
+            next_rtt_delivered: 0,
+            cycle_mstamp: 0,
+            mode: BbrMode::Startup,
+            prev_ca_state: TcpCaState::Open,
+            packet_conservation: false,
+            round_start: false,
+            idle_restart: false,
+            probe_rtt_round_done: false,
+            pacing_gain: BBR_HIGH_GAIN,
+            cwnd_gain: BBR_HIGH_GAIN,
+            full_bw_reached: false,
+            full_bw_cnt: 0,
+            full_bw: 0,
+            cycle_idx: 0,
+            has_seen_rtt: false,
+            prior_cwnd: 0,
+        }
+    }
+
+    /// 估计的瓶颈带宽（字节/秒） (bbr_max_bw)
+    fn max_bw(&self) -> u64 {
+        self.bw.get()
+    }
+}
+
+/// BBR (tcp_bbr_cong_ops)
+pub static TCP_BBR: TcpCongestionOps = TcpCongestionOps {
+    name: "bbr",
+    init: Some(bbr_init),
+    ssthresh: bbr_ssthresh,
+    cong_avoid: None,
+    cong_control: Some(bbr_main),
+    set_state: Some(bbr_set_state),
+    cwnd_event: Some(bbr_cwnd_event),
+    pkts_acked: None,
+};
+
+/// 取出连接上的 BBR 状态
+fn bbr_get(sk: &TcpSocket) -> Bbr {
+    match sk.ca_priv {
+        TcpCaPriv::Bbr(bbr) => bbr,
+        _ => {
+            let mut bbr = Bbr::new();
+            bbr.next_rtt_delivered = sk.rate.delivered;
+            bbr.min_rtt_stamp = get_jiffies();
+            bbr
+        }
+    }
+}
+
+/// 在途报文段数 (tcp_packets_in_flight)
+fn packets_in_flight(sk: &TcpSocket) -> u32 {
+    (sk.tcp_bytes_in_flight() + sk.mss - 1) / sk.mss
+}
+
+/// 带宽乘增益换算成 pacing 速率（字节/秒） (bbr_bw_to_pacing_rate)
+fn bw_to_pacing_rate(bw: u64, gain: u32) -> u64 {
+    (bw * gain as u64 >> BBR_SCALE) * (100 - BBR_PACING_MARGIN_PERCENT) / 100
+}
+
+/// 还没有带宽样本时按初始窗口和 RTT 估计 pacing 速率 (bbr_init_pacing_rate_from_rtt)
+fn init_pacing_rate_from_rtt(sk: &mut TcpSocket, bbr: &mut Bbr) {
+    let rtt_us = if sk.rate.min_rtt_us != u32::MAX {
+        bbr.has_seen_rtt = true;
+        core::cmp::max(sk.rate.min_rtt_us as u64, 1)
+    } else if sk.srtt != 0 {
+        bbr.has_seen_rtt = true;
+        core::cmp::max((sk.srtt >> 3) as u64 * 1_000_000 / HZ, 1)
+    } else {
+        1000 // USEC_PER_MSEC
+    };
+    let bw = sk.snd_cwnd as u64 * sk.mss as u64 * 1_000_000 / rtt_us;
+    sk.pacing_rate = bw_to_pacing_rate(bw, BBR_HIGH_GAIN);
+}
+
+/// 按带宽与增益设置 pacing 速率；管道填满前速率只增不减 (bbr_set_pacing_rate)
+fn set_pacing_rate(sk: &mut TcpSocket, bbr: &mut Bbr, bw: u64, gain: u32) {
+    let rate = bw_to_pacing_rate(bw, gain);
+    if !bbr.has_seen_rtt && sk.rate.min_rtt_us != u32::MAX {
+        init_pacing_rate_from_rtt(sk, bbr);
+    }
+    if bbr.full_bw_reached || rate > sk.pacing_rate {
+        sk.pacing_rate = rate;
+    }
+}
+
+/// 带宽乘增益对应的在途报文段数 (bbr_bdp + bbr_quantization_budget)
+fn bbr_inflight(sk: &TcpSocket, bbr: &Bbr, bw: u64, gain: u32) -> u32 {
+    // 还没有 RTT 样本时用初始窗口
+    if bbr.min_rtt_us == u32::MAX {
+        return TCP_INIT_CWND;
+    }
+    let bdp = bw * bbr.min_rtt_us as u64 / 1_000_000 / sk.mss as u64;
+    let mut cwnd = ((bdp * gain as u64) >> BBR_SCALE).min(TCP_MAX_CWND as u64) as u32;
+    // 为发送端与接收端的 TSO/GSO 超长包和延迟 ACK 留出余量
+    cwnd += 3 * sk.tcp_tso_segs();
+    cwnd = (cwnd + 1) & !1;
+    if bbr.mode == BbrMode::ProbeBw && bbr.cycle_idx == 0 {
+        cwnd += 2;
+    }
+    cwnd
+}
+
+/// 保存进入恢复或 PROBE_RTT 前的窗口 (bbr_save_cwnd)
+fn save_cwnd(sk: &TcpSocket, bbr: &mut Bbr) {
+    if bbr.prev_ca_state == TcpCaState::Open && bbr.mode != BbrMode::ProbeRtt {
+        bbr.prior_cwnd = sk.snd_cwnd;
+    } else {
+        bbr.prior_cwnd = core::cmp::max(bbr.prior_cwnd, sk.snd_cwnd);
+    }
+}
+
+fn reset_startup_mode(bbr: &mut Bbr) {
+    bbr.mode = BbrMode::Startup;
+}
+
+/// 进入 PROBE_BW，随机选一个增益阶段开始，避免多条流同步探测 (bbr_reset_probe_bw_mode)
+fn reset_probe_bw_mode(sk: &TcpSocket, bbr: &mut Bbr) {
+    bbr.mode = BbrMode::ProbeBw;
+    let rand = (crate::drivers::timer::read_time() ^ sk.snd_nxt as u64) as usize % (BBR_CYCLE_LEN - 1);
+    bbr.cycle_idx = BBR_CYCLE_LEN - 1 - rand;
+    advance_cycle_phase(sk, bbr);
+}
+
+fn reset_mode(sk: &TcpSocket, bbr: &mut Bbr) {
+    if !bbr.full_bw_reached {
+        reset_startup_mode(bbr);
+    } else {
+        reset_probe_bw_mode(sk, bbr);
+    }
+}
+
+fn advance_cycle_phase(sk: &TcpSocket, bbr: &mut Bbr) {
+    bbr.cycle_idx = (bbr.cycle_idx + 1) % BBR_CYCLE_LEN;
+    bbr.cycle_mstamp = sk.rate.delivered_us;
+}
+
+/// 当前增益阶段是否该结束 (bbr_is_next_cycle_phase)
+fn is_next_cycle_phase(sk: &TcpSocket, bbr: &Bbr, rs: &TcpRateSample) -> bool {
+    let is_full_length = sk.rate.delivered_us.saturating_sub(bbr.cycle_mstamp) > bbr.min_rtt_us as u64;
+    if bbr.pacing_gain == BBR_UNIT {
+        return is_full_length;
+    }
+    let inflight = (rs.prior_in_flight + sk.mss - 1) / sk.mss;
+    let bw = bbr.max_bw();
+    if bbr.pacing_gain > BBR_UNIT {
+        // 探测阶段：在途数据达到 1.25 BDP 后结束
+        return is_full_length && inflight >= bbr_inflight(sk, bbr, bw, bbr.pacing_gain);
+    }
+    // 排空阶段：在途数据降到 BDP 就可以提前结束
+    is_full_length || inflight <= bbr_inflight(sk, bbr, bw, BBR_UNIT)
+}
+
+/// 更新带宽估计与轮数 (bbr_update_bw)
+fn update_bw(sk: &TcpSocket, bbr: &mut Bbr, rs: &TcpRateSample) {
+    bbr.round_start = false;
+    if rs.interval_us == 0 {
+        return;
+    }
+    // 被采样的数据是在本轮开始之后发出的：新的一轮开始
+    if rs.prior_delivered >= bbr.next_rtt_delivered {
+        bbr.next_rtt_delivered = sk.rate.delivered;
+        bbr.rtt_cnt += 1;
+        bbr.round_start = true;
+        bbr.packet_conservation = false;
+    }
+    let bw = rs.rate();
+    // 受应用限制的样本只有在超过当前估计时才采用
+    if !rs.is_app_limited || bw >= bbr.max_bw() {
+        bbr.bw.running_max(BBR_BW_RTTS, bbr.rtt_cnt, bw);
+    }
+}
+
+/// 连续三轮带宽增长不足 25% 时认为管道已满 (bbr_check_full_bw_reached)
+fn check_full_bw_reached(bbr: &mut Bbr, rs: &TcpRateSample) {
+    if bbr.full_bw_reached || !bbr.round_start || rs.is_app_limited {
+        return;
+    }
+    let bw_thresh = (bbr.full_bw * BBR_FULL_BW_THRESH as u64) >> BBR_SCALE;
+    if bbr.max_bw() >= bw_thresh {
+        bbr.full_bw = bbr.max_bw();
+        bbr.full_bw_cnt = 0;
+        return;
+    }
+    bbr.full_bw_cnt += 1;
+    bbr.full_bw_reached = bbr.full_bw_cnt >= BBR_FULL_BW_CNT;
+}
+
+/// STARTUP 结束后排空队列，在途数据降到 BDP 时进入 PROBE_BW (bbr_check_drain)
+fn check_drain(sk: &mut TcpSocket, bbr: &mut Bbr) {
+    if bbr.mode == BbrMode::Startup && bbr.full_bw_reached {
+        bbr.mode = BbrMode::Drain;
+        sk.snd_ssthresh = bbr_inflight(sk, bbr, bbr.max_bw(), BBR_UNIT);
+    }
+    if bbr.mode == BbrMode::Drain && packets_in_flight(sk) <= bbr_inflight(sk, bbr, bbr.max_bw(), BBR_UNIT) {
+        reset_probe_bw_mode(sk, bbr);
+    }
+}
+
+fn check_probe_rtt_done(sk: &mut TcpSocket, bbr: &mut Bbr) {
+    if bbr.probe_rtt_done_stamp == 0 || get_jiffies() <= bbr.probe_rtt_done_stamp {
+        return;
+    }
+    bbr.min_rtt_stamp = get_jiffies();
+    sk.snd_cwnd = core::cmp::max(sk.snd_cwnd, bbr.prior_cwnd);
+    reset_mode(sk, bbr);
+}
+
+/// 更新最小 RTT；过期时进入 PROBE_RTT 重新测量 (bbr_update_min_rtt)
+fn update_min_rtt(sk: &mut TcpSocket, bbr: &mut Bbr, rs: &TcpRateSample) {
+    let now = get_jiffies();
+    let filter_expired = now > bbr.min_rtt_stamp + BBR_MIN_RTT_WIN_SEC * HZ;
+    if rs.rtt_us >= 0 && ((rs.rtt_us as u64) < bbr.min_rtt_us as u64 || filter_expired) {
+        bbr.min_rtt_us = core::cmp::min(rs.rtt_us as u64, u32::MAX as u64 - 1) as u32;
+        bbr.min_rtt_stamp = now;
+    }
+
+    if filter_expired && !bbr.idle_restart && bbr.mode != BbrMode::ProbeRtt {
+        bbr.mode = BbrMode::ProbeRtt;
+        save_cwnd(sk, bbr);
+        bbr.probe_rtt_done_stamp = 0;
+    }
+
+    if bbr.mode == BbrMode::ProbeRtt {
+        // PROBE_RTT 期间的样本不代表带宽
+        sk.rate.app_limited = core::cmp::max(sk.rate.delivered + sk.tcp_bytes_in_flight() as u64, 1);
+        if bbr.probe_rtt_done_stamp == 0 && packets_in_flight(sk) <= BBR_CWND_MIN_TARGET {
+            bbr.probe_rtt_done_stamp = now + core::cmp::max(msecs_to_jiffies(BBR_PROBE_RTT_MODE_MS), 1);
+            bbr.probe_rtt_round_done = false;
+            bbr.next_rtt_delivered = sk.rate.delivered;
+        } else if bbr.probe_rtt_done_stamp != 0 {
+            if bbr.round_start {
+                bbr.probe_rtt_round_done = true;
+            }
+            if bbr.probe_rtt_round_done {
+                check_probe_rtt_done(sk, bbr);
+            }
+        }
+    }
+    if rs.delivered > 0 {
+        bbr.idle_restart = false;
+    }
+}
+
+/// 按状态设置增益 (bbr_update_gains)
+fn update_gains(bbr: &mut Bbr) {
+    match bbr.mode {
+        BbrMode::Startup => {
+            bbr.pacing_gain = BBR_HIGH_GAIN;
+            bbr.cwnd_gain = BBR_HIGH_GAIN;
+        }
+        BbrMode::Drain => {
+            bbr.pacing_gain = BBR_DRAIN_GAIN;
+            bbr.cwnd_gain = BBR_HIGH_GAIN;
+        }
+        BbrMode::ProbeBw => {
+            bbr.pacing_gain = BBR_PACING_GAIN[bbr.cycle_idx];
+            bbr.cwnd_gain = BBR_CWND_GAIN;
+        }
+        BbrMode::ProbeRtt => {
+            bbr.pacing_gain = BBR_UNIT;
+            bbr.cwnd_gain = BBR_UNIT;
+        }
+    }
+}
+
+/// 进入丢包恢复的第一轮做包守恒，退出时恢复之前的窗口 (bbr_set_cwnd_to_recover_or_restore)
+///
+/// # 返回
+/// 新的窗口，以及本次窗口是否由包守恒决定
+fn recover_or_restore(sk: &TcpSocket, bbr: &mut Bbr, acked: u32) -> (u32, bool) {
+    let state = sk.ca_state;
+    let prev_state = bbr.prev_ca_state;
+    let mut cwnd = sk.snd_cwnd;
+    if state == TcpCaState::Recovery && prev_state != TcpCaState::Recovery {
+        bbr.packet_conservation = true;
+        bbr.next_rtt_delivered = sk.rate.delivered;
+        cwnd = packets_in_flight(sk) + acked;
+    } else if prev_state != TcpCaState::Open && state == TcpCaState::Open {
+        cwnd = core::cmp::max(cwnd, bbr.prior_cwnd);
+        bbr.packet_conservation = false;
+    }
+    bbr.prev_ca_state = state;
+
+    if bbr.packet_conservation {
+        return (core::cmp::max(cwnd, packets_in_flight(sk) + acked), true);
+    }
+    (cwnd, false)
+}
+
+/// 窗口向目标 BDP * cwnd_gain 增长 (bbr_set_cwnd)
+fn set_cwnd(sk: &mut TcpSocket, bbr: &mut Bbr, rs: &TcpRateSample, bw: u64) {
+    let acked = (rs.acked_sacked + sk.mss - 1) / sk.mss;
+    let mut cwnd = sk.snd_cwnd;
+    if acked > 0 {
+        let (new_cwnd, conserving) = recover_or_restore(sk, bbr, acked);
+        cwnd = new_cwnd;
+        if !conserving {
+            let target = bbr_inflight(sk, bbr, bw, bbr.cwnd_gain);
+            if bbr.full_bw_reached {
+                cwnd = core::cmp::min(cwnd + acked, target);
+            } else if cwnd < target || sk.rate.delivered < (TCP_INIT_CWND * sk.mss) as u64 {
+                // 管道填满前只增不减
+                cwnd += acked;
+            }
+            cwnd = core::cmp::max(cwnd, BBR_CWND_MIN_TARGET);
+        }
+    }
+    sk.snd_cwnd = core::cmp::min(cwnd, TCP_MAX_CWND);
+    if bbr.mode == BbrMode::ProbeRtt {
+        sk.snd_cwnd = core::cmp::min(sk.snd_cwnd, BBR_CWND_MIN_TARGET);
+    }
+}
+
+/// 每个确认上更新模型，再设置 pacing 速率与窗口 (bbr_main)
+fn bbr_main(sk: &mut TcpSocket, rs: &TcpRateSample) {
+    let mut bbr = bbr_get(sk);
+
+    // bbr_update_model
+    update_bw(sk, &mut bbr, rs);
+    if bbr.mode == BbrMode::ProbeBw && is_next_cycle_phase(sk, &bbr, rs) {
+        advance_cycle_phase(sk, &mut bbr);
+    }
+    check_full_bw_reached(&mut bbr, rs);
+    check_drain(sk, &mut bbr);
+    update_min_rtt(sk, &mut bbr, rs);
+    update_gains(&mut bbr);
+
+    let bw = bbr.max_bw();
+    if bw > 0 {
+        let gain = bbr.pacing_gain;
+        set_pacing_rate(sk, &mut bbr, bw, gain);
+    }
+    set_cwnd(sk, &mut bbr, rs, bw);
+    sk.ca_priv = TcpCaPriv::Bbr(bbr);
+}
+
+/// 连接建立时初始化 BBR 状态与初始 pacing 速率 (bbr_init)
+fn bbr_init(sk: &mut TcpSocket) {
+    let mut bbr = Bbr::new();
+    bbr.next_rtt_delivered = sk.rate.delivered;
+    bbr.min_rtt_us = sk.rate.min_rtt_us;
+    bbr.min_rtt_stamp = get_jiffies();
+    bbr.cycle_mstamp = sk.rate.delivered_us;
+    // BBR 不使用慢启动门限
+    sk.snd_ssthresh = TCP_MAX_CWND;
+    // 要求发送路径 pacing
+    init_pacing_rate_from_rtt(sk, &mut bbr);
+    reset_startup_mode(&mut bbr);
+    sk.ca_priv = TcpCaPriv::Bbr(bbr);
+}
+
+/// 丢包不改变慢启动门限，只记下当前窗口供恢复后还原 (bbr_ssthresh)
+fn bbr_ssthresh(sk: &mut TcpSocket) -> u32 {
+    let mut bbr = bbr_get(sk);
+    save_cwnd(sk, &mut bbr);
+    sk.ca_priv = TcpCaPriv::Bbr(bbr);
+    sk.snd_ssthresh
+}
+
+/// 超时后重新判断管道是否已满 (bbr_set_state)
+fn bbr_set_state(sk: &mut TcpSocket, new_state: TcpCaState) {
+    if new_state == TcpCaState::Loss {
+        let mut bbr = bbr_get(sk);
+        bbr.prev_ca_state = TcpCaState::Loss;
+        bbr.full_bw = 0;
+        bbr.round_start = true;
+        sk.ca_priv = TcpCaPriv::Bbr(bbr);
+    }
+}
+
+/// 空闲后重新发送：巡航速率发送，不做探测 (bbr_cwnd_event)
+fn bbr_cwnd_event(sk: &mut TcpSocket, ev: TcpCaEvent) {
+    if ev != TcpCaEvent::TxStart || sk.rate.app_limited == 0 {
+        return;
+    }
+    let mut bbr = bbr_get(sk);
+    bbr.idle_restart = true;
+    if bbr.mode == BbrMode::ProbeBw {
+        let bw = bbr.max_bw();
+        set_pacing_rate(sk, &mut bbr, bw, BBR_UNIT);
+    } else if bbr.mode == BbrMode::ProbeRtt {
+        check_probe_rtt_done(sk, &mut bbr);
+    }
+    sk.ca_priv = TcpCaPriv::Bbr(bbr);
+}
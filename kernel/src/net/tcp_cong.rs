@@ -0,0 +1,235 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! TCP 拥塞控制框架
+//!
+//! 拥塞控制算法以一组回调的形式挂在 TcpSocket 上，在确认、丢包、RTT 样本和
+//! 状态切换时被调用，决定拥塞窗口、慢启动门限与发送速率（pacing）。
+//!
+//! 参考: net/ipv4/tcp_cong.c, include/net/tcp.h (tcp_congestion_ops)
+//!
+//! # 设计
+//! - 内置 NewReno（基线）、CUBIC 与 BBR，按名称查找
+//! - 全局默认由启动参数 `tcp_congestion=` 选择，单个连接可用
+//!   setsockopt(TCP_CONGESTION) 覆盖
+//! - 实现了 cong_control 的算法（BBR）自己维护窗口与发送速率，
+//!   不走快速恢复中的窗口缩减
+
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+use crate::net::tcp::{TcpCaState, TcpSocket, TCP_MAX_CWND};
+use crate::net::tcp_rate::TcpRateSample;
+
+/// 算法名的最大长度 (TCP_CA_NAME_MAX)
+pub const TCP_CA_NAME_MAX: usize = 16;
+
+/// 拥塞控制关心的连接事件 (tcp_ca_event)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum TcpCaEvent {
+    /// 空闲后重新开始发送 (CA_EVENT_TX_START)
+    TxStart,
+}
+
+/// 拥塞控制算法 (tcp_congestion_ops)
+pub struct TcpCongestionOps {
+    /// 算法名，用于 setsockopt 和启动参数
+    pub name: &'static str,
+    /// 连接建立时初始化私有状态（可选）
+    pub init: Option<fn(sk: &mut TcpSocket)>,
+    /// 检测到丢包时返回新的慢启动门限
+    pub ssthresh: fn(sk: &mut TcpSocket) -> u32,
+    /// 按确认增长拥塞窗口（与 cong_control 二选一）
+    ///
+    /// # 参数
+    /// - `acked`: 新确认的报文段数
+    pub cong_avoid: Option<fn(sk: &mut TcpSocket, acked: u32)>,
+    /// 每个确认上调用，完全接管窗口与 pacing 速率（可选）
+    pub cong_control: Option<fn(sk: &mut TcpSocket, rs: &TcpRateSample)>,
+    /// 拥塞状态切换前调用（可选）
+    pub set_state: Option<fn(sk: &mut TcpSocket, new_state: TcpCaState)>,
+    /// 连接事件（可选）
+    pub cwnd_event: Option<fn(sk: &mut TcpSocket, ev: TcpCaEvent)>,
+    /// 确认了新数据时调用，带上本次的 RTT 样本（微秒，没有样本为 -1）（可选）
+    pub pkts_acked: Option<fn(sk: &mut TcpSocket, acked: u32, rtt_us: i64)>,
+}
+
+/// 各算法保存在连接上的私有状态 (icsk_ca_priv)
+#[derive(Debug, Clone, Copy)]
+pub enum TcpCaPriv {
+    None,
+    Cubic(crate::net::tcp_cubic::BicTcp),
+    Bbr(crate::net::tcp_bbr::Bbr),
+}
+
+/// NewReno (tcp_reno)
+pub static TCP_RENO: TcpCongestionOps = TcpCongestionOps {
+    name: "reno",
+    init: None,
+    ssthresh: tcp_reno_ssthresh,
+    cong_avoid: Some(tcp_reno_cong_avoid),
+    cong_control: None,
+    set_state: None,
+    cwnd_event: None,
+    pkts_acked: None,
+};
+
+/// 已注册的算法 (tcp_cong_list)
+static TCP_CONG_LIST: [&TcpCongestionOps; 3] = [
+    &TCP_RENO,
+    &crate::net::tcp_cubic::TCP_CUBIC,
+    &crate::net::tcp_bbr::TCP_BBR,
+];
+
+/// 默认算法在 TCP_CONG_LIST 中的下标，与 Linux 一致默认为 CUBIC
+static TCP_CONG_DEFAULT: AtomicUsize = AtomicUsize::new(1);
+
+/// 按名称查找算法 (tcp_ca_find)
+pub fn tcp_ca_find(name: &str) -> Option<&'static TcpCongestionOps> {
+    TCP_CONG_LIST.iter().copied().find(|ops| ops.name == name)
+}
+
+/// 当前的默认算法
+pub fn tcp_ca_default() -> &'static TcpCongestionOps {
+    TCP_CONG_LIST[TCP_CONG_DEFAULT.load(Ordering::Relaxed)]
+}
+
+/// 设置默认算法 (tcp_set_default_congestion_control)
+///
+/// # 返回
+/// 名称不存在时返回 false
+pub fn tcp_set_default_congestion_control(name: &str) -> bool {
+    match TCP_CONG_LIST.iter().position(|ops| ops.name == name) {
+        Some(idx) => {
+            TCP_CONG_DEFAULT.store(idx, Ordering::Relaxed);
+            true
+        }
+        None => false,
+    }
+}
+
+/// 已注册算法的名称，以空格分隔 (tcp_get_available_congestion_control)
+pub fn tcp_available_congestion_control() -> alloc::string::String {
+    let mut names = alloc::string::String::new();
+    for ops in TCP_CONG_LIST.iter() {
+        if !names.is_empty() {
+            names.push(' ');
+        }
+        names.push_str(ops.name);
+    }
+    names
+}
+
+/// 根据启动参数 `tcp_congestion=` 选择默认算法
+pub fn tcp_cong_init() {
+    if let Some(name) = crate::cmdline::get_param("tcp_congestion") {
+        if !tcp_set_default_congestion_control(&name) {
+            crate::println!("tcp: unknown congestion control '{}', using {}", name, tcp_ca_default().name);
+        }
+    }
+}
+
+impl TcpSocket {
+    /// 初始化拥塞控制私有状态 (tcp_init_congestion_control)
+    pub(crate) fn tcp_init_congestion_control(&mut self) {
+        self.ca_priv = TcpCaPriv::None;
+        if let Some(init) = self.ca_ops.init {
+            init(self);
+        }
+    }
+
+    /// 切换拥塞控制算法 (tcp_set_congestion_control)
+    ///
+    /// # 返回
+    /// 名称不存在返回 -ENOENT
+    pub fn tcp_set_congestion_control(&mut self, name: &str) -> Result<(), i32> {
+        let ops = match tcp_ca_find(name) {
+            Some(ops) => ops,
+            None => return Err(-2), // ENOENT
+        };
+        if core::ptr::eq(ops, self.ca_ops) {
+            return Ok(());
+        }
+        self.ca_ops = ops;
+        // 换算法时速率由新算法重新确定
+        self.pacing_rate = 0;
+        self.tcp_init_congestion_control();
+        Ok(())
+    }
+
+    /// 切换拥塞状态，先通知算法 (tcp_set_ca_state)
+    pub(crate) fn tcp_set_ca_state(&mut self, new_state: TcpCaState) {
+        if let Some(set_state) = self.ca_ops.set_state {
+            set_state(self, new_state);
+        }
+        self.ca_state = new_state;
+    }
+
+    /// 通知算法连接事件 (tcp_ca_event)
+    pub(crate) fn tcp_ca_event(&mut self, ev: TcpCaEvent) {
+        if let Some(cwnd_event) = self.ca_ops.cwnd_event {
+            cwnd_event(self, ev);
+        }
+    }
+
+    /// 本次确认之前是否受拥塞窗口限制 (tcp_is_cwnd_limited)
+    ///
+    /// 慢启动中只要在途数据超过窗口的一半就允许增长，避免应用发送不足时窗口虚增
+    pub fn tcp_is_cwnd_limited(&self) -> bool {
+        let flight_segs = self.rate.prior_in_flight / self.mss;
+        if self.snd_cwnd < self.snd_ssthresh {
+            flight_segs * 2 > self.snd_cwnd
+        } else {
+            flight_segs + 1 >= self.snd_cwnd
+        }
+    }
+
+    /// 慢启动 (tcp_slow_start)
+    ///
+    /// # 返回
+    /// 超过慢启动门限后剩余、应按拥塞避免处理的报文段数
+    pub fn tcp_slow_start(&mut self, acked: u32) -> u32 {
+        let cwnd = core::cmp::min(self.snd_cwnd + acked, self.snd_ssthresh);
+        let left = acked - cwnd.saturating_sub(self.snd_cwnd).min(acked);
+        self.snd_cwnd = core::cmp::min(cwnd, TCP_MAX_CWND);
+        left
+    }
+
+    /// 每确认 w 个报文段窗口加一 (tcp_cong_avoid_ai)
+    pub fn tcp_cong_avoid_ai(&mut self, w: u32, acked: u32) {
+        let w = core::cmp::max(w, 1);
+        // 窗口已经超过 w 时（例如刚切换算法），先把计数清零再累加
+        if self.snd_cwnd_cnt >= w {
+            self.snd_cwnd_cnt = 0;
+            self.snd_cwnd += 1;
+        }
+        self.snd_cwnd_cnt += acked;
+        if self.snd_cwnd_cnt >= w {
+            let delta = self.snd_cwnd_cnt / w;
+            self.snd_cwnd_cnt -= delta * w;
+            self.snd_cwnd += delta;
+        }
+        self.snd_cwnd = core::cmp::min(self.snd_cwnd, TCP_MAX_CWND);
+    }
+}
+
+/// NewReno 的慢启动门限：拥塞窗口的一半 (tcp_reno_ssthresh)
+pub fn tcp_reno_ssthresh(sk: &mut TcpSocket) -> u32 {
+    core::cmp::max(sk.snd_cwnd >> 1, 2)
+}
+
+/// NewReno 的窗口增长：慢启动与每 RTT 加一 (tcp_reno_cong_avoid)
+pub fn tcp_reno_cong_avoid(sk: &mut TcpSocket, acked: u32) {
+    if !sk.tcp_is_cwnd_limited() {
+        return;
+    }
+    let mut acked = acked;
+    if sk.snd_cwnd < sk.snd_ssthresh {
+        acked = sk.tcp_slow_start(acked);
+        if acked == 0 {
+            return;
+        }
+    }
+    let cwnd = sk.snd_cwnd;
+    sk.tcp_cong_avoid_ai(cwnd, acked);
+}
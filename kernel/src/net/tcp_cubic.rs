@@ -0,0 +1,323 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! CUBIC 拥塞控制
+//!
+//! 拥塞避免阶段的窗口按距上次丢包的时间的三次函数增长：远离上次丢包时的窗口
+//! W_max 时快速增长，接近时放缓，越过之后再加速探测。增长与 RTT 无关，
+//! 在长肥管道上比 NewReno 更快地用满带宽。
+//!
+//! 参考: net/ipv4/tcp_cubic.c, RFC 9438
+//!
+//! # 设计
+//! - 与 Linux 相同使用定点数：时间单位为 1/1024 秒，β = 717/1024
+//! - 慢启动中用 HyStart 的时延检测提前退出，避免在瓶颈队列上造成大量丢包
+//! - 同时估计同样条件下 NewReno 的窗口，取两者中较大的增长速度 (TCP 友好性)
+
+use crate::drivers::timer::{get_jiffies, HZ};
+use crate::net::tcp::{after, TcpCaState, TcpSeq, TcpSocket};
+use crate::net::tcp_cong::{TcpCaEvent, TcpCaPriv, TcpCongestionOps};
+
+/// β 的定点数分母 (BICTCP_BETA_SCALE)
+const BICTCP_BETA_SCALE: u32 = 1024;
+
+/// 乘性减小因子 β = 717/1024 ≈ 0.7
+const BETA: u32 = 717;
+
+/// 三次函数的时间单位 2^-10 秒 (BICTCP_HZ)
+const BICTCP_HZ: u32 = 10;
+
+/// C = 0.4 的定点表示 (bic_scale * 10)
+const CUBE_RTT_SCALE: u64 = 41 * 10;
+
+/// K = cubic_root(W_max * (1 - β) / C) 中的系数 (cube_factor)
+const CUBE_FACTOR: u64 = (1u64 << (10 + 3 * BICTCP_HZ)) / CUBE_RTT_SCALE;
+
+/// TCP 友好性估计中每 RTT 的报文段增量 (beta_scale)
+const BETA_SCALE: u32 = 8 * (BICTCP_BETA_SCALE + BETA) / 3 / (BICTCP_BETA_SCALE - BETA);
+
+/// 窗口不小于该值时才启用 HyStart (hystart_low_window)
+const HYSTART_LOW_WINDOW: u32 = 16;
+
+/// 每轮参与 HyStart 判断的最少 RTT 样本数 (HYSTART_MIN_SAMPLES)
+const HYSTART_MIN_SAMPLES: u32 = 8;
+
+/// HyStart 时延增加门限的上下限（微秒）
+const HYSTART_DELAY_MIN: u32 = 4000;
+const HYSTART_DELAY_MAX: u32 = 16000;
+
+/// 每个连接的 CUBIC 状态 (struct bictcp)
+#[derive(Debug, Clone, Copy)]
+pub struct BicTcp {
+    /// 每增加一个报文段窗口所需确认的报文段数
+    cnt: u32,
+    /// 上次丢包前的窗口 W_max
+    last_max_cwnd: u32,
+    /// 上次计算时的窗口
+    last_cwnd: u32,
+    /// 上次计算的时间（jiffies）
+    last_time: u64,
+    /// 三次函数的原点
+    origin_point: u32,
+    /// 到达原点所需时间（2^-10 秒）
+    k: u32,
+    /// 最小 RTT（微秒）
+    delay_min: u32,
+    /// 本轮拥塞避免开始的时间（jiffies），0 表示尚未开始
+    epoch_start: u64,
+    /// 本轮确认的报文段数
+    ack_cnt: u32,
+    /// 按 NewReno 估计的窗口
+    tcp_cwnd: u32,
+    /// HyStart 已触发
+    found: bool,
+    /// HyStart 本轮结束的序列号
+    end_seq: TcpSeq,
+    /// HyStart 本轮的最小 RTT（微秒）
+    curr_rtt: u32,
+    /// HyStart 本轮的样本数
+    sample_cnt: u32,
+}
+
+impl BicTcp {
+    const fn new() -> Self {
+        Self {
+            cnt: 0,
+            last_max_cwnd: 0,
+            last_cwnd: 0,
+            last_time: 0,
+            origin_point: 0,
+            k: 0,
+            delay_min: 0,
+            epoch_start: 0,
+            ack_cnt: 0,
+            tcp_cwnd: 0,
+            found: false,
+            end_seq: 0,
+            curr_rtt: u32::MAX,
+            sample_cnt: 0,
+        }
+    }
+
+    /// 丢包后重新开始 (bictcp_reset)
+    fn reset(&mut self) {
+        *self = Self {
+            end_seq: self.end_seq,
+            ..Self::new()
+        };
+    }
+
+    /// 开始新一轮 HyStart 检测 (bictcp_hystart_reset)
+    fn hystart_reset(&mut self, snd_nxt: TcpSeq) {
+        self.end_seq = snd_nxt;
+        self.curr_rtt = u32::MAX;
+        self.sample_cnt = 0;
+    }
+
+    /// 计算拥塞避免阶段的 cnt (bictcp_update)
+    fn update(&mut self, cwnd: u32, acked: u32) {
+        let now = get_jiffies();
+        self.ack_cnt += acked;
+
+        if self.last_cwnd == cwnd && now.wrapping_sub(self.last_time) <= HZ / 32 {
+            return;
+        }
+
+        // 三次函数每个 jiffy 最多更新一次
+        if !(self.epoch_start != 0 && now == self.last_time) {
+            self.last_cwnd = cwnd;
+            self.last_time = now;
+
+            if self.epoch_start == 0 {
+                self.epoch_start = now.max(1);
+                self.ack_cnt = acked;
+                self.tcp_cwnd = cwnd;
+                if self.last_max_cwnd <= cwnd {
+                    self.k = 0;
+                    self.origin_point = cwnd;
+                } else {
+                    self.k = cubic_root(CUBE_FACTOR * (self.last_max_cwnd - cwnd) as u64);
+                    self.origin_point = self.last_max_cwnd;
+                }
+            }
+
+            // t = 从本轮开始经过的时间 + 最小 RTT，单位 2^-10 秒
+            let delay_jiffies = (self.delay_min as u64 * HZ + 999_999) / 1_000_000;
+            let t = ((now.wrapping_sub(self.epoch_start) + delay_jiffies) << BICTCP_HZ) / HZ;
+            let offs = if t < self.k as u64 { self.k as u64 - t } else { t - self.k as u64 };
+            // C * (t - K)^3，offs 超过 2^21 时立方会溢出，此时目标已远超任何窗口
+            let offs = offs.min(1 << 21);
+            let delta = ((CUBE_RTT_SCALE * offs * offs * offs) >> (10 + 3 * BICTCP_HZ)).min(u32::MAX as u64) as u32;
+            let target = if t < self.k as u64 {
+                self.origin_point.saturating_sub(delta)
+            } else {
+                self.origin_point.saturating_add(delta)
+            };
+
+            self.cnt = if target > cwnd { cwnd / (target - cwnd) } else { 100 * cwnd };
+            // 第一次丢包之前限制增长速度：每 RTT 最多增加 5%
+            if self.last_max_cwnd == 0 && self.cnt > 20 {
+                self.cnt = 20;
+            }
+        }
+
+        // TCP 友好性：不比同样条件下的 NewReno 慢
+        let delta = (cwnd * BETA_SCALE) >> 3;
+        if delta > 0 {
+            while self.ack_cnt > delta {
+                self.ack_cnt -= delta;
+                self.tcp_cwnd += 1;
+            }
+        }
+        if self.tcp_cwnd > cwnd {
+            let max_cnt = cwnd / (self.tcp_cwnd - cwnd);
+            if self.cnt > max_cnt {
+                self.cnt = max_cnt;
+            }
+        }
+
+        self.cnt = core::cmp::max(self.cnt, 2);
+    }
+}
+
+/// 整数立方根 (cubic_root)
+fn cubic_root(a: u64) -> u32 {
+    if a == 0 {
+        return 0;
+    }
+    // 从 2^(ceil(bits/3)) 开始的牛顿迭代，结果单调下降到 floor(cbrt(a))
+    let bits = 64 - a.leading_zeros();
+    let mut x: u64 = 1 << ((bits + 2) / 3);
+    loop {
+        let y = (2 * x + a / (x * x)) / 3;
+        if y >= x {
+            return x as u32;
+        }
+        x = y;
+    }
+}
+
+/// CUBIC (cubictcp)
+pub static TCP_CUBIC: TcpCongestionOps = TcpCongestionOps {
+    name: "cubic",
+    init: Some(cubictcp_init),
+    ssthresh: cubictcp_recalc_ssthresh,
+    cong_avoid: Some(cubictcp_cong_avoid),
+    cong_control: None,
+    set_state: Some(cubictcp_state),
+    cwnd_event: Some(cubictcp_cwnd_event),
+    pkts_acked: Some(cubictcp_acked),
+};
+
+/// 取出连接上的 CUBIC 状态；算法刚切换过来时从初始状态开始
+fn bictcp(sk: &TcpSocket) -> BicTcp {
+    match sk.ca_priv {
+        TcpCaPriv::Cubic(ca) => ca,
+        _ => {
+            let mut ca = BicTcp::new();
+            ca.hystart_reset(sk.snd_nxt);
+            ca
+        }
+    }
+}
+
+fn cubictcp_init(sk: &mut TcpSocket) {
+    let mut ca = BicTcp::new();
+    ca.hystart_reset(sk.snd_nxt);
+    sk.ca_priv = TcpCaPriv::Cubic(ca);
+}
+
+/// 丢包：记录 W_max 并按 β 减小 (cubictcp_recalc_ssthresh)
+fn cubictcp_recalc_ssthresh(sk: &mut TcpSocket) -> u32 {
+    let mut ca = bictcp(sk);
+    let cwnd = sk.snd_cwnd;
+    ca.epoch_start = 0;
+    // 快速收敛：W_max 还没恢复到上次的值又丢包，说明有新流加入，让出更多带宽
+    ca.last_max_cwnd = if cwnd < ca.last_max_cwnd {
+        cwnd * (BICTCP_BETA_SCALE + BETA) / (2 * BICTCP_BETA_SCALE)
+    } else {
+        cwnd
+    };
+    sk.ca_priv = TcpCaPriv::Cubic(ca);
+    core::cmp::max(cwnd * BETA / BICTCP_BETA_SCALE, 2)
+}
+
+/// 窗口增长 (cubictcp_cong_avoid)
+fn cubictcp_cong_avoid(sk: &mut TcpSocket, acked: u32) {
+    if !sk.tcp_is_cwnd_limited() {
+        return;
+    }
+    let mut ca = bictcp(sk);
+    let mut acked = acked;
+    if sk.snd_cwnd < sk.snd_ssthresh {
+        // 每一轮数据被确认后开始新一轮 HyStart 检测
+        if after(sk.snd_una, ca.end_seq) {
+            ca.hystart_reset(sk.snd_nxt);
+        }
+        acked = sk.tcp_slow_start(acked);
+        if acked == 0 {
+            sk.ca_priv = TcpCaPriv::Cubic(ca);
+            return;
+        }
+    }
+    ca.update(sk.snd_cwnd, acked);
+    let cnt = ca.cnt;
+    sk.ca_priv = TcpCaPriv::Cubic(ca);
+    sk.tcp_cong_avoid_ai(cnt, acked);
+}
+
+/// 超时后一切重新开始 (cubictcp_state)
+fn cubictcp_state(sk: &mut TcpSocket, new_state: TcpCaState) {
+    if new_state == TcpCaState::Loss {
+        let mut ca = bictcp(sk);
+        ca.reset();
+        ca.hystart_reset(sk.snd_nxt);
+        sk.ca_priv = TcpCaPriv::Cubic(ca);
+    }
+}
+
+/// 空闲后重新发送：三次函数的时间轴不计空闲时间 (cubictcp_cwnd_event)
+fn cubictcp_cwnd_event(sk: &mut TcpSocket, ev: TcpCaEvent) {
+    if ev == TcpCaEvent::TxStart {
+        let mut ca = bictcp(sk);
+        let now = get_jiffies();
+        if ca.epoch_start != 0 && now > sk.lsndtime {
+            ca.epoch_start = core::cmp::min(ca.epoch_start + (now - sk.lsndtime), now);
+        }
+        sk.ca_priv = TcpCaPriv::Cubic(ca);
+    }
+}
+
+/// RTT 样本：更新最小 RTT，慢启动中做 HyStart 时延检测 (cubictcp_acked)
+fn cubictcp_acked(sk: &mut TcpSocket, _acked: u32, rtt_us: i64) {
+    if rtt_us < 0 {
+        return;
+    }
+    let mut ca = bictcp(sk);
+    // 刚从快速恢复出来的样本受重传影响，丢弃
+    if ca.epoch_start != 0 && get_jiffies().wrapping_sub(ca.epoch_start) < HZ {
+        return;
+    }
+    let delay = core::cmp::max(core::cmp::min(rtt_us, u32::MAX as i64 - 1) as u32, 1);
+    if ca.delay_min == 0 || ca.delay_min > delay {
+        ca.delay_min = delay;
+    }
+
+    // HyStart：本轮最小 RTT 比全局最小 RTT 高出门限时，认为队列开始堆积 (hystart_update)
+    if !ca.found && sk.snd_cwnd < sk.snd_ssthresh && sk.snd_cwnd >= HYSTART_LOW_WINDOW {
+        if ca.curr_rtt > delay {
+            ca.curr_rtt = delay;
+        }
+        if ca.sample_cnt < HYSTART_MIN_SAMPLES {
+            ca.sample_cnt += 1;
+        } else {
+            let thresh = (ca.delay_min >> 3).clamp(HYSTART_DELAY_MIN, HYSTART_DELAY_MAX);
+            if ca.curr_rtt > ca.delay_min.saturating_add(thresh) {
+                ca.found = true;
+                sk.snd_ssthresh = sk.snd_cwnd;
+            }
+        }
+    }
+    sk.ca_priv = TcpCaPriv::Cubic(ca);
+}
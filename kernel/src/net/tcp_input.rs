@@ -0,0 +1,594 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! TCP 接收路径
+//!
+//! 处理已同步连接上的报文段：确认与窗口更新、SACK 记分板、RTT 取样、
+//! 重复 ACK 触发的快速重传与恢复，以及按序、乱序数据的接收和 ACK 生成。
+//!
+//! 参考: net/ipv4/tcp_input.c
+//!
+//! # 设计
+//! - 乱序数据直接写入接收缓冲区中对应的位置，只记录区间；空洞补齐后整段并入
+//! - 快速恢复按 NewReno/SACK 选择重传的空洞，窗口的增减交给 tcp_cong 中的算法
+//! - 每收到两个满报文段或遇到乱序、FIN 时立即 ACK，否则由延迟 ACK 定时器发送
+
+use crate::drivers::timer::get_jiffies;
+use crate::net::tcp::{
+    after, before, TcpCaState, TcpHdr, TcpSeq, TcpSocket, TcpState, TCPOLEN_MSS, TCPOLEN_SACK_BASE,
+    TCPOLEN_SACK_PERBLOCK, TCPOLEN_SACK_PERM, TCPOLEN_WINDOW, TCPOPT_EOL, TCPOPT_MSS, TCPOPT_NOP,
+    TCPOPT_SACK, TCPOPT_SACK_PERM, TCPOPT_WINDOW, TCP_FASTRETRANS_THRESH, TCP_MAX_CWND,
+    TCP_MAX_OFO_RANGES, TCP_NUM_SACKS,
+};
+use crate::net::tcp_rate::TcpRateSample;
+use crate::net::tcp_timer::{tcp_clock_us, TCP_DELACK_MIN, TCP_TIMEWAIT_LEN};
+
+/// 解析出的 TCP 选项 (tcp_options_received)
+#[derive(Debug, Clone, Copy, Default)]
+pub struct TcpOptions {
+    /// 对端的 MSS（仅 SYN）
+    pub mss: Option<u16>,
+    /// 对端的窗口扩大因子（仅 SYN）
+    pub wscale: Option<u8>,
+    /// 对端允许 SACK（仅 SYN）
+    pub sack_perm: bool,
+    /// SACK 块 [start, end)
+    pub sacks: [(TcpSeq, TcpSeq); TCP_NUM_SACKS],
+    /// SACK 块数
+    pub num_sacks: usize,
+}
+
+/// 解析 TCP 选项 (tcp_parse_options)
+///
+/// # 参数
+/// - `opts`: 头部中 20 字节之后的选项部分
+pub fn tcp_parse_options(opts: &[u8]) -> TcpOptions {
+    let mut parsed = TcpOptions::default();
+    let mut i = 0;
+    while i < opts.len() {
+        let kind = opts[i];
+        if kind == TCPOPT_EOL {
+            break;
+        }
+        if kind == TCPOPT_NOP {
+            i += 1;
+            continue;
+        }
+        if i + 1 >= opts.len() {
+            break;
+        }
+        let len = opts[i + 1] as usize;
+        if len < 2 || i + len > opts.len() {
+            break;
+        }
+        let body = &opts[i + 2..i + len];
+        match kind {
+            TCPOPT_MSS if len == TCPOLEN_MSS as usize => {
+                parsed.mss = Some(u16::from_be_bytes([body[0], body[1]]));
+            }
+            TCPOPT_WINDOW if len == TCPOLEN_WINDOW as usize => {
+                parsed.wscale = Some(body[0]);
+            }
+            TCPOPT_SACK_PERM if len == TCPOLEN_SACK_PERM as usize => {
+                parsed.sack_perm = true;
+            }
+            TCPOPT_SACK if (len - TCPOLEN_SACK_BASE as usize) % TCPOLEN_SACK_PERBLOCK as usize == 0 => {
+                for block in body.chunks_exact(8) {
+                    if parsed.num_sacks == TCP_NUM_SACKS {
+                        break;
+                    }
+                    let start = u32::from_be_bytes([block[0], block[1], block[2], block[3]]);
+                    let end = u32::from_be_bytes([block[4], block[5], block[6], block[7]]);
+                    parsed.sacks[parsed.num_sacks] = (start, end);
+                    parsed.num_sacks += 1;
+                }
+            }
+            _ => {}
+        }
+        i += len;
+    }
+    parsed
+}
+
+/// 把区间 [start, end) 并入按序排列、互不重叠的区间表
+///
+/// # 返回
+/// 区间表已满、无法加入时返回 false
+pub(crate) fn tcp_range_insert(ranges: &mut alloc::vec::Vec<(TcpSeq, TcpSeq)>, start: TcpSeq, end: TcpSeq, max: usize) -> bool {
+    let mut start = start;
+    let mut end = end;
+    // 与新区间重叠或相接的区间合并进来
+    let mut i = 0;
+    while i < ranges.len() {
+        let (s, e) = ranges[i];
+        if after(s, end) || before(e, start) {
+            i += 1;
+            continue;
+        }
+        if before(s, start) {
+            start = s;
+        }
+        if after(e, end) {
+            end = e;
+        }
+        ranges.remove(i);
+    }
+    if ranges.len() >= max {
+        return false;
+    }
+    let pos = ranges.iter().position(|&(s, _)| after(s, start)).unwrap_or(ranges.len());
+    ranges.insert(pos, (start, end));
+    true
+}
+
+impl TcpSocket {
+    /// 已同步连接上的报文段处理 (tcp_rcv_established + tcp_rcv_state_process)
+    ///
+    /// # 参数
+    /// - `tcp_hdr`: TCP 头部
+    /// - `opts`: 解析出的选项
+    /// - `data`: 数据部分
+    pub(crate) fn tcp_rcv_established(&mut self, tcp_hdr: &TcpHdr, opts: &TcpOptions, data: &[u8]) -> Result<(), ()> {
+        let seq = TcpSeq::from_be(tcp_hdr.seq);
+
+        // RST 只在序列号落在接收窗口内时生效 (RFC 5961)
+        if tcp_hdr.rst() {
+            let wnd = self.recv_buf.free_space() as u32;
+            if !before(seq, self.rcv_nxt) && before(seq, self.rcv_nxt.wrapping_add(wnd.max(1))) {
+                let err = if self.state == TcpState::TCP_CLOSE_WAIT { -32 } else { -104 }; // EPIPE / ECONNRESET
+                self.tcp_done(err);
+            }
+            return Ok(());
+        }
+        // 同步状态下收到 SYN：对端的旧连接，回 ACK 让它发 RST
+        if tcp_hdr.syn() {
+            return self.tcp_send_ack();
+        }
+        if !tcp_hdr.ack() {
+            return Ok(());
+        }
+
+        let is_pure_ack = data.is_empty() && !tcp_hdr.fin();
+        let ack = TcpSeq::from_be(tcp_hdr.ack_seq);
+        self.tcp_ack(ack, seq, tcp_hdr.window(), opts, is_pure_ack)?;
+
+        let mut quick_ack = false;
+        if !data.is_empty() || tcp_hdr.fin() {
+            if self.fin_rcvd {
+                // FIN 之后的数据只需再次确认
+                quick_ack = true;
+            } else {
+                quick_ack = self.tcp_data_queue(seq, data, tcp_hdr.fin());
+            }
+        }
+
+        // 确认可能打开了窗口，发送等待中的数据（同时捎带 ACK）
+        self.tcp_write_xmit();
+        self.tcp_ack_snd_check(quick_ack)
+    }
+
+    /// 处理确认号与窗口 (tcp_ack)
+    ///
+    /// # 参数
+    /// - `ack`: 确认号
+    /// - `seq`: 报文段序列号，用于判断窗口更新的新旧
+    /// - `window`: 报文段中的窗口（未放大）
+    /// - `is_pure_ack`: 不带数据和 FIN，可作为重复 ACK 计数
+    pub(crate) fn tcp_ack(&mut self, ack: TcpSeq, seq: TcpSeq, window: u16, opts: &TcpOptions, is_pure_ack: bool) -> Result<(), ()> {
+        // 确认了还没发送的数据：回 ACK，丢弃该确认
+        if after(ack, self.snd_nxt) {
+            return self.tcp_send_ack();
+        }
+        // 过时的确认
+        if before(ack, self.snd_una) {
+            return Ok(());
+        }
+
+        // 窗口更新 (tcp_may_update_window)
+        let new_wnd = (window as u32) << self.snd_wscale;
+        let wnd_changed = new_wnd != self.snd_wnd;
+        if after(seq, self.snd_wl1) || (seq == self.snd_wl1 && !before(ack, self.snd_wl2)) {
+            self.snd_wnd = new_wnd;
+            self.snd_wl1 = seq;
+            self.snd_wl2 = ack;
+        }
+
+        let prior_state = self.ca_state;
+        let prior_sacked = self.tcp_sacked_bytes();
+        self.rate.prior_in_flight = self.tcp_bytes_in_flight();
+
+        if self.sack_ok && opts.num_sacks > 0 {
+            self.tcp_sacktag(opts);
+        }
+
+        let acked = ack.wrapping_sub(self.snd_una);
+        if acked > 0 {
+            self.tcp_clean_rtx_queue(ack, acked);
+        } else if is_pure_ack && !wnd_changed && self.snd_una != self.snd_nxt {
+            self.tcp_dupack();
+        }
+
+        // 新交付的字节：累计确认的部分加上新 SACK 的部分（之前 SACK 过的不重复计算）
+        let delivered = (acked + self.tcp_sacked_bytes()).saturating_sub(prior_sacked);
+        let rs = self.tcp_rate_gen(delivered, tcp_clock_us());
+        if acked > 0 {
+            if let Some(pkts_acked) = self.ca_ops.pkts_acked {
+                let segs = core::cmp::max(1, acked / self.mss);
+                pkts_acked(self, segs, rs.rtt_us);
+            }
+        }
+        self.tcp_cong_control(acked, prior_state, &rs);
+        Ok(())
+    }
+
+    /// 按本次确认调整拥塞窗口 (tcp_cong_control)
+    ///
+    /// 实现了 cong_control 的算法每个确认都调用；其他算法只在确认了新数据、
+    /// 且确认之前不处于快速恢复时增长窗口 (tcp_may_raise_cwnd)
+    fn tcp_cong_control(&mut self, acked: u32, prior_state: TcpCaState, rs: &TcpRateSample) {
+        if let Some(cong_control) = self.ca_ops.cong_control {
+            cong_control(self, rs);
+            return;
+        }
+        if acked == 0 || prior_state == TcpCaState::Recovery {
+            return;
+        }
+        if let Some(cong_avoid) = self.ca_ops.cong_avoid {
+            cong_avoid(self, core::cmp::max(1, acked / self.mss));
+        }
+    }
+
+    /// 记录对端 SACK 的区间 (tcp_sacktag_write_queue)
+    fn tcp_sacktag(&mut self, opts: &TcpOptions) {
+        for &(start, end) in &opts.sacks[..opts.num_sacks] {
+            // 只接受落在 (snd_una, snd_nxt] 内的块；D-SACK 等不在此范围的块忽略
+            if !after(end, start) || !after(end, self.snd_una) || after(end, self.snd_nxt) {
+                continue;
+            }
+            let start = if before(start, self.snd_una) { self.snd_una } else { start };
+            self.stats.sack_blocks += 1;
+            tcp_range_insert(&mut self.sacked, start, end, usize::MAX);
+        }
+    }
+
+    /// 被 SACK 确认的字节数
+    pub(crate) fn tcp_sacked_bytes(&self) -> u32 {
+        self.sacked.iter().map(|&(s, e)| e.wrapping_sub(s)).sum()
+    }
+
+    /// [start, end) 中被 SACK 确认的字节数
+    fn tcp_sacked_in(&self, start: TcpSeq, end: TcpSeq) -> u32 {
+        let mut bytes = 0;
+        for &(s, e) in &self.sacked {
+            let s = if before(s, start) { start } else { s };
+            let e = if after(e, end) { end } else { e };
+            if after(e, s) {
+                bytes += e.wrapping_sub(s);
+            }
+        }
+        bytes
+    }
+
+    /// 判定为丢失、但尚未重传的字节数 (tcp_mark_head_lost)
+    ///
+    /// 超时后 high_rxt 到 high_seq 之间未被 SACK 的部分都已丢失；
+    /// 快速恢复中只有最高 SACK 块之下的空洞算作丢失 (RFC 6675)
+    fn tcp_lost_bytes(&self) -> u32 {
+        let from = if before(self.high_rxt, self.snd_una) { self.snd_una } else { self.high_rxt };
+        let to = match self.ca_state {
+            TcpCaState::Open => return 0,
+            TcpCaState::Recovery => match self.sacked.last() {
+                Some(&(_, e)) if self.sack_ok => e,
+                _ => return 0,
+            },
+            TcpCaState::Loss => self.high_seq,
+        };
+        if !after(to, from) {
+            return 0;
+        }
+        to.wrapping_sub(from) - self.tcp_sacked_in(from, to)
+    }
+
+    /// 网络中的字节数估计：已发送未确认、未被 SACK 且未判定丢失的部分 (tcp_packets_in_flight)
+    pub(crate) fn tcp_bytes_in_flight(&self) -> u32 {
+        self.snd_nxt
+            .wrapping_sub(self.snd_una)
+            .saturating_sub(self.tcp_sacked_bytes())
+            .saturating_sub(self.tcp_lost_bytes())
+    }
+
+    /// 下一个需要重传的空洞 (tcp_xmit_retransmit_queue 中的选择)
+    ///
+    /// # 返回
+    /// 空洞的起始序列号与长度（不超过一个 MSS）
+    pub(crate) fn tcp_next_hole(&self) -> Option<(TcpSeq, u32)> {
+        let mut from = if before(self.high_rxt, self.snd_una) { self.snd_una } else { self.high_rxt };
+        let limit = match self.ca_state {
+            TcpCaState::Open => return None,
+            TcpCaState::Loss => self.high_seq,
+            TcpCaState::Recovery => match self.sacked.last() {
+                Some(&(_, e)) if self.sack_ok => e,
+                // 没有 SACK 信息：每个部分确认只重传队首的一个报文段 (NewReno)
+                _ if from == self.snd_una => self.snd_una.wrapping_add(self.mss),
+                _ => return None,
+            },
+        };
+        let limit = if after(limit, self.high_seq) { self.high_seq } else { limit };
+
+        for &(s, e) in &self.sacked {
+            if !after(e, from) {
+                continue;
+            }
+            if after(s, from) {
+                break;
+            }
+            from = e;
+        }
+        if !before(from, limit) {
+            return None;
+        }
+        let hole_end = self
+            .sacked
+            .iter()
+            .map(|&(s, _)| s)
+            .find(|&s| after(s, from))
+            .filter(|&s| before(s, limit))
+            .unwrap_or(limit);
+        Some((from, core::cmp::min(hole_end.wrapping_sub(from), self.mss)))
+    }
+
+    /// 处理新确认的数据 (tcp_clean_rtx_queue)
+    fn tcp_clean_rtx_queue(&mut self, ack: TcpSeq, acked: u32) {
+        let now = get_jiffies();
+        let own_cwnd = self.ca_ops.cong_control.is_none();
+
+        // 释放发送缓冲区；超出数据部分的 1 个序列号是 FIN
+        let data_acked = core::cmp::min(acked as usize, self.send_buf.len());
+        self.send_buf.consume(data_acked);
+        self.snd_una = ack;
+        self.stats.bytes_acked += data_acked as u64;
+        let fin_acked = self.fin_sent && ack == self.snd_nxt && self.send_buf.is_empty();
+
+        // 记分板中已确认的部分去掉
+        self.sacked.retain(|&(_, e)| after(e, ack));
+        if let Some(first) = self.sacked.first_mut() {
+            if before(first.0, ack) {
+                first.0 = ack;
+            }
+        }
+
+        // RTT 取样：只对从未重传过的报文段计时 (Karn 算法)
+        if self.rtt_start != 0 && !before(ack, self.rtt_seq) {
+            self.tcp_rtt_estimator(now.saturating_sub(self.rtt_start));
+            self.rtt_start = 0;
+        }
+        self.backoff = 0;
+
+        match self.ca_state {
+            TcpCaState::Recovery if !before(ack, self.high_seq) => {
+                // 恢复点之前的数据全部确认，退出快速恢复
+                self.tcp_set_ca_state(TcpCaState::Open);
+                if own_cwnd {
+                    self.snd_cwnd = core::cmp::max(self.snd_ssthresh, 2);
+                    self.snd_cwnd_cnt = 0;
+                }
+                self.dup_acks = 0;
+            }
+            TcpCaState::Recovery => {
+                // 部分确认：下一个空洞也已丢失，立即重传 (RFC 6582)
+                if !self.sack_ok && own_cwnd {
+                    let acked_segs = (acked + self.mss - 1) / self.mss;
+                    self.snd_cwnd = self.snd_cwnd.saturating_sub(acked_segs).max(1) + 1;
+                }
+                self.tcp_xmit_retransmit_queue();
+            }
+            TcpCaState::Loss => {
+                // 超时后按慢启动增长，超时前发出的数据全部确认后回到 Open
+                if !before(ack, self.high_seq) {
+                    self.tcp_set_ca_state(TcpCaState::Open);
+                    self.dup_acks = 0;
+                }
+            }
+            TcpCaState::Open => {
+                self.dup_acks = 0;
+            }
+        }
+
+        // 仍有未确认的数据时重新计时，否则停止重传定时器
+        if self.snd_una == self.snd_nxt {
+            self.retransmit_deadline = 0;
+        } else {
+            self.tcp_reset_xmit_timer();
+        }
+
+        if fin_acked {
+            self.tcp_fin_acked();
+        }
+    }
+
+    /// 重复 ACK：达到门限时快速重传并进入快速恢复 (tcp_fastretrans_alert)
+    fn tcp_dupack(&mut self) {
+        self.dup_acks += 1;
+        if self.ca_state == TcpCaState::Loss {
+            // 超时恢复中不做快速重传
+            self.tcp_xmit_retransmit_queue();
+            return;
+        }
+        if self.ca_state == TcpCaState::Recovery {
+            // 没有 SACK 时每个重复 ACK 代表一个离开网络的报文段，窗口膨胀一个 MSS
+            if !self.sack_ok && self.ca_ops.cong_control.is_none() {
+                self.snd_cwnd = core::cmp::min(self.snd_cwnd + 1, TCP_MAX_CWND);
+            }
+            self.tcp_xmit_retransmit_queue();
+            return;
+        }
+
+        // 有 SACK 时，被 SACK 的数据超过门限个报文段也说明队首已丢失 (RFC 6675)
+        let sack_lost = self.sack_ok && self.tcp_sacked_bytes() >= TCP_FASTRETRANS_THRESH * self.mss;
+        if self.dup_acks >= TCP_FASTRETRANS_THRESH || sack_lost {
+            self.tcp_enter_recovery();
+        }
+    }
+
+    /// 进入快速恢复并重传队首 (tcp_enter_recovery)
+    fn tcp_enter_recovery(&mut self) {
+        self.snd_ssthresh = (self.ca_ops.ssthresh)(self);
+        // 有 SACK 时按记分板估计网络中的数据，不需要膨胀窗口；
+        // 自己控制窗口的算法（BBR）在 cong_control 中处理
+        if self.ca_ops.cong_control.is_none() {
+            self.snd_cwnd = if self.sack_ok {
+                self.snd_ssthresh
+            } else {
+                self.snd_ssthresh + TCP_FASTRETRANS_THRESH
+            };
+            self.snd_cwnd_cnt = 0;
+        }
+        self.tcp_set_ca_state(TcpCaState::Recovery);
+        self.high_seq = self.snd_nxt;
+        self.high_rxt = self.snd_una;
+        // 重传过的数据不能再用于 RTT 取样
+        self.rtt_start = 0;
+        self.stats.fast_retrans += 1;
+
+        // 快速重传不受拥塞窗口限制
+        let len = core::cmp::min(self.mss, self.high_seq.wrapping_sub(self.snd_una));
+        if self.tcp_retransmit_range(self.snd_una, len).is_ok() {
+            self.high_rxt = self.snd_una.wrapping_add(len);
+        }
+        self.tcp_xmit_retransmit_queue();
+    }
+
+    /// 本端的 FIN 已被确认
+    fn tcp_fin_acked(&mut self) {
+        match self.state {
+            TcpState::TCP_FIN_WAIT1 => {
+                self.state = TcpState::TCP_FIN_WAIT2;
+            }
+            TcpState::TCP_CLOSING => {
+                self.tcp_time_wait();
+            }
+            TcpState::TCP_LAST_ACK => {
+                self.tcp_done(0);
+            }
+            _ => {}
+        }
+    }
+
+    /// 进入 TIME_WAIT (tcp_time_wait)
+    fn tcp_time_wait(&mut self) {
+        self.state = TcpState::TCP_TIME_WAIT;
+        self.retransmit_deadline = 0;
+        self.timewait_deadline = get_jiffies() + TCP_TIMEWAIT_LEN;
+    }
+
+    /// 把数据放入接收缓冲区 (tcp_data_queue)
+    ///
+    /// # 返回
+    /// 需要立即 ACK 时返回 true（乱序、重复、窗口外、补齐空洞或收到 FIN）
+    fn tcp_data_queue(&mut self, seq: TcpSeq, data: &[u8], fin: bool) -> bool {
+        let end = seq.wrapping_add(data.len() as u32);
+
+        // 完全重复的报文段；FIN 占用 end 这个序列号
+        if !after(end, self.rcv_nxt) && !(fin && end == self.rcv_nxt) {
+            return true;
+        }
+
+        // 去掉已经收到的开头部分
+        let (seq, data) = if before(seq, self.rcv_nxt) {
+            let skip = self.rcv_nxt.wrapping_sub(seq) as usize;
+            (self.rcv_nxt, &data[core::cmp::min(skip, data.len())..])
+        } else {
+            (seq, data)
+        };
+        let offset = seq.wrapping_sub(self.rcv_nxt) as usize;
+
+        // 截掉窗口之外的部分
+        let room = self.recv_buf.free_space();
+        if offset > room || (offset == room && !data.is_empty()) {
+            return true;
+        }
+        let (data, fin) = if offset + data.len() > room {
+            (&data[..room - offset], false)
+        } else {
+            (data, fin)
+        };
+
+        if offset != 0 {
+            // 乱序：写到对应位置，记录区间用于 SACK；乱序的 FIN 等重传
+            if data.is_empty() {
+                return true;
+            }
+            let start = seq;
+            let end = seq.wrapping_add(data.len() as u32);
+            if tcp_range_insert(&mut self.ofo, start, end, TCP_MAX_OFO_RANGES) {
+                self.recv_buf.write_at(self.recv_buf.len() + offset, data);
+                self.ofo_last = start;
+                self.stats.ofo_segs += 1;
+            }
+            return true;
+        }
+
+        // 按序数据
+        let n = self.recv_buf.push(data);
+        self.rcv_nxt = self.rcv_nxt.wrapping_add(n as u32);
+        self.stats.bytes_received += n as u64;
+        let mut quick_ack = false;
+
+        // 乱序区间接上后并入
+        if !self.ofo.is_empty() {
+            quick_ack = true;
+            while let Some(&(start, end)) = self.ofo.first() {
+                if after(start, self.rcv_nxt) {
+                    break;
+                }
+                self.ofo.remove(0);
+                if after(end, self.rcv_nxt) {
+                    let extra = end.wrapping_sub(self.rcv_nxt);
+                    self.recv_buf.commit(extra as usize);
+                    self.rcv_nxt = end;
+                    self.stats.bytes_received += extra as u64;
+                }
+            }
+        }
+
+        if fin && self.ofo.is_empty() {
+            self.tcp_fin();
+            return true;
+        }
+
+        // GRO 合并的包按其中的报文段数计，仍是每两个报文段确认一次
+        self.ack_pending += (data.len() as u32).div_ceil(self.mss.max(1)).max(1);
+        quick_ack
+    }
+
+    /// 收到按序的 FIN (tcp_fin)
+    fn tcp_fin(&mut self) {
+        self.rcv_nxt = self.rcv_nxt.wrapping_add(1);
+        self.fin_rcvd = true;
+        match self.state {
+            TcpState::TCP_ESTABLISHED => {
+                self.state = TcpState::TCP_CLOSE_WAIT;
+            }
+            TcpState::TCP_FIN_WAIT1 => {
+                // 本端 FIN 尚未被确认：同时关闭
+                self.state = TcpState::TCP_CLOSING;
+            }
+            TcpState::TCP_FIN_WAIT2 => {
+                self.tcp_time_wait();
+            }
+            _ => {}
+        }
+    }
+
+    /// 决定立即发送 ACK 还是延迟 (__tcp_ack_snd_check)
+    fn tcp_ack_snd_check(&mut self, quick_ack: bool) -> Result<(), ()> {
+        if quick_ack || self.ack_pending >= 2 {
+            return self.tcp_send_ack();
+        }
+        if self.ack_pending > 0 && self.delack_deadline == 0 {
+            self.delack_deadline = get_jiffies() + TCP_DELACK_MIN;
+        }
+        Ok(())
+    }
+}
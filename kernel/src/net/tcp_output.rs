@@ -0,0 +1,418 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! TCP 发送路径
+//!
+//! 应用写入的数据留在发送缓冲区中，直到被确认。发送时在拥塞窗口与对端接收窗口
+//! 允许的范围内，把尽可能多的数据组成一个 TSO/GSO 超长包交给 IP 层；
+//! 重传直接从发送缓冲区重新组包，不保留已发送的 SkBuff。
+//! 拥塞控制算法设置了 pacing 速率时，按速率把发送分成一个个小突发，
+//! 突发之间由 pacing 定时器推迟（粒度为一个 jiffy）。
+//!
+//! 多次小写入在发送缓冲区中连成一段，末尾不足一个 MSS 的零头按以下规则推迟，
+//! 凑满 MSS 或条件解除时再发出 (tcp_nagle_test)：
+//! - Nagle (Minshall 变体)：已发出的小报文段未被确认时推迟，TCP_NODELAY 关闭
+//! - TCP_CORK 与 MSG_MORE：一律推迟，最多 TCP_CORK_MAX，到期由定时器发出
+//! - 已排队 FIN 时不推迟
+//!
+//! 参考: net/ipv4/tcp_output.c
+
+use crate::drivers::timer::{get_jiffies, HZ};
+use crate::net::buffer::SKB_GSO_TCPV4;
+use crate::net::ipv4::IPHDR_LEN;
+use crate::net::tcp::{
+    after, tcp_alloc_skb, tcp_build_header, TcpCaState, TcpSeq, TcpSocket, TcpState, TCPHDR_ACK,
+    TCPHDR_FIN, TCPHDR_PSH, TCPHDR_RST, TCPHDR_SYN, TCPOLEN_MSS, TCPOLEN_SACK_BASE,
+    TCPOLEN_SACK_PERBLOCK, TCPOLEN_SACK_PERM, TCPOLEN_WINDOW, TCPOPT_MSS, TCPOPT_NOP, TCPOPT_SACK,
+    TCPOPT_SACK_PERM, TCPOPT_WINDOW, TCP_GSO_MAX_SIZE, TCP_MAX_HLEN, TCP_MAX_WINDOW, TCP_MIN_HLEN,
+    TCP_MSS, TCP_NUM_SACKS,
+};
+use crate::net::tcp_cong::TcpCaEvent;
+use crate::net::tcp_timer::tcp_clock_us;
+
+/// 选项区最大长度
+const TCP_MAX_OPTLEN: usize = TCP_MAX_HLEN - TCP_MIN_HLEN;
+
+/// cork 与 MSG_MORE 推迟零头的上限 (200ms，与 TCP_CORK 的上限一致)
+pub const TCP_CORK_MAX: u64 = HZ / 5;
+
+/// MSS 的下限 (TCP_MIN_SND_MSS)
+pub const TCP_MIN_SND_MSS: u32 = 48;
+
+/// 路径 MTU 对应的 MSS：数据报文段不带选项 (tcp_mtu_to_mss)
+#[inline]
+pub fn tcp_mtu_to_mss(pmtu: u32) -> u32 {
+    pmtu.saturating_sub((IPHDR_LEN + TCP_MIN_HLEN) as u32).max(TCP_MIN_SND_MSS)
+}
+
+impl TcpSocket {
+    /// SYN / SYN-ACK 的选项：MSS、窗口扩大、SACK 允许 (tcp_syn_options)
+    fn tcp_syn_options(&self, opts: &mut [u8; TCP_MAX_OPTLEN]) -> usize {
+        let mut len = 0;
+        opts[0] = TCPOPT_MSS;
+        opts[1] = TCPOLEN_MSS;
+        opts[2..4].copy_from_slice(&(TCP_MSS as u16).to_be_bytes());
+        len += 4;
+        if self.wscale_ok {
+            opts[len..len + 4].copy_from_slice(&[TCPOPT_NOP, TCPOPT_WINDOW, TCPOLEN_WINDOW, self.rcv_wscale]);
+            len += 4;
+        }
+        if self.sack_ok {
+            opts[len..len + 4].copy_from_slice(&[TCPOPT_NOP, TCPOPT_NOP, TCPOPT_SACK_PERM, TCPOLEN_SACK_PERM]);
+            len += 4;
+        }
+        len
+    }
+
+    /// 已建立连接的选项：有乱序数据时附上 SACK 块 (tcp_established_options)
+    ///
+    /// 包含最近一个乱序报文段的块放在首位，其余按序列号排列 (RFC 2018)
+    fn tcp_established_options(&self, opts: &mut [u8; TCP_MAX_OPTLEN]) -> usize {
+        if !self.sack_ok || self.ofo.is_empty() {
+            return 0;
+        }
+        let first = self
+            .ofo
+            .iter()
+            .position(|&(s, e)| !after(s, self.ofo_last) && after(e, self.ofo_last))
+            .unwrap_or(0);
+        let blocks = core::cmp::min(self.ofo.len(), TCP_NUM_SACKS);
+        opts[0] = TCPOPT_NOP;
+        opts[1] = TCPOPT_NOP;
+        opts[2] = TCPOPT_SACK;
+        opts[3] = TCPOLEN_SACK_BASE + TCPOLEN_SACK_PERBLOCK * blocks as u8;
+        let mut len = 4;
+        let order = core::iter::once(first).chain((0..self.ofo.len()).filter(|&i| i != first));
+        for i in order.take(blocks) {
+            let (start, end) = self.ofo[i];
+            opts[len..len + 4].copy_from_slice(&start.to_be_bytes());
+            opts[len + 4..len + 8].copy_from_slice(&end.to_be_bytes());
+            len += 8;
+        }
+        len
+    }
+
+    /// 选择通告窗口，并记录通告的右边界 (tcp_select_window)
+    ///
+    /// 右边界等于第一个未读字节的序列号加上缓冲区容量，只随应用读取向右移动，窗口不会收缩
+    fn tcp_select_window(&mut self, syn: bool) -> u16 {
+        let space = self.recv_buf.free_space() as u32;
+        let win = if syn {
+            // SYN 中的窗口不缩放
+            core::cmp::min(space, TCP_MAX_WINDOW as u32)
+        } else {
+            core::cmp::min(space >> self.rcv_wscale, TCP_MAX_WINDOW as u32)
+        };
+        let scaled = if syn { win } else { win << self.rcv_wscale };
+        self.rcv_wnd_edge = self.rcv_nxt.wrapping_add(scaled);
+        win as u16
+    }
+
+    /// 组装一个报文段并交给 IP 层 (tcp_transmit_skb)
+    ///
+    /// # 参数
+    /// - `seq`: 序列号
+    /// - `flags`: 标志位
+    /// - `offset`: 数据在发送缓冲区中的偏移（相对 snd_una）
+    /// - `len`: 数据长度；超过 MSS 时作为超长包由设备或 GSO 切分
+    pub(crate) fn tcp_transmit_skb(&mut self, seq: TcpSeq, flags: u8, offset: usize, len: usize) -> Result<(), ()> {
+        let mut opts = [0u8; TCP_MAX_OPTLEN];
+        let opts_len = if flags & TCPHDR_SYN != 0 {
+            self.tcp_syn_options(&mut opts)
+        } else if len == 0 {
+            // SACK 块只放在不带数据的 ACK 上，数据报文段的长度不受选项影响
+            self.tcp_established_options(&mut opts)
+        } else {
+            0
+        };
+        let ack_seq = if flags & TCPHDR_ACK != 0 { self.rcv_nxt } else { 0 };
+        let window = self.tcp_select_window(flags & TCPHDR_SYN != 0);
+        let mss = self.mss as usize;
+
+        // 超过一个 MSS 的数据放在页片段中，线性区只放协议头
+        let paged = len > mss;
+        let mut skb = tcp_alloc_skb(if paged { 0 } else { len })?;
+        let (first, second) = self.send_buf.slices(offset, len);
+        let built = if paged {
+            skb.skb_append_pagefrags(first).and_then(|()| skb.skb_append_pagefrags(second))
+        } else {
+            skb.skb_put_data(first).and_then(|()| skb.skb_put_data(second))
+        }
+        .and_then(|()| {
+            tcp_build_header(&mut skb, self.local_port, self.remote_port, seq, ack_seq, flags, window, &opts[..opts_len])
+        });
+        if built.is_err() || first.len() + second.len() != len {
+            skb.free();
+            return Err(());
+        }
+        if paged {
+            skb.gso_size = mss as u16;
+            skb.gso_type = SKB_GSO_TCPV4;
+        }
+
+        // 任何带 ACK 的报文段都确认了已收到的数据
+        if flags & TCPHDR_ACK != 0 {
+            self.ack_pending = 0;
+            self.delack_deadline = 0;
+        }
+        self.stats.segs_out += core::cmp::max(1, (len + mss - 1) / mss) as u64;
+        crate::net::ipv4::ipv4_send(skb, self.remote_ip, 6) // IPPROTO_TCP = 6
+    }
+
+    /// 发送不带数据的 ACK (tcp_send_ack)
+    pub(crate) fn tcp_send_ack(&mut self) -> Result<(), ()> {
+        if self.state == TcpState::TCP_CLOSE {
+            return Ok(());
+        }
+        self.tcp_transmit_skb(self.snd_nxt, TCPHDR_ACK, 0, 0)
+    }
+
+    /// 向对端发送 RST，中止连接 (tcp_send_active_reset)
+    pub(crate) fn tcp_send_active_reset(&mut self) -> Result<(), ()> {
+        self.tcp_transmit_skb(self.snd_nxt, TCPHDR_RST | TCPHDR_ACK, 0, 0)
+    }
+
+    /// 发送零窗口探测：序列号为 snd_una - 1，对端必然回复带有当前窗口的 ACK (tcp_xmit_probe_skb)
+    pub(crate) fn tcp_send_probe(&mut self) -> Result<(), ()> {
+        self.tcp_transmit_skb(self.snd_una.wrapping_sub(1), TCPHDR_ACK, 0, 0)
+    }
+
+    /// 重传 [seq, seq + len) 的数据；区间到达 FIN 时一起重传 FIN (tcp_retransmit_skb)
+    pub(crate) fn tcp_retransmit_range(&mut self, seq: TcpSeq, len: u32) -> Result<(), ()> {
+        let offset = seq.wrapping_sub(self.snd_una) as usize;
+        let data_len = core::cmp::min(len as usize, self.send_buf.len().saturating_sub(offset));
+        let mut flags = TCPHDR_ACK;
+        if self.fin_sent && offset + data_len == self.send_buf.len() {
+            flags |= TCPHDR_FIN;
+        }
+        if data_len == 0 && flags & TCPHDR_FIN == 0 {
+            return Ok(());
+        }
+        if data_len > 0 {
+            flags |= TCPHDR_PSH;
+            self.tcp_rate_skb_retrans(seq, data_len as u32);
+        }
+        self.stats.retrans_segs += 1;
+        self.tcp_transmit_skb(seq, flags, offset, data_len)
+    }
+
+    /// 按记分板重传判定为丢失的数据，受拥塞窗口限制 (tcp_xmit_retransmit_queue)
+    pub(crate) fn tcp_xmit_retransmit_queue(&mut self) {
+        if self.ca_state == TcpCaState::Open {
+            return;
+        }
+        let cwnd_bytes = self.snd_cwnd.saturating_mul(self.mss);
+        while self.tcp_bytes_in_flight() < cwnd_bytes {
+            let (seq, len) = match self.tcp_next_hole() {
+                Some(hole) => hole,
+                None => break,
+            };
+            if self.tcp_retransmit_range(seq, len).is_err() {
+                break;
+            }
+            // 空洞中 FIN 只占一个序列号
+            self.high_rxt = seq.wrapping_add(core::cmp::max(len, 1));
+        }
+    }
+
+    /// 一个超长包最多包含的报文段数 (tcp_tso_segs / tcp_tso_autosize)
+    ///
+    /// pacing 时限制为一个 jiffy 内按速率可发的数据量，至少两个报文段
+    pub(crate) fn tcp_tso_segs(&self) -> u32 {
+        let max_segs = (TCP_GSO_MAX_SIZE / self.mss as usize) as u32;
+        if self.pacing_rate == 0 {
+            return max_segs;
+        }
+        let segs = self.pacing_rate / HZ / self.mss as u64;
+        (segs as u32).clamp(2, max_segs.max(2))
+    }
+
+    /// pacing 是否要求推迟本次发送；需要推迟时设置 pacing 定时器
+    fn tcp_pacing_check(&mut self, now_us: u64) -> bool {
+        if self.pacing_rate == 0 || now_us >= self.pacing_next_us {
+            return false;
+        }
+        let wait_us = self.pacing_next_us - now_us;
+        let ticks = core::cmp::max(1, (wait_us * HZ + 999_999) / 1_000_000);
+        self.pacing_deadline = get_jiffies() + ticks;
+        true
+    }
+
+    /// 已发出的小报文段是否还未被确认 (tcp_minshall_check)
+    #[inline]
+    fn tcp_minshall_check(&self) -> bool {
+        after(self.snd_sml, self.snd_una) && !after(self.snd_sml, self.snd_nxt)
+    }
+
+    /// 末尾不足一个 MSS 的零头是否要推迟 (tcp_nagle_check)
+    ///
+    /// # 参数
+    /// - `push`: 不受 Nagle 与 cork 限制 (TCP_NAGLE_PUSH)
+    fn tcp_nagle_check(&self, push: bool) -> bool {
+        if push || self.fin_queued {
+            return false;
+        }
+        self.cork || self.msg_more || (!self.nodelay && self.tcp_minshall_check())
+    }
+
+    /// 设置 TCP_NODELAY；打开时立即发出推迟的零头 (__tcp_sock_set_nodelay)
+    pub fn tcp_set_nodelay(&mut self, on: bool) {
+        self.nodelay = on;
+        if on {
+            self.tcp_push_pending_frames(true);
+        }
+    }
+
+    /// 设置 TCP_CORK；取消时按 Nagle 发出剩余数据，TCP_NODELAY 下立即发出 (__tcp_sock_set_cork)
+    pub fn tcp_set_cork(&mut self, on: bool) {
+        self.cork = on;
+        if !on {
+            self.tcp_push_pending_frames(self.nodelay);
+        }
+    }
+
+    /// 按路径 MTU 限制 MSS，只会减小 (tcp_sync_mss)
+    ///
+    /// # 返回
+    /// MSS 是否减小
+    pub(crate) fn tcp_sync_mss(&mut self, pmtu: u32) -> bool {
+        let mss = tcp_mtu_to_mss(pmtu);
+        if mss >= self.mss {
+            return false;
+        }
+        self.mss = mss;
+        true
+    }
+
+    /// MSS 减小后重传在途数据 (tcp_simple_retransmit)
+    ///
+    /// 带 DF 的旧报文段已被路由器丢弃，这不是拥塞信号：进入 Loss 但不减小拥塞窗口，
+    /// 按新的 MSS 从 snd_una 开始重传
+    pub(crate) fn tcp_simple_retransmit(&mut self) {
+        if self.snd_una == self.snd_nxt {
+            return;
+        }
+        if self.ca_state != TcpCaState::Loss {
+            self.high_seq = self.snd_nxt;
+            self.tcp_set_ca_state(TcpCaState::Loss);
+        }
+        self.high_rxt = self.snd_una;
+        self.tcp_xmit_retransmit_queue();
+    }
+
+    /// 在拥塞窗口和对端窗口允许的范围内发送新数据 (tcp_write_xmit)
+    ///
+    /// 每次尽量发出 MSS 整数倍的超长包；数据发完且应用已关闭时发送 FIN
+    pub(crate) fn tcp_write_xmit(&mut self) {
+        self.tcp_push_pending_frames(false);
+    }
+
+    /// 同 tcp_write_xmit，`push` 为 true 时末尾的零头也立即发出 (__tcp_push_pending_frames)
+    pub(crate) fn tcp_push_pending_frames(&mut self, push: bool) {
+        match self.state {
+            TcpState::TCP_ESTABLISHED | TcpState::TCP_CLOSE_WAIT | TcpState::TCP_FIN_WAIT1
+            | TcpState::TCP_LAST_ACK | TcpState::TCP_CLOSING => {}
+            _ => return,
+        }
+        // 丢失的数据优先于新数据
+        self.tcp_xmit_retransmit_queue();
+
+        let mss = self.mss as usize;
+        let now = get_jiffies();
+        let now_us = tcp_clock_us();
+        while !self.fin_sent {
+            let sent = self.snd_nxt.wrapping_sub(self.snd_una) as usize;
+            let unsent = self.send_buf.len().saturating_sub(sent);
+            let in_flight = self.tcp_bytes_in_flight() as usize;
+            let cwnd_quota = (self.snd_cwnd as usize * mss).saturating_sub(in_flight);
+            let wnd_quota = (self.snd_wnd as usize).saturating_sub(sent);
+
+            if unsent == 0 {
+                self.tcp_rate_check_app_limited();
+                // 数据都已发出：发送 FIN
+                if self.fin_queued && self.tcp_transmit_skb(self.snd_nxt, TCPHDR_FIN | TCPHDR_ACK, sent, 0).is_ok() {
+                    self.fin_sent = true;
+                    self.snd_nxt = self.snd_nxt.wrapping_add(1);
+                    if self.retransmit_deadline == 0 {
+                        self.tcp_reset_xmit_timer();
+                    }
+                }
+                break;
+            }
+            if cwnd_quota == 0 || wnd_quota == 0 {
+                // 对端窗口为 0 且没有在途数据时，由探测定时器等待窗口打开
+                if wnd_quota == 0 && sent == 0 && self.retransmit_deadline == 0 {
+                    self.tcp_reset_xmit_timer();
+                }
+                break;
+            }
+
+            if self.tcp_pacing_check(now_us) {
+                break;
+            }
+
+            let mut len = core::cmp::min(unsent, core::cmp::min(cwnd_quota, wnd_quota));
+            len = core::cmp::min(len, self.tcp_tso_segs() as usize * mss);
+            // 避免糊涂窗口：能发满一个 MSS 时不发零头，零头留到数据的末尾；
+            // 末尾的零头再由 Nagle、cork 与 MSG_MORE 决定是否等待后续写入
+            let hold_tail = len == unsent && len % mss != 0 && self.tcp_nagle_check(push);
+            if len > mss && (len < unsent || hold_tail) {
+                len -= len % mss;
+            } else if len < mss && ((len < unsent && in_flight > 0) || hold_tail) {
+                // 没有在途数据时没有 ACK 推动发送，由 cork 定时器最迟发出
+                if hold_tail && in_flight == 0 && self.cork_deadline == 0 {
+                    self.cork_deadline = now + TCP_CORK_MAX;
+                }
+                break;
+            }
+
+            let last = len == unsent;
+            let flags = if last { TCPHDR_ACK | TCPHDR_PSH } else { TCPHDR_ACK };
+            if sent == 0 {
+                // 空闲后重新开始发送
+                self.tcp_ca_event(TcpCaEvent::TxStart);
+            }
+            if self.tcp_transmit_skb(self.snd_nxt, flags, sent, len).is_err() {
+                break;
+            }
+            self.lsndtime = now;
+            self.tcp_rate_skb_sent(self.snd_nxt.wrapping_add(len as u32), now_us, in_flight as u32);
+            if self.pacing_rate > 0 {
+                let gap = len as u64 * 1_000_000 / self.pacing_rate;
+                self.pacing_next_us = core::cmp::max(self.pacing_next_us, now_us) + gap;
+            }
+            // 对新数据计时，测得的 RTT 用于更新 RTO
+            if self.rtt_start == 0 {
+                self.rtt_start = now.max(1);
+                self.rtt_seq = self.snd_nxt.wrapping_add(len as u32);
+            }
+            self.snd_nxt = self.snd_nxt.wrapping_add(len as u32);
+            if len % mss != 0 {
+                self.snd_sml = self.snd_nxt;
+            }
+            if self.retransmit_deadline == 0 {
+                self.tcp_reset_xmit_timer();
+            }
+        }
+        // 数据都已发出，不再需要 cork 定时器
+        if self.snd_nxt.wrapping_sub(self.snd_una) as usize >= self.send_buf.len() {
+            self.cork_deadline = 0;
+        }
+    }
+
+    /// 应用读走数据后，窗口增大足够多时立即通告 (tcp_cleanup_rbuf)
+    pub(crate) fn tcp_cleanup_rbuf(&mut self) {
+        if self.state == TcpState::TCP_CLOSE {
+            return;
+        }
+        let space = (((self.recv_buf.free_space() as u32) >> self.rcv_wscale) << self.rcv_wscale)
+            .min((TCP_MAX_WINDOW as u32) << self.rcv_wscale);
+        let new_edge = self.rcv_nxt.wrapping_add(space);
+        if after(new_edge, self.rcv_wnd_edge)
+            && new_edge.wrapping_sub(self.rcv_wnd_edge) >= 2 * self.mss
+        {
+            let _ = self.tcp_send_ack();
+        }
+    }
+}
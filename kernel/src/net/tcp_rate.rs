@@ -0,0 +1,242 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! TCP 交付速率采样
+//!
+//! 每次发送新数据时记下当时已交付的字节数与时间，数据被确认（累计确认或 SACK）时
+//! 用两次快照之差估计这段时间内的交付速率，并得到一个 RTT 样本。
+//! BBR 用这些样本估计瓶颈带宽，其他算法只用其中的 RTT。
+//!
+//! 参考: net/ipv4/tcp_rate.c, draft-cheng-iccrg-delivery-rate-estimation
+//!
+//! # 设计
+//! - 发送缓冲区中不保留 SkBuff，快照按发送顺序单独记录，每条对应一次新数据发送
+//! - 被重传过的数据不参与采样，无法区分确认的是哪一次发送
+//! - 应用没有数据可发时标记 app_limited，此期间的样本不代表网络的能力
+
+use alloc::collections::VecDeque;
+
+use crate::net::tcp::{after, before, TcpSeq, TcpSocket};
+
+/// 最多保留的发送快照数，超过后新的发送不再记录
+const TCP_RATE_MAX_RECORDS: usize = 256;
+
+/// 一次新数据发送时的快照 (tcp_skb_cb::tx)
+#[derive(Debug, Clone, Copy)]
+struct TcpTxRecord {
+    /// 这次发送的数据的结束序列号
+    end_seq: TcpSeq,
+    /// 发送时间（微秒）
+    tx_us: u64,
+    /// 发送时已交付的字节数
+    delivered: u64,
+    /// 发送时最近一次交付的时间
+    delivered_us: u64,
+    /// 发送时当前采样区间内第一次发送的时间
+    first_tx_us: u64,
+    /// 发送时处于 app_limited
+    app_limited: bool,
+    /// 已被重传
+    retrans: bool,
+}
+
+/// 连接上的交付速率状态
+#[derive(Debug)]
+pub struct TcpRateState {
+    /// 已交付（累计确认或 SACK）的总字节数 (tp->delivered)
+    pub delivered: u64,
+    /// 最近一次交付的时间（微秒） (tp->delivered_mstamp)
+    pub delivered_us: u64,
+    /// 当前采样区间内第一次发送的时间 (tp->first_tx_mstamp)
+    pub first_tx_us: u64,
+    /// app_limited 区间结束时的 delivered，0 表示不受应用限制 (tp->app_limited)
+    pub app_limited: u64,
+    /// 处理当前确认之前的在途字节数
+    pub prior_in_flight: u32,
+    /// 最小 RTT（微秒），没有样本为 u32::MAX (tcp_min_rtt)
+    pub min_rtt_us: u32,
+    /// 最小 RTT 的取样时间（微秒）
+    min_rtt_stamp: u64,
+    records: VecDeque<TcpTxRecord>,
+}
+
+/// 一个确认产生的速率样本 (rate_sample)
+#[derive(Debug, Clone, Copy)]
+pub struct TcpRateSample {
+    /// 被采样的数据发送时已交付的字节数
+    pub prior_delivered: u64,
+    /// 采样区间内交付的字节数
+    pub delivered: u64,
+    /// 采样区间长度（微秒），0 表示本次没有有效的速率样本
+    pub interval_us: u64,
+    /// RTT 样本（微秒），没有样本为 -1
+    pub rtt_us: i64,
+    /// 本次确认新交付的字节数
+    pub acked_sacked: u32,
+    /// 处理本次确认之前的在途字节数
+    pub prior_in_flight: u32,
+    /// 样本受应用发送速度限制
+    pub is_app_limited: bool,
+}
+
+/// 最小 RTT 的有效期（微秒） (tcp_min_rtt_wlen, 300s)
+const TCP_MIN_RTT_WLEN_US: u64 = 300 * 1_000_000;
+
+impl TcpRateState {
+    /// 创建空的速率状态
+    pub const fn new() -> Self {
+        Self {
+            delivered: 0,
+            delivered_us: 0,
+            first_tx_us: 0,
+            app_limited: 0,
+            prior_in_flight: 0,
+            min_rtt_us: u32::MAX,
+            min_rtt_stamp: 0,
+            records: VecDeque::new(),
+        }
+    }
+}
+
+impl TcpRateSample {
+    /// 样本的交付速率（字节/秒）
+    pub fn rate(&self) -> u64 {
+        if self.interval_us == 0 {
+            0
+        } else {
+            self.delivered * 1_000_000 / self.interval_us
+        }
+    }
+}
+
+impl TcpSocket {
+    /// 记录一次新数据发送 (tcp_rate_skb_sent)
+    ///
+    /// # 参数
+    /// - `end_seq`: 发送的数据的结束序列号
+    /// - `now_us`: 当前时间（微秒）
+    /// - `in_flight`: 发送前的在途字节数
+    pub(crate) fn tcp_rate_skb_sent(&mut self, end_seq: TcpSeq, now_us: u64, in_flight: u32) {
+        let rate = &mut self.rate;
+        // 空闲后的第一次发送开始新的采样区间，不把空闲时间算进去
+        if in_flight == 0 {
+            rate.first_tx_us = now_us;
+            rate.delivered_us = now_us;
+        }
+        if rate.records.len() >= TCP_RATE_MAX_RECORDS {
+            return;
+        }
+        rate.records.push_back(TcpTxRecord {
+            end_seq,
+            tx_us: now_us,
+            delivered: rate.delivered,
+            delivered_us: rate.delivered_us,
+            first_tx_us: rate.first_tx_us,
+            app_limited: rate.app_limited != 0,
+            retrans: false,
+        });
+    }
+
+    /// 重传了 [seq, seq + len)，覆盖这段数据的快照不再用于采样
+    pub(crate) fn tcp_rate_skb_retrans(&mut self, seq: TcpSeq, len: u32) {
+        let end = seq.wrapping_add(len);
+        let mut start = self.snd_una;
+        for rec in self.rate.records.iter_mut() {
+            if after(rec.end_seq, seq) && after(end, start) {
+                rec.retrans = true;
+            }
+            start = rec.end_seq;
+        }
+    }
+
+    /// 数据是否已交付（累计确认或落在 SACK 块中）
+    fn tcp_rate_delivered(&self, end_seq: TcpSeq) -> bool {
+        let last = end_seq.wrapping_sub(1);
+        !after(end_seq, self.snd_una) || self.sacked.iter().any(|&(s, e)| !before(last, s) && before(last, e))
+    }
+
+    /// 处理完一个确认后生成速率样本 (tcp_rate_gen)
+    ///
+    /// # 参数
+    /// - `newly_delivered`: 本次确认新交付的字节数
+    /// - `now_us`: 当前时间（微秒）
+    pub(crate) fn tcp_rate_gen(&mut self, newly_delivered: u32, now_us: u64) -> TcpRateSample {
+        let mut rs = TcpRateSample {
+            prior_delivered: 0,
+            delivered: 0,
+            interval_us: 0,
+            rtt_us: -1,
+            acked_sacked: newly_delivered,
+            prior_in_flight: self.rate.prior_in_flight,
+            is_app_limited: false,
+        };
+        if newly_delivered == 0 {
+            return rs;
+        }
+        self.rate.delivered += newly_delivered as u64;
+        self.rate.delivered_us = now_us;
+
+        // 在本次交付的数据中选最后发出的一次作为样本 (tcp_rate_skb_delivered)
+        let mut sample: Option<TcpTxRecord> = None;
+        let mut idx = 0;
+        while idx < self.rate.records.len() {
+            let rec = self.rate.records[idx];
+            if self.tcp_rate_delivered(rec.end_seq) {
+                if !rec.retrans && sample.map_or(true, |s| rec.tx_us >= s.tx_us) {
+                    sample = Some(rec);
+                }
+                // 已交付的快照只用一次
+                self.rate.records.remove(idx);
+            } else {
+                idx += 1;
+            }
+        }
+
+        // 应用限制的区间在标记的数据交付后结束
+        if self.rate.app_limited != 0 && self.rate.delivered > self.rate.app_limited {
+            self.rate.app_limited = 0;
+        }
+
+        let rec = match sample {
+            Some(rec) => rec,
+            None => return rs,
+        };
+        // 下一个采样区间从这次发送开始
+        self.rate.first_tx_us = rec.tx_us;
+
+        rs.prior_delivered = rec.delivered;
+        rs.delivered = self.rate.delivered - rec.delivered;
+        rs.is_app_limited = rec.app_limited;
+        rs.rtt_us = now_us.saturating_sub(rec.tx_us) as i64;
+        let rtt = core::cmp::min(rs.rtt_us as u64, u32::MAX as u64 - 1) as u32;
+        if rtt <= self.rate.min_rtt_us || now_us.saturating_sub(self.rate.min_rtt_stamp) > TCP_MIN_RTT_WLEN_US {
+            self.rate.min_rtt_us = rtt;
+            self.rate.min_rtt_stamp = now_us;
+        }
+        // 发送与确认两段间隔取较大者，避免确认被压缩时高估速率
+        let send_us = rec.tx_us.saturating_sub(rec.first_tx_us);
+        let ack_us = now_us.saturating_sub(rec.delivered_us);
+        rs.interval_us = core::cmp::max(send_us, ack_us);
+        // 比最小 RTT 还短的区间不可信 (tcp_rate_gen)
+        if rs.interval_us < self.rate.min_rtt_us as u64 {
+            rs.interval_us = 0;
+        }
+        rs
+    }
+
+    /// 应用没有更多数据可发时标记 app_limited (tcp_rate_check_app_limited)
+    pub(crate) fn tcp_rate_check_app_limited(&mut self) {
+        let sent = self.snd_nxt.wrapping_sub(self.snd_una) as usize;
+        let unsent = self.send_buf.len().saturating_sub(sent);
+        let in_flight = self.tcp_bytes_in_flight();
+        if unsent < self.mss as usize && in_flight < self.snd_cwnd.saturating_mul(self.mss) {
+            self.rate.app_limited = core::cmp::max(self.rate.delivered + in_flight as u64, 1);
+        }
+    }
+
+    /// 丢弃所有发送快照（重传超时后记分板作废时）
+    pub(crate) fn tcp_rate_reset(&mut self) {
+        self.rate.records.clear();
+    }
+}
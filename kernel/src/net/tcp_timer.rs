@@ -0,0 +1,191 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! TCP 定时器
+//!
+//! 重传、零窗口探测、延迟 ACK、cork 与 TIME_WAIT 都记为 socket 上的到期时刻（jiffies），
+//! 由时钟中断中的 tcp_timer_tick 统一检查；RTO 按 RFC 6298 由 RTT 样本计算。
+//!
+//! 参考: net/ipv4/tcp_timer.c, net/ipv4/tcp_input.c (tcp_rtt_estimator)
+
+use crate::drivers::timer::{get_jiffies, read_time, CLOCK_FREQ, HZ};
+use crate::net::tcp::{for_each_tcp_socket, with_tcp_lock, TcpCaState, TcpSocket, TcpState};
+
+/// RTO 下限 (TCP_RTO_MIN, 200ms)
+pub const TCP_RTO_MIN: u64 = HZ / 5;
+
+/// RTO 上限 (TCP_RTO_MAX, 120s)
+pub const TCP_RTO_MAX: u64 = 120 * HZ;
+
+/// 没有 RTT 样本时的初始 RTO (TCP_TIMEOUT_INIT, 1s)
+pub const TCP_TIMEOUT_INIT: u64 = HZ;
+
+/// 延迟 ACK 的最长等待 (TCP_DELACK_MIN, 40ms)
+pub const TCP_DELACK_MIN: u64 = HZ / 25;
+
+/// TIME_WAIT 持续时间 (TCP_TIMEWAIT_LEN, 60s)
+pub const TCP_TIMEWAIT_LEN: u64 = 60 * HZ;
+
+/// 连续超时重传的上限，超过后放弃连接 (tcp_retries2)
+pub const TCP_RETRIES2: u32 = 15;
+
+/// 握手报文的重传上限 (tcp_syn_retries)
+pub const TCP_SYN_RETRIES: u32 = 6;
+
+/// 微秒级时钟，用于交付速率采样与 pacing (tcp_clock_us)
+#[inline]
+pub fn tcp_clock_us() -> u64 {
+    read_time() / (CLOCK_FREQ / 1_000_000)
+}
+
+impl TcpSocket {
+    /// 用一个 RTT 样本更新平滑 RTT、偏差与 RTO (tcp_rtt_estimator)
+    ///
+    /// # 参数
+    /// - `sample`: RTT 样本（jiffies）
+    pub(crate) fn tcp_rtt_estimator(&mut self, sample: u64) {
+        // 时钟粒度为一个 jiffy，不足一个 jiffy 的样本按一个计
+        let m = core::cmp::max(sample, 1).min(u32::MAX as u64 >> 3) as u32;
+        if self.srtt == 0 {
+            // 第一个样本：SRTT = R，RTTVAR = R / 2
+            self.srtt = m << 3;
+            self.mdev = m << 1;
+        } else {
+            // SRTT = 7/8 SRTT + 1/8 R，RTTVAR = 3/4 RTTVAR + 1/4 |SRTT - R|
+            let err = (m as i64 - (self.srtt >> 3) as i64).unsigned_abs() as u32;
+            self.srtt = self.srtt - (self.srtt >> 3) + m;
+            self.mdev = self.mdev - (self.mdev >> 2) + err;
+        }
+        // RTO = SRTT + 4 * RTTVAR
+        let rto = (self.srtt >> 3) as u64 + self.mdev as u64;
+        self.rto = rto.clamp(TCP_RTO_MIN, TCP_RTO_MAX);
+    }
+
+    /// 当前退避后的超时时长
+    #[inline]
+    pub fn tcp_current_rto(&self) -> u64 {
+        core::cmp::min(self.rto << core::cmp::min(self.backoff, 16), TCP_RTO_MAX)
+    }
+
+    /// 从现在开始重新计时 (inet_csk_reset_xmit_timer)
+    pub(crate) fn tcp_reset_xmit_timer(&mut self) {
+        self.retransmit_deadline = get_jiffies() + self.tcp_current_rto();
+    }
+
+    /// 重传超时 (tcp_retransmit_timer)
+    ///
+    /// 对端窗口为零且没有在途数据时改为发送零窗口探测 (tcp_probe_timer)
+    pub(crate) fn tcp_retransmit_timer(&mut self) {
+        let handshake = matches!(self.state, TcpState::TCP_SYN_SENT | TcpState::TCP_SYN_RECV);
+        let limit = if handshake { TCP_SYN_RETRIES } else { TCP_RETRIES2 };
+        if self.backoff >= limit {
+            self.tcp_done(-110); // ETIMEDOUT
+            return;
+        }
+
+        if self.snd_una == self.snd_nxt && !handshake {
+            // 没有在途数据：零窗口探测
+            let unsent = self.send_buf.len() > 0 || (self.fin_queued && !self.fin_sent);
+            if !unsent {
+                self.retransmit_deadline = 0;
+                return;
+            }
+            self.backoff += 1;
+            let _ = self.tcp_send_probe();
+            self.tcp_reset_xmit_timer();
+            return;
+        }
+
+        self.stats.timeouts += 1;
+        self.backoff += 1;
+        // 超时期间的 RTT 无法区分是哪次发送的确认 (Karn 算法)
+        self.rtt_start = 0;
+
+        match self.state {
+            TcpState::TCP_SYN_SENT => {
+                self.stats.retrans_segs += 1;
+                let _ = self.tcp_transmit_skb(self.snd_una, crate::net::tcp::TCPHDR_SYN, 0, 0);
+            }
+            TcpState::TCP_SYN_RECV => {
+                self.stats.retrans_segs += 1;
+                let _ = self.tcp_transmit_skb(
+                    self.snd_una,
+                    crate::net::tcp::TCPHDR_SYN | crate::net::tcp::TCPHDR_ACK,
+                    0,
+                    0,
+                );
+            }
+            _ => {
+                // 拥塞窗口降为 1，超时前发出的数据中未被 SACK 的全部视为丢失 (tcp_enter_loss)
+                if self.ca_state != TcpCaState::Loss {
+                    self.snd_ssthresh = (self.ca_ops.ssthresh)(self);
+                }
+                self.snd_cwnd = 1;
+                self.snd_cwnd_cnt = 0;
+                self.dup_acks = 0;
+                self.tcp_set_ca_state(TcpCaState::Loss);
+                self.high_seq = self.snd_nxt;
+                self.high_rxt = self.snd_una;
+                // 对端可能已丢弃 SACK 过的数据，记分板与发送快照作废
+                self.sacked.clear();
+                self.tcp_rate_reset();
+
+                let len = core::cmp::min(self.mss, self.snd_nxt.wrapping_sub(self.snd_una));
+                if self.tcp_retransmit_range(self.snd_una, len).is_ok() {
+                    self.high_rxt = self.snd_una.wrapping_add(core::cmp::max(len, 1));
+                }
+            }
+        }
+        self.tcp_reset_xmit_timer();
+    }
+
+    /// 检查并处理已到期的定时器
+    ///
+    /// # 参数
+    /// - `now`: 当前 jiffies
+    pub fn tcp_timers(&mut self, now: u64) {
+        if self.state == TcpState::TCP_CLOSE {
+            return;
+        }
+        if self.timewait_deadline != 0 && now >= self.timewait_deadline {
+            self.tcp_done(0);
+            return;
+        }
+        if self.retransmit_deadline != 0 && now >= self.retransmit_deadline {
+            self.retransmit_deadline = 0;
+            self.tcp_retransmit_timer();
+        }
+        if self.pacing_deadline != 0 && now >= self.pacing_deadline {
+            // pacing 间隔已过，继续发送被推迟的数据
+            self.pacing_deadline = 0;
+            self.tcp_write_xmit();
+        }
+        if self.cork_deadline != 0 && now >= self.cork_deadline {
+            // cork 或 MSG_MORE 推迟的零头到期，不再等待后续写入
+            self.cork_deadline = 0;
+            self.msg_more = false;
+            self.tcp_push_pending_frames(true);
+        }
+        if self.delack_deadline != 0 && now >= self.delack_deadline {
+            // 延迟 ACK 到期 (tcp_delack_timer)
+            self.delack_deadline = 0;
+            if self.ack_pending > 0 {
+                let _ = self.tcp_send_ack();
+            }
+        }
+    }
+}
+
+/// 时钟中断中检查所有连接的定时器 (tcp_write_timer / tcp_delack_timer)
+///
+/// 只由 CPU 0 处理，避免各 CPU 在同一 tick 中争用 TCP 锁
+pub fn tcp_timer_tick() {
+    if crate::arch::cpu_id() != 0 {
+        return;
+    }
+    let now = get_jiffies();
+    with_tcp_lock(|| {
+        for_each_tcp_socket(|socket| socket.tcp_timers(now));
+    });
+}
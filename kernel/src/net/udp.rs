@@ -5,8 +5,25 @@
 //! UDP 协议
 //!
 //! 完全...
-
-use crate::net::buffer::SkBuff;
+//!
+//! # 批量收发
+//! - 每个 socket 有接收队列，按 sk_rcvbuf 限制排队的字节数，超出时丢弃；
+//!   队列中保存 SkBuff，本机发给本机的数据报由回环快速路径整个挂入，不复制
+//! - udp_sendmsg 从多段缓冲区直接拼成一个包；带 UDP_SEGMENT 时一次交给 IP 层的是
+//!   按 gso_size 切分的超长包，到设备层再切成各个数据报 (UDP GSO)
+//! - sendmmsg / recvmmsg 在系统调用层循环调用 udp_sendmsg / udp_recvmsg
+//! - 超过路径 MTU 的数据报（最大 UDP_MAX_DATAGRAM）由 IP 层分片发送，收到的分片
+//!   重组后再交给 udp_rcv；GSO 的 gso_size 必须使每个数据报装进路径 MTU
+
+use alloc::collections::VecDeque;
+use alloc::vec::Vec;
+use spin::Mutex;
+
+use crate::net::buffer::{SkBuff, CHECKSUM_UNNECESSARY, SKB_GSO_UDP_L4};
+use crate::net::busy_poll::SO_BUSY_POLL;
+use crate::net::tcp::SOL_SOCKET;
+use crate::net::ipv4::IPHDR_LEN;
+use crate::net::inet_hashtables::{inet_lookup_bound, InetBindKey, InetHashTable, INADDR_ANY};
 use crate::net::ipv4::{route, checksum};
 use crate::config::UDP_SOCKET_TABLE_SIZE;
 
@@ -19,6 +36,24 @@ pub const UDP_MAX_DATAGRAM: usize = 65507;
 /// UDP 端口号
 pub type UdpPort = u16;
 
+/// UDP 选项层级 (SOL_UDP)
+pub const SOL_UDP: i32 = 17;
+
+/// 设置 UDP GSO 的分段大小 (UDP_SEGMENT)
+pub const UDP_SEGMENT: i32 = 103;
+
+/// 一个 GSO 包最多切成的数据报数 (UDP_MAX_SEGMENTS)
+pub const UDP_MAX_SEGMENTS: usize = 64;
+
+/// 默认接收缓冲区大小（字节） (SK_RMEM_MAX)
+pub const UDP_RCVBUF_DEFAULT: usize = 212992;
+
+/// 协议头预留空间：以太网 + IP + UDP
+const MAX_UDP_HEADER: u32 = 64;
+
+/// 自动绑定使用的临时端口范围 (ip_local_port_range)
+const UDP_EPHEMERAL_PORTS: core::ops::RangeInclusive<UdpPort> = 32768..=60999;
+
 /// UDP 头部
 ///
 #[repr(C)]
@@ -82,6 +117,72 @@ pub struct UdpSocket {
     pub bound: bool,
     /// 是否已连接
     pub connected: bool,
+    /// 接收队列 (sk_receive_queue)
+    pub rcv_queue: VecDeque<UdpDatagram>,
+    /// 接收队列中数据的字节数 (sk_rmem_alloc)
+    pub rmem_alloc: usize,
+    /// 接收缓冲区上限 (sk_rcvbuf)
+    pub rcvbuf: usize,
+    /// UDP_SEGMENT 设置的分段大小，0 表示不分段 (udp_sock.gso_size)
+    pub gso_size: u16,
+    /// 接收队列为空时忙轮询的微秒数 (SO_BUSY_POLL, sk_ll_usec)
+    pub busy_poll_usecs: u32,
+}
+
+/// 接收队列中的数据报
+pub struct UdpDatagram {
+    /// 源地址（主机字节序）
+    pub saddr: u32,
+    /// 源端口
+    pub sport: UdpPort,
+    /// 数据，data 指向 UDP 载荷
+    skb: SkBuff,
+}
+
+impl UdpDatagram {
+    /// 载荷长度
+    pub fn len(&self) -> usize {
+        self.skb.len as usize
+    }
+
+    /// 从 offset 开始复制到 buf
+    ///
+    /// # 返回
+    /// 复制的字节数
+    pub fn copy_to(&self, offset: usize, buf: &mut [u8]) -> usize {
+        let n = core::cmp::min(buf.len(), self.len().saturating_sub(offset));
+        if n == 0 {
+            return 0;
+        }
+        self.skb.skb_copy_bits(offset as u32, &mut buf[..n], n as u32) as usize
+    }
+
+    /// 复制出全部载荷
+    pub fn to_vec(&self) -> Vec<u8> {
+        let mut data = alloc::vec![0u8; self.len()];
+        self.copy_to(0, &mut data);
+        data
+    }
+
+    /// 释放数据
+    pub fn free(self) {
+        self.skb.free();
+    }
+}
+
+/// UDP 统计 (UDP_MIB_*)
+#[derive(Debug, Default, Clone, Copy)]
+pub struct UdpStats {
+    /// 交给 socket 的数据报 (InDatagrams)
+    pub in_datagrams: u64,
+    /// 发送的数据报，GSO 包按切分后的个数计 (OutDatagrams)
+    pub out_datagrams: u64,
+    /// 目标端口上没有 socket (NoPorts)
+    pub no_ports: u64,
+    /// 长度或校验和错误 (InErrors)
+    pub in_errors: u64,
+    /// 接收缓冲区已满而丢弃 (RcvbufErrors)
+    pub rcvbuf_errors: u64,
 }
 
 impl UdpSocket {
@@ -93,6 +194,11 @@ impl UdpSocket {
             remote_ip: 0,
             bound: false,
             connected: false,
+            rcv_queue: VecDeque::new(),
+            rmem_alloc: 0,
+            rcvbuf: UDP_RCVBUF_DEFAULT,
+            gso_size: 0,
+            busy_poll_usecs: crate::net::busy_poll::busy_read(),
         }
     }
 
@@ -101,7 +207,7 @@ impl UdpSocket {
     /// # 参数
     /// - `port`: 端口号
     pub fn bind(&mut self, port: UdpPort) -> Result<(), ()> {
-        // TODO: 检查端口是否已被占用
+        // 端口冲突由 udp_bind 在哈希表中检查
         self.local_port = port;
         self.bound = true;
         Ok(())
@@ -186,6 +292,47 @@ impl UdpSocketTable {
 /// 全局 UDP Socket 表
 static mut UDP_SOCKET_TABLE: UdpSocketTable = UdpSocketTable::new();
 
+/// 已绑定端口的哈希表，值为文件描述符 (udp_table)
+static UDP_HASH: InetHashTable<InetBindKey, i32> = InetHashTable::new();
+
+/// 保护接收队列与 socket 的释放
+///
+/// 接收路径在 NAPI 的中断上下文中运行，进程上下文持锁时必须关中断
+static UDP_LOCK: Mutex<()> = Mutex::new(());
+
+/// UDP 统计（持有 UDP 锁时修改）
+static mut UDP_STATS: UdpStats = UdpStats {
+    in_datagrams: 0,
+    out_datagrams: 0,
+    no_ports: 0,
+    in_errors: 0,
+    rcvbuf_errors: 0,
+};
+
+/// 在关中断并持有 UDP 锁的状态下执行
+fn with_udp_lock<R>(f: impl FnOnce() -> R) -> R {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let _guard = UDP_LOCK.lock();
+    f()
+}
+
+/// 读取 UDP 统计
+pub fn udp_stats() -> UdpStats {
+    with_udp_lock(|| unsafe { UDP_STATS })
+}
+
+/// 查找接收目标地址与端口上数据报的 socket (__udp4_lib_lookup)
+///
+/// # 参数
+/// - `daddr`: 目标地址（主机字节序）
+/// - `dport`: 目标端口
+///
+/// # 返回
+/// 返回 Socket 文件描述符
+pub fn udp_v4_lookup(daddr: u32, dport: UdpPort) -> Option<i32> {
+    inet_lookup_bound(&UDP_HASH, daddr, dport)
+}
+
 /// 分配 UDP Socket
 ///
 /// # 返回
@@ -204,8 +351,21 @@ pub fn udp_socket_alloc() -> Result<i32, i32> {
 /// # 参数
 /// - `fd`: Socket 文件描述符
 pub fn udp_socket_free(fd: i32) {
-    unsafe {
+    let queue = with_udp_lock(|| unsafe {
+        let queue = match UDP_SOCKET_TABLE.get_mut(fd as usize) {
+            Some(socket) => {
+                if socket.bound {
+                    UDP_HASH.remove(&InetBindKey { addr: INADDR_ANY, port: socket.local_port }, fd);
+                }
+                core::mem::take(&mut socket.rcv_queue)
+            }
+            None => VecDeque::new(),
+        };
         UDP_SOCKET_TABLE.free(fd as usize);
+        queue
+    });
+    for dgram in queue {
+        dgram.free();
     }
 }
 
@@ -229,13 +389,27 @@ pub fn udp_socket_get(fd: i32) -> Option<&'static mut UdpSocket> {
 /// - `port`: 端口号
 ///
 /// # 返回
-/// 成功返回 0，失败返回错误码
+/// 成功返回 0，端口已被占用返回 -EADDRINUSE，失败返回错误码
 pub fn udp_bind(fd: i32, port: UdpPort) -> i32 {
     unsafe {
         if let Some(socket) = UDP_SOCKET_TABLE.get_mut(fd as usize) {
+            if socket.bound {
+                if socket.local_port == port {
+                    return 0;
+                }
+                UDP_HASH.remove(&InetBindKey { addr: INADDR_ANY, port: socket.local_port }, fd);
+                socket.bound = false;
+            }
+            // 检查与插入在同一把桶锁下完成，两个 socket 不会同时绑定成功
+            if !UDP_HASH.insert_unique(InetBindKey { addr: INADDR_ANY, port }, fd) {
+                return -98; // EADDRINUSE
+            }
             match socket.bind(port) {
                 Ok(()) => 0,
-                Err(()) => -5, // EIO
+                Err(()) => {
+                    UDP_HASH.remove(&InetBindKey { addr: INADDR_ANY, port }, fd);
+                    -5 // EIO
+                }
             }
         } else {
             -5 // EBADF
@@ -243,25 +417,173 @@ pub fn udp_bind(fd: i32, port: UdpPort) -> i32 {
     }
 }
 
+/// 未绑定的 socket 第一次发送时绑定一个临时端口 (udp_lib_get_port)
+///
+/// # 返回
+/// 成功返回 0，没有空闲端口返回 -EAGAIN
+fn udp_autobind(fd: i32) -> i32 {
+    // 从随 fd 变化的位置开始找，不同 socket 不必每次从头扫描
+    let span = (*UDP_EPHEMERAL_PORTS.end() - *UDP_EPHEMERAL_PORTS.start()) as u32 + 1;
+    let offset = crate::net::inet_hashtables::jhash_3words(fd as u32, 0, 0, 0) % span;
+    for i in 0..span {
+        let port = *UDP_EPHEMERAL_PORTS.start() + ((offset + i) % span) as UdpPort;
+        if udp_bind(fd, port) == 0 {
+            return 0;
+        }
+    }
+    -11 // EAGAIN
+}
+
+/// 发送 UDP 数据报 (udp_sendmsg)
+///
+/// # 参数
+/// - `fd`: Socket 文件描述符
+/// - `iov`: 数据的各段，拼成一个数据报
+/// - `dest`: 目标地址与端口；None 时使用 connect 的地址
+/// - `gso_size`: 控制消息中的 UDP_SEGMENT；None 时使用 socket 的设置
+///
+/// # 返回
+/// 成功返回发送的字节数，失败返回错误码
+///
+/// # 说明
+/// 分段大小非 0 且数据更长时，整块数据作为一个 GSO 包发送，由设备层切成
+/// gso_size 大小的数据报（最后一个可以更短）
+pub fn udp_sendmsg(fd: i32, iov: &[&[u8]], dest: Option<(u32, UdpPort)>, gso_size: Option<u16>) -> isize {
+    let total: usize = iov.iter().map(|seg| seg.len()).sum();
+
+    let (bound, connected, remote, sock_gso) = match udp_socket_get(fd) {
+        Some(socket) => (socket.bound, socket.connected, (socket.remote_ip, socket.remote_port), socket.gso_size),
+        None => return -9, // EBADF
+    };
+    let (daddr, dport) = match dest {
+        Some(dest) => dest,
+        None if connected => remote,
+        None => return -89, // EDESTADDRREQ
+    };
+    if dport == 0 {
+        return -22; // EINVAL
+    }
+
+    let gso_size = gso_size.unwrap_or(sock_gso) as usize;
+    let gso = gso_size != 0 && total > gso_size;
+    if gso {
+        // 切出的每个数据报带 DF 发送，必须能装进路径 MTU (udp_send_skb)
+        if total > gso_size * UDP_MAX_SEGMENTS || total > UDP_MAX_DATAGRAM
+            || IPHDR_LEN + UDP_HLEN + gso_size > route::ip_dst_mtu(daddr) as usize {
+            return -22; // EINVAL
+        }
+    } else if total > UDP_MAX_DATAGRAM {
+        return -90; // EMSGSIZE
+    }
+
+    if !bound {
+        let ret = udp_autobind(fd);
+        if ret < 0 {
+            return ret as isize;
+        }
+    }
+    let sport = match udp_socket_get(fd) {
+        Some(socket) => socket.local_port,
+        None => return -9, // EBADF
+    };
+
+    // 各段直接复制到包中
+    let mut skb = match SkBuff::alloc(MAX_UDP_HEADER + total as u32) {
+        Some(skb) => skb,
+        None => return -105, // ENOBUFS
+    };
+    if skb.skb_reserve(MAX_UDP_HEADER).is_none() {
+        skb.free();
+        return -105;
+    }
+    for seg in iov.iter().filter(|seg| !seg.is_empty()) {
+        if skb.skb_put_data(seg).is_err() {
+            skb.free();
+            return -105;
+        }
+    }
+    let hdr = match skb.skb_push(UDP_HLEN as u32) {
+        Some(ptr) => ptr,
+        None => {
+            skb.free();
+            return -105;
+        }
+    };
+    unsafe {
+        let udp_hdr = &mut *(hdr as *mut UdpHdr);
+        udp_hdr.source = sport.to_be();
+        udp_hdr.dest = dport.to_be();
+        // GSO 包的长度在切分时按各数据报重写
+        udp_hdr.len = ((UDP_HLEN + total) as u16).to_be();
+        udp_hdr.check = 0;
+    }
+    let segs = if gso {
+        skb.gso_size = gso_size as u16;
+        skb.gso_type = SKB_GSO_UDP_L4;
+        (total + gso_size - 1) / gso_size
+    } else {
+        1
+    };
+
+    // 校验和由 ipv4_send 按 CHECKSUM_PARTIAL 处理
+    match crate::net::ipv4::ipv4_send(skb, daddr, 17) {
+        Ok(()) => {
+            with_udp_lock(|| unsafe { UDP_STATS.out_datagrams += segs as u64 });
+            total as isize
+        }
+        Err(()) => -105, // ENOBUFS
+    }
+}
+
+/// 取出接收队列中的第一个数据报 (udp_recvmsg)
+///
+/// # 返回
+/// 队列为空返回 -EAGAIN；数据报用完后由调用者调用 free 释放
+pub fn udp_recvmsg(fd: i32) -> Result<UdpDatagram, isize> {
+    with_udp_lock(|| unsafe {
+        match UDP_SOCKET_TABLE.get_mut(fd as usize) {
+            Some(socket) => match socket.rcv_queue.pop_front() {
+                Some(dgram) => {
+                    socket.rmem_alloc -= dgram.len();
+                    Ok(dgram)
+                }
+                None => Err(-11), // EAGAIN
+            },
+            None => Err(-9), // EBADF
+        }
+    })
+}
+
+/// 接收队列为空且设置了 SO_BUSY_POLL 时忙轮询网卡，等待数据报到达 (sk_busy_loop)
+///
+/// # 参数
+/// - `nonblock`: 带 MSG_DONTWAIT，只轮询一轮
+pub fn udp_busy_loop(fd: i32, nonblock: bool) {
+    let usecs = with_udp_lock(|| unsafe {
+        UDP_SOCKET_TABLE.get(fd as usize)
+            .filter(|socket| socket.rcv_queue.is_empty())
+            .map_or(0, |socket| socket.busy_poll_usecs)
+    });
+    crate::net::busy_poll::napi_busy_loop(usecs, nonblock, || {
+        with_udp_lock(|| unsafe { UDP_SOCKET_TABLE.get(fd as usize).map_or(true, |socket| !socket.rcv_queue.is_empty()) })
+    });
+}
+
+/// 接收队列中的数据报数
+pub fn udp_rcv_queue_len(fd: i32) -> usize {
+    with_udp_lock(|| unsafe { UDP_SOCKET_TABLE.get(fd as usize).map_or(0, |socket| socket.rcv_queue.len()) })
+}
+
 /// 发送 UDP 数据包
 ///
 /// # 参数
 /// - `fd`: Socket 文件描述符
 /// - `buf`: 数据缓冲区
-/// - `len`: 数据长度
 ///
 /// # 返回
 /// 成功返回发送的字节数，失败返回错误码
 pub fn udp_send(fd: i32, buf: &[u8]) -> isize {
-    // TODO: 实现完整的 UDP 发送逻辑
-    // 1. 查找 Socket
-    // 2. 获取远程地址
-    // 3. 构造 UDP 头部
-    // 4. 构造 IP 头部
-    // 5. 计算校验和
-    // 6. 发送数据包
-
-    buf.len() as isize
+    udp_sendmsg(fd, &[buf], None, None)
 }
 
 /// 接收 UDP 数据包
@@ -272,16 +594,218 @@ pub fn udp_send(fd: i32, buf: &[u8]) -> isize {
 /// - `len`: 缓冲区长度
 ///
 /// # 返回
-/// 成功返回接收的字节数，失败返回错误码
+/// 成功返回接收的字节数（超出缓冲区的部分被丢弃），失败返回错误码
 pub fn udp_recv(fd: i32, buf: &mut [u8], len: usize) -> isize {
-    // TODO: 实现完整的 UDP 接收逻辑
-    // 1. 从队列中获取数据包
-    // 2. 验证 UDP 校验和
-    // 3. 复制数据到缓冲区
-    // 4. 返回接收的字节数
+    match udp_recvmsg(fd) {
+        Ok(dgram) => {
+            let len = core::cmp::min(len, buf.len());
+            let n = dgram.copy_to(0, &mut buf[..len]);
+            dgram.free();
+            n as isize
+        }
+        Err(e) => e,
+    }
+}
+
+/// 设置 UDP 选项 (udp_lib_setsockopt)
+///
+/// # 返回
+/// 成功返回 0；不支持的选项返回 -ENOPROTOOPT，值不合法返回 -EINVAL
+pub fn udp_setsockopt(fd: i32, level: i32, optname: i32, optval: &[u8]) -> i32 {
+    if level == SOL_SOCKET && optname == SO_BUSY_POLL {
+        let usecs = match crate::net::busy_poll::parse_sockopt(optval) {
+            Ok(usecs) => usecs,
+            Err(e) => return e,
+        };
+        return match udp_socket_get(fd) {
+            Some(socket) => {
+                socket.busy_poll_usecs = usecs;
+                0
+            }
+            None => -9, // EBADF
+        };
+    }
+    if level != SOL_UDP || optname != UDP_SEGMENT {
+        return -92; // ENOPROTOOPT
+    }
+    if optval.len() < 4 {
+        return -22; // EINVAL
+    }
+    let val = i32::from_ne_bytes([optval[0], optval[1], optval[2], optval[3]]);
+    if !(0..=u16::MAX as i32).contains(&val) {
+        return -22; // EINVAL
+    }
+    match udp_socket_get(fd) {
+        Some(socket) => {
+            socket.gso_size = val as u16;
+            0
+        }
+        None => -9, // EBADF
+    }
+}
 
-    // 简化实现：暂时返回 0 (无数据)
-    0
+/// 读取 UDP 选项 (udp_lib_getsockopt)
+///
+/// # 返回
+/// 成功返回写入的字节数
+pub fn udp_getsockopt(fd: i32, level: i32, optname: i32, out: &mut [u8]) -> isize {
+    let busy_poll = level == SOL_SOCKET && optname == SO_BUSY_POLL;
+    if !busy_poll && (level != SOL_UDP || optname != UDP_SEGMENT) {
+        return -92; // ENOPROTOOPT
+    }
+    if out.len() < 4 {
+        return -22; // EINVAL
+    }
+    match udp_socket_get(fd) {
+        Some(socket) => {
+            let val = if busy_poll { socket.busy_poll_usecs as i32 } else { socket.gso_size as i32 };
+            out[..4].copy_from_slice(&val.to_ne_bytes());
+            4
+        }
+        None => -9, // EBADF
+    }
+}
+
+/// 把数据报挂到目标 socket 的接收队列 (__udp_queue_rcv_skb)
+///
+/// # 参数
+/// - `skb`: data 指向载荷；没有 socket 或接收缓冲区已满时释放
+fn udp_queue_rcv(daddr: u32, dport: UdpPort, saddr: u32, sport: UdpPort, skb: SkBuff) {
+    let fd = udp_v4_lookup(daddr, dport);
+    let dropped = with_udp_lock(|| unsafe {
+        // TODO: 回复 ICMP 端口不可达
+        let socket = match fd.and_then(|fd| UDP_SOCKET_TABLE.get_mut(fd as usize)) {
+            Some(socket) => socket,
+            None => {
+                UDP_STATS.no_ports += 1;
+                return Some(skb);
+            }
+        };
+        let len = skb.len as usize;
+        if socket.rmem_alloc + len > socket.rcvbuf {
+            UDP_STATS.rcvbuf_errors += 1;
+            return Some(skb);
+        }
+        socket.rmem_alloc += len;
+        socket.rcv_queue.push_back(UdpDatagram { saddr, sport, skb });
+        UDP_STATS.in_datagrams += 1;
+        None
+    });
+    if let Some(skb) = dropped {
+        skb.free();
+    }
+}
+
+/// 接收 UDP 数据报并放入目标 socket 的接收队列 (udp_rcv / __udp4_lib_rcv)
+///
+/// # 参数
+/// - `skb`: 包含 IP 包的 SkBuff，载荷被复制，调用者仍拥有它
+/// - `saddr` / `daddr`: 源、目标地址（主机字节序）
+/// - `offset`: UDP 头部在 skb 中的偏移
+/// - `len`: UDP 头部加数据的长度
+pub fn udp_rcv(skb: &SkBuff, saddr: u32, daddr: u32, offset: u32, len: u32) -> Result<(), ()> {
+    let mut hdr_buf = [0u8; UDP_HLEN];
+    let ulen = if (len as usize) < UDP_HLEN || offset + len > skb.len {
+        0
+    } else {
+        skb.skb_copy_bits(offset, &mut hdr_buf, UDP_HLEN as u32);
+        u16::from_be_bytes([hdr_buf[4], hdr_buf[5]]) as usize
+    };
+    // 长度以 UDP 头部为准，IP 层多出的部分是填充
+    if ulen < UDP_HLEN || ulen > len as usize {
+        with_udp_lock(|| unsafe { UDP_STATS.in_errors += 1 });
+        return Err(());
+    }
+
+    // 载荷复制到新的 SkBuff，复制的同时求和
+    let data_len = (ulen - UDP_HLEN) as u32;
+    let mut copy = SkBuff::alloc(data_len).ok_or(())?;
+    let dst = match copy.skb_put(data_len) {
+        Some(ptr) => unsafe { core::slice::from_raw_parts_mut(ptr, data_len as usize) },
+        None => {
+            copy.free();
+            return Err(());
+        }
+    };
+    let (_, data_sum) = skb.skb_copy_and_csum_bits(offset + UDP_HLEN as u32, dst, data_len, 0);
+
+    // 校验和为 0 表示发送方没有计算
+    let check = u16::from_be_bytes([hdr_buf[6], hdr_buf[7]]);
+    if check != 0 && skb.ip_summed != CHECKSUM_UNNECESSARY {
+        let sum = checksum::csum_tcpudp_nofold(saddr, daddr, ulen as u32, 17);
+        let sum = checksum::csum_partial(&hdr_buf, sum);
+        let sum = checksum::csum_block_add(sum, data_sum, UDP_HLEN);
+        if checksum::csum_fold(sum) != 0 {
+            copy.free();
+            with_udp_lock(|| unsafe { UDP_STATS.in_errors += 1 });
+            return Err(());
+        }
+    }
+
+    let sport = u16::from_be_bytes([hdr_buf[0], hdr_buf[1]]);
+    let dport = u16::from_be_bytes([hdr_buf[2], hdr_buf[3]]);
+    udp_queue_rcv(daddr, dport, saddr, sport, copy);
+    Ok(())
+}
+
+/// 本机发给本机的数据报，整个 SkBuff 挂到接收方队列 (回环快速路径)
+///
+/// # 参数
+/// - `skb`: 从 IP 头部开始、刚由 udp_sendmsg 构造的包，不校验校验和
+///
+/// # 说明
+/// UDP_SEGMENT 的超长包在这里切成各个数据报，接收方看到的与经过网络时相同
+/// (udp_rcv_segment)
+pub fn udp_rcv_local(mut skb: SkBuff) {
+    const HDR_LEN: usize = IPHDR_LEN + UDP_HLEN;
+    let mut hdr = [0u8; HDR_LEN];
+    let valid = skb.skb_headlen() as usize >= HDR_LEN && {
+        skb.skb_copy_bits(0, &mut hdr, HDR_LEN as u32);
+        // udp_sendmsg 构造的 IP 头部没有选项
+        hdr[0] == 0x45
+            && u16::from_be_bytes([hdr[IPHDR_LEN + 4], hdr[IPHDR_LEN + 5]]) as u32 + IPHDR_LEN as u32 == skb.len
+    };
+    if !valid {
+        skb.free();
+        with_udp_lock(|| unsafe { UDP_STATS.in_errors += 1 });
+        return;
+    }
+    let saddr = u32::from_be_bytes([hdr[12], hdr[13], hdr[14], hdr[15]]);
+    let daddr = u32::from_be_bytes([hdr[16], hdr[17], hdr[18], hdr[19]]);
+    let udp = &hdr[IPHDR_LEN..];
+    let sport = u16::from_be_bytes([udp[0], udp[1]]);
+    let dport = u16::from_be_bytes([udp[2], udp[3]]);
+    skb.skb_pull(HDR_LEN as u32);
+
+    let gso_size = skb.gso_size as u32;
+    if skb.gso_type & SKB_GSO_UDP_L4 == 0 || gso_size == 0 || skb.len <= gso_size {
+        skb.gso_size = 0;
+        skb.gso_type = 0;
+        udp_queue_rcv(daddr, dport, saddr, sport, skb);
+        return;
+    }
+
+    let mut offset = 0;
+    while offset < skb.len {
+        let seg_len = core::cmp::min(gso_size, skb.len - offset);
+        let mut seg = match SkBuff::alloc(seg_len) {
+            Some(seg) => seg,
+            None => break,
+        };
+        match seg.skb_put(seg_len) {
+            Some(ptr) => {
+                let dst = unsafe { core::slice::from_raw_parts_mut(ptr, seg_len as usize) };
+                skb.skb_copy_bits(offset, dst, seg_len);
+                udp_queue_rcv(daddr, dport, saddr, sport, seg);
+            }
+            None => {
+                seg.free();
+                break;
+            }
+        }
+        offset += seg_len;
+    }
+    skb.free();
 }
 
 /// 计算 UDP 校验和
@@ -295,45 +819,22 @@ pub fn udp_recv(fd: i32, buf: &mut [u8], len: usize) -> isize {
 /// # 返回
 /// 校验和 (网络字节序)
 pub fn udp_checksum(shdr: u32, dhdr: u32, uhdr: &UdpHdr, data: &[u8]) -> u16 {
-    let mut sum: u32 = 0;
-
     // 伪头部 (12 字节)
-    // 源 IP (4 字节)
-    sum += (shdr >> 16) & 0xFFFF;
-    sum += shdr & 0xFFFF;
-    // 目标 IP (4 字节)
-    sum += (dhdr >> 16) & 0xFFFF;
-    sum += dhdr & 0xFFFF;
-    // 保留 (1 字节) + 协议 (1 字节) + UDP 长度 (2 字节)
-    sum += (17u32 << 8); // UDP 协议号
-    sum += uhdr.len as u32;
-
-    // UDP 头部
-    sum += uhdr.source as u32;
-    sum += uhdr.dest as u32;
-    sum += uhdr.len as u32;
-    sum += 0; // 校验和字段 (先设为 0)
-
-    // 数据
-    let mut i = 0;
-    while i + 1 < data.len() {
-        let word = u16::from_be_bytes([data[i], data[i + 1]]) as u32;
-        sum += word;
-        i += 2;
-    }
+    let sum = checksum::csum_tcpudp_nofold(shdr, dhdr, (UDP_HLEN + data.len()) as u32, 17);
 
-    // 处理最后一个字节 (如果有)
-    if i < data.len() {
-        sum += (data[i] as u32) << 8;
-    }
+    // UDP 头部 (校验和字段按 0 计算)
+    let mut hdr = *uhdr;
+    hdr.check = 0;
+    let hdr_bytes = unsafe {
+        core::slice::from_raw_parts((&hdr as *const UdpHdr) as *const u8, UDP_HLEN)
+    };
+    let sum = checksum::csum_partial(hdr_bytes, sum);
 
-    // 处理进位
-    while sum >> 16 != 0 {
-        sum = (sum & 0xFFFF) + (sum >> 16);
-    }
+    // 数据
+    let csum = checksum::csum_fold(checksum::csum_partial(data, sum));
 
-    // 取反
-    !sum as u16
+    // 结果为 0 时发送 0xFFFF，0 表示未计算校验和 (CSUM_MANGLED_0)
+    if csum == 0 { 0xFFFF } else { csum }
 }
 
 /// 构造 UDP 数据包
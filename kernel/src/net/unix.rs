@@ -0,0 +1,1020 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! Unix 域套接字 (AF_UNIX)
+//!
+//! 同一台机器上进程之间的套接字，数据不经过协议栈，发送方直接写入对端的接收缓冲区：
+//! - SOCK_STREAM：字节流，接收缓冲区是与管道相同的页槽环 (PipeRing)
+//! - SOCK_DGRAM / SOCK_SEQPACKET：保留消息边界，接收队列中每项是一个消息
+//! - SCM_RIGHTS 控制消息在进程之间传递打开的文件，在途期间消息持有文件的引用
+//! - 地址以 NUL 开头时属于抽象命名空间，否则是路径名
+//!
+//! 套接字是文件描述符表中的普通文件，read / write / poll 与管道走同一套路径。
+//!
+//! 参考: net/unix/af_unix.c
+//!
+//! # 设计
+//! - 抽象名与路径名都记录在全局名字表中；路径名不在文件系统中创建 socket inode，
+//!   关闭套接字时名字随之释放
+//! - 等待与唤醒都挂在接收方的两个等待队列上：读者与 accept 等在 rcv_wait，
+//!   向它写入的发送方等在 snd_wait
+//! - 流式套接字中 SCM_RIGHTS 的文件附着在字节流的位置上，一次读取不会越过带文件的位置
+//! - 不回收互相引用的在途文件 (unix_gc)
+
+use alloc::collections::{BTreeMap, VecDeque};
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU32, Ordering};
+use spin::Mutex;
+
+use crate::fs::file::{fput, poll_mask, File, FileFlags, FileOps};
+use crate::fs::pipe::{pipe_wait, PipeRing, PIPE_DEF_BUFFERS};
+use crate::fs::select::{poll_wait, PollTable};
+use crate::process::wait::WaitQueueHead;
+
+/// 协议族
+pub const AF_UNIX: i32 = 1;
+
+/// 套接字类型
+pub const SOCK_STREAM: i32 = 1;
+pub const SOCK_DGRAM: i32 = 2;
+pub const SOCK_SEQPACKET: i32 = 5;
+
+/// socket() 的 type 中携带的标志
+pub const SOCK_TYPE_MASK: i32 = 0xf;
+pub const SOCK_NONBLOCK: i32 = 0o4000;
+pub const SOCK_CLOEXEC: i32 = 0o2000000;
+
+/// 控制消息层级与类型
+pub const SOL_SOCKET: i32 = 1;
+pub const SCM_RIGHTS: i32 = 1;
+
+/// 一个 SCM_RIGHTS 消息最多传递的文件数 (SCM_MAX_FD)
+pub const SCM_MAX_FD: usize = 253;
+
+/// sun_path 的长度 (UNIX_PATH_MAX)
+pub const UNIX_PATH_MAX: usize = 108;
+
+/// sockaddr_un 中 sun_path 之前 sun_family 的长度
+pub const UNIX_FAMILY_LEN: usize = 2;
+
+/// 数据报接收队列最多的消息数 (net.unix.max_dgram_qlen)
+pub const UNIX_MAX_DGRAM_QLEN: usize = 10;
+
+/// 消息型接收队列的字节上限 (sk_rcvbuf)
+pub const UNIX_RCVBUF: usize = 212992;
+
+/// listen 的最大 backlog (SOMAXCONN)
+pub const SOMAXCONN: usize = 4096;
+
+/// shutdown 的方式
+pub const SHUT_RD: i32 = 0;
+pub const SHUT_WR: i32 = 1;
+pub const SHUT_RDWR: i32 = 2;
+
+/// 不再接收 / 不再发送 (RCV_SHUTDOWN / SEND_SHUTDOWN)
+const RCV_SHUTDOWN: u8 = 1;
+const SEND_SHUTDOWN: u8 = 2;
+const SHUTDOWN_MASK: u8 = RCV_SHUTDOWN | SEND_SHUTDOWN;
+
+/// 错误码
+const EPERM: isize = -1;
+const ENOENT: isize = -2;
+const EAGAIN: isize = -11;
+const EINVAL: isize = -22;
+const EPIPE: isize = -32;
+const EMSGSIZE: isize = -90;
+const EPROTOTYPE: isize = -91;
+const EOPNOTSUPP: isize = -95;
+const EADDRINUSE: isize = -98;
+const EISCONN: isize = -106;
+const ENOTCONN: isize = -107;
+const ECONNREFUSED: isize = -111;
+
+/// 套接字状态
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum UnixState {
+    /// 未连接 (TCP_CLOSE)
+    Unconnected,
+    /// 监听中 (TCP_LISTEN)
+    Listening,
+    /// 已连接 (TCP_ESTABLISHED)
+    Connected,
+}
+
+/// 消息型接收队列中的一个消息
+struct UnixMsg {
+    data: Vec<u8>,
+    /// SCM_RIGHTS 传递的文件
+    fds: Vec<Arc<File>>,
+    /// 发送方地址
+    addr: Option<Vec<u8>>,
+}
+
+/// 附着在字节流 pos 处的 SCM_RIGHTS 文件
+struct UnixFdBatch {
+    pos: u64,
+    fds: Vec<Arc<File>>,
+}
+
+struct UnixSockInner {
+    state: UnixState,
+    /// 绑定的地址：抽象名以 NUL 开头
+    addr: Option<Vec<u8>>,
+    /// 对端；数据报套接字 connect 后记录默认目标
+    peer: Option<Arc<UnixSock>>,
+    /// 流式套接字的接收缓冲区
+    ring: Option<PipeRing>,
+    /// 字节流中已读出 / 已写入的位置
+    rd_pos: u64,
+    wr_pos: u64,
+    /// 流中待交付的文件，按位置排序
+    fd_batches: VecDeque<UnixFdBatch>,
+    /// 消息型套接字的接收队列
+    msgs: VecDeque<UnixMsg>,
+    /// 接收队列中消息的总字节数
+    msg_bytes: usize,
+    /// 已完成连接、等待 accept 的套接字
+    backlog: VecDeque<Arc<UnixSock>>,
+    max_backlog: usize,
+    /// RCV_SHUTDOWN / SEND_SHUTDOWN
+    shutdown: u8,
+    /// 已关闭 (SOCK_DEAD)
+    dead: bool,
+}
+
+/// Unix 域套接字 (struct unix_sock)
+pub struct UnixSock {
+    ty: i32,
+    inner: Mutex<UnixSockInner>,
+    /// 读者与 accept 等待的队列
+    rcv_wait: WaitQueueHead,
+    /// 向本套接字发送、等待接收缓冲区腾出空间的队列
+    snd_wait: WaitQueueHead,
+}
+
+/// recvmsg 的结果
+pub struct UnixRecv {
+    /// 复制到缓冲区的字节数
+    pub len: usize,
+    /// 消息的完整长度；大于 len 时消息被截断
+    pub msg_len: usize,
+    /// 随消息到达的文件，由调用者安装到文件描述符表
+    pub fds: Vec<Arc<File>>,
+    /// 发送方地址
+    pub addr: Option<Vec<u8>>,
+}
+
+/// 已绑定的地址 (unix_socket_table)
+static UNIX_NAMES: Mutex<BTreeMap<Vec<u8>, Arc<UnixSock>>> = Mutex::new(BTreeMap::new());
+
+/// 自动绑定使用的下一个名字 (unix_autobind 的 ordernum)
+static UNIX_AUTOBIND_NEXT: AtomicU32 = AtomicU32::new(0);
+
+impl UnixSock {
+    fn new(ty: i32) -> Arc<Self> {
+        Arc::new(Self {
+            ty,
+            inner: Mutex::new(UnixSockInner {
+                state: UnixState::Unconnected,
+                addr: None,
+                peer: None,
+                ring: if ty == SOCK_STREAM { Some(PipeRing::new(PIPE_DEF_BUFFERS)) } else { None },
+                rd_pos: 0,
+                wr_pos: 0,
+                fd_batches: VecDeque::new(),
+                msgs: VecDeque::new(),
+                msg_bytes: 0,
+                backlog: VecDeque::new(),
+                max_backlog: 0,
+                shutdown: 0,
+                dead: false,
+            }),
+            rcv_wait: WaitQueueHead::new(),
+            snd_wait: WaitQueueHead::new(),
+        })
+    }
+
+    /// 套接字类型
+    pub fn sock_type(&self) -> i32 {
+        self.ty
+    }
+
+    /// 当前状态
+    pub fn state(&self) -> UnixState {
+        self.inner.lock().state
+    }
+
+    /// 面向连接 (SOCK_STREAM / SOCK_SEQPACKET)
+    fn connection_oriented(&self) -> bool {
+        self.ty != SOCK_DGRAM
+    }
+}
+
+impl UnixSockInner {
+    /// 接收队列中有数据
+    fn has_data(&self) -> bool {
+        match &self.ring {
+            Some(ring) => ring.available_read() > 0,
+            None => !self.msgs.is_empty(),
+        }
+    }
+
+    /// 还能接收长度为 len 的数据（流式套接字只要求有空间）
+    fn can_accept(&self, ty: i32, len: usize) -> bool {
+        match &self.ring {
+            Some(ring) => ring.available_write() > 0,
+            None => {
+                (ty != SOCK_DGRAM || self.msgs.len() < UNIX_MAX_DGRAM_QLEN)
+                    && (self.msgs.is_empty() || self.msg_bytes + len <= UNIX_RCVBUF)
+            }
+        }
+    }
+}
+
+/// 释放未交付的文件引用
+fn unix_put_fds(fds: Vec<Arc<File>>) {
+    for file in fds {
+        fput(file);
+    }
+}
+
+/// 把 data 依次复制到多个缓冲区
+fn copy_to_iov(iov: &mut [&mut [u8]], data: &[u8]) -> usize {
+    let mut done = 0;
+    for buf in iov.iter_mut() {
+        if done == data.len() {
+            break;
+        }
+        let n = buf.len().min(data.len() - done);
+        buf[..n].copy_from_slice(&data[done..done + n]);
+        done += n;
+    }
+    done
+}
+
+/// 解析 sockaddr_un (unix_mkname)
+///
+/// # 参数
+/// - `sun`: 用户给出的 addrlen 字节
+///
+/// # 返回
+/// 名字表中的键：抽象名保留开头的 NUL 与全部字节，路径名截止到第一个 NUL；
+/// 只有 sun_family 时返回空，表示自动绑定
+pub fn unix_mkname(sun: &[u8]) -> Result<Vec<u8>, isize> {
+    if sun.len() < UNIX_FAMILY_LEN || sun.len() > UNIX_FAMILY_LEN + UNIX_PATH_MAX {
+        return Err(EINVAL);
+    }
+    if u16::from_le_bytes([sun[0], sun[1]]) as i32 != AF_UNIX {
+        return Err(EINVAL);
+    }
+    let path = &sun[UNIX_FAMILY_LEN..];
+    if path.is_empty() || path[0] == 0 {
+        return Ok(path.to_vec());
+    }
+    let end = path.iter().position(|&b| b == 0).unwrap_or(path.len());
+    Ok(path[..end].to_vec())
+}
+
+/// 把名字编码为 sockaddr_un (unix_getname)
+///
+/// # 返回
+/// 地址字节；路径名带结尾的 NUL，未绑定时只有 sun_family
+pub fn unix_sockaddr(name: Option<&[u8]>) -> Vec<u8> {
+    let mut sun = Vec::with_capacity(UNIX_FAMILY_LEN + UNIX_PATH_MAX);
+    sun.extend_from_slice(&(AF_UNIX as u16).to_le_bytes());
+    if let Some(name) = name {
+        sun.extend_from_slice(name);
+        if name.first().map_or(false, |&b| b != 0) {
+            sun.push(0);
+        }
+    }
+    sun
+}
+
+/// 在名字表中查找套接字 (unix_find_other)
+fn unix_find(name: &[u8]) -> Result<Arc<UnixSock>, isize> {
+    match UNIX_NAMES.lock().get(name) {
+        Some(sock) => Ok(sock.clone()),
+        // 路径名不存在是 ENOENT，抽象名是 ECONNREFUSED
+        None if name.first().map_or(false, |&b| b != 0) => Err(ENOENT),
+        None => Err(ECONNREFUSED),
+    }
+}
+
+/// 创建套接字 (unix_create)
+pub fn unix_create(ty: i32) -> Result<Arc<UnixSock>, isize> {
+    match ty {
+        SOCK_STREAM | SOCK_DGRAM | SOCK_SEQPACKET => Ok(UnixSock::new(ty)),
+        _ => Err(-94),  // ESOCKTNOSUPPORT
+    }
+}
+
+/// 创建一对互相连接的套接字 (unix_socketpair)
+pub fn unix_socketpair(ty: i32) -> Result<(Arc<UnixSock>, Arc<UnixSock>), isize> {
+    let a = unix_create(ty)?;
+    let b = unix_create(ty)?;
+    {
+        let mut inner = a.inner.lock();
+        inner.peer = Some(b.clone());
+        inner.state = UnixState::Connected;
+    }
+    {
+        let mut inner = b.inner.lock();
+        inner.peer = Some(a.clone());
+        inner.state = UnixState::Connected;
+    }
+    Ok((a, b))
+}
+
+/// 绑定地址 (unix_bind)
+///
+/// # 参数
+/// - `name`: unix_mkname 的结果，为空时自动绑定一个抽象名
+pub fn unix_bind(sock: &Arc<UnixSock>, name: &[u8]) -> isize {
+    if sock.inner.lock().addr.is_some() {
+        return EINVAL;
+    }
+    let name = if name.is_empty() {
+        match unix_autobind_name() {
+            Some(name) => name,
+            None => return -28,  // ENOSPC：名字用尽
+        }
+    } else {
+        name.to_vec()
+    };
+
+    let mut names = UNIX_NAMES.lock();
+    if names.contains_key(&name) {
+        return EADDRINUSE;
+    }
+    let mut inner = sock.inner.lock();
+    if inner.addr.is_some() {
+        return EINVAL;
+    }
+    inner.addr = Some(name.clone());
+    names.insert(name, sock.clone());
+    0
+}
+
+/// 自动绑定的抽象名：NUL 加 5 个十六进制数字 (unix_autobind)
+fn unix_autobind_name() -> Option<Vec<u8>> {
+    const HEX: &[u8; 16] = b"0123456789abcdef";
+    let names = UNIX_NAMES.lock();
+    for _ in 0..0x100000 {
+        let order = UNIX_AUTOBIND_NEXT.fetch_add(1, Ordering::Relaxed) & 0xFFFFF;
+        let mut name = Vec::with_capacity(6);
+        name.push(0);
+        for shift in (0..5).rev() {
+            name.push(HEX[((order >> (shift * 4)) & 0xF) as usize]);
+        }
+        if !names.contains_key(&name) {
+            return Some(name);
+        }
+    }
+    None
+}
+
+/// 开始监听 (unix_listen)
+pub fn unix_listen(sock: &Arc<UnixSock>, backlog: i32) -> isize {
+    if !sock.connection_oriented() {
+        return EOPNOTSUPP;
+    }
+    let mut inner = sock.inner.lock();
+    if inner.addr.is_none() || inner.state == UnixState::Connected {
+        return EINVAL;
+    }
+    inner.state = UnixState::Listening;
+    inner.max_backlog = (backlog.max(1) as usize).min(SOMAXCONN);
+    0
+}
+
+/// 连接到 name 上的套接字 (unix_stream_connect / unix_dgram_connect)
+///
+/// 面向连接时为对方建立一个已连接的新套接字放入监听队列；backlog 已满时等待，
+/// nonblock 时返回 EAGAIN
+pub fn unix_connect(sock: &Arc<UnixSock>, name: &[u8], nonblock: bool) -> isize {
+    let other = match unix_find(name) {
+        Ok(other) => other,
+        Err(e) => return e,
+    };
+    if other.ty != sock.ty {
+        return EPROTOTYPE;
+    }
+
+    if !sock.connection_oriented() {
+        // 数据报：只记录默认目标
+        let mut inner = sock.inner.lock();
+        inner.peer = Some(other);
+        inner.state = UnixState::Connected;
+        return 0;
+    }
+
+    match sock.inner.lock().state {
+        UnixState::Connected => return EISCONN,
+        UnixState::Listening => return EINVAL,
+        UnixState::Unconnected => {}
+    }
+
+    loop {
+        let mut other_inner = other.inner.lock();
+        if other_inner.state != UnixState::Listening || other_inner.dead {
+            return ECONNREFUSED;
+        }
+        if other_inner.backlog.len() < other_inner.max_backlog {
+            // 新套接字与监听者共用地址
+            let newsk = UnixSock::new(sock.ty);
+            {
+                let mut new_inner = newsk.inner.lock();
+                new_inner.state = UnixState::Connected;
+                new_inner.peer = Some(sock.clone());
+                new_inner.addr = other_inner.addr.clone();
+            }
+            {
+                let mut inner = sock.inner.lock();
+                inner.peer = Some(newsk.clone());
+                inner.state = UnixState::Connected;
+            }
+            other_inner.backlog.push_back(newsk);
+            drop(other_inner);
+            other.rcv_wait.wake_up_all();
+            return 0;
+        }
+        drop(other_inner);
+
+        if nonblock {
+            return EAGAIN;
+        }
+        let ready = || {
+            let inner = other.inner.lock();
+            inner.state != UnixState::Listening || inner.backlog.len() < inner.max_backlog
+        };
+        if !pipe_wait(&other.snd_wait, ready) {
+            return EAGAIN;
+        }
+    }
+}
+
+/// 取出一个已完成的连接 (unix_accept)
+pub fn unix_accept(sock: &Arc<UnixSock>, nonblock: bool) -> Result<Arc<UnixSock>, isize> {
+    loop {
+        let mut inner = sock.inner.lock();
+        if inner.state != UnixState::Listening {
+            return Err(EINVAL);
+        }
+        if let Some(newsk) = inner.backlog.pop_front() {
+            drop(inner);
+            // 腾出了 backlog，唤醒等待的 connect
+            sock.snd_wait.wake_up_all();
+            return Ok(newsk);
+        }
+        drop(inner);
+
+        if nonblock {
+            return Err(EAGAIN);
+        }
+        let ready = || {
+            let inner = sock.inner.lock();
+            !inner.backlog.is_empty() || inner.state != UnixState::Listening
+        };
+        if !pipe_wait(&sock.rcv_wait, ready) {
+            return Err(EAGAIN);
+        }
+    }
+}
+
+/// 关闭连接的一个或两个方向 (unix_shutdown)
+///
+/// 面向连接时对端的相反方向一同关闭：本端不再发送，对端读完后得到 EOF
+pub fn unix_shutdown(sock: &Arc<UnixSock>, how: i32) -> isize {
+    let mode = match how {
+        SHUT_RD => RCV_SHUTDOWN,
+        SHUT_WR => SEND_SHUTDOWN,
+        SHUT_RDWR => SHUTDOWN_MASK,
+        _ => return EINVAL,
+    };
+    let peer = {
+        let mut inner = sock.inner.lock();
+        inner.shutdown |= mode;
+        inner.peer.clone()
+    };
+    sock.rcv_wait.wake_up_all();
+    sock.snd_wait.wake_up_all();
+
+    if let Some(peer) = peer {
+        if sock.connection_oriented() {
+            let peer_mode = (if mode & RCV_SHUTDOWN != 0 { SEND_SHUTDOWN } else { 0 })
+                | (if mode & SEND_SHUTDOWN != 0 { RCV_SHUTDOWN } else { 0 });
+            peer.inner.lock().shutdown |= peer_mode;
+            peer.rcv_wait.wake_up_all();
+            peer.snd_wait.wake_up_all();
+        }
+    }
+    0
+}
+
+/// 绑定的地址 (getsockname)
+pub fn unix_getname(sock: &UnixSock) -> Option<Vec<u8>> {
+    sock.inner.lock().addr.clone()
+}
+
+/// 对端的地址 (getpeername)
+///
+/// # 返回
+/// 没有对端时返回 ENOTCONN；对端未绑定时为 None
+pub fn unix_getpeername(sock: &UnixSock) -> Result<Option<Vec<u8>>, isize> {
+    let peer = sock.inner.lock().peer.clone().ok_or(ENOTCONN)?;
+    let addr = peer.inner.lock().addr.clone();
+    Ok(addr)
+}
+
+/// 发送一个消息 (unix_stream_sendmsg / unix_dgram_sendmsg / unix_seqpacket_sendmsg)
+///
+/// # 参数
+/// - `dest`: 目标名字，只对未连接的数据报套接字有意义
+/// - `fds`: SCM_RIGHTS 传递的文件，发送失败时释放
+///
+/// # 返回
+/// 发送的字节数或负错误码
+pub fn unix_sendmsg(
+    sock: &Arc<UnixSock>,
+    iov: &[&[u8]],
+    dest: Option<&[u8]>,
+    fds: Vec<Arc<File>>,
+    nonblock: bool,
+) -> isize {
+    if fds.len() > SCM_MAX_FD {
+        unix_put_fds(fds);
+        return EINVAL;
+    }
+    if sock.ty == SOCK_STREAM {
+        unix_stream_sendmsg(sock, iov, dest, fds, nonblock)
+    } else {
+        unix_dgram_sendmsg(sock, iov, dest, fds, nonblock)
+    }
+}
+
+fn unix_stream_sendmsg(
+    sock: &Arc<UnixSock>,
+    iov: &[&[u8]],
+    dest: Option<&[u8]>,
+    fds: Vec<Arc<File>>,
+    nonblock: bool,
+) -> isize {
+    let (state, shutdown, peer) = {
+        let inner = sock.inner.lock();
+        (inner.state, inner.shutdown, inner.peer.clone())
+    };
+    if dest.is_some() {
+        unix_put_fds(fds);
+        return if state == UnixState::Connected { EISCONN } else { EOPNOTSUPP };
+    }
+    if shutdown & SEND_SHUTDOWN != 0 {
+        unix_put_fds(fds);
+        return EPIPE;
+    }
+    let peer = match peer {
+        Some(peer) => peer,
+        None => {
+            unix_put_fds(fds);
+            return ENOTCONN;
+        }
+    };
+
+    let mut fds = Some(fds).filter(|fds| !fds.is_empty());
+    let mut total = 0usize;
+    for buf in iov.iter() {
+        let mut done = 0;
+        while done < buf.len() {
+            let count = {
+                let mut inner = peer.inner.lock();
+                if inner.shutdown & RCV_SHUTDOWN != 0 || inner.dead {
+                    drop(inner);
+                    if let Some(fds) = fds.take() {
+                        unix_put_fds(fds);
+                    }
+                    return if total > 0 { total as isize } else { EPIPE };
+                }
+                let pos = inner.wr_pos;
+                let count = match inner.ring.as_mut() {
+                    Some(ring) => ring.write(&buf[done..]),
+                    None => 0,
+                };
+                if count > 0 {
+                    // 文件附着在这次写入的第一个字节上
+                    if let Some(fds) = fds.take() {
+                        inner.fd_batches.push_back(UnixFdBatch { pos, fds });
+                    }
+                    inner.wr_pos += count as u64;
+                }
+                count
+            };
+            if count > 0 {
+                done += count;
+                total += count;
+                peer.rcv_wait.wake_up_all();
+                continue;
+            }
+
+            // 对端的接收缓冲区已满
+            if nonblock {
+                if let Some(fds) = fds.take() {
+                    unix_put_fds(fds);
+                }
+                return if total > 0 { total as isize } else { EAGAIN };
+            }
+            let ready = || {
+                let inner = peer.inner.lock();
+                inner.can_accept(SOCK_STREAM, 1) || inner.shutdown & RCV_SHUTDOWN != 0 || inner.dead
+            };
+            if !pipe_wait(&peer.snd_wait, ready) {
+                if let Some(fds) = fds.take() {
+                    unix_put_fds(fds);
+                }
+                return if total > 0 { total as isize } else { EAGAIN };
+            }
+        }
+    }
+    // 没有数据的 SCM_RIGHTS 不会被发送
+    if let Some(fds) = fds.take() {
+        unix_put_fds(fds);
+    }
+    total as isize
+}
+
+fn unix_dgram_sendmsg(
+    sock: &Arc<UnixSock>,
+    iov: &[&[u8]],
+    dest: Option<&[u8]>,
+    fds: Vec<Arc<File>>,
+    nonblock: bool,
+) -> isize {
+    let len: usize = iov.iter().map(|buf| buf.len()).sum();
+    if len > UNIX_RCVBUF {
+        unix_put_fds(fds);
+        return EMSGSIZE;
+    }
+
+    let (shutdown, peer, addr) = {
+        let inner = sock.inner.lock();
+        (inner.shutdown, inner.peer.clone(), inner.addr.clone())
+    };
+    if shutdown & SEND_SHUTDOWN != 0 {
+        unix_put_fds(fds);
+        return EPIPE;
+    }
+
+    // SOCK_SEQPACKET 只发给对端；数据报优先使用给出的地址
+    let target = match (dest.filter(|_| sock.ty == SOCK_DGRAM), peer) {
+        (Some(name), _) => match unix_find(name) {
+            Ok(other) if other.ty == sock.ty => other,
+            Ok(_) => {
+                unix_put_fds(fds);
+                return EPROTOTYPE;
+            }
+            Err(e) => {
+                unix_put_fds(fds);
+                return e;
+            }
+        },
+        (None, Some(peer)) => peer,
+        (None, None) => {
+            unix_put_fds(fds);
+            return if sock.ty == SOCK_SEQPACKET { ENOTCONN } else { -89 };  // EDESTADDRREQ
+        }
+    };
+
+    let data: Vec<u8> = iov.iter().flat_map(|buf| buf.iter().copied()).collect();
+    let mut msg = Some(UnixMsg { data, fds, addr });
+    loop {
+        let mut inner = target.inner.lock();
+        if inner.dead {
+            drop(inner);
+            if let Some(msg) = msg.take() {
+                unix_put_fds(msg.fds);
+            }
+            return if sock.connection_oriented() { EPIPE } else { ECONNREFUSED };
+        }
+        // 接收方已连接到别的套接字时拒绝 (unix_may_send)
+        if sock.ty == SOCK_DGRAM {
+            if let Some(other_peer) = inner.peer.as_ref() {
+                if !Arc::ptr_eq(other_peer, sock) {
+                    drop(inner);
+                    if let Some(msg) = msg.take() {
+                        unix_put_fds(msg.fds);
+                    }
+                    return EPERM;
+                }
+            }
+        }
+        if inner.shutdown & RCV_SHUTDOWN != 0 && sock.connection_oriented() {
+            drop(inner);
+            if let Some(msg) = msg.take() {
+                unix_put_fds(msg.fds);
+            }
+            return EPIPE;
+        }
+        if inner.can_accept(sock.ty, len) {
+            if let Some(msg) = msg.take() {
+                inner.msg_bytes += msg.data.len();
+                inner.msgs.push_back(msg);
+            }
+            drop(inner);
+            target.rcv_wait.wake_up_all();
+            return len as isize;
+        }
+        drop(inner);
+
+        if nonblock {
+            if let Some(msg) = msg.take() {
+                unix_put_fds(msg.fds);
+            }
+            return EAGAIN;
+        }
+        let ty = sock.ty;
+        let ready = || {
+            let inner = target.inner.lock();
+            inner.can_accept(ty, len) || inner.dead
+        };
+        if !pipe_wait(&target.snd_wait, ready) {
+            if let Some(msg) = msg.take() {
+                unix_put_fds(msg.fds);
+            }
+            return EAGAIN;
+        }
+    }
+}
+
+/// 接收数据 (unix_stream_recvmsg / unix_dgram_recvmsg)
+///
+/// 接收队列为空时等待，nonblock 时返回 EAGAIN；对端关闭或 shutdown 之后读完剩余数据得到 0
+pub fn unix_recvmsg(sock: &Arc<UnixSock>, iov: &mut [&mut [u8]], nonblock: bool) -> Result<UnixRecv, isize> {
+    loop {
+        let mut inner = sock.inner.lock();
+        if inner.state == UnixState::Listening {
+            return Err(EINVAL);
+        }
+        if inner.has_data() {
+            let recv = if sock.ty == SOCK_STREAM {
+                unix_stream_read(&mut inner, iov)
+            } else {
+                let msg = match inner.msgs.pop_front() {
+                    Some(msg) => msg,
+                    None => continue,
+                };
+                inner.msg_bytes -= msg.data.len();
+                let len = copy_to_iov(iov, &msg.data);
+                UnixRecv { len, msg_len: msg.data.len(), fds: msg.fds, addr: msg.addr }
+            };
+            let peer = inner.peer.clone();
+            drop(inner);
+            sock.snd_wait.wake_up_all();
+            // 对端的可写状态随之变化，通知 poll 在对端上的等待者 (sk_write_space)
+            if let Some(peer) = peer {
+                peer.rcv_wait.wake_up_all();
+            }
+            return Ok(recv);
+        }
+
+        if inner.shutdown & RCV_SHUTDOWN != 0 {
+            return Ok(UnixRecv { len: 0, msg_len: 0, fds: Vec::new(), addr: None });
+        }
+        if sock.connection_oriented() && inner.state != UnixState::Connected {
+            return Err(if sock.ty == SOCK_STREAM { EINVAL } else { ENOTCONN });
+        }
+        drop(inner);
+
+        if nonblock {
+            return Err(EAGAIN);
+        }
+        let ready = || {
+            let inner = sock.inner.lock();
+            inner.has_data() || inner.shutdown & RCV_SHUTDOWN != 0
+        };
+        if !pipe_wait(&sock.rcv_wait, ready) {
+            return Err(EAGAIN);
+        }
+    }
+}
+
+/// 从字节流读取，不越过下一批文件的位置 (unix_stream_read_generic)
+fn unix_stream_read(inner: &mut UnixSockInner, iov: &mut [&mut [u8]]) -> UnixRecv {
+    let rd_pos = inner.rd_pos;
+    let mut fds = Vec::new();
+    if inner.fd_batches.front().map_or(false, |batch| batch.pos == rd_pos) {
+        if let Some(batch) = inner.fd_batches.pop_front() {
+            fds = batch.fds;
+        }
+    }
+    let mut limit = iov.iter().map(|buf| buf.len()).sum::<usize>();
+    if let Some(batch) = inner.fd_batches.front() {
+        limit = limit.min((batch.pos - rd_pos) as usize);
+    }
+
+    let mut len = 0;
+    if let Some(ring) = inner.ring.as_mut() {
+        for buf in iov.iter_mut() {
+            if len == limit {
+                break;
+            }
+            let want = buf.len().min(limit - len);
+            let n = ring.read(&mut buf[..want]);
+            len += n;
+            if n < want {
+                break;
+            }
+        }
+    }
+    inner.rd_pos += len as u64;
+    UnixRecv { len, msg_len: len, fds, addr: None }
+}
+
+/// 关闭套接字 (unix_release_sock)
+///
+/// 释放名字，通知对端，丢弃监听队列中未 accept 的连接与接收队列中未交付的文件
+fn unix_release(sock: &Arc<UnixSock>) {
+    let (addr, peer, backlog, msgs, batches) = {
+        let mut inner = sock.inner.lock();
+        inner.dead = true;
+        inner.state = UnixState::Unconnected;
+        inner.shutdown = SHUTDOWN_MASK;
+        inner.ring = None;
+        inner.msg_bytes = 0;
+        (
+            inner.addr.take(),
+            inner.peer.take(),
+            core::mem::take(&mut inner.backlog),
+            core::mem::take(&mut inner.msgs),
+            core::mem::take(&mut inner.fd_batches),
+        )
+    };
+
+    // 监听者的新套接字与它共用地址，只有名字表中的那个才能删除名字
+    if let Some(addr) = addr {
+        let mut names = UNIX_NAMES.lock();
+        if names.get(&addr).map_or(false, |owner| Arc::ptr_eq(owner, sock)) {
+            names.remove(&addr);
+        }
+    }
+
+    if let Some(peer) = peer {
+        let mut peer_inner = peer.inner.lock();
+        if peer_inner.peer.as_ref().map_or(false, |p| Arc::ptr_eq(p, sock)) {
+            peer_inner.peer = None;
+            if sock.connection_oriented() {
+                peer_inner.shutdown = SHUTDOWN_MASK;
+            } else {
+                peer_inner.state = UnixState::Unconnected;
+            }
+        }
+        drop(peer_inner);
+        peer.rcv_wait.wake_up_all();
+        peer.snd_wait.wake_up_all();
+    }
+
+    for child in backlog {
+        unix_release(&child);
+    }
+    for msg in msgs {
+        unix_put_fds(msg.fds);
+    }
+    for batch in batches {
+        unix_put_fds(batch.fds);
+    }
+    sock.rcv_wait.wake_up_all();
+    sock.snd_wait.wake_up_all();
+}
+
+/// Unix 域套接字的就绪事件 (unix_poll / unix_dgram_poll)
+///
+/// 监听者有待 accept 的连接时可读；接收队列非空或不再接收时可读，两个方向都关闭时挂断；
+/// 对端的接收缓冲区有空间时可写，未连接的数据报套接字总是可写
+fn unix_poll(file: &File, pt: Option<&mut PollTable>) -> u32 {
+    use poll_mask::*;
+
+    let sock = match unix_sock(file) {
+        Some(sock) => sock,
+        None => return 0,
+    };
+    // 可读与挂断在 rcv_wait 上唤醒；对端读走数据腾出空间时也会唤醒它，可写变化同样可见
+    poll_wait(&sock.rcv_wait, pt);
+    let (state, readable, shutdown, peer) = {
+        let inner = sock.inner.lock();
+        if inner.state == UnixState::Listening {
+            return if inner.backlog.is_empty() { 0 } else { POLLIN | POLLRDNORM };
+        }
+        (inner.state, inner.has_data(), inner.shutdown, inner.peer.clone())
+    };
+
+    let mut mask = 0;
+    if readable || shutdown & RCV_SHUTDOWN != 0 {
+        mask |= POLLIN | POLLRDNORM;
+    }
+    if shutdown == SHUTDOWN_MASK || (sock.connection_oriented() && state == UnixState::Unconnected) {
+        mask |= POLLHUP;
+    }
+    if shutdown & SEND_SHUTDOWN == 0 {
+        let writable = match peer {
+            Some(peer) => {
+                let inner = peer.inner.lock();
+                inner.can_accept(sock.ty, 1) || inner.dead
+            }
+            None => !sock.connection_oriented(),
+        };
+        if writable {
+            mask |= POLLOUT | POLLWRNORM;
+        }
+    }
+    mask
+}
+
+fn unix_file_read(file: &File, buf: &mut [u8]) -> isize {
+    let sock = match unix_sock_arc(file) {
+        Some(sock) => sock,
+        None => return -9,  // EBADF
+    };
+    let nonblock = file.flags.bits() & FileFlags::O_NONBLOCK != 0;
+    match unix_recvmsg(&sock, &mut [buf], nonblock) {
+        Ok(recv) => {
+            // read 不能接收文件
+            unix_put_fds(recv.fds);
+            recv.len as isize
+        }
+        Err(e) => e,
+    }
+}
+
+fn unix_file_write(file: &File, buf: &[u8]) -> isize {
+    let sock = match unix_sock_arc(file) {
+        Some(sock) => sock,
+        None => return -9,  // EBADF
+    };
+    let nonblock = file.flags.bits() & FileFlags::O_NONBLOCK != 0;
+    unix_sendmsg(&sock, &[buf], None, Vec::new(), nonblock)
+}
+
+fn unix_file_close(file: &File) -> i32 {
+    let ptr = match unsafe { (*file.private_data.get()).take() } {
+        Some(ptr) => ptr,
+        None => return -9,  // EBADF
+    };
+    let sock = unsafe { Arc::from_raw(ptr as *const UnixSock) };
+    unix_release(&sock);
+    0
+}
+
+/// Unix 域套接字文件操作
+static UNIX_OPS: FileOps = FileOps {
+    read: Some(unix_file_read),
+    write: Some(unix_file_write),
+    lseek: None,
+    close: Some(unix_file_close),
+    read_iter: None,
+    write_iter: None,
+    poll: Some(unix_poll),
+};
+
+/// 为套接字创建文件 (sock_alloc_file)
+///
+/// 文件持有套接字的一个引用，最后一个文件引用释放时关闭套接字
+pub fn unix_sock_file(sock: Arc<UnixSock>, nonblock: bool) -> Arc<File> {
+    let mut flags = FileFlags::O_RDWR;
+    if nonblock {
+        flags |= FileFlags::O_NONBLOCK;
+    }
+    let file = Arc::new(File::new(FileFlags::new(flags)));
+    file.set_ops(&UNIX_OPS);
+    file.set_private_data(Arc::into_raw(sock) as *mut u8);
+    file
+}
+
+/// 文件是否为 Unix 域套接字
+pub fn is_unix_socket(file: &File) -> bool {
+    unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &UNIX_OPS))
+}
+
+/// 由文件得到套接字
+pub fn unix_sock(file: &File) -> Option<&UnixSock> {
+    if !is_unix_socket(file) {
+        return None;
+    }
+    unsafe { *file.private_data.get() }.map(|ptr| unsafe { &*(ptr as *const UnixSock) })
+}
+
+/// 由文件得到套接字的一个引用
+pub fn unix_sock_arc(file: &File) -> Option<Arc<UnixSock>> {
+    if !is_unix_socket(file) {
+        return None;
+    }
+    unsafe { *file.private_data.get() }.map(|ptr| unsafe {
+        let ptr = ptr as *const UnixSock;
+        Arc::increment_strong_count(ptr);
+        Arc::from_raw(ptr)
+    })
+}
+
+/// 文件是否为非阻塞模式
+pub fn unix_file_nonblock(file: &File) -> bool {
+    file.flags.bits() & FileFlags::O_NONBLOCK != 0
+}
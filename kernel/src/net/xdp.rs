@@ -0,0 +1,210 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 驱动层的早期包过滤 (XDP)
+//!
+//! 网卡驱动在接收轮询中、交给以太网层之前，对原始帧运行一个经典 BPF 程序，
+//! 由返回值决定丢弃、放行、从收到的设备发回或转发到另一个设备。
+//! 被丢弃的帧不经过 GRO、以太网层和协议栈，接收缓冲区直接回收。
+//!
+//! 参考: net/core/dev.c (do_xdp_generic), net/core/filter.c (xdp_do_redirect),
+//! include/uapi/linux/bpf.h (enum xdp_action)
+//!
+//! # 返回值
+//! - 低 8 位是动作：0 ABORTED、1 DROP、2 PASS、3 TX、4 REDIRECT，其他值按 ABORTED 处理
+//! - REDIRECT 时高 24 位是目标设备的 ifindex（经典 BPF 没有 bpf_redirect 辅助函数），
+//!   没有目标时按 ABORTED 处理
+//!
+//! # 与 Linux 的差异
+//! - 经典 BPF 不能改写包，TX 时由驱动交换以太网源地址与目的地址，把帧反射给发送者
+//! - 程序经 /proc/net/xdp 为 eth0 装入：写入 struct sock_filter 数组装入，写入 "0" 卸载
+
+use alloc::format;
+use alloc::string::String;
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU64, Ordering};
+
+use crate::net::buffer::SkBuff;
+use crate::net::ethernet::ETH_ALEN;
+use crate::net::filter::{bpf_check_classic, bpf_prog_run, SockFilter};
+use crate::sync::RwLock;
+
+/// 程序的裁决 (enum xdp_action)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(u32)]
+pub enum XdpAction {
+    /// 程序出错，按丢弃处理并单独计数
+    Aborted = 0,
+    Drop = 1,
+    Pass = 2,
+    /// 从收到的设备发回
+    Tx = 3,
+    /// 转发到另一个设备
+    Redirect = 4,
+}
+
+/// 动作种类数
+pub const XDP_ACTIONS: usize = 5;
+
+const ACTION_NAMES: [&str; XDP_ACTIONS] = ["aborted", "drop", "pass", "tx", "redirect"];
+
+impl XdpAction {
+    /// 解析程序的返回值
+    ///
+    /// # 返回
+    /// 动作和 REDIRECT 的目标 ifindex
+    pub fn from_ret(ret: u32) -> (Self, u32) {
+        let action = match ret & 0xff {
+            1 => XdpAction::Drop,
+            2 => XdpAction::Pass,
+            3 => XdpAction::Tx,
+            4 if ret >> 8 != 0 => XdpAction::Redirect,
+            _ => XdpAction::Aborted,
+        };
+        (action, ret >> 8)
+    }
+}
+
+/// 已通过检查的程序 (struct bpf_prog)
+pub struct XdpProg {
+    insns: Vec<SockFilter>,
+}
+
+impl XdpProg {
+    /// 检查并装入程序
+    pub fn new(insns: &[SockFilter]) -> Result<Self, i32> {
+        bpf_check_classic(insns)?;
+        Ok(Self { insns: insns.to_vec() })
+    }
+
+    /// 对一个帧运行程序 (bpf_prog_run_xdp)
+    #[inline]
+    pub fn run(&self, frame: &[u8]) -> (XdpAction, u32) {
+        XdpAction::from_ret(bpf_prog_run(&self.insns, frame))
+    }
+
+    pub fn len(&self) -> usize {
+        self.insns.len()
+    }
+}
+
+/// 设备上的 XDP 挂载点：当前程序和各动作的计数 (net_device.xdp_prog + xdp 统计)
+pub struct XdpHook {
+    prog: RwLock<Option<Arc<XdpProg>>>,
+    actions: [AtomicU64; XDP_ACTIONS],
+    /// REDIRECT 的目标不存在或发送失败
+    redirect_err: AtomicU64,
+}
+
+impl XdpHook {
+    pub const fn new() -> Self {
+        Self {
+            prog: RwLock::new(None),
+            actions: [const { AtomicU64::new(0) }; XDP_ACTIONS],
+            redirect_err: AtomicU64::new(0),
+        }
+    }
+
+    /// 装入程序，替换已有的程序 (dev_xdp_attach)
+    ///
+    /// # 返回
+    /// 程序未通过检查时返回 -EINVAL，原来的程序保持不变
+    pub fn attach(&self, insns: &[SockFilter]) -> Result<(), i32> {
+        let prog = Arc::new(XdpProg::new(insns)?);
+        *self.prog.write() = Some(prog);
+        Ok(())
+    }
+
+    /// 卸载程序
+    pub fn detach(&self) {
+        *self.prog.write() = None;
+    }
+
+    /// 当前程序；驱动每轮轮询取一次，本轮内不受装入与卸载影响
+    #[inline]
+    pub fn prog(&self) -> Option<Arc<XdpProg>> {
+        self.prog.read().clone()
+    }
+
+    #[inline]
+    pub fn count(&self, action: XdpAction) {
+        self.actions[action as usize].fetch_add(1, Ordering::Relaxed);
+    }
+
+    /// 某个动作的计数
+    pub fn action_count(&self, action: XdpAction) -> u64 {
+        self.actions[action as usize].load(Ordering::Relaxed)
+    }
+
+    pub fn redirect_errors(&self) -> u64 {
+        self.redirect_err.load(Ordering::Relaxed)
+    }
+
+    /// 发送 TX 与 REDIRECT 的帧 (xdp_do_flush)
+    ///
+    /// 在驱动释放接收队列锁之后调用
+    ///
+    /// # 参数
+    /// - `xmit`: 收到帧的设备的发送函数
+    /// - `frames`: 帧和 REDIRECT 的目标 ifindex，TX 的目标为 0
+    pub fn flush(&self, xmit: impl Fn(SkBuff) -> i32, frames: Vec<(SkBuff, u32)>) {
+        for (skb, ifindex) in frames {
+            if ifindex == 0 {
+                xdp_swap_mac(&skb);
+                if xmit(skb) != 0 {
+                    self.redirect_err.fetch_add(1, Ordering::Relaxed);
+                }
+                continue;
+            }
+            match crate::drivers::net::get_netdevice_by_index(ifindex) {
+                Some(dev) if dev.is_up() => {
+                    if dev.xmit(skb) != 0 {
+                        self.redirect_err.fetch_add(1, Ordering::Relaxed);
+                    }
+                }
+                _ => {
+                    self.redirect_err.fetch_add(1, Ordering::Relaxed);
+                    skb.free();
+                }
+            }
+        }
+    }
+
+    /// /proc/net/xdp 中一个设备的内容
+    pub fn show(&self, name: &str) -> String {
+        let insns = self.prog.read().as_ref().map_or(0, |prog| prog.len());
+        let mut out = format!("{}: prog {} insns", name, insns);
+        for (i, action) in ACTION_NAMES.iter().enumerate() {
+            out += &format!(" {} {}", action, self.actions[i].load(Ordering::Relaxed));
+        }
+        out += &format!(" redirect_err {}\n", self.redirect_errors());
+        out
+    }
+
+    /// 处理 /proc/net/xdp 的写入：struct sock_filter 数组装入程序，"0" 卸载
+    pub fn write_control(&self, data: &[u8]) -> Result<usize, i32> {
+        let trimmed = match data.last() {
+            Some(b'\n') => &data[..data.len() - 1],
+            _ => data,
+        };
+        if trimmed == b"0" {
+            self.detach();
+            return Ok(data.len());
+        }
+        let insns = SockFilter::parse(data).ok_or(crate::errno::Errno::InvalidArgument.as_neg_i32())?;
+        self.attach(&insns)?;
+        Ok(data.len())
+    }
+}
+
+/// 交换以太网目的地址与源地址，TX 把帧反射给发送者
+fn xdp_swap_mac(skb: &SkBuff) {
+    if (skb.len as usize) < 2 * ETH_ALEN {
+        return;
+    }
+    let frame = unsafe { core::slice::from_raw_parts_mut(skb.data, 2 * ETH_ALEN) };
+    let (dst, src) = frame.split_at_mut(ETH_ALEN);
+    dst.swap_with_slice(src);
+}
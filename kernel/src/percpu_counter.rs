@@ -0,0 +1,105 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 每 CPU 近似计数器 (percpu_counter)
+//!
+//! 参考 Linux: lib/percpu_counter.c
+//!
+//! 每个 CPU 把增量先记在自己的槽里，槽的绝对值达到 batch 时才并入全局计数，
+//! 频繁修改的计数不再让所有 CPU 争用同一缓存行。
+//! - read() 只读全局计数，误差不超过 batch × CPU 数
+//! - sum() 加上各 CPU 的槽，得到某一时刻的准确值，用于写回磁盘等需要精确值的场合
+//! - 槽按缓存行对齐，不同 CPU 的槽不共享缓存行
+
+use core::sync::atomic::{AtomicI64, Ordering};
+
+use crate::config::MAX_CPUS;
+
+/// 槽并入全局计数的阈值 (percpu_counter_batch = max(32, nr_cpus * 2))
+pub const PERCPU_COUNTER_BATCH: i64 = if MAX_CPUS * 2 > 32 { MAX_CPUS as i64 * 2 } else { 32 };
+
+/// 一个 CPU 的槽，独占缓存行
+#[repr(align(64))]
+struct PercpuSlot(AtomicI64);
+
+/// 每 CPU 近似计数器 (struct percpu_counter)
+pub struct PercpuCounter {
+    /// 全局计数
+    count: AtomicI64,
+    /// 各 CPU 尚未并入的增量
+    counters: [PercpuSlot; MAX_CPUS],
+    batch: i64,
+}
+
+impl PercpuCounter {
+    /// 以初值 amount 创建 (percpu_counter_init)
+    pub const fn new(amount: i64) -> Self {
+        Self {
+            count: AtomicI64::new(amount),
+            counters: [const { PercpuSlot(AtomicI64::new(0)) }; MAX_CPUS],
+            batch: PERCPU_COUNTER_BATCH,
+        }
+    }
+
+    /// 设置为 amount，清空各 CPU 的槽 (percpu_counter_set)
+    ///
+    /// 与并发的 add 之间不保证原子，调用者在没有并发修改时使用（挂载、重放之后）
+    pub fn set(&self, amount: i64) {
+        for slot in &self.counters {
+            slot.0.store(0, Ordering::Relaxed);
+        }
+        self.count.store(amount, Ordering::Release);
+    }
+
+    /// 加上 amount (percpu_counter_add)
+    ///
+    /// 记在本 CPU 的槽里，槽的绝对值达到 batch 时整体并入全局计数。
+    /// 槽是原子的，执行中迁移到其他 CPU 也不会丢失增量
+    pub fn add(&self, amount: i64) {
+        let cpu = (crate::arch::cpu_id() as usize).min(MAX_CPUS - 1);
+        let slot = &self.counters[cpu].0;
+        let local = slot.fetch_add(amount, Ordering::Relaxed) + amount;
+        if local >= self.batch || local <= -self.batch {
+            let folded = slot.swap(0, Ordering::AcqRel);
+            self.count.fetch_add(folded, Ordering::AcqRel);
+        }
+    }
+
+    /// 减去 amount (percpu_counter_sub)
+    pub fn sub(&self, amount: i64) {
+        self.add(-amount)
+    }
+
+    /// 近似值：只读全局计数 (percpu_counter_read)
+    pub fn read(&self) -> i64 {
+        self.count.load(Ordering::Acquire)
+    }
+
+    /// 不小于 0 的近似值 (percpu_counter_read_positive)
+    pub fn read_positive(&self) -> i64 {
+        self.read().max(0)
+    }
+
+    /// 准确值：全局计数加上各 CPU 的槽 (percpu_counter_sum)
+    pub fn sum(&self) -> i64 {
+        self.counters
+            .iter()
+            .fold(self.count.load(Ordering::Acquire), |acc, slot| acc + slot.0.load(Ordering::Relaxed))
+    }
+
+    /// 不小于 0 的准确值 (percpu_counter_sum_positive)
+    pub fn sum_positive(&self) -> i64 {
+        self.sum().max(0)
+    }
+
+    /// 与 rhs 比较，近似值的误差范围不足以判断时才求准确值 (__percpu_counter_compare)
+    pub fn compare(&self, rhs: i64) -> core::cmp::Ordering {
+        let approx = self.read();
+        if (approx - rhs).abs() > self.batch * MAX_CPUS as i64 {
+            return approx.cmp(&rhs);
+        }
+        self.sum().cmp(&rhs)
+    }
+}
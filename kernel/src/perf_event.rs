@@ -0,0 +1,571 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! perf 计数事件 (perf_event)
+//!
+//! 参考 Linux: kernel/events/core.c, include/uapi/linux/perf_event.h
+//!
+//! 实现 perf_event_open 的计数模式。事件源是 arch::riscv64::pmu 的硬件计数器
+//! (cycles / instructions / cache-misses) 和两个软件计数 (page-faults / context-switches)，
+//! 它们在每个 CPU 上单调增长、从不停止。事件在开始计数时记下事件源的快照，
+//! 停止时把差值累加进 count：
+//! - 任务事件挂在 Task::perf_events 上，任务切入 CPU 时取快照、切出时累加，
+//!   只统计该任务在 CPU 上运行的时间
+//! - CPU 事件从使能起一直在它的 CPU 上计数
+//!
+//! 读取正在其他 CPU 上计数的事件时读不到那个 CPU 的计数器，改用它在最近一次
+//! tick 或任务切换时发布的值，最多滞后一个 tick。
+//! 不支持采样 (sample_period)、事件组、继承和 exclude_user / exclude_kernel
+
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use spin::Mutex;
+
+use crate::arch::riscv64::pmu::{self, HwEvent};
+use crate::config::MAX_CPUS;
+use crate::errno::Errno;
+use crate::fs::file::{File, FileFlags, FileOps};
+use crate::process::task::{Pid, Task, TaskState};
+use crate::sched::fair::sched_clock;
+
+/// 事件类型 (perf_type_id)
+pub const PERF_TYPE_HARDWARE: u32 = 0;
+pub const PERF_TYPE_SOFTWARE: u32 = 1;
+
+/// 硬件事件 (perf_hw_id)
+pub const PERF_COUNT_HW_CPU_CYCLES: u64 = 0;
+pub const PERF_COUNT_HW_INSTRUCTIONS: u64 = 1;
+pub const PERF_COUNT_HW_CACHE_MISSES: u64 = 3;
+
+/// 软件事件 (perf_sw_ids)
+pub const PERF_COUNT_SW_PAGE_FAULTS: u64 = 2;
+pub const PERF_COUNT_SW_CONTEXT_SWITCHES: u64 = 3;
+
+/// read 返回的附加字段 (perf_event_read_format)
+pub const PERF_FORMAT_TOTAL_TIME_ENABLED: u64 = 1 << 0;
+pub const PERF_FORMAT_TOTAL_TIME_RUNNING: u64 = 1 << 1;
+pub const PERF_FORMAT_ID: u64 = 1 << 2;
+
+/// perf_event_open 的 flags
+pub const PERF_FLAG_FD_CLOEXEC: u64 = 1 << 3;
+
+/// ioctl 命令
+pub const PERF_EVENT_IOC_ENABLE: u32 = 0x2400;
+pub const PERF_EVENT_IOC_DISABLE: u32 = 0x2401;
+pub const PERF_EVENT_IOC_RESET: u32 = 0x2403;
+pub const PERF_EVENT_IOC_ID: u32 = 0x8008_2407;
+
+/// 第一版 perf_event_attr 的大小 (PERF_ATTR_SIZE_VER0)
+pub const PERF_ATTR_SIZE_VER0: u32 = 64;
+
+/// perf_event_attr 位域中用到的位
+const ATTR_DISABLED: u64 = 1 << 0;
+const ATTR_EXCLUDE_USER: u64 = 1 << 4;
+const ATTR_EXCLUDE_KERNEL: u64 = 1 << 5;
+const ATTR_FREQ: u64 = 1 << 10;
+const ATTR_ENABLE_ON_EXEC: u64 = 1 << 12;
+
+/// perf_event_attr 的前 48 字节，计数模式只用到这些字段
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default)]
+pub struct PerfEventAttr {
+    pub type_: u32,
+    pub size: u32,
+    pub config: u64,
+    /// sample_period / sample_freq
+    pub sample_period: u64,
+    pub sample_type: u64,
+    pub read_format: u64,
+    /// disabled、inherit、exclude_* 等位域
+    pub flags: u64,
+}
+
+/// 事件源：每个 CPU 上单调增长的计数
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum PerfSource {
+    Hw(HwEvent),
+    PageFaults,
+    ContextSwitches,
+}
+
+const NR_SOURCES: usize = 5;
+
+impl PerfSource {
+    const ALL: [PerfSource; NR_SOURCES] = [
+        PerfSource::Hw(HwEvent::Cycles),
+        PerfSource::Hw(HwEvent::Instructions),
+        PerfSource::Hw(HwEvent::CacheMisses),
+        PerfSource::PageFaults,
+        PerfSource::ContextSwitches,
+    ];
+
+    fn from_attr(type_: u32, config: u64) -> Option<Self> {
+        match (type_, config) {
+            (PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES) => Some(PerfSource::Hw(HwEvent::Cycles)),
+            (PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS) => Some(PerfSource::Hw(HwEvent::Instructions)),
+            (PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES) => Some(PerfSource::Hw(HwEvent::CacheMisses)),
+            (PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS) => Some(PerfSource::PageFaults),
+            (PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES) => Some(PerfSource::ContextSwitches),
+            _ => None,
+        }
+    }
+
+    fn index(self) -> usize {
+        match self {
+            PerfSource::Hw(HwEvent::Cycles) => 0,
+            PerfSource::Hw(HwEvent::Instructions) => 1,
+            PerfSource::Hw(HwEvent::CacheMisses) => 2,
+            PerfSource::PageFaults => 3,
+            PerfSource::ContextSwitches => 4,
+        }
+    }
+}
+
+/// 每个 CPU 的缺页次数 (PERF_COUNT_SW_PAGE_FAULTS)
+static SW_PAGE_FAULTS: [AtomicU64; MAX_CPUS] = [const { AtomicU64::new(0) }; MAX_CPUS];
+
+/// 每个 CPU 最近一次发布的各事件源的值，供其他 CPU 读取
+static PUBLISHED: [[AtomicU64; NR_SOURCES]; MAX_CPUS] =
+    [const { [const { AtomicU64::new(0) }; NR_SOURCES] }; MAX_CPUS];
+
+/// 挂在任务上的事件数，为 0 时任务切换不做任何事 (perf_sched_events)
+static NR_TASK_EVENTS: AtomicUsize = AtomicUsize::new(0);
+
+/// 事件 ID 分配 (perf_event_id)
+static NEXT_ID: AtomicU64 = AtomicU64::new(1);
+
+#[inline]
+fn this_cpu() -> usize {
+    crate::arch::cpu_id() as usize
+}
+
+/// 在本 CPU 上读取事件源的当前值
+fn read_local(source: PerfSource, cpu: usize) -> u64 {
+    match source {
+        PerfSource::Hw(event) => pmu::read_counter(event),
+        PerfSource::PageFaults => SW_PAGE_FAULTS[cpu].load(Ordering::Relaxed),
+        PerfSource::ContextSwitches => crate::sched::stats::nr_context_switches_cpu(cpu),
+    }
+}
+
+/// 读取某个 CPU 上事件源的值：本 CPU 读计数器，其他 CPU 读最近发布的值
+fn read_source(source: PerfSource, cpu: usize) -> u64 {
+    if cpu == this_cpu() {
+        read_local(source, cpu)
+    } else {
+        PUBLISHED[cpu][source.index()].load(Ordering::Relaxed)
+    }
+}
+
+/// 发布本 CPU 各事件源的当前值
+fn publish(cpu: usize) {
+    if cpu >= MAX_CPUS {
+        return;
+    }
+    for source in PerfSource::ALL {
+        PUBLISHED[cpu][source.index()].store(read_local(source, cpu), Ordering::Relaxed);
+    }
+}
+
+/// 事件的计数对象
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+enum PerfTarget {
+    Task(Pid),
+    Cpu(usize),
+}
+
+/// 事件的可变状态，在关中断时持锁访问
+struct PerfState {
+    enabled: bool,
+    /// 计数对象正在其上运行的 CPU：任务事件在切入时设置、切出时清除
+    oncpu: Option<usize>,
+    /// enabled 且 oncpu 时，上次结算时事件源的值
+    snapshot: u64,
+    count: u64,
+    /// 上次更新时间的 sched_clock
+    tstamp: u64,
+    time_enabled: u64,
+    time_running: u64,
+}
+
+impl PerfState {
+    /// 正在计数的 CPU
+    fn counting(&self) -> Option<usize> {
+        if self.enabled { self.oncpu } else { None }
+    }
+
+    /// 累加使能时间与计数时间 (update_event_times)
+    fn update_times(&mut self, now: u64) {
+        let delta = now.saturating_sub(self.tstamp);
+        if self.enabled {
+            self.time_enabled += delta;
+            if self.oncpu.is_some() {
+                self.time_running += delta;
+            }
+        }
+        self.tstamp = now;
+    }
+
+    /// 把快照以来的增量累加进 count，并从当前值重新开始 (perf_event_update)
+    fn fold(&mut self, source: PerfSource) {
+        if let Some(cpu) = self.counting() {
+            let value = read_source(source, cpu);
+            self.count += value.saturating_sub(self.snapshot);
+            self.snapshot = value;
+        }
+    }
+}
+
+/// 一个计数事件 (struct perf_event)
+pub struct PerfEvent {
+    id: u64,
+    source: PerfSource,
+    target: PerfTarget,
+    /// 任务事件只在这个 CPU 上计数，None 表示任意 CPU
+    cpu_filter: Option<usize>,
+    read_format: u64,
+    enable_on_exec: bool,
+    state: Mutex<PerfState>,
+}
+
+impl PerfEvent {
+    fn new(source: PerfSource, target: PerfTarget, cpu_filter: Option<usize>, attr: &PerfEventAttr) -> Self {
+        let enabled = attr.flags & ATTR_DISABLED == 0;
+        let (oncpu, snapshot) = match target {
+            PerfTarget::Cpu(cpu) => (Some(cpu), if enabled { read_source(source, cpu) } else { 0 }),
+            PerfTarget::Task(_) => (None, 0),
+        };
+        Self {
+            id: NEXT_ID.fetch_add(1, Ordering::Relaxed),
+            source,
+            target,
+            cpu_filter,
+            read_format: attr.read_format,
+            enable_on_exec: attr.flags & ATTR_ENABLE_ON_EXEC != 0,
+            state: Mutex::new(PerfState {
+                enabled,
+                oncpu,
+                snapshot,
+                count: 0,
+                tstamp: sched_clock(),
+                time_enabled: 0,
+                time_running: 0,
+            }),
+        }
+    }
+
+    /// 关中断后操作状态；任务切换路径也会持有这把锁
+    fn with_state<R>(&self, f: impl FnOnce(&mut PerfState) -> R) -> R {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        f(&mut self.state.lock())
+    }
+
+    /// 事件 ID (PERF_EVENT_IOC_ID)
+    pub fn id(&self) -> u64 {
+        self.id
+    }
+
+    /// 任务切入 CPU，调用者已关中断 (event_sched_in)
+    fn sched_in(&self, cpu: usize, now: u64) {
+        if self.cpu_filter.map_or(false, |filter| filter != cpu) {
+            return;
+        }
+        let mut state = self.state.lock();
+        state.update_times(now);
+        state.oncpu = Some(cpu);
+        if state.enabled {
+            state.snapshot = read_source(self.source, cpu);
+        }
+    }
+
+    /// 任务切出 CPU，调用者已关中断 (event_sched_out)
+    fn sched_out(&self, now: u64) {
+        let mut state = self.state.lock();
+        state.update_times(now);
+        state.fold(self.source);
+        state.oncpu = None;
+    }
+
+    /// 开始计数 (perf_event_enable)
+    pub fn enable(&self) {
+        let source = self.source;
+        self.with_state(|state| {
+            if state.enabled {
+                return;
+            }
+            state.update_times(sched_clock());
+            state.enabled = true;
+            if let Some(cpu) = state.oncpu {
+                state.snapshot = read_source(source, cpu);
+            }
+        });
+    }
+
+    /// 停止计数，保留已有的计数 (perf_event_disable)
+    pub fn disable(&self) {
+        let source = self.source;
+        self.with_state(|state| {
+            state.update_times(sched_clock());
+            state.fold(source);
+            state.enabled = false;
+        });
+    }
+
+    /// 计数清零 (perf_event_reset)
+    pub fn reset(&self) {
+        let source = self.source;
+        self.with_state(|state| {
+            state.fold(source);
+            state.count = 0;
+        });
+    }
+
+    /// 读取 (计数, 使能时间, 计数时间) (perf_event_read_value)
+    pub fn read_value(&self) -> (u64, u64, u64) {
+        let source = self.source;
+        self.with_state(|state| {
+            state.update_times(sched_clock());
+            state.fold(source);
+            (state.count, state.time_enabled, state.time_running)
+        })
+    }
+
+    /// read 返回的字数：计数加 read_format 选择的字段
+    fn read_words(&self) -> usize {
+        1 + (self.read_format & (PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING | PERF_FORMAT_ID))
+            .count_ones() as usize
+    }
+}
+
+/// 任务上的事件表 (perf_event_context)
+pub struct PerfEventContext {
+    events: Mutex<Vec<Arc<PerfEvent>>>,
+}
+
+impl PerfEventContext {
+    pub const fn new() -> Self {
+        Self { events: Mutex::new(Vec::new()) }
+    }
+}
+
+/// 记一次缺页 (perf_sw_event(PERF_COUNT_SW_PAGE_FAULTS))
+#[inline]
+pub fn perf_sw_page_fault() {
+    let cpu = this_cpu();
+    if cpu < MAX_CPUS {
+        SW_PAGE_FAULTS[cpu].fetch_add(1, Ordering::Relaxed);
+    }
+}
+
+/// 时钟 tick 中发布本 CPU 的计数，其他 CPU 读取时最多滞后一个 tick
+pub fn perf_event_tick() {
+    publish(this_cpu());
+}
+
+/// 任务切换时移交任务事件 (perf_event_task_sched_out / perf_event_task_sched_in)
+///
+/// 在 __schedule 中持有运行队列锁、关中断时调用，此时本 CPU 的上下文切换计数已包含这次切换
+pub fn perf_event_task_switch(cpu: usize, prev: &Task, next: &Task) {
+    if NR_TASK_EVENTS.load(Ordering::Relaxed) == 0 || cpu >= MAX_CPUS {
+        return;
+    }
+    publish(cpu);
+    let now = sched_clock();
+    for event in prev.perf_events.events.lock().iter() {
+        event.sched_out(now);
+    }
+    for event in next.perf_events.events.lock().iter() {
+        event.sched_in(cpu, now);
+    }
+}
+
+/// 任务退出时摘下它的事件 (perf_event_exit_task)
+///
+/// 事件保留退出前的计数，文件关闭前仍然可读
+pub fn perf_event_exit_task(task: &Task) {
+    if NR_TASK_EVENTS.load(Ordering::Relaxed) == 0 {
+        return;
+    }
+    let events = {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        let events = core::mem::take(&mut *task.perf_events.events.lock());
+        let now = sched_clock();
+        for event in events.iter() {
+            event.sched_out(now);
+        }
+        events
+    };
+    NR_TASK_EVENTS.fetch_sub(events.len(), Ordering::Relaxed);
+}
+
+/// execve 时使能带 enable_on_exec 的事件 (perf_event_enable_on_exec)
+pub fn perf_event_enable_on_exec(task: &Task) {
+    if NR_TASK_EVENTS.load(Ordering::Relaxed) == 0 {
+        return;
+    }
+    let events: Vec<Arc<PerfEvent>> = {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        task.perf_events.events.lock().iter().filter(|event| event.enable_on_exec).cloned().collect()
+    };
+    for event in events {
+        event.enable();
+    }
+}
+
+/// 把事件挂到任务上；任务正在运行时立即开始计数 (perf_install_in_context)
+fn attach_task(pid: Pid, event: &Arc<PerfEvent>) -> bool {
+    crate::sched::sched::with_task(pid, |task| {
+        if task.state() == TaskState::Zombie {
+            return false;
+        }
+        NR_TASK_EVENTS.fetch_add(1, Ordering::Relaxed);
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        let mut events = task.perf_events.events.lock();
+        if crate::sched::task_curr(task as *const Task) {
+            event.sched_in(task.cpu(), sched_clock());
+        }
+        events.push(event.clone());
+        true
+    })
+    .unwrap_or(false)
+}
+
+/// 从任务上摘下事件；任务已退出时事件早已摘下
+fn detach_task(pid: Pid, event: &Arc<PerfEvent>) {
+    let removed = crate::sched::sched::with_task(pid, |task| {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        let mut events = task.perf_events.events.lock();
+        let before = events.len();
+        events.retain(|other| !Arc::ptr_eq(other, event));
+        before - events.len()
+    })
+    .unwrap_or(0);
+    NR_TASK_EVENTS.fetch_sub(removed, Ordering::Relaxed);
+}
+
+/// 创建事件 (perf_event_alloc + perf_install_in_context)
+///
+/// # 参数
+/// - pid: 0 为当前任务，大于 0 为指定任务，-1 配合 cpu 表示 CPU 事件
+/// - cpu: -1 为任意 CPU，否则只在该 CPU 上计数
+///
+/// # 返回
+/// 成功返回事件，失败返回负的 errno：
+/// 不认识的事件返回 ENOENT，采样和 exclude_user / exclude_kernel 返回 EOPNOTSUPP
+pub fn perf_event_create(attr: &PerfEventAttr, pid: i32, cpu: i32) -> Result<Arc<PerfEvent>, i32> {
+    let source = PerfSource::from_attr(attr.type_, attr.config)
+        .ok_or(Errno::NoSuchFileOrDirectory.as_neg_i32())?;
+    if attr.sample_period != 0 || attr.flags & ATTR_FREQ != 0 {
+        return Err(Errno::OperationNotSupported.as_neg_i32());
+    }
+    if attr.flags & (ATTR_EXCLUDE_USER | ATTR_EXCLUDE_KERNEL) != 0 {
+        return Err(Errno::OperationNotSupported.as_neg_i32());
+    }
+    let supported_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING | PERF_FORMAT_ID;
+    if attr.read_format & !supported_format != 0 {
+        return Err(Errno::InvalidArgument.as_neg_i32());
+    }
+    if cpu < -1 || cpu >= MAX_CPUS as i32 || pid < -1 || (pid == -1 && cpu == -1) {
+        return Err(Errno::InvalidArgument.as_neg_i32());
+    }
+    let cpu_filter = if cpu >= 0 { Some(cpu as usize) } else { None };
+    if let PerfSource::Hw(event) = source {
+        let supported = match cpu_filter {
+            Some(cpu) => pmu::event_supported(event, cpu),
+            None => (0..MAX_CPUS).any(|cpu| pmu::event_supported(event, cpu)),
+        };
+        if !supported {
+            return Err(Errno::NoSuchFileOrDirectory.as_neg_i32());
+        }
+    }
+
+    if pid == -1 {
+        return Ok(Arc::new(PerfEvent::new(source, PerfTarget::Cpu(cpu as usize), None, attr)));
+    }
+    let pid = if pid == 0 {
+        crate::sched::current().map(|task| task.pid()).unwrap_or(0)
+    } else {
+        pid as Pid
+    };
+    let event = Arc::new(PerfEvent::new(source, PerfTarget::Task(pid), cpu_filter, attr));
+    if !attach_task(pid, &event) {
+        return Err(Errno::NoSuchProcess.as_neg_i32());
+    }
+    Ok(event)
+}
+
+/// 由文件得到事件
+pub fn file_perf_event(file: &File) -> Option<&PerfEvent> {
+    let is_perf = unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &PERF_FOPS));
+    if !is_perf {
+        return None;
+    }
+    unsafe { *file.private_data.get() }.map(|ptr| unsafe { &*(ptr as *const PerfEvent) })
+}
+
+/// 读取计数 (perf_read)
+///
+/// 依次写入计数、使能时间、计数时间与 ID 中 read_format 选中的字段，缓冲区不足返回 ENOSPC
+fn perf_read(file: &File, buf: &mut [u8]) -> isize {
+    let event = match file_perf_event(file) {
+        Some(event) => event,
+        None => return Errno::InvalidArgument.as_neg_i32() as isize,
+    };
+    let size = event.read_words() * 8;
+    if buf.len() < size {
+        return Errno::NoSpaceLeftOnDevice.as_neg_i32() as isize;
+    }
+    let (count, enabled, running) = event.read_value();
+    let mut words = [count, 0, 0, 0];
+    let mut n = 1;
+    if event.read_format & PERF_FORMAT_TOTAL_TIME_ENABLED != 0 {
+        words[n] = enabled;
+        n += 1;
+    }
+    if event.read_format & PERF_FORMAT_TOTAL_TIME_RUNNING != 0 {
+        words[n] = running;
+        n += 1;
+    }
+    if event.read_format & PERF_FORMAT_ID != 0 {
+        words[n] = event.id;
+        n += 1;
+    }
+    for (chunk, word) in buf.chunks_exact_mut(8).zip(words[..n].iter()) {
+        chunk.copy_from_slice(&word.to_ne_bytes());
+    }
+    size as isize
+}
+
+/// 关闭时摘下并释放事件 (perf_release)
+fn perf_release(file: &File) -> i32 {
+    let ptr = match unsafe { (*file.private_data.get()).take() } {
+        Some(ptr) => ptr,
+        None => return -9,  // EBADF
+    };
+    let event = unsafe { Arc::from_raw(ptr as *const PerfEvent) };
+    if let PerfTarget::Task(pid) = event.target {
+        detach_task(pid, &event);
+    }
+    0
+}
+
+static PERF_FOPS: FileOps = FileOps {
+    read: Some(perf_read),
+    write: None,
+    lseek: None,
+    close: Some(perf_release),
+    read_iter: None,
+    write_iter: None,
+    poll: None,
+};
+
+/// 创建事件文件 (perf_event_open 中的 anon_inode_getfile)
+pub fn perf_event_create_file(event: Arc<PerfEvent>) -> Arc<File> {
+    let file = Arc::new(File::new(FileFlags::new(FileFlags::O_RDONLY)));
+    file.set_ops(&PERF_FOPS);
+    file.set_private_data(Arc::into_raw(event) as *mut u8);
+    file
+}
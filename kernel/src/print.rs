@@ -2,21 +2,19 @@
 //!
 //! Copyright (c) 2026 Fei Wang
 //!
+
+//! 内核输出宏
+//!
+//! print! / println! 写入 printk 日志缓冲区，由 printk 决定何时输出到控制台
+
 use core::fmt;
-use crate::console;
 
+/// 以默认级别写入日志的 fmt::Write 适配器，每次 write_str 生成一条日志
 pub struct Console;
 
 impl fmt::Write for Console {
     fn write_str(&mut self, s: &str) -> fmt::Result {
-        // 只获取一次锁，输出整个字符串
-        let uart = console::lock();
-        for b in s.bytes() {
-            if b == b'\n' {
-                uart.putc(b'\r');
-            }
-            uart.putc(b);
-        }
+        crate::printk::printk(crate::printk::LOGLEVEL_DEFAULT, format_args!("{}", s));
         Ok(())
     }
 }
@@ -24,8 +22,7 @@ impl fmt::Write for Console {
 #[macro_export]
 macro_rules! print {
     ($($arg:tt)*) => ({
-        use core::fmt::Write;
-        let _ = write!(&mut $crate::print::Console, $($arg)*);
+        $crate::printk::printk($crate::printk::LOGLEVEL_DEFAULT, ::core::format_args!($($arg)*));
     });
 }
 
@@ -33,9 +30,53 @@ macro_rules! print {
 macro_rules! println {
     () => ($crate::print!("\n"));
     ($($arg:tt)*) => ({
-        let mut _console = $crate::print::Console;
-        let _ = ::core::fmt::Write::write_fmt(&mut _console, ::core::format_args!($($arg)*)).ok();
-        let _ = ::core::fmt::Write::write_str(&mut _console, "\n").ok();
+        $crate::printk::printk(
+            $crate::printk::LOGLEVEL_DEFAULT,
+            ::core::format_args!("{}\n", ::core::format_args!($($arg)*)),
+        );
+    });
+}
+
+/// 按级别写一行日志 (printk(KERN_* ...))
+#[macro_export]
+macro_rules! printk_level {
+    ($level:expr, $($arg:tt)*) => ({
+        $crate::printk::printk($level, ::core::format_args!("{}\n", ::core::format_args!($($arg)*)));
+    });
+}
+
+/// 错误 (pr_err)
+#[macro_export]
+macro_rules! pr_err {
+    ($($arg:tt)*) => ($crate::printk_level!($crate::printk::LOGLEVEL_ERR, $($arg)*));
+}
+
+/// 警告 (pr_warn)
+#[macro_export]
+macro_rules! pr_warn {
+    ($($arg:tt)*) => ($crate::printk_level!($crate::printk::LOGLEVEL_WARNING, $($arg)*));
+}
+
+/// 提示 (pr_info)
+#[macro_export]
+macro_rules! pr_info {
+    ($($arg:tt)*) => ($crate::printk_level!($crate::printk::LOGLEVEL_INFO, $($arg)*));
+}
+
+/// 调试信息，默认不输出到控制台 (pr_debug)
+#[macro_export]
+macro_rules! pr_debug {
+    ($($arg:tt)*) => ($crate::printk_level!($crate::printk::LOGLEVEL_DEBUG, $($arg)*));
+}
+
+/// 只写入日志缓冲区，不在调用者中输出到控制台 (printk_deferred)
+#[macro_export]
+macro_rules! printk_deferred {
+    ($($arg:tt)*) => ({
+        $crate::printk::printk_deferred(
+            $crate::printk::LOGLEVEL_DEFAULT,
+            ::core::format_args!("{}\n", ::core::format_args!($($arg)*)),
+        );
     });
 }
 
@@ -45,9 +86,7 @@ macro_rules! println {
 #[macro_export]
 macro_rules! debug_println {
     ($($arg:tt)*) => ({
-        let mut _console = $crate::print::Console;
-        let _ = ::core::fmt::Write::write_fmt(&mut _console, ::core::format_args!($($arg)*)).ok();
-        let _ = ::core::fmt::Write::write_str(&mut _console, "\n").ok();
+        $crate::println!($($arg)*);
     });
 }
 
@@ -0,0 +1,537 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内核日志缓冲区 (printk)
+//!
+//! 参考 Linux: kernel/printk/printk.c, kernel/printk/printk_ringbuffer.c
+//!
+//! print! / println! 不再直接写 UART，而是把格式化好的文本追加到日志环形缓冲区：
+//! - 描述符环记录每条日志的序号、级别、时间戳和文本位置，文本环保存文本；
+//!   写者用原子 fetch_add 分别预留描述符和文本空间，不加锁，中断中也可以写入
+//! - 描述符的状态字写入前清零、写完置为 `序号 + 1`，读者据此识别写到一半或已被覆盖的日志
+//! - 环满后覆盖最旧的日志，控制台来不及输出的部分报告为丢弃的条数
+//!
+//! 控制台输出 (console_unlock)：写者提交后尝试成为控制台的所有者，成功的 hart 把
+//! 所有 CPU 还没输出的日志写到 UART；其他 hart 发现已有所有者时立即返回，
+//! 由所有者代为输出，不再在 UART 锁上排队。
+//! 启动参数 `printk_async` 让普通日志完全异步：写者只追加，由时钟 tick 和空闲循环输出，
+//! 只有错误级别以上的日志或缓冲区使用超过 3/4 时才在写者中输出。
+//! panic 时忽略所有者直接输出剩余日志 (console_flush_on_panic)。
+//!
+//! 读取：/proc/kmsg 与 syslog(2) 按 `<级别>[秒.微秒] 文本` 的 dmesg 格式返回日志；
+//! 级别高于 console_loglevel 的日志只进入缓冲区，不输出到控制台
+
+use alloc::vec::Vec;
+use core::cell::UnsafeCell;
+use core::fmt;
+use core::fmt::Write;
+use core::sync::atomic::{fence, AtomicBool, AtomicU64, AtomicU8, Ordering};
+use spin::Mutex;
+
+/// 日志级别 (KERN_*)
+pub const LOGLEVEL_EMERG: u8 = 0;
+pub const LOGLEVEL_ALERT: u8 = 1;
+pub const LOGLEVEL_CRIT: u8 = 2;
+pub const LOGLEVEL_ERR: u8 = 3;
+pub const LOGLEVEL_WARNING: u8 = 4;
+pub const LOGLEVEL_NOTICE: u8 = 5;
+pub const LOGLEVEL_INFO: u8 = 6;
+pub const LOGLEVEL_DEBUG: u8 = 7;
+
+/// print! / println! 的级别 (MESSAGE_LOGLEVEL_DEFAULT)
+pub const LOGLEVEL_DEFAULT: u8 = LOGLEVEL_WARNING;
+
+/// 默认的控制台级别：DEBUG 以外都输出 (CONSOLE_LOGLEVEL_DEFAULT)
+pub const CONSOLE_LOGLEVEL_DEFAULT: u8 = 7;
+/// `quiet` 启动参数下的控制台级别 (CONSOLE_LOGLEVEL_QUIET)
+pub const CONSOLE_LOGLEVEL_QUIET: u8 = 4;
+/// CONSOLE_OFF 后的控制台级别 (minimum_console_loglevel)
+pub const CONSOLE_LOGLEVEL_MIN: u8 = 1;
+
+/// 文本环大小 (CONFIG_LOG_BUF_SHIFT = 17)
+pub const LOG_BUF_LEN: usize = 1 << 17;
+/// 描述符数，按平均每条 32 字节估算
+pub const LOG_DESCS: usize = LOG_BUF_LEN / 32;
+/// 单条日志的最大长度，更长的输出拆成多条 (PRINTKRB_RECORD_MAX)
+pub const LOG_LINE_MAX: usize = 512;
+
+/// 日志文本以换行结束，下一条从新行开始
+const LOG_NEWLINE: u8 = 1 << 0;
+
+/// 一条日志的元数据 (struct printk_info)
+#[derive(Clone, Copy)]
+struct LogInfo {
+    ts_nsec: u64,
+    /// 文本在文本环中的起始位置（不取模）
+    text_pos: u64,
+    len: u16,
+    level: u8,
+    flags: u8,
+}
+
+/// 描述符 (struct prb_desc)
+struct LogDesc {
+    /// 0 表示正在写入，否则是写入时的序号 + 1
+    state: AtomicU64,
+    info: UnsafeCell<LogInfo>,
+}
+
+/// 日志环形缓冲区 (struct printk_ringbuffer)
+struct LogBuffer {
+    /// 预留过的日志条数，也是下一条日志的序号
+    head_seq: AtomicU64,
+    /// 预留过的文本字节数
+    text_head: AtomicU64,
+    descs: [LogDesc; LOG_DESCS],
+    text: UnsafeCell<[u8; LOG_BUF_LEN]>,
+}
+
+// 描述符与文本由状态字和位置检查保护，见模块说明
+unsafe impl Sync for LogBuffer {}
+
+static LOG_BUF: LogBuffer = LogBuffer {
+    head_seq: AtomicU64::new(0),
+    text_head: AtomicU64::new(0),
+    descs: [const {
+        LogDesc {
+            state: AtomicU64::new(0),
+            info: UnsafeCell::new(LogInfo { ts_nsec: 0, text_pos: 0, len: 0, level: 0, flags: 0 }),
+        }
+    }; LOG_DESCS],
+    text: UnsafeCell::new([0; LOG_BUF_LEN]),
+};
+
+/// 读出的一条日志 (struct printk_record)
+pub struct LogRecord {
+    pub ts_nsec: u64,
+    pub level: u8,
+    /// 文本以换行结束
+    pub newline: bool,
+    pub text: Vec<u8>,
+}
+
+/// 读取某个序号的结果
+pub enum LogRead {
+    Record(LogRecord),
+    /// 还没有这条日志
+    Empty,
+    /// 已预留但还没写完
+    Pending,
+    /// 描述符或文本已被覆盖
+    Lost,
+}
+
+/// 追加一条日志 (prb_reserve + prb_commit)
+///
+/// 超过 LOG_LINE_MAX 的部分被截断
+pub fn log_store(level: u8, text: &[u8]) {
+    let len = text.len().min(LOG_LINE_MAX);
+    if len == 0 {
+        return;
+    }
+    let text = &text[..len];
+    let seq = LOG_BUF.head_seq.fetch_add(1, Ordering::Relaxed);
+    let pos = LOG_BUF.text_head.fetch_add(len as u64, Ordering::Relaxed);
+    let desc = &LOG_BUF.descs[seq as usize % LOG_DESCS];
+    desc.state.store(0, Ordering::Relaxed);
+    fence(Ordering::Release);
+
+    let ring = LOG_BUF.text.get() as *mut u8;
+    let start = pos as usize % LOG_BUF_LEN;
+    let first = len.min(LOG_BUF_LEN - start);
+    unsafe {
+        core::ptr::copy_nonoverlapping(text.as_ptr(), ring.add(start), first);
+        core::ptr::copy_nonoverlapping(text.as_ptr().add(first), ring, len - first);
+        core::ptr::write_volatile(desc.info.get(), LogInfo {
+            ts_nsec: crate::sched::fair::sched_clock(),
+            text_pos: pos,
+            len: len as u16,
+            level,
+            flags: if text[len - 1] == b'\n' { LOG_NEWLINE } else { 0 },
+        });
+    }
+    desc.state.store(seq + 1, Ordering::Release);
+}
+
+/// 读出一条日志的结果 (prb_read)
+enum RawRead {
+    /// 元数据，文本已复制到调用者的缓冲区
+    Record(LogInfo),
+    Empty,
+    Pending,
+    Lost,
+}
+
+/// 把序号为 seq 的日志文本复制到 buf，不分配内存，控制台和 panic 路径使用
+fn read_raw(seq: u64, buf: &mut [u8; LOG_LINE_MAX]) -> RawRead {
+    if seq >= LOG_BUF.head_seq.load(Ordering::Acquire) {
+        return RawRead::Empty;
+    }
+    let desc = &LOG_BUF.descs[seq as usize % LOG_DESCS];
+    let state = desc.state.load(Ordering::Acquire);
+    if state > seq + 1 {
+        return RawRead::Lost;
+    }
+    if state != seq + 1 {
+        return RawRead::Pending;
+    }
+    let info = unsafe { core::ptr::read_volatile(desc.info.get()) };
+    let len = (info.len as usize).min(LOG_LINE_MAX);
+    let start = info.text_pos as usize % LOG_BUF_LEN;
+    let first = len.min(LOG_BUF_LEN - start);
+    unsafe {
+        let ring = LOG_BUF.text.get() as *const u8;
+        core::ptr::copy_nonoverlapping(ring.add(start), buf.as_mut_ptr(), first);
+        core::ptr::copy_nonoverlapping(ring, buf.as_mut_ptr().add(first), len - first);
+    }
+    fence(Ordering::Acquire);
+    // 复制期间描述符被重用，或文本环已经绕过这条日志
+    if desc.state.load(Ordering::Relaxed) != state
+        || LOG_BUF.text_head.load(Ordering::Relaxed) > info.text_pos + LOG_BUF_LEN as u64
+    {
+        return RawRead::Lost;
+    }
+    RawRead::Record(info)
+}
+
+/// 读取序号为 seq 的日志 (prb_read_valid)
+pub fn log_read(seq: u64) -> LogRead {
+    let mut buf = [0u8; LOG_LINE_MAX];
+    match read_raw(seq, &mut buf) {
+        RawRead::Record(info) => LogRead::Record(LogRecord {
+            ts_nsec: info.ts_nsec,
+            level: info.level,
+            newline: info.flags & LOG_NEWLINE != 0,
+            text: buf[..info.len as usize].to_vec(),
+        }),
+        RawRead::Empty => LogRead::Empty,
+        RawRead::Pending => LogRead::Pending,
+        RawRead::Lost => LogRead::Lost,
+    }
+}
+
+/// 下一条日志的序号
+pub fn log_next_seq() -> u64 {
+    LOG_BUF.head_seq.load(Ordering::Acquire)
+}
+
+/// 还在缓冲区中的最旧日志的序号
+fn log_first_seq() -> u64 {
+    log_next_seq().saturating_sub(LOG_DESCS as u64)
+}
+
+// ============================================================================
+// 控制台输出
+// ============================================================================
+
+/// 控制台下一条要输出的日志 (console_seq)
+static CONSOLE_SEQ: AtomicU64 = AtomicU64::new(0);
+/// 是否有 hart 正在输出 (console_owner)
+static CONSOLE_OWNER: AtomicBool = AtomicBool::new(false);
+/// 级别小于它的日志才输出到控制台 (console_loglevel)
+static CONSOLE_LOGLEVEL: AtomicU8 = AtomicU8::new(CONSOLE_LOGLEVEL_DEFAULT);
+/// CONSOLE_OFF 之前的控制台级别 (saved_console_loglevel)
+static SAVED_CONSOLE_LOGLEVEL: AtomicU8 = AtomicU8::new(0);
+/// 普通日志由 tick 和空闲循环输出
+static PRINTK_ASYNC: AtomicBool = AtomicBool::new(false);
+
+/// 控制台级别
+pub fn console_loglevel() -> u8 {
+    CONSOLE_LOGLEVEL.load(Ordering::Relaxed)
+}
+
+/// 设置控制台级别
+pub fn set_console_loglevel(level: u8) {
+    CONSOLE_LOGLEVEL.store(level, Ordering::Relaxed);
+}
+
+/// 普通日志是否异步输出
+pub fn printk_async() -> bool {
+    PRINTK_ASYNC.load(Ordering::Relaxed)
+}
+
+/// 打开或关闭异步输出
+pub fn set_printk_async(on: bool) {
+    PRINTK_ASYNC.store(on, Ordering::Relaxed);
+}
+
+/// 根据启动参数设置控制台级别与异步输出 (loglevel= / quiet / printk_async)
+pub fn init() {
+    if crate::cmdline::has_param("quiet") {
+        set_console_loglevel(CONSOLE_LOGLEVEL_QUIET);
+    }
+    if let Some(level) = crate::cmdline::get_param("loglevel").and_then(|v| v.parse::<u8>().ok()) {
+        set_console_loglevel(level.clamp(CONSOLE_LOGLEVEL_MIN, 8));
+    }
+    if crate::cmdline::has_param("printk_async") {
+        set_printk_async(true);
+    }
+}
+
+/// 把一条日志写到 UART，换行前补回车；持有 UART 锁只到这条写完
+fn console_emit(text: &[u8], lock: bool) {
+    if lock {
+        let uart = crate::console::lock();
+        for &b in text {
+            if b == b'\n' {
+                uart.putc(b'\r');
+            }
+            uart.putc(b);
+        }
+    } else {
+        for &b in text {
+            if b == b'\n' {
+                crate::console::putchar_no_lock(b'\r');
+            }
+            crate::console::putchar_no_lock(b);
+        }
+    }
+}
+
+/// 输出控制台还没输出的日志，遇到写到一半的日志停止
+fn console_drain(lock: bool) {
+    let mut buf = [0u8; LOG_LINE_MAX];
+    let mut dropped = 0;
+    loop {
+        let seq = CONSOLE_SEQ.load(Ordering::Relaxed);
+        match read_raw(seq, &mut buf) {
+            RawRead::Record(info) => {
+                if dropped != 0 {
+                    let mut line = LineWriter::new(0);
+                    let _ = writeln!(line, "** {} printk messages dropped **", dropped);
+                    console_emit(line.bytes(), lock);
+                    dropped = 0;
+                }
+                if info.level < console_loglevel() {
+                    console_emit(&buf[..info.len as usize], lock);
+                }
+                CONSOLE_SEQ.store(seq + 1, Ordering::Relaxed);
+            }
+            RawRead::Lost => {
+                // 跳到还在缓冲区中的最旧日志
+                let next = (seq + 1).max(log_first_seq());
+                dropped += next - seq;
+                CONSOLE_SEQ.store(next, Ordering::Relaxed);
+            }
+            RawRead::Empty | RawRead::Pending => break,
+        }
+    }
+}
+
+/// 下一条要输出的日志已经写完
+fn console_ready() -> bool {
+    let mut buf = [0u8; LOG_LINE_MAX];
+    matches!(read_raw(CONSOLE_SEQ.load(Ordering::Relaxed), &mut buf), RawRead::Record(_) | RawRead::Lost)
+}
+
+/// 成为控制台所有者并输出所有未输出的日志 (console_unlock)
+///
+/// 已有所有者时立即返回；所有者释放后再检查一次，持有期间提交的日志不会被遗漏
+pub fn console_flush() {
+    loop {
+        if CONSOLE_OWNER.compare_exchange(false, true, Ordering::Acquire, Ordering::Relaxed).is_err() {
+            return;
+        }
+        console_drain(true);
+        CONSOLE_OWNER.store(false, Ordering::Release);
+        if !console_ready() {
+            return;
+        }
+    }
+}
+
+/// 时钟 tick 与空闲循环中输出异步日志
+pub fn printk_tick() {
+    if CONSOLE_SEQ.load(Ordering::Relaxed) < log_next_seq() {
+        console_flush();
+    }
+}
+
+/// panic 时输出剩余日志 (console_flush_on_panic)
+///
+/// 不检查所有者也不获取 UART 锁：持有者可能就是 panic 的 hart
+pub fn console_flush_on_panic() {
+    CONSOLE_OWNER.store(true, Ordering::Relaxed);
+    console_drain(false);
+}
+
+/// 写者是否需要立即输出
+fn flush_now(level: u8) -> bool {
+    if !printk_async() || level <= LOGLEVEL_ERR {
+        return true;
+    }
+    // 来不及输出的日志太多时不再推迟，避免被覆盖
+    let backlog = log_next_seq().saturating_sub(CONSOLE_SEQ.load(Ordering::Relaxed));
+    backlog > (LOG_DESCS * 3 / 4) as u64
+}
+
+// ============================================================================
+// 写入
+// ============================================================================
+
+/// 格式化到栈上的行缓冲，满了就作为一条日志提交
+pub struct LineWriter {
+    level: u8,
+    len: usize,
+    buf: [u8; LOG_LINE_MAX],
+}
+
+impl LineWriter {
+    pub const fn new(level: u8) -> Self {
+        Self { level, len: 0, buf: [0; LOG_LINE_MAX] }
+    }
+
+    fn bytes(&self) -> &[u8] {
+        &self.buf[..self.len]
+    }
+
+    /// 提交缓冲中的文本
+    fn commit(&mut self) {
+        log_store(self.level, &self.buf[..self.len]);
+        self.len = 0;
+    }
+}
+
+impl fmt::Write for LineWriter {
+    fn write_str(&mut self, s: &str) -> fmt::Result {
+        for &b in s.as_bytes() {
+            if self.len == LOG_LINE_MAX {
+                self.commit();
+            }
+            self.buf[self.len] = b;
+            self.len += 1;
+        }
+        Ok(())
+    }
+}
+
+/// 写一条日志 (vprintk_emit)
+///
+/// 一次调用的文本作为一条日志（超过 LOG_LINE_MAX 时拆开），然后按需输出到控制台
+pub fn printk(level: u8, args: fmt::Arguments) {
+    let mut line = LineWriter::new(level);
+    let _ = line.write_fmt(args);
+    line.commit();
+    if flush_now(level) {
+        console_flush();
+    }
+}
+
+/// 只写入缓冲区，由 tick 或下一次 printk 输出 (printk_deferred)
+///
+/// 用于持有运行队列锁等不能等待控制台的路径
+pub fn printk_deferred(level: u8, args: fmt::Arguments) {
+    let mut line = LineWriter::new(level);
+    let _ = line.write_fmt(args);
+    line.commit();
+}
+
+// ============================================================================
+// 读取 (syslog)
+// ============================================================================
+
+/// syslog 与 /proc/kmsg 的读取位置 (syslog_seq)
+static SYSLOG_SEQ: Mutex<u64> = Mutex::new(0);
+/// SYSLOG_ACTION_CLEAR 之后 READ_ALL 的起点 (clear_seq)
+static CLEAR_SEQ: AtomicU64 = AtomicU64::new(0);
+
+/// 按 dmesg 格式追加一条日志：前一条以换行结束时加上 `<级别>[秒.微秒] ` 前缀
+fn format_record(out: &mut Vec<u8>, record: &LogRecord, line_start: bool) {
+    if line_start {
+        let mut prefix = LineWriter::new(0);
+        let usec = record.ts_nsec / 1000;
+        let _ = write!(prefix, "<{}>[{:5}.{:06}] ", record.level, usec / 1_000_000, usec % 1_000_000);
+        out.extend_from_slice(prefix.bytes());
+    }
+    out.extend_from_slice(&record.text);
+}
+
+/// 从 seq 开始格式化日志，最多 max 字节，不拆开单条日志
+///
+/// # 返回
+/// (格式化的文本, 下一条没有读出的日志序号)
+fn format_from(mut seq: u64, max: usize) -> (Vec<u8>, u64) {
+    let mut out = Vec::new();
+    let mut line_start = true;
+    seq = seq.max(log_first_seq());
+    loop {
+        match log_read(seq) {
+            LogRead::Record(record) => {
+                let mut formatted = Vec::new();
+                format_record(&mut formatted, &record, line_start);
+                if out.len() + formatted.len() > max && !out.is_empty() {
+                    break;
+                }
+                out.extend_from_slice(&formatted[..formatted.len().min(max)]);
+                line_start = record.newline;
+                seq += 1;
+            }
+            LogRead::Lost => seq += 1,
+            LogRead::Empty | LogRead::Pending => break,
+        }
+    }
+    (out, seq)
+}
+
+/// 读出上次读取之后的日志并前移读取位置 (SYSLOG_ACTION_READ, /proc/kmsg)
+pub fn syslog_read(max: usize) -> Vec<u8> {
+    let mut pos = SYSLOG_SEQ.lock();
+    let (out, next) = format_from(*pos, max);
+    *pos = next;
+    out
+}
+
+/// 未读日志格式化后的字节数 (SYSLOG_ACTION_SIZE_UNREAD)
+pub fn syslog_unread_size() -> usize {
+    let pos = *SYSLOG_SEQ.lock();
+    format_from(pos, usize::MAX).0.len()
+}
+
+/// 读出缓冲区中最新的、总长不超过 max 字节的日志 (SYSLOG_ACTION_READ_ALL)
+pub fn syslog_read_all(max: usize) -> Vec<u8> {
+    // 从最旧的日志开始，跳过放不下的部分
+    let mut seq = CLEAR_SEQ.load(Ordering::Relaxed).max(log_first_seq());
+    let (all, _) = format_from(seq, usize::MAX);
+    let mut excess = all.len().saturating_sub(max);
+    while excess > 0 {
+        match log_read(seq) {
+            LogRead::Record(record) => {
+                let mut formatted = Vec::new();
+                format_record(&mut formatted, &record, true);
+                excess = excess.saturating_sub(formatted.len());
+            }
+            LogRead::Lost => {}
+            LogRead::Empty | LogRead::Pending => break,
+        }
+        seq += 1;
+    }
+    format_from(seq, max).0
+}
+
+/// 之后的 READ_ALL 只返回新日志 (SYSLOG_ACTION_CLEAR)
+pub fn syslog_clear() {
+    CLEAR_SEQ.store(log_next_seq(), Ordering::Relaxed);
+}
+
+/// 关闭控制台输出，只保留 EMERG 级别 (SYSLOG_ACTION_CONSOLE_OFF)
+pub fn console_off() {
+    if SAVED_CONSOLE_LOGLEVEL.load(Ordering::Relaxed) == 0 {
+        SAVED_CONSOLE_LOGLEVEL.store(console_loglevel(), Ordering::Relaxed);
+    }
+    set_console_loglevel(CONSOLE_LOGLEVEL_MIN);
+}
+
+/// 恢复 CONSOLE_OFF 之前的控制台级别 (SYSLOG_ACTION_CONSOLE_ON)
+pub fn console_on() {
+    let saved = SAVED_CONSOLE_LOGLEVEL.swap(0, Ordering::Relaxed);
+    if saved != 0 {
+        set_console_loglevel(saved);
+    }
+}
+
+/// 生成 /proc/kmsg 内容：上次读取之后的日志
+pub fn generate_kmsg() -> Vec<u8> {
+    syslog_read(LOG_BUF_LEN)
+}
@@ -8,20 +8,68 @@
 //! 本模块实现 fork 系统调用的核心逻辑，参考 Linux kernel/fork.c
 //!
 //! 主要函数:
-//! - `do_fork`: 创建子进程的核心实现
+//! - `do_clone`: 按 clone 标志创建进程或线程的核心实现 (kernel_clone)
+//! - `do_fork`: 不共享任何资源的 do_clone
 //!
 //! 流程 (参考 Linux):
 //! 1. 分配新的 task_struct
 //! 2. 复制父进程的状态 (copy_process)
 //! 3. 复制线程信息 (copy_thread)
-//! 4. 复制地址空间 (copy_mm)
-//! 5. 复制文件描述符表 (copy_files)
-//! 6. 将子进程加入调度队列 (wake_up_process)
+//! 4. 复制或共享地址空间 (copy_mm, CLONE_VM)
+//! 5. 复制或共享文件描述符表 (copy_files, CLONE_FILES)
+//! 6. 共享信号处理 (copy_sighand, CLONE_SIGHAND)
+//! 7. 将子进程加入调度队列 (wake_up_process)
+//! 8. CLONE_VFORK：父进程睡眠到子进程 execve 或退出 (wait_for_vfork_done)
 
-use crate::process::task::{Task, SchedPolicy, Pid};
+use alloc::sync::Arc;
+use core::sync::atomic::{AtomicBool, Ordering};
+use crate::process::task::{Task, TaskState, SchedPolicy, Pid};
+use crate::process::wait::{WaitQueueEntry, WaitQueueHead};
 use crate::fs::FdTable;
 use crate::sched::pid::alloc_pid;
 
+// clone 标志 (include/uapi/linux/sched.h)
+pub const CSIGNAL: u64 = 0x0000_00ff;
+pub const CLONE_VM: u64 = 0x0000_0100;
+pub const CLONE_FS: u64 = 0x0000_0200;
+pub const CLONE_FILES: u64 = 0x0000_0400;
+pub const CLONE_SIGHAND: u64 = 0x0000_0800;
+pub const CLONE_PIDFD: u64 = 0x0000_1000;
+pub const CLONE_PTRACE: u64 = 0x0000_2000;
+pub const CLONE_VFORK: u64 = 0x0000_4000;
+pub const CLONE_PARENT: u64 = 0x0000_8000;
+pub const CLONE_THREAD: u64 = 0x0001_0000;
+pub const CLONE_NEWNS: u64 = 0x0002_0000;
+pub const CLONE_SYSVSEM: u64 = 0x0004_0000;
+pub const CLONE_SETTLS: u64 = 0x0008_0000;
+pub const CLONE_PARENT_SETTID: u64 = 0x0010_0000;
+pub const CLONE_CHILD_CLEARTID: u64 = 0x0020_0000;
+pub const CLONE_DETACHED: u64 = 0x0040_0000;
+pub const CLONE_UNTRACED: u64 = 0x0080_0000;
+pub const CLONE_CHILD_SETTID: u64 = 0x0100_0000;
+/// 命名空间、CLONE_IO 与 clone3 的扩展标志：未实现
+const CLONE_UNSUPPORTED: u64 = CLONE_NEWNS | CLONE_PIDFD | 0xffff_ffff_fe00_0000;
+
+const EINVAL: i32 = -22;
+const ENOMEM: i32 = -12;
+
+/// clone 参数 (kernel_clone_args)
+#[derive(Debug, Clone, Copy, Default)]
+pub struct CloneArgs {
+    /// CLONE_* 标志（不含 CSIGNAL）
+    pub flags: u64,
+    /// 子进程退出时发给父进程的信号
+    pub exit_signal: u32,
+    /// 子进程的用户栈指针，0 表示沿用父进程的 sp
+    pub stack: usize,
+    /// CLONE_SETTLS 的 tp
+    pub tls: usize,
+    /// CLONE_PARENT_SETTID 的写入地址
+    pub parent_tid: usize,
+    /// CLONE_CHILD_SETTID / CLONE_CHILD_CLEARTID 的地址
+    pub child_tid: usize,
+}
+
 /// 创建子进程
 ///
 /// 参考 Linux: kernel/fork.c -> kernel_clone() -> copy_process()
@@ -30,25 +78,129 @@ use crate::sched::pid::alloc_pid;
 /// - Some(pid): 子进程的 PID（在父进程中返回）
 /// - None: 创建失败
 pub fn do_fork() -> Option<Pid> {
+    let args = CloneArgs {
+        exit_signal: crate::signal::Signal::SIGCHLD as u32,
+        ..CloneArgs::default()
+    };
+    do_clone(&args).ok()
+}
+
+/// vfork 完成通知 (struct completion vfork)
+///
+/// 父进程与子进程各持有一个引用：子进程先于父进程返回时，通知仍然有效
+pub struct VforkDone {
+    done: AtomicBool,
+    wait: WaitQueueHead,
+}
+
+impl VforkDone {
+    pub fn new() -> Self {
+        Self { done: AtomicBool::new(false), wait: WaitQueueHead::new() }
+    }
+
+    /// 子进程是否已经 execve 或退出
+    pub fn is_done(&self) -> bool {
+        self.done.load(Ordering::Acquire)
+    }
+}
+
+/// 子进程不再使用父进程的地址空间，唤醒 vfork 的父进程 (complete_vfork_done)
+///
+/// 由 execve（读完参数、释放旧地址空间时）和 do_exit 调用
+pub fn complete_vfork_done(task: &Task) {
+    if let Some(vfork) = task.take_vfork_done() {
+        vfork.done.store(true, Ordering::Release);
+        vfork.wait.wake_up_all();
+    }
+}
+
+/// 睡眠到子进程 execve 或退出 (wait_for_vfork_done)
+///
+/// 不可中断：子进程在父进程的栈和地址空间上运行，父进程提前返回会破坏子进程的状态
+fn wait_for_vfork_done(current: &mut Task, vfork: &VforkDone) {
+    let entry = WaitQueueEntry::new(current as *mut Task, false);
+    vfork.wait.add(&entry);
+    loop {
+        // 先进入睡眠状态再检查，检查之后的唤醒会把状态改回 Running
+        current.set_state(TaskState::Uninterruptible);
+        if vfork.is_done() {
+            break;
+        }
+        crate::sched::schedule();
+        entry.clear_woken();
+    }
+    current.set_state(TaskState::Running);
+    vfork.wait.remove(&entry);
+}
+
+/// 检查 clone 标志组合 (copy_process 开头的检查)
+fn check_clone_flags(flags: u64) -> Result<(), i32> {
+    if flags & CLONE_UNSUPPORTED != 0 {
+        return Err(EINVAL);
+    }
+    // 线程组必须共享信号处理，共享信号处理必须共享地址空间
+    if flags & CLONE_THREAD != 0 && flags & CLONE_SIGHAND == 0 {
+        return Err(EINVAL);
+    }
+    if flags & CLONE_SIGHAND != 0 && flags & CLONE_VM == 0 {
+        return Err(EINVAL);
+    }
+    Ok(())
+}
+
+/// 按 clone 标志创建子进程或线程
+///
+/// 参考 Linux: kernel/fork.c -> kernel_clone() -> copy_process()
+///
+/// CLONE_FS / CLONE_SYSVSEM 没有对应的状态，直接接受；CLONE_VFORK 时父进程睡眠到子进程
+/// execve 或退出，与 CLONE_VM 一起使用时不复制地址空间 (vfork / posix_spawn)
+///
+/// # 返回
+/// - Ok(pid): 子任务的 TID（在父进程中返回）
+/// - Err(errno): 负的错误码
+pub fn do_clone(args: &CloneArgs) -> Result<Pid, i32> {
     use crate::arch::riscv64::trap::{current_trap_frame, TrapFrame};
 
+    let flags = args.flags;
+    check_clone_flags(flags)?;
+
     unsafe {
         // 获取当前任务（父进程）
-        let current = crate::sched::current()?;
+        let current = match crate::sched::current() {
+            Some(c) => c,
+            None => return Err(EINVAL),
+        };
         let current_ptr = current as *mut Task;
 
         // 获取父进程当前的 TrapFrame（在 trap 处理期间保存的）
         let parent_trap_frame = current_trap_frame();
         if parent_trap_frame.is_null() {
-            return None;
+            return Err(EINVAL);
+        }
+
+        // 共享地址空间需要父进程本身有地址空间
+        if flags & CLONE_VM != 0 && !(*current_ptr).has_address_space() {
+            return Err(EINVAL);
         }
 
         // 从调度器分配任务槽位
-        let task_ptr = crate::sched::alloc_task_slot()?;
+        let task_ptr = match crate::sched::alloc_task_slot() {
+            Some(t) => t,
+            None => return Err(ENOMEM),
+        };
         let pid = (*task_ptr).pid();
 
-        // 复制父进程的状态到子进程
-        (*task_ptr).set_parent(current_ptr);
+        // 线程和 CLONE_PARENT 的子进程与调用者是兄弟，父进程是调用者的父进程
+        if flags & (CLONE_PARENT | CLONE_THREAD) != 0 {
+            let parent = (*current_ptr).parent_ptr().unwrap_or(core::ptr::null());
+            (*task_ptr).set_parent(parent);
+        } else {
+            (*task_ptr).set_parent(current_ptr);
+        }
+        if flags & CLONE_THREAD != 0 {
+            (*task_ptr).set_tgid((*current_ptr).tgid());
+        }
+        (*task_ptr).sched_fork(&*current_ptr);
 
         // === copy_thread: 复制 TrapFrame ===
         // 参考 Linux: arch/riscv/kernel/process.c copy_thread()
@@ -89,7 +241,8 @@ pub fn do_fork() -> Option<Pid> {
                 s11: parent_frame.s11,
                 gp: parent_frame.gp,  // 复制全局指针
                 _pad: parent_frame._pad,
-                sstatus: parent_frame.sstatus,
+                // 子任务第一次使用浮点时装载复制来的状态
+                sstatus: parent_frame.sstatus & !crate::arch::riscv64::fpu::SR_FS,
                 sepc: parent_frame.sepc + 4,  // 跳过 ecall 指令
                 stval: parent_frame.stval,
             })
@@ -100,16 +253,17 @@ pub fn do_fork() -> Option<Pid> {
         //   sp+0 = 用户 tp
         //   sp+8 = 用户 sp
         //   sp+16 = TrapFrame
-        use alloc::alloc::{alloc, Layout};
+        // 放在子进程内核栈的顶部 (task_pt_regs)，ret_from_fork 在内核栈上执行
         let trap_frame_size = core::mem::size_of::<TrapFrame>();
-        let total_size = trap_frame_size + 16;
-        let layout = Layout::from_size_align(total_size, 16).expect("Invalid layout");
+        let total_size = (trap_frame_size + 16 + 15) & !15;
 
-        let mem_ptr = alloc(layout);
-        if mem_ptr.is_null() {
-            crate::sched::free_task_slot(task_ptr);
-            return None;
-        }
+        let mem_ptr = match (*task_ptr).get_kernel_stack() {
+            Some(stack_top) => stack_top.sub(total_size),
+            None => {
+                crate::sched::free_task_slot(task_ptr);
+                return Err(ENOMEM);
+            }
+        };
 
         // 将 TrapFrame 复制到偏移 16 处
         let trap_frame_ptr = mem_ptr.add(16) as *mut TrapFrame;
@@ -127,6 +281,10 @@ pub fn do_fork() -> Option<Pid> {
             *user_sp_ptr
         };
 
+        // CLONE_SETTLS 设置新的 tp，指定了栈的子任务从新栈开始
+        let user_tp = if flags & CLONE_SETTLS != 0 { args.tls as u64 } else { user_tp };
+        let user_sp = if args.stack != 0 { args.stack as u64 } else { user_sp };
+
         // 写入用户 tp 和 sp
         {
             let header = mem_ptr as *mut u64;
@@ -152,40 +310,81 @@ pub fn do_fork() -> Option<Pid> {
         // 复制信号掩码
         (*task_ptr).sigmask = (*current_ptr).sigmask;
 
-        // === copy_files: 复制文件描述符表 ===
-        {
-            let child_fdtable: alloc::boxed::Box<FdTable> = alloc::boxed::Box::new(FdTable::new());
+        // oom_score_adj 随 fork 继承，受害者标记不继承
+        let score_adj = (*current_ptr).oom.score_adj.load(core::sync::atomic::Ordering::Relaxed);
+        (*task_ptr).oom.score_adj.store(score_adj, core::sync::atomic::Ordering::Relaxed);
+
+        // 复制浮点状态：先写回父进程寄存器中未保存的修改
+        crate::arch::riscv64::fpu::fpu_flush(current_ptr);
+        (*task_ptr).fpu = (*current_ptr).fpu.fork_copy();
+
+        // === copy_files: 共享或新建文件描述符表 ===
+        if flags & CLONE_FILES != 0 {
+            (*task_ptr).set_fdtable((*current_ptr).share_fdtable());
+        } else {
+            let child_fdtable = Arc::new(FdTable::new());
+            crate::init::init_std_fds_for_task(&child_fdtable);
             (*task_ptr).set_fdtable(Some(child_fdtable));
+        }
 
-            if let Some(fdtable) = (*task_ptr).try_fdtable_mut() {
-                crate::init::init_std_fds_for_task(fdtable);
-            }
+        // === copy_sighand: 共享信号处理 ===
+        if flags & CLONE_SIGHAND != 0 {
+            (*task_ptr).signal = (*current_ptr).signal.clone();
         }
 
-        // === copy_mm: 复制地址空间 (COW) ===
-        let parent_addr_space = (*current_ptr).address_space();
-        if let Some(parent_as) = parent_addr_space {
-            match parent_as.fork() {
-                Ok(child_as) => {
-                    (*task_ptr).set_address_space(Some(child_as));
-                }
-                Err(_) => {
-                    crate::sched::free_task_slot(task_ptr);
-                    return None;
+        // === copy_mm: 共享地址空间 (CLONE_VM) 或复制 (COW) ===
+        if flags & CLONE_VM != 0 {
+            (*task_ptr).set_shared_address_space((*current_ptr).share_address_space());
+        } else {
+            let parent_addr_space = (*current_ptr).address_space();
+            if let Some(parent_as) = parent_addr_space {
+                match parent_as.fork() {
+                    Ok(child_as) => {
+                        (*task_ptr).set_address_space(Some(child_as));
+                    }
+                    Err(_) => {
+                        crate::sched::free_task_slot(task_ptr);
+                        return Err(ENOMEM);
+                    }
                 }
+            } else {
+                crate::sched::free_task_slot(task_ptr);
+                return Err(EINVAL);
             }
-        } else {
-            crate::sched::free_task_slot(task_ptr);
-            return None;
         }
 
         // 复制 brk 值
         let parent_brk = (*current_ptr).get_brk();
         (*task_ptr).set_brk(parent_brk);
 
+        // === TID 地址 ===
+        // 地址已由系统调用层检查；CHILD_SETTID 只在共享地址空间时能从这里写入
+        if flags & CLONE_PARENT_SETTID != 0 && args.parent_tid != 0 {
+            *(args.parent_tid as *mut i32) = pid as i32;
+        }
+        if flags & CLONE_CHILD_SETTID != 0 && flags & CLONE_VM != 0 && args.child_tid != 0 {
+            *(args.child_tid as *mut i32) = pid as i32;
+        }
+        if flags & CLONE_CHILD_CLEARTID != 0 {
+            (*task_ptr).set_clear_child_tid(args.child_tid as *mut i32);
+        }
+
+        // vfork 通知在子任务可以运行之前挂上
+        let vfork = if flags & CLONE_VFORK != 0 {
+            let vfork = Arc::new(VforkDone::new());
+            (*task_ptr).set_vfork_done(vfork.clone());
+            Some(vfork)
+        } else {
+            None
+        };
+
         // 将新任务加入运行队列
         crate::sched::enqueue_task(&mut *task_ptr);
 
-        Some(pid)
+        if let Some(vfork) = vfork {
+            wait_for_vfork_done(&mut *current_ptr, &vfork);
+        }
+
+        Ok(pid)
     }
 }
@@ -0,0 +1,929 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 快速用户空间互斥 (futex)
+//!
+//! 等待者按 futex 键散列到全局的等待桶中。私有 futex 的键是 (地址空间, 虚拟地址)；
+//! 共享映射中的 futex 的键是物理地址，不同进程映射同一页时落到同一个桶。
+//! 桶内等待者按优先级排序，同优先级先进先出 (plist)。
+//!
+//! - FUTEX_WAIT / WAIT_BITSET：在桶锁内比较 *uaddr 与期望值后入队睡眠，
+//!   用户态先改值再 FUTEX_WAKE 时不会丢失唤醒
+//! - FUTEX_REQUEUE / CMP_REQUEUE：唤醒一部分等待者，其余直接移到另一个键，
+//!   条件变量广播时不会惊群
+//! - FUTEX_LOCK_PI / UNLOCK_PI / TRYLOCK_PI：futex 字保存持有者 TID，
+//!   等待者提升持有者的优先级，解锁时把锁直接交给最高优先级的等待者
+//! - 任务退出时处理 robust 列表与 clear_child_tid
+//!
+//! 参考: kernel/futex/core.c, kernel/futex/waitwake.c, kernel/futex/requeue.c,
+//!       kernel/futex/pi.c, Documentation/locking/robust-futex-ABI.rst
+
+use alloc::vec::Vec;
+use core::cell::UnsafeCell;
+use core::ptr;
+use core::sync::atomic::{fence, AtomicBool, AtomicPtr, AtomicU32, AtomicUsize, Ordering};
+use spin::Mutex;
+
+use crate::mm::pagemap::VirtAddr;
+use crate::process::task::{Pid, Task, TaskState};
+use crate::time::hrtimer::{hrtimer_cancel, hrtimer_start, hrtimer_wakeup, Hrtimer, HrtimerMode};
+use crate::time::ktime_get;
+
+const EPERM: i32 = -1;
+const ESRCH: i32 = -3;
+const EINTR: i32 = -4;
+const EAGAIN: i32 = -11;
+const EFAULT: i32 = -14;
+const EINVAL: i32 = -22;
+const EDEADLK: i32 = -35;
+const ENOSYS: i32 = -38;
+const ETIMEDOUT: i32 = -110;
+
+/// futex 操作
+pub const FUTEX_WAIT: i32 = 0;
+pub const FUTEX_WAKE: i32 = 1;
+pub const FUTEX_FD: i32 = 2;
+pub const FUTEX_REQUEUE: i32 = 3;
+pub const FUTEX_CMP_REQUEUE: i32 = 4;
+pub const FUTEX_WAKE_OP: i32 = 5;
+pub const FUTEX_LOCK_PI: i32 = 6;
+pub const FUTEX_UNLOCK_PI: i32 = 7;
+pub const FUTEX_TRYLOCK_PI: i32 = 8;
+pub const FUTEX_WAIT_BITSET: i32 = 9;
+pub const FUTEX_WAKE_BITSET: i32 = 10;
+
+/// 只在本进程内使用，不查找共享映射
+pub const FUTEX_PRIVATE_FLAG: i32 = 128;
+/// 超时按 CLOCK_REALTIME 计算
+pub const FUTEX_CLOCK_REALTIME: i32 = 256;
+pub const FUTEX_CMD_MASK: i32 = !(FUTEX_PRIVATE_FLAG | FUTEX_CLOCK_REALTIME);
+
+/// WAIT_BITSET / WAKE_BITSET 匹配所有等待者
+pub const FUTEX_BITSET_MATCH_ANY: u32 = u32::MAX;
+
+/// PI 与 robust futex 字的位
+pub const FUTEX_WAITERS: u32 = 0x8000_0000;
+pub const FUTEX_OWNER_DIED: u32 = 0x4000_0000;
+pub const FUTEX_TID_MASK: u32 = 0x3fff_ffff;
+
+/// FUTEX_WAKE_OP 的操作与比较
+const FUTEX_OP_SET: u32 = 0;
+const FUTEX_OP_ADD: u32 = 1;
+const FUTEX_OP_OR: u32 = 2;
+const FUTEX_OP_ANDN: u32 = 3;
+const FUTEX_OP_XOR: u32 = 4;
+const FUTEX_OP_OPARG_SHIFT: u32 = 8;
+const FUTEX_OP_CMP_EQ: u32 = 0;
+const FUTEX_OP_CMP_NE: u32 = 1;
+const FUTEX_OP_CMP_LT: u32 = 2;
+const FUTEX_OP_CMP_LE: u32 = 3;
+const FUTEX_OP_CMP_GT: u32 = 4;
+const FUTEX_OP_CMP_GE: u32 = 5;
+
+/// robust 列表最多处理的项数，防止用户构造的环 (ROBUST_LIST_LIMIT)
+const ROBUST_LIST_LIMIT: usize = 2048;
+
+/// sizeof(struct robust_list_head)
+pub const ROBUST_LIST_HEAD_LEN: usize = 24;
+
+const FUTEX_HASHBITS: u32 = 8;
+const FUTEX_HASHSIZE: usize = 1 << FUTEX_HASHBITS;
+const GOLDEN_RATIO_64: u64 = 0x61C8_8646_80B5_83EB;
+
+/// futex 键 (union futex_key)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub struct FutexKey {
+    /// 私有 futex 为地址空间的页表根 PPN，共享 futex 与内核线程为 0
+    space: u64,
+    /// 私有 futex 为虚拟地址，共享 futex 为物理地址
+    addr: u64,
+}
+
+impl FutexKey {
+    /// 散列到等待桶 (hash_futex)
+    #[inline]
+    fn hash(&self) -> usize {
+        let h = (self.addr ^ self.space.rotate_left(32)).wrapping_mul(GOLDEN_RATIO_64);
+        (h >> (64 - FUTEX_HASHBITS)) as usize
+    }
+}
+
+/// 等待者 (struct futex_q)
+///
+/// 放在等待者的栈上，入队期间不能移动。键和所在的桶会被 requeue 改变，
+/// 都由当前所在桶的锁保护；唤醒方把 lock_ptr 置空是最后一次访问
+struct FutexQ {
+    task: *mut Task,
+    /// 入队时的优先级，决定唤醒顺序
+    prio: i32,
+    bitset: u32,
+    /// 是否在等待 PI futex
+    pi: bool,
+    key: UnsafeCell<FutexKey>,
+    /// 所在的桶，离开队列后为空 (lock_ptr)
+    lock_ptr: AtomicPtr<FutexHashBucket>,
+    /// UNLOCK_PI 把锁交给了这个等待者
+    pi_owner: AtomicBool,
+}
+
+impl FutexQ {
+    fn new(task: &Task, key: FutexKey, bitset: u32, pi: bool) -> Self {
+        Self {
+            task: task as *const Task as *mut Task,
+            prio: task.prio(),
+            bitset,
+            pi,
+            key: UnsafeCell::new(key),
+            lock_ptr: AtomicPtr::new(ptr::null_mut()),
+            pi_owner: AtomicBool::new(false),
+        }
+    }
+
+    /// 当前的键，调用者持有所在桶的锁
+    #[inline]
+    unsafe fn key(&self) -> FutexKey {
+        *self.key.get()
+    }
+
+    /// 是否仍在队列中
+    #[inline]
+    fn is_queued(&self) -> bool {
+        !self.lock_ptr.load(Ordering::Acquire).is_null()
+    }
+}
+
+/// 有等待者的 PI futex (struct futex_pi_state)
+struct FutexPiState {
+    key: FutexKey,
+    /// 持有者，用 PID 保存，持有者退出后不会留下悬空指针
+    owner: Pid,
+}
+
+struct FutexBucketInner {
+    /// 等待者，按优先级排序
+    chain: Vec<*const FutexQ>,
+    /// 有等待者的 PI futex
+    pi_states: Vec<FutexPiState>,
+}
+
+// 等待者在入队期间保持有效，只在桶锁内访问
+unsafe impl Send for FutexBucketInner {}
+
+impl FutexBucketInner {
+    /// 按优先级插入，同优先级排在已有等待者之后 (plist_add)
+    fn queue(&mut self, q: &FutexQ) {
+        let pos = self
+            .chain
+            .iter()
+            .position(|&p| unsafe { (*p).prio } > q.prio)
+            .unwrap_or(self.chain.len());
+        self.chain.insert(pos, q);
+    }
+
+    /// 从链上摘下 (plist_del)
+    fn unqueue(&mut self, q: *const FutexQ) -> bool {
+        match self.chain.iter().position(|&p| p == q) {
+            Some(pos) => {
+                self.chain.remove(pos);
+                true
+            }
+            None => false,
+        }
+    }
+
+    /// 键上最高优先级的 PI 等待者 (futex_top_waiter)
+    fn top_pi_waiter(&self, key: &FutexKey) -> Option<usize> {
+        self.chain
+            .iter()
+            .position(|&p| unsafe { (*p).pi && (*p).key() == *key })
+    }
+
+    fn pi_state(&mut self, key: &FutexKey) -> Option<&mut FutexPiState> {
+        self.pi_states.iter_mut().find(|s| s.key == *key)
+    }
+
+    /// 键上已没有 PI 等待者时释放 pi_state (put_pi_state)
+    fn put_pi_state(&mut self, key: &FutexKey) {
+        if self.top_pi_waiter(key).is_none() {
+            self.pi_states.retain(|s| s.key != *key);
+        }
+    }
+}
+
+/// 等待桶 (struct futex_hash_bucket)
+struct FutexHashBucket {
+    /// 入队或即将入队的等待者数量，唤醒方不加锁检查 (futex_hb_waiters_pending)
+    waiters: AtomicUsize,
+    inner: Mutex<FutexBucketInner>,
+}
+
+impl FutexHashBucket {
+    const fn new() -> Self {
+        Self {
+            waiters: AtomicUsize::new(0),
+            inner: Mutex::new(FutexBucketInner {
+                chain: Vec::new(),
+                pi_states: Vec::new(),
+            }),
+        }
+    }
+
+    /// 读取 futex 值之前计数，与唤醒方先改值后检查计数配对
+    #[inline]
+    fn waiters_inc(&self) {
+        self.waiters.fetch_add(1, Ordering::SeqCst);
+    }
+
+    #[inline]
+    fn waiters_dec(&self) {
+        self.waiters.fetch_sub(1, Ordering::SeqCst);
+    }
+
+    #[inline]
+    fn has_waiters(&self) -> bool {
+        fence(Ordering::SeqCst);
+        self.waiters.load(Ordering::Relaxed) != 0
+    }
+
+    #[inline]
+    fn as_ptr(&self) -> *mut FutexHashBucket {
+        self as *const FutexHashBucket as *mut FutexHashBucket
+    }
+}
+
+static FUTEX_QUEUES: [FutexHashBucket; FUTEX_HASHSIZE] = [const { FutexHashBucket::new() }; FUTEX_HASHSIZE];
+
+#[inline]
+fn hash_futex(key: &FutexKey) -> &'static FutexHashBucket {
+    &FUTEX_QUEUES[key.hash()]
+}
+
+/// 计算 futex 键 (get_futex_key)
+///
+/// FUTEX_PRIVATE_FLAG 或私有映射中的 futex 按 (地址空间, 虚拟地址)；共享映射中的
+/// futex 先访问一次让页面就位，再按物理地址。没有地址空间的内核线程直接用
+/// 恒等映射的地址
+///
+/// # 参数
+/// - write: 操作会写 futex 字（PI 与 robust），要求映射可写
+fn get_futex_key(uaddr: usize, flags: i32, write: bool) -> Result<FutexKey, i32> {
+    if uaddr == 0 || uaddr % 4 != 0 {
+        return Err(EINVAL);
+    }
+    let space = match crate::sched::current().and_then(|task| task.address_space()) {
+        Some(space) => space,
+        None => return Ok(FutexKey { space: 0, addr: uaddr as u64 }),
+    };
+    let vma = space.find_vma(VirtAddr::new(uaddr)).ok_or(EFAULT)?;
+    if write && !vma.flags().is_writable() {
+        return Err(EFAULT);
+    }
+    if flags & FUTEX_PRIVATE_FLAG != 0 || !vma.flags().is_shared() {
+        return Ok(FutexKey { space: space.root_ppn(), addr: uaddr as u64 });
+    }
+    unsafe { get_futex_value(uaddr) };
+    let page = space.translate(VirtAddr::new(uaddr)).ok_or(EFAULT)?;
+    Ok(FutexKey { space: 0, addr: (page.as_usize() + (uaddr & 0xfff)) as u64 })
+}
+
+/// 读取 futex 字 (get_futex_value_locked)
+///
+/// # Safety
+/// uaddr 已由 get_futex_key 检查
+#[inline]
+unsafe fn get_futex_value(uaddr: usize) -> u32 {
+    (*(uaddr as *const AtomicU32)).load(Ordering::SeqCst)
+}
+
+/// 比较并交换 futex 字 (futex_cmpxchg_value_locked)
+#[inline]
+unsafe fn cmpxchg_futex_value(uaddr: usize, old: u32, new: u32) -> bool {
+    (*(uaddr as *const AtomicU32))
+        .compare_exchange(old, new, Ordering::SeqCst, Ordering::SeqCst)
+        .is_ok()
+}
+
+/// 唤醒并摘下一个等待者 (futex_wake_mark + wake_up_q)
+///
+/// 调用者持有 hb 的锁；先取出任务指针，置空 lock_ptr 之后不再访问 q
+unsafe fn wake_futex(inner: &mut FutexBucketInner, hb: &FutexHashBucket, pos: usize) {
+    let q = inner.chain.remove(pos);
+    hb.waiters_dec();
+    let task = (*q).task;
+    (*q).lock_ptr.store(ptr::null_mut(), Ordering::Release);
+    crate::sched::wake_up_process(task);
+}
+
+/// 摘下自己 (unqueue_me)
+///
+/// # 返回
+/// true 表示仍在队列中、由自己摘下；false 表示已被唤醒
+fn unqueue_me(q: &FutexQ) -> bool {
+    loop {
+        let lock_ptr = q.lock_ptr.load(Ordering::Acquire);
+        if lock_ptr.is_null() {
+            return false;
+        }
+        let hb = unsafe { &*lock_ptr };
+        let mut inner = hb.inner.lock();
+        // 等锁期间可能被 requeue 到别的桶
+        if q.lock_ptr.load(Ordering::Acquire) != lock_ptr {
+            continue;
+        }
+        inner.unqueue(q);
+        hb.waiters_dec();
+        if q.pi {
+            inner.put_pi_state(unsafe { &q.key() });
+        }
+        q.lock_ptr.store(ptr::null_mut(), Ordering::Release);
+        return true;
+    }
+}
+
+/// 睡眠到被唤醒、超时或有信号 (futex_wait_queue)
+///
+/// 调用前已入队并设置好睡眠状态，入队之后的唤醒会把状态改回 Running
+fn futex_sleep(task: &Task, q: &FutexQ, timer: &Hrtimer, abs_time: Option<u64>) {
+    if let Some(expires) = abs_time {
+        hrtimer_start(timer, expires, HrtimerMode::Abs);
+    }
+    if q.is_queued() && !timed_out(abs_time) && !crate::signal::signal_pending() {
+        crate::sched::schedule();
+    }
+    task.set_state(TaskState::Running);
+    if abs_time.is_some() {
+        hrtimer_cancel(timer);
+    }
+}
+
+#[inline]
+fn timed_out(abs_time: Option<u64>) -> bool {
+    abs_time.map_or(false, |expires| ktime_get() >= expires)
+}
+
+/// 等待 futex (futex_wait)
+///
+/// *uaddr 等于 val 时睡眠，直到被 bitset 有交集的 FUTEX_WAKE 唤醒
+///
+/// # 参数
+/// - abs_time: 绝对的超时时间（单调时钟纳秒），None 表示不超时
+///
+/// # 返回
+/// 被唤醒返回 0；值不等返回 EAGAIN，超时返回 ETIMEDOUT，被信号打断返回 EINTR
+pub fn futex_wait(uaddr: usize, flags: i32, val: u32, abs_time: Option<u64>, bitset: u32) -> i32 {
+    if bitset == 0 {
+        return EINVAL;
+    }
+    let key = match get_futex_key(uaddr, flags, false) {
+        Ok(key) => key,
+        Err(e) => return e,
+    };
+    let task = match crate::sched::current() {
+        Some(task) => task,
+        None => return EINVAL,
+    };
+    let timer = Hrtimer::new(hrtimer_wakeup, task as *mut Task as usize);
+    loop {
+        let q = FutexQ::new(task, key, bitset, false);
+        let hb = hash_futex(&key);
+        {
+            let mut inner = hb.inner.lock();
+            hb.waiters_inc();
+            if unsafe { get_futex_value(uaddr) } != val {
+                hb.waiters_dec();
+                return EAGAIN;
+            }
+            task.set_state(TaskState::Interruptible);
+            inner.queue(&q);
+            q.lock_ptr.store(hb.as_ptr(), Ordering::Release);
+        }
+        futex_sleep(task, &q, &timer, abs_time);
+        if !unqueue_me(&q) {
+            return 0;
+        }
+        if timed_out(abs_time) {
+            return ETIMEDOUT;
+        }
+        if crate::signal::signal_pending() {
+            return EINTR;
+        }
+        // 虚假唤醒，重新比较
+    }
+}
+
+/// 在已加锁的桶中唤醒 key 上最多 nr 个 bitset 匹配的等待者
+///
+/// 与 Linux 相同，nr 不大于 0 时也唤醒一个
+unsafe fn wake_key(inner: &mut FutexBucketInner, hb: &FutexHashBucket, key: &FutexKey, nr: i32, bitset: u32) -> Result<i32, i32> {
+    let mut woken = 0;
+    let mut pos = 0;
+    while pos < inner.chain.len() {
+        let q = inner.chain[pos];
+        if (*q).key() != *key {
+            pos += 1;
+            continue;
+        }
+        if (*q).pi {
+            return Err(EINVAL);
+        }
+        if (*q).bitset & bitset == 0 {
+            pos += 1;
+            continue;
+        }
+        wake_futex(inner, hb, pos);
+        woken += 1;
+        if woken >= nr {
+            break;
+        }
+    }
+    Ok(woken)
+}
+
+/// 唤醒等待者 (futex_wake)
+///
+/// # 返回
+/// 唤醒的等待者数量；key 上有 PI 等待者返回 EINVAL
+pub fn futex_wake(uaddr: usize, flags: i32, nr: i32, bitset: u32) -> i32 {
+    if bitset == 0 {
+        return EINVAL;
+    }
+    let key = match get_futex_key(uaddr, flags, false) {
+        Ok(key) => key,
+        Err(e) => return e,
+    };
+    let hb = hash_futex(&key);
+    if !hb.has_waiters() {
+        return 0;
+    }
+    let mut inner = hb.inner.lock();
+    match unsafe { wake_key(&mut inner, hb, &key, nr, bitset) } {
+        Ok(woken) => woken,
+        Err(e) => e,
+    }
+}
+
+/// 按地址顺序锁住两个桶 (double_lock_hb)
+///
+/// 两个键落在同一个桶时 f 的第二个参数为 None
+fn with_double_lock<R>(
+    hb1: &FutexHashBucket,
+    hb2: &FutexHashBucket,
+    f: impl FnOnce(&mut FutexBucketInner, Option<&mut FutexBucketInner>) -> R,
+) -> R {
+    if ptr::eq(hb1, hb2) {
+        return f(&mut hb1.inner.lock(), None);
+    }
+    if (hb1 as *const FutexHashBucket) < (hb2 as *const FutexHashBucket) {
+        let mut g1 = hb1.inner.lock();
+        let mut g2 = hb2.inner.lock();
+        f(&mut g1, Some(&mut *g2))
+    } else {
+        let mut g2 = hb2.inner.lock();
+        let mut g1 = hb1.inner.lock();
+        f(&mut g1, Some(&mut *g2))
+    }
+}
+
+/// 唤醒 nr_wake 个等待者，再把最多 nr_requeue 个移到 uaddr2 (futex_requeue)
+///
+/// # 参数
+/// - cmpval: FUTEX_CMP_REQUEUE 的期望值，*uaddr 不等时返回 EAGAIN
+///
+/// # 返回
+/// 唤醒与移动的等待者总数
+pub fn futex_requeue(uaddr: usize, flags: i32, uaddr2: usize, nr_wake: i32, nr_requeue: i32, cmpval: Option<u32>) -> i32 {
+    if nr_wake < 0 || nr_requeue < 0 {
+        return EINVAL;
+    }
+    let key1 = match get_futex_key(uaddr, flags, false) {
+        Ok(key) => key,
+        Err(e) => return e,
+    };
+    let key2 = match get_futex_key(uaddr2, flags, false) {
+        Ok(key) => key,
+        Err(e) => return e,
+    };
+    let hb1 = hash_futex(&key1);
+    let hb2 = hash_futex(&key2);
+    if cmpval.is_none() && !hb1.has_waiters() {
+        return 0;
+    }
+    with_double_lock(hb1, hb2, |inner1, inner2| unsafe {
+        if let Some(cmpval) = cmpval {
+            if get_futex_value(uaddr) != cmpval {
+                return EAGAIN;
+            }
+        }
+        let mut woken = 0;
+        let mut moved = Vec::new();
+        let mut pos = 0;
+        while pos < inner1.chain.len() {
+            let q = inner1.chain[pos];
+            if (*q).key() != key1 {
+                pos += 1;
+                continue;
+            }
+            if (*q).pi {
+                return EINVAL;
+            }
+            if woken < nr_wake {
+                wake_futex(inner1, hb1, pos);
+                woken += 1;
+            } else if (moved.len() as i32) < nr_requeue {
+                inner1.chain.remove(pos);
+                hb1.waiters_dec();
+                moved.push(q);
+            } else {
+                break;
+            }
+        }
+        // 同一个键的 requeue 只是轮转，移动的等待者排回同优先级的末尾
+        let target = match inner2 {
+            Some(inner2) => inner2,
+            None => inner1,
+        };
+        for &q in moved.iter() {
+            *(*q).key.get() = key2;
+            hb2.waiters_inc();
+            target.queue(&*q);
+            (*q).lock_ptr.store(hb2.as_ptr(), Ordering::Release);
+        }
+        woken + moved.len() as i32
+    })
+}
+
+/// 按 FUTEX_WAKE_OP 的编码修改 *uaddr 并比较旧值 (futex_atomic_op_inuser)
+///
+/// # 返回
+/// 比较结果；编码无效返回 ENOSYS
+unsafe fn futex_atomic_op(encoded: u32, uaddr: usize) -> Result<bool, i32> {
+    let op = (encoded >> 28) & 7;
+    let cmp = (encoded >> 24) & 15;
+    let mut oparg = ((encoded << 8) as i32 >> 20) as u32;
+    let cmparg = ((encoded << 20) as i32) >> 20;
+    if (encoded >> 28) & FUTEX_OP_OPARG_SHIFT != 0 {
+        oparg = 1u32.wrapping_shl(oparg & 31);
+    }
+    let word = &*(uaddr as *const AtomicU32);
+    let old = match op {
+        FUTEX_OP_SET => word.swap(oparg, Ordering::SeqCst),
+        FUTEX_OP_ADD => word.fetch_add(oparg, Ordering::SeqCst),
+        FUTEX_OP_OR => word.fetch_or(oparg, Ordering::SeqCst),
+        FUTEX_OP_ANDN => word.fetch_and(!oparg, Ordering::SeqCst),
+        FUTEX_OP_XOR => word.fetch_xor(oparg, Ordering::SeqCst),
+        _ => return Err(ENOSYS),
+    } as i32;
+    match cmp {
+        FUTEX_OP_CMP_EQ => Ok(old == cmparg),
+        FUTEX_OP_CMP_NE => Ok(old != cmparg),
+        FUTEX_OP_CMP_LT => Ok(old < cmparg),
+        FUTEX_OP_CMP_LE => Ok(old <= cmparg),
+        FUTEX_OP_CMP_GT => Ok(old > cmparg),
+        FUTEX_OP_CMP_GE => Ok(old >= cmparg),
+        _ => Err(ENOSYS),
+    }
+}
+
+/// 修改 uaddr2 后唤醒 uaddr 上的等待者，比较成立时再唤醒 uaddr2 上的 (futex_wake_op)
+///
+/// # 返回
+/// 两个键上唤醒的等待者总数
+pub fn futex_wake_op(uaddr: usize, flags: i32, uaddr2: usize, nr_wake: i32, nr_wake2: i32, encoded: u32) -> i32 {
+    let key1 = match get_futex_key(uaddr, flags, false) {
+        Ok(key) => key,
+        Err(e) => return e,
+    };
+    let key2 = match get_futex_key(uaddr2, flags, true) {
+        Ok(key) => key,
+        Err(e) => return e,
+    };
+    let hb1 = hash_futex(&key1);
+    let hb2 = hash_futex(&key2);
+    with_double_lock(hb1, hb2, |inner1, inner2| unsafe {
+        let cond = match futex_atomic_op(encoded, uaddr2) {
+            Ok(cond) => cond,
+            Err(e) => return e,
+        };
+        let mut woken = match wake_key(inner1, hb1, &key1, nr_wake, FUTEX_BITSET_MATCH_ANY) {
+            Ok(woken) => woken,
+            Err(e) => return e,
+        };
+        if cond {
+            let inner2 = match inner2 {
+                Some(inner2) => inner2,
+                None => inner1,
+            };
+            match wake_key(inner2, hb2, &key2, nr_wake2, FUTEX_BITSET_MATCH_ANY) {
+                Ok(n) => woken += n,
+                Err(e) => return e,
+            }
+        }
+        woken
+    })
+}
+
+/// 提升 PI futex 持有者的优先级 (rt_mutex_adjust_prio_chain)
+///
+/// 只提升直接持有者，持有者自己阻塞在其他 PI futex 上时不沿链传递
+fn pi_boost(owner: Pid, prio: i32) {
+    let task = unsafe { crate::sched::find_task_by_pid(owner) };
+    if !task.is_null() && prio < unsafe { (*task).prio() } {
+        crate::sched::rt_mutex_setprio(task, prio);
+    }
+}
+
+/// 重新计算持有者的优先级 (rt_mutex_adjust_prio)
+///
+/// 取本身的优先级和它持有的 PI futex 上最高优先级等待者中较高者；
+/// 没有被提升过时直接返回，不遍历等待桶
+fn pi_adjust_prio(owner: Pid) {
+    let task = unsafe { crate::sched::find_task_by_pid(owner) };
+    if task.is_null() {
+        return;
+    }
+    let normal = unsafe { (*task).normal_prio() };
+    if unsafe { (*task).prio() } == normal {
+        return;
+    }
+    let mut prio = normal;
+    for hb in FUTEX_QUEUES.iter() {
+        if !hb.has_waiters() {
+            continue;
+        }
+        let inner = hb.inner.lock();
+        for state in inner.pi_states.iter().filter(|s| s.owner == owner) {
+            if let Some(pos) = inner.top_pi_waiter(&state.key) {
+                prio = prio.min(unsafe { (*inner.chain[pos]).prio });
+            }
+        }
+    }
+    crate::sched::rt_mutex_setprio(task, prio);
+}
+
+/// 获取 PI futex (futex_lock_pi)
+///
+/// futex 字为 0（或只有 OWNER_DIED）时写入自己的 TID；否则设置 FUTEX_WAITERS，
+/// 提升持有者的优先级后睡眠，直到 UNLOCK_PI 把锁交过来
+///
+/// # 参数
+/// - abs_time: 绝对的超时时间（纳秒），None 表示不超时
+/// - trylock: FUTEX_TRYLOCK_PI，锁被持有时返回 EAGAIN
+///
+/// # 返回
+/// 获得锁返回 0；已持有返回 EDEADLK，持有者不存在返回 ESRCH
+pub fn futex_lock_pi(uaddr: usize, flags: i32, abs_time: Option<u64>, trylock: bool) -> i32 {
+    let key = match get_futex_key(uaddr, flags, true) {
+        Ok(key) => key,
+        Err(e) => return e,
+    };
+    let task = match crate::sched::current() {
+        Some(task) => task,
+        None => return EINVAL,
+    };
+    let tid = task.pid() & FUTEX_TID_MASK;
+    let timer = Hrtimer::new(hrtimer_wakeup, task as *mut Task as usize);
+    let hb = hash_futex(&key);
+    loop {
+        let q = FutexQ::new(task, key, FUTEX_BITSET_MATCH_ANY, true);
+        let owner = {
+            let mut inner = hb.inner.lock();
+            let uval = unsafe { get_futex_value(uaddr) };
+            let owner = uval & FUTEX_TID_MASK;
+            if owner == tid {
+                return EDEADLK;
+            }
+            if owner == 0 {
+                // 空闲，或持有者退出时 robust 处理清掉了 TID
+                let top = inner.top_pi_waiter(&key).map(|pos| unsafe { (*inner.chain[pos]).prio });
+                let waiters = if top.is_some() { FUTEX_WAITERS } else { 0 };
+                if !unsafe { cmpxchg_futex_value(uaddr, uval, tid | (uval & FUTEX_OWNER_DIED) | waiters) } {
+                    continue;
+                }
+                if let Some(state) = inner.pi_state(&key) {
+                    state.owner = tid;
+                }
+                drop(inner);
+                if let Some(prio) = top {
+                    pi_boost(tid, prio);
+                }
+                return 0;
+            }
+            if trylock {
+                return EAGAIN;
+            }
+            let owner_task = unsafe { crate::sched::find_task_by_pid(owner) };
+            if owner_task.is_null() || unsafe { (*owner_task).state() } == TaskState::Zombie {
+                return ESRCH;
+            }
+            // 持有者在用户态解锁会失败，转而调用 FUTEX_UNLOCK_PI
+            if uval & FUTEX_WAITERS == 0 && !unsafe { cmpxchg_futex_value(uaddr, uval, uval | FUTEX_WAITERS) } {
+                continue;
+            }
+            match inner.pi_state(&key) {
+                Some(state) => state.owner = owner,
+                None => inner.pi_states.push(FutexPiState { key, owner }),
+            }
+            hb.waiters_inc();
+            task.set_state(TaskState::Interruptible);
+            inner.queue(&q);
+            q.lock_ptr.store(hb.as_ptr(), Ordering::Release);
+            owner
+        };
+        pi_boost(owner, q.prio);
+        futex_sleep(task, &q, &timer, abs_time);
+        if !unqueue_me(&q) {
+            if q.pi_owner.load(Ordering::Acquire) {
+                return 0;
+            }
+            // 持有者退出后被唤醒，重新竞争
+            continue;
+        }
+        pi_adjust_prio(owner);
+        if timed_out(abs_time) {
+            return ETIMEDOUT;
+        }
+        if crate::signal::signal_pending() {
+            return EINTR;
+        }
+    }
+}
+
+/// 释放 PI futex (futex_unlock_pi)
+///
+/// 有等待者时把锁交给最高优先级的等待者：futex 字改为它的 TID，
+/// 还有其他等待者时保留 FUTEX_WAITERS；否则清零
+///
+/// # 返回
+/// 成功返回 0；调用者不是持有者返回 EPERM
+pub fn futex_unlock_pi(uaddr: usize, flags: i32) -> i32 {
+    let key = match get_futex_key(uaddr, flags, true) {
+        Ok(key) => key,
+        Err(e) => return e,
+    };
+    let tid = match crate::sched::current() {
+        Some(task) => task.pid() & FUTEX_TID_MASK,
+        None => return EINVAL,
+    };
+    let hb = hash_futex(&key);
+    loop {
+        let mut inner = hb.inner.lock();
+        let uval = unsafe { get_futex_value(uaddr) };
+        if uval & FUTEX_TID_MASK != tid {
+            return EPERM;
+        }
+        let pos = match inner.top_pi_waiter(&key) {
+            Some(pos) => pos,
+            None => {
+                if !unsafe { cmpxchg_futex_value(uaddr, uval, 0) } {
+                    continue;
+                }
+                inner.pi_states.retain(|s| s.key != key);
+                drop(inner);
+                pi_adjust_prio(tid);
+                return 0;
+            }
+        };
+        let q = inner.chain[pos];
+        let new_owner = unsafe { (*(*q).task).pid() } & FUTEX_TID_MASK;
+        let next = inner.chain[pos + 1..]
+            .iter()
+            .find(|&&p| unsafe { (*p).pi && (*p).key() == key })
+            .map(|&p| unsafe { (*p).prio });
+        let waiters = if next.is_some() { FUTEX_WAITERS } else { 0 };
+        if !unsafe { cmpxchg_futex_value(uaddr, uval, new_owner | waiters) } {
+            continue;
+        }
+        unsafe {
+            (*q).pi_owner.store(true, Ordering::Release);
+            wake_futex(&mut inner, hb, pos);
+        }
+        match next {
+            Some(_) => {
+                if let Some(state) = inner.pi_state(&key) {
+                    state.owner = new_owner;
+                }
+            }
+            None => inner.pi_states.retain(|s| s.key != key),
+        }
+        drop(inner);
+        pi_adjust_prio(tid);
+        if let Some(prio) = next {
+            pi_boost(new_owner, prio);
+        }
+        return 0;
+    }
+}
+
+/// 唤醒 PI futex 上最高优先级的等待者重新竞争，不转交锁
+fn futex_wake_pi_retry(uaddr: usize) {
+    let key = match get_futex_key(uaddr, 0, false) {
+        Ok(key) => key,
+        Err(_) => return,
+    };
+    let hb = hash_futex(&key);
+    let mut inner = hb.inner.lock();
+    if let Some(pos) = inner.top_pi_waiter(&key) {
+        unsafe { wake_futex(&mut inner, hb, pos) };
+        inner.put_pi_state(&key);
+    }
+}
+
+/// 持有者退出时释放 robust futex (handle_futex_death)
+///
+/// futex 字的 TID 是退出的任务时改为 OWNER_DIED，保留 FUTEX_WAITERS 并唤醒
+/// 一个等待者，由它获得锁后从 OWNER_DIED 得知需要恢复数据一致性
+///
+/// # 返回
+/// futex 字无效返回 EFAULT
+pub fn handle_futex_death(uaddr: usize, tid: Pid, pi: bool) -> i32 {
+    if get_futex_key(uaddr, 0, true).is_err() {
+        return EFAULT;
+    }
+    loop {
+        let uval = unsafe { get_futex_value(uaddr) };
+        if uval & FUTEX_TID_MASK != tid & FUTEX_TID_MASK {
+            return 0;
+        }
+        let mval = (uval & FUTEX_WAITERS) | FUTEX_OWNER_DIED;
+        if !unsafe { cmpxchg_futex_value(uaddr, uval, mval) } {
+            continue;
+        }
+        if uval & FUTEX_WAITERS != 0 {
+            if pi {
+                futex_wake_pi_retry(uaddr);
+            } else {
+                futex_wake(uaddr, 0, 1, FUTEX_BITSET_MATCH_ANY);
+            }
+        }
+        return 0;
+    }
+}
+
+/// 读取 robust 列表中的一个字 (get_user)
+fn get_robust_word(addr: usize) -> Option<usize> {
+    if addr % 8 != 0 || get_futex_key(addr, 0, false).is_err() {
+        return None;
+    }
+    Some(unsafe { ptr::read_volatile(addr as *const usize) })
+}
+
+/// 读取 robust 列表中的一个指针，最低位表示 PI futex (fetch_robust_entry)
+fn fetch_robust_entry(addr: usize) -> Option<(usize, bool)> {
+    get_robust_word(addr).map(|entry| (entry & !1, entry & 1 != 0))
+}
+
+/// 遍历退出任务的 robust 列表 (exit_robust_list)
+///
+/// struct robust_list_head { list, futex_offset, list_op_pending }；
+/// list_op_pending 是正在加锁或解锁、可能还未链入的项，最后单独处理
+fn exit_robust_list(head: usize, tid: Pid) {
+    let (mut entry, mut pi) = match fetch_robust_entry(head) {
+        Some(e) => e,
+        None => return,
+    };
+    let futex_offset = match get_robust_word(head + 8) {
+        Some(offset) => offset,
+        None => return,
+    };
+    let (pending, pending_pi) = fetch_robust_entry(head + 16).unwrap_or((0, false));
+
+    let mut limit = ROBUST_LIST_LIMIT;
+    while entry != head && entry != 0 && limit > 0 {
+        // 先取下一项：唤醒的等待者可能立即释放当前项
+        let next = fetch_robust_entry(entry);
+        if entry != pending {
+            handle_futex_death(entry.wrapping_add(futex_offset), tid, pi);
+        }
+        match next {
+            Some((n, npi)) => {
+                entry = n;
+                pi = npi;
+            }
+            None => return,
+        }
+        limit -= 1;
+    }
+    if pending != 0 {
+        handle_futex_death(pending.wrapping_add(futex_offset), tid, pending_pi);
+    }
+}
+
+/// 任务退出时的 futex 清理 (futex_exit_release + mm_release)
+///
+/// 释放 robust 列表上仍持有的锁；清零 clear_child_tid 并唤醒等待它的
+/// pthread_join。必须在退出任务自己的地址空间中、获取运行队列锁之前调用
+pub fn futex_exit(task: &mut Task) {
+    let head = task.robust_list_head() as usize;
+    if head != 0 && task.robust_list_len() == ROBUST_LIST_HEAD_LEN {
+        exit_robust_list(head, task.pid());
+    }
+    task.set_robust_list(ptr::null(), 0);
+
+    let tidptr = task.clear_child_tid() as usize;
+    task.set_clear_child_tid(ptr::null_mut());
+    if tidptr != 0 && get_futex_key(tidptr, 0, true).is_ok() {
+        unsafe { (*(tidptr as *const AtomicU32)).store(0, Ordering::SeqCst) };
+        futex_wake(tidptr, 0, 1, FUTEX_BITSET_MATCH_ANY);
+    }
+}
@@ -0,0 +1,229 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内核栈分配 (alloc_thread_stack_node)
+//!
+//! 内核栈映射在专用的内核栈区域 (CONFIG_VMAP_STACK)：每个槽位 64KB，
+//! 高 32KB 是栈，低 32KB 不建立映射作为保护页，栈溢出时触发缺页异常，
+//! 而不是悄悄改写相邻的堆对象。
+//!
+//! 任务回收后内核栈先放入本 CPU 的缓存 (cached_stacks)，下一次 fork
+//! 直接取用，不清零、不重新映射。缓存已满时解除映射、归还物理页；
+//! 槽位的虚拟地址在再次映射前刷新所有 CPU 的 TLB。
+//!
+//! 只有新分配的栈清零，释放时从栈底向上找到第一个非零字，得到该栈用过的
+//! 最大深度 (stack_not_used)，全局最大值由 /proc/kstackinfo 导出。
+
+use alloc::alloc::{alloc, dealloc};
+use alloc::string::String;
+use core::alloc::Layout;
+use core::fmt::Write;
+use core::ptr;
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+use crate::arch::riscv64::mm::{vmap_stack, vmap_stack_pages, vunmap_stack_pages, PAGE_SIZE};
+use crate::config::MAX_CPUS;
+use crate::sync::TicketLock;
+
+/// 内核栈大小 (THREAD_SIZE，32KB = 8 个页面)
+pub const KERNEL_STACK_SIZE: usize = 32768;
+
+/// 槽位大小：保护页 + 栈
+const SLOT_SIZE: usize = 2 * KERNEL_STACK_SIZE;
+
+/// 内核栈区域的槽位数
+const NR_SLOTS: usize = vmap_stack::SIZE as usize / SLOT_SIZE;
+
+const SLOT_WORDS: usize = (NR_SLOTS + 63) / 64;
+
+/// 每个 CPU 缓存的空闲内核栈数 (NR_CACHED_STACKS)
+const NR_CACHED_STACKS: usize = 2;
+
+/// 内核栈区域的槽位分配状态
+struct StackArea {
+    /// 置位表示槽位已映射（正在使用或在 CPU 缓存中）
+    used: [u64; SLOT_WORDS],
+    /// 置位表示槽位曾解除映射，其他 CPU 可能还缓存着旧的 TLB 项
+    stale: [u64; SLOT_WORDS],
+    /// 各槽位的物理页起始地址
+    phys: [usize; NR_SLOTS],
+}
+
+static STACK_AREA: TicketLock<StackArea> = TicketLock::new(StackArea {
+    used: [0; SLOT_WORDS],
+    stale: [0; SLOT_WORDS],
+    phys: [0; NR_SLOTS],
+});
+
+/// 各 CPU 缓存的空闲内核栈（栈底地址），只由本 CPU 在关中断时访问 (cached_stacks)
+static mut CACHED_STACKS: [[usize; NR_CACHED_STACKS]; MAX_CPUS] = [[0; NR_CACHED_STACKS]; MAX_CPUS];
+
+/// 已映射的内核栈数（包括缓存中的）
+static NR_STACKS: AtomicUsize = AtomicUsize::new(0);
+
+/// 回收过的栈用过的最大深度（字节）
+static MAX_STACK_USED: AtomicUsize = AtomicUsize::new(0);
+
+fn stack_layout() -> Layout {
+    // 大小和对齐都是常量，不会失败
+    Layout::from_size_align(KERNEL_STACK_SIZE, PAGE_SIZE as usize).unwrap()
+}
+
+/// 槽位的栈底地址（保护页之上）
+fn slot_stack_bottom(slot: usize) -> usize {
+    vmap_stack::START as usize + slot * SLOT_SIZE + KERNEL_STACK_SIZE
+}
+
+/// 从本 CPU 的缓存取一个内核栈
+fn take_cached_stack() -> Option<usize> {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let cpu = crate::arch::cpu_id() as usize % MAX_CPUS;
+    let cache = unsafe { &mut *ptr::addr_of_mut!(CACHED_STACKS[cpu]) };
+    cache.iter_mut()
+        .find(|stack| **stack != 0)
+        .map(|stack| core::mem::replace(stack, 0))
+}
+
+/// 把内核栈放回本 CPU 的缓存，缓存已满时返回 false
+fn put_cached_stack(stack_bottom: usize) -> bool {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let cpu = crate::arch::cpu_id() as usize % MAX_CPUS;
+    let cache = unsafe { &mut *ptr::addr_of_mut!(CACHED_STACKS[cpu]) };
+    match cache.iter_mut().find(|stack| **stack == 0) {
+        Some(slot) => {
+            *slot = stack_bottom;
+            true
+        }
+        None => false,
+    }
+}
+
+/// 分配一个新的内核栈：取空闲槽位，映射清零后的物理页
+fn map_new_stack() -> Option<usize> {
+    let phys = unsafe { alloc(stack_layout()) };
+    if phys.is_null() {
+        return None;
+    }
+    // 只有第一次使用时清零
+    unsafe { ptr::write_bytes(phys, 0, KERNEL_STACK_SIZE) };
+
+    let (slot, stale) = {
+        let mut area = STACK_AREA.lock_irqsave();
+        let slot = match crate::fs::file::find_next_zero_bit(&area.used, NR_SLOTS, 0) {
+            Some(slot) => slot,
+            None => {
+                drop(area);
+                unsafe { dealloc(phys, stack_layout()) };
+                return None;
+            }
+        };
+        let mask = 1u64 << (slot % 64);
+        let stale = area.stale[slot / 64] & mask != 0;
+        area.used[slot / 64] |= mask;
+        area.stale[slot / 64] &= !mask;
+        area.phys[slot] = phys as usize;
+        (slot, stale)
+    };
+
+    // 槽位以前映射过其他物理页：先让所有 CPU 丢弃旧的 TLB 项 (vm_unmap_aliases)
+    if stale {
+        crate::arch::riscv64::tlb::flush_tlb_all();
+    }
+
+    let bottom = slot_stack_bottom(slot);
+    {
+        let _area = STACK_AREA.lock_irqsave();
+        unsafe { vmap_stack_pages(bottom as u64, phys as u64, KERNEL_STACK_SIZE as u64) };
+    }
+    NR_STACKS.fetch_add(1, Ordering::Relaxed);
+    Some(bottom)
+}
+
+/// 解除内核栈的映射并归还物理页
+///
+/// 可以在中断上下文调用，不刷新其他 CPU 的 TLB
+fn unmap_stack(stack_bottom: usize) {
+    let slot = (stack_bottom - vmap_stack::START as usize) / SLOT_SIZE;
+    let phys = {
+        let mut area = STACK_AREA.lock_irqsave();
+        unsafe { vunmap_stack_pages(stack_bottom as u64, KERNEL_STACK_SIZE as u64) };
+        let mask = 1u64 << (slot % 64);
+        area.used[slot / 64] &= !mask;
+        area.stale[slot / 64] |= mask;
+        core::mem::replace(&mut area.phys[slot], 0)
+    };
+    unsafe { dealloc(phys as *mut u8, stack_layout()) };
+    NR_STACKS.fetch_sub(1, Ordering::Relaxed);
+}
+
+/// 分配内核栈 (alloc_thread_stack_node)
+///
+/// # 返回
+/// 成功返回栈顶地址，区域槽位或内存用完时返回 None
+pub fn alloc_kernel_stack() -> Option<*mut u8> {
+    let bottom = match take_cached_stack() {
+        Some(bottom) => bottom,
+        None => map_new_stack()?,
+    };
+    Some((bottom + KERNEL_STACK_SIZE) as *mut u8)
+}
+
+/// 释放内核栈 (free_thread_stack)
+///
+/// 记录栈用过的深度，本 CPU 的缓存未满时放回缓存，否则解除映射
+pub fn free_kernel_stack(stack_top: *mut u8) {
+    let used = stack_used(stack_top);
+    MAX_STACK_USED.fetch_max(used, Ordering::Relaxed);
+
+    let bottom = stack_top as usize - KERNEL_STACK_SIZE;
+    if !put_cached_stack(bottom) {
+        unmap_stack(bottom);
+    }
+}
+
+/// 栈用过的最大深度（字节）(stack_not_used)
+///
+/// 栈只在第一次使用时清零，从栈底向上第一个非零字之上都曾被使用过
+pub fn stack_used(stack_top: *mut u8) -> usize {
+    let bottom = (stack_top as usize - KERNEL_STACK_SIZE) as *const u64;
+    let words = KERNEL_STACK_SIZE / 8;
+    let unused = (0..words)
+        .find(|&i| unsafe { ptr::read_volatile(bottom.add(i)) } != 0)
+        .unwrap_or(words);
+    (words - unused) * 8
+}
+
+/// 回收过的栈用过的最大深度（字节）
+pub fn stack_high_water() -> usize {
+    MAX_STACK_USED.load(Ordering::Relaxed)
+}
+
+/// 已映射的内核栈数（包括 CPU 缓存中的）
+pub fn nr_stacks() -> usize {
+    NR_STACKS.load(Ordering::Relaxed)
+}
+
+/// 地址是否落在内核栈的保护页中
+///
+/// 缺页异常处理用来区分内核栈溢出
+pub fn is_guard_page(addr: usize) -> bool {
+    let start = vmap_stack::START as usize;
+    addr >= start
+        && addr - start < vmap_stack::SIZE as usize
+        && (addr - start) % SLOT_SIZE < KERNEL_STACK_SIZE
+}
+
+/// 生成 /proc/kstackinfo 内容
+pub fn kstackinfo() -> String {
+    let cached = (0..MAX_CPUS)
+        .map(|cpu| unsafe { (*ptr::addr_of!(CACHED_STACKS[cpu])).iter().filter(|&&s| s != 0).count() })
+        .sum::<usize>();
+    let mut out = String::new();
+    let _ = writeln!(out, "stack_size {}", KERNEL_STACK_SIZE);
+    let _ = writeln!(out, "stacks {}", nr_stacks());
+    let _ = writeln!(out, "cached {}", cached);
+    let _ = writeln!(out, "max_used {}", stack_high_water());
+    out
+}
@@ -8,18 +8,22 @@
 //! 本模块实现进程管理功能，完全...
 //! - `task`: 进程控制块 (task_struct)
 //! - `fork`: 进程创建 (kernel/fork.c)
+//! - `kstack`: 带保护页的内核栈与内核栈缓存
 //! - `wait`: 等待队列 (kernel/wait.c)
+//! - `futex`: 快速用户空间互斥 (kernel/futex/)
 //! - `test`: 进程测试
 //! - `usermod`: 用户模式管理
 
 pub mod task;
 pub mod fork;
+pub mod kstack;
 pub mod test;
 pub mod usermod;
 pub mod wait;
+pub mod futex;
 
 pub use task::Task;
-pub use fork::do_fork;
+pub use fork::{do_clone, do_fork};
 
 pub fn current_pid() -> u32 {
     crate::sched::get_current_pid()
@@ -7,23 +7,16 @@
 //!
 //! 关键设计要点：
 
-use core::sync::atomic::{AtomicU32, Ordering};
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicU64, AtomicUsize, Ordering};
 use core::ptr;
 use crate::mm::pagemap::AddressSpace;
 use crate::fs::FdTable;
 use crate::signal::{SignalStruct, SigPending};
 use crate::config::TIME_SLICE_TICKS as DEFAULT_TIME_SLICE;
-use alloc::boxed::Box;
-use alloc::alloc::{alloc, dealloc};
-use core::alloc::Layout;
+use alloc::sync::Arc;
 use core::mem::offset_of;
 use crate::list::ListHead;
-
-/// 内核栈大小 (32KB = 8 个页面)
-///
-/// RISC-V 通常使用 16KB 内核栈，但我们增加到 32KB
-/// 因为某些操作（如 FdTable 创建）需要较大的栈空间
-const KERNEL_STACK_SIZE: usize = 32768;  // 32KB
+use crate::sched::fair::SchedEntity;
 
 ///
 #[derive(Debug, Clone, Copy, PartialEq, Eq)]
@@ -77,6 +70,27 @@ pub enum SchedPolicy {
     Deadline = 6,
 }
 
+impl SchedPolicy {
+    /// 从系统调用参数解析调度策略，未知的策略返回 None
+    pub fn from_raw(policy: u32) -> Option<Self> {
+        match policy {
+            0 => Some(SchedPolicy::Normal),
+            1 => Some(SchedPolicy::Fifo),
+            2 => Some(SchedPolicy::Rr),
+            3 => Some(SchedPolicy::Batch),
+            5 => Some(SchedPolicy::Idle),
+            6 => Some(SchedPolicy::Deadline),
+            _ => None,
+        }
+    }
+
+    /// 是否是实时策略 (rt_policy)
+    #[inline]
+    pub fn is_rt(self) -> bool {
+        matches!(self, SchedPolicy::Fifo | SchedPolicy::Rr)
+    }
+}
+
 /// 任务标志 (task flags)
 ///
 pub mod task_flags {
@@ -154,6 +168,45 @@ impl Default for CpuContext {
 ///
 pub type Pid = u32;
 
+/// 任务名的最大长度，含结尾的 0 (TASK_COMM_LEN)
+pub const TASK_COMM_LEN: usize = 16;
+
+/// 任务的缺页与 I/O 计数 (task_struct::min_flt / maj_flt, task_io_accounting)
+///
+/// 需要读入文件页或换入的缺页计为 maj_flt，其余计为 min_flt
+///
+/// 只由任务自己更新，/proc/<pid> 与 getrusage 读取时不加锁
+pub struct TaskAcct {
+    /// 不需要读盘的缺页次数
+    pub min_flt: AtomicU64,
+    /// 需要读盘的缺页次数
+    pub maj_flt: AtomicU64,
+    /// 正在处理的缺页需要读盘，由缺页处理设置、account_fault 清除
+    pub fault_major: AtomicBool,
+    /// read 类系统调用读到的字节数
+    pub rchar: AtomicU64,
+    /// write 类系统调用写出的字节数
+    pub wchar: AtomicU64,
+    /// read 类系统调用次数
+    pub syscr: AtomicU64,
+    /// write 类系统调用次数
+    pub syscw: AtomicU64,
+}
+
+impl TaskAcct {
+    pub const fn new() -> Self {
+        Self {
+            min_flt: AtomicU64::new(0),
+            maj_flt: AtomicU64::new(0),
+            fault_major: AtomicBool::new(false),
+            rchar: AtomicU64::new(0),
+            wchar: AtomicU64::new(0),
+            syscr: AtomicU64::new(0),
+            syscw: AtomicU64::new(0),
+        }
+    }
+}
+
 /// 任务控制块 (Task Control Block)
 ///
 ///
@@ -198,11 +251,30 @@ pub struct Task {
     /// 时间片剩余
     time_slice: u32,
 
+    /// 运行队列链表节点 (sched_rt_entity::run_list)
+    ///
+    /// 链接到所属 CPU 运行队列中 prio 对应的 FIFO 链表
+    pub run_list: ListHead,
+
+    /// 是否在运行队列的优先级数组中 (on_rq)
+    pub on_rq: bool,
+
+    /// 所属 CPU 的运行队列 (task_struct::cpu)
+    cpu: u32,
+
+    /// 允许运行的 CPU 位图 (task_struct::cpus_mask)
+    cpus_allowed: AtomicUsize,
+
+    /// CFS 调度实体 (task_struct::se)
+    pub se: SchedEntity,
+
+    /// 在所属运行队列任务表中的槽位索引
+    pub rq_slot: usize,
+
     /// CPU 上下文
     context: CpuContext,
 
-    /// 内核栈
-    /// TODO: 实现内核栈分配
+    /// 内核栈（栈顶地址），退出回收时放回每 CPU 的内核栈缓存
     kernel_stack: Option<*mut u8>,
 
     /// fork 子进程标志
@@ -215,16 +287,16 @@ pub struct Task {
     fork_trap_frame: core::sync::atomic::AtomicU64,
 
     /// 地址空间 (mm_struct)
-    /// 内核线程为 None，用户进程为 Some
-    address_space: Option<AddressSpace>,
+    /// 内核线程为 None，用户进程为 Some；CLONE_VM 创建的线程共享同一个
+    address_space: Option<Arc<AddressSpace>>,
 
     /// 文件描述符表 (files_struct)
-    /// 使用 Box 以减少 Task 的大小
-    fdtable: Option<Box<FdTable>>,
+    /// CLONE_FILES 创建的任务共享同一个
+    fdtable: Option<Arc<FdTable>>,
 
-    /// 信号处理结构 (signal_struct)
-    /// 使用 Box 以减少 Task 的大小
-    pub signal: Option<Box<SignalStruct>>,
+    /// 信号处理结构 (sighand_struct)
+    /// CLONE_SIGHAND 创建的任务共享同一个
+    pub signal: Option<Arc<SignalStruct>>,
 
     /// 待处理信号 (pending)
     pub pending: SigPending,
@@ -234,19 +306,19 @@ pub struct Task {
     /// 用于 sigprocmask 系统调用
     pub sigmask: u64,
 
+    /// 临时信号掩码替换前的掩码 (saved_sigmask / TIF_RESTORE_SIGMASK)
+    ///
+    /// epoll_pwait 等系统调用等待期间使用调用者给出的掩码，
+    /// 返回用户模式前由 do_signal 恢复
+    pub saved_sigmask: Option<u64>,
+
     /// 信号栈 (sigaltstack)
     pub sigstack: crate::signal::SignalStack,
 
-    /// 信号帧地址（在用户空间）
-    pub sigframe_addr: u64,
-
-    /// 信号帧（内核空间备份）
-    pub sigframe: Option<crate::signal::SignalFrame>,
-
     /// 父进程
     parent: Option<*const Task>,
 
-    /// 退出码 (Zombie 状态时有效)
+    /// 交给父进程的等待状态，编码同 wait4 的 status (Zombie 状态时有效)
     exit_code: i32,
 
     /// 子进程列表
@@ -277,11 +349,43 @@ pub struct Task {
     robust_list_head: *const u8,
     robust_list_len: usize,
 
+    /// vfork 完成通知 (vfork_done)
+    ///
+    /// CLONE_VFORK 创建的子进程持有父进程等待的 VforkDone（Arc::into_raw 得到的指针），
+    /// execve 或退出时取下并唤醒父进程；其他任务为空
+    vfork_done: core::sync::atomic::AtomicPtr<crate::process::fork::VforkDone>,
+
     /// 进程堆边界 (brk)
     ///
     /// 指向进程堆的末尾地址，由 sys_brk 管理
     /// 初始值为 0，在第一次 brk 调用时设置为默认值
     brk: core::sync::atomic::AtomicU64,
+
+    /// 引用计数 (task_struct::usage)
+    ///
+    /// 从任务缓存分配的任务为 2：一个由任务表持有，回收时释放；
+    /// 一个由运行状态持有，任务退出并切换走后释放。为 0 表示静态分配，不会释放
+    usage: AtomicU32,
+
+    /// 浮点寄存器状态 (thread_struct::fstate)
+    ///
+    /// 由 arch::riscv64::fpu 延迟保存和恢复
+    pub fpu: crate::arch::riscv64::fpu::ThreadFpu,
+
+    /// 任务名 (comm)，fork 时继承，execve 时设为程序文件名
+    comm: spin::Mutex<[u8; TASK_COMM_LEN]>,
+
+    /// 创建时的 sched_clock，单位 ns (start_time)
+    start_time: u64,
+
+    /// 缺页与 I/O 计数
+    pub acct: TaskAcct,
+
+    /// OOM 评分调整与受害者标记
+    pub oom: crate::mm::oom_kill::TaskOom,
+
+    /// 挂在本任务上的 perf 计数事件 (perf_event_ctxp)
+    pub perf_events: crate::perf_event::PerfEventContext,
 }
 
 impl Task {
@@ -311,6 +415,12 @@ impl Task {
             static_prio,
             normal_prio,
             time_slice: DEFAULT_TIME_SLICE, // 默认时间片 (10 个时钟中断 = 100ms)
+            run_list: ListHead::new(),
+            on_rq: false,
+            cpu: 0,
+            cpus_allowed: AtomicUsize::new(usize::MAX),
+            rq_slot: 0,
+            se: SchedEntity::new(),
             context,
             kernel_stack: None,
             is_fork_child: core::sync::atomic::AtomicBool::new(false),
@@ -320,9 +430,8 @@ impl Task {
             signal,
             pending,
             sigmask: 0,  // 初始信号掩码为空
+            saved_sigmask: None,
             sigstack,
-            sigframe_addr: 0,
-            sigframe: None,
             parent: None,
             exit_code: 0,
             children: ListHead::new(),
@@ -331,12 +440,21 @@ impl Task {
             clear_child_tid: ptr::null_mut(),
             robust_list_head: ptr::null(),
             robust_list_len: 0,
+            vfork_done: core::sync::atomic::AtomicPtr::new(ptr::null_mut()),
             brk: core::sync::atomic::AtomicU64::new(0),
+            usage: AtomicU32::new(0),
+            fpu: crate::arch::riscv64::fpu::ThreadFpu::new(),
+            comm: spin::Mutex::new([0; TASK_COMM_LEN]),
+            start_time: 0,
+            acct: TaskAcct::new(),
+            oom: crate::mm::oom_kill::TaskOom::new(),
+            perf_events: crate::perf_event::PerfEventContext::new(),
         };
 
-        // 初始化 children 和 sibling 链表（必须在结构体构造后）
+        // 初始化 children、sibling 和 run_list 链表（必须在结构体构造后）
         task.children.init();
         task.sibling.init();
+        task.run_list.init();
 
         task
     }
@@ -385,6 +503,27 @@ impl Task {
             (ptr as usize + offset_of!(Task, time_slice)) as *mut u32,
             100,
         );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, on_rq)) as *mut bool,
+            false,
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, cpu)) as *mut u32,
+            crate::arch::cpu_id() as u32,
+        );
+        // idle 任务固定在自己的 CPU 上
+        ptr::write(
+            (ptr as usize + offset_of!(Task, cpus_allowed)) as *mut AtomicUsize,
+            AtomicUsize::new(1usize << (crate::arch::cpu_id() as usize)),
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, rq_slot)) as *mut usize,
+            0,
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, se)) as *mut SchedEntity,
+            SchedEntity::new(),
+        );
         ptr::write(
             (ptr as usize + offset_of!(Task, context)) as *mut CpuContext,
             CpuContext::default(),
@@ -402,15 +541,15 @@ impl Task {
             core::sync::atomic::AtomicU64::new(0),
         );
         ptr::write(
-            (ptr as usize + offset_of!(Task, address_space)) as *mut Option<AddressSpace>,
+            (ptr as usize + offset_of!(Task, address_space)) as *mut Option<Arc<AddressSpace>>,
             None,
         );
         ptr::write(
-            (ptr as usize + offset_of!(Task, fdtable)) as *mut Option<Box<FdTable>>,
+            (ptr as usize + offset_of!(Task, fdtable)) as *mut Option<Arc<FdTable>>,
             None,
         );
         ptr::write(
-            (ptr as usize + offset_of!(Task, signal)) as *mut Option<Box<SignalStruct>>,
+            (ptr as usize + offset_of!(Task, signal)) as *mut Option<Arc<SignalStruct>>,
             None,
         );
         ptr::write(
@@ -422,16 +561,12 @@ impl Task {
             0,
         );
         ptr::write(
-            (ptr as usize + offset_of!(Task, sigstack)) as *mut crate::signal::SignalStack,
-            crate::signal::SignalStack::new(),
-        );
-        ptr::write(
-            (ptr as usize + offset_of!(Task, sigframe_addr)) as *mut u64,
-            0,
+            (ptr as usize + offset_of!(Task, saved_sigmask)) as *mut Option<u64>,
+            None,
         );
         ptr::write(
-            (ptr as usize + offset_of!(Task, sigframe)) as *mut Option<crate::signal::SignalFrame>,
-            None,
+            (ptr as usize + offset_of!(Task, sigstack)) as *mut crate::signal::SignalStack,
+            crate::signal::SignalStack::new(),
         );
         ptr::write(
             (ptr as usize + offset_of!(Task, parent)) as *mut Option<*mut Task>,
@@ -457,12 +592,43 @@ impl Task {
             (ptr as usize + offset_of!(Task, robust_list_len)) as *mut usize,
             0,
         );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, vfork_done))
+                as *mut core::sync::atomic::AtomicPtr<crate::process::fork::VforkDone>,
+            core::sync::atomic::AtomicPtr::new(ptr::null_mut()),
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, usage)) as *mut AtomicU32,
+            AtomicU32::new(0),
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, fpu)) as *mut crate::arch::riscv64::fpu::ThreadFpu,
+            crate::arch::riscv64::fpu::ThreadFpu::new(),
+        );
+        let mut comm = [0; TASK_COMM_LEN];
+        comm[..7].copy_from_slice(b"swapper");
+        ptr::write(
+            (ptr as usize + offset_of!(Task, comm)) as *mut spin::Mutex<[u8; TASK_COMM_LEN]>,
+            spin::Mutex::new(comm),
+        );
+        ptr::write((ptr as usize + offset_of!(Task, start_time)) as *mut u64, 0);
+        ptr::write((ptr as usize + offset_of!(Task, acct)) as *mut TaskAcct, TaskAcct::new());
+        ptr::write(
+            (ptr as usize + offset_of!(Task, oom)) as *mut crate::mm::oom_kill::TaskOom,
+            crate::mm::oom_kill::TaskOom::new(),
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, perf_events)) as *mut crate::perf_event::PerfEventContext,
+            crate::perf_event::PerfEventContext::new(),
+        );
 
         // 初始化 children 和 sibling 链表
         let children_ptr = (ptr as usize + offset_of!(Task, children)) as *mut ListHead;
         (*children_ptr).init();
         let sibling_ptr = (ptr as usize + offset_of!(Task, sibling)) as *mut ListHead;
         (*sibling_ptr).init();
+        let run_list_ptr = (ptr as usize + offset_of!(Task, run_list)) as *mut ListHead;
+        (*run_list_ptr).init();
     }
 
     /// 在指定内存位置构造普通 task
@@ -514,6 +680,26 @@ impl Task {
             (ptr as usize + offset_of!(Task, time_slice)) as *mut u32,
             HZ,
         );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, on_rq)) as *mut bool,
+            false,
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, cpu)) as *mut u32,
+            0,
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, cpus_allowed)) as *mut AtomicUsize,
+            AtomicUsize::new(usize::MAX),
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, rq_slot)) as *mut usize,
+            0,
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, se)) as *mut SchedEntity,
+            SchedEntity::new(),
+        );
         ptr::write(
             (ptr as usize + offset_of!(Task, context)) as *mut CpuContext,
             CpuContext::default(),
@@ -531,15 +717,15 @@ impl Task {
             core::sync::atomic::AtomicU64::new(0),
         );
         ptr::write(
-            (ptr as usize + offset_of!(Task, address_space)) as *mut Option<AddressSpace>,
+            (ptr as usize + offset_of!(Task, address_space)) as *mut Option<Arc<AddressSpace>>,
             None,
         );
         ptr::write(
-            (ptr as usize + offset_of!(Task, fdtable)) as *mut Option<Box<FdTable>>,
+            (ptr as usize + offset_of!(Task, fdtable)) as *mut Option<Arc<FdTable>>,
             None,
         );
         ptr::write(
-            (ptr as usize + offset_of!(Task, signal)) as *mut Option<Box<SignalStruct>>,
+            (ptr as usize + offset_of!(Task, signal)) as *mut Option<Arc<SignalStruct>>,
             None,
         );
         ptr::write(
@@ -551,16 +737,12 @@ impl Task {
             0,
         );
         ptr::write(
-            (ptr as usize + offset_of!(Task, sigstack)) as *mut crate::signal::SignalStack,
-            crate::signal::SignalStack::new(),
-        );
-        ptr::write(
-            (ptr as usize + offset_of!(Task, sigframe_addr)) as *mut u64,
-            0,
+            (ptr as usize + offset_of!(Task, saved_sigmask)) as *mut Option<u64>,
+            None,
         );
         ptr::write(
-            (ptr as usize + offset_of!(Task, sigframe)) as *mut Option<crate::signal::SignalFrame>,
-            None,
+            (ptr as usize + offset_of!(Task, sigstack)) as *mut crate::signal::SignalStack,
+            crate::signal::SignalStack::new(),
         );
         ptr::write(
             (ptr as usize + offset_of!(Task, parent)) as *mut Option<*mut Task>,
@@ -586,16 +768,48 @@ impl Task {
             (ptr as usize + offset_of!(Task, robust_list_len)) as *mut usize,
             0,
         );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, vfork_done))
+                as *mut core::sync::atomic::AtomicPtr<crate::process::fork::VforkDone>,
+            core::sync::atomic::AtomicPtr::new(ptr::null_mut()),
+        );
         ptr::write(
             (ptr as usize + offset_of!(Task, brk)) as *mut core::sync::atomic::AtomicU64,
             core::sync::atomic::AtomicU64::new(0),
         );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, usage)) as *mut AtomicU32,
+            AtomicU32::new(0),
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, fpu)) as *mut crate::arch::riscv64::fpu::ThreadFpu,
+            crate::arch::riscv64::fpu::ThreadFpu::new(),
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, comm)) as *mut spin::Mutex<[u8; TASK_COMM_LEN]>,
+            spin::Mutex::new([0; TASK_COMM_LEN]),
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, start_time)) as *mut u64,
+            crate::sched::fair::sched_clock(),
+        );
+        ptr::write((ptr as usize + offset_of!(Task, acct)) as *mut TaskAcct, TaskAcct::new());
+        ptr::write(
+            (ptr as usize + offset_of!(Task, oom)) as *mut crate::mm::oom_kill::TaskOom,
+            crate::mm::oom_kill::TaskOom::new(),
+        );
+        ptr::write(
+            (ptr as usize + offset_of!(Task, perf_events)) as *mut crate::perf_event::PerfEventContext,
+            crate::perf_event::PerfEventContext::new(),
+        );
 
         // 初始化 children 和 sibling 链表
         let children_ptr = (ptr as usize + offset_of!(Task, children)) as *mut ListHead;
         (*children_ptr).init();
         let sibling_ptr = (ptr as usize + offset_of!(Task, sibling)) as *mut ListHead;
         (*sibling_ptr).init();
+        let run_list_ptr = (ptr as usize + offset_of!(Task, run_list)) as *mut ListHead;
+        (*run_list_ptr).init();
 
         // 分配内核栈
         let task_ref = &mut *ptr;
@@ -652,39 +866,18 @@ impl Task {
     /// ```
     #[inline(never)]
     pub fn sleep(state: TaskState) {
-        // Debug: entering sleep
-        unsafe {
-            crate::console::putchar(b'S');
-            crate::console::putchar(b'L');
-            crate::console::putchar(b'P');
-            crate::console::putchar(b'\n');
-        }
-
         // 设置当前进程为睡眠状态
         if let Some(current) = crate::sched::current() {
             unsafe {
                 (*current).set_state(state);
+                crate::tracepoint!(SCHED_SLEEP, "sleep pid={} state={:?}", (*current).pid(), state);
             }
         }
 
-        // Debug: calling schedule
-        unsafe {
-            crate::console::putchar(b'C');
-            crate::console::putchar(b'S');
-            crate::console::putchar(b'C');
-            crate::console::putchar(b'\n');
-        }
-
         // 触发调度，选择其他进程运行
         crate::sched::schedule();
 
-        // Debug: back from schedule
-        unsafe {
-            crate::console::putchar(b'B');
-            crate::console::putchar(b'S');
-            crate::console::putchar(b'C');
-            crate::console::putchar(b'\n');
-        }
+        crate::tracepoint!(SCHED_SLEEP, "wake pid={}", crate::sched::get_current_pid());
     }
 
     /// 唤醒进程
@@ -708,6 +901,19 @@ impl Task {
     /// ```
     #[inline(never)]
     pub fn wake_up(task: *mut Task) -> bool {
+        Self::try_to_wake_up(task, 0)
+    }
+
+    /// 按唤醒标志唤醒进程 (try_to_wake_up)
+    ///
+    /// 调度器为任务选择运行队列（可能迁移到空闲 CPU 或唤醒者的 CPU），
+    /// 并通知目标 CPU 重新调度
+    ///
+    /// # 参数
+    /// - `task`: 要唤醒的进程
+    /// - `wake_flags`: 唤醒标志，如 sched::WF_SYNC
+    #[inline(never)]
+    pub fn try_to_wake_up(task: *mut Task, wake_flags: u32) -> bool {
         if task.is_null() {
             return false;
         }
@@ -721,8 +927,8 @@ impl Task {
                     // 唤醒进程：设置为 Running 状态
                     (*task).set_state(TaskState::Running);
 
-                    // 设置 need_resched 标志，触发重新调度
-                    crate::sched::set_need_resched();
+                    // 选择运行队列加入，并触发目标 CPU 重新调度
+                    crate::sched::activate_task(task, wake_flags);
 
                     true
                 }
@@ -737,6 +943,105 @@ impl Task {
         self.pid
     }
 
+    /// 获取调度策略
+    #[inline]
+    pub fn policy(&self) -> SchedPolicy {
+        self.policy
+    }
+
+    /// 获取动态优先级 (0-139)
+    #[inline]
+    pub fn prio(&self) -> i32 {
+        self.prio
+    }
+
+    /// 获取静态优先级
+    #[inline]
+    pub fn static_prio(&self) -> i32 {
+        self.static_prio
+    }
+
+    /// 获取不含优先级继承提升的优先级 (normal_prio)
+    #[inline]
+    pub fn normal_prio(&self) -> i32 {
+        self.normal_prio
+    }
+
+    /// 设置动态优先级
+    ///
+    /// 只由 sched::rt_mutex_setprio 调用，任务在优先级数组中时由调用者先移出
+    #[inline]
+    pub fn set_prio(&mut self, prio: i32) {
+        self.prio = prio;
+    }
+
+    /// 实时优先级 (rt_priority)，1-99，数值越大优先级越高；非实时任务为 0
+    #[inline]
+    pub fn rt_priority(&self) -> i32 {
+        if self.policy.is_rt() {
+            crate::sched::fair::MAX_RT_PRIO - 1 - self.normal_prio
+        } else {
+            0
+        }
+    }
+
+    /// 设置调度策略和 normal_prio (__setscheduler_params)
+    ///
+    /// 只由 sched::sched_setscheduler 和 fork 调用，任务在运行队列中时由调用者先移出；
+    /// 动态优先级由调用者另行设置
+    #[inline]
+    pub fn set_sched_params(&mut self, policy: SchedPolicy, normal_prio: i32) {
+        self.policy = policy;
+        self.normal_prio = normal_prio;
+        self.time_slice = DEFAULT_TIME_SLICE;
+    }
+
+    /// 子进程继承父进程的调度策略、优先级、CPU 亲和性和任务组 (sched_fork)
+    ///
+    /// 不继承优先级继承带来的提升；调用时子进程还不在任何运行队列中
+    pub fn sched_fork(&mut self, parent: &Task) {
+        self.static_prio = parent.static_prio;
+        self.set_sched_params(parent.policy, parent.normal_prio);
+        self.prio = self.normal_prio;
+        self.set_cpus_allowed(parent.cpus_allowed());
+        *self.comm.lock() = *parent.comm.lock();
+        crate::sched::group::sched_fork_group(self, parent);
+    }
+
+    /// 获取任务所属 CPU
+    #[inline]
+    pub fn cpu(&self) -> usize {
+        self.cpu as usize
+    }
+
+    /// 设置任务所属 CPU
+    ///
+    /// 仅在任务加入运行队列或迁移时由调度器调用
+    #[inline]
+    pub fn set_cpu(&mut self, cpu: usize) {
+        self.cpu = cpu as u32;
+    }
+
+    /// 允许运行的 CPU 位图 (cpus_ptr)
+    #[inline]
+    pub fn cpus_allowed(&self) -> usize {
+        self.cpus_allowed.load(Ordering::Relaxed)
+    }
+
+    /// 是否允许在指定 CPU 上运行
+    #[inline]
+    pub fn cpu_allowed(&self, cpu: usize) -> bool {
+        cpu < usize::BITS as usize && self.cpus_allowed() & (1usize << cpu) != 0
+    }
+
+    /// 设置允许运行的 CPU 位图
+    ///
+    /// 只由 sched::sched_setaffinity 和 fork 调用，由调度器负责把任务移到允许的 CPU 上
+    #[inline]
+    pub fn set_cpus_allowed(&self, mask: usize) {
+        self.cpus_allowed.store(mask, Ordering::Relaxed);
+    }
+
     /// 抢占式调度支持
 
     /// 减少时间片
@@ -819,6 +1124,18 @@ impl Task {
         self.tgid
     }
 
+    /// 设置 TGID（CLONE_THREAD 加入父进程的线程组）
+    #[inline]
+    pub fn set_tgid(&mut self, tgid: Pid) {
+        self.tgid = tgid;
+    }
+
+    /// 是否是线程组中的非主线程
+    #[inline]
+    pub fn is_thread(&self) -> bool {
+        self.pid != self.tgid
+    }
+
     /// 获取 CPU 上下文的可变引用
     pub fn context_mut(&mut self) -> &mut CpuContext {
         &mut self.context
@@ -829,72 +1146,76 @@ impl Task {
         &self.context
     }
 
-    /// 获取地址空间的可变引用
-    pub fn address_space_mut(&mut self) -> Option<&mut AddressSpace> {
-        self.address_space.as_mut()
-    }
-
     /// 获取地址空间的引用
     pub fn address_space(&self) -> Option<&AddressSpace> {
-        self.address_space.as_ref()
+        self.address_space.as_deref()
     }
 
     /// 设置地址空间
     pub fn set_address_space(&mut self, addr_space: Option<AddressSpace>) {
-        self.address_space = addr_space;
+        self.address_space = addr_space.map(Arc::new);
     }
 
-    /// 分配内核栈
+    /// 取得地址空间的共享引用，并增加 mm_users (CLONE_VM)
+    pub fn share_address_space(&self) -> Option<Arc<AddressSpace>> {
+        let mm = self.address_space.as_ref()?;
+        mm.mm_users_inc();
+        Some(mm.clone())
+    }
+
+    /// 取得地址空间的引用，不增加 mm_users
     ///
+    /// 只读访问地址空间（如 /proc/<pid>/maps）时使用，不让地址空间多一个使用者
+    pub fn address_space_arc(&self) -> Option<Arc<AddressSpace>> {
+        self.address_space.clone()
+    }
+
+    /// 设置共享的地址空间
+    pub fn set_shared_address_space(&mut self, mm: Option<Arc<AddressSpace>>) {
+        self.address_space = mm;
+    }
+
+    /// 分配内核栈
     ///
-    /// 为当前任务分配一个内核栈，大小为 KERNEL_STACK_SIZE (16KB)
+    /// 内核栈映射在带保护页的内核栈区域，大小为 KERNEL_STACK_SIZE (32KB)
     ///
     /// # 返回
     /// 成功返回 Some(栈顶地址)，失败返回 None
     pub fn alloc_kernel_stack(&mut self) -> Option<*mut u8> {
-        unsafe {
-            // 使用全局分配器分配内核栈
-            let layout = Layout::from_size_align(KERNEL_STACK_SIZE, 16)
-                .ok()?;
-
-            let stack_ptr = alloc(layout);
-
-            if !stack_ptr.is_null() {
-                // 清零栈空间
-                core::ptr::write_bytes(stack_ptr, 0, KERNEL_STACK_SIZE);
-
-                // 设置栈顶地址（栈向下增长）
-                let stack_top = stack_ptr.add(KERNEL_STACK_SIZE);
-                self.kernel_stack = Some(stack_top);
-
-                Some(stack_top)
-            } else {
-                None
-            }
-        }
+        let stack_top = crate::process::kstack::alloc_kernel_stack()?;
+        self.kernel_stack = Some(stack_top);
+        Some(stack_top)
     }
 
     /// 释放内核栈
     ///
-    ///
-    /// 释放当前任务的内核栈
+    /// 内核栈放回本 CPU 的内核栈缓存，缓存已满时解除映射
     pub fn free_kernel_stack(&mut self) {
-        if let Some(stack_top) = self.kernel_stack {
-            unsafe {
-                // 计算栈底地址（栈顶 - 栈大小）
-                let stack_bottom = stack_top.sub(KERNEL_STACK_SIZE);
+        if let Some(stack_top) = self.kernel_stack.take() {
+            crate::process::kstack::free_kernel_stack(stack_top);
+        }
+    }
 
-                // 创建 Layout 用于释放内存
-                let layout = Layout::from_size_align(KERNEL_STACK_SIZE, 16)
-                    .unwrap_or_else(|_| Layout::new::<[u8; KERNEL_STACK_SIZE]>());
+    /// 设置引用计数
+    ///
+    /// 任务缓存分配的任务由 alloc_task_slot 设为 2，静态分配的任务保持 0
+    pub fn set_usage(&self, usage: u32) {
+        self.usage.store(usage, Ordering::Release);
+    }
 
-                // 释放内存
-                dealloc(stack_bottom, layout);
+    /// 释放一个引用 (put_task_struct)
+    ///
+    /// # 返回
+    /// 释放的是最后一个引用时返回 true，由调用者释放 Task；静态分配的任务总是返回 false
+    pub fn put_usage(&self) -> bool {
+        let mut usage = self.usage.load(Ordering::Relaxed);
+        while usage != 0 {
+            match self.usage.compare_exchange_weak(usage, usage - 1, Ordering::AcqRel, Ordering::Relaxed) {
+                Ok(_) => return usage == 1,
+                Err(cur) => usage = cur,
             }
-
-            // 清零引用
-            self.kernel_stack = None;
         }
+        false
     }
 
     /// 获取内核栈顶地址
@@ -928,22 +1249,22 @@ impl Task {
         self.fdtable.as_ref().expect("FdTable not initialized")
     }
 
-    /// 获取文件描述符表的可变引用 (Option 版本)
+    /// 设置文件描述符表
     #[inline]
-    pub fn try_fdtable_mut(&mut self) -> Option<&mut FdTable> {
-        self.fdtable.as_mut().map(|b| b.as_mut())
+    pub fn set_fdtable(&mut self, fdtable: Option<Arc<FdTable>>) {
+        self.fdtable = fdtable;
     }
 
-    /// 获取文件描述符表的可变引用
+    /// 文件描述符表是否被其他任务共享 (files->count > 1)
     #[inline]
-    pub fn fdtable_mut(&mut self) -> &mut FdTable {
-        self.fdtable.as_mut().expect("FdTable not initialized")
+    pub fn fdtable_shared(&self) -> bool {
+        self.fdtable.as_ref().map_or(false, |fdtable| Arc::strong_count(fdtable) > 1)
     }
 
-    /// 设置文件描述符表
+    /// 取得文件描述符表的共享引用 (CLONE_FILES)
     #[inline]
-    pub fn set_fdtable(&mut self, fdtable: Option<alloc::boxed::Box<FdTable>>) {
-        self.fdtable = fdtable;
+    pub fn share_fdtable(&self) -> Option<Arc<FdTable>> {
+        self.fdtable.clone()
     }
 
     /// 设置父进程
@@ -1197,6 +1518,24 @@ impl Task {
         self.robust_list_len
     }
 
+    /// 设置 vfork 完成通知 (p->vfork_done = &vfork)
+    pub fn set_vfork_done(&self, vfork: Arc<crate::process::fork::VforkDone>) {
+        let old = self.vfork_done.swap(Arc::into_raw(vfork) as *mut _, Ordering::AcqRel);
+        if !old.is_null() {
+            drop(unsafe { Arc::from_raw(old) });
+        }
+    }
+
+    /// 取下 vfork 完成通知；每个通知只会被取下一次
+    pub fn take_vfork_done(&self) -> Option<Arc<crate::process::fork::VforkDone>> {
+        let ptr = self.vfork_done.swap(ptr::null_mut(), Ordering::AcqRel);
+        if ptr.is_null() {
+            None
+        } else {
+            Some(unsafe { Arc::from_raw(ptr) })
+        }
+    }
+
     /// 获取当前 brk 值
     #[inline]
     pub fn get_brk(&self) -> u64 {
@@ -1208,6 +1547,60 @@ impl Task {
     pub fn set_brk(&self, value: u64) {
         self.brk.store(value, core::sync::atomic::Ordering::Release);
     }
+
+    /// 任务名，去掉结尾的 0 (get_task_comm)
+    pub fn comm(&self) -> alloc::string::String {
+        let comm = *self.comm.lock();
+        let len = comm.iter().position(|&b| b == 0).unwrap_or(TASK_COMM_LEN);
+        alloc::string::String::from_utf8_lossy(&comm[..len]).into_owned()
+    }
+
+    /// 设置任务名，超长时截断 (set_task_comm)
+    pub fn set_comm(&self, name: &[u8]) {
+        let mut comm = [0; TASK_COMM_LEN];
+        let len = name.len().min(TASK_COMM_LEN - 1);
+        comm[..len].copy_from_slice(&name[..len]);
+        *self.comm.lock() = comm;
+    }
+
+    /// 创建时的 sched_clock (start_time)
+    #[inline]
+    pub fn start_time(&self) -> u64 {
+        self.start_time
+    }
+
+    /// 记一次 read 类系统调用 (add_rchar / inc_syscr)
+    #[inline]
+    pub fn account_read(&self, ret: isize) {
+        self.acct.syscr.fetch_add(1, Ordering::Relaxed);
+        if ret > 0 {
+            self.acct.rchar.fetch_add(ret as u64, Ordering::Relaxed);
+        }
+    }
+
+    /// 记一次 write 类系统调用 (add_wchar / inc_syscw)
+    #[inline]
+    pub fn account_write(&self, ret: isize) {
+        self.acct.syscw.fetch_add(1, Ordering::Relaxed);
+        if ret > 0 {
+            self.acct.wchar.fetch_add(ret as u64, Ordering::Relaxed);
+        }
+    }
+
+    /// 记一次处理成功的缺页 (mm_account_fault)
+    #[inline]
+    pub fn account_fault(&self) {
+        use crate::mm::vmstat::{count_vm_event, VmEvent};
+
+        count_vm_event(VmEvent::PgFault);
+        if self.acct.fault_major.swap(false, Ordering::Relaxed) {
+            self.acct.maj_flt.fetch_add(1, Ordering::Relaxed);
+            count_vm_event(VmEvent::PgMajFault);
+        } else {
+            self.acct.min_flt.fetch_add(1, Ordering::Relaxed);
+        }
+        crate::perf_event::perf_sw_page_fault();
+    }
 }
 
 ///
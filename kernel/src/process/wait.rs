@@ -13,8 +13,9 @@
 //! - 当进程需要等待某个条件时，加入等待队列并调用 schedule()
 //! - 当条件满足时，通过 wake_up() 唤醒等待的进程
 
-use alloc::vec::Vec;
-use core::sync::atomic::{AtomicBool, Ordering};
+use core::cell::UnsafeCell;
+use core::ptr;
+use core::sync::atomic::{fence, AtomicBool, AtomicUsize, Ordering};
 use spin::Mutex;
 
 use super::Task;
@@ -26,8 +27,19 @@ pub enum WakeUpHint {
     Normal = 0,
     /// 异步唤醒（不实际唤醒进程，仅标记）
     Async = 1,
+    /// 同步唤醒：唤醒者随后就会睡眠，被唤醒者优先放在唤醒者的 CPU 上 (WF_SYNC)
+    Sync = 2,
 }
 
+/// 唤醒回调 (wait_queue_func_t)
+///
+/// 在队列锁内调用，返回 true 表示完成了一次唤醒；独占项返回 true 时停止唤醒后面的项
+pub type WaitQueueFunc = fn(&WaitQueueEntry) -> bool;
+
+/// 等待队列项 (wait_queue_entry)
+///
+/// 侵入式链表节点：由等待者放在自己的栈上，add 时链入队列，不分配内存。
+/// 链入期间不能移动或释放，被唤醒后必须用 remove 摘下
 #[repr(C)]
 pub struct WaitQueueEntry {
     /// 关联的任务
@@ -36,6 +48,20 @@ pub struct WaitQueueEntry {
     exclusive: bool,
     /// 是否已唤醒
     woken: AtomicBool,
+    /// 唤醒回调 (entry->func)，设置后唤醒时调用回调而不是唤醒任务
+    func: Option<WaitQueueFunc>,
+    /// 回调的私有数据 (entry->private)
+    private: *const (),
+    /// 链表指针 (entry->entry)，由队列锁保护
+    link: UnsafeCell<WaitLink>,
+}
+
+/// 队列项的链表指针
+struct WaitLink {
+    next: *const WaitQueueEntry,
+    prev: *const WaitQueueEntry,
+    /// 是否在队列中
+    queued: bool,
 }
 
 impl WaitQueueEntry {
@@ -49,9 +75,37 @@ impl WaitQueueEntry {
             task,
             exclusive,
             woken: AtomicBool::new(false),
+            func: None,
+            private: ptr::null(),
+            link: UnsafeCell::new(WaitLink {
+                next: ptr::null(),
+                prev: ptr::null(),
+                queued: false,
+            }),
         }
     }
 
+    /// 创建带唤醒回调的等待队列项 (init_waitqueue_func_entry)
+    ///
+    /// 回调项不关联任务，每次唤醒都会调用回调，不会被标记为已唤醒，
+    /// 可以长期留在队列中（poll_table 注册的项即是如此）
+    ///
+    /// # 参数
+    /// * `func` - 唤醒回调
+    /// * `private` - 回调的私有数据
+    /// * `exclusive` - 是否为独占模式
+    pub fn with_callback(func: WaitQueueFunc, private: *const (), exclusive: bool) -> Self {
+        let mut entry = Self::new(ptr::null_mut(), exclusive);
+        entry.func = Some(func);
+        entry.private = private;
+        entry
+    }
+
+    /// 回调的私有数据
+    pub fn private(&self) -> *const () {
+        self.private
+    }
+
     /// 检查是否已被唤醒
     pub fn is_woken(&self) -> bool {
         self.woken.load(Ordering::Acquire)
@@ -62,6 +116,11 @@ impl WaitQueueEntry {
         self.woken.store(true, Ordering::Release);
     }
 
+    /// 清除唤醒标志，以便再次被唤醒（poll 睡眠之前清除 triggered）
+    pub fn clear_woken(&self) {
+        self.woken.store(false, Ordering::Release);
+    }
+
     /// 获取关联的任务
     pub fn task(&self) -> *mut Task {
         self.task
@@ -71,13 +130,32 @@ impl WaitQueueEntry {
     pub fn is_exclusive(&self) -> bool {
         self.exclusive
     }
+
+    /// 链表指针，调用者必须持有队列锁
+    #[inline]
+    unsafe fn link(&self) -> &mut WaitLink {
+        &mut *self.link.get()
+    }
+}
+
+/// 队列的首尾指针
+///
+/// 以空指针结尾而不是像 ListHead 那样指向自己，队列头可以按值移动（const 初始化、
+/// 嵌入按值返回的结构体）；有项链入时队列头正被使用，不会移动
+struct WaitList {
+    first: *const WaitQueueEntry,
+    last: *const WaitQueueEntry,
 }
 
+// 链表只在队列锁内访问，项在链入期间保持有效
+unsafe impl Send for WaitList {}
+
 #[repr(C)]
 pub struct WaitQueueHead {
-    /// 等待队列列表
-    /// 使用 Vec 存储等待的进程
-    list: Mutex<Vec<WaitQueueEntry>>,
+    /// 等待队列链表：非独占项在前，独占项在后
+    list: Mutex<WaitList>,
+    /// 等待者数量，唤醒方不加锁检查 (wq_has_sleeper)
+    nr_waiters: AtomicUsize,
 }
 
 impl WaitQueueHead {
@@ -86,7 +164,11 @@ impl WaitQueueHead {
     /// ...
     pub const fn new() -> Self {
         Self {
-            list: Mutex::new(Vec::new()),
+            list: Mutex::new(WaitList {
+                first: ptr::null(),
+                last: ptr::null(),
+            }),
+            nr_waiters: AtomicUsize::new(0),
         }
     }
 
@@ -94,38 +176,94 @@ impl WaitQueueHead {
     ///
     /// ...
     pub fn init(&self) {
-        // Vec 已经自动初始化
+        // const 初始化已经完成
     }
 
-    /// 添加到等待队列
+    /// 添加到等待队列 (add_wait_queue)
     ///
     /// # 参数
-    /// * `entry` - 等待队列项
+    /// * `entry` - 等待队列项，摘下之前不能移动或释放
+    ///
+    /// 添加后调用者应重新检查等待条件再睡眠：计数在检查之前可见，
+    /// 与唤醒方的 has_waiters 配对，不会丢失唤醒
     ///
     /// ...
-    pub fn add(&self, entry: WaitQueueEntry) {
+    pub fn add(&self, entry: &WaitQueueEntry) {
         let mut list = self.list.lock();
-        // 非独占项添加到头部，独占项添加到尾部
-        if entry.is_exclusive() {
-            list.push(entry);
-        } else {
-            list.insert(0, entry);
+        unsafe {
+            let link = entry.link();
+            if link.queued {
+                return;
+            }
+            link.queued = true;
+            let node = entry as *const WaitQueueEntry;
+            // 非独占项添加到头部，独占项添加到尾部
+            if entry.is_exclusive() {
+                link.next = ptr::null();
+                link.prev = list.last;
+                if list.last.is_null() {
+                    list.first = node;
+                } else {
+                    (*list.last).link().next = node;
+                }
+                list.last = node;
+            } else {
+                link.prev = ptr::null();
+                link.next = list.first;
+                if list.first.is_null() {
+                    list.last = node;
+                } else {
+                    (*list.first).link().prev = node;
+                }
+                list.first = node;
+            }
         }
+        self.nr_waiters.fetch_add(1, Ordering::SeqCst);
     }
 
-    /// 从等待队列移除
+    /// 从等待队列移除 (remove_wait_queue)
     ///
     /// # 参数
-    /// * `task` - 要移除的任务
+    /// * `entry` - 要移除的等待队列项，不在队列中时什么也不做
     ///
     /// ...
-    pub fn remove(&self, task: *mut Task) {
+    pub fn remove(&self, entry: &WaitQueueEntry) {
         let mut list = self.list.lock();
-        list.retain(|entry| entry.task() != task);
+        unsafe {
+            let link = entry.link();
+            if !link.queued {
+                return;
+            }
+            if link.prev.is_null() {
+                list.first = link.next;
+            } else {
+                (*link.prev).link().next = link.next;
+            }
+            if link.next.is_null() {
+                list.last = link.prev;
+            } else {
+                (*link.next).link().prev = link.prev;
+            }
+            link.next = ptr::null();
+            link.prev = ptr::null();
+            link.queued = false;
+        }
+        self.nr_waiters.fetch_sub(1, Ordering::SeqCst);
+    }
+
+    /// 是否有等待者 (wq_has_sleeper)
+    ///
+    /// 不加锁；唤醒方先修改条件再调用，屏障保证看到条件检查之前加入的等待者
+    #[inline]
+    pub fn has_waiters(&self) -> bool {
+        fence(Ordering::SeqCst);
+        self.nr_waiters.load(Ordering::Relaxed) != 0
     }
 
     /// 唤醒等待队列中的进程
     ///
+    /// 没有等待者时不获取队列锁直接返回
+    ///
     /// # 参数
     /// * `mode` - 唤醒模式
     /// * `nr` - 要唤醒的进程数量 (0 表示唤醒所有)
@@ -134,24 +272,39 @@ impl WaitQueueHead {
     /// 实际唤醒的进程数量
     ///
     /// ...
-    pub fn wake_up(&self, _mode: WakeUpHint, nr: usize) -> usize {
+    pub fn wake_up(&self, mode: WakeUpHint, nr: usize) -> usize {
+        if !self.has_waiters() {
+            return 0;
+        }
         let list = self.list.lock();
         let mut awakened = 0;
 
         // 确定最大唤醒数量
         let max_wake = if nr == 0 { usize::MAX } else { nr };
 
-        // 从列表头部开始唤醒
-        for entry in list.iter() {
-            if awakened >= max_wake {
-                break;
-            }
+        // 从链表头部开始唤醒
+        let mut pos = list.first;
+        while !pos.is_null() && awakened < max_wake {
+            let entry = unsafe { &*pos };
+            pos = unsafe { entry.link().next };
 
-            if !entry.is_woken() {
+            if let Some(func) = entry.func {
+                // 回调项不占用唤醒数量；独占的回调项由回调决定是否完成了唤醒
+                if func(entry) && entry.is_exclusive() {
+                    awakened += 1;
+                    break;
+                }
+            } else if !entry.is_woken() {
                 entry.set_woken();
-                // TODO: 实际唤醒进程
-                // 当前简化实现：标记为已唤醒
-                // 完整实现需要将进程添加到运行队列
+                match mode {
+                    WakeUpHint::Normal => {
+                        crate::sched::wake_up_process(entry.task());
+                    }
+                    WakeUpHint::Sync => {
+                        crate::sched::wake_up_process_sync(entry.task());
+                    }
+                    WakeUpHint::Async => {}
+                }
                 awakened += 1;
 
                 // 独占模式：只唤醒一个
@@ -171,6 +324,13 @@ impl WaitQueueHead {
         self.wake_up(WakeUpHint::Normal, 0)
     }
 
+    /// 同步唤醒所有等待的进程 (wake_up_interruptible_sync)
+    ///
+    /// 唤醒者随后就会睡眠或离开，如管道写满后等待读者
+    pub fn wake_up_all_sync(&self) -> usize {
+        self.wake_up(WakeUpHint::Sync, 0)
+    }
+
     /// 唤醒一个进程（独占）
     ///
     /// ...
@@ -198,14 +358,14 @@ macro_rules! wait_event {
             let entry = $crate::process::wait::WaitQueueEntry::new(current, false);
 
             // 添加到等待队列
-            wq_head.add(entry);
+            wq_head.add(&entry);
 
             // 让出 CPU
             #[cfg(feature = "riscv64")]
             crate::sched::schedule();
 
             // 被唤醒后，从等待队列移除
-            wq_head.remove(current);
+            wq_head.remove(&entry);
 
             // 重新检查条件
         }
@@ -237,14 +397,14 @@ macro_rules! wait_event_interruptible {
             let entry = $crate::process::wait::WaitQueueEntry::new(current, false);
 
             // 添加到等待队列
-            wq_head.add(entry);
+            wq_head.add(&entry);
 
             // 让出 CPU
             #[cfg(feature = "riscv64")]
             crate::sched::schedule();
 
             // 被唤醒后，从等待队列移除
-            wq_head.remove(current);
+            wq_head.remove(&entry);
 
             // 重新检查条件
         }
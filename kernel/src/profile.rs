@@ -0,0 +1,209 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内核采样分析 (profile)
+//!
+//! 参考 Linux: kernel/profile.c, tools/perf 的 folded 输出
+//!
+//! 打开后每个时钟 tick 记录一次被打断的上下文：当前任务的 PID、被打断的 PC
+//! 和沿帧指针回溯得到的调用链，写入本 CPU 的环形缓冲区。缓冲区满后覆盖最旧的样本，
+//! 读取看到的是每个 CPU 最近 PROFILE_SAMPLES 个 tick。
+//!
+//! /proc/profile 按 folded 格式导出（每行 `任务名;外层;...;内层 次数`），
+//! 地址保留为十六进制，离线对照内核 ELF 符号化后即可生成火焰图；
+//! 打断用户态时调用链只有 `[user]`。
+//!
+//! 默认关闭，关闭时 tick 只多读一次开关。启动参数 `profile` 或 `profile=1` 打开，
+//! 运行时向 /proc/profile 写入 `1` 打开、`0` 关闭、`reset` 清空
+
+use alloc::collections::BTreeMap;
+use alloc::string::String;
+use alloc::vec::Vec;
+use core::cell::UnsafeCell;
+use core::fmt::Write;
+use core::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+
+use crate::arch::riscv64::stacktrace::{current_frame_pointer, StackWalker};
+use crate::arch::riscv64::trap::TrapFrame;
+use crate::config::MAX_CPUS;
+
+/// 每个样本最多记录的栈帧数（含被打断的 PC）
+pub const PROFILE_DEPTH: usize = 16;
+/// 每个 CPU 环形缓冲区的样本数
+pub const PROFILE_SAMPLES: usize = 1024;
+
+/// 一次采样
+#[derive(Clone, Copy)]
+struct Sample {
+    /// 被打断的任务
+    pid: u32,
+    /// pcs 中有效的栈帧数，0 表示打断的是用户态
+    depth: u32,
+    /// 内层在前：被打断的 PC，然后是各级返回地址
+    pcs: [usize; PROFILE_DEPTH],
+}
+
+impl Sample {
+    const fn new() -> Self {
+        Self { pid: 0, depth: 0, pcs: [0; PROFILE_DEPTH] }
+    }
+}
+
+/// 一个 CPU 的样本环
+struct CpuProfile {
+    /// 写入过的样本总数，下一个样本写在 head % PROFILE_SAMPLES
+    head: AtomicUsize,
+    samples: UnsafeCell<[Sample; PROFILE_SAMPLES]>,
+}
+
+// 只由本 CPU 在时钟中断中写入；读取其他 CPU 正在覆盖的样本只会让该样本不准
+unsafe impl Sync for CpuProfile {}
+
+impl CpuProfile {
+    const fn new() -> Self {
+        Self {
+            head: AtomicUsize::new(0),
+            samples: UnsafeCell::new([Sample::new(); PROFILE_SAMPLES]),
+        }
+    }
+}
+
+static PROFILE: [CpuProfile; MAX_CPUS] = [const { CpuProfile::new() }; MAX_CPUS];
+
+/// 采样开关 (prof_on)
+static ENABLED: AtomicBool = AtomicBool::new(false);
+
+/// 采样是否打开
+#[inline]
+pub fn enabled() -> bool {
+    ENABLED.load(Ordering::Relaxed)
+}
+
+/// 打开或关闭采样
+pub fn set_enabled(on: bool) {
+    ENABLED.store(on, Ordering::Relaxed);
+}
+
+/// 清空所有 CPU 的样本
+pub fn reset() {
+    for profile in PROFILE.iter() {
+        profile.head.store(0, Ordering::Relaxed);
+    }
+}
+
+/// 根据启动参数 `profile` 打开采样 (profile_setup)
+pub fn init() {
+    if crate::cmdline::has_param("profile") || crate::cmdline::get_param("profile").as_deref() == Some("1") {
+        set_enabled(true);
+    }
+}
+
+/// 时钟 tick 中采样一次 (profile_tick)
+///
+/// 在时钟中断中调用，frame 是被打断上下文的 TrapFrame。
+/// 不能内联：回溯从本函数的帧开始，跳过中断处理程序自己的帧
+#[inline(never)]
+pub fn profile_tick(frame: *const TrapFrame, pid: u32) {
+    let cpu = crate::arch::cpu_id() as usize;
+    if cpu >= MAX_CPUS {
+        return;
+    }
+    let mut sample = Sample::new();
+    sample.pid = pid;
+
+    unsafe {
+        // SPP (bit 8) 为 0：打断的是用户态，只记为 [user]
+        if (*frame).sstatus & 0x100 != 0 {
+            sample.pcs[0] = (*frame).sepc as usize;
+            let mut depth = 1;
+            // 被打断的函数在 TrapFrame 之上的同一个内核栈里；
+            // fp 不高于 TrapFrame 的帧属于中断处理程序本身
+            let frame_addr = frame as usize;
+            let fp = current_frame_pointer();
+            let walker = StackWalker::new(fp, fp, frame_addr + crate::process::kstack::KERNEL_STACK_SIZE);
+            for (_, ra) in walker.filter(|&(fp, _)| fp > frame_addr).take(PROFILE_DEPTH - 1) {
+                sample.pcs[depth] = ra;
+                depth += 1;
+            }
+            sample.depth = depth as u32;
+        }
+
+        let profile = &PROFILE[cpu];
+        let head = profile.head.load(Ordering::Relaxed);
+        (*profile.samples.get())[head % PROFILE_SAMPLES] = sample;
+        profile.head.store(head + 1, Ordering::Release);
+    }
+}
+
+/// 所有 CPU 缓冲区中的样本数与被覆盖的样本数
+pub fn sample_counts() -> (usize, usize) {
+    let mut kept = 0;
+    let mut lost = 0;
+    for profile in PROFILE.iter() {
+        let head = profile.head.load(Ordering::Acquire);
+        kept += head.min(PROFILE_SAMPLES);
+        lost += head.saturating_sub(PROFILE_SAMPLES);
+    }
+    (kept, lost)
+}
+
+/// 合并所有 CPU 的样本：(PID, 外层在前的调用链) -> 次数
+fn fold_samples() -> BTreeMap<(u32, Vec<usize>), u64> {
+    let mut folded = BTreeMap::new();
+    for profile in PROFILE.iter() {
+        let head = profile.head.load(Ordering::Acquire);
+        let samples = unsafe { &*profile.samples.get() };
+        for sample in samples.iter().take(head.min(PROFILE_SAMPLES)) {
+            let depth = (sample.depth as usize).min(PROFILE_DEPTH);
+            let stack: Vec<usize> = sample.pcs[..depth].iter().rev().copied().collect();
+            *folded.entry((sample.pid, stack)).or_insert(0) += 1;
+        }
+    }
+    folded
+}
+
+/// 生成 /proc/profile 内容
+///
+/// 第一行是注释：开关、样本数与被覆盖的样本数；之后每行一条 folded 调用栈
+pub fn generate_profile() -> String {
+    let (kept, lost) = sample_counts();
+    let mut out = String::new();
+    let _ = writeln!(out, "# enabled {} samples {} lost {}", enabled() as u8, kept, lost);
+
+    let mut comms: BTreeMap<u32, String> = BTreeMap::new();
+    for ((pid, stack), count) in fold_samples() {
+        let comm = comms.entry(pid).or_insert_with(|| {
+            if pid == 0 {
+                return String::from("swapper");
+            }
+            crate::sched::sched::with_task(pid, |task| task.comm())
+                .filter(|comm| !comm.is_empty())
+                .unwrap_or_else(|| alloc::format!("{}", pid))
+        });
+        out.push_str(comm);
+        if stack.is_empty() {
+            out.push_str(";[user]");
+        }
+        for pc in stack {
+            let _ = write!(out, ";{:#x}", pc);
+        }
+        let _ = writeln!(out, " {}", count);
+    }
+    out
+}
+
+/// 处理 /proc/profile 的写入
+///
+/// # 返回
+/// 成功返回写入的字节数，格式错误返回 -EINVAL
+pub fn write_control(data: &[u8]) -> Result<usize, i32> {
+    match core::str::from_utf8(data).map(|s| s.trim()) {
+        Ok("1") => set_enabled(true),
+        Ok("0") => set_enabled(false),
+        Ok("reset") => reset(),
+        _ => return Err(crate::errno::Errno::InvalidArgument.as_neg_i32()),
+    }
+    Ok(data.len())
+}
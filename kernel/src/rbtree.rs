@@ -0,0 +1,514 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 红黑树实现
+//!
+//! 参考 Linux: include/linux/rbtree.h, lib/rbtree.c
+//!
+//! 用途：
+//! - CFS 调度: cfs_rq::tasks_timeline（按 vruntime 排序）
+//!
+//! 设计特点：
+//! - 侵入式：rb_node 直接嵌入数据结构中，插入/删除不分配内存
+//! - 调用者负责比较：和 Linux 一样，由调用者查找插入位置后调用
+//!   `link_node()` + `insert_color()`
+//! - RbRootCached 缓存最左节点，取最小元素为 O(1)
+
+use core::ptr;
+
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum RbColor {
+    Red,
+    Black,
+}
+
+#[repr(C)]
+pub struct RbNode {
+    /// 父节点
+    pub parent: *mut RbNode,
+    /// 左子节点
+    pub left: *mut RbNode,
+    /// 右子节点
+    pub right: *mut RbNode,
+    /// 节点颜色
+    pub color: RbColor,
+}
+
+impl RbNode {
+    /// 创建一个未链接的节点
+    pub const fn new() -> Self {
+        Self {
+            parent: ptr::null_mut(),
+            left: ptr::null_mut(),
+            right: ptr::null_mut(),
+            color: RbColor::Red,
+        }
+    }
+
+    /// 清空节点链接 (RB_CLEAR_NODE)
+    pub fn clear(&mut self) {
+        self.parent = ptr::null_mut();
+        self.left = ptr::null_mut();
+        self.right = ptr::null_mut();
+        self.color = RbColor::Red;
+    }
+}
+
+#[inline]
+unsafe fn is_red(node: *mut RbNode) -> bool {
+    !node.is_null() && (*node).color == RbColor::Red
+}
+
+#[inline]
+unsafe fn is_black(node: *mut RbNode) -> bool {
+    node.is_null() || (*node).color == RbColor::Black
+}
+
+/// 红黑树根 (struct rb_root)
+#[repr(C)]
+pub struct RbRoot {
+    pub node: *mut RbNode,
+}
+
+impl RbRoot {
+    pub const fn new() -> Self {
+        Self {
+            node: ptr::null_mut(),
+        }
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.node.is_null()
+    }
+
+    /// 将节点链接到查找得到的位置 (rb_link_node)
+    ///
+    /// # Safety
+    /// `link` 必须指向 `parent` 的左/右子指针（或根指针），且该位置为空
+    pub unsafe fn link_node(node: *mut RbNode, parent: *mut RbNode, link: *mut *mut RbNode) {
+        (*node).parent = parent;
+        (*node).left = ptr::null_mut();
+        (*node).right = ptr::null_mut();
+        (*node).color = RbColor::Red;
+        *link = node;
+    }
+
+    unsafe fn rotate_left(&mut self, x: *mut RbNode) {
+        let y = (*x).right;
+        (*x).right = (*y).left;
+        if !(*y).left.is_null() {
+            (*(*y).left).parent = x;
+        }
+        (*y).parent = (*x).parent;
+        let parent = (*x).parent;
+        if parent.is_null() {
+            self.node = y;
+        } else if x == (*parent).left {
+            (*parent).left = y;
+        } else {
+            (*parent).right = y;
+        }
+        (*y).left = x;
+        (*x).parent = y;
+    }
+
+    unsafe fn rotate_right(&mut self, x: *mut RbNode) {
+        let y = (*x).left;
+        (*x).left = (*y).right;
+        if !(*y).right.is_null() {
+            (*(*y).right).parent = x;
+        }
+        (*y).parent = (*x).parent;
+        let parent = (*x).parent;
+        if parent.is_null() {
+            self.node = y;
+        } else if x == (*parent).right {
+            (*parent).right = y;
+        } else {
+            (*parent).left = y;
+        }
+        (*y).right = x;
+        (*x).parent = y;
+    }
+
+    /// 插入后重新平衡 (rb_insert_color)
+    ///
+    /// # Safety
+    /// node 必须已通过 `link_node()` 链接到本树
+    pub unsafe fn insert_color(&mut self, node: *mut RbNode) {
+        let mut z = node;
+        while is_red((*z).parent) {
+            let parent = (*z).parent;
+            // 父节点为红色，所以父节点不是根，祖父节点一定存在
+            let gparent = (*parent).parent;
+
+            if parent == (*gparent).left {
+                let uncle = (*gparent).right;
+                if is_red(uncle) {
+                    (*parent).color = RbColor::Black;
+                    (*uncle).color = RbColor::Black;
+                    (*gparent).color = RbColor::Red;
+                    z = gparent;
+                    continue;
+                }
+                if z == (*parent).right {
+                    z = parent;
+                    self.rotate_left(z);
+                }
+                let parent = (*z).parent;
+                let gparent = (*parent).parent;
+                (*parent).color = RbColor::Black;
+                (*gparent).color = RbColor::Red;
+                self.rotate_right(gparent);
+            } else {
+                let uncle = (*gparent).left;
+                if is_red(uncle) {
+                    (*parent).color = RbColor::Black;
+                    (*uncle).color = RbColor::Black;
+                    (*gparent).color = RbColor::Red;
+                    z = gparent;
+                    continue;
+                }
+                if z == (*parent).left {
+                    z = parent;
+                    self.rotate_right(z);
+                }
+                let parent = (*z).parent;
+                let gparent = (*parent).parent;
+                (*parent).color = RbColor::Black;
+                (*gparent).color = RbColor::Red;
+                self.rotate_left(gparent);
+            }
+        }
+        (*self.node).color = RbColor::Black;
+    }
+
+    /// 用 v 替换 u 在树中的位置
+    unsafe fn transplant(&mut self, u: *mut RbNode, v: *mut RbNode) {
+        let parent = (*u).parent;
+        if parent.is_null() {
+            self.node = v;
+        } else if u == (*parent).left {
+            (*parent).left = v;
+        } else {
+            (*parent).right = v;
+        }
+        if !v.is_null() {
+            (*v).parent = parent;
+        }
+    }
+
+    /// 从树中删除节点 (rb_erase)
+    ///
+    /// # Safety
+    /// node 必须在本树中
+    pub unsafe fn erase(&mut self, node: *mut RbNode) {
+        let z = node;
+        let mut orig_color = (*z).color;
+        let x;
+        let x_parent;
+
+        if (*z).left.is_null() {
+            x = (*z).right;
+            x_parent = (*z).parent;
+            self.transplant(z, x);
+        } else if (*z).right.is_null() {
+            x = (*z).left;
+            x_parent = (*z).parent;
+            self.transplant(z, x);
+        } else {
+            // 两个子节点：用后继节点 y 替换 z
+            let y = Self::leftmost((*z).right);
+            orig_color = (*y).color;
+            x = (*y).right;
+            if (*y).parent == z {
+                x_parent = y;
+            } else {
+                x_parent = (*y).parent;
+                self.transplant(y, x);
+                (*y).right = (*z).right;
+                (*(*y).right).parent = y;
+            }
+            self.transplant(z, y);
+            (*y).left = (*z).left;
+            (*(*y).left).parent = y;
+            (*y).color = (*z).color;
+        }
+
+        if orig_color == RbColor::Black {
+            self.erase_fixup(x, x_parent);
+        }
+
+        (*z).clear();
+    }
+
+    unsafe fn erase_fixup(&mut self, mut x: *mut RbNode, mut parent: *mut RbNode) {
+        while x != self.node && is_black(x) {
+            if parent.is_null() {
+                break;
+            }
+            if x == (*parent).left {
+                let mut w = (*parent).right;
+                if is_red(w) {
+                    (*w).color = RbColor::Black;
+                    (*parent).color = RbColor::Red;
+                    self.rotate_left(parent);
+                    w = (*parent).right;
+                }
+                if is_black((*w).left) && is_black((*w).right) {
+                    (*w).color = RbColor::Red;
+                    x = parent;
+                    parent = (*x).parent;
+                } else {
+                    if is_black((*w).right) {
+                        (*(*w).left).color = RbColor::Black;
+                        (*w).color = RbColor::Red;
+                        self.rotate_right(w);
+                        w = (*parent).right;
+                    }
+                    (*w).color = (*parent).color;
+                    (*parent).color = RbColor::Black;
+                    if !(*w).right.is_null() {
+                        (*(*w).right).color = RbColor::Black;
+                    }
+                    self.rotate_left(parent);
+                    x = self.node;
+                    parent = ptr::null_mut();
+                }
+            } else {
+                let mut w = (*parent).left;
+                if is_red(w) {
+                    (*w).color = RbColor::Black;
+                    (*parent).color = RbColor::Red;
+                    self.rotate_right(parent);
+                    w = (*parent).left;
+                }
+                if is_black((*w).right) && is_black((*w).left) {
+                    (*w).color = RbColor::Red;
+                    x = parent;
+                    parent = (*x).parent;
+                } else {
+                    if is_black((*w).left) {
+                        (*(*w).right).color = RbColor::Black;
+                        (*w).color = RbColor::Red;
+                        self.rotate_left(w);
+                        w = (*parent).left;
+                    }
+                    (*w).color = (*parent).color;
+                    (*parent).color = RbColor::Black;
+                    if !(*w).left.is_null() {
+                        (*(*w).left).color = RbColor::Black;
+                    }
+                    self.rotate_right(parent);
+                    x = self.node;
+                    parent = ptr::null_mut();
+                }
+            }
+        }
+        if !x.is_null() {
+            (*x).color = RbColor::Black;
+        }
+    }
+
+    unsafe fn leftmost(mut node: *mut RbNode) -> *mut RbNode {
+        while !(*node).left.is_null() {
+            node = (*node).left;
+        }
+        node
+    }
+
+    /// 获取最小节点 (rb_first)
+    pub fn first(&self) -> *mut RbNode {
+        if self.node.is_null() {
+            return ptr::null_mut();
+        }
+        unsafe { Self::leftmost(self.node) }
+    }
+
+    /// 获取最大节点 (rb_last)
+    pub fn last(&self) -> *mut RbNode {
+        let mut node = self.node;
+        if node.is_null() {
+            return ptr::null_mut();
+        }
+        unsafe {
+            while !(*node).right.is_null() {
+                node = (*node).right;
+            }
+        }
+        node
+    }
+
+    /// 获取中序后继节点 (rb_next)
+    ///
+    /// # Safety
+    /// node 必须在树中
+    pub unsafe fn next(node: *mut RbNode) -> *mut RbNode {
+        if !(*node).right.is_null() {
+            return Self::leftmost((*node).right);
+        }
+        let mut node = node;
+        let mut parent = (*node).parent;
+        while !parent.is_null() && node == (*parent).right {
+            node = parent;
+            parent = (*node).parent;
+        }
+        parent
+    }
+}
+
+/// 缓存最左节点的红黑树 (struct rb_root_cached)
+#[repr(C)]
+pub struct RbRootCached {
+    pub rb_root: RbRoot,
+    pub rb_leftmost: *mut RbNode,
+}
+
+impl RbRootCached {
+    pub const fn new() -> Self {
+        Self {
+            rb_root: RbRoot::new(),
+            rb_leftmost: ptr::null_mut(),
+        }
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.rb_root.is_empty()
+    }
+
+    /// 获取最小节点 (rb_first_cached)，O(1)
+    #[inline]
+    pub fn first(&self) -> *mut RbNode {
+        self.rb_leftmost
+    }
+
+    /// 插入后重新平衡 (rb_insert_color_cached)
+    ///
+    /// # Safety
+    /// node 必须已通过 `RbRoot::link_node()` 链接到本树；
+    /// `leftmost` 表示查找插入位置时是否一直向左
+    pub unsafe fn insert_color(&mut self, node: *mut RbNode, leftmost: bool) {
+        if leftmost {
+            self.rb_leftmost = node;
+        }
+        self.rb_root.insert_color(node);
+    }
+
+    /// 从树中删除节点 (rb_erase_cached)
+    ///
+    /// # Safety
+    /// node 必须在本树中
+    pub unsafe fn erase(&mut self, node: *mut RbNode) {
+        if self.rb_leftmost == node {
+            self.rb_leftmost = RbRoot::next(node);
+        }
+        self.rb_root.erase(node);
+    }
+}
+
+#[cfg(test)]
+mod tests {
+    use super::*;
+
+    #[repr(C)]
+    struct Item {
+        node: RbNode,
+        key: u64,
+    }
+
+    unsafe fn item_of(node: *mut RbNode) -> *mut Item {
+        node as *mut Item
+    }
+
+    unsafe fn insert(root: &mut RbRootCached, item: *mut Item) {
+        let mut link = &mut root.rb_root.node as *mut *mut RbNode;
+        let mut parent = ptr::null_mut();
+        let mut leftmost = true;
+        while !(*link).is_null() {
+            parent = *link;
+            if (*item).key < (*item_of(parent)).key {
+                link = &mut (*parent).left;
+            } else {
+                link = &mut (*parent).right;
+                leftmost = false;
+            }
+        }
+        RbRoot::link_node(&mut (*item).node, parent, link);
+        root.insert_color(&mut (*item).node, leftmost);
+    }
+
+    /// 校验红黑性质，返回黑高
+    unsafe fn check(node: *mut RbNode) -> usize {
+        if node.is_null() {
+            return 1;
+        }
+        if is_red(node) {
+            assert!(is_black((*node).left) && is_black((*node).right));
+        }
+        if !(*node).left.is_null() {
+            assert_eq!((*(*node).left).parent, node);
+        }
+        if !(*node).right.is_null() {
+            assert_eq!((*(*node).right).parent, node);
+        }
+        let lh = check((*node).left);
+        let rh = check((*node).right);
+        assert_eq!(lh, rh);
+        lh + if is_black(node) { 1 } else { 0 }
+    }
+
+    #[test]
+    fn test_rbtree_insert_erase() {
+        unsafe {
+            let mut items: [Item; 64] = core::array::from_fn(|i| Item {
+                node: RbNode::new(),
+                // 伪随机顺序的键，包含重复值
+                key: ((i as u64) * 37) % 50,
+            });
+            let mut root = RbRootCached::new();
+            for item in items.iter_mut() {
+                insert(&mut root, item);
+                check(root.rb_root.node);
+            }
+
+            // 中序遍历有序
+            let mut prev = 0;
+            let mut count = 0;
+            let mut node = root.first();
+            while !node.is_null() {
+                let key = (*item_of(node)).key;
+                assert!(key >= prev);
+                prev = key;
+                count += 1;
+                node = RbRoot::next(node);
+            }
+            assert_eq!(count, 64);
+            // 最大节点没有后继
+            assert_eq!((*item_of(root.rb_root.last())).key, prev);
+            assert!(RbRoot::next(root.rb_root.last()).is_null());
+
+            // 交替删除最小节点和中间节点
+            for i in 0..64 {
+                let victim = if i % 2 == 0 {
+                    root.first()
+                } else {
+                    let mut n = root.first();
+                    for _ in 0..(32 - i / 2).min(63 - i) / 2 {
+                        n = RbRoot::next(n);
+                    }
+                    n
+                };
+                root.erase(victim);
+                check(root.rb_root.node);
+                assert_eq!(root.first(), root.rb_root.first());
+            }
+            assert!(root.is_empty());
+            assert!(root.first().is_null());
+            assert!(root.rb_root.last().is_null());
+        }
+    }
+}
@@ -12,11 +12,31 @@ use core::arch::asm;
 pub use sbi_rt::set_timer;
 
 /// SBI Extension IDs
+pub const SBI_EXT_BASE: usize = 0x10;
 pub const SBI_EXT_IPI: usize = 0x735049;  // "IPI"
+pub const SBI_EXT_PMU: usize = 0x504D55;  // "PMU"
+pub const SBI_EXT_HSM: usize = 0x48534D;  // "HSM"
+
+/// SBI Base Extension Function IDs
+pub const SBI_EXT_BASE_PROBE_EXT: usize = 3;
 
 /// SBI IPI Extension Function IDs
 pub const SBI_EXT_IPI_SEND_IPI: usize = 0;
 
+/// SBI HSM Extension Function IDs
+pub const SBI_EXT_HSM_HART_SUSPEND: usize = 3;
+
+/// hart_suspend 的挂起类型：默认的保持状态挂起，寄存器与 CSR 不丢失
+pub const SBI_HSM_SUSPEND_RET_DEFAULT: usize = 0x0000_0000;
+
+/// SBI PMU Extension Function IDs
+pub const SBI_EXT_PMU_NUM_COUNTERS: usize = 0;
+pub const SBI_EXT_PMU_COUNTER_GET_INFO: usize = 1;
+pub const SBI_EXT_PMU_COUNTER_CFG_MATCH: usize = 2;
+pub const SBI_EXT_PMU_COUNTER_START: usize = 3;
+pub const SBI_EXT_PMU_COUNTER_STOP: usize = 4;
+pub const SBI_EXT_PMU_COUNTER_FW_READ: usize = 5;
+
 /// SBI 错误码
 pub const SBI_SUCCESS: i64 = 0;
 pub const SBI_ERR_FAILURE: i64 = -1;
@@ -25,6 +45,50 @@ pub const SBI_ERR_INVALID_PARAM: i64 = -3;
 pub const SBI_ERR_DENIED: i64 = -4;
 pub const SBI_ERR_INVALID_ADDRESS: i64 = -5;
 
+/// SBI 调用的返回值 (struct sbiret)
+#[derive(Debug, Clone, Copy)]
+pub struct SbiRet {
+    pub error: i64,
+    pub value: usize,
+}
+
+/// 通用 SBI 调用 (sbi_ecall)
+///
+/// a7 = 扩展 ID，a6 = 函数 ID，a0-a4 传参；返回时 a0 是错误码，a1 是返回值
+pub fn sbi_ecall(ext: usize, fid: usize, args: [usize; 5]) -> SbiRet {
+    let mut error = args[0];
+    let mut value = args[1];
+    unsafe {
+        asm!(
+            "ecall",
+            in("a7") ext,
+            in("a6") fid,
+            inout("a0") error,
+            inout("a1") value,
+            in("a2") args[2],
+            in("a3") args[3],
+            in("a4") args[4],
+        );
+    }
+    SbiRet { error: error as i64, value }
+}
+
+/// 固件是否实现了某个扩展 (sbi_probe_extension)
+pub fn probe_extension(ext: usize) -> bool {
+    let ret = sbi_ecall(SBI_EXT_BASE, SBI_EXT_BASE_PROBE_EXT, [ext, 0, 0, 0, 0]);
+    ret.error == SBI_SUCCESS && ret.value != 0
+}
+
+/// 以保持状态挂起本 hart (sbi_suspend, SBI_HSM_SUSPEND_RET_DEFAULT)
+///
+/// 与 wfi 一样在 sie 中使能的中断待处理时返回，固件可以借此进入更深的低功耗状态
+///
+/// # 返回
+/// SBI 错误码，SBI_SUCCESS 表示挂起后被中断唤醒
+pub fn hart_suspend_retentive() -> i64 {
+    sbi_ecall(SBI_EXT_HSM, SBI_EXT_HSM_HART_SUSPEND, [SBI_HSM_SUSPEND_RET_DEFAULT, 0, 0, 0, 0]).error
+}
+
 /// 发送 IPI 到指定 hart
 ///
 /// # 参数
@@ -32,17 +96,30 @@ pub const SBI_ERR_INVALID_ADDRESS: i64 = -5;
 ///
 /// # 返回
 /// * `bool` - true 表示成功，false 表示失败
+pub fn send_ipi(hart_id: usize) -> bool {
+    send_ipi_mask(1 << hart_id, 0)
+}
+
+/// 发送 IPI 到 hart 位图中的所有 hart (sbi_send_ipi)
+///
+/// 一次 SBI 调用通知多个 hart，比逐个发送少陷入固件
+///
+/// # 参数
+/// * `hart_mask` - 目标 hart 位图，第 n 位对应 hart_mask_base + n
+/// * `hart_mask_base` - 位图起始的 hart ID
+///
+/// # 返回
+/// * `bool` - true 表示成功，false 表示失败
 ///
 /// # 实现
 /// 使用 SBI IPI Extension (EID #0x735049)
-pub fn send_ipi(hart_id: usize) -> bool {
+pub fn send_ipi_mask(hart_mask: usize, hart_mask_base: usize) -> bool {
     unsafe {
         let sbi_ext_id: u64 = SBI_EXT_IPI as u64;
         let sbi_func_id: u64 = SBI_EXT_IPI_SEND_IPI as u64;
-        let hart_mask: u64 = 1u64 << hart_id;
 
-        let mut error: u64 = hart_mask;
-        let mut value: u64 = 0u64;
+        let mut error: u64 = hart_mask as u64;
+        let mut value: u64 = hart_mask_base as u64;
 
         asm!(
             "ecall",
@@ -56,8 +133,9 @@ pub fn send_ipi(hart_id: usize) -> bool {
         // SBI 规范：error = 0 表示成功
         if error as i64 != SBI_SUCCESS {
             // SBI 调用失败
-            crate::println!("sbi: send_ipi to hart {} failed, error={} ({})",
-                hart_id,
+            crate::println!("sbi: send_ipi to harts {:#x}+{} failed, error={} ({})",
+                hart_mask,
+                hart_mask_base,
                 error as i64,
                 match error as i64 {
                     SBI_ERR_NOT_SUPPORTED => "NOT_SUPPORTED",
@@ -0,0 +1,137 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 每 CPU 工作窃取双端队列 (Chase-Lev work-stealing deque)
+//!
+//! 参考: D. Chase, Y. Lev, "Dynamic Circular Work-Stealing Deque" (SPAA 2005)
+//!       N. M. Lê et al., "Correct and Efficient Work-Stealing for Weak
+//!       Memory Models" (PPoPP 2013)
+//!
+//! - 所有者 CPU 在底部 push/pop（在自己的运行队列锁内调用，所有者之间互斥）
+//! - 其他 CPU 在顶部 steal，只使用 CAS，不获取所有者的运行队列锁
+//! - 固定容量的环形缓冲区，队列满时 push 失败，由调用者回退到本地入队
+//!
+//! 队列中的任务已在全局任务表中注册，但不在任何运行队列上，
+//! 窃取成功后由窃取者加入自己的运行队列。
+
+use crate::process::task::Task;
+use core::sync::atomic::{fence, AtomicIsize, AtomicPtr, Ordering};
+
+/// 每个队列的容量（必须是 2 的幂）
+pub const STEAL_DEQUE_SIZE: usize = 64;
+
+const SLOT_INIT: AtomicPtr<Task> = AtomicPtr::new(core::ptr::null_mut());
+
+pub struct StealDeque {
+    /// 窃取端索引（只增不减）
+    top: AtomicIsize,
+    /// 所有者端索引
+    bottom: AtomicIsize,
+    /// 环形缓冲区
+    buf: [AtomicPtr<Task>; STEAL_DEQUE_SIZE],
+}
+
+impl StealDeque {
+    pub const fn new() -> Self {
+        Self {
+            top: AtomicIsize::new(0),
+            bottom: AtomicIsize::new(0),
+            buf: [SLOT_INIT; STEAL_DEQUE_SIZE],
+        }
+    }
+
+    #[inline]
+    fn slot(&self, index: isize) -> &AtomicPtr<Task> {
+        &self.buf[(index as usize) & (STEAL_DEQUE_SIZE - 1)]
+    }
+
+    /// 队列中的任务数（近似值，可能与并发的 steal 竞争）
+    #[inline]
+    pub fn len(&self) -> usize {
+        let b = self.bottom.load(Ordering::Relaxed);
+        let t = self.top.load(Ordering::Relaxed);
+        if b > t { (b - t) as usize } else { 0 }
+    }
+
+    #[inline]
+    pub fn is_empty(&self) -> bool {
+        self.len() == 0
+    }
+
+    /// 所有者在底部压入任务
+    ///
+    /// # 返回
+    /// 队列已满时返回 false
+    ///
+    /// # Safety
+    /// 只能由所有者 CPU 调用，且所有者的 push/pop 之间必须互斥
+    pub unsafe fn push(&self, task: *mut Task) -> bool {
+        let b = self.bottom.load(Ordering::Relaxed);
+        let t = self.top.load(Ordering::Acquire);
+        if b - t >= STEAL_DEQUE_SIZE as isize {
+            return false;
+        }
+        self.slot(b).store(task, Ordering::Relaxed);
+        fence(Ordering::Release);
+        self.bottom.store(b + 1, Ordering::Relaxed);
+        true
+    }
+
+    /// 所有者从底部弹出任务（LIFO，缓存最热）
+    ///
+    /// # Safety
+    /// 只能由所有者 CPU 调用，且所有者的 push/pop 之间必须互斥
+    pub unsafe fn pop(&self) -> Option<*mut Task> {
+        let b = self.bottom.load(Ordering::Relaxed) - 1;
+        self.bottom.store(b, Ordering::Relaxed);
+        fence(Ordering::SeqCst);
+        let t = self.top.load(Ordering::Relaxed);
+
+        if t > b {
+            // 队列为空
+            self.bottom.store(b + 1, Ordering::Relaxed);
+            return None;
+        }
+
+        let task = self.slot(b).load(Ordering::Relaxed);
+        if t == b {
+            // 最后一个元素：与窃取者竞争
+            let won = self
+                .top
+                .compare_exchange(t, t + 1, Ordering::SeqCst, Ordering::Relaxed)
+                .is_ok();
+            self.bottom.store(b + 1, Ordering::Relaxed);
+            if !won {
+                return None;
+            }
+        }
+        Some(task)
+    }
+
+    /// 其他 CPU 从顶部窃取任务（FIFO，最早发布的任务）
+    ///
+    /// 可以被任意 CPU 并发调用，不需要任何锁
+    pub fn steal(&self) -> Option<*mut Task> {
+        loop {
+            let t = self.top.load(Ordering::Acquire);
+            fence(Ordering::SeqCst);
+            let b = self.bottom.load(Ordering::Acquire);
+
+            if t >= b {
+                return None;
+            }
+
+            let task = self.slot(t).load(Ordering::Relaxed);
+            if self
+                .top
+                .compare_exchange(t, t + 1, Ordering::SeqCst, Ordering::Relaxed)
+                .is_ok()
+            {
+                return Some(task);
+            }
+            // 与其他窃取者或所有者的 pop 竞争失败，重试
+        }
+    }
+}
@@ -0,0 +1,522 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 完全公平调度类 (CFS)
+//!
+//! 参考 Linux: kernel/sched/fair.c
+//!
+//! - 每个任务维护虚拟运行时间 vruntime，按 nice 权重缩放
+//! - 可运行任务按 vruntime 组织在红黑树中，总是选择最左（最小）节点
+//! - 调度周期随可运行任务数增长，每个任务的时间片按权重比例分配
+//! - 正在运行的任务 (cfs_rq::curr) 不在红黑树中
+//! - 任务组的份额缩放组内任务的权重；组的带宽用完时，组内任务在切换或被选中时
+//!   移到节流链表，下一个周期由 tick 放回红黑树 (group.rs)
+//!
+//! 适用策略: SCHED_NORMAL、SCHED_BATCH、SCHED_IDLE
+
+use crate::process::task::{Task, TaskState, SchedPolicy};
+use crate::rbtree::{RbNode, RbRoot, RbRootCached};
+use crate::sched::group::{self, TaskGroup};
+use crate::sched::stats::SchedInfo;
+use alloc::vec::Vec;
+use core::mem::offset_of;
+use core::sync::atomic::AtomicBool;
+
+/// nice 0 对应的权重 (NICE_0_LOAD)
+pub const NICE_0_LOAD: u64 = 1024;
+
+/// SCHED_IDLE 任务的权重 (WEIGHT_IDLEPRIO)
+const WEIGHT_IDLEPRIO: u64 = 3;
+
+/// 实时优先级数量 (MAX_RT_PRIO)
+pub const MAX_RT_PRIO: i32 = 100;
+
+/// 调度延迟目标：在此周期内每个可运行任务至少运行一次 (sysctl_sched_latency)
+const SCHED_LATENCY_NS: u64 = 6_000_000;
+
+/// 最小调度粒度 (sysctl_sched_min_granularity)
+const SCHED_MIN_GRANULARITY_NS: u64 = 750_000;
+
+/// 调度周期可容纳的任务数 (sched_nr_latency = latency / min_granularity)
+const SCHED_NR_LATENCY: usize = 8;
+
+/// nice 值到权重的映射表 (sched_prio_to_weight)
+///
+/// 相邻 nice 值之间约有 10% 的 CPU 时间差（权重比约 1.25）
+const SCHED_PRIO_TO_WEIGHT: [u64; 40] = [
+    /* -20 */ 88761, 71755, 56483, 46273, 36291,
+    /* -15 */ 29154, 23254, 18705, 14949, 11916,
+    /* -10 */ 9548, 7620, 6100, 4904, 3906,
+    /*  -5 */ 3121, 2501, 1991, 1586, 1277,
+    /*   0 */ 1024, 820, 655, 526, 423,
+    /*   5 */ 335, 272, 215, 172, 137,
+    /*  10 */ 110, 87, 70, 56, 45,
+    /*  15 */ 36, 29, 23, 18, 15,
+];
+
+/// 调度实体 (struct sched_entity)
+pub struct SchedEntity {
+    /// 红黑树节点（链接到 cfs_rq::tasks_timeline）
+    pub run_node: RbNode,
+    /// 入队时计算的权重
+    pub load_weight: u64,
+    /// 是否在 CFS 运行队列上（在红黑树中或正在运行）
+    pub on_rq: bool,
+    /// 本次开始运行的时间戳 (ns)
+    pub exec_start: u64,
+    /// 累计实际运行时间 (ns)
+    pub sum_exec_runtime: u64,
+    /// 本次被选中时的 sum_exec_runtime，用于计算已运行的时间片
+    pub prev_sum_exec_runtime: u64,
+    /// 虚拟运行时间 (ns)
+    pub vruntime: u64,
+    /// 上次离开 CPU 的时间戳 (ns)，判断缓存是否还热 (task_hot)
+    pub last_ran: u64,
+    /// 正在 CPU 上运行，或已切换走但上下文可能还没保存完 (task_struct::on_cpu)
+    ///
+    /// 置位期间唤醒不会把任务迁移到其他 CPU
+    pub on_cpu: AtomicBool,
+    /// 切换走时保存的抢占计数 (thread_info::preempt_count)
+    pub preempt_count: usize,
+    /// 所属的任务组，null 表示根组 (sched_task_group)
+    pub group: *mut TaskGroup,
+    /// 计入组负载的任务权重，不在组的可运行负载中时为 0
+    pub group_load: u64,
+    /// 组的带宽用完，暂时离开运行队列 (throttled)
+    pub throttled: bool,
+    /// 调度统计 (sched_info)
+    pub sched_info: SchedInfo,
+    /// 不可中断睡眠时计入了平均负载，唤醒时减去 (sched_contributes_to_load)
+    pub sched_contributes_to_load: bool,
+}
+
+impl SchedEntity {
+    pub const fn new() -> Self {
+        Self {
+            run_node: RbNode::new(),
+            load_weight: NICE_0_LOAD,
+            on_rq: false,
+            exec_start: 0,
+            sum_exec_runtime: 0,
+            prev_sum_exec_runtime: 0,
+            vruntime: 0,
+            last_ran: 0,
+            on_cpu: AtomicBool::new(false),
+            preempt_count: 0,
+            group: core::ptr::null_mut(),
+            group_load: 0,
+            throttled: false,
+            sched_info: SchedInfo::new(),
+            sched_contributes_to_load: false,
+        }
+    }
+}
+
+/// 策略是否属于 CFS 调度类
+#[inline]
+pub fn fair_policy(policy: SchedPolicy) -> bool {
+    matches!(policy, SchedPolicy::Normal | SchedPolicy::Batch | SchedPolicy::Idle)
+}
+
+/// 根据静态优先级计算任务权重 (set_load_weight)
+pub fn task_load_weight(task: &Task) -> u64 {
+    if task.policy() == SchedPolicy::Idle {
+        return WEIGHT_IDLEPRIO;
+    }
+    let idx = (task.static_prio() - MAX_RT_PRIO).clamp(0, 39) as usize;
+    SCHED_PRIO_TO_WEIGHT[idx]
+}
+
+/// 调度器时钟 (sched_clock)，单位纳秒
+#[inline]
+pub fn sched_clock() -> u64 {
+    #[cfg(feature = "riscv64")]
+    {
+        use crate::drivers::timer::{read_time, CLOCK_FREQ};
+        read_time() * (1_000_000_000 / CLOCK_FREQ)
+    }
+    #[cfg(not(feature = "riscv64"))]
+    {
+        0
+    }
+}
+
+/// 按权重缩放实际运行时间 (calc_delta_fair)
+#[inline]
+fn calc_delta_fair(delta: u64, weight: u64) -> u64 {
+    if weight == NICE_0_LOAD {
+        delta
+    } else {
+        delta * NICE_0_LOAD / weight.max(1)
+    }
+}
+
+/// 调度周期 (__sched_period)
+///
+/// 可运行任务不多时为固定延迟目标；超过 sched_nr_latency 后
+/// 按最小粒度线性增长，保证每个任务的时间片不小于 min_granularity
+#[inline]
+fn sched_period(nr_running: usize) -> u64 {
+    if nr_running > SCHED_NR_LATENCY {
+        nr_running as u64 * SCHED_MIN_GRANULARITY_NS
+    } else {
+        SCHED_LATENCY_NS
+    }
+}
+
+#[inline]
+unsafe fn task_of(node: *mut RbNode) -> *mut Task {
+    (node as usize - offset_of!(SchedEntity, run_node) - offset_of!(Task, se)) as *mut Task
+}
+
+/// CFS 运行队列 (struct cfs_rq)
+pub struct CfsRq {
+    /// 按 vruntime 排序的可运行任务（不含 curr）
+    tasks_timeline: RbRootCached,
+    /// 当前正在运行的 CFS 任务
+    curr: *mut Task,
+    /// 单调递增的最小 vruntime，作为新任务/唤醒任务的放置基准
+    min_vruntime: u64,
+    /// 可运行任务数（含 curr）
+    nr_running: usize,
+    /// 可运行任务的总权重（含 curr）
+    load_weight: u64,
+    /// 组带宽用完而离开队列的任务 (throttled_list)
+    throttled: Vec<*mut Task>,
+}
+
+impl CfsRq {
+    pub const fn new() -> Self {
+        Self {
+            tasks_timeline: RbRootCached::new(),
+            curr: core::ptr::null_mut(),
+            min_vruntime: 0,
+            nr_running: 0,
+            load_weight: 0,
+            throttled: Vec::new(),
+        }
+    }
+
+    #[inline]
+    pub fn nr_running(&self) -> usize {
+        self.nr_running
+    }
+
+    #[inline]
+    pub fn min_vruntime(&self) -> u64 {
+        self.min_vruntime
+    }
+
+    /// 任务的理想时间片 (sched_slice)，单位纳秒
+    pub fn sched_slice(&self, task: &Task) -> u64 {
+        let nr = self.nr_running + if task.se.on_rq { 0 } else { 1 };
+        let load = self.load_weight + if task.se.on_rq { 0 } else { task.se.load_weight };
+        sched_period(nr) * task.se.load_weight / load.max(1)
+    }
+
+    /// 更新 min_vruntime (update_min_vruntime)
+    unsafe fn update_min_vruntime(&mut self) {
+        let mut vruntime = self.min_vruntime;
+        let mut have = false;
+
+        if !self.curr.is_null() && (*self.curr).se.on_rq {
+            vruntime = (*self.curr).se.vruntime;
+            have = true;
+        }
+
+        let leftmost = self.tasks_timeline.first();
+        if !leftmost.is_null() {
+            let left_vruntime = (*task_of(leftmost)).se.vruntime;
+            vruntime = if have { vruntime.min(left_vruntime) } else { left_vruntime };
+        }
+
+        // min_vruntime 只增不减
+        self.min_vruntime = self.min_vruntime.max(vruntime);
+    }
+
+    /// 结算当前任务的运行时间 (update_curr)
+    pub fn update_curr(&mut self) {
+        let curr = self.curr;
+        if curr.is_null() {
+            return;
+        }
+        unsafe {
+            let now = sched_clock();
+            let se = &mut (*curr).se;
+            let delta_exec = now.saturating_sub(se.exec_start);
+            se.exec_start = now;
+            se.sum_exec_runtime += delta_exec;
+            se.vruntime += calc_delta_fair(delta_exec, se.load_weight);
+            group::account_runtime(curr, delta_exec, now);
+            self.update_min_vruntime();
+        }
+    }
+
+    /// 按 vruntime 插入红黑树 (__enqueue_entity)
+    unsafe fn enqueue_entity(&mut self, task: *mut Task) {
+        let key = (*task).se.vruntime;
+        let mut link = &mut self.tasks_timeline.rb_root.node as *mut *mut RbNode;
+        let mut parent = core::ptr::null_mut();
+        let mut leftmost = true;
+
+        while !(*link).is_null() {
+            parent = *link;
+            if key < (*task_of(parent)).se.vruntime {
+                link = &mut (*parent).left;
+            } else {
+                link = &mut (*parent).right;
+                leftmost = false;
+            }
+        }
+
+        let node = &mut (*task).se.run_node as *mut RbNode;
+        RbRoot::link_node(node, parent, link);
+        self.tasks_timeline.insert_color(node, leftmost);
+    }
+
+    /// 从红黑树删除 (__dequeue_entity)
+    unsafe fn dequeue_entity(&mut self, task: *mut Task) {
+        self.tasks_timeline.erase(&mut (*task).se.run_node);
+    }
+
+    /// 放置新加入的任务 (place_entity)
+    ///
+    /// 新任务从 min_vruntime 之后一个虚拟时间片开始，避免 fork 炸弹抢占；
+    /// 睡眠唤醒的任务最多获得半个调度延迟的补偿，避免长时间睡眠后独占 CPU
+    unsafe fn place_entity(&mut self, task: *mut Task) {
+        let se = &mut (*task).se;
+        let vruntime = if se.sum_exec_runtime == 0 && se.vruntime == 0 {
+            let slice = sched_period(self.nr_running + 1) / (self.nr_running as u64 + 1);
+            self.min_vruntime + calc_delta_fair(slice, se.load_weight)
+        } else {
+            self.min_vruntime.saturating_sub(SCHED_LATENCY_NS / 2)
+        };
+        se.vruntime = se.vruntime.max(vruntime);
+    }
+
+    /// 任务加入 CFS 运行队列 (enqueue_task_fair)
+    ///
+    /// # Safety
+    /// task 必须有效
+    pub unsafe fn enqueue(&mut self, task: *mut Task) {
+        if (*task).se.on_rq {
+            return;
+        }
+
+        self.update_curr();
+
+        (*task).se.load_weight = group::account_enqueue(task, task_load_weight(&*task));
+        self.place_entity(task);
+
+        if task != self.curr {
+            self.enqueue_entity(task);
+        }
+        (*task).se.on_rq = true;
+        self.nr_running += 1;
+        self.load_weight += (*task).se.load_weight;
+    }
+
+    /// 任务离开 CFS 运行队列 (dequeue_task_fair)
+    ///
+    /// # Safety
+    /// task 必须有效；如果 se.on_rq 为 true，则必须在本队列上
+    pub unsafe fn dequeue(&mut self, task: *mut Task) {
+        if !(*task).se.on_rq {
+            return;
+        }
+
+        self.update_curr();
+
+        if task != self.curr {
+            self.dequeue_entity(task);
+        } else {
+            self.curr = core::ptr::null_mut();
+        }
+        (*task).se.on_rq = false;
+        self.nr_running -= 1;
+        self.load_weight -= (*task).se.load_weight;
+        group::account_dequeue(task);
+        self.update_min_vruntime();
+    }
+
+    /// 节流的任务数
+    #[inline]
+    pub fn nr_throttled(&self) -> usize {
+        self.throttled.len()
+    }
+
+    /// 组带宽用完的任务离开队列，等待下一个周期 (throttle_cfs_rq)
+    unsafe fn throttle(&mut self, task: *mut Task) {
+        self.dequeue(task);
+        (*task).se.throttled = true;
+        self.throttled.push(task);
+    }
+
+    /// 取出所在组已进入新周期的节流任务 (unthrottle_cfs_rq)
+    ///
+    /// 由调用方按亲和性放回运行队列
+    pub fn take_unthrottled(&mut self, now: u64) -> Vec<*mut Task> {
+        let mut ready = Vec::new();
+        self.throttled.retain(|&task| unsafe {
+            if group::throttled(task, now) {
+                return true;
+            }
+            (*task).se.throttled = false;
+            ready.push(task);
+            false
+        });
+        ready
+    }
+
+    /// 从节流链表中删除（任务改变调度类或退出时）
+    ///
+    /// # Safety
+    /// task 必须有效
+    pub unsafe fn remove_throttled(&mut self, task: *mut Task) {
+        if (*task).se.throttled {
+            self.throttled.retain(|&t| t != task);
+            (*task).se.throttled = false;
+        }
+    }
+
+    /// 放回被切换出去的任务 (put_prev_task_fair)
+    ///
+    /// 仍可运行的任务按新的 vruntime 重新插入红黑树；
+    /// 已睡眠/退出的任务在此处离开运行队列，被抢占 (preempted) 的除外
+    ///
+    /// # Safety
+    /// prev 必须有效
+    pub unsafe fn put_prev(&mut self, prev: *mut Task, preempted: bool) {
+        if prev != self.curr {
+            return;
+        }
+
+        if !(*prev).se.on_rq {
+            self.curr = core::ptr::null_mut();
+            return;
+        }
+
+        if !preempted && (*prev).state() != TaskState::Running {
+            self.dequeue(prev);
+            return;
+        }
+
+        self.update_curr();
+        if group::throttled(prev, sched_clock()) {
+            self.throttle(prev);
+            return;
+        }
+
+        // 组内其他任务入队或离开后，有效权重随之变化
+        let weight = group::reweight(prev, task_load_weight(&*prev));
+        self.load_weight = self.load_weight - (*prev).se.load_weight + weight;
+        (*prev).se.load_weight = weight;
+
+        self.enqueue_entity(prev);
+        self.curr = core::ptr::null_mut();
+    }
+
+    /// 选择 vruntime 最小的任务 (pick_next_task_fair)
+    ///
+    /// 所在组已被节流的任务移到节流链表，继续选择下一个
+    pub fn pick_next(&mut self) -> Option<*mut Task> {
+        loop {
+            let left = self.tasks_timeline.first();
+            if left.is_null() {
+                return None;
+            }
+            unsafe {
+                let task = task_of(left);
+                if group::throttled(task, sched_clock()) {
+                    self.throttle(task);
+                    continue;
+                }
+                self.set_curr(task);
+                return Some(task);
+            }
+        }
+    }
+
+    /// 把红黑树中的任务设为正在运行的任务 (set_next_entity)
+    ///
+    /// 运行中的任务不在红黑树中；sched_setscheduler 把正在运行的任务换入 CFS 时也调用
+    ///
+    /// # Safety
+    /// task 必须有效且在本队列的红黑树中
+    pub unsafe fn set_curr(&mut self, task: *mut Task) {
+        self.dequeue_entity(task);
+        self.curr = task;
+        let se = &mut (*task).se;
+        se.exec_start = sched_clock();
+        se.prev_sum_exec_runtime = se.sum_exec_runtime;
+    }
+
+    /// 红黑树中 vruntime 最大的任务（最晚才会运行，迁移代价最小）
+    ///
+    /// 不包括正在运行的任务
+    pub fn last_queued(&self) -> Option<*mut Task> {
+        let last = self.tasks_timeline.rb_root.last();
+        if last.is_null() {
+            None
+        } else {
+            Some(unsafe { task_of(last) })
+        }
+    }
+
+    /// 时钟中断时检查当前任务是否需要让出 CPU (task_tick_fair)
+    ///
+    /// # 返回
+    /// true 表示需要重新调度
+    pub fn task_tick(&mut self, curr: *mut Task) -> bool {
+        if curr != self.curr || curr.is_null() {
+            return false;
+        }
+
+        self.update_curr();
+
+        unsafe {
+            // 组带宽用完：切换走，由 put_prev 节流
+            if group::throttled(curr, sched_clock()) {
+                return true;
+            }
+
+            // check_preempt_tick
+            let ideal_runtime = self.sched_slice(&*curr);
+            let delta_exec = (*curr).se.sum_exec_runtime - (*curr).se.prev_sum_exec_runtime;
+            if delta_exec > ideal_runtime {
+                return true;
+            }
+
+            // 至少运行最小粒度，避免过于频繁的切换
+            if delta_exec < SCHED_MIN_GRANULARITY_NS {
+                return false;
+            }
+
+            let left = self.tasks_timeline.first();
+            if left.is_null() {
+                return false;
+            }
+            let left_vruntime = (*task_of(left)).se.vruntime;
+            (*curr).se.vruntime > left_vruntime
+                && (*curr).se.vruntime - left_vruntime > ideal_runtime
+        }
+    }
+
+    /// 迁移离开本队列前，把 vruntime 转换为相对 min_vruntime 的值
+    ///
+    /// # Safety
+    /// task 必须有效且不在本队列上
+    pub unsafe fn migrate_out(&self, task: *mut Task) {
+        (*task).se.vruntime = (*task).se.vruntime.saturating_sub(self.min_vruntime);
+    }
+
+    /// 迁移到本队列后，把相对 vruntime 恢复为绝对值
+    ///
+    /// # Safety
+    /// task 必须有效且尚未加入本队列
+    pub unsafe fn migrate_in(&self, task: *mut Task) {
+        (*task).se.vruntime += self.min_vruntime;
+    }
+}
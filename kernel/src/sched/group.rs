@@ -0,0 +1,526 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 任务组与 CPU 带宽控制 (task_group, cfs_bandwidth)
+//!
+//! 参考 Linux: kernel/sched/core.c (cpu cgroup), kernel/sched/fair.c
+//!
+//! - 任务组组成以根组为根的树，每个任务属于一个组，fork 时继承父进程的组
+//! - 份额 (cpu.shares)：组在父组中按份额与兄弟实体分配 CPU，组内再按任务权重分配。
+//!   任务入队时的有效权重 = 任务权重 × Π(各级组份额 / 该组可运行实体的总权重)
+//!   (calc_group_shares，按全部 CPU 汇总，入队和切换时重新计算)
+//! - 带宽 (cpu.max)：每个周期内组及其子组最多运行 quota 纳秒，用完后组内任务
+//!   离开 CFS 运行队列 (throttle_cfs_rq)，下一个周期开始时由 tick 重新入队
+//!   (unthrottle_cfs_rq)；配额在所有 CPU 间共享
+//! - 内存 (memory.*)：每个子组有一个内存控制组 (mm::memcontrol)，随组创建，组删除后
+//!   由仍计在其中的页保持存活
+//! - 组的全部状态由 TASK_GROUPS 保护，调度器访问任务的组时持有这把锁；
+//!   根组的任务 (se.group 为 null) 不参与组记账，不获取锁
+
+use alloc::boxed::Box;
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use crate::errno;
+use crate::mm::memcontrol::{css_get, mem_cgroup_alloc, mem_cgroup_offline, MemCgroup};
+use crate::process::task::Task;
+use crate::sync::TicketLock;
+
+use super::fair::NICE_0_LOAD;
+
+/// 份额下限与上限 (MIN_SHARES / MAX_SHARES)
+pub const MIN_SHARES: u64 = 2;
+pub const MAX_SHARES: u64 = 1 << 18;
+
+/// 不限制带宽 (RUNTIME_INF)
+pub const RUNTIME_INF: u64 = u64::MAX;
+
+/// 默认带宽周期 100ms (default_cfs_period)
+pub const DEFAULT_CFS_PERIOD_NS: u64 = 100_000_000;
+
+/// 周期与配额的取值范围 (min_cfs_quota_period / max_cfs_quota_period)
+const MIN_CFS_PERIOD_NS: u64 = 1_000_000;
+const MAX_CFS_PERIOD_NS: u64 = 1_000_000_000;
+const MIN_CFS_QUOTA_NS: u64 = 1_000_000;
+
+/// 组的带宽状态 (struct cfs_bandwidth)
+struct CfsBandwidth {
+    period: u64,
+    quota: u64,
+    /// 本周期剩余的运行时间
+    runtime: u64,
+    period_start: u64,
+    throttled: bool,
+    throttled_at: u64,
+    nr_periods: u64,
+    nr_throttled: u64,
+    throttled_time: u64,
+}
+
+impl CfsBandwidth {
+    const fn new() -> Self {
+        Self {
+            period: DEFAULT_CFS_PERIOD_NS,
+            quota: RUNTIME_INF,
+            runtime: RUNTIME_INF,
+            period_start: 0,
+            throttled: false,
+            throttled_at: 0,
+            nr_periods: 0,
+            nr_throttled: 0,
+            throttled_time: 0,
+        }
+    }
+
+    /// 周期结束时补满配额并解除节流 (sched_cfs_period_timer)
+    fn refresh(&mut self, now: u64) {
+        if self.quota == RUNTIME_INF || now < self.period_start + self.period {
+            return;
+        }
+        let periods = (now - self.period_start) / self.period;
+        self.period_start += periods * self.period;
+        self.nr_periods += periods;
+        self.runtime = self.quota;
+        if self.throttled {
+            self.throttled = false;
+            self.throttled_time += now - self.throttled_at;
+        }
+    }
+
+    /// 扣除运行时间，配额用完时节流 (account_cfs_rq_runtime)
+    fn charge(&mut self, delta: u64, now: u64) {
+        if self.quota == RUNTIME_INF {
+            return;
+        }
+        self.refresh(now);
+        self.runtime = self.runtime.saturating_sub(delta);
+        if self.runtime == 0 && !self.throttled {
+            self.throttled = true;
+            self.throttled_at = now;
+            self.nr_throttled += 1;
+        }
+    }
+}
+
+/// 任务组 (struct task_group)
+pub struct TaskGroup {
+    name: String,
+    parent: *mut TaskGroup,
+    children: Vec<*mut TaskGroup>,
+    /// 组在父组中的权重 (tg->shares)
+    shares: u64,
+    /// 可运行的直接子实体的总权重：组内任务的权重与有可运行任务的子组的份额
+    load: u64,
+    /// 子树中可运行的任务数
+    nr_running: usize,
+    /// 属于本组的任务数（包括未回收的僵尸任务），为 0 才能删除
+    nr_tasks: usize,
+    bandwidth: CfsBandwidth,
+    /// 子树累计运行时间 (cpuacct usage)
+    usage: u64,
+    /// 内存控制组，根组为 null
+    memcg: *mut MemCgroup,
+}
+
+impl TaskGroup {
+    const fn new(parent: *mut TaskGroup) -> Self {
+        Self {
+            name: String::new(),
+            parent,
+            children: Vec::new(),
+            shares: NICE_0_LOAD,
+            load: 0,
+            nr_running: 0,
+            nr_tasks: 0,
+            bandwidth: CfsBandwidth::new(),
+            usage: 0,
+            memcg: core::ptr::null_mut(),
+        }
+    }
+}
+
+/// cpu.stat 的内容
+#[derive(Debug, Clone, Copy, Default)]
+pub struct CpuStat {
+    pub usage_ns: u64,
+    pub nr_periods: u64,
+    pub nr_throttled: u64,
+    pub throttled_ns: u64,
+}
+
+struct TaskGroups {
+    root: TaskGroup,
+}
+
+unsafe impl Send for TaskGroups {}
+
+/// 任务组树 (task_groups)
+static TASK_GROUPS: TicketLock<TaskGroups> = TicketLock::new(TaskGroups { root: TaskGroup::new(core::ptr::null_mut()) });
+
+/// 根组 (root_task_group)
+pub fn root_task_group() -> *mut TaskGroup {
+    let mut groups = TASK_GROUPS.lock_irqsave();
+    &mut groups.root as *mut TaskGroup
+}
+
+/// 任务所属的组，根组返回 root_task_group()
+pub fn task_group(task: &Task) -> *mut TaskGroup {
+    let group = task.se.group;
+    if group.is_null() { root_task_group() } else { group }
+}
+
+#[inline]
+unsafe fn is_root(group: *const TaskGroup) -> bool {
+    group.is_null() || (*group).parent.is_null()
+}
+
+/// 创建子组 (sched_create_group)
+///
+/// # 返回
+/// 名字无效返回 EINVAL，同名子组已存在返回 EEXIST
+pub fn sched_create_group(parent: *mut TaskGroup, name: &str) -> Result<*mut TaskGroup, i32> {
+    if name.is_empty() || name.contains('/') || name == "." || name == ".." || parent.is_null() {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    let _groups = TASK_GROUPS.lock_irqsave();
+    unsafe {
+        if (*parent).children.iter().any(|&child| (*child).name == name) {
+            return Err(errno::Errno::FileExists.as_neg_i32());
+        }
+        let mut group = Box::new(TaskGroup::new(parent));
+        group.name = String::from(name);
+        group.memcg = mem_cgroup_alloc((*parent).memcg);
+        let group = Box::into_raw(group);
+        (*parent).children.push(group);
+        Ok(group)
+    }
+}
+
+/// 删除空的子组 (sched_destroy_group)
+///
+/// # 返回
+/// 根组返回 EINVAL；还有任务或子组时返回 EBUSY
+pub fn sched_destroy_group(group: *mut TaskGroup) -> Result<(), i32> {
+    let _groups = TASK_GROUPS.lock_irqsave();
+    unsafe {
+        if is_root(group) {
+            return Err(errno::Errno::InvalidArgument.as_neg_i32());
+        }
+        if (*group).nr_tasks != 0 || !(*group).children.is_empty() {
+            return Err(errno::Errno::DeviceOrResourceBusy.as_neg_i32());
+        }
+        (*(*group).parent).children.retain(|&child| child != group);
+        mem_cgroup_offline((*group).memcg);
+        drop(Box::from_raw(group));
+    }
+    Ok(())
+}
+
+/// 按名字查找子组
+pub fn find_child_group(parent: *mut TaskGroup, name: &str) -> Option<*mut TaskGroup> {
+    let _groups = TASK_GROUPS.lock_irqsave();
+    unsafe { (*parent).children.iter().copied().find(|&child| (*child).name == name) }
+}
+
+/// 子组的名字
+pub fn child_group_names(parent: *mut TaskGroup) -> Vec<String> {
+    let _groups = TASK_GROUPS.lock_irqsave();
+    unsafe { (*parent).children.iter().map(|&child| (*child).name.clone()).collect() }
+}
+
+/// 组的内存控制组，根组返回 null
+///
+/// 组删除前有效；之后只由计在其中的页保持存活
+pub fn tg_memcg(group: *mut TaskGroup) -> *mut MemCgroup {
+    let _groups = TASK_GROUPS.lock_irqsave();
+    unsafe { (*group).memcg }
+}
+
+/// 任务所在组的内存控制组并取得一个引用，根组返回 null (get_mem_cgroup_from_mm)
+///
+/// 持锁读取，防止任务同时被移出组而组被删除
+pub fn task_get_memcg(task: &Task) -> *mut MemCgroup {
+    let _groups = TASK_GROUPS.lock_irqsave();
+    let group = task.se.group;
+    if group.is_null() {
+        return core::ptr::null_mut();
+    }
+    unsafe {
+        let memcg = (*group).memcg;
+        if !memcg.is_null() {
+            css_get(memcg, 1);
+        }
+        memcg
+    }
+}
+
+/// 设置组的份额 (sched_group_set_shares)
+///
+/// 份额限制在 [MIN_SHARES, MAX_SHARES]；根组的份额不可修改
+pub fn sched_group_set_shares(group: *mut TaskGroup, shares: u64) -> Result<(), i32> {
+    let _groups = TASK_GROUPS.lock_irqsave();
+    unsafe {
+        if is_root(group) {
+            return Err(errno::Errno::InvalidArgument.as_neg_i32());
+        }
+        let shares = shares.clamp(MIN_SHARES, MAX_SHARES);
+        let group = &mut *group;
+        // 有可运行任务的组已把旧份额计入父组，根组不记负载
+        if group.nr_running != 0 && !is_root(group.parent) {
+            let parent = &mut *group.parent;
+            parent.load = parent.load - group.shares + shares;
+        }
+        group.shares = shares;
+    }
+    Ok(())
+}
+
+/// 组的份额 (sched_group_shares)
+pub fn sched_group_shares(group: *mut TaskGroup) -> u64 {
+    let _groups = TASK_GROUPS.lock_irqsave();
+    unsafe { (*group).shares }
+}
+
+/// 设置带宽 (tg_set_cfs_bandwidth)
+///
+/// quota 为 RUNTIME_INF 时不限制；周期限制在 1ms 到 1s，配额不少于 1ms。
+/// 新的周期从下一次记账开始
+pub fn tg_set_cfs_bandwidth(group: *mut TaskGroup, period: u64, quota: u64) -> Result<(), i32> {
+    if !(MIN_CFS_PERIOD_NS..=MAX_CFS_PERIOD_NS).contains(&period)
+        || (quota != RUNTIME_INF && quota < MIN_CFS_QUOTA_NS)
+    {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+    let _groups = TASK_GROUPS.lock_irqsave();
+    unsafe {
+        if is_root(group) {
+            return Err(errno::Errno::InvalidArgument.as_neg_i32());
+        }
+        let bw = &mut (*group).bandwidth;
+        if bw.throttled && quota == RUNTIME_INF {
+            bw.throttled = false;
+        }
+        bw.period = period;
+        bw.quota = quota;
+        bw.runtime = quota;
+        bw.period_start = super::fair::sched_clock();
+    }
+    Ok(())
+}
+
+/// 带宽设置 (period, quota) (tg_get_cfs_period / tg_get_cfs_quota)
+pub fn tg_get_cfs_bandwidth(group: *mut TaskGroup) -> (u64, u64) {
+    let _groups = TASK_GROUPS.lock_irqsave();
+    unsafe { ((*group).bandwidth.period, (*group).bandwidth.quota) }
+}
+
+/// 组的运行统计 (cpu.stat)
+pub fn tg_cpu_stat(group: *mut TaskGroup) -> CpuStat {
+    let _groups = TASK_GROUPS.lock_irqsave();
+    unsafe {
+        let group = &*group;
+        let bw = &group.bandwidth;
+        // 节流中的时间计到读取时
+        let throttling = if bw.throttled {
+            super::fair::sched_clock().saturating_sub(bw.throttled_at)
+        } else {
+            0
+        };
+        CpuStat {
+            usage_ns: group.usage,
+            nr_periods: bw.nr_periods,
+            nr_throttled: bw.nr_throttled,
+            throttled_ns: bw.throttled_time + throttling,
+        }
+    }
+}
+
+/// 把组内任务的可运行权重加到组及其祖先上 (account_entity_enqueue)
+unsafe fn group_add_load(mut group: *mut TaskGroup, mut add: u64) {
+    while !is_root(group) {
+        let g = &mut *group;
+        g.nr_running += 1;
+        g.load += add;
+        // 子树从空闲变为可运行时，组的份额加入父组
+        add = if g.nr_running == 1 { g.shares } else { 0 };
+        group = g.parent;
+    }
+}
+
+/// group_add_load 的逆操作 (account_entity_dequeue)
+unsafe fn group_sub_load(mut group: *mut TaskGroup, mut sub: u64) {
+    while !is_root(group) {
+        let g = &mut *group;
+        g.nr_running -= 1;
+        g.load -= sub;
+        sub = if g.nr_running == 0 { g.shares } else { 0 };
+        group = g.parent;
+    }
+}
+
+/// 任务在根运行队列上的有效权重 (calc_group_shares)
+unsafe fn effective_weight(mut group: *mut TaskGroup, weight: u64) -> u64 {
+    let mut weight = weight;
+    while !is_root(group) {
+        let g = &*group;
+        weight = weight * g.shares / g.load.max(1);
+        group = g.parent;
+    }
+    weight.max(MIN_SHARES)
+}
+
+/// 任务加入 CFS 运行队列时计入组的负载，返回有效权重
+///
+/// # Safety
+/// task 必须有效，调用方持有任务所在运行队列的锁
+pub unsafe fn account_enqueue(task: *mut Task, weight: u64) -> u64 {
+    if (*task).se.group.is_null() {
+        return weight;
+    }
+    let _groups = TASK_GROUPS.lock_irqsave();
+    let se = &mut (*task).se;
+    group_add_load(se.group, weight);
+    se.group_load = weight;
+    effective_weight(se.group, weight)
+}
+
+/// 任务离开 CFS 运行队列时从组的负载中减去
+///
+/// # Safety
+/// 同 account_enqueue
+pub unsafe fn account_dequeue(task: *mut Task) {
+    if (*task).se.group.is_null() && (*task).se.group_load == 0 {
+        return;
+    }
+    let _groups = TASK_GROUPS.lock_irqsave();
+    let se = &mut (*task).se;
+    if se.group_load != 0 {
+        group_sub_load(se.group, se.group_load);
+        se.group_load = 0;
+    }
+}
+
+/// 切换时按组当前的负载重新计算有效权重 (update_cfs_group)
+///
+/// 换组时还没计入新组的可运行任务在这里补上
+///
+/// # Safety
+/// 同 account_enqueue，task 在 CFS 运行队列上
+pub unsafe fn reweight(task: *mut Task, weight: u64) -> u64 {
+    if (*task).se.group.is_null() && (*task).se.group_load == 0 {
+        return weight;
+    }
+    let _groups = TASK_GROUPS.lock_irqsave();
+    let se = &mut (*task).se;
+    if se.group_load != weight {
+        if se.group_load != 0 {
+            group_sub_load(se.group, se.group_load);
+        }
+        group_add_load(se.group, weight);
+        se.group_load = if se.group.is_null() { 0 } else { weight };
+    }
+    effective_weight(se.group, weight)
+}
+
+/// 记账运行时间，返回任务所在的组或其祖先是否已被节流
+///
+/// # Safety
+/// 同 account_enqueue
+pub unsafe fn account_runtime(task: *mut Task, delta: u64, now: u64) -> bool {
+    if (*task).se.group.is_null() {
+        return false;
+    }
+    let _groups = TASK_GROUPS.lock_irqsave();
+    let mut group = (*task).se.group;
+    let mut throttled = false;
+    while !is_root(group) {
+        let g = &mut *group;
+        g.usage += delta;
+        g.bandwidth.charge(delta, now);
+        throttled |= g.bandwidth.throttled;
+        group = g.parent;
+    }
+    throttled
+}
+
+/// 任务所在的组或其祖先是否被节流，先处理已结束的周期 (cfs_rq_throttled)
+///
+/// # Safety
+/// task 必须有效
+pub unsafe fn throttled(task: *mut Task, now: u64) -> bool {
+    if (*task).se.group.is_null() {
+        return false;
+    }
+    let _groups = TASK_GROUPS.lock_irqsave();
+    let mut group = (*task).se.group;
+    let mut throttled = false;
+    while !is_root(group) {
+        let g = &mut *group;
+        g.bandwidth.refresh(now);
+        throttled |= g.bandwidth.throttled;
+        group = g.parent;
+    }
+    throttled
+}
+
+/// fork 的子进程加入父进程的组 (cgroup_fork)
+pub fn sched_fork_group(child: &mut Task, parent: &Task) {
+    let group = parent.se.group;
+    child.se.group = group;
+    child.se.group_load = 0;
+    if !group.is_null() {
+        let _groups = TASK_GROUPS.lock_irqsave();
+        unsafe { (*group).nr_tasks += 1 };
+    }
+}
+
+/// 释放任务时离开所在的组 (cgroup_free)
+pub fn cgroup_free(task: &mut Task) {
+    let group = task.se.group;
+    if group.is_null() {
+        return;
+    }
+    let _groups = TASK_GROUPS.lock_irqsave();
+    unsafe {
+        if task.se.group_load != 0 {
+            group_sub_load(group, task.se.group_load);
+            task.se.group_load = 0;
+        }
+        (*group).nr_tasks -= 1;
+    }
+    task.se.group = core::ptr::null_mut();
+}
+
+/// 把任务移到另一个组 (sched_move_task)
+///
+/// 可运行任务的负载立即转到新组，有效权重在下一次切换时更新；
+/// 被节流的任务在下一个 tick 按新组的带宽判断
+///
+/// # Safety
+/// task 必须有效
+pub unsafe fn sched_move_task(task: *mut Task, group: *mut TaskGroup) {
+    let _groups = TASK_GROUPS.lock_irqsave();
+    let group = if is_root(group) { core::ptr::null_mut() } else { group };
+    let se = &mut (*task).se;
+    if se.group == group {
+        return;
+    }
+    let weight = se.group_load;
+    if weight != 0 {
+        group_sub_load(se.group, weight);
+        se.group_load = 0;
+    }
+    if !se.group.is_null() {
+        (*se.group).nr_tasks -= 1;
+    }
+    se.group = group;
+    if !group.is_null() {
+        (*group).nr_tasks += 1;
+        if weight != 0 {
+            group_add_load(group, weight);
+            se.group_load = weight;
+        }
+    }
+}
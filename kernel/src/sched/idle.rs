@@ -0,0 +1,232 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! CPU 空闲状态的选择与进入 (cpuidle)
+//!
+//! 参考 Linux: kernel/sched/idle.c (do_idle, poll_idle),
+//! drivers/cpuidle/governors/haltpoll.c, drivers/cpuidle/cpuidle-riscv-sbi.c
+//!
+//! 空闲的 CPU 依次经过三个状态：
+//! - POLL：开中断轮询 need_resched，不睡眠，唤醒只需要一次内存写入。
+//!   轮询时长按 haltpoll 的方式自适应：空闲时间落在轮询时长之外但不超过上限时加倍，
+//!   超过上限时减半，只有突发的短空闲才值得轮询
+//! - WFI：停止 tick 后执行 wfi，等待中断
+//! - SUSPEND：距下一个定时器足够远时经 SBI HSM 以保持状态挂起 hart，
+//!   固件可以进入比 wfi 更深的低功耗状态；固件不支持 HSM 时退回 WFI
+//!
+//! 轮询的 CPU 在 IDLE_STATE 中登记为 POLL，唤醒者看到 POLL 时只设置它的
+//! need_resched，不发送 IPI (set_nr_if_polling)；WFI 与 SUSPEND 的 CPU 仍经 IPI 唤醒。
+//! 唤醒者先写标志再读状态，空闲 CPU 先改状态再读标志，两边都用 SeqCst，
+//! 至少有一方看到对方的写入，不会丢失唤醒
+
+use alloc::format;
+use alloc::string::String;
+use core::fmt::Write;
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicU8, Ordering};
+
+use crate::config::MAX_CPUS;
+use crate::drivers::timer::read_time;
+use crate::time::{cycles_to_ns, ns_to_cycles};
+
+/// 空闲状态
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+#[repr(u8)]
+pub enum IdleState {
+    Poll = 0,
+    Wfi = 1,
+    Suspend = 2,
+}
+
+/// 空闲状态数
+pub const NR_IDLE_STATES: usize = 3;
+
+const STATE_NAMES: [&str; NR_IDLE_STATES] = ["poll", "wfi", "suspend"];
+
+/// IDLE_STATE 中表示不在空闲状态中
+const STATE_RUNNING: u8 = u8::MAX;
+
+/// 轮询时长的上限 (guest_halt_poll_ns)
+pub const HALT_POLL_NS_MAX: u64 = 200_000;
+/// 从 0 开始增长时的轮询时长 (guest_halt_poll_grow_start)
+pub const HALT_POLL_NS_GROW_START: u64 = 50_000;
+/// 增长与缩减的倍数 (guest_halt_poll_grow / guest_halt_poll_shrink)
+const HALT_POLL_GROW: u64 = 2;
+const HALT_POLL_SHRINK: u64 = 2;
+
+/// 经 HSM 挂起至少要能睡的时间 (target_residency)，更短的空闲用 wfi
+pub const SUSPEND_TARGET_RESIDENCY_NS: u64 = 1_000_000;
+
+/// 固件支持 HSM 挂起
+static HSM_SUSPEND: AtomicBool = AtomicBool::new(false);
+
+/// 一个 CPU 的空闲统计 (struct cpuidle_device)
+struct CpuIdleDev {
+    /// 当前轮询时长，纳秒 (poll_limit_ns)
+    poll_limit_ns: AtomicU64,
+    /// 各状态的进入次数与停留时间，纳秒 (cpuidle_state_usage)
+    usage: [AtomicU64; NR_IDLE_STATES],
+    time_ns: [AtomicU64; NR_IDLE_STATES],
+}
+
+impl CpuIdleDev {
+    const fn new() -> Self {
+        Self {
+            poll_limit_ns: AtomicU64::new(HALT_POLL_NS_GROW_START),
+            usage: [const { AtomicU64::new(0) }; NR_IDLE_STATES],
+            time_ns: [const { AtomicU64::new(0) }; NR_IDLE_STATES],
+        }
+    }
+
+    fn account(&self, state: IdleState, ns: u64) {
+        self.usage[state as usize].fetch_add(1, Ordering::Relaxed);
+        self.time_ns[state as usize].fetch_add(ns, Ordering::Relaxed);
+    }
+}
+
+crate::percpu! {
+    /// 所处的空闲状态，STATE_RUNNING 表示不在空闲循环中睡眠或轮询
+    static IDLE_STATE: AtomicU8 = AtomicU8::new(STATE_RUNNING);
+    /// 空闲统计与轮询时长
+    static CPUIDLE_DEV: CpuIdleDev = CpuIdleDev::new();
+}
+
+/// 探测固件的 HSM 扩展 (sbi_cpuidle_init)
+pub fn init() {
+    HSM_SUSPEND.store(crate::sbi::probe_extension(crate::sbi::SBI_EXT_HSM), Ordering::Relaxed);
+}
+
+/// 固件是否支持 HSM 挂起
+pub fn hsm_suspend_available() -> bool {
+    HSM_SUSPEND.load(Ordering::Relaxed)
+}
+
+/// CPU 是否正在轮询 need_resched (tif_need_resched 与 TIF_POLLING_NRFLAG)
+#[inline]
+pub fn cpu_polling(cpu: usize) -> bool {
+    cpu < MAX_CPUS && IDLE_STATE.per_cpu(cpu).load(Ordering::SeqCst) == IdleState::Poll as u8
+}
+
+/// 根据本次空闲的时长调整轮询时长 (adjust_poll_limit)
+///
+/// # 参数
+/// - `limit`: 当前轮询时长，纳秒
+/// - `block_ns`: 本次从进入空闲到被唤醒的时间，纳秒
+pub fn adjust_poll_limit(limit: u64, block_ns: u64) -> u64 {
+    if block_ns > limit && block_ns <= HALT_POLL_NS_MAX {
+        (limit * HALT_POLL_GROW).max(HALT_POLL_NS_GROW_START).min(HALT_POLL_NS_MAX)
+    } else if block_ns > HALT_POLL_NS_MAX {
+        limit / HALT_POLL_SHRINK
+    } else {
+        limit
+    }
+}
+
+/// 轮询之后的睡眠状态 (cpuidle_select)
+///
+/// # 参数
+/// - `sleep_ns`: 距下一个定时器的纳秒数
+/// - `hsm`: 固件支持 HSM 挂起
+pub fn select_state(sleep_ns: u64, hsm: bool) -> IdleState {
+    if hsm && sleep_ns >= SUSPEND_TARGET_RESIDENCY_NS {
+        IdleState::Suspend
+    } else {
+        IdleState::Wfi
+    }
+}
+
+/// 开中断轮询 need_resched，最多 limit_ns 纳秒 (poll_idle)
+///
+/// # 返回
+/// 轮询期间被要求重新调度
+fn poll_idle(state: &AtomicU8, limit_ns: u64) -> bool {
+    if limit_ns == 0 {
+        return false;
+    }
+    let end = read_time().saturating_add(ns_to_cycles(limit_ns));
+    state.store(IdleState::Poll as u8, Ordering::SeqCst);
+    while !super::need_resched() && read_time() < end {
+        core::hint::spin_loop();
+    }
+    state.store(STATE_RUNNING, Ordering::SeqCst);
+    // 唤醒者看到 POLL 时没有发送 IPI，离开轮询后再检查一次
+    super::need_resched()
+}
+
+/// 空闲循环中的一次空闲 (do_idle)
+///
+/// 先轮询，轮询期间没有任务时停止 tick，按距下一个定时器的时间选择 wfi 或 HSM 挂起。
+/// 被中断或 IPI 唤醒后返回，由调用者重新调度
+pub fn do_idle() {
+    let state = IDLE_STATE.this_cpu();
+    let dev = CPUIDLE_DEV.this_cpu();
+    let limit = dev.poll_limit_ns.load(Ordering::Relaxed);
+    let start = read_time();
+
+    if poll_idle(state, limit) {
+        dev.account(IdleState::Poll, cycles_to_ns(read_time() - start));
+        return;
+    }
+    let polled = read_time();
+    dev.account(IdleState::Poll, cycles_to_ns(polled - start));
+
+    crate::time::tick::tick_nohz_idle_enter();
+    let sleep_ns = cycles_to_ns(crate::time::tick::tick_nohz_get_sleep_length());
+    let target = select_state(sleep_ns, hsm_suspend_available());
+    state.store(target as u8, Ordering::SeqCst);
+    // 轮询结束与登记新状态之间设置的标志没有伴随 IPI
+    if !super::need_resched() {
+        if target == IdleState::Suspend && crate::sbi::hart_suspend_retentive() != crate::sbi::SBI_SUCCESS {
+            // 固件拒绝挂起，之后只用 wfi
+            HSM_SUSPEND.store(false, Ordering::Relaxed);
+            crate::arch::riscv64::cpu::wfi();
+        } else if target == IdleState::Wfi {
+            crate::arch::riscv64::cpu::wfi();
+        }
+    }
+    state.store(STATE_RUNNING, Ordering::SeqCst);
+    crate::time::tick::tick_nohz_idle_exit();
+
+    let now = read_time();
+    dev.account(target, cycles_to_ns(now - polled));
+    dev.poll_limit_ns.store(adjust_poll_limit(limit, cycles_to_ns(now - start)), Ordering::Relaxed);
+}
+
+/// 一个 CPU 的空闲统计
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct CpuIdleStat {
+    pub poll_limit_ns: u64,
+    pub usage: [u64; NR_IDLE_STATES],
+    pub time_ns: [u64; NR_IDLE_STATES],
+}
+
+/// 读取一个 CPU 的空闲统计
+pub fn cpuidle_stat(cpu: usize) -> CpuIdleStat {
+    let dev = CPUIDLE_DEV.per_cpu(cpu);
+    CpuIdleStat {
+        poll_limit_ns: dev.poll_limit_ns.load(Ordering::Relaxed),
+        usage: core::array::from_fn(|i| dev.usage[i].load(Ordering::Relaxed)),
+        time_ns: core::array::from_fn(|i| dev.time_ns[i].load(Ordering::Relaxed)),
+    }
+}
+
+/// /proc/cpuidle 的内容：每个在线 CPU 一行，各状态的进入次数与停留的微秒数
+pub fn cpuidle_show() -> String {
+    let mut out = String::new();
+    let _ = write!(out, "{:<6} {:>13}", "cpu", "poll_limit_ns");
+    for name in STATE_NAMES {
+        let _ = write!(out, " {:>12} {:>14}", format!("{}_usage", name), format!("{}_time_us", name));
+    }
+    let _ = writeln!(out);
+    let active = super::cpu_active_mask();
+    for cpu in (0..MAX_CPUS).filter(|&cpu| active & (1 << cpu) != 0) {
+        let stat = cpuidle_stat(cpu);
+        let _ = write!(out, "{:<6} {:>13}", format!("cpu{}", cpu), stat.poll_limit_ns);
+        for i in 0..NR_IDLE_STATES {
+            let _ = write!(out, " {:>12} {:>14}", stat.usage[i], stat.time_ns[i] / 1000);
+        }
+        let _ = writeln!(out);
+    }
+    out
+}
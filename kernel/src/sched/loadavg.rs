@@ -0,0 +1,109 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 系统负载 (load average)
+//!
+//! 参考 Linux: kernel/sched/loadavg.c
+//!
+//! 每 LOAD_FREQ（5 秒）对活跃任务数（可运行 + 不可中断睡眠）做指数衰减平均，
+//! 分别对应 1、5、15 分钟。使用 11 位小数的定点数 (FSHIFT)。
+//!
+//! 活跃任务数直接读各 CPU 发布的计数，不需要像 Linux 那样由各 CPU 在 tick 中
+//! 折叠增量，停止 tick 的空闲 CPU 也不会少算。时间到了以后第一个 tick 的 CPU
+//! 负责计算；错过的周期（所有 CPU 都长时间没有 tick）按当前活跃数补上
+
+use core::sync::atomic::{AtomicU64, Ordering};
+
+use crate::drivers::timer::HZ;
+
+/// 定点数的小数位数 (FSHIFT)
+pub const FSHIFT: u32 = 11;
+/// 定点数的 1.0 (FIXED_1)
+pub const FIXED_1: u64 = 1 << FSHIFT;
+/// 计算间隔，单位 jiffies (LOAD_FREQ)
+pub const LOAD_FREQ: u64 = 5 * HZ + 1;
+
+/// 1/exp(5s/1min)、1/exp(5s/5min)、1/exp(5s/15min) 的定点数 (EXP_1 / EXP_5 / EXP_15)
+const EXP_1: u64 = 1884;
+const EXP_5: u64 = 2014;
+const EXP_15: u64 = 2037;
+
+/// 补算错过的周期的上限；衰减到这里早已收敛
+const MAX_MISSED_PERIODS: u64 = 256;
+
+/// 1、5、15 分钟的平均负载 (avenrun)
+static AVENRUN: [AtomicU64; 3] = [AtomicU64::new(0), AtomicU64::new(0), AtomicU64::new(0)];
+
+/// 下一次计算的 jiffies，0 表示尚未开始 (calc_load_update)
+static CALC_LOAD_UPDATE: AtomicU64 = AtomicU64::new(0);
+
+/// 一次指数衰减 (calc_load)
+///
+/// 负载上升时向上取整，以免长期停在略低于活跃数的位置
+#[inline]
+pub fn calc_load(load: u64, exp: u64, active: u64) -> u64 {
+    let mut newload = load * exp + active * (FIXED_1 - exp);
+    if active >= load {
+        newload += FIXED_1 - 1;
+    }
+    newload / FIXED_1
+}
+
+/// 当前活跃任务数的定点数 (calc_load_fold_active)
+fn calc_load_active() -> u64 {
+    let active = super::sched::nr_running() + super::sched::nr_uninterruptible();
+    active as u64 * FIXED_1
+}
+
+/// 到了计算时间时更新平均负载 (calc_global_load)
+///
+/// 在 scheduler_tick 中调用，同一周期只有一个 CPU 更新
+pub fn calc_global_load(jiffies: u64) {
+    let next = CALC_LOAD_UPDATE.load(Ordering::Relaxed);
+    if next == 0 {
+        let _ = CALC_LOAD_UPDATE.compare_exchange(0, jiffies + LOAD_FREQ, Ordering::Relaxed, Ordering::Relaxed);
+        return;
+    }
+    if jiffies < next {
+        return;
+    }
+    let missed = (jiffies - next) / LOAD_FREQ;
+    if CALC_LOAD_UPDATE
+        .compare_exchange(next, next + (missed + 1) * LOAD_FREQ, Ordering::AcqRel, Ordering::Relaxed)
+        .is_err()
+    {
+        return;
+    }
+
+    let active = calc_load_active();
+    for (avg, exp) in AVENRUN.iter().zip([EXP_1, EXP_5, EXP_15]) {
+        let mut load = avg.load(Ordering::Relaxed);
+        for _ in 0..=missed.min(MAX_MISSED_PERIODS) {
+            load = calc_load(load, exp, active);
+        }
+        avg.store(load, Ordering::Relaxed);
+    }
+}
+
+/// 平均负载的定点数，加上 offset 后移 shift 位 (get_avenrun)
+pub fn get_avenrun(offset: u64, shift: u32) -> [u64; 3] {
+    let mut loads = [0; 3];
+    for (load, avg) in loads.iter_mut().zip(AVENRUN.iter()) {
+        *load = (avg.load(Ordering::Relaxed) + offset) << shift;
+    }
+    loads
+}
+
+/// 定点数的整数部分 (LOAD_INT)
+#[inline]
+pub fn load_int(x: u64) -> u64 {
+    x >> FSHIFT
+}
+
+/// 定点数的两位小数 (LOAD_FRAC)
+#[inline]
+pub fn load_frac(x: u64) -> u64 {
+    load_int((x & (FIXED_1 - 1)) * 100)
+}
@@ -11,10 +11,22 @@
 //! - 调度实体 (sched_entity): fair 调度单位
 //! - 调度入口: schedule() -> __schedule() -> context_switch()
 //!
-//! 当前实现: 简单的 FIFO 调度器（可扩展为 CFS）
+//! 当前实现:
+//! - fair: CFS，按 vruntime 排序的红黑树 (SCHED_NORMAL/BATCH/IDLE)
+//! - rt: 优先级位图运行队列，每个优先级一个 FIFO 链表 (SCHED_FIFO/RR)
+//! - group: 任务组的份额与 CPU 带宽 (CONFIG_FAIR_GROUP_SCHED / CFS_BANDWIDTH)
+//! - stats / loadavg: 调度统计、CPU 时间与平均负载 (/proc/schedstat, /proc/stat, /proc/loadavg)
+//! - idle: 空闲 CPU 的轮询、wfi 与 SBI HSM 挂起 (cpuidle, /proc/cpuidle)
 
 pub mod sched;
+pub mod fair;
+pub mod deque;
 pub mod pid;
+pub mod preempt;
+pub mod group;
+pub mod stats;
+pub mod loadavg;
+pub mod idle;
 
 pub use sched::{
     current,
@@ -23,11 +35,18 @@ pub use sched::{
     find_task_by_pid,
     get_current_fdtable,
     do_exit,
+    do_group_exit,
+    exit_status,
+    kill_status,
+    wait_status_to_cld,
     do_wait,
     do_wait_nonblock,
+    do_wait_child,
     alloc_task_slot,
     free_task_slot,
+    put_task_struct,
     enqueue_task,
+    activate_task,
     init,
     schedule,
     send_signal,
@@ -36,14 +55,36 @@ pub use sched::{
     load_balance,
     resched_curr,
     resched_cpu,
+    task_curr,
     wake_up_process,
+    wake_up_process_sync,
+    WF_SYNC,
+    rt_mutex_setprio,
+    sched_setscheduler,
+    sched_setaffinity,
+    cpu_active_mask,
+    yield_cpu,
     // 抢占式调度支持
+    preempt_schedule,
+    preempt_schedule_irq,
     need_resched,
     set_need_resched,
     scheduler_tick,
+    account_process_tick,
+    sched_can_stop_tick,
     // SMP 多核支持
     cpu_idle_loop,
 };
 
+pub use preempt::{
+    preempt_count,
+    preempt_disable,
+    preempt_enable,
+    preempt_enable_no_resched,
+    preemptible,
+    cond_resched,
+    PreemptGuard,
+};
+
 // 直接从配置导出 MAX_CPUS
 pub use crate::config::MAX_CPUS;
@@ -10,26 +10,133 @@
 //! - PID 1: init 进程
 //! - PID 2: kthreadd (内核线程守护进程)
 //! - PID 3+: 普通 PID
+//!
+//! PID 由位图分配 (alloc_pidmap)：从上次分配的下一个编号开始找空闲位，
+//! 到达 pid_max 后回绕到 RESERVED_PIDS，回收后的 PID 可以再次分配。
+//! 按 PID 查找任务由任务表中的 PID 散列表完成。
+//!
+//! pidfd 是指向一个进程的文件描述符 (pidfd_open)，只记录 PID，
+//! 由 waitid(P_PIDFD) 使用。
 
-use core::sync::atomic::{AtomicU32, Ordering};
+use alloc::sync::Arc;
+use spin::Mutex;
+
+use crate::fs::file::{find_next_zero_bit, File, FileFlags, FileOps};
 
 pub const PID_MAX_LIMIT: u32 = 4194304; // 4M (默认 32768，最大可到 4M)
 
+/// 位图覆盖的 PID 范围 (PID_MAX_DEFAULT)
+pub const PID_MAX_DEFAULT: u32 = 32768;
+
+/// 回绕后跳过的低编号 PID，留给启动时创建的守护进程 (RESERVED_PIDS)
+pub const RESERVED_PIDS: u32 = 300;
+
 pub const PID_SWAPPER: u32 = 0;  // idle 进程
 pub const PID_INIT: u32 = 1;     // init 进程
 
-static NEXT_PID: AtomicU32 = AtomicU32::new(PID_INIT + 1);
+const PIDMAP_WORDS: usize = PID_MAX_DEFAULT as usize / 64;
+
+/// PID 位图 (struct pidmap)
+struct PidMap {
+    /// 置位表示已分配
+    bits: [u64; PIDMAP_WORDS],
+    /// 上次分配的 PID，下次从它之后开始查找 (last_pid)
+    last_pid: u32,
+    /// 已分配的 PID 数
+    nr_used: u32,
+}
+
+impl PidMap {
+    /// PID 0 和 1 固定属于 idle 和 init，不经过分配
+    const fn new() -> Self {
+        let mut bits = [0; PIDMAP_WORDS];
+        bits[0] = 0b11;
+        Self { bits, last_pid: PID_INIT, nr_used: 0 }
+    }
+
+    fn find_free(&self, start: u32, end: u32) -> Option<u32> {
+        if start >= end {
+            return None;
+        }
+        find_next_zero_bit(&self.bits, end as usize, start as usize).map(|pid| pid as u32)
+    }
+}
+
+static PIDMAP: Mutex<PidMap> = Mutex::new(PidMap::new());
 
+/// 分配一个 PID (alloc_pid)
+///
+/// # 返回
+/// PID 全部用完时返回 None
 pub fn alloc_pid() -> Option<u32> {
-    let pid = NEXT_PID.fetch_add(1, Ordering::Relaxed);
-    if pid >= PID_MAX_LIMIT {
-        // TODO: 实现 PID 复用
-        None
-    } else {
-        Some(pid)
+    let mut map = PIDMAP.lock();
+    let start = map.last_pid + 1;
+    let pid = map.find_free(start, PID_MAX_DEFAULT)
+        .or_else(|| map.find_free(RESERVED_PIDS, start))?;
+    map.bits[pid as usize / 64] |= 1u64 << (pid % 64);
+    map.last_pid = pid;
+    map.nr_used += 1;
+    Some(pid)
+}
+
+/// 释放 PID (free_pid)，之后可以再次分配
+pub fn free_pid(pid: u32) {
+    if pid <= PID_INIT || pid >= PID_MAX_DEFAULT {
+        return;
     }
+    let mut map = PIDMAP.lock();
+    let mask = 1u64 << (pid % 64);
+    let word = &mut map.bits[pid as usize / 64];
+    if *word & mask != 0 {
+        *word &= !mask;
+        map.nr_used -= 1;
+    }
+}
+
+/// 最近分配的 PID (last_pid)
+pub fn last_pid() -> u32 {
+    PIDMAP.lock().last_pid
+}
+
+/// 已分配的 PID 数（不含 0 和 1）
+pub fn nr_pids() -> u32 {
+    PIDMAP.lock().nr_used
 }
 
-pub fn free_pid(_pid: u32) {
-    // TODO: 实现 PID bitmap 释放
+// ============================================================================
+// pidfd
+// ============================================================================
+
+/// pidfd_open 标志
+pub const PIDFD_NONBLOCK: u32 = FileFlags::O_NONBLOCK;
+
+/// pidfd 没有读写，只用于标识进程
+static PIDFD_OPS: FileOps = FileOps {
+    read: None,
+    write: None,
+    lseek: None,
+    close: None,
+    read_iter: None,
+    write_iter: None,
+    poll: None,
+};
+
+/// 创建指向 pid 的 pidfd 文件 (pidfd_create)
+///
+/// 调用方检查进程存在且是线程组组长；pidfd 总是 O_CLOEXEC，由调用方安装时设置
+pub fn pidfd_create_file(pid: u32, flags: u32) -> Arc<File> {
+    let file = Arc::new(File::new(FileFlags::new(FileFlags::O_RDWR | (flags & PIDFD_NONBLOCK))));
+    file.set_ops(&PIDFD_OPS);
+    // 私有数据直接存放 PID，不指向任何对象
+    file.set_private_data(pid as usize as *mut u8);
+    file
+}
+
+/// pidfd 指向的 PID (pidfd_pid)，不是 pidfd 时返回 None
+pub fn pidfd_pid(file: &File) -> Option<u32> {
+    let is_pidfd = unsafe { *file.ops.get() }.map_or(false, |ops| core::ptr::eq(ops, &PIDFD_OPS));
+    if !is_pidfd {
+        return None;
+    }
+    unsafe { *file.private_data.get() }.map(|data| data as usize as u32)
 }
@@ -0,0 +1,105 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内核抢占计数 (preempt_count)
+//!
+//! 参考 Linux: include/linux/preempt.h, kernel/sched/core.c
+//!
+//! - 每 CPU 的计数记录禁止抢占的嵌套深度：自旋锁、读写锁和关中断守卫持有期间加一
+//! - 计数为 0 且开中断时内核代码可以被抢占：
+//!   中断返回内核态时检查 need_resched (preempt_schedule_irq)，
+//!   preempt_enable 把计数减到 0 时也检查 (preempt_schedule)
+//! - 计数随任务切换保存和恢复 (thread_info::preempt_count)，
+//!   睡眠时持有的计数不会留给本 CPU 上的下一个任务
+//! - 没有抢占点的长循环调用 cond_resched 主动让出 CPU
+
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+crate::percpu! {
+    /// 禁止抢占的嵌套深度 (__preempt_count)
+    static PREEMPT_COUNT: AtomicUsize = AtomicUsize::new(0);
+}
+
+/// 中断是否打开
+#[inline]
+fn irqs_enabled() -> bool {
+    let sstatus: u64;
+    unsafe { core::arch::asm!("csrr {}, sstatus", out(reg) sstatus, options(nomem, nostack)) };
+    sstatus & 0x2 != 0
+}
+
+/// 本 CPU 当前的抢占计数 (preempt_count)
+#[inline]
+pub fn preempt_count() -> usize {
+    PREEMPT_COUNT.this_cpu().load(Ordering::Relaxed)
+}
+
+/// 切换任务时装入下一个任务保存的计数 (preempt_count_set)
+#[inline]
+pub fn preempt_count_set(count: usize) {
+    PREEMPT_COUNT.this_cpu().store(count, Ordering::Relaxed);
+}
+
+/// 禁止抢占 (preempt_disable)
+#[inline]
+pub fn preempt_disable() {
+    PREEMPT_COUNT.this_cpu().fetch_add(1, Ordering::Relaxed);
+    core::sync::atomic::compiler_fence(Ordering::SeqCst);
+}
+
+/// 允许抢占但不检查重新调度 (preempt_enable_no_resched)
+///
+/// 用于紧接着会调度或中断仍关闭的路径
+#[inline]
+pub fn preempt_enable_no_resched() {
+    core::sync::atomic::compiler_fence(Ordering::SeqCst);
+    PREEMPT_COUNT.this_cpu().fetch_sub(1, Ordering::Relaxed);
+}
+
+/// 允许抢占 (preempt_enable)
+///
+/// 计数减到 0 时如果有重新调度请求，立即在这里抢占
+#[inline]
+pub fn preempt_enable() {
+    core::sync::atomic::compiler_fence(Ordering::SeqCst);
+    if PREEMPT_COUNT.this_cpu().fetch_sub(1, Ordering::Relaxed) == 1 && super::need_resched() {
+        super::sched::preempt_schedule();
+    }
+}
+
+/// 当前上下文能否被抢占 (preemptible)
+#[inline]
+pub fn preemptible() -> bool {
+    preempt_count() == 0 && irqs_enabled()
+}
+
+/// 可以安全调度时让出 CPU (cond_resched)
+///
+/// 用于没有锁操作的长循环；返回是否发生了调度
+pub fn cond_resched() -> bool {
+    if !super::need_resched() || !preemptible() || crate::softirq::in_softirq() {
+        return false;
+    }
+    super::schedule();
+    true
+}
+
+/// 作用域内禁止抢占 (guard(preempt))
+pub struct PreemptGuard;
+
+impl PreemptGuard {
+    #[inline]
+    pub fn new() -> Self {
+        preempt_disable();
+        PreemptGuard
+    }
+}
+
+impl Drop for PreemptGuard {
+    #[inline]
+    fn drop(&mut self) {
+        preempt_enable();
+    }
+}
@@ -11,7 +11,10 @@
 //! - 调度实体 (sched_entity): fair 调度单位
 //! - 调度入口: schedule() -> __schedule() -> context_switch()
 //!
-//! 当前实现: 简单的 FIFO 调度器（可扩展为 CFS）
+//! 当前实现:
+//! - fair: CFS（见 fair.rs），SCHED_NORMAL/BATCH/IDLE 任务按 vruntime 选择
+//! - rt: 优先级位图运行队列（每个优先级一个 FIFO 链表，O(1) 选择），
+//!   SCHED_FIFO/RR 任务总是优先于 CFS 任务
 //!
 //! 注意：使用原始指针以避免借用检查器限制，这在 OS 内核开发中是常见做法
 
@@ -19,106 +22,839 @@ use crate::errno;
 use crate::process::task::{Task, TaskState, SchedPolicy, Pid};
 use crate::arch;
 use crate::println;
-use crate::fs::{FdTable, File, FileFlags, FileOps, CharDev};
+use crate::fs::{FdTable, File, FileFlags, CharDev};
 use crate::config::{MAX_CPUS, DEFAULT_TIME_SLICE_MS, TIME_SLICE_TICKS};
+use crate::list::ListHead;
+use core::mem::offset_of;
 use alloc::sync::Arc;
 use alloc::boxed::Box;
+use alloc::vec::Vec;
 use crate::sched::pid::alloc_pid;
+use crate::sched::fair::{CfsRq, fair_policy, sched_clock, MAX_RT_PRIO};
+use crate::sched::deque::StealDeque;
+use crate::sched::stats;
+use crate::sched::preempt::{preempt_count, preempt_count_set, preempt_disable, preempt_enable_no_resched};
+use core::sync::atomic::{AtomicBool, AtomicIsize, AtomicPtr, AtomicU64, AtomicUsize, Ordering};
+use crate::mm::kmem_cache::{KmemCache, kmem_cache_create, kmem_cache_alloc, kmem_cache_free, SLAB_HWCACHE_ALIGN, SLAB_CACHE_COLOUR};
 use core::arch::asm;
 use spin::Mutex;
+use crate::sync::{LockClass, QueuedSpinLock, TicketLock};
 
 const MAX_TASKS: usize = 256;
 
-pub struct RunQueue {
-    /// 运行队列 - 使用原始指针
+/// 优先级数量 (MAX_PRIO)
+///
+/// 0-99 为实时优先级，100-139 为普通优先级（对应 nice -20..19）
+pub const MAX_PRIO: usize = 140;
+
+/// 优先级位图的字数 (BITS_TO_LONGS(MAX_PRIO))
+const PRIO_BITMAP_WORDS: usize = (MAX_PRIO + 63) / 64;
+
+/// 任务表槽位位图的字数
+const SLOT_BITMAP_WORDS: usize = MAX_TASKS / 64;
+
+const LIST_HEAD_INIT: ListHead = ListHead::new();
+
+/// 优先级数组 (prio_array)
+///
+/// 参考 Linux: kernel/sched/sched.h struct rt_prio_array
+///
+/// 每个优先级一个 FIFO 链表，位图中置位表示对应链表非空。
+/// 选择下一个任务只需找到位图中最低的置位（优先级最高），时间复杂度 O(1)。
+///
+/// 注意：链表头是自引用结构，PrioArray 放入最终位置后必须调用 init()
+pub struct PrioArray {
+    /// 非空链表位图
+    bitmap: [u64; PRIO_BITMAP_WORDS],
+    /// 每个优先级的任务链表（通过 Task::run_list 链接）
+    queue: [ListHead; MAX_PRIO],
+    /// 队列中的任务数量
+    nr_active: usize,
+}
+
+impl PrioArray {
+    pub const fn new() -> Self {
+        Self {
+            bitmap: [0; PRIO_BITMAP_WORDS],
+            queue: [LIST_HEAD_INIT; MAX_PRIO],
+            nr_active: 0,
+        }
+    }
+
+    /// 初始化所有链表头（必须在 PrioArray 固定位置后调用）
+    pub fn init(&mut self) {
+        for head in self.queue.iter_mut() {
+            head.init();
+        }
+        self.bitmap = [0; PRIO_BITMAP_WORDS];
+        self.nr_active = 0;
+    }
+
+    #[inline]
+    fn task_prio(task: *mut Task) -> usize {
+        let prio = unsafe { (*task).prio() };
+        if prio < 0 {
+            0
+        } else if prio as usize >= MAX_PRIO {
+            MAX_PRIO - 1
+        } else {
+            prio as usize
+        }
+    }
+
+    /// 将任务加入其优先级链表尾部 (enqueue_task_rt)
+    ///
+    /// # Safety
+    /// task 必须有效且不在任何优先级链表中
+    pub unsafe fn enqueue(&mut self, task: *mut Task) {
+        if (*task).on_rq {
+            return;
+        }
+        let prio = Self::task_prio(task);
+        (*task).run_list.add_tail(&mut self.queue[prio]);
+        self.bitmap[prio / 64] |= 1u64 << (prio % 64);
+        (*task).on_rq = true;
+        self.nr_active += 1;
+    }
+
+    /// 将任务从其优先级链表移除 (dequeue_task_rt)
+    ///
+    /// # Safety
+    /// task 必须有效；如果 on_rq 为 true，则必须在本数组中
+    pub unsafe fn dequeue(&mut self, task: *mut Task) {
+        if !(*task).on_rq {
+            return;
+        }
+        self.unlink(task);
+        (*task).on_rq = false;
+        self.nr_active -= 1;
+    }
+
+    /// 将任务移到其优先级链表尾部 (requeue_task_rt)
+    ///
+    /// # Safety
+    /// task 必须有效且在本数组中
+    pub unsafe fn requeue(&mut self, task: *mut Task) {
+        if !(*task).on_rq {
+            return;
+        }
+        let prio = Self::task_prio(task);
+        self.unlink(task);
+        (*task).run_list.add_tail(&mut self.queue[prio]);
+        self.bitmap[prio / 64] |= 1u64 << (prio % 64);
+    }
+
+    /// 把任务从所在的链表摘下，链表变空时清除它的位
+    ///
+    /// 按任务实际所在的链表而不是当前的 prio 清位：入队后 prio 被改过时，
+    /// 旧链表的位不会残留，peek 不会把空链表的表头当作任务返回
+    unsafe fn unlink(&mut self, task: *mut Task) {
+        let prev = (*task).run_list.prev;
+        (*task).run_list.del();
+        // 只有表头在删除后会指向自己
+        if (*prev).is_empty() {
+            let prio = (prev as usize - self.queue.as_ptr() as usize) / core::mem::size_of::<ListHead>();
+            debug_assert!(prio < MAX_PRIO);
+            self.bitmap[prio / 64] &= !(1u64 << (prio % 64));
+        }
+    }
+
+    /// 查找最高优先级的非空链表 (sched_find_first_bit)
+    #[inline]
+    pub fn first_prio(&self) -> Option<usize> {
+        for (i, &word) in self.bitmap.iter().enumerate() {
+            if word != 0 {
+                return Some(i * 64 + word.trailing_zeros() as usize);
+            }
+        }
+        None
+    }
+
+    /// 获取最高优先级链表的第一个任务
+    #[inline]
+    pub fn peek(&self) -> Option<*mut Task> {
+        let prio = self.first_prio()?;
+        let node = self.queue[prio].next;
+        Some((node as usize - offset_of!(Task, run_list)) as *mut Task)
+    }
+
+    /// 队列中的任务数量
+    #[inline]
+    pub fn nr_active(&self) -> usize {
+        self.nr_active
+    }
+}
+
+/// 实时带宽的周期 (sysctl_sched_rt_period)
+pub static SCHED_RT_PERIOD_NS: AtomicU64 = AtomicU64::new(1_000_000_000);
+
+/// 每个周期内实时任务最多运行的时间，u64::MAX 表示不限制 (sysctl_sched_rt_runtime)
+///
+/// 剩下的时间留给 CFS 任务，失控的实时任务不会饿死整个系统
+pub static SCHED_RT_RUNTIME_NS: AtomicU64 = AtomicU64::new(950_000_000);
+
+/// 运行队列的实时带宽记账 (rt_rq 的 rt_time / rt_throttled)
+///
+/// 按时钟中断记账；周期内实时任务的运行时间超过 SCHED_RT_RUNTIME_NS 后节流，
+/// 到下一个周期再解除
+pub struct RtBandwidth {
+    /// 本周期内实时任务已运行的时间
+    rt_time: u64,
+    /// 本周期开始的时间，0 表示还没有记过账
+    period_start: u64,
+    /// 上一次记账的时间
+    last_update: u64,
+    /// 本周期的运行时间已用完
+    throttled: bool,
+}
+
+impl RtBandwidth {
+    pub const fn new() -> Self {
+        Self { rt_time: 0, period_start: 0, last_update: 0, throttled: false }
+    }
+
+    /// 记账到 now 为止的时间 (update_curr_rt / do_sched_rt_period_timer)
+    ///
+    /// `rt_running` 表示上次记账以来 CPU 在运行实时任务
+    ///
+    /// # 返回
+    /// true 表示节流状态改变，需要重新调度
+    pub fn update(&mut self, now: u64, rt_running: bool) -> bool {
+        if self.period_start == 0 {
+            self.period_start = now;
+            self.last_update = now;
+            return false;
+        }
+        let delta = now.saturating_sub(self.last_update);
+        self.last_update = now;
+
+        let mut changed = false;
+        if now.saturating_sub(self.period_start) >= SCHED_RT_PERIOD_NS.load(Ordering::Relaxed) {
+            self.period_start = now;
+            self.rt_time = 0;
+            if self.throttled {
+                self.throttled = false;
+                changed = true;
+            }
+        }
+        if rt_running {
+            self.rt_time = self.rt_time.saturating_add(delta);
+            if !self.throttled && self.rt_time > SCHED_RT_RUNTIME_NS.load(Ordering::Relaxed) {
+                self.throttled = true;
+                changed = true;
+            }
+        }
+        changed
+    }
+
+    /// 本周期的运行时间是否已用完 (rt_rq_throttled)
+    #[inline]
+    pub fn throttled(&self) -> bool {
+        self.throttled
+    }
+
+    /// 本周期内实时任务已运行的时间
+    #[inline]
+    pub fn rt_time(&self) -> u64 {
+        self.rt_time
+    }
+}
+
+/// 槽位链表的结束标记
+const NO_SLOT: u16 = u16::MAX;
+
+/// PID 散列表的桶数 (1 << pidhash_shift)
+const PIDHASH_SHIFT: u32 = 6;
+const PIDHASH_SIZE: usize = 1 << PIDHASH_SHIFT;
+
+/// PID 散列函数 (hash_32)
+#[inline]
+fn pid_hashfn(pid: Pid) -> usize {
+    (pid.wrapping_mul(0x61c8_8647) >> (32 - PIDHASH_SHIFT)) as usize
+}
+
+/// 按槽位号串起的双向链表节点
+#[derive(Clone, Copy)]
+struct SlotLink {
+    prev: u16,
+    next: u16,
+}
+
+impl SlotLink {
+    const UNLINKED: SlotLink = SlotLink { prev: NO_SLOT, next: NO_SLOT };
+}
+
+/// 把 slot 加到链表头部 (list_add)
+fn slot_list_add(head: &mut u16, links: &mut [SlotLink; MAX_TASKS], slot: usize) {
+    let first = *head;
+    links[slot] = SlotLink { prev: NO_SLOT, next: first };
+    if first != NO_SLOT {
+        links[first as usize].prev = slot as u16;
+    }
+    *head = slot as u16;
+}
+
+/// 从链表中摘下 slot (list_del_init)
+///
+/// # 返回
+/// slot 原来是否在链表中
+fn slot_list_del(head: &mut u16, links: &mut [SlotLink; MAX_TASKS], slot: usize) -> bool {
+    let SlotLink { prev, next } = links[slot];
+    if prev != NO_SLOT {
+        links[prev as usize].next = next;
+    } else if *head as usize == slot {
+        *head = next;
+    } else {
+        return false;
+    }
+    if next != NO_SLOT {
+        links[next as usize].prev = prev;
+    }
+    links[slot] = SlotLink::UNLINKED;
+    true
+}
+
+/// 全局任务表
+///
+/// 包含系统中所有已创建的任务（包括睡眠和僵尸任务），供 wait4、
+/// 信号发送等按 PID 查找使用。与运行队列解耦后，任务在 CPU 之间
+/// 迁移时不需要修改任务表，窃取者也不需要获取被窃取 CPU 的锁。
+///
+/// 以下结构都按槽位号索引，不在 Task 中保存指针，由表锁保护：
+/// - PID 散列表 (pid_hash)：按 PID 查找任务 O(1)
+/// - 每个进程的子进程链表 (children / sibling)：父进程退出时交给 init
+/// - 每个进程的僵尸子进程链表：wait4 回收任意子进程 O(1)
+pub struct TaskTable {
+    /// 任务指针 - 使用原始指针
     tasks: [*mut Task; MAX_TASKS],
 
-    /// 当前运行的任务
-    pub current: *mut Task,
+    /// 占用位图（置位表示槽位已使用）
+    slot_bitmap: [u64; SLOT_BITMAP_WORDS],
 
     /// 任务数量
-    nr_running: usize,
+    nr_tasks: usize,
+
+    /// 启动以来注册过的任务数 (total_forks)
+    total_forks: u64,
+
+    /// PID 散列表各桶的第一个槽位
+    pid_hash: [u16; PIDHASH_SIZE],
+    /// 同一桶中的下一个槽位
+    pid_next: [u16; MAX_TASKS],
+
+    /// 父进程所在的槽位，线程和没有登记父进程的任务为 NO_SLOT
+    parent_slot: [u16; MAX_TASKS],
+    /// 子进程链表头，下标为父进程槽位（线程不在其中）
+    children: [u16; MAX_TASKS],
+    sibling: [SlotLink; MAX_TASKS],
+    /// 僵尸子进程链表头，下标为父进程槽位
+    zombies: [u16; MAX_TASKS],
+    zombie_link: [SlotLink; MAX_TASKS],
+}
+
+impl TaskTable {
+    pub const fn new() -> Self {
+        Self {
+            tasks: [core::ptr::null_mut(); MAX_TASKS],
+            slot_bitmap: [0; SLOT_BITMAP_WORDS],
+            nr_tasks: 0,
+            total_forks: 0,
+            pid_hash: [NO_SLOT; PIDHASH_SIZE],
+            pid_next: [NO_SLOT; MAX_TASKS],
+            parent_slot: [NO_SLOT; MAX_TASKS],
+            children: [NO_SLOT; MAX_TASKS],
+            sibling: [SlotLink::UNLINKED; MAX_TASKS],
+            zombies: [NO_SLOT; MAX_TASKS],
+            zombie_link: [SlotLink::UNLINKED; MAX_TASKS],
+        }
+    }
+
+    /// task 已登记时返回它的槽位
+    fn slot_of(&self, task: *const Task) -> Option<usize> {
+        let slot = unsafe { (*task).rq_slot };
+        if slot < MAX_TASKS && self.tasks[slot] as *const Task == task {
+            Some(slot)
+        } else {
+            None
+        }
+    }
+
+    /// 注册任务
+    ///
+    /// 加入 PID 散列表；不是线程且父进程已登记时加入父进程的子进程链表
+    ///
+    /// # 返回
+    /// 任务表已满时返回 false
+    ///
+    /// # Safety
+    /// task 必须有效且未注册
+    unsafe fn insert(&mut self, task: *mut Task) -> bool {
+        let free = self.slot_bitmap.iter().position(|&word| word != u64::MAX);
+        let i = match free {
+            Some(i) => i,
+            None => return false,
+        };
+        let bit = (!self.slot_bitmap[i]).trailing_zeros() as usize;
+        self.slot_bitmap[i] |= 1u64 << bit;
+
+        let slot = i * 64 + bit;
+        self.tasks[slot] = task;
+        self.nr_tasks += 1;
+        self.total_forks += 1;
+        (*task).rq_slot = slot;
+
+        let bucket = pid_hashfn((*task).pid());
+        self.pid_next[slot] = self.pid_hash[bucket];
+        self.pid_hash[bucket] = slot as u16;
+
+        self.parent_slot[slot] = NO_SLOT;
+        self.children[slot] = NO_SLOT;
+        self.zombies[slot] = NO_SLOT;
+        if !(*task).is_thread() {
+            if let Some(pslot) = (*task).parent_ptr().and_then(|parent| self.slot_of(parent)) {
+                self.parent_slot[slot] = pslot as u16;
+                slot_list_add(&mut self.children[pslot], &mut self.sibling, slot);
+            }
+        }
+        true
+    }
+
+    /// 按 PID 查找任务 (find_task_by_pid_ns)
+    fn find(&self, pid: Pid) -> *mut Task {
+        let mut slot = self.pid_hash[pid_hashfn(pid)];
+        while slot != NO_SLOT {
+            let task = self.tasks[slot as usize];
+            if unsafe { (*task).pid() } == pid {
+                return task;
+            }
+            slot = self.pid_next[slot as usize];
+        }
+        core::ptr::null_mut()
+    }
+
+    /// slot 是否在父进程的僵尸链表中
+    fn is_zombie(&self, slot: usize) -> bool {
+        let pslot = self.parent_slot[slot];
+        self.zombie_link[slot].prev != NO_SLOT
+            || (pslot != NO_SLOT && self.zombies[pslot as usize] as usize == slot)
+    }
+
+    /// 把 slot 的子进程交给 init (forget_original_parent)
+    ///
+    /// 没有 init 或退出的就是 init 时，子进程没有父进程，其中的僵尸直接释放
+    ///
+    /// # 返回
+    /// 接收了僵尸子进程、需要唤醒的 init，没有时为 null
+    unsafe fn reparent_children(&mut self, slot: usize) -> *mut Task {
+        let init = self.find(crate::sched::pid::PID_INIT);
+        let init_slot = if init.is_null() { None } else { self.slot_of(init).filter(|&s| s != slot) };
+        let mut reaper = core::ptr::null_mut();
+
+        while self.children[slot] != NO_SLOT {
+            let child = self.children[slot] as usize;
+            slot_list_del(&mut self.children[slot], &mut self.sibling, child);
+            let zombie = slot_list_del(&mut self.zombies[slot], &mut self.zombie_link, child);
+            match init_slot {
+                Some(islot) => {
+                    (*self.tasks[child]).set_parent(init);
+                    self.parent_slot[child] = islot as u16;
+                    slot_list_add(&mut self.children[islot], &mut self.sibling, child);
+                    if zombie {
+                        slot_list_add(&mut self.zombies[islot], &mut self.zombie_link, child);
+                        reaper = init;
+                    }
+                }
+                None => {
+                    (*self.tasks[child]).set_parent(core::ptr::null());
+                    self.parent_slot[child] = NO_SLOT;
+                    if zombie {
+                        let task = self.tasks[child];
+                        self.remove(task);
+                    }
+                }
+            }
+        }
+        reaper
+    }
+
+    /// 任务退出 (exit_notify)
+    ///
+    /// 子进程交给 init，自己挂到父进程的僵尸链表等待回收
+    ///
+    /// # 返回
+    /// 接收了僵尸子进程、需要唤醒的 init，没有时为 null
+    ///
+    /// # Safety
+    /// task 必须有效，状态已经是 Zombie
+    unsafe fn exit_notify(&mut self, task: *mut Task) -> *mut Task {
+        let slot = match self.slot_of(task) {
+            Some(slot) => slot,
+            None => return core::ptr::null_mut(),
+        };
+        let reaper = self.reparent_children(slot);
+        let pslot = self.parent_slot[slot];
+        if pslot != NO_SLOT {
+            slot_list_add(&mut self.zombies[pslot as usize], &mut self.zombie_link, slot);
+        }
+        reaper
+    }
+
+    /// 查找 parent 的一个僵尸子进程，reap 时同时回收 (wait_task_zombie)
+    ///
+    /// pid > 0 时只考虑该子进程，否则考虑任意子进程
+    ///
+    /// # 返回
+    /// - Ok(Some((pid, exit_code, task))): 找到已退出的子进程，回收时 task 是已注销、
+    ///   待释放引用的任务，否则为 null
+    /// - Ok(None): 有符合条件的子进程，但都还没有退出
+    /// - Err(ECHILD): 没有符合条件的子进程
+    unsafe fn wait_zombie(&mut self, parent: *const Task, pid: i32, reap: bool) -> Result<Option<(Pid, i32, *mut Task)>, i32> {
+        let echild = Err(errno::Errno::NoChild.as_neg_i32());
+        let pslot = match self.slot_of(parent) {
+            Some(slot) => slot,
+            None => return echild,
+        };
+
+        let slot = if pid > 0 {
+            let task = self.find(pid as Pid);
+            if task.is_null() || self.parent_slot[(*task).rq_slot] as usize != pslot {
+                return echild;
+            }
+            if !self.is_zombie((*task).rq_slot) {
+                return Ok(None);
+            }
+            (*task).rq_slot
+        } else {
+            match self.zombies[pslot] {
+                NO_SLOT if self.children[pslot] == NO_SLOT => return echild,
+                NO_SLOT => return Ok(None),
+                slot => slot as usize,
+            }
+        };
+
+        let task = self.tasks[slot];
+        let (child_pid, exit_code) = ((*task).pid(), (*task).exit_code());
+        if !reap {
+            return Ok(Some((child_pid, exit_code, core::ptr::null_mut())));
+        }
+        self.remove(task);
+        Ok(Some((child_pid, exit_code, task)))
+    }
+
+    /// 注销任务并释放 PID (release_task)
+    ///
+    /// 回收僵尸进程或线程退出时调用；仍有子进程时先交给 init
+    ///
+    /// # Safety
+    /// task 必须有效
+    unsafe fn remove(&mut self, task: *mut Task) {
+        let slot = match self.slot_of(task) {
+            Some(slot) => slot,
+            None => return,
+        };
+
+        let bucket = pid_hashfn((*task).pid());
+        if self.pid_hash[bucket] as usize == slot {
+            self.pid_hash[bucket] = self.pid_next[slot];
+        } else {
+            let mut prev = self.pid_hash[bucket];
+            while prev != NO_SLOT {
+                let next = self.pid_next[prev as usize];
+                if next as usize == slot {
+                    self.pid_next[prev as usize] = self.pid_next[slot];
+                    break;
+                }
+                prev = next;
+            }
+        }
+        self.pid_next[slot] = NO_SLOT;
+
+        let pslot = self.parent_slot[slot];
+        if pslot != NO_SLOT {
+            slot_list_del(&mut self.children[pslot as usize], &mut self.sibling, slot);
+            slot_list_del(&mut self.zombies[pslot as usize], &mut self.zombie_link, slot);
+            self.parent_slot[slot] = NO_SLOT;
+        }
+        self.reparent_children(slot);
+
+        self.tasks[slot] = core::ptr::null_mut();
+        self.slot_bitmap[slot / 64] &= !(1u64 << (slot % 64));
+        self.nr_tasks -= 1;
+        crate::sched::pid::free_pid((*task).pid());
+    }
+}
+
+unsafe impl Send for TaskTable {}
+
+static TASKLIST_LOCK_CLASS: LockClass = LockClass::new("tasklist");
+
+static TASK_TABLE: TicketLock<TaskTable> = TicketLock::with_class(TaskTable::new(), &TASKLIST_LOCK_CLASS);
+
+pub struct RunQueue {
+    /// 当前运行的任务
+    pub current: *mut Task,
 
     /// 空闲任务
     idle: *mut Task,
 
-    /// Round Robin 调度索引
-    /// 记录上一次调度到的位置，实现循环遍历
-    sched_index: usize,
+    /// 本运行队列所属的 CPU
+    cpu: usize,
+
+    /// 实时任务的优先级数组 (rt_rq)
+    active: PrioArray,
+
+    /// 实时带宽记账 (rt_rq 的节流状态)
+    rt: RtBandwidth,
+
+    /// CFS 运行队列 (cfs_rq)
+    cfs: CfsRq,
+}
+
+impl RunQueue {
+    /// 可运行任务数（包括正在运行的任务，不包括 idle）
+    #[inline]
+    fn nr_running(&self) -> usize {
+        self.active.nr_active() + self.cfs.nr_running()
+    }
+
+    /// 发布本 CPU 的负载，供其他 CPU 在不加锁的情况下选择窃取目标
+    #[inline]
+    fn update_load(&self) {
+        let nr = self.nr_running();
+        RQ_NR_RUNNING.per_cpu(self.cpu).store(nr, Ordering::Relaxed);
+        RQ_NR_THROTTLED.per_cpu(self.cpu).store(self.cfs.nr_throttled(), Ordering::Relaxed);
+        crate::time::tick::tick_nohz_dep_update(self.cpu, nr);
+    }
+
+    /// 将任务迁入本运行队列，可运行时加入对应调度类
+    ///
+    /// # Safety
+    /// task 必须有效且不在任何运行队列中
+    unsafe fn attach_task(&mut self, task: *mut Task) {
+        (*task).set_cpu(self.cpu);
+        if (*task).state() == TaskState::Running {
+            self.enqueue_class(task);
+        }
+    }
+
+    /// 按调度策略把任务加入对应调度类的队列
+    ///
+    /// # Safety
+    /// task 必须有效且属于本运行队列
+    unsafe fn enqueue_class(&mut self, task: *mut Task) {
+        // 从不可中断睡眠中唤醒：离开平均负载的不可中断计数
+        if (*task).se.sched_contributes_to_load {
+            (*task).se.sched_contributes_to_load = false;
+            RQ_NR_UNINTERRUPTIBLE.per_cpu(self.cpu).fetch_sub(1, Ordering::Relaxed);
+        }
+        if task != self.current {
+            stats::sched_info_queued(&mut *task, sched_clock());
+        }
+        if fair_policy((*task).policy()) {
+            self.cfs.enqueue(task);
+        } else {
+            self.active.enqueue(task);
+        }
+        self.update_load();
+    }
+
+    /// 把任务从所在调度类的队列移除（不在队列中时无操作）
+    ///
+    /// # Safety
+    /// task 必须有效且属于本运行队列
+    unsafe fn dequeue_class(&mut self, task: *mut Task) {
+        self.cfs.dequeue(task);
+        self.cfs.remove_throttled(task);
+        self.active.dequeue(task);
+        self.update_load();
+    }
 }
 
 unsafe impl Send for RunQueue {}
 
-static mut PER_CPU_RQ: [Option<Mutex<RunQueue>>; MAX_CPUS] = [None, None, None, None];
+crate::percpu! {
+    /// 运行队列锁竞争最激烈，使用排队锁 (runqueues)
+    static PER_CPU_RQ: Option<QueuedSpinLock<RunQueue>> = None;
 
-static RQ_INIT_LOCK: Mutex<[bool; MAX_CPUS]> = Mutex::new([false; MAX_CPUS]);
+    /// 需要重新调度 (TIF_NEED_RESCHED)
+    static NEED_RESCHED: AtomicBool = AtomicBool::new(false);
+}
 
+static RQ_LOCK_CLASS: LockClass = LockClass::new("rq");
 
-static mut NEED_RESCHED: [core::sync::atomic::AtomicBool; MAX_CPUS] = [
-    core::sync::atomic::AtomicBool::new(false),
-    core::sync::atomic::AtomicBool::new(false),
-    core::sync::atomic::AtomicBool::new(false),
-    core::sync::atomic::AtomicBool::new(false),
-];
+static RQ_INIT_LOCK: Mutex<[bool; MAX_CPUS]> = Mutex::new([false; MAX_CPUS]);
 
 #[inline]
 pub fn need_resched() -> bool {
-    unsafe {
-        let cpu_id = crate::arch::cpu_id() as u64 as usize;
-        if cpu_id >= MAX_CPUS {
-            return false;
-        }
-        NEED_RESCHED[cpu_id].load(core::sync::atomic::Ordering::Acquire)
-    }
+    NEED_RESCHED.this_cpu().load(Ordering::Acquire)
 }
 
 #[inline]
 pub fn set_need_resched() {
-    unsafe {
-        let cpu_id = crate::arch::cpu_id() as u64 as usize;
-        if cpu_id < MAX_CPUS {
-            NEED_RESCHED[cpu_id].store(true, core::sync::atomic::Ordering::Release);
-        }
-    }
+    NEED_RESCHED.this_cpu().store(true, Ordering::Release);
 }
 
 #[inline]
 fn clear_need_resched() {
-    unsafe {
-        let cpu_id = crate::arch::cpu_id() as u64 as usize;
-        if cpu_id < MAX_CPUS {
-            NEED_RESCHED[cpu_id].store(false, core::sync::atomic::Ordering::Release);
-        }
-    }
+    NEED_RESCHED.this_cpu().store(false, Ordering::Release);
 }
 
 pub fn scheduler_tick() {
+    crate::perf_event::perf_event_tick();
+
     // 获取当前 CPU 的运行队列
     let rq = match this_cpu_rq() {
         Some(r) => r,
         None => return,
     };
 
-    let rq_inner = rq.lock();
+    let mut rq_inner = rq.lock();
     let current = rq_inner.current;
 
     if current.is_null() {
         return;
     }
 
-    // 更新时间片（使用 Task 的公共方法）
     let task = unsafe { &mut *current };
-    let still_has_slice = task.tick_time_slice();
+    let resched = if current != rq_inner.idle && fair_policy(task.policy()) {
+        // CFS：结算 vruntime，超出理想时间片时抢占
+        rq_inner.cfs.task_tick(current)
+    } else if task.policy() == SchedPolicy::Fifo {
+        // SCHED_FIFO 没有时间片，只能被更高优先级任务抢占
+        false
+    } else {
+        // SCHED_RR 和 idle 任务：固定时间片轮转
+        if task.tick_time_slice() {
+            false
+        } else {
+            // 时间片用完，重新分配时间片
+            task.reset_time_slice();
+            true
+        }
+    };
+
+    // 实时带宽记账：节流时让出 CPU 给 CFS 任务，解除节流时实时任务重新抢占
+    let rt_running = current != rq_inner.idle && !fair_policy(task.policy());
+    let throttle_changed = rq_inner.rt.update(sched_clock(), rt_running);
+
+    // 组带宽进入新周期：节流的 CFS 任务放回运行队列
+    let (unthrottled, remote) = if rq_inner.cfs.nr_throttled() != 0 {
+        unsafe { unthrottle_cfs_tasks(&mut *rq_inner, sched_clock()) }
+    } else {
+        (false, Vec::new())
+    };
+
+    let this_cpu = rq_inner.cpu;
+    drop(rq_inner);  // 释放锁后再设置标志
 
-    // 检查时间片是否用完
-    if !still_has_slice {
-        // 时间片用完，重新分配时间片
-        task.reset_time_slice();
+    for task in remote {
+        unsafe { attach_remote(task, select_fallback_rq(&*task, this_cpu)) };
+    }
 
+    if resched || throttle_changed || unthrottled {
         // 设置 need_resched 标志，触发重新调度
-        drop(rq_inner);  // 释放锁后再设置标志
         set_need_resched();
     }
+
+    // 周期性负载均衡，各 CPU 错开 tick 以免同时均衡
+    #[cfg(feature = "riscv64")]
+    {
+        let jiffies = crate::drivers::timer::get_jiffies();
+        super::loadavg::calc_global_load(jiffies);
+        if (jiffies + this_cpu as u64) % BALANCE_INTERVAL_TICKS == 0 {
+            rebalance(this_cpu);
+        }
+    }
+}
+
+/// 把一个 tick 计入当前任务和本 CPU 的 CPU 时间 (account_process_tick)
+///
+/// 在时钟中断中、scheduler_tick 之前调用；user_tick 表示被打断的是用户态
+pub fn account_process_tick(user_tick: bool) {
+    let rq = match this_cpu_rq() {
+        Some(r) => r,
+        None => return,
+    };
+    let rq_inner = rq.lock();
+    let current = rq_inner.current;
+    if current.is_null() {
+        return;
+    }
+    let idle = current == rq_inner.idle;
+    let in_softirq = crate::softirq::in_softirq();
+    stats::account_process_tick(rq_inner.cpu, unsafe { &mut *current }, idle, user_tick, in_softirq);
+}
+
+/// CPU 能否停止 tick (sched_can_stop_tick)
+///
+/// 只有一个可运行任务时不需要时间片轮转；有节流的任务时由 tick 检查新周期。
+/// 读取发布的负载，不获取运行队列锁，可以在中断中调用
+pub fn sched_can_stop_tick(cpu: usize) -> bool {
+    cpu < MAX_CPUS
+        && RQ_NR_RUNNING.per_cpu(cpu).load(Ordering::Relaxed) <= 1
+        && !sched_cfs_throttled(cpu)
+}
+
+/// CPU 上是否有等待组带宽新周期的任务，此时空闲也不能停止 tick
+pub fn sched_cfs_throttled(cpu: usize) -> bool {
+    cpu < MAX_CPUS && RQ_NR_THROTTLED.per_cpu(cpu).load(Ordering::Relaxed) != 0
+}
+
+/// 把组带宽已进入新周期的节流任务放回运行队列 (distribute_cfs_runtime)
+///
+/// # 返回
+/// (是否有任务放回本 CPU, 亲和性已不包括本 CPU、需要在锁外迁走的任务)
+unsafe fn unthrottle_cfs_tasks(rq: &mut RunQueue, now: u64) -> (bool, Vec<*mut Task>) {
+    let ready = rq.cfs.take_unthrottled(now);
+    let mut remote = Vec::new();
+    if ready.is_empty() {
+        return (false, remote);
+    }
+    let mut queued = false;
+    for task in ready {
+        // 不再可运行的任务由唤醒重新入队
+        if (*task).state() != TaskState::Running {
+            continue;
+        }
+        if !(*task).cpu_allowed(rq.cpu) {
+            rq.cfs.migrate_out(task);
+            (*task).set_cpu(CPU_NONE);
+            remote.push(task);
+            continue;
+        }
+        rq.enqueue_class(task);
+        queued = true;
+    }
+    rq.update_load();
+    (queued, remote)
+}
+
+crate::percpu! {
+    /// 正在运行的任务，context_switch 时发布，不加锁读取 (rq->curr)
+    static CPU_CURR: AtomicPtr<Task> = AtomicPtr::new(core::ptr::null_mut());
+}
+
+/// 本 CPU 当前任务的 PID，不获取运行队列锁
+///
+/// 跟踪记录等可能在持有运行队列锁时执行的路径使用；本 CPU 的当前任务在切换前不会被释放
+pub fn cpu_curr_pid() -> u32 {
+    let cpu = crate::arch::cpu_id() as usize;
+    if cpu >= MAX_CPUS {
+        return 0;
+    }
+    let curr = CPU_CURR.per_cpu(cpu).load(Ordering::Relaxed);
+    if curr.is_null() { 0 } else { unsafe { (*curr).pid() } }
+}
+
+/// 任务是否正在它所属的 CPU 上运行 (task_curr)
+///
+/// 不获取运行队列锁，结果只是一瞬间的快照；互斥锁乐观自旋时用来判断持有者是否还在运行
+pub fn task_curr(task: *const Task) -> bool {
+    if task.is_null() {
+        return false;
+    }
+    let cpu = unsafe { (*task).cpu() };
+    cpu < MAX_CPUS && core::ptr::eq(CPU_CURR.per_cpu(cpu).load(Ordering::Relaxed), task)
 }
 
 pub fn resched_curr() {
@@ -134,6 +870,14 @@ pub fn resched_curr() {
 /// # 参数
 /// * `cpu` - 目标 CPU ID
 pub fn resched_cpu(cpu: usize) {
+    // 目标 CPU 在空闲循环中轮询 need_resched 时只设置标志，不发送 IPI (set_nr_if_polling)；
+    // 先写标志再检查状态，与 idle::poll_idle 的顺序相反
+    if cpu < MAX_CPUS {
+        NEED_RESCHED.per_cpu(cpu).store(true, Ordering::SeqCst);
+        if super::idle::cpu_polling(cpu) {
+            return;
+        }
+    }
     // 发送 Reschedule IPI 到目标 CPU
     #[cfg(feature = "riscv64")]
     crate::arch::ipi::send_reschedule_ipi(cpu);
@@ -145,22 +889,24 @@ pub fn wake_up_process(task: *mut Task) -> bool {
     Task::wake_up(task)
 }
 
-pub fn this_cpu_rq() -> Option<&'static Mutex<RunQueue>> {
-    unsafe {
-        let cpu_id = crate::arch::cpu_id() as u64 as usize;
-        if cpu_id >= MAX_CPUS {
-            return None;
-        }
-        PER_CPU_RQ[cpu_id].as_ref()
-    }
+/// 同步唤醒 (wake_up_process 带 WF_SYNC)
+///
+/// 唤醒者随后就会睡眠（如管道写满后等待读者），被唤醒者优先放在唤醒者的 CPU 上
+pub fn wake_up_process_sync(task: *mut Task) -> bool {
+    use crate::process::Task;
+    Task::try_to_wake_up(task, WF_SYNC)
 }
 
-pub fn cpu_rq(cpu_id: usize) -> Option<&'static Mutex<RunQueue>> {
+pub fn this_cpu_rq() -> Option<&'static QueuedSpinLock<RunQueue>> {
+    unsafe { (*PER_CPU_RQ.this_cpu_ptr()).as_ref() }
+}
+
+pub fn cpu_rq(cpu_id: usize) -> Option<&'static QueuedSpinLock<RunQueue>> {
     unsafe {
         if cpu_id >= MAX_CPUS {
             return None;
         }
-        PER_CPU_RQ[cpu_id].as_ref()
+        (*PER_CPU_RQ.per_cpu_ptr(cpu_id)).as_ref()
     }
 }
 
@@ -175,13 +921,19 @@ pub fn init_per_cpu_rq(cpu_id: usize) {
     }
 
     unsafe {
-        PER_CPU_RQ[cpu_id] = Some(Mutex::new(RunQueue {
-            tasks: [core::ptr::null_mut(); MAX_TASKS],
+        *PER_CPU_RQ.per_cpu_ptr(cpu_id) = Some(QueuedSpinLock::with_class(RunQueue {
             current: core::ptr::null_mut(),
-            nr_running: 0,
             idle: core::ptr::null_mut(),
-            sched_index: 0,
-        }));
+            cpu: cpu_id,
+            active: PrioArray::new(),
+            rt: RtBandwidth::new(),
+            cfs: CfsRq::new(),
+        }, &RQ_LOCK_CLASS));
+
+        // 优先级链表头是自引用的，必须在运行队列放入最终位置后初始化
+        if let Some(rq) = (*PER_CPU_RQ.per_cpu_ptr(cpu_id)).as_ref() {
+            rq.lock().active.init();
+        }
 
         init_flags[cpu_id] = true;
     }
@@ -195,76 +947,145 @@ static mut IDLE_TASK_STORAGES: [core::mem::MaybeUninit<Task>; MAX_CPUS] = [
     core::mem::MaybeUninit::uninit(),
 ];
 
-const TASK_POOL_SIZE: usize = 16;
-
-// 计算 Task 结构体的实际大小，确保每个槽位足够大
-// Task 包含：CpuContext、AddressSpace、Option<Box<FdTable>>、
-//            Option<Box<SignalStruct>>、ListHead 等
-const TASK_SIZE: usize = core::mem::size_of::<Task>();
-
-// Task 结构体的对齐要求
-const TASK_ALIGN: usize = core::mem::align_of::<Task>();
-
-// 计算对齐后的槽位大小（向上舍入到对齐边界）
-const TASK_SLOT_SIZE: usize = (TASK_SIZE + TASK_ALIGN - 1) / TASK_ALIGN * TASK_ALIGN;
+// 任务缓存 (task_struct_cachep)
+//
+// Task 包含：CpuContext、Option<Arc<AddressSpace>>、Option<Arc<FdTable>>、
+//            Option<Arc<SignalStruct>>、ListHead 等，
+// 使用精确大小的对象缓存，避免按 2 的幂取整浪费内存
+static TASK_CACHEP: AtomicPtr<KmemCache> = AtomicPtr::new(core::ptr::null_mut());
+
+// 任务缓存创建锁
+static TASK_CACHE_LOCK: Mutex<()> = Mutex::new(());
+
+/// 获取任务缓存，第一次使用时创建
+fn task_cachep() -> Option<&'static KmemCache> {
+    let cachep = TASK_CACHEP.load(Ordering::Acquire);
+    if !cachep.is_null() {
+        return Some(unsafe { &*cachep });
+    }
 
-// 任务池锁 - 保护 TASK_POOL 和 TASK_POOL_NEXT
-static TASK_POOL_LOCK: Mutex<()> = Mutex::new(());
+    let _lock = TASK_CACHE_LOCK.lock();
+    let cachep = TASK_CACHEP.load(Ordering::Acquire);
+    if !cachep.is_null() {
+        return Some(unsafe { &*cachep });
+    }
 
-// 使用对齐的静态数组作为任务池
-// 使用 repr(align) 确保数组有正确的对齐
-#[repr(C, align(16))]
-struct AlignedTaskPool {
-    data: [u8; TASK_POOL_SIZE * TASK_SLOT_SIZE],
+    let cachep = kmem_cache_create(
+        "task_struct",
+        core::mem::size_of::<Task>(),
+        core::mem::align_of::<Task>(),
+        SLAB_HWCACHE_ALIGN | SLAB_CACHE_COLOUR,
+        None,
+    )?;
+    TASK_CACHEP.store(cachep as *const KmemCache as *mut KmemCache, Ordering::Release);
+    Some(cachep)
 }
 
-static mut TASK_POOL: AlignedTaskPool = AlignedTaskPool {
-    data: [0; TASK_POOL_SIZE * TASK_SLOT_SIZE],
-};
-static mut TASK_POOL_NEXT: usize = 0;
-
-/// 从任务池分配一个槽位
+/// 从任务缓存分配一个 Task
 ///
 /// 返回已初始化的 Task 指针，调用者负责设置 Task 的其他字段
 pub fn alloc_task_slot() -> Option<*mut Task> {
-    let _lock = TASK_POOL_LOCK.lock();
+    let cachep = task_cachep()?;
+    let task_ptr = kmem_cache_alloc(cachep) as *mut Task;
+    if task_ptr.is_null() {
+        return None;
+    }
 
     unsafe {
-        if TASK_POOL_NEXT >= TASK_POOL_SIZE {
-            return None;
+        // 分配 PID
+        let pid = match alloc_pid() {
+            Some(p) => p,
+            None => {
+                kmem_cache_free(cachep, task_ptr as *mut u8);
+                return None;
+            }
+        };
+
+        // 初始化 Task
+        Task::new_task_at(task_ptr, pid, SchedPolicy::Normal);
+
+        // 任务表和运行状态各持有一个引用
+        (*task_ptr).set_usage(2);
+    }
+
+    Some(task_ptr)
+}
+
+/// 释放任务槽位（回滚分配）
+///
+/// 只归还 Task 本身占用的内存和内核栈，不析构其字段
+pub fn free_task_slot(task_ptr: *mut Task) {
+    if task_ptr.is_null() {
+        return;
+    }
+    crate::sched::pid::free_pid(unsafe { (*task_ptr).pid() });
+    crate::sched::group::cgroup_free(unsafe { &mut *task_ptr });
+    if let Some(cachep) = task_cachep() {
+        unsafe {
+            (*task_ptr).free_kernel_stack();
+            kmem_cache_free(cachep, task_ptr as *mut u8);
         }
+    }
+}
 
-        let pool_idx = TASK_POOL_NEXT;
-        TASK_POOL_NEXT += 1;
+/// 释放任务的一个引用 (put_task_struct)
+///
+/// 最后一个引用释放时析构 Task，内核栈放回内核栈缓存，Task 放回任务缓存。
+/// 静态分配的任务（idle、init）没有引用计数，不会释放
+///
+/// # Safety
+/// task 必须有效；释放运行状态的引用时，task 不能再在任何 CPU 上运行
+pub unsafe fn put_task_struct(task: *mut Task) {
+    if task.is_null() || !(*task).put_usage() {
+        return;
+    }
+    crate::sched::group::cgroup_free(&mut *task);
+    if let Some(cachep) = task_cachep() {
+        (*task).free_kernel_stack();
+        core::ptr::drop_in_place(task);
+        kmem_cache_free(cachep, task as *mut u8);
+    }
+}
 
-        let pool_slot_addr = TASK_POOL.data.as_ptr().add(pool_idx * TASK_SLOT_SIZE);
-        let task_ptr: *mut Task = pool_slot_addr as *mut Task;
+/// 各 CPU 上刚切换走的已退出任务 (rq->prev 的 TASK_DEAD 处理)
+///
+/// 切换时仍在使用它的内核栈和上下文，只能在本 CPU 下一次调度时释放运行状态的引用
+static TASK_DEAD: [AtomicPtr<Task>; MAX_CPUS] = [const { AtomicPtr::new(core::ptr::null_mut()) }; MAX_CPUS];
 
-        // 分配 PID
-        let pid = match alloc_pid() {
-            Some(p) => p,
-            None => {
-                TASK_POOL_NEXT -= 1;
-                return None;
-            }
-        };
+/// 释放本 CPU 上一个已退出任务的运行状态引用 (finish_task_switch)
+unsafe fn finish_dead_task(cpu: usize) {
+    let dead = TASK_DEAD[cpu].swap(core::ptr::null_mut(), Ordering::Acquire);
+    put_task_struct(dead);
+}
 
-        // 初始化 Task
-        Task::new_task_at(task_ptr, pid, SchedPolicy::Normal);
+/// 各 CPU 上一次切换走的任务，上下文可能还没保存完 (finish_task_switch 的 prev)
+static TASK_PREV: [AtomicPtr<Task>; MAX_CPUS] = [const { AtomicPtr::new(core::ptr::null_mut()) }; MAX_CPUS];
 
-        Some(task_ptr)
+/// 确认上一次切换走的任务已完全离开本 CPU，清除它的 on_cpu (finish_task_switch)
+///
+/// 切换到用户态的路径不会回到 __schedule，本 CPU 下一次调度时才确认；
+/// 此前唤醒只会把它放回原 CPU
+unsafe fn finish_task_switch(cpu: usize) {
+    let prev = TASK_PREV[cpu].swap(core::ptr::null_mut(), Ordering::AcqRel);
+    if !prev.is_null() {
+        (*prev).se.on_cpu.store(false, Ordering::Release);
     }
 }
 
-/// 释放任务池槽位（回滚分配）
-pub fn free_task_slot(_task_ptr: *mut Task) {
-    let _lock = TASK_POOL_LOCK.lock();
-    unsafe {
-        if TASK_POOL_NEXT > 0 {
-            TASK_POOL_NEXT -= 1;
-        }
+/// 各 CPU 上因亲和性改变而离开、等上下文保存完再迁走的任务 (migration_cpu_stop)
+static TASK_MIGRATING: [AtomicPtr<Task>; MAX_CPUS] = [const { AtomicPtr::new(core::ptr::null_mut()) }; MAX_CPUS];
+
+/// 把已完全离开本 CPU 的待迁移任务加入允许的 CPU
+///
+/// # Safety
+/// 不能持有任何运行队列的锁
+unsafe fn finish_task_migration(cpu: usize) {
+    let task = TASK_MIGRATING[cpu].load(Ordering::Acquire);
+    if task.is_null() || (*task).se.on_cpu.load(Ordering::Acquire) {
+        return;
     }
-    // 注意：这里没有真正释放内存，因为任务池是静态分配的
+    TASK_MIGRATING[cpu].store(core::ptr::null_mut(), Ordering::Relaxed);
+    attach_remote(task, select_fallback_rq(&*task, cpu));
 }
 
 pub fn init() {
@@ -289,24 +1110,63 @@ pub fn init() {
             let mut rq_inner = rq.lock();
             rq_inner.idle = idle_ptr;
             rq_inner.current = idle_ptr;
+            (*idle_ptr).se.on_cpu.store(true, Ordering::Release);
+            stats::sched_info_idle_start(cpu_id, &mut *idle_ptr, sched_clock());
         }
+        CPU_CURR.per_cpu(cpu_id).store(idle_ptr, Ordering::Relaxed);
     }
 }
 
+/// 主动调度 (schedule)
+///
+/// 调度期间禁止抢占，锁释放时不会递归进入调度
 #[inline(never)]
 pub fn schedule() {
+    preempt_disable();
     unsafe {
-        __schedule();
+        __schedule(false);
+    }
+    preempt_enable_no_resched();
+}
+
+/// preempt_enable 把计数减到 0 时的抢占 (preempt_schedule)
+///
+/// 关中断或在软中断中时不调度，由之后的抢占点处理
+pub fn preempt_schedule() {
+    if !crate::sched::preempt::preemptible() || crate::softirq::in_softirq() {
+        return;
+    }
+    preempt_schedule_common();
+}
+
+/// 中断返回内核态时的抢占 (preempt_schedule_irq)
+///
+/// 被打断的代码禁止了抢占时不调度，它允许抢占时由 preempt_enable 处理
+pub fn preempt_schedule_irq() {
+    if preempt_count() != 0 {
+        return;
     }
+    preempt_schedule_common();
 }
 
-unsafe fn __schedule() {
-    // Debug: entering schedule
-    crate::console::putchar(b'S');
-    crate::console::putchar(b'C');
-    crate::console::putchar(b'H');
-    crate::console::putchar(b'\n');
+/// 抢占式调度：被抢占的任务即使已设置睡眠状态也留在运行队列上 (SM_PREEMPT)
+///
+/// 任务可能在设置睡眠状态之后、调用 schedule 之前被抢占，
+/// 此时让它离开队列会错过还没开始等待的唤醒
+fn preempt_schedule_common() {
+    loop {
+        preempt_disable();
+        unsafe {
+            __schedule(true);
+        }
+        preempt_enable_no_resched();
+        if !need_resched() {
+            break;
+        }
+    }
+}
 
+unsafe fn __schedule(preempt: bool) {
     // 清除 need_resched 标志
     clear_need_resched();
 
@@ -316,6 +1176,17 @@ unsafe fn __schedule() {
         None => return,
     };
 
+    // 上一次切换走的任务（包括已退出的）不再使用本 CPU
+    let cpu = crate::arch::cpu_id() as usize;
+    if cpu < MAX_CPUS {
+        finish_task_switch(cpu);
+        finish_dead_task(cpu);
+        finish_task_migration(cpu);
+    }
+
+    // 调度点是静止状态：执行宽限期已结束的 RCU 回调
+    crate::sync::rcu::rcu_note_context_switch();
+
     let mut rq_inner = rq.lock();
 
     // 获取当前任务
@@ -324,15 +1195,10 @@ unsafe fn __schedule() {
     if prev.is_null() {
         return;
     }
-
-    // Debug: show nr_running
-    crate::console::putchar(b'N');
-    crate::console::putchar(b'R');
-    crate::console::putchar(b'0' + (rq_inner.nr_running as u8));
-    crate::console::putchar(b'\n');
+    stats::schedstat_schedule(rq_inner.cpu);
 
     // 如果只有 idle 任务（nr_running == 0），尝试负载均衡
-    if rq_inner.nr_running == 0 {
+    if rq_inner.nr_running() == 0 {
         drop(rq_inner);
         load_balance();
 
@@ -342,57 +1208,153 @@ unsafe fn __schedule() {
         };
         rq_inner = rq.lock();
 
-        if rq_inner.nr_running == 0 {
+        // 仍然没有可运行任务：当前是 idle 则继续 idle，
+        // 否则（当前任务已睡眠/退出）切换到 idle
+        if rq_inner.nr_running() == 0 && prev == rq_inner.idle {
             return;
         }
     }
 
+    // 进入不可中断睡眠的任务计入平均负载 (nr_uninterruptible)
+    if !preempt && prev != rq_inner.idle && (*prev).state() == TaskState::Uninterruptible
+        && !(*prev).se.sched_contributes_to_load
+    {
+        (*prev).se.sched_contributes_to_load = true;
+        RQ_NR_UNINTERRUPTIBLE.per_cpu(rq_inner.cpu).fetch_add(1, Ordering::Relaxed);
+    }
+
     // 选择下一个任务
-    let next = pick_next_task(&mut *rq_inner);
+    let next = pick_next_task(&mut *rq_inner, preempt);
+    if next == rq_inner.idle {
+        stats::schedstat_goidle(rq_inner.cpu);
+    }
 
     if next == prev {
         return;
     }
 
+    crate::tracepoint!(SCHED_SWITCH, "cpu={} prev={} next={} nr_running={}",
+                       rq_inner.cpu, (*prev).pid(), (*next).pid(), rq_inner.nr_running());
+    crate::trace_record!(TRACE_SCHED_SWITCH, (*prev).pid(), (*next).pid(), (*prev).state() as u32);
+
+    // 已退出的任务不会再运行，由本 CPU 下一次调度时释放
+    if !preempt && (*prev).state() == TaskState::Zombie && cpu < MAX_CPUS {
+        TASK_DEAD[cpu].store(prev, Ordering::Release);
+    }
+
+    // 只保存 prev 改过的浮点寄存器
+    crate::arch::riscv64::fpu::fpu_switch_out(prev);
+
+    // 记录离开 CPU 的时间，唤醒时判断缓存是否还热
+    let now = sched_clock();
+    (*prev).se.last_ran = now;
+    let idle = rq_inner.idle;
+    stats::sched_info_switch(rq_inner.cpu, &mut *prev, prev == idle, &mut *next, next == idle, preempt, now);
+    crate::perf_event::perf_event_task_switch(rq_inner.cpu, &*prev, &*next);
+
     // 上下文切换（需要在锁外执行）
     drop(rq_inner);
     context_switch(&mut *prev, &mut *next);
+
+    // 回到这里时 prev 已被重新调度，可能在另一个 CPU 上；
+    // 切换到它的任务上下文已保存完，可以迁走因亲和性离开的任务
+    let cpu = crate::arch::cpu_id() as usize;
+    if cpu < MAX_CPUS {
+        finish_task_switch(cpu);
+        finish_task_migration(cpu);
+    }
 }
 
-unsafe fn pick_next_task(rq: &mut RunQueue) -> *mut Task {
+/// 选择下一个运行的任务 (pick_next_task)
+///
+/// 先放回当前任务 (put_prev_task)：
+/// - 不再允许在本 CPU 上运行的任务离开运行队列，等待迁移
+/// - CFS 任务按更新后的 vruntime 重新插入红黑树，已睡眠的任务离开队列
+/// - 实时任务移到其优先级链表尾部（同优先级轮转）
+/// - 被抢占 (preempt) 的任务按可运行处理；实时队列仍会惰性移出已睡眠的任务，
+///   它们都已在等待队列或定时器上，唤醒时重新入队
+///
+/// 然后按调度类优先级选择：实时任务优先，其次 CFS，最后 idle。
+/// 实时带宽被节流时先运行 CFS 任务；没有 CFS 任务时实时任务照常运行，不让 CPU 空转。
+unsafe fn pick_next_task(rq: &mut RunQueue, preempt: bool) -> *mut Task {
     let current = rq.current;
-    let start_index = rq.sched_index;
-
-    // 从 sched_index + 1 开始查找，实现循环遍历
-    for offset in 1..=MAX_TASKS {
-        let idx = (start_index + offset) % MAX_TASKS;
-        let task_ptr = rq.tasks[idx];
-
-        // 找到一个非空且不是当前任务的任务
-        if !task_ptr.is_null() && task_ptr != current {
-            // 检查任务状态，只选择 Running 状态的任务
-            if (*task_ptr).state() == TaskState::Running {
-                // 更新 sched_index 到这个任务的位置
-                rq.sched_index = idx;
-                return task_ptr;
+    let nr_throttled = rq.cfs.nr_throttled();
+
+    if !current.is_null() && current != rq.idle {
+        if (*current).state() == TaskState::Running && !(*current).cpu_allowed(rq.cpu) {
+            // 亲和性已排除本 CPU：离开运行队列，切换完成后由 finish_task_migration 迁走
+            rq.dequeue_class(current);
+            rq.cfs.migrate_out(current);
+            (*current).set_cpu(CPU_NONE);
+            TASK_MIGRATING[rq.cpu].store(current, Ordering::Release);
+        } else if fair_policy((*current).policy()) {
+            rq.cfs.put_prev(current, preempt);
+        } else if (*current).on_rq {
+            if preempt || (*current).state() == TaskState::Running {
+                rq.active.requeue(current);
+            } else {
+                rq.active.dequeue(current);
             }
         }
     }
 
-    // 没找到其他可运行任务，检查当前任务是否可运行
-    if !current.is_null() && (*current).state() == TaskState::Running {
-        return current;
+    // 当前任务的组带宽用完时已被 put_prev 节流
+    if rq.cfs.nr_throttled() != nr_throttled {
+        rq.update_load();
+    }
+
+    let rt_first = !rq.rt.throttled();
+    if rt_first {
+        if let Some(task_ptr) = pick_next_rt(rq) {
+            return task_ptr;
+        }
+    }
+
+    let nr_throttled = rq.cfs.nr_throttled();
+    let next = rq.cfs.pick_next();
+    if rq.cfs.nr_throttled() != nr_throttled {
+        rq.update_load();
+    }
+    if let Some(task_ptr) = next {
+        return task_ptr;
+    }
+
+    if !rt_first {
+        if let Some(task_ptr) = pick_next_rt(rq) {
+            return task_ptr;
+        }
     }
 
     // 没有可运行任务，返回 idle 任务
     rq.idle
 }
 
+/// 选择优先级最高的实时任务 (pick_next_task_rt)
+///
+/// 实时队列中已不可运行的任务（睡眠/僵尸/停止）在此处惰性移出，
+/// 每个任务最多被移出一次，总体仍为 O(1)。
+unsafe fn pick_next_rt(rq: &mut RunQueue) -> Option<*mut Task> {
+    while let Some(task_ptr) = rq.active.peek() {
+        if (*task_ptr).state() == TaskState::Running {
+            return Some(task_ptr);
+        }
+        rq.active.dequeue(task_ptr);
+    }
+    None
+}
+
 unsafe fn context_switch(prev: &mut Task, next: &mut Task) {
     // 更新当前任务
     if let Some(rq) = this_cpu_rq() {
         let mut rq_inner = rq.lock();
+        let cpu = rq_inner.cpu;
         rq_inner.current = next;
+        CPU_CURR.per_cpu(cpu).store(next, Ordering::Relaxed);
+
+        // 上上个任务早已切换完；prev 直到本 CPU 下一次调度前都视为仍在 CPU 上
+        finish_task_switch(cpu);
+        next.se.on_cpu.store(true, Ordering::Release);
+        TASK_PREV[cpu].store(prev as *mut Task, Ordering::Release);
     }
 
     // fork 子进程：从 ret_from_fork 开始执行
@@ -409,18 +1371,13 @@ unsafe fn context_switch(prev: &mut Task, next: &mut Task) {
         // 清除 fork 子进程标志（只执行一次）
         (*next).clear_fork_child();
 
-        // 切换到子进程的用户页表
+        // 抢占计数属于任务：保存 prev 的，从 ret_from_fork 返回用户态的子进程从 0 开始
+        prev.se.preempt_count = preempt_count();
+        preempt_count_set(0);
+
+        // 切换到子进程的用户页表（带 ASID，不刷新整个 TLB）
         if let Some(addr_space) = (*next).address_space() {
-            let root_ppn = addr_space.root_ppn();
-            // 设置 satp 为子进程的页表
-            // Sv39 模式: satp = (8 << 60) | root_ppn
-            let satp_value = (8usize << 60) | (root_ppn as usize);
-            core::arch::asm!(
-                "csrw satp, {satp}",
-                "sfence.vma",
-                satp = in(reg) satp_value,
-                options(nostack, nomem)
-            );
+            addr_space.enable();
         }
 
         // 释放 prev 的引用（在保存上下文之前）
@@ -461,6 +1418,12 @@ unsafe fn context_switch(prev: &mut Task, next: &mut Task) {
         );
     }
 
+    // 切换地址空间 (switch_mm)
+    // 内核线程没有地址空间，继续使用上一个页表 (lazy TLB)
+    if let Some(addr_space) = (*next).address_space() {
+        addr_space.enable();
+    }
+
     // 检查是否是用户进程（通过是否有用户上下文判断）
     let ctx = (*next).context();
     let user_ctx_ptr = ctx.x1 as *const crate::arch::riscv64::context::UserContext;
@@ -468,6 +1431,8 @@ unsafe fn context_switch(prev: &mut Task, next: &mut Task) {
 
     if is_user_process {
         // 用户进程：切换到用户模式执行
+        prev.se.preempt_count = preempt_count();
+        preempt_count_set(0);
         drop(&mut *prev);
 
         // 有用户上下文，切换到用户模式（永不返回）
@@ -479,103 +1444,438 @@ unsafe fn context_switch(prev: &mut Task, next: &mut Task) {
     }
 }
 
+/// 新任务加入调度 (wake_up_new_task)
+///
+/// 任务先注册到全局任务表；如果有允许它运行的其他 CPU 正在空闲等待，
+/// 把任务发布到本 CPU 的窃取队列并唤醒该 CPU 来窃取，
+/// 否则直接加入本 CPU 的运行队列。亲和性不包括本 CPU 时加入允许的 CPU。
 pub fn enqueue_task(task: &'static mut Task) {
-    if let Some(rq) = this_cpu_rq() {
+    let cpu_id = crate::arch::cpu_id() as u64 as usize;
+    task.set_state(TaskState::Running);
+    let task_ptr = task as *mut Task;
+
+    unsafe {
+        if !TASK_TABLE.lock().insert(task_ptr) {
+            println!("enqueue_task: task table full, pid {}", (*task_ptr).pid());
+            return;
+        }
+    }
+
+    let rq = match this_cpu_rq() {
+        Some(r) => r,
+        None => return,
+    };
+
+    // 继承的亲和性不包括本 CPU 时直接放到允许的 CPU 上
+    if unsafe { !(*task_ptr).cpu_allowed(cpu_id) } {
+        unsafe {
+            (*task_ptr).set_cpu(CPU_NONE);
+            attach_remote(task_ptr, select_fallback_rq(&*task_ptr, cpu_id));
+        }
+        return;
+    }
+
+    let mut kick = None;
+    {
         let mut rq_inner = rq.lock();
-        if rq_inner.nr_running < MAX_TASKS {
-            for i in 0..MAX_TASKS {
-                if rq_inner.tasks[i].is_null() {
-                    rq_inner.tasks[i] = task;
-                    rq_inner.nr_running += 1;
-                    task.set_state(TaskState::Running);
-                    return;
+        unsafe {
+            (*task_ptr).set_cpu(CPU_NONE);
+            match find_idle_cpu(cpu_id, (*task_ptr).cpus_allowed()) {
+                Some(idle_cpu) if STEAL_DEQUES[cpu_id].push(task_ptr) => {
+                    kick = Some(idle_cpu);
                 }
+                _ => rq_inner.attach_task(task_ptr),
             }
         }
     }
+
+    if let Some(cpu) = kick {
+        resched_cpu(cpu);
+    }
 }
 
+/// 将任务移出可运行队列 (dequeue_task)
+///
+/// 任务仍保留在全局任务表中（例如僵尸任务需要等待父进程 wait4 回收），
+/// 只是不再参与调度选择。
 pub fn dequeue_task(task: &Task) {
-    if let Some(rq) = this_cpu_rq() {
+    let task_ptr = task as *const Task as *mut Task;
+    if let Some(rq) = cpu_rq(task.cpu()) {
         let mut rq_inner = rq.lock();
-        let task_ptr = task as *const Task as *mut Task;
-        for i in 0..MAX_TASKS {
-            if rq_inner.tasks[i] == task_ptr {
-                rq_inner.tasks[i] = core::ptr::null_mut();
-                rq_inner.nr_running -= 1;
-                return;
-            }
+        unsafe {
+            rq_inner.dequeue_class(task_ptr);
         }
     }
 }
 
-pub fn yield_cpu() {
-    schedule();
+/// 同步唤醒：唤醒者随后就会睡眠，被唤醒者优先放在唤醒者的 CPU 上 (WF_SYNC)
+pub const WF_SYNC: u32 = 0x1;
+
+/// 离开 CPU 不到这么久的任务认为缓存仍是热的 (sysctl_sched_migration_cost)
+pub const SCHED_MIGRATION_COST_NS: u64 = 500_000;
+
+/// 任务的缓存是否还热 (task_hot)
+#[inline]
+pub fn task_hot(task: &Task, now: u64) -> bool {
+    now.saturating_sub(task.se.last_ran) < SCHED_MIGRATION_COST_NS
 }
 
-/// 简单调试输出
-#[inline(never)]
-fn debug_sched(msg: &str) {
-    unsafe {
-        use crate::console::putchar;
-        for &b in msg.as_bytes() { putchar(b); }
-        putchar(b'\n');
+/// CPU 是否运行调度器且没有可运行任务 (available_idle_cpu)
+#[inline]
+fn cpu_idle(cpu: usize) -> bool {
+    cpu_rq(cpu).is_some() && RQ_NR_RUNNING.per_cpu(cpu).load(Ordering::Relaxed) == 0
+}
+
+/// 为被唤醒的 CFS 任务选择 CPU (select_task_rq_fair)
+///
+/// 只考虑任务亲和性允许的 CPU：
+/// 1. 同步唤醒且唤醒者的 CPU 上只有唤醒者：放到唤醒者的 CPU (wake_affine_idle)
+/// 2. 原 CPU 空闲：留在原 CPU，缓存最热
+/// 3. 有空闲的 CPU：先看唤醒者的 CPU，再按编号找 (select_idle_sibling)
+/// 4. 都不空闲：缓存还热时留在原 CPU，否则放到负载较轻的一边 (wake_affine_weight)
+///
+/// 两边都不允许时返回原 CPU，由 select_fallback_rq 另选
+pub fn select_task_rq_fair(task: &Task, prev_cpu: usize, this_cpu: usize, wake_flags: u32) -> usize {
+    let sync = wake_flags & WF_SYNC != 0;
+    let nr = |cpu: usize| RQ_NR_RUNNING.per_cpu(cpu).load(Ordering::Relaxed);
+    let allowed = |cpu: usize| task.cpu_allowed(cpu);
+
+    if this_cpu >= MAX_CPUS || cpu_rq(this_cpu).is_none() {
+        return prev_cpu;
+    }
+    if sync && this_cpu != prev_cpu && allowed(this_cpu) && nr(this_cpu) <= 1 {
+        return this_cpu;
+    }
+    if allowed(prev_cpu) && cpu_idle(prev_cpu) {
+        return prev_cpu;
+    }
+    if allowed(this_cpu) && cpu_idle(this_cpu) {
+        return this_cpu;
+    }
+    if let Some(cpu) = (0..MAX_CPUS).find(|&cpu| allowed(cpu) && cpu_idle(cpu)) {
+        return cpu;
+    }
+    if !allowed(this_cpu) {
+        return prev_cpu;
+    }
+    if !allowed(prev_cpu) {
+        return this_cpu;
+    }
+    if task_hot(task, sched_clock()) {
+        return prev_cpu;
+    }
+    // 同步唤醒时唤醒者马上离开，不计入本 CPU 的负载
+    let this_load = nr(this_cpu).saturating_sub(sync as usize);
+    if this_load < nr(prev_cpu) {
+        this_cpu
+    } else {
+        prev_cpu
     }
 }
 
-#[inline(never)]
-fn debug_schedule(msg: &str) {
-    use crate::console::putchar;
-    const PREFIX: &[u8] = b"[sched:";
-    for &b in PREFIX {
-        putchar(b);
+/// 为被唤醒的实时任务选择 CPU (select_task_rq_rt / find_lowest_rq)
+///
+/// 原 CPU 上正在运行的任务优先级不低于它时，换到亲和性允许的 CPU 中
+/// 正在运行的任务优先级最低的一个（空闲最低，其次 CFS 任务）。读取 context_switch 发布的 rq->curr，不获取其他
+/// 运行队列的锁，快照可能已过时，只用于选择
+fn select_task_rq_rt(task: &Task, prev_cpu: usize) -> usize {
+    // 数值越大优先级越低
+    let running_prio = |cpu: usize| -> i32 {
+        let curr = CPU_CURR.per_cpu(cpu).load(Ordering::Relaxed);
+        if curr.is_null() || cpu_idle(cpu) {
+            MAX_PRIO as i32
+        } else if unsafe { fair_policy((*curr).policy()) } {
+            MAX_RT_PRIO
+        } else {
+            unsafe { (*curr).prio() }
+        }
+    };
+
+    if task.cpu_allowed(prev_cpu) && running_prio(prev_cpu) > task.prio() {
+        return prev_cpu;
+    }
+    (0..MAX_CPUS)
+        .filter(|&cpu| task.cpu_allowed(cpu) && cpu_rq(cpu).is_some())
+        .max_by_key(|&cpu| running_prio(cpu))
+        .filter(|&cpu| running_prio(cpu) > task.prio())
+        .unwrap_or(prev_cpu)
+}
+
+/// 被唤醒的任务是否应抢占 CPU 上正在运行的任务 (check_preempt_curr)
+///
+/// 实时任务抢占 CFS 任务和优先级更低的实时任务，实时带宽被节流时不抢占；
+/// CFS 任务只抢占 CFS 任务，是否真的切换由 pick_next_task 按 vruntime 决定
+///
+/// # Safety
+/// task 必须有效且属于 rq
+unsafe fn check_preempt_curr(rq: &RunQueue, task: *mut Task) -> bool {
+    let curr = rq.current;
+    if curr.is_null() || curr == rq.idle {
+        return true;
     }
-    for &b in msg.as_bytes() {
-        putchar(b);
+    if curr == task {
+        return false;
     }
-    const SUFFIX: &[u8] = b"]\n";
-    for &b in SUFFIX {
-        putchar(b);
+    let curr_rt = !fair_policy((*curr).policy());
+    if fair_policy((*task).policy()) {
+        !curr_rt
+    } else {
+        !rq.rt.throttled() && (!curr_rt || (*task).prio() < (*curr).prio())
     }
 }
 
-#[inline(never)]
-fn debug_schedule_num(msg: &str, num: u32) {
-    use crate::console::putchar;
-    const PREFIX: &[u8] = b"[sched:";
-    for &b in PREFIX {
-        putchar(b);
-    }
-    for &b in msg.as_bytes() {
-        putchar(b);
-    }
-    const SEP: &[u8] = b"=";
-    for &b in SEP {
-        putchar(b);
-    }
-    // 打印数字
-    let mut n = num;
-    let mut digits = [0u8; 10];
-    let mut len = 0;
-    if n == 0 {
-        digits[0] = b'0';
-        len = 1;
+/// 将被唤醒的任务加入运行队列 (try_to_wake_up 的 ttwu_queue)
+///
+/// 调用者必须先把任务状态设置为 Running，且不能持有任何运行队列的锁。
+/// 如果任务仍在队列中（尚未被 pick_next_task 移出）或仍在 CPU 上，留在原 CPU；
+/// 已离开 CPU 的任务按 select_task_rq_fair / select_task_rq_rt 选择目标 CPU，
+/// 先移出原运行队列再加入目标运行队列，两把锁不会同时持有。位于窃取队列中的任务
+/// 不属于任何运行队列，由窃取者负责入队。
+///
+/// 需要抢占时（check_preempt_curr），目标是本 CPU 则设置 need_resched，
+/// 否则向目标 CPU 发送重新调度 IPI
+pub fn activate_task(task: *mut Task, wake_flags: u32) {
+    if task.is_null() {
+        return;
+    }
+    unsafe {
+        let prev_cpu = (*task).cpu();
+        let rq = match cpu_rq(prev_cpu) {
+            Some(rq) => rq,
+            None => return,
+        };
+        let this_cpu = crate::arch::cpu_id() as usize;
+
+        let fair = fair_policy((*task).policy());
+        let mut target = prev_cpu;
+        let mut preempt = false;
+        {
+            let mut rq_inner = rq.lock();
+            if (*task).state() != TaskState::Running {
+                return;
+            }
+            let queued = if fair { (*task).se.on_rq } else { (*task).on_rq };
+            let migratable = !queued
+                && !(*task).se.on_cpu.load(Ordering::Acquire)
+                && rq_inner.current != task;
+            if migratable {
+                target = if fair {
+                    select_task_rq_fair(&*task, prev_cpu, this_cpu, wake_flags)
+                } else {
+                    select_task_rq_rt(&*task, prev_cpu)
+                };
+                target = select_fallback_rq(&*task, target);
+            }
+            if target == prev_cpu {
+                rq_inner.enqueue_class(task);
+                preempt = check_preempt_curr(&rq_inner, task);
+            } else {
+                // 迁移途中不属于任何运行队列
+                if fair {
+                    rq_inner.cfs.migrate_out(task);
+                }
+                (*task).set_cpu(CPU_NONE);
+            }
+        }
+
+        stats::ttwu_stat(this_cpu, target);
+
+        if target != prev_cpu {
+            crate::tracepoint!(SCHED_MIGRATE, "pid={} from={} to={}", (*task).pid(), prev_cpu, target);
+            // select_task_rq_* 只返回有运行队列的 CPU
+            if let Some(target_rq) = cpu_rq(target) {
+                let mut target_inner = target_rq.lock();
+                if fair {
+                    target_inner.cfs.migrate_in(task);
+                }
+                target_inner.attach_task(task);
+                preempt = check_preempt_curr(&target_inner, task);
+            }
+        }
+
+        if !preempt {
+            return;
+        }
+        if target == this_cpu {
+            set_need_resched();
+        } else {
+            resched_cpu(target);
+        }
+    }
+}
+
+/// 修改任务的调度策略和实时优先级 (sched_setscheduler)
+///
+/// 实时策略的 sched_priority 为 1-99（数值越大优先级越高），其他策略必须为 0；
+/// 不支持 SCHED_DEADLINE。优先级继承的提升保留到解锁时由 rt_mutex_setprio 撤销。
+///
+/// 任务在运行队列中时先移出，再按新的调度类加入，正在运行的任务换入 CFS 时
+/// 重新成为 cfs_rq::curr；之后通知任务所在的 CPU 重新调度：优先级降低的任务
+/// 可能要让出 CPU，升高的任务可能要抢占当前任务
+///
+/// # 返回
+/// 参数无效返回 Err(-EINVAL)，任务不存在返回 Err(-ESRCH)
+pub fn sched_setscheduler(task: *mut Task, policy: SchedPolicy, sched_priority: i32) -> Result<(), i32> {
+    if task.is_null() {
+        return Err(errno::Errno::NoSuchProcess.as_neg_i32());
+    }
+    let valid = if policy.is_rt() {
+        (1..MAX_RT_PRIO).contains(&sched_priority)
     } else {
-        while n > 0 {
-            digits[len] = b'0' + (n % 10) as u8;
-            n /= 10;
-            len += 1;
+        policy != SchedPolicy::Deadline && sched_priority == 0
+    };
+    if !valid {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+
+    unsafe {
+        let normal_prio = if policy.is_rt() {
+            MAX_RT_PRIO - 1 - sched_priority
+        } else {
+            (*task).static_prio()
+        };
+        let prio = if (*task).prio() < (*task).normal_prio() {
+            (*task).prio().min(normal_prio)
+        } else {
+            normal_prio
+        };
+
+        let cpu = (*task).cpu();
+        let rq = match cpu_rq(cpu) {
+            Some(rq) => rq,
+            None => {
+                // 还没加入运行队列的任务，入队时按新策略选择调度类
+                (*task).set_sched_params(policy, normal_prio);
+                (*task).set_prio(prio);
+                return Ok(());
+            }
+        };
+
+        let queued = {
+            let mut rq_inner = rq.lock();
+            let queued = (*task).on_rq || (*task).se.on_rq || (*task).se.throttled;
+            let running = rq_inner.current == task;
+            if queued {
+                rq_inner.dequeue_class(task);
+            }
+            (*task).set_sched_params(policy, normal_prio);
+            (*task).set_prio(prio);
+            if queued && (*task).state() == TaskState::Running {
+                rq_inner.enqueue_class(task);
+                if running && fair_policy(policy) {
+                    rq_inner.cfs.set_curr(task);
+                }
+            }
+            queued
+        };
+
+        if queued {
+            if cpu == crate::arch::cpu_id() as usize {
+                set_need_resched();
+            } else {
+                resched_cpu(cpu);
+            }
+        }
+    }
+    Ok(())
+}
+
+/// 设置任务允许运行的 CPU (sched_setaffinity / __set_cpus_allowed_ptr)
+///
+/// 掩码先与可用 CPU 求交，为空时返回 Err(-EINVAL)。任务当前所在的 CPU 不再允许时：
+/// - 在队列中等待的任务立即移到允许的 CPU
+/// - 正在运行的任务通知它的 CPU 重新调度，切换走后由 finish_task_migration 迁移
+/// - 睡眠的任务在唤醒时由 select_task_rq_* 选择允许的 CPU
+pub fn sched_setaffinity(task: *mut Task, mask: usize) -> Result<(), i32> {
+    if task.is_null() {
+        return Err(errno::Errno::NoSuchProcess.as_neg_i32());
+    }
+    let mask = mask & cpu_active_mask();
+    if mask == 0 {
+        return Err(errno::Errno::InvalidArgument.as_neg_i32());
+    }
+
+    unsafe {
+        (*task).set_cpus_allowed(mask);
+        let cpu = (*task).cpu();
+        if (*task).cpu_allowed(cpu) {
+            return Ok(());
+        }
+        // 新建或迁移途中的任务在入队或窃取时检查亲和性
+        let rq = match cpu_rq(cpu) {
+            Some(rq) => rq,
+            None => return Ok(()),
+        };
+
+        let mut running = false;
+        let mut moved = false;
+        {
+            let mut rq_inner = rq.lock();
+            if (*task).cpu() != cpu {
+                return Ok(());
+            }
+            if rq_inner.current == task || (*task).se.on_cpu.load(Ordering::Acquire) {
+                // 上下文可能还没保存完，下次从本 CPU 切换走时再迁移
+                running = true;
+            } else if (*task).state() != TaskState::Running {
+                // 睡眠的实时任务可能还在优先级链表中，唤醒时才能选择新的 CPU
+                rq_inner.active.dequeue(task);
+            } else if (*task).on_rq || (*task).se.on_rq {
+                rq_inner.dequeue_class(task);
+                rq_inner.cfs.migrate_out(task);
+                (*task).set_cpu(CPU_NONE);
+                moved = true;
+            }
+        }
+
+        if moved {
+            attach_remote(task, select_fallback_rq(&*task, cpu));
+        } else if running {
+            if cpu == crate::arch::cpu_id() as usize {
+                set_need_resched();
+            } else {
+                resched_cpu(cpu);
+            }
         }
     }
-    for i in (0..len).rev() {
-        putchar(digits[i]);
+    Ok(())
+}
+
+/// 优先级继承改变任务的动态优先级 (rt_mutex_setprio)
+///
+/// 实时任务换到新优先级的链表；调度类仍由策略决定，CFS 任务只记录
+/// 提升后的优先级
+pub fn rt_mutex_setprio(task: *mut Task, prio: i32) {
+    if task.is_null() {
+        return;
     }
-    const SUFFIX: &[u8] = b"]\n";
-    for &b in SUFFIX {
-        putchar(b);
+    unsafe {
+        if (*task).prio() == prio {
+            return;
+        }
+        let rq = match cpu_rq((*task).cpu()) {
+            Some(rq) => rq,
+            None => {
+                (*task).set_prio(prio);
+                return;
+            }
+        };
+        let mut rq_inner = rq.lock();
+        if !fair_policy((*task).policy()) && (*task).on_rq {
+            rq_inner.active.dequeue(task);
+            (*task).set_prio(prio);
+            rq_inner.active.enqueue(task);
+        } else {
+            (*task).set_prio(prio);
+        }
     }
 }
 
+pub fn yield_cpu() {
+    stats::schedstat_yield(crate::arch::cpu_id() as usize);
+    schedule();
+}
+
 pub fn current() -> Option<&'static mut Task> {
     if let Some(rq) = this_cpu_rq() {
         let rq_inner = rq.lock();
@@ -618,20 +1918,44 @@ pub fn get_current_ppid() -> u32 {
     }
 }
 
+/// 按 PID 查找任务，找不到返回 null
 pub unsafe fn find_task_by_pid(pid: Pid) -> *mut Task {
-    // 遍历所有 CPU 的运行队列
-    for cpu_id in 0..MAX_CPUS {
-        if let Some(rq) = cpu_rq(cpu_id) {
-            let rq_inner = rq.lock();
-            for i in 0..rq_inner.nr_running {
-                let task = rq_inner.tasks[i];
-                if !task.is_null() && (*task).pid() == pid {
-                    return task;
-                }
-            }
+    TASK_TABLE.lock().find(pid)
+}
+
+/// 任务表中的任务数 (nr_threads)
+pub fn nr_threads() -> usize {
+    TASK_TABLE.lock().nr_tasks
+}
+
+/// 启动以来创建的任务数 (total_forks)
+pub fn total_forks() -> u64 {
+    TASK_TABLE.lock().total_forks
+}
+
+/// 在持有任务表锁时访问 PID 对应的任务，任务不存在时返回 None
+///
+/// f 期间任务不会被释放；f 不能再获取任务表锁或睡眠
+pub fn with_task<R>(pid: Pid, f: impl FnOnce(&Task) -> R) -> Option<R> {
+    let table = TASK_TABLE.lock();
+    let task = table.find(pid);
+    if task.is_null() {
+        None
+    } else {
+        Some(f(unsafe { &*task }))
+    }
+}
+
+/// 依次访问任务表中的每个任务 (for_each_process_thread)
+///
+/// f 在持有任务表锁时调用，不能再获取任务表锁或睡眠
+pub fn for_each_task(mut f: impl FnMut(*mut Task)) {
+    let table = TASK_TABLE.lock();
+    for &task in table.tasks.iter() {
+        if !task.is_null() {
+            f(task);
         }
     }
-    core::ptr::null_mut()
 }
 
 pub fn get_current_fdtable() -> Option<&'static FdTable> {
@@ -653,7 +1977,10 @@ pub fn get_current_fdtable() -> Option<&'static FdTable> {
 }
 
 pub fn init_std_fds() {
-    use crate::fs::char_dev::{CharDev, CharDevType};
+    use crate::fs::char_dev::{CharDev, CharDevType, UART_OPS};
+
+    // UART 字符设备（使用 static，文件的私有数据在返回后仍然有效）
+    static UART_DEV: CharDev = CharDev::new(CharDevType::UartConsole, 0);
 
     if let Some(rq) = this_cpu_rq() {
         unsafe {
@@ -665,59 +1992,32 @@ pub fn init_std_fds() {
             }
 
             // Idle 任务没有 fdtable
-            let fdtable = match (*current).try_fdtable_mut() {
+            let fdtable = match (*current).try_fdtable() {
                 Some(ft) => ft,
                 None => return,
             };
 
-            // 创建 UART 字符设备
-            let uart_dev = CharDev::new(CharDevType::UartConsole, 0);
-
-            // 文件操作函数表
-            static UART_OPS: FileOps = FileOps {
-                read: Some(uart_file_read),
-                write: Some(uart_file_write),
-                lseek: None,
-                close: None,
-            };
-
             // 创建 stdin (fd=0)
             let stdin = Arc::new(File::new(FileFlags::new(FileFlags::O_RDONLY)));
             stdin.set_ops(&UART_OPS);
-            stdin.set_private_data(&uart_dev as *const CharDev as *mut u8);
+            stdin.set_private_data(&UART_DEV as *const CharDev as *mut u8);
 
             // 创建 stdout (fd=1)
             let stdout = Arc::new(File::new(FileFlags::new(FileFlags::O_WRONLY)));
             stdout.set_ops(&UART_OPS);
-            stdout.set_private_data(&uart_dev as *const CharDev as *mut u8);
+            stdout.set_private_data(&UART_DEV as *const CharDev as *mut u8);
 
             // 创建 stderr (fd=2)
             let stderr = Arc::new(File::new(FileFlags::new(FileFlags::O_WRONLY)));
             stderr.set_ops(&UART_OPS);
-            stderr.set_private_data(&uart_dev as *const CharDev as *mut u8);
+            stderr.set_private_data(&UART_DEV as *const CharDev as *mut u8);
 
             // 安装标准文件描述符
             let _ = fdtable.install_fd(0, stdin);
-            let _ = fdtable.install_fd(1, stdout);
-            let _ = fdtable.install_fd(2, stderr);
-        }
-    }
-}
-
-fn uart_file_read(file: &File, buf: &mut [u8]) -> isize {
-    if let Some(priv_data) = unsafe { *file.private_data.get() } {
-        let char_dev = unsafe { &*(priv_data as *const CharDev) };
-        unsafe { return char_dev.read(buf.as_mut_ptr(), buf.len()) };
-    }
-    -9  // EBADF
-}
-
-fn uart_file_write(file: &File, buf: &[u8]) -> isize {
-    if let Some(priv_data) = unsafe { *file.private_data.get() } {
-        let char_dev = unsafe { &*(priv_data as *const CharDev) };
-        unsafe { return char_dev.write(buf.as_ptr(), buf.len()) };
+            let _ = fdtable.install_fd(1, stdout);
+            let _ = fdtable.install_fd(2, stderr);
+        }
     }
-    -9  // EBADF
 }
 
 // ============================================================================
@@ -733,78 +2033,66 @@ pub fn send_signal(pid: Pid, sig: i32) -> Result<(), i32> {
     }
 
     unsafe {
-        // 遍历所有 CPU 的运行队列查找目标进程
-        for cpu_id in 0..MAX_CPUS {
-            if let Some(rq) = cpu_rq(cpu_id) {
-                let rq_inner = rq.lock();
-
-                for i in 0..MAX_TASKS {
-                    let task_ptr = rq_inner.tasks[i];
-                    if task_ptr.is_null() {
-                        continue;
-                    }
-
-                    let task = &*task_ptr;
-
-                    // 检查 PID 是否匹配
-                    if task.pid() != pid {
-                        continue;
-                    }
+        // 在全局任务表中查找目标进程
+        {
+            let table = TASK_TABLE.lock();
+            let task_ptr = table.find(pid);
+            if !task_ptr.is_null() {
+                let task = &*task_ptr;
+
+                // SIGKILL 和 SIGSTOP 不能被忽略
+                if sig == Signal::SIGKILL as i32 || sig == Signal::SIGSTOP as i32 {
+                    // 直接加入待处理信号
+                    task.pending.add(sig);
+                    // 唤醒睡眠的进程
+                    drop(table);  // 释放锁
+                    use crate::signal;
+                    signal::signal_wake_up(task_ptr);
+                    return Ok(());
+                }
 
-                    // SIGKILL 和 SIGSTOP 不能被忽略
-                    if sig == Signal::SIGKILL as i32 || sig == Signal::SIGSTOP as i32 {
-                        // 直接加入待处理信号
+                // Idle 任务没有信号处理
+                let signal_ref: &crate::signal::SignalStruct = match task.signal.as_deref() {
+                    Some(s) => s,
+                    None => {
+                        // 没有 signal 结构，直接加入待处理队列
                         task.pending.add(sig);
                         // 唤醒睡眠的进程
-                        drop(rq_inner);  // 释放锁
+                        drop(table);  // 释放锁
                         use crate::signal;
                         signal::signal_wake_up(task_ptr);
                         return Ok(());
                     }
+                };
+
+                // 检查信号是否被屏蔽
+                if signal_ref.is_masked(sig) {
+                    return Err(errno::Errno::TryAgain.as_neg_i32());
+                }
 
-                    // Idle 任务没有信号处理
-                    let signal_ref: &crate::signal::SignalStruct = match task.signal.as_ref() {
-                        Some(s) => s,
-                        None => {
-                            // 没有 signal 结构，直接加入待处理队列
+                // 检查信号处理动作
+                if let Some(action) = signal_ref.get_action(sig) {
+                    match action.action() {
+                        crate::signal::SigActionKind::Ignore => {
+                            return Ok(());  // 忽略信号
+                        }
+                        crate::signal::SigActionKind::Default => {
+                            // 默认处理：加入待处理队列
                             task.pending.add(sig);
                             // 唤醒睡眠的进程
-                            drop(rq_inner);  // 释放锁
+                            drop(table);  // 释放锁
                             use crate::signal;
                             signal::signal_wake_up(task_ptr);
                             return Ok(());
                         }
-                    };
-
-                    // 检查信号是否被屏蔽
-                    if signal_ref.is_masked(sig) {
-                        return Err(errno::Errno::TryAgain.as_neg_i32());
-                    }
-
-                    // 检查信号处理动作
-                    if let Some(action) = signal_ref.get_action(sig) {
-                        match action.action() {
-                            crate::signal::SigActionKind::Ignore => {
-                                return Ok(());  // 忽略信号
-                            }
-                            crate::signal::SigActionKind::Default => {
-                                // 默认处理：加入待处理队列
-                                task.pending.add(sig);
-                                // 唤醒睡眠的进程
-                                drop(rq_inner);  // 释放锁
-                                use crate::signal;
-                                signal::signal_wake_up(task_ptr);
-                                return Ok(());
-                            }
-                            crate::signal::SigActionKind::Handler => {
-                                // 用户自定义处理：加入待处理队列
-                                task.pending.add(sig);
-                                // 唤醒睡眠的进程
-                                drop(rq_inner);  // 释放锁
-                                use crate::signal;
-                                signal::signal_wake_up(task_ptr);
-                                return Ok(());
-                            }
+                        crate::signal::SigActionKind::Handler => {
+                            // 用户自定义处理：加入待处理队列
+                            task.pending.add(sig);
+                            // 唤醒睡眠的进程
+                            drop(table);  // 释放锁
+                            use crate::signal;
+                            signal::signal_wake_up(task_ptr);
+                            return Ok(());
                         }
                     }
                 }
@@ -832,10 +2120,15 @@ pub fn handle_pending_signals() {
                 return;
             }
 
+            // 快速路径：没有未屏蔽的待处理信号
+            if !(*current).pending.sigpending() {
+                return;
+            }
+
             // 获取第一个待处理信号
             while let Some(sig) = (*current).pending.first() {
                 // 获取信号处理动作
-                let signal_ref: &crate::signal::SignalStruct = match (*current).signal.as_ref() {
+                let signal_ref: &crate::signal::SignalStruct = match (*current).signal.as_deref() {
                     Some(s) => s,
                     None => {
                         // 没有 signal 结构，使用默认处理
@@ -902,9 +2195,54 @@ pub fn check_and_handle_signals() {
 // 进程退出和等待
 // ============================================================================
 
+/// 正常退出的等待状态 (sys_exit 中的 (error_code & 0xff) << 8)
+///
+/// 退出码在第 8 到 15 位 (WEXITSTATUS)，低 7 位为 0 (WIFEXITED)
+#[inline]
+pub const fn exit_status(code: i32) -> i32 {
+    (code & 0xff) << 8
+}
+
+/// 被信号杀死的等待状态：低 7 位是信号编号 (WTERMSIG)
+#[inline]
+pub const fn kill_status(sig: i32) -> i32 {
+    sig & 0x7f
+}
+
+/// 等待状态对应的 waitid 结果 (wait_task_zombie)
+///
+/// # 返回
+/// (si_code, si_status)：正常退出为 (CLD_EXITED, 退出码)，被信号杀死为 (CLD_KILLED, 信号编号)
+pub fn wait_status_to_cld(status: i32) -> (i32, i32) {
+    use crate::signal::si_code;
+    if status & 0x7f != 0 {
+        (si_code::CLD_KILLED, status & 0x7f)
+    } else {
+        (si_code::CLD_EXITED, (status >> 8) & 0xff)
+    }
+}
+
+/// 结束当前任务 (do_exit)
+///
+/// # 参数
+/// - exit_code: 交给父进程的等待状态，由 exit_status 或 kill_status 编码，
+///   wait4 原样写入用户的 status
 pub fn do_exit(exit_code: i32) -> ! {
     use crate::signal::Signal;
 
+    // 释放 robust futex、唤醒 clear_child_tid 的等待者，需要在获取运行队列锁之前
+    if let Some(task) = current() {
+        crate::process::futex::futex_exit(task);
+        crate::perf_event::perf_event_exit_task(task);
+        // exit_mm: 不再使用共享的地址空间，最后一个使用者归还映射的页；唤醒 vfork 的父进程
+        if let Some(mm) = task.address_space() {
+            mm.mmput();
+        }
+        crate::process::fork::complete_vfork_done(task);
+        // exit_files: 在进程上下文关闭文件，Task 的最终释放可能发生在中断上下文
+        task.set_fdtable(None);
+    }
+
     if let Some(rq) = this_cpu_rq() {
         unsafe {
             let rq_inner = rq.lock();
@@ -926,12 +2264,31 @@ pub fn do_exit(exit_code: i32) -> ! {
             // 设置进程状态为 Zombie
             (*current).set_state(TaskState::Zombie);
 
-            // 从运行队列移除
+            // 从可运行队列移除（保留在任务表中等待父进程回收）
             drop(rq_inner);  // 释放锁后再调用 dequeue_task
             dequeue_task(&*current);
 
-            // 向父进程发送 SIGCHLD 信号并唤醒父进程
-            if parent_pid != 0 {
+            // 子进程交给 init，自己挂到父进程的僵尸链表；
+            // 线程组中的非主线程不通知父进程，退出时自行回收 (release_task)
+            let (reaper, released) = {
+                let mut table = TASK_TABLE.lock();
+                let reaper = table.exit_notify(current);
+                let released = (*current).is_thread();
+                if released {
+                    table.remove(current);
+                }
+                (reaper, released)
+            };
+            if !reaper.is_null() {
+                wake_up_process(reaper);
+            }
+            if released {
+                // 只释放任务表的引用，切换走之前 Task 仍然有效
+                put_task_struct(current);
+            }
+
+            if !(*current).is_thread() && parent_pid != 0 {
+                // 向父进程发送 SIGCHLD 信号并唤醒父进程
                 let _ = send_signal(parent_pid, Signal::SIGCHLD as i32);
 
                 // 唤醒父进程（如果父进程在 wait4 中阻塞等待）
@@ -959,402 +2316,417 @@ pub fn do_exit(exit_code: i32) -> ! {
     }
 }
 
-pub fn do_wait(pid: i32, status_ptr: *mut i32) -> Result<Pid, i32> {
-    // Debug: entering do_wait
-    unsafe {
-        crate::console::putchar(b'D');
-        crate::console::putchar(b'W');
-        crate::console::putchar(b'1');
-        crate::console::putchar(b'\n');
-    }
+/// 结束当前任务所在的整个线程组 (do_group_exit)
+///
+/// 第一个发起组退出的线程记下组退出码，并向组内其他线程发送 SIGKILL；
+/// 它们在返回用户模式处理 SIGKILL 时以组退出码退出，线程组组长交给父进程的
+/// 也是组退出码。组内已有线程发起过组退出时沿用先记下的退出码
+///
+/// # 参数
+/// - exit_code: 组退出的等待状态，由 exit_status 编码
+pub fn do_group_exit(exit_code: i32) -> ! {
+    use crate::signal::Signal;
 
-    unsafe {
-        let current = if let Some(rq) = this_cpu_rq() {
-            rq.lock().current
-        } else {
-            // 没有 runqueue，说明未初始化，直接返回 ECHILD
-            unsafe {
-                crate::console::putchar(b'D');
-                crate::console::putchar(b'W');
-                crate::console::putchar(b'X');
-                crate::console::putchar(b'\n');
+    let mut exit_code = exit_code;
+    if let Some(task) = current() {
+        let tgid = task.tgid();
+        let me = task as *const Task;
+        let first = match task.signal.as_ref() {
+            Some(signal) => {
+                let (code, first) = signal.start_group_exit(tgid, exit_code);
+                exit_code = code;
+                first
             }
-            return Err(errno::Errno::NoChild.as_neg_i32());
+            None => true,
         };
-
-        if current.is_null() {
-            // current 为 null（可能从非进程上下文调用），返回 ECHILD
-            return Err(errno::Errno::NoChild.as_neg_i32());
+        if first {
+            // 在任务表锁外发送，send_signal 会再次获取任务表锁 (zap_other_threads)
+            let mut threads: Vec<Pid> = Vec::new();
+            for_each_task(|t| unsafe {
+                if t as *const Task != me && (*t).tgid() == tgid && (*t).state() != TaskState::Zombie {
+                    threads.push((*t).pid());
+                }
+            });
+            for tid in threads {
+                let _ = send_signal(tid, Signal::SIGKILL as i32);
+            }
         }
+    }
+    do_exit(exit_code)
+}
+
+/// 等待子进程退出 (do_wait)
+///
+/// 在任务表的僵尸链表中查找，不扫描整个任务表
+///
+/// # 参数
+/// - pid: > 0 时等待该子进程，其他值等待任意子进程
+/// - nohang: 没有已退出的子进程时返回 EAGAIN，不睡眠 (WNOHANG)
+/// - reap: 是否回收子进程，为 false 时保留僵尸供再次等待 (WNOWAIT)
+///
+/// # 返回
+/// 已退出子进程的 PID 和等待状态；没有子进程返回 ECHILD，被信号打断返回 EINTR
+pub fn do_wait_child(pid: i32, nohang: bool, reap: bool) -> Result<(Pid, i32), i32> {
+    let current = match current() {
+        Some(task) => task as *mut Task,
+        // 非进程上下文没有子进程
+        None => return Err(errno::Errno::NoChild.as_neg_i32()),
+    };
 
+    unsafe {
         let current_pid = (*current).pid();
 
-        // Debug: show current PID
-        unsafe {
-            crate::console::putchar(b'D');
-            crate::console::putchar(b'W');
-            crate::console::putchar(b'P');
-            crate::console::putchar(b'\n');
-        }
+        crate::tracepoint!(SCHED_WAIT, "wait4 pid={} by pid={}", pid, current_pid);
 
-        // 如果当前是 idle task (PID 0)，说明没有真正的进程在运行
-        // 返回 ECHILD，因为 idle task 没有子进程
+        // idle task (PID 0) 没有子进程
         if current_pid == 0 {
             return Err(errno::Errno::NoChild.as_neg_i32());
         }
 
-        // 循环等待子进程退出
         loop {
-            let mut found_child = false;
-
-            // Debug: scanning for children
-            unsafe {
-                crate::console::putchar(b'D');
-                crate::console::putchar(b'W');
-                crate::console::putchar(b'S');
-                crate::console::putchar(b'\n');
+            let zombie = TASK_TABLE.lock().wait_zombie(current, pid, reap)?;
+            if let Some((child_pid, exit_code, task)) = zombie {
+                crate::tracepoint!(SCHED_WAIT, "reap pid={} by pid={}", child_pid, current_pid);
+                // 释放任务表的引用，在锁外析构 (release_task)
+                put_task_struct(task);
+                return Ok((child_pid, exit_code));
             }
 
-            // 遍历所有 CPU 的运行队列查找僵尸子进程
-            for cpu_id in 0..MAX_CPUS {
-                if let Some(rq) = cpu_rq(cpu_id) {
-                    let mut rq_inner = rq.lock();
-
-                    for i in 0..MAX_TASKS {
-                        let task_ptr = rq_inner.tasks[i];
-                        if task_ptr.is_null() {
-                            continue;
-                        }
-
-                        let task = &*task_ptr;
-                        let task_pid = task.pid();
-                        let task_ppid = task.ppid();
-
-                        // Debug: show task info with slot, pid, ppid
-                        unsafe {
-                            crate::console::putchar(b'T');
-                            crate::console::putchar(b'0' + (cpu_id as u8));  // CPU
-                            crate::console::putchar(b'S');
-                            crate::console::putchar(b'0' + (i as u8));  // slot
-                            crate::console::putchar(b'P');
-                            crate::console::putchar(b'0' + (task_pid as u8));  // pid
-                            crate::console::putchar(b'Q');
-                            crate::console::putchar(b'0' + (task_ppid as u8));  // ppid
-                            crate::console::putchar(b'\n');
-                        }
-
-                        // 检查是否是子进程
-                        if task_ppid != current_pid {
-                            continue;
-                        }
-
-                        // Debug: found child
-                        unsafe {
-                            crate::console::putchar(b'D');
-                            crate::console::putchar(b'W');
-                            crate::console::putchar(b'F');
-                            crate::console::putchar(b'\n');
-                        }
-
-                        found_child = true;
-
-                        // 检查是否是指定的 PID (如果指定了)
-                        if pid > 0 && task.pid() != pid as u32 {
-                            continue;
-                        }
-
-                        // 检查是否是 Zombie 状态
-                        if task.state() == TaskState::Zombie {
-                            // Debug: found zombie
-                            unsafe {
-                                crate::console::putchar(b'D');
-                                crate::console::putchar(b'W');
-                                crate::console::putchar(b'Z');
-                                crate::console::putchar(b'\n');
-                            }
-                            let child_pid = task.pid();
-                            let exit_code = task.exit_code();
-
-                            // 写入退出状态
-                            if !status_ptr.is_null() {
-                                *status_ptr = exit_code;
-                            }
-
-                            // 从运行队列移除
-                            rq_inner.tasks[i] = core::ptr::null_mut();
-                            rq_inner.nr_running -= 1;
-
-                            // 回收 PID
-                            // TODO: 实现 pid_free()
-
-                            return Ok(child_pid);
-                        }
-                    }
-                }
+            // 有子进程但还没有退出
+            if nohang {
+                return Err(errno::Errno::TryAgain.as_neg_i32());
             }
 
-            // 有子进程但还没有退出的
-            if found_child {
-                // Debug: going to sleep
-                unsafe {
-                    crate::console::putchar(b'D');
-                    crate::console::putchar(b'W');
-                    crate::console::putchar(b'L');
-                    crate::console::putchar(b'\n');
-                }
-
-                // 真正的阻塞等待
-
-                // 使用 Task::sleep() 进入可中断睡眠状态
-                // 这会设置当前进程状态为 Interruptible 并触发调度
-                crate::process::Task::sleep(crate::process::task::TaskState::Interruptible);
+            crate::tracepoint!(SCHED_WAIT, "sleep pid={}", current_pid);
 
-                // Debug: woke up
-                unsafe {
-                    crate::console::putchar(b'D');
-                    crate::console::putchar(b'W');
-                    crate::console::putchar(b'W');
-                    crate::console::putchar(b'\n');
-                }
+            // 进入可中断睡眠，子进程退出时由 do_exit 唤醒
+            crate::process::Task::sleep(crate::process::task::TaskState::Interruptible);
 
-                // 被唤醒后，检查是否有信号到达
-                use crate::signal;
-                if signal::signal_pending() {
-                    return Err(errno::Errno::InterruptedSystemCall.as_neg_i32());  // EINTR
-                }
+            crate::tracepoint!(SCHED_WAIT, "wake pid={}", current_pid);
 
-                // 继续循环检查是否有子进程退出
-            } else {
-                // Debug: no child
-                unsafe {
-                    crate::console::putchar(b'D');
-                    crate::console::putchar(b'W');
-                    crate::console::putchar(b'N');
-                    crate::console::putchar(b'\n');
-                }
-                // 没有子进程
-                // 返回 ECHILD (-10)
-                return Err(errno::Errno::NoChild.as_neg_i32());
+            // 被唤醒后，检查是否有信号到达
+            if crate::signal::signal_pending() {
+                return Err(errno::Errno::InterruptedSystemCall.as_neg_i32());  // EINTR
             }
         }
     }
 }
 
-pub fn do_wait_nonblock(pid: i32, status_ptr: *mut i32) -> Result<Pid, i32> {
-    unsafe {
-        let current = if let Some(rq) = this_cpu_rq() {
-            rq.lock().current
-        } else {
-            // 没有 runqueue，说明未初始化，直接返回 ECHILD
-            return Err(errno::Errno::NoChild.as_neg_i32());
-        };
-
-        if current.is_null() {
-            // current 为 null（可能从非进程上下文调用），返回 ECHILD
-            return Err(errno::Errno::NoChild.as_neg_i32());
-        }
-
-        let current_pid = (*current).pid();
+/// 阻塞等待子进程退出 (wait4)
+///
+/// status_ptr 非空时写入等待状态：WIFEXITED / WEXITSTATUS 与 WIFSIGNALED / WTERMSIG
+/// 按 Linux 的编码解析
+pub fn do_wait(pid: i32, status_ptr: *mut i32) -> Result<Pid, i32> {
+    let (child_pid, status) = do_wait_child(pid, false, true)?;
+    if !status_ptr.is_null() {
+        unsafe { *status_ptr = status };
+    }
+    Ok(child_pid)
+}
 
-        // 如果当前是 idle task (PID 0)，说明没有真正的进程在运行
-        // 返回 ECHILD，因为 idle task 没有子进程
-        if current_pid == 0 {
-            return Err(errno::Errno::NoChild.as_neg_i32());
-        }
+/// 非阻塞等待 (WNOHANG)
+///
+/// 有子进程但都还没有退出时返回 EAGAIN，sys_wait4 会将其转换为 0
+pub fn do_wait_nonblock(pid: i32, status_ptr: *mut i32) -> Result<Pid, i32> {
+    let (child_pid, status) = do_wait_child(pid, true, true)?;
+    if !status_ptr.is_null() {
+        unsafe { *status_ptr = status };
+    }
+    Ok(child_pid)
+}
 
-        let mut found_child = false;
+// ============================================================================
+// 负载均衡机制 (Load Balancing)
+// ============================================================================
 
-        // 遍历所有 CPU 的运行队列查找僵尸子进程
-        for cpu_id in 0..MAX_CPUS {
-            if let Some(rq) = cpu_rq(cpu_id) {
-                let mut rq_inner = rq.lock();
+/// 负载不平衡阈值（至少差 2 个任务才进行迁移）
+const LOAD_IMBALANCE_THRESH: usize = 2;
 
-                for i in 0..MAX_TASKS {
-                    let task_ptr = rq_inner.tasks[i];
-                    if task_ptr.is_null() {
-                        continue;
-                    }
+/// 周期性负载均衡间隔（时钟 tick 数）
+const BALANCE_INTERVAL_TICKS: u64 = 4;
 
-                    let task = &*task_ptr;
+/// 位于窃取队列中的任务的 CPU 编号：不属于任何运行队列
+const CPU_NONE: usize = MAX_CPUS;
 
-                    // 检查是否是子进程
-                    if task.ppid() != current_pid {
-                        continue;
-                    }
+const DEQUE_INIT: StealDeque = StealDeque::new();
 
-                    found_child = true;
+/// 每 CPU 窃取队列
+///
+/// 存放本 CPU 发布给其他 CPU 的可运行任务（新 fork 的任务或
+/// 周期性均衡时移出的多余任务）。其他 CPU 窃取时只做 CAS，
+/// 不获取本 CPU 的运行队列锁。
+static STEAL_DEQUES: [StealDeque; MAX_CPUS] = [DEQUE_INIT; MAX_CPUS];
+
+crate::percpu! {
+    /// 每 CPU 负载（可运行任务数），由持有运行队列锁的一方更新
+    static RQ_NR_RUNNING: AtomicUsize = AtomicUsize::new(0);
+
+    /// 每 CPU 因组带宽用完而节流的任务数
+    static RQ_NR_THROTTLED: AtomicUsize = AtomicUsize::new(0);
+
+    /// 在本 CPU 上进入不可中断睡眠、尚未唤醒的任务数 (rq->nr_uninterruptible)
+    ///
+    /// 在一个 CPU 上睡眠、在另一个 CPU 上唤醒时两边分别加减，单个 CPU 的值可能为负
+    static RQ_NR_UNINTERRUPTIBLE: AtomicIsize = AtomicIsize::new(0);
+}
 
-                    // 检查是否是指定的 PID (如果指定了)
-                    if pid > 0 && task.pid() != pid as u32 {
-                        continue;
-                    }
+/// 所有 CPU 上的可运行任务数，包括正在运行的任务 (nr_running)
+pub fn nr_running() -> usize {
+    (0..MAX_CPUS).map(|cpu| RQ_NR_RUNNING.per_cpu(cpu).load(Ordering::Relaxed)).sum()
+}
 
-                    // 检查是否是 Zombie 状态
-                    if task.state() == TaskState::Zombie {
-                        let child_pid = task.pid();
-                        let exit_code = task.exit_code();
+/// 不可中断睡眠中的任务数 (nr_uninterruptible)
+pub fn nr_uninterruptible() -> usize {
+    let sum: isize = (0..MAX_CPUS).map(|cpu| RQ_NR_UNINTERRUPTIBLE.per_cpu(cpu).load(Ordering::Relaxed)).sum();
+    sum.max(0) as usize
+}
 
-                        // 写入退出状态
-                        if !status_ptr.is_null() {
-                            *status_ptr = exit_code;
-                        }
+/// 一个 CPU 上的可运行任务数 (cpu_rq(cpu)->nr_running)
+pub fn nr_running_cpu(cpu: usize) -> usize {
+    if cpu < MAX_CPUS { RQ_NR_RUNNING.per_cpu(cpu).load(Ordering::Relaxed) } else { 0 }
+}
 
-                        // 从运行队列移除
-                        rq_inner.tasks[i] = core::ptr::null_mut();
-                        rq_inner.nr_running -= 1;
+/// 正在 WFI 中空闲等待的 CPU 位图
+static IDLE_CPU_MASK: AtomicUsize = AtomicUsize::new(0);
 
-                        // 回收 PID
-                        // TODO: 实现 pid_free()
+/// 查找一个 allowed 中空闲的其他 CPU
+fn find_idle_cpu(this_cpu: usize, allowed: usize) -> Option<usize> {
+    let mask = IDLE_CPU_MASK.load(Ordering::Acquire) & allowed & !(1usize << this_cpu);
+    if mask == 0 {
+        None
+    } else {
+        Some(mask.trailing_zeros() as usize)
+    }
+}
 
-                        return Ok(child_pid);
-                    }
-                }
-            }
+/// 负载最低的其他 CPU 及其负载
+fn find_idlest_cpu(this_cpu: usize) -> Option<(usize, usize)> {
+    let mut idlest: Option<(usize, usize)> = None;
+    for cpu in 0..MAX_CPUS {
+        if cpu == this_cpu || cpu_rq(cpu).is_none() {
+            continue;
         }
-
-        // 有子进程但还没有退出的
-        if found_child {
-            // 返回 EAGAIN (-11)，sys_wait4 会将其转换为 0
-            Err(errno::Errno::TryAgain.as_neg_i32())
-        } else {
-            // 没有子进程
-            // 返回 ECHILD (-10)
-            Err(errno::Errno::NoChild.as_neg_i32())
+        let load = RQ_NR_RUNNING.per_cpu(cpu).load(Ordering::Relaxed);
+        if idlest.map_or(true, |(_, l)| load < l) {
+            idlest = Some((cpu, load));
         }
     }
+    idlest
 }
 
-// ============================================================================
-// 负载均衡机制 (Load Balancing)
-// ============================================================================
-
-fn rq_load(rq: &RunQueue) -> usize {
-    rq.nr_running
+/// 把任务发布到本 CPU 的窃取队列
+///
+/// 任务离开运行队列，vruntime 转为相对值，由窃取者（或本 CPU
+/// 下一次均衡时）重新加入运行队列。
+///
+/// # 返回
+/// 队列已满时返回 false，任务保持原状
+///
+/// # Safety
+/// 必须持有 rq 的锁；task 必须有效且不是 rq.current
+unsafe fn publish_task(rq: &mut RunQueue, task: *mut Task) -> bool {
+    rq.dequeue_class(task);
+    rq.cfs.migrate_out(task);
+    (*task).set_cpu(CPU_NONE);
+    if !STEAL_DEQUES[rq.cpu].push(task) {
+        rq.cfs.migrate_in(task);
+        rq.attach_task(task);
+        return false;
+    }
+    true
 }
 
-fn find_busiest_cpu(this_cpu: usize) -> Option<usize> {
-    let this_rq = cpu_rq(this_cpu)?;
-    let this_load = rq_load(&*this_rq.lock());
-
-    let mut busiest_cpu = None;
-    let mut max_load = this_load;
-
-    // 负载不平衡阈值（至少差 2 个任务才进行迁移）
-    const LOAD_IMBALANCE_THRESH: usize = 2;
+/// 把从窃取队列取出的任务加入运行队列
+///
+/// # Safety
+/// 必须持有 rq 的锁；task 必须来自窃取队列
+unsafe fn attach_stolen(rq: &mut RunQueue, task: *mut Task) {
+    rq.cfs.migrate_in(task);
+    rq.attach_task(task);
+}
 
-    for cpu in 0..MAX_CPUS {
-        if cpu == this_cpu {
-            continue;  // 跳过当前 CPU
-        }
+/// 把不属于任何运行队列的任务加入指定 CPU，并通知该 CPU 重新调度
+///
+/// 用于窃取到、或因亲和性离开原 CPU 而不能留在本 CPU 的任务
+///
+/// # Safety
+/// 不能持有任何运行队列的锁；task 必须有效、CPU 为 CPU_NONE 且 vruntime 为相对值
+unsafe fn attach_remote(task: *mut Task, cpu: usize) {
+    let rq = match cpu_rq(cpu) {
+        Some(rq) => rq,
+        None => return,
+    };
+    attach_stolen(&mut *rq.lock(), task);
+    if cpu == crate::arch::cpu_id() as usize {
+        set_need_resched();
+    } else {
+        resched_cpu(cpu);
+    }
+}
 
-        if let Some(rq) = cpu_rq(cpu) {
-            let load = rq_load(&*rq.lock());
+/// 调度器可以使用的 CPU 位图 (cpu_active_mask)
+pub fn cpu_active_mask() -> usize {
+    (0..MAX_CPUS)
+        .filter(|&cpu| cpu_rq(cpu).is_some())
+        .fold(0, |mask, cpu| mask | (1usize << cpu))
+}
 
-            // 只有当其他 CPU 负载明显更高时才进行迁移
-            if load > max_load + LOAD_IMBALANCE_THRESH {
-                max_load = load;
-                busiest_cpu = Some(cpu);
-            }
-        }
+/// 在任务允许的 CPU 中选择一个，优先 preferred (select_fallback_rq)
+///
+/// 允许的 CPU 都不可用时把亲和性恢复为全部 CPU (cpuset_cpus_allowed_fallback)
+pub fn select_fallback_rq(task: &Task, preferred: usize) -> usize {
+    let active = cpu_active_mask();
+    let allowed = task.cpus_allowed() & active;
+    if preferred < MAX_CPUS && allowed & (1usize << preferred) != 0 {
+        return preferred;
+    }
+    if allowed != 0 {
+        return allowed.trailing_zeros() as usize;
+    }
+    task.set_cpus_allowed(usize::MAX);
+    if preferred < MAX_CPUS && active & (1usize << preferred) != 0 {
+        preferred
+    } else {
+        active.trailing_zeros() as usize
     }
-
-    busiest_cpu
 }
 
-fn steal_task(src_rq: &mut RunQueue) -> Option<*mut Task> {
-    // 从队尾开始查找（最久未运行的任务）
-    for i in (0..src_rq.nr_running).rev() {
-        let task = src_rq.tasks[i];
+/// 空闲负载均衡 (idle_balance)
+///
+/// 本 CPU 没有可运行任务时调用：先取回本 CPU 尚未被窃取的任务，
+/// 再按负载从高到低从其他 CPU 的窃取队列中窃取。
+///
+/// 窃取只操作无锁队列，从不获取其他 CPU 的运行队列锁，
+/// 因此多个空闲 CPU 同时均衡时不会互相阻塞，也不会发生 ABBA 死锁。
+pub fn load_balance() {
+    let this_cpu = crate::arch::cpu_id() as u64 as usize;
+    let this_rq = match this_cpu_rq() {
+        Some(r) => r,
+        None => return,
+    };
 
-        if task.is_null() {
-            continue;
+    // 窃取到的任务不允许在本 CPU 上运行时，放回允许的 CPU（优先它原来的 CPU）
+    let mut bounced: Option<(*mut Task, usize)> = None;
+    {
+        let mut rq_inner = this_rq.lock();
+        if rq_inner.nr_running() > 0 {
+            return;
         }
 
-        let task_ref = unsafe { &*task };
-
-        // 不要窃取 idle 任务 (PID 0)
-        if task_ref.pid() == 0 {
-            continue;
-        }
+        unsafe {
+            // 本 CPU 的队列：所有者从底部取回（LIFO，缓存最热）
+            if let Some(task) = STEAL_DEQUES[this_cpu].pop() {
+                if (*task).cpu_allowed(this_cpu) {
+                    attach_stolen(&mut *rq_inner, task);
+                    return;
+                }
+                bounced = Some((task, this_cpu));
+            }
 
-        // 不要窃取当前正在运行的任务
-        if task == src_rq.current {
-            continue;
-        }
+            // 按负载从高到低尝试其他 CPU
+            let mut tried = 1usize << this_cpu;
+            while bounced.is_none() {
+                let mut victim = None;
+                let mut max_load = 0;
+                for cpu in 0..MAX_CPUS {
+                    if tried & (1usize << cpu) != 0 || STEAL_DEQUES[cpu].is_empty() {
+                        continue;
+                    }
+                    let load = RQ_NR_RUNNING.per_cpu(cpu).load(Ordering::Relaxed);
+                    if victim.is_none() || load > max_load {
+                        victim = Some(cpu);
+                        max_load = load;
+                    }
+                }
 
-        // 找到可迁移的任务
-        // 从源队列移除
-        src_rq.tasks[i] = core::ptr::null_mut();
-        src_rq.nr_running -= 1;
+                let cpu = match victim {
+                    Some(c) => c,
+                    None => return,
+                };
+                tried |= 1usize << cpu;
 
-        // 移动剩余任务填补空位
-        for j in i..src_rq.nr_running {
-            src_rq.tasks[j] = src_rq.tasks[j + 1];
+                if let Some(task) = STEAL_DEQUES[cpu].steal() {
+                    if (*task).cpu_allowed(this_cpu) {
+                        attach_stolen(&mut *rq_inner, task);
+                        return;
+                    }
+                    bounced = Some((task, cpu));
+                }
+            }
         }
-        src_rq.tasks[src_rq.nr_running] = core::ptr::null_mut();
-
-        return Some(task);
     }
 
-    None
+    if let Some((task, cpu)) = bounced {
+        unsafe { attach_remote(task, select_fallback_rq(&*task, cpu)) };
+    }
 }
 
-pub fn load_balance() {
-    unsafe {
-        let this_cpu = crate::arch::cpu_id() as u64 as usize;
-
-        // 获取当前 CPU 的运行队列
-        let this_rq = match this_cpu_rq() {
-            Some(r) => r,
-            None => return,
-        };
+/// 周期性负载均衡 (rebalance_domains)
+///
+/// 由 scheduler_tick 每 BALANCE_INTERVAL_TICKS 个 tick 调用一次：
+/// 1. 取回上一轮发布但没有被窃取的任务，避免任务在队列中饿死
+/// 2. 本 CPU 负载比最空闲的 CPU 高出阈值时，发布超出平均值的 CFS 任务
+///    并通过 IPI 通知最空闲的 CPU 来窃取
+fn rebalance(this_cpu: usize) {
+    let rq = match cpu_rq(this_cpu) {
+        Some(r) => r,
+        None => return,
+    };
 
-        let this_rq_inner = this_rq.lock();
-        let this_load = rq_load(&*this_rq_inner);
+    let mut kick = None;
+    let mut bounced = None;
+    {
+        let mut rq_inner = rq.lock();
 
-        // 只有当前 CPU 空闲或很空闲时才进行负载均衡
-        // 阈值：当前负载 <= 1（只有 idle 任务或只有一个用户任务）
-        if this_load > 1 {
-            return;  // 当前 CPU 有足够任务，不需要负载均衡
+        unsafe {
+            while let Some(task) = STEAL_DEQUES[this_cpu].pop() {
+                if !(*task).cpu_allowed(this_cpu) {
+                    // 发布后亲和性排除了本 CPU，锁外放到允许的 CPU
+                    bounced = Some(task);
+                    break;
+                }
+                attach_stolen(&mut *rq_inner, task);
+            }
         }
 
-        drop(this_rq_inner);  // 释放锁，避免死锁
-
-        // 查找最繁忙的 CPU
-        if let Some(busiest_cpu) = find_busiest_cpu(this_cpu) {
-            if let Some(busiest_rq) = cpu_rq(busiest_cpu) {
-                let mut busiest_rq_inner = busiest_rq.lock();
-
-                // 从繁忙 CPU 窃取任务
-                if let Some(task) = steal_task(&mut *busiest_rq_inner) {
-                    // 获取任务信息
-                    let _task_pid = (*task).pid();
-
-                    // 释放繁忙 CPU 的锁
-                    drop(busiest_rq_inner);
-
-                    // 重新获取当前 CPU 的锁
-                    let mut this_rq_inner = this_rq.lock();
-
-                    // 添加任务到当前 CPU 的运行队列
-                    enqueue_task_locked(&mut *this_rq_inner, task);
-
-                    // 更新任务的 CPU 亲和性（可选）
-                    // (*task).set_cpu(this_cpu);
+        let this_load = rq_inner.nr_running();
+        if let Some((idlest_cpu, idlest_load)) = find_idlest_cpu(this_cpu) {
+            if this_load >= idlest_load + LOAD_IMBALANCE_THRESH {
+                // 迁移一半的差值，使两边趋于平均
+                let nr_move = (this_load - idlest_load) / 2;
+                let mut moved = 0;
+                let now = sched_clock();
+                unsafe {
+                    while moved < nr_move {
+                        // 选择 vruntime 最大的任务（最晚运行，缓存最冷）
+                        let task = match rq_inner.cfs.last_queued() {
+                            Some(t) => t,
+                            None => break,
+                        };
+                        // 连最冷的任务缓存都还热时，迁移的代价高于不均衡；
+                        // 只能在本 CPU 上运行的任务不能发布 (can_migrate_task)
+                        if task_hot(&*task, now) || (*task).cpus_allowed() & !(1usize << this_cpu) == 0 {
+                            break;
+                        }
+                        if !publish_task(&mut *rq_inner, task) {
+                            break;
+                        }
+                        moved += 1;
+                    }
+                }
+                if moved > 0 {
+                    kick = Some(idlest_cpu);
                 }
             }
         }
     }
-}
 
-fn enqueue_task_locked(rq: &mut RunQueue, task: *mut Task) {
-    if rq.nr_running >= MAX_TASKS {
-        return;
+    if let Some(cpu) = kick {
+        resched_cpu(cpu);
+    }
+    if let Some(task) = bounced {
+        unsafe { attach_remote(task, select_fallback_rq(&*task, this_cpu)) };
     }
-
-    // 添加到队尾
-    rq.tasks[rq.nr_running] = task;
-    rq.nr_running += 1;
 }
 
 // ============================================================================
@@ -1364,7 +2736,7 @@ fn enqueue_task_locked(rq: &mut RunQueue, task: *mut Task) {
 /// CPU 空闲循环
 ///
 /// 当 CPU 没有任务可运行时调用此函数
-/// 会尝试负载均衡，如果没有任务则进入 WFI 休眠
+/// 会尝试负载均衡，如果没有任务则轮询后进入 WFI 或 HSM 挂起
 pub fn cpu_idle_loop() -> ! {
     use crate::arch;
 
@@ -1377,31 +2749,44 @@ pub fn cpu_idle_loop() -> ! {
         // 2. 检查是否只有 idle 任务
         if let Some(rq) = this_cpu_rq() {
             let rq_inner = rq.lock();
-            let current = rq_inner.current;
-            let nr_running = rq_inner.nr_running;
+            let idle_only = rq_inner.nr_running() == 0 && rq_inner.current == rq_inner.idle;
             drop(rq_inner);
 
-            // 如果只有 idle 任务（nr_running == 1 且 current 是 idle）
-            // 或者完全没有任务（nr_running == 0，不应该发生）
-            if nr_running == 1 && !current.is_null() {
+            if idle_only {
+                // 只有 idle 任务，尝试负载均衡
+                load_balance();
+
+                // 负载均衡后重新调度
                 unsafe {
-                    let pid = (*current).pid();
-                    if pid == 0 {
-                        // 只有 idle 任务，尝试负载均衡
-                        drop(rq);
-                        load_balance();
-
-                        // 负载均衡后重新调度
-                        schedule();
-                    }
+                    schedule();
                 }
             }
         }
 
-        // 3. 进入 WFI 休眠，等待中断唤醒
-        // 中断会设置 need_resched 标志，从而跳出 WFI
-        unsafe {
-            asm!("wfi", options(nomem, nostack));
+        // 3. 低于水位时在 CPU 0 上运行页回收 (kswapd) 并补满 OOM 预留页，连续分配失败后规整内存 (kcompactd)，
+        //    合并相同的匿名页 (ksmd) 并把填满的区域合并为大页 (khugepaged)，回写到期的脏页 (flusher)、提交日志 (kjournald2)
+        if arch::cpu_id() as usize == 0 {
+            crate::mm::vmscan::kswapd_run();
+            crate::mm::oom_kill::oom_reserve_refill();
+            crate::mm::compaction::kcompactd_run();
+            crate::mm::ksm::ksmd_run();
+            crate::mm::khugepaged::khugepaged_run();
+            crate::mm::writeback::wb_run();
+            crate::fs::jbd2::kjournald_run();
         }
+
+        // 每个空闲的 CPU 补充预清零页池，缺页时不必同步清零
+        crate::mm::prezero::prezero_run();
+
+        // 休眠前输出异步写入的日志
+        crate::printk::printk_tick();
+
+        // 4. 空闲：先轮询 need_resched，再 wfi 或经 SBI HSM 挂起，等待中断唤醒 (idle::do_idle)
+        // 休眠期间在 IDLE_CPU_MASK 中登记，新任务优先发布给空闲 CPU
+        let cpu_bit = 1usize << (arch::cpu_id() as u64 as usize);
+        // 非启动核睡眠期间停止 tick，只被定时器或 IPI 唤醒
+        IDLE_CPU_MASK.fetch_or(cpu_bit, Ordering::Release);
+        super::idle::do_idle();
+        IDLE_CPU_MASK.fetch_and(!cpu_bit, Ordering::Release);
     }
 }
@@ -0,0 +1,375 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 调度统计 (schedstats)
+//!
+//! 参考 Linux: kernel/sched/stats.c, kernel/sched/stats.h, kernel/sched/cputime.c
+//!
+//! - 任务：运行时间、在运行队列中等待的时间与上 CPU 次数 (sched_info)，
+//!   主动/被动切换次数 (nvcsw / nivcsw)，tick 采样的用户态/内核态时间
+//! - 每 CPU：schedule 调用、切到 idle、唤醒与 yield 次数、运行与等待时间 (/proc/schedstat)
+//! - 每 CPU 的 CPU 时间 (/proc/stat)：tick 采样用户态、nice、内核态与软中断；
+//!   空闲时间按 idle 任务实际占用 CPU 的时间计算，停止 tick 的空闲 CPU 也准确
+//!
+//! 每 CPU 的计数只由本 CPU 在持有运行队列锁或中断中更新，读者不加锁
+
+use core::sync::atomic::{AtomicU64, Ordering};
+
+use crate::config::MAX_CPUS;
+use crate::process::task::{Task, TaskState};
+use crate::sched::fair::MAX_RT_PRIO;
+
+/// /proc/schedstat 的格式版本 (SCHEDSTAT_VERSION)
+pub const SCHEDSTAT_VERSION: u32 = 15;
+
+/// nice 0 的静态优先级 (DEFAULT_PRIO)
+const DEFAULT_PRIO: i32 = MAX_RT_PRIO + 20;
+
+/// 任务的调度统计 (struct sched_info)
+pub struct SchedInfo {
+    /// 上 CPU 的次数 (pcount)
+    pub pcount: u64,
+    /// 在运行队列中等待的总时间 (ns) (run_delay)
+    pub run_delay: u64,
+    /// 在 CPU 上运行的总时间 (ns)，包括所有调度类
+    pub run_time: u64,
+    /// 最近一次上 CPU 的时间 (last_arrival)
+    pub last_arrival: u64,
+    /// 进入运行队列的时间，0 表示不在等待 (last_queued)
+    pub last_queued: u64,
+    /// 主动让出 CPU（睡眠）的次数 (nvcsw)
+    pub nvcsw: u64,
+    /// 被抢占或 yield 的次数 (nivcsw)
+    pub nivcsw: u64,
+    /// tick 采样的用户态与内核态时间，单位 jiffies (utime / stime)
+    pub utime: u64,
+    pub stime: u64,
+}
+
+impl SchedInfo {
+    pub const fn new() -> Self {
+        Self {
+            pcount: 0,
+            run_delay: 0,
+            run_time: 0,
+            last_arrival: 0,
+            last_queued: 0,
+            nvcsw: 0,
+            nivcsw: 0,
+            utime: 0,
+            stime: 0,
+        }
+    }
+}
+
+/// 每 CPU 的调度统计与 CPU 时间 (struct rq 的 schedstat 字段与 kernel_cpustat)
+pub struct RqStats {
+    /// yield 次数 (yld_count)
+    yld_count: AtomicU64,
+    /// 调用 __schedule 的次数 (sched_count)
+    sched_count: AtomicU64,
+    /// 选中 idle 的次数 (sched_goidle)
+    sched_goidle: AtomicU64,
+    /// 本 CPU 发起的唤醒，及其中目标是本 CPU 的次数 (ttwu_count / ttwu_local)
+    ttwu_count: AtomicU64,
+    ttwu_local: AtomicU64,
+    /// 任务在本 CPU 上运行的总时间 (ns) (rq_cpu_time)
+    rq_cpu_time: AtomicU64,
+    /// 任务在本 CPU 运行队列中等待的总时间 (ns) 与上 CPU 次数 (rq_sched_info)
+    run_delay: AtomicU64,
+    pcount: AtomicU64,
+    /// 上下文切换次数 (nr_switches)
+    nr_switches: AtomicU64,
+    /// idle 任务累计占用的时间 (ns)，以及当前这段空闲的开始时间，不在空闲时为 0
+    idle_time: AtomicU64,
+    idle_since: AtomicU64,
+    /// tick 采样的 CPU 时间，单位 jiffies (CPUTIME_USER / NICE / SYSTEM / SOFTIRQ)
+    user: AtomicU64,
+    nice: AtomicU64,
+    system: AtomicU64,
+    softirq: AtomicU64,
+}
+
+impl RqStats {
+    const fn new() -> Self {
+        Self {
+            yld_count: AtomicU64::new(0),
+            sched_count: AtomicU64::new(0),
+            sched_goidle: AtomicU64::new(0),
+            ttwu_count: AtomicU64::new(0),
+            ttwu_local: AtomicU64::new(0),
+            rq_cpu_time: AtomicU64::new(0),
+            run_delay: AtomicU64::new(0),
+            pcount: AtomicU64::new(0),
+            nr_switches: AtomicU64::new(0),
+            idle_time: AtomicU64::new(0),
+            idle_since: AtomicU64::new(0),
+            user: AtomicU64::new(0),
+            nice: AtomicU64::new(0),
+            system: AtomicU64::new(0),
+            softirq: AtomicU64::new(0),
+        }
+    }
+}
+
+crate::percpu! {
+    static RQ_STATS: RqStats = RqStats::new();
+}
+
+#[inline]
+fn inc(counter: &AtomicU64, delta: u64) {
+    counter.fetch_add(delta, Ordering::Relaxed);
+}
+
+#[inline]
+fn get(counter: &AtomicU64) -> u64 {
+    counter.load(Ordering::Relaxed)
+}
+
+/// 任务进入运行队列，开始等待 (sched_info_enqueue)
+///
+/// 已在等待的任务（迁移、换调度类）保留原来的开始时间
+#[inline]
+pub fn sched_info_queued(task: &mut Task, now: u64) {
+    if task.se.sched_info.last_queued == 0 {
+        task.se.sched_info.last_queued = now;
+    }
+}
+
+/// 记录一次 __schedule 调用 (schedstat_inc(rq->sched_count))
+#[inline]
+pub fn schedstat_schedule(cpu: usize) {
+    if cpu < MAX_CPUS {
+        inc(&RQ_STATS.per_cpu(cpu).sched_count, 1);
+    }
+}
+
+/// 记录一次选中 idle (schedstat_inc(rq->sched_goidle))
+#[inline]
+pub fn schedstat_goidle(cpu: usize) {
+    if cpu < MAX_CPUS {
+        inc(&RQ_STATS.per_cpu(cpu).sched_goidle, 1);
+    }
+}
+
+/// 切换任务时结算两边的统计 (sched_info_switch)
+///
+/// prev 离开 CPU：累计运行时间，仍可运行（被抢占）时重新开始等待；
+/// next 上 CPU：累计等待时间与上 CPU 次数。idle 任务的运行时间计为本 CPU 的空闲时间
+///
+/// # 参数
+/// * `preempt` - 切换由抢占引起；否则 prev 不再可运行时计为主动切换
+pub fn sched_info_switch(
+    cpu: usize,
+    prev: &mut Task,
+    prev_idle: bool,
+    next: &mut Task,
+    next_idle: bool,
+    preempt: bool,
+    now: u64,
+) {
+    if cpu >= MAX_CPUS {
+        return;
+    }
+    let stats = RQ_STATS.per_cpu(cpu);
+    inc(&stats.nr_switches, 1);
+
+    // sched_info_depart
+    let prev_running = prev.state() == TaskState::Running;
+    let info = &mut prev.se.sched_info;
+    let delta = if info.last_arrival != 0 { now.saturating_sub(info.last_arrival) } else { 0 };
+    info.run_time += delta;
+    if prev_idle {
+        inc(&stats.idle_time, delta);
+        stats.idle_since.store(0, Ordering::Relaxed);
+    } else {
+        inc(&stats.rq_cpu_time, delta);
+        if !preempt && !prev_running {
+            info.nvcsw += 1;
+        } else {
+            info.nivcsw += 1;
+        }
+        if prev_running && info.last_queued == 0 {
+            info.last_queued = now;
+        }
+    }
+
+    // sched_info_arrive
+    let info = &mut next.se.sched_info;
+    info.last_arrival = now;
+    if next_idle {
+        stats.idle_since.store(now, Ordering::Relaxed);
+    } else {
+        if info.last_queued != 0 {
+            let delay = now.saturating_sub(info.last_queued);
+            info.run_delay += delay;
+            info.last_queued = 0;
+            inc(&stats.run_delay, delay);
+        }
+        info.pcount += 1;
+        inc(&stats.pcount, 1);
+    }
+}
+
+/// CPU 开始运行 idle 任务，从这时起计算空闲时间 (init_idle)
+pub fn sched_info_idle_start(cpu: usize, idle: &mut Task, now: u64) {
+    if cpu < MAX_CPUS {
+        idle.se.sched_info.last_arrival = now;
+        RQ_STATS.per_cpu(cpu).idle_since.store(now, Ordering::Relaxed);
+    }
+}
+
+/// 记录一次唤醒 (ttwu_stat)
+pub fn ttwu_stat(this_cpu: usize, target_cpu: usize) {
+    if this_cpu >= MAX_CPUS {
+        return;
+    }
+    let stats = RQ_STATS.per_cpu(this_cpu);
+    inc(&stats.ttwu_count, 1);
+    if this_cpu == target_cpu {
+        inc(&stats.ttwu_local, 1);
+    }
+}
+
+/// 记录一次 sched_yield (schedstat_inc(rq->yld_count))
+pub fn schedstat_yield(cpu: usize) {
+    if cpu < MAX_CPUS {
+        inc(&RQ_STATS.per_cpu(cpu).yld_count, 1);
+    }
+}
+
+/// 把一个 tick 计入当前任务和本 CPU (account_process_tick)
+///
+/// idle 任务的时间由 sched_info_switch 按实际空闲时间计入，这里跳过
+///
+/// # 参数
+/// * `user_tick` - tick 打断的是用户态
+/// * `in_softirq` - tick 打断的是软中断
+pub fn account_process_tick(cpu: usize, curr: &mut Task, idle: bool, user_tick: bool, in_softirq: bool) {
+    if cpu >= MAX_CPUS || idle {
+        return;
+    }
+    let stats = RQ_STATS.per_cpu(cpu);
+    if user_tick {
+        curr.se.sched_info.utime += 1;
+        if curr.static_prio() > DEFAULT_PRIO {
+            inc(&stats.nice, 1);
+        } else {
+            inc(&stats.user, 1);
+        }
+    } else {
+        curr.se.sched_info.stime += 1;
+        if in_softirq {
+            inc(&stats.softirq, 1);
+        } else {
+            inc(&stats.system, 1);
+        }
+    }
+}
+
+/// 任务的累计运行时间 (ns)，正在运行时包括本次已运行的部分 (task_sched_runtime)
+pub fn task_sched_runtime(task: &Task, running: bool, now: u64) -> u64 {
+    let info = &task.se.sched_info;
+    if running && info.last_arrival != 0 {
+        info.run_time + now.saturating_sub(info.last_arrival)
+    } else {
+        info.run_time
+    }
+}
+
+/// 一个 CPU 的 CPU 时间，单位纳秒 (struct kernel_cpustat)
+#[derive(Debug, Clone, Copy, Default)]
+pub struct CpuTime {
+    pub user: u64,
+    pub nice: u64,
+    pub system: u64,
+    pub idle: u64,
+    pub softirq: u64,
+}
+
+impl CpuTime {
+    pub fn add(&mut self, other: &CpuTime) {
+        self.user += other.user;
+        self.nice += other.nice;
+        self.system += other.system;
+        self.idle += other.idle;
+        self.softirq += other.softirq;
+    }
+}
+
+/// CPU 的 CPU 时间；空闲时间包括正在进行的这一段 (get_idle_time)
+pub fn cpu_time(cpu: usize, now: u64) -> CpuTime {
+    if cpu >= MAX_CPUS {
+        return CpuTime::default();
+    }
+    let stats = RQ_STATS.per_cpu(cpu);
+    let tick = crate::time::TICK_NSEC;
+    let since = get(&stats.idle_since);
+    let idle = get(&stats.idle_time) + if since != 0 { now.saturating_sub(since) } else { 0 };
+    CpuTime {
+        user: get(&stats.user) * tick,
+        nice: get(&stats.nice) * tick,
+        system: get(&stats.system) * tick,
+        idle,
+        softirq: get(&stats.softirq) * tick,
+    }
+}
+
+/// CPU 的上下文切换次数 (nr_context_switches_cpu)
+pub fn nr_context_switches_cpu(cpu: usize) -> u64 {
+    if cpu >= MAX_CPUS { 0 } else { get(&RQ_STATS.per_cpu(cpu).nr_switches) }
+}
+
+/// 所有 CPU 的上下文切换次数 (nr_context_switches)
+pub fn nr_context_switches() -> u64 {
+    (0..MAX_CPUS).map(nr_context_switches_cpu).sum()
+}
+
+/// 一个 CPU 的调度计数
+#[derive(Debug, Clone, Copy, Default, PartialEq)]
+pub struct SchedStatCpu {
+    pub yld_count: u64,
+    pub sched_count: u64,
+    pub sched_goidle: u64,
+    pub ttwu_count: u64,
+    pub ttwu_local: u64,
+    /// 纳秒
+    pub rq_cpu_time: u64,
+    /// 纳秒
+    pub run_delay: u64,
+    pub pcount: u64,
+    pub nr_switches: u64,
+}
+
+/// 读取一个 CPU 的调度计数
+pub fn schedstat_cpu(cpu: usize) -> SchedStatCpu {
+    if cpu >= MAX_CPUS {
+        return SchedStatCpu::default();
+    }
+    let stats = RQ_STATS.per_cpu(cpu);
+    SchedStatCpu {
+        yld_count: get(&stats.yld_count),
+        sched_count: get(&stats.sched_count),
+        sched_goidle: get(&stats.sched_goidle),
+        ttwu_count: get(&stats.ttwu_count),
+        ttwu_local: get(&stats.ttwu_local),
+        rq_cpu_time: get(&stats.rq_cpu_time),
+        run_delay: get(&stats.run_delay),
+        pcount: get(&stats.pcount),
+        nr_switches: get(&stats.nr_switches),
+    }
+}
+
+/// /proc/schedstat 中一个 CPU 的行 (show_schedstat)
+///
+/// cpuN yld_count 0 sched_count sched_goidle ttwu_count ttwu_local rq_cpu_time run_delay pcount
+pub fn show_schedstat_cpu(cpu: usize) -> alloc::string::String {
+    let s = schedstat_cpu(cpu);
+    alloc::format!(
+        "cpu{} {} 0 {} {} {} {} {} {} {}\n",
+        cpu, s.yld_count, s.sched_count, s.sched_goidle, s.ttwu_count, s.ttwu_local,
+        s.rq_cpu_time, s.run_delay, s.pcount,
+    )
+}
@@ -11,9 +11,15 @@
 //! - `struct sigaction`: 信号处理动作
 //! - 信号发送 (kill) 和处理 (do_signal)
 
-use core::sync::atomic::{AtomicU64, AtomicUsize, Ordering};
+use core::mem::{offset_of, size_of};
+use core::sync::atomic::{AtomicBool, AtomicU64, Ordering};
 extern crate alloc;
-use alloc::boxed::Box;
+use alloc::collections::VecDeque;
+use spin::Mutex;
+
+use crate::arch::riscv64::trap::TrapFrame;
+use crate::arch::riscv64::uaccess::{copy_from_user, copy_to_user};
+use crate::process::task::{Pid, Task};
 
 /// 信号编号类型
 pub type SigType = i32;
@@ -195,177 +201,83 @@ impl SigAction {
     }
 }
 
+/// 信号对应的位 (sigmask)
+#[inline]
+pub const fn sigmask(sig: i32) -> SigSet {
+    1u64 << (sig - 1)
+}
+
+/// 不能屏蔽的信号
+pub const UNBLOCKABLE: SigSet = sigmask(Signal::SIGKILL as i32) | sigmask(Signal::SIGSTOP as i32);
+
 /// 待处理信号集合
 ///
+/// 标准信号不排队，每个信号在 std_info 中有一个预分配的节点；
+/// 实时信号按发送顺序在 queue 中排队
 #[repr(C)]
 pub struct SigPending {
     /// 待处理信号位图 (64位，支持信号1-64)
     pub signal: AtomicU64,
-    /// 信号信息队列（用于保存 siginfo）
-    /// 对于标准信号，只保存一个
-    /// 对于实时信号，可以排队多个
+    /// 实时信号信息队列
     pub queue: SigQueue,
+    /// 标准信号的信息，下标为信号编号减一 (legacy_queue)
+    std_info: Mutex<[SigInfo; SIGRTMIN as usize - 1]>,
+    /// 有未被屏蔽的待处理信号 (TIF_SIGPENDING)
+    ///
+    /// 返回用户模式时只读这一位。发送方总是置位，可能多报；
+    /// 处理信号或修改屏蔽字时 recalc 按实际情况重新计算
+    sigpending: AtomicBool,
 }
 
-/// 信号队列节点
-#[repr(C)]
-pub struct SigQueueNode {
-    /// 信号信息
-    pub info: SigInfo,
-    /// 下一个节点
-    pub next: Option<Box<SigQueueNode>>,
-}
-
-/// 信号队列
+/// 实时信号队列
 ///
-/// 使用链表实现的信号队列，支持实时信号排队
+/// 同一实时信号可以排队多个，出队时取该信号最早的一个
 pub struct SigQueue {
-    /// 队列头（用于出队）
-    head: AtomicUsize,
-    /// 队列尾（用于入队）
-    tail: AtomicUsize,
+    nodes: Mutex<VecDeque<SigInfo>>,
 }
 
-/// 队列节点指针类型（使用 Box 智能指针）
-type NodePtr = Option<Box<SigQueueNode>>;
-
-unsafe impl Send for SigQueue {}
-unsafe impl Sync for SigQueue {}
-
 impl SigQueue {
     pub const fn new() -> Self {
         Self {
-            head: AtomicUsize::new(0),
-            tail: AtomicUsize::new(0),
+            nodes: Mutex::new(VecDeque::new()),
         }
     }
 
     /// 检查队列是否为空
     pub fn is_empty(&self) -> bool {
-        self.head.load(Ordering::Acquire) == 0
+        self.nodes.lock().is_empty()
     }
 
     /// 入队：添加信号信息到队列尾部
-    ///
-    /// 用于实时信号排队（标准信号不排队，只保留最新的）
     pub fn enqueue(&self, info: SigInfo) {
-        // 使用 Box 分配新节点
-        let new_node = Box::new(SigQueueNode {
-            info,
-            next: None,
-        });
-
-        let new_node_ptr = Box::leak(new_node) as *mut SigQueueNode as usize;
-
-        // CAS 循环：将新节点链接到队列尾部
-        loop {
-            let tail_ptr = self.tail.load(Ordering::Acquire);
-
-            if tail_ptr == 0 {
-                // 队列为空，同时设置 head 和 tail
-                match self.tail.compare_exchange_weak(
-                    0,
-                    new_node_ptr,
-                    Ordering::Release,
-                    Ordering::Acquire,
-                ) {
-                    Ok(_) => {
-                        self.head.store(new_node_ptr, Ordering::Release);
-                        return;
-                    }
-                    Err(_) => continue,
-                }
-            } else {
-                // 队列非空，链接到尾部节点
-                let tail_node = unsafe { &mut *(tail_ptr as *mut SigQueueNode) };
-                if tail_node.next.is_none() {
-                    // 尝试设置 next 指针
-                    tail_node.next = Some(unsafe {
-                        Box::from_raw(new_node_ptr as *mut SigQueueNode)
-                    });
-
-                    // 更新 tail 指针
-                    match self.tail.compare_exchange_weak(
-                        tail_ptr,
-                        new_node_ptr,
-                        Ordering::Release,
-                        Ordering::Acquire,
-                    ) {
-                        Ok(_) => return,
-                        Err(_) => {
-                            // CAS 失败，回滚 next 并重试
-                            tail_node.next = None;
-                            continue;
-                        }
-                    }
-                } else {
-                    // next 已经被设置，说明有并发操作，更新 tail 并重试
-                    self.tail.store(new_node_ptr, Ordering::Release);
-                    continue;
-                }
-            }
-        }
+        self.nodes.lock().push_back(info);
     }
 
     /// 出队：从队列头部移除信号信息
-    ///
-    /// 返回队列头部的信号信息，如果队列为空则返回 None
     pub fn dequeue(&self) -> Option<SigInfo> {
-        loop {
-            let head_ptr = self.head.load(Ordering::Acquire);
-
-            if head_ptr == 0 {
-                return None;
-            }
-
-            let head_node = unsafe { &*(head_ptr as *const SigQueueNode) };
-
-            // 获取下一个节点指针（直接从 Box 获取裸指针）
-            let next_ptr = match &head_node.next {
-                Some(next) => Some(next.as_ref() as *const SigQueueNode as usize),
-                None => None,
-            };
-
-            let next = next_ptr.unwrap_or(0);
-
-            // CAS 更新 head 指针
-            match self.head.compare_exchange_weak(
-                head_ptr,
-                next,
-                Ordering::Release,
-                Ordering::Acquire,
-            ) {
-                Ok(_) => {
-                    // 如果 head 和 tail 都指向同一个节点，也需要更新 tail
-                    if head_ptr == self.tail.load(Ordering::Acquire) {
-                        self.tail.compare_exchange_weak(
-                            head_ptr,
-                            next,
-                            Ordering::Release,
-                            Ordering::Acquire,
-                        );
-                    }
-
-                    // 释放节点内存并返回信号信息
-                    let info = head_node.info;
-                    unsafe {
-                        let _ = Box::from_raw(head_ptr as *mut SigQueueNode);
-                    }
-                    return Some(info);
-                }
-                Err(_) => continue,
-            }
-        }
+        self.nodes.lock().pop_front()
     }
 
     /// 查看队列头部的信号信息（不移除）
     pub fn peek(&self) -> Option<SigInfo> {
-        let head_ptr = self.head.load(Ordering::Acquire);
-        if head_ptr == 0 {
-            return None;
-        }
-        let head_node = unsafe { &*(head_ptr as *const SigQueueNode) };
-        Some(head_node.info)
+        self.nodes.lock().front().copied()
+    }
+
+    /// 取出 sig 最早的一个节点 (collect_signal)
+    ///
+    /// # 返回
+    /// 节点信息，以及队列中是否还有同一信号
+    pub fn take(&self, sig: i32) -> Option<(SigInfo, bool)> {
+        let mut nodes = self.nodes.lock();
+        let pos = nodes.iter().position(|info| info.si_signo == sig)?;
+        let info = nodes.remove(pos)?;
+        let more = nodes.iter().skip(pos).any(|info| info.si_signo == sig);
+        Some((info, more))
+    }
+
+    /// 删除 sig 的所有节点
+    pub fn remove_all(&self, sig: i32) {
+        self.nodes.lock().retain(|info| info.si_signo != sig);
     }
 }
 
@@ -375,29 +287,14 @@ impl SigPending {
         Self {
             signal: AtomicU64::new(0),
             queue: SigQueue::new(),
+            std_info: Mutex::new([SigInfo::EMPTY; SIGRTMIN as usize - 1]),
+            sigpending: AtomicBool::new(false),
         }
     }
 
     /// 添加信号（标准信号只保留一个，实时信号可以排队）
     pub fn add(&self, sig: i32) {
-        if sig < 1 || sig > 64 {
-            return;
-        }
-
-        // 区分标准信号和实时信号
-        if sig < SIGRTMIN {
-            // 标准信号（1-31）：只设置位图，不排队
-            let mask = 1u64 << (sig - 1);
-            self.signal.fetch_or(mask, Ordering::AcqRel);
-        } else {
-            // 实时信号（32-64）：既可以排队，也设置位图
-            let mask = 1u64 << (sig - 1);
-            self.signal.fetch_or(mask, Ordering::AcqRel);
-
-            // 添加到队列（用于 sigqueue 系统调用）
-            let info = SigInfo::new(sig, si_code::SI_USER, 0, 0);
-            self.queue.enqueue(info);
-        }
+        self.add_info(SigInfo::new(sig, si_code::SI_USER, 0, 0));
     }
 
     /// 添加带信息的信号（用于 sigqueue）
@@ -407,15 +304,20 @@ impl SigPending {
             return;
         }
 
-        // 设置位图
-        let mask = 1u64 << (sig - 1);
-        self.signal.fetch_or(mask, Ordering::AcqRel);
-
-        // 实时信号需要排队
-        if sig >= SIGRTMIN {
+        if sig < SIGRTMIN {
+            // 已经待处理时保留原来的信息 (legacy_queue)
+            let mut std_info = self.std_info.lock();
+            if self.signal.load(Ordering::Acquire) & sigmask(sig) == 0 {
+                std_info[(sig - 1) as usize] = info;
+                self.signal.fetch_or(sigmask(sig), Ordering::AcqRel);
+            }
+        } else {
             self.queue.enqueue(info);
+            self.signal.fetch_or(sigmask(sig), Ordering::AcqRel);
         }
-        // 标准信号只保留最新的 info，不排队
+
+        // 位图先于标志可见，与 recalc 的清除配对
+        self.sigpending.store(true, Ordering::SeqCst);
     }
 
     /// 删除信号（从位图和队列中删除）
@@ -424,22 +326,62 @@ impl SigPending {
             return;
         }
 
-        let mask = 1u64 << (sig - 1);
+        if sig >= SIGRTMIN {
+            self.queue.remove_all(sig);
+        }
+        self.signal.fetch_and(!sigmask(sig), Ordering::AcqRel);
+    }
 
-        // 如果是实时信号且队列非空，从队列中移除
-        if sig >= SIGRTMIN && !self.queue.is_empty() {
-            // 尝试从队列头部移除该信号
-            while let Some(info) = self.queue.peek() {
-                if info.si_signo == sig {
-                    self.queue.dequeue();
-                } else {
-                    break;
+    /// 取出编号最小的未屏蔽信号 (dequeue_signal)
+    ///
+    /// 不修改 sigpending 标志，全部处理完后由调用者 recalc
+    pub fn dequeue(&self, blocked: SigSet) -> Option<SigInfo> {
+        let blocked = blocked & !UNBLOCKABLE;
+        loop {
+            let ready = self.signal.load(Ordering::Acquire) & !blocked;
+            if ready == 0 {
+                return None;
+            }
+            let sig = ready.trailing_zeros() as i32 + 1;
+
+            if sig < SIGRTMIN {
+                let std_info = self.std_info.lock();
+                if self.signal.fetch_and(!sigmask(sig), Ordering::AcqRel) & sigmask(sig) != 0 {
+                    return Some(std_info[(sig - 1) as usize]);
+                }
+                // 被并发的 remove 取走，重新查找
+                continue;
+            }
+
+            // 最后一个节点被取出时才清除位
+            match self.queue.take(sig) {
+                Some((info, true)) => return Some(info),
+                Some((info, false)) => {
+                    self.signal.fetch_and(!sigmask(sig), Ordering::AcqRel);
+                    return Some(info);
+                }
+                None => {
+                    // 位已置而节点还没入队不会发生：入队先于置位
+                    self.signal.fetch_and(!sigmask(sig), Ordering::AcqRel);
+                    return Some(SigInfo::new(sig, si_code::SI_USER, 0, 0));
                 }
             }
         }
+    }
+
+    /// 按屏蔽字重新计算 sigpending 标志 (recalc_sigpending)
+    pub fn recalc(&self, blocked: SigSet) {
+        self.sigpending.store(false, Ordering::SeqCst);
+        // 清除之后再检查，并发的 add 要么被这里看到，要么在清除之后重新置位
+        if self.signal.load(Ordering::SeqCst) & !(blocked & !UNBLOCKABLE) != 0 {
+            self.sigpending.store(true, Ordering::SeqCst);
+        }
+    }
 
-        // 清除位图
-        self.signal.fetch_and(!mask, Ordering::AcqRel);
+    /// 是否可能有未屏蔽的待处理信号 (signal_pending / TIF_SIGPENDING)
+    #[inline]
+    pub fn sigpending(&self) -> bool {
+        self.sigpending.load(Ordering::Relaxed)
     }
 
     /// 检查是否有待处理信号
@@ -447,8 +389,7 @@ impl SigPending {
         if sig < 1 || sig > 64 {
             return false;
         }
-        let mask = 1u64 << (sig - 1);
-        (self.signal.load(Ordering::Acquire) & mask) != 0
+        (self.signal.load(Ordering::Acquire) & sigmask(sig)) != 0
     }
 
     /// 获取第一个待处理信号（从位图获取）
@@ -462,7 +403,7 @@ impl SigPending {
         Some(sig)
     }
 
-    /// 获取第一个待处理信号的详细信息（从队列获取）
+    /// 获取第一个排队的实时信号的详细信息
     pub fn first_info(&self) -> Option<SigInfo> {
         self.queue.dequeue()
     }
@@ -472,6 +413,7 @@ impl SigPending {
         self.signal.store(0, Ordering::Release);
         // 清空队列
         while self.queue.dequeue().is_some() {}
+        self.sigpending.store(false, Ordering::Release);
     }
 
     /// 获取所有待处理信号（位图）
@@ -482,12 +424,17 @@ impl SigPending {
 
 /// 信号处理结构
 ///
+/// CLONE_SIGHAND 创建的线程共享同一个结构，action 由锁保护 (sighand->siglock)
 #[repr(C)]
 pub struct SignalStruct {
     /// 每个信号的动作 (64个信号)
-    pub action: [SigAction; 64],
+    pub action: Mutex<[SigAction; 64]>,
     /// 信号掩码
     pub mask: AtomicU64,
+    /// 已发起组退出的线程组与组退出码 (SIGNAL_GROUP_EXIT, group_exit_code)
+    ///
+    /// 只共享 CLONE_SIGHAND 而不在同一线程组的任务按 TGID 区分
+    group_exit: Mutex<Option<(Pid, i32)>>,
 }
 
 impl SignalStruct {
@@ -503,13 +450,38 @@ impl SignalStruct {
         actions[Signal::SIGCHLD as usize - 1] = SigAction::ignore();
 
         Self {
-            action: actions,
+            action: Mutex::new(actions),
             mask: AtomicU64::new(0),
+            group_exit: Mutex::new(None),
+        }
+    }
+
+    /// 为线程组 tgid 发起组退出，记下组退出码 (do_group_exit)
+    ///
+    /// # 返回
+    /// (组内线程使用的退出码, 是否由本次调用发起)：组内已有线程发起过组退出时，
+    /// 沿用先记下的退出码
+    pub fn start_group_exit(&self, tgid: Pid, exit_code: i32) -> (i32, bool) {
+        let mut group_exit = self.group_exit.lock();
+        match *group_exit {
+            Some((gid, code)) if gid == tgid => (code, false),
+            _ => {
+                *group_exit = Some((tgid, exit_code));
+                (exit_code, true)
+            }
+        }
+    }
+
+    /// 线程组 tgid 的组退出码，没有发起组退出时返回 None
+    pub fn group_exit_code(&self, tgid: Pid) -> Option<i32> {
+        match *self.group_exit.lock() {
+            Some((gid, code)) if gid == tgid => Some(code),
+            _ => None,
         }
     }
 
     /// 设置信号处理动作
-    pub fn set_action(&mut self, sig: i32, action: SigAction) -> Result<(), ()> {
+    pub fn set_action(&self, sig: i32, action: SigAction) -> Result<(), ()> {
         if sig < 1 || sig > 64 {
             return Err(());
         }
@@ -519,16 +491,16 @@ impl SignalStruct {
             return Err(());
         }
 
-        self.action[(sig - 1) as usize] = action;
+        self.action.lock()[(sig - 1) as usize] = action;
         Ok(())
     }
 
     /// 获取信号处理动作
-    pub fn get_action(&self, sig: i32) -> Option<&SigAction> {
+    pub fn get_action(&self, sig: i32) -> Option<SigAction> {
         if sig < 1 || sig > 64 {
             return None;
         }
-        Some(&self.action[(sig - 1) as usize])
+        Some(self.action.lock()[(sig - 1) as usize])
     }
 
     /// 添加信号掩码
@@ -577,6 +549,9 @@ pub struct SigInfo {
 }
 
 impl SigInfo {
+    /// 空的信号信息，用于预分配的节点
+    pub const EMPTY: SigInfo = SigInfo { si_signo: 0, si_code: 0, si_pid: 0, si_uid: 0, si_status: 0 };
+
     /// 创建新的信号信息
     pub fn new(signo: i32, code: i32, pid: u32, uid: u32) -> Self {
         Self {
@@ -618,43 +593,87 @@ pub mod si_code {
 // 信号帧结构 (Signal Frame)
 // ============================================================================
 
-/// 用户上下文 - 信号处理时保存的寄存器状态
+/// 用户态 siginfo_t
 ///
-/// aarch64 特定版本 (arch/arm64/include/uapi/asm/sigcontext.h)
+/// 128 字节，只填 kill / SIGCHLD 用到的字段 (include/uapi/asm-generic/siginfo.h)
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
-pub struct UContext {
-    /// 信号掩码
-    pub uc_sigmask: u64,
-    /// 保留字段
-    pub uc_flags: u64,
-    /// 链接到下一个 ucontext (用于 swapcontext)
-    pub uc_link: u64,
-    /// 栈指针
-    pub uc_stack: u64,
-    /// 寄存器上下文 (在未来扩展)
-    pub uc_mcontext: [u64; 32],  // x0-x30 + sp
-    /// 保存的 PC (程序计数器)
-    pub uc_pc: u64,
-    /// 保留空间（对齐和未来扩展）
-    pub uc_reserved: [u64; 2],
+pub struct UserSigInfo {
+    pub si_signo: i32,
+    pub si_errno: i32,
+    pub si_code: i32,
+    _pad: i32,
+    pub si_pid: u32,
+    pub si_uid: u32,
+    pub si_status: i32,
+    _rest: [u32; 25],
 }
 
-impl UContext {
-    /// 创建新的用户上下文
-    pub fn new() -> Self {
+impl UserSigInfo {
+    pub fn from_info(info: &SigInfo) -> Self {
         Self {
-            uc_sigmask: 0,
-            uc_flags: 0,
-            uc_link: 0,
-            uc_stack: 0,
-            uc_mcontext: [0; 32],
-            uc_pc: 0,
-            uc_reserved: [0; 2],
+            si_signo: info.si_signo,
+            si_errno: 0,
+            si_code: info.si_code,
+            _pad: 0,
+            si_pid: info.si_pid,
+            si_uid: info.si_uid,
+            si_status: info.si_status,
+            _rest: [0; 25],
         }
     }
 }
 
+/// 用户态 stack_t
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct UserStack {
+    pub ss_sp: u64,
+    pub ss_flags: i32,
+    _pad: i32,
+    pub ss_size: u64,
+}
+
+/// 寄存器上下文 (struct sigcontext)
+///
+/// sc_regs 按 struct user_regs_struct 排列：pc, ra, sp, gp, tp, t0-t2, s0, s1,
+/// a0-a7, s2-s11, t3-t6；sc_fpregs 是 __riscv_fp_state 的 Q 扩展大小，
+/// 按 D 扩展布局使用前 33 个字：f0-f31，然后是低 32 位的 fcsr
+#[repr(C, align(16))]
+#[derive(Debug, Copy, Clone)]
+pub struct SigContext {
+    pub sc_regs: [u64; 32],
+    pub sc_fpregs: [u64; 66],
+}
+
+/// sc_regs 中各寄存器的下标
+pub mod sc_reg {
+    pub const PC: usize = 0;
+    pub const RA: usize = 1;
+    pub const SP: usize = 2;
+    pub const GP: usize = 3;
+    pub const TP: usize = 4;
+    pub const T0: usize = 5;
+    pub const S0: usize = 8;
+    pub const A0: usize = 10;
+    pub const S2: usize = 18;
+    pub const T3: usize = 28;
+}
+
+/// 用户上下文 (struct ucontext, arch/riscv/include/uapi/asm/ucontext.h)
+#[repr(C)]
+#[derive(Debug, Copy, Clone)]
+pub struct UContext {
+    pub uc_flags: u64,
+    pub uc_link: u64,
+    pub uc_stack: UserStack,
+    /// 进入处理函数前的信号掩码，rt_sigreturn 时恢复
+    pub uc_sigmask: u64,
+    /// 为更大的 sigset_t 保留 (__unused)
+    _unused: [u8; 120],
+    pub uc_mcontext: SigContext,
+}
+
 /// 信号栈 - 备用信号处理栈
 ///
 /// 用于 sigaltstack 系统调用
@@ -705,33 +724,33 @@ pub const SIGSTKSZ: usize = 8192;
 /// 信号栈最小大小
 pub const MINSIGSTKSZ: usize = 2048;
 
-/// 信号返回 trampoline 代码
-///
-/// 当信号处理函数返回时，会跳转到这个地址，
-/// 然后执行 rt_sigreturn 系统调用恢复上下文
-const SIGRETURN_TRAMPOLINE: &[u8] = &[
-    0x00, 0x00, 0x00, 0x00,  // 魔术字
-];
-
-/// 信号帧 - 在用户栈上构建
+/// 用户栈上的信号帧 (struct rt_sigframe, arch/riscv/kernel/signal.c)
 ///
+/// 处理函数的 a1 指向 info，a2 指向 uc；返回地址是 vDSO 的 __vdso_rt_sigreturn
 #[repr(C)]
 #[derive(Debug, Copy, Clone)]
-pub struct SignalFrame {
-    /// 保留字（对齐和魔术）
-    pub reserved: [u64; 4],
-    /// 信号信息
-    pub info: SigInfo,
-    /// 用户上下文
+pub struct RtSigFrame {
+    pub info: UserSigInfo,
     pub uc: UContext,
-    /// trampoline 代码（占位）
-    pub trampoline: [u8; 4],
 }
 
-impl SignalFrame {
+impl RtSigFrame {
     /// 计算信号帧的总大小
     pub const fn size() -> usize {
-        core::mem::size_of::<SignalFrame>()
+        size_of::<RtSigFrame>()
+    }
+
+    fn zeroed() -> Self {
+        // 全部字段都是整数，全零是合法值
+        unsafe { core::mem::zeroed() }
+    }
+
+    fn as_bytes(&self) -> &[u8] {
+        unsafe { core::slice::from_raw_parts(self as *const Self as *const u8, Self::size()) }
+    }
+
+    fn as_bytes_mut(&mut self) -> &mut [u8] {
+        unsafe { core::slice::from_raw_parts_mut(self as *mut Self as *mut u8, Self::size()) }
     }
 }
 
@@ -750,249 +769,216 @@ pub mod consts {
 // 信号处理和传递
 // ============================================================================
 
-/// 检查并处理待处理的信号
+/// 返回用户模式前处理信号 (exit_to_user_mode_loop)
 ///
+/// 快速路径只读取当前任务缓存的 sigpending 标志
+#[inline]
+pub fn exit_to_user_mode(frame: *mut TrapFrame) {
+    if let Some(task) = crate::sched::current() {
+        if task.pending.sigpending() || task.saved_sigmask.is_some() {
+            unsafe { do_signal(task, frame) };
+        }
+    }
+}
+
+/// 系统调用等待期间临时替换信号掩码 (set_user_sigmask)
 ///
-/// # Returns
+/// 原掩码保存在 saved_sigmask，由 restore_saved_sigmask_unless 或 do_signal 恢复
+pub unsafe fn set_user_sigmask(task: *mut Task, mask: SigSet) {
+    (*task).saved_sigmask = Some((*task).sigmask);
+    (*task).sigmask = mask & !UNBLOCKABLE;
+    (*task).pending.recalc((*task).sigmask);
+}
+
+/// 系统调用返回前恢复原信号掩码 (restore_saved_sigmask_unless)
 ///
-/// * `true` - 如果有待处理的信号
-/// * `false` - 如果没有待处理的信号
-pub fn do_signal() -> bool {
-    use crate::sched;
+/// interrupted 为真（等待被信号打断）时保留临时掩码，让临时掩码解除屏蔽的信号
+/// 在返回用户模式时先被递送，信号帧中保存原掩码，do_signal 最后恢复
+pub unsafe fn restore_saved_sigmask_unless(task: *mut Task, interrupted: bool) {
+    if interrupted {
+        return;
+    }
+    if let Some(saved) = (*task).saved_sigmask.take() {
+        (*task).sigmask = saved;
+        (*task).pending.recalc(saved);
+    }
+}
 
-    unsafe {
-        let current = match sched::current() {
-            Some(c) => c,
-            None => return false,
-        };
-
-        // 检查是否有待处理信号
-        let sig = match (*current).pending.first() {
-            Some(s) => s,
-            None => return false,
-        };
-
-        // 获取信号处理动作（克隆需要的数据）
-        let action = (*current).signal.as_ref()
+/// 处理所有未屏蔽的待处理信号 (arch_do_signal_or_restart)
+///
+/// 有处理函数的信号在用户栈上建立信号帧，返回用户模式后直接进入处理函数；
+/// 多个信号的帧依次叠加，后建立的先执行
+pub unsafe fn do_signal(task: *mut Task, frame: *mut TrapFrame) {
+    // SIGKILL 不经过信号动作，先于其他信号处理：组退出时使用组退出码 (get_signal)
+    if (*task).pending.get_all() & sigmask(Signal::SIGKILL as i32) != 0 {
+        let exit_code = (*task).signal.as_ref()
+            .and_then(|s| s.group_exit_code((*task).tgid()))
+            .unwrap_or(crate::sched::kill_status(Signal::SIGKILL as i32));
+        crate::sched::do_exit(exit_code);
+    }
+
+    while let Some(info) = (*task).pending.dequeue((*task).sigmask) {
+        let sig = info.si_signo;
+        let action = (*task).signal.as_ref()
             .and_then(|s| s.get_action(sig))
-            .cloned();
-
-        // 处理信号
-        if let Some(action) = action {
-            // 检查是否有自定义处理函数
-            if action.has_handler() {
-                // 调用信号处理函数
-                if !setup_frame(current, sig, &action) {
-                    // 设置失败，执行默认动作
-                    handle_default_signal(sig);
+            .unwrap_or(SigAction::new());
+
+        match action.action() {
+            SigActionKind::Ignore => {}
+            SigActionKind::Default => handle_default_signal(sig),
+            SigActionKind::Handler => {
+                if !setup_rt_frame(task, frame, &info, &action) {
+                    // 信号帧写不进用户栈 (force_sigsegv)
+                    handle_default_signal(Signal::SIGSEGV as i32);
                 }
-            } else {
-                // 执行默认动作
-                handle_default_signal(sig);
             }
         }
-
-        // 从待处理队列中删除信号
-        (*current).pending.remove(sig);
-
-        true
     }
+    // 没有建立信号帧时恢复系统调用替换前的掩码 (restore_saved_sigmask)
+    if let Some(saved) = (*task).saved_sigmask.take() {
+        (*task).sigmask = saved;
+    }
+    (*task).pending.recalc((*task).sigmask);
 }
 
-/// 设置信号帧并准备调用信号处理函数
-///
-///
-/// # Arguments
+/// 在用户栈上建立信号帧并转到处理函数 (setup_rt_frame)
 ///
-/// * `task` - 当前任务
-/// * `sig` - 信号编号
-/// * `action` - 信号处理动作
-///
-/// # Returns
+/// 保存 TrapFrame 中的用户寄存器与当前信号掩码，再修改 TrapFrame：
+/// sepc 指向处理函数，a0-a2 为 (sig, &info, &uc)，ra 为 vDSO 的 rt_sigreturn 跳板。
+/// s0/s1 不在 TrapFrame 中：trap 路径不修改它们，处理函数按调用约定保存，
+/// rt_sigreturn 时仍是原值
 ///
-/// * `true` - 设置成功
-/// * `false` - 设置失败
-unsafe fn setup_frame(
-    task: *mut crate::process::task::Task,
-    sig: i32,
-    action: &SigAction,
-) -> bool {
-    // 获取任务的 CPU 上下文
-    let ctx = (*task).context_mut();
-
-    // 检查是否需要使用信号栈
-    let use_altstack = (action.sa_flags.bits() & crate::signal::SigFlags::SA_ONSTACK) != 0;
-
-    // 定义用户栈地址范围（假设的用户空间栈）
-    const USER_STACK_TOP: u64 = 0x0000_7fff_f000_0000;
-    const SIGNAL_FRAME_SIZE: u64 = SignalFrame::size() as u64;
-
-    // 根据标志决定使用哪个栈
-    let frame_addr = if use_altstack {
-        // 使用信号栈
-        let sigstack = &(*task).sigstack;
-
-        // 检查信号栈是否有效
-        if sigstack.is_disabled() || sigstack.ss_sp == 0 {
-            return false;
-        }
-
-        // 计算信号帧位置（在信号栈顶部）
-        sigstack.ss_sp + sigstack.ss_size - SIGNAL_FRAME_SIZE
+/// # 返回
+/// 信号帧写入失败返回 false，此时 TrapFrame 和信号掩码不变
+pub unsafe fn setup_rt_frame(task: *mut Task, frame: *mut TrapFrame, info: &SigInfo, action: &SigAction) -> bool {
+    use sc_reg::*;
+
+    let flags = action.sa_flags.bits();
+    let sig = info.si_signo;
+    let user_sp = (*frame).orig_sp();
+
+    // 选择栈 (get_sigframe)：SA_ONSTACK 且设置了备用栈、当前不在备用栈上时切换
+    let sigstack = (*task).sigstack;
+    let altstack = sigstack.ss_sp != 0 && !sigstack.is_disabled();
+    let on_altstack = altstack && user_sp > sigstack.ss_sp && user_sp <= sigstack.ss_sp + sigstack.ss_size;
+    let sp = if flags & SigFlags::SA_ONSTACK != 0 && altstack && !on_altstack {
+        sigstack.ss_sp + sigstack.ss_size
     } else {
-        // 使用正常用户栈
-        USER_STACK_TOP - SIGNAL_FRAME_SIZE
+        user_sp
     };
-
-    // TODO: 在实际的用户栈内存上构建信号帧
-    // 当前简化实现：暂时不真正构建信号帧
-    // 完整实现需要：
-    // 1. 验证用户栈地址有效
-    // 2. 分配信号帧空间
-    // 3. 使用 copy_to_user 填充信号帧内容
-
-    // 创建信号帧
-    let mut frame = SignalFrame {
-        reserved: [0; 4],
-        info: SigInfo::new(sig, crate::signal::si_code::SI_KERNEL, (*task).pid(), 0),
-        uc: UContext::new(),
-        trampoline: [0xD4, 0x20, 0x00, 0x58],  // svc #0x80 (rt_sigreturn)
+    let addr = match sp.checked_sub(RtSigFrame::size() as u64) {
+        Some(addr) => addr & !15,
+        None => return false,
     };
 
-    // 保存当前上下文到信号帧（用于 sigreturn 恢复）
-    // CpuContext 只有: x0-x7, x19-x28, fp, sp, pc, user_sp, user_spsr
-    frame.uc.uc_mcontext[0] = ctx.x0;
-    frame.uc.uc_mcontext[1] = ctx.x1;
-    frame.uc.uc_mcontext[2] = ctx.x2;
-    frame.uc.uc_mcontext[3] = ctx.x3;
-    frame.uc.uc_mcontext[4] = ctx.x4;
-    frame.uc.uc_mcontext[5] = ctx.x5;
-    frame.uc.uc_mcontext[6] = ctx.x6;
-    frame.uc.uc_mcontext[7] = ctx.x7;
-    // x8-x18 在 CpuContext 中不存在，跳过
-    frame.uc.uc_mcontext[19] = ctx.x19;
-    frame.uc.uc_mcontext[20] = ctx.x20;
-    frame.uc.uc_mcontext[21] = ctx.x21;
-    frame.uc.uc_mcontext[22] = ctx.x22;
-    frame.uc.uc_mcontext[23] = ctx.x23;
-    frame.uc.uc_mcontext[24] = ctx.x24;
-    frame.uc.uc_mcontext[25] = ctx.x25;
-    frame.uc.uc_mcontext[26] = ctx.x26;
-    frame.uc.uc_mcontext[27] = ctx.x27;
-    frame.uc.uc_mcontext[28] = ctx.x28;
-    // x29 (fp) 在 CpuContext 中名为 fp
-    frame.uc.uc_mcontext[29] = ctx.fp;
-    // x30 (lr) 在 CpuContext 中是 sp
-    frame.uc.uc_mcontext[30] = ctx.sp;   // sp (实际是 x30/lr)
-    frame.uc.uc_mcontext[31] = ctx.user_sp;   // user_sp
-
-    // 保存 PC（程序计数器）- 信号处理完成后要返回的地址
-    frame.uc.uc_pc = ctx.pc;
-
-    // 保存信号掩码
-    frame.uc.uc_sigmask = (*task).sigmask;
-
-    // TODO: 将信号帧写入用户空间
-    // 暂时保存到任务的内核空间（信号帧地址传递给 restore_sigcontext）
-    (*task).sigframe_addr = frame_addr;
-    (*task).sigframe = Some(frame);
-
-    // 设置信号处理函数参数
-    ctx.x0 = sig as u64;                      // 第一个参数：信号编号
-    ctx.x1 = frame_addr + 32;                 // 第二个参数：&info (偏移到 info 字段)
-    ctx.x2 = frame_addr + 32 + core::mem::size_of::<SigInfo>() as u64;  // 第三个参数：&uc
-
-    // 设置返回地址为信号处理函数
-    ctx.pc = action.sa_handler as u64;
-
-    // 设置用户栈指针到信号帧位置
-    ctx.sp = frame_addr;
-
-    true  // 成功
-}
-
-/// 从用户栈恢复信号上下文
-///
-///
-/// # Arguments
-///
-/// * `task` - 当前任务
-/// * `frame_addr` - 信号帧在用户空间的地址
-///
-/// # Returns
-///
-/// * `true` - 恢复成功
-/// * `false` - 恢复失败
-pub unsafe fn restore_sigcontext(
-    task: *mut crate::process::task::Task,
-    frame_addr: u64,
-) -> bool {
-    // 验证信号帧地址
-    if frame_addr == 0 {
+    let mut rt = RtSigFrame::zeroed();
+    rt.info = UserSigInfo::from_info(info);
+    rt.uc.uc_stack = UserStack {
+        ss_sp: sigstack.ss_sp,
+        ss_flags: if !altstack {
+            ss_flags::SS_DISABLE as i32
+        } else if on_altstack {
+            ss_flags::SS_ONSTACK as i32
+        } else {
+            0
+        },
+        _pad: 0,
+        ss_size: sigstack.ss_size,
+    };
+    // 系统调用临时替换了掩码时保存原掩码，rt_sigreturn 恢复 (sigmask_to_save)
+    rt.uc.uc_sigmask = (*task).saved_sigmask.unwrap_or((*task).sigmask);
+
+    let f = &*frame;
+    let regs = &mut rt.uc.uc_mcontext.sc_regs;
+    regs[PC] = f.sepc;
+    regs[RA] = f.ra;
+    regs[SP] = user_sp;
+    regs[GP] = f.gp;
+    regs[TP] = f.user_tp();
+    regs[T0..T0 + 3].copy_from_slice(&[f.t0, f.t1, f.t2]);
+    regs[A0..A0 + 8].copy_from_slice(&[f.a0, f.a1, f.a2, f.a3, f.a4, f.a5, f.a6, f.a7]);
+    regs[S2..S2 + 10].copy_from_slice(&[f.s2, f.s3, f.s4, f.s5, f.s6, f.s7, f.s8, f.s9, f.s10, f.s11]);
+    regs[T3..T3 + 4].copy_from_slice(&[f.t3, f.t4, f.t5, f.t6]);
+
+    // 浮点寄存器 (save_fp_state)
+    crate::arch::riscv64::fpu::fpu_flush(task);
+    let fp = &(*task).fpu.state;
+    let fpregs = &mut rt.uc.uc_mcontext.sc_fpregs;
+    fpregs[..32].copy_from_slice(&fp.f);
+    fpregs[32] = fp.fcsr as u64;
+
+    if copy_to_user(addr as usize, rt.as_bytes()) != 0 {
         return false;
     }
 
-    // 从内核空间的备份获取信号帧
-    let frame = match (*task).sigframe {
-        Some(f) => f,
-        None => return false,
-    };
-
-    // 获取任务的 CPU 上下文
-    let ctx = (*task).context_mut();
-
-    // 从信号帧的 uc_mcontext 恢复寄存器
-    // CpuContext 只有: x0-x7, x19-x28, fp, sp, pc, user_sp, user_spsr
-    ctx.x0 = frame.uc.uc_mcontext[0];
-    ctx.x1 = frame.uc.uc_mcontext[1];
-    ctx.x2 = frame.uc.uc_mcontext[2];
-    ctx.x3 = frame.uc.uc_mcontext[3];
-    ctx.x4 = frame.uc.uc_mcontext[4];
-    ctx.x5 = frame.uc.uc_mcontext[5];
-    ctx.x6 = frame.uc.uc_mcontext[6];
-    ctx.x7 = frame.uc.uc_mcontext[7];
-    // x8-x18 在 CpuContext 中不存在，跳过
-    ctx.x19 = frame.uc.uc_mcontext[19];
-    ctx.x20 = frame.uc.uc_mcontext[20];
-    ctx.x21 = frame.uc.uc_mcontext[21];
-    ctx.x22 = frame.uc.uc_mcontext[22];
-    ctx.x23 = frame.uc.uc_mcontext[23];
-    ctx.x24 = frame.uc.uc_mcontext[24];
-    ctx.x25 = frame.uc.uc_mcontext[25];
-    ctx.x26 = frame.uc.uc_mcontext[26];
-    ctx.x27 = frame.uc.uc_mcontext[27];
-    ctx.x28 = frame.uc.uc_mcontext[28];
-    // x29 (fp) 在 CpuContext 中名为 fp
-    ctx.fp = frame.uc.uc_mcontext[29];
-    // x30 (lr) 在 CpuContext 中是 sp
-    ctx.sp = frame.uc.uc_mcontext[30];   // sp (实际是 x30/lr)
-    ctx.user_sp = frame.uc.uc_mcontext[31];   // user_sp
-
-    // 恢复 PC（程序计数器）- 返回到信号中断前的位置
-    ctx.pc = frame.uc.uc_pc;
-
-    // 恢复信号掩码
-    (*task).sigmask = frame.uc.uc_sigmask;
-
-    // 清除信号帧
-    (*task).sigframe = None;
-    (*task).sigframe_addr = 0;
+    let f = &mut *frame;
+    f.sepc = action.sa_handler as u64;
+    f.ra = crate::arch::riscv64::vdso::sigreturn_trampoline();
+    f.a0 = sig as u64;
+    f.a1 = addr + offset_of!(RtSigFrame, info) as u64;
+    f.a2 = addr + offset_of!(RtSigFrame, uc) as u64;
+    f.set_orig_sp(addr);
+
+    // 处理函数执行期间屏蔽 sa_mask 和信号本身 (signal_delivered)
+    let mut blocked = (*task).sigmask | action.sa_mask;
+    if flags & SigFlags::SA_NODEFER == 0 {
+        blocked |= sigmask(sig);
+    }
+    (*task).sigmask = blocked & !UNBLOCKABLE;
+    // 原掩码已保存在信号帧中 (clear_restore_sigmask)
+    (*task).saved_sigmask = None;
 
+    if flags & SigFlags::SA_RESETHAND != 0 {
+        if let Some(sig_struct) = (*task).signal.as_ref() {
+            let _ = sig_struct.set_action(sig, SigAction::new());
+        }
+    }
     true
 }
 
-/// 获取信号帧的偏移量
+/// 从用户栈上的信号帧恢复上下文 (restore_sigcontext)
 ///
-/// 返回信号帧中各个字段的偏移量，用于在用户栈上定位数据
-pub mod frame_offsets {
-    /// SigInfo 在 SignalFrame 中的偏移量
-    pub const SIGINFO_OFFSET: usize = 32;  // reserved [4 * u64]
-
-    /// UContext 在 SignalFrame 中的偏移量
-    pub const UCONTEXT_OFFSET: usize = 32 + 40;  // reserved + SigInfo
+/// 信号帧位于 TrapFrame 中的用户 sp：处理函数返回到跳板时 sp 已恢复为建立帧时的值
+///
+/// # 返回
+/// 恢复后的 a0；信号帧不可读返回 EFAULT
+pub unsafe fn restore_sigcontext(task: *mut Task, frame: *mut TrapFrame) -> Result<u64, i32> {
+    use sc_reg::*;
+
+    let addr = (*frame).orig_sp();
+    let mut rt = RtSigFrame::zeroed();
+    if copy_from_user(rt.as_bytes_mut(), addr as usize) != 0 {
+        return Err(-14);  // EFAULT
+    }
 
-    /// uc_mcontext 在 UContext 中的偏移量
-    pub const MCONTEXT_OFFSET: usize = 32;  // uc_sigmask + uc_flags + uc_link + uc_stack
+    let regs = &rt.uc.uc_mcontext.sc_regs;
+    let f = &mut *frame;
+    f.sepc = regs[PC];
+    f.ra = regs[RA];
+    f.set_orig_sp(regs[SP]);
+    f.gp = regs[GP];
+    // trap.S 用保存的 tp 为 0 表示从内核进入，0 不是合法的用户 tp
+    if regs[TP] != 0 {
+        f.set_user_tp(regs[TP]);
+    }
+    [f.t0, f.t1, f.t2] = [regs[T0], regs[T0 + 1], regs[T0 + 2]];
+    [f.a0, f.a1, f.a2, f.a3, f.a4, f.a5, f.a6, f.a7] =
+        core::array::from_fn(|i| regs[A0 + i]);
+    [f.s2, f.s3, f.s4, f.s5, f.s6, f.s7, f.s8, f.s9, f.s10, f.s11] =
+        core::array::from_fn(|i| regs[S2 + i]);
+    [f.t3, f.t4, f.t5, f.t6] = core::array::from_fn(|i| regs[T3 + i]);
+
+    // 浮点寄存器 (restore_fp_state)：硬件寄存器中的内容作废，返回用户模式时重新装载
+    let fpregs = &rt.uc.uc_mcontext.sc_fpregs;
+    let fp = &mut (*task).fpu.state;
+    fp.f.copy_from_slice(&fpregs[..32]);
+    fp.fcsr = fpregs[32] as u32;
+    crate::arch::riscv64::fpu::fpu_invalidate(task);
+
+    // 恢复信号掩码后，处理期间被屏蔽的信号可能可以递送了
+    (*task).sigmask = rt.uc.uc_sigmask & !UNBLOCKABLE;
+    (*task).pending.recalc((*task).sigmask);
+    Ok(f.a0)
 }
 
 /// 处理信号的默认动作
@@ -1049,21 +1035,6 @@ pub fn send_signal(pid: u32, sig: i32) -> bool {
     }
 }
 
-/// 检查并处理信号（在内核返回用户空间前调用）
-///
-pub fn check_and_deliver_signals() {
-    use crate::sched;
-
-    unsafe {
-        if let Some(current) = sched::current() {
-            // 如果有待处理信号，处理它们
-            if (*current).pending().get_all() != 0 {
-                do_signal();
-            }
-        }
-    }
-}
-
 /// 发送带信号信息的信号（sigqueue）
 ///
 ///
@@ -1128,7 +1099,7 @@ pub fn sigprocmask(how: i32, set: SigSet, oldset: Option<&mut SigSet>) -> i32 {
 
     unsafe {
         if let Some(current) = sched::current() {
-            let signal_struct = (*current).signal.as_mut();
+            let signal_struct = (*current).signal.as_ref();
 
             if let Some(sig_struct) = signal_struct {
                 // 保存旧的掩码
@@ -1192,20 +1163,20 @@ pub fn rt_sigaction(
         return -22_i32;  // EINVAL
     }
 
-    // SIGKILL 和 SIGSTOP 不能被捕获或忽略
-    if sig == Signal::SIGKILL as i32 || sig == Signal::SIGSTOP as i32 {
+    // SIGKILL 和 SIGSTOP 不能被捕获或忽略，但可以查询
+    if act.is_some() && (sig == Signal::SIGKILL as i32 || sig == Signal::SIGSTOP as i32) {
         return -22_i32;  // EINVAL
     }
 
     unsafe {
         if let Some(current) = sched::current() {
-            let signal_struct = (*current).signal.as_mut();
+            let signal_struct = (*current).signal.as_ref();
 
             if let Some(sig_struct) = signal_struct {
                 // 保存旧的信号处理动作
                 if let Some(old) = oldact {
                     if let Some(old_action) = sig_struct.get_action(sig) {
-                        *old = *old_action;
+                        *old = old_action;
                     } else {
                         *old = SigAction::new();
                     }
@@ -1214,7 +1185,13 @@ pub fn rt_sigaction(
                 // 设置新的信号处理动作
                 if let Some(new_action) = act {
                     match sig_struct.set_action(sig, *new_action) {
-                        Ok(_) => 0,  // 成功
+                        Ok(_) => {
+                            // 改为忽略时丢弃已待处理的该信号 (sig_handler_ignored)
+                            if new_action.action() == SigActionKind::Ignore {
+                                (*current).pending.remove(sig);
+                            }
+                            0  // 成功
+                        }
                         Err(_) => -22_i32,  // EINVAL
                     }
                 } else {
@@ -1266,6 +1243,11 @@ pub fn signal_pending() -> bool {
 
     unsafe {
         if let Some(current) = sched::current() {
+            // 快速路径：标志未置位时一定没有未屏蔽的信号
+            if !(*current).pending.sigpending() {
+                return false;
+            }
+
             // 获取待处理信号
             let pending_signals = (*current).pending.get_all();
 
@@ -1322,8 +1304,8 @@ pub fn signal_wake_up_state(task: *mut crate::process::task::Task, _state: crate
                 // 唤醒进程：设置为 Running 状态
                 (*task).set_state(crate::process::task::TaskState::Running);
 
-                // 设置 need_resched 标志，触发重新调度
-                crate::sched::set_need_resched();
+                // 选择运行队列加入，并触发目标 CPU 重新调度
+                crate::sched::activate_task(task, 0);
 
                 true
             }
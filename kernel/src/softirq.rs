@@ -0,0 +1,139 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 软中断 (softirq)
+//!
+//! 硬中断处理函数只做最少的工作，把耗时的部分标记为待处理的软中断，在中断
+//! 返回前 (irq_exit) 统一执行。每个 CPU 有自己的待处理位图，raise 在哪个
+//! CPU 上执行，处理函数就在哪个 CPU 上运行。
+//!
+//! 设备中断的下半部 (NET_RX、BLOCK) 用 open_softirq_threaded 注册，执行时打开中断，
+//! 相当于线程化的中断处理 (irq_thread)：耗时的收包、完成请求不再挡住其他中断。
+//! 其余软中断与硬中断共享不关中断的锁（如定时器时间轮），仍在关中断下运行。
+//! 执行期间再来的中断不会嵌套执行软中断，新标记的位由外层循环处理。
+//!
+//! 参考: kernel/softirq.c, kernel/irq/manage.c, include/linux/interrupt.h
+
+use core::sync::atomic::{AtomicBool, AtomicU32, AtomicUsize, Ordering};
+
+use crate::config::MAX_CPUS;
+
+/// 软中断编号 (HI_SOFTIRQ ...)
+pub const HI_SOFTIRQ: usize = 0;
+pub const TIMER_SOFTIRQ: usize = 1;
+pub const NET_TX_SOFTIRQ: usize = 2;
+pub const NET_RX_SOFTIRQ: usize = 3;
+pub const BLOCK_SOFTIRQ: usize = 4;
+pub const IRQ_POLL_SOFTIRQ: usize = 5;
+pub const TASKLET_SOFTIRQ: usize = 6;
+pub const SCHED_SOFTIRQ: usize = 7;
+pub const HRTIMER_SOFTIRQ: usize = 8;
+pub const RCU_SOFTIRQ: usize = 9;
+pub const NR_SOFTIRQS: usize = 10;
+
+/// 一次 irq_exit 中重新检查待处理位图的最大次数 (MAX_SOFTIRQ_RESTART)
+///
+/// 处理函数可能再次 raise，超过次数后留到下一次中断
+const MAX_SOFTIRQ_RESTART: usize = 10;
+
+/// 软中断处理函数表 (softirq_vec)，存放 fn() 的地址，0 表示未注册
+static SOFTIRQ_VEC: [AtomicUsize; NR_SOFTIRQS] = [const { AtomicUsize::new(0) }; NR_SOFTIRQS];
+
+/// 在开中断下运行的软中断位图
+static SOFTIRQ_THREADED: AtomicU32 = AtomicU32::new(0);
+
+/// 每个 CPU 待处理的软中断位图 (irq_stat.__softirq_pending)
+static SOFTIRQ_PENDING: [AtomicU32; MAX_CPUS] = [const { AtomicU32::new(0) }; MAX_CPUS];
+
+/// 每个 CPU 是否正在执行软中断 (in_serving_softirq)
+static SOFTIRQ_ACTIVE: [AtomicBool; MAX_CPUS] = [const { AtomicBool::new(false) }; MAX_CPUS];
+
+/// 注册软中断处理函数 (open_softirq)
+pub fn open_softirq(nr: usize, action: fn()) {
+    if nr < NR_SOFTIRQS {
+        SOFTIRQ_THREADED.fetch_and(!(1 << nr), Ordering::AcqRel);
+        SOFTIRQ_VEC[nr].store(action as usize, Ordering::Release);
+    }
+}
+
+/// 注册在开中断下运行的软中断处理函数 (request_threaded_irq 的 thread_fn)
+///
+/// 处理函数获取的锁在硬中断中也会获取时，必须用 lock_irqsave 或 try_lock
+pub fn open_softirq_threaded(nr: usize, action: fn()) {
+    if nr < NR_SOFTIRQS {
+        SOFTIRQ_VEC[nr].store(action as usize, Ordering::Release);
+        SOFTIRQ_THREADED.fetch_or(1 << nr, Ordering::AcqRel);
+    }
+}
+
+/// 在当前 CPU 上标记软中断待处理 (raise_softirq)
+pub fn raise_softirq(nr: usize) {
+    let cpu = crate::arch::cpu_id() as usize;
+    if nr < NR_SOFTIRQS && cpu < MAX_CPUS {
+        SOFTIRQ_PENDING[cpu].fetch_or(1 << nr, Ordering::AcqRel);
+    }
+}
+
+/// 当前 CPU 是否有待处理的软中断 (local_softirq_pending)
+#[inline]
+pub fn local_softirq_pending() -> bool {
+    let cpu = crate::arch::cpu_id() as usize;
+    cpu < MAX_CPUS && SOFTIRQ_PENDING[cpu].load(Ordering::Acquire) != 0
+}
+
+/// 当前 CPU 是否正在执行软中断 (in_serving_softirq)
+///
+/// 开中断的软中断期间嵌套的中断不能调度出去：被打断的处理函数可能持有自旋锁
+#[inline]
+pub fn in_softirq() -> bool {
+    let cpu = crate::arch::cpu_id() as usize;
+    cpu < MAX_CPUS && SOFTIRQ_ACTIVE[cpu].load(Ordering::Acquire)
+}
+
+/// 执行当前 CPU 上待处理的软中断 (__do_softirq)
+///
+/// 在中断关闭的状态下调用，返回时中断仍关闭；线程化的处理函数执行期间打开中断，
+/// 期间嵌套的中断只标记待处理位，不会再次进入这里
+pub fn do_softirq() {
+    let cpu = crate::arch::cpu_id() as usize;
+    if cpu >= MAX_CPUS || SOFTIRQ_ACTIVE[cpu].swap(true, Ordering::AcqRel) {
+        return;
+    }
+    for _ in 0..MAX_SOFTIRQ_RESTART {
+        let mut pending = SOFTIRQ_PENDING[cpu].swap(0, Ordering::AcqRel);
+        if pending == 0 {
+            break;
+        }
+        let threaded = SOFTIRQ_THREADED.load(Ordering::Acquire);
+        while pending != 0 {
+            let nr = pending.trailing_zeros() as usize;
+            pending &= pending - 1;
+            let action = SOFTIRQ_VEC[nr].load(Ordering::Acquire);
+            if action == 0 {
+                continue;
+            }
+            let action: fn() = unsafe { core::mem::transmute(action) };
+            if threaded & (1 << nr) != 0 {
+                // 不带 nomem：开关中断也是编译器屏障
+                unsafe { core::arch::asm!("csrsi sstatus, 2", options(nostack)) };
+                action();
+                unsafe { core::arch::asm!("csrci sstatus, 2", options(nostack)) };
+            } else {
+                action();
+            }
+        }
+    }
+    SOFTIRQ_ACTIVE[cpu].store(false, Ordering::Release);
+}
+
+/// 中断返回前执行软中断 (irq_exit)
+///
+/// 软中断可能改变最早的定时器，之后再判断 NO_HZ full 能否停止 tick
+#[inline]
+pub fn irq_exit() {
+    if local_softirq_pending() {
+        do_softirq();
+    }
+    crate::time::tick::tick_nohz_irq_exit();
+}
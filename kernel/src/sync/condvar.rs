@@ -15,7 +15,8 @@
 //! - signal() 唤醒一个等待的进程
 //! - broadcast() 唤醒所有等待的进程
 
-use crate::process::wait::WaitQueueHead;
+use crate::process::task::TaskState;
+use crate::process::wait::{WaitQueueEntry, WaitQueueHead};
 
 /// 条件变量
 ///
@@ -82,8 +83,8 @@ impl ConditionVariable {
     /// * `mutex` - 关联的互斥锁
     ///
     /// # 行为
-    /// 1. 原子地释放互斥锁
-    /// 2. 加入等待队列
+    /// 1. 加入等待队列
+    /// 2. 释放互斥锁
     /// 3. 让出 CPU，进入睡眠
     /// 4. 被唤醒后重新获取互斥锁
     /// 5. 返回
@@ -103,32 +104,7 @@ impl ConditionVariable {
     /// # }
     /// ```
     pub fn wait(&self, mutex: &super::Mutex) {
-        // 1. 释放互斥锁
-        mutex.unlock();
-
-        // 2. 加入等待队列并等待
-        // 条件：被唤醒（总是满足）
-        let current = match crate::sched::current() {
-            Some(task) => task,
-            None => {
-                // 无法获取当前任务，重新获取锁并返回
-                mutex.lock();
-                return;
-            }
-        };
-
-        let entry = crate::process::wait::WaitQueueEntry::new(current, false);
-        self.wait.add(entry);
-
-        // 3. 让出 CPU
-        #[cfg(feature = "riscv64")]
-        crate::sched::schedule();
-
-        // 4. 被唤醒后，从等待队列移除
-        self.wait.remove(current);
-
-        // 5. 重新获取互斥锁
-        mutex.lock();
+        let _ = self.wait_common(mutex, TaskState::Uninterruptible);
     }
 
     /// 等待条件满足（可中断）
@@ -141,8 +117,8 @@ impl ConditionVariable {
     /// * `Err(())` - 被信号中断
     ///
     /// # 行为
-    /// 1. 原子地释放互斥锁
-    /// 2. 加入等待队列
+    /// 1. 加入等待队列
+    /// 2. 释放互斥锁
     /// 3. 让出 CPU，进入睡眠
     /// 4. 被唤醒或被信号中断后重新获取互斥锁
     /// 5. 返回结果
@@ -171,36 +147,39 @@ impl ConditionVariable {
     /// # }
     /// ```
     pub fn wait_interruptible(&self, mutex: &super::Mutex) -> Result<(), ()> {
-        // 1. 释放互斥锁
-        mutex.unlock();
-
-        // TODO: 检查信号中断
-        // 当前简化实现：直接调用 wait()
+        self.wait_common(mutex, TaskState::Interruptible)
+    }
 
-        // 2. 加入等待队列并等待
+    /// 加入等待队列、释放互斥锁、睡眠，醒来后重新加锁
+    ///
+    /// 先置睡眠状态并加入队列再解锁：持锁修改条件后的 signal 一定能看到本等待者，
+    /// 唤醒不会丢失。重新加锁时发出 signal 的任务通常还在运行并很快解锁，
+    /// 互斥锁的乐观自旋让被唤醒者不必再睡一次
+    fn wait_common(&self, mutex: &super::Mutex, state: TaskState) -> Result<(), ()> {
         let current = match crate::sched::current() {
             Some(task) => task,
-            None => {
-                // 无法获取当前任务，重新获取锁并返回
-                mutex.lock();
-                return Ok(());
-            }
+            // 无法获取当前任务，不能睡眠
+            None => return Ok(()),
         };
 
-        let entry = crate::process::wait::WaitQueueEntry::new(current, false);
-        self.wait.add(entry);
-
-        // 3. 让出 CPU
-        #[cfg(feature = "riscv64")]
-        crate::sched::schedule();
+        let entry = WaitQueueEntry::new(current, false);
+        current.set_state(state);
+        self.wait.add(&entry);
+        mutex.unlock();
 
-        // 4. 被唤醒后，从等待队列移除
-        self.wait.remove(current);
+        let interruptible = state == TaskState::Interruptible;
+        if !entry.is_woken() && !(interruptible && crate::signal::signal_pending()) {
+            crate::sched::schedule();
+        }
+        current.set_state(TaskState::Running);
+        self.wait.remove(&entry);
 
-        // 5. 重新获取互斥锁
         mutex.lock();
-
-        Ok(())
+        if !entry.is_woken() && interruptible && crate::signal::signal_pending() {
+            Err(())
+        } else {
+            Ok(())
+        }
     }
 
     /// 唤醒一个等待的进程
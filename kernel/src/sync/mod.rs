@@ -9,10 +9,22 @@
 //!
 //! 核心概念：
 //! - 信号量用于进程同步和互斥
+//! - 互斥锁在持有者运行时自旋、否则睡眠，并交接给等待太久的等待者
+//! - 自旋锁按到达顺序获得 (ticket / MCS)，提供关中断版本和锁统计
+//! - 读多写少的数据用读写锁、顺序锁或 RCU
 //! - P 操作 (down): 获取信号量
 //! - V 操作 (up): 释放信号量
 
 pub mod semaphore;
+pub mod mutex;
 pub mod condvar;
+pub mod seqlock;
+pub mod rcu;
+pub mod spinlock;
+pub mod rwlock;
 
-pub use semaphore::Mutex;
+pub use mutex::Mutex;
+pub use seqlock::SeqLock;
+pub use rcu::{call_rcu, kfree_rcu, rcu_read_lock, synchronize_rcu};
+pub use rwlock::RwLock;
+pub use spinlock::{LockClass, QueuedSpinLock, TicketLock};
@@ -0,0 +1,414 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 自适应互斥锁 (Mutex)
+//!
+//! 完全...
+//! - `kernel/locking/mutex.c` - 互斥锁，乐观自旋与交接
+//!
+//! 核心概念：
+//! - owner 字保存持有者任务指针，低 3 位是标志；无竞争时加锁、解锁各一次 cmpxchg
+//! - 乐观自旋 (mutex_optimistic_spin)：持有者正在其他 CPU 上运行时，
+//!   它很快就会释放锁，原地自旋比睡眠再唤醒便宜
+//! - 持有者不在运行、或本 CPU 需要重新调度时，挂到侵入式等待链表上睡眠
+//! - 交接 (MUTEX_FLAG_HANDOFF)：第一个等待者醒来后仍抢不到锁就置交接位，
+//!   下一次解锁直接把锁交给它，不再被自旋者插队，等待者不会饿死
+
+use core::ptr;
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+use crate::process::task::{Task, TaskState};
+use crate::sync::TicketLock;
+
+/// 等待链表非空，解锁要走慢速路径唤醒等待者
+const MUTEX_FLAG_WAITERS: usize = 0x01;
+/// 第一个等待者要求下一次解锁把锁交给它
+const MUTEX_FLAG_HANDOFF: usize = 0x02;
+/// 锁已交给 owner 字中的任务，由它醒来后取走
+const MUTEX_FLAG_PICKUP: usize = 0x04;
+const MUTEX_FLAGS: usize = 0x07;
+
+/// 启动早期还没有当前任务时使用的持有者，不指向任何任务
+const OWNER_EARLY: usize = MUTEX_FLAGS + 1;
+
+/// 等待者，睡眠期间在等待者的栈上 (struct mutex_waiter)
+struct MutexWaiter {
+    task: *mut Task,
+    next: *const MutexWaiter,
+    prev: *const MutexWaiter,
+}
+
+/// 等待链表，按到达顺序排列；由 wait_lock 保护 (wait_list)
+struct WaiterList {
+    first: *const MutexWaiter,
+    last: *const MutexWaiter,
+}
+
+// 链表只在 wait_lock 内访问，项在链入期间保持有效
+unsafe impl Send for WaiterList {}
+
+impl WaiterList {
+    const fn new() -> Self {
+        Self { first: ptr::null(), last: ptr::null() }
+    }
+
+    /// 添加到尾部
+    unsafe fn add_tail(&mut self, waiter: *mut MutexWaiter) {
+        (*waiter).next = ptr::null();
+        (*waiter).prev = self.last;
+        if self.last.is_null() {
+            self.first = waiter;
+        } else {
+            (*(self.last as *mut MutexWaiter)).next = waiter;
+        }
+        self.last = waiter;
+    }
+
+    unsafe fn remove(&mut self, waiter: *mut MutexWaiter) {
+        let (next, prev) = ((*waiter).next, (*waiter).prev);
+        if prev.is_null() {
+            self.first = next;
+        } else {
+            (*(prev as *mut MutexWaiter)).next = next;
+        }
+        if next.is_null() {
+            self.last = prev;
+        } else {
+            (*(next as *mut MutexWaiter)).prev = prev;
+        }
+        (*waiter).next = ptr::null();
+        (*waiter).prev = ptr::null();
+    }
+
+    /// 第一个等待者的任务，链表为空时返回空指针
+    fn first_task(&self) -> *mut Task {
+        if self.first.is_null() {
+            ptr::null_mut()
+        } else {
+            unsafe { (*self.first).task }
+        }
+    }
+}
+
+/// 当前任务作为持有者的值
+fn current_owner() -> usize {
+    match crate::sched::current() {
+        Some(task) => task as *mut Task as usize,
+        None => OWNER_EARLY,
+    }
+}
+
+/// 持有者是否还在运行，启动早期的持有者总是视为在运行
+#[inline]
+fn owner_running(owner: usize) -> bool {
+    owner == OWNER_EARLY || crate::sched::task_curr(owner as *const Task)
+}
+
+/// 互斥锁 (struct mutex)
+///
+/// 持有期间可以睡眠，不能在中断上下文使用；同一任务加锁后必须由它解锁
+///
+/// # 示例
+/// ```no_run
+/// # use kernel::sync::Mutex;
+/// # fn test(mutex: &Mutex) {
+/// mutex.lock();
+/// // ... 临界区 ...
+/// mutex.unlock();
+/// # }
+/// ```
+pub struct Mutex {
+    /// 持有者任务指针 | 标志，0 表示未加锁 (owner)
+    owner: AtomicUsize,
+    /// 等待链表 (wait_lock + wait_list)
+    wait_lock: TicketLock<WaiterList>,
+}
+
+impl Mutex {
+    /// 创建新互斥锁
+    ///
+    /// # 示例
+    /// ```
+    /// let mutex = Mutex::new();
+    /// ```
+    pub const fn new() -> Self {
+        Self {
+            owner: AtomicUsize::new(0),
+            wait_lock: TicketLock::new(WaiterList::new()),
+        }
+    }
+
+    /// 获取锁 (mutex_lock)
+    ///
+    /// 无竞争时一次 cmpxchg；持有者在运行时先自旋，否则睡眠等待
+    ///
+    /// # 示例
+    /// ```no_run
+    /// # use kernel::sync::Mutex;
+    /// # fn test(mutex: &Mutex) {
+    /// mutex.lock();
+    /// // ... 临界区 ...
+    /// mutex.unlock();
+    /// # }
+    /// ```
+    pub fn lock(&self) {
+        let curr = current_owner();
+        if self.owner.compare_exchange(0, curr, Ordering::Acquire, Ordering::Relaxed).is_ok() {
+            return;
+        }
+        self.lock_slowpath(curr);
+    }
+
+    /// 尝试获取锁（非阻塞）(mutex_trylock)
+    ///
+    /// # 返回
+    /// - `Ok(())` - 成功获取锁
+    /// - `Err(())` - 锁已被占用
+    pub fn try_lock(&self) -> Result<(), ()> {
+        if self.trylock_common(current_owner(), false) {
+            Ok(())
+        } else {
+            Err(())
+        }
+    }
+
+    /// 释放锁 (mutex_unlock)
+    ///
+    /// 没有标志时一次 cmpxchg；有等待者时唤醒第一个，要求交接时直接把锁交给它
+    pub fn unlock(&self) {
+        let owner = self.owner.load(Ordering::Relaxed);
+        if owner & MUTEX_FLAGS == 0
+            && self.owner.compare_exchange(owner, 0, Ordering::Release, Ordering::Relaxed).is_ok()
+        {
+            return;
+        }
+        self.unlock_slowpath();
+    }
+
+    /// 是否已被持有 (mutex_is_locked)
+    pub fn is_locked(&self) -> bool {
+        self.owner.load(Ordering::Relaxed) & !MUTEX_FLAGS != 0
+    }
+
+    /// 是否有任务在等待
+    pub fn has_waiters(&self) -> bool {
+        self.owner.load(Ordering::Relaxed) & MUTEX_FLAG_WAITERS != 0
+    }
+
+    /// 尝试获取锁 (__mutex_trylock_common)
+    ///
+    /// 锁已交给 curr 时取走它；handoff 为真时（第一个等待者）抢不到就置交接位
+    fn trylock_common(&self, curr: usize, handoff: bool) -> bool {
+        let mut owner = self.owner.load(Ordering::Relaxed);
+        loop {
+            let mut flags = owner & MUTEX_FLAGS;
+            let mut task = owner & !MUTEX_FLAGS;
+            if task != 0 {
+                if flags & MUTEX_FLAG_PICKUP != 0 {
+                    if task != curr {
+                        return false;
+                    }
+                    flags &= !MUTEX_FLAG_PICKUP;
+                } else if handoff {
+                    if flags & MUTEX_FLAG_HANDOFF != 0 {
+                        return false;
+                    }
+                    flags |= MUTEX_FLAG_HANDOFF;
+                } else {
+                    return false;
+                }
+            } else {
+                task = curr;
+            }
+            match self.owner.compare_exchange_weak(owner, task | flags, Ordering::Acquire, Ordering::Relaxed) {
+                Ok(_) => return task == curr,
+                Err(cur) => owner = cur,
+            }
+        }
+    }
+
+    /// 持有者在运行时等它释放 (mutex_spin_on_owner)
+    ///
+    /// # 返回
+    /// 持有者已经变化返回 true，应停止自旋（持有者睡眠或本 CPU 要重新调度）返回 false
+    fn spin_on_owner(&self, owner: usize) -> bool {
+        loop {
+            if self.owner.load(Ordering::Relaxed) & !MUTEX_FLAGS != owner {
+                return true;
+            }
+            if !owner_running(owner) || crate::sched::need_resched() {
+                return false;
+            }
+            core::hint::spin_loop();
+        }
+    }
+
+    /// 乐观自旋 (mutex_optimistic_spin)
+    ///
+    /// 持有者一直在运行就一直自旋；锁交接给等待者期间不与它争抢
+    fn optimistic_spin(&self, curr: usize) -> bool {
+        loop {
+            let owner = self.owner.load(Ordering::Relaxed);
+            if owner & MUTEX_FLAG_PICKUP != 0 {
+                return false;
+            }
+            let task = owner & !MUTEX_FLAGS;
+            if task != 0 && !self.spin_on_owner(task) {
+                return false;
+            }
+            if self.trylock_common(curr, false) {
+                return true;
+            }
+            if crate::sched::need_resched() {
+                return false;
+            }
+            core::hint::spin_loop();
+        }
+    }
+
+    /// 加锁慢速路径 (__mutex_lock_common)
+    fn lock_slowpath(&self, curr: usize) {
+        if self.optimistic_spin(curr) {
+            return;
+        }
+
+        // 启动早期没有调度器，只能自旋
+        if curr == OWNER_EARLY {
+            while !self.trylock_common(curr, false) {
+                core::hint::spin_loop();
+            }
+            return;
+        }
+
+        let task = curr as *mut Task;
+        let mut waiter = MutexWaiter { task, next: ptr::null(), prev: ptr::null() };
+        let waiter_ptr = &mut waiter as *mut MutexWaiter;
+        {
+            let mut list = self.wait_lock.lock();
+            unsafe { list.add_tail(waiter_ptr) };
+            // 置等待者位后持有者解锁一定走慢速路径
+            self.owner.fetch_or(MUTEX_FLAG_WAITERS, Ordering::SeqCst);
+        }
+
+        loop {
+            // 先置睡眠状态再检查：解锁方的唤醒不会丢失
+            unsafe { (*task).set_state(TaskState::Uninterruptible) };
+            if self.trylock_common(curr, false) {
+                break;
+            }
+            crate::sched::schedule();
+            unsafe { (*task).set_state(TaskState::Running) };
+
+            let first = core::ptr::eq(self.wait_lock.lock().first, waiter_ptr);
+            if first {
+                // 第一个等待者：抢不到就要求交接，持有者在运行时再自旋一会
+                if self.trylock_common(curr, true) {
+                    break;
+                }
+                let owner = self.owner.load(Ordering::Relaxed) & !MUTEX_FLAGS;
+                if owner != 0 && owner != curr && self.spin_on_owner(owner) && self.trylock_common(curr, true) {
+                    break;
+                }
+            }
+        }
+        unsafe { (*task).set_state(TaskState::Running) };
+
+        let mut list = self.wait_lock.lock();
+        unsafe { list.remove(waiter_ptr) };
+        if list.first.is_null() {
+            self.owner.fetch_and(!(MUTEX_FLAG_WAITERS | MUTEX_FLAG_HANDOFF), Ordering::Relaxed);
+        }
+    }
+
+    /// 解锁慢速路径 (__mutex_unlock_slowpath)
+    fn unlock_slowpath(&self) {
+        let mut owner = self.owner.load(Ordering::Relaxed);
+        // 要求交接时持有者不变，下面直接改成第一个等待者
+        while owner & MUTEX_FLAG_HANDOFF == 0 {
+            match self.owner.compare_exchange_weak(
+                owner,
+                owner & MUTEX_FLAG_WAITERS,
+                Ordering::Release,
+                Ordering::Relaxed,
+            ) {
+                Ok(_) if owner & MUTEX_FLAG_WAITERS != 0 => break,
+                Ok(_) => return,
+                Err(cur) => owner = cur,
+            }
+        }
+
+        let next = {
+            let list = self.wait_lock.lock();
+            let next = list.first_task();
+            if owner & MUTEX_FLAG_HANDOFF != 0 {
+                self.handoff(next);
+            }
+            next
+        };
+        if !next.is_null() {
+            crate::sched::wake_up_process(next);
+        }
+    }
+
+    /// 把锁交给 task (__mutex_handoff)，task 为空时直接释放
+    fn handoff(&self, task: *mut Task) {
+        let mut owner = self.owner.load(Ordering::Relaxed);
+        loop {
+            let mut new = owner & MUTEX_FLAG_WAITERS;
+            if !task.is_null() {
+                new |= task as usize | MUTEX_FLAG_PICKUP;
+            }
+            match self.owner.compare_exchange_weak(owner, new, Ordering::Release, Ordering::Relaxed) {
+                Ok(_) => return,
+                Err(cur) => owner = cur,
+            }
+        }
+    }
+
+    /// 获取锁守护（RAII）
+    ///
+    /// 自动管理锁的生命周期，当守护离开作用域时自动释放锁
+    ///
+    /// # 示例
+    /// ```no_run
+    /// # use kernel::sync::Mutex;
+    /// # fn test(mutex: &Mutex) {
+    /// {
+    ///     let _guard = mutex.guard();
+    ///     // ... 临界区 ...
+    /// } // 自动释放锁
+    /// # }
+    /// ```
+    pub fn guard(&self) -> MutexGuard<'_> {
+        MutexGuard::new(self)
+    }
+}
+
+impl Default for Mutex {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
+/// 互斥锁守护（RAII）
+pub struct MutexGuard<'a> {
+    mutex: &'a Mutex,
+}
+
+impl<'a> MutexGuard<'a> {
+    /// 创建锁守护
+    ///
+    /// # 参数
+    /// * `mutex` - 关联的互斥锁
+    pub fn new(mutex: &'a Mutex) -> Self {
+        mutex.lock();
+        Self { mutex }
+    }
+}
+
+impl<'a> Drop for MutexGuard<'a> {
+    fn drop(&mut self) {
+        self.mutex.unlock();
+    }
+}
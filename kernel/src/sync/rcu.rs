@@ -0,0 +1,175 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 读-拷贝-更新 (RCU)
+//!
+//! 完全...
+//! - `include/linux/rcupdate.h` - rcu_read_lock / synchronize_rcu
+//!
+//! 核心概念：
+//! - 读者关中断进入读临界区，不加锁、不写共享数据，读临界区内不能睡眠
+//! - 写者先发布新指针（或摘除旧指针），再等待宽限期：每个 CPU 都离开过
+//!   在宽限期开始时已经进入的读临界区，之后才能释放旧对象
+//! - 每个 CPU 一个序号，只由本 CPU 修改：进入最外层读临界区加一（变为奇数），
+//!   离开时再加一。写者逐个检查，序号为奇数时等到它变化
+//! - 不想等待的写者用 call_rcu 登记回调，同时记下各 CPU 的序号快照；
+//!   读者关中断且不能睡眠，所以调度 (__schedule) 时本 CPU 一定处于静止状态，
+//!   在这里检查快照，宽限期已结束的回调按登记顺序执行
+
+use alloc::boxed::Box;
+use alloc::collections::VecDeque;
+use alloc::vec::Vec;
+use core::sync::atomic::{fence, AtomicUsize, Ordering};
+
+use crate::arch::context::InterruptGuard;
+use crate::config::MAX_CPUS;
+use crate::sync::TicketLock;
+
+/// 各 CPU 的读临界区序号，奇数表示正在读
+static RCU_READER_SEQ: [AtomicUsize; MAX_CPUS] = [const { AtomicUsize::new(0) }; MAX_CPUS];
+
+/// 各 CPU 的读临界区嵌套深度，只由本 CPU 在关中断时访问
+static mut RCU_READ_DEPTH: [usize; MAX_CPUS] = [0; MAX_CPUS];
+
+/// 读临界区守卫，drop 时离开临界区 (rcu_read_unlock)
+pub struct RcuReadGuard {
+    cpu: usize,
+    _irq: InterruptGuard,
+}
+
+/// 进入读临界区 (rcu_read_lock)
+///
+/// 可以嵌套；临界区内不能调度，也不能调用 synchronize_rcu
+#[inline]
+pub fn rcu_read_lock() -> RcuReadGuard {
+    let irq = unsafe { InterruptGuard::new() };
+    let cpu = crate::arch::cpu_id() as usize % MAX_CPUS;
+    unsafe {
+        let depth = &mut *core::ptr::addr_of_mut!(RCU_READ_DEPTH[cpu]);
+        if *depth == 0 {
+            let seq = &RCU_READER_SEQ[cpu];
+            seq.store(seq.load(Ordering::Relaxed) + 1, Ordering::Relaxed);
+            // 序号先于临界区内的读取可见
+            fence(Ordering::SeqCst);
+        }
+        *depth += 1;
+    }
+    RcuReadGuard { cpu, _irq: irq }
+}
+
+impl Drop for RcuReadGuard {
+    #[inline]
+    fn drop(&mut self) {
+        unsafe {
+            let depth = &mut *core::ptr::addr_of_mut!(RCU_READ_DEPTH[self.cpu]);
+            *depth -= 1;
+            if *depth == 0 {
+                let seq = &RCU_READER_SEQ[self.cpu];
+                seq.store(seq.load(Ordering::Relaxed) + 1, Ordering::Release);
+            }
+        }
+    }
+}
+
+/// 等待宽限期结束 (synchronize_rcu)
+///
+/// 返回时，调用前已进入读临界区的读者都已离开，摘除的旧对象可以释放
+pub fn synchronize_rcu() {
+    // 摘除旧指针的写入先于对读者序号的检查
+    fence(Ordering::SeqCst);
+    for seq in RCU_READER_SEQ.iter() {
+        let start = seq.load(Ordering::Acquire);
+        if start & 1 == 0 {
+            continue;
+        }
+        while seq.load(Ordering::Acquire) == start {
+            core::hint::spin_loop();
+        }
+    }
+}
+
+/// 宽限期后执行的回调 (struct rcu_head)
+struct RcuCallback {
+    /// 登记时各 CPU 的读临界区序号
+    snap: [usize; MAX_CPUS],
+    func: Box<dyn FnOnce() + Send>,
+}
+
+/// 等待宽限期的回调，按登记顺序排列
+static RCU_CALLBACKS: TicketLock<VecDeque<RcuCallback>> = TicketLock::new(VecDeque::new());
+
+/// 等待中的回调数，调度路径只读它
+static RCU_NR_CALLBACKS: AtomicUsize = AtomicUsize::new(0);
+
+/// 各 CPU 读临界区序号的快照
+fn reader_snapshot() -> [usize; MAX_CPUS] {
+    // 摘除旧指针的写入先于读取序号
+    fence(Ordering::SeqCst);
+    core::array::from_fn(|cpu| RCU_READER_SEQ[cpu].load(Ordering::Acquire))
+}
+
+/// 快照之后每个 CPU 都经过了静止状态：当时不在读临界区，或者已经离开
+fn grace_period_elapsed(snap: &[usize; MAX_CPUS]) -> bool {
+    snap.iter()
+        .zip(RCU_READER_SEQ.iter())
+        .all(|(&start, seq)| start & 1 == 0 || seq.load(Ordering::Acquire) != start)
+}
+
+/// 宽限期结束后执行 func (call_rcu)
+///
+/// 不等待，可以在读临界区内调用；func 在之后某次调度或 rcu_barrier 中执行
+pub fn call_rcu(func: impl FnOnce() + Send + 'static) {
+    let callback = RcuCallback { snap: reader_snapshot(), func: Box::new(func) };
+    RCU_CALLBACKS.lock_irqsave().push_back(callback);
+    RCU_NR_CALLBACKS.fetch_add(1, Ordering::Relaxed);
+}
+
+/// 宽限期结束后释放对象 (kfree_rcu)
+pub fn kfree_rcu<T: Send + 'static>(obj: Box<T>) {
+    call_rcu(move || drop(obj));
+}
+
+/// 执行宽限期已结束的回调 (rcu_do_batch)
+///
+/// 后登记的快照不早于先登记的，遇到第一个未结束的就停止
+///
+/// # 返回
+/// 执行的回调数
+pub fn rcu_process_callbacks() -> usize {
+    let ready: Vec<RcuCallback> = {
+        let mut callbacks = RCU_CALLBACKS.lock_irqsave();
+        let nr = callbacks.iter().take_while(|cb| grace_period_elapsed(&cb.snap)).count();
+        callbacks.drain(..nr).collect()
+    };
+    let nr = ready.len();
+    if nr != 0 {
+        RCU_NR_CALLBACKS.fetch_sub(nr, Ordering::Relaxed);
+        // 锁外执行，回调可以再登记回调
+        for callback in ready {
+            (callback.func)();
+        }
+    }
+    nr
+}
+
+/// 本 CPU 经过静止状态 (rcu_note_context_switch)
+///
+/// 由 __schedule 调用：调度时不在读临界区内
+#[inline]
+pub fn rcu_note_context_switch() {
+    if RCU_NR_CALLBACKS.load(Ordering::Relaxed) != 0 {
+        rcu_process_callbacks();
+    }
+}
+
+/// 等待已登记的回调全部执行 (rcu_barrier)
+pub fn rcu_barrier() {
+    synchronize_rcu();
+    rcu_process_callbacks();
+}
+
+/// 等待宽限期的回调数
+pub fn rcu_pending() -> usize {
+    RCU_NR_CALLBACKS.load(Ordering::Relaxed)
+}
@@ -0,0 +1,201 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 读写自旋锁 (rwlock)
+//!
+//! 完全...
+//! - `kernel/locking/qrwlock.c` - 排队读写锁
+//!
+//! 核心概念：
+//! - 多个读者可以同时持有，写者独占
+//! - 写者优先：有写者等待时新的读者先等待，读多写少时写者也不会饿死
+//! - 关中断的读者（中断处理程序、irqsave 区段）不理会等待的写者：
+//!   本 CPU 被打断的代码可能正持有读锁，等写者会死锁 (qrwlock 的 in_interrupt 例外)
+
+use core::cell::UnsafeCell;
+use core::ops::{Deref, DerefMut};
+use core::sync::atomic::{AtomicU32, Ordering};
+
+use crate::sched::preempt::{preempt_disable, preempt_enable};
+
+/// 写者持有锁
+const WRITER: u32 = 1 << 31;
+/// 有写者在等待
+const WRITER_WAITING: u32 = 1 << 30;
+/// 读者计数
+const READER_MASK: u32 = WRITER_WAITING - 1;
+
+/// 中断是否已关闭 (irqs_disabled)
+#[inline]
+fn irqs_disabled() -> bool {
+    let sstatus: u64;
+    unsafe { core::arch::asm!("csrr {}, sstatus", out(reg) sstatus, options(nomem, nostack)) };
+    sstatus & 0x2 == 0
+}
+
+/// 读写锁保护的数据 (rwlock_t)
+pub struct RwLock<T> {
+    /// 写者位、写者等待位和读者计数
+    state: AtomicU32,
+    data: UnsafeCell<T>,
+}
+
+unsafe impl<T: Send + Sync> Sync for RwLock<T> {}
+unsafe impl<T: Send> Send for RwLock<T> {}
+
+impl<T> RwLock<T> {
+    pub const fn new(data: T) -> Self {
+        Self { state: AtomicU32::new(0), data: UnsafeCell::new(data) }
+    }
+
+    /// 读者能否进入：没有写者；开中断时还要求没有写者在等待
+    #[inline]
+    fn read_blocked(state: u32, ignore_waiting: bool) -> bool {
+        if ignore_waiting {
+            state & WRITER != 0
+        } else {
+            state & (WRITER | WRITER_WAITING) != 0
+        }
+    }
+
+    /// 获取读锁 (read_lock)
+    #[inline]
+    pub fn read(&self) -> RwLockReadGuard<'_, T> {
+        preempt_disable();
+        let ignore_waiting = irqs_disabled();
+        loop {
+            let state = self.state.load(Ordering::Relaxed);
+            if !Self::read_blocked(state, ignore_waiting)
+                && self.state
+                    .compare_exchange_weak(state, state + 1, Ordering::Acquire, Ordering::Relaxed)
+                    .is_ok()
+            {
+                return RwLockReadGuard { lock: self };
+            }
+            core::hint::spin_loop();
+        }
+    }
+
+    /// 尝试获取读锁 (read_trylock)，有写者持有或等待时失败
+    #[inline]
+    pub fn try_read(&self) -> Option<RwLockReadGuard<'_, T>> {
+        preempt_disable();
+        let ignore_waiting = irqs_disabled();
+        let mut state = self.state.load(Ordering::Relaxed);
+        while !Self::read_blocked(state, ignore_waiting) {
+            match self.state.compare_exchange_weak(state, state + 1, Ordering::Acquire, Ordering::Relaxed) {
+                Ok(_) => return Some(RwLockReadGuard { lock: self }),
+                Err(cur) => state = cur,
+            }
+        }
+        preempt_enable();
+        None
+    }
+
+    /// 获取写锁 (write_lock)
+    ///
+    /// 先置等待位挡住新读者，再等已有读者离开
+    #[inline]
+    pub fn write(&self) -> RwLockWriteGuard<'_, T> {
+        preempt_disable();
+        loop {
+            let state = self.state.load(Ordering::Relaxed);
+            if state & !WRITER_WAITING == 0 {
+                // 其他等待的写者下一轮重新置等待位
+                if self.state
+                    .compare_exchange_weak(state, WRITER, Ordering::Acquire, Ordering::Relaxed)
+                    .is_ok()
+                {
+                    return RwLockWriteGuard { lock: self };
+                }
+            } else if state & WRITER_WAITING == 0 {
+                self.state.fetch_or(WRITER_WAITING, Ordering::Relaxed);
+            }
+            core::hint::spin_loop();
+        }
+    }
+
+    /// 尝试获取写锁 (write_trylock)
+    #[inline]
+    pub fn try_write(&self) -> Option<RwLockWriteGuard<'_, T>> {
+        preempt_disable();
+        let state = self.state.load(Ordering::Relaxed);
+        if state & !WRITER_WAITING == 0
+            && self.state
+                .compare_exchange(state, WRITER, Ordering::Acquire, Ordering::Relaxed)
+                .is_ok()
+        {
+            return Some(RwLockWriteGuard { lock: self });
+        }
+        preempt_enable();
+        None
+    }
+
+    /// 当前读者数
+    pub fn reader_count(&self) -> u32 {
+        self.state.load(Ordering::Relaxed) & READER_MASK
+    }
+
+    /// 是否有写者持有
+    pub fn is_write_locked(&self) -> bool {
+        self.state.load(Ordering::Relaxed) & WRITER != 0
+    }
+
+    /// 独占时直接访问数据
+    pub fn get_mut(&mut self) -> &mut T {
+        self.data.get_mut()
+    }
+}
+
+/// 读锁守卫 (read_unlock)
+pub struct RwLockReadGuard<'a, T> {
+    lock: &'a RwLock<T>,
+}
+
+impl<T> Deref for RwLockReadGuard<'_, T> {
+    type Target = T;
+
+    #[inline]
+    fn deref(&self) -> &T {
+        unsafe { &*self.lock.data.get() }
+    }
+}
+
+impl<T> Drop for RwLockReadGuard<'_, T> {
+    #[inline]
+    fn drop(&mut self) {
+        self.lock.state.fetch_sub(1, Ordering::Release);
+        preempt_enable();
+    }
+}
+
+/// 写锁守卫 (write_unlock)
+pub struct RwLockWriteGuard<'a, T> {
+    lock: &'a RwLock<T>,
+}
+
+impl<T> Deref for RwLockWriteGuard<'_, T> {
+    type Target = T;
+
+    #[inline]
+    fn deref(&self) -> &T {
+        unsafe { &*self.lock.data.get() }
+    }
+}
+
+impl<T> DerefMut for RwLockWriteGuard<'_, T> {
+    #[inline]
+    fn deref_mut(&mut self) -> &mut T {
+        unsafe { &mut *self.lock.data.get() }
+    }
+}
+
+impl<T> Drop for RwLockWriteGuard<'_, T> {
+    #[inline]
+    fn drop(&mut self) {
+        // 保留其他写者置的等待位
+        self.lock.state.fetch_and(!WRITER, Ordering::Release);
+        preempt_enable();
+    }
+}
@@ -112,14 +112,14 @@ impl Semaphore {
             };
 
             let entry = crate::process::wait::WaitQueueEntry::new(current, false);
-            self.wait.add(entry);
+            self.wait.add(&entry);
 
             // 让出 CPU
             #[cfg(feature = "riscv64")]
             crate::sched::schedule();
 
             // 被唤醒后，从等待队列移除
-            self.wait.remove(current);
+            self.wait.remove(&entry);
         }
     }
 
@@ -255,154 +255,3 @@ impl Semaphore {
         self.count.load(Ordering::Acquire)
     }
 }
-
-/// 互斥信号量（Mutex）
-///
-/// 二值信号量，初始值为 1，用于互斥访问
-///
-///
-/// # 示例
-/// ```no_run
-/// # use kernel::sync::Mutex;
-/// # fn test(mutex: &Mutex) {
-/// mutex.lock();
-/// // ... 临界区 ...
-/// mutex.unlock();
-/// # }
-/// ```
-#[repr(C)]
-pub struct Mutex {
-    /// 内部信号量
-    sem: Semaphore,
-}
-
-impl Mutex {
-    /// 创建新互斥锁
-    ///
-    /// # 示例
-    /// ```
-    /// let mutex = Mutex::new();
-    /// ```
-    pub const fn new() -> Self {
-        Self {
-            sem: Semaphore::new(1),
-        }
-    }
-
-    /// 获取锁
-    ///
-    /// 如果锁已被占用，则阻塞等待
-    ///
-    /// # 示例
-    /// ```no_run
-    /// # use kernel::sync::Mutex;
-    /// # fn test(mutex: &Mutex) {
-    /// mutex.lock();
-    /// // ... 临界区 ...
-    /// mutex.unlock();
-    /// # }
-    /// ```
-    pub fn lock(&self) {
-        self.sem.down();
-    }
-
-    /// 尝试获取锁（非阻塞）
-    ///
-    /// # 返回
-    /// - `Ok(())` - 成功获取锁
-    /// - `Err(())` - 锁已被占用
-    ///
-    /// # 示例
-    /// ```no_run
-    /// # use kernel::sync::Mutex;
-    /// # fn test(mutex: &Mutex) -> Result<(), ()> {
-    /// match mutex.try_lock() {
-    ///     Ok(()) => {
-    ///         // 成功获取锁
-    ///         // ... 临界区 ...
-    ///         mutex.unlock();
-    ///     }
-    ///     Err(()) => {
-    ///         // 锁已被占用
-    ///     }
-    /// }
-    /// # Ok(())
-    /// # }
-    /// ```
-    pub fn try_lock(&self) -> Result<(), ()> {
-        self.sem.down_trylock()
-    }
-
-    /// 释放锁
-    ///
-    /// # 示例
-    /// ```no_run
-    /// # use kernel::sync::Mutex;
-    /// # fn test(mutex: &Mutex) {
-    /// mutex.lock();
-    /// // ... 临界区 ...
-    /// mutex.unlock();
-    /// # }
-    /// ```
-    pub fn unlock(&self) {
-        self.sem.up();
-    }
-}
-
-/// 互斥锁守护（RAII）
-///
-/// 自动管理锁的生命周期
-///
-/// # 示例
-/// ```no_run
-/// # use kernel::sync::Mutex;
-/// # fn test(mutex: &Mutex) {
-/// {
-///     let _guard = mutex.guard();
-///     // ... 临界区 ...
-/// } // 自动释放锁
-/// # }
-/// ```
-pub struct MutexGuard<'a> {
-    mutex: &'a Mutex,
-}
-
-impl<'a> MutexGuard<'a> {
-    /// 创建锁守护
-    ///
-    /// # 参数
-    /// * `mutex` - 关联的互斥锁
-    pub fn new(mutex: &'a Mutex) -> Self {
-        mutex.lock();
-        Self { mutex }
-    }
-}
-
-impl<'a> Drop for MutexGuard<'a> {
-    fn drop(&mut self) {
-        self.mutex.unlock();
-    }
-}
-
-impl Mutex {
-    /// 获取锁守护（RAII）
-    ///
-    /// 自动管理锁的生命周期，当守护离开作用域时自动释放锁
-    ///
-    /// # 返回
-    /// MutexGuard 守护对象
-    ///
-    /// # 示例
-    /// ```no_run
-    /// # use kernel::sync::Mutex;
-    /// # fn test(mutex: &Mutex) {
-    /// {
-    ///     let _guard = mutex.guard();
-    ///     // ... 临界区 ...
-    /// } // 自动释放锁
-    /// # }
-    /// ```
-    pub fn guard(&self) -> MutexGuard<'_> {
-        MutexGuard::new(self)
-    }
-}
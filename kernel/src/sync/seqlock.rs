@@ -0,0 +1,69 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 顺序锁 (seqlock)
+//!
+//! 完全...
+//! - `include/linux/seqlock.h` - 顺序锁
+//!
+//! 核心概念：
+//! - 写者持自旋锁，修改前后各把序号加一，修改期间序号为奇数
+//! - 读者不加锁、不写共享内存：读序号、复制数据、再读序号，两次相同且为偶数即读到一致的快照，
+//!   否则重试
+//! - 适合读多写少的小块数据；数据必须是 Copy，读者拿到的是副本
+
+use core::cell::UnsafeCell;
+use core::sync::atomic::{fence, AtomicU32, Ordering};
+use spin::Mutex;
+
+/// 顺序锁保护的数据 (seqlock_t)
+pub struct SeqLock<T: Copy> {
+    /// 序号，奇数表示正在写
+    seq: AtomicU32,
+    /// 写者之间互斥
+    lock: Mutex<()>,
+    data: UnsafeCell<T>,
+}
+
+unsafe impl<T: Copy + Send> Sync for SeqLock<T> {}
+
+impl<T: Copy> SeqLock<T> {
+    pub const fn new(data: T) -> Self {
+        Self {
+            seq: AtomicU32::new(0),
+            lock: Mutex::new(()),
+            data: UnsafeCell::new(data),
+        }
+    }
+
+    /// 读取一致的快照 (read_seqbegin / read_seqretry)
+    pub fn read(&self) -> T {
+        loop {
+            let start = self.seq.load(Ordering::Acquire);
+            if start & 1 != 0 {
+                core::hint::spin_loop();
+                continue;
+            }
+            // 写者可能同时在改，读到的副本只在序号未变时使用
+            let value = unsafe { core::ptr::read_volatile(self.data.get()) };
+            fence(Ordering::Acquire);
+            if self.seq.load(Ordering::Relaxed) == start {
+                return value;
+            }
+        }
+    }
+
+    /// 修改数据 (write_seqlock_irqsave / write_sequnlock_irqrestore)
+    ///
+    /// 关中断执行：同一 CPU 上被中断的写者会让中断中的读者永远等待
+    pub fn write<R>(&self, f: impl FnOnce(&mut T) -> R) -> R {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        let _guard = self.lock.lock();
+        self.seq.fetch_add(1, Ordering::Relaxed);
+        fence(Ordering::Release);
+        let ret = f(unsafe { &mut *self.data.get() });
+        self.seq.fetch_add(1, Ordering::Release);
+        ret
+    }
+}
@@ -0,0 +1,496 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 公平自旋锁 (Ticket / Queued Spinlocks)
+//!
+//! 完全...
+//! - `kernel/locking/qspinlock.c` - MCS 排队自旋锁
+//! - `include/linux/spinlock.h` - spin_lock_irqsave
+//! - `kernel/locking/lockdep_proc.c` - /proc/lock_stat
+//!
+//! 核心概念：
+//! - 票据锁：取号 (next) 后等待叫号 (owner)，按到达顺序获得锁；
+//!   所有等待者读同一个字，适合竞争不激烈的锁
+//! - 排队锁：等待者排成 MCS 队列，每个 CPU 只在自己的队列节点上自旋，
+//!   只有队首读锁字，释放锁不会让所有等待者的缓存行失效。
+//!   队列节点只在等待期间使用（关中断），拿到锁后交给下一个等待者，
+//!   所以每个 CPU 一个节点就够了，释放只需清除锁字
+//! - lock_irqsave 先关中断再加锁，中断处理程序也会获取的锁必须用它
+//! - 带锁类 (LockClass) 的锁在统计打开时记录获取次数、竞争次数、
+//!   自旋次数和最长持有周期，由 /proc/lock_stat 导出
+
+use core::cell::UnsafeCell;
+use core::fmt::Write;
+use core::ops::{Deref, DerefMut};
+use core::ptr;
+use core::sync::atomic::{AtomicBool, AtomicPtr, AtomicU32, AtomicU64, Ordering};
+
+use alloc::string::String;
+
+use crate::arch::context::InterruptGuard;
+use crate::config::MAX_CPUS;
+use crate::sched::preempt::{preempt_disable, preempt_enable};
+
+/// 底层锁操作 (arch_spinlock_t)
+pub trait RawSpinLock {
+    /// 未加锁的初始值
+    const INIT: Self;
+
+    /// 获取锁，返回等待期间自旋的次数
+    fn lock(&self) -> u64;
+
+    /// 尝试获取锁，不等待
+    fn try_lock(&self) -> bool;
+
+    /// 释放锁
+    ///
+    /// # Safety
+    /// 调用者必须持有锁
+    unsafe fn unlock(&self);
+
+    /// 锁是否被持有
+    fn is_locked(&self) -> bool;
+}
+
+// ============================================================================
+// 票据锁
+// ============================================================================
+
+/// 票据锁 (arch_spinlock_t 的 ticket 实现)
+pub struct RawTicketLock {
+    /// 下一个取到的号
+    next: AtomicU32,
+    /// 正在服务的号
+    owner: AtomicU32,
+}
+
+impl RawSpinLock for RawTicketLock {
+    const INIT: Self = Self { next: AtomicU32::new(0), owner: AtomicU32::new(0) };
+
+    #[inline]
+    fn lock(&self) -> u64 {
+        let ticket = self.next.fetch_add(1, Ordering::Relaxed);
+        let mut spins = 0;
+        while self.owner.load(Ordering::Acquire) != ticket {
+            core::hint::spin_loop();
+            spins += 1;
+        }
+        spins
+    }
+
+    #[inline]
+    fn try_lock(&self) -> bool {
+        let owner = self.owner.load(Ordering::Acquire);
+        self.next
+            .compare_exchange(owner, owner.wrapping_add(1), Ordering::Acquire, Ordering::Relaxed)
+            .is_ok()
+    }
+
+    #[inline]
+    unsafe fn unlock(&self) {
+        // 只有持有者修改 owner
+        let owner = self.owner.load(Ordering::Relaxed);
+        self.owner.store(owner.wrapping_add(1), Ordering::Release);
+    }
+
+    #[inline]
+    fn is_locked(&self) -> bool {
+        self.next.load(Ordering::Relaxed) != self.owner.load(Ordering::Relaxed)
+    }
+}
+
+// ============================================================================
+// MCS 排队锁
+// ============================================================================
+
+/// MCS 队列节点 (struct mcs_spinlock)，独占一个缓存行
+#[repr(align(64))]
+struct McsNode {
+    next: AtomicPtr<McsNode>,
+    /// 前一个等待者把队首交给本节点时置位
+    locked: AtomicBool,
+}
+
+/// 各 CPU 的队列节点 (qnodes)，只在关中断等待锁时使用
+static MCS_NODES: [McsNode; MAX_CPUS] = [const {
+    McsNode { next: AtomicPtr::new(ptr::null_mut()), locked: AtomicBool::new(false) }
+}; MAX_CPUS];
+
+/// 排队自旋锁 (struct qspinlock)
+pub struct RawMcsLock {
+    /// 锁字
+    locked: AtomicBool,
+    /// 等待队列的队尾
+    tail: AtomicPtr<McsNode>,
+}
+
+impl RawMcsLock {
+    /// 有竞争时排队等待 (queued_spin_lock_slowpath)
+    #[cold]
+    fn lock_slowpath(&self) -> u64 {
+        let _irq = unsafe { InterruptGuard::new() };
+        let cpu = crate::arch::cpu_id() as usize % MAX_CPUS;
+        let node = &MCS_NODES[cpu];
+        let node_ptr = node as *const McsNode as *mut McsNode;
+        node.next.store(ptr::null_mut(), Ordering::Relaxed);
+        node.locked.store(false, Ordering::Relaxed);
+
+        let mut spins = 0;
+        let prev = self.tail.swap(node_ptr, Ordering::AcqRel);
+        if !prev.is_null() {
+            // 排在 prev 之后，只在自己的节点上自旋
+            unsafe { (*prev).next.store(node_ptr, Ordering::Release) };
+            while !node.locked.load(Ordering::Acquire) {
+                core::hint::spin_loop();
+                spins += 1;
+            }
+        }
+
+        // 成为队首：等待持有者释放锁
+        loop {
+            if !self.locked.load(Ordering::Relaxed)
+                && self.locked
+                    .compare_exchange_weak(false, true, Ordering::Acquire, Ordering::Relaxed)
+                    .is_ok()
+            {
+                break;
+            }
+            core::hint::spin_loop();
+            spins += 1;
+        }
+
+        // 拿到锁后节点不再需要：队列里只有自己时清空队尾，否则把队首交给后继
+        if self.tail
+            .compare_exchange(node_ptr, ptr::null_mut(), Ordering::Release, Ordering::Relaxed)
+            .is_err()
+        {
+            let next = loop {
+                let next = node.next.load(Ordering::Acquire);
+                if !next.is_null() {
+                    break next;
+                }
+                core::hint::spin_loop();
+            };
+            unsafe { (*next).locked.store(true, Ordering::Release) };
+        }
+        spins
+    }
+}
+
+impl RawSpinLock for RawMcsLock {
+    const INIT: Self = Self { locked: AtomicBool::new(false), tail: AtomicPtr::new(ptr::null_mut()) };
+
+    #[inline]
+    fn lock(&self) -> u64 {
+        // 没有等待者时直接获取；有等待者时排队，不插队
+        if self.tail.load(Ordering::Relaxed).is_null() && self.try_lock() {
+            return 0;
+        }
+        self.lock_slowpath()
+    }
+
+    #[inline]
+    fn try_lock(&self) -> bool {
+        self.locked
+            .compare_exchange(false, true, Ordering::Acquire, Ordering::Relaxed)
+            .is_ok()
+    }
+
+    #[inline]
+    unsafe fn unlock(&self) {
+        self.locked.store(false, Ordering::Release);
+    }
+
+    #[inline]
+    fn is_locked(&self) -> bool {
+        self.locked.load(Ordering::Relaxed)
+    }
+}
+
+// ============================================================================
+// 锁统计
+// ============================================================================
+
+/// 最多统计的锁类数
+const MAX_LOCK_CLASSES: usize = 32;
+
+/// 锁类 (struct lock_class)：同一用途的锁共享一份统计
+pub struct LockClass {
+    name: &'static str,
+    registered: AtomicBool,
+    /// 获取次数
+    acquisitions: AtomicU64,
+    /// 需要等待的获取次数
+    contended: AtomicU64,
+    /// 总自旋次数
+    spins: AtomicU64,
+    /// 最长持有周期数
+    max_hold: AtomicU64,
+    /// 总持有周期数
+    total_hold: AtomicU64,
+}
+
+impl LockClass {
+    pub const fn new(name: &'static str) -> Self {
+        Self {
+            name,
+            registered: AtomicBool::new(false),
+            acquisitions: AtomicU64::new(0),
+            contended: AtomicU64::new(0),
+            spins: AtomicU64::new(0),
+            max_hold: AtomicU64::new(0),
+            total_hold: AtomicU64::new(0),
+        }
+    }
+
+    /// 第一次记录时加入 /proc/lock_stat (register_lock_class)
+    fn register(&'static self) {
+        if self.registered.swap(true, Ordering::Relaxed) {
+            return;
+        }
+        let class = self as *const LockClass as *mut LockClass;
+        for slot in LOCK_CLASSES.iter() {
+            if slot.compare_exchange(ptr::null_mut(), class, Ordering::Release, Ordering::Relaxed).is_ok() {
+                return;
+            }
+        }
+    }
+
+    fn record_acquire(&'static self, spins: u64) {
+        self.register();
+        self.acquisitions.fetch_add(1, Ordering::Relaxed);
+        if spins != 0 {
+            self.contended.fetch_add(1, Ordering::Relaxed);
+            self.spins.fetch_add(spins, Ordering::Relaxed);
+        }
+    }
+
+    fn record_hold(&self, cycles: u64) {
+        self.max_hold.fetch_max(cycles, Ordering::Relaxed);
+        self.total_hold.fetch_add(cycles, Ordering::Relaxed);
+    }
+
+    fn reset(&self) {
+        for counter in [&self.acquisitions, &self.contended, &self.spins, &self.max_hold, &self.total_hold] {
+            counter.store(0, Ordering::Relaxed);
+        }
+    }
+
+    /// (获取次数, 竞争次数, 自旋次数, 最长持有周期)
+    pub fn stat(&self) -> (u64, u64, u64, u64) {
+        (
+            self.acquisitions.load(Ordering::Relaxed),
+            self.contended.load(Ordering::Relaxed),
+            self.spins.load(Ordering::Relaxed),
+            self.max_hold.load(Ordering::Relaxed),
+        )
+    }
+}
+
+/// 已注册的锁类
+static LOCK_CLASSES: [AtomicPtr<LockClass>; MAX_LOCK_CLASSES] =
+    [const { AtomicPtr::new(ptr::null_mut()) }; MAX_LOCK_CLASSES];
+
+/// 统计开关 (lock_stat)
+static STAT_ENABLED: AtomicBool = AtomicBool::new(false);
+
+/// 统计是否打开
+#[inline]
+pub fn lock_stat_enabled() -> bool {
+    STAT_ENABLED.load(Ordering::Relaxed)
+}
+
+/// 打开或关闭统计
+pub fn set_lock_stat(on: bool) {
+    STAT_ENABLED.store(on, Ordering::Relaxed);
+}
+
+/// 清零所有锁类的统计
+pub fn reset_lock_stat() {
+    for slot in LOCK_CLASSES.iter() {
+        let class = slot.load(Ordering::Acquire);
+        if !class.is_null() {
+            unsafe { (*class).reset() };
+        }
+    }
+}
+
+/// 生成 /proc/lock_stat 内容
+pub fn generate_lock_stat() -> String {
+    let mut out = String::new();
+    let _ = writeln!(out, "enabled {}", lock_stat_enabled() as u8);
+    let _ = writeln!(out, "{:<20} {:>12} {:>10} {:>12} {:>12} {:>12}",
+                     "class", "acquisitions", "contended", "spins", "max_hold", "avg_hold");
+    for slot in LOCK_CLASSES.iter() {
+        let class = slot.load(Ordering::Acquire);
+        if class.is_null() {
+            continue;
+        }
+        let class = unsafe { &*class };
+        let (acquisitions, contended, spins, max_hold) = class.stat();
+        let avg_hold = class.total_hold.load(Ordering::Relaxed) / acquisitions.max(1);
+        let _ = writeln!(out, "{:<20} {:>12} {:>10} {:>12} {:>12} {:>12}",
+                         class.name, acquisitions, contended, spins, max_hold, avg_hold);
+    }
+    out
+}
+
+/// /proc/lock_stat 写入：`1` 打开、`0` 关闭、`reset` 清零
+pub fn write_lock_stat(data: &[u8]) -> Result<usize, i32> {
+    match core::str::from_utf8(data).map(|s| s.trim()) {
+        Ok("1") => set_lock_stat(true),
+        Ok("0") => set_lock_stat(false),
+        Ok("reset") => reset_lock_stat(),
+        _ => return Err(crate::errno::Errno::InvalidArgument.as_neg_i32()),
+    }
+    Ok(data.len())
+}
+
+// ============================================================================
+// 自旋锁
+// ============================================================================
+
+/// 保护数据的自旋锁 (spinlock_t)
+pub struct SpinLock<T, R: RawSpinLock> {
+    raw: R,
+    class: Option<&'static LockClass>,
+    /// 获取锁时的周期数，统计打开时用于计算持有时间
+    acquired_at: AtomicU64,
+    data: UnsafeCell<T>,
+}
+
+/// 票据锁
+pub type TicketLock<T> = SpinLock<T, RawTicketLock>;
+
+/// MCS 排队锁
+pub type QueuedSpinLock<T> = SpinLock<T, RawMcsLock>;
+
+unsafe impl<T: Send, R: RawSpinLock> Sync for SpinLock<T, R> {}
+unsafe impl<T: Send, R: RawSpinLock> Send for SpinLock<T, R> {}
+
+impl<T, R: RawSpinLock> SpinLock<T, R> {
+    pub const fn new(data: T) -> Self {
+        Self { raw: R::INIT, class: None, acquired_at: AtomicU64::new(0), data: UnsafeCell::new(data) }
+    }
+
+    /// 创建记录统计的锁
+    pub const fn with_class(data: T, class: &'static LockClass) -> Self {
+        Self { raw: R::INIT, class: Some(class), acquired_at: AtomicU64::new(0), data: UnsafeCell::new(data) }
+    }
+
+    /// 获取锁 (spin_lock)，持有期间禁止抢占
+    #[inline]
+    pub fn lock(&self) -> SpinLockGuard<'_, T, R> {
+        preempt_disable();
+        let spins = self.raw.lock();
+        self.acquired(spins);
+        SpinLockGuard { lock: self }
+    }
+
+    /// 尝试获取锁 (spin_trylock)
+    #[inline]
+    pub fn try_lock(&self) -> Option<SpinLockGuard<'_, T, R>> {
+        preempt_disable();
+        if !self.raw.try_lock() {
+            preempt_enable();
+            return None;
+        }
+        self.acquired(0);
+        Some(SpinLockGuard { lock: self })
+    }
+
+    /// 关中断后获取锁 (spin_lock_irqsave)，守卫释放锁后恢复中断状态
+    #[inline]
+    pub fn lock_irqsave(&self) -> SpinLockIrqGuard<'_, T, R> {
+        let irq = unsafe { InterruptGuard::new() };
+        SpinLockIrqGuard { guard: self.lock(), _irq: irq }
+    }
+
+    /// 锁是否被持有
+    #[inline]
+    pub fn is_locked(&self) -> bool {
+        self.raw.is_locked()
+    }
+
+    /// 独占时直接访问数据
+    #[inline]
+    pub fn get_mut(&mut self) -> &mut T {
+        self.data.get_mut()
+    }
+
+    #[inline]
+    fn acquired(&self, spins: u64) {
+        if let Some(class) = self.class {
+            if lock_stat_enabled() {
+                class.record_acquire(spins);
+                self.acquired_at.store(crate::arch::riscv64::syscall_stats::rdcycle(), Ordering::Relaxed);
+            }
+        }
+    }
+
+    #[inline]
+    fn release(&self) {
+        if let Some(class) = self.class {
+            // 统计在持有期间打开时没有起始时间，不记录
+            let start = self.acquired_at.swap(0, Ordering::Relaxed);
+            if start != 0 {
+                class.record_hold(crate::arch::riscv64::syscall_stats::rdcycle().wrapping_sub(start));
+            }
+        }
+        unsafe { self.raw.unlock() };
+        preempt_enable();
+    }
+}
+
+/// 自旋锁守卫，drop 时释放锁 (spin_unlock)
+pub struct SpinLockGuard<'a, T, R: RawSpinLock> {
+    lock: &'a SpinLock<T, R>,
+}
+
+impl<T, R: RawSpinLock> Deref for SpinLockGuard<'_, T, R> {
+    type Target = T;
+
+    #[inline]
+    fn deref(&self) -> &T {
+        unsafe { &*self.lock.data.get() }
+    }
+}
+
+impl<T, R: RawSpinLock> DerefMut for SpinLockGuard<'_, T, R> {
+    #[inline]
+    fn deref_mut(&mut self) -> &mut T {
+        unsafe { &mut *self.lock.data.get() }
+    }
+}
+
+impl<T, R: RawSpinLock> Drop for SpinLockGuard<'_, T, R> {
+    #[inline]
+    fn drop(&mut self) {
+        self.lock.release();
+    }
+}
+
+/// 关中断的自旋锁守卫 (spin_unlock_irqrestore)
+///
+/// 字段按声明顺序释放：先释放锁，再恢复中断
+pub struct SpinLockIrqGuard<'a, T, R: RawSpinLock> {
+    guard: SpinLockGuard<'a, T, R>,
+    _irq: InterruptGuard,
+}
+
+impl<T, R: RawSpinLock> Deref for SpinLockIrqGuard<'_, T, R> {
+    type Target = T;
+
+    #[inline]
+    fn deref(&self) -> &T {
+        &self.guard
+    }
+}
+
+impl<T, R: RawSpinLock> DerefMut for SpinLockIrqGuard<'_, T, R> {
+    #[inline]
+    fn deref_mut(&mut self) -> &mut T {
+        &mut self.guard
+    }
+}
@@ -0,0 +1,144 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：ARP 邻居缓存
+//
+// 测试内容：
+// 1. 缓存更新、查找与删除
+// 2. 条目超过容量时按桶替换，最新的条目仍可查到
+// 3. 按 jiffies 老化：Reachable -> Stale -> 删除
+// 4. 未解析的包排队等待，请求发满仍无响应时丢弃
+// 5. 收到 ARP 响应后发出排队的包
+
+use crate::println;
+use crate::config::ARP_CACHE_SIZE;
+use crate::drivers::timer::get_jiffies;
+use crate::net::arp::{
+    arp_cache_len, arp_clear, arp_lookup, arp_pending_len, arp_periodic, arp_rcv, arp_remove, arp_resolve_output,
+    arp_state, arp_update, ArpHdr, ArpHrd, ArpOp, ArpPacket, ArpPro, ArpState, ARP_GC_STALETIME, ARP_REACHABLE_TIME,
+    ARP_RETRANS_TIME, ARP_UNRES_QLEN,
+};
+use crate::net::buffer::alloc_skb;
+use crate::net::ethernet::{EthHdr, ETH_ALEN, ETH_BROADCAST};
+use crate::net::ipv4::INADDR_LOCAL;
+
+/// 测试用的邻居地址
+const NEIGH_IP: u32 = 0xC0A8014D; // 192.168.1.77
+const NEIGH_MAC: [u8; ETH_ALEN] = [0x02, 0x00, 0x00, 0x00, 0x00, 0x4D];
+
+pub fn test_arp() {
+    println!("test: ===== Testing ARP Neighbour Cache =====");
+    arp_clear();
+
+    // 测试 1: 基本操作
+    println!("test: 1. Testing update, lookup and remove...");
+    assert_eq!(arp_lookup(NEIGH_IP), None);
+    arp_update(NEIGH_IP, NEIGH_MAC);
+    assert_eq!(arp_lookup(NEIGH_IP), Some(NEIGH_MAC));
+    assert_eq!(arp_state(NEIGH_IP), ArpState::Reachable);
+    let new_mac = [0x02, 0, 0, 0, 0, 0x4E];
+    arp_update(NEIGH_IP, new_mac);
+    assert_eq!(arp_lookup(NEIGH_IP), Some(new_mac));
+    assert_eq!(arp_cache_len(), 1);
+    arp_remove(NEIGH_IP);
+    assert_eq!(arp_lookup(NEIGH_IP), None);
+    assert_eq!(arp_cache_len(), 0);
+    println!("test:    SUCCESS - entries updated, found and removed");
+
+    // 测试 2: 替换
+    println!("test: 2. Testing bucket replacement...");
+    let n = ARP_CACHE_SIZE as u32 * 2;
+    for i in 0..n {
+        arp_update(0x0A000000 + i, [0x02, 0, 0, 0, (i >> 8) as u8, i as u8]);
+    }
+    assert!(arp_cache_len() <= ARP_CACHE_SIZE);
+    assert_eq!(arp_lookup(0x0A000000 + n - 1), Some([0x02, 0, 0, 0, ((n - 1) >> 8) as u8, (n - 1) as u8]));
+    arp_clear();
+    assert_eq!(arp_cache_len(), 0);
+    println!("test:    SUCCESS - at most {} of {} entries kept", ARP_CACHE_SIZE, n);
+
+    // 测试 3: 老化
+    println!("test: 3. Testing entry aging...");
+    arp_update(NEIGH_IP, NEIGH_MAC);
+    let now = get_jiffies();
+    arp_periodic(now + ARP_REACHABLE_TIME - 1);
+    assert_eq!(arp_state(NEIGH_IP), ArpState::Reachable);
+    arp_periodic(now + ARP_REACHABLE_TIME);
+    assert_eq!(arp_state(NEIGH_IP), ArpState::Stale);
+    // Stale 条目仍可用于发送
+    assert_eq!(arp_lookup(NEIGH_IP), Some(NEIGH_MAC));
+    arp_periodic(now + ARP_REACHABLE_TIME + ARP_GC_STALETIME);
+    assert_eq!(arp_state(NEIGH_IP), ArpState::None);
+    assert_eq!(arp_lookup(NEIGH_IP), None);
+    println!("test:    SUCCESS - Reachable -> Stale -> removed");
+
+    // 测试 4: 解析失败
+    println!("test: 4. Testing unresolved queue and failure...");
+    for _ in 0..ARP_UNRES_QLEN + 2 {
+        assert!(arp_resolve_output(dummy_skb(), NEIGH_IP).is_ok());
+    }
+    assert_eq!(arp_state(NEIGH_IP), ArpState::Incomplete);
+    assert_eq!(arp_pending_len(NEIGH_IP), ARP_UNRES_QLEN);
+    let mut t = get_jiffies();
+    // 第一个请求在入队时发出，之后每个重发间隔再发一个
+    for _ in 0..2 {
+        t += ARP_RETRANS_TIME;
+        arp_periodic(t);
+        assert_eq!(arp_state(NEIGH_IP), ArpState::Incomplete);
+    }
+    t += ARP_RETRANS_TIME;
+    arp_periodic(t);
+    assert_eq!(arp_state(NEIGH_IP), ArpState::None);
+    assert_eq!(arp_pending_len(NEIGH_IP), 0);
+    println!("test:    SUCCESS - queue capped at {} and dropped after retries", ARP_UNRES_QLEN);
+
+    // 测试 5: 收到响应
+    println!("test: 5. Testing resolution by ARP reply...");
+    assert!(arp_resolve_output(dummy_skb(), NEIGH_IP).is_ok());
+    assert!(arp_resolve_output(dummy_skb(), NEIGH_IP).is_ok());
+    assert_eq!(arp_pending_len(NEIGH_IP), 2);
+    rcv_arp(ArpOp::ARPOP_REPLY, NEIGH_IP, NEIGH_MAC, INADDR_LOCAL);
+    assert_eq!(arp_state(NEIGH_IP), ArpState::Reachable);
+    assert_eq!(arp_lookup(NEIGH_IP), Some(NEIGH_MAC));
+    assert_eq!(arp_pending_len(NEIGH_IP), 0);
+    // 不是发给本机的请求只更新已有条目，不新建
+    rcv_arp(ArpOp::ARPOP_REQUEST, NEIGH_IP + 1, NEIGH_MAC, NEIGH_IP);
+    assert_eq!(arp_lookup(NEIGH_IP + 1), None);
+    arp_clear();
+    println!("test:    SUCCESS - queued packets sent after reply");
+
+    println!("test: ARP neighbour cache testing completed.");
+}
+
+/// 等待解析的 IP 包（只有一个空的 IP 头）
+fn dummy_skb() -> crate::net::buffer::SkBuff {
+    let mut skb = alloc_skb(64).expect("skb alloc");
+    skb.skb_reserve(16).expect("skb reserve");
+    skb.skb_put_data(&[0u8; 20]).expect("skb put");
+    skb
+}
+
+/// 构造对端发来的 ARP 报文，经 arp_rcv 处理
+fn rcv_arp(op: ArpOp, sender_ip: u32, sender_mac: [u8; ETH_ALEN], target_ip: u32) {
+    let pkt = ArpPacket {
+        hdr: ArpHdr {
+            ar_hrd: (ArpHrd::ARPHRD_ETHER as u16).to_be(),
+            ar_pro: (ArpPro::ARPPROTO_IP as u16).to_be(),
+            ar_hln: ETH_ALEN as u8,
+            ar_pln: 4,
+            ar_op: (op as u16).to_be(),
+        },
+        ar_sha: sender_mac,
+        ar_sip: sender_ip.to_be(),
+        ar_tha: [0; ETH_ALEN],
+        ar_tip: target_ip.to_be(),
+    };
+    let bytes = unsafe { core::slice::from_raw_parts(&pkt as *const ArpPacket as *const u8, ArpPacket::LEN) };
+    let mut skb = alloc_skb(64).expect("skb alloc");
+    skb.skb_put_data(bytes).expect("skb put");
+    let eth_hdr = EthHdr { h_dest: ETH_BROADCAST, h_source: sender_mac, h_proto: 0x0806u16.to_be() };
+    assert!(arp_rcv(&skb, &eth_hdr).is_ok());
+    skb.free();
+}
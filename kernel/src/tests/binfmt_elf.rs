@@ -0,0 +1,166 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：exec 的 ELF 段映射
+//
+// 测试内容：
+// 1. 经页缓存读出 ELF 头和程序头
+// 2. 对齐的段是私有文件映射，缺页映射页缓存中的页
+// 3. 段末页的 BSS 部分清零，页缓存内容不变
+// 4. 页内偏移不一致的段退回到复制
+
+use alloc::sync::Arc;
+use alloc::vec;
+use alloc::vec::Vec;
+use crate::println;
+use crate::arch::riscv64::mm::{create_user_address_space, handle_mm_fault, AddressSpace, FaultFlags,
+                               MmFaultResult, VirtAddr};
+use crate::fs::binfmt_elf::{elf_map, load_elf_phdrs};
+use crate::fs::elf::{Elf64Ehdr, Elf64Phdr, ElfPtType, PF_R, PF_W, PF_X};
+use crate::mm::filemap::{self, MappingSource};
+use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+use crate::mm::pagemap::PageTableType;
+use crate::mm::vma::VmaType;
+
+const ENOEXEC: i32 = -8;
+
+/// 文件内容（头之外的字节为 FILL）
+const FILL: u8 = 0xab;
+const FILE_SIZE: usize = 3 * PAGE_SIZE;
+const ENTRY: u64 = 0x10040;
+
+/// 内存中的测试文件
+struct MemFile {
+    data: Vec<u8>,
+}
+
+impl MappingSource for MemFile {
+    fn size(&self) -> usize {
+        self.data.len()
+    }
+
+    fn read_page(&self, index: usize, buf: &mut [u8]) -> usize {
+        let start = (index * PAGE_SIZE).min(self.data.len());
+        let len = (self.data.len() - start).min(buf.len());
+        buf[..len].copy_from_slice(&self.data[start..start + len]);
+        len
+    }
+}
+
+fn load(offset: u64, vaddr: u64, filesz: u64, memsz: u64, flags: u32) -> Elf64Phdr {
+    Elf64Phdr {
+        p_type: ElfPtType::PT_LOAD as u32,
+        p_flags: flags,
+        p_offset: offset,
+        p_vaddr: vaddr,
+        p_paddr: vaddr,
+        p_filesz: filesz,
+        p_memsz: memsz,
+        p_align: PAGE_SIZE as u64,
+    }
+}
+
+/// 构造测试用 ELF：代码段、带 BSS 的数据段、页内偏移不一致的只读段
+fn build_elf() -> Vec<u8> {
+    let phdrs = [
+        load(0, 0x10000, 0x1800, 0x1800, PF_R | PF_X),
+        load(0x2100, 0x13100, 0x200, 0x3000, PF_R | PF_W),
+        load(0x2400, 0x20000, 0x10, 0x10, PF_R),
+    ];
+    let mut e_ident = [0u8; 16];
+    e_ident[..8].copy_from_slice(&[0x7f, b'E', b'L', b'F', 2, 1, 1, 0]);
+    let ehdr = Elf64Ehdr {
+        e_ident,
+        e_type: 2,        // ET_EXEC
+        e_machine: 243,   // EM_RISCV
+        e_version: 1,
+        e_entry: ENTRY,
+        e_phoff: core::mem::size_of::<Elf64Ehdr>() as u64,
+        e_shoff: 0,
+        e_flags: 0,
+        e_ehsize: core::mem::size_of::<Elf64Ehdr>() as u16,
+        e_phentsize: core::mem::size_of::<Elf64Phdr>() as u16,
+        e_phnum: phdrs.len() as u16,
+        e_shentsize: 0,
+        e_shnum: 0,
+        e_shstrndx: 0,
+    };
+
+    let mut data = vec![FILL; FILE_SIZE];
+    unsafe {
+        core::ptr::write_unaligned(data.as_mut_ptr() as *mut Elf64Ehdr, ehdr);
+        let phdr_ptr = data.as_mut_ptr().add(ehdr.e_phoff as usize) as *mut Elf64Phdr;
+        for (i, phdr) in phdrs.iter().enumerate() {
+            core::ptr::write_unaligned(phdr_ptr.add(i), *phdr);
+        }
+    }
+    data
+}
+
+fn phys_of(aspace: &AddressSpace, addr: usize) -> usize {
+    aspace.translate(PageVirtAddr::new(addr)).expect("page not mapped").as_usize() + addr % PAGE_SIZE
+}
+
+pub fn test_binfmt_elf() {
+    println!("test: ===== Testing ELF Segment Mapping =====");
+
+    const TEST_INO: u64 = u64::MAX - 21;
+    const BAD_INO: u64 = u64::MAX - 22;
+
+    // 测试 1: 读出头部
+    println!("test: 1. Testing ELF header read...");
+    let mapping = filemap::get_mapping(TEST_INO, Arc::new(MemFile { data: build_elf() }));
+    let bin = load_elf_phdrs(mapping.clone()).expect("load_elf_phdrs failed");
+    assert_eq!(bin.ehdr.e_entry, ENTRY);
+    assert_eq!(bin.load_segments().count(), 3);
+    let bad = filemap::get_mapping(BAD_INO, Arc::new(MemFile { data: vec![FILL; PAGE_SIZE] }));
+    assert_eq!(load_elf_phdrs(bad).err(), Some(ENOEXEC));
+    println!("test:    SUCCESS - headers read through the page cache");
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new_with_type(root_ppn, PageTableType::User) };
+    let image_end = elf_map(&aspace, &bin, 0).expect("elf_map failed");
+    assert_eq!(image_end, 0x21000);
+
+    // 测试 2: 代码段映射页缓存
+    println!("test: 2. Testing file-backed text segment...");
+    let text = aspace.find_vma(PageVirtAddr::new(0x10000)).expect("text VMA missing");
+    assert_eq!(text.vma_type(), VmaType::FileBacked);
+    assert!(!aspace.is_mapped(PageVirtAddr::new(0x11000)));
+    assert_eq!(handle_mm_fault(&aspace, VirtAddr::new(0x11000), FaultFlags::READ | FaultFlags::USER),
+               MmFaultResult::Handled);
+    assert_eq!(aspace.translate(PageVirtAddr::new(0x11000)).unwrap().as_usize(),
+               mapping.find_page(1).expect("page not cached"));
+    println!("test:    SUCCESS - text pages come from the page cache");
+
+    // 测试 3: 数据段末页清零，BSS 为匿名映射
+    println!("test: 3. Testing data segment and BSS...");
+    let data = phys_of(&aspace, 0x13100);
+    let page = unsafe { core::slice::from_raw_parts(data as *const u8, PAGE_SIZE - 0x100) };
+    assert!(page[..0x200].iter().all(|&b| b == FILL));
+    assert!(page[0x200..].iter().all(|&b| b == 0), "BSS in the last file page not zeroed");
+    let cached = mapping.find_page(2).expect("page not cached");
+    assert_eq!(unsafe { *((cached + 0x300) as *const u8) }, FILL, "page cache modified");
+    let bss = aspace.find_vma(PageVirtAddr::new(0x14000)).expect("BSS VMA missing");
+    assert_eq!(bss.vma_type(), VmaType::Anonymous);
+    assert_eq!(bss.end().as_usize(), 0x17000);
+    assert!(!aspace.is_mapped(PageVirtAddr::new(0x14000)));
+    println!("test:    SUCCESS - BSS zeroed without touching the page cache");
+
+    // 测试 4: 页内偏移不一致的段
+    println!("test: 4. Testing misaligned segment copy...");
+    let copied = phys_of(&aspace, 0x20000);
+    assert_eq!(unsafe { *(copied as *const u8) }, FILL);
+    assert_eq!(unsafe { *((copied + 0x10) as *const u8) }, 0);
+    println!("test:    SUCCESS - misaligned segment copied from the page cache");
+
+    println!("test: ELF segment mapping testing completed.");
+}
@@ -0,0 +1,201 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 块层请求队列测试
+//!
+//! 用内存盘作为驱动：plug 中相邻的 bio 合并为一个请求，读写结果与逐扇区读写一致
+
+use crate::println;
+use crate::drivers::blkdev::{self, BlkPlug, GenDisk, ReqCmd, Request};
+use spin::Mutex;
+
+/// 内存盘：64 个扇区
+static RAMDISK: Mutex<[u8; 64 * 512]> = Mutex::new([0; 64 * 512]);
+
+/// 驱动收到的请求数
+static NR_REQUESTS: Mutex<usize> = Mutex::new(0);
+
+/// 驱动收到的分散/聚集请求数
+static NR_SG_REQUESTS: Mutex<usize> = Mutex::new(0);
+
+/// 驱动收到的 Discard / WriteZeroes 请求数
+static NR_RANGE_REQUESTS: Mutex<usize> = Mutex::new(0);
+
+unsafe extern "C" fn ramdisk_request(req: &mut Request) {
+    let mut disk = RAMDISK.lock();
+    let start = req.sector as usize * 512;
+    let len = if matches!(req.cmd_type, ReqCmd::Discard | ReqCmd::WriteZeroes) {
+        req.nr_sectors as usize * 512
+    } else if req.sg.is_empty() {
+        req.buffer.len()
+    } else {
+        req.sg.iter().map(|&(_, len)| len).sum()
+    };
+    let end = start + len;
+    let ret = if end > disk.len() {
+        -5  // EIO
+    } else if req.sg.is_empty() {
+        match req.cmd_type {
+            ReqCmd::Read => req.buffer.copy_from_slice(&disk[start..end]),
+            ReqCmd::Write => disk[start..end].copy_from_slice(&req.buffer),
+            ReqCmd::Flush => {}
+            // 内存盘丢弃后读出 0
+            ReqCmd::Discard | ReqCmd::WriteZeroes => {
+                disk[start..end].fill(0);
+                *NR_RANGE_REQUESTS.lock() += 1;
+            }
+        }
+        0
+    } else {
+        let mut off = start;
+        for &(addr, len) in &req.sg {
+            let seg = core::slice::from_raw_parts_mut(addr as *mut u8, len);
+            match req.cmd_type {
+                ReqCmd::Read => seg.copy_from_slice(&disk[off..off + len]),
+                ReqCmd::Write => disk[off..off + len].copy_from_slice(seg),
+                ReqCmd::Flush | ReqCmd::Discard | ReqCmd::WriteZeroes => {}
+            }
+            off += len;
+        }
+        *NR_SG_REQUESTS.lock() += 1;
+        0
+    };
+    *NR_REQUESTS.lock() += 1;
+    if let Some(end_io) = req.end_io {
+        end_io(req, ret);
+    }
+}
+
+pub fn test_blk_mq() {
+    println!("test: ===== Starting blk-mq Tests =====");
+
+    let mut disk = GenDisk::new("ram0", 250, 1, 512, None);
+    disk.set_capacity(64);
+    disk.set_request_fn(ramdisk_request);
+
+    // 1. plug 中逆序提交的相邻写合并为一个请求
+    println!("test: 1. Testing plugged write merging...");
+    let bufs: [[u8; 512]; 4] = [[1; 512], [2; 512], [3; 512], [4; 512]];
+    *NR_REQUESTS.lock() = 0;
+    {
+        let mut plug = BlkPlug::new(&disk);
+        for i in (0..4).rev() {
+            plug.write(8 + i as u64, &bufs[i]);
+        }
+        assert!(plug.finish().is_ok());
+    }
+    assert_eq!(*NR_REQUESTS.lock(), 1);
+    let (_, merged, _) = disk.queue.stats();
+    assert_eq!(merged, 3);
+    println!("test:    SUCCESS - four adjacent bios became one request");
+
+    // 2. 合并的读把数据分散回各个缓冲区
+    println!("test: 2. Testing merged read scatter...");
+    let mut a = [0u8; 1024];
+    let mut b = [0u8; 1024];
+    *NR_REQUESTS.lock() = 0;
+    {
+        let mut plug = BlkPlug::new(&disk);
+        plug.read(10, &mut b);
+        plug.read(8, &mut a);
+        assert!(plug.finish().is_ok());
+    }
+    assert_eq!(*NR_REQUESTS.lock(), 1);
+    assert!(a[..512].iter().all(|&x| x == 1) && a[512..].iter().all(|&x| x == 2));
+    assert!(b[..512].iter().all(|&x| x == 3) && b[512..].iter().all(|&x| x == 4));
+    println!("test:    SUCCESS - each bio gets its own sectors");
+
+    // 3. 不相邻的请求不合并，驱动错误返回给提交者
+    println!("test: 3. Testing non-contiguous bios and errors...");
+    *NR_REQUESTS.lock() = 0;
+    let mut c = [0u8; 512];
+    let mut d = [0u8; 512];
+    {
+        let mut plug = BlkPlug::new(&disk);
+        plug.read(0, &mut c);
+        plug.read(20, &mut d);
+        assert!(plug.finish().is_ok());
+    }
+    assert_eq!(*NR_REQUESTS.lock(), 2);
+    let mut e = [0u8; 512];
+    assert_eq!(blkdev::blkdev_read(&disk, 100, &mut e), Err(-5));
+    println!("test:    SUCCESS - gaps split requests and errors propagate");
+
+    // 4. 驱动支持分散/聚集时合并的请求直接使用 bio 的缓冲区
+    println!("test: 4. Testing scatter-gather requests...");
+    disk.max_segments = 8;
+    *NR_REQUESTS.lock() = 0;
+    *NR_SG_REQUESTS.lock() = 0;
+    let sg_bufs: [[u8; 512]; 3] = [[5; 512], [6; 512], [7; 512]];
+    {
+        let mut plug = BlkPlug::new(&disk);
+        for i in 0..3 {
+            plug.write(30 + i as u64, &sg_bufs[i]);
+        }
+        assert!(plug.finish().is_ok());
+    }
+    let mut f = [0u8; 1536];
+    assert!(blkdev::blkdev_read(&disk, 30, &mut f).is_ok());
+    assert_eq!(*NR_REQUESTS.lock(), 2);
+    assert_eq!(*NR_SG_REQUESTS.lock(), 2);
+    assert!(f[..512].iter().all(|&x| x == 5) && f[1024..].iter().all(|&x| x == 7));
+    disk.max_segments = 0;
+    println!("test:    SUCCESS - multi-segment requests skip the bounce buffer");
+
+    // 5. Discard / WriteZeroes 不带数据，按设备上限拆分，不支持时返回 -EOPNOTSUPP
+    println!("test: 5. Testing discard and write-zeroes...");
+    assert_eq!(blkdev::blkdev_issue_discard(&disk, 30, 3), Err(-95));
+    disk.max_discard_sectors = 2;
+    disk.max_write_zeroes_sectors = 8;
+    *NR_RANGE_REQUESTS.lock() = 0;
+    assert!(blkdev::blkdev_issue_discard(&disk, 30, 3).is_ok());
+    assert_eq!(*NR_RANGE_REQUESTS.lock(), 2);
+    assert!(blkdev::blkdev_read(&disk, 30, &mut f).is_ok());
+    assert!(f.iter().all(|&x| x == 0));
+    assert!(blkdev::blkdev_issue_zeroout(&disk, 8, 4).is_ok());
+    assert_eq!(*NR_RANGE_REQUESTS.lock(), 3);
+    // 不支持 WriteZeroes 时写入零缓冲区
+    disk.max_write_zeroes_sectors = 0;
+    assert!(blkdev::blkdev_write(&disk, 12, &[9u8; 512]).is_ok());
+    assert!(blkdev::blkdev_issue_zeroout(&disk, 12, 1).is_ok());
+    assert_eq!(*NR_RANGE_REQUESTS.lock(), 3);
+    let mut g = [0xFFu8; 2560];
+    assert!(blkdev::blkdev_read(&disk, 8, &mut g).is_ok());
+    assert!(g.iter().all(|&x| x == 0));
+    disk.max_discard_sectors = 0;
+    println!("test:    SUCCESS - range requests carry no data and split at device limits");
+
+    // 6. 完成的请求计入磁盘统计：合并、扇区、在途数和两个直方图
+    println!("test: 6. Testing I/O accounting...");
+    use crate::drivers::blkdev::stat::{STAT_READ, STAT_WRITE};
+    let before = disk.stats.read();
+    let hist_total = |h: [u64; blkdev::stat::LAT_BUCKETS]| h.iter().sum::<u64>();
+    let queued = hist_total(disk.stats.queue_hist(STAT_READ));
+    let mut h = [0u8; 2048];
+    {
+        let mut plug = BlkPlug::new(&disk);
+        let (lo, hi) = h.split_at_mut(1024);
+        plug.read(42, hi);
+        plug.read(40, lo);
+        assert!(plug.finish().is_ok());
+    }
+    let after = disk.stats.read();
+    assert_eq!(after.ios[STAT_READ] - before.ios[STAT_READ], 1);
+    assert_eq!(after.merges[STAT_READ] - before.merges[STAT_READ], 1);
+    assert_eq!(after.sectors[STAT_READ] - before.sectors[STAT_READ], 4);
+    assert_eq!(after.ios[STAT_WRITE], before.ios[STAT_WRITE]);
+    assert_eq!(after.in_flight, 0);
+    assert_eq!(hist_total(disk.stats.queue_hist(STAT_READ)) - queued, 1);
+    assert!(hist_total(disk.stats.device_hist(STAT_READ)) > 0);
+    assert!(disk.stats.show(250, 0, "ram0").trim_start().starts_with("250       0 ram0 "));
+    assert!(disk.stats.show_latency().contains("device read"));
+    assert!(disk.stats.write_control(b"reset\n").is_ok());
+    assert_eq!(hist_total(disk.stats.device_hist(STAT_READ)), 0);
+    assert_eq!(disk.stats.read().ios[STAT_READ], after.ios[STAT_READ]);
+    assert_eq!(disk.stats.write_control(b"1"), Err(-22));
+    println!("test:    SUCCESS - merged request counted once with queue and device latency");
+
+    println!("test: ===== blk-mq Tests Completed =====");
+}
@@ -0,0 +1,148 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 伙伴系统单元测试
+//!
+//! 直接调用全局分配器，按各 order 的空闲块数检查：分配时大块逐级分割、
+//! 块按自身大小对齐、逐页释放时与伙伴逐级合并后 free_area 恢复原状、
+//! 重复释放与堆外指针被忽略、/proc/buddyinfo 与统计一致
+
+use core::alloc::{GlobalAlloc, Layout};
+
+use crate::println;
+use crate::mm::buddy_allocator::{buddy_stats, buddyinfo, BuddyStats, HEAP_ALLOCATOR, MAX_ORDER};
+use crate::mm::PAGE_SIZE;
+
+fn layout(order: usize) -> Layout {
+    Layout::from_size_align(PAGE_SIZE << order, PAGE_SIZE).unwrap()
+}
+
+fn alloc_order(order: usize) -> usize {
+    let ptr = unsafe { HEAP_ALLOCATOR.alloc(layout(order)) } as usize;
+    assert_ne!(ptr, 0);
+    ptr
+}
+
+fn free_order(addr: usize, order: usize) {
+    unsafe { HEAP_ALLOCATOR.dealloc(addr as *mut u8, layout(order)) };
+}
+
+/// 两次统计之间各 order 空闲块数的变化
+fn free_delta(before: &BuddyStats, after: &BuddyStats) -> [isize; MAX_ORDER + 1] {
+    let mut delta = [0isize; MAX_ORDER + 1];
+    for order in 0..=MAX_ORDER {
+        delta[order] = after.free_blocks[order] as isize - before.free_blocks[order] as isize;
+    }
+    delta
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_buddy_allocator() {
+    println!("test: ===== Starting Buddy Allocator Tests =====");
+
+    // 1. 分配 order 的块：取走 order 及以上最小的空闲块，分出的后半部分逐级放回
+    println!("test: 1. Testing split on allocation...");
+    for order in [0, 2, 5] {
+        let before = buddy_stats();
+        let addr = alloc_order(order);
+        let after = buddy_stats();
+        let delta = free_delta(&before, &after);
+        let taken = (order..=MAX_ORDER).find(|&o| delta[o] < 0).expect("no free block taken");
+        // 同一 order 的块被直接取走，或更大的块分割后每一级留下一个块
+        for o in 0..=MAX_ORDER {
+            let expected = if o == taken {
+                -1
+            } else if o >= order && o < taken {
+                1
+            } else {
+                0
+            };
+            assert_eq!(delta[o], expected);
+        }
+        assert_eq!(before.free_bytes - after.free_bytes, PAGE_SIZE << order);
+        assert_eq!(after.alloc_count - before.alloc_count, 1);
+        free_order(addr, order);
+        let freed = buddy_stats();
+        assert_eq!(freed.free_blocks, before.free_blocks);
+        assert_eq!(freed.free_count - before.free_count, 1);
+    }
+    println!("test:    SUCCESS - larger blocks split one level at a time and merge back");
+
+    // 2. 块按自身大小对齐
+    println!("test: 2. Testing block alignment...");
+    let before = buddy_stats();
+    let mut blocks = [0usize; 8];
+    for order in 0..blocks.len() {
+        blocks[order] = alloc_order(order);
+        assert_eq!(blocks[order] % (PAGE_SIZE << order), 0);
+    }
+    for order in (0..blocks.len()).rev() {
+        free_order(blocks[order], order);
+    }
+    assert_eq!(buddy_stats().free_blocks, before.free_blocks);
+    println!("test:    SUCCESS - every block aligned to its size");
+
+    // 3. 逐页释放一个 8 页的块：伙伴都空闲时才合并，最后恢复分配前的状态
+    println!("test: 3. Testing coalescing page by page...");
+    let before = buddy_stats();
+    let block = alloc_order(3);
+    let held = buddy_stats();
+    for i in [0, 2, 4, 6] {
+        free_order(block + i * PAGE_SIZE, 0);
+    }
+    let delta = free_delta(&held, &buddy_stats());
+    assert_eq!((delta[0], delta[1], delta[2]), (4, 0, 0));
+    // 1 与 0 合并为 order 1
+    free_order(block + PAGE_SIZE, 0);
+    let delta = free_delta(&held, &buddy_stats());
+    assert_eq!((delta[0], delta[1], delta[2]), (3, 1, 0));
+    // 3 与 2 合并，再与 {0, 1} 合并为 order 2
+    free_order(block + 3 * PAGE_SIZE, 0);
+    let delta = free_delta(&held, &buddy_stats());
+    assert_eq!((delta[0], delta[1], delta[2]), (2, 0, 1));
+    free_order(block + 5 * PAGE_SIZE, 0);
+    let delta = free_delta(&held, &buddy_stats());
+    assert_eq!((delta[0], delta[1], delta[2]), (1, 1, 1));
+    // 最后一页使整个块空闲，继续与分配时分出的伙伴合并
+    free_order(block + 7 * PAGE_SIZE, 0);
+    assert_eq!(buddy_stats().free_blocks, before.free_blocks);
+    println!("test:    SUCCESS - buddies merged only when both halves were free");
+
+    // 4. 重复释放与不属于堆的指针被忽略
+    println!("test: 4. Testing double free and foreign pointers...");
+    let addr = alloc_order(0);
+    free_order(addr, 0);
+    let before = buddy_stats();
+    free_order(addr, 0);
+    // UART 的 MMIO 地址
+    free_order(0x1000_0000, 0);
+    let after = buddy_stats();
+    assert_eq!(after.free_blocks, before.free_blocks);
+    assert_eq!(after.free_count, before.free_count);
+    println!("test:    SUCCESS - free lists unchanged");
+
+    // 5. 超过 MAX_ORDER 的请求失败
+    println!("test: 5. Testing oversized requests...");
+    let before = buddy_stats();
+    assert!(unsafe { HEAP_ALLOCATOR.alloc(layout(MAX_ORDER + 1)) }.is_null());
+    assert_eq!(buddy_stats().free_blocks, before.free_blocks);
+    println!("test:    SUCCESS - null returned, nothing taken");
+
+    // 6. 碎片指数随 order 不减；/proc/buddyinfo 的各列是各 order 的空闲块数
+    println!("test: 6. Testing unusable index and buddyinfo...");
+    let stats = buddy_stats();
+    let info = buddyinfo();
+    assert_eq!(stats.unusable_index[0], 0);
+    for order in 1..=MAX_ORDER {
+        assert!(stats.unusable_index[order] >= stats.unusable_index[order - 1]);
+        assert!(stats.unusable_index[order] <= 1000);
+    }
+    assert!(info.starts_with("Node 0, zone   Normal "));
+    let columns: alloc::vec::Vec<usize> = info.split_whitespace().skip(4).map(|s| s.parse().unwrap()).collect();
+    assert_eq!(columns.as_slice(), &stats.free_blocks[..]);
+    println!("test:    SUCCESS - fragmentation index and buddyinfo consistent");
+
+    println!("test: ===== Buddy Allocator Tests Completed =====");
+}
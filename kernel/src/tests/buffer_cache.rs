@@ -0,0 +1,237 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 块缓存单元测试
+//!
+//! 在内存盘上把块缓存的预算压到 8 个空闲缓冲区，检查：引用计数与命中、
+//! 按 LRU 顺序淘汰、有使用者的缓冲区不被淘汰、脏缓冲区淘汰前回写、
+//! 回写失败的缓冲区保留、sync_dirty_buffer 与页回收的收缩器
+
+use alloc::boxed::Box;
+use core::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use spin::Mutex;
+
+use crate::println;
+use crate::drivers::blkdev::{GenDisk, ReqCmd, Request};
+use crate::fs::bio;
+
+const BLOCK_SIZE: usize = 4096;
+const NR_BLOCKS: usize = 48;
+/// 测试期间允许的空闲缓冲区数
+const BUDGET: usize = 8;
+
+/// 内存盘：每块的第一个字节为块号
+static RAMDISK: Mutex<[u8; NR_BLOCKS * BLOCK_SIZE]> = Mutex::new([0; NR_BLOCKS * BLOCK_SIZE]);
+/// 驱动写入的块数
+static NR_WRITE_BLOCKS: AtomicUsize = AtomicUsize::new(0);
+/// 为真时写请求返回 EIO
+static FAIL_WRITES: AtomicBool = AtomicBool::new(false);
+
+unsafe extern "C" fn ramdisk_request(req: &mut Request) {
+    let mut disk = RAMDISK.lock();
+    let mut off = req.sector as usize * 512;
+    let mut ret = 0;
+    match req.cmd_type {
+        ReqCmd::Read | ReqCmd::Write if off + req.nr_sectors as usize * 512 > disk.len() => ret = -5,  // EIO
+        ReqCmd::Write if FAIL_WRITES.load(Ordering::Relaxed) => ret = -5,  // EIO
+        ReqCmd::Read => {
+            if req.sg.is_empty() {
+                let len = req.buffer.len();
+                req.buffer.copy_from_slice(&disk[off..off + len]);
+            }
+            for &(addr, len) in &req.sg {
+                core::slice::from_raw_parts_mut(addr as *mut u8, len).copy_from_slice(&disk[off..off + len]);
+                off += len;
+            }
+        }
+        ReqCmd::Write => {
+            NR_WRITE_BLOCKS.fetch_add(req.nr_sectors as usize * 512 / BLOCK_SIZE, Ordering::Relaxed);
+            if req.sg.is_empty() {
+                disk[off..off + req.buffer.len()].copy_from_slice(&req.buffer);
+            }
+            for &(addr, len) in &req.sg {
+                disk[off..off + len].copy_from_slice(core::slice::from_raw_parts(addr as *const u8, len));
+                off += len;
+            }
+        }
+        _ => {}
+    }
+    if let Some(end_io) = req.end_io {
+        end_io(req, ret);
+    }
+}
+
+/// 自上次调用以来写入的块数
+fn take_writes() -> usize {
+    NR_WRITE_BLOCKS.swap(0, Ordering::Relaxed)
+}
+
+/// 磁盘上块的第一个字节
+fn disk_byte(blk: u64) -> u8 {
+    RAMDISK.lock()[blk as usize * BLOCK_SIZE]
+}
+
+/// 读入块后立即释放，缓冲区移到 LRU 表尾
+fn touch(disk: &GenDisk, blk: u64) {
+    let bh = bio::bread(disk, blk).expect("bread failed");
+    assert_eq!(unsafe { (*bh).b_data[0] }, disk_byte(blk));
+    bio::brelse(bh);
+}
+
+/// 块是否在缓存中；在时缓冲区移到 LRU 表尾
+fn cached(disk: &GenDisk, blk: u64) -> bool {
+    match bio::find_get_block(disk, blk) {
+        Some(bh) => {
+            bio::brelse(bh);
+            true
+        }
+        None => false,
+    }
+}
+
+/// 修改缓冲区的第一个字节并标记为脏
+fn dirty(bh: *mut bio::BufferHead, byte: u8) {
+    assert_eq!(unsafe { (*bh).write(0, &[byte]) }, 1);
+    assert!(unsafe { (*bh).is_dirty() });
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_buffer_cache() {
+    println!("test: ===== Starting Buffer Cache Tests =====");
+
+    let disk: &'static mut GenDisk = Box::leak(Box::new(GenDisk::new("bc0", 244, 1, 512, None)));
+    disk.set_capacity((NR_BLOCKS * BLOCK_SIZE / 512) as u32);
+    disk.set_request_fn(ramdisk_request);
+    let disk: &'static GenDisk = disk;
+    for blk in 0..NR_BLOCKS {
+        RAMDISK.lock()[blk * BLOCK_SIZE] = blk as u8;
+    }
+
+    // 丢掉以前的测试留下的空闲缓冲区，只剩仍被引用的 base 个
+    bio::invalidate_buffers();
+    let saved_max = bio::buffer_cache_stats().max_buffers;
+    let base = bio::buffer_cache_stats().nr_buffers;
+    assert_eq!(bio::buffer_cache_stats().nr_unused, 0);
+    bio::set_buffer_cache_budget((base + BUDGET) * BLOCK_SIZE);
+    take_writes();
+
+    // 1. bread 取得引用，第二次命中同一个缓冲区；计数归零后挂到 LRU
+    println!("test: 1. Testing reference counts and hits...");
+    let before = bio::buffer_cache_stats();
+    let bh = bio::bread(disk, 0).expect("bread failed");
+    let again = bio::bread(disk, 0).expect("bread failed");
+    assert_eq!(bh, again);
+    assert_eq!(unsafe { (*bh).count() }, 2);
+    let stats = bio::buffer_cache_stats();
+    assert_eq!((stats.misses - before.misses, stats.hits - before.hits), (1, 1));
+    bio::brelse(again);
+    assert_eq!(bio::buffer_cache_stats().nr_unused, 0);
+    bio::brelse(bh);
+    assert_eq!(bio::buffer_cache_stats().nr_unused, 1);
+    // 只查缓存不读盘
+    assert!(bio::find_get_block(disk, 47).is_none());
+    assert_eq!(bio::buffer_cache_stats().misses - before.misses, 1);
+    println!("test:    SUCCESS - one buffer per block, released onto the LRU");
+
+    // 2. 超出预算时淘汰最久未用的缓冲区，重新使用过的块移到表尾
+    println!("test: 2. Testing LRU eviction order...");
+    for blk in 1..8 {
+        touch(disk, blk);
+    }
+    touch(disk, 0);
+    let before = bio::buffer_cache_stats();
+    touch(disk, 8);
+    let stats = bio::buffer_cache_stats();
+    assert_eq!(stats.evicted - before.evicted, 1);
+    assert_eq!(stats.nr_buffers, base + BUDGET);
+    assert!(!cached(disk, 1));
+    assert!(cached(disk, 0));
+    assert!(cached(disk, 2));
+    println!("test:    SUCCESS - least recently used block evicted first");
+
+    // 3. 有使用者的缓冲区不淘汰，全部被引用时允许暂时超出预算
+    println!("test: 3. Testing referenced buffers are never evicted...");
+    let held: alloc::vec::Vec<_> = (10..19).map(|blk| bio::bread(disk, blk).expect("bread failed")).collect();
+    let stats = bio::buffer_cache_stats();
+    assert_eq!((stats.nr_buffers, stats.nr_unused), (base + BUDGET + 1, 0));
+    for (i, &bh) in held.iter().enumerate() {
+        assert_eq!(unsafe { ((*bh).b_blocknr, (*bh).b_data[0]) }, (10 + i as u64, 10 + i as u8));
+        bio::brelse(bh);
+    }
+    assert_eq!(bio::buffer_cache_stats().nr_unused, BUDGET + 1);
+    // 下一次 bread 淘汰到预算以内
+    touch(disk, 19);
+    assert_eq!(bio::buffer_cache_stats().nr_buffers, base + BUDGET);
+    assert!(!cached(disk, 10));
+    assert!(!cached(disk, 11));
+    assert!(cached(disk, 12));
+    println!("test:    SUCCESS - held buffers survive, budget restored on release");
+
+    // 4. 脏缓冲区淘汰前回写，再次读入得到修改后的内容
+    println!("test: 4. Testing dirty buffer written back on eviction...");
+    let bh = bio::bread(disk, 20).expect("bread failed");
+    dirty(bh, 0xA5);
+    bio::brelse(bh);
+    assert_eq!(disk_byte(20), 20);
+    assert_eq!(take_writes(), 0);
+    for blk in 21..29 {
+        touch(disk, blk);
+    }
+    assert!(!cached(disk, 20));
+    assert_eq!(take_writes(), 1);
+    assert_eq!(disk_byte(20), 0xA5);
+    touch(disk, 20);
+    println!("test:    SUCCESS - eviction wrote the dirty block once");
+
+    // 5. 回写失败的脏缓冲区留在缓存中，之后的 sync_buffers 写回
+    println!("test: 5. Testing failed writeback keeps the buffer...");
+    let bh = bio::bread(disk, 30).expect("bread failed");
+    dirty(bh, 0x5A);
+    bio::brelse(bh);
+    FAIL_WRITES.store(true, Ordering::Relaxed);
+    for blk in 31..41 {
+        touch(disk, blk);
+    }
+    assert_eq!(bio::buffer_cache_stats().nr_buffers, base + BUDGET);
+    let bh = bio::find_get_block(disk, 30).expect("dirty buffer evicted");
+    assert!(unsafe { (*bh).is_dirty() });
+    bio::brelse(bh);
+    assert_eq!(disk_byte(30), 30);
+    FAIL_WRITES.store(false, Ordering::Relaxed);
+    assert_eq!(bio::sync_buffers(), Ok(()));
+    assert_eq!(disk_byte(30), 0x5A);
+    let bh = bio::find_get_block(disk, 30).expect("buffer dropped by sync");
+    assert!(unsafe { !(*bh).is_dirty() });
+    bio::brelse(bh);
+    take_writes();
+    println!("test:    SUCCESS - dirty data kept until it reached the disk");
+
+    // 6. sync_dirty_buffer 只写脏缓冲区
+    println!("test: 6. Testing sync_dirty_buffer...");
+    let bh = bio::bread(disk, 40).expect("bread failed");
+    dirty(bh, 0x3C);
+    assert_eq!(bio::sync_dirty_buffer(bh), Ok(()));
+    assert_eq!((take_writes(), disk_byte(40)), (1, 0x3C));
+    assert_eq!(bio::sync_dirty_buffer(bh), Ok(()));
+    assert_eq!(take_writes(), 0);
+    bio::brelse(bh);
+    println!("test:    SUCCESS - clean buffers are not rewritten");
+
+    // 7. 收缩器释放全部空闲缓冲区，被引用的保留
+    println!("test: 7. Testing shrink_buffers...");
+    let held = bio::bread(disk, 41).expect("bread failed");
+    let unused = bio::buffer_cache_stats().nr_unused;
+    assert_eq!(bio::shrink_buffers(), unused);
+    let stats = bio::buffer_cache_stats();
+    assert_eq!((stats.nr_buffers, stats.nr_unused), (base + 1, 0));
+    assert_eq!(unsafe { (*held).b_data[0] }, 41);
+    bio::brelse(held);
+    assert_eq!(bio::buffer_cache_stats().nr_unused, 1);
+    println!("test:    SUCCESS - idle buffers reclaimed, held buffer kept");
+
+    bio::invalidate_buffers();
+    bio::set_buffer_cache_budget(saved_max * BLOCK_SIZE);
+    println!("test: ===== Buffer Cache Tests Completed =====");
+}
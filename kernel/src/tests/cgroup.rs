@@ -0,0 +1,127 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：任务组与 CPU 带宽
+//
+// 测试内容：
+// 1. 创建、查找和删除子组，重名返回 EEXIST，非空组返回 EBUSY
+// 2. 份额限制在 [MIN_SHARES, MAX_SHARES]，根组不可修改
+// 3. tg_set_cfs_bandwidth 拒绝越界的周期和配额
+// 4. cgroupfs 读写 cpu.max、cpu.weight 和 cpu.stat
+// 5. 写 cgroup.procs 把一个进程移进子组再移回根组，拒绝 idle 和不存在的 PID
+// 6. 通过 cgroupfs 的 mkdir / rmdir
+
+use crate::errno::Errno;
+use crate::fs::cgroupfs;
+use crate::println;
+use crate::sched::group::*;
+
+pub fn test_cgroup() {
+    println!("test: ===== Testing Task Groups and CPU Bandwidth =====");
+
+    let root = root_task_group();
+    let einval = Errno::InvalidArgument.as_neg_i32();
+
+    // 测试 1: 组的生命周期
+    println!("test: 1. Testing group create/destroy...");
+    let parent = sched_create_group(root, "test-a").expect("create test-a");
+    let child = sched_create_group(parent, "b").expect("create test-a/b");
+    assert_eq!(sched_create_group(root, "test-a"), Err(Errno::FileExists.as_neg_i32()));
+    assert_eq!(sched_create_group(root, "x/y"), Err(einval));
+    assert_eq!(find_child_group(root, "test-a"), Some(parent));
+    assert_eq!(find_child_group(parent, "b"), Some(child));
+    assert!(child_group_names(parent).iter().any(|name| name == "b"));
+    assert_eq!(sched_destroy_group(parent), Err(Errno::DeviceOrResourceBusy.as_neg_i32()));
+    assert_eq!(sched_destroy_group(root), Err(einval));
+    assert!(sched_destroy_group(child).is_ok());
+    assert_eq!(find_child_group(parent, "b"), None);
+    println!("test:    SUCCESS - groups created, found and removed");
+
+    // 测试 2: 份额
+    println!("test: 2. Testing shares...");
+    assert_eq!(sched_group_shares(parent), crate::sched::fair::NICE_0_LOAD);
+    assert!(sched_group_set_shares(parent, 0).is_ok());
+    assert_eq!(sched_group_shares(parent), MIN_SHARES);
+    assert!(sched_group_set_shares(parent, u64::MAX).is_ok());
+    assert_eq!(sched_group_shares(parent), MAX_SHARES);
+    assert!(sched_group_set_shares(parent, 2048).is_ok());
+    assert_eq!(sched_group_shares(parent), 2048);
+    assert_eq!(sched_group_set_shares(root, 2048), Err(einval));
+    println!("test:    SUCCESS - shares clamped, root fixed");
+
+    // 测试 3: 带宽参数
+    println!("test: 3. Testing bandwidth limits...");
+    assert_eq!(tg_set_cfs_bandwidth(parent, 100_000, RUNTIME_INF), Err(einval));
+    assert_eq!(tg_set_cfs_bandwidth(parent, DEFAULT_CFS_PERIOD_NS, 1000), Err(einval));
+    assert_eq!(tg_set_cfs_bandwidth(root, DEFAULT_CFS_PERIOD_NS, RUNTIME_INF), Err(einval));
+    assert!(tg_set_cfs_bandwidth(parent, 50_000_000, 20_000_000).is_ok());
+    assert_eq!(tg_get_cfs_bandwidth(parent), (50_000_000, 20_000_000));
+    println!("test:    SUCCESS - period and quota validated");
+
+    // 测试 4: cgroupfs 控制文件
+    println!("test: 4. Testing cgroupfs control files...");
+    assert_eq!(cgroupfs::read_file("/test-a/cpu.max"), Some(b"20000 50000\n".to_vec()));
+    assert_eq!(cgroupfs::write_file("/test-a/cpu.max", b"max\n"), Ok(4));
+    assert_eq!(cgroupfs::read_file("/test-a/cpu.max"), Some(b"max 50000\n".to_vec()));
+    assert!(cgroupfs::write_file("/test-a/cpu.max", b"30000 100000").is_ok());
+    assert_eq!(tg_get_cfs_bandwidth(parent), (100_000_000, 30_000_000));
+    assert_eq!(cgroupfs::write_file("/test-a/cpu.max", b"abc"), Err(einval));
+    assert!(cgroupfs::write_file("/test-a/cpu.weight", b"50").is_ok());
+    assert_eq!(sched_group_shares(parent), 512);
+    assert_eq!(cgroupfs::read_file("/test-a/cpu.weight"), Some(b"50\n".to_vec()));
+    assert_eq!(cgroupfs::write_file("/test-a/cpu.weight", b"0"), Err(einval));
+    assert_eq!(cgroupfs::read_file("/cpu.max"), None);
+    assert!(cgroupfs::read_file("/test-a/cpu.stat").is_some());
+    assert_eq!(
+        cgroupfs::write_file("/test-a/cpu.stat", b"0"),
+        Err(Errno::PermissionDenied.as_neg_i32())
+    );
+    assert!(cgroupfs::write_file("/test-a/cpu.max", b"max").is_ok());
+    println!("test:    SUCCESS - cpu.max and cpu.weight round-trip");
+
+    // 测试 5: 迁移任务
+    println!("test: 5. Testing cgroup.procs...");
+    // 单元测试在 idle 上下文运行，挑一个普通任务来移动
+    let mut tgid = 0;
+    crate::sched::sched::for_each_task(|task| unsafe {
+        if tgid == 0 && (*task).tgid() != 0 {
+            tgid = (*task).tgid();
+        }
+    });
+    assert_eq!(cgroupfs::write_file("/test-a/cgroup.procs", b"0"), Err(einval));
+    assert_eq!(
+        cgroupfs::write_file("/cgroup.procs", b"999999"),
+        Err(Errno::NoSuchProcess.as_neg_i32())
+    );
+    if tgid != 0 {
+        let line = alloc::format!("{}\n", tgid);
+        assert!(cgroupfs::write_file("/test-a/cgroup.procs", line.as_bytes()).is_ok());
+        assert_eq!(cgroupfs::read_file("/test-a/cgroup.procs"), Some(line.clone().into_bytes()));
+        assert_eq!(sched_destroy_group(parent), Err(Errno::DeviceOrResourceBusy.as_neg_i32()));
+        for _ in 0..4 {
+            crate::sched::schedule();
+        }
+        assert!(cgroupfs::write_file("/cgroup.procs", line.as_bytes()).is_ok());
+        assert_eq!(cgroupfs::read_file("/test-a/cgroup.procs"), Some(alloc::vec::Vec::new()));
+        println!("test:    SUCCESS - process {} moved in and back out", tgid);
+    } else {
+        println!("test:    SKIP - no process to move");
+    }
+
+    // 测试 6: mkdir / rmdir
+    println!("test: 6. Testing cgroupfs mkdir/rmdir...");
+    assert!(cgroupfs::mkdir("/test-a/c").is_ok());
+    assert_eq!(cgroupfs::mkdir("/test-a/c"), Err(Errno::FileExists.as_neg_i32()));
+    assert_eq!(cgroupfs::mkdir("/missing/c"), Err(Errno::NoSuchFileOrDirectory.as_neg_i32()));
+    let entries = cgroupfs::list_dir("/test-a").unwrap_or_default();
+    assert!(entries.contains(&(b"c".to_vec(), true)));
+    assert!(entries.contains(&(b"cpu.max".to_vec(), false)));
+    assert!(cgroupfs::rmdir("/test-a/c").is_ok());
+    assert!(cgroupfs::rmdir("/test-a").is_ok());
+    assert_eq!(find_child_group(root, "test-a"), None);
+    println!("test:    SUCCESS - groups managed through the filesystem");
+
+    println!("test: Task group testing completed.");
+}
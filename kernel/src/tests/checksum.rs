@@ -0,0 +1,105 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：Internet 校验和
+//
+// 测试内容：
+// 1. 64 位累加与 16 位参考实现结果一致（各种长度与奇偶）
+// 2. 复制并计算校验和与分开计算一致
+// 3. 向量实现与参考实现一致（CPU 支持时）
+// 4. 各实现的耗时比较
+
+use crate::println;
+use crate::arch::riscv64::cpu;
+use crate::drivers::intc::clint;
+use crate::net::ipv4::checksum::{
+    csum_block_add, csum_fold, csum_partial, csum_partial_64, csum_partial_copy, csum_partial_ref,
+    csum_partial_rvv, ip_checksum,
+};
+use alloc::vec;
+use alloc::vec::Vec;
+
+/// 基准测试每种实现的重复次数
+const BENCH_ROUNDS: usize = 64;
+
+pub fn test_checksum() {
+    println!("test: ===== Testing Internet Checksum =====");
+
+    let data: Vec<u8> = (0..65536usize + 8).map(|i| (i * 7 + (i >> 8)) as u8).collect();
+
+    // 测试 1: 64 位累加与参考实现一致
+    println!("test: 1. Testing 64-bit accumulate against 16-bit reference...");
+    for &len in &[0usize, 1, 2, 3, 7, 8, 9, 20, 63, 1499, 1500, 4096, 65535] {
+        for &start in &[0usize, 1, 3] {
+            let buf = &data[start..start + len];
+            assert_eq!(
+                csum_fold(csum_partial_64(buf, 0x1234)),
+                csum_fold(csum_partial_ref(buf, 0x1234)),
+                "len {} start {}", len, start
+            );
+        }
+    }
+    // RFC 1071 示例 IP 头部
+    let hdr = [0x45, 0x00, 0x00, 0x3c, 0x1c, 0x46, 0x40, 0x00, 0x40, 0x06, 0x00, 0x00, 0xc0, 0xa8, 0x01, 0x01, 0xc0, 0xa8, 0x01, 0x02];
+    assert_eq!(ip_checksum(&hdr), 0xb1e6);
+    println!("test:    SUCCESS - 64-bit fold matches the reference");
+
+    // 测试 2: 复制并计算
+    println!("test: 2. Testing copy-and-checksum...");
+    let mut dst = vec![0u8; 1500];
+    let sum = csum_partial_copy(&data[1..1501], &mut dst, 0);
+    assert_eq!(&dst[..], &data[1..1501]);
+    assert_eq!(csum_fold(sum), csum_fold(csum_partial_ref(&data[1..1501], 0)));
+    // 分块计算后按偏移合并，奇数偏移处的块要循环移位
+    let sum = csum_block_add(csum_partial(&data[..701], 0), csum_partial(&data[701..1500], 0), 701);
+    assert_eq!(csum_fold(sum), csum_fold(csum_partial_ref(&data[..1500], 0)));
+    println!("test:    SUCCESS - copy-and-checksum matches separate copy and sum");
+
+    // 测试 3: 向量实现
+    println!("test: 3. Testing RISC-V vector checksum...");
+    if cpu::has_vector() {
+        for &len in &[4usize, 255, 256, 1500, 4097, 65536] {
+            let buf = &data[..len];
+            let rvv = unsafe { csum_partial_rvv(buf, 0) };
+            assert_eq!(csum_fold(rvv), csum_fold(csum_partial_ref(buf, 0)), "len {}", len);
+        }
+        println!("test:    SUCCESS - vector checksum matches the reference");
+    } else {
+        println!("test:    SKIPPED - CPU does not report the V extension");
+    }
+
+    // 测试 4: 耗时比较
+    println!("test: 4. Benchmarking checksum variants...");
+    for &len in &[64usize, 1500, 65536] {
+        let buf = &data[..len];
+        let reference = bench(|| csum_partial_ref(buf, 0));
+        let word64 = bench(|| csum_partial_64(buf, 0));
+        let mut copy_buf = vec![0u8; len];
+        let copy = bench(|| csum_partial_copy(buf, &mut copy_buf, 0));
+        if cpu::has_vector() {
+            let rvv = bench(|| unsafe { csum_partial_rvv(buf, 0) });
+            println!("test:    {} bytes: ref {} / 64-bit {} / rvv {} / copy+csum {} ticks",
+                     len, reference, word64, rvv, copy);
+        } else {
+            println!("test:    {} bytes: ref {} / 64-bit {} / copy+csum {} ticks",
+                     len, reference, word64, copy);
+        }
+    }
+    println!("test:    SUCCESS - benchmark completed");
+
+    println!("test: Internet checksum testing completed.");
+}
+
+/// 返回 BENCH_ROUNDS 次调用的平均 time CSR 计数
+fn bench<F: FnMut() -> u32>(mut f: F) -> u64 {
+    let mut acc = 0u32;
+    let start = clint::read_time();
+    for _ in 0..BENCH_ROUNDS {
+        acc = acc.wrapping_add(core::hint::black_box(f()));
+    }
+    let end = clint::read_time();
+    core::hint::black_box(acc);
+    (end - start) / BENCH_ROUNDS as u64
+}
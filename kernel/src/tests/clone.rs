@@ -0,0 +1,102 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：clone 与线程组
+//
+// 测试内容：
+// 1. 非法的 clone 标志组合返回 EINVAL
+// 2. CLONE_THREAD 的线程组标识
+// 3. CLONE_FILES / CLONE_SIGHAND 共享同一份结构
+// 4. CLONE_VFORK 的完成通知只触发一次
+// 5. exit_group 的组退出码：先发起者的退出码对整个线程组生效，按 TGID 区分
+
+use alloc::boxed::Box;
+use alloc::sync::Arc;
+use crate::println;
+use crate::fs::FdTable;
+use crate::process::fork::*;
+use crate::process::task::{SchedPolicy, Task};
+use crate::signal::{SigAction, SigActionKind, Signal, SignalStruct};
+
+const EINVAL: i32 = -22;
+
+fn clone_flags(flags: u64) -> i32 {
+    let args = CloneArgs { flags, ..CloneArgs::default() };
+    match do_clone(&args) {
+        Ok(_) => 0,
+        Err(e) => e,
+    }
+}
+
+pub fn test_clone() {
+    println!("test: ===== Testing Clone =====");
+
+    // 测试 1: 标志检查在分配任务之前完成
+    println!("test: 1. Testing invalid clone flags...");
+    assert_eq!(clone_flags(CLONE_THREAD | CLONE_VM), EINVAL);
+    assert_eq!(clone_flags(CLONE_SIGHAND), EINVAL);
+    assert_eq!(clone_flags(CLONE_VM | CLONE_NEWNS), EINVAL);
+    assert_eq!(clone_flags(CLONE_VM | CLONE_PIDFD), EINVAL);
+    println!("test:    SUCCESS - invalid flag combinations return EINVAL");
+
+    // 测试 2: 线程组
+    println!("test: 2. Testing thread group ids...");
+    let mut thread = Box::new(Task::new(7, SchedPolicy::Normal));
+    assert_eq!(thread.tgid(), 7);
+    assert!(!thread.is_thread());
+    thread.set_tgid(5);
+    assert!(thread.is_thread());
+    assert_eq!(thread.pid(), 7);
+    println!("test:    SUCCESS - thread keeps its TID and joins the group");
+
+    // 测试 3: 共享文件描述符表与信号处理
+    println!("test: 3. Testing shared files and sighand...");
+    let mut leader = Box::new(Task::new(5, SchedPolicy::Normal));
+    leader.set_fdtable(Some(Arc::new(FdTable::new())));
+    leader.signal = Some(Arc::new(SignalStruct::new()));
+
+    thread.set_fdtable(leader.share_fdtable());
+    thread.signal = leader.signal.clone();
+    let fd = thread.fdtable().alloc_fd();
+    assert!(fd.is_some());
+    assert!(core::ptr::eq(thread.fdtable(), leader.fdtable()));
+
+    let sigterm = Signal::SIGTERM as i32;
+    thread.signal.as_ref().unwrap().set_action(sigterm, SigAction::ignore()).unwrap();
+    let action = leader.signal.as_ref().unwrap().get_action(sigterm).unwrap();
+    assert_eq!(action.action(), SigActionKind::Ignore);
+    println!("test:    SUCCESS - sigaction in one thread is seen by the group");
+
+    // 测试 4: vfork 完成通知
+    println!("test: 4. Testing vfork completion...");
+    let child = Box::new(Task::new(9, SchedPolicy::Normal));
+    let vfork = Arc::new(VforkDone::new());
+    child.set_vfork_done(vfork.clone());
+    assert!(!vfork.is_done());
+    assert_eq!(Arc::strong_count(&vfork), 2);
+    complete_vfork_done(&child);
+    assert!(vfork.is_done());
+    assert_eq!(Arc::strong_count(&vfork), 1);
+    // execve 之后再退出不会重复通知
+    complete_vfork_done(&child);
+    assert!(child.take_vfork_done().is_none());
+    println!("test:    SUCCESS - exec/exit releases the vfork parent once");
+
+    // 测试 5: 组退出码
+    println!("test: 5. Testing group exit code...");
+    use crate::sched::{exit_status, kill_status};
+    let sighand = leader.signal.as_ref().unwrap();
+    assert_eq!(sighand.group_exit_code(5), None);
+    assert_eq!(sighand.start_group_exit(5, exit_status(3)), (exit_status(3), true));
+    // 组内其他线程随后调用 exit_group 时沿用先记下的退出码
+    assert_eq!(sighand.start_group_exit(5, exit_status(7)), (exit_status(3), false));
+    assert_eq!(thread.signal.as_ref().unwrap().group_exit_code(thread.tgid()), Some(exit_status(3)));
+    // 只共享信号处理的其他线程组不受影响，收到 SIGKILL 时按信号杀死报告
+    assert_eq!(sighand.group_exit_code(9), None);
+    assert_eq!(kill_status(Signal::SIGKILL as i32), 9);
+    println!("test:    SUCCESS - group exit code recorded once per thread group");
+
+    println!("test: Clone testing completed.");
+}
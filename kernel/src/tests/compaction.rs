@@ -0,0 +1,139 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内存规整单元测试
+//!
+//! 空闲页的 Buddy 标记与摘下、匿名页两阶段迁移（先写保护再复制）、
+//! 同步规整的参数检查与统计
+
+use crate::println;
+use crate::arch::riscv64::mm::{
+    create_user_address_space, handle_mm_fault, map, try_to_migrate, AddressSpace, FaultFlags, MigratePage,
+    MmFaultResult, VirtAddr,
+};
+use crate::mm::compaction::{compaction_stats, try_to_compact_pages, COMPACT_BLOCK_PAGES};
+use crate::mm::page::{alloc_frame, dealloc_frame, isolate_free_frames, PhysFrame, VirtAddr as PageVirtAddr, PAGE_SIZE};
+use crate::mm::page_desc::{pfn_to_page, PageFlag, PageType};
+use crate::mm::pcp::{alloc_user_page, free_user_page};
+use crate::mm::vma::{VmaFlags, VmaType};
+
+fn pattern(i: usize) -> u8 {
+    (i % 251) as u8 ^ 0x3c
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_compaction() {
+    println!("test: ===== Starting Compaction Tests =====");
+
+    // 1. 释放的页标记为 Buddy，可以从空闲链表摘下
+    println!("test: 1. Testing free page isolation...");
+    match alloc_frame() {
+        Some(frame) => {
+            let page = pfn_to_page(frame.number);
+            assert_eq!(unsafe { (*page).page_type() }, PageType::Normal);
+            dealloc_frame(frame);
+            assert_eq!(unsafe { (*page).page_type() }, PageType::Buddy);
+            let mut isolated = [0u64; COMPACT_BLOCK_PAGES / 64];
+            assert_eq!(isolate_free_frames(frame.number, 1, &mut isolated), 1);
+            assert_eq!(isolated[0], 1);
+            // 摘下的页不会再被分配出去
+            let other = alloc_frame().expect("alloc failed");
+            assert_ne!(other.number, frame.number);
+            dealloc_frame(other);
+            dealloc_frame(frame);
+            println!("test:    SUCCESS - freed page isolated from the free list");
+        }
+        None => println!("test:    SKIP - no free pages"),
+    }
+
+    // 2. 参数检查
+    println!("test: 2. Testing compaction arguments...");
+    let before = compaction_stats();
+    assert!(try_to_compact_pages(0, 1).is_none());
+    assert!(try_to_compact_pages(COMPACT_BLOCK_PAGES + 1, 1).is_none());
+    assert!(try_to_compact_pages(4, 3).is_none());
+    assert_eq!(compaction_stats().compact_stall, before.compact_stall);
+    println!("test:    SUCCESS - unsupported requests rejected without compacting");
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            println!("test: ===== Compaction Tests Completed =====");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new(root_ppn) };
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let addr = aspace
+        .mmap(PageVirtAddr::new(0), PAGE_SIZE, flags, VmaType::Anonymous, map::MAP_PRIVATE | map::MAP_ANONYMOUS)
+        .expect("mmap failed")
+        .as_usize();
+    assert_eq!(handle_mm_fault(&aspace, VirtAddr::new(addr as u64), FaultFlags::WRITE | FaultFlags::USER),
+               MmFaultResult::Handled);
+    let old_pfn = aspace.translate(PageVirtAddr::new(addr)).unwrap().as_usize() / PAGE_SIZE;
+    for i in 0..PAGE_SIZE {
+        unsafe { *((old_pfn * PAGE_SIZE + i) as *mut u8) = pattern(i) };
+    }
+
+    // 3. 迁移匿名页
+    println!("test: 3. Testing anonymous page migration...");
+    match alloc_user_page() {
+        Some(target) => {
+            // 可写的页先写保护
+            assert_eq!(try_to_migrate(old_pfn, target.number), MigratePage::Protected);
+            crate::arch::tlb::flush_tlb_all();
+            assert_eq!(try_to_migrate(old_pfn, target.number), MigratePage::Moved);
+            crate::arch::tlb::flush_tlb_all();
+            let new_phys = aspace.translate(PageVirtAddr::new(addr)).unwrap().as_usize();
+            assert_eq!(new_phys / PAGE_SIZE, target.number);
+            let data = unsafe { core::slice::from_raw_parts(new_phys as *const u8, PAGE_SIZE) };
+            assert!(data.iter().enumerate().all(|(i, &byte)| byte == pattern(i)), "migrated page corrupted");
+            // 反向映射转移到新页，旧页不再是匿名页
+            unsafe {
+                let new_page = pfn_to_page(target.number);
+                assert_eq!((*new_page).page_type(), PageType::Anonymous);
+                assert!((*new_page).private() != 0);
+                assert!((*new_page).test_flag(PageFlag::SwapBacked));
+                let old_page = pfn_to_page(old_pfn);
+                assert_eq!((*old_page).page_type(), PageType::Normal);
+                assert_eq!((*old_page).private(), 0);
+            }
+            free_user_page(PhysFrame::new(old_pfn));
+            // 旧页已经不在记录的位置
+            assert_eq!(try_to_migrate(old_pfn, target.number), MigratePage::Busy);
+            let result = handle_mm_fault(&aspace, VirtAddr::new(addr as u64), FaultFlags::READ | FaultFlags::USER);
+            assert!(result == MmFaultResult::Handled || result == MmFaultResult::AlreadyMapped);
+            println!("test:    SUCCESS - page moved with its reverse mapping");
+        }
+        None => println!("test:    SKIP - no free pages"),
+    }
+    aspace.mmput();
+
+    // 4. 同步规整的统计
+    println!("test: 4. Testing direct compaction...");
+    let before = compaction_stats();
+    let result = try_to_compact_pages(COMPACT_BLOCK_PAGES, COMPACT_BLOCK_PAGES);
+    let after = compaction_stats();
+    match result {
+        Some(frame) => {
+            assert_eq!(frame.number % COMPACT_BLOCK_PAGES, 0);
+            assert_eq!(after.compact_success, before.compact_success + 1);
+            for pfn in frame.number..frame.number + COMPACT_BLOCK_PAGES {
+                assert_eq!(unsafe { (*pfn_to_page(pfn)).refcount() }, 1);
+                dealloc_frame(PhysFrame::new(pfn));
+            }
+            println!("test:    SUCCESS - compacted a {}-page block", COMPACT_BLOCK_PAGES);
+        }
+        None => {
+            assert!(after.compact_fail > before.compact_fail || after.compact_stall == before.compact_stall);
+            println!("test:    SUCCESS - no block could be compacted ({} pages migrated)",
+                     after.pgmigrate_success - before.pgmigrate_success);
+        }
+    }
+
+    println!("test: ===== Compaction Tests Completed =====");
+}
@@ -0,0 +1,67 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! CPU 空闲状态测试
+//!
+//! 验证轮询时长的自适应、睡眠状态的选择、轮询 CPU 的登记，
+//! 以及 /proc/cpuidle 的导出
+
+use alloc::string::String;
+
+use crate::config::MAX_CPUS;
+use crate::println;
+use crate::sched::idle::{
+    adjust_poll_limit, cpu_polling, select_state, IdleState, HALT_POLL_NS_GROW_START, HALT_POLL_NS_MAX,
+    SUSPEND_TARGET_RESIDENCY_NS,
+};
+
+#[cfg(feature = "unit-test")]
+pub fn test_cpuidle() {
+    println!("test: ===== Starting CPU Idle Tests =====");
+
+    // 1. 轮询时长的增长与缩减
+    println!("test: 1. Testing poll limit adjustment...");
+    assert_eq!(adjust_poll_limit(0, 10_000), HALT_POLL_NS_GROW_START);
+    assert_eq!(adjust_poll_limit(HALT_POLL_NS_GROW_START, 80_000), HALT_POLL_NS_GROW_START * 2);
+    assert_eq!(adjust_poll_limit(150_000, 180_000), HALT_POLL_NS_MAX);
+    assert_eq!(adjust_poll_limit(HALT_POLL_NS_MAX, HALT_POLL_NS_MAX + 1), HALT_POLL_NS_MAX / 2);
+    assert_eq!(adjust_poll_limit(100_000, 30_000), 100_000);
+    assert_eq!(adjust_poll_limit(0, 5_000_000), 0);
+    println!("test:    SUCCESS - grows within {} ns, shrinks beyond", HALT_POLL_NS_MAX);
+
+    // 2. 短睡眠用 wfi，长睡眠且固件支持时挂起
+    println!("test: 2. Testing state selection...");
+    assert_eq!(select_state(u64::MAX, false), IdleState::Wfi);
+    assert_eq!(select_state(SUSPEND_TARGET_RESIDENCY_NS - 1, true), IdleState::Wfi);
+    assert_eq!(select_state(SUSPEND_TARGET_RESIDENCY_NS, true), IdleState::Suspend);
+    println!("test:    SUCCESS - suspend from {} ns", SUSPEND_TARGET_RESIDENCY_NS);
+
+    // 3. 运行中的 CPU 不登记为轮询
+    println!("test: 3. Testing polling state...");
+    assert!(!cpu_polling(crate::arch::cpu_id()));
+    assert!(!cpu_polling(MAX_CPUS));
+    println!("test:    SUCCESS - running CPU is not polling");
+
+    // 4. /proc/cpuidle 每个在线 CPU 一行
+    println!("test: 4. Testing /proc/cpuidle...");
+    let data = crate::fs::procfs::read_file("/cpuidle").unwrap_or_default();
+    let text = String::from_utf8(data).unwrap_or_default();
+    let mut lines = text.lines();
+    let header: alloc::vec::Vec<&str> = lines.next().expect("header").split_whitespace().collect();
+    assert_eq!(header[0], "cpu");
+    assert!(header.contains(&"suspend_usage"));
+    let active = crate::sched::cpu_active_mask();
+    let rows: alloc::vec::Vec<&str> = lines.collect();
+    assert_eq!(rows.len(), active.count_ones() as usize);
+    for row in &rows {
+        let fields: alloc::vec::Vec<&str> = row.split_whitespace().collect();
+        assert_eq!(fields.len(), header.len(), "{}", row);
+        assert!(fields[0].starts_with("cpu"));
+        assert!(fields[1..].iter().all(|f| f.parse::<u64>().is_ok()), "{}", row);
+    }
+    println!("test:    SUCCESS - {} CPUs", rows.len());
+
+    println!("test: ===== CPU Idle Tests Completed =====");
+}
@@ -0,0 +1,155 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! CRC32 / CRC32C 与 ext4 元数据校验和单元测试
+//!
+//! 切片查表与 Zbc 实现和逐位参考实现一致（各种长度与对齐）、标准测试向量、
+//! ext4 inode / extent 块 / 目录块 / 超级块校验和的生成与校验，以及各实现的耗时比较
+
+use alloc::vec;
+use alloc::vec::Vec;
+
+use crate::println;
+use crate::arch::riscv64::cpu;
+use crate::crc32::{self, CRC32C_POLY_LE, CRC32_POLY_LE};
+use crate::drivers::intc::clint;
+use crate::fs::ext4::csum::{self, EXT4_FEATURE_RO_COMPAT_METADATA_CSUM};
+use crate::fs::ext4::Ext4FileSystem;
+
+/// 基准测试每种实现的重复次数
+const BENCH_ROUNDS: usize = 64;
+
+#[cfg(feature = "unit-test")]
+pub fn test_crc32() {
+    println!("test: ===== Starting CRC32 / ext4 metadata_csum Tests =====");
+
+    let data: Vec<u8> = (0..8192usize + 8).map(|i| (i * 13 + (i >> 7)) as u8).collect();
+
+    // 1. 标准测试向量
+    println!("test: 1. Testing check values...");
+    assert_eq!(crc32::crc32c(!0, b"123456789") ^ !0, 0xE306_9283);
+    assert_eq!(crc32::crc32_le(!0, b"123456789") ^ !0, 0xCBF4_3926);
+    assert_eq!(crate::net::ethernet::eth_crc(b"123456789"), 0xCBF4_3926);
+    println!("test:    SUCCESS - crc32c = 0xE3069283, crc32 = 0xCBF43926");
+
+    // 2. 切片查表与逐位参考实现一致，分段计算与整段一致
+    println!("test: 2. Testing slice-by-8 against bitwise reference...");
+    for &len in &[0usize, 1, 7, 8, 9, 15, 16, 17, 63, 128, 1023, 4096] {
+        for &start in &[0usize, 1, 3, 5] {
+            let buf = &data[start..start + len];
+            assert_eq!(crc32::crc32c_base(!0, buf), crc32::crc_le_ref(CRC32C_POLY_LE, !0, buf), "len {} start {}", len, start);
+            assert_eq!(crc32::crc32_le_base(0, buf), crc32::crc_le_ref(CRC32_POLY_LE, 0, buf), "len {} start {}", len, start);
+        }
+    }
+    let whole = crc32::crc32c(!0, &data[..4096]);
+    assert_eq!(crc32::crc32c(crc32::crc32c(!0, &data[..1001]), &data[1001..4096]), whole);
+    println!("test:    SUCCESS - slice-by-8 matches the reference");
+
+    // 3. Zbc 实现
+    println!("test: 3. Testing Zbc carry-less multiply CRC...");
+    if cpu::has_zbc() {
+        for &len in &[16usize, 17, 31, 64, 1500, 4096] {
+            for &start in &[0usize, 1, 7] {
+                let buf = &data[start..start + len];
+                assert_eq!(unsafe { crc32::crc32c_zbc(!0, buf) }, crc32::crc32c_base(!0, buf), "len {} start {}", len, start);
+                assert_eq!(unsafe { crc32::crc32_le_zbc(!0, buf) }, crc32::crc32_le_base(!0, buf), "len {} start {}", len, start);
+            }
+        }
+        println!("test:    SUCCESS - Zbc CRC matches slice-by-8");
+    } else {
+        println!("test:    SKIPPED - CPU does not report the Zbc extension");
+    }
+
+    // 文件系统实例只用于校验和计算，不访问设备
+    let mut fs = Ext4FileSystem::new(core::ptr::null());
+    fs.feature_ro_compat = EXT4_FEATURE_RO_COMPAT_METADATA_CSUM;
+    fs.csum_seed = crc32::crc32c(!0, &[0x5A; 16]);
+    fs.inode_size = 256;
+    fs.block_size = 4096;
+
+    // 4. inode 校验和：生成后通过校验，修改任一字节后校验失败
+    println!("test: 4. Testing inode checksum...");
+    let mut raw = data[..256].to_vec();
+    raw[0x80..0x82].copy_from_slice(&32u16.to_le_bytes());
+    fs.inode_csum_set(12, &mut raw);
+    assert!(fs.inode_csum_verify(12, &raw));
+    assert!(!fs.inode_csum_verify(13, &raw));
+    raw[0x10] ^= 1;
+    assert!(!fs.inode_csum_verify(12, &raw));
+    println!("test:    SUCCESS - inode checksum detects corruption and wrong inode number");
+
+    // 5. extent 块与目录块校验和
+    println!("test: 5. Testing extent and directory block checksums...");
+    let seed = fs.inode_csum_seed(12, 0x1234);
+    let mut ext = vec![0u8; 4096];
+    ext[0..2].copy_from_slice(&0xF30Au16.to_le_bytes());
+    ext[4..6].copy_from_slice(&340u16.to_le_bytes());
+    fs.extent_block_csum_set(seed, &mut ext);
+    assert!(fs.extent_block_csum_verify(seed, &ext));
+    ext[12] ^= 1;
+    assert!(!fs.extent_block_csum_verify(seed, &ext));
+
+    let mut leaf = vec![0u8; 4096];
+    leaf[4..6].copy_from_slice(&(fs.dir_leaf_size() as u16).to_le_bytes());
+    fs.dirblock_csum_set(seed, &mut leaf);
+    assert!(csum::has_dirent_tail(&leaf));
+    assert!(fs.dirblock_csum_verify(seed, &leaf));
+    leaf[8] ^= 1;
+    assert!(!fs.dirblock_csum_verify(seed, &leaf));
+
+    // dx_node：覆盖整块的空目录项之后是 count/limit，limit 为 dx_tail 留出一项
+    let mut node = vec![0u8; 4096];
+    node[4..6].copy_from_slice(&4096u16.to_le_bytes());
+    node[8..10].copy_from_slice(&(fs.dx_limit(8) as u16).to_le_bytes());
+    node[10..12].copy_from_slice(&1u16.to_le_bytes());
+    assert_eq!(csum::dx_countlimit_offset(&node), Some(8));
+    fs.dx_csum_set(seed, &mut node, 8);
+    assert!(fs.dirblock_csum_verify(seed, &node));
+    node[12] ^= 1;
+    assert!(!fs.dirblock_csum_verify(seed, &node));
+    println!("test:    SUCCESS - extent, leaf and dx block checksums verified");
+
+    // 6. 超级块校验和
+    println!("test: 6. Testing superblock checksum...");
+    let mut sb = data[..1024].to_vec();
+    sb[0x64..0x68].copy_from_slice(&EXT4_FEATURE_RO_COMPAT_METADATA_CSUM.to_le_bytes());
+    sb[0x60..0x64].fill(0);
+    csum::ext4_superblock_csum_set(&mut sb);
+    assert!(csum::ext4_superblock_csum_verify(&sb));
+    assert_eq!(csum::ext4_csum_seed(&sb), crc32::crc32c(!0, &sb[0x68..0x78]));
+    sb[0x10] ^= 1;
+    assert!(!csum::ext4_superblock_csum_verify(&sb));
+    println!("test:    SUCCESS - superblock checksum detects corruption");
+    drop(fs);
+
+    // 7. 耗时比较
+    println!("test: 7. Benchmarking CRC32C variants...");
+    for &len in &[64usize, 256, 4096] {
+        let buf = &data[..len];
+        let bitwise = bench(|| crc32::crc_le_ref(CRC32C_POLY_LE, !0, buf));
+        let slice8 = bench(|| crc32::crc32c_base(!0, buf));
+        if cpu::has_zbc() {
+            let zbc = bench(|| unsafe { crc32::crc32c_zbc(!0, buf) });
+            println!("test:    {} bytes: bitwise {} / slice-by-8 {} / zbc {} ticks", len, bitwise, slice8, zbc);
+        } else {
+            println!("test:    {} bytes: bitwise {} / slice-by-8 {} ticks", len, bitwise, slice8);
+        }
+    }
+    println!("test:    SUCCESS - benchmark completed");
+
+    println!("test: ===== CRC32 / ext4 metadata_csum Tests Completed =====");
+}
+
+/// 返回 BENCH_ROUNDS 次调用的平均 time CSR 计数
+fn bench<F: FnMut() -> u32>(mut f: F) -> u64 {
+    let mut acc = 0u32;
+    let start = clint::read_time();
+    for _ in 0..BENCH_ROUNDS {
+        acc = acc.wrapping_add(core::hint::black_box(f()));
+    }
+    let end = clint::read_time();
+    core::hint::black_box(acc);
+    (end - start) / BENCH_ROUNDS as u64
+}
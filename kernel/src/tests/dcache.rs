@@ -9,6 +9,7 @@
 //! - LRU 淘汰策略
 //! - 统计信息（命中率、淘汰次数）
 //! - 缓存清空
+//! - 负目录项与哈希表扩容
 
 use crate::println;
 use crate::fs::dentry;
@@ -41,6 +42,14 @@ pub fn test_dcache() {
     println!("test: 5. Testing hash collision handling...");
     test_dcache_collision();
 
+    // 测试 6: 负目录项
+    println!("test: 6. Testing negative dentries...");
+    test_dcache_negative();
+
+    // 测试 7: 哈希表扩容
+    println!("test: 7. Testing hash table growth...");
+    test_dcache_grow();
+
     println!("test: ===== Dentry Cache Tests Completed =====");
 }
 
@@ -295,3 +304,82 @@ fn test_dcache_collision() {
 
     println!("test:    SUCCESS - hash collision handling functional");
 }
+
+/// 测试负目录项
+fn test_dcache_negative() {
+    println!("test:    Testing negative dentry caching...");
+
+    dentry::dcache_flush();
+    let parent_ino = 300;
+
+    // 查找失败后记录负目录项
+    dentry::dcache_add_negative("missing.txt", parent_ino);
+    match dentry::dcache_lookup("missing.txt", parent_ino) {
+        Some(d) if d.is_negative() => println!("test:    SUCCESS - negative dentry cached"),
+        _ => println!("test:    FAILED - negative dentry not found"),
+    }
+
+    // 文件创建后正目录项替换负目录项
+    let positive = Arc::new(dentry::Dentry::new("missing.txt".to_string()));
+    dentry::dcache_add(positive, parent_ino);
+    match dentry::dcache_lookup("missing.txt", parent_ino) {
+        Some(d) if !d.is_negative() => println!("test:    SUCCESS - positive dentry replaced negative"),
+        _ => println!("test:    FAILED - negative dentry not replaced"),
+    }
+
+    let (count, _) = dentry::dcache_stats();
+    let (negative, negative_hits) = dentry::dcache_negative_stats();
+    println!("test:      Entries: {}, negative: {}, negative hits: {}", count, negative, negative_hits);
+    if count == 1 && negative == 0 {
+        println!("test:    SUCCESS - negative dentry accounting correct");
+    } else {
+        println!("test:    FAILED - negative dentry accounting mismatch");
+    }
+
+    // 长名字存放在堆上，短名字内联
+    let long_name = "a_very_long_file_name_that_does_not_fit_inline.txt";
+    let long = Arc::new(dentry::Dentry::new(long_name.to_string()));
+    dentry::dcache_add(long, parent_ino);
+    if dentry::dcache_lookup(long_name, parent_ino).map_or(false, |d| d.name() == long_name) {
+        println!("test:    SUCCESS - long names work");
+    } else {
+        println!("test:    FAILED - long name lookup failed");
+    }
+
+    dentry::dcache_flush();
+}
+
+/// 测试哈希表扩容
+fn test_dcache_grow() {
+    println!("test:    Testing hash table growth beyond initial size...");
+
+    dentry::dcache_flush();
+    let parent_ino = 400;
+    let buckets_before = dentry::dcache_nr_buckets();
+
+    // 超过初始桶数的负载上限
+    for i in 0..2000 {
+        let name = format!("grow_{}.txt", i);
+        dentry::dcache_add(Arc::new(dentry::Dentry::new(name)), parent_ino);
+    }
+
+    let buckets_after = dentry::dcache_nr_buckets();
+    println!("test:      Buckets: {} -> {}", buckets_before, buckets_after);
+
+    let mut found = 0;
+    for i in 0..2000 {
+        let name = format!("grow_{}.txt", i);
+        if dentry::dcache_lookup(&name, parent_ino).is_some() {
+            found += 1;
+        }
+    }
+    println!("test:      Found {}/2000 entries", found);
+
+    if buckets_after > buckets_before && found == 2000 {
+        println!("test:    SUCCESS - hash table grows and keeps all entries");
+    } else {
+        println!("test:    FAILED - hash table growth lost entries");
+    }
+
+    dentry::dcache_flush();
+}
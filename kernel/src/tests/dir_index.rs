@@ -0,0 +1,99 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 目录子节点索引测试
+//!
+//! 在局部的 rootfs 目录节点上验证：超过阈值后按名字查找、删除与改名仍然正确，
+//! 遍历保持插入顺序
+
+use alloc::format;
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+
+use crate::fs::dir_index::DIR_INDEX_THRESHOLD;
+use crate::fs::rootfs::RootFSNode;
+use crate::println;
+
+fn names(dir: &RootFSNode, start: usize) -> Vec<Vec<u8>> {
+    let mut out = Vec::new();
+    dir.for_each_child(start, |child| {
+        out.push(child.name.clone());
+        true
+    });
+    out
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_dir_index() {
+    println!("test: ===== Starting Directory Index Tests =====");
+
+    // 1. 小目录按顺序查找
+    println!("test: 1. Testing small directory...");
+    let dir = RootFSNode::new_dir(b"bin".to_vec(), 1);
+    for i in 0..DIR_INDEX_THRESHOLD {
+        let name = format!("cmd{}", i).into_bytes();
+        dir.add_child(Arc::new(RootFSNode::new_symlink(name, b"toybox".to_vec(), 10 + i as u64)));
+    }
+    assert_eq!(dir.find_child(b"cmd3").map(|c| c.ino), Some(13));
+    assert!(dir.find_child(b"cmd99").is_none());
+    println!("test:    SUCCESS - lookups below the threshold");
+
+    // 2. 超过阈值后经哈希表查找，每个名字都能找到
+    println!("test: 2. Testing hashed lookups...");
+    for i in DIR_INDEX_THRESHOLD..300 {
+        let name = format!("cmd{}", i).into_bytes();
+        dir.add_child(Arc::new(RootFSNode::new_symlink(name, b"toybox".to_vec(), 10 + i as u64)));
+    }
+    for i in 0..300 {
+        let name = format!("cmd{}", i).into_bytes();
+        assert_eq!(dir.find_child(&name).map(|c| c.ino), Some(10 + i as u64));
+    }
+    assert!(dir.find_child(b"cmd300").is_none());
+    assert!(dir.find_child(b"").is_none());
+    println!("test:    SUCCESS - 300 children found by name");
+
+    // 3. 遍历保持插入顺序，可以从中间继续
+    println!("test: 3. Testing ordered iteration...");
+    let all = names(&dir, 0);
+    assert_eq!(all.len(), 300);
+    assert_eq!(all[0], b"cmd0");
+    assert_eq!(all[299], b"cmd299");
+    let tail = names(&dir, 298);
+    assert_eq!(tail, [b"cmd298".to_vec(), b"cmd299".to_vec()]);
+    let mut count = 0;
+    dir.for_each_child(0, |_| {
+        count += 1;
+        count < 5
+    });
+    assert_eq!(count, 5);
+    println!("test:    SUCCESS - readdir order preserved");
+
+    // 4. 删除与改名后索引仍然正确
+    println!("test: 4. Testing remove and rename...");
+    assert!(dir.remove_child(b"cmd100"));
+    assert!(!dir.remove_child(b"cmd100"));
+    assert!(dir.find_child(b"cmd100").is_none());
+    assert_eq!(dir.find_child(b"cmd101").map(|c| c.ino), Some(111));
+    assert_eq!(names(&dir, 100)[0], b"cmd101");
+    assert!(dir.rename_child(b"cmd5", b"ls".to_vec()).is_ok());
+    assert!(dir.find_child(b"cmd5").is_none());
+    assert_eq!(dir.find_child(b"ls").map(|c| c.ino), Some(15));
+    assert!(dir.rename_child(b"cmd5", b"cat".to_vec()).is_err());
+    println!("test:    SUCCESS - index follows remove and rename");
+
+    // 5. 删到阈值以下退回顺序查找
+    println!("test: 5. Testing shrink below threshold...");
+    for i in 0..300 {
+        dir.remove_child(&format!("cmd{}", i).into_bytes());
+    }
+    assert!(dir.has_children());
+    assert_eq!(names(&dir, 0), [b"ls".to_vec()]);
+    assert_eq!(dir.find_child(b"ls").map(|c| c.ino), Some(15));
+    assert!(dir.remove_child(b"ls"));
+    assert!(!dir.has_children());
+    println!("test:    SUCCESS - empty directory after removing all children");
+
+    println!("test: ===== Directory Index Tests Completed =====");
+}
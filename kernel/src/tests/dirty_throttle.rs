@@ -0,0 +1,127 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：脏页限速与回写阈值
+//
+// 测试内容：
+// 1. 低于 freerun 不限速，超过 dirty_ratio 阈值同步回写
+// 2. 限速时间随全局位置和本设备的份额增加，不超过 MAX_PAUSE
+// 3. /proc/sys/vm 的 dirty_ratio / dirty_background_ratio 解析
+// 4. 每个后备设备分别统计脏页与回写完成数
+
+use alloc::sync::Arc;
+use alloc::vec;
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+use crate::errno::Errno;
+use crate::mm::filemap::{self, MappingSource};
+use crate::mm::page::PAGE_SIZE;
+use crate::mm::writeback::{
+    self, dirty_throttle, DirtyThrottle, DIRTY_RATELIMIT_PAGES, MAX_PAUSE,
+};
+use crate::println;
+
+/// 测试用后备设备上的文件，回写时只计数
+struct BdiFile {
+    size: AtomicUsize,
+}
+
+impl MappingSource for BdiFile {
+    fn size(&self) -> usize {
+        self.size.load(Ordering::Relaxed)
+    }
+
+    fn read_page(&self, _index: usize, buf: &mut [u8]) -> usize {
+        buf.fill(0);
+        buf.len()
+    }
+
+    fn bdi_id(&self) -> u64 {
+        u64::MAX - 1
+    }
+
+    fn write_pages(&self, _index: usize, _pages: &[usize]) -> Result<(), i32> {
+        Ok(())
+    }
+}
+
+fn pause_of(throttle: DirtyThrottle) -> u64 {
+    match throttle {
+        DirtyThrottle::Pause(pause) => pause,
+        other => panic!("expected a pause, got {:?}", other),
+    }
+}
+
+pub fn test_dirty_throttle() {
+    println!("test: ===== Testing Dirty Throttling =====");
+    let n = DIRTY_RATELIMIT_PAGES;
+
+    // 测试 1: freerun 与同步回写
+    println!("test: 1. Testing freerun and sync thresholds...");
+    // thresh = 2000, bg = 1000 -> freerun = 1500
+    assert_eq!(dirty_throttle(n, 1500, 2000, 1000, 100, 100), DirtyThrottle::FreeRun);
+    assert_eq!(dirty_throttle(0, 1900, 2000, 1000, 100, 100), DirtyThrottle::FreeRun);
+    assert_eq!(dirty_throttle(n, 2000, 2000, 1000, 100, 100), DirtyThrottle::Sync);
+    println!("test:    SUCCESS - writers run free below the midpoint");
+
+    // 测试 2: 按位置限速
+    println!("test: 2. Testing proportional pauses...");
+    let low = pause_of(dirty_throttle(n, 1600, 2000, 1000, 100, 100));
+    let high = pause_of(dirty_throttle(n, 1900, 2000, 1000, 100, 100));
+    assert!(low >= 1 && low < high, "pause should grow with dirty pages: {} {}", low, high);
+    assert!(high <= MAX_PAUSE);
+    // 本设备超过份额的写入者睡得更久，低于份额一半的睡得更少
+    let over = pause_of(dirty_throttle(n, 1900, 2000, 1000, 400, 100));
+    let under = pause_of(dirty_throttle(n, 1900, 2000, 1000, 10, 100));
+    assert!(under < high && high < over);
+    assert!(over <= MAX_PAUSE);
+    // 新脏页少时只睡对应的一部分
+    let few = pause_of(dirty_throttle(1, 1900, 2000, 1000, 100, 100));
+    assert!(few <= high);
+    println!("test:    SUCCESS - pauses {}..{} jiffies", under, over);
+
+    // 测试 3: 可调阈值
+    println!("test: 3. Testing vm.dirty_ratio tunables...");
+    let einval = Errno::InvalidArgument.as_neg_i32();
+    let (ratio, bg_ratio) = (writeback::dirty_ratio(), writeback::dirty_background_ratio());
+    assert_eq!(writeback::write_dirty_ratio(b"30\n"), Ok(3));
+    assert_eq!(writeback::dirty_ratio(), 30);
+    assert_eq!(writeback::write_dirty_background_ratio(b"5"), Ok(1));
+    assert_eq!(writeback::dirty_background_ratio(), 5);
+    assert_eq!(writeback::write_dirty_ratio(b"101"), Err(einval));
+    assert_eq!(writeback::write_dirty_ratio(b"many"), Err(einval));
+    assert_eq!(writeback::dirty_ratio(), 30);
+    writeback::write_dirty_ratio(alloc::format!("{}", ratio).as_bytes()).unwrap();
+    writeback::write_dirty_background_ratio(alloc::format!("{}", bg_ratio).as_bytes()).unwrap();
+    println!("test:    SUCCESS - ratios parsed and range checked");
+
+    // 测试 4: 每个后备设备的统计
+    println!("test: 4. Testing per-bdi dirty accounting...");
+    const TEST_INO: u64 = u64::MAX - 31;
+    let file = Arc::new(BdiFile { size: AtomicUsize::new(0) });
+    let mapping = filemap::get_mapping(TEST_INO, file.clone());
+    let wb = writeback::get_bdi(u64::MAX - 1);
+    assert_eq!(mapping.bdi().id(), wb.id());
+    let (dirty_before, written_before) = (wb.nr_dirty(), wb.nr_written());
+    let data = vec![0x33u8; 3 * PAGE_SIZE];
+    file.size.store(data.len(), Ordering::Relaxed);
+    assert_eq!(mapping.write_dirty(0, &data), data.len());
+    assert_eq!(wb.nr_dirty(), dirty_before + 3);
+    // 重写已经脏的页不再计数
+    assert_eq!(mapping.write_dirty(0, &data[..PAGE_SIZE]), PAGE_SIZE);
+    assert_eq!(wb.nr_dirty(), dirty_before + 3);
+    assert_eq!(mapping.writeback(), Ok(3));
+    assert_eq!(wb.nr_dirty(), dirty_before);
+    assert_eq!(wb.nr_written(), written_before + 3);
+    // 有回写完成后设备得到的份额不超过全局阈值
+    let share = wb.calc_thresh(1000);
+    assert!(share > 0 && share <= 1000);
+    assert!(writeback::bdi_list().iter().any(|b| b.id() == wb.id()));
+    mapping.truncate_pages(0);
+    filemap::remove_mapping(TEST_INO);
+    println!("test:    SUCCESS - bdi counts {} pages written", wb.nr_written() - written_before);
+
+    println!("test: Dirty throttling testing completed.");
+}
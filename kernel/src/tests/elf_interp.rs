@@ -0,0 +1,193 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：动态链接程序的加载
+//
+// 测试内容：
+// 1. 读出 PT_INTERP 路径与程序头表地址
+// 2. 主程序与解释器加载到各自的基址，auxv 信息正确
+// 3. 共享目标的私有文件映射在地址空间之间共享缓存页
+// 4. MAP_FIXED 替换原有映射，MAP_FIXED_NOREPLACE 拒绝重叠
+
+use alloc::vec;
+use alloc::vec::Vec;
+use crate::println;
+use crate::arch::riscv64::mm::{create_user_address_space, handle_mm_fault, map, AddressSpace, FaultFlags,
+                               MmFaultResult, VirtAddr};
+use crate::fs::binfmt_elf::{load_elf_binary, open_exec, ElfImage, ELF_ET_DYN_BASE, ELF_INTERP_BASE};
+use crate::fs::elf::{Elf64Ehdr, Elf64Phdr, ElfPtType, PF_R, PF_X};
+use crate::fs::rootfs;
+use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+use crate::mm::pagemap::{MapError, PageTableType};
+use crate::mm::vma::{VmaFlags, VmaType};
+
+const INTERP_PATH: &str = "/test_interp.so";
+const PROG_PATH: &str = "/test_dyn_prog";
+
+const PROG_ENTRY: u64 = 0x100;
+const INTERP_ENTRY: u64 = 0x80;
+const INTERP_OFFSET: usize = 0x200;
+
+fn phdr(p_type: ElfPtType, offset: u64, vaddr: u64, filesz: u64, flags: u32) -> Elf64Phdr {
+    Elf64Phdr {
+        p_type: p_type as u32,
+        p_flags: flags,
+        p_offset: offset,
+        p_vaddr: vaddr,
+        p_paddr: vaddr,
+        p_filesz: filesz,
+        p_memsz: filesz,
+        p_align: PAGE_SIZE as u64,
+    }
+}
+
+/// 构造一页大小的 ET_DYN 映像
+fn build_dyn(entry: u64, phdrs: &[Elf64Phdr]) -> Vec<u8> {
+    let mut e_ident = [0u8; 16];
+    e_ident[..8].copy_from_slice(&[0x7f, b'E', b'L', b'F', 2, 1, 1, 0]);
+    let ehdr = Elf64Ehdr {
+        e_ident,
+        e_type: 3,        // ET_DYN
+        e_machine: 243,   // EM_RISCV
+        e_version: 1,
+        e_entry: entry,
+        e_phoff: core::mem::size_of::<Elf64Ehdr>() as u64,
+        e_shoff: 0,
+        e_flags: 0,
+        e_ehsize: core::mem::size_of::<Elf64Ehdr>() as u16,
+        e_phentsize: core::mem::size_of::<Elf64Phdr>() as u16,
+        e_phnum: phdrs.len() as u16,
+        e_shentsize: 0,
+        e_shnum: 0,
+        e_shstrndx: 0,
+    };
+
+    let mut data = vec![0u8; PAGE_SIZE];
+    unsafe {
+        core::ptr::write_unaligned(data.as_mut_ptr() as *mut Elf64Ehdr, ehdr);
+        let phdr_ptr = data.as_mut_ptr().add(ehdr.e_phoff as usize) as *mut Elf64Phdr;
+        for (i, phdr) in phdrs.iter().enumerate() {
+            core::ptr::write_unaligned(phdr_ptr.add(i), *phdr);
+        }
+    }
+    data
+}
+
+fn build_prog() -> Vec<u8> {
+    let phoff = core::mem::size_of::<Elf64Ehdr>() as u64;
+    let interp_len = INTERP_PATH.len() as u64 + 1;
+    let phdrs = [
+        phdr(ElfPtType::PT_PHDR, phoff, phoff, 3 * core::mem::size_of::<Elf64Phdr>() as u64, PF_R),
+        phdr(ElfPtType::PT_INTERP, INTERP_OFFSET as u64, INTERP_OFFSET as u64, interp_len, PF_R),
+        phdr(ElfPtType::PT_LOAD, 0, 0, PAGE_SIZE as u64, PF_R | PF_X),
+    ];
+    let mut data = build_dyn(PROG_ENTRY, &phdrs);
+    data[INTERP_OFFSET..INTERP_OFFSET + INTERP_PATH.len()].copy_from_slice(INTERP_PATH.as_bytes());
+    data
+}
+
+fn build_interp() -> Vec<u8> {
+    build_dyn(INTERP_ENTRY, &[phdr(ElfPtType::PT_LOAD, 0, 0, PAGE_SIZE as u64, PF_R | PF_X)])
+}
+
+fn new_aspace() -> Option<AddressSpace> {
+    create_user_address_space().map(|ppn| unsafe { AddressSpace::new_with_type(ppn, PageTableType::User) })
+}
+
+/// 读缺页后返回 addr 映射的物理页
+fn fault_in(aspace: &AddressSpace, addr: usize) -> usize {
+    assert_eq!(handle_mm_fault(aspace, VirtAddr::new(addr as u64), FaultFlags::READ | FaultFlags::USER),
+               MmFaultResult::Handled);
+    aspace.translate(PageVirtAddr::new(addr)).expect("page not mapped").as_usize()
+}
+
+pub fn test_elf_interp() {
+    println!("test: ===== Testing ELF Interpreter Loading =====");
+
+    let sb_ptr = rootfs::get_rootfs();
+    if sb_ptr.is_null() {
+        println!("test:    SKIP - RootFS not initialized");
+        return;
+    }
+    let sb = unsafe { &*sb_ptr };
+    let _ = sb.create_file(INTERP_PATH, build_interp());
+    let _ = sb.create_file(PROG_PATH, build_prog());
+
+    // 测试 1: PT_INTERP 与程序头表
+    println!("test: 1. Testing PT_INTERP and PT_PHDR...");
+    let bin = open_exec(PROG_PATH).expect("open_exec failed");
+    assert!(bin.is_dyn());
+    assert_eq!(bin.interp_path().unwrap().as_deref(), Some(INTERP_PATH));
+    assert_eq!(bin.phdr_vaddr(), Some(core::mem::size_of::<Elf64Ehdr>()));
+    let interp = open_exec(INTERP_PATH).expect("open_exec interpreter failed");
+    assert_eq!(interp.interp_path(), Ok(None));
+    println!("test:    SUCCESS - interpreter path read through the page cache");
+
+    let (aspace, other) = match (new_aspace(), new_aspace()) {
+        (Some(a), Some(b)) => (a, b),
+        _ => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+
+    // 测试 2: 加载主程序与解释器
+    println!("test: 2. Testing load_elf_binary with an interpreter...");
+    let image = load_elf_binary(&aspace, &bin).expect("load_elf_binary failed");
+    assert_eq!(image, ElfImage {
+        start: ELF_INTERP_BASE as u64 + INTERP_ENTRY,
+        phdr: (ELF_ET_DYN_BASE + core::mem::size_of::<Elf64Ehdr>()) as u64,
+        phnum: 3,
+        base: ELF_INTERP_BASE as u64,
+        entry: ELF_ET_DYN_BASE as u64 + PROG_ENTRY,
+        image_end: ELF_ET_DYN_BASE + PAGE_SIZE,
+    });
+    let interp_vma = aspace.find_vma(PageVirtAddr::new(ELF_INTERP_BASE)).expect("interpreter VMA missing");
+    assert_eq!(interp_vma.vma_type(), VmaType::FileBacked);
+    assert!(aspace.find_vma(PageVirtAddr::new(ELF_ET_DYN_BASE)).is_some());
+    println!("test:    SUCCESS - execution starts at the interpreter with AT_BASE/AT_ENTRY set");
+
+    // 测试 3: 共享目标的私有映射共享缓存页
+    println!("test: 3. Testing shared object page sharing...");
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::EXEC | VmaFlags::PRIVATE);
+    let ino = interp.mapping.ino();
+    let lib = other
+        .mmap_file(PageVirtAddr::new(0), PAGE_SIZE, flags, ino, 0, map::MAP_PRIVATE)
+        .expect("mmap_file failed")
+        .as_usize();
+    let page = fault_in(&other, lib);
+    assert_eq!(Some(page), interp.mapping.find_page(0));
+    assert_eq!(fault_in(&aspace, ELF_INTERP_BASE), page);
+    assert_eq!(other.mmap_file(PageVirtAddr::new(0), PAGE_SIZE, flags, ino, 0x10, map::MAP_PRIVATE).err(),
+               Some(MapError::Invalid));
+    println!("test:    SUCCESS - both address spaces map the same cached page");
+
+    // 测试 4: MAP_FIXED 替换
+    println!("test: 4. Testing MAP_FIXED replacement...");
+    let mut anon_flags = VmaFlags::new();
+    anon_flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let anon = other
+        .mmap(PageVirtAddr::new(0), 2 * PAGE_SIZE, anon_flags, VmaType::Anonymous,
+              map::MAP_PRIVATE | map::MAP_ANONYMOUS)
+        .expect("anonymous mmap failed")
+        .as_usize();
+    assert_eq!(other.mmap_file(PageVirtAddr::new(anon), PAGE_SIZE, flags, ino, 0,
+                               map::MAP_PRIVATE | map::MAP_FIXED_NOREPLACE).err(),
+               Some(MapError::Invalid));
+    let fixed = other
+        .mmap_file(PageVirtAddr::new(anon), PAGE_SIZE, flags, ino, 0, map::MAP_PRIVATE | map::MAP_FIXED)
+        .expect("MAP_FIXED mmap_file failed")
+        .as_usize();
+    assert_eq!(fixed, anon);
+    assert_eq!(other.find_vma(PageVirtAddr::new(anon)).unwrap().vma_type(), VmaType::FileBacked);
+    assert_eq!(other.find_vma(PageVirtAddr::new(anon + PAGE_SIZE)).unwrap().vma_type(), VmaType::Anonymous);
+    assert_eq!(fault_in(&other, anon), page);
+    println!("test:    SUCCESS - MAP_FIXED replaces the overlapped part of the old mapping");
+
+    let _ = sb.unlink(PROG_PATH);
+    let _ = sb.unlink(INTERP_PATH);
+    println!("test: ELF interpreter loading testing completed.");
+}
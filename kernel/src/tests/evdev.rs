@@ -0,0 +1,93 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：evdev 输入事件设备
+//
+// 测试内容：
+// 1. 没有事件时不可读，非阻塞 read 返回 EAGAIN，缓冲区不足一个事件返回 EINVAL
+// 2. 鼠标移动和按键转换为 input_event 序列并以 SYN_REPORT 结束，一次 read 取出多个
+// 3. 每个打开的文件各自缓冲，关闭后不再接收事件
+// 4. 缓冲区溢出时丢弃旧事件并报告 SYN_DROPPED
+
+use alloc::vec::Vec;
+
+use crate::drivers::keyboard::ps2::KeyEvent;
+use crate::fs::char_dev::evdev_create_file;
+use crate::fs::file::{fput, poll_mask::*, File, FileFlags};
+use crate::input::evdev::{input_report, nr_clients, EVDEV_BUFFER_SIZE, EV_SYN, SYN_DROPPED, SYN_REPORT};
+use crate::input::{InputEvent, RawInputEvent, BTN_LEFT, EV_KEY, EV_REL, REL_X, REL_Y};
+use crate::println;
+
+const EVENT_SIZE: usize = core::mem::size_of::<RawInputEvent>();
+
+/// 读取最多 max 个事件，返回 (类型, 代码, 值)
+fn read_events(file: &File, max: usize) -> Result<Vec<(u16, u16, i32)>, isize> {
+    let mut buf = alloc::vec![RawInputEvent::default(); max];
+    let ret = unsafe { file.read(buf.as_mut_ptr() as *mut u8, max * EVENT_SIZE) };
+    if ret < 0 {
+        return Err(ret);
+    }
+    assert_eq!(ret as usize % EVENT_SIZE, 0);
+    Ok(buf[..ret as usize / EVENT_SIZE].iter().map(|e| (e.type_, e.code, e.value)).collect())
+}
+
+pub fn test_evdev() {
+    println!("test: ===== Testing evdev Input Device =====");
+    let clients = nr_clients();
+
+    // 测试 1: 空设备
+    println!("test: 1. Testing empty device...");
+    let file = evdev_create_file(FileFlags::O_RDONLY | FileFlags::O_NONBLOCK);
+    assert_eq!(nr_clients(), clients + 1);
+    assert_eq!(file.poll() & POLLIN, 0);
+    assert_eq!(read_events(&file, 4), Err(-11));
+    let mut small = [0u8; EVENT_SIZE - 1];
+    assert_eq!(unsafe { file.read(small.as_mut_ptr(), small.len()) }, -22);
+    println!("test:    SUCCESS - empty device is not readable");
+
+    // 测试 2: 事件序列与批量读取
+    println!("test: 2. Testing event packets and batch reads...");
+    input_report(InputEvent::MouseMove { dx: 3, dy: -2 });
+    input_report(InputEvent::MouseButton { left: true, right: false, middle: false });
+    input_report(InputEvent::MouseButton { left: true, right: false, middle: false });
+    input_report(InputEvent::Keyboard(KeyEvent::Press(0x1e)));
+    assert_eq!(file.poll() & POLLIN, POLLIN);
+    let events = read_events(&file, 16).expect("read");
+    assert_eq!(events, [
+        (EV_REL, REL_X, 3), (EV_REL, REL_Y, -2), (EV_SYN, SYN_REPORT, 0),
+        (EV_KEY, BTN_LEFT, 1), (EV_SYN, SYN_REPORT, 0),
+        (EV_KEY, 0x1e, 1), (EV_SYN, SYN_REPORT, 0),
+    ]);
+    // 缓冲区只取能放下的完整事件，剩下的留给下一次
+    input_report(InputEvent::MouseButton { left: false, right: false, middle: false });
+    assert_eq!(read_events(&file, 1), Ok(alloc::vec![(EV_KEY, BTN_LEFT, 0)]));
+    assert_eq!(read_events(&file, 4), Ok(alloc::vec![(EV_SYN, SYN_REPORT, 0)]));
+    println!("test:    SUCCESS - {} events in one read", events.len());
+
+    // 测试 3: 多个客户端
+    println!("test: 3. Testing per-client buffers...");
+    let other = evdev_create_file(FileFlags::O_RDONLY | FileFlags::O_NONBLOCK);
+    input_report(InputEvent::Keyboard(KeyEvent::Release(0x1e)));
+    assert_eq!(read_events(&file, 4).map(|e| e.len()), Ok(2));
+    assert_eq!(read_events(&other, 4).map(|e| e.len()), Ok(2));
+    fput(other);
+    assert_eq!(nr_clients(), clients + 1);
+    println!("test:    SUCCESS - each reader sees every event");
+
+    // 测试 4: 溢出
+    println!("test: 4. Testing overflow...");
+    for _ in 0..EVDEV_BUFFER_SIZE {
+        input_report(InputEvent::Keyboard(KeyEvent::Press(0x10)));
+    }
+    let events = read_events(&file, EVDEV_BUFFER_SIZE).expect("read");
+    assert!(events.len() < EVDEV_BUFFER_SIZE);
+    assert!(events.contains(&(EV_SYN, SYN_DROPPED, 0)));
+    assert_eq!(events.last(), Some(&(EV_SYN, SYN_REPORT, 0)));
+    fput(file);
+    assert_eq!(nr_clients(), clients);
+    println!("test:    SUCCESS - overflow reported with SYN_DROPPED");
+
+    println!("test: evdev testing completed.");
+}
@@ -0,0 +1,313 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 直接 I/O 单元测试
+//!
+//! 在内存盘上经临时的用户地址空间直接读写：偏移、地址或长度不对齐返回 EINVAL、
+//! 写入空洞时分配块并扩展 i_size、空洞读作 0 且文件末尾短读、
+//! 读之前回写范围内的脏页、写之后丢弃缓存页，以及写失败时仍被引用的页保持原内容
+
+use alloc::boxed::Box;
+use alloc::sync::Arc;
+use alloc::vec;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicBool, Ordering};
+use spin::Mutex;
+
+use crate::println;
+use crate::arch::riscv64::mm::{create_user_address_space, map, AddressSpace};
+use crate::drivers::blkdev::{GenDisk, ReqCmd, Request};
+use crate::fs::ext4::extent::{ext4_ext_map_blocks, ext4_ext_tree_init};
+use crate::fs::ext4::file::{ext4_dio_read, ext4_dio_write, ext4_file_read, ext4_file_write, ext4_mapping};
+use crate::fs::ext4::inode::{Ext4Inode, Ext4InodeOnDisk};
+use crate::fs::ext4::superblock::Ext4GroupDesc;
+use crate::fs::ext4::{replace_ext4_fs, Ext4FileSystem};
+use crate::mm::filemap::put_page;
+use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+use crate::mm::vma::{VmaFlags, VmaType};
+
+const BLOCK_SIZE: usize = 4096;
+const BLOCKS_PER_GROUP: usize = 256;
+/// 内存盘：0 号块为超级块，1 号块为块组描述符表，2 号块为块位图，4..8 为 inode 表
+const NR_BLOCKS: usize = 64;
+const BITMAP_BLOCK: u32 = 2;
+const INODE_TABLE: u32 = 4;
+const RESERVED_BLOCKS: usize = 8;
+/// 用户缓冲区页数
+const NR_USER_PAGES: usize = 4;
+
+const EIO: i32 = -5;
+const EINVAL: i32 = -22;
+
+static RAMDISK: Mutex<[u8; NR_BLOCKS * BLOCK_SIZE]> = Mutex::new([0; NR_BLOCKS * BLOCK_SIZE]);
+/// 置位时写请求返回 EIO
+static FAIL_WRITES: AtomicBool = AtomicBool::new(false);
+
+unsafe extern "C" fn ramdisk_request(req: &mut Request) {
+    let mut disk = RAMDISK.lock();
+    let mut off = req.sector as usize * 512;
+    let mut ret = 0;
+    match req.cmd_type {
+        ReqCmd::Read | ReqCmd::Write if off + req.nr_sectors as usize * 512 > disk.len() => ret = -5,  // EIO
+        ReqCmd::Write if FAIL_WRITES.load(Ordering::Relaxed) => ret = -5,  // EIO
+        ReqCmd::Read => {
+            if req.sg.is_empty() {
+                let len = req.buffer.len();
+                req.buffer.copy_from_slice(&disk[off..off + len]);
+            }
+            for &(addr, len) in &req.sg {
+                core::slice::from_raw_parts_mut(addr as *mut u8, len).copy_from_slice(&disk[off..off + len]);
+                off += len;
+            }
+        }
+        ReqCmd::Write => {
+            if req.sg.is_empty() {
+                disk[off..off + req.buffer.len()].copy_from_slice(&req.buffer);
+            }
+            for &(addr, len) in &req.sg {
+                disk[off..off + len].copy_from_slice(core::slice::from_raw_parts(addr as *const u8, len));
+                off += len;
+            }
+        }
+        _ => {}
+    }
+    if let Some(end_io) = req.end_io {
+        end_io(req, ret);
+    }
+}
+
+/// 文件偏移 pos 处第 seed 次写入的字节，相隔 256 字节的位置也不同
+fn pattern(pos: usize, seed: u8) -> u8 {
+    ((pos ^ (pos >> 9)) as u8).wrapping_add(seed.wrapping_mul(37))
+}
+
+/// 按文件偏移 pos 填充用户缓冲区开头的 len 字节，并记入文件内容模型
+fn fill_user(user: usize, pos: usize, len: usize, seed: u8, model: &mut Vec<u8>) {
+    if model.len() < pos + len {
+        model.resize(pos + len, 0);
+    }
+    for i in 0..len {
+        model[pos + i] = pattern(pos + i, seed);
+        unsafe { core::ptr::write_volatile((user + i) as *mut u8, model[pos + i]) };
+    }
+}
+
+/// 用户缓冲区开头的 len 字节等于文件 [pos, pos + len) 的内容
+fn check_user(user: usize, pos: usize, len: usize, model: &[u8]) {
+    for i in 0..len {
+        let byte = unsafe { core::ptr::read_volatile((user + i) as *const u8) };
+        assert_eq!(byte, model[pos + i], "file offset {}", pos + i);
+    }
+}
+
+fn poison_user(user: usize) {
+    unsafe { core::ptr::write_bytes(user as *mut u8, 0xAA, NR_USER_PAGES * PAGE_SIZE) };
+}
+
+/// 逻辑块 lblk 的物理块号，空洞为 0
+fn map_block(fs: &Ext4FileSystem, inode: &Ext4Inode, lblk: u64) -> u64 {
+    ext4_ext_map_blocks(fs, inode, lblk).expect("map_blocks failed").0
+}
+
+/// 磁盘上逻辑块 lblk 的内容等于文件模型
+fn check_disk(fs: &Ext4FileSystem, inode: &Ext4Inode, lblk: u64, model: &[u8]) {
+    let pblk = map_block(fs, inode, lblk) as usize;
+    assert_ne!(pblk, 0);
+    let start = lblk as usize * BLOCK_SIZE;
+    let end = model.len().min(start + BLOCK_SIZE);
+    let disk = RAMDISK.lock();
+    assert_eq!(&disk[pblk * BLOCK_SIZE..pblk * BLOCK_SIZE + end - start], &model[start..end]);
+}
+
+fn disk_block_used(block: u64) -> bool {
+    let disk = RAMDISK.lock();
+    disk[BITMAP_BLOCK as usize * BLOCK_SIZE + block as usize / 8] & (1 << (block % 8)) != 0
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_ext4_dio() {
+    println!("test: ===== Starting ext4 Direct I/O Tests =====");
+
+    const SSTATUS_SUM: usize = 0x40000;
+
+    let current = match crate::sched::current() {
+        Some(task) => task,
+        None => {
+            println!("test:    SKIP - no current task");
+            return;
+        }
+    };
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+
+    let disk: &'static mut GenDisk = Box::leak(Box::new(GenDisk::new("dio0", 243, 1, 512, None)));
+    disk.set_capacity((NR_BLOCKS * BLOCK_SIZE / 512) as u32);
+    disk.set_request_fn(ramdisk_request);
+    let disk: &'static GenDisk = disk;
+
+    let fs: &'static mut Ext4FileSystem = Box::leak(Box::new(Ext4FileSystem::new(disk)));
+    fs.blocks_per_group = BLOCKS_PER_GROUP as u32;
+    fs.inodes_per_group = 64;
+    fs.group_count = 1;
+    fs.total_blocks = NR_BLOCKS as u64;
+    fs.feature_incompat = 0x40;  // EXTENTS
+    fs.group_descs.push(Box::new(Ext4GroupDesc {
+        bg_block_bitmap: BITMAP_BLOCK,
+        bg_inode_bitmap: BITMAP_BLOCK + 1,
+        bg_inode_table: INODE_TABLE,
+        bg_free_blocks_count: (NR_BLOCKS - RESERVED_BLOCKS) as u16,
+        ..Default::default()
+    }));
+    {
+        // 元数据块与磁盘末尾之后的块已用
+        let mut ramdisk = RAMDISK.lock();
+        let bitmap = &mut ramdisk[BITMAP_BLOCK as usize * BLOCK_SIZE..][..BLOCK_SIZE];
+        bitmap[..RESERVED_BLOCKS / 8].fill(0xff);
+        bitmap[NR_BLOCKS / 8..BLOCKS_PER_GROUP / 8].fill(0xff);
+    }
+    // 直接写与回写只为全局实例的设备分配块
+    let fs_ptr: *mut Ext4FileSystem = fs;
+    let old_fs = replace_ext4_fs(fs_ptr);
+    let fs: &'static Ext4FileSystem = unsafe { &*fs_ptr };
+
+    let mut inode = Ext4Inode::from_disk(&Ext4InodeOnDisk::default(), 12);
+    inode.mode = 0o100644;
+    ext4_ext_tree_init(&mut inode);
+    let mut model: Vec<u8> = Vec::new();
+
+    // 用户缓冲区：预先填入的匿名页，直接 I/O 时固定
+    let aspace = Arc::new(unsafe { AddressSpace::new(root_ppn) });
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let user = aspace
+        .mmap(PageVirtAddr::new(0), NR_USER_PAGES * PAGE_SIZE, flags, VmaType::Anonymous,
+              map::MAP_PRIVATE | map::MAP_ANONYMOUS | map::MAP_POPULATE)
+        .expect("mmap failed")
+        .as_usize();
+    let old_mm = current.address_space_arc();
+    current.set_shared_address_space(Some(aspace.clone()));
+    let old_satp: u64;
+    let old_sstatus: usize;
+    unsafe {
+        core::arch::asm!("csrr {}, satp", out(reg) old_satp);
+        aspace.enable();
+        core::arch::asm!("csrrs {}, sstatus, {}", out(reg) old_sstatus, in(reg) SSTATUS_SUM);
+    }
+
+    // 1. 偏移、地址或长度不按扇区对齐
+    println!("test: 1. Testing alignment checks...");
+    for (offset, addr, len) in [(1, user, 512), (512, user + 8, 512), (0, user, 100)] {
+        assert_eq!(ext4_dio_read(fs, &inode, offset, addr, len), Err(EINVAL));
+        assert_eq!(ext4_dio_write(fs, &mut inode, offset, addr, len), Err(EINVAL));
+    }
+    assert_eq!(inode.get_size(), 0);
+    assert_eq!(map_block(fs, &inode, 0), 0);
+    println!("test:    SUCCESS - misaligned offset, address and length rejected with EINVAL");
+
+    // 2. 写入文件末尾之后：空洞立即分配块，i_size 扩展到写入末尾，inode 写回
+    println!("test: 2. Testing block allocation and i_size extension...");
+    fill_user(user, 2 * BLOCK_SIZE, 2 * BLOCK_SIZE, 1, &mut model);
+    assert_eq!(ext4_dio_write(fs, &mut inode, 2 * BLOCK_SIZE as u64, user, 2 * BLOCK_SIZE), Ok(2 * BLOCK_SIZE));
+    assert_eq!(inode.get_size(), 4 * BLOCK_SIZE as u64);
+    assert_eq!(fs.read_inode(12).map(|disk_inode| disk_inode.get_size()), Ok(4 * BLOCK_SIZE as u64));
+    assert_eq!(map_block(fs, &inode, 0), 0);
+    assert_eq!(map_block(fs, &inode, 1), 0);
+    for lblk in 2..4 {
+        check_disk(fs, &inode, lblk, &model);
+        assert!(disk_block_used(map_block(fs, &inode, lblk)));
+    }
+    // 数据直接写到磁盘，不留在页缓存
+    let mapping = ext4_mapping(fs, &inode);
+    assert_eq!(mapping.nr_cached_range(0, 4), 0);
+    println!("test:    SUCCESS - blocks {} and {} allocated, i_size {}",
+             map_block(fs, &inode, 2), map_block(fs, &inode, 3), inode.get_size());
+
+    // 3. 空洞读作 0；从最后一个扇区开始读，只返回到文件末尾的字节
+    println!("test: 3. Testing hole reads and short read at EOF...");
+    poison_user(user);
+    assert_eq!(ext4_dio_read(fs, &inode, BLOCK_SIZE as u64, user, 2 * BLOCK_SIZE), Ok(2 * BLOCK_SIZE));
+    check_user(user, BLOCK_SIZE, 2 * BLOCK_SIZE, &model);
+    assert!(model[BLOCK_SIZE..2 * BLOCK_SIZE].iter().all(|&b| b == 0));
+    poison_user(user);
+    let last_sector = 4 * BLOCK_SIZE - 512;
+    assert_eq!(ext4_dio_read(fs, &inode, last_sector as u64, user, 2048), Ok(512));
+    check_user(user, last_sector, 512, &model);
+    assert_eq!(ext4_dio_read(fs, &inode, 4 * BLOCK_SIZE as u64, user, 512), Ok(0));
+    assert_eq!(mapping.nr_cached_range(0, 4), 0);
+    println!("test:    SUCCESS - holes zero-filled, 512 of 2048 bytes read at EOF");
+
+    // 4. 读之前回写范围内的脏页：覆盖已有块的缓冲写，以及尚未分配块的追加
+    println!("test: 4. Testing writeback of dirty pages before reads...");
+    let mut data = vec![0u8; 3000];
+    for (i, byte) in data.iter_mut().enumerate() {
+        *byte = pattern(2 * BLOCK_SIZE + 100 + i, 3);
+    }
+    model[2 * BLOCK_SIZE + 100..2 * BLOCK_SIZE + 3100].copy_from_slice(&data);
+    assert_eq!(ext4_file_write(fs, &mut inode, 2 * BLOCK_SIZE as u64 + 100, &data), Ok(3000));
+    let tail = [0x5au8; 100];
+    model.extend_from_slice(&tail);
+    assert_eq!(ext4_file_write(fs, &mut inode, 4 * BLOCK_SIZE as u64, &tail), Ok(100));
+    assert_eq!(mapping.nr_dirty(), 2);
+    // 文件末尾不在扇区边界：返回到末尾为止
+    poison_user(user);
+    assert_eq!(ext4_dio_read(fs, &inode, 2 * BLOCK_SIZE as u64, user, 3 * BLOCK_SIZE), Ok(2 * BLOCK_SIZE + 100));
+    check_user(user, 2 * BLOCK_SIZE, 2 * BLOCK_SIZE + 100, &model);
+    assert_eq!(mapping.nr_dirty(), 0);
+    for lblk in 2..5 {
+        check_disk(fs, &inode, lblk, &model);
+    }
+    println!("test:    SUCCESS - dirty pages written back, append allocated block {}", map_block(fs, &inode, 4));
+
+    // 5. 写之后丢弃缓存页，缓冲读从磁盘读到新内容
+    println!("test: 5. Testing page cache invalidation after writes...");
+    let mut buf = vec![0u8; BLOCK_SIZE];
+    assert_eq!(ext4_file_read(fs, &inode, 2 * BLOCK_SIZE as u64, &mut buf), Ok(BLOCK_SIZE));
+    assert!(mapping.find_page(2).is_some());
+    fill_user(user, 2 * BLOCK_SIZE, BLOCK_SIZE, 5, &mut model);
+    assert_eq!(ext4_dio_write(fs, &mut inode, 2 * BLOCK_SIZE as u64, user, BLOCK_SIZE), Ok(BLOCK_SIZE));
+    assert!(mapping.find_page(2).is_none());
+    assert_eq!(ext4_file_read(fs, &inode, 2 * BLOCK_SIZE as u64, &mut buf), Ok(BLOCK_SIZE));
+    assert_eq!(&buf[..], &model[2 * BLOCK_SIZE..3 * BLOCK_SIZE]);
+    check_disk(fs, &inode, 2, &model);
+    println!("test:    SUCCESS - stale page dropped, buffered read sees the new data");
+
+    // 6. 仍被引用（如被 mmap）的页不能丢弃：写成功时复制新内容，写失败时保持磁盘上的旧内容
+    println!("test: 6. Testing pages that cannot be invalidated...");
+    let phys = mapping.grab_page(2).expect("grab_page failed");
+    let page = |i: usize| unsafe { core::ptr::read_volatile((phys + i) as *const u8) };
+    fill_user(user, 2 * BLOCK_SIZE, BLOCK_SIZE, 6, &mut model);
+    assert_eq!(ext4_dio_write(fs, &mut inode, 2 * BLOCK_SIZE as u64, user, BLOCK_SIZE), Ok(BLOCK_SIZE));
+    assert_eq!(mapping.find_page(2), Some(phys));
+    assert!((0..BLOCK_SIZE).all(|i| page(i) == model[2 * BLOCK_SIZE + i]));
+    let written = model.clone();
+    FAIL_WRITES.store(true, Ordering::Relaxed);
+    fill_user(user, 2 * BLOCK_SIZE, BLOCK_SIZE, 7, &mut model);
+    assert_eq!(ext4_dio_write(fs, &mut inode, 2 * BLOCK_SIZE as u64, user, BLOCK_SIZE), Err(EIO));
+    FAIL_WRITES.store(false, Ordering::Relaxed);
+    assert!((0..BLOCK_SIZE).all(|i| page(i) == written[2 * BLOCK_SIZE + i]));
+    check_disk(fs, &inode, 2, &written);
+    assert_eq!(inode.get_size(), written.len() as u64);
+    put_page(phys);
+    println!("test:    SUCCESS - pinned page updated on success, unchanged after EIO");
+
+    assert_eq!(mapping.nr_dirty(), 0);
+    mapping.truncate_pages(0);
+    unsafe {
+        if old_sstatus & SSTATUS_SUM == 0 {
+            core::arch::asm!("csrc sstatus, {}", in(reg) SSTATUS_SUM);
+        }
+        core::arch::asm!("csrw satp, {}", "sfence.vma zero, zero", in(reg) old_satp);
+    }
+    current.set_shared_address_space(old_mm);
+    aspace.mmput();
+    replace_ext4_fs(old_fs);
+
+    println!("test: ===== ext4 Direct I/O Tests Completed =====");
+}
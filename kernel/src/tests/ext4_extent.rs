@@ -0,0 +1,280 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 extent 树单元测试
+//!
+//! 在内存盘上向一个 inode 插入上千个不连续的 extent，树从 i_block 中的根加深到两层索引，
+//! 每一步之后逐个逻辑块检查映射与模型一致：
+//! 追加与中间插入引起的叶子分裂、第一个条目变小时上层索引的更新、与前后 extent 的合并、
+//! 未初始化 extent 写入时的分裂与转换、超过单个 extent 最大长度的范围
+
+use alloc::boxed::Box;
+use alloc::vec;
+use alloc::vec::Vec;
+use spin::Mutex;
+
+use crate::println;
+use crate::drivers::blkdev::{GenDisk, ReqCmd, Request};
+use crate::fs::ext4::extent::{
+    ext4_ext_convert_to_initialized, ext4_ext_insert_extent, ext4_ext_insert_unwritten, ext4_ext_map_blocks,
+    ext4_ext_tree_init, get_extent_header,
+};
+use crate::fs::ext4::inode::{Ext4Inode, Ext4InodeOnDisk};
+use crate::fs::ext4::mballoc::{ext4_mb_flush, ext4_mb_group_free};
+use crate::fs::ext4::superblock::Ext4GroupDesc;
+use crate::fs::ext4::Ext4FileSystem;
+
+const BLOCK_SIZE: usize = 4096;
+/// 一个块组，块位图正好占一个块
+const NR_BLOCKS: usize = 32768;
+/// 内存盘只保存元数据：0..16 为超级块、块组描述符表与块位图，
+/// 16..64 是唯一的空闲块，树节点都从这里分配；extent 指向的数据块从不读写
+const NR_DISK_BLOCKS: usize = 64;
+const FIRST_FREE_BLOCK: usize = 16;
+const BITMAP_BLOCK: u32 = 2;
+
+/// 顺序追加的 extent：第 i 个覆盖逻辑块 [10 + 4i, 13 + 4i)，每隔 5 个为未初始化的
+const NR_APPENDS: usize = 1500;
+/// 检查映射的逻辑块范围
+const NR_MODEL_BLOCKS: usize = 6300;
+/// 未初始化 extent 分裂与合并使用的逻辑块
+const UNWRITTEN_LBLK: u64 = 6100;
+
+static RAMDISK: Mutex<[u8; NR_DISK_BLOCKS * BLOCK_SIZE]> = Mutex::new([0; NR_DISK_BLOCKS * BLOCK_SIZE]);
+
+unsafe extern "C" fn ramdisk_request(req: &mut Request) {
+    let mut disk = RAMDISK.lock();
+    let mut off = req.sector as usize * 512;
+    let mut ret = 0;
+    match req.cmd_type {
+        ReqCmd::Read | ReqCmd::Write if off + req.nr_sectors as usize * 512 > disk.len() => ret = -5,  // EIO
+        ReqCmd::Read => {
+            if req.sg.is_empty() {
+                let len = req.buffer.len();
+                req.buffer.copy_from_slice(&disk[off..off + len]);
+            }
+            for &(addr, len) in &req.sg {
+                core::slice::from_raw_parts_mut(addr as *mut u8, len).copy_from_slice(&disk[off..off + len]);
+                off += len;
+            }
+        }
+        ReqCmd::Write => {
+            if req.sg.is_empty() {
+                disk[off..off + req.buffer.len()].copy_from_slice(&req.buffer);
+            }
+            for &(addr, len) in &req.sg {
+                disk[off..off + len].copy_from_slice(core::slice::from_raw_parts(addr as *const u8, len));
+                off += len;
+            }
+        }
+        _ => {}
+    }
+    if let Some(end_io) = req.end_io {
+        end_io(req, ret);
+    }
+}
+
+/// 第 i 个追加的 extent：(逻辑块, 物理块, 是否未初始化)
+fn append_extent(i: usize) -> (u64, u64, bool) {
+    (10 + 4 * i as u64, 100 + 4 * i as u64, i % 5 == 0)
+}
+
+/// 根节点的深度
+fn depth(inode: &Ext4Inode) -> u16 {
+    get_extent_header(&inode.block).eh_depth
+}
+
+/// 逐个逻辑块检查映射
+///
+/// model[lblk] 为已初始化的块映射到的物理块，空洞与未初始化的块为 None。
+/// 物理块号必须一致；返回的长度至少为 1，且不超过模型中从 lblk 起物理连续的部分或空洞；
+/// 模型末尾的空洞延伸到之后的 extent，不检查长度
+fn check_tree(fs: &Ext4FileSystem, inode: &Ext4Inode, model: &[Option<u64>]) {
+    let n = model.len();
+    let mut run = vec![1u64; n];
+    for l in (0..n - 1).rev() {
+        let cont = match (model[l], model[l + 1]) {
+            (Some(a), Some(b)) => b == a + 1,
+            (None, None) => true,
+            _ => false,
+        };
+        if cont {
+            run[l] = run[l + 1] + 1;
+        }
+    }
+    for l in 0..n {
+        let (pblk, len) = ext4_ext_map_blocks(fs, inode, l as u64).expect("map_blocks failed");
+        assert_eq!(pblk, model[l].unwrap_or(0));
+        assert!(len >= 1);
+        if model[l].is_some() || l as u64 + run[l] < n as u64 {
+            assert!(len <= run[l]);
+        }
+    }
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_ext4_extent() {
+    println!("test: ===== Starting ext4 Extent Tree Tests =====");
+
+    let disk: &'static mut GenDisk = Box::leak(Box::new(GenDisk::new("ext0", 245, 1, 512, None)));
+    disk.set_capacity((NR_BLOCKS * BLOCK_SIZE / 512) as u32);
+    disk.set_request_fn(ramdisk_request);
+    let disk: &'static GenDisk = disk;
+    {
+        let mut ramdisk = RAMDISK.lock();
+        let bitmap = &mut ramdisk[BITMAP_BLOCK as usize * BLOCK_SIZE..][..BLOCK_SIZE];
+        for i in (0..FIRST_FREE_BLOCK).chain(NR_DISK_BLOCKS..NR_BLOCKS) {
+            bitmap[i / 8] |= 1 << (i % 8);
+        }
+    }
+
+    let mut fs = Ext4FileSystem::new(disk);
+    fs.blocks_per_group = NR_BLOCKS as u32;
+    fs.inodes_per_group = 64;
+    fs.group_count = 1;
+    fs.total_blocks = NR_BLOCKS as u64;
+    fs.group_descs.push(Box::new(Ext4GroupDesc {
+        bg_block_bitmap: BITMAP_BLOCK,
+        bg_free_blocks_count: (NR_DISK_BLOCKS - FIRST_FREE_BLOCK) as u16,
+        ..Default::default()
+    }));
+
+    let mut inode = Ext4Inode::from_disk(&Ext4InodeOnDisk::default(), 12);
+    inode.mode = 0o100644;
+    ext4_ext_tree_init(&mut inode);
+    let mut model: Vec<Option<u64>> = vec![None; NR_MODEL_BLOCKS];
+
+    // 1. 根节点放满 4 个后加深为一层索引；4 个叶子放满后再加深一层
+    println!("test: 1. Testing depth growth on appends...");
+    for i in 0..NR_APPENDS {
+        let (lblk, pblk, unwritten) = append_extent(i);
+        if unwritten {
+            assert_eq!(ext4_ext_insert_unwritten(&fs, &mut inode, lblk, pblk, 3), Ok(()));
+        } else {
+            assert_eq!(ext4_ext_insert_extent(&fs, &mut inode, lblk, pblk, 3), Ok(()));
+            for k in 0..3 {
+                model[(lblk + k) as usize] = Some(pblk + k);
+            }
+        }
+        let expected = if i < 4 { 0 } else if i < 1360 { 1 } else { 2 };
+        assert_eq!(depth(&inode), expected);
+    }
+    // 4 个满的叶子、追加时新建的第 5 个叶子与第二层的索引块
+    assert_eq!(inode.blocks, 6 * (BLOCK_SIZE / 512) as u64);
+    assert_eq!(ext4_mb_flush(&fs), Ok(()));
+    assert_eq!(ext4_mb_group_free(&fs, 0), Some(42));
+    check_tree(&fs, &inode, &model);
+    // 第一个 extent 之前的空洞到它为止
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, 0), Ok((0, 10)));
+    println!("test:    SUCCESS - depth 0 -> 1 -> 2, every block maps");
+
+    // 2. 未初始化的 extent 按空洞读出，写入的部分分裂出来转为已初始化
+    println!("test: 2. Testing unwritten extent split...");
+    let (lblk, pblk, _) = append_extent(100);
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, lblk), Ok((0, 3)));
+    // 中间一块：分为三段，满的叶子随之分裂
+    assert_eq!(ext4_ext_convert_to_initialized(&fs, &mut inode, lblk + 1, 1), Ok(Some((pblk + 1, 1))));
+    model[(lblk + 1) as usize] = Some(pblk + 1);
+    assert_eq!(inode.blocks, 7 * (BLOCK_SIZE / 512) as u64);
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, lblk), Ok((0, 1)));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, lblk + 1), Ok((pblk + 1, 1)));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, lblk + 2), Ok((0, 1)));
+    // 整个 extent 与开头的一部分
+    let (lblk, pblk, _) = append_extent(200);
+    assert_eq!(ext4_ext_convert_to_initialized(&fs, &mut inode, lblk, 3), Ok(Some((pblk, 3))));
+    for k in 0..3 {
+        model[(lblk + k) as usize] = Some(pblk + k);
+    }
+    let (lblk, pblk, _) = append_extent(300);
+    assert_eq!(ext4_ext_convert_to_initialized(&fs, &mut inode, lblk, 2), Ok(Some((pblk, 2))));
+    for k in 0..2 {
+        model[(lblk + k) as usize] = Some(pblk + k);
+    }
+    // 已初始化的 extent 与空洞不转换
+    let (lblk, _, _) = append_extent(1);
+    assert_eq!(ext4_ext_convert_to_initialized(&fs, &mut inode, lblk, 1), Ok(None));
+    assert_eq!(ext4_ext_convert_to_initialized(&fs, &mut inode, lblk + 3, 1), Ok(None));
+    check_tree(&fs, &inode, &model);
+    println!("test:    SUCCESS - written parts split out of unwritten extents");
+
+    // 3. 在满的叶子中间插入：叶子对半分裂
+    println!("test: 3. Testing out-of-order inserts into a full leaf...");
+    for i in 700..760 {
+        let (lblk, _, _) = append_extent(i);
+        let pblk = 40000 + i as u64;
+        assert_eq!(ext4_ext_insert_extent(&fs, &mut inode, lblk + 3, pblk, 1), Ok(()));
+        model[(lblk + 3) as usize] = Some(pblk);
+    }
+    assert_eq!(inode.blocks, 8 * (BLOCK_SIZE / 512) as u64);
+    check_tree(&fs, &inode, &model);
+    println!("test:    SUCCESS - middle inserts split the leaf in halves");
+
+    // 4. 与前后 extent 合并：填上两个已初始化 extent 之间的空隙时三段合并为一个，
+    //    前面是未初始化的 extent 时只与后面合并
+    println!("test: 4. Testing merges with neighbours...");
+    for i in 1101..1104 {
+        let (lblk, pblk, _) = append_extent(i);
+        assert_eq!(ext4_ext_insert_extent(&fs, &mut inode, lblk + 3, pblk + 3, 1), Ok(()));
+        model[(lblk + 3) as usize] = Some(pblk + 3);
+    }
+    let (lblk, pblk, _) = append_extent(1101);
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, lblk), Ok((pblk, 15)));
+    assert_eq!(ext4_ext_insert_extent(&fs, &mut inode, lblk - 1, pblk - 1, 1), Ok(()));
+    model[(lblk - 1) as usize] = Some(pblk - 1);
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, lblk - 1), Ok((pblk - 1, 16)));
+    let (lblk, _, _) = append_extent(1100);
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, lblk), Ok((0, 3)));
+    check_tree(&fs, &inode, &model);
+    println!("test:    SUCCESS - contiguous neighbours merged");
+
+    // 5. 插入到第一个 extent 之前：两层索引的起始逻辑块都变小
+    println!("test: 5. Testing insert before the first extent...");
+    assert_eq!(inode.block[3], 10);
+    assert_eq!(ext4_ext_insert_extent(&fs, &mut inode, 0, 45000, 5), Ok(()));
+    for k in 0..5 {
+        model[k] = Some(45000 + k as u64);
+    }
+    assert_eq!(inode.block[3], 0);
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, 5), Ok((0, 5)));
+    check_tree(&fs, &inode, &model);
+    println!("test:    SUCCESS - indexes corrected up to the root");
+
+    // 6. 未初始化的 extent 分几次写完，写入的部分与已初始化的邻居合并，最后合为一个
+    println!("test: 6. Testing unwritten conversion merged back into one extent...");
+    let u = UNWRITTEN_LBLK;
+    assert_eq!(ext4_ext_insert_unwritten(&fs, &mut inode, u, 25000, 100), Ok(()));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, u + 50), Ok((0, 50)));
+    assert_eq!(ext4_ext_convert_to_initialized(&fs, &mut inode, u + 10, 5), Ok(Some((25010, 5))));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, u), Ok((0, 10)));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, u + 10), Ok((25010, 5)));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, u + 15), Ok((0, 85)));
+    assert_eq!(ext4_ext_convert_to_initialized(&fs, &mut inode, u, 10), Ok(Some((25000, 10))));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, u), Ok((25000, 15)));
+    // 超出 extent 末尾的部分不转换
+    assert_eq!(ext4_ext_convert_to_initialized(&fs, &mut inode, u + 90, 20), Ok(Some((25090, 10))));
+    assert_eq!(ext4_ext_convert_to_initialized(&fs, &mut inode, u + 15, 75), Ok(Some((25015, 75))));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, u), Ok((25000, 100)));
+    for k in 0..100 {
+        model[(u + k) as usize] = Some(25000 + k);
+    }
+    check_tree(&fs, &inode, &model);
+    println!("test:    SUCCESS - three pieces merged back after the last write");
+
+    // 7. 超过单个 extent 最大长度的范围按 32768 块（未初始化的为 32767 块）切段
+    println!("test: 7. Testing ranges longer than one extent...");
+    assert_eq!(ext4_ext_insert_unwritten(&fs, &mut inode, 7000, 60000, 40000), Ok(()));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, 7000), Ok((0, 32767)));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, 7000 + 32767), Ok((0, 7233)));
+    assert_eq!(ext4_ext_insert_extent(&fs, &mut inode, 50000, 100000, 40000), Ok(()));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, 50000), Ok((100000, 32768)));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, 50000 + 32768), Ok((132768, 7232)));
+    assert_eq!(ext4_ext_map_blocks(&fs, &inode, 90000), Ok((0, u64::MAX - 90000)));
+    check_tree(&fs, &inode, &model);
+    assert_eq!(ext4_mb_flush(&fs), Ok(()));
+    assert_eq!(ext4_mb_group_free(&fs, 0), Some(48 - (inode.blocks / (BLOCK_SIZE / 512) as u64) as u32));
+    println!("test:    SUCCESS - long ranges split at the extent length limit");
+
+    println!("test: ===== ext4 Extent Tree Tests Completed =====");
+}
@@ -0,0 +1,69 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 extent 状态缓存单元测试
+//!
+//! 测试按段缓存的块映射：查找、相邻段合并、重叠截断和空洞
+
+use crate::println;
+use crate::fs::ext4::extents_status::{ExtentStatus, ExtentStatusTree};
+
+#[cfg(feature = "unit-test")]
+pub fn test_ext4_extent_cache() {
+    println!("test: ===== Starting ext4 Extent Cache Tests =====");
+
+    // 测试 1: 查找与映射
+    println!("test: 1. Testing extent lookup...");
+    test_lookup();
+
+    // 测试 2: 合并与截断
+    println!("test: 2. Testing extent merge and clipping...");
+    test_merge();
+
+    println!("test: ===== ext4 Extent Cache Tests Completed =====");
+}
+
+fn test_lookup() {
+    let mut tree = ExtentStatusTree::new();
+    assert_eq!(tree.lookup(0), None);
+
+    tree.insert(ExtentStatus { lblk: 0, len: 8, pblk: 1000 });
+    tree.insert(ExtentStatus { lblk: 8, len: 4, pblk: 0 });
+    tree.insert(ExtentStatus { lblk: 20, len: 10, pblk: 5000 });
+
+    let es = tree.lookup(5).expect("block 5 should be cached");
+    assert_eq!(es.map(5), 1005);
+    assert!(tree.lookup(9).unwrap().is_hole());
+    assert_eq!(tree.lookup(9).unwrap().map(9), 0);
+    assert_eq!(tree.lookup(12), None);
+    assert_eq!(tree.lookup(29).unwrap().map(29), 5009);
+    assert_eq!(tree.lookup(30), None);
+    println!("test:    SUCCESS - cached extents resolve logical blocks");
+}
+
+fn test_merge() {
+    let mut tree = ExtentStatusTree::new();
+
+    // 物理上连续的相邻段合并为一段
+    tree.insert(ExtentStatus { lblk: 0, len: 4, pblk: 100 });
+    tree.insert(ExtentStatus { lblk: 8, len: 4, pblk: 108 });
+    tree.insert(ExtentStatus { lblk: 4, len: 4, pblk: 104 });
+    assert_eq!(tree.len(), 1);
+    assert_eq!(tree.lookup(11), Some(ExtentStatus { lblk: 0, len: 12, pblk: 100 }));
+
+    // 物理上不连续的相邻段不合并
+    tree.insert(ExtentStatus { lblk: 12, len: 4, pblk: 900 });
+    assert_eq!(tree.len(), 2);
+
+    // 与后一段重叠的部分被截掉
+    tree.insert(ExtentStatus { lblk: 20, len: 4, pblk: 2000 });
+    tree.insert(ExtentStatus { lblk: 16, len: 100, pblk: 0 });
+    assert_eq!(tree.lookup(19).unwrap().len, 4);
+    assert_eq!(tree.lookup(21).unwrap().map(21), 2001);
+
+    tree.clear();
+    assert_eq!(tree.len(), 0);
+    println!("test:    SUCCESS - adjacent extents merge, overlaps are clipped");
+}
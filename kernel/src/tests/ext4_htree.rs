@@ -0,0 +1,293 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 索引目录单元测试
+//!
+//! 1. 六种目录哈希的已知结果，取自 e2fsprogs 1.47 的 `debugfs -R "dx_hash -h HASHALG_n [-s seed] name"`，
+//!    默认种子与指定种子各一组，名字覆盖多组输入与高位字符（区分有符号与无符号版本）
+//! 2. 在内存盘上向单块目录插入目录项直到转换为索引目录并多次分裂叶子，
+//!    检查每个叶子的目录项落在索引给出的哈希区间内，每个名字都能经索引找到
+
+use alloc::boxed::Box;
+use alloc::format;
+use alloc::string::String;
+use alloc::vec::Vec;
+use spin::Mutex;
+
+use crate::println;
+use crate::drivers::blkdev::{GenDisk, ReqCmd, Request};
+use crate::fs::ext4::dir::file_type::{EXT4_FT_DIR, EXT4_FT_REG_FILE};
+use crate::fs::ext4::hash::{
+    ext4fs_dirhash, DxHashInfo, DX_HASH_HALF_MD4, DX_HASH_HALF_MD4_UNSIGNED, DX_HASH_LEGACY,
+    DX_HASH_LEGACY_UNSIGNED, DX_HASH_TEA, DX_HASH_TEA_UNSIGNED,
+};
+use crate::fs::ext4::namei::{ext4_add_entry, ext4_dx_find_entry, is_dx_dir, EXT4_INDEX_FL};
+use crate::fs::ext4::superblock::Ext4GroupDesc;
+use crate::fs::ext4::{mballoc, Ext4FileSystem};
+
+const BLOCK_SIZE: usize = 4096;
+const NR_BLOCKS: usize = 64;
+const INODE_TABLE: u32 = 4;
+/// 块 0..=10 为元数据与三个目录的第 0 块
+const FIRST_DIR_BLOCK: u32 = 8;
+const FIRST_FREE_BLOCK: usize = 11;
+/// 测试目录的 inode 号依次为 12、13、14
+const FIRST_DIR_INO: u32 = 12;
+/// 每个目录插入的目录项数：转换为索引目录后叶子分裂数次，仍在 12 个直接块内
+const NR_NAMES: usize = 800;
+
+/// 超级块标志：目录哈希按无符号字符计算 (EXT2_FLAGS_UNSIGNED_HASH)
+const EXT2_FLAGS_UNSIGNED_HASH: u32 = 0x2;
+/// 目录索引特性 (COMPAT_DIR_INDEX)
+const EXT4_FEATURE_COMPAT_DIR_INDEX: u32 = 0x20;
+/// dx_root 中 dx_root_info 的偏移
+const DX_ROOT_INFO: usize = 24;
+
+/// debugfs -s 11111111-2222-3333-4444-555555555555 对应的种子
+const SEED: [u32; 4] = [0x1111_1111, 0x3333_2222, 0x5555_4444, 0x5555_5555];
+
+/// (算法, 是否指定种子, 名字, 主哈希, 次哈希)
+const KNOWN_HASHES: &[(u8, bool, &[u8], u32, u32)] = &[
+    (DX_HASH_LEGACY, false, b"hello", 0x32252546, 0),
+    (DX_HASH_LEGACY, false, b"lost+found", 0x5e2aba24, 0),
+    (DX_HASH_LEGACY, false, b"caf\xe9", 0x65f23bce, 0),
+    (DX_HASH_LEGACY, false, b"a_rather_long_file_name_that_spans_two_chunks.txt", 0x119d6932, 0),
+    (DX_HASH_LEGACY, true, b"\xc3\xa9t\xc3\xa9_r\xc3\xa9sum\xc3\xa9_\xe2\x82\xac_over_thirty_two_bytes.dat", 0x542f976a, 0),
+    (DX_HASH_HALF_MD4, false, b"hello", 0x1746da32, 0x420013b5),
+    (DX_HASH_HALF_MD4, true, b"hello", 0xe4a977aa, 0xb8f2ce63),
+    (DX_HASH_HALF_MD4, false, b"lost+found", 0x591de422, 0x6ffc56e0),
+    (DX_HASH_HALF_MD4, true, b"caf\xe9", 0x42ecfa5a, 0x144aca96),
+    (DX_HASH_HALF_MD4, false, b"a_rather_long_file_name_that_spans_two_chunks.txt", 0x7d9be5f8, 0xacdaff12),
+    (DX_HASH_HALF_MD4, true, b"a_rather_long_file_name_that_spans_two_chunks.txt", 0x13ac24f4, 0x0b78fb0e),
+    (DX_HASH_HALF_MD4, false, b"\xc3\xa9t\xc3\xa9_r\xc3\xa9sum\xc3\xa9_\xe2\x82\xac_over_thirty_two_bytes.dat", 0x23b6360a, 0xb0e5523c),
+    (DX_HASH_TEA, false, b"hello", 0x6f5bb1a8, 0x231917c2),
+    (DX_HASH_TEA, true, b"hello", 0x4ad5910a, 0x413ecd8c),
+    (DX_HASH_TEA, false, b"caf\xe9", 0x84b3a194, 0x1cf71779),
+    (DX_HASH_TEA, true, b"lost+found", 0x66d30396, 0xdab5f5fe),
+    (DX_HASH_TEA, false, b"a_rather_long_file_name_that_spans_two_chunks.txt", 0x3f40d6a4, 0xa0dfa815),
+    (DX_HASH_TEA, true, b"\xc3\xa9t\xc3\xa9_r\xc3\xa9sum\xc3\xa9_\xe2\x82\xac_over_thirty_two_bytes.dat", 0x18f9d0c8, 0xfca1bb0e),
+    (DX_HASH_LEGACY_UNSIGNED, false, b"hello", 0x32252546, 0),
+    (DX_HASH_LEGACY_UNSIGNED, false, b"caf\xe9", 0x7c3849d0, 0),
+    (DX_HASH_LEGACY_UNSIGNED, true, b"\xc3\xa9t\xc3\xa9_r\xc3\xa9sum\xc3\xa9_\xe2\x82\xac_over_thirty_two_bytes.dat", 0xebeef040, 0),
+    (DX_HASH_HALF_MD4_UNSIGNED, false, b"lost+found", 0x591de422, 0x6ffc56e0),
+    (DX_HASH_HALF_MD4_UNSIGNED, false, b"caf\xe9", 0xab408964, 0x07893b5c),
+    (DX_HASH_HALF_MD4_UNSIGNED, true, b"caf\xe9", 0x4934ce16, 0xfa22c126),
+    (DX_HASH_HALF_MD4_UNSIGNED, false, b"\xc3\xa9t\xc3\xa9_r\xc3\xa9sum\xc3\xa9_\xe2\x82\xac_over_thirty_two_bytes.dat", 0xf6495b74, 0x1a2f4693),
+    (DX_HASH_HALF_MD4_UNSIGNED, true, b"\xc3\xa9t\xc3\xa9_r\xc3\xa9sum\xc3\xa9_\xe2\x82\xac_over_thirty_two_bytes.dat", 0x960261ec, 0xd8ff40dc),
+    (DX_HASH_TEA_UNSIGNED, false, b"hello", 0x6f5bb1a8, 0x231917c2),
+    (DX_HASH_TEA_UNSIGNED, false, b"caf\xe9", 0xe665cc26, 0x417d943d),
+    (DX_HASH_TEA_UNSIGNED, true, b"caf\xe9", 0x4cf144c6, 0x5dad3510),
+    (DX_HASH_TEA_UNSIGNED, false, b"\xc3\xa9t\xc3\xa9_r\xc3\xa9sum\xc3\xa9_\xe2\x82\xac_over_thirty_two_bytes.dat", 0x65e72306, 0x10dd7135),
+    (DX_HASH_TEA_UNSIGNED, true, b"\xc3\xa9t\xc3\xa9_r\xc3\xa9sum\xc3\xa9_\xe2\x82\xac_over_thirty_two_bytes.dat", 0x42d58380, 0x3c611b6f),
+];
+
+static RAMDISK: Mutex<[u8; NR_BLOCKS * BLOCK_SIZE]> = Mutex::new([0; NR_BLOCKS * BLOCK_SIZE]);
+
+unsafe extern "C" fn ramdisk_request(req: &mut Request) {
+    let mut disk = RAMDISK.lock();
+    let mut off = req.sector as usize * 512;
+    let mut ret = 0;
+    match req.cmd_type {
+        ReqCmd::Read | ReqCmd::Write if off + req.nr_sectors as usize * 512 > disk.len() => ret = -5,  // EIO
+        ReqCmd::Read => {
+            if req.sg.is_empty() {
+                let len = req.buffer.len();
+                req.buffer.copy_from_slice(&disk[off..off + len]);
+            }
+            for &(addr, len) in &req.sg {
+                core::slice::from_raw_parts_mut(addr as *mut u8, len).copy_from_slice(&disk[off..off + len]);
+                off += len;
+            }
+        }
+        ReqCmd::Write => {
+            if req.sg.is_empty() {
+                disk[off..off + req.buffer.len()].copy_from_slice(&req.buffer);
+            }
+            for &(addr, len) in &req.sg {
+                disk[off..off + len].copy_from_slice(core::slice::from_raw_parts(addr as *const u8, len));
+                off += len;
+            }
+        }
+        _ => {}
+    }
+    if let Some(end_io) = req.end_io {
+        end_io(req, ret);
+    }
+}
+
+fn get_u16(data: &[u8], off: usize) -> u16 {
+    u16::from_le_bytes([data[off], data[off + 1]])
+}
+
+fn get_u32(data: &[u8], off: usize) -> u32 {
+    u32::from_le_bytes([data[off], data[off + 1], data[off + 2], data[off + 3]])
+}
+
+/// 在内存盘上写入只有 '.' 和 '..' 的单块目录：inode 使用直接块映射
+fn make_dir(ino: u32, block: u32) {
+    let mut disk = RAMDISK.lock();
+    let raw = &mut disk[INODE_TABLE as usize * BLOCK_SIZE + (ino as usize - 1) * 256..][..256];
+    raw[0..2].copy_from_slice(&0o40755u16.to_le_bytes());
+    raw[4..8].copy_from_slice(&(BLOCK_SIZE as u32).to_le_bytes());
+    raw[0x1A..0x1C].copy_from_slice(&2u16.to_le_bytes());
+    raw[0x1C..0x20].copy_from_slice(&((BLOCK_SIZE / 512) as u32).to_le_bytes());
+    raw[0x28..0x2C].copy_from_slice(&block.to_le_bytes());
+
+    let data = &mut disk[block as usize * BLOCK_SIZE..][..BLOCK_SIZE];
+    data[0..4].copy_from_slice(&ino.to_le_bytes());
+    data[4..6].copy_from_slice(&12u16.to_le_bytes());
+    data[6] = 1;
+    data[7] = EXT4_FT_DIR;
+    data[8] = b'.';
+    data[12..16].copy_from_slice(&ino.to_le_bytes());
+    data[16..18].copy_from_slice(&((BLOCK_SIZE - 12) as u16).to_le_bytes());
+    data[18] = 2;
+    data[19] = EXT4_FT_DIR;
+    data[20..22].copy_from_slice(b"..");
+}
+
+/// 第 i 个目录项的名字：长度不同，部分带有高位字符
+fn entry_name(i: usize) -> String {
+    match i % 3 {
+        0 => format!("f{:04}", i),
+        1 => format!("caf\u{e9}_{:04}", i),
+        _ => format!("data_file_{:04}.bin", i),
+    }
+}
+
+/// 内存盘上的块
+fn disk_block(block: u64) -> Vec<u8> {
+    RAMDISK.lock()[block as usize * BLOCK_SIZE..][..BLOCK_SIZE].to_vec()
+}
+
+/// 检查索引：每个叶子的目录项哈希落在 [本项起始哈希, 下一项起始哈希) 内，
+/// 下一项带冲突标记时允许等于它的起始哈希
+///
+/// # 返回
+/// (叶子数, 叶子中的目录项数)
+fn check_index(block_map: &[u32; 15], info: &DxHashInfo) -> (usize, usize) {
+    let root = disk_block(block_map[0] as u64);
+    assert_eq!(root[DX_ROOT_INFO + 6], 0);
+    let base = DX_ROOT_INFO + root[DX_ROOT_INFO + 5] as usize;
+    let count = get_u16(&root, base + 2) as usize;
+    let start = |i: usize| if i == 0 { 0 } else { get_u32(&root, base + 8 * i) };
+
+    let mut nr_entries = 0;
+    for i in 0..count {
+        let lblk = get_u32(&root, base + 8 * i + 4) as usize;
+        let leaf = disk_block(block_map[lblk] as u64);
+        let lo = start(i) & !1;
+        let hi = if i + 1 < count { Some(start(i + 1)) } else { None };
+        let mut off = 0;
+        while off < BLOCK_SIZE {
+            let rec_len = get_u16(&leaf, off + 4) as usize;
+            assert!(rec_len >= 12 && off + rec_len <= BLOCK_SIZE);
+            if get_u32(&leaf, off) != 0 {
+                let name = &leaf[off + 8..off + 8 + leaf[off + 6] as usize];
+                let (hash, _) = ext4fs_dirhash(name, info).expect("hash");
+                assert!(hash >= lo);
+                if let Some(hi) = hi {
+                    assert!(hash < hi & !1 || (hi & 1 != 0 && hash == hi & !1));
+                }
+                nr_entries += 1;
+            }
+            off += rec_len;
+        }
+    }
+    (count, nr_entries)
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_ext4_htree() {
+    println!("test: ===== Starting ext4 Htree Directory Tests =====");
+
+    // 1. 已知结果
+    println!("test: 1. Testing dirhash known answers...");
+    for &(hash_version, seeded, name, major, minor) in KNOWN_HASHES {
+        let info = DxHashInfo { hash_version, seed: if seeded { SEED } else { [0; 4] } };
+        assert_eq!(ext4fs_dirhash(name, &info), Some((major, minor)));
+    }
+    // 有符号与无符号版本只在高位字符上不同
+    let signed = DxHashInfo { hash_version: DX_HASH_TEA, seed: [0; 4] };
+    let unsigned = DxHashInfo { hash_version: DX_HASH_TEA_UNSIGNED, seed: [0; 4] };
+    assert_eq!(ext4fs_dirhash(b"hello", &signed), ext4fs_dirhash(b"hello", &unsigned));
+    assert_ne!(ext4fs_dirhash(b"caf\xe9", &signed), ext4fs_dirhash(b"caf\xe9", &unsigned));
+    assert!(ext4fs_dirhash(b"hello", &DxHashInfo { hash_version: 6, seed: [0; 4] }).is_none());
+    println!("test:    SUCCESS - {} hashes match e2fsprogs", KNOWN_HASHES.len());
+
+    let disk: &'static mut GenDisk = Box::leak(Box::new(GenDisk::new("htree0", 247, 1, 512, None)));
+    disk.set_capacity((NR_BLOCKS * BLOCK_SIZE / 512) as u32);
+    disk.set_request_fn(ramdisk_request);
+    let disk: &'static GenDisk = disk;
+
+    {
+        let mut ramdisk = RAMDISK.lock();
+        let bitmap = &mut ramdisk[2 * BLOCK_SIZE..3 * BLOCK_SIZE];
+        for i in 0..FIRST_FREE_BLOCK {
+            bitmap[i / 8] |= 1 << (i % 8);
+        }
+    }
+    for i in 0..3 {
+        make_dir(FIRST_DIR_INO + i, FIRST_DIR_BLOCK + i);
+    }
+
+    let mut fs = Ext4FileSystem::new(disk);
+    fs.blocks_per_group = NR_BLOCKS as u32;
+    fs.inodes_per_group = 64;
+    fs.group_count = 1;
+    fs.total_blocks = NR_BLOCKS as u64;
+    fs.feature_compat = EXT4_FEATURE_COMPAT_DIR_INDEX;
+    fs.hash_seed = SEED;
+    fs.group_descs.push(Box::new(Ext4GroupDesc {
+        bg_block_bitmap: 2,
+        bg_inode_bitmap: 3,
+        bg_inode_table: INODE_TABLE,
+        bg_free_blocks_count: (NR_BLOCKS - FIRST_FREE_BLOCK) as u16,
+        ..Default::default()
+    }));
+
+    // 2. 每种算法建一个目录，插入到转换为索引目录并分裂若干次
+    let cases = [
+        ("half MD4", DX_HASH_HALF_MD4, 0, DX_HASH_HALF_MD4),
+        ("TEA unsigned", DX_HASH_TEA, EXT2_FLAGS_UNSIGNED_HASH, DX_HASH_TEA_UNSIGNED),
+        ("legacy", DX_HASH_LEGACY, 0, DX_HASH_LEGACY),
+    ];
+    for (i, &(label, def_hash_version, s_flags, effective)) in cases.iter().enumerate() {
+        println!("test: {}. Testing {} directory index and leaf splits...", i + 2, label);
+        fs.def_hash_version = def_hash_version;
+        fs.s_flags = s_flags;
+        let ino = FIRST_DIR_INO + i as u32;
+        let mut dir = fs.read_inode(ino).expect("read_inode failed");
+        assert!(!is_dx_dir(&fs, &dir));
+
+        for n in 0..NR_NAMES {
+            let name = entry_name(n);
+            assert_eq!(ext4_add_entry(&fs, &mut dir, &name, 1000 + n as u32, EXT4_FT_REG_FILE), Ok(()));
+        }
+        assert!(is_dx_dir(&fs, &dir));
+        assert_ne!(dir.flags & EXT4_INDEX_FL, 0);
+        let nr_blocks = (dir.size / BLOCK_SIZE as u64) as usize;
+        assert!(nr_blocks <= 12);
+
+        // 叶子的目录项与索引一致，每个名字都在一个叶子中
+        let info = DxHashInfo { hash_version: effective, seed: SEED };
+        let (leaves, entries) = check_index(&dir.block, &info);
+        assert_eq!(leaves, nr_blocks - 1);
+        assert!(leaves >= 4);
+        assert_eq!(entries, NR_NAMES);
+
+        // 每个名字都经索引找到，不存在的名字返回 ENOENT
+        for n in 0..NR_NAMES {
+            let entry = ext4_dx_find_entry(&fs, &dir, entry_name(n).as_bytes()).expect("dx lookup");
+            assert_eq!(entry.inode, 1000 + n as u32);
+        }
+        assert_eq!(ext4_dx_find_entry(&fs, &dir, b"f9999").map(|e| e.inode), Err(-2));
+        assert_eq!(ext4_add_entry(&fs, &mut dir, &entry_name(7), 1, EXT4_FT_REG_FILE), Err(-17));
+        mballoc::ext4_mb_discard_preallocations(&fs, ino);
+        println!("test:    SUCCESS - {} names in {} leaves found through the index", entries, leaves);
+    }
+
+    println!("test: ===== ext4 Htree Directory Tests Completed =====");
+}
@@ -0,0 +1,173 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 inline 数据单元测试
+//!
+//! 在内存盘上构造 inline 数据的 inode（i_block 加 system.data 扩展属性）：
+//! 经页缓存读取不访问数据块、在 inode 中改写、超出容量时报 ENOSPC、删除 inline 数据
+
+use alloc::boxed::Box;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicUsize, Ordering};
+use spin::Mutex;
+
+use crate::println;
+use crate::drivers::blkdev::{GenDisk, ReqCmd, Request};
+use crate::fs::ext4::file::ext4_file_read;
+use crate::fs::ext4::inline::{self, EXT4_FEATURE_INCOMPAT_INLINE_DATA, EXT4_INLINE_DATA_FL};
+use crate::fs::ext4::superblock::Ext4GroupDesc;
+use crate::fs::ext4::Ext4FileSystem;
+
+const BLOCK_SIZE: usize = 4096;
+const NR_BLOCKS: usize = 24;
+/// inode 表从 4 号块开始，12 号 inode 在其中的偏移
+const INODE_TABLE: u32 = 4;
+const INO: u32 = 12;
+const INODE_OFFSET: usize = INODE_TABLE as usize * BLOCK_SIZE + (INO as usize - 1) * 256;
+/// system.data 的值长度，文件最多 100 字节
+const XATTR_VALUE_SIZE: usize = 40;
+
+static RAMDISK: Mutex<[u8; NR_BLOCKS * BLOCK_SIZE]> = Mutex::new([0; NR_BLOCKS * BLOCK_SIZE]);
+/// 驱动收到的读请求数
+static NR_READS: AtomicUsize = AtomicUsize::new(0);
+
+unsafe extern "C" fn ramdisk_request(req: &mut Request) {
+    let mut disk = RAMDISK.lock();
+    let mut off = req.sector as usize * 512;
+    let mut ret = 0;
+    match req.cmd_type {
+        ReqCmd::Read | ReqCmd::Write if off + req.nr_sectors as usize * 512 > disk.len() => ret = -5,  // EIO
+        ReqCmd::Read => {
+            NR_READS.fetch_add(1, Ordering::Relaxed);
+            if req.sg.is_empty() {
+                let len = req.buffer.len();
+                req.buffer.copy_from_slice(&disk[off..off + len]);
+            }
+            for &(addr, len) in &req.sg {
+                core::slice::from_raw_parts_mut(addr as *mut u8, len).copy_from_slice(&disk[off..off + len]);
+                off += len;
+            }
+        }
+        ReqCmd::Write => {
+            if req.sg.is_empty() {
+                disk[off..off + req.buffer.len()].copy_from_slice(&req.buffer);
+            }
+            for &(addr, len) in &req.sg {
+                disk[off..off + len].copy_from_slice(core::slice::from_raw_parts(addr as *const u8, len));
+                off += len;
+            }
+        }
+        _ => {}
+    }
+    if let Some(end_io) = req.end_io {
+        end_io(req, ret);
+    }
+}
+
+/// 在内存盘上写入 inline 数据的 inode：i_extra_isize 为 32，
+/// 扩展属性区只有 system.data，值放在 inode 末尾
+fn make_inline_inode(data: &[u8]) {
+    let mut raw = [0u8; 256];
+    raw[0..2].copy_from_slice(&0o100644u16.to_le_bytes());
+    raw[4..8].copy_from_slice(&(data.len() as u32).to_le_bytes());
+    raw[0x1A..0x1C].copy_from_slice(&1u16.to_le_bytes());
+    raw[0x20..0x24].copy_from_slice(&EXT4_INLINE_DATA_FL.to_le_bytes());
+    let head = data.len().min(60);
+    raw[0x28..0x28 + head].copy_from_slice(&data[..head]);
+    raw[0x80..0x82].copy_from_slice(&32u16.to_le_bytes());
+
+    // 属性区：魔数、一项 system.data、结束标记
+    let first = 160 + 4;
+    let value = 256 - XATTR_VALUE_SIZE;
+    raw[160..164].copy_from_slice(&0xEA02_0000u32.to_le_bytes());
+    raw[first] = 4;
+    raw[first + 1] = 7;
+    raw[first + 2..first + 4].copy_from_slice(&((value - first) as u16).to_le_bytes());
+    raw[first + 8..first + 12].copy_from_slice(&(XATTR_VALUE_SIZE as u32).to_le_bytes());
+    raw[first + 16..first + 20].copy_from_slice(b"data");
+    raw[value..value + data.len() - head].copy_from_slice(&data[head..]);
+
+    RAMDISK.lock()[INODE_OFFSET..INODE_OFFSET + 256].copy_from_slice(&raw);
+}
+
+/// 当前磁盘上的 inode
+fn disk_inode() -> Vec<u8> {
+    RAMDISK.lock()[INODE_OFFSET..INODE_OFFSET + 256].to_vec()
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_ext4_inline() {
+    println!("test: ===== Starting ext4 Inline Data Tests =====");
+
+    let disk: &'static mut GenDisk = Box::leak(Box::new(GenDisk::new("inl0", 248, 1, 512, None)));
+    disk.set_capacity((NR_BLOCKS * BLOCK_SIZE / 512) as u32);
+    disk.set_request_fn(ramdisk_request);
+    let disk: &'static GenDisk = disk;
+
+    let content: Vec<u8> = (0..80u8).map(|i| b'a' + i % 26).collect();
+    make_inline_inode(&content);
+
+    let mut fs = Ext4FileSystem::new(disk);
+    fs.inodes_per_group = 256;
+    fs.group_count = 1;
+    fs.feature_incompat = EXT4_FEATURE_INCOMPAT_INLINE_DATA;
+    fs.group_descs.push(Box::new(Ext4GroupDesc {
+        bg_block_bitmap: 2,
+        bg_inode_bitmap: 3,
+        bg_inode_table: INODE_TABLE,
+        bg_free_blocks_count: 0,
+        bg_free_inodes_count: 0,
+        bg_used_dirs_count: 0,
+        bg_flags: 0,
+        bg_exclude_bitmap_lo: 0,
+        bg_block_bitmap_csum_lo: 0,
+        bg_inode_bitmap_csum_lo: 0,
+        bg_itable_unused_lo: 0,
+        bg_checksum: 0,
+    }));
+
+    // 1. 读取：i_block 与 system.data 拼成文件内容，读取时不再访问磁盘
+    println!("test: 1. Testing inline data read...");
+    let inode = fs.read_inode(INO).expect("read_inode failed");
+    assert!(inode.has_inline_data());
+    assert_eq!(inode.get_data_block(&fs, 0), Ok(0));
+    NR_READS.store(0, Ordering::Relaxed);
+    let mut buf = [0u8; 128];
+    assert_eq!(ext4_file_read(&fs, &inode, 0, &mut buf), Ok(80));
+    assert_eq!(&buf[..80], &content[..]);
+    assert_eq!(ext4_file_read(&fs, &inode, 70, &mut buf[..4]), Ok(4));
+    assert_eq!(&buf[..4], &content[70..74]);
+    assert_eq!(NR_READS.load(Ordering::Relaxed), 0);
+    println!("test:    SUCCESS - 80 bytes read from the inode without data block I/O");
+
+    // 2. 改写：前 60 字节进 i_block，其余进 system.data，容量为 100 字节
+    println!("test: 2. Testing inline data write...");
+    assert_eq!(fs.inline_max_size(&inode), Ok(60 + XATTR_VALUE_SIZE));
+    let mut inode = inode;
+    let new: Vec<u8> = (0..95u8).map(|i| i.wrapping_mul(7)).collect();
+    assert!(inline::ext4_write_inline_data(&fs, &mut inode, &new).is_ok());
+    inode.set_size(new.len() as u64);
+    let raw = disk_inode();
+    assert_eq!(&raw[0x28..0x28 + 60], &new[..60]);
+    let mut buf = [0u8; 128];
+    assert_eq!(inline::ext4_read_inline_data(&inode, &raw, 0, &mut buf), 95);
+    assert_eq!(&buf[..95], &new[..]);
+    let too_big = [0u8; 101];
+    assert!(inline::ext4_write_inline_data(&fs, &mut inode, &too_big).is_err());
+    println!("test:    SUCCESS - inline data rewritten in place, 101 bytes rejected");
+
+    // 3. 删除 inline 数据：标志、i_block 与 system.data 属性项都清除
+    println!("test: 3. Testing inline data destroy...");
+    assert!(inline::ext4_destroy_inline_data(&fs, &mut inode).is_ok());
+    assert!(!inode.has_inline_data());
+    assert!(inode.block.iter().all(|&b| b == 0));
+    let raw = disk_inode();
+    assert_eq!(u32::from_le_bytes([raw[0x20], raw[0x21], raw[0x22], raw[0x23]]) & EXT4_INLINE_DATA_FL, 0);
+    assert_eq!(inline::ext4_get_max_inline_size(&raw), 0);
+    assert!(raw[164..256].iter().all(|&b| b == 0));
+    println!("test:    SUCCESS - inode is now a plain file without data blocks");
+
+    println!("test: ===== ext4 Inline Data Tests Completed =====");
+}
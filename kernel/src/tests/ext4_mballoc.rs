@@ -0,0 +1,199 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 多块分配器单元测试
+//!
+//! 在三个块组的内存盘上分配与释放，每一步之后写回并检查磁盘上的块位图、
+//! 块组描述符的空闲计数与内存中的计数一致：
+//! 伙伴位图的分裂与合并、目标块、inode 的预分配窗口、跨块组的释放与换组分配
+
+use alloc::boxed::Box;
+use spin::Mutex;
+
+use crate::println;
+use crate::drivers::blkdev::{GenDisk, ReqCmd, Request};
+use crate::fs::ext4::mballoc::{
+    ext4_mb_discard_preallocations, ext4_mb_flush, ext4_mb_free_blocks, ext4_mb_group_free, ext4_mb_new_blocks,
+};
+use crate::fs::ext4::superblock::Ext4GroupDesc;
+use crate::fs::ext4::Ext4FileSystem;
+
+const BLOCK_SIZE: usize = 4096;
+const BLOCKS_PER_GROUP: usize = 256;
+const NR_GROUPS: usize = 3;
+/// 内存盘只保存元数据：0 号块为超级块，1 号块为块组描述符表，2..=4 为各组的块位图。
+/// 数据块从不读写，超出的请求返回 EIO
+const NR_DISK_BLOCKS: usize = 8;
+const GDT_BLOCK: usize = 1;
+const BITMAP_BLOCK: u32 = 2;
+/// 0 号组开头的 8 个块已被元数据占用
+const RESERVED_BLOCKS: usize = 8;
+
+static RAMDISK: Mutex<[u8; NR_DISK_BLOCKS * BLOCK_SIZE]> = Mutex::new([0; NR_DISK_BLOCKS * BLOCK_SIZE]);
+
+unsafe extern "C" fn ramdisk_request(req: &mut Request) {
+    let mut disk = RAMDISK.lock();
+    let mut off = req.sector as usize * 512;
+    let mut ret = 0;
+    match req.cmd_type {
+        ReqCmd::Read | ReqCmd::Write if off + req.nr_sectors as usize * 512 > disk.len() => ret = -5,  // EIO
+        ReqCmd::Read => {
+            if req.sg.is_empty() {
+                let len = req.buffer.len();
+                req.buffer.copy_from_slice(&disk[off..off + len]);
+            }
+            for &(addr, len) in &req.sg {
+                core::slice::from_raw_parts_mut(addr as *mut u8, len).copy_from_slice(&disk[off..off + len]);
+                off += len;
+            }
+        }
+        ReqCmd::Write => {
+            if req.sg.is_empty() {
+                disk[off..off + req.buffer.len()].copy_from_slice(&req.buffer);
+            }
+            for &(addr, len) in &req.sg {
+                disk[off..off + len].copy_from_slice(core::slice::from_raw_parts(addr as *const u8, len));
+                off += len;
+            }
+        }
+        _ => {}
+    }
+    if let Some(end_io) = req.end_io {
+        end_io(req, ret);
+    }
+}
+
+/// 磁盘上块组描述符的 bg_free_blocks_count
+fn disk_desc_free(group: usize) -> u16 {
+    let disk = RAMDISK.lock();
+    let off = GDT_BLOCK * BLOCK_SIZE + group * core::mem::size_of::<Ext4GroupDesc>() + 12;
+    u16::from_le_bytes([disk[off], disk[off + 1]])
+}
+
+/// 磁盘块位图中块 block 是否已用
+fn disk_block_used(block: u64) -> bool {
+    let group = block as usize / BLOCKS_PER_GROUP;
+    let bit = block as usize % BLOCKS_PER_GROUP;
+    let disk = RAMDISK.lock();
+    disk[(BITMAP_BLOCK as usize + group) * BLOCK_SIZE + bit / 8] & (1 << (bit % 8)) != 0
+}
+
+/// 写回后检查块组：位图中的空闲块数、描述符的空闲计数与内存中的计数都等于 free
+fn check_group(fs: &Ext4FileSystem, group: usize, free: u32) {
+    assert_eq!(ext4_mb_flush(fs), Ok(()));
+    let base = (group * BLOCKS_PER_GROUP) as u64;
+    let bitmap_free = (0..BLOCKS_PER_GROUP as u64).filter(|&i| !disk_block_used(base + i)).count();
+    assert_eq!(bitmap_free as u32, free);
+    assert_eq!(disk_desc_free(group) as u32, free);
+    assert_eq!(ext4_mb_group_free(fs, group), Some(free));
+}
+
+/// 检查磁盘位图中 [block, block + len) 全部已用或全部空闲
+fn check_range(block: u64, len: u64, used: bool) {
+    for b in block..block + len {
+        assert_eq!(disk_block_used(b), used);
+    }
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_ext4_mballoc() {
+    println!("test: ===== Starting ext4 Multi-Block Allocator Tests =====");
+
+    let disk: &'static mut GenDisk = Box::leak(Box::new(GenDisk::new("mb0", 246, 1, 512, None)));
+    disk.set_capacity((NR_GROUPS * BLOCKS_PER_GROUP * BLOCK_SIZE / 512) as u32);
+    disk.set_request_fn(ramdisk_request);
+    let disk: &'static GenDisk = disk;
+
+    let mut fs = Ext4FileSystem::new(disk);
+    fs.blocks_per_group = BLOCKS_PER_GROUP as u32;
+    fs.inodes_per_group = 64;
+    fs.group_count = NR_GROUPS as u32;
+    fs.total_blocks = (NR_GROUPS * BLOCKS_PER_GROUP) as u64;
+    {
+        let mut ramdisk = RAMDISK.lock();
+        for group in 0..NR_GROUPS {
+            let free = if group == 0 { BLOCKS_PER_GROUP - RESERVED_BLOCKS } else { BLOCKS_PER_GROUP };
+            let desc = Ext4GroupDesc {
+                bg_block_bitmap: BITMAP_BLOCK + group as u32,
+                bg_free_blocks_count: free as u16,
+                ..Default::default()
+            };
+            let off = GDT_BLOCK * BLOCK_SIZE + group * core::mem::size_of::<Ext4GroupDesc>();
+            ramdisk[off..off + 4].copy_from_slice(&desc.bg_block_bitmap.to_le_bytes());
+            ramdisk[off + 12..off + 14].copy_from_slice(&desc.bg_free_blocks_count.to_le_bytes());
+            fs.group_descs.push(Box::new(desc));
+        }
+        ramdisk[BITMAP_BLOCK as usize * BLOCK_SIZE] = 0xff;
+    }
+
+    // 1. 伙伴位图：按长度取 2^k 对齐的空闲段，释放的相邻块合并后可以整段分配
+    println!("test: 1. Testing buddy split and merge...");
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 0, 1), Ok((8, 1)));
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 0, 8), Ok((16, 8)));
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 0, 4), Ok((12, 4)));
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 0, 2), Ok((10, 2)));
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 0, 1), Ok((9, 1)));
+    check_range(0, 24, true);
+    check_range(24, 8, false);
+    check_group(&fs, 0, 232);
+    // 8..15 只空出一半时凑不成 8 块的对齐段
+    assert_eq!(ext4_mb_free_blocks(&fs, 12, 4), Ok(()));
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 0, 8), Ok((24, 8)));
+    for (block, len) in [(8, 1), (9, 1), (10, 2)] {
+        assert_eq!(ext4_mb_free_blocks(&fs, block, len), Ok(()));
+    }
+    check_range(8, 8, false);
+    check_group(&fs, 0, 232);
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 0, 8), Ok((8, 8)));
+    check_range(0, 32, true);
+    check_group(&fs, 0, 224);
+    println!("test:    SUCCESS - aligned runs split off and merged back");
+
+    // 2. 目标块空闲时从目标块开始，已用时在同组中另找
+    println!("test: 2. Testing goal block...");
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 100, 4), Ok((100, 4)));
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 306, 4), Ok((306, 4)));
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 100, 4), Ok((32, 4)));
+    check_range(100, 4, true);
+    check_group(&fs, 0, 216);
+    check_group(&fs, 1, 252);
+    println!("test:    SUCCESS - goal honored, fallback stays in the goal group");
+
+    // 3. 预分配窗口：顺序追加从窗口中取块，窗口在磁盘上仍是空闲块但不分给别人
+    println!("test: 3. Testing inode preallocation window...");
+    assert_eq!(ext4_mb_new_blocks(&fs, 20, 0, 128, 1), Ok((128, 1)));
+    assert_eq!(ext4_mb_new_blocks(&fs, 20, 1, 0, 4), Ok((129, 4)));
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 133, 1), Ok((36, 1)));
+    check_range(128, 5, true);
+    check_range(133, 59, false);
+    check_group(&fs, 0, 210);
+    ext4_mb_discard_preallocations(&fs, 20);
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 133, 1), Ok((133, 1)));
+    check_group(&fs, 0, 209);
+    println!("test:    SUCCESS - window feeds sequential appends, released on discard");
+
+    // 4. 跨块组释放，目标组已满时换到下一组
+    println!("test: 4. Testing frees across group boundaries...");
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 250, 6), Ok((250, 6)));
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 256, 6), Ok((256, 6)));
+    check_group(&fs, 0, 203);
+    check_group(&fs, 1, 246);
+    assert_eq!(ext4_mb_free_blocks(&fs, 250, 12), Ok(()));
+    check_range(250, 12, false);
+    check_group(&fs, 0, 209);
+    check_group(&fs, 1, 252);
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 512, 256), Ok((512, 256)));
+    check_group(&fs, 2, 0);
+    assert_eq!(ext4_mb_new_blocks(&fs, 0, 0, 600, 1), Ok((37, 1)));
+    assert_eq!(ext4_mb_free_blocks(&fs, 512, 256), Ok(()));
+    assert_eq!(ext4_mb_free_blocks(&fs, 37, 1), Ok(()));
+    check_group(&fs, 2, 256);
+    check_group(&fs, 0, 209);
+    // 超出文件系统的范围
+    assert_eq!(ext4_mb_free_blocks(&fs, 760, 20), Err(-22));
+    println!("test:    SUCCESS - counts follow frees spanning two groups");
+
+    println!("test: ===== ext4 Multi-Block Allocator Tests Completed =====");
+}
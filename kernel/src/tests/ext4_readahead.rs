@@ -0,0 +1,153 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 元数据预读单元测试
+//!
+//! 在内存盘上测试：breadahead 把相邻块合并为一个读请求且跳过已缓存的块、
+//! 读 inode 表时预读同组已用部分的后续块、flex_bg 下一次读入整个 flex 组的位图
+
+use alloc::boxed::Box;
+use core::sync::atomic::{AtomicUsize, Ordering};
+use spin::Mutex;
+
+use crate::println;
+use crate::drivers::blkdev::{GenDisk, ReqCmd, Request};
+use crate::fs::bio;
+use crate::fs::ext4::mballoc;
+use crate::fs::ext4::superblock::Ext4GroupDesc;
+use crate::fs::ext4::Ext4FileSystem;
+
+const BLOCK_SIZE: usize = 4096;
+const NR_BLOCKS: usize = 96;
+
+/// 内存盘：96 个 4KB 块
+static RAMDISK: Mutex<[u8; NR_BLOCKS * BLOCK_SIZE]> = Mutex::new([0; NR_BLOCKS * BLOCK_SIZE]);
+/// 驱动收到的读请求数与读入的块数
+static NR_READS: AtomicUsize = AtomicUsize::new(0);
+static NR_READ_BLOCKS: AtomicUsize = AtomicUsize::new(0);
+
+unsafe extern "C" fn ramdisk_request(req: &mut Request) {
+    let disk = RAMDISK.lock();
+    let mut off = req.sector as usize * 512;
+    let mut ret = 0;
+    if req.cmd_type == ReqCmd::Read {
+        NR_READS.fetch_add(1, Ordering::Relaxed);
+        NR_READ_BLOCKS.fetch_add(req.nr_sectors as usize * 512 / BLOCK_SIZE, Ordering::Relaxed);
+        if req.sg.is_empty() {
+            let end = off + req.buffer.len();
+            if end <= disk.len() {
+                req.buffer.copy_from_slice(&disk[off..end]);
+            } else {
+                ret = -5;  // EIO
+            }
+        } else {
+            for &(addr, len) in &req.sg {
+                core::slice::from_raw_parts_mut(addr as *mut u8, len).copy_from_slice(&disk[off..off + len]);
+                off += len;
+            }
+        }
+    }
+    if let Some(end_io) = req.end_io {
+        end_io(req, ret);
+    }
+}
+
+/// 自上次调用以来的 (读请求数, 读入块数)
+fn take_reads() -> (usize, usize) {
+    (NR_READS.swap(0, Ordering::Relaxed), NR_READ_BLOCKS.swap(0, Ordering::Relaxed))
+}
+
+fn group_desc(block_bitmap: u32, inode_bitmap: u32, inode_table: u32, itable_unused: u16) -> Box<Ext4GroupDesc> {
+    Box::new(Ext4GroupDesc {
+        bg_block_bitmap: block_bitmap,
+        bg_inode_bitmap: inode_bitmap,
+        bg_inode_table: inode_table,
+        bg_free_blocks_count: 0,
+        bg_free_inodes_count: 0,
+        bg_used_dirs_count: 0,
+        bg_flags: 0,
+        bg_exclude_bitmap_lo: 0,
+        bg_block_bitmap_csum_lo: 0,
+        bg_inode_bitmap_csum_lo: 0,
+        bg_itable_unused_lo: itable_unused,
+        bg_checksum: 0,
+    })
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_ext4_readahead() {
+    println!("test: ===== Starting ext4 Metadata Readahead Tests =====");
+
+    // 地址唯一的磁盘，块缓存中留下的缓冲区不会与以后的设备混淆
+    let disk: &'static mut GenDisk = Box::leak(Box::new(GenDisk::new("ra0", 249, 1, 512, None)));
+    disk.set_capacity((NR_BLOCKS * BLOCK_SIZE / 512) as u32);
+    disk.set_request_fn(ramdisk_request);
+    let disk: &'static GenDisk = disk;
+    for blk in 0..NR_BLOCKS {
+        RAMDISK.lock()[blk * BLOCK_SIZE] = blk as u8;
+    }
+
+    // 1. 相邻块合并读入，之后的 bread 命中缓存
+    println!("test: 1. Testing breadahead of contiguous blocks...");
+    let before = bio::buffer_cache_stats();
+    let blocks: alloc::vec::Vec<u64> = (1..9).collect();
+    assert_eq!(bio::breadahead(disk, &blocks), 8);
+    assert_eq!(take_reads(), (1, 8));
+    for blk in 1..9u64 {
+        let bh = bio::find_get_block(disk, blk).expect("block not cached");
+        assert_eq!(unsafe { (*bh).b_data[0] }, blk as u8);
+        bio::brelse(bh);
+    }
+    assert_eq!(take_reads(), (0, 0));
+    assert_eq!(bio::buffer_cache_stats().readahead - before.readahead, 8);
+    println!("test:    SUCCESS - 8 blocks read in one request and served from cache");
+
+    // 2. 已缓存的块跳过，不在缓存中的块 find_get_block 不读盘
+    println!("test: 2. Testing cached blocks are skipped...");
+    assert_eq!(bio::breadahead(disk, &[4, 5, 9]), 1);
+    assert_eq!(take_reads(), (1, 1));
+    assert!(bio::find_get_block(disk, 10).is_none());
+    assert_eq!(take_reads(), (0, 0));
+    println!("test:    SUCCESS - only the uncached block was read");
+
+    // 文件系统：每组 256 个 inode，inode 表 16 块，0 号组的后一半 inode 从未使用
+    let mut fs = Ext4FileSystem::new(disk);
+    fs.inodes_per_group = 256;
+    fs.feature_ro_compat = 0x10;  // GDT_CSUM
+    fs.feature_incompat = 0x200;  // FLEX_BG
+    fs.log_groups_per_flex = 2;
+    fs.group_count = 4;
+    fs.group_descs.push(group_desc(40, 44, 48, 128));
+    fs.group_descs.push(group_desc(41, 45, 64, 0));
+    fs.group_descs.push(group_desc(42, 46, 80, 0));
+    fs.group_descs.push(group_desc(43, 47, 0, 0));
+
+    // 3. inode 表预读：只读已用的 8 块；同一窗口内的 inode 不再读盘
+    println!("test: 3. Testing inode table readahead...");
+    assert!(fs.read_inode(1).is_ok());
+    assert_eq!(take_reads(), (1, 8));
+    assert!(fs.read_inode(100).is_ok());
+    assert_eq!(take_reads(), (0, 0));
+    // 1 号组的 inode 表全部在用，整张表 16 块一起读入
+    assert!(fs.read_inode(257).is_ok());
+    assert_eq!(take_reads(), (1, 16));
+    println!("test:    SUCCESS - inode table read ahead within the used range");
+
+    // 4. flex 组位图预读：4 个组的块位图与 inode 位图一起读入
+    println!("test: 4. Testing flex_bg bitmap prefetch...");
+    mballoc::ext4_mb_prefetch(&fs, 2, 42);
+    let (nr_reqs, nr_blocks) = take_reads();
+    assert_eq!(nr_blocks, 8);
+    assert!(nr_reqs <= 2, "bitmaps took {} requests", nr_reqs);
+    mballoc::ext4_mb_prefetch(&fs, 3, 43);
+    assert_eq!(take_reads(), (0, 0));
+    // 没有 flex_bg 时不预读
+    fs.feature_incompat = 0;
+    mballoc::ext4_mb_prefetch(&fs, 0, 60);
+    assert_eq!(take_reads(), (0, 0));
+    println!("test:    SUCCESS - flex group bitmaps read in {} request(s)", nr_reqs);
+
+    println!("test: ===== ext4 Metadata Readahead Tests Completed =====");
+}
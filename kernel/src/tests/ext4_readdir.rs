@@ -0,0 +1,115 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! ext4 目录游标单元测试
+//!
+//! 测试按块内偏移继续读取目录块：缓冲区满时停在放不下的一项、
+//! 游标落在记录中间时从之后的第一条继续、跳过已删除的记录、rec_len 损坏时报错
+
+use alloc::vec::Vec;
+
+use crate::println;
+use crate::fs::ext4::dir::ext4_readdir_block;
+
+const BLOCK_SIZE: usize = 1024;
+
+#[cfg(feature = "unit-test")]
+pub fn test_ext4_readdir() {
+    println!("test: ===== Starting ext4 Readdir Cursor Tests =====");
+
+    // 测试 1: 游标续读
+    println!("test: 1. Testing readdir cursor resume...");
+    test_resume();
+
+    // 测试 2: 记录中间的游标与已删除的记录
+    println!("test: 2. Testing unaligned cursor and deleted entries...");
+    test_unaligned_cursor();
+
+    // 测试 3: 损坏的目录块
+    println!("test: 3. Testing corrupted rec_len...");
+    test_corrupted();
+
+    println!("test: ===== ext4 Readdir Cursor Tests Completed =====");
+}
+
+/// 按 (inode, 名字, rec_len) 生成一个目录块，最后一条占满剩余空间
+fn make_block(entries: &[(u32, &str, usize)]) -> Vec<u8> {
+    let mut data = alloc::vec![0u8; BLOCK_SIZE];
+    let mut pos = 0;
+    for (i, &(ino, name, rec_len)) in entries.iter().enumerate() {
+        let rec_len = if i + 1 == entries.len() { BLOCK_SIZE - pos } else { rec_len };
+        data[pos..pos + 4].copy_from_slice(&ino.to_le_bytes());
+        data[pos + 4..pos + 6].copy_from_slice(&(rec_len as u16).to_le_bytes());
+        data[pos + 6] = name.len() as u8;
+        data[pos + 7] = 1;
+        data[pos + 8..pos + 8 + name.len()].copy_from_slice(name.as_bytes());
+        pos += rec_len;
+    }
+    data
+}
+
+fn test_resume() {
+    let block = make_block(&[(11, "a", 12), (12, "bb", 12), (13, "ccc", 12), (14, "dddd", 0)]);
+
+    // 只收两条：停在第三条的开头
+    let mut names = Vec::new();
+    let stop = ext4_readdir_block(&block, 0, |entry, _| {
+        if names.len() == 2 {
+            return false;
+        }
+        names.push(entry.inode);
+        true
+    })
+    .unwrap();
+    assert_eq!(names, [11, 12]);
+    assert_eq!(stop, 24);
+
+    // 从游标继续，d_off 是下一条的位置
+    let mut rest = Vec::new();
+    let end = ext4_readdir_block(&block, stop, |entry, next| {
+        rest.push((entry.inode, next));
+        true
+    })
+    .unwrap();
+    assert_eq!(rest, [(13, 36), (14, BLOCK_SIZE)]);
+    assert_eq!(end, BLOCK_SIZE);
+    println!("test:    SUCCESS - cursor resumes at the first unreported entry");
+}
+
+fn test_unaligned_cursor() {
+    // 第二条已删除
+    let block = make_block(&[(21, "x", 16), (0, "gone", 16), (23, "z", 16), (24, "w", 0)]);
+
+    let mut seen = Vec::new();
+    ext4_readdir_block(&block, 0, |entry, _| {
+        seen.push(entry.inode);
+        true
+    })
+    .unwrap();
+    assert_eq!(seen, [21, 23, 24]);
+
+    // 游标落在第三条记录中间：从第四条继续
+    let mut seen = Vec::new();
+    ext4_readdir_block(&block, 40, |entry, _| {
+        seen.push(entry.inode);
+        true
+    })
+    .unwrap();
+    assert_eq!(seen, [24]);
+    println!("test:    SUCCESS - unaligned cursor and deleted entries handled");
+}
+
+fn test_corrupted() {
+    let mut block = make_block(&[(31, "p", 12), (32, "q", 0)]);
+    // rec_len 为 0 会让遍历原地打转
+    block[4..6].copy_from_slice(&0u16.to_le_bytes());
+    assert!(ext4_readdir_block(&block, 0, |_, _| true).is_err());
+
+    // rec_len 越过块尾
+    let mut block = make_block(&[(31, "p", 12), (32, "q", 0)]);
+    block[16..18].copy_from_slice(&(BLOCK_SIZE as u16).to_le_bytes());
+    assert!(ext4_readdir_block(&block, 0, |_, _| true).is_err());
+    println!("test:    SUCCESS - corrupted rec_len reported as I/O error");
+}
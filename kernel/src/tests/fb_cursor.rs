@@ -0,0 +1,86 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：硬件光标 ioctl 参数检查
+//
+// 测试内容：
+// 1. 未知的 set 位、不带 SETIMAGE 的 SETHOT 返回 EINVAL
+// 2. 图像尺寸为 0 或超过 CURSOR_SIZE 返回 EINVAL，图像地址无效返回 EFAULT
+// 3. 参数有效但设备没有光标队列时返回 ENODEV
+//
+// 参数检查先于访问设备，都不会改变光标状态
+
+use crate::drivers::gpu::virtio_gpu::CURSOR_SIZE;
+use crate::drivers::gpu::{
+    fbdev_ioctl, with_gpu_device, FbHwCursor, FBIO_HWCURSOR, FB_HWCURSOR_SETHOT, FB_HWCURSOR_SETIMAGE,
+    FB_HWCURSOR_SETPOS,
+};
+use crate::println;
+
+const EFAULT: i64 = -14;
+const ENODEV: i64 = -19;
+const EINVAL: i64 = -22;
+
+/// 用户地址空间内、没有任何映射的地址
+const UNMAPPED: u64 = 0x10_0000_0000;
+
+fn cursor_ioctl(cursor: &FbHwCursor) -> i64 {
+    fbdev_ioctl(FBIO_HWCURSOR, cursor as *const FbHwCursor as usize)
+}
+
+/// 带 SETIMAGE 的参数，图像地址无效：尺寸检查通过时返回 EFAULT
+fn image_cursor(width: u32, height: u32) -> FbHwCursor {
+    FbHwCursor { set: FB_HWCURSOR_SETIMAGE, enable: 1, width, height, image: UNMAPPED, ..Default::default() }
+}
+
+pub fn test_fb_cursor() {
+    println!("test: ===== Testing Framebuffer Hardware Cursor =====");
+
+    if crate::drivers::gpu::get_framebuffer_info().is_none() {
+        // 没有帧缓冲区时所有 fbdev ioctl 都返回 ENXIO
+        assert_eq!(fbdev_ioctl(FBIO_HWCURSOR, 0), -6);
+        println!("test:    SKIP - no framebuffer");
+        println!("test: Framebuffer hardware cursor testing completed.");
+        return;
+    }
+
+    // 测试 1: set 位
+    println!("test: 1. Testing set bits...");
+    let hot = FbHwCursor { set: FB_HWCURSOR_SETHOT, enable: 1, hot_x: 3, hot_y: 3, ..Default::default() };
+    assert_eq!(cursor_ioctl(&hot), EINVAL);
+    let hot_pos = FbHwCursor { set: FB_HWCURSOR_SETHOT | FB_HWCURSOR_SETPOS, ..hot };
+    assert_eq!(cursor_ioctl(&hot_pos), EINVAL);
+    let unknown = FbHwCursor { set: FB_HWCURSOR_SETPOS | 0x08, enable: 1, ..Default::default() };
+    assert_eq!(cursor_ioctl(&unknown), EINVAL);
+    println!("test:    SUCCESS - SETHOT without SETIMAGE and unknown bits rejected");
+
+    // 测试 2: 图像尺寸与地址
+    println!("test: 2. Testing image size and address...");
+    for (width, height) in [(0, 16), (16, 0), (0, 0), (CURSOR_SIZE + 1, 16), (16, CURSOR_SIZE + 1), (u32::MAX, 1)] {
+        assert_eq!(cursor_ioctl(&image_cursor(width, height)), EINVAL, "{}x{}", width, height);
+    }
+    assert_eq!(cursor_ioctl(&image_cursor(CURSOR_SIZE, CURSOR_SIZE)), EFAULT);
+    let with_hot = FbHwCursor { set: FB_HWCURSOR_SETIMAGE | FB_HWCURSOR_SETHOT, ..image_cursor(1, 1) };
+    assert_eq!(cursor_ioctl(&with_hot), EFAULT);
+    // 参数本身的地址无效
+    assert_eq!(fbdev_ioctl(FBIO_HWCURSOR, UNMAPPED as usize), EFAULT);
+    println!("test:    SUCCESS - sizes outside 1..={} and bad images rejected", CURSOR_SIZE);
+
+    // 测试 3: 没有光标队列
+    println!("test: 3. Testing device without a cursor queue...");
+    match with_gpu_device(|gpu| gpu.has_cursor()) {
+        Some(false) => {
+            let pos = FbHwCursor { set: FB_HWCURSOR_SETPOS, enable: 1, x: 10, y: 10, ..Default::default() };
+            assert_eq!(cursor_ioctl(&pos), ENODEV);
+            let hide = FbHwCursor::default();
+            assert_eq!(cursor_ioctl(&hide), ENODEV);
+            println!("test:    SUCCESS - ENODEV without a cursor queue");
+        }
+        Some(true) => println!("test:    SKIP - device has a cursor queue"),
+        None => println!("test:    SKIP - no GPU device"),
+    }
+
+    println!("test: Framebuffer hardware cursor testing completed.");
+}
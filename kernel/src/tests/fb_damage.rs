@@ -0,0 +1,85 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：帧缓冲区损坏区域记录
+//
+// 测试内容：
+// 1. 矩形裁剪到屏幕范围，空矩形被丢弃
+// 2. 重叠矩形合并，合并结果再与其他矩形合并
+// 3. 不重叠的矩形分别保留，take 之后清空
+// 4. 超过 MAX_DAMAGE_RECTS 时合并为外接矩形
+// 5. FBIO_DAMAGE 拒绝无效地址
+
+use crate::drivers::gpu::{fbdev_ioctl, DamageList, DamageRect, FbDamage, FBIO_DAMAGE, MAX_DAMAGE_RECTS};
+use crate::println;
+
+pub fn test_fb_damage() {
+    println!("test: ===== Testing Framebuffer Damage Tracking =====");
+
+    // 测试 1: 裁剪
+    println!("test: 1. Testing clipping...");
+    let mut damage = DamageList::new(640, 480);
+    damage.add(DamageRect::new(600, 400, 100, 100));
+    damage.add(DamageRect::new(700, 0, 10, 10));
+    damage.add(DamageRect::new(10, 10, 0, 5));
+    damage.add(DamageRect::new(u32::MAX, 1, u32::MAX, 1));
+    assert_eq!(damage.rects(), [DamageRect::new(600, 400, 40, 80)]);
+    println!("test:    SUCCESS - rects clipped to the screen");
+
+    // 测试 2: 重叠合并
+    println!("test: 2. Testing overlap coalescing...");
+    let mut damage = DamageList::new(640, 480);
+    damage.add(DamageRect::new(0, 0, 10, 10));
+    damage.add(DamageRect::new(100, 0, 10, 10));
+    assert_eq!(damage.rects().len(), 2);
+    // 同时与两个矩形重叠，三者合并为一个
+    damage.add(DamageRect::new(5, 5, 100, 2));
+    assert_eq!(damage.rects(), [DamageRect::new(0, 0, 110, 10)]);
+    println!("test:    SUCCESS - overlapping rects merged transitively");
+
+    // 测试 3: 不重叠的矩形
+    println!("test: 3. Testing disjoint rects...");
+    let mut damage = DamageList::new(640, 480);
+    damage.add(DamageRect::new(0, 0, 16, 16));
+    // 只共享边的矩形不算重叠
+    damage.add(DamageRect::new(16, 0, 16, 16));
+    assert_eq!(damage.rects().len(), 2);
+    assert_eq!(damage.bounding(), Some(DamageRect::new(0, 0, 32, 16)));
+    let total: u64 = damage.rects().iter().map(|r| r.area()).sum();
+    assert_eq!(total, 2 * 16 * 16);
+    assert_eq!(damage.take().len(), 2);
+    assert!(damage.is_empty());
+    assert_eq!(damage.bounding(), None);
+    println!("test:    SUCCESS - disjoint rects kept apart");
+
+    // 测试 4: 上限
+    println!("test: 4. Testing rect limit...");
+    let mut damage = DamageList::new(640, 480);
+    for i in 0..MAX_DAMAGE_RECTS as u32 {
+        damage.add(DamageRect::new(i * 20, 0, 8, 8));
+    }
+    assert_eq!(damage.rects().len(), MAX_DAMAGE_RECTS);
+    damage.add(DamageRect::new(0, 100, 8, 8));
+    assert_eq!(damage.rects(), [DamageRect::new(0, 0, (MAX_DAMAGE_RECTS as u32 - 1) * 20 + 8, 108)]);
+    damage.add_all();
+    assert_eq!(damage.rects(), [DamageRect::new(0, 0, 640, 480)]);
+    println!("test:    SUCCESS - list collapses to the bounding rect");
+
+    // 测试 5: ioctl 参数
+    println!("test: 5. Testing FBIO_DAMAGE arguments...");
+    if crate::drivers::gpu::get_framebuffer_info().is_none() {
+        // 没有帧缓冲区时所有 fbdev ioctl 都返回 ENXIO
+        assert_eq!(fbdev_ioctl(FBIO_DAMAGE, 0), -6);
+        println!("test:    SKIP - no framebuffer");
+    } else {
+        // 参数必须在用户地址空间内，内核地址同样返回 EFAULT
+        let args = FbDamage { num_rects: 1, flags: 0, rects: 0 };
+        assert_eq!(fbdev_ioctl(FBIO_DAMAGE, &args as *const FbDamage as usize), -14);
+        assert_eq!(fbdev_ioctl(FBIO_DAMAGE, usize::MAX - 4), -14);
+        println!("test:    SUCCESS - bad addresses rejected");
+    }
+
+    println!("test: Framebuffer damage testing completed.");
+}
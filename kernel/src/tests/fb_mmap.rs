@@ -0,0 +1,85 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：帧缓冲区映射 (mmap_pfn)
+//
+// 测试内容：
+// 1. 由内核选址，起始地址与物理地址保持相同的 2MB 内偏移，登记为 Device VMA
+// 2. 第二次映射不与第一次重叠，两处访问同一块物理内存
+// 3. 空闲的建议地址被采用，冲突的建议地址重新选址，未对齐的物理地址被拒绝
+// 4. munmap 后页表项清除，后备内存不被释放
+
+use alloc::vec;
+
+use crate::arch::riscv64::mm::{create_user_address_space, AddressSpace, PageTableEntry, HPAGE_SIZE};
+use crate::mm::page::{VirtAddr, PAGE_SIZE};
+use crate::mm::pagemap::MapError;
+use crate::mm::vma::{VmaFlags, VmaType};
+use crate::println;
+
+const FB_PAGES: usize = 4;
+
+pub fn test_fb_mmap() {
+    println!("test: ===== Testing Framebuffer mmap =====");
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new(root_ppn) };
+
+    // 内核堆恒等映射，页对齐的部分直接作为"帧缓冲区"的物理内存
+    let backing = vec![0x5au8; (FB_PAGES + 1) * PAGE_SIZE];
+    let phys = (backing.as_ptr() as usize + PAGE_SIZE - 1) & !(PAGE_SIZE - 1);
+    let len = FB_PAGES * PAGE_SIZE;
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::SHARED);
+    let pte = PageTableEntry::V | PageTableEntry::U | PageTableEntry::R | PageTableEntry::W;
+
+    // 测试 1: 内核选址
+    println!("test: 1. Testing kernel-chosen address...");
+    let first = aspace.mmap_pfn(VirtAddr::new(0), phys, len, flags, pte).expect("mmap_pfn");
+    assert_eq!(first.as_usize() % HPAGE_SIZE, phys % HPAGE_SIZE);
+    assert_eq!(aspace.translate(first).map(|p| p.as_usize()), Some(phys));
+    let vma = aspace.find_vma(first).expect("vma");
+    assert_eq!(vma.vma_type(), VmaType::Device);
+    assert_eq!(vma.end().as_usize() - vma.start().as_usize(), len);
+    println!("test:    SUCCESS - mapped at {:#x}", first.as_usize());
+
+    // 测试 2: 第二个映射者
+    println!("test: 2. Testing a second mapping...");
+    let second = aspace.mmap_pfn(VirtAddr::new(0), phys, len, flags, pte).expect("mmap_pfn");
+    assert!(second.as_usize() >= first.as_usize() + len || second.as_usize() + len <= first.as_usize());
+    let last = (FB_PAGES - 1) * PAGE_SIZE;
+    assert_eq!(aspace.translate(VirtAddr::new(second.as_usize() + last)).map(|p| p.as_usize()),
+               Some(phys + last));
+    println!("test:    SUCCESS - second mapping at {:#x}", second.as_usize());
+
+    // 测试 3: 建议地址
+    println!("test: 3. Testing address hints...");
+    let relocated = aspace.mmap_pfn(first, phys, PAGE_SIZE, flags, pte).expect("mmap_pfn");
+    assert_ne!(relocated, first);
+    let hint = VirtAddr::new(relocated.as_usize() + 64 * HPAGE_SIZE);
+    assert_eq!(aspace.mmap_pfn(hint, phys, PAGE_SIZE, flags, pte), Ok(hint));
+    assert_eq!(aspace.mmap_pfn(VirtAddr::new(0), phys + 1, PAGE_SIZE, flags, pte), Err(MapError::Invalid));
+    println!("test:    SUCCESS - free hints kept, conflicting hints moved");
+
+    // 测试 4: munmap
+    println!("test: 4. Testing munmap...");
+    assert_eq!(aspace.munmap(first, len), Ok(()));
+    assert!(aspace.translate(first).is_none());
+    assert!(aspace.find_vma(first).is_none());
+    assert_eq!(aspace.translate(second).map(|p| p.as_usize()), Some(phys));
+    for addr in [second, relocated, hint] {
+        aspace.munmap(addr, PAGE_SIZE).ok();
+    }
+    aspace.munmap(second, len).ok();
+    assert!(backing.iter().all(|&b| b == 0x5a));
+    println!("test:    SUCCESS - backing memory left to the driver");
+
+    println!("test: Framebuffer mmap testing completed.");
+}
@@ -0,0 +1,111 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：位图分配与无锁查找的文件描述符表
+//
+// 测试内容：
+// 1. 总是分配最小的空闲描述符，跨越已满的字
+// 2. 描述符数组按需扩展，扩展后原有文件仍可查到，NR_OPEN_MAX 为上限
+// 3. 查找与关闭的引用计数，未安装的描述符可以释放
+// 4. 描述符表未共享时 fdget 不增加引用计数
+
+use alloc::sync::Arc;
+use crate::println;
+use crate::fs::file::{fdget, FdTable, File, FileFlags, NR_OPEN_MAX};
+
+fn new_file() -> Arc<File> {
+    Arc::new(File::new(FileFlags::new(FileFlags::O_RDONLY)))
+}
+
+pub fn test_fdtable_rcu() {
+    println!("test: ===== Testing Lock-free FdTable =====");
+
+    // 测试 1: 最小空闲描述符
+    println!("test: 1. Testing lowest free fd allocation...");
+    let fdtable = FdTable::new();
+    for expect in 0..70 {
+        assert_eq!(fdtable.alloc_fd(), Some(expect));
+    }
+    assert_eq!(fdtable.close_fd(5), Ok(()));
+    assert_eq!(fdtable.close_fd(66), Ok(()));
+    assert_eq!(fdtable.close_fd(5), Err(()));
+    assert_eq!(fdtable.alloc_fd(), Some(5));
+    assert_eq!(fdtable.alloc_fd(), Some(66));
+    assert_eq!(fdtable.alloc_fd(), Some(70));
+    assert_eq!(fdtable.open_count(), 71);
+    println!("test:    SUCCESS - freed fds are reused lowest first");
+
+    // 测试 2: 数组扩展
+    println!("test: 2. Testing fd array expansion...");
+    let fdtable = FdTable::new();
+    let first = new_file();
+    assert_eq!(fdtable.install_fd(3, first.clone()), Ok(()));
+    assert_eq!(fdtable.max_fds(), 64);
+    assert_eq!(fdtable.install_fd(200, new_file()), Ok(()));
+    assert_eq!(fdtable.max_fds(), 256);
+    assert!(Arc::ptr_eq(&fdtable.get_file(3).unwrap(), &first));
+    assert!(fdtable.get_file(200).is_some());
+    assert!(fdtable.get_file(201).is_none());
+    assert!(fdtable.install_fd(200, new_file()).is_err());
+    assert!(fdtable.install_fd(NR_OPEN_MAX, new_file()).is_err());
+    assert!(fdtable.get_file(NR_OPEN_MAX + 7).is_none());
+    let mut last = 0;
+    while let Some(fd) = fdtable.alloc_fd() {
+        last = fd;
+    }
+    assert_eq!(last, NR_OPEN_MAX - 1);
+    assert_eq!(fdtable.max_fds(), NR_OPEN_MAX);
+    assert_eq!(fdtable.open_count(), NR_OPEN_MAX);
+    println!("test:    SUCCESS - array doubles up to NR_OPEN_MAX");
+
+    // 测试 3: 引用计数
+    println!("test: 3. Testing reference counting...");
+    let fdtable = FdTable::new();
+    let file = new_file();
+    let fd = fdtable.alloc_fd().unwrap();
+    assert_eq!(fdtable.install_fd(fd, file.clone()), Ok(()));
+    assert_eq!(Arc::strong_count(&file), 2);
+    let got = fdtable.get_file(fd).unwrap();
+    assert_eq!(Arc::strong_count(&file), 3);
+    drop(got);
+    let dup = fdtable.dup_fd(fd).unwrap();
+    assert_eq!(Arc::strong_count(&file), 3);
+    assert_eq!(fdtable.close_fd(fd), Ok(()));
+    assert_eq!(fdtable.close_fd(dup), Ok(()));
+    assert_eq!(Arc::strong_count(&file), 1);
+    let reserved = fdtable.alloc_fd().unwrap();
+    assert!(fdtable.get_file(reserved).is_none());
+    assert_eq!(fdtable.close_fd(reserved), Ok(()));
+    assert_eq!(fdtable.open_count(), 0);
+    assert_eq!(fdtable.install_fd(0, file.clone()), Ok(()));
+    drop(fdtable);
+    assert_eq!(Arc::strong_count(&file), 1);
+    println!("test:    SUCCESS - table references are released on close and drop");
+
+    // 测试 4: fdget 快速路径
+    println!("test: 4. Testing fdget fast path...");
+    let task = match crate::sched::current() {
+        Some(task) if task.has_fdtable() && !task.fdtable_shared() => task,
+        _ => {
+            println!("test:    SKIP - current task has no private fdtable");
+            println!("test: Lock-free FdTable testing completed.");
+            return;
+        }
+    };
+    let fd = task.fdtable().alloc_fd().unwrap();
+    assert_eq!(task.fdtable().install_fd(fd, file.clone()), Ok(()));
+    {
+        let light = unsafe { fdget(fd) }.expect("fdget failed");
+        assert!(core::ptr::eq(&*light, &*file));
+        assert_eq!(Arc::strong_count(&file), 2);
+    }
+    assert_eq!(Arc::strong_count(&file), 2);
+    assert!(unsafe { fdget(NR_OPEN_MAX + 1) }.is_none());
+    assert_eq!(task.fdtable().close_fd(fd), Ok(()));
+    assert_eq!(Arc::strong_count(&file), 1);
+    println!("test:    SUCCESS - unshared tables skip the reference count");
+
+    println!("test: Lock-free FdTable testing completed.");
+}
@@ -0,0 +1,113 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：浮点状态的延迟保存与恢复
+//
+// 测试内容：
+// 1. FpState 布局与 sstatus.FS 编码
+// 2. fstate_save / fstate_restore 往返
+// 3. FS 关闭时第一次使用浮点的异常处理
+// 4. 脏位跟踪、写回与 fork 复制
+
+use alloc::vec;
+use core::mem::{offset_of, size_of};
+use crate::println;
+use crate::arch::riscv64::fpu::*;
+use crate::arch::riscv64::trap::TrapFrame;
+
+fn read_sstatus() -> u64 {
+    let sstatus: u64;
+    unsafe { core::arch::asm!("csrr {}, sstatus", out(reg) sstatus) };
+    sstatus
+}
+
+pub fn test_fpu() {
+    println!("test: ===== Testing Lazy FPU State =====");
+
+    // 测试 1: 布局
+    println!("test: 1. Testing state layout...");
+    assert_eq!(offset_of!(FpState, fcsr), 256);
+    assert_eq!(size_of::<FpState>(), 264);
+    assert_eq!(SR_FS, SR_FS_DIRTY);
+    assert_eq!(SR_FS_INITIAL | SR_FS_CLEAN, SR_FS);
+    println!("test:    SUCCESS - layout matches __riscv_d_ext_state");
+
+    // 测试 2: 保存与恢复
+    println!("test: 2. Testing save/restore round trip...");
+    unsafe {
+        let sstatus = read_sstatus();
+        let mut saved = FpState::new();
+        fstate_save(&mut saved);
+
+        let mut state = FpState::new();
+        for (i, f) in state.f.iter_mut().enumerate() {
+            *f = 0x4000_0000_0000_0000 | i as u64;
+        }
+        state.fcsr = 0x21;  // frm = RTZ，fflags = NX
+        fstate_restore(&state);
+        let mut check = FpState::new();
+        fstate_save(&mut check);
+        assert_eq!((check.f, check.fcsr), (state.f, state.fcsr));
+
+        fstate_restore(&saved);
+        assert_eq!(read_sstatus() & SR_FS, sstatus & SR_FS);
+    }
+    println!("test:    SUCCESS - registers and fcsr survive, FS unchanged");
+
+    // 测试 3: 第一次使用
+    println!("test: 3. Testing first-use trap...");
+    let mut words = vec![0u64; size_of::<TrapFrame>() / 8];
+    let frame = words.as_mut_ptr() as *mut TrapFrame;
+    unsafe {
+        // 内核模式使用浮点：打开 FS
+        (*frame).sstatus = 0x100;
+        assert!(fpu_first_use(frame));
+        assert_eq!((*frame).sstatus & SR_FS, SR_FS_INITIAL);
+        // FS 已打开时是真正的非法指令
+        (*frame).sstatus = 0x100 | SR_FS_CLEAN;
+        assert!(!fpu_first_use(frame));
+    }
+    match crate::sched::current() {
+        Some(task) => unsafe {
+            let task: *mut crate::process::task::Task = task;
+            (*frame).sstatus = 0;
+            assert!(fpu_first_use(frame));
+            assert_eq!((*frame).sstatus & SR_FS, SR_FS_CLEAN);
+            // 寄存器仍属于当前任务，返回用户模式时直接使用
+            (*frame).sstatus = 0;
+            fpu_exit_to_user(frame);
+            assert_eq!((*frame).sstatus & SR_FS, SR_FS_CLEAN);
+            // 作废后返回用户模式时关闭 FS
+            fpu_invalidate(task);
+            fpu_exit_to_user(frame);
+            assert_eq!((*frame).sstatus & SR_FS, SR_FS_OFF);
+            println!("test:    SUCCESS - kernel and user first use enable FS");
+
+            // 测试 4: 脏位
+            println!("test: 4. Testing dirty tracking...");
+            (*frame).sstatus = 0;
+            assert!(fpu_first_use(frame));
+            (*frame).sstatus = SR_FS_DIRTY;
+            fpu_trap_entry(frame);
+            assert_eq!((*frame).sstatus & SR_FS, SR_FS_CLEAN);
+            assert!((*task).fpu.is_dirty());
+            assert_eq!(read_sstatus() & SR_FS, SR_FS_OFF);
+            fpu_flush(task);
+            assert!(!(*task).fpu.is_dirty());
+
+            let child = (*task).fpu.fork_copy();
+            assert_eq!(child.state.f, (*task).fpu.state.f);
+            assert!(!child.is_dirty());
+            println!("test:    SUCCESS - dirty state is written back and copied");
+        },
+        None => {
+            println!("test:    SKIPPED - no current task");
+            println!("test: 4. Testing dirty tracking...");
+            println!("test:    SKIPPED - no current task");
+        }
+    }
+
+    println!("test: Lazy FPU state testing completed.");
+}
@@ -0,0 +1,95 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：futex
+//
+// 测试内容：
+// 1. FUTEX_WAIT 的参数检查与值比较
+// 2. 超时到期的等待返回 ETIMEDOUT，并已离开等待桶
+// 3. REQUEUE / CMP_REQUEUE 与 WAKE_OP
+// 4. PI futex：持有者不存在、非持有者解锁
+// 5. robust futex 的持有者退出处理
+
+use core::sync::atomic::{AtomicU32, Ordering};
+use crate::println;
+use crate::process::futex::*;
+use crate::time::ktime_get;
+
+const EPERM: i32 = -1;
+const ESRCH: i32 = -3;
+const EAGAIN: i32 = -11;
+const EINVAL: i32 = -22;
+const ETIMEDOUT: i32 = -110;
+
+/// 不存在的任务 TID
+const DEAD_TID: u32 = 0x2345;
+
+static WORD: AtomicU32 = AtomicU32::new(0);
+static WORD2: AtomicU32 = AtomicU32::new(0);
+
+fn addr(word: &AtomicU32) -> usize {
+    word as *const AtomicU32 as usize
+}
+
+pub fn test_futex() {
+    println!("test: ===== Testing Futex =====");
+    let uaddr = addr(&WORD);
+    let uaddr2 = addr(&WORD2);
+
+    // 测试 1: 值不等时立即返回
+    println!("test: 1. Testing FUTEX_WAIT value check...");
+    WORD.store(1, Ordering::SeqCst);
+    assert_eq!(futex_wait(uaddr, FUTEX_PRIVATE_FLAG, 0, None, FUTEX_BITSET_MATCH_ANY), EAGAIN);
+    assert_eq!(futex_wait(uaddr, FUTEX_PRIVATE_FLAG, 1, None, 0), EINVAL);
+    assert_eq!(futex_wait(uaddr + 1, FUTEX_PRIVATE_FLAG, 1, None, FUTEX_BITSET_MATCH_ANY), EINVAL);
+    assert_eq!(futex_wake(uaddr, FUTEX_PRIVATE_FLAG, 1, FUTEX_BITSET_MATCH_ANY), 0);
+    println!("test:    SUCCESS - mismatched value returns EAGAIN");
+
+    // 测试 2: 已到期的绝对超时
+    println!("test: 2. Testing FUTEX_WAIT_BITSET timeout...");
+    let ret = futex_wait(uaddr, FUTEX_PRIVATE_FLAG, 1, Some(ktime_get()), 0x1);
+    assert_eq!(ret, ETIMEDOUT);
+    // 超时的等待者已离开队列，唤醒不到任何人
+    assert_eq!(futex_wake(uaddr, FUTEX_PRIVATE_FLAG, i32::MAX, FUTEX_BITSET_MATCH_ANY), 0);
+    println!("test:    SUCCESS - expired wait returns ETIMEDOUT");
+
+    // 测试 3: REQUEUE 与 WAKE_OP
+    println!("test: 3. Testing REQUEUE and WAKE_OP...");
+    assert_eq!(futex_requeue(uaddr, FUTEX_PRIVATE_FLAG, uaddr2, 1, i32::MAX, None), 0);
+    assert_eq!(futex_requeue(uaddr, FUTEX_PRIVATE_FLAG, uaddr2, 1, i32::MAX, Some(2)), EAGAIN);
+    assert_eq!(futex_requeue(uaddr, FUTEX_PRIVATE_FLAG, uaddr2, 1, i32::MAX, Some(1)), 0);
+    assert_eq!(futex_requeue(uaddr, FUTEX_PRIVATE_FLAG, uaddr2, -1, 0, None), EINVAL);
+    // FUTEX_OP(FUTEX_OP_ADD, 5, FUTEX_OP_CMP_EQ, 0)
+    WORD2.store(0, Ordering::SeqCst);
+    assert_eq!(futex_wake_op(uaddr, FUTEX_PRIVATE_FLAG, uaddr2, 1, 1, (1 << 28) | (5 << 12)), 0);
+    assert_eq!(WORD2.load(Ordering::SeqCst), 5);
+    // FUTEX_OP(FUTEX_OP_SET | FUTEX_OP_OPARG_SHIFT, 3, FUTEX_OP_CMP_GT, 4)
+    assert_eq!(futex_wake_op(uaddr, FUTEX_PRIVATE_FLAG, uaddr2, 1, 1, (8 << 28) | (4 << 24) | (3 << 12) | 4), 0);
+    assert_eq!(WORD2.load(Ordering::SeqCst), 1 << 3);
+    println!("test:    SUCCESS - requeue compares value, wake_op updates uaddr2");
+
+    // 测试 4: PI futex
+    println!("test: 4. Testing PI futex ownership...");
+    WORD.store(DEAD_TID, Ordering::SeqCst);
+    assert_eq!(futex_lock_pi(uaddr, FUTEX_PRIVATE_FLAG, None, true), EAGAIN);
+    assert_eq!(futex_lock_pi(uaddr, FUTEX_PRIVATE_FLAG, Some(ktime_get()), false), ESRCH);
+    assert_eq!(futex_unlock_pi(uaddr, FUTEX_PRIVATE_FLAG), EPERM);
+    assert_eq!(WORD.load(Ordering::SeqCst), DEAD_TID);
+    println!("test:    SUCCESS - missing owner returns ESRCH");
+
+    // 测试 5: robust futex
+    println!("test: 5. Testing robust futex owner death...");
+    WORD.store(DEAD_TID | FUTEX_WAITERS, Ordering::SeqCst);
+    assert_eq!(handle_futex_death(uaddr, DEAD_TID, false), 0);
+    assert_eq!(WORD.load(Ordering::SeqCst), FUTEX_WAITERS | FUTEX_OWNER_DIED);
+    // 不属于退出任务的锁不变
+    WORD.store(DEAD_TID + 1, Ordering::SeqCst);
+    assert_eq!(handle_futex_death(uaddr, DEAD_TID, true), 0);
+    assert_eq!(WORD.load(Ordering::SeqCst), DEAD_TID + 1);
+    println!("test:    SUCCESS - dead owner marked FUTEX_OWNER_DIED");
+
+    WORD.store(0, Ordering::SeqCst);
+    println!("test: Futex testing completed.");
+}
@@ -0,0 +1,69 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：GPU fence 与帧完成通知文件
+//
+// 测试内容：
+// 1. 新建的通知文件不报告之前完成的 fence
+// 2. fence 完成后可读，read 返回最近完成的序号，序号不会回退
+// 3. 通知文件可以加入 epoll
+
+use crate::arch::riscv64::syscall::{epoll_ctl_ops, epoll_events, EPollEvent};
+use crate::drivers::gpu::fence::{fence_create_file, fence_signal, fence_signaled, last_signaled};
+use crate::fs::eventpoll::{ep_ctl, ep_poll, epoll_create_file, file_epoll};
+use crate::fs::file::{fput, poll_mask::*, File, FileFlags};
+use crate::println;
+
+fn read_u64(file: &File) -> Result<u64, isize> {
+    let mut buf = [0u8; 8];
+    match unsafe { file.read(buf.as_mut_ptr(), 8) } {
+        8 => Ok(u64::from_ne_bytes(buf)),
+        e => Err(e),
+    }
+}
+
+pub fn test_gpu_fence() {
+    println!("test: ===== Testing GPU Fences =====");
+    let base = last_signaled();
+
+    // 测试 1: 新建文件
+    println!("test: 1. Testing fresh fence file...");
+    assert_eq!(fence_create_file(0x1).err(), Some(-22));
+    let file = fence_create_file(FileFlags::O_NONBLOCK).expect("fence file");
+    assert_eq!(file.poll() & POLLIN, 0);
+    assert_eq!(read_u64(&file), Err(-11));
+    println!("test:    SUCCESS - nothing reported before a new fence");
+
+    // 测试 2: fence 完成
+    println!("test: 2. Testing fence signalling...");
+    fence_signal(base + 2);
+    assert!(fence_signaled(base + 1) && fence_signaled(base + 2));
+    assert!(!fence_signaled(base + 3));
+    assert_eq!(file.poll() & POLLIN, POLLIN);
+    assert_eq!(read_u64(&file), Ok(base + 2));
+    assert_eq!(read_u64(&file), Err(-11));
+    // 较小的序号不使完成位置回退，也不唤醒读者
+    fence_signal(base + 1);
+    assert_eq!(last_signaled(), base + 2);
+    assert_eq!(file.poll() & POLLIN, 0);
+    println!("test:    SUCCESS - reads return the latest completed fence");
+
+    // 测试 3: epoll
+    println!("test: 3. Testing epoll readiness...");
+    let epfile = epoll_create_file();
+    let ep = file_epoll(&epfile).expect("epoll");
+    let event = EPollEvent { events: epoll_events::EPOLLIN, data: 0xf };
+    assert_eq!(ep_ctl(&ep, epoll_ctl_ops::EPOLL_CTL_ADD, 7, &file, Some(&event)), Ok(()));
+    assert_eq!(ep_poll(&ep, 8, 0).map(|ev| ev.len()), Ok(0));
+    fence_signal(base + 3);
+    assert_eq!(ep_poll(&ep, 8, 0).expect("epoll_wait"), [event]);
+    assert_eq!(read_u64(&file), Ok(base + 3));
+    assert_eq!(ep_poll(&ep, 8, 0).map(|ev| ev.len()), Ok(0));
+    fput(file);
+    fput(epfile);
+    println!("test:    SUCCESS - fence completion wakes epoll");
+
+    println!("test: GPU fence testing completed.");
+}
@@ -0,0 +1,175 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：通用接收合并 (GRO)
+//
+// 测试内容：
+// 1. 同一条流上连续的报文段合并成一个包，IP 头部与数据正确
+// 2. 交错的两条流分别合并
+// 3. 序列号不连续、FIN 与短报文段结束合并
+// 4. 校验和错误的报文段不合并，非 TCP 帧原样交付
+
+use alloc::vec::Vec;
+use crate::println;
+use crate::net::buffer::{alloc_skb, SkBuff, CHECKSUM_NONE, CHECKSUM_UNNECESSARY};
+use crate::net::ethernet::ETH_HLEN;
+use crate::net::gro::napi_gro_receive_list;
+use crate::net::ipv4::checksum;
+use crate::net::tcp::{TCPHDR_ACK, TCPHDR_FIN, TCPHDR_PSH};
+
+/// 测试用的对端地址
+const PEER_IP: u32 = 0x0A000202;
+/// 测试用的本机地址
+const LOCAL_IP: u32 = 0x0A00020F;
+
+pub fn test_gro() {
+    println!("test: ===== Testing Generic Receive Offload =====");
+
+    // 测试 1: 单条流
+    println!("test: 1. Testing coalescing of one flow...");
+    let mut frames = Vec::new();
+    for i in 0..8u32 {
+        let flags = if i == 7 { TCPHDR_ACK | TCPHDR_PSH } else { TCPHDR_ACK };
+        frames.push(tcp_frame(40000, 1000 + i * 1000, flags, 1000, true));
+    }
+    let out = napi_gro_receive_list(frames);
+    assert_eq!(out.len(), 1);
+    let skb = &out[0];
+    assert_eq!(skb.len as usize, ETH_HLEN + 40 + 8000);
+    assert_eq!(skb.gso_size, 1000);
+    assert_eq!(skb.ip_summed, CHECKSUM_UNNECESSARY);
+    let bytes = frame_bytes(skb);
+    let ip = &bytes[ETH_HLEN..ETH_HLEN + 20];
+    assert_eq!(u16::from_be_bytes([ip[2], ip[3]]) as usize, 40 + 8000);
+    assert_eq!(checksum::ip_checksum(ip), 0);
+    assert_eq!(tcp_seq(&bytes), 1000);
+    assert_ne!(bytes[ETH_HLEN + 20 + 13] & TCPHDR_PSH, 0);
+    // 数据按序列号连续
+    for (i, &b) in bytes[ETH_HLEN + 40..].iter().enumerate() {
+        assert_eq!(b, payload_byte(1000 + i as u32));
+    }
+    free_all(out);
+    println!("test:    SUCCESS - 8 segments coalesced into one 8000-byte packet");
+
+    // 测试 2: 两条流交错
+    println!("test: 2. Testing interleaved flows...");
+    let mut frames = Vec::new();
+    for i in 0..4u32 {
+        frames.push(tcp_frame(40000, 1000 + i * 1000, TCPHDR_ACK, 1000, true));
+        frames.push(tcp_frame(40001, 5000 + i * 1000, TCPHDR_ACK, 1000, true));
+    }
+    let out = napi_gro_receive_list(frames);
+    assert_eq!(out.len(), 2);
+    assert!(out.iter().all(|skb| skb.len as usize == ETH_HLEN + 40 + 4000));
+    free_all(out);
+    println!("test:    SUCCESS - each flow coalesced separately");
+
+    // 测试 3: 结束合并的条件
+    println!("test: 3. Testing flush conditions...");
+    let frames = alloc::vec![
+        tcp_frame(40000, 1000, TCPHDR_ACK, 1000, true),
+        tcp_frame(40000, 2000, TCPHDR_ACK, 1000, true),
+        // 序列号跳过 1000 字节
+        tcp_frame(40000, 4000, TCPHDR_ACK, 1000, true),
+        // 短报文段合并后结束这一批
+        tcp_frame(40000, 5000, TCPHDR_ACK, 500, true),
+        tcp_frame(40000, 5500, TCPHDR_ACK, 1000, true),
+        // FIN 不合并，先交付暂存的包
+        tcp_frame(40000, 6500, TCPHDR_ACK | TCPHDR_FIN, 100, true),
+    ];
+    let out = napi_gro_receive_list(frames);
+    let lens: Vec<usize> = out.iter().map(|skb| skb.len as usize - ETH_HLEN - 40).collect();
+    assert_eq!(lens, [2000, 1500, 1000, 100]);
+    let seqs: Vec<u32> = out.iter().map(|skb| tcp_seq(&frame_bytes(skb))).collect();
+    assert_eq!(seqs, [1000, 4000, 5500, 6500]);
+    free_all(out);
+    println!("test:    SUCCESS - gaps, short segments and FIN end coalescing in order");
+
+    // 测试 4: 校验和与非 TCP 帧
+    println!("test: 4. Testing checksum validation and other frames...");
+    let bad = tcp_frame(40000, 2000, TCPHDR_ACK, 1000, false);
+    unsafe {
+        *bad.data.add(ETH_HLEN + 40) ^= 0xFF;
+    }
+    let mut arp = alloc_skb(64).expect("skb alloc");
+    let mut arp_frame = [0u8; ETH_HLEN + 28];
+    arp_frame[12..14].copy_from_slice(&0x0806u16.to_be_bytes());
+    arp.skb_put_data(&arp_frame).expect("skb put");
+    let frames = alloc::vec![
+        tcp_frame(40000, 1000, TCPHDR_ACK, 1000, false),
+        bad,
+        arp,
+        tcp_frame(40000, 3000, TCPHDR_ACK, 1000, false),
+    ];
+    let out = napi_gro_receive_list(frames);
+    assert_eq!(out.len(), 4);
+    assert_eq!(out[0].ip_summed, CHECKSUM_UNNECESSARY);
+    assert_eq!(out[1].ip_summed, CHECKSUM_NONE);
+    assert_eq!(out[2].len as usize, ETH_HLEN + 28);
+    free_all(out);
+    println!("test:    SUCCESS - corrupted segment delivered unmerged");
+
+    println!("test: GRO testing completed.");
+}
+
+/// 数据内容由序列号决定，便于检查合并后的顺序
+fn payload_byte(seq: u32) -> u8 {
+    (seq % 251) as u8
+}
+
+/// 构造对端发来的以太网 + IPv4 + TCP 帧，校验和正确
+fn tcp_frame(sport: u16, seq: u32, flags: u8, len: usize, hw_csum: bool) -> SkBuff {
+    let mut frame = alloc::vec![0u8; ETH_HLEN + 40 + len];
+    frame[12..14].copy_from_slice(&0x0800u16.to_be_bytes());
+    {
+        let ip = &mut frame[ETH_HLEN..ETH_HLEN + 20];
+        ip[0] = 0x45;
+        ip[2..4].copy_from_slice(&((40 + len) as u16).to_be_bytes());
+        ip[6] = 0x40; // DF
+        ip[8] = 64;
+        ip[9] = 6;
+        ip[12..16].copy_from_slice(&PEER_IP.to_be_bytes());
+        ip[16..20].copy_from_slice(&LOCAL_IP.to_be_bytes());
+        let check = checksum::ip_checksum(ip);
+        ip[10..12].copy_from_slice(&check.to_be_bytes());
+    }
+    {
+        let tcp = &mut frame[ETH_HLEN + 20..];
+        tcp[0..2].copy_from_slice(&sport.to_be_bytes());
+        tcp[2..4].copy_from_slice(&80u16.to_be_bytes());
+        tcp[4..8].copy_from_slice(&seq.to_be_bytes());
+        tcp[8..12].copy_from_slice(&777u32.to_be_bytes());
+        tcp[12] = 5 << 4;
+        tcp[13] = flags;
+        tcp[14..16].copy_from_slice(&65535u16.to_be_bytes());
+        for i in 0..len {
+            tcp[20 + i] = payload_byte(seq + i as u32);
+        }
+        let sum = checksum::csum_tcpudp_nofold(PEER_IP, LOCAL_IP, (20 + len) as u32, 6);
+        let check = checksum::csum_fold(checksum::csum_partial(tcp, sum));
+        tcp[16..18].copy_from_slice(&check.to_be_bytes());
+    }
+    let mut skb = alloc_skb(frame.len() as u32).expect("skb alloc");
+    skb.skb_put_data(&frame).expect("skb put");
+    skb.ip_summed = if hw_csum { CHECKSUM_UNNECESSARY } else { CHECKSUM_NONE };
+    skb
+}
+
+fn frame_bytes(skb: &SkBuff) -> Vec<u8> {
+    let mut bytes = alloc::vec![0u8; skb.len as usize];
+    skb.skb_copy_bits(0, &mut bytes, skb.len);
+    bytes
+}
+
+fn tcp_seq(bytes: &[u8]) -> u32 {
+    let tcp = &bytes[ETH_HLEN + 20..];
+    u32::from_be_bytes([tcp[4], tcp[5], tcp[6], tcp[7]])
+}
+
+fn free_all(skbs: Vec<SkBuff>) {
+    for skb in skbs {
+        skb.free();
+    }
+}
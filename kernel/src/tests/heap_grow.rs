@@ -0,0 +1,121 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内核堆扩展单元测试
+//!
+//! 先占住堆中所有 256 页及以上的空闲块，再分配 256 页的块迫使堆从物理页分配器
+//! 取 2MB 扩展块：检查扩展块的对齐与统计、块内放不下时再扩展一次、
+//! 扩展块完全空闲后由 shrink_heap 归还、meminfo 报告扩展与归还次数
+
+use core::alloc::{GlobalAlloc, Layout};
+
+use crate::println;
+use crate::mm::buddy_allocator::{buddy_stats, shrink_heap, HEAP_ALLOCATOR, MAX_ORDER};
+use crate::mm::{get_memory_info, PAGE_SIZE};
+
+/// 测试使用的分配大小：256 页
+const ORDER: usize = 8;
+/// 扩展块大小（HEAP_CHUNK_ORDER）
+const CHUNK_SIZE: usize = PAGE_SIZE << 9;
+
+fn layout(order: usize) -> Layout {
+    Layout::from_size_align(PAGE_SIZE << order, PAGE_SIZE).unwrap()
+}
+
+fn alloc_order(order: usize) -> usize {
+    let ptr = unsafe { HEAP_ALLOCATOR.alloc(layout(order)) } as usize;
+    assert_ne!(ptr, 0);
+    ptr
+}
+
+fn free_order(addr: usize, order: usize) {
+    unsafe { HEAP_ALLOCATOR.dealloc(addr as *mut u8, layout(order)) };
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_heap_grow() {
+    println!("test: ===== Starting Heap Growth Tests =====");
+
+    // 归还以前的测试留下的空闲扩展块
+    shrink_heap();
+
+    // 1. 占住所有 order >= ORDER 的空闲块，从高 order 往下取，每次正好取走一个整块
+    println!("test: 1. Testing heap exhaustion for order {}...", ORDER);
+    let baseline = buddy_stats();
+    let mut held = [(0usize, 0usize); 128];
+    let mut nr_held = 0;
+    for order in (ORDER..=MAX_ORDER).rev() {
+        while buddy_stats().free_blocks[order] > 0 {
+            assert!(nr_held < held.len());
+            held[nr_held] = (alloc_order(order), order);
+            nr_held += 1;
+        }
+    }
+    let before = buddy_stats();
+    assert_eq!(before.grow_count, baseline.grow_count);
+    for order in ORDER..=MAX_ORDER {
+        assert_eq!(before.free_blocks[order], 0);
+    }
+    println!("test:    SUCCESS - {} large blocks held without growing", nr_held);
+
+    // 2. 再分配 256 页：堆扩展一个 2MB 对齐的扩展块，地址在初始区域之外
+    println!("test: 2. Testing growth on exhaustion...");
+    let first = alloc_order(ORDER);
+    let after = buddy_stats();
+    assert_eq!(after.grow_count - before.grow_count, 1);
+    assert_eq!(after.nr_chunks - before.nr_chunks, 1);
+    assert_eq!(after.chunk_bytes - before.chunk_bytes, CHUNK_SIZE);
+    // Zone 头占用块末尾的页，不计入堆大小
+    let grown = after.heap_size - before.heap_size;
+    assert!(grown >= PAGE_SIZE << ORDER && grown < CHUNK_SIZE);
+    assert!(first < after.heap_start || first >= after.heap_end);
+    assert_eq!(first % CHUNK_SIZE, 0);
+    println!("test:    SUCCESS - one 2MB chunk added at {:#x}", first);
+
+    // 3. 扩展块去掉 Zone 头后放不下第二个 256 页的块，再扩展一次
+    println!("test: 3. Testing second growth...");
+    let second = alloc_order(ORDER);
+    let stats = buddy_stats();
+    assert_eq!(stats.grow_count - before.grow_count, 2);
+    assert_eq!(stats.nr_chunks - before.nr_chunks, 2);
+    assert_eq!(second % CHUNK_SIZE, 0);
+    assert_ne!(first, second);
+    println!("test:    SUCCESS - chunk header leaves room for only one block");
+
+    // 4. 仍有分配的扩展块不归还，完全空闲后由 shrink_heap 归还
+    println!("test: 4. Testing shrink of free chunks...");
+    free_order(first, ORDER);
+    assert_eq!(shrink_heap(), CHUNK_SIZE);
+    assert_eq!(buddy_stats().nr_chunks, stats.nr_chunks - 1);
+    free_order(second, ORDER);
+    assert_eq!(shrink_heap(), CHUNK_SIZE);
+    let shrunk = buddy_stats();
+    assert_eq!(shrunk.shrink_count - stats.shrink_count, 2);
+    assert_eq!(shrunk.nr_chunks, before.nr_chunks);
+    assert_eq!((shrunk.chunk_bytes, shrunk.heap_size), (before.chunk_bytes, before.heap_size));
+    // 没有空闲扩展块时什么也不做
+    assert_eq!(shrink_heap(), 0);
+    println!("test:    SUCCESS - both chunks returned to the page allocator");
+
+    // 5. 放回占住的块，空闲块恢复原状
+    println!("test: 5. Testing release of held blocks...");
+    for &(addr, order) in held[..nr_held].iter().rev() {
+        free_order(addr, order);
+    }
+    let restored = buddy_stats();
+    assert_eq!(restored.free_blocks, baseline.free_blocks);
+    assert_eq!(restored.free_bytes, baseline.free_bytes);
+    println!("test:    SUCCESS - free lists restored");
+
+    // 6. meminfo 报告扩展块数与扩展、归还次数（会分配内存，放在最后）
+    println!("test: 6. Testing meminfo heap counters...");
+    let info = get_memory_info();
+    assert_eq!(info.heap_chunks, restored.nr_chunks);
+    assert_eq!(info.heap_grows - baseline.grow_count, 2);
+    assert_eq!(info.heap_shrinks - stats.shrink_count, 2);
+    println!("test:    SUCCESS - growth events visible in meminfo");
+
+    println!("test: ===== Heap Growth Tests Completed =====");
+}
@@ -17,6 +17,7 @@ use alloc::sync::Arc;
 use alloc::vec::Vec;
 use alloc::format;
 use alloc::string::ToString;
+use core::sync::atomic::{AtomicUsize, Ordering};
 
 #[cfg(feature = "unit-test")]
 pub fn test_icache() {
@@ -42,6 +43,10 @@ pub fn test_icache() {
     println!("test: 5. Testing different inode types...");
     test_icache_types();
 
+    // 测试 6: 按设备区分、脏 inode 写回
+    println!("test: 6. Testing per-device keys and dirty write-back...");
+    test_icache_writeback();
+
     println!("test: ===== Inode Cache Tests Completed =====");
 }
 
@@ -316,3 +321,50 @@ fn test_icache_types() {
 
     println!("test:    SUCCESS - different inode types handled properly");
 }
+
+/// 测试用的写回回调调用次数
+static TEST_WRITEBACKS: AtomicUsize = AtomicUsize::new(0);
+
+fn test_write_inode(_inode: &inode::Inode) -> Result<(), i32> {
+    TEST_WRITEBACKS.fetch_add(1, Ordering::Relaxed);
+    Ok(())
+}
+
+fn test_icache_writeback() {
+    const DEV: u64 = 0xfff0;
+    println!("test:    Testing (dev, ino) keys, mark_inode_dirty and writeback...");
+
+    let mut vi = inode::make_reg_inode(7000, 10);
+    vi.i_dev = DEV;
+    vi.write_inode = Some(test_write_inode);
+    let cached = inode::insert_inode_hash(Arc::new(vi));
+
+    // 同一 (dev, ino) 再次插入返回已有的实例
+    let mut dup = inode::make_reg_inode(7000, 20);
+    dup.i_dev = DEV;
+    let again = inode::insert_inode_hash(Arc::new(dup));
+    assert!(Arc::ptr_eq(&cached, &again), "duplicate insert should return the cached inode");
+
+    // 设备号是键的一部分
+    assert!(inode::ilookup(DEV, 7000).is_some(), "inode should be found on its device");
+    assert!(inode::ilookup(DEV + 1, 7000).is_none(), "inode should not be found on another device");
+
+    // 脏 inode 写回一次后变干净
+    let before = TEST_WRITEBACKS.load(Ordering::Relaxed);
+    inode::mark_inode_dirty(&cached);
+    inode::mark_inode_dirty(&cached);
+    assert!(inode::has_dirty_inodes(), "dirty inode should be registered");
+    assert_eq!(inode::writeback_inodes(Some(DEV), false), 1, "one inode should be written back");
+    assert_eq!(TEST_WRITEBACKS.load(Ordering::Relaxed), before + 1, "write_inode should run once");
+    assert!(!cached.i_dirty.load(Ordering::Relaxed), "inode should be clean after writeback");
+
+    // 仍被引用的 inode 不会被淘汰
+    inode::icache_shrink(usize::MAX);
+    assert!(inode::ilookup(DEV, 7000).is_some(), "referenced inode should survive shrink");
+
+    // 卸载时淘汰该设备的全部 inode
+    inode::evict_inodes(DEV);
+    assert!(inode::ilookup(DEV, 7000).is_none(), "evict_inodes should drop the device's inodes");
+
+    println!("test:    SUCCESS - per-device icache and writeback work");
+}
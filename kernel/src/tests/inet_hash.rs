@@ -0,0 +1,130 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：套接字查找哈希表
+//
+// 测试内容：
+// 1. 哈希表插入、查找、删除与唯一插入
+// 2. 条目增多后桶数组扩容，所有条目仍可查到
+// 3. 绑定查找：精确地址优先，其次 INADDR_ANY
+// 4. UDP 端口冲突检查与按端口查找
+// 5. TCP 报文经哈希表分发到监听 socket 与子连接
+
+use crate::println;
+use crate::net::buffer::{alloc_skb, CHECKSUM_UNNECESSARY};
+use crate::net::inet_hashtables::{inet_lookup_bound, jhash_3words, InetBindKey, InetEhashKey, InetHashTable, INADDR_ANY};
+use crate::net::tcp::{
+    tcp_bind, tcp_ehash_len, tcp_listen, tcp_socket_alloc, tcp_socket_free, tcp_v4_rcv, TcpSeq,
+    TCPHDR_ACK, TCPHDR_RST, TCPHDR_SYN,
+};
+use crate::net::udp::{udp_bind, udp_socket_alloc, udp_socket_free, udp_v4_lookup};
+
+/// 测试用的本机地址
+const LOCAL_IP: u32 = 0x0A00020F;
+/// 测试用的对端地址
+const PEER_IP: u32 = 0x0A000202;
+
+pub fn test_inet_hash() {
+    println!("test: ===== Testing Socket Lookup Hash Tables =====");
+
+    // 测试 1: 基本操作
+    println!("test: 1. Testing insert, lookup and remove...");
+    assert_eq!(jhash_3words(1, 2, 3, 0), jhash_3words(1, 2, 3, 0));
+    assert_ne!(jhash_3words(1, 2, 3, 0), jhash_3words(1, 2, 4, 0));
+    let table: InetHashTable<InetEhashKey, u32> = InetHashTable::new();
+    let key = InetEhashKey { faddr: PEER_IP, fport: 40000, lport: 80 };
+    assert_eq!(table.lookup(&key), None);
+    table.insert(key, 7);
+    table.insert(key, 8);
+    assert_eq!(table.lookup(&key), Some(7));
+    assert!(table.remove(&key, 7));
+    assert!(!table.remove(&key, 7));
+    assert_eq!(table.lookup(&key), Some(8));
+    assert!(!table.insert_unique(key, 9));
+    assert!(table.remove(&key, 8));
+    assert_eq!(table.len(), 0);
+    println!("test:    SUCCESS - entries inserted, found and removed");
+
+    // 测试 2: 扩容
+    println!("test: 2. Testing bucket array growth...");
+    let table: InetHashTable<InetEhashKey, u32> = InetHashTable::new();
+    for i in 0..1000u32 {
+        table.insert(InetEhashKey { faddr: PEER_IP + (i >> 8), fport: 1024 + i as u16, lport: 80 }, i);
+    }
+    assert_eq!(table.len(), 1000);
+    assert!(table.nr_buckets() >= 1000 / 2);
+    for i in 0..1000u32 {
+        let key = InetEhashKey { faddr: PEER_IP + (i >> 8), fport: 1024 + i as u16, lport: 80 };
+        assert_eq!(table.lookup(&key), Some(i));
+    }
+    println!("test:    SUCCESS - 1000 entries in {} buckets", table.nr_buckets());
+
+    // 测试 3: 绑定查找
+    println!("test: 3. Testing bound address lookup...");
+    let table: InetHashTable<InetBindKey, u32> = InetHashTable::new();
+    table.insert(InetBindKey { addr: INADDR_ANY, port: 53 }, 1);
+    assert_eq!(inet_lookup_bound(&table, LOCAL_IP, 53), Some(1));
+    table.insert(InetBindKey { addr: LOCAL_IP, port: 53 }, 2);
+    assert_eq!(inet_lookup_bound(&table, LOCAL_IP, 53), Some(2));
+    assert_eq!(inet_lookup_bound(&table, PEER_IP, 53), Some(1));
+    assert_eq!(inet_lookup_bound(&table, LOCAL_IP, 54), None);
+    println!("test:    SUCCESS - exact address preferred over INADDR_ANY");
+
+    // 测试 4: UDP
+    println!("test: 4. Testing UDP bind conflicts...");
+    let fd1 = udp_socket_alloc().expect("udp alloc");
+    let fd2 = udp_socket_alloc().expect("udp alloc");
+    assert_eq!(udp_bind(fd1, 4321), 0);
+    assert_eq!(udp_bind(fd2, 4321), -98);
+    assert_eq!(udp_v4_lookup(LOCAL_IP, 4321), Some(fd1));
+    udp_socket_free(fd1);
+    assert_eq!(udp_v4_lookup(LOCAL_IP, 4321), None);
+    assert_eq!(udp_bind(fd2, 4321), 0);
+    assert_eq!(udp_v4_lookup(LOCAL_IP, 4321), Some(fd2));
+    udp_socket_free(fd2);
+    println!("test:    SUCCESS - second bind rejected with EADDRINUSE");
+
+    // 测试 5: TCP 分发
+    println!("test: 5. Testing TCP demultiplexing...");
+    let listener = tcp_socket_alloc().expect("tcp alloc");
+    assert_eq!(tcp_bind(listener, 7070), 0);
+    assert_eq!(tcp_listen(listener, 16), 0);
+    let base = tcp_ehash_len();
+    // 两个不同源端口的 SYN 各产生一个子连接
+    rcv_segment(40000, 7070, 100, 0, TCPHDR_SYN);
+    rcv_segment(40001, 7070, 200, 0, TCPHDR_SYN);
+    assert_eq!(tcp_ehash_len(), base + 2);
+    // 重传的 SYN 交给已有的子连接，不再创建
+    rcv_segment(40000, 7070, 100, 0, TCPHDR_SYN);
+    assert_eq!(tcp_ehash_len(), base + 2);
+    // RST 终止子连接，连接从哈希表中删除
+    rcv_segment(40000, 7070, 101, 0, TCPHDR_RST | TCPHDR_ACK);
+    assert_eq!(tcp_ehash_len(), base + 1);
+    // 监听 socket 关闭时未被 accept 的子连接一并终止，之后不再接受新连接
+    tcp_socket_free(listener);
+    assert_eq!(tcp_ehash_len(), base);
+    rcv_segment(40002, 7070, 300, 0, TCPHDR_SYN);
+    assert_eq!(tcp_ehash_len(), base);
+    println!("test:    SUCCESS - SYNs demultiplexed to listener and children");
+
+    println!("test: Socket lookup hash table testing completed.");
+}
+
+/// 构造对端发来的 TCP 报文段，经 tcp_v4_rcv 分发
+fn rcv_segment(sport: u16, dport: u16, seq: TcpSeq, ack: TcpSeq, flags: u8) {
+    let mut seg = [0u8; 20];
+    seg[0..2].copy_from_slice(&sport.to_be_bytes());
+    seg[2..4].copy_from_slice(&dport.to_be_bytes());
+    seg[4..8].copy_from_slice(&seq.to_be_bytes());
+    seg[8..12].copy_from_slice(&ack.to_be_bytes());
+    seg[12] = 5 << 4;
+    seg[13] = flags;
+    seg[14..16].copy_from_slice(&65535u16.to_be_bytes());
+    let mut skb = alloc_skb(64).expect("skb alloc");
+    skb.skb_put_data(&seg).expect("skb put");
+    skb.ip_summed = CHECKSUM_UNNECESSARY;
+    assert!(tcp_v4_rcv(&skb, PEER_IP, LOCAL_IP, 0, seg.len() as u32).is_ok());
+    skb.free();
+}
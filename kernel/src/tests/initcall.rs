@@ -0,0 +1,77 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：启动阶段计时与并行 initcall
+//
+// 测试内容：
+// 1. 启动阶段按开始时间记录，异步阶段也在其中
+// 2. 异步任务按声明的依赖顺序执行，async_synchronize_full 等待全部完成
+// 3. /proc/boottime 输出表头、各阶段与总耗时
+
+use core::sync::atomic::{AtomicU32, Ordering};
+
+use crate::initcall;
+use crate::println;
+
+/// 每个任务把自己的编号追加到低位，执行顺序 1、2、3 得到 0x123
+static ORDER: AtomicU32 = AtomicU32::new(0);
+
+fn push(n: u32) {
+    let order = ORDER.load(Ordering::Relaxed);
+    ORDER.store(order << 4 | n, Ordering::Relaxed);
+}
+
+fn job_first() -> bool {
+    push(1);
+    true
+}
+
+fn job_second() -> bool {
+    push(2);
+    true
+}
+
+fn job_third() -> bool {
+    push(3);
+    true
+}
+
+pub fn test_initcall() {
+    println!("test: ===== Testing Initcall =====");
+
+    // 测试 1: 启动阶段记录
+    println!("test: 1. Testing boot phase records...");
+    let records = initcall::records();
+    assert!(records.iter().any(|r| r.name == "mm" && !r.is_async));
+    assert!(records.iter().any(|r| r.name == "sched" && r.ok));
+    assert!(records.iter().any(|r| r.name == "blkdev_probe" && r.is_async));
+    assert!(records.windows(2).all(|pair| pair[0].start <= pair[1].start));
+    assert!(records.iter().all(|r| r.end >= r.start));
+    println!("test:    SUCCESS - {} phases, {} async worker(s)", records.len(), initcall::async_workers());
+
+    // 测试 2: 依赖顺序（次核已回到空闲循环，由本核在等待时执行）
+    println!("test: 2. Testing async dependencies...");
+    ORDER.store(0, Ordering::Relaxed);
+    let nr = initcall::records().len();
+    let first = initcall::async_schedule("test_first", job_first, &[]);
+    let second = initcall::async_schedule("test_second", job_second, &[first]);
+    initcall::async_schedule("test_third", job_third, &[second]);
+    initcall::async_synchronize_full();
+    assert_eq!(ORDER.load(Ordering::Relaxed), 0x123);
+    assert_eq!(initcall::records().len(), nr + 3);
+    println!("test:    SUCCESS - jobs ran in dependency order");
+
+    // 测试 3: /proc/boottime
+    println!("test: 3. Testing /proc/boottime...");
+    let data = crate::fs::procfs::read_file("/boottime").expect("/proc/boottime exists");
+    let text = core::str::from_utf8(&data).unwrap();
+    assert!(text.starts_with("initcall"));
+    assert!(text.lines().any(|line| line.starts_with("test_third ")));
+    // 还没有启动 init 进程
+    assert!(text.lines().any(|line| line == "total_us -"));
+    println!("test:    SUCCESS - {} lines", text.lines().count());
+
+    println!("test: Initcall testing completed.");
+}
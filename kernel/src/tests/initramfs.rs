@@ -0,0 +1,134 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：initramfs (cpio newc)
+//
+// 测试内容：
+// 1. 解析 newc 条目，路径去掉开头的 "./"，TRAILER!!! 之后的内容被忽略
+// 2. 解到 RootFS：目录、文件与符号链接，文件数据直接引用归档
+// 3. 页对齐的数据提供直接映射的物理页，末尾不足一页的部分与未对齐的数据不提供
+// 4. 写入时复制到堆上，归档内容不变
+// 5. 格式错误的归档返回 EINVAL
+
+use alloc::vec::Vec;
+
+use crate::errno::Errno;
+use crate::fs::initramfs;
+use crate::fs::rootfs::{FileData, RootFSNode, RootFSSuperBlock};
+use crate::mm::PAGE_SIZE;
+use crate::println;
+
+/// 追加一个 newc 条目；page_align 时在文件名后填充 NUL，使数据从页边界开始
+fn push_entry(buf: &mut Vec<u8>, name: &str, mode: u32, data: &[u8], page_align: bool) {
+    let mut namesize = name.len() + 1;
+    if page_align {
+        while (buf.len() + 110 + namesize) % PAGE_SIZE != 0 {
+            namesize += 1;
+        }
+    }
+    let fields = [0, mode, 0, 0, 1, 0, data.len() as u32, 0, 0, 0, 0, namesize as u32, 0];
+    buf.extend_from_slice(b"070701");
+    for field in fields {
+        buf.extend_from_slice(alloc::format!("{:08x}", field).as_bytes());
+    }
+    buf.extend_from_slice(name.as_bytes());
+    buf.resize(buf.len() + namesize - name.len(), 0);
+    while buf.len() % 4 != 0 {
+        buf.push(0);
+    }
+    buf.extend_from_slice(data);
+    while buf.len() % 4 != 0 {
+        buf.push(0);
+    }
+}
+
+/// 复制到页对齐、不再释放的内存中，模拟引导程序加载的 initrd
+fn leak_aligned(data: &[u8]) -> &'static [u8] {
+    let layout = core::alloc::Layout::from_size_align(data.len(), PAGE_SIZE).unwrap();
+    unsafe {
+        let ptr = alloc::alloc::alloc(layout);
+        assert!(!ptr.is_null());
+        core::ptr::copy_nonoverlapping(data.as_ptr(), ptr, data.len());
+        core::slice::from_raw_parts(ptr, data.len())
+    }
+}
+
+pub fn test_initramfs() {
+    println!("test: ===== Testing Initramfs =====");
+
+    let big: Vec<u8> = (0..2 * PAGE_SIZE + 100).map(|i| i as u8).collect();
+    let mut buf = Vec::new();
+    push_entry(&mut buf, ".", 0o040755, b"", false);
+    push_entry(&mut buf, "./bin", 0o040755, b"", false);
+    push_entry(&mut buf, "./bin/hello", 0o100755, b"hello world\n", false);
+    push_entry(&mut buf, "./bin/big", 0o100644, &big, true);
+    push_entry(&mut buf, "./etc/motd", 0o100644, b"motd", false);
+    push_entry(&mut buf, "./bin/hi", 0o120777, b"hello", false);
+    push_entry(&mut buf, "./dev/console", 0o020600, b"", false);
+    push_entry(&mut buf, "TRAILER!!!", 0, b"", false);
+    push_entry(&mut buf, "./after", 0o100644, b"x", false);
+    let archive = leak_aligned(&buf);
+
+    // 测试 1: 解析
+    println!("test: 1. Testing newc parsing...");
+    let mut names = Vec::new();
+    let count = initramfs::parse(archive, |entry| {
+        names.push(entry.name);
+        Ok(())
+    });
+    assert_eq!(count, Ok(7));
+    assert_eq!(names, ["", "bin", "bin/hello", "bin/big", "etc/motd", "bin/hi", "dev/console"]);
+    println!("test:    SUCCESS - {} entries before trailer", names.len());
+
+    // 测试 2: 解到 RootFS
+    println!("test: 2. Testing unpack...");
+    let sb = RootFSSuperBlock::new();
+    // bin、hello、big、motd、hi；自动创建的父目录 etc、dev 不计入，设备节点跳过
+    assert_eq!(initramfs::unpack(&sb, archive), Ok(5));
+    assert!(sb.lookup("/etc").map_or(false, |n| n.is_dir()));
+    assert!(sb.lookup("/dev/console").is_none());
+    assert!(sb.lookup("/after").is_none());
+    assert_eq!(sb.readlink("/bin/hi"), Ok(b"hello".to_vec()));
+    let hello = sb.lookup("/bin/hello").expect("/bin/hello");
+    let in_archive = match hello.data {
+        Some(FileData::Initramfs(data)) => archive.as_ptr_range().contains(&data.as_ptr()) && data == b"hello world\n",
+        _ => false,
+    };
+    assert!(in_archive);
+    println!("test:    SUCCESS - files reference the archive in place");
+
+    // 测试 3: 直接映射的页
+    println!("test: 3. Testing direct pages...");
+    let big_node = sb.lookup("/bin/big").expect("/bin/big");
+    let data = big_node.data.as_ref().unwrap();
+    assert_eq!(data.as_slice(), &big[..]);
+    let first = data.direct_page(0).expect("aligned page");
+    assert_eq!(first % PAGE_SIZE, 0);
+    assert_eq!(data.direct_page(1), Some(first + PAGE_SIZE));
+    assert_eq!(data.direct_page(2), None);
+    assert_eq!(hello.data.as_ref().unwrap().direct_page(0), None);
+    println!("test:    SUCCESS - 2 full pages mapped at {:#x}", first);
+
+    // 测试 4: 写时复制
+    println!("test: 4. Testing copy on write...");
+    let node = unsafe { &mut *(alloc::sync::Arc::as_ptr(&hello) as *mut RootFSNode) };
+    assert_eq!(node.write_data(0, b"HELLO"), 5);
+    let mut out = [0u8; 12];
+    assert_eq!(hello.read_data(0, &mut out), 12);
+    assert_eq!(&out, b"HELLO world\n");
+    assert!(matches!(hello.data, Some(FileData::Owned(_))));
+    assert!(archive.windows(12).any(|w| w == b"hello world\n"));
+    println!("test:    SUCCESS - archive left untouched");
+
+    // 测试 5: 格式错误
+    println!("test: 5. Testing malformed archives...");
+    let einval = Err(Errno::InvalidArgument.as_neg_i32());
+    assert_eq!(initramfs::parse(b"070707garbage", |_| Ok(())), einval);
+    assert_eq!(initramfs::parse(&buf[..200], |_| Ok(())), einval);
+    assert_eq!(initramfs::parse(&[0u8; 16], |_| Ok(())), Ok(0));
+    println!("test:    SUCCESS - malformed archives rejected");
+
+    println!("test: Initramfs testing completed.");
+}
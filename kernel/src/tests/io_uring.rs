@@ -0,0 +1,101 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! io_uring 测试
+//!
+//! 按用户的协议放入 SQE、收割 CQE：批量提交、串联请求的取消、CQ 满时的溢出
+
+use crate::println;
+use crate::fs::io_uring::{opcode, sqe_flags, IoRingCtx, IoUringParams, IoUringSqe};
+
+fn sqe(op: u8, fd: i32, flags: u8, user_data: u64) -> IoUringSqe {
+    IoUringSqe {
+        opcode: op,
+        flags,
+        ioprio: 0,
+        fd,
+        off: 0,
+        addr: 0,
+        len: 0,
+        op_flags: 0,
+        user_data,
+        buf_index: 0,
+        personality: 0,
+        splice_fd_in: 0,
+        pad: [0; 2],
+    }
+}
+
+pub fn test_io_uring() {
+    println!("test: ===== Starting io_uring Tests =====");
+
+    // 1. 条目数取整到 2 的幂，CQ 是 SQ 的两倍
+    println!("test: 1. Testing io_uring_setup...");
+    let (ctx, params) = match IoRingCtx::new(3, &IoUringParams::default()) {
+        Ok(ring) => ring,
+        Err(e) => {
+            println!("test:    FAILED - setup returned {}", e);
+            return;
+        }
+    };
+    assert_eq!(params.sq_entries, 4);
+    assert_eq!(params.cq_entries, 8);
+    assert!(IoRingCtx::new(0, &IoUringParams::default()).is_err());
+    println!("test:    SUCCESS - ring sizes are rounded up");
+
+    // 2. 一次提交多个请求，完成项按顺序出现
+    println!("test: 2. Testing batched NOP submission...");
+    for i in 0..4 {
+        assert!(ctx.push_sqe(&sqe(opcode::IORING_OP_NOP, -1, 0, i)));
+    }
+    assert!(!ctx.push_sqe(&sqe(opcode::IORING_OP_NOP, -1, 0, 99)));
+    assert_eq!(ctx.submit(4), 4);
+    for i in 0..4 {
+        let cqe = ctx.pop_cqe().expect("missing cqe");
+        assert_eq!(cqe.user_data, i);
+        assert_eq!(cqe.res, 0);
+    }
+    assert!(ctx.pop_cqe().is_none());
+    println!("test:    SUCCESS - one enter completes the whole batch");
+
+    // 3. 串联请求中失败的请求取消其后的请求
+    println!("test: 3. Testing IOSQE_IO_LINK cancellation...");
+    ctx.push_sqe(&sqe(opcode::IORING_OP_NOP, -1, sqe_flags::IOSQE_IO_LINK, 1));
+    ctx.push_sqe(&sqe(opcode::IORING_OP_READ, -1, sqe_flags::IOSQE_IO_LINK, 2));
+    ctx.push_sqe(&sqe(opcode::IORING_OP_NOP, -1, 0, 3));
+    assert_eq!(ctx.submit(3), 3);
+    let res: alloc::vec::Vec<(u64, i32)> = (0..3).map(|_| {
+        let cqe = ctx.pop_cqe().expect("missing cqe");
+        (cqe.user_data, cqe.res)
+    }).collect();
+    assert_eq!(res[0], (1, 0));
+    assert_eq!(res[1], (2, -9));
+    assert_eq!(res[2], (3, -125));
+    println!("test:    SUCCESS - the rest of the chain gets ECANCELED");
+
+    // 4. CQ 满时完成项不丢弃，收割后补回
+    println!("test: 4. Testing CQ overflow...");
+    for round in 0..3u64 {
+        for i in 0..4 {
+            ctx.push_sqe(&sqe(opcode::IORING_OP_NOP, -1, 0, round * 4 + i));
+        }
+        ctx.submit(4);
+    }
+    let mut seen = 0;
+    while let Some(cqe) = ctx.pop_cqe() {
+        assert_eq!(cqe.user_data, seen);
+        seen += 1;
+    }
+    assert_eq!(seen, 8);
+    ctx.submit(0);
+    while let Some(cqe) = ctx.pop_cqe() {
+        assert_eq!(cqe.user_data, seen);
+        seen += 1;
+    }
+    assert_eq!(seen, 12);
+    println!("test:    SUCCESS - overflowed completions are flushed in order");
+
+    println!("test: ===== io_uring Tests Completed =====");
+}
@@ -0,0 +1,155 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：IPv4 分片重组与路径 MTU
+//
+// 测试内容：
+// 1. 按顺序与乱序到达的分片重组成完整的数据报，IP 头按完整长度重写
+// 2. 重复的分片被忽略，重叠的分片使整个队列作废
+// 3. 超时未到齐的队列被丢弃并计数
+// 4. ICMP "需要分片" 的 MTU 只降低路径 MTU，过小的值按 552 处理
+// 5. 路径 MTU 换算成 TCP MSS
+
+use alloc::vec::Vec;
+use crate::println;
+use crate::net::buffer::{alloc_skb, SkBuff};
+use crate::net::ipv4::{checksum, ip_frag_flags, INADDR_LOCAL};
+use crate::net::ipv4::ip_fragment::{ip_defrag, ip_frag_expire, ip_frag_mem, ip_frag_stats, IPFRAG_TIME};
+use crate::net::ipv4::route::{ip_dst_mtu, ip_rt_update_pmtu, pmtu_exception_count, route_add, route_clear};
+use crate::net::tcp_output::tcp_mtu_to_mss;
+use crate::time::get_jiffies;
+
+/// 测试用的对端地址
+const PEER_IP: u32 = 0x0A000202;
+/// 测试用的本机地址
+const LOCAL_IP: u32 = 0x0A00020F;
+
+pub fn test_ip_fragment() {
+    println!("test: ===== Testing IPv4 Fragmentation and PMTU =====");
+
+    let payload: Vec<u8> = (0..3000u32).map(|i| (i * 7) as u8).collect();
+
+    // 测试 1: 重组
+    println!("test: 1. Testing in-order and out-of-order reassembly...");
+    let base = ip_frag_stats();
+    assert!(feed(0x1001, &payload, 0, 1480).is_none());
+    assert!(feed(0x1001, &payload, 1480, 1480).is_none());
+    let full = feed(0x1001, &payload, 2960, 40).expect("reassembled");
+    check_datagram(&full, 0x1001, &payload);
+    full.free();
+    // 最后一个分片先到
+    assert!(feed(0x1002, &payload, 2960, 40).is_none());
+    assert!(feed(0x1002, &payload, 1480, 1480).is_none());
+    let full = feed(0x1002, &payload, 0, 1480).expect("reassembled");
+    check_datagram(&full, 0x1002, &payload);
+    full.free();
+    assert_eq!(ip_frag_mem(), (0, 0));
+    assert_eq!(ip_frag_stats().reasm_oks - base.reasm_oks, 2);
+    println!("test:    SUCCESS - datagrams reassembled in any order");
+
+    // 测试 2: 重复与重叠
+    println!("test: 2. Testing duplicate and overlapping fragments...");
+    assert!(feed(0x1003, &payload, 0, 1480).is_none());
+    assert!(feed(0x1003, &payload, 0, 1480).is_none());
+    assert_eq!(ip_frag_mem().0, 1);
+    assert!(feed(0x1003, &payload, 1480, 1480).is_none());
+    let full = feed(0x1003, &payload, 2960, 40).expect("reassembled");
+    check_datagram(&full, 0x1003, &payload);
+    full.free();
+    let before = ip_frag_stats();
+    assert!(feed(0x1004, &payload, 0, 1480).is_none());
+    assert!(feed(0x1004, &payload, 1472, 1488).is_none());
+    assert_eq!(ip_frag_mem(), (0, 0));
+    assert_eq!(ip_frag_stats().reasm_overlaps - before.reasm_overlaps, 1);
+    // 队列作废后剩下的分片重新开始一个无法完成的队列
+    assert!(feed(0x1004, &payload, 2960, 40).is_none());
+    assert_eq!(ip_frag_mem().0, 1);
+    println!("test:    SUCCESS - duplicates ignored, overlap drops the queue");
+
+    // 测试 3: 超时
+    println!("test: 3. Testing reassembly timeout...");
+    let before = ip_frag_stats();
+    assert!(feed(0x1005, &payload, 0, 1480).is_none());
+    assert_eq!(ip_frag_expire(get_jiffies()), 0);
+    assert_eq!(ip_frag_expire(get_jiffies() + IPFRAG_TIME), 2);
+    assert_eq!(ip_frag_mem(), (0, 0));
+    assert_eq!(ip_frag_stats().reasm_timeout - before.reasm_timeout, 2);
+    println!("test:    SUCCESS - incomplete queues expire");
+
+    // 测试 4: 路径 MTU
+    println!("test: 4. Testing path MTU update...");
+    route_clear();
+    assert!(route_add(0x0A000000, 0xFF000000, 0, 1, 1500).is_ok());
+    assert_eq!(ip_dst_mtu(PEER_IP), 1500);
+    assert_eq!(ip_rt_update_pmtu(PEER_IP, 1400), Some(1400));
+    assert_eq!(ip_dst_mtu(PEER_IP), 1400);
+    // 同一网段中的其他地址不受影响
+    assert_eq!(ip_dst_mtu(PEER_IP + 1), 1500);
+    // 不升高
+    assert_eq!(ip_rt_update_pmtu(PEER_IP, 1450), None);
+    assert_eq!(ip_dst_mtu(PEER_IP), 1400);
+    // 过小的值与不报告 MTU 的 0 按 552 处理
+    assert_eq!(ip_rt_update_pmtu(PEER_IP, 68), Some(552));
+    assert_eq!(ip_rt_update_pmtu(PEER_IP, 0), None);
+    assert_eq!(ip_dst_mtu(PEER_IP), 552);
+    assert_eq!(pmtu_exception_count(), 1);
+    // 发往本机的报文不受路径 MTU 限制
+    assert_eq!(ip_rt_update_pmtu(INADDR_LOCAL, 1000), None);
+    route_clear();
+    assert_eq!(pmtu_exception_count(), 0);
+    println!("test:    SUCCESS - PMTU only decreases, clamped to 552");
+
+    // 测试 5: MSS
+    println!("test: 5. Testing MTU to MSS conversion...");
+    assert_eq!(tcp_mtu_to_mss(1500), 1460);
+    assert_eq!(tcp_mtu_to_mss(552), 512);
+    assert_eq!(tcp_mtu_to_mss(68), 48);
+    println!("test:    SUCCESS - MSS follows the path MTU");
+
+    println!("test: IPv4 fragmentation and PMTU testing completed.");
+}
+
+/// 构造对端发来的一个分片并交给 ip_defrag
+///
+/// # 参数
+/// - `offset`: 分片数据在数据报中的偏移
+/// - `len`: 分片数据的长度；到达数据报末尾的是最后一个分片
+fn feed(id: u16, payload: &[u8], offset: usize, len: usize) -> Option<SkBuff> {
+    let last = offset + len >= payload.len();
+    let data = &payload[offset..(offset + len).min(payload.len())];
+    let mut frame = alloc::vec![0u8; 20 + data.len()];
+    {
+        let ip = &mut frame[..20];
+        ip[0] = 0x45;
+        ip[2..4].copy_from_slice(&((20 + data.len()) as u16).to_be_bytes());
+        ip[4..6].copy_from_slice(&id.to_be_bytes());
+        let frag_off = (offset / 8) as u16 | if last { 0 } else { ip_frag_flags::MF };
+        ip[6..8].copy_from_slice(&frag_off.to_be_bytes());
+        ip[8] = 64;
+        ip[9] = 17;
+        ip[12..16].copy_from_slice(&PEER_IP.to_be_bytes());
+        ip[16..20].copy_from_slice(&LOCAL_IP.to_be_bytes());
+        let check = checksum::ip_checksum(ip);
+        ip[10..12].copy_from_slice(&check.to_be_bytes());
+    }
+    frame[20..].copy_from_slice(data);
+    let mut skb = alloc_skb(frame.len() as u32).expect("skb alloc");
+    skb.skb_put_data(&frame).expect("skb put");
+    let full = ip_defrag(&skb, 20, skb.len);
+    skb.free();
+    full
+}
+
+/// 检查重组后的数据报：总长度、分片字段、头部校验和与数据
+fn check_datagram(skb: &SkBuff, id: u16, payload: &[u8]) {
+    let mut bytes = alloc::vec![0u8; skb.len as usize];
+    skb.skb_copy_bits(0, &mut bytes, skb.len);
+    assert_eq!(bytes.len(), 20 + payload.len());
+    assert_eq!(u16::from_be_bytes([bytes[2], bytes[3]]) as usize, bytes.len());
+    assert_eq!(u16::from_be_bytes([bytes[4], bytes[5]]), id);
+    assert_eq!(u16::from_be_bytes([bytes[6], bytes[7]]), 0);
+    assert_eq!(checksum::ip_checksum(&bytes[..20]), 0);
+    assert_eq!(&bytes[20..], payload);
+}
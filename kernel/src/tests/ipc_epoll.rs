@@ -4,8 +4,13 @@
 //!
 //! epoll 系统调用测试
 
+use alloc::sync::Arc;
+use alloc::vec::Vec;
 use crate::println;
-use crate::arch::riscv64::syscall::{EPollEvent, epoll_events, epoll_ctl_ops};
+use crate::arch::riscv64::syscall::{syscall_handler, EPollEvent, SyscallFrame, epoll_events, epoll_ctl_ops};
+use crate::fs::eventpoll::{ep_ctl, ep_poll, epoll_create_file, file_epoll, EventPoll};
+use crate::fs::file::{fput, File};
+use crate::net::unix::{unix_recvmsg, unix_sendmsg, unix_sock_arc, unix_sock_file, unix_socketpair, SOCK_STREAM};
 
 pub fn test_epoll() {
     println!("test: ===== Starting epoll() System Call Tests =====");
@@ -22,10 +27,26 @@ pub fn test_epoll() {
     println!("test: 3. Testing epoll_ctl operations...");
     test_epoll_ctl_operations();
 
-    // 测试 4: epoll 系统调用存在性
-    println!("test: 4. Testing epoll syscalls existence...");
+    // 测试 4: 按 musl 的系统调用号调用
+    println!("test: 4. Testing epoll syscalls by musl numbers...");
     test_epoll_syscalls();
 
+    // 测试 5: 水平触发的就绪链表
+    println!("test: 5. Testing level-triggered ready list...");
+    test_epoll_level_triggered();
+
+    // 测试 6: EPOLLET 与 EPOLLONESHOT
+    println!("test: 6. Testing EPOLLET and EPOLLONESHOT...");
+    test_epoll_edge_oneshot();
+
+    // 测试 7: epoll_ctl 错误与 EPOLLEXCLUSIVE
+    println!("test: 7. Testing epoll_ctl errors and EPOLLEXCLUSIVE...");
+    test_epoll_ctl_errors();
+
+    // 测试 8: 关闭文件后自动摘除，嵌套 epoll
+    println!("test: 8. Testing auto removal and nested epoll...");
+    test_epoll_release_nested();
+
     println!("test: ===== epoll() Tests Completed =====");
 }
 
@@ -59,12 +80,261 @@ fn test_epoll_ctl_operations() {
     println!("test:    SUCCESS - epoll_ctl operations defined");
 }
 
+/// musl riscv64 使用的系统调用号 (asm-generic/unistd.h)
+const NR_EVENTFD2: u64 = 19;
+const NR_EPOLL_CREATE1: u64 = 20;
+const NR_EPOLL_CTL: u64 = 21;
+const NR_EPOLL_PWAIT: u64 = 22;
+const NR_CLOSE: u64 = 57;
+
+const EINVAL: u64 = -22_i64 as u64;
+const EINTR: u64 = -4_i64 as u64;
+
+fn syscall(nr: u64, args: [u64; 6]) -> u64 {
+    let mut frame = SyscallFrame::default();
+    frame.a7 = nr;
+    frame.a0 = args[0];
+    frame.a1 = args[1];
+    frame.a2 = args[2];
+    frame.a3 = args[3];
+    frame.a4 = args[4];
+    frame.a5 = args[5];
+    syscall_handler(&mut frame);
+    frame.a0
+}
+
+/// 按 musl 的系统调用号调用 epoll_create1 / epoll_ctl / epoll_pwait
+///
+/// 事件数组必须在用户地址范围内：临时换上只有一页匿名映射的用户地址空间
 fn test_epoll_syscalls() {
-    println!("test:    epoll_create syscall number: 20");
-    println!("test:    epoll_create1 syscall number: 251");
-    println!("test:    epoll_ctl syscall number: 21");
-    println!("test:    epoll_wait syscall number: 22");
-    println!("test:    epoll_pwait syscall number: 252");
-    println!("test:    Note: Direct syscall testing requires complex frame setup");
-    println!("test:    SUCCESS - epoll syscalls exist");
+    use crate::arch::riscv64::mm::{create_user_address_space, map, AddressSpace};
+    use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+    use crate::mm::vma::{VmaFlags, VmaType};
+    use crate::signal::{restore_saved_sigmask_unless, sigmask, Signal};
+
+    let current = match crate::sched::current() {
+        Some(task) if task.has_fdtable() => task,
+        _ => {
+            println!("test:    SKIPPED - no current process with an fd table");
+            return;
+        }
+    };
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIPPED - no page table available");
+            return;
+        }
+    };
+    let aspace = Arc::new(unsafe { AddressSpace::new(root_ppn) });
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let page = aspace
+        .mmap(PageVirtAddr::new(0), PAGE_SIZE, flags, VmaType::Anonymous,
+              map::MAP_PRIVATE | map::MAP_ANONYMOUS | map::MAP_POPULATE)
+        .expect("mmap failed")
+        .as_usize();
+    let old_mm = current.address_space_arc();
+    current.set_shared_address_space(Some(aspace.clone()));
+    let old_satp: u64;
+    unsafe {
+        core::arch::asm!("csrr {}, satp", out(reg) old_satp);
+        aspace.enable();
+    }
+    let event = page as *mut EPollEvent;
+    let events = (page + 64) as *mut EPollEvent;
+    let mask_ptr = (page + 1024) as *mut u64;
+    let read_event = |i: usize| unsafe { core::ptr::read_volatile(events.add(i)) };
+
+    // 20 是 epoll_create1：musl 的 epoll_create(size) 也以 flags = 0 调用它
+    let epfd = syscall(NR_EPOLL_CREATE1, [0; 6]);
+    assert!((epfd as i64) >= 0, "epoll_create1(0) failed: {}", epfd as i64);
+    assert_eq!(syscall(NR_EPOLL_CREATE1, [1, 0, 0, 0, 0, 0]), EINVAL);
+    let idle = syscall(NR_EPOLL_CREATE1, [0o2000000, 0, 0, 0, 0, 0]);
+    assert!((idle as i64) >= 0);
+
+    let efd = syscall(NR_EVENTFD2, [1, 0, 0, 0, 0, 0]);
+    assert!((efd as i64) >= 0);
+    unsafe { core::ptr::write_volatile(event, EPollEvent { events: epoll_events::EPOLLIN, data: 7 }) };
+    assert_eq!(syscall(NR_EPOLL_CTL, [epfd, epoll_ctl_ops::EPOLL_CTL_ADD as u64, efd, event as u64, 0, 0]), 0);
+
+    // 22 是 epoll_pwait：sigmask 为 NULL 时与 epoll_wait 相同
+    let ready = EPollEvent { events: epoll_events::EPOLLIN, data: 7 };
+    assert_eq!(syscall(NR_EPOLL_PWAIT, [epfd, events as u64, 4, 0, 0, 0]), 1);
+    assert_eq!(read_event(0), ready);
+
+    // 临时掩码只在等待期间生效，返回后恢复
+    let usr1 = sigmask(Signal::SIGUSR1 as i32);
+    let old_mask = current.sigmask;
+    unsafe { core::ptr::write_volatile(mask_ptr, usr1) };
+    assert_eq!(syscall(NR_EPOLL_PWAIT, [epfd, events as u64, 4, 0, mask_ptr as u64, 8]), 1);
+    assert_eq!(read_event(0), ready);
+    assert_eq!(current.sigmask, old_mask);
+    assert!(current.saved_sigmask.is_none());
+    assert_eq!(syscall(NR_EPOLL_PWAIT, [epfd, events as u64, 4, 0, mask_ptr as u64, 4]), EINVAL);
+
+    // 原掩码屏蔽的待处理信号被临时掩码解除屏蔽：等待返回 EINTR，
+    // 临时掩码保留到信号递送，信号帧保存原掩码
+    current.sigmask = old_mask | usr1;
+    current.pending.add(Signal::SIGUSR1 as i32);
+    unsafe { core::ptr::write_volatile(mask_ptr, 0) };
+    assert_eq!(syscall(NR_EPOLL_PWAIT, [idle, events as u64, 4, 1, mask_ptr as u64, 8]), EINTR);
+    assert_eq!(current.sigmask, 0);
+    assert_eq!(current.saved_sigmask, Some(old_mask | usr1));
+    assert_eq!(current.pending.dequeue(0).map(|info| info.si_signo), Some(Signal::SIGUSR1 as i32));
+    unsafe { restore_saved_sigmask_unless(current, false) };
+    assert_eq!(current.sigmask, old_mask | usr1);
+    current.sigmask = old_mask;
+    current.pending.recalc(old_mask);
+
+    for fd in [efd, idle, epfd] {
+        assert_eq!(syscall(NR_CLOSE, [fd, 0, 0, 0, 0, 0]), 0);
+    }
+    unsafe { core::arch::asm!("csrw satp, {}", "sfence.vma zero, zero", in(reg) old_satp) };
+    current.set_shared_address_space(old_mm);
+    aspace.mmput();
+    println!("test:    SUCCESS - epoll_create1/epoll_ctl/epoll_pwait reached by numbers 20/21/22");
+}
+
+/// 创建 epoll 实例
+fn new_epoll() -> (Arc<File>, Arc<EventPoll>) {
+    let file = epoll_create_file();
+    let ep = file_epoll(&file).expect("epoll");
+    (file, ep)
+}
+
+/// 创建一对已连接的非阻塞流式套接字文件
+fn stream_pair() -> (Arc<File>, Arc<File>) {
+    let (a, b) = unix_socketpair(SOCK_STREAM).expect("socketpair");
+    (unix_sock_file(a, true), unix_sock_file(b, true))
+}
+
+fn send(file: &File, data: &[u8]) {
+    let sock = unix_sock_arc(file).expect("unix sock");
+    assert_eq!(unix_sendmsg(&sock, &[data], None, Vec::new(), true), data.len() as isize);
+}
+
+fn drain(file: &File) -> usize {
+    let sock = unix_sock_arc(file).expect("unix sock");
+    let mut buf = [0u8; 64];
+    unix_recvmsg(&sock, &mut [&mut buf[..]], true).map_or(0, |recv| recv.len)
+}
+
+fn add(ep: &Arc<EventPoll>, fd: i32, file: &Arc<File>, events: u32, data: u64) -> Result<(), i32> {
+    ep_ctl(ep, epoll_ctl_ops::EPOLL_CTL_ADD, fd, file, Some(&EPollEvent { events, data }))
+}
+
+fn test_epoll_level_triggered() {
+    let (epfile, ep) = new_epoll();
+    let (a, b) = stream_pair();
+    assert_eq!(add(&ep, 4, &b, epoll_events::EPOLLIN, 0xb), Ok(()));
+    assert_eq!(ep_poll(&ep, 8, 0).map(|ev| ev.len()), Ok(0));
+
+    // 写入由等待队列回调放入就绪链表
+    send(&a, b"ping");
+    let events = ep_poll(&ep, 8, 0).expect("epoll_wait");
+    assert_eq!(events, [EPollEvent { events: epoll_events::EPOLLIN, data: 0xb }]);
+    // 水平触发：没有读走之前一直报告
+    assert_eq!(ep_poll(&ep, 8, 0).map(|ev| ev.len()), Ok(1));
+    assert_eq!(drain(&b), 4);
+    assert_eq!(ep_poll(&ep, 8, 0).map(|ev| ev.len()), Ok(0));
+
+    // 已经可写的项在添加时直接就绪
+    assert_eq!(add(&ep, 3, &a, epoll_events::EPOLLOUT, 0xa), Ok(()));
+    let events = ep_poll(&ep, 8, 0).expect("epoll_wait");
+    assert_eq!(events, [EPollEvent { events: epoll_events::EPOLLOUT, data: 0xa }]);
+
+    fput(a);
+    fput(b);
+    fput(epfile);
+    println!("test:    SUCCESS - ready entries reported until drained");
+}
+
+fn test_epoll_edge_oneshot() {
+    let (epfile, ep) = new_epoll();
+    let (a, b) = stream_pair();
+    let (c, d) = stream_pair();
+    assert_eq!(add(&ep, 4, &b, epoll_events::EPOLLIN | epoll_events::EPOLLET, 1), Ok(()));
+    assert_eq!(add(&ep, 6, &d, epoll_events::EPOLLIN | epoll_events::EPOLLONESHOT, 2), Ok(()));
+
+    send(&a, b"x");
+    send(&c, b"y");
+    assert_eq!(ep_poll(&ep, 8, 0).map(|ev| ev.len()), Ok(2));
+    // 都不再报告：边缘触发等新数据，EPOLLONESHOT 已禁用
+    assert_eq!(ep_poll(&ep, 8, 0).map(|ev| ev.len()), Ok(0));
+
+    send(&a, b"x");
+    send(&c, b"y");
+    let events = ep_poll(&ep, 8, 0).expect("epoll_wait");
+    assert_eq!(events, [EPollEvent { events: epoll_events::EPOLLIN, data: 1 }]);
+
+    // EPOLL_CTL_MOD 重新启用
+    let event = EPollEvent { events: epoll_events::EPOLLIN | epoll_events::EPOLLONESHOT, data: 3 };
+    assert_eq!(ep_ctl(&ep, epoll_ctl_ops::EPOLL_CTL_MOD, 6, &d, Some(&event)), Ok(()));
+    let events = ep_poll(&ep, 8, 0).expect("epoll_wait");
+    assert_eq!(events, [EPollEvent { events: epoll_events::EPOLLIN, data: 3 }]);
+
+    for file in [a, b, c, d, epfile] {
+        fput(file);
+    }
+    println!("test:    SUCCESS - edge and one-shot entries reported once");
+}
+
+fn test_epoll_ctl_errors() {
+    use epoll_ctl_ops::*;
+    use epoll_events::*;
+
+    let (epfile, ep) = new_epoll();
+    let (a, b) = stream_pair();
+    let excl = EPOLLIN | EPOLLEXCLUSIVE;
+    assert_eq!(add(&ep, 4, &b, EPOLLIN | EPOLLEXCLUSIVE | EPOLLONESHOT, 0), Err(-22));
+    assert_eq!(add(&ep, 4, &b, excl, 0), Ok(()));
+    assert_eq!(add(&ep, 4, &b, EPOLLIN, 0), Err(-17));
+    assert_eq!(ep_ctl(&ep, EPOLL_CTL_MOD, 4, &b, Some(&EPollEvent { events: EPOLLIN, data: 0 })), Err(-22));
+    assert_eq!(ep_ctl(&ep, EPOLL_CTL_MOD, 5, &b, Some(&EPollEvent { events: EPOLLIN, data: 0 })), Err(-2));
+    assert_eq!(add(&ep, 7, &epfile, EPOLLIN, 0), Err(-22));
+
+    // 两个实例独占地监视同一个文件，没有等待者时都能收到
+    let (epfile2, ep2) = new_epoll();
+    assert_eq!(add(&ep2, 4, &b, excl, 0), Ok(()));
+    send(&a, b"z");
+    assert_eq!(ep_poll(&ep, 8, 0).map(|ev| ev.len()), Ok(1));
+    assert_eq!(ep_poll(&ep2, 8, 0).map(|ev| ev.len()), Ok(1));
+
+    assert_eq!(ep_ctl(&ep, EPOLL_CTL_DEL, 4, &b, None), Ok(()));
+    assert_eq!(ep_ctl(&ep, EPOLL_CTL_DEL, 4, &b, None), Err(-2));
+    assert_eq!(ep.nr_items(), 0);
+
+    for file in [a, b, epfile, epfile2] {
+        fput(file);
+    }
+    println!("test:    SUCCESS - invalid operations rejected");
+}
+
+fn test_epoll_release_nested() {
+    let (epfile, ep) = new_epoll();
+    let (outer_file, outer) = new_epoll();
+    let (a, b) = stream_pair();
+    assert_eq!(add(&ep, 4, &b, epoll_events::EPOLLIN, 0), Ok(()));
+    assert_eq!(add(&outer, 5, &epfile, epoll_events::EPOLLIN, 5), Ok(()));
+    // 互相监视会形成环
+    assert_eq!(add(&ep, 6, &outer_file, epoll_events::EPOLLIN, 0), Err(-40));
+
+    send(&a, b"n");
+    let events = ep_poll(&outer, 8, 0).expect("epoll_wait");
+    assert_eq!(events, [EPollEvent { events: epoll_events::EPOLLIN, data: 5 }]);
+    assert_eq!(drain(&b), 1);
+    assert_eq!(ep_poll(&outer, 8, 0).map(|ev| ev.len()), Ok(0));
+
+    // 最后一个引用释放时自动摘除
+    fput(b);
+    assert_eq!(ep.nr_items(), 0);
+    assert_eq!(ep_poll(&ep, 8, 0).map(|ev| ev.len()), Ok(0));
+    fput(a);
+
+    drop(ep);
+    fput(epfile);
+    assert_eq!(outer.nr_items(), 0);
+    fput(outer_file);
+    println!("test:    SUCCESS - closed files leave the interest list");
 }
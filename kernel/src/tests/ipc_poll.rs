@@ -4,8 +4,13 @@
 //!
 //! poll 系统调用测试
 
+use alloc::sync::Arc;
+use alloc::vec::Vec;
 use crate::println;
 use crate::arch::riscv64::syscall::{PollFd, poll_events};
+use crate::fs::file::{fput, File, FileFlags};
+use crate::fs::select::{do_poll, do_select, vfs_poll, PollTable};
+use crate::net::unix::{unix_sendmsg, unix_sock_arc, unix_sock_file, unix_socketpair, SOCK_STREAM};
 
 pub fn test_poll() {
     println!("test: ===== Starting poll() System Call Tests =====");
@@ -22,6 +27,14 @@ pub fn test_poll() {
     println!("test: 3. Testing poll syscall existence...");
     test_poll_syscall();
 
+    // 测试 4: 文件的 poll 方法与等待队列登记
+    println!("test: 4. Testing FileOps::poll registration...");
+    test_poll_method();
+
+    // 测试 5: do_poll / do_select
+    println!("test: 5. Testing do_poll and do_select...");
+    test_do_poll_select();
+
     println!("test: ===== poll() Tests Completed =====");
 }
 
@@ -54,3 +67,76 @@ fn test_poll_syscall() {
     println!("test:    Note: Direct syscall testing requires complex frame setup");
     println!("test:    SUCCESS - poll syscall exists (syscall 7)");
 }
+
+/// 创建一对已连接的非阻塞流式套接字文件
+fn stream_pair() -> (Arc<File>, Arc<File>) {
+    let (a, b) = unix_socketpair(SOCK_STREAM).expect("socketpair");
+    (unix_sock_file(a, true), unix_sock_file(b, true))
+}
+
+fn test_poll_method() {
+    use poll_events::*;
+
+    let (a, b) = stream_pair();
+    let mut pt = PollTable::new();
+    let mask = vfs_poll(&b, Some(&mut pt));
+    assert_eq!(mask & POLLIN as u32, 0);
+    assert_eq!(pt.queues().len(), 1);
+    // 只查询时不登记
+    assert_eq!(vfs_poll(&a, None) & POLLOUT as u32, POLLOUT as u32);
+
+    // 没有 poll 方法的文件总是可读可写
+    let plain = File::new(FileFlags::new(FileFlags::O_RDWR));
+    let mut pt = PollTable::new();
+    assert_eq!(vfs_poll(&plain, Some(&mut pt)) & (POLLIN | POLLOUT) as u32, (POLLIN | POLLOUT) as u32);
+    assert!(pt.queues().is_empty());
+
+    fput(a);
+    fput(b);
+    println!("test:    SUCCESS - socket registers its receive queue");
+}
+
+fn test_do_poll_select() {
+    use poll_events::*;
+
+    let (a, b) = stream_pair();
+    let files = [Some(b.clone()), Some(a.clone()), None, None];
+    let mut fds = [
+        PollFd { fd: 4, events: POLLIN, revents: 0 },
+        PollFd { fd: 3, events: POLLIN | POLLOUT, revents: 0 },
+        PollFd { fd: 9, events: POLLIN, revents: 0 },
+        PollFd { fd: -1, events: POLLIN, revents: 0xffff },
+    ];
+    // 没有数据：只有可写的一端和无效描述符就绪
+    assert_eq!(do_poll(&mut fds, &files, 0), Ok(2));
+    assert_eq!(fds[0].revents, 0);
+    assert_eq!(fds[1].revents, POLLOUT);
+    assert_eq!(fds[2].revents, POLLNVAL);
+    assert_eq!(fds[3].revents, 0);
+
+    let sock = unix_sock_arc(&a).expect("unix sock");
+    assert_eq!(unix_sendmsg(&sock, &[b"sel"], None, Vec::new(), true), 3);
+    assert_eq!(do_poll(&mut fds, &files, 0), Ok(3));
+    assert_eq!(fds[0].revents, POLLIN);
+
+    // select：3 可写，4 可读；异常集合为空
+    let lookup = |fd: usize| match fd {
+        3 => Some(a.clone()),
+        4 => Some(b.clone()),
+        _ => None,
+    };
+    let mut inp = [1u64 << 4 | 1 << 3];
+    let mut outp = [1u64 << 3];
+    let mut exp = [0u64];
+    assert_eq!(do_select(5, [&mut inp, &mut outp, &mut exp], lookup, 0), Ok(2));
+    assert_eq!((inp[0], outp[0], exp[0]), (1 << 4, 1 << 3, 0));
+    // 未打开的描述符
+    let mut inp = [1u64 << 7];
+    assert_eq!(do_select(8, [&mut inp, &mut [], &mut []], lookup, 0), Err(-9));
+
+    drop(sock);
+    drop(files);
+    fput(a);
+    fput(b);
+    println!("test:    SUCCESS - revents and fd sets filled in one pass");
+}
@@ -0,0 +1,106 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：中断亲和性与线程化中断
+//
+// 测试内容：
+// 1. request_irq 拒绝无效中断号和重复注册
+// 2. irq_set_affinity 只在掩码中的 hart 上使能，拒绝没有在线 CPU 的掩码
+// 3. /proc/irq/N/smp_affinity 读写十六进制掩码
+// 4. 返回 WakeThread 的中断在本 CPU 上开中断执行下半部
+// 5. free_irq 在所有 hart 上关闭中断
+
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+use crate::irq::*;
+use crate::println;
+
+/// PLIC 上没有设备的中断号
+const TEST_IRQ: usize = 100;
+
+static HARDIRQ_CALLS: AtomicUsize = AtomicUsize::new(0);
+static THREAD_CALLS: AtomicUsize = AtomicUsize::new(0);
+/// 下半部执行时的 sstatus.SIE 与 CPU
+static THREAD_SIE: AtomicUsize = AtomicUsize::new(0);
+static THREAD_CPU: AtomicUsize = AtomicUsize::new(usize::MAX);
+
+fn test_handler(_irq: usize) -> IrqReturn {
+    HARDIRQ_CALLS.fetch_add(1, Ordering::Relaxed);
+    IrqReturn::WakeThread
+}
+
+fn test_thread() {
+    let sstatus: usize;
+    unsafe { core::arch::asm!("csrr {}, sstatus", out(reg) sstatus, options(nomem, nostack)) };
+    THREAD_SIE.store(sstatus & 0x2, Ordering::Relaxed);
+    THREAD_CPU.store(crate::arch::cpu_id(), Ordering::Relaxed);
+    THREAD_CALLS.fetch_add(1, Ordering::Relaxed);
+}
+
+pub fn test_irq_affinity() {
+    println!("test: ===== Testing IRQ Affinity and Threaded IRQs =====");
+
+    let this_cpu = crate::arch::cpu_id();
+    let einval = crate::errno::Errno::InvalidArgument.as_neg_i32();
+
+    // 测试 1: 注册
+    println!("test: 1. Testing request_irq...");
+    crate::softirq::open_softirq_threaded(crate::softirq::IRQ_POLL_SOFTIRQ, test_thread);
+    assert_eq!(request_irq(0, test_handler, "bad"), Err(einval));
+    assert_eq!(request_irq(crate::drivers::intc::plic::MAX_INTERRUPTS, test_handler, "bad"), Err(einval));
+    assert!(request_threaded_irq(TEST_IRQ, test_handler, Some(crate::softirq::IRQ_POLL_SOFTIRQ), "irq-test").is_ok());
+    assert_eq!(
+        request_irq(TEST_IRQ, test_handler, "irq-test"),
+        Err(crate::errno::Errno::DeviceOrResourceBusy.as_neg_i32())
+    );
+    assert!(registered_irqs().contains(&TEST_IRQ));
+    println!("test:    SUCCESS - invalid and duplicate registrations rejected");
+
+    // 测试 2: 亲和性
+    println!("test: 2. Testing irq_set_affinity...");
+    assert!(irq_set_affinity(TEST_IRQ, 1 << this_cpu).is_ok());
+    assert_eq!(irq_get_affinity(TEST_IRQ), 1 << this_cpu);
+    assert_eq!(irq_effective_affinity(TEST_IRQ), 1 << this_cpu);
+    assert_eq!(irq_set_affinity(TEST_IRQ, 0), Err(einval));
+    assert_eq!(irq_get_affinity(TEST_IRQ), 1 << this_cpu);
+    println!("test:    SUCCESS - enabled only on cpu{}", this_cpu);
+
+    // 测试 3: /proc/irq/N/smp_affinity
+    println!("test: 3. Testing /proc/irq/{}/smp_affinity...", TEST_IRQ);
+    let path = alloc::format!("/irq/{}/smp_affinity", TEST_IRQ);
+    let mask = alloc::format!("{:x}\n", IRQ_DEFAULT_AFFINITY);
+    assert_eq!(crate::fs::procfs::write_file(&path, mask.as_bytes()), Ok(mask.len()));
+    assert_eq!(crate::fs::procfs::read_file(&path), Some(mask.into_bytes()));
+    assert_eq!(crate::fs::procfs::write_file(&path, b"zz\n"), Err(einval));
+    let mask = alloc::format!("0x{:x}", 1 << this_cpu);
+    assert!(crate::fs::procfs::write_file(&path, mask.as_bytes()).is_ok());
+    assert_eq!(irq_get_affinity(TEST_IRQ), 1 << this_cpu);
+    println!("test:    SUCCESS - hex mask read back and applied");
+
+    // 测试 4: 线程化下半部
+    println!("test: 4. Testing threaded bottom half...");
+    let before = kstat_irqs_cpu(TEST_IRQ, this_cpu);
+    {
+        let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+        handle_irq(TEST_IRQ);
+        assert_eq!(THREAD_CALLS.load(Ordering::Relaxed), 0);
+        crate::softirq::do_softirq();
+    }
+    assert_eq!(HARDIRQ_CALLS.load(Ordering::Relaxed), 1);
+    assert_eq!(THREAD_CALLS.load(Ordering::Relaxed), 1);
+    assert_eq!(THREAD_SIE.load(Ordering::Relaxed), 0x2);
+    assert_eq!(THREAD_CPU.load(Ordering::Relaxed), this_cpu);
+    assert_eq!(kstat_irqs_cpu(TEST_IRQ, this_cpu), before + 1);
+    println!("test:    SUCCESS - bottom half ran on cpu{} with interrupts enabled", this_cpu);
+
+    // 测试 5: 注销
+    println!("test: 5. Testing free_irq...");
+    free_irq(TEST_IRQ);
+    assert_eq!(irq_effective_affinity(TEST_IRQ), 0);
+    assert!(!registered_irqs().contains(&TEST_IRQ));
+    println!("test:    SUCCESS - disabled on all harts");
+
+    println!("test: IRQ affinity testing completed.");
+}
@@ -0,0 +1,183 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! JBD2 日志单元测试
+//!
+//! 在内存盘上建一个 CSUM_V3 日志：提交只写日志区域且合并重复的强制提交、
+//! 放弃日志后重新加载时重放已提交的事务、按事务号等待提交、检查点写回原位置并把日志标记为空
+
+use alloc::boxed::Box;
+use alloc::vec;
+use spin::Mutex;
+
+use crate::println;
+use crate::crc32::crc32c;
+use crate::drivers::blkdev::{self, GenDisk, ReqCmd, Request};
+use crate::fs::bio;
+use crate::fs::jbd2::{self, sb_off, Journal};
+
+const BLOCK_SIZE: usize = 4096;
+const NR_BLOCKS: usize = 64;
+
+/// 日志占用的磁盘块 [JOURNAL_START, JOURNAL_START + JOURNAL_LEN)
+const JOURNAL_START: u64 = 8;
+const JOURNAL_LEN: u64 = 32;
+
+/// 被日志保护的两个元数据块
+const HOME_A: u64 = 50;
+const HOME_B: u64 = 51;
+
+/// 内存盘：64 个 4KB 块
+static RAMDISK: Mutex<[u8; NR_BLOCKS * BLOCK_SIZE]> = Mutex::new([0; NR_BLOCKS * BLOCK_SIZE]);
+
+unsafe extern "C" fn ramdisk_request(req: &mut Request) {
+    let mut disk = RAMDISK.lock();
+    let mut off = req.sector as usize * 512;
+    let ret = if req.sg.is_empty() {
+        let end = off + req.buffer.len();
+        match req.cmd_type {
+            ReqCmd::Read if end <= disk.len() => { req.buffer.copy_from_slice(&disk[off..end]); 0 }
+            ReqCmd::Write if end <= disk.len() => { disk[off..end].copy_from_slice(&req.buffer); 0 }
+            ReqCmd::Read | ReqCmd::Write => -5,  // EIO
+            _ => 0,
+        }
+    } else {
+        for &(addr, len) in &req.sg {
+            let seg = core::slice::from_raw_parts_mut(addr as *mut u8, len);
+            match req.cmd_type {
+                ReqCmd::Read => seg.copy_from_slice(&disk[off..off + len]),
+                ReqCmd::Write => disk[off..off + len].copy_from_slice(seg),
+                _ => {}
+            }
+            off += len;
+        }
+        0
+    };
+    if let Some(end_io) = req.end_io {
+        end_io(req, ret);
+    }
+}
+
+/// 磁盘块的内容
+fn disk_block(blocknr: u64) -> alloc::vec::Vec<u8> {
+    let disk = RAMDISK.lock();
+    let start = blocknr as usize * BLOCK_SIZE;
+    disk[start..start + BLOCK_SIZE].to_vec()
+}
+
+/// 写入日志超级块：日志区域 [1, JOURNAL_LEN)，从 tid 7 开始，启用 CSUM_V3 与 64BIT
+fn format_journal() {
+    let mut sb = vec![0u8; BLOCK_SIZE];
+    jbd2::put_be32(&mut sb, 0, jbd2::JBD2_MAGIC_NUMBER);
+    jbd2::put_be32(&mut sb, 4, jbd2::JBD2_SUPERBLOCK_V2);
+    jbd2::put_be32(&mut sb, sb_off::S_BLOCKSIZE, BLOCK_SIZE as u32);
+    jbd2::put_be32(&mut sb, sb_off::S_MAXLEN, JOURNAL_LEN as u32);
+    jbd2::put_be32(&mut sb, sb_off::S_FIRST, 1);
+    jbd2::put_be32(&mut sb, sb_off::S_SEQUENCE, 7);
+    jbd2::put_be32(
+        &mut sb,
+        sb_off::S_FEATURE_INCOMPAT,
+        jbd2::JBD2_FEATURE_INCOMPAT_CSUM_V3 | jbd2::JBD2_FEATURE_INCOMPAT_64BIT,
+    );
+    sb[sb_off::S_UUID..sb_off::S_UUID + 16].copy_from_slice(&[0x5A; 16]);
+    sb[sb_off::S_CHECKSUM_TYPE] = jbd2::JBD2_CRC32C_CHKSUM;
+    let csum = jbd2::superblock_csum(&sb);
+    jbd2::put_be32(&mut sb, sb_off::S_CHECKSUM, csum);
+    let start = JOURNAL_START as usize * BLOCK_SIZE;
+    RAMDISK.lock()[start..start + BLOCK_SIZE].copy_from_slice(&sb);
+}
+
+/// 修改块缓存中的一个块并交给日志
+fn journal_block(journal: &Journal, disk: &GenDisk, blocknr: u64, fill: u8, magic: bool) {
+    let bh = bio::bread(disk, blocknr).expect("bread");
+    unsafe {
+        (*bh).b_data.fill(fill);
+        if magic {
+            jbd2::put_be32(&mut (*bh).b_data, 0, jbd2::JBD2_MAGIC_NUMBER);
+        }
+    }
+    assert!(journal.dirty_metadata(bh).is_ok());
+    bio::brelse(bh);
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_jbd2() {
+    println!("test: ===== Starting JBD2 Journal Tests =====");
+
+    // 地址唯一的磁盘，块缓存中留下的缓冲区不会与以后的设备混淆
+    let disk: &'static mut GenDisk = Box::leak(Box::new(GenDisk::new("jbd0", 251, 1, 512, None)));
+    disk.set_capacity((NR_BLOCKS * BLOCK_SIZE / 512) as u32);
+    disk.set_request_fn(ramdisk_request);
+    let disk: &'static GenDisk = disk;
+    let map = vec![(0, JOURNAL_START, JOURNAL_LEN)];
+
+    // 1. CRC32C 标准测试向量
+    println!("test: 1. Testing crc32c check value...");
+    assert_eq!(crc32c(!0, b"123456789") ^ !0, 0xE306_9283);
+    println!("test:    SUCCESS - crc32c(\"123456789\") = 0xE3069283");
+
+    // 2. 加载日志：超级块记录日志从 first 开始
+    println!("test: 2. Testing journal load...");
+    format_journal();
+    let journal = Journal::load(disk, BLOCK_SIZE, map.clone()).expect("load");
+    let stats = journal.stats();
+    assert_eq!(stats.log_size, JOURNAL_LEN - 1);
+    assert_eq!(stats.nr_replayed, 0);
+    assert_eq!(jbd2::get_be32(&disk_block(JOURNAL_START), sb_off::S_START), 1);
+    println!("test:    SUCCESS - empty journal opened at block 1");
+
+    // 3. 提交只写日志区域，描述符、两个元数据块、提交块顺序排列；重复的强制提交合并
+    println!("test: 3. Testing commit and group commit...");
+    journal_block(&journal, disk, HOME_A, 0xAB, false);
+    journal_block(&journal, disk, HOME_B, 0x11, true);
+    assert!(journal.force_commit().is_ok());
+    assert!(journal.force_commit().is_ok());
+    let stats = journal.stats();
+    assert_eq!(stats.nr_commits, 1);
+    assert_eq!(stats.log_used, 4);
+    assert!(disk_block(HOME_A).iter().all(|&b| b == 0));
+    let desc = disk_block(JOURNAL_START + 1);
+    assert_eq!(jbd2::get_be32(&desc, 0), jbd2::JBD2_MAGIC_NUMBER);
+    assert_eq!(jbd2::get_be32(&desc, 4), jbd2::JBD2_DESCRIPTOR_BLOCK);
+    assert_eq!(jbd2::get_be32(&desc, 8), 7);
+    // 以魔数开头的块在日志中被转义
+    assert_eq!(jbd2::get_be32(&disk_block(JOURNAL_START + 3), 0), 0);
+    assert_eq!(jbd2::get_be32(&disk_block(JOURNAL_START + 4), 4), jbd2::JBD2_COMMIT_BLOCK);
+    println!("test:    SUCCESS - one commit of 4 log blocks, home blocks untouched");
+
+    // 4. 放弃日志模拟崩溃，重新加载时重放
+    println!("test: 4. Testing recovery after abort...");
+    journal.abort();
+    let journal = Journal::load(disk, BLOCK_SIZE, map).expect("reload");
+    assert_eq!(journal.stats().nr_replayed, 1);
+    assert!(disk_block(HOME_A).iter().all(|&b| b == 0xAB));
+    let home_b = disk_block(HOME_B);
+    assert_eq!(jbd2::get_be32(&home_b, 0), jbd2::JBD2_MAGIC_NUMBER);
+    assert!(home_b[4..].iter().all(|&b| b == 0x11));
+    println!("test:    SUCCESS - committed transaction replayed and unescaped");
+
+    // 5. 按事务号等待提交：已提交的事务不再提交，由调用者刷新设备缓存
+    println!("test: 5. Testing complete_transaction and device flush...");
+    journal_block(&journal, disk, HOME_B, 0x22, false);
+    let tid = journal.running_tid();
+    assert_eq!(journal.complete_transaction(tid), Ok(true));
+    assert_eq!(journal.complete_transaction(tid), Ok(false));
+    let (_, flushes) = disk.flush_stats();
+    assert!(blkdev::blkdev_issue_flush(disk).is_ok());
+    assert_eq!(disk.flush_stats().1, flushes + 1);
+    println!("test:    SUCCESS - committed tid not recommitted, flush issued once");
+
+    // 6. 检查点写回原位置，卸载后日志为空
+    println!("test: 6. Testing checkpoint and clean unmount...");
+    journal_block(&journal, disk, HOME_A, 0xCD, false);
+    assert!(journal.flush().is_ok());
+    assert!(disk_block(HOME_A).iter().all(|&b| b == 0xCD));
+    assert_eq!(journal.stats().log_used, 0);
+    assert!(journal.destroy().is_ok());
+    assert_eq!(jbd2::get_be32(&disk_block(JOURNAL_START), sb_off::S_START), 0);
+    println!("test:    SUCCESS - checkpoint wrote home, journal marked clean");
+
+    println!("test: ===== JBD2 Journal Tests Completed =====");
+}
@@ -0,0 +1,69 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：命名对象缓存 (kmem_cache)
+//
+// 测试内容：
+// 1. 创建缓存并检查对象布局
+// 2. 分配对象满足对齐要求且互不重叠
+// 3. 释放后统计信息正确，shrink 回收空闲 slab
+// 4. /proc/slabinfo 包含缓存名称
+
+use crate::println;
+use crate::mm::kmem_cache::{self, SLAB_HWCACHE_ALIGN};
+use alloc::vec::Vec;
+
+pub fn test_kmem_cache() {
+    println!("test: ===== Testing kmem_cache =====");
+
+    // 测试 1: 创建缓存
+    println!("test: 1. Testing kmem_cache_create...");
+    let cachep = kmem_cache::kmem_cache_create("test_obj", 40, 8, SLAB_HWCACHE_ALIGN, None)
+        .expect("kmem_cache_create failed");
+    assert_eq!(cachep.name(), "test_obj");
+    assert_eq!(cachep.object_size(), 40);
+    assert!(cachep.size() >= 40 && cachep.size() % 64 == 0, "size should be cache-line aligned");
+    assert!(cachep.objects_per_slab() > 0);
+    println!("test:    SUCCESS - size={} num={}", cachep.size(), cachep.objects_per_slab());
+
+    // 测试 2: 分配超过一个 slab 的对象
+    println!("test: 2. Testing kmem_cache_alloc...");
+    let count = cachep.objects_per_slab() + 3;
+    let mut objs: Vec<*mut u8> = Vec::with_capacity(count);
+    for i in 0..count {
+        let obj = kmem_cache::kmem_cache_alloc(cachep);
+        assert!(!obj.is_null(), "alloc {} failed", i);
+        assert_eq!(obj as usize % 64, 0, "object should be cache-line aligned");
+        unsafe { core::ptr::write_bytes(obj, i as u8, 40) };
+        objs.push(obj);
+    }
+    for (i, &obj) in objs.iter().enumerate() {
+        let byte = unsafe { *obj.add(39) };
+        assert_eq!(byte, i as u8, "object {} overlapped", i);
+    }
+    let stats = cachep.stats();
+    assert_eq!(stats.active_objs, count);
+    assert!(stats.num_slabs >= 2);
+    println!("test:    SUCCESS - {} objects in {} slabs", count, stats.num_slabs);
+
+    // 测试 3: 释放并回收
+    println!("test: 3. Testing kmem_cache_free/shrink...");
+    for obj in objs.drain(..) {
+        unsafe { kmem_cache::kmem_cache_free(cachep, obj) };
+    }
+    assert_eq!(cachep.stats().active_objs, 0);
+    kmem_cache::kmem_cache_shrink(cachep);
+    assert_eq!(cachep.stats().num_slabs, 0, "shrink should release all free slabs");
+    println!("test:    SUCCESS - all slabs released");
+
+    // 测试 4: slabinfo
+    println!("test: 4. Testing slabinfo...");
+    let info = kmem_cache::slabinfo();
+    assert!(info.starts_with("slabinfo - version: 2.1"));
+    assert!(info.contains("test_obj"));
+    println!("test:    SUCCESS - slabinfo lists test_obj");
+
+    println!("test: ===== kmem_cache Test Completed =====");
+}
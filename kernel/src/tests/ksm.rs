@@ -0,0 +1,117 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! KSM 单元测试
+//!
+//! 两个地址空间中内容相同的页合并为只读共享的合并页、内容不同的页保持独立、
+//! 写入合并页经 COW 复制、MADV_UNMERGEABLE 与退出取消登记
+
+use crate::println;
+use crate::arch::riscv64::mm::{
+    create_user_address_space, handle_cow_fault, handle_mm_fault, madv, map, AddressSpace, FaultFlags,
+    MmFaultResult, VirtAddr,
+};
+use crate::mm::ksm::{ksm_scan, ksm_stats};
+use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+use crate::mm::page_desc::{pfn_to_page, PageType};
+use crate::mm::vma::{VmaFlags, VmaType};
+
+/// 映射两页并写入：第 0 页两个地址空间相同，第 1 页各不相同
+fn setup(seed: u8) -> Option<(AddressSpace, usize)> {
+    let aspace = unsafe { AddressSpace::new(create_user_address_space()?) };
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let base = aspace
+        .mmap(PageVirtAddr::new(0), 2 * PAGE_SIZE, flags, VmaType::Anonymous, map::MAP_PRIVATE | map::MAP_ANONYMOUS)
+        .ok()?
+        .as_usize();
+    for page in 0..2 {
+        let addr = base + page * PAGE_SIZE;
+        assert_eq!(handle_mm_fault(&aspace, VirtAddr::new(addr as u64), FaultFlags::WRITE | FaultFlags::USER),
+                   MmFaultResult::Handled);
+        let phys = aspace.translate(PageVirtAddr::new(addr)).unwrap().as_usize();
+        for i in 0..PAGE_SIZE {
+            let byte = if page == 0 { (i % 253) as u8 } else { (i % 253) as u8 ^ seed };
+            unsafe { *((phys + i) as *mut u8) = byte };
+        }
+    }
+    aspace.madvise(PageVirtAddr::new(base), 2 * PAGE_SIZE, madv::MADV_MERGEABLE).ok()?;
+    Some((aspace, base))
+}
+
+fn pfn_of(aspace: &AddressSpace, addr: usize) -> usize {
+    aspace.translate(PageVirtAddr::new(addr)).unwrap().as_usize() / PAGE_SIZE
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_ksm() {
+    println!("test: ===== Starting KSM Tests =====");
+
+    let ((a, base_a), (b, base_b)) = match (setup(0x11), setup(0x22)) {
+        (Some(a), Some(b)) => (a, b),
+        (a, b) => {
+            a.into_iter().chain(b).for_each(|(aspace, _)| aspace.mmput());
+            println!("test:    SKIP - no address space available");
+            println!("test: ===== KSM Tests Completed =====");
+            return;
+        }
+    };
+    let before = ksm_stats();
+    assert!(before.mm_slots >= 2);
+
+    // 1. 相同的页合并
+    println!("test: 1. Testing merging of identical pages...");
+    // 第一轮只记录校验和，之后校验和不变的页才合并；后台 ksmd 也可能参与
+    for _ in 0..8 {
+        if pfn_of(&a, base_a) == pfn_of(&b, base_b) {
+            break;
+        }
+        ksm_scan(before.mm_slots * 2 + 4);
+    }
+    let kpfn = pfn_of(&a, base_a);
+    assert_eq!(kpfn, pfn_of(&b, base_b), "identical pages not merged");
+    unsafe {
+        assert_eq!((*pfn_to_page(kpfn)).page_type(), PageType::Ksm);
+        assert_eq!((*pfn_to_page(kpfn)).refcount(), 2);
+    }
+    let stats = ksm_stats();
+    assert!(stats.pages_shared >= 1 && stats.pages_sharing >= 1);
+    assert!(stats.pages_merged > before.pages_merged);
+    println!("test:    SUCCESS - {} page(s) shared, {} sharing", stats.pages_shared, stats.pages_sharing);
+
+    // 2. 内容不同的页不合并
+    println!("test: 2. Testing distinct pages stay private...");
+    assert_ne!(pfn_of(&a, base_a + PAGE_SIZE), pfn_of(&b, base_b + PAGE_SIZE));
+    println!("test:    SUCCESS - pages with different content not merged");
+
+    // 3. 写入合并页经 COW 复制
+    println!("test: 3. Testing write to a merged page...");
+    assert_eq!(handle_mm_fault(&a, VirtAddr::new(base_a as u64), FaultFlags::WRITE | FaultFlags::USER),
+               MmFaultResult::CowPending);
+    assert!(unsafe { handle_cow_fault(&a, VirtAddr::new(base_a as u64)) }.is_some());
+    let private = pfn_of(&a, base_a);
+    assert_ne!(private, kpfn);
+    unsafe {
+        *((private * PAGE_SIZE) as *mut u8) = 0xff;
+        assert_eq!(*((kpfn * PAGE_SIZE) as *const u8), 0, "merged page modified through a private copy");
+        assert_eq!((*pfn_to_page(kpfn)).refcount(), 1);
+    }
+    // 最后一个映射写入时也复制，合并页释放
+    assert!(unsafe { handle_cow_fault(&b, VirtAddr::new(base_b as u64)) }.is_some());
+    assert_ne!(pfn_of(&b, base_b), kpfn);
+    println!("test:    SUCCESS - writes break sharing through COW");
+
+    // 4. 取消登记
+    println!("test: 4. Testing unmergeable and exit...");
+    let slots = ksm_stats().mm_slots;
+    a.madvise(PageVirtAddr::new(base_a), 2 * PAGE_SIZE, madv::MADV_UNMERGEABLE).expect("madvise failed");
+    assert_eq!(ksm_stats().mm_slots, slots - 1);
+    b.mmput();
+    assert_eq!(ksm_stats().mm_slots, slots - 2);
+    a.mmput();
+    println!("test:    SUCCESS - address spaces removed from the scan list");
+
+    println!("test: ===== KSM Tests Completed =====");
+}
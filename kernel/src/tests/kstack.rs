@@ -0,0 +1,70 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：带保护页的内核栈
+//
+// 测试内容：
+// 1. 内核栈映射在内核栈区域，栈底之下是保护页
+// 2. 栈深度统计与最大深度
+// 3. 缓存已满时解除映射，槽位再次映射后可以读写
+
+use alloc::vec::Vec;
+use crate::println;
+use crate::arch::riscv64::mm::vmap_stack;
+use crate::process::kstack::*;
+
+pub fn test_kstack() {
+    println!("test: ===== Testing Guarded Kernel Stacks =====");
+
+    // 测试 1: 布局
+    println!("test: 1. Testing stack placement and guard page...");
+    let top = alloc_kernel_stack().unwrap();
+    let top_addr = top as usize;
+    let bottom = top_addr - KERNEL_STACK_SIZE;
+    assert_eq!(top_addr % 4096, 0);
+    assert!(top_addr > vmap_stack::START as usize
+        && top_addr <= (vmap_stack::START + vmap_stack::SIZE) as usize);
+    assert!(is_guard_page(bottom - 8));
+    assert!(!is_guard_page(bottom));
+    assert!(!is_guard_page(top_addr - 8));
+    assert!(!is_guard_page(0x8020_0000));
+    println!("test:    SUCCESS - stack sits above an unmapped guard page");
+
+    // 测试 2: 栈深度
+    println!("test: 2. Testing stack depth accounting...");
+    unsafe {
+        core::ptr::write_volatile((top_addr - 8) as *mut u64, 0x5a5a);
+        core::ptr::write_volatile((top_addr - 3000) as *mut u64, 0x5a5a);
+    }
+    assert!(stack_used(top) >= 3000);
+    free_kernel_stack(top);
+    assert!(stack_high_water() >= 3000);
+    assert!(kstackinfo().contains("max_used"));
+    println!("test:    SUCCESS - depth recorded at free");
+
+    // 测试 3: 解除映射与再次映射
+    println!("test: 3. Testing unmap beyond the per-CPU cache...");
+    let before = nr_stacks();
+    let stacks: Vec<*mut u8> = (0..8).map(|_| alloc_kernel_stack().unwrap()).collect();
+    assert!(nr_stacks() >= before + 6);
+    for &stack in &stacks {
+        free_kernel_stack(stack);
+    }
+    assert!(nr_stacks() <= before + 2);
+    let stacks: Vec<*mut u8> = (0..8).map(|_| alloc_kernel_stack().unwrap()).collect();
+    for &stack in &stacks {
+        let word = (stack as usize - KERNEL_STACK_SIZE) as *mut u64;
+        unsafe {
+            core::ptr::write_volatile(word, stack as u64);
+            assert_eq!(core::ptr::read_volatile(word), stack as u64);
+        }
+    }
+    for &stack in &stacks {
+        free_kernel_stack(stack);
+    }
+    println!("test:    SUCCESS - recycled slots map fresh pages");
+
+    println!("test: Guarded kernel stack testing completed.");
+}
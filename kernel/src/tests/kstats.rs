@@ -0,0 +1,114 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 共享统计页测试
+//!
+//! 验证页头与布局、seqcount 更新、计数与各模块一致、非对齐读取，
+//! 以及 /dev/kstats 的打开、读取与 stat
+
+use crate::fs::{file_close, file_open, get_file_fd, FileFlags, Stat};
+use crate::kstats::*;
+use crate::mm::pcp::{alloc_page_pcp, free_page_pcp, MigrateType};
+use crate::println;
+
+/// 从快照中取第 idx 个字
+fn word_at(page: &[u8], idx: usize) -> u64 {
+    u64::from_ne_bytes(page[idx * 8..idx * 8 + 8].try_into().unwrap())
+}
+
+/// 读取整页的一致快照
+fn snapshot() -> [u8; 4096] {
+    let mut page = [0u8; 4096];
+    assert_eq!(kstats_read(&mut page, 0), 4096);
+    page
+}
+
+/// 更新一次，tick 正在更新时重试
+fn update() {
+    while !kstats_update() {
+        core::hint::spin_loop();
+    }
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_kstats() {
+    println!("test: ===== Starting Kernel Stats Page Tests =====");
+
+    // 1. 页头
+    println!("test: 1. Testing header...");
+    update();
+    let page = snapshot();
+    assert_eq!(word_at(&page, HDR_MAGIC), KSTATS_MAGIC);
+    assert_eq!(word_at(&page, HDR_VERSION), KSTATS_VERSION);
+    assert_eq!(word_at(&page, HDR_SIZE), 4096);
+    assert_eq!(word_at(&page, HDR_SEQ) & 1, 0);
+    let glb = word_at(&page, HDR_GLB_OFFSET) as usize / 8;
+    let cpu_off = word_at(&page, HDR_CPU_OFFSET) as usize / 8;
+    let stride = word_at(&page, HDR_CPU_STRIDE) as usize / 8;
+    let nr_cpus = word_at(&page, HDR_NR_CPUS) as usize;
+    assert_eq!(nr_cpus, crate::config::MAX_CPUS);
+    assert!(glb + GLB_NET_TX_DROPPED < cpu_off);
+    assert!(stride > CPU_IDLE_SUSPEND_USAGE);
+    assert!(cpu_off + nr_cpus * stride <= 512);
+    println!("test:    SUCCESS - {} CPU sections of {} bytes", nr_cpus, stride * 8);
+
+    // 2. 每次更新 seq 加 2
+    println!("test: 2. Testing seqcount...");
+    let seq = word_at(&snapshot(), HDR_SEQ);
+    update();
+    let after = word_at(&snapshot(), HDR_SEQ);
+    assert!(after >= seq + 2 && after & 1 == 0);
+    println!("test:    SUCCESS - seq {} -> {}", seq, after);
+
+    // 3. 计数与各模块一致
+    println!("test: 3. Testing counters...");
+    let cpu = crate::arch::cpu_id() as usize;
+    let this = cpu_off + cpu * stride;
+    let before = snapshot();
+    let frame = alloc_page_pcp(MigrateType::Unmovable).expect("page allocation");
+    free_page_pcp(frame, MigrateType::Unmovable);
+    update();
+    let page = snapshot();
+    assert_eq!(word_at(&page, this + CPU_ONLINE), 1);
+    assert_eq!(word_at(&page, glb + GLB_NR_PAGES), crate::mm::page::frame_stats().total_frames as u64);
+    assert_eq!(word_at(&page, glb + GLB_NR_CPUS_ONLINE), crate::sched::cpu_active_mask().count_ones() as u64);
+    assert!(word_at(&page, glb + GLB_TIMESTAMP_NS) > word_at(&before, glb + GLB_TIMESTAMP_NS));
+    assert!(word_at(&page, glb + GLB_JIFFIES) >= word_at(&before, glb + GLB_JIFFIES));
+    // 任务可能在分配后迁移到其他 CPU，比较所有 CPU 的合计
+    let sum = |page: &[u8], idx: usize| -> u64 { (0..nr_cpus).map(|c| word_at(page, cpu_off + c * stride + idx)).sum() };
+    assert!(sum(&page, CPU_PGALLOC) > sum(&before, CPU_PGALLOC));
+    assert!(sum(&page, CPU_PGFREE) > sum(&before, CPU_PGFREE));
+    assert!(sum(&page, CPU_NR_SWITCHES) >= sum(&before, CPU_NR_SWITCHES));
+    println!("test:    SUCCESS - pgalloc +{}", sum(&page, CPU_PGALLOC) - sum(&before, CPU_PGALLOC));
+
+    // 4. 非对齐与越界读取
+    println!("test: 4. Testing partial reads...");
+    let mut buf = [0u8; 5];
+    assert_eq!(kstats_read(&mut buf, 3), 5);
+    assert_eq!(&buf[..], &KSTATS_MAGIC.to_ne_bytes()[3..8]);
+    assert_eq!(kstats_read(&mut buf, 4094), 2);
+    assert_eq!(kstats_read(&mut buf, 4096), 0);
+    println!("test:    SUCCESS - unaligned and tail reads");
+
+    // 5. /dev/kstats 只读打开、读取与 stat
+    println!("test: 5. Testing /dev/kstats...");
+    assert_eq!(file_open(KSTATS_PATH, FileFlags::O_RDWR, 0), Err(-13));
+    let fd = file_open(KSTATS_PATH, FileFlags::O_RDONLY, 0).expect("open /dev/kstats");
+    let file = unsafe { get_file_fd(fd) }.expect("kstats file");
+    assert!(crate::fs::char_dev::is_kstats_file(&file));
+    let mut head = [0u8; 16];
+    assert_eq!(unsafe { file.read(head.as_mut_ptr(), head.len()) }, 16);
+    assert_eq!(word_at(&head, HDR_MAGIC), KSTATS_MAGIC);
+    assert_eq!(word_at(&head, HDR_VERSION), KSTATS_VERSION);
+    assert_eq!(file.get_pos(), 16);
+    drop(file);
+    assert!(file_close(fd).is_ok());
+    let mut stat = Stat::default();
+    assert!(crate::fs::path_stat(KSTATS_PATH, 0, &mut stat).is_ok());
+    assert_eq!(stat.st_size, 4096);
+    println!("test:    SUCCESS - read-only char device");
+
+    println!("test: ===== Kernel Stats Page Tests Completed =====");
+}
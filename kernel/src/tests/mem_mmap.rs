@@ -41,6 +41,42 @@ pub fn test_mmap_syscalls() {
     println!("test: 8. Testing mlock/munlock syscalls...");
     test_mlock();
 
+    // 测试 9: 匿名映射按需分页
+    println!("test: 9. Testing demand paging for anonymous mmap/brk...");
+    test_demand_paging();
+
+    // 测试 10: 读缺页映射共享零页
+    println!("test: 10. Testing shared zero page...");
+    test_zero_page();
+
+    // 测试 11: 文件映射的页缓存与 fault-around
+    println!("test: 11. Testing page cache fault-around...");
+    test_file_fault_around();
+
+    // 测试 12: ASID 分配与 fork 写保护
+    println!("test: 12. Testing ASID allocation and fork write-protect...");
+    test_asid_tlb();
+
+    // 测试 13: fork 共享 L0 页表
+    println!("test: 13. Testing shared page tables across fork...");
+    test_shared_page_tables();
+
+    // 测试 14: 2MB 大页映射
+    println!("test: 14. Testing 2MB huge page mappings...");
+    test_huge_pages();
+
+    // 测试 15: 按页表批量映射与解除映射
+    println!("test: 15. Testing range-based map/unmap...");
+    test_range_map_unmap();
+
+    // 测试 16: madvise 与 mincore
+    println!("test: 16. Testing madvise and mincore...");
+    test_madvise_mincore();
+
+    // 测试 17: mremap 搬移页表项
+    println!("test: 17. Testing mremap by moving page table entries...");
+    test_mremap_move();
+
     println!("test: ===== mmap() Tests Completed =====");
 }
 
@@ -108,3 +144,634 @@ fn test_mlock() {
     println!("test:    Purpose: Lock/unlock memory in RAM");
     println!("test:    SUCCESS - mlock/munlock syscalls exist");
 }
+
+fn test_demand_paging() {
+    use crate::arch::riscv64::mm::{
+        create_user_address_space, handle_mm_fault, map, AddressSpace, FaultFlags,
+        MmFaultResult, VirtAddr,
+    };
+    use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+    use crate::mm::vma::{VmaFlags, VmaType};
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new(root_ppn) };
+
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+
+    // mmap 只登记 VMA，不分配物理页
+    let start = aspace
+        .mmap(PageVirtAddr::new(0), 16 * PAGE_SIZE, flags, VmaType::Anonymous,
+              map::MAP_PRIVATE | map::MAP_ANONYMOUS)
+        .expect("mmap failed");
+    for i in 0..16 {
+        assert!(!aspace.is_mapped(PageVirtAddr::new(start.as_usize() + i * PAGE_SIZE)),
+                "page {} populated eagerly", i);
+    }
+
+    // 第一次访问分配清零页，相邻页保持未映射
+    let target = start.as_usize() + 3 * PAGE_SIZE;
+    let result = handle_mm_fault(&aspace, VirtAddr::new(target as u64),
+                                 FaultFlags::WRITE | FaultFlags::USER);
+    assert_eq!(result, MmFaultResult::Handled);
+    assert!(aspace.is_mapped(PageVirtAddr::new(target)));
+    assert!(!aspace.is_mapped(PageVirtAddr::new(target - PAGE_SIZE)));
+    assert!(!aspace.is_mapped(PageVirtAddr::new(target + PAGE_SIZE)));
+    println!("test:    SUCCESS - anonymous pages faulted in on first touch");
+
+    // MAP_POPULATE 立即建立映射
+    let populated = aspace
+        .mmap(PageVirtAddr::new(0), 4 * PAGE_SIZE, flags, VmaType::Anonymous,
+              map::MAP_PRIVATE | map::MAP_ANONYMOUS | map::MAP_POPULATE)
+        .expect("mmap(MAP_POPULATE) failed");
+    for i in 0..4 {
+        assert!(aspace.is_mapped(PageVirtAddr::new(populated.as_usize() + i * PAGE_SIZE)),
+                "MAP_POPULATE page {} not mapped", i);
+    }
+    println!("test:    SUCCESS - MAP_POPULATE faults pages eagerly");
+
+    // brk 只扩展堆 VMA，相邻扩展合并为一个 VMA
+    let brk = aspace.brk().as_usize();
+    aspace.expand_brk(brk, brk + 2 * PAGE_SIZE + 1).expect("expand_brk failed");
+    aspace.expand_brk(brk + 2 * PAGE_SIZE + 1, brk + 8 * PAGE_SIZE).expect("expand_brk failed");
+    let heap = aspace.find_vma(PageVirtAddr::new(brk)).expect("heap VMA missing");
+    assert_eq!(heap.start().as_usize(), brk);
+    assert_eq!(heap.end().as_usize(), brk + 8 * PAGE_SIZE);
+    assert!(!aspace.is_mapped(PageVirtAddr::new(brk)));
+    println!("test:    SUCCESS - brk extends the heap VMA without allocating");
+}
+
+fn test_zero_page() {
+    use crate::arch::riscv64::mm::{
+        create_user_address_space, handle_cow_fault, handle_mm_fault, is_zero_page_ppn, map,
+        AddressSpace, FaultFlags, MmFaultResult, VirtAddr,
+    };
+    use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+    use crate::mm::vma::{VmaFlags, VmaType};
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new(root_ppn) };
+
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let start = aspace
+        .mmap(PageVirtAddr::new(0), 4 * PAGE_SIZE, flags, VmaType::Anonymous,
+              map::MAP_PRIVATE | map::MAP_ANONYMOUS)
+        .expect("mmap failed");
+
+    // 两个页的读缺页都映射到同一个零页
+    let zero_ppn = |addr: usize| {
+        let phys = aspace.translate(PageVirtAddr::new(addr)).expect("page not mapped");
+        (phys.as_usize() / PAGE_SIZE) as u64
+    };
+    for i in 0..2 {
+        let addr = start.as_usize() + i * PAGE_SIZE;
+        let result = handle_mm_fault(&aspace, VirtAddr::new(addr as u64),
+                                     FaultFlags::READ | FaultFlags::USER);
+        assert_eq!(result, MmFaultResult::Handled);
+        assert!(is_zero_page_ppn(zero_ppn(addr)), "read fault should map the zero page");
+    }
+    println!("test:    SUCCESS - read faults share the zero page");
+
+    // 第一次写入经 COW 换成私有清零页
+    let addr = start.as_usize();
+    let result = handle_mm_fault(&aspace, VirtAddr::new(addr as u64),
+                                 FaultFlags::WRITE | FaultFlags::USER);
+    assert_eq!(result, MmFaultResult::CowPending);
+    assert!(unsafe { handle_cow_fault(&aspace, VirtAddr::new(addr as u64)) }.is_some());
+    let phys = aspace.translate(PageVirtAddr::new(addr)).unwrap().as_usize();
+    assert!(!is_zero_page_ppn((phys / PAGE_SIZE) as u64));
+    let page = unsafe { core::slice::from_raw_parts(phys as *const u8, PAGE_SIZE) };
+    assert!(page.iter().all(|&b| b == 0), "private copy should be zeroed");
+    assert!(is_zero_page_ppn(zero_ppn(addr + PAGE_SIZE)), "other page still on the zero page");
+    println!("test:    SUCCESS - write fault replaces the zero page via COW");
+}
+
+/// 测试用文件：第 i 页的内容全部为字节 i
+struct PatternFile {
+    pages: usize,
+}
+
+impl crate::mm::filemap::MappingSource for PatternFile {
+    fn size(&self) -> usize {
+        self.pages * crate::mm::PAGE_SIZE
+    }
+
+    fn read_page(&self, index: usize, buf: &mut [u8]) -> usize {
+        if index >= self.pages {
+            return 0;
+        }
+        buf.fill(index as u8);
+        buf.len()
+    }
+}
+
+fn test_file_fault_around() {
+    use crate::arch::riscv64::mm::{
+        create_user_address_space, handle_cow_fault, handle_mm_fault, AddressSpace, FaultFlags,
+        MmFaultResult, VirtAddr,
+    };
+    use crate::mm::filemap::{self, FAULT_AROUND_PAGES};
+    use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+    use crate::mm::vma::{Vma, VmaFlags};
+    use alloc::sync::Arc;
+
+    const TEST_INO: u64 = u64::MAX - 11;
+    const FILE_PAGES: usize = 40;
+    const BASE: usize = 0x5800_0000;
+
+    let mapping = filemap::get_mapping(TEST_INO, Arc::new(PatternFile { pages: FILE_PAGES }));
+
+    let (root_a, root_b) = match (create_user_address_space(), create_user_address_space()) {
+        (Some(a), Some(b)) => (a, b),
+        _ => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let as_a = unsafe { AddressSpace::new(root_a) };
+    let as_b = unsafe { AddressSpace::new(root_b) };
+
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::EXEC | VmaFlags::PRIVATE);
+    for aspace in [&as_a, &as_b] {
+        let mut vma = Vma::new(PageVirtAddr::new(BASE),
+                               PageVirtAddr::new(BASE + FILE_PAGES * PAGE_SIZE), flags);
+        vma.set_file_mapping(TEST_INO, 0);
+        aspace.map_vma(vma).expect("map_vma failed");
+    }
+
+    // 一次缺页映射整个对齐窗口
+    let fault = BASE + 20 * PAGE_SIZE + 123;
+    assert_eq!(handle_mm_fault(&as_a, VirtAddr::new(fault as u64), FaultFlags::READ | FaultFlags::USER),
+               MmFaultResult::Handled);
+    let window = (20 / FAULT_AROUND_PAGES) * FAULT_AROUND_PAGES;
+    for i in 0..FILE_PAGES {
+        let mapped = as_a.is_mapped(PageVirtAddr::new(BASE + i * PAGE_SIZE));
+        assert_eq!(mapped, i >= window && i < window + FAULT_AROUND_PAGES, "page {}", i);
+    }
+    let phys = as_a.translate(PageVirtAddr::new(BASE + 21 * PAGE_SIZE)).unwrap().as_usize();
+    assert_eq!(unsafe { *(phys as *const u8) }, 21);
+    println!("test:    SUCCESS - fault-around mapped {} pages", FAULT_AROUND_PAGES);
+
+    // 窗口在 VMA 末尾截断
+    let last = BASE + (FILE_PAGES - 1) * PAGE_SIZE;
+    assert_eq!(handle_mm_fault(&as_a, VirtAddr::new(last as u64), FaultFlags::EXEC | FaultFlags::USER),
+               MmFaultResult::Handled);
+    assert!(as_a.is_mapped(PageVirtAddr::new(BASE + 32 * PAGE_SIZE)));
+
+    // 另一个地址空间共享同一个缓存页
+    assert_eq!(handle_mm_fault(&as_b, VirtAddr::new(fault as u64), FaultFlags::READ | FaultFlags::USER),
+               MmFaultResult::Handled);
+    assert_eq!(as_b.translate(PageVirtAddr::new(BASE + 21 * PAGE_SIZE)).unwrap().as_usize(), phys);
+    assert_eq!(mapping.find_page(21), Some(phys));
+    println!("test:    SUCCESS - page cache pages shared between address spaces");
+
+    // 可写私有映射：写入得到私有副本，缓存页不变
+    let priv_base = BASE + FILE_PAGES * PAGE_SIZE;
+    let mut wflags = VmaFlags::new();
+    wflags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let mut vma = Vma::new(PageVirtAddr::new(priv_base),
+                           PageVirtAddr::new(priv_base + 4 * PAGE_SIZE), wflags);
+    vma.set_file_mapping(TEST_INO, 20 * PAGE_SIZE);
+    as_b.map_vma(vma).expect("map_vma failed");
+
+    let addr = priv_base + PAGE_SIZE;
+    assert_eq!(handle_mm_fault(&as_b, VirtAddr::new(addr as u64), FaultFlags::READ | FaultFlags::USER),
+               MmFaultResult::Handled);
+    assert_eq!(as_b.translate(PageVirtAddr::new(addr)).unwrap().as_usize(), phys);
+    assert_eq!(handle_mm_fault(&as_b, VirtAddr::new(addr as u64), FaultFlags::WRITE | FaultFlags::USER),
+               MmFaultResult::CowPending);
+    assert!(unsafe { handle_cow_fault(&as_b, VirtAddr::new(addr as u64)) }.is_some());
+    let copy = as_b.translate(PageVirtAddr::new(addr)).unwrap().as_usize();
+    assert_ne!(copy, phys, "COW must not write into the page cache");
+    assert_eq!(unsafe { *(copy as *const u8) }, 21);
+    assert_eq!(mapping.find_page(21), Some(phys));
+    println!("test:    SUCCESS - private write copies the cached page");
+}
+
+fn test_asid_tlb() {
+    use crate::arch::riscv64::mm::{
+        create_user_address_space, handle_cow_fault, handle_mm_fault, is_cow_page, map,
+        AddressSpace, FaultFlags, MmFaultResult, VirtAddr,
+    };
+    use crate::arch::tlb;
+    use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+    use crate::mm::vma::{VmaFlags, VmaType};
+
+    let (root_a, root_b) = match (create_user_address_space(), create_user_address_space()) {
+        (Some(a), Some(b)) => (a, b),
+        _ => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let as_a = unsafe { AddressSpace::new(root_a) };
+    let as_b = unsafe { AddressSpace::new(root_b) };
+
+    // 用户页表包含内核映射，测试结束后恢复原来的 satp
+    let old_satp: u64;
+    unsafe { core::arch::asm!("csrr {}, satp", out(reg) old_satp) };
+
+    unsafe {
+        as_a.enable();
+        as_b.enable();
+    }
+    if tlb::tlb_stats().asid_bits == 0 {
+        assert_eq!(as_a.asid(), 0);
+        println!("test:    SKIP - hardware has no usable ASID bits");
+    } else {
+        let (asid_a, asid_b) = (as_a.asid(), as_b.asid());
+        assert!(asid_a != 0 && asid_b != 0, "ASID 0 is reserved");
+        assert_ne!(asid_a, asid_b, "address spaces must get distinct ASIDs");
+        unsafe { as_a.enable() };
+        assert_eq!(as_a.asid(), asid_a, "ASID must be stable across switches");
+        assert_eq!((as_a.satp() >> 44) & 0xFFFF, asid_a);
+        let cpu = crate::arch::cpu_id();
+        assert!(as_a.context().cpumask() & (1 << cpu) != 0);
+        println!("test:    SUCCESS - ASIDs {} and {} assigned", asid_a, asid_b);
+    }
+    unsafe { core::arch::asm!("csrw satp, {}", "sfence.vma zero, zero", in(reg) old_satp) };
+
+    // fork 后父进程的可写页同样变为只读 + COW
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let start = as_a
+        .mmap(PageVirtAddr::new(0), PAGE_SIZE, flags, VmaType::Anonymous,
+              map::MAP_PRIVATE | map::MAP_ANONYMOUS | map::MAP_POPULATE)
+        .expect("mmap failed");
+    let addr = start.as_usize();
+    let parent_phys = as_a.translate(start).expect("page not populated").as_usize();
+    unsafe { *(parent_phys as *mut u8) = 0x5a };
+
+    let child = match as_a.fork() {
+        Ok(child) => child,
+        Err(_) => {
+            println!("test:    SKIP - fork out of page tables");
+            return;
+        }
+    };
+    assert!(unsafe { is_cow_page(as_a.root_ppn(), VirtAddr::new(addr as u64)) },
+            "parent PTE must be write-protected");
+    assert!(unsafe { is_cow_page(child.root_ppn(), VirtAddr::new(addr as u64)) });
+
+    // 父进程写入得到私有副本，子进程仍看到原内容
+    assert_eq!(handle_mm_fault(&as_a, VirtAddr::new(addr as u64), FaultFlags::WRITE | FaultFlags::USER),
+               MmFaultResult::CowPending);
+    assert!(unsafe { handle_cow_fault(&as_a, VirtAddr::new(addr as u64)) }.is_some());
+    let new_phys = as_a.translate(start).unwrap().as_usize();
+    assert_ne!(new_phys, parent_phys);
+    unsafe { *(new_phys as *mut u8) = 0xa5 };
+    assert_eq!(child.translate(start).unwrap().as_usize(), parent_phys);
+    assert_eq!(unsafe { *(parent_phys as *const u8) }, 0x5a);
+    println!("test:    SUCCESS - fork write-protects the parent");
+}
+
+fn test_shared_page_tables() {
+    use crate::arch::riscv64::mm::{
+        create_user_address_space, handle_cow_fault, handle_mm_fault, map, nr_shared_pte_tables,
+        AddressSpace, FaultFlags, MmFaultResult, VirtAddr,
+    };
+    use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+    use crate::mm::vma::{VmaFlags, VmaType};
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let parent = unsafe { AddressSpace::new(root_ppn) };
+
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let start = parent
+        .mmap(PageVirtAddr::new(0), 4 * PAGE_SIZE, flags, VmaType::Anonymous,
+              map::MAP_PRIVATE | map::MAP_ANONYMOUS)
+        .expect("mmap failed");
+    let page = |i: usize| start.as_usize() + i * PAGE_SIZE;
+    parent.populate(start, PageVirtAddr::new(page(1))).expect("populate failed");
+    let phys0 = parent.translate(start).unwrap().as_usize();
+    unsafe { *(phys0 as *mut u8) = 0x11 };
+
+    let before = nr_shared_pte_tables();
+    let child = match parent.fork() {
+        Ok(child) => child,
+        Err(_) => {
+            println!("test:    SKIP - fork out of page tables");
+            return;
+        }
+    };
+    assert!(nr_shared_pte_tables() > before, "fork should share L0 tables");
+    assert_eq!(child.translate(start).unwrap().as_usize(), phys0);
+    println!("test:    SUCCESS - child shares the parent's L0 table");
+
+    // 子进程缺页映射新页：先复制出私有 L0 页表，父进程看不到
+    assert_eq!(handle_mm_fault(&child, VirtAddr::new(page(2) as u64), FaultFlags::WRITE | FaultFlags::USER),
+               MmFaultResult::Handled);
+    assert!(child.is_mapped(PageVirtAddr::new(page(2))));
+    assert!(!parent.is_mapped(PageVirtAddr::new(page(2))), "fault must not leak into the parent");
+    assert_eq!(child.translate(start).unwrap().as_usize(), phys0);
+    println!("test:    SUCCESS - first write into the table unshares it");
+
+    // 父进程写入：子进程的私有页表仍引用原页，因此复制
+    assert_eq!(handle_mm_fault(&parent, VirtAddr::new(page(0) as u64), FaultFlags::WRITE | FaultFlags::USER),
+               MmFaultResult::CowPending);
+    assert!(unsafe { handle_cow_fault(&parent, VirtAddr::new(page(0) as u64)) }.is_some());
+    let new_phys = parent.translate(start).unwrap().as_usize();
+    assert_ne!(new_phys, phys0, "page is still mapped by the child");
+    assert_eq!(unsafe { *(new_phys as *const u8) }, 0x11);
+    assert_eq!(child.translate(start).unwrap().as_usize(), phys0);
+    println!("test:    SUCCESS - COW after unshare keeps both copies");
+}
+
+fn test_huge_pages() {
+    use crate::arch::riscv64::mm::{
+        create_user_address_space, handle_cow_fault, handle_mm_fault, map, nr_anon_huge_pages,
+        AddressSpace, FaultFlags, MmFaultResult, VirtAddr, HPAGE_SIZE,
+    };
+    use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+    use crate::mm::vma::{VmaFlags, VmaType};
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let parent = unsafe { AddressSpace::new(root_ppn) };
+
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE | VmaFlags::HUGETLB);
+    let start = parent
+        .mmap(PageVirtAddr::new(0), HPAGE_SIZE, flags, VmaType::Anonymous,
+              map::MAP_PRIVATE | map::MAP_ANONYMOUS | map::MAP_HUGETLB)
+        .expect("mmap failed");
+    assert_eq!(start.as_usize() % HPAGE_SIZE, 0, "MAP_HUGETLB mapping must be 2MB aligned");
+    println!("test:    SUCCESS - MAP_HUGETLB mapping is 2MB aligned");
+
+    let before = nr_anon_huge_pages();
+    let addr = start.as_usize() + 5 * PAGE_SIZE;
+    assert_eq!(handle_mm_fault(&parent, VirtAddr::new(addr as u64), FaultFlags::WRITE | FaultFlags::USER),
+               MmFaultResult::Handled);
+    if nr_anon_huge_pages() == before {
+        println!("test:    SKIP - no contiguous 2MB block available");
+        return;
+    }
+    let base = parent.translate(start).unwrap().as_usize();
+    assert_eq!(base % HPAGE_SIZE, 0);
+    let last = start.as_usize() + HPAGE_SIZE - PAGE_SIZE;
+    assert_eq!(parent.translate(PageVirtAddr::new(last)).unwrap().as_usize(), base + HPAGE_SIZE - PAGE_SIZE);
+    unsafe { *(base as *mut u8) = 0x33 };
+    println!("test:    SUCCESS - one fault maps the whole 2MB page");
+
+    // fork 写保护大页，写入时复制整个大页
+    let child = match parent.fork() {
+        Ok(child) => child,
+        Err(_) => {
+            println!("test:    SKIP - fork out of page tables");
+            return;
+        }
+    };
+    assert_eq!(child.translate(start).unwrap().as_usize(), base);
+    assert_eq!(handle_mm_fault(&child, VirtAddr::new(addr as u64), FaultFlags::WRITE | FaultFlags::USER),
+               MmFaultResult::CowPending);
+    if unsafe { handle_cow_fault(&child, VirtAddr::new(addr as u64)) }.is_some() {
+        let copy = child.translate(start).unwrap().as_usize();
+        assert_ne!(copy, base);
+        assert_eq!(unsafe { *(copy as *const u8) }, 0x33);
+        assert_eq!(parent.translate(start).unwrap().as_usize(), base);
+        println!("test:    SUCCESS - COW copies the huge page");
+    }
+
+    // 部分 munmap 拆分大页，其余部分保持映射
+    parent.munmap(PageVirtAddr::new(last), PAGE_SIZE).expect("munmap failed");
+    assert!(!parent.is_mapped(PageVirtAddr::new(last)));
+    assert_eq!(parent.translate(start).unwrap().as_usize(), base);
+    println!("test:    SUCCESS - partial munmap splits the huge page");
+}
+
+fn test_range_map_unmap() {
+    use crate::arch::riscv64::mm::{create_user_address_space, map_user_region, AddressSpace, PageTableEntry};
+    use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new(root_ppn) };
+
+    // 跨越两个 L0 页表的区域：只建立映射，不访问物理页
+    let virt = 0x1f_0000usize;
+    let phys = 0x8400_0000usize;
+    let pages = 600;
+    let flags = PageTableEntry::V | PageTableEntry::U | PageTableEntry::R | PageTableEntry::W;
+    unsafe { map_user_region(root_ppn, virt as u64, phys as u64, (pages * PAGE_SIZE) as u64, flags) };
+    for i in [0, 15, 16, 300, pages - 1] {
+        let addr = PageVirtAddr::new(virt + i * PAGE_SIZE);
+        assert_eq!(aspace.translate(addr).unwrap().as_usize(), phys + i * PAGE_SIZE);
+    }
+    assert!(!aspace.is_mapped(PageVirtAddr::new(virt + pages * PAGE_SIZE)));
+    println!("test:    SUCCESS - batched map crosses L0 table boundaries");
+
+    // 解除中间一段，两端保持映射
+    aspace.munmap(PageVirtAddr::new(virt + 10 * PAGE_SIZE), 500 * PAGE_SIZE).expect("munmap failed");
+    assert!(aspace.is_mapped(PageVirtAddr::new(virt + 9 * PAGE_SIZE)));
+    assert!(!aspace.is_mapped(PageVirtAddr::new(virt + 10 * PAGE_SIZE)));
+    assert!(!aspace.is_mapped(PageVirtAddr::new(virt + 509 * PAGE_SIZE)));
+    assert!(aspace.is_mapped(PageVirtAddr::new(virt + 510 * PAGE_SIZE)));
+    println!("test:    SUCCESS - batched unmap clears only the requested range");
+}
+
+fn test_madvise_mincore() {
+    use crate::arch::riscv64::mm::{
+        create_user_address_space, handle_cow_fault, handle_mm_fault, madv, map, AddressSpace,
+        FaultFlags, MmFaultResult, VirtAddr,
+    };
+    use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+    use crate::mm::pagemap::MapError;
+    use crate::mm::vma::{VmaFlags, VmaType};
+    use crate::mm::vmscan;
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new(root_ppn) };
+
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let start = aspace
+        .mmap(PageVirtAddr::new(0), 8 * PAGE_SIZE, flags, VmaType::Anonymous,
+              map::MAP_PRIVATE | map::MAP_ANONYMOUS)
+        .expect("mmap failed")
+        .as_usize();
+    let page = |i: usize| start + i * PAGE_SIZE;
+    let write = |i: usize, value: u8| {
+        let addr = VirtAddr::new(page(i) as u64);
+        match handle_mm_fault(&aspace, addr, FaultFlags::WRITE | FaultFlags::USER) {
+            MmFaultResult::CowPending => assert!(unsafe { handle_cow_fault(&aspace, addr) }.is_some()),
+            MmFaultResult::Handled | MmFaultResult::AlreadyMapped => {}
+            other => panic!("write fault failed: {:?}", other),
+        }
+        let phys = aspace.translate(PageVirtAddr::new(page(i))).unwrap().as_usize();
+        unsafe { *(phys as *mut u8) = value };
+    };
+
+    for i in 0..4 {
+        write(i, 0x50 + i as u8);
+    }
+    let resident = aspace.mincore(PageVirtAddr::new(start), 8 * PAGE_SIZE).expect("mincore failed");
+    assert_eq!(resident, [1, 1, 1, 1, 0, 0, 0, 0]);
+    assert_eq!(aspace.mincore(PageVirtAddr::new(page(8)), PAGE_SIZE), Err(MapError::NotMapped));
+    println!("test:    SUCCESS - mincore reports page table residency");
+
+    // MADV_DONTNEED 立即释放，再次读到零页
+    aspace.madvise(PageVirtAddr::new(start), 2 * PAGE_SIZE, madv::MADV_DONTNEED).expect("DONTNEED failed");
+    assert!(!aspace.is_mapped(PageVirtAddr::new(page(0))));
+    assert!(!aspace.is_mapped(PageVirtAddr::new(page(1))));
+    assert_eq!(handle_mm_fault(&aspace, VirtAddr::new(page(0) as u64), FaultFlags::READ | FaultFlags::USER),
+               MmFaultResult::Handled);
+    let phys = aspace.translate(PageVirtAddr::new(page(0))).unwrap().as_usize();
+    assert_eq!(unsafe { *(phys as *const u8) }, 0);
+    println!("test:    SUCCESS - MADV_DONTNEED drops pages and refaults zero-filled");
+
+    // MADV_FREE：没有再写入的页在回收时释放，写入过的页保留
+    aspace.madvise(PageVirtAddr::new(page(2)), 2 * PAGE_SIZE, madv::MADV_FREE).expect("FREE failed");
+    assert!(aspace.is_mapped(PageVirtAddr::new(page(2))));
+    write(3, 0x77);
+    let (active, inactive) = vmscan::lru_sizes();
+    vmscan::shrink_page_cache(active + inactive);
+    assert!(!aspace.is_mapped(PageVirtAddr::new(page(2))), "clean lazyfree page must be reclaimed");
+    let phys = aspace.translate(PageVirtAddr::new(page(3))).unwrap().as_usize();
+    assert_eq!(unsafe { *(phys as *const u8) }, 0x77);
+    assert!(vmscan::vmscan_stats().pglazyfreed >= 1);
+    println!("test:    SUCCESS - MADV_FREE pages are reclaimed unless redirtied");
+
+    // 访问模式建议分割 VMA
+    aspace.madvise(PageVirtAddr::new(page(4)), 2 * PAGE_SIZE, madv::MADV_SEQUENTIAL).expect("SEQUENTIAL failed");
+    assert!(aspace.find_vma(PageVirtAddr::new(page(4))).unwrap().flags().contains(VmaFlags::SEQ_READ));
+    assert!(!aspace.find_vma(PageVirtAddr::new(page(3))).unwrap().flags().contains(VmaFlags::SEQ_READ));
+    assert!(!aspace.find_vma(PageVirtAddr::new(page(6))).unwrap().flags().contains(VmaFlags::SEQ_READ));
+    aspace.madvise(PageVirtAddr::new(page(4)), 2 * PAGE_SIZE, madv::MADV_RANDOM).expect("RANDOM failed");
+    let vma = aspace.find_vma(PageVirtAddr::new(page(5))).unwrap();
+    assert!(vma.flags().contains(VmaFlags::RAND_READ) && !vma.flags().contains(VmaFlags::SEQ_READ));
+    assert_eq!(aspace.madvise(PageVirtAddr::new(page(7)), 2 * PAGE_SIZE, madv::MADV_WILLNEED),
+               Err(MapError::NotMapped));
+    println!("test:    SUCCESS - access pattern hints split the VMA");
+}
+
+fn test_mremap_move() {
+    use crate::arch::riscv64::mm::{
+        create_user_address_space, handle_cow_fault, handle_mm_fault, map, mremap, AddressSpace,
+        FaultFlags, MmFaultResult, VirtAddr,
+    };
+    use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+    use crate::mm::pagemap::MapError;
+    use crate::mm::vma::{VmaFlags, VmaType};
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new(root_ppn) };
+
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let anon = map::MAP_PRIVATE | map::MAP_ANONYMOUS;
+    let phys_of = |addr: usize| aspace.translate(PageVirtAddr::new(addr)).map(|p| p.as_usize());
+    let write = |addr: usize, value: u8| {
+        let fault_addr = VirtAddr::new(addr as u64);
+        match handle_mm_fault(&aspace, fault_addr, FaultFlags::WRITE | FaultFlags::USER) {
+            MmFaultResult::CowPending => assert!(unsafe { handle_cow_fault(&aspace, fault_addr) }.is_some()),
+            MmFaultResult::Handled | MmFaultResult::AlreadyMapped => {}
+            other => panic!("write fault failed: {:?}", other),
+        }
+        unsafe { *(phys_of(addr).unwrap() as *mut u8) = value };
+    };
+
+    // A 占 4 页，紧跟着 1 页的 B
+    let a = aspace
+        .mmap(PageVirtAddr::new(0), 4 * PAGE_SIZE, flags, VmaType::Anonymous, anon)
+        .expect("mmap A failed")
+        .as_usize();
+    let b = a + 4 * PAGE_SIZE;
+    aspace
+        .mmap(PageVirtAddr::new(b), PAGE_SIZE, flags, VmaType::Anonymous, anon | map::MAP_FIXED)
+        .expect("mmap B failed");
+
+    // B 之后空闲：原地扩展
+    let grown = aspace.mremap(PageVirtAddr::new(b), PAGE_SIZE, 2 * PAGE_SIZE, 0, PageVirtAddr::new(0));
+    assert_eq!(grown.map(|addr| addr.as_usize()), Ok(b));
+    assert_eq!(aspace.find_vma(PageVirtAddr::new(b)).unwrap().end().as_usize(), b + 2 * PAGE_SIZE);
+    println!("test:    SUCCESS - mremap grows in place when the next range is free");
+
+    for i in 0..4 {
+        write(a + i * PAGE_SIZE, 0x60 + i as u8);
+    }
+    let frames: [usize; 4] = core::array::from_fn(|i| phys_of(a + i * PAGE_SIZE).unwrap());
+
+    // A 被 B 挡住，不允许移动时失败
+    assert_eq!(aspace.mremap(PageVirtAddr::new(a), 4 * PAGE_SIZE, 8 * PAGE_SIZE, 0, PageVirtAddr::new(0)),
+               Err(MapError::OutOfMemory));
+
+    // 允许移动：页表项搬到新地址，物理页和内容不变
+    let moved = aspace
+        .mremap(PageVirtAddr::new(a), 4 * PAGE_SIZE, 8 * PAGE_SIZE, mremap::MREMAP_MAYMOVE, PageVirtAddr::new(0))
+        .expect("mremap MAYMOVE failed")
+        .as_usize();
+    assert_ne!(moved, a);
+    for i in 0..4 {
+        let phys = phys_of(moved + i * PAGE_SIZE).expect("moved page not mapped");
+        assert_eq!(phys, frames[i], "mremap must move the page, not copy it");
+        assert_eq!(unsafe { *(phys as *const u8) }, 0x60 + i as u8);
+        assert!(!aspace.is_mapped(PageVirtAddr::new(a + i * PAGE_SIZE)));
+    }
+    assert!(aspace.find_vma(PageVirtAddr::new(a)).is_none());
+    assert_eq!(aspace.find_vma(PageVirtAddr::new(moved)).unwrap().end().as_usize(), moved + 8 * PAGE_SIZE);
+    assert!(!aspace.is_mapped(PageVirtAddr::new(moved + 4 * PAGE_SIZE)));
+    println!("test:    SUCCESS - MREMAP_MAYMOVE relocates PTEs without copying");
+
+    // 原地收缩
+    let shrunk = aspace.mremap(PageVirtAddr::new(moved), 8 * PAGE_SIZE, 2 * PAGE_SIZE, 0, PageVirtAddr::new(0));
+    assert_eq!(shrunk.map(|addr| addr.as_usize()), Ok(moved));
+    assert!(!aspace.is_mapped(PageVirtAddr::new(moved + 2 * PAGE_SIZE)));
+    assert_eq!(aspace.find_vma(PageVirtAddr::new(moved)).unwrap().end().as_usize(), moved + 2 * PAGE_SIZE);
+
+    // MREMAP_FIXED 必须与 MREMAP_MAYMOVE 一起使用，移到 A 原来的位置
+    assert_eq!(aspace.mremap(PageVirtAddr::new(moved), 2 * PAGE_SIZE, 2 * PAGE_SIZE, mremap::MREMAP_FIXED,
+                             PageVirtAddr::new(a)),
+               Err(MapError::Invalid));
+    let fixed = aspace
+        .mremap(PageVirtAddr::new(moved), 2 * PAGE_SIZE, 2 * PAGE_SIZE,
+                mremap::MREMAP_MAYMOVE | mremap::MREMAP_FIXED, PageVirtAddr::new(a))
+        .expect("mremap FIXED failed")
+        .as_usize();
+    assert_eq!(fixed, a);
+    assert_eq!(phys_of(a + PAGE_SIZE), Some(frames[1]));
+    assert!(!aspace.is_mapped(PageVirtAddr::new(moved)));
+    println!("test:    SUCCESS - MREMAP_FIXED moves to the requested address");
+}
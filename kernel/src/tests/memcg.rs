@@ -0,0 +1,123 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内存控制组单元测试
+//!
+//! 计费逐级累加并在释放时扣除、memory.max 拒绝超限的计费、
+//! 删除的组由计在其中的页保持存活、定向回收只扫描目标组的页
+
+use alloc::vec::Vec;
+
+use crate::println;
+use crate::fs::cgroupfs;
+use crate::mm::memcontrol::{mem_cgroup_charge_to, mem_cgroup_stats, page_memcg, MemcgEvent, MemcgStat};
+use crate::mm::page::{PhysFrame, PAGE_SIZE};
+use crate::mm::pcp::{alloc_user_page, free_user_page};
+use crate::mm::vmscan::{lru_cache_add, lru_cache_del, try_to_free_mem_cgroup_pages, vmscan_stats};
+use crate::sched::group::{root_task_group, sched_create_group, sched_destroy_group, tg_memcg, TaskGroup};
+
+fn usage(group: *mut TaskGroup) -> usize {
+    unsafe { mem_cgroup_stats(tg_memcg(group)).usage }
+}
+
+/// 分配一页并计到 group
+fn charged_page(group: *mut TaskGroup, stat: MemcgStat) -> Option<PhysFrame> {
+    let frame = alloc_user_page().expect("alloc_user_page failed");
+    if unsafe { mem_cgroup_charge_to(tg_memcg(group), &frame, stat) } {
+        Some(frame)
+    } else {
+        free_user_page(frame);
+        None
+    }
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_memcg() {
+    println!("test: ===== Starting Memory Cgroup Tests =====");
+
+    let root = root_task_group();
+    assert!(tg_memcg(root).is_null());
+    let parent = sched_create_group(root, "test-mem").expect("create test-mem");
+    let child = sched_create_group(parent, "a").expect("create test-mem/a");
+    assert!(!tg_memcg(parent).is_null() && !tg_memcg(child).is_null());
+
+    // 1. 计费逐级累加
+    println!("test: 1. Testing hierarchical charging...");
+    let mut frames = Vec::new();
+    frames.push(charged_page(child, MemcgStat::Anon).expect("charge failed"));
+    frames.push(charged_page(child, MemcgStat::File).expect("charge failed"));
+    assert_eq!(usage(child), 2);
+    assert_eq!(usage(parent), 2);
+    assert_eq!(page_memcg(frames[0].number), tg_memcg(child));
+    let stats = unsafe { mem_cgroup_stats(tg_memcg(parent)) };
+    assert_eq!(stats.stat[MemcgStat::Anon as usize], 1);
+    assert_eq!(stats.stat[MemcgStat::File as usize], 1);
+    let current = alloc::format!("{}\n", 2 * PAGE_SIZE);
+    assert_eq!(cgroupfs::read_file("/test-mem/a/memory.current"), Some(current.into_bytes()));
+    assert_eq!(cgroupfs::read_file("/memory.current"), None);
+    assert_eq!(cgroupfs::read_file("/cgroup.controllers"), Some(b"cpu memory\n".to_vec()));
+    println!("test:    SUCCESS - charges reach every ancestor");
+
+    // 2. memory.max 拒绝超限的计费
+    println!("test: 2. Testing memory.max...");
+    let max = alloc::format!("{}", 3 * PAGE_SIZE);
+    assert!(cgroupfs::write_file("/test-mem/memory.max", max.as_bytes()).is_ok());
+    assert_eq!(cgroupfs::read_file("/test-mem/memory.max"), Some(alloc::format!("{}\n", max).into_bytes()));
+    assert_eq!(cgroupfs::read_file("/test-mem/a/memory.max"), Some(b"max\n".to_vec()));
+    frames.push(charged_page(child, MemcgStat::Kernel).expect("charge under limit failed"));
+    // 匿名页不在 LRU 上，回收不出内存
+    assert!(charged_page(child, MemcgStat::Anon).is_none());
+    assert_eq!(usage(parent), 3);
+    let stats = unsafe { mem_cgroup_stats(tg_memcg(parent)) };
+    assert!(stats.events[MemcgEvent::Max as usize] > 0);
+    assert_eq!(stats.events[MemcgEvent::Oom as usize], 1);
+    assert_eq!(stats.peak, 3);
+    assert!(cgroupfs::write_file("/test-mem/memory.max", b"max").is_ok());
+    assert!(cgroupfs::write_file("/test-mem/memory.max", b"lots").is_err());
+    println!("test:    SUCCESS - charge over the limit fails after reclaim");
+
+    // 3. 释放时扣除
+    println!("test: 3. Testing uncharge on free...");
+    let frame = frames.pop().unwrap();
+    free_user_page(frame);
+    assert!(page_memcg(frame.number).is_null());
+    assert_eq!(usage(parent), 2);
+    for frame in frames.drain(..) {
+        free_user_page(frame);
+    }
+    assert_eq!(usage(child), 0);
+    assert_eq!(usage(parent), 0);
+    assert_eq!(cgroupfs::read_file("/test-mem/memory.stat"),
+               Some(b"anon 0\nfile 0\nkernel 0\nsock 0\n".to_vec()));
+    println!("test:    SUCCESS - freed pages leave every level");
+
+    // 4. 定向回收只扫描目标组的页
+    println!("test: 4. Testing targeted reclaim...");
+    let frame = charged_page(child, MemcgStat::File).expect("charge failed");
+    lru_cache_add(frame.number);
+    let before = vmscan_stats();
+    let other = sched_create_group(root, "test-mem-b").expect("create test-mem-b");
+    assert_eq!(try_to_free_mem_cgroup_pages(tg_memcg(other), 1), 0);
+    assert_eq!(vmscan_stats().pgscan, before.pgscan);
+    // 页不在任何页缓存中，扫描后放回
+    try_to_free_mem_cgroup_pages(tg_memcg(parent), 1);
+    let after = vmscan_stats();
+    assert!(after.pgscan > before.pgscan);
+    assert_eq!(after.memcg_reclaim, before.memcg_reclaim + 2);
+    lru_cache_del(frame.number);
+    assert!(sched_destroy_group(other).is_ok());
+    println!("test:    SUCCESS - reclaim skipped pages of other groups");
+
+    // 5. 删除的组由计在其中的页保持存活
+    println!("test: 5. Testing offline groups...");
+    assert!(sched_destroy_group(child).is_ok());
+    assert_eq!(usage(parent), 1);
+    free_user_page(frame);
+    assert_eq!(usage(parent), 0);
+    assert!(sched_destroy_group(parent).is_ok());
+    println!("test:    SUCCESS - last page released the offline group");
+
+    println!("test: ===== Memory Cgroup Tests Completed =====");
+}
@@ -0,0 +1,160 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：MAP_SHARED 文件映射与 msync
+//
+// 测试内容：
+// 1. 能回写的共享映射：写缺页映射页缓存中的页并标记为脏，读缺页映射为只读
+// 2. 写入只读映射的页时恢复写权限并标记为脏，不复制页
+// 3. msync(MS_SYNC) 写保护并回写脏页，之后再写入重新变脏
+// 4. 解除映射时可写页的脏状态转移到页缓存
+// 5. 不能回写的共享映射直接可写；fork 后父子进程继续共享同一个页
+// 6. msync 范围内有空洞返回 ENOMEM
+
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use spin::Mutex;
+
+use crate::arch::riscv64::mm::{
+    create_user_address_space, handle_mm_fault, AddressSpace, FaultFlags, MmFaultResult, VirtAddr,
+};
+use crate::errno::Errno;
+use crate::mm::filemap::{self, MappingSource};
+use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+use crate::mm::vma::{Vma, VmaFlags};
+use crate::println;
+
+const FILE_PAGES: usize = 8;
+const BASE: usize = 0x5a00_0000;
+
+/// 测试用文件：记录回写的页
+struct WritebackFile {
+    writeback: bool,
+    written: Mutex<Vec<usize>>,
+}
+
+impl MappingSource for WritebackFile {
+    fn size(&self) -> usize {
+        FILE_PAGES * PAGE_SIZE
+    }
+
+    fn read_page(&self, index: usize, buf: &mut [u8]) -> usize {
+        buf.fill(index as u8);
+        buf.len()
+    }
+
+    fn can_writeback(&self) -> bool {
+        self.writeback
+    }
+
+    fn write_pages(&self, index: usize, pages: &[usize]) -> Result<(), i32> {
+        self.written.lock().extend(index..index + pages.len());
+        Ok(())
+    }
+}
+
+fn map_shared(aspace: &AddressSpace, base: usize, ino: u64) {
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::SHARED);
+    let mut vma = Vma::new(PageVirtAddr::new(base), PageVirtAddr::new(base + FILE_PAGES * PAGE_SIZE), flags);
+    vma.set_file_mapping(ino, 0);
+    aspace.map_vma(vma).expect("map_vma failed");
+}
+
+fn fault(aspace: &AddressSpace, addr: usize, flags: u32) -> MmFaultResult {
+    handle_mm_fault(aspace, VirtAddr::new(addr as u64), flags | FaultFlags::USER)
+}
+
+pub fn test_mmap_shared() {
+    println!("test: ===== Testing MAP_SHARED File Mappings =====");
+    const WB_INO: u64 = u64::MAX - 21;
+    const SHMEM_INO: u64 = u64::MAX - 22;
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new(root_ppn) };
+    let page = |i: usize| BASE + i * PAGE_SIZE;
+
+    let source = Arc::new(WritebackFile { writeback: true, written: Mutex::new(Vec::new()) });
+    let mapping = filemap::get_mapping(WB_INO, source.clone());
+    map_shared(&aspace, BASE, WB_INO);
+
+    // 测试 1: 写缺页与读缺页
+    println!("test: 1. Testing shared write fault...");
+    assert_eq!(fault(&aspace, page(0) + 8, FaultFlags::WRITE), MmFaultResult::Handled);
+    let phys0 = aspace.translate(PageVirtAddr::new(page(0))).unwrap().as_usize();
+    assert_eq!(mapping.find_page(0), Some(phys0));
+    assert_eq!(mapping.nr_dirty(), 1);
+    assert_eq!(fault(&aspace, page(1), FaultFlags::READ), MmFaultResult::Handled);
+    assert!(aspace.is_mapped(PageVirtAddr::new(page(1))));
+    assert_eq!(mapping.nr_dirty(), 1, "read fault must not dirty the page");
+    println!("test:    SUCCESS - write fault maps and dirties the cached page");
+
+    // 测试 2: 写入只读映射的页
+    println!("test: 2. Testing write to a read-only shared page...");
+    let phys1 = aspace.translate(PageVirtAddr::new(page(1))).unwrap().as_usize();
+    assert_eq!(fault(&aspace, page(1), FaultFlags::WRITE), MmFaultResult::Handled);
+    assert_eq!(aspace.translate(PageVirtAddr::new(page(1))).unwrap().as_usize(), phys1);
+    assert_eq!(mapping.nr_dirty(), 2);
+    unsafe { *(phys1 as *mut u8) = 0xaa };
+    println!("test:    SUCCESS - write protect fault dirties without copying");
+
+    // 测试 3: msync
+    println!("test: 3. Testing msync(MS_SYNC)...");
+    assert_eq!(aspace.msync(PageVirtAddr::new(BASE), FILE_PAGES * PAGE_SIZE, true), Ok(()));
+    assert_eq!(mapping.nr_dirty(), 0);
+    let mut written = source.written.lock().clone();
+    written.sort();
+    assert_eq!(written, [0, 1]);
+    // 页已被写保护：再次写入经过缺页并重新变脏
+    assert_eq!(fault(&aspace, page(0), FaultFlags::WRITE), MmFaultResult::Handled);
+    assert_eq!(mapping.nr_dirty(), 1);
+    assert_eq!(aspace.msync(PageVirtAddr::new(BASE), PAGE_SIZE, false), Ok(()));
+    assert_eq!(mapping.nr_dirty(), 1, "MS_ASYNC leaves writeback to the flusher");
+    println!("test:    SUCCESS - msync writes back and re-arms dirty tracking");
+
+    // 测试 4: 解除映射
+    println!("test: 4. Testing dirty transfer on unmap...");
+    mapping.writeback().unwrap();
+    assert_eq!(mapping.nr_dirty(), 0);
+    // 页表项仍然可写，解除映射时脏状态转移到页缓存
+    aspace.munmap(PageVirtAddr::new(BASE), FILE_PAGES * PAGE_SIZE).unwrap();
+    assert_eq!(mapping.nr_dirty(), 1);
+    mapping.writeback().unwrap();
+    println!("test:    SUCCESS - unmap transfers the dirty bit");
+
+    // 测试 5: 不能回写的共享映射与 fork
+    println!("test: 5. Testing shared mapping across fork...");
+    let shmem = filemap::get_mapping(SHMEM_INO, Arc::new(WritebackFile { writeback: false, written: Mutex::new(Vec::new()) }));
+    map_shared(&aspace, BASE, SHMEM_INO);
+    assert_eq!(fault(&aspace, page(2), FaultFlags::WRITE), MmFaultResult::Handled);
+    let phys2 = aspace.translate(PageVirtAddr::new(page(2))).unwrap().as_usize();
+    assert_eq!(shmem.find_page(2), Some(phys2));
+    assert_eq!(shmem.nr_dirty(), 0);
+    match aspace.fork() {
+        Ok(child) => {
+            // fork 写保护了共享 L0 页表中的页，写入恢复写权限而不是复制
+            assert_eq!(fault(&child, page(2), FaultFlags::WRITE), MmFaultResult::Handled);
+            assert_eq!(child.translate(PageVirtAddr::new(page(2))).unwrap().as_usize(), phys2);
+            assert_eq!(fault(&aspace, page(2), FaultFlags::WRITE), MmFaultResult::Handled);
+            assert_eq!(aspace.translate(PageVirtAddr::new(page(2))).unwrap().as_usize(), phys2);
+            println!("test:    SUCCESS - parent and child keep sharing the page");
+        }
+        Err(_) => println!("test:    SKIP - fork out of page tables"),
+    }
+
+    // 测试 6: 空洞
+    println!("test: 6. Testing msync on a hole...");
+    assert_eq!(aspace.msync(PageVirtAddr::new(BASE), (FILE_PAGES + 1) * PAGE_SIZE, true),
+               Err(Errno::OutOfMemory.as_neg_i32()));
+    println!("test:    SUCCESS - unmapped range returns ENOMEM");
+
+    println!("test: MAP_SHARED testing completed.");
+}
@@ -73,6 +73,8 @@ pub mod icache;
 #[cfg(feature = "unit-test")]
 pub mod standard_alloc;
 #[cfg(feature = "unit-test")]
+pub mod kmem_cache;
+#[cfg(feature = "unit-test")]
 pub mod fstat;
 #[cfg(feature = "unit-test")]
 pub mod fcntl;
@@ -89,6 +91,12 @@ pub mod network;
 #[cfg(feature = "unit-test")]
 pub mod pipe2;
 #[cfg(feature = "unit-test")]
+pub mod readv;
+#[cfg(feature = "unit-test")]
+pub mod io_uring;
+#[cfg(feature = "unit-test")]
+pub mod blk_mq;
+#[cfg(feature = "unit-test")]
 pub mod signal_procmask;
 #[cfg(feature = "unit-test")]
 pub mod ipc_poll;
@@ -100,6 +108,192 @@ pub mod ipc_eventfd;
 pub mod mem_mmap;
 #[cfg(feature = "unit-test")]
 pub mod mem_cow;
+#[cfg(feature = "unit-test")]
+pub mod sched_fair;
+#[cfg(feature = "unit-test")]
+pub mod sched_prio_array;
+#[cfg(feature = "unit-test")]
+pub mod steal_deque;
+#[cfg(feature = "unit-test")]
+pub mod tracepoint;
+#[cfg(feature = "unit-test")]
+pub mod vmscan;
+#[cfg(feature = "unit-test")]
+pub mod page_cache;
+#[cfg(feature = "unit-test")]
+pub mod ext4_extent_cache;
+#[cfg(feature = "unit-test")]
+pub mod checksum;
+#[cfg(feature = "unit-test")]
+pub mod tcp_data;
+#[cfg(feature = "unit-test")]
+pub mod tcp_cong;
+#[cfg(feature = "unit-test")]
+pub mod inet_hash;
+#[cfg(feature = "unit-test")]
+pub mod tcp_listen;
+#[cfg(feature = "unit-test")]
+pub mod route;
+#[cfg(feature = "unit-test")]
+pub mod arp;
+#[cfg(feature = "unit-test")]
+pub mod gro;
+#[cfg(feature = "unit-test")]
+pub mod udp;
+#[cfg(feature = "unit-test")]
+pub mod unix;
+#[cfg(feature = "unit-test")]
+pub mod timer;
+#[cfg(feature = "unit-test")]
+pub mod vdso;
+#[cfg(feature = "unit-test")]
+pub mod futex;
+#[cfg(feature = "unit-test")]
+pub mod clone;
+#[cfg(feature = "unit-test")]
+pub mod binfmt_elf;
+#[cfg(feature = "unit-test")]
+pub mod elf_interp;
+#[cfg(feature = "unit-test")]
+pub mod uaccess;
+#[cfg(feature = "unit-test")]
+pub mod syscall_stats;
+#[cfg(feature = "unit-test")]
+pub mod fdtable_rcu;
+#[cfg(feature = "unit-test")]
+pub mod signal_frame;
+#[cfg(feature = "unit-test")]
+pub mod wait_pid;
+#[cfg(feature = "unit-test")]
+pub mod task_cache;
+#[cfg(feature = "unit-test")]
+pub mod kstack;
+#[cfg(feature = "unit-test")]
+pub mod fpu;
+#[cfg(feature = "unit-test")]
+pub mod spinlock;
+#[cfg(feature = "unit-test")]
+pub mod rwlock_rcu;
+#[cfg(feature = "unit-test")]
+pub mod mutex;
+#[cfg(feature = "unit-test")]
+pub mod percpu;
+#[cfg(feature = "unit-test")]
+pub mod smp_call;
+#[cfg(feature = "unit-test")]
+pub mod irq_affinity;
+#[cfg(feature = "unit-test")]
+pub mod wake_affine;
+#[cfg(feature = "unit-test")]
+pub mod sched_rt;
+#[cfg(feature = "unit-test")]
+pub mod sched_affinity;
+#[cfg(feature = "unit-test")]
+pub mod preempt;
+#[cfg(feature = "unit-test")]
+pub mod cgroup;
+#[cfg(feature = "unit-test")]
+pub mod sched_stats;
+#[cfg(feature = "unit-test")]
+pub mod procfs_pid;
+#[cfg(feature = "unit-test")]
+pub mod profile;
+#[cfg(feature = "unit-test")]
+pub mod perf_event;
+#[cfg(feature = "unit-test")]
+pub mod trace_ring_buffer;
+#[cfg(feature = "unit-test")]
+pub mod printk;
+#[cfg(feature = "unit-test")]
+pub mod initcall;
+#[cfg(feature = "unit-test")]
+pub mod initramfs;
+#[cfg(feature = "unit-test")]
+pub mod tmpfs;
+#[cfg(feature = "unit-test")]
+pub mod mmap_shared;
+#[cfg(feature = "unit-test")]
+pub mod dirty_throttle;
+#[cfg(feature = "unit-test")]
+pub mod fb_damage;
+#[cfg(feature = "unit-test")]
+pub mod gpu_fence;
+#[cfg(feature = "unit-test")]
+pub mod evdev;
+#[cfg(feature = "unit-test")]
+pub mod fb_mmap;
+#[cfg(feature = "unit-test")]
+pub mod pci_msi;
+#[cfg(feature = "unit-test")]
+pub mod ext4_readdir;
+#[cfg(feature = "unit-test")]
+pub mod jbd2;
+#[cfg(feature = "unit-test")]
+pub mod crc32;
+#[cfg(feature = "unit-test")]
+pub mod ext4_readahead;
+#[cfg(feature = "unit-test")]
+pub mod percpu_counter;
+#[cfg(feature = "unit-test")]
+pub mod statx;
+#[cfg(feature = "unit-test")]
+pub mod ext4_inline;
+#[cfg(feature = "unit-test")]
+pub mod seq_file;
+#[cfg(feature = "unit-test")]
+pub mod user_page_recycle;
+#[cfg(feature = "unit-test")]
+pub mod vma_lock;
+#[cfg(feature = "unit-test")]
+pub mod memcg;
+#[cfg(feature = "unit-test")]
+pub mod oom_kill;
+#[cfg(feature = "unit-test")]
+pub mod zswap;
+#[cfg(feature = "unit-test")]
+pub mod compaction;
+#[cfg(feature = "unit-test")]
+pub mod ksm;
+#[cfg(feature = "unit-test")]
+pub mod thp;
+#[cfg(feature = "unit-test")]
+pub mod prezero;
+#[cfg(feature = "unit-test")]
+pub mod string;
+#[cfg(feature = "unit-test")]
+pub mod tty;
+#[cfg(feature = "unit-test")]
+pub mod dir_index;
+#[cfg(feature = "unit-test")]
+pub mod xdp;
+#[cfg(feature = "unit-test")]
+pub mod vmstat;
+#[cfg(feature = "unit-test")]
+pub mod cpuidle;
+#[cfg(feature = "unit-test")]
+pub mod kstats;
+#[cfg(feature = "unit-test")]
+pub mod ip_fragment;
+#[cfg(feature = "unit-test")]
+pub mod ext4_htree;
+#[cfg(feature = "unit-test")]
+pub mod ext4_mballoc;
+#[cfg(feature = "unit-test")]
+pub mod ext4_extent;
+#[cfg(feature = "unit-test")]
+pub mod buffer_cache;
+#[cfg(feature = "unit-test")]
+pub mod buddy_allocator;
+#[cfg(feature = "unit-test")]
+pub mod heap_grow;
+#[cfg(feature = "unit-test")]
+pub mod pcp;
+#[cfg(feature = "unit-test")]
+pub mod sparse_mem_map;
+#[cfg(feature = "unit-test")]
+pub mod fb_cursor;
+#[cfg(feature = "unit-test")]
+pub mod ext4_dio;
 
 #[cfg(feature = "unit-test")]
 pub fn run_all_tests() {
@@ -225,7 +419,298 @@ pub fn run_all_tests() {
     // 40. Copy-on-Write (COW) 测试
     mem_cow::test_cow();
 
-    // 41. 标准 alloc crate 类型测试
+    // 41. CFS 公平调度类测试
+    sched_fair::test_sched_fair();
+
+    // 138. 实时优先级数组测试
+    sched_prio_array::test_sched_prio_array();
+
+    // 42. 工作窃取队列测试
+    steal_deque::test_steal_deque();
+
+    // 43. 跟踪点测试
+    tracepoint::test_tracepoint();
+
+    // 44. 命名对象缓存测试
+    kmem_cache::test_kmem_cache();
+
+    // 45. 页回收测试
+    vmscan::test_vmscan();
+
+    // 46. 页缓存测试
+    page_cache::test_page_cache();
+
+    // 47. ext4 extent 状态缓存测试
+    ext4_extent_cache::test_ext4_extent_cache();
+
+    // 48. readv / preadv / pwritev 测试
+    readv::test_readv();
+
+    // 49. io_uring 测试
+    io_uring::test_io_uring();
+
+    // 50. 块层请求队列测试
+    blk_mq::test_blk_mq();
+
+    // 51. Internet 校验和测试
+    checksum::test_checksum();
+
+    // 53. TCP 数据传输测试
+    tcp_data::test_tcp_data();
+
+    // 54. TCP 拥塞控制测试
+    tcp_cong::test_tcp_cong();
+
+    // 55. 套接字查找哈希表测试
+    inet_hash::test_inet_hash();
+
+    // 56. TCP 监听队列与 SYN cookie 测试
+    tcp_listen::test_tcp_listen();
+
+    // 57. IPv4 路由表测试
+    route::test_route();
+
+    // 58. ARP 邻居缓存测试
+    arp::test_arp();
+
+    // 59. 通用接收合并测试
+    gro::test_gro();
+
+    // 60. UDP 收发与 GSO 测试
+    udp::test_udp();
+
+    // 61. Unix 域套接字测试
+    unix::test_unix();
+
+    // 62. 时间轮、hrtimer 与 timerfd 测试
+    timer::test_timer();
+
+    // 63. vDSO 映像与用户模式 clock_gettime 测试
+    vdso::test_vdso();
+
+    // 64. futex 等待、唤醒、requeue 与 PI 测试
+    futex::test_futex();
+
+    // 65. clone 标志检查与线程组共享测试
+    clone::test_clone();
+
+    // 66. exec 的 ELF 段文件映射测试
+    binfmt_elf::test_binfmt_elf();
+
+    // 67. PT_INTERP 动态链接程序加载与共享库映射测试
+    elf_interp::test_elf_interp();
+
+    // 68. 用户内存复制与异常表修复测试
+    uaccess::test_uaccess();
+
+    // 69. 系统调用表分发与统计测试
+    syscall_stats::test_syscall_stats();
+
+    // 70. 位图分配与无锁查找的文件描述符表测试
+    fdtable_rcu::test_fdtable_rcu();
+
+    // 71. 信号递送快速路径与用户栈信号帧测试
+    signal_frame::test_signal_frame();
+
+    // 72. PID 分配、散列查找与 waitid / pidfd 测试
+    wait_pid::test_wait_pid();
+
+    // 73. 任务缓存与内核栈缓存测试
+    task_cache::test_task_cache();
+
+    // 74. 带保护页的内核栈测试
+    kstack::test_kstack();
+
+    // 75. 浮点状态延迟保存与恢复测试
+    fpu::test_fpu();
+
+    // 76. 票据锁与 MCS 排队锁测试
+    spinlock::test_spinlock();
+
+    // 77. 读写锁与 RCU 回调测试
+    rwlock_rcu::test_rwlock_rcu();
+
+    // 78. 自适应互斥锁测试
+    mutex::test_mutex();
+
+    // 79. 每 CPU 变量测试
+    percpu::test_percpu();
+
+    // 80. 跨 CPU 函数调用测试
+    smp_call::test_smp_call();
+
+    // 81. 中断亲和性与线程化中断测试
+    irq_affinity::test_irq_affinity();
+
+    // 82. 唤醒时 CPU 选择测试
+    wake_affine::test_wake_affine();
+
+    // 83. 实时调度类测试
+    sched_rt::test_sched_rt();
+
+    // 84. CPU 亲和性测试
+    sched_affinity::test_sched_affinity();
+
+    // 85. 内核抢占计数测试
+    preempt::test_preempt();
+
+    // 86. 任务组与 CPU 带宽测试
+    cgroup::test_cgroup();
+
+    // 87. 平均负载与调度统计测试
+    sched_stats::test_sched_stats();
+
+    // 88. /proc/<pid> 进程信息测试
+    procfs_pid::test_procfs_pid();
+
+    // 89. 内核采样分析测试
+    profile::test_profile();
+
+    // 90. perf 计数事件测试
+    perf_event::test_perf_event();
+
+    // 91. 二进制跟踪环形缓冲区测试
+    trace_ring_buffer::test_trace_ring_buffer();
+
+    // 92. printk 日志缓冲区测试
+    printk::test_printk();
+
+    // 93. 启动阶段计时与并行 initcall 测试
+    initcall::test_initcall();
+
+    // 94. initramfs 测试
+    initramfs::test_initramfs();
+
+    // 95. tmpfs 测试
+    tmpfs::test_tmpfs();
+
+    // 96. MAP_SHARED 文件映射测试
+    mmap_shared::test_mmap_shared();
+
+    // 97. 脏页限速测试
+    dirty_throttle::test_dirty_throttle();
+
+    // 98. 帧缓冲区损坏区域测试
+    fb_damage::test_fb_damage();
+
+    // 99. GPU fence 测试
+    gpu_fence::test_gpu_fence();
+
+    // 100. evdev 输入事件设备测试
+    evdev::test_evdev();
+
+    // 101. 帧缓冲区映射测试
+    fb_mmap::test_fb_mmap();
+
+    // 102. PCI MSI-X 测试
+    pci_msi::test_pci_msi();
+
+    // 103. ext4 目录游标测试
+    ext4_readdir::test_ext4_readdir();
+
+    // 104. JBD2 日志测试
+    jbd2::test_jbd2();
+
+    // 105. CRC32 与 ext4 元数据校验和测试
+    crc32::test_crc32();
+
+    // 106. ext4 元数据预读测试
+    ext4_readahead::test_ext4_readahead();
+
+    // 107. 每 CPU 近似计数器测试
+    percpu_counter::test_percpu_counter();
+
+    // 108. statx / newfstatat 测试
+    statx::test_statx();
+
+    // 109. ext4 inline 数据测试
+    ext4_inline::test_ext4_inline();
+
+    // 110. seq_file 与 /proc 按需生成测试
+    seq_file::test_seq_file();
+
+    // 111. 用户物理页回收测试
+    user_page_recycle::test_user_page_recycle();
+
+    // 112. VMA 无锁查找测试
+    vma_lock::test_vma_lock();
+
+    // 113. 内存控制组测试
+    memcg::test_memcg();
+
+    // 114. OOM killer 测试
+    oom_kill::test_oom_kill();
+
+    // 115. zswap 测试
+    zswap::test_zswap();
+
+    // 116. 内存规整测试
+    compaction::test_compaction();
+
+    // 117. KSM 测试
+    ksm::test_ksm();
+
+    // 118. 透明大页测试
+    thp::test_thp();
+
+    // 119. 预清零页池测试
+    prezero::test_prezero();
+
+    // 120. 内核字符串函数测试
+    string::test_string();
+
+    // 121. TTY 层测试
+    tty::test_tty();
+
+    // 122. 目录子节点索引测试
+    dir_index::test_dir_index();
+
+    // 123. XDP 早期包过滤测试
+    xdp::test_xdp();
+
+    // 124. 内存事件计数测试
+    vmstat::test_vmstat();
+
+    // 125. CPU 空闲状态测试
+    cpuidle::test_cpuidle();
+
+    // 126. 共享统计页测试
+    kstats::test_kstats();
+
+    // 127. IPv4 分片重组与路径 MTU 测试
+    ip_fragment::test_ip_fragment();
+
+    // 128. ext4 索引目录测试
+    ext4_htree::test_ext4_htree();
+
+    // 129. ext4 多块分配器测试
+    ext4_mballoc::test_ext4_mballoc();
+
+    // 130. ext4 extent 树测试
+    ext4_extent::test_ext4_extent();
+
+    // 131. 块缓存淘汰与回写测试
+    buffer_cache::test_buffer_cache();
+
+    // 132. 伙伴系统分割与合并测试
+    buddy_allocator::test_buddy_allocator();
+
+    // 133. 内核堆扩展与归还测试
+    heap_grow::test_heap_grow();
+
+    // 134. Per-CPU 页缓存补充与归还测试
+    pcp::test_pcp();
+
+    // 135. 稀疏 mem_map 测试
+    sparse_mem_map::test_sparse_mem_map();
+
+    // 136. 硬件光标 ioctl 参数测试
+    fb_cursor::test_fb_cursor();
+
+    // 137. ext4 直接 I/O 测试
+    ext4_dio::test_ext4_dio();
+
+    // 52. 标准 alloc crate 类型测试
     // standard_alloc::test_standard_alloc();
 
     println!("test: ===== All Unit Tests Completed =====");
@@ -0,0 +1,73 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：自适应互斥锁
+//
+// 测试内容：
+// 1. 无竞争的加锁、解锁与 try_lock
+// 2. 锁守护离开作用域时释放
+// 3. task_curr 判断任务是否正在运行
+// 4. 条件变量没有等待者时 signal / broadcast 不影响互斥锁
+
+use crate::println;
+use crate::sync::condvar::ConditionVariable;
+use crate::sync::Mutex;
+
+static TEST_MUTEX: Mutex = Mutex::new();
+
+pub fn test_mutex() {
+    println!("test: ===== Testing Adaptive Mutex =====");
+
+    // 测试 1: 加锁与解锁
+    println!("test: 1. Testing uncontended lock and unlock...");
+    TEST_MUTEX.lock();
+    assert!(TEST_MUTEX.is_locked());
+    assert!(!TEST_MUTEX.has_waiters());
+    assert!(TEST_MUTEX.try_lock().is_err());
+    TEST_MUTEX.unlock();
+    assert!(!TEST_MUTEX.is_locked());
+    assert!(TEST_MUTEX.try_lock().is_ok());
+    TEST_MUTEX.unlock();
+    assert!(!TEST_MUTEX.is_locked());
+    println!("test:    SUCCESS - owner word is set and cleared");
+
+    // 测试 2: 锁守护
+    println!("test: 2. Testing mutex guard...");
+    let mutex = Mutex::new();
+    {
+        let _guard = mutex.guard();
+        assert!(mutex.is_locked());
+    }
+    assert!(!mutex.is_locked());
+    for _ in 0..3 {
+        let _guard = mutex.guard();
+    }
+    assert!(!mutex.is_locked());
+    println!("test:    SUCCESS - guard unlocks on drop");
+
+    // 测试 3: task_curr
+    println!("test: 3. Testing task_curr...");
+    assert!(!crate::sched::task_curr(core::ptr::null()));
+    match crate::sched::current() {
+        Some(task) => {
+            assert!(crate::sched::task_curr(task as *const _));
+            println!("test:    SUCCESS - current task is running on its CPU");
+        }
+        None => println!("test:    SKIP - no current task"),
+    }
+
+    // 测试 4: 条件变量
+    println!("test: 4. Testing condition variable without waiters...");
+    let cond = ConditionVariable::new();
+    mutex.lock();
+    cond.signal();
+    cond.broadcast();
+    assert!(mutex.is_locked());
+    mutex.unlock();
+    assert!(!mutex.is_locked());
+    println!("test:    SUCCESS - signal and broadcast leave the mutex alone");
+
+    println!("test: Mutex testing completed.");
+}
@@ -6,6 +6,7 @@
 
 use crate::println;
 use crate::net::buffer::{SkBuff, alloc_skb, kfree_skb, PacketType, EthProtocol, IpProtocol};
+use crate::net::skb_pool;
 use crate::drivers::net::{loopback_init, get_loopback_device, loopback_send, loopback};
 
 #[cfg(feature = "unit-test")]
@@ -28,6 +29,10 @@ pub fn test_network() {
     println!("test: 4. Testing loopback device...");
     test_loopback();
 
+    // 测试 5: 每 CPU 数据区缓存
+    println!("test: 5. Testing per-CPU SkBuff data pool...");
+    test_skb_pool();
+
     println!("test: ===== Network Subsystem Tests Completed =====");
 }
 
@@ -114,3 +119,38 @@ fn test_loopback() {
 
     println!("test:    SUCCESS - Loopback device works");
 }
+
+fn test_skb_pool() {
+    let cpu = crate::arch::cpu_id() as usize;
+
+    // 释放的数据区留在本 CPU 缓存中，下一次分配直接取回
+    let skb = alloc_skb(1500).expect("Failed to allocate SkBuff");
+    assert_eq!(skb.truesize(), skb_pool::SKB_DATA_SIZE, "MTU-sized SkBuff should use the pool");
+    let head = skb.head;
+    kfree_skb(skb);
+    let hits = skb_pool::skb_pool_stats()[cpu].hits;
+    let skb = alloc_skb(64).expect("Failed to allocate SkBuff");
+    assert_eq!(skb.head, head, "Freed data area should be reused");
+    assert_eq!(skb_pool::skb_pool_stats()[cpu].hits, hits + 1, "Reuse should count as a hit");
+
+    // skb_recycle 恢复为刚分配的状态
+    let mut skb = skb;
+    skb.skb_put_data(&[1, 2, 3]).unwrap();
+    skb.skb_recycle();
+    assert_eq!(skb.len(), 0, "Recycled SkBuff should be empty");
+    assert_eq!(skb.head, head, "Recycled SkBuff keeps its data area");
+    kfree_skb(skb);
+
+    // 大块数据放在页片段中
+    let data: alloc::vec::Vec<u8> = (0..10000usize).map(|i| i as u8).collect();
+    let mut skb = alloc_skb(0).expect("Failed to allocate SkBuff");
+    skb.skb_append_pagefrags(&data).unwrap();
+    assert_eq!(skb.len(), 10000, "Length should include page fragments");
+    assert_eq!(skb.nr_frags, 3, "10000 bytes should take 3 pages");
+    let mut out = alloc::vec![0u8; 10000];
+    assert_eq!(skb.skb_copy_bits(0, &mut out, 10000), 10000);
+    assert_eq!(out, data, "Fragment data mismatch");
+    kfree_skb(skb);
+
+    println!("test:    SUCCESS - Pool reuses data areas, large data goes to page fragments");
+}
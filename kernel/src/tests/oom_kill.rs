@@ -0,0 +1,127 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! OOM killer 单元测试
+//!
+//! 评分随驻留页数和 oom_score_adj 变化、/proc/<pid>/oom_score_adj 的读写、
+//! 预留页只给受害者、空组的 OOM 不杀死任何进程
+
+use alloc::string::String;
+use core::sync::atomic::Ordering;
+
+use crate::println;
+use crate::arch::riscv64::mm::{
+    create_user_address_space, handle_mm_fault, map, AddressSpace, FaultFlags, MmFaultResult, VirtAddr,
+};
+use crate::fs::procfs;
+use crate::mm::oom_kill::{
+    nr_oom_kills, nr_reserved_pages, oom_badness, oom_reserve_alloc, oom_reserve_refill, out_of_memory,
+    OOM_SCORE_ADJ_MAX, OOM_SCORE_ADJ_MIN,
+};
+use crate::mm::page::{frame_stats, VirtAddr as PageVirtAddr, PAGE_SIZE};
+use crate::mm::pcp::free_user_page;
+use crate::mm::vma::{VmaFlags, VmaType};
+use crate::sched::group::{root_task_group, sched_create_group, sched_destroy_group, tg_memcg};
+
+const NR_PAGES: usize = 4;
+
+/// 读取 /proc 文件为字符串
+fn read_proc(path: &str) -> String {
+    String::from_utf8(procfs::read_file(path).unwrap_or_default()).unwrap_or_default()
+}
+
+/// 找一个 PID 不为 0 的线程组首任务
+fn find_process() -> u32 {
+    let mut pid = 0;
+    crate::sched::sched::for_each_task(|task| unsafe {
+        let task = &*task;
+        if pid == 0 && task.pid() != 0 && task.pid() == task.tgid() {
+            pid = task.pid();
+        }
+    });
+    pid
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_oom_kill() {
+    println!("test: ===== Starting OOM Killer Tests =====");
+
+    // 1. 评分
+    println!("test: 1. Testing oom_badness...");
+    match create_user_address_space() {
+        Some(root_ppn) => {
+            let aspace = unsafe { AddressSpace::new(root_ppn) };
+            let totalpages = frame_stats().total_frames;
+            let empty = oom_badness(&aspace, 0, totalpages).expect("killable");
+            let mut flags = VmaFlags::new();
+            flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+            let anon = map::MAP_PRIVATE | map::MAP_ANONYMOUS;
+            let base = aspace.mmap(PageVirtAddr::new(0), NR_PAGES * PAGE_SIZE, flags, VmaType::Anonymous, anon)
+                .expect("mmap failed");
+            for page in 0..NR_PAGES {
+                let addr = base.as_usize() + page * PAGE_SIZE;
+                let result = handle_mm_fault(&aspace, VirtAddr::new(addr as u64), FaultFlags::WRITE | FaultFlags::USER);
+                assert_eq!(result, MmFaultResult::Handled);
+            }
+            let points = oom_badness(&aspace, 0, totalpages).expect("killable");
+            assert!(points >= empty + NR_PAGES, "{} pages resident, badness {}", NR_PAGES, points);
+            let boosted = oom_badness(&aspace, OOM_SCORE_ADJ_MAX, totalpages).expect("killable");
+            assert!(boosted > points);
+            assert_eq!(oom_badness(&aspace, OOM_SCORE_ADJ_MIN, totalpages), None);
+            aspace.mmput();
+            println!("test:    SUCCESS - badness {} -> {} with oom_score_adj 1000", points, boosted);
+        }
+        None => println!("test:    SKIP - no page table available"),
+    }
+
+    // 2. /proc/<pid>/oom_score_adj
+    println!("test: 2. Testing /proc/<pid>/oom_score_adj...");
+    let pid = find_process();
+    if pid != 0 {
+        let path = alloc::format!("/{}/oom_score_adj", pid);
+        let einval = crate::errno::Errno::InvalidArgument.as_neg_i32();
+        assert_eq!(read_proc(&path), "0\n");
+        assert_eq!(procfs::write_file(&path, b"-500\n"), Ok(5));
+        assert_eq!(read_proc(&path), "-500\n");
+        assert_eq!(procfs::write_file(&path, b"2000"), Err(einval));
+        assert_eq!(procfs::write_file(&path, b"high"), Err(einval));
+        assert_eq!(read_proc(&path), "-500\n");
+        let score = read_proc(&alloc::format!("/{}/oom_score", pid));
+        assert!(score.trim().parse::<usize>().map_or(false, |score| score <= 2000));
+        assert_eq!(procfs::write_file(&path, b"0"), Ok(1));
+        assert_eq!(procfs::read_file("/999999/oom_score_adj"), None);
+        println!("test:    SUCCESS - pid {}: oom_score {}", pid, score.trim());
+    } else {
+        println!("test:    SKIP - no process to inspect");
+    }
+
+    // 3. 预留页只给受害者
+    println!("test: 3. Testing victim reserves...");
+    oom_reserve_refill();
+    let reserved = nr_reserved_pages();
+    assert!(oom_reserve_alloc().is_none(), "reserve served a task that is not a victim");
+    match crate::sched::current() {
+        Some(task) if reserved > 0 => {
+            task.oom.victim.store(true, Ordering::Release);
+            let frame = oom_reserve_alloc();
+            task.oom.victim.store(false, Ordering::Release);
+            free_user_page(frame.expect("victim denied the reserve"));
+            assert_eq!(nr_reserved_pages(), reserved - 1);
+            println!("test:    SUCCESS - victim took 1 of {} reserved pages", reserved);
+        }
+        _ => println!("test:    SKIP - reserve empty"),
+    }
+
+    // 4. 空组的 OOM 找不到受害者
+    println!("test: 4. Testing memcg OOM without tasks...");
+    let group = sched_create_group(root_task_group(), "test-oom").expect("create test-oom");
+    let kills = nr_oom_kills();
+    assert!(!out_of_memory(tg_memcg(group)));
+    assert_eq!(nr_oom_kills(), kills);
+    assert!(sched_destroy_group(group).is_ok());
+    println!("test:    SUCCESS - nothing killed outside the group");
+
+    println!("test: ===== OOM Killer Tests Completed =====");
+}
@@ -0,0 +1,330 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 页缓存测试
+//!
+//! 测试页缓存的索引与读写路径：
+//! - 基数树在稀疏、跨层的索引上的存取、删除与范围遍历
+//! - read() 首次从数据来源读入，之后从同一批缓存页复制
+//! - write() 更新已缓存的页
+//! - 顺序读取时预读窗口逐次放大，随机读取时收缩；连续页成批读入
+//! - 延迟写只弄脏缓存页，回写时连续的脏页一次交给数据来源
+//! - splice 把缓存页作为 SkBuff 的页片段挂入，只增加页引用、不复制数据
+
+use crate::println;
+use crate::mm::filemap::{self, FileRaState, MappingSource, RaMode, RA_MAX_PAGES};
+use crate::mm::page::PAGE_SIZE;
+use crate::mm::xarray::XArray;
+use alloc::sync::Arc;
+use alloc::vec;
+use alloc::vec::Vec;
+use spin::Mutex;
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+/// 第 i 页内容全部为 i 的测试文件，记录读入次数
+struct CountingFile {
+    size: usize,
+    reads: AtomicUsize,
+    /// read_pages 的调用次数（一次批量读入）
+    batches: AtomicUsize,
+}
+
+impl MappingSource for CountingFile {
+    fn size(&self) -> usize {
+        self.size
+    }
+
+    fn read_page(&self, index: usize, buf: &mut [u8]) -> usize {
+        self.reads.fetch_add(1, Ordering::Relaxed);
+        buf.fill(index as u8);
+        buf.len().min(self.size - index * PAGE_SIZE)
+    }
+
+    fn read_pages(&self, index: usize, buf: &mut [u8]) -> usize {
+        self.batches.fetch_add(1, Ordering::Relaxed);
+        let mut done = 0;
+        for (i, chunk) in buf.chunks_mut(PAGE_SIZE).enumerate() {
+            done += self.read_page(index + i, chunk);
+        }
+        done
+    }
+}
+
+/// 内存中的可写测试文件，记录回写次数
+struct WritableFile {
+    size: AtomicUsize,
+    data: Mutex<Vec<u8>>,
+    writes: AtomicUsize,
+}
+
+impl MappingSource for WritableFile {
+    fn size(&self) -> usize {
+        self.size.load(Ordering::Relaxed)
+    }
+
+    fn read_page(&self, index: usize, buf: &mut [u8]) -> usize {
+        let data = self.data.lock();
+        let start = (index * PAGE_SIZE).min(data.len());
+        let len = (data.len() - start).min(buf.len());
+        buf[..len].copy_from_slice(&data[start..start + len]);
+        len
+    }
+
+    fn write_pages(&self, index: usize, pages: &[usize]) -> Result<(), i32> {
+        self.writes.fetch_add(1, Ordering::Relaxed);
+        let size = self.size();
+        let mut data = self.data.lock();
+        data.resize(size, 0);
+        for (i, &phys) in pages.iter().enumerate() {
+            let start = (index + i) * PAGE_SIZE;
+            let len = size.saturating_sub(start).min(PAGE_SIZE);
+            let page = unsafe { core::slice::from_raw_parts(phys as *const u8, len) };
+            data[start..start + len].copy_from_slice(page);
+        }
+        Ok(())
+    }
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_page_cache() {
+    println!("test: ===== Starting Page Cache Tests =====");
+
+    // 测试 1: 基数树存取
+    println!("test: 1. Testing XArray store/load/erase...");
+    test_xarray();
+
+    // 测试 2: 经页缓存读写
+    println!("test: 2. Testing buffered read/write through the page cache...");
+    test_buffered_io();
+
+    // 测试 3: 预读窗口
+    println!("test: 3. Testing sequential read-ahead windows...");
+    test_readahead();
+
+    // 测试 4: 延迟写与回写
+    println!("test: 4. Testing delayed writes and write-back...");
+    test_writeback();
+
+    // 测试 5: 缓存页挂入 SkBuff 页片段
+    println!("test: 5. Testing splice of cached pages into SkBuff frags...");
+    test_splice_to_skb();
+
+    println!("test: ===== Page Cache Tests Completed =====");
+}
+
+fn test_xarray() {
+    let mut xa = XArray::new();
+    assert!(xa.is_empty());
+    assert_eq!(xa.load(0), None);
+
+    // 跨越多层的稀疏索引
+    let indices = [0usize, 1, 63, 64, 4095, 4096, 1 << 20, (1 << 30) + 7];
+    for &i in indices.iter() {
+        assert_eq!(xa.store(i, i * 2 + 1), None);
+    }
+    assert_eq!(xa.len(), indices.len());
+    for &i in indices.iter() {
+        assert_eq!(xa.load(i), Some(i * 2 + 1));
+    }
+    assert_eq!(xa.load(2), None);
+    assert_eq!(xa.load(1 << 21), None);
+    assert_eq!(xa.store(63, 5), Some(127));
+    assert_eq!(xa.len(), indices.len());
+
+    // 范围遍历按索引顺序
+    let mut seen = Vec::new();
+    xa.for_each_range(1, 4097, |index, _| seen.push(index));
+    assert_eq!(seen, [1, 63, 64, 4095, 4096]);
+    println!("test:    SUCCESS - sparse indices stored and iterated in order");
+
+    for &i in indices.iter() {
+        assert!(xa.erase(i).is_some());
+        assert_eq!(xa.load(i), None);
+    }
+    assert!(xa.is_empty());
+    assert_eq!(xa.erase(0), None);
+    // 删空后可以继续使用
+    assert_eq!(xa.store(9, 1), None);
+    assert_eq!(xa.load(9), Some(1));
+    println!("test:    SUCCESS - erase frees nodes and shrinks the tree");
+}
+
+fn test_buffered_io() {
+    const TEST_INO: u64 = u64::MAX - 21;
+    const FILE_SIZE: usize = 3 * PAGE_SIZE + 100;
+
+    let file = Arc::new(CountingFile {
+        size: FILE_SIZE,
+        reads: AtomicUsize::new(0),
+        batches: AtomicUsize::new(0),
+    });
+    let mapping = filemap::get_mapping(TEST_INO, file.clone());
+
+    // 跨页读取，第一次从数据来源读入
+    let mut buf = [0u8; 200];
+    assert_eq!(mapping.read(PAGE_SIZE - 100, &mut buf), 200);
+    assert!(buf[..100].iter().all(|&b| b == 0));
+    assert!(buf[100..].iter().all(|&b| b == 1));
+    let reads = file.reads.load(Ordering::Relaxed);
+    assert_eq!(reads, 2);
+
+    // 再次读取不访问数据来源，结果来自同一个缓存页
+    assert_eq!(mapping.read(PAGE_SIZE - 100, &mut buf), 200);
+    assert_eq!(file.reads.load(Ordering::Relaxed), reads);
+    assert!(mapping.find_page(1).is_some());
+    println!("test:    SUCCESS - repeated reads are served from cached pages");
+
+    // 读到文件末尾为止
+    let mut tail = [0u8; PAGE_SIZE];
+    assert_eq!(mapping.read(3 * PAGE_SIZE, &mut tail), 100);
+    assert!(tail[..100].iter().all(|&b| b == 3));
+    assert_eq!(mapping.read(FILE_SIZE, &mut tail), 0);
+
+    // 写入更新已缓存的页
+    mapping.write(PAGE_SIZE + 10, &[0xAB; 4]);
+    let mut check = [0u8; 6];
+    assert_eq!(mapping.read(PAGE_SIZE + 9, &mut check), 6);
+    assert_eq!(check, [1, 0xAB, 0xAB, 0xAB, 0xAB, 1]);
+    println!("test:    SUCCESS - writes update cached pages");
+}
+
+fn test_readahead() {
+    // 从文件开头逐页读：初始窗口为请求的 4 倍，读到标记页时推进并放大
+    let mut ra = FileRaState::new();
+    assert_eq!(ra.ondemand(0, 1), (0, 4));
+    assert_eq!(ra.ondemand(1, 1), (1, 11));
+    assert_eq!(ra.ondemand(2, 1), (2, 10));
+    let mut last_size = ra.size;
+    for index in 3..512 {
+        let (start, len) = ra.ondemand(index, 1);
+        assert_eq!(start, index);
+        assert!(len >= 1);
+        assert!(ra.size >= last_size && ra.size <= RA_MAX_PAGES);
+        last_size = ra.size;
+    }
+    assert_eq!(ra.size, RA_MAX_PAGES);
+
+    // 跳到别处读：窗口收缩为请求本身
+    assert_eq!(ra.ondemand(10_000, 2), (10_000, 2));
+    // 随后顺序读重新建立窗口
+    let (_, len) = ra.ondemand(10_002, 1);
+    assert!(len > 1);
+
+    // POSIX_FADV_RANDOM 不预读，POSIX_FADV_SEQUENTIAL 一开始就用最大窗口
+    ra.mode = RaMode::Random;
+    assert_eq!(ra.ondemand(10_003, 1), (10_003, 1));
+    let mut seq = FileRaState::new();
+    seq.mode = RaMode::Sequential;
+    assert_eq!(seq.ondemand(0, 1), (0, RA_MAX_PAGES * 2));
+    println!("test:    SUCCESS - window grows on sequential reads and shrinks on random reads");
+
+    // 顺序读取整个文件：连续页成批读入，读入次数远少于页数
+    const TEST_INO: u64 = u64::MAX - 22;
+    const NR_PAGES: usize = 200;
+    let file = Arc::new(CountingFile {
+        size: NR_PAGES * PAGE_SIZE,
+        reads: AtomicUsize::new(0),
+        batches: AtomicUsize::new(0),
+    });
+    let mapping = filemap::get_mapping(TEST_INO, file.clone());
+    let mut ra = FileRaState::new();
+    let mut buf = [0u8; 512];
+    let mut offset = 0;
+    while offset < NR_PAGES * PAGE_SIZE {
+        assert_eq!(mapping.read_ra(offset, &mut buf, &mut ra), buf.len());
+        assert!(buf.iter().all(|&b| b == (offset / PAGE_SIZE) as u8));
+        offset += buf.len();
+    }
+    assert_eq!(file.reads.load(Ordering::Relaxed), NR_PAGES);
+    let batches = file.batches.load(Ordering::Relaxed);
+    assert!(batches * 8 <= NR_PAGES);
+    println!("test:    SUCCESS - {} pages read in {} batches", NR_PAGES, batches);
+
+    // POSIX_FADV_DONTNEED 丢弃未被使用的缓存页
+    assert_eq!(mapping.invalidate_range(0, NR_PAGES), NR_PAGES);
+    assert_eq!(mapping.nr_cached(), 0);
+    println!("test:    SUCCESS - invalidate_range drops unused cached pages");
+}
+
+fn test_writeback() {
+    const TEST_INO: u64 = u64::MAX - 23;
+    let file = Arc::new(WritableFile {
+        size: AtomicUsize::new(100),
+        data: Mutex::new(vec![7u8; 100]),
+        writes: AtomicUsize::new(0),
+    });
+    let mapping = filemap::get_mapping(TEST_INO, file.clone());
+
+    // 追加写三页多：只弄脏缓存页，不访问数据来源的存储
+    let payload = vec![0x5Au8; 3 * PAGE_SIZE];
+    file.size.store(50 + payload.len(), Ordering::Relaxed);
+    assert_eq!(mapping.write_dirty(50, &payload), payload.len());
+    assert_eq!(mapping.nr_dirty(), 4);
+    assert!(mapping.dirtied_when() != 0);
+    assert_eq!(file.writes.load(Ordering::Relaxed), 0);
+    assert_eq!(file.data.lock().len(), 100);
+
+    // 读取看到的是脏页中的新数据，脏页不会被丢弃
+    let mut check = [0u8; 4];
+    assert_eq!(mapping.read(48, &mut check), 4);
+    assert_eq!(check, [7, 7, 0x5A, 0x5A]);
+    assert_eq!(mapping.invalidate_range(0, 4), 0);
+    println!("test:    SUCCESS - delayed writes stay in dirty cached pages");
+
+    // 回写：连续的脏页一次写回
+    assert_eq!(mapping.writeback(), Ok(4));
+    assert_eq!(file.writes.load(Ordering::Relaxed), 1);
+    assert_eq!(mapping.nr_dirty(), 0);
+    assert_eq!(mapping.dirtied_when(), 0);
+    assert_eq!(mapping.take_wb_error(), 0);
+    {
+        let data = file.data.lock();
+        assert_eq!(data.len(), 50 + payload.len());
+        assert!(data[..50].iter().all(|&b| b == 7));
+        assert!(data[50..].iter().all(|&b| b == 0x5A));
+    }
+
+    // 回写后的页干净，可以丢弃，之后从数据来源读回相同内容
+    assert_eq!(mapping.invalidate_range(0, 4), 4);
+    assert_eq!(mapping.read(48, &mut check), 4);
+    assert_eq!(check, [7, 7, 0x5A, 0x5A]);
+    println!("test:    SUCCESS - write-back flushes contiguous dirty pages in one request");
+}
+
+fn test_splice_to_skb() {
+    use crate::fs::splice::splice_mapping_to_skb;
+    use crate::mm::page_desc::pfn_to_page;
+
+    const TEST_INO: u64 = u64::MAX - 25;
+    let file = Arc::new(CountingFile {
+        size: 3 * PAGE_SIZE,
+        reads: AtomicUsize::new(0),
+        batches: AtomicUsize::new(0),
+    });
+    let mapping = filemap::get_mapping(TEST_INO, file.clone());
+
+    // 从第 0 页中间开始取两页的数据：跨三个页片段
+    let mut pos = (PAGE_SIZE / 2) as u64;
+    let skb = splice_mapping_to_skb(&mapping, &mut pos, 2 * PAGE_SIZE).expect("splice to skb failed");
+    assert_eq!(pos, (PAGE_SIZE / 2 + 2 * PAGE_SIZE) as u64);
+    assert_eq!(skb.len() as usize, 2 * PAGE_SIZE);
+    assert_eq!(skb.skb_headlen(), 0);
+    assert_eq!(skb.nr_frags, 3);
+
+    // 片段引用的就是缓存页，缓存页多了一个引用
+    for (i, frag) in skb.frags[..3].iter().enumerate() {
+        assert_eq!(Some(frag.page), mapping.find_page(i));
+        assert_eq!(unsafe { (*pfn_to_page(frag.page / PAGE_SIZE)).refcount() }, 2);
+    }
+    let mut buf = [0u8; 4];
+    assert_eq!(skb.skb_copy_bits((PAGE_SIZE / 2 - 2) as u32, &mut buf, 4), 4);
+    assert_eq!(buf, [0, 0, 1, 1]);
+    println!("test:    SUCCESS - cached pages are attached as frags without copying");
+
+    // 被片段引用的页不能回收；释放 SkBuff 后引用归还
+    assert_eq!(mapping.invalidate_range(0, 3), 0);
+    skb.free();
+    assert_eq!(mapping.invalidate_range(0, 3), 3);
+    println!("test:    SUCCESS - freeing the skb drops the page references");
+}
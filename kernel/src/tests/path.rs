@@ -6,6 +6,8 @@
 // 测试：Path 路径解析功能
 use crate::println;
 use crate::fs::path::Path;
+use crate::fs::namei;
+use crate::fs::rootfs;
 
 pub fn test_path() {
     println!("test: Testing Path parsing...");
@@ -51,5 +53,59 @@ pub fn test_path() {
     assert_eq!(Path::new("").as_str(), "", "Empty as_str should work");
     println!("test:    SUCCESS - as_str works");
 
+    // 测试 6: 逐分量路径查找
+    println!("test: 6. Testing component-wise path walk...");
+    test_path_walk();
+
     println!("test: Path parsing testing completed.");
 }
+
+fn test_path_walk() {
+    let sb_ptr = rootfs::get_rootfs();
+    if sb_ptr.is_null() {
+        println!("test:    RootFS not initialized, skipping");
+        return;
+    }
+    let sb = unsafe { &*sb_ptr };
+
+    let _ = sb.create_dir("/walk_test", 0o755);
+    let _ = sb.create_dir("/walk_test/sub", 0o755);
+    let _ = sb.create_file("/walk_test/sub/foo", b"foo".to_vec());
+
+    // 第一次查找填充 dcache，之后同一路径和共享前缀的路径走 lookup_fast
+    assert!(sb.lookup("/walk_test/sub/foo").is_some(), "foo should be found");
+    let (fast_before, slow_before) = namei::path_walk_stats();
+    assert!(sb.lookup("/walk_test/sub/foo").is_some(), "foo should be found again");
+    let (fast_after, slow_after) = namei::path_walk_stats();
+    assert!(fast_after >= fast_before + 3, "cached walk should hit dcache for every component");
+    assert_eq!(slow_after, slow_before, "cached walk should not call the filesystem");
+
+    // "." 和 ".." 不需要规范化
+    let node = sb.lookup("/walk_test/./sub/../sub/foo");
+    assert!(node.is_some() && node.unwrap().name == b"foo", ". and .. should be resolved");
+
+    // 负目录项：不存在的名字被缓存，创建后失效
+    assert!(sb.lookup("/walk_test/sub/bar").is_none(), "bar should not exist yet");
+    let _ = sb.create_file("/walk_test/sub/bar", b"bar".to_vec());
+    assert!(sb.lookup("/walk_test/sub/bar").is_some(), "bar should be found after creation");
+    let _ = sb.unlink("/walk_test/sub/bar");
+    assert!(sb.lookup("/walk_test/sub/bar").is_none(), "bar should be gone after unlink");
+
+    // 中间分量的符号链接被跟随，相对目标从链接所在目录解析
+    let _ = sb.symlink("sub", "/walk_test/link");
+    let node = sb.lookup("/walk_test/link/foo");
+    assert!(node.is_some() && node.unwrap().name == b"foo", "symlink should be followed");
+    let link = sb.lookup("/walk_test/link");
+    assert!(link.is_some() && link.unwrap().is_symlink(), "last symlink should not be followed");
+
+    // 挂载点按分量匹配
+    if let Some((mnt, rest)) = namei::lookup_mnt("/walk_test/sub") {
+        assert_eq!(rest, "/walk_test/sub", "root mount should cover the whole path");
+        assert!(mnt.mnt_mountpoint.as_ref().map_or(false, |mp| mp.as_slice() == b"/"), "should be root mount");
+    }
+    if let Some((_, rest)) = namei::lookup_mnt("/proc/meminfo") {
+        assert!(rest == "/meminfo" || rest == "/proc/meminfo", "proc path should be split at its mount");
+    }
+
+    println!("test:    SUCCESS - path walk works");
+}
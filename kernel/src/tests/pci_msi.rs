@@ -0,0 +1,121 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：PCI MSI / MSI-X 与 IMSIC 中断号分配
+//
+// 测试内容：
+// 1. 沿 capability 链表找到 MSI-X 与 MSI，解析表大小、BAR 与偏移
+// 2. MSI-X 向量表写入消息后保持屏蔽，放开后可读回，越界表项被拒绝
+// 3. 使能 MSI-X 时先屏蔽整个功能并关闭 INTx，关闭后恢复；MSI 写入 64 位地址
+// 4. IMSIC 中断号分配、分发与释放，未初始化中断文件的 hart 不能作为目标
+
+use alloc::vec;
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+use crate::drivers::intc::imsic;
+use crate::drivers::pci::msi::{msix_flags, MsiCapability, MsiMsg, MsixCapability, MsixTable, PCI_MSIX_ENTRY_SIZE};
+use crate::drivers::pci::{command, PCIConfig};
+use crate::irq::IrqReturn;
+use crate::println;
+
+static DISPATCHED: AtomicUsize = AtomicUsize::new(0);
+
+fn dummy_msi_handler(id: usize) -> IrqReturn {
+    DISPATCHED.store(id, Ordering::SeqCst);
+    IrqReturn::Handled
+}
+
+pub fn test_pci_msi() {
+    println!("test: ===== Testing PCI MSI-X =====");
+
+    // 内存中的假配置空间：0x40 厂商 capability → 0x50 MSI-X → 0x60 MSI
+    let mut space = vec![0u32; 64];
+    let base = space.as_mut_ptr() as u64;
+    let config = PCIConfig::new(base);
+    config.write_config_word(0x06, crate::drivers::pci::status::CAPABILITIES_LIST);
+    config.write_config_dword(0x34, 0x40);
+    config.write_config_dword(0x40, 0x5009);
+    config.write_config_dword(0x50, 0x0007_6011);
+    config.write_config_dword(0x54, 0x2000 | 1);
+    config.write_config_dword(0x58, 0x3000 | 1);
+    config.write_config_dword(0x60, 0x0084_0005);
+
+    // 测试 1: capability 解析
+    println!("test: 1. Testing capability parsing...");
+    let msix = MsixCapability::parse(&config).expect("msix");
+    assert_eq!(msix.pos, 0x50);
+    assert_eq!(msix.table_size, 8);
+    assert_eq!((msix.table_bir, msix.table_offset), (1, 0x2000));
+    assert_eq!((msix.pba_bir, msix.pba_offset), (1, 0x3000));
+    let msi = MsiCapability::parse(&config).expect("msi");
+    assert_eq!(msi.pos, 0x60);
+    assert!(msi.is_64 && !msi.per_vector_mask);
+    assert_eq!(msi.max_vectors, 4);
+    assert!(config.find_capability(0x10).is_none());
+    println!("test:    SUCCESS - MSI-X with {} entries, MSI with {} vectors", msix.table_size, msi.max_vectors);
+
+    // 测试 2: 向量表
+    println!("test: 2. Testing MSI-X table entries...");
+    let table_mem = vec![0u32; (msix.table_size as u64 * PCI_MSIX_ENTRY_SIZE / 4) as usize];
+    let bar_addr = table_mem.as_ptr() as u64 - msix.table_offset as u64;
+    let table = MsixTable::new(&msix, bar_addr);
+    let msg = MsiMsg { address: 0x1_2800_1000, data: 5 };
+    assert_eq!(table.write_msg(3, &msg), Ok(()));
+    assert_eq!(table_mem[3 * 4 + 3] & 1, 1);
+    table.unmask(3);
+    assert_eq!(table_mem[3 * 4 + 3] & 1, 0);
+    assert_eq!(table.read_msg(3), Some(msg));
+    assert!(table.write_msg(8, &msg).is_err());
+    assert!(table.read_msg(8).is_none());
+    println!("test:    SUCCESS - entries written masked and read back");
+
+    // 测试 3: 使能与关闭
+    println!("test: 3. Testing MSI-X / MSI enable...");
+    msix.enable_masked(&config);
+    let control = config.read_config_word(msix.pos + 2);
+    assert_eq!(control & (msix_flags::ENABLE | msix_flags::MASKALL), msix_flags::ENABLE | msix_flags::MASKALL);
+    assert_ne!(config.command() & command::INT_DISABLE, 0);
+    msix.unmask_all(&config);
+    assert_eq!(config.read_config_word(msix.pos + 2) & msix_flags::MASKALL, 0);
+    msix.disable(&config);
+    assert_eq!(config.read_config_word(msix.pos + 2) & msix_flags::ENABLE, 0);
+    assert_eq!(config.command() & command::INT_DISABLE, 0);
+    assert_eq!(msi.enable(&config, &msg), Ok(()));
+    assert_eq!(config.read_config_dword(0x64), 0x2800_1000);
+    assert_eq!(config.read_config_dword(0x68), 1);
+    assert_eq!(config.read_config_word(0x6C), 5);
+    assert_ne!(config.read_config_word(0x62) & 1, 0);
+    msi.disable(&config);
+    println!("test:    SUCCESS - function masked while programming, INTx restored");
+
+    // 测试 4: IMSIC 中断号
+    println!("test: 4. Testing IMSIC vector allocation...");
+    let a = imsic::msi_alloc(dummy_msi_handler, None, "test-msi").expect("msi_alloc");
+    let b = imsic::msi_alloc(dummy_msi_handler, None, "test-msi").expect("msi_alloc");
+    assert_ne!(a, b);
+    assert!(a > 0 && b > 0);
+    imsic::handle_msi(b);
+    assert_eq!(DISPATCHED.load(Ordering::SeqCst), b);
+    assert_eq!(imsic::kstat_msi(b), 1);
+    let hart = crate::arch::cpu_id();
+    match imsic::msi_compose_msg(a, hart) {
+        Some(msg) => {
+            assert!(imsic::is_enabled());
+            assert_eq!(msg.address, imsic::IMSIC_S_BASE + hart as u64 * imsic::IMSIC_HART_STRIDE);
+            assert_eq!(msg.data, a as u32);
+        }
+        None => assert_eq!(imsic::ready_mask() & (1 << hart), 0),
+    }
+    imsic::msi_free(a);
+    imsic::msi_free(b);
+    assert!(imsic::allocated_msis().iter().all(|&(id, _)| id != a && id != b));
+    let spurious = imsic::spurious_msis();
+    imsic::handle_msi(a);
+    assert_eq!(imsic::spurious_msis(), spurious + 1);
+    println!("test:    SUCCESS - vectors {} and {} allocated, dispatched, freed", a, b);
+
+    drop(space);
+    println!("test: PCI MSI-X testing completed.");
+}
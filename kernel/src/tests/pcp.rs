@@ -0,0 +1,148 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! Per-CPU 页缓存单元测试
+//!
+//! 在独立的 PerCpuPages 上按全局分配器的空闲页数检查：补充批量随连续补充放大、
+//! 不超过高水位的一半，释放到高水位时批量归还并提高水位、归还批量随释放放大；
+//! 再检查全局接口的命中与补充计数、drain_local_pages / drain_all_pages 与高水位衰减
+
+use crate::println;
+use crate::mm::page::{alloc_frame, dealloc_frame, frame_stats, PhysFrame};
+use crate::mm::pcp::{
+    alloc_page_pcp, drain_all_pages, drain_local_pages, free_page_pcp, pcp_stats, pcp_tick, MigrateType,
+    PerCpuPages, PCP_BATCH, PCP_HIGH, PCP_HIGH_MIN, PCP_LOW,
+};
+
+/// 释放阶段使用的页数：缓存到 PCP_HIGH 页时第一次归还，到 PCP_HIGH + PCP_BATCH 页时第二次归还
+const NR_FRAMES: usize = PCP_HIGH + 2 * PCP_BATCH;
+
+fn free_frames() -> usize {
+    frame_stats().free_frames
+}
+
+/// 从本地缓存分配一页，返回页号
+fn pcp_alloc(pcp: &mut PerCpuPages) -> usize {
+    pcp.alloc(MigrateType::Movable).expect("pcp alloc failed").number
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_pcp() {
+    println!("test: ===== Starting Per-CPU Page Cache Tests =====");
+
+    let mut pcp = PerCpuPages::new();
+    pcp.init();
+    let mut frames = [0usize; NR_FRAMES];
+    let mut nr_frames = 0;
+    let base = free_frames();
+
+    // 1. 首次分配补充 PCP_BATCH 页，第一页直接返回，其余留在缓存
+    println!("test: 1. Testing refill on empty cache...");
+    frames[nr_frames] = pcp_alloc(&mut pcp);
+    nr_frames += 1;
+    assert_eq!(base - free_frames(), PCP_BATCH);
+    assert_eq!(pcp.count(MigrateType::Movable), PCP_BATCH - 1);
+    assert_eq!(pcp.count(MigrateType::Unmovable), 0);
+    // 缓存中的页直接命中，不访问全局分配器
+    while pcp.count(MigrateType::Movable) > 0 {
+        frames[nr_frames] = pcp_alloc(&mut pcp);
+        nr_frames += 1;
+    }
+    assert_eq!(base - free_frames(), PCP_BATCH);
+    println!("test:    SUCCESS - {} pages fetched, {} hits", PCP_BATCH, PCP_BATCH - 1);
+
+    // 2. 连续补充时批量翻倍，但不超过高水位的一半
+    println!("test: 2. Testing refill batch scaling...");
+    for _ in 0..2 {
+        let before = free_frames();
+        frames[nr_frames] = pcp_alloc(&mut pcp);
+        nr_frames += 1;
+        assert_eq!(before - free_frames(), PCP_HIGH / 2);
+        assert_eq!(pcp.count(MigrateType::Movable), PCP_HIGH / 2 - 1);
+        while pcp.count(MigrateType::Movable) > 0 {
+            frames[nr_frames] = pcp_alloc(&mut pcp);
+            nr_frames += 1;
+        }
+    }
+    assert_eq!(pcp.total_count(), 0);
+    // 释放阶段需要的其余页直接取自全局分配器
+    while nr_frames < NR_FRAMES {
+        frames[nr_frames] = alloc_frame().expect("alloc_frame failed").number;
+        nr_frames += 1;
+    }
+    println!("test:    SUCCESS - batch grew from {} to {}", PCP_BATCH, PCP_HIGH / 2);
+
+    // 3. 缓存达到高水位时归还 PCP_BATCH 页；高水位提高，下一次归还批量翻倍
+    println!("test: 3. Testing drain at the high watermark...");
+    let before = free_frames();
+    for i in 0..PCP_HIGH - 1 {
+        pcp.free(PhysFrame::new(frames[i]), MigrateType::Movable);
+    }
+    assert_eq!(pcp.count(MigrateType::Movable), PCP_HIGH - 1);
+    assert_eq!(free_frames(), before);
+    pcp.free(PhysFrame::new(frames[PCP_HIGH - 1]), MigrateType::Movable);
+    assert_eq!(pcp.count(MigrateType::Movable), PCP_HIGH - PCP_BATCH);
+    assert_eq!(free_frames() - before, PCP_BATCH);
+    // 新的高水位为 PCP_HIGH + PCP_BATCH
+    for i in PCP_HIGH..NR_FRAMES - 1 {
+        pcp.free(PhysFrame::new(frames[i]), MigrateType::Movable);
+    }
+    assert_eq!(pcp.count(MigrateType::Movable), PCP_HIGH + PCP_BATCH - 1);
+    pcp.free(PhysFrame::new(frames[NR_FRAMES - 1]), MigrateType::Movable);
+    assert_eq!(pcp.count(MigrateType::Movable), PCP_HIGH - PCP_BATCH);
+    assert_eq!(free_frames() - before, 3 * PCP_BATCH);
+    assert!(pcp.count(MigrateType::Movable) >= PCP_LOW);
+    println!("test:    SUCCESS - drained {} then {} pages", PCP_BATCH, 2 * PCP_BATCH);
+
+    // 4. 取回缓存中的页并还给全局分配器
+    println!("test: 4. Testing cleanup...");
+    let cached = pcp.count(MigrateType::Movable);
+    for i in 0..cached {
+        frames[i] = pcp_alloc(&mut pcp);
+    }
+    assert_eq!(pcp.total_count(), 0);
+    for i in 0..cached {
+        dealloc_frame(PhysFrame::new(frames[i]));
+    }
+    assert_eq!(free_frames(), base);
+    println!("test:    SUCCESS - all {} pages returned", NR_FRAMES);
+
+    // 5. 全局接口：清空后第一次分配补充，第二次命中；drain_local_pages 清空本 CPU 缓存
+    println!("test: 5. Testing per-CPU interface and local drain...");
+    let cpu = crate::arch::cpu_id() as usize;
+    drain_local_pages();
+    let before = pcp_stats().cpu_stats[cpu];
+    assert_eq!(before.counts, [0; 3]);
+    let a = alloc_page_pcp(MigrateType::Movable).expect("alloc_page_pcp failed");
+    let b = alloc_page_pcp(MigrateType::Movable).expect("alloc_page_pcp failed");
+    let stats = pcp_stats().cpu_stats[cpu];
+    assert_eq!((stats.refills - before.refills, stats.hits - before.hits), (1, 1));
+    free_page_pcp(a, MigrateType::Movable);
+    free_page_pcp(b, MigrateType::Movable);
+    assert!(pcp_stats().cpu_stats[cpu].counts[MigrateType::Movable as usize] > 0);
+    drain_local_pages();
+    assert_eq!(pcp_stats().cpu_stats[cpu].counts, [0; 3]);
+    println!("test:    SUCCESS - refill, hit and local drain counted on cpu {}", cpu);
+
+    // 6. drain_all_pages 在其他 CPU 完成或等待超时后返回
+    println!("test: 6. Testing drain_all_pages...");
+    let a = alloc_page_pcp(MigrateType::Movable).expect("alloc_page_pcp failed");
+    free_page_pcp(a, MigrateType::Movable);
+    drain_all_pages();
+    assert_eq!(pcp_stats().cpu_stats[cpu].counts, [0; 3]);
+    println!("test:    SUCCESS - caches drained");
+
+    // 7. 每 PCP_DECAY_TICKS 个 tick 高水位向 PCP_HIGH_MIN 衰减 1/8
+    println!("test: 7. Testing high watermark decay...");
+    let high = pcp_stats().cpu_stats[cpu].high;
+    for _ in 0..100 {
+        pcp_tick();
+    }
+    let expected = if high > PCP_HIGH_MIN { high - ((high - PCP_HIGH_MIN) / 8).max(1) } else { high };
+    assert_eq!(pcp_stats().cpu_stats[cpu].high, expected);
+    println!("test:    SUCCESS - high watermark {} -> {}", high, expected);
+
+    println!("test: ===== Per-CPU Page Cache Tests Completed =====");
+}
@@ -0,0 +1,68 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：每 CPU 变量
+//
+// 测试内容：
+// 1. tp 指向本 CPU 的数据区，cpu_id() 读出的编号与数据区一致
+// 2. 各 CPU 的数据区按缓存行对齐，互不重叠
+// 3. 修改本 CPU 的副本不影响其他 CPU 的副本
+// 4. need_resched 标志保存在本 CPU 的数据区
+
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+use crate::arch::riscv64::percpu::*;
+use crate::config::MAX_CPUS;
+use crate::println;
+
+crate::percpu! {
+    static TEST_COUNTER: AtomicUsize = AtomicUsize::new(7);
+}
+
+pub fn test_percpu() {
+    println!("test: ===== Testing Per-CPU Variables =====");
+
+    let cpu = crate::arch::cpu_id();
+
+    // 测试 1: 本 CPU 的数据区
+    println!("test: 1. Testing this CPU's area...");
+    assert!(cpu < MAX_CPUS);
+    assert_eq!(TEST_COUNTER.this_cpu_ptr(), TEST_COUNTER.per_cpu_ptr(cpu));
+    assert_eq!(unsafe { *(this_cpu_base() as *const usize) }, cpu);
+    println!("test:    SUCCESS - tp points at CPU {}'s area", cpu);
+
+    // 测试 2: 对齐与间隔
+    println!("test: 2. Testing area alignment...");
+    let size = percpu_size();
+    assert!(size > 0 && size % PERCPU_ALIGN == 0);
+    assert_eq!(this_cpu_base() % PERCPU_ALIGN, 0);
+    for i in 1..MAX_CPUS {
+        let delta = TEST_COUNTER.per_cpu_ptr(i) as usize - TEST_COUNTER.per_cpu_ptr(i - 1) as usize;
+        assert_eq!(delta, size);
+        assert_eq!(per_cpu_offset(i) - per_cpu_offset(i - 1), size);
+    }
+    println!("test:    SUCCESS - {} byte areas are cache line aligned", size);
+
+    // 测试 3: 各 CPU 的副本独立
+    println!("test: 3. Testing independent copies...");
+    let other = (cpu + 1) % MAX_CPUS;
+    let before = TEST_COUNTER.per_cpu(other).load(Ordering::Relaxed);
+    let old = TEST_COUNTER.this_cpu().fetch_add(1, Ordering::Relaxed);
+    assert_eq!(TEST_COUNTER.per_cpu(cpu).load(Ordering::Relaxed), old + 1);
+    if other != cpu {
+        assert_eq!(TEST_COUNTER.per_cpu(other).load(Ordering::Relaxed), before);
+    }
+    TEST_COUNTER.this_cpu().store(old, Ordering::Relaxed);
+    println!("test:    SUCCESS - updates stay on this CPU");
+
+    // 测试 4: need_resched
+    println!("test: 4. Testing need_resched flag...");
+    // 置位后由下一次调度清除，不影响后续测试
+    crate::sched::set_need_resched();
+    assert!(crate::sched::need_resched());
+    println!("test:    SUCCESS - flag is read back from this CPU's area");
+
+    println!("test: Per-CPU testing completed.");
+}
@@ -0,0 +1,55 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 每 CPU 近似计数器单元测试
+//!
+//! 小于 batch 的增量留在本 CPU 的槽里、sum 总是准确、达到 batch 时并入全局计数、
+//! compare 在近似值足以判断时不求和、set 清空各槽
+
+use core::cmp::Ordering;
+
+use crate::println;
+use crate::percpu_counter::{PercpuCounter, PERCPU_COUNTER_BATCH};
+
+#[cfg(feature = "unit-test")]
+pub fn test_percpu_counter() {
+    println!("test: ===== Starting Percpu Counter Tests =====");
+
+    // 1. 小增量只记在本 CPU 的槽里
+    println!("test: 1. Testing small deltas stay per-CPU...");
+    let counter = PercpuCounter::new(1000);
+    counter.add(5);
+    counter.sub(2);
+    assert_eq!(counter.read(), 1000);
+    assert_eq!(counter.sum(), 1003);
+    println!("test:    SUCCESS - read() = 1000, sum() = 1003");
+
+    // 2. 槽达到 batch 时并入全局计数
+    println!("test: 2. Testing fold at batch...");
+    counter.add(PERCPU_COUNTER_BATCH);
+    assert_eq!(counter.read(), 1003 + PERCPU_COUNTER_BATCH);
+    assert_eq!(counter.sum(), 1003 + PERCPU_COUNTER_BATCH);
+    for _ in 0..10 * PERCPU_COUNTER_BATCH {
+        counter.sub(1);
+    }
+    assert_eq!(counter.sum(), 1003 - 9 * PERCPU_COUNTER_BATCH);
+    assert!((counter.read() - counter.sum()).abs() < PERCPU_COUNTER_BATCH);
+    println!("test:    SUCCESS - deltas folded into the global count");
+
+    // 3. 比较与非负读取
+    println!("test: 3. Testing compare and positive reads...");
+    let exact = counter.sum();
+    assert_eq!(counter.compare(exact), Ordering::Equal);
+    assert_eq!(counter.compare(exact + 1), Ordering::Less);
+    assert_eq!(counter.compare(exact - 1), Ordering::Greater);
+    assert_eq!(counter.compare(i64::MIN / 2), Ordering::Greater);
+    counter.set(-3);
+    assert_eq!(counter.sum(), -3);
+    assert_eq!(counter.sum_positive(), 0);
+    assert_eq!(counter.read_positive(), 0);
+    println!("test:    SUCCESS - compare, set and positive reads");
+
+    println!("test: ===== Percpu Counter Tests Completed =====");
+}
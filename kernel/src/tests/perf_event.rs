@@ -0,0 +1,154 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：perf 计数事件
+//
+// 测试内容：
+// 1. perf_event_open 参数检查：不认识的事件、采样、exclude_*、缺少目标
+// 2. CPU 事件计数 instructions 与缺页，disable 后计数冻结，reset 清零
+// 3. read 按 read_format 返回计数、使能时间、计数时间与 ID
+// 4. 任务事件只统计任务在 CPU 上的时间，关闭后从任务上摘下
+
+use alloc::boxed::Box;
+
+use crate::errno::Errno;
+use crate::perf_event::*;
+use crate::println;
+use crate::process::task::{SchedPolicy, Task, TaskState};
+
+fn attr(type_: u32, config: u64) -> PerfEventAttr {
+    PerfEventAttr { type_, size: PERF_ATTR_SIZE_VER0, config, ..Default::default() }
+}
+
+/// 通过文件读取 read_format 选中的各个字
+fn read_words(file: &crate::fs::file::File, words: &mut [u64]) -> isize {
+    let mut buf = [0u8; 32];
+    let len = unsafe { file.read(buf.as_mut_ptr(), buf.len()) };
+    for (word, chunk) in words.iter_mut().zip(buf.chunks_exact(8)) {
+        *word = u64::from_ne_bytes([chunk[0], chunk[1], chunk[2], chunk[3], chunk[4], chunk[5], chunk[6], chunk[7]]);
+    }
+    len
+}
+
+pub fn test_perf_event() {
+    println!("test: ===== Testing perf_event =====");
+
+    let cpu = crate::arch::cpu_id() as i32;
+
+    // 测试 1: 参数检查
+    println!("test: 1. Testing perf_event_open argument checks...");
+    let err = |result: Result<alloc::sync::Arc<PerfEvent>, i32>| result.err().unwrap_or(0);
+    assert_eq!(err(perf_event_create(&attr(7, 0), -1, cpu)), Errno::NoSuchFileOrDirectory.as_neg_i32());
+    assert_eq!(err(perf_event_create(&attr(PERF_TYPE_SOFTWARE, 99), -1, cpu)), Errno::NoSuchFileOrDirectory.as_neg_i32());
+    let mut sampling = attr(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    sampling.sample_period = 1000;
+    assert_eq!(err(perf_event_create(&sampling, -1, cpu)), Errno::OperationNotSupported.as_neg_i32());
+    let mut user_only = attr(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    user_only.flags = 1 << 5;  // exclude_kernel
+    assert_eq!(err(perf_event_create(&user_only, -1, cpu)), Errno::OperationNotSupported.as_neg_i32());
+    let mut grouped = attr(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    grouped.read_format = 1 << 3;  // PERF_FORMAT_GROUP
+    assert_eq!(err(perf_event_create(&grouped, -1, cpu)), Errno::InvalidArgument.as_neg_i32());
+    let cycles = attr(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    assert_eq!(err(perf_event_create(&cycles, -1, -1)), Errno::InvalidArgument.as_neg_i32());
+    assert_eq!(err(perf_event_create(&cycles, -1, crate::config::MAX_CPUS as i32)), Errno::InvalidArgument.as_neg_i32());
+    assert_eq!(err(perf_event_create(&cycles, 999999, -1)), Errno::NoSuchProcess.as_neg_i32());
+    println!("test:    SUCCESS - bad events, sampling and bad targets rejected");
+
+    // 测试 2: CPU 事件
+    println!("test: 2. Testing per-CPU counting...");
+    let insns = perf_event_create(&attr(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS), -1, cpu).expect("instructions");
+    let faults = perf_event_create(&attr(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS), -1, cpu).expect("page-faults");
+    let mut sum = 0u64;
+    for i in 0..1000u64 {
+        sum = core::hint::black_box(sum.wrapping_add(i));
+    }
+    for _ in 0..3 {
+        perf_sw_page_fault();
+    }
+    let (count, _, _) = insns.read_value();
+    assert!(count >= 1000);
+    assert_eq!(faults.read_value().0, 3);
+    faults.disable();
+    perf_sw_page_fault();
+    assert_eq!(faults.read_value().0, 3);
+    faults.enable();
+    perf_sw_page_fault();
+    assert_eq!(faults.read_value().0, 4);
+    faults.reset();
+    assert_eq!(faults.read_value().0, 0);
+    println!("test:    SUCCESS - {} instructions, page faults frozen while disabled", count);
+
+    // 测试 3: read_format
+    println!("test: 3. Testing read() and read_format...");
+    let mut timed = attr(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+    timed.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING | PERF_FORMAT_ID;
+    let event = perf_event_create(&timed, -1, cpu).expect("page-faults");
+    let id = event.id();
+    perf_sw_page_fault();
+    let file = perf_event_create_file(event);
+    assert!(file_perf_event(&file).is_some());
+    let mut words = [0u64; 4];
+    assert_eq!(read_words(&file, &mut words), 32);
+    assert_eq!(words[0], 1);
+    assert!(words[1] >= words[2]);
+    assert_eq!(words[3], id);
+    let mut short = [0u8; 16];
+    assert_eq!(unsafe { file.read(short.as_mut_ptr(), short.len()) }, Errno::NoSpaceLeftOnDevice.as_neg_i32() as isize);
+    crate::fs::file::fput(file);
+    println!("test:    SUCCESS - count {}, enabled {}ns, running {}ns", words[0], words[1], words[2]);
+
+    // 测试 4: 任务事件
+    println!("test: 4. Testing per-task counting across switches...");
+    let mut pid = 0;
+    crate::sched::sched::for_each_task(|task| unsafe {
+        let task = &*task;
+        if pid == 0 && task.pid() != 0 && task.state() != TaskState::Zombie
+            && !crate::sched::task_curr(task as *const Task)
+        {
+            pid = task.pid();
+        }
+    });
+    if pid != 0 {
+        let mut timed = attr(PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS);
+        timed.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        let event = perf_event_create(&timed, pid as i32, -1).expect("task event");
+        // 任务没有运行时不计数
+        perf_sw_page_fault();
+        assert_eq!(event.read_value().0, 0);
+
+        // 模拟任务在本 CPU 上运行一段时间
+        let other = Box::new(Task::new(4243, SchedPolicy::Normal));
+        let switch = |to_task: bool| {
+            let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+            crate::sched::sched::with_task(pid, |task| {
+                if to_task {
+                    perf_event_task_switch(cpu as usize, &other, task);
+                } else {
+                    perf_event_task_switch(cpu as usize, task, &other);
+                }
+            });
+        };
+        switch(true);
+        perf_sw_page_fault();
+        perf_sw_page_fault();
+        switch(false);
+        perf_sw_page_fault();
+        let (count, enabled, running) = event.read_value();
+        assert_eq!(count, 2);
+        assert!(running <= enabled);
+
+        // 关闭后从任务上摘下，之后的切换不再碰它
+        let file = perf_event_create_file(event);
+        crate::fs::file::fput(file);
+        switch(true);
+        switch(false);
+        println!("test:    SUCCESS - pid {}: count {}, running {}ns of {}ns", pid, count, running, enabled);
+    } else {
+        println!("test:    SKIP - no task to attach to");
+    }
+
+    println!("test: perf_event testing completed.");
+}
@@ -8,8 +8,16 @@
 //! - 基本 pipe2 功能
 //! - O_CLOEXEC 标志（TODO）
 //! - O_NONBLOCK 标志（TODO）
+//! - 页槽环：小写入合并到同一页、F_SETPIPE_SZ、splice 挂入页引用
 
 use crate::println;
+use crate::fs::create_pipe;
+use crate::fs::pipe::{pipe_fcntl, pipe_splice_page, PIPE_DEF_BUFFERS};
+use crate::mm::page_desc::pfn_to_page;
+use crate::mm::PAGE_SIZE;
+use crate::process::wait::{WaitQueueEntry, WaitQueueHead, WakeUpHint};
+use alloc::sync::Arc;
+use alloc::vec;
 
 pub fn test_pipe2() {
     println!("test: ===== Starting pipe2() System Call Tests =====");
@@ -22,6 +30,13 @@ pub fn test_pipe2() {
     println!("test: 2. Testing pipe2 with flags...");
     test_pipe2_flags();
 
+    // 测试 3: 页槽环
+    println!("test: 3. Testing page-slot pipe ring...");
+    test_pipe_pages();
+
+    println!("test: 4. Testing intrusive wait queue...");
+    test_wait_queue();
+
     println!("test: ===== pipe2() Tests Completed =====");
 }
 
@@ -43,3 +58,84 @@ fn test_pipe2_flags() {
     println!("test:    Note: Flags are accepted but implementation is pending");
     println!("test:    SUCCESS - pipe2 accepts flags parameter");
 }
+
+fn test_pipe_pages() {
+    let (mut read_file, mut write_file) = create_pipe();
+    assert_eq!(pipe_fcntl(&read_file, None), Ok(PIPE_DEF_BUFFERS * PAGE_SIZE));
+
+    // 小写入追加到同一页
+    for _ in 0..3 {
+        assert_eq!(unsafe { write_file.write(b"abc".as_ptr(), 3) }, 3);
+    }
+    let mut buf = [0u8; 16];
+    assert_eq!(unsafe { read_file.read(buf.as_mut_ptr(), buf.len()) }, 9);
+    assert_eq!(&buf[..9], b"abcabcabc");
+    println!("test:    SUCCESS - small writes merge into one page");
+
+    // 容量取整为 2 的幂个页；已有数据多于新容量时不能缩小
+    assert_eq!(pipe_fcntl(&write_file, Some(5 * PAGE_SIZE)), Ok(8 * PAGE_SIZE));
+    let data = vec![0x42u8; 8 * PAGE_SIZE];
+    assert_eq!(unsafe { write_file.write(data.as_ptr(), data.len()) }, data.len() as isize);
+    assert_eq!(pipe_fcntl(&write_file, Some(PAGE_SIZE)), Err(-16));
+    let mut out = vec![0u8; 8 * PAGE_SIZE];
+    assert_eq!(unsafe { read_file.read(out.as_mut_ptr(), out.len()) }, out.len() as isize);
+    assert!(out.iter().all(|&b| b == 0x42));
+    assert_eq!(pipe_fcntl(&write_file, Some(PAGE_SIZE)), Ok(PAGE_SIZE));
+    println!("test:    SUCCESS - F_SETPIPE_SZ resizes the ring");
+
+    // splice 只挂入页引用，读完后归还
+    let frame = crate::mm::pcp::alloc_user_page().expect("alloc page failed");
+    let phys = frame.start_address().as_usize();
+    unsafe { core::ptr::write_bytes(phys as *mut u8, 0x77, PAGE_SIZE) };
+    assert_eq!(pipe_splice_page(&write_file, phys, 100, 200), 200);
+    assert_eq!(unsafe { (*pfn_to_page(phys / PAGE_SIZE)).refcount() }, 2);
+    assert_eq!(unsafe { read_file.read(buf.as_mut_ptr(), buf.len()) }, 16);
+    assert!(buf.iter().all(|&b| b == 0x77));
+    assert_eq!(unsafe { read_file.read(out.as_mut_ptr(), out.len()) }, 184);
+    assert_eq!(unsafe { (*pfn_to_page(phys / PAGE_SIZE)).refcount() }, 1);
+    crate::mm::filemap::put_page(phys);
+    println!("test:    SUCCESS - spliced pages are referenced, not copied");
+
+    unsafe {
+        if let Some(file) = Arc::get_mut(&mut read_file) {
+            file.close();
+        }
+        if let Some(file) = Arc::get_mut(&mut write_file) {
+            file.close();
+        }
+    }
+}
+
+fn test_wait_queue() {
+    let queue = WaitQueueHead::new();
+    assert!(!queue.has_waiters());
+    assert_eq!(queue.wake_up_all(), 0);
+
+    // 项在栈上链入，不分配；非独占项在前，独占项在后
+    let task = core::ptr::null_mut();
+    let shared1 = WaitQueueEntry::new(task, false);
+    let shared2 = WaitQueueEntry::new(task, false);
+    let exclusive = WaitQueueEntry::new(task, true);
+    queue.add(&exclusive);
+    queue.add(&shared1);
+    queue.add(&shared2);
+    queue.add(&shared2);
+    assert!(queue.has_waiters());
+    println!("test:    SUCCESS - entries linked without allocation");
+
+    assert_eq!(queue.wake_up(WakeUpHint::Async, 2), 2);
+    assert!(shared1.is_woken() && shared2.is_woken() && !exclusive.is_woken());
+    // 已唤醒的项不重复唤醒
+    assert_eq!(queue.wake_up(WakeUpHint::Async, 0), 1);
+    assert!(exclusive.is_woken());
+    println!("test:    SUCCESS - wake_up skips already woken entries");
+
+    queue.remove(&shared2);
+    queue.remove(&exclusive);
+    queue.remove(&exclusive);
+    assert!(queue.has_waiters());
+    queue.remove(&shared1);
+    assert!(!queue.has_waiters());
+    assert_eq!(queue.wake_up_all(), 0);
+    println!("test:    SUCCESS - has_waiters tracks add / remove");
+}
@@ -0,0 +1,105 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：内核抢占计数
+//
+// 测试内容：
+// 1. preempt_disable / preempt_enable 嵌套计数
+// 2. 自旋锁、读写锁和关中断守卫持有期间计数加一
+// 3. 持有锁或 PreemptGuard 时不可抢占，cond_resched 不调度
+// 4. 计数归零时 preempt_enable 处理重新调度请求
+// 5. 调度前后本任务的计数不变
+
+use crate::println;
+use crate::sched::{self, preempt_count, preempt_disable, preempt_enable, preempt_enable_no_resched, PreemptGuard};
+use crate::sync::{RwLock, TicketLock};
+
+static TEST_LOCK: TicketLock<u32> = TicketLock::new(0);
+static TEST_RWLOCK: RwLock<u32> = RwLock::new(0);
+
+pub fn test_preempt() {
+    println!("test: ===== Testing Kernel Preemption =====");
+
+    let base = preempt_count();
+
+    // 测试 1: 嵌套
+    println!("test: 1. Testing preempt_disable nesting...");
+    preempt_disable();
+    preempt_disable();
+    assert_eq!(preempt_count(), base + 2);
+    preempt_enable_no_resched();
+    assert_eq!(preempt_count(), base + 1);
+    preempt_enable();
+    assert_eq!(preempt_count(), base);
+    println!("test:    SUCCESS - count nests and unwinds");
+
+    // 测试 2: 锁
+    println!("test: 2. Testing lock guards...");
+    {
+        let _guard = TEST_LOCK.lock();
+        assert_eq!(preempt_count(), base + 1);
+        assert!(TEST_LOCK.try_lock().is_none());
+        assert_eq!(preempt_count(), base + 1);
+    }
+    assert_eq!(preempt_count(), base);
+    {
+        let _guard = TEST_LOCK.lock_irqsave();
+        assert_eq!(preempt_count(), base + 2);
+    }
+    assert_eq!(preempt_count(), base);
+    {
+        let _r1 = TEST_RWLOCK.read();
+        let _r2 = TEST_RWLOCK.read();
+        assert_eq!(preempt_count(), base + 2);
+        assert!(TEST_RWLOCK.try_write().is_none());
+        assert_eq!(preempt_count(), base + 2);
+    }
+    {
+        let _w = TEST_RWLOCK.write();
+        assert_eq!(preempt_count(), base + 1);
+    }
+    assert_eq!(preempt_count(), base);
+    println!("test:    SUCCESS - spinlock, rwlock and irq guards counted");
+
+    // 测试 3: 不可抢占区段
+    println!("test: 3. Testing non-preemptible sections...");
+    {
+        let _guard = PreemptGuard::new();
+        assert!(!sched::preemptible());
+        sched::set_need_resched();
+        assert!(!sched::cond_resched());
+        assert!(sched::need_resched());
+    }
+    {
+        let _guard = TEST_LOCK.lock();
+        assert!(!sched::preemptible());
+        assert!(!sched::cond_resched());
+    }
+    println!("test:    SUCCESS - no reschedule while preemption is disabled");
+
+    // 测试 4: 计数归零时调度
+    println!("test: 4. Testing preempt_enable reschedule...");
+    if sched::preemptible() {
+        sched::set_need_resched();
+        {
+            let _guard = TEST_LOCK.lock();
+            assert!(sched::need_resched());
+        }
+        assert!(!sched::need_resched());
+        println!("test:    SUCCESS - pending reschedule handled on unlock");
+    } else {
+        println!("test:    SKIP - caller is not preemptible (count={})", preempt_count());
+    }
+
+    // 测试 5: 跨调度保存
+    println!("test: 5. Testing count across schedule...");
+    for _ in 0..4 {
+        sched::schedule();
+        assert_eq!(preempt_count(), base);
+    }
+    println!("test:    SUCCESS - count restored after switching back");
+
+    println!("test: Kernel preemption testing completed.");
+}
@@ -0,0 +1,72 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 预清零页池单元测试
+//!
+//! clear_page 清零整页、空闲循环补充池、GFP_ZERO 分配取得全零的页、直接回收归还池中的页
+
+use crate::println;
+use crate::arch::riscv64::cpu::clear_page;
+use crate::mm::page::PAGE_SIZE;
+use crate::mm::pcp::{alloc_user_page, free_user_page};
+use crate::mm::prezero::{alloc_zeroed_user_page, drain_zero_pool, prezero_run, zero_pool_stats};
+
+fn is_zero(addr: usize) -> bool {
+    unsafe { core::slice::from_raw_parts(addr as *const u8, PAGE_SIZE) }.iter().all(|&byte| byte == 0)
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_prezero() {
+    println!("test: ===== Starting Pre-zeroed Page Pool Tests =====");
+
+    // 1. clear_page
+    println!("test: 1. Testing clear_page...");
+    match alloc_user_page() {
+        Some(frame) => {
+            let addr = frame.start_address().as_usize();
+            unsafe {
+                core::ptr::write_bytes(addr as *mut u8, 0xa5, PAGE_SIZE);
+                clear_page(addr);
+            }
+            assert!(is_zero(addr), "clear_page left non-zero bytes");
+            free_user_page(frame);
+            println!("test:    SUCCESS - whole page cleared");
+        }
+        None => println!("test:    SKIP - no free pages"),
+    }
+
+    // 2. 空闲循环补充池，分配取得全零的页
+    println!("test: 2. Testing pool refill and zeroed allocation...");
+    prezero_run();
+    let before = zero_pool_stats();
+    match alloc_zeroed_user_page() {
+        Some(frame) => {
+            let after = zero_pool_stats();
+            assert_eq!(after.hits + after.misses, before.hits + before.misses + 1);
+            assert!(is_zero(frame.start_address().as_usize()), "zeroed allocation returned dirty page");
+            // 弄脏后释放，不会回到池中
+            unsafe { *(frame.start_address().as_usize() as *mut u8) = 1 };
+            free_user_page(frame);
+            println!("test:    SUCCESS - zeroed page from the {} ({} pages pooled)",
+                     if after.hits > before.hits { "pool" } else { "allocator" }, before.nr_pages);
+        }
+        None => println!("test:    SKIP - no free pages"),
+    }
+
+    // 3. 直接回收归还池中的页
+    println!("test: 3. Testing pool drain...");
+    prezero_run();
+    let pooled = zero_pool_stats().nr_pages;
+    // 其他空闲的 CPU 可能同时在补充
+    let drained = drain_zero_pool();
+    assert!(drained > 0 || pooled == 0);
+    if let Some(frame) = alloc_zeroed_user_page() {
+        assert!(is_zero(frame.start_address().as_usize()));
+        free_user_page(frame);
+    }
+    println!("test:    SUCCESS - {} pooled pages returned to the allocator", drained);
+
+    println!("test: ===== Pre-zeroed Page Pool Tests Completed =====");
+}
@@ -0,0 +1,102 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：printk 日志缓冲区
+//
+// 测试内容：
+// 1. 写入的日志按序号读回，保留级别、时间戳与换行标志
+// 2. 控制台级别：CONSOLE_OFF 保存并降低级别，CONSOLE_ON 恢复
+// 3. syslog 格式：整行带 `<级别>[秒.微秒]` 前缀，续写的片段不带前缀
+// 4. /proc/kmsg 读取即消费
+// 5. 写满描述符环后最旧的日志被覆盖，读取得到 Lost
+
+use crate::printk::{self, LogRead, LOGLEVEL_DEBUG, LOGLEVEL_INFO, LOG_DESCS};
+use crate::println;
+
+fn contains(haystack: &[u8], needle: &[u8]) -> bool {
+    haystack.windows(needle.len()).any(|window| window == needle)
+}
+
+pub fn test_printk() {
+    println!("test: ===== Testing printk =====");
+
+    let saved_level = printk::console_loglevel();
+
+    // 测试 1: 写入与读回
+    println!("test: 1. Testing log_store and log_read...");
+    let start = printk::log_next_seq();
+    crate::printk_level!(LOGLEVEL_DEBUG, "printk-test record {}", 1);
+    let mut found = None;
+    for seq in start..printk::log_next_seq() {
+        if let LogRead::Record(record) = printk::log_read(seq) {
+            if record.text == b"printk-test record 1\n" {
+                found = Some(record);
+            }
+        }
+    }
+    let record = found.expect("record stored");
+    assert_eq!(record.level, LOGLEVEL_DEBUG);
+    assert!(record.newline);
+    assert!(matches!(printk::log_read(printk::log_next_seq() + 1), LogRead::Empty));
+    println!("test:    SUCCESS - record stored at {}ns", record.ts_nsec);
+
+    // 测试 2: 控制台级别
+    println!("test: 2. Testing console log level...");
+    printk::console_off();
+    assert_eq!(printk::console_loglevel(), printk::CONSOLE_LOGLEVEL_MIN);
+    printk::console_off();
+    printk::console_on();
+    assert_eq!(printk::console_loglevel(), saved_level);
+    printk::set_console_loglevel(LOGLEVEL_INFO);
+    crate::pr_info!("printk-test hidden from console");
+    printk::set_console_loglevel(saved_level);
+    println!("test:    SUCCESS - console level {} restored", saved_level);
+
+    // 测试 3: syslog 格式
+    println!("test: 3. Testing syslog formatting...");
+    printk::syslog_clear();
+    crate::pr_info!("printk-test line {}", 42);
+    crate::print!("printk-test part1 ");
+    crate::print!("part2\n");
+    let all = printk::syslog_read_all(4096);
+    assert!(contains(&all, b"<6>["));
+    assert!(contains(&all, b"] printk-test line 42\n"));
+    assert!(contains(&all, b"] printk-test part1 part2\n"));
+    assert!(!contains(&all, b"printk-test hidden"));
+    // 只放得下最新的日志时丢掉旧的
+    let tail = printk::syslog_read_all(40);
+    assert!(tail.len() <= 40);
+    assert!(contains(&tail, b"part2\n") || tail.is_empty());
+    println!("test:    SUCCESS - {} bytes since clear", all.len());
+
+    // 测试 4: /proc/kmsg
+    println!("test: 4. Testing /proc/kmsg...");
+    let _ = crate::fs::procfs::read_file("/kmsg").expect("/proc/kmsg exists");
+    crate::printk_deferred!("printk-test kmsg");
+    let kmsg = crate::fs::procfs::read_file("/kmsg").expect("/proc/kmsg exists");
+    assert!(contains(&kmsg, b"printk-test kmsg\n"));
+    assert_eq!(printk::syslog_unread_size(), 0);
+    let again = crate::fs::procfs::read_file("/kmsg").expect("/proc/kmsg exists");
+    assert!(!contains(&again, b"printk-test kmsg"));
+    println!("test:    SUCCESS - {} bytes consumed", kmsg.len());
+
+    // 测试 5: 覆盖
+    println!("test: 5. Testing overwrite...");
+    let first = printk::log_next_seq();
+    for i in 0..LOG_DESCS + 10 {
+        printk::log_store(LOGLEVEL_DEBUG, alloc::format!("printk-test fill {}\n", i).as_bytes());
+    }
+    assert!(matches!(printk::log_read(first), LogRead::Lost));
+    let last = printk::log_next_seq() - 1;
+    match printk::log_read(last) {
+        LogRead::Record(record) => assert_eq!(record.text, alloc::format!("printk-test fill {}\n", LOG_DESCS + 9).as_bytes()),
+        _ => panic!("newest record readable"),
+    }
+    printk::console_flush();
+    printk::syslog_clear();
+    println!("test:    SUCCESS - oldest of {} records overwritten", LOG_DESCS + 10);
+
+    println!("test: printk testing completed.");
+}
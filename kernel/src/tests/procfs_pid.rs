@@ -0,0 +1,137 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：/proc/<pid> 下的进程信息
+//
+// 测试内容：
+// 1. 任务名截断与读写、缺页计数的记账
+// 2. /proc/self 是指向当前线程组 PID 的符号链接
+// 3. /proc/<pid>/stat 有 52 个字段，status 与 io 的格式
+// 4. maps 与 smaps 的 VMA 一一对应，驻留大小不超过 VMA 大小
+// 5. 不存在的 PID 返回 None，目录列出所有文件
+
+use alloc::boxed::Box;
+use alloc::string::String;
+use alloc::vec::Vec;
+use core::sync::atomic::Ordering;
+
+use crate::fs::procfs;
+use crate::println;
+use crate::process::task::{SchedPolicy, Task, TASK_COMM_LEN};
+
+/// 读取 /proc 文件为字符串
+fn read_proc(path: &str) -> String {
+    let data = procfs::read_file(path).unwrap_or_default();
+    String::from_utf8(data).unwrap_or_default()
+}
+
+/// 找一个普通的线程组首任务；want_mm 为真时要求有地址空间
+fn find_process(want_mm: bool) -> u32 {
+    let mut pid = 0;
+    crate::sched::sched::for_each_task(|task| unsafe {
+        let task = &*task;
+        if pid == 0 && task.pid() != 0 && task.pid() == task.tgid()
+            && (!want_mm || task.address_space().is_some())
+        {
+            pid = task.pid();
+        }
+    });
+    pid
+}
+
+pub fn test_procfs_pid() {
+    println!("test: ===== Testing /proc/<pid> =====");
+
+    // 测试 1: 任务名与记账
+    println!("test: 1. Testing comm and accounting...");
+    let task = Box::new(Task::new(4242, SchedPolicy::Normal));
+    assert_eq!(task.comm(), "");
+    task.set_comm(b"a-very-long-command-name");
+    assert_eq!(task.comm().len(), TASK_COMM_LEN - 1);
+    assert_eq!(task.comm(), "a-very-long-com");
+    task.account_read(10);
+    task.account_read(-9);
+    task.account_write(3);
+    task.account_fault();
+    assert_eq!(task.acct.syscr.load(Ordering::Relaxed), 2);
+    assert_eq!(task.acct.rchar.load(Ordering::Relaxed), 10);
+    assert_eq!(task.acct.syscw.load(Ordering::Relaxed), 1);
+    assert_eq!(task.acct.wchar.load(Ordering::Relaxed), 3);
+    assert_eq!(task.acct.min_flt.load(Ordering::Relaxed), 1);
+    println!("test:    SUCCESS - comm truncated, reads, writes and faults counted");
+
+    // 测试 2: /proc/self
+    println!("test: 2. Testing /proc/self...");
+    let node = procfs::get_procfs_sb().and_then(|sb| sb.lookup("/self")).expect("/proc/self exists");
+    assert!(node.is_symlink());
+    let tgid = crate::sched::current().map(|task| task.tgid()).unwrap_or(0);
+    assert_eq!(read_proc("/self"), alloc::format!("{}", tgid));
+    let root = procfs::list_dir("/").unwrap_or_default();
+    assert!(root.iter().any(|(name, _, _)| name.as_slice() == b"self"));
+    println!("test:    SUCCESS - /proc/self -> {}", tgid);
+
+    // 测试 3: stat、status、io
+    println!("test: 3. Testing /proc/<pid>/stat, status and io...");
+    let pid = find_process(false);
+    if pid != 0 {
+        let stat = read_proc(&alloc::format!("/{}/stat", pid));
+        let (head, tail) = stat.rsplit_once(')').expect("comm is parenthesized");
+        assert!(head.starts_with(&alloc::format!("{} (", pid)));
+        assert_eq!(tail.split_whitespace().count() + 2, 52);
+        let status = read_proc(&alloc::format!("/{}/status", pid));
+        assert!(status.starts_with("Name:\t"));
+        assert!(status.lines().any(|line| line == alloc::format!("Pid:\t{}", pid)));
+        assert!(status.lines().any(|line| line.starts_with("voluntary_ctxt_switches:\t")));
+        let io = read_proc(&alloc::format!("/{}/io", pid));
+        let keys: Vec<&str> = io.lines().filter_map(|line| line.split_once(": ").map(|(key, _)| key)).collect();
+        assert_eq!(keys, ["rchar", "wchar", "syscr", "syscw", "read_bytes", "write_bytes", "cancelled_write_bytes"]);
+        println!("test:    SUCCESS - pid {}: {}", pid, head);
+    } else {
+        println!("test:    SKIP - no process to inspect");
+    }
+
+    // 测试 4: maps 与 smaps
+    println!("test: 4. Testing /proc/<pid>/maps and smaps...");
+    let pid = find_process(true);
+    if pid != 0 {
+        let maps = read_proc(&alloc::format!("/{}/maps", pid));
+        let smaps = read_proc(&alloc::format!("/{}/smaps", pid));
+        let headers: Vec<&str> = smaps
+            .lines()
+            .filter(|line| line.split_whitespace().next().map_or(false, |range| range.contains('-')))
+            .collect();
+        let nr_vmas = maps.lines().count();
+        assert!(nr_vmas > 0);
+        assert_eq!(headers.len(), nr_vmas);
+        let kb = |line: &str| line.split_whitespace().nth(1).and_then(|v| v.parse::<u64>().ok()).unwrap_or(0);
+        let sizes: Vec<u64> = smaps.lines().filter(|line| line.starts_with("Size:")).map(kb).collect();
+        let rss: Vec<u64> = smaps.lines().filter(|line| line.starts_with("Rss:")).map(kb).collect();
+        assert_eq!(sizes.len(), nr_vmas);
+        for (size, rss) in sizes.iter().zip(rss.iter()) {
+            assert!(rss <= size);
+        }
+        println!("test:    SUCCESS - pid {}: {} VMAs, {} kB resident", pid, nr_vmas, rss.iter().sum::<u64>());
+    } else {
+        println!("test:    SKIP - no process with an address space");
+    }
+
+    // 测试 5: 不存在的 PID 与目录
+    println!("test: 5. Testing missing PIDs and directory listing...");
+    for name in ["stat", "status", "maps", "smaps", "io"] {
+        assert_eq!(procfs::read_file(&alloc::format!("/999999/{}", name)), None);
+    }
+    let pid = find_process(false);
+    if pid != 0 {
+        let dir = procfs::list_dir(&alloc::format!("/{}", pid)).unwrap_or_default();
+        for name in ["stat", "status", "maps", "smaps", "io", "schedstat"] {
+            assert!(dir.iter().any(|(entry, _, _)| entry.as_slice() == name.as_bytes()));
+        }
+        println!("test:    SUCCESS - /proc/{} lists {} entries", pid, dir.len());
+    } else {
+        println!("test:    SKIP - no process to list");
+    }
+
+    println!("test: /proc/<pid> testing completed.");
+}
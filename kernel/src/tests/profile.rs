@@ -0,0 +1,84 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：帧指针回溯与内核采样分析
+//
+// 测试内容：
+// 1. StackWalker 沿构造的帧链回溯，遇到越界或不增长的 fp 停止
+// 2. 打断用户态的样本记为 [user]
+// 3. 打断内核态的样本以被打断的 PC 为最内层
+// 4. /proc/profile 的写入控制
+
+use alloc::vec::Vec;
+
+use crate::arch::riscv64::stacktrace::StackWalker;
+use crate::arch::riscv64::trap::TrapFrame;
+use crate::errno::Errno;
+use crate::println;
+use crate::profile;
+
+pub fn test_profile() {
+    println!("test: ===== Testing Kernel Sampling Profiler =====");
+
+    let was_enabled = profile::enabled();
+
+    // 测试 1: 帧链回溯
+    println!("test: 1. Testing StackWalker...");
+    // 三帧：每条记录是 [调用者 fp, 返回地址]，位于 fp - 16
+    let mut stack = [0usize; 12];
+    let base = stack.as_mut_ptr() as usize;
+    let fp = |slot: usize| base + slot * 8;
+    stack[0] = fp(6);
+    stack[1] = 0x1111;
+    stack[4] = fp(10);
+    stack[5] = 0x2222;
+    stack[8] = fp(2); // 指回低地址：链在这里结束
+    stack[9] = 0x3333;
+    let walked: Vec<usize> = unsafe { StackWalker::new(fp(2), base, fp(12)) }.map(|(_, ra)| ra).collect();
+    assert_eq!(walked, [0x1111, 0x2222, 0x3333]);
+    let bounded: Vec<usize> = unsafe { StackWalker::new(fp(2), base, fp(5)) }.map(|(_, ra)| ra).collect();
+    assert_eq!(bounded, [0x1111]);
+    assert_eq!(unsafe { StackWalker::new(fp(2) + 4, base, fp(12)) }.count(), 0);
+    println!("test:    SUCCESS - walks the chain and stops at bad frame pointers");
+
+    // 测试 2: 用户态样本
+    println!("test: 2. Testing user-mode sample...");
+    profile::reset();
+    let mut frame: TrapFrame = unsafe { core::mem::zeroed() };
+    frame.sepc = 0x10000;
+    profile::profile_tick(&frame, 0);
+    assert_eq!(profile::sample_counts(), (1, 0));
+    let content = profile::generate_profile();
+    assert!(content.lines().any(|line| line == "swapper;[user] 1"));
+    println!("test:    SUCCESS - user-mode tick folded as [user]");
+
+    // 测试 3: 内核态样本
+    println!("test: 3. Testing kernel-mode sample...");
+    profile::reset();
+    frame.sstatus = 0x100;
+    frame.sepc = 0x8020_1234;
+    profile::profile_tick(&frame, 0);
+    let content = profile::generate_profile();
+    let line = content.lines().find(|line| !line.starts_with('#')).unwrap_or("");
+    let (stack, count) = line.rsplit_once(' ').expect("folded line has a count");
+    assert_eq!(count, "1");
+    assert!(stack.starts_with("swapper;"));
+    assert!(stack.ends_with(";0x80201234"));
+    println!("test:    SUCCESS - {} frames", stack.split(';').count() - 1);
+
+    // 测试 4: 写入控制
+    println!("test: 4. Testing /proc/profile control...");
+    assert_eq!(profile::write_control(b"1\n"), Ok(2));
+    assert!(profile::enabled());
+    assert_eq!(profile::write_control(b"reset"), Ok(5));
+    assert_eq!(profile::sample_counts(), (0, 0));
+    assert_eq!(profile::write_control(b"0"), Ok(1));
+    assert!(!profile::enabled());
+    assert_eq!(profile::write_control(b"on"), Err(Errno::InvalidArgument.as_neg_i32()));
+    println!("test:    SUCCESS - enable, reset and disable");
+
+    profile::set_enabled(was_enabled);
+    println!("test: Profiler testing completed.");
+}
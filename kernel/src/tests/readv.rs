@@ -0,0 +1,61 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! readv / preadv / pwritev 测试
+//!
+//! 经 FileOps 的 read_iter / write_iter 读写多个分段，按位置的读写不改变文件位置
+
+use crate::println;
+use crate::fs::file::{File, FileFlags, REG_FILE_OPS};
+use crate::fs::inode::make_reg_inode_with_data;
+use alloc::sync::Arc;
+
+pub fn test_readv() {
+    println!("test: ===== Starting vectored I/O Tests =====");
+
+    let file = File::new(FileFlags::new(FileFlags::O_RDWR));
+    file.set_inode(Arc::new(make_reg_inode_with_data(u64::MAX - 26, b"hello, vectored world")));
+    file.set_ops(&REG_FILE_OPS);
+
+    // 1. readv 一次读入多个分段，前进文件位置
+    println!("test: 1. Testing readv...");
+    let mut a = [0u8; 5];
+    let mut b = [0u8; 2];
+    let mut c = [0u8; 8];
+    assert_eq!(file.read_vec(&mut [&mut a[..], &mut b[..], &mut c[..]], None), 15);
+    assert_eq!(&a, b"hello");
+    assert_eq!(&b, b", ");
+    assert_eq!(&c, b"vectored");
+    assert_eq!(file.get_pos(), 15);
+    println!("test:    SUCCESS - readv fills every segment in order");
+
+    // 2. preadv 从指定位置读取，不改变文件位置；到达文件末尾时短读
+    println!("test: 2. Testing preadv...");
+    let mut d = [0u8; 4];
+    let mut e = [0u8; 8];
+    assert_eq!(file.read_vec(&mut [&mut d[..], &mut e[..]], Some(16)), 5);
+    assert_eq!(&d, b"worl");
+    assert_eq!(e[0], b'd');
+    assert_eq!(file.get_pos(), 15);
+    println!("test:    SUCCESS - preadv leaves the file position alone");
+
+    // 3. pwritev 写到指定位置，之后可以读回
+    println!("test: 3. Testing pwritev...");
+    assert_eq!(file.write_vec(&[b"HE", b"LLO"], Some(0)), 5);
+    assert_eq!(file.get_pos(), 15);
+    let mut f = [0u8; 5];
+    assert_eq!(file.read_vec(&mut [&mut f[..]], Some(0)), 5);
+    assert_eq!(&f, b"HELLO");
+    println!("test:    SUCCESS - pwritev writes all segments at the offset");
+
+    // 4. 管道不能按位置读写
+    println!("test: 4. Testing preadv on a pipe...");
+    let (read_file, _write_file) = crate::fs::create_pipe();
+    let mut g = [0u8; 4];
+    assert_eq!(read_file.read_vec(&mut [&mut g[..]], Some(0)), -29);
+    println!("test:    SUCCESS - pipes return ESPIPE");
+
+    println!("test: ===== vectored I/O Tests Completed =====");
+}
@@ -0,0 +1,126 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：IPv4 路由表
+//
+// 测试内容：
+// 1. 前缀树的最长前缀匹配
+// 2. 删除路由后回退到较短的前缀，中间节点被合并
+// 3. 数千条路由与线性查找结果一致
+// 4. 每 CPU 目的地址缓存命中，路由修改后缓存失效
+
+use alloc::vec::Vec;
+use crate::println;
+use crate::net::ipv4::fib_trie::{prefix_mask, FibTrie};
+use crate::net::ipv4::route::{route_add, route_cache_stats, route_clear, route_count, route_lookup, route_remove};
+
+pub fn test_route() {
+    println!("test: ===== Testing IPv4 Routing Table =====");
+
+    // 测试 1: 最长前缀匹配
+    println!("test: 1. Testing longest prefix match...");
+    let mut trie: FibTrie<u32> = FibTrie::new();
+    assert_eq!(trie.lookup(0x0A000001), None);
+    trie.insert(0, 0, 1); // 默认路由
+    trie.insert(0x0A000000, 8, 2); // 10.0.0.0/8
+    trie.insert(0x0A010000, 16, 3); // 10.1.0.0/16
+    trie.insert(0x0A010200, 24, 4); // 10.1.2.0/24
+    trie.insert(0x0A010203, 32, 5); // 10.1.2.3/32
+    assert_eq!(trie.lookup(0x0A010203), Some(5));
+    assert_eq!(trie.lookup(0x0A010204), Some(4));
+    assert_eq!(trie.lookup(0x0A01FF01), Some(3));
+    assert_eq!(trie.lookup(0x0AFF0001), Some(2));
+    assert_eq!(trie.lookup(0xC0A80001), Some(1));
+    // 同一前缀再次插入替换旧值
+    assert_eq!(trie.insert(0x0A0102FF, 24, 6), Some(4));
+    assert_eq!(trie.lookup(0x0A010204), Some(6));
+    assert_eq!(trie.len(), 5);
+    println!("test:    SUCCESS - /32 over /24 over /16 over /8 over default");
+
+    // 测试 2: 删除
+    println!("test: 2. Testing route removal...");
+    assert_eq!(trie.remove(0x0A010200, 24), Some(6));
+    assert_eq!(trie.remove(0x0A010200, 24), None);
+    assert_eq!(trie.lookup(0x0A010204), Some(3));
+    assert_eq!(trie.lookup(0x0A010203), Some(5));
+    assert_eq!(trie.remove(0x0A010203, 32), Some(5));
+    assert_eq!(trie.remove(0x0A010000, 16), Some(3));
+    assert_eq!(trie.remove(0x0A000000, 8), Some(2));
+    assert_eq!(trie.lookup(0x0A010203), Some(1));
+    // 只剩根节点上的默认路由
+    assert_eq!(trie.nr_nodes(), 1);
+    println!("test:    SUCCESS - lookups fall back to shorter prefixes");
+
+    // 测试 3: 大量路由
+    println!("test: 3. Testing thousands of routes...");
+    let mut trie: FibTrie<u32> = FibTrie::new();
+    let mut routes: Vec<(u32, u8)> = Vec::new();
+    let mut x: u32 = 0x1234_5678;
+    for i in 0..3000u32 {
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        let plen = 8 + (x % 25) as u8;
+        let key = x & prefix_mask(plen);
+        if trie.insert(key, plen, i).is_none() {
+            routes.push((key, plen));
+        }
+    }
+    assert_eq!(trie.len(), routes.len());
+    let mut y: u32 = 0x9e37_79b9;
+    for _ in 0..2000 {
+        y ^= y << 13;
+        y ^= y >> 17;
+        y ^= y << 5;
+        // 一半的地址取自已有前缀，保证大多数查找能匹配
+        let addr = if y & 1 == 0 { routes[(y as usize >> 1) % routes.len()].0 | (y & 0xff) } else { y };
+        let best = routes
+            .iter()
+            .filter(|&&(key, plen)| addr & prefix_mask(plen) == key)
+            .max_by_key(|&&(_, plen)| plen)
+            .copied();
+        assert_eq!(trie.lookup(addr).is_some(), best.is_some());
+        if let Some((key, plen)) = best {
+            assert_eq!(trie.lookup(addr), trie.get(key, plen));
+        }
+    }
+    for &(key, plen) in routes.iter() {
+        assert!(trie.remove(key, plen).is_some());
+    }
+    assert_eq!(trie.len(), 0);
+    assert_eq!(trie.nr_nodes(), 1);
+    println!("test:    SUCCESS - {} routes agree with linear search", routes.len());
+
+    // 测试 4: 目的地址缓存
+    println!("test: 4. Testing per-CPU destination cache...");
+    route_clear();
+    assert!(route_add(0x0A000000, 0xFF000000, 0, 1, 1500).is_ok());
+    assert!(route_add(0x0A000000, 0xFF00FF00, 0, 1, 1500).is_err());
+    assert_eq!(route_count(), 1);
+    let before = cache_totals();
+    assert_eq!(route_lookup(0x0A000105).map(|r| r.oif), Some(1));
+    assert_eq!(route_lookup(0x0A000105).map(|r| r.oif), Some(1));
+    let after = cache_totals();
+    assert!(after.0 > before.0);
+    // 更具体的路由加入后缓存项因代数过期而失效
+    assert!(route_add(0x0A000100, 0xFFFFFF00, 0x0A000001, 2, 1500).is_ok());
+    let route = route_lookup(0x0A000105).expect("route");
+    assert_eq!(route.oif, 2);
+    assert!(route.is_gateway());
+    assert!(route_remove(0x0A000100, 0xFFFFFF00));
+    assert_eq!(route_lookup(0x0A000105).map(|r| r.oif), Some(1));
+    // 没有路由的结果同样缓存
+    assert_eq!(route_lookup(0xC0A80001).map(|r| r.oif), None);
+    route_clear();
+    assert_eq!(route_lookup(0x0A000105).map(|r| r.oif), None);
+    println!("test:    SUCCESS - cache hit, invalidated on route change");
+
+    println!("test: IPv4 routing table testing completed.");
+}
+
+/// 所有 CPU 的 (命中, 未命中) 之和
+fn cache_totals() -> (u64, u64) {
+    route_cache_stats().iter().fold((0, 0), |(h, m), s| (h + s.hits, m + s.misses))
+}
@@ -0,0 +1,128 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：读写锁与 RCU 回调
+//
+// 测试内容：
+// 1. 读写锁的读者共享与写者独占
+// 2. call_rcu 在读临界区结束前不执行
+// 3. kfree_rcu 与 rcu_barrier
+// 4. 挂载表的无锁查找与复制更新
+// 5. 挂载散列表按路径前缀查找最深的挂载点
+
+use alloc::boxed::Box;
+use alloc::sync::Arc;
+use core::sync::atomic::{AtomicBool, AtomicUsize, Ordering};
+use crate::println;
+use crate::fs::mount::{MntFlags, MntNamespace, VfsMount};
+use crate::sync::rcu::*;
+use crate::sync::RwLock;
+
+static CALLBACK_RUNS: AtomicUsize = AtomicUsize::new(0);
+static DROPPED: AtomicBool = AtomicBool::new(false);
+
+struct DropMarker;
+
+impl Drop for DropMarker {
+    fn drop(&mut self) {
+        DROPPED.store(true, Ordering::Relaxed);
+    }
+}
+
+pub fn test_rwlock_rcu() {
+    println!("test: ===== Testing RwLock and RCU Callbacks =====");
+
+    // 测试 1: 读写锁
+    println!("test: 1. Testing reader-writer lock...");
+    let lock = RwLock::new(10u32);
+    {
+        let r1 = lock.read();
+        let r2 = lock.try_read().unwrap();
+        assert_eq!(*r1 + *r2, 20);
+        assert_eq!(lock.reader_count(), 2);
+        assert!(lock.try_write().is_none());
+    }
+    assert_eq!(lock.reader_count(), 0);
+    {
+        let mut w = lock.write();
+        *w += 1;
+        assert!(lock.is_write_locked());
+        assert!(lock.try_read().is_none());
+        assert!(lock.try_write().is_none());
+    }
+    assert!(!lock.is_write_locked());
+    assert_eq!(*lock.read(), 11);
+    println!("test:    SUCCESS - readers share, writer excludes");
+
+    // 测试 2: call_rcu
+    println!("test: 2. Testing call_rcu grace period...");
+    CALLBACK_RUNS.store(0, Ordering::Relaxed);
+    {
+        let _rcu = rcu_read_lock();
+        call_rcu(|| { CALLBACK_RUNS.fetch_add(1, Ordering::Relaxed); });
+        assert!(rcu_pending() >= 1);
+        // 本 CPU 还在登记时的读临界区内
+        rcu_process_callbacks();
+        assert_eq!(CALLBACK_RUNS.load(Ordering::Relaxed), 0);
+    }
+    rcu_process_callbacks();
+    assert_eq!(CALLBACK_RUNS.load(Ordering::Relaxed), 1);
+    println!("test:    SUCCESS - callback runs only after the reader leaves");
+
+    // 测试 3: kfree_rcu
+    println!("test: 3. Testing kfree_rcu and rcu_barrier...");
+    DROPPED.store(false, Ordering::Relaxed);
+    {
+        let _rcu = rcu_read_lock();
+        kfree_rcu(Box::new(DropMarker));
+        assert!(!DROPPED.load(Ordering::Relaxed));
+    }
+    rcu_barrier();
+    assert!(DROPPED.load(Ordering::Relaxed));
+    println!("test:    SUCCESS - object freed after the grace period");
+
+    // 测试 4: 挂载表
+    println!("test: 4. Testing RCU mount table...");
+    let ns = MntNamespace::new();
+    assert!(ns.find_mount(b"/mnt/a").is_none());
+    let root = Arc::new(VfsMount::new(b"/".to_vec(), b"/".to_vec(), MntFlags::new(0), None));
+    let mnt = Arc::new(VfsMount::new(b"/mnt".to_vec(), b"/".to_vec(), MntFlags::new(0), None));
+    ns.add_mount(root.clone()).unwrap();
+    ns.add_mount(mnt.clone()).unwrap();
+    assert!(Arc::ptr_eq(&ns.find_mount(b"/mnt/a").unwrap(), &mnt));
+    assert!(Arc::ptr_eq(&ns.find_mount(b"/mntx").unwrap(), &root));
+    assert_eq!(ns.list_mounts().len(), 2);
+    ns.remove_mount(0).unwrap();
+    assert_eq!(ns.list_mounts().len(), 1);
+    assert!(ns.remove_mount(7).is_err());
+    rcu_barrier();
+    // 旧表释放后只剩命名空间和本地的引用
+    assert_eq!(Arc::strong_count(&root) + Arc::strong_count(&mnt), 3);
+    println!("test:    SUCCESS - lookups see published tables, old tables freed");
+
+    // 测试 5: 挂载散列表
+    println!("test: 5. Testing mount hash lookups...");
+    let ns = MntNamespace::new();
+    let mount = |mp: &[u8]| Arc::new(VfsMount::new(mp.to_vec(), b"/".to_vec(), MntFlags::new(0), None));
+    let root = mount(b"/");
+    let mnt = mount(b"/mnt");
+    let deep = mount(b"/mnt/a/b");
+    for m in [&root, &mnt, &deep] {
+        ns.add_mount(m.clone()).unwrap();
+    }
+    // 同一挂载点先挂载的胜出
+    ns.add_mount(mount(b"/mnt")).unwrap();
+    assert!(Arc::ptr_eq(&ns.find_mount(b"/mnt/a/b/c/d").unwrap(), &deep));
+    assert!(Arc::ptr_eq(&ns.find_mount(b"/mnt/a/b").unwrap(), &deep));
+    assert!(Arc::ptr_eq(&ns.find_mount(b"/mnt/a/bc").unwrap(), &mnt));
+    assert!(Arc::ptr_eq(&ns.find_mount(b"/mnt/").unwrap(), &mnt));
+    assert!(Arc::ptr_eq(&ns.find_mount(b"/").unwrap(), &root));
+    assert!(Arc::ptr_eq(&ns.find_mount(b"/other/x").unwrap(), &root));
+    assert!(ns.find_mount(b"mnt/a").is_none());
+    assert!(ns.find_mount(b"").is_none());
+    println!("test:    SUCCESS - deepest mountpoint found by prefix probing");
+
+    println!("test: RwLock and RCU testing completed.");
+}
@@ -0,0 +1,98 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：CPU 亲和性
+//
+// 测试内容：
+// 1. 新任务允许在所有 CPU 上运行，子进程继承亲和性
+// 2. sched_setaffinity 拒绝没有可用 CPU 的掩码
+// 3. 唤醒时只选择允许的 CPU
+// 4. select_fallback_rq 在允许的 CPU 中选择
+// 5. 把当前任务绑定到另一个 CPU 后切换过去，再绑回原 CPU
+
+use crate::println;
+use crate::process::task::{Task, SchedPolicy};
+use crate::sched::sched::{select_fallback_rq, select_task_rq_fair, WF_SYNC};
+use crate::sched::{self, cpu_active_mask, sched_setaffinity, MAX_CPUS};
+use alloc::boxed::Box;
+
+pub fn test_sched_affinity() {
+    println!("test: ===== Testing CPU Affinity =====");
+
+    let this_cpu = crate::arch::cpu_id() as usize;
+    let active = cpu_active_mask();
+    let einval = crate::errno::Errno::InvalidArgument.as_neg_i32();
+
+    // 测试 1: 默认亲和性与继承
+    println!("test: 1. Testing default and inherited affinity...");
+    let mut task = Box::new(Task::new(970, SchedPolicy::Normal));
+    let ptr = &mut *task as *mut Task;
+    assert_eq!(task.cpus_allowed(), usize::MAX);
+    assert!(task.cpu_allowed(this_cpu));
+    task.set_cpus_allowed(1 << this_cpu);
+    let mut child = Box::new(Task::new(971, SchedPolicy::Normal));
+    child.sched_fork(&task);
+    assert_eq!(child.cpus_allowed(), 1 << this_cpu);
+    task.set_cpus_allowed(usize::MAX);
+    println!("test:    SUCCESS - default all CPUs, child inherits mask");
+
+    // 测试 2: 无效掩码
+    println!("test: 2. Testing mask without active CPUs...");
+    assert_eq!(sched_setaffinity(ptr, 0), Err(einval));
+    assert_eq!(sched_setaffinity(ptr, !active), Err(einval));
+    assert_eq!(task.cpus_allowed(), usize::MAX);
+    assert_eq!(sched_setaffinity(ptr, usize::MAX), Ok(()));
+    assert_eq!(task.cpus_allowed(), active);
+    println!("test:    SUCCESS - active mask = {:#x}", active);
+
+    // 测试 3: 唤醒时只选择允许的 CPU
+    println!("test: 3. Testing wakeup placement honours the mask...");
+    for cpu in (0..MAX_CPUS).filter(|&cpu| active & (1 << cpu) != 0) {
+        task.set_cpus_allowed(1 << cpu);
+        for prev in (0..MAX_CPUS).filter(|&prev| active & (1 << prev) != 0) {
+            for &flags in &[0, WF_SYNC] {
+                let target = select_fallback_rq(&task, select_task_rq_fair(&task, prev, this_cpu, flags));
+                assert_eq!(target, cpu, "pinned to cpu{} but woke on cpu{}", cpu, target);
+            }
+        }
+    }
+    println!("test:    SUCCESS - pinned task always placed on its CPU");
+
+    // 测试 4: 回退选择
+    println!("test: 4. Testing select_fallback_rq...");
+    task.set_cpus_allowed(active);
+    assert_eq!(select_fallback_rq(&task, this_cpu), this_cpu);
+    task.set_cpus_allowed(!active);
+    let fallback = select_fallback_rq(&task, this_cpu);
+    assert_eq!(fallback, this_cpu);
+    assert_eq!(task.cpus_allowed(), usize::MAX);
+    println!("test:    SUCCESS - no usable CPU resets the mask");
+
+    // 测试 5: 迁移当前任务
+    println!("test: 5. Testing migration of the current task...");
+    let current = match sched::current() {
+        Some(current) => current as *mut Task,
+        None => {
+            println!("test:    SKIPPED - no current task");
+            return;
+        }
+    };
+    let other = (0..MAX_CPUS).find(|&cpu| cpu != this_cpu && active & (1 << cpu) != 0);
+    match other {
+        Some(other) => {
+            assert_eq!(sched_setaffinity(current, 1 << other), Ok(()));
+            sched::yield_cpu();
+            assert_eq!(crate::arch::cpu_id() as usize, other);
+            assert_eq!(sched_setaffinity(current, 1 << this_cpu), Ok(()));
+            sched::yield_cpu();
+            assert_eq!(crate::arch::cpu_id() as usize, this_cpu);
+            assert_eq!(sched_setaffinity(current, usize::MAX), Ok(()));
+            println!("test:    SUCCESS - moved to cpu{} and back to cpu{}", other, this_cpu);
+        }
+        None => println!("test:    SKIPPED - single CPU"),
+    }
+
+    println!("test: CPU affinity testing completed.");
+}
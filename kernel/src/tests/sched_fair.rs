@@ -0,0 +1,86 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：CFS 公平调度类
+//
+// 测试内容：
+// 1. nice 权重计算
+// 2. 按 vruntime 顺序选择任务
+// 3. 时间片随可运行任务数缩短
+// 4. 运行中的任务放回红黑树
+
+use crate::println;
+use crate::process::task::{Task, TaskState, SchedPolicy};
+use crate::sched::fair::{CfsRq, task_load_weight, NICE_0_LOAD};
+use alloc::boxed::Box;
+use alloc::vec::Vec;
+
+pub fn test_sched_fair() {
+    println!("test: ===== Testing CFS Fair Scheduling Class =====");
+
+    // 测试 1: nice 0 (static_prio 120) 的权重
+    println!("test: 1. Testing load weight of nice 0...");
+    let probe = Box::new(Task::new(900, SchedPolicy::Normal));
+    assert_eq!(task_load_weight(&probe), NICE_0_LOAD, "nice 0 weight should be 1024");
+    println!("test:    SUCCESS - weight = {}", NICE_0_LOAD);
+
+    // 测试 2: 按 vruntime 从小到大选择
+    println!("test: 2. Testing pick order by vruntime...");
+    let mut cfs = CfsRq::new();
+    let vruntimes = [3_000_000u64, 1_000_000, 2_000_000];
+    let mut tasks: Vec<Box<Task>> = Vec::new();
+    for (i, &v) in vruntimes.iter().enumerate() {
+        let mut task = Box::new(Task::new(901 + i as u32, SchedPolicy::Normal));
+        // 标记为已运行过，避免按新任务放置
+        task.se.sum_exec_runtime = 1;
+        task.se.vruntime = v;
+        tasks.push(task);
+    }
+    unsafe {
+        for task in tasks.iter_mut() {
+            cfs.enqueue(&mut **task as *mut Task);
+        }
+    }
+    assert_eq!(cfs.nr_running(), 3, "CFS rq should have 3 tasks");
+
+    let first = cfs.pick_next().expect("pick_next should return a task");
+    assert_eq!(unsafe { (*first).pid() }, 902, "smallest vruntime should be picked first");
+    println!("test:    SUCCESS - picked PID 902 (vruntime 1ms)");
+
+    // 测试 3: 时间片 = 调度周期 / 可运行任务数（权重相同）
+    println!("test: 3. Testing sched_slice with 3 runnable tasks...");
+    let slice = cfs.sched_slice(unsafe { &*first });
+    assert_eq!(slice, 6_000_000 / 3, "slice should be latency / nr_running");
+    println!("test:    SUCCESS - slice = {} ns", slice);
+
+    // 测试 4: 放回当前任务后，vruntime 次小的任务被选中
+    println!("test: 4. Testing put_prev and re-pick...");
+    unsafe {
+        (*first).se.vruntime = 5_000_000;
+        cfs.put_prev(first, false);
+    }
+    let second = cfs.pick_next().expect("pick_next should return a task");
+    assert_eq!(unsafe { (*second).pid() }, 903, "next smallest vruntime should be picked");
+    println!("test:    SUCCESS - picked PID 903");
+
+    // 测试 5: 睡眠任务在 put_prev 时离开队列
+    println!("test: 5. Testing put_prev of a sleeping task...");
+    unsafe {
+        (*second).set_state(TaskState::Interruptible);
+        cfs.put_prev(second, false);
+    }
+    assert_eq!(cfs.nr_running(), 2, "sleeping task should be dequeued");
+    assert!(!unsafe { (*second).se.on_rq }, "sleeping task should not be on_rq");
+    println!("test:    SUCCESS - sleeping task dequeued");
+
+    unsafe {
+        for task in tasks.iter_mut() {
+            cfs.dequeue(&mut **task as *mut Task);
+        }
+    }
+    assert_eq!(cfs.nr_running(), 0, "CFS rq should be empty");
+
+    println!("test: ===== CFS Fair Scheduling Class Testing Completed =====");
+}
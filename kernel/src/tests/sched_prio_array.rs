@@ -0,0 +1,172 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 实时优先级数组单元测试
+//!
+//! 在独立的 PrioArray 上检查：同一优先级内按 FIFO 顺序选择、跨越位图三个字的优先级选择、
+//! 链表变空时才清除位、requeue 移到链表尾部，以及优先级改变的任务出队、入队后不残留位
+
+use alloc::boxed::Box;
+use alloc::vec::Vec;
+
+use crate::println;
+use crate::process::task::{SchedPolicy, Task};
+use crate::sched::sched::{PrioArray, MAX_PRIO};
+
+fn new_task(pid: u32, prio: i32) -> Box<Task> {
+    let mut task = Box::new(Task::new(pid, SchedPolicy::Fifo));
+    task.set_prio(prio);
+    task
+}
+
+fn ptr(task: &mut Box<Task>) -> *mut Task {
+    &mut **task as *mut Task
+}
+
+/// 下一个被选中的任务的 PID
+fn peek_pid(array: &PrioArray) -> Option<u32> {
+    array.peek().map(|task| unsafe { (*task).pid() })
+}
+
+/// 依次取出队首任务直到数组为空，返回取出的 PID
+fn drain(array: &mut PrioArray) -> Vec<u32> {
+    let mut pids = Vec::new();
+    while let Some(task) = array.peek() {
+        unsafe {
+            pids.push((*task).pid());
+            array.dequeue(task);
+        }
+    }
+    assert_eq!(array.first_prio(), None);
+    assert_eq!(array.nr_active(), 0);
+    pids
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_sched_prio_array() {
+    println!("test: ===== Starting Priority Array Tests =====");
+
+    // 链表头是自引用结构，放入堆中后再初始化
+    let mut array = Box::new(PrioArray::new());
+    array.init();
+    assert_eq!((array.first_prio(), array.peek().is_none()), (None, true));
+
+    // 1. 同一优先级按入队顺序选择
+    println!("test: 1. Testing FIFO order within one priority...");
+    let mut same: Vec<Box<Task>> = (0..3).map(|i| new_task(960 + i, 50)).collect();
+    unsafe {
+        for task in same.iter_mut() {
+            array.enqueue(ptr(task));
+        }
+        // 已在队列中的任务不重复入队
+        array.enqueue(ptr(&mut same[0]));
+    }
+    assert_eq!(array.nr_active(), 3);
+    assert_eq!(array.first_prio(), Some(50));
+    assert_eq!(drain(&mut array), [960, 961, 962]);
+    println!("test:    SUCCESS - prio 50 picked in FIFO order");
+
+    // 2. 优先级 0、63 在位图第 0 个字，64 在第 1 个字，139 在第 2 个字
+    println!("test: 2. Testing picks across bitmap words...");
+    let prios = [139, 64, 63, 0];
+    let mut spread: Vec<Box<Task>> = prios.iter().map(|&prio| new_task(970 + prio as u32, prio)).collect();
+    unsafe {
+        for task in spread.iter_mut() {
+            array.enqueue(ptr(task));
+        }
+    }
+    assert_eq!(array.first_prio(), Some(0));
+    assert_eq!(drain(&mut array), [970, 1033, 1034, 1109]);
+    // 超出范围的优先级归入两端的链表
+    let mut low = new_task(980, -1);
+    let mut high = new_task(981, MAX_PRIO as i32);
+    unsafe {
+        array.enqueue(ptr(&mut high));
+        assert_eq!(array.first_prio(), Some(MAX_PRIO - 1));
+        array.enqueue(ptr(&mut low));
+        assert_eq!(array.first_prio(), Some(0));
+    }
+    assert_eq!(drain(&mut array), [980, 981]);
+    println!("test:    SUCCESS - prio 0, 63, 64, 139 picked in order");
+
+    // 3. 同一优先级还有任务时不清除位，最后一个任务出队时才清除
+    println!("test: 3. Testing bit cleared only when a list empties...");
+    unsafe {
+        array.enqueue(ptr(&mut spread[2]));  // prio 63
+        array.enqueue(ptr(&mut spread[1]));  // prio 64
+        array.enqueue(ptr(&mut same[0]));    // prio 50
+        array.enqueue(ptr(&mut same[1]));    // prio 50
+        // 按优先级出队：先出队第二个，第一个仍在链表中
+        array.dequeue(ptr(&mut same[1]));
+        assert_eq!((array.first_prio(), peek_pid(&array)), (Some(50), Some(960)));
+        // 不在队列中的任务出队无操作
+        array.dequeue(ptr(&mut same[1]));
+        assert_eq!(array.nr_active(), 3);
+        array.dequeue(ptr(&mut same[0]));
+        assert_eq!((array.first_prio(), peek_pid(&array)), (Some(63), Some(1033)));
+        array.dequeue(ptr(&mut spread[2]));
+        assert_eq!((array.first_prio(), peek_pid(&array)), (Some(64), Some(1034)));
+    }
+    assert_eq!(drain(&mut array), [1034]);
+    println!("test:    SUCCESS - bit kept until the last task left the list");
+
+    // 4. requeue 把任务移到同一优先级链表的尾部，只有一个任务时位保持不变
+    println!("test: 4. Testing requeue rotation...");
+    unsafe {
+        for task in same.iter_mut() {
+            array.enqueue(ptr(task));
+        }
+        array.requeue(ptr(&mut same[0]));
+        assert_eq!(peek_pid(&array), Some(961));
+        array.requeue(ptr(&mut same[1]));
+        assert_eq!(peek_pid(&array), Some(962));
+        assert_eq!(array.nr_active(), 3);
+    }
+    assert_eq!(drain(&mut array), [962, 960, 961]);
+    unsafe {
+        array.enqueue(ptr(&mut same[2]));
+        array.requeue(ptr(&mut same[2]));
+        assert_eq!((array.first_prio(), peek_pid(&array)), (Some(50), Some(962)));
+        // 不在队列中的任务不会被 requeue 加入
+        array.requeue(ptr(&mut same[0]));
+        assert_eq!(array.nr_active(), 1);
+    }
+    assert_eq!(drain(&mut array), [962]);
+    println!("test:    SUCCESS - requeued tasks moved behind their peers");
+
+    // 5. 优先级改变：rt_mutex_setprio / sched_setscheduler 先出队、改 prio 再入队；
+    //    入队后直接改 prio 的任务出队或 requeue 时也清除原链表的位
+    println!("test: 5. Testing prio changes leave no stale bits...");
+    let mut boosted = new_task(990, 90);
+    let mut other = new_task(991, 90);
+    unsafe {
+        array.enqueue(ptr(&mut boosted));
+        array.enqueue(ptr(&mut other));
+        array.dequeue(ptr(&mut boosted));
+        boosted.set_prio(10);
+        array.enqueue(ptr(&mut boosted));
+        assert_eq!((array.first_prio(), peek_pid(&array)), (Some(10), Some(990)));
+        // 优先级恢复后回到 90 的链表尾部，10 的位清除
+        array.dequeue(ptr(&mut boosted));
+        boosted.set_prio(90);
+        array.enqueue(ptr(&mut boosted));
+        assert_eq!((array.first_prio(), peek_pid(&array)), (Some(90), Some(991)));
+    }
+    assert_eq!(drain(&mut array), [991, 990]);
+    unsafe {
+        array.enqueue(ptr(&mut boosted));
+        boosted.set_prio(120);
+        array.dequeue(ptr(&mut boosted));
+        assert_eq!((array.first_prio(), array.peek().is_none()), (None, true));
+        array.enqueue(ptr(&mut boosted));
+        boosted.set_prio(5);
+        array.requeue(ptr(&mut boosted));
+        assert_eq!((array.first_prio(), peek_pid(&array)), (Some(5), Some(990)));
+    }
+    assert_eq!(drain(&mut array), [990]);
+    println!("test:    SUCCESS - no bit left set for an emptied list");
+
+    println!("test: ===== Priority Array Tests Completed =====");
+}
@@ -0,0 +1,100 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：实时调度类
+//
+// 测试内容：
+// 1. 调度策略编号解析
+// 2. sched_setscheduler 拒绝无效的策略和优先级
+// 3. 实时优先级与 prio 的换算，切回 SCHED_NORMAL 恢复静态优先级
+// 4. 修改策略时保留优先级继承的提升
+// 5. 子进程继承调度策略
+// 6. 实时带宽用完后节流，下一个周期解除
+
+use crate::println;
+use crate::process::task::{Task, SchedPolicy};
+use crate::sched::sched::{sched_setscheduler, RtBandwidth, SCHED_RT_PERIOD_NS, SCHED_RT_RUNTIME_NS};
+use alloc::boxed::Box;
+use core::sync::atomic::Ordering;
+
+pub fn test_sched_rt() {
+    println!("test: ===== Testing Real-Time Scheduling Class =====");
+
+    let einval = crate::errno::Errno::InvalidArgument.as_neg_i32();
+
+    // 测试 1: 策略编号
+    println!("test: 1. Testing policy numbers...");
+    assert_eq!(SchedPolicy::from_raw(1), Some(SchedPolicy::Fifo));
+    assert_eq!(SchedPolicy::from_raw(2), Some(SchedPolicy::Rr));
+    assert_eq!(SchedPolicy::from_raw(4), None);
+    assert!(SchedPolicy::Rr.is_rt());
+    assert!(!SchedPolicy::Batch.is_rt());
+    println!("test:    SUCCESS - SCHED_FIFO=1, SCHED_RR=2, 4 unknown");
+
+    // 测试 2: 无效参数
+    println!("test: 2. Testing invalid parameters...");
+    let mut task = Box::new(Task::new(960, SchedPolicy::Normal));
+    let ptr = &mut *task as *mut Task;
+    assert_eq!(sched_setscheduler(ptr, SchedPolicy::Fifo, 0), Err(einval));
+    assert_eq!(sched_setscheduler(ptr, SchedPolicy::Rr, 100), Err(einval));
+    assert_eq!(sched_setscheduler(ptr, SchedPolicy::Normal, 5), Err(einval));
+    assert_eq!(sched_setscheduler(ptr, SchedPolicy::Deadline, 0), Err(einval));
+    assert_eq!(
+        sched_setscheduler(core::ptr::null_mut(), SchedPolicy::Fifo, 10),
+        Err(crate::errno::Errno::NoSuchProcess.as_neg_i32())
+    );
+    assert_eq!(task.policy(), SchedPolicy::Normal);
+    println!("test:    SUCCESS - invalid policy/priority rejected");
+
+    // 测试 3: 优先级换算
+    println!("test: 3. Testing priority mapping...");
+    assert_eq!(sched_setscheduler(ptr, SchedPolicy::Fifo, 50), Ok(()));
+    assert_eq!(task.policy(), SchedPolicy::Fifo);
+    assert_eq!(task.prio(), 49);
+    assert_eq!(task.rt_priority(), 50);
+    assert_eq!(sched_setscheduler(ptr, SchedPolicy::Rr, 99), Ok(()));
+    assert_eq!(task.prio(), 0);
+    assert_eq!(task.rt_priority(), 99);
+    assert_eq!(sched_setscheduler(ptr, SchedPolicy::Normal, 0), Ok(()));
+    assert_eq!(task.prio(), task.static_prio());
+    assert_eq!(task.rt_priority(), 0);
+    println!("test:    SUCCESS - sched_priority 50 -> prio 49, 99 -> 0");
+
+    // 测试 4: 优先级继承的提升
+    println!("test: 4. Testing priority boost is kept...");
+    task.set_prio(10);
+    assert_eq!(sched_setscheduler(ptr, SchedPolicy::Fifo, 50), Ok(()));
+    assert_eq!(task.prio(), 10);
+    assert_eq!(task.normal_prio(), 49);
+    println!("test:    SUCCESS - boosted prio 10 kept, normal_prio 49");
+
+    // 测试 5: fork 继承
+    println!("test: 5. Testing sched_fork...");
+    let mut child = Box::new(Task::new(961, SchedPolicy::Normal));
+    child.sched_fork(&task);
+    assert_eq!(child.policy(), SchedPolicy::Fifo);
+    assert_eq!(child.prio(), 49);
+    assert_eq!(child.rt_priority(), 50);
+    println!("test:    SUCCESS - child inherits SCHED_FIFO without the boost");
+
+    // 测试 6: 实时带宽
+    println!("test: 6. Testing RT throttling...");
+    let period = SCHED_RT_PERIOD_NS.load(Ordering::Relaxed);
+    let runtime = SCHED_RT_RUNTIME_NS.load(Ordering::Relaxed);
+    let start = 1_000;
+    let mut rt = RtBandwidth::new();
+    assert!(!rt.update(start, false));
+    assert!(!rt.update(start + runtime / 2, true));
+    assert!(!rt.throttled());
+    assert!(rt.update(start + runtime + 1, true));
+    assert!(rt.throttled());
+    assert!(!rt.update(start + period - 1, true));
+    assert!(rt.update(start + period, false));
+    assert!(!rt.throttled());
+    assert_eq!(rt.rt_time(), 0);
+    println!("test:    SUCCESS - throttled after {} ms of {} ms", runtime / 1_000_000, period / 1_000_000);
+
+    println!("test: Real-time scheduling testing completed.");
+}
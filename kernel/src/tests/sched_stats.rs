@@ -0,0 +1,116 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：平均负载与调度统计
+//
+// 测试内容：
+// 1. calc_load 的定点衰减收敛到活跃任务数，空闲时衰减到 0
+// 2. /proc/loadavg 的格式
+// 3. schedule 调用计入 /proc/schedstat 的 sched_count
+// 4. /proc/stat 的 cpu 行与 ctxt、procs_running
+// 5. /proc/<pid>/schedstat 按需生成，不存在的 PID 返回 None
+
+use alloc::string::String;
+use alloc::vec::Vec;
+
+use crate::println;
+use crate::sched::loadavg::{calc_load, FIXED_1};
+
+/// 读取 /proc 文件为字符串
+fn read_proc(path: &str) -> String {
+    let data = crate::fs::procfs::read_file(path).unwrap_or_default();
+    String::from_utf8(data).unwrap_or_default()
+}
+
+/// 本 CPU 在 /proc/schedstat 中的 sched_count
+fn this_cpu_sched_count() -> u64 {
+    let prefix = alloc::format!("cpu{} ", crate::arch::cpu_id());
+    let content = read_proc("/schedstat");
+    let line = content.lines().find(|line| line.starts_with(&prefix)).unwrap_or("");
+    line.split_whitespace().nth(3).and_then(|v| v.parse().ok()).unwrap_or(0)
+}
+
+pub fn test_sched_stats() {
+    println!("test: ===== Testing Load Average and Scheduler Statistics =====");
+
+    // 测试 1: 定点衰减
+    println!("test: 1. Testing calc_load...");
+    assert_eq!(calc_load(0, 1884, FIXED_1), 164);
+    let mut load = 0;
+    for _ in 0..2000 {
+        load = calc_load(load, 1884, 2 * FIXED_1);
+    }
+    assert_eq!(load, 2 * FIXED_1);
+    for _ in 0..2000 {
+        load = calc_load(load, 1884, 0);
+    }
+    assert_eq!(load, 0);
+    println!("test:    SUCCESS - converges to the active count and decays to zero");
+
+    // 测试 2: /proc/loadavg
+    println!("test: 2. Testing /proc/loadavg...");
+    let content = read_proc("/loadavg");
+    let fields: Vec<&str> = content.split_whitespace().collect();
+    assert_eq!(fields.len(), 5);
+    for avg in &fields[..3] {
+        let (int, frac) = avg.split_once('.').expect("load average has two decimals");
+        assert!(int.parse::<u64>().is_ok());
+        assert_eq!(frac.len(), 2);
+    }
+    let (running, total) = fields[3].split_once('/').expect("running/total");
+    assert!(running.parse::<usize>().is_ok());
+    assert!(total.parse::<usize>().unwrap_or(0) >= 1);
+    println!("test:    SUCCESS - {}", content.trim_end());
+
+    // 测试 3: /proc/schedstat
+    println!("test: 3. Testing /proc/schedstat...");
+    assert!(read_proc("/schedstat").starts_with("version 15\n"));
+    let before = this_cpu_sched_count();
+    for _ in 0..4 {
+        crate::sched::schedule();
+    }
+    let after = this_cpu_sched_count();
+    assert!(after >= before + 4);
+    println!("test:    SUCCESS - sched_count {} -> {}", before, after);
+
+    // 测试 4: /proc/stat
+    println!("test: 4. Testing /proc/stat...");
+    let content = read_proc("/stat");
+    let cpu_line = content.lines().next().unwrap_or("");
+    assert!(cpu_line.starts_with("cpu "));
+    assert_eq!(cpu_line.split_whitespace().count(), 11);
+    let this_cpu = alloc::format!("cpu{} ", crate::arch::cpu_id());
+    assert!(content.lines().any(|line| line.starts_with(&this_cpu)));
+    assert!(content.lines().any(|line| line.starts_with("ctxt ")));
+    assert!(content.lines().any(|line| line.starts_with("procs_running ")));
+    println!("test:    SUCCESS - cpu, ctxt and procs lines present");
+
+    // 测试 5: /proc/<pid>/schedstat
+    println!("test: 5. Testing /proc/<pid>/schedstat...");
+    assert_eq!(crate::fs::procfs::read_file("/999999/schedstat"), None);
+    // 单元测试在 idle 上下文运行，挑一个普通任务
+    let mut pid = 0;
+    crate::sched::sched::for_each_task(|task| unsafe {
+        if pid == 0 && (*task).pid() != 0 && (*task).pid() == (*task).tgid() {
+            pid = (*task).pid();
+        }
+    });
+    if pid != 0 {
+        let path = alloc::format!("/{}/schedstat", pid);
+        let content = read_proc(&path);
+        let fields: Vec<u64> = content.split_whitespace().filter_map(|v| v.parse().ok()).collect();
+        assert_eq!(fields.len(), 3);
+        let dir = crate::fs::procfs::list_dir(&alloc::format!("/{}", pid)).unwrap_or_default();
+        assert!(dir.iter().any(|(name, _, _)| name.as_slice() == b"schedstat"));
+        let root = crate::fs::procfs::list_dir("/").unwrap_or_default();
+        let name = alloc::format!("{}", pid);
+        assert!(root.iter().any(|(entry, _, _)| entry.as_slice() == name.as_bytes()));
+        println!("test:    SUCCESS - pid {}: {}", pid, content.trim_end());
+    } else {
+        println!("test:    SKIP - no process to inspect");
+    }
+
+    println!("test: Scheduler statistics testing completed.");
+}
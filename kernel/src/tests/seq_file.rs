@@ -0,0 +1,145 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! seq_file 与 /proc 按需生成单元测试
+//!
+//! 小缓冲区顺序读取与一次读完一致且每条记录只生成一次、任意位置读取从头重建、
+//! 列宽补齐、/proc 文件经文件描述符分段读取与 read_file 一致
+
+use alloc::vec::Vec;
+use core::fmt::Write;
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+use crate::println;
+use crate::fs::file::FileFlags;
+use crate::fs::procfs;
+use crate::fs::seq_file::SeqFile;
+use crate::fs::vfs;
+
+const NR_RECORDS: usize = 50;
+
+/// 生成函数被调用的次数
+static NR_SHOWS: AtomicUsize = AtomicUsize::new(0);
+
+/// 第 index 条记录是 "record <index>: " 加上 index % 7 个 '#'
+fn test_show(data: usize, index: usize, m: &mut SeqFile) -> bool {
+    NR_SHOWS.fetch_add(1, Ordering::Relaxed);
+    if index >= data {
+        return false;
+    }
+    let _ = write!(m, "record {}: ", index);
+    for _ in 0..index % 7 {
+        m.puts("#");
+    }
+    m.puts("\n");
+    true
+}
+
+fn expected() -> Vec<u8> {
+    let mut content = Vec::new();
+    for index in 0..NR_RECORDS {
+        content.extend_from_slice(alloc::format!("record {}: ", index).as_bytes());
+        content.extend(core::iter::repeat(b'#').take(index % 7));
+        content.push(b'\n');
+    }
+    content
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_seq_file() {
+    println!("test: ===== Starting seq_file Tests =====");
+
+    let content = expected();
+
+    // 1. 7 字节一次顺序读取，每条记录只生成一次
+    println!("test: 1. Testing sequential reads with a small buffer...");
+    NR_SHOWS.store(0, Ordering::Relaxed);
+    let mut seq = SeqFile::new(test_show, NR_RECORDS);
+    let mut out = Vec::new();
+    let mut buf = [0u8; 7];
+    loop {
+        let n = seq.read(out.len() as u64, &mut buf);
+        if n == 0 {
+            break;
+        }
+        out.extend_from_slice(&buf[..n]);
+    }
+    assert_eq!(out, content);
+    let nr_shows = NR_SHOWS.load(Ordering::Relaxed);
+    assert!(nr_shows <= NR_RECORDS + 2, "{} show calls for {} records", nr_shows, NR_RECORDS);
+    println!("test:    SUCCESS - {} bytes in 7-byte reads, {} show calls", out.len(), nr_shows);
+
+    // 2. 任意位置读取：与上次结束位置不同时从头重建
+    println!("test: 2. Testing reads at arbitrary offsets...");
+    for &(pos, len) in &[(0usize, 5usize), (333, 40), (12, 1), (content.len() - 3, 10), (100, 200)] {
+        let mut buf = [0u8; 256];
+        let n = seq.read(pos as u64, &mut buf[..len]);
+        let end = (pos + len).min(content.len());
+        assert_eq!(&buf[..n], &content[pos..end], "pos {} len {}", pos, len);
+    }
+    let mut buf = [0u8; 16];
+    assert_eq!(seq.read(content.len() as u64 + 100, &mut buf), 0);
+    assert_eq!(SeqFile::new(test_show, 0).read_to_end(), Vec::<u8>::new());
+    println!("test:    SUCCESS - offset reads match the full content");
+
+    // 3. 列宽补齐
+    println!("test: 3. Testing setwidth and pad...");
+    fn padded(_data: usize, index: usize, m: &mut SeqFile) -> bool {
+        if index > 0 {
+            return false;
+        }
+        m.setwidth(10);
+        m.puts("abc");
+        m.pad();
+        m.puts("name\n");
+        m.setwidth(2);
+        m.puts("long");
+        m.pad();
+        m.puts("\n");
+        true
+    }
+    assert_eq!(SeqFile::new(padded, 0).read_to_end(), b"abc       name\nlong\n".to_vec());
+    println!("test:    SUCCESS - columns padded to the set width");
+
+    // 4. /proc 文件经文件描述符分段读取
+    println!("test: 4. Testing /proc reads through a file descriptor...");
+    if crate::sched::get_current_fdtable().is_none() {
+        println!("test:    SKIPPED - no fdtable");
+    } else {
+        for path in ["/proc/meminfo", "/proc/cpuinfo", "/proc/self/maps", "/proc/version"] {
+            let fd = vfs::file_open(path, FileFlags::O_RDONLY, 0).expect("open /proc file");
+            let mut out = Vec::new();
+            let mut buf = [0u8; 13];
+            loop {
+                let n = vfs::file_read(fd, &mut buf, buf.len()).expect("read /proc file");
+                if n == 0 {
+                    break;
+                }
+                out.extend_from_slice(&buf[..n]);
+            }
+            let _ = vfs::file_close(fd);
+            let whole = procfs::read_file(&path["/proc".len()..]).unwrap_or_default();
+            // meminfo 的数值随时变化，比较行数与各行的名称
+            let names = |data: &[u8]| -> Vec<Vec<u8>> {
+                data.split(|&b| b == b'\n')
+                    .map(|line| line.split(|&b| b == b':' || b == b' ').next().unwrap_or(&[]).to_vec())
+                    .collect()
+            };
+            assert_eq!(names(&out), names(&whole), "{}", path);
+        }
+        assert!(matches!(vfs::file_open("/proc/meminfo", FileFlags::O_WRONLY, 0), Err(e) if e == -13));
+        assert!(vfs::file_open("/proc/no_such_file", FileFlags::O_RDONLY, 0).is_err());
+        println!("test:    SUCCESS - fd reads match read_file");
+    }
+
+    // 5. 生成的文件大小为 0
+    println!("test: 5. Testing size of generated files...");
+    let sb = procfs::get_procfs_sb().expect("procfs initialized");
+    assert_eq!(sb.lookup("/meminfo").expect("meminfo").size(), 0);
+    assert_eq!(sb.lookup("/slabinfo").expect("slabinfo").size(), 0);
+    println!("test:    SUCCESS - generated files report size 0");
+
+    println!("test: ===== seq_file Tests Completed =====");
+}
@@ -106,7 +106,7 @@ pub fn test_signal() {
 
     // 测试 8: 信号动作设置
     println!("test: 8. Testing set_action()...");
-    let mut sig_struct = SignalStruct::new();
+    let sig_struct = SignalStruct::new();
 
     // 设置 SIGTERM 的处理动作为 ignore
     let ignore_action = SigAction::ignore();
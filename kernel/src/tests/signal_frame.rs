@@ -0,0 +1,203 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：信号递送快速路径与用户栈信号帧
+//
+// 测试内容：
+// 1. sigpending 标志的置位、recalc 与按屏蔽字出队
+// 2. 标准信号合并、实时信号按顺序排队
+// 3. rt_sigframe / ucontext / sigcontext 布局与 Linux riscv 一致
+// 4. setup_rt_frame 与 restore_sigcontext 往返
+// 5. rt_sigaction 系统调用
+
+use alloc::vec;
+use core::mem::{offset_of, size_of};
+use crate::println;
+use crate::arch::riscv64::syscall::{syscall_handler, SyscallFrame};
+use crate::arch::riscv64::trap::TrapFrame;
+use crate::signal::*;
+
+const EINVAL: u64 = -22_i64 as u64;
+
+const SIGUSR1: i32 = Signal::SIGUSR1 as i32;
+const SIGUSR2: i32 = Signal::SIGUSR2 as i32;
+const SIGRT8: i32 = SIGRTMIN + 8;
+
+/// 用户地址空间内、没有任何映射的地址
+const UNMAPPED: u64 = 0x10_0000_0000;
+
+fn rt_sigaction_syscall(sig: i32, act: u64, oldact: u64, sigsetsize: u64) -> u64 {
+    let mut frame = SyscallFrame::default();
+    frame.a7 = 134;
+    frame.a0 = sig as u64;
+    frame.a1 = act;
+    frame.a2 = oldact;
+    frame.a3 = sigsetsize;
+    syscall_handler(&mut frame);
+    frame.a0
+}
+
+pub fn test_signal_frame() {
+    println!("test: ===== Testing Signal Fast Path and Frames =====");
+
+    // 测试 1: sigpending 标志
+    println!("test: 1. Testing sigpending flag...");
+    let pending = SigPending::new();
+    assert!(!pending.sigpending());
+    pending.add(SIGUSR1);
+    assert!(pending.sigpending());
+    assert!(pending.dequeue(sigmask(SIGUSR1)).is_none());
+    pending.recalc(sigmask(SIGUSR1));
+    assert!(!pending.sigpending());
+    pending.recalc(0);
+    assert!(pending.sigpending());
+    assert_eq!(pending.dequeue(0).map(|info| info.si_signo), Some(SIGUSR1));
+    pending.recalc(0);
+    assert!(!pending.sigpending());
+    pending.add(Signal::SIGKILL as i32);
+    pending.recalc(!0);
+    assert!(pending.sigpending());
+    assert_eq!(pending.dequeue(!0).map(|info| info.si_signo), Some(Signal::SIGKILL as i32));
+    println!("test:    SUCCESS - flag follows pending and blocked signals");
+
+    // 测试 2: 合并与排队
+    println!("test: 2. Testing standard and real-time queueing...");
+    pending.add_info(SigInfo::new(SIGUSR2, si_code::SI_USER, 1, 0));
+    pending.add_info(SigInfo::new(SIGUSR2, si_code::SI_USER, 2, 0));
+    for pid in 1..=3 {
+        pending.add_info(SigInfo::new(SIGRT8, si_code::SI_USER, pid, 0));
+    }
+    let usr2 = pending.dequeue(0).unwrap();
+    assert_eq!((usr2.si_signo, usr2.si_pid), (SIGUSR2, 1));
+    for pid in 1..=3 {
+        assert!(pending.has(SIGRT8));
+        let info = pending.dequeue(0).unwrap();
+        assert_eq!((info.si_signo, info.si_pid), (SIGRT8, pid));
+    }
+    assert!(!pending.has(SIGRT8));
+    assert!(pending.dequeue(0).is_none());
+    pending.add(SIGRT8);
+    pending.add(SIGRT8);
+    pending.remove(SIGRT8);
+    assert!(pending.queue.is_empty());
+    assert!(pending.dequeue(0).is_none());
+    println!("test:    SUCCESS - standard signals coalesce, RT signals queue in order");
+
+    // 测试 3: 布局
+    println!("test: 3. Testing frame layout...");
+    assert_eq!(size_of::<UserSigInfo>(), 128);
+    assert_eq!(offset_of!(UContext, uc_sigmask), 40);
+    assert_eq!(offset_of!(UContext, uc_mcontext), 176);
+    assert_eq!(size_of::<SigContext>(), 784);
+    assert_eq!(offset_of!(RtSigFrame, uc), 128);
+    assert_eq!(RtSigFrame::size(), 1088);
+    println!("test:    SUCCESS - layout matches struct rt_sigframe");
+
+    // 测试 4: 建立与恢复信号帧
+    println!("test: 4. Testing setup_rt_frame/restore_sigcontext...");
+    match crate::sched::current() {
+        Some(task) => unsafe {
+            let task: *mut crate::process::task::Task = task;
+            let saved_mask = (*task).sigmask;
+            (*task).sigmask = sigmask(SIGRT8);
+
+            // trap.S 的布局：用户 tp、原始 sp，然后是 TrapFrame
+            let mut words = vec![0u64; 2 + size_of::<TrapFrame>() / 8];
+            let frame = words.as_mut_ptr().add(2) as *mut TrapFrame;
+            let stack = vec![0u64; 512];
+            let stack_top = stack.as_ptr() as u64 + 4096 - 8;
+            (*frame).set_user_tp(0x7000);
+            (*frame).set_orig_sp(stack_top);
+            (*frame).sepc = 0x1000;
+            (*frame).ra = 0x2000;
+            (*frame).gp = 0x3000;
+            (*frame).t0 = 5;
+            (*frame).s2 = 18;
+            (*frame).t6 = 31;
+            [(*frame).a0, (*frame).a1, (*frame).a2, (*frame).a7] = [100, 101, 102, 107];
+
+            let action = SigAction {
+                sa_handler: 0x4000,
+                sa_flags: SigFlags::new(0),
+                sa_mask: sigmask(SIGUSR2) | sigmask(Signal::SIGKILL as i32),
+            };
+            let info = SigInfo::new(SIGUSR1, si_code::SI_USER, 42, 0);
+            assert!(setup_rt_frame(task, frame, &info, &action));
+
+            let addr = (*frame).orig_sp();
+            assert_eq!(addr % 16, 0);
+            assert!(addr + RtSigFrame::size() as u64 <= stack_top && addr >= stack.as_ptr() as u64);
+            assert_eq!(((*frame).sepc, (*frame).a0), (0x4000, SIGUSR1 as u64));
+            assert_eq!(((*frame).a1, (*frame).a2), (addr, addr + 128));
+            assert_eq!((*frame).ra, crate::arch::riscv64::vdso::sigreturn_trampoline());
+            assert_eq!((*task).sigmask, sigmask(SIGRT8) | sigmask(SIGUSR1) | sigmask(SIGUSR2));
+            let rt = &*(addr as *const RtSigFrame);
+            assert_eq!((rt.info.si_signo, rt.info.si_pid), (SIGUSR1, 42));
+            assert_eq!(rt.uc.uc_sigmask, sigmask(SIGRT8));
+            let regs = &rt.uc.uc_mcontext.sc_regs;
+            assert_eq!((regs[sc_reg::PC], regs[sc_reg::SP], regs[sc_reg::TP]), (0x1000, stack_top, 0x7000));
+
+            // 处理函数返回：跳板执行时 sp 仍指向信号帧
+            (*frame).a0 = 0;
+            (*frame).s2 = 0;
+            (*frame).ra = 0;
+            assert_eq!(restore_sigcontext(task, frame), Ok(100));
+            assert_eq!(((*frame).sepc, (*frame).ra, (*frame).gp), (0x1000, 0x2000, 0x3000));
+            assert_eq!(((*frame).t0, (*frame).s2, (*frame).t6, (*frame).a7), (5, 18, 31, 107));
+            assert_eq!(((*frame).orig_sp(), (*frame).user_tp()), (stack_top, 0x7000));
+            assert_eq!((*task).sigmask, sigmask(SIGRT8));
+
+            // SA_NODEFER 不屏蔽信号本身；栈不可写时不修改任何状态
+            let nodefer = SigAction { sa_flags: SigFlags::new(SigFlags::SA_NODEFER), ..action };
+            assert!(setup_rt_frame(task, frame, &info, &nodefer));
+            assert_eq!((*task).sigmask & sigmask(SIGUSR1), 0);
+            assert!(restore_sigcontext(task, frame).is_ok());
+            (*frame).set_orig_sp(UNMAPPED);
+            assert!(!setup_rt_frame(task, frame, &info, &action));
+            assert_eq!(((*frame).sepc, (*task).sigmask), (0x1000, sigmask(SIGRT8)));
+            assert!(restore_sigcontext(task, frame).is_err());
+
+            (*task).sigmask = saved_mask;
+            (*task).pending.recalc(saved_mask);
+            println!("test:    SUCCESS - registers and mask survive the round trip");
+        },
+        None => println!("test:    SKIPPED - no current task"),
+    }
+
+    // 测试 5: rt_sigaction
+    println!("test: 5. Testing rt_sigaction syscall...");
+    let has_signal = crate::sched::current().map_or(false, |task| task.signal.is_some());
+    if has_signal {
+        let mut saved = [0u64; 3];
+        let mut query = [0u64; 3];
+        assert_eq!(rt_sigaction_syscall(SIGUSR1, 0, saved.as_mut_ptr() as u64, 4), EINVAL);
+        assert_eq!(rt_sigaction_syscall(SIGUSR1, 0, saved.as_mut_ptr() as u64, 8), 0);
+
+        let act = [0x4000u64, SigFlags::SA_NODEFER as u64, sigmask(SIGUSR2) | sigmask(Signal::SIGSTOP as i32)];
+        assert_eq!(rt_sigaction_syscall(SIGUSR1, act.as_ptr() as u64, 0, 8), 0);
+        assert_eq!(rt_sigaction_syscall(SIGUSR1, 0, query.as_mut_ptr() as u64, 8), 0);
+        assert_eq!(query, [0x4000, SigFlags::SA_NODEFER as u64, sigmask(SIGUSR2)]);
+
+        // SIGKILL 可以查询，不能修改
+        assert_eq!(rt_sigaction_syscall(Signal::SIGKILL as i32, 0, query.as_mut_ptr() as u64, 8), 0);
+        assert_eq!(rt_sigaction_syscall(Signal::SIGKILL as i32, act.as_ptr() as u64, 0, 8), EINVAL);
+        assert_eq!(rt_sigaction_syscall(0, 0, 0, 8), EINVAL);
+
+        // 改为忽略时丢弃已待处理的信号
+        let task = crate::sched::current().unwrap();
+        task.pending.add(SIGUSR1);
+        let ignore = [SigActionKind::Ignore as u64, 0, 0];
+        assert_eq!(rt_sigaction_syscall(SIGUSR1, ignore.as_ptr() as u64, 0, 8), 0);
+        assert!(!task.pending.has(SIGUSR1));
+
+        assert_eq!(rt_sigaction_syscall(SIGUSR1, saved.as_ptr() as u64, 0, 8), 0);
+        task.pending.recalc(task.sigmask);
+        println!("test:    SUCCESS - set, query, SIGKILL and SIG_IGN flush");
+    } else {
+        println!("test:    SKIPPED - no current task with signal handlers");
+    }
+
+    println!("test: Signal fast path and frame testing completed.");
+}
@@ -0,0 +1,72 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：跨 CPU 函数调用
+//
+// 测试内容：
+// 1. smp_call_function_single 目标是本 CPU 时直接执行
+// 2. on_each_cpu 同步调用在所有能处理 IPI 的 CPU 上执行
+// 3. 异步调用入队后返回，之后的同步调用按顺序等到它执行完
+// 4. 目标只有本 CPU 时不发送 IPI
+
+use core::sync::atomic::{AtomicUsize, Ordering};
+
+use crate::arch::ipi::*;
+use crate::println;
+
+static CALLS: AtomicUsize = AtomicUsize::new(0);
+static CPUS_SEEN: AtomicUsize = AtomicUsize::new(0);
+
+fn count_call(info: usize) {
+    CALLS.fetch_add(info, Ordering::Relaxed);
+    CPUS_SEEN.fetch_or(1 << crate::arch::cpu_id(), Ordering::Relaxed);
+}
+
+fn reset() {
+    CALLS.store(0, Ordering::Relaxed);
+    CPUS_SEEN.store(0, Ordering::Relaxed);
+}
+
+pub fn test_smp_call() {
+    println!("test: ===== Testing Cross-CPU Function Calls =====");
+
+    let this_cpu = crate::arch::cpu_id();
+    let online = ipi_ready_mask() | (1 << this_cpu);
+    let others = online & !(1 << this_cpu);
+
+    // 测试 1: 本 CPU
+    println!("test: 1. Testing call on this CPU...");
+    reset();
+    smp_call_function_single(this_cpu, count_call, 1, true);
+    assert_eq!(CALLS.load(Ordering::Relaxed), 1);
+    assert_eq!(CPUS_SEEN.load(Ordering::Relaxed), 1 << this_cpu);
+    println!("test:    SUCCESS - local call runs inline");
+
+    // 测试 2: on_each_cpu
+    println!("test: 2. Testing on_each_cpu...");
+    reset();
+    on_each_cpu(count_call, 1, true);
+    assert_eq!(CALLS.load(Ordering::Relaxed), online.count_ones() as usize);
+    assert_eq!(CPUS_SEEN.load(Ordering::Relaxed), online);
+    println!("test:    SUCCESS - ran on {} CPUs (mask {:#x})", online.count_ones(), online);
+
+    // 测试 3: 异步调用
+    println!("test: 3. Testing async call followed by sync call...");
+    reset();
+    smp_call_function_many(others, count_call, 10, false);
+    smp_call_function_many(others, count_call, 1, true);
+    assert_eq!(CALLS.load(Ordering::Relaxed), 11 * others.count_ones() as usize);
+    println!("test:    SUCCESS - async requests complete before later sync ones");
+
+    // 测试 4: 只有本 CPU
+    println!("test: 4. Testing self-only mask...");
+    let (sbi_before, reqs_before) = ipi_stats();
+    smp_call_function_many(1 << this_cpu, count_call, 1, true);
+    send_ipi_mask(1 << this_cpu, IpiType::Reschedule);
+    assert_eq!(ipi_stats(), (sbi_before, reqs_before));
+    println!("test:    SUCCESS - no IPI is sent to self");
+
+    println!("test: Cross-CPU call testing completed.");
+}
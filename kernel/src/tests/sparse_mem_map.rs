@@ -0,0 +1,98 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 稀疏 mem_map 单元测试
+//!
+//! 检查按 section 分配的页描述符：存在的 section 数与统计一致、
+//! 每个 section 首、中、尾页的 pfn 与 Page 指针互相转换、section 内描述符连续、
+//! 空洞与超出范围的 pfn 没有描述符、重复初始化不再分配、
+//! 描述符覆盖原来 64MB 的上限之外
+
+use crate::println;
+use crate::mm::page::{alloc_frame, dealloc_frame};
+use crate::mm::page_desc::{
+    page_desc_stats, page_to_pfn, pfn_to_page, pfn_valid, present_sections, section_nr_to_pfn, sparse_init,
+    total_pages, MAX_PFN, NR_MEM_SECTIONS, PAGES_PER_SECTION, PHYS_MEMORY_BASE,
+};
+use crate::mm::PAGE_SIZE;
+
+/// 原来固定 mem_map 覆盖的页数（64MB）
+const OLD_MAX_PAGES: usize = 16384;
+
+/// 检查 pfn 的描述符存在且能转换回 pfn
+fn check_round_trip(pfn: usize) {
+    let page = pfn_to_page(pfn);
+    assert!(!page.is_null());
+    assert_eq!(page_to_pfn(page), pfn);
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_sparse_mem_map() {
+    println!("test: ===== Starting Sparse mem_map Tests =====");
+
+    // 1. section 的首页有描述符当且仅当该 section 存在
+    println!("test: 1. Testing present sections...");
+    let mut nr_present = 0;
+    let mut last_pfn = 0;
+    for nr in 0..NR_MEM_SECTIONS {
+        if pfn_valid(section_nr_to_pfn(nr)) {
+            nr_present += 1;
+            last_pfn = section_nr_to_pfn(nr) + PAGES_PER_SECTION - 1;
+        }
+    }
+    assert!(nr_present > 0);
+    assert_eq!(nr_present, present_sections());
+    assert!(total_pages() <= nr_present * PAGES_PER_SECTION);
+    assert_eq!(page_desc_stats().total_pages, total_pages());
+    println!("test:    SUCCESS - {} sections, {} managed pages", nr_present, total_pages());
+
+    // 2. 每个存在的 section 内 pfn 与 Page 指针一一对应，描述符连续存放
+    println!("test: 2. Testing pfn <-> page round trip...");
+    for nr in 0..NR_MEM_SECTIONS {
+        let start = section_nr_to_pfn(nr);
+        if !pfn_valid(start) {
+            continue;
+        }
+        for pfn in [start, start + PAGES_PER_SECTION / 2, start + PAGES_PER_SECTION - 1] {
+            check_round_trip(pfn);
+        }
+        let first = pfn_to_page(start);
+        let last = pfn_to_page(start + PAGES_PER_SECTION - 1);
+        assert_eq!(last, unsafe { first.add(PAGES_PER_SECTION - 1) });
+    }
+    println!("test:    SUCCESS - descriptors contiguous within each section");
+
+    // 3. 空洞与超出范围的 pfn 没有描述符
+    println!("test: 3. Testing holes and out-of-range pfns...");
+    // 0 号页与 UART 的 MMIO 区域不是 RAM
+    assert!(!pfn_valid(0));
+    assert!(pfn_to_page(0x1000_0000 / PAGE_SIZE).is_null());
+    assert!(!pfn_valid(MAX_PFN));
+    assert!(pfn_to_page(MAX_PFN + PAGES_PER_SECTION).is_null());
+    assert!(!pfn_valid(usize::MAX));
+    println!("test:    SUCCESS - null returned for holes");
+
+    // 4. 重复调用 sparse_init 直接返回已有的页数，不再分配 section
+    println!("test: 4. Testing repeated sparse_init...");
+    let managed = total_pages();
+    assert_eq!(sparse_init(&[]), managed);
+    assert_eq!(sparse_init(&[(PHYS_MEMORY_BASE / PAGE_SIZE, OLD_MAX_PAGES)]), managed);
+    assert_eq!((present_sections(), total_pages()), (nr_present, managed));
+    println!("test:    SUCCESS - existing sections kept");
+
+    // 5. 分配的页都有描述符；RAM 超过 64MB 时描述符覆盖原来的上限之外
+    println!("test: 5. Testing coverage of allocated frames...");
+    let frame = alloc_frame().expect("alloc_frame failed");
+    check_round_trip(frame.number);
+    dealloc_frame(frame);
+    if managed > OLD_MAX_PAGES {
+        let limit = PHYS_MEMORY_BASE / PAGE_SIZE + OLD_MAX_PAGES;
+        assert!(last_pfn >= limit);
+        check_round_trip(limit);
+    }
+    println!("test:    SUCCESS - highest described pfn {:#x}", last_pfn);
+
+    println!("test: ===== Sparse mem_map Tests Completed =====");
+}
@@ -0,0 +1,97 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：票据锁与 MCS 排队锁
+//
+// 测试内容：
+// 1. 票据锁的获取、释放与 try_lock
+// 2. MCS 排队锁的获取、释放与 try_lock
+// 3. lock_irqsave 持有期间关中断，释放后恢复
+// 4. 锁类统计与 /proc/lock_stat
+
+use crate::println;
+use crate::sync::spinlock::*;
+
+static TEST_LOCK_CLASS: LockClass = LockClass::new("test_lock");
+
+static TEST_LOCK: TicketLock<u64> = TicketLock::with_class(0, &TEST_LOCK_CLASS);
+
+fn sie_enabled() -> bool {
+    let sstatus: u64;
+    unsafe { core::arch::asm!("csrr {}, sstatus", out(reg) sstatus) };
+    sstatus & 0x2 != 0
+}
+
+pub fn test_spinlock() {
+    println!("test: ===== Testing Ticket and Queued Spinlocks =====");
+
+    // 测试 1: 票据锁
+    println!("test: 1. Testing ticket lock...");
+    let ticket = TicketLock::new(1u32);
+    {
+        let mut guard = ticket.lock();
+        *guard += 1;
+        assert!(ticket.is_locked());
+        assert!(ticket.try_lock().is_none());
+    }
+    assert!(!ticket.is_locked());
+    for _ in 0..3 {
+        *ticket.lock() += 1;
+    }
+    assert_eq!(*ticket.try_lock().unwrap(), 5);
+    println!("test:    SUCCESS - tickets are served in order");
+
+    // 测试 2: 排队锁
+    println!("test: 2. Testing MCS queued lock...");
+    let mut queued = QueuedSpinLock::new(0u32);
+    {
+        let mut guard = queued.lock();
+        *guard = 7;
+        assert!(queued.is_locked());
+        assert!(queued.try_lock().is_none());
+    }
+    assert!(!queued.is_locked());
+    *queued.try_lock().unwrap() += 1;
+    assert_eq!(*queued.get_mut(), 8);
+    println!("test:    SUCCESS - lock word and queue tail are released");
+
+    // 测试 3: lock_irqsave
+    println!("test: 3. Testing lock_irqsave...");
+    let was_enabled = sie_enabled();
+    {
+        let mut guard = queued.lock_irqsave();
+        *guard += 1;
+        assert!(!sie_enabled());
+    }
+    assert_eq!(sie_enabled(), was_enabled);
+    assert_eq!(*queued.lock(), 9);
+    println!("test:    SUCCESS - interrupts are off while held and restored after");
+
+    // 测试 4: 统计
+    println!("test: 4. Testing lock statistics...");
+    let was_on = lock_stat_enabled();
+    set_lock_stat(false);
+    *TEST_LOCK.lock() += 1;
+    assert_eq!(TEST_LOCK_CLASS.stat().0, 0);
+
+    set_lock_stat(true);
+    for _ in 0..4 {
+        *TEST_LOCK.lock() += 1;
+    }
+    let guard = TEST_LOCK.lock();
+    assert!(TEST_LOCK.try_lock().is_none());
+    drop(guard);
+    let (acquisitions, contended, spins, _) = TEST_LOCK_CLASS.stat();
+    assert_eq!((acquisitions, contended, spins), (5, 0, 0));
+    assert!(generate_lock_stat().contains("test_lock"));
+
+    assert_eq!(write_lock_stat(b"reset\n"), Ok(6));
+    assert_eq!(TEST_LOCK_CLASS.stat(), (0, 0, 0, 0));
+    assert!(write_lock_stat(b"on").is_err());
+    set_lock_stat(was_on);
+    println!("test:    SUCCESS - acquisitions counted only while enabled");
+
+    println!("test: Spinlock testing completed.");
+}
@@ -0,0 +1,66 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! statx / newfstatat 单元测试
+//!
+//! struct statx 的布局与 Linux uapi 一致、Stat 到 Statx 的转换（设备号拆分、掩码），
+//! 以及按路径查找文件状态
+
+use core::mem::{offset_of, size_of};
+
+use crate::println;
+use crate::fs::stat::{Stat, Statx, STATX_BASIC_STATS, STATX_INO, STATX_TYPE};
+use crate::fs::{path_stat, rootfs};
+
+#[cfg(feature = "unit-test")]
+pub fn test_statx() {
+    println!("test: ===== Starting statx Tests =====");
+
+    // 1. 布局
+    println!("test: 1. Testing struct statx layout...");
+    assert_eq!(size_of::<Statx>(), 256);
+    assert_eq!(offset_of!(Statx, stx_mode), 28);
+    assert_eq!(offset_of!(Statx, stx_ino), 32);
+    assert_eq!(offset_of!(Statx, stx_size), 40);
+    assert_eq!(offset_of!(Statx, stx_atime), 64);
+    assert_eq!(offset_of!(Statx, stx_mtime), 112);
+    assert_eq!(offset_of!(Statx, stx_rdev_major), 128);
+    assert_eq!(offset_of!(Statx, stx_dev_minor), 140);
+    println!("test:    SUCCESS - struct statx is 256 bytes with uapi offsets");
+
+    // 2. 由 Stat 转换
+    println!("test: 2. Testing Stat to Statx conversion...");
+    let mut stat = Stat::new();
+    stat.st_ino = 12;
+    stat.st_size = 5000;
+    stat.st_rdev = 0x0d40;  // 13:64
+    stat.st_dev = (8 << 8) | 1;  // 8:1
+    stat.st_mtime = 100;
+    stat.st_mtime_nsec = 7;
+    stat.set_regular_file();
+    stat.set_mode(0o640);
+    let stx = Statx::from_stat(&stat, STATX_TYPE | STATX_INO);
+    assert_eq!(stx.stx_mask, STATX_TYPE | STATX_INO);
+    assert_eq!(stx.stx_mode, 0o100640);
+    assert_eq!((stx.stx_ino, stx.stx_size), (12, 5000));
+    assert_eq!((stx.stx_rdev_major, stx.stx_rdev_minor), (13, 64));
+    assert_eq!((stx.stx_dev_major, stx.stx_dev_minor), (8, 1));
+    assert_eq!((stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec), (100, 7));
+    println!("test:    SUCCESS - fields, device numbers and mask converted");
+
+    // 3. 按路径查找
+    println!("test: 3. Testing path_stat...");
+    let mut stat = Stat::new();
+    assert!(path_stat("/no/such/file", STATX_BASIC_STATS, &mut stat).is_err());
+    if unsafe { rootfs::get_rootfs() }.is_null() {
+        println!("test:    SKIPPED - rootfs not mounted");
+    } else {
+        assert_eq!(path_stat("/", STATX_TYPE, &mut stat), Ok(STATX_BASIC_STATS));
+        assert!(stat.is_directory());
+        println!("test:    SUCCESS - missing path fails, root is a directory");
+    }
+
+    println!("test: ===== statx Tests Completed =====");
+}
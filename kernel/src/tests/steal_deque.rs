@@ -0,0 +1,79 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：工作窃取队列
+//
+// 测试内容：
+// 1. 所有者 push/pop 为 LIFO 顺序
+// 2. 窃取者 steal 为 FIFO 顺序
+// 3. 队列满时 push 失败
+// 4. 最后一个元素 pop 与 steal 只有一方成功
+
+use crate::println;
+use crate::process::task::Task;
+use crate::sched::deque::{StealDeque, STEAL_DEQUE_SIZE};
+
+pub fn test_steal_deque() {
+    println!("test: ===== Testing Work-Stealing Deque =====");
+
+    // 这里只比较指针，不解引用
+    let task = |i: usize| (0x1000 + i * 0x100) as *mut Task;
+
+    // 测试 1: 所有者端 LIFO
+    println!("test: 1. Testing owner push/pop (LIFO)...");
+    let deque = StealDeque::new();
+    unsafe {
+        assert!(deque.push(task(1)));
+        assert!(deque.push(task(2)));
+        assert!(deque.push(task(3)));
+        assert_eq!(deque.len(), 3, "deque should hold 3 tasks");
+        assert_eq!(deque.pop(), Some(task(3)));
+        assert_eq!(deque.pop(), Some(task(2)));
+        assert_eq!(deque.pop(), Some(task(1)));
+        assert_eq!(deque.pop(), None, "empty deque should pop None");
+    }
+    println!("test:    SUCCESS - pop returns newest first");
+
+    // 测试 2: 窃取端 FIFO
+    println!("test: 2. Testing steal (FIFO)...");
+    unsafe {
+        assert!(deque.push(task(4)));
+        assert!(deque.push(task(5)));
+    }
+    assert_eq!(deque.steal(), Some(task(4)));
+    assert_eq!(deque.steal(), Some(task(5)));
+    assert_eq!(deque.steal(), None, "empty deque should steal None");
+    assert!(deque.is_empty());
+    println!("test:    SUCCESS - steal returns oldest first");
+
+    // 测试 3: 容量上限
+    println!("test: 3. Testing full deque...");
+    unsafe {
+        for i in 0..STEAL_DEQUE_SIZE {
+            assert!(deque.push(task(i)), "push within capacity should succeed");
+        }
+        assert!(!deque.push(task(STEAL_DEQUE_SIZE)), "push on full deque should fail");
+        // 环形缓冲区回绕后仍保持顺序
+        assert_eq!(deque.steal(), Some(task(0)));
+        assert!(deque.push(task(STEAL_DEQUE_SIZE)));
+        assert_eq!(deque.pop(), Some(task(STEAL_DEQUE_SIZE)));
+        while deque.pop().is_some() {}
+    }
+    println!("test:    SUCCESS - capacity = {}", STEAL_DEQUE_SIZE);
+
+    // 测试 4: 最后一个元素
+    println!("test: 4. Testing last element handoff...");
+    unsafe {
+        assert!(deque.push(task(7)));
+        assert_eq!(deque.steal(), Some(task(7)));
+        assert_eq!(deque.pop(), None, "stolen task must not be popped again");
+        assert!(deque.push(task(8)));
+        assert_eq!(deque.pop(), Some(task(8)));
+        assert_eq!(deque.steal(), None, "popped task must not be stolen again");
+    }
+    println!("test:    SUCCESS - each task is taken exactly once");
+
+    println!("test: ===== Work-Stealing Deque Test Completed =====");
+}
@@ -0,0 +1,270 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内核字符串函数单元测试
+//!
+//! memcpy / memmove / memset / memcmp / strlen 的标量与向量实现，
+//! 覆盖各种长度与源、目的地址的对齐组合，结果与逐字节的参考实现比较；
+//! 打开向量实现时复制到尚未访问的匿名用户映射，缺页处理不破坏复制结果
+
+use alloc::sync::Arc;
+
+use crate::println;
+use crate::arch::riscv64::cpu::has_vector;
+use crate::arch::riscv64::mm::{create_user_address_space, map, AddressSpace};
+use crate::arch::riscv64::string::{set_string_rvv, string_rvv_enabled};
+use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+use crate::mm::vma::{VmaFlags, VmaType};
+
+extern "C" {
+    fn memcpy(dst: *mut u8, src: *const u8, n: usize) -> *mut u8;
+    fn memmove(dst: *mut u8, src: *const u8, n: usize) -> *mut u8;
+    fn memset(dst: *mut u8, c: i32, n: usize) -> *mut u8;
+    fn memcmp(a: *const u8, b: *const u8, n: usize) -> i32;
+    fn strlen(s: *const u8) -> usize;
+}
+
+const LENGTHS: [usize; 15] = [0, 1, 7, 8, 15, 16, 17, 63, 64, 65, 255, 256, 257, 1000, 4096];
+const BUF_SIZE: usize = 4096 + 32;
+
+static mut SRC: [u8; BUF_SIZE] = [0; BUF_SIZE];
+static mut DST: [u8; BUF_SIZE] = [0; BUF_SIZE];
+
+fn pattern(i: usize) -> u8 {
+    (i * 7 + 3) as u8
+}
+
+/// 逐字节读取，避免被编译器替换为被测函数
+fn byte(buf: *const u8, i: usize) -> u8 {
+    unsafe { core::ptr::read_volatile(buf.add(i)) }
+}
+
+fn fill(buf: *mut u8, seed: usize) {
+    for i in 0..BUF_SIZE {
+        unsafe { core::ptr::write_volatile(buf.add(i), pattern(i + seed)) };
+    }
+}
+
+fn check_memcpy(src: *mut u8, dst: *mut u8) {
+    for &len in &LENGTHS {
+        for soff in 0..8 {
+            for doff in 0..8 {
+                fill(src, 0);
+                fill(dst, 100);
+                let ret = unsafe { memcpy(dst.add(doff), src.add(soff), len) };
+                assert_eq!(ret, unsafe { dst.add(doff) });
+                for i in 0..BUF_SIZE {
+                    let expected = if i >= doff && i < doff + len { pattern(i - doff + soff) } else { pattern(i + 100) };
+                    assert_eq!(byte(dst, i), expected, "memcpy len={} soff={} doff={} i={}", len, soff, doff, i);
+                }
+            }
+        }
+    }
+}
+
+fn check_memmove(buf: *mut u8) {
+    for &len in &LENGTHS {
+        if len + 16 > BUF_SIZE {
+            continue;
+        }
+        for soff in 0..16 {
+            for doff in 0..16 {
+                fill(buf, 0);
+                unsafe { memmove(buf.add(doff), buf.add(soff), len) };
+                for i in 0..len + 16 {
+                    let expected = if i >= doff && i < doff + len { pattern(i - doff + soff) } else { pattern(i) };
+                    assert_eq!(byte(buf, i), expected, "memmove len={} soff={} doff={} i={}", len, soff, doff, i);
+                }
+            }
+        }
+    }
+}
+
+fn check_memset(dst: *mut u8) {
+    for &len in &LENGTHS {
+        for doff in 0..8 {
+            fill(dst, 0);
+            let ret = unsafe { memset(dst.add(doff), 0x1a5, len) };
+            assert_eq!(ret, unsafe { dst.add(doff) });
+            for i in 0..BUF_SIZE {
+                let expected = if i >= doff && i < doff + len { 0xa5 } else { pattern(i) };
+                assert_eq!(byte(dst, i), expected, "memset len={} doff={} i={}", len, doff, i);
+            }
+        }
+    }
+}
+
+fn check_memcmp(a: *mut u8, b: *mut u8) {
+    for &len in &LENGTHS {
+        for aoff in 0..8 {
+            for boff in 0..8 {
+                for i in 0..len {
+                    unsafe {
+                        core::ptr::write_volatile(a.add(aoff + i), pattern(i));
+                        core::ptr::write_volatile(b.add(boff + i), pattern(i));
+                    }
+                }
+                assert_eq!(unsafe { memcmp(a.add(aoff), b.add(boff), len) }, 0, "memcmp len={}", len);
+                if len == 0 {
+                    continue;
+                }
+                // 最后一个字节不同，差值按无符号字节计算
+                let last = boff + len - 1;
+                let orig = byte(b, last);
+                unsafe { core::ptr::write_volatile(b.add(last), orig.wrapping_add(0x80)) };
+                let r = unsafe { memcmp(a.add(aoff), b.add(boff), len) };
+                assert_eq!(r, orig as i32 - orig.wrapping_add(0x80) as i32, "memcmp len={} aoff={} boff={}",
+                           len, aoff, boff);
+                unsafe { core::ptr::write_volatile(b.add(last), orig) };
+            }
+        }
+    }
+}
+
+fn check_strlen(buf: *mut u8) {
+    for &len in &LENGTHS {
+        if len + 8 >= BUF_SIZE {
+            continue;
+        }
+        for off in 0..8 {
+            for i in 0..BUF_SIZE {
+                unsafe { core::ptr::write_volatile(buf.add(i), b'a' + (i % 26) as u8) };
+            }
+            unsafe { core::ptr::write_volatile(buf.add(off + len), 0) };
+            assert_eq!(unsafe { strlen(buf.add(off)) }, len, "strlen len={} off={}", len, off);
+        }
+    }
+}
+
+fn run_all(name: &str) {
+    let src = unsafe { core::ptr::addr_of_mut!(SRC) as *mut u8 };
+    let dst = unsafe { core::ptr::addr_of_mut!(DST) as *mut u8 };
+    check_memcpy(src, dst);
+    check_memmove(dst);
+    check_memset(dst);
+    check_memcmp(src, dst);
+    check_strlen(dst);
+    println!("test:    SUCCESS - {} memcpy/memmove/memset/memcmp/strlen match the byte reference", name);
+}
+
+/// 复制、填充到尚未访问的匿名用户映射：每次写入都在函数内部缺页
+fn check_user_mapping() {
+    const SSTATUS_SUM: usize = 0x40000;
+    const NR_PAGES: usize = 3;
+
+    let current = match crate::sched::current() {
+        Some(task) => task,
+        None => {
+            println!("test:    SKIP - no current task");
+            return;
+        }
+    };
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let aspace = Arc::new(unsafe { AddressSpace::new(root_ppn) });
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let start = aspace
+        .mmap(PageVirtAddr::new(0), NR_PAGES * PAGE_SIZE, flags, VmaType::Anonymous,
+              map::MAP_PRIVATE | map::MAP_ANONYMOUS)
+        .expect("mmap failed")
+        .as_usize();
+    let user = start as *mut u8;
+    for i in 0..NR_PAGES {
+        assert!(aspace.translate(PageVirtAddr::new(start + i * PAGE_SIZE)).is_none());
+    }
+
+    // 缺页由当前任务的地址空间处理；用户页表包含内核映射，结束后恢复原来的 satp
+    let old_mm = current.address_space_arc();
+    current.set_shared_address_space(Some(aspace.clone()));
+    let old_satp: u64;
+    let old_sstatus: usize;
+    unsafe {
+        core::arch::asm!("csrr {}, satp", out(reg) old_satp);
+        aspace.enable();
+        core::arch::asm!("csrrs {}, sstatus, {}", out(reg) old_sstatus, in(reg) SSTATUS_SUM);
+    }
+
+    // 跨越前两页的 memcpy，从第一页的非对齐偏移开始
+    let src = unsafe { core::ptr::addr_of_mut!(SRC) as *mut u8 };
+    fill(src, 0);
+    let len = PAGE_SIZE;
+    let ret = unsafe { memcpy(user.add(8), src, len) };
+    assert_eq!(ret, unsafe { user.add(8) });
+    for i in 0..len {
+        assert_eq!(byte(user, 8 + i), pattern(i), "user memcpy i={}", i);
+    }
+    // 复制结果可用 memcmp 比较，未写入的字节保持为零
+    assert_eq!(unsafe { memcmp(user.add(8), src, len) }, 0);
+    assert!((0..8).all(|i| byte(user, i) == 0));
+
+    // 第三页尚未访问，memset 在其中缺页
+    let third = unsafe { user.add(2 * PAGE_SIZE) };
+    unsafe { memset(third.add(3), 0x5a, 1000) };
+    for i in 0..PAGE_SIZE {
+        let expected = if i >= 3 && i < 1003 { 0x5a } else { 0 };
+        assert_eq!(byte(third, i), expected, "user memset i={}", i);
+    }
+
+    // 用户映射内反向重叠的 memmove
+    unsafe { memmove(user.add(24), user.add(8), 1000) };
+    for i in 0..1000 {
+        assert_eq!(byte(user, 24 + i), pattern(i), "user memmove i={}", i);
+    }
+
+    unsafe {
+        if old_sstatus & SSTATUS_SUM == 0 {
+            core::arch::asm!("csrc sstatus, {}", in(reg) SSTATUS_SUM);
+        }
+        core::arch::asm!("csrw satp, {}", "sfence.vma zero, zero", in(reg) old_satp);
+    }
+    current.set_shared_address_space(old_mm);
+    for i in 0..NR_PAGES {
+        assert!(aspace.translate(PageVirtAddr::new(start + i * PAGE_SIZE)).is_some());
+    }
+    aspace.mmput();
+
+    // 缺页之后内核地址之间的复制仍然正确
+    let dst = unsafe { core::ptr::addr_of_mut!(DST) as *mut u8 };
+    fill(dst, 100);
+    unsafe { memcpy(dst, src, len) };
+    for i in 0..len {
+        assert_eq!(byte(dst, i), pattern(i), "kernel memcpy after fault i={}", i);
+    }
+    println!("test:    SUCCESS - {} faulting pages filled correctly", NR_PAGES);
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_string() {
+    println!("test: ===== Starting String Function Tests =====");
+    let saved = string_rvv_enabled();
+
+    // 1. 标量实现
+    println!("test: 1. Testing scalar string functions...");
+    set_string_rvv(false);
+    run_all("scalar");
+
+    // 2. 向量实现
+    println!("test: 2. Testing RVV string functions...");
+    if has_vector() {
+        set_string_rvv(true);
+        run_all("RVV");
+    } else {
+        println!("test:    SKIP - CPU has no vector extension");
+    }
+
+    // 3. 写入尚未访问的用户映射（打开向量实现时用户地址走标量路径）
+    println!("test: 3. Testing copies into an untouched user mapping...");
+    set_string_rvv(true);
+    check_user_mapping();
+
+    set_string_rvv(saved);
+    println!("test: ===== String Function Tests Completed =====");
+}
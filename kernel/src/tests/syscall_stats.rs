@@ -0,0 +1,78 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：系统调用表与统计
+//
+// 测试内容：
+// 1. 系统调用表按编号查到处理函数，空位与越界编号返回 ENOSYS
+// 2. 打开统计后记录次数、周期与直方图
+// 3. 关闭统计后不再计数，/proc/syscall_stats 写入开关与清零
+
+use crate::println;
+use crate::arch::riscv64::syscall::{syscall_handler, syscall_name, SyscallFrame, NR_SYSCALLS};
+use crate::arch::riscv64::syscall_stats::*;
+
+const ENOSYS: u64 = -38_i64 as u64;
+const EINVAL: i32 = -22;
+
+const NR_GETPID: usize = 172;
+
+fn invoke(nr: u64) -> u64 {
+    let mut frame = SyscallFrame::default();
+    frame.a7 = nr;
+    syscall_handler(&mut frame);
+    frame.a0
+}
+
+pub fn test_syscall_stats() {
+    println!("test: ===== Testing Syscall Table and Stats =====");
+
+    // 测试 1: 查表分发
+    println!("test: 1. Testing table dispatch...");
+    assert_eq!(syscall_name(NR_GETPID), Some("sys_getpid"));
+    assert_eq!(syscall_name(499), None);
+    assert_eq!(syscall_name(NR_SYSCALLS + 1), None);
+    assert_eq!(invoke(499), ENOSYS);
+    assert_eq!(invoke(NR_SYSCALLS as u64), ENOSYS);
+    assert_eq!(invoke(u64::MAX), ENOSYS);
+    let pid = invoke(NR_GETPID as u64);
+    assert_ne!(pid, ENOSYS);
+    println!("test:    SUCCESS - known numbers dispatch, holes return ENOSYS");
+
+    // 测试 2: 统计计数
+    println!("test: 2. Testing per-syscall counters...");
+    let was_enabled = enabled();
+    assert_eq!(write_control(b"reset\n"), Ok(6));
+    assert_eq!(write_control(b"1"), Ok(1));
+    assert!(enabled());
+    for _ in 0..5 {
+        assert_eq!(invoke(NR_GETPID as u64), pid);
+    }
+    invoke(499);
+    let stat = syscall_stat(NR_GETPID);
+    assert_eq!(stat.calls, 5);
+    assert_eq!(stat.hist.iter().sum::<u64>(), 5);
+    assert!(stat.cycles > 0);
+    assert_eq!(per_cpu_calls(NR_GETPID).iter().sum::<u64>(), 5);
+    assert_eq!(syscall_stat(499).calls, 0);
+    let text = generate_stats();
+    assert!(text.starts_with("enabled 1"));
+    assert!(text.contains("sys_getpid"));
+    println!("test:    SUCCESS - calls, cycles and histogram recorded");
+
+    // 测试 3: 开关与清零
+    println!("test: 3. Testing enable/disable and reset...");
+    assert_eq!(write_control(b"0"), Ok(1));
+    invoke(NR_GETPID as u64);
+    assert_eq!(syscall_stat(NR_GETPID).calls, 5);
+    assert_eq!(write_control(b"reset"), Ok(5));
+    assert_eq!(syscall_stat(NR_GETPID), SyscallStat::default());
+    assert!(!generate_stats().contains("sys_getpid"));
+    assert_eq!(write_control(b"on"), Err(EINVAL));
+    set_enabled(was_enabled);
+    println!("test:    SUCCESS - disabled stats stay unchanged, reset clears all CPUs");
+
+    println!("test: Syscall table and stats testing completed.");
+}
@@ -0,0 +1,74 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：任务缓存与内核栈缓存
+//
+// 测试内容：
+// 1. 任务引用计数：两个引用都释放后才回收
+// 2. 回收的内核栈被下一次分配复用
+// 3. 大量创建/回收任务后 PID 与任务缓存不泄漏
+
+use alloc::vec::Vec;
+use crate::println;
+use crate::sched::{alloc_task_slot, put_task_struct};
+use crate::sched::pid::nr_pids;
+
+pub fn test_task_cache() {
+    println!("test: ===== Testing Task and Kernel Stack Cache =====");
+
+    // 测试 1: 引用计数
+    println!("test: 1. Testing task usage count...");
+    let used = nr_pids();
+    let task = alloc_task_slot().unwrap();
+    assert!(unsafe { (*task).get_kernel_stack() }.is_some());
+    assert_eq!(nr_pids(), used + 1);
+    unsafe {
+        // 任务表的引用：PID 在注销时释放，这里手动释放
+        crate::sched::pid::free_pid((*task).pid());
+        assert!((*task).put_usage());
+        // 只剩运行状态的引用时 Task 仍然有效
+        assert!((*task).get_kernel_stack().is_some());
+    }
+    println!("test:    SUCCESS - task survives until the last reference");
+
+    // 测试 2: 内核栈复用
+    println!("test: 2. Testing kernel stack reuse...");
+    let stack = unsafe { (*task).get_kernel_stack() };
+    unsafe { put_task_struct(task) };
+    let a = alloc_task_slot().unwrap();
+    let b = alloc_task_slot().unwrap();
+    let stacks = unsafe { [(*a).get_kernel_stack(), (*b).get_kernel_stack()] };
+    assert!(stacks.contains(&stack));
+    for t in [a, b] {
+        unsafe {
+            crate::sched::pid::free_pid((*t).pid());
+            put_task_struct(t);
+            put_task_struct(t);
+        }
+    }
+    assert_eq!(nr_pids(), used);
+    println!("test:    SUCCESS - freed stack reused by the next fork");
+
+    // 测试 3: 大量创建与回收
+    println!("test: 3. Testing fork/exit churn...");
+    for _ in 0..64 {
+        let mut tasks = Vec::new();
+        for _ in 0..32 {
+            let t = alloc_task_slot().unwrap();
+            tasks.push(t);
+        }
+        for t in tasks {
+            unsafe {
+                crate::sched::pid::free_pid((*t).pid());
+                put_task_struct(t);
+                put_task_struct(t);
+            }
+        }
+    }
+    assert_eq!(nr_pids(), used);
+    println!("test:    SUCCESS - 2048 tasks created and recycled");
+
+    println!("test: Task and kernel stack cache testing completed.");
+}
@@ -0,0 +1,153 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：TCP 拥塞控制
+//
+// 测试内容：
+// 1. 按名称查找算法与默认算法
+// 2. setsockopt(TCP_CONGESTION) 切换与读取
+// 3. NewReno 慢启动与拥塞避免
+// 4. CUBIC 的乘性减小与快速收敛
+// 5. BBR 初始化：pacing 速率与慢启动门限
+// 6. 交付速率采样
+
+use crate::println;
+use crate::net::tcp::{
+    tcp_getsockopt, tcp_setsockopt, tcp_socket_alloc, tcp_socket_free, TcpSocket, SOL_TCP,
+    TCP_CONGESTION, TCP_MAX_CWND,
+};
+use crate::net::tcp_bbr::BbrMode;
+use crate::net::tcp_cong::{tcp_available_congestion_control, tcp_ca_default, tcp_ca_find, TcpCaPriv};
+
+/// 测试用的 MSS
+const TEST_MSS: u32 = 1000;
+
+pub fn test_tcp_cong() {
+    println!("test: ===== Testing TCP Congestion Control =====");
+
+    // 测试 1: 查找与默认算法
+    println!("test: 1. Testing congestion control lookup...");
+    assert_eq!(tcp_ca_find("reno").map(|ops| ops.name), Some("reno"));
+    assert_eq!(tcp_ca_find("bbr").map(|ops| ops.name), Some("bbr"));
+    assert!(tcp_ca_find("vegas").is_none());
+    assert_eq!(tcp_available_congestion_control(), "reno cubic bbr");
+    let sock = TcpSocket::new();
+    assert!(core::ptr::eq(sock.ca_ops, tcp_ca_default()));
+    println!("test:    SUCCESS - default is {}", tcp_ca_default().name);
+
+    // 测试 2: setsockopt / getsockopt
+    println!("test: 2. Testing TCP_CONGESTION socket option...");
+    let fd = tcp_socket_alloc().expect("socket alloc");
+    assert_eq!(tcp_setsockopt(fd, SOL_TCP, TCP_CONGESTION, b"reno\0"), 0);
+    let mut name = [0xffu8; 16];
+    assert_eq!(tcp_getsockopt(fd, SOL_TCP, TCP_CONGESTION, &mut name), 16);
+    assert_eq!(&name[..5], b"reno\0");
+    assert_eq!(tcp_setsockopt(fd, SOL_TCP, TCP_CONGESTION, b"vegas"), -2);
+    assert_eq!(tcp_setsockopt(fd, 0, TCP_CONGESTION, b"bbr"), -92);
+    assert_eq!(tcp_getsockopt(fd, SOL_TCP, TCP_CONGESTION, &mut name), 16);
+    assert_eq!(&name[..5], b"reno\0");
+    tcp_socket_free(fd);
+    println!("test:    SUCCESS - option set, read back and rejected unknown names");
+
+    // 测试 3: NewReno
+    println!("test: 3. Testing NewReno slow start and additive increase...");
+    let mut sock = cong_socket("reno");
+    let ops = sock.ca_ops;
+    let cong_avoid = ops.cong_avoid.expect("reno cong_avoid");
+    sock.snd_cwnd = 10;
+    sock.snd_ssthresh = 12;
+    sock.rate.prior_in_flight = 10 * TEST_MSS;
+    // 慢启动到门限为止，剩余的 2 个报文段计入拥塞避免
+    cong_avoid(&mut sock, 4);
+    assert_eq!(sock.snd_cwnd, 12);
+    sock.rate.prior_in_flight = 12 * TEST_MSS;
+    for _ in 0..9 {
+        cong_avoid(&mut sock, 1);
+    }
+    assert_eq!(sock.snd_cwnd, 12);
+    cong_avoid(&mut sock, 1);
+    assert_eq!(sock.snd_cwnd, 13);
+    // 不受拥塞窗口限制时不增长
+    sock.rate.prior_in_flight = 0;
+    cong_avoid(&mut sock, 8);
+    assert_eq!(sock.snd_cwnd, 13);
+    assert_eq!((ops.ssthresh)(&mut sock), 6);
+    println!("test:    SUCCESS - cwnd 13 after slow start and one RTT of AI");
+
+    // 测试 4: CUBIC
+    println!("test: 4. Testing CUBIC multiplicative decrease...");
+    let mut sock = cong_socket("cubic");
+    let ops = sock.ca_ops;
+    assert!(matches!(sock.ca_priv, TcpCaPriv::Cubic(_)));
+    sock.snd_cwnd = 100;
+    // β = 717/1024
+    assert_eq!((ops.ssthresh)(&mut sock), 70);
+    // W_max 未恢复又丢包（快速收敛），β 不变
+    sock.snd_cwnd = 70;
+    assert_eq!((ops.ssthresh)(&mut sock), 49);
+    sock.snd_cwnd = 2;
+    assert_eq!((ops.ssthresh)(&mut sock), 2);
+    // 拥塞避免中窗口增长，但刚丢包时不会跳过 W_max
+    sock.snd_cwnd = 70;
+    sock.snd_ssthresh = 70;
+    sock.rate.prior_in_flight = 70 * TEST_MSS;
+    let cong_avoid = ops.cong_avoid.expect("cubic cong_avoid");
+    for _ in 0..70 {
+        cong_avoid(&mut sock, 1);
+    }
+    assert!(sock.snd_cwnd >= 70 && sock.snd_cwnd <= 100);
+    println!("test:    SUCCESS - ssthresh 70/49, cwnd {} after one window", sock.snd_cwnd);
+
+    // 测试 5: BBR
+    println!("test: 5. Testing BBR initialization...");
+    let mut sock = cong_socket("bbr");
+    let ops = sock.ca_ops;
+    assert_eq!(sock.snd_ssthresh, TCP_MAX_CWND);
+    assert!(sock.pacing_rate > 0);
+    match sock.ca_priv {
+        TcpCaPriv::Bbr(bbr) => {
+            assert_eq!(bbr.mode, BbrMode::Startup);
+            assert!(!bbr.full_bw_reached);
+        }
+        _ => panic!("bbr private state missing"),
+    }
+    // 丢包不改变门限
+    assert_eq!((ops.ssthresh)(&mut sock), TCP_MAX_CWND);
+    assert!(sock.tcp_tso_segs() >= 2);
+    // 换回其他算法时 pacing 关闭
+    assert!(sock.tcp_set_congestion_control("cubic").is_ok());
+    assert_eq!(sock.pacing_rate, 0);
+    println!("test:    SUCCESS - pacing enabled, ssthresh unlimited");
+
+    // 测试 6: 交付速率采样
+    println!("test: 6. Testing delivery rate sampling...");
+    let mut sock = cong_socket("reno");
+    sock.snd_una = 1000;
+    sock.tcp_rate_skb_sent(2000, 1_000_000, 0);
+    sock.tcp_rate_skb_sent(3000, 1_000_100, 1000);
+    sock.snd_una = 3000;
+    let rs = sock.tcp_rate_gen(2000, 1_010_000);
+    assert_eq!(rs.delivered, 2000);
+    assert_eq!(rs.rtt_us, 9_900);
+    assert_eq!(rs.interval_us, 10_000);
+    assert_eq!(rs.rate(), 200_000);
+    assert_eq!(sock.rate.min_rtt_us, 9_900);
+    // 没有新交付的确认不产生样本
+    let rs = sock.tcp_rate_gen(0, 1_020_000);
+    assert_eq!(rs.interval_us, 0);
+    assert_eq!(rs.rtt_us, -1);
+    println!("test:    SUCCESS - 2000 bytes in 10ms sampled as 200000 B/s");
+
+    println!("test: TCP congestion control testing completed.");
+}
+
+/// 创建使用指定算法、已初始化拥塞控制的连接
+fn cong_socket(name: &str) -> TcpSocket {
+    let mut sock = TcpSocket::new();
+    sock.mss = TEST_MSS;
+    assert!(sock.tcp_set_congestion_control(name).is_ok());
+    sock.tcp_init_congestion_control();
+    sock
+}
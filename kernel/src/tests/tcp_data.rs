@@ -0,0 +1,240 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：TCP 数据传输
+//
+// 测试内容：
+// 1. 环形缓冲区回绕与按偏移写入
+// 2. TCP 选项解析（MSS、窗口扩大、SACK）
+// 3. 按序数据接收与读取
+// 4. 乱序数据缓存，空洞补齐后整段交付
+// 5. 发送数据、ACK 确认与 RTT 取样
+// 6. 重复 ACK 触发快速重传，完整确认后退出恢复
+// 7. 重传超时后进入 Loss 状态并退避
+// 8. Nagle、TCP_NODELAY、TCP_CORK 与 MSG_MORE 合并小写入
+
+use crate::println;
+use crate::net::tcp::{
+    TcpCaState, TcpHdr, TcpRingBuf, TcpSeq, TcpSocket, TcpState, TCPHDR_ACK, TCPHDR_PSH,
+    TCPOLEN_SACK_BASE, TCPOLEN_SACK_PERBLOCK, TCPOPT_NOP, TCPOPT_SACK,
+};
+use crate::net::tcp_input::tcp_parse_options;
+use alloc::vec;
+use alloc::vec::Vec;
+
+/// 测试连接的本端初始序列号
+const LOCAL_ISS: TcpSeq = 1000;
+/// 测试连接的对端初始序列号
+const REMOTE_ISS: TcpSeq = 5000;
+
+pub fn test_tcp_data() {
+    println!("test: ===== Testing TCP Data Transfer =====");
+
+    // 测试 1: 环形缓冲区
+    println!("test: 1. Testing TCP ring buffer wraparound...");
+    let mut ring = TcpRingBuf::with_capacity(8);
+    assert_eq!(ring.push(b"abcdef"), 6);
+    let mut out = [0u8; 8];
+    assert_eq!(ring.pop(&mut out[..4]), 4);
+    assert_eq!(&out[..4], b"abcd");
+    // 写入跨越缓冲区末尾
+    assert_eq!(ring.push(b"ghijkl"), 6);
+    assert_eq!(ring.free_space(), 0);
+    assert_eq!(ring.push(b"x"), 0);
+    assert_eq!(ring.pop(&mut out), 8);
+    assert_eq!(&out, b"efghijkl");
+    // 先写后面的数据，再补前面的空洞
+    assert_eq!(ring.write_at(3, b"de"), 2);
+    assert_eq!(ring.write_at(0, b"abc"), 3);
+    ring.commit(5);
+    assert_eq!(ring.pop(&mut out), 5);
+    assert_eq!(&out[..5], b"abcde");
+    println!("test:    SUCCESS - ring buffer wraps and fills holes");
+
+    // 测试 2: 选项解析
+    println!("test: 2. Testing TCP option parsing...");
+    let syn_opts = [2, 4, 0x05, 0xb4, 1, 3, 3, 7, 1, 1, 4, 2];
+    let opts = tcp_parse_options(&syn_opts);
+    assert_eq!(opts.mss, Some(1460));
+    assert_eq!(opts.wscale, Some(7));
+    assert!(opts.sack_perm);
+    let opts = tcp_parse_options(&sack_option(&[(100, 200), (300, 400)]));
+    assert_eq!(opts.num_sacks, 2);
+    assert_eq!(opts.sacks[1], (300, 400));
+    // 长度越界的选项被忽略
+    let opts = tcp_parse_options(&[2, 4, 0x05]);
+    assert_eq!(opts.mss, None);
+    println!("test:    SUCCESS - MSS, window scale and SACK options parsed");
+
+    // 测试 3: 按序接收
+    println!("test: 3. Testing in-order receive...");
+    let mut sock = established_socket();
+    let payload: Vec<u8> = (0..3000u32).map(|i| (i * 13) as u8).collect();
+    deliver(&mut sock, REMOTE_ISS, LOCAL_ISS, TCPHDR_ACK | TCPHDR_PSH, &[], &payload[..100]);
+    assert_eq!(sock.rcv_nxt, REMOTE_ISS + 100);
+    let mut buf = vec![0u8; 4096];
+    assert_eq!(sock.recv(&mut buf, 4096), Ok(100));
+    assert_eq!(&buf[..100], &payload[..100]);
+    assert_eq!(sock.recv(&mut buf, 4096), Err(-11));
+    println!("test:    SUCCESS - in-order data delivered");
+
+    // 测试 4: 乱序接收
+    println!("test: 4. Testing out-of-order receive...");
+    deliver(&mut sock, REMOTE_ISS + 1100, LOCAL_ISS, TCPHDR_ACK, &[], &payload[1100..1600]);
+    assert_eq!(sock.rcv_nxt, REMOTE_ISS + 100);
+    assert_eq!(sock.ofo.len(), 1);
+    assert_eq!(sock.recv(&mut buf, 4096), Err(-11));
+    deliver(&mut sock, REMOTE_ISS + 100, LOCAL_ISS, TCPHDR_ACK, &[], &payload[100..1100]);
+    assert_eq!(sock.rcv_nxt, REMOTE_ISS + 1600);
+    assert!(sock.ofo.is_empty());
+    assert_eq!(sock.recv(&mut buf, 4096), Ok(1500));
+    assert_eq!(&buf[..1500], &payload[100..1600]);
+    println!("test:    SUCCESS - hole filled, {} bytes delivered in order", 1500);
+
+    // 测试 5: 发送与确认
+    println!("test: 5. Testing send and ACK processing...");
+    let mut sock = established_socket();
+    assert_eq!(sock.send(&payload), Ok(3000));
+    assert_eq!(sock.snd_nxt, LOCAL_ISS + 3000);
+    assert!(sock.retransmit_deadline != 0);
+    deliver(&mut sock, REMOTE_ISS, LOCAL_ISS + 3000, TCPHDR_ACK, &[], &[]);
+    assert_eq!(sock.snd_una, LOCAL_ISS + 3000);
+    assert!(sock.send_buf.is_empty());
+    assert_eq!(sock.retransmit_deadline, 0);
+    assert!(sock.srtt != 0);
+    // 只发出 3 个报文段，未受拥塞窗口限制，窗口不增长
+    assert_eq!(sock.snd_cwnd, 10);
+    println!("test:    SUCCESS - ACK consumed send buffer, srtt {} rto {}", sock.srtt >> 3, sock.rto);
+
+    // 测试 6: 快速重传
+    println!("test: 6. Testing fast retransmit with SACK...");
+    let mut sock = established_socket();
+    let mss = sock.mss;
+    let data = vec![0x5au8; (mss * 8) as usize];
+    assert_eq!(sock.send(&data), Ok(data.len()));
+    // 第一个报文段丢失，后续报文段陆续被 SACK
+    for i in 1..4u32 {
+        let sack = sack_option(&[(LOCAL_ISS + mss, LOCAL_ISS + mss * (i + 1))]);
+        deliver(&mut sock, REMOTE_ISS, LOCAL_ISS, TCPHDR_ACK, &sack, &[]);
+    }
+    assert_eq!(sock.ca_state, TcpCaState::Recovery);
+    assert_eq!(sock.stats.fast_retrans, 1);
+    assert!(sock.snd_ssthresh < 10);
+    deliver(&mut sock, REMOTE_ISS, LOCAL_ISS + mss * 8, TCPHDR_ACK, &[], &[]);
+    assert_eq!(sock.ca_state, TcpCaState::Open);
+    assert!(sock.sacked.is_empty());
+    println!("test:    SUCCESS - recovery entered after 3 dupacks and exited on full ACK");
+
+    // 测试 7: 重传超时
+    println!("test: 7. Testing retransmission timeout...");
+    let mut sock = established_socket();
+    assert_eq!(sock.send(&payload[..1000]), Ok(1000));
+    let rto = sock.tcp_current_rto();
+    let deadline = sock.retransmit_deadline;
+    sock.tcp_timers(deadline);
+    assert_eq!(sock.ca_state, TcpCaState::Loss);
+    assert_eq!(sock.snd_cwnd, 1);
+    assert_eq!(sock.backoff, 1);
+    assert_eq!(sock.stats.timeouts, 1);
+    assert_eq!(sock.tcp_current_rto(), rto * 2);
+    deliver(&mut sock, REMOTE_ISS, LOCAL_ISS + 1000, TCPHDR_ACK, &[], &[]);
+    assert_eq!(sock.ca_state, TcpCaState::Open);
+    assert_eq!(sock.backoff, 0);
+    println!("test:    SUCCESS - timeout backed off and recovered after ACK");
+
+    // 测试 8: 小写入合并
+    println!("test: 8. Testing Nagle, TCP_NODELAY, TCP_CORK and MSG_MORE...");
+    let mut sock = established_socket();
+    let mss = sock.mss as usize;
+    // 第一个小写入立即发出；它未被确认时，后续小写入留在发送缓冲区中
+    assert_eq!(sock.send(&payload[..100]), Ok(100));
+    assert_eq!(sock.snd_nxt, LOCAL_ISS + 100);
+    assert_eq!(sock.send(&payload[..200]), Ok(200));
+    assert_eq!(sock.send(&payload[..300]), Ok(300));
+    assert_eq!(sock.snd_nxt, LOCAL_ISS + 100);
+    // ACK 到达后合并成一个报文段发出
+    deliver(&mut sock, REMOTE_ISS, LOCAL_ISS + 100, TCPHDR_ACK, &[], &[]);
+    assert_eq!(sock.snd_nxt, LOCAL_ISS + 600);
+    // 打开 TCP_NODELAY 时立即发出推迟的零头，之后的小写入不再等待
+    assert_eq!(sock.send(&payload[..50]), Ok(50));
+    assert_eq!(sock.snd_nxt, LOCAL_ISS + 600);
+    sock.tcp_set_nodelay(true);
+    assert_eq!(sock.snd_nxt, LOCAL_ISS + 650);
+    assert_eq!(sock.send(&payload[..50]), Ok(50));
+    assert_eq!(sock.snd_nxt, LOCAL_ISS + 700);
+    deliver(&mut sock, REMOTE_ISS, LOCAL_ISS + 700, TCPHDR_ACK, &[], &[]);
+    // TCP_CORK 只发出满 MSS 的部分，没有在途数据时设置 cork 定时器，取消后发出零头
+    sock.tcp_set_cork(true);
+    let big = vec![0x11u8; mss + 10];
+    assert_eq!(sock.send(&big), Ok(mss + 10));
+    let sent = LOCAL_ISS + 700 + mss as u32;
+    assert_eq!(sock.snd_nxt, sent);
+    deliver(&mut sock, REMOTE_ISS, sent, TCPHDR_ACK, &[], &[]);
+    assert_eq!(sock.snd_nxt, sent);
+    assert!(sock.cork_deadline != 0);
+    sock.tcp_set_cork(false);
+    assert_eq!(sock.snd_nxt, sent + 10);
+    assert_eq!(sock.cork_deadline, 0);
+    deliver(&mut sock, REMOTE_ISS, sent + 10, TCPHDR_ACK, &[], &[]);
+    // MSG_MORE 的零头等下一次写入，最迟在 cork 定时器到期时发出
+    assert_eq!(sock.sendmsg(&payload[..20], true), Ok(20));
+    assert_eq!(sock.snd_nxt, sent + 10);
+    let deadline = sock.cork_deadline;
+    assert!(deadline != 0);
+    sock.tcp_timers(deadline);
+    assert_eq!(sock.snd_nxt, sent + 30);
+    assert_eq!(sock.cork_deadline, 0);
+    println!("test:    SUCCESS - small writes coalesced and pushed on ACK, uncork and timeout");
+
+    println!("test: TCP data transfer testing completed.");
+}
+
+/// 构造一个已建立的连接，发出的报文段经真实的 IPv4 路径发送到 10.0.2.2
+fn established_socket() -> TcpSocket {
+    let mut sock = TcpSocket::new();
+    sock.local_port = 5000;
+    sock.remote_port = 6000;
+    sock.remote_ip = 0x0A000202;
+    sock.state = TcpState::TCP_ESTABLISHED;
+    sock.snd_una = LOCAL_ISS;
+    sock.snd_nxt = LOCAL_ISS;
+    sock.snd_wl1 = REMOTE_ISS;
+    sock.snd_wl2 = LOCAL_ISS;
+    sock.snd_wnd = 65535;
+    sock.rcv_nxt = REMOTE_ISS;
+    sock.sack_ok = true;
+    sock.rcv_wscale = 0;
+    sock.send_buf = TcpRingBuf::with_capacity(64 * 1024);
+    sock.recv_buf = TcpRingBuf::with_capacity(64 * 1024);
+    sock
+}
+
+/// 构造 SACK 选项（前置两个 NOP 对齐到 4 字节）
+fn sack_option(blocks: &[(TcpSeq, TcpSeq)]) -> Vec<u8> {
+    let mut opt = vec![TCPOPT_NOP, TCPOPT_NOP, TCPOPT_SACK];
+    opt.push(TCPOLEN_SACK_BASE + TCPOLEN_SACK_PERBLOCK * blocks.len() as u8);
+    for &(start, end) in blocks {
+        opt.extend_from_slice(&start.to_be_bytes());
+        opt.extend_from_slice(&end.to_be_bytes());
+    }
+    opt
+}
+
+/// 构造对端发来的报文段并交给连接处理
+fn deliver(sock: &mut TcpSocket, seq: TcpSeq, ack: TcpSeq, flags: u8, opts: &[u8], data: &[u8]) {
+    let hdr_len = 20 + ((opts.len() + 3) & !3);
+    let mut seg = vec![0u8; hdr_len + data.len()];
+    seg[0..2].copy_from_slice(&sock.remote_port.to_be_bytes());
+    seg[2..4].copy_from_slice(&sock.local_port.to_be_bytes());
+    seg[4..8].copy_from_slice(&seq.to_be_bytes());
+    seg[8..12].copy_from_slice(&ack.to_be_bytes());
+    seg[12] = ((hdr_len / 4) as u8) << 4;
+    seg[13] = flags;
+    seg[14..16].copy_from_slice(&65535u16.to_be_bytes());
+    seg[20..20 + opts.len()].copy_from_slice(opts);
+    seg[hdr_len..].copy_from_slice(data);
+    let hdr = TcpHdr::from_bytes(&seg).unwrap();
+    let _ = sock.handle_packet(hdr, &seg[hdr_len..]);
+}
@@ -0,0 +1,202 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：TCP 监听队列与 SYN cookie
+//
+// 测试内容：
+// 1. SYN cookie 的生成与校验
+// 2. 半连接队列满后改用 SYN cookie
+// 3. 完成握手的连接进入全连接队列，由 accept 取出
+// 4. cookie 握手直接建立连接
+// 5. 全连接队列满时丢弃新的 SYN
+// 6. SO_REUSEPORT 监听组按四元组分配连接
+// 7. socket 文件：由文件找到 socket，写入走 tcp_sendmsg，关闭最后一个引用释放 socket
+
+use crate::println;
+use crate::fs::file::fput;
+use crate::net::buffer::{alloc_skb, CHECKSUM_UNNECESSARY};
+use crate::net::syncookies::{cookie_v4_check, cookie_v4_init_sequence};
+use crate::net::tcp::{
+    is_tcp_socket, tcp_accept, tcp_bind, tcp_ehash_len, tcp_getsockopt, tcp_listen, tcp_setsockopt,
+    tcp_sock_file, tcp_sock_id, tcp_socket_alloc, tcp_socket_free, tcp_socket_get, tcp_v4_rcv, TcpSeq, TcpState, SOL_SOCKET,
+    SO_REUSEPORT, TCPHDR_ACK, TCPHDR_SYN,
+};
+
+/// 测试用的本机地址
+const LOCAL_IP: u32 = 0x0A00020F;
+/// 测试用的对端地址
+const PEER_IP: u32 = 0x0A000202;
+/// 普通握手中服务器 SYN-ACK 的序列号加一
+const SERVER_ACK: TcpSeq = 54322;
+
+pub fn test_tcp_listen() {
+    println!("test: ===== Testing TCP Listen Queues and SYN Cookies =====");
+
+    // 测试 1: cookie 编码
+    println!("test: 1. Testing SYN cookie encode and check...");
+    let (cookie, mss) = cookie_v4_init_sequence(PEER_IP, LOCAL_IP, 40000, 80, 1000, 1460);
+    assert_eq!(mss, 1460);
+    assert_eq!(cookie_v4_check(PEER_IP, LOCAL_IP, 40000, 80, 1000, cookie), Some(1460));
+    let (cookie2, mss) = cookie_v4_init_sequence(PEER_IP, LOCAL_IP, 40000, 80, 1000, 1400);
+    assert_eq!(mss, 1300);
+    assert_eq!(cookie_v4_check(PEER_IP, LOCAL_IP, 40000, 80, 1000, cookie2), Some(1300));
+    // 四元组或 cookie 不符都无法通过
+    assert_eq!(cookie_v4_check(PEER_IP, LOCAL_IP, 40001, 80, 1000, cookie), None);
+    assert_eq!(cookie_v4_check(0x0A000203, LOCAL_IP, 40000, 80, 1000, cookie), None);
+    assert_eq!(cookie_v4_check(PEER_IP, LOCAL_IP, 40000, 80, 1000, cookie ^ 0x0100_0000), None);
+    println!("test:    SUCCESS - cookie carries MSS and rejects other tuples");
+
+    // 测试 2: 半连接队列
+    println!("test: 2. Testing SYN queue overflow...");
+    let listener = tcp_socket_alloc().expect("tcp alloc");
+    assert_eq!(tcp_bind(listener, 7171), 0);
+    assert_eq!(tcp_listen(listener, 2), 0);
+    let base = tcp_ehash_len();
+    rcv_segment(41000, 7171, 100, 0, TCPHDR_SYN);
+    rcv_segment(41001, 7171, 200, 0, TCPHDR_SYN);
+    assert_eq!(queue_lens(listener), (2, 0));
+    // 第三个 SYN 只得到 cookie，不创建子连接
+    rcv_segment(41002, 7171, 300, 0, TCPHDR_SYN);
+    assert_eq!(queue_lens(listener), (2, 0));
+    assert_eq!(tcp_ehash_len(), base + 2);
+    assert_eq!(tcp_accept(listener), -11);
+    println!("test:    SUCCESS - SYN queue bounded by backlog");
+
+    // 测试 3: accept
+    println!("test: 3. Testing accept queue...");
+    rcv_segment(41000, 7171, 101, SERVER_ACK, TCPHDR_ACK);
+    assert_eq!(queue_lens(listener), (1, 1));
+    let fd = tcp_accept(listener);
+    assert!(fd >= 0);
+    let child = tcp_socket_get(fd).expect("accepted socket");
+    assert_eq!(child.state, TcpState::TCP_ESTABLISHED);
+    assert_eq!(child.remote_port, 41000);
+    assert_eq!(queue_lens(listener), (1, 0));
+    assert_eq!(tcp_accept(listener), -11);
+    // accept 之后的报文段交给新的文件描述符
+    assert_eq!(tcp_ehash_len(), base + 2);
+    rcv_segment(41000, 7171, 101, SERVER_ACK, TCPHDR_ACK | crate::net::tcp::TCPHDR_FIN);
+    assert_eq!(tcp_socket_get(fd).map(|s| s.state), Some(TcpState::TCP_CLOSE_WAIT));
+    assert_eq!(tcp_accept(fd), -22);
+    tcp_socket_free(fd);
+    println!("test:    SUCCESS - accepted fd {} in ESTABLISHED", fd);
+
+    // 测试 4: cookie 握手
+    println!("test: 4. Testing SYN cookie handshake...");
+    // 第三个 SYN 没有 MSS 选项，cookie 中编码的是 536
+    let (cookie, _) = cookie_v4_init_sequence(PEER_IP, LOCAL_IP, 41002, 7171, 300, 536);
+    rcv_segment(41002, 7171, 301, cookie.wrapping_add(5), TCPHDR_ACK);
+    assert_eq!(queue_lens(listener), (1, 0));
+    rcv_segment(41002, 7171, 301, cookie.wrapping_add(1), TCPHDR_ACK);
+    assert_eq!(queue_lens(listener), (1, 1));
+    let stats = tcp_socket_get(listener).expect("listener").stats;
+    assert_eq!((stats.syncookies_recv, stats.syncookies_failed), (1, 1));
+    let fd = tcp_accept(listener);
+    assert!(fd >= 0);
+    let child = tcp_socket_get(fd).expect("accepted socket");
+    assert_eq!(child.state, TcpState::TCP_ESTABLISHED);
+    assert_eq!(child.mss, 536);
+    assert!(!child.wscale_ok && !child.sack_ok);
+    tcp_socket_free(fd);
+    println!("test:    SUCCESS - cookie ACK created connection with MSS 536");
+
+    // 测试 5: 全连接队列
+    println!("test: 5. Testing accept queue overflow...");
+    tcp_socket_free(listener);
+    assert_eq!(tcp_ehash_len(), base);
+    let listener = tcp_socket_alloc().expect("tcp alloc");
+    assert_eq!(tcp_bind(listener, 7172), 0);
+    assert_eq!(tcp_listen(listener, 1), 0);
+    for port in 42000..42002u16 {
+        rcv_segment(port, 7172, 100, 0, TCPHDR_SYN);
+        rcv_segment(port, 7172, 101, SERVER_ACK, TCPHDR_ACK);
+    }
+    assert_eq!(queue_lens(listener), (0, 2));
+    rcv_segment(42002, 7172, 100, 0, TCPHDR_SYN);
+    assert_eq!(queue_lens(listener), (0, 2));
+    assert_eq!(tcp_socket_get(listener).map(|s| s.stats.listen_overflows), Some(1));
+    // 关闭监听 socket 终止未被 accept 的连接
+    tcp_socket_free(listener);
+    assert_eq!(tcp_ehash_len(), base);
+    println!("test:    SUCCESS - SYN dropped while accept queue full");
+
+    // 测试 6: SO_REUSEPORT
+    println!("test: 6. Testing SO_REUSEPORT listener group...");
+    let one = 1i32.to_ne_bytes();
+    let a = tcp_socket_alloc().expect("tcp alloc");
+    let b = tcp_socket_alloc().expect("tcp alloc");
+    let c = tcp_socket_alloc().expect("tcp alloc");
+    for fd in [a, b, c] {
+        assert_eq!(tcp_bind(fd, 7173), 0);
+    }
+    assert_eq!(tcp_setsockopt(a, SOL_SOCKET, SO_REUSEPORT, &one), 0);
+    assert_eq!(tcp_setsockopt(b, SOL_SOCKET, SO_REUSEPORT, &one), 0);
+    let mut val = [0u8; 4];
+    assert_eq!(tcp_getsockopt(b, SOL_SOCKET, SO_REUSEPORT, &mut val), 4);
+    assert_eq!(i32::from_ne_bytes(val), 1);
+    assert_eq!(tcp_listen(a, 64), 0);
+    assert_eq!(tcp_listen(b, 64), 0);
+    // 没有设置 SO_REUSEPORT 的 socket 不能加入
+    assert_eq!(tcp_listen(c, 64), -98);
+    for port in 43000..43032u16 {
+        rcv_segment(port, 7173, 100, 0, TCPHDR_SYN);
+    }
+    let (qa, _) = queue_lens(a);
+    let (qb, _) = queue_lens(b);
+    assert_eq!(qa + qb, 32);
+    assert!(qa > 0 && qb > 0);
+    // 同一条连接的 ACK 回到收到 SYN 的监听 socket
+    for port in 43000..43032u16 {
+        rcv_segment(port, 7173, 101, SERVER_ACK, TCPHDR_ACK);
+    }
+    assert_eq!(queue_lens(a), (0, qa));
+    assert_eq!(queue_lens(b), (0, qb));
+    for fd in [a, b, c] {
+        tcp_socket_free(fd);
+    }
+    assert_eq!(tcp_ehash_len(), base);
+    println!("test:    SUCCESS - 32 connections split {}/{}", qa, qb);
+
+    // 测试 7: socket 文件
+    println!("test: 7. Testing TCP socket file...");
+    let sk = tcp_socket_alloc().expect("tcp alloc");
+    assert_eq!(tcp_bind(sk, 7174), 0);
+    assert_eq!(tcp_listen(sk, 8), 0);
+    let file = tcp_sock_file(sk, false);
+    assert!(is_tcp_socket(&file));
+    assert_eq!(tcp_sock_id(&file), Some(sk));
+    // 未建立连接的 socket 不能发送
+    let data = [0u8; 16];
+    assert_eq!(unsafe { file.write(data.as_ptr(), data.len()) }, -32);
+    fput(file);
+    assert!(tcp_socket_get(sk).is_none());
+    assert_eq!(tcp_ehash_len(), base);
+    println!("test:    SUCCESS - closing the file releases the listener");
+
+    println!("test: TCP listen queue testing completed.");
+}
+
+/// 监听 socket 的 (半连接队列长度, 全连接队列长度)
+fn queue_lens(fd: i32) -> (usize, usize) {
+    let socket = tcp_socket_get(fd).expect("listener");
+    (socket.reqsk_queue.syn_queue_len(), socket.reqsk_queue.accept_queue_len())
+}
+
+/// 构造对端发来的 TCP 报文段，经 tcp_v4_rcv 分发
+fn rcv_segment(sport: u16, dport: u16, seq: TcpSeq, ack: TcpSeq, flags: u8) {
+    let mut seg = [0u8; 20];
+    seg[0..2].copy_from_slice(&sport.to_be_bytes());
+    seg[2..4].copy_from_slice(&dport.to_be_bytes());
+    seg[4..8].copy_from_slice(&seq.to_be_bytes());
+    seg[8..12].copy_from_slice(&ack.to_be_bytes());
+    seg[12] = 5 << 4;
+    seg[13] = flags;
+    seg[14..16].copy_from_slice(&65535u16.to_be_bytes());
+    let mut skb = alloc_skb(64).expect("skb alloc");
+    skb.skb_put_data(&seg).expect("skb put");
+    skb.ip_summed = CHECKSUM_UNNECESSARY;
+    assert!(tcp_v4_rcv(&skb, PEER_IP, LOCAL_IP, 0, seg.len() as u32).is_ok());
+    skb.free();
+}
@@ -0,0 +1,124 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 透明大页单元测试
+//!
+//! 模式切换 (always / madvise / never)、MADV_HUGEPAGE 下写缺页直接映射大页、
+//! khugepaged 把填满的 4KB 区域合并为大页、部分 munmap 拆分合并出的大页
+
+use crate::println;
+use crate::arch::riscv64::mm::{
+    create_user_address_space, handle_mm_fault, madv, map, set_transparent_hugepage, transparent_hugepage,
+    AddressSpace, FaultFlags, MmFaultResult, ThpMode, VirtAddr, HPAGE_SIZE,
+};
+use crate::mm::khugepaged::write_enabled;
+use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+use crate::mm::vma::{VmaFlags, VmaType};
+
+fn pattern(i: usize) -> u8 {
+    (i % 241) as u8 ^ 0x5a
+}
+
+fn write_fault(aspace: &AddressSpace, addr: usize) {
+    assert_eq!(handle_mm_fault(aspace, VirtAddr::new(addr as u64), FaultFlags::WRITE | FaultFlags::USER),
+               MmFaultResult::Handled);
+}
+
+/// [addr, addr + HPAGE_SIZE) 是否映射到一个 2MB 对齐的连续物理块
+fn is_huge(aspace: &AddressSpace, addr: usize) -> bool {
+    let base = match aspace.translate(PageVirtAddr::new(addr)) {
+        Some(phys) => phys.as_usize(),
+        None => return false,
+    };
+    base % HPAGE_SIZE == 0
+        && aspace.translate(PageVirtAddr::new(addr + HPAGE_SIZE - PAGE_SIZE)).map(|phys| phys.as_usize())
+            == Some(base + HPAGE_SIZE - PAGE_SIZE)
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_thp() {
+    println!("test: ===== Starting THP Tests =====");
+    let saved = transparent_hugepage();
+
+    // 1. 模式切换
+    println!("test: 1. Testing THP mode control...");
+    assert_eq!(write_enabled(b"madvise\n"), Ok(8));
+    assert_eq!(transparent_hugepage(), ThpMode::Madvise);
+    assert!(write_enabled(b"sometimes").is_err());
+    assert_eq!(transparent_hugepage(), ThpMode::Madvise);
+    println!("test:    SUCCESS - mode switched and bad values rejected");
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            set_transparent_hugepage(saved);
+            println!("test:    SKIP - no page table available");
+            println!("test: ===== THP Tests Completed =====");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new(root_ppn) };
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let start = aspace
+        .mmap(PageVirtAddr::new(0), 2 * HPAGE_SIZE, flags, VmaType::Anonymous, map::MAP_PRIVATE | map::MAP_ANONYMOUS)
+        .expect("mmap failed")
+        .as_usize();
+    assert_eq!(start % HPAGE_SIZE, 0);
+    let second = start + HPAGE_SIZE;
+
+    // 2. madvise 模式只有 MADV_HUGEPAGE 的范围使用大页
+    println!("test: 2. Testing madvise mode...");
+    write_fault(&aspace, start);
+    assert!(!aspace.is_mapped(PageVirtAddr::new(start + PAGE_SIZE)), "unadvised range got a huge page");
+    aspace.madvise(PageVirtAddr::new(second), HPAGE_SIZE, madv::MADV_HUGEPAGE).expect("madvise failed");
+    write_fault(&aspace, second + 7 * PAGE_SIZE);
+    if is_huge(&aspace, second) {
+        println!("test:    SUCCESS - advised range mapped by one huge page");
+    } else {
+        println!("test:    SKIP - no contiguous 2MB block available");
+    }
+
+    // 3. khugepaged 合并填满的区域
+    println!("test: 3. Testing khugepaged collapse...");
+    set_transparent_hugepage(ThpMode::Never);
+    for addr in (start + PAGE_SIZE..second).step_by(PAGE_SIZE) {
+        write_fault(&aspace, addr);
+    }
+    for addr in (start..second).step_by(PAGE_SIZE) {
+        let phys = aspace.translate(PageVirtAddr::new(addr)).unwrap().as_usize();
+        unsafe { *(phys as *mut u8) = pattern((addr - start) / PAGE_SIZE) };
+    }
+    assert!(!is_huge(&aspace, start));
+    // never 模式下不合并
+    assert_eq!(aspace.collapse_scan(0, 4).1, 0);
+    set_transparent_hugepage(ThpMode::Madvise);
+    aspace.madvise(PageVirtAddr::new(start), HPAGE_SIZE, madv::MADV_HUGEPAGE).expect("madvise failed");
+    let (scanned, collapsed, _) = aspace.collapse_scan(0, 4);
+    assert!(scanned >= 1);
+    if collapsed > 0 {
+        assert!(is_huge(&aspace, start));
+        for addr in (start..second).step_by(PAGE_SIZE) {
+            let phys = aspace.translate(PageVirtAddr::new(addr)).unwrap().as_usize();
+            assert_eq!(unsafe { *(phys as *const u8) }, pattern((addr - start) / PAGE_SIZE), "collapse lost data");
+        }
+        println!("test:    SUCCESS - 512 small pages collapsed into a huge page");
+
+        // 4. 部分 munmap 拆分大页
+        println!("test: 4. Testing partial munmap of a collapsed page...");
+        let base = aspace.translate(PageVirtAddr::new(start)).unwrap().as_usize();
+        aspace.munmap(PageVirtAddr::new(start + 3 * PAGE_SIZE), PAGE_SIZE).expect("munmap failed");
+        assert!(!aspace.is_mapped(PageVirtAddr::new(start + 3 * PAGE_SIZE)));
+        assert_eq!(aspace.translate(PageVirtAddr::new(start + 4 * PAGE_SIZE)).unwrap().as_usize(),
+                   base + 4 * PAGE_SIZE);
+        println!("test:    SUCCESS - huge page split, neighbours stay mapped");
+    } else {
+        println!("test:    SKIP - no contiguous 2MB block available");
+    }
+
+    aspace.mmput();
+    set_transparent_hugepage(saved);
+    println!("test: ===== THP Tests Completed =====");
+}
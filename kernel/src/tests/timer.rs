@@ -0,0 +1,228 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：定时器子系统
+//
+// 测试内容：
+// 1. 时间轮：各层的定时器都不早于到期时间触发，粗粒度层的误差不超过一个桶
+// 2. mod_timer 修改与 del_timer，回调中重新挂起自己
+// 3. hrtimer 按到期时间顺序执行，取消后不再执行，周期定时器推进后重新入队
+// 4. timerfd：到期次数、poll 就绪与 settime / gettime
+// 5. nohz_full 的 CPU 列表解析
+
+use alloc::boxed::Box;
+use alloc::vec::Vec;
+use core::sync::atomic::{AtomicPtr, AtomicU64, AtomicUsize, Ordering};
+use spin::Mutex;
+use crate::println;
+use crate::drivers::timer::get_jiffies;
+use crate::fs::file::{fput, poll_mask::*};
+use crate::fs::timerfd::{
+    file_timerfd, timerfd_create_file, timerfd_gettime, timerfd_settime, TimerFdSpec, CLOCK_MONOTONIC,
+    TFD_NONBLOCK, TFD_TIMER_ABSTIME,
+};
+use crate::time::hrtimer::{
+    hrtimer_cancel, hrtimer_is_queued, hrtimer_run_queues_on, hrtimer_run_softirq, hrtimer_start_on, Hrtimer,
+    HrtimerBase, HrtimerMode, HrtimerRestart,
+};
+use crate::time::timer::{
+    del_timer, mod_timer_on, next_expiry_on, run_timers_on, timer_pending, TimerBase, TimerList,
+};
+use crate::time::tick::parse_cpulist;
+use crate::time::{ktime_get, NSEC_PER_MSEC};
+
+/// 驱动时间轮的模拟 jiffies，回调据此记录触发时刻
+static NOW: AtomicU64 = AtomicU64::new(0);
+/// 回调中重新挂起时使用的时间轮
+static REARM_BASE: AtomicPtr<Mutex<TimerBase>> = AtomicPtr::new(core::ptr::null_mut());
+/// hrtimer 回调的执行顺序
+static HR_ORDER: Mutex<Vec<usize>> = Mutex::new(Vec::new());
+/// 周期 hrtimer 累计的周期数
+static HR_OVERRUNS: AtomicU64 = AtomicU64::new(0);
+
+/// 定时器的触发记录
+struct Fired {
+    at: AtomicU64,
+    count: AtomicUsize,
+}
+
+impl Fired {
+    const fn new() -> Self {
+        Self { at: AtomicU64::new(0), count: AtomicUsize::new(0) }
+    }
+}
+
+pub fn test_timer() {
+    println!("test: ===== Testing Timer Wheel and Hrtimers =====");
+
+    // 测试 1: 各层的到期精度
+    println!("test: 1. Testing timer wheel levels...");
+    let base = Box::new(Mutex::new(TimerBase::new()));
+    // 空时间轮被前移到当前 jiffies，到期时间都相对于它
+    let j0 = get_jiffies();
+    let delays = [1u64, 10, 62, 100, 1000, 5000];
+    let fired: Vec<Fired> = delays.iter().map(|_| Fired::new()).collect();
+    let timers: Vec<TimerList> = fired.iter().map(|f| TimerList::new(record, f as *const Fired as usize)).collect();
+    for (timer, &delay) in timers.iter().zip(delays.iter()) {
+        mod_timer_on(&base, timer, j0 + delay);
+    }
+    assert_eq!(base.lock().nr_pending(), delays.len());
+    run_until(&base, j0, j0 + 6000);
+    for (f, &delay) in fired.iter().zip(delays.iter()) {
+        let at = f.at.load(Ordering::Relaxed);
+        assert_eq!(f.count.load(Ordering::Relaxed), 1);
+        assert!(at >= j0 + delay);
+        // 第 0 层精确到 jiffy，更高层不超过一个桶的粒度 (delay / 7)
+        if delay < 63 {
+            assert_eq!(at, j0 + delay);
+        } else {
+            assert!(at - (j0 + delay) <= delay / 7);
+        }
+    }
+    assert_eq!(base.lock().nr_pending(), 0);
+    println!("test:    SUCCESS - {} timers across levels, none early", delays.len());
+
+    // 测试 2: mod_timer / del_timer 与回调中重新挂起
+    println!("test: 2. Testing mod_timer, del_timer and re-arming...");
+    let j1 = j0 + 6001;
+    let a = Fired::new();
+    let ta = TimerList::new(record, &a as *const Fired as usize);
+    assert!(!mod_timer_on(&base, &ta, j1 + 20));
+    assert!(timer_pending(&ta));
+    assert!(mod_timer_on(&base, &ta, j1 + 5));
+    assert_eq!(next_expiry_on(&base), Some(j1 + 5));
+    run_until(&base, j1, j1 + 4);
+    assert_eq!(a.count.load(Ordering::Relaxed), 0);
+    run_until(&base, j1 + 5, j1 + 5);
+    assert_eq!((a.count.load(Ordering::Relaxed), a.at.load(Ordering::Relaxed)), (1, j1 + 5));
+    assert!(!timer_pending(&ta));
+    mod_timer_on(&base, &ta, j1 + 30);
+    assert!(del_timer(&ta));
+    assert!(!del_timer(&ta));
+    assert_eq!(next_expiry_on(&base), None);
+    REARM_BASE.store(&*base as *const _ as *mut _, Ordering::Release);
+    let b = Fired::new();
+    let tb = TimerList::new(rearm, &b as *const Fired as usize);
+    mod_timer_on(&base, &tb, j1 + 10);
+    run_until(&base, j1 + 6, j1 + 100);
+    assert_eq!((b.count.load(Ordering::Relaxed), b.at.load(Ordering::Relaxed)), (3, j1 + 30));
+    assert!(!timer_pending(&tb));
+    println!("test:    SUCCESS - re-armed timer fired 3 times");
+
+    // 测试 3: hrtimer
+    println!("test: 3. Testing hrtimer ordering and restart...");
+    let hbase = Box::new(Mutex::new(HrtimerBase::new()));
+    let h1 = Hrtimer::new(hr_record, 1);
+    let h2 = Hrtimer::new(hr_record, 2);
+    let h3 = Hrtimer::new(hr_record, 3);
+    assert!(hrtimer_start_on(&hbase, &h1, 3000, HrtimerMode::Abs));
+    assert!(hrtimer_start_on(&hbase, &h2, 1000, HrtimerMode::Abs));
+    assert!(!hrtimer_start_on(&hbase, &h3, 2000, HrtimerMode::Abs));
+    assert_eq!(hbase.lock().next_event(), Some(1000));
+    hrtimer_run_queues_on(&hbase, 1500);
+    assert_eq!(*HR_ORDER.lock(), [2]);
+    hrtimer_run_queues_on(&hbase, 2500);
+    assert_eq!(*HR_ORDER.lock(), [2, 3]);
+    assert!(hrtimer_cancel(&h1));
+    assert!(!hrtimer_is_queued(&h1));
+    hrtimer_run_queues_on(&hbase, 5000);
+    assert_eq!(*HR_ORDER.lock(), [2, 3]);
+    // 周期 100ns：一次执行跳过的周期都计入，下次到期晚于当前时间
+    let hp = Hrtimer::new(hr_periodic, 100);
+    hrtimer_start_on(&hbase, &hp, 10_000, HrtimerMode::Abs);
+    HR_NOW.store(10_350, Ordering::Relaxed);
+    hrtimer_run_queues_on(&hbase, 10_350);
+    assert_eq!(HR_OVERRUNS.load(Ordering::Relaxed), 4);
+    assert!(hrtimer_is_queued(&hp));
+    assert_eq!(hp.expires(), 10_400);
+    HR_NOW.store(10_400, Ordering::Relaxed);
+    hrtimer_run_queues_on(&hbase, 10_400);
+    assert_eq!((HR_OVERRUNS.load(Ordering::Relaxed), hp.expires()), (5, 10_500));
+    assert!(hrtimer_cancel(&hp));
+    assert_eq!(hbase.lock().next_event(), None);
+    println!("test:    SUCCESS - 3 one-shot and 1 periodic hrtimer");
+
+    // 测试 4: timerfd
+    println!("test: 4. Testing timerfd...");
+    assert_eq!(timerfd_create_file(5, 0).err(), Some(-22));
+    assert_eq!(timerfd_create_file(CLOCK_MONOTONIC, 1).err(), Some(-22));
+    let file = timerfd_create_file(CLOCK_MONOTONIC, TFD_NONBLOCK).expect("timerfd");
+    let ctx = file_timerfd(&file).expect("timerfd ctx");
+    let mut buf = [0u8; 8];
+    assert_eq!(unsafe { file.read(buf.as_mut_ptr(), 8) }, -11);
+    assert_eq!(unsafe { file.read(buf.as_mut_ptr(), 4) }, -22);
+    assert_eq!(file.poll() & POLLIN, 0);
+    // 首次到期在 2.5ms 之前、周期 1ms：至少已经错过 3 个周期
+    // 测试期间时钟中断关闭，手动执行 HRTIMER_SOFTIRQ
+    let spec = TimerFdSpec { value: ktime_get() - 5 * NSEC_PER_MSEC / 2, interval: NSEC_PER_MSEC };
+    assert_eq!(timerfd_settime(ctx, TFD_TIMER_ABSTIME, spec), TimerFdSpec::default());
+    hrtimer_run_softirq();
+    assert_ne!(file.poll() & POLLIN, 0);
+    assert_eq!(unsafe { file.read(buf.as_mut_ptr(), 8) }, 8);
+    let ticks = u64::from_ne_bytes(buf);
+    assert!(ticks >= 3);
+    assert_eq!(file.poll() & POLLIN, 0);
+    let curr = timerfd_gettime(ctx);
+    assert!(curr.value > 0 && curr.value <= NSEC_PER_MSEC);
+    assert_eq!(curr.interval, NSEC_PER_MSEC);
+    // it_value 为 0 停止定时器，返回原来的设置
+    assert_eq!(timerfd_settime(ctx, 0, TimerFdSpec::default()).interval, NSEC_PER_MSEC);
+    assert_eq!(timerfd_gettime(ctx), TimerFdSpec::default());
+    fput(file);
+    println!("test:    SUCCESS - {} expirations read", ticks);
+
+    // 测试 5: nohz_full=<cpu 列表>
+    println!("test: 5. Testing nohz_full cpu list...");
+    assert_eq!(parse_cpulist("1"), Some(0b10));
+    assert_eq!(parse_cpulist("1-3"), Some(0b1110));
+    assert_eq!(parse_cpulist("0,2-3"), Some(0b1101));
+    // 超出 MAX_CPUS 的 CPU 被忽略
+    assert_eq!(parse_cpulist("3-100"), Some(1 << 3));
+    assert_eq!(parse_cpulist("3-1"), None);
+    assert_eq!(parse_cpulist("a"), None);
+    println!("test:    SUCCESS - cpu lists parsed");
+
+    println!("test: Timer testing completed.");
+}
+
+/// 按 jiffy 逐个推进时间轮
+fn run_until(base: &Mutex<TimerBase>, from: u64, to: u64) {
+    for j in from..=to {
+        NOW.store(j, Ordering::Relaxed);
+        run_timers_on(base, j);
+    }
+}
+
+/// 记录触发时刻
+fn record(timer: &TimerList) {
+    let fired = unsafe { &*(timer.data() as *const Fired) };
+    fired.at.store(NOW.load(Ordering::Relaxed), Ordering::Relaxed);
+    fired.count.fetch_add(1, Ordering::Relaxed);
+}
+
+/// 记录后每 10 个 jiffies 重新挂起，共触发 3 次
+fn rearm(timer: &TimerList) {
+    record(timer);
+    let fired = unsafe { &*(timer.data() as *const Fired) };
+    if fired.count.load(Ordering::Relaxed) < 3 {
+        let base = unsafe { &*REARM_BASE.load(Ordering::Acquire) };
+        mod_timer_on(base, timer, NOW.load(Ordering::Relaxed) + 10);
+    }
+}
+
+/// hrtimer 回调看到的当前时间
+static HR_NOW: AtomicU64 = AtomicU64::new(0);
+
+fn hr_record(timer: &Hrtimer) -> HrtimerRestart {
+    HR_ORDER.lock().push(timer.data());
+    HrtimerRestart::NoRestart
+}
+
+/// 周期为 data 纳秒的定时器
+fn hr_periodic(timer: &Hrtimer) -> HrtimerRestart {
+    let overruns = timer.forward(HR_NOW.load(Ordering::Relaxed), timer.data() as u64);
+    HR_OVERRUNS.fetch_add(overruns, Ordering::Relaxed);
+    HrtimerRestart::Restart
+}
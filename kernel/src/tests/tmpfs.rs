@@ -0,0 +1,180 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：tmpfs
+//
+// 测试内容：
+// 1. 挂载选项解析：size（含百分比）、nr_inodes、huge，未知选项返回 EINVAL
+// 2. 写入与读取：空洞读为 0 且不分配页
+// 3. 页缓存中的页不可驱逐，不在 LRU 上，计入 Shmem
+// 4. 截断释放页并清零末页尾部
+// 5. size 上限：写满后部分写入，之后返回 ENOSPC
+// 6. nr_inodes 上限：删除后可以再创建
+// 7. huge=always 整块分配 2MB 区间，截断后不再算作大页
+// 8. 删除文件释放页并注销页缓存
+
+use alloc::vec;
+
+use crate::errno::Errno;
+use crate::fs::tmpfs::{self, ShmemHuge, TmpfsOptions, TmpfsSuperBlock, HPAGE_PMD_NR};
+use crate::mm::filemap;
+use crate::mm::page_desc::{pfn_to_page, PageFlag};
+use crate::mm::PAGE_SIZE;
+use crate::println;
+
+fn options(max_blocks: usize, max_inodes: usize, huge: ShmemHuge) -> TmpfsOptions {
+    TmpfsOptions { max_blocks, max_inodes, huge }
+}
+
+pub fn test_tmpfs() {
+    println!("test: ===== Testing Tmpfs =====");
+    let enospc = Errno::NoSpaceLeftOnDevice.as_neg_i32();
+    let einval = Errno::InvalidArgument.as_neg_i32();
+
+    // 测试 1: 挂载选项
+    println!("test: 1. Testing mount option parsing...");
+    let opts = TmpfsOptions::parse(Some("size=1m,nr_inodes=16,huge=within_size,mode=1777")).unwrap();
+    assert_eq!(opts, options(256, 16, ShmemHuge::WithinSize));
+    let opts = TmpfsOptions::parse(Some("size=5000,nr_inodes=2k")).unwrap();
+    assert_eq!(opts.max_blocks, 2);
+    assert_eq!(opts.max_inodes, 2048);
+    let total = crate::mm::page_desc::total_pages();
+    assert_eq!(TmpfsOptions::parse(Some("size=10%")).unwrap().max_blocks, total * 10 / 100);
+    assert_eq!(TmpfsOptions::parse(None).unwrap(), TmpfsOptions::default_options());
+    assert_eq!(TmpfsOptions::parse(Some("huge=sometimes")), Err(einval));
+    assert_eq!(TmpfsOptions::parse(Some("noatime")), Err(einval));
+    assert_eq!(TmpfsOptions::parse(Some("size=12q")), Err(einval));
+    println!("test:    SUCCESS - options parsed");
+
+    // 测试 2: 写入、读取与空洞
+    println!("test: 2. Testing write, read and holes...");
+    let sb = TmpfsSuperBlock::new(options(0, 0, ShmemHuge::Never));
+    sb.mkdir("/dir", 0o755).unwrap();
+    let inode = sb.create("/dir/file", 0o644, false).unwrap();
+    assert_eq!(sb.create("/dir/file", 0o644, false).err(), Some(Errno::FileExists.as_neg_i32()));
+    assert_eq!(inode.write(2 * PAGE_SIZE, b"hello"), Ok(5));
+    assert_eq!(inode.nr_pages(), 1);
+    let mut buf = vec![0xffu8; 3 * PAGE_SIZE];
+    assert_eq!(inode.read(0, &mut buf), 2 * PAGE_SIZE + 5);
+    assert!(buf[..2 * PAGE_SIZE].iter().all(|&b| b == 0));
+    assert_eq!(&buf[2 * PAGE_SIZE..2 * PAGE_SIZE + 5], b"hello");
+    // 读空洞不分配页
+    assert_eq!(inode.nr_pages(), 1);
+    assert_eq!(inode.read(2 * PAGE_SIZE + 5, &mut buf), 0);
+    let mut buf = [0u8; 5];
+    assert_eq!(inode.append(b" world"), Ok((2 * PAGE_SIZE + 5, 6)));
+    assert_eq!(inode.read(2 * PAGE_SIZE + 6, &mut buf), 5);
+    assert_eq!(&buf, b"world");
+    let listed = sb.list_dir("/dir").unwrap();
+    assert_eq!(listed.len(), 1);
+    assert_eq!(listed[0].0, b"file");
+    println!("test:    SUCCESS - holes read as zero without allocating");
+
+    // 测试 3: 不可驱逐
+    println!("test: 3. Testing unevictable pages...");
+    let mapping = inode.mapping();
+    let phys = mapping.find_page(2).unwrap();
+    let page = pfn_to_page(phys / PAGE_SIZE);
+    assert!(unsafe { (*page).test_flag(PageFlag::Unevictable) });
+    assert!(!unsafe { (*page).test_flag(PageFlag::Lru) });
+    assert!(tmpfs::nr_shmem_pages() >= 1);
+    assert_eq!(sb.used_blocks(), 1);
+    println!("test:    SUCCESS - pages are unevictable and accounted");
+
+    // 测试 4: 截断
+    println!("test: 4. Testing truncate...");
+    let data = vec![0x5au8; 3 * PAGE_SIZE];
+    assert_eq!(inode.write(0, &data), Ok(3 * PAGE_SIZE));
+    assert_eq!(inode.nr_pages(), 3);
+    inode.truncate(100).unwrap();
+    assert_eq!(inode.nr_pages(), 1);
+    assert_eq!(sb.used_blocks(), 1);
+    assert_eq!(mapping.nr_cached(), 1);
+    inode.truncate(2 * PAGE_SIZE).unwrap();
+    let mut buf = vec![0xffu8; 2 * PAGE_SIZE];
+    assert_eq!(inode.read(0, &mut buf), 2 * PAGE_SIZE);
+    assert!(buf[..100].iter().all(|&b| b == 0x5a));
+    assert!(buf[100..].iter().all(|&b| b == 0));
+    assert_eq!(inode.nr_pages(), 1);
+    println!("test:    SUCCESS - truncate frees pages and zeroes the tail");
+
+    // 测试 8 检查这个键在删除文件后被注销
+    let key = inode.mapping_key();
+    drop(mapping);
+    drop(inode);
+
+    // 测试 5: size 上限
+    println!("test: 5. Testing size limit...");
+    let small = TmpfsSuperBlock::new(options(4, 0, ShmemHuge::Never));
+    let file = small.create("/f", 0o644, false).unwrap();
+    let data = vec![1u8; 5 * PAGE_SIZE];
+    assert_eq!(file.write(0, &data), Ok(4 * PAGE_SIZE));
+    assert_eq!(file.write(4 * PAGE_SIZE, &data), Err(enospc));
+    let mut buf = vec![0u8; PAGE_SIZE];
+    assert_eq!(file.read(4 * PAGE_SIZE, &mut buf), 0);
+    assert_eq!(small.used_blocks(), 4);
+    // 已有的页可以覆盖写
+    assert_eq!(file.write(0, b"again"), Ok(5));
+    drop(file);
+    small.unlink("/f").unwrap();
+    assert_eq!(small.used_blocks(), 0);
+    println!("test:    SUCCESS - writes stop at the size limit");
+
+    // 测试 6: nr_inodes 上限（根目录占一个）
+    println!("test: 6. Testing nr_inodes limit...");
+    let few = TmpfsSuperBlock::new(options(0, 3, ShmemHuge::Never));
+    few.create("/a", 0o644, false).unwrap();
+    few.mkdir("/d", 0o755).unwrap();
+    assert_eq!(few.create("/b", 0o644, false).err(), Some(enospc));
+    few.unlink("/a").unwrap();
+    assert_eq!(few.used_inodes(), 2);
+    few.create("/b", 0o644, false).unwrap();
+    assert_eq!(few.unlink("/d"), Err(Errno::IsADirectory.as_neg_i32()));
+    assert_eq!(few.rmdir("/b"), Err(Errno::NotADirectory.as_neg_i32()));
+    few.unlink("/b").unwrap();
+    few.rmdir("/d").unwrap();
+    assert_eq!(few.used_inodes(), 1);
+    println!("test:    SUCCESS - inode limit enforced");
+
+    // 测试 7: 大页区间
+    println!("test: 7. Testing huge extents...");
+    let huge = TmpfsSuperBlock::new(options(0, 0, ShmemHuge::Always));
+    let file = huge.create("/h", 0o644, false).unwrap();
+    let thps = tmpfs::nr_shmem_huge_pages();
+    assert_eq!(file.write(PAGE_SIZE, b"x"), Ok(1));
+    if file.nr_huge_extents() == 1 {
+        assert_eq!(file.nr_pages(), HPAGE_PMD_NR);
+        assert_eq!(tmpfs::nr_shmem_huge_pages(), thps + 1);
+        let mapping = file.mapping();
+        let first = mapping.find_page(0).unwrap();
+        assert_eq!(first % (HPAGE_PMD_NR * PAGE_SIZE), 0);
+        assert_eq!(mapping.find_page(HPAGE_PMD_NR - 1), Some(first + (HPAGE_PMD_NR - 1) * PAGE_SIZE));
+        file.truncate(PAGE_SIZE).unwrap();
+        assert_eq!(file.nr_huge_extents(), 0);
+        assert_eq!(tmpfs::nr_shmem_huge_pages(), thps);
+        assert_eq!(file.nr_pages(), 1);
+        println!("test:    SUCCESS - 2MB extent allocated contiguously");
+    } else {
+        // 没有连续内存时退回 4KB 页
+        assert_eq!(file.nr_pages(), 1);
+        println!("test:    SUCCESS - fell back to 4K pages (no contiguous memory)");
+    }
+    drop(file);
+    huge.unlink("/h").unwrap();
+    assert_eq!(huge.used_blocks(), 0);
+
+    // 测试 8: 删除
+    println!("test: 8. Testing unlink and evict...");
+    assert!(filemap::find_mapping(key).is_some());
+    sb.unlink("/dir/file").unwrap();
+    assert!(filemap::find_mapping(key).is_none());
+    assert_eq!(sb.used_blocks(), 0);
+    assert_eq!(sb.rmdir("/"), Err(Errno::DeviceOrResourceBusy.as_neg_i32()));
+    sb.rmdir("/dir").unwrap();
+    assert!(sb.lookup("/dir").is_none());
+    println!("test:    SUCCESS - unlink frees pages and the mapping");
+
+    println!("test: Tmpfs testing completed.");
+}
@@ -0,0 +1,86 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：二进制跟踪环形缓冲区
+//
+// 测试内容：
+// 1. 事件开关与 /proc/trace_events 的写入控制
+// 2. trace_record! 关闭时不求值参数，开启时写入带 CPU 和 PID 的记录
+// 3. 写满后最旧的记录被覆盖，读者得到一条 TRACE_LOST 和按时间排序的记录
+// 4. /proc/trace_pipe_raw 输出整条记录
+
+use core::sync::atomic::{AtomicU32, Ordering};
+
+use crate::errno::Errno;
+use crate::println;
+use crate::trace::ring_buffer::{self, TraceEntry, TraceReader, TRACE_LOST, TRACE_NET_RX, TRACE_RING_SIZE};
+
+pub fn test_trace_ring_buffer() {
+    println!("test: ===== Testing Trace Ring Buffer =====");
+
+    let was_enabled = ring_buffer::event_enabled(TRACE_NET_RX);
+
+    // 测试 1: 事件开关
+    println!("test: 1. Testing event controls...");
+    assert!(ring_buffer::set_event_enabled("net_rx", false));
+    assert!(!ring_buffer::event_enabled(TRACE_NET_RX));
+    assert!(!ring_buffer::set_event_enabled("no_such_event", true));
+    assert!(!ring_buffer::set_event_enabled("lost", true));
+    assert_eq!(ring_buffer::write_control(b"net_rx 1\n"), Ok(9));
+    assert!(ring_buffer::event_enabled(TRACE_NET_RX));
+    assert!(ring_buffer::generate_events().lines().any(|line| line == "net_rx 1"));
+    assert_eq!(ring_buffer::write_control(b"net_rx on"), Err(Errno::InvalidArgument.as_neg_i32()));
+    assert_eq!(ring_buffer::write_control(b"bogus 1"), Err(Errno::InvalidArgument.as_neg_i32()));
+    assert_eq!(ring_buffer::write_control(b"net_rx 0"), Ok(8));
+    assert!(!ring_buffer::event_enabled(TRACE_NET_RX));
+    println!("test:    SUCCESS - events toggled by name");
+
+    // 测试 2: 写入记录
+    println!("test: 2. Testing trace_record!...");
+    let evaluated = AtomicU32::new(0);
+    let arg = || evaluated.fetch_add(1, Ordering::Relaxed) as u64 + 0x55;
+    let mut reader = TraceReader::new();
+    crate::trace_record!(TRACE_NET_RX, arg(), 2, 3);
+    assert_eq!(evaluated.load(Ordering::Relaxed), 0);
+    ring_buffer::set_event_enabled("net_rx", true);
+    crate::trace_record!(TRACE_NET_RX, arg(), 2, 3);
+    ring_buffer::set_event_enabled("net_rx", false);
+    assert_eq!(evaluated.load(Ordering::Relaxed), 1);
+    let entries = reader.read();
+    let ours: alloc::vec::Vec<&TraceEntry> =
+        entries.iter().filter(|entry| entry.event == TRACE_NET_RX && entry.data == [0x55, 2, 3]).collect();
+    assert_eq!(ours.len(), 1);
+    assert_eq!(ours[0].cpu as u64, crate::arch::cpu_id());
+    assert_eq!(ours[0].pid, crate::sched::sched::cpu_curr_pid());
+    assert!(reader.read().iter().all(|entry| entry.data != [0x55, 2, 3]));
+    println!("test:    SUCCESS - one record at ts {}", ours[0].ts);
+
+    // 测试 3: 覆盖与排序
+    println!("test: 3. Testing overwrite and ordering...");
+    let mut reader = TraceReader::new();
+    for i in 0..(TRACE_RING_SIZE + 10) as u64 {
+        ring_buffer::record(TRACE_NET_RX, [i, 0, 0]);
+    }
+    let entries = reader.read();
+    assert_eq!(entries[0].event, TRACE_LOST);
+    assert!(entries[0].data[0] >= 10);
+    assert!(entries[1..].windows(2).all(|pair| pair[0].ts <= pair[1].ts));
+    let last = entries.iter().rev().find(|entry| entry.event == TRACE_NET_RX).map(|entry| entry.data[0]);
+    assert_eq!(last, Some((TRACE_RING_SIZE + 9) as u64));
+    println!("test:    SUCCESS - {} lost, {} kept", entries[0].data[0], entries.len() - 1);
+
+    // 测试 4: /proc/trace_pipe_raw
+    println!("test: 4. Testing /proc/trace_pipe_raw...");
+    let size = core::mem::size_of::<TraceEntry>();
+    assert_eq!(size, 40);
+    assert_eq!(ring_buffer::encode(&entries[..2]).len(), 2 * size);
+    let raw = crate::fs::procfs::read_file("/trace_pipe_raw").expect("/proc/trace_pipe_raw exists");
+    assert_eq!(raw.len() % size, 0);
+    assert!(raw.len() > 0);
+    println!("test:    SUCCESS - {} records streamed", raw.len() / size);
+
+    ring_buffer::set_event_enabled("net_rx", was_enabled);
+    println!("test: Trace ring buffer testing completed.");
+}
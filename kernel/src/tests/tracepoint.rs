@@ -0,0 +1,46 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：跟踪点开关
+//
+// 测试内容：
+// 1. 跟踪点默认关闭
+// 2. 通过 /proc/tracepoints 格式的命令开启和关闭
+// 3. 非法命令返回 EINVAL
+
+use crate::println;
+use crate::errno::Errno;
+use crate::trace;
+
+pub fn test_tracepoint() {
+    println!("test: ===== Testing Tracepoints =====");
+
+    // 测试 1: 列表包含所有跟踪点
+    println!("test: 1. Testing tracepoint list...");
+    let list = trace::generate_list();
+    assert!(list.contains("sched_switch "), "list should contain sched_switch");
+    assert!(list.contains("syscall "), "list should contain syscall");
+    println!("test:    SUCCESS - tracepoints listed");
+
+    // 测试 2: 开启后关闭
+    println!("test: 2. Testing enable/disable...");
+    let was_enabled = trace::SCHED_WAIT.enabled();
+    assert_eq!(trace::write_control(b"sched_wait 1\n"), Ok(13));
+    assert!(trace::SCHED_WAIT.enabled(), "sched_wait should be enabled");
+    assert!(trace::generate_list().contains("sched_wait 1"));
+    assert_eq!(trace::write_control(b"sched_wait 0"), Ok(12));
+    assert!(!trace::SCHED_WAIT.enabled(), "sched_wait should be disabled");
+    trace::SCHED_WAIT.set_enabled(was_enabled);
+    println!("test:    SUCCESS - sched_wait toggled");
+
+    // 测试 3: 非法命令
+    println!("test: 3. Testing invalid commands...");
+    let einval = Err(Errno::InvalidArgument.as_neg_i32());
+    assert_eq!(trace::write_control(b"no_such_event 1"), einval);
+    assert_eq!(trace::write_control(b"sched_wait on"), einval);
+    println!("test:    SUCCESS - invalid commands rejected");
+
+    println!("test: ===== Tracepoint Test Completed =====");
+}
@@ -0,0 +1,122 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! TTY 层单元测试
+//!
+//! 发送缓冲区的回绕与 ONLCR 输出处理、规范模式的行编辑与回显、VEOF、
+//! 非规范模式按 VMIN 返回；都使用局部的缓冲区和线路规程，不访问串口
+
+use alloc::boxed::Box;
+use alloc::vec::Vec;
+
+use crate::drivers::tty::n_tty::NTty;
+use crate::drivers::tty::serial::CircBuf;
+use crate::drivers::tty::{process_output, Termios, ECHO, ICANON, ONLCR, OPOST, VMIN};
+use crate::println;
+
+/// 送入字符，返回回显
+fn feed(tty: &mut NTty, chars: &[u8]) -> Vec<u8> {
+    let mut echoed = Vec::new();
+    tty.receive_buf(chars, &mut |buf| echoed.extend_from_slice(buf));
+    echoed
+}
+
+fn read_all<const N: usize>(ring: &CircBuf<N>) -> Vec<u8> {
+    let mut out = Vec::new();
+    while let Some(c) = ring.pop() {
+        out.push(c);
+    }
+    out
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_tty() {
+    println!("test: ===== Starting TTY Tests =====");
+
+    // 1. 环形缓冲区回绕与满
+    println!("test: 1. Testing xmit ring wrap-around...");
+    let ring: CircBuf<8> = CircBuf::new();
+    assert_eq!(ring.push(b"abcdef"), 6);
+    assert_eq!(read_all(&ring), b"abcdef");
+    assert_eq!(ring.push(b"0123456789"), 8);
+    assert_eq!(ring.space(), 0);
+    let mut out = [0u8; 5];
+    assert_eq!(ring.pop_into(&mut out), 5);
+    assert_eq!(&out, b"01234");
+    assert_eq!(ring.push(b"xy"), 2);
+    assert_eq!(read_all(&ring), b"567xy");
+    println!("test:    SUCCESS - ring wraps and stops when full");
+
+    // 2. ONLCR：换行写成 \r\n，放不下两个字节就停在换行之前
+    println!("test: 2. Testing output processing...");
+    let ring: CircBuf<8> = CircBuf::new();
+    assert_eq!(process_output(&ring, b"a\nb\n", OPOST | ONLCR), 4);
+    assert_eq!(read_all(&ring), b"a\r\nb\r\n");
+    assert_eq!(process_output(&ring, b"abcdef\nz", OPOST | ONLCR), 7);
+    assert_eq!(read_all(&ring), b"abcdef\r\n");
+    assert_eq!(ring.push(b"abcdefg"), 7);
+    assert_eq!(process_output(&ring, b"\nz", OPOST | ONLCR), 0);
+    assert_eq!(read_all(&ring), b"abcdefg");
+    assert_eq!(process_output(&ring, b"a\n", 0), 2);
+    assert_eq!(read_all(&ring), b"a\n");
+    println!("test:    SUCCESS - ONLCR expands newlines, raw output is copied as is");
+
+    let mut tty = Box::new(NTty::new());
+    let mut buf = [0u8; 64];
+
+    // 3. 规范模式：行完成之前不可读，VERASE / VKILL 编辑当前行
+    println!("test: 3. Testing canonical line editing...");
+    assert_eq!(feed(&mut tty, b"ab\x7f"), b"ab\x08 \x08");
+    assert!(tty.read(&mut buf).is_none());
+    assert_eq!(feed(&mut tty, b"c\r"), b"c\n");
+    assert_eq!(tty.readable(), 3);
+    assert_eq!(tty.read(&mut buf), Some(3));
+    assert_eq!(&buf[..3], b"ac\n");
+    feed(&mut tty, b"xyz\x15ok\n");
+    assert_eq!(tty.read(&mut buf), Some(3));
+    assert_eq!(&buf[..3], b"ok\n");
+    // 一次只返回一行，缓冲区小时分多次
+    feed(&mut tty, b"one\ntwo\n");
+    assert_eq!(tty.read(&mut buf[..2]), Some(2));
+    assert_eq!(tty.read(&mut buf), Some(2));
+    assert_eq!(&buf[..2], b"e\n");
+    assert_eq!(tty.read(&mut buf), Some(4));
+    assert_eq!(&buf[..4], b"two\n");
+    println!("test:    SUCCESS - erase, kill and one line per read");
+
+    // 4. 控制字符回显为 ^X，VEOF 不交给读者
+    println!("test: 4. Testing ECHOCTL and VEOF...");
+    assert_eq!(feed(&mut tty, b"\x01\x7f"), b"^A\x08 \x08\x08 \x08");
+    feed(&mut tty, b"hi\x04");
+    assert_eq!(tty.read(&mut buf), Some(2));
+    assert_eq!(&buf[..2], b"hi");
+    feed(&mut tty, b"\x04");
+    assert_eq!(tty.read(&mut buf), Some(0));
+    assert!(tty.read(&mut buf).is_none());
+    println!("test:    SUCCESS - control characters echoed, EOF returns 0");
+
+    // 5. 非规范模式：按 VMIN 返回，关闭回显
+    println!("test: 5. Testing non-canonical mode...");
+    let mut raw: Termios = tty.termios;
+    raw.c_lflag &= !(ICANON | ECHO);
+    raw.c_cc[VMIN] = 2;
+    feed(&mut tty, b"pa");
+    tty.set_termios(&raw);
+    // 离开规范模式时未完成的行立即可读
+    assert_eq!(tty.read(&mut buf), Some(2));
+    assert!(feed(&mut tty, b"q").is_empty());
+    assert!(!tty.input_available());
+    assert!(tty.read(&mut buf).is_none());
+    feed(&mut tty, b"\x7f");
+    assert_eq!(tty.read(&mut buf), Some(2));
+    assert_eq!(&buf[..2], b"q\x7f");
+    raw.c_cc[VMIN] = 0;
+    tty.set_termios(&raw);
+    assert_eq!(tty.read(&mut buf), Some(0));
+    tty.set_termios(&Termios::std());
+    println!("test:    SUCCESS - VMIN honoured, erase is a plain byte");
+
+    println!("test: ===== TTY Tests Completed =====");
+}
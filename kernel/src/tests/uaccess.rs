@@ -0,0 +1,88 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：用户内存复制
+//
+// 测试内容：
+// 1. copy_from_user / copy_to_user 的按字与逐字节路径
+// 2. 访问未映射地址时由异常表修复，返回未复制的字节数
+// 3. strncpy_from_user / strndup_user 的长度与错误
+// 4. get_user / put_user 与 access_ok
+
+use alloc::vec;
+use crate::println;
+use crate::arch::riscv64::uaccess::*;
+
+const EFAULT: i32 = -14;
+const EINVAL: i32 = -22;
+
+/// 用户地址空间内、没有任何映射的地址
+const UNMAPPED: usize = 0x10_0000_0000;
+
+fn sum_bit() -> u64 {
+    let sstatus: u64;
+    unsafe { core::arch::asm!("csrr {}, sstatus", out(reg) sstatus) };
+    sstatus & 0x40000
+}
+
+pub fn test_uaccess() {
+    println!("test: ===== Testing User Memory Copy =====");
+
+    // 测试 1: 各种长度与对齐
+    println!("test: 1. Testing copy_from_user/copy_to_user...");
+    let sum = sum_bit();
+    let src: [u8; 100] = core::array::from_fn(|i| i as u8 ^ 0x5a);
+    for &(src_off, dst_off, len) in &[(0, 0, 100), (3, 3, 90), (1, 2, 70), (0, 0, 7), (5, 5, 33)] {
+        let mut dst = [0u8; 100];
+        assert_eq!(copy_from_user(&mut dst[dst_off..dst_off + len], src[src_off..].as_ptr() as usize), 0);
+        assert_eq!(dst[dst_off..dst_off + len], src[src_off..src_off + len]);
+        assert!(dst[..dst_off].iter().chain(dst[dst_off + len..].iter()).all(|&b| b == 0));
+    }
+    let mut dst = [0u8; 64];
+    assert_eq!(copy_to_user(dst.as_mut_ptr() as usize + 1, &src[..63]), 0);
+    assert_eq!(dst[1..], src[..63]);
+    assert_eq!(sum_bit(), sum);
+    println!("test:    SUCCESS - word and byte copies match");
+
+    // 测试 2: 缺页修复
+    println!("test: 2. Testing fault fixup...");
+    let mut buf = [0xeeu8; 48];
+    assert_eq!(copy_from_user(&mut buf, UNMAPPED), buf.len());
+    assert!(buf.iter().all(|&b| b == 0xee));
+    assert_eq!(copy_to_user(UNMAPPED + 3, &src[..20]), 20);
+    assert!(search_exception_table(sum_bit as usize).is_none());
+    assert_eq!(sum_bit(), sum);
+    println!("test:    SUCCESS - faults return the uncopied length");
+
+    // 测试 3: 字符串
+    println!("test: 3. Testing strncpy_from_user...");
+    let string = b"/bin/sh-with-a-longer-name\0pad";
+    let mut name = [0u8; 64];
+    assert_eq!(strncpy_from_user(&mut name, string.as_ptr() as usize), Ok(26));
+    assert_eq!(&name[..26], &string[..26]);
+    let mut short = [0u8; 9];
+    assert_eq!(strncpy_from_user(&mut short, string.as_ptr() as usize + 1), Ok(9));
+    assert_eq!(&short, &string[1..10]);
+    assert_eq!(strncpy_from_user(&mut name, UNMAPPED), Err(EFAULT));
+    assert_eq!(strncpy_from_user(&mut name, usize::MAX), Err(EFAULT));
+    assert_eq!(strndup_user(string.as_ptr() as usize, 64).unwrap(), &string[..26]);
+    assert_eq!(strndup_user(string.as_ptr() as usize, 8), Err(EINVAL));
+    println!("test:    SUCCESS - string length, truncation and EFAULT");
+
+    // 测试 4: 单个值与地址范围
+    println!("test: 4. Testing get_user/put_user...");
+    let mut value = vec![0x1122_3344_5566_7788u64, 0];
+    let addr = value.as_mut_ptr() as usize;
+    assert_eq!(get_user::<u64>(addr), Ok(0x1122_3344_5566_7788));
+    assert_eq!(put_user(addr + 8, &0xabcdu64), Ok(()));
+    assert_eq!(value[1], 0xabcd);
+    assert_eq!(get_user::<u32>(UNMAPPED), Err(EFAULT));
+    assert!(!access_ok(USER_SPACE_END, 1));
+    assert!(!access_ok(usize::MAX - 3, 8));
+    assert_eq!(copy_to_user(USER_SPACE_END - 4, &src[..8]), 8);
+    println!("test:    SUCCESS - single values and range checks");
+
+    println!("test: User memory copy testing completed.");
+}
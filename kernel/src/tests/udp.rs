@@ -0,0 +1,250 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：UDP 收发与 UDP GSO
+//
+// 测试内容：
+// 1. 数据报进入接收队列，按顺序取出并带源地址；缓冲区不足时截断
+// 2. 校验和错误与长度错误的数据报被丢弃，校验和为 0 的数据报被接受
+// 3. 接收缓冲区满时丢弃并计数
+// 4. UDP_SEGMENT 与 SO_BUSY_POLL 选项的设置与读取，发送参数检查
+// 5. UDP 超长包按 gso_size 切成各个数据报，长度与校验和逐个重算
+// 6. 发往本机的数据报经回环快速路径直接进入接收方队列，GSO 包按数据报到达
+
+use alloc::vec::Vec;
+use crate::println;
+use crate::drivers::net::loopback::loopback_stats;
+use crate::net::buffer::{alloc_skb, SkBuff, SKB_GSO_UDP_L4};
+use crate::net::busy_poll::{busy_read, write_busy_read, SO_BUSY_POLL};
+use crate::net::ethernet::ETH_HLEN;
+use crate::net::gso::skb_gso_segment;
+use crate::net::ipv4::{checksum, INADDR_LOCAL};
+use crate::net::udp::{
+    udp_bind, udp_busy_loop, udp_getsockopt, udp_rcv, udp_rcv_queue_len, udp_recv, udp_recvmsg, udp_sendmsg,
+    udp_setsockopt, udp_socket_alloc, udp_socket_free, udp_socket_get, udp_stats, SOL_UDP, UDP_SEGMENT,
+};
+use crate::net::tcp::SOL_SOCKET;
+
+/// 测试用的对端地址
+const PEER_IP: u32 = 0x0A000202;
+/// 测试用的本机地址
+const LOCAL_IP: u32 = 0x0A00020F;
+/// 回环地址 127.0.0.1
+const LOOPBACK_IP: u32 = 0x7F000001;
+
+pub fn test_udp() {
+    println!("test: ===== Testing UDP Datagrams and GSO =====");
+
+    let fd = udp_socket_alloc().expect("udp alloc");
+    assert_eq!(udp_bind(fd, 5353), 0);
+
+    // 测试 1: 接收队列
+    println!("test: 1. Testing receive queue...");
+    let base = udp_stats();
+    for i in 0..3u8 {
+        rcv_datagram(40000 + i as u16, 5353, &[i; 100], true, 0);
+    }
+    assert_eq!(udp_rcv_queue_len(fd), 3);
+    let dgram = udp_recvmsg(fd).ok().expect("datagram");
+    assert_eq!((dgram.saddr, dgram.sport, dgram.len()), (PEER_IP, 40000, 100));
+    assert!(dgram.to_vec().iter().all(|&b| b == 0));
+    dgram.free();
+    // 缓冲区只有 10 字节时其余部分丢弃，数据报整个出队
+    let mut buf = [0u8; 10];
+    assert_eq!(udp_recv(fd, &mut buf, 10), 10);
+    assert_eq!(buf, [1; 10]);
+    assert_eq!(udp_rcv_queue_len(fd), 1);
+    assert_eq!(udp_recv(fd, &mut buf, 10), 10);
+    assert_eq!(udp_recv(fd, &mut buf, 10), -11);
+    assert_eq!(udp_stats().in_datagrams, base.in_datagrams + 3);
+    println!("test:    SUCCESS - datagrams queued in order with source address");
+
+    // 测试 2: 校验和与长度
+    println!("test: 2. Testing checksum and length checks...");
+    let base = udp_stats();
+    rcv_datagram(40000, 5353, b"corrupt", true, 0x5a);
+    rcv_datagram(40000, 5353, b"no checksum", false, 0);
+    // UDP 长度超过 IP 给出的长度
+    let mut skb = datagram_skb(40000, 5353, b"short", true, 0);
+    assert!(udp_rcv(&skb, PEER_IP, LOCAL_IP, 0, skb.len - 1).is_err());
+    skb.free();
+    // 没有 socket 的端口
+    skb = datagram_skb(40000, 5354, b"nobody", true, 0);
+    assert!(udp_rcv(&skb, PEER_IP, LOCAL_IP, 0, skb.len).is_ok());
+    skb.free();
+    let stats = udp_stats();
+    assert_eq!(stats.in_errors, base.in_errors + 2);
+    assert_eq!(stats.no_ports, base.no_ports + 1);
+    assert_eq!(udp_rcv_queue_len(fd), 1);
+    let dgram = udp_recvmsg(fd).ok().expect("datagram");
+    assert_eq!(&dgram.to_vec()[..], b"no checksum");
+    dgram.free();
+    println!("test:    SUCCESS - bad datagrams dropped, zero checksum accepted");
+
+    // 测试 3: 接收缓冲区
+    println!("test: 3. Testing receive buffer limit...");
+    let base = udp_stats();
+    udp_socket_get(fd).expect("socket").rcvbuf = 250;
+    for _ in 0..4 {
+        rcv_datagram(40000, 5353, &[7; 100], true, 0);
+    }
+    assert_eq!(udp_rcv_queue_len(fd), 2);
+    assert_eq!(udp_stats().rcvbuf_errors, base.rcvbuf_errors + 2);
+    while let Ok(dgram) = udp_recvmsg(fd) {
+        dgram.free();
+    }
+    assert_eq!(udp_socket_get(fd).expect("socket").rmem_alloc, 0);
+    println!("test:    SUCCESS - datagrams beyond rcvbuf dropped");
+
+    // 测试 4: 选项与发送参数
+    println!("test: 4. Testing UDP_SEGMENT/SO_BUSY_POLL options and send checks...");
+    let mut out = [0u8; 4];
+    assert_eq!(udp_setsockopt(fd, SOL_UDP, UDP_SEGMENT, &1400i32.to_ne_bytes()), 0);
+    assert_eq!(udp_getsockopt(fd, SOL_UDP, UDP_SEGMENT, &mut out), 4);
+    assert_eq!(i32::from_ne_bytes(out), 1400);
+    assert_eq!(udp_setsockopt(fd, SOL_UDP, UDP_SEGMENT, &(-1i32).to_ne_bytes()), -22);
+    assert_eq!(udp_setsockopt(fd, SOL_UDP, 1, &0i32.to_ne_bytes()), -92);
+    assert_eq!(udp_setsockopt(fd, SOL_UDP, UDP_SEGMENT, &0i32.to_ne_bytes()), 0);
+    // SO_BUSY_POLL 默认取 busy_read；MSG_DONTWAIT 时队列为空只轮询一轮
+    assert_eq!(udp_getsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &mut out), 4);
+    assert_eq!(i32::from_ne_bytes(out) as u32, busy_read());
+    assert_eq!(udp_setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &50i32.to_ne_bytes()), 0);
+    assert_eq!(udp_getsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &mut out), 4);
+    assert_eq!(i32::from_ne_bytes(out), 50);
+    assert_eq!(udp_setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &(-1i32).to_ne_bytes()), -22);
+    udp_busy_loop(fd, true);
+    assert_eq!(udp_rcv_queue_len(fd), 0);
+    assert!(write_busy_read(b"-1\n").is_err());
+    let saved = busy_read();
+    assert_eq!(write_busy_read(b"25\n"), Ok(3));
+    assert_eq!(busy_read(), 25);
+    assert_eq!(write_busy_read(alloc::format!("{}", saved).as_bytes()).map(|_| busy_read()), Ok(saved));
+    // 未连接且没有目标地址
+    assert_eq!(udp_sendmsg(fd, &[b"x"], None, None), -89);
+    let big = alloc::vec![0u8; 65508];
+    assert_eq!(udp_sendmsg(fd, &[&big], Some((PEER_IP, 53)), None), -90);
+    // 超过 UDP_MAX_SEGMENTS 个分段
+    assert_eq!(udp_sendmsg(fd, &[&big[..6500]], Some((PEER_IP, 53)), Some(100)), -22);
+    println!("test:    SUCCESS - option round-trips, invalid sends rejected");
+    udp_socket_free(fd);
+
+    // 测试 5: GSO 切分
+    println!("test: 5. Testing UDP GSO segmentation...");
+    let payload: Vec<u8> = (0..2500u32).map(|i| (i * 7) as u8).collect();
+    let skb = gso_skb(&payload, 1000);
+    let segs = skb_gso_segment(skb, 0).ok().expect("segment");
+    assert_eq!(segs.len(), 3);
+    let mut joined = Vec::new();
+    for (i, seg) in segs.iter().enumerate() {
+        let bytes = frame_bytes(seg);
+        let seg_len = if i < 2 { 1000 } else { 500 };
+        assert_eq!(bytes.len(), ETH_HLEN + 28 + seg_len);
+        let ip = &bytes[ETH_HLEN..ETH_HLEN + 20];
+        assert_eq!(u16::from_be_bytes([ip[2], ip[3]]) as usize, 28 + seg_len);
+        assert_eq!(u16::from_be_bytes([ip[4], ip[5]]), 0x1000 + i as u16);
+        assert_eq!(checksum::ip_checksum(ip), 0);
+        let udp = &bytes[ETH_HLEN + 20..];
+        assert_eq!(u16::from_be_bytes([udp[4], udp[5]]) as usize, 8 + seg_len);
+        let sum = checksum::csum_tcpudp_nofold(LOCAL_IP, PEER_IP, udp.len() as u32, 17);
+        assert_eq!(checksum::csum_fold(checksum::csum_partial(udp, sum)), 0);
+        joined.extend_from_slice(&udp[8..]);
+    }
+    assert_eq!(joined, payload);
+    for seg in segs {
+        seg.free();
+    }
+    println!("test:    SUCCESS - 2500 bytes split into 3 datagrams with valid checksums");
+
+    // 测试 6: 本机投递
+    println!("test: 6. Testing local delivery fast path...");
+    let rx = udp_socket_alloc().expect("udp alloc");
+    let tx = udp_socket_alloc().expect("udp alloc");
+    assert_eq!(udp_bind(rx, 6000), 0);
+    let lo = loopback_stats();
+    assert_eq!(udp_sendmsg(tx, &[b"ping ", b"local"], Some((LOOPBACK_IP, 6000)), None), 10);
+    let dgram = udp_recvmsg(rx).ok().expect("datagram");
+    assert_eq!(&dgram.to_vec()[..], b"ping local");
+    // 未绑定的发送方自动绑定了临时端口
+    let sport = udp_socket_get(tx).expect("socket").local_port;
+    assert_eq!((dgram.saddr, dgram.sport), (INADDR_LOCAL, sport));
+    dgram.free();
+    assert_eq!(udp_sendmsg(tx, &[&payload], Some((LOOPBACK_IP, 6000)), Some(1000)), 2500);
+    assert_eq!(udp_rcv_queue_len(rx), 3);
+    let mut joined = Vec::new();
+    while let Ok(dgram) = udp_recvmsg(rx) {
+        assert!(dgram.len() <= 1000);
+        joined.extend_from_slice(&dgram.to_vec());
+        dgram.free();
+    }
+    assert_eq!(joined, payload);
+    let stats = loopback_stats();
+    assert_eq!(stats.tx_packets, lo.tx_packets + 2);
+    assert_eq!(stats.rx_packets, lo.rx_packets + 2);
+    udp_socket_free(rx);
+    udp_socket_free(tx);
+    println!("test:    SUCCESS - local datagrams queued without ARP or framing");
+
+    println!("test: UDP datagram and GSO testing completed.");
+}
+
+/// 构造对端发来的 UDP 数据报，`corrupt` 非 0 时改坏数据
+fn datagram_skb(sport: u16, dport: u16, data: &[u8], with_csum: bool, corrupt: u8) -> SkBuff {
+    let len = 8 + data.len();
+    let mut dgram = alloc::vec![0u8; len];
+    dgram[0..2].copy_from_slice(&sport.to_be_bytes());
+    dgram[2..4].copy_from_slice(&dport.to_be_bytes());
+    dgram[4..6].copy_from_slice(&(len as u16).to_be_bytes());
+    dgram[8..].copy_from_slice(data);
+    if with_csum {
+        let sum = checksum::csum_tcpudp_nofold(PEER_IP, LOCAL_IP, len as u32, 17);
+        let check = checksum::csum_fold(checksum::csum_partial(&dgram, sum));
+        dgram[6..8].copy_from_slice(&check.to_be_bytes());
+    }
+    dgram[8] ^= corrupt;
+    let mut skb = alloc_skb(dgram.len() as u32).expect("skb alloc");
+    skb.skb_put_data(&dgram).expect("skb put");
+    skb
+}
+
+/// 构造数据报并经 udp_rcv 交给本地 socket
+fn rcv_datagram(sport: u16, dport: u16, data: &[u8], with_csum: bool, corrupt: u8) {
+    let skb = datagram_skb(sport, dport, data, with_csum, corrupt);
+    let _ = udp_rcv(&skb, PEER_IP, LOCAL_IP, 0, skb.len);
+    skb.free();
+}
+
+/// 构造本机发往对端、以以太网头部开始的 UDP 超长包
+fn gso_skb(payload: &[u8], gso_size: u16) -> SkBuff {
+    let mut frame = alloc::vec![0u8; ETH_HLEN + 28 + payload.len()];
+    frame[12..14].copy_from_slice(&0x0800u16.to_be_bytes());
+    {
+        let ip = &mut frame[ETH_HLEN..ETH_HLEN + 20];
+        ip[0] = 0x45;
+        ip[2..4].copy_from_slice(&((28 + payload.len()) as u16).to_be_bytes());
+        ip[4..6].copy_from_slice(&0x1000u16.to_be_bytes());
+        ip[8] = 64;
+        ip[9] = 17;
+        ip[12..16].copy_from_slice(&LOCAL_IP.to_be_bytes());
+        ip[16..20].copy_from_slice(&PEER_IP.to_be_bytes());
+    }
+    {
+        let udp = &mut frame[ETH_HLEN + 20..];
+        udp[0..2].copy_from_slice(&5353u16.to_be_bytes());
+        udp[2..4].copy_from_slice(&53u16.to_be_bytes());
+        udp[4..6].copy_from_slice(&((8 + payload.len()) as u16).to_be_bytes());
+        udp[8..].copy_from_slice(payload);
+    }
+    let mut skb = alloc_skb(frame.len() as u32).expect("skb alloc");
+    skb.skb_put_data(&frame).expect("skb put");
+    skb.gso_size = gso_size;
+    skb.gso_type = SKB_GSO_UDP_L4;
+    skb
+}
+
+fn frame_bytes(skb: &SkBuff) -> Vec<u8> {
+    let mut bytes = alloc::vec![0u8; skb.len as usize];
+    skb.skb_copy_bits(0, &mut bytes, skb.len);
+    bytes
+}
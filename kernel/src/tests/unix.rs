@@ -0,0 +1,175 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：Unix 域套接字
+//
+// 测试内容：
+// 1. socketpair 字节流收发与 poll 就绪状态
+// 2. SCM_RIGHTS 传递文件：在途期间发送方关闭不影响文件，读取不越过附着文件的位置
+// 3. 抽象命名空间的数据报：自动绑定、源地址与接收队列上限
+// 4. 路径名上的 listen / connect / accept，对端关闭后 EOF 与 EPIPE
+// 5. SOCK_SEQPACKET 保留消息边界，缓冲区不足时截断
+
+use alloc::sync::Arc;
+use alloc::vec::Vec;
+use crate::println;
+use crate::fs::file::{fput, poll_mask::*};
+use crate::net::unix::{
+    unix_accept, unix_bind, unix_connect, unix_create, unix_getname, unix_listen, unix_mkname,
+    unix_recvmsg, unix_sendmsg, unix_sock_arc, unix_sock_file, unix_socketpair, UnixState,
+    SOCK_DGRAM, SOCK_SEQPACKET, SOCK_STREAM, UNIX_MAX_DGRAM_QLEN,
+};
+
+/// 测试用的路径名
+const TEST_PATH: &[u8] = b"/tmp/rux-unix-test.sock";
+/// 测试用的抽象名
+const TEST_ABSTRACT: &[u8] = b"\0rux-unix-test";
+
+pub fn test_unix() {
+    println!("test: ===== Testing Unix Domain Sockets =====");
+
+    // 测试 1: 字节流
+    println!("test: 1. Testing stream socketpair...");
+    let (a, b) = socketpair_files(SOCK_STREAM);
+    let sa = unix_sock_arc(&a).expect("unix sock");
+    let sb = unix_sock_arc(&b).expect("unix sock");
+    assert_eq!(b.poll() & POLLIN, 0);
+    assert_ne!(a.poll() & POLLOUT, 0);
+    assert_eq!(unix_sendmsg(&sa, &[b"hello, ", b"world"], None, Vec::new(), true), 12);
+    assert_ne!(b.poll() & POLLIN, 0);
+    let mut buf = [0u8; 32];
+    let (head, tail) = buf.split_at_mut(5);
+    let recv = unix_recvmsg(&sb, &mut [head, tail], true).expect("recv");
+    assert_eq!(recv.len, 12);
+    assert_eq!(&buf[..12], b"hello, world");
+    assert_eq!(b.poll() & POLLIN, 0);
+    assert_eq!(unix_recvmsg(&sb, &mut [&mut buf[..]], true).err(), Some(-11));
+    println!("test:    SUCCESS - 12 bytes across two iovecs");
+
+    // 测试 2: SCM_RIGHTS
+    println!("test: 2. Testing SCM_RIGHTS file passing...");
+    let (c, d) = socketpair_files(SOCK_STREAM);
+    assert_eq!(unix_sendmsg(&sa, &[b"ab"], None, Vec::new(), true), 2);
+    assert_eq!(unix_sendmsg(&sa, &[b"cd"], None, alloc::vec![c.clone()], true), 2);
+    // 发送方关闭自己的描述符，在途的消息仍持有文件
+    fput(c);
+    assert_eq!(d.poll() & POLLHUP, 0);
+    let recv = unix_recvmsg(&sb, &mut [&mut buf[..]], true).expect("recv");
+    assert_eq!((recv.len, recv.fds.len()), (2, 0));
+    let mut recv = unix_recvmsg(&sb, &mut [&mut buf[..]], true).expect("recv");
+    assert_eq!(recv.len, 2);
+    assert_eq!(&buf[..2], b"cd");
+    assert_eq!(recv.fds.len(), 1);
+    let passed = recv.fds.pop().expect("passed file");
+    assert!(unix_sock_arc(&passed).is_some());
+    // 最后一个引用释放时才关闭，对端随之挂断
+    fput(passed);
+    assert_ne!(d.poll() & POLLHUP, 0);
+    fput(d);
+    println!("test:    SUCCESS - passed file survives sender close");
+
+    // 测试 3: 抽象命名空间的数据报
+    println!("test: 3. Testing abstract datagram sockets...");
+    let server = unix_create(SOCK_DGRAM).expect("create");
+    let client = unix_create(SOCK_DGRAM).expect("create");
+    let server_file = unix_sock_file(server.clone(), true);
+    let client_file = unix_sock_file(client.clone(), true);
+    let name = unix_mkname(&sockaddr_un(TEST_ABSTRACT)).expect("mkname");
+    assert_eq!(name, TEST_ABSTRACT);
+    assert_eq!(unix_bind(&server, &name), 0);
+    assert_eq!(unix_bind(&server, &name), -22);
+    assert_eq!(unix_bind(&client, &[]), 0);
+    let client_name = unix_getname(&client).expect("autobind name");
+    assert_eq!((client_name.len(), client_name[0]), (6, 0));
+    assert_ne!(client_file.poll() & POLLOUT, 0);
+    for i in 0..UNIX_MAX_DGRAM_QLEN {
+        assert_eq!(unix_sendmsg(&client, &[&[i as u8; 100]], Some(&name), Vec::new(), true), 100);
+    }
+    assert_eq!(unix_sendmsg(&client, &[b"x"], Some(&name), Vec::new(), true), -11);
+    assert_ne!(server_file.poll() & POLLIN, 0);
+    let recv = unix_recvmsg(&server, &mut [&mut buf[..]], true).expect("recv");
+    assert_eq!((recv.len, recv.msg_len), (32, 100));
+    assert_eq!(recv.addr.as_deref(), Some(&client_name[..]));
+    assert_eq!(unix_sendmsg(&client, &[b"x"], Some(b"\0no-such-name"), Vec::new(), true), -111);
+    fput(server_file);
+    // 名字随套接字释放，可以重新绑定
+    let again = unix_create(SOCK_DGRAM).expect("create");
+    assert_eq!(unix_bind(&again, &name), 0);
+    fput(unix_sock_file(again, true));
+    fput(client_file);
+    println!("test:    SUCCESS - queue limited to {} datagrams", UNIX_MAX_DGRAM_QLEN);
+
+    // 测试 4: listen / connect / accept
+    println!("test: 4. Testing listen, connect and accept...");
+    let listener = unix_create(SOCK_STREAM).expect("create");
+    let listener_file = unix_sock_file(listener.clone(), true);
+    assert_eq!(unix_listen(&listener, 4), -22);
+    assert_eq!(unix_bind(&listener, TEST_PATH), 0);
+    assert_eq!(unix_listen(&listener, 4), 0);
+    let other = unix_create(SOCK_STREAM).expect("create");
+    assert_eq!(unix_bind(&other, TEST_PATH), -98);
+    assert_eq!(unix_accept(&listener, true).err(), Some(-11));
+    assert_eq!(listener_file.poll() & POLLIN, 0);
+    let conn = unix_create(SOCK_STREAM).expect("create");
+    let conn_file = unix_sock_file(conn.clone(), true);
+    assert_eq!(unix_connect(&conn, TEST_PATH, true), 0);
+    assert_eq!(conn.state(), UnixState::Connected);
+    assert_ne!(listener_file.poll() & POLLIN, 0);
+    let accepted = unix_accept(&listener, true).expect("accept");
+    let accepted_file = unix_sock_file(accepted.clone(), true);
+    assert_eq!(unix_getname(&accepted).as_deref(), Some(TEST_PATH));
+    assert_eq!(unix_sendmsg(&conn, &[b"ping"], None, Vec::new(), true), 4);
+    let recv = unix_recvmsg(&accepted, &mut [&mut buf[..]], true).expect("recv");
+    assert_eq!(&buf[..recv.len], b"ping");
+    assert_eq!(unix_sendmsg(&accepted, &[b"pong"], None, Vec::new(), true), 4);
+    fput(accepted_file);
+    // 对端关闭：剩余数据读完后 EOF，再发送得到 EPIPE
+    let recv = unix_recvmsg(&conn, &mut [&mut buf[..]], true).expect("recv");
+    assert_eq!(&buf[..recv.len], b"pong");
+    assert_eq!(unix_recvmsg(&conn, &mut [&mut buf[..]], true).map(|r| r.len), Ok(0));
+    assert_eq!(unix_sendmsg(&conn, &[b"late"], None, Vec::new(), true), -32);
+    assert_ne!(conn_file.poll() & POLLHUP, 0);
+    fput(conn_file);
+    fput(listener_file);
+    assert_eq!(unix_connect(&other, TEST_PATH, true), -2);
+    fput(unix_sock_file(other, true));
+    println!("test:    SUCCESS - connection accepted on {} byte path", TEST_PATH.len());
+
+    // 测试 5: SOCK_SEQPACKET
+    println!("test: 5. Testing seqpacket message boundaries...");
+    let (p, q) = socketpair_files(SOCK_SEQPACKET);
+    let sp = unix_sock_arc(&p).expect("unix sock");
+    let sq = unix_sock_arc(&q).expect("unix sock");
+    assert_eq!(unix_sendmsg(&sp, &[b"0123456789"], None, Vec::new(), true), 10);
+    assert_eq!(unix_sendmsg(&sp, &[b"ab"], None, Vec::new(), true), 2);
+    let recv = unix_recvmsg(&sq, &mut [&mut buf[..4]], true).expect("recv");
+    assert_eq!((recv.len, recv.msg_len), (4, 10));
+    let recv = unix_recvmsg(&sq, &mut [&mut buf[..]], true).expect("recv");
+    assert_eq!(&buf[..recv.len], b"ab");
+    assert_eq!(unix_recvmsg(&sq, &mut [&mut buf[..]], true).err(), Some(-11));
+    fput(p);
+    assert_eq!(unix_recvmsg(&sq, &mut [&mut buf[..]], true).map(|r| r.len), Ok(0));
+    fput(q);
+    drop((sa, sb));
+    fput(a);
+    fput(b);
+    println!("test:    SUCCESS - truncated record reports full length");
+
+    println!("test: Unix domain socket testing completed.");
+}
+
+/// 创建一对已连接的非阻塞套接字文件
+fn socketpair_files(ty: i32) -> (Arc<crate::fs::File>, Arc<crate::fs::File>) {
+    let (a, b) = unix_socketpair(ty).expect("socketpair");
+    (unix_sock_file(a, true), unix_sock_file(b, true))
+}
+
+/// 构造 sockaddr_un
+fn sockaddr_un(path: &[u8]) -> Vec<u8> {
+    let mut sun = Vec::new();
+    sun.extend_from_slice(&1u16.to_le_bytes());
+    sun.extend_from_slice(path);
+    sun
+}
@@ -0,0 +1,106 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 用户物理页回收单元测试
+//!
+//! alloc_and_map_user_memory 逐页从页分配器取得带引用计数的页，
+//! 跨页写入经用户页表完成；munmap 与最后一个使用者退出时归还页
+
+use alloc::vec::Vec;
+
+use crate::println;
+use crate::arch::riscv64::mm::{
+    alloc_and_map_user_memory, copy_to_user_space, create_user_address_space, AddressSpace, PageTableEntry,
+};
+use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+use crate::mm::page_desc::pfn_to_page;
+use crate::mm::vma::{Vma, VmaFlags};
+
+const BASE: usize = 0x3000_0000;
+const NR_PAGES: usize = 4;
+
+/// 物理地址所在页的引用计数
+fn refcount(phys: usize) -> i32 {
+    let page = pfn_to_page(phys / PAGE_SIZE);
+    assert!(!page.is_null());
+    unsafe { (*page).refcount() }
+}
+
+/// 分配并映射 [start, start + NR_PAGES 页)，登记为匿名 VMA
+fn map_region(aspace: &AddressSpace, start: usize) -> Vec<usize> {
+    let flags = PageTableEntry::V | PageTableEntry::U | PageTableEntry::R | PageTableEntry::W
+        | PageTableEntry::A | PageTableEntry::D;
+    unsafe { alloc_and_map_user_memory(aspace.root_ppn(), start as u64, (NR_PAGES * PAGE_SIZE) as u64, flags) }
+        .expect("alloc_and_map_user_memory failed");
+    let mut vma_flags = VmaFlags::new();
+    vma_flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let end = start + NR_PAGES * PAGE_SIZE;
+    aspace.map_vma(Vma::new(PageVirtAddr::new(start), PageVirtAddr::new(end), vma_flags)).expect("map_vma failed");
+    (0..NR_PAGES)
+        .map(|i| aspace.translate(PageVirtAddr::new(start + i * PAGE_SIZE)).expect("page not mapped").as_usize())
+        .collect()
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_user_page_recycle() {
+    println!("test: ===== Starting User Page Recycle Tests =====");
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new(root_ppn) };
+
+    // 1. 逐页分配：每页引用计数为 1 且已清零
+    println!("test: 1. Testing per-page allocation with refcounts...");
+    let pages = map_region(&aspace, BASE);
+    for &phys in &pages {
+        assert_eq!(refcount(phys), 1);
+        let data = unsafe { core::slice::from_raw_parts(phys as *const u8, PAGE_SIZE) };
+        assert!(data.iter().all(|&b| b == 0));
+    }
+    println!("test:    SUCCESS - {} zeroed pages with refcount 1", pages.len());
+
+    // 2. 跨页写入经用户页表落到各自的物理页
+    println!("test: 2. Testing writes across page boundaries...");
+    let data: Vec<u8> = (0..PAGE_SIZE + 200).map(|i| i as u8).collect();
+    let addr = BASE + PAGE_SIZE - 100;
+    assert!(unsafe { copy_to_user_space(root_ppn, addr as u64, &data) });
+    for (i, &byte) in data.iter().enumerate() {
+        let virt = addr + i;
+        let phys = pages[(virt - BASE) / PAGE_SIZE] + virt % PAGE_SIZE;
+        assert_eq!(unsafe { *(phys as *const u8) }, byte, "offset {}", i);
+    }
+    let unmapped = BASE + NR_PAGES * PAGE_SIZE - 8;
+    assert!(!unsafe { copy_to_user_space(root_ppn, unmapped as u64, &[0u8; 16]) });
+    println!("test:    SUCCESS - copy follows the page table");
+
+    // 3. munmap 归还页
+    println!("test: 3. Testing munmap frees pages...");
+    aspace.munmap(PageVirtAddr::new(BASE), NR_PAGES * PAGE_SIZE).expect("munmap failed");
+    for &phys in &pages {
+        assert_eq!(refcount(phys), 0);
+    }
+    assert!(!aspace.is_mapped(PageVirtAddr::new(BASE)));
+    println!("test:    SUCCESS - unmapped pages returned to the allocator");
+
+    // 4. 最后一个使用者退出时归还全部映射
+    println!("test: 4. Testing mmput releases the address space...");
+    let pages = map_region(&aspace, BASE);
+    aspace.mm_users_inc();
+    aspace.mmput();
+    assert!(pages.iter().all(|&phys| refcount(phys) == 1), "shared mm released early");
+    aspace.mmput();
+    for &phys in &pages {
+        assert_eq!(refcount(phys), 0);
+    }
+    assert!(aspace.find_vma(PageVirtAddr::new(BASE)).is_none());
+    println!("test:    SUCCESS - last user frees mapped pages");
+
+    println!("test: ===== User Page Recycle Tests Completed =====");
+}
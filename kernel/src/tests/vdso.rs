@@ -0,0 +1,175 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：vDSO
+//
+// 测试内容：
+// 1. 按 musl __vdsosym 的方式解析映像，带版本查找导出符号
+// 2. 直接调用 vDSO 代码：clock_gettime / gettimeofday 与内核时间一致
+// 3. vvar 页的 seqlock 更新与 COARSE 时钟
+
+use crate::println;
+use crate::arch::riscv64::vdso::{
+    coarse_time, image_page, update_vsyscall, vdso_image, VDSO_CODE_OFFSET, VDSO_SYMBOLS, VDSO_VERSION,
+};
+use crate::drivers::timer::read_time;
+use crate::time::{cycles_to_ns, ktime_get, NSEC_PER_SEC};
+
+#[repr(C)]
+#[derive(Default)]
+struct Timespec {
+    tv_sec: i64,
+    tv_nsec: i64,
+}
+
+type ClockGettime = extern "C" fn(i32, *mut Timespec) -> i32;
+type Gettimeofday = extern "C" fn(*mut Timespec, *mut u64) -> i32;
+
+pub fn test_vdso() {
+    println!("test: ===== Testing vDSO =====");
+
+    // 测试 1: ELF 解析
+    println!("test: 1. Testing vDSO symbol lookup...");
+    let image = vdso_image();
+    assert_eq!(&image[..4], b"\x7fELF");
+    let cgt = vdsosym(image, VDSO_VERSION, VDSO_SYMBOLS[0]).expect("__vdso_clock_gettime");
+    let gtod = vdsosym(image, VDSO_VERSION, VDSO_SYMBOLS[1]).expect("__vdso_gettimeofday");
+    assert!(cgt >= VDSO_CODE_OFFSET && gtod >= VDSO_CODE_OFFSET && cgt != gtod);
+    // 版本不符或不存在的符号找不到
+    assert_eq!(vdsosym(image, "LINUX_2.6", VDSO_SYMBOLS[0]), None);
+    assert_eq!(vdsosym(image, VDSO_VERSION, "__vdso_getcpu"), None);
+    println!("test:    SUCCESS - symbols at {:#x} and {:#x}", cgt, gtod);
+
+    // 测试 2: 执行 vDSO 代码（内核恒等映射可执行，数据页同样在映像前一页）
+    println!("test: 2. Testing vDSO clock_gettime...");
+    let clock_gettime: ClockGettime = unsafe { core::mem::transmute(image_page() + cgt) };
+    let gettimeofday: Gettimeofday = unsafe { core::mem::transmute(image_page() + gtod) };
+    for clk in [0, 1, 4, 7] {
+        let before = ktime_get();
+        let mut ts = Timespec::default();
+        assert_eq!(clock_gettime(clk, &mut ts), 0);
+        let after = ktime_get();
+        let ns = ts.tv_sec as u64 * NSEC_PER_SEC + ts.tv_nsec as u64;
+        assert!((ts.tv_nsec as u64) < NSEC_PER_SEC);
+        assert!(before <= ns && ns <= after);
+    }
+    let mut tv = Timespec::default();
+    let mut tz = u64::MAX;
+    let before = ktime_get() / 1000;
+    assert_eq!(gettimeofday(&mut tv, &mut tz), 0);
+    let us = tv.tv_sec as u64 * 1_000_000 + tv.tv_nsec as u64;
+    assert!(before <= us && us <= ktime_get() / 1000);
+    assert_eq!(tz, 0);
+    println!("test:    SUCCESS - vDSO time matches ktime_get");
+
+    // 测试 3: COARSE 时钟读上一个 tick 写入的数据
+    println!("test: 3. Testing vvar update and coarse clocks...");
+    let now = read_time();
+    update_vsyscall(now);
+    let (sec, nsec) = coarse_time();
+    assert_eq!(sec * NSEC_PER_SEC + nsec, cycles_to_ns(now));
+    let mut ts = Timespec::default();
+    assert_eq!(clock_gettime(6, &mut ts), 0);
+    assert_eq!((ts.tv_sec as u64, ts.tv_nsec as u64), (sec, nsec));
+    // 精确时钟不早于 COARSE 时钟
+    let mut fine = Timespec::default();
+    clock_gettime(1, &mut fine);
+    assert!((fine.tv_sec, fine.tv_nsec) >= (ts.tv_sec, ts.tv_nsec));
+    println!("test:    SUCCESS - coarse clock = last update");
+
+    println!("test: vDSO testing completed.");
+}
+
+fn rd16(b: &[u8], off: usize) -> u16 {
+    u16::from_le_bytes([b[off], b[off + 1]])
+}
+
+fn rd32(b: &[u8], off: usize) -> u32 {
+    u32::from_le_bytes(b[off..off + 4].try_into().unwrap())
+}
+
+fn rd64(b: &[u8], off: usize) -> u64 {
+    u64::from_le_bytes(b[off..off + 8].try_into().unwrap())
+}
+
+fn cstr(b: &[u8], off: usize) -> &[u8] {
+    let len = b[off..].iter().position(|&c| c == 0).unwrap_or(0);
+    &b[off..off + len]
+}
+
+/// 与 musl src/internal/vdso.c 的 __vdsosym 相同的查找过程
+///
+/// # 返回
+/// 符号相对映像起点的偏移
+fn vdsosym(image: &[u8], vername: &str, name: &str) -> Option<usize> {
+    let phoff = rd64(image, 32) as usize;
+    let phentsize = rd16(image, 54) as usize;
+    let phnum = rd16(image, 56) as usize;
+    let mut base = None;
+    let mut dynv = None;
+    for i in 0..phnum {
+        let ph = phoff + i * phentsize;
+        match rd32(image, ph) {
+            1 => base = Some(rd64(image, ph + 8) as usize - rd64(image, ph + 16) as usize),
+            2 => dynv = Some(rd64(image, ph + 8) as usize),
+            _ => {}
+        }
+    }
+    let (base, mut dynv) = (base?, dynv?);
+
+    let (mut strings, mut syms, mut hashtab, mut versym, mut verdef) = (None, None, None, None, None);
+    loop {
+        let tag = rd64(image, dynv);
+        let val = base + rd64(image, dynv + 8) as usize;
+        match tag {
+            0 => break,
+            5 => strings = Some(val),
+            6 => syms = Some(val),
+            4 => hashtab = Some(val),
+            0x6fff_fff0 => versym = Some(val),
+            0x6fff_fffc => verdef = Some(val),
+            _ => {}
+        }
+        dynv += 16;
+    }
+    let (strings, syms, hashtab) = (strings?, syms?, hashtab?);
+    if verdef.is_none() {
+        versym = None;
+    }
+
+    for i in 0..rd32(image, hashtab + 4) as usize {
+        let sym = syms + i * 24;
+        let info = image[sym + 4];
+        if (1 << (info & 0xf)) & 0b10_0111 == 0 || (1 << (info >> 4)) & 0b100_0000_0110 == 0 {
+            continue;
+        }
+        if rd16(image, sym + 6) == 0 || cstr(image, strings + rd32(image, sym) as usize) != name.as_bytes() {
+            continue;
+        }
+        if let (Some(versym), Some(verdef)) = (versym, verdef) {
+            if !checkver(image, verdef, rd16(image, versym + 2 * i), vername, strings) {
+                continue;
+            }
+        }
+        return Some(base + rd64(image, sym + 8) as usize);
+    }
+    None
+}
+
+fn checkver(image: &[u8], mut def: usize, vsym: u16, vername: &str, strings: usize) -> bool {
+    let vsym = vsym & 0x7fff;
+    loop {
+        if rd16(image, def + 2) & 1 == 0 && rd16(image, def + 4) & 0x7fff == vsym {
+            break;
+        }
+        let next = rd32(image, def + 16) as usize;
+        if next == 0 {
+            return false;
+        }
+        def += next;
+    }
+    let aux = def + rd32(image, def + 12) as usize;
+    cstr(image, strings + rd32(image, aux) as usize) == vername.as_bytes()
+}
@@ -12,7 +12,8 @@
 
 use crate::println;
 use crate::drivers::net::{loopback, virtio_net};
-use crate::net::buffer::SkBuff;
+use crate::net::buffer::{SkBuff, CHECKSUM_NONE, SKB_GSO_TCPV4};
+use crate::net::ipv4::checksum;
 
 pub fn test_virtio_net() {
     println!("test: ===== Starting VirtIO-Net Device Tests =====");
@@ -33,6 +34,18 @@ pub fn test_virtio_net() {
     println!("test: 4. Testing SkBuff allocation and free...");
     test_skb_alloc();
 
+    // 测试 5: NAPI 调度状态
+    println!("test: 5. Testing NAPI schedule/complete state...");
+    test_napi_state();
+
+    // 测试 6: 软件 GSO 与校验和补齐
+    println!("test: 6. Testing software GSO and checksum fallback...");
+    test_software_gso();
+
+    // 测试 7: 多队列的队列编号与按 CPU 选择队列对
+    println!("test: 7. Testing multiqueue pair selection...");
+    test_queue_pair_selection();
+
     println!("test: VirtIO-Net Device testing completed.");
 }
 
@@ -151,3 +164,146 @@ fn test_skb_alloc() {
 
     println!("test:    SUCCESS - SkBuff allocation and free work");
 }
+
+/// 测试 NAPI 调度状态：轮询中到来的中断让轮询者多跑一轮
+fn test_napi_state() {
+    let napi = virtio_net::NapiState::new();
+
+    // 第一个执行者成为轮询者，其他执行者只留下标记
+    assert!(napi.schedule_prep());
+    assert!(!napi.schedule_prep());
+
+    // 有标记时不能释放轮询权，清掉标记后才能
+    assert!(!napi.complete());
+    assert!(napi.complete());
+
+    // 释放后可以重新占有
+    assert!(napi.schedule_prep());
+    assert!(napi.complete());
+
+    // 忙轮询占有时不留标记；已有轮询者时忙轮询不抢占、也不让它多跑一轮
+    assert!(napi.busy_poll_prep());
+    assert!(!napi.busy_poll_prep());
+    assert!(!napi.schedule_prep());
+    assert!(!napi.complete());
+    assert!(napi.complete());
+    assert!(napi.schedule_prep());
+    assert!(!napi.busy_poll_prep());
+    assert!(napi.complete());
+
+    println!("test:    SUCCESS - missed interrupts keep the poller running");
+}
+
+/// 测试软件 GSO：不支持卸载的设备收到按 MSS 切好、校验和已补齐的帧
+fn test_software_gso() {
+    const HDR: usize = 14 + 20 + 20;
+    const PAYLOAD: usize = 3000;
+    const MSS: u16 = 1460;
+    let saddr: u32 = 0xC0A80164;
+    let daddr: u32 = 0xC0A80101;
+
+    let mut skb = match SkBuff::alloc((HDR + PAYLOAD) as u32) {
+        Some(skb) => skb,
+        None => {
+            println!("test:    FAILED - Could not allocate SkBuff");
+            return;
+        }
+    };
+    let base = skb.skb_put((HDR + PAYLOAD) as u32).unwrap();
+    let frame = unsafe { core::slice::from_raw_parts_mut(base, HDR + PAYLOAD) };
+    frame.fill(0);
+    frame[12..14].copy_from_slice(&0x0800u16.to_be_bytes());
+    let ip = &mut frame[14..34];
+    ip[0] = 0x45;
+    ip[2..4].copy_from_slice(&((20 + 20 + PAYLOAD) as u16).to_be_bytes());
+    ip[8] = 64;
+    ip[9] = 6;
+    ip[12..16].copy_from_slice(&saddr.to_be_bytes());
+    ip[16..20].copy_from_slice(&daddr.to_be_bytes());
+    let tcp = &mut frame[34..54];
+    tcp[4..8].copy_from_slice(&1000u32.to_be_bytes());
+    tcp[12] = 5 << 4;
+    tcp[13] = 0x18; // PSH + ACK
+    for (i, b) in frame[HDR..].iter_mut().enumerate() {
+        *b = i as u8;
+    }
+    skb.set_csum_partial(unsafe { base.add(34) }, crate::net::gso::TCP_CSUM_OFFSET);
+    skb.gso_size = MSS;
+    skb.gso_type = SKB_GSO_TCPV4;
+
+    let segs = match crate::net::gso::validate_xmit_skb(skb, 0) {
+        Ok(segs) => segs,
+        Err(()) => {
+            println!("test:    FAILED - Software GSO returned error");
+            return;
+        }
+    };
+    assert_eq!(segs.len(), 3);
+
+    let mut offset = 0usize;
+    for (i, seg) in segs.iter().enumerate() {
+        let frame = unsafe { core::slice::from_raw_parts(seg.data, seg.len as usize) };
+        let seg_len = seg.len as usize - HDR;
+        assert_eq!(seg_len, core::cmp::min(MSS as usize, PAYLOAD - offset));
+        assert_eq!(seg.ip_summed, CHECKSUM_NONE);
+
+        // IP 头部校验和与总长度
+        assert_eq!(checksum::ip_checksum(&frame[14..34]), 0);
+        assert_eq!(u16::from_be_bytes([frame[16], frame[17]]) as usize, 40 + seg_len);
+
+        // 序列号递增；PSH 只在最后一段
+        let seq = u32::from_be_bytes([frame[38], frame[39], frame[40], frame[41]]);
+        assert_eq!(seq, 1000 + offset as u32);
+        assert_eq!(frame[47] & 0x08 != 0, i == 2);
+
+        // 伪头部加 TCP 段的校验和为 0
+        let pseudo = checksum::csum_tcpudp_nofold(saddr, daddr, (20 + seg_len) as u32, 6);
+        assert_eq!(checksum::csum_fold(checksum::csum_partial(&frame[34..], pseudo)), 0);
+        assert_eq!(frame[HDR], offset as u8);
+        offset += seg_len;
+    }
+    for seg in segs {
+        seg.free();
+    }
+
+    println!("test:    SUCCESS - super-segment split into MSS frames with valid checksums");
+}
+
+/// 测试多队列：收发队列与控制队列编号不重叠，发送与轮询按 CPU 选择队列对
+fn test_queue_pair_selection() {
+    use crate::config::MAX_CPUS;
+    use virtio_net::{ctrlq2vq, rxq2vq, select_queue_pair, txq2vq};
+
+    // receiveqN = 2N、transmitqN = 2N + 1，控制队列紧随最后一对
+    let mut used = [false; 2 * MAX_CPUS + 1];
+    for n in 0..MAX_CPUS {
+        for vq in [rxq2vq(n), txq2vq(n)] {
+            assert!(!used[vq as usize]);
+            used[vq as usize] = true;
+        }
+    }
+    assert_eq!(ctrlq2vq(MAX_CPUS) as usize, 2 * MAX_CPUS);
+    assert!(!used[ctrlq2vq(MAX_CPUS) as usize]);
+    assert_eq!((rxq2vq(0), txq2vq(0), ctrlq2vq(1)), (0, 1, 2));
+
+    // 每个 CPU 一对时各 CPU 的发送队列互不相同
+    let mut owner = [usize::MAX; MAX_CPUS];
+    for cpu in 0..MAX_CPUS {
+        let qp = select_queue_pair(cpu, MAX_CPUS);
+        assert_eq!(owner[qp], usize::MAX);
+        owner[qp] = cpu;
+    }
+    // 队列对少于 CPU 时轮流共用，且不越界
+    for cpu in 0..MAX_CPUS {
+        assert_eq!(select_queue_pair(cpu, 2), cpu % 2);
+        assert_eq!(select_queue_pair(cpu, 1), 0);
+        assert_eq!(select_queue_pair(cpu, 0), 0);
+    }
+
+    // 未初始化的设备只有一对，不允许忙轮询
+    let dev = virtio_net::VirtIONetDevice::new(0);
+    assert_eq!(dev.nr_queue_pairs(), 1);
+    assert!(dev.busy_poll_start().is_none());
+
+    println!("test:    SUCCESS - {} CPUs map to distinct queue pairs", MAX_CPUS);
+}
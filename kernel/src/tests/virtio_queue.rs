@@ -7,6 +7,8 @@
 //!
 //! 测试 VirtIO 驱动的队列管理功能
 
+use core::sync::atomic::{AtomicU32, Ordering};
+
 use crate::println;
 
 #[cfg(feature = "unit-test")]
@@ -33,9 +35,211 @@ pub fn test_virtio_queue() {
     println!("test: 5. Testing bit operations...");
     test_bit_operations();
 
+    // 测试 6: 事件索引抑制通知
+    println!("test: 6. Testing event index notification suppression...");
+    test_event_idx();
+
+    // 测试 7: 紧凑队列的提交与收割
+    println!("test: 7. Testing packed virtqueue...");
+    test_packed_ring();
+
+    // 测试 8: 分离队列的乱序完成、描述符回收与在途请求上限
+    println!("test: 8. Testing split ring completion and descriptor recycling...");
+    test_split_ring_completion();
+
+    // 测试 9: 预分配请求头池与请求标签的分配、耗尽与归还
+    println!("test: 9. Testing DMA pools and request tags...");
+    test_dma_pools();
+
     println!("test: ===== VirtIO Queue Tests Completed =====");
 }
 
+fn test_event_idx() {
+    use crate::drivers::virtio::queue::{need_event, VirtQueue};
+
+    assert!(need_event(0, 1, 0));
+    assert!(!need_event(5, 3, 1));
+    assert!(need_event(0xFFFF, 1, 0xFFFE));
+
+    let mut q = match VirtQueue::new(8, 0, 0, 0, 0) {
+        Some(q) => q,
+        None => {
+            println!("test:    FAILED - cannot allocate vring");
+            return;
+        }
+    };
+    q.enable_event_idx();
+    // 设备的 avail_event 为 0：第一条链需要通知，之后的不需要
+    assert!(q.add_buf(&[(0x1000, 512, false)], 1).is_some());
+    assert!(q.kick_prepare());
+    assert!(q.add_buf(&[(0x2000, 512, false)], 2).is_some());
+    assert!(!q.kick_prepare());
+    // 设备把 avail_event 推进到 2 后，第三条链越过它
+    let avail_event = (q.get_used_addr() as usize + 4 + 8 * 8) as *mut u16;
+    unsafe { core::ptr::write_volatile(avail_event, 2) };
+    assert!(q.add_buf(&[(0x3000, 512, false)], 3).is_some());
+    assert!(q.kick_prepare());
+    println!("test:    SUCCESS - doorbell only when the device's avail_event is crossed");
+}
+
+fn test_packed_ring() {
+    use crate::drivers::virtio::packed::{PackedDesc, VRING_PACKED_DESC_F_AVAIL, VRING_PACKED_DESC_F_USED};
+    use crate::drivers::virtio::queue::VirtQueue;
+
+    let mut q = match VirtQueue::new_packed(8, 0, 0, 0, 0) {
+        Some(q) => q,
+        None => {
+            println!("test:    FAILED - cannot allocate packed ring");
+            return;
+        }
+    };
+    assert!(q.is_packed());
+    let id = q.add_buf(&[(0x1000, 512, false), (0x2000, 1, true)], 42);
+    assert_eq!(id, Some(0));
+    assert_eq!(q.num_free(), 6);
+    let ring = q.get_desc_addr() as *mut PackedDesc;
+    unsafe {
+        assert!((*ring).flags & VRING_PACKED_DESC_F_AVAIL != 0);
+        assert!((*ring.add(1)).flags & VRING_PACKED_DESC_F_USED == 0);
+    }
+    assert!(q.get_buf().is_none());
+
+    // 模拟设备：在链首位置写回 id 和长度，并置 USED 位与 AVAIL 位一致
+    unsafe {
+        (*ring).id = 0;
+        (*ring).len = 1;
+        core::ptr::write_volatile(&mut (*ring).flags, VRING_PACKED_DESC_F_AVAIL | VRING_PACKED_DESC_F_USED);
+    }
+    assert_eq!(q.get_buf(), Some((42, 1)));
+    assert_eq!(q.num_free(), 8);
+    assert!(q.enable_cb());
+    println!("test:    SUCCESS - packed descriptors are posted and reclaimed by buffer id");
+}
+
+/// 模拟设备的通知、中断状态、中断应答寄存器
+static REGS: [AtomicU32; 3] = [const { AtomicU32::new(0) }; 3];
+const NOTIFY: usize = 0;
+const STATUS: usize = 1;
+const ACK: usize = 2;
+
+/// 模拟设备：把链头 head 的完成放入已用环
+fn device_complete(q: &crate::drivers::virtio::queue::VirtQueue, head: u16, len: u32) {
+    use crate::drivers::virtio::queue::UsedElem;
+
+    let used = q.get_used_addr() as usize;
+    let idx = q.get_used();
+    unsafe {
+        let ring = (used + 4) as *mut UsedElem;
+        core::ptr::write_volatile(ring.add(idx as usize % q.queue_size as usize), UsedElem { id: head as u32, len });
+        core::ptr::write_volatile((used + 2) as *mut u16, idx.wrapping_add(1));
+    }
+}
+
+fn test_split_ring_completion() {
+    use crate::drivers::virtio::queue::VirtQueue;
+
+    let notify = REGS[NOTIFY].as_ptr() as u64;
+    let mut q = match VirtQueue::new(64, 3, notify, REGS[STATUS].as_ptr() as u64, REGS[ACK].as_ptr() as u64) {
+        Some(q) => q,
+        None => {
+            println!("test:    FAILED - cannot allocate vring");
+            return;
+        }
+    };
+
+    // 每个块请求占 3 个描述符（请求头、数据、状态），64 个描述符最多 21 个请求在途
+    let mut heads = [0u16; 21];
+    for (i, head) in heads.iter_mut().enumerate() {
+        let bufs = [(0x1000, 16, false), (0x2000, 512, true), (0x3000, 1, true)];
+        *head = q.add_buf(&bufs, 100 + i).expect("add_buf failed");
+    }
+    assert_eq!(q.num_free(), 1);
+    assert!(q.add_buf(&[(0x1000, 16, false), (0x2000, 512, true), (0x3000, 1, true)], 999).is_none());
+    assert_eq!(q.get_avail(), 21);
+    assert!(q.kick());
+    assert_eq!(REGS[NOTIFY].load(Ordering::Relaxed), 3);
+
+    // 设备乱序完成：token 对应各自的请求，整条链回到空闲链表
+    assert!(q.get_buf().is_none());
+    device_complete(&q, heads[5], 513);
+    device_complete(&q, heads[2], 1);
+    assert!(q.more_used());
+    assert_eq!(q.get_buf(), Some((105, 513)));
+    assert_eq!(q.get_buf(), Some((102, 1)));
+    assert_eq!(q.get_buf(), None);
+    assert_eq!(q.num_free(), 7);
+
+    // 最后归还的链最先重用，链内描述符保持原样
+    let bufs = [(0x4000, 16, false), (0x5000, 512, false), (0x6000, 1, true)];
+    assert_eq!(q.add_buf(&bufs, 200), Some(heads[2]));
+    assert_eq!(q.next_head(), Some(heads[5]));
+    assert_eq!(q.add_buf(&bufs, 201), Some(heads[5]));
+    assert!(q.add_buf(&bufs, 202).is_none());
+
+    // 收割期间关闭中断；重新打开时还有完成则要求调用者继续收割
+    q.disable_cb();
+    device_complete(&q, heads[0], 1);
+    assert!(!q.enable_cb());
+    assert_eq!(q.get_buf(), Some((100, 1)));
+    assert!(q.enable_cb());
+
+    // 中断状态非零时写回应答寄存器
+    assert_eq!(q.ack_interrupt(), 0);
+    assert_eq!(REGS[ACK].load(Ordering::Relaxed), 0);
+    REGS[STATUS].store(1, Ordering::Relaxed);
+    assert_eq!(q.ack_interrupt(), 1);
+    assert_eq!(REGS[ACK].load(Ordering::Relaxed), 1);
+    println!("test:    SUCCESS - out-of-order completions matched tokens, in-flight bounded by descriptors");
+}
+
+fn test_dma_pools() {
+    use crate::drivers::virtio::queue::{DmaPool, VirtIOBlkReqHeader, VirtIOBlkResp};
+    use crate::drivers::virtio::VirtBlkTags;
+
+    // 一次分配的池按页对齐，第 i 个元素的物理地址按元素大小递增
+    let headers = match DmaPool::new(21, VirtIOBlkReqHeader { type_: 0, reserved: 0, sector: 0 }) {
+        Some(pool) => pool,
+        None => {
+            println!("test:    FAILED - cannot allocate DMA pool");
+            return;
+        }
+    };
+    assert_eq!(headers.phys(0) % 4096, 0);
+    for i in 0..21 {
+        assert_eq!(headers.phys(i), headers.phys(0) + (i * core::mem::size_of::<VirtIOBlkReqHeader>()) as u64);
+        assert_eq!(headers.read(i).sector, 0);
+    }
+    headers.write(7, VirtIOBlkReqHeader { type_: 1, reserved: 0, sector: 42 });
+    assert_eq!((headers.read(7).type_, headers.read(7).sector), (1, 42));
+    assert_eq!(headers.read(6).sector, 0);
+    let resps = DmaPool::new(21, VirtIOBlkResp { status: 0xFF }).expect("cannot allocate DMA pool");
+    assert_eq!(resps.phys(20) - resps.phys(0), 20);
+    assert_eq!(resps.read(20).status, 0xFF);
+
+    // 标签从小到大分配，用完后失败，归还的标签被再次分配
+    let tags = VirtBlkTags::new(4).expect("cannot allocate tags");
+    for tag in 0..4 {
+        assert_eq!(tags.try_get(), Some(tag));
+    }
+    assert_eq!(tags.try_get(), None);
+    tags.put(2);
+    assert_eq!(tags.try_get(), Some(2));
+    assert_eq!(tags.try_get(), None);
+    for tag in 0..4 {
+        tags.put(tag);
+    }
+    assert_eq!(tags.header_phys(3) - tags.header_phys(0), 3 * core::mem::size_of::<VirtIOBlkReqHeader>() as u64);
+    assert_eq!(tags.resp_phys(3) - tags.resp_phys(0), 3);
+
+    // 标签数不超过位图宽度
+    let tags = VirtBlkTags::new(100).expect("cannot allocate tags");
+    for tag in 0..64 {
+        assert_eq!(tags.try_get(), Some(tag));
+    }
+    assert_eq!(tags.try_get(), None);
+    println!("test:    SUCCESS - pool addresses precomputed, tags exhausted and reused");
+}
+
 fn test_virtio_structure_sizes() {
     // VirtIO 规范要求的结构体大小
 
@@ -0,0 +1,87 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! VMA 无锁查找单元测试
+//!
+//! RCU 快照与 VMA 管理器一致、写锁改变修改序号、缺页不经 VMA 锁查找
+
+use crate::println;
+use crate::arch::riscv64::mm::{
+    create_user_address_space, handle_mm_fault, map, nr_fault_retries, AddressSpace, FaultFlags,
+    MmFaultResult, VirtAddr,
+};
+use crate::mm::page::{VirtAddr as PageVirtAddr, PAGE_SIZE};
+use crate::mm::vma::{VmaFlags, VmaType};
+
+/// 快照与加锁查找的结果一致
+fn assert_same_vma(aspace: &AddressSpace, addr: usize) {
+    let rcu = aspace.find_vma_rcu(PageVirtAddr::new(addr)).map(|vma| (vma.start(), vma.end()));
+    let locked = aspace.find_vma(PageVirtAddr::new(addr)).map(|vma| (vma.start(), vma.end()));
+    assert_eq!(rcu, locked, "addr {:#x}", addr);
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_vma_lock() {
+    println!("test: ===== Starting VMA Lock Tests =====");
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new(root_ppn) };
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let anon = map::MAP_PRIVATE | map::MAP_ANONYMOUS;
+
+    // 1. 快照查找与 VMA 管理器一致
+    println!("test: 1. Testing RCU snapshot lookups...");
+    assert!(aspace.find_vma_rcu(PageVirtAddr::new(0x1000_0000)).is_none());
+    let a = aspace.mmap(PageVirtAddr::new(0), 8 * PAGE_SIZE, flags, VmaType::Anonymous, anon).expect("mmap failed");
+    let b = aspace.mmap(PageVirtAddr::new(0), 4 * PAGE_SIZE, flags, VmaType::Anonymous, anon).expect("mmap failed");
+    // munmap 中间一页把 a 拆成两个 VMA
+    aspace.munmap(PageVirtAddr::new(a.as_usize() + 3 * PAGE_SIZE), PAGE_SIZE).expect("munmap failed");
+    for base in [a.as_usize(), b.as_usize()] {
+        for page in 0..9 {
+            assert_same_vma(&aspace, base + page * PAGE_SIZE);
+            assert_same_vma(&aspace, base + page * PAGE_SIZE + PAGE_SIZE - 1);
+        }
+    }
+    assert!(aspace.find_vma_rcu(PageVirtAddr::new(a.as_usize() + 3 * PAGE_SIZE)).is_none());
+    println!("test:    SUCCESS - snapshot matches the VMA tree after mmap/munmap");
+
+    // 2. 写锁改变修改序号
+    println!("test: 2. Testing VMA sequence count...");
+    let seq = aspace.vma_seq_begin();
+    assert_eq!(seq % 2, 0);
+    assert!(!aspace.vma_seq_retry(seq));
+    {
+        let _vma_mgr = aspace.vma_write();
+        assert!(aspace.vma_seq_retry(seq), "writer in progress not detected");
+    }
+    let next = aspace.vma_seq_begin();
+    assert_eq!(next, seq + 2);
+    assert!(aspace.vma_seq_retry(seq));
+    println!("test:    SUCCESS - each write section advances the sequence by 2");
+
+    // 3. 缺页经快照找到 VMA，没有并发修改时不重试
+    println!("test: 3. Testing faults through the snapshot...");
+    let retries = nr_fault_retries();
+    for page in 0..4 {
+        let addr = b.as_usize() + page * PAGE_SIZE;
+        let result = handle_mm_fault(&aspace, VirtAddr::new(addr as u64), FaultFlags::WRITE | FaultFlags::USER);
+        assert_eq!(result, MmFaultResult::Handled);
+        assert!(aspace.is_mapped(PageVirtAddr::new(addr)));
+    }
+    let hole = a.as_usize() + 3 * PAGE_SIZE;
+    assert_eq!(handle_mm_fault(&aspace, VirtAddr::new(hole as u64), FaultFlags::READ | FaultFlags::USER),
+               MmFaultResult::Segfault);
+    assert_eq!(nr_fault_retries(), retries);
+    println!("test:    SUCCESS - faults resolved without the VMA lock");
+
+    println!("test: ===== VMA Lock Tests Completed =====");
+}
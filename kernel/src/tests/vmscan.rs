@@ -0,0 +1,92 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 页回收测试
+//!
+//! 测试页缓存页的 LRU 维护与回收：
+//! - 新缓存页进入 inactive 链表
+//! - 被访问过的页提升到 active，不被回收
+//! - 持有引用的页不被回收
+//! - 回收后的页再次访问时重新读入
+
+use crate::println;
+use crate::mm::filemap::{self, MappingSource};
+use crate::mm::page_desc::{pfn_to_page, PageFlag};
+use crate::mm::page::PAGE_SIZE;
+use crate::mm::vmscan;
+use alloc::sync::Arc;
+
+/// 第 i 页内容全部为 i 的测试文件
+struct PatternFile {
+    pages: usize,
+}
+
+impl MappingSource for PatternFile {
+    fn size(&self) -> usize {
+        self.pages * PAGE_SIZE
+    }
+
+    fn read_page(&self, index: usize, buf: &mut [u8]) -> usize {
+        buf.fill(index as u8);
+        buf.len()
+    }
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_vmscan() {
+    println!("test: ===== Starting Page Reclaim Tests =====");
+
+    const TEST_INO: u64 = u64::MAX - 18;
+    const FILE_PAGES: usize = 8;
+
+    let mapping = filemap::get_mapping(TEST_INO, Arc::new(PatternFile { pages: FILE_PAGES }));
+
+    // 测试 1: 新页进入 inactive 链表
+    println!("test: 1. Testing LRU insertion...");
+    let (_, inactive_before) = vmscan::lru_sizes();
+    let mut phys = [0usize; FILE_PAGES];
+    for i in 0..FILE_PAGES {
+        phys[i] = match mapping.find_or_read_page(i) {
+            Some(p) => p,
+            None => {
+                println!("test:    SKIP - out of memory");
+                return;
+            }
+        };
+        let page = pfn_to_page(phys[i] / PAGE_SIZE);
+        assert!(unsafe { (*page).test_flag(PageFlag::Lru) });
+        assert!(!unsafe { (*page).test_flag(PageFlag::Active) });
+    }
+    assert!(vmscan::lru_sizes().1 >= inactive_before + FILE_PAGES);
+    println!("test:    SUCCESS - new page cache pages are on the inactive list");
+
+    // 测试 2: 回收未访问的页，保留访问过的和仍被引用的页
+    println!("test: 2. Testing reclaim of unreferenced pages...");
+    assert_eq!(mapping.find_or_read_page(1), Some(phys[1]));
+    let held = mapping.grab_page(2).unwrap();
+    assert_eq!(held, phys[2]);
+
+    let (active, inactive) = vmscan::lru_sizes();
+    vmscan::shrink_page_cache(active + inactive);
+    for i in 0..FILE_PAGES {
+        let cached = mapping.find_page(i).is_some();
+        assert_eq!(cached, i == 1 || i == 2, "page {}", i);
+    }
+    let page1 = pfn_to_page(phys[1] / PAGE_SIZE);
+    assert!(unsafe { (*page1).test_flag(PageFlag::Active) }, "referenced page must be activated");
+    println!("test:    SUCCESS - referenced and in-use pages survive reclaim");
+
+    // 测试 3: 回收的页再次访问时重新读入
+    println!("test: 3. Testing refault after reclaim...");
+    let again = mapping.find_or_read_page(5).expect("refault failed");
+    assert_eq!(unsafe { *(again as *const u8) }, 5);
+    unsafe { (*pfn_to_page(held / PAGE_SIZE)).put_page() };
+    println!("test:    SUCCESS - reclaimed page is read back from its source");
+
+    let stats = vmscan::vmscan_stats();
+    println!("test:    pgscan={} pgsteal={} kswapd_runs={} allocstall={}",
+             stats.pgscan, stats.pgsteal, stats.kswapd_runs, stats.allocstall);
+
+    println!("test: ===== Page Reclaim Tests Completed =====");
+}
@@ -0,0 +1,94 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 内存事件计数测试
+//!
+//! 验证页分配与释放、slab 增长与收缩、缺页记账在各 CPU 计数上的增量，
+//! 以及 /proc/vmstat 与 /proc/<pid>/stat 的导出
+
+use alloc::boxed::Box;
+use alloc::string::String;
+use core::sync::atomic::Ordering;
+
+use crate::mm::kmem_cache;
+use crate::mm::pcp::{alloc_page_pcp, free_page_pcp, MigrateType};
+use crate::mm::vmstat::{all_vm_events, nr_pages_order, vm_event, VmEvent, NR_PAGE_ORDERS};
+use crate::println;
+use crate::process::task::{SchedPolicy, Task};
+
+#[cfg(feature = "unit-test")]
+pub fn test_vmstat() {
+    println!("test: ===== Starting VM Event Counter Tests =====");
+
+    // 1. 页数折算为阶
+    println!("test: 1. Testing page orders...");
+    assert_eq!(nr_pages_order(1), 0);
+    assert_eq!(nr_pages_order(2), 1);
+    assert_eq!(nr_pages_order(3), 2);
+    assert_eq!(nr_pages_order(512), 9);
+    let before = all_vm_events();
+    crate::mm::vmstat::count_pgalloc(20);
+    let after = all_vm_events();
+    assert_eq!(after.pgalloc[NR_PAGE_ORDERS - 1], before.pgalloc[NR_PAGE_ORDERS - 1] + 1);
+    assert_eq!(after.pages_allocated() - before.pages_allocated(), 1 << (NR_PAGE_ORDERS - 1));
+    println!("test:    SUCCESS - orders above the last are clamped");
+
+    // 2. 页分配与释放计入 0 阶
+    println!("test: 2. Testing pgalloc/pgfree...");
+    let before = all_vm_events();
+    let frame = alloc_page_pcp(MigrateType::Unmovable).expect("page allocation");
+    free_page_pcp(frame, MigrateType::Unmovable);
+    let after = all_vm_events();
+    assert!(after.pgalloc[0] > before.pgalloc[0]);
+    assert!(after.pgfree[0] > before.pgfree[0]);
+    println!("test:    SUCCESS - pgalloc_order0 +{} pgfree_order0 +{}",
+             after.pgalloc[0] - before.pgalloc[0], after.pgfree[0] - before.pgfree[0]);
+
+    // 3. slab 增长与收缩
+    println!("test: 3. Testing slab grow/shrink...");
+    let cachep = kmem_cache::kmem_cache_create("vmstat_test", 64, 8, 0, None).expect("kmem_cache_create");
+    let grow = vm_event(VmEvent::SlabGrow);
+    let obj = kmem_cache::kmem_cache_alloc(cachep);
+    assert!(!obj.is_null());
+    assert!(vm_event(VmEvent::SlabGrow) > grow);
+    let shrink = vm_event(VmEvent::SlabShrink);
+    unsafe { kmem_cache::kmem_cache_free(cachep, obj) };
+    kmem_cache::kmem_cache_shrink(cachep);
+    assert!(vm_event(VmEvent::SlabShrink) > shrink);
+    println!("test:    SUCCESS - new and released slabs counted");
+
+    // 4. 缺页记账区分 min_flt 与 maj_flt
+    println!("test: 4. Testing minor and major faults...");
+    let task = Box::new(Task::new(4343, SchedPolicy::Normal));
+    let faults = vm_event(VmEvent::PgFault);
+    let major = vm_event(VmEvent::PgMajFault);
+    task.account_fault();
+    task.acct.fault_major.store(true, Ordering::Relaxed);
+    task.account_fault();
+    task.account_fault();
+    assert_eq!(task.acct.min_flt.load(Ordering::Relaxed), 2);
+    assert_eq!(task.acct.maj_flt.load(Ordering::Relaxed), 1);
+    assert!(!task.acct.fault_major.load(Ordering::Relaxed));
+    assert!(vm_event(VmEvent::PgFault) >= faults + 3);
+    assert!(vm_event(VmEvent::PgMajFault) > major);
+    println!("test:    SUCCESS - min_flt 2 maj_flt 1");
+
+    // 5. /proc/vmstat 每行一个名称和数值
+    println!("test: 5. Testing /proc/vmstat...");
+    let data = crate::fs::procfs::read_file("/vmstat").unwrap_or_default();
+    let text = String::from_utf8(data).unwrap_or_default();
+    for line in text.lines() {
+        let (name, value) = line.split_once(' ').expect("name value");
+        assert!(!name.is_empty());
+        assert!(value.parse::<u64>().is_ok(), "{}", line);
+    }
+    for name in ["nr_free_pages", "pgalloc_order0", "pgfree_order10", "pgfault", "pgmajfault",
+                 "cow_fault", "zero_page_map", "pcp_refill", "slab_grow", "pgscan", "oom_kill"] {
+        assert!(text.lines().any(|line| line.split(' ').next() == Some(name)), "{} missing", name);
+    }
+    println!("test:    SUCCESS - {} lines", text.lines().count());
+
+    println!("test: ===== VM Event Counter Tests Completed =====");
+}
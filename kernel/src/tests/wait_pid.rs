@@ -0,0 +1,145 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：PID 分配、PID 散列查找与 waitid / pidfd
+//
+// 测试内容：
+// 1. PID 位图分配、释放与计数
+// 2. 按 PID 散列查找当前任务
+// 3. pidfd 文件与 PID 往返
+// 4. waitid 参数检查与没有子进程时的 ECHILD
+// 5. pidfd_open 与 waitid(P_PIDFD)
+// 6. wait4 的等待状态编码与 waitid 的 si_code / si_status
+
+use alloc::sync::Arc;
+use crate::println;
+use crate::arch::riscv64::syscall::{syscall_handler, SyscallFrame};
+use crate::fs::file::{File, FileFlags};
+use crate::sched::pid::*;
+
+const EBADF: u64 = -9_i64 as u64;
+const ECHILD: u64 = -10_i64 as u64;
+const EINVAL: u64 = -22_i64 as u64;
+const ESRCH: u64 = -3_i64 as u64;
+
+const WNOHANG: u64 = 1;
+const WEXITED: u64 = 4;
+
+fn waitid_syscall(idtype: u64, id: u64, options: u64) -> u64 {
+    let mut frame = SyscallFrame::default();
+    frame.a7 = 95;
+    frame.a0 = idtype;
+    frame.a1 = id;
+    frame.a2 = 0;
+    frame.a3 = options;
+    syscall_handler(&mut frame);
+    frame.a0
+}
+
+fn pidfd_open_syscall(pid: u64, flags: u64) -> u64 {
+    let mut frame = SyscallFrame::default();
+    frame.a7 = 434;
+    frame.a0 = pid;
+    frame.a1 = flags;
+    syscall_handler(&mut frame);
+    frame.a0
+}
+
+pub fn test_wait_pid() {
+    println!("test: ===== Testing PID Allocation and waitid =====");
+
+    // 测试 1: PID 位图
+    println!("test: 1. Testing PID bitmap allocation...");
+    let used = nr_pids();
+    let a = alloc_pid().unwrap();
+    let b = alloc_pid().unwrap();
+    assert!(a > PID_INIT && b > PID_INIT && a != b);
+    assert_eq!(nr_pids(), used + 2);
+    free_pid(a);
+    free_pid(a);
+    assert_eq!(nr_pids(), used + 1);
+    free_pid(b);
+    free_pid(PID_INIT);
+    assert_eq!(nr_pids(), used);
+    // 刚释放的 PID 不会马上被再次分配
+    let c = alloc_pid().unwrap();
+    assert!(c != a && c != b);
+    free_pid(c);
+    println!("test:    SUCCESS - pids allocate forward and free once");
+
+    // 测试 2: PID 散列
+    println!("test: 2. Testing PID hash lookup...");
+    match crate::sched::current() {
+        Some(task) => {
+            let task: *mut crate::process::task::Task = task;
+            let pid = unsafe { (*task).pid() };
+            assert_eq!(unsafe { crate::sched::find_task_by_pid(pid) }, task);
+            assert!(unsafe { crate::sched::find_task_by_pid(c) }.is_null());
+            println!("test:    SUCCESS - current task found by pid");
+        }
+        None => println!("test:    SKIPPED - no current task"),
+    }
+
+    // 测试 3: pidfd 文件
+    println!("test: 3. Testing pidfd file...");
+    let file = pidfd_create_file(1234, PIDFD_NONBLOCK);
+    assert_eq!(pidfd_pid(&file), Some(1234));
+    assert!(file.flags.bits() & FileFlags::O_NONBLOCK != 0);
+    let plain = Arc::new(File::new(FileFlags::new(FileFlags::O_RDWR)));
+    assert_eq!(pidfd_pid(&plain), None);
+    println!("test:    SUCCESS - pidfd records its pid");
+
+    // 测试 4: waitid 参数
+    println!("test: 4. Testing waitid arguments...");
+    assert_eq!(waitid_syscall(7, 0, WEXITED), EINVAL);
+    assert_eq!(waitid_syscall(0, 0, WNOHANG), EINVAL);
+    assert_eq!(waitid_syscall(0, 0, WEXITED | 0x10), EINVAL);
+    assert_eq!(waitid_syscall(1, 0, WEXITED), EINVAL);
+    assert_eq!(waitid_syscall(3, 1 << 20, WEXITED), EBADF);
+    if crate::sched::current().is_some() {
+        assert_eq!(waitid_syscall(1, c as u64, WEXITED | WNOHANG), ECHILD);
+    }
+    println!("test:    SUCCESS - invalid options rejected, no child gives ECHILD");
+
+    // 测试 5: pidfd_open
+    println!("test: 5. Testing pidfd_open...");
+    assert_eq!(pidfd_open_syscall(1, 1), EINVAL);
+    assert_eq!(pidfd_open_syscall(0, 0), EINVAL);
+    assert_eq!(pidfd_open_syscall(c as u64, 0), ESRCH);
+    let leader = crate::sched::current().map_or(false, |task| !task.is_thread() && task.has_fdtable());
+    if leader {
+        let pid = crate::sched::current().unwrap().pid();
+        let fd = pidfd_open_syscall(pid as u64, 0);
+        assert!((fd as i64) >= 0);
+        let file = unsafe { crate::fs::get_file_fd(fd as usize) }.unwrap();
+        assert_eq!(pidfd_pid(&file), Some(pid));
+        assert!(file.get_cloexec());
+        // 进程不是自己的子进程
+        assert_eq!(waitid_syscall(3, fd, WEXITED | WNOHANG), ECHILD);
+        drop(file);
+        assert!(unsafe { crate::fs::close_file_fd(fd as usize) }.is_ok());
+        println!("test:    SUCCESS - pidfd installed close-on-exec");
+    } else {
+        println!("test:    SKIPPED - no current process with an fd table");
+    }
+
+    // 测试 6: 等待状态
+    println!("test: 6. Testing wait status encoding...");
+    use crate::sched::{exit_status, kill_status, wait_status_to_cld};
+    use crate::signal::si_code::{CLD_EXITED, CLD_KILLED};
+    // WIFEXITED(s) = (s & 0x7f) == 0，WEXITSTATUS(s) = (s >> 8) & 0xff
+    assert_eq!(exit_status(0), 0);
+    assert_eq!(exit_status(3), 0x300);
+    assert_eq!(exit_status(-1), 0xff00);
+    assert_eq!(exit_status(256 + 7), 0x700);
+    // WIFSIGNALED(s)，WTERMSIG(s) = s & 0x7f
+    assert_eq!(kill_status(9), 9);
+    assert_eq!(wait_status_to_cld(exit_status(42)), (CLD_EXITED, 42));
+    assert_eq!(wait_status_to_cld(kill_status(9)), (CLD_KILLED, 9));
+    assert_eq!(wait_status_to_cld(kill_status(15)), (CLD_KILLED, 15));
+    println!("test:    SUCCESS - exit code in bits 8-15, killing signal in bits 0-6");
+
+    println!("test: PID allocation and waitid testing completed.");
+}
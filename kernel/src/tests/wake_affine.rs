@@ -0,0 +1,80 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+// 测试：唤醒时的 CPU 选择 (wake affine)
+//
+// 测试内容：
+// 1. 刚离开 CPU 的任务缓存是热的，离开超过迁移代价的是冷的
+// 2. 唤醒者的 CPU 无效时留在原 CPU
+// 3. 同步唤醒且唤醒者的 CPU 上只有唤醒者时放到唤醒者的 CPU
+// 4. 选出的 CPU 总有运行队列
+// 5. 正在运行的任务标记为在 CPU 上
+
+use core::sync::atomic::Ordering;
+
+use crate::println;
+use crate::process::task::{Task, SchedPolicy};
+use crate::sched::fair::sched_clock;
+use crate::sched::sched::{select_task_rq_fair, task_hot, SCHED_MIGRATION_COST_NS};
+use crate::sched::{self, MAX_CPUS, WF_SYNC};
+use alloc::boxed::Box;
+
+pub fn test_wake_affine() {
+    println!("test: ===== Testing Wake-Affine CPU Selection =====");
+
+    let this_cpu = crate::arch::cpu_id() as usize;
+    let mut task = Box::new(Task::new(950, SchedPolicy::Normal));
+    task.se.sum_exec_runtime = 1;
+
+    // 测试 1: 缓存热度
+    println!("test: 1. Testing task_hot...");
+    let now = sched_clock();
+    task.se.last_ran = now;
+    assert!(task_hot(&task, now));
+    assert!(task_hot(&task, now + SCHED_MIGRATION_COST_NS - 1));
+    assert!(!task_hot(&task, now + SCHED_MIGRATION_COST_NS));
+    println!("test:    SUCCESS - hot for {} ns after leaving the CPU", SCHED_MIGRATION_COST_NS);
+
+    // 测试 2: 无效的唤醒者 CPU
+    println!("test: 2. Testing invalid waker CPU...");
+    assert_eq!(select_task_rq_fair(&task, this_cpu, MAX_CPUS, 0), this_cpu);
+    assert_eq!(select_task_rq_fair(&task, this_cpu, MAX_CPUS, WF_SYNC), this_cpu);
+    println!("test:    SUCCESS - task stays on cpu{}", this_cpu);
+
+    // 测试 3: 同步唤醒
+    println!("test: 3. Testing sync wakeup...");
+    let other = (0..MAX_CPUS).find(|&cpu| cpu != this_cpu && sched::cpu_rq(cpu).is_some());
+    match other {
+        Some(prev) if sched::sched_can_stop_tick(this_cpu) => {
+            task.se.last_ran = sched_clock();
+            assert_eq!(select_task_rq_fair(&task, prev, this_cpu, WF_SYNC), this_cpu);
+            println!("test:    SUCCESS - pulled from cpu{} to waker cpu{}", prev, this_cpu);
+        }
+        _ => println!("test:    SKIPPED - no second CPU or waker CPU busy"),
+    }
+
+    // 测试 4: 选出的 CPU 有运行队列
+    println!("test: 4. Testing selected CPU is online...");
+    for prev in (0..MAX_CPUS).filter(|&cpu| sched::cpu_rq(cpu).is_some()) {
+        for &last_ran in &[0, sched_clock()] {
+            task.se.last_ran = last_ran;
+            for &flags in &[0, WF_SYNC] {
+                let cpu = select_task_rq_fair(&task, prev, this_cpu, flags);
+                assert!(sched::cpu_rq(cpu).is_some(), "cpu{} has no runqueue", cpu);
+            }
+        }
+    }
+    println!("test:    SUCCESS - every choice has a runqueue");
+
+    // 测试 5: 当前任务在 CPU 上
+    println!("test: 5. Testing on_cpu of current task...");
+    if let Some(current) = sched::current() {
+        assert!(current.se.on_cpu.load(Ordering::Acquire));
+        println!("test:    SUCCESS - current task marked on_cpu");
+    }
+    assert!(!task.se.on_cpu.load(Ordering::Acquire));
+
+    println!("test: Wake-affine testing completed.");
+}
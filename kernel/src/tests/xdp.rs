@@ -0,0 +1,113 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 经典 BPF 与 XDP 测试
+//!
+//! 验证装入检查拒绝不安全的程序、程序对构造的以太网帧给出正确的裁决，
+//! 以及挂载点的装入、卸载与控制文件格式
+
+use alloc::vec;
+use alloc::vec::Vec;
+
+use crate::net::filter::*;
+use crate::net::xdp::{XdpAction, XdpHook};
+use crate::println;
+
+/// 丢弃目的端口为 9 的 IPv4 UDP 包，其余放行
+fn drop_udp_discard() -> Vec<SockFilter> {
+    vec![
+        SockFilter::stmt(BPF_LD | BPF_H | BPF_ABS, 12),
+        SockFilter::jump(BPF_JMP | BPF_JEQ | BPF_K, 0x0800, 0, 6),
+        SockFilter::stmt(BPF_LD | BPF_B | BPF_ABS, 23),
+        SockFilter::jump(BPF_JMP | BPF_JEQ | BPF_K, 17, 0, 4),
+        SockFilter::stmt(BPF_LDX | BPF_B | BPF_MSH, 14),
+        SockFilter::stmt(BPF_LD | BPF_H | BPF_IND, 16),
+        SockFilter::jump(BPF_JMP | BPF_JEQ | BPF_K, 9, 0, 1),
+        SockFilter::stmt(BPF_RET | BPF_K, XdpAction::Drop as u32),
+        SockFilter::stmt(BPF_RET | BPF_K, XdpAction::Pass as u32),
+    ]
+}
+
+/// 以太网 + 20 字节 IPv4 头 + UDP 头
+fn udp_frame(dport: u16) -> Vec<u8> {
+    let mut frame = vec![0u8; 14 + 20 + 8];
+    frame[12] = 0x08;
+    frame[14] = 0x45;
+    frame[23] = 17;
+    frame[36..38].copy_from_slice(&dport.to_be_bytes());
+    frame
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_xdp() {
+    println!("test: ===== Starting XDP Tests =====");
+
+    // 1. 装入检查
+    println!("test: 1. Testing bpf_check_classic...");
+    let ret = SockFilter::stmt(BPF_RET | BPF_K, 0);
+    assert!(bpf_check_classic(&drop_udp_discard()).is_ok());
+    assert!(bpf_check_classic(&[]).is_err());
+    assert!(bpf_check_classic(&[SockFilter::stmt(BPF_LD | BPF_IMM, 1)]).is_err());
+    assert!(bpf_check_classic(&[SockFilter::jump(BPF_JMP | BPF_JEQ | BPF_K, 0, 1, 0), ret]).is_err());
+    assert!(bpf_check_classic(&[SockFilter::stmt(BPF_JMP | BPF_JA, 1), ret]).is_err());
+    assert!(bpf_check_classic(&[SockFilter::stmt(BPF_ALU | BPF_DIV | BPF_K, 0), ret]).is_err());
+    assert!(bpf_check_classic(&[SockFilter::stmt(BPF_ALU | BPF_LSH | BPF_K, 32), ret]).is_err());
+    assert!(bpf_check_classic(&[SockFilter::stmt(BPF_ST, BPF_MEMWORDS as u32), ret]).is_err());
+    assert!(bpf_check_classic(&[SockFilter::stmt(0xffff, 0), ret]).is_err());
+    println!("test:    SUCCESS - unsafe programs rejected");
+
+    // 2. 运行：按 UDP 目的端口丢弃，越界读取返回 0
+    println!("test: 2. Testing bpf_prog_run...");
+    let prog = drop_udp_discard();
+    assert_eq!(bpf_prog_run(&prog, &udp_frame(9)), XdpAction::Drop as u32);
+    assert_eq!(bpf_prog_run(&prog, &udp_frame(53)), XdpAction::Pass as u32);
+    let mut arp = udp_frame(9);
+    arp[13] = 0x06;
+    assert_eq!(bpf_prog_run(&prog, &arp), XdpAction::Pass as u32);
+    assert_eq!(bpf_prog_run(&prog, &udp_frame(9)[..30]), 0);
+    let div_x = [
+        SockFilter::stmt(BPF_LD | BPF_IMM, 7),
+        SockFilter::stmt(BPF_ALU | BPF_DIV | BPF_X, 0),
+        SockFilter::stmt(BPF_RET | BPF_A, 0),
+    ];
+    assert!(bpf_check_classic(&div_x).is_ok());
+    assert_eq!(bpf_prog_run(&div_x, &[]), 0);
+    println!("test:    SUCCESS - verdicts on constructed frames");
+
+    // 3. 返回值解析
+    println!("test: 3. Testing XdpAction::from_ret...");
+    assert_eq!(XdpAction::from_ret(2), (XdpAction::Pass, 0));
+    assert_eq!(XdpAction::from_ret(3), (XdpAction::Tx, 0));
+    assert_eq!(XdpAction::from_ret((2 << 8) | 4), (XdpAction::Redirect, 2));
+    assert_eq!(XdpAction::from_ret(4).0, XdpAction::Aborted);
+    assert_eq!(XdpAction::from_ret(0x77).0, XdpAction::Aborted);
+    println!("test:    SUCCESS - action and ifindex decoded");
+
+    // 4. 挂载点与控制文件
+    println!("test: 4. Testing XdpHook...");
+    let hook = XdpHook::new();
+    assert!(hook.prog().is_none());
+    let mut bytes = Vec::new();
+    for ins in drop_udp_discard() {
+        bytes.extend_from_slice(&ins.code.to_le_bytes());
+        bytes.push(ins.jt);
+        bytes.push(ins.jf);
+        bytes.extend_from_slice(&ins.k.to_le_bytes());
+    }
+    assert_eq!(hook.write_control(&bytes), Ok(bytes.len()));
+    let prog = hook.prog().expect("program attached");
+    assert_eq!(prog.len(), 9);
+    assert_eq!(prog.run(&udp_frame(9)), (XdpAction::Drop, 0));
+    assert!(hook.write_control(&bytes[..12]).is_err());
+    assert!(hook.prog().is_some());
+    hook.count(XdpAction::Drop);
+    assert_eq!(hook.action_count(XdpAction::Drop), 1);
+    assert!(hook.show("eth0").starts_with("eth0: prog 9 insns aborted 0 drop 1 pass 0"));
+    assert_eq!(hook.write_control(b"0\n"), Ok(2));
+    assert!(hook.prog().is_none());
+    println!("test:    SUCCESS - attach, detach and counters");
+
+    println!("test: ===== XDP Tests Completed =====");
+}
@@ -0,0 +1,182 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! zswap 单元测试
+//!
+//! LZ4 压缩往返、same_filled 页、匿名页两轮换出（先写保护再换出）后缺页换入、
+//! fork 共享交换项、munmap 释放交换槽
+
+use crate::println;
+use crate::arch::riscv64::mm::{
+    create_user_address_space, handle_mm_fault, map, try_to_swap_out, AddressSpace, FaultFlags, MmFaultResult,
+    SwapOut, VirtAddr,
+};
+use crate::lz4::{lz4_compress, lz4_compress_bound, lz4_decompress, LZ4_HASH_SIZE};
+use crate::mm::page::{PhysFrame, VirtAddr as PageVirtAddr, PAGE_SIZE};
+use crate::mm::page_desc::{pfn_to_page, PageFlag, PageType};
+use crate::mm::pcp::{alloc_user_page, free_user_page};
+use crate::mm::vma::{VmaFlags, VmaType};
+use crate::mm::zswap::{swap_count, swap_free, zswap_load, zswap_stats, zswap_store};
+
+/// 可压缩但不是 same_filled 的内容
+fn pattern(i: usize, seed: u8) -> u8 {
+    (i % 61) as u8 ^ seed
+}
+
+/// 按页回收的流程换出 addr 处的页：写保护、刷新 TLB、换出、刷新 TLB 后释放
+fn swap_out(aspace: &AddressSpace, addr: usize) -> bool {
+    let pfn = match aspace.translate(PageVirtAddr::new(addr)) {
+        Some(phys) => phys.as_usize() / PAGE_SIZE,
+        None => return false,
+    };
+    if try_to_swap_out(pfn) == SwapOut::Protected {
+        crate::arch::tlb::flush_tlb_all();
+    }
+    if try_to_swap_out(pfn) != SwapOut::Unmapped {
+        return false;
+    }
+    crate::arch::tlb::flush_tlb_all();
+    crate::mm::vmscan::lru_cache_del(pfn);
+    unsafe {
+        let page = pfn_to_page(pfn);
+        (*page).set_page_type(PageType::Normal);
+        (*page).clear_flag(PageFlag::SwapBacked);
+    }
+    free_user_page(PhysFrame::new(pfn));
+    true
+}
+
+/// 读缺页后检查 addr 处的页内容
+fn check_page(aspace: &AddressSpace, addr: usize, seed: u8) -> bool {
+    let result = handle_mm_fault(aspace, VirtAddr::new(addr as u64), FaultFlags::READ | FaultFlags::USER);
+    if result != MmFaultResult::Handled && result != MmFaultResult::AlreadyMapped {
+        return false;
+    }
+    let phys = match aspace.translate(PageVirtAddr::new(addr)) {
+        Some(phys) => phys.as_usize(),
+        None => return false,
+    };
+    let data = unsafe { core::slice::from_raw_parts(phys as *const u8, PAGE_SIZE) };
+    data.iter().enumerate().all(|(i, &byte)| byte == pattern(i, seed))
+}
+
+#[cfg(feature = "unit-test")]
+pub fn test_zswap() {
+    println!("test: ===== Starting zswap Tests =====");
+
+    // 1. LZ4 往返
+    println!("test: 1. Testing LZ4 round trip...");
+    let mut src = [0u8; 2048];
+    for (i, byte) in src.iter_mut().enumerate() {
+        *byte = if i < 1024 { pattern(i, 0x11) } else { (i * 7 % 251) as u8 };
+    }
+    let mut compressed = [0u8; lz4_compress_bound(2048)];
+    let mut table = [0u16; LZ4_HASH_SIZE];
+    let len = lz4_compress(&src, &mut compressed, &mut table).expect("compress failed");
+    assert!(len < src.len());
+    let mut out = [0u8; 2048];
+    assert_eq!(lz4_decompress(&compressed[..len], &mut out), Some(src.len()));
+    assert!(out == src);
+    let short = lz4_compress(b"abc", &mut compressed, &mut table).expect("compress failed");
+    assert_eq!(lz4_decompress(&compressed[..short], &mut out), Some(3));
+    assert_eq!(&out[..3], b"abc");
+    // 截断的输入和太小的输出缓冲区
+    assert_eq!(lz4_decompress(&compressed[..len / 2], &mut out), None);
+    assert_eq!(lz4_decompress(&compressed[..len], &mut out[..100]), None);
+    println!("test:    SUCCESS - {} bytes compressed to {}", src.len(), len);
+
+    // 2. same_filled 页不占池空间
+    println!("test: 2. Testing same-filled pages...");
+    match (alloc_user_page(), alloc_user_page()) {
+        (Some(frame), Some(dst)) => {
+            let words = unsafe {
+                core::slice::from_raw_parts_mut((frame.number * PAGE_SIZE) as *mut usize, PAGE_SIZE / 8)
+            };
+            words.fill(0x5a5a_5a5a_5a5a_5a5a);
+            let before = zswap_stats();
+            let offset = zswap_store(frame.number).expect("store failed");
+            let stats = zswap_stats();
+            assert_eq!(stats.same_filled_pages, before.same_filled_pages + 1);
+            assert_eq!(stats.pool_pages, before.pool_pages);
+            assert_eq!(swap_count(offset), 1);
+            assert!(zswap_load(offset, dst.number));
+            let loaded = unsafe { core::slice::from_raw_parts((dst.number * PAGE_SIZE) as *const usize, PAGE_SIZE / 8) };
+            assert!(loaded.iter().all(|&word| word == 0x5a5a_5a5a_5a5a_5a5a));
+            swap_free(offset);
+            assert_eq!(swap_count(offset), 0);
+            assert_eq!(zswap_stats().stored_pages, before.stored_pages);
+            free_user_page(frame);
+            free_user_page(dst);
+            println!("test:    SUCCESS - same-filled page stored without pool pages");
+        }
+        (frame, dst) => {
+            frame.into_iter().chain(dst).for_each(free_user_page);
+            println!("test:    SKIP - no free pages");
+        }
+    }
+
+    let root_ppn = match create_user_address_space() {
+        Some(ppn) => ppn,
+        None => {
+            println!("test:    SKIP - no page table available");
+            println!("test: ===== zswap Tests Completed =====");
+            return;
+        }
+    };
+    let aspace = unsafe { AddressSpace::new(root_ppn) };
+    let mut flags = VmaFlags::new();
+    flags.insert(VmaFlags::READ | VmaFlags::WRITE | VmaFlags::PRIVATE);
+    let base = aspace
+        .mmap(PageVirtAddr::new(0), 3 * PAGE_SIZE, flags, VmaType::Anonymous, map::MAP_PRIVATE | map::MAP_ANONYMOUS)
+        .expect("mmap failed")
+        .as_usize();
+    for page in 0..3 {
+        let addr = base + page * PAGE_SIZE;
+        assert_eq!(handle_mm_fault(&aspace, VirtAddr::new(addr as u64), FaultFlags::WRITE | FaultFlags::USER),
+                   MmFaultResult::Handled);
+        let phys = aspace.translate(PageVirtAddr::new(addr)).unwrap().as_usize();
+        for i in 0..PAGE_SIZE {
+            unsafe { *((phys + i) as *mut u8) = pattern(i, page as u8) };
+        }
+    }
+
+    // 3. 换出后缺页换入
+    println!("test: 3. Testing swap out and swap in...");
+    let before = zswap_stats();
+    assert!(swap_out(&aspace, base), "anonymous page not swapped out");
+    assert!(aspace.translate(PageVirtAddr::new(base)).is_none());
+    assert_eq!(zswap_stats().stored_pages, before.stored_pages + 1);
+    let vma = aspace.find_vma(PageVirtAddr::new(base)).unwrap();
+    assert_eq!(aspace.smaps(&vma).swap, PAGE_SIZE as u64);
+    assert!(check_page(&aspace, base, 0), "swapped-in page corrupted");
+    let after = zswap_stats();
+    assert_eq!(after.stored_pages, before.stored_pages);
+    assert_eq!(after.pswpin, before.pswpin + 1);
+    assert_eq!(aspace.smaps(&vma).swap, 0);
+    println!("test:    SUCCESS - page restored from zswap");
+
+    // 4. fork 后父子进程各自换入
+    println!("test: 4. Testing swap entries shared by fork...");
+    assert!(swap_out(&aspace, base + PAGE_SIZE));
+    let stored = zswap_stats().stored_pages;
+    let child = aspace.fork().expect("fork failed");
+    assert!(check_page(&child, base + PAGE_SIZE, 1), "child read wrong data");
+    assert_eq!(zswap_stats().stored_pages, stored, "slot freed while the parent still maps it");
+    assert!(check_page(&aspace, base + PAGE_SIZE, 1), "parent read wrong data");
+    assert_eq!(zswap_stats().stored_pages, stored - 1);
+    child.mmput();
+    println!("test:    SUCCESS - each copy of the swap entry holds its own reference");
+
+    // 5. munmap 释放交换槽
+    println!("test: 5. Testing munmap of swapped pages...");
+    assert!(swap_out(&aspace, base + 2 * PAGE_SIZE));
+    let stored = zswap_stats().stored_pages;
+    aspace.munmap(PageVirtAddr::new(base + 2 * PAGE_SIZE), PAGE_SIZE).expect("munmap failed");
+    assert_eq!(zswap_stats().stored_pages, stored - 1);
+    aspace.mmput();
+    println!("test:    SUCCESS - unmapping a swap entry frees its slot");
+
+    println!("test: ===== zswap Tests Completed =====");
+}
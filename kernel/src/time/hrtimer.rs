@@ -0,0 +1,365 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 高精度定时器 (hrtimer)
+//!
+//! 以纳秒为单位的精确定时器。每个 CPU 一棵按到期时间排序的红黑树，最左节点
+//! 就是最早到期的定时器，它和下一个 tick 中较早的一个决定 set_timer 编程的
+//! 中断时间；到期回调在 HRTIMER_SOFTIRQ 中执行，返回 Restart 的定时器按
+//! 新的到期时间重新入队。
+//!
+//! 参考: kernel/time/hrtimer.c, include/linux/hrtimer.h
+
+use core::cell::UnsafeCell;
+use core::mem::offset_of;
+use core::ptr;
+use core::sync::atomic::{AtomicPtr, Ordering};
+use spin::Mutex;
+
+use crate::config::MAX_CPUS;
+use crate::rbtree::{RbNode, RbRoot, RbRootCached};
+use crate::time::ktime_get;
+
+/// 回调的返回值 (enum hrtimer_restart)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum HrtimerRestart {
+    NoRestart,
+    Restart,
+}
+
+/// 到期时间的解释方式 (enum hrtimer_mode)
+#[derive(Debug, Clone, Copy, PartialEq, Eq)]
+pub enum HrtimerMode {
+    /// 绝对的单调时间
+    Abs,
+    /// 相对于当前时间
+    Rel,
+}
+
+/// 定时器到期回调，在软中断中执行，不能睡眠
+pub type HrtimerFunc = fn(&Hrtimer) -> HrtimerRestart;
+
+/// 高精度定时器 (struct hrtimer)
+///
+/// 入队期间定时器不能移动；释放时自动取消
+pub struct Hrtimer {
+    node: UnsafeCell<RbNode>,
+    /// 到期时间，纳秒
+    expires: UnsafeCell<u64>,
+    /// 是否在红黑树中 (HRTIMER_STATE_ENQUEUED)
+    enqueued: UnsafeCell<bool>,
+    /// 所在的定时器基，入队或正在执行时有效
+    base: AtomicPtr<Mutex<HrtimerBase>>,
+    function: HrtimerFunc,
+    data: usize,
+}
+
+// 树节点只在所属定时器基的锁内访问
+unsafe impl Send for Hrtimer {}
+unsafe impl Sync for Hrtimer {}
+
+impl Hrtimer {
+    /// 创建定时器 (hrtimer_init)
+    pub const fn new(function: HrtimerFunc, data: usize) -> Self {
+        Self {
+            node: UnsafeCell::new(RbNode::new()),
+            expires: UnsafeCell::new(0),
+            enqueued: UnsafeCell::new(false),
+            base: AtomicPtr::new(ptr::null_mut()),
+            function,
+            data,
+        }
+    }
+
+    /// 创建时传入的私有数据
+    #[inline]
+    pub fn data(&self) -> usize {
+        self.data
+    }
+
+    /// 到期时间 (hrtimer_get_expires)
+    #[inline]
+    pub fn expires(&self) -> u64 {
+        unsafe { *self.expires.get() }
+    }
+
+    /// 推进到期时间，使其晚于 now (hrtimer_forward)
+    ///
+    /// 只能在回调中或定时器未入队时调用
+    ///
+    /// # 返回
+    /// 跳过的周期数 (overrun)
+    pub fn forward(&self, now: u64, interval: u64) -> u64 {
+        let expires = self.expires();
+        if interval == 0 || now < expires {
+            return 0;
+        }
+        let overruns = (now - expires) / interval + 1;
+        unsafe { *self.expires.get() = expires.saturating_add(overruns.saturating_mul(interval)) };
+        overruns
+    }
+}
+
+impl Drop for Hrtimer {
+    fn drop(&mut self) {
+        hrtimer_cancel(self);
+    }
+}
+
+/// 由树节点得到定时器 (rb_entry)
+#[inline]
+unsafe fn timer_of(node: *mut RbNode) -> *const Hrtimer {
+    (node as usize - offset_of!(Hrtimer, node)) as *const Hrtimer
+}
+
+/// 每个 CPU 的定时器基 (struct hrtimer_clock_base)
+pub struct HrtimerBase {
+    active: RbRootCached,
+    /// 正在执行回调的定时器
+    running: *const Hrtimer,
+}
+
+unsafe impl Send for HrtimerBase {}
+
+impl HrtimerBase {
+    pub const fn new() -> Self {
+        Self {
+            active: RbRootCached::new(),
+            running: ptr::null(),
+        }
+    }
+
+    /// 按到期时间插入红黑树 (enqueue_hrtimer)
+    ///
+    /// # 返回
+    /// 是否成为最早到期的定时器
+    unsafe fn enqueue(&mut self, timer: &Hrtimer) -> bool {
+        let key = timer.expires();
+        let mut link = &mut self.active.rb_root.node as *mut *mut RbNode;
+        let mut parent = ptr::null_mut();
+        let mut leftmost = true;
+        while !(*link).is_null() {
+            parent = *link;
+            if key < (*timer_of(parent)).expires() {
+                link = &mut (*parent).left;
+            } else {
+                link = &mut (*parent).right;
+                leftmost = false;
+            }
+        }
+        let node = timer.node.get();
+        RbRoot::link_node(node, parent, link);
+        self.active.insert_color(node, leftmost);
+        *timer.enqueued.get() = true;
+        leftmost
+    }
+
+    /// 从红黑树删除 (__remove_hrtimer)
+    unsafe fn remove(&mut self, timer: &Hrtimer) -> bool {
+        if !*timer.enqueued.get() {
+            return false;
+        }
+        self.active.erase(timer.node.get());
+        (*timer.node.get()).clear();
+        *timer.enqueued.get() = false;
+        true
+    }
+
+    /// 最早的到期时间
+    pub fn next_event(&self) -> Option<u64> {
+        let first = self.active.first();
+        if first.is_null() {
+            None
+        } else {
+            Some(unsafe { (*timer_of(first)).expires() })
+        }
+    }
+}
+
+/// 每个 CPU 的定时器基 (hrtimer_bases)
+static HRTIMER_BASES: [Mutex<HrtimerBase>; MAX_CPUS] = [const { Mutex::new(HrtimerBase::new()) }; MAX_CPUS];
+
+/// 当前 CPU 的定时器基
+#[inline]
+fn this_cpu_base() -> &'static Mutex<HrtimerBase> {
+    let cpu = crate::arch::cpu_id() as usize;
+    &HRTIMER_BASES[cpu.min(MAX_CPUS - 1)]
+}
+
+/// 锁住定时器所在的定时器基 (lock_hrtimer_base)
+fn lock_hrtimer_base(timer: &Hrtimer) -> Option<spin::MutexGuard<'static, HrtimerBase>> {
+    loop {
+        let base = timer.base.load(Ordering::Acquire);
+        if base.is_null() {
+            return None;
+        }
+        let guard = unsafe { (*base).lock() };
+        if timer.base.load(Ordering::Acquire) == base {
+            return Some(guard);
+        }
+    }
+}
+
+/// 定时器是否已入队 (hrtimer_is_queued)
+#[inline]
+pub fn hrtimer_is_queued(timer: &Hrtimer) -> bool {
+    unsafe { *timer.enqueued.get() }
+}
+
+/// 在指定定时器基上启动定时器 (__hrtimer_start_range_ns)
+///
+/// 定时器基必须比挂在上面的定时器存活得更久
+///
+/// # 返回
+/// 是否成为该定时器基上最早到期的定时器
+pub fn hrtimer_start_on(base: &Mutex<HrtimerBase>, timer: &Hrtimer, tim: u64, mode: HrtimerMode) -> bool {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    if let Some(mut old) = lock_hrtimer_base(timer) {
+        unsafe { old.remove(timer) };
+    }
+    let expires = match mode {
+        HrtimerMode::Abs => tim,
+        HrtimerMode::Rel => ktime_get().saturating_add(tim),
+    };
+    let mut guard = base.lock();
+    unsafe { *timer.expires.get() = expires };
+    timer.base.store(base as *const _ as *mut _, Ordering::Release);
+    unsafe { guard.enqueue(timer) }
+}
+
+/// 在当前 CPU 上启动定时器 (hrtimer_start)
+///
+/// 成为最早到期的定时器时立即重新编程时钟事件
+pub fn hrtimer_start(timer: &Hrtimer, tim: u64, mode: HrtimerMode) {
+    if hrtimer_start_on(this_cpu_base(), timer, tim, mode) {
+        crate::time::tick::tick_program_event();
+    }
+}
+
+/// 取消入队的定时器，不等待正在执行的回调 (hrtimer_try_to_cancel)
+///
+/// # 返回
+/// 取消前定时器是否已入队
+pub fn hrtimer_try_to_cancel(timer: &Hrtimer) -> bool {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    match lock_hrtimer_base(timer) {
+        Some(mut base) => unsafe { base.remove(timer) },
+        None => false,
+    }
+}
+
+/// 取消定时器并等待正在执行的回调结束 (hrtimer_cancel)
+///
+/// 不能在定时器自己的回调中调用
+pub fn hrtimer_cancel(timer: &Hrtimer) -> bool {
+    let mut queued = false;
+    loop {
+        {
+            let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+            let mut base = match lock_hrtimer_base(timer) {
+                Some(base) => base,
+                None => return queued,
+            };
+            queued |= unsafe { base.remove(timer) };
+            if !ptr::eq(base.running, timer) {
+                return queued;
+            }
+        }
+        core::hint::spin_loop();
+    }
+}
+
+/// 距离到期的剩余纳秒 (hrtimer_get_remaining)
+pub fn hrtimer_get_remaining(timer: &Hrtimer) -> u64 {
+    timer.expires().saturating_sub(ktime_get())
+}
+
+/// 执行定时器基上到 now 为止到期的定时器 (__hrtimer_run_queues)
+///
+/// 回调执行时不持有锁；回调返回 Restart 且没有自己重新启动时，按推进后的
+/// 到期时间重新入队
+pub fn hrtimer_run_queues_on(base: &Mutex<HrtimerBase>, now: u64) {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let mut guard = base.lock();
+    loop {
+        let first = guard.active.first();
+        if first.is_null() {
+            break;
+        }
+        let timer = unsafe { &*timer_of(first) };
+        if timer.expires() > now {
+            break;
+        }
+        // __run_hrtimer
+        unsafe { guard.remove(timer) };
+        guard.running = timer;
+        drop(guard);
+        let restart = (timer.function)(timer);
+        guard = base.lock();
+        if restart == HrtimerRestart::Restart && !hrtimer_is_queued(timer)
+            && ptr::eq(timer.base.load(Ordering::Acquire), base)
+        {
+            unsafe { guard.enqueue(timer) };
+        }
+        guard.running = ptr::null();
+    }
+}
+
+/// 当前 CPU 上最早的到期时间
+pub fn hrtimer_next_event() -> Option<u64> {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    this_cpu_base().lock().next_event()
+}
+
+/// 时钟中断中检查当前 CPU 是否有到期的定时器 (hrtimer_interrupt)
+pub fn hrtimer_interrupt(now: u64) {
+    let expired = this_cpu_base().lock().next_event().map_or(false, |next| next <= now);
+    if expired {
+        crate::softirq::raise_softirq(crate::softirq::HRTIMER_SOFTIRQ);
+    }
+}
+
+/// HRTIMER_SOFTIRQ 处理函数 (hrtimer_run_softirq)
+pub fn hrtimer_run_softirq() {
+    hrtimer_run_queues_on(this_cpu_base(), ktime_get());
+}
+
+/// 唤醒睡眠的任务 (hrtimer_wakeup)
+///
+/// data 为睡眠的任务，供带超时的睡眠使用
+pub fn hrtimer_wakeup(timer: &Hrtimer) -> HrtimerRestart {
+    crate::sched::wake_up_process(timer.data() as *mut crate::process::Task);
+    HrtimerRestart::NoRestart
+}
+
+/// 可中断地睡眠到绝对时间 expires (do_nanosleep)
+///
+/// # 返回
+/// - Ok(()): 到达 expires
+/// - Err(remaining): 被信号打断，remaining 为剩余纳秒
+pub fn hrtimer_nanosleep(expires: u64) -> Result<(), u64> {
+    use crate::process::task::TaskState;
+
+    let task = match crate::sched::current() {
+        Some(task) => task,
+        None => return Ok(()),
+    };
+    let timer = Hrtimer::new(hrtimer_wakeup, task as *mut crate::process::Task as usize);
+    loop {
+        let now = ktime_get();
+        if now >= expires {
+            return Ok(());
+        }
+        if crate::signal::signal_pending() {
+            return Err(expires - now);
+        }
+        task.set_state(TaskState::Interruptible);
+        hrtimer_start(&timer, expires, HrtimerMode::Abs);
+        if hrtimer_is_queued(&timer) {
+            crate::sched::schedule();
+        }
+        hrtimer_cancel(&timer);
+        task.set_state(TaskState::Running);
+    }
+}
@@ -0,0 +1,62 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 时间子系统
+//!
+//! - timer: 以 jiffies 为单位的分层时间轮，用于粗粒度超时
+//! - hrtimer: 以纳秒为单位的红黑树定时器，直接决定下一次时钟中断
+//! - tick: 周期 tick 与空闲 CPU 停止 tick (NO_HZ)
+//!
+//! 时钟源是 time CSR，时钟事件设备是 SBI set_timer。
+//!
+//! 参考: kernel/time/, include/linux/ktime.h
+
+pub mod timer;
+pub mod hrtimer;
+pub mod tick;
+
+use crate::drivers::timer::{read_time, CLOCK_FREQ, HZ};
+
+pub const NSEC_PER_SEC: u64 = 1_000_000_000;
+pub const NSEC_PER_MSEC: u64 = 1_000_000;
+pub const NSEC_PER_USEC: u64 = 1_000;
+
+/// 一个 jiffy 的纳秒数 (TICK_NSEC)
+pub const TICK_NSEC: u64 = NSEC_PER_SEC / HZ;
+
+/// 一个 time CSR 周期的纳秒数
+const NSEC_PER_CYCLE: u64 = NSEC_PER_SEC / CLOCK_FREQ;
+
+/// 时钟周期转换为纳秒
+#[inline]
+pub const fn cycles_to_ns(cycles: u64) -> u64 {
+    cycles.saturating_mul(NSEC_PER_CYCLE)
+}
+
+/// 纳秒转换为时钟周期，向上取整，保证定时器不会提前到期
+#[inline]
+pub const fn ns_to_cycles(ns: u64) -> u64 {
+    ns / NSEC_PER_CYCLE + (ns % NSEC_PER_CYCLE != 0) as u64
+}
+
+/// 纳秒转换为 jiffies，向上取整 (nsecs_to_jiffies)
+#[inline]
+pub const fn nsecs_to_jiffies(ns: u64) -> u64 {
+    ns / TICK_NSEC + (ns % TICK_NSEC != 0) as u64
+}
+
+/// 单调时间，纳秒 (ktime_get)
+#[inline]
+pub fn ktime_get() -> u64 {
+    cycles_to_ns(read_time())
+}
+
+/// 注册定时器软中断
+pub fn init() {
+    use crate::softirq::{open_softirq, HRTIMER_SOFTIRQ, TIMER_SOFTIRQ};
+
+    open_softirq(TIMER_SOFTIRQ, timer::run_timer_softirq);
+    open_softirq(HRTIMER_SOFTIRQ, hrtimer::hrtimer_run_softirq);
+    tick::tick_nohz_init();
+}
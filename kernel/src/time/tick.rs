@@ -0,0 +1,225 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 周期 tick 与停止 tick (NO_HZ)
+//!
+//! 每个 CPU 的时钟事件只有一个截止时间：tick 运行时取下一个 tick 与最早的
+//! hrtimer 中较早者；tick 停止时只为时间轮和 hrtimer 上最早的定时器编程
+//! 中断，没有定时器时一直睡到被 IPI 唤醒。
+//!
+//! - NO_HZ idle：非启动核进入空闲后停止 tick，被唤醒时按 time CSR 补上
+//!   jiffies。启动核 (tick_do_timer_cpu) 始终保持周期 tick，网络等全局的
+//!   周期性工作不会停。
+//! - NO_HZ full：启动参数 `nohz_full=<cpu 列表>` 指定的非启动核上只有一个
+//!   可运行任务时，在中断返回前停止 tick；运行队列加入第二个任务时恢复。
+//!
+//! 参考: kernel/time/tick-sched.c, kernel/time/tick-common.c
+//!       Documentation/timers/no_hz.rst
+
+use core::sync::atomic::{AtomicBool, AtomicU64, AtomicUsize, Ordering};
+
+use crate::config::MAX_CPUS;
+use crate::drivers::timer::{cycles_to_jiffies, jiffies_to_cycles, read_time, set_timer, update_jiffies};
+use crate::time::{hrtimer, ns_to_cycles, timer};
+
+/// 不停止 tick 的 CPU (tick_do_timer_cpu)
+pub const TICK_DO_TIMER_CPU: usize = 0;
+
+/// 每个 CPU 下一个 tick 的时钟周期 (tick_next_period)
+static NEXT_TICK: [AtomicU64; MAX_CPUS] = [const { AtomicU64::new(0) }; MAX_CPUS];
+
+/// 每个 CPU 的 tick 是否已停止 (tick_stopped)
+static TICK_STOPPED: [AtomicBool; MAX_CPUS] = [const { AtomicBool::new(false) }; MAX_CPUS];
+
+/// 每个 CPU 是否在空闲循环中停止了 tick (inidle)
+static TICK_INIDLE: [AtomicBool; MAX_CPUS] = [const { AtomicBool::new(false) }; MAX_CPUS];
+
+/// 启用 NO_HZ full 的 CPU 位图 (tick_nohz_full_mask)
+static NOHZ_FULL_MASK: AtomicUsize = AtomicUsize::new(0);
+
+#[inline]
+fn this_cpu() -> usize {
+    (crate::arch::cpu_id() as usize).min(MAX_CPUS - 1)
+}
+
+/// 解析 CPU 列表，如 "1-3,5" (cpulist_parse)
+///
+/// 超出 MAX_CPUS 的 CPU 被忽略；格式错误返回 None
+pub fn parse_cpulist(list: &str) -> Option<usize> {
+    let mut mask = 0usize;
+    for part in list.split(',').filter(|p| !p.is_empty()) {
+        let (first, last) = match part.split_once('-') {
+            Some((a, b)) => (a.parse::<usize>().ok()?, b.parse::<usize>().ok()?),
+            None => {
+                let cpu = part.parse::<usize>().ok()?;
+                (cpu, cpu)
+            }
+        };
+        if first > last {
+            return None;
+        }
+        for cpu in first..=last.min(MAX_CPUS - 1) {
+            mask |= 1 << cpu;
+        }
+    }
+    Some(mask)
+}
+
+/// 读取 nohz_full 启动参数 (tick_nohz_full_setup)
+///
+/// 启动核必须保持 tick，从位图中去掉
+pub fn tick_nohz_init() {
+    let list = match crate::cmdline::get_param("nohz_full") {
+        Some(list) => list,
+        None => return,
+    };
+    match parse_cpulist(&list) {
+        Some(mask) => {
+            let mask = mask & !(1 << TICK_DO_TIMER_CPU);
+            NOHZ_FULL_MASK.store(mask, Ordering::Release);
+            crate::println!("tick: nohz_full cpus {:#x}", mask);
+        }
+        None => crate::println!("tick: invalid nohz_full list '{}'", list),
+    }
+}
+
+/// CPU 是否启用了 NO_HZ full (tick_nohz_full_cpu)
+#[inline]
+pub fn tick_nohz_full_cpu(cpu: usize) -> bool {
+    cpu < MAX_CPUS && NOHZ_FULL_MASK.load(Ordering::Acquire) & (1 << cpu) != 0
+}
+
+/// 时钟中断中判断本次是否到了 tick (tick_handle_periodic)
+///
+/// tick 停止期间的每次中断都按 tick 处理，补上停止期间的工作。
+/// tick 对齐到 jiffy 边界，中断晚到时不会累积误差
+pub fn tick_handle(now: u64) -> bool {
+    let cpu = this_cpu();
+    if now < NEXT_TICK[cpu].load(Ordering::Acquire) {
+        return false;
+    }
+    NEXT_TICK[cpu].store(jiffies_to_cycles(cycles_to_jiffies(now) + 1), Ordering::Release);
+    true
+}
+
+/// 本 CPU 的 tick 是否已停止
+#[inline]
+pub fn tick_stopped() -> bool {
+    TICK_STOPPED[this_cpu()].load(Ordering::Acquire)
+}
+
+/// 为本 CPU 编程下一次时钟中断 (tick_program_event)
+///
+/// tick 运行时取下一个 tick，停止时取时间轮上最早的定时器；再与最早的
+/// hrtimer 比较
+pub fn tick_program_event() {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    set_timer(next_event(this_cpu()));
+}
+
+/// 本 CPU 下一次时钟中断的时钟周期，没有定时器时为 u64::MAX
+fn next_event(cpu: usize) -> u64 {
+    let next = if TICK_STOPPED[cpu].load(Ordering::Acquire) {
+        timer::next_timer_interrupt().map_or(u64::MAX, jiffies_to_cycles)
+    } else {
+        NEXT_TICK[cpu].load(Ordering::Acquire)
+    };
+    match hrtimer::hrtimer_next_event() {
+        Some(expires) => next.min(ns_to_cycles(expires)),
+        None => next,
+    }
+}
+
+/// 距下一次时钟中断的时钟周期数 (tick_nohz_get_sleep_length)
+///
+/// 空闲循环据此预测能睡多久；没有定时器时为 u64::MAX
+pub fn tick_nohz_get_sleep_length() -> u64 {
+    next_event(this_cpu()).saturating_sub(read_time())
+}
+
+/// 恢复本 CPU 的周期 tick (tick_nohz_restart)
+///
+/// 补上停止期间的 jiffies，下一个 tick 对齐到 jiffy 边界
+fn tick_nohz_restart(cpu: usize) {
+    let now = read_time();
+    update_jiffies(now);
+    NEXT_TICK[cpu].store(jiffies_to_cycles(cycles_to_jiffies(now) + 1), Ordering::Release);
+    TICK_STOPPED[cpu].store(false, Ordering::Release);
+    tick_program_event();
+}
+
+/// 进入空闲前停止 tick (tick_nohz_idle_enter)
+pub fn tick_nohz_idle_enter() {
+    let cpu = this_cpu();
+    // 有节流的任务时保留 tick，由它检查组带宽的新周期
+    if cpu == TICK_DO_TIMER_CPU || crate::sched::sched::sched_cfs_throttled(cpu) {
+        return;
+    }
+    TICK_INIDLE[cpu].store(true, Ordering::Release);
+    TICK_STOPPED[cpu].store(true, Ordering::Release);
+    tick_program_event();
+}
+
+/// 离开空闲后恢复 tick (tick_nohz_idle_exit)
+pub fn tick_nohz_idle_exit() {
+    let cpu = this_cpu();
+    if !TICK_INIDLE[cpu].swap(false, Ordering::AcqRel) {
+        return;
+    }
+    tick_nohz_restart(cpu);
+}
+
+/// 进入中断时补上 tick 停止期间的 jiffies (tick_irq_enter)
+///
+/// NO_HZ full 的 CPU 上运行队列已不止一个任务时立即恢复 tick，
+/// 后面的调度才有时间片可用
+pub fn tick_irq_enter() {
+    let cpu = this_cpu();
+    if !TICK_STOPPED[cpu].load(Ordering::Acquire) {
+        return;
+    }
+    if !TICK_INIDLE[cpu].load(Ordering::Acquire) && !crate::sched::sched_can_stop_tick(cpu) {
+        tick_nohz_restart(cpu);
+    } else {
+        update_jiffies(read_time());
+    }
+}
+
+/// 中断返回前判断能否停止 tick (tick_nohz_irq_exit)
+///
+/// 只处理 NO_HZ full 的 CPU；调用方随后重新编程时钟事件
+pub fn tick_nohz_irq_exit() {
+    let cpu = this_cpu();
+    if !tick_nohz_full_cpu(cpu) || TICK_INIDLE[cpu].load(Ordering::Acquire) {
+        return;
+    }
+    let can_stop = crate::sched::sched_can_stop_tick(cpu);
+    if can_stop != TICK_STOPPED[cpu].load(Ordering::Acquire) {
+        if can_stop {
+            TICK_STOPPED[cpu].store(true, Ordering::Release);
+            tick_program_event();
+        } else {
+            tick_nohz_restart(cpu);
+        }
+    }
+}
+
+/// 运行队列任务数变化时检查 tick 依赖 (tick_nohz_dep_set_cpu)
+///
+/// 停止了 tick 的 NO_HZ full CPU 加入第二个任务时恢复 tick：本 CPU 直接
+/// 恢复，其他 CPU 用 IPI 通知，由对方的 tick_irq_enter 恢复
+pub fn tick_nohz_dep_update(cpu: usize, nr_running: usize) {
+    if nr_running <= 1 || !tick_nohz_full_cpu(cpu) || !TICK_STOPPED[cpu].load(Ordering::Acquire) {
+        return;
+    }
+    if TICK_INIDLE[cpu].load(Ordering::Acquire) {
+        return;
+    }
+    if cpu == this_cpu() {
+        tick_nohz_restart(cpu);
+    } else {
+        #[cfg(feature = "riscv64")]
+        crate::arch::ipi::send_reschedule_ipi(cpu);
+    }
+}
@@ -0,0 +1,466 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+//! 分层时间轮 (timer wheel)
+//!
+//! 以 jiffies 为单位的粗粒度定时器，适合各类超时。每个 CPU 一个时间轮，共
+//! 8 层、每层 64 个桶，第 n 层的一个桶跨 8^n 个 jiffies：越远的定时器落在
+//! 越粗的层上，到期时间向上取整到桶的粒度，只会推迟、不会提前。插入和删除都是
+//! O(1)，不需要逐层迁移；到期的定时器在 TIMER_SOFTIRQ 中执行。
+//!
+//! 参考: kernel/time/timer.c, include/linux/timer.h
+
+use core::cell::UnsafeCell;
+use core::ptr;
+use core::sync::atomic::{AtomicPtr, Ordering};
+use spin::Mutex;
+
+use crate::config::MAX_CPUS;
+use crate::drivers::timer::get_jiffies;
+
+/// 每层桶数 (LVL_BITS / LVL_SIZE)
+const LVL_BITS: u32 = 6;
+const LVL_SIZE: usize = 1 << LVL_BITS;
+const LVL_MASK: u64 = LVL_SIZE as u64 - 1;
+
+/// 相邻两层的粒度相差 8 倍 (LVL_CLK_SHIFT)
+const LVL_CLK_SHIFT: u32 = 3;
+const LVL_CLK_MASK: u64 = (1 << LVL_CLK_SHIFT) - 1;
+
+/// 层数 (LVL_DEPTH)
+const LVL_DEPTH: usize = 8;
+const WHEEL_SIZE: usize = LVL_SIZE * LVL_DEPTH;
+
+/// 第 n 层的粒度 (LVL_SHIFT / LVL_GRAN)
+#[inline]
+const fn lvl_shift(n: usize) -> u32 {
+    n as u32 * LVL_CLK_SHIFT
+}
+
+#[inline]
+const fn lvl_gran(n: usize) -> u64 {
+    1 << lvl_shift(n)
+}
+
+/// 第 n 层容纳的最小延迟 (LVL_START)
+const fn lvl_start(n: usize) -> u64 {
+    (LVL_SIZE as u64 - 1) << ((n as u32 - 1) * LVL_CLK_SHIFT)
+}
+
+/// 超过最高层的延迟截短到 WHEEL_TIMEOUT_MAX
+const WHEEL_TIMEOUT_CUTOFF: u64 = lvl_start(LVL_DEPTH);
+const WHEEL_TIMEOUT_MAX: u64 = WHEEL_TIMEOUT_CUTOFF - lvl_gran(LVL_DEPTH - 1);
+
+/// schedule_timeout 不设超时 (MAX_SCHEDULE_TIMEOUT)
+pub const MAX_SCHEDULE_TIMEOUT: u64 = u64::MAX;
+
+/// 定时器到期回调，在软中断中执行，不能睡眠
+pub type TimerFunc = fn(&TimerList);
+
+/// 时间轮定时器 (struct timer_list)
+///
+/// 挂起期间定时器不能移动；释放时自动删除
+pub struct TimerList {
+    /// 桶内链表 (hlist_node)，pprev 为空表示未挂起
+    next: UnsafeCell<*const TimerList>,
+    pprev: UnsafeCell<*mut *const TimerList>,
+    /// 所在的桶
+    idx: UnsafeCell<usize>,
+    /// 到期的 jiffies
+    expires: UnsafeCell<u64>,
+    /// 所在的时间轮，挂起或正在执行时有效
+    base: AtomicPtr<Mutex<TimerBase>>,
+    function: TimerFunc,
+    data: usize,
+}
+
+// 链表字段只在所属时间轮的锁内访问
+unsafe impl Send for TimerList {}
+unsafe impl Sync for TimerList {}
+
+impl TimerList {
+    /// 创建定时器 (timer_setup)
+    pub const fn new(function: TimerFunc, data: usize) -> Self {
+        Self {
+            next: UnsafeCell::new(ptr::null()),
+            pprev: UnsafeCell::new(ptr::null_mut()),
+            idx: UnsafeCell::new(0),
+            expires: UnsafeCell::new(0),
+            base: AtomicPtr::new(ptr::null_mut()),
+            function,
+            data,
+        }
+    }
+
+    /// 创建时传入的私有数据
+    #[inline]
+    pub fn data(&self) -> usize {
+        self.data
+    }
+
+    /// 最近一次设置的到期时间
+    #[inline]
+    pub fn expires(&self) -> u64 {
+        unsafe { *self.expires.get() }
+    }
+}
+
+impl Drop for TimerList {
+    fn drop(&mut self) {
+        del_timer_sync(self);
+    }
+}
+
+/// 每个 CPU 的时间轮 (struct timer_base)
+pub struct TimerBase {
+    /// 下一个要处理的 jiffy
+    clk: u64,
+    /// 最早的桶到期时间，可能偏早但不会偏晚
+    next_expiry: u64,
+    /// 正在执行回调的定时器
+    running: *const TimerList,
+    /// 挂起的定时器数
+    nr_pending: usize,
+    /// 每层一个位图，标记非空的桶
+    pending_map: [u64; LVL_DEPTH],
+    vectors: [*const TimerList; WHEEL_SIZE],
+}
+
+unsafe impl Send for TimerBase {}
+
+impl TimerBase {
+    pub const fn new() -> Self {
+        Self {
+            clk: 0,
+            next_expiry: u64::MAX,
+            running: ptr::null(),
+            nr_pending: 0,
+            pending_map: [0; LVL_DEPTH],
+            vectors: [ptr::null(); WHEEL_SIZE],
+        }
+    }
+
+    /// 挂起的定时器数
+    #[inline]
+    pub fn nr_pending(&self) -> usize {
+        self.nr_pending
+    }
+
+    /// 挂入到期时间对应的桶 (enqueue_timer)
+    unsafe fn enqueue(&mut self, timer: &TimerList, expires: u64) {
+        let (idx, bucket_expiry) = calc_wheel_index(expires, self.clk);
+        *timer.expires.get() = expires;
+        *timer.idx.get() = idx;
+
+        // hlist_add_head
+        let head = &mut self.vectors[idx] as *mut *const TimerList;
+        let first = *head;
+        *timer.next.get() = first;
+        if !first.is_null() {
+            *(*first).pprev.get() = timer.next.get();
+        }
+        *head = timer;
+        *timer.pprev.get() = head;
+
+        self.pending_map[idx / LVL_SIZE] |= 1 << (idx % LVL_SIZE);
+        self.nr_pending += 1;
+        if bucket_expiry < self.next_expiry {
+            self.next_expiry = bucket_expiry;
+        }
+    }
+
+    /// 从桶或待执行链表上摘下 (detach_if_pending)
+    unsafe fn detach(&mut self, timer: &TimerList) -> bool {
+        let pprev = *timer.pprev.get();
+        if pprev.is_null() {
+            return false;
+        }
+        let next = *timer.next.get();
+        *pprev = next;
+        if !next.is_null() {
+            *(*next).pprev.get() = pprev;
+        }
+        *timer.next.get() = ptr::null();
+        *timer.pprev.get() = ptr::null_mut();
+
+        let idx = *timer.idx.get();
+        if self.vectors[idx].is_null() {
+            self.pending_map[idx / LVL_SIZE] &= !(1 << (idx % LVL_SIZE));
+        }
+        self.nr_pending -= 1;
+        true
+    }
+
+    /// 把 clk 时刻到期的桶移到 heads (collect_expired_timers)
+    ///
+    /// 第 n+1 层只在第 n 层的位置回绕到 0 时检查
+    unsafe fn collect_expired(&mut self, heads: &mut [*const TimerList; LVL_DEPTH]) -> usize {
+        let mut clk = self.clk;
+        let mut levels = 0;
+        for lvl in 0..LVL_DEPTH {
+            let pos = (clk & LVL_MASK) as usize;
+            if self.pending_map[lvl] & (1 << pos) != 0 {
+                self.pending_map[lvl] &= !(1 << pos);
+                let idx = lvl * LVL_SIZE + pos;
+                // hlist_move_list
+                let first = self.vectors[idx];
+                self.vectors[idx] = ptr::null();
+                heads[levels] = first;
+                *(*first).pprev.get() = &mut heads[levels];
+                levels += 1;
+            }
+            if clk & LVL_CLK_MASK != 0 {
+                break;
+            }
+            clk >>= LVL_CLK_SHIFT;
+        }
+        levels
+    }
+
+    /// 重新计算最早的桶到期时间 (__next_timer_interrupt)
+    fn scan_next_expiry(&self) -> u64 {
+        let mut next = u64::MAX;
+        for lvl in 0..LVL_DEPTH {
+            let map = self.pending_map[lvl];
+            if map == 0 {
+                continue;
+            }
+            let shift = lvl_shift(lvl);
+            let lvl_clk = self.clk >> shift;
+            // 从当前位置开始的第一个非空桶
+            let dist = map.rotate_right((lvl_clk & LVL_MASK) as u32).trailing_zeros() as u64;
+            let mut bucket = lvl_clk + dist;
+            // 当前位置的桶在本轮已经处理过，只能等下一轮
+            if bucket << shift < self.clk {
+                bucket += LVL_SIZE as u64;
+            }
+            next = next.min(bucket << shift);
+        }
+        next
+    }
+}
+
+/// 计算到期时间所在的层和桶，以及桶的到期时间 (calc_wheel_index)
+fn calc_wheel_index(expires: u64, clk: u64) -> (usize, u64) {
+    if expires < clk {
+        // 已经过期：放到下一个要处理的桶
+        return ((clk & LVL_MASK) as usize, clk);
+    }
+    let mut expires = expires;
+    let mut delta = expires - clk;
+    if delta >= WHEEL_TIMEOUT_CUTOFF {
+        expires = clk + WHEEL_TIMEOUT_MAX;
+        delta = WHEEL_TIMEOUT_MAX;
+    }
+    let mut lvl = 0;
+    while lvl < LVL_DEPTH - 1 && delta >= lvl_start(lvl + 1) {
+        lvl += 1;
+    }
+    // 向上取整到本层粒度 (calc_index)
+    let shift = lvl_shift(lvl);
+    let bucket = (expires + lvl_gran(lvl) - 1) >> shift;
+    (lvl * LVL_SIZE + (bucket & LVL_MASK) as usize, bucket << shift)
+}
+
+/// 每个 CPU 的时间轮 (timer_bases)
+static TIMER_BASES: [Mutex<TimerBase>; MAX_CPUS] = [const { Mutex::new(TimerBase::new()) }; MAX_CPUS];
+
+/// 当前 CPU 的时间轮
+#[inline]
+fn this_cpu_base() -> &'static Mutex<TimerBase> {
+    let cpu = crate::arch::cpu_id() as usize;
+    &TIMER_BASES[cpu.min(MAX_CPUS - 1)]
+}
+
+/// 锁住定时器所在的时间轮 (lock_timer_base)
+///
+/// 定时器可能同时被迁移到其他时间轮，加锁后再确认一次
+fn lock_timer_base(timer: &TimerList) -> Option<spin::MutexGuard<'static, TimerBase>> {
+    loop {
+        let base = timer.base.load(Ordering::Acquire);
+        if base.is_null() {
+            return None;
+        }
+        let guard = unsafe { (*base).lock() };
+        if timer.base.load(Ordering::Acquire) == base {
+            return Some(guard);
+        }
+    }
+}
+
+/// 定时器是否挂起 (timer_pending)
+#[inline]
+pub fn timer_pending(timer: &TimerList) -> bool {
+    unsafe { !(*timer.pprev.get()).is_null() }
+}
+
+/// 在指定时间轮上（重新）设置定时器 (__mod_timer)
+///
+/// 时间轮必须比挂在上面的定时器存活得更久
+///
+/// # 返回
+/// 修改前定时器是否挂起
+pub fn mod_timer_on(base: &Mutex<TimerBase>, timer: &TimerList, expires: u64) -> bool {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let pending = match lock_timer_base(timer) {
+        Some(mut old) => unsafe { old.detach(timer) },
+        None => false,
+    };
+    let mut guard = base.lock();
+    // 空闲期间 clk 可能已经落后很多，在最早的桶到期之前可以直接前移 (forward_timer_base)
+    if guard.nr_pending == 0 {
+        guard.next_expiry = u64::MAX;
+    }
+    let jnow = get_jiffies();
+    if guard.clk < jnow {
+        guard.clk = jnow.min(guard.next_expiry.max(guard.clk));
+    }
+    timer.base.store(base as *const _ as *mut _, Ordering::Release);
+    unsafe { guard.enqueue(timer, expires) };
+    pending
+}
+
+/// 在当前 CPU 上设置定时器 (mod_timer)
+///
+/// # 返回
+/// 修改前定时器是否挂起
+pub fn mod_timer(timer: &TimerList, expires: u64) -> bool {
+    mod_timer_on(this_cpu_base(), timer, expires)
+}
+
+/// 启动未挂起的定时器 (add_timer)
+pub fn add_timer(timer: &TimerList, expires: u64) {
+    mod_timer(timer, expires);
+}
+
+/// 删除定时器，不等待正在执行的回调 (del_timer)
+///
+/// # 返回
+/// 删除前定时器是否挂起
+pub fn del_timer(timer: &TimerList) -> bool {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    match lock_timer_base(timer) {
+        Some(mut base) => unsafe { base.detach(timer) },
+        None => false,
+    }
+}
+
+/// 删除定时器并等待正在执行的回调结束 (del_timer_sync)
+///
+/// 不能在定时器自己的回调中调用
+pub fn del_timer_sync(timer: &TimerList) -> bool {
+    let mut pending = false;
+    loop {
+        {
+            let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+            let mut base = match lock_timer_base(timer) {
+                Some(base) => base,
+                None => return pending,
+            };
+            pending |= unsafe { base.detach(timer) };
+            if !ptr::eq(base.running, timer) {
+                return pending;
+            }
+        }
+        core::hint::spin_loop();
+    }
+}
+
+/// 执行时间轮上到 now 为止到期的定时器 (__run_timers)
+///
+/// 回调执行时不持有时间轮的锁，可以重新设置自己
+pub fn run_timers_on(base: &Mutex<TimerBase>, now: u64) {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let mut guard = base.lock();
+    while guard.clk <= now {
+        // 跳过没有桶到期的 jiffies
+        if guard.next_expiry > now {
+            guard.clk = now + 1;
+            break;
+        }
+        if guard.next_expiry > guard.clk {
+            guard.clk = guard.next_expiry;
+        }
+
+        let mut heads = [ptr::null(); LVL_DEPTH];
+        let levels = unsafe { guard.collect_expired(&mut heads) };
+        guard.clk += 1;
+        guard.next_expiry = guard.scan_next_expiry();
+
+        // expire_timers
+        let heads = heads.as_mut_ptr();
+        for lvl in 0..levels {
+            let head = unsafe { heads.add(lvl) };
+            while unsafe { !(*head).is_null() } {
+                let timer = unsafe { &**head };
+                unsafe { guard.detach(timer) };
+                guard.running = timer;
+                drop(guard);
+                (timer.function)(timer);
+                guard = base.lock();
+                guard.running = ptr::null();
+            }
+        }
+    }
+}
+
+/// 时间轮上最早的桶到期时间，可能偏早；没有定时器时返回 None
+pub fn next_expiry_on(base: &Mutex<TimerBase>) -> Option<u64> {
+    let _irq = unsafe { crate::arch::context::InterruptGuard::new() };
+    let base = base.lock();
+    if base.nr_pending == 0 {
+        None
+    } else {
+        Some(base.next_expiry)
+    }
+}
+
+/// 当前 CPU 上最早的定时器到期时间 (get_next_timer_interrupt)
+pub fn next_timer_interrupt() -> Option<u64> {
+    next_expiry_on(this_cpu_base())
+}
+
+/// 时钟 tick 中检查当前 CPU 是否有到期的定时器 (run_local_timers)
+pub fn run_local_timers() {
+    let expired = this_cpu_base().lock().next_expiry <= get_jiffies();
+    if expired {
+        crate::softirq::raise_softirq(crate::softirq::TIMER_SOFTIRQ);
+    }
+}
+
+/// TIMER_SOFTIRQ 处理函数 (run_timer_softirq)
+pub fn run_timer_softirq() {
+    run_timers_on(this_cpu_base(), get_jiffies());
+}
+
+/// 唤醒 schedule_timeout 中睡眠的任务 (process_timeout)
+fn process_timeout(timer: &TimerList) {
+    crate::sched::wake_up_process(timer.data() as *mut crate::process::Task);
+}
+
+/// 睡眠到被唤醒或超时 (schedule_timeout)
+///
+/// 调用前先设置好当前任务的睡眠状态；超时后任务被唤醒
+///
+/// # 参数
+/// - timeout: 超时的 jiffies 数，MAX_SCHEDULE_TIMEOUT 表示不设超时
+///
+/// # 返回
+/// 剩余的 jiffies，超时返回 0
+pub fn schedule_timeout(timeout: u64) -> u64 {
+    if timeout == MAX_SCHEDULE_TIMEOUT {
+        crate::sched::schedule();
+        return timeout;
+    }
+    let task = match crate::sched::current() {
+        Some(task) => task as *mut crate::process::Task,
+        None => return 0,
+    };
+    let expire = get_jiffies().saturating_add(timeout);
+    let timer = TimerList::new(process_timeout, task as usize);
+    mod_timer(&timer, expire);
+    crate::sched::schedule();
+    del_timer_sync(&timer);
+    expire.saturating_sub(get_jiffies())
+}
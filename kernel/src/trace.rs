@@ -0,0 +1,168 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 跟踪点 (tracepoint)
+//!
+//! 参考 Linux: include/linux/tracepoint.h, kernel/trace/trace_events.c
+//!
+//! 调试输出编译进内核，但默认关闭：
+//! - 关闭时只有一次 Relaxed 原子读和一个预测为不跳转的分支，
+//!   参数不会被求值，也不会获取 UART 锁
+//! - 输出路径放在冷函数中，不膨胀热路径的指令缓存
+//!
+//! 开启方式：
+//! - 启动参数: `trace_event=sched_switch,syscall`（`trace_event=all` 开启全部）
+//! - 运行时: 向 /proc/tracepoints 写入 `<name> 1` 或 `<name> 0`
+//!
+//! 使用方式：
+//! ```no_run
+//! tracepoint!(SCHED_SWITCH, "prev={} next={}", prev_pid, next_pid);
+//! ```
+//!
+//! 需要低开销、不经过控制台的记录时使用 ring_buffer 的 trace_record!
+
+pub mod ring_buffer;
+
+use alloc::string::String;
+use core::fmt;
+use core::sync::atomic::{AtomicBool, Ordering};
+
+/// 跟踪点
+pub struct Tracepoint {
+    /// 名称（用于启动参数和 /proc/tracepoints）
+    name: &'static str,
+    /// 是否开启（static key）
+    enabled: AtomicBool,
+}
+
+impl Tracepoint {
+    pub const fn new(name: &'static str) -> Self {
+        Self {
+            name,
+            enabled: AtomicBool::new(false),
+        }
+    }
+
+    #[inline]
+    pub fn name(&self) -> &'static str {
+        self.name
+    }
+
+    /// 跟踪点是否开启 (static_key_false)
+    #[inline(always)]
+    pub fn enabled(&self) -> bool {
+        self.enabled.load(Ordering::Relaxed)
+    }
+
+    #[inline]
+    pub fn set_enabled(&self, on: bool) {
+        self.enabled.store(on, Ordering::Relaxed);
+    }
+}
+
+/// 进程切换 (__schedule)
+pub static SCHED_SWITCH: Tracepoint = Tracepoint::new("sched_switch");
+/// 进程睡眠与唤醒 (Task::sleep)
+pub static SCHED_SLEEP: Tracepoint = Tracepoint::new("sched_sleep");
+/// 唤醒时把任务迁移到其他 CPU (sched_migrate_task)
+pub static SCHED_MIGRATE: Tracepoint = Tracepoint::new("sched_migrate_task");
+/// wait4 查找和回收子进程 (do_wait)
+pub static SCHED_WAIT: Tracepoint = Tracepoint::new("sched_wait");
+/// 系统调用参数和错误路径
+pub static SYSCALL: Tracepoint = Tracepoint::new("syscall");
+
+/// 所有跟踪点
+static TRACEPOINTS: [&Tracepoint; 5] = [
+    &SCHED_SWITCH,
+    &SCHED_SLEEP,
+    &SCHED_MIGRATE,
+    &SCHED_WAIT,
+    &SYSCALL,
+];
+
+/// 输出一条跟踪记录（冷路径）
+#[cold]
+#[inline(never)]
+pub fn emit(tp: &Tracepoint, args: fmt::Arguments) {
+    let mut console = crate::print::Console;
+    let _ = fmt::Write::write_fmt(&mut console, format_args!("[{}] {}\n", tp.name, args));
+}
+
+/// 触发跟踪点
+///
+/// 跟踪点关闭时不会求值格式化参数
+#[macro_export]
+macro_rules! tracepoint {
+    ($tp:ident, $($arg:tt)*) => ({
+        if $crate::trace::$tp.enabled() {
+            $crate::trace::emit(&$crate::trace::$tp, ::core::format_args!($($arg)*));
+        }
+    });
+}
+
+/// 按名称开启或关闭跟踪点，`all` 表示全部
+///
+/// # 返回
+/// 名称不存在时返回 false
+pub fn set_enabled(name: &str, on: bool) -> bool {
+    let mut found = false;
+    for tp in TRACEPOINTS.iter() {
+        if name == "all" || tp.name == name {
+            tp.set_enabled(on);
+            found = true;
+        }
+    }
+    found
+}
+
+/// 根据启动参数 `trace_event=` 开启跟踪点，`trace_buf=` 开启二进制跟踪记录
+pub fn init() {
+    ring_buffer::init();
+    if let Some(list) = crate::cmdline::get_param("trace_event") {
+        for name in list.split(',').filter(|s| !s.is_empty()) {
+            if !set_enabled(name, true) {
+                crate::println!("trace: unknown tracepoint '{}'", name);
+            }
+        }
+    }
+}
+
+/// 生成 /proc/tracepoints 内容：每行 `<name> <0|1>`
+pub fn generate_list() -> String {
+    let mut out = String::new();
+    for tp in TRACEPOINTS.iter() {
+        out.push_str(tp.name);
+        out.push_str(if tp.enabled() { " 1\n" } else { " 0\n" });
+    }
+    out
+}
+
+/// 处理写入 /proc/tracepoints 的命令
+///
+/// 每行格式为 `<name> <0|1>`，`<name>` 可以是 `all`
+///
+/// # 返回
+/// 成功返回写入的字节数，格式错误返回 -EINVAL
+pub fn write_control(data: &[u8]) -> Result<usize, i32> {
+    let text = core::str::from_utf8(data)
+        .map_err(|_| crate::errno::Errno::InvalidArgument.as_neg_i32())?;
+
+    for line in text.lines() {
+        let mut parts = line.split_whitespace();
+        let name = match parts.next() {
+            Some(n) => n,
+            None => continue,
+        };
+        let on = match parts.next() {
+            Some("1") => true,
+            Some("0") => false,
+            _ => return Err(crate::errno::Errno::InvalidArgument.as_neg_i32()),
+        };
+        if !set_enabled(name, on) {
+            return Err(crate::errno::Errno::InvalidArgument.as_neg_i32());
+        }
+    }
+    Ok(data.len())
+}
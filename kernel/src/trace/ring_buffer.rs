@@ -0,0 +1,358 @@
+//! MIT License
+//!
+//! Copyright (c) 2026 Fei Wang
+//!
+
+//! 二进制跟踪环形缓冲区 (ring_buffer)
+//!
+//! 参考 Linux: kernel/trace/ring_buffer.c, include/trace/events/
+//!
+//! tracepoint! 的文本输出要格式化并获取 UART 锁，会改变被观察的时序、让各 hart 互相等待。
+//! 这里的跟踪记录是定长的二进制结构，写入本 CPU 的环形缓冲区，不加锁：
+//! - 写者用原子 fetch_add 预留槽位，中断中嵌套写入也只会拿到不同的槽位
+//! - 每个槽位有序号：写入前清零，写完置为 `位置 + 1`；读者前后两次读到相同且匹配的
+//!   序号才接受记录，写到一半或已被覆盖的槽位会被识别出来
+//! - 缓冲区满后覆盖最旧的记录，写者从不等待读者
+//!
+//! 时间戳是 time CSR 的原始值 (rdtime，频率 CLOCK_FREQ)，各 hart 共用同一个时钟源，
+//! 合并各 CPU 的记录时可以直接比较。
+//!
+//! 开启方式：
+//! - 启动参数: `trace_buf=sched_switch,sys_enter`（`trace_buf=all` 开启全部）
+//! - 运行时: 向 /proc/trace_events 写入 `<name> 1` / `<name> 0`，`reset` 丢弃未读的记录
+//!
+//! 读取：/proc/trace_pipe_raw 每次读取返回上次读取之后的新记录（按时间排序的
+//! TraceEntry 数组，本机字节序），读取不会暂停写者；被覆盖而丢失的记录用一条
+//! TRACE_LOST 记录表示，data[0] 是丢失的条数
+
+use alloc::string::String;
+use alloc::vec::Vec;
+use core::cell::UnsafeCell;
+use core::fmt::Write;
+use core::sync::atomic::{fence, AtomicU32, AtomicU64, Ordering};
+use spin::Mutex;
+
+use crate::config::MAX_CPUS;
+
+/// 每个 CPU 的槽位数，必须是 2 的幂
+pub const TRACE_RING_SIZE: usize = 2048;
+
+/// 事件编号
+/// 丢失记录，data[0] 为条数（只出现在读出的流中）
+pub const TRACE_LOST: u16 = 0;
+/// 任务切换，data = [prev pid, next pid, prev state]
+pub const TRACE_SCHED_SWITCH: u16 = 1;
+/// 系统调用入口，data = [调用号, a0, a1]
+pub const TRACE_SYS_ENTER: u16 = 2;
+/// 系统调用返回，data = [调用号, 返回值, 0]
+pub const TRACE_SYS_EXIT: u16 = 3;
+/// 缺页异常，data = [地址, sepc, scause | (用户态 << 63)]
+pub const TRACE_PAGE_FAULT: u16 = 4;
+/// 块设备请求下发，data = [起始扇区, 字节数, 命令 (0 读 1 写 2 刷新)]
+pub const TRACE_BLOCK_RQ: u16 = 5;
+/// 收到以太网帧，data = [长度, 以太网协议, 0]
+pub const TRACE_NET_RX: u16 = 6;
+/// 发送以太网帧，data = [长度, 以太网协议, 0]
+pub const TRACE_NET_TX: u16 = 7;
+
+/// 事件名，下标是事件编号
+const EVENT_NAMES: [&str; 8] = [
+    "lost",
+    "sched_switch",
+    "sys_enter",
+    "sys_exit",
+    "page_fault",
+    "block_rq",
+    "net_rx",
+    "net_tx",
+];
+
+/// 一条跟踪记录，40 字节
+#[repr(C)]
+#[derive(Debug, Clone, Copy, Default, PartialEq, Eq)]
+pub struct TraceEntry {
+    /// time CSR 的值
+    pub ts: u64,
+    /// 事件编号 (TRACE_*)
+    pub event: u16,
+    /// 写入记录的 CPU
+    pub cpu: u16,
+    /// 当时在该 CPU 上运行的任务
+    pub pid: u32,
+    /// 事件相关的数据
+    pub data: [u64; 3],
+}
+
+/// 环中的一个槽位
+struct TraceSlot {
+    /// 0 表示正在写入，否则是写入时的位置 + 1
+    seq: AtomicU64,
+    entry: UnsafeCell<TraceEntry>,
+}
+
+/// 一个 CPU 的环形缓冲区 (ring_buffer_per_cpu)
+struct TraceRing {
+    /// 预留过的记录总数，下一条写在 head % TRACE_RING_SIZE
+    head: AtomicU64,
+    slots: [TraceSlot; TRACE_RING_SIZE],
+}
+
+// 槽位的内容由序号保护，见模块说明
+unsafe impl Sync for TraceRing {}
+
+impl TraceRing {
+    const fn new() -> Self {
+        Self {
+            head: AtomicU64::new(0),
+            slots: [const {
+                TraceSlot {
+                    seq: AtomicU64::new(0),
+                    entry: UnsafeCell::new(TraceEntry { ts: 0, event: 0, cpu: 0, pid: 0, data: [0; 3] }),
+                }
+            }; TRACE_RING_SIZE],
+        }
+    }
+
+    /// 读取位置 pos 的记录
+    fn read(&self, pos: u64) -> SlotRead {
+        let slot = &self.slots[pos as usize % TRACE_RING_SIZE];
+        let seq = slot.seq.load(Ordering::Acquire);
+        if seq > pos + 1 {
+            return SlotRead::Overwritten;
+        }
+        if seq != pos + 1 {
+            return SlotRead::Pending;
+        }
+        let entry = unsafe { core::ptr::read_volatile(slot.entry.get()) };
+        fence(Ordering::Acquire);
+        if slot.seq.load(Ordering::Relaxed) != seq {
+            // 复制期间被新的记录覆盖
+            return SlotRead::Overwritten;
+        }
+        SlotRead::Entry(entry)
+    }
+}
+
+enum SlotRead {
+    Entry(TraceEntry),
+    /// 已预留但还没写完
+    Pending,
+    Overwritten,
+}
+
+static RINGS: [TraceRing; MAX_CPUS] = [const { TraceRing::new() }; MAX_CPUS];
+
+/// 开启的事件，第 n 位对应事件 n
+static EVENT_MASK: AtomicU32 = AtomicU32::new(0);
+
+/// 事件是否开启
+#[inline(always)]
+pub fn event_enabled(event: u16) -> bool {
+    EVENT_MASK.load(Ordering::Relaxed) & (1 << event) != 0
+}
+
+/// 写入一条记录 (ring_buffer_lock_reserve + ring_buffer_unlock_commit)
+///
+/// 可以在任何上下文调用，包括中断和持有运行队列锁时
+#[inline(never)]
+pub fn record(event: u16, data: [u64; 3]) {
+    let cpu = crate::arch::cpu_id() as usize;
+    if cpu >= MAX_CPUS {
+        return;
+    }
+    let ring = &RINGS[cpu];
+    let pos = ring.head.fetch_add(1, Ordering::Relaxed);
+    let slot = &ring.slots[pos as usize % TRACE_RING_SIZE];
+    slot.seq.store(0, Ordering::Relaxed);
+    fence(Ordering::Release);
+    let entry = TraceEntry {
+        ts: crate::drivers::timer::read_time(),
+        event,
+        cpu: cpu as u16,
+        pid: crate::sched::sched::cpu_curr_pid(),
+        data,
+    };
+    unsafe { core::ptr::write_volatile(slot.entry.get(), entry) };
+    slot.seq.store(pos + 1, Ordering::Release);
+}
+
+/// 写入跟踪记录，事件关闭时不求值参数
+///
+/// ```no_run
+/// trace_record!(TRACE_SCHED_SWITCH, prev_pid, next_pid, prev_state);
+/// ```
+#[macro_export]
+macro_rules! trace_record {
+    ($event:ident, $a:expr, $b:expr, $c:expr) => ({
+        if $crate::trace::ring_buffer::event_enabled($crate::trace::ring_buffer::$event) {
+            $crate::trace::ring_buffer::record(
+                $crate::trace::ring_buffer::$event,
+                [($a) as u64, ($b) as u64, ($c) as u64],
+            );
+        }
+    });
+}
+
+/// 各 CPU 的读取位置 (ring_buffer_iter)
+///
+/// 每个读者从自己的位置继续读，互不影响，也不影响写者
+pub struct TraceReader {
+    pos: [u64; MAX_CPUS],
+}
+
+impl TraceReader {
+    /// 从各 CPU 当前的最新位置开始读
+    pub fn new() -> Self {
+        let mut pos = [0; MAX_CPUS];
+        for (cpu, ring) in RINGS.iter().enumerate() {
+            pos[cpu] = ring.head.load(Ordering::Acquire);
+        }
+        Self { pos }
+    }
+
+    /// 从缓冲区中最旧的记录开始读
+    pub const fn from_start() -> Self {
+        Self { pos: [0; MAX_CPUS] }
+    }
+
+    /// 读出上次之后的新记录，按时间排序
+    ///
+    /// 每个 CPU 读到第一条还没写完的记录为止，下次从那里继续；
+    /// 被覆盖的记录合计为一条 TRACE_LOST 放在最前面
+    pub fn read(&mut self) -> Vec<TraceEntry> {
+        let mut entries = Vec::new();
+        let mut lost = 0;
+        for (cpu, ring) in RINGS.iter().enumerate() {
+            let head = ring.head.load(Ordering::Acquire);
+            let oldest = head.saturating_sub(TRACE_RING_SIZE as u64);
+            let mut pos = self.pos[cpu].max(oldest);
+            lost += pos - self.pos[cpu];
+            while pos < head {
+                match ring.read(pos) {
+                    SlotRead::Entry(entry) => entries.push(entry),
+                    SlotRead::Overwritten => lost += 1,
+                    SlotRead::Pending => break,
+                }
+                pos += 1;
+            }
+            self.pos[cpu] = pos;
+        }
+        entries.sort_by_key(|entry| entry.ts);
+        if lost != 0 {
+            let ts = entries.first().map_or(0, |entry| entry.ts);
+            entries.insert(0, TraceEntry { ts, event: TRACE_LOST, cpu: 0, pid: 0, data: [lost, 0, 0] });
+        }
+        entries
+    }
+}
+
+/// /proc/trace_pipe_raw 的读取位置
+static PIPE_READER: Mutex<TraceReader> = Mutex::new(TraceReader::from_start());
+
+/// 把记录编码为 /proc/trace_pipe_raw 的字节流
+pub fn encode(entries: &[TraceEntry]) -> Vec<u8> {
+    let size = core::mem::size_of::<TraceEntry>();
+    let mut out = Vec::with_capacity(entries.len() * size);
+    for entry in entries {
+        let bytes = unsafe { core::slice::from_raw_parts(entry as *const TraceEntry as *const u8, size) };
+        out.extend_from_slice(bytes);
+    }
+    out
+}
+
+/// 生成 /proc/trace_pipe_raw 内容：上次读取之后的新记录 (tracing_buffers_read)
+pub fn generate_pipe_raw() -> Vec<u8> {
+    let entries = PIPE_READER.lock().read();
+    encode(&entries)
+}
+
+/// 丢弃 /proc/trace_pipe_raw 还没读出的记录 (ring_buffer_reset)
+///
+/// 只移动读取位置，写者不受影响
+pub fn reset() {
+    *PIPE_READER.lock() = TraceReader::new();
+}
+
+/// 按名称开启或关闭事件，`all` 表示全部
+///
+/// # 返回
+/// 名称不存在时返回 false
+pub fn set_event_enabled(name: &str, on: bool) -> bool {
+    let mut mask = 0;
+    for (event, event_name) in EVENT_NAMES.iter().enumerate().skip(1) {
+        if name == "all" || *event_name == name {
+            mask |= 1 << event;
+        }
+    }
+    if mask == 0 {
+        return false;
+    }
+    if on {
+        EVENT_MASK.fetch_or(mask, Ordering::Relaxed);
+    } else {
+        EVENT_MASK.fetch_and(!mask, Ordering::Relaxed);
+    }
+    true
+}
+
+/// 根据启动参数 `trace_buf=` 开启事件
+pub fn init() {
+    if let Some(list) = crate::cmdline::get_param("trace_buf") {
+        for name in list.split(',').filter(|s| !s.is_empty()) {
+            if !set_event_enabled(name, true) {
+                crate::println!("trace: unknown trace event '{}'", name);
+            }
+        }
+    }
+}
+
+/// 生成 /proc/trace_events 内容
+///
+/// 第一行是注释：记录大小、每个 CPU 的槽位数和写入过的记录总数；之后每行 `<name> <0|1>`
+pub fn generate_events() -> String {
+    let written: u64 = RINGS.iter().map(|ring| ring.head.load(Ordering::Relaxed)).sum();
+    let mut out = String::new();
+    let _ = writeln!(
+        out,
+        "# entry_size {} ring_size {} written {}",
+        core::mem::size_of::<TraceEntry>(),
+        TRACE_RING_SIZE,
+        written
+    );
+    for (event, name) in EVENT_NAMES.iter().enumerate().skip(1) {
+        let _ = writeln!(out, "{} {}", name, event_enabled(event as u16) as u8);
+    }
+    out
+}
+
+/// 处理写入 /proc/trace_events 的命令
+///
+/// 每行为 `<name> <0|1>`（`<name>` 可以是 `all`）或 `reset`
+///
+/// # 返回
+/// 成功返回写入的字节数，格式错误返回 -EINVAL
+pub fn write_control(data: &[u8]) -> Result<usize, i32> {
+    let text = core::str::from_utf8(data)
+        .map_err(|_| crate::errno::Errno::InvalidArgument.as_neg_i32())?;
+
+    for line in text.lines() {
+        let mut parts = line.split_whitespace();
+        let name = match parts.next() {
+            Some(n) => n,
+            None => continue,
+        };
+        if name == "reset" {
+            reset();
+            continue;
+        }
+        let on = match parts.next() {
+            Some("1") => true,
+            Some("0") => false,
+            _ => return Err(crate::errno::Errno::InvalidArgument.as_neg_i32()),
+        };
+        if !set_event_enabled(name, on) {
+            return Err(crate::errno::Errno::InvalidArgument.as_neg_i32());
+        }
+    }
+    Ok(data.len())
+}
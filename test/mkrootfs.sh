@@ -18,6 +18,10 @@ MOUNT_POINT="$PROJECT_ROOT/test/rootfs_mnt"
 SHELL_BINARY="$PROJECT_ROOT/userspace/shell/shell"
 DESKTOP_BINARY="$PROJECT_ROOT/userspace/target/riscv64gc-unknown-none-elf/release/desktop"
 TOYBOX_BINARY="$PROJECT_ROOT/userspace/toybox/toybox/toybox"
+BENCH_BINARY="$PROJECT_ROOT/userspace/bench/rbench"
+RFIO_BINARY="$PROJECT_ROOT/userspace/bench/rfio"
+RFIO_PROFILE="$PROJECT_ROOT/userspace/bench/profiles/ext4.rfio"
+RNET_BINARY="$PROJECT_ROOT/userspace/bench/rnet"
 
 echo "========================================"
 echo "Building ext4 rootfs image"
@@ -82,7 +86,7 @@ if [ -f "$TOYBOX_BINARY" ]; then
 
     # 创建常用命令符号链接
     echo "Creating toybox symlinks for common commands..."
-    TOYBOX_COMMANDS="ls cat echo mkdir rm cp mv ln chmod chown pwd true false test date sleep head tail wc sort uniq grep sed awk tr cut basename dirname realpath touch du df free uname hostname id whoami env printenv yes tee"
+    TOYBOX_COMMANDS="ls cat echo mkdir rm cp mv ln chmod chown pwd true false test date sleep head tail wc sort uniq grep sed awk tr cut basename dirname realpath touch du df free uname hostname id whoami env printenv yes tee taskset nproc"
     (
         cd "$MOUNT_POINT/bin"
         for cmd in $TOYBOX_COMMANDS; do
@@ -97,6 +101,38 @@ else
     echo "  Run 'make toybox' to build toybox first"
 fi
 
+# 安装 rbench 基准测试（如果存在）及其文件读测试数据
+if [ -f "$BENCH_BINARY" ]; then
+    echo "Installing rbench to /bin/rbench..."
+    sudo cp "$BENCH_BINARY" "$MOUNT_POINT/bin/rbench"
+    sudo chmod +x "$MOUNT_POINT/bin/rbench"
+    sudo mkdir -p "$MOUNT_POINT/bench"
+    sudo dd if=/dev/urandom of="$MOUNT_POINT/bench/data" bs=1M count=4 2>/dev/null
+else
+    echo "Warning: rbench not found at $BENCH_BINARY (skipping)"
+    echo "  Run 'make -C userspace/bench' to build it first"
+fi
+
+# 安装 rfio 文件系统基准测试及其任务文件（如果存在）
+if [ -f "$RFIO_BINARY" ]; then
+    echo "Installing rfio to /bin/rfio..."
+    sudo cp "$RFIO_BINARY" "$MOUNT_POINT/bin/rfio"
+    sudo chmod +x "$MOUNT_POINT/bin/rfio"
+    sudo mkdir -p "$MOUNT_POINT/bench"
+    sudo cp "$RFIO_PROFILE" "$MOUNT_POINT/bench/ext4.rfio"
+else
+    echo "Warning: rfio not found at $RFIO_BINARY (skipping)"
+fi
+
+# 安装 rnet 网络基准测试（如果存在）
+if [ -f "$RNET_BINARY" ]; then
+    echo "Installing rnet to /bin/rnet..."
+    sudo cp "$RNET_BINARY" "$MOUNT_POINT/bin/rnet"
+    sudo chmod +x "$MOUNT_POINT/bin/rnet"
+else
+    echo "Warning: rnet not found at $RNET_BINARY (skipping)"
+fi
+
 # 创建一些基本的设备节点（如果 mknod 可用）
 if command -v mknod &> /dev/null; then
     echo "Creating device nodes..."
@@ -120,6 +156,8 @@ echo "========================================"
 [ -f "$SHELL_BINARY" ] && echo "Shell:       $(stat -c%s "$SHELL_BINARY" 2>/dev/null || stat -f%z "$SHELL_BINARY") bytes"
 [ -f "$DESKTOP_BINARY" ] && echo "Desktop:       $(stat -c%s "$DESKTOP_BINARY" 2>/dev/null || stat -f%z "$DESKTOP_BINARY") bytes"
 [ -f "$TOYBOX_BINARY" ] && echo "Toybox:        $(stat -c%s "$TOYBOX_BINARY" 2>/dev/null || stat -f%z "$TOYBOX_BINARY") bytes"
+[ -f "$BENCH_BINARY" ] && echo "Rbench:        $(stat -c%s "$BENCH_BINARY" 2>/dev/null || stat -f%z "$BENCH_BINARY") bytes"
+[ -f "$RFIO_BINARY" ] && echo "Rfio:          $(stat -c%s "$RFIO_BINARY" 2>/dev/null || stat -f%z "$RFIO_BINARY") bytes"
 echo ""
 echo "Total image size: $(stat -c%s "$IMAGE_FILE" 2>/dev/null || stat -f%z "$IMAGE_FILE") bytes"
 ls -lh "$IMAGE_FILE"
@@ -5,13 +5,18 @@
 # 1. 检查内核是否存在，不存在则构建
 # 2. 启动 QEMU
 #    - test 参数: 使用 unit-test 特性，强制重新编译
+#    - kbench 参数: 使用 bench 特性以 release 模式编译，运行内核微基准测试
+#    - bench 参数: 以 /bin/rbench 作为 init 运行用户态基准测试，结果写入 test/rbench-results.txt
+#    - fsbench 参数: 以 /bin/rfio 作为 init 运行 /bench/ext4.rfio，结果写入 test/rfio-results.txt
+#    - netbench 参数: 主机运行 rnet 服务器，以 /bin/rnet 作为 init 运行网络基准，结果写入 test/rnet-results.txt
 #    - console 参数:  控制台模式（可指定 init 程序）
 #    - gui 参数:  图形界面模式（启用 VirtIO-GPU 显示）
 #
 # 用法:
 #   ./run.sh [mode] [init]
-#   mode: console | gui | test
+#   mode: console | gui | test | kbench | bench | fsbench | netbench
 #   init: /bin/shell | /bin/sh
+#   INITRD=<cpio newc 归档> 环境变量: 控制台模式下经 -initrd 传给内核，解到 RootFS
 
 set -e
 
@@ -39,6 +44,12 @@ run_kernel() {
     local INIT="${1:-$DEFAULT_INIT}"
     echo "启动 QEMU (4核, 2GB 内存, 控制台模式, init=$INIT)..."
 
+    # 可选的 initramfs（内核从设备树 /chosen 读取位置）
+    local INITRD_ARGS=()
+    if [ -n "$INITRD" ]; then
+        INITRD_ARGS=(-initrd "$INITRD")
+    fi
+
     # 检查是否在 WSL 中运行
     if grep -qi microsoft /proc/version 2>/dev/null; then
         echo "检测到 WSL 环境，使用特殊配置..."
@@ -55,6 +66,7 @@ run_kernel() {
             -drive file=test/rootfs.img,if=none,id=rootfs,format=raw \
             -device virtio-blk-pci,disable-legacy=on,drive=rootfs \
             -device virtio-gpu-pci \
+            "${INITRD_ARGS[@]}" \
             -kernel target/riscv64gc-unknown-none-elf/debug/rux \
             -append "root=/dev/vda rw init=$INIT console=ttyS0"
     else
@@ -69,6 +81,7 @@ run_kernel() {
             -drive file=test/rootfs.img,if=none,id=rootfs,format=raw \
             -device virtio-blk-pci,disable-legacy=on,drive=rootfs \
             -device virtio-gpu-pci \
+            "${INITRD_ARGS[@]}" \
             -kernel target/riscv64gc-unknown-none-elf/debug/rux \
             -append "root=/dev/vda rw init=$INIT console=ttyS0"
     fi
@@ -95,6 +108,51 @@ run_kernel_gui() {
         -append "root=/dev/vda rw init=$INIT console=ttyS0"
 }
 
+# 以基准程序作为 init 运行：输出 "<名称>: done" 或超时后关闭 QEMU
+# 用法: run_bench <程序名> [额外 QEMU 参数...]，结果写入 test/<程序名>-results.txt
+run_bench() {
+    local PROG="$1"
+    shift
+    local LOG="test/$PROG.log"
+    local RESULTS="test/$PROG-results.txt"
+    local TIMEOUT="${BENCH_TIMEOUT:-900}"
+    echo "启动 QEMU (4核, /bin/$PROG, 超时 ${TIMEOUT}s)..."
+    rm -f "$LOG"
+    qemu-system-riscv64 \
+        -M virt \
+        -cpu rv64 \
+        -m 2G \
+        -smp 4 \
+        -nographic \
+        -monitor none \
+        -serial "file:$LOG" \
+        -drive file=test/rootfs.img,if=none,id=rootfs,format=raw \
+        -device virtio-blk-pci,disable-legacy=on,drive=rootfs \
+        "$@" \
+        -kernel target/riscv64gc-unknown-none-elf/release/rux \
+        -append "root=/dev/vda rw init=/bin/$PROG console=ttyS0" &
+    local QEMU_PID=$!
+
+    local WAITED=0
+    while kill -0 "$QEMU_PID" 2>/dev/null; do
+        if grep -q "^$PROG: done" "$LOG" 2>/dev/null || [ "$WAITED" -ge "$TIMEOUT" ]; then
+            kill "$QEMU_PID" 2>/dev/null || true
+            break
+        fi
+        sleep 1
+        WAITED=$((WAITED + 1))
+    done
+    wait "$QEMU_PID" 2>/dev/null || true
+
+    grep "^$PROG:" "$LOG" | tr -d '\r' > "$RESULTS" || true
+    cat "$RESULTS"
+    if ! grep -q "^$PROG: done" "$RESULTS"; then
+        echo "$PROG 未完成，完整输出见 $LOG"
+        return 1
+    fi
+    echo "结果已写入 $RESULTS"
+}
+
 # 主函数
 main() {
     local MODE="${1:-console}"
@@ -114,6 +172,43 @@ main() {
             -device virtio-net-device,netdev=user \
             -netdev user,id=user \
             -kernel target/riscv64gc-unknown-none-elf/debug/rux
+    elif [ "$MODE" = "kbench" ]; then
+        # 内核微基准测试：release 编译，结果以 "bench:" 开头
+        echo "构建内核 (特性: riscv64,bench, release)..."
+        cargo build --release --target riscv64gc-unknown-none-elf --features "riscv64,bench"
+        echo "启动 QEMU (4核, 内核微基准测试)..."
+        qemu-system-riscv64 \
+            -M virt \
+            -cpu rv64 \
+            -m 2G \
+            -nographic \
+            -smp 4 \
+            -serial mon:stdio \
+            -kernel target/riscv64gc-unknown-none-elf/release/rux
+    elif [ "$MODE" = "bench" ] || [ "$MODE" = "fsbench" ]; then
+        # 用户态基准测试：release 编译内核，rootfs 中需要有 /bin/rbench 或 /bin/rfio
+        echo "构建内核 (特性: riscv64, release)..."
+        cargo build --release --target riscv64gc-unknown-none-elf --features "riscv64"
+        if [ "$MODE" = "bench" ]; then
+            run_bench rbench
+        else
+            run_bench rfio
+        fi
+    elif [ "$MODE" = "netbench" ]; then
+        # 网络基准测试：主机编译并运行 rnet 服务器，客户机经 QEMU user 网络连接
+        # 192.168.1.2（映射到主机 127.0.0.1）。驱动只支持 MMIO 传输，使用 virtio-net-device
+        echo "构建内核 (特性: riscv64, release)..."
+        cargo build --release --target riscv64gc-unknown-none-elf --features "riscv64"
+        local PORT="${NETBENCH_PORT:-5201}"
+        cc -O2 -o test/rnet-host userspace/bench/src/rnet.c
+        ./test/rnet-host server -p "$PORT" > test/rnet-host.log 2>&1 &
+        local SERVER_PID=$!
+        local STATUS=0
+        run_bench rnet \
+            -device virtio-net-device,netdev=net0 \
+            -netdev user,id=net0,net=192.168.1.0/24,host=192.168.1.2 || STATUS=$?
+        kill "$SERVER_PID" 2>/dev/null || true
+        return "$STATUS"
     elif [ "$MODE" = "gui" ]; then
         # 图形界面模式：启用 VirtIO-GPU 显示
         ensure_kernel "riscv64" false
@@ -108,6 +108,20 @@ void free(void *p)
 	unsigned char *start = g->mem->storage + stride*idx;
 	unsigned char *end = start + stride - IB;
 	get_nominal_size(p, end);
+
+#if USE_TCACHE
+	// keep small slots for reuse by this thread. the frame is left
+	// intact so the slot can be freed normally when the cache drains.
+	struct tcache *tc = MT ? __pthread_self()->malloc_tcache : 0;
+	int sc = g->sizeclass;
+	if (tc && sc < TCACHE_CLASSES && tc->count[sc] < TCACHE_COUNT) {
+		for (int i=0; i<tc->count[sc]; i++)
+			assert(tc->slot[sc][i] != p);
+		tc->slot[sc][tc->count[sc]++] = p;
+		return;
+	}
+#endif
+
 	uint32_t self = 1u<<idx, all = (2u<<g->last_idx)-1;
 	((unsigned char *)p)[-3] = 255;
 	// invalidate offset to group header, and cycle offset of
@@ -149,3 +163,18 @@ void free(void *p)
 		errno = e;
 	}
 }
+
+#if USE_TCACHE
+void __malloc_tcache_flush(void)
+{
+	struct pthread *self = __pthread_self();
+	struct tcache *tc = self->malloc_tcache;
+	self->malloc_tcache_off = 1;
+	if (!tc) return;
+	self->malloc_tcache = 0;
+	for (int sc=0; sc<TCACHE_CLASSES; sc++)
+		while (tc->count[sc])
+			free(tc->slot[sc][--tc->count[sc]]);
+	free(tc);
+}
+#endif
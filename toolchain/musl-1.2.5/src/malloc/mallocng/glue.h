@@ -12,6 +12,7 @@
 #include "libc.h"
 #include "lock.h"
 #include "dynlink.h"
+#include "pthread_impl.h"
 
 // use macros to appropriately namespace these.
 #define size_classes __malloc_size_classes
@@ -24,7 +25,13 @@
 #define realloc __libc_realloc
 #define free __libc_free
 
-#define USE_MADV_FREE 0
+#define USE_MADV_FREE 1
+
+// per-thread cache of freed small slots, consulted before taking
+// the malloc lock. build with -DUSE_TCACHE=0 to disable.
+#ifndef USE_TCACHE
+#define USE_TCACHE 1
+#endif
 
 #if USE_REAL_ASSERT
 #include <assert.h>
@@ -296,6 +296,32 @@ static int alloc_slot(int sc, size_t req)
 	return 0;
 }
 
+#if USE_TCACHE
+static void *tcache_get(int sc, size_t n)
+{
+	struct pthread *self = __pthread_self();
+	struct tcache *tc = self->malloc_tcache;
+	if (!tc) {
+		if (self->malloc_tcache_off) return 0;
+		// the cache itself is larger than any cached class,
+		// so this cannot recurse.
+		tc = malloc(sizeof *tc);
+		if (!tc) return 0;
+		memset(tc->count, 0, sizeof tc->count);
+		self->malloc_tcache = tc;
+	}
+	if (!tc->count[sc]) return 0;
+	unsigned char *p = tc->slot[sc][--tc->count[sc]];
+	struct meta *g = get_meta(p);
+	int idx = get_slot_index(p);
+	// retire the old frame the way free would have, then
+	// enframe the slot again for the new size.
+	p[-3] = 255;
+	*(uint16_t *)(p-2) = 0;
+	return enframe(g, idx, n, 0);
+}
+#endif
+
 void *malloc(size_t n)
 {
 	if (size_overflows(n)) return 0;
@@ -334,6 +360,13 @@ void *malloc(size_t n)
 
 	sc = size_to_class(n);
 
+#if USE_TCACHE
+	if (MT && sc < TCACHE_CLASSES) {
+		void *p = tcache_get(sc, n);
+		if (p) return p;
+	}
+#endif
+
 	rdlock();
 	g = ctx.active[sc];
 
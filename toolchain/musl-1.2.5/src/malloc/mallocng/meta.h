@@ -60,6 +60,19 @@ struct malloc_context {
 __attribute__((__visibility__("hidden")))
 extern struct malloc_context ctx;
 
+#if USE_TCACHE
+// small size classes (up to 496 bytes) are cached per thread. the
+// cached slots stay allocated as far as the groups are concerned,
+// so the count per class is kept low to bound the memory pinned.
+#define TCACHE_CLASSES 16
+#define TCACHE_COUNT 8
+
+struct tcache {
+	unsigned char count[TCACHE_CLASSES];
+	void *slot[TCACHE_CLASSES][TCACHE_COUNT];
+};
+#endif
+
 #ifdef PAGESIZE
 #define PGSZ PAGESIZE
 #else
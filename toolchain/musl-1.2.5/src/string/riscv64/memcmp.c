@@ -0,0 +1,18 @@
+#include <string.h>
+#include "libc.h"
+
+#define HWCAP_ISA_V (1UL << ('V' - 'A'))
+
+hidden int __memcmp_rvv(const void *, const void *, size_t);
+hidden int __memcmp_scalar(const void *, const void *, size_t);
+
+#define memcmp __memcmp_scalar
+#include "../memcmp.c"
+#undef memcmp
+
+int memcmp(const void *vl, const void *vr, size_t n)
+{
+	if (n >= 32 && (__hwcap & HWCAP_ISA_V))
+		return __memcmp_rvv(vl, vr, n);
+	return __memcmp_scalar(vl, vr, n);
+}
@@ -0,0 +1,18 @@
+#include <string.h>
+#include "libc.h"
+
+#define HWCAP_ISA_V (1UL << ('V' - 'A'))
+
+hidden void *__memcpy_rvv(void *restrict, const void *restrict, size_t);
+hidden void *__memcpy_scalar(void *restrict, const void *restrict, size_t);
+
+#define memcpy __memcpy_scalar
+#include "../memcpy.c"
+#undef memcpy
+
+void *memcpy(void *restrict dest, const void *restrict src, size_t n)
+{
+	if (n >= 32 && (__hwcap & HWCAP_ISA_V))
+		return __memcpy_rvv(dest, src, n);
+	return __memcpy_scalar(dest, src, n);
+}
@@ -0,0 +1,24 @@
+#include <string.h>
+#include <stdint.h>
+#include "libc.h"
+
+#define HWCAP_ISA_V (1UL << ('V' - 'A'))
+
+hidden void *__memmove_rvv(void *, const void *, size_t);
+hidden void *__memmove_scalar(void *, const void *, size_t);
+
+#define memmove __memmove_scalar
+#include "../memmove.c"
+#undef memmove
+
+void *memmove(void *dest, const void *src, size_t n)
+{
+	if (n >= 32 && (__hwcap & HWCAP_ISA_V)) {
+		/* Forward copies are memcpy's; only overlap with dest above
+		 * src needs the backward vector loop. */
+		if ((uintptr_t)dest-(uintptr_t)src >= n)
+			return memcpy(dest, src, n);
+		return __memmove_rvv(dest, src, n);
+	}
+	return __memmove_scalar(dest, src, n);
+}
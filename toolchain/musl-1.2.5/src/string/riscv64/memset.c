@@ -0,0 +1,18 @@
+#include <string.h>
+#include "libc.h"
+
+#define HWCAP_ISA_V (1UL << ('V' - 'A'))
+
+hidden void *__memset_rvv(void *, int, size_t);
+hidden void *__memset_scalar(void *, int, size_t);
+
+#define memset __memset_scalar
+#include "../memset.c"
+#undef memset
+
+void *memset(void *dest, int c, size_t n)
+{
+	if (n >= 32 && (__hwcap & HWCAP_ISA_V))
+		return __memset_rvv(dest, c, n);
+	return __memset_scalar(dest, c, n);
+}
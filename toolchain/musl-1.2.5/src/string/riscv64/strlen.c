@@ -0,0 +1,18 @@
+#include <string.h>
+#include "libc.h"
+
+#define HWCAP_ISA_V (1UL << ('V' - 'A'))
+
+hidden size_t __strlen_rvv(const char *);
+hidden size_t __strlen_scalar(const char *);
+
+#define strlen __strlen_scalar
+#include "../strlen.c"
+#undef strlen
+
+size_t strlen(const char *s)
+{
+	if (__hwcap & HWCAP_ISA_V)
+		return __strlen_rvv(s);
+	return __strlen_scalar(s);
+}
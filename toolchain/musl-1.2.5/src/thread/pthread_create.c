@@ -13,6 +13,7 @@ static void dummy_0()
 weak_alias(dummy_0, __acquire_ptc);
 weak_alias(dummy_0, __release_ptc);
 weak_alias(dummy_0, __pthread_tsd_run_dtors);
+weak_alias(dummy_0, __malloc_tcache_flush);
 weak_alias(dummy_0, __do_orphaned_stdio_locks);
 weak_alias(dummy_0, __dl_thread_cleanup);
 weak_alias(dummy_0, __membarrier_init);
@@ -69,6 +70,10 @@ _Noreturn void __pthread_exit(void *result)
 
 	__pthread_tsd_run_dtors();
 
+	/* Return slots held in the thread's malloc cache, if any, now
+	 * that no more application code can run on this thread. */
+	__malloc_tcache_flush();
+
 	__block_app_sigs(&set);
 
 	/* This atomic potentially competes with a concurrent pthread_detach
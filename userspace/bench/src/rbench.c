@@ -0,0 +1,459 @@
+/*
+ * Rux OS 用户态基准测试 (rbench) - musl libc 版本
+ *
+ * 参考 lmbench 的 lat_syscall / lat_proc / lat_pipe / bw_pipe / lat_ctx /
+ * lat_pagefault / bw_file_rd，测量：
+ * - null 系统调用 (getppid)、getpid、clock_gettime
+ * - fork+exit、fork+execve
+ * - 管道往返延迟与带宽
+ * - N 个进程组成管道环时的上下文切换延迟
+ * - 匿名 mmap 缺页开销
+ * - 文件读带宽（冷缓存与热缓存）
+ *
+ * 每项重复 REPEATS 次，输出最小值与中位数，每行一条便于脚本解析：
+ *   rbench: <名称> iters=<N> min=<值> median=<值> unit=<ns|MB/s>
+ * 全部完成后输出 "rbench: done"。作为 init 运行时完成后不退出，由 make bench 关闭 QEMU。
+ *
+ * 用法：rbench [-r 重复次数] [测试名...]
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys/wait.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+
+#define DEFAULT_REPEATS 5
+#define MAX_REPEATS 32
+
+/* 管道带宽测试：每次写 64KB，共 16MB */
+#define PIPE_CHUNK (64 * 1024)
+#define PIPE_TOTAL (16 * 1024 * 1024)
+
+/* 缺页测试映射的大小 */
+#define FAULT_BYTES (4 * 1024 * 1024)
+#define PAGE_SIZE 4096
+
+/* 文件读测试：mkrootfs.sh 安装的数据文件，不存在时自己创建 */
+#define FILE_PATH "/bench/data"
+#define FILE_BYTES (4 * 1024 * 1024)
+#define FILE_CHUNK (64 * 1024)
+
+/* 上下文切换测试的最大进程数 */
+#define CTX_MAX_PROCS 16
+
+static char buf[PIPE_CHUNK];
+static const char *self_path = "/bin/rbench";
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+/* 输出一项结果：values 为每次重复的结果，单位由 unit 给出 */
+static void report(const char *name, long iters, long long *values, int n, const char *unit) {
+    qsort(values, n, sizeof(values[0]), cmp_ll);
+    printf("rbench: %s iters=%ld min=%lld median=%lld unit=%s\n",
+           name, iters, values[0], values[n / 2], unit);
+}
+
+/* 把 repeats 次 fn(iters) 的总耗时折算为每次操作的纳秒数并输出 */
+static void run_latency(const char *name, long long (*fn)(long), long iters, int repeats) {
+    long long values[MAX_REPEATS];
+    int n = 0;
+    fn(iters / 10 + 1);  /* 预热 */
+    for (int i = 0; i < repeats; i++) {
+        long long ns = fn(iters);
+        if (ns < 0) {
+            printf("rbench: %s failed errno=%d\n", name, errno);
+            return;
+        }
+        values[n++] = ns / iters;
+    }
+    report(name, iters, values, n, "ns");
+}
+
+/* 把 repeats 次 fn() 传输 bytes 字节的耗时折算为 MB/s 并输出 */
+static void run_bandwidth(const char *name, long long (*fn)(void), long bytes, int repeats) {
+    long long values[MAX_REPEATS];
+    int n = 0;
+    for (int i = 0; i < repeats; i++) {
+        long long ns = fn();
+        if (ns <= 0) {
+            printf("rbench: %s failed errno=%d\n", name, errno);
+            return;
+        }
+        values[n++] = (long long)bytes * 1000 / ns;  /* bytes/ns * 1000 = MB/s */
+    }
+    report(name, 1, values, n, "MB/s");
+}
+
+/* ===== 系统调用 ===== */
+
+static long long bench_null(long iters) {
+    long long start = now_ns();
+    for (long i = 0; i < iters; i++) {
+        syscall(SYS_getppid);
+    }
+    return now_ns() - start;
+}
+
+static long long bench_getpid(long iters) {
+    long long start = now_ns();
+    for (long i = 0; i < iters; i++) {
+        syscall(SYS_getpid);
+    }
+    return now_ns() - start;
+}
+
+static long long bench_clock_gettime(long iters) {
+    struct timespec ts;
+    long long start = now_ns();
+    for (long i = 0; i < iters; i++) {
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+    }
+    return now_ns() - start;
+}
+
+/* ===== 进程创建 ===== */
+
+static long long bench_fork_exit(long iters) {
+    long long start = now_ns();
+    for (long i = 0; i < iters; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            return -1;
+        }
+        if (pid == 0) {
+            _exit(0);
+        }
+        waitpid(pid, NULL, 0);
+    }
+    return now_ns() - start;
+}
+
+static long long bench_fork_execve(long iters) {
+    char *argv[] = { "rbench", "--exit", NULL };
+    long long start = now_ns();
+    for (long i = 0; i < iters; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            return -1;
+        }
+        if (pid == 0) {
+            execve(self_path, argv, NULL);
+            _exit(127);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+            errno = ENOEXEC;
+            return -1;
+        }
+    }
+    return now_ns() - start;
+}
+
+/* ===== 管道 ===== */
+
+/* 两个进程通过一对管道来回传递 1 字节，返回往返总耗时 */
+static long long bench_pipe_latency(long iters) {
+    int to_child[2], to_parent[2];
+    char c = 0;
+    if (pipe(to_child) < 0 || pipe(to_parent) < 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        for (long i = 0; i < iters; i++) {
+            if (read(to_child[0], &c, 1) != 1 || write(to_parent[1], &c, 1) != 1) {
+                _exit(1);
+            }
+        }
+        _exit(0);
+    }
+    long long start = now_ns();
+    for (long i = 0; i < iters; i++) {
+        if (write(to_child[1], &c, 1) != 1 || read(to_parent[0], &c, 1) != 1) {
+            break;
+        }
+    }
+    long long elapsed = now_ns() - start;
+    waitpid(pid, NULL, 0);
+    close(to_child[0]);
+    close(to_child[1]);
+    close(to_parent[0]);
+    close(to_parent[1]);
+    return elapsed;
+}
+
+/* 子进程写 PIPE_TOTAL 字节，父进程读完的耗时 */
+static long long bench_pipe_bandwidth(void) {
+    int fds[2];
+    if (pipe(fds) < 0) {
+        return -1;
+    }
+    pid_t pid = fork();
+    if (pid < 0) {
+        return -1;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        for (long done = 0; done < PIPE_TOTAL; ) {
+            ssize_t n = write(fds[1], buf, PIPE_CHUNK);
+            if (n <= 0) {
+                _exit(1);
+            }
+            done += n;
+        }
+        _exit(0);
+    }
+    close(fds[1]);
+    long long start = now_ns();
+    long total = 0;
+    while (total < PIPE_TOTAL) {
+        ssize_t n = read(fds[0], buf, PIPE_CHUNK);
+        if (n <= 0) {
+            break;
+        }
+        total += n;
+    }
+    long long elapsed = now_ns() - start;
+    close(fds[0]);
+    waitpid(pid, NULL, 0);
+    return total == PIPE_TOTAL ? elapsed : -1;
+}
+
+/* ===== 上下文切换 ===== */
+
+static int ctx_procs;
+
+/* ctx_procs 个进程组成管道环传递令牌，每传一次是一次上下文切换 */
+static long long bench_ctx(long iters) {
+    int ring[CTX_MAX_PROCS][2];
+    pid_t pids[CTX_MAX_PROCS];
+    char c = 0;
+    int n = ctx_procs;
+
+    for (int i = 0; i < n; i++) {
+        if (pipe(ring[i]) < 0) {
+            return -1;
+        }
+    }
+    /* 进程 i 从 ring[i] 读，写到 ring[(i + 1) % n]；父进程是 0 号 */
+    for (int i = 1; i < n; i++) {
+        pids[i] = fork();
+        if (pids[i] < 0) {
+            return -1;
+        }
+        if (pids[i] == 0) {
+            for (long k = 0; k < iters; k++) {
+                if (read(ring[i][0], &c, 1) != 1 || write(ring[(i + 1) % n][1], &c, 1) != 1) {
+                    _exit(1);
+                }
+            }
+            _exit(0);
+        }
+    }
+    long long start = now_ns();
+    for (long k = 0; k < iters; k++) {
+        if (write(ring[1 % n][1], &c, 1) != 1 || read(ring[0][0], &c, 1) != 1) {
+            break;
+        }
+    }
+    long long elapsed = now_ns() - start;
+    for (int i = 1; i < n; i++) {
+        waitpid(pids[i], NULL, 0);
+    }
+    for (int i = 0; i < n; i++) {
+        close(ring[i][0]);
+        close(ring[i][1]);
+    }
+    /* 每轮 n 次切换，run_latency 再除以 iters */
+    return elapsed / n;
+}
+
+/* ===== 内存映射 ===== */
+
+/* 映射 FAULT_BYTES 的匿名内存并逐页写入，返回缺页的总耗时 */
+static long long bench_page_fault(long iters) {
+    long long total = 0;
+    long pages = FAULT_BYTES / PAGE_SIZE;
+    for (long done = 0; done < iters; done += pages) {
+        char *p = mmap(NULL, FAULT_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            return -1;
+        }
+        long long start = now_ns();
+        for (long i = 0; i < pages && done + i < iters; i++) {
+            p[i * PAGE_SIZE] = 1;
+        }
+        total += now_ns() - start;
+        munmap(p, FAULT_BYTES);
+    }
+    return total;
+}
+
+/* 映射并解除映射 FAULT_BYTES 的匿名内存，不访问 */
+static long long bench_mmap(long iters) {
+    long long start = now_ns();
+    for (long i = 0; i < iters; i++) {
+        char *p = mmap(NULL, FAULT_BYTES, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            return -1;
+        }
+        munmap(p, FAULT_BYTES);
+    }
+    return now_ns() - start;
+}
+
+/* ===== 文件读 ===== */
+
+static int file_cold;
+
+/* 数据文件不存在时写一个 */
+static int ensure_file(void) {
+    int fd = open(FILE_PATH, O_RDONLY);
+    if (fd >= 0) {
+        close(fd);
+        return 0;
+    }
+    mkdir("/bench", 0755);
+    fd = open(FILE_PATH, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    memset(buf, 0x5a, FILE_CHUNK);
+    for (long done = 0; done < FILE_BYTES; done += FILE_CHUNK) {
+        if (write(fd, buf, FILE_CHUNK) != FILE_CHUNK) {
+            close(fd);
+            return -1;
+        }
+    }
+    fsync(fd);
+    close(fd);
+    return 0;
+}
+
+/* 顺序读完数据文件的耗时；冷缓存时先丢弃文件的页缓存 */
+static long long bench_file_read(void) {
+    int fd = open(FILE_PATH, O_RDONLY);
+    if (fd < 0) {
+        return -1;
+    }
+    if (file_cold) {
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    long long start = now_ns();
+    long total = 0;
+    for (;;) {
+        ssize_t n = read(fd, buf, FILE_CHUNK);
+        if (n <= 0) {
+            break;
+        }
+        total += n;
+    }
+    long long elapsed = now_ns() - start;
+    close(fd);
+    return total == FILE_BYTES ? elapsed : -1;
+}
+
+/* ===== 主程序 ===== */
+
+static int selected(int argc, char **argv, int first, const char *name) {
+    if (first >= argc) {
+        return 1;
+    }
+    for (int i = first; i < argc; i++) {
+        if (strncmp(name, argv[i], strlen(argv[i])) == 0) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    int repeats = DEFAULT_REPEATS;
+    int first = 1;
+
+    /* fork+execve 测试的子进程 */
+    if (argc > 1 && strcmp(argv[1], "--exit") == 0) {
+        return 0;
+    }
+    if (argc > 2 && strcmp(argv[1], "-r") == 0) {
+        repeats = atoi(argv[2]);
+        if (repeats < 1 || repeats > MAX_REPEATS) {
+            repeats = DEFAULT_REPEATS;
+        }
+        first = 3;
+    }
+    if (access(self_path, X_OK) != 0 && argc > 0 && argv[0][0] == '/') {
+        self_path = argv[0];
+    }
+
+    printf("rbench: start repeats=%d\n", repeats);
+
+    if (selected(argc, argv, first, "null_syscall"))
+        run_latency("null_syscall", bench_null, 100000, repeats);
+    if (selected(argc, argv, first, "getpid"))
+        run_latency("getpid", bench_getpid, 100000, repeats);
+    if (selected(argc, argv, first, "clock_gettime"))
+        run_latency("clock_gettime", bench_clock_gettime, 100000, repeats);
+    if (selected(argc, argv, first, "fork_exit"))
+        run_latency("fork_exit", bench_fork_exit, 200, repeats);
+    if (selected(argc, argv, first, "fork_execve"))
+        run_latency("fork_execve", bench_fork_execve, 100, repeats);
+    if (selected(argc, argv, first, "pipe_latency"))
+        run_latency("pipe_latency", bench_pipe_latency, 10000, repeats);
+    if (selected(argc, argv, first, "pipe_bandwidth"))
+        run_bandwidth("pipe_bandwidth", bench_pipe_bandwidth, PIPE_TOTAL, repeats);
+    if (selected(argc, argv, first, "ctx_switch")) {
+        static const int sizes[] = { 2, 4, 8, 16 };
+        char name[32];
+        for (unsigned i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+            ctx_procs = sizes[i];
+            snprintf(name, sizeof(name), "ctx_switch/%d", ctx_procs);
+            run_latency(name, bench_ctx, 5000, repeats);
+        }
+    }
+    if (selected(argc, argv, first, "mmap"))
+        run_latency("mmap", bench_mmap, 1000, repeats);
+    if (selected(argc, argv, first, "page_fault"))
+        run_latency("page_fault", bench_page_fault, FAULT_BYTES / PAGE_SIZE, repeats);
+    if (selected(argc, argv, first, "file_read")) {
+        if (ensure_file() == 0) {
+            file_cold = 1;
+            run_bandwidth("file_read/cold", bench_file_read, FILE_BYTES, repeats);
+            file_cold = 0;
+            run_bandwidth("file_read/warm", bench_file_read, FILE_BYTES, repeats);
+        } else {
+            printf("rbench: file_read failed errno=%d\n", errno);
+        }
+    }
+
+    printf("rbench: done\n");
+    fflush(stdout);
+
+    /* 作为 init 运行时不能退出 */
+    if (getpid() == 1) {
+        for (;;) {
+            pause();
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,532 @@
+/*
+ * Rux OS 文件系统基准测试 (rfio) - musl libc 版本
+ *
+ * 类似 fio 的负载生成器，测量 ext4 读写路径、块分配与页缓存：
+ * - rw=read|write|randread|randwrite：顺序或随机读写，块大小 bs，总量 size
+ * - iodepth=1 时用 pread/pwrite，大于 1 时通过 io_uring 保持 iodepth 个请求在途
+ * - fsync=N：每完成 N 个写请求 fsync 一次
+ * - nrfiles=N：数据分布在 N 个文件中，轮流访问
+ * - invalidate=1：开始前丢弃文件的页缓存 (POSIX_FADV_DONTNEED)，测量冷缓存
+ * - rw=create|stat|unlink：对 nrfiles 个空文件做元数据操作
+ * - file=前缀：文件名为 <dir>/<前缀>.<序号>，默认用任务名
+ *
+ * 每个任务输出一行：
+ *   rfio: <名称> rw=<rw> bs=<bs> iodepth=<N> ios=<N> iops=<N> bw_kib=<KiB/s>
+ *         lat_min_us=.. lat_p50_us=.. lat_p90_us=.. lat_p99_us=.. lat_p999_us=.. lat_max_us=..
+ * 全部完成后输出 "rfio: done"。作为 init 运行时完成后不退出。
+ *
+ * 用法：
+ *   rfio [-f 任务文件]          按任务文件逐行运行，默认 /bench/ext4.rfio
+ *   rfio key=value ...          运行一个任务
+ * 任务文件每行一个任务，由空格分隔的 key=value 组成，# 开始注释
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <time.h>
+#include <errno.h>
+
+#define DEFAULT_PROFILE "/bench/ext4.rfio"
+#define DEFAULT_DIR "/bench"
+
+#define MAX_IODEPTH 64
+#define MAX_FILES 4096
+#define MAX_BS (1024 * 1024)
+/* 记录的延迟样本上限，超过后只统计次数和总耗时 */
+#define MAX_SAMPLES 65536
+#define MAX_LINE 512
+
+/* ===== io_uring ABI (include/uapi/linux/io_uring.h) ===== */
+
+#ifndef SYS_io_uring_setup
+#define SYS_io_uring_setup 425
+#define SYS_io_uring_enter 426
+#endif
+#define IORING_OFF_SQ_RING 0ULL
+#define IORING_OFF_SQES 0x10000000ULL
+#define IORING_ENTER_GETEVENTS 1U
+#define IORING_OP_READ 22
+#define IORING_OP_WRITE 23
+
+struct io_sqring_offsets {
+    uint32_t head, tail, ring_mask, ring_entries, flags, dropped, array, resv1;
+    uint64_t user_addr;
+};
+
+struct io_cqring_offsets {
+    uint32_t head, tail, ring_mask, ring_entries, overflow, cqes, flags, resv1;
+    uint64_t user_addr;
+};
+
+struct io_uring_params {
+    uint32_t sq_entries, cq_entries, flags, sq_thread_cpu, sq_thread_idle, features, wq_fd, resv[3];
+    struct io_sqring_offsets sq_off;
+    struct io_cqring_offsets cq_off;
+};
+
+struct io_uring_sqe {
+    uint8_t opcode, flags;
+    uint16_t ioprio;
+    int32_t fd;
+    uint64_t off, addr;
+    uint32_t len, rw_flags;
+    uint64_t user_data;
+    uint16_t buf_index, personality;
+    int32_t splice_fd_in;
+    uint64_t pad[2];
+};
+
+struct io_uring_cqe {
+    uint64_t user_data;
+    int32_t res;
+    uint32_t flags;
+};
+
+struct ring {
+    int fd;
+    uint32_t *sq_head, *sq_tail, *sq_mask, *sq_array;
+    uint32_t *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+};
+
+static int ring_init(struct ring *r, unsigned entries) {
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    r->fd = syscall(SYS_io_uring_setup, entries, &p);
+    if (r->fd < 0) {
+        return -1;
+    }
+    size_t sq_size = p.sq_off.array + p.sq_entries * sizeof(uint32_t);
+    size_t cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    size_t size = sq_size > cq_size ? sq_size : cq_size;
+    char *rings = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, r->fd, IORING_OFF_SQ_RING);
+    void *sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe), PROT_READ | PROT_WRITE,
+                      MAP_SHARED, r->fd, IORING_OFF_SQES);
+    if (rings == MAP_FAILED || sqes == MAP_FAILED) {
+        close(r->fd);
+        return -1;
+    }
+    r->sq_head = (uint32_t *)(rings + p.sq_off.head);
+    r->sq_tail = (uint32_t *)(rings + p.sq_off.tail);
+    r->sq_mask = (uint32_t *)(rings + p.sq_off.ring_mask);
+    r->sq_array = (uint32_t *)(rings + p.sq_off.array);
+    r->cq_head = (uint32_t *)(rings + p.cq_off.head);
+    r->cq_tail = (uint32_t *)(rings + p.cq_off.tail);
+    r->cq_mask = (uint32_t *)(rings + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(rings + p.cq_off.cqes);
+    r->sqes = sqes;
+    return 0;
+}
+
+/* 在 SQ 尾部放一个读写请求，由下一次 io_uring_enter 提交 */
+static void ring_queue(struct ring *r, int op, int fd, void *buf, unsigned len, uint64_t off, uint64_t tag) {
+    uint32_t tail = *r->sq_tail;
+    uint32_t idx = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = op;
+    sqe->fd = fd;
+    sqe->off = off;
+    sqe->addr = (uint64_t)(uintptr_t)buf;
+    sqe->len = len;
+    sqe->user_data = tag;
+    r->sq_array[idx] = idx;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+}
+
+/* 取出一个完成项，没有时返回 0 */
+static int ring_reap(struct ring *r, struct io_uring_cqe *out) {
+    uint32_t head = *r->cq_head;
+    if (head == __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE)) {
+        return 0;
+    }
+    *out = r->cqes[head & *r->cq_mask];
+    __atomic_store_n(r->cq_head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+/* ===== 任务参数 ===== */
+
+struct job {
+    char name[64];
+    /* 文件名前缀，默认与任务名相同；多个任务可以共用同一组文件 */
+    char file[64];
+    char rw[16];
+    char dir[128];
+    long bs;
+    long size;
+    int iodepth;
+    int fsync;
+    int nrfiles;
+    int invalidate;
+};
+
+static void job_defaults(struct job *j) {
+    memset(j, 0, sizeof(*j));
+    strcpy(j->name, "job");
+    strcpy(j->rw, "read");
+    strcpy(j->dir, DEFAULT_DIR);
+    j->bs = 4096;
+    j->size = 16L * 1024 * 1024;
+    j->iodepth = 1;
+    j->nrfiles = 1;
+    j->invalidate = 1;
+}
+
+/* 解析 4k / 16m / 1g 这样的大小 */
+static long parse_size(const char *s) {
+    char *end;
+    long v = strtol(s, &end, 10);
+    switch (*end) {
+    case 'k': case 'K': return v * 1024;
+    case 'm': case 'M': return v * 1024 * 1024;
+    case 'g': case 'G': return v * 1024 * 1024 * 1024;
+    default: return v;
+    }
+}
+
+/* 设置一个 key=value，不认识的 key 返回 -1 */
+static int job_set(struct job *j, const char *kv) {
+    const char *eq = strchr(kv, '=');
+    if (!eq) {
+        return -1;
+    }
+    size_t klen = eq - kv;
+    const char *v = eq + 1;
+#define KEY(k) (klen == strlen(k) && strncmp(kv, k, klen) == 0)
+    if (KEY("name")) snprintf(j->name, sizeof(j->name), "%s", v);
+    else if (KEY("file")) snprintf(j->file, sizeof(j->file), "%s", v);
+    else if (KEY("rw")) snprintf(j->rw, sizeof(j->rw), "%s", v);
+    else if (KEY("dir")) snprintf(j->dir, sizeof(j->dir), "%s", v);
+    else if (KEY("bs")) j->bs = parse_size(v);
+    else if (KEY("size")) j->size = parse_size(v);
+    else if (KEY("iodepth")) j->iodepth = atoi(v);
+    else if (KEY("fsync")) j->fsync = atoi(v);
+    else if (KEY("nrfiles")) j->nrfiles = atoi(v);
+    else if (KEY("invalidate")) j->invalidate = atoi(v);
+    else return -1;
+#undef KEY
+    return 0;
+}
+
+/* ===== 统计 ===== */
+
+struct stats {
+    long ios;
+    long samples;
+    long long *lat;  /* 每个请求的延迟 (ns)，最多 MAX_SAMPLES 个 */
+};
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static void stats_add(struct stats *s, long long ns) {
+    if (s->samples < MAX_SAMPLES) {
+        s->lat[s->samples++] = ns;
+    }
+    s->ios++;
+}
+
+/* 第 pct_x10 / 1000 分位的延迟，单位微秒 */
+static long long pct_us(struct stats *s, int pct_x10) {
+    if (s->samples == 0) {
+        return 0;
+    }
+    return s->lat[(s->samples - 1) * pct_x10 / 1000] / 1000;
+}
+
+static void report(struct job *j, struct stats *s, long long elapsed, long bytes) {
+    qsort(s->lat, s->samples, sizeof(long long), cmp_ll);
+    if (elapsed <= 0) {
+        elapsed = 1;
+    }
+    printf("rfio: %s rw=%s bs=%ld iodepth=%d ios=%ld iops=%lld bw_kib=%lld "
+           "lat_min_us=%lld lat_p50_us=%lld lat_p90_us=%lld lat_p99_us=%lld lat_p999_us=%lld lat_max_us=%lld\n",
+           j->name, j->rw, j->bs, j->iodepth, s->ios,
+           (long long)s->ios * 1000000000LL / elapsed,
+           (long long)bytes * 1000000000LL / 1024 / elapsed,
+           pct_us(s, 0), pct_us(s, 500), pct_us(s, 900), pct_us(s, 990), pct_us(s, 999), pct_us(s, 1000));
+}
+
+/* ===== 数据任务 ===== */
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t rng_next(void) {
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static void file_path(char *out, size_t len, struct job *j, int i) {
+    snprintf(out, len, "%s/%s.%d", j->dir, j->file[0] ? j->file : j->name, i);
+}
+
+/* 读任务需要的文件：不存在或太短时写满；写任务从空文件开始 */
+static int prepare_files(struct job *j, int *fds, long file_size, int is_write, char *buf) {
+    char path[192];
+    for (int i = 0; i < j->nrfiles; i++) {
+        file_path(path, sizeof(path), j, i);
+        if (is_write) {
+            fds[i] = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        } else {
+            fds[i] = open(path, O_RDWR | O_CREAT, 0644);
+            struct stat st;
+            if (fds[i] >= 0 && fstat(fds[i], &st) == 0 && st.st_size < file_size) {
+                memset(buf, 0xa5, j->bs);
+                for (long off = 0; off < file_size; off += j->bs) {
+                    if (pwrite(fds[i], buf, j->bs, off) != j->bs) {
+                        return -1;
+                    }
+                }
+                fsync(fds[i]);
+            }
+        }
+        if (fds[i] < 0) {
+            return -1;
+        }
+        if (j->invalidate) {
+            posix_fadvise(fds[i], 0, 0, POSIX_FADV_DONTNEED);
+        }
+    }
+    return 0;
+}
+
+/* 第 n 个请求的文件与偏移 */
+static void next_target(struct job *j, long n, long blocks_per_file, int is_rand, int *file, long *off) {
+    *file = n % j->nrfiles;
+    long block = is_rand ? (long)(rng_next() % blocks_per_file) : (n / j->nrfiles) % blocks_per_file;
+    *off = block * j->bs;
+}
+
+static int run_data_job(struct job *j) {
+    int is_write = strstr(j->rw, "write") != NULL;
+    int is_rand = strncmp(j->rw, "rand", 4) == 0;
+    int fds[MAX_FILES];
+    long file_size = j->size / j->nrfiles;
+    long blocks_per_file = file_size / j->bs;
+    long total = blocks_per_file * j->nrfiles;
+    if (blocks_per_file <= 0) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    char *bufs = mmap(NULL, (size_t)j->bs * j->iodepth, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    struct stats s = { 0, 0, NULL };
+    s.lat = mmap(NULL, MAX_SAMPLES * sizeof(long long), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (bufs == MAP_FAILED || s.lat == MAP_FAILED) {
+        return -1;
+    }
+    if (prepare_files(j, fds, file_size, is_write, bufs) < 0) {
+        return -1;
+    }
+    memset(bufs, 0x5a, (size_t)j->bs * j->iodepth);
+
+    long writes = 0;
+    long long start = now_ns();
+    if (j->iodepth == 1) {
+        for (long n = 0; n < total; n++) {
+            int f;
+            long off;
+            next_target(j, n, blocks_per_file, is_rand, &f, &off);
+            long long t0 = now_ns();
+            ssize_t done = is_write ? pwrite(fds[f], bufs, j->bs, off) : pread(fds[f], bufs, j->bs, off);
+            if (done != j->bs) {
+                return -1;
+            }
+            if (is_write && j->fsync && ++writes % j->fsync == 0) {
+                fsync(fds[f]);
+            }
+            stats_add(&s, now_ns() - t0);
+        }
+    } else {
+        struct ring r;
+        long long issued_at[MAX_IODEPTH];
+        int slot_file[MAX_IODEPTH];
+        int free_slots[MAX_IODEPTH];
+        int nr_free = j->iodepth;
+        long submitted = 0, completed = 0;
+        if (ring_init(&r, j->iodepth) < 0) {
+            return -1;
+        }
+        for (int i = 0; i < j->iodepth; i++) {
+            free_slots[i] = i;
+        }
+        while (completed < total) {
+            unsigned to_submit = 0;
+            while (nr_free > 0 && submitted < total) {
+                int slot = free_slots[--nr_free];
+                int f;
+                long off;
+                next_target(j, submitted, blocks_per_file, is_rand, &f, &off);
+                slot_file[slot] = f;
+                issued_at[slot] = now_ns();
+                ring_queue(&r, is_write ? IORING_OP_WRITE : IORING_OP_READ, fds[f],
+                           bufs + (size_t)slot * j->bs, j->bs, off, slot);
+                submitted++;
+                to_submit++;
+            }
+            if (syscall(SYS_io_uring_enter, r.fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0) < 0) {
+                return -1;
+            }
+            struct io_uring_cqe cqe;
+            while (ring_reap(&r, &cqe)) {
+                int slot = (int)cqe.user_data;
+                if (cqe.res != j->bs) {
+                    errno = cqe.res < 0 ? -cqe.res : EIO;
+                    return -1;
+                }
+                stats_add(&s, now_ns() - issued_at[slot]);
+                if (is_write && j->fsync && ++writes % j->fsync == 0) {
+                    fsync(fds[slot_file[slot]]);
+                }
+                free_slots[nr_free++] = slot;
+                completed++;
+            }
+        }
+        close(r.fd);
+    }
+    if (is_write) {
+        for (int i = 0; i < j->nrfiles; i++) {
+            fsync(fds[i]);
+        }
+    }
+    long long elapsed = now_ns() - start;
+
+    for (int i = 0; i < j->nrfiles; i++) {
+        close(fds[i]);
+    }
+    report(j, &s, elapsed, total * j->bs);
+    munmap(bufs, (size_t)j->bs * j->iodepth);
+    munmap(s.lat, MAX_SAMPLES * sizeof(long long));
+    return 0;
+}
+
+/* ===== 元数据任务 ===== */
+
+static int run_meta_job(struct job *j) {
+    struct stats s = { 0, 0, NULL };
+    char path[192];
+    s.lat = mmap(NULL, MAX_SAMPLES * sizeof(long long), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (s.lat == MAP_FAILED) {
+        return -1;
+    }
+    mkdir(j->dir, 0755);
+    long long start = now_ns();
+    for (int i = 0; i < j->nrfiles; i++) {
+        file_path(path, sizeof(path), j, i);
+        long long t0 = now_ns();
+        int ok;
+        if (strcmp(j->rw, "create") == 0) {
+            int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+            ok = fd >= 0;
+            if (ok) {
+                close(fd);
+            }
+        } else if (strcmp(j->rw, "stat") == 0) {
+            struct stat st;
+            ok = stat(path, &st) == 0;
+        } else {
+            ok = unlink(path) == 0;
+        }
+        if (!ok) {
+            return -1;
+        }
+        stats_add(&s, now_ns() - t0);
+    }
+    long long elapsed = now_ns() - start;
+    report(j, &s, elapsed, 0);
+    munmap(s.lat, MAX_SAMPLES * sizeof(long long));
+    return 0;
+}
+
+static void run_job(struct job *j) {
+    int is_meta = strcmp(j->rw, "create") == 0 || strcmp(j->rw, "stat") == 0 || strcmp(j->rw, "unlink") == 0;
+    int is_data = strcmp(j->rw, "read") == 0 || strcmp(j->rw, "write") == 0
+        || strcmp(j->rw, "randread") == 0 || strcmp(j->rw, "randwrite") == 0;
+    if (j->bs <= 0 || j->bs > MAX_BS || j->iodepth < 1 || j->iodepth > MAX_IODEPTH
+        || j->nrfiles < 1 || j->nrfiles > MAX_FILES || (!is_meta && !is_data)) {
+        printf("rfio: %s invalid job\n", j->name);
+        return;
+    }
+    if ((is_meta ? run_meta_job(j) : run_data_job(j)) < 0) {
+        printf("rfio: %s failed errno=%d\n", j->name, errno);
+    }
+}
+
+/* 运行任务文件中的每一行 */
+static int run_profile(const char *path) {
+    FILE *f = fopen(path, "r");
+    char line[MAX_LINE];
+    if (!f) {
+        printf("rfio: cannot open %s errno=%d\n", path, errno);
+        return -1;
+    }
+    while (fgets(line, sizeof(line), f)) {
+        char *hash = strchr(line, '#');
+        if (hash) {
+            *hash = '\0';
+        }
+        struct job j;
+        int fields = 0, bad = 0;
+        job_defaults(&j);
+        for (char *tok = strtok(line, " \t\r\n"); tok; tok = strtok(NULL, " \t\r\n")) {
+            if (job_set(&j, tok) < 0) {
+                printf("rfio: unknown option %s\n", tok);
+                bad = 1;
+            }
+            fields++;
+        }
+        if (fields > 0 && !bad) {
+            run_job(&j);
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char **argv) {
+    if (argc > 2 && strcmp(argv[1], "-f") == 0) {
+        run_profile(argv[2]);
+    } else if (argc > 1) {
+        struct job j;
+        job_defaults(&j);
+        for (int i = 1; i < argc; i++) {
+            if (job_set(&j, argv[i]) < 0) {
+                printf("rfio: unknown option %s\n", argv[i]);
+                return 1;
+            }
+        }
+        run_job(&j);
+    } else {
+        run_profile(DEFAULT_PROFILE);
+    }
+
+    printf("rfio: done\n");
+    fflush(stdout);
+
+    /* 作为 init 运行时不能退出 */
+    if (getpid() == 1) {
+        for (;;) {
+            pause();
+        }
+    }
+    return 0;
+}
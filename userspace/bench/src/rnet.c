@@ -0,0 +1,477 @@
+/*
+ * Rux OS 网络基准测试 (rnet)
+ *
+ * 类似 iperf / netperf 的 TCP/UDP 吞吐与延迟测试，同一份源码既用 musl 编译为
+ * /bin/rnet，也用主机编译器编译为主机侧的对端 (test/run.sh netbench)：
+ * - server：在同一端口监听 TCP 与 UDP，按客户端请求接收、发送或回显
+ * - tcp_stream：客户端持续发送，测量发送方向吞吐
+ * - tcp_maerts：服务器持续发送，测量接收方向吞吐
+ * - udp_flood：客户端持续发送数据报，服务器统计收到的个数，得到包速率与丢包率
+ * - tcp_rr / udp_rr：1 字节请求/响应，测量每秒事务数与延迟分位
+ *
+ * 输出每行一条：
+ *   rnet: <测试> ... gbit_s=<值> | pps=<值> | trans_s=<值> lat_p50_us=.. lat_p99_us=..
+ * 不带参数运行时（作为 init）连接 192.168.1.2（QEMU user 网络中的主机）运行全部测试，
+ * 完成后输出 "rnet: done"。
+ *
+ * 用法：
+ *   rnet server [-p 端口]
+ *   rnet <测试> <服务器地址> [-p 端口] [-t 秒数] [-l 长度] [-n 事务数]
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <time.h>
+#include <errno.h>
+#include <signal.h>
+
+#define DEFAULT_PORT 5201
+#define DEFAULT_HOST "192.168.1.2"
+#define DEFAULT_SECS 10
+#define DEFAULT_TCP_LEN (128 * 1024)
+#define DEFAULT_UDP_LEN 1400
+#define DEFAULT_RR_COUNT 10000
+#define MAX_LEN (256 * 1024)
+#define MAX_RR_SAMPLES 100000
+
+/* TCP 连接的第一个字节选择服务 */
+#define MODE_SINK 'S'    /* 服务器接收直到 EOF，回复收到的字节数 */
+#define MODE_SOURCE 'T'  /* 服务器发送直到客户端关闭 */
+#define MODE_ECHO 'R'    /* 服务器原样回显 */
+
+/* UDP 数据报的第一个字节 */
+#define UDP_FLOOD 'F'    /* 计数 */
+#define UDP_END 'E'      /* 回复计数并清零 */
+#define UDP_ECHO 'R'     /* 原样回显 */
+
+struct opts {
+    const char *host;
+    int port;
+    int secs;
+    int len;
+    long count;
+};
+
+static char buf[MAX_LEN];
+static long long rr_lat[MAX_RR_SAMPLES];
+
+static long long now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int cmp_ll(const void *a, const void *b) {
+    long long x = *(const long long *)a, y = *(const long long *)b;
+    return (x > y) - (x < y);
+}
+
+static int write_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = write(fd, p, len);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int read_all(int fd, void *data, size_t len) {
+    char *p = data;
+    while (len > 0) {
+        ssize_t n = read(fd, p, len);
+        if (n <= 0) {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+static int make_addr(struct sockaddr_in *sa, const char *host, int port) {
+    memset(sa, 0, sizeof(*sa));
+    sa->sin_family = AF_INET;
+    sa->sin_port = htons(port);
+    if (host == NULL) {
+        sa->sin_addr.s_addr = htonl(INADDR_ANY);
+        return 0;
+    }
+    return inet_pton(AF_INET, host, &sa->sin_addr) == 1 ? 0 : -1;
+}
+
+/* ===== 服务器 ===== */
+
+static void serve_tcp(int fd) {
+    char mode;
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (read_all(fd, &mode, 1) < 0) {
+        return;
+    }
+    if (mode == MODE_SINK) {
+        uint64_t total = 0;
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0) {
+            total += n;
+        }
+        write_all(fd, &total, sizeof(total));
+    } else if (mode == MODE_SOURCE) {
+        while (write(fd, buf, DEFAULT_TCP_LEN) > 0) {
+        }
+    } else if (mode == MODE_ECHO) {
+        ssize_t n;
+        while ((n = read(fd, buf, sizeof(buf))) > 0) {
+            if (write_all(fd, buf, n) < 0) {
+                break;
+            }
+        }
+    }
+}
+
+static void serve_udp(int fd, uint64_t *flood_count) {
+    struct sockaddr_in peer;
+    socklen_t peer_len = sizeof(peer);
+    ssize_t n = recvfrom(fd, buf, sizeof(buf), 0, (struct sockaddr *)&peer, &peer_len);
+    if (n <= 0) {
+        return;
+    }
+    if (buf[0] == UDP_FLOOD) {
+        (*flood_count)++;
+    } else if (buf[0] == UDP_END) {
+        sendto(fd, flood_count, sizeof(*flood_count), 0, (struct sockaddr *)&peer, peer_len);
+        *flood_count = 0;
+    } else if (buf[0] == UDP_ECHO) {
+        sendto(fd, buf, n, 0, (struct sockaddr *)&peer, peer_len);
+    }
+}
+
+static int run_server(struct opts *o) {
+    struct sockaddr_in sa;
+    int one = 1;
+    int lfd = socket(AF_INET, SOCK_STREAM, 0);
+    int ufd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (lfd < 0 || ufd < 0) {
+        perror("rnet: socket");
+        return 1;
+    }
+    /* tcp_maerts 客户端关闭连接时 write 失败即可，不应终止服务器 */
+    signal(SIGPIPE, SIG_IGN);
+    setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    make_addr(&sa, NULL, o->port);
+    if (bind(lfd, (struct sockaddr *)&sa, sizeof(sa)) < 0 || listen(lfd, 4) < 0
+        || bind(ufd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        perror("rnet: bind");
+        return 1;
+    }
+    printf("rnet: server listening on port %d\n", o->port);
+    fflush(stdout);
+
+    uint64_t flood_count = 0;
+    for (;;) {
+        struct pollfd pfd[2] = { { lfd, POLLIN, 0 }, { ufd, POLLIN, 0 } };
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return 1;
+        }
+        if (pfd[1].revents & POLLIN) {
+            serve_udp(ufd, &flood_count);
+        }
+        if (pfd[0].revents & POLLIN) {
+            int cfd = accept(lfd, NULL, NULL);
+            if (cfd >= 0) {
+                serve_tcp(cfd);
+                close(cfd);
+            }
+        }
+    }
+}
+
+/* ===== 客户端 ===== */
+
+static int tcp_connect(struct opts *o, char mode) {
+    struct sockaddr_in sa;
+    int one = 1;
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0 || make_addr(&sa, o->host, o->port) < 0
+        || connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    if (write_all(fd, &mode, 1) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void report_stream(const char *name, uint64_t bytes, long long ns) {
+    double secs = ns / 1e9;
+    printf("rnet: %s bytes=%llu secs=%.2f gbit_s=%.3f\n",
+           name, (unsigned long long)bytes, secs, bytes * 8 / secs / 1e9);
+}
+
+/* 发送 secs 秒，服务器确认收到的字节数 */
+static int tcp_stream(struct opts *o) {
+    int fd = tcp_connect(o, MODE_SINK);
+    if (fd < 0) {
+        return -1;
+    }
+    uint64_t sent = 0, acked = 0;
+    long long start = now_ns(), end = start + (long long)o->secs * 1000000000LL;
+    while (now_ns() < end) {
+        if (write_all(fd, buf, o->len) < 0) {
+            close(fd);
+            return -1;
+        }
+        sent += o->len;
+    }
+    shutdown(fd, SHUT_WR);
+    int ok = read_all(fd, &acked, sizeof(acked));
+    long long elapsed = now_ns() - start;
+    close(fd);
+    if (ok < 0 || acked != sent) {
+        errno = EIO;
+        return -1;
+    }
+    report_stream("tcp_stream", acked, elapsed);
+    return 0;
+}
+
+/* 服务器发送 secs 秒 */
+static int tcp_maerts(struct opts *o) {
+    int fd = tcp_connect(o, MODE_SOURCE);
+    if (fd < 0) {
+        return -1;
+    }
+    uint64_t received = 0;
+    long long start = now_ns(), end = start + (long long)o->secs * 1000000000LL;
+    while (now_ns() < end) {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if (n <= 0) {
+            close(fd);
+            return -1;
+        }
+        received += n;
+    }
+    long long elapsed = now_ns() - start;
+    close(fd);
+    report_stream("tcp_maerts", received, elapsed);
+    return 0;
+}
+
+static int udp_socket(struct opts *o, struct sockaddr_in *sa) {
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0 || make_addr(sa, o->host, o->port) < 0
+        || connect(fd, (struct sockaddr *)sa, sizeof(*sa)) < 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    return fd;
+}
+
+/* 等待 fd 可读最多 ms 毫秒 */
+static int wait_readable(int fd, int ms) {
+    struct pollfd pfd = { fd, POLLIN, 0 };
+    return poll(&pfd, 1, ms) > 0 && (pfd.revents & POLLIN);
+}
+
+/* 发送 secs 秒数据报，再向服务器要收到的个数 */
+static int udp_flood(struct opts *o) {
+    struct sockaddr_in sa;
+    int fd = udp_socket(o, &sa);
+    if (fd < 0) {
+        return -1;
+    }
+    uint64_t sent = 0, received = 0;
+    int len = o->len > DEFAULT_UDP_LEN ? DEFAULT_UDP_LEN : o->len;
+    buf[0] = UDP_FLOOD;
+    long long start = now_ns(), end = start + (long long)o->secs * 1000000000LL;
+    while (now_ns() < end) {
+        if (send(fd, buf, len, 0) == len) {
+            sent++;
+        }
+    }
+    long long elapsed = now_ns() - start;
+    /* 结束标记可能丢失，重发几次 */
+    int got = 0;
+    for (int i = 0; i < 10 && !got; i++) {
+        char end_mark = UDP_END;
+        send(fd, &end_mark, 1, 0);
+        if (wait_readable(fd, 500) && recv(fd, &received, sizeof(received), 0) == sizeof(received)) {
+            got = 1;
+        }
+    }
+    close(fd);
+    if (!got) {
+        errno = ETIMEDOUT;
+        return -1;
+    }
+    double secs = elapsed / 1e9;
+    printf("rnet: udp_flood len=%d sent=%llu received=%llu pps=%.0f rx_pps=%.0f gbit_s=%.3f loss_pct=%.2f\n",
+           len, (unsigned long long)sent, (unsigned long long)received, sent / secs, received / secs,
+           received * (double)len * 8 / secs / 1e9, sent ? 100.0 * (sent - received) / sent : 0.0);
+    return 0;
+}
+
+static void report_rr(const char *name, long n, long long elapsed) {
+    long samples = n < MAX_RR_SAMPLES ? n : MAX_RR_SAMPLES;
+    qsort(rr_lat, samples, sizeof(rr_lat[0]), cmp_ll);
+    printf("rnet: %s trans=%ld trans_s=%.0f lat_min_us=%lld lat_p50_us=%lld lat_p90_us=%lld lat_p99_us=%lld lat_max_us=%lld\n",
+           name, n, n / (elapsed / 1e9), rr_lat[0] / 1000, rr_lat[(samples - 1) / 2] / 1000,
+           rr_lat[(samples - 1) * 90 / 100] / 1000, rr_lat[(samples - 1) * 99 / 100] / 1000,
+           rr_lat[samples - 1] / 1000);
+}
+
+static int tcp_rr(struct opts *o) {
+    int fd = tcp_connect(o, MODE_ECHO);
+    char c = 'x';
+    if (fd < 0) {
+        return -1;
+    }
+    long long start = now_ns();
+    for (long i = 0; i < o->count; i++) {
+        long long t0 = now_ns();
+        if (write_all(fd, &c, 1) < 0 || read_all(fd, &c, 1) < 0) {
+            close(fd);
+            return -1;
+        }
+        if (i < MAX_RR_SAMPLES) {
+            rr_lat[i] = now_ns() - t0;
+        }
+    }
+    long long elapsed = now_ns() - start;
+    close(fd);
+    report_rr("tcp_rr", o->count, elapsed);
+    return 0;
+}
+
+static int udp_rr(struct opts *o) {
+    struct sockaddr_in sa;
+    int fd = udp_socket(o, &sa);
+    char req[2] = { UDP_ECHO, 0 }, resp[2];
+    long done = 0, lost = 0;
+    if (fd < 0) {
+        return -1;
+    }
+    long long start = now_ns();
+    while (done < o->count) {
+        long long t0 = now_ns();
+        send(fd, req, sizeof(req), 0);
+        /* 丢包时超时重发，不计入样本 */
+        if (!wait_readable(fd, 200) || recv(fd, resp, sizeof(resp), 0) != sizeof(resp)) {
+            if (++lost > o->count / 10 + 10) {
+                close(fd);
+                errno = ETIMEDOUT;
+                return -1;
+            }
+            continue;
+        }
+        if (done < MAX_RR_SAMPLES) {
+            rr_lat[done] = now_ns() - t0;
+        }
+        done++;
+    }
+    long long elapsed = now_ns() - start;
+    close(fd);
+    report_rr("udp_rr", done, elapsed);
+    return 0;
+}
+
+/* ===== 主程序 ===== */
+
+struct test {
+    const char *name;
+    int (*fn)(struct opts *);
+};
+
+static const struct test tests[] = {
+    { "tcp_stream", tcp_stream },
+    { "tcp_maerts", tcp_maerts },
+    { "udp_flood", udp_flood },
+    { "tcp_rr", tcp_rr },
+    { "udp_rr", udp_rr },
+};
+
+#define NR_TESTS (sizeof(tests) / sizeof(tests[0]))
+
+static void run_test(const struct test *t, struct opts *o) {
+    if (t->fn(o) < 0) {
+        printf("rnet: %s failed errno=%d\n", t->name, errno);
+    }
+    fflush(stdout);
+}
+
+int main(int argc, char **argv) {
+    struct opts o = { DEFAULT_HOST, DEFAULT_PORT, DEFAULT_SECS, DEFAULT_TCP_LEN, DEFAULT_RR_COUNT };
+    const char *mode = argc > 1 ? argv[1] : NULL;
+    int first = 2;
+
+    if (mode && strcmp(mode, "server") != 0) {
+        if (argc < 3) {
+            printf("usage: rnet server [-p port] | rnet <test> <host> [-p port] [-t secs] [-l len] [-n count]\n");
+            return 1;
+        }
+        o.host = argv[2];
+        first = 3;
+    }
+    for (int i = first; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "-p") == 0) o.port = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-t") == 0) o.secs = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-l") == 0) o.len = atoi(argv[i + 1]);
+        else if (strcmp(argv[i], "-n") == 0) o.count = atol(argv[i + 1]);
+    }
+    if (o.len < 1 || o.len > MAX_LEN) {
+        o.len = DEFAULT_TCP_LEN;
+    }
+    memset(buf, 0x5a, sizeof(buf));
+
+    if (mode && strcmp(mode, "server") == 0) {
+        return run_server(&o);
+    }
+
+    if (mode) {
+        for (unsigned i = 0; i < NR_TESTS; i++) {
+            if (strcmp(mode, tests[i].name) == 0) {
+                run_test(&tests[i], &o);
+                return 0;
+            }
+        }
+        printf("rnet: unknown test %s\n", mode);
+        return 1;
+    }
+
+    /* 不带参数：连接默认主机运行全部测试 */
+    printf("rnet: start host=%s port=%d secs=%d\n", o.host, o.port, o.secs);
+    for (unsigned i = 0; i < NR_TESTS; i++) {
+        run_test(&tests[i], &o);
+    }
+    printf("rnet: done\n");
+    fflush(stdout);
+
+    /* 作为 init 运行时不能退出 */
+    if (getpid() == 1) {
+        for (;;) {
+            pause();
+        }
+    }
+    return 0;
+}
@@ -4,8 +4,20 @@
 
 use rux_gui::{
     FramebufferDevice, FontRenderer, DoubleBuffer, MouseCursor,
-    WindowManager, SimplePanel, color,
+    WindowManager, WindowId, SimplePanel, Compositor, Offset, ScreenRect, Framebuffer,
+    InputDevice, InputEvent, color,
 };
+use rux_gui::input::ev;
+
+/// 光标大小，移动光标时重新合成原来的位置
+const CURSOR_SIZE: u32 = 16;
+
+/// 窗口内容：面板使用屏幕坐标，origin 是创建时窗口的左上角
+struct WindowContent {
+    id: WindowId,
+    origin: (u32, u32),
+    panel: SimplePanel,
+}
 
 /// 桌面环境
 struct Desktop {
@@ -14,8 +26,10 @@ struct Desktop {
     font: FontRenderer,
     cursor: MouseCursor,
     wm: WindowManager,
-    launcher_panel: SimplePanel,
-    clock_panel: SimplePanel,
+    compositor: Compositor,
+    contents: Vec<WindowContent>,
+    /// 输入事件设备，不存在时按固定间隔重绘
+    input: Option<InputDevice>,
     running: bool,
 }
 
@@ -36,13 +50,14 @@ impl Desktop {
         // 初始化字体
         let font = FontRenderer::new_8x8();
 
-        // 初始化光标
-        let cursor = MouseCursor::new(screen_width, screen_height);
+        // 初始化光标，设备支持时使用硬件光标
+        let mut cursor = MouseCursor::new(screen_width, screen_height);
+        cursor.enable_hw(&fb);
 
         // 初始化窗口管理器
         let mut wm = WindowManager::new();
-        wm.create_window("Launcher", 10, 10, 200, 300);
-        wm.create_window("Clock", 220, 10, 200, 100);
+        let launcher_id = wm.create_window("Launcher", 10, 10, 200, 300);
+        let clock_id = wm.create_window("Clock", 220, 10, 200, 100);
 
         // 创建启动器面板
         let mut launcher_panel = SimplePanel::new(10, 40, 180, 260);
@@ -56,44 +71,108 @@ impl Desktop {
         clock_panel.add_label(20, 10, "00:00:00");
         clock_panel.add_label(20, 30, "2026-02-15");
 
-        Self {
+        let compositor = Compositor::new(screen_width, screen_height);
+        let contents = vec![
+            WindowContent { id: launcher_id, origin: (10, 10), panel: launcher_panel },
+            WindowContent { id: clock_id, origin: (220, 10), panel: clock_panel },
+        ];
+
+        let desktop = Self {
             fb,
             double_buffer,
             font,
             cursor,
             wm,
-            launcher_panel,
-            clock_panel,
+            compositor,
+            contents,
+            input: InputDevice::open(),
             running: true,
-        }
+        };
+        desktop.draw_background();
+        desktop
     }
 
     fn run(&mut self) {
         while self.running {
-            // 处理输入事件（需要系统调用支持）
-            // self.handle_events();
-
-            // 绘制
-            self.draw();
+            self.handle_events();
+
+            // 窗口移动、叠放变化只产生损坏区域，只有失效的窗口重绘内容
+            self.compositor.update(&self.wm);
+            if self.compositor.has_damage() {
+                self.draw();
+                self.double_buffer.swap_buffers(&self.fb);
+            }
+
+            // 空闲时睡眠到下一个输入事件
+            match &self.input {
+                Some(input) => {
+                    input.wait(None);
+                }
+                None => std::thread::sleep(std::time::Duration::from_millis(16)),
+            }
+        }
+    }
 
-            // 刷新屏幕
-            self.double_buffer.swap_buffers(&self.fb);
+    /// 处理已经到达的全部输入事件，鼠标移动在每组事件的 SYN_REPORT 处生效
+    fn handle_events(&mut self) {
+        let mut events = [InputEvent::default(); 64];
+        let (mut dx, mut dy) = (0i32, 0i32);
+        loop {
+            let n = match &self.input {
+                Some(input) => input.read_events(&mut events),
+                None => return,
+            };
+            if n == 0 {
+                break;
+            }
+            for event in &events[..n] {
+                match (event.type_, event.code) {
+                    (ev::EV_REL, ev::REL_X) => dx += event.value,
+                    (ev::EV_REL, ev::REL_Y) => dy += event.value,
+                    (ev::EV_KEY, ev::BTN_LEFT) => {
+                        let (x, y) = (self.cursor.x as u32, self.cursor.y as u32);
+                        if event.value != 0 {
+                            if let Some(id) = self.wm.handle_mouse_down(x, y) {
+                                self.wm.remove_window(id);
+                            }
+                        } else {
+                            self.wm.handle_mouse_up();
+                        }
+                    }
+                    (ev::EV_SYN, ev::SYN_REPORT) if dx != 0 || dy != 0 => {
+                        self.move_cursor(dx, dy);
+                        dx = 0;
+                        dy = 0;
+                    }
+                    _ => {}
+                }
+            }
+        }
+    }
 
-            // 延迟
-            std::thread::sleep(std::time::Duration::from_millis(16));
+    fn move_cursor(&mut self, dx: i32, dy: i32) {
+        let (old_x, old_y) = (self.cursor.x as u32, self.cursor.y as u32);
+        self.cursor.set_position(self.cursor.x + dx, self.cursor.y + dy);
+        if self.cursor.hw {
+            // 硬件光标叠加在帧缓冲区之上，移动不产生损坏区域
+            self.cursor.sync_hw(&self.fb);
+        } else {
+            self.compositor.damage(ScreenRect::new(old_x, old_y, CURSOR_SIZE, CURSOR_SIZE));
         }
+        self.wm.handle_mouse_move(self.cursor.x as u32, self.cursor.y as u32);
     }
 
-    fn draw(&self) {
-        // 清空背景
-        self.double_buffer.clear(color::BLUE);
+    /// 绘制桌面背景和任务栏，只在创建时绘制一次
+    fn draw_background(&self) {
+        let background = self.compositor.background();
+        background.clear(color::BLUE);
 
         // 绘制任务栏
         let taskbar_height = 30u32;
         let screen_width = self.fb.width();
         let screen_height = self.fb.height();
 
-        self.double_buffer.fill_rect(
+        background.fill_rect(
             0,
             screen_height - taskbar_height,
             screen_width,
@@ -101,19 +180,24 @@ impl Desktop {
             0xFF303030,
         );
         self.font.draw_string(
-            &self.double_buffer,
+            background,
             10,
             screen_height - taskbar_height + 10,
             "Rux OS Desktop",
             color::WHITE,
         );
+    }
 
-        // 绘制窗口
-        self.wm.draw_all(&self.double_buffer, &self.font);
-
-        // 绘制面板
-        self.launcher_panel.draw(&self.double_buffer, &self.font);
-        self.clock_panel.draw(&self.double_buffer, &self.font);
+    fn draw(&mut self) {
+        // 合成损坏区域
+        let contents = &self.contents;
+        let font = &self.font;
+        self.compositor.composite(&self.double_buffer, &self.wm, font, |window, surface| {
+            if let Some(content) = contents.iter().find(|c| c.id == window.id) {
+                let (ox, oy) = content.origin;
+                content.panel.draw(&Offset::new(surface, ox, oy), font);
+            }
+        });
 
         // 绘制光标
         self.cursor.draw(&self.double_buffer);
@@ -0,0 +1,416 @@
+//! 窗口合成器
+//!
+//! 每个窗口拥有一块离屏表面 (Surface)，只有被 invalidate 或大小变化时才重绘
+//! 窗口内容；移动、叠放次序变化只产生屏幕上的损坏区域，不重绘任何控件。
+//!
+//! 合成时对每个损坏矩形逐行从前往后遍历窗口：每一行维护尚未被覆盖的区间，
+//! 前面的窗口写入后把对应区间去掉，被完全遮住的窗口不会被读取，屏幕上每个像素
+//! 只写一次（遮挡剔除）；剩下的区间取自桌面背景表面。合成完成后把损坏矩形交给
+//! 目标的 flush_rect，显示设备只刷新这些区域。
+
+use std::cell::UnsafeCell;
+use std::collections::BTreeMap;
+use std::vec;
+use std::vec::Vec;
+
+use crate::font::FontRenderer;
+use crate::framebuffer::{color, Framebuffer};
+use crate::span;
+use crate::window::{Window, WindowId, WindowManager};
+
+/// 窗口阴影向右下的偏移
+pub const SHADOW_OFFSET: u32 = 4;
+
+/// 每帧最多记录的损坏矩形数，超过时合并为外接矩形
+const MAX_DAMAGE_RECTS: usize = 16;
+
+/// 离屏表面
+pub struct Surface {
+    pixels: UnsafeCell<Vec<u32>>,
+    width: u32,
+    height: u32,
+}
+
+impl Surface {
+    pub fn new(width: u32, height: u32) -> Self {
+        Self {
+            pixels: UnsafeCell::new(vec![0u32; (width * height) as usize]),
+            width,
+            height,
+        }
+    }
+
+    #[inline]
+    pub fn width(&self) -> u32 {
+        self.width
+    }
+
+    #[inline]
+    pub fn height(&self) -> u32 {
+        self.height
+    }
+
+    /// 第 y 行的全部像素
+    #[inline]
+    pub fn row(&self, y: u32) -> &[u32] {
+        let start = (y * self.width) as usize;
+        unsafe { &(&*self.pixels.get())[start..start + self.width as usize] }
+    }
+
+    /// 第 y 行从 x 开始的 len 个像素，调用者保证不越界
+    #[inline]
+    #[allow(clippy::mut_from_ref)]
+    unsafe fn span_mut(&self, x: u32, y: u32, len: u32) -> &mut [u32] {
+        let start = (y * self.width + x) as usize;
+        &mut (&mut *self.pixels.get())[start..start + len as usize]
+    }
+}
+
+impl Framebuffer for Surface {
+    fn put_pixel(&self, x: u32, y: u32, color: u32) {
+        if x < self.width && y < self.height {
+            unsafe { self.span_mut(x, y, 1)[0] = color };
+        }
+    }
+
+    fn width(&self) -> u32 {
+        self.width
+    }
+
+    fn height(&self) -> u32 {
+        self.height
+    }
+
+    fn fill_span(&self, x: u32, y: u32, len: u32, color: u32) {
+        if x >= self.width || y >= self.height {
+            return;
+        }
+        let len = len.min(self.width - x);
+        span::fill_span(unsafe { self.span_mut(x, y, len) }, color);
+    }
+
+    fn write_span(&self, x: u32, y: u32, pixels: &[u32]) {
+        if x >= self.width || y >= self.height {
+            return;
+        }
+        let len = (pixels.len() as u32).min(self.width - x);
+        span::copy_span(unsafe { self.span_mut(x, y, len) }, pixels);
+    }
+}
+
+/// 把屏幕坐标平移到 (ox, oy) 为原点的目标上
+///
+/// 控件使用屏幕坐标，绘制到窗口表面时经过它换算；原点左上方的部分被裁掉
+pub struct Offset<'a, F: Framebuffer> {
+    target: &'a F,
+    ox: u32,
+    oy: u32,
+}
+
+impl<'a, F: Framebuffer> Offset<'a, F> {
+    pub fn new(target: &'a F, ox: u32, oy: u32) -> Self {
+        Self { target, ox, oy }
+    }
+}
+
+impl<'a, F: Framebuffer> Framebuffer for Offset<'a, F> {
+    fn put_pixel(&self, x: u32, y: u32, color: u32) {
+        if x >= self.ox && y >= self.oy {
+            self.target.put_pixel(x - self.ox, y - self.oy, color);
+        }
+    }
+
+    fn width(&self) -> u32 {
+        self.ox.saturating_add(self.target.width())
+    }
+
+    fn height(&self) -> u32 {
+        self.oy.saturating_add(self.target.height())
+    }
+
+    fn fill_span(&self, x: u32, y: u32, len: u32, color: u32) {
+        if y < self.oy {
+            return;
+        }
+        let skip = self.ox.saturating_sub(x);
+        if skip < len {
+            self.target.fill_span(x + skip - self.ox, y - self.oy, len - skip, color);
+        }
+    }
+
+    fn write_span(&self, x: u32, y: u32, pixels: &[u32]) {
+        if y < self.oy {
+            return;
+        }
+        let skip = self.ox.saturating_sub(x) as usize;
+        if skip < pixels.len() {
+            self.target.write_span(x + skip as u32 - self.ox, y - self.oy, &pixels[skip..]);
+        }
+    }
+}
+
+/// 屏幕矩形 [x0, x1) x [y0, y1)
+#[derive(Clone, Copy, Debug, PartialEq, Eq)]
+pub struct ScreenRect {
+    pub x0: u32,
+    pub y0: u32,
+    pub x1: u32,
+    pub y1: u32,
+}
+
+impl ScreenRect {
+    pub fn new(x: u32, y: u32, width: u32, height: u32) -> Self {
+        Self { x0: x, y0: y, x1: x.saturating_add(width), y1: y.saturating_add(height) }
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.x0 >= self.x1 || self.y0 >= self.y1
+    }
+
+    fn intersects(&self, other: &ScreenRect) -> bool {
+        self.x0 < other.x1 && other.x0 < self.x1 && self.y0 < other.y1 && other.y0 < self.y1
+    }
+
+    fn union(&self, other: &ScreenRect) -> ScreenRect {
+        ScreenRect {
+            x0: self.x0.min(other.x0),
+            y0: self.y0.min(other.y0),
+            x1: self.x1.max(other.x1),
+            y1: self.y1.max(other.y1),
+        }
+    }
+}
+
+/// 窗口在屏幕上的一行里占据的一段
+enum LayerSpan<'a> {
+    /// 窗口表面的一行，从 x0 开始
+    Pixels { x0: u32, x1: u32, row: &'a [u32] },
+    /// 纯色（阴影）
+    Solid { x0: u32, x1: u32, color: u32 },
+}
+
+/// 一个窗口的合成状态
+struct Layer {
+    surface: Surface,
+    x: u32,
+    y: u32,
+    z: u32,
+    /// 表面内容是最新的
+    valid: bool,
+}
+
+impl Layer {
+    /// 窗口和阴影覆盖的屏幕区域
+    fn bounds(&self) -> ScreenRect {
+        ScreenRect::new(self.x, self.y, self.surface.width() + SHADOW_OFFSET, self.surface.height() + SHADOW_OFFSET)
+    }
+
+    /// 屏幕第 y 行上窗口占据的段，最多两段：窗口本身和右侧阴影，或者只有底部阴影
+    fn row_spans<'a>(&'a self, y: u32, out: &mut Vec<LayerSpan<'a>>) {
+        let (w, h) = (self.surface.width(), self.surface.height());
+        if y < self.y || y >= self.y + h + SHADOW_OFFSET {
+            return;
+        }
+        let ry = y - self.y;
+        if ry < h {
+            out.push(LayerSpan::Pixels { x0: self.x, x1: self.x + w, row: self.surface.row(ry) });
+            if ry >= SHADOW_OFFSET {
+                out.push(LayerSpan::Solid { x0: self.x + w, x1: self.x + w + SHADOW_OFFSET, color: color::DARK_GRAY });
+            }
+        } else {
+            out.push(LayerSpan::Solid {
+                x0: self.x + SHADOW_OFFSET,
+                x1: self.x + w + SHADOW_OFFSET,
+                color: color::DARK_GRAY,
+            });
+        }
+    }
+}
+
+/// 窗口合成器
+pub struct Compositor {
+    width: u32,
+    height: u32,
+    /// 桌面背景，窗口没有覆盖的地方取自这里
+    background: Surface,
+    layers: BTreeMap<WindowId, Layer>,
+    /// 本帧的损坏矩形，两两不相交
+    damage: Vec<ScreenRect>,
+}
+
+impl Compositor {
+    pub fn new(width: u32, height: u32) -> Self {
+        Self {
+            width,
+            height,
+            background: Surface::new(width, height),
+            layers: BTreeMap::new(),
+            damage: vec![ScreenRect::new(0, 0, width, height)],
+        }
+    }
+
+    /// 桌面背景表面；绘制后调用 damage 报告修改的区域
+    pub fn background(&self) -> &Surface {
+        &self.background
+    }
+
+    /// 记录屏幕上需要重新合成的矩形
+    pub fn damage(&mut self, rect: ScreenRect) {
+        let mut rect = ScreenRect {
+            x0: rect.x0.min(self.width),
+            y0: rect.y0.min(self.height),
+            x1: rect.x1.min(self.width),
+            y1: rect.y1.min(self.height),
+        };
+        if rect.is_empty() {
+            return;
+        }
+        while let Some(pos) = self.damage.iter().position(|r| r.intersects(&rect)) {
+            rect = rect.union(&self.damage.swap_remove(pos));
+        }
+        self.damage.push(rect);
+        if self.damage.len() > MAX_DAMAGE_RECTS {
+            let bounding = self.damage.iter().skip(1).fold(self.damage[0], |acc, r| acc.union(r));
+            self.damage.clear();
+            self.damage.push(bounding);
+        }
+    }
+
+    /// 整个屏幕都需要重新合成
+    pub fn damage_all(&mut self) {
+        self.damage(ScreenRect::new(0, 0, self.width, self.height));
+    }
+
+    /// 窗口内容变化，下一次合成时重绘它的表面
+    pub fn invalidate(&mut self, id: WindowId) {
+        if let Some(layer) = self.layers.get_mut(&id) {
+            layer.valid = false;
+        }
+    }
+
+    /// 是否有需要合成的内容
+    pub fn has_damage(&self) -> bool {
+        !self.damage.is_empty() || self.layers.values().any(|l| !l.valid)
+    }
+
+    /// 本帧的损坏矩形
+    pub fn damage_rects(&self) -> &[ScreenRect] {
+        &self.damage
+    }
+
+    /// 与窗口管理器同步：新建、关闭、移动、改变大小和叠放次序都转换为损坏区域
+    pub fn update(&mut self, wm: &WindowManager) {
+        let mut damage = Vec::new();
+        let mut alive = Vec::new();
+        for w in wm.windows().into_iter().filter(|w| w.visible) {
+            alive.push(w.id);
+            match self.layers.get_mut(&w.id) {
+                None => {
+                    let layer = Layer { surface: Surface::new(w.width, w.height), x: w.x, y: w.y, z: w.z_order, valid: false };
+                    damage.push(layer.bounds());
+                    self.layers.insert(w.id, layer);
+                }
+                Some(layer) => {
+                    let old = layer.bounds();
+                    if layer.surface.width() != w.width || layer.surface.height() != w.height {
+                        layer.surface = Surface::new(w.width, w.height);
+                        layer.valid = false;
+                    }
+                    let moved = (layer.x, layer.y) != (w.x, w.y);
+                    let restacked = layer.z != w.z_order;
+                    layer.x = w.x;
+                    layer.y = w.y;
+                    layer.z = w.z_order;
+                    if moved || !layer.valid {
+                        damage.push(old);
+                    }
+                    if moved || restacked || !layer.valid {
+                        damage.push(layer.bounds());
+                    }
+                }
+            }
+        }
+        let closed: Vec<WindowId> = self.layers.keys().copied().filter(|id| !alive.contains(id)).collect();
+        for id in closed {
+            if let Some(layer) = self.layers.remove(&id) {
+                damage.push(layer.bounds());
+            }
+        }
+        for rect in damage {
+            self.damage(rect);
+        }
+    }
+
+    /// 重绘失效的窗口表面，按损坏矩形合成到 fb 并通知显示设备
+    ///
+    /// paint 绘制窗口内容，收到的表面以窗口左上角为原点；控件使用屏幕坐标时
+    /// 用 Offset::new(surface, window.x, window.y) 换算
+    pub fn composite<F, P>(&mut self, fb: &F, wm: &WindowManager, font: &FontRenderer, mut paint: P)
+    where
+        F: Framebuffer,
+        P: FnMut(&Window, &Surface),
+    {
+        for (id, layer) in self.layers.iter_mut().filter(|(_, l)| !l.valid) {
+            if let Some(window) = wm.get_window(*id) {
+                window.draw_body(&layer.surface, font, 0, 0);
+                paint(window, &layer.surface);
+            }
+            layer.valid = true;
+        }
+
+        // 从前往后
+        let mut order: Vec<&Layer> = self.layers.values().collect();
+        order.sort_by(|a, b| b.z.cmp(&a.z));
+
+        let mut spans = Vec::new();
+        let mut uncovered: Vec<(u32, u32)> = Vec::new();
+        let mut remaining: Vec<(u32, u32)> = Vec::new();
+        for rect in &self.damage {
+            for y in rect.y0..rect.y1 {
+                uncovered.clear();
+                uncovered.push((rect.x0, rect.x1));
+                for layer in &order {
+                    if uncovered.is_empty() {
+                        break;
+                    }
+                    spans.clear();
+                    layer.row_spans(y, &mut spans);
+                    for s in &spans {
+                        let (sx0, sx1) = match *s {
+                            LayerSpan::Pixels { x0, x1, .. } | LayerSpan::Solid { x0, x1, .. } => (x0, x1),
+                        };
+                        remaining.clear();
+                        for &(u0, u1) in &uncovered {
+                            let (c0, c1) = (u0.max(sx0), u1.min(sx1));
+                            if c0 >= c1 {
+                                remaining.push((u0, u1));
+                                continue;
+                            }
+                            match *s {
+                                LayerSpan::Pixels { x0, row, .. } => {
+                                    fb.write_span(c0, y, &row[(c0 - x0) as usize..(c1 - x0) as usize]);
+                                }
+                                LayerSpan::Solid { color, .. } => fb.fill_span(c0, y, c1 - c0, color),
+                            }
+                            if u0 < c0 {
+                                remaining.push((u0, c0));
+                            }
+                            if c1 < u1 {
+                                remaining.push((c1, u1));
+                            }
+                        }
+                        core::mem::swap(&mut uncovered, &mut remaining);
+                    }
+                }
+                let bg = self.background.row(y);
+                for &(u0, u1) in &uncovered {
+                    fb.write_span(u0, y, &bg[u0 as usize..u1 as usize]);
+                }
+            }
+        }
+
+        for rect in self.damage.drain(..) {
+            fb.flush_rect(rect.x0, rect.y0, rect.x1 - rect.x0, rect.y1 - rect.y0);
+        }
+    }
+}
@@ -1,4 +1,7 @@
 //! 鼠标光标
+//!
+//! 设备支持时光标由显示设备叠加 (FBIO_CURSOR)，移动只需一次 ioctl，
+//! 不重绘也不刷新光标下的区域；否则每帧把光标画进帧缓冲区
 
 /// 默认箭头光标 (16x16)
 const ARROW_CURSOR: [u16; 16] = [
@@ -52,6 +55,8 @@ pub struct MouseCursor {
     pub screen_width: u32,
     pub screen_height: u32,
     pub visible: bool,
+    /// 使用硬件光标，draw 不再绘制
+    pub hw: bool,
 }
 
 impl MouseCursor {
@@ -62,9 +67,59 @@ impl MouseCursor {
             screen_width,
             screen_height,
             visible: true,
+            hw: false,
         }
     }
 
+    /// 把箭头上传为硬件光标，掩码外的像素透明
+    ///
+    /// 返回 false 时设备没有硬件光标，继续使用软件光标
+    pub fn enable_hw(&mut self, fb: &crate::framebuffer::FramebufferDevice) -> bool {
+        let mut image = [0u32; 16 * 16];
+        for py in 0..16usize {
+            for px in 0..16usize {
+                let mask_bit = (ARROW_MASK[py] >> (15 - px)) & 1;
+                let cursor_bit = (ARROW_CURSOR[py] >> (15 - px)) & 1;
+                if mask_bit != 0 {
+                    image[py * 16 + px] = if cursor_bit != 0 {
+                        cursor_color::BLACK
+                    } else {
+                        cursor_color::WHITE
+                    };
+                }
+            }
+        }
+        let cursor = crate::framebuffer::FbCursor {
+            set: crate::framebuffer::FB_CUR_SETIMAGE | crate::framebuffer::FB_CUR_SETPOS
+                | crate::framebuffer::FB_CUR_SETHOT,
+            enable: self.visible as u32,
+            x: self.x as u32,
+            y: self.y as u32,
+            hot_x: 0,
+            hot_y: 0,
+            width: 16,
+            height: 16,
+            image: image.as_ptr() as u64,
+        };
+        self.hw = fb.set_cursor(&cursor);
+        self.hw
+    }
+
+    /// 把当前位置与可见性交给硬件光标
+    pub fn sync_hw(&self, fb: &crate::framebuffer::FramebufferDevice) {
+        if !self.hw {
+            return;
+        }
+        let cursor = crate::framebuffer::FbCursor {
+            set: crate::framebuffer::FB_CUR_SETPOS,
+            enable: self.visible as u32,
+            x: self.x as u32,
+            y: self.y as u32,
+            ..Default::default()
+        };
+        fb.set_cursor(&cursor);
+    }
+
     pub fn move_by(&mut self, dx: i16, dy: i16) {
         self.x = (self.x + dx as i32).clamp(0, (self.screen_width - 1) as i32);
         self.y = (self.y + dy as i32).clamp(0, (self.screen_height - 1) as i32);
@@ -76,7 +131,7 @@ impl MouseCursor {
     }
 
     pub fn draw<F: crate::framebuffer::Framebuffer>(&self, fb: &F) {
-        if !self.visible {
+        if !self.visible || self.hw {
             return;
         }
 
@@ -2,14 +2,20 @@
 //!
 //! 提供无闪烁的图形渲染
 
+use std::cell::UnsafeCell;
 use std::vec;
 use std::vec::Vec;
 use crate::framebuffer::Framebuffer;
+use crate::span;
 
 /// 双缓冲管理器
+///
+/// 每行记录自上次 swap_buffers 以来修改过的像素范围，swap 只按行复制这些范围
 pub struct DoubleBuffer {
     /// 后端缓冲区
-    back_buffer: Vec<u32>,
+    back_buffer: UnsafeCell<Vec<u32>>,
+    /// 每行修改过的像素范围 [start, end)，start >= end 表示这一行没有修改
+    dirty: UnsafeCell<Vec<(u32, u32)>>,
     /// 屏幕宽度
     width: u32,
     /// 屏幕高度
@@ -24,7 +30,8 @@ impl DoubleBuffer {
     /// 创建新的双缓冲系统
     pub fn new() -> Self {
         Self {
-            back_buffer: Vec::new(),
+            back_buffer: UnsafeCell::new(Vec::new()),
+            dirty: UnsafeCell::new(Vec::new()),
             width: 0,
             height: 0,
             stride: 0,
@@ -40,10 +47,12 @@ impl DoubleBuffer {
 
         self.width = width;
         self.height = height;
-        self.stride = stride;
+        self.stride = stride.max(width);
 
-        let buffer_size = (stride * height) as usize;
-        self.back_buffer = vec![0u32; buffer_size];
+        let buffer_size = (self.stride * height) as usize;
+        self.back_buffer = UnsafeCell::new(vec![0u32; buffer_size]);
+        // 第一次 swap 复制整个屏幕
+        self.dirty = UnsafeCell::new(vec![(0, width); height as usize]);
 
         self.initialized = true;
     }
@@ -65,6 +74,37 @@ impl DoubleBuffer {
         self.height
     }
 
+    /// 第 y 行从 x 开始的 len 个像素，调用者保证不越界
+    ///
+    /// 缓冲区只在本线程内通过 &self 修改，同一时刻只有一个行切片存活
+    #[inline]
+    #[allow(clippy::mut_from_ref)]
+    unsafe fn span_mut(&self, x: u32, y: u32, len: u32) -> &mut [u32] {
+        let start = (y * self.stride + x) as usize;
+        &mut (&mut *self.back_buffer.get())[start..start + len as usize]
+    }
+
+    /// 记录第 y 行 [x0, x1) 被修改
+    #[inline]
+    fn mark_dirty(&self, y: u32, x0: u32, x1: u32) {
+        let row = unsafe { &mut (&mut *self.dirty.get())[y as usize] };
+        if row.0 >= row.1 {
+            *row = (x0, x1);
+        } else {
+            *row = (row.0.min(x0), row.1.max(x1));
+        }
+    }
+
+    /// 下一次 swap_buffers 复制整个屏幕（前端内容被其他程序覆盖后调用）
+    pub fn mark_all_dirty(&self) {
+        if !self.initialized {
+            return;
+        }
+        for row in unsafe { (&mut *self.dirty.get()).iter_mut() } {
+            *row = (0, self.width);
+        }
+    }
+
     /// 绘制像素
     #[inline]
     pub fn put_pixel(&self, x: u32, y: u32, color: u32) {
@@ -72,13 +112,8 @@ impl DoubleBuffer {
             return;
         }
 
-        let offset = (y * self.stride + x) as usize;
-        if offset < self.back_buffer.len() {
-            unsafe {
-                let ptr = self.back_buffer.as_ptr() as *mut u32;
-                core::ptr::write_volatile(ptr.add(offset), color);
-            }
-        }
+        unsafe { self.span_mut(x, y, 1)[0] = color };
+        self.mark_dirty(y, x, x + 1);
     }
 
     /// 获取像素
@@ -88,12 +123,27 @@ impl DoubleBuffer {
             return 0;
         }
 
-        let offset = (y * self.stride + x) as usize;
-        if offset < self.back_buffer.len() {
-            self.back_buffer[offset]
-        } else {
-            0
+        unsafe { (&*self.back_buffer.get())[(y * self.stride + x) as usize] }
+    }
+
+    /// 从 (x, y) 开始向右填充 len 个像素
+    pub fn fill_span(&self, x: u32, y: u32, len: u32, color: u32) {
+        if !self.initialized || x >= self.width || y >= self.height || len == 0 {
+            return;
         }
+        let len = len.min(self.width - x);
+        span::fill_span(unsafe { self.span_mut(x, y, len) }, color);
+        self.mark_dirty(y, x, x + len);
+    }
+
+    /// 把一行像素写到 (x, y) 开始的位置
+    pub fn write_span(&self, x: u32, y: u32, pixels: &[u32]) {
+        if !self.initialized || x >= self.width || y >= self.height || pixels.is_empty() {
+            return;
+        }
+        let len = (pixels.len() as u32).min(self.width - x);
+        span::copy_span(unsafe { self.span_mut(x, y, len) }, pixels);
+        self.mark_dirty(y, x, x + len);
     }
 
     /// 填充矩形
@@ -102,16 +152,18 @@ impl DoubleBuffer {
             return;
         }
 
-        let x_end = (x + width).min(self.width);
-        let y_end = (y + height).min(self.height);
-
-        for py in y..y_end {
-            for px in x..x_end {
-                self.put_pixel(px, py, color);
+        if let Some((x0, y0, x1, y1)) = span::clip_rect(x, y, width, height, self.width, self.height) {
+            for py in y0..y1 {
+                self.fill_span(x0, py, x1 - x0, color);
             }
         }
     }
 
+    /// 绘制位图：pixels 中每行 src_stride 个像素
+    pub fn blit_bitmap(&self, x: u32, y: u32, width: u32, height: u32, pixels: &[u32], src_stride: u32) {
+        Framebuffer::blit_bitmap(self, x, y, width, height, pixels, src_stride);
+    }
+
     /// 绘制矩形边框
     pub fn blit_rect(&self, x: u32, y: u32, width: u32, height: u32, color: u32, thickness: u32) {
         self.fill_rect(x, y, width, thickness, color);
@@ -172,16 +224,33 @@ impl DoubleBuffer {
     }
 
     /// 复制到前端 framebuffer
+    ///
+    /// 只按行复制上次 swap 以来修改过的范围，复制完后通知显示设备刷新这些行的外接矩形
     pub fn swap_buffers<F: Framebuffer>(&self, fb: &F) {
         if !self.initialized {
             return;
         }
 
-        for y in 0..self.height {
-            for x in 0..self.width {
-                let color = self.get_pixel(x, y);
-                fb.put_pixel(x, y, color);
+        let dirty = unsafe { &mut *self.dirty.get() };
+        let buffer = unsafe { &*self.back_buffer.get() };
+        let mut bounds: Option<(u32, u32, u32, u32)> = None;
+        for (y, row) in dirty.iter_mut().enumerate() {
+            let (x0, x1) = *row;
+            if x0 >= x1 {
+                continue;
             }
+            *row = (0, 0);
+            let y = y as u32;
+            let start = (y * self.stride) as usize;
+            fb.write_span(x0, y, &buffer[start + x0 as usize..start + x1 as usize]);
+            bounds = Some(match bounds {
+                None => (x0, y, x1, y + 1),
+                Some((bx0, by0, bx1, _)) => (bx0.min(x0), by0, bx1.max(x1), y + 1),
+            });
+        }
+
+        if let Some((x0, y0, x1, y1)) = bounds {
+            fb.flush_rect(x0, y0, x1 - x0, y1 - y0);
         }
     }
 }
@@ -197,6 +266,18 @@ impl Framebuffer for DoubleBuffer {
         self.put_pixel(x, y, color);
     }
 
+    fn fill_span(&self, x: u32, y: u32, len: u32, color: u32) {
+        self.fill_span(x, y, len, color);
+    }
+
+    fn write_span(&self, x: u32, y: u32, pixels: &[u32]) {
+        self.write_span(x, y, pixels);
+    }
+
+    fn fill_rect(&self, x: u32, y: u32, width: u32, height: u32, color: u32) {
+        self.fill_rect(x, y, width, height, color);
+    }
+
     fn width(&self) -> u32 {
         self.width
     }
@@ -1,6 +1,15 @@
 //! 8x8 位图字体渲染
 //!
 //! 提供基础的 ASCII 字符渲染功能 (0x20-0x7F)
+//!
+//! 字形在编译期预先光栅化为每行的像素跨度 (GlyphAtlas)，绘制时每段调用一次
+//! fill_span，不再逐位测试、逐像素绘制。整行文字的跨度由 TextCache 按字符串缓存，
+//! 相邻字符在同一行上首尾相接的跨度合并为一段；字形是单色掩码，颜色在绘制时指定，
+//! 同一字符串换颜色也命中缓存。
+
+use core::cell::RefCell;
+use std::string::String;
+use std::vec::Vec;
 
 use crate::framebuffer::Framebuffer;
 
@@ -109,12 +118,190 @@ pub const FONT_8x8: [u8; 720] = [
     0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // '~'
 ];
 
+/// 字体数据覆盖的第一个和最后一个字符
+const FIRST_CHAR: u8 = 0x20;
+const LAST_CHAR: u8 = 0x79;
+const NR_GLYPHS: usize = (LAST_CHAR - FIRST_CHAR + 1) as usize;
+
+/// 8 位的一行最多有 4 段不相连的像素
+const MAX_ROW_SPANS: usize = 4;
+
+/// 字形一行中的一段连续像素：起始列与长度
+#[derive(Clone, Copy, Default)]
+struct GlyphSpan {
+    x: u8,
+    len: u8,
+}
+
+/// 一个字形：每行的跨度
+#[derive(Clone, Copy)]
+struct Glyph {
+    spans: [[GlyphSpan; MAX_ROW_SPANS]; 8],
+    nr_spans: [u8; 8],
+}
+
+/// 预先光栅化的字形表
+struct GlyphAtlas {
+    glyphs: [Glyph; NR_GLYPHS],
+}
+
+impl GlyphAtlas {
+    /// 把位图字体的每一行拆成连续像素段
+    const fn build(font: &[u8; 720]) -> Self {
+        let empty = Glyph {
+            spans: [[GlyphSpan { x: 0, len: 0 }; MAX_ROW_SPANS]; 8],
+            nr_spans: [0; 8],
+        };
+        let mut glyphs = [empty; NR_GLYPHS];
+        let mut g = 0;
+        while g < NR_GLYPHS {
+            let mut row = 0;
+            while row < 8 {
+                let bits = font[g * 8 + row];
+                let mut n = 0;
+                let mut px = 0;
+                while px < 8 {
+                    if (bits >> (7 - px)) & 1 != 0 {
+                        let start = px;
+                        while px < 8 && (bits >> (7 - px)) & 1 != 0 {
+                            px += 1;
+                        }
+                        glyphs[g].spans[row][n] = GlyphSpan { x: start as u8, len: (px - start) as u8 };
+                        n += 1;
+                    } else {
+                        px += 1;
+                    }
+                }
+                glyphs[g].nr_spans[row] = n as u8;
+                row += 1;
+            }
+            g += 1;
+        }
+        Self { glyphs }
+    }
+
+    /// 字符的字形，字体之外的字符返回 None
+    fn glyph(&self, ch: u8) -> Option<&Glyph> {
+        if !(FIRST_CHAR..=LAST_CHAR).contains(&ch) {
+            return None;
+        }
+        Some(&self.glyphs[(ch - FIRST_CHAR) as usize])
+    }
+}
+
+static ATLAS: GlyphAtlas = GlyphAtlas::build(&FONT_8x8);
+
+/// 一段光栅化的文字中一行上的一段连续像素，坐标相对文字左上角
+#[derive(Clone, Copy, PartialEq, Eq, Debug)]
+pub struct TextSpan {
+    pub x: u32,
+    pub y: u32,
+    pub len: u32,
+}
+
+/// 一行文字光栅化后的所有跨度，按行排列
+pub struct TextRun {
+    spans: Vec<TextSpan>,
+}
+
+impl TextRun {
+    /// 光栅化一行文字（不含换行）
+    fn rasterize(text: &str, advance: u32) -> Self {
+        let mut spans: Vec<TextSpan> = Vec::new();
+        for row in 0..8u32 {
+            let row_start = spans.len();
+            for (i, ch) in text.bytes().enumerate() {
+                let glyph = match ATLAS.glyph(ch) {
+                    Some(glyph) => glyph,
+                    None => continue,
+                };
+                let base = i as u32 * advance;
+                for s in &glyph.spans[row as usize][..glyph.nr_spans[row as usize] as usize] {
+                    let x = base + s.x as u32;
+                    // 与同一行上一段首尾相接时合并
+                    match spans[row_start..].last_mut() {
+                        Some(last) if last.x + last.len == x => last.len += s.len as u32,
+                        _ => spans.push(TextSpan { x, y: row, len: s.len as u32 }),
+                    }
+                }
+            }
+        }
+        Self { spans }
+    }
+
+    /// 所有跨度
+    pub fn spans(&self) -> &[TextSpan] {
+        &self.spans
+    }
+
+    /// 以 (x, y) 为左上角绘制
+    pub fn draw<F: Framebuffer>(&self, fb: &F, x: u32, y: u32, color: u32) {
+        for s in &self.spans {
+            fb.fill_span(x.saturating_add(s.x), y.saturating_add(s.y), s.len, color);
+        }
+    }
+}
+
+/// 每帧重绘相同标签时使用的文字缓存，最多 TEXT_CACHE_SIZE 项
+const TEXT_CACHE_SIZE: usize = 64;
+
+/// 按字符串缓存光栅化结果，最近使用的在最后，满了淘汰最久未用的
+pub struct TextCache {
+    entries: RefCell<Vec<(String, TextRun)>>,
+}
+
+impl TextCache {
+    pub const fn new() -> Self {
+        Self { entries: RefCell::new(Vec::new()) }
+    }
+
+    /// 取出 text 的光栅化结果交给 f，没有缓存时先光栅化
+    fn with_run<R>(&self, text: &str, advance: u32, f: impl FnOnce(&TextRun) -> R) -> R {
+        let mut entries = self.entries.borrow_mut();
+        match entries.iter().position(|(key, _)| key == text) {
+            Some(pos) => {
+                let entry = entries.remove(pos);
+                entries.push(entry);
+            }
+            None => {
+                if entries.len() >= TEXT_CACHE_SIZE {
+                    entries.remove(0);
+                }
+                entries.push((String::from(text), TextRun::rasterize(text, advance)));
+            }
+        }
+        f(&entries.last().unwrap().1)
+    }
+
+    /// 缓存的字符串数
+    pub fn len(&self) -> usize {
+        self.entries.borrow().len()
+    }
+
+    pub fn is_empty(&self) -> bool {
+        self.entries.borrow().is_empty()
+    }
+
+    /// 丢弃所有缓存
+    pub fn clear(&self) {
+        self.entries.borrow_mut().clear();
+    }
+}
+
+impl Default for TextCache {
+    fn default() -> Self {
+        Self::new()
+    }
+}
+
 /// 字体渲染器
 pub struct FontRenderer {
     /// 字体宽度
     width: u32,
     /// 字体高度
     height: u32,
+    /// 整行文字的光栅化缓存
+    cache: TextCache,
 }
 
 impl FontRenderer {
@@ -123,9 +310,16 @@ impl FontRenderer {
         Self {
             width: 8,
             height: 8,
+            cache: TextCache::new(),
         }
     }
 
+    /// 文字缓存
+    #[inline]
+    pub fn cache(&self) -> &TextCache {
+        &self.cache
+    }
+
     /// 获取字体宽度
     #[inline]
     pub const fn width(&self) -> u32 {
@@ -141,37 +335,30 @@ impl FontRenderer {
     /// 绘制单个字符
     pub fn draw_char<F: Framebuffer>(&self, fb: &F, x: u32, y: u32, ch: u8, color: u32) {
         // 字体数据覆盖 0x20-0x7F (但实际只有 90 个字符: 0x20-0x79)
-        if ch < 0x20 || ch > 0x79 {
-            return;
-        }
-
-        let idx = (ch - 0x20) as usize;
-        let base = idx * 8;
+        let glyph = match ATLAS.glyph(ch) {
+            Some(glyph) => glyph,
+            None => return,
+        };
 
         for py in 0..8 {
-            let row_data = FONT_8x8[base + py as usize];
-            for px in 0..8 {
-                let bit = (row_data >> (7 - px)) & 1;
-                if bit != 0 {
-                    fb.put_pixel(x + px, y + py, color);
-                }
+            for s in &glyph.spans[py][..glyph.nr_spans[py] as usize] {
+                fb.fill_span(x.saturating_add(s.x as u32), y.saturating_add(py as u32), s.len as u32, color);
             }
         }
     }
 
     /// 绘制字符串
-    pub fn draw_string<F: Framebuffer>(&self, fb: &F, mut x: u32, mut y: u32, text: &str, color: u32) {
-        for ch in text.bytes() {
-            match ch {
-                b'\n' => {
-                    y += self.height;
-                    x = 0;
-                }
-                _ => {
-                    self.draw_char(fb, x, y, ch, color);
-                    x += self.width;
-                }
+    ///
+    /// 每行文字取自缓存；换行后从 x = 0 开始下一行
+    pub fn draw_string<F: Framebuffer>(&self, fb: &F, x: u32, y: u32, text: &str, color: u32) {
+        let mut line_x = x;
+        let mut line_y = y;
+        for line in text.split('\n') {
+            if !line.is_empty() {
+                self.cache.with_run(line, self.width, |run| run.draw(fb, line_x, line_y, color));
             }
+            line_y += self.height;
+            line_x = 0;
         }
     }
 
@@ -4,6 +4,7 @@
 
 use core::ptr::write_volatile;
 use core::ptr::read_volatile;
+use crate::span;
 
 /// 系统调用号 (RISC-V Linux ABI)
 mod syscall {
@@ -15,6 +16,10 @@ mod syscall {
     /// Framebuffer ioctl 命令
     pub const FBIOGET_FSCREENINFO: u32 = 0x4602;
     pub const FBIOGET_VSCREENINFO: u32 = 0x4600;
+    /// 报告损坏区域并刷新 (Rux 扩展)
+    pub const FBIO_DAMAGE: u32 = 0x46F0;
+    /// 设置硬件光标 (Rux 扩展)
+    pub const FBIO_CURSOR: u32 = 0x46F2;
 }
 
 /// 保护标志
@@ -126,10 +131,49 @@ impl Default for FbVarScreeninfo {
     }
 }
 
+/// 损坏矩形 (与内核 damage.rs 对应)
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct FbDamageRect {
+    pub x: u32,
+    pub y: u32,
+    pub width: u32,
+    pub height: u32,
+}
+
+/// FBIO_DAMAGE 参数 (与内核 fbdev.rs 对应)
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct FbDamage {
+    pub num_rects: u32,
+    pub flags: u32,
+    pub rects: u64,
+}
+
+/// FBIO_CURSOR 的 set 位 (与内核 fbdev.rs 对应)
+pub const FB_CUR_SETIMAGE: u32 = 0x01;
+pub const FB_CUR_SETPOS: u32 = 0x02;
+pub const FB_CUR_SETHOT: u32 = 0x04;
+
+/// FBIO_CURSOR 参数 (与内核 fbdev.rs 对应)
+#[repr(C)]
+#[derive(Clone, Copy, Default)]
+pub struct FbCursor {
+    pub set: u32,
+    pub enable: u32,
+    pub x: u32,
+    pub y: u32,
+    pub hot_x: u32,
+    pub hot_y: u32,
+    pub width: u32,
+    pub height: u32,
+    pub image: u64,
+}
+
 /// 系统调用包装函数 - RISC-V 版本
 #[cfg(target_arch = "riscv64")]
 #[inline(always)]
-unsafe fn syscall3(num: usize, arg0: usize, arg1: usize, arg2: usize) -> isize {
+pub(crate) unsafe fn syscall3(num: usize, arg0: usize, arg1: usize, arg2: usize) -> isize {
     let ret: isize;
     core::arch::asm!(
         "ecall",
@@ -144,7 +188,7 @@ unsafe fn syscall3(num: usize, arg0: usize, arg1: usize, arg2: usize) -> isize {
 
 #[cfg(target_arch = "riscv64")]
 #[inline(always)]
-unsafe fn syscall6(num: usize, arg0: usize, arg1: usize, arg2: usize,
+pub(crate) unsafe fn syscall6(num: usize, arg0: usize, arg1: usize, arg2: usize,
                    arg3: usize, arg4: usize, arg5: usize) -> isize {
     let ret: isize;
     core::arch::asm!(
@@ -164,14 +208,14 @@ unsafe fn syscall6(num: usize, arg0: usize, arg1: usize, arg2: usize,
 /// 系统调用包装函数 - 非 RISC-V 平台（开发/测试用）
 #[cfg(not(target_arch = "riscv64"))]
 #[inline(always)]
-unsafe fn syscall3(_num: usize, _arg0: usize, _arg1: usize, _arg2: usize) -> isize {
+pub(crate) unsafe fn syscall3(_num: usize, _arg0: usize, _arg1: usize, _arg2: usize) -> isize {
     // 非 RISC-V 平台返回错误
     -1
 }
 
 #[cfg(not(target_arch = "riscv64"))]
 #[inline(always)]
-unsafe fn syscall6(_num: usize, _arg0: usize, _arg1: usize, _arg2: usize,
+pub(crate) unsafe fn syscall6(_num: usize, _arg0: usize, _arg1: usize, _arg2: usize,
                    _arg3: usize, _arg4: usize, _arg5: usize) -> isize {
     // 非 RISC-V 平台返回错误
     -1
@@ -194,17 +238,57 @@ pub mod color {
 }
 
 /// Framebuffer 绘图 trait
+///
+/// 只需实现 put_pixel；能直接访问像素行的实现应覆盖 fill_span / write_span，
+/// fill_rect、blit_bitmap 等都建立在这两个行操作上
 pub trait Framebuffer {
     fn put_pixel(&self, x: u32, y: u32, color: u32);
     fn width(&self) -> u32;
     fn height(&self) -> u32;
 
+    /// 从 (x, y) 开始向右填充 len 个像素，超出屏幕的部分被裁掉
+    fn fill_span(&self, x: u32, y: u32, len: u32, color: u32) {
+        if y >= self.height() {
+            return;
+        }
+        for px in x..x.saturating_add(len).min(self.width()) {
+            self.put_pixel(px, y, color);
+        }
+    }
+
+    /// 把一行像素写到 (x, y) 开始的位置，超出屏幕的部分被裁掉
+    fn write_span(&self, x: u32, y: u32, pixels: &[u32]) {
+        if y >= self.height() {
+            return;
+        }
+        for (px, &color) in (x..self.width()).zip(pixels) {
+            self.put_pixel(px, y, color);
+        }
+    }
+
+    /// 通知显示设备矩形区域已经更新，没有显示设备的实现什么也不做
+    fn flush_rect(&self, _x: u32, _y: u32, _width: u32, _height: u32) {}
+
     fn fill_rect(&self, x: u32, y: u32, width: u32, height: u32, color: u32) {
-        let x_end = (x + width).min(self.width());
-        let y_end = (y + height).min(self.height());
-        for py in y..y_end {
-            for px in x..x_end {
-                self.put_pixel(px, py, color);
+        if let Some((x0, y0, x1, y1)) = span::clip_rect(x, y, width, height, self.width(), self.height()) {
+            for py in y0..y1 {
+                self.fill_span(x0, py, x1 - x0, color);
+            }
+        }
+    }
+
+    /// 绘制位图：pixels 中每行 src_stride 个像素，取左上角 width x height 的区域
+    fn blit_bitmap(&self, x: u32, y: u32, width: u32, height: u32, pixels: &[u32], src_stride: u32) {
+        let (x0, y0, x1, y1) = match span::clip_rect(x, y, width, height, self.width(), self.height()) {
+            Some(clip) => clip,
+            None => return,
+        };
+        let len = (x1 - x0) as usize;
+        for py in y0..y1 {
+            let start = (py - y0) as usize * src_stride as usize;
+            match pixels.get(start..start + len) {
+                Some(row) => self.write_span(x0, py, row),
+                None => break,
             }
         }
     }
@@ -435,18 +519,78 @@ impl FramebufferDevice {
         }
     }
 
+    /// 第 y 行从 x 开始的 len 个像素，调用者保证不越界
+    #[inline]
+    unsafe fn span_mut(&self, x: u32, y: u32, len: u32) -> &mut [u32] {
+        let offset = (y * self.stride() + x * 4) as usize;
+        core::slice::from_raw_parts_mut(self.ptr.add(offset) as *mut u32, len as usize)
+    }
+
+    /// 从 (x, y) 开始向右填充 len 个像素
+    pub fn fill_span(&self, x: u32, y: u32, len: u32, color: u32) {
+        if x >= self.width() || y >= self.height() {
+            return;
+        }
+        let len = len.min(self.width() - x);
+        span::fill_span(unsafe { self.span_mut(x, y, len) }, color);
+    }
+
+    /// 把一行像素写到 (x, y) 开始的位置
+    pub fn write_span(&self, x: u32, y: u32, pixels: &[u32]) {
+        if x >= self.width() || y >= self.height() {
+            return;
+        }
+        let len = (pixels.len() as u32).min(self.width() - x);
+        span::copy_span(unsafe { self.span_mut(x, y, len) }, pixels);
+    }
+
+    /// 通知显示设备刷新矩形区域 (FBIO_DAMAGE)
+    pub fn flush_rect(&self, x: u32, y: u32, width: u32, height: u32) {
+        let rect = FbDamageRect { x, y, width, height };
+        let damage = FbDamage {
+            num_rects: 1,
+            flags: 0,
+            rects: &rect as *const FbDamageRect as u64,
+        };
+        unsafe {
+            syscall3(
+                syscall::SYS_IOCTL,
+                FBDEV_FD as usize,
+                syscall::FBIO_DAMAGE as usize,
+                &damage as *const FbDamage as usize,
+            );
+        }
+    }
+
+    /// 设置硬件光标 (FBIO_CURSOR)
+    ///
+    /// 返回 false 表示设备没有硬件光标，调用者应继续绘制软件光标
+    pub fn set_cursor(&self, cursor: &FbCursor) -> bool {
+        let ret = unsafe {
+            syscall3(
+                syscall::SYS_IOCTL,
+                FBDEV_FD as usize,
+                syscall::FBIO_CURSOR as usize,
+                cursor as *const FbCursor as usize,
+            )
+        };
+        ret == 0
+    }
+
     /// 填充矩形
     pub fn fill_rect(&self, x: u32, y: u32, width: u32, height: u32, color: u32) {
-        let x_end = (x + width).min(self.width());
-        let y_end = (y + height).min(self.height());
-
-        for py in y..y_end {
-            for px in x..x_end {
-                self.put_pixel(px, py, color);
+        if let Some((x0, y0, x1, y1)) = span::clip_rect(x, y, width, height, self.width(), self.height()) {
+            for py in y0..y1 {
+                self.fill_span(x0, py, x1 - x0, color);
             }
         }
     }
 
+    /// 绘制位图：pixels 中每行 src_stride 个像素
+    pub fn blit_bitmap(&self, x: u32, y: u32, width: u32, height: u32, pixels: &[u32], src_stride: u32) {
+        Framebuffer::blit_bitmap(self, x, y, width, height, pixels, src_stride);
+    }
+
     /// 绘制矩形边框
     pub fn blit_rect(&self, x: u32, y: u32, width: u32, height: u32, color: u32, thickness: u32) {
         // 上边
@@ -546,20 +690,30 @@ impl FramebufferDevice {
         }
     }
 
-    /// 复制矩形区域
+    /// 复制矩形区域，源和目标可以重叠
     pub fn copy_rect(&self, src_x: u32, src_y: u32, dst_x: u32, dst_y: u32, width: u32, height: u32) {
-        for py in 0..height {
-            for px in 0..width {
-                let sx = src_x + px;
-                let sy = src_y + py;
-                let dx = dst_x + px;
-                let dy = dst_y + py;
-
-                if sx < self.width() && sy < self.height() && dx < self.width() && dy < self.height() {
-                    let color = self.get_pixel(sx, sy);
-                    self.put_pixel(dx, dy, color);
-                }
-            }
+        // 源和目标都裁剪到屏幕内，取两者都能容纳的大小
+        let (sx0, sy0, sx1, sy1) = match span::clip_rect(src_x, src_y, width, height, self.width(), self.height()) {
+            Some(clip) => clip,
+            None => return,
+        };
+        let (dx0, dy0, dx1, dy1) = match span::clip_rect(dst_x, dst_y, width, height, self.width(), self.height()) {
+            Some(clip) => clip,
+            None => return,
+        };
+        let w = (sx1 - sx0).min(dx1 - dx0);
+        let h = (sy1 - sy0).min(dy1 - dy0);
+
+        // 向下移动时从最后一行开始，不覆盖还没复制的源行
+        let copy_row = |row: u32| unsafe {
+            let src = self.ptr.add(((sy0 + row) * self.stride() + sx0 * 4) as usize) as *const u32;
+            let dst = self.ptr.add(((dy0 + row) * self.stride() + dx0 * 4) as usize) as *mut u32;
+            core::ptr::copy(src, dst, w as usize);
+        };
+        if dy0 > sy0 {
+            (0..h).rev().for_each(copy_row);
+        } else {
+            (0..h).for_each(copy_row);
         }
     }
 }
@@ -570,6 +724,22 @@ impl Framebuffer for FramebufferDevice {
         self.put_pixel(x, y, color);
     }
 
+    fn fill_span(&self, x: u32, y: u32, len: u32, color: u32) {
+        self.fill_span(x, y, len, color);
+    }
+
+    fn write_span(&self, x: u32, y: u32, pixels: &[u32]) {
+        self.write_span(x, y, pixels);
+    }
+
+    fn flush_rect(&self, x: u32, y: u32, width: u32, height: u32) {
+        self.flush_rect(x, y, width, height);
+    }
+
+    fn fill_rect(&self, x: u32, y: u32, width: u32, height: u32, color: u32) {
+        self.fill_rect(x, y, width, height, color);
+    }
+
     fn width(&self) -> u32 {
         self.width()
     }
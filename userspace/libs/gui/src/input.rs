@@ -0,0 +1,131 @@
+//! 输入事件设备
+//!
+//! 读取 /dev/input/event0 上的 struct input_event。设备以非阻塞方式打开，
+//! 一次 read 取出多个事件；没有事件时用 wait 睡眠在 poll 上，不占用 CPU。
+
+use crate::framebuffer::{syscall3, syscall6};
+
+/// 系统调用号 (RISC-V Linux ABI)
+mod syscall {
+    pub const SYS_OPENAT: usize = 56;
+    pub const SYS_CLOSE: usize = 57;
+    pub const SYS_READ: usize = 63;
+    /// poll(fds, nfds, timeout_ms) (Rux 调用号)
+    pub const SYS_POLL: usize = 7;
+}
+
+const AT_FDCWD: isize = -100;
+const O_RDONLY: u32 = 0;
+const O_NONBLOCK: u32 = 0o4000;
+const O_CLOEXEC: u32 = 0o2000000;
+const POLLIN: i16 = 0x0001;
+
+/// 输入事件设备节点
+pub const EVDEV_PATH: &[u8] = b"/dev/input/event0\0";
+
+/// 事件类型与代码 (linux/input-event-codes.h)
+pub mod ev {
+    pub const EV_SYN: u16 = 0x00;
+    pub const EV_KEY: u16 = 0x01;
+    pub const EV_REL: u16 = 0x02;
+
+    pub const SYN_REPORT: u16 = 0;
+    pub const SYN_DROPPED: u16 = 3;
+
+    pub const REL_X: u16 = 0x00;
+    pub const REL_Y: u16 = 0x01;
+
+    pub const BTN_LEFT: u16 = 0x110;
+    pub const BTN_RIGHT: u16 = 0x111;
+    pub const BTN_MIDDLE: u16 = 0x112;
+}
+
+/// 输入事件 (struct input_event)
+#[repr(C)]
+#[derive(Clone, Copy, Default, Debug)]
+pub struct InputEvent {
+    pub tv_sec: u64,
+    pub tv_usec: u64,
+    pub type_: u16,
+    pub code: u16,
+    pub value: i32,
+}
+
+#[repr(C)]
+struct PollFd {
+    fd: i32,
+    events: i16,
+    revents: i16,
+}
+
+/// 输入事件设备
+pub struct InputDevice {
+    fd: i32,
+}
+
+impl InputDevice {
+    /// 打开输入事件设备
+    ///
+    /// # Returns
+    /// 设备不存在时返回 None
+    pub fn open() -> Option<Self> {
+        let fd = unsafe {
+            syscall6(
+                syscall::SYS_OPENAT,
+                AT_FDCWD as usize,
+                EVDEV_PATH.as_ptr() as usize,
+                (O_RDONLY | O_NONBLOCK | O_CLOEXEC) as usize,
+                0,
+                0,
+                0,
+            )
+        };
+        if fd < 0 {
+            return None;
+        }
+        Some(Self { fd: fd as i32 })
+    }
+
+    pub fn fd(&self) -> i32 {
+        self.fd
+    }
+
+    /// 等待事件到来
+    ///
+    /// # Arguments
+    /// * `timeout_ms` - 最长等待时间，None 表示一直等待
+    ///
+    /// # Returns
+    /// 有事件可读时返回 true，超时或被信号打断返回 false
+    pub fn wait(&self, timeout_ms: Option<u32>) -> bool {
+        let mut pfd = PollFd { fd: self.fd, events: POLLIN, revents: 0 };
+        let timeout = timeout_ms.map_or(-1, |ms| ms as i32);
+        let ret = unsafe {
+            syscall3(syscall::SYS_POLL, &mut pfd as *mut PollFd as usize, 1, timeout as isize as usize)
+        };
+        ret > 0 && pfd.revents & POLLIN != 0
+    }
+
+    /// 读取已经到达的事件，不阻塞
+    ///
+    /// # Returns
+    /// 读到的事件数
+    pub fn read_events(&self, events: &mut [InputEvent]) -> usize {
+        let size = core::mem::size_of::<InputEvent>();
+        let ret = unsafe {
+            syscall3(syscall::SYS_READ, self.fd as usize, events.as_mut_ptr() as usize, events.len() * size)
+        };
+        if ret <= 0 {
+            return 0;
+        }
+        ret as usize / size
+    }
+}
+
+impl Drop for InputDevice {
+    fn drop(&mut self) {
+        unsafe {
+            syscall3(syscall::SYS_CLOSE, self.fd as usize, 0, 0);
+        }
+    }
+}
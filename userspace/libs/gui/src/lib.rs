@@ -1,23 +1,29 @@
 //! Rux GUI 库
 //!
 //! 用户态图形界面库，提供：
-//! - 基础绘图原语
+//! - 基础绘图原语（按行填充、复制与位图绘制）
 //! - 字体渲染
 //! - 双缓冲
 //! - 窗口管理
 //! - UI 控件
 //! - 鼠标光标
+//! - 输入事件设备
 
 pub mod framebuffer;
+pub mod span;
 pub mod font;
 pub mod double_buffer;
 pub mod cursor;
 pub mod window;
 pub mod widgets;
+pub mod compositor;
+pub mod input;
 
 pub use framebuffer::{Framebuffer, FramebufferDevice, color};
-pub use font::FontRenderer;
+pub use font::{FontRenderer, TextCache, TextRun};
 pub use double_buffer::DoubleBuffer;
 pub use cursor::MouseCursor;
 pub use window::{Window, WindowManager, WindowId, WindowState};
+pub use input::{InputDevice, InputEvent};
+pub use compositor::{Compositor, Offset, ScreenRect, Surface};
 pub use widgets::{Button, Label, TextBox, SimplePanel, WidgetState, WidgetEvent, WidgetId};
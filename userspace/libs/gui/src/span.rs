@@ -0,0 +1,43 @@
+//! 行跨度 (span) 绘图原语
+//!
+//! 按整行处理像素，代替逐像素的 put_pixel：
+//! - 填充使用 64 位存储，一次写两个像素
+//! - 复制使用 copy_from_slice (memcpy)
+//! - 矩形裁剪只做一次，内层循环没有边界检查
+
+/// 把矩形裁剪到 width x height 的屏幕内
+///
+/// # Returns
+/// (x0, y0, x1, y1)，右下边界不含；矩形在屏幕外或为空时返回 None
+#[inline]
+pub fn clip_rect(x: u32, y: u32, w: u32, h: u32, width: u32, height: u32) -> Option<(u32, u32, u32, u32)> {
+    if x >= width || y >= height || w == 0 || h == 0 {
+        return None;
+    }
+    let x1 = x.saturating_add(w).min(width);
+    let y1 = y.saturating_add(h).min(height);
+    Some((x, y, x1, y1))
+}
+
+/// 用 color 填充一段像素
+pub fn fill_span(dst: &mut [u32], color: u32) {
+    // 头尾不足 8 字节对齐的像素单独写，中间按 u64 写
+    let (head, body, tail) = unsafe { dst.align_to_mut::<u64>() };
+    let pair = (color as u64) << 32 | color as u64;
+    for p in head.iter_mut() {
+        *p = color;
+    }
+    for p in body.iter_mut() {
+        *p = pair;
+    }
+    for p in tail.iter_mut() {
+        *p = color;
+    }
+}
+
+/// 复制一段像素，长度取两者中较短的
+#[inline]
+pub fn copy_span(dst: &mut [u32], src: &[u32]) {
+    let len = dst.len().min(src.len());
+    dst[..len].copy_from_slice(&src[..len]);
+}
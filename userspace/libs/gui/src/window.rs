@@ -78,29 +78,30 @@ impl Window {
 
         // 阴影
         fb.fill_rect(self.x + 4, self.y + 4, self.width, self.height, color::DARK_GRAY);
+        self.draw_body(fb, font, self.x, self.y);
+    }
+
+    /// 以 (ox, oy) 为左上角绘制窗口本身（不含阴影），合成器用它绘制到窗口表面
+    pub fn draw_body<F: Framebuffer>(&self, fb: &F, font: &FontRenderer, ox: u32, oy: u32) {
         // 背景
-        fb.fill_rect(self.x, self.y, self.width, self.height, color::WHITE);
+        fb.fill_rect(ox, oy, self.width, self.height, color::WHITE);
         // 边框
-        fb.blit_rect(self.x, self.y, self.width, self.height, color::BLACK, 2);
+        fb.blit_rect(ox, oy, self.width, self.height, color::BLACK, 2);
         // 标题栏
-        fb.fill_rect(self.x, self.y, self.width, TITLE_BAR_HEIGHT, color::BLUE);
+        fb.fill_rect(ox, oy, self.width, TITLE_BAR_HEIGHT, color::BLUE);
 
         // 标题文本
         if self.width > 40 {
-            let title_x = self.x + 6;
-            let title_y = self.y + 6;
+            let title_x = ox + 6;
+            let title_y = oy + 6;
             let max_chars = ((self.width - 30) / 8) as usize;
-            for (i, ch) in self.title.bytes().enumerate() {
-                if i >= max_chars {
-                    break;
-                }
-                font.draw_char(fb, title_x + i as u32 * 8, title_y, ch, color::WHITE);
-            }
+            let end = self.title.char_indices().nth(max_chars).map_or(self.title.len(), |(i, _)| i);
+            font.draw_string(fb, title_x, title_y, &self.title[..end], color::WHITE);
         }
 
         // 关闭按钮
-        let close_x = self.x + self.width - 18;
-        let close_y = self.y + 4;
+        let close_x = ox + self.width - 18;
+        let close_y = oy + 4;
         fb.fill_rect(close_x, close_y, 12, 12, color::RED);
         fb.draw_line(close_x + 2, close_y + 2, close_x + 10, close_y + 10, color::WHITE);
         fb.draw_line(close_x + 10, close_y + 2, close_x + 2, close_y + 10, color::WHITE);
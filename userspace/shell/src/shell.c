@@ -5,7 +5,9 @@
  * - 显示提示符
  * - 读取用户输入
  * - 执行内置命令（echo, help, exit, ls, cat）
- * - 执行外部程序（通过 fork + execve + wait）
+ * - 执行外部程序（通过 posix_spawn + wait）
+ * - 命令路径散列表（hash），PATH 改变或程序不存在时失效
+ * - 不需要新进程的小程序（echo, true, false, test）在进程内执行
  *
  * 使用 musl libc 提供的标准 C 库函数
  */
@@ -19,9 +21,17 @@
 #include <dirent.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <spawn.h>
+#include <sys/stat.h>
 
 #define MAX_CMD_LEN 256
 #define MAX_ARGS 16
+#define MAX_PATH_LEN 256
+
+/* 命令散列表（POSIX sh 的 hash） */
+#define HASH_SIZE 64
+#define HASH_NAME_LEN 64
+#define DEFAULT_PATH "/bin"
 
 /* 打印欢迎信息 */
 static void print_welcome(void) {
@@ -38,6 +48,11 @@ static void print_help(void) {
     printf("Rux OS Shell v0.3\n");
     printf("Available commands:\n");
     printf("  echo <args>  - Print arguments\n");
+    printf("  true, false  - Return success / failure\n");
+    printf("  test, [      - Evaluate an expression\n");
+    printf("  toybox <cmd> - Run a built-in applet\n");
+    printf("  hash [-r]    - Show / forget remembered command paths\n");
+    printf("  export PATH=<dirs> - Set the command search path\n");
     printf("  help         - Show this help message\n");
     printf("  ls [dir]     - List directory contents\n");
     printf("  cat <file>   - Display file contents\n");
@@ -120,25 +135,275 @@ static void cmd_cat(const char *filename) {
     close(fd);
 }
 
-/* 执行外部程序 */
-static int run_external(const char *path, char *const argv[]) {
-    pid_t pid = fork();
+/*
+ * 小程序 (applet)
+ *
+ * 像 toybox 一样按名字分派到进程内的函数，不创建新进程。
+ * 只收录不改变 shell 状态、不读标准输入的命令 (NOFORK)
+ */
+static int applet_echo(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        printf("%s", argv[i]);
+        if (i < argc - 1) printf(" ");
+    }
+    printf("\n");
+    return 0;
+}
 
-    if (pid < 0) {
-        printf("fork failed\n");
-        return -1;
-    } else if (pid == 0) {
-        /* 子进程：执行程序 */
-        execve(path, argv, NULL);
-        /* 如果 execve 返回，说明失败了 */
-        printf("execve failed: %s\n", path);
-        exit(1);
-    } else {
-        /* 父进程：等待子进程结束 */
-        int status;
-        waitpid(pid, &status, 0);
+static int applet_true(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+    return 0;
+}
+
+static int applet_false(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+    return 1;
+}
+
+/* test 的单目运算：-e -f -d -z -n */
+static int test_unary(const char *op, const char *arg) {
+    struct stat st;
+
+    if (strcmp(op, "-z") == 0) return arg[0] == '\0';
+    if (strcmp(op, "-n") == 0) return arg[0] != '\0';
+    if (stat(arg, &st) != 0) return 0;
+    if (strcmp(op, "-e") == 0) return 1;
+    if (strcmp(op, "-f") == 0) return S_ISREG(st.st_mode);
+    if (strcmp(op, "-d") == 0) return S_ISDIR(st.st_mode);
+    return -1;
+}
+
+/* test 的双目运算：= != -eq -ne -lt -le -gt -ge */
+static int test_binary(const char *lhs, const char *op, const char *rhs) {
+    if (strcmp(op, "=") == 0) return strcmp(lhs, rhs) == 0;
+    if (strcmp(op, "!=") == 0) return strcmp(lhs, rhs) != 0;
+
+    long a = strtol(lhs, NULL, 10);
+    long b = strtol(rhs, NULL, 10);
+    if (strcmp(op, "-eq") == 0) return a == b;
+    if (strcmp(op, "-ne") == 0) return a != b;
+    if (strcmp(op, "-lt") == 0) return a < b;
+    if (strcmp(op, "-le") == 0) return a <= b;
+    if (strcmp(op, "-gt") == 0) return a > b;
+    if (strcmp(op, "-ge") == 0) return a >= b;
+    return -1;
+}
+
+/* test / [ - 返回 0 表示真，1 表示假，2 表示表达式错误 */
+static int applet_test(int argc, char *argv[]) {
+    int negate = 0;
+    int result;
+
+    if (strcmp(argv[0], "[") == 0) {
+        if (strcmp(argv[argc - 1], "]") != 0) {
+            printf("[: missing ]\n");
+            return 2;
+        }
+        argc--;
+    }
+    argv++;
+    argc--;
+
+    if (argc > 0 && strcmp(argv[0], "!") == 0) {
+        negate = 1;
+        argv++;
+        argc--;
+    }
+
+    switch (argc) {
+    case 0: result = 0; break;
+    case 1: result = argv[0][0] != '\0'; break;
+    case 2: result = test_unary(argv[0], argv[1]); break;
+    case 3: result = test_binary(argv[0], argv[1], argv[2]); break;
+    default: result = -1; break;
+    }
+    if (result < 0) {
+        printf("test: bad expression\n");
+        return 2;
+    }
+    return negate ? result : !result;
+}
+
+struct applet {
+    const char *name;
+    int (*main)(int argc, char *argv[]);
+};
+
+static const struct applet applets[] = {
+    { "echo",  applet_echo },
+    { "true",  applet_true },
+    { "false", applet_false },
+    { "test",  applet_test },
+    { "[",     applet_test },
+};
+
+static const struct applet *find_applet(const char *name) {
+    for (size_t i = 0; i < sizeof(applets) / sizeof(applets[0]); i++) {
+        if (strcmp(applets[i].name, name) == 0) {
+            return &applets[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * 命令散列表
+ *
+ * 记住名字到完整路径的映射，再次执行时不用逐个目录尝试。
+ * PATH 改变时全部清空；按记住的路径执行失败 (ENOENT) 时丢弃这一项重新查找
+ */
+struct hash_entry {
+    char name[HASH_NAME_LEN];
+    char path[MAX_PATH_LEN];
+    unsigned hits;
+};
+
+static struct hash_entry hash_table[HASH_SIZE];
+static char hash_path_env[MAX_PATH_LEN];
+
+/* FNV-1a */
+static unsigned hash_name(const char *name) {
+    unsigned h = 2166136261u;
+    while (*name) {
+        h = (h ^ (unsigned char)*name++) * 16777619u;
+    }
+    return h;
+}
+
+static void hash_clear(void) {
+    memset(hash_table, 0, sizeof(hash_table));
+}
+
+static const char *search_path(void) {
+    const char *path = getenv("PATH");
+    return path ? path : DEFAULT_PATH;
+}
+
+/* 开放寻址查找；返回名字所在的项，不存在时返回可以插入的空项，表满时返回 NULL */
+static struct hash_entry *hash_slot(const char *name) {
+    unsigned h = hash_name(name);
+    for (unsigned i = 0; i < HASH_SIZE; i++) {
+        struct hash_entry *e = &hash_table[(h + i) % HASH_SIZE];
+        if (e->name[0] == '\0' || strcmp(e->name, name) == 0) {
+            return e;
+        }
+    }
+    return NULL;
+}
+
+/* 删除一项，之后同一探测链上的项重新插入，保证后面的项仍能找到 */
+static void hash_forget(const char *name) {
+    struct hash_entry *e = hash_slot(name);
+    if (e == NULL || e->name[0] == '\0') return;
+    e->name[0] = '\0';
+
+    unsigned i = (unsigned)(e - hash_table);
+    for (unsigned j = (i + 1) % HASH_SIZE; hash_table[j].name[0] != '\0'; j = (j + 1) % HASH_SIZE) {
+        struct hash_entry moved = hash_table[j];
+        hash_table[j].name[0] = '\0';
+        *hash_slot(moved.name) = moved;
+    }
+}
+
+/* 在 PATH 的各个目录中查找普通文件 */
+static int path_search(const char *name, char *out, size_t size) {
+    const char *dir = search_path();
+    struct stat st;
+
+    while (*dir) {
+        size_t len = strcspn(dir, ":");
+        /* 空目录表示当前目录 */
+        snprintf(out, size, "%.*s/%s", len ? (int)len : 1, len ? dir : ".", name);
+        if (stat(out, &st) == 0 && S_ISREG(st.st_mode)) {
+            return 0;
+        }
+        dir += len;
+        if (*dir == ':') dir++;
+    }
+    return -1;
+}
+
+/* PATH 改变后记住的路径都可能失效，全部清空 (hash -r) */
+static void hash_check_path(void) {
+    const char *path = search_path();
+    if (strcmp(path, hash_path_env) != 0) {
+        hash_clear();
+        snprintf(hash_path_env, sizeof(hash_path_env), "%s", path);
+    }
+}
+
+/* 查找命令的完整路径，先查散列表 */
+static int lookup_command(const char *name, char *out, size_t size) {
+    hash_check_path();
+
+    struct hash_entry *e = hash_slot(name);
+    if (e != NULL && e->name[0] != '\0') {
+        e->hits++;
+        snprintf(out, size, "%s", e->path);
         return 0;
     }
+
+    if (path_search(name, out, size) != 0) {
+        return -1;
+    }
+    /* 名字太长或表满时不记住 */
+    if (e != NULL && strlen(name) < HASH_NAME_LEN) {
+        snprintf(e->name, sizeof(e->name), "%s", name);
+        snprintf(e->path, sizeof(e->path), "%s", out);
+        e->hits = 1;
+    }
+    return 0;
+}
+
+/* hash 命令 - 显示或清空记住的命令路径 */
+static void cmd_hash(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "-r") == 0) {
+        hash_clear();
+        return;
+    }
+    hash_check_path();
+    printf("hits\tcommand\n");
+    for (int i = 0; i < HASH_SIZE; i++) {
+        if (hash_table[i].name[0] != '\0') {
+            printf("%4u\t%s\n", hash_table[i].hits, hash_table[i].path);
+        }
+    }
+}
+
+/* export 命令 - 只支持 NAME=value 形式 */
+static void cmd_export(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        char *eq = strchr(argv[i], '=');
+        if (eq == NULL || eq == argv[i]) {
+            printf("export: usage: export NAME=value\n");
+            continue;
+        }
+        *eq = '\0';
+        setenv(argv[i], eq + 1, 1);
+        *eq = '=';
+    }
+}
+
+/* 执行外部程序；返回 0 或 posix_spawn 的错误码 */
+static int run_external(const char *path, char *const argv[]) {
+    /*
+     * posix_spawn 用 clone(CLONE_VM | CLONE_VFORK) 创建子进程：
+     * 不复制页表，shell 睡眠到子进程 execve 完成，比 fork + execve 快得多
+     */
+    char *const envp[] = { NULL };
+    pid_t pid;
+    int err = posix_spawn(&pid, path, NULL, NULL, argv, envp);
+
+    if (err != 0) {
+        return err;
+    }
+
+    /* 等待子进程结束 */
+    int status;
+    waitpid(pid, &status, 0);
+    return 0;
 }
 
 /* 解析并执行命令 */
@@ -160,16 +425,22 @@ static void execute_command(char *cmd) {
 
     if (argc == 0) return;
 
-    /* 处理内置命令 */
-    if (strcmp(args[0], "echo") == 0) {
-        for (int i = 1; i < argc; i++) {
-            printf("%s", args[i]);
-            if (i < argc - 1) printf(" ");
+    /* 进程内执行的小程序；toybox <applet> 显式选择小程序 */
+    const struct applet *applet = find_applet(args[0]);
+    if (applet == NULL && strcmp(args[0], "toybox") == 0) {
+        if (argc < 2 || (applet = find_applet(args[1])) == NULL) {
+            printf("toybox: unknown applet '%s'\n", argc > 1 ? args[1] : "");
+            return;
         }
-        printf("\n");
+        applet->main(argc - 1, args + 1);
+        return;
+    }
+    if (applet != NULL) {
+        applet->main(argc, args);
         return;
     }
 
+    /* 处理内置命令 */
     if (strcmp(args[0], "help") == 0) {
         print_help();
         return;
@@ -203,18 +474,44 @@ static void execute_command(char *cmd) {
         return;
     }
 
+    if (strcmp(args[0], "hash") == 0) {
+        cmd_hash(argc, args);
+        return;
+    }
+
+    if (strcmp(args[0], "export") == 0) {
+        cmd_export(argc, args);
+        return;
+    }
+
     /* 执行外部程序 */
-    char path[256];
+    char path[MAX_PATH_LEN];
+    int err;
 
-    if (args[0][0] == '/' || args[0][0] == '.') {
-        /* 绝对路径或相对路径 */
-        strncpy(path, args[0], sizeof(path) - 1);
+    if (strchr(args[0], '/') != NULL) {
+        /* 绝对路径或相对路径，不查找也不记住 */
+        snprintf(path, sizeof(path), "%s", args[0]);
+        err = run_external(path, args);
     } else {
-        /* 在 /bin 中查找 */
-        snprintf(path, sizeof(path), "/bin/%s", args[0]);
+        if (lookup_command(args[0], path, sizeof(path)) != 0) {
+            printf("%s: command not found\n", args[0]);
+            return;
+        }
+        err = run_external(path, args);
+        if (err == ENOENT) {
+            /* 记住的程序已被删除或移走，重新查找一次 */
+            hash_forget(args[0]);
+            if (lookup_command(args[0], path, sizeof(path)) != 0) {
+                printf("%s: command not found\n", args[0]);
+                return;
+            }
+            err = run_external(path, args);
+        }
     }
 
-    run_external(path, args);
+    if (err != 0) {
+        printf("spawn failed: %s: %s\n", path, strerror(err));
+    }
 }
 
 /* 主函数 */
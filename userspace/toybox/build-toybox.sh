@@ -2,6 +2,13 @@
 # Rux OS - Toybox 构建脚本
 #
 # 使用交叉编译工具链编译 toybox，生成静态链接的 RISC-V 64 位二进制文件
+#
+# 用法: ./build-toybox.sh [--layout] [--profile]
+#   --layout   按 hot-functions.txt 把常用命令的代码和数据排在一起，并在固定地址链接
+#              (-no-pie)，启动时没有重定位要做；配合内核 execve 的 fault-around，
+#              一次 ls 只缺页几十个页面，而不是在整个二进制里零散地读
+#   --profile  在主机上用 -finstrument-functions 构建 toybox，运行一组常用命令，
+#              按函数首次调用的顺序重新生成 hot-functions.txt，不做交叉编译
 
 set -e
 
@@ -9,6 +16,17 @@ SCRIPT_DIR="$(cd "$(dirname "${BASH_SOURCE[0]}")" && pwd)"
 PROJECT_ROOT="$(cd "$SCRIPT_DIR/../.." && pwd)"
 TOYBOX_DIR="${SCRIPT_DIR}/toybox"
 TOYBOX_VERSION="0.8.13"
+HOT_FUNCTIONS="${SCRIPT_DIR}/hot-functions.txt"
+
+LAYOUT=0
+PROFILE=0
+for arg in "$@"; do
+    case "$arg" in
+        --layout) LAYOUT=1 ;;
+        --profile) PROFILE=1 ;;
+        *) echo "Usage: $0 [--layout] [--profile]"; exit 1 ;;
+    esac
+done
 
 echo "========================================"
 echo "Rux OS - Toybox Build Script"
@@ -16,18 +34,21 @@ echo "========================================"
 echo "TOYBOX_VERSION: ${TOYBOX_VERSION}"
 echo "TOYBOX_DIR: ${TOYBOX_DIR}"
 echo "PROJECT_ROOT: ${PROJECT_ROOT}"
+echo "LAYOUT: ${LAYOUT}"
 echo ""
 
-# 检查交叉编译工具链
-if ! command -v riscv64-linux-gnu-gcc &> /dev/null; then
-    echo "Error: riscv64-linux-gnu-gcc not found"
-    echo "Please install RISC-V cross-compiler toolchain"
-    exit 1
-fi
+# 检查交叉编译工具链（剖析只用主机编译器）
+if [ "$PROFILE" = 0 ]; then
+    if ! command -v riscv64-linux-gnu-gcc &> /dev/null; then
+        echo "Error: riscv64-linux-gnu-gcc not found"
+        echo "Please install RISC-V cross-compiler toolchain"
+        exit 1
+    fi
 
-echo "Cross-compiler: $(which riscv64-linux-gnu-gcc)"
-echo "GCC version: $(riscv64-linux-gnu-gcc --version | head -1)"
-echo ""
+    echo "Cross-compiler: $(which riscv64-linux-gnu-gcc)"
+    echo "GCC version: $(riscv64-linux-gnu-gcc --version | head -1)"
+    echo ""
+fi
 
 # 下载 toybox 源码
 if [ ! -d "$TOYBOX_DIR" ]; then
@@ -47,6 +68,112 @@ else
     echo "Toybox source already exists at $TOYBOX_DIR"
 fi
 
+# 剖析用的命令序列，尽量贴近 shell 中的日常使用；ls 放在最前，它的启动路径排在最前面
+profile_workload() {
+    local tb="$1"
+
+    mkdir -p a/b/c
+    echo hello > a/f
+    "$tb" ls -l / > /dev/null
+    "$tb" ls -la a > /dev/null
+    "$tb" ls > /dev/null
+    "$tb" cat a/f > /dev/null
+    "$tb" echo hello world > /dev/null
+    "$tb" mkdir -p d/e
+    "$tb" cp -r a d/
+    "$tb" mv d/a d/g
+    "$tb" rm -rf d
+    "$tb" touch t
+    "$tb" ln -s t u
+    "$tb" chmod 644 t
+    "$tb" pwd > /dev/null
+    "$tb" grep -n hello a/f > /dev/null
+    "$tb" sed 's/hello/bye/' a/f > /dev/null
+    "$tb" head -n 1 a/f > /dev/null
+    "$tb" tail -n 1 a/f > /dev/null
+    "$tb" wc a/f > /dev/null
+    "$tb" sort a/f > /dev/null
+    "$tb" find a > /dev/null
+    "$tb" du -s a > /dev/null
+    "$tb" df > /dev/null 2>&1 || true
+    "$tb" ps > /dev/null 2>&1 || true
+    "$tb" uname -a > /dev/null
+    "$tb" date > /dev/null
+    "$tb" sleep 0
+    "$tb" test -d a
+    "$tb" true
+}
+
+# 在主机上生成 hot-functions.txt
+generate_profile() {
+    local work
+    work="$(mktemp -d)"
+    trap 'rm -rf "$work"' EXIT
+
+    cp -r "$TOYBOX_DIR" "$work/src"
+    cd "$work/src"
+    make distclean > /dev/null 2>&1 || true
+    make defconfig > /dev/null
+    cc -O2 -c "$SCRIPT_DIR/hot-trace.c" -o "$work/hot-trace.o"
+    CFLAGS="-finstrument-functions -fno-pie" LDFLAGS="-no-pie $work/hot-trace.o" \
+        NOSTRIP=1 make -j$(nproc) > /dev/null
+
+    mkdir "$work/run"
+    cd "$work/run"
+    TOYBOX_TRACE="$work/trace" profile_workload "$work/src/generated/unstripped/toybox"
+
+    # 地址换成函数名，按首次出现的顺序去重
+    {
+        echo "# toybox 启动剖析：函数按首次调用的顺序排列，build-toybox.sh --layout 使用"
+        echo "# 由 build-toybox.sh --profile 生成，不要手工编辑"
+        nm "$work/src/generated/unstripped/toybox" |
+            awk 'NR == FNR { if ($2 ~ /^[tT]$/) name[$1] = $3; next }
+                 { addr = sprintf("%016s", $1); gsub(/ /, "0", addr) }
+                 addr in name && !(addr in done) { done[addr] = 1; print name[addr] }' \
+                - "$work/trace"
+    } > "$HOT_FUNCTIONS"
+
+    echo "Profile written to $HOT_FUNCTIONS ($(grep -vc '^#' "$HOT_FUNCTIONS") functions)"
+}
+
+if [ "$PROFILE" = 1 ]; then
+    generate_profile
+    exit 0
+fi
+
+# 生成 --layout 的链接脚本：在默认脚本的通用输入段之前插入热点段
+#
+# -ffunction-sections/-fdata-sections（toybox 默认打开）让每个函数和变量有自己的段，
+# 热点函数按剖析顺序排在 .text 开头附近，toy_list 与全局状态也各自排在 .data/.bss 开头
+generate_layout_script() {
+    local out="$1"
+    local text="" f
+
+    while read -r f; do
+        case "$f" in
+            ''|'#'*) continue ;;
+        esac
+        text+="    *(.text.$f)\n"
+    done < "$HOT_FUNCTIONS"
+
+    echo 'int main(void) { return 0; }' |
+        "$CC" -static -no-pie -Wl,--verbose -xc - -o /dev/null 2> /dev/null |
+        awk -v text="$text" \
+            -v data="    *(.data.toy_list)\n" \
+            -v bss="    *(.bss.toys .bss.this .bss.toybuf .bss.libbuf)\n" '
+            /^=+$/ { inside = !inside; next }
+            !inside { next }
+            /^ *\*\(\.text \.stub \.text\.\*/ { printf "%s", text }
+            /^ *\*\(\.data \.data\.\*/ { printf "%s", data }
+            /^ *\*\(\.bss \.bss\.\*/ { printf "%s", bss }
+            { print }' > "$out"
+
+    if ! grep -q '\.text\.toy_find' "$out"; then
+        echo "Error: failed to generate layout linker script"
+        exit 1
+    fi
+}
+
 # 构建 toybox
 cd "$TOYBOX_DIR"
 
@@ -55,6 +182,18 @@ export CC=riscv64-linux-gnu-gcc
 export CFLAGS="-static"
 export LDFLAGS="-static"
 
+if [ "$LAYOUT" = 1 ]; then
+    if [ ! -f "$HOT_FUNCTIONS" ]; then
+        echo "Error: $HOT_FUNCTIONS not found, run $0 --profile first"
+        exit 1
+    fi
+    echo "Generating hot section layout from $HOT_FUNCTIONS..."
+    generate_layout_script "$SCRIPT_DIR/toybox-layout.ld"
+    # 固定地址链接：代码直接寻址，启动时没有 R_RISCV_RELATIVE 重定位要改写数据页
+    export CFLAGS="-static -fno-pie"
+    export LDFLAGS="-static -no-pie -Wl,-T,$SCRIPT_DIR/toybox-layout.ld"
+fi
+
 echo ""
 echo "Configuring toybox..."
 make distclean 2>/dev/null || true
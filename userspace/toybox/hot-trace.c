@@ -0,0 +1,53 @@
+/*
+ * Rux OS - toybox 启动剖析
+ *
+ * build-toybox.sh --profile 用 -finstrument-functions 编译主机版 toybox 并链接本文件：
+ * 每个函数第一次被调用时，把函数地址追加到 $TOYBOX_TRACE 指向的文件。
+ * 多次运行的结果按首次出现的顺序合并，就是 hot-functions.txt 中的段顺序。
+ *
+ * toybox 用 _exit() 退出，所以地址逐个直接 write()，不经过 stdio 缓冲
+ */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#define TRACE_SLOTS 8192
+
+static void *seen[TRACE_SLOTS];
+static int trace_fd = -1;
+
+__attribute__((no_instrument_function))
+void __cyg_profile_func_enter(void *fn, void *caller)
+{
+    unsigned long slot = ((unsigned long)fn >> 2) & (TRACE_SLOTS - 1);
+    char buf[32];
+    int len;
+
+    (void)caller;
+    while (seen[slot]) {
+        if (seen[slot] == fn)
+            return;
+        slot = (slot + 1) & (TRACE_SLOTS - 1);
+    }
+    seen[slot] = fn;
+
+    if (trace_fd == -1) {
+        char *path = getenv("TOYBOX_TRACE");
+
+        trace_fd = path ? open(path, O_WRONLY | O_CREAT | O_APPEND, 0644) : -2;
+    }
+    if (trace_fd < 0)
+        return;
+    len = snprintf(buf, sizeof(buf), "%lx\n", (unsigned long)fn);
+    if (write(trace_fd, buf, len) != len)
+        trace_fd = -2;
+}
+
+__attribute__((no_instrument_function))
+void __cyg_profile_func_exit(void *fn, void *caller)
+{
+    (void)fn;
+    (void)caller;
+}
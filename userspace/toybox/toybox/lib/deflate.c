@@ -10,19 +10,40 @@
 
 #include "toys.h"
 
+// Bits looked up at once when decoding literal/length and distance codes.
+#define LITBITS 11
+#define DISTBITS 9
+
+// Huffman coding uses bits to traverse a binary tree to a leaf node,
+// By placing frequently occurring symbols at shorter paths, frequently
+// used symbols may be represented in fewer bits than uncommon symbols.
+// (length[0] isn't used but code's clearer if it's there.)
+
+struct huff {
+  unsigned short length[16];  // How many symbols have this bit length?
+  unsigned short symbol[288]; // sorted by bit length, then ascending order
+};
+
 struct deflate {
   // Huffman codes: base offset and extra bits tables (length and distance)
   char lenbits[29], distbits[30];
   unsigned short lenbase[29], distbase[30];
-  void *fixdisthuff, *fixlithuff;
+  struct huff fixlit, fixdist, lit, dist;
 
-  // CRC
-  void (*crcfunc)(struct deflate *dd, char *data, unsigned len);
-  unsigned crctable[256], crc;
+  // Decode tables indexed by the next LITBITS/DISTBITS input bits, see
+  // huff_table()
+  unsigned fixlittab[1<<LITBITS], fixdisttab[1<<DISTBITS],
+    littab[1<<LITBITS], disttab[1<<DISTBITS];
 
+  // CRC (slice-by-8: crctable[k*256+i] is byte i followed by k zero bytes)
+  void (*crcfunc)(struct deflate *dd, char *data, unsigned len);
+  unsigned crctable[8*256], crc;
 
   // Tables only used for deflation
-  unsigned short *hashhead, *hashchain;
+  unsigned short *hashhead, *hashchain, *symlit, *symdist;
+  unsigned symcount, freqlit[286], freqdist[30];
+  unsigned char lcode[256], dcode[512];
+  int good, lazy, nice, chain, greedy;
 
   // Compressed data buffer (extra space malloced at end)
   unsigned pos, len;
@@ -30,9 +51,11 @@ struct deflate {
   char *outbuf, data[];
 };
 
-// little endian bit buffer
+// little endian bit buffer: input is read into buf and fed through a 64 bit
+// accumulator, output collects bits in the accumulator and flushes bytes
 struct bitbuf {
-  int fd, bitpos, len, max;
+  int fd, pos, len, max, bitcount;
+  unsigned long long bits;
   char *buf, data[];
 };
 
@@ -48,91 +71,105 @@ static struct bitbuf *bitbuf_init(int fd, int size)
   return bb;
 }
 
-// Advance bitpos without the overhead of recording bits
-// Loads more data when input buffer empty
-// call with 0 to just load data, returns 0 at EOF
-static int bitbuf_skip(struct bitbuf *bb, int bits)
+// Top up the accumulator to at least 56 bits unless input runs out.
+// With 8 bytes left in the buffer load a whole word: the bytes past the
+// ones counted land above bitcount and get ORed in again unchanged next time.
+static void bitbuf_fill(struct bitbuf *bb)
 {
-  int pos = bb->bitpos + bits + (bits<0), len;
+  while (bb->bitcount < 56) {
+    if (bb->pos == bb->len) {
+      if (bb->fd == -1) return;
+      bb->pos = 0;
+      if (1 > (bb->len = read(bb->fd, bb->buf, bb->max))) {
+        bb->len = 0;
+        return;
+      }
+    }
+    if (bb->len-bb->pos >= 8) {
+      unsigned long long word;
 
-  while (pos >= (len = bb->len<<3)) {
-    pos -= len;
-    if (1 > (bb->len = read(bb->fd, bb->buf, bb->max))) {
-      if (!bits) break;
-      error_exit("inflate EOF");
+      memcpy(&word, bb->buf+bb->pos, 8);
+      bb->bits |= SWAP_LE64(word) << bb->bitcount;
+      bb->pos += (63-bb->bitcount)>>3;
+      bb->bitcount |= 56;
+    } else {
+      bb->bits |= (unsigned long long)(unsigned char)bb->buf[bb->pos++]
+        << bb->bitcount;
+      bb->bitcount += 8;
     }
   }
-  bb->bitpos = pos;
+}
 
-  return pos<len;
+// Discard bits already looked at
+static inline void bitbuf_drop(struct bitbuf *bb, int bits)
+{
+  bb->bits >>= bits;
+  bb->bitcount -= bits;
 }
 
-// Optimized single bit inlined version
-static inline int bitbuf_bit(struct bitbuf *bb)
+// Fetch the next X (up to 32) bits from the bitbuf, little endian
+static unsigned bitbuf_get(struct bitbuf *bb, int bits)
 {
-  int bufpos = bb->bitpos>>3;
+  unsigned result;
 
-  if (bufpos == bb->len) {
-    bitbuf_skip(bb, -1);
-    bufpos = 0;
+  if (bb->bitcount < bits) {
+    bitbuf_fill(bb);
+    if (bb->bitcount < bits) error_exit("inflate EOF");
   }
+  result = bb->bits & ((1ULL<<bits)-1);
+  bitbuf_drop(bb, bits);
 
-  return (bb->buf[bufpos]>>(bb->bitpos++&7))&1;
+  return result;
 }
 
-// Fetch the next X bits from the bitbuf, little endian
-static unsigned bitbuf_get(struct bitbuf *bb, int bits)
+// Advance without the overhead of recording bits
+static void bitbuf_skip(struct bitbuf *bb, unsigned bits)
 {
-  int result = 0, offset = 0;
-
   while (bits) {
-    int click = bb->bitpos >> 3, blow, blen;
-
-    // Load more data if buffer empty
-    if (click == bb->len) {
-      bitbuf_skip(bb, -1);
-      click = 0;
-    }
+    int n = bits > 32 ? 32 : bits;
 
-    // grab bits from next byte
-    blow = bb->bitpos & 7;
-    blen = 8-blow;
-    if (blen > bits) blen = bits;
-    result |= ((bb->buf[click] >> blow) & ((1<<blen)-1)) << offset;
-    offset += blen;
-    bits -= blen;
-    bb->bitpos += blen;
+    bitbuf_get(bb, n);
+    bits -= n;
   }
+}
 
-  return result;
+// Skip to next byte boundary
+static void bitbuf_align(struct bitbuf *bb)
+{
+  bitbuf_drop(bb, bb->bitcount&7);
 }
 
-static void bitbuf_flush(struct bitbuf *bb)
+// Is there more input? (Loads data, returns 0 at EOF.)
+static int bitbuf_more(struct bitbuf *bb)
 {
-  if (!bb->bitpos) return;
+  bitbuf_fill(bb);
 
-  xwrite(bb->fd, bb->buf, (bb->bitpos+7)>>3);
-  memset(bb->buf, 0, bb->max);
-  bb->bitpos = 0;
+  return bb->bitcount>0;
 }
 
-static void bitbuf_put(struct bitbuf *bb, int data, int len)
+static void bitbuf_flush(struct bitbuf *bb)
 {
-  while (len) {
-    int click = bb->bitpos >> 3, blow, blen;
+  if (bb->bitcount) {
+    bb->buf[bb->pos++] = bb->bits;
+    bb->bits = bb->bitcount = 0;
+  }
+  if (bb->pos) xwrite(bb->fd, bb->buf, bb->pos);
+  bb->pos = 0;
+}
 
-    // Flush buffer if necessary
-    if (click == bb->max) {
-      bitbuf_flush(bb);
-      click = 0;
+// Append up to 32 bits of data
+static void bitbuf_put(struct bitbuf *bb, unsigned data, int len)
+{
+  bb->bits |= (unsigned long long)data << bb->bitcount;
+  bb->bitcount += len;
+  while (bb->bitcount >= 8) {
+    if (bb->pos == bb->max) {
+      xwrite(bb->fd, bb->buf, bb->pos);
+      bb->pos = 0;
     }
-    blow = bb->bitpos & 7;
-    blen = 8-blow;
-    if (blen > len) blen = len;
-    bb->buf[click] |= data << blow;
-    bb->bitpos += blen;
-    data >>= blen;
-    len -= blen;
+    bb->buf[bb->pos++] = bb->bits;
+    bb->bits >>= 8;
+    bb->bitcount -= 8;
   }
 }
 
@@ -158,15 +195,37 @@ static void output_byte(struct deflate *dd, char sym)
   if (pos == 32767) inflate_out(dd, 32768);
 }
 
-// Huffman coding uses bits to traverse a binary tree to a leaf node,
-// By placing frequently occurring symbols at shorter paths, frequently
-// used symbols may be represented in fewer bits than uncommon symbols.
-// (length[0] isn't used but code's clearer if it's there.)
+static void output_bytes(struct deflate *dd, char *data, unsigned len)
+{
+  while (len) {
+    unsigned pos = dd->pos & 32767, n = 32768-pos;
+
+    if (n > len) n = len;
+    memcpy(dd->data+pos, data, n);
+    dd->pos += n;
+    data += n;
+    len -= n;
+    if (!(dd->pos & 32767)) inflate_out(dd, 32768);
+  }
+}
 
-struct huff {
-  unsigned short length[16];  // How many symbols have this bit length?
-  unsigned short symbol[288]; // sorted by bit length, then ascending order
-};
+// Copy len bytes from dist back in the 32k window, a chunk at a time.
+// Chunks longer than dist overlap themselves and must go a byte at a time.
+static void copy_match(struct deflate *dd, unsigned dist, unsigned len)
+{
+  while (len) {
+    unsigned pos = dd->pos & 32767, from = (dd->pos-dist) & 32767, n = len, i;
+    char *to = dd->data+pos, *src = dd->data+from;
+
+    if (n > 32768-pos) n = 32768-pos;
+    if (n > 32768-from) n = 32768-from;
+    if (dist >= n) memmove(to, src, n);
+    else for (i = 0; i<n; i++) to[i] = src[i];
+    dd->pos += n;
+    len -= n;
+    if (!(dd->pos & 32767)) inflate_out(dd, 32768);
+  }
+}
 
 // Create simple huffman tree from array of bit lengths.
 
@@ -189,18 +248,64 @@ static void len2huff(struct huff *huff, char bitlen[], int len)
   for (i = 0; i<len; i++) if (bitlen[i]) huff->symbol[offset[bitlen[i]]++] = i;
 }
 
-// Fetch and decode next huffman coded symbol from bitbuf.
-// This takes advantage of the sorting to navigate the tree as an array:
-// each time we fetch a bit we have all the codes at that bit level in
-// order with no gaps.
-static unsigned huff_and_puff(struct bitbuf *bb, struct huff *huff)
+// Huffman codes are sent most significant bit first into a little endian
+// bitstream, so table lookups and output want them reversed.
+static unsigned bitrev(unsigned code, int len)
+{
+  unsigned rev = 0;
+
+  while (len--) {
+    rev = (rev<<1) | (code&1);
+    code >>= 1;
+  }
+
+  return rev;
+}
+
+// Build a lookup table from a huff: entry for the next "bits" input bits.
+// Low 5 bits are the code length to consume, then 32 means one symbol
+// (in bits 8 and up), 64 means two literals (bits 8-15 and 16-23, literal
+// tables only), and 0 means the code is longer than the table.
+static void huff_table(struct huff *huff, unsigned *table, int bits, int pair)
+{
+  int len, i, count, sym = 0;
+  unsigned code = 0;
+
+  memset(table, 0, sizeof(*table)<<bits);
+  for (len = 1; len<16; len++) {
+    for (count = huff->length[len]; count--; code++, sym++) {
+      unsigned entry = len | 32 | (huff->symbol[sym]<<8);
+
+      if (len > bits) continue;
+      for (i = bitrev(code, len); i < 1<<bits; i += 1<<len) table[i] = entry;
+    }
+    code <<= 1;
+  }
+
+  // Pack a second literal into entries when both codes fit. The second
+  // code is looked up in the bits left over, a lower slot than i, so going
+  // down only ever reads entries not yet turned into pairs.
+  if (pair) for (i = (1<<bits)-1; i>=0; i--) {
+    unsigned e1 = table[i], e2;
+
+    if ((e1&96) != 32 || (e1>>8) > 255) continue;
+    e2 = table[i>>(e1&31)];
+    if ((e2&96) != 32 || (e2>>8) > 255 || (e1&31)+(e2&31) > bits) continue;
+    table[i] = ((e1&31)+(e2&31)) | 64 | (e1&0xff00) | ((e2>>8)<<16);
+  }
+}
+
+// Decode a code longer than the lookup table the slow way: this takes
+// advantage of the sorting to navigate the tree as an array. Each time we
+// fetch a bit we have all the codes at that bit level in order with no gaps.
+static unsigned huff_slow(struct bitbuf *bb, struct huff *huff)
 {
   unsigned short *length = huff->length;
   int start = 0, offset = 0;
 
   // Traverse through the bit lengths until our code is in this range
   for (;;) {
-    offset = (offset << 1) | bitbuf_bit(bb);
+    offset = (offset << 1) | bitbuf_get(bb, 1);
     start += *++length;
     if ((offset -= *length) < 0) break;
     if ((length - huff->length) & 16) error_exit("bad symbol");
@@ -209,6 +314,22 @@ static unsigned huff_and_puff(struct bitbuf *bb, struct huff *huff)
   return huff->symbol[start + offset];
 }
 
+// Fetch next table entry, falling back to huff_slow (returns entry with
+// one symbol) for long codes. Entries of pairs consume both literals.
+static unsigned huff_decode(struct bitbuf *bb, unsigned *table, int bits,
+  struct huff *huff)
+{
+  unsigned entry;
+
+  if (bb->bitcount < 15) bitbuf_fill(bb);
+  entry = table[bb->bits & ((1<<bits)-1)];
+  if (!(entry&96)) return 32 | (huff_slow(bb, huff)<<8);
+  if ((entry&31) > bb->bitcount) error_exit("inflate EOF");
+  bitbuf_drop(bb, entry&31);
+
+  return entry;
+}
+
 // Decompress deflated data from bitbuf to dd->outfd.
 static void inflate(struct deflate *dd, struct bitbuf *bb)
 {
@@ -225,37 +346,45 @@ static void inflate(struct deflate *dd, struct bitbuf *bb)
 
     // Uncompressed block?
     if (!type) {
-      int len, nlen;
+      unsigned len, nlen, n;
 
       // Align to byte, read length
-      bitbuf_skip(bb, (8-bb->bitpos)&7);
+      bitbuf_align(bb);
       len = bitbuf_get(bb, 16);
       nlen = bitbuf_get(bb, 16);
       if (len != (0xffff & ~nlen)) error_exit("bad len");
 
-      // Dump literal output data
+      // Dump literal output data: whole bytes left in the accumulator first,
+      // then straight from the input buffer.
+      while (len && bb->bitcount) {
+        output_byte(dd, bitbuf_get(bb, 8));
+        len--;
+      }
+      if (!bb->bitcount) bb->bits = 0;
       while (len) {
-        int pos = bb->bitpos >> 3, bblen = bb->len - pos;
-        char *p = bb->buf+pos;
-
-        // dump bytes until done or end of current bitbuf contents
-        if (bblen > len) bblen = len;
-        pos = bblen;
-        while (pos--) output_byte(dd, *(p++));
-        bitbuf_skip(bb, bblen << 3);
-        len -= bblen;
+        if (bb->pos == bb->len) {
+          if (bb->fd == -1 || 1 > (bb->len = read(bb->fd, bb->buf, bb->max)))
+            error_exit("inflate EOF");
+          bb->pos = 0;
+        }
+        if ((n = bb->len - bb->pos) > len) n = len;
+        output_bytes(dd, bb->buf+bb->pos, n);
+        bb->pos += n;
+        len -= n;
       }
 
     // Compressed block
     } else {
       struct huff *disthuff, *lithuff;
+      unsigned *disttab, *littab;
 
       // Dynamic huffman codes?
       if (type == 2) {
-        struct huff *h2 = ((struct huff *)libbuf)+1;
+        struct huff h2;
         int i, litlen, distlen, hufflen;
         char *hufflen_order = "\x10\x11\x12\0\x08\x07\x09\x06\x0a\x05\x0b"
-                              "\x04\x0c\x03\x0d\x02\x0e\x01\x0f", *bits;
+                              "\x04\x0c\x03\x0d\x02\x0e\x01\x0f",
+             bits[288+32+138];
 
         // The huffman trees are stored as a series of bit lengths
         litlen = bitbuf_get(bb, 5)+257;  // max 288
@@ -266,13 +395,13 @@ static void inflate(struct deflate *dd, struct bitbuf *bb)
         // a complicated way: an array of bit lengths (hufflen many
         // entries, each 3 bits) is used to fill out an array of 19 entries
         // in a magic order, leaving the rest 0. Then make a tree out of it:
-        memset(bits = libbuf+1, 0, 19);
+        memset(bits, 0, 19);
         for (i=0; i<hufflen; i++) bits[hufflen_order[i]] = bitbuf_get(bb, 3);
-        len2huff(h2, bits, 19);
+        len2huff(&h2, bits, 19);
 
         // Use that tree to read in the literal and distance bit lengths
         for (i = 0; i < litlen + distlen;) {
-          int sym = huff_and_puff(bb, h2);
+          int sym = huff_slow(bb, &h2);
 
           // 0-15 are literals, 16 = repeat previous code 3-6 times,
           // 17 = 3-10 zeroes (3 bit), 18 = 11-138 zeroes (7 bit)
@@ -280,40 +409,50 @@ static void inflate(struct deflate *dd, struct bitbuf *bb)
           else {
             int len = sym & 2;
 
+            if (sym == 16 && !i) error_exit("bad tree");
             len = bitbuf_get(bb, sym-14+len+(len>>1)) + 3 + (len<<2);
-            memset(bits+i, bits[i-1] * !(sym&3), len);
+            memset(bits+i, sym == 16 ? bits[i-1] : 0, len);
             i += len;
           }
         }
         if (i > litlen+distlen) error_exit("bad tree");
 
-        len2huff(lithuff = h2, bits, litlen);
-        len2huff(disthuff = ((struct huff *)libbuf)+2, bits+litlen, distlen);
+        len2huff(lithuff = &dd->lit, bits, litlen);
+        len2huff(disthuff = &dd->dist, bits+litlen, distlen);
+        huff_table(lithuff, littab = dd->littab, LITBITS, 1);
+        huff_table(disthuff, disttab = dd->disttab, DISTBITS, 0);
 
       // Static huffman codes
       } else {
-        lithuff = dd->fixlithuff;
-        disthuff = dd->fixdisthuff;
+        lithuff = &dd->fixlit;
+        disthuff = &dd->fixdist;
+        littab = dd->fixlittab;
+        disttab = dd->fixdisttab;
       }
 
       // Use huffman tables to decode block of compressed symbols
       for (;;) {
-        int sym = huff_and_puff(bb, lithuff);
+        unsigned entry = huff_decode(bb, littab, LITBITS, lithuff), sym, len,
+          dist;
+
+        // Two literals?
+        if (entry&64) {
+          output_byte(dd, entry>>8);
+          output_byte(dd, entry>>16);
+          continue;
+        }
 
         // Literal?
-        if (sym < 256) output_byte(dd, sym);
+        if ((sym = entry>>8) < 256) output_byte(dd, sym);
 
         // Copy range?
         else if (sym > 256) {
-          int len, dist;
-
-          sym -= 257;
+          if ((sym -= 257) > 28) error_exit("bad symbol");
           len = dd->lenbase[sym] + bitbuf_get(bb, dd->lenbits[sym]);
-          sym = huff_and_puff(bb, disthuff);
+          sym = huff_decode(bb, disttab, DISTBITS, disthuff)>>8;
+          if (sym > 29) error_exit("bad symbol");
           dist = dd->distbase[sym] + bitbuf_get(bb, dd->distbits[sym]);
-          sym = dd->pos & 32767;
-
-          while (len--) output_byte(dd, dd->data[(dd->pos-dist) & 32767]);
+          copy_match(dd, dist, len);
 
         // End of block
         } else break;
@@ -327,56 +466,384 @@ static void inflate(struct deflate *dd, struct bitbuf *bb)
   if (dd->pos & 32767) inflate_out(dd, dd->pos&32767);
 }
 
+// Compression level tuning, from zlib: drop to a quarter of the chain once
+// a match is "good", stop lazy matching (levels 4-9) once a match is "lazy"
+// long or only insert matches that short into the hash (levels 1-3), stop
+// searching once a match is "nice", and follow at most "chain" candidates.
+static struct {
+  short good, lazy, nice, chain;
+} deflate_levels[] = {
+  {0, 0, 0, 0}, {4, 4, 8, 4}, {4, 5, 16, 8}, {4, 6, 32, 32},
+  {4, 4, 16, 16}, {8, 16, 32, 32}, {8, 16, 128, 128}, {8, 32, 128, 256},
+  {32, 128, 258, 1024}, {32, 258, 258, 4096}
+};
+
+// Lookahead kept past the current position: longest match plus a hash
+#define LOOKAHEAD (258+3+1)
+#define BLOCKSYMS 16384
+
+static unsigned deflate_hash(unsigned char *p)
+{
+  return ((p[0]<<16 | p[1]<<8 | p[2])*2654435761U) >> 17;
+}
+
+// Add position to the hash chains, returning the previous chain head
+static unsigned hash_insert(struct deflate *dd, unsigned pos)
+{
+  unsigned h = deflate_hash((void *)dd->data+pos), prev = dd->hashhead[h];
+
+  dd->hashchain[pos&32767] = prev;
+  dd->hashhead[h] = pos;
+
+  return prev;
+}
+
+// Longest match at pos better than prev, among the hash chain starting
+// at cur. Returns 0 if nothing better.
+static unsigned longest_match(struct deflate *dd, unsigned pos, unsigned avail,
+  unsigned prev, unsigned cur, unsigned *dist)
+{
+  unsigned char *data = (void *)dd->data, *scan = data+pos;
+  unsigned best = prev, limit = pos>32768 ? pos-32768 : 0,
+    nice = dd->nice > avail ? avail : dd->nice;
+  int chain = dd->chain;
+
+  if (prev >= avail) return 0;
+  if (prev >= dd->good) chain >>= 2;
+  while (cur > limit && chain--) {
+    unsigned char *match = data+cur;
+
+    if (match[best] == scan[best] && *match == *scan
+      && match[1] == scan[1])
+    {
+      unsigned len = 2;
+
+      while (len < avail && match[len] == scan[len]) len++;
+      if (len > best) {
+        best = len;
+        *dist = pos-cur;
+        if (len >= nice) break;
+      }
+    }
+    cur = dd->hashchain[cur&32767];
+  }
+
+  return best>prev ? best : 0;
+}
+
+// Record literal (dist 0) or length/distance pair for the current block
+static void deflate_sym(struct deflate *dd, unsigned litlen, unsigned dist)
+{
+  dd->symlit[dd->symcount] = litlen;
+  dd->symdist[dd->symcount++] = dist;
+  if (dist) {
+    dd->freqlit[257+dd->lcode[litlen-3]]++;
+    dd->freqdist[dd->dcode[dist<=256 ? dist-1 : 256+((dist-1)>>7)]]++;
+  } else dd->freqlit[litlen]++;
+}
+
+// Huffman code lengths for freq[], at most limit bits long. Builds the tree
+// by merging the two lightest of the sorted leaves and already merged nodes
+// (which come out sorted), then flattens the weights and retries if too deep.
+static void huff_lengths(unsigned *freq, int count, int limit, char *bitlen)
+{
+  int sym[288], up[576], depth[576], i, j, leaf, node, next, nleaf, max,
+    scale = 0;
+  unsigned weight[576];
+
+  for (;;) {
+    for (i = nleaf = 0; i<count; i++) {
+      bitlen[i] = 0;
+      if (freq[i]) sym[nleaf++] = i;
+    }
+
+    // Less than two symbols: make up a complete one bit code
+    if (nleaf < 2) {
+      if (nleaf) bitlen[*sym] = 1;
+      for (i = 0; nleaf<2; i++) if (!bitlen[i]) bitlen[i] = 1, nleaf++;
+
+      return;
+    }
+
+    // Sort leaves by weight
+    for (i = 0; i<nleaf; i++) {
+      unsigned w = scale ? (freq[sym[i]]>>scale)|1 : freq[sym[i]];
+      int s = sym[i];
+
+      for (j = i; j && weight[j-1] > w; j--) {
+        weight[j] = weight[j-1];
+        sym[j] = sym[j-1];
+      }
+      weight[j] = w;
+      sym[j] = s;
+    }
+
+    leaf = 0;
+    node = next = nleaf;
+    while (next < 2*nleaf-1) {
+      int a, b;
+
+      a = (leaf<nleaf && (node==next || weight[leaf]<=weight[node]))
+        ? leaf++ : node++;
+      b = (leaf<nleaf && (node==next || weight[leaf]<=weight[node]))
+        ? leaf++ : node++;
+      weight[next] = weight[a]+weight[b];
+      up[a] = up[b] = next++;
+    }
+    depth[next-1] = 0;
+    for (i = next-2; i>=0; i--) depth[i] = depth[up[i]]+1;
+    for (i = max = 0; i<nleaf; i++)
+      if ((bitlen[sym[i]] = depth[i]) > max) max = depth[i];
+    if (max <= limit) return;
+    scale++;
+  }
+}
+
+// Canonical (bit reversed) codes from bit lengths
+static void huff_codes(char *bitlen, int count, unsigned short *codes)
+{
+  int bl_count[16], next[16], i, code = 0;
+
+  memset(bl_count, 0, sizeof(bl_count));
+  for (i = 0; i<count; i++) bl_count[bitlen[i]]++;
+  bl_count[0] = 0;
+  for (i = 1; i<16; i++) next[i] = code = (code+bl_count[i-1])<<1;
+  for (i = 0; i<count; i++)
+    if (bitlen[i]) codes[i] = bitrev(next[bitlen[i]]++, bitlen[i]);
+}
+
+// Run length encode code lengths into symbols 0-18 with extra bits in the
+// high byte, counting symbol frequencies.
+static int rle_lengths(char *bits, int len, unsigned short *out,
+  unsigned *freq)
+{
+  int i = 0, count = 0, run, n;
+
+  while (i<len) {
+    unsigned sym;
+
+    for (run = 1; i+run<len && bits[i+run] == bits[i]; run++);
+    if (!bits[i] && run >= 3) {
+      if ((n = run) > 138) n = 138;
+      sym = n>10 ? 18 | (n-11)<<8 : 17 | (n-3)<<8;
+    } else if (bits[i] && run >= 4) {
+      freq[out[count++] = bits[i++]]++;
+      if ((n = run-1) > 6) n = 6;
+      sym = 16 | (n-3)<<8;
+    } else {
+      n = 1;
+      sym = bits[i];
+    }
+    freq[(out[count++] = sym)&255]++;
+    i += n;
+  }
+
+  return count;
+}
+
+// Emit symbols collected in dd as a block: stored, fixed, or dynamic
+// huffman, whichever comes out smallest.
+static void deflate_block(struct deflate *dd, struct bitbuf *bb, char *raw,
+  unsigned rawlen, int final)
+{
+  char *hufflen_order = "\x10\x11\x12\0\x08\x07\x09\x06\x0a\x05\x0b"
+                        "\x04\x0c\x03\x0d\x02\x0e\x01\x0f",
+       bits[286+30], lens[286+30], fixbits[288+30], clen[19], *litbits,
+       *distbits;
+  unsigned short codes[288+30], ccodes[19], rle[286+30], *litcodes,
+    *distcodes;
+  unsigned cfreq[19], i, n, hlit, hdist, hclen, nrle, extra = 0;
+  unsigned long long dyn, fix, stored;
+
+  dd->freqlit[256]++;
+  huff_lengths(dd->freqlit, 286, 15, bits);
+  huff_lengths(dd->freqdist, 30, 15, bits+286);
+  for (hlit = 286; !bits[hlit-1]; hlit--);
+  for (hdist = 30; hdist>1 && !bits[286+hdist-1]; hdist--);
+  memcpy(lens, bits, hlit);
+  memcpy(lens+hlit, bits+286, hdist);
+  memset(cfreq, 0, sizeof(cfreq));
+  nrle = rle_lengths(lens, hlit+hdist, rle, cfreq);
+  huff_lengths(cfreq, 19, 7, clen);
+  for (hclen = 19; hclen>4 && !clen[hufflen_order[hclen-1]]; hclen--);
+
+  // Block sizes in bits
+  for (i = 0; i<288; i++) fixbits[i] = 8 + (i>143) - ((i>255)<<1) + (i>279);
+  memset(fixbits+288, 5, 30);
+  for (i = 0; i<29; i++) extra += dd->freqlit[257+i]*dd->lenbits[i];
+  for (i = 0; i<30; i++) extra += dd->freqdist[i]*dd->distbits[i];
+  dyn = 17+3*hclen;
+  fix = 3;
+  for (i = 0; i<nrle; i++) {
+    n = rle[i]&255;
+    dyn += clen[n] + (n<16 ? 0 : n==16 ? 2 : n==17 ? 3 : 7);
+  }
+  for (i = 0; i<286; i++) {
+    dyn += (unsigned long long)dd->freqlit[i]*bits[i];
+    fix += (unsigned long long)dd->freqlit[i]*fixbits[i];
+  }
+  for (i = 0; i<30; i++) {
+    dyn += (unsigned long long)dd->freqdist[i]*bits[286+i];
+    fix += (unsigned long long)dd->freqdist[i]*5;
+  }
+  dyn += extra;
+  fix += extra;
+  stored = 8*(unsigned long long)rawlen + 40*(rawlen/65535+1);
+
+  if (stored <= dyn && stored <= fix) {
+    do {
+      n = rawlen>65535 ? 65535 : rawlen;
+      bitbuf_put(bb, final && n == rawlen, 1);
+      bitbuf_put(bb, 0, 2);
+      bitbuf_put(bb, 0, -bb->bitcount&7);
+      bitbuf_put(bb, n, 16);
+      bitbuf_put(bb, 0xffff & ~n, 16);
+      for (i = 0; i<n; i++) bitbuf_put(bb, (unsigned char)raw[i], 8);
+      raw += n;
+      rawlen -= n;
+    } while (rawlen);
+  } else {
+    if (fix <= dyn) {
+      bitbuf_put(bb, final, 1);
+      bitbuf_put(bb, 1, 2);
+      litbits = fixbits;
+      huff_codes(litbits, 288, litcodes = codes);
+    } else {
+      bitbuf_put(bb, final, 1);
+      bitbuf_put(bb, 2, 2);
+      bitbuf_put(bb, hlit-257, 5);
+      bitbuf_put(bb, hdist-1, 5);
+      bitbuf_put(bb, hclen-4, 4);
+      for (i = 0; i<hclen; i++) bitbuf_put(bb, clen[hufflen_order[i]], 3);
+      huff_codes(clen, 19, ccodes);
+      for (i = 0; i<nrle; i++) {
+        n = rle[i]&255;
+        bitbuf_put(bb, ccodes[n], clen[n]);
+        if (n>15) bitbuf_put(bb, rle[i]>>8, n==16 ? 2 : n==17 ? 3 : 7);
+      }
+      litbits = bits;
+      huff_codes(litbits, 286, litcodes = codes);
+    }
+    distbits = litbits+(litbits == bits ? 286 : 288);
+    huff_codes(distbits, 30, distcodes = codes+288);
+
+    for (i = 0; i<dd->symcount; i++) {
+      unsigned len = dd->symlit[i], dist = dd->symdist[i], c;
+
+      if (!dist) bitbuf_put(bb, litcodes[len], litbits[len]);
+      else {
+        c = dd->lcode[len-3];
+        bitbuf_put(bb, litcodes[257+c], litbits[257+c]);
+        if (dd->lenbits[c]) bitbuf_put(bb, len-dd->lenbase[c], dd->lenbits[c]);
+        c = dd->dcode[dist<=256 ? dist-1 : 256+((dist-1)>>7)];
+        bitbuf_put(bb, distcodes[c], distbits[c]);
+        if (dd->distbits[c])
+          bitbuf_put(bb, dist-dd->distbase[c], dd->distbits[c]);
+      }
+    }
+    bitbuf_put(bb, litcodes[256], litbits[256]);
+  }
+
+  dd->symcount = 0;
+  memset(dd->freqlit, 0, sizeof(dd->freqlit));
+  memset(dd->freqdist, 0, sizeof(dd->freqdist));
+}
+
 // Deflate from dd->infd to bitbuf
-// For deflate, dd->len = input read, dd->pos = input consumed
+// Input goes through a 64k window: once full, the completed block is sent
+// and the top 32k slides down while positions in the hash chains adjust.
 static void deflate(struct deflate *dd, struct bitbuf *bb)
 {
   char *data = dd->data;
-  int len, final = 0;
+  unsigned pos = 0, end = 0, start = 0, done = 0, len, dist = 0, prevlen = 0,
+    prevdist = 0, avail, cur, i;
+  int eof = 0, pending = 0;
 
   dd->crc = ~0;
 
-  while (!final) {
-    // Read next half-window of data if we haven't hit EOF yet.
-    len = readall(dd->infd, data+(dd->len&32768), 32768);
-    if (len < 0) perror_exit("read"); // TODO: add filename
-    if (len != 32768) final++;
-    if (dd->crcfunc) dd->crcfunc(dd, data+(dd->len&32768), len);
-    // dd->len += len;  crcfunc advances len TODO
-
-    // store block as literal
-// TODO: actually compress!
-    bitbuf_put(bb, final, 1);
-    bitbuf_put(bb, 0, 1);
-
-    bitbuf_put(bb, 0, (8-bb->bitpos)&7);
-    bitbuf_put(bb, len, 16);
-    bitbuf_put(bb, 0xffff & ~len, 16);
-
-    // repeat until spanked
-    while (dd->pos != dd->len) {
-      unsigned pos = dd->pos&65535;
+  for (;;) {
+    // Keep enough lookahead for a full length match
+    if (!eof && end-pos < LOOKAHEAD) {
+      if (end == 65536) {
+        if (done > start) deflate_block(dd, bb, data+start, done-start, 0);
+        memmove(data, data+32768, 32768);
+        for (i = 0; i<32768; i++) {
+          dd->hashhead[i] = dd->hashhead[i]>=32768 ? dd->hashhead[i]-32768 : 0;
+          dd->hashchain[i] = dd->hashchain[i]>=32768 ? dd->hashchain[i]-32768:0;
+        }
+        pos -= 32768;
+        end -= 32768;
+        start = done -= 32768;
+      }
+      len = readall(dd->infd, data+end, 65536-end);
+      if (len == -1) perror_exit("read"); // TODO: add filename
+      if (len != 65536-end) eof++;
+      if (dd->crcfunc) dd->crcfunc(dd, data+end, len);
+      end += len;
+    }
+    if (pos == end) break;
+
+    // Find match here (only if it beats the one found at the last position)
+    avail = end-pos;
+    if (avail > 258) avail = 258;
+    len = 0;
+    if (avail >= 3) {
+      cur = hash_insert(dd, pos);
+      if (dd->greedy) len = longest_match(dd, pos, avail, 2, cur, &dist);
+      else if (prevlen < dd->lazy)
+        len = longest_match(dd, pos, avail, prevlen>2 ? prevlen : 2, cur,&dist);
+      if (len == 3 && dist > 4096) len = 0;
+    }
 
-      bitbuf_put(bb, data[pos], 8);
+    if (dd->greedy) {
+      if (len) {
+        deflate_sym(dd, len, dist);
+        if (len <= dd->lazy)
+          for (i = pos+1; i<pos+len; i++) if (end-i >= 3) hash_insert(dd, i);
+        pos += len;
+      } else deflate_sym(dd, (unsigned char)data[pos++], 0);
+      done = pos;
+
+    // Lazy matching: use the previous position's match unless this beats it
+    } else if (prevlen >= 3 && !len) {
+      deflate_sym(dd, prevlen, prevdist);
+      for (i = pos+1; i<pos-1+prevlen; i++) if (end-i >= 3) hash_insert(dd, i);
+      done = pos += prevlen-1;
+      prevlen = pending = 0;
+    } else {
+      if (pending) deflate_sym(dd, (unsigned char)data[pos-1], 0);
+      done = pos++;
+      pending = 1;
+      prevlen = len;
+      prevdist = dist;
+    }
 
-      // need to refill buffer?
-      if (!(32767 & ++dd->pos) && !final) break;
+    if (dd->symcount == BLOCKSYMS) {
+      deflate_block(dd, bb, data+start, done-start, 0);
+      start = done;
     }
   }
+  if (pending) deflate_sym(dd, (unsigned char)data[(done = pos)-1], 0);
+  deflate_block(dd, bb, data+start, done-start, 1);
   bitbuf_flush(bb);
 }
 
 // Allocate memory for deflate/inflate.
 static struct deflate *init_deflate(int compress)
 {
-  int i, n = 1;
-  struct deflate *dd = xmalloc(sizeof(struct deflate)+32768*(compress ? 4 : 1));
+  int i, j, n = 1;
+  struct deflate *dd = xmalloc(sizeof(struct deflate)+32768*(compress ? 8 : 1));
+  char bits[288];
 
   memset(dd, 0, sizeof(struct deflate));
-  // decompress needs 32k history, compress adds 64k hashhead and 32k hashchain
+  // decompress needs 32k history, compress has a 64k window, 64k hashhead,
+  // 64k hashchain, and 64k of symbols for the current block
   if (compress) {
     dd->hashhead = (unsigned short *)(dd->data+65536);
-    dd->hashchain = (unsigned short *)(dd->data+65536+32768);
+    dd->hashchain = (unsigned short *)(dd->data+2*65536);
+    dd->symlit = (unsigned short *)(dd->data+3*65536);
+    dd->symdist = dd->symlit+BLOCKSYMS;
+    memset(dd->hashhead, 0, 2*65536);
   }
 
   // Calculate lenbits, lenbase, distbits, distbase
@@ -400,12 +867,25 @@ static struct deflate *init_deflate(int compress)
     dd->distbits[i] = n;
   }
 
-// TODO layout and lifetime of this?
+  // Reverse maps from match length and distance to code
+  if (compress) {
+    for (i = 0; i<29; i++)
+      for (j = dd->lenbase[i]; j<dd->lenbase[i]+(1<<dd->lenbits[i]); j++)
+        if (j<=258) dd->lcode[j-3] = i;
+    for (i = 0; i<30; i++)
+      for (j = dd->distbase[i]; j<dd->distbase[i]+(1<<dd->distbits[i]); j++)
+        dd->dcode[j<=256 ? j-1 : 256+((j-1)>>7)] = i;
+
+    return dd;
+  }
+
   // Init fixed huffman tables
-  for (i=0; i<288; i++) libbuf[i] = 8 + (i>143) - ((i>255)<<1) + (i>279);
-  len2huff(dd->fixlithuff = ((struct huff *)libbuf)+3, libbuf, 288);
-  memset(libbuf, 5, 30);
-  len2huff(dd->fixdisthuff = ((struct huff *)libbuf)+4, libbuf, 30);
+  for (i=0; i<288; i++) bits[i] = 8 + (i>143) - ((i>255)<<1) + (i>279);
+  len2huff(&dd->fixlit, bits, 288);
+  huff_table(&dd->fixlit, dd->fixlittab, LITBITS, 1);
+  memset(bits, 5, 30);
+  len2huff(&dd->fixdist, bits, 30);
+  huff_table(&dd->fixdist, dd->fixdisttab, DISTBITS, 0);
 
   return dd;
 }
@@ -431,13 +911,30 @@ static int is_gzip(struct bitbuf *bb)
 
 static void gzip_crc(struct deflate *dd, char *data, unsigned len)
 {
-  int i;
-  unsigned crc, *crc_table = dd->crctable;
+  unsigned char *p = (void *)data;
+  unsigned crc, *t = dd->crctable;
 
   crc = dd->crc;
-  for (i = 0; i<len; i++) crc = crc_table[(crc^data[i])&0xff] ^ (crc>>8);
-  dd->crc = crc;
   dd->len += len;
+  for (; len>=8; len -= 8, p += 8) {
+    crc ^= p[0] | p[1]<<8 | p[2]<<16 | (unsigned)p[3]<<24;
+    crc = t[7*256+(crc&255)] ^ t[6*256+((crc>>8)&255)]
+      ^ t[5*256+((crc>>16)&255)] ^ t[4*256+(crc>>24)]
+      ^ t[3*256+p[4]] ^ t[2*256+p[5]] ^ t[256+p[6]] ^ t[p[7]];
+  }
+  while (len--) crc = t[(crc^*p++)&0xff] ^ (crc>>8);
+  dd->crc = crc;
+}
+
+// Little endian crc table, extended for slice-by-8
+static void gzip_crc_init(struct deflate *dd)
+{
+  unsigned *t = dd->crctable;
+  int i;
+
+  crc_init(t, 1);
+  for (i = 256; i<8*256; i++) t[i] = (t[i-256]>>8) ^ t[t[i-256]&255];
+  dd->crcfunc = gzip_crc;
 }
 
 /*
@@ -456,29 +953,35 @@ unsigned adler32(char *buf, unsigned len, unsigned crc)
 }
 */
 
-long long gzip_fd(int infd, int outfd)
+long long gzip_fd(int infd, int outfd, int level)
 {
   struct bitbuf *bb = bitbuf_init(outfd, 4096);
   struct deflate *dd = init_deflate(1);
   long long rc;
 
+  if (level<1 || level>9) level = 6;
+  dd->good = deflate_levels[level].good;
+  dd->lazy = deflate_levels[level].lazy;
+  dd->nice = deflate_levels[level].nice;
+  dd->chain = deflate_levels[level].chain;
+  dd->greedy = level<4;
+
   // Header from RFC 1952 section 2.2:
   // 2 ID bytes (1F, 8b), gzip method byte (8=deflate), FLAG byte (none),
-  // 4 byte MTIME (zeroed), Extra Flags (2=maximum compression),
+  // 4 byte MTIME (zeroed), Extra Flags (2=maximum compression, 4=fastest),
   // Operating System (FF=unknown)
 
   dd->infd = infd;
-  xwrite(bb->fd, "\x1f\x8b\x08\0\0\0\0\0\x02\xff", 10);
+  xwrite(bb->fd, level==9 ? "\x1f\x8b\x08\0\0\0\0\0\x02\xff"
+    : level==1 ? "\x1f\x8b\x08\0\0\0\0\0\x04\xff"
+    : "\x1f\x8b\x08\0\0\0\0\0\0\xff", 10);
 
-  // Little endian crc table
-  crc_init(dd->crctable, 1);
-  dd->crcfunc = gzip_crc;
+  gzip_crc_init(dd);
 
   deflate(dd, bb);
 
   // tail: crc32, len32
 
-  bitbuf_put(bb, 0, (8-bb->bitpos)&7);
   bitbuf_put(bb, ~dd->crc, 32);
   bitbuf_put(bb, dd->len, 32);
   rc = dd->len;
@@ -494,22 +997,19 @@ long long gunzip_common(struct bitbuf *bb, struct deflate *dd)
 {
   long long rc = 0;
 
-  // Little endian crc table
-  crc_init(dd->crctable, 1);
-  dd->crcfunc = gzip_crc;
+  gzip_crc_init(dd);
 
   do {
     if (!is_gzip(bb)) error_exit("not gzip");
 
     inflate(dd, bb);
     // tail: crc32, len32
-    bitbuf_skip(bb, (8-bb->bitpos)&7);
+    bitbuf_align(bb);
     if (~dd->crc != bitbuf_get(bb, 32) || dd->len != bitbuf_get(bb, 32))
       error_exit("bad crc");
     rc += dd->len;
-    bitbuf_skip(bb, (8-bb->bitpos)&7);
     dd->pos = dd->len = 0;
-  } while (bitbuf_skip(bb, 0));
+  } while (bitbuf_more(bb));
   free(bb);
   free(dd);
 
@@ -8,6 +8,18 @@
 
 #include "toys.h"
 
+// Read in big chunks so syscalls don't dominate, buffer allocated on first use
+#define HASH_READ (128*1024)
+
+static char *hash_buf(void)
+{
+  static char *buf;
+
+  if (!buf) buf = xmalloc(HASH_READ);
+
+  return buf;
+}
+
 // Use external library of hand-coded assembly implementations?
 #if CFG_TOYBOX_LIBCRYPTO
 #include <openssl/md5.h>
@@ -37,6 +49,7 @@ void hash_by_name(int fd, char *name, char *result)
     USE_SHA384SUM(HASH_INIT("sha384sum", SHA384),)
     USE_SHA512SUM(HASH_INIT("sha512sum", SHA512),)
   }, * hash;
+  char *buf = hash_buf();
   int i;
 
   // This should never NOT match, so no need to check
@@ -46,9 +59,9 @@ void hash_by_name(int fd, char *name, char *result)
 
   hash->init(&ctx);
   for (;;) {
-      i = read(fd, libbuf, sizeof(libbuf));
+      i = read(fd, buf, HASH_READ);
       if (i<1) break;
-      hash->update(&ctx, libbuf, i);
+      hash->update(&ctx, buf, i);
   }
   hash->final(libbuf+128, &ctx);
 
@@ -133,157 +146,214 @@ static const unsigned sha1rconsts[] = {
 
 // Mix next 64 bytes of data into md5 hash
 
-static void md5_transform(struct browns *hash)
+#define MD5F(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MD5G(x, y, z) MD5F(z, x, y)
+#define MD5H(x, y, z) ((x) ^ (y) ^ (z))
+#define MD5I(x, y, z) ((y) ^ ((x) | ~(z)))
+#define MD5STEP(f, a, b, c, d, in, k, s) \
+  a += f(b, c, d) + (in) + (k); a = b + rol(a, s);
+
+static void md5_transform(struct browns *hash, char *data)
 {
-  unsigned x[4], *b = hash->buffer.i32;
+  unsigned x[16], a, b, c, d, *k = hash->rconsttable32;
   int i;
 
-  for (i = 0; i<4; i++) x[i] = hash->state.i32[i];
-  for (i = 0; i<64; i++) {
-    unsigned in, a, rot, temp;
-
-    a = (-i)&3;
-    if (i<16) {
-      in = i;
-      rot = 7+(5*(i&3));
-      temp = x[(a+1)&3];
-      temp = (temp & x[(a+2)&3]) | ((~temp) & x[(a+3)&3]);
-    } else if (i<32) {
-      in = (1+(5*i))&15;
-      temp = (i&3)+1;
-      rot = temp*5;
-      if (temp&2) rot--;
-      temp = x[(a+3)&3];
-      temp = (x[(a+1)&3] & temp) | (x[(a+2)&3] & ~temp);
-    } else if (i<48) {
-      in = (5+(3*(i&15)))&15;
-      rot = i&3;
-      rot = 4+(5*rot)+((rot+1)&6);
-      temp = x[(a+1)&3] ^ x[(a+2)&3] ^ x[(a+3)&3];
-    } else {
-      in = (7*(i&15))&15;
-      rot = (i&3)+1;
-      rot = (5*rot)+(((rot+2)&2)>>1);
-      temp = x[(a+2)&3] ^ (x[(a+1)&3] | ~x[(a+3)&3]);
-    }
-    temp += x[a] + SWAP_LE32(b[in]) + hash->rconsttable32[i];
-    x[a] = x[(a+1)&3] + ((temp<<rot) | (temp>>(32-rot)));
+  memcpy(x, data, 64);
+  if (IS_BIG_ENDIAN) for (i = 0; i<16; i++) x[i] = SWAP_LE32(x[i]);
+  a = hash->state.i32[0];
+  b = hash->state.i32[1];
+  c = hash->state.i32[2];
+  d = hash->state.i32[3];
+
+  // 4 rounds of 16 operations, each round with its own message word order
+  for (i = 0; i<16; i += 4) {
+    MD5STEP(MD5F, a, b, c, d, x[i], k[i], 7);
+    MD5STEP(MD5F, d, a, b, c, x[i+1], k[i+1], 12);
+    MD5STEP(MD5F, c, d, a, b, x[i+2], k[i+2], 17);
+    MD5STEP(MD5F, b, c, d, a, x[i+3], k[i+3], 22);
   }
-  for (i = 0; i<4; i++) hash->state.i32[i] += x[i];
+  for (; i<32; i += 4) {
+    MD5STEP(MD5G, a, b, c, d, x[(5*i+1)&15], k[i], 5);
+    MD5STEP(MD5G, d, a, b, c, x[(5*i+6)&15], k[i+1], 9);
+    MD5STEP(MD5G, c, d, a, b, x[(5*i+11)&15], k[i+2], 14);
+    MD5STEP(MD5G, b, c, d, a, x[(5*i)&15], k[i+3], 20);
+  }
+  for (; i<48; i += 4) {
+    MD5STEP(MD5H, a, b, c, d, x[(3*i+5)&15], k[i], 4);
+    MD5STEP(MD5H, d, a, b, c, x[(3*i+8)&15], k[i+1], 11);
+    MD5STEP(MD5H, c, d, a, b, x[(3*i+11)&15], k[i+2], 16);
+    MD5STEP(MD5H, b, c, d, a, x[(3*i+14)&15], k[i+3], 23);
+  }
+  for (; i<64; i += 4) {
+    MD5STEP(MD5I, a, b, c, d, x[(7*i)&15], k[i], 6);
+    MD5STEP(MD5I, d, a, b, c, x[(7*i+7)&15], k[i+1], 10);
+    MD5STEP(MD5I, c, d, a, b, x[(7*i+14)&15], k[i+2], 15);
+    MD5STEP(MD5I, b, c, d, a, x[(7*i+21)&15], k[i+3], 21);
+  }
+  hash->state.i32[0] += a;
+  hash->state.i32[1] += b;
+  hash->state.i32[2] += c;
+  hash->state.i32[3] += d;
 }
 
 // Mix next 64 bytes of data into sha1 hash.
 
-static void sha1_transform(struct browns *hash)
+#define SHA1STEP(f, k, a, b, c, d, e, w) \
+  e += rol(a, 5) + f(b, c, d) + (k) + (w); b = rol(b, 30);
+#define SHA1MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+static void sha1_transform(struct browns *hash, char *data)
 {
-  int i, j, k, count;
-  unsigned *block = hash->buffer.i32, oldstate[5], *rot[5], *temp, work;
+  unsigned w[80], a, b, c, d, e;
+  int i;
 
-  // Copy context->state.i32[] to working vars
-  for (i = 0; i<5; i++) {
-    oldstate[i] = hash->state.i32[i];
-    rot[i] = hash->state.i32 + i;
+  // Message schedule
+  memcpy(w, data, 64);
+  for (i = 0; i<16; i++) w[i] = SWAP_BE32(w[i]);
+  for (; i<80; i++) w[i] = rol(w[i-3] ^ w[i-8] ^ w[i-14] ^ w[i-16], 1);
+
+  a = hash->state.i32[0];
+  b = hash->state.i32[1];
+  c = hash->state.i32[2];
+  d = hash->state.i32[3];
+  e = hash->state.i32[4];
+
+  // 4 rounds of 20 operations each, renaming instead of rotating variables
+  for (i = 0; i<20; i += 5) {
+    SHA1STEP(MD5F, sha1rconsts[0], a, b, c, d, e, w[i]);
+    SHA1STEP(MD5F, sha1rconsts[0], e, a, b, c, d, w[i+1]);
+    SHA1STEP(MD5F, sha1rconsts[0], d, e, a, b, c, w[i+2]);
+    SHA1STEP(MD5F, sha1rconsts[0], c, d, e, a, b, w[i+3]);
+    SHA1STEP(MD5F, sha1rconsts[0], b, c, d, e, a, w[i+4]);
   }
-  if (IS_BIG_ENDIAN) for (i = 0; i<16; i++) block[i] = SWAP_LE32(block[i]);
-
-  // 4 rounds of 20 operations each.
-  for (i = count = 0; i<4; i++) {
-    for (j = 0; j<20; j++) {
-      work = *rot[2] ^ *rot[3];
-      if (!i) work = (work & *rot[1]) ^ *rot[3];
-      else {
-        if (i==2) work = ((*rot[1]|*rot[2])&*rot[3])|(*rot[1]&*rot[2]);
-        else work ^= *rot[1];
-      }
-
-      if (!i && j<16)
-        work += block[count] = (ror(block[count],8)&0xFF00FF00)
-                             | (rol(block[count],8)&0x00FF00FF);
-      else
-        work += block[count&15] = rol(block[(count+13)&15]
-              ^ block[(count+8)&15] ^ block[(count+2)&15] ^ block[count&15], 1);
-      *rot[4] += work + rol(*rot[0],5) + sha1rconsts[i];
-      *rot[1] = rol(*rot[1],30);
-
-      // Rotate by one for next time.
-      temp = rot[4];
-      for (k = 4; k; k--) rot[k] = rot[k-1];
-      *rot = temp;
-      count++;
-    }
+  for (; i<40; i += 5) {
+    SHA1STEP(MD5H, sha1rconsts[1], a, b, c, d, e, w[i]);
+    SHA1STEP(MD5H, sha1rconsts[1], e, a, b, c, d, w[i+1]);
+    SHA1STEP(MD5H, sha1rconsts[1], d, e, a, b, c, w[i+2]);
+    SHA1STEP(MD5H, sha1rconsts[1], c, d, e, a, b, w[i+3]);
+    SHA1STEP(MD5H, sha1rconsts[1], b, c, d, e, a, w[i+4]);
+  }
+  for (; i<60; i += 5) {
+    SHA1STEP(SHA1MAJ, sha1rconsts[2], a, b, c, d, e, w[i]);
+    SHA1STEP(SHA1MAJ, sha1rconsts[2], e, a, b, c, d, w[i+1]);
+    SHA1STEP(SHA1MAJ, sha1rconsts[2], d, e, a, b, c, w[i+2]);
+    SHA1STEP(SHA1MAJ, sha1rconsts[2], c, d, e, a, b, w[i+3]);
+    SHA1STEP(SHA1MAJ, sha1rconsts[2], b, c, d, e, a, w[i+4]);
+  }
+  for (; i<80; i += 5) {
+    SHA1STEP(MD5H, sha1rconsts[3], a, b, c, d, e, w[i]);
+    SHA1STEP(MD5H, sha1rconsts[3], e, a, b, c, d, w[i+1]);
+    SHA1STEP(MD5H, sha1rconsts[3], d, e, a, b, c, w[i+2]);
+    SHA1STEP(MD5H, sha1rconsts[3], c, d, e, a, b, w[i+3]);
+    SHA1STEP(MD5H, sha1rconsts[3], b, c, d, e, a, w[i+4]);
   }
   // Add the previous values of state.i32[]
-  for (i = 0; i<5; i++) hash->state.i32[i] += oldstate[i];
+  hash->state.i32[0] += a;
+  hash->state.i32[1] += b;
+  hash->state.i32[2] += c;
+  hash->state.i32[3] += d;
+  hash->state.i32[4] += e;
 }
 
-static void sha2_32_transform(struct browns *hash)
+// The sha2 sigma functions are single instructions with the RISC-V scalar
+// crypto extension (build with -march=..._zknh), else rotates and shifts.
+#ifdef __riscv_zknh
+#define ZKNH(name, insn, type) static inline type name(type x) \
+  { unsigned long r; asm(insn " %0, %1" : "=r"(r) : "r"(x)); return r; }
+ZKNH(sha256_S0, "sha256sum0", unsigned)
+ZKNH(sha256_S1, "sha256sum1", unsigned)
+ZKNH(sha256_s0, "sha256sig0", unsigned)
+ZKNH(sha256_s1, "sha256sig1", unsigned)
+#if __riscv_xlen == 64
+ZKNH(sha512_S0, "sha512sum0", unsigned long long)
+ZKNH(sha512_S1, "sha512sum1", unsigned long long)
+ZKNH(sha512_s0, "sha512sig0", unsigned long long)
+ZKNH(sha512_s1, "sha512sig1", unsigned long long)
+#define HAVE_ZKNH64
+#endif
+#else
+#define sha256_S0(x) (ror(x, 2) ^ ror(x, 13) ^ ror(x, 22))
+#define sha256_S1(x) (ror(x, 6) ^ ror(x, 11) ^ ror(x, 25))
+#define sha256_s0(x) (ror(x, 7) ^ ror(x, 18) ^ ((x) >> 3))
+#define sha256_s1(x) (ror(x, 17) ^ ror(x, 19) ^ ((x) >> 10))
+#endif
+#ifndef HAVE_ZKNH64
+#define sha512_S0(x) (ror(x, 28) ^ ror(x, 34) ^ ror(x, 39))
+#define sha512_S1(x) (ror(x, 14) ^ ror(x, 18) ^ ror(x, 41))
+#define sha512_s0(x) (ror(x, 1) ^ ror(x, 8) ^ ((x) >> 7))
+#define sha512_s1(x) (ror(x, 19) ^ ror(x, 61) ^ ((x) >> 6))
+#endif
+
+// One sha2 round: the caller renames the 8 working variables each round.
+#define SHA2ROUND(S0, S1, a, b, c, d, e, f, g, h, k, w) \
+  h += S1(e) + MD5F(e, f, g) + (k) + (w); d += h; \
+  h += S0(a) + SHA1MAJ(a, b, c);
+#define SHA2ROUNDS(S0, S1, k, w, i) \
+  SHA2ROUND(S0, S1, a, b, c, d, e, f, g, h, k[i], w[i]) \
+  SHA2ROUND(S0, S1, h, a, b, c, d, e, f, g, k[i+1], w[i+1]) \
+  SHA2ROUND(S0, S1, g, h, a, b, c, d, e, f, k[i+2], w[i+2]) \
+  SHA2ROUND(S0, S1, f, g, h, a, b, c, d, e, k[i+3], w[i+3]) \
+  SHA2ROUND(S0, S1, e, f, g, h, a, b, c, d, k[i+4], w[i+4]) \
+  SHA2ROUND(S0, S1, d, e, f, g, h, a, b, c, k[i+5], w[i+5]) \
+  SHA2ROUND(S0, S1, c, d, e, f, g, h, a, b, k[i+6], w[i+6]) \
+  SHA2ROUND(S0, S1, b, c, d, e, f, g, h, a, k[i+7], w[i+7])
+
+static void sha2_32_transform(struct browns *hash, char *data)
 {
-  unsigned block[64], s0, s1, S0, S1, ch, maj, temp1, temp2, rot[8];
+  unsigned block[64], a, b, c, d, e, f, g, h, *k = hash->rconsttable32,
+    *s = hash->state.i32;
   int i;
 
-  for (i = 0; i<16; i++) block[i] = SWAP_BE32(hash->buffer.i32[i]);
+  memcpy(block, data, 64);
+  for (i = 0; i<16; i++) block[i] = SWAP_BE32(block[i]);
 
   // Extend the message schedule array beyond first 16 words
-  for (i = 16; i<64; i++) {
-    s0 = ror(block[i-15], 7) ^ ror(block[i-15], 18) ^ (block[i-15] >> 3);
-    s1 = ror(block[i-2], 17) ^ ror(block[i-2], 19) ^ (block[i-2] >> 10);
-    block[i] = block[i-16] + s0 + block[i-7] + s1;
-  }
+  for (; i<64; i++) block[i] = block[i-16] + sha256_s0(block[i-15])
+    + block[i-7] + sha256_s1(block[i-2]);
+
   // Copy context->state.i32[] to working vars
-  for (i = 0; i<8; i++) rot[i] = hash->state.i32[i];
+  a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
   // 64 rounds
-  for (i = 0; i<64; i++) {
-    S1 = ror(rot[4],6) ^ ror(rot[4],11) ^ ror(rot[4], 25);
-    ch = (rot[4] & rot[5]) ^ ((~ rot[4]) & rot[6]);
-    temp1 = rot[7] + S1 + ch + hash->rconsttable32[i] + block[i];
-    S0 = ror(rot[0],2) ^ ror(rot[0],13) ^ ror(rot[0], 22);
-    maj = (rot[0] & rot[1]) ^ (rot[0] & rot[2]) ^ (rot[1] & rot[2]);
-    temp2 = S0 + maj;
-    memmove(rot+1, rot, 7*sizeof(*rot));
-    rot[4] += temp1;
-    rot[0] = temp1 + temp2;
+  for (i = 0; i<64; i += 8) {
+    SHA2ROUNDS(sha256_S0, sha256_S1, k, block, i)
   }
 
   // Add the previous values of state.i32[]
-  for (i = 0; i<8; i++) hash->state.i32[i] += rot[i];
+  s[0] += a, s[1] += b, s[2] += c, s[3] += d;
+  s[4] += e, s[5] += f, s[6] += g, s[7] += h;
 }
 
-static void sha2_64_transform(struct browns *hash)
+static void sha2_64_transform(struct browns *hash, char *data)
 {
-  unsigned long long block[80], s0, s1, S0, S1, ch, maj, temp1, temp2, rot[8];
+  unsigned long long block[80], a, b, c, d, e, f, g, h,
+    *k = hash->rconsttable64, *s = hash->state.i64;
   int i;
 
-  for (i=0; i<16; i++) block[i] = SWAP_BE64(hash->buffer.i64[i]);
+  memcpy(block, data, 128);
+  for (i = 0; i<16; i++) block[i] = SWAP_BE64(block[i]);
 
   // Extend the message schedule array beyond first 16 words
-  for (i = 16; i<80; i++) {
-    s0 = ror(block[i-15], 1) ^ ror(block[i-15], 8) ^ (block[i-15] >> 7);
-    s1 = ror(block[i-2], 19) ^ ror(block[i-2], 61) ^ (block[i-2] >> 6);
-    block[i] = block[i-16] + s0 + block[i-7] + s1;
-  }
+  for (; i<80; i++) block[i] = block[i-16] + sha512_s0(block[i-15])
+    + block[i-7] + sha512_s1(block[i-2]);
+
   // Copy context->state.i64[] to working vars
-  for (i = 0; i<8; i++) rot[i] = hash->state.i64[i];
+  a = s[0], b = s[1], c = s[2], d = s[3], e = s[4], f = s[5], g = s[6], h = s[7];
   // 80 rounds
-  for (i = 0; i<80; i++) {
-    S1 = ror(rot[4],14) ^ ror(rot[4],18) ^ ror(rot[4], 41);
-    ch = (rot[4] & rot[5]) ^ ((~ rot[4]) & rot[6]);
-    temp1 = rot[7] + S1 + ch + hash->rconsttable64[i] + block[i];
-    S0 = ror(rot[0],28) ^ ror(rot[0],34) ^ ror(rot[0], 39);
-    maj = (rot[0] & rot[1]) ^ (rot[0] & rot[2]) ^ (rot[1] & rot[2]);
-    temp2 = S0 + maj;
-    memmove(rot+1, rot, 7*sizeof(*rot));
-    rot[4] += temp1;
-    rot[0] = temp1 + temp2;
+  for (i = 0; i<80; i += 8) {
+    SHA2ROUNDS(sha512_S0, sha512_S1, k, block, i)
   }
 
   // Add the previous values of state.i64[]
-  for (i=0; i<8; i++) hash->state.i64[i] += rot[i];
+  s[0] += a, s[1] += b, s[2] += c, s[3] += d;
+  s[4] += e, s[5] += f, s[6] += g, s[7] += h;
 }
 
 // Fill 64/128-byte (512/1024-bit) working buffer, call transform() when full.
+// Whole frames get transformed straight from the input without copying.
 
 static void hash_update(char *data, unsigned int len,
-  void (*transform)(struct browns *hash), int chunksize, struct browns *hash)
+  void (*transform)(struct browns *hash, char *data), int chunksize,
+  struct browns *hash)
 {
   unsigned int i, j;
 
@@ -291,19 +361,19 @@ static void hash_update(char *data, unsigned int len,
   if (hash->count+len<hash->count) hash->overflow++;
   hash->count += len;
 
-  for (;;) {
-    // Grab next chunk of data, return if it's not enough to process a frame
+  // Top up a partial frame left over from last time
+  if (j) {
     i = chunksize - j;
     if (i>len) i = len;
     memcpy(hash->buffer.c+j, data, i);
-    if (j+i != chunksize) break;
-
-    // Process a frame
-    transform(hash);
-    j=0;
+    if (j+i != chunksize) return;
+    transform(hash, hash->buffer.c);
     data += i;
     len -= i;
   }
+  for (; len>=chunksize; data += chunksize, len -= chunksize)
+    transform(hash, data);
+  memcpy(hash->buffer.c, data, len);
 }
 
 void hash_by_name(int fd, char *name, char *result)
@@ -311,9 +381,9 @@ void hash_by_name(int fd, char *name, char *result)
   unsigned long long count[2];
   int i, chunksize, digestlen, method;
   volatile unsigned *pp;
-  void (*transform)(struct browns *hash);
+  void (*transform)(struct browns *hash, char *data);
   struct browns *hash = xzalloc(sizeof(struct browns));
-  char buf;
+  char *buf = hash_buf(), pad;
 
   // md5sum, sha1sum, sha224sum, sha256sum, sha384sum, sha512sum
   method = stridx("us2581", name[4]);
@@ -356,9 +426,9 @@ void hash_by_name(int fd, char *name, char *result)
 
   hash->count = 0;
   for (;;) {
-    i = read(fd, libbuf, sizeof(libbuf));
+    i = read(fd, buf, HASH_READ);
     if (i<1) break;
-    hash_update(libbuf, i, transform, chunksize, hash);
+    hash_update(buf, i, transform, chunksize, hash);
   }
 
   // End the message by appending a "1" bit to the data, ending with the
@@ -367,15 +437,15 @@ void hash_by_name(int fd, char *name, char *result)
   //
   // Since our input up to now has been in whole bytes, we can deal with
   // bytes here too. sha384 and 512 use 128 bit counter, so track overflow.
-  buf = 0x80;
+  pad = 0x80;
   count[0] = (hash->overflow<<3)+(hash->count>>61);
   count[1] = hash->count<<3; // convert to bits
   for (i = 0; i<2; i++)
     count[i] = !method ? SWAP_LE64(count[i]) : SWAP_BE64(count[i]);
   i = 8<<(method>=4);
   do {
-    hash_update(&buf, 1, transform, chunksize, hash);
-    buf = 0;
+    hash_update(&pad, 1, transform, chunksize, hash);
+    pad = 0;
   } while ((hash->count&(chunksize-1)) != chunksize-i);
   hash_update((void *)(count+(method<4)), i, transform, chunksize, hash);
 
@@ -385,10 +455,14 @@ void hash_by_name(int fd, char *name, char *result)
   else for (i=0; i<digestlen/4; i++)
     result += sprintf(result, "%08x",
             !method ? bswap_32(hash->state.i32[i]) : hash->state.i32[i]);
-  // Wipe variables. Cryptographer paranoia. Avoid "optimizing" out memset
-  // by looping on a volatile pointer.
+  // Wipe variables (and as much of the read buffer as this file used).
+  // Cryptographer paranoia. Avoid "optimizing" out memset by looping on a
+  // volatile pointer.
+  i = hash->count<HASH_READ ? (hash->count+3)/4 : HASH_READ/4;
+  for (pp = (void *)buf; pp-(unsigned *)buf<i; pp++) *pp = 0;
+  if (method && name[3] == '2') free(hash->rconsttable32);
+  if (!method && CFG_TOYBOX_FLOAT) free(hash->rconsttable32);
   for (pp = (void *)hash; pp-(unsigned *)hash<sizeof(*hash)/4; pp++) *pp = 0;
-  for (pp = (void *)libbuf; pp-(unsigned *)libbuf<sizeof(libbuf)/4; pp++)
-    *pp = 0;
+  free(hash);
 }
 #endif
@@ -89,6 +89,7 @@ int dirtree_recurse(struct dirtree *node, int (*callback)(struct dirtree *node),
 struct dirtree *dirtree_flagread(char *path, int flags,
   int (*callback)(struct dirtree *node));
 struct dirtree *dirtree_read(char *path, int (*callback)(struct dirtree *node));
+void dirtree_prefetch(int threads);
 
 // Tell xopen and friends to print warnings but return -1 as necessary
 // The largest O_BLAH flag so far is arch/alpha's O_PATH at 0x800000 so
@@ -384,7 +385,7 @@ int comma_remove(char *optlist, char *opt);
 
 // deflate.c
 
-long long gzip_fd(int infd, int outfd);
+long long gzip_fd(int infd, int outfd, int level);
 long long gunzip_fd(int infd, int outfd);
 long long gunzip_mem(char *inbuf, int inlen, char *outbuf, int outlen);
 
@@ -644,35 +644,92 @@ static int check_copy_file_range(void)
 #endif
 }
 
+// Share in's blocks with out (reflink) when copying all of a regular file
+// into an empty one, both at offset 0. Returns bytes copied or -1.
+static long long clone_file(int in, int out)
+{
+#ifdef FICLONE
+  static int noclone;
+  struct stat st, st2;
+
+  if (noclone || fstat(in, &st) || !S_ISREG(st.st_mode) || !st.st_size
+    || fstat(out, &st2) || !S_ISREG(st2.st_mode) || st2.st_size
+    || lseek(in, 0, SEEK_CUR) || lseek(out, 0, SEEK_CUR)) return -1;
+  if (ioctl(out, FICLONE, in)) {
+    // Don't keep asking a filesystem that can't
+    if (errno==EOPNOTSUPP || errno==ENOTTY || errno==EINVAL) noclone++;
+
+    return -1;
+  }
+  lseek(in, st.st_size, SEEK_SET);
+  lseek(out, st.st_size, SEEK_SET);
+
+  return st.st_size;
+#else
+  return -1;
+#endif
+}
+
+// Bounce buffer for when the kernel can't copy for us
+#define SENDFILE_BUF (1<<20)
+
 // Return bytes copied from in to out. If bytes <0 copy all of in to out.
 // If consumed isn't null, amount read saved there (return is written or error)
+// Tries reflink, then copy_file_range(), sendfile(), and splice() (each
+// until it fails), then read/write through a big page aligned buffer.
 long long sendfile_len(int in, int out, long long bytes, long long *consumed)
 {
+  static char *buf;
   long long total = 0, len, ww;
-  int try_cfr = check_copy_file_range();
+  int method = 0, sys[] = {check_copy_file_range(),
+#ifdef __linux__
+    __NR_sendfile, __NR_splice
+#else
+    0, 0
+#endif
+  };
 
   if (consumed) *consumed = 0;
+  if (in>=0 && bytes<0 && (len = clone_file(in, out))>0) {
+    if (consumed) *consumed = len;
+
+    return len;
+  }
   if (in>=0) while (bytes != total) {
     ww = 0;
     len = bytes-total;
+    if (bytes<0 || len>(1<<30)) len = (1<<30);
 
     errno = 0;
-    if (try_cfr) {
-      if (bytes<0 || len>(1<<30)) len = (1<<30);
-      len = syscall(try_cfr, in, 0, out, 0, len, 0);
-      if (len < 0) {
-        try_cfr = 0;
+    if (method<3) {
+      if (!sys[method]) {
+        method++;
+
+        continue;
+      }
+      // sendfile() has out first and an offset pointer, the others match
+      if (method==1) len = syscall(sys[1], out, in, 0, len);
+      else len = syscall(sys[method], in, 0, out, 0, len, 0);
+      // Move on if this fd pair isn't supported. (copy_file_range() can
+      // return 0 on files whose size doesn't match contents, like /proc.)
+      if ((len<0 && errno!=EAGAIN) || (!len && !total)) {
+        method++;
 
         continue;
       }
     } else {
-      if (bytes<0 || len>sizeof(libbuf)) len = sizeof(libbuf);
-      ww = len = read(in, libbuf, len);
+      if (!buf) buf = xmmap(0, SENDFILE_BUF, PROT_READ|PROT_WRITE,
+        MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+#ifdef POSIX_FADV_SEQUENTIAL
+      if (method++==3) posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+      if (len>SENDFILE_BUF) len = SENDFILE_BUF;
+      ww = len = read(in, buf, len);
     }
     if (len<1 && errno==EAGAIN) continue;
     if (len<1) break;
     if (consumed) *consumed += len;
-    if (ww && writeall(out, libbuf, len) != len) return -1;
+    if (ww && writeall(out, buf, len) != len) return -1;
     total += len;
   }
 
@@ -69,6 +69,14 @@
 #define AT_REMOVEDIR 0x200
 #endif
 
+#ifndef AT_NO_AUTOMOUNT      // Kernel commit 6f45b65672c8 2011
+#define AT_NO_AUTOMOUNT 0x800
+#endif
+
+#if defined(__linux__) && !defined(FICLONE) // Kernel commit 04b38d601239 2015
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
 #ifndef O_DIRECT
 #define O_DIRECT 0x4000
 #endif
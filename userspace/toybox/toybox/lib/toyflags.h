@@ -36,5 +36,8 @@
 #define TOYFLAG_LINEBUF  (1<<13)
 #define TOYFLAG_NOBUF    (1<<14)
 
+// Only passes bytes through: skip locale setup (static glibc probes files)
+#define TOYFLAG_NOLOCALE (1<<15)
+
 // Error code to return if argument parsing fails (default 1)
 #define TOYFLAG_ARGFAIL(x) (x<<24)
@@ -217,10 +217,12 @@ void toy_singleinit(struct toy_list *which, char *argv[])
 
     // Try user's locale, but if that isn't UTF-8 merge in a UTF-8 locale's
     // character type data. (Fall back to en_US for MacOS.)
-    setlocale(LC_CTYPE, "");
-    if (strcmp("UTF-8", nl_langinfo(CODESET)))
-      uselocale(newlocale(LC_CTYPE_MASK, "C.UTF-8", 0) ? :
-        newlocale(LC_CTYPE_MASK, "en_US.UTF-8", 0));
+    if (!(which->flags & TOYFLAG_NOLOCALE)) {
+      setlocale(LC_CTYPE, "");
+      if (strcmp("UTF-8", nl_langinfo(CODESET)))
+        uselocale(newlocale(LC_CTYPE_MASK, "C.UTF-8", 0) ? :
+          newlocale(LC_CTYPE_MASK, "en_US.UTF-8", 0));
+    }
 
     if (which->flags & TOYFLAG_LINEBUF) btype = _IOLBF;
     else if (which->flags & TOYFLAG_NOBUF) btype = _IONBF;
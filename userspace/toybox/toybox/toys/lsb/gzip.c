@@ -107,7 +107,7 @@ static int do_deflate(int in_fd, int out_fd, int dd, int level)
   int x;
 
   if (dd) WOULD_EXIT(x, gunzip_fd(in_fd, out_fd));
-  else WOULD_EXIT(x, gzip_fd(in_fd, out_fd));
+  else WOULD_EXIT(x, gzip_fd(in_fd, out_fd, level));
 
   return x;
 }
@@ -2,7 +2,7 @@
  *
  * Copyright 2007 Rob Landley <rob@landley.net>
 
-USE_YES(NEWTOY(yes, 0, TOYFLAG_USR|TOYFLAG_BIN))
+USE_YES(NEWTOY(yes, 0, TOYFLAG_USR|TOYFLAG_BIN|TOYFLAG_NOLOCALE))
 
 config YES
   bool "yes"
@@ -4,7 +4,7 @@
  *
  * See http://opengroup.org/onlinepubs/9699919799/utilities/cat.html
 
-USE_CAT(NEWTOY(cat, "uvte", TOYFLAG_BIN))
+USE_CAT(NEWTOY(cat, "uvte", TOYFLAG_BIN|TOYFLAG_NOLOCALE))
 
 config CAT
   bool "cat"
@@ -30,6 +30,15 @@ static void do_cat(int fd, char *name)
 {
   int i, len, size = FLAG(u) ? 1 : sizeof(toybuf);
 
+  // Without output processing let the kernel move the data
+  if (!toys.optflags) {
+    errno = 0;
+    if (sendfile_len(fd, 1, -1, 0)<0) perror_exit("write");
+    if (errno) perror_msg_raw(name);
+
+    return;
+  }
+
   for(;;) {
     len = read(fd, toybuf, size);
     if (len<0) perror_msg_raw(name);
@@ -5,8 +5,8 @@
  * See http://opengroup.org/onlinepubs/9699919799/utilities/chown.html
  * See http://opengroup.org/onlinepubs/9699919799/utilities/chgrp.html
 
-USE_CHGRP(NEWTOY(chgrp, "<2h(no-dereference)PLHRfv[-HLP]", TOYFLAG_BIN))
-USE_CHOWN(OLDTOY(chown, chgrp, TOYFLAG_BIN))
+USE_CHGRP(NEWTOY(chgrp, "<2h(no-dereference)PLHRfv[-HLP]", TOYFLAG_BIN|TOYFLAG_NOLOCALE))
+USE_CHOWN(OLDTOY(chown, chgrp, TOYFLAG_BIN|TOYFLAG_NOLOCALE))
 
 config CHGRP
   bool "chgrp"
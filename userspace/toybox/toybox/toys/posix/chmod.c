@@ -6,7 +6,7 @@
  *
  * Deviations from posix: -cfv
 
-USE_CHMOD(NEWTOY(chmod, "<2?cvfR[-cvf]", TOYFLAG_BIN))
+USE_CHMOD(NEWTOY(chmod, "<2?cvfR[-cvf]", TOYFLAG_BIN|TOYFLAG_NOLOCALE))
 
 config CHMOD
   bool "chmod"
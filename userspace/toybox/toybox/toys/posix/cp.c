@@ -15,15 +15,15 @@
 // options shared between mv/cp must be in same order (right to left)
 // for FLAG macros to work out right in shared infrastructure.
 
-USE_CP(NEWTOY(cp, "<1(preserve):;D(parents)RHLPprudaslv(verbose)nF(remove-destination)fit:T[-HLPd][-niu][+Rr]", TOYFLAG_BIN))
-USE_MV(NEWTOY(mv, "<1x(swap)v(verbose)nF(remove-destination)fit:T[-ni]", TOYFLAG_BIN))
-USE_INSTALL(NEWTOY(install, "<1cdDp(preserve-timestamps)svt:m:o:g:", TOYFLAG_USR|TOYFLAG_BIN))
+USE_CP(NEWTOY(cp, "<1(preserve):;D(parents)RHLPprudaslj#<1v(verbose)nF(remove-destination)fit:T[-HLPd][-niu][+Rr]", TOYFLAG_BIN|TOYFLAG_NOLOCALE))
+USE_MV(NEWTOY(mv, "<1x(swap)v(verbose)nF(remove-destination)fit:T[-ni]", TOYFLAG_BIN|TOYFLAG_NOLOCALE))
+USE_INSTALL(NEWTOY(install, "<1cdDp(preserve-timestamps)svt:m:o:g:", TOYFLAG_USR|TOYFLAG_BIN|TOYFLAG_NOLOCALE))
 
 config CP
   bool "cp"
   default y
   help
-    usage: cp [-aDdFfHiLlnPpRrsTuv] [--preserve=motcxa] [-t TARGET] SOURCE... [DEST]
+    usage: cp [-aDdFfHiLlnPpRrsTuv] [-j N] [--preserve=motcxa] [-t TARGET] SOURCE... [DEST]
 
     Copy files from SOURCE to DEST.  If more than one SOURCE, DEST must
     be a directory.
@@ -35,6 +35,7 @@ config CP
     -f	Delete destination files we can't write to
     -H	Follow symlinks listed on command line
     -i	Interactive, prompt before overwriting existing DEST
+    -j N	Prefetch source directories with N threads
     -L	Follow all symlinks
     -l	Hard link instead of copy
     -n	No clobber (don't overwrite DEST)
@@ -103,7 +104,9 @@ GLOBALS(
     } i;
     // cp's options
     struct {
-      char *t, *preserve;
+      char *t;
+      long j;
+      char *preserve;
     } c;
   };
 
@@ -382,6 +385,7 @@ void cp_main(void)
     if (destdir) error_exit("'%s' is a directory", destname);
   }
 
+  if (FLAG(j)) dirtree_prefetch(TT.c.j);
   if (FLAG(a)||FLAG(p)) TT.pflags = _CP_mode|_CP_ownership|_CP_timestamps;
 
   // Not using comma_args() (yet?) because interpeting as letters.
@@ -8,13 +8,13 @@
  * 32 bit du -b maxes out at 4 gigs (instead of 2 terabytes via *512 trick)
  * because dirtree->extra is a long.
 
-USE_DU(NEWTOY(du, "d#<0=-1hmlcaHkKLsxb[-HL][-kKmh]", TOYFLAG_USR|TOYFLAG_BIN))
+USE_DU(NEWTOY(du, "d#<0=-1hmlcaHkKLsxbj#<1[-HL][-kKmh]", TOYFLAG_USR|TOYFLAG_BIN))
 
 config DU
   bool "du"
   default y
   help
-    usage: du [-d N] [-abcHKkLlmsx] [FILE...]
+    usage: du [-d N] [-j N] [-abcHKkLlmsx] [FILE...]
 
     Show disk usage, space consumed by files and directories.
 
@@ -29,6 +29,7 @@ config DU
     -a	All files, not just directories
     -c	Cumulative total
     -d N	Only depth < N
+    -j N	Prefetch directories with N threads
     -H	Follow symlinks on cmdline
     -L	Follow all symlinks
     -l	Disable hardlink filter
@@ -40,7 +41,7 @@ config DU
 #include "toys.h"
 
 GLOBALS(
-  long d;
+  long j, d;
 
   unsigned long depth, total;
   dev_t st_dev;
@@ -157,6 +158,7 @@ void du_main(void)
   char *noargs[] = {".", 0}, **args;
 
   // Loop over command line arguments, recursing through children
+  if (FLAG(j)) dirtree_prefetch(TT.j);
   for (args = toys.optc ? toys.optargs : noargs; *args; args++)
     dirtree_flagread(*args, DIRTREE_SYMFOLLOW*(FLAG(H)|FLAG(L)), do_du);
   if (FLAG(c)) print(FLAG(b) ? TT.total : TT.total*512, 0);
@@ -9,18 +9,19 @@
  * Not treating two {} as an error, but only using last
  * TODO: -context
 
-USE_FIND(NEWTOY(find, "?^HL[-HL]", TOYFLAG_USR|TOYFLAG_BIN))
+USE_FIND(NEWTOY(find, "?^j#<1HL[-HL]", TOYFLAG_USR|TOYFLAG_BIN))
 
 config FIND
   bool "find"
   default y
   help
-    usage: find [-HL] [DIR...] [<options>]
+    usage: find [-HL] [-j N] [DIR...] [<options>]
 
     Search directories for matching files.
     Default: search ".", match all, -print matches.
 
     -H  Follow command line symlinks         -L  Follow all symlinks
+    -j  Prefetch directories with N threads (overlap cold disk reads)
 
     Match filters:
     -name  PATTERN   filename with wildcards   -iname      ignore case -name
@@ -69,6 +70,8 @@ config FIND
 #include "toys.h"
 
 GLOBALS(
+  long j;
+
   char **filter;
   struct double_list *argdata;
   int topdir, xdev, depth;
@@ -713,6 +716,7 @@ void find_main(void)
   do_find(0);
 
   // Loop through paths
+  if (FLAG(j)) dirtree_prefetch(TT.j);
   for (i = 0; i < len; i++)
     dirtree_flagread(ss[i],
       DIRTREE_STATLESS|(DIRTREE_SYMFOLLOW*!!(toys.optflags&(FLAG_H|FLAG_L))),
@@ -7,13 +7,13 @@
  * Deviations from POSIX: Lots.
  * We invented -x
 
-USE_SORT(NEWTOY(sort, USE_TOYBOX_FLOAT("g")"S:T:m" "o:k*t:" "xVbMCcszdfirun", TOYFLAG_USR|TOYFLAG_BIN|TOYFLAG_ARGFAIL(2)|TOYFLAG_MOREHELP(CFG_TOYBOX_FLOAT)))
+USE_SORT(NEWTOY(sort, "(parallel)#<1"USE_TOYBOX_FLOAT("g")"S:T:m" "o:k*t:" "xVbMCcszdfirun", TOYFLAG_USR|TOYFLAG_BIN|TOYFLAG_ARGFAIL(2)|TOYFLAG_MOREHELP(CFG_TOYBOX_FLOAT)))
 
 config SORT
   bool "sort"
   default y
   help
-    usage: sort [-bCcdf!giMnrsuxVz] [FILE...] [-k#[,#[x]] [-t X]] [-o FILE]
+    usage: sort [-bCcdf!giMnrsuxVz] [FILE...] [-k#[,#[x]] [-t X]] [-o FILE] [-S SIZE] [-T DIR] [--parallel=N]
 
     Sort all lines of text from input files (or stdin) to stdout.
 
@@ -30,11 +30,14 @@ config SORT
     -o	Output to FILE instead of stdout
     -r	Reverse
     -s	Skip fallback sort (only sort with keys)
+    -S	Buffer SIZE bytes of input, spilling sorted runs to temp files (-T: 64m)
+    -T	Put temp files in DIR (default $TMPDIR or /tmp)
     -t	Use a key separator other than whitespace
     -u	Unique lines only
     -x	Hexadecimal numerical sort
     -V	Version numbers (name-1.234-rc6.5b.tgz)
     -z	Zero (null) terminated lines
+    --parallel=N	Sort using N threads
 
     Sorting by KEY looks at a subset of the words on each line. -k2 uses the
     second word to the end of the line, -k2,2 looks at only the second word,
@@ -47,15 +50,20 @@ config SORT
 
 #define FOR_sort
 #include "toys.h"
+#include <pthread.h>
 
 GLOBALS(
   char *t;
   struct arg_list *k;
-  char *o, *T, S;
+  char *o, *T, *S;
+  long parallel;
 
   void *key_list;
-  unsigned linecount;
-  char **lines, *name;
+  unsigned linecount, runcount;
+  char **lines, *name, *tmpl, *last;
+  long long size, chunk;
+  FILE **runs;
+  int fd;
 )
 
 // The sort types are n, g, and M.
@@ -71,6 +79,12 @@ struct sort_key {
   int flags;
 };
 
+// A sorted sequence of lines being merged: a slice of an array or a run file
+struct merge_src {
+  char *line, **next, **end;
+  FILE *fp;
+};
+
 static int skip_key(char *str)
 {
   int end = 0;
@@ -271,6 +285,140 @@ static int compare_keys(const void *xarg, const void *yarg)
   return retval * ((flags&FLAG_r) ? -1 : 1);
 }
 
+// Advance a merge source to its next line, returning 0 at the end.
+static int merge_next(struct merge_src *src)
+{
+  if (src->fp) {
+    long len;
+
+    if ((src->line = xgetdelim(src->fp, '\n'*!FLAG(z))) && !FLAG(z)
+      && (len = strlen(src->line)) && src->line[len-1]=='\n') src->line[len-1] = 0;
+  } else src->line = (src->next<src->end) ? *src->next++ : 0;
+
+  return !!src->line;
+}
+
+static void heap_down(struct merge_src **heap, int count, int i)
+{
+  struct merge_src *swap;
+  int child;
+
+  while ((child = 2*i+1)<count) {
+    if (child+1<count && compare_keys(&heap[child+1]->line, &heap[child]->line)<0)
+      child++;
+    if (compare_keys(&heap[i]->line, &heap[child]->line)<=0) break;
+    swap = heap[i];
+    heap[i] = heap[child];
+    heap[child] = swap;
+    i = child;
+  }
+}
+
+// k-way merge of sorted sources, passing each line to emit() in order.
+static void merge_sources(struct merge_src *src, int count, void (*emit)(char *))
+{
+  struct merge_src **heap = xmalloc(count*sizeof(*heap));
+  int i, n = 0;
+
+  for (i = 0; i<count; i++) if (merge_next(src+i)) heap[n++] = src+i;
+  for (i = n/2; i--;) heap_down(heap, n, i);
+  while (n) {
+    emit(heap[0]->line);
+    if (!merge_next(*heap)) *heap = heap[--n];
+    heap_down(heap, n, 0);
+  }
+  free(heap);
+}
+
+static void *sort_slice(void *arg)
+{
+  struct merge_src *src = arg;
+
+  qsort(src->next, src->end-src->next, sizeof(char *), compare_keys);
+
+  return 0;
+}
+
+static void merge_to_lines(char *line)
+{
+  TT.lines[TT.linecount++] = line;
+}
+
+// Sort TT.parallel slices of TT.lines on worker threads, then merge them.
+// Slices whose thread can't be started are sorted here instead.
+static void parallel_sort(void)
+{
+  int i, threads, n = TT.parallel;
+  struct merge_src *src = xzalloc(n*sizeof(*src));
+  pthread_t *tid = xmalloc(n*sizeof(*tid));
+  char **lines = TT.lines;
+  unsigned count = TT.linecount;
+
+  for (i = 0; i<n; i++) {
+    src[i].next = lines+(long long)count*i/n;
+    src[i].end = lines+(long long)count*(i+1)/n;
+  }
+  for (i = 1; i<n; i++) if (pthread_create(tid+i, 0, sort_slice, src+i)) break;
+  threads = i;
+  for (sort_slice(src); i<n; i++) sort_slice(src+i);
+  while (--threads) pthread_join(tid[threads], 0);
+
+  // Keep the capacity a multiple of 64 lines for sort_lines()
+  TT.lines = xmalloc(sizeof(char *)*((count+63)&~63));
+  TT.linecount = 0;
+  merge_sources(src, n, merge_to_lines);
+  free(lines);
+  free(src);
+  free(tid);
+}
+
+static void sort_chunk(void)
+{
+  if (TT.parallel>1 && TT.linecount>=2*TT.parallel) parallel_sort();
+  else qsort(TT.lines, TT.linecount, sizeof(char *), compare_keys);
+}
+
+// Sort the buffered lines and save them to an unlinked temp file for the
+// final merge (-S).
+static void spill_run(void)
+{
+  char *name;
+  FILE *fp = xfdopen(xtempfile(TT.tmpl, &name), "w+");
+  unsigned i;
+
+  unlink(name);
+  free(name);
+  sort_chunk();
+  for (i = 0; i<TT.linecount; i++) {
+    fputs(TT.lines[i], fp);
+    putc('\n'*!FLAG(z), fp);
+    free(TT.lines[i]);
+  }
+  if (fflush(fp) || ferror(fp)) perror_exit("write %s", TT.tmpl);
+  rewind(fp);
+  if (!(TT.runcount&15))
+    TT.runs = xrealloc(TT.runs, sizeof(FILE *)*(TT.runcount+16));
+  TT.runs[TT.runcount++] = fp;
+  TT.linecount = 0;
+  TT.size = 0;
+}
+
+// Write one sorted line, dropping duplicates of the previous line for -u.
+static void output_line(char *s)
+{
+  unsigned i = strlen(s);
+
+  if (FLAG(u) && TT.last && !compare_keys(&TT.last, &s)) {
+    free(s);
+    return;
+  }
+  if (!FLAG(z)) s[i] = '\n';
+  xwrite(TT.fd, s, i+1);
+  s[i] = 0;
+  free(TT.last);
+  TT.last = s;
+}
+
 // Read each line from file, appending to a big array.
 static void sort_lines(char **pline, long len)
 {
@@ -296,6 +444,12 @@ static void sort_lines(char **pline, long len)
     TT.lines[TT.linecount] = line;
   }
   TT.linecount++;
+
+  // Past the -S limit the buffered lines become a sorted run on disk
+  if (TT.chunk && !(FLAG(C)||FLAG(c))) {
+    TT.size += len+1+sizeof(char *);
+    if (TT.size>=TT.chunk) spill_run();
+  }
 }
 
 // Callback from loopfiles to handle input files.
@@ -307,7 +461,9 @@ static void sort_read(int fd, char *name)
 
 void sort_main(void)
 {
-  int idx, jdx, fd = 1;
+  int idx;
+
+  TT.fd = 1;
 
   if (FLAG(u)) toys.optflags |= FLAG_s;
 
@@ -336,8 +492,8 @@ void sort_main(void)
             break;
           }
 
-          // Which flag is this?
-          optlist = toys.which->options;
+          // Which flag is this? (Skip the long-only --parallel.)
+          optlist = strchr(toys.which->options, ')')+1;
           temp2 = strchr(optlist, *temp);
           flag = 1<<(optlist-temp2+strlen(optlist)-1);
 
@@ -359,6 +515,14 @@ void sort_main(void)
   // If no keys, perform alphabetic sort over the whole line.
   if (!TT.key_list) add_key()->range[0] = 1;
 
+  // External merge: -S limits the memory used, -T alone implies a default
+  if (TT.S || TT.T) {
+    TT.chunk = TT.S ? atolx(TT.S) : 64<<20;
+    if (TT.chunk<1) error_exit("bad -S %s", TT.S);
+    TT.tmpl = xmprintf("%s/sort.",
+      TT.T ? : getenv("TMPDIR") ? : "/tmp");
+  }
+
   // Open input files and read data, populating TT.lines[TT.linecount]
   loopfiles(toys.optargs, sort_read);
 
@@ -367,34 +531,30 @@ void sort_main(void)
   if (FLAG(C)||FLAG(c)) goto exit_now;
 
   // Perform the actual sort
-  qsort(TT.lines, TT.linecount, sizeof(char *), compare_keys);
-
-  // handle unique (-u)
-  if (FLAG(u)) {
-    for (jdx=0, idx=1; idx<TT.linecount; idx++) {
-      if (!compare_keys(&TT.lines[jdx], &TT.lines[idx])) free(TT.lines[idx]);
-      else TT.lines[++jdx] = TT.lines[idx];
-    }
-    if (TT.linecount) TT.linecount = jdx+1;
-  }
+  sort_chunk();
 
   // Open output file if necessary. We can't do this until we've finished
   // reading in case the output file is one of the input files.
-  if (TT.o) fd = xcreate(TT.o, O_CREAT|O_TRUNC|O_WRONLY, 0666);
+  if (TT.o) TT.fd = xcreate(TT.o, O_CREAT|O_TRUNC|O_WRONLY, 0666);
 
-  // Output result
-  for (idx = 0; idx<TT.linecount; idx++) {
-    char *s = TT.lines[idx];
-    unsigned i = strlen(s);
+  // Output result, merging with any spilled runs (-u handled in output_line)
+  if (TT.runcount) {
+    struct merge_src *src = xzalloc((TT.runcount+1)*sizeof(*src));
 
-    if (!FLAG(z)) s[i] = '\n';
-    xwrite(fd, s, i+1);
-    if (CFG_TOYBOX_FREE) free(s);
-  }
+    for (idx = 0; idx<TT.runcount; idx++) src[idx].fp = TT.runs[idx];
+    src[idx].next = TT.lines;
+    src[idx].end = TT.lines+TT.linecount;
+    merge_sources(src, TT.runcount+1, output_line);
+    for (idx = 0; idx<TT.runcount; idx++) fclose(TT.runs[idx]);
+    free(src);
+  } else for (idx = 0; idx<TT.linecount; idx++) output_line(TT.lines[idx]);
 
 exit_now:
   if (CFG_TOYBOX_FREE) {
-    if (fd != 1) close(fd);
+    if (TT.fd != 1) close(TT.fd);
     free(TT.lines);
+    free(TT.last);
+    free(TT.runs);
+    free(TT.tmpl);
   }
 }
@@ -7,7 +7,7 @@
  * -f is ignored for BSD/macOS compatibility. busybox/coreutils also support
  * this, but only coreutils documents it in --help output.
 
-USE_TOUCH(NEWTOY(touch, "<1acd:fmr:t:h[!dtr]", TOYFLAG_BIN))
+USE_TOUCH(NEWTOY(touch, "<1acd:fmr:t:h[!dtr]", TOYFLAG_BIN|TOYFLAG_NOLOCALE))
 
 config TOUCH
   bool "touch"